@@ -81,6 +81,23 @@ extern "C" {
 
 #define U_SHORT_RANGE_BT_ADDRESS_SIZE 14
 
+#ifndef U_BLE_GAP_SCAN_DEDUP_MAX_NUM
+/** The number of devices remembered when de-duplicating scan
+ *  results, see uBleGapScanFilter_t.
+ */
+# define U_BLE_GAP_SCAN_DEDUP_MAX_NUM 32
+#endif
+
+/** Use as the rssiMin field of uBleGapScanFilter_t to accept
+ *  any RSSI.
+ */
+#define U_BLE_GAP_SCAN_FILTER_RSSI_ANY -128
+
+/** Use as the manufacturerId field of uBleGapScanFilter_t to
+ *  accept any advertisement, with or without manufacturer data.
+ */
+#define U_BLE_GAP_SCAN_FILTER_MANUFACTURER_ID_ANY -1
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -111,6 +128,41 @@ typedef struct {
  */
 typedef bool (*uBleGapScanCallback_t)(uBleScanResult_t *pScanResult);
 
+/** Filter for uBleGapScanFiltered(): a scan result is only passed
+ *  to the callback if it passes all of the tests that are set.
+ *  Initialise with #U_BLE_GAP_SCAN_FILTER_DEFAULTS, which passes
+ *  everything, and then set the fields of interest.
+ */
+typedef struct {
+    const char *const *ppAddressList; /**< only pass devices with one of these
+                                           addresses, in the form of the address
+                                           field of uBleScanResult_t, the
+                                           address type character at the end
+                                           being ignored; NULL for any address. */
+    size_t numAddresses;              /**< the number of entries at ppAddressList. */
+    const char *pNamePrefix;          /**< only pass devices whose name starts
+                                           with this; NULL for any name. */
+    int32_t manufacturerId;           /**< only pass advertisements containing
+                                           manufacturer data with this company
+                                           identifier; use
+                                           #U_BLE_GAP_SCAN_FILTER_MANUFACTURER_ID_ANY
+                                           for any. */
+    int32_t rssiMin;                  /**< only pass devices with an RSSI of at
+                                           least this, in dBm; use
+                                           #U_BLE_GAP_SCAN_FILTER_RSSI_ANY for any. */
+    uint32_t dedupWindowMs;           /**< if non-zero, a result of the same data
+                                           type from a device that was passed less
+                                           than this long ago is not passed again;
+                                           up to #U_BLE_GAP_SCAN_DEDUP_MAX_NUM
+                                           devices are remembered. */
+} uBleGapScanFilter_t;
+
+/** Default values for uBleGapScanFilter_t: pass everything.
+ */
+#define U_BLE_GAP_SCAN_FILTER_DEFAULTS {NULL, 0, NULL,                                   \
+                                        U_BLE_GAP_SCAN_FILTER_MANUFACTURER_ID_ANY,       \
+                                        U_BLE_GAP_SCAN_FILTER_RSSI_ANY, 0}
+
 /** Connect/disconnect callback for central and peripheral.
  *  @param[in]  connHandle  connection handle identifying the peer.
  *                          Must later be used for uBleGapDisconnect and
@@ -175,6 +227,25 @@ int32_t uBleGapScan(uDeviceHandle_t devHandle,
                     uint32_t timeousMs,
                     uBleGapScanCallback_t cb);
 
+/** As uBleGapScan() but only results that pass the given filter are
+ *  passed to the callback; the filtering is done as the results
+ *  arrive, so results that are filtered out cost little.
+ *
+ * @param[in] devHandle   the handle of the u-blox BLE device.
+ * @param[in] discType    type of scan to perform.
+ * @param[in] activeScan  active or passive scan.
+ * @param[in] timeousMs   total time interval in milliseconds used for the scan.
+ * @param[in] pFilter     the filter; NULL to pass everything.
+ * @param[in] cb          a callback routine for the found devices.
+ * @return                zero on success, on failure negative error code.
+ */
+int32_t uBleGapScanFiltered(uDeviceHandle_t devHandle,
+                            uBleGapDiscoveryType_t discType,
+                            bool activeScan,
+                            uint32_t timeousMs,
+                            const uBleGapScanFilter_t *pFilter,
+                            uBleGapScanCallback_t cb);
+
 /** Try connecting to another peripheral BLE device.
  *  If a connection callback has been set via uBleGapSetConnectCallback() then
  *  this will be called when the connection has been completed.
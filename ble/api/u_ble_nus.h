@@ -40,6 +40,15 @@ extern "C" {
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
+
+#ifndef U_BLE_NUS_WRITE_FRAGMENT_SIZE
+/** uBleNusWrite() sends its data in pieces of at most this many
+ *  bytes; this must be no more than the MTU negotiated with the peer,
+ *  less three, and no more than 255.
+ */
+# define U_BLE_NUS_WRITE_FRAGMENT_SIZE 244
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -87,13 +96,15 @@ int32_t uBleNusInit(uDeviceHandle_t devHandle,
                     const char *pAddress,
                     uBleNusReceiveCallback_t cb);
 
-/** Write data to the peer
+/** Write data to the peer; data longer than
+ * #U_BLE_NUS_WRITE_FRAGMENT_SIZE is sent as several writes, one
+ * after the other.
  *
  * @param[in]  pValue      pointer to the data to write.
  * @param[in]  valueLength size of the data.
  * @return                 zero on success, on failure negative error code.
  */
-int32_t uBleNusWrite(const void *pValue, uint8_t valueLength);
+int32_t uBleNusWrite(const void *pValue, size_t valueLength);
 
 /** Create advertisement data package with the NUS service UUID.
  *  This data can then be used for uBleGapAdvertiseStart.
@@ -60,6 +60,20 @@ extern "C" {
 #define U_BLE_SPS_MAX_CONNECTIONS 8
 #endif
 
+/** Number of remote SPS servers whose GATT handles are remembered,
+ *  see uBleSpsSetServerHandleCache().
+ */
+#ifndef U_BLE_SPS_SERVER_HANDLE_CACHE_MAX_NUM
+#define U_BLE_SPS_SERVER_HANDLE_CACHE_MAX_NUM 4
+#endif
+
+/** Size of the transmit queue of a connected data channel used by
+ *  uBleSpsSendQueued(); allocated on first use.
+ */
+#ifndef U_BLE_SPS_TX_QUEUE_SIZE
+#define U_BLE_SPS_TX_QUEUE_SIZE 1024
+#endif
+
 /** Default timeout for data sending. Can be modified per
  *  connection with uBleSpsSetSendTimeout().
  */
@@ -152,6 +166,28 @@ typedef struct {
     uint32_t linkLossTimeout;
 } uBleSpsConnParams_t;
 
+/** The flow control state of an SPS channel, as returned by
+ * uBleSpsGetFlowState().
+ */
+typedef struct {
+    int32_t mtu;               /**< the current ATT MTU of the connection;
+                                    each packet carries up to this less
+                                    three bytes of data. */
+    bool flowCtrlEnabled;      /**< true if credit-based flow control is
+                                    in use on the channel. */
+    bool throughputMode;       /**< true if the channel was connected in
+                                    throughput mode, see
+                                    uBleSpsEnableThroughputModeOnNext(). */
+    int32_t txCredits;         /**< the number of packets that may be sent
+                                    before the remote side grants more
+                                    credits, -1 if not known. */
+    int32_t rxCreditsOnRemote; /**< the number of packets the remote side
+                                    may send before it needs more credits
+                                    from us, -1 if not known. */
+    int32_t rxBufferedBytes;   /**< the number of received bytes waiting
+                                    to be read with uBleSpsReceive(). */
+} uBleSpsFlowState_t;
+
 /** Connection status callback type.
  *
  * @param connHandle             connection handle (use to send disconnect).
@@ -250,6 +286,38 @@ int32_t uBleSpsReceive(uDeviceHandle_t devHandle, int32_t channel, char *pData,
  */
 int32_t uBleSpsSend(uDeviceHandle_t devHandle, int32_t channel, const char *pData, int32_t length);
 
+/** Queue data to send, without blocking.  The data is copied into
+ * the transmit queue of the channel, of #U_BLE_SPS_TX_QUEUE_SIZE,
+ * and sent in the background.  The queues of all channels are
+ * served in turn, one packet from each channel that has data and
+ * TX credits at a time, so that a channel whose remote device is
+ * slow to give credits does not hold up the others; this is intended
+ * for talking to several devices at once.
+ *
+ * uBleSpsSend() and this function should not both be used on the
+ * same channel.  Not supported with a u-connectXpress module.
+ *
+ * @param devHandle the handle of the u-blox device.
+ * @param channel   the channel to send on.
+ * @param[in] pData pointer to the data, must not be NULL.
+ * @param length    length of data to send.
+ * @return          the number of bytes queued, which is less than
+ *                  length, maybe zero, if the queue is full, else
+ *                  negative error code.
+ */
+int32_t uBleSpsSendQueued(uDeviceHandle_t devHandle, int32_t channel,
+                          const char *pData, int32_t length);
+
+/** Get the amount of data in the transmit queue of a channel, see
+ * uBleSpsSendQueued().
+ *
+ * @param devHandle the handle of the u-blox device.
+ * @param channel   the channel.
+ * @return          the number of bytes waiting to be sent, else
+ *                  negative error code.
+ */
+int32_t uBleSpsGetTxQueueLevel(uDeviceHandle_t devHandle, int32_t channel);
+
 /** Set timeout for data sending
  *
  * If sending of data takes more than this time uBleSpsSend() will stop sending data
@@ -307,6 +375,65 @@ int32_t uBleSpsGetSpsServerHandles(uDeviceHandle_t devHandle, int32_t channel,
  */
 int32_t uBleSpsPresetSpsServerHandles(uDeviceHandle_t devHandle, const uBleSpsHandles_t *pHandles);
 
+/** Switch the server handle cache on or off; it is on by default.
+ *
+ * When the cache is on, the server handles discovered on a connection
+ * made with uBleSpsConnectSps(), with flow control enabled, are
+ * remembered against the address of the remote device, for up to
+ * #U_BLE_SPS_SERVER_HANDLE_CACHE_MAX_NUM devices, and are used
+ * instead of discovery the next time uBleSpsConnectSps() is called
+ * with the same address, unless handles have been set with
+ * uBleSpsPresetSpsServerHandles().  If a connection made with cached
+ * handles fails before it is up, the handles for that device are
+ * forgotten, so the next attempt does discovery again.
+ *
+ * The cache is intended for bonded devices, which are expected to
+ * keep their GATT database the same; switch it off when talking to
+ * devices whose GATT database may change.  Switching the cache off
+ * empties it.
+ *
+ * @note This only works when the connecting side is central.
+ *
+ * @param devHandle    the handle of the u-blox device.
+ * @param onNotOff     true to switch the cache on, false to
+ *                     switch it off.
+ *
+ * @return             zero on success, on failure negative error code.
+ */
+int32_t uBleSpsSetServerHandleCache(uDeviceHandle_t devHandle, bool onNotOff);
+
+/** Use throughput mode on the next SPS connection, intended for
+ * streaming large amounts of data.  In throughput mode the LE data
+ * length extension is requested as soon as the link comes up, so
+ * that each MTU-sized packet fits into a single radio packet, and
+ * uBleSpsSend() keeps queueing full packets while it has credits,
+ * yielding only briefly if the BLE stack runs out of buffers, rather
+ * than treating that as the end of the connection event.  The MTU is
+ * always negotiated to the maximum the BLE stack is configured for,
+ * throughput mode or not; use uBleSpsGetFlowState() to see what was
+ * agreed.
+ *
+ * Like uBleSpsDisableFlowCtrlOnNext() this applies to the next
+ * connection only.  With a u-connectXpress module the module always
+ * negotiates the MTU and data length itself, so this function has no
+ * effect there.
+ *
+ * @param devHandle the handle of the u-blox device.
+ * @return          zero on success, on failure negative error code.
+ */
+int32_t uBleSpsEnableThroughputModeOnNext(uDeviceHandle_t devHandle);
+
+/** Get the flow control state of an SPS channel, e.g. to see how
+ * fast data can be sent or whether the remote side is keeping up.
+ *
+ * @param devHandle    the handle of the u-blox device.
+ * @param channel      the channel, given in the connection callback.
+ * @param[out] pState  a place to put the state, cannot be NULL.
+ * @return             zero on success, on failure negative error code.
+ */
+int32_t uBleSpsGetFlowState(uDeviceHandle_t devHandle, int32_t channel,
+                            uBleSpsFlowState_t *pState);
+
 /** Disable flow control for next SPS connection
  *
  * Flow control is enabled by default. Flow control cannot be altered for
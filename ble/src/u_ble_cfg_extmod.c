@@ -55,10 +55,24 @@
 #define U_BLE_CFG_MAX_NUM_SERVERS 7
 #define U_BLE_CFG_STARTUP_MODE_EDM 2
 
+/** The time to wait after the module has been restarted.
+ */
+#define U_BLE_CFG_RESTART_WAIT_MS 5000
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The settings of the module that uBleCfgConfigure() may change,
+ * read in one pass so that only the differences need be written.
+ */
+typedef struct {
+    int32_t role;
+    int32_t spsServerId;  /**< -1 if there is no SPS server. */
+    int32_t freeServerId; /**< a disabled server ID, -1 if none was seen. */
+    int32_t startupMode;
+} uBleCfgSettings_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -67,19 +81,44 @@
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
-static int32_t getStartupMode(const uAtClientHandle_t atHandle)
+// Read the current settings in one pass, under a single AT lock.
+static int32_t readSettings(const uAtClientHandle_t atHandle,
+                            uBleCfgSettings_t *pSettings)
 {
-    int32_t modeOrError;
+    int32_t id;
+    int32_t type;
 
+    pSettings->spsServerId = -1;
+    pSettings->freeServerId = -1;
     uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UBTLE?");
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, "+UBTLE:");
+    pSettings->role = uAtClientReadInt(atHandle);
+    uAtClientResponseStop(atHandle);
+
+    uAtClientCommandStart(atHandle, "AT+UDSC");
+    uAtClientCommandStop(atHandle);
+    // Loop until we get OK, ERROR or timeout
+    while (uAtClientResponseStart(atHandle, "+UDSC:") == 0) {
+        id = uAtClientReadInt(atHandle);
+        type = uAtClientReadInt(atHandle);
+        if (type == U_BLE_CFG_SERVER_TYPE_SPS) {
+            pSettings->spsServerId = id;
+        } else if ((type == (int32_t) U_SHORT_RANGE_SERVER_DISABLED) &&
+                   (pSettings->freeServerId < 0)) {
+            pSettings->freeServerId = id;
+        }
+    }
+    uAtClientResponseStop(atHandle);
+
     uAtClientCommandStart(atHandle, "AT+UMSM?");
     uAtClientCommandStop(atHandle);
     uAtClientResponseStart(atHandle, "+UMSM:");
-    modeOrError = uAtClientReadInt(atHandle);
+    pSettings->startupMode = uAtClientReadInt(atHandle);
     uAtClientResponseStop(atHandle);
-    uAtClientUnlock(atHandle);
 
-    return modeOrError;
+    return uAtClientUnlock(atHandle);
 }
 
 static int32_t setStartupMode(const uAtClientHandle_t atHandle, int32_t mode)
@@ -106,33 +145,6 @@ static int32_t setBleRole(const uAtClientHandle_t atHandle, int32_t role)
     return error;
 }
 
-static int32_t getServer(const uAtClientHandle_t atHandle, int32_t type)
-{
-    int32_t error;
-    int32_t found_id = -1;
-
-    uAtClientLock(atHandle);
-    uAtClientCommandStart(atHandle, "AT+UDSC");
-    uAtClientCommandStop(atHandle);
-
-    // Loop until we get OK, ERROR or timeout
-    while (uAtClientResponseStart(atHandle, "+UDSC:") == 0) {
-        int32_t id = uAtClientReadInt(atHandle);
-        if (uAtClientReadInt(atHandle) == type) {
-            found_id = id;
-        }
-    }
-
-    uAtClientResponseStop(atHandle);
-    error = uAtClientUnlock(atHandle);
-
-    if (error == 0) {
-        error = found_id;
-    }
-
-    return error;
-}
-
 static int32_t disableServer(const uAtClientHandle_t atHandle, int32_t serverId)
 {
     int32_t error;
@@ -149,28 +161,33 @@ static int32_t disableServer(const uAtClientHandle_t atHandle, int32_t serverId)
     return error;
 }
 
-static int32_t setServer(const uAtClientHandle_t atHandle, uShortRangeServerType_t type)
+// Set a server of the given type, using freeId if it is not
+// negative, else searching for a free server ID.
+static int32_t setServer(const uAtClientHandle_t atHandle, uShortRangeServerType_t type,
+                         int32_t freeId)
 {
-    int32_t error;
-    int32_t id = -1;
-    bool found = false;
+    int32_t error = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t id = freeId;
+    bool found = (freeId >= 0);
 
-    uAtClientLock(atHandle);
-    for (size_t y = 0; (y < U_BLE_CFG_MAX_NUM_SERVERS) &&
-         !found; y++) {
-        uAtClientCommandStart(atHandle, "AT+UDSC=");
-        uAtClientWriteInt(atHandle, (int32_t) y);
-        uAtClientCommandStop(atHandle);
-        uAtClientResponseStart(atHandle, "+UDSC:");
-        id = uAtClientReadInt(atHandle);
-        if (uAtClientReadInt(atHandle) == (int32_t) U_SHORT_RANGE_SERVER_DISABLED) {
-            found = true;
+    if (!found) {
+        uAtClientLock(atHandle);
+        for (size_t y = 0; (y < U_BLE_CFG_MAX_NUM_SERVERS) &&
+             !found; y++) {
+            uAtClientCommandStart(atHandle, "AT+UDSC=");
+            uAtClientWriteInt(atHandle, (int32_t) y);
+            uAtClientCommandStop(atHandle);
+            uAtClientResponseStart(atHandle, "+UDSC:");
+            id = uAtClientReadInt(atHandle);
+            if (uAtClientReadInt(atHandle) == (int32_t) U_SHORT_RANGE_SERVER_DISABLED) {
+                found = true;
+                uAtClientResponseStop(atHandle);
+                break;
+            }
             uAtClientResponseStop(atHandle);
-            break;
         }
-        uAtClientResponseStop(atHandle);
+        error = uAtClientUnlock(atHandle);
     }
-    error = uAtClientUnlock(atHandle);
 
     if (found) {
         uAtClientLock(atHandle);
@@ -184,32 +201,6 @@ static int32_t setServer(const uAtClientHandle_t atHandle, uShortRangeServerType
     return error;
 }
 
-static int32_t restart(const uAtClientHandle_t atHandle, bool store)
-{
-    int32_t error = (int32_t) U_ERROR_COMMON_SUCCESS;
-
-    if (store) {
-        uAtClientLock(atHandle);
-        uAtClientCommandStart(atHandle, "AT&W");
-        uAtClientCommandStopReadResponse(atHandle);
-        error = (int32_t)uAtClientUnlock(atHandle);
-    }
-
-    if (error == (int32_t)U_ERROR_COMMON_SUCCESS) {
-        uAtClientLock(atHandle);
-        uAtClientCommandStart(atHandle, "AT+CPWROFF");
-        uAtClientCommandStopReadResponse(atHandle);
-        error = (int32_t)uAtClientUnlock(atHandle);
-
-        if (error == (int32_t) U_ERROR_COMMON_SUCCESS) {
-            uPortTaskBlock(5000);
-            uAtClientFlush(atHandle);
-        }
-    }
-
-    return error;
-}
-
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS THAT ARE PRIVATE TO BLE EXTMOD
  * -------------------------------------------------------------- */
@@ -239,6 +230,7 @@ int32_t uBleCfgConfigure(uDeviceHandle_t devHandle,
     int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
     uShortRangePrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
+    uBleCfgSettings_t settings;
 
     if (pCfg != NULL) {
         errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
@@ -250,8 +242,14 @@ int32_t uBleCfgConfigure(uDeviceHandle_t devHandle,
                 bool restartNeeded = false;
                 atHandle = pInstance->atHandle;
 
-                int32_t role = uBlePrivateGetRole(atHandle);
-                if (role != (int32_t) pCfg->role) {
+                // Read what is there already and then send only the
+                // differences; if the read fails, send everything
+                if (readSettings(atHandle, &settings) != 0) {
+                    settings.role = -1;
+                    settings.startupMode = -1;
+                }
+
+                if (settings.role != (int32_t) pCfg->role) {
                     errorCode = setBleRole(atHandle, (int32_t) pCfg->role);
                     if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
                         restartNeeded = true;
@@ -259,23 +257,22 @@ int32_t uBleCfgConfigure(uDeviceHandle_t devHandle,
                 }
 
                 if (pCfg->spsServer) {
-                    if (getServer(atHandle, U_BLE_CFG_SERVER_TYPE_SPS) < 0) {
+                    if (settings.spsServerId < 0) {
                         errorCode = setServer(atHandle,
-                                              (uShortRangeServerType_t) U_BLE_CFG_SERVER_TYPE_SPS);
+                                              (uShortRangeServerType_t) U_BLE_CFG_SERVER_TYPE_SPS,
+                                              settings.freeServerId);
                         if (errorCode >= 0) {
                             restartNeeded = true;
                         }
                     }
                 } else {
-                    int32_t spsServerId = getServer(atHandle, U_BLE_CFG_SERVER_TYPE_SPS);
-                    if (spsServerId >= 0) {
-                        disableServer(atHandle, spsServerId);
+                    if (settings.spsServerId >= 0) {
+                        disableServer(atHandle, settings.spsServerId);
                         restartNeeded = true;
                     }
                 }
 
-                int32_t mode = getStartupMode(atHandle);
-                if (mode != U_BLE_CFG_STARTUP_MODE_EDM) {
+                if (settings.startupMode != U_BLE_CFG_STARTUP_MODE_EDM) {
                     errorCode = setStartupMode(atHandle, U_BLE_CFG_STARTUP_MODE_EDM);
                     if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
                         restartNeeded = true;
@@ -284,7 +281,9 @@ int32_t uBleCfgConfigure(uDeviceHandle_t devHandle,
 
 
                 if (errorCode >= 0 && restartNeeded) {
-                    restart(atHandle, true);
+                    // Deferred to uShortRangeCfgBatchEnd() if batching
+                    uShortRangePrivateStoreAndRestart(pInstance,
+                                                      U_BLE_CFG_RESTART_WAIT_MS);
                 }
             }
             uShortRangeUnlock();
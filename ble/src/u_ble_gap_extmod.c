@@ -36,6 +36,7 @@
 #include "stdio.h"   // snprintf()
 #include "stdlib.h"  // strol(), atoi(), strol(), strtof()
 #include "string.h"  // memset(), strncpy(), strtok_r(), strtol()
+#include "ctype.h"   // toupper()
 #include "u_error_common.h"
 #include "u_at_client.h"
 #include "u_ble.h"
@@ -61,6 +62,11 @@
 
 #define DONT_CHECK_ROLE 0
 
+/** The number of hex digits in a BT address, not counting the
+ * address type character that follows.
+ */
+#define BT_ADDRESS_HEX_DIGITS 12
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -70,6 +76,14 @@ typedef enum { BLE_ROLE_ANY,
                BLE_ROLE_PERIPHERAL
              } bleRoleCheck_t;
 
+/** An entry in the scan de-duplication table.
+ */
+typedef struct {
+    char address[U_SHORT_RANGE_BT_ADDRESS_SIZE];
+    uint8_t dataType;
+    int32_t timeMs;
+} bleScanDedupEntry_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -128,6 +142,108 @@ static void disconnectUrc(uAtClientHandle_t atHandle, void *pParameter)
     cb(connHandle, NULL, false);
 }
 
+// Compare two BT addresses, ignoring case and the address type.
+static bool addressMatch(const char *pAddress1, const char *pAddress2)
+{
+    bool match = true;
+
+    for (size_t x = 0; match && (x < BT_ADDRESS_HEX_DIGITS); x++) {
+        match = (toupper((int32_t) pAddress1[x]) == toupper((int32_t) pAddress2[x]));
+        if (pAddress1[x] == 0) {
+            break;
+        }
+    }
+
+    return match;
+}
+
+// Return true if the advertisement data contains manufacturer
+// data with the given company identifier.
+static bool hasManufacturerId(const uBleScanResult_t *pResult, int32_t manufacturerId)
+{
+    bool found = false;
+    size_t x = 0;
+    size_t length;
+
+    while (!found && (x + 1 < pResult->dataLength)) {
+        length = pResult->data[x];
+        if (length == 0) {
+            break;
+        }
+        if ((pResult->data[x + 1] == U_BT_DATA_MANUFACTURER_DATA) && (length >= 3) &&
+            (x + 3 < pResult->dataLength)) {
+            // Company identifier is little-endian
+            found = (((int32_t) pResult->data[x + 2]) |
+                     (((int32_t) pResult->data[x + 3]) << 8)) == manufacturerId;
+        }
+        x += length + 1;
+    }
+
+    return found;
+}
+
+// Return true if a scan result passes the fixed tests of a filter.
+static bool scanFilterPass(const uBleGapScanFilter_t *pFilter,
+                           const uBleScanResult_t *pResult)
+{
+    bool pass = true;
+
+    if (pFilter != NULL) {
+        pass = (pResult->rssi >= pFilter->rssiMin);
+        if (pass && (pFilter->pNamePrefix != NULL)) {
+            pass = (strncmp(pResult->name, pFilter->pNamePrefix,
+                            strlen(pFilter->pNamePrefix)) == 0);
+        }
+        if (pass && (pFilter->manufacturerId != U_BLE_GAP_SCAN_FILTER_MANUFACTURER_ID_ANY)) {
+            pass = hasManufacturerId(pResult, pFilter->manufacturerId);
+        }
+        if (pass && (pFilter->ppAddressList != NULL)) {
+            pass = false;
+            for (size_t x = 0; !pass && (x < pFilter->numAddresses); x++) {
+                pass = addressMatch(pResult->address, pFilter->ppAddressList[x]);
+            }
+        }
+    }
+
+    return pass;
+}
+
+// Return true if a scan result has not been passed within the
+// de-duplication window, remembering it if so; when the table is
+// full the entry passed longest ago is re-used.
+static bool scanDedupPass(bleScanDedupEntry_t *pTable, size_t *pNumEntries,
+                          uint32_t windowMs, const uBleScanResult_t *pResult)
+{
+    bool pass = true;
+    int32_t nowMs = uPortGetTickTimeMs();
+    bleScanDedupEntry_t *pEntry = NULL;
+    bleScanDedupEntry_t *pOldest = pTable;
+
+    for (size_t x = 0; (x < *pNumEntries) && (pEntry == NULL); x++) {
+        if ((pTable[x].dataType == pResult->dataType) &&
+            (strcmp(pTable[x].address, pResult->address) == 0)) {
+            pEntry = &(pTable[x]);
+        } else if (pTable[x].timeMs - pOldest->timeMs < 0) {
+            pOldest = &(pTable[x]);
+        }
+    }
+    if (pEntry != NULL) {
+        pass = ((uint32_t) (nowMs - pEntry->timeMs) >= windowMs);
+    } else if (*pNumEntries < U_BLE_GAP_SCAN_DEDUP_MAX_NUM) {
+        pEntry = &(pTable[*pNumEntries]);
+        (*pNumEntries)++;
+    } else {
+        pEntry = pOldest;
+    }
+    if (pass) {
+        memcpy(pEntry->address, pResult->address, sizeof(pEntry->address));
+        pEntry->dataType = pResult->dataType;
+        pEntry->timeMs = nowMs;
+    }
+
+    return pass;
+}
+
 // Use common connect urc callback using the provided application callback as parameter
 static int32_t setConnectUrc(uAtClientHandle_t atHandle, uBleGapConnectCallback_t cb)
 {
@@ -202,9 +318,30 @@ int32_t uBleGapScan(uDeviceHandle_t devHandle,
                     bool activeScan,
                     uint32_t timeousMs,
                     uBleGapScanCallback_t cb)
+{
+    return uBleGapScanFiltered(devHandle, discType, activeScan,
+                               timeousMs, NULL, cb);
+}
+
+int32_t uBleGapScanFiltered(uDeviceHandle_t devHandle,
+                            uBleGapDiscoveryType_t discType,
+                            bool activeScan,
+                            uint32_t timeousMs,
+                            const uBleGapScanFilter_t *pFilter,
+                            uBleGapScanCallback_t cb)
 {
     int32_t errorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
     uShortRangePrivateInstance_t *pInstance;
+    bleScanDedupEntry_t *pDedupTable = NULL;
+    size_t numDedupEntries = 0;
+
+    if ((pFilter != NULL) && (pFilter->dedupWindowMs > 0)) {
+        pDedupTable = (bleScanDedupEntry_t *)pUPortMalloc(U_BLE_GAP_SCAN_DEDUP_MAX_NUM *
+                                                          sizeof(bleScanDedupEntry_t));
+        if (pDedupTable == NULL) {
+            return (int32_t)U_ERROR_COMMON_NO_MEMORY;
+        }
+    }
     if (uShortRangeLock() == (int32_t)U_ERROR_COMMON_SUCCESS) {
         pInstance = pUShortRangePrivateGetInstance(devHandle);
         errorCode = (int32_t)U_BLE_ERROR_INVALID_MODE;
@@ -247,7 +384,10 @@ int32_t uBleGapScan(uDeviceHandle_t devHandle,
                         ok = true;
                     }
                 }
-                if (ok && cb) {
+                if (ok && cb && scanFilterPass(pFilter, &result) &&
+                    ((pDedupTable == NULL) ||
+                     scanDedupPass(pDedupTable, &numDedupEntries,
+                                   pFilter->dedupWindowMs, &result))) {
                     keepGoing = cb(&result);
                 }
             }
@@ -256,6 +396,7 @@ int32_t uBleGapScan(uDeviceHandle_t devHandle,
         }
         uShortRangeUnlock();
     }
+    uPortFree(pDedupTable);
     return errorCode;
 }
 
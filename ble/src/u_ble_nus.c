@@ -63,6 +63,10 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#if (U_BLE_NUS_WRITE_FRAGMENT_SIZE < 1) || (U_BLE_NUS_WRITE_FRAGMENT_SIZE > 255)
+# error U_BLE_NUS_WRITE_FRAGMENT_SIZE must be between 1 and 255
+#endif
+
 #define NUS_SERVICE_UUID "6E400001B5A3F393E0A9E50E24DCCA9E"
 #define NUS_RX_CHAR_UUID "6E400002B5A3F393E0A9E50E24DCCA9E"
 #define NUS_TX_CHAR_UUID "6E400003B5A3F393E0A9E50E24DCCA9E"
@@ -195,13 +199,31 @@ int32_t uBleNusDeInit()
     return errorCode;
 }
 
-int32_t uBleNusWrite(const void *pValue, uint8_t valueLength)
+int32_t uBleNusWrite(const void *pValue, size_t valueLength)
 {
-    if (gIsServer) {
-        return uBleGattWriteNotifyValue(gDeviceHandle, gConnHandle, gTxHandle, pValue, valueLength);
-    } else {
-        return uBleGattWriteValue(gDeviceHandle, gConnHandle, gRxHandle, pValue, valueLength, true);
-    }
+    int32_t errorCode = (int32_t)U_ERROR_COMMON_SUCCESS;
+    const uint8_t *pData = (const uint8_t *)pValue;
+    uint8_t fragmentSize;
+
+    do {
+        fragmentSize = U_BLE_NUS_WRITE_FRAGMENT_SIZE;
+        if (valueLength < fragmentSize) {
+            fragmentSize = (uint8_t)valueLength;
+        }
+        if (gIsServer) {
+            errorCode = uBleGattWriteNotifyValue(gDeviceHandle, gConnHandle, gTxHandle,
+                                                 pData, fragmentSize);
+        } else {
+            errorCode = uBleGattWriteValue(gDeviceHandle, gConnHandle, gRxHandle,
+                                           pData, fragmentSize, true);
+        }
+        if (pData != NULL) {
+            pData += fragmentSize;
+        }
+        valueLength -= fragmentSize;
+    } while ((errorCode == 0) && (valueLength > 0));
+
+    return errorCode;
 }
 
 int32_t uBleNusSetAdvData(uint8_t *pAdvData, uint8_t advDataSize)
@@ -84,6 +84,7 @@ typedef struct uBleSpsChannel_s {
     uShortRangePrivateInstance_t  *pInstance;
     uShortRangePbufList_t         *pSpsRxBuff;
     uint32_t                      txTimeout;
+    int32_t                       mtu;
     struct uBleSpsChannel_s       *pNext;
 } uBleSpsChannel_t;
 
@@ -102,7 +103,8 @@ static void UUBTACLC_urc(uAtClientHandle_t atHandle, void *pParameter);
 // follow prototype
 static void UUBTACLD_urc(uAtClientHandle_t atHandle, void *pParameter);
 static void createSpsChannel(uShortRangePrivateInstance_t *pInstance,
-                             int32_t channel, uBleSpsChannel_t **ppListHead);
+                             int32_t channel, int32_t mtu,
+                             uBleSpsChannel_t **ppListHead);
 static uBleSpsChannel_t *getSpsChannel(const uShortRangePrivateInstance_t *pInstance,
                                        int32_t channel, uBleSpsChannel_t *pListHead);
 static void deleteSpsChannel(const uShortRangePrivateInstance_t *pInstance,
@@ -177,7 +179,8 @@ static void UUBTACLD_urc(uAtClientHandle_t atHandle,
 
 // Allocate and add SPS channel info to linked list
 static void createSpsChannel(uShortRangePrivateInstance_t *pInstance,
-                             int32_t channel, uBleSpsChannel_t **ppListHead)
+                             int32_t channel, int32_t mtu,
+                             uBleSpsChannel_t **ppListHead)
 {
     uBleSpsChannel_t *pChannel = *ppListHead;
 
@@ -204,6 +207,7 @@ static void createSpsChannel(uShortRangePrivateInstance_t *pInstance,
         pChannel->pInstance = pInstance;
         pChannel->pNext = NULL;
         pChannel->txTimeout = U_BLE_SPS_DEFAULT_SEND_TIMEOUT_MS;
+        pChannel->mtu = mtu;
     } else {
         uPortLog("U_BLE_SPS: Failed to create data channel!\n");
     }
@@ -292,7 +296,8 @@ static void spsEventCallback(uAtClientHandle_t atHandle,
             // callback since it will assume that e.g. the rx buffer exists,
             // for the same reason we have to delete it after calling the callback
             if (pStatus->type == (int32_t)U_SHORT_RANGE_EVENT_CONNECTED) {
-                createSpsChannel(pStatus->pInstance, pStatus->dataChannel, &gpChannelList);
+                createSpsChannel(pStatus->pInstance, pStatus->dataChannel, pStatus->mtu,
+                                 &gpChannelList);
             }
             pStatus->pCallback(pStatus->connHandle, pStatus->address, pStatus->type,
                                pStatus->dataChannel, pStatus->mtu, pStatus->pCallbackParameter);
@@ -771,12 +776,76 @@ int32_t uBleSpsPresetSpsServerHandles(uDeviceHandle_t devHandle, const uBleSpsHa
     return (int32_t)U_ERROR_COMMON_NOT_IMPLEMENTED;
 }
 
+int32_t uBleSpsSendQueued(uDeviceHandle_t devHandle, int32_t channel,
+                          const char *pData, int32_t length)
+{
+    (void)devHandle;
+    (void)channel;
+    (void)pData;
+    (void)length;
+    return (int32_t)U_ERROR_COMMON_NOT_IMPLEMENTED;
+}
+
+int32_t uBleSpsGetTxQueueLevel(uDeviceHandle_t devHandle, int32_t channel)
+{
+    (void)devHandle;
+    (void)channel;
+    return (int32_t)U_ERROR_COMMON_NOT_IMPLEMENTED;
+}
+
+int32_t uBleSpsSetServerHandleCache(uDeviceHandle_t devHandle, bool onNotOff)
+{
+    (void)devHandle;
+    (void)onNotOff;
+    return (int32_t)U_ERROR_COMMON_NOT_IMPLEMENTED;
+}
+
 int32_t uBleSpsDisableFlowCtrlOnNext(uDeviceHandle_t devHandle)
 {
     (void)devHandle;
     return (int32_t)U_ERROR_COMMON_NOT_IMPLEMENTED;
 }
 
+int32_t uBleSpsEnableThroughputModeOnNext(uDeviceHandle_t devHandle)
+{
+    // The module looks after the MTU and data length itself
+    (void)devHandle;
+    return (int32_t)U_ERROR_COMMON_SUCCESS;
+}
+
+int32_t uBleSpsGetFlowState(uDeviceHandle_t devHandle, int32_t channel,
+                            uBleSpsFlowState_t *pState)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+
+        pInstance = pUShortRangePrivateGetInstance(devHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pState != NULL)) {
+            const uBleSpsChannel_t *pChannel = getSpsChannel(pInstance, channel, gpChannelList);
+            if (pChannel != NULL) {
+                // Credits are handled inside the module, out of sight
+                pState->mtu = pChannel->mtu;
+                pState->flowCtrlEnabled = true;
+                pState->throughputMode = false;
+                pState->txCredits = -1;
+                pState->rxCreditsOnRemote = -1;
+                pState->rxBufferedBytes = 0;
+                if (pChannel->pSpsRxBuff != NULL) {
+                    pState->rxBufferedBytes = (int32_t)pChannel->pSpsRxBuff->totalLen;
+                }
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        uShortRangeUnlock();
+    }
+
+    return errorCode;
+}
+
 #endif
 
 // End of file
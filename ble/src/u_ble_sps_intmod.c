@@ -59,6 +59,21 @@
 
 #define U_BLE_PDU_HEADER_SIZE 3
 
+#ifndef U_BLE_SPS_THROUGHPUT_RETRY_DELAY_MS
+/** In throughput mode, how long uBleSpsSend() waits before trying
+ * again when the BLE stack has no buffer for another packet.
+ */
+# define U_BLE_SPS_THROUGHPUT_RETRY_DELAY_MS 1
+#endif
+
+#ifndef U_BLE_SPS_TX_QUEUE_MAX_PACKET_SIZE
+/** The largest packet sent from a transmit queue, see
+ * uBleSpsSendQueued(); packets are otherwise as large as the MTU
+ * allows.
+ */
+# define U_BLE_SPS_TX_QUEUE_MAX_PACKET_SIZE 244
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -88,7 +103,8 @@ typedef enum {
     EVENT_SPS_CREDITS_SUBSCRIBED,
     EVENT_SPS_FIFO_SUBSCRIBED,
     EVENT_SPS_CONNECTING_FAILED,
-    EVENT_SPS_RX_DATA_AVAILABLE
+    EVENT_SPS_RX_DATA_AVAILABLE,
+    EVENT_SPS_TX_QUEUE_SERVICE
 } spsEventType_t;
 
 /** SPS Role
@@ -121,11 +137,21 @@ typedef struct {
     uPortSemaphoreHandle_t txCreditsSemaphore;
     char                   rxData[U_BLE_SPS_BUFFER_SIZE];
     uRingBuffer_t          rxRingBuffer;
+    char                  *pTxData; // Allocated by uBleSpsSendQueued()
+    uRingBuffer_t          txRingBuffer;
     uint32_t               dataSendTimeoutMs;
     spsRole_t              localSpsRole;
     bool                   flowCtrlEnabled;
+    bool                   throughputMode;
 } spsConnection_t;
 
+/** Server handles remembered for a remote device
+ * */
+typedef struct {
+    char             remoteAddr[14]; // As in spsConnection_t
+    uBleSpsHandles_t attHandle;
+} spsServerHandleCacheEntry_t;
+
 /** SPS Client event
  * */
 typedef struct {
@@ -150,6 +176,12 @@ static bool sendDataToRemoteFifo(const spsConnection_t *pSpsConn, const char *pD
 static void updateRxCreditsOnRemote(spsConnection_t *pSpsConn);
 static void gapConnectionEvent(int32_t gapConnHandle, uPortGattGapConnStatus_t status,
                                void *pParameter);
+static void requestTxQueueService(void);
+static void serviceTxQueues(void);
+static int32_t findServerHandleCacheEntry(const char *pRemoteAddr);
+static void removeServerHandleCacheEntry(int32_t index);
+static void addServerHandleCacheEntry(const char *pRemoteAddr,
+                                      const uBleSpsHandles_t *pAttHandle);
 
 /**  SPS Client specific functions */
 static uPortGattIter_t onCreditsNotified(int32_t gapConnHandle,
@@ -203,6 +235,14 @@ static void *gpSpsDataAvailableCallbackParam;
 static spsConnection_t *gpSpsConnections[U_BLE_SPS_MAX_CONNECTIONS];
 static uBleSpsHandles_t gNextConnServerHandles;
 static bool gFlowCtrlOnNext = true;
+static bool gThroughputModeOnNext = false;
+static bool gServerHandleCacheOn = true;
+// Most recently used first
+static spsServerHandleCacheEntry_t gServerHandleCache[U_BLE_SPS_SERVER_HANDLE_CACHE_MAX_NUM];
+static size_t gServerHandleCacheNum = 0;
+static volatile bool gTxQueueServicePending = false;
+static int32_t gTxQueueNextSpsConnHandle = 0;
+static char gTxQueuePacket[U_BLE_SPS_TX_QUEUE_MAX_PACKET_SIZE];
 
 static uPortGattUuid128_t gSpsCreditsCharUuid = {
     .type = U_PORT_GATT_UUID_TYPE_128,
@@ -329,12 +369,60 @@ static void freeSpsConnection(int32_t spsConnHandle)
     if (validSpsConnHandle(spsConnHandle)) {
         spsConnection_t *pSpsConn = gpSpsConnections[spsConnHandle];
         uRingBufferDelete(&pSpsConn->rxRingBuffer);
+        if (pSpsConn->pTxData != NULL) {
+            uRingBufferDelete(&pSpsConn->txRingBuffer);
+            uPortFree(pSpsConn->pTxData);
+        }
         uPortSemaphoreDelete(pSpsConn->txCreditsSemaphore);
         uPortFree(pSpsConn);
         gpSpsConnections[spsConnHandle] = NULL;
     }
 }
 
+// Find the server handle cache entry for an address, returning
+// its index or -1.
+static int32_t findServerHandleCacheEntry(const char *pRemoteAddr)
+{
+    int32_t index = -1;
+
+    for (size_t x = 0; (x < gServerHandleCacheNum) && (index < 0); x++) {
+        if (strncmp(gServerHandleCache[x].remoteAddr, pRemoteAddr,
+                    sizeof(gServerHandleCache[x].remoteAddr)) == 0) {
+            index = (int32_t)x;
+        }
+    }
+
+    return index;
+}
+
+static void removeServerHandleCacheEntry(int32_t index)
+{
+    if ((index >= 0) && ((size_t)index < gServerHandleCacheNum)) {
+        gServerHandleCacheNum--;
+        memmove(&(gServerHandleCache[index]), &(gServerHandleCache[index + 1]),
+                (gServerHandleCacheNum - index) * sizeof(gServerHandleCache[0]));
+    }
+}
+
+// Add or refresh the server handle cache entry for an address,
+// putting it at the front; the least recently used entry is
+// dropped if the cache is full.
+static void addServerHandleCacheEntry(const char *pRemoteAddr,
+                                      const uBleSpsHandles_t *pAttHandle)
+{
+    removeServerHandleCacheEntry(findServerHandleCacheEntry(pRemoteAddr));
+    if (gServerHandleCacheNum >= U_BLE_SPS_SERVER_HANDLE_CACHE_MAX_NUM) {
+        gServerHandleCacheNum = U_BLE_SPS_SERVER_HANDLE_CACHE_MAX_NUM - 1;
+    }
+    memmove(&(gServerHandleCache[1]), &(gServerHandleCache[0]),
+            gServerHandleCacheNum * sizeof(gServerHandleCache[0]));
+    memset(&(gServerHandleCache[0]), 0, sizeof(gServerHandleCache[0]));
+    strncpy(gServerHandleCache[0].remoteAddr, pRemoteAddr,
+            sizeof(gServerHandleCache[0].remoteAddr) - 1);
+    gServerHandleCache[0].attHandle = *pAttHandle;
+    gServerHandleCacheNum++;
+}
+
 static bool validSpsConnHandle(int32_t spsConnHandle)
 {
     if ((spsConnHandle >= 0) &&
@@ -371,16 +459,32 @@ static spsConnection_t *initSpsConnection(int32_t spsConnHandle, int32_t gapConn
         pSpsConn->server.creditsClientConf = 0;
         pSpsConn->spsState = SPS_STATE_DISCONNECTED;
         uPortSemaphoreCreate(&(pSpsConn->txCreditsSemaphore), 0, 1);
-        uRingBufferCreate(&pSpsConn->rxRingBuffer, pSpsConn->rxData, sizeof(pSpsConn->rxData));
+        // Single producer (the BLE stack) and single consumer (uBleSpsReceive())
+        uRingBufferCreateLockFree(&pSpsConn->rxRingBuffer, pSpsConn->rxData, sizeof(pSpsConn->rxData));
         uRingBufferReset(&pSpsConn->rxRingBuffer);
         pSpsConn->dataSendTimeoutMs = U_BLE_SPS_DEFAULT_SEND_TIMEOUT_MS;
         pSpsConn->localSpsRole = localSpsRole;
         pSpsConn->flowCtrlEnabled = true;
+        pSpsConn->throughputMode = false;
+        pSpsConn->pTxData = NULL;
     }
 
     return gpSpsConnections[spsConnHandle];
 }
 
+// As server it is the client that exchanges the MTU, so pick up
+// whatever it agreed; must be done before any RX credits are given
+// as they are worked out from the MTU.
+static void refreshServerMtu(spsConnection_t *pSpsConn)
+{
+    int32_t mtu = uPortGattGetMtu(pSpsConn->gapConnHandle);
+
+    if (mtu > pSpsConn->mtu) {
+        pSpsConn->mtu = (uint16_t)mtu;
+        uPortLog("U_BLE_SPS: MTU = %d\n", pSpsConn->mtu);
+    }
+}
+
 static void addLocalTxCredits(int32_t spsConnHandle, uint8_t credits)
 {
     spsConnection_t *pSpsConn = pGetSpsConn(spsConnHandle);
@@ -392,8 +496,13 @@ static void addLocalTxCredits(int32_t spsConnHandle, uint8_t credits)
             // We have received more credits, dataSend function might
             // be waiting for the semaphore indicating the we now have TX credits
             uPortSemaphoreGive(pSpsConn->txCreditsSemaphore);
+            if ((pSpsConn->pTxData != NULL) &&
+                (uRingBufferDataSize(&(pSpsConn->txRingBuffer)) > 0)) {
+                requestTxQueueService();
+            }
         }
         if ((pSpsConn->spsState == SPS_STATE_DISCONNECTED) && pSpsConn->flowCtrlEnabled) {
+            refreshServerMtu(pSpsConn);
             pSpsConn->spsState = SPS_STATE_CONNECTED;
             uPortLog("U_BLE_SPS: Connected as SPS server. Handle %d, remote addr: %s\n",
                      spsConnHandle, pSpsConn->remoteAddr);
@@ -455,6 +564,77 @@ static bool sendDataToRemoteFifo(const spsConnection_t *pSpsConn, const char *pD
     return success;
 }
 
+// Ask for the transmit queues to be served by the event task,
+// unless that has already been asked for.
+static void requestTxQueueService(void)
+{
+    spsEvent_t event;
+
+    if (!gTxQueueServicePending) {
+        gTxQueueServicePending = true;
+        event.type = EVENT_SPS_TX_QUEUE_SERVICE;
+        event.spsConnHandle = U_BLE_SPS_INVALID_HANDLE;
+        if (uPortEventQueueSend(gSpsEventQueue, &event, sizeof(event)) != 0) {
+            gTxQueueServicePending = false;
+        }
+    }
+}
+
+// Serve the transmit queues round-robin, one packet from each
+// connection per pass, until nothing more can be sent; runs in the
+// event task.  Connections that are waiting for TX credits are
+// picked up again when the credits arrive; if the BLE stack is out
+// of buffers we yield briefly and come back.
+static void serviceTxQueues(void)
+{
+    bool progress = true;
+    bool stackBusy = false;
+    spsConnection_t *pSpsConn;
+    int32_t spsConnHandle;
+    size_t length;
+
+    gTxQueueServicePending = false;
+    while (progress && !stackBusy) {
+        progress = false;
+
+        U_PORT_MUTEX_LOCK(gBleSpsMutex);
+
+        for (int32_t x = 0; (x < U_BLE_SPS_MAX_CONNECTIONS) && !stackBusy; x++) {
+            spsConnHandle = (gTxQueueNextSpsConnHandle + x) % U_BLE_SPS_MAX_CONNECTIONS;
+            pSpsConn = gpSpsConnections[spsConnHandle];
+            if ((pSpsConn != NULL) && (pSpsConn->pTxData != NULL) &&
+                (pSpsConn->spsState == SPS_STATE_CONNECTED) &&
+                (!pSpsConn->flowCtrlEnabled || (pSpsConn->txCredits > 0))) {
+                length = pSpsConn->mtu - U_BLE_PDU_HEADER_SIZE;
+                if (length > sizeof(gTxQueuePacket)) {
+                    length = sizeof(gTxQueuePacket);
+                }
+                length = uRingBufferPeek(&(pSpsConn->txRingBuffer), gTxQueuePacket, length, 0);
+                if (length > 0) {
+                    if (sendDataToRemoteFifo(pSpsConn, gTxQueuePacket, (uint16_t)length)) {
+                        uRingBufferRead(&(pSpsConn->txRingBuffer), NULL, length);
+                        if (pSpsConn->flowCtrlEnabled) {
+                            pSpsConn->txCredits--;
+                        }
+                        progress = true;
+                    } else {
+                        stackBusy = true;
+                    }
+                }
+            }
+        }
+        // Start the next pass one along, to be fair
+        gTxQueueNextSpsConnHandle = (gTxQueueNextSpsConnHandle + 1) % U_BLE_SPS_MAX_CONNECTIONS;
+
+        U_PORT_MUTEX_UNLOCK(gBleSpsMutex);
+    }
+
+    if (stackBusy) {
+        uPortTaskBlock(U_BLE_SPS_THROUGHPUT_RETRY_DELAY_MS);
+        requestTxQueueService();
+    }
+}
+
 static void updateRxCreditsOnRemote(spsConnection_t *pSpsConn)
 {
     size_t avaibleBufferSize = uRingBufferAvailableSize(&(pSpsConn->rxRingBuffer));
@@ -531,6 +711,11 @@ static void gapConnectionEvent(int32_t gapConnHandle, uPortGattGapConnStatus_t s
                     pSpsConn->spsState = SPS_STATE_DISCONNECTED;
                 } else {
                     uPortLog("U_BLE_SPS: SPS connection failed!\n");
+                    if (pSpsConn->localSpsRole == SPS_CLIENT) {
+                        // In case the handles came from the cache and
+                        // are what is wrong
+                        removeServerHandleCacheEntry(findServerHandleCacheEntry(pSpsConn->remoteAddr));
+                    }
                     // If a connection attempt failed we have not yet
                     // communicated the connection handle to the upper layer
                     // We still report the failed connection attempt but with
@@ -565,6 +750,11 @@ static void gapConnectionEvent(int32_t gapConnHandle, uPortGattGapConnStatus_t s
                     spsConnection_t *pSpsConn = initSpsConnection(spsConnHandle, gapConnHandle, SPS_SERVER);
                     uPortGattGetRemoteAddress(gapConnHandle, addr, &addrType);
                     addrArrayToString(addr, addrType, true, pSpsConn->remoteAddr);
+                    pSpsConn->throughputMode = gThroughputModeOnNext;
+                    gThroughputModeOnNext = false;
+                    if (pSpsConn->throughputMode) {
+                        uPortGattMaximiseDataLength(gapConnHandle);
+                    }
                     uPortLog("U_BLE_SPS: Remote GAP connected, SPS conn handle: %d\n", spsConnHandle);
                 } else {
                     uPortLog("U_BLE_SPS: We already have maximum nbr of allowed SPS connections!\n", spsConnHandle);
@@ -811,6 +1001,11 @@ static void onBleSpsEvent(void *pParam, size_t eventSize)
     spsConnection_t *pSpsConn;
     (void)eventSize;
 
+    if ((pEvent != NULL) && (pEvent->type == EVENT_SPS_TX_QUEUE_SERVICE)) {
+        serviceTxQueues();
+        return;
+    }
+
     if ((pEvent == NULL) || !validSpsConnHandle(pEvent->spsConnHandle)) {
         return;
     }
@@ -820,6 +1015,9 @@ static void onBleSpsEvent(void *pParam, size_t eventSize)
     switch (pEvent->type) {
 
         case EVENT_GAP_CONNECTED:
+            if (pSpsConn->throughputMode) {
+                uPortGattMaximiseDataLength(pSpsConn->gapConnHandle);
+            }
             if (pSpsConn->client.attHandle.service == 0) {
                 // If service handle is 0 we assume the handles was not
                 // preset and we have to discover them
@@ -899,6 +1097,12 @@ static void onBleSpsEvent(void *pParam, size_t eventSize)
             uPortLog("U_BLE_SPS: Connected as SPS client. Handle %d, remote addr: %s\n",
                      pEvent->spsConnHandle, pSpsConn->remoteAddr);
             pSpsConn->spsState = SPS_STATE_CONNECTED;
+            if (gServerHandleCacheOn && pSpsConn->flowCtrlEnabled) {
+                // Only with flow control are all of the handles known
+                U_PORT_MUTEX_LOCK(gBleSpsMutex);
+                addServerHandleCacheEntry(pSpsConn->remoteAddr, &(pSpsConn->client.attHandle));
+                U_PORT_MUTEX_UNLOCK(gBleSpsMutex);
+            }
             if (gpSpsConnStatusCallback != NULL) {
                 gpSpsConnStatusCallback(pEvent->spsConnHandle,
                                         pSpsConn->remoteAddr,
@@ -923,6 +1127,10 @@ static void onBleSpsEvent(void *pParam, size_t eventSize)
                 gpSpsDataAvailableCallback(pEvent->spsConnHandle, gpSpsDataAvailableCallbackParam);
             }
             break;
+
+        case EVENT_SPS_TX_QUEUE_SERVICE:
+            // Dealt with above
+            break;
     }
 }
 
@@ -955,6 +1163,7 @@ static int32_t remoteWritesFifoCcc(int32_t gapConnHandle, const void *buf, uint1
                 // Client has configured FIFO notifications without
                 // Credits notification, indicating a credit less SPS connection
                 pSpsConn->flowCtrlEnabled = false;
+                refreshServerMtu(pSpsConn);
                 pSpsConn->spsState = SPS_STATE_CONNECTED;
                 uPortLog("U_BLE_SPS: Connected as SPS server. Handle %d, remote addr: %s\n",
                          spsConnHandle, pSpsConn->remoteAddr);
@@ -1169,9 +1378,18 @@ int32_t uBleSpsConnectSps(uDeviceHandle_t devHandle,
                         // Preset server handles (if they are not preset gNextConnServerHandles
                         // is all zero, which will trigger discovery later)
                         memcpy(&(pSpsConn->client.attHandle), &gNextConnServerHandles, sizeof(uBleSpsHandles_t));
+                        if ((pSpsConn->client.attHandle.service == 0) && gServerHandleCacheOn) {
+                            // Not preset: try the cache
+                            int32_t index = findServerHandleCacheEntry(pSpsConn->remoteAddr);
+                            if (index >= 0) {
+                                pSpsConn->client.attHandle = gServerHandleCache[index].attHandle;
+                            }
+                        }
                         // Maybe disable flow control
                         pSpsConn->flowCtrlEnabled = gFlowCtrlOnNext;
                         gFlowCtrlOnNext = true;
+                        pSpsConn->throughputMode = gThroughputModeOnNext;
+                        gThroughputModeOnNext = false;
                         errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                     }
                 }
@@ -1269,6 +1487,10 @@ int32_t uBleSpsSend(uDeviceHandle_t devHandle, int32_t channel, const char *pDat
                     pData += bytesToSendNow;
                     bytesLeftToSend -= bytesToSendNow;
                     pSpsConn->txCredits--;
+                } else if (pSpsConn->throughputMode) {
+                    // The stack is out of buffers: let it get
+                    // some packets out over the air
+                    uPortTaskBlock(U_BLE_SPS_THROUGHPUT_RETRY_DELAY_MS);
                 }
             } else {
                 // We have flow control enabled, we didn't time out waiting
@@ -1290,6 +1512,80 @@ int32_t uBleSpsSend(uDeviceHandle_t devHandle, int32_t channel, const char *pDat
     }
 }
 
+int32_t uBleSpsSendQueued(uDeviceHandle_t devHandle, int32_t channel,
+                          const char *pData, int32_t length)
+{
+    int32_t spsConnHandle = channel;
+    int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    spsConnection_t *pSpsConn;
+    size_t available;
+
+    if ((uDeviceGetDeviceType(devHandle) != (int32_t)U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU) ||
+        (pData == NULL) || (length < 0)) {
+        return sizeOrErrorCode;
+    }
+
+    U_PORT_MUTEX_LOCK(gBleSpsMutex);
+
+    if (validSpsConnHandle(spsConnHandle)) {
+        pSpsConn = pGetSpsConn(spsConnHandle);
+        sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+        if (pSpsConn->spsState == SPS_STATE_CONNECTED) {
+            if (pSpsConn->pTxData == NULL) {
+                sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NO_MEMORY;
+                pSpsConn->pTxData = (char *)pUPortMalloc(U_BLE_SPS_TX_QUEUE_SIZE);
+                if (pSpsConn->pTxData != NULL) {
+                    // Single producer (this function) and single consumer
+                    // (the event task)
+                    uRingBufferCreateLockFree(&pSpsConn->txRingBuffer, pSpsConn->pTxData,
+                                              U_BLE_SPS_TX_QUEUE_SIZE);
+                }
+            }
+            if (pSpsConn->pTxData != NULL) {
+                available = uRingBufferAvailableSize(&(pSpsConn->txRingBuffer));
+                if ((size_t)length > available) {
+                    length = (int32_t)available;
+                }
+                sizeOrErrorCode = 0;
+                if ((length > 0) &&
+                    uRingBufferAdd(&(pSpsConn->txRingBuffer), pData, length)) {
+                    sizeOrErrorCode = length;
+                    requestTxQueueService();
+                }
+            }
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gBleSpsMutex);
+
+    return sizeOrErrorCode;
+}
+
+int32_t uBleSpsGetTxQueueLevel(uDeviceHandle_t devHandle, int32_t channel)
+{
+    int32_t spsConnHandle = channel;
+    int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    spsConnection_t *pSpsConn;
+
+    if (uDeviceGetDeviceType(devHandle) != (int32_t)U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU) {
+        return sizeOrErrorCode;
+    }
+
+    U_PORT_MUTEX_LOCK(gBleSpsMutex);
+
+    if (validSpsConnHandle(spsConnHandle)) {
+        pSpsConn = pGetSpsConn(spsConnHandle);
+        sizeOrErrorCode = 0;
+        if (pSpsConn->pTxData != NULL) {
+            sizeOrErrorCode = (int32_t)uRingBufferDataSize(&(pSpsConn->txRingBuffer));
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gBleSpsMutex);
+
+    return sizeOrErrorCode;
+}
+
 int32_t uBleSpsSetDataAvailableCallback(uDeviceHandle_t devHandle,
                                         uBleSpsAvailableCallback_t pCallback,
                                         void *pCallbackParameter)
@@ -1360,6 +1656,24 @@ int32_t uBleSpsPresetSpsServerHandles(uDeviceHandle_t devHandle, const uBleSpsHa
     return (int32_t)U_ERROR_COMMON_SUCCESS;
 }
 
+int32_t uBleSpsSetServerHandleCache(uDeviceHandle_t devHandle, bool onNotOff)
+{
+    if (uDeviceGetDeviceType(devHandle) != (int32_t)U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU) {
+        return (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    }
+
+    U_PORT_MUTEX_LOCK(gBleSpsMutex);
+
+    gServerHandleCacheOn = onNotOff;
+    if (!onNotOff) {
+        gServerHandleCacheNum = 0;
+    }
+
+    U_PORT_MUTEX_UNLOCK(gBleSpsMutex);
+
+    return (int32_t)U_ERROR_COMMON_SUCCESS;
+}
+
 int32_t uBleSpsDisableFlowCtrlOnNext(uDeviceHandle_t devHandle)
 {
     if (uDeviceGetDeviceType(devHandle) != (int32_t)U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU) {
@@ -1371,6 +1685,45 @@ int32_t uBleSpsDisableFlowCtrlOnNext(uDeviceHandle_t devHandle)
     return (int32_t)U_ERROR_COMMON_SUCCESS;
 }
 
+int32_t uBleSpsEnableThroughputModeOnNext(uDeviceHandle_t devHandle)
+{
+    if (uDeviceGetDeviceType(devHandle) != (int32_t)U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU) {
+        return (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    }
+
+    gThroughputModeOnNext = true;
+
+    return (int32_t)U_ERROR_COMMON_SUCCESS;
+}
+
+int32_t uBleSpsGetFlowState(uDeviceHandle_t devHandle, int32_t channel,
+                            uBleSpsFlowState_t *pState)
+{
+    int32_t spsConnHandle = channel;
+
+    if (uDeviceGetDeviceType(devHandle) != (int32_t)U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU) {
+        return (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    }
+
+    if ((pState == NULL) || !validSpsConnHandle(spsConnHandle)) {
+        return (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    }
+
+    const spsConnection_t *pSpsConn = pGetSpsConn(spsConnHandle);
+    pState->mtu = pSpsConn->mtu;
+    pState->flowCtrlEnabled = pSpsConn->flowCtrlEnabled;
+    pState->throughputMode = pSpsConn->throughputMode;
+    pState->txCredits = -1;
+    pState->rxCreditsOnRemote = -1;
+    if (pSpsConn->flowCtrlEnabled) {
+        pState->txCredits = pSpsConn->txCredits;
+        pState->rxCreditsOnRemote = pSpsConn->rxCreditsOnRemote;
+    }
+    pState->rxBufferedBytes = (int32_t)uRingBufferDataSize(&(pSpsConn->rxRingBuffer));
+
+    return (int32_t)U_ERROR_COMMON_SUCCESS;
+}
+
 #endif
 
 // End of file
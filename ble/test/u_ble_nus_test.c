@@ -97,6 +97,8 @@
 #define SERVER_FOUND (gPeerMac[0] != 0)
 // Connection wait time in seconds. The external server and client may be busy
 #define PEER_WAIT_TIME_S 100
+// Duration of the filtered scans in milliseconds
+#define FILTERED_SCAN_TIME_MS 5000
 
 /* ----------------------------------------------------------------
  * TYPES
@@ -149,6 +151,12 @@ static uBleGapAdvConfig_t gAdvCfg = {
 static char gPeerMac[U_SHORT_RANGE_BT_ADDRESS_SIZE] = {0};
 static char gPeerResponse[100] = {0};
 
+// The number of results of each data type seen by filteredScanResponse()
+static int32_t gFilteredScanCount[3] = {0};
+// The number of results seen by filteredScanResponse() that are not
+// from the server
+static int32_t gFilteredScanBadCount = 0;
+
 static int32_t gResourceCountStart;
 
 /* ----------------------------------------------------------------
@@ -164,6 +172,17 @@ static bool scanResponse(uBleScanResult_t *pScanResult)
     return true;
 }
 
+static bool filteredScanResponse(uBleScanResult_t *pScanResult)
+{
+    // Compare the twelve hex digits, not the address type after them
+    if (strncmp(pScanResult->address, gPeerMac, 12) != 0) {
+        gFilteredScanBadCount++;
+    } else if (pScanResult->dataType < sizeof(gFilteredScanCount) / sizeof(gFilteredScanCount[0])) {
+        gFilteredScanCount[pScanResult->dataType]++;
+    }
+    return true;
+}
+
 static void peerIncoming(uint8_t *pValue, uint8_t valueSize)
 {
     uint8_t maxSize = sizeof(gPeerResponse) - 1;
@@ -222,6 +241,29 @@ U_PORT_TEST_FUNCTION("[bleNus]", "bleNusClient")
                                        scanResponse) == 0);
     }
     U_PORT_TEST_ASSERT(SERVER_FOUND);
+    // Scan repeatedly for just the server, de-duplicating over
+    // longer than the scan: each data type should be passed once
+    const char *pAddressList[] = {gPeerMac};
+    uBleGapScanFilter_t filter = U_BLE_GAP_SCAN_FILTER_DEFAULTS;
+    filter.ppAddressList = pAddressList;
+    filter.numAddresses = 1;
+    filter.dedupWindowMs = FILTERED_SCAN_TIME_MS * 2;
+    U_TEST_PRINT_LINE("filtered scan for %s", gPeerMac);
+    U_PORT_TEST_ASSERT(uBleGapScanFiltered(gDeviceHandle, U_BLE_GAP_SCAN_DISCOVER_ALL,
+                                           true, FILTERED_SCAN_TIME_MS, &filter,
+                                           filteredScanResponse) == 0);
+    U_TEST_PRINT_LINE("%d advertisement(s), %d scan response(s), %d from others",
+                      gFilteredScanCount[1], gFilteredScanCount[2], gFilteredScanBadCount);
+    U_PORT_TEST_ASSERT(gFilteredScanBadCount == 0);
+    U_PORT_TEST_ASSERT(gFilteredScanCount[1] + gFilteredScanCount[2] > 0);
+    U_PORT_TEST_ASSERT((gFilteredScanCount[1] <= 1) && (gFilteredScanCount[2] <= 1));
+    // No device can be received this strongly
+    memset(gFilteredScanCount, 0, sizeof(gFilteredScanCount));
+    filter.rssiMin = 20;
+    U_PORT_TEST_ASSERT(uBleGapScanFiltered(gDeviceHandle, U_BLE_GAP_SCAN_DISCOVER_ALL,
+                                           true, FILTERED_SCAN_TIME_MS, &filter,
+                                           filteredScanResponse) == 0);
+    U_PORT_TEST_ASSERT(gFilteredScanCount[1] + gFilteredScanCount[2] + gFilteredScanBadCount == 0);
     // BLE connection may fail so do multiple tries if that happens
     bool ok = false;
     for (uint32_t i = 0; !ok && i < 3; i++) {
@@ -129,6 +129,7 @@ static void connectionCallback(int32_t connHandle, char *address, int32_t type,
 U_PORT_TEST_FUNCTION("[bleSps]", "bleSps")
 {
     int32_t resourceCount;
+    uBleSpsFlowState_t flowState;
     resourceCount = uTestUtilGetDynamicResourceCount();
 
 #ifdef U_CFG_TEST_SHORT_RANGE_MODULE_TYPE
@@ -163,6 +164,24 @@ U_PORT_TEST_FUNCTION("[bleSps]", "bleSps")
     U_PORT_TEST_ASSERT(uBleSpsSetDataAvailableCallback(gHandles.devHandle, dataAvailableCallback,
                                                        NULL) == 0);
 
+    // Throughput mode may be asked for ahead of a connection but,
+    // with no connection, there is no flow state to get
+    U_PORT_TEST_ASSERT(uBleSpsEnableThroughputModeOnNext(gHandles.devHandle) == 0);
+    U_PORT_TEST_ASSERT(uBleSpsGetFlowState(gHandles.devHandle, 0, NULL) < 0);
+    U_PORT_TEST_ASSERT(uBleSpsGetFlowState(gHandles.devHandle, -1, &flowState) < 0);
+    U_PORT_TEST_ASSERT(uBleSpsGetFlowState(gHandles.devHandle, 0, &flowState) < 0);
+
+    // The server handle cache is only there for open CPU, where it
+    // can be switched off, which empties it, and back on again
+#ifdef U_CFG_TEST_SHORT_RANGE_MODULE_TYPE
+    U_PORT_TEST_ASSERT(uBleSpsSetServerHandleCache(gHandles.devHandle, false) ==
+                       (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED);
+#else
+    U_PORT_TEST_ASSERT(uBleSpsSetServerHandleCache(NULL, true) < 0);
+    U_PORT_TEST_ASSERT(uBleSpsSetServerHandleCache(gHandles.devHandle, false) == 0);
+    U_PORT_TEST_ASSERT(uBleSpsSetServerHandleCache(gHandles.devHandle, true) == 0);
+#endif
+
     uBleTestPrivatePostamble(&gHandles);
 
     uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
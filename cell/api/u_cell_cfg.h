@@ -79,6 +79,50 @@ extern "C" {
 # define U_CELL_CFG_GREETING_CALLBACK_MAX_LEN_BYTES 64
 #endif
 
+#ifndef U_CELL_CFG_TRANSACTION_MAX_NUM_RATS
+/** The maximum number of ranked RATs that may be set with
+ * uCellCfgApply().
+ */
+# define U_CELL_CFG_TRANSACTION_MAX_NUM_RATS 3
+#endif
+
+#ifndef U_CELL_CFG_TRANSACTION_MAX_NUM_BAND_MASKS
+/** The maximum number of band masks that may be set with
+ * uCellCfgApply().
+ */
+# define U_CELL_CFG_TRANSACTION_MAX_NUM_BAND_MASKS 2
+#endif
+
+/** Default values for #uCellCfgTransaction_t: leave everything
+ * alone.
+ */
+#define U_CELL_CFG_TRANSACTION_DEFAULTS {-1,                                  \
+                                         {U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED}, \
+                                         {{U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED, 0, 0}}}
+
+#ifndef U_CELL_CFG_BAUD_RATE_UPGRADE_SETTLE_MS
+/** How long to wait, after the cellular module has acknowledged a
+ * change of baud rate with uCellCfgUpgradeBaudRate(), before
+ * talking to it at the new rate.
+ */
+# define U_CELL_CFG_BAUD_RATE_UPGRADE_SETTLE_MS 100
+#endif
+
+#ifndef U_CELL_CFG_BAUD_RATE_UPGRADE_VERIFY_TRIES
+/** The number of times to try "AT" at a new baud rate, see
+ * uCellCfgUpgradeBaudRate(), before giving up and falling back
+ * to the previous baud rate.
+ */
+# define U_CELL_CFG_BAUD_RATE_UPGRADE_VERIFY_TRIES 3
+#endif
+
+#ifndef U_CELL_CFG_BAUD_RATE_UPGRADE_VERIFY_TIMEOUT_MS
+/** The AT response timeout for each "AT" sent to check a new
+ * baud rate, see uCellCfgUpgradeBaudRate().
+ */
+# define U_CELL_CFG_BAUD_RATE_UPGRADE_VERIFY_TIMEOUT_MS 500
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -97,6 +141,39 @@ typedef enum {
     U_CELL_CFG_GNSS_PROFILE_RESET_AFTER_POWER_ON = 0x40
 } uCellCfgGnssProfile_t;
 
+/** A band mask, as applied by uCellCfgApply().
+ */
+typedef struct {
+    uCellNetRat_t rat;  /**< the RAT that the band mask is for,
+                             #U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED
+                             if this entry is not used. */
+    uint64_t bandMask1; /**< as the parameter of the same name
+                             to uCellCfgSetBandMask(). */
+    uint64_t bandMask2; /**< as the parameter of the same name
+                             to uCellCfgSetBandMask(). */
+} uCellCfgBandMask_t;
+
+/** A set of configuration changes which all require a reboot, to be
+ * applied together with uCellCfgApply().  Initialise this with
+ * #U_CELL_CFG_TRANSACTION_DEFAULTS, which leaves everything alone,
+ * and then populate only the fields you wish to set.
+ */
+typedef struct {
+    int32_t mnoProfile; /**< the MNO profile, as would be passed
+                             to uCellCfgSetMnoProfile(), -1 to leave
+                             the MNO profile alone. */
+    uCellNetRat_t rat[U_CELL_CFG_TRANSACTION_MAX_NUM_RATS]; /**< the RATs
+                             to use, in rank order, as would be set
+                             with uCellCfgSetRat() followed by
+                             uCellCfgSetRatRank(); unused ranks should
+                             be #U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED,
+                             set rat[0] to that to leave the RATs
+                             alone. */
+    uCellCfgBandMask_t bandMask[U_CELL_CFG_TRANSACTION_MAX_NUM_BAND_MASKS]; /**< the
+                             band masks to set, each as would be set
+                             with uCellCfgSetBandMask(). */
+} uCellCfgTransaction_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -254,6 +331,35 @@ int32_t uCellCfgSetMnoProfile(uDeviceHandle_t cellHandle,
  */
 int32_t uCellCfgGetMnoProfile(uDeviceHandle_t cellHandle);
 
+/** Apply several configuration changes, each of which would
+ * otherwise need its own reboot, together: each setting is first
+ * read back from the module and only those which are different are
+ * written, after which the module is rebooted once, and not at all
+ * if nothing needed to change.  The settings are applied in the
+ * order MNO profile, RATs, band masks since an MNO profile may
+ * itself change the RATs and the band masks; because of that, if
+ * the MNO profile needs to change then the module is rebooted
+ * straight afterwards so that the RATs and band masks are compared
+ * against what the new MNO profile has done, which means that at
+ * most two reboots are done.  As for the individual functions, the
+ * module must be powered on but must NOT be connected to the
+ * cellular network.
+ *
+ * @param cellHandle             the handle of the cellular instance.
+ * @param[in] pTransaction       the configuration to apply, cannot be
+ *                               NULL.
+ * @param[in] pKeepGoingCallback passed to uCellPwrReboot(); may be
+ *                               NULL.
+ * @return                       on success the number of settings
+ *                               that were changed, zero meaning that
+ *                               the module already matched and so
+ *                               was not rebooted, else negative
+ *                               error code.
+ */
+int32_t uCellCfgApply(uDeviceHandle_t cellHandle,
+                      const uCellCfgTransaction_t *pTransaction,
+                      bool (*pKeepGoingCallback) (uDeviceHandle_t));
+
 /** Configures the cellular module's serial interface. The configuration
  * affects how an available (physical or logical) serial interface is
  * used, e.g the meaning of data flowing over it. Possible usages are:
@@ -345,7 +451,12 @@ int32_t uCellCfgFactoryReset(uDeviceHandle_t cellHandle, int32_t fsRestoreType,
  * for the greeting message to be sent as soon as the module has
  * booted the baud-rate used by the module must be fixed, e.g.
  * with a call to uCellCfgSetAutoBaudOff() in the case of SARA-R5
- * and SARA-U201.
+ * and SARA-U201.  Where the greeting message is emitted at boot,
+ * and is no longer than #U_CELL_CFG_GREETING_CALLBACK_MAX_LEN_BYTES,
+ * its arrival is used by uCellPwrOn() to tell that the module has
+ * booted, which saves time; for this reason too it is best that
+ * the greeting message is unique, e.g. #U_CELL_CFG_GREETING, and it
+ * is best to set it after auto-bauding has been switched off.
  *
  * @param cellHandle   the handle of the cellular instance.
  * @param[in] pStr     the null-terminated greeting message; use NULL
@@ -450,6 +561,32 @@ int32_t uCellCfgSetAutoBaudOn(uDeviceHandle_t cellHandle);
  */
 bool uCellCfgAutoBaudIsOn(uDeviceHandle_t cellHandle);
 
+/** Move the UART interface to the cellular module to the highest
+ * baud rate that both the module (as reported by AT+IPR=?) and this
+ * MCU's UART support, no higher than baudRateMax.  The new rate is
+ * set in the module with AT+IPR, this MCU's UART is switched to it
+ * with uPortUartSetBaudRate() and then the module is checked for a
+ * response; should that fail, both ends are returned to the current
+ * rate.  The new rate is NOT stored in the module's non-volatile
+ * memory: when the module is rebooted, powered off or enters deep
+ * sleep this MCU's UART is returned to the original baud rate, since
+ * that is what the module will come back at, and this function may
+ * be called again after it has returned.
+ *
+ * This is only supported when the AT interface is a UART (i.e. not
+ * while CMUX is active), on platforms that implement
+ * uPortUartSetBaudRate(), and for modules which only store AT+IPR
+ * when told to (i.e. those that support AT&W, so not SARA-R4).
+ *
+ * @param cellHandle   the handle of the cellular instance.
+ * @param baudRateMax  the maximum baud rate to use.
+ * @return             on success the baud rate now in use, which
+ *                     may be the existing one if nothing higher is
+ *                     available, else negative error code.
+ */
+int32_t uCellCfgUpgradeBaudRate(uDeviceHandle_t cellHandle,
+                                int32_t baudRateMax);
+
 /** Set the GNSS profile (AT+UGPRF), essentially the interface(s) that a
  * GNSS chip inside or connected via the cellular module will use.  Must
  * be sent before the GNSS module is switched on.
@@ -48,6 +48,26 @@ extern "C" {
  */
 #define U_CELL_FILE_NAME_MAX_LENGTH 248
 
+#ifndef U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES
+/** The size of the chunks in which uCellFileWriteStream() and
+ * uCellFileReadStream() pass data to/from the callback; for
+ * uCellFileWriteStream() this amount of RAM is allocated for the
+ * duration of the call, uCellFileReadStream() passes the data
+ * straight out of the receive buffer of the AT client.
+ */
+# define U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES 1024
+#endif
+
+#ifndef U_CELL_FILE_CACHE_MAX_NUM_ENTRIES
+/** The maximum number of files remembered in the cache of the
+ * directory of the file system, which allows uCellFileSize() to be
+ * answered without asking the module; if there are more files than
+ * this the cache is only used for files that this MCU has written or
+ * asked the size of.
+ */
+# define U_CELL_FILE_CACHE_MAX_NUM_ENTRIES 32
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -162,6 +182,83 @@ int32_t uCellFileBlockRead(uDeviceHandle_t cellHandle,
                            size_t offset,
                            size_t dataSize);
 
+/** Write a file of a known size to the file system without holding
+ * all of it in RAM: the data is requested from pCallback in chunks
+ * of up to #U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES, each being sent to
+ * the module as soon as it is provided, all within a single AT
+ * command.  As with uCellFileWrite(), if the file already exists
+ * the data will be appended to it and it is recommended that flow
+ * control lines are connected.
+ *
+ * pCallback is called with the AT interface locked and hence must
+ * not call back into this API; the offset it is given may be used
+ * to report progress.  Should pCallback return an error part way
+ * through, the module is given padding to complete the AT command
+ * and the error is returned; if the file was created by this call it
+ * is deleted, else (i.e. when appending) it is left in place, with
+ * the padding appended, since deleting it would lose what was there
+ * before.
+ *
+ * @param cellHandle      the handle of the cellular instance.
+ * @param[in] pFileName   the name of the file, see uCellFileWrite().
+ * @param totalSize       the number of bytes that will be written.
+ * @param[in] pCallback   the function that provides the data: it
+ *                        is passed the cellular handle, a buffer,
+ *                        the size of the buffer, the offset of the
+ *                        buffer in the file and pCallbackParam; it
+ *                        should write up to size bytes into pBuffer
+ *                        and return the number written, zero or a
+ *                        negative error code meaning that no more
+ *                        data is available.  Cannot be NULL.
+ * @param[in] pCallbackParam  a parameter to pass to pCallback, may
+ *                        be NULL.
+ * @return                on success the number of bytes written,
+ *                        which will be totalSize, else negative
+ *                        error code.
+ */
+int32_t uCellFileWriteStream(uDeviceHandle_t cellHandle,
+                             const char *pFileName,
+                             size_t totalSize,
+                             int32_t (*pCallback) (uDeviceHandle_t cellHandle,
+                                                   char *pBuffer,
+                                                   size_t size,
+                                                   size_t offset,
+                                                   void *pCallbackParam),
+                             void *pCallbackParam);
+
+/** Read a whole file from the file system without holding all of it
+ * in RAM: the file is read with a single AT command and the data
+ * is passed to pCallback in chunks of up to
+ * #U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES as it arrives.  Supports
+ * tags, unlike uCellFileBlockRead().
+ *
+ * pCallback is called with the AT interface locked and hence must
+ * not call back into this API.
+ *
+ * @param cellHandle      the handle of the cellular instance.
+ * @param[in] pFileName   the name of the file, see uCellFileRead().
+ * @param[in] pCallback   the function to receive the data: it is
+ *                        passed the cellular handle, the data, its
+ *                        size, its offset in the file and
+ *                        pCallbackParam; it should return true to
+ *                        continue or false to stop, in which case
+ *                        the remainder of the file is discarded and
+ *                        #U_ERROR_COMMON_CANCELLED is returned.
+ *                        Cannot be NULL.
+ * @param[in] pCallbackParam  a parameter to pass to pCallback, may
+ *                        be NULL.
+ * @return                on success the number of bytes read,
+ *                        else negative error code.
+ */
+int32_t uCellFileReadStream(uDeviceHandle_t cellHandle,
+                            const char *pFileName,
+                            bool (*pCallback) (uDeviceHandle_t cellHandle,
+                                               const char *pData,
+                                               size_t size,
+                                               size_t offset,
+                                               void *pCallbackParam),
+                            void *pCallbackParam);
+
 /** Read size of file on the file system. If the file does not exists,
  * error will be return.
  *
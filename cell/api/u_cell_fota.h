@@ -130,6 +130,14 @@ typedef struct {
                                 #U_CELL_FOTA_STATUS_TYPE_PERCENTAGE_CHECK or
                                 #U_CELL_FOTA_STATUS_TYPE_PERCENTAGE_INSTALL. */
     } value;
+    int32_t elapsedSeconds; /**< populated if type is #U_CELL_FOTA_STATUS_TYPE_PERCENTAGE_DOWNLOAD:
+                                 the number of seconds since the download started (or since
+                                 it was first seen, if the download was already under way
+                                 when the callback was set), else -1. */
+    int32_t etaSeconds; /**< populated if type is #U_CELL_FOTA_STATUS_TYPE_PERCENTAGE_DOWNLOAD:
+                             an estimate, based on the rate of progress so far, of the
+                             number of seconds until the download completes, -1 if this
+                             is not yet known. */
 } uCellFotaStatus_t;
 
 /** Function signature of the FOTA status callback.
@@ -60,6 +60,11 @@ extern "C" {
 # define U_CELL_HTTP_CONTENT_TYPE_MAX_LENGTH_BYTES 64
 #endif
 
+/** The number of custom request headers that can be set with
+ * uCellHttpSetRequestHeader().
+ */
+#define U_CELL_HTTP_REQUEST_HEADER_MAX_NUM 5
+
 #ifndef U_CELL_HTTP_TIMEOUT_SECONDS_MIN
 /** The minimum HTTP timeout value permitted, in seconds.
  */
@@ -330,6 +335,26 @@ int32_t uCellHttpRequestFile(uDeviceHandle_t cellHandle, int32_t httpHandle,
                              const char *pFileNamePutPost,
                              const char *pContentTypePutPost);
 
+/** Set or clear a custom header that will be sent with each subsequent
+ * HTTP request on this HTTP instance, for instance a "Range" header to
+ * resume an interrupted download.  Not supported by SARA-U201.
+ *
+ * @param cellHandle    the handle of the cellular instance to be used.
+ * @param httpHandle    the handle of the HTTP instance, as returned by
+ *                      uCellHttpOpen().
+ * @param headerIndex   the index of the custom header, 0 to
+ *                      #U_CELL_HTTP_REQUEST_HEADER_MAX_NUM - 1.
+ * @param[in] pName     the null-terminated name of the header, for
+ *                      example "Range", without the colon; use NULL
+ *                      to clear the custom header at headerIndex.
+ * @param[in] pValue    the null-terminated value of the header, for
+ *                      example "bytes=1024-"; ignored if pName is NULL.
+ * @return              zero on success else negative error code.
+ */
+int32_t uCellHttpSetRequestHeader(uDeviceHandle_t cellHandle, int32_t httpHandle,
+                                  int32_t headerIndex, const char *pName,
+                                  const char *pValue);
+
 /** Get the last HTTP error code.
  *
  * @param cellHandle     the handle of the cellular instance to be used.
@@ -78,6 +78,47 @@ extern "C" {
  */
 int32_t uCellInfoRefreshRadioParameters(uDeviceHandle_t cellHandle);
 
+/** Set a maximum age for the radio parameters: if
+ * uCellInfoRefreshRadioParameters() is called when the stored
+ * values were refreshed less than this long ago it returns success
+ * immediately, without any AT traffic, leaving the stored values as
+ * they are.  This allows code that monitors the radio parameters
+ * frequently to call uCellInfoRefreshRadioParameters() as often as
+ * it likes without loading the AT interface.  None of the supported
+ * modules emit the radio parameters unsolicited, hence this cannot
+ * be driven by URCs; the age is measured from the last successful
+ * refresh.  The default is zero, meaning that every call to
+ * uCellInfoRefreshRadioParameters() queries the module.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param maxAgeMs    the maximum age in milliseconds; zero to
+ *                    always refresh.
+ * @return            zero on success, negative error code on
+ *                    failure.
+ */
+int32_t uCellInfoSetRadioParametersMaxAge(uDeviceHandle_t cellHandle,
+                                          int32_t maxAgeMs);
+
+/** Get the maximum age of the radio parameters, as set by
+ * uCellInfoSetRadioParametersMaxAge().
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            the maximum age in milliseconds, else
+ *                    negative error code.
+ */
+int32_t uCellInfoGetRadioParametersMaxAge(uDeviceHandle_t cellHandle);
+
+/** Get how long ago the stored radio parameters were refreshed
+ * from the module.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            the age of the stored radio parameters in
+ *                    milliseconds, #U_ERROR_COMMON_NOT_FOUND if
+ *                    they have not been refreshed since they were
+ *                    last cleared, else negative error code.
+ */
+int32_t uCellInfoGetRadioParametersAgeMs(uDeviceHandle_t cellHandle);
+
 /** Get the RSSI that pertained after the last call to
  * uCellInfoRefreshRadioParameters().  Note that RSSI may not
  * be available unless the module has successfully registered
@@ -200,6 +241,10 @@ int32_t uCellInfoGetCellIdPhysical(uDeviceHandle_t cellHandle);
 int32_t uCellInfoGetEarfcn(uDeviceHandle_t cellHandle);
 
 /** Get the IMEI of the cellular module.
+ *
+ * The value is read from the module once and then cached, so
+ * subsequent calls do not involve an AT exchange; the cache is
+ * cleared when the module is powered off, rebooted or reset.
  *
  * @param cellHandle  the handle of the cellular instance.
  * @param[out] pImei  a pointer to #U_CELL_INFO_IMEI_SIZE bytes
@@ -214,6 +259,11 @@ int32_t uCellInfoGetImei(uDeviceHandle_t cellHandle,
                          char *pImei);
 
 /** Get the IMSI of the SIM in the cellular module.
+ *
+ * The value is read from the module once and then cached, so
+ * subsequent calls do not involve an AT exchange; the cache is
+ * cleared when the module is powered off, rebooted or reset, or
+ * when the SIM is switched off (AT+CFUN=0).
  *
  * @param cellHandle  the handle of the cellular instance.
  * @param[out] pImsi  a pointer to #U_CELL_INFO_IMSI_SIZE bytes
@@ -233,6 +283,11 @@ int32_t uCellInfoGetImsi(uDeviceHandle_t cellHandle,
  * digits; it is treated as a string here because of that variable
  * length.
  *
+ * The value is read from the module once and then cached, so
+ * subsequent calls do not involve an AT exchange; the cache is
+ * cleared when the module is powered off, rebooted or reset, or
+ * when the SIM is switched off (AT+CFUN=0).
+ *
  * @param cellHandle  the handle of the cellular instance.
  * @param[out] pStr   a pointer to size bytes of storage into which
  *                    the ICCID string will be copied.  Room
@@ -270,6 +325,10 @@ int32_t uCellInfoGetManufacturerStr(uDeviceHandle_t cellHandle,
                                     char *pStr, size_t size);
 
 /** Get the model identification string from the cellular module.
+ *
+ * The value is read from the module once and then cached, so
+ * subsequent calls do not involve an AT exchange; the cache is
+ * cleared when the module is powered off, rebooted or reset.
  *
  * @param cellHandle  the handle of the cellular instance.
  * @param[out] pStr   a pointer to size bytes of storage into which
@@ -288,6 +347,10 @@ int32_t uCellInfoGetModelStr(uDeviceHandle_t cellHandle,
                              char *pStr, size_t size);
 
 /** Get the firmware version string from the cellular module.
+ *
+ * The value is read from the module once and then cached, so
+ * subsequent calls do not involve an AT exchange; the cache is
+ * cleared when the module is powered off, rebooted or reset.
  *
  * @param cellHandle  the handle of the cellular instance.
  * @param[out] pStr   a pointer to size bytes of storage into which
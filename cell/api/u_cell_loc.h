@@ -150,6 +150,24 @@ extern "C" {
 # define U_CELL_LOC_GNSS_SYSTEM_TYPES 0x7f
 #endif
 
+#ifndef U_CELL_LOC_CACHE_REFRESH_BACKOFF_MIN_SECONDS
+/** How long uCellLocGetCached() waits, after a background refresh
+ * has failed or has returned a fix that is not within the desired
+ * accuracy, before it will start another one; the wait doubles with
+ * each further such refresh, up to
+ * #U_CELL_LOC_CACHE_REFRESH_BACKOFF_MAX_SECONDS.
+ */
+# define U_CELL_LOC_CACHE_REFRESH_BACKOFF_MIN_SECONDS 10
+#endif
+
+#ifndef U_CELL_LOC_CACHE_REFRESH_BACKOFF_MAX_SECONDS
+/** The longest wait uCellLocGetCached() will make between
+ * unsuccessful background refreshes, see
+ * #U_CELL_LOC_CACHE_REFRESH_BACKOFF_MIN_SECONDS.
+ */
+# define U_CELL_LOC_CACHE_REFRESH_BACKOFF_MAX_SECONDS 300
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -316,6 +334,31 @@ void uCellLocSetDesiredAccuracy(uDeviceHandle_t cellHandle,
  */
 int32_t uCellLocGetDesiredAccuracy(uDeviceHandle_t cellHandle);
 
+/** Set the maximum age of a cached location fix.  The last
+ * successful fix, whether obtained with uCellLocGet() or with
+ * uCellLocGetStart(), is kept and, if it is no older than this and
+ * the radius of position is no larger than the desired accuracy (see
+ * uCellLocSetDesiredAccuracy()), uCellLocGet() and uCellLocGetCached()
+ * will return it immediately instead of going to the server.  This is
+ * useful where position is asked for much more often than the device
+ * moves, saving both time and data.  If this is not called then zero
+ * is used, meaning that the cache is not used.
+ *
+ * @param cellHandle     the handle of the cellular instance.
+ * @param maxAgeSeconds  the maximum age of a cached fix in seconds,
+ *                       zero to never use a cached fix.
+ */
+void uCellLocSetCacheMaxAge(uDeviceHandle_t cellHandle,
+                            int32_t maxAgeSeconds);
+
+/** Get the maximum age of a cached location fix.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            the maximum age in seconds, else negative
+ *                    error code.
+ */
+int32_t uCellLocGetCacheMaxAge(uDeviceHandle_t cellHandle);
+
 /** Set the desired location fix time-out.  If this is not called
  * then the default #U_CELL_LOC_DESIRED_FIX_TIMEOUT_DEFAULT_SECONDS
  * is used.
@@ -632,6 +675,47 @@ int32_t uCellLocGetStart(uDeviceHandle_t cellHandle,
                                             int32_t svs,
                                             int64_t timeUtc));
 
+/** Get the location from the cache, non-blocking: if the last
+ * successful fix is within the limits set by uCellLocSetCacheMaxAge()
+ * and uCellLocSetDesiredAccuracy() it is returned immediately,
+ * else a background refresh is started, as if uCellLocGetStart()
+ * had been called with a NULL callback, and #U_ERROR_COMMON_BUSY
+ * is returned; call this function again later to pick up the
+ * refreshed fix.  If a refresh fails, or returns a fix that is not
+ * within the desired accuracy, no new refresh is started for
+ * #U_CELL_LOC_CACHE_REFRESH_BACKOFF_MIN_SECONDS, doubling with each
+ * further unsuccessful refresh up to
+ * #U_CELL_LOC_CACHE_REFRESH_BACKOFF_MAX_SECONDS; during that time
+ * the outcome of the last refresh is returned.  The parameters are
+ * as for uCellLocGet().
+ *
+ * @param cellHandle                       the handle of the cellular instance.
+ * @param[out] pLatitudeX1e7               a place to put latitude; may be NULL.
+ * @param[out] pLongitudeX1e7              a place to put longitude; may be NULL.
+ * @param[out] pAltitudeMillimetres        a place to put the altitude; may be NULL.
+ * @param[out] pRadiusMillimetres          a place to put the radius of position;
+ *                                         may be NULL.
+ * @param[out] pSpeedMillimetresPerSecond  a place to put the speed; may be NULL.
+ * @param[out] pSvs                        a place to put the number of space
+ *                                         vehicles used; may be NULL.
+ * @param[out] pTimeUtc                    a place to put the UTC time; may be NULL.
+ * @return                                 zero if a cached fix was returned,
+ *                                         #U_ERROR_COMMON_BUSY if a refresh
+ *                                         is in progress, else negative error
+ *                                         code, e.g. if the module is not
+ *                                         registered and so a refresh could
+ *                                         not be started, or the error code
+ *                                         of the last refresh (where a fix
+ *                                         outside the desired accuracy is
+ *                                         #U_ERROR_COMMON_NOT_FOUND) while
+ *                                         waiting to try again.
+ */
+int32_t uCellLocGetCached(uDeviceHandle_t cellHandle,
+                          int32_t *pLatitudeX1e7, int32_t *pLongitudeX1e7,
+                          int32_t *pAltitudeMillimetres, int32_t *pRadiusMillimetres,
+                          int32_t *pSpeedMillimetresPerSecond,
+                          int32_t *pSvs, int64_t *pTimeUtc);
+
 /** Get the last status of a location fix attempt.
  *
  * @param cellHandle  the handle of the cellular instance.
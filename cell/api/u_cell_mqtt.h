@@ -69,6 +69,14 @@ extern "C" {
 # define U_CELL_MQTT_PUBLISH_BIN_MAX_LENGTH_BYTES 1024
 #endif
 
+#ifndef U_CELL_MQTT_SN_REGISTER_PIPELINE_DEPTH
+/** The number of MQTT-SN topic registrations that
+ * uCellMqttSnRegisterNormalTopicList() sends to the module, one
+ * after the other, before waiting for the answers.
+ */
+# define U_CELL_MQTT_SN_REGISTER_PIPELINE_DEPTH 4
+#endif
+
 #ifndef U_CELL_MQTT_WRITE_TOPIC_MAX_LENGTH_BYTES
 /** The maximum length of an MQTT topic used as a filter
  * or in a will message in bytes; this does NOT include
@@ -119,6 +127,28 @@ extern "C" {
 # define U_CELL_MQTT_PROMPT_TIMEOUT_KEEP_ALIVE_SECONDS 30
 #endif
 
+#ifndef U_CELL_MQTT_PUBLISH_QUEUE_MAX_NUM_MESSAGES
+/** The maximum number of messages that may be waiting in the
+ * queue of uCellMqttPublishAsync().
+ */
+# define U_CELL_MQTT_PUBLISH_QUEUE_MAX_NUM_MESSAGES 50
+#endif
+
+#ifndef U_CELL_MQTT_PUBLISH_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that sends the messages queued
+ * by uCellMqttPublishAsync(); the message callbacks are also
+ * called from this task.
+ */
+# define U_CELL_MQTT_PUBLISH_TASK_STACK_SIZE_BYTES 2560
+#endif
+
+#ifndef U_CELL_MQTT_PUBLISH_TASK_PRIORITY
+/** The priority of the task that sends the messages queued by
+ * uCellMqttPublishAsync().
+ */
+# define U_CELL_MQTT_PUBLISH_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -667,6 +697,68 @@ int32_t uCellMqttPublish(uDeviceHandle_t cellHandle, const char *pTopicNameStr,
                          size_t messageSizeBytes,
                          uCellMqttQos_t qos, bool retain);
 
+/** Queue an MQTT message for publishing and return without waiting.
+ * The topic and message are copied and then published, in the
+ * order they were queued, by a task of this API which behaves
+ * exactly as uCellMqttPublish() would, including retries and, for
+ * QoS 1 and 2, waiting for the module to report that the publish
+ * is complete.  Since the calling task need not wait, a burst of
+ * messages is sent as quickly as the module will accept them.
+ * Messages still in the queue when uCellMqttDeinit() is called
+ * are not sent; their callbacks are called with
+ * #U_ERROR_COMMON_CANCELLED.
+ *
+ * @param cellHandle        the handle of the cellular instance to
+ *                          be used.
+ * @param[in] pTopicNameStr the null-terminated topic string
+ *                          for the message; cannot be NULL.
+ * @param[in] pMessage      a pointer to the message, see
+ *                          uCellMqttPublish().
+ * @param messageSizeBytes  the length of pMessage, see
+ *                          uCellMqttPublish().
+ * @param qos               the MQTT QoS to use for this message.
+ * @param retain            if true the message will be retained
+ *                          by the broker.
+ * @param[in] pCallback     a function to call when the message
+ *                          has been published, or has failed to
+ *                          be; the parameters are the cellular
+ *                          handle, the message handle returned by
+ *                          this function, zero on success else
+ *                          the negative error code that
+ *                          uCellMqttPublish() would have returned,
+ *                          and pCallbackParam.  The callback is
+ *                          called from a task with a stack of
+ *                          #U_CELL_MQTT_PUBLISH_TASK_STACK_SIZE_BYTES
+ *                          and may call this API.  May be NULL.
+ * @param[in] pCallbackParam a parameter to pass to pCallback;
+ *                          may be NULL.
+ * @return                  on success a non-negative message
+ *                          handle, else negative error code,
+ *                          e.g. #U_ERROR_COMMON_BUSY if there are
+ *                          already
+ *                          #U_CELL_MQTT_PUBLISH_QUEUE_MAX_NUM_MESSAGES
+ *                          in the queue.
+ */
+int32_t uCellMqttPublishAsync(uDeviceHandle_t cellHandle,
+                              const char *pTopicNameStr,
+                              const char *pMessage,
+                              size_t messageSizeBytes,
+                              uCellMqttQos_t qos, bool retain,
+                              void (*pCallback) (uDeviceHandle_t,
+                                                 int32_t,
+                                                 int32_t,
+                                                 void *),
+                              void *pCallbackParam);
+
+/** Get the number of messages in the queue of
+ * uCellMqttPublishAsync(), including any that is being published.
+ *
+ * @param cellHandle the handle of the cellular instance to be used.
+ * @return           on success the number of messages, else
+ *                   negative error code.
+ */
+int32_t uCellMqttPublishAsyncGetNum(uDeviceHandle_t cellHandle);
+
 /** Subscribe to an MQTT topic. The pKeepGoingCallback()
  * function set during initialisation will be called while
  * this function is waiting for a subscription to complete.
@@ -776,6 +868,33 @@ int32_t uCellMqttSnRegisterNormalTopic(uDeviceHandle_t cellHandle,
                                        const char *pTopicNameStr,
                                        uCellMqttSnTopicName_t *pTopicName);
 
+/** MQTT-SN only: as uCellMqttSnRegisterNormalTopic() but for a list
+ * of topics, sending up to #U_CELL_MQTT_SN_REGISTER_PIPELINE_DEPTH
+ * registrations to the module before waiting for the answers, rather
+ * than waiting for a round trip to the broker for each one.  The
+ * module answers registrations in the order they were sent.
+ *
+ * There is no retry here: a topic that could not be registered has
+ * its type set to #U_CELL_MQTT_SN_TOPIC_NAME_TYPE_MAX_NUM and may
+ * be retried with uCellMqttSnRegisterNormalTopic().
+ *
+ * Must be connected to an MQTT-SN broker for this to work.
+ *
+ * @param cellHandle          the handle of the cellular instance to
+ *                            be used.
+ * @param[in] ppTopicNameStr  an array of numTopics null-terminated
+ *                            topic name strings; cannot be NULL.
+ * @param numTopics           the number of topics.
+ * @param[out] pTopicNames    an array of numTopics places to put the
+ *                            MQTT-SN topic names; cannot be NULL.
+ * @return                    on success the number of topics that were
+ *                            registered, else negative error code.
+ */
+int32_t uCellMqttSnRegisterNormalTopicList(uDeviceHandle_t cellHandle,
+                                           const char *const *ppTopicNameStr,
+                                           size_t numTopics,
+                                           uCellMqttSnTopicName_t *pTopicNames);
+
 /** MQTT-SN only: publish a message; this differs from uCellMqttPublish()
  * in that it uses an MQTT-SN topic name, which will be a predefined ID
  * or a short name or as returned by uCellMqttSnRegisterNormalTopic()/
@@ -41,6 +41,19 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES
+/** The largest information field length (N1 in 3GPP 27.010) that
+ * may be set with uCellMuxSetFrameSize(); the internal buffers of
+ * the multiplexer are sized according to this value, hence it
+ * defaults to the same value as the default information field length,
+ * 128.  If you intend to use larger frames, e.g. for bulk GNSS
+ * data, you should increase this (the maximum is 1509), which
+ * costs roughly four times the increase in RAM when the
+ * multiplexer is enabled.
+ */
+# define U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES 128
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -58,6 +71,53 @@ extern "C" {
 # define U_CELL_MUX_MAX_CHANNELS 3
 #endif
 
+#ifndef U_CELL_MUX_PPP_CONNECT_TIMEOUT_MS
+/** How long to wait for the module to respond with CONNECT
+ * when a PPP channel is opened with uCellMuxPppOpen().
+ */
+# define U_CELL_MUX_PPP_CONNECT_TIMEOUT_MS 10000
+#endif
+
+#ifndef U_CELL_MUX_DATA_COMMAND_MAX_LENGTH_BYTES
+/** The maximum length of the command passed to uCellMuxDataOpen(),
+ * not including the null terminator.
+ */
+# define U_CELL_MUX_DATA_COMMAND_MAX_LENGTH_BYTES 32
+#endif
+
+/** Statistics for a CMUX channel, see uCellMuxGetChannelStats().
+ * All of the counts are reset when the channel is opened.
+ */
+typedef struct {
+    uint32_t framesReceived; /**< the number of UI/UIH frames received. */
+    uint32_t bytesReceived;  /**< the number of information field bytes
+                                  placed in the receive buffer. */
+    uint32_t framesSent;     /**< the number of UIH frames sent. */
+    uint32_t bytesSent;      /**< the number of information field bytes sent. */
+    uint32_t fcsErrors;      /**< the number of frames, addressed to this
+                                  channel, that were thrown away because
+                                  their FCS was incorrect. */
+    uint32_t bytesDiscarded; /**< the number of received information field
+                                  bytes thrown away because the receive
+                                  buffer was full, only possible if
+                                  discard on overflow is enabled. */
+    uint32_t stalls;         /**< the number of times the decoding of
+                                  received frames, for all channels, was
+                                  held up because the receive buffer of this
+                                  channel was full. */
+    uint32_t rxFlowControlOffCount; /**< the number of times we asked the
+                                         module to stop sending on this
+                                         channel. */
+    int32_t rxFlowControlOffMs; /**< the total time for which we have asked
+                                     the module to stop sending on this
+                                     channel, in milliseconds. */
+    uint32_t txFlowControlOffCount; /**< the number of times the module asked
+                                         us to stop sending on this channel. */
+    int32_t txFlowControlOffMs; /**< the total time for which the module
+                                     has asked us to stop sending on this
+                                     channel, in milliseconds. */
+} uCellMuxChannelStats_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS:  WORKAROUND FOR LINKER ISSUE
  * -------------------------------------------------------------- */
@@ -115,6 +175,38 @@ void uCellMuxPrivateLink(void);
  */
 int32_t uCellMuxEnable(uDeviceHandle_t cellHandle);
 
+/** Set the maximum length of the information field of a CMUX frame,
+ * N1 in 3GPP 27.010, that will be requested by the next call to
+ * uCellMuxEnable(); it has no effect on a multiplexer that is
+ * already enabled.  Larger frames mean less header and FCS overhead
+ * for bulk transfers, e.g. of GNSS data, at the expense of a little
+ * latency for the other channels.  Note that, in basic mode, which
+ * is all that the u-blox cellular modules support, the same maximum
+ * information field length applies to all channels; the receive
+ * buffers of the channels are sized, when they are opened, to be
+ * at least four times the information field length.  The default
+ * is 128 bytes.
+ *
+ * @param cellHandle             the handle of the cellular instance.
+ * @param informationLengthBytes the maximum information field length;
+ *                               must be at least 1 and no more than
+ *                               #U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES.
+ *                               Use zero to return to the default.
+ * @return                       zero on success or negative error code
+ *                               on failure.
+ */
+int32_t uCellMuxSetFrameSize(uDeviceHandle_t cellHandle,
+                             size_t informationLengthBytes);
+
+/** Get the maximum length of the information field of a CMUX frame,
+ * as set by uCellMuxSetFrameSize().
+ *
+ * @param cellHandle the handle of the cellular instance.
+ * @return           on success the maximum information field length,
+ *                   else negative error code.
+ */
+int32_t uCellMuxGetFrameSize(uDeviceHandle_t cellHandle);
+
 /** Determine if the multiplexer is currently enabled.
  *
  * @param cellHandle the handle of the cellular instance.
@@ -204,6 +296,97 @@ int32_t uCellMuxAddChannel(uDeviceHandle_t cellHandle,
 uDeviceSerial_t *pUCellMuxChannelGetDeviceSerial(uDeviceHandle_t cellHandle,
                                                  int32_t channel);
 
+/** Get the statistics for an open multiplexer channel; useful
+ * when diagnosing data loss, e.g. to tell whether a receive buffer
+ * overflowed, flow control held things up or frames were corrupted.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param channel     the channel number, which may be
+ *                    #U_CELL_MUX_CHANNEL_ID_GNSS.
+ * @param[out] pStats a place to put the statistics; cannot be NULL.
+ * @return            zero on success or negative error code on failure.
+ */
+int32_t uCellMuxGetChannelStats(uDeviceHandle_t cellHandle,
+                                int32_t channel,
+                                uCellMuxChannelStats_t *pStats);
+
+/** Open a multiplexer channel for PPP: a channel is opened, the
+ * module is told to enter data mode on it with ATD*99***x#, where
+ * x is #U_CELL_NET_CONTEXT_ID, and, once the module has responded
+ * with CONNECT, the serial device for the channel is returned.
+ * Everything written to or read from that serial device is then
+ * PPP, carried over the multiplexer alongside the AT interface
+ * (and any GNSS channel), and so the serial device may be bound
+ * to the PPP client of an IP stack on this MCU, e.g. lwIP's pppos
+ * (write() of the serial device as the output callback, the event
+ * callback of the serial device feeding what is read to
+ * pppos_input()) or, on Linux, a pty that is passed to pppd; this
+ * allows the IP stack and TLS library of this MCU to be used in
+ * place of the AT sockets of the module, which require an AT
+ * command per packet.
+ *
+ * uCellMuxEnable() must have been called and the module should
+ * be registered with the network, e.g. by calling uCellNetConnect(),
+ * which will also have defined the PDP context.  Note that the
+ * PPP channel occupies a multiplexer channel: if you also wish to
+ * use GNSS over the multiplexer you will need to increase
+ * #U_CELL_MUX_MAX_CHANNELS to 4.
+ *
+ * @param cellHandle           the handle of the cellular instance.
+ * @param[out] ppDeviceSerial  a place to put the serial device of
+ *                             the PPP channel; cannot be NULL.
+ * @return                     zero on success or negative error code
+ *                             on failure.
+ */
+int32_t uCellMuxPppOpen(uDeviceHandle_t cellHandle,
+                        uDeviceSerial_t **ppDeviceSerial);
+
+/** Open the multiplexer channel that is otherwise used for PPP,
+ * see uCellMuxPppOpen(), send it an AT command that puts the module
+ * into data mode on that channel and, once the module has responded
+ * with CONNECT (waiting up to #U_CELL_MUX_PPP_CONNECT_TIMEOUT_MS),
+ * return the serial device for the channel.  uCellMuxPppOpen() is
+ * this function with the command "ATD*99***x#"; another example is
+ * uCellSockDirectLinkEnter(), which uses "AT+USODL=x".  Only one
+ * data channel may be open at a time.
+ *
+ * uCellMuxEnable() must have been called.
+ *
+ * @param cellHandle           the handle of the cellular instance.
+ * @param[in] pCommand         the null-terminated AT command, including
+ *                             the "AT" but without a line ending, at
+ *                             most #U_CELL_MUX_DATA_COMMAND_MAX_LENGTH_BYTES
+ *                             long; cannot be NULL.
+ * @param[out] ppDeviceSerial  a place to put the serial device of
+ *                             the channel; cannot be NULL.
+ * @return                     zero on success or negative error code
+ *                             on failure.
+ */
+int32_t uCellMuxDataOpen(uDeviceHandle_t cellHandle,
+                         const char *pCommand,
+                         uDeviceSerial_t **ppDeviceSerial);
+
+/** Close the multiplexer channel that was opened with
+ * uCellMuxDataOpen(); this is exactly uCellMuxPppClose().
+ *
+ * @param cellHandle the handle of the cellular instance.
+ * @return           zero on success or negative error code on failure.
+ */
+int32_t uCellMuxDataClose(uDeviceHandle_t cellHandle);
+
+/** Close the multiplexer channel that was opened with
+ * uCellMuxPppOpen(); the PPP client of the IP stack should be
+ * told to disconnect (i.e. to send LCP terminate) _before_ this
+ * is called.  Closing the channel causes the module to drop the
+ * data connection.  As with uCellMuxRemoveChannel(), the memory of
+ * the serial device is not freed until the cellular instance is
+ * removed or uCellMuxFree() is called.
+ *
+ * @param cellHandle the handle of the cellular instance.
+ * @return           zero on success or negative error code on failure.
+ */
+int32_t uCellMuxPppClose(uDeviceHandle_t cellHandle);
+
 /** Remove a multiplexer channel.  Note that this does NOT free
  * memory to ensure thread safety; memory is free'd when the cellular
  * instance is closed (or see uCellMuxFree()).
@@ -72,6 +72,14 @@ extern "C" {
  */
 #define U_CELL_NET_MCC_MNC_LENGTH_BYTES 7
 
+#ifndef U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH
+/** The number of samples held by the data counter sampler, see
+ * uCellNetDataCounterSamplerStart(); once full the oldest sample
+ * is overwritten.
+ */
+# define U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH 16
+#endif
+
 #ifndef U_CELL_NET_MAX_NAME_LENGTH_BYTES
 /** The number of bytes required to store a network name,
  * including terminator.
@@ -148,6 +156,24 @@ extern "C" {
 # define U_CELL_NET_DEEP_SCAN_TIME_SECONDS 240
 #endif
 
+#ifndef U_CELL_NET_REGISTRATION_URC_CHECK_INTERVAL_MS
+/** When registration polling is off (see
+ * uCellNetSetRegistrationPolling()), how often the registration
+ * status, as updated by the +CxREG URCs, is checked while waiting
+ * to register; no AT traffic is involved in this check.
+ */
+# define U_CELL_NET_REGISTRATION_URC_CHECK_INTERVAL_MS 50
+#endif
+
+#ifndef U_CELL_NET_REGISTRATION_URC_FALLBACK_QUERY_MS
+/** When registration polling is off (see
+ * uCellNetSetRegistrationPolling()), the interval at which the
+ * registration status is nevertheless queried, in case a URC
+ * has been missed.
+ */
+# define U_CELL_NET_REGISTRATION_URC_FALLBACK_QUERY_MS 10000
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -265,6 +291,22 @@ typedef struct {
     int32_t rsrqDb;  /**< current reference signal received quality in dB. */
 } uCellNetCellInfo_t;
 
+/** A sample of the data counters, as recorded by the data counter
+ * sampler, see uCellNetDataCounterSamplerStart().
+ */
+typedef struct {
+    int32_t timeMs;       /**< the value of uPortGetTickTimeMs() when
+                               the sample was taken. */
+    int32_t txBytes;      /**< the transmit data counter, as would
+                               be returned by uCellNetGetDataCounterTx(). */
+    int32_t rxBytes;      /**< the receive data counter, as would
+                               be returned by uCellNetGetDataCounterRx(). */
+    bool atDeactivation;  /**< true if the sample was taken because the
+                               PDP context was about to be deactivated,
+                               i.e. this is the final count for the
+                               session, false for a periodic sample. */
+} uCellNetDataCounterSample_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -443,6 +485,64 @@ int32_t uCellNetDeactivate(uDeviceHandle_t cellHandle,
 int32_t uCellNetDisconnect(uDeviceHandle_t cellHandle,
                            bool (*pKeepGoingCallback) (uDeviceHandle_t));
 
+/** Activate an additional PDP context, alongside the one set up by
+ * uCellNetConnect() or uCellNetActivate(), for instance to reach a
+ * private APN while the default context remains in use for general
+ * Internet traffic.  The module must already be registered with the
+ * network.  Sockets may be bound to the additional context with
+ * uCellSockSetNextContextId().  Unlike the default context, an
+ * additional context is not reactivated automatically should the
+ * module fall out of service: the application should check it with
+ * uCellNetContextIsActive() and call this function again as necessary.
+ * NOTE: how many contexts may be active at any one time depends on
+ * the module and the network, both of which may refuse.
+ *
+ * @param cellHandle    the handle of the cellular instance.
+ * @param contextId     the PDP context ID, 1 to
+ *                      #U_CELL_NET_MAX_NUM_CONTEXTS but not
+ *                      #U_CELL_NET_CONTEXT_ID.
+ * @param[in] pApn      pointer to a string giving the APN to use;
+ *                      unlike uCellNetConnect() there is no look-up
+ *                      in the APN database, NULL is treated as "".
+ * @param[in] pUsername pointer to a string giving the user name for
+ *                      PPP authentication; may be NULL if no user
+ *                      name or password is required.
+ * @param[in] pPassword pointer to a string giving the password for
+ *                      PPP authentication; ignored if pUsername is
+ *                      NULL, must be non-NULL if pUsername is non-NULL.
+ * @return              zero on success or negative error code on
+ *                      failure.
+ */
+int32_t uCellNetActivateContext(uDeviceHandle_t cellHandle,
+                                int32_t contextId, const char *pApn,
+                                const char *pUsername,
+                                const char *pPassword);
+
+/** Deactivate a PDP context previously activated with
+ * uCellNetActivateContext(); the default context is left alone.
+ * Any sockets bound to the context should be closed first.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param contextId   the PDP context ID, 1 to
+ *                    #U_CELL_NET_MAX_NUM_CONTEXTS but not
+ *                    #U_CELL_NET_CONTEXT_ID.
+ * @return            zero on success (including if the context
+ *                    was not active) or negative error code on
+ *                    failure.
+ */
+int32_t uCellNetDeactivateContext(uDeviceHandle_t cellHandle,
+                                  int32_t contextId);
+
+/** Get whether a PDP context is active.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param contextId   the PDP context ID, 1 to
+ *                    #U_CELL_NET_MAX_NUM_CONTEXTS; may be
+ *                    #U_CELL_NET_CONTEXT_ID.
+ * @return            true if the context is active, else false.
+ */
+bool uCellNetContextIsActive(uDeviceHandle_t cellHandle, int32_t contextId);
+
 /** Initiate a network scan and return the first result after
  * it has completed; uCellNetScanGetNext() should be called
  * repeatedly to iterate through subsequent results from the
@@ -544,6 +644,54 @@ int32_t uCellNetScanGetNext(uDeviceHandle_t cellHandle,
  */
 void uCellNetScanGetLast(uDeviceHandle_t cellHandle);
 
+/** Perform a network scan, as uCellNetScanGetFirst() does, but
+ * report each network found through a callback rather than the
+ * caller iterating with uCellNetScanGetNext().  Note that the module
+ * only returns the results of AT+COPS=? once the entire scan is
+ * complete; the callback is called for each network in turn at that
+ * point, from the calling task.  This function is not thread-safe
+ * in the same way as uCellNetScanGetFirst().
+ *
+ * @param cellHandle             the handle of the cellular instance.
+ * @param[in] pCallback          the function to call for each network:
+ *                               it is passed the cellular handle, the
+ *                               network name, the MCC/MNC string, the
+ *                               RAT and pCallbackParameter; it should
+ *                               return true to continue or false to
+ *                               stop being called.  Cannot be NULL.
+ * @param[in] pCallbackParameter a parameter to pass to pCallback; may
+ *                               be NULL.
+ * @param[in] pKeepGoingCallback see uCellNetScanGetFirst().
+ * @return                       the number of networks found or negative
+ *                               error code, see uCellNetScanGetFirst().
+ */
+int32_t uCellNetScan(uDeviceHandle_t cellHandle,
+                     bool (*pCallback) (uDeviceHandle_t,
+                                        const char *,
+                                        const char *,
+                                        uCellNetRat_t,
+                                        void *),
+                     void *pCallbackParameter,
+                     bool (*pKeepGoingCallback) (uDeviceHandle_t));
+
+/** Set a maximum age for the results of a network scan: if
+ * uCellNetScanGetFirst() or uCellNetScan() is called within this
+ * time of the last network scan that succeeded, the results of
+ * that scan are returned again without AT+COPS=? being sent.  This
+ * is useful where a scan would otherwise be repeated only to read the
+ * same list again, since a scan can take minutes.  A copy of the
+ * results is kept in RAM for this purpose, and is freed when the
+ * maximum age is set to zero, which is the default.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param maxAgeMs    the maximum age in milliseconds; zero to always
+ *                    perform a new scan.
+ * @return            zero on success or negative error code on
+ *                    failure.
+ */
+int32_t uCellNetSetScanCacheMaxAge(uDeviceHandle_t cellHandle,
+                                   int32_t maxAgeMs);
+
 /** Do an extended network search, AT+COPS=5; only supported on SARA-R5.
  * The detected cells may be used with uCellTimeSyncCellEnable(),
  * supported on SARA-R5xx-01B and later modules.
@@ -593,6 +741,93 @@ int32_t uCellNetDeepScan(uDeviceHandle_t cellHandle,
                                             void *),
                          void *pCallbackParameter);
 
+/** Do an extended network search, as uCellNetDeepScan(), collecting
+ * the results into a table ranked best first, by RSRP and then by
+ * RSRQ; only supported on SARA-R5.  A cell that is reported more
+ * than once (e.g. because the module had to repeat the scan) appears
+ * only once, with its best values.  If more cells are found than
+ * will fit in the table the weakest are dropped.  The table may be
+ * passed to uCellNetConnectBest().
+ *
+ * @param cellHandle             the handle of the cellular instance.
+ * @param[out] pTable            a pointer to an array of numEntries
+ *                               entries in which to store the results;
+ *                               cannot be NULL.
+ * @param numEntries             the number of entries at pTable; must
+ *                               be greater than zero.
+ * @param[in] pKeepGoingCallback a callback that is called periodically
+ *                               during the scan; it should return true
+ *                               to continue the scan or false to
+ *                               abort it.  May be NULL.
+ * @return                       on success the number of entries
+ *                               written to pTable, else negative error
+ *                               code.
+ */
+int32_t uCellNetDeepScanRanked(uDeviceHandle_t cellHandle,
+                               uCellNetCellInfo_t *pTable,
+                               size_t numEntries,
+                               bool (*pKeepGoingCallback) (uDeviceHandle_t));
+
+/** Connect to the network using the ranked results of
+ * uCellNetDeepScanRanked(): uCellNetConnect() is called with the
+ * MCC/MNC of the best cell and, should that fail, with that of the
+ * next best cell on a different network, and so on.  Note that the
+ * deep scan results do not say whether an MNC was two or three digits
+ * long: an MNC value less than 100 is assumed to be two digits.
+ *
+ * @param cellHandle             the handle of the cellular instance.
+ * @param[in] pTable             the ranked table, as populated by
+ *                               uCellNetDeepScanRanked(); cannot be NULL.
+ * @param numEntries             the number of valid entries at pTable,
+ *                               i.e. the return value of
+ *                               uCellNetDeepScanRanked(); must be
+ *                               greater than zero.
+ * @param[in] pApn               as for uCellNetConnect().
+ * @param[in] pUsername          as for uCellNetConnect().
+ * @param[in] pPassword          as for uCellNetConnect().
+ * @param[in] pKeepGoingCallback as for uCellNetConnect(); also checked
+ *                               before each network is tried.
+ * @return                       on success the index of the entry in
+ *                               pTable whose network was connected to,
+ *                               else negative error code.
+ */
+int32_t uCellNetConnectBest(uDeviceHandle_t cellHandle,
+                            const uCellNetCellInfo_t *pTable,
+                            size_t numEntries,
+                            const char *pApn, const char *pUsername,
+                            const char *pPassword,
+                            bool (*pKeepGoingCallback) (uDeviceHandle_t));
+
+/** Set whether the registration status is polled while waiting
+ * to register in uCellNetConnect() or uCellNetRegister().  By
+ * default the AT+CxREG? queries are sent continuously, one every
+ * few hundred milliseconds, while the module registers.  With
+ * polling off the wait is driven by the +CxREG URCs alone, which
+ * are always switched on: the registration status they report is
+ * checked every #U_CELL_NET_REGISTRATION_URC_CHECK_INTERVAL_MS
+ * with no AT traffic, so that the following attach check and context
+ * activation begin as soon as the module reports registration.  A
+ * query is still made every
+ * #U_CELL_NET_REGISTRATION_URC_FALLBACK_QUERY_MS in case a URC has
+ * been missed.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param onNotOff    true to poll (the default), false to rely
+ *                    on URCs.
+ * @return            zero on success or negative error code on
+ *                    failure.
+ */
+int32_t uCellNetSetRegistrationPolling(uDeviceHandle_t cellHandle,
+                                       bool onNotOff);
+
+/** Get whether the registration status is polled while waiting
+ * to register, see uCellNetSetRegistrationPolling().
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            true if polling is on, else false.
+ */
+bool uCellNetGetRegistrationPolling(uDeviceHandle_t cellHandle);
+
 /** Enable or disable the registration status call-back. This
  * call-back allows the application to know the various
  * states of the network scanning, registration and rejections
@@ -755,6 +990,24 @@ int32_t uCellNetGetMccMnc(uDeviceHandle_t cellHandle,
  */
 int32_t uCellNetGetIpAddressStr(uDeviceHandle_t cellHandle, char *pStr);
 
+/** As uCellNetGetIpAddressStr() but for a given PDP context, e.g.
+ * one activated with uCellNetActivateContext().
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param contextId   the PDP context ID, 1 to
+ *                    #U_CELL_NET_MAX_NUM_CONTEXTS; may be
+ *                    #U_CELL_NET_CONTEXT_ID.
+ * @param[out] pStr   should point to storage of length at least
+ *                    #U_CELL_NET_IP_ADDRESS_SIZE bytes in size;
+ *                    may be NULL.
+ * @return            on success, the number of characters that would
+ *                    be copied into into pStr if it is not NULL,
+ *                    NOT including the terminator (as strlen()
+ *                    would return), on failure negative error code.
+ */
+int32_t uCellNetGetContextIpAddressStr(uDeviceHandle_t cellHandle,
+                                       int32_t contextId, char *pStr);
+
 /** Return the IP addresses of the first and second DNS assigned
  * by the network.  Without a DNS the module is unable to
  * use hostnames in these API functions, only IP addresses.
@@ -844,6 +1097,55 @@ int32_t uCellNetGetDataCounterRx(uDeviceHandle_t cellHandle);
  */
 int32_t uCellNetResetDataCounters(uDeviceHandle_t cellHandle);
 
+/** Start the data counter sampler, which records the transmit and
+ * receive data counters, at the given interval and just before the
+ * PDP context is deactivated by uCellNetDeactivate() or
+ * uCellNetDisconnect(), into a history of
+ * #U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH samples that may be read
+ * with uCellNetDataCounterSamplerRead(); this way an application
+ * that, for instance, bills by the byte need not interleave its own
+ * AT queries with its data traffic.  The periodic samples are taken
+ * from the AT client's callback task, are not taken while the module
+ * is not registered or is in deep sleep (since nothing can be
+ * counted then and waking the module just to ask would be wasteful)
+ * and are skipped if the module does not respond.  If the sampler is
+ * already running the interval is changed and the history is kept.
+ * Only supported on modules where uCellNetGetDataCounterTx() is
+ * supported.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param intervalMs  the interval between periodic samples in
+ *                    milliseconds; use zero to sample only at
+ *                    deactivation.
+ * @return            zero on success else negative error code.
+ */
+int32_t uCellNetDataCounterSamplerStart(uDeviceHandle_t cellHandle,
+                                        int32_t intervalMs);
+
+/** Stop the data counter sampler and free its history.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ */
+void uCellNetDataCounterSamplerStop(uDeviceHandle_t cellHandle);
+
+/** Read samples from the history of the data counter sampler, oldest
+ * first; the samples that are read are removed from the history so
+ * that no sample is read twice.
+ *
+ * @param cellHandle     the handle of the cellular instance.
+ * @param[out] pSamples  a place to put the samples; may be NULL,
+ *                       in which case the number of samples in the
+ *                       history is returned and none are removed.
+ * @param numSamples     the number of samples there is room for
+ *                       at pSamples.
+ * @return               the number of samples read or, if pSamples
+ *                       is NULL, the number that could be read, else
+ *                       negative error code.
+ */
+int32_t uCellNetDataCounterSamplerRead(uDeviceHandle_t cellHandle,
+                                       uCellNetDataCounterSample_t *pSamples,
+                                       size_t numSamples);
+
 #ifdef __cplusplus
 }
 #endif
@@ -171,6 +171,16 @@ extern "C" {
 # define U_CELL_PWR_UART_POWER_SAVING_DTR_READY_MS 20
 #endif
 
+#ifndef U_CELL_PWR_UART_POWER_SAVING_DTR_READY_CTS_MS
+/** As #U_CELL_PWR_UART_POWER_SAVING_DTR_READY_MS but used when CTS
+ * flow control is enabled on the UART: the module only asserts CTS
+ * once it is ready to receive UART data, so the UART will hold off
+ * sending until then and there is no need to wait the full time;
+ * value in milliseconds.
+ */
+# define U_CELL_PWR_UART_POWER_SAVING_DTR_READY_CTS_MS 0
+#endif
+
 #ifndef U_CELL_PWR_UART_POWER_SAVING_DTR_HYSTERESIS_MS
 /** When DTR power saving is in use (see uCellPwrSetDtrPowerSavingPin()),
  * this is the minimum time that should pass betweeen toggling of the pin;
@@ -179,6 +189,13 @@ extern "C" {
 # define U_CELL_PWR_UART_POWER_SAVING_DTR_HYSTERESIS_MS 20
 #endif
 
+#ifndef U_CELL_PWR_DEFER_MAX_NUM
+/** The maximum number of operations that may be waiting, having
+ * been deferred with uCellPwrDefer(), on any one cellular instance.
+ */
+# define U_CELL_PWR_DEFER_MAX_NUM 16
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -285,6 +302,15 @@ bool uCellPwrIsAlive(uDeviceHandle_t cellHandle);
  * to the module, then this function will check that the module
  * is responsive and then configure it for correct operation
  * with this driver.
+ * If a greeting message has been set with uCellCfgSetGreeting()
+ * or uCellCfgSetGreetingCallback() and the module will emit it as
+ * soon as it boots (i.e. it is not auto-bauding and DTR is not
+ * being used for power saving) then, once the module has been
+ * switched on, this function waits for the greeting to arrive
+ * before talking to the module, rather than polling it with "AT"
+ * while it boots, falling back to polling if the greeting does
+ * not turn up; uCellPwrReboot() and uCellPwrResetHard() do the
+ * same rather than waiting a fixed time.
  *
  * @param cellHandle             the handle of the cellular instance.
  * @param[in] pSimPinCode        pointer to a string giving the PIN of
@@ -403,6 +429,82 @@ int32_t uCellPwrOffHard(uDeviceHandle_t cellHandle, bool trulyHard,
  */
 bool uCellPwrRebootIsRequired(uDeviceHandle_t cellHandle);
 
+/** Get the fingerprint of the configuration that this code last
+ * applied to the settings of the cellular module which the module
+ * keeps in non-volatile memory; this may be stored by the
+ * application, e.g. in its own non-volatile memory, and passed to
+ * uCellPwrSetConfigFingerprint() after a restart of the MCU.
+ *
+ * @param cellHandle         the handle of the cellular instance.
+ * @param[out] pFingerprint  a place to put the fingerprint; cannot
+ *                           be NULL.
+ * @return                   zero on success, #U_ERROR_COMMON_NOT_FOUND
+ *                           if no configuration is known, e.g. because
+ *                           the module has not been powered on or a
+ *                           setting has since been changed, else
+ *                           negative error code.
+ */
+int32_t uCellPwrGetConfigFingerprint(uDeviceHandle_t cellHandle,
+                                     uint32_t *pFingerprint);
+
+/** Switch on "fast boot", supplying a known-good configuration
+ * fingerprint as returned by uCellPwrGetConfigFingerprint().
+ * Each time the module is powered on, rebooted or returns from
+ * deep sleep, the settings which it forgets (echo, error reporting,
+ * flow control, UART power saving, URCs) are always sent, and the
+ * MNO profile, the sockets hex mode (AT+UDCONF=1) and the GNSS
+ * profile (AT+UGPRF) are read back as verification queries.  When
+ * fast boot is on and the result matches the fingerprint, the
+ * settings that the module keeps in non-volatile memory are not
+ * re-sent.
+ * If the fingerprint does not match, the full configuration is
+ * sent and the fingerprint is updated, so that the next boot can
+ * be fast.  Changing a non-volatile setting through this API, e.g.
+ * with uCellCfgSetUdconf() or uCellCfgSetGnssProfile(), clears the
+ * fingerprint.  Fast boot is off by default.
+ *
+ * @param cellHandle   the handle of the cellular instance.
+ * @param fingerprint  the known-good fingerprint; use zero to switch
+ *                     fast boot off.  If the fingerprint is not
+ *                     known in advance, any non-zero value
+ *                     switches fast boot on, from the boot after
+ *                     next.
+ * @return             zero on success or negative error code on
+ *                     failure.
+ */
+int32_t uCellPwrSetConfigFingerprint(uDeviceHandle_t cellHandle,
+                                     uint32_t fingerprint);
+
+/** Switch "warm attach" on or off.  This is intended for the case
+ * where this MCU has restarted while the cellular module has stayed
+ * powered, registered and perhaps with sockets open.  If warm attach
+ * is on and uCellPwrOn() finds the module already on, the packet
+ * switched registration status is read back from the module (with
+ * AT+CEREG? or AT+CGREG?) and, if the module is registered, whether
+ * it has an active PDP context (AT+CGACT?); the radio is then NOT
+ * switched off at the end of power-on, so that a subsequent call to
+ * uCellNetConnect() returns almost immediately without disturbing
+ * the network connection.  Combine this with
+ * uCellPwrSetConfigFingerprint() to also avoid re-sending the
+ * configuration that the module keeps in non-volatile memory, and
+ * use uCellSockWarmAttach() to pick up any sockets the module has
+ * open.  Warm attach is off by default.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param onNotOff    true to switch warm attach on, false to switch
+ *                    it off.
+ * @return            zero on success or negative error code on
+ *                    failure.
+ */
+int32_t uCellPwrSetWarmAttach(uDeviceHandle_t cellHandle, bool onNotOff);
+
+/** Get whether warm attach is on or off, see uCellPwrSetWarmAttach().
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            true if warm attach is on, else false.
+ */
+bool uCellPwrGetWarmAttach(uDeviceHandle_t cellHandle);
+
 /** Re-boot the cellular module.  The module will be reset after
  * a proper detach from the network and any NV parameters will
  * be saved.  If this function returns successfully then the
@@ -982,6 +1084,90 @@ int32_t uCellPwrGetDeepSleepActive(uDeviceHandle_t cellHandle,
 int32_t uCellPwrWakeUpFromDeepSleep(uDeviceHandle_t cellHandle,
                                     bool (*pKeepGoingCallback) (uDeviceHandle_t));
 
+/** Defer a non-urgent operation, e.g. reading the signal strength,
+ * publishing a queued MQTT message or sending on a socket, so that
+ * it is run together with the other operations that have been
+ * deferred, in a single window during which the module is awake,
+ * rather than waking the module from deep sleep for each one; where
+ * the module spends most of its time in 3GPP power saving, waking it
+ * up is usually the largest cost in energy.
+ *
+ * The deferred operations are run, earliest deadline first, when
+ * any of the following happens:
+ *
+ * - the module is woken from deep sleep, e.g. because some other
+ *   operation was not deferred,
+ * - the module indicates that its protocol stack has woken up of its
+ *   own accord (e.g. for a periodic tracking area update),
+ * - the deadline of any of the deferred operations is reached: since
+ *   the module must then be woken up anyway, all of the operations
+ *   that are waiting are run with it,
+ * - uCellPwrDeferFlush() is called.
+ *
+ * If 3GPP power saving has not been agreed with the network (as
+ * far as uCellPwrGet3gppPowerSaving() or a registration indication
+ * has told us), or the VInt pin of the module is connected to this
+ * MCU and shows that the module is awake right now, there is nothing
+ * to be gained by waiting and so the operation is run straight away.
+ * Note that E-DRX on its own does not put the module into deep sleep
+ * and hence does not cause operations to be deferred.
+ *
+ * Operations are run from the uAtClientCallback() task, which has
+ * a stack of #U_AT_CLIENT_CALLBACK_TASK_STACK_SIZE_BYTES; they may
+ * call any cellular API but, as for any AT client callback, should
+ * not take forever.  Operations that are still waiting when the
+ * cellular instance is removed are discarded without being run.
+ *
+ * @param cellHandle      the handle of the cellular instance.
+ * @param[in] pOperation  the operation, which will be called with
+ *                        cellHandle as its first parameter and
+ *                        pParameter as its second; cannot be NULL.
+ * @param[in] pParameter  a parameter to pass to pOperation; may be
+ *                        NULL.  This must remain valid until
+ *                        pOperation has been called or the operation
+ *                        has been cancelled with uCellPwrDeferCancel().
+ * @param deadlineMs      the longest the operation may be left
+ *                        waiting, in milliseconds; zero to run it
+ *                        straight away, taking all of the other
+ *                        operations that are waiting with it.
+ * @return                zero on success else negative error code;
+ *                        #U_ERROR_COMMON_NO_MEMORY if
+ *                        #U_CELL_PWR_DEFER_MAX_NUM operations are
+ *                        already waiting.
+ */
+int32_t uCellPwrDefer(uDeviceHandle_t cellHandle,
+                      void (*pOperation) (uDeviceHandle_t cellHandle,
+                                          void *pParameter),
+                      void *pParameter, int32_t deadlineMs);
+
+/** Run all of the operations deferred with uCellPwrDefer() now,
+ * e.g. because the application knows that the module is about to
+ * be woken up anyway.  The operations are run from the
+ * uAtClientCallback() task, i.e. this function does not wait for
+ * them to complete.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            on success the number of operations that will
+ *                    be run, else negative error code.
+ */
+int32_t uCellPwrDeferFlush(uDeviceHandle_t cellHandle);
+
+/** Cancel operations deferred with uCellPwrDefer() that have not
+ * yet been run.
+ *
+ * @param cellHandle      the handle of the cellular instance.
+ * @param[in] pOperation  the operation to cancel; NULL to cancel
+ *                        all of the operations that are waiting.
+ * @param[in] pParameter  if pOperation is not NULL, only operations
+ *                        with this parameter are cancelled.
+ * @return                on success the number of operations that
+ *                        were cancelled, else negative error code.
+ */
+int32_t uCellPwrDeferCancel(uDeviceHandle_t cellHandle,
+                            void (*pOperation) (uDeviceHandle_t cellHandle,
+                                                void *pParameter),
+                            void *pParameter);
+
 /** Disable UART, AKA 32 kHz, sleep. 32 kHz sleep is always
  * enabled where supported by the module; call this function
  * to disable 32 kHz sleep.
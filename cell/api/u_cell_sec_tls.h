@@ -484,6 +484,33 @@ int32_t uCellSecTlsSniSet(const uCellSecTlsContext_t *pContext,
 int32_t uCellSecTlsSniGet(const uCellSecTlsContext_t *pContext,
                           char *pSni, size_t size);
 
+/** Set whether TLS session resumption is used.  With session
+ * resumption on, the module keeps the session ID/ticket that a
+ * server gives it and offers it back when the same security
+ * profile is next used to connect to that server, so that an
+ * abbreviated handshake can take place, saving several kilobytes
+ * of data and the time of the full handshake; whether the session
+ * is actually resumed is down to the server.  The session is
+ * stored by the module, not by this code, and hence only persists
+ * for as long as the module does.
+ * Only SARA-R5 and LARA-R6 modules support this feature.
+ *
+ * @param[in] pContext  a pointer to the security context.
+ * @param onNotOff      true to use session resumption, else false.
+ * @return              zero on success else negative error code.
+ */
+int32_t uCellSecTlsSessionResumptionSet(const uCellSecTlsContext_t *pContext,
+                                        bool onNotOff);
+
+/** Get whether TLS session resumption is used.
+ * Only SARA-R5 and LARA-R6 modules support this feature.
+ *
+ * @param[in] pContext  a pointer to the security context.
+ * @return              1 if session resumption is on, 0 if it is
+ *                      off, else negative error code.
+ */
+int32_t uCellSecTlsSessionResumptionGet(const uCellSecTlsContext_t *pContext);
+
 #ifdef __cplusplus
 }
 #endif
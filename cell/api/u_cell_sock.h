@@ -64,6 +64,58 @@ extern "C" {
 # define U_CELL_SOCK_TCP_RETRY_LIMIT 3
 #endif
 
+#ifndef U_CELL_SOCK_TCP_TX_WINDOW_BYTES
+/** The amount of TCP data that uCellSockWrite() will leave queued,
+ * unacknowledged, in the cellular module: chunks are written without
+ * waiting for the far end to acknowledge them for as long as the
+ * total remains below this, after which the amount outstanding is
+ * checked with AT+USOCTL and writing continues when there is room.
+ * This avoids a full module buffer causing short writes that use
+ * up #U_CELL_SOCK_TCP_RETRY_LIMIT.  Set to zero to switch the
+ * check off.
+ */
+# define U_CELL_SOCK_TCP_TX_WINDOW_BYTES (1024 * 8)
+#endif
+
+#ifndef U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS
+/** The silence required either side of the escape sequence that
+ * ends direct link mode, see uCellSockDirectLinkExit(); the module
+ * default (ATS12) is one second.
+ */
+# define U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS 1100
+#endif
+
+#ifndef U_CELL_SOCK_DIRECT_LINK_EXIT_TIMEOUT_MS
+/** How long to wait for DISCONNECT after the escape sequence that
+ * ends direct link mode.
+ */
+# define U_CELL_SOCK_DIRECT_LINK_EXIT_TIMEOUT_MS 5000
+#endif
+
+#ifndef U_CELL_SOCK_TCP_TX_WINDOW_TIMEOUT_MS
+/** How long uCellSockWrite() will wait for room in the window set by
+ * #U_CELL_SOCK_TCP_TX_WINDOW_BYTES before returning with what has
+ * been sent so far.
+ */
+# define U_CELL_SOCK_TCP_TX_WINDOW_TIMEOUT_MS 10000
+#endif
+
+#ifndef U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES
+/** If this is non-zero then data arriving on TCP sockets which
+ * have a data callback (which all sockets created through the
+ * common/sock API do) is read from the module ahead of time:
+ * the +UUSORD URCs that arrive together are handled by a single
+ * callback which, with the AT client locked only once, reads up
+ * to this many bytes for each such socket into a buffer of its
+ * own, allocated when first needed, and only then calls the data
+ * callbacks; uCellSockRead() takes data from that buffer before
+ * asking the module for more.  #U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES,
+ * the most the module will return in one read, is a sensible
+ * value; the default of zero saves the memory.
+ */
+# define U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES 0
+#endif
+
 /** The maximum number of sockets that can be open at one time.
  */
 #define U_CELL_SOCK_MAX_NUM_SOCKETS 7
@@ -199,6 +251,32 @@ int32_t uCellSockClose(uDeviceHandle_t cellHandle,
  */
 void uCellSockCleanup(uDeviceHandle_t cellHandle);
 
+/** Pick up the sockets that the cellular module already has open,
+ * for instance after this MCU has been restarted while the module
+ * stayed powered, see uCellPwrSetWarmAttach().  Each socket ID
+ * that the module might use is queried with AT+USOCTL and, for any
+ * that turn out to be open (and which this code does not already
+ * know about), a socket is created here so that it may be used
+ * as if it had been created with uCellSockCreate() and connected,
+ * if it is TCP, with uCellSockConnect().  The data and closed
+ * callbacks of the sockets are not set: call
+ * uCellSockRegisterCallbackData() and
+ * uCellSockRegisterCallbackClosed() as required.
+ *
+ * @param cellHandle         the handle of the cellular instance.
+ * @param[out] pSockHandles  a place to put the handles of the
+ *                           sockets that were picked up; may be
+ *                           NULL.
+ * @param numSockHandles     the number of entries at pSockHandles.
+ * @return                   the number of sockets picked up, which
+ *                           may be more than numSockHandles, else
+ *                           negated value of U_SOCK_Exxx from
+ *                           u_sock_errno.h.
+ */
+int32_t uCellSockWarmAttach(uDeviceHandle_t cellHandle,
+                            int32_t *pSockHandles,
+                            size_t numSockHandles);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: CONFIGURE
  * -------------------------------------------------------------- */
@@ -357,6 +435,36 @@ bool uCellSockHexModeIsOn(uDeviceHandle_t cellHandle);
 int32_t uCellSockSetNextLocalPort(uDeviceHandle_t cellHandle,
                                   int32_t port);
 
+/** Set the PDP context that the socket created by the next
+ * uCellSockCreate() will be bound to, e.g. one activated with
+ * uCellNetActivateContext(); otherwise sockets use the default
+ * context, #U_CELL_NET_CONTEXT_ID.  As with
+ * uCellSockSetNextLocalPort() this applies to the next
+ * uCellSockCreate() only and is not thread-safe.  Specify -1 to
+ * cancel a previous selection.
+ * NOTE: only SARA-R5 supports binding a socket to a PDP context.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param contextId   the PDP context ID, 1 to
+ *                    #U_CELL_NET_MAX_NUM_CONTEXTS, or -1 to cancel
+ *                    a previous uCellSockSetNextContextId()
+ *                    selection.
+ * @return            zero on success else negated value
+ *                    of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockSetNextContextId(uDeviceHandle_t cellHandle,
+                                  int32_t contextId);
+
+/** Get the PDP context that a socket is bound to.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param sockHandle  the handle of the socket.
+ * @return            the PDP context ID, else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockGetContextId(uDeviceHandle_t cellHandle,
+                              int32_t sockHandle);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: UDP ONLY
  * -------------------------------------------------------------- */
@@ -435,6 +543,26 @@ int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
                        int32_t sockHandle,
                        const void *pData, size_t dataSizeBytes);
 
+/** Send bytes gathered from several buffers over a connected
+ * socket; the buffers are packed into segments of
+ * #U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES (or half that in hex mode)
+ * exactly as if they had been concatenated and passed to
+ * uCellSockWrite().
+ *
+ * @param cellHandle     the handle of the cellular instance.
+ * @param sockHandle     the handle of the socket.
+ * @param[in] pIoVec     an array of count buffers to send; an
+ *                       element may only have a NULL pData if its
+ *                       dataSizeBytes is zero.
+ * @param count          the number of elements at pIoVec.
+ * @return               the number of bytes sent on
+ *                       success else negated value
+ *                       of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockWritev(uDeviceHandle_t cellHandle,
+                        int32_t sockHandle,
+                        const uSockIoVec_t *pIoVec, size_t count);
+
 /** Receive bytes on a connected socket.
  *
  * @param cellHandle     the handle of the cellular instance.
@@ -450,6 +578,65 @@ int32_t uCellSockRead(uDeviceHandle_t cellHandle,
                       int32_t sockHandle,
                       void *pData, size_t dataSizeBytes);
 
+/* ----------------------------------------------------------------
+ * FUNCTIONS: DIRECT LINK
+ * -------------------------------------------------------------- */
+
+/** Put a connected socket into direct link mode (AT+USODL): the
+ * socket is carried over a multiplexer channel of its own, returned
+ * as a serial device, for which the module does no AT framing at
+ * all, so everything written to the serial device is sent on the
+ * socket and everything received on the socket may be read from the
+ * serial device; this is the quickest way to move a large amount of
+ * data, e.g. a file upload or a firmware image, since there is no AT
+ * command per chunk.  The AT interface carries on working on its own
+ * multiplexer channel in the meantime.
+ *
+ * uCellMuxEnable() must have been called: the channel used is the one
+ * that would otherwise be used for PPP, see uCellMuxDataOpen(), and
+ * so direct link mode may not be used at the same time as PPP, and
+ * only one socket may be in direct link mode at a time.  While a
+ * socket is in direct link mode uCellSockWrite(), uCellSockRead(),
+ * uCellSockSendTo() and uCellSockReceiveFrom() return
+ * -#U_SOCK_EBUSY for it.
+ *
+ * Should the far end close the socket, the module leaves direct
+ * link mode of its own accord and "DISCONNECT" will appear at the
+ * end of the received data; uCellSockDirectLinkExit() should still
+ * be called.
+ *
+ * @param cellHandle           the handle of the cellular instance.
+ * @param sockHandle           the handle of the socket.
+ * @param[out] ppDeviceSerial  a place to put the serial device that
+ *                             carries the socket; cannot be NULL.
+ * @return                     zero on success else negated value of
+ *                             U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockDirectLinkEnter(uDeviceHandle_t cellHandle,
+                                 int32_t sockHandle,
+                                 uDeviceSerial_t **ppDeviceSerial);
+
+/** Take a socket out of direct link mode: the escape sequence,
+ * "+++", is sent with #U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS of
+ * silence either side, anything still being received on the
+ * serial device is discarded until the module responds with
+ * DISCONNECT and then the multiplexer channel is closed; the
+ * socket itself remains open.  Any data written to the serial
+ * device should have been sent (i.e. it should be known that
+ * the module's transmit buffer has drained, e.g. by the far end
+ * having responded) before this is called.  uCellSockClose()
+ * does this automatically.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param sockHandle  the handle of the socket.
+ * @return            zero on success else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h; the
+ *                    socket is out of direct link mode whatever
+ *                    the return value.
+ */
+int32_t uCellSockDirectLinkExit(uDeviceHandle_t cellHandle,
+                                int32_t sockHandle);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: ASYNC
  * -------------------------------------------------------------- */
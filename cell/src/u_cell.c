@@ -130,18 +130,26 @@ static void removeCellInstance(uCellPrivateInstance_t *pInstance)
             uAtClientSetWakeUpHandler(pInstance->atHandle, NULL, NULL, 0);
             // Free any scan results
             uCellPrivateScanFree(&(pInstance->pScanResults));
+            uCellPrivateScanFree(&(pInstance->pScanCache));
             // Free any location context and associated URC
             uCellPrivateLocRemoveContext(pInstance);
             // Free any sleep context
             uCellPrivateSleepRemoveContext(pInstance);
             // Free any FOTA context
             uPortFree(pInstance->pFotaContext);
+            // Free any identity cache
+            uPortFree(pInstance->pIdCache);
+            // Free any file system directory cache
+            uCellPrivateFileCacheClear(pInstance);
+            // Stop any data counter sampler
+            uCellPrivateDataCounterSamplerRemoveContext(pInstance);
             // Free any HTTP context
             uCellPrivateHttpRemoveContext(pInstance);
             // Free any CMUX context
             uCellMuxPrivateRemoveContext(pInstance);
             // Free any CellTime context
             uCellPrivateCellTimeRemoveContext(pInstance);
+            U_DEVICE_INSTANCE(pInstance->cellHandle)->pPrivateInstance = NULL;
             uDeviceDestroyInstance(U_DEVICE_INSTANCE(pInstance->cellHandle));
             uPortFree(pInstance);
             pCurrent = NULL;
@@ -262,6 +270,9 @@ int32_t uCellAdd(uCellModuleType_t moduleType,
             // Check parameters
             handleOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
             if (((size_t) moduleType < gUCellPrivateModuleListSize) &&
+#ifdef U_CFG_CELL_MODULE_ONLY
+                (moduleType == U_CELL_PRIVATE_MODULE_TYPE_ONLY) &&
+#endif
                 (atHandle != NULL) &&
                 (pGetCellInstanceAtHandle(atHandle) == NULL)) {
                 handleOrErrorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
@@ -295,6 +306,7 @@ int32_t uCellAdd(uCellModuleType_t moduleType,
                     uCellPrivateClearRadioParameters(&(pInstance->radioParameters), false);
                     pInstance->pModule = &(gUCellPrivateModuleList[moduleType]);
                     pInstance->sockNextLocalPort = -1;
+                    pInstance->sockNextContextId = -1;
                     pInstance->deepSleepBlockedBy = -1;
                     pInstance->gnssAidMode = U_CELL_LOC_GNSS_AIDING_TYPES;
                     pInstance->gnssSystemTypesBitMap = U_CELL_LOC_GNSS_SYSTEM_TYPES;
@@ -410,7 +422,9 @@ int32_t uCellAdd(uCellModuleType_t moduleType,
                                                   U_CELL_POWER_SAVING_UART_WAKEUP_MARGIN_MILLISECONDS);
 #endif
                         // ...and finally add it to the list
+                        // and to the device instance, for lookup
                         addCellInstance(pInstance);
+                        pDevInstance->pPrivateInstance = (void *) pInstance;
                         handleOrErrorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                         *pCellHandle = pInstance->cellHandle;
                     } else {
@@ -78,6 +78,7 @@ static const char *const pApnDefault = _APN("internet",,);
  * No need to add default, "internet" will be used as a default if
  * no entry matches.
  * The APN without username/password have to be listed first.
+ * The table is sorted by MCC and is const so that it stays in flash.
  */
 static const uCellNetApn_t gApnLookUpTable[] = {
 // MCC Country
@@ -85,22 +86,15 @@ static const uCellNetApn_t gApnLookUpTable[] = {
 // MCC must be 3 digits
 // MNC must be either 2 or 3 digits
 // MCC must be separated by '-' from MNC, multiple MNC can be separated by ','
+// Entries MUST be in ascending order of MCC: pApnGetConfig() does a
+// binary search on it
 
-// 232 Austria - AUT
-    { /* T-Mobile */ "232-03",  _APN("m2m.business",,) },
-
-// 460 China - CN
-    { /* CN Mobile */"460-00",  _APN("cmnet",,)
-        _APN("cmwap",,)
-    },
-    { /* Unicom */   "460-01",  _APN("3gnet",,)
-        _APN("uninet", "uninet", "uninet")
-    },
+// 204 Netherlands - NL
+    { /* Vodafone */ "204-04",  _APN("public4.m2minternet.com",,) },
 
-// 262 Germany - DE
-    { /* T-Mobile */ "262-01",  _APN("internet.t-mobile", "t-mobile", "tm") },
-    { /* T-Mobile */ "262-02,06",
-        _APN("m2m.business",,)
+// 214 Spain
+    { /* Telefonica */       "214-07",
+        _APN("m2mtrial.telefonica.com",,) /* Cat-M1 */
     },
 
 // 222 Italy - IT
@@ -108,42 +102,15 @@ static const uCellNetApn_t gApnLookUpTable[] = {
     { /* Vodafone */ "222-10",  _APN("web.omnitel.it",,) },
     { /* Wind */     "222-88",  _APN("internet.wind.biz",,) },
 
-// 440 Japan - JP
-//lint -e{786} Suppress concatenation within initialiser
-    { /* Softbank */ "440-04,06,20,40,41,42,43,44,45,46,47,48,90,91,92,93,94,95"
-        ",96,97,98",
-        _APN("open.softbank.ne.jp", "opensoftbank", "ebMNuX1FIHg9d3DA")
-        _APN("smile.world", "dna1trop", "so2t3k3m2a")
-    },
-//lint -e{786} Suppress concatenation within initialiser
-    { /* NTTDoCoMo */ "440-09,10,11,12,13,14,15,16,17,18,19,21,22,23,24,25,26,27,"
-        "28,29,30,31,32,33,34,35,36,37,38,39,58,59,60,61,62,63,"
-        "64,65,66,67,68,69,87,99",
-        _APN("bmobilewap",,) /*BMobile*/
-        _APN("mpr2.bizho.net", "Mopera U",) /* DoCoMo */
-        _APN("bmobile.ne.jp", "bmobile@wifi2", "bmobile") /*BMobile*/
-    },
-
-// 204 Netherlands - NL
-    { /* Vodafone */ "204-04",  _APN("public4.m2minternet.com",,) },
-
-// 293 Slovenia - SI
-    { /* Si.mobil */ "293-40",  _APN("internet.simobil.si",,) },
-    { /* Tusmobil */ "293-70",  _APN("internet.tusmobil.si",,) },
-
-// 240 Sweden SE
-    { /* Telia */    "240-01",  _APN("online.telia.se",,) },
-    { /* Telenor */  "240-06,08",
-        _APN("services.telenor.se",,)
-    },
-    { /* Tele2 */    "240-07",  _APN("mobileinternet.tele2.se",,) },
-
 // 228 Switzerland - CH
     { /* Swisscom */ "228-01",  _APN("gprs.swisscom.ch",,) },
     { /* Orange */   "228-03",  _APN("internet",,) /* contract */
         _APN("click",,)    /* pre-pay */
     },
 
+// 232 Austria - AUT
+    { /* T-Mobile */ "232-03",  _APN("m2m.business",,) },
+
 // 234 United Kingdom - GB
     { /* Telefonica */       "234-02,10,11",
         _APN("mobile.o2.co.uk", "faster", "web") /* contract */
@@ -156,6 +123,23 @@ static const uCellNetApn_t gApnLookUpTable[] = {
     { /* Three */    "234-20",  _APN("three.co.uk",,) },
     { /* Jersey */   "234-50",  _APN("jtm2m",,) /* as used on u-blox C030 U201 boards */ },
 
+// 240 Sweden SE
+    { /* Telia */    "240-01",  _APN("online.telia.se",,) },
+    { /* Telenor */  "240-06,08",
+        _APN("services.telenor.se",,)
+    },
+    { /* Tele2 */    "240-07",  _APN("mobileinternet.tele2.se",,) },
+
+// 262 Germany - DE
+    { /* T-Mobile */ "262-01",  _APN("internet.t-mobile", "t-mobile", "tm") },
+    { /* T-Mobile */ "262-02,06",
+        _APN("m2m.business",,)
+    },
+
+// 293 Slovenia - SI
+    { /* Si.mobil */ "293-40",  _APN("internet.simobil.si",,) },
+    { /* Tusmobil */ "293-70",  _APN("internet.tusmobil.si",,) },
+
 // 310 United States of America - US
     { /* T-Mobile */ "310-026,260,490",
         _APN("epc.tmobile.com",,)
@@ -167,13 +151,32 @@ static const uCellNetApn_t gApnLookUpTable[] = {
         _APN("isp.cingular", "ISP@CINGULARGPRS.COM", "CINGULAR1")
     },
 
-// 901 International - INT
-    { /* Transatel */ "901-37", _APN("netgprs.com", "tsl", "tsl") },
+// 440 Japan - JP
+//lint -e{786} Suppress concatenation within initialiser
+    { /* Softbank */ "440-04,06,20,40,41,42,43,44,45,46,47,48,90,91,92,93,94,95"
+        ",96,97,98",
+        _APN("open.softbank.ne.jp", "opensoftbank", "ebMNuX1FIHg9d3DA")
+        _APN("smile.world", "dna1trop", "so2t3k3m2a")
+    },
+//lint -e{786} Suppress concatenation within initialiser
+    { /* NTTDoCoMo */ "440-09,10,11,12,13,14,15,16,17,18,19,21,22,23,24,25,26,27,"
+        "28,29,30,31,32,33,34,35,36,37,38,39,58,59,60,61,62,63,"
+        "64,65,66,67,68,69,87,99",
+        _APN("bmobilewap",,) /*BMobile*/
+        _APN("mpr2.bizho.net", "Mopera U",) /* DoCoMo */
+        _APN("bmobile.ne.jp", "bmobile@wifi2", "bmobile") /*BMobile*/
+    },
 
-// 214 Spain
-    { /* Telefonica */       "214-07",
-        _APN("m2mtrial.telefonica.com",,) /* Cat-M1 */
+// 460 China - CN
+    { /* CN Mobile */"460-00",  _APN("cmnet",,)
+        _APN("cmwap",,)
+    },
+    { /* Unicom */   "460-01",  _APN("3gnet",,)
+        _APN("uninet", "uninet", "uninet")
     },
+
+// 901 International - INT
+    { /* Transatel */ "901-37", _APN("netgprs.com", "tsl", "tsl") },
 };
 
 /* ----------------------------------------------------------------
@@ -190,27 +193,47 @@ static const char *pApnGetConfig(const char *pImsi)
     const char *pConfig = NULL;
     const char *pStr;
     size_t length;
+    size_t numEntries = sizeof(gApnLookUpTable) / sizeof(*gApnLookUpTable);
+    size_t lower = 0;
+    size_t upper = numEntries;
+    size_t x = numEntries;
+    size_t middle;
+    int32_t compare;
 
     if ((pImsi != NULL) && (*pImsi != '\0')) {
         // Many carriers use internet without username and password,
         // so use this as default now try to lookup the setting
-        // for our table
-        for (size_t x = 0; x < sizeof(gApnLookUpTable) / sizeof(*gApnLookUpTable) &&
-             !pConfig; x++) {
-            pStr = gApnLookUpTable[x].pMccMnc;
-            // Check the MCC
-            if (memcmp(pImsi, pStr, 3) == 0) {
-                pStr += 3;
-                // Check all the MNC, MNC length can be 2 or 3 digits
-                while (((*(pStr + 0) == '-') || (*(pStr + 0) == ',')) &&
-                       (*(pStr + 1) >= '0') && (*(pStr + 1) <= '9') &&
-                       (*(pStr + 2) >= '0') && (*(pStr + 2) <= '9') && !pConfig) {
-                    length = ((*(pStr + 3) >= '0') && (*(pStr + 3) <= '9')) ? 3 : 2;
-                    if (memcmp(pImsi + 3, pStr + 1, length) == 0) {
-                        pConfig = gApnLookUpTable[x].pCfg;
-                    }
-                    pStr += length + 1;
+        // for our table: first binary search for an entry with our
+        // MCC
+        while ((lower < upper) && (x == numEntries)) {
+            middle = lower + ((upper - lower) / 2);
+            compare = memcmp(pImsi, gApnLookUpTable[middle].pMccMnc, 3);
+            if (compare < 0) {
+                upper = middle;
+            } else if (compare > 0) {
+                lower = middle + 1;
+            } else {
+                x = middle;
+            }
+        }
+        // There may be several entries for the MCC, go to the first
+        while ((x > 0) && (x < numEntries) &&
+               (memcmp(pImsi, gApnLookUpTable[x - 1].pMccMnc, 3) == 0)) {
+            x--;
+        }
+        // Now check the MNCs of each entry for the MCC
+        for (; (x < numEntries) &&
+             (memcmp(pImsi, gApnLookUpTable[x].pMccMnc, 3) == 0) && !pConfig; x++) {
+            pStr = gApnLookUpTable[x].pMccMnc + 3;
+            // Check all the MNC, MNC length can be 2 or 3 digits
+            while (((*(pStr + 0) == '-') || (*(pStr + 0) == ',')) &&
+                   (*(pStr + 1) >= '0') && (*(pStr + 1) <= '9') &&
+                   (*(pStr + 2) >= '0') && (*(pStr + 2) <= '9') && !pConfig) {
+                length = ((*(pStr + 3) >= '0') && (*(pStr + 3) <= '9')) ? 3 : 2;
+                if (memcmp(pImsi + 3, pStr + 1, length) == 0) {
+                    pConfig = gApnLookUpTable[x].pCfg;
                 }
+                pStr += length + 1;
             }
         }
     }
@@ -45,6 +45,7 @@
 #include "u_port_debug.h"
 #include "u_port_os.h"
 #include "u_port_heap.h"
+#include "u_port_uart.h"
 
 #include "u_at_client.h"
 
@@ -53,6 +54,7 @@
 #include "u_cell.h"         // Order is
 #include "u_cell_net.h"     // important here
 #include "u_cell_private.h" // don't change it
+#include "u_cell_pwr.h"
 #include "u_cell_cfg.h"
 
 /* ----------------------------------------------------------------
@@ -887,11 +889,14 @@ static void greetingCallback(uAtClientHandle_t atHandle, void *pParameter)
 // follow prototype
 static void GREETING_urc(uAtClientHandle_t atHandle, void *pParameter)
 {
-    const uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
     uCellCfgGreeting_t *pGreeting;
 
     (void) atHandle;
 
+    // Let power-on know that the module has booted
+    pInstance->greetingReceived = true;
+
     if (pInstance->pGreetingCallback != NULL) {
         // Put the data for the callback into a struct to our
         // local callback via the AT client's callback mechanism
@@ -968,6 +973,32 @@ static void removeGreetingUrc(uCellPrivateInstance_t *pInstance,
     }
 }
 
+// Determine whether a greeting message that has just been set
+// will be emitted as soon as the module boots: it will not be if
+// the module is auto-bauding, since then it has no idea what
+// baud rate to send the greeting at until it has been sent
+// something (AT+IPR? returns zero in that case).
+static bool greetingIsAtBoot(const uCellPrivateInstance_t *pInstance)
+{
+    bool isAtBoot = true;
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+
+    if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                           U_CELL_PRIVATE_FEATURE_AUTO_BAUDING)) {
+        uAtClientLock(atHandle);
+        uAtClientCommandStart(atHandle, "AT+IPR?");
+        uAtClientCommandStop(atHandle);
+        uAtClientResponseStart(atHandle, "+IPR:");
+        isAtBoot = (uAtClientReadInt(atHandle) > 0);
+        uAtClientResponseStop(atHandle);
+        if (uAtClientUnlock(atHandle) != 0) {
+            isAtBoot = false;
+        }
+    }
+
+    return isAtBoot;
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: GENERAL
  * -------------------------------------------------------------- */
@@ -999,6 +1030,166 @@ static int32_t setAndStoreBaudRate(const uCellPrivateInstance_t *pInstance,
     return errorCode;
 }
 
+// Check that the module responds to "AT" at the current baud rate.
+static bool baudRateVerify(uAtClientHandle_t atHandle)
+{
+    bool verified = false;
+
+    for (size_t x = 0; (x < U_CELL_CFG_BAUD_RATE_UPGRADE_VERIFY_TRIES) &&
+         !verified; x++) {
+        // Throw away anything garbled that arrived at the wrong rate
+        uAtClientFlush(atHandle);
+        uAtClientLock(atHandle);
+        uAtClientTimeoutSet(atHandle, U_CELL_CFG_BAUD_RATE_UPGRADE_VERIFY_TIMEOUT_MS);
+        uAtClientCommandStart(atHandle, "AT");
+        uAtClientCommandStopReadResponse(atHandle);
+        verified = (uAtClientUnlock(atHandle) == 0);
+    }
+
+    return verified;
+}
+
+// Given the list of baud rates returned by AT+IPR=?, e.g.
+// "(0,9600,19200,115200,230400,460800,921600),()", return the
+// highest one that is above baudRateNow, no higher than baudRateMax
+// and that this MCU's UART will accept, else zero.
+static int32_t baudRateChoose(const char *pList, int32_t uart,
+                              int32_t baudRateNow, int32_t baudRateMax)
+{
+    int32_t baudRate = 0;
+    int32_t candidate = -1;
+    int32_t ceiling = baudRateMax + 1;
+    int32_t x;
+    const char *pStr;
+    char *pEnd;
+
+    while ((baudRate == 0) && (candidate != 0)) {
+        // Find the highest rate below the ceiling
+        candidate = 0;
+        pStr = strchr(pList, '(');
+        if (pStr != NULL) {
+            pStr++;
+            while ((*pStr != 0) && (*pStr != ')')) {
+                x = strtol(pStr, &pEnd, 10);
+                if (pEnd == pStr) {
+                    pEnd++;
+                }
+                if ((x > baudRateNow) && (x < ceiling) && (x > candidate)) {
+                    candidate = x;
+                }
+                pStr = pEnd;
+            }
+        }
+        if (candidate > 0) {
+            // Check that this MCU's UART can do it; nothing is
+            // being sent at the moment so there is no harm in
+            // switching the rate and then switching it back
+            if (uPortUartSetBaudRate(uart, candidate) == 0) {
+                uPortUartSetBaudRate(uart, baudRateNow);
+                baudRate = candidate;
+            } else {
+                ceiling = candidate;
+            }
+        }
+    }
+
+    return baudRate;
+}
+
+// Apply the RATs of a transaction, if they differ from those of
+// the module, returning the number of changes made (zero or one)
+// or negative error code.
+static int32_t applyRats(uDeviceHandle_t cellHandle,
+                         const uCellNetRat_t *pRat)
+{
+    int32_t errorCodeOrChanges = 0;
+    bool same = true;
+    uCellNetRat_t rat;
+
+    for (int32_t x = 0; (x < U_CELL_CFG_TRANSACTION_MAX_NUM_RATS) &&
+         same && (errorCodeOrChanges == 0); x++) {
+        rat = uCellCfgGetRat(cellHandle, x);
+        if ((int32_t) rat < 0) {
+            if (x == 0) {
+                // Couldn't even read the first one
+                errorCodeOrChanges = (int32_t) rat;
+            }
+            // Otherwise this is a rank beyond what the module supports
+            rat = U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED;
+        }
+        same = (rat == *(pRat + x));
+    }
+    if (!same && (errorCodeOrChanges == 0)) {
+        errorCodeOrChanges = uCellCfgSetRat(cellHandle, *pRat);
+        for (int32_t x = 1; (x < U_CELL_CFG_TRANSACTION_MAX_NUM_RATS) &&
+             (errorCodeOrChanges == 0) &&
+             (*(pRat + x) != U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED); x++) {
+            errorCodeOrChanges = uCellCfgSetRatRank(cellHandle, *(pRat + x), x);
+        }
+        if (errorCodeOrChanges == 0) {
+            errorCodeOrChanges = 1;
+        }
+    }
+
+    return errorCodeOrChanges;
+}
+
+// Apply the band masks of a transaction, where they differ from
+// those of the module, returning the number of changes made or
+// negative error code.
+static int32_t applyBandMasks(uDeviceHandle_t cellHandle,
+                              const uCellCfgBandMask_t *pBandMask)
+{
+    int32_t errorCodeOrChanges = 0;
+    int32_t changes = 0;
+    uint64_t bandMask1;
+    uint64_t bandMask2;
+
+    for (size_t x = 0; (x < U_CELL_CFG_TRANSACTION_MAX_NUM_BAND_MASKS) &&
+         (errorCodeOrChanges == 0); x++, pBandMask++) {
+        if (pBandMask->rat != U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED) {
+            errorCodeOrChanges = uCellCfgGetBandMask(cellHandle, pBandMask->rat,
+                                                     &bandMask1, &bandMask2);
+            if ((errorCodeOrChanges == 0) &&
+                ((bandMask1 != pBandMask->bandMask1) ||
+                 (bandMask2 != pBandMask->bandMask2))) {
+                errorCodeOrChanges = uCellCfgSetBandMask(cellHandle, pBandMask->rat,
+                                                         pBandMask->bandMask1,
+                                                         pBandMask->bandMask2);
+                changes++;
+            }
+        }
+    }
+    if (errorCodeOrChanges == 0) {
+        errorCodeOrChanges = changes;
+    }
+
+    return errorCodeOrChanges;
+}
+
+// Set the baud rate in the module, without storing it, and then
+// switch this MCU's UART to match, returning true if the module
+// responds at the new rate.
+static bool baudRateSwitch(uAtClientHandle_t atHandle, int32_t uart,
+                           int32_t baudRate)
+{
+    bool success = false;
+
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+IPR=");
+    uAtClientWriteInt(atHandle, baudRate);
+    // The module responds at the old rate and then switches
+    uAtClientCommandStopReadResponse(atHandle);
+    if (uAtClientUnlock(atHandle) == 0) {
+        uPortTaskBlock(U_CELL_CFG_BAUD_RATE_UPGRADE_SETTLE_MS);
+        if (uPortUartSetBaudRate(uart, baudRate) == 0) {
+            success = baudRateVerify(atHandle);
+        }
+    }
+
+    return success;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -1449,6 +1640,60 @@ int32_t uCellCfgGetMnoProfile(uDeviceHandle_t cellHandle)
     return errorCodeOrMnoProfile;
 }
 
+// Apply several configuration changes with at most one reboot.
+int32_t uCellCfgApply(uDeviceHandle_t cellHandle,
+                      const uCellCfgTransaction_t *pTransaction,
+                      bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t errorCodeOrChanges = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    int32_t changes = 0;
+    int32_t x;
+
+    if (pTransaction != NULL) {
+        errorCodeOrChanges = 0;
+        if (pTransaction->mnoProfile >= 0) {
+            x = uCellCfgGetMnoProfile(cellHandle);
+            if (x < 0) {
+                errorCodeOrChanges = x;
+            } else if (x != pTransaction->mnoProfile) {
+                errorCodeOrChanges = uCellCfgSetMnoProfile(cellHandle,
+                                                           pTransaction->mnoProfile);
+                changes++;
+                if ((errorCodeOrChanges == 0) &&
+                    ((pTransaction->rat[0] != U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED) ||
+                     (pTransaction->bandMask[0].rat != U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED))) {
+                    // The MNO profile is likely to change the RATs and
+                    // band masks but only once it has taken effect
+                    errorCodeOrChanges = uCellPwrReboot(cellHandle, pKeepGoingCallback);
+                }
+            }
+        }
+        if ((errorCodeOrChanges == 0) &&
+            (pTransaction->rat[0] != U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED)) {
+            errorCodeOrChanges = applyRats(cellHandle, pTransaction->rat);
+            if (errorCodeOrChanges > 0) {
+                changes += errorCodeOrChanges;
+                errorCodeOrChanges = 0;
+            }
+        }
+        if (errorCodeOrChanges == 0) {
+            errorCodeOrChanges = applyBandMasks(cellHandle, pTransaction->bandMask);
+            if (errorCodeOrChanges > 0) {
+                changes += errorCodeOrChanges;
+                errorCodeOrChanges = 0;
+            }
+        }
+        if ((errorCodeOrChanges == 0) && uCellPwrRebootIsRequired(cellHandle)) {
+            errorCodeOrChanges = uCellPwrReboot(cellHandle, pKeepGoingCallback);
+        }
+        if (errorCodeOrChanges == 0) {
+            errorCodeOrChanges = changes;
+        }
+    }
+
+    return errorCodeOrChanges;
+}
+
 // Configure serial interface
 int32_t uCellCfgSetSerialInterface(uDeviceHandle_t cellHandle, int32_t requestedVariant)
 {
@@ -1533,6 +1778,8 @@ int32_t uCellCfgSetUdconf(uDeviceHandle_t cellHandle, int32_t param1,
             errorCode = uAtClientUnlock(atHandle);
             if (errorCode == 0) {
                 pInstance->rebootIsRequired = true;
+                // No longer the configuration we know
+                pInstance->configFingerprint = 0;
             }
         }
 
@@ -1621,6 +1868,8 @@ int32_t uCellCfgFactoryReset(uDeviceHandle_t cellHandle, int32_t fsRestoreType,
             errorCode = uAtClientUnlock(atHandle);
             if (errorCode == 0) {
                 pInstance->rebootIsRequired = true;
+                // No longer the configuration we know
+                pInstance->configFingerprint = 0;
             }
         }
 
@@ -1636,7 +1885,7 @@ int32_t uCellCfgSetGreeting(uDeviceHandle_t cellHandle, const char *pStr)
     int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
     uCellPrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
-    size_t size;
+    int32_t size;
     // +1 for terminator
     char buffer[U_CELL_CFG_GREETING_CALLBACK_MAX_LEN_BYTES + 1];
 
@@ -1647,18 +1896,25 @@ int32_t uCellCfgSetGreeting(uDeviceHandle_t cellHandle, const char *pStr)
         pInstance = pUCellPrivateGetInstance(cellHandle);
         if (pInstance != NULL) {
             atHandle = pInstance->atHandle;
-            if (pInstance->pGreetingCallback != NULL) {
-                // If there's already a greeting callback, remove
-                // it 'cos this is the "non-callback" form
-                size = getGreeting(atHandle, buffer, sizeof(buffer));
-                if (size > 0) {
-                    removeGreetingUrc(pInstance, buffer);
-                }
-                pInstance->pGreetingCallback = NULL;
-                pInstance->pGreetingCallbackParameter = NULL;
+            // Remove any existing greeting URC: if there's a
+            // greeting callback it goes 'cos this is the
+            // "non-callback" form
+            size = getGreeting(atHandle, buffer, sizeof(buffer));
+            if (size > 0) {
+                removeGreetingUrc(pInstance, buffer);
             }
+            pInstance->greetingAtBoot = false;
+            pInstance->pGreetingCallback = NULL;
+            pInstance->pGreetingCallbackParameter = NULL;
             // Now actually set the greeting
             errorCode = setGreeting(atHandle, pStr);
+            if ((errorCode == 0) && (pStr != NULL) && (strlen(pStr) > 0) &&
+                (strlen(pStr) <= U_CELL_CFG_GREETING_CALLBACK_MAX_LEN_BYTES) &&
+                (addGreetingUrc(pInstance, pStr) == 0)) {
+                // There's no callback but power-on can still
+                // use the greeting to tell that the module has booted
+                pInstance->greetingAtBoot = greetingIsAtBoot(pInstance);
+            }
         }
 
         U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
@@ -1676,7 +1932,8 @@ int32_t uCellCfgSetGreetingCallback(uDeviceHandle_t cellHandle,
     int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
     uCellPrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
-    size_t size;
+    int32_t size;
+    int32_t x;
     // +1 for terminator
     char buffer[U_CELL_CFG_GREETING_CALLBACK_MAX_LEN_BYTES + 1];
 
@@ -1694,13 +1951,21 @@ int32_t uCellCfgSetGreetingCallback(uDeviceHandle_t cellHandle,
                 if (size > 0) {
                     removeGreetingUrc(pInstance, buffer);
                 }
+                pInstance->greetingAtBoot = false;
                 // Set the new greeting
                 errorCode = setGreeting(atHandle, pStr);
                 if (errorCode == 0) {
-                    if (pCallback != NULL) {
-                        errorCode = addGreetingUrc(pInstance, pStr);
-                        if (errorCode != 0) {
+                    // Even without a callback the greeting is
+                    // listened for, so that power-on can use it
+                    if ((pCallback != NULL) ||
+                        ((pStr != NULL) && (strlen(pStr) > 0) &&
+                         (strlen(pStr) <= U_CELL_CFG_GREETING_CALLBACK_MAX_LEN_BYTES))) {
+                        x = addGreetingUrc(pInstance, pStr);
+                        if (x == 0) {
+                            pInstance->greetingAtBoot = greetingIsAtBoot(pInstance);
+                        } else if (pCallback != NULL) {
                             // Clean up on error
+                            errorCode = x;
                             setGreeting(atHandle, NULL);
                         }
                     }
@@ -1873,6 +2138,86 @@ bool uCellCfgAutoBaudIsOn(uDeviceHandle_t cellHandle)
     return autoBaudOn;
 }
 
+// Move to the highest baud rate that both ends support.
+int32_t uCellCfgUpgradeBaudRate(uDeviceHandle_t cellHandle,
+                                int32_t baudRateMax)
+{
+    int32_t errorCodeOrBaudRate = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uAtClientStreamHandle_t stream = U_AT_CLIENT_STREAM_HANDLE_DEFAULTS;
+    int32_t baudRateNow;
+    int32_t baudRateNew = 0;
+    int32_t bytesRead;
+    char buffer[128]; // Enough room for the AT+IPR=? list of any module
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCodeOrBaudRate = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (baudRateMax > 0)) {
+            errorCodeOrBaudRate = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            atHandle = pInstance->atHandle;
+            uAtClientStreamGetExt(atHandle, &stream);
+            if ((stream.type == U_AT_CLIENT_STREAM_TYPE_UART) &&
+                U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                   U_CELL_PRIVATE_FEATURE_AT_PROFILES)) {
+                errorCodeOrBaudRate = (int32_t) U_CELL_ERROR_AT;
+                // Get the current baud rate and the ones on offer
+                uAtClientLock(atHandle);
+                uAtClientCommandStart(atHandle, "AT+IPR?");
+                uAtClientCommandStop(atHandle);
+                uAtClientResponseStart(atHandle, "+IPR:");
+                baudRateNow = uAtClientReadInt(atHandle);
+                uAtClientResponseStop(atHandle);
+                uAtClientCommandStart(atHandle, "AT+IPR=?");
+                uAtClientCommandStop(atHandle);
+                uAtClientResponseStart(atHandle, "+IPR:");
+                // uAtClientReadBytes() since the list contains
+                // delimiters; leave room for a terminator
+                bytesRead = uAtClientReadBytes(atHandle, buffer,
+                                               sizeof(buffer) - 1, false);
+                uAtClientResponseStop(atHandle);
+                if ((uAtClientUnlock(atHandle) == 0) &&
+                    (baudRateNow > 0) && (bytesRead > 0)) {
+                    buffer[bytesRead] = 0;
+                    errorCodeOrBaudRate = baudRateNow;
+                    baudRateNew = baudRateChoose(buffer, stream.handle.int32,
+                                                 baudRateNow, baudRateMax);
+                }
+                if (baudRateNew > 0) {
+                    if (baudRateSwitch(atHandle, stream.handle.int32, baudRateNew)) {
+                        uPortLog("U_CELL_CFG: UART now at %d baud.\n", baudRateNew);
+                        if (pInstance->baudRateRestore == 0) {
+                            pInstance->baudRateRestore = baudRateNow;
+                        }
+                        errorCodeOrBaudRate = baudRateNew;
+                    } else {
+                        // Fall back: if the module did not switch
+                        // then going back to the old rate at this
+                        // end is enough, otherwise the module
+                        // has to be told to go back also
+                        errorCodeOrBaudRate = (int32_t) U_CELL_ERROR_AT;
+                        uPortUartSetBaudRate(stream.handle.int32, baudRateNow);
+                        if (!baudRateVerify(atHandle)) {
+                            uPortUartSetBaudRate(stream.handle.int32, baudRateNew);
+                            baudRateSwitch(atHandle, stream.handle.int32, baudRateNow);
+                        }
+                        uPortLog("U_CELL_CFG: unable to use %d baud, staying at %d.\n",
+                                 baudRateNew, baudRateNow);
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrBaudRate;
+}
+
 // Set "AT+UGPRF".
 int32_t uCellCfgSetGnssProfile(uDeviceHandle_t cellHandle, int32_t profileBitMap,
                                const char *pServerName)
@@ -1888,6 +2233,8 @@ int32_t uCellCfgSetGnssProfile(uDeviceHandle_t cellHandle, int32_t profileBitMap
         pInstance = pUCellPrivateGetInstance(cellHandle);
         if (pInstance != NULL) {
             errorCode = uCellPrivateSetGnssProfile(pInstance, profileBitMap, pServerName);
+            // No longer the configuration we know
+            pInstance->configFingerprint = 0;
         }
 
         U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
@@ -39,12 +39,26 @@
 #include "u_error_common.h"
 #include "u_port.h"
 #include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_at_client.h"
 #include "u_cell_module_type.h"
 #include "u_cell_net.h"
 #include "u_cell_file.h"
 #include "u_cell_private.h"
 
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** Context for readStreamCallback().
+ */
+typedef struct {
+    uDeviceHandle_t cellHandle;
+    bool (*pCallback) (uDeviceHandle_t, const char *, size_t, size_t, void *);
+    void *pCallbackParam;
+    bool keepGoing;
+} uCellFileReadStreamContext_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -58,6 +72,79 @@ static uCellPrivateFileListContainer_t *gpFileList = NULL;
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Callback for uAtClientReadBytesStream() in uCellFileReadStream():
+// passes a segment of the file to the user's callback in chunks of
+// no more than U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES.
+static bool readStreamCallback(uAtClientHandle_t atHandle,
+                               const char *pData, size_t size,
+                               size_t offset, void *pCallbackParam)
+{
+    uCellFileReadStreamContext_t *pContext = (uCellFileReadStreamContext_t *) pCallbackParam;
+    size_t thisSize;
+
+    (void) atHandle;
+
+    while ((size > 0) && pContext->keepGoing) {
+        thisSize = size;
+        if (thisSize > U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES) {
+            thisSize = U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES;
+        }
+        pContext->keepGoing = pContext->pCallback(pContext->cellHandle, pData,
+                                                  thisSize, offset,
+                                                  pContext->pCallbackParam);
+        pData += thisSize;
+        offset += thisSize;
+        size -= thisSize;
+    }
+
+    return pContext->keepGoing;
+}
+
+// Get the size of a file, from the cache if possible, else
+// from the module; gUCellPrivateMutex must be locked.
+static int32_t fileSize(uCellPrivateInstance_t *pInstance,
+                        const char *pFileName)
+{
+    int32_t errorCode;
+    uAtClientHandle_t atHandle;
+    int32_t size;
+
+    errorCode = uCellPrivateFileCacheGetSize(pInstance, pFileName);
+    if (errorCode == (int32_t) U_ERROR_COMMON_NOT_FOUND) {
+        // Known not to exist: the module would return
+        // an error, so do the same
+        errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+    } else if (errorCode < 0) {
+        errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+        atHandle = pInstance->atHandle;
+        // Do the ULSTFILE thang with the AT interface
+        uAtClientLock(atHandle);
+        uAtClientCommandStart(atHandle, "AT+ULSTFILE=");
+        // Write get file size op_code
+        uAtClientWriteInt(atHandle, 2);
+        // Write file name
+        uAtClientWriteString(atHandle, pFileName, true);
+        if (pInstance->pFileSystemTag != NULL) {
+            // Write tag
+            uAtClientWriteString(atHandle, pInstance->pFileSystemTag, true);
+        }
+        uAtClientCommandStop(atHandle);
+        // Grab the response
+        uAtClientResponseStart(atHandle, "+ULSTFILE:");
+        // Read file size
+        size = uAtClientReadInt(atHandle);
+        uAtClientResponseStop(atHandle);
+        if (uAtClientUnlock(atHandle) == 0) {
+            errorCode = size;
+            if (size >= 0) {
+                uCellPrivateFileCacheSetSize(pInstance, pFileName, size);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: WORKAROUND FOR LINKER ISSUE
  * -------------------------------------------------------------- */
@@ -87,6 +174,10 @@ int32_t uCellFileSetTag(uDeviceHandle_t cellHandle, const char *pTag)
             errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
             if (U_CELL_PRIVATE_HAS(pInstance->pModule,
                                    U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)) {
+                if (pTag != pInstance->pFileSystemTag) {
+                    // A different file system: forget what we knew
+                    uCellPrivateFileCacheClear(pInstance);
+                }
                 pInstance->pFileSystemTag = pTag;
                 errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
             }
@@ -166,6 +257,8 @@ int32_t uCellFileWrite(uDeviceHandle_t cellHandle,
                 uAtClientCommandStopReadResponse(atHandle);
                 if (uAtClientUnlock(atHandle) == 0) {
                     errorCode = (int32_t) bytesWritten;
+                    // Data written is appended to any existing file
+                    uCellPrivateFileCacheAppend(pInstance, pFileName, bytesWritten);
                 }
             } else {
                 // Best to tidy whatever might have arrived instead
@@ -349,14 +442,27 @@ int32_t uCellFileBlockRead(uDeviceHandle_t cellHandle,
     return errorCode;
 }
 
-// Read file size.
-int32_t uCellFileSize(uDeviceHandle_t cellHandle,
-                      const char *pFileName)
+// Write a file, with the data provided by a callback.
+int32_t uCellFileWriteStream(uDeviceHandle_t cellHandle,
+                             const char *pFileName,
+                             size_t totalSize,
+                             int32_t (*pCallback) (uDeviceHandle_t cellHandle,
+                                                   char *pBuffer,
+                                                   size_t size,
+                                                   size_t offset,
+                                                   void *pCallbackParam),
+                             void *pCallbackParam)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    int32_t callbackErrorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     uCellPrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
-    int32_t size = 0;
+    char *pBuffer;
+    size_t offset = 0;
+    size_t thisSize;
+    size_t written = 1;
+    bool existed;
+    int32_t x;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -365,29 +471,155 @@ int32_t uCellFileSize(uDeviceHandle_t cellHandle,
         pInstance = pUCellPrivateGetInstance(cellHandle);
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         // Check parameters
-        if ((pInstance != NULL) && (pFileName != NULL) &&
+        if ((pInstance != NULL) && (pCallback != NULL) && (pFileName != NULL) &&
+            (strlen(pFileName) <= U_CELL_FILE_NAME_MAX_LENGTH)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            pBuffer = (char *) pUPortMalloc(U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES);
+            if (pBuffer != NULL) {
+                // If the file already exists the data is appended
+                // to it, in which case it must not be deleted should
+                // the callback give up
+                existed = (fileSize(pInstance, pFileName) >= 0);
+                errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+                atHandle = pInstance->atHandle;
+                // Do the UDWNFILE thang with the AT interface,
+                // just the once for the whole file
+                uAtClientLock(atHandle);
+                uAtClientCommandStart(atHandle, "AT+UDWNFILE=");
+                uAtClientWriteString(atHandle, pFileName, true);
+                uAtClientWriteInt(atHandle, (int32_t) totalSize);
+                if (pInstance->pFileSystemTag != NULL) {
+                    uAtClientWriteString(atHandle, pInstance->pFileSystemTag, true);
+                }
+                uAtClientCommandStop(atHandle);
+                // Wait for the prompt
+                if (uAtClientWaitCharacter(atHandle, '>') == 0) {
+                    // Allow plenty of time for each chunk
+                    uAtClientTimeoutSet(atHandle, 10000);
+                    uPortTaskBlock(50);
+                    while ((written > 0) && (offset < totalSize) &&
+                           (uAtClientErrorGet(atHandle) == 0)) {
+                        thisSize = totalSize - offset;
+                        if (thisSize > U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES) {
+                            thisSize = U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES;
+                        }
+                        if (callbackErrorCode == 0) {
+                            x = pCallback(cellHandle, pBuffer, thisSize, offset, pCallbackParam);
+                            if (x <= 0) {
+                                // The callback has run out: the module still
+                                // expects the rest so pad it out and delete the
+                                // file afterwards
+                                callbackErrorCode = x;
+                                if (callbackErrorCode == 0) {
+                                    callbackErrorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+                                }
+                                memset(pBuffer, 0, thisSize);
+                            } else if ((size_t) x < thisSize) {
+                                thisSize = (size_t) x;
+                            }
+                        }
+                        written = uAtClientWriteBytes(atHandle, pBuffer, thisSize, true);
+                        offset += written;
+                    }
+                    // Restore at client timeout to default
+                    uAtClientTimeoutSet(atHandle, U_AT_CLIENT_DEFAULT_TIMEOUT_MS);
+                    // Grab the response
+                    uAtClientCommandStopReadResponse(atHandle);
+                    if (uAtClientUnlock(atHandle) == 0) {
+                        errorCode = (int32_t) offset;
+                        uCellPrivateFileCacheAppend(pInstance, pFileName, offset);
+                    }
+                    if (callbackErrorCode < 0) {
+                        if (!existed) {
+                            uCellPrivateFileDelete(pInstance, pFileName);
+                        }
+                        errorCode = callbackErrorCode;
+                    }
+                } else {
+                    // Best to tidy whatever might have arrived instead
+                    // of the prompt before exiting
+                    uAtClientResponseStop(atHandle);
+                    uAtClientUnlock(atHandle);
+                }
+                uPortFree(pBuffer);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Read a whole file, passing the data to a callback.
+int32_t uCellFileReadStream(uDeviceHandle_t cellHandle,
+                            const char *pFileName,
+                            bool (*pCallback) (uDeviceHandle_t cellHandle,
+                                               const char *pData,
+                                               size_t size,
+                                               size_t offset,
+                                               void *pCallbackParam),
+                            void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    int32_t indicatedReadSize;
+    int32_t x = 0;
+    uCellFileReadStreamContext_t context;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        // Check parameters
+        if ((pInstance != NULL) && (pCallback != NULL) && (pFileName != NULL) &&
             (strlen(pFileName) <= U_CELL_FILE_NAME_MAX_LENGTH)) {
             errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+            context.cellHandle = cellHandle;
+            context.pCallback = pCallback;
+            context.pCallbackParam = pCallbackParam;
+            context.keepGoing = true;
             atHandle = pInstance->atHandle;
-            // Do the ULSTFILE thang with the AT interface
+            // Do the URDFILE thang with the AT interface
             uAtClientLock(atHandle);
-            uAtClientCommandStart(atHandle, "AT+ULSTFILE=");
-            // Write get file size op_code
-            uAtClientWriteInt(atHandle, 2);
-            // Write file name
+            uAtClientCommandStart(atHandle, "AT+URDFILE=");
             uAtClientWriteString(atHandle, pFileName, true);
             if (pInstance->pFileSystemTag != NULL) {
-                // Write tag
                 uAtClientWriteString(atHandle, pInstance->pFileSystemTag, true);
             }
             uAtClientCommandStop(atHandle);
-            // Grab the response
-            uAtClientResponseStart(atHandle, "+ULSTFILE:");
-            // Read file size
-            size = uAtClientReadInt(atHandle);
+            if (U_CELL_PRIVATE_MODULE_IS_SARA_R4(pInstance->pModule->moduleType)) {
+                // SARA-R4 only puts \n before the
+                // response, not \r\n as it should
+                uAtClientResponseStart(atHandle, "\n+URDFILE:");
+            } else {
+                uAtClientResponseStart(atHandle, "+URDFILE:");
+            }
+            // Skip the file name
+            uAtClientSkipParameters(atHandle, 1);
+            indicatedReadSize = uAtClientReadInt(atHandle);
+            // Don't stop for anything!
+            uAtClientIgnoreStopTag(atHandle);
+            // Get the leading quote mark out of the way
+            uAtClientReadBytes(atHandle, NULL, 1, true);
+            if (indicatedReadSize > 0) {
+                // Hand the data on straight out of the AT
+                // client's receive buffer as it arrives
+                x = uAtClientReadBytesStream(atHandle, (size_t) indicatedReadSize,
+                                             readStreamCallback, &context);
+            }
+            // Make sure to wait for the stop tag before
+            // we finish
+            uAtClientRestoreStopTag(atHandle);
             uAtClientResponseStop(atHandle);
-            if (uAtClientUnlock(atHandle) == 0) {
-                errorCode = size;
+            if ((uAtClientUnlock(atHandle) == 0) && (x >= 0)) {
+                errorCode = x;
+                if (!context.keepGoing) {
+                    errorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+                }
             }
         }
 
@@ -397,6 +629,31 @@ int32_t uCellFileSize(uDeviceHandle_t cellHandle,
     return errorCode;
 }
 
+// Read file size.
+int32_t uCellFileSize(uDeviceHandle_t cellHandle,
+                      const char *pFileName)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        // Check parameters
+        if ((pInstance != NULL) && (pFileName != NULL) &&
+            (strlen(pFileName) <= U_CELL_FILE_NAME_MAX_LENGTH)) {
+            errorCode = fileSize(pInstance, pFileName);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
 // Delete file on file system.
 int32_t uCellFileDelete(uDeviceHandle_t cellHandle,
                         const char *pFileName)
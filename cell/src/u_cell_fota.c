@@ -87,6 +87,8 @@ typedef struct {
 typedef struct {
     uCellFotaStatusCallback_t *pCallback;
     void *pCallbackParameter;
+    int32_t downloadStartTimeMs; /**< -1 if no download is in progress. */
+    int32_t downloadStartPercentage; /**< the percentage when downloadStartTimeMs was set. */
 } uCellPrivateFotaContext_t;
 
 /* ----------------------------------------------------------------
@@ -174,6 +176,28 @@ static void fotaStatusCallback(uAtClientHandle_t atHandle, void *pParameter)
     }
 }
 
+// Work out the elapsed time and the estimated time to completion
+// of a download from the percentage just reported.
+static void downloadProgress(uCellPrivateFotaContext_t *pContext,
+                             uCellFotaStatus_t *pStatus)
+{
+    int32_t elapsedMs;
+    int32_t percentage = (int32_t) pStatus->value.percentage;
+
+    if ((pContext->downloadStartTimeMs < 0) ||
+        (percentage < pContext->downloadStartPercentage)) {
+        // Either the start of the download was missed or the
+        // module has started again: measure from here
+        pContext->downloadStartTimeMs = uPortGetTickTimeMs();
+        pContext->downloadStartPercentage = percentage;
+    }
+    elapsedMs = uPortGetTickTimeMs() - pContext->downloadStartTimeMs;
+    pStatus->elapsedSeconds = elapsedMs / 1000;
+    pStatus->etaSeconds = uCellPrivateFotaEtaSeconds(elapsedMs,
+                                                     pContext->downloadStartPercentage,
+                                                     percentage);
+}
+
 // Call fotaStatusCallback() via the AT client callback queue.
 static void queueFotaStatus(uCellPrivateInstance_t *pInstance,
                             uCellFotaStatus_t *pStatus)
@@ -205,6 +229,10 @@ static void UFOTASTAT_urc(uAtClientHandle_t atHandle,
     int32_t param2;
     bool urcIsGood = false;
     uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
+    uCellPrivateFotaContext_t *pContext = (uCellPrivateFotaContext_t *) pInstance->pFotaContext;
+
+    status.elapsedSeconds = -1;
+    status.etaSeconds = -1;
 
     // Populate the status from the URC
     event = uAtClientReadInt(atHandle);
@@ -217,6 +245,7 @@ static void UFOTASTAT_urc(uAtClientHandle_t atHandle,
                 if ((param1 == 1) && (param2 >= 0)) {
                     status.type = U_CELL_FOTA_STATUS_TYPE_PERCENTAGE_DOWNLOAD;
                     status.value.percentage = param2;
+                    downloadProgress(pContext, &status);
                     urcIsGood = true;
                 }
                 break;
@@ -226,11 +255,14 @@ static void UFOTASTAT_urc(uAtClientHandle_t atHandle,
                     // params tell us nothing of any use, just indicate
                     // a status of "start"
                     status.value.download = U_CELL_FOTA_STATUS_DOWNLOAD_START;
+                    pContext->downloadStartTimeMs = uPortGetTickTimeMs();
+                    pContext->downloadStartPercentage = 0;
                     urcIsGood = true;
                 }
                 break;
             case 2: // download complete
                 status.type = U_CELL_FOTA_STATUS_TYPE_DOWNLOAD;
+                pContext->downloadStartTimeMs = -1;
                 if ((param1 == 2) && (param2 == 100)) { // success
                     status.value.download = U_CELL_FOTA_STATUS_DOWNLOAD_SUCCESS;
                     urcIsGood = true;
@@ -266,6 +298,8 @@ static void UFWPREVAL_UUFWINSTALL_urc(uAtClientHandle_t atHandle,
     int32_t percentageOrStatusCode;
     uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
 
+    status.elapsedSeconds = -1;
+    status.etaSeconds = -1;
     percentageOrStatusCode = uAtClientReadInt(atHandle);
     if (percentageOrStatusCode >= 0) {
         if (percentageOrStatusCode < U_CELL_FOTA_STATUS_INSTALL_MIN_NUM_UUFWINSTALL) {
@@ -332,6 +366,10 @@ int32_t uCellFotaSetStatusCallback(uDeviceHandle_t cellHandle,
                     // cellular is closed down in order to
                     // ensure thread-safety of the callback
                     pContext = (uCellPrivateFotaContext_t *) pUPortMalloc(sizeof(uCellPrivateFotaContext_t));
+                    if (pContext != NULL) {
+                        pContext->downloadStartTimeMs = -1;
+                        pContext->downloadStartPercentage = 0;
+                    }
                 }
                 if (pContext != NULL) {
                     pInstance->pFotaContext = pContext;
@@ -346,8 +384,9 @@ int32_t uCellFotaSetStatusCallback(uDeviceHandle_t cellHandle,
                     pContext->pCallbackParameter = pCallbackParameter;
                     if (pCallback != NULL) {
                         state = 1;
-                        errorCode = uAtClientSetUrcHandler(atHandle, "+UFOTASTAT:",
-                                                           UFOTASTAT_urc, pInstance);
+                        errorCode = uAtClientSetUrcHandlerExt(atHandle, "+UFOTASTAT:",
+                                                              UFOTASTAT_urc, pInstance,
+                                                              U_AT_CLIENT_URC_PRIORITY_BULK);
                     }
                     if (errorCode == 0) {
                         uAtClientLock(atHandle);
@@ -357,10 +396,12 @@ int32_t uCellFotaSetStatusCallback(uDeviceHandle_t cellHandle,
                         errorCode = uAtClientUnlock(atHandle);
                         if (errorCode == 0) {
                             if ((state == 1) &&
-                                (uAtClientSetUrcHandler(atHandle, "+UFWPREVAL:",
-                                                        UFWPREVAL_urc, pInstance) == 0) &&
-                                (uAtClientSetUrcHandler(atHandle, "+UUFWINSTALL:",
-                                                        UUFWINSTALL_urc, pInstance) == 0)) {
+                                (uAtClientSetUrcHandlerExt(atHandle, "+UFWPREVAL:",
+                                                           UFWPREVAL_urc, pInstance,
+                                                           U_AT_CLIENT_URC_PRIORITY_BULK) == 0) &&
+                                (uAtClientSetUrcHandlerExt(atHandle, "+UUFWINSTALL:",
+                                                           UUFWINSTALL_urc, pInstance,
+                                                           U_AT_CLIENT_URC_PRIORITY_BULK) == 0)) {
                                 // Not all modules support the AT+UFWINSTALL
                                 // command which is required to get the validation
                                 // and installation progress (and it can only be
@@ -391,6 +391,9 @@ static void UUHTTPCR_urc(uAtClientHandle_t atHandle, void *pParameter)
     result = uAtClientReadInt(atHandle);
 
     if ((profileId >= 0) && (requestType >= 0) && (result >= 0)) {
+        // The module has written the response file itself so
+        // the file system directory cache can no longer be trusted
+        pCellInstance->fileCacheStale = true;
         // Convert POST_DATA to POST
         if (requestType == 5) {
             requestType = 4;
@@ -823,6 +826,49 @@ int32_t uCellHttpRequestFile(uDeviceHandle_t cellHandle, int32_t httpHandle,
     return errorCode;
 }
 
+// Set or clear a custom request header.
+int32_t uCellHttpSetRequestHeader(uDeviceHandle_t cellHandle, int32_t httpHandle,
+                                  int32_t headerIndex, const char *pName,
+                                  const char *pValue)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pCellInstance = NULL;
+    uCellHttpInstance_t *pHttpInstance = NULL;
+    char *pBuffer;
+    size_t length = 16; // Room for the index, two colons and a terminator
+
+    U_CELL_HTTP_ENTRY_FUNCTION(cellHandle, httpHandle, &pCellInstance,
+                               &pHttpInstance, &errorCode);
+
+    if (errorCode == 0) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((headerIndex >= 0) && (headerIndex < U_CELL_HTTP_REQUEST_HEADER_MAX_NUM) &&
+            ((pName == NULL) || (pValue != NULL))) {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            if (pName != NULL) {
+                length += strlen(pName) + strlen(pValue);
+            }
+            pBuffer = (char *) pUPortMalloc(length);
+            if (pBuffer != NULL) {
+                // The format is "<index>:<name>:<value>", just
+                // "<index>:" clearing the header
+                if (pName != NULL) {
+                    snprintf(pBuffer, length, "%d:%s:%s", (int) headerIndex, pName, pValue);
+                } else {
+                    snprintf(pBuffer, length, "%d:", (int) headerIndex);
+                }
+                errorCode = doUhttpString(pCellInstance->atHandle,
+                                          pHttpInstance->profileId, 9, pBuffer);
+                uPortFree(pBuffer);
+            }
+        }
+    }
+
+    U_CELL_HTTP_EXIT_FUNCTION();
+
+    return errorCode;
+}
+
 // Get the last HTTP error code for the given HTTP instance.
 int32_t uCellHttpGetLastErrorCode(uDeviceHandle_t cellHandle,
                                   int32_t httpHandle)
@@ -43,6 +43,7 @@
 
 #include "u_error_common.h"
 
+#include "u_port.h"
 #include "u_port_clib_platform_specific.h" // strtok_r() and, in some cases, isblank()
 #include "u_port_clib_mktime64.h"
 #include "u_port_debug.h"
@@ -51,6 +52,8 @@
 
 #include "u_at_client.h"
 
+#include "u_time_sync.h"
+
 #include "u_device_shared.h"
 
 #include "u_cell_module_type.h"
@@ -149,6 +152,97 @@ static int32_t getString(uAtClientHandle_t atHandle,
     return errorCodeOrSize;
 }
 
+// Get the ICCID string from the cellular module.
+static int32_t getIccid(uAtClientHandle_t atHandle,
+                        char *pBuffer, size_t bufferSize)
+{
+    int32_t errorCodeOrSize;
+    int32_t bytesRead;
+
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+CCID");
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, "+CCID:");
+    bytesRead = uAtClientReadString(atHandle, pBuffer, bufferSize, false);
+    uAtClientResponseStop(atHandle);
+    errorCodeOrSize = uAtClientUnlock(atHandle);
+    if ((bytesRead >= 0) && (errorCodeOrSize == 0)) {
+        errorCodeOrSize = bytesRead;
+        uPortLog("U_CELL_INFO: ICCID is %s.\n", pBuffer);
+    } else {
+        errorCodeOrSize = (int32_t) U_CELL_ERROR_AT;
+        uPortLog("U_CELL_INFO: unable to read ICCID.\n");
+    }
+
+    return errorCodeOrSize;
+}
+
+// Read one of the identity strings from the cellular module.
+static int32_t readIdString(uAtClientHandle_t atHandle,
+                            uCellPrivateIdString_t idString,
+                            char *pBuffer, size_t bufferSize)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    switch (idString) {
+        case U_CELL_PRIVATE_ID_STRING_ICCID:
+            errorCodeOrSize = getIccid(atHandle, pBuffer, bufferSize);
+            break;
+        case U_CELL_PRIVATE_ID_STRING_MODEL:
+            errorCodeOrSize = getString(atHandle, "AT+CGMM",
+                                        pBuffer, bufferSize);
+            break;
+        case U_CELL_PRIVATE_ID_STRING_FIRMWARE_VERSION:
+            // Use ATI9 instead of AT+CGMR as it contains more information
+            errorCodeOrSize = getString(atHandle, "ATI9",
+                                        pBuffer, bufferSize);
+            break;
+        default:
+            break;
+    }
+
+    return errorCodeOrSize;
+}
+
+// Get one of the identity strings, from the identity cache if
+// it is there, else from the module, populating the cache.
+static int32_t getIdStringCached(uCellPrivateInstance_t *pInstance,
+                                 uCellPrivateIdString_t idString,
+                                 char *pStr, size_t size)
+{
+    int32_t errorCodeOrSize;
+    uCellPrivateIdCache_t *pIdCache = pUCellPrivateGetIdCache(pInstance);
+    size_t length;
+
+    if ((pIdCache != NULL) && (pIdCache->stringLength[idString] < 0)) {
+        errorCodeOrSize = readIdString(pInstance->atHandle, idString,
+                                       pIdCache->string[idString],
+                                       sizeof(pIdCache->string[idString]));
+        // Only cache the string if it definitely fitted
+        if ((errorCodeOrSize >= 0) &&
+            (errorCodeOrSize < (int32_t) sizeof(pIdCache->string[idString]) - 1)) {
+            pIdCache->stringLength[idString] = errorCodeOrSize;
+        }
+    }
+    if ((pIdCache != NULL) && (pIdCache->stringLength[idString] >= 0)) {
+        // Copy out as much as there is room for, as
+        // uAtClientReadString() would
+        length = (size_t) pIdCache->stringLength[idString];
+        if (length > size - 1) {
+            length = size - 1;
+        }
+        memcpy(pStr, pIdCache->string[idString], length);
+        *(pStr + length) = 0;
+        errorCodeOrSize = (int32_t) length;
+    } else {
+        // No cache or it would not fit: do it the hard way
+        errorCodeOrSize = readIdString(pInstance->atHandle, idString,
+                                       pStr, size);
+    }
+
+    return errorCodeOrSize;
+}
+
 // Get SINR as an integer from a decimal (e.g -13.75) in a string,
 // or 0x7FFFFFFF if not known
 static int32_t getSinr(const char *pStr, int32_t divisor)
@@ -669,6 +763,7 @@ int32_t uCellInfoRefreshRadioParameters(uDeviceHandle_t cellHandle)
     uCellPrivateRadioParameters_t *pRadioParameters;
     uAtClientHandle_t atHandle;
     uCellNetRat_t rat;
+    bool upToDate;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -680,8 +775,16 @@ int32_t uCellInfoRefreshRadioParameters(uDeviceHandle_t cellHandle)
             errorCode = (int32_t) U_CELL_ERROR_NOT_REGISTERED;
             atHandle = pInstance->atHandle;
             pRadioParameters = &(pInstance->radioParameters);
-            uCellPrivateClearRadioParameters(pRadioParameters, true);
-            if (uCellPrivateIsRegistered(pInstance)) {
+            // Check if what we have is recent enough to leave be
+            upToDate = (pRadioParameters->refreshedAtMs >= 0) &&
+                       (uPortGetTickTimeMs() - pRadioParameters->refreshedAtMs <
+                        pInstance->radioParametersMaxAgeMs);
+            if (upToDate) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            } else {
+                uCellPrivateClearRadioParameters(pRadioParameters, true);
+            }
+            if (!upToDate && uCellPrivateIsRegistered(pInstance)) {
                 // The mechanisms to get the radio information
                 // are different between EUTRAN and GERAN but
                 // AT+CSQ works in all cases though it sometimes
@@ -722,20 +825,26 @@ int32_t uCellInfoRefreshRadioParameters(uDeviceHandle_t cellHandle)
                 }
             }
 
-            if (errorCode == 0) {
-                uPortLog("U_CELL_INFO: radio parameters refreshed:\n");
-                uPortLog("             RSSI:             %d dBm\n", pRadioParameters->rssiDbm);
-                uPortLog("             RSRP:             %d dBm\n", pRadioParameters->rsrpDbm);
-                uPortLog("             RSRQ:             %d dB\n", pRadioParameters->rsrqDb);
-                uPortLog("             RxQual:           %d\n", pRadioParameters->rxQual);
-                uPortLog("             logical cell ID:  0x%08x\n", pRadioParameters->cellIdLogical);
-                uPortLog("             physical cell ID: %d\n", pRadioParameters->cellIdPhysical);
-                uPortLog("             EARFCN:           %d\n", pRadioParameters->earfcn);
-                if (pRadioParameters->snrDb != 0x7FFFFFFF) {
-                    uPortLog("             SNR:              %d\n", pRadioParameters->snrDb);
+            if (!upToDate) {
+                // Only report what has been freshly read
+                if (errorCode == 0) {
+                    pRadioParameters->refreshedAtMs = uPortGetTickTimeMs();
+                    uPortLog("U_CELL_INFO: radio parameters refreshed:\n");
+                    uPortLog("             RSSI:             %d dBm\n", pRadioParameters->rssiDbm);
+                    uPortLog("             RSRP:             %d dBm\n", pRadioParameters->rsrpDbm);
+                    uPortLog("             RSRQ:             %d dB\n", pRadioParameters->rsrqDb);
+                    uPortLog("             RxQual:           %d\n", pRadioParameters->rxQual);
+                    uPortLog("             logical cell ID:  0x%08x\n",
+                             pRadioParameters->cellIdLogical);
+                    uPortLog("             physical cell ID: %d\n",
+                             pRadioParameters->cellIdPhysical);
+                    uPortLog("             EARFCN:           %d\n", pRadioParameters->earfcn);
+                    if (pRadioParameters->snrDb != 0x7FFFFFFF) {
+                        uPortLog("             SNR:              %d\n", pRadioParameters->snrDb);
+                    }
+                } else {
+                    uPortLog("U_CELL_INFO: unable to refresh radio parameters.\n");
                 }
-            } else {
-                uPortLog("U_CELL_INFO: unable to refresh radio parameters.\n");
             }
         }
 
@@ -745,6 +854,78 @@ int32_t uCellInfoRefreshRadioParameters(uDeviceHandle_t cellHandle)
     return errorCode;
 }
 
+// Set the maximum age of the radio parameters.
+int32_t uCellInfoSetRadioParametersMaxAge(uDeviceHandle_t cellHandle,
+                                          int32_t maxAgeMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (maxAgeMs >= 0)) {
+            pInstance->radioParametersMaxAgeMs = maxAgeMs;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get the maximum age of the radio parameters.
+int32_t uCellInfoGetRadioParametersMaxAge(uDeviceHandle_t cellHandle)
+{
+    int32_t errorCodeOrValue = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCodeOrValue = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            errorCodeOrValue = pInstance->radioParametersMaxAgeMs;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrValue;
+}
+
+// Get the age of the radio parameters.
+int32_t uCellInfoGetRadioParametersAgeMs(uDeviceHandle_t cellHandle)
+{
+    int32_t errorCodeOrValue = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCodeOrValue = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            errorCodeOrValue = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            if (pInstance->radioParameters.refreshedAtMs >= 0) {
+                errorCodeOrValue = uPortGetTickTimeMs() -
+                                   pInstance->radioParameters.refreshedAtMs;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrValue;
+}
+
 // Get the RSSI.
 int32_t uCellInfoGetRssiDbm(uDeviceHandle_t cellHandle)
 {
@@ -1066,8 +1247,6 @@ int32_t uCellInfoGetIccidStr(uDeviceHandle_t cellHandle,
 {
     int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uCellPrivateInstance_t *pInstance;
-    uAtClientHandle_t atHandle;
-    int32_t bytesRead;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -1076,21 +1255,9 @@ int32_t uCellInfoGetIccidStr(uDeviceHandle_t cellHandle,
         pInstance = pUCellPrivateGetInstance(cellHandle);
         errorCodeOrSize = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if ((pInstance != NULL) && (pStr != NULL) && (size > 0)) {
-            atHandle = pInstance->atHandle;
-            uAtClientLock(atHandle);
-            uAtClientCommandStart(atHandle, "AT+CCID");
-            uAtClientCommandStop(atHandle);
-            uAtClientResponseStart(atHandle, "+CCID:");
-            bytesRead = uAtClientReadString(atHandle, pStr, size, false);
-            uAtClientResponseStop(atHandle);
-            errorCodeOrSize = uAtClientUnlock(atHandle);
-            if ((bytesRead >= 0) && (errorCodeOrSize == 0)) {
-                errorCodeOrSize = bytesRead;
-                uPortLog("U_CELL_INFO: ICCID is %s.\n", pStr);
-            } else {
-                errorCodeOrSize = (int32_t) U_CELL_ERROR_AT;
-                uPortLog("U_CELL_INFO: unable to read ICCID.\n");
-            }
+            errorCodeOrSize = getIdStringCached(pInstance,
+                                                U_CELL_PRIVATE_ID_STRING_ICCID,
+                                                pStr, size);
         }
 
         U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
@@ -1137,8 +1304,9 @@ int32_t uCellInfoGetModelStr(uDeviceHandle_t cellHandle,
         pInstance = pUCellPrivateGetInstance(cellHandle);
         errorCodeOrSize = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if ((pInstance != NULL) && (pStr != NULL) && (size > 0)) {
-            errorCodeOrSize = getString(pInstance->atHandle, "AT+CGMM",
-                                        pStr, size);
+            errorCodeOrSize = getIdStringCached(pInstance,
+                                                U_CELL_PRIVATE_ID_STRING_MODEL,
+                                                pStr, size);
         }
 
         U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
@@ -1161,9 +1329,9 @@ int32_t uCellInfoGetFirmwareVersionStr(uDeviceHandle_t cellHandle,
         pInstance = pUCellPrivateGetInstance(cellHandle);
         errorCodeOrSize = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if ((pInstance != NULL) && (pStr != NULL) && (size > 0)) {
-            // Use ATI9 instead of AT+CGMR as it contains more information
-            errorCodeOrSize = getString(pInstance->atHandle, "ATI9",
-                                        pStr, size);
+            errorCodeOrSize = getIdStringCached(pInstance,
+                                                U_CELL_PRIVATE_ID_STRING_FIRMWARE_VERSION,
+                                                pStr, size);
         }
 
         U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
@@ -1178,6 +1346,8 @@ int64_t uCellInfoGetTimeUtc(uDeviceHandle_t cellHandle)
     int64_t errorCodeOrUtcTime = (int64_t) U_ERROR_COMMON_NOT_INITIALISED;
     uCellPrivateInstance_t *pInstance;
     int32_t timeZoneSeconds = 0;
+    int32_t startTimeMs;
+    int32_t endTimeMs;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -1186,10 +1356,20 @@ int64_t uCellInfoGetTimeUtc(uDeviceHandle_t cellHandle)
         pInstance = pUCellPrivateGetInstance(cellHandle);
         errorCodeOrUtcTime = (int64_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pInstance != NULL) {
+            startTimeMs = uPortGetTickTimeMs();
             errorCodeOrUtcTime = getTimeAndTimeZone(pInstance->atHandle,
                                                     &timeZoneSeconds);
             if (errorCodeOrUtcTime >= 0) {
                 errorCodeOrUtcTime -= timeZoneSeconds;
+                // Let the time service know: the time is whole
+                // seconds so take it to be half way through the
+                // second, accurate to half a second plus however
+                // long the AT command took
+                endTimeMs = uPortGetTickTimeMs();
+                uTimeSyncFeed(U_TIME_SYNC_SOURCE_CELL_NITZ,
+                              (errorCodeOrUtcTime * 1000000000) + 500000000,
+                              500000000 + ((int64_t) (endTimeMs - startTimeMs) * 1000000),
+                              endTimeMs);
             }
         }
 
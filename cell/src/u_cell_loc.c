@@ -247,6 +247,7 @@ static void UULOC_urc_callback(uAtClientHandle_t atHandle, void *pParam)
     uCellPrivateLocContext_t *pContext;
     uCellLocFixDataStorage_t *pFixDataStorage;
     uCellLocFixDataStorageBlock_t *pFixDataStorageBlock;
+    uCellPrivateLocFix_t *pLastFix;
 
     (void) atHandle;
 
@@ -257,9 +258,34 @@ static void UULOC_urc_callback(uAtClientHandle_t atHandle, void *pParam)
             // Lock the data storage mutex while we use it
             U_PORT_MUTEX_LOCK(pContext->fixDataStorageMutex);
 
+            pFixDataStorageBlock = &(pUrcStorage->fixDataStorageBlock);
+            if (pFixDataStorageBlock->errorCode == 0) {
+                // Keep the fix for uCellLocGet()/uCellLocGetCached()
+                pLastFix = &(pContext->lastFix);
+                pLastFix->latitudeX1e7 = pFixDataStorageBlock->latitudeX1e7;
+                pLastFix->longitudeX1e7 = pFixDataStorageBlock->longitudeX1e7;
+                pLastFix->altitudeMillimetres = pFixDataStorageBlock->altitudeMillimetres;
+                pLastFix->radiusMillimetres = pFixDataStorageBlock->radiusMillimetres;
+                pLastFix->speedMillimetresPerSecond =
+                    pFixDataStorageBlock->speedMillimetresPerSecond;
+                pLastFix->svs = pFixDataStorageBlock->svs;
+                pLastFix->timeUtc = pFixDataStorageBlock->timeUtc;
+                pLastFix->obtainedAtMs = uPortGetTickTimeMs();
+            }
+            // Keep the outcome for the backoff in uCellLocGetCached()
+            pContext->refreshErrorCode = pFixDataStorageBlock->errorCode;
+            if ((pContext->refreshErrorCode == 0) &&
+                ((pFixDataStorageBlock->radiusMillimetres == INT_MIN) ||
+                 (pFixDataStorageBlock->radiusMillimetres > pContext->desiredAccuracyMillimetres))) {
+                pContext->refreshErrorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            }
+            pContext->refreshEndedAtMs = uPortGetTickTimeMs();
+            pContext->refreshNumFailures++;
+            if (pContext->refreshErrorCode == 0) {
+                pContext->refreshNumFailures = 0;
+            }
             pFixDataStorage = (uCellLocFixDataStorage_t *) pContext->pFixDataStorage;
             if (pFixDataStorage != NULL) {
-                pFixDataStorageBlock = &(pUrcStorage->fixDataStorageBlock);
                 switch (pFixDataStorage->type) {
                     case U_CELL_LOC_FIX_DATA_STORAGE_TYPE_BLOCK:
                         if (pFixDataStorage->store.pBlock != NULL) {
@@ -508,6 +534,12 @@ static int32_t ensureContext(uCellPrivateInstance_t *pInstance)
                 pContext->desiredFixTimeoutSeconds = U_CELL_LOC_DESIRED_FIX_TIMEOUT_DEFAULT_SECONDS;
                 pContext->gnssEnable = U_CELL_LOC_GNSS_ENABLE_DEFAULT;
                 pContext->fixStatus = (int32_t) U_LOCATION_STATUS_UNKNOWN;
+                memset(&(pContext->lastFix), 0, sizeof(pContext->lastFix));
+                pContext->lastFix.obtainedAtMs = -1;
+                pContext->cacheMaxAgeSeconds = 0;
+                pContext->refreshErrorCode = 0;
+                pContext->refreshEndedAtMs = 0;
+                pContext->refreshNumFailures = 0;
                 uAtClientSetUrcHandler(pInstance->atHandle,
                                        "+UULOCIND:", UULOCIND_urc,
                                        pInstance);
@@ -632,6 +664,129 @@ static int32_t beginLocationFix(const uCellPrivateInstance_t *pInstance)
     return errorCode;
 }
 
+// Get the cached location fix if it is within the age and accuracy
+// limits, returning true if it is; the caller must NOT have locked
+// the fix data storage mutex.
+static bool getCachedFix(uCellPrivateLocContext_t *pContext,
+                         int32_t *pLatitudeX1e7, int32_t *pLongitudeX1e7,
+                         int32_t *pAltitudeMillimetres, int32_t *pRadiusMillimetres,
+                         int32_t *pSpeedMillimetresPerSecond,
+                         int32_t *pSvs, int64_t *pTimeUtc)
+{
+    bool isUsable = false;
+    uCellPrivateLocFix_t *pFix = &(pContext->lastFix);
+
+    U_PORT_MUTEX_LOCK(pContext->fixDataStorageMutex);
+
+    if ((pContext->cacheMaxAgeSeconds > 0) && (pFix->obtainedAtMs >= 0) &&
+        ((uPortGetTickTimeMs() - pFix->obtainedAtMs) / 1000 < pContext->cacheMaxAgeSeconds) &&
+        (pFix->radiusMillimetres != INT_MIN) &&
+        (pFix->radiusMillimetres <= pContext->desiredAccuracyMillimetres)) {
+        isUsable = true;
+        if (pLatitudeX1e7 != NULL) {
+            *pLatitudeX1e7 = pFix->latitudeX1e7;
+        }
+        if (pLongitudeX1e7 != NULL) {
+            *pLongitudeX1e7 = pFix->longitudeX1e7;
+        }
+        if (pAltitudeMillimetres != NULL) {
+            *pAltitudeMillimetres = pFix->altitudeMillimetres;
+        }
+        if (pRadiusMillimetres != NULL) {
+            *pRadiusMillimetres = pFix->radiusMillimetres;
+        }
+        if (pSpeedMillimetresPerSecond != NULL) {
+            *pSpeedMillimetresPerSecond = pFix->speedMillimetresPerSecond;
+        }
+        if (pSvs != NULL) {
+            *pSvs = pFix->svs;
+        }
+        if (pTimeUtc != NULL) {
+            *pTimeUtc = pFix->timeUtc;
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(pContext->fixDataStorageMutex);
+
+    return isUsable;
+}
+
+// Return true if uCellLocGetCached() should wait before starting
+// another refresh, because the last ones were not usable; the caller
+// must have locked the fix data storage mutex.
+static bool refreshBackingOff(const uCellPrivateLocContext_t *pContext)
+{
+    bool backingOff = false;
+    int32_t backoffSeconds = U_CELL_LOC_CACHE_REFRESH_BACKOFF_MIN_SECONDS;
+
+    if (pContext->refreshNumFailures > 0) {
+        for (int32_t x = 1; (x < pContext->refreshNumFailures) &&
+             (backoffSeconds < U_CELL_LOC_CACHE_REFRESH_BACKOFF_MAX_SECONDS); x++) {
+            backoffSeconds *= 2;
+        }
+        if (backoffSeconds > U_CELL_LOC_CACHE_REFRESH_BACKOFF_MAX_SECONDS) {
+            backoffSeconds = U_CELL_LOC_CACHE_REFRESH_BACKOFF_MAX_SECONDS;
+        }
+        backingOff = ((uPortGetTickTimeMs() - pContext->refreshEndedAtMs) / 1000 < backoffSeconds);
+    }
+
+    return backingOff;
+}
+
+// Start a location fix with the result going to pCallback, which
+// may be NULL; the cellular mutex must be locked.
+static int32_t startLocationFix(uCellPrivateInstance_t *pInstance,
+                                void (*pCallback) (uDeviceHandle_t cellHandle,
+                                                   int32_t errorCode,
+                                                   int32_t latitudeX1e7,
+                                                   int32_t longitudeX1e7,
+                                                   int32_t altitudeMillimetres,
+                                                   int32_t radiusMillimetres,
+                                                   int32_t speedMillimetresPerSecond,
+                                                   int32_t svs,
+                                                   int64_t timeUtc))
+{
+    int32_t errorCode = (int32_t) U_CELL_ERROR_NOT_REGISTERED;
+    uCellPrivateLocContext_t *pContext;
+    uCellLocFixDataStorage_t *pFixDataStorage;
+
+    if (uCellPrivateIsRegistered(pInstance)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pContext = pInstance->pLocContext;
+
+        U_PORT_MUTEX_LOCK(pContext->fixDataStorageMutex);
+
+        if (pContext->pFixDataStorage == NULL) {
+            // Allocate the data storage and copy pCallback in
+            // The data storage will be freed by the local callback
+            // that is called from the URC handler after it has done
+            // pCallback
+            pFixDataStorage = (uCellLocFixDataStorage_t *) pUPortMalloc(sizeof(*pFixDataStorage));
+            if (pFixDataStorage != NULL) {
+                pFixDataStorage->type = U_CELL_LOC_FIX_DATA_STORAGE_TYPE_CALLBACK;
+                pFixDataStorage->store.pCallback = pCallback;
+                pContext->pFixDataStorage = (void *) pFixDataStorage;
+                // Start the location fix
+                pContext->fixStatus = (int32_t) U_LOCATION_STATUS_UNKNOWN;
+                // Register a URC handler and give it the instance,
+                // which has our data storage attached to it
+                uAtClientRemoveUrcHandler(pInstance->atHandle, "+UULOC:");
+                uAtClientSetUrcHandlerExt(pInstance->atHandle, "+UULOC:",
+                                          UULOC_urc, pInstance,
+                                          U_AT_CLIENT_URC_PRIORITY_BULK);
+                errorCode = beginLocationFix(pInstance);
+                if (errorCode != 0) {
+                    uAtClientRemoveUrcHandler(pInstance->atHandle, "+UULOC:");
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->fixDataStorageMutex);
+    }
+
+    return errorCode;
+}
+
 // Get AT+UGPS.
 //                   *** BE CAREFUL ***
 //  The cellular module will only populate *pAidMode and
@@ -1220,6 +1375,39 @@ int32_t uCellLocGetDesiredAccuracy(uDeviceHandle_t cellHandle)
     return errorCodeOrAccuracy;
 }
 
+// Set the maximum age of a cached location fix.
+void uCellLocSetCacheMaxAge(uDeviceHandle_t cellHandle,
+                            int32_t maxAgeSeconds)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance = NULL;
+
+    U_CELL_LOC_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCode);
+
+    if ((errorCode == 0) && (pInstance != NULL) && (maxAgeSeconds >= 0)) {
+        pInstance->pLocContext->cacheMaxAgeSeconds = maxAgeSeconds;
+    }
+
+    U_CELL_LOC_EXIT_FUNCTION();
+}
+
+// Get the maximum age of a cached location fix.
+int32_t uCellLocGetCacheMaxAge(uDeviceHandle_t cellHandle)
+{
+    int32_t errorCodeOrMaxAge = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance = NULL;
+
+    U_CELL_LOC_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCodeOrMaxAge);
+
+    if ((errorCodeOrMaxAge == 0) && (pInstance != NULL)) {
+        errorCodeOrMaxAge = pInstance->pLocContext->cacheMaxAgeSeconds;
+    }
+
+    U_CELL_LOC_EXIT_FUNCTION();
+
+    return errorCodeOrMaxAge;
+}
+
 // Set the desired location fix time-out.
 void uCellLocSetDesiredFixTimeout(uDeviceHandle_t cellHandle,
                                   int32_t fixTimeoutSeconds)
@@ -1616,7 +1804,13 @@ int32_t uCellLocGet(uDeviceHandle_t cellHandle,
 
     U_CELL_LOC_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCode);
 
-    if ((errorCode == 0) && (pInstance != NULL)) {
+    if ((errorCode == 0) && (pInstance != NULL) &&
+        getCachedFix(pInstance->pLocContext, pLatitudeX1e7, pLongitudeX1e7,
+                     pAltitudeMillimetres, pRadiusMillimetres,
+                     pSpeedMillimetresPerSecond, pSvs, pTimeUtc)) {
+        // Nothing more to do, the fix came from the cache
+        uPortLog("U_CELL_LOC: using cached location.\n");
+    } else if ((errorCode == 0) && (pInstance != NULL)) {
         errorCode = (int32_t) U_CELL_ERROR_NOT_REGISTERED;
         if (uCellPrivateIsRegistered(pInstance)) {
             errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
@@ -1639,9 +1833,10 @@ int32_t uCellLocGet(uDeviceHandle_t cellHandle,
                     // Register a URC handler and give it the instance,
                     // which has our data storage attached to it
                     uAtClientRemoveUrcHandler(pInstance->atHandle, "+UULOC:");
-                    uAtClientSetUrcHandler(pInstance->atHandle,
-                                           "+UULOC:", UULOC_urc,
-                                           pInstance);
+                    uAtClientSetUrcHandlerExt(pInstance->atHandle,
+                                              "+UULOC:", UULOC_urc,
+                                              pInstance,
+                                              U_AT_CLIENT_URC_PRIORITY_BULK);
                     // Start the location fix
                     pContext->fixStatus = (int32_t) U_LOCATION_STATUS_UNKNOWN;
                     errorCode = beginLocationFix(pInstance);
@@ -1725,44 +1920,55 @@ int32_t uCellLocGetStart(uDeviceHandle_t cellHandle,
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uCellPrivateInstance_t *pInstance = NULL;
-    uCellPrivateLocContext_t *pContext;
-    uCellLocFixDataStorage_t *pFixDataStorage;
 
     U_CELL_LOC_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCode);
 
     if ((errorCode == 0) && (pInstance != NULL)) {
-        errorCode = (int32_t) U_CELL_ERROR_NOT_REGISTERED;
-        if (uCellPrivateIsRegistered(pInstance)) {
-            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-            pContext = pInstance->pLocContext;
+        errorCode = startLocationFix(pInstance, pCallback);
+    }
 
-            U_PORT_MUTEX_LOCK(pContext->fixDataStorageMutex);
+    U_CELL_LOC_EXIT_FUNCTION();
 
-            if (pContext->pFixDataStorage == NULL) {
-                // Allocate the data storage and copy pCallback in
-                // The data storage will be freed by the local callback
-                // that is called from the URC handler after it has done
-                // pCallback
-                pFixDataStorage = (uCellLocFixDataStorage_t *) pUPortMalloc(sizeof(*pFixDataStorage));
-                if (pFixDataStorage != NULL) {
-                    pFixDataStorage->type = U_CELL_LOC_FIX_DATA_STORAGE_TYPE_CALLBACK;
-                    pFixDataStorage->store.pCallback = pCallback;
-                    pContext->pFixDataStorage = (void *) pFixDataStorage;
-                    // Start the location fix
-                    pContext->fixStatus = (int32_t) U_LOCATION_STATUS_UNKNOWN;
-                    // Register a URC handler and give it the instance,
-                    // which has our data storage attached to it
-                    uAtClientRemoveUrcHandler(pInstance->atHandle, "+UULOC:");
-                    uAtClientSetUrcHandler(pInstance->atHandle, "+UULOC:",
-                                           UULOC_urc, pInstance);
-                    errorCode = beginLocationFix(pInstance);
-                    if (errorCode != 0) {
-                        uAtClientRemoveUrcHandler(pInstance->atHandle, "+UULOC:");
-                    }
-                }
-            }
+    return errorCode;
+}
 
+// Get the location from the cache, else start a refresh.
+int32_t uCellLocGetCached(uDeviceHandle_t cellHandle,
+                          int32_t *pLatitudeX1e7, int32_t *pLongitudeX1e7,
+                          int32_t *pAltitudeMillimetres, int32_t *pRadiusMillimetres,
+                          int32_t *pSpeedMillimetresPerSecond,
+                          int32_t *pSvs, int64_t *pTimeUtc)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance = NULL;
+    uCellPrivateLocContext_t *pContext;
+    bool inProgress;
+    bool backingOff;
+
+    U_CELL_LOC_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCode);
+
+    if ((errorCode == 0) && (pInstance != NULL)) {
+        pContext = pInstance->pLocContext;
+        if (!getCachedFix(pContext, pLatitudeX1e7, pLongitudeX1e7,
+                          pAltitudeMillimetres, pRadiusMillimetres,
+                          pSpeedMillimetresPerSecond, pSvs, pTimeUtc)) {
+            U_PORT_MUTEX_LOCK(pContext->fixDataStorageMutex);
+            inProgress = (pContext->pFixDataStorage != NULL);
+            backingOff = refreshBackingOff(pContext);
+            if (backingOff) {
+                errorCode = pContext->refreshErrorCode;
+            }
             U_PORT_MUTEX_UNLOCK(pContext->fixDataStorageMutex);
+            if (inProgress) {
+                errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+            } else if (!backingOff) {
+                // Start a refresh in the background; the URC
+                // callback will fill the cache
+                errorCode = startLocationFix(pInstance, NULL);
+                if (errorCode == 0) {
+                    errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                }
+            }
         }
     }
 
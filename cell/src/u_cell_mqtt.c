@@ -37,6 +37,7 @@
 #include "stdio.h"     // snprintf()
 
 #include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h" // For U_CFG_OS_APP_TASK_PRIORITY
 
 #include "u_error_common.h"
 
@@ -50,6 +51,7 @@
 #include "u_port_os.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
+#include "u_port_event_queue.h"
 
 #include "u_hex_bin_convert.h"
 
@@ -89,6 +91,14 @@
 # define U_CELL_MQTT_CONNECT_DELAY_MILLISECONDS 1000
 #endif
 
+#ifndef U_CELL_MQTT_HEX_CHUNK_LENGTH_BYTES
+/** Where a message has to be sent to the module as hex it is
+ * converted, on the stack, in chunks of this many binary bytes,
+ * rather than all at once in an allocated buffer.
+ */
+# define U_CELL_MQTT_HEX_CHUNK_LENGTH_BYTES 32
+#endif
+
 /** Helper macro to make sure that the entry and exit functions
  * are always called.
  */
@@ -232,6 +242,9 @@ typedef struct {
     uint32_t flagsBitmap;
     uCellMqttQos_t subscribeQoS;
     int32_t topicId;
+    // The answers to pipelined registrations, in order, -1 for failure
+    int32_t registerTopicId[U_CELL_MQTT_SN_REGISTER_PIPELINE_DEPTH];
+    size_t registerNumAnswers;
     char topicNameShort[U_CELL_MQTT_SN_TOPIC_NAME_MAX_LENGTH_BYTES];
     // The remaining parameters are only
     // required for SARA-R4 which sends
@@ -254,6 +267,22 @@ typedef struct {
     bool messageRead;
 } uCellMqttUrcMessage_t;
 
+/** A message in the queue of uCellMqttPublishAsync(); the topic
+ * string and then the message follow the structure in the same
+ * allocation.
+ */
+typedef struct uCellMqttPublishQueued_t {
+    struct uCellMqttPublishQueued_t *pNext;
+    int32_t handle;
+    const char *pTopicNameStr;
+    const char *pMessage;
+    size_t messageSizeBytes;
+    uCellMqttQos_t qos;
+    bool retain;
+    void (*pCallback) (uDeviceHandle_t, int32_t, int32_t, void *);
+    void *pCallbackParam;
+} uCellMqttPublishQueued_t;
+
 /** Struct bringing all of the above together.
  */
 typedef struct {
@@ -286,6 +315,15 @@ typedef struct {
                                                       received in a URC, only
                                                       required for SARA-R4. */
     size_t numTries; /**< The number of tries for a radio-related operation. */
+    uPortSemaphoreHandle_t publishSemaphore; /**< Given by the publish URC,
+                                                  may be NULL. */
+    uCellMqttPublishQueued_t *pPublishQueue; /**< The messages queued by
+                                                  uCellMqttPublishAsync(). */
+    size_t publishQueueLength; /**< The number of messages in pPublishQueue,
+                                    plus one while a message is being sent. */
+    int32_t publishNextHandle; /**< The next handle for uCellMqttPublishAsync(). */
+    int32_t publishEventQueueHandle; /**< The queue of the task that sends the
+                                          messages, -1 if not open. */
     bool mqttSn; /**< true if this is an MQTT-SN session, else false. */
 } uCellMqttContext_t;
 
@@ -468,6 +506,10 @@ static void UUMQTTC_UUMQTTSNC_urc(uAtClientHandle_t atHandle,
             pUrcStatus->flagsBitmap |= 1 << U_CELL_MQTT_URC_FLAG_PUBLISH_SUCCESS;
         }
         pUrcStatus->flagsBitmap |= 1 << U_CELL_MQTT_URC_FLAG_PUBLISH_UPDATED;
+        if (pContext->publishSemaphore != NULL) {
+            // Let publish() know straight away
+            uPortSemaphoreGive(pContext->publishSemaphore);
+        }
     } else if (urcType == MQTT_COMMAND_OPCODE_SUBSCRIBE(mqttSn)) {
         // Subscribe
         // Get the QoS
@@ -546,6 +588,11 @@ static void UUMQTTC_UUMQTTSNC_urc(uAtClientHandle_t atHandle,
                         pUrcStatus->topicId = urcParam2;
                         pUrcStatus->flagsBitmap |= 1 << U_CELL_MQTT_URC_FLAG_REGISTER_SUCCESS;
                     }
+                    if (pUrcStatus->registerNumAnswers < U_CELL_MQTT_SN_REGISTER_PIPELINE_DEPTH) {
+                        pUrcStatus->registerTopicId[pUrcStatus->registerNumAnswers] =
+                            ((urcParam1 == 1) && (urcParam2 >= 0)) ? urcParam2 : -1;
+                        pUrcStatus->registerNumAnswers++;
+                    }
                     pUrcStatus->flagsBitmap |= 1 << U_CELL_MQTT_URC_FLAG_REGISTER_UPDATED;
                     break;
                 case 7: // Will parameters update, 1 means success
@@ -1517,6 +1564,29 @@ static int32_t mqttSnTopicNameToStr(const uCellMqttSnTopicName_t *pTopicName,
  * STATIC FUNCTIONS: PUBLISH/SUBSCRIBE/UNSUBSCRIBE/READ
  * -------------------------------------------------------------- */
 
+// Write pData to the AT client as a quoted hex string parameter,
+// converting it in chunks as it goes.
+static void writeHexParameter(uAtClientHandle_t atHandle,
+                              const char *pData, size_t lengthBytes)
+{
+    char hex[(U_CELL_MQTT_HEX_CHUNK_LENGTH_BYTES * 2) + 1];
+    size_t thisLengthBytes;
+
+    uAtClientWritePartialString(atHandle, true, "\"");
+    while (lengthBytes > 0) {
+        thisLengthBytes = lengthBytes;
+        if (thisLengthBytes > U_CELL_MQTT_HEX_CHUNK_LENGTH_BYTES) {
+            thisLengthBytes = U_CELL_MQTT_HEX_CHUNK_LENGTH_BYTES;
+        }
+        uBinToHex(pData, thisLengthBytes, hex);
+        hex[thisLengthBytes * 2] = '\0';
+        uAtClientWritePartialString(atHandle, false, hex);
+        pData += thisLengthBytes;
+        lengthBytes -= thisLengthBytes;
+    }
+    uAtClientWritePartialString(atHandle, false, "\"");
+}
+
 // Publish a message, MQTT or MQTT-SN style.
 static int32_t publish(const uCellPrivateInstance_t *pInstance,
                        const char *pTopicNameStr,
@@ -1531,6 +1601,7 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
     volatile uCellMqttUrcStatus_t *pUrcStatus;
     uAtClientHandle_t atHandle;
     char *pTextMessage = NULL;
+    bool textMode;
     int32_t status = 1;
     bool isAscii;
     bool messageWritten = false;
@@ -1563,45 +1634,42 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
           ((isAscii && (messageSizeBytes <= U_CELL_MQTT_PUBLISH_HEX_MAX_LENGTH_BYTES * 2)) ||
            (messageSizeBytes <= U_CELL_MQTT_PUBLISH_HEX_MAX_LENGTH_BYTES))))) {
         errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-        if (!U_CELL_PRIVATE_HAS(pInstance->pModule,
-                                U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH) ||
-            mqttSn ||
-            ((messageSizeBytes == 0) && retain)) { // Zero length retain messages always sent as ASCII
-            // Note: the MQTT-SN AT interface never supports binary
-            // publishing (even where the MQTT one does)
+        // Note: the MQTT-SN AT interface never supports binary
+        // publishing (even where the MQTT one does)
+        textMode = !U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                       U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH) ||
+                   mqttSn ||
+                   ((messageSizeBytes == 0) && retain); // Zero length retain messages always sent as ASCII
+        if (textMode && isAscii) {
             // If we aren't able to publish a message as a binary
-            // blob then allocate space to publish it as a string,
-            // either as hex or as ASCII with a terminator added
-            if (isAscii) {
-                pTextMessage = (char *) pUPortMalloc(messageSizeBytes + 1);
-                if (pTextMessage != NULL) {
-                    if (pMessage != NULL) {
-                        // Copy in the text
-                        memcpy(pTextMessage, pMessage, messageSizeBytes);
-                    }
-                    // Add a terminator
-                    *(pTextMessage + messageSizeBytes) = '\0';
-                }
-            } else {
-                pTextMessage = (char *) pUPortMalloc((messageSizeBytes * 2) + 1);
-                if (pTextMessage != NULL) {
-                    // Convert to hex
-                    uBinToHex(pMessage, messageSizeBytes, pTextMessage);
-                    // Add a terminator to make it a string
-                    *(pTextMessage + (messageSizeBytes * 2)) = '\0';
+            // blob then allocate space to publish it as ASCII with
+            // a terminator added; hex is converted as it is written
+            pTextMessage = (char *) pUPortMalloc(messageSizeBytes + 1);
+            if (pTextMessage != NULL) {
+                if (pMessage != NULL) {
+                    // Copy in the text
+                    memcpy(pTextMessage, pMessage, messageSizeBytes);
                 }
+                // Add a terminator
+                *(pTextMessage + messageSizeBytes) = '\0';
             }
         }
 
-        if ((pTextMessage != NULL) ||
-            U_CELL_PRIVATE_HAS(pInstance->pModule,
-                               U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH)) {
+        if (!textMode || !isAscii || (pTextMessage != NULL)) {
             errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
             atHandle = pInstance->atHandle;
+            if (pContext->publishSemaphore == NULL) {
+                // Not fatal if this fails, we will just poll for the URC
+                uPortSemaphoreCreate((uPortSemaphoreHandle_t *) &(pContext->publishSemaphore), 0, 1);
+            }
             // We retry this if the failure was due to radio conditions
             do {
                 uAtClientLock(atHandle);
                 pUrcStatus->flagsBitmap = 0;
+                if (pContext->publishSemaphore != NULL) {
+                    // Lose any give left over from a previous URC
+                    uPortSemaphoreTryTake(pContext->publishSemaphore, 0);
+                }
                 if (U_CELL_PRIVATE_HAS(pInstance->pModule,
                                        U_CELL_PRIVATE_FEATURE_MQTT_SARA_R4_OLD_SYNTAX)) {
                     // In the old SARA-R4 syntax there's no URC
@@ -1612,7 +1680,7 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
                 }
                 uAtClientCommandStart(atHandle, MQTT_COMMAND_AT_COMMAND_STRING(mqttSn));
                 // Publish the message
-                if (pTextMessage != NULL) {
+                if (textMode) {
                     // ASCII or hex mode
                     uAtClientWriteInt(atHandle, MQTT_COMMAND_OPCODE_PUBLISH_STRING(mqttSn));
                 } else {
@@ -1623,7 +1691,7 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
                 uAtClientWriteInt(atHandle, (int32_t) qos);
                 // Retention
                 uAtClientWriteInt(atHandle, (int32_t) retain);
-                if (pTextMessage != NULL) {
+                if (textMode) {
                     // If we aren't doing binary mode...
                     if (isAscii) {
                         // ASCII mode
@@ -1639,7 +1707,7 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
                 }
                 // Topic
                 uAtClientWriteString(atHandle, pTopicNameStr, true);
-                if (pTextMessage == NULL) {
+                if (!textMode) {
                     // The length of the binary message
                     uAtClientWriteInt(atHandle, (int32_t) messageSizeBytes);
                     uAtClientCommandStop(atHandle);
@@ -1667,7 +1735,11 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
                     }
                 } else {
                     // ASCII or hex message
-                    uAtClientWriteString(atHandle, pTextMessage, true);
+                    if (isAscii) {
+                        uAtClientWriteString(atHandle, pTextMessage, true);
+                    } else {
+                        writeHexParameter(atHandle, pMessage, messageSizeBytes);
+                    }
                     messageWritten = true;
                     uAtClientCommandStop(atHandle);
                 }
@@ -1702,15 +1774,23 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
                                (uPortGetTickTimeMs() - startTimeMs < (U_MQTT_CLIENT_RESPONSE_WAIT_SECONDS * 1000)) &&
                                ((pContext->pKeepGoingCallback == NULL) ||
                                 pContext->pKeepGoingCallback())) {
-                            uPortTaskBlock(1000);
-                            // When UART power saving is switched on some
-                            // modules (e.g. SARA-R422) can somteimes
-                            // withhold URCs so poke the module here to be
-                            // sure that it has not gone to sleep on us
-                            uAtClientLock(atHandle);
-                            uAtClientCommandStart(atHandle, "AT");
-                            uAtClientCommandStopReadResponse(atHandle);
-                            uAtClientUnlock(atHandle);
+                            // The URC gives the semaphore, so this
+                            // returns as soon as the publish is done
+                            if (pContext->publishSemaphore != NULL) {
+                                uPortSemaphoreTryTake(pContext->publishSemaphore, 1000);
+                            } else {
+                                uPortTaskBlock(1000);
+                            }
+                            if ((pUrcStatus->flagsBitmap & (1 << U_CELL_MQTT_URC_FLAG_PUBLISH_UPDATED)) == 0) {
+                                // When UART power saving is switched on some
+                                // modules (e.g. SARA-R422) can somteimes
+                                // withhold URCs so poke the module here to be
+                                // sure that it has not gone to sleep on us
+                                uAtClientLock(atHandle);
+                                uAtClientCommandStart(atHandle, "AT");
+                                uAtClientCommandStopReadResponse(atHandle);
+                                uAtClientUnlock(atHandle);
+                            }
                         }
                         if ((pUrcStatus->flagsBitmap & (1 << U_CELL_MQTT_URC_FLAG_PUBLISH_SUCCESS)) != 0) {
                             errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
@@ -1732,6 +1812,48 @@ static int32_t publish(const uCellPrivateInstance_t *pInstance,
     return errorCode;
 }
 
+// Event handler for the publish queue: publish the message at the
+// head of the queue of the cellular instance whose handle is at
+// pParam and call its callback.
+static void publishQueueEventHandler(void *pParam, size_t paramLength)
+{
+    uDeviceHandle_t cellHandle = *((uDeviceHandle_t *) pParam);
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance = NULL;
+    volatile uCellMqttContext_t *pContext = NULL;
+    uCellMqttPublishQueued_t *pQueued = NULL;
+
+    (void) paramLength;
+
+    U_CELL_MQTT_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCode, true);
+
+    if ((errorCode == 0) && (pInstance != NULL)) {
+        pContext = (volatile uCellMqttContext_t *) pInstance->pMqttContext;
+        pQueued = pContext->pPublishQueue;
+        if (pQueued != NULL) {
+            // Take the message off the queue but leave it counted
+            // in publishQueueLength until it has been sent
+            pContext->pPublishQueue = pQueued->pNext;
+            errorCode = publish(pInstance, pQueued->pTopicNameStr, -1,
+                                pQueued->pMessage, pQueued->messageSizeBytes,
+                                pQueued->qos, pQueued->retain);
+            pContext->publishQueueLength--;
+        }
+    }
+
+    U_CELL_MQTT_EXIT_FUNCTION();
+
+    if (pQueued != NULL) {
+        // Call the callback outside the lock so that it may
+        // call back into this API
+        if (pQueued->pCallback != NULL) {
+            pQueued->pCallback(cellHandle, pQueued->handle, errorCode,
+                               pQueued->pCallbackParam);
+        }
+        uPortFree(pQueued);
+    }
+}
+
 // Subscribe to an MQTT topic, MQTT or MQTT-SN style.
 static int32_t subscribe(const uCellPrivateInstance_t *pInstance,
                          const char *pTopicFilterStr,
@@ -2172,6 +2294,11 @@ int32_t uCellMqttInit(uDeviceHandle_t cellHandle, const char *pBrokerNameStr,
                     pContext->pBrokerNameStr = NULL;
                     pContext->pUrcMessage = NULL;
                     pContext->numTries = U_CELL_MQTT_RETRIES_DEFAULT + 1;
+                    pContext->publishSemaphore = NULL;
+                    pContext->pPublishQueue = NULL;
+                    pContext->publishQueueLength = 0;
+                    pContext->publishNextHandle = 0;
+                    pContext->publishEventQueueHandle = -1;
                     pContext->mqttSn = mqttSn;
                     pInstance->pMqttContext = pContext;
                     if (U_CELL_PRIVATE_MODULE_IS_SARA_R4(pInstance->pModule->moduleType)) {
@@ -2348,6 +2475,25 @@ void uCellMqttDeinit(uDeviceHandle_t cellHandle)
 {
     uCellPrivateInstance_t *pInstance;
     volatile uCellMqttContext_t *pContext;
+    int32_t publishEventQueueHandle = -1;
+    uCellMqttPublishQueued_t *pQueued = NULL;
+    uCellMqttPublishQueued_t *pTmp;
+
+    U_CELL_MQTT_ENTRY_FUNCTION(cellHandle, &pInstance, NULL, true);
+
+    if (pInstance != NULL) {
+        pContext = (volatile uCellMqttContext_t *) pInstance->pMqttContext;
+        publishEventQueueHandle = pContext->publishEventQueueHandle;
+        pContext->publishEventQueueHandle = -1;
+    }
+
+    U_CELL_MQTT_EXIT_FUNCTION();
+
+    // The publish task needs the cellular mutex, so it has
+    // to be stopped with the mutex unlocked
+    if (publishEventQueueHandle >= 0) {
+        uPortEventQueueClose(publishEventQueueHandle);
+    }
 
     U_CELL_MQTT_ENTRY_FUNCTION(cellHandle, &pInstance, NULL, true);
 
@@ -2358,6 +2504,11 @@ void uCellMqttDeinit(uDeviceHandle_t cellHandle)
         }
 
         uAtClientRemoveUrcHandler(pInstance->atHandle, "+UUMQTT");
+        // Anything left in the publish queue is cancelled
+        pQueued = pContext->pPublishQueue;
+        if (pContext->publishSemaphore != NULL) {
+            uPortSemaphoreDelete(pContext->publishSemaphore);
+        }
         uPortFree(pContext->pBrokerNameStr);
         //lint -e(605) Suppress complaints about
         // freeing a volatile pointer as well
@@ -2369,6 +2520,17 @@ void uCellMqttDeinit(uDeviceHandle_t cellHandle)
     }
 
     U_CELL_MQTT_EXIT_FUNCTION();
+
+    while (pQueued != NULL) {
+        pTmp = pQueued->pNext;
+        if (pQueued->pCallback != NULL) {
+            pQueued->pCallback(cellHandle, pQueued->handle,
+                               (int32_t) U_ERROR_COMMON_CANCELLED,
+                               pQueued->pCallbackParam);
+        }
+        uPortFree(pQueued);
+        pQueued = pTmp;
+    }
 }
 
 // Get the current cellular MQTT client ID.
@@ -2725,7 +2887,6 @@ int32_t uCellMqttSetWill(uDeviceHandle_t cellHandle,
     volatile uCellMqttContext_t *pContext;
     bool mqttSn;
     uAtClientHandle_t atHandle;
-    char *pHexMessage = NULL;
 
     U_CELL_MQTT_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCode, true);
 
@@ -2747,33 +2908,16 @@ int32_t uCellMqttSetWill(uDeviceHandle_t cellHandle,
                    isAllowedMqttSn(pMessage, messageSizeBytes, retain)) ||
                   (messageSizeBytes <= U_CELL_MQTT_WILL_MESSAGE_MAX_LENGTH_BYTES)))) {
                 atHandle = pInstance->atHandle;
-                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                if ((pMessage != NULL) && !mqttSn) {
-                    // For MQTT we can do it in hex, so allocate space
-                    // to encode the hex version of the message
-                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-                    pHexMessage = (char *) pUPortMalloc((messageSizeBytes * 2) + 1);
-                    if (pHexMessage != NULL) {
-                        // Convert to hex
-                        uBinToHex(pMessage, messageSizeBytes, pHexMessage);
-                        // Add a terminator to make it a string
-                        *(pHexMessage + (messageSizeBytes * 2)) = '\0';
-                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                    }
-                }
-
                 // The following operations must be done in
                 // this order if they are to work
-                if (errorCode == 0) {
-                    // Write the "will" QOS
-                    uAtClientLock(atHandle);
-                    uAtClientCommandStart(atHandle, MQTT_PROFILE_AT_COMMAND_STRING(mqttSn));
-                    // Set "will" QOS
-                    uAtClientWriteInt(atHandle, MQTT_PROFILE_OPCODE_WILL_QOS(mqttSn));
-                    // The "will" QOS
-                    uAtClientWriteInt(atHandle, (int32_t) qos);
-                    errorCode = atMqttStopCmdGetRespAndUnlock(pInstance);
-                }
+                // Write the "will" QOS
+                uAtClientLock(atHandle);
+                uAtClientCommandStart(atHandle, MQTT_PROFILE_AT_COMMAND_STRING(mqttSn));
+                // Set "will" QOS
+                uAtClientWriteInt(atHandle, MQTT_PROFILE_OPCODE_WILL_QOS(mqttSn));
+                // The "will" QOS
+                uAtClientWriteInt(atHandle, (int32_t) qos);
+                errorCode = atMqttStopCmdGetRespAndUnlock(pInstance);
                 if (errorCode == 0) {
                     // Write the "will" retention flag
                     uAtClientLock(atHandle);
@@ -2802,8 +2946,9 @@ int32_t uCellMqttSetWill(uDeviceHandle_t cellHandle,
                     // Set "will" message
                     uAtClientWriteInt(atHandle, MQTT_PROFILE_OPCODE_WILL_MESSAGE(mqttSn));
                     // Write the "will" message
-                    if (pHexMessage != NULL) {
-                        uAtClientWriteString(atHandle, pHexMessage, true);
+                    if (!mqttSn) {
+                        // For MQTT we can do it in hex
+                        writeHexParameter(atHandle, pMessage, messageSizeBytes);
                         // Hex mode
                         uAtClientWriteInt(atHandle, 1);
                     } else {
@@ -2811,8 +2956,6 @@ int32_t uCellMqttSetWill(uDeviceHandle_t cellHandle,
                     }
                     errorCode = atMqttStopCmdGetRespAndUnlock(pInstance);
                 }
-                // Free memory
-                uPortFree(pHexMessage);
             }
         }
     }
@@ -3234,6 +3377,122 @@ int32_t uCellMqttPublish(uDeviceHandle_t cellHandle,
     return errorCode;
 }
 
+// Queue an MQTT message for publishing.
+int32_t uCellMqttPublishAsync(uDeviceHandle_t cellHandle,
+                              const char *pTopicNameStr,
+                              const char *pMessage,
+                              size_t messageSizeBytes,
+                              uCellMqttQos_t qos, bool retain,
+                              void (*pCallback) (uDeviceHandle_t,
+                                                 int32_t,
+                                                 int32_t,
+                                                 void *),
+                              void *pCallbackParam)
+{
+    int32_t errorCodeOrHandle = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance = NULL;
+    volatile uCellMqttContext_t *pContext;
+    uCellMqttPublishQueued_t *pQueued;
+    uCellMqttPublishQueued_t **ppTail;
+    size_t topicSizeBytes;
+    char *pTmp;
+
+    U_CELL_MQTT_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCodeOrHandle, true);
+
+    if ((errorCodeOrHandle == 0) && (pInstance != NULL)) {
+        errorCodeOrHandle = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+        pContext = (volatile uCellMqttContext_t *) pInstance->pMqttContext;
+        if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                               U_CELL_PRIVATE_FEATURE_MQTT) &&
+            !pContext->mqttSn) {
+            // The rest of the parameters are checked by publish()
+            errorCodeOrHandle = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+            if ((pTopicNameStr != NULL) && ((pMessage != NULL) || (messageSizeBytes == 0))) {
+                errorCodeOrHandle = (int32_t) U_ERROR_COMMON_BUSY;
+                // Keeping within this limit also means that
+                // uPortEventQueueSend() below cannot block
+                if (pContext->publishQueueLength < U_CELL_MQTT_PUBLISH_QUEUE_MAX_NUM_MESSAGES) {
+                    errorCodeOrHandle = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    if (pContext->publishEventQueueHandle < 0) {
+                        pContext->publishEventQueueHandle = uPortEventQueueOpen(publishQueueEventHandler,
+                                                                                "cellMqttPublish",
+                                                                                sizeof(uDeviceHandle_t),
+                                                                                U_CELL_MQTT_PUBLISH_TASK_STACK_SIZE_BYTES,
+                                                                                U_CELL_MQTT_PUBLISH_TASK_PRIORITY,
+                                                                                U_CELL_MQTT_PUBLISH_QUEUE_MAX_NUM_MESSAGES);
+                    }
+                    topicSizeBytes = strlen(pTopicNameStr) + 1;
+                    pQueued = NULL;
+                    if (pContext->publishEventQueueHandle >= 0) {
+                        pQueued = (uCellMqttPublishQueued_t *) pUPortMalloc(sizeof(*pQueued) +
+                                                                            topicSizeBytes +
+                                                                            messageSizeBytes);
+                    }
+                    if (pQueued != NULL) {
+                        pTmp = (char *) (pQueued + 1);
+                        memcpy(pTmp, pTopicNameStr, topicSizeBytes);
+                        pQueued->pTopicNameStr = pTmp;
+                        pTmp += topicSizeBytes;
+                        if (messageSizeBytes > 0) {
+                            memcpy(pTmp, pMessage, messageSizeBytes);
+                        }
+                        pQueued->pMessage = pTmp;
+                        pQueued->messageSizeBytes = messageSizeBytes;
+                        pQueued->qos = qos;
+                        pQueued->retain = retain;
+                        pQueued->pCallback = pCallback;
+                        pQueued->pCallbackParam = pCallbackParam;
+                        pQueued->handle = pContext->publishNextHandle;
+                        pQueued->pNext = NULL;
+                        ppTail = (uCellMqttPublishQueued_t **) &(pContext->pPublishQueue);
+                        while (*ppTail != NULL) {
+                            ppTail = &((*ppTail)->pNext);
+                        }
+                        *ppTail = pQueued;
+                        pContext->publishQueueLength++;
+                        pContext->publishNextHandle++;
+                        if (pContext->publishNextHandle < 0) {
+                            pContext->publishNextHandle = 0;
+                        }
+                        errorCodeOrHandle = pQueued->handle;
+                        if (uPortEventQueueSend(pContext->publishEventQueueHandle,
+                                                &cellHandle, sizeof(cellHandle)) != 0) {
+                            // Take it off again
+                            *ppTail = NULL;
+                            pContext->publishQueueLength--;
+                            uPortFree(pQueued);
+                            errorCodeOrHandle = (int32_t) U_ERROR_COMMON_PLATFORM;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    U_CELL_MQTT_EXIT_FUNCTION();
+
+    return errorCodeOrHandle;
+}
+
+// Get the number of messages in the publish queue.
+int32_t uCellMqttPublishAsyncGetNum(uDeviceHandle_t cellHandle)
+{
+    int32_t errorCodeOrNum = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance = NULL;
+    volatile uCellMqttContext_t *pContext;
+
+    U_CELL_MQTT_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCodeOrNum, true);
+
+    if ((errorCodeOrNum == 0) && (pInstance != NULL)) {
+        pContext = (volatile uCellMqttContext_t *) pInstance->pMqttContext;
+        errorCodeOrNum = (int32_t) pContext->publishQueueLength;
+    }
+
+    U_CELL_MQTT_EXIT_FUNCTION();
+
+    return errorCodeOrNum;
+}
+
 // Subscribe to an MQTT topic.
 int32_t uCellMqttSubscribe(uDeviceHandle_t cellHandle,
                            const char *pTopicFilterStr,
@@ -3403,6 +3662,99 @@ int32_t uCellMqttSnRegisterNormalTopic(uDeviceHandle_t cellHandle,
     return errorCode;
 }
 
+// Ask the MQTT-SN broker for topic IDs for a list of normal MQTT
+// topics, pipelining the requests.
+int32_t uCellMqttSnRegisterNormalTopicList(uDeviceHandle_t cellHandle,
+                                           const char *const *ppTopicNameStr,
+                                           size_t numTopics,
+                                           uCellMqttSnTopicName_t *pTopicNames)
+{
+    int32_t errorCodeOrNum = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance = NULL;
+    volatile uCellMqttContext_t *pContext;
+    volatile uCellMqttUrcStatus_t *pUrcStatus;
+    uAtClientHandle_t atHandle;
+    int32_t startTimeMs;
+    size_t batchSize;
+    size_t numSent;
+    size_t numRegistered = 0;
+    bool keepGoing = true;
+    int32_t topicId;
+
+    U_CELL_MQTT_ENTRY_FUNCTION(cellHandle, &pInstance, &errorCodeOrNum, true);
+
+    if ((errorCodeOrNum == 0) && (pInstance != NULL)) {
+        errorCodeOrNum = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+        pContext = (volatile uCellMqttContext_t *) pInstance->pMqttContext;
+        if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                               U_CELL_PRIVATE_FEATURE_MQTTSN) &&
+            pContext->mqttSn) {
+            errorCodeOrNum = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+            pUrcStatus = &(pContext->urcStatus);
+            if ((ppTopicNameStr != NULL) && (pTopicNames != NULL)) {
+                atHandle = pInstance->atHandle;
+                for (size_t start = 0; start < numTopics; start += batchSize) {
+                    batchSize = numTopics - start;
+                    if (batchSize > U_CELL_MQTT_SN_REGISTER_PIPELINE_DEPTH) {
+                        batchSize = U_CELL_MQTT_SN_REGISTER_PIPELINE_DEPTH;
+                    }
+                    numSent = 0;
+                    if (keepGoing) {
+                        uAtClientLock(atHandle);
+                        pUrcStatus->registerNumAnswers = 0;
+                        // Send the whole batch without waiting for the
+                        // broker in between; stop at the first refusal
+                        // since the answers are matched up by order
+                        for (size_t x = 0; (x < batchSize) &&
+                             (uAtClientErrorGet(atHandle) == 0); x++) {
+                            uAtClientCommandStart(atHandle, "AT+UMQTTSNC=");
+                            // Register a topic
+                            uAtClientWriteInt(atHandle, 2);
+                            uAtClientWriteString(atHandle, ppTopicNameStr[start + x], true);
+                            uAtClientCommandStopReadResponse(atHandle);
+                            if (uAtClientErrorGet(atHandle) == 0) {
+                                numSent++;
+                            }
+                        }
+                        uAtClientUnlock(atHandle);
+                        // Wait for the URCs carrying the IDs
+                        startTimeMs = uPortGetTickTimeMs();
+                        while ((pUrcStatus->registerNumAnswers < numSent) && keepGoing &&
+                               (uPortGetTickTimeMs() - startTimeMs < (U_MQTT_CLIENT_RESPONSE_WAIT_SECONDS * 1000))) {
+                            keepGoing = (pContext->pKeepGoingCallback == NULL) ||
+                                        pContext->pKeepGoingCallback();
+                            if (keepGoing) {
+                                uPortTaskBlock(100);
+                            }
+                        }
+                    }
+                    for (size_t x = 0; x < batchSize; x++) {
+                        topicId = -1;
+                        if (x < pUrcStatus->registerNumAnswers) {
+                            topicId = pUrcStatus->registerTopicId[x];
+                        }
+                        if ((x < numSent) && (topicId >= 0)) {
+                            pTopicNames[start + x].name.id = (uint16_t) topicId;
+                            pTopicNames[start + x].type = U_CELL_MQTT_SN_TOPIC_NAME_TYPE_ID_NORMAL;
+                            numRegistered++;
+                        } else {
+                            pTopicNames[start + x].type = U_CELL_MQTT_SN_TOPIC_NAME_TYPE_MAX_NUM;
+                        }
+                    }
+                }
+                errorCodeOrNum = (int32_t) numRegistered;
+                if (numRegistered < numTopics) {
+                    printErrorCodes(pInstance);
+                }
+            }
+        }
+    }
+
+    U_CELL_MQTT_EXIT_FUNCTION();
+
+    return errorCodeOrNum;
+}
+
 // Publish a message.
 int32_t uCellMqttSnPublish(uDeviceHandle_t cellHandle,
                            const uCellMqttSnTopicName_t *pTopicName,
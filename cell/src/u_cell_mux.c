@@ -55,7 +55,8 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
-#include "string.h"    // memcpy()
+#include "stdio.h"     // snprintf()
+#include "string.h"    // memcpy(), strstr()
 #include "ctype.h"
 
 #include "u_cfg_sw.h"
@@ -69,6 +70,7 @@
 #include "u_port_heap.h"
 #include "u_port_uart.h"
 #include "u_port_event_queue.h"
+#include "u_log_ram_trace.h" // U_LOG_RAM_TRACE_XXX()
 
 #include "u_interface.h"
 #include "u_ringbuffer.h"
@@ -156,6 +158,13 @@ typedef struct {
     size_t informationLengthBytes;
 } uCellMuxUserFrame_t;
 
+/** Structure passed to cmuxDecodeDestination() by cmuxDecode().
+ */
+typedef struct {
+    uCellMuxPrivateContext_t *pContext;
+    size_t spaceBytes; /**< set to the space offered for the information field. */
+} uCellMuxDecodeDestination_t;
+
 /** Structure to hold a serial event callback on the event queue.
  */
 typedef struct {
@@ -347,7 +356,7 @@ static int32_t serialWriteInnards(struct uDeviceSerial_t *pDeviceSerial,
                                                        pUInterfaceContext(pDeviceSerial);
     uCellPrivateInstance_t *pInstance = pChannelContext->pContext->pInstance;
     char *pBufferEncoded;
-    size_t chunkSize = U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES;
+    size_t chunkSize = pChannelContext->pContext->informationLengthMaxBytes;
     size_t thisChunkSize;
     size_t sizeWritten = 0;
     int32_t thisLengthWritten;
@@ -372,8 +381,8 @@ static int32_t serialWriteInnards(struct uDeviceSerial_t *pDeviceSerial,
                (uPortGetTickTimeMs() - startTimeMs < U_CELL_MUX_WRITE_TIMEOUT_MS)) {
             // Encode a chunk as UIH
             thisChunkSize = sizeBytes - sizeWritten;
-            if (thisChunkSize > U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES) {
-                thisChunkSize = U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES;
+            if (thisChunkSize > chunkSize) {
+                thisChunkSize = chunkSize;
             }
             sizeOrErrorCode = uCellMuxPrivateEncode(pChannelContext->channel,
                                                     U_CELL_MUX_PRIVATE_FRAME_TYPE_UIH,
@@ -417,6 +426,8 @@ static int32_t serialWriteInnards(struct uDeviceSerial_t *pDeviceSerial,
 #endif
                 // Keep track of the amount of user information written
                 sizeWritten += thisChunkSize;
+                pChannelContext->stats.framesSent++;
+                pChannelContext->stats.bytesSent += thisChunkSize;
             }
         }
 
@@ -436,12 +447,45 @@ static int32_t serialWriteInnards(struct uDeviceSerial_t *pDeviceSerial,
     return sizeOrErrorCode;
 }
 
+// Update the flow control statistics of a channel.
+static void flowControlStats(uCellMuxPrivateChannelContext_t *pChannelContext,
+                             bool rxNotTx, bool stopNotGo)
+{
+    int32_t *pStartMs = &(pChannelContext->txFlowControlOffStartMs);
+    uint32_t *pCount = &(pChannelContext->stats.txFlowControlOffCount);
+    int32_t *pTotalMs = &(pChannelContext->stats.txFlowControlOffMs);
+
+    if (rxNotTx) {
+        pStartMs = &(pChannelContext->rxFlowControlOffStartMs);
+        pCount = &(pChannelContext->stats.rxFlowControlOffCount);
+        pTotalMs = &(pChannelContext->stats.rxFlowControlOffMs);
+    }
+    if (stopNotGo) {
+        if (*pStartMs < 0) {
+            *pStartMs = uPortGetTickTimeMs();
+            (*pCount)++;
+        }
+    } else {
+        if (*pStartMs >= 0) {
+            *pTotalMs += uPortGetTickTimeMs() - *pStartMs;
+            *pStartMs = -1;
+        }
+    }
+}
+
 // Send flow control on or off for the given channel.
 static int32_t sendFlowControl(uCellMuxPrivateContext_t *pContext,
                                uint8_t channel, bool stopNotGo)
 {
     char buffer[4];
     uDeviceSerial_t *pDeviceSerial = pUCellMuxPrivateGetDeviceSerial(pContext, 0);
+    uCellMuxPrivateChannelContext_t *pChannelContext;
+
+    pChannelContext = (uCellMuxPrivateChannelContext_t *) pUInterfaceContext(
+                          pUCellMuxPrivateGetDeviceSerial(pContext, channel));
+    if ((pChannelContext != NULL) && (channel != U_CELL_MUX_PRIVATE_CHANNEL_ID_CONTROL)) {
+        flowControlStats(pChannelContext, true, stopNotGo);
+    }
 
     // Format of the MSC frame that sends flow control is as described
     // in controlChannelInformation()
@@ -1022,6 +1066,77 @@ static uint8_t getChannelGnss(const uCellPrivateInstance_t *pInstance)
     return channel;
 }
 
+// Get the channel to use for PPP: the first channel after the
+// AT channel that is not the GNSS channel.
+static uint8_t getChannelPpp(uint8_t channelGnss)
+{
+    uint8_t channel = U_CELL_MUX_PRIVATE_CHANNEL_ID_AT + 1;
+
+    if (channel == channelGnss) {
+        channel++;
+    }
+
+    return channel;
+}
+
+// Wait for the response to a dial command on a CMUX channel, returning
+// zero when CONNECT has been received.  Reading is done a byte at a
+// time so that none of the PPP traffic which follows CONNECT is lost.
+static int32_t waitConnect(uDeviceSerial_t *pDeviceSerial)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+    // Enough for "\r\nNO CARRIER\r\n" plus a null terminator
+    char buffer[16] = {0};
+    size_t length = 0;
+    bool connected = false;
+    char c;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    while ((errorCode == (int32_t) U_ERROR_COMMON_TIMEOUT) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_CELL_MUX_PPP_CONNECT_TIMEOUT_MS)) {
+        if (pDeviceSerial->read(pDeviceSerial, &c, 1) == 1) {
+            if (length >= sizeof(buffer) - 1) {
+                // Keep the most recent characters
+                memmove(buffer, buffer + 1, length - 1);
+                length--;
+            }
+            buffer[length] = c;
+            length++;
+            buffer[length] = 0;
+            if (connected) {
+                // Wait for the end of the CONNECT line, which
+                // may include a speed
+                if (c == '\n') {
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                }
+            } else if (strstr(buffer, "CONNECT") != NULL) {
+                connected = true;
+            } else if ((strstr(buffer, "ERROR") != NULL) ||
+                       (strstr(buffer, "NO CARRIER") != NULL)) {
+                errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+            }
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+
+    return errorCode;
+}
+
+// Get the receive buffer length to use for a CMUX channel: at least
+// four times the information field length so that the channel does
+// not stall the decoder of the others while it is being emptied.
+static size_t receiveBufferLength(const uCellMuxPrivateContext_t *pContext)
+{
+    size_t length = U_CELL_MUX_PRIVATE_VIRTUAL_SERIAL_BUFFER_LENGTH_BYTES;
+
+    if (pContext->informationLengthMaxBytes * 4 > length) {
+        length = pContext->informationLengthMaxBytes * 4;
+    }
+
+    return length;
+}
+
 // Open a CMUX channel.
 static int32_t openChannel(uCellMuxPrivateContext_t *pContext,
                            uint8_t channel, size_t receiveBufferSizeBytes)
@@ -1077,6 +1192,9 @@ static int32_t openChannel(uCellMuxPrivateContext_t *pContext,
                 pChannelContext->markedForDeletion = false;
                 memset(&(pChannelContext->traffic), 0, sizeof(pChannelContext->traffic));
                 memset(&(pChannelContext->eventCallback), 0, sizeof(pChannelContext->eventCallback));
+                memset(&(pChannelContext->stats), 0, sizeof(pChannelContext->stats));
+                pChannelContext->rxFlowControlOffStartMs = -1;
+                pChannelContext->txFlowControlOffStartMs = -1;
                 errorCode = pDeviceSerial->open(pDeviceSerial, NULL, receiveBufferSizeBytes);
                 // Don't clean up on error here - the serial device will be re-used if
                 // the user tries again and this ensures thread-safety.
@@ -1137,6 +1255,8 @@ static void controlChannelInformation(uCellMuxPrivateContext_t *pContext,
             U_CELL_MUX_IS_OPEN(pChannelContext->state)) {
             if (isCommand) {
                 pChannelContext->traffic.txIsFlowControlledOff = ((*(pBuffer + 3) & 0x02) == 0x02);
+                flowControlStats(pChannelContext, false,
+                                 pChannelContext->traffic.txIsFlowControlledOff);
             } else {
                 pChannelContext->traffic.rxIsFlowControlledOff = ((*(pBuffer + 3) & 0x02) == 0x02);
             }
@@ -1251,6 +1371,66 @@ static void cmuxDecodeControl(uCellMuxPrivateContext_t *pContext)
     }
 }
 
+// Called by the parser, from cmuxDecode(), once the header of a
+// frame has been decoded: point the parser at the free space in
+// the receive buffer of the channel so that the information field
+// is written directly there.  The write pointer is NOT moved here,
+// that is done by cmuxDecode() once the frame is known to be good.
+static void cmuxDecodeDestination(uCellMuxPrivateParserContext_t *pParserContext,
+                                  uint8_t address, uCellMuxPrivateFrameType_t type,
+                                  size_t informationLengthBytes, void *pParam)
+{
+    uCellMuxDecodeDestination_t *pDestination = (uCellMuxDecodeDestination_t *) pParam;
+    uDeviceSerial_t *pDeviceSerial;
+    uCellMuxPrivateChannelContext_t *pChannelContext;
+    volatile uCellMuxPrivateTraffic_t *pTraffic;
+    const char *pRxBufferRead;
+    char *pRxBufferEnd;
+
+    (void) informationLengthBytes;
+
+    pParserContext->pInformation = NULL;
+    pParserContext->informationLengthBytes = 0;
+    pParserContext->pInformation2 = NULL;
+    pParserContext->information2LengthBytes = 0;
+    pDestination->spaceBytes = 0;
+    if ((address != U_CELL_MUX_PRIVATE_CHANNEL_ID_CONTROL) &&
+        ((type == U_CELL_MUX_PRIVATE_FRAME_TYPE_UIH) ||
+         (type == U_CELL_MUX_PRIVATE_FRAME_TYPE_UI))) {
+        pDeviceSerial = pUCellMuxPrivateGetDeviceSerial(pDestination->pContext, address);
+        pChannelContext = (uCellMuxPrivateChannelContext_t *) pUInterfaceContext(pDeviceSerial);
+        if ((pChannelContext != NULL) && !pChannelContext->markedForDeletion &&
+            (pChannelContext->traffic.rxBufferSizeBytes > 0)) {
+            pTraffic = &(pChannelContext->traffic);
+            // Take a copy of the read pointer as it may be moved by
+            // the reader while we're in here; -1 in the lengths below
+            // to avoid the write pointer catching up with the read pointer
+            pRxBufferRead = pTraffic->pRxBufferRead;
+            pRxBufferEnd = pTraffic->pRxBufferStart + pTraffic->rxBufferSizeBytes;
+            pParserContext->pInformation = pTraffic->pRxBufferWrite;
+            if (pTraffic->pRxBufferWrite >= pRxBufferRead) {
+                // Free space is from the write pointer to the end of
+                // the buffer and then from the start of the buffer up
+                // to the read pointer
+                pParserContext->informationLengthBytes = pRxBufferEnd - pTraffic->pRxBufferWrite;
+                pParserContext->pInformation2 = pTraffic->pRxBufferStart;
+                pParserContext->information2LengthBytes = pRxBufferRead - pTraffic->pRxBufferStart;
+                if (pParserContext->information2LengthBytes > 0) {
+                    pParserContext->information2LengthBytes--;
+                } else {
+                    pParserContext->informationLengthBytes--;
+                }
+            } else {
+                // Free space is from the write pointer up to the read pointer
+                pParserContext->informationLengthBytes = pRxBufferRead -
+                                                         pTraffic->pRxBufferWrite - 1;
+            }
+            pDestination->spaceBytes = pParserContext->informationLengthBytes +
+                                       pParserContext->information2LengthBytes;
+        }
+    }
+}
+
 // Decode received CMUX frames, just the non-control-channel ones, from
 // the ring buffer.
 static void cmuxDecode(uCellMuxPrivateContext_t *pContext, uint32_t eventBitMap)
@@ -1261,27 +1441,40 @@ static void cmuxDecode(uCellMuxPrivateContext_t *pContext, uint32_t eventBitMap)
     uCellMuxPrivateChannelContext_t *pChannelContext;
     uCellMuxPrivateTraffic_t *pTraffic;
     U_RING_BUFFER_PARSER_f parserList[] = {uCellMuxPrivateParseCmux, NULL};
-    size_t offset;
+    uCellMuxDecodeDestination_t destination;
     bool stalled = false;
-    size_t bufferLength;
-    size_t discardLength;
     size_t x;
-    const char *pRxBufferRead;
+
+    U_LOG_RAM_TRACE_BEGIN(U_LOG_RAM_TRACE_ID_CELL_MUX_DECODE);
 
     if (pContext != NULL) {
+        destination.pContext = pContext;
         // Try to decode new CMUX messages from the ring buffer
         errorCodeOrLength = 0;
         while ((errorCodeOrLength >= 0) && !stalled) {
             memset(&parserContext, 0, sizeof(parserContext));
             parserContext.type = U_CELL_MUX_PRIVATE_FRAME_TYPE_NONE;
             parserContext.address = U_CELL_MUX_PRIVATE_ADDRESS_ANY;
-            // Initial decode, which does NOT copy-out the information field
-            // because we don't know if we have enough room in the buffers
+            // Decode in a single pass: once the header of a frame
+            // has been decoded cmuxDecodeDestination() points the
+            // parser at the free space in the receive buffer of the
+            // channel, into which the information field is written
+            // as the FCS is calculated
+            destination.spaceBytes = 0;
+            parserContext.pInformationDestination = cmuxDecodeDestination;
+            parserContext.pInformationDestinationParam = &destination;
             errorCodeOrLength = uRingBufferParseHandle(&(pContext->ringBuffer),
                                                        pContext->readHandle,
                                                        parserList, &parserContext);
+            if (parserContext.fcsError) {
+                pChannelContext = (uCellMuxPrivateChannelContext_t *) pUInterfaceContext(
+                                      pUCellMuxPrivateGetDeviceSerial(pContext,
+                                                                      parserContext.fcsErrorAddress));
+                if (pChannelContext != NULL) {
+                    pChannelContext->stats.fcsErrors++;
+                }
+            }
             if (errorCodeOrLength > 0) {
-                discardLength = 0;
                 pDeviceSerial = pUCellMuxPrivateGetDeviceSerial(pContext, parserContext.address);
                 pChannelContext = (uCellMuxPrivateChannelContext_t *) pUInterfaceContext(pDeviceSerial);
                 if ((pChannelContext != NULL) &&
@@ -1308,85 +1501,33 @@ static void cmuxDecode(uCellMuxPrivateContext_t *pContext, uint32_t eventBitMap)
                             //fall-through
                             case U_CELL_MUX_PRIVATE_FRAME_TYPE_UI:
                                 if (pTraffic->rxBufferSizeBytes > 0) {
-                                    // We have user information, work out how much we can cope with
-                                    // -1 below to avoid pointer wrap
-                                    bufferLength  = pTraffic->rxBufferSizeBytes - serialGetReceiveSizeInnards(pDeviceSerial) - 1;
-                                    if (bufferLength > sizeof(pContext->scratch)) {
-                                        bufferLength = sizeof(pContext->scratch);
-                                    }
-                                    if (parserContext.informationLengthBytes > bufferLength) {
-                                        discardLength = parserContext.informationLengthBytes - bufferLength;
-                                        parserContext.informationLengthBytes = bufferLength;
-                                    }
-                                    if ((discardLength == 0) || pTraffic->discardOnOverflow) {
-                                        // Re-parse the buffer to actually get the information field
-                                        parserContext.pInformation = pContext->scratch;
-                                        uRingBufferParseHandle(&(pContext->ringBuffer),
-                                                               pContext->readHandle,
-                                                               parserList, &parserContext);
-                                        if (parserContext.informationLengthBytes > bufferLength) {
-                                            parserContext.informationLengthBytes = bufferLength;
+                                    // The information field is already in the receive
+                                    // buffer of the channel, as much of it as would fit
+                                    if ((parserContext.informationLengthBytes <= destination.spaceBytes) ||
+                                        pTraffic->discardOnOverflow) {
+                                        x = parserContext.informationLengthBytes;
+                                        if (x > destination.spaceBytes) {
+                                            x = destination.spaceBytes;
                                         }
 #ifdef U_CELL_MUX_ENABLE_DEBUG
-                                        uPortLog("U_CELL_CMUX_%d: writing %d byte(s) of decode I-field, buffer %d/%d.\n",
-                                                 pChannelContext->channel,
-                                                 parserContext.informationLengthBytes,
+                                        uPortLog("U_CELL_CMUX_%d: decoded %d byte(s) of I-field, buffer %d/%d.\n",
+                                                 pChannelContext->channel, x,
                                                  serialGetReceiveSizeInnards(pDeviceSerial),
                                                  pTraffic->rxBufferSizeBytes);
-#endif
-                                        //  Move the user's information-field bytes into the main buffer
-                                        pRxBufferRead = pTraffic->pRxBufferRead;
-                                        if (pTraffic->pRxBufferWrite >= pRxBufferRead) {
-                                            // Write pointer is equal to or ahead of read,
-                                            // start by adding up to the end of the buffer
-                                            offset = pTraffic->pRxBufferStart +
-                                                     pTraffic->rxBufferSizeBytes - pTraffic->pRxBufferWrite;
-                                            if (offset > parserContext.informationLengthBytes) {
-                                                offset = parserContext.informationLengthBytes;
-                                            }
-                                            memcpy(pTraffic->pRxBufferWrite, pContext->scratch, offset);
-                                            parserContext.informationLengthBytes -= offset;
-                                            // Move the write pointer on, wrapping as necessary
-                                            pTraffic->pRxBufferWrite += offset;
-                                            if (pTraffic->pRxBufferWrite >= pTraffic->pRxBufferStart +
-                                                pTraffic->rxBufferSizeBytes) {
-                                                pTraffic->pRxBufferWrite = pTraffic->pRxBufferStart;
-                                            }
-                                            // If there is still stuff to write, continue writing
-                                            // up to just before the read pointer
-                                            if (parserContext.informationLengthBytes > 0) {
-                                                x = pRxBufferRead - pTraffic->pRxBufferWrite;
-                                                if (x > 0) {
-                                                    x--;
-                                                }
-                                                if (x > parserContext.informationLengthBytes) {
-                                                    x = parserContext.informationLengthBytes;
-                                                }
-                                                memcpy(pTraffic->pRxBufferWrite, pContext->scratch + offset, x);
-                                                pTraffic->pRxBufferWrite += x;
-                                            }
-                                        } else {
-                                            // Write pointer is behind read, just write as much as we can
-                                            x = pRxBufferRead - pTraffic->pRxBufferWrite;
-                                            if (x > parserContext.informationLengthBytes) {
-                                                x = parserContext.informationLengthBytes;
-                                            }
-                                            memcpy(pTraffic->pRxBufferWrite, pContext->scratch, x);
-                                            pTraffic->pRxBufferWrite += x;
+                                        if (x < parserContext.informationLengthBytes) {
+                                            uPortLog("U_CELL_CMUX_%d: discarded %d byte(s) of I-field.\n",
+                                                     pChannelContext->channel,
+                                                     parserContext.informationLengthBytes - x);
                                         }
-                                        // Wrap the write pointer if necessary
+#endif
+                                        pChannelContext->stats.framesReceived++;
+                                        pChannelContext->stats.bytesReceived += x;
+                                        pChannelContext->stats.bytesDiscarded += parserContext.informationLengthBytes - x;
+                                        // Move the write pointer on, wrapping as necessary
+                                        pTraffic->pRxBufferWrite += x;
                                         if (pTraffic->pRxBufferWrite >= pTraffic->pRxBufferStart +
                                             pTraffic->rxBufferSizeBytes) {
-                                            pTraffic->pRxBufferWrite = pTraffic->pRxBufferStart;
-                                        }
-                                        // Having decoded what we can, do any discarding
-                                        if (discardLength > 0) {
-                                            uRingBufferReadHandle(&(pContext->ringBuffer), pContext->readHandle,
-                                                                  NULL, discardLength);
-#ifdef U_CELL_MUX_ENABLE_DEBUG
-                                            uPortLog("U_CELL_CMUX_%d: discarded %d byte(s) of I-field.\n",
-                                                     pChannelContext->channel, discardLength);
-#endif
+                                            pTraffic->pRxBufferWrite -= pTraffic->rxBufferSizeBytes;
                                         }
                                     } else {
                                         // Not enough room to decode more of the information field
@@ -1394,6 +1535,7 @@ static void cmuxDecode(uCellMuxPrivateContext_t *pContext, uint32_t eventBitMap)
 #ifdef U_CELL_MUX_ENABLE_DEBUG
                                         uPortLog("U_CELL_CMUX: stalled.\n");
 #endif
+                                        pChannelContext->stats.stalls++;
                                         stalled = true;
                                     }
 
@@ -1425,10 +1567,9 @@ static void cmuxDecode(uCellMuxPrivateContext_t *pContext, uint32_t eventBitMap)
                 }
 
                 if (!stalled) {
-                    // Remove any suff we have not already discarded from the ring-buffer
-                    // if we've processed it
+                    // Remove what we have processed from the ring-buffer
                     uRingBufferReadHandle(&(pContext->ringBuffer), pContext->readHandle,
-                                          NULL, errorCodeOrLength - discardLength);
+                                          NULL, errorCodeOrLength);
                 }
             }
         }
@@ -1447,6 +1588,8 @@ static void cmuxDecode(uCellMuxPrivateContext_t *pContext, uint32_t eventBitMap)
             }
         }
     }
+
+    U_LOG_RAM_TRACE_END(U_LOG_RAM_TRACE_ID_CELL_MUX_DECODE);
 }
 
 // Callback that is called when an event (e.g. data arrival) occurs on the
@@ -1604,6 +1747,11 @@ int32_t uCellMuxEnable(uDeviceHandle_t cellHandle)
                         // Initialise the other parts of [an existing] context
                         pContext->pInstance = pInstance;
                         pContext->channelGnss = getChannelGnss(pInstance);
+                        pContext->channelPpp = getChannelPpp(pContext->channelGnss);
+                        pContext->informationLengthMaxBytes = pInstance->muxInformationLengthBytes;
+                        if (pContext->informationLengthMaxBytes == 0) {
+                            pContext->informationLengthMaxBytes = U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES;
+                        }
                         pContext->holdingBufferIndex = 0;
                         // Initiate CMUX
                         atHandle = pInstance->atHandle;
@@ -1621,7 +1769,7 @@ int32_t uCellMuxEnable(uDeviceHandle_t cellHandle)
                         uAtClientWriteString(atHandle, "", false);
                         // Set the information field length
                         uAtClientWriteInt(atHandle,
-                                          U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES);
+                                          (int32_t) pContext->informationLengthMaxBytes);
                         // Everything else is left at defaults for max compatibility
                         uAtClientCommandStopReadResponse(atHandle);
                         // Not unlocking here, just check for errors
@@ -1648,7 +1796,7 @@ int32_t uCellMuxEnable(uDeviceHandle_t cellHandle)
                                 // we will need a data buffer for the information field carrying the
                                 // user data (i.e. AT commands)
                                 errorCode = openChannel(pContext, U_CELL_MUX_PRIVATE_CHANNEL_ID_AT,
-                                                        U_CELL_MUX_PRIVATE_VIRTUAL_SERIAL_BUFFER_LENGTH_BYTES);
+                                                        receiveBufferLength(pContext));
                                 if (errorCode == 0) {
 #ifdef U_CELL_MUX_ENABLE_DEBUG
                                     uPortLog("U_CELL_CMUX_1: AT channel open, flushing stored URCs...\n");
@@ -1746,6 +1894,56 @@ bool uCellMuxIsEnabled(uDeviceHandle_t cellHandle)
     return isEnabled;
 }
 
+// Set the maximum information field length.
+int32_t uCellMuxSetFrameSize(uDeviceHandle_t cellHandle,
+                             size_t informationLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if ((pInstance != NULL) &&
+            (informationLengthBytes <= U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES)) {
+            pInstance->muxInformationLengthBytes = informationLengthBytes;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get the maximum information field length.
+int32_t uCellMuxGetFrameSize(uDeviceHandle_t cellHandle)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        errorCodeOrSize = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if (pInstance != NULL) {
+            errorCodeOrSize = (int32_t) pInstance->muxInformationLengthBytes;
+            if (errorCodeOrSize == 0) {
+                errorCodeOrSize = U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrSize;
+}
+
 // Add a multiplexer channel.
 int32_t uCellMuxAddChannel(uDeviceHandle_t cellHandle,
                            int32_t channel,
@@ -1774,7 +1972,7 @@ int32_t uCellMuxAddChannel(uDeviceHandle_t cellHandle,
                         channel = pContext->channelGnss;
                     }
                     errorCode = openChannel(pContext, channel,
-                                            U_CELL_MUX_PRIVATE_VIRTUAL_SERIAL_BUFFER_LENGTH_BYTES);
+                                            receiveBufferLength(pContext));
                     if (errorCode == 0) {
 #ifdef U_CELL_MUX_ENABLE_DEBUG
                         uPortLog("U_CELL_CMUX_%d: channel added.\n", channel);
@@ -1825,6 +2023,169 @@ uDeviceSerial_t *pUCellMuxChannelGetDeviceSerial(uDeviceHandle_t cellHandle,
     return pDeviceSerial;
 }
 
+// Get the statistics for a multiplexer channel.
+int32_t uCellMuxGetChannelStats(uDeviceHandle_t cellHandle,
+                                int32_t channel,
+                                uCellMuxChannelStats_t *pStats)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uCellMuxPrivateContext_t *pContext;
+    uCellMuxPrivateChannelContext_t *pChannelContext;
+    int32_t nowMs;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if ((pInstance != NULL) && (pStats != NULL) &&
+            ((channel <= U_CELL_MUX_PRIVATE_ADDRESS_MAX) ||
+             (channel == U_CELL_MUX_CHANNEL_ID_GNSS))) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+            if (pInstance->pMuxContext != NULL) {
+                pContext = (uCellMuxPrivateContext_t *) pInstance->pMuxContext;
+                if (pContext->savedAtHandle != NULL) {
+                    if (channel == U_CELL_MUX_CHANNEL_ID_GNSS) {
+                        channel = pContext->channelGnss;
+                    }
+                    errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+                    pChannelContext = (uCellMuxPrivateChannelContext_t *) pUInterfaceContext(
+                                          pUCellMuxPrivateGetDeviceSerial(pContext, (uint8_t) channel));
+                    if (pChannelContext != NULL) {
+                        *pStats = pChannelContext->stats;
+                        // Include any flow control off period that is
+                        // still in progress
+                        nowMs = uPortGetTickTimeMs();
+                        if (pChannelContext->rxFlowControlOffStartMs >= 0) {
+                            pStats->rxFlowControlOffMs += nowMs - pChannelContext->rxFlowControlOffStartMs;
+                        }
+                        if (pChannelContext->txFlowControlOffStartMs >= 0) {
+                            pStats->txFlowControlOffMs += nowMs - pChannelContext->txFlowControlOffStartMs;
+                        }
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Open the multiplexer data channel.
+int32_t uCellMuxDataOpen(uDeviceHandle_t cellHandle,
+                         const char *pCommand,
+                         uDeviceSerial_t **ppDeviceSerial)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uCellMuxPrivateContext_t *pContext;
+    uDeviceSerial_t *pDeviceSerial;
+    // Enough for the command plus the terminators
+    char buffer[U_CELL_MUX_DATA_COMMAND_MAX_LENGTH_BYTES + 2];
+    int32_t length = -1;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if (pCommand != NULL) {
+            length = snprintf(buffer, sizeof(buffer), "%s\r", pCommand);
+        }
+        if ((pInstance != NULL) && (length > 0) && (length < (int32_t) sizeof(buffer)) &&
+            (ppDeviceSerial != NULL)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+            if (pInstance->pMuxContext != NULL) {
+                pContext = (uCellMuxPrivateContext_t *) pInstance->pMuxContext;
+                if (pContext->savedAtHandle != NULL) {
+                    errorCode = openChannel(pContext, pContext->channelPpp,
+                                            receiveBufferLength(pContext));
+                    if (errorCode == 0) {
+                        pDeviceSerial = pUCellMuxPrivateGetDeviceSerial(pContext,
+                                                                        pContext->channelPpp);
+                        // Send the command, which will switch the
+                        // channel into data mode
+                        errorCode = pDeviceSerial->write(pDeviceSerial, buffer, length);
+                        if (errorCode == length) {
+                            errorCode = waitConnect(pDeviceSerial);
+                        } else if (errorCode >= 0) {
+                            errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+                        }
+                        if (errorCode == 0) {
+#ifdef U_CELL_MUX_ENABLE_DEBUG
+                            uPortLog("U_CELL_CMUX_%d: data channel connected.\n",
+                                     pContext->channelPpp);
+#endif
+                            *ppDeviceSerial = pDeviceSerial;
+                        } else {
+                            // Clean up on error
+                            uCellMuxPrivateCloseChannel(pContext, pContext->channelPpp);
+                        }
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Open a multiplexer channel for PPP.
+int32_t uCellMuxPppOpen(uDeviceHandle_t cellHandle,
+                        uDeviceSerial_t **ppDeviceSerial)
+{
+    char buffer[16];
+
+    // Dial the PDP context
+    snprintf(buffer, sizeof(buffer), "ATD*99***%d#", U_CELL_NET_CONTEXT_ID);
+
+    return uCellMuxDataOpen(cellHandle, buffer, ppDeviceSerial);
+}
+
+// Close the multiplexer data channel.
+int32_t uCellMuxDataClose(uDeviceHandle_t cellHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uCellMuxPrivateContext_t *pContext;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if (pInstance != NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (pInstance->pMuxContext != NULL) {
+                pContext = (uCellMuxPrivateContext_t *) pInstance->pMuxContext;
+                if ((pContext->savedAtHandle != NULL) &&
+                    (pUCellMuxPrivateGetDeviceSerial(pContext, pContext->channelPpp) != NULL)) {
+                    uCellMuxPrivateCloseChannel(pContext, pContext->channelPpp);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Close the PPP multiplexer channel.
+int32_t uCellMuxPppClose(uDeviceHandle_t cellHandle)
+{
+    return uCellMuxDataClose(cellHandle);
+}
+
 // Remove a multiplexer channel.
 int32_t uCellMuxRemoveChannel(uDeviceHandle_t cellHandle,
                               uDeviceSerial_t *pDeviceSerial)
@@ -353,10 +353,23 @@ int32_t uCellMuxPrivateParseCmux(uParseHandle_t parseHandle, void *pUserParam)
     if (bytesAvailable(parseHandle, pContextParser) < (size_t) informationLengthBytes + 2) {
         return U_ERROR_COMMON_TIMEOUT;
     }
+    if ((pContextParser->pInformationDestination != NULL) && (getDiscard(parseHandle) == 0)) {
+        // Let the caller decide where the information field should go
+        pContextParser->pInformationDestination(pContextParser, address, type,
+                                                informationLengthBytes,
+                                                pContextParser->pInformationDestinationParam);
+    }
     for (size_t y = 0; y < informationLengthBytes; y++) {
         getByte(parseHandle, pContextParser, &x);
-        if ((pContextParser->pInformation != NULL) && (y < pContextParser->informationLengthBytes)) {
-            *(pContextParser->pInformation + y) = (char) x;
+        if (y < pContextParser->informationLengthBytes) {
+            if (pContextParser->pInformation != NULL) {
+                *(pContextParser->pInformation + y) = (char) x;
+            }
+        } else if ((pContextParser->pInformation2 != NULL) &&
+                   (y < pContextParser->informationLengthBytes +
+                    pContextParser->information2LengthBytes)) {
+            *(pContextParser->pInformation2 + y -
+              pContextParser->informationLengthBytes) = (char) x;
         }
         if (type != U_CELL_MUX_PRIVATE_FRAME_TYPE_UIH) {
             fcs = gFcsTable[fcs ^ x];
@@ -365,6 +378,10 @@ int32_t uCellMuxPrivateParseCmux(uParseHandle_t parseHandle, void *pUserParam)
     getByte(parseHandle, pContextParser, &x);
     // 0xCF is the reversed order of 11110011
     if (gFcsTable[fcs ^ x] != 0xCF) {
+        if (getDiscard(parseHandle) == 0) {
+            pContextParser->fcsError = true;
+            pContextParser->fcsErrorAddress = address;
+        }
         return U_ERROR_COMMON_NOT_FOUND;
     }
     getByte(parseHandle, pContextParser, &x);
@@ -467,10 +484,14 @@ int32_t uCellMuxPrivateCopyAtClient(uAtClientHandle_t atHandleSource,
             pUrcPrefixRoot = pUrcPrefixRoot->pNext;
             uPortFree(pUrcPrefixTmp);
         }
-        // Copy the URC handlers into the now-empty-of-URC-handlers destination AT handler
+        // Copy the URC handlers into the now-empty-of-URC-handlers destination
+        // AT handler, keeping their priority classes
         for (int32_t x = uAtClientUrcHandlerGetFirst(atHandleSource, &pString, &pUrcHandler,
                                                      &pHandlerParam);
-             (x >= 0) && (uAtClientSetUrcHandler(atHandleDestination, pString, pUrcHandler, pHandlerParam) == 0);
+             (x >= 0) &&
+             (uAtClientSetUrcHandlerExt(atHandleDestination, pString, pUrcHandler, pHandlerParam,
+                                        (uAtClientUrcPriority_t) uAtClientUrcHandlerPriorityGet(atHandleSource,
+                                                pString)) == 0);
              x = uAtClientUrcHandlerGetNext(atHandleSource, &pString, &pUrcHandler, &pHandlerParam)) {
         }
 
@@ -480,6 +501,7 @@ int32_t uCellMuxPrivateCopyAtClient(uAtClientHandle_t atHandleSource,
         uAtClientTimeoutSet(atHandleDestination, uAtClientTimeoutGet(atHandleSource));
         uAtClientDelimiterSet(atHandleDestination, uAtClientDelimiterGet(atHandleSource));
         uAtClientDelaySet(atHandleDestination, uAtClientDelayGet(atHandleSource));
+        uAtClientEventDrivenSet(atHandleDestination, uAtClientEventDrivenGet(atHandleSource));
         a = uAtClientGetActivityPinSettings(atHandleSource, &b, &c, &d);
         uAtClientSetActivityPin(atHandleDestination, a, b, c, d);
 
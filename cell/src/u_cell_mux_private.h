@@ -52,6 +52,10 @@ extern "C" {
 # define U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES 128
 #endif
 
+#if U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES > U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES
+#error U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES is greater than U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES
+#endif
+
 #ifndef U_CELL_MUX_PRIVATE_VIRTUAL_SERIAL_BUFFER_LENGTH_BYTES
 /** A suggested length for the buffer which a virtual serial port
  * should use for receiving data from the cellular module, e.g.
@@ -104,7 +108,7 @@ extern "C" {
 /** The length of the raw buffer, enough to store at least
  * one maximum-length CMUX frame on each channel.
  */
-# define U_CELL_MUX_PRIVATE_BUFFER_LENGTH_BYTES ((U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES +  \
+# define U_CELL_MUX_PRIVATE_BUFFER_LENGTH_BYTES ((U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES +        \
                                                   U_CELL_MUX_PRIVATE_FRAME_OVERHEAD_MAX_BYTES)       \
                                                   * U_CELL_MUX_MAX_CHANNELS)
 #endif
@@ -141,7 +145,7 @@ extern "C" {
  * present per channel in a given MCS frame, so (5 + 7) * 2 * 3) and
  * must be at least as big as #U_CELL_MUX_PRIVATE_CONTROL_CHANNEL_BUFFER_LENGTH_BYTES.
  */
-# define U_CELL_MUX_PRIVATE_HOLDING_BUFFER_LENGTH_BYTES_X ((U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES + \
+# define U_CELL_MUX_PRIVATE_HOLDING_BUFFER_LENGTH_BYTES_X ((U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES + \
                                                             U_CELL_MUX_PRIVATE_FRAME_OVERHEAD_MAX_BYTES) / 2)
 # if U_CELL_MUX_PRIVATE_HOLDING_BUFFER_LENGTH_BYTES_X < U_CELL_MUX_PRIVATE_CONTROL_CHANNEL_BUFFER_LENGTH_BYTES
 #  define U_CELL_MUX_PRIVATE_HOLDING_BUFFER_LENGTH_BYTES U_CELL_MUX_PRIVATE_CONTROL_CHANNEL_BUFFER_LENGTH_BYTES
@@ -157,8 +161,8 @@ extern "C" {
  * the stack.  It must be at least as big as the maximum information
  * field length and the maximum control channel buffer length.
  */
-# if U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES > U_CELL_MUX_PRIVATE_CONTROL_CHANNEL_BUFFER_LENGTH_BYTES
-#  define U_CELL_MUX_PRIVATE_SCRATCH_BUFFER_LENGTH_BYTES U_CELL_MUX_PRIVATE_INFORMATION_LENGTH_MAX_BYTES
+# if U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES > U_CELL_MUX_PRIVATE_CONTROL_CHANNEL_BUFFER_LENGTH_BYTES
+#  define U_CELL_MUX_PRIVATE_SCRATCH_BUFFER_LENGTH_BYTES U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES
 # else
 #  define U_CELL_MUX_PRIVATE_SCRATCH_BUFFER_LENGTH_BYTES U_CELL_MUX_PRIVATE_CONTROL_CHANNEL_BUFFER_LENGTH_BYTES
 # endif
@@ -217,7 +221,7 @@ typedef enum {
 
 /** The input/output structure for parsing some input data in search of a CMUX frame.
  */
-typedef struct {
+typedef struct uCellMuxPrivateParserContext_t {
     uint8_t address; /**< set this to the wanted address field, which could be
                           #U_CELL_MUX_PRIVATE_ADDRESS_ANY; the decoding
                           process will set it to the decoded address of a CMUX
@@ -237,6 +241,33 @@ typedef struct {
                                         This may be more than the size of pInformation,
                                         though the buffer size of pInformation will always
                                         be respected. */
+    char *pInformation2; /**< a second piece of storage for the information field, used
+                              once pInformation is full, e.g. the start of a ring buffer
+                              where pInformation is the end of it; may be NULL. */
+    size_t information2LengthBytes; /**< set this to the amount of storage at pInformation2;
+                                         it is not modified by the decoding process. */
+    void (*pInformationDestination) (struct uCellMuxPrivateParserContext_t *,
+                                     uint8_t, uCellMuxPrivateFrameType_t,
+                                     size_t, void *); /**< if not NULL this will be called,
+                                                           with this structure, the
+                                                           address, the frame type, the
+                                                           information field length and
+                                                           pInformationDestinationParam,
+                                                           once the header of a complete
+                                                           frame has been decoded with
+                                                           nothing discarded before
+                                                           it; it may
+                                                           set pInformation,
+                                                           informationLengthBytes,
+                                                           pInformation2 and
+                                                           information2LengthBytes so
+                                                           that the information field
+                                                           is decoded directly to where
+                                                           it is needed. */
+    void *pInformationDestinationParam; /**< passed to pInformationDestination. */
+    bool fcsError; /**< set to true if a frame found with nothing discarded before it
+                        failed its FCS check, in which case fcsErrorAddress is set. */
+    uint8_t fcsErrorAddress; /**< the address of the frame that failed its FCS check. */
     char *pBuffer;       /**< a buffer to be decoded; may be NULL if the source of
                               information to be decoded is actually a ring-buffer (which
                               works differently, see uCellMuxPrivateParseCmux()). */
@@ -254,6 +285,8 @@ typedef struct {
     uAtClientHandle_t savedAtHandle; /**< the AT client handle we were using in normal mode. */
     int32_t underlyingStreamHandle; /**< the handle of the stream [UART] that the MUX is running on. */
     uint8_t channelGnss; /**< the CMUX channel to use for GNSS. */
+    uint8_t channelPpp; /**< the CMUX channel to use for PPP. */
+    size_t informationLengthMaxBytes; /**< N1, the maximum information field length in use. */
     uDeviceSerial_t *pDeviceSerial[U_CELL_MUX_MAX_CHANNELS]; /**< the channels. */
     uRingBuffer_t ringBuffer; /**< the ring buffer where we put the stream from the cellular module,
                                    generic version. */
@@ -305,6 +338,9 @@ typedef struct {
     uPortMutexHandle_t mutex;
     uCellMuxPrivateTraffic_t traffic;
     uCellMuxPrivateEventCallback_t eventCallback;
+    uCellMuxChannelStats_t stats;
+    int32_t rxFlowControlOffStartMs; /**< when we asked for flow control off, -1 if not. */
+    int32_t txFlowControlOffStartMs; /**< when the module asked for flow control off, -1 if not. */
 } uCellMuxPrivateChannelContext_t;
 
 /* ----------------------------------------------------------------
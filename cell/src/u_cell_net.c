@@ -63,6 +63,7 @@
 #include "u_cell_mno_db.h"
 
 #include "u_cell_pwr_private.h"
+#include "u_cell_net_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -116,6 +117,15 @@ typedef struct {
     void *pCallbackParameter;
 } uCellNetRegistationStatus_t;
 
+/** Context for uCellNetDeepScanRanked().
+ */
+typedef struct {
+    uCellNetCellInfo_t *pTable;
+    size_t numEntries;
+    size_t count;
+    bool (*pKeepGoingCallback) (uDeviceHandle_t);
+} uCellNetDeepScanRanked_t;
+
 /** All the parameters for the base station connection status callback.
  */
 typedef struct {
@@ -663,11 +673,11 @@ static void UUPSDD_urc(uAtClientHandle_t atHandle,
 {
     uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
 
-    // Skip the parameter; we don't care since we only ever
-    // activate a single internal profile
-    uAtClientSkipParameters(atHandle, 1);
-
-    if (pInstance->profileState == U_CELL_PRIVATE_PROFILE_STATE_SHOULD_BE_UP) {
+    // Only the profile of the default context is reactivated
+    // automatically, those activated with uCellNetActivateContext()
+    // are left to the application
+    if ((uAtClientReadInt(atHandle) == U_CELL_NET_PROFILE_ID) &&
+        (pInstance->profileState == U_CELL_PRIVATE_PROFILE_STATE_SHOULD_BE_UP)) {
         // Set the state so that, should we re-register with the network,
         // we will reactivate the internal profile
         pInstance->profileState = U_CELL_PRIVATE_PROFILE_STATE_REQUIRES_REACTIVATION;
@@ -744,6 +754,17 @@ static int32_t radioOff(uCellPrivateInstance_t *pInstance)
     return errorCode;
 }
 
+// Register the URC handlers for registration and context loss.
+static void setUrcHandlers(uCellPrivateInstance_t *pInstance)
+{
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+
+    uAtClientSetUrcHandler(atHandle, "+CREG:", CREG_urc, pInstance);
+    uAtClientSetUrcHandler(atHandle, "+CGREG:", CGREG_urc, pInstance);
+    uAtClientSetUrcHandler(atHandle, "+CEREG:", CEREG_urc, pInstance);
+    uAtClientSetUrcHandler(atHandle, "+UUPSDD:", UUPSDD_urc, pInstance);
+}
+
 // Prepare for connection with the network.
 static int32_t prepareConnect(uCellPrivateInstance_t *pInstance)
 {
@@ -755,10 +776,7 @@ static int32_t prepareConnect(uCellPrivateInstance_t *pInstance)
     uPortLog("U_CELL_NET: preparing to register/connect...\n");
 
     // Register the URC handlers
-    uAtClientSetUrcHandler(atHandle, "+CREG:", CREG_urc, pInstance);
-    uAtClientSetUrcHandler(atHandle, "+CGREG:", CGREG_urc, pInstance);
-    uAtClientSetUrcHandler(atHandle, "+CEREG:", CEREG_urc, pInstance);
-    uAtClientSetUrcHandler(atHandle, "+UUPSDD:", UUPSDD_urc, pInstance);
+    setUrcHandlers(pInstance);
 
     // Switch on the unsolicited result codes for registration
     // and also ask for the additional parameters <lac>, <ci> and
@@ -993,6 +1011,141 @@ static int32_t readNextScanItem(uCellPrivateInstance_t *pInstance,
     return errorCodeOrNumber;
 }
 
+// Copy a list of network scan results, returning zero on success
+// or negative error code.
+static int32_t scanCopy(const uCellPrivateNet_t *pSource,
+                        uCellPrivateNet_t **ppDestination)
+{
+    int32_t errorCodeOrNumber = 0;
+    uCellPrivateNet_t *pNet;
+    uCellPrivateNet_t **ppStart = ppDestination;
+
+    while ((pSource != NULL) && (errorCodeOrNumber >= 0)) {
+        errorCodeOrNumber = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pNet = (uCellPrivateNet_t *) pUPortMalloc(sizeof(*pNet));
+        if (pNet != NULL) {
+            *pNet = *pSource;
+            pNet->pNext = NULL;
+            *ppDestination = pNet;
+            ppDestination = &(pNet->pNext);
+            errorCodeOrNumber = 0;
+        }
+        pSource = pSource->pNext;
+    }
+
+    if (errorCodeOrNumber < 0) {
+        // Don't leave a partial list behind
+        uCellPrivateScanFree(ppStart);
+    }
+
+    return errorCodeOrNumber;
+}
+
+// Query the registration status of one of gRegTypes[] with
+// AT+CxREG? and update the status held in pInstance accordingly,
+// returning the outcome of the AT command.
+static int32_t queryRegistration(uCellPrivateInstance_t *pInstance,
+                                 int32_t regType)
+{
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+    int32_t firstInt;
+    int32_t status3gpp;
+    uCellNetStatus_t status = U_CELL_NET_STATUS_UNKNOWN;
+    int32_t skippedParameters = 1;
+    int32_t rat = (int32_t) U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED;
+    bool gotUrc;
+    char buffer[U_CELL_PRIVATE_CELL_ID_LOGICAL_SIZE + 1]; // +1 for terminator
+
+    uAtClientLock(atHandle);
+    uAtClientTimeoutSet(atHandle,
+                        pInstance->pModule->responseMaxWaitMs);
+    uAtClientCommandStart(atHandle, gRegTypes[regType].pQueryStr);
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, gRegTypes[regType].pResponseStr);
+    // It is possible for the module to spit-out
+    // a "+CxREG: y" URC while we're waiting for
+    // the "+CxREG: x,y" response from the AT+CxREG
+    // command. So the first integer might either by the mode
+    // we set, <n>, being sent back to us or it might be the
+    // <status> value of the URC.  The dodge to distinguish the
+    // two is based on the fact that our values for <n> match status
+    // values that mean "not registered", so we can do this:
+    // (a) if the first integer matches the <n>/mode
+    //     parameter from the AT+CxREG=<n>,... command, then either
+    //     i)  this is the response we were expecting and
+    //         the status etc. parameters follow, or,
+    //     ii) this is a URC with a value indicating we are not
+    //         registered and hence will not be followed
+    //         by any further parameters,
+    // (b) if the first integer does not match <n> then this
+    //     is a URC and the first integer is the <status> value.
+
+    gotUrc = false;
+    firstInt = uAtClientReadInt(atHandle);
+    status3gpp = uAtClientReadInt(atHandle);
+    if ((firstInt == U_CELL_NET_CREG_OR_CGREG_TYPE) ||
+        (firstInt == U_CELL_NET_CEREG_TYPE)) {
+        // case (a.i) or (a.ii)
+        if (status3gpp < 0) {
+            // case (a.ii)
+            gotUrc = true;
+            status3gpp = firstInt;
+            uAtClientClearError(atHandle);
+        }
+    } else {
+        // case (b), it's the URC
+        gotUrc = true;
+        status3gpp = firstInt;
+    }
+    if (gotUrc) {
+        // Read the actual response, which should follow
+        uAtClientResponseStart(atHandle,
+                               gRegTypes[regType].pResponseStr);
+        uAtClientReadInt(atHandle);
+        status3gpp = uAtClientReadInt(atHandle);
+    }
+    if ((status3gpp >= 0) &&
+        (status3gpp < (int32_t) (sizeof(g3gppStatusToCellStatus) /
+                                 sizeof(g3gppStatusToCellStatus[0])))) {
+        status = g3gppStatusToCellStatus[status3gpp];
+    }
+    if (U_CELL_NET_STATUS_MEANS_REGISTERED(status)) {
+        // Skip <lac>/<tac>
+        if ((regType == 2 /* CEREG */) && (gRegTypes[regType].type == 4) &&
+            (((pInstance->pModule->moduleType ==
+               U_CELL_MODULE_TYPE_SARA_R410M_02B) ||
+              (pInstance->pModule->moduleType ==
+               U_CELL_MODULE_TYPE_SARA_R412M_02B)) ||
+             ((pInstance->pModule->moduleType == U_CELL_MODULE_TYPE_LARA_R6) &&
+              !gotUrc))) {
+            // SARA-R41x-02B modules, and LARA-R6 modules but only in the
+            // non-URC case, sneak an extra <rac_or_mme> parameter in between
+            // <tac> and <ci> when U_CELL_NET_CEREG_TYPE is 4 so we need to
+            // skip an additional parameter
+            skippedParameters++;
+        }
+        uAtClientSkipParameters(atHandle, skippedParameters);
+        // Read CI, which is hex, encoded as an 8-digit string
+        if (uAtClientReadString(atHandle, buffer, sizeof(buffer), false) > 0) {
+            pInstance->radioParameters.cellIdLogical = strtol(buffer, NULL, 16);
+        }
+        // Read the RAT that we're on
+        rat = uAtClientReadInt(atHandle);
+        if ((rat < 0) && (regType == 2 /* CEREG */)) {
+            // LARA-R6 sometime misses out the RAT in the +CEREG
+            // response; we need something...
+            rat = 7; // LTE
+        }
+    }
+    // Set the status
+    setNetworkStatus(pInstance, status, rat,
+                     gRegTypes[regType].domain,
+                     false);
+    uAtClientResponseStop(atHandle);
+
+    return uAtClientUnlock(atHandle);
+}
+
 // Register with the cellular network
 static int32_t registerNetwork(uCellPrivateInstance_t *pInstance,
                                const char *pMccMnc)
@@ -1002,14 +1155,9 @@ static int32_t registerNetwork(uCellPrivateInstance_t *pInstance,
     bool keepGoing = true;
     bool deviceErrorDetected = false;
     int32_t regType;
-    int32_t firstInt;
-    int32_t status3gpp;
-    uCellNetStatus_t status;
-    int32_t skippedParameters = 1;
-    int32_t rat = (int32_t) U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED;
-    bool gotUrc;
     size_t errorCount = 0;
-    char buffer[U_CELL_PRIVATE_CELL_ID_LOGICAL_SIZE + 1]; // +1 for terminator
+    int32_t lastQueryTimeMs;
+    bool queryNow;
 
     // Come out of airplane mode and try to register
     // Wait for flip time to expire first though
@@ -1081,99 +1229,21 @@ static int32_t registerNetwork(uCellPrivateInstance_t *pInstance,
         // Wait for registration to succeed
         errorCode = (int32_t) U_CELL_ERROR_NOT_REGISTERED;
         regType = 0;
+        lastQueryTimeMs = uPortGetTickTimeMs();
         while (keepGoing && keepGoingLocalCb(pInstance) &&
                !uCellPrivateIsRegistered(pInstance)) {
+            // With polling off, only send a query once in a
+            // while in case a +CxREG URC has been missed
+            queryNow = !pInstance->registrationPollingOff ||
+                       (uPortGetTickTimeMs() - lastQueryTimeMs >=
+                        U_CELL_NET_REGISTRATION_URC_FALLBACK_QUERY_MS);
             // Prod the modem anyway, we've nout much else to do
             // We use each of the AT+CxREG? query types,
             // one at a time.
-            if (gRegTypes[regType].supportedRatsBitmap &
-                pInstance->pModule->supportedRatsBitmap) {
-                status = U_CELL_NET_STATUS_UNKNOWN;
-                uAtClientLock(atHandle);
-                uAtClientTimeoutSet(atHandle,
-                                    pInstance->pModule->responseMaxWaitMs);
-                uAtClientCommandStart(atHandle, gRegTypes[regType].pQueryStr);
-                uAtClientCommandStop(atHandle);
-                uAtClientResponseStart(atHandle, gRegTypes[regType].pResponseStr);
-                // It is possible for the module to spit-out
-                // a "+CxREG: y" URC while we're waiting for
-                // the "+CxREG: x,y" response from the AT+CxREG
-                // command. So the first integer might either by the mode
-                // we set, <n>, being sent back to us or it might be the
-                // <status> value of the URC.  The dodge to distinguish the
-                // two is based on the fact that our values for <n> match status
-                // values that mean "not registered", so we can do this:
-                // (a) if the first integer matches the <n>/mode
-                //     parameter from the AT+CxREG=<n>,... command, then either
-                //     i)  this is the response we were expecting and
-                //         the status etc. parameters follow, or,
-                //     ii) this is a URC with a value indicating we are not
-                //         registered and hence will not be followed
-                //         by any further parameters,
-                // (b) if the first integer does not match <n> then this
-                //     is a URC and the first integer is the <status> value.
-
-                gotUrc = false;
-                firstInt = uAtClientReadInt(atHandle);
-                status3gpp = uAtClientReadInt(atHandle);
-                if ((firstInt == U_CELL_NET_CREG_OR_CGREG_TYPE) ||
-                    (firstInt == U_CELL_NET_CEREG_TYPE)) {
-                    // case (a.i) or (a.ii)
-                    if (status3gpp < 0) {
-                        // case (a.ii)
-                        gotUrc = true;
-                        status3gpp = firstInt;
-                        uAtClientClearError(atHandle);
-                    }
-                } else {
-                    // case (b), it's the URC
-                    gotUrc = true;
-                    status3gpp = firstInt;
-                }
-                if (gotUrc) {
-                    // Read the actual response, which should follow
-                    uAtClientResponseStart(atHandle,
-                                           gRegTypes[regType].pResponseStr);
-                    uAtClientReadInt(atHandle);
-                    status3gpp = uAtClientReadInt(atHandle);
-                }
-                if ((status3gpp >= 0) &&
-                    (status3gpp < (int32_t) (sizeof(g3gppStatusToCellStatus) /
-                                             sizeof(g3gppStatusToCellStatus[0])))) {
-                    status = g3gppStatusToCellStatus[status3gpp];
-                }
-                if (U_CELL_NET_STATUS_MEANS_REGISTERED(status)) {
-                    // Skip <lac>/<tac>
-                    if ((regType == 2 /* CEREG */) && (gRegTypes[regType].type == 4) &&
-                        (((pInstance->pModule->moduleType == U_CELL_MODULE_TYPE_SARA_R410M_02B) ||
-                          (pInstance->pModule->moduleType == U_CELL_MODULE_TYPE_SARA_R412M_02B)) ||
-                         ((pInstance->pModule->moduleType == U_CELL_MODULE_TYPE_LARA_R6) &&
-                          !gotUrc))) {
-                        // SARA-R41x-02B modules, and LARA-R6 modules but only in the
-                        // non-URC case, sneak an extra <rac_or_mme> parameter in between
-                        // <tac> and <ci> when U_CELL_NET_CEREG_TYPE is 4 so we need to
-                        // skip an additional parameter
-                        skippedParameters++;
-                    }
-                    uAtClientSkipParameters(atHandle, skippedParameters);
-                    // Read CI, which is hex, encoded as an 8-digit string
-                    if (uAtClientReadString(atHandle, buffer, sizeof(buffer), false) > 0) {
-                        pInstance->radioParameters.cellIdLogical = strtol(buffer, NULL, 16);
-                    }
-                    // Read the RAT that we're on
-                    rat = uAtClientReadInt(atHandle);
-                    if ((rat < 0) && (regType == 2 /* CEREG */)) {
-                        // LARA-R6 sometime misses out the RAT in the +CEREG
-                        // response; we need something...
-                        rat = 7; // LTE
-                    }
-                }
-                // Set the status
-                setNetworkStatus(pInstance, status, rat,
-                                 gRegTypes[regType].domain,
-                                 false);
-                uAtClientResponseStop(atHandle);
-                if (uAtClientUnlock(atHandle) != 0) {
+            if (queryNow && (gRegTypes[regType].supportedRatsBitmap &
+                             pInstance->pModule->supportedRatsBitmap)) {
+                lastQueryTimeMs = uPortGetTickTimeMs();
+                if (queryRegistration(pInstance, regType) != 0) {
                     // We're prodding the module pretty often
                     // while it is busy, it is possible for
                     // the responses to fall outside of the
@@ -1192,6 +1262,10 @@ static int32_t registerNetwork(uCellPrivateInstance_t *pInstance,
             if (regType >= (int32_t) (sizeof(gRegTypes) / sizeof(gRegTypes[0]))) {
                 regType = 0;
             }
+            if (!queryNow) {
+                // Rely on the +CxREG URCs to update the status
+                uPortTaskBlock(U_CELL_NET_REGISTRATION_URC_CHECK_INTERVAL_MS);
+            }
         }
     }
 
@@ -1675,11 +1749,13 @@ static int32_t deactivate(uCellPrivateInstance_t *pInstance,
     uAtClientHandle_t atHandle = pInstance->atHandle;
 
     if (isActive(pInstance, contextId)) {
-        pInstance->profileState = U_CELL_PRIVATE_PROFILE_STATE_SHOULD_BE_DOWN;
+        if (contextId == U_CELL_NET_CONTEXT_ID) {
+            pInstance->profileState = U_CELL_PRIVATE_PROFILE_STATE_SHOULD_BE_DOWN;
+        }
         uAtClientLock(atHandle);
         uAtClientCommandStart(atHandle, "AT+CGACT=");
         uAtClientWriteInt(atHandle, 0);
-        uAtClientWriteInt(atHandle, U_CELL_NET_CONTEXT_ID);
+        uAtClientWriteInt(atHandle, contextId);
         uAtClientCommandStopReadResponse(atHandle);
         errorCode = uAtClientUnlock(atHandle);
     }
@@ -1696,10 +1772,12 @@ static  int32_t deactivateUpsd(uCellPrivateInstance_t *pInstance,
     uAtClientHandle_t atHandle = pInstance->atHandle;
 
     if (isActiveUpsd(pInstance, profileId)) {
-        pInstance->profileState = U_CELL_PRIVATE_PROFILE_STATE_SHOULD_BE_DOWN;
+        if (profileId == U_CELL_NET_PROFILE_ID) {
+            pInstance->profileState = U_CELL_PRIVATE_PROFILE_STATE_SHOULD_BE_DOWN;
+        }
         uAtClientLock(atHandle);
         uAtClientCommandStart(atHandle, "AT+UPSDA=");
-        uAtClientWriteInt(atHandle, U_CELL_NET_PROFILE_ID);
+        uAtClientWriteInt(atHandle, profileId);
         uAtClientWriteInt(atHandle, 4);
         uAtClientCommandStopReadResponse(atHandle);
         errorCode = uAtClientUnlock(atHandle);
@@ -1708,6 +1786,95 @@ static  int32_t deactivateUpsd(uCellPrivateInstance_t *pInstance,
     return errorCode;
 }
 
+// Return the IP address of the given PDP context/profile.
+static int32_t getIpAddressStr(const uCellPrivateInstance_t *pInstance,
+                               int32_t contextId, int32_t profileId,
+                               char *pStr)
+{
+    int32_t errorCodeOrSize = (int32_t) U_CELL_ERROR_NOT_CONNECTED;
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+    bool active;
+    char *pBuffer = NULL;
+    int32_t bytesRead = -1;
+
+    // First check if the context is active
+    if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                           U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
+        active = isActiveUpsd(pInstance, profileId);
+    } else {
+        active = isActive(pInstance, contextId);
+    }
+    if (active) {
+        errorCodeOrSize = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        // Malloc() memory for this rather than put it on
+        // the stack as IPV6 addresses can be quite big
+        pBuffer = (char *) pUPortMalloc(U_CELL_NET_IP_ADDRESS_SIZE);
+        if (pBuffer != NULL) {
+            // Try this a few times: I have seen
+            // "AT+CGPADDR= 1," returned on rare occasions
+            for (size_t x = 3; (x > 0) && (errorCodeOrSize <= 0); x--) {
+                *pBuffer = '\0'; // In case we read zero bytes successfully
+                uAtClientLock(atHandle);
+                if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                       U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
+                    uAtClientCommandStart(atHandle, "AT+UPSND=");
+                    uAtClientWriteInt(atHandle, profileId);
+                    uAtClientWriteInt(atHandle, 0);
+                    uAtClientCommandStop(atHandle);
+                    uAtClientResponseStart(atHandle, "+UPSND:");
+                    // Skip the echo of the profile ID and command
+                    uAtClientSkipParameters(atHandle, 2);
+                    // Read the IP address.
+                    bytesRead = uAtClientReadString(atHandle, pBuffer,
+                                                    U_CELL_NET_IP_ADDRESS_SIZE,
+                                                    false);
+                } else {
+                    uAtClientCommandStart(atHandle, "AT+CGPADDR=");
+                    uAtClientWriteInt(atHandle, contextId);
+                    uAtClientCommandStop(atHandle);
+                    uAtClientResponseStart(atHandle, "+CGPADDR:");
+                    // Skip the context ID
+                    uAtClientSkipParameters(atHandle, 1);
+                    // Read the IP address.
+                    bytesRead = uAtClientReadString(atHandle, pBuffer,
+                                                    U_CELL_NET_IP_ADDRESS_SIZE,
+                                                    false);
+                }
+                uAtClientResponseStop(atHandle);
+                errorCodeOrSize = uAtClientUnlock(atHandle);
+                if ((errorCodeOrSize == 0) && (bytesRead > 0)) {
+                    errorCodeOrSize = bytesRead;
+                    if (pStr != NULL) {
+                        strncpy(pStr, pBuffer, U_CELL_NET_IP_ADDRESS_SIZE);
+                    }
+                    uPortLog("U_CELL_NET: IP address \"%.*s\".\n",
+                             bytesRead, pBuffer);
+                } else {
+                    errorCodeOrSize = (int32_t) U_CELL_ERROR_AT;
+                    uPortLog("U_CELL_NET: unable to read IP address.\n");
+                    uPortTaskBlock(1000);
+                }
+            }
+
+            // Free memory
+            uPortFree(pBuffer);
+        }
+    } else {
+        uPortLog("U_CELL_NET: not connected, unable to read IP address.\n");
+    }
+
+    return errorCodeOrSize;
+}
+
+
+// Return true if contextId is a valid PDP context ID other than
+// the one used by uCellNetConnect()/uCellNetActivate().
+static bool isAdditionalContextId(int32_t contextId)
+{
+    return (contextId > 0) && (contextId <= U_CELL_NET_MAX_NUM_CONTEXTS) &&
+           (contextId != U_CELL_NET_CONTEXT_ID);
+}
+
 // When given a new APN, check if we have an existing compatible
 // PDP context and, if we don't, do something about it
 // NOTE: returns 0 (success) if the current context is adequate, else error.
@@ -2067,6 +2234,228 @@ static int32_t parseDeepScanLine(uAtClientHandle_t atHandle,
     return errorCodeOrNumber;
 }
 
+// Return true if cell A is better than cell B: stronger RSRP
+// first, then better RSRQ.
+static bool deepScanIsBetter(const uCellNetCellInfo_t *pA,
+                             const uCellNetCellInfo_t *pB)
+{
+    return (pA->rsrpDbm > pB->rsrpDbm) ||
+           ((pA->rsrpDbm == pB->rsrpDbm) && (pA->rsrqDb > pB->rsrqDb));
+}
+
+// Return true if two deep scan results are the same cell.
+static bool deepScanIsSameCell(const uCellNetCellInfo_t *pA,
+                               const uCellNetCellInfo_t *pB)
+{
+    return (pA->mcc == pB->mcc) && (pA->mnc == pB->mnc) &&
+           (pA->cellIdPhysical == pB->cellIdPhysical) &&
+           (pA->earfcnDownlink == pB->earfcnDownlink);
+}
+
+// Callback for uCellNetDeepScan(), used by uCellNetDeepScanRanked()
+// to keep a table of the best cells, best first.
+static bool deepScanRankedCallback(uDeviceHandle_t cellHandle,
+                                   uCellNetCellInfo_t *pCell,
+                                   void *pParameter)
+{
+    uCellNetDeepScanRanked_t *pContext = (uCellNetDeepScanRanked_t *) pParameter;
+    uCellNetCellInfo_t *pTable = pContext->pTable;
+    bool insert = true;
+    size_t position;
+
+    if (pCell != NULL) {
+        // A scan that is retried will report the same cells again:
+        // keep only the best report of each
+        for (size_t x = 0; (x < pContext->count) && insert; x++) {
+            if (deepScanIsSameCell(pCell, pTable + x)) {
+                insert = deepScanIsBetter(pCell, pTable + x);
+                if (insert) {
+                    memmove(pTable + x, pTable + x + 1,
+                            (pContext->count - x - 1) * sizeof(*pTable));
+                    pContext->count--;
+                }
+            }
+        }
+        if (insert) {
+            for (position = 0; (position < pContext->count) &&
+                 !deepScanIsBetter(pCell, pTable + position); position++) {}
+            if (position < pContext->numEntries) {
+                if (pContext->count < pContext->numEntries) {
+                    pContext->count++;
+                }
+                // Shuffle down, dropping the worst if the table is full
+                memmove(pTable + position + 1, pTable + position,
+                        (pContext->count - position - 1) * sizeof(*pTable));
+                *(pTable + position) = *pCell;
+            }
+        }
+    }
+
+    return (pContext->pKeepGoingCallback == NULL) ||
+           pContext->pKeepGoingCallback(cellHandle);
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: DATA COUNTERS
+ * -------------------------------------------------------------- */
+
+// Read the transmit and/or receive data counters of the default
+// context with AT+UGCNTRD.
+static int32_t readDataCounters(const uCellPrivateInstance_t *pInstance,
+                                int32_t *pBytesSent, int32_t *pBytesReceived)
+{
+    int32_t errorCode = (int32_t) U_CELL_ERROR_AT;
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+    bool ours = false;
+    int32_t bytesSent = 0;
+    int32_t bytesReceived = 0;
+    int32_t y = 0;
+
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UGCNTRD");
+    uAtClientCommandStop(atHandle);
+    for (size_t x = 0; (x < U_CELL_NET_MAX_NUM_CONTEXTS) &&
+         (y >= 0) && !ours; x++) {
+        uAtClientResponseStart(atHandle, "+UGCNTRD:");
+        // Check if this is our context ID
+        y = uAtClientReadInt(atHandle);
+        if (y == U_CELL_NET_CONTEXT_ID) {
+            ours = true;
+            // If it is, next come the sent and received
+            // counts for this session
+            bytesSent = uAtClientReadInt(atHandle);
+            bytesReceived = uAtClientReadInt(atHandle);
+        }
+    }
+    uAtClientResponseStop(atHandle);
+    if ((uAtClientUnlock(atHandle) == 0) && ours &&
+        ((pBytesSent == NULL) || (bytesSent >= 0)) &&
+        ((pBytesReceived == NULL) || (bytesReceived >= 0))) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if (pBytesSent != NULL) {
+            *pBytesSent = bytesSent;
+        }
+        if (pBytesReceived != NULL) {
+            *pBytesReceived = bytesReceived;
+        }
+    }
+
+    return errorCode;
+}
+
+// Take a sample of the data counters into the history of the
+// data counter sampler, if it is running.
+// gUCellPrivateMutex should be locked before this is called.
+static void dataCounterSample(uCellPrivateInstance_t *pInstance,
+                              bool atDeactivation)
+{
+    uCellPrivateDataCounterSampler_t *pSampler = pInstance->pDataCounterSampler;
+    uCellNetDataCounterSample_t *pSample;
+    int32_t bytesSent;
+    int32_t bytesReceived;
+
+    if ((pSampler != NULL) &&
+        (readDataCounters(pInstance, &bytesSent, &bytesReceived) == 0)) {
+        if (pSampler->count < U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH) {
+            pSample = &(pSampler->sample[(pSampler->oldest + pSampler->count) %
+                                                           U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH]);
+            pSampler->count++;
+        } else {
+            // Full: overwrite the oldest
+            pSample = &(pSampler->sample[pSampler->oldest]);
+            pSampler->oldest = (pSampler->oldest + 1) % U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH;
+        }
+        pSample->timeMs = uPortGetTickTimeMs();
+        pSample->txBytes = bytesSent;
+        pSample->rxBytes = bytesReceived;
+        pSample->atDeactivation = atDeactivation;
+    }
+}
+
+// Take a periodic sample of the data counters; called through the
+// uAtClientCallback() mechanism by dataCounterSamplerTimerCallback()
+// so that the AT interface may be used.  The parameter is the
+// cell handle, rather than the instance, since the instance may
+// have been removed by the time this is called.
+static void dataCounterSampleCallback(uAtClientHandle_t atHandle,
+                                      void *pParameter)
+{
+    uCellPrivateInstance_t *pInstance;
+
+    (void) atHandle;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance((uDeviceHandle_t) pParameter);
+        // Nothing is counted while not registered or asleep,
+        // so don't wake the module up just to ask
+        if ((pInstance != NULL) && uCellPrivateIsRegistered(pInstance) &&
+            !uCellPrivateIsDeepSleepActive(pInstance)) {
+            dataCounterSample(pInstance, false);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+}
+
+// Timer callback for the data counter sampler: since a timer
+// callback must not block, hand over to dataCounterSampleCallback().
+static void dataCounterSamplerTimerCallback(const uPortTimerHandle_t timerHandle,
+                                            void *pParam)
+{
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParam;
+
+    (void) timerHandle;
+
+    uAtClientCallback(pInstance->atHandle, dataCounterSampleCallback,
+                      (void *) pInstance->cellHandle);
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS THAT ARE PRIVATE TO CELLULAR
+ * -------------------------------------------------------------- */
+
+// Pick up the network state of a module that was already registered.
+int32_t uCellNetPrivateWarmAttach(uCellPrivateInstance_t *pInstance)
+{
+    int32_t errorCode = (int32_t) U_CELL_ERROR_NOT_REGISTERED;
+    bool active;
+
+    // The module will have been left emitting the registration
+    // URCs by whoever registered it, so we need to handle them
+    setUrcHandlers(pInstance);
+
+    // Query the packet switched registration status, EUTRAN
+    // (the last entry in gRegTypes[]) first since that is the
+    // most likely
+    for (int32_t x = (int32_t) (sizeof(gRegTypes) / sizeof(gRegTypes[0])) - 1;
+         (x >= 0) && !uCellPrivateIsRegistered(pInstance); x--) {
+        if ((gRegTypes[x].domain == U_CELL_NET_REG_DOMAIN_PS) &&
+            (gRegTypes[x].supportedRatsBitmap &
+             pInstance->pModule->supportedRatsBitmap)) {
+            queryRegistration(pInstance, x);
+        }
+    }
+
+    if (uCellPrivateIsRegistered(pInstance)) {
+        errorCode = (int32_t) U_CELL_ERROR_NOT_CONNECTED;
+        if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                               U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
+            active = isActiveUpsd(pInstance, U_CELL_NET_PROFILE_ID);
+        } else {
+            active = isActive(pInstance, U_CELL_NET_CONTEXT_ID);
+        }
+        if (active) {
+            pInstance->profileState = U_CELL_PRIVATE_PROFILE_STATE_SHOULD_BE_UP;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -2511,6 +2900,8 @@ int32_t uCellNetDeactivate(uDeviceHandle_t cellHandle,
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pInstance != NULL) {
             if (uCellPrivateIsRegistered(pInstance)) {
+                // Catch the final count of the session
+                dataCounterSample(pInstance, true);
                 rat = uCellPrivateGetActiveRat(pInstance);
                 if (U_CELL_PRIVATE_RAT_IS_EUTRAN(rat) ||
                     U_CELL_PRIVATE_MODULE_IS_SARA_R4(pInstance->pModule->moduleType)) {
@@ -2567,6 +2958,10 @@ int32_t uCellNetDisconnect(uDeviceHandle_t cellHandle,
             uAtClientResponseStop(atHandle);
             errorCode = uAtClientUnlock(atHandle);
             if ((errorCode == 0) && (status3gpp != 2)) {
+                if (uCellPrivateIsRegistered(pInstance)) {
+                    // Catch the final count of the session
+                    dataCounterSample(pInstance, true);
+                }
                 errorCode = disconnectNetwork(pInstance, pKeepGoingCallback);
             }
             if (!uCellPrivateIsRegistered(pInstance)) {
@@ -2586,23 +2981,147 @@ int32_t uCellNetDisconnect(uDeviceHandle_t cellHandle,
     return errorCode;
 }
 
-// Initiate a network scan and return the first result.
-int32_t uCellNetScanGetFirst(uDeviceHandle_t cellHandle,
-                             char *pName, size_t nameSize,
-                             char *pMccMnc, uCellNetRat_t *pRat,
-                             bool (*pKeepGoingCallback) (uDeviceHandle_t cellHandle))
+// Activate an additional PDP context.
+int32_t uCellNetActivateContext(uDeviceHandle_t cellHandle,
+                                int32_t contextId, const char *pApn,
+                                const char *pUsername,
+                                const char *pPassword)
 {
-    int32_t errorCodeOrNumber = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uCellPrivateInstance_t *pInstance;
-    uAtClientHandle_t atHandle;
-    char *pBuffer;
-    int32_t bytesRead;
-    int32_t mode;
-    int64_t innerStartTimeMs;
-    uAtClientDeviceError_t deviceError;
-    bool gotAnswer = false;
-    char *pSaved;
-    char *pStr;
+    int32_t profileId;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && isAdditionalContextId(contextId) &&
+            ((pUsername == NULL) || (pPassword != NULL))) {
+            errorCode = (int32_t) U_CELL_ERROR_NOT_REGISTERED;
+            if (uCellPrivateIsRegistered(pInstance)) {
+                profileId = U_CELL_PRIVATE_CONTEXT_ID_TO_PROFILE_ID(contextId);
+                uPortLog("U_CELL_NET: activating context %d (profile %d)",
+                         contextId, profileId);
+                if (pApn != NULL) {
+                    uPortLog(", APN \"%s\".\n", pApn);
+                } else {
+                    uPortLog(", no APN.\n");
+                }
+                // No call-back: the activation functions below
+                // will give up after U_CELL_NET_CONNECT_TIMEOUT_SECONDS
+                pInstance->pKeepGoingCallback = NULL;
+                pInstance->startTimeMs = uPortGetTickTimeMs();
+                if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                       U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
+                    // SARA-U2 style, everything through AT+UPSD
+                    errorCode = activateContextUpsd(pInstance, profileId, pApn,
+                                                    pUsername, pPassword);
+                } else {
+                    // SARA-R4/R5/R6 style: define the context,
+                    // set the authentication mode and activate it
+                    errorCode = defineContext(pInstance, contextId, pApn);
+                    if ((errorCode == 0) && (pUsername != NULL)) {
+                        errorCode = setAuthenticationMode(pInstance, contextId,
+                                                          pUsername, pPassword);
+                    }
+                    if (errorCode == 0) {
+                        errorCode = activateContext(pInstance, contextId, profileId);
+                    }
+                }
+                pInstance->startTimeMs = 0;
+                if (errorCode != 0) {
+                    uPortLog("U_CELL_NET: unable to activate context %d.\n",
+                             contextId);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Deactivate an additional PDP context.
+int32_t uCellNetDeactivateContext(uDeviceHandle_t cellHandle,
+                                  int32_t contextId)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && isAdditionalContextId(contextId)) {
+            if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                   U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
+                errorCode = deactivateUpsd(pInstance,
+                                           U_CELL_PRIVATE_CONTEXT_ID_TO_PROFILE_ID(contextId));
+            } else {
+                errorCode = deactivate(pInstance, contextId);
+            }
+            if (errorCode != 0) {
+                uPortLog("U_CELL_NET: unable to deactivate context %d.\n",
+                         contextId);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get whether a PDP context is active.
+bool uCellNetContextIsActive(uDeviceHandle_t cellHandle, int32_t contextId)
+{
+    bool active = false;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if ((pInstance != NULL) && (contextId > 0) &&
+            (contextId <= U_CELL_NET_MAX_NUM_CONTEXTS)) {
+            if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                   U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
+                active = isActiveUpsd(pInstance,
+                                      U_CELL_PRIVATE_CONTEXT_ID_TO_PROFILE_ID(contextId));
+            } else {
+                active = isActive(pInstance, contextId);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return active;
+}
+
+// Initiate a network scan and return the first result.
+int32_t uCellNetScanGetFirst(uDeviceHandle_t cellHandle,
+                             char *pName, size_t nameSize,
+                             char *pMccMnc, uCellNetRat_t *pRat,
+                             bool (*pKeepGoingCallback) (uDeviceHandle_t cellHandle))
+{
+    int32_t errorCodeOrNumber = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    char *pBuffer;
+    int32_t bytesRead;
+    int32_t mode;
+    int64_t innerStartTimeMs;
+    uAtClientDeviceError_t deviceError;
+    bool gotAnswer = false;
+    char *pSaved;
+    char *pStr;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -2616,8 +3135,29 @@ int32_t uCellNetScanGetFirst(uDeviceHandle_t cellHandle,
             // Free any previous scan results
             uCellPrivateScanFree(&(pInstance->pScanResults));
             errorCodeOrNumber = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-            // Allocate some temporary storage
-            pBuffer = (char *) pUPortMalloc(U_CELL_NET_SCAN_LENGTH_BYTES);
+            pBuffer = NULL;
+            if (pInstance->scanCached &&
+                (uPortGetTickTimeMs() - pInstance->scanCacheTimeMs <
+                 pInstance->scanCacheMaxAgeMs)) {
+                // Recent enough, just return the cached results;
+                // if the copy fails scanCopy() leaves nothing behind
+                errorCodeOrNumber = scanCopy(pInstance->pScanCache,
+                                             &(pInstance->pScanResults));
+                if (errorCodeOrNumber == 0) {
+                    errorCodeOrNumber = readNextScanItem(pInstance, pMccMnc, pName,
+                                                         nameSize, pRat);
+                    if (errorCodeOrNumber >= 0) {
+                        // readNextScanItem() returns the number left
+                        errorCodeOrNumber++;
+                    } else {
+                        // There were no networks
+                        errorCodeOrNumber = 0;
+                    }
+                }
+            } else {
+                // Allocate some temporary storage
+                pBuffer = (char *) pUPortMalloc(U_CELL_NET_SCAN_LENGTH_BYTES);
+            }
             if (pBuffer != NULL) {
                 errorCodeOrNumber = (int32_t) U_CELL_ERROR_TEMPORARY_FAILURE;
                 // Ensure that we're powered up.
@@ -2715,6 +3255,15 @@ int32_t uCellNetScanGetFirst(uDeviceHandle_t cellHandle,
                     uCellPrivateCFunMode(pInstance, mode);
                 }
                 if (gotAnswer) {
+                    if ((pInstance->scanCacheMaxAgeMs > 0) && (errorCodeOrNumber >= 0)) {
+                        // Keep a copy for next time
+                        uCellPrivateScanFree(&(pInstance->pScanCache));
+                        pInstance->scanCached = (scanCopy(pInstance->pScanResults,
+                                                          &(pInstance->pScanCache)) == 0);
+                        if (pInstance->scanCached) {
+                            pInstance->scanCacheTimeMs = uPortGetTickTimeMs();
+                        }
+                    }
                     // Return the first thing from what we stored
                     readNextScanItem(pInstance, pMccMnc, pName,
                                      nameSize, pRat);
@@ -2730,6 +3279,67 @@ int32_t uCellNetScanGetFirst(uDeviceHandle_t cellHandle,
     return errorCodeOrNumber;
 }
 
+// Perform a network scan, reporting the results through a callback.
+int32_t uCellNetScan(uDeviceHandle_t cellHandle,
+                     bool (*pCallback) (uDeviceHandle_t,
+                                        const char *,
+                                        const char *,
+                                        uCellNetRat_t,
+                                        void *),
+                     void *pCallbackParameter,
+                     bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t errorCodeOrNumber = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    char name[U_CELL_NET_MAX_NAME_LENGTH_BYTES];
+    char mccMnc[U_CELL_NET_MCC_MNC_LENGTH_BYTES];
+    uCellNetRat_t rat = U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED;
+    bool keepGoing = true;
+
+    if (pCallback != NULL) {
+        // Done outside the mutex so that pCallback may call
+        // into this API
+        errorCodeOrNumber = uCellNetScanGetFirst(cellHandle, name, sizeof(name),
+                                                 mccMnc, &rat, pKeepGoingCallback);
+        for (int32_t x = errorCodeOrNumber; (x > 0) && keepGoing; x--) {
+            keepGoing = pCallback(cellHandle, name, mccMnc, rat, pCallbackParameter);
+            if (keepGoing && (x > 1)) {
+                uCellNetScanGetNext(cellHandle, name, sizeof(name), mccMnc, &rat);
+            }
+        }
+        uCellNetScanGetLast(cellHandle);
+    }
+
+    return errorCodeOrNumber;
+}
+
+// Set the maximum age of cached network scan results.
+int32_t uCellNetSetScanCacheMaxAge(uDeviceHandle_t cellHandle,
+                                   int32_t maxAgeMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (maxAgeMs >= 0)) {
+            pInstance->scanCacheMaxAgeMs = maxAgeMs;
+            if (maxAgeMs == 0) {
+                uCellPrivateScanFree(&(pInstance->pScanCache));
+                pInstance->scanCached = false;
+            }
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
 // Return subsequent results from a network scan.
 int32_t uCellNetScanGetNext(uDeviceHandle_t cellHandle,
                             char *pName, size_t nameSize,
@@ -2892,6 +3502,118 @@ int32_t uCellNetDeepScan(uDeviceHandle_t cellHandle,
     return errorCodeOrNumber;
 }
 
+// Do an extended network search and rank the results.
+int32_t uCellNetDeepScanRanked(uDeviceHandle_t cellHandle,
+                               uCellNetCellInfo_t *pTable,
+                               size_t numEntries,
+                               bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t errorCodeOrNumber = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uCellNetDeepScanRanked_t context = {0};
+
+    if ((pTable != NULL) && (numEntries > 0)) {
+        context.pTable = pTable;
+        context.numEntries = numEntries;
+        context.pKeepGoingCallback = pKeepGoingCallback;
+        errorCodeOrNumber = uCellNetDeepScan(cellHandle, deepScanRankedCallback,
+                                             &context);
+        if (errorCodeOrNumber >= 0) {
+            errorCodeOrNumber = (int32_t) context.count;
+        }
+    }
+
+    return errorCodeOrNumber;
+}
+
+// Connect using the best of a set of deep scan results.
+int32_t uCellNetConnectBest(uDeviceHandle_t cellHandle,
+                            const uCellNetCellInfo_t *pTable,
+                            size_t numEntries,
+                            const char *pApn, const char *pUsername,
+                            const char *pPassword,
+                            bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t errorCodeOrIndex = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    char mccMnc[U_CELL_NET_MCC_MNC_LENGTH_BYTES];
+    bool tried;
+
+    if ((pTable != NULL) && (numEntries > 0)) {
+        errorCodeOrIndex = (int32_t) U_CELL_ERROR_NOT_FOUND;
+        for (size_t x = 0; (x < numEntries) && (errorCodeOrIndex < 0) &&
+             ((pKeepGoingCallback == NULL) || pKeepGoingCallback(cellHandle)); x++) {
+            // The table is ranked by cell so a PLMN may appear more
+            // than once: only try each PLMN once, at its best cell
+            tried = false;
+            for (size_t y = 0; (y < x) && !tried; y++) {
+                tried = ((pTable + y)->mcc == (pTable + x)->mcc) &&
+                        ((pTable + y)->mnc == (pTable + x)->mnc);
+            }
+            if (!tried) {
+                // AT+COPS=5 does not say whether the MNC was two or
+                // three digits, assume two unless it can't be
+                snprintf(mccMnc, sizeof(mccMnc),
+                         ((pTable + x)->mnc < 100) ? "%03d%02d" : "%03d%03d",
+                         (int) (pTable + x)->mcc, (int) (pTable + x)->mnc);
+                uPortLog("U_CELL_NET: connecting to PLMN %s, best cell RSRP %d dBm.\n",
+                         mccMnc, (pTable + x)->rsrpDbm);
+                errorCodeOrIndex = uCellNetConnect(cellHandle, mccMnc, pApn,
+                                                   pUsername, pPassword,
+                                                   pKeepGoingCallback);
+                if (errorCodeOrIndex == 0) {
+                    errorCodeOrIndex = (int32_t) x;
+                }
+            }
+        }
+    }
+
+    return errorCodeOrIndex;
+}
+
+// Set whether registration is polled or not.
+int32_t uCellNetSetRegistrationPolling(uDeviceHandle_t cellHandle,
+                                       bool onNotOff)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            pInstance->registrationPollingOff = !onNotOff;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get whether registration is polled or not.
+bool uCellNetGetRegistrationPolling(uDeviceHandle_t cellHandle)
+{
+    uCellPrivateInstance_t *pInstance;
+    bool onNotOff = false;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if (pInstance != NULL) {
+            onNotOff = !pInstance->registrationPollingOff;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return onNotOff;
+}
+
 // Enable or disable the registration status call-back.
 int32_t uCellNetSetRegistrationStatusCallback(uDeviceHandle_t cellHandle,
                                               void (*pCallback) (uCellNetRegDomain_t,
@@ -3135,10 +3857,6 @@ int32_t uCellNetGetIpAddressStr(uDeviceHandle_t cellHandle,
 {
     int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uCellPrivateInstance_t *pInstance;
-    uAtClientHandle_t atHandle;
-    bool active;
-    char *pBuffer = NULL;
-    int32_t bytesRead = -1;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -3147,73 +3865,34 @@ int32_t uCellNetGetIpAddressStr(uDeviceHandle_t cellHandle,
         pInstance = pUCellPrivateGetInstance(cellHandle);
         errorCodeOrSize = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pInstance != NULL) {
-            errorCodeOrSize = (int32_t) U_CELL_ERROR_NOT_CONNECTED;
-            atHandle = pInstance->atHandle;
-            // First check if the context is active
-            if (U_CELL_PRIVATE_HAS(pInstance->pModule,
-                                   U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
-                active = isActiveUpsd(pInstance, U_CELL_NET_PROFILE_ID);
-            } else {
-                active = isActive(pInstance, U_CELL_NET_CONTEXT_ID);
-            }
-            if (active) {
-                errorCodeOrSize = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-                // Malloc() memory for this rather than put it on
-                // the stack as IPV6 addresses can be quite big
-                pBuffer = (char *) pUPortMalloc(U_CELL_NET_IP_ADDRESS_SIZE);
-                if (pBuffer != NULL) {
-                    // Try this a few times: I have seen
-                    // "AT+CGPADDR= 1," returned on rare occasions
-                    for (size_t x = 3; (x > 0) && (errorCodeOrSize <= 0); x--) {
-                        *pBuffer = '\0'; // In case we read zero bytes successfully
-                        uAtClientLock(atHandle);
-                        if (U_CELL_PRIVATE_HAS(pInstance->pModule,
-                                               U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION)) {
-                            uAtClientCommandStart(atHandle, "AT+UPSND=");
-                            uAtClientWriteInt(atHandle, U_CELL_NET_PROFILE_ID);
-                            uAtClientWriteInt(atHandle, 0);
-                            uAtClientCommandStop(atHandle);
-                            uAtClientResponseStart(atHandle, "+UPSND:");
-                            // Skip the echo of the profile ID and command
-                            uAtClientSkipParameters(atHandle, 2);
-                            // Read the IP address.
-                            bytesRead = uAtClientReadString(atHandle, pBuffer,
-                                                            U_CELL_NET_IP_ADDRESS_SIZE,
-                                                            false);
-                        } else {
-                            uAtClientCommandStart(atHandle, "AT+CGPADDR=");
-                            uAtClientWriteInt(atHandle, U_CELL_NET_CONTEXT_ID);
-                            uAtClientCommandStop(atHandle);
-                            uAtClientResponseStart(atHandle, "+CGPADDR:");
-                            // Skip the context ID
-                            uAtClientSkipParameters(atHandle, 1);
-                            // Read the IP address.
-                            bytesRead = uAtClientReadString(atHandle, pBuffer,
-                                                            U_CELL_NET_IP_ADDRESS_SIZE,
-                                                            false);
-                        }
-                        uAtClientResponseStop(atHandle);
-                        errorCodeOrSize = uAtClientUnlock(atHandle);
-                        if ((errorCodeOrSize == 0) && (bytesRead > 0)) {
-                            errorCodeOrSize = bytesRead;
-                            if (pStr != NULL) {
-                                strncpy(pStr, pBuffer, U_CELL_NET_IP_ADDRESS_SIZE);
-                            }
-                            uPortLog("U_CELL_NET: IP address \"%.*s\".\n",
-                                     bytesRead, pBuffer);
-                        } else {
-                            errorCodeOrSize = (int32_t) U_CELL_ERROR_AT;
-                            uPortLog("U_CELL_NET: unable to read IP address.\n");
-                            uPortTaskBlock(1000);
-                        }
-                    }
+            errorCodeOrSize = getIpAddressStr(pInstance, U_CELL_NET_CONTEXT_ID,
+                                              U_CELL_NET_PROFILE_ID, pStr);
+        }
 
-                    // Free memory
-                    uPortFree(pBuffer);
-                }
-            } else {
-                uPortLog("U_CELL_NET: not connected, unable to read IP address.\n");
-            }
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrSize;
+}
+
+// Return the IP address of a given PDP context.
+int32_t uCellNetGetContextIpAddressStr(uDeviceHandle_t cellHandle,
+                                       int32_t contextId, char *pStr)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCodeOrSize = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (contextId > 0) &&
+            (contextId <= U_CELL_NET_MAX_NUM_CONTEXTS)) {
+            errorCodeOrSize = getIpAddressStr(pInstance, contextId,
+                                              U_CELL_PRIVATE_CONTEXT_ID_TO_PROFILE_ID(contextId),
+                                              pStr);
         }
 
         U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
@@ -3298,10 +3977,7 @@ int32_t uCellNetGetDataCounterTx(uDeviceHandle_t cellHandle)
 {
     int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uCellPrivateInstance_t *pInstance;
-    uAtClientHandle_t atHandle;
-    bool ours = false;
-    int32_t bytesSent = 0;
-    int32_t y = 0;
+    int32_t bytesSent;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -3313,26 +3989,8 @@ int32_t uCellNetGetDataCounterTx(uDeviceHandle_t cellHandle)
             errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
             if (U_CELL_PRIVATE_HAS(pInstance->pModule,
                                    U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)) {
-                errorCodeOrCount = (int32_t) U_CELL_ERROR_AT;
-                atHandle = pInstance->atHandle;
-                uAtClientLock(atHandle);
-                uAtClientCommandStart(atHandle, "AT+UGCNTRD");
-                uAtClientCommandStop(atHandle);
-                for (size_t x = 0; (x < U_CELL_NET_MAX_NUM_CONTEXTS) &&
-                     (y >= 0) && !ours; x++) {
-                    uAtClientResponseStart(atHandle, "+UGCNTRD:");
-                    // Check if this is our context ID
-                    y = uAtClientReadInt(atHandle);
-                    if (y == U_CELL_NET_CONTEXT_ID) {
-                        ours = true;
-                        // If it is, the next byte is the sent
-                        // count for this session
-                        bytesSent = uAtClientReadInt(atHandle);
-                    }
-                }
-                uAtClientResponseStop(atHandle);
-                if ((uAtClientUnlock(atHandle) == 0) && ours &&
-                    (bytesSent >= 0)) {
+                errorCodeOrCount = readDataCounters(pInstance, &bytesSent, NULL);
+                if (errorCodeOrCount == 0) {
                     errorCodeOrCount = bytesSent;
                 }
             }
@@ -3349,10 +4007,7 @@ int32_t uCellNetGetDataCounterRx(uDeviceHandle_t cellHandle)
 {
     int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uCellPrivateInstance_t *pInstance;
-    uAtClientHandle_t atHandle;
-    bool ours = false;
-    int32_t bytesReceived = 0;
-    int32_t y = 0;
+    int32_t bytesReceived;
 
     if (gUCellPrivateMutex != NULL) {
 
@@ -3364,27 +4019,8 @@ int32_t uCellNetGetDataCounterRx(uDeviceHandle_t cellHandle)
             errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
             if (U_CELL_PRIVATE_HAS(pInstance->pModule,
                                    U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)) {
-                errorCodeOrCount = (int32_t) U_CELL_ERROR_AT;
-                atHandle = pInstance->atHandle;
-                uAtClientLock(atHandle);
-                uAtClientCommandStart(atHandle, "AT+UGCNTRD");
-                uAtClientCommandStop(atHandle);
-                for (size_t x = 0; (x < U_CELL_NET_MAX_NUM_CONTEXTS) &&
-                     (y >= 0) && !ours; x++) {
-                    uAtClientResponseStart(atHandle, "+UGCNTRD:");
-                    // Check if this is our context ID
-                    y = uAtClientReadInt(atHandle);
-                    if (y == U_CELL_NET_CONTEXT_ID) {
-                        ours = true;
-                        // Skip the transmitted byte count
-                        uAtClientSkipParameters(atHandle, 1);
-                        // Get the received count for this session
-                        bytesReceived = uAtClientReadInt(atHandle);
-                    }
-                }
-                uAtClientResponseStop(atHandle);
-                if ((uAtClientUnlock(atHandle) == 0) && ours &&
-                    (bytesReceived >= 0)) {
+                errorCodeOrCount = readDataCounters(pInstance, NULL, &bytesReceived);
+                if (errorCodeOrCount == 0) {
                     errorCodeOrCount = bytesReceived;
                 }
             }
@@ -3430,4 +4066,118 @@ int32_t uCellNetResetDataCounters(uDeviceHandle_t cellHandle)
     return errorCode;
 }
 
+// Start the data counter sampler.
+int32_t uCellNetDataCounterSamplerStart(uDeviceHandle_t cellHandle,
+                                        int32_t intervalMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uCellPrivateDataCounterSampler_t *pSampler;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (intervalMs >= 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                   U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)) {
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                pSampler = pInstance->pDataCounterSampler;
+                if (pSampler == NULL) {
+                    pSampler = (uCellPrivateDataCounterSampler_t *) pUPortMalloc(sizeof(*pSampler));
+                    if (pSampler != NULL) {
+                        memset(pSampler, 0, sizeof(*pSampler));
+                        pInstance->pDataCounterSampler = pSampler;
+                    }
+                }
+                if (pSampler != NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    if ((pSampler->timer != NULL) &&
+                        ((intervalMs == 0) || (intervalMs != pSampler->intervalMs))) {
+                        uPortTimerDelete(pSampler->timer);
+                        pSampler->timer = NULL;
+                    }
+                    pSampler->intervalMs = intervalMs;
+                    if ((intervalMs > 0) && (pSampler->timer == NULL)) {
+                        errorCode = uPortTimerCreate(&(pSampler->timer), "cellCounters",
+                                                     dataCounterSamplerTimerCallback,
+                                                     pInstance, (uint32_t) intervalMs,
+                                                     true);
+                        if (errorCode == 0) {
+                            errorCode = uPortTimerStart(pSampler->timer);
+                            if (errorCode != 0) {
+                                uPortTimerDelete(pSampler->timer);
+                            }
+                        }
+                        if (errorCode != 0) {
+                            pSampler->timer = NULL;
+                        }
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Stop the data counter sampler.
+void uCellNetDataCounterSamplerStop(uDeviceHandle_t cellHandle)
+{
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        uCellPrivateDataCounterSamplerRemoveContext(pUCellPrivateGetInstance(cellHandle));
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+}
+
+// Read samples from the history of the data counter sampler.
+int32_t uCellNetDataCounterSamplerRead(uDeviceHandle_t cellHandle,
+                                       uCellNetDataCounterSample_t *pSamples,
+                                       size_t numSamples)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uCellPrivateDataCounterSampler_t *pSampler;
+    size_t count = 0;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            pSampler = pInstance->pDataCounterSampler;
+            if (pSampler != NULL) {
+                if (pSamples == NULL) {
+                    count = pSampler->count;
+                } else {
+                    while ((count < numSamples) && (pSampler->count > 0)) {
+                        *(pSamples + count) = pSampler->sample[pSampler->oldest];
+                        pSampler->oldest = (pSampler->oldest + 1) %
+                                           U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH;
+                        pSampler->count--;
+                        count++;
+                    }
+                }
+                errorCodeOrCount = (int32_t) count;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrCount;
+}
+
 // End of file
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _U_CELL_NET_PRIVATE_H_
+#define _U_CELL_NET_PRIVATE_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** @file
+ * @brief This header file defines a network function that is needed
+ * in an internal form by the power part of the cellular API, made
+ * available this way in order to avoid dragging the whole of
+ * the net part of the cellular API into u_cell_pwr.c.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Bring the network state held by this code up to date with that
+ * of a module which was already registered before this code started,
+ * e.g. because the MCU has been reset while the module has stayed
+ * powered: the registration URC handlers are installed, the packet
+ * switched registration status is queried (AT+CEREG? or AT+CGREG?)
+ * and, if the module is registered and has an active PDP context,
+ * that context is marked as being up so that a subsequent
+ * uCellNetConnect() need not disturb it.  No configuration is sent
+ * to the module.
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance  a pointer to the instance.
+ * @return           zero if the module is registered with an active
+ *                   PDP context, #U_CELL_ERROR_NOT_CONNECTED if it is
+ *                   registered but there is no PDP context,
+ *                   #U_CELL_ERROR_NOT_REGISTERED if it is not
+ *                   registered, else negative error code.
+ */
+int32_t uCellNetPrivateWarmAttach(uCellPrivateInstance_t *pInstance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_CELL_NET_PRIVATE_H_
+
+// End of file
@@ -51,6 +51,8 @@
 
 #include "u_security.h"
 
+#include "u_device_shared.h"
+
 #include "u_cell_module_type.h"
 #include "u_cell_file.h" // U_CELL_FILE_NAME_MAX_LENGTH
 #include "u_cell.h"         // Order is
@@ -102,19 +104,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         2 /* Simultaneous RATs */,
         ((1ULL << (int32_t) U_CELL_NET_RAT_GSM_GPRS_EGPRS) |
          (1ULL << (int32_t) U_CELL_NET_RAT_UTRAN)) /* RATs */,
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CONTEXT_MAPPING_REQUIRED)    |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AUTO_BAUDING)                |
-         // In theory SARA-U201 does support DTR power saving however we do not
-         // have this in our regression test farm and hence it is not marked
-         // as supported for now
-         // (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DTR_POWER_SAVING)
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AT_PROFILES)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CTS_CONTROL)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SOCK_SET_LOCAL_PORT)         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING) /* features */
-         // CMUX is supported here but we do not test it hence it is not marked as supported
-        ),
+        U_CELL_PRIVATE_FEATURES_SARA_U201 /* features */,
         6 /* Default CMUX channel for GNSS */
     },
     {
@@ -124,22 +114,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         2 /* Simultaneous RATs */,
         ((1ULL << (int32_t) U_CELL_NET_RAT_CATM1)          |
          (1ULL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)        |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)               |
-         // In theory SARA-R410M does support keep alive but I have been
-         // unable to make it work (always returns error) and hence this is
-         // not marked as supported for now
-         // (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SARA_R4_OLD_SYNTAX) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                  |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                    |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                    |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)  /* features */
-        ),
+        U_CELL_PRIVATE_FEATURES_SARA_R410M_02B /* features */,
         3 /* Default CMUX channel for GNSS */
     },
     {
@@ -150,26 +125,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         ((1ULL << (int32_t) U_CELL_NET_RAT_GSM_GPRS_EGPRS) |
          (1ULL << (int32_t) U_CELL_NET_RAT_CATM1)          |
          (1ULL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                            |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                                  |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION)    |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SARA_R4_OLD_SYNTAX)             |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SET_LOCAL_PORT)                 |
-         // In theory SARA-R412M does support keep alive but I have been
-         // unable to make it work (always returns error) and hence this is
-         // not marked as supported for now
-         // (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SESSION_RETAIN)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                              |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)  /* features */
-        ),
+        U_CELL_PRIVATE_FEATURES_SARA_R412M_02B /* features */,
         3 /* Default CMUX channel for GNSS */
     },
     {
@@ -180,17 +136,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         ((1ULL << (int32_t) U_CELL_NET_RAT_GSM_GPRS_EGPRS) |
          (1ULL << (int32_t) U_CELL_NET_RAT_CATM1)          |
          (1ULL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                              |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX) /* features */
-        ),
+        U_CELL_PRIVATE_FEATURES_SARA_R412M_03B /* features */,
         3 /* Default CMUX channel for GNSS */
     },
     {
@@ -204,36 +150,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         ((1ULL << (int32_t) U_CELL_NET_RAT_CATM1) |
          (1ULL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
 #endif
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_IANA_NUMBERING)         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_CIPHER_LIST)            |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_WILL)                           |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CONTEXT_MAPPING_REQUIRED)            |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AUTO_BAUDING)                        |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AT_PROFILES)                         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_ZTP)                        |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DTR_POWER_SAVING)                    |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING_PAGING_WINDOW_SET) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTTSN)                              |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CTS_CONTROL)                         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SOCK_SET_LOCAL_PORT)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SNR_REPORTED) /* features */
-        ),
+        U_CELL_PRIVATE_FEATURES_SARA_R5 /* features */,
         4 /* Default CMUX channel for GNSS */
     },
     {
@@ -243,20 +160,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         2 /* Simultaneous RATs */,
         ((1ULL << (int32_t) U_CELL_NET_RAT_CATM1)          |
          (1ULL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                              |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)   /* features */
-        ),
+        U_CELL_PRIVATE_FEATURES_SARA_R410M_03B /* features */,
         3 /* Default CMUX channel for GNSS */
     },
     {
@@ -267,33 +171,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         ((1ULL << (int32_t) U_CELL_NET_RAT_GSM_GPRS_EGPRS) |
          (1ULL << (int32_t) U_CELL_NET_RAT_CATM1)          |
          (1ULL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)                    |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_IANA_NUMBERING)         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_WILL)                           |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CONTEXT_MAPPING_REQUIRED)            |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      |
-         // SARA-R422 _does_ support 3GPP power saving, however the tests fail at the
-         // moment because a second attempt to enter 3GPP power saving, after waking-up
-         // from sleep to do something, fails, hence the support is disabled until
-         // we determine why that is
-         //(1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   |
-         //(1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING_PAGING_WINDOW_SET) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                  |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTTSN)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                  |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                  |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SNR_REPORTED) /* features */
-        ),
+        U_CELL_PRIVATE_FEATURES_SARA_R422 /* features */,
         3 /* Default CMUX channel for GNSS */
     },
     {
@@ -304,24 +182,7 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         ((1ULL << (int32_t) U_CELL_NET_RAT_GSM_GPRS_EGPRS) |
          (1ULL << (int32_t) U_CELL_NET_RAT_LTE)            |
          (1ULL << (int32_t) U_CELL_NET_RAT_UTRAN)) /* RATs */,
-        ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_IANA_NUMBERING)         |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_WILL)                           |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DTR_POWER_SAVING)                    |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTTSN)                              |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SOCK_SET_LOCAL_PORT)                 |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                |
-         (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SNR_REPORTED) /* features */
-        ),
+        U_CELL_PRIVATE_FEATURES_LARA_R6 /* features */,
         3 /* Default CMUX channel for GNSS */
     }
 };
@@ -500,6 +361,148 @@ static void fileListClear(uCellPrivateFileListContainer_t **ppFileContainer)
     }
 }
 
+// Free a list of file cache entries.
+static void fileCacheEntriesFree(uCellPrivateFileCacheEntry_t *pEntry)
+{
+    uCellPrivateFileCacheEntry_t *pTmp;
+
+    while (pEntry != NULL) {
+        pTmp = pEntry->pNext;
+        uPortFree(pEntry);
+        pEntry = pTmp;
+    }
+}
+
+// Get the file cache of an instance, clearing it first if the
+// module may have changed the file system behind our back and,
+// if create is true, creating it if there isn't one.
+static uCellPrivateFileCache_t *pFileCacheGet(uCellPrivateInstance_t *pInstance,
+                                              bool create)
+{
+    if (pInstance->fileCacheStale) {
+        pInstance->fileCacheStale = false;
+        uCellPrivateFileCacheClear(pInstance);
+    }
+    if ((pInstance->pFileCache == NULL) && create) {
+        pInstance->pFileCache = (uCellPrivateFileCache_t *) pUPortMalloc(sizeof(uCellPrivateFileCache_t));
+        if (pInstance->pFileCache != NULL) {
+            memset(pInstance->pFileCache, 0, sizeof(*(pInstance->pFileCache)));
+        }
+    }
+
+    return pInstance->pFileCache;
+}
+
+// Find a file in a list of file cache entries, returning a pointer
+// to the pointer to it so that it can be removed.
+static uCellPrivateFileCacheEntry_t **ppFileCacheFind(uCellPrivateFileCacheEntry_t **ppEntry,
+                                                      const char *pFileName,
+                                                      size_t fileNameLength)
+{
+    const char *pName;
+
+    while (*ppEntry != NULL) {
+        pName = ((const char *) *ppEntry) + sizeof(**ppEntry);
+        if ((strlen(pName) == fileNameLength) &&
+            (memcmp(pName, pFileName, fileNameLength) == 0)) {
+            break;
+        }
+        ppEntry = &((*ppEntry)->pNext);
+    }
+
+    return ppEntry;
+}
+
+// Add a file to the file cache, if there is room, returning the entry.
+static uCellPrivateFileCacheEntry_t *pFileCacheAdd(uCellPrivateFileCache_t *pCache,
+                                                   const char *pFileName,
+                                                   size_t fileNameLength,
+                                                   int32_t size)
+{
+    uCellPrivateFileCacheEntry_t *pEntry = NULL;
+
+    if (pCache->numEntries < U_CELL_FILE_CACHE_MAX_NUM_ENTRIES) {
+        pEntry = (uCellPrivateFileCacheEntry_t *) pUPortMalloc(sizeof(*pEntry) +
+                                                               fileNameLength + 1);
+        if (pEntry != NULL) {
+            pEntry->size = size;
+            memcpy(((char *) pEntry) + sizeof(*pEntry), pFileName, fileNameLength);
+            *(((char *) pEntry) + sizeof(*pEntry) + fileNameLength) = 0;
+            pEntry->pNext = pCache->pEntries;
+            pCache->pEntries = pEntry;
+            pCache->numEntries++;
+        }
+    }
+    if (pEntry == NULL) {
+        // We no longer know everything
+        pCache->complete = false;
+    }
+
+    return pEntry;
+}
+
+// Replace the contents of the file cache with a directory listing
+// just read from the module, keeping the sizes already known.
+static void fileCacheFromList(uCellPrivateInstance_t *pInstance,
+                              const uCellPrivateFileListContainer_t *pFileContainer)
+{
+    uCellPrivateFileCache_t *pCache = pFileCacheGet(pInstance, true);
+    uCellPrivateFileCacheEntry_t *pOld;
+    uCellPrivateFileCacheEntry_t **ppFound;
+    int32_t size;
+
+    if (pCache != NULL) {
+        pOld = pCache->pEntries;
+        pCache->pEntries = NULL;
+        pCache->numEntries = 0;
+        pCache->complete = true;
+        while (pFileContainer != NULL) {
+            size = -1;
+            ppFound = ppFileCacheFind(&pOld, pFileContainer->pFileName,
+                                      pFileContainer->fileNameLength);
+            if (*ppFound != NULL) {
+                size = (*ppFound)->size;
+            }
+            pFileCacheAdd(pCache, pFileContainer->pFileName,
+                          pFileContainer->fileNameLength, size);
+            pFileContainer = pFileContainer->pNext;
+        }
+        fileCacheEntriesFree(pOld);
+    }
+}
+
+// Make a directory listing from the file cache, returning the number
+// of entries or negative error code.
+static int32_t fileCacheToList(const uCellPrivateFileCache_t *pCache,
+                               uCellPrivateFileListContainer_t **ppFileContainer)
+{
+    int32_t errorOrCount = 0;
+    const uCellPrivateFileCacheEntry_t *pEntry = pCache->pEntries;
+    uCellPrivateFileListContainer_t *pFileContainer;
+    const char *pName;
+    size_t fileNameLength;
+
+    while ((pEntry != NULL) && (errorOrCount >= 0)) {
+        errorOrCount = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pName = ((const char *) pEntry) + sizeof(*pEntry);
+        fileNameLength = strlen(pName);
+        pFileContainer = (uCellPrivateFileListContainer_t *) pUPortMalloc(sizeof(*pFileContainer) +
+                                                                          fileNameLength);
+        if (pFileContainer != NULL) {
+            pFileContainer->pFileName = ((char *) pFileContainer) + sizeof(*pFileContainer);
+            memcpy(pFileContainer->pFileName, pName, fileNameLength);
+            pFileContainer->fileNameLength = fileNameLength;
+            errorOrCount = (int32_t) filelListAddCount(ppFileContainer, pFileContainer);
+        }
+        pEntry = pEntry->pNext;
+    }
+    if (errorOrCount < 0) {
+        fileListClear(ppFileContainer);
+    }
+
+    return errorOrCount;
+}
+
 
 // [Re]attach a PDP context to an internal module profile with an
 // option on whether the AT client is locked/released or not.
@@ -596,13 +599,17 @@ bool uCellPrivateIsNumeric(const char *pBuffer, size_t bufferSize)
     return numeric;
 }
 
-// Find a cellular instance in the list by instance handle.
+// Find a cellular instance by instance handle.
 uCellPrivateInstance_t *pUCellPrivateGetInstance(uDeviceHandle_t cellHandle)
 {
-    uCellPrivateInstance_t *pInstance = gpUCellPrivateInstanceList;
-
-    while ((pInstance != NULL) && (pInstance->cellHandle != cellHandle)) {
-        pInstance = pInstance->pNext;
+    uCellPrivateInstance_t *pInstance = NULL;
+    uDeviceInstance_t *pDevInstance = U_DEVICE_INSTANCE(cellHandle);
+
+    // uCellAdd() stores the instance in the device instance
+    // so there's no need to search the list
+    if (uDeviceIsValidInstance(pDevInstance) &&
+        (pDevInstance->deviceType == U_DEVICE_TYPE_CELL)) {
+        pInstance = (uCellPrivateInstance_t *) pDevInstance->pPrivateInstance;
     }
 
     return pInstance;
@@ -651,6 +658,7 @@ void uCellPrivateClearRadioParameters(uCellPrivateRadioParameters_t *pParameters
     }
     pParameters->earfcn = -1;
     pParameters->snrDb = 0x7FFFFFFF;
+    pParameters->refreshedAtMs = -1;
 }
 
 // Clear the dynamic parameters of an instance,
@@ -671,6 +679,21 @@ void uCellPrivateClearDynamicParameters(uCellPrivateInstance_t *pInstance)
     uCellPrivateClearRadioParameters(&(pInstance->radioParameters), false);
 }
 
+// Return the UART to the baud rate before uCellCfgUpgradeBaudRate().
+void uCellPrivateBaudRateRestore(uCellPrivateInstance_t *pInstance)
+{
+    uAtClientStreamHandle_t stream = U_AT_CLIENT_STREAM_HANDLE_DEFAULTS;
+
+    if (pInstance->baudRateRestore > 0) {
+        uAtClientStreamGetExt(pInstance->atHandle, &stream);
+        if (stream.type == U_AT_CLIENT_STREAM_TYPE_UART) {
+            uPortUartSetBaudRate(stream.handle.int32,
+                                 pInstance->baudRateRestore);
+        }
+        pInstance->baudRateRestore = 0;
+    }
+}
+
 // Get the current CFUN mode.
 int32_t uCellPrivateCFunGet(const uCellPrivateInstance_t *pInstance)
 {
@@ -750,17 +773,28 @@ void uCellPrivateCFunMode(uCellPrivateInstance_t *pInstance,
     uAtClientCommandStopReadResponse(atHandle);
     if (uAtClientUnlock(atHandle) == 0) {
         pInstance->lastCfunFlipTimeMs = uPortGetTickTimeMs();
+        if (mode == 0) {
+            // The SIM is switched off in AT+CFUN=0 and
+            // so could be swapped
+            uCellPrivateIdCacheClear(pInstance, true);
+        }
     }
 }
 
 // Get the IMSI of the SIM.
-int32_t uCellPrivateGetImsi(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateGetImsi(uCellPrivateInstance_t *pInstance,
                             char *pImsi)
 {
     int32_t errorCode = (int32_t) U_CELL_ERROR_AT;
     uAtClientHandle_t atHandle = pInstance->atHandle;
+    uCellPrivateIdCache_t *pIdCache = pInstance->pIdCache;
     int32_t bytesRead;
 
+    if ((pIdCache != NULL) && pIdCache->imsiValid) {
+        memcpy(pImsi, pIdCache->imsi, sizeof(pIdCache->imsi));
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
     // Try this ten times: unfortunately
     // the module can spit out a URC just when
     // we're expecting the IMSI and, since there
@@ -780,6 +814,11 @@ int32_t uCellPrivateGetImsi(const uCellPrivateInstance_t *pInstance,
             (bytesRead == 15) &&
             uCellPrivateIsNumeric(pImsi, 15)) {
             errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            pIdCache = pUCellPrivateGetIdCache(pInstance);
+            if (pIdCache != NULL) {
+                memcpy(pIdCache->imsi, pImsi, sizeof(pIdCache->imsi));
+                pIdCache->imsiValid = true;
+            }
         } else {
             uPortTaskBlock(1000);
         }
@@ -789,13 +828,19 @@ int32_t uCellPrivateGetImsi(const uCellPrivateInstance_t *pInstance,
 }
 
 // Get the IMEI of the cellular module.
-int32_t uCellPrivateGetImei(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateGetImei(uCellPrivateInstance_t *pInstance,
                             char *pImei)
 {
     int32_t errorCode = (int32_t) U_CELL_ERROR_AT;
     uAtClientHandle_t atHandle = pInstance->atHandle;
+    uCellPrivateIdCache_t *pIdCache = pInstance->pIdCache;
     int32_t bytesRead;
 
+    if ((pIdCache != NULL) && pIdCache->imeiValid) {
+        memcpy(pImei, pIdCache->imei, sizeof(pIdCache->imei));
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
     // Try this ten times: unfortunately
     // the module can spit out a URC just when
     // we're expecting the IMEI and, since there
@@ -815,12 +860,49 @@ int32_t uCellPrivateGetImei(const uCellPrivateInstance_t *pInstance,
             (bytesRead == 15) &&
             uCellPrivateIsNumeric(pImei, 15)) {
             errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            pIdCache = pUCellPrivateGetIdCache(pInstance);
+            if (pIdCache != NULL) {
+                memcpy(pIdCache->imei, pImei, sizeof(pIdCache->imei));
+                pIdCache->imeiValid = true;
+            }
         }
     }
 
     return errorCode;
 }
 
+// Get the identity cache, creating it if necessary.
+uCellPrivateIdCache_t *pUCellPrivateGetIdCache(uCellPrivateInstance_t *pInstance)
+{
+    if (pInstance->pIdCache == NULL) {
+        pInstance->pIdCache = (uCellPrivateIdCache_t *) pUPortMalloc(sizeof(uCellPrivateIdCache_t));
+        if (pInstance->pIdCache != NULL) {
+            uCellPrivateIdCacheClear(pInstance, false);
+        }
+    }
+
+    return pInstance->pIdCache;
+}
+
+// Clear the identity cache.
+void uCellPrivateIdCacheClear(uCellPrivateInstance_t *pInstance,
+                              bool simOnly)
+{
+    uCellPrivateIdCache_t *pIdCache = pInstance->pIdCache;
+
+    if (pIdCache != NULL) {
+        pIdCache->imsiValid = false;
+        pIdCache->stringLength[U_CELL_PRIVATE_ID_STRING_ICCID] = -1;
+        if (!simOnly) {
+            pIdCache->imeiValid = false;
+            for (size_t x = 0; x < sizeof(pIdCache->stringLength) /
+                 sizeof(pIdCache->stringLength[0]); x++) {
+                pIdCache->stringLength[x] = -1;
+            }
+        }
+    }
+}
+
 // Get whether the given instance is registered with the network.
 // Needs to be in the packet switched domain, circuit switched is
 // no use for this API.
@@ -915,13 +997,9 @@ void uCellPrivateScanFree(uCellPrivateNet_t **ppScanResults)
 // Get the module characteristics for a given instance.
 const uCellPrivateModule_t *pUCellPrivateGetModule(uDeviceHandle_t cellHandle)
 {
-    uCellPrivateInstance_t *pInstance = gpUCellPrivateInstanceList;
+    uCellPrivateInstance_t *pInstance = pUCellPrivateGetInstance(cellHandle);
     const uCellPrivateModule_t *pModule = NULL;
 
-    while ((pInstance != NULL) && (pInstance->cellHandle != cellHandle)) {
-        pInstance = pInstance->pNext;
-    }
-
     if (pInstance != NULL) {
         pModule = pInstance->pModule;
     }
@@ -954,13 +1032,38 @@ void uCellPrivateLocRemoveContext(uCellPrivateInstance_t *pInstance)
 // Remove the sleep context for the given instance.
 void uCellPrivateSleepRemoveContext(uCellPrivateInstance_t *pInstance)
 {
+    uCellPrivateDefer_t *pDefer;
+
     if (pInstance != NULL) {
+        if (pInstance->pSleepContext != NULL) {
+            if (pInstance->pSleepContext->deferTimer != NULL) {
+                uPortTimerDelete(pInstance->pSleepContext->deferTimer);
+            }
+            // Any deferred operations are discarded
+            while (pInstance->pSleepContext->pDeferList != NULL) {
+                pDefer = pInstance->pSleepContext->pDeferList;
+                pInstance->pSleepContext->pDeferList = pDefer->pNext;
+                uPortFree(pDefer);
+            }
+        }
         // Free the context
         uPortFree(pInstance->pSleepContext);
         pInstance->pSleepContext = NULL;
     }
 }
 
+// Remove the data counter sampler context for the given instance.
+void uCellPrivateDataCounterSamplerRemoveContext(uCellPrivateInstance_t *pInstance)
+{
+    if ((pInstance != NULL) && (pInstance->pDataCounterSampler != NULL)) {
+        if (pInstance->pDataCounterSampler->timer != NULL) {
+            uPortTimerDelete(pInstance->pDataCounterSampler->timer);
+        }
+        uPortFree(pInstance->pDataCounterSampler);
+        pInstance->pDataCounterSampler = NULL;
+    }
+}
+
 // [Re]attach a PDP context to an internal module profile.
 int32_t uCellPrivateActivateProfile(const uCellPrivateInstance_t *pInstance,
                                     int32_t contextId, int32_t profileId, size_t tries,
@@ -1148,11 +1251,14 @@ int32_t uCellPrivateResumeUartPowerSaving(const uCellPrivateInstance_t *pInstanc
 }
 
 // Delete file on file system.
-int32_t uCellPrivateFileDelete(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateFileDelete(uCellPrivateInstance_t *pInstance,
                                const char *pFileName)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
     uAtClientHandle_t atHandle;
+    uCellPrivateFileCache_t *pCache;
+    uCellPrivateFileCacheEntry_t **ppEntry;
+    uCellPrivateFileCacheEntry_t *pEntry;
 
     // Check parameters
     if ((pInstance != NULL) && (pFileName != NULL) &&
@@ -1173,6 +1279,17 @@ int32_t uCellPrivateFileDelete(const uCellPrivateInstance_t *pInstance,
         uAtClientCommandStopReadResponse(atHandle);
         if (uAtClientUnlock(atHandle) == 0) {
             errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            pCache = pFileCacheGet(pInstance, false);
+            if (pCache != NULL) {
+                ppEntry = ppFileCacheFind(&(pCache->pEntries), pFileName,
+                                          strlen(pFileName));
+                if (*ppEntry != NULL) {
+                    pEntry = *ppEntry;
+                    *ppEntry = pEntry->pNext;
+                    uPortFree(pEntry);
+                    pCache->numEntries--;
+                }
+            }
         }
     }
 
@@ -1180,7 +1297,7 @@ int32_t uCellPrivateFileDelete(const uCellPrivateInstance_t *pInstance,
 }
 
 // Get the name of the first file stored on file system.
-int32_t uCellPrivateFileListFirst(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateFileListFirst(uCellPrivateInstance_t *pInstance,
                                   uCellPrivateFileListContainer_t **ppFileListContainer,
                                   char *pFileName)
 {
@@ -1188,77 +1305,93 @@ int32_t uCellPrivateFileListFirst(const uCellPrivateInstance_t *pInstance,
     uAtClientHandle_t atHandle;
     char *pFileNameTmp;
     uCellPrivateFileListContainer_t *pFileContainer;
+    const uCellPrivateFileCache_t *pCache;
     bool keepGoing = true;
     int32_t bytesRead = 0;
     size_t count = 0;
 
     // Check parameters
     if ((pInstance != NULL) && (ppFileListContainer != NULL) && (pFileName != NULL)) {
-        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-        // Allocate temporary storage for a file name string
-        pFileNameTmp = pUPortMalloc(U_CELL_FILE_NAME_MAX_LENGTH + 1);
-        if (pFileNameTmp != NULL) {
-            errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
-            atHandle = pInstance->atHandle;
-            // Do the ULSTFILE thang with the AT interface
-            uAtClientLock(atHandle);
-            uAtClientCommandStart(atHandle, "AT+ULSTFILE=");
-            // List files operation
-            uAtClientWriteInt(atHandle, 0);
-            if (pInstance->pFileSystemTag != NULL) {
-                // Write tag
-                uAtClientWriteString(atHandle, pInstance->pFileSystemTag, true);
+        pCache = pFileCacheGet(pInstance, false);
+        if ((pCache != NULL) && pCache->complete) {
+            // No need to ask the module
+            errorCode = fileCacheToList(pCache, ppFileListContainer);
+            if (errorCode > 0) {
+                fileListGetRemove(ppFileListContainer, pFileName);
+            } else if (errorCode == 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
             }
-            uAtClientCommandStop(atHandle);
-            uAtClientResponseStart(atHandle, "+ULSTFILE:");
-            while (keepGoing) {
-                // Read file name
-                keepGoing = false;
-                bytesRead = uAtClientReadString(atHandle, pFileNameTmp,
-                                                U_CELL_FILE_NAME_MAX_LENGTH + 1,
-                                                false);
-                if (bytesRead > 0) {
-                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-                    // Allocate space for the structure plus the actual file name
-                    // stored immediately after the structure in the same malloc()ed space
-                    pFileContainer = (uCellPrivateFileListContainer_t *) pUPortMalloc(sizeof(*pFileContainer) +
-                                                                                      bytesRead);
-                    if (pFileContainer != NULL) {
-                        keepGoing = true;
-                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                        // Point pFileName just beyond the end of the structure
-                        pFileContainer->pFileName = ((char *) pFileContainer) + sizeof(*pFileContainer);
-                        // Copy the file name to this location (noting no null terminator
-                        /// since it has a separate length indicator)
-                        memcpy(pFileContainer->pFileName, pFileNameTmp, bytesRead);
-                        pFileContainer->fileNameLength = bytesRead;
-                        // Add the container to the end of the list
-                        count = filelListAddCount(ppFileListContainer, pFileContainer);
+        } else {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            // Allocate temporary storage for a file name string
+            pFileNameTmp = pUPortMalloc(U_CELL_FILE_NAME_MAX_LENGTH + 1);
+            if (pFileNameTmp != NULL) {
+                errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+                atHandle = pInstance->atHandle;
+                // Do the ULSTFILE thang with the AT interface
+                uAtClientLock(atHandle);
+                uAtClientCommandStart(atHandle, "AT+ULSTFILE=");
+                // List files operation
+                uAtClientWriteInt(atHandle, 0);
+                if (pInstance->pFileSystemTag != NULL) {
+                    // Write tag
+                    uAtClientWriteString(atHandle, pInstance->pFileSystemTag, true);
+                }
+                uAtClientCommandStop(atHandle);
+                uAtClientResponseStart(atHandle, "+ULSTFILE:");
+                while (keepGoing) {
+                    // Read file name
+                    keepGoing = false;
+                    bytesRead = uAtClientReadString(atHandle, pFileNameTmp,
+                                                    U_CELL_FILE_NAME_MAX_LENGTH + 1,
+                                                    false);
+                    if (bytesRead > 0) {
+                        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                        // Allocate space for the structure plus the actual file name
+                        // stored immediately after the structure in the same malloc()ed space
+                        pFileContainer = (uCellPrivateFileListContainer_t *) pUPortMalloc(sizeof(*pFileContainer) +
+                                                                                          bytesRead);
+                        if (pFileContainer != NULL) {
+                            keepGoing = true;
+                            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                            // Point pFileName just beyond the end of the structure
+                            pFileContainer->pFileName = ((char *) pFileContainer) + sizeof(*pFileContainer);
+                            // Copy the file name to this location (noting no null terminator
+                            /// since it has a separate length indicator)
+                            memcpy(pFileContainer->pFileName, pFileNameTmp, bytesRead);
+                            pFileContainer->fileNameLength = bytesRead;
+                            // Add the container to the end of the list
+                            count = filelListAddCount(ppFileListContainer, pFileContainer);
+                        }
                     }
                 }
-            }
-            uAtClientResponseStop(atHandle);
-
-            // Do the following parts inside the AT lock,
-            // providing protection for the linked-list.
-            if (errorCode == (int32_t) U_ERROR_COMMON_NO_MEMORY) {
-                // If we ran out of memory, clear the whole list,
-                // don't want to report partial information
-                fileListClear(&pFileContainer);
-            } else {
-                if (count > 0) {
-                    // Set the return value, copy out the first item in the list
-                    // and remove it.
-                    errorCode = (int32_t) count;
-                    fileListGetRemove(ppFileListContainer, pFileName);
+                uAtClientResponseStop(atHandle);
+
+                // Do the following parts inside the AT lock,
+                // providing protection for the linked-list.
+                if (errorCode == (int32_t) U_ERROR_COMMON_NO_MEMORY) {
+                    // If we ran out of memory, clear the whole list,
+                    // don't want to report partial information
+                    fileListClear(&pFileContainer);
                 } else {
-                    errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+                    if (uAtClientErrorGet(atHandle) == 0) {
+                        // Have the whole directory: remember it
+                        fileCacheFromList(pInstance, *ppFileListContainer);
+                    }
+                    if (count > 0) {
+                        // Set the return value, copy out the first item in the list
+                        // and remove it.
+                        errorCode = (int32_t) count;
+                        fileListGetRemove(ppFileListContainer, pFileName);
+                    } else {
+                        errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+                    }
                 }
-            }
-            uAtClientUnlock(atHandle);
+                uAtClientUnlock(atHandle);
 
-            // Free temporary storage
-            uPortFree(pFileNameTmp);
+                // Free temporary storage
+                uPortFree(pFileNameTmp);
+            }
         }
     }
 
@@ -1288,6 +1421,90 @@ void uCellPrivateFileListLast(uCellPrivateFileListContainer_t **ppFileListContai
     }
 }
 
+// Free the file system directory cache.
+void uCellPrivateFileCacheClear(uCellPrivateInstance_t *pInstance)
+{
+    if ((pInstance != NULL) && (pInstance->pFileCache != NULL)) {
+        fileCacheEntriesFree(pInstance->pFileCache->pEntries);
+        uPortFree(pInstance->pFileCache);
+        pInstance->pFileCache = NULL;
+    }
+}
+
+// Get the size of a file from the file system directory cache.
+int32_t uCellPrivateFileCacheGetSize(uCellPrivateInstance_t *pInstance,
+                                     const char *pFileName)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_UNKNOWN;
+    uCellPrivateFileCache_t *pCache;
+    uCellPrivateFileCacheEntry_t **ppEntry;
+
+    if ((pInstance != NULL) && (pFileName != NULL)) {
+        pCache = pFileCacheGet(pInstance, false);
+        if (pCache != NULL) {
+            ppEntry = ppFileCacheFind(&(pCache->pEntries), pFileName,
+                                      strlen(pFileName));
+            if (*ppEntry != NULL) {
+                if ((*ppEntry)->size >= 0) {
+                    errorCodeOrSize = (*ppEntry)->size;
+                }
+            } else if (pCache->complete) {
+                errorCodeOrSize = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            }
+        }
+    }
+
+    return errorCodeOrSize;
+}
+
+// Record that a file exists and has the given size.
+void uCellPrivateFileCacheSetSize(uCellPrivateInstance_t *pInstance,
+                                  const char *pFileName, int32_t size)
+{
+    uCellPrivateFileCache_t *pCache;
+    uCellPrivateFileCacheEntry_t **ppEntry;
+
+    if ((pInstance != NULL) && (pFileName != NULL)) {
+        pCache = pFileCacheGet(pInstance, true);
+        if (pCache != NULL) {
+            ppEntry = ppFileCacheFind(&(pCache->pEntries), pFileName,
+                                      strlen(pFileName));
+            if (*ppEntry != NULL) {
+                (*ppEntry)->size = size;
+            } else {
+                pFileCacheAdd(pCache, pFileName, strlen(pFileName), size);
+            }
+        }
+    }
+}
+
+// Record that data has been appended to a file.
+void uCellPrivateFileCacheAppend(uCellPrivateInstance_t *pInstance,
+                                 const char *pFileName, size_t length)
+{
+    uCellPrivateFileCache_t *pCache;
+    uCellPrivateFileCacheEntry_t **ppEntry;
+
+    if ((pInstance != NULL) && (pFileName != NULL)) {
+        pCache = pFileCacheGet(pInstance, true);
+        if (pCache != NULL) {
+            ppEntry = ppFileCacheFind(&(pCache->pEntries), pFileName,
+                                      strlen(pFileName));
+            if (*ppEntry != NULL) {
+                if ((*ppEntry)->size >= 0) {
+                    (*ppEntry)->size += (int32_t) length;
+                }
+            } else {
+                // If we don't know every file then this one
+                // may have already existed, in which case
+                // we can't know its size
+                pFileCacheAdd(pCache, pFileName, strlen(pFileName),
+                              pCache->complete ? (int32_t) length : -1);
+            }
+        }
+    }
+}
+
 // Remove the HTTP context for the given instance.
 void uCellPrivateHttpRemoveContext(uCellPrivateInstance_t *pInstance)
 {
@@ -1532,4 +1749,19 @@ void uCellPrivateAbortAtCommand(const uCellPrivateInstance_t *pInstance)
     }
 }
 
+// Estimate the time for a FOTA download to complete.
+int32_t uCellPrivateFotaEtaSeconds(int32_t elapsedMs,
+                                   int32_t startPercentage,
+                                   int32_t percentage)
+{
+    int32_t etaSeconds = -1;
+
+    if ((elapsedMs >= 0) && (percentage > startPercentage) && (percentage <= 100)) {
+        etaSeconds = (int32_t) (((int64_t) elapsedMs * (100 - percentage)) /
+                                (percentage - startPercentage) / 1000);
+    }
+
+    return etaSeconds;
+}
+
 // End of file
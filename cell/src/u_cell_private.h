@@ -105,13 +105,211 @@ extern "C" {
      ((rat) == U_CELL_NET_RAT_CATM1) ||    \
      ((rat) == U_CELL_NET_RAT_NB1))
 
+/** The feature bit-maps of the modules, one per entry in
+ * gUCellPrivateModuleList, made up of uCellPrivateFeature_t bits
+ * and named U_CELL_PRIVATE_FEATURES_ + the module type without the
+ * U_CELL_MODULE_TYPE_ prefix.  These are macros, rather than being
+ * written into gUCellPrivateModuleList directly, so that, for a
+ * single-module build, U_CELL_PRIVATE_HAS() becomes a compile-time
+ * constant.
+ */
+#define U_CELL_PRIVATE_FEATURES_SARA_U201                                                   \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION) |               \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CONTEXT_MAPPING_REQUIRED)    |               \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AUTO_BAUDING)                |               \
+     /* In theory SARA-U201 does support DTR power saving however we do not */              \
+     /* have this in our regression test farm and hence it is not marked */                 \
+     /* as supported for now */                                                             \
+     /* (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DTR_POWER_SAVING) */                      \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AT_PROFILES)                 |               \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CTS_CONTROL)                 |               \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SOCK_SET_LOCAL_PORT)         |               \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                           \
+     /* CMUX is supported here but we do not test it hence it is not marked as supported */ \
+    )
+
+#define U_CELL_PRIVATE_FEATURES_SARA_R410M_02B                                  \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)        |            \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)   |            \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)               |            \
+     /* In theory SARA-R410M does support keep alive but I have been */         \
+     /* unable to make it work (always returns error) and hence this is */      \
+     /* not marked as supported for now */                                      \
+     /* (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)         | */ \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SARA_R4_OLD_SYNTAX) |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                  |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)         |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)       |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                    |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                    |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)       |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                            \
+    )
+
+#define U_CELL_PRIVATE_FEATURES_SARA_R412M_02B                                              \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                            |    \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                                  |    \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)                       |    \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION)    |    \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SARA_R4_OLD_SYNTAX)             |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SET_LOCAL_PORT)                 |       \
+     /* In theory SARA-R412M does support keep alive but I have been */                     \
+     /* unable to make it work (always returns error) and hence this is */                  \
+     /* not marked as supported for now */                                                  \
+     /* (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     | */ \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SESSION_RETAIN)                 |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                              |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                        \
+    )
+
+#define U_CELL_PRIVATE_FEATURES_SARA_R412M_03B                                        \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                              | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                  \
+    )
+
+#define U_CELL_PRIVATE_FEATURES_SARA_R5                                               \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST)                       | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)                       | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_IANA_NUMBERING)         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_CIPHER_LIST)            | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH)                 | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_WILL)                           | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CONTEXT_MAPPING_REQUIRED)            | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AUTO_BAUDING)                        | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_AT_PROFILES)                         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_ZTP)                        | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DTR_POWER_SAVING)                    | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING_PAGING_WINDOW_SET) | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTTSN)                              | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CTS_CONTROL)                         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SOCK_SET_LOCAL_PORT)                 | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SNR_REPORTED)                        | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SESSION_RESUMPTION)     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SOCK_CONTEXT_BINDING)                  \
+    )
+
+#define U_CELL_PRIVATE_FEATURES_SARA_R410M_03B                                        \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UCGED5)                              | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                   | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                  \
+    )
+
+#define U_CELL_PRIVATE_FEATURES_SARA_R422                                                   \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST)                       |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)                    |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_IANA_NUMBERING)         |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH)                 |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_WILL)                           |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CONTEXT_MAPPING_REQUIRED)            |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     |       \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DEEP_SLEEP_URC)                      |       \
+     /* SARA-R422 _does_ support 3GPP power saving, however the tests fail at the */        \
+     /* moment because a second attempt to enter 3GPP power saving, after waking-up */      \
+     /* from sleep to do something, fails, hence the support is disabled until */           \
+     /* we determine why that is */                                                         \
+     /* (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING)                   | */ \
+     /* (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_3GPP_POWER_SAVING_PAGING_WINDOW_SET) | */ \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_EDRX)                                  |     \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTTSN)                                |     \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                  |     \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING)                     |     \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                  |     \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SNR_REPORTED)                                \
+    )
+
+#define U_CELL_PRIVATE_FEATURES_LARA_R6                                               \
+    ((1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE)                         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)                               | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST)                       | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_IANA_NUMBERING)         | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SERVER_NAME_INDICATION) | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_BINARY_PUBLISH)                 | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_WILL)                           | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_KEEP_ALIVE)                     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTT_SECURITY)                       | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FILE_SYSTEM_TAG)                     | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_DTR_POWER_SAVING)                    | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_MQTTSN)                              | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SOCK_SET_LOCAL_PORT)                 | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_FOTA)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_CMUX)                                | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SNR_REPORTED)                        | \
+     (1ULL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SESSION_RESUMPTION)       \
+    )
+
+/** Paste the expanded value of a macro onto a prefix.
+ */
+#define U_CELL_PRIVATE_PASTE_(a, b) a##b
+#define U_CELL_PRIVATE_PASTE(a, b) U_CELL_PRIVATE_PASTE_(a, b)
+
+#ifdef U_CFG_CELL_MODULE_ONLY
+/** U_CFG_CELL_MODULE_ONLY may be defined to the module type, minus
+ * the U_CELL_MODULE_TYPE_ prefix (e.g. SARA_R5), for a build that
+ * only ever talks to that one type of module; uCellAdd() will then
+ * refuse any other module type and feature checks are resolved at
+ * compile time, so that code for features the module does not have
+ * is compiled out.
+ */
+# define U_CELL_PRIVATE_MODULE_TYPE_ONLY U_CELL_PRIVATE_PASTE(U_CELL_MODULE_TYPE_, U_CFG_CELL_MODULE_ONLY)
+# define U_CELL_PRIVATE_FEATURES_ONLY U_CELL_PRIVATE_PASTE(U_CELL_PRIVATE_FEATURES_, U_CFG_CELL_MODULE_ONLY)
+#endif
+
 /** Determine if the given feature is supported or not
  * by the pointed-to module.
  */
 //lint --emacro((774), U_CELL_PRIVATE_HAS) Suppress left side always
 // evaluates to True
-#define U_CELL_PRIVATE_HAS(pModule, feature) \
+#ifdef U_CFG_CELL_MODULE_ONLY
+# define U_CELL_PRIVATE_HAS(pModule, feature) \
+    ((pModule != NULL) && ((U_CELL_PRIVATE_FEATURES_ONLY) & (1ULL << (int32_t) (feature))))
+#else
+# define U_CELL_PRIVATE_HAS(pModule, feature) \
     ((pModule != NULL) && ((pModule->featuresBitmap) & (1ULL << (int32_t) (feature))))
+#endif
 
 #ifndef U_CELL_PRIVATE_GREETING_STR
 /** A greeting string, a useful indication that the module
@@ -147,6 +345,25 @@ extern "C" {
 # define U_CELL_PRIVATE_UART_WAKE_UP_RETRY_INTERVAL_MS 333
 #endif
 
+#ifndef U_CELL_PRIVATE_ID_CACHE_STRING_LENGTH_BYTES
+/** The room for each of the identity strings (ICCID, model and
+ * firmware version) held in the identity cache, including room for
+ * a null terminator; a string that does not fit is simply not
+ * cached.
+ */
+# define U_CELL_PRIVATE_ID_CACHE_STRING_LENGTH_BYTES 64
+#endif
+
+/** Map a PDP context ID to the internal module profile ID that is
+ * used with it, for those modules where such a mapping is required
+ * (e.g. with AT+UPSD).  #U_CELL_NET_CONTEXT_ID maps to
+ * #U_CELL_NET_PROFILE_ID and the other context IDs follow on from
+ * there, wrapping, so that no two contexts share a profile.
+ */
+#define U_CELL_PRIVATE_CONTEXT_ID_TO_PROFILE_ID(contextId)            \
+    ((((contextId) - U_CELL_NET_CONTEXT_ID) + U_CELL_NET_PROFILE_ID + \
+      U_CELL_NET_MAX_NUM_CONTEXTS) % U_CELL_NET_MAX_NUM_CONTEXTS)
+
 /** Bit mask to get to the bit in pinStates which indicates
  * the "on" state of the ENABLE_POWER pin.
  */
@@ -237,7 +454,9 @@ typedef enum {
     U_CELL_PRIVATE_FEATURE_FOTA,
     U_CELL_PRIVATE_FEATURE_UART_POWER_SAVING,
     U_CELL_PRIVATE_FEATURE_CMUX,
-    U_CELL_PRIVATE_FEATURE_SNR_REPORTED
+    U_CELL_PRIVATE_FEATURE_SNR_REPORTED,
+    U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SESSION_RESUMPTION,
+    U_CELL_PRIVATE_FEATURE_SOCK_CONTEXT_BINDING
 } uCellPrivateFeature_t;
 
 /** The characteristics that may differ between cellular modules.
@@ -305,6 +524,8 @@ typedef struct {
     int32_t cellIdLogical;   /**< The logical cell ID of the serving cell. */
     int32_t earfcn;   /**< The EARFCN of the serving cell. */
     int32_t snrDb;   /**< The SINR as reported by the module (LTE only). */
+    int32_t refreshedAtMs; /**< When the above were last successfully
+                                refreshed, -1 if they have not been. */
 } uCellPrivateRadioParameters_t;
 
 /** Structure to hold a network name, MCC/MNC and RAT
@@ -318,6 +539,20 @@ typedef struct uCellPrivateNet_t {
     struct uCellPrivateNet_t *pNext;
 } uCellPrivateNet_t;
 
+/** A location fix, as cached by the cell loc API.
+ */
+typedef struct {
+    int32_t latitudeX1e7;
+    int32_t longitudeX1e7;
+    int32_t altitudeMillimetres;
+    int32_t radiusMillimetres;
+    int32_t speedMillimetresPerSecond;
+    int32_t svs;
+    int64_t timeUtc;
+    int32_t obtainedAtMs; /**< the tick time at which the fix was obtained,
+                               -1 if there is no fix stored. */
+} uCellPrivateLocFix_t;
+
 /** Context for the cell loc API.
  */
 typedef struct {
@@ -329,6 +564,16 @@ typedef struct {
     uPortMutexHandle_t fixDataStorageMutex;  /**< protect manipulation of fix data storage. */
     void *pFixDataStorage;/**< pointer to data storage used when establishing a fix. */
     int32_t fixStatus;    /**< status of a location fix. */
+    uCellPrivateLocFix_t lastFix; /**< the last successful fix, protected
+                                       by fixDataStorageMutex. */
+    int32_t cacheMaxAgeSeconds; /**< how old lastFix may be and still be
+                                     returned by uCellLocGet(), 0 for never. */
+    int32_t refreshErrorCode;   /**< the outcome of the last fix attempt,
+                                     protected by fixDataStorageMutex. */
+    int32_t refreshEndedAtMs;   /**< the tick time at which the last fix
+                                     attempt ended. */
+    int32_t refreshNumFailures; /**< the number of fix attempts in a row that
+                                     were not usable by the cache. */
 } uCellPrivateLocContext_t;
 
 /** Type to keep track of the deep sleep state.
@@ -343,6 +588,16 @@ typedef enum {
     U_CELL_PRIVATE_MAX_NUM_SLEEP_STATES
 } uCellPrivateDeepSleepState_t;
 
+/** A non-urgent operation deferred with uCellPwrDefer().
+ */
+typedef struct uCellPrivateDefer_t {
+    void (*pOperation) (uDeviceHandle_t, void *);
+    void *pParameter;
+    int32_t deadlineMs; /**< the uPortGetTickTimeMs() by which
+                             the operation must be run. */
+    struct uCellPrivateDefer_t *pNext;
+} uCellPrivateDefer_t;
+
 /** Structure to keep track of all things deep sleep related.
  */
 typedef struct {
@@ -357,6 +612,8 @@ typedef struct {
     void *pEDrxCallbackParam; /**< User parameter to pEDrxCallback. */
     void (*pWakeUpCallback) (uDeviceHandle_t, void *); /**< A callback that can be called when a module is awoken from deep sleep. */
     void *pWakeUpCallbackParam; /**< Parameter provided by the user and passed to pWakeUpCallback when called. */
+    uCellPrivateDefer_t *pDeferList; /**< Operations deferred with uCellPwrDefer(), earliest deadline first. */
+    uPortTimerHandle_t deferTimer; /**< Timer for the earliest deadline in pDeferList. */
     // *INDENT-ON*
 } uCellPrivateSleep_t;
 
@@ -394,6 +651,64 @@ typedef struct uCellPrivateFileListContainer_t {
     struct uCellPrivateFileListContainer_t *pNext;
 } uCellPrivateFileListContainer_t;
 
+/** An entry in uCellPrivateFileCache_t; the null-terminated file
+ * name is stored in the space immediately following the structure.
+ */
+typedef struct uCellPrivateFileCacheEntry_t {
+    int32_t size;  /**< The size of the file, -1 if not known. */
+    struct uCellPrivateFileCacheEntry_t *pNext;
+} uCellPrivateFileCacheEntry_t;
+
+/** Cache of the directory of the file system in the tagged area
+ * currently being addressed, maintained by the file functions of
+ * this library so that existence and size checks don't need to
+ * trouble the module.
+ */
+typedef struct {
+    bool complete;   /**< True if pEntries is the whole directory,
+                          i.e. a file that is not in it does not exist. */
+    size_t numEntries;
+    uCellPrivateFileCacheEntry_t *pEntries;
+} uCellPrivateFileCache_t;
+
+/** The identity strings held in uCellPrivateIdCache_t.
+ */
+typedef enum {
+    U_CELL_PRIVATE_ID_STRING_ICCID,
+    U_CELL_PRIVATE_ID_STRING_MODEL,
+    U_CELL_PRIVATE_ID_STRING_FIRMWARE_VERSION,
+    U_CELL_PRIVATE_ID_STRING_MAX_NUM
+} uCellPrivateIdString_t;
+
+/** Cache of the static identity information of a module and its
+ * SIM, populated on first read and cleared when the module reboots
+ * or the SIM may have changed.
+ */
+typedef struct {
+    char imei[15];       /**< The IMEI, NOT null terminated. */
+    bool imeiValid;      /**< True if imei is populated. */
+    char imsi[15];       /**< The IMSI, NOT null terminated. */
+    bool imsiValid;      /**< True if imsi is populated. */
+    char string[U_CELL_PRIVATE_ID_STRING_MAX_NUM][U_CELL_PRIVATE_ID_CACHE_STRING_LENGTH_BYTES]; /**< The
+                                                                                                     null-terminated
+                                                                                                     strings. */
+    int32_t stringLength[U_CELL_PRIVATE_ID_STRING_MAX_NUM]; /**< The length of each
+                                                                 string, negative if
+                                                                 it is not cached. */
+} uCellPrivateIdCache_t;
+
+/** Context for the data counter sampler, see
+ * uCellNetDataCounterSamplerStart().
+ */
+typedef struct {
+    uPortTimerHandle_t timer; /**< The periodic sample timer, NULL if
+                                   sampling only at deactivation. */
+    int32_t intervalMs;       /**< The period of timer. */
+    uCellNetDataCounterSample_t sample[U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH];
+    size_t oldest;            /**< The index of the oldest entry in sample[]. */
+    size_t count;             /**< The number of entries in sample[]. */
+} uCellPrivateDataCounterSampler_t;
+
 /** Definition of a cellular instance.
  */
 typedef struct uCellPrivateInstance_t {
@@ -425,6 +740,7 @@ typedef struct uCellPrivateInstance_t {
     networkStatus[U_CELL_NET_REG_DOMAIN_MAX_NUM]; /**< Registation status in each domain. */
     uCellNetRat_t rat[U_CELL_NET_REG_DOMAIN_MAX_NUM];  /**< The active RAT for each domain. */
     uCellPrivateRadioParameters_t radioParameters; /**< The radio parameters. */
+    int32_t radioParametersMaxAgeMs; /**< See uCellInfoSetRadioParametersMaxAge(). */
     int32_t startTimeMs;     /**< Used while connecting and scanning. */
     int32_t connectedAtMs;   /**< When a connection was last established,
                                   can be used for offsetting from that time;
@@ -433,15 +749,32 @@ typedef struct uCellPrivateInstance_t {
                                   required, e.g. as a result of a configuration
                                   change. */
     int32_t mnoProfile;     /**< The active MNO profile, populated at boot. */
+    uint32_t configFingerprint; /**< The fingerprint of the persistent configuration
+                                     last applied to the module, zero if not known. */
+    bool fastBoot;           /**< If true, persistent configuration is skipped at
+                                  power-on when configFingerprint matches. */
+    bool warmAttach;         /**< See uCellPwrSetWarmAttach(). */
     bool (*pKeepGoingCallback) (uDeviceHandle_t cellHandle);  /**< Used while connecting. */
+    bool registrationPollingOff; /**< See uCellNetSetRegistrationPolling(). */
     void (*pRegistrationStatusCallback) (uCellNetRegDomain_t, uCellNetStatus_t, void *);
     void *pRegistrationStatusCallbackParameter;
     void (*pConnectionStatusCallback) (bool, void *);
     void *pConnectionStatusCallbackParameter;
     void (*pGreetingCallback) (uDeviceHandle_t, void *);
     void *pGreetingCallbackParameter;
+    bool greetingAtBoot;     /**< True if a greeting URC handler is in place
+                                  and the module will emit the greeting as soon
+                                  as it has booted, so that power-on can wait
+                                  for it rather than poll with "AT". */
+    volatile bool greetingReceived; /**< Set by the greeting URC handler. */
     uCellPrivateNet_t *pScanResults;    /**< Anchor for list of network scan results. */
+    uCellPrivateNet_t *pScanCache;      /**< A copy of the last successful scan results. */
+    bool scanCached;         /**< True if pScanCache is populated (it might be empty). */
+    int32_t scanCacheTimeMs; /**< When pScanCache was populated. */
+    int32_t scanCacheMaxAgeMs; /**< See uCellNetSetScanCacheMaxAge(). */
     int32_t sockNextLocalPort;
+    int32_t sockNextContextId; /**< The PDP context that the next socket
+                                    will be bound to, -1 for the default. */
     uint32_t gnssAidMode;  /**< A bit-map of the types of aiding to use (AssistNow Online, Offline, Autonomous, etc.). */
     uint32_t gnssSystemTypesBitMap;  /**< A bit-map of the GNSS system types (GPS, GLONASS, etc.) a GNSS chip should use. */
     volatile void *pMqttContext; /**< Hook for MQTT context, volatile as it
@@ -458,10 +791,24 @@ typedef struct uCellPrivateInstance_t {
     void *pFotaContext; /**< FOTA context, lodged here as a void * to
                              avoid spreading its types all over. */
     void *pHttpContext;  /**< Hook for a HTTP context. */
+    size_t muxInformationLengthBytes; /**< N1 for the next uCellMuxEnable(), 0 for default. */
     void *pMuxContext; /**< CMUX context, lodged here as a void * to
                             avoid spreading its types all over. */
     void *pCellTimeContext;  /**< Hook for CellTime context. */
     void *pCellTimeCellSyncContext;   /**< Hook for CellTime cell synchronisation context. */
+    uCellPrivateIdCache_t *pIdCache; /**< Cached identity information, NULL
+                                          until something is first cached. */
+    uCellPrivateDataCounterSampler_t *pDataCounterSampler; /**< NULL unless the
+                                                                data counter
+                                                                sampler is running. */
+    int32_t baudRateRestore; /**< If uCellCfgUpgradeBaudRate() has changed the
+                                  baud rate, the rate to return this MCU's
+                                  UART to when the module restarts, else zero. */
+    uCellPrivateFileCache_t *pFileCache; /**< Cached file system directory, NULL
+                                              until something is first cached. */
+    volatile bool fileCacheStale; /**< Set, e.g. by a URC, when the module may
+                                       have written a file itself; the file
+                                       cache is cleared when it is next used. */
     struct uCellPrivateInstance_t *pNext;
 } uCellPrivateInstance_t;
 
@@ -509,7 +856,9 @@ void uCellPrivateAbortAtCommand(const uCellPrivateInstance_t *pInstance);
  */
 bool uCellPrivateIsNumeric(const char *pBuffer, size_t bufferSize);
 
-/** Find a cellular instance in the list by instance handle.
+/** Find a cellular instance by instance handle; this does not
+ * search the list, the instance is found through the device
+ * instance that the handle points to.
  *
  * Note: gUCellPrivateMutex should be locked before this is called.
  *
@@ -569,6 +918,15 @@ void uCellPrivateClearRadioParameters(uCellPrivateRadioParameters_t *pParameters
  */
 void uCellPrivateClearDynamicParameters(uCellPrivateInstance_t *pInstance);
 
+/** If uCellCfgUpgradeBaudRate() has changed the baud rate, return
+ * this MCU's UART to the baud rate it had before, the one the module
+ * will come back at; this should be called once the module has
+ * gone down for a reboot, a power off or deep sleep.
+ *
+ * @param pInstance a pointer to the instance.
+ */
+void uCellPrivateBaudRateRestore(uCellPrivateInstance_t *pInstance);
+
 /** Get the current AT+CFUN mode of the module.
  *
  * @param pInstance  pointer to the cellular instance.
@@ -598,12 +956,15 @@ void uCellPrivateCFunMode(uCellPrivateInstance_t *pInstance,
  *
  * Note: gUCellPrivateMutex should be locked before this is called.
  *
+ * The IMSI is cached: only the first call after a reboot, or after
+ * the SIM may have changed, goes to the module.
+ *
  * @param pInstance  a pointer to the cellular instance.
  * @param pImsi      a pointer to 15 bytes in which the IMSI
  *                   will be stored.
  * @return           zero on success else negative error code.
  */
-int32_t uCellPrivateGetImsi(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateGetImsi(uCellPrivateInstance_t *pInstance,
                             char *pImsi);
 
 /** Get the IMEI of the module.
@@ -611,13 +972,41 @@ int32_t uCellPrivateGetImsi(const uCellPrivateInstance_t *pInstance,
  * Note: gUCellPrivateMutex should be locked before this is called.
  *
  * @param pInstance  a pointer to the cellular instance.
+ * The IMEI is cached: only the first call after a reboot goes
+ * to the module.
+ *
+ * @param pInstance  a pointer to the cellular instance.
  * @param pImei      a pointer to 15 bytes in which the IMEI
  *                   will be stored.
  * @return           zero on success else negative error code.
  */
-int32_t uCellPrivateGetImei(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateGetImei(uCellPrivateInstance_t *pInstance,
                             char *pImei);
 
+/** Get the identity cache of an instance, creating it if it does
+ * not already exist.
+ *
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance  a pointer to the cellular instance.
+ * @return           a pointer to the identity cache, NULL if
+ *                   there is not enough memory to create it.
+ */
+uCellPrivateIdCache_t *pUCellPrivateGetIdCache(uCellPrivateInstance_t *pInstance);
+
+/** Clear the identity cache of an instance; call this when the
+ * module has rebooted or when the SIM may have changed.  The
+ * memory of the cache is retained.
+ *
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance  a pointer to the cellular instance.
+ * @param simOnly    if true only the information that belongs to
+ *                   the SIM (IMSI and ICCID) is cleared.
+ */
+void uCellPrivateIdCacheClear(uCellPrivateInstance_t *pInstance,
+                              bool simOnly);
+
 /** Get whether the given instance is registered with the network.
  *
  * Note: gUCellPrivateMutex should be locked before this is called.
@@ -819,7 +1208,7 @@ int32_t uCellPrivateResumeUartPowerSaving(const uCellPrivateInstance_t *pInstanc
  *                       characters: / * : % | " < > ?.
  * @return               zero on success or negative error code on failure.
  */
-int32_t uCellPrivateFileDelete(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateFileDelete(uCellPrivateInstance_t *pInstance,
                                const char *pFileName);
 
 /** Get the description of file stored on the file system;
@@ -840,7 +1229,7 @@ int32_t uCellPrivateFileDelete(const uCellPrivateInstance_t *pInstance,
  * @return                    the total number of file names in the list
  *                            or negative error code.
  */
-int32_t uCellPrivateFileListFirst(const uCellPrivateInstance_t *pInstance,
+int32_t uCellPrivateFileListFirst(uCellPrivateInstance_t *pInstance,
                                   uCellPrivateFileListContainer_t **ppFileListContainer,
                                   char *pFileName);
 
@@ -874,6 +1263,52 @@ int32_t uCellPrivateFileListNext(uCellPrivateFileListContainer_t **ppFileListCon
  */
 void uCellPrivateFileListLast(uCellPrivateFileListContainer_t **ppFileListContainer);
 
+/** Free the file system directory cache of an instance.
+ *
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance  a pointer to the cellular instance.
+ */
+void uCellPrivateFileCacheClear(uCellPrivateInstance_t *pInstance);
+
+/** Get the size of a file from the file system directory cache.
+ *
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance      a pointer to the cellular instance.
+ * @param[in] pFileName  the file name.
+ * @return               the size of the file if it is known,
+ *                       #U_ERROR_COMMON_NOT_FOUND if the file is known
+ *                       not to exist, else #U_ERROR_COMMON_UNKNOWN, in
+ *                       which case the module must be asked.
+ */
+int32_t uCellPrivateFileCacheGetSize(uCellPrivateInstance_t *pInstance,
+                                     const char *pFileName);
+
+/** Record in the file system directory cache that a file exists
+ * and has the given size.
+ *
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance      a pointer to the cellular instance.
+ * @param[in] pFileName  the file name.
+ * @param size           the size of the file, -1 if not known.
+ */
+void uCellPrivateFileCacheSetSize(uCellPrivateInstance_t *pInstance,
+                                  const char *pFileName, int32_t size);
+
+/** Record in the file system directory cache that data has been
+ * appended to a file, which may or may not have existed before.
+ *
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance      a pointer to the cellular instance.
+ * @param[in] pFileName  the file name.
+ * @param length         the number of bytes appended.
+ */
+void uCellPrivateFileCacheAppend(uCellPrivateInstance_t *pInstance,
+                                 const char *pFileName, size_t length);
+
 /** Remove the HTTP context for the given instance.
  *
  * Note:  gUCellPrivateMutex and the linked list mutex of the HTTP
@@ -949,6 +1384,29 @@ bool uCellPrivateGnssInsideCell(const uCellPrivateInstance_t *pInstance);
  */
 void uCellPrivateCellTimeRemoveContext(uCellPrivateInstance_t *pInstance);
 
+/** Remove the data counter sampler context for the given instance,
+ * stopping the sampler.
+ *
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param pInstance   a pointer to the cellular instance.
+ */
+void uCellPrivateDataCounterSamplerRemoveContext(uCellPrivateInstance_t *pInstance);
+
+/** Estimate the number of seconds until a FOTA download completes,
+ * assuming that progress continues at the rate seen so far.
+ *
+ * @param elapsedMs       the time since the download was first seen.
+ * @param startPercentage the percentage at which the download was
+ *                        first seen.
+ * @param percentage      the percentage now reported.
+ * @return                the estimated number of seconds to
+ *                        completion, -1 if no estimate can be made.
+ */
+int32_t uCellPrivateFotaEtaSeconds(int32_t elapsedMs,
+                                   int32_t startPercentage,
+                                   int32_t percentage);
+
 #ifdef __cplusplus
 }
 #endif
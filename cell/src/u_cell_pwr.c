@@ -33,7 +33,7 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
-#include "string.h"    // strlen()
+#include "string.h"    // strlen(), memset()
 
 #include "u_cfg_sw.h"
 
@@ -60,6 +60,7 @@
 #include "u_cell_mux_private.h"
 #include "u_cell_pwr.h"
 #include "u_cell_pwr_private.h"
+#include "u_cell_net_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -74,6 +75,11 @@
  */
 #define U_CELL_PWR_CONFIGURATION_COMMAND_TRIES 3
 
+/** How often to check for the arrival of the greeting message
+ * while waiting for the module to boot.
+ */
+#define U_CELL_PWR_GREETING_CHECK_INTERVAL_MS 10
+
 /** The UART power saving duration in GSM frames, needed for the
  * UART power saving AT command.
  */
@@ -152,10 +158,6 @@ static const char *const gpConfigCommand[] = {"ATE0",      // Echo off
 // really is a good 1.8V SIM.
                                               "AT+UDCONF=92,1,1",
 #endif
-// SARA-R5xxx-01B remembers whether sockets are in hex mode or
-// not so reset that here in order that all modules behave the
-// same way
-                                              "AT+UDCONF=1,0",
                                               "ATI9",      // Firmware version
                                               "AT&C1",     // DCD circuit (109) changes with the carrier
                                               "AT&D0"      // Ignore changes to DTR
@@ -810,6 +812,135 @@ static int32_t setEDrxUrc(const uCellPrivateInstance_t *pInstance)
     return errorCode;
 }
 
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: DEFERRED OPERATIONS
+ * -------------------------------------------------------------- */
+
+// Return true if there is nothing to be gained by deferring an
+// operation: 3GPP power saving has not been agreed or VInt shows
+// that the module is awake right now.
+// gUCellPrivateMutex should be locked before this is called.
+static bool deferIsPointless(uCellPrivateInstance_t *pInstance)
+{
+    uCellPrivateSleep_t *pContext = pInstance->pSleepContext;
+
+    return (pContext == NULL) || !pContext->powerSaving3gppAgreed ||
+           ((pInstance->pinVInt >= 0) && !uCellPrivateIsDeepSleepActive(pInstance));
+}
+
+// Run all of the deferred operations of an instance; this is
+// called through the uAtClientCallback() mechanism so that the
+// operations are free to call the cellular API.
+static void deferRunCallback(uAtClientHandle_t atHandle, void *pParameter)
+{
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
+    uCellPrivateSleep_t *pContext;
+    uCellPrivateDefer_t *pList = NULL;
+    uCellPrivateDefer_t *pDefer;
+    uDeviceHandle_t cellHandle = NULL;
+    bool holding = false;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pContext = pInstance->pSleepContext;
+        if (pContext != NULL) {
+            // Take the lot, anything deferred from here on
+            // will go into a new list
+            pList = pContext->pDeferList;
+            pContext->pDeferList = NULL;
+            if (pContext->deferTimer != NULL) {
+                uPortTimerStop(pContext->deferTimer);
+            }
+        }
+        cellHandle = pInstance->cellHandle;
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+
+        // Run the operations with the API unlocked since
+        // they will no doubt want to call it; if there is a DTR
+        // pin, hold it on throughout so that the module is woken
+        // once for the batch rather than once per AT command
+        if (pList != NULL) {
+            holding = (uAtClientActivityPinHold(atHandle, true) == 0);
+        }
+        while (pList != NULL) {
+            pDefer = pList;
+            pList = pDefer->pNext;
+            pDefer->pOperation(cellHandle, pDefer->pParameter);
+            uPortFree(pDefer);
+        }
+        if (holding) {
+            uAtClientActivityPinHold(atHandle, false);
+        }
+    }
+}
+
+// Start running the deferred operations of an instance, if
+// there are any.
+// gUCellPrivateMutex should be locked before this is called,
+// except by UUPSMR_urc(), which can only look; deferRunCallback()
+// copes with finding nothing to do.
+static void deferRun(uCellPrivateInstance_t *pInstance)
+{
+    if ((pInstance->pSleepContext != NULL) &&
+        (pInstance->pSleepContext->pDeferList != NULL)) {
+        uAtClientCallback(pInstance->atHandle, deferRunCallback, pInstance);
+    }
+}
+
+// Timer callback for the earliest deadline of the deferred
+// operations: since a timer callback must not block, hand over
+// to deferRunCallback().
+static void deferTimerCallback(const uPortTimerHandle_t timerHandle,
+                               void *pParam)
+{
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParam;
+
+    (void) timerHandle;
+
+    uAtClientCallback(pInstance->atHandle, deferRunCallback, pInstance);
+}
+
+// Set the deferred operation timer running for the earliest
+// deadline, or stop it if there is nothing waiting.
+// gUCellPrivateMutex should be locked before this is called.
+static int32_t deferTimerSet(uCellPrivateInstance_t *pInstance)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    uCellPrivateSleep_t *pContext = pInstance->pSleepContext;
+    int32_t intervalMs;
+
+    if (pContext->pDeferList == NULL) {
+        if (pContext->deferTimer != NULL) {
+            uPortTimerStop(pContext->deferTimer);
+        }
+    } else {
+        intervalMs = pContext->pDeferList->deadlineMs - uPortGetTickTimeMs();
+        if (intervalMs < 1) {
+            intervalMs = 1;
+        }
+        if (pContext->deferTimer == NULL) {
+            errorCode = uPortTimerCreate(&(pContext->deferTimer), "cellDefer",
+                                         deferTimerCallback, pInstance,
+                                         (uint32_t) intervalMs, false);
+            if (errorCode != 0) {
+                pContext->deferTimer = NULL;
+            }
+        } else {
+            uPortTimerStop(pContext->deferTimer);
+            errorCode = uPortTimerChange(pContext->deferTimer,
+                                         (uint32_t) intervalMs);
+        }
+        if (errorCode == 0) {
+            errorCode = uPortTimerStart(pContext->deferTimer);
+        }
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: DEEP SLEEP
  * -------------------------------------------------------------- */
@@ -846,6 +977,10 @@ static void UUPSMR_urc(uAtClientHandle_t atHandle, void *pParameter)
     // 2 means sleep is blocked.
     if (x == 1) {
         pInstance->deepSleepState = U_CELL_PRIVATE_DEEP_SLEEP_STATE_PROTOCOL_STACK_ASLEEP;
+    } else if (x == 0) {
+        // Whatever woke the module up, it is awake now and so
+        // this is a good time to run any deferred operations
+        deferRun(pInstance);
     }
     pInstance->deepSleepBlockedBy = -1;
     if (x == 2) {
@@ -902,6 +1037,34 @@ static int32_t moduleIsAlive(uCellPrivateInstance_t *pInstance,
     return errorCode;
 }
 
+// Return true if the arrival of the greeting message can be used
+// to tell that the module has booted; note that the module does
+// not emit the greeting at boot if DTR is used for power saving.
+static bool greetingAtBoot(const uCellPrivateInstance_t *pInstance)
+{
+    return pInstance->greetingAtBoot && (pInstance->pinDtrPowerSaving < 0);
+}
+
+// Wait up to waitMs for the greeting message, which must have been
+// cleared before the module was booted, returning true if it arrived.
+static bool greetingWait(uCellPrivateInstance_t *pInstance, int32_t waitMs,
+                         bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    while (!pInstance->greetingReceived &&
+           (uPortGetTickTimeMs() - startTimeMs < waitMs) &&
+           ((pKeepGoingCallback == NULL) || pKeepGoingCallback(pInstance->cellHandle))) {
+        uPortTaskBlock(U_CELL_PWR_GREETING_CHECK_INTERVAL_MS);
+    }
+    if (pInstance->greetingReceived) {
+        uPortLog("U_CELL_PWR: greeting received after %d ms.\n",
+                 uPortGetTickTimeMs() - startTimeMs);
+    }
+
+    return pInstance->greetingReceived;
+}
+
 // Configure one item in the cellular module.
 static bool moduleConfigureOne(uAtClientHandle_t atHandle,
                                const char *pAtString,
@@ -918,6 +1081,56 @@ static bool moduleConfigureOne(uAtClientHandle_t atHandle,
     return success;
 }
 
+// Read the sockets hex mode setting, AT+UDCONF=1, from the
+// cellular module, returning -1 if it cannot be read.
+static int32_t getSocketsHexMode(uAtClientHandle_t atHandle)
+{
+    int32_t hexMode;
+
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UDCONF=");
+    uAtClientWriteInt(atHandle, 1);
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, "+UDCONF:");
+    // Skip the first parameter, which is just our 1 again
+    uAtClientSkipParameters(atHandle, 1);
+    hexMode = uAtClientReadInt(atHandle);
+    uAtClientResponseStop(atHandle);
+    if (uAtClientUnlock(atHandle) != 0) {
+        hexMode = -1;
+    }
+
+    return hexMode;
+}
+
+// Work out the fingerprint of the persistent configuration of
+// the cellular module, never zero, from the sockets hex mode
+// and GNSS profile settings (negative if they cannot be read);
+// pInstance->mnoProfile must have been populated.
+static uint32_t configFingerprint(const uCellPrivateInstance_t *pInstance,
+                                  int32_t hexMode, int32_t gnssProfile)
+{
+    // FNV-1a
+    uint32_t fingerprint = 2166136261U;
+    int32_t value[] = {(int32_t) pInstance->pModule->moduleType,
+                       pInstance->mnoProfile,
+                       hexMode,
+                       gnssProfile
+                      };
+
+    for (size_t x = 0; x < sizeof(value) / sizeof(value[0]); x++) {
+        for (size_t y = 0; y < sizeof(value[x]); y++) {
+            fingerprint ^= (((uint32_t) value[x]) >> (y * 8)) & 0xFF;
+            fingerprint *= 16777619U;
+        }
+    }
+    if (fingerprint == 0) {
+        fingerprint = 1;
+    }
+
+    return fingerprint;
+}
+
 // Configure the cellular module.
 static int32_t moduleConfigure(uCellPrivateInstance_t *pInstance,
                                bool andRadioOff, bool returningFromSleep)
@@ -929,14 +1142,29 @@ static int32_t moduleConfigure(uCellPrivateInstance_t *pInstance,
     uCellPwrPsvMode_t uartPowerSavingMode = U_CELL_PWR_PSV_MODE_DISABLED; // Assume no UART power saving
     char buffer[20]; // Enough room for AT+UPSV=2,1300
     char *pServerNameGnss;
-    int32_t y;
-
-    // First send all the commands that everyone gets
+    int32_t hexMode;
+    int32_t gnssProfile = -1;
+    int32_t readyMs;
+    uint32_t fingerprint;
+    uAtClientPipelineCommand_t configCommand[sizeof(gpConfigCommand) / sizeof(gpConfigCommand[0])];
+
+    // First send all the commands that everyone gets, as a
+    // pipeline with one command in flight, which keeps the
+    // inter-command delay that the module needs, then retry
+    // individually any that failed
+    memset(configCommand, 0, sizeof(configCommand));
+    for (size_t x = 0; x < sizeof(configCommand) / sizeof(configCommand[0]); x++) {
+        configCommand[x].pCommand = gpConfigCommand[x];
+    }
+    uAtClientPipeline(atHandle, configCommand,
+                      sizeof(configCommand) / sizeof(configCommand[0]), 1);
     for (size_t x = 0;
-         (x < sizeof(gpConfigCommand) / sizeof(gpConfigCommand[0])) &&
+         (x < sizeof(configCommand) / sizeof(configCommand[0])) &&
          success; x++) {
-        success = moduleConfigureOne(atHandle, gpConfigCommand[x],
-                                     U_CELL_PWR_CONFIGURATION_COMMAND_TRIES);
+        if (configCommand[x].errorCode != 0) {
+            success = moduleConfigureOne(atHandle, gpConfigCommand[x],
+                                         U_CELL_PWR_CONFIGURATION_COMMAND_TRIES);
+        }
     }
 
     if (success &&
@@ -1056,10 +1284,17 @@ static int32_t moduleConfigure(uCellPrivateInstance_t *pInstance,
             uPortLog("U_CELL_PWR: power saving not supported.\n");
         }
         // Now tell the AT Client that it should control the
-        // DTR pin, if relevant
+        // DTR pin, if relevant; if CTS flow control is on then
+        // the UART will hold off transmission until the module
+        // is ready, so there is no need to wait the full time
         if (!returningFromSleep && (uartPowerSavingMode == U_CELL_PWR_PSV_MODE_DTR)) {
+            readyMs = U_CELL_PWR_UART_POWER_SAVING_DTR_READY_MS;
+            if ((stream.type == U_AT_CLIENT_STREAM_TYPE_UART) &&
+                uPortUartIsCtsFlowControlEnabled(stream.handle.int32)) {
+                readyMs = U_CELL_PWR_UART_POWER_SAVING_DTR_READY_CTS_MS;
+            }
             uAtClientSetActivityPin(atHandle, pInstance->pinDtrPowerSaving,
-                                    U_CELL_PWR_UART_POWER_SAVING_DTR_READY_MS,
+                                    readyMs,
                                     U_CELL_PWR_UART_POWER_SAVING_DTR_HYSTERESIS_MS,
                                     U_CELL_PRIVATE_DTR_POWER_SAVING_PIN_ON_STATE(pInstance->pinStates) == 1 ? true : false);
         }
@@ -1073,8 +1308,9 @@ static int32_t moduleConfigure(uCellPrivateInstance_t *pInstance,
                                          U_CELL_PWR_CONFIGURATION_COMMAND_TRIES);
             if (success && !returningFromSleep) {
                 // Add the URC handler if it wasn't there before
-                uAtClientSetUrcHandler(pInstance->atHandle, "+UUPSMR:",
-                                       UUPSMR_urc, pInstance);
+                uAtClientSetUrcHandlerExt(pInstance->atHandle, "+UUPSMR:",
+                                          UUPSMR_urc, pInstance,
+                                          U_AT_CLIENT_URC_PRIORITY_HIGH);
             }
         }
         // Update the sleep parameters; note that we ask for the
@@ -1092,7 +1328,8 @@ static int32_t moduleConfigure(uCellPrivateInstance_t *pInstance,
     }
 
     if (success) {
-        // Retrieve and store the current MNO profile
+        // Retrieve and store the current MNO profile; this is
+        // also the verification query for a fast boot
         pInstance->mnoProfile = -1;
         uAtClientLock(atHandle);
         uAtClientCommandStart(atHandle, "AT+UMNOPROF?");
@@ -1101,27 +1338,58 @@ static int32_t moduleConfigure(uCellPrivateInstance_t *pInstance,
         pInstance->mnoProfile = uAtClientReadInt(atHandle);
         uAtClientResponseStop(atHandle);
         uAtClientUnlock(atHandle);
-        // The module may have a GNSS module inside it or
-        // connected via it, in which case, if we are to use
-        // that module via CMUX rather than via the clunky
-        // AT+UGUBX commands, we need to configure the module
-        // with the AT+UGPRF command to send GNSS output to
-        // the CMUX interface.  This HAS to be done while the
-        // GNSS chip is switched off, so it is best to do it
-        // now.  Don't fail on the outcome here in case this
-        // is not supported for some reason (in which case
-        // we won't be able to use GNSS via cellular)
+        // The non-volatile settings written below are also read
+        // back, so that a change to any of them, e.g. by another
+        // application, defeats fast boot
+        hexMode = getSocketsHexMode(atHandle);
         pServerNameGnss = (char *) pUPortMalloc(U_CELL_CFG_GNSS_SERVER_NAME_MAX_LEN_BYTES);
         if (pServerNameGnss != NULL) {
-            y = uCellPrivateGetGnssProfile(pInstance, pServerNameGnss,
-                                           U_CELL_CFG_GNSS_SERVER_NAME_MAX_LEN_BYTES);
-            if ((y >= 0) && ((y & U_CELL_CFG_GNSS_PROFILE_MUX) == 0)) {
-                y |= U_CELL_CFG_GNSS_PROFILE_MUX;
-                uCellPrivateSetGnssProfile(pInstance, y, pServerNameGnss);
+            gnssProfile = uCellPrivateGetGnssProfile(pInstance, pServerNameGnss,
+                                                     U_CELL_CFG_GNSS_SERVER_NAME_MAX_LEN_BYTES);
+        }
+        fingerprint = configFingerprint(pInstance, hexMode, gnssProfile);
+        if (pInstance->fastBoot && (pServerNameGnss != NULL) &&
+            (pInstance->configFingerprint == fingerprint)) {
+            uPortLog("U_CELL_PWR: configuration fingerprint 0x%08x matches,"
+                     " fast boot.\n", fingerprint);
+        } else {
+            // The settings from here on are kept by the module
+            // in non-volatile memory.
+            // SARA-R5xxx-01B remembers whether sockets are in hex
+            // mode or not so reset that here in order that all
+            // modules behave the same way
+            success = moduleConfigureOne(atHandle, "AT+UDCONF=1,0",
+                                         U_CELL_PWR_CONFIGURATION_COMMAND_TRIES);
+            if (hexMode > 0) {
+                hexMode = 0;
+            }
+            // The module may have a GNSS module inside it or
+            // connected via it, in which case, if we are to use
+            // that module via CMUX rather than via the clunky
+            // AT+UGUBX commands, we need to configure the module
+            // with the AT+UGPRF command to send GNSS output to
+            // the CMUX interface.  This HAS to be done while the
+            // GNSS chip is switched off, so it is best to do it
+            // now.  Don't fail on the outcome here in case this
+            // is not supported for some reason (in which case
+            // we won't be able to use GNSS via cellular)
+            if ((gnssProfile >= 0) && ((gnssProfile & U_CELL_CFG_GNSS_PROFILE_MUX) == 0)) {
+                gnssProfile |= U_CELL_CFG_GNSS_PROFILE_MUX;
+                uCellPrivateSetGnssProfile(pInstance, gnssProfile, pServerNameGnss);
+            }
+            // The fingerprint is that of the settings as they
+            // should now read back
+            pInstance->configFingerprint = 0;
+            if (success && (pInstance->mnoProfile >= 0) && (pServerNameGnss != NULL)) {
+                pInstance->configFingerprint = configFingerprint(pInstance, hexMode,
+                                                                 gnssProfile);
             }
-            // Free memory
-            uPortFree(pServerNameGnss);
         }
+        // Free memory
+        uPortFree(pServerNameGnss);
+    }
+
+    if (success) {
         if (andRadioOff) {
             // Switch the radio off until commanded to connect
             // Wait for flip time to expire
@@ -1179,7 +1447,10 @@ static void waitForPowerOff(uCellPrivateInstance_t *pInstance,
     // We have rebooted
     if (moduleIsOff) {
         pInstance->rebootIsRequired = false;
+        uCellPrivateIdCacheClear(pInstance, false);
     }
+    // The module will come back at its original baud rate
+    uCellPrivateBaudRateRestore(pInstance);
 }
 
 // Power the cellular module off.
@@ -1283,6 +1554,11 @@ int32_t uCellPwrPrivateOn(uCellPrivateInstance_t *pInstance,
     // correctly once more
     pInstance->deepSleepState = U_CELL_PRIVATE_DEEP_SLEEP_STATE_UNKNOWN;
     pInstance->deepSleepBlockedBy = -1;
+    if (asleepAtStart) {
+        // The module will come back from deep sleep at its
+        // original baud rate
+        uCellPrivateBaudRateRestore(pInstance);
+    }
 
     if (pInstance->pinEnablePower >= 0) {
         enablePowerAtStart = uPortGpioGet(pInstance->pinEnablePower);
@@ -1301,6 +1577,16 @@ int32_t uCellPwrPrivateOn(uCellPrivateInstance_t *pInstance,
         ((pInstance->pinVInt < 0) &&
          (moduleIsAlive(pInstance, 1) == 0))) {
         uPortLog("U_CELL_PWR: powering on, module is already on.\n");
+        if (pInstance->warmAttach && !asleepAtStart &&
+            !uCellPrivateIsRegistered(pInstance)) {
+            // This code may have been restarted while the module
+            // carried on: pick up its registration and PDP context
+            // state so that neither is disturbed by what follows
+            if (uCellNetPrivateWarmAttach(pInstance) == 0) {
+                uPortLog("U_CELL_PWR: warm attach, module is registered"
+                         " with an active PDP context.\n");
+            }
+        }
         // Configure the module.  Since it was already
         // powered on we might have been called from
         // a state where everything was already fine
@@ -1325,6 +1611,12 @@ int32_t uCellPwrPrivateOn(uCellPrivateInstance_t *pInstance,
         if (allowPrinting) {
             uPortLog("U_CELL_PWR: powering on.\n");
         }
+        pInstance->greetingReceived = false;
+        if (!asleepAtStart) {
+            // Whatever we knew of the module, and its SIM,
+            // may no longer be true
+            uCellPrivateIdCacheClear(pInstance, false);
+        }
         // First, switch on the volts
         if (!asleepAtStart && (pInstance->pinEnablePower >= 0)) {
             platformError = uPortGpioSet(pInstance->pinEnablePower,
@@ -1354,6 +1646,16 @@ int32_t uCellPwrPrivateOn(uCellPrivateInstance_t *pInstance,
                     }
                 }
             }
+            if (!asleepAtStart && greetingAtBoot(pInstance) &&
+                ((pInstance->pinPwrOn >= 0) ||
+                 ((pInstance->pinEnablePower >= 0) && (enablePowerAtStart == 0)))) {
+                // We've booted the module and it will tell us when
+                // it is ready: wait for that rather than poking it
+                // with "AT" while it boots; if the greeting doesn't
+                // turn up we fall back to poking it anyway
+                greetingWait(pInstance, pInstance->pModule->bootWaitSeconds * 1000,
+                             pKeepGoingCallback);
+            }
             // Cellular module should be up, see if it's there
             // and, if so, configure it
             for (size_t y = U_CELL_PWR_IS_ALIVE_ATTEMPTS_POWER_ON;
@@ -1408,6 +1710,11 @@ int32_t uCellPwrPrivateOn(uCellPrivateInstance_t *pInstance,
         }
     }
 
+    if (asleepAtStart && (errorCode == 0)) {
+        // Having been woken up, run anything that was deferred
+        deferRun(pInstance);
+    }
+
     return errorCode;
 }
 
@@ -1826,6 +2133,7 @@ int32_t uCellPwrOffHard(uDeviceHandle_t cellHandle, bool trulyHard,
                              (int32_t) !U_CELL_PRIVATE_ENABLE_POWER_PIN_ON_STATE(pInstance->pinStates));
                 // Need to disable mux mode
                 uCellMuxPrivateDisable(pInstance);
+                uCellPrivateBaudRateRestore(pInstance);
                 errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
             } else {
                 if (pInstance->pinPwrOn >= 0) {
@@ -1893,6 +2201,105 @@ bool uCellPwrRebootIsRequired(uDeviceHandle_t cellHandle)
 }
 
 
+// Get the configuration fingerprint.
+int32_t uCellPwrGetConfigFingerprint(uDeviceHandle_t cellHandle,
+                                     uint32_t *pFingerprint)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pFingerprint != NULL)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            if (pInstance->configFingerprint != 0) {
+                *pFingerprint = pInstance->configFingerprint;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Switch fast boot on or off.
+int32_t uCellPwrSetConfigFingerprint(uDeviceHandle_t cellHandle,
+                                     uint32_t fingerprint)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            pInstance->fastBoot = (fingerprint != 0);
+            if (pInstance->fastBoot) {
+                pInstance->configFingerprint = fingerprint;
+            }
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Switch warm attach on or off.
+int32_t uCellPwrSetWarmAttach(uDeviceHandle_t cellHandle, bool onNotOff)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            pInstance->warmAttach = onNotOff;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get whether warm attach is on or off.
+bool uCellPwrGetWarmAttach(uDeviceHandle_t cellHandle)
+{
+    bool onNotOff = false;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        if (pInstance != NULL) {
+            onNotOff = pInstance->warmAttach;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return onNotOff;
+}
+
+
 // Re-boot the cellular module.
 int32_t uCellPwrReboot(uDeviceHandle_t cellHandle,
                        bool (*pKeepGoingCallback) (uDeviceHandle_t))
@@ -1925,6 +2332,7 @@ int32_t uCellPwrReboot(uDeviceHandle_t cellHandle,
                                 U_CELL_PRIVATE_AT_CFUN_OFF_RESPONSE_TIME_SECONDS * 1000);
             // Clear the dynamic parameters
             uCellPrivateClearDynamicParameters(pInstance);
+            pInstance->greetingReceived = false;
             uAtClientCommandStart(atHandle, "AT+CFUN=");
             if (pInstance->pModule->moduleType == U_CELL_MODULE_TYPE_SARA_R5) {
                 // SARA-R5 doesn't support 15 (which doesn't reset the SIM)
@@ -1937,8 +2345,17 @@ int32_t uCellPwrReboot(uDeviceHandle_t cellHandle,
             if (errorCode == 0) {
                 // We have rebooted
                 pInstance->rebootIsRequired = false;
-                // Wait for the module to boot
-                uPortTaskBlock(pInstance->pModule->rebootCommandWaitSeconds * 1000);
+                uCellPrivateIdCacheClear(pInstance, false);
+                uCellPrivateBaudRateRestore(pInstance);
+                // Wait for the module to boot, or for it to say that
+                // it has
+                if (greetingAtBoot(pInstance)) {
+                    greetingWait(pInstance,
+                                 pInstance->pModule->rebootCommandWaitSeconds * 1000,
+                                 pKeepGoingCallback);
+                } else {
+                    uPortTaskBlock(pInstance->pModule->rebootCommandWaitSeconds * 1000);
+                }
                 // Two goes at this with a power-off inbetween,
                 // 'cos I've seen some modules
                 // fail during initial configuration.
@@ -2063,6 +2480,7 @@ int32_t uCellPwrResetHard(uDeviceHandle_t cellHandle, int32_t pinReset)
             pInstance->deepSleepState = U_CELL_PRIVATE_DEEP_SLEEP_STATE_UNAVAILABLE;
             // Need to disable mux mode
             uCellMuxPrivateDisable(pInstance);
+            pInstance->greetingReceived = false;
             // Set the RESET pin to the "reset" state
             platformError = uPortGpioSet(pinReset, pinResetToggleToState);
             if (platformError == 0) {
@@ -2075,6 +2493,8 @@ int32_t uCellPwrResetHard(uDeviceHandle_t cellHandle, int32_t pinReset)
                 if (platformError == 0) {
                     // We have rebooted
                     pInstance->rebootIsRequired = false;
+                    uCellPrivateIdCacheClear(pInstance, false);
+                    uCellPrivateBaudRateRestore(pInstance);
                     startTime = uPortGetTickTimeMs();
                     while (uPortGetTickTimeMs() - startTime < resetHoldMilliseconds) {
                         uPortTaskBlock(100);
@@ -2084,8 +2504,15 @@ int32_t uCellPwrResetHard(uDeviceHandle_t cellHandle, int32_t pinReset)
                     // barfed above if there were a problem and there's
                     // nothing we can do about it anyway
                     uPortGpioSet(pinReset, (int32_t) !U_CELL_RESET_PIN_TOGGLE_TO_STATE);
-                    // Wait for the module to boot
-                    uPortTaskBlock(pInstance->pModule->rebootCommandWaitSeconds * 1000);
+                    // Wait for the module to boot, or for it to say that
+                    // it has
+                    if (greetingAtBoot(pInstance)) {
+                        greetingWait(pInstance,
+                                     pInstance->pModule->rebootCommandWaitSeconds * 1000,
+                                     NULL);
+                    } else {
+                        uPortTaskBlock(pInstance->pModule->rebootCommandWaitSeconds * 1000);
+                    }
                     if (pInstance->pModule->moduleType == U_CELL_MODULE_TYPE_SARA_R5) {
                         // SARA-R5 chucks out a load of stuff after
                         // boot in its development version: flush it away
@@ -2784,6 +3211,144 @@ int32_t uCellPwrWakeUpFromDeepSleep(uDeviceHandle_t cellHandle,
     return uCellPwrOn(cellHandle, NULL, pKeepGoingCallback);
 }
 
+// Defer a non-urgent operation.
+int32_t uCellPwrDefer(uDeviceHandle_t cellHandle,
+                      void (*pOperation) (uDeviceHandle_t cellHandle,
+                                          void *pParameter),
+                      void *pParameter, int32_t deadlineMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uCellPrivateDefer_t *pDefer;
+    uCellPrivateDefer_t **ppThis;
+    size_t count = 0;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pOperation != NULL) && (deadlineMs >= 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (pInstance->pSleepContext == NULL) {
+                errorCode = createSleepContext(pInstance);
+            }
+            if (errorCode == 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                for (pDefer = pInstance->pSleepContext->pDeferList; pDefer != NULL;
+                     pDefer = pDefer->pNext) {
+                    count++;
+                }
+                pDefer = NULL;
+                if (count < U_CELL_PWR_DEFER_MAX_NUM) {
+                    pDefer = (uCellPrivateDefer_t *) pUPortMalloc(sizeof(*pDefer));
+                }
+                if (pDefer != NULL) {
+                    pDefer->pOperation = pOperation;
+                    pDefer->pParameter = pParameter;
+                    pDefer->deadlineMs = uPortGetTickTimeMs() + deadlineMs;
+                    // Keep the list in deadline order; comparing
+                    // the difference copes with the tick wrapping
+                    ppThis = &(pInstance->pSleepContext->pDeferList);
+                    while ((*ppThis != NULL) &&
+                           ((*ppThis)->deadlineMs - pDefer->deadlineMs <= 0)) {
+                        ppThis = &((*ppThis)->pNext);
+                    }
+                    pDefer->pNext = *ppThis;
+                    *ppThis = pDefer;
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    if ((deadlineMs == 0) || deferIsPointless(pInstance) ||
+                        // If there are no timers, deadlines can't be
+                        // kept, so just get on with it
+                        (deferTimerSet(pInstance) != 0)) {
+                        deferRun(pInstance);
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Run all deferred operations now.
+int32_t uCellPwrDeferFlush(uDeviceHandle_t cellHandle)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            errorCodeOrCount = 0;
+            if (pInstance->pSleepContext != NULL) {
+                for (uCellPrivateDefer_t *pDefer = pInstance->pSleepContext->pDeferList;
+                     pDefer != NULL; pDefer = pDefer->pNext) {
+                    errorCodeOrCount++;
+                }
+                deferRun(pInstance);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Cancel deferred operations.
+int32_t uCellPwrDeferCancel(uDeviceHandle_t cellHandle,
+                            void (*pOperation) (uDeviceHandle_t cellHandle,
+                                                void *pParameter),
+                            void *pParameter)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uCellPrivateDefer_t **ppThis;
+    uCellPrivateDefer_t *pDefer;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            errorCodeOrCount = 0;
+            if (pInstance->pSleepContext != NULL) {
+                ppThis = &(pInstance->pSleepContext->pDeferList);
+                while (*ppThis != NULL) {
+                    pDefer = *ppThis;
+                    if ((pOperation == NULL) ||
+                        ((pDefer->pOperation == pOperation) &&
+                         (pDefer->pParameter == pParameter))) {
+                        *ppThis = pDefer->pNext;
+                        uPortFree(pDefer);
+                        errorCodeOrCount++;
+                    } else {
+                        ppThis = &(pDefer->pNext);
+                    }
+                }
+                if (errorCodeOrCount > 0) {
+                    // The earliest deadline may have changed
+                    deferTimerSet(pInstance);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCodeOrCount;
+}
+
 // Disable 32 kHz sleep.
 int32_t uCellPwrDisableUartSleep(uDeviceHandle_t cellHandle)
 {
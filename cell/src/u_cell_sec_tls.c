@@ -1273,4 +1273,93 @@ int32_t uCellSecTlsSniGet(const uCellSecTlsContext_t *pContext,
     return gLastErrorCode;
 }
 
+// Set whether TLS session resumption is used.
+int32_t uCellSecTlsSessionResumptionSet(const uCellSecTlsContext_t *pContext,
+                                        bool onNotOff)
+{
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+
+    gLastErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        gLastErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pContext != NULL) {
+            pInstance = pUCellPrivateGetInstance(pContext->cellHandle);
+            if (pInstance != NULL) {
+                gLastErrorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+                if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                       U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SESSION_RESUMPTION)) {
+                    atHandle = pInstance->atHandle;
+                    uAtClientLock(atHandle);
+                    uAtClientCommandStart(atHandle, "AT+USECPRF=");
+                    // Profile ID
+                    uAtClientWriteInt(atHandle, pContext->profileId);
+                    // Session resumption operation
+                    uAtClientWriteInt(atHandle, 13);
+                    uAtClientWriteInt(atHandle, onNotOff ? 1 : 0);
+                    uAtClientCommandStopReadResponse(atHandle);
+                    gLastErrorCode = uAtClientUnlock(atHandle);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return gLastErrorCode;
+}
+
+// Get whether TLS session resumption is used.
+int32_t uCellSecTlsSessionResumptionGet(const uCellSecTlsContext_t *pContext)
+{
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    int32_t x;
+
+    gLastErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        gLastErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pContext != NULL) {
+            pInstance = pUCellPrivateGetInstance(pContext->cellHandle);
+            if (pInstance != NULL) {
+                gLastErrorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+                if (U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                       U_CELL_PRIVATE_FEATURE_SECURITY_TLS_SESSION_RESUMPTION)) {
+                    atHandle = pInstance->atHandle;
+                    uAtClientLock(atHandle);
+                    uAtClientCommandStart(atHandle, "AT+USECPRF=");
+                    // Profile ID
+                    uAtClientWriteInt(atHandle, pContext->profileId);
+                    // Session resumption operation
+                    uAtClientWriteInt(atHandle, 13);
+                    uAtClientCommandStop(atHandle);
+                    // The response is +USECPRF: 0,13,<on/off>
+                    uAtClientResponseStart(atHandle, "+USECPRF:");
+                    // Skip the first two parameters
+                    uAtClientSkipParameters(atHandle, 2);
+                    x = uAtClientReadInt(atHandle);
+                    uAtClientResponseStop(atHandle);
+                    gLastErrorCode = uAtClientUnlock(atHandle);
+                    if (gLastErrorCode == 0) {
+                        gLastErrorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+                        if ((x == 0) || (x == 1)) {
+                            gLastErrorCode = x;
+                        }
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return gLastErrorCode;
+}
+
 // End of file
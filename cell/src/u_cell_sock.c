@@ -36,6 +36,7 @@
 #include "limits.h"    // UINT16_MAX
 
 #include "u_cfg_sw.h"
+#include "u_error_common.h"
 
 #include "u_compiler.h"
 #include "u_port.h"
@@ -53,6 +54,7 @@
 #include "u_cell_module_type.h"
 #include "u_cell_file.h"
 #include "u_cell_net.h"
+#include "u_cell_mux.h"
 #include "u_cell_private.h"
 #include "u_cell_sock.h"
 
@@ -99,6 +101,30 @@
 #define U_CELL_SOCK_SARA_R422_DNS_DELAY_MILLISECONDS 500
 #endif
 
+#ifndef U_CELL_SOCK_MODULE_INDEX_SIZE
+/** The number of module socket IDs, 0 upwards, that can be
+ * looked up directly when a URC arrives; IDs outside this range,
+ * or a clash between two modules, fall back to a search of the
+ * list.
+ */
+# define U_CELL_SOCK_MODULE_INDEX_SIZE 16
+#endif
+
+#ifndef U_CELL_SOCK_UDP_DISCARD_CHUNK_SIZE_BYTES
+/** When a UDP datagram is larger than the buffer it is being
+ * received into, the excess is read into and discarded from a
+ * buffer on the stack of this size.
+ */
+# define U_CELL_SOCK_UDP_DISCARD_CHUNK_SIZE_BYTES 32
+#endif
+
+#ifndef U_CELL_SOCK_TCP_TX_WINDOW_POLL_MS
+/** How often to check, with AT+USOCTL, for room in the TCP
+ * transmit window, see #U_CELL_SOCK_TCP_TX_WINDOW_BYTES.
+ */
+# define U_CELL_SOCK_TCP_TX_WINDOW_POLL_MS 50
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -125,6 +151,24 @@ typedef struct {
     void (*pClosedCallback) (uDeviceHandle_t, int32_t); /**< Set to NULL
                                                      if socket is
                                                      not in use. */
+    char *pRxBuffer; /**< Data read by readAggregateCallback(), NULL if
+                          not yet needed; protected by the AT client
+                          lock. */
+    size_t rxBufferOffset; /**< Where the unread data in pRxBuffer starts. */
+    size_t rxBufferLength; /**< The amount of unread data in pRxBuffer. */
+    int32_t txWindowBytes; /**< What uCellSockWritev() believes is
+                                unacknowledged in the module for a TCP
+                                socket, only brought up to date with
+                                AT+USOCTL when the window appears
+                                full; -1 if the module can't tell us. */
+    uDeviceSerial_t *pDirectLink; /**< The multiplexer channel carrying
+                                       the socket in direct link mode,
+                                       NULL if not in direct link mode. */
+    int32_t contextId; /**< The PDP context the socket is bound to. */
+    bool isStream; /**< True for a TCP socket. */
+    bool readAggregateScheduled; /**< True if this socket has queued a
+                                      readAggregateCallback() that has
+                                      not yet run. */
 } uCellSockSocket_t;
 
 /** Definition of a URC handler.
@@ -145,10 +189,17 @@ static bool gInitialised = false;
  */
 static int32_t gNextSockHandle = 0;
 
-/** The sockets: a nice simple array, nothing fancy.
+/** The sockets: a nice simple array, nothing fancy; the entry
+ * for a socket handle is always at sockHandle modulo the size of
+ * the array, see pSockCreate().
  */
 static uCellSockSocket_t gSockets[U_CELL_SOCK_MAX_NUM_SOCKETS];
 
+/** Index into gSockets[] by module socket ID, so that a URC can
+ * find its socket without a search; -1 where there is none.
+ */
+static int8_t gSockIndexModule[U_CELL_SOCK_MODULE_INDEX_SIZE];
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: LIST MANAGEMENT
  * -------------------------------------------------------------- */
@@ -157,9 +208,10 @@ static uCellSockSocket_t gSockets[U_CELL_SOCK_MAX_NUM_SOCKETS];
 static uCellSockSocket_t *pFindBySockHandle(int32_t sockHandle)
 {
     uCellSockSocket_t *pSock = NULL;
+    size_t x;
 
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
-         (pSock == NULL); x++) {
+    if (sockHandle >= 0) {
+        x = ((size_t) sockHandle) % (sizeof(gSockets) / sizeof(gSockets[0]));
         if (gSockets[x].sockHandle == sockHandle) {
             pSock = &(gSockets[x]);
         }
@@ -168,22 +220,53 @@ static uCellSockSocket_t *pFindBySockHandle(int32_t sockHandle)
     return pSock;
 }
 
+// Record the module socket ID of an entry in gSockIndexModule[].
+static void sockIndexModuleSet(const uCellSockSocket_t *pSock)
+{
+    if ((pSock->sockHandleModule >= 0) &&
+        (pSock->sockHandleModule < (int32_t) (sizeof(gSockIndexModule) / sizeof(gSockIndexModule[0])))) {
+        gSockIndexModule[pSock->sockHandleModule] = (int8_t) (pSock - gSockets);
+    }
+}
+
+// Remove the module socket ID of an entry from gSockIndexModule[].
+static void sockIndexModuleClear(const uCellSockSocket_t *pSock)
+{
+    if ((pSock->sockHandleModule >= 0) &&
+        (pSock->sockHandleModule < (int32_t) (sizeof(gSockIndexModule) / sizeof(gSockIndexModule[0]))) &&
+        (gSockIndexModule[pSock->sockHandleModule] == (int8_t) (pSock - gSockets))) {
+        gSockIndexModule[pSock->sockHandleModule] = -1;
+    }
+}
+
 // Find the entry for the given module socket handle.
 //lint -e{818} suppress "could be declared as pointing to const": it is!
 static uCellSockSocket_t *pFindBySockHandleModule(const uAtClientHandle_t atHandle,
                                                   int32_t sockHandleModule)
 {
     uCellSockSocket_t *pSock = NULL;
+    int32_t x;
 
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
-         (pSock == NULL); x++) {
-        if ((gSockets[x].sockHandle >= 0) &&
+    if ((sockHandleModule >= 0) &&
+        (sockHandleModule < (int32_t) (sizeof(gSockIndexModule) / sizeof(gSockIndexModule[0])))) {
+        x = gSockIndexModule[sockHandleModule];
+        if ((x >= 0) && (gSockets[x].sockHandle >= 0) &&
             (gSockets[x].atHandle == atHandle) &&
             (gSockets[x].sockHandleModule == sockHandleModule)) {
             pSock = &(gSockets[x]);
         }
     }
 
+    // Out of range of the index or a clash between modules
+    for (size_t y = 0; (y < sizeof(gSockets) / sizeof(gSockets[0])) &&
+         (pSock == NULL); y++) {
+        if ((gSockets[y].sockHandle >= 0) &&
+            (gSockets[y].atHandle == atHandle) &&
+            (gSockets[y].sockHandleModule == sockHandleModule)) {
+            pSock = &(gSockets[y]);
+        }
+    }
+
     return pSock;
 }
 
@@ -198,24 +281,31 @@ static void doUsoer(uAtClientHandle_t atHandle)
     uAtClientUnlock(atHandle);
 }
 
-// Create a socket entry in the list.
-static uCellSockSocket_t *pSockCreate(int32_t sockHandle,
-                                      uDeviceHandle_t cellHandle,
+// Create a socket entry in the list; the socket handle is made
+// from gNextSockHandle such that it is the index of the entry
+// modulo the size of the list, which pFindBySockHandle() relies on.
+static uCellSockSocket_t *pSockCreate(uDeviceHandle_t cellHandle,
                                       uAtClientHandle_t atHandle)
 {
     uCellSockSocket_t *pSock = NULL;
+    size_t size = sizeof(gSockets) / sizeof(gSockets[0]);
+    size_t index = 0;
 
     // Find an empty entry in the list
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
-         (pSock == NULL); x++) {
+    for (size_t x = 0; (x < size) && (pSock == NULL); x++) {
         if (gSockets[x].sockHandle < 0) {
             pSock = &(gSockets[x]);
+            index = x;
         }
     }
 
     // Set it up
     if (pSock != NULL) {
-        pSock->sockHandle = sockHandle;
+        if (gNextSockHandle > (int32_t) ((INT32_MAX - index) / size)) {
+            gNextSockHandle = 0;
+        }
+        pSock->sockHandle = (gNextSockHandle * (int32_t) size) + (int32_t) index;
+        gNextSockHandle++;
         pSock->cellHandle = cellHandle;
         pSock->atHandle = atHandle;
         pSock->sockHandleModule = -1;
@@ -223,6 +313,14 @@ static uCellSockSocket_t *pSockCreate(int32_t sockHandle,
         pSock->pAsyncClosedCallback = NULL;
         pSock->pDataCallback = NULL;
         pSock->pClosedCallback = NULL;
+        pSock->pRxBuffer = NULL;
+        pSock->rxBufferOffset = 0;
+        pSock->rxBufferLength = 0;
+        pSock->txWindowBytes = 0;
+        pSock->pDirectLink = NULL;
+        pSock->contextId = U_CELL_NET_CONTEXT_ID;
+        pSock->isStream = false;
+        pSock->readAggregateScheduled = false;
     }
 
     return pSock;
@@ -233,22 +331,270 @@ static void sockFree(int32_t sockHandle)
 {
     uCellSockSocket_t *pSock = NULL;
 
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
-         (pSock == NULL); x++) {
-        if (gSockets[x].sockHandle == sockHandle) {
-            pSock = &(gSockets[x]);
-            pSock->sockHandle = -1;
-            pSock->cellHandle = NULL;
-            pSock->atHandle = NULL;
-            pSock->sockHandleModule = -1;
-            pSock->pendingBytes = 0;
-            pSock->pAsyncClosedCallback = NULL;
-            pSock->pDataCallback = NULL;
-            pSock->pClosedCallback = NULL;
+    pSock = pFindBySockHandle(sockHandle);
+    if (pSock != NULL) {
+        sockIndexModuleClear(pSock);
+        if (pSock->pRxBuffer != NULL) {
+            // readAggregateCallback() may be using the buffer,
+            // which it does with the AT client locked
+            uAtClientLock(pSock->atHandle);
+            uPortFree(pSock->pRxBuffer);
+            pSock->pRxBuffer = NULL;
+            pSock->rxBufferLength = 0;
+            uAtClientUnlock(pSock->atHandle);
         }
+        pSock->sockHandle = -1;
+        pSock->cellHandle = NULL;
+        pSock->atHandle = NULL;
+        pSock->sockHandleModule = -1;
+        pSock->pendingBytes = 0;
+        pSock->pAsyncClosedCallback = NULL;
+        pSock->pDataCallback = NULL;
+        pSock->pClosedCallback = NULL;
     }
 }
 
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: READING
+ * -------------------------------------------------------------- */
+
+// Read up to wantedSize bytes from a TCP socket with AT+USORD
+// into pBuffer, returning the number of bytes read or negated
+// errno.  The AT client must be locked before this is called
+// and is left locked.
+static int32_t usordRead(const uCellPrivateInstance_t *pInstance,
+                         uCellSockSocket_t *pSocket,
+                         char *pBuffer, int32_t wantedSize)
+{
+    int32_t negErrnoLocalOrSize = U_SOCK_ENONE;
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+    int32_t receivedSize;
+    int32_t readLength = 0;
+    int32_t x;
+    char *pHexBuffer = NULL;
+    const char *pHexView = NULL;
+
+    uAtClientCommandStart(atHandle, "AT+USORD=");
+    uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
+    // Number of bytes to read
+    uAtClientWriteInt(atHandle, wantedSize);
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, "+USORD:");
+    // Skip the socket ID
+    uAtClientSkipParameters(atHandle, 1);
+    // Read the amount of data
+    receivedSize = uAtClientReadInt(atHandle);
+    if (receivedSize > wantedSize) {
+        receivedSize = wantedSize;
+    }
+    if (receivedSize > 0) {
+        if (pInstance->socketsHexMode) {
+            // In hex mode, try to decode the hex straight
+            // out of the AT client's receive buffer; only
+            // if the hex string is too large to fit there
+            // do we need a buffer to dump the hex into
+            readLength = uAtClientReadParameterView(atHandle, &pHexView);
+            if (readLength == (int32_t) U_ERROR_COMMON_NO_MEMORY) {
+                pHexView = NULL;
+                negErrnoLocalOrSize = -U_SOCK_ENOMEM;
+                //lint -e{647} Suppress suspicious truncation
+                pHexBuffer = (char *) pUPortMalloc(receivedSize * 2 + 1);  // +1 for terminator
+            }
+        }
+        if (!pInstance->socketsHexMode || (pHexView != NULL) ||
+            (pHexBuffer != NULL)) {
+            negErrnoLocalOrSize = U_SOCK_ENONE;
+            if (pHexView != NULL) {
+                if (readLength > 0) {
+                    x = wantedSize * 2;
+                    if (readLength > x) {
+                        readLength = x;
+                    }
+                    uHexToBin(pHexView, readLength, pBuffer);
+                }
+            } else if (pHexBuffer != NULL) {
+                // In hex mode we can read in the whole string
+                //lint -e{647} Suppress suspicious truncation
+                readLength = uAtClientReadString(atHandle, pHexBuffer,
+                                                 receivedSize * 2 + 1,
+                                                 false);
+                if (readLength > 0) {
+                    x = wantedSize * 2;
+                    if (readLength > x) {
+                        readLength = x;
+                    }
+                    uHexToBin(pHexBuffer, readLength, pBuffer);
+                }
+                // Free memory
+                uPortFree(pHexBuffer);
+            } else {
+                // Binary mode, don't stop for anything!
+                uAtClientIgnoreStopTag(atHandle);
+                // Get the leading quote mark out of the way
+                uAtClientReadBytes(atHandle, NULL, 1, true);
+                // Now read out the available data
+                uAtClientReadBytes(atHandle, pBuffer, receivedSize, true);
+                // Make sure we wait for the stop tag before
+                // going around again
+                uAtClientRestoreStopTag(atHandle);
+            }
+        }
+    }
+    uAtClientResponseStop(atHandle);
+    // BEFORE unlocking, work out what's happened.
+    // This is to prevent a URC being processed that
+    // may indicate data left and over-write pendingBytes
+    // while we're also writing to it.
+    if ((uAtClientErrorGet(atHandle) == 0) && (receivedSize >= 0)) {
+        // Must use what +USORD returns here as it may be less
+        // or more than we asked for and also may be
+        // more than pendingBytes, depending on how
+        // the URCs landed
+        // This update of pendingBytes will be overwritten
+        // by the URC but we have to do something here
+        // 'cos we don't get a URC to tell us when pendingBytes
+        // has gone to zero.
+        if (receivedSize > pSocket->pendingBytes) {
+            pSocket->pendingBytes = 0;
+        } else {
+            pSocket->pendingBytes -= receivedSize;
+        }
+        if (negErrnoLocalOrSize == U_SOCK_ENONE) {
+            negErrnoLocalOrSize = receivedSize;
+        }
+    } else {
+        negErrnoLocalOrSize = -U_SOCK_EIO;
+    }
+
+    return negErrnoLocalOrSize;
+}
+
+// Take up to dataSizeBytes from the buffer of a socket that was
+// filled by readAggregateCallback(), returning the number of
+// bytes taken.  The AT client must be locked before this is called.
+static size_t rxBufferTake(uCellSockSocket_t *pSocket, char *pData,
+                           size_t dataSizeBytes)
+{
+    if (dataSizeBytes > pSocket->rxBufferLength) {
+        dataSizeBytes = pSocket->rxBufferLength;
+    }
+    memcpy(pData, pSocket->pRxBuffer + pSocket->rxBufferOffset, dataSizeBytes);
+    pSocket->rxBufferOffset += dataSizeBytes;
+    pSocket->rxBufferLength -= dataSizeBytes;
+    if (pSocket->rxBufferLength == 0) {
+        pSocket->rxBufferOffset = 0;
+    }
+
+    return dataSizeBytes;
+}
+
+#if U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES > 0
+
+// Callback, queued by readAggregateSchedule(), that reads the data
+// waiting on all of the TCP sockets of an AT client into their
+// buffers, locking the AT client just once, and only then calls
+// their data callbacks.
+static void readAggregateCallback(const uAtClientHandle_t atHandle,
+                                  void *pParameter)
+{
+    uCellSockSocket_t *pSocket;
+    uCellPrivateInstance_t *pInstance;
+    int32_t sockHandle[U_CELL_SOCK_MAX_NUM_SOCKETS];
+    int32_t dataLengthMax;
+    int32_t x;
+
+    (void) pParameter;
+
+    uAtClientLock(atHandle);
+    for (size_t y = 0; y < sizeof(gSockets) / sizeof(gSockets[0]); y++) {
+        pSocket = &(gSockets[y]);
+        sockHandle[y] = -1;
+        if ((pSocket->sockHandle >= 0) && (pSocket->atHandle == atHandle)) {
+            // A URC that arrives from now on needs another callback
+            pSocket->readAggregateScheduled = false;
+            if (pSocket->isStream && (pSocket->pendingBytes > 0) &&
+                (pSocket->pDataCallback != NULL)) {
+                // Whatever happens below, the data callback is due
+                sockHandle[y] = pSocket->sockHandle;
+                pInstance = pUCellPrivateGetInstance(pSocket->cellHandle);
+                if (pSocket->pRxBuffer == NULL) {
+                    pSocket->pRxBuffer = (char *) pUPortMalloc(U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES);
+                    pSocket->rxBufferOffset = 0;
+                    pSocket->rxBufferLength = 0;
+                }
+                if ((pInstance != NULL) && (pSocket->pRxBuffer != NULL)) {
+                    dataLengthMax = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
+                    if (pInstance->socketsHexMode) {
+                        dataLengthMax /= 2;
+                    }
+                    x = (int32_t) (U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES -
+                                   (pSocket->rxBufferOffset + pSocket->rxBufferLength));
+                    if (x > dataLengthMax) {
+                        x = dataLengthMax;
+                    }
+                    if (x > 0) {
+                        x = usordRead(pInstance, pSocket,
+                                      pSocket->pRxBuffer + pSocket->rxBufferOffset +
+                                      pSocket->rxBufferLength, x);
+                        if (x > 0) {
+                            pSocket->rxBufferLength += x;
+                        } else if (x < 0) {
+                            // Don't let one socket spoil it for the rest;
+                            // this one's reader will find out for itself
+                            uAtClientClearError(atHandle);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    uAtClientUnlock(atHandle);
+
+    // Now the data callbacks, with the AT client unlocked so that
+    // they may read; re-check the socket as it may have gone
+    for (size_t y = 0; y < sizeof(gSockets) / sizeof(gSockets[0]); y++) {
+        pSocket = &(gSockets[y]);
+        if ((sockHandle[y] >= 0) && (pSocket->sockHandle == sockHandle[y]) &&
+            (pSocket->pDataCallback != NULL)) {
+            pSocket->pDataCallback(pSocket->cellHandle, sockHandle[y]);
+        }
+    }
+}
+
+#endif // #if U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES > 0
+
+// Called from UUSORD_UUSORF_urc() when data has arrived on a socket
+// with a data callback: if that is a TCP socket, make sure that a
+// readAggregateCallback() is queued for its AT client, returning
+// true if so, in which case there is nothing more for the URC to do.
+static bool readAggregateSchedule(uCellSockSocket_t *pSocket)
+{
+    bool scheduled = false;
+#if U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES > 0
+    uAtClientHandle_t atHandle = pSocket->atHandle;
+
+    if (pSocket->isStream) {
+        // If any socket of this AT client has queued a callback
+        // that has not yet run, that callback will do for us too
+        for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
+             !scheduled; x++) {
+            scheduled = (gSockets[x].sockHandle >= 0) &&
+                        (gSockets[x].atHandle == atHandle) &&
+                        gSockets[x].readAggregateScheduled;
+        }
+        if (!scheduled &&
+            (uAtClientCallback(atHandle, readAggregateCallback, NULL) == 0)) {
+            pSocket->readAggregateScheduled = true;
+            scheduled = true;
+        }
+    }
+#else
+    (void) pSocket;
+#endif
+
+    return scheduled;
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: URC AND RELATED FUNCTIONS
  * -------------------------------------------------------------- */
@@ -330,14 +676,16 @@ static void UUSORD_UUSORF_urc(const uAtClientHandle_t atHandle,
         pSocket = pFindBySockHandleModule(atHandle,
                                           sockHandleModule);
         if (pSocket != NULL) {
-            // Call the user call-back via the trampoline
+            pSocket->pendingBytes = dataSizeBytes;
+            // Call the user call-back via the trampoline, or
+            // via a read of all the sockets with data waiting
             if ((dataSizeBytes > 0) &&
-                (pSocket->pDataCallback != NULL)) {
+                (pSocket->pDataCallback != NULL) &&
+                !readAggregateSchedule(pSocket)) {
                 uAtClientCallback(atHandle,
                                   dataCallback,
                                   U_INT32_TO_PTR(pSocket->sockHandle));
             }
-            pSocket->pendingBytes = dataSizeBytes;
         }
     }
 }
@@ -597,6 +945,9 @@ int32_t setHexMode(uDeviceHandle_t cellHandle, bool hexModeOnNotOff)
         uAtClientCommandStopReadResponse(atHandle);
         if (uAtClientUnlock(atHandle) == 0) {
             pInstance->socketsHexMode = (state == 1);
+            // AT+UDCONF=1 is persistent on some modules, so
+            // no longer the configuration we know
+            pInstance->configFingerprint = 0;
             errnoLocal = U_SOCK_ENONE;
         }
     }
@@ -608,6 +959,83 @@ int32_t setHexMode(uDeviceHandle_t cellHandle, bool hexModeOnNotOff)
  * STATIC FUNCTIONS: MISC
  * -------------------------------------------------------------- */
 
+// Hex-encode into pHexBuffer or, if pHexBuffer is NULL, write to
+// the AT client as binary, length bytes of an I/O vector starting
+// at the given element and offset.
+static void ioVecGather(uAtClientHandle_t atHandle,
+                        const uSockIoVec_t *pIoVec, size_t count,
+                        size_t index, size_t offset,
+                        char *pHexBuffer, size_t length)
+{
+    size_t thisLength;
+    const char *pData;
+
+    while ((length > 0) && (index < count)) {
+        thisLength = pIoVec[index].dataSizeBytes - offset;
+        if (thisLength > length) {
+            thisLength = length;
+        }
+        if (thisLength > 0) {
+            pData = (const char *) pIoVec[index].pData + offset;
+            if (pHexBuffer != NULL) {
+                pHexBuffer += uBinToHex(pData, thisLength, pHexBuffer);
+            } else {
+                uAtClientWriteBytes(atHandle, pData, thisLength, true);
+            }
+            length -= thisLength;
+        }
+        index++;
+        offset = 0;
+    }
+}
+
+// Move a position in an I/O vector on by length bytes.
+static void ioVecAdvance(const uSockIoVec_t *pIoVec, size_t count,
+                         size_t *pIndex, size_t *pOffset, size_t length)
+{
+    size_t thisLength;
+
+    while ((length > 0) && (*pIndex < count)) {
+        thisLength = pIoVec[*pIndex].dataSizeBytes - *pOffset;
+        if (thisLength > length) {
+            *pOffset += length;
+            length = 0;
+        } else {
+            length -= thisLength;
+            (*pIndex)++;
+            *pOffset = 0;
+        }
+    }
+}
+
+// Send AT+USOCTL for an operation with an integer return value
+// and read the answer, -U_SOCK_EIO on failure.
+static int32_t usoctlRead(uAtClientHandle_t atHandle,
+                          int32_t sockHandleModule, int32_t operation)
+{
+    int32_t negErrnoLocallOrValue = -U_SOCK_EIO;
+    int32_t x;
+
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+USOCTL=");
+    uAtClientWriteInt(atHandle, sockHandleModule);
+    uAtClientWriteInt(atHandle, operation);
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, "+USOCTL:");
+    // Skip the first two integers, which
+    // are just the socket ID and our operation number
+    // coming back
+    uAtClientSkipParameters(atHandle, 2);
+    // Now read the integer we actually want
+    x = uAtClientReadInt(atHandle);
+    uAtClientResponseStop(atHandle);
+    if ((uAtClientUnlock(atHandle) == 0) && (x >= 0)) {
+        negErrnoLocallOrValue = x;
+    }
+
+    return negErrnoLocallOrValue;
+}
+
 // Do AT+USOCTL for an operation with an integer return value.
 static int32_t doUsoctl(uDeviceHandle_t cellHandle, int32_t sockHandle,
                         int32_t operation)
@@ -615,35 +1043,17 @@ static int32_t doUsoctl(uDeviceHandle_t cellHandle, int32_t sockHandle,
     int32_t negErrnoLocallOrValue = -U_SOCK_EINVAL;
     uCellPrivateInstance_t *pInstance;
     uCellSockSocket_t *pSocket;
-    uAtClientHandle_t atHandle;
-    int32_t x;
 
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
     if (pInstance != NULL) {
-        atHandle = pInstance->atHandle;
         // Find the entry
         if (sockHandle >= 0) {
             pSocket = pFindBySockHandle(sockHandle);
             if (pSocket != NULL) {
-                negErrnoLocallOrValue = -U_SOCK_EIO;
-                // Do USOCTL 1 to get the last error code
-                uAtClientLock(atHandle);
-                uAtClientCommandStart(atHandle, "AT+USOCTL=");
-                uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                uAtClientWriteInt(atHandle, operation);
-                uAtClientCommandStop(atHandle);
-                uAtClientResponseStart(atHandle, "+USOCTL:");
-                // Skip the first two integers, which
-                // are just the socket ID and our operation number
-                // coming back
-                uAtClientSkipParameters(atHandle, 2);
-                // Now read the integer we actually want
-                x = uAtClientReadInt(atHandle);
-                uAtClientResponseStop(atHandle);
-                if ((uAtClientUnlock(atHandle) == 0) && (x >= 0)) {
-                    negErrnoLocallOrValue = x;
-                }
+                negErrnoLocallOrValue = usoctlRead(pInstance->atHandle,
+                                                   pSocket->sockHandleModule,
+                                                   operation);
             }
         }
     }
@@ -651,6 +1061,87 @@ static int32_t doUsoctl(uDeviceHandle_t cellHandle, int32_t sockHandle,
     return negErrnoLocallOrValue;
 }
 
+// Wait until there is room for sendSize more bytes in the TCP
+// transmit window of a socket, returning false if there is still
+// no room after U_CELL_SOCK_TCP_TX_WINDOW_TIMEOUT_MS; the AT
+// client must NOT be locked.
+static bool txWindowWait(uAtClientHandle_t atHandle,
+                         uCellSockSocket_t *pSocket, int32_t sendSize)
+{
+    bool room = (U_CELL_SOCK_TCP_TX_WINDOW_BYTES <= 0) || !pSocket->isStream ||
+                (pSocket->txWindowBytes < 0) ||
+                (pSocket->txWindowBytes + sendSize <= U_CELL_SOCK_TCP_TX_WINDOW_BYTES);
+    int32_t startTimeMs = uPortGetTickTimeMs();
+    int32_t x;
+
+    while (!room) {
+        // Do USOCTL 11 to get the TCP outgoing unacknowledged data
+        x = usoctlRead(atHandle, pSocket->sockHandleModule, 11);
+        if (x < 0) {
+            // Module can't tell us, don't ask again
+            pSocket->txWindowBytes = -1;
+            room = true;
+        } else {
+            pSocket->txWindowBytes = x;
+            // Always room if nothing is outstanding, in case
+            // the window is smaller than a chunk
+            room = (x == 0) || (x + sendSize <= U_CELL_SOCK_TCP_TX_WINDOW_BYTES);
+            if (!room) {
+                if (uPortGetTickTimeMs() - startTimeMs >= U_CELL_SOCK_TCP_TX_WINDOW_TIMEOUT_MS) {
+                    break;
+                }
+                uPortTaskBlock(U_CELL_SOCK_TCP_TX_WINDOW_POLL_MS);
+            }
+        }
+    }
+
+    return room;
+}
+
+// Leave direct link mode on a socket: the escape sequence is sent,
+// with the guard time either side, any remaining data is discarded
+// while waiting for DISCONNECT and then the multiplexer channel is
+// closed, which will end direct link mode even if the module missed
+// the escape sequence.
+static int32_t directLinkExit(uCellSockSocket_t *pSocket)
+{
+    int32_t negErrnoLocal = -U_SOCK_ETIMEDOUT;
+    uDeviceSerial_t *pDeviceSerial = pSocket->pDirectLink;
+    // Enough for "\r\nDISCONNECT\r\n" plus a null terminator
+    char buffer[16] = {0};
+    size_t length = 0;
+    char c;
+    int32_t startTimeMs;
+
+    uPortTaskBlock(U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS);
+    if (pDeviceSerial->write(pDeviceSerial, "+++", 3) == 3) {
+        uPortTaskBlock(U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS);
+        startTimeMs = uPortGetTickTimeMs();
+        while ((negErrnoLocal == -U_SOCK_ETIMEDOUT) &&
+               (uPortGetTickTimeMs() - startTimeMs < U_CELL_SOCK_DIRECT_LINK_EXIT_TIMEOUT_MS)) {
+            if (pDeviceSerial->read(pDeviceSerial, &c, 1) == 1) {
+                if (length >= sizeof(buffer) - 1) {
+                    // Keep the most recent characters
+                    memmove(buffer, buffer + 1, length - 1);
+                    length--;
+                }
+                buffer[length] = c;
+                length++;
+                buffer[length] = 0;
+                if (strstr(buffer, "DISCONNECT") != NULL) {
+                    negErrnoLocal = U_SOCK_ENONE;
+                }
+            } else {
+                uPortTaskBlock(10);
+            }
+        }
+    }
+    uCellMuxDataClose(pSocket->cellHandle);
+    pSocket->pDirectLink = NULL;
+
+    return negErrnoLocal;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: WORKAROUND FOR LINKER ISSUE
  * -------------------------------------------------------------- */
@@ -680,8 +1171,16 @@ int32_t uCellSockInit()
             pSock->pendingBytes = 0;
             pSock->pDataCallback = NULL;
             pSock->pClosedCallback = NULL;
+            // A socket left open over a previous deinitialisation
+            // may still have a buffer from readAggregateCallback()
+            uPortFree(pSock->pRxBuffer);
+            pSock->pRxBuffer = NULL;
+            pSock->rxBufferLength = 0;
+            pSock->readAggregateScheduled = false;
         }
 
+        memset(gSockIndexModule, -1, sizeof(gSockIndexModule));
+
         gInitialised = true;
     }
 
@@ -698,14 +1197,16 @@ int32_t uCellSockInitInstance(uDeviceHandle_t cellHandle)
         pInstance = pUCellPrivateGetInstance(cellHandle);
         if (pInstance != NULL) {
             errnoLocal = U_SOCK_ENONE;
-            // Set up the URCs
+            // Set up the URCs: these are high priority since data
+            // arriving should be dealt with promptly
             for (size_t x = 0; (x < sizeof(gUrcHandlers) /
                                 sizeof(gUrcHandlers[0])) &&
                  (errnoLocal == U_SOCK_ENONE); x++) {
-                if (uAtClientSetUrcHandler(pInstance->atHandle,
-                                           gUrcHandlers[x].pPrefix,
-                                           gUrcHandlers[x].pHandler,
-                                           NULL) != 0) {
+                if (uAtClientSetUrcHandlerExt(pInstance->atHandle,
+                                              gUrcHandlers[x].pPrefix,
+                                              gUrcHandlers[x].pHandler,
+                                              NULL,
+                                              U_AT_CLIENT_URC_PRIORITY_HIGH) != 0) {
                     errnoLocal = U_SOCK_ENOMEM;
                 }
             }
@@ -747,11 +1248,7 @@ int32_t uCellSockCreate(uDeviceHandle_t cellHandle,
         negErrnoLocal = -U_SOCK_ENOBUFS;
         atHandle = pInstance->atHandle;
         // Create the entry
-        pSocket = pSockCreate(gNextSockHandle, cellHandle, atHandle);
-        gNextSockHandle++;
-        if (gNextSockHandle < 0) {
-            gNextSockHandle = 0;
-        }
+        pSocket = pSockCreate(cellHandle, atHandle);
         if (pSocket != NULL) {
             // Create the socket in the cellular module
             uAtClientLock(atHandle);
@@ -762,6 +1259,18 @@ int32_t uCellSockCreate(uDeviceHandle_t cellHandle,
             if (pInstance->sockNextLocalPort >= 0) {
                 uAtClientWriteInt(atHandle, pInstance->sockNextLocalPort);
                 pInstance->sockNextLocalPort = -1;
+            } else if (pInstance->sockNextContextId >= 0) {
+                // Let the IP stack choose the port
+                uAtClientWriteInt(atHandle, 0);
+            }
+            // User-specified PDP context: IP type 0 (IPV4) and then
+            // the internal profile mapped to the context
+            if (pInstance->sockNextContextId >= 0) {
+                pSocket->contextId = pInstance->sockNextContextId;
+                uAtClientWriteInt(atHandle, 0);
+                uAtClientWriteInt(atHandle,
+                                  U_CELL_PRIVATE_CONTEXT_ID_TO_PROFILE_ID(pSocket->contextId));
+                pInstance->sockNextContextId = -1;
             }
             uAtClientCommandStop(atHandle);
             uAtClientResponseStart(atHandle, "+USOCR:");
@@ -769,6 +1278,8 @@ int32_t uCellSockCreate(uDeviceHandle_t cellHandle,
             uAtClientResponseStop(atHandle);
             if (uAtClientUnlock(atHandle) == 0) {
                 // All good
+                sockIndexModuleSet(pSocket);
+                pSocket->isStream = (protocol == U_SOCK_PROTOCOL_TCP);
                 negErrnoLocal = pSocket->sockHandle;
             } else {
                 // Free the socket again
@@ -869,6 +1380,10 @@ int32_t uCellSockClose(uDeviceHandle_t cellHandle,
             pSocket = pFindBySockHandle(sockHandle);
             if (pSocket != NULL) {
                 errnoLocal = U_SOCK_EIO;
+                if (pSocket->pDirectLink != NULL) {
+                    // Can't close the socket from direct link mode
+                    directLinkExit(pSocket);
+                }
                 // Close the socket through the cellular module
                 // If have seen modules return ERROR to this
                 // immediately so try a few times
@@ -933,6 +1448,51 @@ void uCellSockCleanup(uDeviceHandle_t cellHandle)
     (void) cellHandle;
 }
 
+// Pick up the sockets the module already has open.
+int32_t uCellSockWarmAttach(uDeviceHandle_t cellHandle,
+                            int32_t *pSockHandles,
+                            size_t numSockHandles)
+{
+    int32_t negErrnoLocalOrNumber = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uCellSockSocket_t *pSocket;
+    int32_t protocol;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if (pInstance != NULL) {
+        negErrnoLocalOrNumber = 0;
+        atHandle = pInstance->atHandle;
+        for (int32_t x = 0; (x < U_CELL_SOCK_MAX_NUM_SOCKETS) &&
+             (negErrnoLocalOrNumber >= 0); x++) {
+            if (pFindBySockHandleModule(atHandle, x) == NULL) {
+                // Do USOCTL 0 to get the protocol of the socket,
+                // which will fail if the socket is not open
+                protocol = usoctlRead(atHandle, x, 0);
+                if ((protocol == (int32_t) U_SOCK_PROTOCOL_TCP) ||
+                    (protocol == (int32_t) U_SOCK_PROTOCOL_UDP)) {
+                    pSocket = pSockCreate(cellHandle, atHandle);
+                    if (pSocket != NULL) {
+                        pSocket->sockHandleModule = x;
+                        pSocket->isStream = (protocol == (int32_t) U_SOCK_PROTOCOL_TCP);
+                        sockIndexModuleSet(pSocket);
+                        if ((pSockHandles != NULL) &&
+                            ((size_t) negErrnoLocalOrNumber < numSockHandles)) {
+                            *(pSockHandles + negErrnoLocalOrNumber) = pSocket->sockHandle;
+                        }
+                        negErrnoLocalOrNumber++;
+                    } else {
+                        negErrnoLocalOrNumber = -U_SOCK_ENOBUFS;
+                    }
+                }
+            }
+        }
+    }
+
+    return negErrnoLocalOrNumber;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: CONFIGURE
  * -------------------------------------------------------------- */
@@ -1222,6 +1782,53 @@ int32_t uCellSockSetNextLocalPort(uDeviceHandle_t cellHandle,
     return negErrnoLocal;
 }
 
+// Set a PDP context for the next uCellSockCreate().
+int32_t uCellSockSetNextContextId(uDeviceHandle_t cellHandle,
+                                  int32_t contextId)
+{
+    int32_t negErrnoLocal = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) &&
+        ((contextId == -1) ||
+         ((contextId > 0) && (contextId <= U_CELL_NET_MAX_NUM_CONTEXTS)))) {
+        negErrnoLocal = U_SOCK_ENONE;
+        if (contextId == U_CELL_NET_CONTEXT_ID) {
+            // Nothing to bind, that's the default
+            contextId = -1;
+        }
+        if ((contextId >= 0) &&
+            !U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                U_CELL_PRIVATE_FEATURE_SOCK_CONTEXT_BINDING)) {
+            negErrnoLocal = -U_SOCK_ENOSYS;
+        } else {
+            pInstance->sockNextContextId = contextId;
+        }
+    }
+
+    return negErrnoLocal;
+}
+
+// Get the PDP context that a socket is bound to.
+int32_t uCellSockGetContextId(uDeviceHandle_t cellHandle,
+                              int32_t sockHandle)
+{
+    int32_t negErrnoLocalOrContextId = -U_SOCK_EINVAL;
+    uCellSockSocket_t *pSocket;
+
+    // Find the instance and then the entry
+    if ((pUCellPrivateGetInstance(cellHandle) != NULL) && (sockHandle >= 0)) {
+        pSocket = pFindBySockHandle(sockHandle);
+        if (pSocket != NULL) {
+            negErrnoLocalOrContextId = pSocket->contextId;
+        }
+    }
+
+    return negErrnoLocalOrContextId;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: UDP ONLY
  * -------------------------------------------------------------- */
@@ -1254,7 +1861,10 @@ int32_t uCellSockSendTo(uDeviceHandle_t cellHandle,
         // Find the entry
         if (sockHandle >= 0) {
             pSocket = pFindBySockHandle(sockHandle);
-            if (pSocket != NULL) {
+            if ((pSocket != NULL) && (pSocket->pDirectLink != NULL)) {
+                // The data is going over the direct link
+                negErrnoLocalOrSize = -U_SOCK_EBUSY;
+            } else if (pSocket != NULL) {
                 negErrnoLocalOrSize = -U_SOCK_EDESTADDRREQ;
                 if (uSockAddressToString(pRemoteAddress, buffer,
                                          sizeof(buffer)) > 0) {
@@ -1275,14 +1885,13 @@ int32_t uCellSockSendTo(uDeviceHandle_t cellHandle,
                                 negErrnoLocalOrSize = -U_SOCK_EIO;
                                 uAtClientLock(atHandle);
                                 uAtClientCommandStart(atHandle, "AT+USOST=");
-                                // Write module socket handle
-                                uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                                // Write IP address
-                                uAtClientWriteString(atHandle, pRemoteIpAddress, true);
-                                // Write port number
-                                uAtClientWriteInt(atHandle, pRemoteAddress->port);
-                                // Number of bytes to follow
-                                uAtClientWriteInt(atHandle, (int32_t) dataSizeBytes);
+                                // Write module socket handle, IP address, port
+                                // number and the number of bytes to follow
+                                uAtClientWriteParams(atHandle, "isii",
+                                                     pSocket->sockHandleModule,
+                                                     pRemoteIpAddress,
+                                                     (int32_t) pRemoteAddress->port,
+                                                     (int32_t) dataSizeBytes);
                                 if (pHexBuffer) {
                                     // Send the hex mode data as a string
                                     uAtClientWriteString(atHandle, pHexBuffer, true);
@@ -1346,6 +1955,8 @@ int32_t uCellSockReceiveFrom(uDeviceHandle_t cellHandle,
     int32_t receivedSize = -1;
     int32_t readLength;
     char *pHexBuffer = NULL;
+    const char *pHexView;
+    char discard[U_CELL_SOCK_UDP_DISCARD_CHUNK_SIZE_BYTES];
 
     buffer[0] = 0;  // In case of slip-ups
 
@@ -1369,7 +1980,10 @@ int32_t uCellSockReceiveFrom(uDeviceHandle_t cellHandle,
         // Find the entry
         if (sockHandle >= 0) {
             pSocket = pFindBySockHandle(sockHandle);
-            if (pSocket != NULL) {
+            if ((pSocket != NULL) && (pSocket->pDirectLink != NULL)) {
+                // The data is going over the direct link
+                negErrnoLocalOrSize = -U_SOCK_EBUSY;
+            } else if (pSocket != NULL) {
                 negErrnoLocalOrSize = -U_SOCK_EWOULDBLOCK;
                 if (pSocket->pendingBytes == 0) {
                     // If the URC has not filled in pendingBytes,
@@ -1437,15 +2051,31 @@ int32_t uCellSockReceiveFrom(uDeviceHandle_t cellHandle,
                         dataSizeBytes = receivedSize;
                     }
                     if (receivedSize > 0) {
+                        pHexView = NULL;
                         if (pInstance->socketsHexMode) {
-                            // In hex mode we need a buffer to dump
-                            // the hex into and then we can decode it
-                            negErrnoLocalOrSize = -U_SOCK_ENOMEM;
-                            //lint -e{647} Suppress suspicious truncation
-                            pHexBuffer = (char *) pUPortMalloc(receivedSize * 2 + 1);  // +1 for terminator
+                            // In hex mode, try to decode the hex straight
+                            // out of the AT client's receive buffer; only
+                            // if the hex string is too large to fit there
+                            // do we need a buffer to dump the hex into
+                            readLength = uAtClientReadParameterView(atHandle, &pHexView);
+                            if (readLength == (int32_t) U_ERROR_COMMON_NO_MEMORY) {
+                                pHexView = NULL;
+                                negErrnoLocalOrSize = -U_SOCK_ENOMEM;
+                                //lint -e{647} Suppress suspicious truncation
+                                pHexBuffer = (char *) pUPortMalloc(receivedSize * 2 + 1);  // +1 for terminator
+                            }
                         }
-                        if (!pInstance->socketsHexMode || (pHexBuffer != NULL)) {
-                            if (pHexBuffer != NULL) {
+                        if (!pInstance->socketsHexMode || (pHexView != NULL) ||
+                            (pHexBuffer != NULL)) {
+                            if (pHexView != NULL) {
+                                if (readLength > 0) {
+                                    x = (int32_t) dataSizeBytes * 2;
+                                    if (readLength > x) {
+                                        readLength = x;
+                                    }
+                                    uHexToBin(pHexView, readLength, (char *) pData);
+                                }
+                            } else if (pHexBuffer != NULL) {
                                 // In hex mode we can read in the whole string
                                 //lint -e{647} Suppress suspicious truncation
                                 readLength = uAtClientReadString(atHandle, pHexBuffer,
@@ -1465,14 +2095,23 @@ int32_t uCellSockReceiveFrom(uDeviceHandle_t cellHandle,
                                 // Get the leading quote mark out of the way
                                 uAtClientReadBytes(atHandle, NULL, 1, true);
                                 // Now read out all the actual data,
-                                // first the bit we want
+                                // first the bit we want, which the AT
+                                // client moves straight into pData
                                 uAtClientReadBytes(atHandle, (char *) pData,
                                                    dataSizeBytes, true);
-                                if (receivedSize > (int32_t) dataSizeBytes) {
-                                    //...and then the rest poured away to NULL
-                                    uAtClientReadBytes(atHandle, NULL,
-                                                       receivedSize -
-                                                       dataSizeBytes, true);
+                                // ...and then pour the rest of the datagram
+                                // away, in chunks so that it too can take
+                                // the AT client's direct path rather than
+                                // being checked byte by byte
+                                x = receivedSize - (int32_t) dataSizeBytes;
+                                while ((x > 0) && (uAtClientErrorGet(atHandle) == 0)) {
+                                    readLength = x;
+                                    if (readLength > (int32_t) sizeof(discard)) {
+                                        readLength = (int32_t) sizeof(discard);
+                                    }
+                                    uAtClientReadBytes(atHandle, discard,
+                                                       readLength, true);
+                                    x -= readLength;
                                 }
                                 // Make sure to wait for the stop tag before
                                 // we finish
@@ -1530,22 +2169,46 @@ int32_t uCellSockReceiveFrom(uDeviceHandle_t cellHandle,
 int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
                        int32_t sockHandle,
                        const void *pData, size_t dataSizeBytes)
+{
+    uSockIoVec_t ioVec;
+
+    ioVec.pData = (void *) pData;
+    ioVec.dataSizeBytes = dataSizeBytes;
+
+    return uCellSockWritev(cellHandle, sockHandle, &ioVec, 1);
+}
+
+// Send bytes gathered from several buffers over a connected socket.
+int32_t uCellSockWritev(uDeviceHandle_t cellHandle,
+                        int32_t sockHandle,
+                        const uSockIoVec_t *pIoVec, size_t count)
 {
     int32_t negErrnoLocalOrSize = -U_SOCK_EINVAL;
     uCellPrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
     uCellSockSocket_t *pSocket;
-    int32_t leftToSendSize = (int32_t) dataSizeBytes;
+    size_t dataSizeBytes = 0;
+    int32_t leftToSendSize;
     int32_t sentSize = 0;
-    int32_t dataOffset = 0;
+    size_t ioVecIndex = 0;
+    size_t ioVecOffset = 0;
     int32_t thisSendSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
     size_t x = 0;
     bool written = true;
     char *pHexBuffer = NULL;
 
+    for (size_t y = 0; (y < count) && (pIoVec != NULL); y++) {
+        if ((pIoVec[y].pData == NULL) && (pIoVec[y].dataSizeBytes > 0)) {
+            pIoVec = NULL;
+        } else {
+            dataSizeBytes += pIoVec[y].dataSizeBytes;
+        }
+    }
+    leftToSendSize = (int32_t) dataSizeBytes;
+
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
-    if (pInstance != NULL) {
+    if ((pInstance != NULL) && ((pIoVec != NULL) || (count == 0))) {
         atHandle = pInstance->atHandle;
         if (pInstance->socketsHexMode) {
             thisSendSize /= 2;
@@ -1555,7 +2218,10 @@ int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
         // Find the entry
         if (sockHandle >= 0) {
             pSocket = pFindBySockHandle(sockHandle);
-            if (pSocket != NULL) {
+            if ((pSocket != NULL) && (pSocket->pDirectLink != NULL)) {
+                // The data is going over the direct link
+                negErrnoLocalOrSize = -U_SOCK_EBUSY;
+            } else if (pSocket != NULL) {
                 if (!pInstance->socketsHexMode || (pHexBuffer != NULL)) {
                     negErrnoLocalOrSize = U_SOCK_ENONE;
                     x = 0;
@@ -1566,17 +2232,24 @@ int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
                         if (leftToSendSize < thisSendSize) {
                             thisSendSize = leftToSendSize;
                         }
+                        // Keep the module's transmit buffer
+                        // topped up, rather than waiting for
+                        // the far end, but don't overfill it
+                        if (!txWindowWait(atHandle, pSocket, thisSendSize)) {
+                            break;
+                        }
                         uAtClientLock(atHandle);
                         uAtClientCommandStart(atHandle, "AT+USOWR=");
-                        // Write module socket handle
-                        uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                        // Number of bytes to follow
-                        uAtClientWriteInt(atHandle, (int32_t) thisSendSize);
+                        // Write module socket handle and number of bytes to follow
+                        uAtClientWriteParams(atHandle, "ii",
+                                             pSocket->sockHandleModule,
+                                             (int32_t) thisSendSize);
                         written = false;
                         if (pHexBuffer) {
                             // Make the hex-coded null terminated string
-                            uBinToHex((const char *) pData + dataOffset,
-                                      thisSendSize, pHexBuffer);
+                            ioVecGather(atHandle, pIoVec, count,
+                                        ioVecIndex, ioVecOffset,
+                                        pHexBuffer, thisSendSize);
                             pHexBuffer[thisSendSize * 2] = 0;
                             // Send the hex mode data as a string
                             //lint -e(679) Suppress suspicious truncation
@@ -1590,9 +2263,9 @@ int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
                                 // Wait for it...
                                 uPortTaskBlock(50);
                                 // Go!
-                                uAtClientWriteBytes(atHandle,
-                                                    (const char *) pData + dataOffset,
-                                                    thisSendSize, true);
+                                ioVecGather(atHandle, pIoVec, count,
+                                            ioVecIndex, ioVecOffset,
+                                            NULL, thisSendSize);
                                 written = true;
                             }
                         }
@@ -1615,7 +2288,8 @@ int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
                                 sentSize = 0;
                             }
                             if (uAtClientUnlock(atHandle) == 0) {
-                                dataOffset += sentSize;
+                                ioVecAdvance(pIoVec, count, &ioVecIndex,
+                                             &ioVecOffset, sentSize);
                                 leftToSendSize -= sentSize;
                                 // Technically, it should be OK to
                                 // send fewer bytes than asked for,
@@ -1625,6 +2299,14 @@ int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
                                 if (sentSize < thisSendSize) {
                                     x++;
                                 }
+                                if (pSocket->txWindowBytes >= 0) {
+                                    pSocket->txWindowBytes += sentSize;
+                                    if (sentSize < thisSendSize) {
+                                        // The module's buffer is full,
+                                        // wait for room next time
+                                        pSocket->txWindowBytes = U_CELL_SOCK_TCP_TX_WINDOW_BYTES;
+                                    }
+                                }
                             } else {
                                 negErrnoLocalOrSize = -U_SOCK_EIO;
                                 // Got an AT interface error, see
@@ -1664,10 +2346,7 @@ int32_t uCellSockRead(uDeviceHandle_t cellHandle,
     int32_t dataLengthMax = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
     int32_t x = -1;
     int32_t thisWantedReceiveSize;
-    int32_t thisActualReceiveSize;
     int32_t totalReceivedSize = 0;
-    int32_t readLength;
-    char *pHexBuffer = NULL;
 
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
@@ -1679,9 +2358,12 @@ int32_t uCellSockRead(uDeviceHandle_t cellHandle,
         // Find the entry
         if (sockHandle >= 0) {
             pSocket = pFindBySockHandle(sockHandle);
-            if (pSocket != NULL) {
+            if ((pSocket != NULL) && (pSocket->pDirectLink != NULL)) {
+                // The data is going over the direct link
+                negErrnoLocalOrSize = -U_SOCK_EBUSY;
+            } else if (pSocket != NULL) {
                 negErrnoLocalOrSize = -U_SOCK_EWOULDBLOCK;
-                if (pSocket->pendingBytes == 0) {
+                if ((pSocket->pendingBytes == 0) && (pSocket->rxBufferLength == 0)) {
                     // If the URC has not filled in pendingBytes,
                     // ask the module directly if there is anything
                     // to read
@@ -1719,97 +2401,34 @@ int32_t uCellSockRead(uDeviceHandle_t cellHandle,
                         negErrnoLocalOrSize = -U_SOCK_EIO;
                     }
                 }
-                if (pSocket->pendingBytes > 0) {
+                if ((pSocket->pendingBytes > 0) || (pSocket->rxBufferLength > 0)) {
                     negErrnoLocalOrSize = U_SOCK_ENONE;
                     // Run around the loop until we run out of
                     // pending data or room in the buffer
                     while ((dataSizeBytes > 0) &&
-                           (pSocket->pendingBytes > 0) &&
+                           ((pSocket->pendingBytes > 0) || (pSocket->rxBufferLength > 0)) &&
                            (negErrnoLocalOrSize == U_SOCK_ENONE)) {
-                        thisWantedReceiveSize = dataLengthMax;
-                        if (thisWantedReceiveSize > (int32_t) dataSizeBytes) {
-                            thisWantedReceiveSize = (int32_t) dataSizeBytes;
-                        }
                         uAtClientLock(atHandle);
-                        uAtClientCommandStart(atHandle, "AT+USORD=");
-                        uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                        // Number of bytes to read
-                        uAtClientWriteInt(atHandle, thisWantedReceiveSize);
-                        uAtClientCommandStop(atHandle);
-                        uAtClientResponseStart(atHandle, "+USORD:");
-                        // Skip the socket ID
-                        uAtClientSkipParameters(atHandle, 1);
-                        // Read the amount of data
-                        thisActualReceiveSize = uAtClientReadInt(atHandle);
-                        if (thisActualReceiveSize > (int32_t) dataSizeBytes) {
-                            thisActualReceiveSize = (int32_t) dataSizeBytes;
-                        }
-                        if (thisActualReceiveSize > 0) {
-                            if (pInstance->socketsHexMode) {
-                                // In hex mode we need a buffer to dump
-                                // the hex into and then we can decode it
-                                negErrnoLocalOrSize = -U_SOCK_ENOMEM;
-                                //lint -e{647} Suppress suspicious truncation
-                                pHexBuffer = (char *) pUPortMalloc(thisActualReceiveSize * 2 + 1);  // +1 for terminator
-                            }
-                            if (!pInstance->socketsHexMode || (pHexBuffer != NULL)) {
-                                negErrnoLocalOrSize = U_SOCK_ENONE;
-                                if (pHexBuffer != NULL) {
-                                    // In hex mode we can read in the whole string
-                                    //lint -e{647} Suppress suspicious truncation
-                                    readLength = uAtClientReadString(atHandle, pHexBuffer,
-                                                                     thisActualReceiveSize * 2 + 1,
-                                                                     false);
-                                    if (readLength > 0) {
-                                        x = ((int32_t) dataSizeBytes) * 2;
-                                        if (readLength > x) {
-                                            readLength = x;
-                                        }
-                                        uHexToBin(pHexBuffer, readLength,
-                                                  (char *) pData + totalReceivedSize);
-                                    }
-                                    // Free memory
-                                    uPortFree(pHexBuffer);
-                                } else {
-                                    // Binary mode, don't stop for anything!
-                                    uAtClientIgnoreStopTag(atHandle);
-                                    // Get the leading quote mark out of the way
-                                    uAtClientReadBytes(atHandle, NULL, 1, true);
-                                    // Now read out the available data
-                                    uAtClientReadBytes(atHandle,
-                                                       (char *) pData +
-                                                       totalReceivedSize,
-                                                       thisActualReceiveSize, true);
-                                    // Make sure we wait for the stop tag before
-                                    // going around again
-                                    uAtClientRestoreStopTag(atHandle);
-                                }
+                        if (pSocket->rxBufferLength > 0) {
+                            // Anything readAggregateCallback() has read
+                            // from the module must be taken first
+                            x = (int32_t) rxBufferTake(pSocket,
+                                                       (char *) pData + totalReceivedSize,
+                                                       dataSizeBytes);
+                        } else {
+                            thisWantedReceiveSize = dataLengthMax;
+                            if (thisWantedReceiveSize > (int32_t) dataSizeBytes) {
+                                thisWantedReceiveSize = (int32_t) dataSizeBytes;
                             }
+                            x = usordRead(pInstance, pSocket,
+                                          (char *) pData + totalReceivedSize,
+                                          thisWantedReceiveSize);
                         }
-                        uAtClientResponseStop(atHandle);
-                        // BEFORE unlocking, work out what's happened.
-                        // This is to prevent a URC being processed that
-                        // may indicate data left and over-write pendingBytes
-                        // while we're also writing to it.
-                        if ((uAtClientErrorGet(atHandle) == 0) &&
-                            (thisActualReceiveSize >= 0)) {
-                            // Must use what +USORD returns here as it may be less
-                            // or more than we asked for and also may be
-                            // more than pendingBytes, depending on how
-                            // the URCs landed
-                            // This update of pendingBytes will be overwritten
-                            // by the URC but we have to do something here
-                            // 'cos we don't get a URC to tell us when pendingBytes
-                            // has gone to zero.
-                            if (thisActualReceiveSize > pSocket->pendingBytes) {
-                                pSocket->pendingBytes = 0;
-                            } else {
-                                pSocket->pendingBytes -= thisActualReceiveSize;
-                            }
-                            totalReceivedSize += thisActualReceiveSize;
-                            dataSizeBytes -= thisActualReceiveSize;
+                        if (x >= 0) {
+                            totalReceivedSize += x;
+                            dataSizeBytes -= x;
                         } else {
-                            negErrnoLocalOrSize = -U_SOCK_EIO;
+                            negErrnoLocalOrSize = x;
                         }
                         uAtClientUnlock(atHandle);
                     }
@@ -1875,6 +2494,84 @@ void uCellSockRegisterCallbackClosed(uDeviceHandle_t cellHandle,
     }
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: DIRECT LINK
+ * -------------------------------------------------------------- */
+
+// Put a socket into direct link mode.
+int32_t uCellSockDirectLinkEnter(uDeviceHandle_t cellHandle,
+                                 int32_t sockHandle,
+                                 uDeviceSerial_t **ppDeviceSerial)
+{
+    int32_t negErrnoLocal = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uCellSockSocket_t *pSocket;
+    char buffer[16];
+    int32_t errorCode;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) && (ppDeviceSerial != NULL)) {
+        // Find the entry
+        if (sockHandle >= 0) {
+            pSocket = pFindBySockHandle(sockHandle);
+            if (pSocket != NULL) {
+                negErrnoLocal = -U_SOCK_EALREADY;
+                if (pSocket->pDirectLink == NULL) {
+                    // Direct link mode takes over the channel, so
+                    // it has to be a CMUX channel of its own, leaving
+                    // the AT interface free
+                    negErrnoLocal = -U_SOCK_EOPNOTSUPP;
+                    if (uCellMuxIsEnabled(cellHandle)) {
+                        snprintf(buffer, sizeof(buffer), "AT+USODL=%d",
+                                 (int) pSocket->sockHandleModule);
+                        errorCode = uCellMuxDataOpen(cellHandle, buffer,
+                                                     &(pSocket->pDirectLink));
+                        if (errorCode == 0) {
+                            negErrnoLocal = U_SOCK_ENONE;
+                            *ppDeviceSerial = pSocket->pDirectLink;
+                        } else {
+                            pSocket->pDirectLink = NULL;
+                            negErrnoLocal = -U_SOCK_EIO;
+                            if (errorCode == (int32_t) U_ERROR_COMMON_TIMEOUT) {
+                                negErrnoLocal = -U_SOCK_ETIMEDOUT;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return negErrnoLocal;
+}
+
+// Take a socket out of direct link mode.
+int32_t uCellSockDirectLinkExit(uDeviceHandle_t cellHandle,
+                                int32_t sockHandle)
+{
+    int32_t negErrnoLocal = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uCellSockSocket_t *pSocket;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if (pInstance != NULL) {
+        // Find the entry
+        if (sockHandle >= 0) {
+            pSocket = pFindBySockHandle(sockHandle);
+            if (pSocket != NULL) {
+                negErrnoLocal = U_SOCK_ENONE;
+                if (pSocket->pDirectLink != NULL) {
+                    negErrnoLocal = directLinkExit(pSocket);
+                }
+            }
+        }
+    }
+
+    return negErrnoLocal;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TCP INCOMING (TCP SERVER) ONLY
  * -------------------------------------------------------------- */
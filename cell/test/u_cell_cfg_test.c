@@ -865,6 +865,51 @@ U_PORT_TEST_FUNCTION("[cellCfg]", "cellCfgAutoBaud")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test moving to a higher baud rate and coming back from a reboot
+ * at the original one.
+ */
+U_PORT_TEST_FUNCTION("[cellCfg]", "cellCfgUpgradeBaudRate")
+{
+    uDeviceHandle_t cellHandle;
+    int32_t x;
+    int32_t resourceCount;
+
+    // In case a previous test failed
+    uCellTestPrivateCleanup(&gHandles);
+
+    // Obtain the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Do the standard preamble
+    U_PORT_TEST_ASSERT(uCellTestPrivatePreamble(U_CFG_TEST_CELL_MODULE_TYPE,
+                                                &gHandles, true) == 0);
+    cellHandle = gHandles.cellHandle;
+
+    U_TEST_PRINT_LINE("upgrading the baud rate...");
+    x = uCellCfgUpgradeBaudRate(cellHandle, 921600);
+    U_TEST_PRINT_LINE("uCellCfgUpgradeBaudRate() returned %d.", x);
+    U_PORT_TEST_ASSERT((x >= U_CELL_UART_BAUD_RATE) ||
+                       (x == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED));
+    // Whatever happened, the module should still be talking to us
+    U_PORT_TEST_ASSERT((int32_t) uCellCfgGetRat(cellHandle, 0) >= 0);
+    if (x > U_CELL_UART_BAUD_RATE) {
+        // A reboot should put us back where we started
+        U_TEST_PRINT_LINE("rebooting...");
+        U_PORT_TEST_ASSERT(uCellPwrReboot(cellHandle, NULL) == 0);
+        U_PORT_TEST_ASSERT((int32_t) uCellCfgGetRat(cellHandle, 0) >= 0);
+    }
+
+    // Do the standard postamble, leaving the module on for the next
+    // test to speed things up
+    uCellTestPrivatePostamble(&gHandles, false);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Test greeting message.
  */
 U_PORT_TEST_FUNCTION("[cellCfg]", "cellCfgGreeting")
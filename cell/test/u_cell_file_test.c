@@ -100,6 +100,15 @@
  */
 #define U_CELL_FILE_TEST_REENTRANT_STRING_SIZE 9
 
+/** The name of the file used by cellFileStream.
+ */
+#define U_CELL_FILE_TEST_STREAM_FILE_NAME "stream"
+
+/** The size of the file used by cellFileStream; chosen to be
+ * more than two stream chunks and not a multiple of one.
+ */
+#define U_CELL_FILE_TEST_STREAM_FILE_SIZE ((U_CELL_FILE_STREAM_CHUNK_LENGTH_BYTES * 2) + 100)
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -143,6 +152,57 @@ static bool checkTracker(bool *pTracker, size_t size)
     return isGood;
 }
 
+// Write callback for cellFileStream: produce a pattern based
+// on offset.
+static int32_t streamWriteCallback(uDeviceHandle_t cellHandle,
+                                   char *pBuffer, size_t size,
+                                   size_t offset, void *pCallbackParam)
+{
+    (void) cellHandle;
+    (void) pCallbackParam;
+
+    for (size_t x = 0; x < size; x++) {
+        *(pBuffer + x) = (char) ('A' + ((offset + x) % 26));
+    }
+
+    return (int32_t) size;
+}
+
+// Write callback for cellFileStream: produce the pattern for the
+// first chunk and then give up.
+static int32_t streamWriteAbortCallback(uDeviceHandle_t cellHandle,
+                                        char *pBuffer, size_t size,
+                                        size_t offset, void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+
+    if (offset == 0) {
+        errorCode = streamWriteCallback(cellHandle, pBuffer, size,
+                                        offset, pCallbackParam);
+    }
+
+    return errorCode;
+}
+
+// Read callback for cellFileStream: check the pattern, counting
+// errors into pCallbackParam.
+static bool streamReadCallback(uDeviceHandle_t cellHandle,
+                               const char *pData, size_t size,
+                               size_t offset, void *pCallbackParam)
+{
+    int32_t *pErrorCount = (int32_t *) pCallbackParam;
+
+    (void) cellHandle;
+
+    for (size_t x = 0; x < size; x++) {
+        if (*(pData + x) != (char) ('A' + ((offset + x) % 26))) {
+            (*pErrorCount)++;
+        }
+    }
+
+    return true;
+}
+
 /* ----------------------------------------------------------------
 * PUBLIC FUNCTIONS
 * -------------------------------------------------------------- */
@@ -420,6 +480,79 @@ U_PORT_TEST_FUNCTION("[cellFile]", "cellFileRead")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test writing and reading a file through the streaming API.
+ */
+U_PORT_TEST_FUNCTION("[cellFile]", "cellFileStream")
+{
+    int32_t resourceCount;
+    uDeviceHandle_t cellHandle;
+    int32_t result;
+    int32_t errorCount = 0;
+
+    // In case a previous test failed
+    uCellTestPrivateCleanup(&gHandles);
+
+    // Obtain the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Do the standard preamble
+    U_PORT_TEST_ASSERT(uCellTestPrivatePreamble(U_CFG_TEST_CELL_MODULE_TYPE,
+                                                &gHandles, true) == 0);
+    cellHandle = gHandles.cellHandle;
+
+    // In case a previous test was aborted half way
+    uCellFileDelete(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME);
+
+    U_TEST_PRINT_LINE("streaming %d byte(s) into file...",
+                      U_CELL_FILE_TEST_STREAM_FILE_SIZE);
+    result = uCellFileWriteStream(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME,
+                                  U_CELL_FILE_TEST_STREAM_FILE_SIZE,
+                                  streamWriteCallback, NULL);
+    U_TEST_PRINT_LINE("number of bytes written into the file = %d.", result);
+    U_PORT_TEST_ASSERT(result == U_CELL_FILE_TEST_STREAM_FILE_SIZE);
+    U_PORT_TEST_ASSERT(uCellFileSize(cellHandle,
+                                     U_CELL_FILE_TEST_STREAM_FILE_NAME) == result);
+
+    U_TEST_PRINT_LINE("streaming file back...");
+    result = uCellFileReadStream(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME,
+                                 streamReadCallback, &errorCount);
+    U_TEST_PRINT_LINE("number of bytes read = %d, %d mismatch(es).",
+                      result, errorCount);
+    U_PORT_TEST_ASSERT(result == U_CELL_FILE_TEST_STREAM_FILE_SIZE);
+    U_PORT_TEST_ASSERT(errorCount == 0);
+
+    // Giving up part way through an append must leave the
+    // existing file in place: the padding will have been added
+    U_TEST_PRINT_LINE("giving up part way through appending to the file...");
+    result = uCellFileWriteStream(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME,
+                                  U_CELL_FILE_TEST_STREAM_FILE_SIZE,
+                                  streamWriteAbortCallback, NULL);
+    U_PORT_TEST_ASSERT(result == (int32_t) U_ERROR_COMMON_CANCELLED);
+    result = uCellFileSize(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME);
+    U_TEST_PRINT_LINE("file is now %d byte(s).", result);
+    U_PORT_TEST_ASSERT(result >= U_CELL_FILE_TEST_STREAM_FILE_SIZE);
+
+    U_PORT_TEST_ASSERT(uCellFileDelete(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME) == 0);
+
+    // Giving up part way through writing a new file must delete it
+    U_TEST_PRINT_LINE("giving up part way through writing a new file...");
+    result = uCellFileWriteStream(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME,
+                                  U_CELL_FILE_TEST_STREAM_FILE_SIZE,
+                                  streamWriteAbortCallback, NULL);
+    U_PORT_TEST_ASSERT(result == (int32_t) U_ERROR_COMMON_CANCELLED);
+    U_PORT_TEST_ASSERT(uCellFileSize(cellHandle, U_CELL_FILE_TEST_STREAM_FILE_NAME) < 0);
+
+    // Do the standard postamble, leaving the module on for the next
+    // test to speed things up
+    uCellTestPrivatePostamble(&gHandles, false);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Test list all files.
  */
 U_PORT_TEST_FUNCTION("[cellFile]", "cellFileListAll")
@@ -125,6 +125,19 @@ U_PORT_TEST_FUNCTION("[cellFota]", "cellFotaVeryBasicIndeed")
     // In case a previous test failed
     uCellTestPrivateCleanup(&gHandles);
 
+    // Check the download time estimate, which needs no module: no
+    // estimate without progress or with a nonsense percentage, else
+    // the remaining percentage at the rate so far
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(10000, 20, 20) == -1);
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(10000, 20, 10) == -1);
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(10000, 20, 101) == -1);
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(-1, 0, 50) == -1);
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(10000, 0, 50) == 10);
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(10000, 20, 30) == 70);
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(10000, 20, 100) == 0);
+    // Long downloads must not overflow
+    U_PORT_TEST_ASSERT(uCellPrivateFotaEtaSeconds(INT32_MAX, 0, 1) == 212600881);
+
     // Obtain the initial resource count
     resourceCount = uTestUtilGetDynamicResourceCount();
 
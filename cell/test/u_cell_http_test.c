@@ -369,6 +369,7 @@ static bool waitCheckHttpResponse(int32_t timeoutSeconds,
 U_PORT_TEST_FUNCTION("[cellHttp]", "cellHttp")
 {
     uDeviceHandle_t cellHandle;
+    const uCellPrivateModule_t *pModule;
     int32_t httpHandle;
     int32_t y;
     int32_t resourceCount;
@@ -468,6 +469,37 @@ U_PORT_TEST_FUNCTION("[cellHttp]", "cellHttp")
                                              httpHandle,
                                              U_CELL_HTTP_REQUEST_GET, NULL));
 
+    // Check parameter checking on custom request headers
+    U_PORT_TEST_ASSERT(uCellHttpSetRequestHeader(cellHandle, httpHandle, -1,
+                                                 "X-Ubxlib-Test", "1") < 0);
+    U_PORT_TEST_ASSERT(uCellHttpSetRequestHeader(cellHandle, httpHandle,
+                                                 U_CELL_HTTP_REQUEST_HEADER_MAX_NUM,
+                                                 "X-Ubxlib-Test", "1") < 0);
+    U_PORT_TEST_ASSERT(uCellHttpSetRequestHeader(cellHandle, httpHandle, 0,
+                                                 "X-Ubxlib-Test", NULL) < 0);
+    pModule = pUCellPrivateGetModule(cellHandle);
+    U_PORT_TEST_ASSERT(pModule != NULL);
+    //lint -esym(613, pModule) Suppress possible use of NULL pointer
+    // for pModule from now on
+    if (pModule->moduleType != U_CELL_MODULE_TYPE_SARA_U201) {
+        // GET it again with a custom header set, which the
+        // server should ignore, then clear the header
+        U_TEST_PRINT_LINE("HTTP GET file %s with a custom header...", pathBuffer);
+        U_PORT_TEST_ASSERT(uCellHttpSetRequestHeader(cellHandle, httpHandle,
+                                                     U_CELL_HTTP_REQUEST_HEADER_MAX_NUM - 1,
+                                                     "X-Ubxlib-Test", "1") == 0);
+        U_PORT_TEST_ASSERT(uCellHttpRequest(cellHandle, httpHandle,
+                                            U_CELL_HTTP_REQUEST_GET,
+                                            pathBuffer, NULL, NULL, NULL) == 0);
+        U_PORT_TEST_ASSERT(waitCheckHttpResponse(U_CELL_HTTP_TIMEOUT_SECONDS_MIN,
+                                                 &gCallbackData, cellHandle,
+                                                 httpHandle,
+                                                 U_CELL_HTTP_REQUEST_GET, NULL));
+        U_PORT_TEST_ASSERT(uCellHttpSetRequestHeader(cellHandle, httpHandle,
+                                                     U_CELL_HTTP_REQUEST_HEADER_MAX_NUM - 1,
+                                                     NULL, NULL) == 0);
+    }
+
     // GET it again but using an explicit response file name this time
     U_TEST_PRINT_LINE("HTTP GET file %s again...", pathBuffer);
     U_PORT_TEST_ASSERT(uCellHttpRequest(cellHandle, httpHandle,
@@ -360,6 +360,22 @@ U_PORT_TEST_FUNCTION("[cellInfo]", "cellInfoRadioParameters")
                            (x == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED));
     }
 
+    U_TEST_PRINT_LINE("checking maximum age of radio parameters...");
+    U_PORT_TEST_ASSERT(uCellInfoGetRadioParametersMaxAge(cellHandle) == 0);
+    U_PORT_TEST_ASSERT(uCellInfoSetRadioParametersMaxAge(cellHandle, 60000) == 0);
+    U_PORT_TEST_ASSERT(uCellInfoGetRadioParametersMaxAge(cellHandle) == 60000);
+    for (count = 10; (uCellInfoRefreshRadioParameters(cellHandle) != 0) &&
+         (count > 0); count--) {
+        uPortTaskBlock(1000);
+    }
+    U_PORT_TEST_ASSERT(count > 0);
+    x = uCellInfoGetRadioParametersAgeMs(cellHandle);
+    U_PORT_TEST_ASSERT(x >= 0);
+    // A refresh now should be a no-op, leaving the age alone
+    U_PORT_TEST_ASSERT(uCellInfoRefreshRadioParameters(cellHandle) == 0);
+    U_PORT_TEST_ASSERT(uCellInfoGetRadioParametersAgeMs(cellHandle) >= x);
+    U_PORT_TEST_ASSERT(uCellInfoSetRadioParametersMaxAge(cellHandle, 0) == 0);
+
     // Disconnect
     U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
 
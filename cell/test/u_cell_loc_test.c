@@ -586,6 +586,21 @@ U_PORT_TEST_FUNCTION("[cellLoc]", "cellLocCfg")
     uCellLocSetDesiredFixTimeout(cellHandle, y);
     U_TEST_PRINT_LINE("desired fix timeout returned to.", y);
 
+    // Check the cache maximum age
+    y = uCellLocGetCacheMaxAge(cellHandle);
+    U_TEST_PRINT_LINE("cache maximum age is %d second(s).", y);
+    U_PORT_TEST_ASSERT(y == 0);
+    uCellLocSetCacheMaxAge(cellHandle, 60);
+    z = uCellLocGetCacheMaxAge(cellHandle);
+    U_TEST_PRINT_LINE("cache maximum age is now %d second(s).", z);
+    U_PORT_TEST_ASSERT(z == 60);
+    // A negative value should be ignored
+    uCellLocSetCacheMaxAge(cellHandle, -1);
+    U_PORT_TEST_ASSERT(uCellLocGetCacheMaxAge(cellHandle) == 60);
+    // Put it back as it was
+    uCellLocSetCacheMaxAge(cellHandle, y);
+    U_TEST_PRINT_LINE("cache maximum age returned to %d second(s).", y);
+
     // Check whether GNSS is used or not
     y = (int32_t) uCellLocGetGnssEnable(cellHandle);
     U_TEST_PRINT_LINE("GNSS is %s.", y ? "enabled" : "disabled");
@@ -765,6 +780,24 @@ U_PORT_TEST_FUNCTION("[cellLoc]", "cellLocLoc")
     U_PORT_TEST_ASSERT(x == 0);
     U_PORT_TEST_ASSERT(timeUtc > U_CELL_LOC_TEST_MIN_UTC_TIME);
 
+    // With caching switched on, the fix just obtained should be
+    // returned from the cache without going to the server, provided
+    // that it is within the desired accuracy
+    if ((radiusMillimetres != INT_MIN) &&
+        (radiusMillimetres <= uCellLocGetDesiredAccuracy(cellHandle))) {
+        U_TEST_PRINT_LINE("getting location from the cache.");
+        uCellLocSetCacheMaxAge(cellHandle, U_CELL_LOC_TEST_TIMEOUT_SECONDS);
+        startTime = uPortGetTickTimeMs();
+        x = uCellLocGetCached(cellHandle, &(whole[0]), &(whole[1]),
+                              NULL, NULL, NULL, NULL, NULL);
+        U_TEST_PRINT_LINE("result was %d, took %d ms.", x,
+                          (int32_t) (uPortGetTickTimeMs() - startTime));
+        U_PORT_TEST_ASSERT(x == 0);
+        U_PORT_TEST_ASSERT(whole[0] == latitudeX1e7);
+        U_PORT_TEST_ASSERT(whole[1] == longitudeX1e7);
+        uCellLocSetCacheMaxAge(cellHandle, 0);
+    }
+
     // Get position, non-blocking version
     U_TEST_PRINT_LINE("location establishment, non-blocking version.");
     // Try this a few times as the Cell Locate AT command can sometimes
@@ -145,6 +145,23 @@ const char *pBool(bool isTrue)
     return isTrue ? "true" : "false";
 }
 
+// Information destination callback: split the information field
+// across the two halves of the buffer at pParam, second half first.
+static void informationDestination(uCellMuxPrivateParserContext_t *pParserContext,
+                                   uint8_t address, uCellMuxPrivateFrameType_t type,
+                                   size_t informationLengthBytes, void *pParam)
+{
+    (void) address;
+    (void) type;
+    (void) informationLengthBytes;
+
+    pParserContext->pInformation = ((char *) pParam) +
+                                   (U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES / 2);
+    pParserContext->informationLengthBytes = U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES / 2;
+    pParserContext->pInformation2 = (char *) pParam;
+    pParserContext->information2LengthBytes = U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES / 2;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -161,6 +178,8 @@ U_PORT_TEST_FUNCTION("[cellMuxPrivate]", "cellMuxPrivateBackToBack")
     uint8_t address;
     bool pollFinal = false;
     char *pInformation;
+    char *pDestination;
+    size_t splitLength;
     int32_t expectedFrameLength;
     uCellMuxPrivateParserContext_t parserContext = {0};
     int32_t z;
@@ -277,9 +296,42 @@ U_PORT_TEST_FUNCTION("[cellMuxPrivate]", "cellMuxPrivateBackToBack")
         uPortTaskBlock(U_CFG_OS_YIELD_MS);
     }
 
+    // Check that the information field of a frame can be decoded
+    // into two separate pieces of storage, as chosen by a callback
+    pDestination = (char *) pUPortMalloc(U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(pDestination != NULL);
+    z = U_CELL_MUX_PRIVATE_TEST_MAX_INFORMATION_SIZE_BYTES;
+    if (z > U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES) {
+        z = U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES;
+    }
+    for (int32_t y = 0; y < z; y++) {
+        *(pInformation + y) = (char) y;
+    }
+    parserContext.bufferSize = uCellMuxPrivateEncode(1, U_CELL_MUX_PRIVATE_FRAME_TYPE_UIH, false,
+                                                     pInformation, z, parserContext.pBuffer);
+    U_PORT_TEST_ASSERT((int32_t) parserContext.bufferSize > z);
+    parserContext.address = U_CELL_MUX_PRIVATE_ADDRESS_ANY;
+    parserContext.type = U_CELL_MUX_PRIVATE_FRAME_TYPE_NONE;
+    parserContext.pInformation = NULL;
+    parserContext.informationLengthBytes = 0;
+    parserContext.pInformationDestination = informationDestination;
+    parserContext.pInformationDestinationParam = pDestination;
+    parserContext.bufferIndex = 0;
+    U_PORT_TEST_ASSERT(uCellMuxPrivateParseCmux(NULL, &parserContext) == 0);
+    U_PORT_TEST_ASSERT(parserContext.type == U_CELL_MUX_PRIVATE_FRAME_TYPE_UIH);
+    U_PORT_TEST_ASSERT((int32_t) parserContext.informationLengthBytes == z);
+    splitLength = U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES / 2;
+    if (splitLength > (size_t) z) {
+        splitLength = z;
+    }
+    U_PORT_TEST_ASSERT(memcmp(pDestination + (U_CELL_MUX_PRIVATE_TEST_MAX_FRAME_SIZE_BYTES / 2),
+                              pInformation, splitLength) == 0);
+    U_PORT_TEST_ASSERT(memcmp(pDestination, pInformation + splitLength, z - splitLength) == 0);
+
     // Free memory
     uPortFree(parserContext.pBuffer);
     uPortFree(pInformation);
+    uPortFree(pDestination);
 
     uPortDeinit();
 
@@ -65,6 +65,7 @@
 #include "u_at_client.h"
 
 #include "u_sock.h"
+#include "u_sock_errno.h"
 
 #include "u_security.h"
 
@@ -449,6 +450,7 @@ U_PORT_TEST_FUNCTION("[cellMux]", "cellMuxBasic")
     // +1 and zero init so that we can treat it as a string
     char buffer1[U_CELL_INFO_IMEI_SIZE + 1] = {0};
     char buffer2[U_CELL_INFO_IMEI_SIZE + 1] = {0};
+    uCellMuxChannelStats_t stats;
 
     // In case a previous test failed
     uCellTestPrivateCleanup(&gHandles);
@@ -474,9 +476,22 @@ U_PORT_TEST_FUNCTION("[cellMux]", "cellMuxBasic")
         U_PORT_TEST_ASSERT(uCellInfoGetImei(cellHandle, buffer1) == 0);
         U_TEST_PRINT_LINE("IMEI is %s.", buffer1);
 
+        // Check that the frame size can be set, limits included
+        U_PORT_TEST_ASSERT(uCellMuxGetFrameSize(cellHandle) > 0);
+        U_PORT_TEST_ASSERT(uCellMuxSetFrameSize(cellHandle,
+                                                U_CELL_MUX_INFORMATION_LENGTH_LIMIT_BYTES + 1) < 0);
+
         for (size_t x = 0; x < U_CELL_MUX_TEST_BASIC_NUM_ITERATIONS; x++) {
 
-            uPortLog(U_TEST_PREFIX_BASE "_%d: enabling CMUX...\n", x + 1);
+            // Alternate between the default frame size and a small one
+            if (x % 2 == 0) {
+                U_PORT_TEST_ASSERT(uCellMuxSetFrameSize(cellHandle, 0) == 0);
+            } else {
+                U_PORT_TEST_ASSERT(uCellMuxSetFrameSize(cellHandle, 64) == 0);
+                U_PORT_TEST_ASSERT(uCellMuxGetFrameSize(cellHandle) == 64);
+            }
+            uPortLog(U_TEST_PREFIX_BASE "_%d: enabling CMUX, frame size %d...\n", x + 1,
+                     uCellMuxGetFrameSize(cellHandle));
             U_PORT_TEST_ASSERT(uCellMuxEnable(cellHandle) == 0);
             U_PORT_TEST_ASSERT(uCellMuxIsEnabled(cellHandle));
             U_PORT_TEST_ASSERT(pUCellMuxChannelGetDeviceSerial(cellHandle, 0) != NULL);
@@ -487,16 +502,30 @@ U_PORT_TEST_FUNCTION("[cellMux]", "cellMuxBasic")
             uPortLog(U_TEST_PREFIX_BASE "_%d: IMEI read over a CMUX channel gives %s.\n", x + 1, buffer2);
             U_PORT_TEST_ASSERT(strncmp(buffer1, buffer2, sizeof(buffer1)) == 0);
 
+            // Having done that, the AT channel must have carried traffic
+            U_PORT_TEST_ASSERT(uCellMuxGetChannelStats(cellHandle, 1, &stats) == 0);
+            uPortLog(U_TEST_PREFIX_BASE "_%d: AT channel %d frame(s) (%d byte(s)) in,"
+                     " %d frame(s) (%d byte(s)) out, %d FCS error(s), %d byte(s)"
+                     " discarded, %d stall(s).\n", x + 1, stats.framesReceived,
+                     stats.bytesReceived, stats.framesSent, stats.bytesSent,
+                     stats.fcsErrors, stats.bytesDiscarded, stats.stalls);
+            U_PORT_TEST_ASSERT(stats.framesReceived > 0);
+            U_PORT_TEST_ASSERT(stats.bytesReceived > 0);
+            U_PORT_TEST_ASSERT(stats.framesSent > 0);
+            U_PORT_TEST_ASSERT(stats.bytesSent > 0);
+
             uPortLog(U_TEST_PREFIX_BASE "_%d: disabling CMUX...\n", x + 1);
             U_PORT_TEST_ASSERT(uCellMuxDisable(cellHandle) == 0);
             U_PORT_TEST_ASSERT(!uCellMuxIsEnabled(cellHandle));
             U_PORT_TEST_ASSERT(pUCellMuxChannelGetDeviceSerial(cellHandle, 0) == NULL);
             U_PORT_TEST_ASSERT(pUCellMuxChannelGetDeviceSerial(cellHandle, 1) == NULL);
+            U_PORT_TEST_ASSERT(uCellMuxGetChannelStats(cellHandle, 1, &stats) < 0);
 
             U_PORT_TEST_ASSERT(uCellInfoGetImei(cellHandle, buffer2) == 0);
             uPortLog(U_TEST_PREFIX_BASE "_%d: IMEI read after disabling CMUX gives %s.\n", x + 1, buffer2);
             U_PORT_TEST_ASSERT(strncmp(buffer1, buffer2, sizeof(buffer1)) == 0);
         }
+        U_PORT_TEST_ASSERT(uCellMuxSetFrameSize(cellHandle, 0) == 0);
     } else {
         U_TEST_PRINT_LINE("CMUX is not supported, not running tests.");
         U_PORT_TEST_ASSERT(uCellMuxEnable(cellHandle) < 0);
@@ -956,6 +985,240 @@ U_PORT_TEST_FUNCTION("[cellMux]", "cellMuxHttp")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test direct link mode on a TCP socket over CMUX.
+ */
+U_PORT_TEST_FUNCTION("[cellMux]", "cellMuxSockDirectLink")
+{
+    uDeviceHandle_t cellHandle;
+    const uCellPrivateModule_t *pModule;
+    int32_t resourceCount;
+    uSockAddress_t echoServerAddress;
+    uDeviceSerial_t *pDeviceSerial = NULL;
+    int32_t startTimeMs;
+    int32_t y;
+    int32_t z;
+    char *pBuffer;
+
+    // In case a previous test failed
+    uCellTestPrivateCleanup(&gHandles);
+
+    // Obtain the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    gTestPassed = false;
+
+    // Do the standard preamble
+    U_PORT_TEST_ASSERT(uCellTestPrivatePreamble(U_CFG_TEST_CELL_MODULE_TYPE,
+                                                &gHandles, true) == 0);
+    cellHandle = gHandles.cellHandle;
+
+    // Get the private module data so that we can check for CMUX support
+    pModule = pUCellPrivateGetModule(cellHandle);
+    U_PORT_TEST_ASSERT(pModule != NULL);
+    //lint -esym(613, pModule) Suppress possible use of NULL pointer
+    // for pModule from now on
+
+    if (U_CELL_PRIVATE_HAS(pModule, U_CELL_PRIVATE_FEATURE_CMUX)) {
+        // Malloc a buffer to receive things into.
+        pBuffer = (char *) pUPortMalloc(sizeof(gAllChars));
+        U_PORT_TEST_ASSERT(pBuffer != NULL);
+
+        U_TEST_PRINT_LINE("enabling CMUX...\n");
+        U_PORT_TEST_ASSERT(uCellMuxEnable(cellHandle) == 0);
+
+        // Make a cellular connection and a TCP socket to the echo
+        // server
+        U_PORT_TEST_ASSERT(connect(cellHandle) == 0);
+        U_PORT_TEST_ASSERT(uCellSockInit() == 0);
+        U_PORT_TEST_ASSERT(uCellSockInitInstance(cellHandle) == 0);
+        U_PORT_TEST_ASSERT(uCellSockGetHostByName(cellHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(echoServerAddress.ipAddress)) == 0);
+        echoServerAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+        gSockHandle = uCellSockCreate(cellHandle, U_SOCK_TYPE_STREAM,
+                                      U_SOCK_PROTOCOL_TCP);
+        U_PORT_TEST_ASSERT(gSockHandle >= 0);
+        U_PORT_TEST_ASSERT(uCellSockConnect(cellHandle, gSockHandle,
+                                            &echoServerAddress) == 0);
+
+        U_TEST_PRINT_LINE("entering direct link mode...");
+        U_PORT_TEST_ASSERT(uCellSockDirectLinkEnter(cellHandle, gSockHandle,
+                                                    &pDeviceSerial) == 0);
+        U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+        U_PORT_TEST_ASSERT(uCellSockDirectLinkEnter(cellHandle, gSockHandle,
+                                                    &pDeviceSerial) == -U_SOCK_EALREADY);
+        // The AT-based calls are refused while the socket is in
+        // direct link mode
+        U_PORT_TEST_ASSERT(uCellSockWrite(cellHandle, gSockHandle,
+                                          gAllChars, 1) == -U_SOCK_EBUSY);
+        U_PORT_TEST_ASSERT(uCellSockRead(cellHandle, gSockHandle,
+                                         pBuffer, 1) == -U_SOCK_EBUSY);
+
+        // Send the echo data over the direct link and get it back
+        U_TEST_PRINT_LINE("sending %d byte(s) to %s:%d over the direct link...",
+                          sizeof(gAllChars), U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                          U_SOCK_TEST_ECHO_TCP_SERVER_PORT);
+        y = 0;
+        startTimeMs = uPortGetTickTimeMs();
+        while ((y < sizeof(gAllChars)) && (uPortGetTickTimeMs() - startTimeMs < 10000)) {
+            z = pDeviceSerial->write(pDeviceSerial, gAllChars + y, sizeof(gAllChars) - y);
+            if (z > 0) {
+                y += z;
+            } else {
+                uPortTaskBlock(10);
+            }
+        }
+        U_PORT_TEST_ASSERT(y == sizeof(gAllChars));
+        y = 0;
+        memset(pBuffer, 0, sizeof(gAllChars));
+        startTimeMs = uPortGetTickTimeMs();
+        while ((y < sizeof(gAllChars)) && (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+            z = pDeviceSerial->read(pDeviceSerial, pBuffer + y, sizeof(gAllChars) - y);
+            if (z > 0) {
+                y += z;
+            } else {
+                uPortTaskBlock(10);
+            }
+        }
+        U_TEST_PRINT_LINE("%d byte(s) echoed over the direct link in %d ms.", y,
+                          uPortGetTickTimeMs() - startTimeMs);
+        U_PORT_TEST_ASSERT(y == sizeof(gAllChars));
+        U_PORT_TEST_ASSERT(memcmp(pBuffer, gAllChars, sizeof(gAllChars)) == 0);
+
+        // Leave direct link mode: the socket must then work over
+        // AT commands again
+        U_TEST_PRINT_LINE("leaving direct link mode...");
+        U_PORT_TEST_ASSERT(uCellSockDirectLinkExit(cellHandle, gSockHandle) == 0);
+        U_PORT_TEST_ASSERT(uCellSockDirectLinkExit(cellHandle, gSockHandle) == 0);
+        U_PORT_TEST_ASSERT(uCellSockWrite(cellHandle, gSockHandle,
+                                          gAllChars, 10) == 10);
+        y = 0;
+        startTimeMs = uPortGetTickTimeMs();
+        while ((y < 10) && (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+            z = uCellSockRead(cellHandle, gSockHandle, pBuffer + y, 10 - y);
+            if (z > 0) {
+                y += z;
+            } else {
+                uPortTaskBlock(500);
+            }
+        }
+        U_PORT_TEST_ASSERT(y == 10);
+        U_PORT_TEST_ASSERT(memcmp(pBuffer, gAllChars, 10) == 0);
+
+        // Enter direct link mode again and close the socket from
+        // there: uCellSockClose() must take it out of direct link
+        // mode first
+        U_PORT_TEST_ASSERT(uCellSockDirectLinkEnter(cellHandle, gSockHandle,
+                                                    &pDeviceSerial) == 0);
+        U_TEST_PRINT_LINE("closing socket from direct link mode...");
+        U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, gSockHandle, NULL) == 0);
+
+        // Deinit cell sockets
+        uCellSockDeinit();
+
+        U_TEST_PRINT_LINE("disabling CMUX...\n");
+        U_PORT_TEST_ASSERT(uCellMuxDisable(cellHandle) == 0);
+
+        U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+
+        // Free memory
+        uPortFree(pBuffer);
+    } else {
+        U_TEST_PRINT_LINE("CMUX is not supported, not running tests.");
+        U_PORT_TEST_ASSERT(uCellMuxEnable(cellHandle) < 0);
+    }
+
+    gTestPassed = true;
+
+    // Do the standard postamble, leaving the module on for the next
+    // test to speed things up
+    uCellTestPrivatePostamble(&gHandles, false);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test a PPP channel over CMUX.
+ */
+U_PORT_TEST_FUNCTION("[cellMux]", "cellMuxPpp")
+{
+    uDeviceHandle_t cellHandle;
+    const uCellPrivateModule_t *pModule;
+    int32_t resourceCount;
+    uDeviceSerial_t *pDeviceSerial = NULL;
+    char c = 0;
+    int32_t startTimeMs;
+
+    // In case a previous test failed
+    uCellTestPrivateCleanup(&gHandles);
+
+    // Obtain the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Do the standard preamble
+    U_PORT_TEST_ASSERT(uCellTestPrivatePreamble(U_CFG_TEST_CELL_MODULE_TYPE,
+                                                &gHandles, true) == 0);
+    cellHandle = gHandles.cellHandle;
+
+    // Get the private module data so that we can check for CMUX support
+    pModule = pUCellPrivateGetModule(cellHandle);
+    U_PORT_TEST_ASSERT(pModule != NULL);
+    //lint -esym(613, pModule) Suppress possible use of NULL pointer
+    // for pModule from now on
+
+    if (U_CELL_PRIVATE_HAS(pModule, U_CELL_PRIVATE_FEATURE_CMUX)) {
+        // Can't open a PPP channel without the multiplexer
+        U_PORT_TEST_ASSERT(uCellMuxPppOpen(cellHandle, &pDeviceSerial) < 0);
+
+        U_TEST_PRINT_LINE("enabling CMUX...\n");
+        U_PORT_TEST_ASSERT(uCellMuxEnable(cellHandle) == 0);
+
+        // Make a cellular connection
+        U_PORT_TEST_ASSERT(connect(cellHandle) == 0);
+
+        U_TEST_PRINT_LINE("opening PPP channel...");
+        U_PORT_TEST_ASSERT(uCellMuxPppOpen(cellHandle, &pDeviceSerial) == 0);
+        U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+
+        // The module should begin LCP negotiation, so we should
+        // see a PPP flag character arrive
+        startTimeMs = uPortGetTickTimeMs();
+        while ((c != 0x7e) && (uPortGetTickTimeMs() - startTimeMs < 10000)) {
+            if (pDeviceSerial->read(pDeviceSerial, &c, 1) != 1) {
+                uPortTaskBlock(10);
+            }
+        }
+        U_TEST_PRINT_LINE("%s PPP from the module.", (c == 0x7e) ? "received" : "did not receive");
+        U_PORT_TEST_ASSERT(c == 0x7e);
+
+        U_TEST_PRINT_LINE("closing PPP channel...");
+        U_PORT_TEST_ASSERT(uCellMuxPppClose(cellHandle) == 0);
+
+        U_TEST_PRINT_LINE("disabling CMUX...\n");
+        U_PORT_TEST_ASSERT(uCellMuxDisable(cellHandle) == 0);
+
+        U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+    } else {
+        U_TEST_PRINT_LINE("CMUX is not supported, not running tests.");
+        U_PORT_TEST_ASSERT(uCellMuxPppOpen(cellHandle, &pDeviceSerial) < 0);
+    }
+
+    gTestPassed = true;
+
+    // Do the standard postamble, leaving the module on for the next
+    // test to speed things up
+    uCellTestPrivatePostamble(&gHandles, false);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -65,6 +65,7 @@
 #include "u_cell_file.h"
 #include "u_cell_net.h"     // Required by u_cell_private.h
 #include "u_cell_private.h" // So that we can get at some innards
+#include "u_cell_apn_db.h"  // So that we can test the look-up
 
 #include "u_cell_test_cfg.h"
 #include "u_cell_test_private.h"
@@ -134,6 +135,24 @@ static bool keepGoingCallback(uDeviceHandle_t cellHandle)
     return keepGoing;
 }
 
+// Callback for uCellNetScan(), counts the networks.
+static bool scanCallback(uDeviceHandle_t cellHandle,
+                         const char *pName, const char *pMccMnc,
+                         uCellNetRat_t rat, void *pParam)
+{
+    int32_t *pCount = (int32_t *) pParam;
+
+    (void) cellHandle;
+    (void) pName;
+    if ((pMccMnc != NULL) && (strlen(pMccMnc) > 0) &&
+        (rat > U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED) &&
+        (rat < U_CELL_NET_RAT_MAX_NUM)) {
+        (*pCount)++;
+    }
+
+    return true;
+}
+
 // Callback for registration status.
 static void registerCallback(uCellNetRegDomain_t domain,
                              uCellNetStatus_t status,
@@ -471,6 +490,9 @@ U_PORT_TEST_FUNCTION("[cellNet]", "cellNetScanRegActDeact")
     int32_t y = 0;
     uCellNetRat_t rat = U_CELL_NET_RAT_UNKNOWN_OR_NOT_USED;
     int32_t resourceCount;
+    int32_t scanCount;
+    int32_t networkCount;
+    int64_t startTimeMs;
 
     // In case a previous test failed
     uCellTestPrivateCleanup(&gHandles);
@@ -527,6 +549,29 @@ U_PORT_TEST_FUNCTION("[cellNet]", "cellNetScanRegActDeact")
     // Must be at least one, can't guarantee more than that
     U_PORT_TEST_ASSERT(y > 0);
 
+    // Switch on the scan cache and scan with a callback: the first
+    // scan populates the cache, the second should be served from it
+    U_PORT_TEST_ASSERT(uCellNetSetScanCacheMaxAge(cellHandle, 60000) == 0);
+    for (size_t x = 0; x < 2; x++) {
+        networkCount = 0;
+        gStopTimeMs = uPortGetTickTimeMs() +
+                      (U_CELL_TEST_CFG_CONNECT_TIMEOUT_SECONDS * 1000);
+        startTimeMs = uPortGetTickTimeMs();
+        scanCount = uCellNetScan(cellHandle, scanCallback, &networkCount,
+                                 keepGoingCallback);
+        U_TEST_PRINT_LINE("uCellNetScan() returned %d, %d network(s) reported,"
+                          " took %d ms.", scanCount, networkCount,
+                          (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+        U_PORT_TEST_ASSERT((scanCount < 0) || (scanCount == networkCount));
+        if (x > 0) {
+            // Can't be sure that the first scan succeeded but, if it
+            // did, the second should have been quick
+            U_PORT_TEST_ASSERT((scanCount <= 0) ||
+                               (uPortGetTickTimeMs() - startTimeMs < 1000));
+        }
+    }
+    U_PORT_TEST_ASSERT(uCellNetSetScanCacheMaxAge(cellHandle, 0) == 0);
+
     // Note: uCellNetDeepScan() is tested with the uCellTime API
     // since that is where the results can be used
 
@@ -813,6 +858,88 @@ U_PORT_TEST_FUNCTION("[cellNet]", "cellNetScanRegActDeact")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test registration with polling switched off, i.e. driven by
+ * the +CxREG URCs alone.
+ */
+U_PORT_TEST_FUNCTION("[cellNet]", "cellNetRegNoPolling")
+{
+    uDeviceHandle_t cellHandle;
+    int32_t resourceCount;
+    int64_t startTimeMs;
+
+    // In case a previous test failed
+    uCellTestPrivateCleanup(&gHandles);
+
+    // Obtain the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Do the standard preamble
+    U_PORT_TEST_ASSERT(uCellTestPrivatePreamble(U_CFG_TEST_CELL_MODULE_TYPE,
+                                                &gHandles, true) == 0);
+    cellHandle = gHandles.cellHandle;
+
+    // Polling is on by default
+    U_PORT_TEST_ASSERT(uCellNetGetRegistrationPolling(cellHandle));
+    U_PORT_TEST_ASSERT(uCellNetSetRegistrationPolling(cellHandle, false) == 0);
+    U_PORT_TEST_ASSERT(!uCellNetGetRegistrationPolling(cellHandle));
+
+    // Make sure we start from not registered
+    U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+
+    U_TEST_PRINT_LINE("registering without polling...");
+    startTimeMs = uPortGetTickTimeMs();
+    gStopTimeMs = startTimeMs + (U_CELL_TEST_CFG_CONNECT_TIMEOUT_SECONDS * 1000);
+    U_PORT_TEST_ASSERT(uCellNetRegister(cellHandle, NULL, keepGoingCallback) == 0);
+    U_TEST_PRINT_LINE("registration took %d ms.",
+                      (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+    U_PORT_TEST_ASSERT(uCellNetIsRegistered(cellHandle));
+
+    // Disconnect and put polling back as it was
+    U_TEST_PRINT_LINE("disconnecting...");
+    U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+    U_PORT_TEST_ASSERT(uCellNetSetRegistrationPolling(cellHandle, true) == 0);
+    U_PORT_TEST_ASSERT(uCellNetGetRegistrationPolling(cellHandle));
+
+    // Do the standard postamble, leaving the module on for the next
+    // test to speed things up
+    uCellTestPrivatePostamble(&gHandles, false);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test the APN database look-up; no module is required.
+ */
+U_PORT_TEST_FUNCTION("[cellNet]", "cellNetApnDb")
+{
+    const char *pConfig;
+
+    // The binary search relies on the table being sorted by MCC
+    for (size_t x = 1; x < sizeof(gApnLookUpTable) / sizeof(gApnLookUpTable[0]); x++) {
+        U_PORT_TEST_ASSERT(memcmp(gApnLookUpTable[x - 1].pMccMnc,
+                                  gApnLookUpTable[x].pMccMnc, 3) <= 0);
+    }
+
+    // First entry, last entry, a three-digit MNC and the
+    // second entry of an MCC
+    pConfig = pApnGetConfig("204041234567890");
+    U_PORT_TEST_ASSERT(strcmp(pConfig, "public4.m2minternet.com") == 0);
+    pConfig = pApnGetConfig("901371234567890");
+    U_PORT_TEST_ASSERT(strcmp(pConfig, "netgprs.com") == 0);
+    pConfig = pApnGetConfig("310680123456789");
+    U_PORT_TEST_ASSERT(strcmp(pConfig, "phone") == 0);
+    pConfig = pApnGetConfig("460011234567890");
+    U_PORT_TEST_ASSERT(strcmp(pConfig, "3gnet") == 0);
+    // Unknown MNC and unknown MCC give the default
+    pConfig = pApnGetConfig("262991234567890");
+    U_PORT_TEST_ASSERT(pConfig == pApnDefault);
+    pConfig = pApnGetConfig("999011234567890");
+    U_PORT_TEST_ASSERT(pConfig == pApnDefault);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
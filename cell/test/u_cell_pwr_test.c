@@ -787,6 +787,8 @@ U_PORT_TEST_FUNCTION("[cellPwr]", "cellPwr")
 U_PORT_TEST_FUNCTION("[cellPwr]", "cellPwrReboot")
 {
     int32_t resourceCount;
+    uint32_t fingerprint = 0;
+    uint32_t fingerprintAfter = 0;
 
     // In case a previous test failed
     uCellTestPrivateCleanup(&gHandles);
@@ -810,6 +812,25 @@ U_PORT_TEST_FUNCTION("[cellPwr]", "cellPwrReboot")
 
     U_PORT_TEST_ASSERT(uCellPwrIsAlive(gHandles.cellHandle));
 
+    // Now reboot again with fast boot on, which should
+    // leave the configuration fingerprint unchanged
+    if (uCellPwrGetConfigFingerprint(gHandles.cellHandle, &fingerprint) == 0) {
+        U_TEST_PRINT_LINE("rebooting cellular with fast boot, fingerprint 0x%08x...",
+                          fingerprint);
+        U_PORT_TEST_ASSERT(fingerprint != 0);
+        U_PORT_TEST_ASSERT(uCellPwrSetConfigFingerprint(gHandles.cellHandle,
+                                                        fingerprint) == 0);
+        U_PORT_TEST_ASSERT(uCellPwrReboot(gHandles.cellHandle, NULL) == 0);
+#ifdef U_CELL_TEST_MUX_ALWAYS
+        U_PORT_TEST_ASSERT(uCellMuxEnable(gHandles.cellHandle) == 0);
+#endif
+        U_PORT_TEST_ASSERT(uCellPwrIsAlive(gHandles.cellHandle));
+        U_PORT_TEST_ASSERT(uCellPwrGetConfigFingerprint(gHandles.cellHandle,
+                                                        &fingerprintAfter) == 0);
+        U_PORT_TEST_ASSERT(fingerprintAfter == fingerprint);
+        U_PORT_TEST_ASSERT(uCellPwrSetConfigFingerprint(gHandles.cellHandle, 0) == 0);
+    }
+
     // Do the standard postamble, leaving the module on for the next
     // test to speed things up
     uCellTestPrivatePostamble(&gHandles, false);
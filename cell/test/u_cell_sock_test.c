@@ -542,6 +542,7 @@ U_PORT_TEST_FUNCTION("[cellSock]", "cellSockBasic")
     uSockAddress_t echoServerAddressUdp;
     uSockAddress_t echoServerAddressTcp;
     uSockAddress_t address;
+    uCellNetDataCounterSample_t dataCounterSample = {0};
     int32_t y;
     int32_t w;
     int32_t z;
@@ -915,9 +916,30 @@ U_PORT_TEST_FUNCTION("[cellSock]", "cellSockBasic")
         U_PORT_TEST_ASSERT(y < 0);
     }
 
+    // Have the data counter sampler take the final count of this
+    // session at disconnect
+    y = uCellNetDataCounterSamplerStart(cellHandle, 0);
+    if (U_CELL_PRIVATE_HAS(pModule, U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)) {
+        U_PORT_TEST_ASSERT(y == 0);
+    } else {
+        U_PORT_TEST_ASSERT(y < 0);
+    }
+
     // Disconnect
     U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
 
+    if (U_CELL_PRIVATE_HAS(pModule, U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)) {
+        y = uCellNetDataCounterSamplerRead(cellHandle, &dataCounterSample, 1);
+        U_TEST_PRINT_LINE("data counter sampler: %d sample(s), %d byte(s) sent, %d"
+                          " byte(s) received at disconnect.", y,
+                          dataCounterSample.txBytes, dataCounterSample.rxBytes);
+        U_PORT_TEST_ASSERT(y == 1);
+        U_PORT_TEST_ASSERT(dataCounterSample.atDeactivation);
+        U_PORT_TEST_ASSERT((dataCounterSample.txBytes >= 0) && (dataCounterSample.rxBytes >= 0));
+        uCellNetDataCounterSamplerStop(cellHandle);
+    }
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, NULL, 0) < 0);
+
     // Do the standard postamble, leaving the module on for the next
     // test to speed things up
     uCellTestPrivatePostamble(&gHandles, false);
@@ -392,9 +392,34 @@ extern "C" {
 # define U_AT_CLIENT_CALLBACK_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
 #endif
 
+#ifndef U_AT_CLIENT_CALLBACK_TASK_PRIORITY_HIGH
+/** The priority of the task in which callbacks triggered via
+ * uAtClientCallback() from a URC handler of priority
+ * #U_AT_CLIENT_URC_PRIORITY_HIGH will run; must be less than
+ * #U_AT_CLIENT_URC_TASK_PRIORITY.
+ */
+# define U_AT_CLIENT_CALLBACK_TASK_PRIORITY_HIGH (U_AT_CLIENT_CALLBACK_TASK_PRIORITY + 1)
+#endif
+
+#ifndef U_AT_CLIENT_CALLBACK_TASK_PRIORITY_BULK
+/** The priority of the task in which callbacks triggered via
+ * uAtClientCallback() from a URC handler of priority
+ * #U_AT_CLIENT_URC_PRIORITY_BULK will run.  This is the same
+ * as #U_AT_CLIENT_CALLBACK_TASK_PRIORITY by default: it is
+ * enough that bulk callbacks are in a queue of their own.
+ */
+# define U_AT_CLIENT_CALLBACK_TASK_PRIORITY_BULK U_AT_CLIENT_CALLBACK_TASK_PRIORITY
+#endif
+
 #ifndef U_AT_CLIENT_MAX_NUM
-/** The maximum number of AT handlers that can be active at any
- * one time.
+/** The number of AT clients that can be active at any one time
+ * without the AT client having to allocate memory for its internal
+ * table of them; beyond this the table is grown, doubling in size
+ * each time, up to a limit of 256 AT clients.  Memory allocated
+ * for a grown table is only released by uAtClientDeinit().  Note
+ * that each AT client needs no tasks of its own beyond the one that
+ * the stream (e.g. UART) already has, in which URCs are handled:
+ * the callback queues and tasks are shared by all AT clients.
  */
 # define U_AT_CLIENT_MAX_NUM 5
 #endif
@@ -406,6 +431,81 @@ extern "C" {
 # define U_AT_CLIENT_ACTIVITY_PIN_HYSTERESIS_INTERVAL_MS 10
 #endif
 
+#ifndef U_AT_CLIENT_PIPELINE_MAX_IN_FLIGHT
+/** The maximum number of AT commands that uAtClientPipeline() will
+ * allow to be outstanding at the AT server at any one time; the
+ * maxInFlight parameter to uAtClientPipeline() is capped at this
+ * value.
+ */
+# define U_AT_CLIENT_PIPELINE_MAX_IN_FLIGHT 8
+#endif
+
+#ifndef U_AT_CLIENT_STATS_MAX_NUM_COMMANDS
+/** The maximum number of distinct AT commands that statistics
+ * are kept for by each AT client when U_CFG_AT_CLIENT_STATS is
+ * defined; commands beyond this number are not recorded.
+ */
+# define U_AT_CLIENT_STATS_MAX_NUM_COMMANDS 32
+#endif
+
+#ifndef U_AT_CLIENT_STATS_COMMAND_MAX_LENGTH_BYTES
+/** The maximum length of the AT command stored in
+ * #uAtClientStats_t, not including the null terminator;
+ * longer commands are truncated.
+ */
+# define U_AT_CLIENT_STATS_COMMAND_MAX_LENGTH_BYTES 15
+#endif
+
+#ifndef U_AT_CLIENT_STATS_NUM_BUCKETS
+/** The number of buckets in the latency histogram of
+ * #uAtClientStats_t: bucket 0 counts latencies of less than
+ * 1 ms, then bucket n counts latencies from 2^(n - 1) ms up
+ * to, but not including, 2^n ms, the last bucket counting
+ * everything larger.
+ */
+# define U_AT_CLIENT_STATS_NUM_BUCKETS 18
+#endif
+
+#ifndef U_AT_CLIENT_TIMEOUT_ADAPTIVE_PERCENTILE
+/** The percentile of the latency of an AT command, taken from the
+ * histogram of #uAtClientStats_t, that the adaptive AT timeout
+ * of uAtClientTimeoutAdaptiveSet() is based on.
+ */
+# define U_AT_CLIENT_TIMEOUT_ADAPTIVE_PERCENTILE 99
+#endif
+
+#ifndef U_AT_CLIENT_TIMEOUT_ADAPTIVE_SAFETY_FACTOR
+/** The factor by which the percentile latency, rounded up to
+ * the top of its histogram bucket, is multipled to give the
+ * adaptive AT timeout, see uAtClientTimeoutAdaptiveSet().
+ */
+# define U_AT_CLIENT_TIMEOUT_ADAPTIVE_SAFETY_FACTOR 4
+#endif
+
+#ifndef U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_MS
+/** The smallest adaptive AT timeout, see
+ * uAtClientTimeoutAdaptiveSet().
+ */
+# define U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_MS 200
+#endif
+
+#ifndef U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_SAMPLES
+/** The number of times an AT command must have completed before
+ * an adaptive AT timeout is applied to it, see
+ * uAtClientTimeoutAdaptiveSet().
+ */
+# define U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_SAMPLES 20
+#endif
+
+#ifndef U_AT_CLIENT_WRITE_PARAMS_BUFFER_LENGTH_BYTES
+/** The size of the buffer, on the stack, in which
+ * uAtClientWriteParams() assembles the parameters before
+ * writing them to the stream; parameters that do not fit are
+ * still written, it just takes more than one stream write.
+ */
+# define U_AT_CLIENT_WRITE_PARAMS_BUFFER_LENGTH_BYTES 64
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -449,6 +549,21 @@ typedef enum {
     U_AT_CLIENT_DEVICE_ERROR_TYPE_ABORTED  /**< ABORTED by the user */
 } uAtClientDeviceErrorType_t;
 
+/** The priority classes of URC handler, see
+ * uAtClientSetUrcHandlerExt(); the class determines which task
+ * any uAtClientCallback() made from the URC handler is run in.
+ */
+typedef enum {
+    U_AT_CLIENT_URC_PRIORITY_HIGH,   /**< latency-critical, e.g. socket
+                                          data arriving or a wake-up
+                                          from power saving. */
+    U_AT_CLIENT_URC_PRIORITY_NORMAL, /**< the default. */
+    U_AT_CLIENT_URC_PRIORITY_BULK,   /**< things that can wait and may take
+                                          time to process, e.g. location
+                                          or FOTA progress. */
+    U_AT_CLIENT_URC_PRIORITY_MAX_NUM
+} uAtClientUrcPriority_t;
+
 /** An AT error response structure with error code and type.
  */
 typedef struct {
@@ -456,6 +571,67 @@ typedef struct {
     int32_t code;
 } uAtClientDeviceError_t;
 
+/** A single AT command for use with uAtClientPipeline().
+ */
+typedef struct {
+    const char *pCommand; /**< the complete command, e.g. "AT+CGMR",
+                               without the trailing command delimiter;
+                               cannot be NULL. */
+    const char *pPrefix;  /**< the information response prefix to
+                               pass to uAtClientResponseStart(), e.g.
+                               "+CGMR:"; may be NULL. */
+    /** the function that will be called, between
+     *  uAtClientResponseStart() and uAtClientResponseStop(), to
+     *  parse the information response to this command using the
+     *  uAtClientReadXxx() functions; the function MUST NOT call
+     *  uAtClientLock(), uAtClientUnlock() or any of the
+     *  uAtClientCommandXxx()/uAtClientResponseXxx() functions.
+     *  May be NULL if no information response is expected. */
+    void (*pParser) (uAtClientHandle_t atHandle, size_t index, void *pParam);
+    void *pParserParam; /**< passed to pParser as its last parameter. */
+    int32_t errorCode;  /**< populated by uAtClientPipeline() with
+                             the outcome of this command: zero on
+                             success, #U_ERROR_COMMON_DEVICE_ERROR if
+                             the AT server responded with an error (in
+                             which case deviceError is also populated),
+                             #U_ERROR_COMMON_CANCELLED if the command was
+                             never sent or another negative error code. */
+    uAtClientDeviceError_t deviceError; /**< populated by uAtClientPipeline()
+                                             with any error reported by
+                                             the AT server. */
+} uAtClientPipelineCommand_t;
+
+/** The statistics for one AT command, as returned by
+ * uAtClientStatsGet(); only available if U_CFG_AT_CLIENT_STATS
+ * is defined.
+ */
+typedef struct {
+    char command[U_AT_CLIENT_STATS_COMMAND_MAX_LENGTH_BYTES + 1]; /**< the command,
+                                                                       up to but not
+                                                                       including any
+                                                                       "=" or "?",
+                                                                       e.g. "AT+USORD". */
+    uint32_t count;         /**< the number of times the command was sent. */
+    uint32_t timeoutCount;  /**< the number of AT timeouts while the command
+                                 was in progress. */
+    uint32_t bytesSent;     /**< the total number of bytes sent for the command. */
+    uint32_t bytesReceived; /**< the total number of bytes received while the
+                                 command was in progress. */
+    int32_t latencyMaxMs;   /**< the largest latency, from the start of the
+                                 command to the end of the response, seen. */
+    uint32_t latencyTotalMs; /**< the sum of the latencies of all of the
+                                  times the command was sent, i.e. the
+                                  total time spent in it. */
+    uint32_t latencyHistogram[U_AT_CLIENT_STATS_NUM_BUCKETS]; /**< log2 histogram of
+                                                                   latency, see
+                                                                   #U_AT_CLIENT_STATS_NUM_BUCKETS. */
+    int32_t timeoutAdaptiveMs; /**< the AT timeout that would be applied to
+                                    the command if adaptive timeouts were
+                                    on, see uAtClientTimeoutAdaptiveSet(),
+                                    -1 if there is none; filled in by
+                                    uAtClientStatsGet(). */
+} uAtClientStats_t;
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: INITIALISATION AND CONFIGURATION
  * -------------------------------------------------------------- */
@@ -695,6 +871,45 @@ void uAtClientTimeoutCallbackGet(uAtClientHandle_t atHandle,
                                  void (**ppCallback) (uAtClientHandle_t,
                                                       int32_t *));
 
+/** Switch adaptive AT timeouts on or off; they are off by default.
+ * When on, an AT command that has completed at least
+ * #U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_SAMPLES times, according to the
+ * statistics of uAtClientStatsGet(), and has never timed out, is given
+ * an AT timeout of the #U_AT_CLIENT_TIMEOUT_ADAPTIVE_PERCENTILE
+ * percentile of its latency multiplied by
+ * #U_AT_CLIENT_TIMEOUT_ADAPTIVE_SAFETY_FACTOR, minimum
+ * #U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_MS, if that is shorter than the
+ * timeout it would otherwise have.  An unresponsive AT server is then
+ * detected, e.g. by the callback of uAtClientTimeoutCallbackSet(),
+ * within a few hundred milliseconds rather than after the
+ * #U_AT_CLIENT_DEFAULT_TIMEOUT_MS of the worst case.
+ *
+ * The timeout is only adapted where the code sending the command
+ * has left the AT timeout alone: a call to uAtClientTimeoutSet()
+ * during the AT lock, e.g. for a command known to take a long time,
+ * is always obeyed.  Once a command has timed out it is no longer
+ * adapted, in case the timeout was genuinely too short, until
+ * uAtClientStatsReset() is called.
+ *
+ * Only available if U_CFG_AT_CLIENT_STATS is defined for the build.
+ *
+ * @param atHandle  the handle of the AT client.
+ * @param onNotOff  true to switch adaptive AT timeouts on, else false.
+ * @return          zero on success else negative error code, e.g.
+ *                  #U_ERROR_COMMON_NOT_SUPPORTED if
+ *                  U_CFG_AT_CLIENT_STATS is not defined.
+ */
+int32_t uAtClientTimeoutAdaptiveSet(uAtClientHandle_t atHandle,
+                                    bool onNotOff);
+
+/** Get whether adaptive AT timeouts are on, see
+ * uAtClientTimeoutAdaptiveSet().
+ *
+ * @param atHandle  the handle of the AT client.
+ * @return          true if adaptive AT timeouts are on, else false.
+ */
+bool uAtClientTimeoutAdaptiveGet(const uAtClientHandle_t atHandle);
+
 /** Get the delimiter that is used between parameters in
  * an outgoing AT command or is expected between parameters in
  * a response from the AT server.
@@ -733,6 +948,34 @@ int32_t uAtClientDelayGet(const uAtClientHandle_t atHandle);
 void uAtClientDelaySet(uAtClientHandle_t atHandle,
                        int32_t delayMs);
 
+/** Get whether event-driven reads are on or off, see
+ * uAtClientEventDrivenSet().
+ *
+ * @param atHandle  the handle of the AT client.
+ * @return          true if event-driven reads are on, else false.
+ */
+bool uAtClientEventDrivenGet(const uAtClientHandle_t atHandle);
+
+/** Switch event-driven reads on or off.  By default, when
+ * waiting for a response, the AT client polls the stream every
+ * #U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS.  With event-driven
+ * reads switched on the waiting task instead blocks on a
+ * semaphore which is given by the event callback of the stream
+ * when data arrives, so a response is processed as soon as it
+ * lands; a complete line of response is also processed at once,
+ * rather than waiting #U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS in
+ * case more follows.  #U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS
+ * remains the upper limit on any single wait, so a stream which
+ * does not signal every arrival of data is no worse off.
+ *
+ * @param atHandle  the handle of the AT client.
+ * @param onNotOff  true to switch event-driven reads on, false
+ *                  to switch them off.
+ * @return          zero on success else negative error code.
+ */
+int32_t uAtClientEventDrivenSet(uAtClientHandle_t atHandle,
+                                bool onNotOff);
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: SEND AN AT COMMAND
  * -------------------------------------------------------------- */
@@ -909,6 +1152,51 @@ void uAtClientWriteHexData(uAtClientHandle_t atHandle,
                            const uint8_t *pData,
                            uint8_t lengthBytes);
 
+/** Write a number of AT command parameters in one go, used
+ * after uAtClientCommandStart() has been called to start the
+ * AT command sequence.  The effect is exactly as if the
+ * equivalent uAtClientWriteInt(), uAtClientWriteUint64(),
+ * uAtClientWriteString() or uAtClientWriteBytes() (with
+ * standalone false) calls had been made, one per parameter,
+ * except that the parameters, with delimiters, are assembled
+ * into a single buffer and passed to the stream in one write,
+ * which is more efficient.  For example, instead of:
+ *
+ * ```
+ * uAtClientWriteInt(atHandle, socket);
+ * uAtClientWriteString(atHandle, "1.2.3.4", true);
+ * uAtClientWriteInt(atHandle, port);
+ * ```
+ *
+ * ...you could write:
+ *
+ * ```
+ * uAtClientWriteParams(atHandle, "isi", socket, "1.2.3.4", port);
+ * ```
+ *
+ * @param atHandle     the handle of the AT client.
+ * @param[in] pFormat  a null-terminated string with one character
+ *                     per parameter to follow, which may be:
+ *                     - 'i': an int32_t,
+ *                     - 'l': a uint64_t,
+ *                     - 's': a null-terminated string, to be
+ *                       written with quotes around it; NULL
+ *                       is written as an empty string,
+ *                     - 'r': a null-terminated string, to be
+ *                       written as-is, without quotes; NULL
+ *                       writes nothing,
+ *                     - 'b': a pointer to some bytes, type
+ *                       const char *, followed by the number of
+ *                       bytes, type size_t.
+ *                     Any other character will cause the AT
+ *                     client error to be set to
+ *                     #U_ERROR_COMMON_INVALID_PARAMETER, which
+ *                     will be returned by uAtClientUnlock().
+ * @param ...          the parameters, as described by pFormat.
+ */
+void uAtClientWriteParams(uAtClientHandle_t atHandle,
+                          const char *pFormat, ...);
+
 /** Stop the outgoing AT command by writing the
  * command terminator.  Should be called after
  * uAtClientCommandStart() and any uAtClientWritexxx()
@@ -1037,6 +1325,13 @@ int32_t uAtClientReadString(uAtClientHandle_t atHandle,
  * stop tag to be obeyed either, call
  * uAtClientIgnoreStopTag() first.
  *
+ * When the stop tag is not being obeyed, pBuffer is not NULL
+ * and no receive intercept function has been set (see
+ * uAtClientStreamInterceptRx()), the bytes are moved from the
+ * UART or virtual serial stream straight into pBuffer, without
+ * being staged in the receive buffer of the AT client; in this
+ * case lengthBytes is not limited by the receive buffer size.
+ *
  * @param atHandle      the handle of the AT client.
  * @param[out] pBuffer  a buffer in which to place the
  *                      bytes read.  May be set to NULL
@@ -1067,6 +1362,45 @@ int32_t uAtClientReadBytes(uAtClientHandle_t atHandle,
                            char *pBuffer, size_t lengthBytes,
                            bool standalone);
 
+/** Read the given number of bytes from the received AT response
+ * stream, e.g. the binary payload of a URC once its prefix and
+ * length have been read, passing them to pCallback in segments
+ * straight out of the receive buffer of the AT client: the
+ * receive buffer is re-used for each segment so lengthBytes is
+ * not limited by its size and the caller needs no buffer of
+ * its own.  Neither delimiters nor the stop tag are searched for
+ * within the lengthBytes; any stop tag following them is handled
+ * as usual, e.g. by uAtClientResponseStop().
+ *
+ * pCallback is called with the AT client locked and hence must
+ * not call any function of this API on atHandle; it must also
+ * not keep pData beyond its return.
+ *
+ * @param atHandle            the handle of the AT client.
+ * @param lengthBytes         the number of bytes to read.
+ * @param[in] pCallback       the function to receive the data:
+ *                            pData points to size bytes which are
+ *                            at offset from the start of the
+ *                            lengthBytes; return false to have the
+ *                            remainder of the bytes read and thrown
+ *                            away without calling pCallback again.
+ *                            Cannot be NULL.
+ * @param[in] pCallbackParam  passed to pCallback as its last
+ *                            parameter, may be NULL.
+ * @return                    the number of bytes read, which will
+ *                            be lengthBytes even if pCallback
+ *                            returned false, else negative error
+ *                            code.
+ */
+int32_t uAtClientReadBytesStream(uAtClientHandle_t atHandle,
+                                 size_t lengthBytes,
+                                 bool (*pCallback) (uAtClientHandle_t atHandle,
+                                                    const char *pData,
+                                                    size_t size,
+                                                    size_t offset,
+                                                    void *pCallbackParam),
+                                 void *pCallbackParam);
+
 /** Read binary data received as a hex string from from the
  *  AT response
  *
@@ -1085,6 +1419,45 @@ int32_t uAtClientReadHexData(uAtClientHandle_t atHandle,
                              uint8_t *pData,
                              uint8_t lengthBytes);
 
+/** Read a parameter from the received AT response without
+ * copying it: instead of placing the parameter in a caller's
+ * buffer, as uAtClientReadString() does, a pointer is returned
+ * into the receive buffer of the AT client, along with the
+ * length of the parameter.  This is useful where a long
+ * parameter (e.g. a hex-encoded block of socket data) is
+ * going to be decoded by the caller anyway and so the copy
+ * performed by uAtClientReadString() would be wasted effort.
+ *
+ * The delimiter and the stop tag are obeyed exactly as for
+ * uAtClientReadString(), surrounding quotation marks are
+ * removed (quotation marks within the parameter are NOT
+ * removed, they will be included in the view) and the
+ * delimiter/stop tag are consumed, so the next read function
+ * will begin with the following parameter.
+ *
+ * The whole parameter, plus its delimiter or stop tag, must
+ * fit into the receive buffer of the AT client (see
+ * uAtClientAddExt()); if it does not then nothing is consumed
+ * and #U_ERROR_COMMON_NO_MEMORY is returned, in which case the
+ * caller may read the parameter with uAtClientReadString()
+ * instead.
+ *
+ * IMPORTANT: the returned pointer is only valid until the next
+ * call into this AT client and the contents are NOT null
+ * terminated; you MUST only access the returned number of
+ * characters.
+ *
+ * @param atHandle           the handle of the AT client.
+ * @param[out] ppParameter   a place to put the pointer to the
+ *                           start of the parameter; may be NULL,
+ *                           in which case the parameter is just
+ *                           skipped.
+ * @return                   the length of the parameter in bytes
+ *                           or negative error code.
+ */
+int32_t uAtClientReadParameterView(uAtClientHandle_t atHandle,
+                                   const char **ppParameter);
+
 /** Marks the end of an AT response, should be called
  * after uAtClientResponseStart() when all of the
  * wanted parameters have been read.  The remainder of
@@ -1166,6 +1539,55 @@ void uAtClientSkipBytes(uAtClientHandle_t atHandle,
 int32_t uAtClientWaitCharacter(uAtClientHandle_t atHandle,
                                char character);
 
+/** Send a sequence of independent AT commands, with up to
+ * maxInFlight of them outstanding at the AT server at any one
+ * time, and process the responses in order as they arrive.
+ * This avoids the round-trip idle time of the usual one command
+ * at a time scheme when a number of queries need to be made, e.g.
+ * during start-up configuration.  With maxInFlight greater than 1
+ * the inter-command delay set with uAtClientDelaySet() is NOT applied
+ * between the commands of a pipeline, only before the first.
+ *
+ * This function performs the locking itself: it MUST NOT be called
+ * between uAtClientLock() and uAtClientUnlock().  Each command is
+ * sent, in full, exactly as it appears in pCommand; for each one, in
+ * order, uAtClientResponseStart() is called with pPrefix, then
+ * pParser (if not NULL), then uAtClientResponseStop(), and the
+ * outcome is written to the errorCode/deviceError fields of the
+ * command.  An error response from the AT server to one command does
+ * not affect the others; a timeout or a stream error, on the other
+ * hand, means that the responses can no longer be matched to the
+ * commands, hence in this case the AT client is flushed and all
+ * commands not yet completed are marked with an error.
+ *
+ * Note that, strictly speaking, an AT server is only obliged to
+ * accept a new command once it has sent the final result code of the
+ * previous one: only set maxInFlight to more than 1 for an AT server
+ * known to buffer incoming commands and to need no inter-command
+ * delay.  With maxInFlight set to 1 each command is only sent once
+ * the previous one has completed and the uAtClientDelaySet() gap is
+ * kept, exactly as in the usual scheme: there is no time saved on the
+ * wire but the whole sequence is sent under one lock and comes back
+ * as one set of results.
+ *
+ * @param atHandle          the handle of the AT client.
+ * @param[in,out] pCommands an array of numCommands commands; the
+ *                          errorCode and deviceError fields of each
+ *                          entry will be populated.
+ * @param numCommands       the number of entries at pCommands.
+ * @param maxInFlight       the maximum number of commands that may
+ *                          be outstanding at the AT server at any one
+ *                          time; must be at least 1, values larger
+ *                          than #U_AT_CLIENT_PIPELINE_MAX_IN_FLIGHT
+ *                          are capped.
+ * @return                  on success the number of commands that
+ *                          completed with no error, else negative
+ *                          error code.
+ */
+int32_t uAtClientPipeline(uAtClientHandle_t atHandle,
+                          uAtClientPipelineCommand_t *pCommands,
+                          size_t numCommands, size_t maxInFlight);
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: HANDLE UNSOLICITED RESPONSES
  * -------------------------------------------------------------- */
@@ -1216,6 +1638,53 @@ int32_t uAtClientSetUrcHandler(uAtClientHandle_t atHandle,
                                                  void *),
                                void *pHandlerParam);
 
+/** As uAtClientSetUrcHandler() but with a priority class.  A
+ * URC handler itself always runs in the URC task, in the order
+ * that URCs arrive, but any uAtClientCallback() made from within
+ * the handler is queued according to the priority class of the
+ * handler: each class has its own callback queue and task, the
+ * task for #U_AT_CLIENT_URC_PRIORITY_HIGH running at
+ * #U_AT_CLIENT_CALLBACK_TASK_PRIORITY_HIGH and that for
+ * #U_AT_CLIENT_URC_PRIORITY_BULK at
+ * #U_AT_CLIENT_CALLBACK_TASK_PRIORITY_BULK.  This means that,
+ * for instance, a slow callback resulting from a bulk URC will
+ * not delay the callback of a high priority one.  The callback
+ * queues and tasks for the high and bulk classes are shared by
+ * all AT clients and are only created when a URC handler of
+ * that class is first set.  If a handler is already set for
+ * the given prefix then the new setting is ignored.
+ *
+ * @param atHandle           the handle of the AT client.
+ * @param[in] pPrefix        the prefix for the URC, e.g. "+UUSORD:".
+ * @param[in] pHandler       the function to be called if the prefix
+ *                           is found at the start of an AT string
+ *                           from the AT server.
+ * @param[in] pHandlerParam  void * parameter to be passed to the
+ *                           function call as the second parameter,
+ *                           may be NULL.
+ * @param priority           the priority class of the URC handler.
+ * @return                   zero on success else negative error code.
+ */
+int32_t uAtClientSetUrcHandlerExt(uAtClientHandle_t atHandle,
+                                  const char *pPrefix,
+                                  void (*pHandler) (uAtClientHandle_t,
+                                                    void *),
+                                  void *pHandlerParam,
+                                  uAtClientUrcPriority_t priority);
+
+/** Get the priority class of a URC handler.
+ *
+ * @param atHandle     the handle of the AT client.
+ * @param[in] pPrefix  the prefix for the URC, which would have been
+ *                     set in a call to uAtClientSetUrcHandler() or
+ *                     uAtClientSetUrcHandlerExt().
+ * @return             the priority class, else negative error code,
+ *                     e.g. #U_ERROR_COMMON_NOT_FOUND if there is no
+ *                     handler for pPrefix.
+ */
+int32_t uAtClientUrcHandlerPriorityGet(uAtClientHandle_t atHandle,
+                                       const char *pPrefix);
+
 /** Remove an unsolicited response code handler.
  *
  * IMPORTANT: make sure that this function is only called
@@ -1292,6 +1761,20 @@ int32_t uAtClientUrcHandlerGetNext(uAtClientHandle_t atHandle,
                                                        void *),
                                    void **ppHandlerParam);
 
+/** Get the number of times the URC handler for the given prefix
+ * has been called since it was set with uAtClientSetUrcHandler();
+ * useful when working out which URCs are keeping the AT client busy.
+ * This function MUST NOT be called from a URC handler.
+ *
+ * @param atHandle    the handle of the AT client.
+ * @param[in] pPrefix the prefix of the URC handler, exactly as
+ *                    passed to uAtClientSetUrcHandler().
+ * @return            the number of times the URC handler has been
+ *                    called, else negative error code.
+ */
+int32_t uAtClientUrcHandlerHitCountGet(uAtClientHandle_t atHandle,
+                                       const char *pPrefix);
+
 /** \deprecated Hijack the URC handler, replacing it with the given
  * URC handler.  This function is deprecated and may be removed at
  * some point in the future; please use uAtClientUrcHandlerHijackExt()
@@ -1361,7 +1844,13 @@ int32_t uAtClientUrcHandlerStackMinFree(uAtClientHandle_t atHandle);
  * they are called.  A single callback queue is shared between
  * all AT client instances; you can determine which instance
  * has made the call by checking #uAtClientHandle_t, the first
- * parameter passed to the callback.
+ * parameter passed to the callback.  The exception is where
+ * this function is called from a URC handler that was set
+ * with uAtClientSetUrcHandlerExt() with a priority class other
+ * than #U_AT_CLIENT_URC_PRIORITY_NORMAL: then the callback is
+ * queued on the callback queue of that class instead, and so
+ * is only guaranteed to be run in order with respect to other
+ * callbacks of the same class.
  *
  * @param atHandle            the handle of the AT client.
  * @param[in] pCallback       the callback function.
@@ -1762,6 +2251,60 @@ int32_t uAtClientGetActivityPinSettings(const uAtClientHandle_t atHandle,
                                         int32_t *pReadyMs, int32_t *pHysteresisMs,
                                         bool *pHighIsOn);
 
+/** Switch the activity pin on in advance, because AT commands are
+ * known to be coming, and keep it on until released.  Normally the
+ * activity pin is switched on when the AT client is locked, after
+ * which the AT client waits readyMs (see uAtClientSetActivityPin())
+ * for the module at the other end to be ready, and it is switched
+ * off again when the AT client is unlocked.  If instead the pin is
+ * held by calling this function with holdNotRelease true, the
+ * readyMs wait starts immediately, while this MCU gets on with
+ * preparing what it is going to send, and only what remains of it
+ * is waited for when the AT client is locked; the pin then also
+ * stays on between AT commands, removing the wait altogether for
+ * those that follow, until the hold is released by calling this
+ * function with holdNotRelease false.  Holds may be nested, the pin
+ * is switched off when the last one is released.  Other than
+ * waiting for any AT command already in progress to finish, and
+ * for the hysteresis time of the pin, this function does not block.
+ *
+ * @param atHandle        the handle of the AT client.
+ * @param holdNotRelease  true to hold the activity pin on, false to
+ *                        release a previous hold.
+ * @return                zero on success else negative error code,
+ *                        e.g. if no activity pin is set.
+ */
+int32_t uAtClientActivityPinHold(uAtClientHandle_t atHandle, bool holdNotRelease);
+
+/** Get the per-command statistics of an AT client: the number of
+ * times each AT command was sent, the latency from the call to
+ * uAtClientCommandStart() to the call to uAtClientResponseStop(),
+ * as a log2 histogram, the bytes sent and received and the number
+ * of AT timeouts.  This is useful when working out what AT timeout
+ * a given command really needs.  The statistics are only collected
+ * if U_CFG_AT_CLIENT_STATS is defined for the build.
+ *
+ * @param atHandle     the handle of the AT client.
+ * @param[out] pStats  a pointer to an array of numStats entries in
+ *                     which the statistics will be stored, one entry
+ *                     per AT command, in the order the commands were
+ *                     first sent.
+ * @param numStats     the number of entries at pStats; at most
+ *                     #U_AT_CLIENT_STATS_MAX_NUM_COMMANDS will be used.
+ * @return             on success the number of entries populated,
+ *                     else negative error code, e.g.
+ *                     #U_ERROR_COMMON_NOT_SUPPORTED if
+ *                     U_CFG_AT_CLIENT_STATS is not defined.
+ */
+int32_t uAtClientStatsGet(uAtClientHandle_t atHandle,
+                          uAtClientStats_t *pStats, size_t numStats);
+
+/** Reset the statistics of an AT client, see uAtClientStatsGet().
+ *
+ * @param atHandle  the handle of the AT client.
+ */
+void uAtClientStatsReset(uAtClientHandle_t atHandle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_AT_CLIENT_CAPTURE_H_
+#define _U_AT_CLIENT_CAPTURE_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#include "u_device_serial.h"
+#include "u_at_client.h"
+
+/** \addtogroup _AT-client
+ *  @{
+ */
+
+/** @file
+ * @brief Capture and replay of AT client traffic. A capture
+ * is started on an existing AT client with pUAtClientCaptureStart():
+ * this hooks the transmit and receive intercepts of the AT client
+ * (see uAtClientStreamInterceptTx() and uAtClientStreamInterceptRx())
+ * and passes the traffic, timestamped, to a write function that
+ * you provide; on Linux or Windows that function would typically
+ * fwrite() the data to a file.
+ *
+ * A capture, loaded back into RAM, can then be given to
+ * pUAtClientReplayCreate(), which returns a virtual serial device
+ * that can be passed to uAtClientAddExt() as
+ * #U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL.  The device plays back
+ * the received data of the capture, ignoring the timestamps, i.e.
+ * as fast as the AT client can consume it: the received data that
+ * followed a transmission in the capture is only made available
+ * once the AT client has written that transmission, so that
+ * responses cannot overtake the commands that caused them.  This
+ * allows AT parsing and the code that sits above the AT client to
+ * be exercised, and timed, without a real module.
+ *
+ * The capture format is compact and binary: a header of
+ * #U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES, consisting of the four
+ * characters "UATC" followed by a version byte
+ * (#U_AT_CLIENT_CAPTURE_VERSION) and three reserved bytes, then
+ * any number of records, each of which is:
+ *
+ * - one byte of direction, #U_AT_CLIENT_CAPTURE_DIRECTION_TX or
+ *   #U_AT_CLIENT_CAPTURE_DIRECTION_RX,
+ * - a four byte little-endian timestamp, the number of milliseconds
+ *   since the capture was started,
+ * - a two byte little-endian length,
+ * - that many bytes of data.
+ *
+ * Note that since the capture uses the intercept functions of
+ * the AT client it cannot be used at the same time as anything
+ * else that does so, e.g. CMUX.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The version of the capture format.
+ */
+#define U_AT_CLIENT_CAPTURE_VERSION 1
+
+/** The length of the header at the start of a capture.
+ */
+#define U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES 8
+
+/** The length of the header at the start of each record in a
+ * capture: direction, timestamp and length.
+ */
+#define U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES 7
+
+/** The direction value of a record which contains data sent
+ * by the AT client.
+ */
+#define U_AT_CLIENT_CAPTURE_DIRECTION_TX 0x01
+
+/** The direction value of a record which contains data received
+ * by the AT client.
+ */
+#define U_AT_CLIENT_CAPTURE_DIRECTION_RX 0x02
+
+#ifndef U_AT_CLIENT_REPLAY_CALLBACK_QUEUE_LENGTH
+/** The number of events that may be waiting to be delivered to
+ * the event callback of a replay device.
+ */
+# define U_AT_CLIENT_REPLAY_CALLBACK_QUEUE_LENGTH 10
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** Forward declaration of a capture, private to this module.
+ */
+struct uAtClientCapture_t;
+
+/** A write function for a capture: this will be called with
+ * chunks of the capture, header first, which should be stored
+ * in order.  It is called from whatever task is reading or writing
+ * the AT client at the time and hence should not block for long.
+ *
+ * @param[in] pData   the data to store; will not be NULL.
+ * @param length      the number of bytes at pData.
+ * @param[in] pParam  the pWriteParam pointer that was passed to
+ *                    pUAtClientCaptureStart().
+ * @return            zero on success, else negative error code.
+ */
+typedef int32_t (*uAtClientCaptureWrite_t)(const void *pData, size_t length,
+                                           void *pParam);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: CAPTURE
+ * -------------------------------------------------------------- */
+
+/** Start capturing the traffic of an AT client.  This sets the
+ * transmit and receive intercept functions of the AT client,
+ * replacing any that are already set, and hence any data in the
+ * receive buffer of the AT client is lost.  Must NOT be called
+ * while the AT client is locked: this function locks the AT
+ * client itself.
+ *
+ * @param atHandle          the handle of the AT client.
+ * @param[in] pWrite        the function that will be called to
+ *                          store the capture; cannot be NULL.
+ * @param[in] pWriteParam   a parameter that will be passed to
+ *                          pWrite as its last parameter; may
+ *                          be NULL.
+ * @return                  on success a pointer to the capture,
+ *                          which should be passed to
+ *                          uAtClientCaptureStop() when done,
+ *                          else NULL.
+ */
+struct uAtClientCapture_t *pUAtClientCaptureStart(uAtClientHandle_t atHandle,
+                                                  uAtClientCaptureWrite_t pWrite,
+                                                  void *pWriteParam);
+
+/** Stop a capture, removing the intercept functions from the AT
+ * client and freeing memory.  Must NOT be called while the AT
+ * client is locked: this function locks the AT client itself.
+ *
+ * @param[in] pCapture  the capture, as returned by
+ *                      pUAtClientCaptureStart().
+ * @return              on success the number of records that
+ *                      were captured, else negative error code,
+ *                      e.g. if a call to the write function failed
+ *                      at any point, in which case the capture
+ *                      is likely incomplete.
+ */
+int32_t uAtClientCaptureStop(struct uAtClientCapture_t *pCapture);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: REPLAY
+ * -------------------------------------------------------------- */
+
+/** Create a virtual serial device that plays back a capture.
+ * The device should be opened with its open() function and can
+ * then be passed to uAtClientAddExt() as a stream of type
+ * #U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL.  Calling open() again,
+ * after close(), starts the replay from the beginning.
+ *
+ * @param[in] pCapture  a pointer to the capture; this is NOT
+ *                      copied and so must remain valid until
+ *                      uAtClientReplayDelete() is called.
+ * @param size          the number of bytes at pCapture.
+ * @return              on success a pointer to the serial device,
+ *                      else NULL, e.g. if the capture header is
+ *                      not valid.
+ */
+uDeviceSerial_t *pUAtClientReplayCreate(const void *pCapture, size_t size);
+
+/** Get the number of bytes written to a replay device that did
+ * not match the transmitted data of the capture, including any
+ * bytes written after the end of the capture; useful for
+ * regression testing.
+ *
+ * @param[in] pDeviceSerial  the replay device, as returned by
+ *                           pUAtClientReplayCreate().
+ * @return                   the number of mismatched bytes, else
+ *                           negative error code.
+ */
+int32_t uAtClientReplayMismatchGet(uDeviceSerial_t *pDeviceSerial);
+
+/** Get whether all of the received data in a capture has been
+ * read from a replay device.
+ *
+ * @param[in] pDeviceSerial  the replay device, as returned by
+ *                           pUAtClientReplayCreate().
+ * @return                   true if the replay has been completely
+ *                           read, else false.
+ */
+bool uAtClientReplayIsDone(uDeviceSerial_t *pDeviceSerial);
+
+/** Delete a replay device; the device should first be closed
+ * and any AT client using it removed.
+ *
+ * @param[in] pDeviceSerial  the replay device, as returned by
+ *                           pUAtClientReplayCreate().
+ */
+void uAtClientReplayDelete(uDeviceSerial_t *pDeviceSerial);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_AT_CLIENT_CAPTURE_H_
+
+// End of file
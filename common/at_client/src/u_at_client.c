@@ -34,6 +34,7 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "stdarg.h"    // va_list
 #include "string.h"    // memcpy(), strcmp(), strcspn(), strspm()
 #include "stdio.h"     // snprintf()
 #include "ctype.h"     // isprint()
@@ -57,6 +58,8 @@
 #include "u_port_gpio.h"
 #include "u_port_uart.h"
 #include "u_port_event_queue.h"
+#include "u_port_atomic.h"
+#include "u_log_ram_trace.h" // U_LOG_RAM_TRACE_XXX()
 
 #include "u_device_serial.h"
 
@@ -67,6 +70,7 @@
 #include "u_short_range_edm_stream.h"
 
 #include "u_hex_bin_convert.h"
+#include "u_perf_counters.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -250,6 +254,22 @@
  */
 #define U_AT_CLIENT_MAGIC_NUMBER_START 1
 
+/** The number of bits at the bottom of an AT client magic number
+ * that give the slot of the AT client in the asynchronous-processing
+ * table, the remaining bits being a sequence number; this limits
+ * the number of AT clients to 2 to the power of this.
+ */
+#define U_AT_CLIENT_MAGIC_NUMBER_SLOT_BITS 8
+
+/** The mask for the slot bits of an AT client magic number.
+ */
+#define U_AT_CLIENT_MAGIC_NUMBER_SLOT_MASK ((1 << U_AT_CLIENT_MAGIC_NUMBER_SLOT_BITS) - 1)
+
+/** The number of buckets in the hash table used to find an
+ * AT client by stream.
+ */
+#define U_AT_CLIENT_STREAM_HASH_TABLE_LENGTH 16
+
 /** Get the stream handle as an integer: for printing only.
  */
 #define U_AT_CLIENT_HANDLE_FOR_PRINT(pClient) (pClient->stream.type == U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL ? (int) (uintptr_t) pClient->stream.handle.pDeviceSerial : pClient->stream.handle.int32)
@@ -258,10 +278,43 @@
  */
 #define U_AT_CLIENT_PRINT_TIMESTAMP_BUFFER_SIZE_BYTES 27
 
+/** The longest run of printable characters that printAt() passes
+ * to uPortLog() in one go; kept short enough that it fits into the
+ * strings area of a deferred print (see #U_CFG_LOG_DEFERRED).
+ */
+#define U_AT_CLIENT_PRINT_AT_RUN_MAX_LENGTH_BYTES 32
+
+#ifndef U_AT_CLIENT_URC_HASH_KEY_LENGTH
+/** The number of characters at the start of a URC prefix that are
+ * hashed to select the URC handler bucket; URC prefixes shorter than
+ * this are kept on a separate list which is always searched.  Most
+ * URC prefixes begin with "+U", hence this needs to be reasonably
+ * long to be of use.
+ */
+# define U_AT_CLIENT_URC_HASH_KEY_LENGTH 5
+#endif
+
+#ifndef U_AT_CLIENT_URC_HASH_NUM_BUCKETS
+/** The number of buckets in the URC handler hash table of each AT
+ * client: must be a power of two.
+ */
+# define U_AT_CLIENT_URC_HASH_NUM_BUCKETS 16
+#endif
+
+#if (U_AT_CLIENT_URC_HASH_NUM_BUCKETS & (U_AT_CLIENT_URC_HASH_NUM_BUCKETS - 1)) != 0
+# error U_AT_CLIENT_URC_HASH_NUM_BUCKETS must be a power of two
+#endif
+
 // Do some cross-checking
 #if (U_AT_CLIENT_CALLBACK_TASK_PRIORITY >= U_AT_CLIENT_URC_TASK_PRIORITY)
 # error U_AT_CLIENT_CALLBACK_TASK_PRIORITY must be less than U_AT_CLIENT_URC_TASK_PRIORITY
 #endif
+#if (U_AT_CLIENT_CALLBACK_TASK_PRIORITY_HIGH >= U_AT_CLIENT_URC_TASK_PRIORITY)
+# error U_AT_CLIENT_CALLBACK_TASK_PRIORITY_HIGH must be less than U_AT_CLIENT_URC_TASK_PRIORITY
+#endif
+#if (U_AT_CLIENT_CALLBACK_TASK_PRIORITY_BULK >= U_AT_CLIENT_URC_TASK_PRIORITY)
+# error U_AT_CLIENT_CALLBACK_TASK_PRIORITY_BULK must be less than U_AT_CLIENT_URC_TASK_PRIORITY
+#endif
 
 #ifdef U_CFG_AT_CLIENT_DETAILED_DEBUG
 /** Macros for detailed debugging of buffering behaviour.
@@ -294,6 +347,37 @@
 # define LOG_IF(cond, place)
 #endif
 
+#ifdef U_CFG_AT_CLIENT_STATS
+/** Macros for collecting per-command statistics; each is a single
+ * statement, so that it is safe in an unbraced if/else.
+ */
+# define STATS_COMMAND_START(pClient, pCommand) statsCommandStart(pClient, pCommand)
+# define STATS_RESPONSE_STOP(pClient) statsResponseStop(pClient)
+# define STATS_END(pClient) ((pClient)->pStatsCurrent = NULL)
+# define STATS_BYTES_SENT(pClient, numBytes) do {                                                          \
+                                                 if ((pClient)->pStatsCurrent != NULL) {                   \
+                                                     (pClient)->pStatsCurrent->bytesSent += (numBytes);    \
+                                                 }                                                         \
+                                             } while (0)
+# define STATS_BYTES_RECEIVED(pClient, numBytes) do {                                                          \
+                                                     if ((pClient)->pStatsCurrent != NULL) {                   \
+                                                         (pClient)->pStatsCurrent->bytesReceived += (numBytes);\
+                                                     }                                                         \
+                                                 } while (0)
+# define STATS_TIMEOUT(pClient) do {                                                  \
+                                    if ((pClient)->pStatsCurrent != NULL) {           \
+                                        (pClient)->pStatsCurrent->timeoutCount++;     \
+                                    }                                                 \
+                                } while (0)
+#else
+# define STATS_COMMAND_START(pClient, pCommand)
+# define STATS_RESPONSE_STOP(pClient)
+# define STATS_END(pClient)
+# define STATS_BYTES_SENT(pClient, numBytes)
+# define STATS_BYTES_RECEIVED(pClient, numBytes)
+# define STATS_TIMEOUT(pClient)
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -327,6 +411,9 @@ typedef struct uAtClientUrc_t {
     size_t prefixLength;       /** The length of pPrefix. */
     void (*pHandler) (uAtClientHandle_t, void *); /** The handler to call if pPrefix is matched. */
     void *pHandlerParam;       /** The parameter to pass to pHandler. */
+    uint32_t hitCount;         /** The number of times pHandler has been called. */
+    uAtClientUrcPriority_t priority; /** The priority class of this URC. */
+    struct uAtClientUrc_t *pNextInBucket; /** The next URC in the same hash bucket. */
     struct uAtClientUrc_t *pNext;
 } uAtClientUrc_t;
 
@@ -407,6 +494,10 @@ typedef struct {
     bool highIsOn;
     int32_t lastToggleTime;
     int32_t hysteresisMs;
+    uPortMutexHandle_t mutex; /**< protects isOn, inUse and holdCount. */
+    bool isOn;
+    bool inUse; /**< the stream is locked. */
+    size_t holdCount; /**< the number of uAtClientActivityPinHold()s. */
 } uAtClientActivityPin_t;
 
 /** Struct defining a stack of mutexes.
@@ -441,6 +532,10 @@ typedef struct uAtClientInstance_t {
     uAtClientTag_t stopTag; /** The stop tag for the current scope. */
     uAtClientUrc_t *pUrcList; /** Linked-list anchor for URC handlers. */
     uAtClientUrc_t *pUrcRead;  /** Pointer used when reading the URC handlers. */
+    /** Hash table of the URC handlers in pUrcList, indexed by urcHash(),
+        the last entry being the list of URC handlers with prefixes shorter
+        than U_AT_CLIENT_URC_HASH_KEY_LENGTH. */
+    uAtClientUrc_t *pUrcHash[U_AT_CLIENT_URC_HASH_NUM_BUCKETS + 1];
     int32_t lastResponseStopMs; /** The time the last response ended in milliseconds. */
     int32_t lockTimeMs; /** The time when the stream was locked. */
     int32_t lastTxTimeMs; /** The time when the last transmit activity was carried out, set to -1 initially. */
@@ -466,9 +561,35 @@ typedef struct uAtClientInstance_t {
                                    as its fourth parameter. */
     uAtClientWakeUp_t *pWakeUp; /** Pointer to a wake-up handler structure. */
     uAtClientActivityPin_t *pActivityPin; /** Pointer to an activity pin structure. */
+    uAtClientUrcPriority_t urcPriority; /** The priority class of the URC handler being run. */
+    uPortTaskHandle_t urcTaskHandle; /** The task running the URC handler, NULL if there is none. */
+    bool eventDriven; /** Whether event-driven reads are on. */
+    uPortSemaphoreHandle_t rxSemaphore; /** Given when data arrives, created when event-driven reads are first switched on. */
+#ifdef U_CFG_AT_CLIENT_STATS
+    uAtClientStats_t *pStats; /** Array of U_AT_CLIENT_STATS_MAX_NUM_COMMANDS statistics entries. */
+    size_t numStats; /** The number of entries in use at pStats. */
+    uAtClientStats_t *pStatsCurrent; /** The entry for the AT command in progress, if any. */
+    int32_t statsStartTimeMs; /** The time at which the AT command in progress was started. */
+    bool timeoutAdaptive; /** Whether adaptive AT timeouts are on. */
+    bool timeoutAdapted; /** True if the AT timeout of the current lock has been adapted. */
+#endif
     struct uAtClientInstance_t *pNext;
+    struct uAtClientInstance_t *pNextHash; /** Next in the same stream hash bucket. */
 } uAtClientInstance_t;
 
+/** The table of AT client magic numbers that are processing
+ * asynchronous events, see gpAtClientAsyncTable; the entries
+ * follow the structure in the same allocation.  When the table
+ * has to grow a new one is allocated and the old one is kept,
+ * on the pRetired list, until uAtClientDeinit(), since an
+ * asynchronous event might still be reading it.
+ */
+typedef struct uAtClientAsyncTable_t {
+    size_t length; /** The number of entries at pMagicNumber. */
+    volatile int32_t *pMagicNumber; /** The entries, zero where unused. */
+    struct uAtClientAsyncTable_t *pRetired; /** Previous, smaller, table. */
+} uAtClientAsyncTable_t;
+
 #ifdef U_CFG_AT_CLIENT_DETAILED_DEBUG
 /** Structure used for detailed debugging of the AT client
  * buffering behaviour, used in particular to debug the
@@ -510,17 +631,35 @@ static uAtClientInstance_t *gpAtClientList = NULL;
  */
 static uPortMutexHandle_t gMutex = NULL;
 
-/** As well as the linked list of AT clients we keep a list of
- * the magic numbers related to each AT client as an array.  This
- * is so that we can mark an AT client as not reacting to
- * asynchronous events (by removing it from the array).
+/** Storage for the initial asynchronous-processing table, so that
+ * nothing need be allocated for up to #U_AT_CLIENT_MAX_NUM AT clients.
+ */
+static volatile int32_t gAtClientAsyncTableInitialEntries[U_AT_CLIENT_MAX_NUM] = {0};
+
+/** The initial asynchronous-processing table.
+ */
+static uAtClientAsyncTable_t gAtClientAsyncTableInitial = {U_AT_CLIENT_MAX_NUM,
+                                                           gAtClientAsyncTableInitialEntries,
+                                                           NULL
+                                                          };
+
+/** As well as the linked list of AT clients we keep a table of
+ * the magic numbers related to each AT client, indexed by the slot
+ * bits of the magic number.  This is so that we can mark an AT
+ * client as not reacting to asynchronous events (by removing it
+ * from the table).
  * Note: we can't run through the linked list for this kind of
  * thing as that would require a lock on gMutex and the asynchronous
- * event may not be able to obtain such a lock.
+ * event may not be able to obtain such a lock; the table is only
+ * changed with gMutex locked but is read without it.
+ */
+static uAtClientAsyncTable_t *gpAtClientAsyncTable = &gAtClientAsyncTableInitial;
+
+/** Hash table of the AT clients by stream, for uAtClientAdd().
  */
-static int32_t gAtClientMagicNumberProcessAsync[U_AT_CLIENT_MAX_NUM] = {0};
+static uAtClientInstance_t *gpAtClientStreamHash[U_AT_CLIENT_STREAM_HASH_TABLE_LENGTH] = {0};
 
-/** The next AT client magic number to use.
+/** The sequence number part of the next AT client magic number.
  */
 static int32_t gAtClientMagicNumberNext = U_AT_CLIENT_MAGIC_NUMBER_START;
 
@@ -540,9 +679,26 @@ static const uAtClientTagDef_t gResponseStopTag = {U_AT_CLIENT_OK,
  */
 static const uAtClientTagDef_t gNoStopTag = {"", 0};
 
-/** The event queue for callbacks.
+/** The event queues for callbacks, one for each URC priority
+ * class; only the #U_AT_CLIENT_URC_PRIORITY_NORMAL one is opened
+ * by uAtClientInit(), the others are opened when a URC handler
+ * of that priority class is first set, -1 if not open.
+ */
+static int32_t gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_MAX_NUM] = {-1, -1, -1};
+
+/** The names of the tasks of the callback event queues.
+ */
+static const char *const gpEventQueueName[U_AT_CLIENT_URC_PRIORITY_MAX_NUM] = {"atCallbacksHigh",
+                                                                               "atCallbacks",
+                                                                               "atCallbacksBulk"
+                                                                              };
+
+/** The priorities of the tasks of the callback event queues.
  */
-static int32_t gEventQueueHandle;
+static const int32_t gEventQueuePriority[U_AT_CLIENT_URC_PRIORITY_MAX_NUM] = {U_AT_CLIENT_CALLBACK_TASK_PRIORITY_HIGH,
+                                                                              U_AT_CLIENT_CALLBACK_TASK_PRIORITY,
+                                                                              U_AT_CLIENT_CALLBACK_TASK_PRIORITY_BULK
+                                                                             };
 
 /** Mutex to protect gEventQueueHandle.
  * Note: the reason for this being separate to gMutex is
@@ -730,11 +886,24 @@ static void printLogDebug(const uAtClientDetailedDebug_t *pDebug,
 }
 #endif
 
-// Find an AT client instance in the list by stream handle.
+// Return the bucket of gpAtClientStreamHash for a stream.
+static size_t streamHash(const uAtClientStreamHandle_t *pStream)
+{
+    uintptr_t value = (uintptr_t) pStream->handle.int32;
+
+    if (pStream->type == U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL) {
+        // Low bits of a pointer are likely zero
+        value = ((uintptr_t) pStream->handle.pDeviceSerial) >> 3;
+    }
+
+    return (size_t) ((value + (uintptr_t) pStream->type) % U_AT_CLIENT_STREAM_HASH_TABLE_LENGTH);
+}
+
+// Find an AT client instance by stream handle.
 // gMutex should be locked before this is called.
 static uAtClientInstance_t *pGetAtClientInstance(const uAtClientStreamHandle_t *pStream)
 {
-    uAtClientInstance_t *pClient = gpAtClientList;
+    uAtClientInstance_t *pClient = gpAtClientStreamHash[streamHash(pStream)];
 
     while ((pClient != NULL) &&
            ((pClient->stream.type != pStream->type) ||
@@ -742,67 +911,110 @@ static uAtClientInstance_t *pGetAtClientInstance(const uAtClientStreamHandle_t *
              (pClient->stream.handle.pDeviceSerial != pStream->handle.pDeviceSerial)) ||
             ((pClient->stream.type != U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL) &&
              (pClient->stream.handle.int32 != pStream->handle.int32)))) {
-        pClient = pClient->pNext;
+        pClient = pClient->pNextHash;
     }
 
     return pClient;
 }
 
-// Get the number of AT clients currently active;
+// Return a free slot in the asynchronous-processing table,
+// growing the table if there is none, else -1 if there is no
+// memory or no more slots.
 // gMutex should be locked before this is called.
-static size_t numAtClients()
+static int32_t asyncTableSlotGet()
 {
-    size_t numClients = 0;
-    uAtClientInstance_t *pClient = gpAtClientList;
+    int32_t slot = -1;
+    uAtClientAsyncTable_t *pTable = gpAtClientAsyncTable;
+    uAtClientAsyncTable_t *pNewTable;
+    size_t length;
 
-    while (pClient != NULL) {
-        pClient = pClient->pNext;
-        numClients++;
+    for (size_t x = 0; (slot < 0) && (x < pTable->length); x++) {
+        if (pTable->pMagicNumber[x] == 0) {
+            slot = (int32_t) x;
+        }
+    }
+    length = pTable->length * 2;
+    if (length > U_AT_CLIENT_MAGIC_NUMBER_SLOT_MASK + 1) {
+        length = U_AT_CLIENT_MAGIC_NUMBER_SLOT_MASK + 1;
+    }
+    if ((slot < 0) && (length > pTable->length)) {
+        // Grow the table: copy the old one into a new, larger, one
+        // and switch over to it, keeping the old one for anyone
+        // who might be reading it right now
+        pNewTable = (uAtClientAsyncTable_t *) pUPortMalloc(sizeof(uAtClientAsyncTable_t) +
+                                                           (length * sizeof(int32_t)));
+        if (pNewTable != NULL) {
+            memset(pNewTable, 0, sizeof(uAtClientAsyncTable_t) + (length * sizeof(int32_t)));
+            pNewTable->length = length;
+            pNewTable->pMagicNumber = (volatile int32_t *) (pNewTable + 1);
+            pNewTable->pRetired = pTable;
+            for (size_t x = 0; x < pTable->length; x++) {
+                pNewTable->pMagicNumber[x] = pTable->pMagicNumber[x];
+            }
+            slot = (int32_t) pTable->length;
+            uPortAtomicStorePtr((void *volatile *) &gpAtClientAsyncTable, pNewTable);
+        }
     }
 
-    return numClients;
+    return slot;
+}
+
+// Free any grown asynchronous-processing tables, going back
+// to the initial one, which is emptied.
+// gMutex should be locked before this is called.
+static void asyncTableFree()
+{
+    uAtClientAsyncTable_t *pTable = gpAtClientAsyncTable;
+    uAtClientAsyncTable_t *pRetired;
+
+    uPortAtomicStorePtr((void *volatile *) &gpAtClientAsyncTable,
+                        &gAtClientAsyncTableInitial);
+    while ((pTable != NULL) && (pTable != &gAtClientAsyncTableInitial)) {
+        pRetired = pTable->pRetired;
+        uPortFree(pTable);
+        pTable = pRetired;
+    }
+    for (size_t x = 0; x < gAtClientAsyncTableInitial.length; x++) {
+        gAtClientAsyncTableInitial.pMagicNumber[x] = 0;
+    }
 }
 
-// Add an AT client instance to the list.
+// Add an AT client instance to the list, in the given slot
+// of the asynchronous-processing table, as returned by
+// asyncTableSlotGet().
 // gMutex should be locked before this is called.
 // Note: doesn't copy it, just adds it.
-static void addAtClientInstance(uAtClientInstance_t *pClient)
+static void addAtClientInstance(uAtClientInstance_t *pClient, int32_t slot)
 {
-    bool done = false;
+    size_t bucket = streamHash(&(pClient->stream));
 
-    // Populate the magic number
-    pClient->magicNumber = gAtClientMagicNumberNext;
+    // Populate the magic number: sequence number on top,
+    // slot at the bottom
+    pClient->magicNumber = (gAtClientMagicNumberNext << U_AT_CLIENT_MAGIC_NUMBER_SLOT_BITS) | slot;
     gAtClientMagicNumberNext++;
-    if (gAtClientMagicNumberNext < U_AT_CLIENT_MAGIC_NUMBER_START) {
+    if (gAtClientMagicNumberNext >= (INT32_MAX >> U_AT_CLIENT_MAGIC_NUMBER_SLOT_BITS)) {
         gAtClientMagicNumberNext = U_AT_CLIENT_MAGIC_NUMBER_START;
     }
-    for (size_t x = 0; !done &&
-         (x < sizeof(gAtClientMagicNumberProcessAsync) / sizeof(gAtClientMagicNumberProcessAsync[0])); x++) {
-        if (gAtClientMagicNumberProcessAsync[x] == 0) {
-            gAtClientMagicNumberProcessAsync[x] = pClient->magicNumber;
-            done = true;
-        }
-    }
-    U_ASSERT(done);
+    uPortAtomicStore(&(gpAtClientAsyncTable->pMagicNumber[slot]), pClient->magicNumber);
 
-    // Add to the list
+    // Add to the list and to the hash table
     pClient->pNext = gpAtClientList;
     gpAtClientList = pClient;
+    pClient->pNextHash = gpAtClientStreamHash[bucket];
+    gpAtClientStreamHash[bucket] = pClient;
 }
 
 // Mark an AT client as not processing asynchronous data.
 // gMutex should be locked before this is called.
 static void ignoreAsync(const uAtClientInstance_t *pClient)
 {
-    bool done = false;
+    size_t slot = (size_t) (pClient->magicNumber & U_AT_CLIENT_MAGIC_NUMBER_SLOT_MASK);
 
-    for (size_t x = 0; !done &&
-         (x < sizeof(gAtClientMagicNumberProcessAsync) / sizeof(gAtClientMagicNumberProcessAsync[0])); x++) {
-        if (gAtClientMagicNumberProcessAsync[x] == pClient->magicNumber) {
-            // Remove the magic number from the list
-            gAtClientMagicNumberProcessAsync[x] = 0;
-            done = true;
-        }
+    if (slot < gpAtClientAsyncTable->length) {
+        // Remove the magic number from the table, compare-exchange
+        // in case the slot has since been given to another AT client
+        uPortAtomicCompareExchange(&(gpAtClientAsyncTable->pMagicNumber[slot]),
+                                   pClient->magicNumber, 0);
     }
 }
 
@@ -813,6 +1025,16 @@ static void removeAtClientInstance(const uAtClientInstance_t *pClient)
 {
     uAtClientInstance_t *pCurrent;
     uAtClientInstance_t *pPrev = NULL;
+    uAtClientInstance_t **ppHash;
+
+    // Remove the AT client from the hash table
+    ppHash = &(gpAtClientStreamHash[streamHash(&(pClient->stream))]);
+    while ((*ppHash != NULL) && (*ppHash != pClient)) {
+        ppHash = &((*ppHash)->pNextHash);
+    }
+    if (*ppHash != NULL) {
+        *ppHash = pClient->pNextHash;
+    }
 
     // Remove the AT client from the linked list
     pCurrent = gpAtClientList;
@@ -831,6 +1053,17 @@ static void removeAtClientInstance(const uAtClientInstance_t *pClient)
     }
 }
 
+// Free an activity pin.
+static void activityPinFree(uAtClientActivityPin_t *pActivityPin)
+{
+    if (pActivityPin != NULL) {
+        if (pActivityPin->mutex != NULL) {
+            uPortMutexDelete(pActivityPin->mutex);
+        }
+        uPortFree(pActivityPin);
+    }
+}
+
 // Remove an AT client.
 // gMutex should be locked before this is called.
 static void removeClient(uAtClientInstance_t *pClient)
@@ -882,9 +1115,19 @@ static void removeClient(uAtClientInstance_t *pClient)
         pClient->pUrcList = pUrc->pNext;
         uPortFree(pUrc);
     }
+    memset(pClient->pUrcHash, 0, sizeof(pClient->pUrcHash));
 
     // Remove any activity pin
-    uPortFree(pClient->pActivityPin);
+    activityPinFree(pClient->pActivityPin);
+
+#ifdef U_CFG_AT_CLIENT_STATS
+    uPortFree(pClient->pStats);
+#endif
+
+    // Remove any event-driven read semaphore
+    if (pClient->rxSemaphore != NULL) {
+        uPortSemaphoreDelete(pClient->rxSemaphore);
+    }
 
     // Free the receive buffer if it was allocated.
     if (pClient->pReceiveBuffer->isMalloced) {
@@ -971,12 +1214,13 @@ static int32_t urcHandlerGetNext(uAtClientInstance_t *pClient,
 static bool processAsync(int32_t magicNumber)
 {
     bool process = false;
+    size_t slot = (size_t) (magicNumber & U_AT_CLIENT_MAGIC_NUMBER_SLOT_MASK);
+    uAtClientAsyncTable_t *pTable;
 
-    for (size_t x = 0; !process &&
-         (x < sizeof(gAtClientMagicNumberProcessAsync) / sizeof(gAtClientMagicNumberProcessAsync[0])); x++) {
-        if (gAtClientMagicNumberProcessAsync[x] == magicNumber) {
-            process = true;
-        }
+    pTable = (uAtClientAsyncTable_t *) pUPortAtomicLoadPtr((void *const volatile *) &gpAtClientAsyncTable);
+    if ((slot < pTable->length) &&
+        (uPortAtomicLoad(&(pTable->pMagicNumber[slot])) == magicNumber)) {
+        process = true;
     }
 
     return process;
@@ -1101,19 +1345,31 @@ static uPortMutexHandle_t streamTryLock(const uAtClientInstance_t *pClient,
     return streamMutex;
 }
 
-// Find one character buffer inside another.
+// Find one character buffer inside another; memchr() is used
+// to hop between candidate first characters, since that is
+// usually rather better optimised than a byte-wise loop.
 static const char *pMemStr(const char *pBuffer,
                            size_t bufferLength,
                            const char *pFind,
                            size_t findLength)
 {
     const char *pPos = NULL;
-
-    if (bufferLength >= findLength) {
-        for (size_t x = 0; (pPos == NULL) &&
-             (x < (bufferLength - findLength) + 1); x++) {
-            if (memcmp(pBuffer + x, pFind, findLength) == 0) {
-                pPos = pBuffer + x;
+    const char *pCandidate = pBuffer;
+    const char *pLast;
+
+    if ((findLength > 0) && (bufferLength >= findLength)) {
+        // pLast is the last position at which a match could start
+        pLast = pBuffer + (bufferLength - findLength);
+        while ((pPos == NULL) && (pCandidate != NULL) &&
+               (pCandidate <= pLast)) {
+            pCandidate = (const char *) memchr(pCandidate, *pFind,
+                                               (pLast - pCandidate) + 1);
+            if (pCandidate != NULL) {
+                if (memcmp(pCandidate, pFind, findLength) == 0) {
+                    pPos = pCandidate;
+                } else {
+                    pCandidate++;
+                }
             }
         }
     }
@@ -1121,11 +1377,66 @@ static const char *pMemStr(const char *pBuffer,
     return pPos;
 }
 
+// Find the end of a parameter in the unread part of the receive
+// buffer, i.e. the first delimiter or the start of the stop tag,
+// whichever comes first, ignoring quoted sections.  Returns the
+// position of the terminator or NULL if there is none in the
+// buffer yet; *pIsStopTag is set to true if the terminator is
+// the stop tag.
+static const char *pFindParameterEnd(const uAtClientInstance_t *pClient,
+                                     const char *pStart, size_t length,
+                                     bool *pIsStopTag)
+{
+    const uAtClientTagDef_t *pTagDef = pClient->stopTag.pTagDef;
+    const char *pEnd = pStart + length;
+    const char *pDelimiter;
+    const char *pStopTag;
+    const char *pQuote;
+    const char *pTerminator = NULL;
+    bool keepGoing = true;
+
+    *pIsStopTag = false;
+    while (keepGoing && (pStart < pEnd)) {
+        pDelimiter = NULL;
+        if (pClient->delimiter != 0) {
+            pDelimiter = (const char *) memchr(pStart, pClient->delimiter, pEnd - pStart);
+        }
+        pStopTag = pMemStr(pStart, pEnd - pStart, pTagDef->pString, pTagDef->length);
+        pQuote = (const char *) memchr(pStart, '\"', pEnd - pStart);
+        if ((pQuote != NULL) &&
+            ((pDelimiter == NULL) || (pQuote < pDelimiter)) &&
+            ((pStopTag == NULL) || (pQuote < pStopTag))) {
+            // A quoted section begins before any terminator:
+            // skip to the closing quote and search again from there
+            pStart = (const char *) memchr(pQuote + 1, '\"', pEnd - (pQuote + 1));
+            if (pStart != NULL) {
+                pStart++;
+            } else {
+                // The closing quote has not arrived yet
+                keepGoing = false;
+            }
+        } else {
+            if ((pStopTag != NULL) &&
+                ((pDelimiter == NULL) || (pStopTag < pDelimiter))) {
+                pTerminator = pStopTag;
+                *pIsStopTag = true;
+            } else {
+                pTerminator = pDelimiter;
+            }
+            keepGoing = false;
+        }
+    }
+
+    return pTerminator;
+}
+
 // Print out AT commands and responses.
 static void printAt(uAtClientInstance_t *pClient,
                     const char *pAt, size_t length, bool sending)
 {
     char c;
+    size_t x;
+    size_t run;
     bool timestamp = true;
     char prefixBuffer[32];
 #if U_CFG_ENABLE_LOGGING
@@ -1159,15 +1470,17 @@ static void printAt(uAtClientInstance_t *pClient,
                          (int) U_AT_CLIENT_HANDLE_FOR_PRINT(pClient));
             }
         }
-        for (size_t x = 0; x < length; x++) {
+        x = 0;
+        while (x < length) {
             if (timestamp) {
                 uPortLog("%s%s", prefixBuffer,
                          pPrintTimestamp(pClient->debugOn ? " " : NULL,
                                          ": ", timestampBuffer, sizeof(timestampBuffer)));
                 timestamp = false;
             }
-            c = *pAt++;
+            c = *(pAt + x);
             if (!isprint((int32_t) c)) {
+                x++;
 #ifdef U_AT_CLIENT_PRINT_CONTROL_CHARACTERS
                 uPortLog("[%02x]", (unsigned char) c);
 #else
@@ -1182,8 +1495,16 @@ static void printAt(uAtClientInstance_t *pClient,
                 }
 #endif
             } else {
-                // Print the ASCII character
-                uPortLog("%c", c);
+                // Print the run of ASCII characters in one go, rather
+                // than a character at a time
+                run = 1;
+                while ((x + run < length) &&
+                       (run < U_AT_CLIENT_PRINT_AT_RUN_MAX_LENGTH_BYTES) &&
+                       isprint((int32_t) * (pAt + x + run))) {
+                    run++;
+                }
+                uPortLog("%.*s", (int) run, pAt + x);
+                x += run;
             }
         }
     }
@@ -1226,6 +1547,7 @@ static void consecutiveTimeout(uAtClientInstance_t *pClient)
 
     U_PORT_MUTEX_LOCK(gMutexEventQueue);
 
+    STATS_TIMEOUT(pClient);
     pClient->numConsecutiveAtTimeouts++;
     if (pClient->pConsecutiveTimeoutsCallback != NULL) {
         // pConsecutiveTimeoutsCallback second parameter
@@ -1236,12 +1558,191 @@ static void consecutiveTimeout(uAtClientInstance_t *pClient)
         cb.atHandle = (uAtClientHandle_t) pClient;
         cb.pParam = &(pClient->numConsecutiveAtTimeouts);
         cb.atClientMagicNumber = pClient->magicNumber;
-        uPortEventQueueSend(gEventQueueHandle, &cb, sizeof(cb));
+        uPortEventQueueSend(gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL],
+                            &cb, sizeof(cb));
     }
 
     U_PORT_MUTEX_UNLOCK(gMutexEventQueue);
 }
 
+#ifdef U_CFG_AT_CLIENT_STATS
+// Work out the adaptive AT timeout for a command from its latency
+// histogram, -1 if there isn't one.
+static int32_t statsTimeoutCalculate(const uAtClientStats_t *pStats)
+{
+    int32_t timeoutMs = -1;
+    uint32_t numSamples = 0;
+    uint32_t threshold;
+    uint32_t total = 0;
+    size_t bucket = 0;
+
+    if (pStats->timeoutCount == 0) {
+        for (size_t x = 0; x < U_AT_CLIENT_STATS_NUM_BUCKETS; x++) {
+            numSamples += pStats->latencyHistogram[x];
+        }
+        if (numSamples >= U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_SAMPLES) {
+            threshold = ((numSamples * U_AT_CLIENT_TIMEOUT_ADAPTIVE_PERCENTILE) + 99) / 100;
+            while ((bucket < U_AT_CLIENT_STATS_NUM_BUCKETS) &&
+                   (total + pStats->latencyHistogram[bucket] < threshold)) {
+                total += pStats->latencyHistogram[bucket];
+                bucket++;
+            }
+            // The last bucket has no top, so nothing can be said
+            if (bucket < U_AT_CLIENT_STATS_NUM_BUCKETS - 1) {
+                // The top of bucket n is 2^n ms
+                timeoutMs = (1 << bucket) * U_AT_CLIENT_TIMEOUT_ADAPTIVE_SAFETY_FACTOR;
+                if (timeoutMs < U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_MS) {
+                    timeoutMs = U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_MS;
+                }
+            }
+        }
+    }
+
+    return timeoutMs;
+}
+
+// Apply the adaptive AT timeout for a command that is being started,
+// provided that the code sending it has not set an AT timeout of its
+// own in this lock and that we're not in a wake-up handler; the
+// AT timeout is restored on unlock in the usual way.
+static void statsTimeoutAdapt(uAtClientInstance_t *pClient,
+                              const uAtClientStats_t *pStats)
+{
+    int32_t timeoutMs = statsTimeoutCalculate(pStats);
+    int32_t baseTimeoutMs = pClient->atTimeoutMs;
+
+    if (pClient->timeoutAdapted) {
+        // Adapted for an earlier command in this lock, start again
+        baseTimeoutMs = pClient->atTimeoutSavedMs;
+        pClient->atTimeoutMs = baseTimeoutMs;
+    }
+    if (((pClient->atTimeoutSavedMs < 0) || pClient->timeoutAdapted) &&
+        ((pClient->pWakeUp == NULL) || (pClient->pWakeUp->atTimeoutSavedMs < 0)) &&
+        (timeoutMs >= 0) && (baseTimeoutMs >= 0)) {
+        // The AT timeout runs from the start of the lock
+        timeoutMs += uPortGetTickTimeMs() - pClient->lockTimeMs;
+        if (timeoutMs < baseTimeoutMs) {
+            pClient->atTimeoutSavedMs = baseTimeoutMs;
+            pClient->atTimeoutMs = timeoutMs;
+            pClient->timeoutAdapted = true;
+        }
+    }
+}
+
+// Find or create the statistics entry for the given AT command
+// and mark it as being in progress.
+static void statsCommandStart(uAtClientInstance_t *pClient,
+                              const char *pCommand)
+{
+    uAtClientStats_t *pStats = NULL;
+    size_t length = 0;
+
+    pClient->pStatsCurrent = NULL;
+    if ((pClient->pStats != NULL) && (pCommand != NULL)) {
+        // The command is everything up to any "=" or "?"
+        while ((length < U_AT_CLIENT_STATS_COMMAND_MAX_LENGTH_BYTES) &&
+               (*(pCommand + length) != 0) && (*(pCommand + length) != '=') &&
+               (*(pCommand + length) != '?')) {
+            length++;
+        }
+        for (size_t x = 0; (x < pClient->numStats) && (pStats == NULL); x++) {
+            if ((strncmp(pClient->pStats[x].command, pCommand, length) == 0) &&
+                (pClient->pStats[x].command[length] == 0)) {
+                pStats = &(pClient->pStats[x]);
+            }
+        }
+        if ((pStats == NULL) && (pClient->numStats < U_AT_CLIENT_STATS_MAX_NUM_COMMANDS)) {
+            pStats = &(pClient->pStats[pClient->numStats]);
+            memcpy(pStats->command, pCommand, length);
+            pStats->command[length] = 0;
+            pClient->numStats++;
+        }
+        if (pStats != NULL) {
+            pStats->count++;
+            pClient->pStatsCurrent = pStats;
+            pClient->statsStartTimeMs = uPortGetTickTimeMs();
+            if (pClient->timeoutAdaptive) {
+                statsTimeoutAdapt(pClient, pStats);
+            }
+        }
+    }
+}
+
+// Record the latency of the AT command in progress.
+static void statsResponseStop(uAtClientInstance_t *pClient)
+{
+    uAtClientStats_t *pStats = pClient->pStatsCurrent;
+    int32_t latencyMs;
+    size_t bucket = 0;
+
+    if (pStats != NULL) {
+        latencyMs = uPortGetTickTimeMs() - pClient->statsStartTimeMs;
+        pStats->latencyTotalMs += latencyMs;
+        if (latencyMs > pStats->latencyMaxMs) {
+            pStats->latencyMaxMs = latencyMs;
+        }
+        while ((latencyMs > 0) && (bucket < U_AT_CLIENT_STATS_NUM_BUCKETS - 1)) {
+            latencyMs >>= 1;
+            bucket++;
+        }
+        pStats->latencyHistogram[bucket]++;
+        pClient->pStatsCurrent = NULL;
+    }
+}
+
+// The performance counters source for all AT clients: each
+// AT client is numbered by its position in the list.
+static void statsPerfCountersSource(uPerfCountersWriter_t *pWriter,
+                                    void *pParam)
+{
+    uAtClientInstance_t *pClient;
+    const uAtClientStats_t *pStats;
+    char name[U_AT_CLIENT_STATS_COMMAND_MAX_LENGTH_BYTES + 32];
+    int32_t prefixLength;
+    size_t index = 0;
+
+    (void) pParam;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        for (pClient = gpAtClientList; pClient != NULL; pClient = pClient->pNext) {
+
+            U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+            for (size_t x = 0; (pClient->pStats != NULL) && (x < pClient->numStats); x++) {
+                pStats = &(pClient->pStats[x]);
+                prefixLength = snprintf(name, sizeof(name), "%d.%s.", (int) index, pStats->command);
+                if ((prefixLength > 0) && (prefixLength < (int32_t) sizeof(name))) {
+                    strncpy(name + prefixLength, "count", sizeof(name) - prefixLength);
+                    uPerfCountersWriteCounter(pWriter, name, pStats->count);
+                    strncpy(name + prefixLength, "timeouts", sizeof(name) - prefixLength);
+                    uPerfCountersWriteCounter(pWriter, name, pStats->timeoutCount);
+                    strncpy(name + prefixLength, "bytesSent", sizeof(name) - prefixLength);
+                    uPerfCountersWriteCounter(pWriter, name, pStats->bytesSent);
+                    strncpy(name + prefixLength, "bytesReceived", sizeof(name) - prefixLength);
+                    uPerfCountersWriteCounter(pWriter, name, pStats->bytesReceived);
+                    strncpy(name + prefixLength, "latencyTotalMs", sizeof(name) - prefixLength);
+                    uPerfCountersWriteCounter(pWriter, name, pStats->latencyTotalMs);
+                    strncpy(name + prefixLength, "latencyMaxMs", sizeof(name) - prefixLength);
+                    uPerfCountersWriteCounter(pWriter, name, pStats->latencyMaxMs);
+                    strncpy(name + prefixLength, "latencyMs", sizeof(name) - prefixLength);
+                    uPerfCountersWriteHistogram(pWriter, name, pStats->latencyHistogram,
+                                                U_AT_CLIENT_STATS_NUM_BUCKETS);
+                }
+            }
+
+            U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+
+            index++;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+}
+#endif
+
 // Calculate the remaining time for polling based on the start
 // time and the AT timeout. Returns the time remaining for
 // polling in milliseconds.
@@ -1351,10 +1852,20 @@ static void bufferRewind(const uAtClientInstance_t *pClient)
     }
 }
 
+// Return true if waiting for data on the stream should be
+// done on rxSemaphore; never the case in the event callback
+// of the stream since that is where rxSemaphore is given.
+static bool streamEventDriven(const uAtClientInstance_t *pClient,
+                              bool eventIsCallback)
+{
+    return pClient->eventDriven && !eventIsCallback;
+}
+
 // Read from the UART/serial interface in nice coherent lines.
 static int32_t serialReadNoStutter(uAtClientInstance_t *pClient,
                                    uAtClientBlockState_t blockState,
-                                   int32_t atTimeoutMs)
+                                   int32_t atTimeoutMs,
+                                   bool eventIsCallback)
 {
     int32_t readLength = 0;
     int32_t thisReadLength;
@@ -1387,13 +1898,27 @@ static int32_t serialReadNoStutter(uAtClientInstance_t *pClient,
             if (blockState == U_AT_CLIENT_BLOCK_STATE_NOTHING_RECEIVED) {
                 // Got something: now wait for more
                 blockState = U_AT_CLIENT_BLOCK_STATE_WAIT_FOR_MORE;
-                uPortTaskBlock(U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+                if (!streamEventDriven(pClient, eventIsCallback)) {
+                    uPortTaskBlock(U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+                } else if ((readLength >= U_AT_CLIENT_CRLF_LENGTH_BYTES) &&
+                           (memcmp(pBuffer - U_AT_CLIENT_CRLF_LENGTH_BYTES, U_AT_CLIENT_CRLF,
+                                   U_AT_CLIENT_CRLF_LENGTH_BYTES) == 0)) {
+                    // If what we have ends in a complete line,
+                    // there is no need to wait for more
+                    blockState = U_AT_CLIENT_BLOCK_STATE_DO_NOT_BLOCK;
+                } else {
+                    uPortSemaphoreTryTake(pClient->rxSemaphore,
+                                          U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+                }
             }
         } else {
             if (blockState == U_AT_CLIENT_BLOCK_STATE_WAIT_FOR_MORE) {
                 // We were waiting for more but we have received nothing
                 // so stop blocking now
                 blockState = U_AT_CLIENT_BLOCK_STATE_DO_NOT_BLOCK;
+            } else if (streamEventDriven(pClient, eventIsCallback)) {
+                uPortSemaphoreTryTake(pClient->rxSemaphore,
+                                      U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
             } else {
                 uPortTaskBlock(U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
             }
@@ -1430,6 +1955,8 @@ static bool bufferFill(uAtClientInstance_t *pClient,
     char timestampBuffer[U_AT_CLIENT_PRINT_TIMESTAMP_BUFFER_SIZE_BYTES];
 #endif
 
+    U_LOG_RAM_TRACE_BEGIN(U_LOG_RAM_TRACE_ID_AT_CLIENT_BUFFER_FILL);
+
     // Determine if we're in a callback or not
     switch (pClient->stream.type) {
         case U_AT_CLIENT_STREAM_TYPE_UART:
@@ -1521,7 +2048,8 @@ static bool bufferFill(uAtClientInstance_t *pClient,
             case U_AT_CLIENT_STREAM_TYPE_UART:
             //fall-through
             case U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL:
-                readLength = serialReadNoStutter(pClient, blockState, atTimeoutMs);
+                readLength = serialReadNoStutter(pClient, blockState, atTimeoutMs,
+                                                 eventIsCallback);
                 break;
             case U_AT_CLIENT_STREAM_TYPE_EDM:
                 readLength = uShortRangeEdmStreamAtRead(pClient->stream.handle.int32,
@@ -1540,6 +2068,7 @@ static bool bufferFill(uAtClientInstance_t *pClient,
             // read in; may not be the same as the amount of data
             // available in the buffer for the AT client as
             // there may be an intercept function in the way
+            STATS_BYTES_RECEIVED(pClient, readLength);
             pReceiveBuffer->lengthBuffered += readLength;
             // length starts out as the amount of data that has not yet
             // been successfully processed by the intercept function
@@ -1671,7 +2200,12 @@ static bool bufferFill(uAtClientInstance_t *pClient,
         }
 
         LOG_BUFFER_FILL(14);
-        uPortTaskBlock(U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+        if (!streamEventDriven(pClient, eventIsCallback)) {
+            uPortTaskBlock(U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+        } else if ((readLength == 0) && blocking) {
+            uPortSemaphoreTryTake(pClient->rxSemaphore,
+                                  U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+        }
     } while ((readLength == 0) &&
              (pollTimeRemaining(atTimeoutMs, pClient->lockTimeMs) > 0));
 
@@ -1686,6 +2220,8 @@ static bool bufferFill(uAtClientInstance_t *pClient,
 
     U_ASSERT(U_AT_CLIENT_GUARD_CHECK(pReceiveBuffer));
 
+    U_LOG_RAM_TRACE_END(U_LOG_RAM_TRACE_ID_AT_CLIENT_BUFFER_FILL);
+
     return readLength > 0;
 }
 
@@ -1738,6 +2274,105 @@ static int32_t bufferReadChar(uAtClientInstance_t *pClient)
     return character;
 }
 
+// Return true if readBytesDirect() can be used: there must be no
+// stop tag to look for, no receive intercept function (which would
+// need to process the data in the receive buffer) and the stream
+// must be one we can read from directly.
+static bool readBytesDirectPossible(const uAtClientInstance_t *pClient)
+{
+    return (pClient->stopTag.pTagDef->length == 0) && !pClient->stopTag.found &&
+           (pClient->pInterceptRx == NULL) &&
+           ((pClient->stream.type == U_AT_CLIENT_STREAM_TYPE_UART) ||
+            (pClient->stream.type == U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL));
+}
+
+// Read lengthBytes into pBuffer: first whatever is already in
+// the receive buffer and then straight from the stream, without
+// staging the data in the receive buffer.  Returns the number of
+// bytes read, which will be less than lengthBytes only if an error
+// has been set.
+static size_t readBytesDirect(uAtClientInstance_t *pClient,
+                              char *pBuffer, size_t lengthBytes)
+{
+    uAtClientReceiveBuffer_t *pReceiveBuffer = pClient->pReceiveBuffer;
+    size_t lengthRead;
+    int32_t thisReadLength;
+    int32_t atTimeoutMs = pClient->atTimeoutMs;
+    bool eventIsCallback = false;
+    uDeviceSerial_t *pDeviceSerial = pClient->stream.handle.pDeviceSerial;
+
+    // Whatever is already in the receive buffer first
+    lengthRead = pReceiveBuffer->length - pReceiveBuffer->readIndex;
+    if (lengthRead > lengthBytes) {
+        lengthRead = lengthBytes;
+    }
+    memcpy(pBuffer, U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) +
+           pReceiveBuffer->readIndex, lengthRead);
+    pReceiveBuffer->readIndex += lengthRead;
+
+    if (lengthRead < lengthBytes) {
+        // The receive buffer must now be empty
+        bufferReset(pClient, false);
+        if (pClient->stream.type == U_AT_CLIENT_STREAM_TYPE_UART) {
+            eventIsCallback = uPortUartEventIsCallback(pClient->stream.handle.int32);
+        } else {
+            eventIsCallback = pDeviceSerial->eventIsCallback(pDeviceSerial);
+        }
+        if (eventIsCallback) {
+            // Short timeout if we're in a URC callback
+            atTimeoutMs = U_AT_CLIENT_URC_TIMEOUT_MS;
+        }
+        // As in bufferFill(), keep going while data is
+        // arriving, even if the AT timeout has passed
+        do {
+            if (pClient->stream.type == U_AT_CLIENT_STREAM_TYPE_UART) {
+                thisReadLength = uPortUartRead(pClient->stream.handle.int32,
+                                               pBuffer + lengthRead,
+                                               lengthBytes - lengthRead);
+            } else {
+                thisReadLength = pDeviceSerial->read(pDeviceSerial,
+                                                     pBuffer + lengthRead,
+                                                     lengthBytes - lengthRead);
+            }
+            if (thisReadLength > 0) {
+                printAt(pClient, pBuffer + lengthRead, thisReadLength, false);
+                STATS_BYTES_RECEIVED(pClient, thisReadLength);
+                lengthRead += thisReadLength;
+            } else if (streamEventDriven(pClient, eventIsCallback)) {
+                uPortSemaphoreTryTake(pClient->rxSemaphore,
+                                      U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+            } else {
+                uPortTaskBlock(U_AT_CLIENT_STREAM_READ_RETRY_DELAY_MS);
+            }
+        } while ((lengthRead < lengthBytes) &&
+                 ((thisReadLength > 0) ||
+                  (pollTimeRemaining(atTimeoutMs, pClient->lockTimeMs) > 0)));
+
+        if (lengthRead < lengthBytes) {
+            setError(pClient, U_ERROR_COMMON_DEVICE_ERROR);
+            consecutiveTimeout(pClient);
+        } else {
+            pClient->numConsecutiveAtTimeouts = 0;
+        }
+    }
+
+    return lengthRead;
+}
+
+// Return the read index of the receive buffer moved past any
+// nulls at the start, which a module can emit near power-on.
+static size_t bufferSkipNulls(const uAtClientReceiveBuffer_t *pReceiveBuffer)
+{
+    size_t readIndex = pReceiveBuffer->readIndex;
+
+    while ((readIndex < pReceiveBuffer->length) &&
+           (*(U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) + readIndex) == 0)) {
+        readIndex++;
+    }
+
+    return readIndex;
+}
+
 // Look for pString at the start of the current receive buffer
 // without bringing more data into it, and if the string
 // is there consume it.
@@ -1753,10 +2388,7 @@ static bool bufferMatch(const uAtClientInstance_t *pClient,
 
     readIndex = pReceiveBuffer->readIndex;
     if (ignoreNullsAtStart) {
-        while ((pReceiveBuffer->length - readIndex < length) &&
-               (*(U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) + readIndex) == 0)) {
-            readIndex++;
-        }
+        readIndex = bufferSkipNulls(pReceiveBuffer);
     }
 
     if ((pReceiveBuffer->length - readIndex) >= length) {
@@ -1764,7 +2396,7 @@ static bool bufferMatch(const uAtClientInstance_t *pClient,
                                pString, length) == 0)) {
             // Consume the matching part
             readIndex += length;
-            pReceiveBuffer->readIndex += readIndex;
+            pReceiveBuffer->readIndex = readIndex;
             found = true;
         }
     }
@@ -1891,6 +2523,33 @@ static void informationResponseStop(uAtClientInstance_t *pClient)
     }
 }
 
+// Return the hash bucket index of the first
+// U_AT_CLIENT_URC_HASH_KEY_LENGTH characters at pString.
+static size_t urcHash(const char *pString)
+{
+    uint32_t hash = 2166136261U; // FNV-1a
+
+    for (size_t x = 0; x < U_AT_CLIENT_URC_HASH_KEY_LENGTH; x++) {
+        hash ^= (uint8_t) *(pString + x);
+        hash *= 16777619U;
+    }
+
+    return (size_t) (hash & (U_AT_CLIENT_URC_HASH_NUM_BUCKETS - 1));
+}
+
+// Return the index into pUrcHash[] of the list that a URC
+// handler with the given prefix should be in.
+static size_t urcHashIndex(const char *pPrefix, size_t prefixLength)
+{
+    size_t index = U_AT_CLIENT_URC_HASH_NUM_BUCKETS;
+
+    if (prefixLength >= U_AT_CLIENT_URC_HASH_KEY_LENGTH) {
+        index = urcHash(pPrefix);
+    }
+
+    return index;
+}
+
 // Iterate through URCs and check if one of them matches the current
 // contents of the receive buffer. If a URC is matched, set the
 // scope to information response and, after the URC's handler has
@@ -1898,40 +2557,71 @@ static void informationResponseStop(uAtClientInstance_t *pClient)
 // up to CR/LF.
 static bool bufferMatchOneUrc(uAtClientInstance_t *pClient)
 {
+    uAtClientReceiveBuffer_t *pReceiveBuffer = pClient->pReceiveBuffer;
     size_t prefixLength = 0;
     bool found = false;
     int32_t now;
     uErrorCode_t savedError;
+    uAtClientUrcPriority_t savedUrcPriority;
+    uPortTaskHandle_t savedUrcTaskHandle;
+    uAtClientUrc_t *pList[2];
+    size_t readIndex;
 
     bufferRewind(pClient);
 
-    for (uAtClientUrc_t *pUrc = pClient->pUrcList;
-         !found && (pUrc != NULL);
-         pUrc = pUrc->pNext) {
-        prefixLength = pUrc->prefixLength;
-        if (pClient->pReceiveBuffer->length >= prefixLength) {
-            // Do the check ignoring nulls at the start in case
-            // a URC is emitted near power-on which can suffer from
-            // such nulls
-            if (bufferMatch(pClient, pUrc->pPrefix, prefixLength, true)) {
-                setScope(pClient, U_AT_CLIENT_SCOPE_INFORMATION);
-                now = uPortGetTickTimeMs();
-                // Before heading off into URCness, save
-                // the current error state and reset
-                // it so that the URC doesn't suffer the error
-                savedError = pClient->error;
-                pClient->error = U_ERROR_COMMON_SUCCESS;
-                if (processAsync(pClient->magicNumber) && pUrc->pHandler) {
-                    pUrc->pHandler(pClient, pUrc->pHandlerParam);
+    // Only the bucket that the start of the buffer hashes to
+    // can contain a match, plus the list of short URC prefixes;
+    // the start is after any nulls, since that is where
+    // bufferMatch() will look for the URC prefix
+    pList[0] = NULL;
+    readIndex = bufferSkipNulls(pReceiveBuffer);
+    if (pReceiveBuffer->length - readIndex >= U_AT_CLIENT_URC_HASH_KEY_LENGTH) {
+        pList[0] = pClient->pUrcHash[urcHash(U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) +
+                                             readIndex)];
+    }
+    pList[1] = pClient->pUrcHash[U_AT_CLIENT_URC_HASH_NUM_BUCKETS];
+
+    for (size_t x = 0; !found && (x < sizeof(pList) / sizeof(pList[0])); x++) {
+        for (uAtClientUrc_t *pUrc = pList[x];
+             !found && (pUrc != NULL);
+             pUrc = pUrc->pNextInBucket) {
+            prefixLength = pUrc->prefixLength;
+            if (pReceiveBuffer->length >= prefixLength) {
+                // Do the check ignoring nulls at the start in case
+                // a URC is emitted near power-on which can suffer from
+                // such nulls
+                if (bufferMatch(pClient, pUrc->pPrefix, prefixLength, true)) {
+                    setScope(pClient, U_AT_CLIENT_SCOPE_INFORMATION);
+                    now = uPortGetTickTimeMs();
+                    // Before heading off into URCness, save
+                    // the current error state and reset
+                    // it so that the URC doesn't suffer the error
+                    savedError = pClient->error;
+                    pClient->error = U_ERROR_COMMON_SUCCESS;
+                    if (processAsync(pClient->magicNumber) && pUrc->pHandler) {
+                        pUrc->hitCount++;
+                        // Note the priority class of the URC handler, and the
+                        // task it is running in, so that uAtClientCallback()
+                        // can pick the right queue; save what was there
+                        // in case this is a URC handled "in-line"
+                        savedUrcPriority = pClient->urcPriority;
+                        savedUrcTaskHandle = pClient->urcTaskHandle;
+                        pClient->urcPriority = pUrc->priority;
+                        if (uPortTaskGetHandle(&(pClient->urcTaskHandle)) != 0) {
+                            pClient->urcTaskHandle = NULL;
+                        }
+                        pUrc->pHandler(pClient, pUrc->pHandlerParam);
+                        pClient->urcPriority = savedUrcPriority;
+                        pClient->urcTaskHandle = savedUrcTaskHandle;
+                    }
+                    informationResponseStop(pClient);
+                    // Put the error state back again
+                    pClient->error = savedError;
+                    // Add the amount of time spent in the URC
+                    // world to the start time
+                    pClient->lockTimeMs += uPortGetTickTimeMs() - now;
+                    found = true;
                 }
-                informationResponseStop(pClient);
-                // Put the error state back again
-                pClient->error = savedError;
-                // Put the error state back again
-                // Add the amount of time spent in the URC
-                // world to the start time
-                pClient->lockTimeMs += uPortGetTickTimeMs() - now;
-                found = true;
             }
         }
     }
@@ -2046,18 +2736,150 @@ static int32_t readString(uAtClientInstance_t *pClient,
     return lengthRead;
 }
 
+// Find the next parameter in the receive buffer, filling it
+// if necessary, and consume it, returning a pointer to it at
+// ppParameter and its length; the pointer is only valid until
+// the receive buffer is next touched.  Returns
+// U_ERROR_COMMON_NO_MEMORY, having consumed nothing, if the
+// parameter will not fit in the receive buffer.
+// The mutex should be locked before this is called.
+static int32_t parameterView(uAtClientInstance_t *pClient,
+                             const char **ppParameter)
+{
+    uAtClientReceiveBuffer_t *pReceiveBuffer = pClient->pReceiveBuffer;
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+    const char *pStart;
+    const char *pTerminator = NULL;
+    size_t length;
+    bool isStopTag = false;
+    bool keepGoing = true;
+
+    if ((pClient->error == U_ERROR_COMMON_SUCCESS) &&
+        !pClient->stopTag.found) {
+        while (keepGoing) {
+            pStart = U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) + pReceiveBuffer->readIndex;
+            length = pReceiveBuffer->length - pReceiveBuffer->readIndex;
+            pTerminator = pFindParameterEnd(pClient, pStart, length, &isStopTag);
+            if ((pTerminator == NULL) && (pClient->stopTag.pTagDef->length == 0) &&
+                (pClient->delimiter == 0) && (length > 0)) {
+                // No stop tag and no delimiter: everything we
+                // have is the parameter
+                pTerminator = pStart + length;
+            }
+            if (pTerminator != NULL) {
+                keepGoing = false;
+                errorCodeOrLength = (int32_t) (pTerminator - pStart);
+                // Remove surrounding quotes, if there are any
+                if ((errorCodeOrLength >= 2) && (*pStart == '\"') &&
+                    (*(pTerminator - 1) == '\"')) {
+                    pStart++;
+                    errorCodeOrLength -= 2;
+                }
+                if (ppParameter != NULL) {
+                    *ppParameter = pStart;
+                }
+                // Consume the parameter and its terminator
+                pReceiveBuffer->readIndex += pTerminator -
+                                             (U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) +
+                                              pReceiveBuffer->readIndex);
+                if (isStopTag) {
+                    pReceiveBuffer->readIndex += pClient->stopTag.pTagDef->length;
+                    pClient->stopTag.found = true;
+                } else if (pReceiveBuffer->readIndex < pReceiveBuffer->length) {
+                    pReceiveBuffer->readIndex++;
+                }
+            } else {
+                // Need more data: move what we have down in the
+                // buffer to make room, making sure that there
+                // _is_ room, since bufferFill() would otherwise
+                // discard the lot
+                bufferRewind(pClient);
+                if (pReceiveBuffer->lengthBuffered >= pReceiveBuffer->dataBufferSize) {
+                    // The parameter won't fit: leave it for the
+                    // caller to read by other means
+                    errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    keepGoing = false;
+                } else if (bufferFill(pClient, true)) {
+                    pClient->numConsecutiveAtTimeouts = 0;
+                } else {
+                    setError(pClient, U_ERROR_COMMON_DEVICE_ERROR);
+                    consecutiveTimeout(pClient);
+                    keepGoing = false;
+                }
+            }
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// Convert the decimal digits at the start of a buffer of the
+// given length, which need not be null-terminated, into a
+// uint64_t; conversion stops when a non-numeric character is
+// reached.  A sign, if present, is written to pNegative, which
+// may be NULL if a sign is not expected, in which case none
+// is accepted.  Returns the number of digits converted.
+static size_t stringToUint64(const char *pBuffer, size_t length,
+                             uint64_t *pUint64, bool *pNegative)
+{
+    const char *pEnd = pBuffer + length;
+    const char *pStart;
+    uint64_t uint64 = 0;
+    uint32_t digit;
+
+    // Like strtol(), skip leading white space
+    while ((pBuffer < pEnd) && (*pBuffer == ' ')) {
+        pBuffer++;
+    }
+    if (pNegative != NULL) {
+        *pNegative = false;
+        if ((pBuffer < pEnd) && ((*pBuffer == '-') || (*pBuffer == '+'))) {
+            *pNegative = (*pBuffer == '-');
+            pBuffer++;
+        }
+    }
+    pStart = pBuffer;
+    // An unsigned subtraction makes this a single comparison
+    while ((pBuffer < pEnd) &&
+           ((digit = (uint32_t) (uint8_t) *pBuffer - '0') <= 9)) {
+        uint64 = (uint64 * 10) + digit;
+        pBuffer++;
+    }
+    *pUint64 = uint64;
+
+    return pBuffer - pStart;
+}
+
 // Read an integer.
 // The mutex should be locked before this is called.
 static int32_t readInt(uAtClientInstance_t *pClient)
 {
     char buffer[32]; // Enough for an integer
+    const char *pParameter = NULL;
     int32_t integerRead = -1;
+    int32_t length;
+    uint64_t uint64;
+    bool negative = false;
 
     if ((pClient->error == U_ERROR_COMMON_SUCCESS) &&
-        !pClient->stopTag.found &&
-        (readString(pClient, buffer,
-                    sizeof(buffer), false) > 0)) {
-        integerRead = strtol(buffer, NULL, 10);
+        !pClient->stopTag.found) {
+        // Convert the digits directly out of the receive buffer
+        length = parameterView(pClient, &pParameter);
+        if (length == (int32_t) U_ERROR_COMMON_NO_MEMORY) {
+            // Too long for the receive buffer (!), do it the slow way
+            pParameter = buffer;
+            length = readString(pClient, buffer, sizeof(buffer), false);
+        }
+        if ((length > 0) &&
+            (stringToUint64(pParameter, length, &uint64, &negative) > 0)) {
+            integerRead = (int32_t) uint64;
+            if (negative) {
+                integerRead = -integerRead;
+            }
+        } else if (length > 0) {
+            // Not a number, which strtol() would have returned as zero
+            integerRead = 0;
+        }
     }
 
     return integerRead;
@@ -2141,6 +2963,8 @@ static bool processResponse(uAtClientInstance_t *pClient,
     bool prefixMatched = false;
     const char *pTmp;
 
+    U_LOG_RAM_TRACE_BEGIN(U_LOG_RAM_TRACE_ID_AT_CLIENT_PROCESS_RESPONSE);
+
     while ((pClient->error == U_ERROR_COMMON_SUCCESS) &&
            (!pClient->stopTag.found) &&
            !processingDone) {
@@ -2204,6 +3028,8 @@ static bool processResponse(uAtClientInstance_t *pClient,
         }
     }
 
+    U_LOG_RAM_TRACE_END(U_LOG_RAM_TRACE_ID_AT_CLIENT_PROCESS_RESPONSE);
+
     return prefixMatched;
 }
 
@@ -2382,6 +3208,7 @@ static size_t write(uAtClientInstance_t *pClient,
     // if *everything* was written
     if (pClient->error == U_ERROR_COMMON_SUCCESS) {
         printAt(pClient, pDataStart, length, true);
+        STATS_BYTES_SENT(pClient, length);
     } else {
         length = 0;
     }
@@ -2414,25 +3241,117 @@ static bool writeCheckAndDelimit(uAtClientInstance_t *pClient)
     return isOk;
 }
 
+// Append data to the buffer used by uAtClientWriteParams(), writing
+// the buffer to the stream first if there is not enough room; data
+// that is larger than the whole buffer is written directly.
+static void writeParamsAppend(uAtClientInstance_t *pClient,
+                              char *pBuffer, size_t *pLength,
+                              const char *pData, size_t length)
+{
+    if (*pLength + length > U_AT_CLIENT_WRITE_PARAMS_BUFFER_LENGTH_BYTES) {
+        if (*pLength > 0) {
+            write(pClient, pBuffer, *pLength, false);
+            *pLength = 0;
+        }
+        if (length > U_AT_CLIENT_WRITE_PARAMS_BUFFER_LENGTH_BYTES) {
+            write(pClient, pData, length, false);
+            length = 0;
+        }
+    }
+    if (length > 0) {
+        memcpy(pBuffer + *pLength, pData, length);
+        *pLength += length;
+    }
+}
+
 // Check if a URC handler is already in the list.
-static bool findUrcHandler(const uAtClientInstance_t *pClient,
-                           const char *pPrefix)
+static uAtClientUrc_t *pFindUrcHandler(const uAtClientInstance_t *pClient,
+                                       const char *pPrefix)
 {
-    uAtClientUrc_t *pUrc = pClient->pUrcList;
-    bool found = false;
+    uAtClientUrc_t *pUrc;
+    uAtClientUrc_t *pFound = NULL;
 
-    while ((pUrc != NULL) && !found) {
+    pUrc = pClient->pUrcHash[urcHashIndex(pPrefix, strlen(pPrefix))];
+    while ((pUrc != NULL) && (pFound == NULL)) {
         if (strcmp(pPrefix, pUrc->pPrefix) == 0) {
-            found = true;
+            pFound = pUrc;
         }
-        pUrc = pUrc->pNext;
+        pUrc = pUrc->pNextInBucket;
     }
 
-    return found;
+    return pFound;
 }
 
-// Try to lock the stream: this does NOT clear errors.
-// Returns the stream mutex that was locked or NULL.
+// Switch an activity pin on, if it is not already on, either
+// because the stream has been locked (inUseNotHold true) or for
+// uAtClientActivityPinHold().  In the first case this waits
+// until the far end is ready, which is readyMs after the pin
+// was switched on: if the pin was switched on in advance,
+// i.e. held, some or all of that time will already have passed.
+static void activityPinOn(uAtClientActivityPin_t *pActivityPin,
+                          bool inUseNotHold)
+{
+    int32_t waitMs = 0;
+
+    U_PORT_MUTEX_LOCK(pActivityPin->mutex);
+
+    if (!pActivityPin->isOn) {
+        while (uPortGetTickTimeMs() - pActivityPin->lastToggleTime <
+               pActivityPin->hysteresisMs) {
+            uPortTaskBlock(U_AT_CLIENT_ACTIVITY_PIN_HYSTERESIS_INTERVAL_MS);
+        }
+        if (uPortGpioSet(pActivityPin->pin,
+                         (int32_t) pActivityPin->highIsOn) == 0) {
+            pActivityPin->isOn = true;
+            pActivityPin->lastToggleTime = uPortGetTickTimeMs();
+        }
+    }
+    if (pActivityPin->isOn) {
+        waitMs = pActivityPin->readyMs -
+                 (uPortGetTickTimeMs() - pActivityPin->lastToggleTime);
+    }
+    if (inUseNotHold) {
+        pActivityPin->inUse = true;
+    } else {
+        pActivityPin->holdCount++;
+    }
+
+    U_PORT_MUTEX_UNLOCK(pActivityPin->mutex);
+
+    if (inUseNotHold && (waitMs > 0)) {
+        uPortTaskBlock(waitMs);
+    }
+}
+
+// Switch an activity pin off, unless it is still in use or held.
+static void activityPinOff(uAtClientActivityPin_t *pActivityPin,
+                           bool inUseNotHold)
+{
+    U_PORT_MUTEX_LOCK(pActivityPin->mutex);
+
+    if (inUseNotHold) {
+        pActivityPin->inUse = false;
+    } else if (pActivityPin->holdCount > 0) {
+        pActivityPin->holdCount--;
+    }
+    if (pActivityPin->isOn && !pActivityPin->inUse &&
+        (pActivityPin->holdCount == 0)) {
+        while (uPortGetTickTimeMs() - pActivityPin->lastToggleTime <
+               pActivityPin->hysteresisMs) {
+            uPortTaskBlock(U_AT_CLIENT_ACTIVITY_PIN_HYSTERESIS_INTERVAL_MS);
+        }
+        if (uPortGpioSet(pActivityPin->pin,
+                         (int32_t) !pActivityPin->highIsOn) == 0) {
+            pActivityPin->isOn = false;
+            pActivityPin->lastToggleTime = uPortGetTickTimeMs();
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(pActivityPin->mutex);
+}
+
+// Try to lock the stream: this does NOT clear errors.
+// Returns the stream mutex that was locked or NULL.
 static uPortMutexHandle_t tryLock(uAtClientInstance_t *pClient)
 {
     uPortMutexHandle_t streamMutex;
@@ -2442,15 +3361,7 @@ static uPortMutexHandle_t tryLock(uAtClientInstance_t *pClient)
         pClient->lockTimeMs = uPortGetTickTimeMs();
         if (pClient->pActivityPin != NULL) {
             // If an activity pin is set then switch it on
-            while (uPortGetTickTimeMs() - pClient->pActivityPin->lastToggleTime <
-                   pClient->pActivityPin->hysteresisMs) {
-                uPortTaskBlock(U_AT_CLIENT_ACTIVITY_PIN_HYSTERESIS_INTERVAL_MS);
-            }
-            if (uPortGpioSet(pClient->pActivityPin->pin,
-                             (int32_t) pClient->pActivityPin->highIsOn) == 0) {
-                pClient->pActivityPin->lastToggleTime = uPortGetTickTimeMs();
-                uPortTaskBlock(pClient->pActivityPin->readyMs);
-            }
+            activityPinOn(pClient->pActivityPin, true);
         }
     }
 
@@ -2482,17 +3393,14 @@ static void unlockNoDataCheck(uAtClientInstance_t *pClient,
             pClient->atTimeoutMs = pClient->atTimeoutSavedMs;
             pClient->atTimeoutSavedMs = -1;
         }
+#ifdef U_CFG_AT_CLIENT_STATS
+        pClient->timeoutAdapted = false;
+#endif
 
         if (pClient->pActivityPin != NULL) {
-            // If an activity pin is set then switch it off
-            while (uPortGetTickTimeMs() - pClient->pActivityPin->lastToggleTime <
-                   pClient->pActivityPin->hysteresisMs) {
-                uPortTaskBlock(U_AT_CLIENT_ACTIVITY_PIN_HYSTERESIS_INTERVAL_MS);
-            }
-            if (uPortGpioSet(pClient->pActivityPin->pin,
-                             (int32_t) !pClient->pActivityPin->highIsOn) == 0) {
-                pClient->pActivityPin->lastToggleTime = uPortGetTickTimeMs();
-            }
+            // If an activity pin is set then switch it off,
+            // unless it is being held
+            activityPinOff(pClient->pActivityPin, true);
         }
     }
 
@@ -2500,22 +3408,6 @@ static void unlockNoDataCheck(uAtClientInstance_t *pClient,
     uPortMutexUnlock(streamMutex);
 }
 
-// Convert a string which should contain
-// something like "7587387289371387" (and
-// be null-terminated) into a uint64_t
-// Any leading crap is ignored and conversion
-// stops when a non-numeric character is reached.
-static uint64_t stringToUint64(const char *pBuffer)
-{
-    uint64_t uint64 = 0;
-
-    while (*pBuffer >= '0' && *pBuffer <= '9') {
-        uint64 = (uint64 * 10) + (*pBuffer++ - '0');
-    }
-
-    return uint64;
-}
-
 // Convert a uint64_t into a string,
 // returning the length of string that
 // would be required even if bufLen were
@@ -2613,6 +3505,11 @@ static void urcCallback(const uAtClientStreamHandle_t *pStream,
          ((pStream->type != U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL) &&
           (pStream->handle.int32 == pClient->stream.handle.int32)))) {
         if (uPortMutexTryLock(pClient->urcPermittedMutex, 0) == 0) {
+            if (pClient->eventDriven &&
+                (eventBitmask & U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED)) {
+                // Release anyone blocked waiting for data
+                uPortSemaphoreGive(pClient->rxSemaphore);
+            }
             if (pClient->pUrcHijackInt32 != NULL) {
                 // We've been hijacked, deprecated style, do that thing
                 pClient->pUrcHijackInt32(pStream->handle.int32, eventBitmask,
@@ -2690,7 +3587,7 @@ static void urcCallback(const uAtClientStreamHandle_t *pStream,
                         // sure that's safe
                         unlockNoDataCheck(pClient, streamMutex);
 
-                        x = uPortEventQueueGetFree(gEventQueueHandle);
+                        x = uPortEventQueueGetFree(gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL]);
                         if ((x >= 0) && (x < U_AT_CLIENT_CALLBACK_QUEUE_FREE_THRESHOLD)) {
                             // If the AT client callback queue is getting full, give the
                             // task at the end of it time to execute or we may fill up
@@ -2768,6 +3665,7 @@ static uAtClientHandle_t clientAdd(const uAtClientStreamHandle_t *pStream,
     bool receiveBufferIsMalloced = false;
     uDeviceSerial_t *pDeviceSerial;
     int32_t errorCode = -1;
+    int32_t slot;
 
     U_PORT_MUTEX_LOCK(gMutex);
 
@@ -2776,11 +3674,13 @@ static uAtClientHandle_t clientAdd(const uAtClientStreamHandle_t *pStream,
         (pStream->type < U_AT_CLIENT_STREAM_TYPE_MAX)) {
         // See if there's already an AT client for this stream and
         // also check that we have room for another entry in the
-        // magic number array
+        // magic number table
         pClient = pGetAtClientInstance(pStream);
-        if ((pClient == NULL) &&
-            (numAtClients() < sizeof(gAtClientMagicNumberProcessAsync) /
-             sizeof(gAtClientMagicNumberProcessAsync[0]))) {
+        slot = -1;
+        if (pClient == NULL) {
+            slot = asyncTableSlotGet();
+        }
+        if ((pClient == NULL) && (slot >= 0)) {
             // Nope, create one
             pClient = (uAtClientInstance_t *)pUPortMalloc(sizeof(uAtClientInstance_t));
             if (pClient != NULL) {
@@ -2812,6 +3712,15 @@ static uAtClientHandle_t clientAdd(const uAtClientStreamHandle_t *pStream,
                         pClient->lastTxTimeMs = -1;
                         pClient->urcMaxStringLength = U_AT_CLIENT_INITIAL_URC_LENGTH;
                         pClient->maxRespLength = U_AT_CLIENT_MAX_LENGTH_INFORMATION_RESPONSE_PREFIX;
+#ifdef U_CFG_AT_CLIENT_STATS
+                        // If this fails statistics are simply not collected
+                        pClient->pStats = (uAtClientStats_t *) pUPortMalloc(sizeof(uAtClientStats_t) *
+                                                                            U_AT_CLIENT_STATS_MAX_NUM_COMMANDS);
+                        if (pClient->pStats != NULL) {
+                            memset(pClient->pStats, 0, sizeof(uAtClientStats_t) *
+                                   U_AT_CLIENT_STATS_MAX_NUM_COMMANDS);
+                        }
+#endif
                         // Set up the buffer and its protection markers
                         pClient->pReceiveBuffer->dataBufferSize = receiveBufferSize -
                                                                   U_AT_CLIENT_BUFFER_OVERHEAD_BYTES;
@@ -2849,7 +3758,7 @@ static uAtClientHandle_t clientAdd(const uAtClientStreamHandle_t *pStream,
                         }
                         if (errorCode == 0) {
                             // Add the instance to the list
-                            addAtClientInstance(pClient);
+                            addAtClientInstance(pClient, slot);
                         }
                     }
                 }
@@ -2920,13 +3829,13 @@ int32_t uAtClientInit()
     if (gMutex == NULL) {
         // Create an event queue for callbacks
         errorCodeOrHandle = uPortEventQueueOpen(eventQueueCallback,
-                                                "atCallbacks",
+                                                gpEventQueueName[U_AT_CLIENT_URC_PRIORITY_NORMAL],
                                                 sizeof(uAtClientCallback_t),
                                                 U_AT_CLIENT_CALLBACK_TASK_STACK_SIZE_BYTES,
-                                                U_AT_CLIENT_CALLBACK_TASK_PRIORITY,
+                                                gEventQueuePriority[U_AT_CLIENT_URC_PRIORITY_NORMAL],
                                                 U_AT_CLIENT_CALLBACK_QUEUE_LENGTH);
         if (errorCodeOrHandle >= 0) {
-            gEventQueueHandle = errorCodeOrHandle;
+            gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL] = errorCodeOrHandle;
             // Create the mutex that protects gEventQueueHandle
             errorCodeOrHandle = uPortMutexCreate(&gMutexEventQueue);
             if (errorCodeOrHandle == 0) {
@@ -2939,16 +3848,23 @@ int32_t uAtClientInit()
                         gPrintTimestampOriginSeconds = 0;
                         gPrintTimestampOriginTickTimeMs = uPortGetTickTimeMs();
                     }
+#endif
+#ifdef U_CFG_AT_CLIENT_STATS
+                    // Make the statistics available as performance
+                    // counters; not fatal if there is no room
+                    uPerfCountersRegister("atClient", statsPerfCountersSource, NULL);
 #endif
                 } else {
                     // Failed, release the callbacks event queue again
                     // and its mutex
-                    uPortEventQueueClose(gEventQueueHandle);
+                    uPortEventQueueClose(gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL]);
+                    gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL] = -1;
                     uPortMutexDelete(gMutexEventQueue);
                 }
             } else {
                 // Failed, release the callbacks event queue again
-                uPortEventQueueClose(gEventQueueHandle);
+                uPortEventQueueClose(gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL]);
+                gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL] = -1;
             }
         }
     }
@@ -2961,16 +3877,28 @@ void uAtClientDeinit()
 {
     if (gMutex != NULL) {
 
+#ifdef U_CFG_AT_CLIENT_STATS
+        // Do this first, with no locks held, since the
+        // source takes gMutex
+        uPerfCountersDeregister(statsPerfCountersSource, NULL);
+#endif
+
         U_PORT_MUTEX_LOCK(gMutex);
 
         // Remove all the AT handlers
         while (gpAtClientList != NULL) {
             removeClient(gpAtClientList);
         }
+        asyncTableFree();
 
         U_PORT_MUTEX_LOCK(gMutexEventQueue);
-        // Release the callbacks event queue
-        uPortEventQueueClose(gEventQueueHandle);
+        // Release the callbacks event queues
+        for (size_t x = 0; x < sizeof(gEventQueueHandle) / sizeof(gEventQueueHandle[0]); x++) {
+            if (gEventQueueHandle[x] >= 0) {
+                uPortEventQueueClose(gEventQueueHandle[x]);
+                gEventQueueHandle[x] = -1;
+            }
+        }
 
         // Delete the mutexes
         U_PORT_MUTEX_UNLOCK(gMutexEventQueue);
@@ -3130,6 +4058,10 @@ void uAtClientTimeoutSet(uAtClientHandle_t atHandle, int32_t timeoutMs)
             if (pClient->atTimeoutSavedMs < 0) {
                 pClient->atTimeoutSavedMs = pClient->atTimeoutMs;
             }
+#ifdef U_CFG_AT_CLIENT_STATS
+            // The caller knows best
+            pClient->timeoutAdapted = false;
+#endif
         }
         pClient->atTimeoutMs = timeoutMs;
     }
@@ -3158,6 +4090,48 @@ void uAtClientTimeoutCallbackGet(uAtClientHandle_t atHandle,
     }
 }
 
+// Switch adaptive AT timeouts on or off.
+int32_t uAtClientTimeoutAdaptiveSet(uAtClientHandle_t atHandle,
+                                    bool onNotOff)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+#ifdef U_CFG_AT_CLIENT_STATS
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+
+    errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    if (pClient != NULL) {
+
+        U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+        pClient->timeoutAdaptive = onNotOff;
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+
+        U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+    }
+#else
+    (void) atHandle;
+    (void) onNotOff;
+#endif
+
+    return errorCode;
+}
+
+// Get whether adaptive AT timeouts are on.
+//lint -e{818} suppress "could be declared as pointing to const": it is!
+bool uAtClientTimeoutAdaptiveGet(const uAtClientHandle_t atHandle)
+{
+    bool onNotOff = false;
+#ifdef U_CFG_AT_CLIENT_STATS
+    if (atHandle != NULL) {
+        onNotOff = ((uAtClientInstance_t *) atHandle)->timeoutAdaptive;
+    }
+#else
+    (void) atHandle;
+#endif
+
+    return onNotOff;
+}
+
 // Get the delimiter.
 //lint -e{818} suppress "could be declared as pointing to const": it is!
 char uAtClientDelimiterGet(const uAtClientHandle_t atHandle)
@@ -3192,6 +4166,45 @@ void uAtClientDelaySet(uAtClientHandle_t atHandle,
     }
 }
 
+// Get whether event-driven reads are on.
+bool uAtClientEventDrivenGet(const uAtClientHandle_t atHandle)
+{
+    return ((const uAtClientInstance_t *) atHandle)->eventDriven;
+}
+
+// Switch event-driven reads on or off.
+int32_t uAtClientEventDrivenSet(uAtClientHandle_t atHandle,
+                                bool onNotOff)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+
+    // IMPORTANT: this can't lock pClient->mutex as it
+    // needs to acquire urcPermittedMutex, under which
+    // a URC handler might have already locked pClient->mutex.
+    // Also, it may be called while the AT client is locked,
+    // hence the semaphore, once created, is kept until the
+    // AT client is removed rather than risk deleting it
+    // while something is waiting on it
+
+    if (pClient != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        U_PORT_MUTEX_LOCK(pClient->urcPermittedMutex);
+        if (onNotOff && (pClient->rxSemaphore == NULL)) {
+            errorCode = uPortSemaphoreCreate(&(pClient->rxSemaphore), 0, 1);
+            if (errorCode != 0) {
+                pClient->rxSemaphore = NULL;
+            }
+        }
+        if (errorCode == 0) {
+            pClient->eventDriven = onNotOff;
+        }
+        U_PORT_MUTEX_UNLOCK(pClient->urcPermittedMutex);
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: SEND AN AT COMMAND
  * -------------------------------------------------------------- */
@@ -3210,16 +4223,8 @@ void uAtClientLock(uAtClientHandle_t atHandle)
         streamMutex = streamLock(pClient);
         mutexStackPush(&(pClient->lockedStreamMutexStack), streamMutex);
         if (pClient->pActivityPin != NULL) {
-            while (uPortGetTickTimeMs() - pClient->pActivityPin->lastToggleTime <
-                   pClient->pActivityPin->hysteresisMs) {
-                uPortTaskBlock(U_AT_CLIENT_ACTIVITY_PIN_HYSTERESIS_INTERVAL_MS);
-            }
             // If an activity pin is set then switch it on
-            if (uPortGpioSet(pClient->pActivityPin->pin,
-                             (int32_t) pClient->pActivityPin->highIsOn) == 0) {
-                pClient->pActivityPin->lastToggleTime = uPortGetTickTimeMs();
-                uPortTaskBlock(pClient->pActivityPin->readyMs);
-            }
+            activityPinOn(pClient->pActivityPin, true);
         }
         clearError(pClient);
         pClient->lockTimeMs = uPortGetTickTimeMs();
@@ -3264,6 +4269,9 @@ int32_t uAtClientUnlock(uAtClientHandle_t atHandle)
 
     U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
 
+    // Anything after here is not part of an AT command
+    STATS_END(pClient);
+
     streamMutex = mutexStackPop(&(pClient->lockedStreamMutexStack));
     if (streamMutex != NULL) {
         unlockNoDataCheck(pClient, streamMutex);
@@ -3346,6 +4354,7 @@ void uAtClientCommandStart(uAtClientHandle_t atHandle,
             }
         }
 
+        STATS_COMMAND_START(pClient, pCommand);
         // Send the command, no delimiter at first
         pClient->delimiterRequired = false;
         // Note: allow pCommand to be NULL here only
@@ -3481,6 +4490,79 @@ void uAtClientWriteHexData(uAtClientHandle_t atHandle,
     }
 }
 
+// Write a number of parameters in one go.
+void uAtClientWriteParams(uAtClientHandle_t atHandle,
+                          const char *pFormat, ...)
+{
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    char buffer[U_AT_CLIENT_WRITE_PARAMS_BUFFER_LENGTH_BYTES];
+    size_t length = 0;
+    char numberString[24];
+    int32_t numberLength;
+    const char *pData;
+    size_t dataLength;
+    va_list args;
+
+    U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+    va_start(args, pFormat);
+    while ((*pFormat != 0) && (pClient->error == U_ERROR_COMMON_SUCCESS)) {
+        // Deal with the delimiter as writeCheckAndDelimit() would
+        if (pClient->delimiterRequired) {
+            writeParamsAppend(pClient, buffer, &length, &(pClient->delimiter), 1);
+        } else {
+            pClient->delimiterRequired = true;
+        }
+        switch (*pFormat) {
+            case 'i':
+                numberLength = snprintf(numberString, sizeof(numberString),
+                                        "%d", (int) va_arg(args, int32_t));
+                if ((numberLength > 0) && (numberLength < (int32_t) sizeof(numberString))) {
+                    writeParamsAppend(pClient, buffer, &length, numberString, numberLength);
+                }
+                break;
+            case 'l':
+                numberLength = uint64ToString(numberString, sizeof(numberString),
+                                              va_arg(args, uint64_t));
+                if ((numberLength > 0) && (numberLength < (int32_t) sizeof(numberString))) {
+                    writeParamsAppend(pClient, buffer, &length, numberString, numberLength);
+                }
+                break;
+            case 's':
+                // A NULL string is written as an empty one
+                pData = va_arg(args, const char *);
+                dataLength = (pData != NULL) ? strlen(pData) : 0;
+                writeParamsAppend(pClient, buffer, &length, "\"", 1);
+                writeParamsAppend(pClient, buffer, &length, pData, dataLength);
+                writeParamsAppend(pClient, buffer, &length, "\"", 1);
+                break;
+            case 'r':
+                pData = va_arg(args, const char *);
+                dataLength = (pData != NULL) ? strlen(pData) : 0;
+                writeParamsAppend(pClient, buffer, &length, pData, dataLength);
+                break;
+            case 'b':
+                pData = va_arg(args, const char *);
+                dataLength = va_arg(args, size_t);
+                writeParamsAppend(pClient, buffer, &length, pData, dataLength);
+                break;
+            default:
+                // Can't carry on: we don't know what is in the va_list
+                setError(pClient, U_ERROR_COMMON_INVALID_PARAMETER);
+                break;
+        }
+        pFormat++;
+    }
+    va_end(args);
+
+    if ((length > 0) && (pClient->error == U_ERROR_COMMON_SUCCESS)) {
+        // write() will set device error if there's a problem
+        write(pClient, buffer, length, false);
+    }
+
+    U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+}
+
 // Stop the outgoing part of an AT command sequence.
 void uAtClientCommandStop(uAtClientHandle_t atHandle)
 {
@@ -3568,20 +4650,28 @@ int32_t uAtClientReadUint64(uAtClientHandle_t atHandle,
 {
     uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
     char buffer[32]; // Enough for an integer
+    const char *pParameter = NULL;
+    int32_t length;
     int32_t returnValue = -1;
 
     U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
 
     if ((pClient->error == U_ERROR_COMMON_SUCCESS) &&
-        !pClient->stopTag.found &&
-        (readString(pClient, buffer,
-                    sizeof(buffer), false) > 0)) {
-        // Would use sscanf() here but we cannot
-        // rely on there being 64 bit sscanf() support
-        // in the underlying library, hence
-        // we do our own thing
-        *pUint64 = stringToUint64(buffer);
-        returnValue = 0;
+        !pClient->stopTag.found) {
+        // Convert the digits directly out of the receive buffer
+        length = parameterView(pClient, &pParameter);
+        if (length == (int32_t) U_ERROR_COMMON_NO_MEMORY) {
+            pParameter = buffer;
+            length = readString(pClient, buffer, sizeof(buffer), false);
+        }
+        if (length > 0) {
+            // Would use sscanf() here but we cannot
+            // rely on there being 64 bit sscanf() support
+            // in the underlying library, hence
+            // we do our own thing
+            stringToUint64(pParameter, length, pUint64, NULL);
+            returnValue = 0;
+        }
     }
 
     U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
@@ -3621,6 +4711,14 @@ int32_t uAtClientReadBytes(uAtClientHandle_t atHandle,
 
     U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
 
+    if ((pBuffer != NULL) && (pClient->error == U_ERROR_COMMON_SUCCESS) &&
+        readBytesDirectPossible(pClient)) {
+        // Nothing to look for in the data, so we can move
+        // it straight into pBuffer, avoiding a copy to the
+        // receive buffer and the byte-by-byte checking below
+        lengthRead = (int32_t) readBytesDirect(pClient, pBuffer, lengthBytes);
+    }
+
     while ((lengthRead < ((int32_t) lengthBytes + matchPos)) &&
            (pClient->error == U_ERROR_COMMON_SUCCESS) &&
            !pStopTag->found) {
@@ -3702,28 +4800,119 @@ int32_t uAtClientReadBytes(uAtClientHandle_t atHandle,
     return lengthRead;
 }
 
+// Read bytes, passing them to a callback straight out of the
+// receive buffer.
+int32_t uAtClientReadBytesStream(uAtClientHandle_t atHandle,
+                                 size_t lengthBytes,
+                                 bool (*pCallback) (uAtClientHandle_t atHandle,
+                                                    const char *pData,
+                                                    size_t size,
+                                                    size_t offset,
+                                                    void *pCallbackParam),
+                                 void *pCallbackParam)
+{
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    uAtClientReceiveBuffer_t *pReceiveBuffer = pClient->pReceiveBuffer;
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    size_t offset = 0;
+    size_t thisSize;
+    bool keepGoing = true;
+
+    U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+    if (pCallback != NULL) {
+        while ((offset < lengthBytes) &&
+               (pClient->error == U_ERROR_COMMON_SUCCESS)) {
+            if (pReceiveBuffer->readIndex >= pReceiveBuffer->length) {
+                // Everything has been read, re-use the
+                // receive buffer for the next segment
+                bufferReset(pClient, false);
+                if (bufferFill(pClient, true)) {
+                    pClient->numConsecutiveAtTimeouts = 0;
+                } else {
+                    setError(pClient, U_ERROR_COMMON_DEVICE_ERROR);
+                    consecutiveTimeout(pClient);
+                }
+            }
+            thisSize = pReceiveBuffer->length - pReceiveBuffer->readIndex;
+            if (thisSize > lengthBytes - offset) {
+                thisSize = lengthBytes - offset;
+            }
+            if ((thisSize > 0) && keepGoing) {
+                keepGoing = pCallback(atHandle,
+                                      U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) +
+                                      pReceiveBuffer->readIndex,
+                                      thisSize, offset, pCallbackParam);
+            }
+            pReceiveBuffer->readIndex += thisSize;
+            offset += thisSize;
+        }
+        errorCodeOrLength = (int32_t) pClient->error;
+        if (pClient->error == U_ERROR_COMMON_SUCCESS) {
+            errorCodeOrLength = (int32_t) offset;
+        }
+    }
+
+    U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+
+    return errorCodeOrLength;
+}
+
 int32_t uAtClientReadHexData(uAtClientHandle_t atHandle,
                              uint8_t *pData,
                              uint8_t lengthBytes)
 {
-    int32_t errorOrLength;
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    int32_t errorOrLength = -1;
+    const char *pHexStr = NULL;
     size_t strSize = lengthBytes * 2 + 1;
-    char *pHexStr = (char *)pUPortMalloc(strSize);
-    if (pHexStr) {
-        errorOrLength = uAtClientReadString(atHandle,
-                                            pHexStr,
-                                            strSize,
-                                            false);
+    char *pBuffer;
+
+    U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+    if ((pClient->error == U_ERROR_COMMON_SUCCESS) &&
+        !pClient->stopTag.found) {
+        // Decode the hex directly out of the receive buffer
+        errorOrLength = parameterView(pClient, &pHexStr);
         if (errorOrLength > 0) {
-            errorOrLength = uHexToBin(pHexStr, strlen(pHexStr), (char *)pData);
+            if ((size_t) errorOrLength > strSize - 1) {
+                errorOrLength = (int32_t) strSize - 1;
+            }
+            errorOrLength = (int32_t) uHexToBin(pHexStr, errorOrLength, (char *) pData);
+        } else if (errorOrLength == (int32_t) U_ERROR_COMMON_NO_MEMORY) {
+            // Too long for the receive buffer, copy it out instead
+            pBuffer = (char *) pUPortMalloc(strSize);
+            if (pBuffer != NULL) {
+                errorOrLength = readString(pClient, pBuffer, strSize, false);
+                if (errorOrLength > 0) {
+                    errorOrLength = (int32_t) uHexToBin(pBuffer, errorOrLength, (char *) pData);
+                }
+                uPortFree(pBuffer);
+            }
         }
-        uPortFree(pHexStr);
-    } else {
-        errorOrLength = U_ERROR_COMMON_NO_MEMORY;
     }
+
+    U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+
     return errorOrLength;
 }
 
+// Read a parameter without copying it.
+int32_t uAtClientReadParameterView(uAtClientHandle_t atHandle,
+                                   const char **ppParameter)
+{
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    int32_t errorCodeOrLength;
+
+    U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+    errorCodeOrLength = parameterView(pClient, ppParameter);
+
+    U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+
+    return errorCodeOrLength;
+}
+
 // Stop the response part of an AT sequence.
 void uAtClientResponseStop(uAtClientHandle_t atHandle)
 {
@@ -3741,6 +4930,7 @@ void uAtClientResponseStop(uAtClientHandle_t atHandle)
     }
 
     pClient->lastResponseStopMs = uPortGetTickTimeMs();
+    STATS_RESPONSE_STOP(pClient);
 
     U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
 }
@@ -3935,6 +5125,92 @@ int32_t uAtClientWaitCharacter(uAtClientHandle_t atHandle,
     return (int32_t) errorCode;
 }
 
+// Send a pipeline of AT commands and process their responses.
+int32_t uAtClientPipeline(uAtClientHandle_t atHandle,
+                          uAtClientPipelineCommand_t *pCommands,
+                          size_t numCommands, size_t maxInFlight)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    uAtClientPipelineCommand_t *pCommand;
+    size_t numSent = 0;
+    size_t numDone = 0;
+    int32_t delayMs;
+    int32_t streamError = (int32_t) U_ERROR_COMMON_SUCCESS;
+
+    // IMPORTANT: this can't lock pClient->mutex as it
+    // processes responses and hence may end up calling
+    // a URC handler which will also need the lock.
+
+    if ((pClient != NULL) && (pCommands != NULL) && (maxInFlight > 0)) {
+        if (maxInFlight > U_AT_CLIENT_PIPELINE_MAX_IN_FLIGHT) {
+            maxInFlight = U_AT_CLIENT_PIPELINE_MAX_IN_FLIGHT;
+        }
+        for (size_t x = 0; x < numCommands; x++) {
+            pCommands[x].errorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+            pCommands[x].deviceError.type = U_AT_CLIENT_DEVICE_ERROR_TYPE_NO_ERROR;
+            pCommands[x].deviceError.code = 0;
+        }
+        errorCodeOrCount = 0;
+        uAtClientLock(atHandle);
+        // With one command in flight each is only sent once the
+        // previous one has completed, as usual, so the inter-command
+        // delay that the AT server needs applies throughout; with
+        // more it can only be applied before the first command
+        delayMs = pClient->delayMs;
+        while ((numDone < numCommands) &&
+               (streamError == (int32_t) U_ERROR_COMMON_SUCCESS)) {
+            // Top up the commands in flight
+            while ((numSent < numCommands) && (numSent - numDone < maxInFlight) &&
+                   (streamError == (int32_t) U_ERROR_COMMON_SUCCESS)) {
+                uAtClientCommandStart(atHandle, pCommands[numSent].pCommand);
+                uAtClientCommandStop(atHandle);
+                if (maxInFlight > 1) {
+                    pClient->delayMs = 0;
+                }
+                streamError = uAtClientErrorGet(atHandle);
+                if (streamError == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                    numSent++;
+                }
+            }
+            if (streamError == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                // Process the response to the oldest command in flight
+                pCommand = &(pCommands[numDone]);
+                uAtClientResponseStart(atHandle, pCommand->pPrefix);
+                if (pCommand->pParser != NULL) {
+                    pCommand->pParser(atHandle, numDone, pCommand->pParserParam);
+                }
+                uAtClientResponseStop(atHandle);
+                uAtClientDeviceErrorGet(atHandle, &(pCommand->deviceError));
+                pCommand->errorCode = uAtClientErrorGet(atHandle);
+                if (pCommand->errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                    errorCodeOrCount++;
+                } else if (pCommand->deviceError.type == U_AT_CLIENT_DEVICE_ERROR_TYPE_NO_ERROR) {
+                    // Not an error response from the AT server but
+                    // a timeout or the like: we can no longer tell
+                    // which response belongs to which command
+                    streamError = pCommand->errorCode;
+                }
+                // An error response only affects the one command
+                uAtClientClearError(atHandle);
+                numDone++;
+            }
+        }
+        if (streamError != (int32_t) U_ERROR_COMMON_SUCCESS) {
+            // Anything that was sent but has not completed has
+            // failed and whatever is left in the buffer is junk
+            for (size_t x = numDone; x < numSent; x++) {
+                pCommands[x].errorCode = streamError;
+            }
+            uAtClientFlush(atHandle);
+        }
+        pClient->delayMs = delayMs;
+        uAtClientUnlock(atHandle);
+    }
+
+    return errorCodeOrCount;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: HANDLE UNSOLICITED RESPONSES
  * -------------------------------------------------------------- */
@@ -3945,21 +5221,62 @@ int32_t uAtClientSetUrcHandler(uAtClientHandle_t atHandle,
                                void (*pHandler) (uAtClientHandle_t,
                                                  void *),
                                void *pHandlerParam)
+{
+    return uAtClientSetUrcHandlerExt(atHandle, pPrefix, pHandler, pHandlerParam,
+                                     U_AT_CLIENT_URC_PRIORITY_NORMAL);
+}
+
+// Set a handler for a URC with a priority class.
+int32_t uAtClientSetUrcHandlerExt(uAtClientHandle_t atHandle,
+                                  const char *pPrefix,
+                                  void (*pHandler) (uAtClientHandle_t,
+                                                    void *),
+                                  void *pHandlerParam,
+                                  uAtClientUrcPriority_t priority)
 {
     uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
     uAtClientUrc_t *pUrc = NULL;
     uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
     size_t prefixLength;
     char *pDest;
+    size_t x;
+    int32_t eventQueueHandle = 0;
 #if U_CFG_ENABLE_LOGGING
     char timestampBuffer[U_AT_CLIENT_PRINT_TIMESTAMP_BUFFER_SIZE_BYTES];
 #endif
 
+    if ((priority >= 0) && (priority < U_AT_CLIENT_URC_PRIORITY_MAX_NUM) &&
+        (priority != U_AT_CLIENT_URC_PRIORITY_NORMAL)) {
+        // Make sure that the callback queue for this
+        // priority class exists; the mutex that protects the
+        // queues only exists once uAtClientInit() has been called
+        eventQueueHandle = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+        if (gMutexEventQueue != NULL) {
+            U_PORT_MUTEX_LOCK(gMutexEventQueue);
+            if (gEventQueueHandle[priority] < 0) {
+                eventQueueHandle = uPortEventQueueOpen(eventQueueCallback,
+                                                       gpEventQueueName[priority],
+                                                       sizeof(uAtClientCallback_t),
+                                                       U_AT_CLIENT_CALLBACK_TASK_STACK_SIZE_BYTES,
+                                                       gEventQueuePriority[priority],
+                                                       U_AT_CLIENT_CALLBACK_QUEUE_LENGTH);
+                if (eventQueueHandle >= 0) {
+                    gEventQueueHandle[priority] = eventQueueHandle;
+                }
+            }
+            eventQueueHandle = gEventQueueHandle[priority];
+            U_PORT_MUTEX_UNLOCK(gMutexEventQueue);
+        }
+    }
+
     U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
 
-    if ((pPrefix != NULL) && (pHandler != NULL)) {
+    if ((pPrefix != NULL) && (pHandler != NULL) && (priority >= 0) &&
+        (priority < U_AT_CLIENT_URC_PRIORITY_MAX_NUM)) {
         errorCode = U_ERROR_COMMON_NO_MEMORY;
-        if (!findUrcHandler(pClient, pPrefix)) {
+        if (eventQueueHandle < 0) {
+            errorCode = (uErrorCode_t) eventQueueHandle;
+        } else if (pFindUrcHandler(pClient, pPrefix) == NULL) {
             prefixLength = strlen(pPrefix);
             pUrc = (uAtClientUrc_t *) pUPortMalloc(sizeof(uAtClientUrc_t) + prefixLength + 1);
             if (pUrc != NULL) {
@@ -3980,6 +5297,8 @@ int32_t uAtClientSetUrcHandler(uAtClientHandle_t atHandle,
                 pUrc->prefixLength = prefixLength;
                 pUrc->pHandler = pHandler;
                 pUrc->pHandlerParam = pHandlerParam;
+                pUrc->hitCount = 0;
+                pUrc->priority = priority;
 
                 errorCode = U_ERROR_COMMON_SUCCESS;
             }
@@ -4006,6 +5325,9 @@ int32_t uAtClientSetUrcHandler(uAtClientHandle_t atHandle,
 
         pUrc->pNext = pClient->pUrcList;
         pClient->pUrcList = pUrc;
+        x = urcHashIndex(pUrc->pPrefix, pUrc->prefixLength);
+        pUrc->pNextInBucket = pClient->pUrcHash[x];
+        pClient->pUrcHash[x] = pUrc;
 
         U_PORT_MUTEX_UNLOCK(pClient->urcPermittedMutex);
     }
@@ -4020,6 +5342,7 @@ void uAtClientRemoveUrcHandler(uAtClientHandle_t atHandle,
     uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
     uAtClientUrc_t *pCurrent = pClient->pUrcList;
     uAtClientUrc_t *pPrev = NULL;
+    uAtClientUrc_t **ppBucket;
 
     // IMPORTANT: this can't lock pClient->mutex as it
     // needs to be able to acquire urcPermittedMutex
@@ -4037,6 +5360,15 @@ void uAtClientRemoveUrcHandler(uAtClientHandle_t atHandle,
             } else {
                 pClient->pUrcList = pCurrent->pNext;
             }
+            // Remove it from its hash bucket also
+            ppBucket = &(pClient->pUrcHash[urcHashIndex(pCurrent->pPrefix,
+                                                        pCurrent->prefixLength)]);
+            while ((*ppBucket != NULL) && (*ppBucket != pCurrent)) {
+                ppBucket = &((*ppBucket)->pNextInBucket);
+            }
+            if (*ppBucket != NULL) {
+                *ppBucket = pCurrent->pNextInBucket;
+            }
 
             U_PORT_MUTEX_UNLOCK(pClient->urcPermittedMutex);
 
@@ -4073,6 +5405,55 @@ int32_t uAtClientUrcHandlerGetNext(uAtClientHandle_t atHandle,
                              ppHandler, ppHandlerParam);
 }
 
+// Get the number of times a URC handler has been called.
+int32_t uAtClientUrcHandlerHitCountGet(uAtClientHandle_t atHandle,
+                                       const char *pPrefix)
+{
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientUrc_t *pUrc;
+
+    // IMPORTANT: this can't lock pClient->mutex, see
+    // uAtClientRemoveUrcHandler(), hence it has to lock
+    // urcPermittedMutex to be sure the list is stable
+
+    if ((pClient != NULL) && (pPrefix != NULL)) {
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+        U_PORT_MUTEX_LOCK(pClient->urcPermittedMutex);
+        pUrc = pFindUrcHandler(pClient, pPrefix);
+        if (pUrc != NULL) {
+            errorCodeOrCount = (int32_t) (pUrc->hitCount & INT32_MAX);
+        }
+        U_PORT_MUTEX_UNLOCK(pClient->urcPermittedMutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Get the priority class of a URC handler.
+int32_t uAtClientUrcHandlerPriorityGet(uAtClientHandle_t atHandle,
+                                       const char *pPrefix)
+{
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    int32_t errorCodeOrPriority = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientUrc_t *pUrc;
+
+    // IMPORTANT: this can't lock pClient->mutex, see
+    // uAtClientUrcHandlerHitCountGet()
+
+    if ((pClient != NULL) && (pPrefix != NULL)) {
+        errorCodeOrPriority = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+        U_PORT_MUTEX_LOCK(pClient->urcPermittedMutex);
+        pUrc = pFindUrcHandler(pClient, pPrefix);
+        if (pUrc != NULL) {
+            errorCodeOrPriority = (int32_t) pUrc->priority;
+        }
+        U_PORT_MUTEX_UNLOCK(pClient->urcPermittedMutex);
+    }
+
+    return errorCodeOrPriority;
+}
+
 // Hijack the URC handler, deprecated form.
 void uAtClientUrcHandlerHijack(uAtClientHandle_t atHandle,
                                void (*pHandler)(int32_t, uint32_t,
@@ -4138,8 +5519,11 @@ int32_t uAtClientCallback(uAtClientHandle_t atHandle,
                           void (*pCallback) (uAtClientHandle_t, void *),
                           void *pCallbackParam)
 {
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
     int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
     uAtClientCallback_t cb = {0}; // Keep Valgrind happy (otherwise the last four bytes will be uninitialised)
+    int32_t eventQueueHandle;
+    uPortTaskHandle_t taskHandle = NULL;
 
     U_PORT_MUTEX_LOCK(gMutexEventQueue);
 
@@ -4147,8 +5531,17 @@ int32_t uAtClientCallback(uAtClientHandle_t atHandle,
         cb.pFunction = pCallback;
         cb.atHandle = atHandle;
         cb.pParam = pCallbackParam;
-        cb.atClientMagicNumber = ((uAtClientInstance_t *) atHandle)->magicNumber;
-        errorCode = uPortEventQueueSend(gEventQueueHandle, &cb, sizeof(cb));
+        cb.atClientMagicNumber = pClient->magicNumber;
+        // If we are being called from a URC handler that has
+        // a priority class then use the queue of that class
+        eventQueueHandle = gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL];
+        if ((pClient->urcTaskHandle != NULL) &&
+            (gEventQueueHandle[pClient->urcPriority] >= 0) &&
+            (uPortTaskGetHandle(&taskHandle) == 0) &&
+            (taskHandle == pClient->urcTaskHandle)) {
+            eventQueueHandle = gEventQueueHandle[pClient->urcPriority];
+        }
+        errorCode = uPortEventQueueSend(eventQueueHandle, &cb, sizeof(cb));
     }
 
     U_PORT_MUTEX_UNLOCK(gMutexEventQueue);
@@ -4163,7 +5556,7 @@ int32_t uAtClientCallbackStackMinFree()
 
     U_PORT_MUTEX_LOCK(gMutexEventQueue);
 
-    sizeOrErrorCode = uPortEventQueueStackMinFree(gEventQueueHandle);
+    sizeOrErrorCode = uPortEventQueueStackMinFree(gEventQueueHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL]);
 
     U_PORT_MUTEX_UNLOCK(gMutexEventQueue);
 
@@ -4511,12 +5904,19 @@ int32_t uAtClientSetActivityPin(uAtClientHandle_t atHandle,
     U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
 
     if (pin < 0) {
-        uPortFree(pClient->pActivityPin);
+        activityPinFree(pClient->pActivityPin);
         pClient->pActivityPin = NULL;
         errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     } else {
         if (pClient->pActivityPin == NULL) {
             pClient->pActivityPin = (uAtClientActivityPin_t *) pUPortMalloc(sizeof(*(pClient->pActivityPin)));
+            if (pClient->pActivityPin != NULL) {
+                memset(pClient->pActivityPin, 0, sizeof(*(pClient->pActivityPin)));
+                if (uPortMutexCreate(&(pClient->pActivityPin->mutex)) != 0) {
+                    uPortFree(pClient->pActivityPin);
+                    pClient->pActivityPin = NULL;
+                }
+            }
         }
         if (pClient->pActivityPin != NULL) {
             pClient->pActivityPin->pin = pin;
@@ -4533,6 +5933,28 @@ int32_t uAtClientSetActivityPin(uAtClientHandle_t atHandle,
     return errorCode;
 }
 
+// Switch the activity pin on in advance of AT commands, or let it go.
+int32_t uAtClientActivityPinHold(uAtClientHandle_t atHandle, bool holdNotRelease)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+
+    U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+    if (pClient->pActivityPin != NULL) {
+        if (holdNotRelease) {
+            activityPinOn(pClient->pActivityPin, false);
+        } else {
+            activityPinOff(pClient->pActivityPin, false);
+        }
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+
+    return errorCode;
+}
+
 // Return the activity pin.
 //lint -esym(818, atHandle) Suppress could be declared
 // as pointing to const. it is!
@@ -4580,4 +6002,70 @@ int32_t uAtClientGetActivityPinSettings(const uAtClientHandle_t atHandle,
     return activityPin;
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: STATISTICS
+ * -------------------------------------------------------------- */
+
+// Get the per-command statistics.
+int32_t uAtClientStatsGet(uAtClientHandle_t atHandle,
+                          uAtClientStats_t *pStats, size_t numStats)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+#ifdef U_CFG_AT_CLIENT_STATS
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+
+    errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    if ((pClient != NULL) && ((pStats != NULL) || (numStats == 0))) {
+
+        U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        if (pClient->pStats != NULL) {
+            if (numStats > pClient->numStats) {
+                numStats = pClient->numStats;
+            }
+            if (numStats > 0) {
+                memcpy(pStats, pClient->pStats, numStats * sizeof(*pStats));
+            }
+            for (size_t x = 0; x < numStats; x++) {
+                pStats[x].timeoutAdaptiveMs = statsTimeoutCalculate(&(pStats[x]));
+            }
+            errorCodeOrCount = (int32_t) numStats;
+        }
+
+        U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+    }
+#else
+    (void) atHandle;
+    (void) pStats;
+    (void) numStats;
+#endif
+
+    return errorCodeOrCount;
+}
+
+// Reset the per-command statistics.
+void uAtClientStatsReset(uAtClientHandle_t atHandle)
+{
+#ifdef U_CFG_AT_CLIENT_STATS
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+
+    if (pClient != NULL) {
+
+        U_AT_CLIENT_LOCK_CLIENT_MUTEX(pClient);
+
+        if (pClient->pStats != NULL) {
+            memset(pClient->pStats, 0, sizeof(uAtClientStats_t) *
+                   U_AT_CLIENT_STATS_MAX_NUM_COMMANDS);
+        }
+        pClient->numStats = 0;
+        pClient->pStatsCurrent = NULL;
+
+        U_AT_CLIENT_UNLOCK_CLIENT_MUTEX(pClient);
+    }
+#else
+    (void) atHandle;
+#endif
+}
+
 // End of file
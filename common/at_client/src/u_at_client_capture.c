@@ -0,0 +1,868 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of capture and replay of AT client traffic.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memcpy(), memcmp()
+
+#include "u_cfg_os_platform_specific.h" // U_CFG_OS_YIELD_MS
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_event_queue.h"
+
+#include "u_interface.h"
+#include "u_device_serial.h"
+
+#include "u_at_client.h"
+#include "u_at_client_capture.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The characters at the start of the capture header.
+ */
+#define U_AT_CLIENT_CAPTURE_MAGIC "UATC"
+
+/** The length of U_AT_CLIENT_CAPTURE_MAGIC.
+ */
+#define U_AT_CLIENT_CAPTURE_MAGIC_LENGTH_BYTES 4
+
+/** The maximum amount of data in a single record, limited by
+ * the two-byte length field.
+ */
+#define U_AT_CLIENT_CAPTURE_RECORD_MAX_DATA_LENGTH_BYTES 0xFFFF
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A capture.
+ */
+typedef struct uAtClientCapture_t {
+    uAtClientHandle_t atHandle;
+    uAtClientCaptureWrite_t pWrite;
+    void *pWriteParam;
+    int32_t startTimeMs;
+    int32_t numRecords;
+    int32_t errorCode; /**< the first error returned by pWrite. */
+} uAtClientCapture_t;
+
+/** The context of a replay device.
+ */
+typedef struct {
+    uPortMutexHandle_t mutex;
+    const uint8_t *pCapture;
+    size_t size;
+    bool isOpen;
+    size_t rxOffset; /**< offset of the current receive record. */
+    size_t rxIndex;  /**< how far into rxOffset has been read. */
+    size_t txOffset; /**< offset of the current transmit record. */
+    size_t txIndex;  /**< how far into txOffset has been written. */
+    int32_t mismatchCount;
+    int32_t eventQueueHandle;
+    uint32_t eventFilter;
+    void (*pEventCallback)(struct uDeviceSerial_t *, uint32_t, void *);
+    void *pEventCallbackParam;
+} uAtClientReplayContext_t;
+
+/** The event passed through the event queue of a replay device.
+ */
+typedef struct {
+    struct uDeviceSerial_t *pDeviceSerial;
+    uint32_t eventBitMap;
+} uAtClientReplayEvent_t;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: CAPTURE
+ * -------------------------------------------------------------- */
+
+// Call the write function, remembering the first error.
+static void captureWrite(uAtClientCapture_t *pCapture,
+                         const void *pData, size_t length)
+{
+    int32_t errorCode;
+
+    if (pCapture->errorCode == 0) {
+        errorCode = pCapture->pWrite(pData, length, pCapture->pWriteParam);
+        if (errorCode < 0) {
+            pCapture->errorCode = errorCode;
+        }
+    }
+}
+
+// Write one or more records containing the given data.
+static void captureRecord(uAtClientCapture_t *pCapture, uint8_t direction,
+                          const char *pData, size_t length)
+{
+    uint8_t header[U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES];
+    uint32_t timestampMs = (uint32_t) (uPortGetTickTimeMs() - pCapture->startTimeMs);
+    size_t thisLength;
+
+    while (length > 0) {
+        thisLength = length;
+        if (thisLength > U_AT_CLIENT_CAPTURE_RECORD_MAX_DATA_LENGTH_BYTES) {
+            thisLength = U_AT_CLIENT_CAPTURE_RECORD_MAX_DATA_LENGTH_BYTES;
+        }
+        header[0] = direction;
+        header[1] = (uint8_t) timestampMs;
+        header[2] = (uint8_t) (timestampMs >> 8);
+        header[3] = (uint8_t) (timestampMs >> 16);
+        header[4] = (uint8_t) (timestampMs >> 24);
+        header[5] = (uint8_t) thisLength;
+        header[6] = (uint8_t) (thisLength >> 8);
+        captureWrite(pCapture, header, sizeof(header));
+        captureWrite(pCapture, pData, thisLength);
+        pCapture->numRecords++;
+        pData += thisLength;
+        length -= thisLength;
+    }
+}
+
+// Transmit intercept: record everything and pass it on unchanged.
+static const char *interceptTx(uAtClientHandle_t atHandle,
+                               const char **ppData, size_t *pLength,
+                               void *pContext)
+{
+    const char *pData = NULL;
+
+    (void) atHandle;
+
+    if ((ppData != NULL) && (*ppData != NULL)) {
+        pData = *ppData;
+        captureRecord((uAtClientCapture_t *) pContext,
+                      U_AT_CLIENT_CAPTURE_DIRECTION_TX, pData, *pLength);
+        *ppData += *pLength;
+    } else {
+        // Nothing is held back so there is nothing to flush
+        *pLength = 0;
+    }
+
+    return pData;
+}
+
+// Receive intercept: record everything and pass it on unchanged.
+static char *interceptRx(uAtClientHandle_t atHandle,
+                         char **ppData, size_t *pLength,
+                         void *pContext)
+{
+    char *pData = NULL;
+
+    (void) atHandle;
+
+    if ((ppData != NULL) && (*ppData != NULL) && (*pLength > 0)) {
+        pData = *ppData;
+        captureRecord((uAtClientCapture_t *) pContext,
+                      U_AT_CLIENT_CAPTURE_DIRECTION_RX, pData, *pLength);
+        *ppData += *pLength;
+    } else {
+        // Returning NULL with zero length ends the loop in the AT client
+        *pLength = 0;
+    }
+
+    return pData;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: REPLAY HELPERS
+ * -------------------------------------------------------------- */
+
+// Get the direction and data length of the record at the given
+// offset, returning false if there is no complete record there.
+static bool recordGet(const uAtClientReplayContext_t *pContext, size_t offset,
+                      uint8_t *pDirection, size_t *pLength)
+{
+    bool isValid = false;
+    const uint8_t *pRecord = pContext->pCapture + offset;
+
+    if (offset + U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES <= pContext->size) {
+        *pDirection = pRecord[0];
+        *pLength = ((size_t) pRecord[5]) | (((size_t) pRecord[6]) << 8);
+        isValid = (offset + U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES +
+                   *pLength <= pContext->size);
+    }
+
+    return isValid;
+}
+
+// Return the offset of the next record of the given direction at or
+// after offset, or the size of the capture if there isn't one.
+static size_t recordNext(const uAtClientReplayContext_t *pContext,
+                         size_t offset, uint8_t direction)
+{
+    uint8_t thisDirection = 0;
+    size_t length = 0;
+    bool isValid = recordGet(pContext, offset, &thisDirection, &length);
+
+    while (isValid && (thisDirection != direction)) {
+        offset += U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES + length;
+        isValid = recordGet(pContext, offset, &thisDirection, &length);
+    }
+    if (!isValid) {
+        // A truncated record is treated as the end of the capture
+        offset = pContext->size;
+    }
+
+    return offset;
+}
+
+// Return the number of received bytes that may currently be read:
+// everything in the receive records before the next transmit record
+// that has not yet been completely written.
+static size_t rxAvailable(const uAtClientReplayContext_t *pContext)
+{
+    size_t available = 0;
+    size_t offset = pContext->rxOffset;
+    size_t index = pContext->rxIndex;
+    uint8_t direction;
+    size_t length;
+
+    while ((offset < pContext->txOffset) &&
+           recordGet(pContext, offset, &direction, &length)) {
+        if (direction == U_AT_CLIENT_CAPTURE_DIRECTION_RX) {
+            available += length - index;
+            index = 0;
+        }
+        offset += U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES + length;
+    }
+
+    return available;
+}
+
+// Send an event, blocking if delayMs is less than zero, else trying
+// for up to delayMs; must NOT be called with the mutex locked since
+// the event handler locks it.
+static int32_t sendEvent(struct uDeviceSerial_t *pDeviceSerial,
+                         int32_t eventQueueHandle,
+                         uint32_t eventBitMap, int32_t delayMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uAtClientReplayEvent_t event;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    if (eventQueueHandle >= 0) {
+        event.pDeviceSerial = pDeviceSerial;
+        event.eventBitMap = eventBitMap;
+        if (delayMs < 0) {
+            errorCode = uPortEventQueueSend(eventQueueHandle, &event, sizeof(event));
+        } else {
+            do {
+                errorCode = uPortEventQueueSendIrq(eventQueueHandle, &event, sizeof(event));
+                if ((errorCode != 0) && (delayMs > 0)) {
+                    uPortTaskBlock(U_CFG_OS_YIELD_MS);
+                }
+            } while ((errorCode != 0) && (uPortGetTickTimeMs() - startTimeMs < delayMs));
+        }
+    }
+
+    return errorCode;
+}
+
+// Return the event queue handle if an event callback is set
+// for eventBitMap, else -1; the mutex must be locked.
+static int32_t eventQueueGet(const uAtClientReplayContext_t *pContext,
+                             uint32_t eventBitMap)
+{
+    int32_t eventQueueHandle = -1;
+
+    if ((pContext->pEventCallback != NULL) && (pContext->eventFilter & eventBitMap)) {
+        eventQueueHandle = pContext->eventQueueHandle;
+    }
+
+    return eventQueueHandle;
+}
+
+// Event handler for all replay devices.
+static void eventHandler(void *pParam, size_t paramLength)
+{
+    uAtClientReplayEvent_t *pEvent = (uAtClientReplayEvent_t *) pParam;
+    uAtClientReplayContext_t *pContext;
+    void (*pEventCallback)(struct uDeviceSerial_t *, uint32_t, void *) = NULL;
+    void *pEventCallbackParam = NULL;
+
+    (void) paramLength;
+
+    pContext = (uAtClientReplayContext_t *) pUInterfaceContext(pEvent->pDeviceSerial);
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (pContext->eventFilter & pEvent->eventBitMap) {
+            pEventCallback = pContext->pEventCallback;
+            pEventCallbackParam = pContext->pEventCallbackParam;
+        }
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        // Call the callback outside the lock since it will
+        // likely want to read from the device
+        if (pEventCallback != NULL) {
+            pEventCallback(pEvent->pDeviceSerial, pEvent->eventBitMap,
+                           pEventCallbackParam);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: REPLAY SERIAL DEVICE
+ * -------------------------------------------------------------- */
+
+// Open the replay device, starting from the beginning of the capture.
+static int32_t serialOpen(struct uDeviceSerial_t *pDeviceSerial,
+                          void *pReceiveBuffer, size_t receiveBufferSizeBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+
+    // No receive buffer is needed: the capture is the receive buffer
+    (void) pReceiveBuffer;
+    (void) receiveBufferSizeBytes;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (!pContext->isOpen) {
+            pContext->rxOffset = recordNext(pContext, U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES,
+                                            U_AT_CLIENT_CAPTURE_DIRECTION_RX);
+            pContext->rxIndex = 0;
+            pContext->txOffset = recordNext(pContext, U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES,
+                                            U_AT_CLIENT_CAPTURE_DIRECTION_TX);
+            pContext->txIndex = 0;
+            pContext->mismatchCount = 0;
+            pContext->isOpen = true;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCode;
+}
+
+// Close the replay device.
+static void serialClose(struct uDeviceSerial_t *pDeviceSerial)
+{
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        pContext->isOpen = false;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+}
+
+// Get the number of bytes that may be read.
+static int32_t serialGetReceiveSize(struct uDeviceSerial_t *pDeviceSerial)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->isOpen) {
+            errorCodeOrSize = (int32_t) rxAvailable(pContext);
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrSize;
+}
+
+// Read the received data of the capture, up to the next unwritten
+// transmit record.
+static int32_t serialRead(struct uDeviceSerial_t *pDeviceSerial,
+                          void *pBuffer, size_t sizeBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+    char *pData = (char *) pBuffer;
+    uint8_t direction;
+    size_t length;
+    size_t thisLength;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->isOpen) {
+            errorCodeOrLength = 0;
+            while ((sizeBytes > 0) && (pContext->rxOffset < pContext->txOffset) &&
+                   recordGet(pContext, pContext->rxOffset, &direction, &length)) {
+                thisLength = length - pContext->rxIndex;
+                if (thisLength > sizeBytes) {
+                    thisLength = sizeBytes;
+                }
+                memcpy(pData, pContext->pCapture + pContext->rxOffset +
+                       U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES + pContext->rxIndex,
+                       thisLength);
+                pData += thisLength;
+                sizeBytes -= thisLength;
+                errorCodeOrLength += (int32_t) thisLength;
+                pContext->rxIndex += thisLength;
+                if (pContext->rxIndex >= length) {
+                    pContext->rxOffset = recordNext(pContext, pContext->rxOffset +
+                                                    U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES +
+                                                    length,
+                                                    U_AT_CLIENT_CAPTURE_DIRECTION_RX);
+                    pContext->rxIndex = 0;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrLength;
+}
+
+// Write to the replay device: the data is compared with the
+// transmit records of the capture and, once a transmit record has
+// been completely written, the received data that follows it is
+// released.
+static int32_t serialWrite(struct uDeviceSerial_t *pDeviceSerial,
+                           const void *pBuffer, size_t sizeBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+    const char *pData = (const char *) pBuffer;
+    const uint8_t *pRecorded;
+    uint8_t direction;
+    size_t length;
+    size_t thisLength;
+    size_t before = 0;
+    int32_t eventQueueHandle = -1;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->isOpen) {
+            errorCodeOrLength = (int32_t) sizeBytes;
+            before = rxAvailable(pContext);
+            while (sizeBytes > 0) {
+                if (!recordGet(pContext, pContext->txOffset, &direction, &length)) {
+                    // Written beyond the end of the capture
+                    pContext->mismatchCount += (int32_t) sizeBytes;
+                    sizeBytes = 0;
+                } else {
+                    thisLength = length - pContext->txIndex;
+                    if (thisLength > sizeBytes) {
+                        thisLength = sizeBytes;
+                    }
+                    pRecorded = pContext->pCapture + pContext->txOffset +
+                                U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES +
+                                pContext->txIndex;
+                    for (size_t x = 0; x < thisLength; x++) {
+                        if (((uint8_t) pData[x]) != pRecorded[x]) {
+                            pContext->mismatchCount++;
+                        }
+                    }
+                    pData += thisLength;
+                    sizeBytes -= thisLength;
+                    pContext->txIndex += thisLength;
+                    if (pContext->txIndex >= length) {
+                        pContext->txOffset = recordNext(pContext, pContext->txOffset +
+                                                        U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES +
+                                                        length,
+                                                        U_AT_CLIENT_CAPTURE_DIRECTION_TX);
+                        pContext->txIndex = 0;
+                    }
+                }
+            }
+            if ((before == 0) && (rxAvailable(pContext) > 0)) {
+                eventQueueHandle = eventQueueGet(pContext,
+                                                 U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+        // Let the reader know that there is data; "try" since
+        // a full queue means that the reader has plenty to do
+        sendEvent(pDeviceSerial, eventQueueHandle,
+                  U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED, 0);
+    }
+
+    return errorCodeOrLength;
+}
+
+// Set the event callback.
+static int32_t serialEventCallbackSet(struct uDeviceSerial_t *pDeviceSerial,
+                                      uint32_t filter,
+                                      void (*pFunction)(struct uDeviceSerial_t *,
+                                                        uint32_t,
+                                                        void *),
+                                      void *pParam,
+                                      size_t stackSizeBytes,
+                                      int32_t priority)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+    int32_t eventQueueHandle = -1;
+
+    if ((pContext != NULL) && (pFunction != NULL) && (filter != 0)) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->pEventCallback == NULL) {
+            errorCode = uPortEventQueueOpen(eventHandler, "atReplay",
+                                            sizeof(uAtClientReplayEvent_t),
+                                            stackSizeBytes, priority,
+                                            U_AT_CLIENT_REPLAY_CALLBACK_QUEUE_LENGTH);
+            if (errorCode >= 0) {
+                pContext->eventQueueHandle = errorCode;
+                pContext->eventFilter = filter;
+                pContext->pEventCallback = pFunction;
+                pContext->pEventCallbackParam = pParam;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                if (pContext->isOpen && (rxAvailable(pContext) > 0)) {
+                    // There may be URCs at the start of the capture
+                    eventQueueHandle = eventQueueGet(pContext,
+                                                     U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+        sendEvent(pDeviceSerial, eventQueueHandle,
+                  U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED, 0);
+    }
+
+    return errorCode;
+}
+
+// Remove the event callback.
+static void serialEventCallbackRemove(struct uDeviceSerial_t *pDeviceSerial)
+{
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+    int32_t eventQueueHandle = -1;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->pEventCallback != NULL) {
+            eventQueueHandle = pContext->eventQueueHandle;
+            pContext->eventQueueHandle = -1;
+            pContext->pEventCallback = NULL;
+            pContext->eventFilter = 0;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+        // Close the queue outside the lock as the event
+        // handler may be waiting on it
+        if (eventQueueHandle >= 0) {
+            uPortEventQueueClose(eventQueueHandle);
+        }
+    }
+}
+
+// Get the event callback filter.
+static uint32_t serialEventCallbackFilterGet(struct uDeviceSerial_t *pDeviceSerial)
+{
+    uint32_t filter = 0;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        filter = pContext->eventFilter;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return filter;
+}
+
+// Change the event callback filter.
+static int32_t serialEventCallbackFilterSet(struct uDeviceSerial_t *pDeviceSerial,
+                                            uint32_t filter)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+
+    if ((pContext != NULL) && (filter != 0)) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->pEventCallback != NULL) {
+            pContext->eventFilter = filter;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCode;
+}
+
+// Send an event to the event callback.
+static int32_t serialEventSend(struct uDeviceSerial_t *pDeviceSerial,
+                               uint32_t eventBitMap)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+    int32_t eventQueueHandle;
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        eventQueueHandle = eventQueueGet(pContext, eventBitMap);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        errorCode = sendEvent(pDeviceSerial, eventQueueHandle, eventBitMap, -1);
+    }
+
+    return errorCode;
+}
+
+// Try to send an event to the event callback.
+static int32_t serialEventTrySend(struct uDeviceSerial_t *pDeviceSerial,
+                                  uint32_t eventBitMap, int32_t delayMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+    int32_t eventQueueHandle;
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        eventQueueHandle = eventQueueGet(pContext, eventBitMap);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        errorCode = sendEvent(pDeviceSerial, eventQueueHandle, eventBitMap, delayMs);
+    }
+
+    return errorCode;
+}
+
+// Return whether we're in the event callback or not.
+static bool serialEventIsCallback(struct uDeviceSerial_t *pDeviceSerial)
+{
+    bool isCallback = false;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (pContext->eventQueueHandle >= 0) {
+            isCallback = uPortEventQueueIsTask(pContext->eventQueueHandle);
+        }
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return isCallback;
+}
+
+// Return the minimum free stack of the event callback task.
+static int32_t serialEventStackMinFree(struct uDeviceSerial_t *pDeviceSerial)
+{
+    int32_t errorCodeOrStackMinFree = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientReplayContext_t *pContext = (uAtClientReplayContext_t *)
+                                         pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (pContext->eventQueueHandle >= 0) {
+            errorCodeOrStackMinFree = uPortEventQueueStackMinFree(pContext->eventQueueHandle);
+        }
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrStackMinFree;
+}
+
+// Populate the vector table; flow control and discard on
+// overflow are left at their defaults since they have no meaning
+// for a replay.
+static void initSerialInterface(struct uDeviceSerial_t *pDeviceSerial)
+{
+    pDeviceSerial->open = serialOpen;
+    pDeviceSerial->close = serialClose;
+    pDeviceSerial->getReceiveSize = serialGetReceiveSize;
+    pDeviceSerial->read = serialRead;
+    pDeviceSerial->write = serialWrite;
+    pDeviceSerial->eventCallbackSet = serialEventCallbackSet;
+    pDeviceSerial->eventCallbackRemove = serialEventCallbackRemove;
+    pDeviceSerial->eventCallbackFilterGet = serialEventCallbackFilterGet;
+    pDeviceSerial->eventCallbackFilterSet = serialEventCallbackFilterSet;
+    pDeviceSerial->eventSend = serialEventSend;
+    pDeviceSerial->eventTrySend = serialEventTrySend;
+    pDeviceSerial->eventIsCallback = serialEventIsCallback;
+    pDeviceSerial->eventStackMinFree = serialEventStackMinFree;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CAPTURE
+ * -------------------------------------------------------------- */
+
+// Start a capture.
+uAtClientCapture_t *pUAtClientCaptureStart(uAtClientHandle_t atHandle,
+                                           uAtClientCaptureWrite_t pWrite,
+                                           void *pWriteParam)
+{
+    uAtClientCapture_t *pCapture = NULL;
+    uint8_t header[U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES] = {0};
+
+    if ((atHandle != NULL) && (pWrite != NULL)) {
+        pCapture = (uAtClientCapture_t *) pUPortMalloc(sizeof(*pCapture));
+        if (pCapture != NULL) {
+            memset(pCapture, 0, sizeof(*pCapture));
+            pCapture->atHandle = atHandle;
+            pCapture->pWrite = pWrite;
+            pCapture->pWriteParam = pWriteParam;
+            pCapture->startTimeMs = uPortGetTickTimeMs();
+            memcpy(header, U_AT_CLIENT_CAPTURE_MAGIC, U_AT_CLIENT_CAPTURE_MAGIC_LENGTH_BYTES);
+            header[U_AT_CLIENT_CAPTURE_MAGIC_LENGTH_BYTES] = U_AT_CLIENT_CAPTURE_VERSION;
+            captureWrite(pCapture, header, sizeof(header));
+            if (pCapture->errorCode == 0) {
+                uAtClientLock(atHandle);
+                uAtClientStreamInterceptTx(atHandle, interceptTx, pCapture);
+                uAtClientStreamInterceptRx(atHandle, interceptRx, pCapture);
+                uAtClientUnlock(atHandle);
+            } else {
+                uPortFree(pCapture);
+                pCapture = NULL;
+            }
+        }
+    }
+
+    return pCapture;
+}
+
+// Stop a capture.
+int32_t uAtClientCaptureStop(uAtClientCapture_t *pCapture)
+{
+    int32_t errorCodeOrNumRecords = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (pCapture != NULL) {
+        uAtClientLock(pCapture->atHandle);
+        uAtClientStreamInterceptTx(pCapture->atHandle, NULL, NULL);
+        uAtClientStreamInterceptRx(pCapture->atHandle, NULL, NULL);
+        uAtClientUnlock(pCapture->atHandle);
+        errorCodeOrNumRecords = pCapture->numRecords;
+        if (pCapture->errorCode < 0) {
+            errorCodeOrNumRecords = pCapture->errorCode;
+        }
+        uPortFree(pCapture);
+    }
+
+    return errorCodeOrNumRecords;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: REPLAY
+ * -------------------------------------------------------------- */
+
+// Create a replay device.
+uDeviceSerial_t *pUAtClientReplayCreate(const void *pCapture, size_t size)
+{
+    uDeviceSerial_t *pDeviceSerial = NULL;
+    uAtClientReplayContext_t *pContext;
+    const uint8_t *pHeader = (const uint8_t *) pCapture;
+
+    if ((pHeader != NULL) && (size >= U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES) &&
+        (memcmp(pHeader, U_AT_CLIENT_CAPTURE_MAGIC, U_AT_CLIENT_CAPTURE_MAGIC_LENGTH_BYTES) == 0) &&
+        (pHeader[U_AT_CLIENT_CAPTURE_MAGIC_LENGTH_BYTES] == U_AT_CLIENT_CAPTURE_VERSION)) {
+        pDeviceSerial = pUDeviceSerialCreate(initSerialInterface,
+                                             sizeof(uAtClientReplayContext_t));
+        if (pDeviceSerial != NULL) {
+            pContext = (uAtClientReplayContext_t *) pUInterfaceContext(pDeviceSerial);
+            pContext->pCapture = pHeader;
+            pContext->size = size;
+            pContext->eventQueueHandle = -1;
+            if (uPortMutexCreate(&(pContext->mutex)) != 0) {
+                uDeviceSerialDelete(pDeviceSerial);
+                pDeviceSerial = NULL;
+            }
+        }
+    }
+
+    return pDeviceSerial;
+}
+
+// Get the number of mismatched bytes written to a replay device.
+int32_t uAtClientReplayMismatchGet(uDeviceSerial_t *pDeviceSerial)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uAtClientReplayContext_t *pContext;
+
+    if (pDeviceSerial != NULL) {
+        pContext = (uAtClientReplayContext_t *) pUInterfaceContext(pDeviceSerial);
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        errorCodeOrCount = pContext->mismatchCount;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Get whether a replay has been completely read.
+bool uAtClientReplayIsDone(uDeviceSerial_t *pDeviceSerial)
+{
+    bool isDone = false;
+    uAtClientReplayContext_t *pContext;
+
+    if (pDeviceSerial != NULL) {
+        pContext = (uAtClientReplayContext_t *) pUInterfaceContext(pDeviceSerial);
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        isDone = pContext->isOpen && (pContext->rxOffset >= pContext->size);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return isDone;
+}
+
+// Delete a replay device.
+void uAtClientReplayDelete(uDeviceSerial_t *pDeviceSerial)
+{
+    uAtClientReplayContext_t *pContext;
+
+    if (pDeviceSerial != NULL) {
+        serialEventCallbackRemove(pDeviceSerial);
+        pContext = (uAtClientReplayContext_t *) pUInterfaceContext(pDeviceSerial);
+        uPortMutexDelete(pContext->mutex);
+        uDeviceSerialDelete(pDeviceSerial);
+    }
+}
+
+// End of file
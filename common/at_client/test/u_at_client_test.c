@@ -54,10 +54,14 @@
 #include "u_port_heap.h"
 #include "u_port_debug.h"
 #include "u_port_uart.h"
+#if (U_CFG_TEST_PIN_A >= 0)
+# include "u_port_gpio.h"
+#endif
 
 #include "u_test_util_resource_check.h"
 
 #include "u_at_client.h"
+#include "u_at_client_capture.h"
 #include "u_at_client_test.h"
 #include "u_at_client_test_data.h"
 
@@ -131,11 +135,21 @@
 # define U_AT_CLIENT_TEST_AT_TIMEOUT_TOLERANCE_MS 250
 #endif
 
+/** The ready time to use when testing uAtClientActivityPinHold(),
+ * long enough to be easily measured.
+ */
+#define U_AT_CLIENT_TEST_ACTIVITY_PIN_READY_MS 500
+
 /** The AT client buffer length to use during testing:
  * we send non-prefixed response of length 256 bytes plus
  * we need room for initial and trailing line endings. */
 #define U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES (256 + 4 + U_AT_CLIENT_BUFFER_OVERHEAD_BYTES)
 
+/** The inter-command delay to use when checking that
+ * uAtClientPipeline() keeps it with one command in flight.
+ */
+#define U_AT_CLIENT_TEST_PIPELINE_DELAY_MS 100
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -164,6 +178,38 @@ static int32_t gUartAHandle = -1;
  */
 static int32_t gUartBHandle = -1;
 
+/** A capture for the replay test: AT+CGMI and its response.
+ */
+static const char gReplayCapture[] = "UATC\x01\x00\x00\x00"
+                                     "\x01\x00\x00\x00\x00\x08\x00" "AT+CGMI\r"
+                                     "\x02\x10\x00\x00\x00\x0e\x00" "\r\nu-blox\r\nOK\r\n";
+
+/** Buffer to capture into for the replay test.
+ */
+static char gCaptureBuffer[256];
+
+/** The number of bytes in gCaptureBuffer.
+ */
+static size_t gCaptureLength = 0;
+
+/** The handles of the tasks that callbacks from URCs of each
+ * priority class were run in, for the URC priority test.
+ */
+static uPortTaskHandle_t gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_MAX_NUM] = {0};
+
+/** The parameter of the URC in the URC nulls test, -1 if it has
+ * not arrived.
+ */
+static volatile int32_t gUrcNullsParameter = -1;
+
+/** Where readBytesStreamCallback() puts what it is given.
+ */
+static char gReadBytesStreamBuffer[128];
+
+/** Count of the calls to readBytesStreamCallback().
+ */
+static size_t gReadBytesStreamNumCallbacks = 0;
+
 #if (U_CFG_TEST_UART_A >= 0)
 
 /** Store the last consecutive AT time-out call-back here.
@@ -187,6 +233,142 @@ static const char *gpInterceptTxDataLast = NULL;
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Capture write function for the replay test.
+static int32_t captureWrite(const void *pData, size_t length, void *pParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+
+    (void) pParam;
+
+    if (gCaptureLength + length <= sizeof(gCaptureBuffer)) {
+        memcpy(gCaptureBuffer + gCaptureLength, pData, length);
+        gCaptureLength += length;
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
+// Send AT+CGMI and read the response, for the replay test.
+static int32_t atCgmi(uAtClientHandle_t atHandle, char *pBuffer, size_t bufferSize)
+{
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+CGMI");
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, NULL);
+    uAtClientReadString(atHandle, pBuffer, bufferSize, false);
+    uAtClientResponseStop(atHandle);
+    return uAtClientUnlock(atHandle);
+}
+
+// Add a record of length bytes, which may include nulls, to a
+// capture in gCaptureBuffer, starting the capture if gCaptureLength
+// is zero.
+static void captureRecordAddBytes(uint8_t direction, const char *pData,
+                                  size_t length)
+{
+
+    if (gCaptureLength == 0) {
+        memcpy(gCaptureBuffer, gReplayCapture, U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES);
+        gCaptureLength = U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES;
+    }
+    U_PORT_TEST_ASSERT(gCaptureLength + U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES +
+                       length <= sizeof(gCaptureBuffer));
+    memset(gCaptureBuffer + gCaptureLength, 0, U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES);
+    gCaptureBuffer[gCaptureLength] = (char) direction;
+    gCaptureBuffer[gCaptureLength + 5] = (char) length;
+    gCaptureBuffer[gCaptureLength + 6] = (char) (length >> 8);
+    gCaptureLength += U_AT_CLIENT_CAPTURE_RECORD_HEADER_LENGTH_BYTES;
+    memcpy(gCaptureBuffer + gCaptureLength, pData, length);
+    gCaptureLength += length;
+}
+
+// Add a record, a null-terminated string, to a capture in
+// gCaptureBuffer, starting the capture if gCaptureLength is zero.
+static void captureRecordAdd(uint8_t direction, const char *pData)
+{
+    captureRecordAddBytes(direction, pData, strlen(pData));
+}
+
+// Parser for the pipeline test: reads an integer into the entry
+// of the int32_t array at pParam given by index.
+static void pipelineParser(uAtClientHandle_t atHandle, size_t index,
+                           void *pParam)
+{
+    *(((int32_t *) pParam) + index) = uAtClientReadInt(atHandle);
+}
+
+// Callback for the read bytes stream test: appends the segment to
+// gReadBytesStreamBuffer and stops after the first segment if
+// pCallbackParam is not NULL.
+static bool readBytesStreamCallback(uAtClientHandle_t atHandle,
+                                    const char *pData, size_t size,
+                                    size_t offset, void *pCallbackParam)
+{
+    (void) atHandle;
+
+    U_PORT_TEST_ASSERT(offset + size < sizeof(gReadBytesStreamBuffer));
+    memcpy(gReadBytesStreamBuffer + offset, pData, size);
+    gReadBytesStreamNumCallbacks++;
+
+    return (pCallbackParam == NULL);
+}
+
+// URC handler for the read bytes stream test: reads
+// +UUTEST: <length>,"<binary data>", pParameter is passed
+// on to readBytesStreamCallback().
+static void readBytesStreamUrcHandler(uAtClientHandle_t atHandle, void *pParameter)
+{
+    int32_t length;
+
+    length = uAtClientReadInt(atHandle);
+    U_PORT_TEST_ASSERT(length > 0);
+    uAtClientIgnoreStopTag(atHandle);
+    // The opening quote
+    uAtClientReadBytes(atHandle, NULL, 1, true);
+    U_PORT_TEST_ASSERT(uAtClientReadBytesStream(atHandle, (size_t) length,
+                                                readBytesStreamCallback,
+                                                pParameter) == length);
+    // The closing quote and the CR/LF: since this is a URC
+    // there is no OK to restore the stop tag for
+    uAtClientReadBytes(atHandle, NULL, 3, true);
+}
+
+// Callback for the URC priority test: pParameter points to the
+// entry in gUrcPriorityTaskHandle for the priority class.
+static void urcPriorityCallback(uAtClientHandle_t atHandle, void *pParameter)
+{
+    uPortTaskHandle_t taskHandle = NULL;
+
+    (void) atHandle;
+
+    if (uPortTaskGetHandle(&taskHandle) == 0) {
+        *((uPortTaskHandle_t *) pParameter) = taskHandle;
+    }
+}
+
+// URC handler for the URC priority test: reads the priority
+// class from the URC and makes a callback.
+static void urcPriorityUrcHandler(uAtClientHandle_t atHandle, void *pParameter)
+{
+    int32_t priority = uAtClientReadInt(atHandle);
+
+    (void) pParameter;
+
+    if ((priority >= 0) && (priority < U_AT_CLIENT_URC_PRIORITY_MAX_NUM)) {
+        uAtClientCallback(atHandle, urcPriorityCallback,
+                          &(gUrcPriorityTaskHandle[priority]));
+    }
+}
+
+// URC handler for the URC nulls test.
+static void urcNullsUrcHandler(uAtClientHandle_t atHandle, void *pParameter)
+{
+    (void) pParameter;
+
+    gUrcNullsParameter = uAtClientReadInt(atHandle);
+}
+
 #if (U_CFG_TEST_UART_A >= 0)
 
 // AT consecutive timeout callback, used by some of the tests below
@@ -203,6 +385,13 @@ static void consecutiveTimeoutCallback(uAtClientHandle_t atHandle,
     gConsecutiveTimeout = *pCount;
 }
 
+// A URC handler that does nothing, used by the configuration test.
+static void dummyUrcHandler(uAtClientHandle_t atHandle, void *pParameter)
+{
+    (void) atHandle;
+    (void) pParameter;
+}
+
 // Check the stack extents for the URC and callbacks tasks.
 static void checkStackExtents(uAtClientHandle_t atHandle)
 {
@@ -1046,6 +1235,750 @@ U_PORT_TEST_FUNCTION("[atClient]", "atClientInitialisation")
     uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
 }
 
+/** Replay a capture into an AT client and, at the same time,
+ * capture the traffic; the result is then replayed again to
+ * check that it produces the same outcome.  Requires no UART.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientReplay")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    struct uAtClientCapture_t *pCapture = NULL;
+    const char *pReplay = gReplayCapture;
+    size_t replayLength = sizeof(gReplayCapture) - 1;
+    char buffer[16];
+    int32_t x;
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    gCaptureLength = 0;
+    for (size_t pass = 0; pass < 2; pass++) {
+        U_TEST_PRINT_LINE("replay pass %d, %d byte(s) of capture.", pass + 1, replayLength);
+        pDeviceSerial = pUAtClientReplayCreate(pReplay, replayLength);
+        U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+        U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+        stream.handle.pDeviceSerial = pDeviceSerial;
+        stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+        atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+        U_PORT_TEST_ASSERT(atClientHandle != NULL);
+        if (pass == 0) {
+            pCapture = pUAtClientCaptureStart(atClientHandle, captureWrite, NULL);
+            U_PORT_TEST_ASSERT(pCapture != NULL);
+        }
+
+        memset(buffer, 0, sizeof(buffer));
+        U_PORT_TEST_ASSERT(atCgmi(atClientHandle, buffer, sizeof(buffer)) == 0);
+        U_TEST_PRINT_LINE("response was \"%s\".", buffer);
+        U_PORT_TEST_ASSERT(strcmp(buffer, "u-blox") == 0);
+        U_PORT_TEST_ASSERT(uAtClientReplayMismatchGet(pDeviceSerial) == 0);
+        U_PORT_TEST_ASSERT(uAtClientReplayIsDone(pDeviceSerial));
+
+        if (pass == 0) {
+            x = uAtClientCaptureStop(pCapture);
+            U_TEST_PRINT_LINE("captured %d record(s).", x);
+            U_PORT_TEST_ASSERT(x >= 2);
+            U_PORT_TEST_ASSERT(gCaptureLength > U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES);
+            pReplay = gCaptureBuffer;
+            replayLength = gCaptureLength;
+        }
+
+        uAtClientRemove(atClientHandle);
+        pDeviceSerial->close(pDeviceSerial);
+        uAtClientReplayDelete(pDeviceSerial);
+    }
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Check that uAtClientWriteParams() writes exactly what the
+ * equivalent individual write calls would, using a replay
+ * device to check the output.  Requires no UART.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientWriteParams")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    const char *pLong = "0123456789012345678901234567890123456789"
+                        "0123456789012345678901234567890123456789";
+    char command[160];
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    // Make a capture of what should be sent, longer than
+    // U_AT_CLIENT_WRITE_PARAMS_BUFFER_LENGTH_BYTES
+    snprintf(command, sizeof(command),
+             "AT+TEST=-1,\"a\",18446744073709551615,raw,\"%s\",xyz,\"\",\r", pLong);
+    gCaptureLength = 0;
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, command);
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\nOK\r\n");
+
+    pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+    uAtClientLock(atClientHandle);
+    uAtClientCommandStart(atClientHandle, "AT+TEST=");
+    uAtClientWriteParams(atClientHandle, "isl", (int32_t) -1, "a", UINT64_MAX);
+    uAtClientWriteParams(atClientHandle, "rsb", "raw", pLong, "xyzzy", (size_t) 3);
+    // NULL strings are written as empty ones
+    uAtClientWriteParams(atClientHandle, "sr", (const char *) NULL, (const char *) NULL);
+    uAtClientCommandStopReadResponse(atClientHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+    U_TEST_PRINT_LINE("%d byte(s) mismatched.", uAtClientReplayMismatchGet(pDeviceSerial));
+    U_PORT_TEST_ASSERT(uAtClientReplayMismatchGet(pDeviceSerial) == 0);
+
+    // An invalid format character should be reported
+    uAtClientLock(atClientHandle);
+    uAtClientWriteParams(atClientHandle, "?", 0);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test reading of integers and hex data, which are converted
+ * straight out of the receive buffer; uses a replay device and so
+ * requires no UARTs.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientReadNumbers")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    uint64_t uint64 = 0;
+    uint8_t hex[4] = {0};
+    int32_t resourceCount;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    gCaptureLength = 0;
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+TEST\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX,
+                     "\r\n+TEST: 12,-7,\"3\",x,18446744073709551615,0aF1,:\r\nOK\r\n");
+
+    pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+    uAtClientLock(atClientHandle);
+    uAtClientCommandStart(atClientHandle, "AT+TEST");
+    uAtClientCommandStop(atClientHandle);
+    uAtClientResponseStart(atClientHandle, "+TEST:");
+    U_PORT_TEST_ASSERT(uAtClientReadInt(atClientHandle) == 12);
+    U_PORT_TEST_ASSERT(uAtClientReadInt(atClientHandle) == -7);
+    U_PORT_TEST_ASSERT(uAtClientReadInt(atClientHandle) == 3);
+    // Not a number, which reads as zero, like strtol()
+    U_PORT_TEST_ASSERT(uAtClientReadInt(atClientHandle) == 0);
+    U_PORT_TEST_ASSERT(uAtClientReadUint64(atClientHandle, &uint64) == 0);
+    U_PORT_TEST_ASSERT(uint64 == UINT64_MAX);
+    U_PORT_TEST_ASSERT(uAtClientReadHexData(atClientHandle, hex, sizeof(hex)) == 2);
+    U_PORT_TEST_ASSERT((hex[0] == 0x0a) && (hex[1] == 0xf1));
+    // Invalid hex, conversion stops there
+    U_PORT_TEST_ASSERT(uAtClientReadHexData(atClientHandle, hex, sizeof(hex)) == 0);
+    // Nothing left
+    U_PORT_TEST_ASSERT(uAtClientReadInt(atClientHandle) < 0);
+    uAtClientResponseStop(atClientHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+    U_PORT_TEST_ASSERT(uAtClientReplayMismatchGet(pDeviceSerial) == 0);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test uAtClientReadParameterView(), using a receive buffer that
+ * is smaller than the response so that the view has to be found
+ * across refills of the buffer; uses a replay device and so requires
+ * no UARTs.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientReadParameterView")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    const char *pParameter;
+    char buffer[32];
+    int32_t resourceCount;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    gCaptureLength = 0;
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+TEST\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX,
+                     "\r\n+TEST: 12,\"a,b\",,skipped,\"say \"hi\"\",last\r\nOK\r\n");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+TEST2\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX,
+                     "\r\n+TEST2: 0123456789012345678901234,7\r\nOK\r\n");
+
+    pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_BUFFER_OVERHEAD_BYTES + 16);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+    uAtClientLock(atClientHandle);
+    uAtClientCommandStart(atClientHandle, "AT+TEST");
+    uAtClientCommandStop(atClientHandle);
+    uAtClientResponseStart(atClientHandle, "+TEST:");
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) == 2);
+    U_PORT_TEST_ASSERT(memcmp(pParameter, "12", 2) == 0);
+    // Quotes are removed and a delimiter between them is not a delimiter
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) == 3);
+    U_PORT_TEST_ASSERT(memcmp(pParameter, "a,b", 3) == 0);
+    // An empty parameter
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) == 0);
+    // Just skip one
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, NULL) == 7);
+    // Only the surrounding quotes are removed
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) == 8);
+    U_PORT_TEST_ASSERT(memcmp(pParameter, "say \"hi\"", 8) == 0);
+    // The last one ends with the stop tag, after which there is nothing
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) == 4);
+    U_PORT_TEST_ASSERT(memcmp(pParameter, "last", 4) == 0);
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) < 0);
+    uAtClientResponseStop(atClientHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+
+    uAtClientLock(atClientHandle);
+    uAtClientCommandStart(atClientHandle, "AT+TEST2");
+    uAtClientCommandStop(atClientHandle);
+    uAtClientResponseStart(atClientHandle, "+TEST2:");
+    // Too long for the receive buffer: nothing is consumed and the
+    // parameter can still be read as a string
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) ==
+                       (int32_t) U_ERROR_COMMON_NO_MEMORY);
+    U_PORT_TEST_ASSERT(uAtClientReadString(atClientHandle, buffer, sizeof(buffer), false) == 25);
+    U_PORT_TEST_ASSERT(strcmp(buffer, "0123456789012345678901234") == 0);
+    U_PORT_TEST_ASSERT(uAtClientReadParameterView(atClientHandle, &pParameter) == 1);
+    U_PORT_TEST_ASSERT(*pParameter == '7');
+    uAtClientResponseStop(atClientHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+    U_PORT_TEST_ASSERT(uAtClientReplayMismatchGet(pDeviceSerial) == 0);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test uAtClientPipeline() with three commands in flight; the
+ * capture only delivers each response once the commands ahead of it
+ * have been sent, so any lack of pipelining would show up as a
+ * mismatch; with one command in flight the inter-command delay
+ * must be kept.  Uses a replay device and so requires no UARTs.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientPipeline")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    uAtClientPipelineCommand_t commands[5] = {0};
+    const char *pCommand[] = {"AT+A", "AT+B", "AT+C", "AT+D", "AT+E"};
+    const char *pPrefix[] = {"+A:", "+B:", NULL, "+D:", "+E:"};
+    int32_t value[5];
+    int32_t startTimeMs;
+    int32_t durationMs;
+    int32_t resourceCount;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    for (size_t x = 0; x < sizeof(commands) / sizeof(commands[0]); x++) {
+        commands[x].pCommand = pCommand[x];
+        commands[x].pPrefix = pPrefix[x];
+        if (pPrefix[x] != NULL) {
+            commands[x].pParser = pipelineParser;
+            commands[x].pParserParam = value;
+        }
+        value[x] = -1;
+    }
+
+    // AT+B fails with a CME ERROR and AT+C has no information response
+    gCaptureLength = 0;
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+A\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+B\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+C\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\n+A: 1\r\n\r\nOK\r\n");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+D\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\n+CME ERROR: 10\r\n");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+E\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\nOK\r\n");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\n+D: 4\r\n\r\nOK\r\n");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\n+E: 5\r\n\r\nOK\r\n");
+
+    pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uAtClientPipeline(NULL, commands, 5, 3) < 0);
+    U_PORT_TEST_ASSERT(uAtClientPipeline(atClientHandle, NULL, 5, 3) < 0);
+    U_PORT_TEST_ASSERT(uAtClientPipeline(atClientHandle, commands, 5, 0) < 0);
+
+    // Four of the five succeed
+    U_PORT_TEST_ASSERT(uAtClientPipeline(atClientHandle, commands, 5, 3) == 4);
+    U_PORT_TEST_ASSERT(uAtClientReplayMismatchGet(pDeviceSerial) == 0);
+    U_PORT_TEST_ASSERT(uAtClientReplayIsDone(pDeviceSerial));
+    U_PORT_TEST_ASSERT(commands[0].errorCode == 0);
+    U_PORT_TEST_ASSERT(value[0] == 1);
+    // ...the error only affecting its own command
+    U_PORT_TEST_ASSERT(commands[1].errorCode == (int32_t) U_ERROR_COMMON_DEVICE_ERROR);
+    U_PORT_TEST_ASSERT(commands[1].deviceError.type == U_AT_CLIENT_DEVICE_ERROR_TYPE_CME);
+    U_PORT_TEST_ASSERT(commands[1].deviceError.code == 10);
+    U_PORT_TEST_ASSERT(value[1] < 0);
+    U_PORT_TEST_ASSERT(commands[2].errorCode == 0);
+    U_PORT_TEST_ASSERT(commands[2].deviceError.type == U_AT_CLIENT_DEVICE_ERROR_TYPE_NO_ERROR);
+    U_PORT_TEST_ASSERT(value[2] == -1);
+    U_PORT_TEST_ASSERT(commands[3].errorCode == 0);
+    U_PORT_TEST_ASSERT(value[3] == 4);
+    U_PORT_TEST_ASSERT(commands[4].errorCode == 0);
+    U_PORT_TEST_ASSERT(value[4] == 5);
+
+    // The AT client is unlocked and usable afterwards
+    uAtClientLock(atClientHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    // With one command in flight the inter-command delay is kept
+    gCaptureLength = 0;
+    for (size_t x = 0; x < 3; x++) {
+        captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+A\r");
+        captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\nOK\r\n");
+        commands[x].pCommand = pCommand[0];
+        commands[x].pPrefix = NULL;
+        commands[x].pParser = NULL;
+    }
+    pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+    uAtClientDelaySet(atClientHandle, U_AT_CLIENT_TEST_PIPELINE_DELAY_MS);
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uAtClientPipeline(atClientHandle, commands, 3, 1) == 3);
+    durationMs = uPortGetTickTimeMs() - startTimeMs;
+    U_TEST_PRINT_LINE("three commands with a %d ms delay took %d ms.",
+                      U_AT_CLIENT_TEST_PIPELINE_DELAY_MS, durationMs);
+    U_PORT_TEST_ASSERT(durationMs >= U_AT_CLIENT_TEST_PIPELINE_DELAY_MS * 2);
+    U_PORT_TEST_ASSERT(uAtClientDelayGet(atClientHandle) == U_AT_CLIENT_TEST_PIPELINE_DELAY_MS);
+    U_PORT_TEST_ASSERT(uAtClientReplayMismatchGet(pDeviceSerial) == 0);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+#if (U_CFG_TEST_PIN_A >= 0)
+/** Test uAtClientActivityPinHold() by timing uAtClientLock(): the
+ * ready time of the activity pin should be waited for only when the
+ * pin is not already held (half the ready time is the threshold, to
+ * allow for tick granularity); uses a replay device and pin A, which
+ * only has to be available as an output.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientActivityPinHold")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    uPortGpioConfig_t gpioConfig;
+    int32_t startTimeMs;
+    int32_t durationMs;
+    int32_t resourceCount;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    U_PORT_GPIO_SET_DEFAULT(&gpioConfig);
+    gpioConfig.pin = U_CFG_TEST_PIN_A;
+    gpioConfig.direction = U_PORT_GPIO_DIRECTION_OUTPUT;
+    U_PORT_TEST_ASSERT(uPortGpioConfig(&gpioConfig) == 0);
+    U_PORT_TEST_ASSERT(uPortGpioSet(U_CFG_TEST_PIN_A, 0) == 0);
+
+    // No AT traffic is needed, just a stream
+    pDeviceSerial = pUAtClientReplayCreate(gReplayCapture,
+                                           U_AT_CLIENT_CAPTURE_HEADER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+    // No activity pin, nothing to hold
+    U_PORT_TEST_ASSERT(uAtClientActivityPinHold(atClientHandle, true) < 0);
+
+    U_PORT_TEST_ASSERT(uAtClientSetActivityPin(atClientHandle, U_CFG_TEST_PIN_A,
+                                               U_AT_CLIENT_TEST_ACTIVITY_PIN_READY_MS,
+                                               0, true) == 0);
+
+    // Not held: locking waits for the ready time
+    startTimeMs = uPortGetTickTimeMs();
+    uAtClientLock(atClientHandle);
+    durationMs = uPortGetTickTimeMs() - startTimeMs;
+    uAtClientUnlock(atClientHandle);
+    U_TEST_PRINT_LINE("lock without hold took %d ms.", durationMs);
+    U_PORT_TEST_ASSERT(durationMs >= U_AT_CLIENT_TEST_ACTIVITY_PIN_READY_MS / 2);
+
+    // Holding does not wait and the ready time then passes in the
+    // background, so locking needn't wait either, nor again while
+    // the hold continues; a nested hold keeps it going
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uAtClientActivityPinHold(atClientHandle, true) == 0);
+    durationMs = uPortGetTickTimeMs() - startTimeMs;
+    U_TEST_PRINT_LINE("hold took %d ms.", durationMs);
+    U_PORT_TEST_ASSERT(durationMs < U_AT_CLIENT_TEST_ACTIVITY_PIN_READY_MS / 2);
+    U_PORT_TEST_ASSERT(uAtClientActivityPinHold(atClientHandle, true) == 0);
+    uPortTaskBlock(U_AT_CLIENT_TEST_ACTIVITY_PIN_READY_MS);
+    for (size_t x = 0; x < 3; x++) {
+        startTimeMs = uPortGetTickTimeMs();
+        uAtClientLock(atClientHandle);
+        durationMs = uPortGetTickTimeMs() - startTimeMs;
+        uAtClientUnlock(atClientHandle);
+        U_TEST_PRINT_LINE("lock %d while held took %d ms.", x + 1, durationMs);
+        U_PORT_TEST_ASSERT(durationMs < U_AT_CLIENT_TEST_ACTIVITY_PIN_READY_MS / 2);
+        if (x == 1) {
+            // Release the nested hold
+            U_PORT_TEST_ASSERT(uAtClientActivityPinHold(atClientHandle, false) == 0);
+        }
+    }
+
+    // Once the last hold is released the ready time is waited for again
+    U_PORT_TEST_ASSERT(uAtClientActivityPinHold(atClientHandle, false) == 0);
+    startTimeMs = uPortGetTickTimeMs();
+    uAtClientLock(atClientHandle);
+    durationMs = uPortGetTickTimeMs() - startTimeMs;
+    uAtClientUnlock(atClientHandle);
+    U_TEST_PRINT_LINE("lock after release took %d ms.", durationMs);
+    U_PORT_TEST_ASSERT(durationMs >= U_AT_CLIENT_TEST_ACTIVITY_PIN_READY_MS / 2);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+#endif
+
+/** Test that uAtClientReadBytesStream() delivers a binary URC
+ * payload, containing what would otherwise be stop tags, that is
+ * larger than the receive buffer of the AT client; uses a replay
+ * device and so requires no UARTs.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientReadBytesStream")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    const char *pPayload = "0123456789\r\nOK\r\n0123456789ERROR\r\n"
+                           "01234567890123456789\r\n0123456789";
+    char urc[128];
+    int32_t resourceCount;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    gCaptureLength = 0;
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT+TEST\r");
+    snprintf(urc, sizeof(urc), "\r\nOK\r\n\r\n+UUTEST: %d,\"%s\"\r\n",
+             (int) strlen(pPayload), pPayload);
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, urc);
+
+    for (size_t pass = 0; pass < 2; pass++) {
+        pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+        U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+        U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+        stream.handle.pDeviceSerial = pDeviceSerial;
+        stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+        // A receive buffer smaller than the payload
+        atClientHandle = uAtClientAddExt(&stream, NULL,
+                                         U_AT_CLIENT_BUFFER_OVERHEAD_BYTES + 16);
+        U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+        memset(gReadBytesStreamBuffer, 0, sizeof(gReadBytesStreamBuffer));
+        gReadBytesStreamNumCallbacks = 0;
+        uAtClientLock(atClientHandle);
+        uAtClientCommandStart(atClientHandle, "AT+TEST");
+        uAtClientCommandStopReadResponse(atClientHandle);
+        // On the second pass, stop after the first segment
+        U_PORT_TEST_ASSERT(uAtClientUrcDirect(atClientHandle, "+UUTEST:",
+                                              readBytesStreamUrcHandler,
+                                              (pass == 0) ? NULL : (void *) pPayload) == 0);
+        U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+        U_TEST_PRINT_LINE("pass %d: payload in %d segment(s).", pass + 1,
+                          gReadBytesStreamNumCallbacks);
+        if (pass == 0) {
+            U_PORT_TEST_ASSERT(gReadBytesStreamNumCallbacks > 1);
+            U_PORT_TEST_ASSERT(strcmp(gReadBytesStreamBuffer, pPayload) == 0);
+        } else {
+            U_PORT_TEST_ASSERT(gReadBytesStreamNumCallbacks == 1);
+            U_PORT_TEST_ASSERT(strncmp(gReadBytesStreamBuffer, pPayload, strlen(gReadBytesStreamBuffer)) == 0);
+        }
+        U_PORT_TEST_ASSERT(uAtClientReplayMismatchGet(pDeviceSerial) == 0);
+        U_PORT_TEST_ASSERT(uAtClientReplayIsDone(pDeviceSerial));
+
+        uAtClientRemove(atClientHandle);
+        pDeviceSerial->close(pDeviceSerial);
+        uAtClientReplayDelete(pDeviceSerial);
+    }
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test that callbacks from URC handlers of each priority class
+ * are run in the task of that class; uses a replay device and so
+ * requires no UARTs.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientUrcPriority")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    int32_t startTimeMs;
+    int32_t resourceCount;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    // One URC of each class, each carrying its class as a parameter
+    gCaptureLength = 0;
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX,
+                     "\r\nOK\r\n+UTESTB: 2\r\n+UTESTN: 1\r\n+UTESTH: 0\r\n");
+
+    pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+    memset(gUrcPriorityTaskHandle, 0, sizeof(gUrcPriorityTaskHandle));
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandlerExt(atClientHandle, "+UTESTH:",
+                                                 urcPriorityUrcHandler, NULL,
+                                                 U_AT_CLIENT_URC_PRIORITY_HIGH) == 0);
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandler(atClientHandle, "+UTESTN:",
+                                              urcPriorityUrcHandler, NULL) == 0);
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandlerExt(atClientHandle, "+UTESTB:",
+                                                 urcPriorityUrcHandler, NULL,
+                                                 U_AT_CLIENT_URC_PRIORITY_BULK) == 0);
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandlerExt(atClientHandle, "+UTESTX:",
+                                                 urcPriorityUrcHandler, NULL,
+                                                 U_AT_CLIENT_URC_PRIORITY_MAX_NUM) < 0);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerPriorityGet(atClientHandle,
+                                                      "+UTESTH:") == (int32_t) U_AT_CLIENT_URC_PRIORITY_HIGH);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerPriorityGet(atClientHandle,
+                                                      "+UTESTN:") == (int32_t) U_AT_CLIENT_URC_PRIORITY_NORMAL);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerPriorityGet(atClientHandle,
+                                                      "+UTESTB:") == (int32_t) U_AT_CLIENT_URC_PRIORITY_BULK);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerPriorityGet(atClientHandle,
+                                                      "+UTESTX:") == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+
+    uAtClientLock(atClientHandle);
+    uAtClientCommandStart(atClientHandle, "AT");
+    uAtClientCommandStopReadResponse(atClientHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+
+    // Wait for the URCs to be processed and the callbacks to run
+    startTimeMs = uPortGetTickTimeMs();
+    while (((gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_HIGH] == NULL) ||
+            (gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL] == NULL) ||
+            (gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_BULK] == NULL)) &&
+           (uPortGetTickTimeMs() - startTimeMs < 5000)) {
+        uPortTaskBlock(10);
+    }
+    U_PORT_TEST_ASSERT(gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_HIGH] != NULL);
+    U_PORT_TEST_ASSERT(gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL] != NULL);
+    U_PORT_TEST_ASSERT(gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_BULK] != NULL);
+    // Each class should have had its own task
+    U_PORT_TEST_ASSERT(gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_HIGH] !=
+                       gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL]);
+    U_PORT_TEST_ASSERT(gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_BULK] !=
+                       gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_NORMAL]);
+    U_PORT_TEST_ASSERT(gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_HIGH] !=
+                       gUrcPriorityTaskHandle[U_AT_CLIENT_URC_PRIORITY_BULK]);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test that a URC preceded by nulls, as a module may emit near
+ * power-on, is still found in the hash table of URC handlers and
+ * dispatched; uses a replay device and so requires no UARTs.
+ */
+U_PORT_TEST_FUNCTION("[atClient]", "atClientUrcNulls")
+{
+    uAtClientHandle_t atClientHandle;
+    uAtClientStreamHandle_t stream;
+    uDeviceSerial_t *pDeviceSerial;
+    const char urc[] = "\0\0\0+UTESTN: 7\r\n";
+    int32_t startTimeMs;
+    int32_t resourceCount;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+
+    gCaptureLength = 0;
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_TX, "AT\r");
+    captureRecordAdd(U_AT_CLIENT_CAPTURE_DIRECTION_RX, "\r\nOK\r\n");
+    captureRecordAddBytes(U_AT_CLIENT_CAPTURE_DIRECTION_RX, urc, sizeof(urc) - 1);
+
+    pDeviceSerial = pUAtClientReplayCreate(gCaptureBuffer, gCaptureLength);
+    U_PORT_TEST_ASSERT(pDeviceSerial != NULL);
+    U_PORT_TEST_ASSERT(pDeviceSerial->open(pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    atClientHandle = uAtClientAddExt(&stream, NULL, U_AT_CLIENT_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(atClientHandle != NULL);
+
+    gUrcNullsParameter = -1;
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandler(atClientHandle, "+UTESTN:",
+                                              urcNullsUrcHandler, NULL) == 0);
+
+    uAtClientLock(atClientHandle);
+    uAtClientCommandStart(atClientHandle, "AT");
+    uAtClientCommandStopReadResponse(atClientHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atClientHandle) == 0);
+
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gUrcNullsParameter < 0) && (uPortGetTickTimeMs() - startTimeMs < 5000)) {
+        uPortTaskBlock(10);
+    }
+    U_TEST_PRINT_LINE("URC parameter was %d.", gUrcNullsParameter);
+    U_PORT_TEST_ASSERT(gUrcNullsParameter == 7);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle, "+UTESTN:") == 1);
+
+    uAtClientRemove(atClientHandle);
+    pDeviceSerial->close(pDeviceSerial);
+    uAtClientReplayDelete(pDeviceSerial);
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 #if (U_CFG_TEST_UART_A >= 0)
 /** Add an AT client then try getting and setting all of the
  * configuration items.  Requires one UART with no
@@ -1137,11 +2070,79 @@ U_PORT_TEST_FUNCTION("[atClient]", "atClientConfiguration")
     U_TEST_PRINT_LINE("delay is now %d ms.", x);
     U_PORT_TEST_ASSERT(x == U_AT_CLIENT_DEFAULT_DELAY_MS + 1);
 
+    thingIsOn = uAtClientEventDrivenGet(atClientHandle);
+    U_TEST_PRINT_LINE("event-driven reads are %s.", thingIsOn ? "on" : "off");
+    U_PORT_TEST_ASSERT(!thingIsOn);
+
+    U_PORT_TEST_ASSERT(uAtClientEventDrivenSet(atClientHandle, true) == 0);
+    thingIsOn = uAtClientEventDrivenGet(atClientHandle);
+    U_TEST_PRINT_LINE("event-driven reads are now %s.", thingIsOn ? "on" : "off");
+    U_PORT_TEST_ASSERT(thingIsOn);
+    U_PORT_TEST_ASSERT(uAtClientEventDrivenSet(atClientHandle, false) == 0);
+    U_PORT_TEST_ASSERT(!uAtClientEventDrivenGet(atClientHandle));
+    // Leave it on so that it is cleaned up by uAtClientRemove()
+    U_PORT_TEST_ASSERT(uAtClientEventDrivenSet(atClientHandle, true) == 0);
+
     // Can't do much with this other than set it
     U_TEST_PRINT_LINE("setting consecutive AT timeout callback...");
     uAtClientTimeoutCallbackSet(atClientHandle,
                                 consecutiveTimeoutCallback);
 
+    // Add some URC handlers, including ones with short
+    // prefixes and ones which share a common start,
+    // then check that they can each be found and removed
+    U_TEST_PRINT_LINE("adding URC handlers...");
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandler(atClientHandle, "+UUSORD:",
+                                              dummyUrcHandler, NULL) == 0);
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandler(atClientHandle, "+UUSORF:",
+                                              dummyUrcHandler, NULL) == 0);
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandler(atClientHandle, "RING",
+                                              dummyUrcHandler, NULL) == 0);
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandler(atClientHandle, "+CEREG:",
+                                              dummyUrcHandler, NULL) == 0);
+    // Adding the same one again should be harmless
+    U_PORT_TEST_ASSERT(uAtClientSetUrcHandler(atClientHandle, "+CEREG:",
+                                              dummyUrcHandler, NULL) == 0);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerGetFirst(atClientHandle, NULL,
+                                                   NULL, NULL) == 3);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle, "+UUSORD:") == 0);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle, "+UUSORF:") == 0);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle, "RING") == 0);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle, "+CEREG:") == 0);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle,
+                                                      "+UUSOCL:") == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    uAtClientRemoveUrcHandler(atClientHandle, "+UUSORD:");
+    uAtClientRemoveUrcHandler(atClientHandle, "RING");
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle,
+                                                      "+UUSORD:") == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle,
+                                                      "RING") == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerHitCountGet(atClientHandle, "+UUSORF:") == 0);
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerGetFirst(atClientHandle, NULL,
+                                                   NULL, NULL) == 1);
+    uAtClientRemoveUrcHandler(atClientHandle, "+UUSORF:");
+    uAtClientRemoveUrcHandler(atClientHandle, "+CEREG:");
+    U_PORT_TEST_ASSERT(uAtClientUrcHandlerGetFirst(atClientHandle, NULL,
+                                                   NULL, NULL) < 0);
+
+    // Statistics may or may not be compiled in but either
+    // way nothing should have been recorded yet
+    x = uAtClientStatsGet(atClientHandle, NULL, 0);
+    U_TEST_PRINT_LINE("uAtClientStatsGet() returned %d.", x);
+    U_PORT_TEST_ASSERT((x == 0) || (x == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED));
+    uAtClientStatsReset(atClientHandle);
+    // Adaptive timeouts are only there if statistics are
+    U_PORT_TEST_ASSERT(!uAtClientTimeoutAdaptiveGet(atClientHandle));
+    if (x == 0) {
+        U_PORT_TEST_ASSERT(uAtClientTimeoutAdaptiveSet(atClientHandle, true) == 0);
+        U_PORT_TEST_ASSERT(uAtClientTimeoutAdaptiveGet(atClientHandle));
+        U_PORT_TEST_ASSERT(uAtClientTimeoutAdaptiveSet(atClientHandle, false) == 0);
+    } else {
+        U_PORT_TEST_ASSERT(uAtClientTimeoutAdaptiveSet(atClientHandle,
+                                                       true) == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED);
+    }
+    U_PORT_TEST_ASSERT(!uAtClientTimeoutAdaptiveGet(atClientHandle));
+
     // Check the stack extents for the URC and callbacks tasks
     checkStackExtents(atClientHandle);
 
@@ -44,6 +44,20 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_DEVICE_OPEN_TASK_STACK_SIZE_BYTES
+/** The stack size of each of the tasks started by uDeviceOpenStart()
+ * to bring up a device.
+ */
+# define U_DEVICE_OPEN_TASK_STACK_SIZE_BYTES (1024 * 4)
+#endif
+
+#ifndef U_DEVICE_OPEN_TASK_PRIORITY
+/** The priority of each of the tasks started by uDeviceOpenStart()
+ * to bring up a device.
+ */
+# define U_DEVICE_OPEN_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -142,6 +156,19 @@ typedef struct {
        against it might and with the clause"; if this
        field is populated then the version field of
        this structure must be set to 1 or higher". */
+    int32_t baudRateMax;      /**< Cellular only, ignored otherwise:
+                                   if this is larger than baudRate then,
+                                   once the module has been powered on,
+                                   the UART is moved to the highest baud
+                                   rate, no higher than this, that both
+                                   the module and this MCU support, see
+                                   uCellCfgUpgradeBaudRate() for the
+                                   details; should that not be possible
+                                   the UART stays at baudRate.  If this
+                                   field is populated then the version
+                                   field of this structure must be set
+                                   to 1 or higher. */
+    /* This is the end of version 1 of this structure. */
 } uDeviceCfgUart_t;
 
 /** Virtual serial interface.
@@ -256,6 +283,20 @@ typedef struct {
        against it might end with the clause "; if this
        field is populated then the version field
        of this structure must be set to 1 or higher". */
+    bool warmAttach;           /**< Set this to true if the cellular
+                                    module may have been left powered,
+                                    registered and connected while this
+                                    MCU restarted: if the module is found
+                                    to be on, its registration and PDP
+                                    context state is picked up rather
+                                    than the radio being switched off,
+                                    see uCellPwrSetWarmAttach(); any
+                                    sockets the module has open may then
+                                    be recovered with uCellSockWarmAttach().
+                                    If this field is populated then the
+                                    version field of this structure must
+                                    be set to 1 or higher. */
+    /* This is the end of version 1 of this structure. */
 } uDeviceCfgCell_t;
 
 /** GNSS device configuration.
@@ -306,6 +347,17 @@ typedef struct {
        against it might end with the clause "; if this
        field is populated then the version field of
        this structure must be set to 1 or higher". */
+    size_t ringBufferLengthBytes; /**< The size of the ring buffer that
+                                       holds messages streamed from the
+                                       GNSS device, see
+                                       uGnssSetRingBufferLength(); let the
+                                       compiler initialise this to 0 to
+                                       use the default of
+                                       #U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES.
+                                       If this field is populated then
+                                       the version field of this structure
+                                       must be set to 1 or higher. */
+    /* This is the end of version 1 of this structure. */
 } uDeviceCfgGnss_t;
 
 /** Short-range device configuration.
@@ -409,6 +461,49 @@ int32_t uDeviceGetDefaults(uDeviceType_t deviceType,
 int32_t uDeviceOpen(const uDeviceCfg_t *pDeviceCfg,
                     uDeviceHandle_t *pDeviceHandle);
 
+/** Open a device instance without waiting: the device is brought up
+ * by a task of its own and pCallback is called when it is powered-up
+ * and ready to be configured, or when that has failed.  Since each
+ * device is brought up independently, several devices of different
+ * types (e.g. cellular, GNSS and short-range) may be opened in
+ * parallel, the total start-up time then being that of the slowest
+ * device rather than the sum of them all; devices of the same type
+ * share the mutex of their API and so are still brought up one after
+ * the other.  The device handle only exists once the device driver
+ * has been added, hence it is passed to pCallback rather than
+ * returned here: anything to be done with the device, for instance
+ * uNetworkInterfaceUp(), should be done from, or triggered by,
+ * pCallback.  uDeviceDeinit() waits for any uDeviceOpenStart() that
+ * is in progress to complete.
+ *
+ * @param[in] pDeviceCfg     device configuration, cannot be NULL; the
+ *                           structure is copied but anything that it
+ *                           points to (e.g. a SIM PIN or a UART prefix)
+ *                           must remain valid until pCallback has
+ *                           been called.
+ * @param[in] pCallback      the function to call when the device has
+ *                           been opened, cannot be NULL.  The first
+ *                           parameter is the device handle, NULL on
+ *                           failure, the second is zero on success
+ *                           else the negative error code that
+ *                           uDeviceOpen() would have returned and the
+ *                           third is pCallbackParam.  pCallback is
+ *                           called from the task that brought the
+ *                           device up, which exits when it returns;
+ *                           it may call any device or network API.
+ * @param[in] pCallbackParam a parameter that will be passed to
+ *                           pCallback; may be NULL.
+ * @return                   zero if the task that will bring up the
+ *                           device was started, else a negative error
+ *                           code, in which case pCallback will not
+ *                           be called.
+ */
+int32_t uDeviceOpenStart(const uDeviceCfg_t *pDeviceCfg,
+                         void (*pCallback) (uDeviceHandle_t devHandle,
+                                            int32_t errorCode,
+                                            void *pCallbackParam),
+                         void *pCallbackParam);
+
 /** Close an open device instance, optionally powering it down.
  *
  * Note: when a device is closed not all memory associated with it
@@ -26,9 +26,12 @@
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"   //
 
+#include "u_cfg_os_platform_specific.h" // U_CFG_OS_APP_TASK_PRIORITY, U_CFG_OS_YIELD_MS
 #include "u_error_common.h"
 
 #include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port.h"
 
 #include "u_device.h"
 #include "u_device_shared.h"
@@ -36,6 +39,8 @@
 #include "u_location.h"
 #include "u_location_shared.h"
 
+#include "u_security_tls.h"
+
 #include "u_device_private.h"
 #include "u_device_private_cell.h"
 #include "u_device_private_gnss.h"
@@ -59,14 +64,110 @@
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The parameters of a uDeviceOpenStart(), passed to openTask().
+ */
+typedef struct {
+    uDeviceCfg_t deviceCfg;
+    void (*pCallback) (uDeviceHandle_t devHandle,
+                       int32_t errorCode,
+                       void *pCallbackParam);
+    void *pCallbackParam;
+} uDeviceOpenStart_t;
+
 /* ----------------------------------------------------------------
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
 
+/** The number of uDeviceOpenStart() tasks that have yet to finish,
+ * protected by the device API mutex.
+ */
+static int32_t gOpenStartCount = 0;
+
+/* ----------------------------------------------------------------
+ * FUNCTION PROTOTYPES
+ * -------------------------------------------------------------- */
+
+int32_t uDeviceCallback(const char *pOperationType,
+                        void *pOperationParam1,
+                        void *pOperationParam2);
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Bring up a device; locking is up to the caller.
+static int32_t openDevice(const uDeviceCfg_t *pDeviceCfg,
+                          uDeviceHandle_t *pDeviceHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pDeviceCfg != NULL) && (pDeviceCfg->version == 0) && (pDeviceHandle != NULL)) {
+        switch (pDeviceCfg->deviceType) {
+            case U_DEVICE_TYPE_CELL:
+                errorCode = uDevicePrivateCellAdd(pDeviceCfg, pDeviceHandle);
+                if (errorCode == 0) {
+                    U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgCell.moduleType;
+                }
+                break;
+            case U_DEVICE_TYPE_GNSS:
+                errorCode = uDevicePrivateGnssAdd(pDeviceCfg, pDeviceHandle);
+                if (errorCode == 0) {
+                    U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgGnss.moduleType;
+                }
+                break;
+            case U_DEVICE_TYPE_SHORT_RANGE:
+                errorCode = uDevicePrivateShortRangeAdd(pDeviceCfg, pDeviceHandle);
+                if (errorCode == 0) {
+                    U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgSho.moduleType;
+                }
+                break;
+            case U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU:
+                errorCode = uDevicePrivateShortRangeOpenCpuAdd(pDeviceCfg, pDeviceHandle);
+                if (errorCode == 0) {
+                    U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgSho.moduleType;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return errorCode;
+}
+
+// The task that brings up a device for uDeviceOpenStart(); it does
+// not hold the device API lock while doing so, which is what allows
+// devices to be brought up in parallel: each device API has its own
+// mutex to protect its instances.
+static void openTask(void *pParameter)
+{
+    uDeviceOpenStart_t *pOpenStart = (uDeviceOpenStart_t *) pParameter;
+    uDeviceHandle_t devHandle = NULL;
+    int32_t errorCode = uDeviceLock();
+
+    if (errorCode == 0) {
+        errorCode = uDeviceCallback("open", (void *) pOpenStart->deviceCfg.deviceType, NULL);
+        uDeviceUnlock();
+    }
+    if (errorCode == 0) {
+        errorCode = openDevice(&(pOpenStart->deviceCfg), &devHandle);
+    }
+    if (errorCode != 0) {
+        devHandle = NULL;
+    }
+
+    pOpenStart->pCallback(devHandle, errorCode, pOpenStart->pCallbackParam);
+    uPortFree(pOpenStart);
+
+    if (uDeviceLock() == 0) {
+        gOpenStartCount--;
+        uDeviceUnlock();
+    }
+
+    // Delete ourselves
+    uPortTaskDelete(NULL);
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -157,6 +258,17 @@ int32_t uDeviceInit()
 
 int32_t uDeviceDeinit()
 {
+    bool openStartPending = true;
+
+    // Wait for any uDeviceOpenStart() tasks to finish
+    while (openStartPending && (uDeviceLock() == 0)) {
+        openStartPending = (gOpenStartCount > 0);
+        uDeviceUnlock();
+        if (openStartPending) {
+            uPortTaskBlock(U_CFG_OS_YIELD_MS);
+        }
+    }
+
     uLocationSharedDeinit();
     uDevicePrivateShortRangeDeinit();
     uDevicePrivateGnssDeinit();
@@ -262,36 +374,47 @@ int32_t uDeviceOpen(const uDeviceCfg_t *pDeviceCfg, uDeviceHandle_t *pDeviceHand
         errorCode = uDeviceCallback("open", (void *)pDeviceCfg->deviceType, NULL);
     }
 
+    if (errorCode == 0) {
+        errorCode = openDevice(pDeviceCfg, pDeviceHandle);
+
+        // ...and done
+        uDeviceUnlock();
+    }
+
+    return errorCode;
+}
+
+int32_t uDeviceOpenStart(const uDeviceCfg_t *pDeviceCfg,
+                         void (*pCallback) (uDeviceHandle_t devHandle,
+                                            int32_t errorCode,
+                                            void *pCallbackParam),
+                         void *pCallbackParam)
+{
+    uDeviceOpenStart_t *pOpenStart;
+    uPortTaskHandle_t taskHandle;
+    // Lock the API
+    int32_t errorCode = uDeviceLock();
+
     if (errorCode == 0) {
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((pDeviceCfg != NULL) && (pDeviceCfg->version == 0) && (pDeviceHandle != NULL)) {
-            switch (pDeviceCfg->deviceType) {
-                case U_DEVICE_TYPE_CELL:
-                    errorCode = uDevicePrivateCellAdd(pDeviceCfg, pDeviceHandle);
-                    if (errorCode == 0) {
-                        U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgCell.moduleType;
-                    }
-                    break;
-                case U_DEVICE_TYPE_GNSS:
-                    errorCode = uDevicePrivateGnssAdd(pDeviceCfg, pDeviceHandle);
-                    if (errorCode == 0) {
-                        U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgGnss.moduleType;
-                    }
-                    break;
-                case U_DEVICE_TYPE_SHORT_RANGE:
-                    errorCode = uDevicePrivateShortRangeAdd(pDeviceCfg, pDeviceHandle);
-                    if (errorCode == 0) {
-                        U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgSho.moduleType;
-                    }
-                    break;
-                case U_DEVICE_TYPE_SHORT_RANGE_OPEN_CPU:
-                    errorCode = uDevicePrivateShortRangeOpenCpuAdd(pDeviceCfg, pDeviceHandle);
-                    if (errorCode == 0) {
-                        U_DEVICE_INSTANCE(*pDeviceHandle)->moduleType = pDeviceCfg->deviceCfg.cfgSho.moduleType;
-                    }
-                    break;
-                default:
-                    break;
+        if ((pDeviceCfg != NULL) && (pDeviceCfg->version == 0) && (pCallback != NULL)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            // This is free'd by openTask()
+            pOpenStart = (uDeviceOpenStart_t *) pUPortMalloc(sizeof(*pOpenStart));
+            if (pOpenStart != NULL) {
+                pOpenStart->deviceCfg = *pDeviceCfg;
+                pOpenStart->pCallback = pCallback;
+                pOpenStart->pCallbackParam = pCallbackParam;
+                errorCode = uPortTaskCreate(openTask, "deviceOpen",
+                                            U_DEVICE_OPEN_TASK_STACK_SIZE_BYTES,
+                                            (void *) pOpenStart,
+                                            U_DEVICE_OPEN_TASK_PRIORITY,
+                                            &taskHandle);
+                if (errorCode == 0) {
+                    gOpenStartCount++;
+                } else {
+                    uPortFree(pOpenStart);
+                }
             }
         }
 
@@ -306,13 +429,22 @@ int32_t uDeviceClose(uDeviceHandle_t devHandle, bool powerOff)
 {
     int32_t errorCode;
     uDeviceType_t deviceType;
+    uDeviceInstance_t *pInstance;
 
     // Lock the API
     errorCode = uDeviceLock();
     if (errorCode == 0) {
+        if (uDeviceGetInstance(devHandle, &pInstance) == 0) {
+            // Wait for anyone working on the device, e.g. bringing
+            // up a network with it locked, to finish
+            uDeviceInstanceDrain(pInstance);
+        }
         deviceType = uDeviceGetDeviceType(devHandle);
         switch (deviceType) {
             case U_DEVICE_TYPE_CELL:
+                // Any security profiles configured for sharing
+                // will not survive the device going away
+                uSecurityTlsCacheFlush(devHandle);
                 errorCode = uDevicePrivateCellRemove(devHandle, powerOff);
                 break;
             case U_DEVICE_TYPE_GNSS:
@@ -43,6 +43,7 @@
 #include "u_cell.h"
 #include "u_cell_net.h"
 #include "u_cell_pwr.h"
+#include "u_cell_cfg.h"
 
 #include "u_device_shared_cell.h"
 #include "u_device_private_cell.h"
@@ -178,11 +179,23 @@ static int32_t addDevice(const uDeviceCfgUart_t *pCfgUart,
                         errorCode = uCellPwrSetDtrPowerSavingPin(*pDeviceHandle,
                                                                  pCfgCell->pinDtrPowerSaving);
                     }
+                    if ((errorCode == 0) && (pCfgCell->version > 0) &&
+                        pCfgCell->warmAttach) {
+                        errorCode = uCellPwrSetWarmAttach(*pDeviceHandle, true);
+                    }
                     if (errorCode == 0) {
                         // Power on
                         errorCode = uCellPwrOn(*pDeviceHandle, pCfgCell->pSimPinCode,
                                                keepGoingCallback);
                     }
+                    if ((errorCode == 0) && (pCfgUart->version > 0) &&
+                        (pCfgUart->baudRateMax > pCfgUart->baudRate)) {
+                        // Move to a higher baud rate if we can; this
+                        // falls back to the current baud rate if it
+                        // fails so it is not an error if it does
+                        uCellCfgUpgradeBaudRate(*pDeviceHandle,
+                                                pCfgUart->baudRateMax);
+                    }
                     if (errorCode != 0) {
                         // If we failed to power on, clean up
                         removeDevice(*pDeviceHandle, false);
@@ -251,7 +264,7 @@ int32_t uDevicePrivateCellAdd(const uDeviceCfg_t *pDevCfg,
         (pDeviceHandle != NULL)) {
         pCfgUart = &(pDevCfg->transportCfg.cfgUart);
         pCfgCell = &(pDevCfg->deviceCfg.cfgCell);
-        if (pCfgCell->version == 0) {
+        if (pCfgCell->version <= 1) {
             errorCode = addDevice(pCfgUart, pCfgCell, pDeviceHandle);
         }
     }
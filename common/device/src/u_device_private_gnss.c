@@ -161,6 +161,14 @@ static int32_t addDevice(uGnssTransportHandle_t gnssTransportHandle,
                              gnssTransportType, gnssTransportHandle,
                              pCfgGnss->pinEnablePower, false,
                              pDeviceHandle);
+        if ((errorCode == 0) && (pCfgGnss->version > 0) &&
+            (pCfgGnss->ringBufferLengthBytes > 0)) {
+            errorCode = uGnssSetRingBufferLength(*pDeviceHandle,
+                                                 pCfgGnss->ringBufferLengthBytes);
+            if (errorCode != 0) {
+                uGnssRemove(*pDeviceHandle);
+            }
+        }
         if (errorCode == 0) {
             if (pCfgGnss->i2cAddress > 0) {
                 uGnssSetI2cAddress(*pDeviceHandle, pCfgGnss->i2cAddress);
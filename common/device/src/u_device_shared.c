@@ -30,6 +30,7 @@
 #include "string.h"    // for memset()
 
 #include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h" // U_CFG_OS_YIELD_MS
 #include "u_compiler.h" // for U_INLINE
 #include "u_error_common.h"
 
@@ -99,6 +100,10 @@ uDeviceInstance_t *pUDeviceCreateInstance(uDeviceType_t type)
 
     if (pInstance) {
         uDeviceInitInstance(pInstance, type);
+        if (uPortMutexCreate(&(pInstance->mutex)) != 0) {
+            uPortFree(pInstance);
+            pInstance = NULL;
+        }
     }
 
     return pInstance;
@@ -109,6 +114,9 @@ void uDeviceDestroyInstance(uDeviceInstance_t *pInstance)
     if (uDeviceIsValidInstance(pInstance)) {
         // Invalidate the instance
         pInstance->magic = 0;
+        if (pInstance->mutex != NULL) {
+            uPortMutexDelete(pInstance->mutex);
+        }
         uPortFree(pInstance);
     } else {
         uPortLog("U_DEVICE: Warning: trying to destroy an already"
@@ -138,6 +146,52 @@ int32_t uDeviceUnlock()
     return errorCode;
 }
 
+int32_t uDeviceInstanceLock(uDeviceHandle_t devHandle,
+                            uDeviceInstance_t **ppInstance)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    bool locked = false;
+
+    // Can't just wait on the device lock since the device might be
+    // closed, and its lock deleted, meanwhile; instead check that the
+    // device is still there and try the lock with the device API
+    // locked, which uDeviceClose() also has to lock
+    while ((gMutex != NULL) && !locked) {
+        U_PORT_MUTEX_LOCK(gMutex);
+        errorCode = uDeviceGetInstance(devHandle, ppInstance);
+        if (errorCode == 0) {
+            locked = ((*ppInstance)->mutex == NULL) ||
+                     (uPortMutexTryLock((*ppInstance)->mutex, 0) == 0);
+        }
+        U_PORT_MUTEX_UNLOCK(gMutex);
+        if (errorCode != 0) {
+            break;
+        }
+        if (!locked) {
+            uPortTaskBlock(U_CFG_OS_YIELD_MS);
+        }
+    }
+
+    return errorCode;
+}
+
+void uDeviceInstanceUnlock(uDeviceInstance_t *pInstance)
+{
+    if ((pInstance != NULL) && (pInstance->mutex != NULL)) {
+        uPortMutexUnlock(pInstance->mutex);
+    }
+}
+
+void uDeviceInstanceDrain(uDeviceInstance_t *pInstance)
+{
+    if ((pInstance != NULL) && (pInstance->mutex != NULL)) {
+        // No-one else can take the lock once we have it since
+        // the device API is locked
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
+    }
+}
+
 U_INLINE void uDeviceInitInstance(uDeviceInstance_t *pInstance,
                                   uDeviceType_t type)
 {
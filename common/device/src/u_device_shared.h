@@ -23,6 +23,7 @@
  * please keep #includes to your .c files. */
 
 #include "u_device.h"
+#include "u_port_os.h" // uPortMutexHandle_t
 
 /** @file
  * @brief Functions for initializing a u-blox device (chip or module),
@@ -32,6 +33,12 @@
  * are not thread-safe. They are intended to be called in-sequence by
  * the implementations of ubxlib API functions within a
  * uDeviceLock()/uDeviceUnlock() pair to guarantee thread-safety.
+ *
+ * Something that works on a single device for a long time, e.g.
+ * bringing up a network, should instead hold the lock of that
+ * device, see uDeviceInstanceLock(), so that work on other devices
+ * can carry on meanwhile; the device API lock is then only held
+ * by the opening and closing of devices.
  */
 
 #ifdef __cplusplus
@@ -83,7 +90,16 @@ typedef struct {
     uDeviceType_t deviceType;   /**< type of device. */
     int32_t moduleType;         /**< module identification (when applicable). */
     void *pContext;             /**< private instance data for the device. */
+    void *pPrivateInstance;     /**< the private instance of the driver
+                                     API behind the device, where that
+                                     API keeps one, set when the device
+                                     is added to it so that the instance
+                                     can be found without searching. */
     uDeviceNetworkData_t networkData[U_DEVICE_NETWORKS_MAX_NUM]; /**< network cfg and private data. */
+    uPortMutexHandle_t mutex;   /**< the lock of this device, see
+                                     uDeviceInstanceLock(); NULL
+                                     if the instance was not created
+                                     with pUDeviceCreateInstance(). */
     // Note: In the future structs of function pointers for socket, MQTT etc.
     // implementations may be added here.
 } uDeviceInstance_t;
@@ -142,6 +158,42 @@ int32_t uDeviceLock();
  */
 int32_t uDeviceUnlock();
 
+/** Lock a device: while a device is locked no other task can lock
+ * it and it cannot be closed, but the device API itself is not
+ * locked, so work on other devices may carry on.  This must NOT be
+ * called with the device API locked, and uDeviceLock() must not be
+ * called while holding the lock of a device, since uDeviceClose()
+ * holds the device API lock while waiting for the lock of the
+ * device it is closing.  The device locks are not recursive.  If
+ * the device is locked by another task this waits, polling, until
+ * it is released or the device has been closed.  An instance that
+ * was not created by pUDeviceCreateInstance() has no lock, in which
+ * case this only validates the handle.
+ *
+ * @param devHandle       the device handle.
+ * @param[out] ppInstance a place to put the device instance, cannot
+ *                        be NULL.
+ * @return                zero on success else negative error code,
+ *                        for instance if the handle is not, or is
+ *                        no longer, valid.
+ */
+int32_t uDeviceInstanceLock(uDeviceHandle_t devHandle,
+                            uDeviceInstance_t **ppInstance);
+
+/** Unlock a device that was locked with uDeviceInstanceLock().
+ *
+ * @param[in] pInstance the device instance, as returned by
+ *                      uDeviceInstanceLock().
+ */
+void uDeviceInstanceUnlock(uDeviceInstance_t *pInstance);
+
+/** Wait for a device to be unlocked; called by uDeviceClose(), with
+ * the device API locked, before the instance is destroyed.
+ *
+ * @param[in] pInstance the device instance.
+ */
+void uDeviceInstanceDrain(uDeviceInstance_t *pInstance);
+
 /** Initialize a device instance. This is useful when
  * pUDeviceCreateInstance() is not used and the
  * uDeviceInstance_t is allocated manually.
@@ -51,6 +51,7 @@
 #include "u_test_util_resource_check.h"
 
 #include "u_interface.h"
+#include "u_device.h"
 #include "u_device_serial.h"
 
 /* ----------------------------------------------------------------
@@ -144,6 +145,34 @@ static uDeviceSerial_t *gpDeviceSerial = NULL;
 
 #endif
 
+/** The number of times openStartCallback() has been called.
+ */
+static volatile int32_t gOpenStartCallCount = 0;
+
+/** The error code passed to openStartCallback().
+ */
+static volatile int32_t gOpenStartErrorCode = 0;
+
+/** The device handle passed to openStartCallback().
+ */
+static volatile uDeviceHandle_t gOpenStartDevHandle = NULL;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Callback for uDeviceOpenStart().
+static void openStartCallback(uDeviceHandle_t devHandle,
+                              int32_t errorCode,
+                              void *pCallbackParam)
+{
+    gOpenStartDevHandle = devHandle;
+    gOpenStartErrorCode = errorCode;
+    if (pCallbackParam == (void *) &gOpenStartCallCount) {
+        gOpenStartCallCount++;
+    }
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: FOR THE SERIAL INTERFACE TEST
  * -------------------------------------------------------------- */
@@ -491,4 +520,58 @@ U_PORT_TEST_FUNCTION("[device]", "deviceSerialCleanup")
 
 #endif
 
+/** Test the parameter checking and the completion callback of
+ * uDeviceOpenStart(); opening a real device is tested by the
+ * network tests.
+ */
+U_PORT_TEST_FUNCTION("[device]", "deviceOpenStart")
+{
+    uDeviceCfg_t deviceCfg = {0};
+    int32_t resourceCount;
+    int32_t startTimeMs;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uDeviceInit() == 0);
+
+    // Bad parameters are rejected at once, with no callback
+    U_PORT_TEST_ASSERT(uDeviceOpenStart(NULL, openStartCallback, NULL) < 0);
+    deviceCfg.deviceType = U_DEVICE_TYPE_CELL;
+    U_PORT_TEST_ASSERT(uDeviceOpenStart(&deviceCfg, NULL, NULL) < 0);
+
+    // A device type that cannot be opened fails in the task
+    // and the failure is passed to the callback
+    deviceCfg.deviceType = U_DEVICE_TYPE_NONE;
+    gOpenStartCallCount = 0;
+    gOpenStartErrorCode = 0;
+    gOpenStartDevHandle = (uDeviceHandle_t) &deviceCfg;
+    U_PORT_TEST_ASSERT(uDeviceOpenStart(&deviceCfg, openStartCallback,
+                                        (void *) &gOpenStartCallCount) == 0);
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gOpenStartCallCount == 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < 5000)) {
+        uPortTaskBlock(10);
+    }
+    U_TEST_PRINT_LINE("uDeviceOpenStart() callback called %d time(s),"
+                      " error code %d.", gOpenStartCallCount, gOpenStartErrorCode);
+    U_PORT_TEST_ASSERT(gOpenStartCallCount == 1);
+    U_PORT_TEST_ASSERT(gOpenStartErrorCode == (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(gOpenStartDevHandle == NULL);
+
+    // uDeviceDeinit() waits for the task to have gone
+    uDeviceDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 // End of file
\ No newline at end of file
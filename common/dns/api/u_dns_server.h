@@ -56,9 +56,34 @@ typedef bool (*uDnsKeepGoingCallback_t)(uDeviceHandle_t deviceHandle);
  * FUNCTIONS
  * -------------------------------------------------------------- */
 
+/** Open the socket of a DNS server on the supplied device, for
+ * an application that runs its own event loop: add the returned
+ * descriptor to the read set passed to uSockSelect() and, when it
+ * is unblocked, call uDnsServerProcess().  Close the server with
+ * uSockClose().
+ *
+ * @param deviceHandle the handle of the network device instance.
+ * @return             on success the descriptor of the non-blocking
+ *                     DNS server socket, else negative error code.
+ */
+int32_t uDnsServerOpen(uDeviceHandle_t deviceHandle);
+
+/** Answer all of the requests waiting on a socket opened with
+ * uDnsServerOpen(), directing every lookup to the specified ipv4
+ * address; this does not block.
+ *
+ * @param sock        the descriptor returned by uDnsServerOpen().
+ * @param[in] pIpAddr the address for all lookups.
+ * @return            the number of requests answered, else
+ *                    negative error code.
+ */
+int32_t uDnsServerProcess(int32_t sock, const char *pIpAddr);
+
 /** Create a DNS server on the supplied device. All requests
  * will then be directed to the specified ipv4 address.
- * The server is intended to run in a separate process thread.
+ * The server is intended to run in a separate process thread;
+ * if you already have an event loop, use uDnsServerOpen() and
+ * uDnsServerProcess() instead.
  *
  * @param deviceHandle the handle of the network device instance.
  * @param[in] pIpAddr  the address for all lookups
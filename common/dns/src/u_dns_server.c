@@ -53,6 +53,7 @@
 #include "u_sock.h"
 
 #include "u_dns_server.h"
+#include "u_dns_server_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -63,6 +64,13 @@
 # define U_DNS_TTL 600
 #endif
 
+#ifndef U_DNS_SERVER_SELECT_TIMEOUT_MS
+/** How long uDnsServer() waits for a request before checking its
+ * keep-going callback again.
+ */
+# define U_DNS_SERVER_SELECT_TIMEOUT_MS 100
+#endif
+
 #define DNS_QR_QUERY      0
 #define DNS_QR_RESPONSE   1
 #define DNS_OPCODE_QUERY  0
@@ -130,130 +138,187 @@ static uint32_t htonl(uint32_t x)
 }
 
 /* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS
+ * PUBLIC FUNCTIONS THAT ARE PRIVATE TO UBXLIB
  * -------------------------------------------------------------- */
 
-int32_t uDnsServer(uDeviceHandle_t deviceHandle,
-                   const char *pIpAddr,
-                   uDnsKeepGoingCallback_t cb)
+// Build, in place in pBuff, the response to the DNS request of
+// length requestLength bytes that pBuff contains, mapping any name
+// to netAddr; returns the length of the response to send, zero if
+// there is nothing to send.
+size_t uDnsServerPrivateBuildResponse(uint8_t *pBuff, size_t buffSize,
+                                      size_t requestLength, uint32_t netAddr)
 {
-    uSockAddress_t lookupAddr;
-    uSockStringToAddress(pIpAddr, &lookupAddr);
-    // Address in network endian format
-    uint32_t netAddr = htonl(lookupAddr.ipAddress.address.ipv4);
+    size_t responseLength = 0;
     uint8_t netAddrLen = sizeof(netAddr);
     // Time to live for the response in seconds
     uint32_t ttl = htonl(U_DNS_TTL);
 
+    if (requestLength > sizeof(uDnsHeader_t)) {
+        // Incoming request
+        uDnsHeader_t *pHeader = (uDnsHeader_t *)pBuff;
+        bool valid =
+            pHeader->QR == DNS_QR_QUERY &&
+            pHeader->OPCode == DNS_OPCODE_QUERY &&
+            ntohs(pHeader->QDCount) == 1 &&
+            pHeader->ANCount == 0 &&
+            pHeader->NSCount == 0 &&
+            pHeader->ARCount == 0;
+        if (valid) {
+            // Create a response which maps any requested name
+            // to the address specified by pIpAddr
+            pHeader->QR = DNS_QR_RESPONSE;
+            pHeader->ANCount = pHeader->QDCount;
+            uint8_t *pData = pBuff + sizeof(uDnsHeader_t);
+            // Need to parse the query name even if it is ignored
+            // in order to get the correct position for the response ip.
+            // Also print the name for debugging purposes.
+            char name[100];
+            memset(name, 0, sizeof(name));
+            int32_t remain = requestLength - sizeof(uDnsHeader_t);
+            while (remain > 0 && *pData != 0) {
+                uint8_t len = *pData + 1;
+                if (len > remain) {
+                    valid = false;
+                    break;
+                }
+                if (sizeof(name) - strlen(name) > len) {
+                    strncat(name, (char *)(pData + 1), len - 1);
+                    strcat(name, ".");
+                }
+                remain -= len;
+                pData += len;
+            }
+            if (strlen(name)) {
+                name[strlen(name) - 1] = 0;
+            }
+            if (valid) {
+                uPortLog("U_DNS lookup: %s\n", name);
+            }
+
+            // Make sure we have space for the address as well in the buffer
+            valid = valid && (((pData - pBuff) + 21) < buffSize);
+
+            if (valid) {
+                // Skip remaining
+                pData += 5;
+                // Answer name is a pointer
+                *(pData++) = 0xC0;
+                // Pointer is to the name at offset
+                *(pData++) = 0x0C;
+                // Answer is type A query (host address)
+                *(pData++) = 0;
+                *(pData++) = 1;
+                // Answer is class IN (Internet address)
+                *(pData++) = 0;
+                *(pData++) = 1;
+                // TTL
+                memcpy(pData, (uint8_t *)&ttl, sizeof(ttl));
+                pData += sizeof(ttl);
+                // The fixed lookup address
+                *(pData++) = 0;
+                *(pData++) = netAddrLen;
+                memcpy(pData, (uint8_t *)&netAddr, netAddrLen);
+                pData += netAddrLen;
+                responseLength = pData - pBuff;
+            }
+        }
+        if (!valid) {
+            // Send an error response
+            int32_t dnsError =
+                pHeader->OPCode != DNS_OPCODE_QUERY ?
+                DNS_NOTIMPL_ERROR :
+                DNS_FORM_ERROR;
+            pHeader->QR = DNS_QR_RESPONSE;
+            pHeader->RCode = (unsigned char)dnsError;
+            pHeader->QDCount = 0;
+            pHeader->ANCount = 0;
+            pHeader->NSCount = 0;
+            pHeader->ARCount = 0;
+            uPortLog("U_DNS: Unhandled request: %d\n", dnsError);
+            responseLength = sizeof(uDnsHeader_t);
+        }
+    }
+
+    return responseLength;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Open the DNS server socket.
+int32_t uDnsServerOpen(uDeviceHandle_t deviceHandle)
+{
+    uSockAddress_t localAddr;
     int32_t sock = uSockCreate(deviceHandle,
                                U_SOCK_TYPE_DGRAM,
                                U_SOCK_PROTOCOL_UDP);
-    if (sock < 0) {
+    if (sock >= 0) {
+        uSockBlockingSet(sock, false);
+        memset(&localAddr, 0, sizeof(localAddr));
+        localAddr.port = 53;
+        uSockBind(sock, &localAddr);
+        uPortLog("U_DNS: server started\n");
+    } else {
         uPortLog("U_DNS: Failed to create DNS server socket: %d\n", sock);
-        return sock;
     }
-    uSockBlockingSet(sock, false);
+
+    return sock;
+}
+
+// Answer all of the DNS requests waiting on the server socket.
+int32_t uDnsServerProcess(int32_t sock, const char *pIpAddr)
+{
+    int32_t errorCodeOrNum = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uSockAddress_t lookupAddr;
     uSockAddress_t remoteAddr;
     uint8_t buff[255];
-    remoteAddr.ipAddress.address.ipv4 = 0;
-    remoteAddr.port = 53;
-    uSockBind(sock, &remoteAddr);
-    memset(buff, 0, sizeof(buff));
-    uPortLog("U_DNS: server started\n");
-    while (true) {
-        int32_t errOrCnt = uSockReceiveFrom(sock,
-                                            &remoteAddr,
-                                            buff,
-                                            sizeof(buff));
-        if (errOrCnt > (int32_t)sizeof(uDnsHeader_t)) {
-            // Incoming request
-            uDnsHeader_t *pHeader = (uDnsHeader_t *)buff;
-            bool valid =
-                pHeader->QR == DNS_QR_QUERY &&
-                pHeader->OPCode == DNS_OPCODE_QUERY &&
-                ntohs(pHeader->QDCount) == 1 &&
-                pHeader->ANCount == 0 &&
-                pHeader->NSCount == 0 &&
-                pHeader->ARCount == 0;
-            if (valid) {
-                // Create a response which maps any requested name
-                // to the address specified by pIpAddr
-                pHeader->QR = DNS_QR_RESPONSE;
-                pHeader->ANCount = pHeader->QDCount;
-                uint8_t *pData = buff + sizeof(uDnsHeader_t);
-                // Need to parse the query name even if it is ignored
-                // in order to get the correct position for the response ip.
-                // Also print the name for debugging purposes.
-                char name[100];
-                memset(name, 0, sizeof(name));
-                int32_t remain = errOrCnt - sizeof(uDnsHeader_t);
-                while (remain > 0 && *pData != 0) {
-                    uint8_t len = *pData + 1;
-                    if (len > remain) {
-                        valid = false;
-                        break;
-                    }
-                    if (sizeof(name) - strlen(name) > len) {
-                        strncat(name, (char *)(pData + 1), len - 1);
-                        strcat(name, ".");
-                    }
-                    remain -= len;
-                    pData += len;
-                }
-                if (strlen(name)) {
-                    name[strlen(name) - 1] = 0;
-                }
-                if (valid) {
-                    uPortLog("U_DNS lookup: %s\n", name);
-                }
+    int32_t errOrCnt;
+    size_t responseLength;
 
-                // Make sure we have space for the address as well in the buffer
-                valid = valid && (((pData - buff) + 21) < sizeof(buff));
-
-                if (valid) {
-                    // Skip remaining
-                    pData += 5;
-                    // Answer name is a pointer
-                    *(pData++) = 0xC0;
-                    // Pointer is to the name at offset
-                    *(pData++) = 0x0C;
-                    // Answer is type A query (host address)
-                    *(pData++) = 0;
-                    *(pData++) = 1;
-                    // Answer is class IN (Internet address)
-                    *(pData++) = 0;
-                    *(pData++) = 1;
-                    // TTL
-                    memcpy(pData, (uint8_t *)&ttl, sizeof(ttl));
-                    pData += sizeof(ttl);
-                    // The fixed lookup address
-                    *(pData++) = 0;
-                    *(pData++) = netAddrLen;
-                    memcpy(pData, (uint8_t *)&netAddr, netAddrLen);
-                    pData += netAddrLen;
-                    uSockSendTo(sock, &remoteAddr, buff, pData - buff);
+    if ((sock >= 0) && (pIpAddr != NULL) &&
+        (uSockStringToAddress(pIpAddr, &lookupAddr) == 0)) {
+        errorCodeOrNum = 0;
+        // Address in network endian format
+        uint32_t netAddr = htonl(lookupAddr.ipAddress.address.ipv4);
+        do {
+            errOrCnt = uSockReceiveFrom(sock, &remoteAddr,
+                                        buff, sizeof(buff));
+            if (errOrCnt > 0) {
+                responseLength = uDnsServerPrivateBuildResponse(buff, sizeof(buff),
+                                                                errOrCnt, netAddr);
+                if (responseLength > 0) {
+                    uSockSendTo(sock, &remoteAddr, buff, responseLength);
+                    errorCodeOrNum++;
                 }
             }
-            if (!valid) {
-                // Send an error response
-                int32_t dnsError =
-                    pHeader->OPCode != DNS_OPCODE_QUERY ?
-                    DNS_NOTIMPL_ERROR :
-                    DNS_FORM_ERROR;
-                pHeader->QR = DNS_QR_RESPONSE;
-                pHeader->RCode = (unsigned char)dnsError;
-                pHeader->QDCount = 0;
-                pHeader->ANCount = 0;
-                pHeader->NSCount = 0;
-                pHeader->ARCount = 0;
-                uPortLog("U_DNS: Unhandled request: %d\n", dnsError);
-                uSockSendTo(sock, &remoteAddr, pHeader, sizeof(uDnsHeader_t));
+        } while (errOrCnt > 0);
+    }
+
+    return errorCodeOrNum;
+}
+
+int32_t uDnsServer(uDeviceHandle_t deviceHandle,
+                   const char *pIpAddr,
+                   uDnsKeepGoingCallback_t cb)
+{
+    uSockDescriptorSet_t readSet;
+    int32_t sock = uDnsServerOpen(deviceHandle);
+
+    if (sock >= 0) {
+        do {
+            // Wait for a request to arrive rather than polling
+            U_SOCK_FD_ZERO(&readSet);
+            U_SOCK_FD_SET(sock, &readSet);
+            if (uSockSelect(sock + 1, &readSet, NULL, NULL,
+                            U_DNS_SERVER_SELECT_TIMEOUT_MS) > 0) {
+                uDnsServerProcess(sock, pIpAddr);
             }
-        }
-        uPortTaskBlock(100);
-        if (cb != NULL && !cb(deviceHandle)) {
-            break;
-        }
+        } while ((cb == NULL) || cb(deviceHandle));
+        sock = uSockClose(sock);
     }
-    return uSockClose(sock);
+
+    return sock;
 }
+
+// End of file
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_DNS_SERVER_PRIVATE_H_
+#define _U_DNS_SERVER_PRIVATE_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** @file
+ * @brief This header file defines functions of the DNS server
+ * that are internal to ubxlib; they are made available this way
+ * so that they can be tested on their own.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Build, in place, the response to a DNS request: a valid query
+ * for a single name is answered with an A record of the given
+ * address, anything else with an error response consisting of
+ * just the header.
+ *
+ * @param[in,out] pBuff  on entry the request, on return the
+ *                       response; cannot be NULL.
+ * @param buffSize       the size of the buffer at pBuff.
+ * @param requestLength  the length of the request in pBuff.
+ * @param netAddr        the IPV4 address to answer with, in
+ *                       network byte order.
+ * @return               the length of the response in pBuff,
+ *                       zero if the request is too short to be
+ *                       answered at all.
+ */
+size_t uDnsServerPrivateBuildResponse(uint8_t *pBuff, size_t buffSize,
+                                      size_t requestLength, uint32_t netAddr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_DNS_SERVER_PRIVATE_H_
+
+// End of file
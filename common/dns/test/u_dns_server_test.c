@@ -0,0 +1,193 @@
+/*
+ * Copyright 2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Test for the DNS server: the building of responses is
+ * tested on its own, so no network device is required.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memcpy(), memcmp()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_dns_server_private.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_DNS_SERVER_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The length of the DNS header.
+ */
+#define U_DNS_SERVER_TEST_HEADER_LENGTH 12
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** A query for the A record of "example.com", ID 0x1234, recursion
+ * desired.
+ */
+static const uint8_t gQuery[] = {
+    0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+    0x00, 0x01, 0x00, 0x01
+};
+
+/** The answer that the DNS server should append to gQuery, the
+ * address being 192.168.1.2 with a time to live of 600 seconds.
+ */
+static const uint8_t gAnswer[] = {
+    0xc0, 0x0c, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x02, 0x58,
+    0x00, 0x04, 192, 168, 1, 2
+};
+
+/** The address to answer with, in network byte order.
+ */
+static const uint8_t gAddress[] = {192, 168, 1, 2};
+
+/** Buffer for requests and responses.
+ */
+static uint8_t gBuffer[128];
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Check that gBuffer holds an error response, just a header, to
+// the query with ID 0x1234 with the given response code.
+static bool isErrorResponse(size_t length, uint8_t responseCode)
+{
+    bool isError = (length == U_DNS_SERVER_TEST_HEADER_LENGTH) &&
+                   (gBuffer[0] == 0x12) && (gBuffer[1] == 0x34) &&
+                   ((gBuffer[2] & 0x80) != 0) && ((gBuffer[3] & 0x0f) == responseCode);
+
+    // All of the counts must be zero
+    for (size_t x = 4; isError && (x < U_DNS_SERVER_TEST_HEADER_LENGTH); x++) {
+        isError = (gBuffer[x] == 0);
+    }
+
+    return isError;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TESTS
+ * -------------------------------------------------------------- */
+
+/** Build responses to good and bad DNS requests.
+ */
+U_PORT_TEST_FUNCTION("[dnsServer]", "dnsServerBuildResponse")
+{
+    int32_t heapAllocCount = uPortHeapAllocCount();
+    uint32_t netAddr;
+    size_t length;
+
+    memcpy(&netAddr, gAddress, sizeof(netAddr));
+
+    // A good query is answered with the address, the question
+    // being kept and the header becoming that of a response
+    // with one answer
+    memcpy(gBuffer, gQuery, sizeof(gQuery));
+    length = uDnsServerPrivateBuildResponse(gBuffer, sizeof(gBuffer),
+                                            sizeof(gQuery), netAddr);
+    U_TEST_PRINT_LINE("response to a good query is %d byte(s).", (int) length);
+    U_PORT_TEST_ASSERT(length == sizeof(gQuery) + sizeof(gAnswer));
+    U_PORT_TEST_ASSERT((gBuffer[0] == 0x12) && (gBuffer[1] == 0x34));
+    U_PORT_TEST_ASSERT(gBuffer[2] == 0x81);
+    U_PORT_TEST_ASSERT((gBuffer[3] & 0x0f) == 0);
+    U_PORT_TEST_ASSERT((gBuffer[4] == 0) && (gBuffer[5] == 1));
+    U_PORT_TEST_ASSERT((gBuffer[6] == 0) && (gBuffer[7] == 1));
+    U_PORT_TEST_ASSERT(memcmp(gBuffer + 8, gQuery + 8, sizeof(gQuery) - 8) == 0);
+    U_PORT_TEST_ASSERT(memcmp(gBuffer + sizeof(gQuery), gAnswer, sizeof(gAnswer)) == 0);
+
+    // Too short to have a question: nothing to send
+    memcpy(gBuffer, gQuery, sizeof(gQuery));
+    U_PORT_TEST_ASSERT(uDnsServerPrivateBuildResponse(gBuffer, sizeof(gBuffer),
+                                                      U_DNS_SERVER_TEST_HEADER_LENGTH,
+                                                      netAddr) == 0);
+
+    // A response rather than a query is a format error
+    memcpy(gBuffer, gQuery, sizeof(gQuery));
+    gBuffer[2] |= 0x80;
+    length = uDnsServerPrivateBuildResponse(gBuffer, sizeof(gBuffer),
+                                            sizeof(gQuery), netAddr);
+    U_PORT_TEST_ASSERT(isErrorResponse(length, 1));
+
+    // As is more than one question
+    memcpy(gBuffer, gQuery, sizeof(gQuery));
+    gBuffer[5] = 2;
+    length = uDnsServerPrivateBuildResponse(gBuffer, sizeof(gBuffer),
+                                            sizeof(gQuery), netAddr);
+    U_PORT_TEST_ASSERT(isErrorResponse(length, 1));
+
+    // An opcode other than query is not implemented
+    memcpy(gBuffer, gQuery, sizeof(gQuery));
+    gBuffer[2] |= 0x10;
+    length = uDnsServerPrivateBuildResponse(gBuffer, sizeof(gBuffer),
+                                            sizeof(gQuery), netAddr);
+    U_PORT_TEST_ASSERT(isErrorResponse(length, 4));
+
+    // A label running off the end of the request is a format error
+    memcpy(gBuffer, gQuery, sizeof(gQuery));
+    gBuffer[U_DNS_SERVER_TEST_HEADER_LENGTH] = 100;
+    length = uDnsServerPrivateBuildResponse(gBuffer, sizeof(gBuffer),
+                                            sizeof(gQuery), netAddr);
+    U_PORT_TEST_ASSERT(isErrorResponse(length, 1));
+
+    // As is a buffer with no room for the answer
+    memcpy(gBuffer, gQuery, sizeof(gQuery));
+    length = uDnsServerPrivateBuildResponse(gBuffer, sizeof(gQuery) + 4,
+                                            sizeof(gQuery), netAddr);
+    U_PORT_TEST_ASSERT(isErrorResponse(length, 1));
+
+    // Check that we haven't leaked any heap
+    U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+}
+
+// End of file
@@ -65,6 +65,70 @@ extern "C" {
 # define U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES (64 + 1)
 #endif
 
+#ifndef U_HTTP_CLIENT_ETAG_LENGTH_BYTES
+/** The maximum length of an ETag, including its quotes and room
+ * for a null-terminator; a longer ETag is treated as absent.
+ */
+# define U_HTTP_CLIENT_ETAG_LENGTH_BYTES (64 + 1)
+#endif
+
+#ifndef U_HTTP_CLIENT_ETAG_PATH_LENGTH_BYTES
+/** The maximum length of a path for which
+ * uHttpClientGetRequestConditional() can remember an ETag,
+ * including room for a null-terminator.
+ */
+# define U_HTTP_CLIENT_ETAG_PATH_LENGTH_BYTES (128 + 1)
+#endif
+
+#ifndef U_HTTP_CLIENT_ETAG_CACHE_NUM_ENTRIES
+/** The number of paths for which a context remembers the ETag,
+ * see uHttpClientGetRequestConditional().
+ */
+# define U_HTTP_CLIENT_ETAG_CACHE_NUM_ENTRIES 4
+#endif
+
+#ifndef U_HTTP_CLIENT_HEADER_LINE_LENGTH_BYTES
+/** The longest header line that uHttpClientHeaderParse() keeps in
+ * full; only the start of a longer line is examined.
+ */
+# define U_HTTP_CLIENT_HEADER_LINE_LENGTH_BYTES 128
+#endif
+
+#ifndef U_HTTP_CLIENT_REQUEST_QUEUE_LENGTH
+/** The number of requests that may be waiting in the queue of
+ * a context, see uHttpClientGetRequestQueue().
+ */
+# define U_HTTP_CLIENT_REQUEST_QUEUE_LENGTH 8
+#endif
+
+#ifndef U_HTTP_CLIENT_REQUEST_QUEUE_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that carries out queued requests;
+ * the request callbacks are called from this task.
+ */
+# define U_HTTP_CLIENT_REQUEST_QUEUE_TASK_STACK_SIZE_BYTES 2560
+#endif
+
+#ifndef U_HTTP_CLIENT_REQUEST_QUEUE_TASK_PRIORITY
+/** The priority of the task that carries out queued requests.
+ */
+# define U_HTTP_CLIENT_REQUEST_QUEUE_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
+#ifndef U_HTTP_CLIENT_SEGMENTED_RETRIES_MAX
+/** The number of requests of uHttpClientGetRequestSegmented() that
+ * may fail one after the other, with no data at all being received
+ * in between, before uHttpClientGetRequestSegmented() gives up.
+ */
+# define U_HTTP_CLIENT_SEGMENTED_RETRIES_MAX 5
+#endif
+
+#ifndef U_HTTP_CLIENT_SEGMENTED_CONTEXTS_MAX_NUM
+/** The maximum number of contexts that uHttpClientGetRequestSegmented()
+ * can use at once.
+ */
+# define U_HTTP_CLIENT_SEGMENTED_CONTEXTS_MAX_NUM 4
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -100,6 +164,106 @@ typedef void (uHttpClientResponseCallback_t)(uDeviceHandle_t devHandle,
                                              size_t responseSize,
                                              void *pResponseCallbackParam);
 
+/** Callback that will be called with each chunk of the HTTP response
+ * body by uHttpClientGetRequestStream().
+ *
+ * @param devHandle                     the device handle.
+ * @param[in] pData                     the chunk of the body; only valid
+ *                                      for the duration of the call.
+ * @param size                          the number of bytes at pData.
+ * @param[in,out] pStreamCallbackParam  the pStreamCallbackParam pointer
+ *                                      that was passed to
+ *                                      uHttpClientGetRequestStream().
+ * @return                              true to carry on, false to stop
+ *                                      reading the body.
+ */
+typedef bool (uHttpClientStreamCallback_t)(uDeviceHandle_t devHandle,
+                                           const char *pData,
+                                           size_t size,
+                                           void *pStreamCallbackParam);
+
+/** Callback that will be called by uHttpClientHeaderParse() with
+ * each header of an HTTP response, so that headers other than those
+ * it extracts itself may be picked out.
+ *
+ * @param[in] pName       the null-terminated name of the header, e.g.
+ *                        "Cache-Control", as received; HTTP header
+ *                        names are not case sensitive.
+ * @param[in] pValue      the null-terminated value of the header,
+ *                        without leading or trailing white space;
+ *                        truncated if the header line is longer than
+ *                        #U_HTTP_CLIENT_HEADER_LINE_LENGTH_BYTES.
+ * @param[in,out] pParam  the pCallbackParam pointer that was passed
+ *                        to uHttpClientHeaderParserInit().
+ */
+typedef void (uHttpClientHeaderCallback_t)(const char *pName,
+                                           const char *pValue,
+                                           void *pParam);
+
+/** The state of a streaming parser of the status line and headers
+ * of an HTTP response, see uHttpClientHeaderParse().  The results
+ * may be read once done is true.
+ */
+typedef struct {
+    int32_t statusCode;      /**< the status code, e.g. 200; -1 if the
+                                  status line was not valid. */
+    int32_t contentLength;   /**< the value of the Content-Length
+                                  header, -1 if there was none. */
+    char eTag[U_HTTP_CLIENT_ETAG_LENGTH_BYTES]; /**< the value of the ETag
+                                                     header, including its
+                                                     quotes, empty if there
+                                                     was none. */
+    size_t statusLineLength; /**< the length of the status line,
+                                  including its line ending. */
+    size_t headerLength;     /**< the length of the status line and all
+                                  the headers, including the blank line
+                                  at the end, i.e. the offset of the body. */
+    bool done;               /**< true once the blank line at the end of
+                                  the headers has been parsed. */
+    char *pContentType;      /* the rest is internal; the place to put
+                                the content type, may be NULL. */
+    uHttpClientHeaderCallback_t *pCallback;
+    void *pCallbackParam;
+    char line[U_HTTP_CLIENT_HEADER_LINE_LENGTH_BYTES + 1];
+    size_t lineLength;
+    bool lineTruncated;
+} uHttpClientHeaderParser_t;
+
+/** Callback that will be called with each chunk of a resource
+ * fetched by uHttpClientGetRequestSegmented().  For any one segment
+ * the chunks arrive in order but chunks of different segments may
+ * be interleaved, hence the offset.
+ *
+ * @param devHandle        the device handle of the context that
+ *                         received the chunk.
+ * @param offset           the offset of pData in the resource.
+ * @param[in] pData        the chunk; only valid for the duration of
+ *                         the call.
+ * @param size             the number of bytes at pData.
+ * @param[in,out] pParam   the pCallbackParam pointer that was passed
+ *                         to uHttpClientGetRequestSegmented().
+ * @return                 true to carry on, false to stop the download.
+ */
+typedef bool (uHttpClientSegmentCallback_t)(uDeviceHandle_t devHandle,
+                                            size_t offset,
+                                            const char *pData,
+                                            size_t size,
+                                            void *pParam);
+
+/** A segment of a resource, as fetched by
+ * uHttpClientGetRequestSegmented(); usually populated by
+ * uHttpClientSegmentsInit().
+ */
+typedef struct {
+    size_t offset;   /**< the offset of the segment in the resource. */
+    size_t length;   /**< the length of the segment. */
+    size_t received; /**< the number of bytes of the segment that
+                          have been received, zero to begin with;
+                          this is the checkpoint which, if the
+                          segments are persisted, allows a download
+                          to be resumed after a restart. */
+} uHttpClientSegment_t;
+
 /** HTTP client connection information.  Note that the maximum length
  * of the string fields may differ between modules.
  * NOTE: if this structure is modified be sure to modify
@@ -192,7 +356,8 @@ typedef struct {
     void *semaphoreHandle; /* no 'p' prefix as this should be treated as a handle,
                               not using actual type to avoid customer having to drag
                               more headers in for what is an internal structure. */
-    int32_t eventQueueHandle;
+    int32_t eventQueueHandle; /* the queue of uHttpClientXxxRequestQueue(), -1 if not open. */
+    bool eventQueueClosing;   /* set while uHttpClientClose() cancels queued requests. */
     int32_t lastRequestTimeMs;
     void *pPriv; /* underlying HTTP implementation may use this void pointer
                     to hold the reference to the internal data structures. */
@@ -206,6 +371,10 @@ typedef struct {
     char *pResponse;       /* set when a HTTP POST, GET or HEAD is being carried out. */
     size_t *pResponseSize; /* set when a HTTP POST, GET or HEAD is being carried out. */
     char *pContentType;    /* set when a HTTP POST or GET is being carried out. */
+    uHttpClientStreamCallback_t *pStreamCallback; /* set when a streamed HTTP GET is being carried out. */
+    void *pStreamCallbackParam;                   /* set when a streamed HTTP GET is being carried out. */
+    size_t *pStreamOffset; /* set when a resumed streamed HTTP GET is being carried out. */
+    size_t streamEndOffset; /* set when a ranged streamed HTTP GET is being carried out. */
 } uHttpClientContext_t;
 
 /* ----------------------------------------------------------------
@@ -255,7 +424,10 @@ uHttpClientContext_t *pUHttpClientOpen(uDeviceHandle_t devHandle,
 int32_t uHttpClientOpenResetLastError();
 
 /** Close the given HTTP client session; will wait for any HTTP
- * request that is currently running to end.
+ * request that is currently running to end.  Requests still
+ * queued by uHttpClientGetRequestQueue() or
+ * uHttpClientPostRequestQueue() have their callbacks called with
+ * #U_ERROR_COMMON_CANCELLED before this function returns.
  *
  * @param[in] pContext   a pointer to the internal HTTP context
  *                       structure that was originally returned by
@@ -426,6 +598,334 @@ int32_t uHttpClientGetRequest(uHttpClientContext_t *pContext,
                               char *pResponseBody, size_t *pSize,
                               char *pContentType);
 
+/** Make an HTTP GET request, passing the response body to a callback
+ * in chunks rather than copying it into one buffer, so that a large
+ * response never needs a response-sized buffer in RAM.  Otherwise
+ * this behaves exactly as uHttpClientGetRequest(); in particular, it
+ * blocks unless pResponseCallback was given in the pConnection
+ * structure passed to pUHttpClientOpen(), in which case the
+ * responseSize passed to pResponseCallback is the number of body
+ * bytes that were passed to pStreamCallback.  Only supported for
+ * cellular.  On cellular the response is first stored in the file
+ * system of the module and is then read back in chunks of
+ * U_HTTP_CLIENT_CELL_FILE_CHUNK_LENGTH bytes, using a temporary
+ * buffer of that size.
+ *
+ * @param[in] pContext             a pointer to the internal HTTP context
+ *                                 structure that was originally returned by
+ *                                 pUHttpClientOpen().
+ * @param[in] pPath                the null-terminated path on the HTTP server
+ *                                 to GET the data from; cannot be NULL.
+ * @param[in] pStreamCallback      the function to call with each chunk
+ *                                 of the response body; it is called from
+ *                                 the task that handles the module's HTTP
+ *                                 indications and hence should not block
+ *                                 for long.  Cannot be NULL.
+ * @param[in] pStreamCallbackParam a parameter to pass to pStreamCallback;
+ *                                 may be NULL.
+ * @param[out] pContentType        a place to put the content type of the
+ *                                 response, see uHttpClientGetRequest();
+ *                                 may be NULL.
+ * @return                         in the blocking case the HTTP status code
+ *                                 or negative error code; in the non-blocking
+ *                                 case zero or negative error code.
+ */
+int32_t uHttpClientGetRequestStream(uHttpClientContext_t *pContext,
+                                    const char *pPath,
+                                    uHttpClientStreamCallback_t *pStreamCallback,
+                                    void *pStreamCallbackParam,
+                                    char *pContentType);
+
+/** As uHttpClientGetRequestStream() but resuming an interrupted
+ * download: *pOffset is the checkpoint, the number of bytes of the
+ * body that have been received, and is advanced as each chunk is
+ * passed to pStreamCallback, so if the request fails part way
+ * through, for instance because of coverage loss, the caller
+ * need only keep *pOffset, persisting it if required, and call
+ * this function again to carry on from where it left off.  Where
+ * *pOffset is non-zero a "Range" header is sent so that the server
+ * only sends the rest of the body, status code 206; if the server
+ * ignores the range and sends the whole body, status code 200,
+ * the bytes before *pOffset are dropped here so that pStreamCallback
+ * still only sees the rest of the body (though they will have been
+ * downloaded).  The body is only streamed if the status code is 200
+ * or 206.  Only supported for cellular, and not on SARA-U201; uses
+ * custom request header #U_CELL_HTTP_REQUEST_HEADER_MAX_NUM - 1 of
+ * the HTTP instance.
+ *
+ * @param[in] pContext             a pointer to the internal HTTP context
+ *                                 structure that was originally returned by
+ *                                 pUHttpClientOpen().
+ * @param[in] pPath                the null-terminated path on the HTTP server
+ *                                 to GET the data from; cannot be NULL.
+ * @param[in,out] pOffset          a pointer to the offset into the body at
+ *                                 which to start, zero for the start; cannot
+ *                                 be NULL.  In the non-blocking case this
+ *                                 MUST REMAIN VALID until the response
+ *                                 callback is called.
+ * @param[in] pStreamCallback      see uHttpClientGetRequestStream().
+ * @param[in] pStreamCallbackParam see uHttpClientGetRequestStream().
+ * @param[out] pContentType        see uHttpClientGetRequestStream().
+ * @return                         in the blocking case the HTTP status code
+ *                                 or negative error code; in the non-blocking
+ *                                 case zero or negative error code.
+ */
+int32_t uHttpClientGetRequestStreamResume(uHttpClientContext_t *pContext,
+                                          const char *pPath,
+                                          size_t *pOffset,
+                                          uHttpClientStreamCallback_t *pStreamCallback,
+                                          void *pStreamCallbackParam,
+                                          char *pContentType);
+
+/** As uHttpClientGetRequestStreamResume() but fetching only a byte
+ * range of the body: the bytes from *pOffset up to, but not including,
+ * endOffset are streamed, a "Range" header asking for just those
+ * bytes being sent.  As with uHttpClientGetRequestStreamResume(),
+ * *pOffset is advanced as each chunk is passed to pStreamCallback
+ * and, should the server ignore the range, the bytes outside it are
+ * dropped here.  Only supported for cellular, and not on SARA-U201:
+ * the Wi-Fi HTTP AT interface offers no way of adding a request
+ * header.
+ *
+ * @param[in] pContext             a pointer to the internal HTTP context
+ *                                 structure that was originally returned by
+ *                                 pUHttpClientOpen().
+ * @param[in] pPath                the null-terminated path on the HTTP server
+ *                                 to GET the data from; cannot be NULL.
+ * @param[in,out] pOffset          a pointer to the offset into the body at
+ *                                 which to start; cannot be NULL.  In the
+ *                                 non-blocking case this MUST REMAIN VALID
+ *                                 until the response callback is called.
+ * @param endOffset                the offset into the body at which to stop,
+ *                                 must be greater than *pOffset; zero to
+ *                                 carry on to the end of the body, in which
+ *                                 case this behaves exactly as
+ *                                 uHttpClientGetRequestStreamResume().
+ * @param[in] pStreamCallback      see uHttpClientGetRequestStream().
+ * @param[in] pStreamCallbackParam see uHttpClientGetRequestStream().
+ * @param[out] pContentType        see uHttpClientGetRequestStream().
+ * @return                         in the blocking case the HTTP status code
+ *                                 or negative error code; in the non-blocking
+ *                                 case zero or negative error code.
+ */
+int32_t uHttpClientGetRequestStreamRange(uHttpClientContext_t *pContext,
+                                         const char *pPath,
+                                         size_t *pOffset, size_t endOffset,
+                                         uHttpClientStreamCallback_t *pStreamCallback,
+                                         void *pStreamCallbackParam,
+                                         char *pContentType);
+
+/** Divide a resource of a known size, e.g. as read from the
+ * "Content-Length" returned by uHttpClientHeadRequest(), into
+ * segments for uHttpClientGetRequestSegmented().
+ *
+ * @param[out] pSegments   a place to put the segments; cannot be NULL.
+ * @param maxNumSegments   the number of segments at pSegments.
+ * @param totalSize        the size of the resource in bytes.
+ * @param segmentSize      the size of each segment; the last segment
+ *                         may be shorter.  If more than maxNumSegments
+ *                         segments would be required the segments are
+ *                         made bigger so that maxNumSegments suffice.
+ * @return                 the number of segments populated, else
+ *                         negative error code.
+ */
+int32_t uHttpClientSegmentsInit(uHttpClientSegment_t *pSegments,
+                                size_t maxNumSegments,
+                                size_t totalSize, size_t segmentSize);
+
+/** Fetch a resource in segments using ranged GET requests, see
+ * uHttpClientGetRequestStreamRange(), resuming each segment from
+ * where it got to if a request fails, e.g. because of coverage loss,
+ * so that a large resource downloaded over a poor link never starts
+ * again from zero.  Where more than one context is given, each
+ * context fetches a different segment at the same time, which is
+ * useful where the contexts are on different modules or the module
+ * supports simultaneous requests on its HTTP profiles; where the
+ * module does not, the segments are simply fetched one after the
+ * other.  This function blocks until all of the segments have been
+ * fetched, or until #U_HTTP_CLIENT_SEGMENTED_RETRIES_MAX requests in
+ * a row have failed without any data arriving.  The received field
+ * of each segment is kept up to date throughout, so if this function
+ * fails, or the device restarts, calling it again with the same
+ * segments carries on from where it left off.  Only supported for
+ * cellular.
+ *
+ * The contexts may be blocking or non-blocking but no other request
+ * should be made on them while this function is running.  The
+ * response callback of a non-blocking context is not called for the
+ * requests made by this function.  The pKeepGoingCallback of the
+ * first context, if there is one, is called while waiting and, if
+ * it returns false, this function returns once the requests in
+ * progress have finished.
+ *
+ * @param[in] ppContext       an array of pointers to contexts, each as
+ *                            returned by pUHttpClientOpen(), all
+ *                            connected to the same HTTP server; cannot
+ *                            be NULL.
+ * @param numContexts         the number of contexts at ppContext, at
+ *                            most #U_HTTP_CLIENT_SEGMENTED_CONTEXTS_MAX_NUM.
+ * @param[in] pPath           the null-terminated path on the HTTP server
+ *                            of the resource; cannot be NULL.
+ * @param[in,out] pSegments   the segments of the resource, see
+ *                            uHttpClientSegmentsInit(); cannot be NULL.
+ * @param numSegments         the number of segments at pSegments.
+ * @param[in] pCallback       the function to call with each chunk of
+ *                            the resource; it is called from the task
+ *                            that handles the module's HTTP indications
+ *                            and hence should not block for long.
+ *                            Cannot be NULL.
+ * @param[in] pCallbackParam  a parameter to pass to pCallback; may be
+ *                            NULL.
+ * @return                    zero when all of the segments have been
+ *                            received, a positive HTTP status code if
+ *                            the last request to fail returned a status
+ *                            code other than 200 or 206, else negative
+ *                            error code, e.g. #U_ERROR_COMMON_CANCELLED
+ *                            if pCallback or pKeepGoingCallback returned
+ *                            false.
+ */
+int32_t uHttpClientGetRequestSegmented(uHttpClientContext_t **ppContext,
+                                       size_t numContexts,
+                                       const char *pPath,
+                                       uHttpClientSegment_t *pSegments,
+                                       size_t numSegments,
+                                       uHttpClientSegmentCallback_t *pCallback,
+                                       void *pCallbackParam);
+
+/** As uHttpClientGetRequest() but conditional: if the context has
+ * an ETag for pPath from an earlier response to this function, an
+ * "If-None-Match" header carrying it is sent and, if the resource
+ * has not changed, the server returns status code 304 with no body,
+ * saving the download; *pSize is then set to zero and the caller
+ * should use the copy it already has.  A 200 response which carries
+ * an ETag has the ETag remembered for next time, the context keeping
+ * the ETags of the last #U_HTTP_CLIENT_ETAG_CACHE_NUM_ENTRIES paths;
+ * the paths are stored in full, so an ETag is only ever sent for
+ * the path it came from, and a path too long for
+ * #U_HTTP_CLIENT_ETAG_PATH_LENGTH_BYTES is always requested
+ * unconditionally.
+ * On cellular this uses custom request header
+ * #U_CELL_HTTP_REQUEST_HEADER_MAX_NUM - 2 of the HTTP instance and
+ * so, once an ETag is held, is not supported on SARA-U201; on
+ * Wi-Fi, where the AT interface offers no way of adding a request
+ * header, the request is always made unconditionally, exactly as
+ * uHttpClientGetRequest().
+ *
+ * @param[in] pContext        a pointer to the internal HTTP context
+ *                            structure that was originally returned by
+ *                            pUHttpClientOpen().
+ * @param[in] pPath           see uHttpClientGetRequest().
+ * @param[out] pResponseBody  see uHttpClientGetRequest().
+ * @param[in,out] pSize       see uHttpClientGetRequest().
+ * @param[out] pContentType   see uHttpClientGetRequest().
+ * @return                    as uHttpClientGetRequest(); in the
+ *                            blocking case 304 means that the
+ *                            resource is unchanged.
+ */
+int32_t uHttpClientGetRequestConditional(uHttpClientContext_t *pContext,
+                                         const char *pPath,
+                                         char *pResponseBody, size_t *pSize,
+                                         char *pContentType);
+
+/** Initialise a streaming parser of HTTP response headers; the
+ * parser keeps only one header line at a time, so the headers of a
+ * response never need to be held in RAM all at once.
+ *
+ * @param[out] pParser        the parser; cannot be NULL.
+ * @param[out] pContentType   a place to put the value of the
+ *                            Content-Type header, truncated to
+ *                            #U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES
+ *                            including the null-terminator, which is
+ *                            always added; may be NULL.
+ * @param[in] pCallback       a function to call with every header;
+ *                            may be NULL.
+ * @param[in] pCallbackParam  a parameter to pass to pCallback; may be
+ *                            NULL.
+ */
+void uHttpClientHeaderParserInit(uHttpClientHeaderParser_t *pParser,
+                                 char *pContentType,
+                                 uHttpClientHeaderCallback_t *pCallback,
+                                 void *pCallbackParam);
+
+/** Parse the next block of an HTTP response, which may be of any
+ * size, starting with its status line.  Parsing stops at the end of
+ * the headers, setting the done field of pParser, so that anything
+ * beyond is left alone as the start of the body.
+ *
+ * @param[in,out] pParser  the parser, as initialised by
+ *                         uHttpClientHeaderParserInit(); cannot be NULL.
+ * @param[in] pData        the next block of the response.
+ * @param size             the number of bytes at pData.
+ * @return                 the number of bytes of pData that were
+ *                         consumed, less than size only if the end
+ *                         of the headers has been reached.
+ */
+size_t uHttpClientHeaderParse(uHttpClientHeaderParser_t *pParser,
+                              const char *pData, size_t size);
+
+/** Queue an HTTP GET request.  Requests queued on a context are
+ * carried out in order, one straight after the other, by a task of
+ * this API, each exactly as uHttpClientGetRequest() would, and
+ * pCallback is called as each completes.  The HTTP profile of the
+ * context stays set up in the module throughout, so a burst of
+ * requests to the same server costs no more than the requests
+ * themselves.  Only supported on a blocking context, i.e. one where
+ * pResponseCallback in the pConnection structure passed to
+ * pUHttpClientOpen() was NULL.  Requests still queued when
+ * uHttpClientClose() is called are not sent; their callbacks are
+ * called with #U_ERROR_COMMON_CANCELLED.
+ *
+ * IMPORTANT: pPath and all of the storage passed to this function
+ * MUST REMAIN VALID until pCallback is called.
+ *
+ * @param[in] pContext         a pointer to the internal HTTP context
+ *                             structure that was originally returned by
+ *                             pUHttpClientOpen().
+ * @param[in] pPath            see uHttpClientGetRequest().
+ * @param[out] pResponseBody   see uHttpClientGetRequest().
+ * @param[in,out] pSize        see uHttpClientGetRequest().
+ * @param[out] pContentType    see uHttpClientGetRequest().
+ * @param[in] pCallback        the function to call when the request
+ *                             completes; it is passed what
+ *                             uHttpClientGetRequest() returned and the
+ *                             amount of data at pResponseBody.  Called
+ *                             from the task of the queue, which has a
+ *                             stack of
+ *                             #U_HTTP_CLIENT_REQUEST_QUEUE_TASK_STACK_SIZE_BYTES.
+ *                             May be NULL.
+ * @param[in] pCallbackParam   a parameter to pass to pCallback; may be
+ *                             NULL.
+ * @return                     zero on success else negative error code,
+ *                             e.g. #U_ERROR_COMMON_BUSY if there are
+ *                             already #U_HTTP_CLIENT_REQUEST_QUEUE_LENGTH
+ *                             requests in the queue.
+ */
+int32_t uHttpClientGetRequestQueue(uHttpClientContext_t *pContext,
+                                   const char *pPath,
+                                   char *pResponseBody, size_t *pSize,
+                                   char *pContentType,
+                                   uHttpClientResponseCallback_t *pCallback,
+                                   void *pCallbackParam);
+
+/** Queue an HTTP POST request; as uHttpClientGetRequestQueue() but
+ * for uHttpClientPostRequest(), the parameters of which are the
+ * same as those here, with the addition of pCallback and
+ * pCallbackParam.
+ *
+ * IMPORTANT: pPath, pData, pContentType and all of the storage passed to
+ * this function MUST REMAIN VALID until pCallback is called.
+ *
+ * @return zero on success else negative error code.
+ */
+int32_t uHttpClientPostRequestQueue(uHttpClientContext_t *pContext,
+                                    const char *pPath,
+                                    const char *pData, size_t size,
+                                    const char *pContentType,
+                                    char *pResponseBody, size_t *pResponseSize,
+                                    char *pResponseContentType,
+                                    uHttpClientResponseCallback_t *pCallback,
+                                    void *pCallbackParam);
+
 /** Make a request for an HTTP header.  If this is a blocking call (i.e.
  * pResponseCallback in the pConnection structure passed to pUHttpClientOpen()
  * was NULL) and a pKeepGoingCallback() was provided in pConnection then
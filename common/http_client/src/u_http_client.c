@@ -50,8 +50,10 @@
 #include "stdbool.h"
 #include "stdio.h"     // snprintf()
 #include "string.h"    // strstr()/memcmp()/strncpy()/strlen()/strtol()
+#include "ctype.h"     // tolower()
 
 #include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h" // For U_CFG_OS_APP_TASK_PRIORITY
 
 #include "u_error_common.h"
 
@@ -64,6 +66,7 @@
 #include "u_port_heap.h"
 #include "u_port_debug.h"
 #include "u_port_uart.h"
+#include "u_port_event_queue.h"
 
 #include "u_assert.h"
 
@@ -125,24 +128,112 @@
 # define U_HTTP_CLIENT_CELL_FILE_WRITE_DELAY_MS 50
 #endif
 
-/** The maximum length of the first line of an HTTP response.
+/** The index of the custom request header of a cellular HTTP
+ * instance that is used for the "Range" header of
+ * uHttpClientGetRequestStreamResume().
  */
-#define U_HTTP_CLIENT_CELL_FILE_READ_FIRST_LINE_LENGTH 64
+#define U_HTTP_CLIENT_CELL_RANGE_HEADER_INDEX (U_CELL_HTTP_REQUEST_HEADER_MAX_NUM - 1)
 
-/** The maximum length of the headers of an HTTP response.
+/** The index of the custom request header of a cellular HTTP
+ * instance that is used for the "If-None-Match" header of
+ * uHttpClientGetRequestConditional().
  */
-#define U_HTTP_CLIENT_CELL_FILE_READ_HEADERS_LENGTH 1024
+#define U_HTTP_CLIENT_CELL_CONDITIONAL_HEADER_INDEX (U_CELL_HTTP_REQUEST_HEADER_MAX_NUM - 2)
+
+/** The size of the blocks in which the status line and headers of
+ * an HTTP response are read from the response file and passed
+ * through uHttpClientHeaderParse().
+ */
+#define U_HTTP_CLIENT_CELL_FILE_READ_HEADER_BLOCK_LENGTH 64
+
+/** How long uHttpClientGetRequestSegmented() waits between checks
+ * on its requests and, when a request could not be sent, before
+ * trying again.
+ */
+#define U_HTTP_CLIENT_SEGMENTED_WAIT_MS 1000
 
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** An entry in the ETag cache of uHttpClientGetRequestConditional().
+ */
+typedef struct {
+    char path[U_HTTP_CLIENT_ETAG_PATH_LENGTH_BYTES]; /**< empty if the
+                                                          entry is unused. */
+    char eTag[U_HTTP_CLIENT_ETAG_LENGTH_BYTES];
+} uHttpClientETag_t;
+
+/** The ETag cache of uHttpClientGetRequestConditional().
+ */
+typedef struct {
+    uHttpClientETag_t entry[U_HTTP_CLIENT_ETAG_CACHE_NUM_ENTRIES];
+    size_t next;                                     /**< the entry to
+                                                          replace next. */
+    char path[U_HTTP_CLIENT_ETAG_PATH_LENGTH_BYTES]; /**< the path of the
+                                                          request in
+                                                          progress. */
+} uHttpClientETagCache_t;
+
 /** Private context structure for HTTP, cellular-flavour.
  */
 typedef struct {
     int32_t httpHandle;
+    uHttpClientETagCache_t *pETagCache; /**< allocated on first use. */
+    bool conditional;                   /**< true if the request in progress
+                                             is from
+                                             uHttpClientGetRequestConditional(),
+                                             its path being in pETagCache. */
 } uHttpClientContextCell_t;
 
+/** A request in the queue of uHttpClientXxxRequestQueue(); the
+ * fields are the parameters of uHttpClientPostRequest(), of which
+ * uHttpClientGetRequest() uses a subset.
+ */
+typedef struct {
+    uHttpClientContext_t *pContext;
+    bool isPost;
+    const char *pPath;
+    const char *pData;
+    size_t size;
+    const char *pContentType;
+    char *pResponseBody;
+    size_t *pResponseSize;
+    char *pResponseContentType;
+    uHttpClientResponseCallback_t *pCallback;
+    void *pCallbackParam;
+    uPortSemaphoreHandle_t doneSemaphoreHandle; /**< if non-NULL this is not a
+                                                     request: the semaphore
+                                                     is given once those
+                                                     ahead are completed. */
+} uHttpClientQueuedRequest_t;
+
+/** State of uHttpClientGetRequestSegmented() shared between its
+ * contexts.
+ */
+typedef struct {
+    uPortSemaphoreHandle_t semaphoreHandle;
+    uHttpClientSegmentCallback_t *pCallback;
+    void *pCallbackParam;
+    volatile bool cancelled;
+} uHttpClientSegmented_t;
+
+/** State of uHttpClientGetRequestSegmented() for one context.
+ */
+typedef struct {
+    uHttpClientContext_t *pContext;
+    uHttpClientResponseCallback_t *pResponseCallback; /**< the context's own. */
+    void *pResponseCallbackParam;                     /**< the context's own. */
+    uHttpClientSegmented_t *pSegmented;
+    uHttpClientSegment_t *pSegment; /**< the segment being fetched, NULL if none. */
+    size_t position;                /**< the stream offset of the request. */
+    size_t receivedAtStart;         /**< the received field of the segment
+                                         when the request was made. */
+    int32_t startTimeMs;
+    volatile bool done;
+    volatile int32_t statusCodeOrError;
+} uHttpClientSegmentedSlot_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -152,133 +243,207 @@ typedef struct {
 static uErrorCode_t gLastOpenError = U_ERROR_COMMON_SUCCESS;
 
 /* ----------------------------------------------------------------
- * STATIC FUNCTIONS: CELLULAR SPECIFIC
+ * STATIC FUNCTIONS: HEADER PARSING
  * -------------------------------------------------------------- */
 
-// Read the start of a response file to find the HTTP status code.
-static int32_t cellFileResponseReadStatusCode(uDeviceHandle_t cellHandle,
-                                              const char *pFileNameResponse,
-                                              size_t *pOffset)
+// Return true if the given header name is pWanted, ignoring case
+// as HTTP does.
+static bool headerNameIs(const char *pName, const char *pWanted)
+{
+    while ((*pName != 0) &&
+           (tolower((unsigned char) *pName) == tolower((unsigned char) *pWanted))) {
+        pName++;
+        pWanted++;
+    }
+
+    return (*pName == 0) && (*pWanted == 0);
+}
+
+// Process the line held in the line buffer of the parser, the
+// first being the status line and the rest headers.
+static void headerParseLine(uHttpClientHeaderParser_t *pParser)
 {
-    int32_t errorOrStatusCode;
-    // +1 in order that this can be made into a string
-    char responseBuffer[U_HTTP_CLIENT_CELL_FILE_READ_FIRST_LINE_LENGTH + 1];
-    char *pSave;
-    char *pTmp;
-
-    // Read enough of the response file to get the status code
-    errorOrStatusCode = uCellFileBlockRead(cellHandle, pFileNameResponse,
-                                           responseBuffer, 0,
-                                           // -1 so that we can make it a string
-                                           sizeof(responseBuffer) - 1);
-    if (errorOrStatusCode >= 0) {
-        // Make it a string
-        responseBuffer[errorOrStatusCode] = 0;
-
-        // What we expect to get is something like:
-        // "HTTP/1.0 200 OK\r\nAccept-Ranges: ..."
-
-        // Before we modify the buffer by tokenising it,
-        // find the end of the line and put it in pOffset
-        if (pOffset != NULL) {
-            // As a bonus find the end of line and
-            // put the distance to it into pOffset
-            *pOffset = 0;
-            pTmp = strstr(responseBuffer, "\r\n");
-            if (pTmp != NULL) {
-                *pOffset = (pTmp - responseBuffer) + 2; // +2 for \r\n
+    char *pLine = pParser->line;
+    char *pValue;
+    char *pEnd;
+    int32_t value;
+
+    pLine[pParser->lineLength] = 0;
+    if (pParser->statusLineLength == 0) {
+        // What we expect is something like "HTTP/1.1 200 OK"
+        if ((pParser->lineLength > 5) && (memcmp(pLine, "HTTP/", 5) == 0)) {
+            pValue = strchr(pLine, ' ');
+            if (pValue != NULL) {
+                value = strtol(pValue + 1, &pEnd, 10);
+                if ((pEnd - (pValue + 1) == 3) && (value >= 0)) {
+                    pParser->statusCode = value;
+                }
             }
         }
-
-        // Now tokenise on space
-        pTmp = strtok_r(responseBuffer, " ", &pSave);
-        // Confirm that there's an HTTP at the start
-        if ((pTmp != NULL) && (strlen(pTmp) >= 4) && (memcmp(pTmp, "HTTP", 4) == 0)) {
-            // The 3-digit status code should be next
-            pTmp = strtok_r(NULL, " ", &pSave);
-            if ((pTmp != NULL) && (strlen(pTmp) >= 3)) {
-                errorOrStatusCode = strtol(pTmp, &pTmp, 10);
+    } else {
+        // Something like "Content-Length: 1234"
+        pValue = strchr(pLine, ':');
+        if (pValue != NULL) {
+            *pValue = 0;
+            pValue++;
+            // Strip leading and trailing white space from the value
+            while ((*pValue == ' ') || (*pValue == '\t')) {
+                pValue++;
+            }
+            pEnd = pLine + pParser->lineLength;
+            while ((pEnd > pValue) && ((*(pEnd - 1) == ' ') || (*(pEnd - 1) == '\t'))) {
+                pEnd--;
+            }
+            *pEnd = 0;
+            if (headerNameIs(pLine, "Content-Length")) {
+                value = strtol(pValue, &pEnd, 10);
+                if ((pEnd != pValue) && (*pEnd == 0) && (value >= 0)) {
+                    pParser->contentLength = value;
+                }
+            } else if (headerNameIs(pLine, "ETag")) {
+                // A truncated ETag is of no use to anyone
+                if (!pParser->lineTruncated && (strlen(pValue) < sizeof(pParser->eTag))) {
+                    strncpy(pParser->eTag, pValue, sizeof(pParser->eTag));
+                }
+            } else if ((pParser->pContentType != NULL) &&
+                       headerNameIs(pLine, "Content-Type")) {
+                strncpy(pParser->pContentType, pValue,
+                        U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES - 1);
+                *(pParser->pContentType + U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES - 1) = 0;
             }
+            if (pParser->pCallback != NULL) {
+                pParser->pCallback(pLine, pValue, pParser->pCallbackParam);
+            }
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: CELLULAR SPECIFIC
+ * -------------------------------------------------------------- */
+
+// Pass the status line and headers at the start of a response
+// file through the given parser, a block at a time; if the file
+// ends without a blank line the headers are taken to be all of it.
+static int32_t cellFileResponseReadHeaders(uDeviceHandle_t cellHandle,
+                                           const char *pFileNameResponse,
+                                           uHttpClientHeaderParser_t *pParser)
+{
+    int32_t errorCodeOrSize;
+    char buffer[U_HTTP_CLIENT_CELL_FILE_READ_HEADER_BLOCK_LENGTH];
+
+    do {
+        errorCodeOrSize = uCellFileBlockRead(cellHandle, pFileNameResponse,
+                                             buffer, pParser->headerLength,
+                                             sizeof(buffer));
+        if (errorCodeOrSize > 0) {
+            uHttpClientHeaderParse(pParser, buffer, (size_t) errorCodeOrSize);
         }
+    } while ((errorCodeOrSize > 0) && !pParser->done);
+
+    if (errorCodeOrSize > 0) {
+        errorCodeOrSize = 0;
     }
 
-    return errorOrStatusCode;
+    return errorCodeOrSize;
 }
 
-// Read the header from the response file, starting at offset,
-// and deriving the content type on the way if required.
-static int32_t cellFileResponseReadHead(uDeviceHandle_t cellHandle,
-                                        const char *pFileNameResponse,
-                                        size_t offset,
-                                        char *pResponseHeader,
-                                        size_t responseHeaderSize,
-                                        char *pContentType)
+// Find the entry in the ETag cache for the given path.
+static uHttpClientETag_t *pCellETagFind(uHttpClientETagCache_t *pETagCache,
+                                        const char *pPath)
 {
-    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-    char *pBuffer = pResponseHeader;
-    size_t size = responseHeaderSize;
-    bool malloced = false;
-    char *pTmp;
-    char *pEnd;
-    size_t sizeContentType;
+    uHttpClientETag_t *pETag = NULL;
 
-    if (pBuffer == NULL) {
-        size = U_HTTP_CLIENT_CELL_FILE_READ_HEADERS_LENGTH;
-        pBuffer = (char *) pUPortMalloc(size + 1); // +1 to add a terminator
-        malloced = true;
+    for (size_t x = 0; (x < U_HTTP_CLIENT_ETAG_CACHE_NUM_ENTRIES) && (pETag == NULL); x++) {
+        if ((pETagCache->entry[x].path[0] != 0) &&
+            (strcmp(pETagCache->entry[x].path, pPath) == 0)) {
+            pETag = &(pETagCache->entry[x]);
+        }
     }
 
-    if (pBuffer != NULL) {
-        errorCodeOrSize = uCellFileBlockRead(cellHandle, pFileNameResponse,
-                                             pBuffer, offset, size);
-        if ((errorCodeOrSize >= 0) && malloced) {
-            // Need to be able to treat pBuffer as a string for
-            // the rest of this
-            *(pBuffer + errorCodeOrSize) = 0;
-            // Find the end of the headers region, which is marked by
-            // a blank line
-            pTmp = strstr(pBuffer, "\r\n\r\n");
-            if (pTmp != NULL) {
-                errorCodeOrSize = pTmp - pBuffer;
+    return pETag;
+}
+
+// Update the ETag cache with the outcome of a conditional request:
+// a 200 response replaces whatever was held for the path, a 304
+// leaves it alone and anything else is of no relevance.
+static void cellETagUpdate(uHttpClientContextCell_t *pContextCell,
+                           int32_t statusCode, const char *pETagReceived)
+{
+    uHttpClientETagCache_t *pETagCache = pContextCell->pETagCache;
+    uHttpClientETag_t *pETag;
+
+    if (pContextCell->conditional && (pETagCache != NULL) && (statusCode == 200)) {
+        pETag = pCellETagFind(pETagCache, pETagCache->path);
+        if (*pETagReceived == 0) {
+            // The resource no longer has an ETag
+            if (pETag != NULL) {
+                pETag->path[0] = 0;
             }
-            if (pContentType != NULL) {
-                *pContentType = 0;
-                // Find the content type in the headers
-                pTmp = strstr(pBuffer, "Content-Type:");
-                if (pTmp != NULL) {
-                    pTmp += 13; // For "Content-Type:"
-                    // Need to turn this into a string of max length
-                    // U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES - 1
-                    // First, remove any initial spaces
-                    while (*pTmp == ' ') {
-                        pTmp++;
-                    }
-                    // Assuming the end of the content-type text is the end
-                    // of the headers, then work out the size
-                    sizeContentType = errorCodeOrSize - (pTmp - pBuffer);
-                    // See if there is actually a line-end on the content-type
-                    pEnd = strstr(pTmp, "\r\n");
-                    if (pEnd != NULL) {
-                        sizeContentType = pEnd - pTmp;
-                    }
-                    // Populate pContentType
-                    if (sizeContentType > U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES - 1) {
-                        sizeContentType = U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES - 1;
-                    }
-                    memcpy(pContentType, pTmp, sizeContentType);
-                    // Add a terminator
-                    *(pContentType + sizeContentType) = 0;
+        } else {
+            if (pETag == NULL) {
+                // Replace the oldest
+                pETag = &(pETagCache->entry[pETagCache->next]);
+                pETagCache->next++;
+                if (pETagCache->next >= U_HTTP_CLIENT_ETAG_CACHE_NUM_ENTRIES) {
+                    pETagCache->next = 0;
                 }
             }
+            strncpy(pETag->path, pETagCache->path, sizeof(pETag->path));
+            strncpy(pETag->eTag, pETagReceived, sizeof(pETag->eTag));
         }
+    }
+    pContextCell->conditional = false;
+}
 
-        if (malloced) {
-            // Free memory
-            uPortFree(pBuffer);
-        }
+// Read the body from the response file, starting at offset, and
+// pass it to the stream callback in chunks, returning the number of
+// bytes passed on; if there is a stream offset it is advanced
+// accordingly.
+static int32_t cellFileResponseStream(uDeviceHandle_t cellHandle,
+                                      const char *pFileNameResponse,
+                                      size_t offset,
+                                      const uHttpClientContext_t *pContext)
+{
+    int32_t totalSize = 0;
+    int32_t thisSize;
+    char *pBuffer;
+
+    pBuffer = (char *) pUPortMalloc(U_HTTP_CLIENT_CELL_FILE_CHUNK_LENGTH);
+    if (pBuffer != NULL) {
+        do {
+            thisSize = U_HTTP_CLIENT_CELL_FILE_CHUNK_LENGTH;
+            if ((pContext->streamEndOffset > 0) && (pContext->pStreamOffset != NULL)) {
+                // A ranged request: don't go past the end of the
+                // range, even if the server sent more
+                if (*pContext->pStreamOffset >= pContext->streamEndOffset) {
+                    thisSize = 0;
+                } else if (pContext->streamEndOffset - *pContext->pStreamOffset < (size_t) thisSize) {
+                    thisSize = (int32_t) (pContext->streamEndOffset - *pContext->pStreamOffset);
+                }
+            }
+            if (thisSize > 0) {
+                thisSize = uCellFileBlockRead(cellHandle, pFileNameResponse,
+                                              pBuffer, offset + totalSize,
+                                              thisSize);
+            }
+            if (thisSize > 0) {
+                totalSize += thisSize;
+                if (pContext->pStreamOffset != NULL) {
+                    *pContext->pStreamOffset += (size_t) thisSize;
+                }
+                if (!pContext->pStreamCallback(cellHandle, pBuffer,
+                                               (size_t) thisSize,
+                                               pContext->pStreamCallbackParam)) {
+                    // The application has had enough
+                    thisSize = 0;
+                }
+            }
+        } while (thisSize > 0);
+        uPortFree(pBuffer);
     }
 
-    return errorCodeOrSize;
+    return totalSize;
 }
 
 // Callback for HTTP responses in the cellular case.
@@ -294,10 +459,13 @@ static void cellCallback(uDeviceHandle_t cellHandle, int32_t httpHandle,
     int32_t responseSize = 0;
     int32_t thisSize = 0;
     int32_t totalSize = 0;
+    uHttpClientContextCell_t *pContextCell;
+    uHttpClientHeaderParser_t *pParser = NULL;
 
     (void) httpHandle;
 
     if (pContext != NULL) {
+        pContextCell = (uHttpClientContextCell_t *) pContext->pPriv;
         if (!error) {
             if (uCellAtClientHandleGet(pContext->devHandle, &atHandle) == 0) {
                 // Switch AT printing off for this as it is quite a load
@@ -305,57 +473,81 @@ static void cellCallback(uDeviceHandle_t cellHandle, int32_t httpHandle,
                 uAtClientPrintAtSet(atHandle, false);
             }
 
-            // Read the status code from the file
-            statusCodeOrError = cellFileResponseReadStatusCode(cellHandle,
-                                                               pFileNameResponse,
-                                                               &offset);
+            // Parse the status line and headers, picking up the
+            // content type where required; HEAD responses have
+            // their headers passed back raw instead
+            statusCodeOrError = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            pParser = (uHttpClientHeaderParser_t *) pUPortMalloc(sizeof(*pParser));
+            if (pParser != NULL) {
+                uHttpClientHeaderParserInit(pParser,
+                                            (requestType == U_CELL_HTTP_REQUEST_HEAD) ?
+                                            NULL : pContext->pContentType,
+                                            NULL, NULL);
+                statusCodeOrError = cellFileResponseReadHeaders(cellHandle,
+                                                                pFileNameResponse,
+                                                                pParser);
+                if (statusCodeOrError == 0) {
+                    statusCodeOrError = (int32_t) U_ERROR_COMMON_PROTOCOL_ERROR;
+                    if (pParser->statusCode >= 0) {
+                        statusCodeOrError = pParser->statusCode;
+                    }
+                    cellETagUpdate(pContextCell, statusCodeOrError, pParser->eTag);
+                }
+            }
             if (statusCodeOrError >= 0) {
                 // Read data from the response file, where required
-                if ((pContext->pResponse != NULL) &&
-                    (pContext->pResponseSize != NULL) &&
-                    (*pContext->pResponseSize > 0)) {
+                offset = pParser->headerLength;
+                if (pContext->pStreamCallback != NULL) {
+                    // For a resumed download 206 is the partial content
+                    // asked for while with 200 the server has ignored
+                    // the range and sent everything, so skip what we
+                    // already have; anything else is not the body
+                    if ((pContext->pStreamOffset != NULL) && (statusCodeOrError == 200)) {
+                        offset += *pContext->pStreamOffset;
+                    }
+                    if ((requestType == U_CELL_HTTP_REQUEST_GET) &&
+                        ((pContext->pStreamOffset == NULL) ||
+                         (statusCodeOrError == 200) || (statusCodeOrError == 206))) {
+                        responseSize = cellFileResponseStream(cellHandle,
+                                                              pFileNameResponse,
+                                                              offset, pContext);
+                    }
+                } else if ((pContext->pResponse != NULL) &&
+                           (pContext->pResponseSize != NULL) &&
+                           (*pContext->pResponseSize > 0)) {
                     switch (requestType) {
                         case U_CELL_HTTP_REQUEST_HEAD:
-                            responseSize = cellFileResponseReadHead(cellHandle,
-                                                                    pFileNameResponse,
-                                                                    offset,
-                                                                    pContext->pResponse,
-                                                                    *pContext->pResponseSize,
-                                                                    NULL);
+                            // The headers, without the status line
+                            responseSize = uCellFileBlockRead(cellHandle,
+                                                              pFileNameResponse,
+                                                              pContext->pResponse,
+                                                              pParser->statusLineLength,
+                                                              *pContext->pResponseSize);
                             break;
                         case U_CELL_HTTP_REQUEST_GET:
                         //fall-through
                         case U_CELL_HTTP_REQUEST_POST:
-                            // Read the headers to get the content type and allow
-                            // us to work out the offset to the start of the body
-                            responseSize = cellFileResponseReadHead(cellHandle,
-                                                                    pFileNameResponse,
-                                                                    offset, NULL, 0,
-                                                                    pContext->pContentType);
-                            if (responseSize >= 0) {
-                                // Read the body, starting from the end of the headers
-                                // It _should_ be possible to read this all at once,
-                                // however it puts some stress on the AT interface
-                                // and so here we chunk it.
-                                offset += (size_t) responseSize + 4; // +4 for "\r\n\r\n"
-                                do {
-                                    thisSize = U_HTTP_CLIENT_CELL_FILE_CHUNK_LENGTH;
-                                    if (thisSize > ((int32_t) *pContext->pResponseSize) - totalSize) {
-                                        thisSize = ((int32_t) * pContext->pResponseSize) - totalSize;
-                                    }
+                            // Read the body, starting from the end of the headers
+                            // It _should_ be possible to read this all at once,
+                            // however it puts some stress on the AT interface
+                            // and so here we chunk it.
+                            do {
+                                thisSize = U_HTTP_CLIENT_CELL_FILE_CHUNK_LENGTH;
+                                if (thisSize > ((int32_t) *pContext->pResponseSize) - totalSize) {
+                                    thisSize = ((int32_t) * pContext->pResponseSize) - totalSize;
+                                }
+                                if (thisSize > 0) {
+                                    thisSize = uCellFileBlockRead(cellHandle,
+                                                                  pFileNameResponse,
+                                                                  pContext->pResponse + totalSize,
+                                                                  offset + totalSize,
+                                                                  thisSize);
                                     if (thisSize > 0) {
-                                        thisSize = uCellFileBlockRead(cellHandle,
-                                                                      pFileNameResponse,
-                                                                      pContext->pResponse + totalSize,
-                                                                      offset + totalSize,
-                                                                      thisSize);
-                                        if (thisSize > 0) {
-                                            totalSize += thisSize;
-                                        }
+                                        totalSize += thisSize;
                                     }
-                                } while (thisSize > 0);
-                                responseSize = totalSize;
-                            }
+                                }
+                            } while (thisSize > 0);
+                            responseSize = totalSize;
                             break;
                         default:
                             break;
@@ -369,6 +561,7 @@ static void cellCallback(uDeviceHandle_t cellHandle, int32_t httpHandle,
                     *pContext->pResponseSize = (size_t) responseSize;
                 }
             }
+            uPortFree(pParser);
 
             if (atPrintOn) {
                 uAtClientPrintAtSet(atHandle, true);
@@ -377,6 +570,7 @@ static void cellCallback(uDeviceHandle_t cellHandle, int32_t httpHandle,
             // Call this to make the error code visible in the AT stream
             uCellHttpGetLastErrorCode(cellHandle, httpHandle);
         }
+        pContextCell->conditional = false;
 
         // Call the callback, if required
         if (pContext->pResponseCallback != NULL) {
@@ -386,6 +580,13 @@ static void cellCallback(uDeviceHandle_t cellHandle, int32_t httpHandle,
                                         pContext->pResponseCallbackParam);
         }
 
+        // A streamed request must not leave its callback in
+        // place for the next, which may not be streamed
+        pContext->pStreamCallback = NULL;
+        pContext->pStreamCallbackParam = NULL;
+        pContext->pStreamOffset = NULL;
+        pContext->streamEndOffset = 0;
+
         // Set the status code for block() to read if required and
         // give the semaphore back
         pContext->statusCodeOrError = statusCodeOrError;
@@ -603,6 +804,10 @@ static void clearLastRequest(uHttpClientContext_t *pContext)
     pContext->pResponse = NULL;
     pContext->pResponseSize = NULL;
     pContext->pContentType = NULL;
+    pContext->pStreamCallback = NULL;
+    pContext->pStreamCallbackParam = NULL;
+    pContext->pStreamOffset = NULL;
+    pContext->streamEndOffset = 0;
     pContext->lastRequestTimeMs = -1;
     pContext->statusCodeOrError = 0;
     uPortSemaphoreGive((uPortSemaphoreHandle_t) pContext->semaphoreHandle);
@@ -705,6 +910,238 @@ static int32_t block(volatile uHttpClientContext_t *pContext)
     return errorCode;
 }
 
+// Event handler of the request queue: carry out one request,
+// blocking, and call its callback.
+static void requestQueueEventHandler(void *pParam, size_t paramLength)
+{
+    uHttpClientQueuedRequest_t *pRequest = (uHttpClientQueuedRequest_t *) pParam;
+    int32_t statusCodeOrError = (int32_t) U_ERROR_COMMON_CANCELLED;
+    size_t responseSize = 0;
+
+    (void) paramLength;
+
+    if (pRequest->doneSemaphoreHandle != NULL) {
+        // uHttpClientClose() is waiting for the queue to drain and
+        // may free the context as soon as this is given, so this
+        // must be the last thing done
+        uPortSemaphoreGive(pRequest->doneSemaphoreHandle);
+    } else if (!pRequest->pContext->eventQueueClosing) {
+        if (pRequest->isPost) {
+            statusCodeOrError = uHttpClientPostRequest(pRequest->pContext,
+                                                       pRequest->pPath,
+                                                       pRequest->pData,
+                                                       pRequest->size,
+                                                       pRequest->pContentType,
+                                                       pRequest->pResponseBody,
+                                                       pRequest->pResponseSize,
+                                                       pRequest->pResponseContentType);
+        } else {
+            statusCodeOrError = uHttpClientGetRequest(pRequest->pContext,
+                                                      pRequest->pPath,
+                                                      pRequest->pResponseBody,
+                                                      pRequest->pResponseSize,
+                                                      pRequest->pResponseContentType);
+        }
+        if ((statusCodeOrError >= 0) && (pRequest->pResponseSize != NULL)) {
+            responseSize = *pRequest->pResponseSize;
+        }
+    }
+
+    if ((pRequest->doneSemaphoreHandle == NULL) && (pRequest->pCallback != NULL)) {
+        pRequest->pCallback(pRequest->pContext->devHandle, statusCodeOrError,
+                            responseSize, pRequest->pCallbackParam);
+    }
+}
+
+// Add a request to the queue of a context, opening the queue
+// if required.
+static int32_t requestQueueAdd(const uHttpClientQueuedRequest_t *pRequest)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uHttpClientContext_t *pContext = pRequest->pContext;
+
+    if ((pContext != NULL) && (pRequest->pPath != NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+        if (pContext->pResponseCallback == NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (pContext->eventQueueHandle < 0) {
+                // Take the request lock so that only one task opens it
+                U_HTTP_CLIENT_REQUEST_ENTRY_FUNCTION(pContext, &errorCode, true);
+
+                if ((errorCode == 0) && (pContext->eventQueueHandle < 0)) {
+                    errorCode = uPortEventQueueOpen(requestQueueEventHandler,
+                                                    "httpRequest",
+                                                    sizeof(*pRequest),
+                                                    U_HTTP_CLIENT_REQUEST_QUEUE_TASK_STACK_SIZE_BYTES,
+                                                    U_HTTP_CLIENT_REQUEST_QUEUE_TASK_PRIORITY,
+                                                    U_HTTP_CLIENT_REQUEST_QUEUE_LENGTH);
+                    if (errorCode >= 0) {
+                        pContext->eventQueueHandle = errorCode;
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    }
+                }
+
+                U_HTTP_CLIENT_REQUEST_EXIT_FUNCTION(pContext, errorCode);
+                if (errorCode == 0) {
+                    uPortSemaphoreGive((uPortSemaphoreHandle_t) pContext->semaphoreHandle);
+                }
+            }
+            if (errorCode == 0) {
+                // Return busy rather than block the caller
+                errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                if (uPortEventQueueGetFree(pContext->eventQueueHandle) != 0) {
+                    errorCode = uPortEventQueueSend(pContext->eventQueueHandle,
+                                                    pRequest, sizeof(*pRequest));
+                }
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Make an HTTP GET request, streaming the response body and, if
+// pOffset is non-NULL, starting at *pOffset into the body and,
+// if endOffset is non-zero, stopping at endOffset.
+static int32_t getRequestStream(uHttpClientContext_t *pContext,
+                                const char *pPath, size_t *pOffset,
+                                size_t endOffset,
+                                uHttpClientStreamCallback_t *pStreamCallback,
+                                void *pStreamCallbackParam,
+                                char *pContentType)
+{
+    int32_t errorCode;
+    int32_t httpHandle;
+    char range[32];
+    bool ranged = (pOffset != NULL) && ((*pOffset > 0) || (endOffset > 0));
+
+    U_HTTP_CLIENT_REQUEST_ENTRY_FUNCTION(pContext, &errorCode, false);
+
+    if (errorCode == 0) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pPath != NULL) && (pStreamCallback != NULL) &&
+            ((endOffset == 0) || ((pOffset != NULL) && (endOffset > *pOffset)))) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
+                httpHandle = ((uHttpClientContextCell_t *) pContext->pPriv)->httpHandle;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                if (ranged) {
+                    // Only ask for what we don't already have
+                    if (endOffset > 0) {
+                        snprintf(range, sizeof(range), "bytes=%u-%u",
+                                 (unsigned int) *pOffset, (unsigned int) (endOffset - 1));
+                    } else {
+                        snprintf(range, sizeof(range), "bytes=%u-", (unsigned int) *pOffset);
+                    }
+                    errorCode = uCellHttpSetRequestHeader(pContext->devHandle, httpHandle,
+                                                          U_HTTP_CLIENT_CELL_RANGE_HEADER_INDEX,
+                                                          "Range", range);
+                }
+                if (errorCode == 0) {
+                    pContext->pStreamCallback = pStreamCallback;
+                    pContext->pStreamCallbackParam = pStreamCallbackParam;
+                    pContext->pStreamOffset = pOffset;
+                    pContext->streamEndOffset = endOffset;
+                    pContext->pContentType = pContentType;
+                    errorCode = uCellHttpRequest(pContext->devHandle, httpHandle,
+                                                 U_CELL_HTTP_REQUEST_GET, pPath,
+                                                 NULL, NULL, NULL);
+                    if (errorCode != 0) {
+                        // Make sure to forget the user's pointers on error
+                        pContext->pStreamCallback = NULL;
+                        pContext->pStreamCallbackParam = NULL;
+                        pContext->pStreamOffset = NULL;
+                        pContext->streamEndOffset = 0;
+                        pContext->pContentType = NULL;
+                    }
+                    if (ranged) {
+                        // The request has been sent, the header must
+                        // not be sent with the next one
+                        uCellHttpSetRequestHeader(pContext->devHandle, httpHandle,
+                                                  U_HTTP_CLIENT_CELL_RANGE_HEADER_INDEX,
+                                                  NULL, NULL);
+                    }
+                }
+            }
+            if (errorCode == 0) {
+                // Handle blocking
+                errorCode = block((volatile uHttpClientContext_t *) pContext);
+            }
+        }
+    }
+
+    U_HTTP_CLIENT_REQUEST_EXIT_FUNCTION(pContext, errorCode);
+
+    return errorCode;
+}
+
+// Response callback of the contexts used by
+// uHttpClientGetRequestSegmented().
+static void segmentedResponseCallback(uDeviceHandle_t devHandle,
+                                      int32_t statusCodeOrError,
+                                      size_t responseSize,
+                                      void *pResponseCallbackParam)
+{
+    uHttpClientSegmentedSlot_t *pSlot = (uHttpClientSegmentedSlot_t *) pResponseCallbackParam;
+
+    (void) devHandle;
+    (void) responseSize;
+
+    pSlot->statusCodeOrError = statusCodeOrError;
+    pSlot->done = true;
+    uPortSemaphoreGive(pSlot->pSegmented->semaphoreHandle);
+}
+
+// Stream callback of the requests made by
+// uHttpClientGetRequestSegmented(): pass the data on, with its
+// offset, and only then count it as received.
+static bool segmentedStreamCallback(uDeviceHandle_t devHandle,
+                                    const char *pData,
+                                    size_t size,
+                                    void *pStreamCallbackParam)
+{
+    uHttpClientSegmentedSlot_t *pSlot = (uHttpClientSegmentedSlot_t *) pStreamCallbackParam;
+    uHttpClientSegmented_t *pSegmented = pSlot->pSegmented;
+    bool keepGoing = false;
+
+    // The stream offset has already been advanced past pData
+    if (!pSegmented->cancelled &&
+        pSegmented->pCallback(devHandle, pSlot->position - size,
+                              pData, size, pSegmented->pCallbackParam)) {
+        pSlot->pSegment->received = pSlot->position - pSlot->pSegment->offset;
+        keepGoing = true;
+    } else {
+        pSegmented->cancelled = true;
+    }
+
+    return keepGoing;
+}
+
+// Return the first segment that is neither complete nor being
+// fetched by one of the slots of uHttpClientGetRequestSegmented().
+static uHttpClientSegment_t *pNextSegment(const uHttpClientSegmentedSlot_t *pSlot,
+                                         size_t numSlots,
+                                         uHttpClientSegment_t *pSegments,
+                                         size_t numSegments)
+{
+    uHttpClientSegment_t *pSegment = NULL;
+    bool claimed;
+
+    for (size_t x = 0; (pSegment == NULL) && (x < numSegments); x++) {
+        if (pSegments[x].received < pSegments[x].length) {
+            claimed = false;
+            for (size_t y = 0; !claimed && (y < numSlots); y++) {
+                claimed = ((pSlot + y)->pSegment == &(pSegments[x]));
+            }
+            if (!claimed) {
+                pSegment = &(pSegments[x]);
+            }
+        }
+    }
+
+    return pSegment;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -724,6 +1161,7 @@ uHttpClientContext_t *pUHttpClientOpen(uDeviceHandle_t devHandle,
         if (pContext != NULL) {
             // Populate our HTTP context and set up security
             memset(pContext, 0, sizeof (*pContext));
+            pContext->eventQueueHandle = -1;
             pContext->lastRequestTimeMs = -1;
             pContext->devHandle = devHandle;
             pContext->timeoutSeconds = pConnection->timeoutSeconds;
@@ -786,7 +1224,29 @@ int32_t uHttpClientOpenResetLastError()
 // Close the given HTTP client session.
 void uHttpClientClose(uHttpClientContext_t *pContext)
 {
+    uHttpClientQueuedRequest_t done = {0};
+
     if (pContext != NULL) {
+        if (pContext->eventQueueHandle >= 0) {
+            // The queue task needs the request lock, so stop it
+            // first; anything still queued is cancelled.  Closing an
+            // event queue does not wait for its task, which would
+            // then use pContext after it is freed, so queue a marker
+            // behind the requests and wait for the task to reach it
+            pContext->eventQueueClosing = true;
+            done.pContext = pContext;
+            if ((uPortSemaphoreCreate(&(done.doneSemaphoreHandle), 0, 1) == 0) &&
+                (done.doneSemaphoreHandle != NULL)) {
+                if (uPortEventQueueSend(pContext->eventQueueHandle,
+                                        &done, sizeof(done)) == 0) {
+                    uPortSemaphoreTake(done.doneSemaphoreHandle);
+                }
+                uPortSemaphoreDelete(done.doneSemaphoreHandle);
+            }
+            uPortEventQueueClose(pContext->eventQueueHandle);
+            pContext->eventQueueHandle = -1;
+        }
+
         // Call this so as not to pull pContext out from under an
         // existing HTTP request
         U_HTTP_CLIENT_REQUEST_ENTRY_FUNCTION(pContext, NULL, true);
@@ -804,6 +1264,10 @@ void uHttpClientClose(uHttpClientContext_t *pContext)
         }
 
         uPortSemaphoreDelete((uPortSemaphoreHandle_t) pContext->semaphoreHandle);
+        if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL) &&
+            (pContext->pPriv != NULL)) {
+            uPortFree(((uHttpClientContextCell_t *) pContext->pPriv)->pETagCache);
+        }
         uPortFree(pContext->pPriv);
         uPortFree(pContext);
         pContext = NULL;
@@ -965,6 +1429,354 @@ int32_t uHttpClientGetRequest(uHttpClientContext_t *pContext,
     return errorCode;
 }
 
+// Make a conditional HTTP GET request.
+int32_t uHttpClientGetRequestConditional(uHttpClientContext_t *pContext,
+                                         const char *pPath,
+                                         char *pResponseBody, size_t *pSize,
+                                         char *pContentType)
+{
+    int32_t errorCode;
+    uHttpClientContextCell_t *pContextCell;
+    uHttpClientETag_t *pETag = NULL;
+    bool conditional;
+
+    if ((pContext != NULL) && !U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
+        // No way to add a request header: just an ordinary GET
+        errorCode = uHttpClientGetRequest(pContext, pPath, pResponseBody,
+                                          pSize, pContentType);
+    } else {
+        U_HTTP_CLIENT_REQUEST_ENTRY_FUNCTION(pContext, &errorCode, false);
+
+        if (errorCode == 0) {
+            errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+            if (pPath != NULL) {
+                pContextCell = (uHttpClientContextCell_t *) pContext->pPriv;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                // A path that is too long to remember is simply
+                // requested unconditionally
+                conditional = (strlen(pPath) < U_HTTP_CLIENT_ETAG_PATH_LENGTH_BYTES);
+                if (conditional && (pContextCell->pETagCache == NULL)) {
+                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    pContextCell->pETagCache = pUPortMalloc(sizeof(uHttpClientETagCache_t));
+                    if (pContextCell->pETagCache != NULL) {
+                        memset(pContextCell->pETagCache, 0, sizeof(uHttpClientETagCache_t));
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    }
+                }
+                if (conditional && (errorCode == 0)) {
+                    pETag = pCellETagFind(pContextCell->pETagCache, pPath);
+                }
+                if ((pETag != NULL) && (errorCode == 0)) {
+                    errorCode = uCellHttpSetRequestHeader(pContext->devHandle,
+                                                          pContextCell->httpHandle,
+                                                          U_HTTP_CLIENT_CELL_CONDITIONAL_HEADER_INDEX,
+                                                          "If-None-Match", pETag->eTag);
+                }
+                if (errorCode == 0) {
+                    pContextCell->conditional = conditional;
+                    if (conditional) {
+                        strncpy(pContextCell->pETagCache->path, pPath,
+                                sizeof(pContextCell->pETagCache->path));
+                    }
+                    pContext->pResponse = pResponseBody;
+                    pContext->pResponseSize = pSize;
+                    pContext->pContentType = pContentType;
+                    errorCode = uCellHttpRequest(pContext->devHandle,
+                                                 pContextCell->httpHandle,
+                                                 U_CELL_HTTP_REQUEST_GET, pPath,
+                                                 NULL, NULL, NULL);
+                    if (errorCode != 0) {
+                        // Make sure to forget the user's pointers on error
+                        pContextCell->conditional = false;
+                        pContext->pResponse = NULL;
+                        pContext->pResponseSize = NULL;
+                        pContext->pContentType = NULL;
+                    }
+                    if (pETag != NULL) {
+                        // The request has been sent, the header must
+                        // not be sent with the next one
+                        uCellHttpSetRequestHeader(pContext->devHandle,
+                                                  pContextCell->httpHandle,
+                                                  U_HTTP_CLIENT_CELL_CONDITIONAL_HEADER_INDEX,
+                                                  NULL, NULL);
+                    }
+                }
+                if (errorCode == 0) {
+                    // Handle blocking
+                    errorCode = block((volatile uHttpClientContext_t *) pContext);
+                }
+            }
+        }
+
+        U_HTTP_CLIENT_REQUEST_EXIT_FUNCTION(pContext, errorCode);
+    }
+
+    return errorCode;
+}
+
+// Make an HTTP GET request, streaming the response body.
+int32_t uHttpClientGetRequestStream(uHttpClientContext_t *pContext,
+                                    const char *pPath,
+                                    uHttpClientStreamCallback_t *pStreamCallback,
+                                    void *pStreamCallbackParam,
+                                    char *pContentType)
+{
+    return getRequestStream(pContext, pPath, NULL, 0, pStreamCallback,
+                            pStreamCallbackParam, pContentType);
+}
+
+// Make an HTTP GET request, streaming the response body from an offset.
+int32_t uHttpClientGetRequestStreamResume(uHttpClientContext_t *pContext,
+                                          const char *pPath,
+                                          size_t *pOffset,
+                                          uHttpClientStreamCallback_t *pStreamCallback,
+                                          void *pStreamCallbackParam,
+                                          char *pContentType)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (pOffset != NULL) {
+        errorCode = getRequestStream(pContext, pPath, pOffset, 0, pStreamCallback,
+                                     pStreamCallbackParam, pContentType);
+    }
+
+    return errorCode;
+}
+
+// Make an HTTP GET request, streaming a range of the response body.
+int32_t uHttpClientGetRequestStreamRange(uHttpClientContext_t *pContext,
+                                         const char *pPath,
+                                         size_t *pOffset, size_t endOffset,
+                                         uHttpClientStreamCallback_t *pStreamCallback,
+                                         void *pStreamCallbackParam,
+                                         char *pContentType)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (pOffset != NULL) {
+        errorCode = getRequestStream(pContext, pPath, pOffset, endOffset,
+                                     pStreamCallback, pStreamCallbackParam,
+                                     pContentType);
+    }
+
+    return errorCode;
+}
+
+// Divide a resource into segments.
+int32_t uHttpClientSegmentsInit(uHttpClientSegment_t *pSegments,
+                                size_t maxNumSegments,
+                                size_t totalSize, size_t segmentSize)
+{
+    int32_t errorCodeOrNumSegments = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    size_t numSegments;
+
+    if ((pSegments != NULL) && (maxNumSegments > 0) &&
+        (totalSize > 0) && (segmentSize > 0)) {
+        numSegments = (totalSize + segmentSize - 1) / segmentSize;
+        if (numSegments > maxNumSegments) {
+            segmentSize = (totalSize + maxNumSegments - 1) / maxNumSegments;
+            numSegments = (totalSize + segmentSize - 1) / segmentSize;
+        }
+        for (size_t x = 0; x < numSegments; x++) {
+            pSegments[x].offset = x * segmentSize;
+            pSegments[x].length = segmentSize;
+            if (pSegments[x].offset + segmentSize > totalSize) {
+                pSegments[x].length = totalSize - pSegments[x].offset;
+            }
+            pSegments[x].received = 0;
+        }
+        errorCodeOrNumSegments = (int32_t) numSegments;
+    }
+
+    return errorCodeOrNumSegments;
+}
+
+// Fetch a resource in segments.
+int32_t uHttpClientGetRequestSegmented(uHttpClientContext_t **ppContext,
+                                       size_t numContexts,
+                                       const char *pPath,
+                                       uHttpClientSegment_t *pSegments,
+                                       size_t numSegments,
+                                       uHttpClientSegmentCallback_t *pCallback,
+                                       void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uHttpClientSegmented_t segmented = {0};
+    uHttpClientSegmentedSlot_t slot[U_HTTP_CLIENT_SEGMENTED_CONTEXTS_MAX_NUM] = {0};
+    uHttpClientSegmentedSlot_t *pSlot;
+    uHttpClientSegment_t *pSegment;
+    size_t failures = 0;
+    bool inFlight;
+    bool complete = false;
+
+    if ((ppContext != NULL) && (numContexts > 0) &&
+        (numContexts <= U_HTTP_CLIENT_SEGMENTED_CONTEXTS_MAX_NUM) &&
+        (pPath != NULL) && (pSegments != NULL) && (numSegments > 0) &&
+        (pCallback != NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        for (size_t x = 0; (x < numContexts) && (errorCode == 0); x++) {
+            if (ppContext[x] == NULL) {
+                errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+            } else if (!U_DEVICE_IS_TYPE(ppContext[x]->devHandle, U_DEVICE_TYPE_CELL)) {
+                errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            }
+        }
+        if (errorCode == 0) {
+            errorCode = uPortSemaphoreCreate(&segmented.semaphoreHandle, 0, 1);
+        }
+        if (errorCode == 0) {
+            segmented.pCallback = pCallback;
+            segmented.pCallbackParam = pCallbackParam;
+            // Take over the response callbacks of the contexts, which
+            // also makes them non-blocking, so that all of them can
+            // be kept busy at once
+            for (size_t x = 0; x < numContexts; x++) {
+                slot[x].pContext = ppContext[x];
+                slot[x].pSegmented = &segmented;
+                slot[x].pResponseCallback = ppContext[x]->pResponseCallback;
+                slot[x].pResponseCallbackParam = ppContext[x]->pResponseCallbackParam;
+                ppContext[x]->pResponseCallback = segmentedResponseCallback;
+                ppContext[x]->pResponseCallbackParam = &(slot[x]);
+            }
+            do {
+                inFlight = false;
+                for (size_t x = 0; x < numContexts; x++) {
+                    pSlot = &(slot[x]);
+                    if ((pSlot->pSegment != NULL) && !pSlot->done &&
+                        (uPortGetTickTimeMs() - pSlot->startTimeMs >
+                         (pSlot->pContext->timeoutSeconds * 2) * 1000)) {
+                        // Guard against a response that never comes,
+                        // as entryFunctionRequest() does
+                        pSlot->statusCodeOrError = (int32_t) U_ERROR_COMMON_TIMEOUT;
+                        pSlot->done = true;
+                    }
+                    if ((pSlot->pSegment != NULL) && pSlot->done) {
+                        // A request has finished: only worry if
+                        // it did not get all of its segment
+                        pSegment = pSlot->pSegment;
+                        if (pSegment->received > pSlot->receivedAtStart) {
+                            failures = 0;
+                        }
+                        if (pSegment->received < pSegment->length) {
+                            errorCode = pSlot->statusCodeOrError;
+                            if ((errorCode == 200) || (errorCode == 206)) {
+                                errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+                            } else if (errorCode == 0) {
+                                errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
+                            }
+                            if (pSegment->received == pSlot->receivedAtStart) {
+                                failures++;
+                            }
+                        }
+                        pSlot->pSegment = NULL;
+                    }
+                    if ((pSlot->pSegment == NULL) && !segmented.cancelled &&
+                        (failures < U_HTTP_CLIENT_SEGMENTED_RETRIES_MAX)) {
+                        // Find a segment that is still to do and that no
+                        // other context is working on, and ask for it
+                        pSegment = pNextSegment(slot, numContexts, pSegments, numSegments);
+                        if (pSegment != NULL) {
+                            pSlot->pSegment = pSegment;
+                            pSlot->position = pSegment->offset + pSegment->received;
+                            pSlot->receivedAtStart = pSegment->received;
+                            pSlot->statusCodeOrError = 0;
+                            pSlot->done = false;
+                            pSlot->startTimeMs = uPortGetTickTimeMs();
+                            errorCode = getRequestStream(pSlot->pContext, pPath,
+                                                         &(pSlot->position),
+                                                         pSegment->offset + pSegment->length,
+                                                         segmentedStreamCallback, pSlot, NULL);
+                            if (errorCode != 0) {
+                                pSlot->pSegment = NULL;
+                                failures++;
+                            }
+                        }
+                    }
+                    if (pSlot->pSegment != NULL) {
+                        inFlight = true;
+                    }
+                }
+                complete = (pNextSegment(slot, numContexts, pSegments, numSegments) == NULL) &&
+                           !inFlight;
+                if (!complete && (inFlight || (!segmented.cancelled &&
+                                               (failures < U_HTTP_CLIENT_SEGMENTED_RETRIES_MAX)))) {
+                    // Wait for a request to finish or, if none could be
+                    // sent, for a while before trying again
+                    uPortSemaphoreTryTake(segmented.semaphoreHandle, U_HTTP_CLIENT_SEGMENTED_WAIT_MS);
+                    if ((ppContext[0]->pKeepGoingCallback != NULL) &&
+                        !ppContext[0]->pKeepGoingCallback()) {
+                        segmented.cancelled = true;
+                    }
+                }
+            } while (!complete && (inFlight || (!segmented.cancelled &&
+                                                (failures < U_HTTP_CLIENT_SEGMENTED_RETRIES_MAX))));
+            // Give the contexts their own callbacks back
+            for (size_t x = 0; x < numContexts; x++) {
+                ppContext[x]->pResponseCallback = slot[x].pResponseCallback;
+                ppContext[x]->pResponseCallbackParam = slot[x].pResponseCallbackParam;
+            }
+            uPortSemaphoreDelete(segmented.semaphoreHandle);
+            if (complete) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            } else if (segmented.cancelled) {
+                errorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+            } else if (errorCode == 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Queue an HTTP GET request.
+int32_t uHttpClientGetRequestQueue(uHttpClientContext_t *pContext,
+                                   const char *pPath,
+                                   char *pResponseBody, size_t *pSize,
+                                   char *pContentType,
+                                   uHttpClientResponseCallback_t *pCallback,
+                                   void *pCallbackParam)
+{
+    uHttpClientQueuedRequest_t request = {0};
+
+    request.pContext = pContext;
+    request.pPath = pPath;
+    request.pResponseBody = pResponseBody;
+    request.pResponseSize = pSize;
+    request.pResponseContentType = pContentType;
+    request.pCallback = pCallback;
+    request.pCallbackParam = pCallbackParam;
+
+    return requestQueueAdd(&request);
+}
+
+// Queue an HTTP POST request.
+int32_t uHttpClientPostRequestQueue(uHttpClientContext_t *pContext,
+                                    const char *pPath,
+                                    const char *pData, size_t size,
+                                    const char *pContentType,
+                                    char *pResponseBody, size_t *pResponseSize,
+                                    char *pResponseContentType,
+                                    uHttpClientResponseCallback_t *pCallback,
+                                    void *pCallbackParam)
+{
+    uHttpClientQueuedRequest_t request = {0};
+
+    request.pContext = pContext;
+    request.isPost = true;
+    request.pPath = pPath;
+    request.pData = pData;
+    request.size = size;
+    request.pContentType = pContentType;
+    request.pResponseBody = pResponseBody;
+    request.pResponseSize = pResponseSize;
+    request.pResponseContentType = pResponseContentType;
+    request.pCallback = pCallback;
+    request.pCallbackParam = pCallbackParam;
+
+    return requestQueueAdd(&request);
+}
+
 // Make an HTTP HEAD request.
 int32_t uHttpClientHeadRequest(uHttpClientContext_t *pContext,
                                const char *pPath,
@@ -1041,4 +1853,61 @@ int32_t uHttpClientDeleteRequest(uHttpClientContext_t *pContext,
     return errorCode;
 }
 
+// Initialise a streaming HTTP response header parser.
+void uHttpClientHeaderParserInit(uHttpClientHeaderParser_t *pParser,
+                                 char *pContentType,
+                                 uHttpClientHeaderCallback_t *pCallback,
+                                 void *pCallbackParam)
+{
+    if (pParser != NULL) {
+        memset(pParser, 0, sizeof(*pParser));
+        pParser->statusCode = -1;
+        pParser->contentLength = -1;
+        pParser->pContentType = pContentType;
+        pParser->pCallback = pCallback;
+        pParser->pCallbackParam = pCallbackParam;
+        if (pContentType != NULL) {
+            *pContentType = 0;
+        }
+    }
+}
+
+// Parse the next block of an HTTP response.
+size_t uHttpClientHeaderParse(uHttpClientHeaderParser_t *pParser,
+                              const char *pData, size_t size)
+{
+    size_t consumed = 0;
+    char c;
+
+    if ((pParser != NULL) && (pData != NULL)) {
+        while (!pParser->done && (consumed < size)) {
+            c = *(pData + consumed);
+            consumed++;
+            pParser->headerLength++;
+            if (c == '\n') {
+                if (pParser->statusLineLength == 0) {
+                    headerParseLine(pParser);
+                    pParser->statusLineLength = pParser->headerLength;
+                } else if (pParser->lineLength == 0) {
+                    // The blank line at the end of the headers
+                    pParser->done = true;
+                } else {
+                    headerParseLine(pParser);
+                }
+                pParser->lineLength = 0;
+                pParser->lineTruncated = false;
+            } else if (c != '\r') {
+                if (pParser->lineLength < sizeof(pParser->line) - 1) {
+                    pParser->line[pParser->lineLength] = c;
+                    pParser->lineLength++;
+                } else {
+                    pParser->lineTruncated = true;
+                }
+            }
+        }
+    }
+
+    return consumed;
+}
+
 // End of file
@@ -187,6 +187,18 @@ U_WEAK int32_t uCellHttpRequestFile(uDeviceHandle_t cellHandle, int32_t httpHand
     return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
 }
 
+U_WEAK int32_t uCellHttpSetRequestHeader(uDeviceHandle_t cellHandle, int32_t httpHandle,
+                                         int32_t headerIndex, const char *pName,
+                                         const char *pValue)
+{
+    (void) cellHandle;
+    (void) httpHandle;
+    (void) headerIndex;
+    (void) pName;
+    (void) pValue;
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
 U_WEAK int32_t uCellHttpGetLastErrorCode(uDeviceHandle_t cellHandle, int32_t httpHandle)
 {
     (void) cellHandle;
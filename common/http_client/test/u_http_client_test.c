@@ -220,6 +220,10 @@ static char *gpDataBufferIn = NULL;
  */
 static size_t gSizeDataBufferIn = 0;
 
+/** The offset for uHttpClientGetRequestStreamResume().
+ */
+static size_t gStreamOffset = 0;
+
 /** A place to hook the buffer for content type.
  */
 static char *gpContentTypeBuffer = NULL;
@@ -327,6 +331,61 @@ static void httpCallback(uDeviceHandle_t devHandle,
     }
 }
 
+// Callback for uHttpClientGetRequestStream(): append the data to
+// gpDataBufferIn, pParam pointing to the amount of storage there.
+static bool streamCallback(uDeviceHandle_t devHandle,
+                           const char *pData, size_t size,
+                           void *pStreamCallbackParam)
+{
+    size_t sizeStorage = *((size_t *) pStreamCallbackParam);
+
+    (void) devHandle;
+
+    if (size > sizeStorage - gSizeDataBufferIn) {
+        size = sizeStorage - gSizeDataBufferIn;
+    }
+    memcpy(gpDataBufferIn + gSizeDataBufferIn, pData, size);
+    gSizeDataBufferIn += size;
+
+    return true;
+}
+
+// Callback for uHttpClientGetRequestSegmented(): put the data into
+// gpDataBufferIn at its offset, pParam pointing to the amount of
+// storage there.
+static bool streamSegmentCallback(uDeviceHandle_t devHandle,
+                                  size_t offset, const char *pData,
+                                  size_t size, void *pParam)
+{
+    bool keepGoing = false;
+
+    (void) devHandle;
+
+    if ((pParam != NULL) && (gpDataBufferIn != NULL) &&
+        (offset + size <= *((size_t *) pParam))) {
+        memcpy(gpDataBufferIn + offset, pData, size);
+        gSizeDataBufferIn += size;
+        keepGoing = true;
+    }
+
+    return keepGoing;
+}
+
+// Callback for uHttpClientHeaderParse(), which counts the headers
+// and checks that a custom one arrives intact.
+static void headerCallback(const char *pName, const char *pValue,
+                           void *pParam)
+{
+    int32_t *pCount = (int32_t *) pParam;
+
+    if (pCount != NULL) {
+        (*pCount)++;
+        if ((strcmp(pName, "X-Thing") == 0) && (strcmp(pValue, "a b") != 0)) {
+            *pCount = -1000;
+        }
+    }
+}
+
 // Fill a buffer with binary 0 to 255.
 static void bufferFill(char *pBuffer, size_t size)
 {
@@ -566,6 +625,121 @@ static int32_t checkResponse(uHttpClientTestOperation_t operation,
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
 
+/** Test the division of a resource into segments for
+ * uHttpClientGetRequestSegmented(), and its parameter checking;
+ * no device is required.
+ */
+U_PORT_TEST_FUNCTION("[httpClient]", "httpClientSegments")
+{
+    uHttpClientSegment_t segment[4];
+    uHttpClientContext_t *pContext = NULL;
+    size_t total;
+
+    U_TEST_PRINT_LINE("testing segments.");
+
+    U_PORT_TEST_ASSERT(uHttpClientSegmentsInit(NULL, 4, 1000, 100) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientSegmentsInit(segment, 0, 1000, 100) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientSegmentsInit(segment, 4, 0, 100) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientSegmentsInit(segment, 4, 1000, 0) < 0);
+
+    // Segments that fit, the last one short
+    U_PORT_TEST_ASSERT(uHttpClientSegmentsInit(segment, 4, 1000, 300) == 4);
+    U_PORT_TEST_ASSERT((segment[0].offset == 0) && (segment[0].length == 300));
+    U_PORT_TEST_ASSERT((segment[2].offset == 600) && (segment[2].length == 300));
+    U_PORT_TEST_ASSERT((segment[3].offset == 900) && (segment[3].length == 100));
+
+    // Too many segments: they are made bigger
+    U_PORT_TEST_ASSERT(uHttpClientSegmentsInit(segment, 4, 1001, 100) == 4);
+    total = 0;
+    for (size_t x = 0; x < 4; x++) {
+        U_PORT_TEST_ASSERT(segment[x].offset == total);
+        U_PORT_TEST_ASSERT(segment[x].received == 0);
+        total += segment[x].length;
+    }
+    U_PORT_TEST_ASSERT(total == 1001);
+
+    // One segment for a small resource
+    U_PORT_TEST_ASSERT(uHttpClientSegmentsInit(segment, 4, 10, 100) == 1);
+    U_PORT_TEST_ASSERT((segment[0].offset == 0) && (segment[0].length == 10));
+
+    // Bad parameters for the download itself
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestSegmented(NULL, 1, "/x", segment, 1,
+                                                      streamSegmentCallback, NULL) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestSegmented(&pContext, 0, "/x", segment, 1,
+                                                      streamSegmentCallback, NULL) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestSegmented(&pContext, 1, "/x", segment, 1,
+                                                      streamSegmentCallback, NULL) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestSegmented(&pContext, 1, "/x", segment, 1,
+                                                      NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestStreamRange(NULL, "/x", &total, 0,
+                                                        streamCallback, NULL, NULL) < 0);
+}
+
+/** Test the streaming parser of HTTP response headers, feeding it
+ * in blocks of every size; no device is required.
+ */
+U_PORT_TEST_FUNCTION("[httpClient]", "httpClientHeaderParse")
+{
+    const char *pResponse = "HTTP/1.1 304 Not Modified\r\n"
+                            "content-length:  12 \r\n"
+                            "X-Thing: a b\r\n"
+                            "Content-Type: text/plain\r\n"
+                            "ETAG: \"abc123\"\r\n"
+                            "\r\n"
+                            "body";
+    const char *pLongETag = "HTTP/1.0 200 OK\r\nETag: \""
+                            "012345678901234567890123456789012345678901234567890123456789"
+                            "0123456789\"\r\n\r\n";
+    uHttpClientHeaderParser_t *pParser;
+    char contentType[U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES];
+    size_t length = strlen(pResponse);
+    size_t consumed;
+    int32_t count;
+
+    U_TEST_PRINT_LINE("testing header parser.");
+
+    pParser = (uHttpClientHeaderParser_t *) pUPortMalloc(sizeof(*pParser));
+    U_PORT_TEST_ASSERT(pParser != NULL);
+
+    for (size_t blockSize = 1; blockSize <= length; blockSize++) {
+        count = 0;
+        uHttpClientHeaderParserInit(pParser, contentType, headerCallback, &count);
+        consumed = 0;
+        while ((consumed < length) && !pParser->done) {
+            consumed += uHttpClientHeaderParse(pParser, pResponse + consumed,
+                                               (length - consumed < blockSize) ?
+                                               length - consumed : blockSize);
+        }
+        U_PORT_TEST_ASSERT(pParser->done);
+        U_PORT_TEST_ASSERT(consumed == length - 4);
+        U_PORT_TEST_ASSERT(pParser->headerLength == length - 4);
+        U_PORT_TEST_ASSERT(pParser->statusLineLength == 27);
+        U_PORT_TEST_ASSERT(pParser->statusCode == 304);
+        U_PORT_TEST_ASSERT(pParser->contentLength == 12);
+        U_PORT_TEST_ASSERT(strcmp(pParser->eTag, "\"abc123\"") == 0);
+        U_PORT_TEST_ASSERT(strcmp(contentType, "text/plain") == 0);
+        U_PORT_TEST_ASSERT(count == 4);
+    }
+
+    // An ETag too long to keep is not kept at all
+    uHttpClientHeaderParserInit(pParser, NULL, NULL, NULL);
+    uHttpClientHeaderParse(pParser, pLongETag, strlen(pLongETag));
+    U_PORT_TEST_ASSERT(pParser->done);
+    U_PORT_TEST_ASSERT(pParser->statusCode == 200);
+    U_PORT_TEST_ASSERT(pParser->contentLength == -1);
+    U_PORT_TEST_ASSERT(pParser->eTag[0] == 0);
+
+    // Not HTTP at all
+    uHttpClientHeaderParserInit(pParser, NULL, NULL, NULL);
+    uHttpClientHeaderParse(pParser, "HTTX/1.1 200 OK\r\n\r\n", 19);
+    U_PORT_TEST_ASSERT(pParser->done);
+    U_PORT_TEST_ASSERT(pParser->statusCode == -1);
+
+    uPortFree(pParser);
+
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestConditional(NULL, "/x", NULL, NULL, NULL) < 0);
+}
+
 /** Test HTTP connectivity.
  *
  * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
@@ -910,6 +1084,16 @@ U_PORT_TEST_FUNCTION("[httpClient]", "httpClient")
             for (size_t y = 0; y < httpClientMaxNumConn; y++) {
                 uHttpClientClose(gpHttpContext[y]);
             }
+            if (deviceType == U_DEVICE_TYPE_SHORT_RANGE) {
+                // Wi-Fi HTTP keeps the peer connections of closed
+                // instances open in a pool, unless the server has
+                // since closed them: flushing closes what is left
+                outcome = uShortRangePeerPoolFlush(devHandle);
+                U_TEST_PRINT_LINE("%d idle peer connection(s) flushed.", outcome);
+                U_PORT_TEST_ASSERT((outcome >= 0) &&
+                                   (outcome <= U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES));
+                U_PORT_TEST_ASSERT(uShortRangePeerPoolFlush(devHandle) == 0);
+            }
         } // for (HTTP and HTTPS)
     }
 
@@ -947,6 +1131,170 @@ U_PORT_TEST_FUNCTION("[httpClient]", "httpClient")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test the streamed forms of GET, uHttpClientGetRequestStream()
+ * and uHttpClientGetRequestStreamResume(), which are only supported
+ * on cellular: PUT a file, stream it back both whole and from half
+ * way through, then DELETE it.
+ */
+U_PORT_TEST_FUNCTION("[httpClient]", "httpClientStream")
+{
+    uNetworkTestList_t *pList;
+    uDeviceHandle_t devHandle;
+    uHttpClientConnection_t connection = U_HTTP_CLIENT_CONNECTION_DEFAULT;
+    int32_t resourceCount = 0;
+    char urlBuffer[64];
+    char serialNumber[U_SECURITY_SERIAL_NUMBER_MAX_LENGTH_BYTES];
+    char pathBuffer[32];
+    size_t dataSizeBytes = U_HTTP_CLIENT_TEST_DATA_SIZE_BYTES;
+    int32_t errorOrStatusCode;
+    size_t tries;
+
+    // In case a previous test failed
+    uNetworkTestCleanUp();
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+
+    // Get the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Do the standard preamble
+    pList = pStdPreamble();
+
+    // Get storage for what we're going to PUT/GET
+    gpDataBufferOut = (char *) pUPortMalloc(dataSizeBytes);
+    U_PORT_TEST_ASSERT(gpDataBufferOut != NULL);
+    gpDataBufferIn = (char *) pUPortMalloc(dataSizeBytes);
+    U_PORT_TEST_ASSERT(gpDataBufferIn != NULL);
+    gpContentTypeBuffer = (char *) pUPortMalloc(U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(gpContentTypeBuffer != NULL);
+
+    snprintf(urlBuffer, sizeof(urlBuffer), "%s:%d",
+             U_HTTP_CLIENT_TEST_SERVER_DOMAIN_NAME, (int) U_HTTP_CLIENT_TEST_SERVER_PORT);
+    connection.pServerName = urlBuffer;
+
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        devHandle = *pTmp->pDevHandle;
+        if (uDeviceGetDeviceType(devHandle) != (int32_t) U_DEVICE_TYPE_CELL) {
+            U_TEST_PRINT_LINE("streamed GET is only supported on cellular, skipping %s.",
+                              gpUNetworkTestDeviceTypeName[pTmp->pDeviceCfg->deviceType]);
+            continue;
+        }
+
+        // Get a unique number we can use to stop parallel
+        // tests colliding at the HTTP server
+        U_PORT_TEST_ASSERT(uSecurityGetSerialNumber(devHandle, serialNumber) > 0);
+        snprintf(pathBuffer, sizeof(pathBuffer), "/%.16s_stream.html", serialNumber);
+
+        gpHttpContext[0] = pUHttpClientOpen(devHandle, &connection, NULL);
+        U_PORT_TEST_ASSERT(gpHttpContext[0] != NULL);
+
+        // PUT the file
+        bufferFill(gpDataBufferOut, dataSizeBytes);
+        errorOrStatusCode = -1;
+        for (tries = 0; (errorOrStatusCode != 200) &&
+             (tries < HTTP_CLIENT_TEST_MAX_TRIES_UNKNOWN); tries++) {
+            U_TEST_PRINT_LINE("PUT %d byte(s) to %s...", dataSizeBytes, pathBuffer);
+            errorOrStatusCode = uHttpClientPutRequest(gpHttpContext[0], pathBuffer,
+                                                      gpDataBufferOut, dataSizeBytes,
+                                                      U_HTTP_CLIENT_TEST_CONTENT_TYPE);
+            // Give the module a rest betweeen tries
+            uPortTaskBlock(1000);
+        }
+        U_PORT_TEST_ASSERT(errorOrStatusCode == 200);
+
+        // Stream the whole file back
+        errorOrStatusCode = -1;
+        for (tries = 0; (errorOrStatusCode != 200) &&
+             (tries < HTTP_CLIENT_TEST_MAX_TRIES_UNKNOWN); tries++) {
+            memset(gpDataBufferIn, 0xFF, dataSizeBytes);
+            memset(gpContentTypeBuffer, 0xFF, U_HTTP_CLIENT_CONTENT_TYPE_LENGTH_BYTES);
+            gSizeDataBufferIn = 0;
+            U_TEST_PRINT_LINE("streamed GET of %s...", pathBuffer);
+            errorOrStatusCode = uHttpClientGetRequestStream(gpHttpContext[0], pathBuffer,
+                                                            streamCallback, &dataSizeBytes,
+                                                            gpContentTypeBuffer);
+            uPortTaskBlock(1000);
+        }
+        U_TEST_PRINT_LINE("status %d, %d byte(s) streamed.", errorOrStatusCode,
+                          gSizeDataBufferIn);
+        U_PORT_TEST_ASSERT(errorOrStatusCode == 200);
+        U_PORT_TEST_ASSERT(gSizeDataBufferIn == dataSizeBytes);
+        U_PORT_TEST_ASSERT(bufferCheck(gpDataBufferIn, dataSizeBytes) == 0);
+        U_PORT_TEST_ASSERT(strncmp(gpContentTypeBuffer, U_HTTP_CLIENT_TEST_CONTENT_TYPE,
+                                   strlen(U_HTTP_CLIENT_TEST_CONTENT_TYPE)) == 0);
+
+        // Stream the second half again, as if resuming
+        errorOrStatusCode = -1;
+        for (tries = 0; (errorOrStatusCode != 200) && (errorOrStatusCode != 206) &&
+             (errorOrStatusCode != (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) &&
+             (tries < HTTP_CLIENT_TEST_MAX_TRIES_UNKNOWN); tries++) {
+            memset(gpDataBufferIn + (dataSizeBytes / 2), 0xFF, dataSizeBytes - (dataSizeBytes / 2));
+            gSizeDataBufferIn = dataSizeBytes / 2;
+            gStreamOffset = dataSizeBytes / 2;
+            U_TEST_PRINT_LINE("resumed streamed GET of %s from offset %d...",
+                              pathBuffer, gStreamOffset);
+            errorOrStatusCode = uHttpClientGetRequestStreamResume(gpHttpContext[0], pathBuffer,
+                                                                  &gStreamOffset,
+                                                                  streamCallback, &dataSizeBytes,
+                                                                  NULL);
+            uPortTaskBlock(1000);
+        }
+        U_TEST_PRINT_LINE("status %d, offset now %d.", errorOrStatusCode, gStreamOffset);
+        if (errorOrStatusCode == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+            U_TEST_PRINT_LINE("resumed streamed GET not supported by this module.");
+        } else {
+            U_PORT_TEST_ASSERT((errorOrStatusCode == 200) || (errorOrStatusCode == 206));
+            U_PORT_TEST_ASSERT(gStreamOffset == dataSizeBytes);
+            U_PORT_TEST_ASSERT(gSizeDataBufferIn == dataSizeBytes);
+            U_PORT_TEST_ASSERT(bufferCheck(gpDataBufferIn, dataSizeBytes) == 0);
+        }
+
+        // DELETE the file again
+        U_TEST_PRINT_LINE("DELETE of %s...", pathBuffer);
+        errorOrStatusCode = uHttpClientDeleteRequest(gpHttpContext[0], pathBuffer);
+        U_TEST_PRINT_LINE("status %d.", errorOrStatusCode);
+
+        uHttpClientClose(gpHttpContext[0]);
+        gpHttpContext[0] = NULL;
+    }
+
+    // Free memory
+    uPortFree(gpDataBufferOut);
+    gpDataBufferOut = NULL;
+    uPortFree(gpDataBufferIn);
+    gpDataBufferIn = NULL;
+    uPortFree(gpContentTypeBuffer);
+    gpContentTypeBuffer = NULL;
+
+    // Close the devices once more and free the list
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        if (*pTmp->pDevHandle != NULL) {
+            U_TEST_PRINT_LINE("taking down %s...",
+                              gpUNetworkTestTypeName[pTmp->networkType]);
+            U_PORT_TEST_ASSERT(uNetworkInterfaceDown(*pTmp->pDevHandle,
+                                                     pTmp->networkType) == 0);
+            U_TEST_PRINT_LINE("closing device %s...",
+                              gpUNetworkTestDeviceTypeName[pTmp->pDeviceCfg->deviceType]);
+            U_PORT_TEST_ASSERT(uDeviceClose(*pTmp->pDevHandle, false) == 0);
+            *pTmp->pDevHandle = NULL;
+        }
+    }
+    uNetworkTestListFree();
+    // Clean-up TLS security mutex; an application wouldn't normally,
+    // do this, we only do it here to make the sums add up
+    uSecurityTlsCleanUp();
+    uDeviceDeinit();
+    uPortDeinit();
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
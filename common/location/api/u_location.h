@@ -91,6 +91,13 @@ extern "C" {
 # define U_LOCATION_CLOUD_LOCATE_RRLP_DATA_LENGTH_BYTES 0x7FFFFFFF
 #endif
 
+#ifndef U_LOCATION_CLOUD_LOCATE_RRLP_BATCH_SNAPSHOTS
+/** The number of RRLP snapshots that Cloud Locate collects before
+ * sending them in one MQTT message; default is one, no batching.
+ */
+# define U_LOCATION_CLOUD_LOCATE_RRLP_BATCH_SNAPSHOTS 1
+#endif
+
 #ifndef U_LOCATION_ACCESS_POINTS_FILTER_DEFAULT
 /** The default number of Wifi access points that must be visible
  * to make a position request based on them: 5 is the minimum.
@@ -117,7 +124,24 @@ extern "C" {
                                      NULL, NULL,                                                \
                                      U_LOCATION_CLOUD_LOCATE_RRLP_DATA_LENGTH_BYTES,            \
                                      U_LOCATION_ACCESS_POINTS_FILTER_DEFAULT,                   \
-                                     U_LOCATION_RSSI_DBM_FILTER_DEFAULT}
+                                     U_LOCATION_RSSI_DBM_FILTER_DEFAULT,                        \
+                                     U_LOCATION_CLOUD_LOCATE_RRLP_BATCH_SNAPSHOTS}
+#endif
+
+#ifndef U_LOCATION_HYBRID_MAX_NUM_SOURCES
+/** The maximum number of sources that uLocationGetHybrid() can
+ * race against each other.
+ */
+# define U_LOCATION_HYBRID_MAX_NUM_SOURCES 4
+#endif
+
+#ifndef U_LOCATION_ADAPTIVE_CFG_DEFAULTS
+/** Default values for #uLocationAdaptiveCfg_t: a fix every second
+ * while moving, falling to one a minute once there has been no sign
+ * of motion for two minutes, with the GNSS power-saving mode
+ * following the rate.
+ */
+# define U_LOCATION_ADAPTIVE_CFG_DEFAULTS {1000, 60000, 1000, 25000, 120000, true}
 #endif
 
 /* ----------------------------------------------------------------
@@ -235,7 +259,11 @@ typedef struct {
                                       unlimited (in which case the MEASX mode will be
                                       used), 50 for MEAS50 and 20 for MEAS20.  Only
                                       GNSS modules M10 or higher support the
-                                      MEAS50/MEAS20 modes. */
+                                      MEAS50/MEAS20 modes.  Use zero to have the
+                                      mode chosen for each snapshot: MEAS50, where
+                                      the GNSS module supports it and the signals
+                                      are strong enough for it to be as accurate
+                                      as MEASX, else MEASX. */
 
     /* The following fields are ONLY used by U_LOCATION_TYPE_CLOUD_GOOGLE,
        U_LOCATION_TYPE_CLOUD_SKYHOOK and U_LOCATION_TYPE_CLOUD_HERE. */
@@ -246,6 +274,25 @@ typedef struct {
     int32_t rssiDbmFilter;      /**< ignore Wi-Fi access points with received
                                      signal strength less than this,
                                      range -100 dBm to 0 dBm. */
+
+    /* The following field is ONLY used by U_LOCATION_TYPE_CLOUD_CLOUD_LOCATE
+       and is placed here, at the end, to avoid breaking existing code. */
+
+    int32_t rrlpBatchSnapshots; /**< the number of RRLP snapshots to collect
+                                     before sending them all to Cloud Locate in
+                                     a single MQTT message, which saves on the
+                                     overhead of a message per snapshot when,
+                                     for instance, tracking a device; each call
+                                     to uLocationGet() takes one snapshot and
+                                     returns success without a location until
+                                     the batch is sent.  Only used when
+                                     pClientIdStr is NULL, i.e. when the location
+                                     is only needed in the cloud.  Each snapshot
+                                     is sent as a complete UBX frame, header and
+                                     checksum included, so that they can be told
+                                     apart.  Zero or one means no batching.  Call
+                                     uLocationCloudLocateFlush() to send a part-
+                                     filled batch. */
 } uLocationAssist_t;
 
 /** Definition of a location.
@@ -274,6 +321,49 @@ typedef struct {
                           if this is not available -1 will be returned. */
 } uLocation_t;
 
+/** A source of location for uLocationGetHybrid(): the fields
+ * are as for the parameters of the same name to uLocationGetStart().
+ */
+typedef struct {
+    uDeviceHandle_t devHandle;
+    uLocationType_t type;
+    const uLocationAssist_t *pLocationAssist;
+    const char *pAuthenticationTokenStr;
+} uLocationHybridSource_t;
+
+/** The policy of uLocationGetContinuousStartAdaptive().
+ */
+typedef struct {
+    int32_t movingRateMs;     /**< the location rate while the device
+                                   is moving, in milliseconds. */
+    int32_t stationaryRateMs; /**< the location rate, the floor, once
+                                   the device has been stationary for
+                                   stationaryTimeMs; must be no smaller
+                                   than movingRateMs. */
+    int32_t movingSpeedMillimetresPerSecond; /**< a GNSS speed at or above
+                                                  this is taken as motion;
+                                                  zero or less to not use
+                                                  speed. */
+    int32_t movingDistanceMillimetres; /**< a location this far, or further
+                                            if the radius of the fix is
+                                            larger, from where the device
+                                            was last seen moving is taken
+                                            as motion, covering a change
+                                            of heading at low speeds;
+                                            zero or less to not use
+                                            distance. */
+    int32_t stationaryTimeMs;  /**< how long without any sign of motion,
+                                    from GNSS or from
+                                    uLocationAdaptiveMotion(), before the
+                                    device is taken to be stationary. */
+    bool gnssPwrFollowsRate;   /**< if true the power-saving mode of the
+                                    GNSS device follows the rate: no
+                                    power saving (cyclic tracking for M8
+                                    devices, which have no such mode) at
+                                    rates faster than ten seconds, on/off
+                                    at slower rates. */
+} uLocationAdaptiveCfg_t;
+
 /** The possible states a location establishment
  * attempt can be in.
  */
@@ -565,6 +655,8 @@ int32_t uLocationGetStatus(uDeviceHandle_t devHandle);
  * this function the callback passed to those functions will not be called until
  * another uLocationGetStart() / uLocationGetContinuousStart() is begun.
  *
+ * This also stops a uLocationGetContinuousStartAdaptive().
+ *
  * Note: location via Wifi allocates memory for asynchronous location
  * operations when first called that may never be released: see that API for
  * how to free such memory.
@@ -573,6 +665,118 @@ int32_t uLocationGetStatus(uDeviceHandle_t devHandle);
  */
 void uLocationGetStop(uDeviceHandle_t devHandle);
 
+/** Get the current location from several sources at once, e.g. GNSS,
+ * Cell Locate and Wi-Fi across the devices that the application has
+ * open, returning the first location that meets the accuracy target;
+ * time-to-location is then that of the quickest source rather than
+ * that of the slowest.  Each source is started as if by
+ * uLocationGetStart() and, as soon as one returns a location with
+ * a radius no larger than accuracyTargetMillimetres, the sources
+ * that have not yet returned are cancelled (with uLocationGetStop()).
+ * If no source meets the target then the most accurate of the
+ * locations returned is given once all of the sources have finished
+ * or pKeepGoingCallback returns false.
+ *
+ * Since each source is run as an asynchronous request, the devices
+ * involved should have no other asynchronous location request
+ * outstanding while this function is running, no two sources may
+ * share the same mechanism (e.g. two GNSS sources, one a GNSS device
+ * and the other GNSS inside a cellular device) and only one call to
+ * this function may be in progress at a time.
+ * #U_LOCATION_TYPE_CLOUD_CLOUD_LOCATE is not supported.
+ *
+ * @param[in] pSources             the sources, an array of numSources;
+ *                                 cannot be NULL.
+ * @param numSources               the number of sources at pSources, from
+ *                                 1 to #U_LOCATION_HYBRID_MAX_NUM_SOURCES.
+ * @param accuracyTargetMillimetres the radius that a location must have in
+ *                                 order to be returned straight away; use -1
+ *                                 to return the first location that arrives,
+ *                                 whatever its accuracy.
+ * @param[out] pLocation           a place to put the location; may be NULL.
+ * @param pKeepGoingCallback       a callback function that governs how long
+ *                                 location establishment is allowed to take,
+ *                                 called with the device handle of the first
+ *                                 source while waiting; location establishment
+ *                                 continues while it returns true.  May be
+ *                                 NULL, in which case location establishment
+ *                                 will stop when #U_LOCATION_TIMEOUT_SECONDS
+ *                                 have elapsed.
+ * @return                         zero on success or negative error code
+ *                                 on failure.
+ */
+int32_t uLocationGetHybrid(const uLocationHybridSource_t *pSources,
+                           size_t numSources,
+                           int32_t accuracyTargetMillimetres,
+                           uLocation_t *pLocation,
+                           bool (*pKeepGoingCallback) (uDeviceHandle_t));
+
+/** As uLocationGetContinuousStart() but with a rate that adapts to
+ * motion, which can make a very large difference to the battery life
+ * of a tracker: while the device is moving location is established at
+ * movingRateMs and, once there has been no sign of motion for
+ * stationaryTimeMs, the rate falls to stationaryRateMs; see
+ * #uLocationAdaptiveCfg_t.  Motion is detected from the speed and
+ * position of the GNSS fixes and, if the application calls
+ * uLocationAdaptiveMotion() from, for instance, the motion callback
+ * of an accelerometer, from that.  The rate is changed while
+ * position streaming continues, from a task of this API, and, where
+ * gnssPwrFollowsRate is set, the GNSS power-saving mode is changed
+ * with it (see uGnssPwrSetMode() for the implications of
+ * power-saving on communication with the GNSS device).
+ *
+ * Only GNSS location is [currently] supported, i.e. a GNSS device or
+ * a cellular device with type #U_LOCATION_TYPE_GNSS, and only one
+ * adaptive location may be running at a time.  Call uLocationGetStop()
+ * to stop; the GNSS power-saving mode is then returned to what it was
+ * when this function was called, though the power-saving timings are
+ * not.
+ *
+ * @param devHandle               the device handle to use.
+ * @param[in] pCfg                the adaptive policy, cannot be NULL;
+ *                                this is copied.
+ * @param type                    the type of location fix to perform, only
+ *                                #U_LOCATION_TYPE_GNSS is supported.
+ * @param[in] pLocationAssist     as for uLocationGetContinuousStart().
+ * @param pAuthenticationTokenStr as for uLocationGetContinuousStart().
+ * @param pCallback               the callback, as for
+ *                                uLocationGetContinuousStart().
+ * @return                        zero on success or negative error code on
+ *                                failure.
+ */
+int32_t uLocationGetContinuousStartAdaptive(uDeviceHandle_t devHandle,
+                                            const uLocationAdaptiveCfg_t *pCfg,
+                                            uLocationType_t type,
+                                            const uLocationAssist_t *pLocationAssist,
+                                            const char *pAuthenticationTokenStr,
+                                            void (*pCallback) (uDeviceHandle_t devHandle,
+                                                               int32_t errorCode,
+                                                               const uLocation_t *pLocation));
+
+/** Tell a uLocationGetContinuousStartAdaptive() that the device is
+ * moving, for instance when an accelerometer reports motion; the
+ * moving rate applies at once, without waiting for the next fix to
+ * show it.  This function does not block and may be called as often
+ * as is convenient, however it must NOT be called from an interrupt.
+ *
+ * @param devHandle the device handle that was passed to
+ *                  uLocationGetContinuousStartAdaptive().
+ * @return          zero on success or negative error code on failure.
+ */
+int32_t uLocationAdaptiveMotion(uDeviceHandle_t devHandle);
+
+/** Send any RRLP snapshots that Cloud Locate is holding in a batch
+ * (see the rrlpBatchSnapshots field of #uLocationAssist_t) and free
+ * the memory of the batch; call this before logging out of the
+ * Cloud Locate service.
+ *
+ * @param pMqttClientContext the context of an MQTT client that is
+ *                           logged-in to the Cloud Locate service;
+ *                           if this is NULL the batch is discarded.
+ * @return                   zero on success else negative error code.
+ */
+int32_t uLocationCloudLocateFlush(void *pMqttClientContext);
+
 #ifdef __cplusplus
 }
 #endif
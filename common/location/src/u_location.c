@@ -32,6 +32,7 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // memset()
 
 #include "u_cfg_os_platform_specific.h"  // For U_CFG_OS_YIELD_MS
 
@@ -39,8 +40,10 @@
 
 #include "u_device_shared.h"
 
+#include "u_port.h"
 #include "u_port_os.h"
 #include "u_port_heap.h"
+#include "u_port_event_queue.h"
 
 #include "u_cell_loc.h"
 
@@ -49,6 +52,7 @@
 #include "u_gnss.h"
 #include "u_gnss_cfg.h"
 #include "u_gnss_pos.h"
+#include "u_gnss_pwr.h"
 
 #include "u_mqtt_common.h"  // Needed by
 #include "u_mqtt_client.h"  // u_location_private_cloud_locate.h
@@ -67,14 +71,107 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** How often uLocationGetHybrid() checks on its sources.
+ */
+#define U_LOCATION_HYBRID_POLL_INTERVAL_MS 100
+
+#ifndef U_LOCATION_ADAPTIVE_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that changes the rate of
+ * uLocationGetContinuousStartAdaptive().
+ */
+# define U_LOCATION_ADAPTIVE_TASK_STACK_SIZE_BYTES (1024 * 3)
+#endif
+
+#ifndef U_LOCATION_ADAPTIVE_TASK_PRIORITY
+/** The priority of the task that changes the rate of
+ * uLocationGetContinuousStartAdaptive().
+ */
+# define U_LOCATION_ADAPTIVE_TASK_PRIORITY (U_CFG_OS_PRIORITY_MIN + 2)
+#endif
+
+#ifndef U_LOCATION_ADAPTIVE_PWR_ON_OFF_RATE_MS
+/** The rate at or above which uLocationGetContinuousStartAdaptive()
+ * puts the GNSS device into on/off power-saving mode.
+ */
+# define U_LOCATION_ADAPTIVE_PWR_ON_OFF_RATE_MS 10000
+#endif
+
+/** The number of millimetres in a ten millionth of a degree of
+ * latitude, multiplied by 1000.
+ */
+#define U_LOCATION_MILLIMETRES_PER_DEGREE_X1E7_X1000 11132
+
+/** The coalescing key of adaptive location events carrying a fix;
+ * since there is also a key for motion events, an event queue of
+ * length two can never be full.
+ */
+#define U_LOCATION_ADAPTIVE_EVENT_KEY_FIX 0
+
+/** The coalescing key of adaptive location motion events.
+ */
+#define U_LOCATION_ADAPTIVE_EVENT_KEY_MOTION 1
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The state of a uLocationGetHybrid() call, protected by
+ * gULocationMutex; each source is identified by the FIFO its
+ * asynchronous request is pushed to, hence they must all differ.
+ */
+typedef struct {
+    bool active;
+    int32_t accuracyTargetMillimetres;
+    size_t numSources;
+    uLocationSharedFifo_t fifo[U_LOCATION_HYBRID_MAX_NUM_SOURCES];
+    bool complete[U_LOCATION_HYBRID_MAX_NUM_SOURCES];
+    size_t numComplete;
+    bool targetMet;
+    bool haveLocation;
+    uLocation_t location;  /**< the most accurate location so far. */
+    int32_t errorCode;     /**< the first error, if there is no location. */
+} uLocationHybrid_t;
+
+/** The state of uLocationGetContinuousStartAdaptive(); active,
+ * pCallback and eventQueueHandle are protected by gULocationMutex,
+ * the rest belong to the event task once it has been started.
+ */
+typedef struct {
+    bool active;
+    uDeviceHandle_t devHandle;
+    uLocationAdaptiveCfg_t cfg;
+    void (*pCallback) (uDeviceHandle_t devHandle,
+                       int32_t errorCode,
+                       const uLocation_t *pLocation);
+    int32_t eventQueueHandle;
+    int32_t rateMs;
+    int32_t lastMotionTimeMs;
+    bool haveAnchor;
+    int32_t anchorLatitudeX1e7;  /**< where the device was last seen moving. */
+    int32_t anchorLongitudeX1e7;
+    int32_t pwrModeOriginal;     /**< negative if it is not to be restored. */
+} uLocationAdaptive_t;
+
+/** An event for the task of uLocationGetContinuousStartAdaptive().
+ */
+typedef struct {
+    bool motion;       /**< true if from uLocationAdaptiveMotion(). */
+    int32_t errorCode;
+    uLocation_t location;
+} uLocationAdaptiveEvent_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
 
+/** The state of uLocationGetHybrid().
+ */
+static uLocationHybrid_t gHybrid = {0};
+
+/** The state of uLocationGetContinuousStartAdaptive().
+ */
+static uLocationAdaptive_t gAdaptive = {0};
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTION PROTOTYPES
  * -------------------------------------------------------------- */
@@ -413,6 +510,238 @@ int32_t startAsync(uDeviceHandle_t devHandle, int32_t desiredRateMs,
     return errorCode;
 }
 
+// Work out the FIFO that a location request of the given type
+// on the given device will be pushed to.
+static uLocationSharedFifo_t hybridFifo(uDeviceHandle_t devHandle,
+                                        uLocationType_t type)
+{
+    uLocationSharedFifo_t fifo = U_LOCATION_SHARED_FIFO_NONE;
+    int32_t devType = uDeviceGetDeviceType(devHandle);
+
+    if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
+        if ((type == U_LOCATION_TYPE_CLOUD_GOOGLE) ||
+            (type == U_LOCATION_TYPE_CLOUD_SKYHOOK) ||
+            (type == U_LOCATION_TYPE_CLOUD_HERE)) {
+            fifo = U_LOCATION_SHARED_FIFO_WIFI;
+        }
+    } else if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+        if (type == U_LOCATION_TYPE_CLOUD_CELL_LOCATE) {
+            fifo = U_LOCATION_SHARED_FIFO_CELL_LOCATE;
+        } else if (type == U_LOCATION_TYPE_GNSS) {
+            fifo = U_LOCATION_SHARED_FIFO_GNSS;
+        }
+    } else if (devType == (int32_t) U_DEVICE_TYPE_GNSS) {
+        fifo = U_LOCATION_SHARED_FIFO_GNSS;
+    }
+
+    return fifo;
+}
+
+// Record the outcome of a source of uLocationGetHybrid().
+// gULocationMutex should be locked before this is called.
+static void hybridResult(uLocationSharedFifo_t fifo, int32_t errorCode,
+                         const uLocation_t *pLocation)
+{
+    bool found = false;
+    int32_t radius;
+
+    if (gHybrid.active) {
+        for (size_t x = 0; (x < gHybrid.numSources) && !found; x++) {
+            if ((gHybrid.fifo[x] == fifo) && !gHybrid.complete[x]) {
+                gHybrid.complete[x] = true;
+                gHybrid.numComplete++;
+                found = true;
+            }
+        }
+        if (found) {
+            if ((errorCode == 0) && (pLocation != NULL)) {
+                radius = pLocation->radiusMillimetres;
+                // Keep the most accurate location, an unknown
+                // radius (-1) counting as the least accurate
+                if (!gHybrid.haveLocation ||
+                    ((radius >= 0) && ((gHybrid.location.radiusMillimetres < 0) ||
+                                       (radius < gHybrid.location.radiusMillimetres)))) {
+                    gHybrid.location = *pLocation;
+                    gHybrid.haveLocation = true;
+                }
+                if ((gHybrid.accuracyTargetMillimetres < 0) ||
+                    ((radius >= 0) && (radius <= gHybrid.accuracyTargetMillimetres))) {
+                    gHybrid.targetMet = true;
+                }
+            } else if (gHybrid.errorCode == 0) {
+                gHybrid.errorCode = errorCode;
+                if (gHybrid.errorCode == 0) {
+                    gHybrid.errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
+                }
+            }
+        }
+    }
+}
+
+// Callback for a GNSS source of uLocationGetHybrid(), called with
+// gULocationMutex locked.
+static void hybridCallbackGnss(uDeviceHandle_t devHandle,
+                               int32_t errorCode,
+                               const uLocation_t *pLocation)
+{
+    (void) devHandle;
+    hybridResult(U_LOCATION_SHARED_FIFO_GNSS, errorCode, pLocation);
+}
+
+// Callback for a Cell Locate source of uLocationGetHybrid(), called
+// with gULocationMutex locked.
+static void hybridCallbackCellLocate(uDeviceHandle_t devHandle,
+                                     int32_t errorCode,
+                                     const uLocation_t *pLocation)
+{
+    (void) devHandle;
+    hybridResult(U_LOCATION_SHARED_FIFO_CELL_LOCATE, errorCode, pLocation);
+}
+
+// Callback for a Wi-Fi source of uLocationGetHybrid(), called with
+// gULocationMutex locked.
+static void hybridCallbackWifi(uDeviceHandle_t devHandle,
+                               int32_t errorCode,
+                               const uLocation_t *pLocation)
+{
+    (void) devHandle;
+    hybridResult(U_LOCATION_SHARED_FIFO_WIFI, errorCode, pLocation);
+}
+
+// Return a good approximation to the cosine of an angle given in
+// ten millionths of a degree, between -90 and +90 degrees, multiplied
+// by 1000, using Bhaskara's approximation; as in u_gnss_pos.c.
+static int64_t cosX1000(int32_t angleX1e7)
+{
+    int64_t x = angleX1e7 / 100000; // Hundredths of a degree
+    int64_t xSquared = x * x;
+
+    return (1000 * 4 * (81000000LL - xSquared)) / ((4 * 81000000LL) + xSquared);
+}
+
+// Return true if two positions are at least the given distance apart,
+// using a flat-earth approximation, which is fine at the distances
+// of interest here.
+static bool distanceReached(int32_t latitudeAX1e7, int32_t longitudeAX1e7,
+                            int32_t latitudeBX1e7, int32_t longitudeBX1e7,
+                            int64_t thresholdMillimetres)
+{
+    int64_t north = ((int64_t) latitudeAX1e7 - latitudeBX1e7) *
+                    U_LOCATION_MILLIMETRES_PER_DEGREE_X1E7_X1000 / 1000;
+    int64_t east = (int64_t) longitudeAX1e7 - longitudeBX1e7;
+
+    if (east > 1800000000LL) {
+        // Crossed the anti-meridian, take the short way round
+        east -= 3600000000LL;
+    } else if (east < -1800000000LL) {
+        east += 3600000000LL;
+    }
+    east = (east * U_LOCATION_MILLIMETRES_PER_DEGREE_X1E7_X1000 / 1000) *
+           cosX1000(latitudeAX1e7) / 1000;
+
+    return (north * north) + (east * east) >= thresholdMillimetres * thresholdMillimetres;
+}
+
+// Set the GNSS power-saving mode to suit the given rate.
+static void adaptivePwrSet(uDeviceHandle_t devHandle, int32_t rateMs)
+{
+    if (rateMs >= U_LOCATION_ADAPTIVE_PWR_ON_OFF_RATE_MS) {
+        // Wake up for a fix once per period
+        uGnssPwrSetTiming(devHandle, rateMs / 1000, -1, -1, -1, -1);
+        uGnssPwrSetMode(devHandle, U_GNSS_PWR_SAVING_MODE_ON_OFF);
+    } else if (uGnssPwrSetMode(devHandle, U_GNSS_PWR_SAVING_MODE_NONE) != 0) {
+        // M8 devices have no "none" mode, cyclic tracking is the
+        // better of the two for frequent fixes
+        uGnssPwrSetMode(devHandle, U_GNSS_PWR_SAVING_MODE_CYCLIC_TRACKING);
+    }
+}
+
+// The event handler of uLocationGetContinuousStartAdaptive(): work
+// out whether the device is moving and change the rate if required.
+// This does not lock gULocationMutex, which is held while the event
+// queue is closed.
+static void adaptiveEventHandler(void *pParam, size_t paramLength)
+{
+    uLocationAdaptiveEvent_t *pEvent = (uLocationAdaptiveEvent_t *) pParam;
+    uLocationAdaptiveCfg_t *pCfg = &(gAdaptive.cfg);
+    int32_t nowMs = uPortGetTickTimeMs();
+    bool moving = pEvent->motion;
+    int64_t threshold;
+    int32_t rateMs;
+
+    (void) paramLength;
+
+    if (!moving && (pEvent->errorCode == 0)) {
+        moving = (pCfg->movingSpeedMillimetresPerSecond > 0) &&
+                 (pEvent->location.speedMillimetresPerSecond >= pCfg->movingSpeedMillimetresPerSecond);
+        if (!moving && (pCfg->movingDistanceMillimetres > 0)) {
+            if (gAdaptive.haveAnchor) {
+                // Don't let the uncertainty of the fix look like motion
+                threshold = pCfg->movingDistanceMillimetres;
+                if (pEvent->location.radiusMillimetres > threshold) {
+                    threshold = pEvent->location.radiusMillimetres;
+                }
+                moving = distanceReached(pEvent->location.latitudeX1e7,
+                                         pEvent->location.longitudeX1e7,
+                                         gAdaptive.anchorLatitudeX1e7,
+                                         gAdaptive.anchorLongitudeX1e7,
+                                         threshold);
+            } else {
+                gAdaptive.haveAnchor = true;
+                gAdaptive.anchorLatitudeX1e7 = pEvent->location.latitudeX1e7;
+                gAdaptive.anchorLongitudeX1e7 = pEvent->location.longitudeX1e7;
+            }
+        }
+        if (moving) {
+            gAdaptive.haveAnchor = true;
+            gAdaptive.anchorLatitudeX1e7 = pEvent->location.latitudeX1e7;
+            gAdaptive.anchorLongitudeX1e7 = pEvent->location.longitudeX1e7;
+        }
+    }
+    if (moving) {
+        gAdaptive.lastMotionTimeMs = nowMs;
+    }
+
+    rateMs = pCfg->stationaryRateMs;
+    if (nowMs - gAdaptive.lastMotionTimeMs < pCfg->stationaryTimeMs) {
+        rateMs = pCfg->movingRateMs;
+    }
+    if (rateMs != gAdaptive.rateMs) {
+        // Change the rate while streaming carries on; the streamed
+        // position code will put back the original rate when stopped
+        if (uGnssCfgSetRate(gAdaptive.devHandle, rateMs, 1, U_GNSS_TIME_SYSTEM_NONE) == 0) {
+            gAdaptive.rateMs = rateMs;
+            if (pCfg->gnssPwrFollowsRate) {
+                adaptivePwrSet(gAdaptive.devHandle, rateMs);
+            }
+        }
+    }
+}
+
+// Callback for uLocationGetContinuousStartAdaptive(), called with
+// gULocationMutex locked.
+static void adaptiveCallback(uDeviceHandle_t devHandle,
+                             int32_t errorCode,
+                             const uLocation_t *pLocation)
+{
+    uLocationAdaptiveEvent_t event = {0};
+
+    if (gAdaptive.active) {
+        if (gAdaptive.pCallback != NULL) {
+            gAdaptive.pCallback(devHandle, errorCode, pLocation);
+        }
+        event.errorCode = errorCode;
+        if (pLocation != NULL) {
+            event.location = *pLocation;
+        } else if (errorCode == 0) {
+            event.errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
+        }
+        // Coalesced, so this cannot block
+        uPortEventQueueSendExt(gAdaptive.eventQueueHandle, &event, sizeof(event),
+                               U_LOCATION_ADAPTIVE_EVENT_KEY_FIX, false);
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -426,6 +755,7 @@ int32_t uLocationGet(uDeviceHandle_t devHandle, uLocationType_t type,
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uLocation_t location;
+    uLocation_t *pLocationCloudLocate;
     uDeviceHandle_t gnssDeviceHandle;
 
     if (gULocationMutex != NULL) {
@@ -498,6 +828,12 @@ int32_t uLocationGet(uDeviceHandle_t devHandle, uLocationType_t type,
                     // the MQTT client handle is passed in via pLocationAssist)
                     gnssDeviceHandle = uNetworkGetDeviceHandle(devHandle, U_NETWORK_TYPE_GNSS);
                     if ((pLocationAssist != NULL) && (gnssDeviceHandle != NULL)) {
+                        // The location can only be read back with a Client ID,
+                        // without one the RRLP data is just sent (or batched)
+                        pLocationCloudLocate = NULL;
+                        if (pLocationAssist->pClientIdStr != NULL) {
+                            pLocationCloudLocate = &location;
+                        }
                         errorCode = uLocationPrivateCloudLocate(devHandle, gnssDeviceHandle,
                                                                 (uMqttClientContext_t *) pLocationAssist->pMqttClientContext,
                                                                 pLocationAssist->svsThreshold,
@@ -505,9 +841,11 @@ int32_t uLocationGet(uDeviceHandle_t devHandle, uLocationType_t type,
                                                                 pLocationAssist->multipathIndexLimit,
                                                                 pLocationAssist->pseudorangeRmsErrorIndexLimit,
                                                                 pLocationAssist->rrlpDataLengthBytes,
+                                                                pLocationAssist->rrlpBatchSnapshots,
                                                                 pLocationAssist->pClientIdStr,
-                                                                &location, pKeepGoingCallback);
-                        if (pLocation != NULL) {
+                                                                pLocationCloudLocate,
+                                                                pKeepGoingCallback);
+                        if ((pLocation != NULL) && (pLocationCloudLocate != NULL)) {
                             *pLocation = location;
                         }
                     }
@@ -587,6 +925,101 @@ int32_t uLocationGetContinuousStart(uDeviceHandle_t devHandle,
     return errorCode;
 }
 
+// Get the current location to a callback, continuously, at a rate
+// that adapts to motion.
+int32_t uLocationGetContinuousStartAdaptive(uDeviceHandle_t devHandle,
+                                            const uLocationAdaptiveCfg_t *pCfg,
+                                            uLocationType_t type,
+                                            const uLocationAssist_t *pLocationAssist,
+                                            const char *pAuthenticationTokenStr,
+                                            void (*pCallback) (uDeviceHandle_t devHandle,
+                                                               int32_t errorCode,
+                                                               const uLocation_t *pLocation))
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    int32_t devType;
+
+    if (gULocationMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gULocationMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        devType = uDeviceGetDeviceType(devHandle);
+        if ((pCfg != NULL) && (pCfg->movingRateMs > 0) &&
+            (pCfg->stationaryRateMs >= pCfg->movingRateMs)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if ((devType == (int32_t) U_DEVICE_TYPE_GNSS) ||
+                ((devType == (int32_t) U_DEVICE_TYPE_CELL) && (type == U_LOCATION_TYPE_GNSS))) {
+                errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                if (!gAdaptive.active) {
+                    memset(&gAdaptive, 0, sizeof(gAdaptive));
+                    gAdaptive.devHandle = devHandle;
+                    gAdaptive.cfg = *pCfg;
+                    gAdaptive.pCallback = pCallback;
+                    // Start off moving, so that the first fix arrives
+                    // quickly, slowing down if there is no motion
+                    gAdaptive.rateMs = pCfg->movingRateMs;
+                    gAdaptive.lastMotionTimeMs = uPortGetTickTimeMs();
+                    gAdaptive.pwrModeOriginal = -1;
+                    errorCode = uPortEventQueueOpen(adaptiveEventHandler, "locAdaptive",
+                                                    sizeof(uLocationAdaptiveEvent_t),
+                                                    U_LOCATION_ADAPTIVE_TASK_STACK_SIZE_BYTES,
+                                                    U_LOCATION_ADAPTIVE_TASK_PRIORITY, 2);
+                    if (errorCode >= 0) {
+                        gAdaptive.eventQueueHandle = errorCode;
+                        if (pCfg->gnssPwrFollowsRate) {
+                            gAdaptive.pwrModeOriginal = uGnssPwrGetMode(devHandle);
+                            adaptivePwrSet(devHandle, gAdaptive.rateMs);
+                        }
+                        errorCode = startAsync(devHandle, gAdaptive.rateMs, type,
+                                               pLocationAssist, pAuthenticationTokenStr,
+                                               adaptiveCallback);
+                        if (errorCode == 0) {
+                            gAdaptive.active = true;
+                        } else {
+                            uPortEventQueueClose(gAdaptive.eventQueueHandle);
+                            if (gAdaptive.pwrModeOriginal >= 0) {
+                                uGnssPwrSetMode(devHandle,
+                                                (uGnssPwrSavingMode_t) gAdaptive.pwrModeOriginal);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gULocationMutex);
+    }
+
+    return errorCode;
+}
+
+// Tell uLocationGetContinuousStartAdaptive() that the device is moving.
+int32_t uLocationAdaptiveMotion(uDeviceHandle_t devHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uLocationAdaptiveEvent_t event = {0};
+
+    if (gULocationMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gULocationMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (gAdaptive.active && (gAdaptive.devHandle == devHandle)) {
+            event.motion = true;
+            // Coalesced, so this cannot block
+            errorCode = uPortEventQueueSendExt(gAdaptive.eventQueueHandle,
+                                               &event, sizeof(event),
+                                               U_LOCATION_ADAPTIVE_EVENT_KEY_MOTION,
+                                               false);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gULocationMutex);
+    }
+
+    return errorCode;
+}
+
 // Get the current status of a location establishment attempt.
 int32_t uLocationGetStatus(uDeviceHandle_t devHandle)
 {
@@ -616,10 +1049,20 @@ int32_t uLocationGetStatus(uDeviceHandle_t devHandle)
 // Cancel a uLocationGetStart()/uLocationGetContinuousStart().
 void uLocationGetStop(uDeviceHandle_t devHandle)
 {
+    int32_t pwrModeRestore = -1;
+
     if (gULocationMutex != NULL) {
 
         U_PORT_MUTEX_LOCK(gULocationMutex);
 
+        if (gAdaptive.active && (gAdaptive.devHandle == devHandle)) {
+            // Stop any adaptive location first so that the rate
+            // is left alone from here on
+            gAdaptive.active = false;
+            uPortEventQueueClose(gAdaptive.eventQueueHandle);
+            pwrModeRestore = gAdaptive.pwrModeOriginal;
+        }
+
         int32_t devType = uDeviceGetDeviceType(devHandle);
         if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
             uPortFree(pULocationSharedRequestPop(U_LOCATION_SHARED_FIFO_WIFI));
@@ -638,8 +1081,151 @@ void uLocationGetStop(uDeviceHandle_t devHandle)
             uGnssPosGetStreamedStop(devHandle);
         }
 
+        if (pwrModeRestore >= 0) {
+            uGnssPwrSetMode(devHandle, (uGnssPwrSavingMode_t) pwrModeRestore);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gULocationMutex);
+    }
+}
+
+// Get the current location from several sources at once.
+int32_t uLocationGetHybrid(const uLocationHybridSource_t *pSources,
+                           size_t numSources,
+                           int32_t accuracyTargetMillimetres,
+                           uLocation_t *pLocation,
+                           bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    void (*pCallback) (uDeviceHandle_t, int32_t, const uLocation_t *);
+    uLocationSharedFifo_t fifo;
+    int32_t startTimeMs;
+    bool finished = false;
+    bool stop;
+    int32_t x;
+
+    if (gULocationMutex != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pSources != NULL) && (numSources > 0) &&
+            (numSources <= U_LOCATION_HYBRID_MAX_NUM_SOURCES)) {
+
+            U_PORT_MUTEX_LOCK(gULocationMutex);
+
+            errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+            if (!gHybrid.active) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                memset(&gHybrid, 0, sizeof(gHybrid));
+                for (size_t y = 0; (y < numSources) && (errorCode == 0); y++) {
+                    fifo = hybridFifo(pSources[y].devHandle, pSources[y].type);
+                    if (fifo == U_LOCATION_SHARED_FIFO_NONE) {
+                        errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+                    }
+                    for (size_t z = 0; (z < y) && (errorCode == 0); z++) {
+                        if (gHybrid.fifo[z] == fifo) {
+                            errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+                        }
+                    }
+                    gHybrid.fifo[y] = fifo;
+                }
+            }
+            if (errorCode == 0) {
+                gHybrid.active = true;
+                gHybrid.accuracyTargetMillimetres = accuracyTargetMillimetres;
+                gHybrid.numSources = numSources;
+                // Start all of the sources; one that fails to
+                // start is simply complete with that error
+                for (size_t y = 0; y < numSources; y++) {
+                    switch (gHybrid.fifo[y]) {
+                        case U_LOCATION_SHARED_FIFO_CELL_LOCATE:
+                            pCallback = hybridCallbackCellLocate;
+                            break;
+                        case U_LOCATION_SHARED_FIFO_WIFI:
+                            pCallback = hybridCallbackWifi;
+                            break;
+                        default:
+                            pCallback = hybridCallbackGnss;
+                            break;
+                    }
+                    x = startAsync(pSources[y].devHandle, 0, pSources[y].type,
+                                   pSources[y].pLocationAssist,
+                                   pSources[y].pAuthenticationTokenStr,
+                                   pCallback);
+                    if (x != 0) {
+                        hybridResult(gHybrid.fifo[y], x, NULL);
+                    }
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gULocationMutex);
+
+            if (errorCode == 0) {
+                // Wait for the target to be met, all of the sources
+                // to finish or the caller to lose patience
+                startTimeMs = uPortGetTickTimeMs();
+                while (!finished) {
+                    U_PORT_MUTEX_LOCK(gULocationMutex);
+                    finished = gHybrid.targetMet ||
+                               (gHybrid.numComplete >= gHybrid.numSources);
+                    U_PORT_MUTEX_UNLOCK(gULocationMutex);
+                    if (!finished) {
+                        if (pKeepGoingCallback != NULL) {
+                            finished = !pKeepGoingCallback(pSources[0].devHandle);
+                        } else {
+                            finished = (uPortGetTickTimeMs() - startTimeMs) >
+                                       (U_LOCATION_TIMEOUT_SECONDS * 1000);
+                        }
+                        if (!finished) {
+                            uPortTaskBlock(U_LOCATION_HYBRID_POLL_INTERVAL_MS);
+                        }
+                    }
+                }
+
+                // Cancel the sources that are still going, outside
+                // the lock since stopping may wait on a callback
+                for (size_t y = 0; y < numSources; y++) {
+                    U_PORT_MUTEX_LOCK(gULocationMutex);
+                    stop = !gHybrid.complete[y];
+                    U_PORT_MUTEX_UNLOCK(gULocationMutex);
+                    if (stop) {
+                        uLocationGetStop(pSources[y].devHandle);
+                    }
+                }
+
+                U_PORT_MUTEX_LOCK(gULocationMutex);
+                if (gHybrid.haveLocation) {
+                    if (pLocation != NULL) {
+                        *pLocation = gHybrid.location;
+                    }
+                } else {
+                    errorCode = gHybrid.errorCode;
+                    if (errorCode == 0) {
+                        errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+                    }
+                }
+                gHybrid.active = false;
+                U_PORT_MUTEX_UNLOCK(gULocationMutex);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Send any batched Cloud Locate RRLP snapshots.
+int32_t uLocationCloudLocateFlush(void *pMqttClientContext)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+
+    if (gULocationMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gULocationMutex);
+
+        errorCode = uLocationPrivateCloudLocateFlush((uMqttClientContext_t *) pMqttClientContext);
+
         U_PORT_MUTEX_UNLOCK(gULocationMutex);
     }
+
+    return errorCode;
 }
 
 // End of file
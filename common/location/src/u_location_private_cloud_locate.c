@@ -35,14 +35,13 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
-#include "string.h"    // memcpy(), strncmp(), strncpy() and strncat()
-#include "ctype.h"     // isdigit()
+#include "string.h"    // memcpy(), memmove(), memset(), strncmp(), strncpy() and strncat()
+#include "ctype.h"     // isdigit(), isspace()
 
 #include "u_cfg_sw.h"
 #include "u_error_common.h"
 
 #include "u_port.h"
-#include "u_port_clib_platform_specific.h" // strtok_r()
 #include "u_port_os.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
@@ -112,27 +111,73 @@
 # define U_LOCATION_PRIVATE_CLOUD_LOCATE_READ_MESSAGE_LENGTH_BYTES 512
 #endif
 
+#ifndef U_LOCATION_PRIVATE_CLOUD_LOCATE_AUTO_C_NO_STRONG
+/** When the RRLP mode is chosen automatically (rrlpDataLengthBytes
+ * zero), the carrier to noise ratio at or above which a satellite
+ * in the UBX-RXM-MEASX snapshot is counted as strong.
+ */
+# define U_LOCATION_PRIVATE_CLOUD_LOCATE_AUTO_C_NO_STRONG 35
+#endif
+
+#ifndef U_LOCATION_PRIVATE_CLOUD_LOCATE_AUTO_SVS_STRONG
+/** When the RRLP mode is chosen automatically (rrlpDataLengthBytes
+ * zero), the number of strong satellites (see
+ * #U_LOCATION_PRIVATE_CLOUD_LOCATE_AUTO_C_NO_STRONG) at or above which
+ * the compact UBX-RXM-MEAS50 form, which gives the same accuracy
+ * from good signals, is sent in place of UBX-RXM-MEASX; in poorer
+ * conditions Cloud Locate is given the full UBX-RXM-MEASX snapshot
+ * to work with.
+ */
+# define U_LOCATION_PRIVATE_CLOUD_LOCATE_AUTO_SVS_STRONG 6
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** RRLP snapshots waiting to be sent to Cloud Locate in one MQTT
+ * message; protected by the location API mutex, which is held by
+ * all of the callers of this module.
+ */
+typedef struct {
+    uMqttClientContext_t *pMqttClientContext;
+    char *pBuffer; /**< U_LOCATION_PRIVATE_CLOUD_LOCATE_BUFFER_LENGTH_BYTES long. */
+    size_t length;
+    int32_t numSnapshots;
+} uLocationPrivateCloudLocateBatch_t;
+
+/** A key/value pair from the flat JSON object that Cloud Locate
+ * sends back; neither is null-terminated and the quotes around a
+ * string value are not included.
+ */
+typedef struct {
+    const char *pKey;
+    size_t keyLength;
+    const char *pValue;
+    size_t valueLength;
+} uLocationPrivateCloudLocateJsonItem_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
 
+/** The batch of RRLP snapshots that has yet to be sent.
+ */
+static uLocationPrivateCloudLocateBatch_t gBatch = {0};
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
 // Convert a string containing a [fractional] decimal number,
-// something like "-758.7387289" (should be null-terminated) into
-// an int32_t with the given power of ten multiplier.
+// something like "-758.7387289" into an int32_t with the given
+// power of ten multiplier.
 // Any leading crap is ignored and conversion stops when a
 // non-numeric character is reached after the number has begun.
-static int32_t stringToInt32(char *pStr, int32_t *pNumber,
+static int32_t stringToInt32(const char *pStr, int32_t *pNumber,
                              int32_t powerOfTenWanted,
                              int32_t maxFractionalDigits,
-                             char **ppEnd)
+                             const char **ppEnd)
 {
     int32_t errorCode = -1;
     int64_t int64 = 0;
@@ -210,123 +255,162 @@ static int32_t stringToInt32(char *pStr, int32_t *pNumber,
     return errorCode;
 }
 
-// Find the start of the value of a single item, e.g.
-// for \"Lat\":52.018749899999996 pKey would
-// be "\"Lat\"", and a pointer to the character 5 would
-// be returned
-static char *pFindItem(char *pStr, const char *pKey)
+// Skip white space.
+static const char *pJsonSkipSpace(const char *pStr)
 {
-    if (pStr != NULL) {
-        pStr = strstr(pStr, pKey);
-        if (pStr != NULL) {
-            // Move on to the ':'
-            pStr = strstr(pStr, ":");
-            if (pStr != NULL) {
-                // Move beyond the ":"
-                pStr++;
-            }
-        }
+    while (isspace((int32_t) *pStr)) {
+        pStr++;
     }
 
     return pStr;
 }
 
-// Parse location out of a message of the form:
-//
-// "{"Lat":52.018749899999996,"Lon":0.2471071,"Alt":120.21600000000001,"Acc":29.877,"MeasTime":"2021-11-09T18:24:11","Epochs":1}"
-//
-// Note that pStr is MODIFIED in this process.
-static int32_t parseLocation(char *pStr, uLocation_t *pLocation)
+// Get the next key/value pair from a flat JSON object, e.g. for
+// {"Lat":52.018749899999996,"MeasTime":"2021-11-09T18:24:11"}
+// the first call, with pStr pointing at the '{', would return
+// Lat and 52.018749899999996, the second call, with pStr set to
+// the return value of the first, MeasTime and 2021-11-09T18:24:11;
+// NULL is returned at the end of the object or if it is not
+// understood.  Each character is visited only once.
+static const char *pJsonNext(const char *pStr,
+                             uLocationPrivateCloudLocateJsonItem_t *pItem)
 {
-    char *pSaved;
-    int32_t x;
-    int32_t year;
-    int32_t months;
-
-    pStr = pFindItem(pStr, "\"Lat\"");
-    if (pStr != NULL) {
-        // pStr should now point at 52.018749899999996
-        if (stringToInt32(pStr, &x, 7, 7, &pStr) == 0) {
-            pLocation->latitudeX1e7 = x;
-        } else {
-            pStr = NULL;
-        }
+    pStr = pJsonSkipSpace(pStr);
+    if ((*pStr == '{') || (*pStr == ',')) {
+        pStr = pJsonSkipSpace(pStr + 1);
     }
-    pStr = pFindItem(pStr, "\"Lon\"");
-    if (pStr != NULL) {
-        // pStr should now point at 0.2471071
-        if (stringToInt32(pStr, &x, 7, 7, &pStr) == 0) {
-            pLocation->longitudeX1e7 = x;
-        } else {
-            pStr = NULL;
+    if (*pStr == '"') {
+        // The key
+        pStr++;
+        pItem->pKey = pStr;
+        while ((*pStr != '"') && (*pStr != 0)) {
+            pStr++;
         }
-    }
-    pStr = pFindItem(pStr, "\"Alt\"");
-    if (pStr != NULL) {
-        // pStr should now point at 120.21600000000001
-        if (stringToInt32(pStr, &x, 3, 3, &pStr) == 0) {
-            pLocation->altitudeMillimetres = x;
+        pItem->keyLength = pStr - pItem->pKey;
+        if (*pStr == '"') {
+            pStr = pJsonSkipSpace(pStr + 1);
+        }
+        if (*pStr == ':') {
+            pStr = pJsonSkipSpace(pStr + 1);
+            if (*pStr == '"') {
+                // A string value, which may contain escapes
+                pStr++;
+                pItem->pValue = pStr;
+                while ((*pStr != '"') && (*pStr != 0)) {
+                    if ((*pStr == '\\') && (*(pStr + 1) != 0)) {
+                        pStr++;
+                    }
+                    pStr++;
+                }
+                pItem->valueLength = pStr - pItem->pValue;
+                pStr = (*pStr == '"') ? pStr + 1 : NULL;
+            } else {
+                // A number or a literal
+                pItem->pValue = pStr;
+                while ((*pStr != ',') && (*pStr != '}') &&
+                       !isspace((int32_t) *pStr) && (*pStr != 0)) {
+                    pStr++;
+                }
+                pItem->valueLength = pStr - pItem->pValue;
+                if (pItem->valueLength == 0) {
+                    pStr = NULL;
+                }
+            }
         } else {
             pStr = NULL;
         }
+    } else {
+        pStr = NULL;
     }
-    pStr = pFindItem(pStr, "\"Acc\"");
-    if (pStr != NULL) {
-        // pStr should now point at 29.877
-        if (stringToInt32(pStr, &x, 3, 3, &pStr) == 0) {
-            pLocation->radiusMillimetres = x;
-        } else {
-            pStr = NULL;
+
+    return pStr;
+}
+
+// Return true if the key of a JSON item is the given one.
+static bool jsonKeyIs(const uLocationPrivateCloudLocateJsonItem_t *pItem,
+                      const char *pKey)
+{
+    return (pItem->keyLength == strlen(pKey)) &&
+           (strncmp(pItem->pKey, pKey, pItem->keyLength) == 0);
+}
+
+// Convert a time of the form "2021-11-09T18:24:11" (without the
+// quotes) into seconds since 1970, returning -1 if it is not valid.
+static int64_t measTimeToSecondsUtc(const char *pStr, size_t length)
+{
+    int64_t secondsUtc = -1;
+    // Year, month, day, hours, minutes and seconds, plus the
+    // character that should follow each but the last
+    int32_t field[6];
+    const char separator[] = {'-', '-', 'T', ':', ':'};
+    char *pEnd = NULL;
+    size_t x;
+
+    if (length >= 19) {
+        for (x = 0; x < sizeof(field) / sizeof(field[0]); x++) {
+            field[x] = strtol(pStr, &pEnd, 10);
+            if ((pEnd == pStr) ||
+                ((x < sizeof(separator)) && (*pEnd != separator[x]))) {
+                break;
+            }
+            pStr = pEnd + 1;
+        }
+        // 2021 since Cloud Locate did not exist before then
+        if ((x == sizeof(field) / sizeof(field[0])) && (field[0] >= 2021) &&
+            (field[1] >= 1) && (field[1] <= 12) && (field[2] >= 1) && (field[2] <= 31)) {
+            secondsUtc = uTimeDaysFromCivil(field[0], field[1], field[2]) * 3600 * 24;
+            secondsUtc += ((int64_t) field[3] * 3600) + (field[4] * 60) + field[5];
         }
     }
-    pStr = pFindItem(pStr, "\"MeasTime\"");
-    if (pStr != NULL) {
-        // pStr should now point at \"2021-11-09T18:24:11\",
-        // i.e. including the quotes
-        // Tokenise on "-"
-        pStr = strtok_r(pStr, "-", &pSaved);
-        // Skip the opening quote
-        pStr++;
-        // Four digit year converted to years since 1970
-        year = strtol(pStr, NULL, 10) - 1970;
-        if (year >= 2021 - 1970) {
-            // Move pStr to the start of the month
-            pStr = strtok_r(NULL, "-", &pSaved);
-            if (pStr != NULL) {
-                // Month (1 to 12), so take away 1 to make it zero-based
-                months = strtol(pStr, NULL, 10) - 1;
-                months += year * 12;
-                // Work out the number of seconds due to the year/month count
-                pLocation->timeUtc = uTimeMonthsToSecondsUtc(months);
+
+    return secondsUtc;
+}
+
+// Parse location out of a message of the form:
+//
+// "{"Lat":52.018749899999996,"Lon":0.2471071,"Alt":120.21600000000001,"Acc":29.877,"MeasTime":"2021-11-09T18:24:11","Epochs":1}"
+//
+// in a single pass; the items may come in any order and any that
+// are not understood are ignored.
+static int32_t parseLocation(const char *pStr, uLocation_t *pLocation)
+{
+    uLocationPrivateCloudLocateJsonItem_t item;
+    // Lat, Lon, Alt, Acc and MeasTime must all be present
+    uint32_t missing = 0x1f;
+    int64_t timeUtc;
+    int32_t x;
+
+    while ((pStr = pJsonNext(pStr, &item)) != NULL) {
+        if (jsonKeyIs(&item, "Lat")) {
+            if (stringToInt32(item.pValue, &x, 7, 7, NULL) == 0) {
+                pLocation->latitudeX1e7 = x;
+                missing &= ~0x01UL;
             }
-            // Move pStr to the start of the day and tokenize-out the "T"
-            pStr = strtok_r(NULL, "T", &pSaved);
-            if (pStr != NULL) {
-                // Day (1 to 31)
-                pLocation->timeUtc += (int64_t) (strtol(pStr, NULL, 10) - 1) * 3600 * 24;
+        } else if (jsonKeyIs(&item, "Lon")) {
+            if (stringToInt32(item.pValue, &x, 7, 7, NULL) == 0) {
+                pLocation->longitudeX1e7 = x;
+                missing &= ~0x02UL;
             }
-            // Move pStr to the start of the hours and tokenize-out the ":"
-            pStr = strtok_r(NULL, ":", &pSaved);
-            if (pStr != NULL) {
-                // Hours since midnight
-                pLocation->timeUtc  += (int64_t) strtol(pStr, NULL, 10) * 3600;
+        } else if (jsonKeyIs(&item, "Alt")) {
+            if (stringToInt32(item.pValue, &x, 3, 3, NULL) == 0) {
+                pLocation->altitudeMillimetres = x;
+                missing &= ~0x04UL;
             }
-            // Move pStr to Minutes after the hour
-            pStr = strtok_r(NULL, ":", &pSaved);
-            if (pStr != NULL) {
-                pLocation->timeUtc  += (int64_t) strtol(pStr, NULL, 10) * 60;
+        } else if (jsonKeyIs(&item, "Acc")) {
+            if (stringToInt32(item.pValue, &x, 3, 3, NULL) == 0) {
+                pLocation->radiusMillimetres = x;
+                missing &= ~0x08UL;
             }
-            // Move pStr to Seconds after the hour, which ends at the final quotation mark
-            pStr = strtok_r(NULL, ":", &pSaved);
-            if (pStr != NULL) {
-                pLocation->timeUtc += (int64_t) strtol(pStr, NULL, 10);
+        } else if (jsonKeyIs(&item, "MeasTime")) {
+            timeUtc = measTimeToSecondsUtc(item.pValue, item.valueLength);
+            if (timeUtc >= 0) {
+                pLocation->timeUtc = timeUtc;
+                missing &= ~0x10UL;
             }
-        } else {
-            pStr = NULL;
         }
     }
 
-    return pStr != NULL ? (int32_t) U_ERROR_COMMON_SUCCESS : (int32_t) U_ERROR_COMMON_UNKNOWN;
+    return (missing == 0) ? (int32_t) U_ERROR_COMMON_SUCCESS : (int32_t) U_ERROR_COMMON_UNKNOWN;
 }
 
 // Get the RRLP mode from the RRLP data length.
@@ -348,6 +432,144 @@ static uGnssRrlpMode_t rrlpMode(int32_t rrlpDataLengthBytes)
     return rrlpMode;
 }
 
+// Count the satellites in a UBX-RXM-MEASX snapshot, as returned
+// by uGnssPosGetRrlp(), that have a carrier to noise ratio of at
+// least cNoThreshold.
+static int32_t measxCountStrong(const char *pBuffer, int32_t length,
+                                int32_t cNoThreshold)
+{
+    const uint8_t *pBody = (const uint8_t *) pBuffer + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+    int32_t bodyLength = length - U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+    int32_t numStrong = 0;
+    int32_t svs = 0;
+
+    // The number of satellites is at offset 34 and the carrier
+    // to noise ratio of each is at offset 46 + (x * 24)
+    if (bodyLength > 34) {
+        svs = *(pBody + 34);
+    }
+    for (int32_t x = 0; (x < svs) && (46 + (x * 24) < bodyLength); x++) {
+        if (*(pBody + 46 + (x * 24)) >= cNoThreshold) {
+            numStrong++;
+        }
+    }
+
+    return numStrong;
+}
+
+// Get a snapshot of RRLP data from the GNSS device in the mode
+// given by rrlpDataLengthBytes or, if that is zero, in the most
+// compact mode that the signal conditions allow, returning the
+// length of the complete UBX frame written to pBuffer or negative
+// error code; *pCompact is set to true if one of the compact
+// modes was used.
+static int32_t rrlpGet(uDeviceHandle_t gnssDevHandle,
+                       char *pBuffer, size_t bufferLength,
+                       int32_t rrlpDataLengthBytes,
+                       int32_t svsThreshold, int32_t cNoThreshold,
+                       int32_t multipathIndexLimit,
+                       int32_t pseudorangeRmsErrorIndexLimit,
+                       bool (*pKeepGoingCallback) (uDeviceHandle_t),
+                       bool *pCompact)
+{
+    int32_t errorCodeOrLength;
+    int32_t x;
+
+    *pCompact = false;
+    errorCodeOrLength = uGnssPosSetRrlpMode(gnssDevHandle,
+                                            rrlpMode(rrlpDataLengthBytes));
+    if (errorCodeOrLength == 0) {
+        errorCodeOrLength = uGnssPosGetRrlp(gnssDevHandle, pBuffer, bufferLength,
+                                            svsThreshold, cNoThreshold, multipathIndexLimit,
+                                            pseudorangeRmsErrorIndexLimit,
+                                            pKeepGoingCallback);
+        if ((rrlpDataLengthBytes > 0) && (rrlpDataLengthBytes < INT_MAX)) {
+            *pCompact = true;
+        }
+    }
+
+    if ((rrlpDataLengthBytes == 0) &&
+        (errorCodeOrLength > 50 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) &&
+        (bufferLength - errorCodeOrLength >= 50 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) &&
+        (measxCountStrong(pBuffer, errorCodeOrLength,
+                          U_LOCATION_PRIVATE_CLOUD_LOCATE_AUTO_C_NO_STRONG) >=
+         U_LOCATION_PRIVATE_CLOUD_LOCATE_AUTO_SVS_STRONG)) {
+        // The signals are good enough for MEAS50 to do as well as
+        // MEASX in fewer bytes: try to get that, after the MEASX
+        // snapshot so that it is still there to fall back on if
+        // the GNSS device does not support MEAS50 (e.g. M8/M9)
+        if (uGnssPosSetRrlpMode(gnssDevHandle, U_GNSS_RRLP_MODE_MEAS50) == 0) {
+            x = uGnssPosGetRrlp(gnssDevHandle, pBuffer + errorCodeOrLength,
+                                50 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES,
+                                -1, -1, -1, -1, pKeepGoingCallback);
+            if (x >= U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) {
+                memmove(pBuffer, pBuffer + errorCodeOrLength, x);
+                errorCodeOrLength = x;
+                *pCompact = true;
+            }
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// Send the batch of RRLP snapshots, if there is one, and free it;
+// if pMqttClientContext is NULL the batch is simply discarded.
+static int32_t batchFlush(uMqttClientContext_t *pMqttClientContext)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+
+    if (gBatch.pBuffer != NULL) {
+        if ((pMqttClientContext != NULL) && (gBatch.length > 0)) {
+            uPortLog("U_LOCATION_PRIVATE_CLOUD_LOCATE: sending %d RRLP snapshot(s),"
+                     " %d byte(s).\n", gBatch.numSnapshots, (int32_t) gBatch.length);
+            errorCode = uMqttClientPublish(pMqttClientContext,
+                                           U_LOCATION_PRIVATE_CLOUD_LOCATE_MQTT_PUBLISH_TOPIC,
+                                           gBatch.pBuffer, gBatch.length,
+                                           U_MQTT_QOS_EXACTLY_ONCE, false);
+        }
+        uPortFree(gBatch.pBuffer);
+    }
+    memset(&gBatch, 0, sizeof(gBatch));
+
+    return errorCode;
+}
+
+// Add an RRLP snapshot, a complete UBX frame, to the batch, sending
+// the batch if it is then full.
+static int32_t batchAdd(uMqttClientContext_t *pMqttClientContext,
+                        int32_t batchSnapshots,
+                        const char *pSnapshot, size_t length)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+
+    if ((gBatch.pBuffer != NULL) &&
+        ((gBatch.pMqttClientContext != pMqttClientContext) ||
+         (gBatch.length + length > U_LOCATION_PRIVATE_CLOUD_LOCATE_BUFFER_LENGTH_BYTES))) {
+        // Send what we have if it is for a different MQTT client
+        // or there is no room for this snapshot
+        errorCode = batchFlush(gBatch.pMqttClientContext);
+    }
+    if ((errorCode == 0) && (gBatch.pBuffer == NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        gBatch.pBuffer = (char *) pUPortMalloc(U_LOCATION_PRIVATE_CLOUD_LOCATE_BUFFER_LENGTH_BYTES);
+        if (gBatch.pBuffer != NULL) {
+            gBatch.pMqttClientContext = pMqttClientContext;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+    }
+    if (errorCode == 0) {
+        memcpy(gBatch.pBuffer + gBatch.length, pSnapshot, length);
+        gBatch.length += length;
+        gBatch.numSnapshots++;
+        if (gBatch.numSnapshots >= batchSnapshots) {
+            errorCode = batchFlush(pMqttClientContext);
+        }
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -361,6 +583,7 @@ int32_t uLocationPrivateCloudLocate(uDeviceHandle_t devHandle,
                                     int32_t multipathIndexLimit,
                                     int32_t pseudorangeRmsErrorIndexLimit,
                                     int32_t rrlpDataLengthBytes,
+                                    int32_t batchSnapshots,
                                     const char *pClientIdStr,
                                     uLocation_t *pLocation,
                                     bool (*pKeepGoingCallback) (uDeviceHandle_t))
@@ -374,14 +597,20 @@ int32_t uLocationPrivateCloudLocate(uDeviceHandle_t devHandle,
     char *pMessageRead;
     int32_t startTimeMs = uPortGetTickTimeMs();
     bool subscribed = false;
+    bool compact;
     size_t z;
 
     if ((gnssDevHandle != NULL) && (pMqttClientContext != NULL) &&
         ((pLocation == NULL) || (pClientIdStr != NULL)) &&
-        ((rrlpDataLengthBytes == 20) || (rrlpDataLengthBytes == 50) ||
-         (rrlpDataLengthBytes == INT_MAX))) {
+        ((rrlpDataLengthBytes == 0) || (rrlpDataLengthBytes == 20) ||
+         (rrlpDataLengthBytes == 50) || (rrlpDataLengthBytes == INT_MAX))) {
         errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-        if (rrlpDataLengthBytes < INT_MAX) {
+        if ((pClientIdStr != NULL) && (pLocation != NULL)) {
+            // The location is read back for each snapshot, so
+            // there can be no batching
+            batchSnapshots = 1;
+        }
+        if ((rrlpDataLengthBytes > 0) && (rrlpDataLengthBytes < INT_MAX)) {
             // If we're not using MEASX mode we can allocate a much smaller
             // and specific buffer length
             bufferLength = rrlpDataLengthBytes + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
@@ -404,18 +633,21 @@ int32_t uLocationPrivateCloudLocate(uDeviceHandle_t devHandle,
             }
 
             if (errorCode >= 0) { // >= 0 since uMqttClientSubscribe() returns QoS
-                // Set the RRLP mode
-                errorCode = uGnssPosSetRrlpMode(gnssDevHandle,
-                                                rrlpMode(rrlpDataLengthBytes));
-                if (errorCode == 0) {
-                    // Get the RRLP data from the GNSS chip
-                    errorCode = uGnssPosGetRrlp(gnssDevHandle, pBuffer, bufferLength,
-                                                svsThreshold, cNoThreshold, multipathIndexLimit,
-                                                pseudorangeRmsErrorIndexLimit,
-                                                pKeepGoingCallback);
-                    if (errorCode >= U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) {
+                // Get the RRLP data from the GNSS chip
+                errorCode = rrlpGet(gnssDevHandle, pBuffer, bufferLength,
+                                    rrlpDataLengthBytes, svsThreshold,
+                                    cNoThreshold, multipathIndexLimit,
+                                    pseudorangeRmsErrorIndexLimit,
+                                    pKeepGoingCallback, &compact);
+                if (errorCode >= U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) {
+                    if (batchSnapshots > 1) {
+                        // Keep the whole UBX frame so that the snapshots
+                        // in the batch can be told apart by the service
+                        errorCode = batchAdd(pMqttClientContext, batchSnapshots,
+                                             pBuffer, errorCode);
+                    } else {
                         pTmp = pBuffer;
-                        if (rrlpDataLengthBytes < INT_MAX) {
+                        if (compact) {
                             // If we're using one of the compact RRLP modes, the UBX
                             // protocol header and CRC must be stripped off
                             pTmp += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
@@ -507,4 +739,10 @@ int32_t uLocationPrivateCloudLocate(uDeviceHandle_t devHandle,
     return errorCode;
 }
 
+// Send any RRLP snapshots that are waiting in a batch.
+int32_t uLocationPrivateCloudLocateFlush(uMqttClientContext_t *pMqttClientContext)
+{
+    return batchFlush(pMqttClientContext);
+}
+
 // End of file
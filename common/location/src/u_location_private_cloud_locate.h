@@ -112,7 +112,22 @@ extern "C" {
  *                                      all modules, or 50 for MEAS50 mode,
  *                                      20 for MEAS20 mode; these latter are
  *                                      only supported by M10 modules and
- *                                      above.
+ *                                      above.  Use zero to have the mode
+ *                                      chosen automatically: MEAS50 if the
+ *                                      signals are strong enough for it to
+ *                                      do as well as MEASX and the GNSS
+ *                                      module supports it, else MEASX.
+ * @param batchSnapshots                the number of RRLP snapshots to
+ *                                      collect before sending them to
+ *                                      Cloud Locate in a single MQTT
+ *                                      message, each as a complete UBX
+ *                                      frame; zero or one to send each
+ *                                      snapshot as it is taken.  Ignored
+ *                                      if pLocation is not NULL, since
+ *                                      the location is then read back
+ *                                      for each snapshot.  Snapshots that
+ *                                      are waiting in a batch may be sent
+ *                                      with uLocationPrivateCloudLocateFlush().
  * @param pClientIdStr                  the Thingstream device ID, obtained
  *                                      from the Thingstream portal, for
  *                                      this device; must be provided if
@@ -149,10 +164,23 @@ int32_t uLocationPrivateCloudLocate(uDeviceHandle_t devHandle,
                                     int32_t multipathIndexLimit,
                                     int32_t pseudorangeRmsErrorIndexLimit,
                                     int32_t rrlpDataLengthBytes,
+                                    int32_t batchSnapshots,
                                     const char *pClientIdStr,
                                     uLocation_t *pLocation,
                                     bool (*pKeepGoingCallback) (uDeviceHandle_t));
 
+/** Send any RRLP snapshots that uLocationPrivateCloudLocate() is
+ * holding in a batch and free the memory of the batch.
+ *
+ * @param pMqttClientContext the context of an MQTT client that
+ *                           is logged-in to the Cloud Locate
+ *                           service; if this is NULL the batch
+ *                           is discarded.
+ * @return                   zero on success else negative error
+ *                           code.
+ */
+int32_t uLocationPrivateCloudLocateFlush(uMqttClientContext_t *pMqttClientContext);
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,6 +43,7 @@
 #include "u_gnss.h"
 #include "u_gnss_cfg.h"
 #include "u_gnss_pos.h"
+#include "u_gnss_pwr.h"
 
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
@@ -157,4 +158,45 @@ U_WEAK int32_t uGnssPosGetRrlp(uDeviceHandle_t gnssHandle, char *pBuffer,
     return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
 }
 
+U_WEAK int32_t uGnssCfgSetRate(uDeviceHandle_t gnssHandle,
+                               int32_t measurementPeriodMs,
+                               int32_t navigationCount,
+                               uGnssTimeSystem_t timeSystem)
+{
+    (void) gnssHandle;
+    (void) measurementPeriodMs;
+    (void) navigationCount;
+    (void) timeSystem;
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
+U_WEAK int32_t uGnssPwrSetMode(uDeviceHandle_t gnssHandle, uGnssPwrSavingMode_t mode)
+{
+    (void) gnssHandle;
+    (void) mode;
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
+U_WEAK int32_t uGnssPwrGetMode(uDeviceHandle_t gnssHandle)
+{
+    (void) gnssHandle;
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
+U_WEAK int32_t uGnssPwrSetTiming(uDeviceHandle_t gnssHandle,
+                                 int32_t acquisitionPeriodSeconds,
+                                 int32_t acquisitionRetryPeriodSeconds,
+                                 int32_t onTimeSeconds,
+                                 int32_t maxAcquisitionTimeSeconds,
+                                 int32_t minAcquisitionTimeSeconds)
+{
+    (void) gnssHandle;
+    (void) acquisitionPeriodSeconds;
+    (void) acquisitionRetryPeriodSeconds;
+    (void) onTimeSeconds;
+    (void) maxAcquisitionTimeSeconds;
+    (void) minAcquisitionTimeSeconds;
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
 // End of file
@@ -54,6 +54,7 @@
 #include "u_port.h"
 #include "u_port_debug.h"
 #include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_port_i2c.h"
 #include "u_port_spi.h"
 
@@ -723,6 +724,217 @@ static void testContinuous(uDeviceHandle_t devHandle,
     }
 }
 
+// Test continuous location with a rate that adapts to motion.
+static void testContinuousAdaptive(uDeviceHandle_t devHandle,
+                                   uNetworkType_t networkType,
+                                   uLocationType_t locationType,
+                                   const uLocationTestCfg_t *pLocationCfg)
+{
+    // Motion only from uLocationAdaptiveMotion(), falling to one
+    // fix every five seconds after three seconds without it
+    uLocationAdaptiveCfg_t cfg = {1000, 5000, 0, 0, 3000, false};
+    uLocationAdaptiveCfg_t cfgBad;
+    const uLocationAssist_t *pLocationAssist = NULL;
+    const char *pAuthenticationTokenStr = NULL;
+    int32_t startTimeMs;
+    int32_t timeoutMs = U_LOCATION_TEST_CFG_TIMEOUT_SECONDS * 1000;
+    int32_t count;
+    int32_t y;
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uLocationGetContinuousStartAdaptive(devHandle, NULL, locationType,
+                                                           NULL, NULL, locationCallback) < 0);
+    cfgBad = cfg;
+    cfgBad.movingRateMs = 0;
+    U_PORT_TEST_ASSERT(uLocationGetContinuousStartAdaptive(devHandle, &cfgBad, locationType,
+                                                           NULL, NULL, locationCallback) < 0);
+    cfgBad = cfg;
+    cfgBad.stationaryRateMs = cfg.movingRateMs - 1;
+    U_PORT_TEST_ASSERT(uLocationGetContinuousStartAdaptive(devHandle, &cfgBad, locationType,
+                                                           NULL, NULL, locationCallback) < 0);
+    // Not running
+    U_PORT_TEST_ASSERT(uLocationAdaptiveMotion(devHandle) < 0);
+
+    if ((pLocationCfg != NULL) && (locationType == U_LOCATION_TYPE_GNSS)) {
+        U_TEST_PRINT_LINE("continuous adaptive API.");
+        pLocationAssist = pLocationCfg->pLocationAssist;
+        pAuthenticationTokenStr = pLocationCfg->pAuthenticationTokenStr;
+        gDevHandle = NULL;
+        gErrorCode = INT_MIN;
+        gCount = 0;
+        uLocationTestResetLocation(&gLocation);
+        y = uLocationGetContinuousStartAdaptive(devHandle, &cfg, locationType,
+                                                pLocationAssist, pAuthenticationTokenStr,
+                                                locationCallback);
+        U_TEST_PRINT_LINE("uLocationGetContinuousStartAdaptive() returned %d.", y);
+#ifdef U_NETWORK_GNSS_CFG_CELL_USE_AT_ONLY
+        // As for uLocationGetContinuousStart()
+        U_PORT_TEST_ASSERT((y == 0) || (y == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED));
+#else
+        U_PORT_TEST_ASSERT(y == 0);
+#endif
+        if (y == 0) {
+            // Only one at a time
+            U_PORT_TEST_ASSERT(uLocationGetContinuousStartAdaptive(devHandle, &cfg, locationType,
+                                                                   pLocationAssist,
+                                                                   pAuthenticationTokenStr,
+                                                                   locationCallback) < 0);
+            startTimeMs = uPortGetTickTimeMs();
+            while ((gCount < U_LOCATION_TEST_CFG_CONTINUOUS_COUNT) &&
+                   (uPortGetTickTimeMs() - startTimeMs < timeoutMs)) {
+                U_PORT_TEST_ASSERT(uLocationAdaptiveMotion(devHandle) == 0);
+                uPortTaskBlock(500);
+            }
+            U_TEST_PRINT_LINE("took %d second(s) to get location %d time(s) while moving.",
+                              (int32_t) (uPortGetTickTimeMs() - startTimeMs) / 1000, gCount);
+            U_PORT_TEST_ASSERT(gCount >= U_LOCATION_TEST_CFG_CONTINUOUS_COUNT);
+            U_PORT_TEST_ASSERT(gDevHandle == devHandle);
+            U_PORT_TEST_ASSERT(gErrorCode == 0);
+            // Now stop moving: fixes should keep coming, just
+            // less often, once the stationary time has passed
+            uPortTaskBlock(cfg.stationaryTimeMs + cfg.movingRateMs);
+            count = gCount;
+            startTimeMs = uPortGetTickTimeMs();
+            while ((gCount == count) &&
+                   (uPortGetTickTimeMs() - startTimeMs < timeoutMs + cfg.stationaryRateMs)) {
+                uPortTaskBlock(500);
+            }
+            U_TEST_PRINT_LINE("%d second(s) between fixes while stationary.",
+                              (int32_t) (uPortGetTickTimeMs() - startTimeMs) / 1000);
+            U_PORT_TEST_ASSERT(gCount > count);
+            uLocationGetStop(devHandle);
+            U_PORT_TEST_ASSERT(uLocationAdaptiveMotion(devHandle) < 0);
+            // As for uLocationGetContinuousStart(), let anything in
+            // transit turn up and be discarded
+            uPortTaskBlock(U_LOCATION_TEST_CONTINUOUS_STOP_TIMEOUT_SECONDS * 1000);
+        }
+    } else if ((networkType == U_NETWORK_TYPE_WIFI) || (networkType == U_NETWORK_TYPE_BLE) ||
+               ((networkType == U_NETWORK_TYPE_CELL) && (locationType != U_LOCATION_TYPE_GNSS))) {
+        // Only GNSS location is supported
+        gCount = 0;
+        U_PORT_TEST_ASSERT(uLocationGetContinuousStartAdaptive(devHandle, &cfg, locationType,
+                                                               NULL, NULL, locationCallback) < 0);
+        U_PORT_TEST_ASSERT(uLocationAdaptiveMotion(devHandle) < 0);
+        U_PORT_TEST_ASSERT(gCount == 0);
+    }
+}
+
+// Test the hybrid location API with a single source.
+static void testHybrid(uDeviceHandle_t devHandle,
+                       uNetworkType_t networkType,
+                       uLocationType_t locationType,
+                       const uLocationTestCfg_t *pLocationCfg)
+{
+    uLocation_t location;
+    uLocationHybridSource_t sources[2];
+    int32_t startTimeMs;
+    int32_t timeoutMs = U_LOCATION_TEST_CFG_TIMEOUT_SECONDS * 1000;
+    int32_t y;
+
+    if (networkType == U_NETWORK_TYPE_WIFI) {
+        timeoutMs = U_LOCATION_TEST_CFG_WIFI_TIMEOUT_SECONDS * 1000;
+    }
+
+    sources[0].devHandle = devHandle;
+    sources[0].type = locationType;
+    sources[0].pLocationAssist = NULL;
+    sources[0].pAuthenticationTokenStr = NULL;
+    if (pLocationCfg != NULL) {
+        sources[0].pLocationAssist = pLocationCfg->pLocationAssist;
+        sources[0].pAuthenticationTokenStr = pLocationCfg->pAuthenticationTokenStr;
+    }
+    sources[1] = sources[0];
+    gDevHandle = devHandle;
+    uLocationTestResetLocation(&location);
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uLocationGetHybrid(NULL, 1, -1, &location, keepGoingCallback) < 0);
+    U_PORT_TEST_ASSERT(uLocationGetHybrid(sources, 0, -1, &location, keepGoingCallback) < 0);
+    U_PORT_TEST_ASSERT(uLocationGetHybrid(sources, U_LOCATION_HYBRID_MAX_NUM_SOURCES + 1,
+                                          -1, &location, keepGoingCallback) < 0);
+    // Two sources may not share a mechanism
+    U_PORT_TEST_ASSERT(uLocationGetHybrid(sources, 2, -1, &location, keepGoingCallback) < 0);
+    U_PORT_TEST_ASSERT(location.latitudeX1e7 == INT_MIN);
+
+    if ((pLocationCfg != NULL) && (locationType != U_LOCATION_TYPE_CLOUD_CLOUD_LOCATE)) {
+        U_TEST_PRINT_LINE("hybrid API.");
+        startTimeMs = uPortGetTickTimeMs();
+        gStopTimeMs = startTimeMs + timeoutMs;
+        y = uLocationGetHybrid(sources, 1, U_LOCATION_TEST_MAX_RADIUS_MILLIMETRES,
+                               &location, keepGoingCallback);
+        U_TEST_PRINT_LINE("uLocationGetHybrid() returned %d after %d second(s).", y,
+                          (int32_t) (uPortGetTickTimeMs() - startTimeMs) / 1000);
+        if (networkType != U_NETWORK_TYPE_WIFI) {
+            U_PORT_TEST_ASSERT(y == 0);
+        } else if (y != 0) {
+            // As for the other APIs, the cloud services used for Wifi-based
+            // location can sometimes be unable to determine position
+            U_TEST_PRINT_LINE("*** WARNING *** cloud service was unable to determine"
+                              " position (%d).", y);
+        }
+        if ((y == 0) && (location.radiusMillimetres > 0) &&
+            (location.radiusMillimetres <= U_LOCATION_TEST_MAX_RADIUS_MILLIMETRES)) {
+            uLocationTestPrintLocation(&location);
+            U_PORT_TEST_ASSERT(location.latitudeX1e7 > INT_MIN);
+            U_PORT_TEST_ASSERT(location.longitudeX1e7 > INT_MIN);
+        }
+    } else if ((pLocationCfg != NULL) || !U_NETWORK_TEST_TYPE_HAS_LOCATION(networkType)) {
+        // Cloud Locate is not supported and neither is a location
+        // type the network does not support
+        U_PORT_TEST_ASSERT(uLocationGetHybrid(sources, 1, -1, &location, keepGoingCallback) < 0);
+        U_PORT_TEST_ASSERT(location.latitudeX1e7 == INT_MIN);
+    }
+}
+
+// Test batching of Cloud Locate RRLP snapshots.
+static void testCloudLocateBatch(uDeviceHandle_t devHandle,
+                                 uLocationType_t locationType,
+                                 const uLocationTestCfg_t *pLocationCfg)
+{
+    uLocationAssist_t locationAssist;
+    uLocation_t location;
+    int32_t heapAllocCount;
+    int32_t y;
+
+    if ((pLocationCfg != NULL) && (locationType == U_LOCATION_TYPE_CLOUD_CLOUD_LOCATE) &&
+        (pLocationCfg->pLocationAssist != NULL) &&
+        (pLocationCfg->pLocationAssist->pMqttClientContext != NULL)) {
+        U_TEST_PRINT_LINE("Cloud Locate batching.");
+        locationAssist = *pLocationCfg->pLocationAssist;
+        // Nothing is waiting to be sent, so flushing or discarding
+        // does nothing
+        U_PORT_TEST_ASSERT(uLocationCloudLocateFlush(locationAssist.pMqttClientContext) == 0);
+        U_PORT_TEST_ASSERT(uLocationCloudLocateFlush(NULL) == 0);
+        heapAllocCount = uPortHeapAllocCount();
+        // Without a Client ID the location stays in the cloud, so
+        // the snapshots can be batched
+        locationAssist.pClientIdStr = NULL;
+        locationAssist.rrlpBatchSnapshots = 2;
+        gDevHandle = NULL;
+        gStopTimeMs = uPortGetTickTimeMs() + (U_LOCATION_TEST_CFG_TIMEOUT_SECONDS * 1000);
+        uLocationTestResetLocation(&location);
+        y = uLocationGet(devHandle, locationType, &locationAssist, NULL,
+                         &location, keepGoingCallback);
+        U_TEST_PRINT_LINE("first snapshot of the batch returned %d.", y);
+        U_PORT_TEST_ASSERT(y == 0);
+        // Nothing is returned and the snapshot is held
+        U_PORT_TEST_ASSERT(location.latitudeX1e7 == INT_MIN);
+        U_PORT_TEST_ASSERT(uPortHeapAllocCount() > heapAllocCount);
+        // Send the part-filled batch, which frees it
+        U_PORT_TEST_ASSERT(uLocationCloudLocateFlush(locationAssist.pMqttClientContext) == 0);
+        U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+        // Take another snapshot, this time in auto mode, and discard it
+        locationAssist.rrlpDataLengthBytes = 0;
+        gStopTimeMs = uPortGetTickTimeMs() + (U_LOCATION_TEST_CFG_TIMEOUT_SECONDS * 1000);
+        y = uLocationGet(devHandle, locationType, &locationAssist, NULL,
+                         &location, keepGoingCallback);
+        U_TEST_PRINT_LINE("auto-mode snapshot of the batch returned %d.", y);
+        U_PORT_TEST_ASSERT(y == 0);
+        U_PORT_TEST_ASSERT(uLocationCloudLocateFlush(NULL) == 0);
+        U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
@@ -845,6 +1057,18 @@ U_PORT_TEST_FUNCTION("[location]", "locationBasic")
                            (uLocationType_t) locationType, gpLocationCfg);
             U_PORT_TEST_ASSERT(httpPostCheck((uLocationType_t) locationType, gpHttpContext, &httpStatusCode));
 
+            // Test the adaptive continuous location API (supported and
+            // non-supported cases)
+            testContinuousAdaptive(devHandle, pTmp->networkType,
+                                   (uLocationType_t) locationType, gpLocationCfg);
+
+            // Test the hybrid location API (supported and non-supported cases)
+            testHybrid(devHandle, pTmp->networkType,
+                       (uLocationType_t) locationType, gpLocationCfg);
+
+            // Test batching of Cloud Locate snapshots (where supported)
+            testCloudLocateBatch(devHandle, (uLocationType_t) locationType, gpLocationCfg);
+
             if (gpLocationCfg != NULL) {
                 if ((gpLocationCfg->pLocationAssist != NULL) &&
                     (gpLocationCfg->pLocationAssist->pMqttClientContext != NULL)) {
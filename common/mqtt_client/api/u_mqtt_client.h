@@ -54,6 +54,69 @@ extern "C" {
 # define U_MQTT_CLIENT_RESPONSE_WAIT_SECONDS 120
 #endif
 
+#ifndef U_MQTT_CLIENT_PREFETCH_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that reads messages from the
+ * module when prefetch is on, see uMqttClientSetPrefetch();
+ * the message callback and the filter function are called
+ * from this task.
+ */
+# define U_MQTT_CLIENT_PREFETCH_TASK_STACK_SIZE_BYTES 2560
+#endif
+
+#ifndef U_MQTT_CLIENT_PREFETCH_TASK_PRIORITY
+/** The priority of the task that reads messages from the
+ * module when prefetch is on, see uMqttClientSetPrefetch().
+ */
+# define U_MQTT_CLIENT_PREFETCH_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
+#ifndef U_MQTT_CLIENT_SESSION_BACKOFF_MIN_MS
+/** The default delay before the first attempt to reconnect a
+ * managed session, see uMqttClientSessionStart(); each failed
+ * attempt doubles the delay up to
+ * #U_MQTT_CLIENT_SESSION_BACKOFF_MAX_MS.
+ */
+# define U_MQTT_CLIENT_SESSION_BACKOFF_MIN_MS 2000
+#endif
+
+#ifndef U_MQTT_CLIENT_SESSION_BACKOFF_MAX_MS
+/** The default longest delay between attempts to reconnect a
+ * managed session, see uMqttClientSessionStart().
+ */
+# define U_MQTT_CLIENT_SESSION_BACKOFF_MAX_MS (10 * 60 * 1000)
+#endif
+
+#ifndef U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_MESSAGES
+/** The default number of QoS 1 or 2 messages that a managed
+ * session holds in RAM, while it is disconnected, to be published
+ * once it is reconnected; see uMqttClientSessionStart().
+ */
+# define U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_MESSAGES 8
+#endif
+
+#ifndef U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_RETRIES
+/** The number of times that a managed session tries again to
+ * publish a held message which fails while the session is
+ * connected before throwing it away; see uMqttClientSessionStart().
+ */
+# define U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_RETRIES 3
+#endif
+
+#ifndef U_MQTT_CLIENT_SESSION_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that reconnects a managed session
+ * and publishes what it holds, see uMqttClientSessionStart(); the
+ * reconnect callback is called from this task.
+ */
+# define U_MQTT_CLIENT_SESSION_TASK_STACK_SIZE_BYTES 2560
+#endif
+
+#ifndef U_MQTT_CLIENT_SESSION_TASK_PRIORITY
+/** The priority of the task that reconnects a managed session
+ * and publishes what it holds, see uMqttClientSessionStart().
+ */
+# define U_MQTT_CLIENT_SESSION_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
 /** The defaults for an MQTT connection, see #uMqttClientConnection_t.
  * Whenever an instance of uMqttClientConnection_t is created it
  * should be assigned to this to ensure the correct default
@@ -62,6 +125,13 @@ extern "C" {
                                           -1, -1, false, false,    \
                                           NULL, NULL, false, 0}
 
+/** The defaults for a managed session, see #uMqttClientSessionCfg_t.
+ */
+#define U_MQTT_CLIENT_SESSION_CFG_DEFAULT {U_MQTT_CLIENT_SESSION_BACKOFF_MIN_MS,          \
+                                           U_MQTT_CLIENT_SESSION_BACKOFF_MAX_MS,          \
+                                           U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_MESSAGES, \
+                                           NULL, NULL}
+
 /** The number of bytes required to store a short MQTT-SN topic name,
  * which will be of the form "xy", two characters plus a null terminator.
  */
@@ -185,6 +255,27 @@ typedef struct {
                                             modules. */
 } uMqttClientConnection_t;
 
+/** Configuration of a managed session, see uMqttClientSessionStart().
+ * NOTE: if this structure is modified be sure to modify
+ * #U_MQTT_CLIENT_SESSION_CFG_DEFAULT to match.
+ */
+typedef struct {
+    int32_t backoffMinMs;        /**< the delay before the first attempt
+                                      to reconnect or to publish again. */
+    int32_t backoffMaxMs;        /**< the longest delay between attempts
+                                      to reconnect or to publish again. */
+    size_t outboxMaxNumMessages; /**< the number of QoS 1 or 2 messages
+                                      to hold, zero for none. */
+    void (*pReconnectCallback) (int32_t, void *); /**< called, with the
+                                                       number of attempts
+                                                       it took and
+                                                       pReconnectCallbackParam,
+                                                       each time the session
+                                                       has been reconnected;
+                                                       may be NULL. */
+    void *pReconnectCallbackParam;
+} uMqttClientSessionCfg_t;
+
 /** MQTT context data, used internally by this code and
  * exposed here only so that it can be handed around by the
  * caller.  The contents and, umm, structure of this structure
@@ -201,8 +292,30 @@ typedef struct {
     uSecurityTlsContext_t *pSecurityContext;
     int32_t totalMessagesSent;      /* Total messages sent from MQTT client */
     int32_t totalMessagesReceived;  /* Total messages received by MQTT client */
+    void (*pMessageCallback) (int32_t, void *); /* As passed to uMqttClientSetMessageCallback() */
+    void *pMessageCallbackParam;
+    void *pPrefetch; /* Prefetch state, NULL if uMqttClientSetPrefetch() is off */
+    void (*pDisconnectCallback) (int32_t, void *); /* As passed to uMqttClientSetDisconnectCallback() */
+    void *pDisconnectCallbackParam;
+    void *pSession; /* Managed session state, NULL if uMqttClientSessionStart() is off */
+    void *pSnTopicCache; /* MQTT-SN topic IDs kept across connections, NULL until needed */
 } uMqttClientContext_t;
 
+/** MQTT-SN only: a topic for uMqttClientSnRegisterNormalTopicList().
+ */
+typedef struct {
+    const char *pTopicNameStr;    /**< the null-terminated normal MQTT
+                                       topic name. */
+    int32_t predefinedId;         /**< a predefined topic ID, agreed with
+                                       the broker, to fall back to if the
+                                       topic cannot be registered; -1 for
+                                       none. */
+    uMqttSnTopicName_t topicName; /**< filled in with the MQTT-SN topic
+                                       name; the type is set to
+                                       #U_MQTT_SN_TOPIC_NAME_TYPE_MAX_NUM
+                                       if there is none. */
+} uMqttClientSnTopic_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: MQTT AND MQTT-SN
  * -------------------------------------------------------------- */
@@ -318,7 +431,7 @@ bool uMqttClientIsConnected(const uMqttClientContext_t *pContext);
  *                            as the second parameter.
  * @return                    zero on success else negative error code.
  */
-int32_t uMqttClientSetMessageCallback(const uMqttClientContext_t *pContext,
+int32_t uMqttClientSetMessageCallback(uMqttClientContext_t *pContext,
                                       void (*pCallback) (int32_t, void *),
                                       void *pCallbackParam);
 
@@ -374,7 +487,7 @@ int32_t uMqttClientGetTotalMessagesReceived(const uMqttClientContext_t *pContext
  * @param[in] pCallbackParam this value will be passed to pCallback.
  * @return                   zero on success else negative error code.
  */
-int32_t uMqttClientSetDisconnectCallback(const uMqttClientContext_t *pContext,
+int32_t uMqttClientSetDisconnectCallback(uMqttClientContext_t *pContext,
                                          void (*pCallback) (int32_t, void *),
                                          void *pCallbackParam);
 
@@ -497,6 +610,134 @@ int32_t uMqttClientMessageRead(uMqttClientContext_t *pContext,
                                size_t *pMessageSizeBytes,
                                uMqttQos_t *pQos);
 
+/** MQTT only: switch prefetch on or off; only supported for
+ * cellular.  When prefetch is on, an unread message indication
+ * from the module causes a task of this API to read all of the
+ * unread messages from the module, in the background, into a local
+ * queue of up to maxNumMessages messages.  uMqttClientMessageRead()
+ * then returns messages from RAM.  Only once the local queue is
+ * empty does it fall back to reading the module.
+ * uMqttClientGetUnread() returns the total of the local queue and
+ * the module.
+ *
+ * A filter function may be given: it is called with the topic of
+ * each message read from the module, and messages for which it
+ * returns false are thrown away without being queued.
+ *
+ * When prefetch is on, the callback set with
+ * uMqttClientSetMessageCallback() is called from the prefetch task,
+ * once the messages have been fetched, rather than straight from the
+ * module indication.
+ *
+ * You must have made an MQTT connection using uMqttClientConnect()
+ * first.
+ *
+ * @param[in] pContext         a pointer to the internal MQTT context
+ *                             structure that was originally returned
+ *                             by pUMqttClientOpen().
+ * @param maxNumMessages       the maximum number of messages to hold
+ *                             in RAM; any more are left in the module
+ *                             until there is room.  Use zero to
+ *                             switch prefetch off.
+ * @param maxMessageSizeBytes  the maximum length of a message; a
+ *                             longer message is truncated when it is
+ *                             fetched and uMqttClientMessageRead()
+ *                             will then return
+ *                             #U_ERROR_COMMON_TRUNCATED for it.
+ *                             Storage of this size is allocated
+ *                             while prefetch is on; ignored if
+ *                             maxNumMessages is zero.
+ * @param[in] pFilter          a function that is given the topic of
+ *                             each fetched message and pFilterParam;
+ *                             return true to keep the message, false
+ *                             to throw it away.  May be NULL, in
+ *                             which case all messages are kept.
+ * @param[in] pFilterParam     a parameter to pass to pFilter; may be
+ *                             NULL.
+ * @return                     zero on success else negative error
+ *                             code; #U_ERROR_COMMON_BUSY is returned
+ *                             if prefetch is already on and there are
+ *                             messages in the local queue that have
+ *                             not been read.
+ */
+int32_t uMqttClientSetPrefetch(uMqttClientContext_t *pContext,
+                               size_t maxNumMessages,
+                               size_t maxMessageSizeBytes,
+                               bool (*pFilter) (const char *, void *),
+                               void *pFilterParam);
+
+/** MQTT only: put an MQTT connection into managed-session
+ * mode; only supported for cellular.  In this mode, if the broker
+ * drops the connection, it is re-established by a task of this API,
+ * after a delay which starts at backoffMinMs and doubles with each
+ * failed attempt up to backoffMaxMs.  Each delay is drawn at random
+ * from between half and all of its nominal value, the random
+ * sequence being seeded from the client ID, so that a fleet of
+ * devices which lose coverage together do not all return together.
+ *
+ * The session is connected with retention on, i.e. "clean session"
+ * false, so that the broker keeps the subscriptions across a
+ * reconnection.  Where the module does not support retention
+ * (e.g. SARA-R5) the subscriptions made with uMqttClientSubscribe()
+ * while the session is managed are remembered and made again on
+ * reconnection.
+ *
+ * While the session is disconnected, or while messages are already
+ * held, uMqttClientPublish() of a QoS 1 or 2 message holds a copy in
+ * RAM, returning #U_ERROR_COMMON_TEMPORARY_FAILURE, so that messages
+ * are always published in order; the same happens if the publish
+ * fails with the module.  Up to outboxMaxNumMessages are held, after
+ * which #U_ERROR_COMMON_NO_MEMORY is returned.  Held messages are
+ * published by the task of this API once the session is reconnected,
+ * before the reconnect callback is called, or straight away if the
+ * session is connected.  Should publishing a held message fail while
+ * the session remains connected it is tried again, after a delay
+ * chosen as for reconnection, and it is thrown away once it has
+ * failed #U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_RETRIES more times,
+ * so that it cannot hold up those behind it.  QoS 0 messages are
+ * not held.
+ *
+ * A disconnect callback set with uMqttClientSetDisconnectCallback()
+ * is still called when the connection is dropped.  A disconnection
+ * made by uMqttClientDisconnect() is not undone.
+ *
+ * @param[in] pContext     a pointer to the internal MQTT context
+ *                         structure that was originally returned by
+ *                         pUMqttClientOpen().
+ * @param[in] pConnection  the connection information for the session;
+ *                         the structure is copied, the retain field
+ *                         being ignored, but the strings it points
+ *                         to are NOT copied and so must remain valid
+ *                         until uMqttClientSessionStop() has been
+ *                         called or pContext has been closed.  If the
+ *                         session is already connected it is adopted
+ *                         as it is, else it is connected here and
+ *                         an error is returned if that fails.
+ * @param[in] pCfg         the configuration; may be NULL, in which
+ *                         case #U_MQTT_CLIENT_SESSION_CFG_DEFAULT is
+ *                         used.
+ * @return                 zero on success else negative error code;
+ *                         #U_ERROR_COMMON_BUSY is returned if a
+ *                         managed session is already started.
+ */
+int32_t uMqttClientSessionStart(uMqttClientContext_t *pContext,
+                                const uMqttClientConnection_t *pConnection,
+                                const uMqttClientSessionCfg_t *pCfg);
+
+/** MQTT only: end managed-session mode, leaving the connection
+ * as it is; any messages held for publishing are thrown away.  This
+ * is done by uMqttClientClose() in any case.  If a reconnection is
+ * in progress this may take as long as uMqttClientConnect().
+ *
+ * @param[in] pContext  a pointer to the internal MQTT context
+ *                      structure that was originally returned by
+ *                      pUMqttClientOpen().
+ * @return              the number of messages that were held and
+ *                      have been thrown away, else negative error
+ *                      code.
+ */
+int32_t uMqttClientSessionStop(uMqttClientContext_t *pContext);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: MQTT-SN ONLY
  * -------------------------------------------------------------- */
@@ -629,6 +870,46 @@ int32_t uMqttClientSnRegisterNormalTopic(const uMqttClientContext_t *pContext,
                                          const char *pTopicNameStr,
                                          uMqttSnTopicName_t *pTopicName);
 
+/** MQTT-SN only: get MQTT-SN topic names for a whole list of normal
+ * MQTT topics in one go, intended to be called just after connecting.
+ * This is much quicker than calling uMqttClientSnRegisterNormalTopic()
+ * for each topic:
+ *
+ * - IDs already obtained are re-used without asking the broker: those
+ *   obtained during this connection and, if the connection was made
+ *   with retain set, so that the broker keeps the session, those
+ *   obtained during earlier connections or read from pCacheFileName,
+ * - the remaining topics are registered with the requests pipelined,
+ *   see uCellMqttSnRegisterNormalTopicList(), any that fail being
+ *   retried individually,
+ * - a topic that still cannot be registered is given its predefinedId,
+ *   if there is one.
+ *
+ * IDs are kept until uMqttClientClose() is called.  Note that normal
+ * topic IDs are assigned by the broker per session: only set retain
+ * to true in the connection if the broker really does keep the session,
+ * otherwise stale IDs may be used.
+ *
+ * This is currently only supported on cellular.  Must be connected to
+ * an MQTT-SN broker for this to work.
+ *
+ * @param[in] pContext        a pointer to the internal MQTT context.
+ * @param[in,out] pTopics     an array of numTopics topics, the
+ *                            topicName fields of which are filled in.
+ * @param numTopics           the number of topics.
+ * @param[in] pCacheFileName  the name of a file on the file system of
+ *                            the module in which to keep the topic IDs,
+ *                            so that a retained session survives a
+ *                            restart of this MCU; may be NULL.
+ * @return                    on success the number of topics that
+ *                            have a topic name, else negative error
+ *                            code.
+ */
+int32_t uMqttClientSnRegisterNormalTopicList(uMqttClientContext_t *pContext,
+                                             uMqttClientSnTopic_t *pTopics,
+                                             size_t numTopics,
+                                             const char *pCacheFileName);
+
 /** MQTT-SN only: publish a message; this differs from uMqttClientPublish()
  * in that it uses an MQTT-SN topic name, either created with
  * uMqttClientSnSetTopicIdPredefined()/ uMqttClientSnSetTopicNameShort()
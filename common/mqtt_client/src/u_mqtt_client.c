@@ -48,29 +48,148 @@
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
 #include "string.h"    // strlen(), strncpy(), memset()
+#include "stdlib.h"    // strtol()
+#include "stdio.h"     // snprintf()
+
+#include "u_cfg_os_platform_specific.h" // For U_CFG_OS_APP_TASK_PRIORITY
 
 #include "u_error_common.h"
 
 #include "u_device_shared.h"
 
+#include "u_port.h"
 #include "u_port_os.h"
 #include "u_port_heap.h"
+#include "u_port_event_queue.h"
 
 #include "u_mqtt_common.h"
 #include "u_mqtt_client.h"
+#include "u_mqtt_client_private.h"
 
 #include "u_cell_sec_tls.h"
 #include "u_cell_mqtt.h"
+#include "u_cell_file.h"
 #include "u_wifi_mqtt.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** How often the task of a managed session checks, while waiting
+ * to reconnect or to publish again, whether it has been asked to stop.
+ */
+#define U_MQTT_CLIENT_SESSION_WAIT_STEP_MS 100
+
+#ifndef U_MQTT_CLIENT_SN_TOPIC_CACHE_FILE_MAX_LENGTH_BYTES
+/** The maximum size of the file in which
+ * uMqttClientSnRegisterNormalTopicList() keeps MQTT-SN topic IDs.
+ */
+# define U_MQTT_CLIENT_SN_TOPIC_CACHE_FILE_MAX_LENGTH_BYTES 1024
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** A message held in RAM by prefetch; the topic string and then
+ * the message follow the structure in the same allocation.
+ */
+typedef struct uMqttClientPrefetchMessage_t {
+    struct uMqttClientPrefetchMessage_t *pNext;
+    size_t messageSizeBytes;
+    uMqttQos_t qos;
+    bool truncated;
+} uMqttClientPrefetchMessage_t;
+
+/** The prefetch state of an MQTT client, pointed-to by the pPrefetch
+ * field of uMqttClientContext_t.
+ */
+typedef struct {
+    uPortMutexHandle_t mutex; /**< Protects the queue and fetchPending,
+                                   which are also touched from the message
+                                   indication callback. */
+    int32_t eventQueueHandle;
+    uMqttClientPrefetchMessage_t *pHead;
+    uMqttClientPrefetchMessage_t *pTail;
+    size_t numMessages;
+    size_t maxNumMessages;
+    bool fetchPending;
+    bool (*pFilter) (const char *, void *);
+    void *pFilterParam;
+    size_t maxMessageSizeBytes;
+    char topicNameStr[U_CELL_MQTT_READ_TOPIC_MAX_LENGTH_BYTES + 1];
+    char *pMessage; /**< Storage of maxMessageSizeBytes that follows
+                         this structure. */
+} uMqttClientPrefetch_t;
+
+/** A subscription remembered by a managed session; the topic filter
+ * string follows the structure in the same allocation.
+ */
+typedef struct uMqttClientSessionSubscription_t {
+    struct uMqttClientSessionSubscription_t *pNext;
+    uMqttQos_t maxQos;
+} uMqttClientSessionSubscription_t;
+
+/** A message held by a managed session to be published once it is
+ * reconnected; the topic string and then the message follow the
+ * structure in the same allocation.
+ */
+typedef struct uMqttClientSessionMessage_t {
+    struct uMqttClientSessionMessage_t *pNext;
+    size_t messageSizeBytes;
+    uMqttQos_t qos;
+    bool retain;
+    int32_t numRetries; /**< the number of times publishing this
+                             message has failed while connected. */
+} uMqttClientSessionMessage_t;
+
+/** The managed-session state of an MQTT client, pointed-to by the
+ * pSession field of uMqttClientContext_t.  Apart from
+ * reconnectPending, which is also touched from the disconnect
+ * callback, everything is protected by the context mutex.
+ */
+typedef struct {
+    uPortMutexHandle_t mutex; /**< Protects reconnectPending. */
+    int32_t eventQueueHandle;
+    uMqttClientConnection_t connection;
+    uMqttClientSessionCfg_t cfg;
+    bool persistent; /**< true if the broker keeps the subscriptions. */
+    uMqttClientSessionSubscription_t *pSubscriptions;
+    uMqttClientSessionMessage_t *pOutboxHead;
+    uMqttClientSessionMessage_t *pOutboxTail;
+    size_t outboxNumMessages;
+    uint32_t randomState;
+    bool reconnectPending; /**< true if an event is pending for the
+                                session task, which reconnects and
+                                publishes what is held. */
+    volatile bool stopping;
+} uMqttClientSession_t;
+
+/** An MQTT-SN topic ID remembered by
+ * uMqttClientSnRegisterNormalTopicList(); the topic string follows
+ * the structure in the same allocation.
+ */
+typedef struct uMqttClientSnTopicCacheEntry_t {
+    struct uMqttClientSnTopicCacheEntry_t *pNext;
+    uint16_t id;
+    int32_t connectCount; /**< The value of connectCount in
+                               uMqttClientSnTopicCache_t when the ID was
+                               obtained, -1 if it was read from file. */
+} uMqttClientSnTopicCacheEntry_t;
+
+/** The MQTT-SN topic ID cache of an MQTT client, pointed-to by the
+ * pSnTopicCache field of uMqttClientContext_t; protected by the
+ * context mutex.
+ */
+typedef struct {
+    uMqttClientSnTopicCacheEntry_t *pHead;
+    int32_t connectCount; /**< Incremented on every MQTT-SN connect. */
+    bool retain; /**< The retain setting of the last connect: if the
+                      broker keeps the session then IDs obtained in an
+                      earlier connection remain valid. */
+    bool loaded; /**< True once the cache file has been read. */
+} uMqttClientSnTopicCache_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -148,6 +267,756 @@ static int32_t cellConnect(uDeviceHandle_t devHandle,
     return errorCode;
 }
 
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: PREFETCH
+ * -------------------------------------------------------------- */
+
+// Ask the prefetch task to read messages from the module, unless it
+// has already been asked; since at most one event is ever pending,
+// the send cannot block.
+static void prefetchTrigger(uMqttClientContext_t *pContext,
+                            uMqttClientPrefetch_t *pPrefetch)
+{
+    U_PORT_MUTEX_LOCK(pPrefetch->mutex);
+
+    if (!pPrefetch->fetchPending) {
+        if (uPortEventQueueSend(pPrefetch->eventQueueHandle,
+                                &pContext, sizeof(pContext)) == 0) {
+            pPrefetch->fetchPending = true;
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(pPrefetch->mutex);
+}
+
+// The message indication callback given to cellular while prefetch
+// is on; pParam is the MQTT context.  The context mutex is locked
+// so that prefetch cannot be switched off, and its state freed,
+// underneath us.
+static void prefetchMessageCallback(int32_t numUnread, void *pParam)
+{
+    uMqttClientContext_t *pContext = (uMqttClientContext_t *) pParam;
+    uMqttClientPrefetch_t *pPrefetch;
+
+    U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    pPrefetch = (uMqttClientPrefetch_t *) pContext->pPrefetch;
+    if ((pPrefetch != NULL) && (numUnread > 0)) {
+        prefetchTrigger(pContext, pPrefetch);
+    }
+
+    U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+}
+
+// Event handler of the prefetch task: read messages from the module
+// until it has none or the local queue is full, then tell the
+// application.
+static void prefetchEventHandler(void *pParam, size_t paramLength)
+{
+    uMqttClientContext_t *pContext = *((uMqttClientContext_t **) pParam);
+    uMqttClientPrefetch_t *pPrefetch;
+    uMqttClientPrefetchMessage_t *pMessage;
+    size_t messageSizeBytes;
+    size_t topicSizeBytes;
+    uMqttQos_t qos;
+    bool full = false;
+    int32_t errorCode;
+    int32_t numUnread = -1;
+    void (*pCallback) (int32_t, void *) = NULL;
+    void *pCallbackParam = NULL;
+
+    (void) paramLength;
+
+    U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    pPrefetch = (uMqttClientPrefetch_t *) pContext->pPrefetch;
+    if (pPrefetch != NULL) {
+        U_PORT_MUTEX_LOCK(pPrefetch->mutex);
+        // Anything that arrives from now on needs a new event
+        pPrefetch->fetchPending = false;
+        U_PORT_MUTEX_UNLOCK(pPrefetch->mutex);
+
+        while (!full && (uCellMqttGetUnread(pContext->devHandle) > 0)) {
+            messageSizeBytes = pPrefetch->maxMessageSizeBytes;
+            qos = U_MQTT_QOS_AT_MOST_ONCE;
+            errorCode = uCellMqttMessageRead(pContext->devHandle,
+                                             pPrefetch->topicNameStr,
+                                             sizeof(pPrefetch->topicNameStr),
+                                             pPrefetch->pMessage,
+                                             &messageSizeBytes,
+                                             (uCellMqttQos_t *) &qos);
+            if ((errorCode != 0) && (errorCode != (int32_t) U_ERROR_COMMON_TRUNCATED)) {
+                // Leave it for uMqttClientMessageRead() to report
+                break;
+            }
+            if ((pPrefetch->pFilter == NULL) ||
+                pPrefetch->pFilter(pPrefetch->topicNameStr, pPrefetch->pFilterParam)) {
+                topicSizeBytes = strlen(pPrefetch->topicNameStr) + 1;
+                pMessage = (uMqttClientPrefetchMessage_t *) pUPortMalloc(sizeof(*pMessage) +
+                                                                         topicSizeBytes +
+                                                                         messageSizeBytes);
+                if (pMessage == NULL) {
+                    // Nothing more can be done, the message is lost
+                    break;
+                }
+                pMessage->pNext = NULL;
+                pMessage->messageSizeBytes = messageSizeBytes;
+                pMessage->qos = qos;
+                pMessage->truncated = (errorCode != 0);
+                memcpy(pMessage + 1, pPrefetch->topicNameStr, topicSizeBytes);
+                memcpy(((char *) (pMessage + 1)) + topicSizeBytes,
+                       pPrefetch->pMessage, messageSizeBytes);
+
+                U_PORT_MUTEX_LOCK(pPrefetch->mutex);
+                if (pPrefetch->pTail != NULL) {
+                    pPrefetch->pTail->pNext = pMessage;
+                } else {
+                    pPrefetch->pHead = pMessage;
+                }
+                pPrefetch->pTail = pMessage;
+                pPrefetch->numMessages++;
+                full = (pPrefetch->numMessages >= pPrefetch->maxNumMessages);
+                U_PORT_MUTEX_UNLOCK(pPrefetch->mutex);
+            }
+        }
+
+        numUnread = uCellMqttGetUnread(pContext->devHandle);
+        if (numUnread >= 0) {
+            numUnread += (int32_t) pPrefetch->numMessages;
+        }
+        pCallback = pContext->pMessageCallback;
+        pCallbackParam = pContext->pMessageCallbackParam;
+    }
+
+    U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    if ((pCallback != NULL) && (numUnread > 0)) {
+        // Called outside the lock so that the application
+        // may call back into this API
+        pCallback(numUnread, pCallbackParam);
+    }
+}
+
+// Take a message from the local queue of prefetch, returning
+// U_ERROR_COMMON_EMPTY if there is none; the parameters are
+// as for uMqttClientMessageRead().
+static int32_t prefetchRead(uMqttClientContext_t *pContext,
+                            uMqttClientPrefetch_t *pPrefetch,
+                            char *pTopicNameStr,
+                            size_t topicNameSizeBytes,
+                            char *pMessage,
+                            size_t *pMessageSizeBytes,
+                            uMqttQos_t *pQos)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_EMPTY;
+    uMqttClientPrefetchMessage_t *pPrefetchMessage;
+    bool wasFull;
+    const char *pStr;
+    size_t x;
+
+    U_PORT_MUTEX_LOCK(pPrefetch->mutex);
+
+    pPrefetchMessage = pPrefetch->pHead;
+    wasFull = (pPrefetch->numMessages >= pPrefetch->maxNumMessages);
+    if (pPrefetchMessage != NULL) {
+        pPrefetch->pHead = pPrefetchMessage->pNext;
+        if (pPrefetch->pHead == NULL) {
+            pPrefetch->pTail = NULL;
+        }
+        pPrefetch->numMessages--;
+    }
+
+    U_PORT_MUTEX_UNLOCK(pPrefetch->mutex);
+
+    if (pPrefetchMessage != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        pStr = (const char *) (pPrefetchMessage + 1);
+        x = strlen(pStr);
+        if (x > topicNameSizeBytes - 1) {
+            x = topicNameSizeBytes - 1;
+            errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+        }
+        memcpy(pTopicNameStr, pStr, x);
+        *(pTopicNameStr + x) = '\0';
+        if (pMessage != NULL) {
+            pStr += strlen(pStr) + 1;
+            x = pPrefetchMessage->messageSizeBytes;
+            if (x > *pMessageSizeBytes) {
+                x = *pMessageSizeBytes;
+                errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+            }
+            memcpy(pMessage, pStr, x);
+            *pMessageSizeBytes = x;
+        }
+        if (pPrefetchMessage->truncated) {
+            errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+        }
+        if (pQos != NULL) {
+            *pQos = pPrefetchMessage->qos;
+        }
+        uPortFree(pPrefetchMessage);
+        if (wasFull) {
+            // There is room again, fetch whatever was left behind
+            prefetchTrigger(pContext, pPrefetch);
+        }
+    }
+
+    return errorCode;
+}
+
+// Switch prefetch off, returning the prefetch state which the caller
+// must pass to prefetchFree() once the context mutex is unlocked;
+// must be called with the context mutex locked.
+static uMqttClientPrefetch_t *pPrefetchDetach(uMqttClientContext_t *pContext)
+{
+    uMqttClientPrefetch_t *pPrefetch = (uMqttClientPrefetch_t *) pContext->pPrefetch;
+
+    if (pPrefetch != NULL) {
+        pContext->pPrefetch = NULL;
+        // Give cellular back the application's callback
+        uCellMqttSetMessageCallback(pContext->devHandle,
+                                    pContext->pMessageCallback,
+                                    pContext->pMessageCallbackParam);
+    }
+
+    return pPrefetch;
+}
+
+// Free prefetch state; must be called with the context mutex unlocked
+// since the prefetch task locks it.
+static void prefetchFree(uMqttClientPrefetch_t *pPrefetch)
+{
+    uMqttClientPrefetchMessage_t *pTmp;
+
+    if (pPrefetch != NULL) {
+        uPortEventQueueClose(pPrefetch->eventQueueHandle);
+        while (pPrefetch->pHead != NULL) {
+            pTmp = pPrefetch->pHead->pNext;
+            uPortFree(pPrefetch->pHead);
+            pPrefetch->pHead = pTmp;
+        }
+        uPortMutexDelete(pPrefetch->mutex);
+        uPortFree(pPrefetch);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: MANAGED SESSION
+ * -------------------------------------------------------------- */
+
+// Return the next number of a random sequence; a simple LCG is
+// used as rand() is not usable on all platforms.
+static uint32_t sessionRandom(uint32_t *pRandomState)
+{
+    *pRandomState = (*pRandomState * 1664525U) + 1013904223U;
+
+    // The low bits of an LCG are not very random
+    return *pRandomState >> 8;
+}
+
+// Return the delay before the given attempt to reconnect, or to
+// publish again, counting from zero.
+static int32_t sessionBackoffMs(uMqttClientSession_t *pSession,
+                                int32_t attempt)
+{
+    return uMqttClientPrivateSessionBackoffMs(pSession->cfg.backoffMinMs,
+                                              pSession->cfg.backoffMaxMs,
+                                              attempt,
+                                              &(pSession->randomState));
+}
+
+// Wait for the given time or until the session is asked to stop.
+static void sessionWait(const uMqttClientSession_t *pSession,
+                        int32_t delayMs)
+{
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    while (!pSession->stopping &&
+           (uPortGetTickTimeMs() - startTimeMs < delayMs)) {
+        uPortTaskBlock(U_MQTT_CLIENT_SESSION_WAIT_STEP_MS);
+    }
+}
+
+// Ask the session task to reconnect and publish what is held,
+// unless it has already been asked; since at most one event is
+// ever pending, the send cannot block.
+static void sessionTrigger(uMqttClientContext_t *pContext,
+                           uMqttClientSession_t *pSession)
+{
+    U_PORT_MUTEX_LOCK(pSession->mutex);
+
+    if (!pSession->reconnectPending) {
+        if (uPortEventQueueSend(pSession->eventQueueHandle,
+                                &pContext, sizeof(pContext)) == 0) {
+            pSession->reconnectPending = true;
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(pSession->mutex);
+}
+
+// The disconnect callback given to cellular while a session is
+// managed; pParam is the MQTT context.  The context mutex is held
+// while the session is used, so that it cannot be freed underneath
+// us, but not while the application's callback is called.
+static void sessionDisconnectCallback(int32_t errorCode, void *pParam)
+{
+    uMqttClientContext_t *pContext = (uMqttClientContext_t *) pParam;
+    uMqttClientSession_t *pSession;
+    void (*pCallback) (int32_t, void *);
+    void *pCallbackParam;
+
+    U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    pSession = (uMqttClientSession_t *) pContext->pSession;
+    if ((pSession != NULL) && !pSession->stopping) {
+        sessionTrigger(pContext, pSession);
+    }
+    pCallback = pContext->pDisconnectCallback;
+    pCallbackParam = pContext->pDisconnectCallbackParam;
+
+    U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    if (pCallback != NULL) {
+        pCallback(errorCode, pCallbackParam);
+    }
+}
+
+// Make again the subscriptions of a managed session.
+static void sessionResubscribe(uMqttClientContext_t *pContext,
+                               const uMqttClientSession_t *pSession)
+{
+    const uMqttClientSessionSubscription_t *pSubscription;
+
+    U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    pSubscription = pSession->pSubscriptions;
+    while ((pSubscription != NULL) && !pSession->stopping &&
+           (uCellMqttSubscribe(pContext->devHandle,
+                               (const char *) (pSubscription + 1),
+                               (uCellMqttQos_t) pSubscription->maxQos) >= 0)) {
+        pSubscription = pSubscription->pNext;
+    }
+
+    U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+}
+
+// Remove the message at the head of the outbox of a managed
+// session and free it; must be called with the context mutex locked.
+static void sessionOutboxPop(uMqttClientSession_t *pSession)
+{
+    uMqttClientSessionMessage_t *pMessage = pSession->pOutboxHead;
+
+    if (pMessage != NULL) {
+        pSession->pOutboxHead = pMessage->pNext;
+        if (pSession->pOutboxHead == NULL) {
+            pSession->pOutboxTail = NULL;
+        }
+        pSession->outboxNumMessages--;
+        uPortFree(pMessage);
+    }
+}
+
+// Publish, in order, the messages held by a managed session,
+// stopping at the first that fails, returning true if nothing is
+// left held.  A message whose publish fails while the session
+// remains connected is tried again by a later call, but after
+// U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_RETRIES such failures it is
+// thrown away so that it does not hold up those behind it.
+static bool sessionReplay(uMqttClientContext_t *pContext,
+                          uMqttClientSession_t *pSession)
+{
+    uMqttClientSessionMessage_t *pMessage;
+    const char *pTopicNameStr;
+    bool keepGoing = true;
+    bool empty = false;
+
+    while (keepGoing) {
+        keepGoing = false;
+
+        U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+        pMessage = pSession->pOutboxHead;
+        if (pMessage == NULL) {
+            empty = true;
+        } else if (!pSession->stopping) {
+            pTopicNameStr = (const char *) (pMessage + 1);
+            if (uCellMqttPublish(pContext->devHandle, pTopicNameStr,
+                                 pTopicNameStr + strlen(pTopicNameStr) + 1,
+                                 pMessage->messageSizeBytes,
+                                 (uCellMqttQos_t) pMessage->qos,
+                                 pMessage->retain) == 0) {
+                pContext->totalMessagesSent++;
+                sessionOutboxPop(pSession);
+                keepGoing = true;
+            } else if (uCellMqttIsConnected(pContext->devHandle)) {
+                // Still connected, so it is the message rather than
+                // the connection that is at fault
+                pMessage->numRetries++;
+                if (pMessage->numRetries > U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_RETRIES) {
+                    sessionOutboxPop(pSession);
+                    keepGoing = true;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+    }
+
+    return empty;
+}
+
+// Event handler of the session task: reconnect, with backoff, until
+// connected or asked to stop, then make the subscriptions again if
+// the broker will not have kept them and publish whatever is held,
+// trying again, with backoff, for as long as the session remains
+// connected.  The session state remains valid while this runs since
+// sessionFree() closes the event queue before freeing it.
+static void sessionEventHandler(void *pParam, size_t paramLength)
+{
+    uMqttClientContext_t *pContext = *((uMqttClientContext_t **) pParam);
+    uMqttClientSession_t *pSession;
+    int32_t attempt = 0;
+    int32_t retry = 0;
+    bool connected;
+    bool held;
+
+    (void) paramLength;
+
+    U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    pSession = (uMqttClientSession_t *) pContext->pSession;
+    if (pSession != NULL) {
+        U_PORT_MUTEX_LOCK(pSession->mutex);
+        // A drop from now on needs a new event
+        pSession->reconnectPending = false;
+        U_PORT_MUTEX_UNLOCK(pSession->mutex);
+    }
+
+    U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+    if (pSession != NULL) {
+        connected = uMqttClientIsConnected(pContext);
+        while (!connected && !pSession->stopping) {
+            sessionWait(pSession, sessionBackoffMs(pSession, attempt));
+            if (!pSession->stopping) {
+                attempt++;
+                connected = (uMqttClientConnect(pContext, &(pSession->connection)) == 0);
+            }
+        }
+        if (connected && !pSession->stopping) {
+            if ((attempt > 0) && !pSession->persistent) {
+                sessionResubscribe(pContext, pSession);
+            }
+            held = !sessionReplay(pContext, pSession);
+            if ((attempt > 0) && (pSession->cfg.pReconnectCallback != NULL)) {
+                pSession->cfg.pReconnectCallback(attempt,
+                                                 pSession->cfg.pReconnectCallbackParam);
+            }
+            // If anything is still held, keep trying; should
+            // the connection drop, the disconnect callback
+            // will have queued another event
+            while (held && !pSession->stopping &&
+                   uMqttClientIsConnected(pContext)) {
+                sessionWait(pSession, sessionBackoffMs(pSession, retry));
+                retry++;
+                held = !sessionReplay(pContext, pSession);
+            }
+        }
+    }
+}
+
+// Hold a copy of a message to be published once a managed session
+// is reconnected, returning true if there was room; must be called
+// with the context mutex locked.
+static bool sessionHold(uMqttClientSession_t *pSession,
+                        const char *pTopicNameStr,
+                        const char *pMessage, size_t messageSizeBytes,
+                        uMqttQos_t qos, bool retain)
+{
+    uMqttClientSessionMessage_t *pHeld = NULL;
+    size_t topicSizeBytes = strlen(pTopicNameStr) + 1;
+
+    if (pSession->outboxNumMessages < pSession->cfg.outboxMaxNumMessages) {
+        pHeld = (uMqttClientSessionMessage_t *) pUPortMalloc(sizeof(*pHeld) +
+                                                             topicSizeBytes +
+                                                             messageSizeBytes);
+        if (pHeld != NULL) {
+            pHeld->pNext = NULL;
+            pHeld->messageSizeBytes = messageSizeBytes;
+            pHeld->qos = qos;
+            pHeld->retain = retain;
+            pHeld->numRetries = 0;
+            memcpy(pHeld + 1, pTopicNameStr, topicSizeBytes);
+            if (messageSizeBytes > 0) {
+                memcpy(((char *) (pHeld + 1)) + topicSizeBytes,
+                       pMessage, messageSizeBytes);
+            }
+            if (pSession->pOutboxTail != NULL) {
+                pSession->pOutboxTail->pNext = pHeld;
+            } else {
+                pSession->pOutboxHead = pHeld;
+            }
+            pSession->pOutboxTail = pHeld;
+            pSession->outboxNumMessages++;
+        }
+    }
+
+    return (pHeld != NULL);
+}
+
+// Remember, or with remember false forget, a subscription of a
+// managed session; must be called with the context mutex locked.
+static void sessionSubscription(uMqttClientSession_t *pSession,
+                                const char *pTopicFilterStr,
+                                uMqttQos_t maxQos, bool remember)
+{
+    uMqttClientSessionSubscription_t **ppSubscription = &(pSession->pSubscriptions);
+    uMqttClientSessionSubscription_t *pTmp;
+    size_t topicSizeBytes = strlen(pTopicFilterStr) + 1;
+
+    while ((*ppSubscription != NULL) &&
+           (strcmp((const char *) (*ppSubscription + 1), pTopicFilterStr) != 0)) {
+        ppSubscription = &((*ppSubscription)->pNext);
+    }
+
+    if (*ppSubscription != NULL) {
+        if (remember) {
+            (*ppSubscription)->maxQos = maxQos;
+        } else {
+            pTmp = *ppSubscription;
+            *ppSubscription = pTmp->pNext;
+            uPortFree(pTmp);
+        }
+    } else if (remember) {
+        pTmp = (uMqttClientSessionSubscription_t *) pUPortMalloc(sizeof(*pTmp) +
+                                                                 topicSizeBytes);
+        if (pTmp != NULL) {
+            pTmp->pNext = NULL;
+            pTmp->maxQos = maxQos;
+            memcpy(pTmp + 1, pTopicFilterStr, topicSizeBytes);
+            *ppSubscription = pTmp;
+        }
+    }
+}
+
+// End the management of a session, returning the session state
+// which the caller must pass to sessionFree() once the context mutex
+// is unlocked; must be called with the context mutex locked.
+static uMqttClientSession_t *pSessionDetach(uMqttClientContext_t *pContext)
+{
+    uMqttClientSession_t *pSession = (uMqttClientSession_t *) pContext->pSession;
+
+    if (pSession != NULL) {
+        pSession->stopping = true;
+        pContext->pSession = NULL;
+        // Give cellular back the application's callback
+        uCellMqttSetDisconnectCallback(pContext->devHandle,
+                                       pContext->pDisconnectCallback,
+                                       pContext->pDisconnectCallbackParam);
+    }
+
+    return pSession;
+}
+
+// Free managed-session state; must be called with the context mutex
+// unlocked since the session task locks it.
+static void sessionFree(uMqttClientSession_t *pSession)
+{
+    uMqttClientSessionSubscription_t *pSubscription;
+    uMqttClientSessionMessage_t *pMessage;
+
+    if (pSession != NULL) {
+        pSession->stopping = true;
+        if (pSession->eventQueueHandle >= 0) {
+            uPortEventQueueClose(pSession->eventQueueHandle);
+        }
+        while (pSession->pSubscriptions != NULL) {
+            pSubscription = pSession->pSubscriptions->pNext;
+            uPortFree(pSession->pSubscriptions);
+            pSession->pSubscriptions = pSubscription;
+        }
+        while (pSession->pOutboxHead != NULL) {
+            pMessage = pSession->pOutboxHead->pNext;
+            uPortFree(pSession->pOutboxHead);
+            pSession->pOutboxHead = pMessage;
+        }
+        if (pSession->mutex != NULL) {
+            uPortMutexDelete(pSession->mutex);
+        }
+        uPortFree(pSession);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: MQTT-SN TOPIC ID CACHE
+ * -------------------------------------------------------------- */
+
+// Get the MQTT-SN topic cache of a context, creating it if required;
+// must be called with the context mutex locked.
+static uMqttClientSnTopicCache_t *pSnTopicCacheGet(uMqttClientContext_t *pContext)
+{
+    uMqttClientSnTopicCache_t *pCache = (uMqttClientSnTopicCache_t *) pContext->pSnTopicCache;
+
+    if (pCache == NULL) {
+        pCache = (uMqttClientSnTopicCache_t *) pUPortMalloc(sizeof(*pCache));
+        if (pCache != NULL) {
+            memset(pCache, 0, sizeof(*pCache));
+            pContext->pSnTopicCache = pCache;
+        }
+    }
+
+    return pCache;
+}
+
+// Find the entry for a topic in the MQTT-SN topic cache.
+static uMqttClientSnTopicCacheEntry_t *pSnTopicCacheFind(const uMqttClientSnTopicCache_t *pCache,
+                                                         const char *pTopicNameStr)
+{
+    uMqttClientSnTopicCacheEntry_t *pEntry = pCache->pHead;
+
+    while ((pEntry != NULL) && (strcmp((const char *) (pEntry + 1), pTopicNameStr) != 0)) {
+        pEntry = pEntry->pNext;
+    }
+
+    return pEntry;
+}
+
+// Add or update a topic in the MQTT-SN topic cache.
+static void snTopicCacheSet(uMqttClientSnTopicCache_t *pCache,
+                            const char *pTopicNameStr, size_t topicNameLength,
+                            uint16_t id, int32_t connectCount)
+{
+    uMqttClientSnTopicCacheEntry_t *pEntry = NULL;
+
+    if (strlen(pTopicNameStr) == topicNameLength) {
+        pEntry = pSnTopicCacheFind(pCache, pTopicNameStr);
+    }
+    if (pEntry == NULL) {
+        pEntry = (uMqttClientSnTopicCacheEntry_t *) pUPortMalloc(sizeof(*pEntry) +
+                                                                 topicNameLength + 1);
+        if (pEntry != NULL) {
+            memcpy(pEntry + 1, pTopicNameStr, topicNameLength);
+            *(((char *) (pEntry + 1)) + topicNameLength) = 0;
+            pEntry->pNext = pCache->pHead;
+            pCache->pHead = pEntry;
+        }
+    }
+    if (pEntry != NULL) {
+        pEntry->id = id;
+        pEntry->connectCount = connectCount;
+    }
+}
+
+// Read the MQTT-SN topic cache file, lines of "<id> <topic>\n".
+static void snTopicCacheLoad(uDeviceHandle_t devHandle,
+                             uMqttClientSnTopicCache_t *pCache,
+                             const char *pFileName)
+{
+    char *pBuffer = (char *) pUPortMalloc(U_MQTT_CLIENT_SN_TOPIC_CACHE_FILE_MAX_LENGTH_BYTES + 1);
+    int32_t length;
+    char *pLine;
+    char *pEnd;
+    char *pNewline;
+    long id;
+
+    if (pBuffer != NULL) {
+        length = uCellFileBlockRead(devHandle, pFileName, pBuffer, 0,
+                                    U_MQTT_CLIENT_SN_TOPIC_CACHE_FILE_MAX_LENGTH_BYTES);
+        if (length > 0) {
+            *(pBuffer + length) = 0;
+            pLine = pBuffer;
+            while ((pNewline = strchr(pLine, '\n')) != NULL) {
+                id = strtol(pLine, &pEnd, 10);
+                if ((pEnd != pLine) && (*pEnd == ' ') && (id >= 0) &&
+                    (id <= UINT16_MAX) && (pEnd + 1 < pNewline)) {
+                    // Entries obtained in this session take precedence
+                    *pNewline = 0;
+                    if (pSnTopicCacheFind(pCache, pEnd + 1) == NULL) {
+                        snTopicCacheSet(pCache, pEnd + 1, pNewline - (pEnd + 1),
+                                        (uint16_t) id, -1);
+                    }
+                }
+                pLine = pNewline + 1;
+            }
+        }
+        uPortFree(pBuffer);
+    }
+}
+
+// Write the MQTT-SN topic cache file; entries that don't fit are
+// simply left out.
+static void snTopicCacheSave(uDeviceHandle_t devHandle,
+                             const uMqttClientSnTopicCache_t *pCache,
+                             const char *pFileName)
+{
+    char *pBuffer = (char *) pUPortMalloc(U_MQTT_CLIENT_SN_TOPIC_CACHE_FILE_MAX_LENGTH_BYTES + 1);
+    const uMqttClientSnTopicCacheEntry_t *pEntry = pCache->pHead;
+    size_t length = 0;
+    int32_t x;
+
+    if (pBuffer != NULL) {
+        while (pEntry != NULL) {
+            x = snprintf(pBuffer + length,
+                         U_MQTT_CLIENT_SN_TOPIC_CACHE_FILE_MAX_LENGTH_BYTES + 1 - length,
+                         "%u %s\n", (unsigned int) pEntry->id,
+                         (const char *) (pEntry + 1));
+            if ((x > 0) && (length + x <= U_MQTT_CLIENT_SN_TOPIC_CACHE_FILE_MAX_LENGTH_BYTES)) {
+                length += x;
+            } else {
+                *(pBuffer + length) = 0;
+            }
+            pEntry = pEntry->pNext;
+        }
+        uCellFileWrite(devHandle, pFileName, pBuffer, length);
+        uPortFree(pBuffer);
+    }
+}
+
+// Free the MQTT-SN topic cache.
+static void snTopicCacheFree(uMqttClientSnTopicCache_t *pCache)
+{
+    uMqttClientSnTopicCacheEntry_t *pEntry;
+
+    if (pCache != NULL) {
+        while (pCache->pHead != NULL) {
+            pEntry = pCache->pHead->pNext;
+            uPortFree(pCache->pHead);
+            pCache->pHead = pEntry;
+        }
+        uPortFree(pCache);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS THAT ARE PRIVATE TO UBXLIB
+ * -------------------------------------------------------------- */
+
+// Return the backoff delay of a managed session: it doubles with
+// each attempt up to the maximum and is then jittered to between
+// half and all of that.
+int32_t uMqttClientPrivateSessionBackoffMs(int32_t backoffMinMs,
+                                           int32_t backoffMaxMs,
+                                           int32_t attempt,
+                                           uint32_t *pRandomState)
+{
+    int32_t delayMs = backoffMinMs;
+
+    for (int32_t x = 0; (x < attempt) && (delayMs < backoffMaxMs); x++) {
+        if (delayMs > backoffMaxMs / 2) {
+            delayMs = backoffMaxMs;
+        } else {
+            delayMs *= 2;
+        }
+    }
+    if (delayMs > 1) {
+        delayMs = (delayMs / 2) + (int32_t) (sessionRandom(pRandomState) %
+                                             (uint32_t) ((delayMs / 2) + 1));
+    }
+
+    return delayMs;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: MQTT AND MQTT-SN
  * -------------------------------------------------------------- */
@@ -235,8 +1104,19 @@ int32_t uMqttClientOpenResetLastError()
 // Close an MQTT client.
 void uMqttClientClose(uMqttClientContext_t *pContext)
 {
+    uMqttClientPrefetch_t *pPrefetch;
+    uMqttClientSession_t *pSession;
+
     if (pContext != NULL) {
 
+        U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+        pSession = pSessionDetach(pContext);
+        pPrefetch = pPrefetchDetach(pContext);
+        U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+        sessionFree(pSession);
+        prefetchFree(pPrefetch);
+
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
 
         if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
@@ -250,6 +1130,8 @@ void uMqttClientClose(uMqttClientContext_t *pContext)
             uSecurityTlsRemove(pContext->pSecurityContext);
         }
 
+        snTopicCacheFree((uMqttClientSnTopicCache_t *) pContext->pSnTopicCache);
+
         U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
 
         uPortMutexDelete((uPortMutexHandle_t) (pContext->mutexHandle));
@@ -278,6 +1160,15 @@ int32_t uMqttClientConnect(uMqttClientContext_t *pContext,
             // pContext->pPriv so that it is carred around with the
             // context and can be updated.
             pContext->pPriv = (void *) pConnection->pWill;
+            if ((errorCode == 0) && pConnection->mqttSn) {
+                // Topic IDs from earlier connections only remain
+                // valid if the broker has kept the session
+                uMqttClientSnTopicCache_t *pCache = pSnTopicCacheGet(pContext);
+                if (pCache != NULL) {
+                    pCache->connectCount++;
+                    pCache->retain = pConnection->retain;
+                }
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
 
             errorCode = uWifiMqttConnect(pContext, pConnection);
@@ -333,7 +1224,7 @@ bool uMqttClientIsConnected(const uMqttClientContext_t *pContext)
 }
 
 // Set a callback to be called on new message arrival.
-int32_t uMqttClientSetMessageCallback(const uMqttClientContext_t *pContext,
+int32_t uMqttClientSetMessageCallback(uMqttClientContext_t *pContext,
                                       void (*pCallback) (int32_t, void *),
                                       void *pCallbackParam)
 {
@@ -345,9 +1236,18 @@ int32_t uMqttClientSetMessageCallback(const uMqttClientContext_t *pContext,
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
 
         if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
-            errorCode = uCellMqttSetMessageCallback(pContext->devHandle,
-                                                    pCallback,
-                                                    pCallbackParam);
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (pContext->pPrefetch == NULL) {
+                // With prefetch on, the prefetch task calls the callback
+                errorCode = uCellMqttSetMessageCallback(pContext->devHandle,
+                                                        pCallback,
+                                                        pCallbackParam);
+            }
+            if (errorCode == 0) {
+                // Remembered for prefetch
+                pContext->pMessageCallback = pCallback;
+                pContext->pMessageCallbackParam = pCallbackParam;
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
             errorCode = uWifiMqttSetMessageCallback(pContext,
                                                     pCallback,
@@ -372,6 +1272,10 @@ int32_t uMqttClientGetUnread(const uMqttClientContext_t *pContext)
 
         if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
             errorCodeOrUnread = uCellMqttGetUnread(pContext->devHandle);
+            if ((errorCodeOrUnread >= 0) && (pContext->pPrefetch != NULL)) {
+                errorCodeOrUnread += (int32_t) ((uMqttClientPrefetch_t *)
+                                                pContext->pPrefetch)->numMessages;
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
             errorCodeOrUnread = uWifiMqttGetUnread(pContext);
         }
@@ -427,7 +1331,7 @@ int32_t uMqttClientGetTotalMessagesReceived(const uMqttClientContext_t *pContext
 }
 
 // Set a callback for when the MQTT connection is dropped.
-int32_t uMqttClientSetDisconnectCallback(const uMqttClientContext_t *pContext,
+int32_t uMqttClientSetDisconnectCallback(uMqttClientContext_t *pContext,
                                          void (*pCallback) (int32_t, void *),
                                          void *pCallbackParam)
 {
@@ -439,9 +1343,19 @@ int32_t uMqttClientSetDisconnectCallback(const uMqttClientContext_t *pContext,
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
 
         if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
-            errorCode = uCellMqttSetDisconnectCallback(pContext->devHandle,
-                                                       pCallback,
-                                                       pCallbackParam);
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (pContext->pSession == NULL) {
+                // With a managed session, the session's callback
+                // calls the application's
+                errorCode = uCellMqttSetDisconnectCallback(pContext->devHandle,
+                                                           pCallback,
+                                                           pCallbackParam);
+            }
+            if (errorCode == 0) {
+                // Remembered for a managed session
+                pContext->pDisconnectCallback = pCallback;
+                pContext->pDisconnectCallbackParam = pCallbackParam;
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
             errorCode = uWifiMqttSetDisconnectCallback(pContext,
                                                        pCallback,
@@ -466,6 +1380,9 @@ int32_t uMqttClientPublish(uMqttClientContext_t *pContext,
                            uMqttQos_t qos, bool retain)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uMqttClientSession_t *pSession;
+    bool holdable;
+    bool connected;
 
     if ((pContext != NULL) && (pTopicNameStr != NULL) &&
         // If retain is true an empty message sent to the broker means
@@ -476,10 +1393,38 @@ int32_t uMqttClientPublish(uMqttClientContext_t *pContext,
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
 
         if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
-            errorCode = uCellMqttPublish(pContext->devHandle,
-                                         pTopicNameStr,
-                                         pMessage, messageSizeBytes,
-                                         (uCellMqttQos_t) qos, retain);
+            pSession = (uMqttClientSession_t *) pContext->pSession;
+            holdable = (pSession != NULL) && (pSession->cfg.outboxMaxNumMessages > 0) &&
+                       ((qos == U_MQTT_QOS_AT_LEAST_ONCE) || (qos == U_MQTT_QOS_EXACTLY_ONCE));
+            connected = uCellMqttIsConnected(pContext->devHandle);
+            if (holdable && (!connected || (pSession->pOutboxHead != NULL))) {
+                // No point in waiting for the module to fail and,
+                // if messages are already held, this one must not
+                // overtake them
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                if (sessionHold(pSession, pTopicNameStr, pMessage,
+                                messageSizeBytes, qos, retain)) {
+                    errorCode = (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE;
+                }
+            } else {
+                errorCode = uCellMqttPublish(pContext->devHandle,
+                                             pTopicNameStr,
+                                             pMessage, messageSizeBytes,
+                                             (uCellMqttQos_t) qos, retain);
+                if ((errorCode != 0) && holdable &&
+                    sessionHold(pSession, pTopicNameStr, pMessage,
+                                messageSizeBytes, qos, retain)) {
+                    errorCode = (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE;
+                }
+                // Want to know if we're still connected for below
+                connected = uCellMqttIsConnected(pContext->devHandle);
+            }
+            if ((errorCode == (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE) && connected) {
+                // Have the session task publish what is held;
+                // if not connected the disconnect callback will
+                // already have done this
+                sessionTrigger(pContext, pSession);
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
             errorCode = uWifiMqttPublish(pContext,
                                          pTopicNameStr,
@@ -512,6 +1457,10 @@ int32_t uMqttClientSubscribe(const uMqttClientContext_t *pContext,
             errorCode = uCellMqttSubscribe(pContext->devHandle,
                                            pTopicFilterStr,
                                            (uCellMqttQos_t) maxQos);
+            if ((errorCode >= 0) && (pContext->pSession != NULL)) {
+                sessionSubscription((uMqttClientSession_t *) pContext->pSession,
+                                    pTopicFilterStr, maxQos, true);
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
             errorCode = uWifiMqttSubscribe(pContext,
                                            pTopicFilterStr,
@@ -538,6 +1487,10 @@ int32_t uMqttClientUnsubscribe(const uMqttClientContext_t *pContext,
         if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
             errorCode = uCellMqttUnsubscribe(pContext->devHandle,
                                              pTopicFilterStr);
+            if ((errorCode == 0) && (pContext->pSession != NULL)) {
+                sessionSubscription((uMqttClientSession_t *) pContext->pSession,
+                                    pTopicFilterStr, U_MQTT_QOS_AT_MOST_ONCE, false);
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
             errorCode = uWifiMqttUnsubscribe(pContext, pTopicFilterStr);
         }
@@ -566,12 +1519,24 @@ int32_t uMqttClientMessageRead(uMqttClientContext_t *pContext,
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
 
         if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
-            errorCode = uCellMqttMessageRead(pContext->devHandle,
-                                             pTopicNameStr,
-                                             topicNameSizeBytes,
-                                             pMessage,
-                                             pMessageSizeBytes,
-                                             (uCellMqttQos_t *) pQos);
+            errorCode = (int32_t) U_ERROR_COMMON_EMPTY;
+            if (pContext->pPrefetch != NULL) {
+                errorCode = prefetchRead(pContext,
+                                         (uMqttClientPrefetch_t *) pContext->pPrefetch,
+                                         pTopicNameStr,
+                                         topicNameSizeBytes,
+                                         pMessage,
+                                         pMessageSizeBytes,
+                                         pQos);
+            }
+            if (errorCode == (int32_t) U_ERROR_COMMON_EMPTY) {
+                errorCode = uCellMqttMessageRead(pContext->devHandle,
+                                                 pTopicNameStr,
+                                                 topicNameSizeBytes,
+                                                 pMessage,
+                                                 pMessageSizeBytes,
+                                                 (uCellMqttQos_t *) pQos);
+            }
         } else if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_SHORT_RANGE)) {
             errorCode = uWifiMqttMessageRead(pContext,
                                              pTopicNameStr,
@@ -590,6 +1555,216 @@ int32_t uMqttClientMessageRead(uMqttClientContext_t *pContext,
     return errorCode;
 }
 
+// Switch prefetch on or off.
+int32_t uMqttClientSetPrefetch(uMqttClientContext_t *pContext,
+                               size_t maxNumMessages,
+                               size_t maxMessageSizeBytes,
+                               bool (*pFilter) (const char *, void *),
+                               void *pFilterParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uMqttClientPrefetch_t *pPrefetch = NULL;
+    uMqttClientPrefetch_t *pPrefetchOld = NULL;
+
+    if (pContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+        if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (maxNumMessages > 0) {
+                // Set up the new state before taking the lock
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                pPrefetch = (uMqttClientPrefetch_t *) pUPortMalloc(sizeof(*pPrefetch) +
+                                                                   maxMessageSizeBytes);
+                if (pPrefetch != NULL) {
+                    memset(pPrefetch, 0, sizeof(*pPrefetch));
+                    pPrefetch->maxNumMessages = maxNumMessages;
+                    pPrefetch->maxMessageSizeBytes = maxMessageSizeBytes;
+                    pPrefetch->pMessage = (char *) (pPrefetch + 1);
+                    pPrefetch->pFilter = pFilter;
+                    pPrefetch->pFilterParam = pFilterParam;
+                    pPrefetch->eventQueueHandle = -1;
+                    errorCode = uPortMutexCreate(&(pPrefetch->mutex));
+                    if (errorCode == 0) {
+                        // Length 2: one event pending while one is handled
+                        pPrefetch->eventQueueHandle = uPortEventQueueOpen(prefetchEventHandler,
+                                                                          "mqttPrefetch",
+                                                                          sizeof(pContext),
+                                                                          U_MQTT_CLIENT_PREFETCH_TASK_STACK_SIZE_BYTES,
+                                                                          U_MQTT_CLIENT_PREFETCH_TASK_PRIORITY,
+                                                                          2);
+                        errorCode = pPrefetch->eventQueueHandle;
+                        if (errorCode >= 0) {
+                            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                        } else {
+                            uPortMutexDelete(pPrefetch->mutex);
+                        }
+                    }
+                    if (errorCode != 0) {
+                        uPortFree(pPrefetch);
+                        pPrefetch = NULL;
+                    }
+                }
+            }
+
+            if (errorCode == 0) {
+
+                U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+                if ((pContext->pPrefetch != NULL) &&
+                    (((uMqttClientPrefetch_t *) pContext->pPrefetch)->numMessages > 0)) {
+                    errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                } else {
+                    pPrefetchOld = pPrefetchDetach(pContext);
+                    if (pPrefetch != NULL) {
+                        errorCode = uCellMqttSetMessageCallback(pContext->devHandle,
+                                                                prefetchMessageCallback,
+                                                                pContext);
+                        if (errorCode == 0) {
+                            pContext->pPrefetch = pPrefetch;
+                            pPrefetch = NULL;
+                            if (uCellMqttGetUnread(pContext->devHandle) > 0) {
+                                // Pick up anything already waiting
+                                prefetchTrigger(pContext,
+                                                (uMqttClientPrefetch_t *) pContext->pPrefetch);
+                            }
+                        }
+                    }
+                }
+
+                U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+            }
+
+            // Whatever was not used
+            prefetchFree(pPrefetchOld);
+            prefetchFree(pPrefetch);
+        }
+    }
+
+    return errorCode;
+}
+
+// Put an MQTT connection into managed-session mode.
+int32_t uMqttClientSessionStart(uMqttClientContext_t *pContext,
+                                const uMqttClientConnection_t *pConnection,
+                                const uMqttClientSessionCfg_t *pCfg)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uMqttClientSessionCfg_t cfg = U_MQTT_CLIENT_SESSION_CFG_DEFAULT;
+    uMqttClientSession_t *pSession = NULL;
+    uint32_t seed = 2166136261U; // FNV-1a
+    const char *pStr;
+
+    if (pCfg != NULL) {
+        cfg = *pCfg;
+    }
+    if ((pContext != NULL) && (pConnection != NULL) && !pConnection->mqttSn &&
+        (cfg.backoffMinMs > 0) && (cfg.backoffMaxMs >= cfg.backoffMinMs)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+        if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
+            // Set up the new state before taking the lock
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            pSession = (uMqttClientSession_t *) pUPortMalloc(sizeof(*pSession));
+            if (pSession != NULL) {
+                memset(pSession, 0, sizeof(*pSession));
+                pSession->connection = *pConnection;
+                pSession->cfg = cfg;
+                pSession->eventQueueHandle = -1;
+                // Seed the jitter so that the devices of a fleet
+                // do not all back off by the same amount
+                pStr = pConnection->pClientIdStr;
+                while ((pStr != NULL) && (*pStr != 0)) {
+                    seed ^= (uint8_t) *pStr;
+                    seed *= 16777619U;
+                    pStr++;
+                }
+                pSession->randomState = seed ^ (uint32_t) uPortGetTickTimeMs();
+                errorCode = uPortMutexCreate(&(pSession->mutex));
+                if (errorCode == 0) {
+                    // Length 2: one event pending while one is handled
+                    pSession->eventQueueHandle = uPortEventQueueOpen(sessionEventHandler,
+                                                                     "mqttSession",
+                                                                     sizeof(pContext),
+                                                                     U_MQTT_CLIENT_SESSION_TASK_STACK_SIZE_BYTES,
+                                                                     U_MQTT_CLIENT_SESSION_TASK_PRIORITY,
+                                                                     2);
+                    errorCode = pSession->eventQueueHandle;
+                    if (errorCode >= 0) {
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    }
+                }
+            }
+
+            if (errorCode == 0) {
+
+                U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+                if (pContext->pSession != NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                } else {
+                    if (!uCellMqttIsConnected(pContext->devHandle)) {
+                        // Connect with retention on, unless the module
+                        // cannot do that
+                        pSession->connection.retain = true;
+                        errorCode = cellConnect(pContext->devHandle,
+                                                &(pSession->connection),
+                                                pContext->pSecurityContext, false);
+                        if (errorCode == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+                            pSession->connection.retain = false;
+                            errorCode = cellConnect(pContext->devHandle,
+                                                    &(pSession->connection),
+                                                    pContext->pSecurityContext, false);
+                        }
+                        // As for uMqttClientConnect()
+                        pContext->pPriv = (void *) pConnection->pWill;
+                    }
+                    if (errorCode == 0) {
+                        pSession->persistent = uCellMqttIsRetained(pContext->devHandle);
+                        pSession->connection.retain = pSession->persistent;
+                        errorCode = uCellMqttSetDisconnectCallback(pContext->devHandle,
+                                                                   sessionDisconnectCallback,
+                                                                   pContext);
+                        if (errorCode == 0) {
+                            pContext->pSession = pSession;
+                            pSession = NULL;
+                        }
+                    }
+                }
+
+                U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+            }
+
+            // Whatever was not used
+            sessionFree(pSession);
+        }
+    }
+
+    return errorCode;
+}
+
+// End managed-session mode.
+int32_t uMqttClientSessionStop(uMqttClientContext_t *pContext)
+{
+    int32_t errorCodeOrNumMessages = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uMqttClientSession_t *pSession;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+        errorCodeOrNumMessages = 0;
+        pSession = pSessionDetach(pContext);
+        if (pSession != NULL) {
+            errorCodeOrNumMessages = (int32_t) pSession->outboxNumMessages;
+        }
+
+        U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+        sessionFree(pSession);
+    }
+
+    return errorCodeOrNumMessages;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: MQTT-SN ONLY
  * -------------------------------------------------------------- */
@@ -747,6 +1922,107 @@ int32_t uMqttClientSnRegisterNormalTopic(const uMqttClientContext_t *pContext,
     return errorCode;
 }
 
+// Get MQTT-SN topic names for a list of normal MQTT topics.
+int32_t uMqttClientSnRegisterNormalTopicList(uMqttClientContext_t *pContext,
+                                             uMqttClientSnTopic_t *pTopics,
+                                             size_t numTopics,
+                                             const char *pCacheFileName)
+{
+    int32_t errorCodeOrNum = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uMqttClientSnTopicCache_t *pCache;
+    uMqttClientSnTopicCacheEntry_t *pEntry;
+    const char **ppTopicNameStr = NULL;
+    uCellMqttSnTopicName_t *pTopicNames = NULL;
+    size_t *pIndex = NULL;
+    size_t numToRegister = 0;
+    size_t numDone = 0;
+    bool changed = false;
+    uMqttClientSnTopic_t *pTopic;
+
+    if ((pContext != NULL) && ((pTopics != NULL) || (numTopics == 0))) {
+        errorCodeOrNum = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+
+        U_PORT_MUTEX_LOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+
+        if (U_DEVICE_IS_TYPE(pContext->devHandle, U_DEVICE_TYPE_CELL)) {
+            errorCodeOrNum = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            pCache = pSnTopicCacheGet(pContext);
+            if (numTopics > 0) {
+                ppTopicNameStr = (const char **) pUPortMalloc(numTopics * sizeof(*ppTopicNameStr));
+                pTopicNames = (uCellMqttSnTopicName_t *) pUPortMalloc(numTopics * sizeof(*pTopicNames));
+                pIndex = (size_t *) pUPortMalloc(numTopics * sizeof(*pIndex));
+            }
+            if ((pCache != NULL) &&
+                ((numTopics == 0) ||
+                 ((ppTopicNameStr != NULL) && (pTopicNames != NULL) && (pIndex != NULL)))) {
+                if ((pCacheFileName != NULL) && !pCache->loaded) {
+                    snTopicCacheLoad(pContext->devHandle, pCache, pCacheFileName);
+                    pCache->loaded = true;
+                }
+                // Use what can be used from the cache, collect the rest
+                for (size_t x = 0; x < numTopics; x++) {
+                    pTopic = &(pTopics[x]);
+                    pTopic->topicName.type = U_MQTT_SN_TOPIC_NAME_TYPE_MAX_NUM;
+                    pEntry = NULL;
+                    if (pTopic->pTopicNameStr != NULL) {
+                        pEntry = pSnTopicCacheFind(pCache, pTopic->pTopicNameStr);
+                    }
+                    if ((pEntry != NULL) &&
+                        (pCache->retain || (pEntry->connectCount == pCache->connectCount))) {
+                        pTopic->topicName.name.id = pEntry->id;
+                        pTopic->topicName.type = U_MQTT_SN_TOPIC_NAME_TYPE_ID_NORMAL;
+                        numDone++;
+                    } else if (pTopic->pTopicNameStr != NULL) {
+                        ppTopicNameStr[numToRegister] = pTopic->pTopicNameStr;
+                        pIndex[numToRegister] = x;
+                        numToRegister++;
+                    }
+                }
+                if (numToRegister > 0) {
+                    // Pipeline the registrations
+                    uCellMqttSnRegisterNormalTopicList(pContext->devHandle,
+                                                       ppTopicNameStr, numToRegister,
+                                                       pTopicNames);
+                }
+                for (size_t x = 0; x < numToRegister; x++) {
+                    pTopic = &(pTopics[pIndex[x]]);
+                    if (pTopicNames[x].type != U_CELL_MQTT_SN_TOPIC_NAME_TYPE_ID_NORMAL) {
+                        // One at a time, with retries, for any that failed
+                        uCellMqttSnRegisterNormalTopic(pContext->devHandle,
+                                                       ppTopicNameStr[x],
+                                                       &(pTopicNames[x]));
+                    }
+                    if (pTopicNames[x].type == U_CELL_MQTT_SN_TOPIC_NAME_TYPE_ID_NORMAL) {
+                        pTopic->topicName.name.id = pTopicNames[x].name.id;
+                        pTopic->topicName.type = U_MQTT_SN_TOPIC_NAME_TYPE_ID_NORMAL;
+                        snTopicCacheSet(pCache, ppTopicNameStr[x], strlen(ppTopicNameStr[x]),
+                                        pTopicNames[x].name.id, pCache->connectCount);
+                        changed = true;
+                        numDone++;
+                    } else if ((pTopic->predefinedId >= 0) &&
+                               (pTopic->predefinedId <= UINT16_MAX)) {
+                        // Fall back to the predefined ID
+                        pTopic->topicName.name.id = (uint16_t) pTopic->predefinedId;
+                        pTopic->topicName.type = U_MQTT_SN_TOPIC_NAME_TYPE_ID_PREDEFINED;
+                        numDone++;
+                    }
+                }
+                if (changed && (pCacheFileName != NULL)) {
+                    snTopicCacheSave(pContext->devHandle, pCache, pCacheFileName);
+                }
+                errorCodeOrNum = (int32_t) numDone;
+            }
+            uPortFree(ppTopicNameStr);
+            uPortFree(pTopicNames);
+            uPortFree(pIndex);
+        }
+
+        U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) (pContext->mutexHandle));
+    }
+
+    return errorCodeOrNum;
+}
+
 // Publish a message.
 int32_t uMqttClientSnPublish(uMqttClientContext_t *pContext,
                              const uMqttSnTopicName_t *pTopicName,
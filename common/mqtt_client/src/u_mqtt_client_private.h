@@ -0,0 +1,63 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_MQTT_CLIENT_PRIVATE_H_
+#define _U_MQTT_CLIENT_PRIVATE_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** @file
+ * @brief This header file defines functions of the MQTT client API
+ * that are internal to ubxlib; they are made available this way
+ * so that they can be tested on their own.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Return the delay before the given attempt of a managed session
+ * to reconnect, or to try again to publish a held message: the
+ * delay starts at backoffMinMs, doubles with each attempt up to
+ * backoffMaxMs and is then drawn at random from between half and
+ * all of that.
+ *
+ * @param backoffMinMs       the delay for attempt zero.
+ * @param backoffMaxMs       the longest delay.
+ * @param attempt            the attempt, counting from zero.
+ * @param[in,out] pRandomState the state of the random sequence,
+ *                           which is advanced; cannot be NULL.
+ * @return                   the delay in milliseconds.
+ */
+int32_t uMqttClientPrivateSessionBackoffMs(int32_t backoffMinMs,
+                                           int32_t backoffMaxMs,
+                                           int32_t attempt,
+                                           uint32_t *pRandomState);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_MQTT_CLIENT_PRIVATE_H_
+
+// End of file
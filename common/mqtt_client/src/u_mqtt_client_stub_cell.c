@@ -92,6 +92,12 @@ U_WEAK int32_t uCellMqttSetRetainOn(uDeviceHandle_t cellHandle)
     return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
 }
 
+U_WEAK bool uCellMqttIsRetained(uDeviceHandle_t cellHandle)
+{
+    (void) cellHandle;
+    return false;
+}
+
 U_WEAK int32_t uCellMqttSetSecurityOn(uDeviceHandle_t cellHandle,
                                       int32_t securityProfileId)
 {
@@ -235,6 +241,18 @@ U_WEAK int32_t uCellMqttSnRegisterNormalTopic(uDeviceHandle_t cellHandle,
     return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
 }
 
+U_WEAK int32_t uCellMqttSnRegisterNormalTopicList(uDeviceHandle_t cellHandle,
+                                                  const char *const *ppTopicNameStr,
+                                                  size_t numTopics,
+                                                  uCellMqttSnTopicName_t *pTopicNames)
+{
+    (void) cellHandle;
+    (void) ppTopicNameStr;
+    (void) numTopics;
+    (void) pTopicNames;
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
 U_WEAK int32_t uCellMqttSnPublish(uDeviceHandle_t cellHandle,
                                   const uCellMqttSnTopicName_t *pTopicName,
                                   const char *pMessage,
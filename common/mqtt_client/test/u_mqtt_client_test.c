@@ -70,6 +70,7 @@
 #include "u_security.h"     // For uSecurityGetSerialNumber()
 
 #include "u_mqtt_client.h"
+#include "u_mqtt_client_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -521,6 +522,81 @@ U_PORT_TEST_FUNCTION("[mqttClient]", "mqttClient")
                     U_TEST_PRINT_LINE_MQTT("attempting to read a message when there are none returned %d.", y);
                     U_PORT_TEST_ASSERT(y == (int32_t) U_ERROR_COMMON_EMPTY);
 
+                    if (pTmp->networkType == U_NETWORK_TYPE_CELL) {
+                        // Do it all again with prefetch on, so that the
+                        // message is read from RAM
+                        U_TEST_PRINT_LINE_MQTT("switching prefetch on...");
+                        U_PORT_TEST_ASSERT(uMqttClientSetPrefetch(gpMqttContextA, 2,
+                                                                  U_MQTT_CLIENT_TEST_PUBLISH_MAX_LENGTH_BYTES,
+                                                                  NULL, NULL) == 0);
+                        gNumUnread = 0;
+                        gStopTimeMs = uPortGetTickTimeMs() +
+                                      (U_MQTT_CLIENT_RESPONSE_WAIT_SECONDS * 1000);
+                        U_PORT_TEST_ASSERT(uMqttClientPublish(gpMqttContextA, pTopicOut, pMessageOut,
+                                                              U_MQTT_CLIENT_TEST_PUBLISH_MAX_LENGTH_BYTES,
+                                                              U_MQTT_QOS_EXACTLY_ONCE, false) == 0);
+                        startTimeMs = uPortGetTickTimeMs();
+                        while ((gNumUnread == 0) &&
+                               (uPortGetTickTimeMs() < startTimeMs +
+                                (U_MQTT_CLIENT_RESPONSE_WAIT_SECONDS * 1000))) {
+                            uPortTaskBlock(1000);
+                        }
+                        U_TEST_PRINT_LINE_MQTT("%d message(s) prefetched.", gNumUnread);
+                        U_PORT_TEST_ASSERT(gNumUnread == 1);
+                        U_PORT_TEST_ASSERT(uMqttClientGetUnread(gpMqttContextA) == 1);
+                        // Can't switch prefetch off with a message in RAM
+                        U_PORT_TEST_ASSERT(uMqttClientSetPrefetch(gpMqttContextA, 0, 0,
+                                                                  NULL, NULL) ==
+                                           (int32_t) U_ERROR_COMMON_BUSY);
+                        s = U_MQTT_CLIENT_TEST_PUBLISH_MAX_LENGTH_BYTES;
+                        U_PORT_TEST_ASSERT(uMqttClientMessageRead(gpMqttContextA,
+                                                                  pTopicIn,
+                                                                  U_MQTT_CLIENT_TEST_READ_TOPIC_MAX_LENGTH_BYTES,
+                                                                  pMessageIn, &s,
+                                                                  &qos) == 0);
+                        U_PORT_TEST_ASSERT(qos == U_MQTT_QOS_EXACTLY_ONCE);
+                        U_PORT_TEST_ASSERT(strcmp(pTopicIn, pTopicOut) == 0);
+                        U_PORT_TEST_ASSERT(s == U_MQTT_CLIENT_TEST_PUBLISH_MAX_LENGTH_BYTES);
+                        U_PORT_TEST_ASSERT(memcmp(pMessageIn, pMessageOut, s) == 0);
+                        U_PORT_TEST_ASSERT(uMqttClientGetUnread(gpMqttContextA) == 0);
+                        U_PORT_TEST_ASSERT(uMqttClientSetPrefetch(gpMqttContextA, 0, 0,
+                                                                  NULL, NULL) == 0);
+
+                        // Adopt the connection as a managed session and
+                        // check that it still works as normal
+                        U_TEST_PRINT_LINE_MQTT("starting a managed session...");
+                        U_PORT_TEST_ASSERT(uMqttClientSessionStart(gpMqttContextA, NULL,
+                                                                   NULL) < 0);
+                        U_PORT_TEST_ASSERT(uMqttClientSessionStart(gpMqttContextA,
+                                                                   &connection, NULL) == 0);
+                        U_PORT_TEST_ASSERT(uMqttClientSessionStart(gpMqttContextA,
+                                                                   &connection, NULL) ==
+                                           (int32_t) U_ERROR_COMMON_BUSY);
+                        U_PORT_TEST_ASSERT(uMqttClientIsConnected(gpMqttContextA));
+                        gStopTimeMs = uPortGetTickTimeMs() +
+                                      (U_MQTT_CLIENT_RESPONSE_WAIT_SECONDS * 1000);
+                        U_PORT_TEST_ASSERT(uMqttClientPublish(gpMqttContextA, pTopicOut, pMessageOut,
+                                                              U_MQTT_CLIENT_TEST_PUBLISH_MAX_LENGTH_BYTES,
+                                                              U_MQTT_QOS_AT_LEAST_ONCE, false) == 0);
+                        // Nothing should have been held
+                        U_PORT_TEST_ASSERT(uMqttClientSessionStop(gpMqttContextA) == 0);
+                        U_PORT_TEST_ASSERT(uMqttClientSessionStop(gpMqttContextA) == 0);
+                        // Throw away the message that came back
+                        startTimeMs = uPortGetTickTimeMs();
+                        while ((uMqttClientGetUnread(gpMqttContextA) == 0) &&
+                               (uPortGetTickTimeMs() < startTimeMs +
+                                (U_MQTT_CLIENT_RESPONSE_WAIT_SECONDS * 1000))) {
+                            uPortTaskBlock(1000);
+                        }
+                        s = U_MQTT_CLIENT_TEST_PUBLISH_MAX_LENGTH_BYTES;
+                        U_PORT_TEST_ASSERT(uMqttClientMessageRead(gpMqttContextA,
+                                                                  pTopicIn,
+                                                                  U_MQTT_CLIENT_TEST_READ_TOPIC_MAX_LENGTH_BYTES,
+                                                                  pMessageIn, &s,
+                                                                  &qos) == 0);
+                        U_PORT_TEST_ASSERT(strcmp(pTopicIn, pTopicOut) == 0);
+                    }
+
                     // Check that we can send an empty message with the retain flag set to true,
                     // which can be used to remove the single-allowed retained message from a topic.
                     U_TEST_PRINT_LINE_MQTT("attempting to send a NULL message with retain set.", y);
@@ -632,6 +708,8 @@ U_PORT_TEST_FUNCTION("[mqttClient]", "mqttClientSn")
     char *pMessageIn;
     uMqttQos_t qos;
     char topicNameShortStr[U_MQTT_CLIENT_SN_TOPIC_NAME_SHORT_LENGTH_BYTES];
+    char topicNameListStr[64];
+    uMqttClientSnTopic_t topics[3];
 
     // In case a previous test failed
     uNetworkTestCleanUp();
@@ -860,6 +938,45 @@ U_PORT_TEST_FUNCTION("[mqttClient]", "mqttClientSn")
                     }
                 }
 
+                // Register a list of topics in one go: the topic registered
+                // above, another one and one with no name but a predefined ID
+                U_TEST_PRINT_LINE_MQTTSN("registering a list of MQTT topics...");
+                snprintf(topicNameListStr, sizeof(topicNameListStr), "%s/list", pTopicNameOutMqtt);
+                topics[0].pTopicNameStr = pTopicNameOutMqtt;
+                topics[0].predefinedId = -1;
+                topics[1].pTopicNameStr = topicNameListStr;
+                topics[1].predefinedId = -1;
+                topics[2].pTopicNameStr = NULL;
+                topics[2].predefinedId = 1;
+                U_PORT_TEST_ASSERT(uMqttClientSnRegisterNormalTopicList(NULL, topics, 2, NULL) < 0);
+                U_PORT_TEST_ASSERT(uMqttClientSnRegisterNormalTopicList(gpMqttContextA, NULL, 2,
+                                                                        NULL) < 0);
+                U_PORT_TEST_ASSERT(uMqttClientSnRegisterNormalTopicList(gpMqttContextA, topics, 0,
+                                                                        NULL) == 0);
+                startTimeMs = uPortGetTickTimeMs();
+                y = uMqttClientSnRegisterNormalTopicList(gpMqttContextA, topics, 3, NULL);
+                U_TEST_PRINT_LINE_MQTTSN("%d topic(s) of 3 registered in %d ms.", y,
+                                         (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+                U_PORT_TEST_ASSERT(y == 2);
+                for (size_t x = 0; x < 2; x++) {
+                    U_PORT_TEST_ASSERT(uMqttClientSnGetTopicNameType(&(topics[x].topicName)) ==
+                                       U_MQTT_SN_TOPIC_NAME_TYPE_ID_NORMAL);
+                    U_PORT_TEST_ASSERT(uMqttClientSnGetTopicId(&(topics[x].topicName)) >= 0);
+                }
+                U_PORT_TEST_ASSERT(uMqttClientSnGetTopicId(&(topics[0].topicName)) !=
+                                   uMqttClientSnGetTopicId(&(topics[1].topicName)));
+                // A topic without a name is not registered, even though
+                // there is a predefined ID to fall back on
+                U_PORT_TEST_ASSERT(topics[2].topicName.type == U_MQTT_SN_TOPIC_NAME_TYPE_MAX_NUM);
+                // Doing it again should come from the cache and give
+                // the same answer
+                topicNameOut = topics[1].topicName;
+                U_PORT_TEST_ASSERT(uMqttClientSnRegisterNormalTopicList(gpMqttContextA, topics, 2,
+                                                                        NULL) == 2);
+                U_PORT_TEST_ASSERT(uMqttClientSnGetTopicId(&(topics[1].topicName)) ==
+                                   uMqttClientSnGetTopicId(&topicNameOut));
+                topicNameOut = topics[0].topicName;
+
                 // Check that we can send an empty message with the retain flag set to true,
                 // which can be used to remove the single-allowed retained message from a topic.
                 U_TEST_PRINT_LINE_MQTTSN("attempting to send a NULL message with retain set.", y);
@@ -993,6 +1110,62 @@ U_PORT_TEST_FUNCTION("[mqttClient]", "mqttClientSn")
 
 #endif // #ifndef U_CFG_TEST_MQTT_CLIENT_SN_DISABLE_CONNECTIVITY_TEST
 
+/** Test the backoff of a managed session; no connection is required.
+ */
+U_PORT_TEST_FUNCTION("[mqttClient]", "mqttClientSessionBackoff")
+{
+    uint32_t randomState = 0;
+    uint32_t randomStateCopy;
+    int32_t nominalMs;
+    int32_t delayMs;
+    int32_t lastDelayMs = -1;
+    bool varied = false;
+
+    U_TEST_PRINT_LINE_MQTT("testing managed-session backoff.");
+
+    for (int32_t attempt = 0; attempt < 40; attempt++) {
+        // The nominal delay doubles from 1000 up to 60000
+        nominalMs = 1000;
+        for (int32_t x = 0; (x < attempt) && (nominalMs < 60000); x++) {
+            nominalMs *= 2;
+        }
+        if (nominalMs > 60000) {
+            nominalMs = 60000;
+        }
+        randomStateCopy = randomState;
+        delayMs = uMqttClientPrivateSessionBackoffMs(1000, 60000, attempt, &randomState);
+        U_TEST_PRINT_LINE_MQTT("attempt %d: %d ms (nominal %d ms).", attempt,
+                               delayMs, nominalMs);
+        // Jittered to between half and all of the nominal value
+        U_PORT_TEST_ASSERT(delayMs >= nominalMs / 2);
+        U_PORT_TEST_ASSERT(delayMs <= nominalMs);
+        // The random sequence must have moved on
+        U_PORT_TEST_ASSERT(randomState != randomStateCopy);
+        if ((attempt > 10) && (lastDelayMs >= 0) && (delayMs != lastDelayMs)) {
+            varied = true;
+        }
+        lastDelayMs = delayMs;
+    }
+    // At the maximum there should still be jitter
+    U_PORT_TEST_ASSERT(varied);
+
+    // The same state gives the same delay, a different one need not
+    randomState = 42;
+    delayMs = uMqttClientPrivateSessionBackoffMs(1000, 60000, 3, &randomState);
+    randomState = 42;
+    U_PORT_TEST_ASSERT(uMqttClientPrivateSessionBackoffMs(1000, 60000, 3,
+                                                          &randomState) == delayMs);
+
+    // No overflow however many attempts there have been, even with
+    // the largest possible maximum
+    randomState = 0;
+    delayMs = uMqttClientPrivateSessionBackoffMs(1000, INT32_MAX, 1000, &randomState);
+    U_PORT_TEST_ASSERT(delayMs >= INT32_MAX / 2);
+
+    // A minimum of one millisecond cannot be jittered
+    U_PORT_TEST_ASSERT(uMqttClientPrivateSessionBackoffMs(1, 1, 5, &randomState) == 1);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -71,6 +71,20 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_NETWORK_UP_TASK_STACK_SIZE_BYTES
+/** The stack size of each of the tasks started by
+ * uNetworkInterfaceUpStart() to bring up a network interface.
+ */
+# define U_NETWORK_UP_TASK_STACK_SIZE_BYTES (1024 * 4)
+#endif
+
+#ifndef U_NETWORK_UP_TASK_PRIORITY
+/** The priority of each of the tasks started by
+ * uNetworkInterfaceUpStart() to bring up a network interface.
+ */
+# define U_NETWORK_UP_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -192,6 +206,19 @@ typedef struct {
     void *pCallbackParameter;
 } uNetworkStatusCallbackData_t;
 
+/** A network interface on a device, as passed to
+ * uNetworkInterfaceUpFirst().
+ */
+typedef struct {
+    uDeviceHandle_t devHandle; /**< the handle of the device carrying
+                                    the network. */
+    uNetworkType_t netType;    /**< the network interface on that
+                                    device. */
+    const void *pCfg;          /**< the configuration of the network
+                                    interface, exactly as it would be
+                                    passed to uNetworkInterfaceUp(). */
+} uNetworkInterface_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -235,6 +262,79 @@ typedef struct {
 int32_t uNetworkInterfaceUp(uDeviceHandle_t devHandle, uNetworkType_t netType,
                             const void *pCfg);
 
+/** Bring up the given network interface on a device without waiting:
+ * the interface is brought up by a task of its own and pCallback is
+ * called when that has succeeded or failed.  Since the device API is
+ * not locked while the interface is being brought up, the interfaces
+ * of different devices (e.g. a cellular module and a Wi-Fi module)
+ * may be brought up in parallel, the total time then being that of
+ * the slowest rather than the sum of them all; interfaces sharing a
+ * driver API (e.g. two cellular modules) share the mutex of that API
+ * and so are still brought up one after the other.  While the
+ * interface is being brought up the device is locked: calls to
+ * uNetworkInterfaceUp(), uNetworkInterfaceDown() and
+ * uNetworkSetStatusCallback() for the same device, and uDeviceClose()
+ * of it, wait until that is done; nonetheless the device should not
+ * be closed until pCallback has been called.
+ *
+ * @param devHandle              the handle of the device carrying the
+ *                               network.
+ * @param netType                which of the network interfaces to bring
+ *                               up.
+ * @param[in] pCfg               the configuration, exactly as for
+ *                               uNetworkInterfaceUp().
+ * @param[in] pCallback          the function to call when the interface
+ *                               has been brought up, or bringing it
+ *                               up has failed, with isUp set accordingly
+ *                               and pStatus NULL; may be NULL.  If the
+ *                               interface came up and is not GNSS,
+ *                               pCallback is also set as the status
+ *                               callback of the interface with
+ *                               uNetworkSetStatusCallback() before it
+ *                               is called, so that it goes on to be
+ *                               told of later status changes, with
+ *                               pStatus filled in as normal.
+ *                               pCallback is called from the task that
+ *                               brought the interface up, which exits
+ *                               when it returns; unlike a status
+ *                               callback, it may call any device or
+ *                               network API.
+ * @param[in] pCallbackParameter a pointer to be passed to pCallback
+ *                               as its last parameter; may be NULL.
+ * @return                       zero if the task that will bring up
+ *                               the interface was started, else a
+ *                               negative error code, in which case
+ *                               pCallback will not be called.
+ */
+int32_t uNetworkInterfaceUpStart(uDeviceHandle_t devHandle,
+                                 uNetworkType_t netType,
+                                 const void *pCfg,
+                                 uNetworkStatusCallback_t pCallback,
+                                 void *pCallbackParameter);
+
+/** Bring up several network interfaces at the same time, using
+ * uNetworkInterfaceUpStart(), and return as soon as the first of them
+ * is up; the device handle of that interface is then the one to pass
+ * to uSockCreate(), uMqttClientOpen() etc., so that traffic is routed
+ * over whichever interface connected first.  Any of the other
+ * interfaces that come up later are taken down again, in the
+ * background, by the task that brought them up.  How long each
+ * attempt may take is governed by its configuration, e.g. the
+ * timeoutSeconds field of #uNetworkCfgCell_t.
+ *
+ * @param[in] pInterfaces the interfaces to bring up, cannot be NULL;
+ *                        the array is not referred to once this
+ *                        function has returned but the configurations
+ *                        it points to are, as for uNetworkInterfaceUp().
+ * @param numInterfaces   the number of elements at pInterfaces.
+ * @return                on success the index into pInterfaces of the
+ *                        interface that came up first, else the
+ *                        negative error code of the last of the
+ *                        interfaces to fail.
+ */
+int32_t uNetworkInterfaceUpFirst(const uNetworkInterface_t *pInterfaces,
+                                 size_t numInterfaces);
+
 /** Take down the given network interface on a device, disconnecting
  * it from any peer entity.  After this function returns
  * uNetworkInterfaceUp() must be called once more to ensure that the
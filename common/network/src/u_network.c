@@ -33,6 +33,8 @@
 #include "stdbool.h"
 #include "string.h"    // memset()
 
+#include "u_cfg_os_platform_specific.h" // U_CFG_OS_APP_TASK_PRIORITY
+
 #include "u_error_common.h"
 
 #include "u_device_shared.h"
@@ -42,6 +44,8 @@
 #include "u_port_os.h"
 #include "u_port_heap.h"
 
+#include "u_sock.h"
+
 #include "u_location.h"
 #include "u_location_shared.h"
 
@@ -63,6 +67,34 @@
  * TYPES
  * -------------------------------------------------------------- */
 
+/** Shared between the uNetworkInterfaceUpStart() tasks launched by
+ * a uNetworkInterfaceUpFirst(), protected by the device API mutex
+ * and free'd by whichever of them is the last to let go of it.
+ */
+typedef struct {
+    size_t referenceCount;
+    size_t numInterfaces;
+    size_t numFailed;
+    int32_t winner; /**< index of the first interface up, -1 if none yet. */
+    int32_t errorCode; /**< the error code of the last failure. */
+    uPortSemaphoreHandle_t semaphore; /**< given when there is a winner
+                                           or everything has failed. */
+} uNetworkUpFirst_t;
+
+/** The parameters of a uNetworkInterfaceUpStart(), passed to upTask().
+ */
+typedef struct {
+    uDeviceHandle_t devHandle;
+    uNetworkType_t netType;
+    const void *pCfg;
+    uNetworkStatusCallback_t pCallback;
+    void *pCallbackParameter;
+    uNetworkUpFirst_t *pUpFirst; /**< NULL if not part of a
+                                      uNetworkInterfaceUpFirst(). */
+    size_t index; /**< the index into the uNetworkInterfaceUpFirst()
+                       interfaces. */
+} uNetworkUpStart_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -72,7 +104,8 @@
  * -------------------------------------------------------------- */
 
 // Bring a network up or down.
-// This must be called between uDeviceLock() and uDeviceUnlock().
+// This must be called between uDeviceInstanceLock() and
+// uDeviceInstanceUnlock() for the device.
 static int32_t networkInterfaceChangeState(uDeviceHandle_t devHandle,
                                            uNetworkType_t netType,
                                            const void *pNetworkCfg,
@@ -132,6 +165,205 @@ static int32_t networkInterfaceChangeState(uDeviceHandle_t devHandle,
     return errorCode;
 }
 
+// Let go of the shared uNetworkInterfaceUpFirst() data, freeing it
+// if this is the last reference.
+// This must be called between uDeviceLock() and uDeviceUnlock().
+static void upFirstRelease(uNetworkUpFirst_t *pUpFirst)
+{
+    if (pUpFirst->referenceCount > 0) {
+        pUpFirst->referenceCount--;
+    }
+    if (pUpFirst->referenceCount == 0) {
+        uPortSemaphoreDelete(pUpFirst->semaphore);
+        uPortFree(pUpFirst);
+    }
+}
+
+// Note the result of bringing up one of the interfaces of a
+// uNetworkInterfaceUpFirst(), returning true if the interface
+// came up but lost and so should be taken down again.
+// This must be called between uDeviceLock() and uDeviceUnlock().
+static bool upFirstResult(uNetworkUpFirst_t *pUpFirst, size_t index,
+                          int32_t errorCode)
+{
+    bool takeDown = false;
+
+    if (errorCode == 0) {
+        if (pUpFirst->winner < 0) {
+            pUpFirst->winner = (int32_t) index;
+            uPortSemaphoreGive(pUpFirst->semaphore);
+        } else {
+            takeDown = true;
+        }
+    } else {
+        pUpFirst->errorCode = errorCode;
+        pUpFirst->numFailed++;
+        if ((pUpFirst->winner < 0) &&
+            (pUpFirst->numFailed >= pUpFirst->numInterfaces)) {
+            uPortSemaphoreGive(pUpFirst->semaphore);
+        }
+    }
+
+    return takeDown;
+}
+
+// Find, or allocate, the network data for a network on a device
+// and store the configuration in it, returning the configuration
+// to use.
+// This must be called between uDeviceInstanceLock() and
+// uDeviceInstanceUnlock() for the device.
+static int32_t networkDataSet(uDeviceHandle_t devHandle,
+                              uNetworkType_t netType,
+                              const void *pCfg,
+                              const void **ppCfg)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uDeviceInstance_t *pInstance;
+    uDeviceNetworkData_t *pNetworkData;
+
+    if ((uDeviceGetInstance(devHandle, &pInstance) == 0) &&
+        (netType >= U_NETWORK_TYPE_NONE) &&
+        (netType < U_NETWORK_TYPE_MAX_NUM)) {
+        pNetworkData = pUNetworkGetNetworkData(pInstance, netType);
+        if (pNetworkData == NULL) {
+            // No network of this type has yet been brought up on
+            // this device
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            pNetworkData = pUNetworkGetNetworkData(pInstance, U_NETWORK_TYPE_NONE);
+        }
+        if (pNetworkData != NULL) {
+            pNetworkData->networkType = (int32_t) netType;
+            errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+            if (pCfg == NULL) {
+                // Use possible last set configuration
+                pCfg = pNetworkData->pCfg;
+            }
+            if (pCfg != NULL) {
+                pNetworkData->pCfg = pCfg;
+                *ppCfg = pCfg;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// The task that brings up a network interface for
+// uNetworkInterfaceUpStart(); it holds only the lock of the device
+// while doing so, which is what allows the interfaces of different
+// devices to be brought up in parallel: each driver API has its own
+// mutex to protect its instances.
+static void upTask(void *pParameter)
+{
+    uNetworkUpStart_t *pUpStart = (uNetworkUpStart_t *) pParameter;
+    bool takeDown = false;
+    uDeviceInstance_t *pInstance;
+    const void *pCfg = NULL;
+    int32_t errorCode = uDeviceInstanceLock(pUpStart->devHandle, &pInstance);
+
+    if (errorCode == 0) {
+        errorCode = networkDataSet(pUpStart->devHandle, pUpStart->netType,
+                                   pUpStart->pCfg, &pCfg);
+        if (errorCode == 0) {
+            errorCode = networkInterfaceChangeState(pUpStart->devHandle,
+                                                    pUpStart->netType,
+                                                    pCfg, true);
+        }
+        uDeviceInstanceUnlock(pInstance);
+    }
+
+    if (uDeviceLock() == 0) {
+        if (pUpStart->pUpFirst != NULL) {
+            takeDown = upFirstResult(pUpStart->pUpFirst, pUpStart->index, errorCode);
+            upFirstRelease(pUpStart->pUpFirst);
+        }
+        uDeviceUnlock();
+    }
+
+    if (takeDown) {
+        // Someone else got there first
+        uNetworkInterfaceDown(pUpStart->devHandle, pUpStart->netType);
+    } else if (pUpStart->pCallback != NULL) {
+        if ((errorCode == 0) && (pUpStart->netType != U_NETWORK_TYPE_GNSS)) {
+            uNetworkSetStatusCallback(pUpStart->devHandle, pUpStart->netType,
+                                      pUpStart->pCallback,
+                                      pUpStart->pCallbackParameter);
+        }
+        pUpStart->pCallback(pUpStart->devHandle, pUpStart->netType,
+                            (errorCode == 0), NULL,
+                            pUpStart->pCallbackParameter);
+    }
+
+    uPortFree(pUpStart);
+
+    // Delete ourselves
+    uPortTaskDelete(NULL);
+}
+
+// Start bringing up a network interface, optionally as part of
+// a uNetworkInterfaceUpFirst().
+static int32_t upStart(uDeviceHandle_t devHandle, uNetworkType_t netType,
+                       const void *pCfg, uNetworkStatusCallback_t pCallback,
+                       void *pCallbackParameter, uNetworkUpFirst_t *pUpFirst,
+                       size_t index)
+{
+    uNetworkUpStart_t *pUpStart;
+    uPortTaskHandle_t taskHandle;
+    uDeviceInstance_t *pInstance;
+    uDeviceNetworkData_t *pNetworkData;
+    // Lock the API: only for as long as it takes to start the
+    // task, which is what then locks the device
+    int32_t errorCode = uDeviceLock();
+
+    if (errorCode == 0) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((uDeviceGetInstance(devHandle, &pInstance) == 0) &&
+            (netType >= U_NETWORK_TYPE_NONE) &&
+            (netType < U_NETWORK_TYPE_MAX_NUM)) {
+            pNetworkData = pUNetworkGetNetworkData(pInstance, netType);
+            if ((pCfg != NULL) ||
+                ((pNetworkData != NULL) && (pNetworkData->pCfg != NULL))) {
+                // upTask() will store the configuration
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+        if (errorCode == 0) {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            // This is free'd by upTask()
+            pUpStart = (uNetworkUpStart_t *) pUPortMalloc(sizeof(*pUpStart));
+            if (pUpStart != NULL) {
+                memset(pUpStart, 0, sizeof(*pUpStart));
+                pUpStart->devHandle = devHandle;
+                pUpStart->netType = netType;
+                pUpStart->pCfg = pCfg;
+                pUpStart->pCallback = pCallback;
+                pUpStart->pCallbackParameter = pCallbackParameter;
+                pUpStart->pUpFirst = pUpFirst;
+                pUpStart->index = index;
+                if (pUpFirst != NULL) {
+                    pUpFirst->referenceCount++;
+                }
+                errorCode = uPortTaskCreate(upTask, "networkUp",
+                                            U_NETWORK_UP_TASK_STACK_SIZE_BYTES,
+                                            (void *) pUpStart,
+                                            U_NETWORK_UP_TASK_PRIORITY,
+                                            &taskHandle);
+                if (errorCode != 0) {
+                    if (pUpFirst != NULL) {
+                        pUpFirst->referenceCount--;
+                    }
+                    uPortFree(pUpStart);
+                }
+            }
+        }
+        // ...and done
+        uDeviceUnlock();
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -152,40 +384,93 @@ int32_t uNetworkInterfaceUp(uDeviceHandle_t devHandle,
     uNetworkPrivateGnssLink();
     uNetworkPrivateWifiLink();
 
-    // Lock the API
-    int32_t errorCode = uDeviceLock();
     uDeviceInstance_t *pInstance;
-    uDeviceNetworkData_t *pNetworkData;
+    // Lock the device, not the API, so that the interfaces of
+    // other devices may be brought up meanwhile
+    int32_t errorCode = uDeviceInstanceLock(devHandle, &pInstance);
 
     if (errorCode == 0) {
-        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((uDeviceGetInstance(devHandle, &pInstance) == 0) &&
-            (netType >= U_NETWORK_TYPE_NONE) &&
-            (netType < U_NETWORK_TYPE_MAX_NUM)) {
-            pNetworkData = pUNetworkGetNetworkData(pInstance, netType);
-            if (pNetworkData == NULL) {
-                // No network of this type has yet been brought up on
-                // this device
-                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-                pNetworkData = pUNetworkGetNetworkData(pInstance, U_NETWORK_TYPE_NONE);
-            }
-            if (pNetworkData != NULL) {
-                pNetworkData->networkType = (int32_t) netType;
-                errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-                if (pCfg == NULL) {
-                    // Use possible last set configuration
-                    pCfg = pNetworkData->pCfg;
+        errorCode = networkDataSet(devHandle, netType, pCfg, &pCfg);
+        if (errorCode == 0) {
+            errorCode = networkInterfaceChangeState(devHandle, netType,
+                                                    pCfg, true);
+        }
+        // ...and done
+        uDeviceInstanceUnlock(pInstance);
+    }
+
+    return errorCode;
+}
+
+int32_t uNetworkInterfaceUpStart(uDeviceHandle_t devHandle,
+                                 uNetworkType_t netType,
+                                 const void *pCfg,
+                                 uNetworkStatusCallback_t pCallback,
+                                 void *pCallbackParameter)
+{
+    // See uNetworkInterfaceUp() for why these are here
+    uNetworkPrivateBleLink();
+    uNetworkPrivateCellLink();
+    uNetworkPrivateGnssLink();
+    uNetworkPrivateWifiLink();
+
+    return upStart(devHandle, netType, pCfg, pCallback,
+                   pCallbackParameter, NULL, 0);
+}
+
+int32_t uNetworkInterfaceUpFirst(const uNetworkInterface_t *pInterfaces,
+                                 size_t numInterfaces)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uNetworkUpFirst_t *pUpFirst;
+    size_t numStarted = 0;
+
+    // See uNetworkInterfaceUp() for why these are here
+    uNetworkPrivateBleLink();
+    uNetworkPrivateCellLink();
+    uNetworkPrivateGnssLink();
+    uNetworkPrivateWifiLink();
+
+    if ((pInterfaces != NULL) && (numInterfaces > 0)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pUpFirst = (uNetworkUpFirst_t *) pUPortMalloc(sizeof(*pUpFirst));
+        if (pUpFirst != NULL) {
+            memset(pUpFirst, 0, sizeof(*pUpFirst));
+            pUpFirst->winner = -1;
+            // The reference held by this function
+            pUpFirst->referenceCount = 1;
+            errorCode = uPortSemaphoreCreate(&(pUpFirst->semaphore), 0, 1);
+            if (errorCode == 0) {
+                for (size_t x = 0; x < numInterfaces; x++) {
+                    errorCode = upStart(pInterfaces[x].devHandle,
+                                        pInterfaces[x].netType,
+                                        pInterfaces[x].pCfg,
+                                        NULL, NULL, pUpFirst, x);
+                    if (errorCode == 0) {
+                        numStarted++;
+                    } else if (uDeviceLock() == 0) {
+                        // Count this as a failure of the interface
+                        upFirstResult(pUpFirst, x, errorCode);
+                        uDeviceUnlock();
+                    }
+                }
+                if (numStarted > 0) {
+                    // Wait for a winner or for everything to fail
+                    uPortSemaphoreTake(pUpFirst->semaphore);
                 }
-                if (pCfg != NULL) {
-                    pNetworkData->pCfg = pCfg;
-                    errorCode = networkInterfaceChangeState(devHandle, netType,
-                                                            pNetworkData->pCfg,
-                                                            true);
+                errorCode = uDeviceLock();
+                if (errorCode == 0) {
+                    errorCode = pUpFirst->errorCode;
+                    if (pUpFirst->winner >= 0) {
+                        errorCode = pUpFirst->winner;
+                    }
+                    upFirstRelease(pUpFirst);
+                    uDeviceUnlock();
                 }
+            } else {
+                uPortFree(pUpFirst);
             }
         }
-        // ...and done
-        uDeviceUnlock();
     }
 
     return errorCode;
@@ -193,15 +478,14 @@ int32_t uNetworkInterfaceUp(uDeviceHandle_t devHandle,
 
 int32_t uNetworkInterfaceDown(uDeviceHandle_t devHandle, uNetworkType_t netType)
 {
-    // Lock the API
-    int32_t errorCode = uDeviceLock();
     uDeviceInstance_t *pInstance;
     uDeviceNetworkData_t *pNetworkData;
+    // Lock the device
+    int32_t errorCode = uDeviceInstanceLock(devHandle, &pInstance);
 
     if (errorCode == 0) {
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((uDeviceGetInstance(devHandle, &pInstance) == 0) &&
-            (netType >= U_NETWORK_TYPE_NONE) &&
+        if ((netType >= U_NETWORK_TYPE_NONE) &&
             (netType < U_NETWORK_TYPE_MAX_NUM)) {
             // If pNetworkData is NULL then this network has never
             // been brought up, hence success
@@ -211,12 +495,14 @@ int32_t uNetworkInterfaceDown(uDeviceHandle_t devHandle, uNetworkType_t netType)
                 errorCode = networkInterfaceChangeState(devHandle, netType,
                                                         pNetworkData->pCfg,
                                                         false);
+                // Any remembered DNS answers may no longer be right
+                uSockHostCacheFlush(devHandle);
                 uPortFree(pNetworkData->pStatusCallbackData);
                 pNetworkData->pStatusCallbackData = NULL;
             }
         }
         // ...and done
-        uDeviceUnlock();
+        uDeviceInstanceUnlock(pInstance);
     }
 
     return errorCode;
@@ -228,16 +514,15 @@ int32_t uNetworkSetStatusCallback(uDeviceHandle_t devHandle,
                                   uNetworkStatusCallback_t pCallback,
                                   void *pCallbackParameter)
 {
-    // Lock the API
-    int32_t errorCode = uDeviceLock();
     uDeviceInstance_t *pInstance;
     uDeviceNetworkData_t *pNetworkData;
     uNetworkStatusCallbackData_t *pStatusCallbackData;
+    // Lock the device
+    int32_t errorCode = uDeviceInstanceLock(devHandle, &pInstance);
 
     if (errorCode == 0) {
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((uDeviceGetInstance(devHandle, &pInstance) == 0) &&
-            (netType >= U_NETWORK_TYPE_NONE) &&
+        if ((netType >= U_NETWORK_TYPE_NONE) &&
             (netType < U_NETWORK_TYPE_MAX_NUM)) {
             // If pNetworkData is NULL then this network has not
             // been brought up
@@ -281,7 +566,7 @@ int32_t uNetworkSetStatusCallback(uDeviceHandle_t devHandle,
             }
         }
         // ...and done
-        uDeviceUnlock();
+        uDeviceInstanceUnlock(pInstance);
     }
 
     return errorCode;
@@ -110,6 +110,13 @@
  */
 #define U_TEST_PRINT_LINE_X(format, ...) uPortLog(U_TEST_PREFIX_X format "\n", ##__VA_ARGS__)
 
+#ifndef U_NETWORK_TEST_UP_START_TIMEOUT_SECONDS
+/** How long to wait for uNetworkInterfaceUpStart() to bring up
+ * a network.
+ */
+# define U_NETWORK_TEST_UP_START_TIMEOUT_SECONDS 240
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -215,6 +222,18 @@ static uNetworkCfgWifi_t gNetworkCfgWifiNetStatus = {
 static uNetworkStatusCallbackParameters_t gNetworkStatusCallbackParameters[U_NETWORK_TYPE_MAX_NUM];
 #endif
 
+/** The number of times upStartCallback() has been called at the
+ * end of a uNetworkInterfaceUpStart().
+ */
+static volatile int32_t gUpStartCallbackCount = 0;
+
+/** The parameters last passed to upStartCallback() at the end of
+ * a uNetworkInterfaceUpStart().
+ */
+static uDeviceHandle_t gUpStartDevHandle = NULL;
+static uNetworkType_t gUpStartNetType = U_NETWORK_TYPE_NONE;
+static bool gUpStartIsUp = false;
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -244,15 +263,33 @@ static void wrapPrint(const char *pBuffer, size_t bufLength,
     uPortLog("\n");
 }
 
-static void sendBleSps(uDeviceHandle_t devHandle)
+// If queued is true uBleSpsSendQueued() is used, where supported,
+// rather than uBleSpsSend().
+static void sendBleSps(uDeviceHandle_t devHandle, bool queued)
 {
     uint32_t tries = 0;
     int32_t testDataOffset = 0;
-    U_TEST_PRINT_LINE("sending data on channel %d...", gChannel);
+    int32_t bytesSentNow;
+    U_TEST_PRINT_LINE("sending data on channel %d%s...", gChannel, queued ? ", queued" : "");
+    if (queued) {
+        U_PORT_TEST_ASSERT(uBleSpsSendQueued(devHandle, gChannel, NULL, 1) < 0);
+        U_PORT_TEST_ASSERT(uBleSpsGetTxQueueLevel(devHandle, -1) < 0);
+    }
     while ((tries++ < 15) && (gBytesSent < gTotalBytes)) {
         // -1 to omit gTestData string terminator
-        int32_t bytesSentNow =
-            uBleSpsSend(devHandle, gChannel, gTestData + testDataOffset, sizeof gTestData - 1 - testDataOffset);
+        bytesSentNow = (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+        if (queued) {
+            bytesSentNow = uBleSpsSendQueued(devHandle, gChannel, gTestData + testDataOffset,
+                                             sizeof gTestData - 1 - testDataOffset);
+            if (bytesSentNow == (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED) {
+                U_TEST_PRINT_LINE("queued sending not supported.");
+                queued = false;
+            }
+        }
+        if (!queued) {
+            bytesSentNow = uBleSpsSend(devHandle, gChannel, gTestData + testDataOffset,
+                                       sizeof gTestData - 1 - testDataOffset);
+        }
 
         if (bytesSentNow >= 0) {
             gBytesSent += bytesSentNow;
@@ -265,12 +302,24 @@ static void sendBleSps(uDeviceHandle_t devHandle)
         }
         U_TEST_PRINT_LINE("%d byte(s) sent.", gBytesSent);
 
-        // Make room for context switch letting receive event process
-        uPortTaskBlock(U_CFG_OS_YIELD_MS);
+        if (queued) {
+            // Give the queue time to drain
+            uPortTaskBlock(100);
+        } else {
+            // Make room for context switch letting receive event process
+            uPortTaskBlock(U_CFG_OS_YIELD_MS);
+        }
     }
     if (gBytesSent < gTotalBytes) {
         U_TEST_PRINT_LINE("%d byte(s) were not sent.", gTotalBytes - gBytesSent);
     }
+    if (queued) {
+        for (tries = 0; (tries < 50) &&
+             (uBleSpsGetTxQueueLevel(devHandle, gChannel) > 0); tries++) {
+            uPortTaskBlock(100);
+        }
+        U_PORT_TEST_ASSERT(uBleSpsGetTxQueueLevel(devHandle, gChannel) == 0);
+    }
 }
 
 //lint -e{818} Suppress 'pData' could be declared as const:
@@ -394,6 +443,26 @@ static void networkStatusCallback(uDeviceHandle_t devHandle,
 }
 #endif
 
+// Callback for uNetworkInterfaceUpStart(), which then goes on to
+// be the network status callback.
+static void upStartCallback(uDeviceHandle_t devHandle,
+                            uNetworkType_t netType,
+                            bool isUp,
+                            uNetworkStatus_t *pStatus,
+                            void *pParameter)
+{
+    U_PORT_TEST_ASSERT(pParameter == (void *) &gUpStartCallbackCount);
+
+    if (pStatus == NULL) {
+        // The end of uNetworkInterfaceUpStart(), rather than a
+        // later status change
+        gUpStartDevHandle = devHandle;
+        gUpStartNetType = netType;
+        gUpStartIsUp = isUp;
+        gUpStartCallbackCount++;
+    }
+}
+
 // Open a socket and use it.
 static int32_t openSocketAndUseIt(uDeviceHandle_t devHandle, uNetworkType_t netType)
 {
@@ -555,6 +624,127 @@ U_PORT_TEST_FUNCTION("[network]", "networkSock")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test bringing up a network that supports sockets in the
+ * background with uNetworkInterfaceUpStart(), then all of them at
+ * the same time with uNetworkInterfaceUpFirst(), using whichever
+ * comes up first.
+ */
+U_PORT_TEST_FUNCTION("[network]", "networkUpFirst")
+{
+    uNetworkTestList_t *pList;
+    uNetworkInterface_t interfaces[U_NETWORK_TYPE_MAX_NUM * 2];
+    size_t numInterfaces = 0;
+    int32_t winner;
+    int32_t startTimeMs;
+    int32_t resourceCount;
+
+    // Make sure we start fresh for this test case
+    uNetworkTestCleanUp();
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uDeviceInit() == 0);
+
+    // Check parameters
+    U_PORT_TEST_ASSERT(uNetworkInterfaceUpFirst(NULL, 1) < 0);
+    U_PORT_TEST_ASSERT(uNetworkInterfaceUpFirst(interfaces, 0) < 0);
+    U_PORT_TEST_ASSERT(uNetworkInterfaceUpStart(NULL, U_NETWORK_TYPE_CELL, NULL,
+                                                upStartCallback,
+                                                (void *) &gUpStartCallbackCount) < 0);
+
+    // Get a list of things that support sockets and open them
+    pList = pUNetworkTestListAlloc(uNetworkTestHasSock);
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        if (*pTmp->pDevHandle == NULL) {
+            U_TEST_PRINT_LINE("adding device %s for network %s...",
+                              gpUNetworkTestDeviceTypeName[pTmp->pDeviceCfg->deviceType],
+                              gpUNetworkTestTypeName[pTmp->networkType]);
+            U_PORT_TEST_ASSERT(uDeviceOpen(pTmp->pDeviceCfg, pTmp->pDevHandle) == 0);
+        }
+        if (numInterfaces < sizeof(interfaces) / sizeof(interfaces[0])) {
+            interfaces[numInterfaces].devHandle = *pTmp->pDevHandle;
+            interfaces[numInterfaces].netType = pTmp->networkType;
+            interfaces[numInterfaces].pCfg = pTmp->pNetworkCfg;
+            numInterfaces++;
+        }
+    }
+
+    if (numInterfaces > 0) {
+        uSockDeinit();
+        // Bring up the first network in the background
+        U_TEST_PRINT_LINE("bringing up %s in the background...",
+                          gpUNetworkTestTypeName[interfaces[0].netType]);
+        gUpStartCallbackCount = 0;
+        startTimeMs = uPortGetTickTimeMs();
+        U_PORT_TEST_ASSERT(uNetworkInterfaceUpStart(interfaces[0].devHandle,
+                                                    interfaces[0].netType,
+                                                    interfaces[0].pCfg,
+                                                    upStartCallback,
+                                                    (void *) &gUpStartCallbackCount) == 0);
+        while ((gUpStartCallbackCount == 0) &&
+               (uPortGetTickTimeMs() - startTimeMs <
+                U_NETWORK_TEST_UP_START_TIMEOUT_SECONDS * 1000)) {
+            uPortTaskBlock(100);
+        }
+        U_TEST_PRINT_LINE("uNetworkInterfaceUpStart() callback called %d time(s) after"
+                          " %d second(s).", gUpStartCallbackCount,
+                          (int32_t) (uPortGetTickTimeMs() - startTimeMs) / 1000);
+        U_PORT_TEST_ASSERT(gUpStartCallbackCount == 1);
+        U_PORT_TEST_ASSERT(gUpStartDevHandle == interfaces[0].devHandle);
+        U_PORT_TEST_ASSERT(gUpStartNetType == interfaces[0].netType);
+        U_PORT_TEST_ASSERT(gUpStartIsUp);
+        U_PORT_TEST_ASSERT(openSocketAndUseIt(interfaces[0].devHandle,
+                                              interfaces[0].netType) == 0);
+        U_PORT_TEST_ASSERT(uNetworkInterfaceDown(interfaces[0].devHandle,
+                                                 interfaces[0].netType) == 0);
+        // Only status changes, not another end, after that
+        U_PORT_TEST_ASSERT(gUpStartCallbackCount == 1);
+
+        U_TEST_PRINT_LINE("bringing up %d network(s) at once...", numInterfaces);
+        winner = uNetworkInterfaceUpFirst(interfaces, numInterfaces);
+        U_TEST_PRINT_LINE("uNetworkInterfaceUpFirst() returned %d.", winner);
+        U_PORT_TEST_ASSERT((winner >= 0) && (winner < (int32_t) numInterfaces));
+        U_TEST_PRINT_LINE("%s came up first.",
+                          gpUNetworkTestTypeName[interfaces[winner].netType]);
+        U_PORT_TEST_ASSERT(openSocketAndUseIt(interfaces[winner].devHandle,
+                                              interfaces[winner].netType) == 0);
+        // Take everything down: this waits for any loser
+        // that is still trying to finish
+        for (size_t x = 0; x < numInterfaces; x++) {
+            U_PORT_TEST_ASSERT(uNetworkInterfaceDown(interfaces[x].devHandle,
+                                                     interfaces[x].netType) == 0);
+        }
+    }
+
+    // Close the devices once more and free the list
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        if (*pTmp->pDevHandle != NULL) {
+            U_TEST_PRINT_LINE("closing device %s...",
+                              gpUNetworkTestDeviceTypeName[pTmp->pDeviceCfg->deviceType]);
+            U_PORT_TEST_ASSERT(uDeviceClose(*pTmp->pDevHandle, false) == 0);
+            *pTmp->pDevHandle = NULL;
+        }
+    }
+    uNetworkTestListFree();
+
+    uSockDeinit();
+    uSockCleanUp();
+
+    uDeviceDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 #if defined(U_BLE_TEST_CFG_REMOTE_SPS_CENTRAL) || defined(U_BLE_TEST_CFG_REMOTE_SPS_PERIPHERAL)
 /** Test BLE network.
  */
@@ -565,6 +755,7 @@ U_PORT_TEST_FUNCTION("[network]", "networkBle")
     int32_t resourceCount;
     int32_t timeoutCount;
     uBleSpsHandles_t spsHandles;
+    uBleSpsFlowState_t flowState;
 
     // In case a previous test failed
     uNetworkTestCleanUp();
@@ -675,11 +866,18 @@ U_PORT_TEST_FUNCTION("[network]", "networkBle")
                 if (i == 0) {
                     uBleSpsGetSpsServerHandles(devHandle, gChannel, &spsHandles);
                 }
+                U_PORT_TEST_ASSERT(uBleSpsGetFlowState(devHandle, gChannel, &flowState) == 0);
+                U_TEST_PRINT_LINE("MTU %d, flow control %s, TX credits %d, RX credits %d.",
+                                  flowState.mtu, flowState.flowCtrlEnabled ? "on" : "off",
+                                  flowState.txCredits, flowState.rxCreditsOnRemote);
+                U_PORT_TEST_ASSERT(flowState.mtu > 0);
+                U_PORT_TEST_ASSERT(flowState.rxBufferedBytes >= 0);
 
                 uBleSpsSetSendTimeout(devHandle, gChannel, 100);
                 uPortTaskBlock(100);
                 timeoutCount = 0;
-                sendBleSps(devHandle);
+                // Use the second up/down run to test queued sending
+                sendBleSps(devHandle, (a > 0));
                 while (gBytesReceived < gBytesSent) {
                     uPortTaskBlock(100);
                     if (timeoutCount++ > 100) {
@@ -88,6 +88,13 @@ extern "C" {
  */
 #define U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES 16
 
+#ifndef U_SECURITY_CREDENTIAL_HASH_CHUNK_LENGTH_BYTES
+/** The size of the chunks, taken from the stack, in which
+ * uSecurityCredentialCalculateHash() reads a credential.
+ */
+# define U_SECURITY_CREDENTIAL_HASH_CHUNK_LENGTH_BYTES 64
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -124,6 +131,57 @@ typedef struct {
     int64_t expirationUtc;
 } uSecurityCredential_t;
 
+/** An item in a batch of credentials to be stored by
+ * uSecurityCredentialStoreBatch().
+ */
+typedef struct {
+    uSecurityCredentialType_t type; /**< the type of the credential. */
+    const char *pName;      /**< the null-terminated name of the credential,
+                                 maximum length
+                                 #U_SECURITY_CREDENTIAL_NAME_MAX_LENGTH_BYTES. */
+    const char *pContents;  /**< the credential to be stored. */
+    size_t size;            /**< the number of bytes at pContents. */
+    const char *pPassword;  /**< the null-terminated password of a PKCS8
+                                 encrypted private key; may be NULL. */
+    const char *pMd5;       /**< the #U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES
+                                 MD5 hash that the credential has when stored
+                                 in the module, as returned by
+                                 uSecurityCredentialStore(); if this is
+                                 given and a credential of the same type and
+                                 name with this hash is already stored in the
+                                 module then the item is skipped.  May be NULL,
+                                 in which case the item is always stored. */
+} uSecurityCredentialBatchItem_t;
+
+/** The outcome of storing an item with uSecurityCredentialStoreBatch().
+ */
+typedef struct {
+    int32_t errorCode; /**< zero on success, else negative error code. */
+    bool skipped;      /**< true if the item was already stored in the
+                            module with the expected hash and hence
+                            was not stored again. */
+    char md5[U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES]; /**< the MD5 hash
+                                                           of the credential
+                                                           as stored in the
+                                                           module, valid only
+                                                           if errorCode is
+                                                           zero. */
+} uSecurityCredentialBatchResult_t;
+
+/** The function with which uSecurityCredentialCalculateHash() reads
+ * a credential, e.g. from flash or from the network.
+ *
+ * @param[in] pParam    the pReadParam given to
+ *                      uSecurityCredentialCalculateHash().
+ * @param[out] pBuffer  a place to put the data; never NULL.
+ * @param size          the amount of storage at pBuffer.
+ * @return              the number of bytes written to pBuffer, zero
+ *                      when there is no more to read, else negative
+ *                      error code.
+ */
+typedef int32_t (*uSecurityCredentialRead_t)(void *pParam, char *pBuffer,
+                                             size_t size);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -224,6 +282,30 @@ int32_t uSecurityCredentialStore(uDeviceHandle_t devHandle,
                                  const char *pPassword,
                                  char *pMd5);
 
+/** Store a batch of X.509 certificates and/or security keys, e.g.
+ * during factory provisioning.  Each item is stored as if by
+ * uSecurityCredentialStore(), except that where the item has an
+ * expected MD5 hash and the module already has a credential of that
+ * type and name with that hash the item is skipped, saving the
+ * upload.  A failure on one item does not stop the rest of the batch
+ * from being stored: check pResults afterwards.
+ *
+ * @param devHandle      the handle of the instance to be used,
+ *                       for example obtained using uDeviceOpen().
+ * @param[in] pItems     an array of numItems items to store; cannot
+ *                       be NULL.
+ * @param numItems       the number of items at pItems.
+ * @param[out] pResults  an array of numItems results, one for each
+ *                       item at pItems; cannot be NULL.
+ * @return               on success the number of items that could
+ *                       not be stored (hence zero if all went well),
+ *                       else negative error code.
+ */
+int32_t uSecurityCredentialStoreBatch(uDeviceHandle_t devHandle,
+                                      const uSecurityCredentialBatchItem_t *pItems,
+                                      size_t numItems,
+                                      uSecurityCredentialBatchResult_t *pResults);
+
 /** As uSecurityCredentialStore() but can be used ONLY with cellular modules
  * where you have already stored a certificate in the file system of the
  * cellular module and you want to import that certificate into the security
@@ -286,6 +368,30 @@ int32_t uSecurityCredentialGetHash(uDeviceHandle_t devHandle,
                                    const char *pName,
                                    char *pMd5);
 
+/** Calculate locally the MD5 hash of a credential, reading it in
+ * chunks of #U_SECURITY_CREDENTIAL_HASH_CHUNK_LENGTH_BYTES as it
+ * streams in, so that no buffer the size of the credential is
+ * required; the result may be compared with that returned by
+ * uSecurityCredentialGetHash() to decide whether the credential
+ * needs to be stored at all, or passed as the pMd5 field of a
+ * #uSecurityCredentialBatchItem_t.  Since the module hashes the
+ * DER form of what is stored, the two will only match if the
+ * credential being read is in DER format.  This function does not
+ * require a device.
+ *
+ * @param[in] pRead       the function that reads the credential;
+ *                        cannot be NULL.
+ * @param[in] pReadParam  a parameter that will be passed to pRead;
+ *                        may be NULL.
+ * @param[out] pMd5       pointer to #U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES
+ *                        of storage for the result; cannot be NULL.
+ * @return                on success the number of bytes of credential
+ *                        that were hashed, else negative error code.
+ */
+int32_t uSecurityCredentialCalculateHash(uSecurityCredentialRead_t pRead,
+                                         void *pReadParam,
+                                         char *pMd5);
+
 /** Get the description of the first X.509 certificate or security key
  * from storage; uSecurityCredentialListNext() should be called repeatedly
  * to iterate through subsequent entries in the list.  This function
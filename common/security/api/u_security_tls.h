@@ -78,6 +78,19 @@ extern "C" {
 # define U_SECURITY_TLS_SNI_MAX_LENGTH_BYTES 128
 #endif
 
+#ifndef U_SECURITY_TLS_PROFILE_CACHE_MAX_NUM_UNUSED
+/** On cellular, security contexts with identical settings share a
+ * single configured security profile in the module, so that opening
+ * another TLS socket to the same server doesn't need to repeat the
+ * AT commands that configure it.  A profile is kept configured once
+ * the last security context using it has been removed, ready for
+ * the next one, up to this many such unused profiles; unused
+ * profiles are also released if the module runs out of profiles.
+ * Set this to 0 to only share profiles that are in use.
+ */
+# define U_SECURITY_TLS_PROFILE_CACHE_MAX_NUM_UNUSED 2
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -357,8 +370,11 @@ typedef struct {
                            negotiation, maximum length #U_SECURITY_TLS_SNI_MAX_LENGTH_BYTES;
                            this is optional on cellular modules while for Wifi modules it
                            is set automatically if the connect string is a URL. */
-    bool enableSessionResumption; /**< set to true to enable session resumption; currently
-                                       only false is supported. */
+    bool enableSessionResumption; /**< set to true to enable session resumption, where
+                                       the module keeps the session ID/ticket a server
+                                       gives it and offers it back on the next connection
+                                       to that server, avoiding a full handshake; supported
+                                       on SARA-R5 and LARA-R6 cellular modules only. */
     bool useDeviceCertificate; /**< if this is set to true then pClientCertificateName should
                                     be set to NULL and instead, for a module that supports
                                     u-blox security and has been security sealed, the device
@@ -449,6 +465,19 @@ uSecurityTlsContext_t *pUSecurityTlsAdd(uDeviceHandle_t devHandle,
  */
 void uSecurityTlsRemove(uSecurityTlsContext_t *pContext);
 
+/** Forget the security profiles that have been configured in
+ * the given device for sharing between security contexts, see
+ * #U_SECURITY_TLS_PROFILE_CACHE_MAX_NUM_UNUSED; this is called by
+ * uDeviceClose() and should also be called if the module has been
+ * restarted by other means, since the module will then have lost
+ * the configuration.  Security contexts currently using a profile
+ * are not affected.  This function is thread-safe.
+ * IMPORTANT: this function is NOT INTENDED FOR CUSTOMER USE.
+ *
+ * @param devHandle the handle of the device, NULL for all devices.
+ */
+void uSecurityTlsCacheFlush(uDeviceHandle_t devHandle);
+
 /** Clean-up memory from TLS security contexts.
  * pUSecurityTlsAdd() creates a mutex, if not already created,
  * to ensure thread-safety.  This function may be called if
@@ -49,6 +49,7 @@
 #include "u_port.h"
 #include "u_port_os.h"
 #include "u_port_heap.h"
+#include "u_port_crypto.h"
 
 #include "u_at_client.h"
 
@@ -441,6 +442,57 @@ int32_t uSecurityCredentialStore(uDeviceHandle_t devHandle,
                                            pPassword, pMd5);
 }
 
+// Store a batch of X.509 certificates and/or security keys.
+int32_t uSecurityCredentialStoreBatch(uDeviceHandle_t devHandle,
+                                      const uSecurityCredentialBatchItem_t *pItems,
+                                      size_t numItems,
+                                      uSecurityCredentialBatchResult_t *pResults)
+{
+    uAtClientHandle_t atHandle;
+    int32_t errorCodeOrFailCount = getAtClient(devHandle, &atHandle);
+    const uSecurityCredentialBatchItem_t *pItem;
+    uSecurityCredentialBatchResult_t *pResult;
+
+    if (errorCodeOrFailCount == 0) {
+        errorCodeOrFailCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pItems != NULL) && (pResults != NULL)) {
+            errorCodeOrFailCount = 0;
+            for (size_t x = 0; x < numItems; x++) {
+                pItem = pItems + x;
+                pResult = pResults + x;
+                pResult->skipped = false;
+                pResult->errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+                if (pItem->pMd5 != NULL) {
+                    // Only worth storing if it isn't there already
+                    pResult->errorCode = uSecurityCredentialGetHash(devHandle,
+                                                                    pItem->type,
+                                                                    pItem->pName,
+                                                                    pResult->md5);
+                    if ((pResult->errorCode == 0) &&
+                        (memcmp(pResult->md5, pItem->pMd5, sizeof(pResult->md5)) == 0)) {
+                        pResult->skipped = true;
+                    }
+                }
+                if (!pResult->skipped) {
+                    pResult->errorCode = securityCredentialStoreOrImport(devHandle,
+                                                                         pItem->type,
+                                                                         pItem->pName,
+                                                                         pItem->pContents,
+                                                                         pItem->size,
+                                                                         NULL,
+                                                                         pItem->pPassword,
+                                                                         pResult->md5);
+                }
+                if (pResult->errorCode != 0) {
+                    errorCodeOrFailCount++;
+                }
+            }
+        }
+    }
+
+    return errorCodeOrFailCount;
+}
+
 // Import the given X.509 certificate or security key from a file.
 int32_t uSecurityCredentialImportFromFile(uDeviceHandle_t devHandle,
                                           uSecurityCredentialType_t type,
@@ -504,6 +556,45 @@ int32_t uSecurityCredentialGetHash(uDeviceHandle_t devHandle,
     return errorCode;
 }
 
+// Calculate the MD5 hash of a credential read in chunks.
+int32_t uSecurityCredentialCalculateHash(uSecurityCredentialRead_t pRead,
+                                         void *pReadParam,
+                                         char *pMd5)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    char buffer[U_SECURITY_CREDENTIAL_HASH_CHUNK_LENGTH_BYTES];
+    void *pContext = NULL;
+    int32_t totalLength = 0;
+    int32_t x;
+
+    if ((pRead != NULL) && (pMd5 != NULL)) {
+        errorCodeOrLength = uPortCryptoMd5Init(&pContext);
+        if (errorCodeOrLength == 0) {
+            do {
+                x = pRead(pReadParam, buffer, sizeof(buffer));
+                if (x > 0) {
+                    totalLength += x;
+                    errorCodeOrLength = uPortCryptoMd5Update(pContext, buffer, x);
+                } else if (x < 0) {
+                    errorCodeOrLength = x;
+                }
+            } while ((x > 0) && (errorCodeOrLength == 0));
+            // Always finish, to free the context, but only
+            // output on success
+            x = uPortCryptoMd5Finish(pContext,
+                                     errorCodeOrLength == 0 ? pMd5 : NULL);
+            if (errorCodeOrLength == 0) {
+                errorCodeOrLength = x;
+            }
+            if (errorCodeOrLength == 0) {
+                errorCodeOrLength = totalLength;
+            }
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
 // Get the description of the first X.509 certificate or security key.
 int32_t uSecurityCredentialListFirst(uDeviceHandle_t devHandle,
                                      uSecurityCredential_t *pCredential)
@@ -57,6 +57,20 @@
  * TYPES
  * -------------------------------------------------------------- */
 
+/** A configured cellular security profile, which may be shared by
+ * any number of security contexts with identical settings and is
+ * kept, up to #U_SECURITY_TLS_PROFILE_CACHE_MAX_NUM_UNUSED, once
+ * none are using it.
+ */
+typedef struct uSecurityTlsProfile_t {
+    uDeviceHandle_t devHandle;
+    uint64_t hash;          /**< Hash of the uSecurityTlsSettings_t contents. */
+    void *pNetworkSpecific;
+    size_t useCount;
+    bool flushed;           /**< Still in use but no longer to be shared. */
+    struct uSecurityTlsProfile_t *pNext;
+} uSecurityTlsProfile_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -65,6 +79,11 @@
  */
 static uPortMutexHandle_t gMutex = NULL;
 
+/** The configured cellular security profiles, most recently
+ * used first.
+ */
+static uSecurityTlsProfile_t *gpProfileList = NULL;
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -110,14 +129,253 @@ static bool checkConfig(const uSecurityTlsSettings_t *pSettings)
          (strlen(pSettings->pExpectedServerUrl) <=
           U_SECURITY_TLS_EXPECTED_SERVER_URL_MAX_LENGTH_BYTES)) &&
         ((pSettings->pSni == NULL) || (strlen(pSettings->pSni) <=
-                                       U_SECURITY_TLS_SNI_MAX_LENGTH_BYTES)) &&
-        !pSettings->enableSessionResumption) {
+                                       U_SECURITY_TLS_SNI_MAX_LENGTH_BYTES))) {
         isGood = true;
     }
 
     return isGood;
 }
 
+// Add length bytes to a 64-bit FNV-1a hash.
+static uint64_t hashAdd(uint64_t hash, const void *pData, size_t length)
+{
+    const uint8_t *pByte = (const uint8_t *) pData;
+
+    for (size_t x = 0; x < length; x++) {
+        hash ^= *pByte;
+        hash *= 1099511628211ULL;
+        pByte++;
+    }
+
+    return hash;
+}
+
+// Add a string to a hash, distinguishing NULL from empty and
+// marking the end so that adjacent strings can't run together.
+static uint64_t hashAddString(uint64_t hash, const char *pString)
+{
+    uint8_t marker = 0;
+
+    if (pString != NULL) {
+        hash = hashAdd(hash, pString, strlen(pString));
+        marker = 1;
+    }
+
+    return hashAdd(hash, &marker, sizeof(marker));
+}
+
+// Hash the contents of a settings structure, NULL meaning defaults.
+static uint64_t hashSettings(const uSecurityTlsSettings_t *pSettings)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    int32_t value[4];
+    bool flag[3];
+
+    if (pSettings != NULL) {
+        value[0] = (int32_t) pSettings->tlsVersionMin;
+        value[1] = (int32_t) pSettings->certificateCheck;
+        value[2] = (int32_t) pSettings->psk.size;
+        value[3] = (int32_t) pSettings->pskId.size;
+        hash = hashAdd(hash, value, sizeof(value));
+        hash = hashAddString(hash, pSettings->pRootCaCertificateName);
+        hash = hashAddString(hash, pSettings->pClientCertificateName);
+        hash = hashAddString(hash, pSettings->pClientPrivateKeyName);
+        hash = hashAddString(hash, pSettings->pClientPrivateKeyPassword);
+        hash = hashAddString(hash, pSettings->pExpectedServerUrl);
+        hash = hashAddString(hash, pSettings->pSni);
+        hash = hashAdd(hash, &(pSettings->cipherSuites.num),
+                       sizeof(pSettings->cipherSuites.num));
+        for (size_t x = 0; x < pSettings->cipherSuites.num; x++) {
+            value[0] = (int32_t) pSettings->cipherSuites.suite[x];
+            hash = hashAdd(hash, value, sizeof(value[0]));
+        }
+        if (pSettings->psk.pBin != NULL) {
+            hash = hashAdd(hash, pSettings->psk.pBin, pSettings->psk.size);
+        }
+        if (pSettings->pskId.pBin != NULL) {
+            hash = hashAdd(hash, pSettings->pskId.pBin, pSettings->pskId.size);
+        }
+        flag[0] = pSettings->enableSessionResumption;
+        flag[1] = pSettings->useDeviceCertificate;
+        flag[2] = pSettings->includeCaCertificates;
+        hash = hashAdd(hash, flag, sizeof(flag));
+    }
+
+    return hash;
+}
+
+// Find a cached profile by device handle and hash, ignoring
+// flushed profiles, or, if pNetworkSpecific is not NULL, by
+// pNetworkSpecific, returning a pointer to the pointer to it so
+// that it can be removed.
+static uSecurityTlsProfile_t **ppProfileFind(uDeviceHandle_t devHandle,
+                                             uint64_t hash,
+                                             const void *pNetworkSpecific)
+{
+    uSecurityTlsProfile_t **ppProfile = &gpProfileList;
+
+    while ((*ppProfile != NULL) &&
+           ((pNetworkSpecific != NULL) ? ((*ppProfile)->pNetworkSpecific != pNetworkSpecific) :
+            (((*ppProfile)->devHandle != devHandle) || ((*ppProfile)->hash != hash) ||
+             (*ppProfile)->flushed))) {
+        ppProfile = &((*ppProfile)->pNext);
+    }
+
+    return ppProfile;
+}
+
+// Remove a profile from the list, freeing the cellular security
+// profile also if no-one is using it.
+static void profileFree(uSecurityTlsProfile_t **ppProfile)
+{
+    uSecurityTlsProfile_t *pProfile = *ppProfile;
+
+    *ppProfile = pProfile->pNext;
+    if (pProfile->useCount == 0) {
+        uCellSecTlsRemove((uCellSecTlsContext_t *) pProfile->pNetworkSpecific);
+    }
+    uPortFree(pProfile);
+}
+
+// Free the least recently used unused profile of a device, or of
+// any device if devHandle is NULL, returning true if there was one.
+static bool profileFreeOldestUnused(uDeviceHandle_t devHandle)
+{
+    uSecurityTlsProfile_t **ppProfile = &gpProfileList;
+    uSecurityTlsProfile_t **ppOldest = NULL;
+
+    while (*ppProfile != NULL) {
+        if (((*ppProfile)->useCount == 0) &&
+            ((devHandle == NULL) || ((*ppProfile)->devHandle == devHandle))) {
+            ppOldest = ppProfile;
+        }
+        ppProfile = &((*ppProfile)->pNext);
+    }
+    if (ppOldest != NULL) {
+        profileFree(ppOldest);
+    }
+
+    return (ppOldest != NULL);
+}
+
+// Count the unused profiles.
+static size_t profileCountUnused()
+{
+    size_t count = 0;
+
+    for (uSecurityTlsProfile_t *pProfile = gpProfileList; pProfile != NULL;
+         pProfile = pProfile->pNext) {
+        if (pProfile->useCount == 0) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+// Configure a new cellular security profile with the given settings.
+static int32_t cellProfileAdd(uDeviceHandle_t devHandle,
+                              const uSecurityTlsSettings_t *pSettings,
+                              void **ppNetworkSpecific)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    void *pNetworkSpecific;
+
+    // Allocate a cellular security context with
+    // default settings
+    pNetworkSpecific = (void *) pUCellSecSecTlsAdd(devHandle);
+    if (pNetworkSpecific == NULL) {
+        errorCode = uCellSecTlsResetLastError();
+    }
+    while ((pNetworkSpecific == NULL) &&
+           (errorCode == (int32_t) U_ERROR_COMMON_NO_MEMORY) &&
+           profileFreeOldestUnused(devHandle)) {
+        // All of the profiles were taken, some by cached
+        // profiles that no-one is using: try again
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        pNetworkSpecific = (void *) pUCellSecSecTlsAdd(devHandle);
+        if (pNetworkSpecific == NULL) {
+            errorCode = uCellSecTlsResetLastError();
+        }
+    }
+    if (pNetworkSpecific != NULL) {
+        if (pSettings != NULL) {
+            // Looks like some specific settings have been
+            // requested: set them
+            if (pSettings->tlsVersionMin != U_SECURITY_TLS_VERSION_ANY) {
+                // Set the TLS version (encoding is the
+                // same in cellular)
+                errorCode = uCellSecTlsVersionSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                  (int32_t) pSettings->tlsVersionMin);
+            }
+            if ((errorCode == 0) &&
+                (pSettings->pRootCaCertificateName != NULL)) {
+                // Set the root CA certificate name
+                errorCode = uCellSecTlsRootCaCertificateNameSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                                pSettings->pRootCaCertificateName);
+            }
+            if ((errorCode == 0) &&
+                (pSettings->pClientCertificateName != NULL)) {
+                // Set the client certificate name
+                errorCode = uCellSecTlsClientCertificateNameSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                                pSettings->pClientCertificateName);
+            }
+            if ((errorCode == 0) &&
+                (pSettings->pClientPrivateKeyName != NULL)) {
+                // Set the client private key name
+                errorCode = uCellSecTlsClientPrivateKeyNameSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                               pSettings->pClientPrivateKeyName,
+                                                               pSettings->pClientPrivateKeyPassword);
+            }
+            if ((errorCode == 0) &&
+                (pSettings->cipherSuites.num > 0)) {
+                // Set the cipher suites
+                for (size_t x = 0; (x < pSettings->cipherSuites.num) &&
+                     (errorCode == 0); x++) {
+                    errorCode = uCellSecTlsCipherSuiteAdd((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                          (int32_t) pSettings->cipherSuites.suite[x]);
+                }
+            }
+            if ((errorCode == 0) &&
+                (((pSettings->psk.pBin != NULL) && (pSettings->psk.size > 0) &&
+                  (pSettings->pskId.pBin != NULL) && (pSettings->pskId.size > 0)) ||
+                 pSettings->pskGeneratedByRoT)) {
+                // Set the pre-shared key and accompanying ID
+                errorCode = uCellSecTlsClientPskSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                    pSettings->psk.pBin, pSettings->psk.size,
+                                                    pSettings->pskId.pBin, pSettings->pskId.size,
+                                                    pSettings->pskGeneratedByRoT);
+            }
+            if (errorCode == 0) {
+                // Set the certificate checking
+                errorCode = uCellSecTlsCertificateCheckSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                           (uCellSecTlsCertficateCheck_t) pSettings->certificateCheck,
+                                                           pSettings->pExpectedServerUrl);
+            }
+            if ((errorCode == 0) && (pSettings->pSni != NULL)) {
+                // Set the Server Name Indication string
+                errorCode = uCellSecTlsSniSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                              pSettings->pSni);
+            }
+            if ((errorCode == 0) && (pSettings->useDeviceCertificate)) {
+                // Set that the device certificate from security sealing
+                // should be used as the client certificate
+                errorCode = uCellSecTlsUseDeviceCertificateSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                               pSettings->includeCaCertificates);
+            }
+            if ((errorCode == 0) && (pSettings->enableSessionResumption)) {
+                // Switch on session resumption
+                errorCode = uCellSecTlsSessionResumptionSet((uCellSecTlsContext_t *) pNetworkSpecific,
+                                                            true);
+            }
+        }
+    }
+
+    *ppNetworkSpecific = pNetworkSpecific;
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -134,6 +392,9 @@ uSecurityTlsContext_t *pUSecurityTlsAdd(uDeviceHandle_t devHandle,
     const char *pClientPrivateKeyName = NULL;
     bool certificateCheckOn = false;
     uSecurityTlsVersion_t tlsVersionMin = U_SECURITY_TLS_VERSION_ANY;
+    uint64_t hash;
+    uSecurityTlsProfile_t **ppProfile;
+    uSecurityTlsProfile_t *pProfile;
 
     if ((errorCode == 0) && (pContext != NULL)) {
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
@@ -151,7 +412,10 @@ uSecurityTlsContext_t *pUSecurityTlsAdd(uDeviceHandle_t devHandle,
                     errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
                     // Only CA checking (not the URL and date versions)
                     // are supported for short range
-                    if (pSettings->certificateCheck <= U_SECURITY_TLS_CERTIFICATE_CHECK_ROOT_CA) {
+                    if (pSettings->enableSessionResumption) {
+                        // Not supported on short range
+                        errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+                    } else if (pSettings->certificateCheck <= U_SECURITY_TLS_CERTIFICATE_CHECK_ROOT_CA) {
                         errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                         pRootCaCertificateName = pSettings->pRootCaCertificateName;
                         pClientCertificateName = pSettings->pClientCertificateName;
@@ -175,75 +439,38 @@ uSecurityTlsContext_t *pUSecurityTlsAdd(uDeviceHandle_t devHandle,
                 }
             } else if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
                 errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                // Allocate a cellular security context with
-                // default settings
-                pNetworkSpecific = (void *) pUCellSecSecTlsAdd(devHandle);
-                if (pNetworkSpecific == NULL) {
-                    errorCode = uCellSecTlsResetLastError();
+                hash = hashSettings(pSettings);
+                ppProfile = ppProfileFind(devHandle, hash, NULL);
+                pProfile = *ppProfile;
+                if ((pProfile != NULL) && (pSettings != NULL) &&
+                    pSettings->pskGeneratedByRoT) {
+                    // The root of trust generates a new PSK each time,
+                    // that can't be shared
+                    pProfile = NULL;
+                }
+                if (pProfile != NULL) {
+                    // An identical profile is already configured:
+                    // share it, moving it to the front of the list
+                    *ppProfile = pProfile->pNext;
+                    pProfile->pNext = gpProfileList;
+                    gpProfileList = pProfile;
+                    pProfile->useCount++;
+                    pNetworkSpecific = pProfile->pNetworkSpecific;
                 } else {
-                    if (pSettings != NULL) {
-                        // Looks like some specific settings have been
-                        // requested: set them
-                        if (pSettings->tlsVersionMin != U_SECURITY_TLS_VERSION_ANY) {
-                            // Set the TLS version (encoding is the
-                            // same in cellular)
-                            errorCode = uCellSecTlsVersionSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                              (int32_t) pSettings->tlsVersionMin);
-                        }
-                        if ((errorCode == 0) &&
-                            (pSettings->pRootCaCertificateName != NULL)) {
-                            // Set the root CA certificate name
-                            errorCode = uCellSecTlsRootCaCertificateNameSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                                            pSettings->pRootCaCertificateName);
-                        }
-                        if ((errorCode == 0) &&
-                            (pSettings->pClientCertificateName != NULL)) {
-                            // Set the client certificate name
-                            errorCode = uCellSecTlsClientCertificateNameSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                                            pSettings->pClientCertificateName);
-                        }
-                        if ((errorCode == 0) &&
-                            (pSettings->pClientPrivateKeyName != NULL)) {
-                            // Set the client private key name
-                            errorCode = uCellSecTlsClientPrivateKeyNameSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                                           pSettings->pClientPrivateKeyName,
-                                                                           pSettings->pClientPrivateKeyPassword);
-                        }
-                        if ((errorCode == 0) &&
-                            (pSettings->cipherSuites.num > 0)) {
-                            // Set the cipher suites
-                            for (size_t x = 0; (x < pSettings->cipherSuites.num) &&
-                                 (errorCode == 0); x++) {
-                                errorCode = uCellSecTlsCipherSuiteAdd((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                                      (int32_t) pSettings->cipherSuites.suite[x]);
-                            }
-                        }
-                        if ((errorCode == 0) &&
-                            (((pSettings->psk.pBin != NULL) && (pSettings->psk.size > 0) &&
-                              (pSettings->pskId.pBin != NULL) && (pSettings->pskId.size > 0)) ||
-                             pSettings->pskGeneratedByRoT)) {
-                            // Set the pre-shared key and accompanying ID
-                            errorCode = uCellSecTlsClientPskSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                                pSettings->psk.pBin, pSettings->psk.size,
-                                                                pSettings->pskId.pBin, pSettings->pskId.size,
-                                                                pSettings->pskGeneratedByRoT);
-                        }
-                        if (errorCode == 0) {
-                            // Set the certificate checking
-                            errorCode = uCellSecTlsCertificateCheckSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                                       (uCellSecTlsCertficateCheck_t) pSettings->certificateCheck,
-                                                                       pSettings->pExpectedServerUrl);
-                        }
-                        if ((errorCode == 0) && (pSettings->pSni != NULL)) {
-                            // Set the Server Name Indication string
-                            errorCode = uCellSecTlsSniSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                          pSettings->pSni);
-                        }
-                        if ((errorCode == 0) && (pSettings->useDeviceCertificate)) {
-                            // Set that the device certificate from security sealing
-                            // should be used as the client certificate
-                            errorCode = uCellSecTlsUseDeviceCertificateSet((uCellSecTlsContext_t *) pNetworkSpecific,
-                                                                           pSettings->includeCaCertificates);
+                    errorCode = cellProfileAdd(devHandle, pSettings, &pNetworkSpecific);
+                    if ((errorCode == 0) &&
+                        ((pSettings == NULL) || !pSettings->pskGeneratedByRoT)) {
+                        // Remember it for next time; if this fails
+                        // it is just not shared
+                        pProfile = (uSecurityTlsProfile_t *) pUPortMalloc(sizeof(*pProfile));
+                        if (pProfile != NULL) {
+                            pProfile->devHandle = devHandle;
+                            pProfile->hash = hash;
+                            pProfile->pNetworkSpecific = pNetworkSpecific;
+                            pProfile->useCount = 1;
+                            pProfile->flushed = false;
+                            pProfile->pNext = gpProfileList;
+                            gpProfileList = pProfile;
                         }
                     }
                 }
@@ -268,6 +495,8 @@ uSecurityTlsContext_t *pUSecurityTlsAdd(uDeviceHandle_t devHandle,
 // Free the given TLS security context.
 void uSecurityTlsRemove(uSecurityTlsContext_t *pContext)
 {
+    uSecurityTlsProfile_t *pProfile;
+
     if ((pContext != NULL) && (init() == 0)) {
 
         U_PORT_MUTEX_LOCK(gMutex);
@@ -276,7 +505,27 @@ void uSecurityTlsRemove(uSecurityTlsContext_t *pContext)
         if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
             uShortRangeSecTlsRemove((uShortRangeSecTlsContext_t *) pContext->pNetworkSpecific);
         } else if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-            uCellSecTlsRemove((uCellSecTlsContext_t *) pContext->pNetworkSpecific);
+            pProfile = NULL;
+            if (pContext->pNetworkSpecific != NULL) {
+                pProfile = *ppProfileFind(NULL, 0, pContext->pNetworkSpecific);
+            }
+            if (pProfile != NULL) {
+                // A cached profile: keep it for re-use unless it
+                // has been flushed or there are too many unused
+                // profiles already
+                if (pProfile->useCount > 0) {
+                    pProfile->useCount--;
+                }
+                if (pProfile->flushed) {
+                    if (pProfile->useCount == 0) {
+                        profileFree(ppProfileFind(NULL, 0, pContext->pNetworkSpecific));
+                    }
+                } else if (profileCountUnused() > U_SECURITY_TLS_PROFILE_CACHE_MAX_NUM_UNUSED) {
+                    profileFreeOldestUnused(NULL);
+                }
+            } else {
+                uCellSecTlsRemove((uCellSecTlsContext_t *) pContext->pNetworkSpecific);
+            }
         }
         uPortFree(pContext);
 
@@ -284,10 +533,40 @@ void uSecurityTlsRemove(uSecurityTlsContext_t *pContext)
     }
 }
 
+// Forget the cached security profiles of a device.
+void uSecurityTlsCacheFlush(uDeviceHandle_t devHandle)
+{
+    uSecurityTlsProfile_t **ppProfile = &gpProfileList;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        while (*ppProfile != NULL) {
+            if (((devHandle == NULL) || ((*ppProfile)->devHandle == devHandle)) &&
+                ((*ppProfile)->useCount == 0)) {
+                profileFree(ppProfile);
+            } else {
+                if ((devHandle == NULL) || ((*ppProfile)->devHandle == devHandle)) {
+                    // Still in use, maybe by several security
+                    // contexts: keep it so that it is freed once,
+                    // when the last of them is removed, but don't
+                    // share it any more
+                    (*ppProfile)->flushed = true;
+                }
+                ppProfile = &((*ppProfile)->pNext);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+}
+
 // Clean-up memory from TLS security contexts.
 void uSecurityTlsCleanUp()
 {
     if (gMutex != NULL) {
+        uSecurityTlsCacheFlush(NULL);
         U_PORT_MUTEX_LOCK(gMutex);
         U_PORT_MUTEX_UNLOCK(gMutex);
         uPortMutexDelete(gMutex);
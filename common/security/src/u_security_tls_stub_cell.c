@@ -143,5 +143,13 @@ U_WEAK int32_t uCellSecTlsSniSet(const uCellSecTlsContext_t *pContext,
     return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
 }
 
+U_WEAK int32_t uCellSecTlsSessionResumptionSet(const uCellSecTlsContext_t *pContext,
+                                               bool onNotOff)
+{
+    (void) pContext;
+    (void) onNotOff;
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
 
 // End of file
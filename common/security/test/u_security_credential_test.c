@@ -43,6 +43,7 @@
 #include "u_port.h"
 #include "u_port_debug.h"
 #include "u_port_os.h"
+#include "u_port_crypto.h"
 
 #include "u_test_util_resource_check.h"
 
@@ -117,14 +118,83 @@
  * VARIABLES
  * -------------------------------------------------------------- */
 
+/** The number of bytes of the test credential read so far by
+ * readCallback().
+ */
+static size_t gReadOffset = 0;
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Read callback for uSecurityCredentialCalculateHash(), returning
+// the test client certificate a few bytes at a time; if pParam
+// is not NULL it points to an error code to return instead.
+static int32_t readCallback(void *pParam, char *pBuffer, size_t size)
+{
+    int32_t errorCodeOrLength;
+    size_t length = gUSecurityCredentialTestClientX509PemSize - gReadOffset;
+
+    if (pParam != NULL) {
+        errorCodeOrLength = *((int32_t *) pParam);
+    } else {
+        // Return less than asked, like a network would
+        if (size > 13) {
+            size = 13;
+        }
+        if (length > size) {
+            length = size;
+        }
+        memcpy(pBuffer, gUSecurityCredentialTestClientX509Pem + gReadOffset, length);
+        gReadOffset += length;
+        errorCodeOrLength = (int32_t) length;
+    }
+
+    return errorCodeOrLength;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
 
+/** Test calculating the hash of a credential in pieces; no
+ * device is required for this.
+ */
+U_PORT_TEST_FUNCTION("[securityCredential]", "securityCredentialCalculateHash")
+{
+    char hash[U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES];
+    char expected[U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES];
+    void *pContext;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+    int32_t resourceCount;
+
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Calculate the expected hash in one go
+    U_PORT_TEST_ASSERT(uPortCryptoMd5Init(&pContext) == 0);
+    U_PORT_TEST_ASSERT(uPortCryptoMd5Update(pContext,
+                                            (const char *) gUSecurityCredentialTestClientX509Pem,
+                                            gUSecurityCredentialTestClientX509PemSize) == 0);
+    U_PORT_TEST_ASSERT(uPortCryptoMd5Finish(pContext, expected) == 0);
+
+    gReadOffset = 0;
+    U_PORT_TEST_ASSERT(uSecurityCredentialCalculateHash(readCallback, NULL,
+                                                        hash) == (int32_t) gUSecurityCredentialTestClientX509PemSize);
+    U_PORT_TEST_ASSERT(memcmp(hash, expected, sizeof(hash)) == 0);
+
+    // An error from the read callback should be passed back
+    U_PORT_TEST_ASSERT(uSecurityCredentialCalculateHash(readCallback, &errorCode,
+                                                        hash) == errorCode);
+    U_PORT_TEST_ASSERT(uSecurityCredentialCalculateHash(NULL, NULL, hash) < 0);
+    U_PORT_TEST_ASSERT(uSecurityCredentialCalculateHash(readCallback, NULL, NULL) < 0);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 #ifdef U_SECURITY_CREDENTIAL_TEST_FORMATS
 /** Not a test, since it doesn't have any test asserts in it, but
  * a function to try all the possible credential formats/encodings
@@ -218,6 +288,8 @@ U_PORT_TEST_FUNCTION("[securityCredential]", "securityCredentialTest")
     int32_t z;
     char hash[U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES];
     char buffer[U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES];
+    uSecurityCredentialBatchItem_t batchItem[2];
+    uSecurityCredentialBatchResult_t batchResult[2];
 
     // In case a previous test failed
     uNetworkTestCleanUp();
@@ -295,6 +367,31 @@ U_PORT_TEST_FUNCTION("[securityCredential]", "securityCredentialTest")
             U_PORT_TEST_ASSERT((uint8_t) buffer[y] == hash[y]);
         }
 
+        // Store the certificate again as a batch: the first item has
+        // the hash just read and so should be skipped, the second has
+        // no hash and so should be stored
+        U_TEST_PRINT_LINE_X("storing certificate as a batch...", x);
+        for (size_t y = 0; y < sizeof(batchItem) / sizeof(batchItem[0]); y++) {
+            batchItem[y].type = U_SECURITY_CREDENTIAL_CLIENT_X509;
+            batchItem[y].pName = "ubxlib_test_cert";
+            batchItem[y].pContents = (const char *) gUSecurityCredentialTestClientX509Pem;
+            batchItem[y].size = gUSecurityCredentialTestClientX509PemSize;
+            batchItem[y].pPassword = NULL;
+            batchItem[y].pMd5 = NULL;
+        }
+        batchItem[0].pMd5 = hash;
+        U_PORT_TEST_ASSERT(uSecurityCredentialStoreBatch(devHandle, batchItem,
+                                                         sizeof(batchItem) / sizeof(batchItem[0]),
+                                                         batchResult) == 0);
+        U_PORT_TEST_ASSERT(batchResult[0].errorCode == 0);
+        U_PORT_TEST_ASSERT(batchResult[0].skipped);
+        U_PORT_TEST_ASSERT(batchResult[1].errorCode == 0);
+        U_PORT_TEST_ASSERT(!batchResult[1].skipped);
+        for (size_t y = 0; y < sizeof(hash); y++) {
+            U_PORT_TEST_ASSERT(batchResult[0].md5[y] == hash[y]);
+            U_PORT_TEST_ASSERT(batchResult[1].md5[y] == hash[y]);
+        }
+
         // Check that the certificate is listed
         U_TEST_PRINT_LINE_X("listing credentials...", x);
         z = 0;
@@ -215,6 +215,9 @@ U_PORT_TEST_FUNCTION("[securityTls]", "securityTlsSock")
     int32_t resourceCount;
     uSecurityTlsSettings_t settings = U_SECURITY_TLS_SETTINGS_DEFAULT;
     char hash[U_SECURITY_CREDENTIAL_MD5_LENGTH_BYTES];
+    uSecurityTlsContext_t *pContext;
+    uSecurityTlsContext_t *pContextShared;
+    uSecurityTlsContext_t *pContextFlushed;
 
     // In case a previous test failed
     uNetworkTestCleanUp();
@@ -400,6 +403,34 @@ U_PORT_TEST_FUNCTION("[securityTls]", "securityTlsSock")
             // the SARA-R412M-03B we have on the test system.
             U_TEST_PRINT_LINE("*** WARNING *** socket failed to close.");
         }
+
+        if (pTmp->pDeviceCfg->deviceType == U_DEVICE_TYPE_CELL) {
+            // On cellular, identical settings should share
+            // the same configured security profile
+            pContext = pUSecurityTlsAdd(devHandle, &settings);
+            U_PORT_TEST_ASSERT(pContext != NULL);
+            U_PORT_TEST_ASSERT(pContext->errorCode == 0);
+            pContextShared = pUSecurityTlsAdd(devHandle, &settings);
+            U_PORT_TEST_ASSERT(pContextShared != NULL);
+            U_PORT_TEST_ASSERT(pContextShared->errorCode == 0);
+            U_PORT_TEST_ASSERT(pContextShared->pNetworkSpecific == pContext->pNetworkSpecific);
+            // Once the cache is flushed the profile, though
+            // still in use, must no longer be shared
+            uSecurityTlsCacheFlush(devHandle);
+            pContextFlushed = pUSecurityTlsAdd(devHandle, &settings);
+            U_PORT_TEST_ASSERT(pContextFlushed != NULL);
+            U_PORT_TEST_ASSERT(pContextFlushed->errorCode == 0);
+            U_PORT_TEST_ASSERT(pContextFlushed->pNetworkSpecific != pContext->pNetworkSpecific);
+            // Removing both users of the flushed profile must
+            // free it just the once
+            uSecurityTlsRemove(pContextShared);
+            uSecurityTlsRemove(pContext);
+            uSecurityTlsRemove(pContextFlushed);
+            // Flushing again, with nothing in use, releases the
+            // unused profile kept for re-use
+            uSecurityTlsCacheFlush(devHandle);
+            uSecurityTlsCacheFlush(NULL);
+        }
     }
 
     // Remove each network type
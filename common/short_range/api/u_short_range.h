@@ -65,6 +65,32 @@ extern "C" {
 # define U_SHORT_RANGE_UART_BAUD_RATE 115200
 #endif
 
+#ifndef U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES
+/** The number of idle peer connections (e.g. those of Wi-Fi HTTP
+ * sessions that have been closed) that are kept open so that a new
+ * session to the same peer, with the same options, can re-use the
+ * connection without a TCP/TLS handshake; set to 0 to close peers
+ * immediately, as before.
+ */
+# define U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES 2
+#endif
+
+#ifndef U_SHORT_RANGE_PEER_POOL_IDLE_TIMEOUT_MS
+/** How long an idle peer connection is kept in the pool; it is
+ * closed when the pool is next used after this time, or by
+ * uShortRangePeerPoolFlush(), or when the device is closed.  Should
+ * be less than the keep-alive time of the servers concerned.
+ */
+# define U_SHORT_RANGE_PEER_POOL_IDLE_TIMEOUT_MS 30000
+#endif
+
+#ifndef U_SHORT_RANGE_PEER_POOL_URL_MAX_LENGTH_BYTES
+/** The maximum length of the peer URL of a pooled connection,
+ * including terminator; connections with longer URLs are not pooled.
+ */
+# define U_SHORT_RANGE_PEER_POOL_URL_MAX_LENGTH_BYTES 128
+#endif
+
 
 /** Bluetooth address length.
  */
@@ -257,6 +283,37 @@ int32_t uShortRangeOpenUart(uShortRangeModuleType_t moduleType,
                             const uShortRangeUartConfig_t *pUartConfig,
                             bool restart, uDeviceHandle_t *pDevHandle);
 
+/** Start a configuration batch: until uShortRangeCfgBatchEnd() is
+ * called, configuration functions such as uWifiCfgConfigure() and
+ * uBleCfgConfigure() still send whatever settings differ from those
+ * of the module but, rather than each storing the settings with AT&W
+ * and restarting the module, they leave that to
+ * uShortRangeCfgBatchEnd(), which does it at most once.
+ *
+ * @param devHandle  the short range device handle.
+ * @return           zero on success or negative error code on failure.
+ */
+int32_t uShortRangeCfgBatchStart(uDeviceHandle_t devHandle);
+
+/** End a configuration batch started with uShortRangeCfgBatchStart():
+ * if any of the configuration functions called since needed the
+ * settings to be stored and the module restarted, that is done now.
+ *
+ * @param devHandle  the short range device handle.
+ * @return           1 if the module was restarted, 0 if there was no
+ *                   need, else negative error code.
+ */
+int32_t uShortRangeCfgBatchEnd(uDeviceHandle_t devHandle);
+
+/** Close any idle peer connections that are being kept open in the
+ * peer pool, see #U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES.
+ *
+ * @param devHandle  the short range device handle.
+ * @return           the number of connections closed, else negative
+ *                   error code.
+ */
+int32_t uShortRangePeerPoolFlush(uDeviceHandle_t devHandle);
+
 /** Closes and disconnects all associated handles, such as UART and EDM, for the short range instance
  *
  * @param devHandle         the short range device handle to close.
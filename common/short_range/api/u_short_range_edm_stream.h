@@ -46,6 +46,36 @@ extern "C" {
 #define U_EDM_STREAM_EVENT_QUEUE_SIZE 20
 #endif
 
+#ifndef U_SHORT_RANGE_EDM_STREAM_MAX_NUM
+/** The maximum number of EDM streams that may be open at once,
+ * one per short range module; each has its own parser, pbuf pool,
+ * event task and lock, so traffic on one module never waits on
+ * another.
+ */
+# define U_SHORT_RANGE_EDM_STREAM_MAX_NUM 2
+#endif
+
+#ifndef U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH
+/** If non-zero, each EDM stream has a transmit buffer of this size,
+ * allocated when the stream is opened, into which the EDM data
+ * frames of uShortRangeEdmStreamWrite() are gathered so that
+ * as many as will fit are sent in a single UART write, rather than
+ * three UART writes (header, payload and tail) for every frame.
+ * A frame too large for the buffer is still written straight from
+ * the caller's data.
+ */
+# define U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH 0
+#endif
+
+#ifndef U_SHORT_RANGE_EDM_STREAM_DATA_FRAME_MAX_SIZE
+/** The largest payload that uShortRangeEdmStreamWrite() puts into a
+ * single EDM data frame on an IP/MQTT connection; on a Bluetooth
+ * connection the frame size of the connection applies.  Must be no
+ * larger than the EDM maximum of 4092 bytes.
+ */
+# define U_SHORT_RANGE_EDM_STREAM_DATA_FRAME_MAX_SIZE 4092
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -75,18 +105,25 @@ typedef void (*uEdmDataEventCallback_t)(int32_t edmStreamHandle,
  * FUNCTIONS
  * -------------------------------------------------------------- */
 
-/** Initialise stream handling.
+/** Initialise stream handling; it is safe to call this more than
+ * once.
  *
  * @return  zero on success else negative error code.
  */
 int32_t uShortRangeEdmStreamInit();
 
-/** Shutdown stream handling.
+/** Shutdown stream handling.  Only instances that have been
+ * closed with uShortRangeEdmStreamClose() are cleaned up, their
+ * pbuf pool and mutex being freed; instances that are still open,
+ * e.g. those of another short range module, are left alone and
+ * carry on working: to free them, close them and call this
+ * function again.
  */
 void uShortRangeEdmStreamDeinit();
 
 /** Open an instance. Needs an open UART instance that is not accessed
- * by any other module.
+ * by any other module.  Up to #U_SHORT_RANGE_EDM_STREAM_MAX_NUM
+ * instances may be open at once.
  *
  * @param uartHandle       the UART HW block to use.
  * @return                 a stream handle else negative
@@ -312,6 +349,17 @@ int32_t uShortRangeEdmStreamAtEventSend(int32_t handle, uint32_t eventBitMap);
  */
 int32_t uShortRangeEdmStreamAtEventStackMinFree(int32_t handle);
 
+/** Get the usage statistics of the pool of pbufs that received
+ * data is put into for this stream, see
+ * uShortRangePbufPoolGetStatistics().
+ *
+ * @param handle      the handle of the stream instance.
+ * @param[out] pStats a place to put the statistics, cannot be NULL.
+ * @return            zero on success else negative error code.
+ */
+int32_t uShortRangeEdmStreamGetPbufStatistics(int32_t handle,
+                                              uShortRangePbufPoolStatistics_t *pStats);
+
 /** Detect whether the task currently executing is the
  * event callback for this stream. Useful if you have code which
  * is called a few levels down from the callback both by
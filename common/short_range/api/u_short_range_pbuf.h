@@ -44,6 +44,55 @@ extern "C" {
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
+
+/** The sizing of the pools of pbufs and pbuf lists, see
+ * uShortRangeMemPoolInitConfig(); a count of zero means the default.
+ */
+typedef struct {
+    int32_t pbufCount;         /**< the initial number of pbufs, zero for
+                                    U_SHORT_RANGE_PBUF_COUNT, by default
+                                    enough for one maximum-size EDM
+                                    payload. */
+    int32_t pbufListCount;     /**< the initial number of pbuf lists, zero
+                                    for U_SHORT_RANGE_PBUFLIST_COUNT, by
+                                    default 32. */
+    int32_t pbufGrowCount;     /**< if non-zero, when the pbufs run out
+                                    this many more are allocated from the
+                                    heap, in a secondary segment. */
+    int32_t pbufMaxCount;      /**< the limit on the number of pbufs,
+                                    including those of secondary segments;
+                                    ignored if pbufGrowCount is zero. */
+    int32_t pbufListGrowCount; /**< as pbufGrowCount but for pbuf lists. */
+    int32_t pbufListMaxCount;  /**< as pbufMaxCount but for pbuf lists. */
+} uShortRangePbufPoolConfig_t;
+
+/** Usage statistics of a pool of pbufs and pbuf lists, see
+ * uShortRangePbufPoolGetStatistics().
+ */
+typedef struct {
+    int32_t pbufCount;              /**< the number of pbufs, including
+                                         those of secondary segments. */
+    int32_t pbufUsedCount;          /**< the number of pbufs in use. */
+    int32_t pbufUsedMaxCount;       /**< the high-water mark of pbufUsedCount. */
+    int32_t pbufAllocFailCount;     /**< the number of times a pbuf could
+                                         not be allocated; the EDM parser
+                                         then stops taking data from the
+                                         UART until one is free, risking
+                                         loss of data should the UART
+                                         buffer overflow. */
+    int32_t pbufListCount;          /**< as pbufCount but for pbuf lists. */
+    int32_t pbufListUsedCount;      /**< as pbufUsedCount but for pbuf lists. */
+    int32_t pbufListUsedMaxCount;   /**< as pbufUsedMaxCount but for pbuf lists. */
+    int32_t pbufListAllocFailCount; /**< as pbufAllocFailCount but for
+                                         pbuf lists. */
+} uShortRangePbufPoolStatistics_t;
+
+/** A pool of pbufs and pbuf lists, one per EDM stream, so that
+ * EDM streams do not compete for memory or for the lock that
+ * protects it; the pool is otherwise opaque.
+ */
+typedef struct uShortRangePbufPool_t uShortRangePbufPool_t;
+
 /**
  * List of Pointer to payload
  */
@@ -55,7 +104,8 @@ extern "C" {
 #endif
 typedef U_PACKED_STRUCT(uShortRangePbuf_t) {
     struct uShortRangePbuf_t *pNext; /**< Used for linked list of pBuf */
-    uint16_t length; /**< Number of used bytes in the data buffer */
+    uint16_t length; /**< Number of unread bytes in the data buffer */
+    uint16_t offset; /**< Offset of the first unread byte in the data buffer */
     char data[];  /**< Data buffer */
 } uShortRangePbuf_t;
 #ifdef _MSC_VER
@@ -75,6 +125,8 @@ typedef U_PACKED_STRUCT(uShortRangePbufList_t) {
     uint16_t totalLen;
     // edm channel of this payload
     int8_t edmChannel;
+    // the pool that the pbuf list and its pbufs came from
+    uShortRangePbufPool_t *pPool;
 } uShortRangePbufList_t;
 // *INDENT-ON*
 
@@ -92,18 +144,75 @@ typedef struct uShortRangePktList_t {
  * FUNCTIONS
  * -------------------------------------------------------------- */
 
-/** Initialize the memory pool for shortrange; it is always safe
- * to call this, even if the memory pool might have already been
- * initialised.
+/** Initialize the default memory pool for shortrange, the one
+ * used by uShortRangePbufAlloc() and pUShortRangePbufListAlloc();
+ * it is always safe to call this, even if the memory pool might
+ * have already been initialised.
  *
  * @return zero on success else negative error code.
  */
 int32_t uShortRangeMemPoolInit(void);
 
-/** Release all the associated memory pools for shortrange.
+/** As uShortRangeMemPoolInit() but with the pools sized as given;
+ * the configuration is also used for every pool created afterwards
+ * with uShortRangePbufPoolCreate(), e.g. those of the EDM streams
+ * when a short-range device is opened, so call this before then.
+ * If the default memory pool has already been initialised it is
+ * left as it is.
+ *
+ * @param[in] pConfig the configuration; NULL for the defaults.
+ * @return            zero on success else negative error code.
+ */
+int32_t uShortRangeMemPoolInitConfig(const uShortRangePbufPoolConfig_t *pConfig);
+
+/** Release the default memory pool for shortrange.
  */
 void uShortRangeMemPoolDeInit(void);
 
+/** Get the usage statistics of a pool, e.g. in order to size the
+ * pools, see uShortRangeMemPoolInitConfig(), from field data.
+ *
+ * @param[in] pPool   the pool; NULL for the default memory pool.
+ * @param[out] pStats a place to put the statistics, cannot be NULL.
+ * @return            zero on success else negative error code.
+ */
+int32_t uShortRangePbufPoolGetStatistics(uShortRangePbufPool_t *pPool,
+                                         uShortRangePbufPoolStatistics_t *pStats);
+
+/** Create a pool of pbufs and pbuf lists, independent of the
+ * default memory pool and of any other pool.
+ *
+ * @param[out] ppPool a place to put a pointer to the pool,
+ *                    cannot be NULL.
+ * @return            zero on success else negative error code.
+ */
+int32_t uShortRangePbufPoolCreate(uShortRangePbufPool_t **ppPool);
+
+/** Delete a pool created with uShortRangePbufPoolCreate(); any
+ * pbufs or pbuf lists still allocated from it become invalid.
+ *
+ * @param[in] pPool the pool, may be NULL.
+ */
+void uShortRangePbufPoolDelete(uShortRangePbufPool_t *pPool);
+
+/** As uShortRangePbufAlloc() but allocating from the given pool.
+ *
+ * @param[in] pPool  the pool, cannot be NULL.
+ * @param[out] ppBuf a double pointer to destination pbuf.
+ * @return           data size of the returned pbuf, on failure
+ *                   negative error code.
+ */
+int32_t uShortRangePbufPoolAlloc(uShortRangePbufPool_t *pPool,
+                                 uShortRangePbuf_t **ppBuf);
+
+/** As pUShortRangePbufListAlloc() but allocating from the given
+ * pool; pbufs appended to the list must come from the same pool.
+ *
+ * @param[in] pPool the pool, cannot be NULL.
+ * @return          pointer to uShortRangePbufList_t or NULL.
+ */
+uShortRangePbufList_t *pUShortRangePbufPoolListAlloc(uShortRangePbufPool_t *pPool);
+
 /** Allocate fixed size memory from gEdmPayLoadPool memory pool.
  * Refer to gEdmPayLoadPool in u_short_range_pbuf.c
  * Memory pool should have been initialized before using this
@@ -126,7 +235,7 @@ int32_t uShortRangePbufAlloc(uShortRangePbuf_t **ppBuf);
 uShortRangePbufList_t *pUShortRangePbufListAlloc(void);
 
 /** Put the allocated memory for pbufs and packet in to their
- * free list of respective pool.
+ * free list of respective pool, whichever pool that was.
  *
  * @param[in] pBufList Pointer to the packet.
  */
@@ -150,6 +259,34 @@ int32_t uShortRangePbufListAppend(uShortRangePbufList_t *pBufList, uShortRangePb
  */
 size_t uShortRangePbufListConsumeData(uShortRangePbufList_t *pBufList, char *pData, size_t len);
 
+/** Get a pointer to the unread data of one of the pbufs of a
+ * pbuf list, in place, without copying or consuming anything.  The
+ * data pointed to remains valid until it is consumed, e.g. with
+ * uShortRangePbufListSkip(), or the pbuf list is freed.
+ *
+ * @param[in] pBufList pointer to the pbuf list.
+ * @param index        the index of the pbuf in the list, where
+ *                     zero is the pbuf that will be read next.
+ * @param[out] ppData  a place to put the pointer to the data,
+ *                     cannot be NULL.
+ * @return             the number of bytes at *ppData, zero if
+ *                     there is no such pbuf.
+ */
+size_t uShortRangePbufListPeek(const uShortRangePbufList_t *pBufList,
+                               size_t index, const char **ppData);
+
+/** Consume data from the pbuf list without copying it anywhere,
+ * e.g. once it has been dealt with in place after a call to
+ * uShortRangePbufListPeek(); pbufs that become empty are returned
+ * to their pool.
+ *
+ * @param[in] pBufList pointer to the pbuf list.
+ * @param len          the number of bytes to consume.
+ * @return             the number of bytes consumed, which will be
+ *                     less than len if the pbuf list held less.
+ */
+size_t uShortRangePbufListSkip(uShortRangePbufList_t *pBufList, size_t len);
+
 /** Link a new pbuf list to the existing pbuf list.
  *  The pointer allocated for the new pbuf list from the pbuf list pool
  *  will be added to its free list.
@@ -183,6 +320,15 @@ int32_t uShortRangePktListAppend(uShortRangePktList_t *pPktList,
  */
 int32_t uShortRangePktListConsumePacket(uShortRangePktList_t *pPktList, char *pData, size_t *pLen,
                                         int32_t *pEdmChannel);
+
+/** Remove the first packet from a packet list and free it without
+ * copying it anywhere, e.g. once it has been dealt with in place.
+ *
+ * @param[in,out] pPktList pointer to the packet list.
+ * @return                 zero on success or negative error code;
+ *                         #U_ERROR_COMMON_EMPTY if there is no packet.
+ */
+int32_t uShortRangePktListDropPacket(uShortRangePktList_t *pPktList);
 #ifdef __cplusplus
 }
 #endif
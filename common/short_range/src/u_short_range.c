@@ -171,6 +171,10 @@ static void removeShortRangeInstance(uShortRangePrivateInstance_t *pInstance)
         }
     }
 
+    uPortFree(pInstance->pWifiScanCache);
+    uPortFree(pInstance->pWifiConnectCache);
+    uPortFree(pInstance->pWifiLocCache);
+    uPortFree(pInstance->pPeerPool);
     uPortFree(pInstance);
 }
 
@@ -205,6 +209,11 @@ static int32_t uShortRangeAdd(uShortRangeModuleType_t moduleType,
             break;
         }
     }
+#ifdef U_CFG_SHORT_RANGE_MODULE_ONLY
+    if (moduleType != U_SHORT_RANGE_PRIVATE_MODULE_TYPE_ONLY) {
+        pModule = NULL;
+    }
+#endif
     if ((uShortRangeGetModuleInfo(moduleType) == NULL) ||
         (atHandle == NULL) || (pModule == NULL)) {
         return (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
@@ -517,6 +526,9 @@ static void UUDPD_urc(uAtClientHandle_t atHandle,
 
     connHandle = uAtClientReadInt(atHandle);
 
+    // If the peer was idle in the pool it is no more
+    uShortRangePrivatePeerPoolDisconnected(pInstance, connHandle);
+
     int32_t id = findFreeConnection(pInstance, connHandle);
 
     if (id != -1) {
@@ -867,7 +879,9 @@ int32_t uShortRangeOpenUart(uShortRangeModuleType_t moduleType,
         }
     }
 
-    if (moduleType != getModule(atClientHandle)) {
+    // uShortRangeDetectModule() has already checked the module type
+    // with AT+GMM if we didn't restart, no need to ask again
+    if (restart && (moduleType != getModule(atClientHandle))) {
         uShortRangeClose(*pDevHandle);
         return (int32_t)U_SHORT_RANGE_ERROR_INIT_INTERNAL;
     }
@@ -875,6 +889,80 @@ int32_t uShortRangeOpenUart(uShortRangeModuleType_t moduleType,
     return (int32_t) U_ERROR_COMMON_SUCCESS;
 }
 
+int32_t uShortRangePeerPoolFlush(uDeviceHandle_t devHandle)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+
+    if (gUShortRangePrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUShortRangePrivateMutex);
+
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUShortRangePrivateGetInstance(devHandle);
+        if (pInstance != NULL) {
+            errorCodeOrCount = uShortRangePrivatePeerPoolFlush(pInstance);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUShortRangePrivateMutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+int32_t uShortRangeCfgBatchStart(uDeviceHandle_t devHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+
+    if (gUShortRangePrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUShortRangePrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUShortRangePrivateGetInstance(devHandle);
+        if (pInstance != NULL) {
+            pInstance->cfgBatch = true;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUShortRangePrivateMutex);
+    }
+
+    return errorCode;
+}
+
+int32_t uShortRangeCfgBatchEnd(uDeviceHandle_t devHandle)
+{
+    int32_t errorCodeOrRestarted = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+
+    if (gUShortRangePrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUShortRangePrivateMutex);
+
+        errorCodeOrRestarted = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUShortRangePrivateGetInstance(devHandle);
+        if (pInstance != NULL) {
+            pInstance->cfgBatch = false;
+            errorCodeOrRestarted = 0;
+            if (pInstance->cfgRestartPending) {
+                pInstance->cfgRestartPending = false;
+                errorCodeOrRestarted = uShortRangePrivateStoreAndRestart(pInstance,
+                                                                         pInstance->cfgRestartWaitMs);
+                pInstance->cfgRestartWaitMs = 0;
+                if (errorCodeOrRestarted == 0) {
+                    errorCodeOrRestarted = 1;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUShortRangePrivateMutex);
+    }
+
+    return errorCodeOrRestarted;
+}
+
 void uShortRangeClose(uDeviceHandle_t devHandle)
 {
     uShortRangePrivateInstance_t *pInstance;
@@ -887,6 +975,8 @@ void uShortRangeClose(uDeviceHandle_t devHandle)
     pInstance = pUShortRangePrivateGetInstance(devHandle);
 
     if (pInstance != NULL) {
+        // Close any idle peers while we can still talk to the module
+        uShortRangePrivatePeerPoolFlush(pInstance);
         uAtClientIgnoreAsync(pInstance->atHandle);
         uShortRangeEdmStreamClose(pInstance->streamHandle);
         uShortRangeEdmStreamDeinit();
@@ -54,41 +54,36 @@
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
-typedef enum {
-    EDM_PARSER_STATE_PARSE_START_BYTE,
-    EDM_PARSER_STATE_PARSE_PAYLOAD_LENGTH,
-    EDM_PARSER_STATE_PARSE_HEADER_LENGTH,
-    EDM_PARSER_STATE_ALLOCATE_PBUFLIST,
-    EDM_PARSER_STATE_ALLOCATE_PAYLOAD,
-    EDM_PARSER_STATE_ACCUMULATE_PAYLOAD,
-    EDM_PARSER_STATE_PARSE_TAIL_BYTE,
-    EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING
-} edmParserState_t;
 
 /* ----------------------------------------------------------------
  * STATIC PROTOTYPES
  * -------------------------------------------------------------- */
 static int32_t getBtProfile(char value, uShortRangeBtProfile_t *profile);
 static int32_t getIpProtocol(char value, uShortRangeIpProtocol_t *protocol);
-static uShortRangeEdmEvent_t *allocateEdmEvent(void);
-static uShortRangeEdmEvent_t *parseConnectBtEvent(uint8_t channel, char *buffer,
+static uShortRangeEdmEvent_t *parseConnectBtEvent(uShortRangeEdmParser_t *pParser,
+                                                  uint8_t channel, char *buffer,
                                                   uint16_t payloadLength);
-static uShortRangeEdmEvent_t *parseConnectIpv4Event(uint8_t channel, char *buffer,
+static uShortRangeEdmEvent_t *parseConnectIpv4Event(uShortRangeEdmParser_t *pParser,
+                                                    uint8_t channel, char *buffer,
                                                     uint16_t payloadLength);
-static uShortRangeEdmEvent_t *parseConnectIpv6Event(uint8_t channel, char *buffer,
+static uShortRangeEdmEvent_t *parseConnectIpv6Event(uShortRangeEdmParser_t *pParser,
+                                                    uint8_t channel, char *buffer,
                                                     uint16_t payloadLength);
-static uShortRangeEdmEvent_t *parseConnectEvent(uint8_t channel, uShortRangePbufList_t *pBufList);
-static uShortRangeEdmEvent_t *parseDisconnectEvent(uint8_t channel);
-static uShortRangeEdmEvent_t *parseDataEvent(uint8_t channel, uShortRangePbufList_t *pBufList);
-static uShortRangeEdmEvent_t *parseAtResponseOrEvent(uShortRangePbufList_t *pBufList);
-static uShortRangeEdmEvent_t *parseEdmPayload(uint16_t idAndType, uint8_t channel,
+static uShortRangeEdmEvent_t *parseConnectEvent(uShortRangeEdmParser_t *pParser,
+                                                uint8_t channel, uShortRangePbufList_t *pBufList);
+static uShortRangeEdmEvent_t *parseDisconnectEvent(uShortRangeEdmParser_t *pParser,
+                                                   uint8_t channel);
+static uShortRangeEdmEvent_t *parseDataEvent(uShortRangeEdmParser_t *pParser,
+                                             uint8_t channel, uShortRangePbufList_t *pBufList);
+static uShortRangeEdmEvent_t *parseAtResponseOrEvent(uShortRangeEdmParser_t *pParser,
+                                                     uShortRangePbufList_t *pBufList);
+static uShortRangeEdmEvent_t *parseEdmPayload(uShortRangeEdmParser_t *pParser,
+                                              uint16_t idAndType, uint8_t channel,
                                               uShortRangePbufList_t *pBufList);
 
 /* ----------------------------------------------------------------
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
-static edmParserState_t gEdmParserState = EDM_PARSER_STATE_PARSE_START_BYTE;
-static uShortRangePbufList_t *gCurPBufList = NULL;
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -130,14 +125,8 @@ static int32_t getIpProtocol(char value, uShortRangeIpProtocol_t *pProtocol)
     return U_SHORT_RANGE_EDM_OK;
 }
 
-static uShortRangeEdmEvent_t *allocateEdmEvent(void)
-{
-    static uShortRangeEdmEvent_t gEdmEvent;
-
-    return &gEdmEvent;
-}
-
-static uShortRangeEdmEvent_t *parseConnectBtEvent(uint8_t channel, char *pBuffer,
+static uShortRangeEdmEvent_t *parseConnectBtEvent(uShortRangeEdmParser_t *pParser,
+                                                  uint8_t channel, char *pBuffer,
                                                   uint16_t payloadLength)
 {
     uShortRangeEdmEvent_t *pEvent = NULL;
@@ -146,7 +135,7 @@ static uShortRangeEdmEvent_t *parseConnectBtEvent(uint8_t channel, char *pBuffer
 
     if ((payloadLength == 10) && (result == U_SHORT_RANGE_EDM_OK)) {
         uShortRangeEdmConnectionEventBt_t *pEvtData;
-        pEvent = allocateEdmEvent();
+        pEvent = &pParser->event;
         pEvent->type = U_SHORT_RANGE_EDM_EVENT_CONNECT_BT;
         pEvtData = &pEvent->params.btConnectEvent;
         pEvtData->channel = channel;
@@ -159,7 +148,8 @@ static uShortRangeEdmEvent_t *parseConnectBtEvent(uint8_t channel, char *pBuffer
     return pEvent;
 }
 
-static uShortRangeEdmEvent_t *parseConnectIpv4Event(uint8_t channel, char *pBuffer,
+static uShortRangeEdmEvent_t *parseConnectIpv4Event(uShortRangeEdmParser_t *pParser,
+                                                    uint8_t channel, char *pBuffer,
                                                     uint16_t payloadLength)
 {
     uShortRangeEdmEvent_t *pEvent = NULL;
@@ -168,7 +158,7 @@ static uShortRangeEdmEvent_t *parseConnectIpv4Event(uint8_t channel, char *pBuff
 
     if ((payloadLength == 14) && (result == U_SHORT_RANGE_EDM_OK)) {
         uShortRangeEdmConnectionEventIpv4_t *pEvtData;
-        pEvent = allocateEdmEvent();
+        pEvent = &pParser->event;
         pEvent->type = U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv4;
         pEvtData = &pEvent->params.ipv4ConnectEvent;
         pEvtData->channel = channel;
@@ -186,7 +176,8 @@ static uShortRangeEdmEvent_t *parseConnectIpv4Event(uint8_t channel, char *pBuff
     return pEvent;
 }
 
-static uShortRangeEdmEvent_t *parseConnectIpv6Event(uint8_t channel, char *pBuffer,
+static uShortRangeEdmEvent_t *parseConnectIpv6Event(uShortRangeEdmParser_t *pParser,
+                                                    uint8_t channel, char *pBuffer,
                                                     uint16_t payloadLength)
 {
     uShortRangeEdmEvent_t *pEvent = NULL;
@@ -195,7 +186,7 @@ static uShortRangeEdmEvent_t *parseConnectIpv6Event(uint8_t channel, char *pBuff
 
     if ((payloadLength == 38) && (result == U_SHORT_RANGE_EDM_OK)) {
         uShortRangeEdmConnectionEventIpv6_t *pEvtData;
-        pEvent = allocateEdmEvent();
+        pEvent = &pParser->event;
         pEvent->type = U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv6;
         pEvtData = &pEvent->params.ipv6ConnectEvent;
         pEvtData->channel = channel;
@@ -213,7 +204,8 @@ static uShortRangeEdmEvent_t *parseConnectIpv6Event(uint8_t channel, char *pBuff
     return pEvent;
 }
 
-static uShortRangeEdmEvent_t *parseConnectEvent(uint8_t channel, uShortRangePbufList_t *pBufList)
+static uShortRangeEdmEvent_t *parseConnectEvent(uShortRangeEdmParser_t *pParser,
+                                                uint8_t channel, uShortRangePbufList_t *pBufList)
 {
     uShortRangeEdmEvent_t *pEvent = NULL;
     uint16_t payloadLength = 0;
@@ -229,15 +221,15 @@ static uShortRangeEdmEvent_t *parseConnectEvent(uint8_t channel, uShortRangePbuf
         switch (type) {
 
             case U_SHORT_RANGE_EDM_CONNECTION_TYPE_BT:
-                pEvent = parseConnectBtEvent(channel, pBuffer, payloadLength);
+                pEvent = parseConnectBtEvent(pParser, channel, pBuffer, payloadLength);
                 break;
 
             case U_SHORT_RANGE_EDM_CONNECTION_TYPE_IPv4:
-                pEvent = parseConnectIpv4Event(channel, pBuffer, payloadLength);
+                pEvent = parseConnectIpv4Event(pParser, channel, pBuffer, payloadLength);
                 break;
 
             case U_SHORT_RANGE_EDM_CONNECTION_TYPE_IPv6:
-                pEvent = parseConnectIpv6Event(channel, pBuffer, payloadLength);
+                pEvent = parseConnectIpv6Event(pParser, channel, pBuffer, payloadLength);
                 break;
 
             default:
@@ -248,23 +240,25 @@ static uShortRangeEdmEvent_t *parseConnectEvent(uint8_t channel, uShortRangePbuf
     return pEvent;
 }
 
-static uShortRangeEdmEvent_t *parseDisconnectEvent(uint8_t channel)
+static uShortRangeEdmEvent_t *parseDisconnectEvent(uShortRangeEdmParser_t *pParser,
+                                                   uint8_t channel)
 {
     uShortRangeEdmEvent_t *pEvent;
 
-    pEvent = allocateEdmEvent();
+    pEvent = &pParser->event;
     pEvent->type = U_SHORT_RANGE_EDM_EVENT_DISCONNECT;
     pEvent->params.disconnectEvent.channel = channel;
 
     return pEvent;
 }
 
-static uShortRangeEdmEvent_t *parseDataEvent(uint8_t channel, uShortRangePbufList_t *pBufList)
+static uShortRangeEdmEvent_t *parseDataEvent(uShortRangeEdmParser_t *pParser,
+                                             uint8_t channel, uShortRangePbufList_t *pBufList)
 {
     uShortRangeEdmEvent_t *pEvent = NULL;
 
     if ((pBufList != NULL) && (pBufList->totalLen > 0)) {
-        pEvent = allocateEdmEvent();
+        pEvent = &pParser->event;
         pEvent->type = U_SHORT_RANGE_EDM_EVENT_DATA;
         pEvent->params.dataEvent.channel = channel;
         pEvent->params.dataEvent.pBufList = pBufList;
@@ -273,15 +267,17 @@ static uShortRangeEdmEvent_t *parseDataEvent(uint8_t channel, uShortRangePbufLis
     return pEvent;
 }
 
-static uShortRangeEdmEvent_t *parseAtResponseOrEvent(uShortRangePbufList_t *pBufList)
+static uShortRangeEdmEvent_t *parseAtResponseOrEvent(uShortRangeEdmParser_t *pParser,
+                                                     uShortRangePbufList_t *pBufList)
 {
-    uShortRangeEdmEvent_t *pEvent = allocateEdmEvent();
+    uShortRangeEdmEvent_t *pEvent = &pParser->event;
     pEvent->type = U_SHORT_RANGE_EDM_EVENT_AT;
     pEvent->params.atEvent.pBufList = pBufList;
     return pEvent;
 }
 
-static uShortRangeEdmEvent_t *parseEdmPayload(uint16_t idAndType, uint8_t channel,
+static uShortRangeEdmEvent_t *parseEdmPayload(uShortRangeEdmParser_t *pParser,
+                                              uint16_t idAndType, uint8_t channel,
                                               uShortRangePbufList_t *pBufList)
 {
     uShortRangeEdmEvent_t *pEvent = NULL;
@@ -289,26 +285,26 @@ static uShortRangeEdmEvent_t *parseEdmPayload(uint16_t idAndType, uint8_t channe
     switch (idAndType) {
 
         case U_SHORT_RANGE_EDM_TYPE_CONNECT_EVENT:
-            pEvent = parseConnectEvent(channel, pBufList);
+            pEvent = parseConnectEvent(pParser, channel, pBufList);
             uShortRangePbufListFree(pBufList);
             break;
 
         case U_SHORT_RANGE_EDM_TYPE_DISCONNECT_EVENT:
-            pEvent = parseDisconnectEvent(channel);
+            pEvent = parseDisconnectEvent(pParser, channel);
             uShortRangePbufListFree(pBufList);
             break;
 
         case U_SHORT_RANGE_EDM_TYPE_DATA_EVENT:
-            pEvent = parseDataEvent(channel, pBufList);
+            pEvent = parseDataEvent(pParser, channel, pBufList);
             break;
 
         case U_SHORT_RANGE_EDM_TYPE_AT_RESPONSE:
         case U_SHORT_RANGE_EDM_TYPE_AT_EVENT:
-            pEvent = parseAtResponseOrEvent(pBufList);
+            pEvent = parseAtResponseOrEvent(pParser, pBufList);
             break;
 
         case U_SHORT_RANGE_EDM_TYPE_START_EVENT:
-            pEvent = allocateEdmEvent();
+            pEvent = &pParser->event;
             pEvent->type = U_SHORT_RANGE_EDM_EVENT_STARTUP;
             break;
         //lint -e825
@@ -325,100 +321,103 @@ static uShortRangeEdmEvent_t *parseEdmPayload(uint16_t idAndType, uint8_t channe
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
-bool uShortRangeEdmParserReady(void)
+void uShortRangeEdmParserInit(uShortRangeEdmParser_t *pParser,
+                              uShortRangePbufPool_t *pPool)
+{
+    memset(pParser, 0, sizeof(*pParser));
+    pParser->state = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE;
+    pParser->pPool = pPool;
+}
+
+bool uShortRangeEdmParserReady(const uShortRangeEdmParser_t *pParser)
 {
-    return (gEdmParserState != EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING);
+    return (pParser->state != U_SHORT_RANGE_EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING);
 }
 
-void uShortRangeEdmResetParser(void)
+void uShortRangeEdmResetParser(uShortRangeEdmParser_t *pParser)
 {
-    gEdmParserState = EDM_PARSER_STATE_PARSE_START_BYTE;
+    pParser->state = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE;
 }
 
-bool uShortRangeEdmParse(char c, uShortRangeEdmEvent_t **ppResultEvent, bool *pMemAvailable)
+bool uShortRangeEdmParse(uShortRangeEdmParser_t *pParser, char c,
+                         uShortRangeEdmEvent_t **ppResultEvent, bool *pMemAvailable)
 {
-    edmParserState_t newState = gEdmParserState;
-    static uint16_t payloadLength;
-    static uShortRangePbuf_t *pBuf;
-    static int32_t pBufSize;
-    static char header[U_SHORT_RANGE_EDM_HEADER_SIZE];
-    static uint32_t headerIndex;
-    static uint16_t idAndType;
-    static uint8_t channel;
+    uShortRangeEdmParserState_t newState = pParser->state;
     bool charConsumed = false;
     int32_t result;
 
     *pMemAvailable = true;
-    switch (gEdmParserState) {
+    switch (pParser->state) {
 
-        case EDM_PARSER_STATE_PARSE_START_BYTE:
+        case U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE:
             if (c == U_SHORT_RANGE_EDM_HEAD) {
-                headerIndex = 0;
-                newState = EDM_PARSER_STATE_PARSE_PAYLOAD_LENGTH;
+                pParser->headerIndex = 0;
+                newState = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_PAYLOAD_LENGTH;
             }
             charConsumed = true;
             break;
 
-        case EDM_PARSER_STATE_PARSE_PAYLOAD_LENGTH:
-            if (headerIndex == 0) {
-                payloadLength = (uint16_t)(uint8_t)c << 8;
-                headerIndex++;
+        case U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_PAYLOAD_LENGTH:
+            if (pParser->headerIndex == 0) {
+                pParser->payloadLength = (uint16_t)(uint8_t)c << 8;
+                pParser->headerIndex++;
             } else {
-                payloadLength |= (uint16_t)(uint8_t)c;
-                if (payloadLength < 2) {
+                pParser->payloadLength |= (uint16_t)(uint8_t)c;
+                if (pParser->payloadLength < 2) {
                     // Something is wrong, start over
-                    newState = EDM_PARSER_STATE_PARSE_START_BYTE;
+                    newState = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE;
                 } else {
-                    headerIndex = 0;
-                    newState = EDM_PARSER_STATE_PARSE_HEADER_LENGTH;
+                    pParser->headerIndex = 0;
+                    newState = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_HEADER_LENGTH;
                 }
             }
             charConsumed = true;
             break;
-        case EDM_PARSER_STATE_PARSE_HEADER_LENGTH:
-            header[headerIndex++] = c;
-            payloadLength--;
+        case U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_HEADER_LENGTH:
+            pParser->header[pParser->headerIndex++] = c;
+            pParser->payloadLength--;
 
-            if (headerIndex == 2) {
+            if (pParser->headerIndex == 2) {
 
-                idAndType = ((uint16_t)(uint8_t)header[0] << 8) | (uint16_t)(uint8_t)header[1];
+                pParser->idAndType = ((uint16_t)(uint8_t)pParser->header[0] << 8) |
+                                     (uint16_t)(uint8_t)pParser->header[1];
 
-                if ((idAndType == U_SHORT_RANGE_EDM_TYPE_AT_RESPONSE) ||
-                    (idAndType == U_SHORT_RANGE_EDM_TYPE_AT_EVENT)    ||
-                    (idAndType == U_SHORT_RANGE_EDM_TYPE_START_EVENT) ||
-                    (idAndType == U_SHORT_RANGE_EDM_TYPE_AT_REQUEST)) {
+                if ((pParser->idAndType == U_SHORT_RANGE_EDM_TYPE_AT_RESPONSE) ||
+                    (pParser->idAndType == U_SHORT_RANGE_EDM_TYPE_AT_EVENT)    ||
+                    (pParser->idAndType == U_SHORT_RANGE_EDM_TYPE_START_EVENT) ||
+                    (pParser->idAndType == U_SHORT_RANGE_EDM_TYPE_AT_REQUEST)) {
 
                     // Channel does not exist for these types so
                     // fill in -1
-                    header[headerIndex++] = -1;
+                    pParser->header[pParser->headerIndex++] = -1;
                 }
             }
 
-            if (headerIndex == U_SHORT_RANGE_EDM_HEADER_SIZE) {
-                channel = header[2];
+            if (pParser->headerIndex == U_SHORT_RANGE_EDM_HEADER_SIZE) {
+                pParser->channel = pParser->header[2];
                 // gCurPBufChain should always be NULL here
                 // If it's not we have a leak
-                U_ASSERT(gCurPBufList == NULL);
-                pBuf = NULL;
-                newState = EDM_PARSER_STATE_ALLOCATE_PBUFLIST;
+                U_ASSERT(pParser->pCurPBufList == NULL);
+                pParser->pBuf = NULL;
+                newState = U_SHORT_RANGE_EDM_PARSER_STATE_ALLOCATE_PBUFLIST;
                 // For disconnect event there is no payload
                 // so directly head to parse tail byte
-                if ((idAndType == U_SHORT_RANGE_EDM_TYPE_DISCONNECT_EVENT) ||
-                    (idAndType == U_SHORT_RANGE_EDM_TYPE_START_EVENT)) {
-                    newState = EDM_PARSER_STATE_PARSE_TAIL_BYTE;
+                if ((pParser->idAndType == U_SHORT_RANGE_EDM_TYPE_DISCONNECT_EVENT) ||
+                    (pParser->idAndType == U_SHORT_RANGE_EDM_TYPE_START_EVENT)) {
+                    newState = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_TAIL_BYTE;
                 }
             }
             charConsumed = true;
             break;
 
-        case EDM_PARSER_STATE_ALLOCATE_PBUFLIST:
+        case U_SHORT_RANGE_EDM_PARSER_STATE_ALLOCATE_PBUFLIST:
 
             // if allocation fails stay back until
             // we have some free memory in their respective pool
-            gCurPBufList = pUShortRangePbufListAlloc();
-            if (gCurPBufList != NULL) {
-                gCurPBufList->edmChannel = channel;
-                newState = EDM_PARSER_STATE_ALLOCATE_PAYLOAD;
+            pParser->pCurPBufList = pUShortRangePbufPoolListAlloc(pParser->pPool);
+            if (pParser->pCurPBufList != NULL) {
+                pParser->pCurPBufList->edmChannel = pParser->channel;
+                newState = U_SHORT_RANGE_EDM_PARSER_STATE_ALLOCATE_PAYLOAD;
             } else {
                 *pMemAvailable = false; // remain at same state, try again later
             }
@@ -426,14 +425,14 @@ bool uShortRangeEdmParse(char c, uShortRangeEdmEvent_t **ppResultEvent, bool *pM
             charConsumed = false;
             break;
 
-        case EDM_PARSER_STATE_ALLOCATE_PAYLOAD:
+        case U_SHORT_RANGE_EDM_PARSER_STATE_ALLOCATE_PAYLOAD:
 
             // if allocation fails stay back until
             // we have some free memory in their respective pool
-            pBufSize = uShortRangePbufAlloc(&pBuf);
-            if (pBufSize > 0) {
-                headerIndex = 0;
-                newState = EDM_PARSER_STATE_ACCUMULATE_PAYLOAD;
+            pParser->pBufSize = uShortRangePbufPoolAlloc(pParser->pPool, &pParser->pBuf);
+            if (pParser->pBufSize > 0) {
+                pParser->headerIndex = 0;
+                newState = U_SHORT_RANGE_EDM_PARSER_STATE_ACCUMULATE_PAYLOAD;
             } else {
                 *pMemAvailable = false; // remain at same state, try again later
             }
@@ -441,54 +440,55 @@ bool uShortRangeEdmParse(char c, uShortRangeEdmEvent_t **ppResultEvent, bool *pM
             charConsumed = false;
             break;
 
-        case EDM_PARSER_STATE_ACCUMULATE_PAYLOAD:
+        case U_SHORT_RANGE_EDM_PARSER_STATE_ACCUMULATE_PAYLOAD:
 
-            U_ASSERT(pBufSize > 0);
-            U_ASSERT(pBuf != NULL);
-            U_ASSERT(pBuf->length < pBufSize);
+            U_ASSERT(pParser->pBufSize > 0);
+            U_ASSERT(pParser->pBuf != NULL);
+            U_ASSERT(pParser->pBuf->length < pParser->pBufSize);
 
-            pBuf->data[pBuf->length++] = c;
-            payloadLength--;
+            pParser->pBuf->data[pParser->pBuf->length++] = c;
+            pParser->payloadLength--;
 
-            if ((pBuf->length == pBufSize) ||
-                (payloadLength == 0)) {
-                result = uShortRangePbufListAppend(gCurPBufList, pBuf);
+            if ((pParser->pBuf->length == pParser->pBufSize) ||
+                (pParser->payloadLength == 0)) {
+                result = uShortRangePbufListAppend(pParser->pCurPBufList, pParser->pBuf);
                 U_ASSERT(result == 0);
-                if (payloadLength == 0) {
-                    newState = EDM_PARSER_STATE_PARSE_TAIL_BYTE;
-                } else if (pBuf->length == pBufSize) {
+                if (pParser->payloadLength == 0) {
+                    newState = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_TAIL_BYTE;
+                } else if (pParser->pBuf->length == pParser->pBufSize) {
                     // we have some more data coming in
                     // so allocate memory for payload
-                    newState = EDM_PARSER_STATE_ALLOCATE_PAYLOAD;
+                    newState = U_SHORT_RANGE_EDM_PARSER_STATE_ALLOCATE_PAYLOAD;
                 }
-                pBuf = NULL;
+                pParser->pBuf = NULL;
             }
             charConsumed = true;
             break;
 
-        case EDM_PARSER_STATE_PARSE_TAIL_BYTE:
-            newState = EDM_PARSER_STATE_PARSE_START_BYTE;
+        case U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_TAIL_BYTE:
+            newState = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE;
             if (c == U_SHORT_RANGE_EDM_TAIL) {
                 if (ppResultEvent != NULL) {
-                    *ppResultEvent = parseEdmPayload(idAndType, channel, gCurPBufList);
+                    *ppResultEvent = parseEdmPayload(pParser, pParser->idAndType, pParser->channel,
+                                                     pParser->pCurPBufList);
                     if (*ppResultEvent == NULL) {
                         // No event was generated
                         // Reset parser
-                        newState = EDM_PARSER_STATE_PARSE_START_BYTE;
+                        newState = U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE;
                     } else {
-                        newState = EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING;
+                        newState = U_SHORT_RANGE_EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING;
                     }
                 }
             }
-            if (newState == EDM_PARSER_STATE_PARSE_START_BYTE) {
+            if (newState == U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE) {
                 // Always de-allocate the buffer when we reset the parser
-                uShortRangePbufListFree(gCurPBufList);
+                uShortRangePbufListFree(pParser->pCurPBufList);
             }
-            gCurPBufList = NULL;
+            pParser->pCurPBufList = NULL;
             charConsumed = true;
             break;
 
-        case EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING:
+        case U_SHORT_RANGE_EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING:
             // Parser will stay in this state until parser is reset.
             // This to avoid the parser overwriting data in an unprocessed event
             // Any user of the parser thus have to reset the parser when it has
@@ -496,11 +496,61 @@ bool uShortRangeEdmParse(char c, uShortRangeEdmEvent_t **ppResultEvent, bool *pM
             break;
     }
 
-    gEdmParserState = newState;
+    pParser->state = newState;
 
     return charConsumed;
 }
 
+size_t uShortRangeEdmParseBuffer(uShortRangeEdmParser_t *pParser,
+                                 const char *pBuffer, size_t length,
+                                 uShortRangeEdmEvent_t **ppResultEvent,
+                                 bool *pMemAvailable)
+{
+    size_t consumed = 0;
+    const char *pStart;
+    size_t x;
+
+    *ppResultEvent = NULL;
+    *pMemAvailable = true;
+    while ((consumed < length) && uShortRangeEdmParserReady(pParser) &&
+           *pMemAvailable && (*ppResultEvent == NULL)) {
+        if (pParser->state == U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE) {
+            // Skip everything up to the next start byte in one go
+            pStart = (const char *) memchr(pBuffer + consumed, (uint8_t) U_SHORT_RANGE_EDM_HEAD,
+                                           length - consumed);
+            if (pStart == NULL) {
+                consumed = length;
+                continue;
+            }
+            consumed = pStart - pBuffer;
+        } else if (pParser->state == U_SHORT_RANGE_EDM_PARSER_STATE_ACCUMULATE_PAYLOAD) {
+            // Copy all but the last of as much payload as will fit in the
+            // pbuf in one go, leaving the last byte for uShortRangeEdmParse()
+            // so that it takes care of what happens when the pbuf is
+            // full or the payload is complete
+            x = length - consumed;
+            if (x > pParser->payloadLength) {
+                x = pParser->payloadLength;
+            }
+            if (x > (size_t) (pParser->pBufSize - pParser->pBuf->length)) {
+                x = pParser->pBufSize - pParser->pBuf->length;
+            }
+            if (x > 1) {
+                x--;
+                memcpy(&pParser->pBuf->data[pParser->pBuf->length], pBuffer + consumed, x);
+                pParser->pBuf->length += (uint16_t) x;
+                pParser->payloadLength -= (uint16_t) x;
+                consumed += x;
+            }
+        }
+        if (uShortRangeEdmParse(pParser, pBuffer[consumed], ppResultEvent, pMemAvailable)) {
+            consumed++;
+        }
+    }
+
+    return consumed;
+}
+
 int32_t uShortRangeEdmZeroCopyHeadData(uint8_t channel, uint32_t size, char *pHead)
 {
     if (pHead == NULL || size > U_SHORT_RANGE_EDM_MAX_SIZE) {
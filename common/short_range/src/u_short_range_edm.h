@@ -48,6 +48,17 @@
 #define U_SHORT_RANGE_EDM_BLK_SIZE            64
 #define U_SHORT_RANGE_EDM_BLK_COUNT           (U_SHORT_RANGE_EDM_MAX_SIZE / U_SHORT_RANGE_EDM_BLK_SIZE)
 
+typedef enum {
+    U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_START_BYTE,
+    U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_PAYLOAD_LENGTH,
+    U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_HEADER_LENGTH,
+    U_SHORT_RANGE_EDM_PARSER_STATE_ALLOCATE_PBUFLIST,
+    U_SHORT_RANGE_EDM_PARSER_STATE_ALLOCATE_PAYLOAD,
+    U_SHORT_RANGE_EDM_PARSER_STATE_ACCUMULATE_PAYLOAD,
+    U_SHORT_RANGE_EDM_PARSER_STATE_PARSE_TAIL_BYTE,
+    U_SHORT_RANGE_EDM_PARSER_STATE_WAIT_FOR_EVENT_PROCESSING
+} uShortRangeEdmParserState_t;
+
 typedef enum {
     U_SHORT_RANGE_EDM_EVENT_CONNECT_BT,
     U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv4,
@@ -99,6 +110,34 @@ typedef struct {
     } params;
 } uShortRangeEdmEvent_t;
 
+/** The state of an EDM parser, one per EDM stream; treat as
+ * private, initialise with uShortRangeEdmParserInit().
+ */
+typedef struct {
+    uShortRangeEdmParserState_t state;
+    uint16_t payloadLength;
+    uShortRangePbuf_t *pBuf;
+    int32_t pBufSize;
+    char header[U_SHORT_RANGE_EDM_HEADER_SIZE];
+    uint32_t headerIndex;
+    uint16_t idAndType;
+    uint8_t channel;
+    uShortRangePbufList_t *pCurPBufList;
+    uShortRangePbufPool_t *pPool;
+    uShortRangeEdmEvent_t event;
+} uShortRangeEdmParser_t;
+
+/**
+ *
+ * @brief Initialise an EDM parser.
+ *
+ * @param[out] pParser the parser to initialise.
+ * @param[in] pPool    the pool that the parser should allocate
+ *                     pbufs and pbuf lists from.
+ */
+void uShortRangeEdmParserInit(uShortRangeEdmParser_t *pParser,
+                              uShortRangePbufPool_t *pPool);
+
 /**
  *
  * @brief Check if EDM parser is available
@@ -106,16 +145,20 @@ typedef struct {
  * @note  Do not call the uShortRangeEdmParse function if this function
  *        returns false.
  *
+ * @param pParser the parser.
+ *
  * @return True if EDM parser is available
  */
-bool uShortRangeEdmParserReady(void);
+bool uShortRangeEdmParserReady(const uShortRangeEdmParser_t *pParser);
 
 /**
  *
  * @brief Reset the parser. Do this every time the latest EDM event
  *        has been processed to make the parser available again.
+ *
+ * @param pParser the parser.
  */
-void uShortRangeEdmResetParser(void);
+void uShortRangeEdmResetParser(uShortRangeEdmParser_t *pParser);
 
 /**
  *
@@ -125,6 +168,8 @@ void uShortRangeEdmResetParser(void);
  *        Check if parser is available with uShortRangeEdmParserAvailable
  *        If a packet is invalid it will be silently dropped.
  *
+ * @param pParser the parser.
+ *
  * @param c Input character.
  *
  * @param[out] ppResultEvent Address of pointer to event, NULL if no event was generated
@@ -135,7 +180,36 @@ void uShortRangeEdmResetParser(void);
  *
  * @return True when input character c is consumed else false.
  */
-bool uShortRangeEdmParse(char c, uShortRangeEdmEvent_t **ppResultEvent, bool *pMemAvailable);
+bool uShortRangeEdmParse(uShortRangeEdmParser_t *pParser, char c,
+                         uShortRangeEdmEvent_t **ppResultEvent, bool *pMemAvailable);
+
+/**
+ *
+ * @brief Function for parsing a buffer of binary EDM data, with the
+ *        same outcome as calling uShortRangeEdmParse() for each
+ *        character in turn but faster: the start byte of a packet
+ *        is searched for with memchr() and payload is copied into
+ *        pbufs in bulk.  Parsing stops at the end of the buffer,
+ *        when an event is generated or when memory runs out.
+ *
+ * @note  Do not call this function if parser is not available.
+ *
+ * @param pParser the parser.
+ *
+ * @param pBuffer the input characters.
+ *
+ * @param length  the number of characters at pBuffer.
+ *
+ * @param[out] ppResultEvent Address of pointer to event, NULL if no event was generated.
+ *
+ * @param[out] pMemAvailable Pointer to a boolean that indicates if memory was allocated successfully.
+ *
+ * @return The number of characters of pBuffer consumed.
+ */
+size_t uShortRangeEdmParseBuffer(uShortRangeEdmParser_t *pParser,
+                                 const char *pBuffer, size_t length,
+                                 uShortRangeEdmEvent_t **ppResultEvent,
+                                 bool *pMemAvailable);
 
 /**
  *
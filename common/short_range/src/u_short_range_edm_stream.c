@@ -39,6 +39,7 @@
 #include "u_port_event_queue.h"
 #include "u_port_uart.h"
 #include "u_port_debug.h"
+#include "u_log_ram_trace.h" // U_LOG_RAM_TRACE_XXX()
 #include "u_at_client.h"
 #include "u_short_range_pbuf.h"
 #include "u_short_range_module_type.h"
@@ -64,6 +65,13 @@
 // TODO: is this value correct?
 #define U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH 500
 #define U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS    9
+#define U_SHORT_RANGE_EDM_STREAM_UART_BUFFER_LENGTH 128
+
+#ifndef U_SHORT_RANGE_EDM_STREAM_DATA_BATCH_MAX
+// The maximum number of received data packets that are passed to
+// the event task in a single event.
+# define U_SHORT_RANGE_EDM_STREAM_DATA_BATCH_MAX 16
+#endif
 
 #ifndef U_EDM_STREAM_TASK_STACK_SIZE_BYTES
 #define U_EDM_STREAM_TASK_STACK_SIZE_BYTES  U_AT_CLIENT_URC_TASK_STACK_SIZE_BYTES
@@ -145,12 +153,14 @@ typedef struct {
     uShortRangeConnectDataIp_t conData;
 } uShortRangeEdmStreamIpEvent_t;
 
+// One or more received data packets, chained through pNext, each
+// carrying its own EDM channel.
 typedef struct {
-    int32_t channel;
     uShortRangePbufList_t *pBufList;
 } uShortRangeEdmStreamDataEvent_t;
 
 typedef struct {
+    struct uEdmStreamInstance_t *pInstance;
     uShortRangeEdmStreamEventType_t type;
     union {
         // no content in at event       at;
@@ -174,6 +184,7 @@ typedef struct {
 } uShortRangeEdmStreamConnections_t;
 
 typedef struct uEdmStreamInstance_t {
+    uPortMutexHandle_t mutex;
     bool ignoreUartCallback;
     int32_t handle;
     int32_t uartHandle;
@@ -199,14 +210,32 @@ typedef struct uEdmStreamInstance_t {
     int32_t atResponseLength;
     int32_t atResponseRead;
     uShortRangeEdmStreamConnections_t connections[U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS];
+    uShortRangePbufPool_t *pPool;
+    uShortRangeEdmParser_t parser;
+    // Characters read from the UART but not yet parsed
+    char uartBuffer[U_SHORT_RANGE_EDM_STREAM_UART_BUFFER_LENGTH];
+    size_t uartBufferCount;
+    // EDM data frames gathered for a single UART write, if
+    // U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH is non-zero
+    char *pTxBuffer;
+    size_t txBufferCount;
+    // Data packets parsed but not yet passed to the event task
+    uShortRangePbufList_t *pDataBatchHead;
+    uShortRangePbufList_t *pDataBatchTail;
+    size_t dataBatchCount;
 } uShortRangeEdmStreamInstance_t;
 
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
 
-static uPortMutexHandle_t gMutex = NULL;
-static uShortRangeEdmStreamInstance_t gEdmStream;
+/** The EDM stream instances, the handle of an instance being its
+ * index; each has its own mutex, created by
+ * uShortRangeEdmStreamInit(), so that EDM streams never wait on
+ * one another.
+ */
+static uShortRangeEdmStreamInstance_t gEdmStream[U_SHORT_RANGE_EDM_STREAM_MAX_NUM];
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -274,14 +303,30 @@ static const char *getProtocolText(uShortRangeIpProtocol_t protocol)
 
 #endif
 
+// Get the instance for a handle, NULL if the handle is out of range
+// or uShortRangeEdmStreamInit() has not been called; the instance
+// is not locked and may not be open.
+static uShortRangeEdmStreamInstance_t *pGetInstance(int32_t handle)
+{
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+
+    if ((handle >= 0) && (handle < U_SHORT_RANGE_EDM_STREAM_MAX_NUM) &&
+        (gEdmStream[handle].mutex != NULL)) {
+        pInstance = &gEdmStream[handle];
+    }
+
+    return pInstance;
+}
+
 // Find connection from channel, use -1 to get the first free slot
-static uShortRangeEdmStreamConnections_t *findConnection(int32_t channel)
+static uShortRangeEdmStreamConnections_t *findConnection(uShortRangeEdmStreamInstance_t *pInstance,
+                                                         int32_t channel)
 {
     uShortRangeEdmStreamConnections_t *pConnection = NULL;
 
     for (uint32_t i = 0; i < U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS; i++) {
-        if (gEdmStream.connections[i].channel == channel) {
-            pConnection = &gEdmStream.connections[i];
+        if (pInstance->connections[i].channel == channel) {
+            pConnection = &pInstance->connections[i];
             break;
         }
     }
@@ -289,122 +334,149 @@ static uShortRangeEdmStreamConnections_t *findConnection(int32_t channel)
     return pConnection;
 }
 
-static void processedEvent(void)
+// Trigger an event from the uart to get parsing going again.
+static void kickUart(uShortRangeEdmStreamInstance_t *pInstance)
 {
     int32_t sendErrorCode;
 
-    uShortRangeEdmResetParser();
-    // Trigger an event from the uart to get parsing going again
     // First use the "try" version so as not to block, which can
     // lead to mutex lock-outs if the queue is full: if the "try"
     // version is not supported on this platform then fall back
     // to the blocking version; there is no danger here since,
     // if there are already events in the UART queue, the URC
     // callback will certainly be run anyway.
-    sendErrorCode = uPortUartEventTrySend(gEdmStream.uartHandle,
+    sendErrorCode = uPortUartEventTrySend(pInstance->uartHandle,
                                           U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
                                           0);
     if ((sendErrorCode == (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED) ||
         (sendErrorCode == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED)) {
-        uPortUartEventSend(gEdmStream.uartHandle,
+        uPortUartEventSend(pInstance->uartHandle,
                            U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED);
     }
 }
 
-static void atEventHandler(void)
+static void processedEvent(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    uShortRangeEdmResetParser(&pInstance->parser);
+    kickUart(pInstance);
+}
+
+static void atEventHandler(uShortRangeEdmStreamInstance_t *pInstance)
 {
-    if (gEdmStream.pAtCallback != NULL) {
-        gEdmStream.pAtCallback(gEdmStream.handle,
+    if (pInstance->pAtCallback != NULL) {
+        pInstance->pAtCallback(pInstance->handle,
                                U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
-                               gEdmStream.pAtCallbackParam);
+                               pInstance->pAtCallbackParam);
     }
     // This event is not fully processed until uShortRangeEdmStreamAtRead has been called
     // and all event data been read out
 }
 
 // Event handler, calls the user's event callback.
-static void btEventHandler(uShortRangeEdmStreamBtEvent_t *pBtEvent)
+static void btEventHandler(uShortRangeEdmStreamInstance_t *pInstance,
+                           uShortRangeEdmStreamBtEvent_t *pBtEvent)
 {
-    if (gEdmStream.pBtEventCallback != NULL) {
-        gEdmStream.pBtEventCallback(gEdmStream.handle, pBtEvent->channel, pBtEvent->type,
-                                    &pBtEvent->conData, gEdmStream.pBtEventCallbackParam);
+    if (pInstance->pBtEventCallback != NULL) {
+        pInstance->pBtEventCallback(pInstance->handle, pBtEvent->channel, pBtEvent->type,
+                                    &pBtEvent->conData, pInstance->pBtEventCallbackParam);
     }
     uEdmChLogLine(LOG_CH_BT, "processed");
-    processedEvent();
+    processedEvent(pInstance);
 }
 
 // Event handler, calls the user's event callback.
-static void ipEventHandler(uShortRangeEdmStreamIpEvent_t *pIpEvent)
+static void ipEventHandler(uShortRangeEdmStreamInstance_t *pInstance,
+                           uShortRangeEdmStreamIpEvent_t *pIpEvent)
 {
-    if (gEdmStream.pIpEventCallback != NULL) {
-        gEdmStream.pIpEventCallback(gEdmStream.handle, pIpEvent->channel, pIpEvent->type,
-                                    &pIpEvent->conData, gEdmStream.pIpEventCallbackParam);
+    if (pInstance->pIpEventCallback != NULL) {
+        pInstance->pIpEventCallback(pInstance->handle, pIpEvent->channel, pIpEvent->type,
+                                    &pIpEvent->conData, pInstance->pIpEventCallbackParam);
     }
 
     uEdmChLogLine(LOG_CH_IP, "processed");
-    processedEvent();
+    processedEvent(pInstance);
 }
 
 // Event handler, calls the user's event callback.
-static void mqttEventHandler(uShortRangeEdmStreamIpEvent_t *pMqttEvent)
+static void mqttEventHandler(uShortRangeEdmStreamInstance_t *pInstance,
+                             uShortRangeEdmStreamIpEvent_t *pMqttEvent)
 {
-    if (gEdmStream.pMqttEventCallback != NULL) {
-        gEdmStream.pMqttEventCallback(gEdmStream.handle, pMqttEvent->channel, pMqttEvent->type,
-                                      &pMqttEvent->conData, gEdmStream.pMqttEventCallbackParam);
+    if (pInstance->pMqttEventCallback != NULL) {
+        pInstance->pMqttEventCallback(pInstance->handle, pMqttEvent->channel, pMqttEvent->type,
+                                      &pMqttEvent->conData, pInstance->pMqttEventCallbackParam);
     }
     uEdmChLogLine(LOG_CH_IP, "processed");
-    processedEvent();
+    processedEvent(pInstance);
 }
 
-static void dataEventHandler(uShortRangeEdmStreamDataEvent_t *pDataEvent)
+static void dataEventHandler(uShortRangeEdmStreamInstance_t *pInstance,
+                             uShortRangeEdmStreamDataEvent_t *pDataEvent)
 {
     uShortRangeEdmStreamConnections_t *pConnection;
-    volatile uEdmDataEventCallback_t pDataCallback = NULL;
-    volatile void *pCallbackParam = NULL;
-    volatile int32_t edmStreamHandle = -1;
+    volatile uEdmDataEventCallback_t pDataCallback;
+    volatile void *pCallbackParam;
+    volatile int32_t edmStreamHandle;
+    uShortRangePbufList_t *pBufList;
+    uShortRangePbufList_t *pNext;
+    int32_t channel;
 
-    uPortMutexLock(gMutex);
-    pConnection = findConnection(pDataEvent->channel);
+    uPortMutexLock(pInstance->mutex);
+    for (pBufList = pDataEvent->pBufList; pBufList != NULL; pBufList = pNext) {
+        // Detach the packet from the batch before handing it on
+        pNext = pBufList->pNext;
+        pBufList->pNext = NULL;
+        channel = pBufList->edmChannel;
+        pDataCallback = NULL;
+        pCallbackParam = NULL;
+        edmStreamHandle = -1;
+        pConnection = findConnection(pInstance, channel);
 
-    if (pConnection != NULL) {
-        edmStreamHandle = gEdmStream.handle;
+        if (pConnection != NULL) {
+            edmStreamHandle = pInstance->handle;
 
-        switch (pConnection->type) {
+            switch (pConnection->type) {
 
-            case U_SHORT_RANGE_CONNECTION_TYPE_BT:
-                pDataCallback = gEdmStream.pBtDataCallback;
-                pCallbackParam = gEdmStream.pBtDataCallbackParam;
-                break;
+                case U_SHORT_RANGE_CONNECTION_TYPE_BT:
+                    pDataCallback = pInstance->pBtDataCallback;
+                    pCallbackParam = pInstance->pBtDataCallbackParam;
+                    break;
 
-            case U_SHORT_RANGE_CONNECTION_TYPE_IP:
-                pDataCallback = gEdmStream.pIpDataCallback;
-                pCallbackParam = gEdmStream.pIpDataCallbackParam;
-                break;
+                case U_SHORT_RANGE_CONNECTION_TYPE_IP:
+                    pDataCallback = pInstance->pIpDataCallback;
+                    pCallbackParam = pInstance->pIpDataCallbackParam;
+                    break;
 
-            case U_SHORT_RANGE_CONNECTION_TYPE_MQTT:
-                pDataCallback = gEdmStream.pMqttDataCallback;
-                pCallbackParam = gEdmStream.pMqttDataCallbackParam;
-                break;
+                case U_SHORT_RANGE_CONNECTION_TYPE_MQTT:
+                    pDataCallback = pInstance->pMqttDataCallback;
+                    pCallbackParam = pInstance->pMqttDataCallbackParam;
+                    break;
 
-            case U_SHORT_RANGE_CONNECTION_TYPE_INVALID:
-            default:
-                break;
+                case U_SHORT_RANGE_CONNECTION_TYPE_INVALID:
+                default:
+                    break;
+            }
         }
-    }
 
-    if (pDataCallback != NULL) {
-        // Make sure we release the lock before calling the callback
-        // otherwise this may result in a deadlock
-        uPortMutexUnlock(gMutex);
-        //lint -e(1773) Suppress "attempt to cast away const"
-        pDataCallback(edmStreamHandle, pDataEvent->channel, pDataEvent->pBufList,
-                      (void *)pCallbackParam);
-        uPortMutexLock(gMutex);
+        if (pDataCallback != NULL) {
+            // Make sure we release the lock before calling the callback
+            // otherwise this may result in a deadlock
+            uPortMutexUnlock(pInstance->mutex);
+            //lint -e(1773) Suppress "attempt to cast away const"
+            pDataCallback(edmStreamHandle, channel, pBufList,
+                          (void *)pCallbackParam);
+            uPortMutexLock(pInstance->mutex);
+        } else {
+            // Nobody to take the data
+            uShortRangePbufListFree(pBufList);
+        }
     }
 
     uEdmChLogLine(LOG_CH_DATA, "processed");
-    processedEvent();
-    uPortMutexUnlock(gMutex);
+    // The parser was not held up by the batch, it carries on
+    // parsing while the batch is handled; just make sure that it
+    // has another go in case it ran out of pbufs in the meantime
+    kickUart(pInstance);
+    uPortMutexUnlock(pInstance->mutex);
 }
 
 static void eventHandler(void *pParam, size_t paramLength)
@@ -412,30 +484,30 @@ static void eventHandler(void *pParam, size_t paramLength)
     uShortRangeEdmStreamEvent_t *pEvent = (uShortRangeEdmStreamEvent_t *)pParam;
     (void)paramLength;
 
-    if (pEvent == NULL) {
+    if ((pEvent == NULL) || (pEvent->pInstance == NULL)) {
         return;
     }
 
     switch (pEvent->type) {
 
         case U_SHORT_RANGE_EDM_STREAM_EVENT_AT:
-            atEventHandler();
+            atEventHandler(pEvent->pInstance);
             break;
 
         case U_SHORT_RANGE_EDM_STREAM_EVENT_BT:
-            btEventHandler(&(pEvent->bt));
+            btEventHandler(pEvent->pInstance, &(pEvent->bt));
             break;
 
         case U_SHORT_RANGE_EDM_STREAM_EVENT_IP:
-            ipEventHandler(&(pEvent->ip));
+            ipEventHandler(pEvent->pInstance, &(pEvent->ip));
             break;
 
         case U_SHORT_RANGE_EDM_STREAM_EVENT_MQTT:
-            mqttEventHandler(&(pEvent->mqtt));
+            mqttEventHandler(pEvent->pInstance, &(pEvent->mqtt));
             break;
 
         case U_SHORT_RANGE_EDM_STREAM_EVENT_DATA:
-            dataEventHandler(&(pEvent->data));
+            dataEventHandler(pEvent->pInstance, &(pEvent->data));
             break;
 
         default:
@@ -443,26 +515,28 @@ static void eventHandler(void *pParam, size_t paramLength)
     }
 }
 
-static bool enqueueEdmAtEvent(uShortRangeEdmEvent_t *pEvent)
+static bool enqueueEdmAtEvent(uShortRangeEdmStreamInstance_t *pInstance,
+                              uShortRangeEdmEvent_t *pEvent)
 {
     bool success = false;
     uShortRangeEdmStreamEvent_t event = {0}; // Keep Valgrind happy
 
     uShortRangePbufList_t *pBufList = pEvent->params.atEvent.pBufList;
-    gEdmStream.atResponseLength = (int32_t)pBufList->totalLen;
-    gEdmStream.atResponseRead = 0;
-    uShortRangePbufListConsumeData(pBufList, gEdmStream.pAtResponseBuffer,
-                                   gEdmStream.atResponseLength);
+    pInstance->atResponseLength = (int32_t)pBufList->totalLen;
+    pInstance->atResponseRead = 0;
+    uShortRangePbufListConsumeData(pBufList, pInstance->pAtResponseBuffer,
+                                   pInstance->atResponseLength);
     uShortRangePbufListFree(pBufList);
 
 #ifdef U_CFG_SHORT_RANGE_EDM_STREAM_DEBUG
     uEdmChLogStart(LOG_CH_AT_RX, "\"");
-    dumpAtData(gEdmStream.pAtResponseBuffer, gEdmStream.atResponseLength);
+    dumpAtData(pInstance->pAtResponseBuffer, pInstance->atResponseLength);
     uEdmChLogEnd("\"");
 #endif
 
     event.type = U_SHORT_RANGE_EDM_STREAM_EVENT_AT;
-    if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
+    event.pInstance = pInstance;
+    if (uPortEventQueueSend(pInstance->eventQueueHandle,
                             &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
         success = true;
     } else {
@@ -472,15 +546,16 @@ static bool enqueueEdmAtEvent(uShortRangeEdmEvent_t *pEvent)
     return success;
 }
 
-static bool enqueueEdmConnectBtEvent(uShortRangeEdmEvent_t *pEvent)
+static bool enqueueEdmConnectBtEvent(uShortRangeEdmStreamInstance_t *pInstance,
+                                     uShortRangeEdmEvent_t *pEvent)
 {
     bool success = false;
 
     uShortRangeEdmStreamConnections_t *pConnection =
-        findConnection(pEvent->params.btConnectEvent.channel);
+        findConnection(pInstance, pEvent->params.btConnectEvent.channel);
 
     if (pConnection == NULL) {
-        pConnection = findConnection(-1);
+        pConnection = findConnection(pInstance, -1);
     }
     if (pConnection != NULL) {
         uShortRangeEdmStreamEvent_t event = {0}; // Keep Valgrind happy
@@ -499,7 +574,8 @@ static bool enqueueEdmConnectBtEvent(uShortRangeEdmEvent_t *pEvent)
         uEdmChLogEnd("");
 #endif
 
-        if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
+        event.pInstance = pInstance;
+        if (uPortEventQueueSend(pInstance->eventQueueHandle,
                                 &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
             success = true;
         } else {
@@ -510,15 +586,16 @@ static bool enqueueEdmConnectBtEvent(uShortRangeEdmEvent_t *pEvent)
     return success;
 }
 
-static bool enqueueEdmConnectIpv4Event(uShortRangeEdmEvent_t *pEvent)
+static bool enqueueEdmConnectIpv4Event(uShortRangeEdmStreamInstance_t *pInstance,
+                                       uShortRangeEdmEvent_t *pEvent)
 {
     bool success = false;
 
     uShortRangeEdmStreamConnections_t *pConnection =
-        findConnection(pEvent->params.ipv4ConnectEvent.channel);
+        findConnection(pInstance, pEvent->params.ipv4ConnectEvent.channel);
 
     if (pConnection == NULL) {
-        pConnection = findConnection(-1);
+        pConnection = findConnection(pInstance, -1);
     }
     if (pConnection != NULL) {
         uShortRangeEdmStreamEvent_t event = {0}; // Keep Valgrind happy
@@ -559,7 +636,8 @@ static bool enqueueEdmConnectIpv4Event(uShortRangeEdmEvent_t *pEvent)
                           rIp[0], rIp[1], rIp[2], rIp[3], rPort);
 #endif
 
-            if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
+            event.pInstance = pInstance;
+            if (uPortEventQueueSend(pInstance->eventQueueHandle,
                                     &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
                 success = true;
             } else {
@@ -571,15 +649,16 @@ static bool enqueueEdmConnectIpv4Event(uShortRangeEdmEvent_t *pEvent)
     return success;
 }
 
-static bool enqueueEdmConnectIpv6Event(uShortRangeEdmEvent_t *pEvent)
+static bool enqueueEdmConnectIpv6Event(uShortRangeEdmStreamInstance_t *pInstance,
+                                       uShortRangeEdmEvent_t *pEvent)
 {
     bool success = false;
 
     uShortRangeEdmStreamConnections_t *pConnection =
-        findConnection(pEvent->params.ipv6ConnectEvent.channel);
+        findConnection(pInstance, pEvent->params.ipv6ConnectEvent.channel);
 
     if (pConnection == NULL) {
-        pConnection = findConnection(-1);
+        pConnection = findConnection(pInstance, -1);
     }
     if (pConnection != NULL) {
         uShortRangeEdmStreamEvent_t event = {0};
@@ -615,7 +694,8 @@ static bool enqueueEdmConnectIpv6Event(uShortRangeEdmEvent_t *pEvent)
                           event.ip.channel, protocolTxt, lPort, rPort);
 #endif
 
-            if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
+            event.pInstance = pInstance;
+            if (uPortEventQueueSend(pInstance->eventQueueHandle,
                                     &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
                 success = true;
             } else {
@@ -627,12 +707,13 @@ static bool enqueueEdmConnectIpv6Event(uShortRangeEdmEvent_t *pEvent)
     return success;
 }
 
-static bool enqueueEdmDisconnectEvent(uShortRangeEdmEvent_t *pEvent)
+static bool enqueueEdmDisconnectEvent(uShortRangeEdmStreamInstance_t *pInstance,
+                                      uShortRangeEdmEvent_t *pEvent)
 {
     bool success = false;
 
     uint8_t channel = pEvent->params.disconnectEvent.channel;
-    uShortRangeEdmStreamConnections_t *pConnection = findConnection(channel);
+    uShortRangeEdmStreamConnections_t *pConnection = findConnection(pInstance, channel);
 
     if (pConnection != NULL) {
         uShortRangeEdmStreamEvent_t event = {0}; // Keep Valgrind happy
@@ -644,7 +725,8 @@ static bool enqueueEdmDisconnectEvent(uShortRangeEdmEvent_t *pEvent)
 #ifdef U_CFG_SHORT_RANGE_EDM_STREAM_DEBUG
                 uEdmChLogLine(LOG_CH_BT, "ch: %d, disconnect", channel);
 #endif
-                if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
+                event.pInstance = pInstance;
+                if (uPortEventQueueSend(pInstance->eventQueueHandle,
                                         &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
                     success = true;
                 } else {
@@ -659,7 +741,8 @@ static bool enqueueEdmDisconnectEvent(uShortRangeEdmEvent_t *pEvent)
 #ifdef U_CFG_SHORT_RANGE_EDM_STREAM_DEBUG
                 uEdmChLogLine(LOG_CH_IP, "ch: %d, disconnect", channel);
 #endif
-                if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
+                event.pInstance = pInstance;
+                if (uPortEventQueueSend(pInstance->eventQueueHandle,
                                         &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
                     success = true;
                 } else {
@@ -674,7 +757,8 @@ static bool enqueueEdmDisconnectEvent(uShortRangeEdmEvent_t *pEvent)
 #ifdef U_CFG_SHORT_RANGE_EDM_STREAM_DEBUG
                 uEdmChLogLine(LOG_CH_IP, "ch: %d, disconnect", channel);
 #endif
-                if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
+                event.pInstance = pInstance;
+                if (uPortEventQueueSend(pInstance->eventQueueHandle,
                                         &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
                     success = true;
                 } else {
@@ -692,65 +776,106 @@ static bool enqueueEdmDisconnectEvent(uShortRangeEdmEvent_t *pEvent)
     return success;
 }
 
-static bool enqueueEdmDataEvent(uShortRangeEdmEvent_t *pEvent)
+// Pass the batch of received data packets to the event task in
+// a single event.
+static void flushDataBatch(uShortRangeEdmStreamInstance_t *pInstance)
 {
-    bool success = false;
-
+    uShortRangePbufList_t *pBufList;
     uShortRangeEdmStreamEvent_t event = {0}; // Keep Valgrind happy
-    event.type = U_SHORT_RANGE_EDM_STREAM_EVENT_DATA;
-    event.data.channel = pEvent->params.dataEvent.channel;
-    event.data.pBufList = pEvent->params.dataEvent.pBufList;
 
-    if (event.data.pBufList != NULL) {
+    if (pInstance->pDataBatchHead != NULL) {
+        event.type = U_SHORT_RANGE_EDM_STREAM_EVENT_DATA;
+        event.data.pBufList = pInstance->pDataBatchHead;
+        event.pInstance = pInstance;
+        if (uPortEventQueueSend(pInstance->eventQueueHandle,
+                                &event, sizeof(uShortRangeEdmStreamEvent_t)) != 0) {
+            uPortLog("U_SHO_EDM_STREAM: Failed to enqueue message\n");
+            // The data is lost but the pbufs need not be
+            while (pInstance->pDataBatchHead != NULL) {
+                pBufList = pInstance->pDataBatchHead;
+                pInstance->pDataBatchHead = pBufList->pNext;
+                pBufList->pNext = NULL;
+                uShortRangePbufListFree(pBufList);
+            }
+        }
+        pInstance->pDataBatchHead = NULL;
+        pInstance->pDataBatchTail = NULL;
+        pInstance->dataBatchCount = 0;
+    }
+}
+
+// Add a received data packet to the batch that will be passed to
+// the event task, rather than passing each packet on its own.
+static void batchEdmDataEvent(uShortRangeEdmStreamInstance_t *pInstance,
+                              uShortRangeEdmEvent_t *pEvent)
+{
+    uShortRangePbufList_t *pBufList = pEvent->params.dataEvent.pBufList;
+
+    if (pBufList != NULL) {
 
 #ifdef U_CFG_SHORT_RANGE_EDM_STREAM_DEBUG
 # ifdef U_CFG_SHORT_RANGE_EDM_STREAM_DEBUG_DUMP_DATA
-        uEdmChLogStart(LOG_CH_DATA, "RX (%d bytes): ", (event.data.pBufList)->totalLen);
-        dumpPbufList(event.data.pBufList);
+        uEdmChLogStart(LOG_CH_DATA, "RX (%d bytes): ", pBufList->totalLen);
+        dumpPbufList(pBufList);
         uEdmChLogEnd("");
 # else
-        uEdmChLogLine(LOG_CH_DATA, "RX (%d bytes)", (event.data.pBufList)->totalLen);
+        uEdmChLogLine(LOG_CH_DATA, "RX (%d bytes)", pBufList->totalLen);
 # endif
 #endif
+        pBufList->edmChannel = (int8_t) pEvent->params.dataEvent.channel;
+        pBufList->pNext = NULL;
+        if (pInstance->pDataBatchTail != NULL) {
+            pInstance->pDataBatchTail->pNext = pBufList;
+        } else {
+            pInstance->pDataBatchHead = pBufList;
+        }
+        pInstance->pDataBatchTail = pBufList;
+        pInstance->dataBatchCount++;
+        if (pInstance->dataBatchCount >= U_SHORT_RANGE_EDM_STREAM_DATA_BATCH_MAX) {
+            flushDataBatch(pInstance);
+        }
     }
-    if (uPortEventQueueSend(gEdmStream.eventQueueHandle,
-                            &event, sizeof(uShortRangeEdmStreamEvent_t)) == 0) {
-        success = true;
-    } else {
-        uPortLog("U_SHO_EDM_STREAM: Failed to enqueue message\n");
-    }
-
-    return success;
 }
 
-static void processEdmEvent(uShortRangeEdmEvent_t *pEvent)
+static void processEdmEvent(uShortRangeEdmStreamInstance_t *pInstance,
+                            uShortRangeEdmEvent_t *pEvent)
 {
     bool enqueued = false;
 
+    U_LOG_RAM_TRACE_BEGIN(U_LOG_RAM_TRACE_ID_EDM_EVENT);
+
+    if (pEvent->type == U_SHORT_RANGE_EDM_EVENT_DATA) {
+        // The pbuf list now belongs to the batch, so the parser
+        // may carry straight on without waiting for the event task
+        batchEdmDataEvent(pInstance, pEvent);
+        uShortRangeEdmResetParser(&pInstance->parser);
+        U_LOG_RAM_TRACE_END(U_LOG_RAM_TRACE_ID_EDM_EVENT);
+        return;
+    }
+
+    // Anything else must not overtake data received before it
+    flushDataBatch(pInstance);
+
     switch (pEvent->type) {
 
         case U_SHORT_RANGE_EDM_EVENT_AT:
-            enqueued = enqueueEdmAtEvent(pEvent);
+            enqueued = enqueueEdmAtEvent(pInstance, pEvent);
             break;
 
         case U_SHORT_RANGE_EDM_EVENT_CONNECT_BT:
-            enqueued = enqueueEdmConnectBtEvent(pEvent);
+            enqueued = enqueueEdmConnectBtEvent(pInstance, pEvent);
             break;
 
         case U_SHORT_RANGE_EDM_EVENT_DISCONNECT:
-            enqueued = enqueueEdmDisconnectEvent(pEvent);
-            break;
-
-        case U_SHORT_RANGE_EDM_EVENT_DATA:
-            enqueued = enqueueEdmDataEvent(pEvent);
+            enqueued = enqueueEdmDisconnectEvent(pInstance, pEvent);
             break;
 
         case U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv4:
-            enqueued = enqueueEdmConnectIpv4Event(pEvent);
+            enqueued = enqueueEdmConnectIpv4Event(pInstance, pEvent);
             break;
 
         case U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv6:
-            enqueued = enqueueEdmConnectIpv6Event(pEvent);
+            enqueued = enqueueEdmConnectIpv6Event(pInstance, pEvent);
             break;
 
         case U_SHORT_RANGE_EDM_EVENT_INVALID: /* Intentional fallthrough */
@@ -762,18 +887,20 @@ static void processEdmEvent(uShortRangeEdmEvent_t *pEvent)
 
     if (!enqueued) {
         /* No event was enqueued to the event queue so we simply consume the event */
-        processedEvent();
+        processedEvent(pInstance);
     }
+
+    U_LOG_RAM_TRACE_END(U_LOG_RAM_TRACE_ID_EDM_EVENT);
 }
 
 static void uartCallback(int32_t uartHandle, uint32_t eventBitmask,
                          void *pParameters)
 {
-    (void)pParameters;
+    uShortRangeEdmStreamInstance_t *pInstance = (uShortRangeEdmStreamInstance_t *) pParameters;
     bool memAvailable = true;
 
-    if ((gEdmStream.uartHandle == uartHandle) &&
-        !gEdmStream.ignoreUartCallback &&
+    if ((pInstance != NULL) && (pInstance->uartHandle == uartHandle) &&
+        !pInstance->ignoreUartCallback &&
         (eventBitmask == U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED)) {
         bool uartEmpty = false;
         // We don't want to read one character at the time from the uart driver since that will be
@@ -782,50 +909,58 @@ static void uartCallback(int32_t uartHandle, uint32_t eventBitmask,
         // before an EDM-event is generated by the parser which makes the parser unavailable
         // and we have to leave this callback. When the parser later is available this
         // uart-event will be placed on the queue again so that we come back here.
-        // We thus need a static buffer, and if there are unparsed characters left in it we move
-        // them to the beginning of the buffer befor leaving (instead of using a ring buffer).
-        U_PORT_MUTEX_LOCK(gMutex);
-        while (!uartEmpty && uShortRangeEdmParserReady() && memAvailable) {
+        // We thus need a buffer that persists, one per instance, and if there are unparsed
+        // characters left in it we move them to the beginning of the buffer befor leaving
+        // (instead of using a ring buffer).
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
+        while (!uartEmpty && uShortRangeEdmParserReady(&pInstance->parser) && memAvailable) {
             // Loop until we couldn't read any more characters from uart
             // or EDM parser is unavailable
             // or no pbuf memory is available
-            static char buffer[128];
-            static size_t charsInBuffer = 0;
+            char *pBuffer = pInstance->uartBuffer;
+            size_t charsInBuffer = pInstance->uartBufferCount;
             size_t consumed = 0;
 
             // Check if there are any existing characters in the buffer and parse them
-            while (uShortRangeEdmParserReady() && (consumed < charsInBuffer) && memAvailable) {
-                //lint -esym(727, buffer)
+            while (uShortRangeEdmParserReady(&pInstance->parser) &&
+                   (consumed < charsInBuffer) && memAvailable) {
                 uShortRangeEdmEvent_t *pEvent = NULL;
                 // when there is no memory available in the pool to intake
-                // the data, this call would return false.In such
+                // the data, this call would stop short.In such
                 // cases hardware flow control will be triggered if
                 // UART H/W Rx FIFO is full.
-                if (uShortRangeEdmParse(buffer[consumed], &pEvent, &memAvailable)) {
-                    consumed++;
-                }
+                consumed += uShortRangeEdmParseBuffer(&pInstance->parser, pBuffer + consumed,
+                                                      charsInBuffer - consumed,
+                                                      &pEvent, &memAvailable);
                 if (pEvent != NULL) {
-                    processEdmEvent(pEvent);
+                    processEdmEvent(pInstance, pEvent);
                 }
             }
+            if (!memAvailable) {
+                // Let the data that is holding the pbufs go
+                flushDataBatch(pInstance);
+            }
             // Move unparsed data to beginning of buffer
             if ((consumed > 0) && (charsInBuffer - consumed) > 0) {
-                memmove(buffer, buffer + consumed, charsInBuffer - consumed);
+                memmove(pBuffer, pBuffer + consumed, charsInBuffer - consumed);
             }
             charsInBuffer -= consumed;
 
             // Read as much as possible from uart into rest of buffer
-            if (charsInBuffer < sizeof buffer) {
-                int32_t sizeOrError = uPortUartRead(gEdmStream.uartHandle, buffer + charsInBuffer,
-                                                    sizeof buffer - charsInBuffer);
+            if (charsInBuffer < sizeof(pInstance->uartBuffer)) {
+                int32_t sizeOrError = uPortUartRead(pInstance->uartHandle, pBuffer + charsInBuffer,
+                                                    sizeof(pInstance->uartBuffer) - charsInBuffer);
                 if (sizeOrError > 0) {
                     charsInBuffer += sizeOrError;
                 } else {
                     uartEmpty = true;
                 }
             }
+            pInstance->uartBufferCount = charsInBuffer;
         }
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        // Pass on whatever data was received in this go
+        flushDataBatch(pInstance);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 }
 
@@ -840,15 +975,77 @@ static void flushUart(int32_t uartHandle)
     }
 }
 
-static int32_t uartWrite(const void *pData, size_t length)
+static int32_t uartWrite(const uShortRangeEdmStreamInstance_t *pInstance,
+                         const void *pData, size_t length)
 {
     int32_t x = 0;
     if (pData != NULL) {
-        x = uPortUartWrite(gEdmStream.uartHandle, pData, length);
+        x = uPortUartWrite(pInstance->uartHandle, pData, length);
     }
     return x;
 }
 
+// Write whatever has been gathered in the transmit buffer to the
+// UART, returning true if all of it was written.
+static bool txBufferFlush(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    bool success = true;
+
+    if (pInstance->txBufferCount > 0) {
+        success = (uartWrite(pInstance, pInstance->pTxBuffer,
+                             pInstance->txBufferCount) == (int32_t) pInstance->txBufferCount);
+        pInstance->txBufferCount = 0;
+    }
+
+    return success;
+}
+
+// Write an EDM data frame, gathering it into the transmit buffer
+// if there is one and it fits, returning true on success.
+static bool writeDataFrame(uShortRangeEdmStreamInstance_t *pInstance,
+                           int32_t channel, const char *pData, int32_t size)
+{
+    bool success = true;
+    bool buffered = false;
+    char head[U_SHORT_RANGE_EDM_DATA_HEAD_SIZE];
+    char tail[U_SHORT_RANGE_EDM_TAIL_SIZE];
+    size_t frameSize = U_SHORT_RANGE_EDM_DATA_HEAD_SIZE + size + U_SHORT_RANGE_EDM_TAIL_SIZE;
+    int32_t sent;
+
+#if U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH > 0
+    char *pFrame;
+    if ((pInstance->pTxBuffer != NULL) &&
+        (frameSize <= U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH)) {
+        if (pInstance->txBufferCount + frameSize > U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH) {
+            success = txBufferFlush(pInstance);
+        }
+        if (success) {
+            pFrame = pInstance->pTxBuffer + pInstance->txBufferCount;
+            (void)uShortRangeEdmZeroCopyHeadData((uint8_t)channel, size, pFrame);
+            memcpy(pFrame + U_SHORT_RANGE_EDM_DATA_HEAD_SIZE, pData, size);
+            (void)uShortRangeEdmZeroCopyTail(pFrame + U_SHORT_RANGE_EDM_DATA_HEAD_SIZE + size);
+            pInstance->txBufferCount += frameSize;
+        }
+        buffered = true;
+    }
+#endif
+
+    if (!buffered) {
+        // Keep the order of frames
+        success = txBufferFlush(pInstance);
+        if (success) {
+            (void)uShortRangeEdmZeroCopyHeadData((uint8_t)channel, size, (char *)&head[0]);
+            sent = uartWrite(pInstance, (void *)&head[0], U_SHORT_RANGE_EDM_DATA_HEAD_SIZE);
+            sent += uartWrite(pInstance, (const void *)pData, size);
+            (void)uShortRangeEdmZeroCopyTail((char *)&tail[0]);
+            sent += uartWrite(pInstance, (void *)&tail[0], U_SHORT_RANGE_EDM_TAIL_SIZE);
+            success = (sent == (int32_t) frameSize);
+        }
+    }
+
+    return success;
+}
+
 // Do an EDM send.  Returns the amount written, including
 // EDM packet overhead.
 static int32_t edmSend(const uShortRangeEdmStreamInstance_t *pEdmStream)
@@ -870,7 +1067,7 @@ static int32_t edmSend(const uShortRangeEdmStreamInstance_t *pEdmStream)
             uEdmChLogEnd("\"");
 #endif
             while (written < (uint32_t) sizeOrError) {
-                written += uartWrite((void *) (pPacket + written),
+                written += uartWrite(pEdmStream, (void *) (pPacket + written),
                                      (uint32_t) sizeOrError - written);
             }
         }
@@ -880,46 +1077,44 @@ static int32_t edmSend(const uShortRangeEdmStreamInstance_t *pEdmStream)
     return sizeOrError;
 }
 
-// A transmit intercept function.
-//lint -e{818} Suppress 'pContext' could be declared as const:
-// need to follow function signature
+// A transmit intercept function, pContext being the instance.
 static const char *pInterceptTx(uAtClientHandle_t atHandle,
                                 const char **ppData,
                                 size_t *pLength,
                                 void *pContext)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = (uShortRangeEdmStreamInstance_t *) pContext;
     int32_t x = 0;
 
-    (void) pContext;
     (void) atHandle;
 
     if ((*pLength != 0) || (ppData == NULL)) {
         if (ppData == NULL) {
             // We're being flushed, create and send EDM packet
-            edmSend(&gEdmStream);
+            edmSend(pInstance);
             // Reset buffer
-            gEdmStream.atCommandCurrent = 0;
+            pInstance->atCommandCurrent = 0;
         } else {
             // Send any whole buffer's worths we have
-            while ((*pLength + gEdmStream.atCommandCurrent > U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH) &&
+            while ((*pLength + pInstance->atCommandCurrent > U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH) &&
                    (x >= 0)) {
-                x = U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH - gEdmStream.atCommandCurrent;
-                memcpy(gEdmStream.pAtCommandBuffer + gEdmStream.atCommandCurrent, *ppData, x);
+                x = U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH - pInstance->atCommandCurrent;
+                memcpy(pInstance->pAtCommandBuffer + pInstance->atCommandCurrent, *ppData, x);
                 *pLength -= x;
                 *ppData += x;
-                gEdmStream.atCommandCurrent = U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH;
+                pInstance->atCommandCurrent = U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH;
                 // Send a chunk
-                x = edmSend(&gEdmStream);
+                x = edmSend(pInstance);
                 if (x < 0) {
                     // Error recovery: tell the caller we've consumed the lot
                     *ppData += *pLength;
                     *pLength = 0;
                 }
-                gEdmStream.atCommandCurrent = 0;
+                pInstance->atCommandCurrent = 0;
             }
             // Copy in any partial buffer, will be sent when we are flushed
-            memcpy(gEdmStream.pAtCommandBuffer + gEdmStream.atCommandCurrent, *ppData, *pLength);
-            gEdmStream.atCommandCurrent += (int32_t) * pLength;
+            memcpy(pInstance->pAtCommandBuffer + pInstance->atCommandCurrent, *ppData, *pLength);
+            pInstance->atCommandCurrent += (int32_t) * pLength;
             // Tell the caller what we've consumed.
             *ppData += *pLength;
         }
@@ -939,110 +1134,147 @@ static const char *pInterceptTx(uAtClientHandle_t atHandle,
 int32_t uShortRangeEdmStreamInit()
 {
     uErrorCode_t errorCodeOrHandle = U_ERROR_COMMON_SUCCESS;
-
-    if (gMutex == NULL) {
-        errorCodeOrHandle = (uErrorCode_t)uPortMutexCreate(&gMutex);
-
-        if (errorCodeOrHandle == U_ERROR_COMMON_SUCCESS) {
-            errorCodeOrHandle = (uErrorCode_t)uShortRangeMemPoolInit();
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    for (size_t x = 0; (x < sizeof(gEdmStream) / sizeof(gEdmStream[0])) &&
+         (errorCodeOrHandle == U_ERROR_COMMON_SUCCESS); x++) {
+        pInstance = &gEdmStream[x];
+        if (pInstance->mutex == NULL) {
+            errorCodeOrHandle = (uErrorCode_t)uPortMutexCreate(&pInstance->mutex);
+            pInstance->handle = -1;
+            pInstance->uartHandle = -1;
+            pInstance->eventQueueHandle = -1;
+            pInstance->ignoreUartCallback = false;
         }
-        gEdmStream.handle = -1;
-        gEdmStream.ignoreUartCallback = false;
     }
 
-    uShortRangeEdmResetParser();
-
     return (int32_t) errorCodeOrHandle;
 }
 
 void uShortRangeEdmStreamDeinit()
 {
-    uShortRangeEdmResetParser();
-
-    if (gMutex != NULL) {
-
-        U_PORT_MUTEX_LOCK(gMutex);
-        uShortRangeMemPoolDeInit();
-
-        if (gEdmStream.eventQueueHandle >= 0) {
-            uPortEventQueueClose(gEdmStream.eventQueueHandle);
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    // Only instances that are closed are cleaned up, so that
+    // closing one short range module does not pull the EDM
+    // stream out from under another
+    for (size_t x = 0; x < sizeof(gEdmStream) / sizeof(gEdmStream[0]); x++) {
+        pInstance = &gEdmStream[x];
+        if ((pInstance->mutex != NULL) && (pInstance->handle == -1)) {
+
+            U_PORT_MUTEX_LOCK(pInstance->mutex);
+            uShortRangePbufPoolDelete(pInstance->pPool);
+            pInstance->pPool = NULL;
+            U_PORT_MUTEX_UNLOCK(pInstance->mutex);
+            uPortMutexDelete(pInstance->mutex);
+            pInstance->mutex = NULL;
         }
-        gEdmStream.eventQueueHandle = -1;
-
-        U_PORT_MUTEX_UNLOCK(gMutex);
-        uPortMutexDelete(gMutex);
-        gMutex = NULL;
     }
 }
 
 int32_t uShortRangeEdmStreamOpen(int32_t uartHandle)
 {
     uErrorCode_t handleOrErrorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+
+    // Find and lock a free instance
+    for (size_t x = 0; (x < sizeof(gEdmStream) / sizeof(gEdmStream[0])) &&
+         (pInstance == NULL); x++) {
+        if (gEdmStream[x].mutex != NULL) {
+            handleOrErrorCode = U_ERROR_COMMON_NO_MEMORY;
+            uPortMutexLock(gEdmStream[x].mutex);
+            if (gEdmStream[x].handle == -1) {
+                pInstance = &gEdmStream[x];
+            } else {
+                uPortMutexUnlock(gEdmStream[x].mutex);
+            }
+        }
+    }
 
-    if (gMutex != NULL) {
-
-        U_PORT_MUTEX_LOCK(gMutex);
+    if (pInstance != NULL) {
         handleOrErrorCode = U_ERROR_COMMON_INVALID_PARAMETER;
 
-        if (uartHandle >= 0 && gEdmStream.handle == -1) {
+        if (uartHandle >= 0) {
+            int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
 
-            int32_t errorCode = uPortUartEventCallbackSet(uartHandle,
-                                                          U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
-                                                          uartCallback, NULL,
-                                                          U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
-                                                          U_EDM_STREAM_TASK_PRIORITY);
+            // The pbuf pool is kept until uShortRangeEdmStreamDeinit()
+            // since pbufs may still be held by the wifi/ble APIs after
+            // the stream has been closed
+            if (pInstance->pPool == NULL) {
+                errorCode = uShortRangePbufPoolCreate(&pInstance->pPool);
+            }
+            if (errorCode == 0) {
+                errorCode = uPortUartEventCallbackSet(uartHandle,
+                                                      U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
+                                                      uartCallback, pInstance,
+                                                      U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
+                                                      U_EDM_STREAM_TASK_PRIORITY);
+            }
 
             if (errorCode == 0) {
-                gEdmStream.pAtCommandBuffer = (char *)pUPortMalloc(U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
-                memset(gEdmStream.pAtCommandBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
-                gEdmStream.pAtResponseBuffer = (char *)pUPortMalloc(U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
-                memset(gEdmStream.pAtResponseBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
-                if (gEdmStream.pAtCommandBuffer == NULL ||
-                    gEdmStream.pAtResponseBuffer == NULL) {
+                pInstance->pAtCommandBuffer = (char *)pUPortMalloc(U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
+                pInstance->pAtResponseBuffer = (char *)pUPortMalloc(U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
+                if (pInstance->pAtCommandBuffer == NULL ||
+                    pInstance->pAtResponseBuffer == NULL) {
                     handleOrErrorCode = U_ERROR_COMMON_NO_MEMORY;
                     uPortUartEventCallbackRemove(uartHandle);
+                    uPortFree(pInstance->pAtCommandBuffer);
+                    pInstance->pAtCommandBuffer = NULL;
+                    uPortFree(pInstance->pAtResponseBuffer);
+                    pInstance->pAtResponseBuffer = NULL;
                 } else {
-                    gEdmStream.eventQueueHandle
+                    memset(pInstance->pAtCommandBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
+                    memset(pInstance->pAtResponseBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
+#if U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH > 0
+                    // Without a transmit buffer frames are just written
+                    // one at a time, so not fatal if this fails
+                    pInstance->pTxBuffer = (char *)pUPortMalloc(U_SHORT_RANGE_EDM_STREAM_TX_BUFFER_LENGTH);
+#endif
+                    pInstance->txBufferCount = 0;
+                    pInstance->eventQueueHandle
                         = uPortEventQueueOpen(eventHandler, "eventEdmStream",
                                               sizeof(uShortRangeEdmStreamEvent_t),
                                               U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
                                               U_EDM_STREAM_TASK_PRIORITY,
                                               U_EDM_STREAM_EVENT_QUEUE_SIZE);
-                    if (gEdmStream.eventQueueHandle < 0) {
-                        gEdmStream.eventQueueHandle = -1;
+                    if (pInstance->eventQueueHandle < 0) {
+                        pInstance->eventQueueHandle = -1;
                     }
 
-                    gEdmStream.handle = 0;
-                    gEdmStream.uartHandle = uartHandle;
-                    gEdmStream.atHandle = NULL;
-                    gEdmStream.pAtCallback = NULL;
-                    gEdmStream.pAtCallbackParam = NULL;
-                    gEdmStream.pBtEventCallback = NULL;
-                    gEdmStream.pBtEventCallbackParam = NULL;
-                    gEdmStream.pBtDataCallback = NULL;
-                    gEdmStream.pBtDataCallbackParam = NULL;
-                    gEdmStream.pIpEventCallback = NULL;
-                    gEdmStream.pIpEventCallbackParam = NULL;
-                    gEdmStream.pIpDataCallback = NULL;
-                    gEdmStream.pIpDataCallbackParam = NULL;
-                    gEdmStream.pMqttEventCallback = NULL;
-                    gEdmStream.pMqttEventCallbackParam = NULL;
-                    gEdmStream.pMqttDataCallback = NULL;
-                    gEdmStream.pMqttDataCallbackParam = NULL;
-                    gEdmStream.atCommandCurrent = 0;
+                    pInstance->handle = (int32_t) (pInstance - gEdmStream);
+                    pInstance->uartHandle = uartHandle;
+                    pInstance->atHandle = NULL;
+                    pInstance->pAtCallback = NULL;
+                    pInstance->pAtCallbackParam = NULL;
+                    pInstance->pBtEventCallback = NULL;
+                    pInstance->pBtEventCallbackParam = NULL;
+                    pInstance->pBtDataCallback = NULL;
+                    pInstance->pBtDataCallbackParam = NULL;
+                    pInstance->pIpEventCallback = NULL;
+                    pInstance->pIpEventCallbackParam = NULL;
+                    pInstance->pIpDataCallback = NULL;
+                    pInstance->pIpDataCallbackParam = NULL;
+                    pInstance->pMqttEventCallback = NULL;
+                    pInstance->pMqttEventCallbackParam = NULL;
+                    pInstance->pMqttDataCallback = NULL;
+                    pInstance->pMqttDataCallbackParam = NULL;
+                    pInstance->atCommandCurrent = 0;
+                    pInstance->atResponseLength = 0;
+                    pInstance->atResponseRead = 0;
+                    pInstance->uartBufferCount = 0;
 
                     for (uint32_t i = 0; i < U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS; i++) {
-                        gEdmStream.connections[i].channel = -1;
-                        gEdmStream.connections[i].type = U_SHORT_RANGE_CONNECTION_TYPE_INVALID;
+                        pInstance->connections[i].channel = -1;
+                        pInstance->connections[i].type = U_SHORT_RANGE_CONNECTION_TYPE_INVALID;
                     }
 
-                    handleOrErrorCode = (uErrorCode_t)gEdmStream.handle;
+                    handleOrErrorCode = (uErrorCode_t)pInstance->handle;
                     flushUart(uartHandle);
                 }
             }
         }
-        uShortRangeEdmResetParser();
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        uShortRangeEdmParserInit(&pInstance->parser, pInstance->pPool);
+        uPortMutexUnlock(pInstance->mutex);
     }
 
     return (int32_t) handleOrErrorCode;
@@ -1050,51 +1282,55 @@ int32_t uShortRangeEdmStreamOpen(int32_t uartHandle)
 
 void uShortRangeEdmStreamClose(int32_t handle)
 {
-    if (gMutex != NULL) {
-        gEdmStream.ignoreUartCallback = true;
-        uPortMutexLock(gMutex);
-
-        if ((handle != -1) && (handle == gEdmStream.handle)) {
-            gEdmStream.handle = -1;
-            if (gEdmStream.uartHandle >= 0) {
-                uPortUartEventCallbackRemove(gEdmStream.uartHandle);
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
+
+    if (pInstance != NULL) {
+        pInstance->ignoreUartCallback = true;
+        uPortMutexLock(pInstance->mutex);
+
+        if (handle == pInstance->handle) {
+            pInstance->handle = -1;
+            if (pInstance->uartHandle >= 0) {
+                uPortUartEventCallbackRemove(pInstance->uartHandle);
             }
-            gEdmStream.uartHandle = -1;
-            if (gEdmStream.eventQueueHandle >= 0) {
-                uPortEventQueueClose(gEdmStream.eventQueueHandle);
+            pInstance->uartHandle = -1;
+            if (pInstance->eventQueueHandle >= 0) {
+                uPortEventQueueClose(pInstance->eventQueueHandle);
             }
-            gEdmStream.eventQueueHandle = -1;
-            if (gEdmStream.atHandle != NULL) {
-                uAtClientStreamInterceptTx(gEdmStream.atHandle, NULL, NULL);
+            pInstance->eventQueueHandle = -1;
+            if (pInstance->atHandle != NULL) {
+                uAtClientStreamInterceptTx(pInstance->atHandle, NULL, NULL);
             }
-            gEdmStream.atHandle = NULL;
-            gEdmStream.pAtCallback = NULL;
-            gEdmStream.pAtCallbackParam = NULL;
-            gEdmStream.pBtEventCallback = NULL;
-            gEdmStream.pBtEventCallbackParam = NULL;
-            gEdmStream.pBtDataCallback = NULL;
-            gEdmStream.pBtDataCallbackParam = NULL;
-            gEdmStream.pIpEventCallback = NULL;
-            gEdmStream.pIpEventCallbackParam = NULL;
-            gEdmStream.pIpDataCallback = NULL;
-            gEdmStream.pIpDataCallbackParam = NULL;
-            gEdmStream.pMqttEventCallback = NULL;
-            gEdmStream.pMqttEventCallbackParam = NULL;
-            gEdmStream.pMqttDataCallback = NULL;
-            gEdmStream.pMqttDataCallbackParam = NULL;
-            uPortFree(gEdmStream.pAtCommandBuffer);
-            gEdmStream.pAtCommandBuffer = NULL;
-            uPortFree(gEdmStream.pAtResponseBuffer);
-            gEdmStream.pAtResponseBuffer = NULL;
+            pInstance->atHandle = NULL;
+            pInstance->pAtCallback = NULL;
+            pInstance->pAtCallbackParam = NULL;
+            pInstance->pBtEventCallback = NULL;
+            pInstance->pBtEventCallbackParam = NULL;
+            pInstance->pBtDataCallback = NULL;
+            pInstance->pBtDataCallbackParam = NULL;
+            pInstance->pIpEventCallback = NULL;
+            pInstance->pIpEventCallbackParam = NULL;
+            pInstance->pIpDataCallback = NULL;
+            pInstance->pIpDataCallbackParam = NULL;
+            pInstance->pMqttEventCallback = NULL;
+            pInstance->pMqttEventCallbackParam = NULL;
+            pInstance->pMqttDataCallback = NULL;
+            pInstance->pMqttDataCallbackParam = NULL;
+            uPortFree(pInstance->pAtCommandBuffer);
+            pInstance->pAtCommandBuffer = NULL;
+            uPortFree(pInstance->pAtResponseBuffer);
+            pInstance->pAtResponseBuffer = NULL;
+            uPortFree(pInstance->pTxBuffer);
+            pInstance->pTxBuffer = NULL;
             for (uint32_t i = 0; i < U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS; i++) {
-                gEdmStream.connections[i].channel = -1;
-                gEdmStream.connections[i].type = U_SHORT_RANGE_CONNECTION_TYPE_INVALID;
+                pInstance->connections[i].channel = -1;
+                pInstance->connections[i].type = U_SHORT_RANGE_CONNECTION_TYPE_INVALID;
             }
+            uShortRangeEdmResetParser(&pInstance->parser);
         }
 
-        uShortRangeEdmResetParser();
-        uPortMutexUnlock(gMutex);
-        gEdmStream.ignoreUartCallback = false;
+        uPortMutexUnlock(pInstance->mutex);
+        pInstance->ignoreUartCallback = false;
     }
 }
 
@@ -1103,20 +1339,21 @@ int32_t uShortRangeEdmStreamAtCallbackSet(int32_t handle,
                                           uEdmAtEventCallback_t pFunction,
                                           void *pParam)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((handle == gEdmStream.handle) && (pFunction != NULL)) {
-            gEdmStream.pAtCallback = pFunction;
-            gEdmStream.pAtCallbackParam = pParam;
+        if ((handle == pInstance->handle) && (pFunction != NULL)) {
+            pInstance->pAtCallback = pFunction;
+            pInstance->pAtCallbackParam = pParam;
             errorCode = U_ERROR_COMMON_SUCCESS;
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return (int32_t)errorCode;
@@ -1126,26 +1363,27 @@ int32_t uShortRangeEdmStreamIpEventCallbackSet(int32_t handle,
                                                uEdmIpConnectionStatusCallback_t pFunction,
                                                void *pParam)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if (handle == gEdmStream.handle) {
-            if (pFunction != NULL && gEdmStream.pIpEventCallback == NULL) {
-                gEdmStream.pIpEventCallback = pFunction;
-                gEdmStream.pIpEventCallbackParam = pParam;
+        if (handle == pInstance->handle) {
+            if (pFunction != NULL && pInstance->pIpEventCallback == NULL) {
+                pInstance->pIpEventCallback = pFunction;
+                pInstance->pIpEventCallbackParam = pParam;
                 errorCode = U_ERROR_COMMON_SUCCESS;
             } else if (pFunction == NULL) {
-                gEdmStream.pIpEventCallback = NULL;
-                gEdmStream.pIpEventCallbackParam = NULL;
+                pInstance->pIpEventCallback = NULL;
+                pInstance->pIpEventCallbackParam = NULL;
                 errorCode = U_ERROR_COMMON_SUCCESS;
             }
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return (int32_t)errorCode;
@@ -1162,26 +1400,27 @@ int32_t uShortRangeEdmStreamMqttEventCallbackSet(int32_t handle,
                                                  uEdmIpConnectionStatusCallback_t pFunction,
                                                  void *pParam)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if (handle == gEdmStream.handle) {
-            if (pFunction != NULL && gEdmStream.pMqttEventCallback == NULL) {
-                gEdmStream.pMqttEventCallback = pFunction;
-                gEdmStream.pMqttEventCallbackParam = pParam;
+        if (handle == pInstance->handle) {
+            if (pFunction != NULL && pInstance->pMqttEventCallback == NULL) {
+                pInstance->pMqttEventCallback = pFunction;
+                pInstance->pMqttEventCallbackParam = pParam;
                 errorCode = U_ERROR_COMMON_SUCCESS;
             } else if (pFunction == NULL) {
-                gEdmStream.pMqttEventCallback = NULL;
-                gEdmStream.pMqttEventCallbackParam = NULL;
+                pInstance->pMqttEventCallback = NULL;
+                pInstance->pMqttEventCallbackParam = NULL;
                 errorCode = U_ERROR_COMMON_SUCCESS;
             }
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return (int32_t)errorCode;
@@ -1199,27 +1438,28 @@ int32_t uShortRangeEdmStreamBtEventCallbackSet(int32_t handle,
                                                uEdmBtConnectionStatusCallback_t pFunction,
                                                void *pParam)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if (handle == gEdmStream.handle) {
-            if (pFunction != NULL && gEdmStream.pBtEventCallback == NULL) {
-                gEdmStream.pBtEventCallback = pFunction;
-                gEdmStream.pBtEventCallbackParam = pParam;
+        if (handle == pInstance->handle) {
+            if (pFunction != NULL && pInstance->pBtEventCallback == NULL) {
+                pInstance->pBtEventCallback = pFunction;
+                pInstance->pBtEventCallbackParam = pParam;
                 errorCode = U_ERROR_COMMON_SUCCESS;
             } else if (pFunction == NULL) {
-                gEdmStream.pBtEventCallback = NULL;
-                gEdmStream.pBtEventCallbackParam = NULL;
+                pInstance->pBtEventCallback = NULL;
+                pInstance->pBtEventCallbackParam = NULL;
                 errorCode = U_ERROR_COMMON_SUCCESS;
             }
 
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return (int32_t)errorCode;
@@ -1237,48 +1477,49 @@ int32_t uShortRangeEdmStreamDataEventCallbackSet(int32_t handle,
                                                  uEdmDataEventCallback_t pFunction,
                                                  void *pParam)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if (handle == gEdmStream.handle) {
+        if (handle == pInstance->handle) {
             switch (type) {
 
                 case U_SHORT_RANGE_CONNECTION_TYPE_BT:
-                    if (pFunction != NULL && gEdmStream.pBtDataCallback == NULL) {
-                        gEdmStream.pBtDataCallback = pFunction;
-                        gEdmStream.pBtDataCallbackParam = pParam;
+                    if (pFunction != NULL && pInstance->pBtDataCallback == NULL) {
+                        pInstance->pBtDataCallback = pFunction;
+                        pInstance->pBtDataCallbackParam = pParam;
                         errorCode = U_ERROR_COMMON_SUCCESS;
                     } else if (pFunction == NULL) {
-                        gEdmStream.pBtDataCallback = NULL;
-                        gEdmStream.pBtDataCallbackParam = NULL;
+                        pInstance->pBtDataCallback = NULL;
+                        pInstance->pBtDataCallbackParam = NULL;
                         errorCode = U_ERROR_COMMON_SUCCESS;
                     }
                     break;
 
                 case U_SHORT_RANGE_CONNECTION_TYPE_IP:
-                    if (pFunction != NULL && gEdmStream.pIpDataCallback == NULL) {
-                        gEdmStream.pIpDataCallback = pFunction;
-                        gEdmStream.pIpDataCallbackParam = pParam;
+                    if (pFunction != NULL && pInstance->pIpDataCallback == NULL) {
+                        pInstance->pIpDataCallback = pFunction;
+                        pInstance->pIpDataCallbackParam = pParam;
                         errorCode = U_ERROR_COMMON_SUCCESS;
                     } else if (pFunction == NULL) {
-                        gEdmStream.pIpDataCallback = NULL;
-                        gEdmStream.pIpDataCallbackParam = NULL;
+                        pInstance->pIpDataCallback = NULL;
+                        pInstance->pIpDataCallbackParam = NULL;
                         errorCode = U_ERROR_COMMON_SUCCESS;
                     }
                     break;
 
                 case U_SHORT_RANGE_CONNECTION_TYPE_MQTT:
-                    if (pFunction != NULL && gEdmStream.pMqttDataCallback == NULL) {
-                        gEdmStream.pMqttDataCallback = pFunction;
-                        gEdmStream.pMqttDataCallbackParam = pParam;
+                    if (pFunction != NULL && pInstance->pMqttDataCallback == NULL) {
+                        pInstance->pMqttDataCallback = pFunction;
+                        pInstance->pMqttDataCallbackParam = pParam;
                         errorCode = U_ERROR_COMMON_SUCCESS;
                     } else if (pFunction == NULL) {
-                        gEdmStream.pMqttDataCallback = NULL;
-                        gEdmStream.pMqttDataCallbackParam = NULL;
+                        pInstance->pMqttDataCallback = NULL;
+                        pInstance->pMqttDataCallbackParam = NULL;
                         errorCode = U_ERROR_COMMON_SUCCESS;
                     }
                     break;
@@ -1288,7 +1529,7 @@ int32_t uShortRangeEdmStreamDataEventCallbackSet(int32_t handle,
             }
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return (int32_t)errorCode;
@@ -1305,27 +1546,30 @@ void uShortRangeEdmStreamDataEventCallbackRemove(int32_t handle,
 
 void uShortRangeEdmStreamSetAtHandle(int32_t handle, void *atHandle)
 {
-    if (handle == gEdmStream.handle) {
-        uAtClientStreamInterceptTx(atHandle, pInterceptTx, NULL);
-        gEdmStream.atHandle = atHandle;
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
+
+    if ((pInstance != NULL) && (handle == pInstance->handle)) {
+        uAtClientStreamInterceptTx(atHandle, pInterceptTx, pInstance);
+        pInstance->atHandle = atHandle;
     }
 }
 
 int32_t uShortRangeEdmStreamAtWrite(int32_t handle, const void *pBuffer,
                                     size_t sizeBytes)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-        if (gEdmStream.handle == handle && pBuffer != NULL && sizeBytes != 0) {
+        if (pInstance->handle == handle && pBuffer != NULL && sizeBytes != 0) {
             int32_t result;
             uint32_t sent = 0;
 
             do {
-                result = uartWrite(pBuffer, sizeBytes);
+                result = uartWrite(pInstance, pBuffer, sizeBytes);
                 if (result > 0) {
                     sent += result;
                 }
@@ -1334,7 +1578,7 @@ int32_t uShortRangeEdmStreamAtWrite(int32_t handle, const void *pBuffer,
             sizeOrErrorCode = (int32_t)sent;
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return sizeOrErrorCode;
@@ -1343,33 +1587,34 @@ int32_t uShortRangeEdmStreamAtWrite(int32_t handle, const void *pBuffer,
 int32_t uShortRangeEdmStreamAtRead(int32_t handle, void *pBuffer,
                                    size_t sizeBytes)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        if (!gEdmStream.ignoreUartCallback) {
-            U_PORT_MUTEX_LOCK(gMutex);
+        if (!pInstance->ignoreUartCallback) {
+            U_PORT_MUTEX_LOCK(pInstance->mutex);
 
             sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-            if (gEdmStream.handle == handle && pBuffer != NULL && sizeBytes != 0) {
-                sizeOrErrorCode = (int32_t)(gEdmStream.atResponseLength - gEdmStream.atResponseRead);
+            if (pInstance->handle == handle && pBuffer != NULL && sizeBytes != 0) {
+                sizeOrErrorCode = (int32_t)(pInstance->atResponseLength - pInstance->atResponseRead);
                 if (sizeOrErrorCode > 0) {
                     if (sizeBytes < (uint32_t)sizeOrErrorCode) {
                         sizeOrErrorCode = (int32_t)sizeBytes;
                     }
-                    memcpy(pBuffer, gEdmStream.pAtResponseBuffer + gEdmStream.atResponseRead, sizeOrErrorCode);
-                    gEdmStream.atResponseRead += sizeOrErrorCode;
+                    memcpy(pBuffer, pInstance->pAtResponseBuffer + pInstance->atResponseRead, sizeOrErrorCode);
+                    pInstance->atResponseRead += sizeOrErrorCode;
 
-                    if (gEdmStream.atResponseRead >= gEdmStream.atResponseLength) {
-                        gEdmStream.atResponseLength = 0;
-                        gEdmStream.atResponseRead = 0;
+                    if (pInstance->atResponseRead >= pInstance->atResponseLength) {
+                        pInstance->atResponseLength = 0;
+                        pInstance->atResponseRead = 0;
                         uEdmChLogLine(LOG_CH_AT_RX, "processed");
-                        processedEvent();
+                        processedEvent(pInstance);
                     }
                 }
             }
 
-            U_PORT_MUTEX_UNLOCK(gMutex);
+            U_PORT_MUTEX_UNLOCK(pInstance->mutex);
         } else {
             sizeOrErrorCode = 0;
         }
@@ -1382,19 +1627,17 @@ int32_t uShortRangeEdmStreamWrite(int32_t handle, int32_t channel,
                                   const void *pBuffer, size_t sizeBytes,
                                   uint32_t timeoutMs)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
-        U_PORT_MUTEX_LOCK(gMutex);
+    if (pInstance != NULL) {
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-        if (gEdmStream.handle == handle && channel >= 0 &&
+        if (pInstance->handle == handle && channel >= 0 &&
             (pBuffer != NULL || sizeBytes == 0)) {
-            uShortRangeEdmStreamConnections_t *pConnection = findConnection(channel);
+            uShortRangeEdmStreamConnections_t *pConnection = findConnection(pInstance, channel);
             if (pConnection != NULL) {
-                int32_t sent;
                 int32_t send;
-                char head[U_SHORT_RANGE_EDM_DATA_HEAD_SIZE];
-                char tail[U_SHORT_RANGE_EDM_TAIL_SIZE];
                 sizeOrErrorCode = 0;
                 int64_t startTime = uPortGetTickTimeMs();
                 int64_t endTime;
@@ -1405,6 +1648,8 @@ int32_t uShortRangeEdmStreamWrite(int32_t handle, int32_t channel,
                         if (((int32_t)sizeBytes - sizeOrErrorCode) > pConnection->bt.frameSize) {
                             send = pConnection->bt.frameSize;
                         }
+                    } else if (send > U_SHORT_RANGE_EDM_STREAM_DATA_FRAME_MAX_SIZE) {
+                        send = U_SHORT_RANGE_EDM_STREAM_DATA_FRAME_MAX_SIZE;
                     }
 
 #ifdef U_CFG_SHORT_RANGE_EDM_STREAM_DEBUG
@@ -1417,13 +1662,8 @@ int32_t uShortRangeEdmStreamWrite(int32_t handle, int32_t channel,
 # endif
 #endif
 
-                    (void)uShortRangeEdmZeroCopyHeadData((uint8_t)channel, send, (char *)&head[0]);
-                    sent = uartWrite((void *)&head[0], U_SHORT_RANGE_EDM_DATA_HEAD_SIZE);
-                    sent += uartWrite((const void *)((const char *)pBuffer + sizeOrErrorCode), send);
-                    (void)uShortRangeEdmZeroCopyTail((char *)&tail[0]);
-                    sent += uartWrite((void *)&tail[0], U_SHORT_RANGE_EDM_TAIL_SIZE);
-
-                    if (sent != (send + U_SHORT_RANGE_EDM_DATA_HEAD_SIZE + U_SHORT_RANGE_EDM_TAIL_SIZE)) {
+                    if (!writeDataFrame(pInstance, channel,
+                                        (const char *)pBuffer + sizeOrErrorCode, send)) {
                         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_DEVICE_ERROR;
                         break;
                     } else {
@@ -1432,9 +1672,13 @@ int32_t uShortRangeEdmStreamWrite(int32_t handle, int32_t channel,
                     endTime = uPortGetTickTimeMs();
                 } while (((int32_t)sizeBytes > sizeOrErrorCode) &&
                          (endTime - startTime < timeoutMs));
+                // Nothing is left in the transmit buffer on return
+                if (!txBufferFlush(pInstance)) {
+                    sizeOrErrorCode = (int32_t)U_ERROR_COMMON_DEVICE_ERROR;
+                }
             }
         }
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return sizeOrErrorCode;
@@ -1442,27 +1686,29 @@ int32_t uShortRangeEdmStreamWrite(int32_t handle, int32_t channel,
 
 int32_t uShortRangeEdmStreamAtEventSend(int32_t handle, uint32_t eventBitMap)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((handle == 0) &&
-            (gEdmStream.eventQueueHandle >= 0) &&
+        if ((handle == pInstance->handle) &&
+            (pInstance->eventQueueHandle >= 0) &&
             // The only event we support right now
             (eventBitMap == U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED)) {
             uShortRangeEdmStreamEvent_t event = {0}; // Keep Valgrind happy
+            event.pInstance = pInstance;
             event.type = U_SHORT_RANGE_EDM_STREAM_EVENT_AT;
-            errorCode = uPortEventQueueSend(gEdmStream.eventQueueHandle,
+            errorCode = uPortEventQueueSend(pInstance->eventQueueHandle,
                                             &event, sizeof(uShortRangeEdmStreamEvent_t));
             if (errorCode != 0) {
                 uPortLog("U_SHO_EDM_STREAM: Failed to enqueue message\n");
             }
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return errorCode;
@@ -1470,18 +1716,19 @@ int32_t uShortRangeEdmStreamAtEventSend(int32_t handle, uint32_t eventBitMap)
 
 bool uShortRangeEdmStreamAtEventIsCallback(int32_t handle)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     bool isEventCallback = false;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
-        if ((handle == gEdmStream.handle) &&
-            (gEdmStream.eventQueueHandle >= 0)) {
-            isEventCallback = uPortEventQueueIsTask(gEdmStream.eventQueueHandle);
+        if ((handle == pInstance->handle) &&
+            (pInstance->eventQueueHandle >= 0)) {
+            isEventCallback = uPortEventQueueIsTask(pInstance->eventQueueHandle);
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return isEventCallback;
@@ -1489,53 +1736,77 @@ bool uShortRangeEdmStreamAtEventIsCallback(int32_t handle)
 
 void uShortRangeEdmStreamAtCallbackRemove(int32_t handle)
 {
-    if (gMutex != NULL) {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
-        if (handle == gEdmStream.handle) {
-            gEdmStream.pAtCallback = NULL;
+        if (handle == pInstance->handle) {
+            pInstance->pAtCallback = NULL;
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 }
 
 
 int32_t uShortRangeEdmStreamAtEventStackMinFree(int32_t handle)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((handle == gEdmStream.handle) &&
-            (gEdmStream.eventQueueHandle >= 0)) {
-            sizeOrErrorCode = uPortEventQueueStackMinFree(gEdmStream.eventQueueHandle);
+        if ((handle == pInstance->handle) &&
+            (pInstance->eventQueueHandle >= 0)) {
+            sizeOrErrorCode = uPortEventQueueStackMinFree(pInstance->eventQueueHandle);
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return sizeOrErrorCode;
 }
 
+int32_t uShortRangeEdmStreamGetPbufStatistics(int32_t handle,
+                                              uShortRangePbufPoolStatistics_t *pStats)
+{
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+
+    if (pInstance != NULL) {
+
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((handle == pInstance->handle) && (pInstance->pPool != NULL)) {
+            errorCode = uShortRangePbufPoolGetStatistics(pInstance->pPool, pStats);
+        }
+
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
+    }
+
+    return errorCode;
+}
+
 int32_t uShortRangeEdmStreamAtGetReceiveSize(int32_t handle)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = pGetInstance(handle);
     int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
 
-    if (gMutex != NULL) {
+    if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_LOCK(pInstance->mutex);
 
         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-        if (handle == gEdmStream.handle) {
-            sizeOrErrorCode = gEdmStream.atResponseLength - gEdmStream.atResponseRead;
+        if (handle == pInstance->handle) {
+            sizeOrErrorCode = pInstance->atResponseLength - pInstance->atResponseRead;
         }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(pInstance->mutex);
     }
 
     return sizeOrErrorCode;
@@ -21,6 +21,7 @@
 #include "u_assert.h"
 #include "u_port_debug.h"
 #include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_error_common.h"
 #include "u_short_range_pbuf.h"
 #include "u_mempool.h"
@@ -37,12 +38,18 @@
 #endif
 
 #ifndef U_SHORT_RANGE_PBUF_COUNT
-#define U_SHORT_RANGE_PBUF_COUNT      (32)
+#define U_SHORT_RANGE_PBUF_COUNT      U_SHORT_RANGE_EDM_BLK_COUNT
 #endif
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** A pool of pbufs and of the pbuf lists they are put on.
+ */
+struct uShortRangePbufPool_t {
+    uMemPoolDesc_t pBufListPool;
+    uMemPoolDesc_t pBufPool;
+};
 
 /* ----------------------------------------------------------------
  * STATIC PROTOTYPES
@@ -52,30 +59,84 @@
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
 
-static uMemPoolDesc_t gPBufListPool = {0};
-static uMemPoolDesc_t gPBufPool = {0};
+/** The default pool.
+ */
+static uShortRangePbufPool_t gPool = {0};
+
+/** The sizing of pools, as set by uShortRangeMemPoolInitConfig().
+ */
+static uShortRangePbufPoolConfig_t gConfig = {0};
 
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
-static void freePbuf(uShortRangePbuf_t *pBuf, bool freeWholeChain)
+static void freePbuf(uShortRangePbufPool_t *pPool, uShortRangePbuf_t *pBuf,
+                     bool freeWholeChain)
 {
     if (freeWholeChain) {
         while (pBuf != NULL) {
             uShortRangePbuf_t *pNext = pBuf->pNext;
             // Basic sanity check - pbuf length should never be longer than pool block size
-            U_ASSERT(pBuf->length <= gPBufPool.blockSize);
-            uMemPoolFreeMem(&gPBufPool, pBuf);
+            U_ASSERT(pBuf->length <= pPool->pBufPool.blockSize);
+            uMemPoolFreeMem(&pPool->pBufPool, pBuf);
             pBuf = pNext;
         }
     } else if (pBuf != NULL) {
         // Basic sanity check - pbuf length should never be longer than pool block size
-        U_ASSERT(pBuf->length <= gPBufPool.blockSize);
-        uMemPoolFreeMem(&gPBufPool, pBuf);
+        U_ASSERT(pBuf->length <= pPool->pBufPool.blockSize);
+        uMemPoolFreeMem(&pPool->pBufPool, pBuf);
     }
 }
 
+// Initialise the memory pools of a pbuf pool.
+static int32_t poolInit(uShortRangePbufPool_t *pPool)
+{
+    int32_t pbufListCount = U_SHORT_RANGE_PBUFLIST_COUNT;
+    int32_t pbufCount = U_SHORT_RANGE_PBUF_COUNT;
+    int32_t err;
+
+    if (gConfig.pbufListCount > 0) {
+        pbufListCount = gConfig.pbufListCount;
+    }
+    if (gConfig.pbufCount > 0) {
+        pbufCount = gConfig.pbufCount;
+    }
+
+    err = uMemPoolInit(&pPool->pBufListPool, sizeof(uShortRangePbufList_t),
+                       pbufListCount);
+    if (err == 0) {
+        err = uMemPoolSetGrowth(&pPool->pBufListPool, gConfig.pbufListGrowCount,
+                                gConfig.pbufListMaxCount);
+        if ((err == 0) && (gConfig.pbufListGrowCount == 0)) {
+            // A pool that cannot grow can be lock-free, so that
+            // the EDM receive path takes no mutex per frame
+            err = uMemPoolSetLockFree(&pPool->pBufListPool);
+        }
+        if (err == 0) {
+            err = uMemPoolInit(&pPool->pBufPool, sizeof(uShortRangePbuf_t) + U_SHORT_RANGE_EDM_BLK_SIZE,
+                               pbufCount);
+            if (err == 0) {
+                err = uMemPoolSetGrowth(&pPool->pBufPool, gConfig.pbufGrowCount,
+                                        gConfig.pbufMaxCount);
+                if ((err == 0) && (gConfig.pbufGrowCount == 0)) {
+                    err = uMemPoolSetLockFree(&pPool->pBufPool);
+                }
+                if (err != (int32_t)U_ERROR_COMMON_SUCCESS) {
+                    uMemPoolDeinit(&pPool->pBufPool);
+                }
+            }
+        }
+
+        if (err != (int32_t)U_ERROR_COMMON_SUCCESS) {
+            uMemPoolDeinit(&pPool->pBufListPool);
+            // Deinit will also set the mutex to NULL again
+        }
+    }
+
+    return err;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -84,19 +145,25 @@ int32_t uShortRangeMemPoolInit(void)
 {
     int32_t err = (int32_t)U_ERROR_COMMON_SUCCESS;
 
-    if ((gPBufListPool.mutex == NULL) && (gPBufPool.mutex == NULL)) {
-        err = uMemPoolInit(&gPBufListPool, sizeof(uShortRangePbufList_t),
-                           U_SHORT_RANGE_PBUFLIST_COUNT);
+    if ((gPool.pBufListPool.mutex == NULL) && (gPool.pBufPool.mutex == NULL)) {
+        err = poolInit(&gPool);
+    }
 
-        if (err == 0) {
-            err = uMemPoolInit(&gPBufPool, sizeof(uShortRangePbuf_t) + U_SHORT_RANGE_EDM_BLK_SIZE,
-                               U_SHORT_RANGE_EDM_BLK_COUNT);
+    return err;
+}
 
-            if (err != (int32_t)U_ERROR_COMMON_SUCCESS) {
-                uMemPoolDeinit(&gPBufListPool);
-                // Deinit will also set the mutex to NULL again
-            }
-        }
+int32_t uShortRangeMemPoolInitConfig(const uShortRangePbufPoolConfig_t *pConfig)
+{
+    int32_t err = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    uShortRangePbufPoolConfig_t config = {0};
+
+    if (pConfig != NULL) {
+        config = *pConfig;
+    }
+    if ((config.pbufCount >= 0) && (config.pbufListCount >= 0) &&
+        (config.pbufGrowCount >= 0) && (config.pbufListGrowCount >= 0)) {
+        gConfig = config;
+        err = uShortRangeMemPoolInit();
     }
 
     return err;
@@ -104,39 +171,109 @@ int32_t uShortRangeMemPoolInit(void)
 
 void uShortRangeMemPoolDeInit(void)
 {
-    uMemPoolDeinit(&gPBufPool);
-    uMemPoolDeinit(&gPBufListPool);
+    uMemPoolDeinit(&gPool.pBufPool);
+    uMemPoolDeinit(&gPool.pBufListPool);
     // Deinit will also set the mutex to NULL again
 }
 
-int32_t uShortRangePbufAlloc(uShortRangePbuf_t **ppBuf)
+int32_t uShortRangePbufPoolGetStatistics(uShortRangePbufPool_t *pPool,
+                                         uShortRangePbufPoolStatistics_t *pStats)
+{
+    int32_t err = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    uMemPoolStatistics_t stats;
+
+    if (pPool == NULL) {
+        pPool = &gPool;
+    }
+    if (pStats != NULL) {
+        err = uMemPoolGetStatistics(&pPool->pBufPool, &stats);
+        if (err == 0) {
+            pStats->pbufCount = stats.totalBlockCount;
+            pStats->pbufUsedCount = stats.usedBlockCount;
+            pStats->pbufUsedMaxCount = stats.maxUsedBlockCount;
+            pStats->pbufAllocFailCount = stats.allocFailCount;
+            err = uMemPoolGetStatistics(&pPool->pBufListPool, &stats);
+            if (err == 0) {
+                pStats->pbufListCount = stats.totalBlockCount;
+                pStats->pbufListUsedCount = stats.usedBlockCount;
+                pStats->pbufListUsedMaxCount = stats.maxUsedBlockCount;
+                pStats->pbufListAllocFailCount = stats.allocFailCount;
+            }
+        }
+    }
+
+    return err;
+}
+
+int32_t uShortRangePbufPoolCreate(uShortRangePbufPool_t **ppPool)
+{
+    int32_t err = (int32_t)U_ERROR_COMMON_NO_MEMORY;
+    uShortRangePbufPool_t *pPool;
+
+    pPool = (uShortRangePbufPool_t *)pUPortMalloc(sizeof(uShortRangePbufPool_t));
+    if (pPool != NULL) {
+        memset(pPool, 0, sizeof(*pPool));
+        err = poolInit(pPool);
+        if (err == (int32_t)U_ERROR_COMMON_SUCCESS) {
+            *ppPool = pPool;
+        } else {
+            uPortFree(pPool);
+        }
+    }
+
+    return err;
+}
+
+void uShortRangePbufPoolDelete(uShortRangePbufPool_t *pPool)
+{
+    if (pPool != NULL) {
+        uMemPoolDeinit(&pPool->pBufPool);
+        uMemPoolDeinit(&pPool->pBufListPool);
+        uPortFree(pPool);
+    }
+}
+
+int32_t uShortRangePbufPoolAlloc(uShortRangePbufPool_t *pPool,
+                                 uShortRangePbuf_t **ppBuf)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-    *ppBuf = (uShortRangePbuf_t *)uMemPoolAllocMem(&gPBufPool);
+    *ppBuf = (uShortRangePbuf_t *)uMemPoolAllocMem(&pPool->pBufPool);
     if (*ppBuf != NULL) {
         (*ppBuf)->length = 0;
+        (*ppBuf)->offset = 0;
         (*ppBuf)->pNext = NULL;
-        errorCode = gPBufPool.blockSize - sizeof(uShortRangePbuf_t);
+        errorCode = pPool->pBufPool.blockSize - sizeof(uShortRangePbuf_t);
     }
     return errorCode;
 }
 
-uShortRangePbufList_t *pUShortRangePbufListAlloc(void)
+uShortRangePbufList_t *pUShortRangePbufPoolListAlloc(uShortRangePbufPool_t *pPool)
 {
     uShortRangePbufList_t *pList;
-    pList = (uShortRangePbufList_t *)uMemPoolAllocMem(&gPBufListPool);
+    pList = (uShortRangePbufList_t *)uMemPoolAllocMem(&pPool->pBufListPool);
     if (pList != NULL) {
         memset(pList, 0, sizeof(uShortRangePbufList_t));
+        pList->pPool = pPool;
     }
     return pList;
 }
 
+int32_t uShortRangePbufAlloc(uShortRangePbuf_t **ppBuf)
+{
+    return uShortRangePbufPoolAlloc(&gPool, ppBuf);
+}
+
+uShortRangePbufList_t *pUShortRangePbufListAlloc(void)
+{
+    return pUShortRangePbufPoolListAlloc(&gPool);
+}
+
 void uShortRangePbufListFree(uShortRangePbufList_t *pBufList)
 {
     if (pBufList != NULL) {
-        freePbuf(pBufList->pBufHead, true);
+        freePbuf(pBufList->pPool, pBufList->pBufHead, true);
         pBufList->totalLen = 0;
-        uMemPoolFreeMem(&gPBufListPool, pBufList);
+        uMemPoolFreeMem(&pBufList->pPool->pBufListPool, pBufList);
     }
 }
 
@@ -166,6 +303,7 @@ void uShortRangePbufListMerge(uShortRangePbufList_t *pOldList, uShortRangePbufLi
         (pOldList->totalLen > 0) &&
         (pNewList->totalLen > 0)) {
 
+        U_ASSERT(pOldList->pPool == pNewList->pPool);
         if (pOldList->pBufTail != NULL) {
             pOldList->pBufTail->pNext = pNewList->pBufHead;
             pOldList->pBufTail = pNewList->pBufTail;
@@ -174,7 +312,7 @@ void uShortRangePbufListMerge(uShortRangePbufList_t *pOldList, uShortRangePbufLi
             *pOldList = *pNewList;
         }
 
-        uMemPoolFreeMem(&gPBufListPool, pNewList);
+        uMemPoolFreeMem(&pNewList->pPool->pBufListPool, pNewList);
     }
 }
 
@@ -183,41 +321,80 @@ size_t uShortRangePbufListConsumeData(uShortRangePbufList_t *pBufList, char *pDa
 {
     size_t copiedLen = 0;
     uShortRangePbuf_t *pTemp;
-    uShortRangePbuf_t *pNext = NULL;
+    size_t x;
 
     if ((pBufList != NULL) && (pData != NULL)) {
+        // Copy out of the pbufs as they stand, then consume
+        // what was copied in one go
+        for (pTemp = pBufList->pBufHead;
+             (copiedLen < len) && (pTemp != NULL); pTemp = pTemp->pNext) {
+            x = pTemp->length;
+            if (x > len - copiedLen) {
+                x = len - copiedLen;
+            }
+            memcpy(&pData[copiedLen], &pTemp->data[pTemp->offset], x);
+            copiedLen += x;
+        }
+        uShortRangePbufListSkip(pBufList, copiedLen);
+    }
+
+    return copiedLen;
+}
+
+size_t uShortRangePbufListPeek(const uShortRangePbufList_t *pBufList,
+                               size_t index, const char **ppData)
+{
+    size_t size = 0;
+    uShortRangePbuf_t *pTemp = NULL;
 
+    if ((pBufList != NULL) && (ppData != NULL)) {
+        for (pTemp = pBufList->pBufHead; (index > 0) && (pTemp != NULL); pTemp = pTemp->pNext) {
+            index--;
+        }
+        if (pTemp != NULL) {
+            *ppData = &pTemp->data[pTemp->offset];
+            size = pTemp->length;
+        }
+    }
+
+    return size;
+}
+
+size_t uShortRangePbufListSkip(uShortRangePbufList_t *pBufList, size_t len)
+{
+    size_t skippedLen = 0;
+    uShortRangePbuf_t *pTemp;
+    uShortRangePbuf_t *pNext = NULL;
+
+    if (pBufList != NULL) {
         for (pTemp = pBufList->pBufHead; (len != 0 && pTemp != NULL); pTemp = pNext) {
             // Basic sanity check - pbuf length should never be longer than pool block size
-            U_ASSERT(pTemp->length <= gPBufPool.blockSize);
+            U_ASSERT(pTemp->offset + pTemp->length <= pBufList->pPool->pBufPool.blockSize);
 
             if (pTemp->length <= len) {
-                // Copy the data to the given buffer
-                memcpy(&pData[copiedLen], &pTemp->data[0], pTemp->length);
-                copiedLen += pTemp->length;
+                skippedLen += pTemp->length;
                 pBufList->totalLen -= pTemp->length;
                 len -= pTemp->length;
                 pNext = pTemp->pNext;
                 // We are done with this pbuf - put it back in the pool
-                freePbuf(pTemp, false);
+                freePbuf(pBufList->pPool, pTemp, false);
                 pBufList->pBufHead = pNext;
                 if (pBufList->pBufHead == NULL) {
                     pBufList->pBufTail = NULL;
                 }
             } else {
-                // Do partial copy
-                memcpy(&pData[copiedLen], &pTemp->data[0], len);
-                copiedLen += len;
+                // Partial consumption: just move the start of the
+                // unread data on, no need to shift it down
+                skippedLen += len;
                 pBufList->totalLen -= (uint16_t)len;
                 pTemp->length -= (uint16_t)len;
-                // move the remaining data to start
-                memmove(&pTemp->data[0], &pTemp->data[len], pTemp->length);
+                pTemp->offset += (uint16_t)len;
                 len = 0;
             }
         }
     }
 
-    return copiedLen;
+    return skippedLen;
 }
 
 
@@ -290,4 +467,26 @@ int32_t uShortRangePktListConsumePacket(uShortRangePktList_t *pPktList, char *pD
 
     return err;
 }
+
+int32_t uShortRangePktListDropPacket(uShortRangePktList_t *pPktList)
+{
+    int32_t err = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    uShortRangePbufList_t *pTemp;
+
+    if (pPktList != NULL) {
+        err = (int32_t)U_ERROR_COMMON_EMPTY;
+        pTemp = pPktList->pBufListHead;
+        if ((pPktList->pktCount > 0) && (pTemp != NULL)) {
+            pPktList->pBufListHead = pTemp->pNext;
+            pPktList->pktCount--;
+            uShortRangePbufListFree(pTemp);
+            if (pPktList->pktCount == 0) {
+                memset((void *)pPktList, 0, sizeof(uShortRangePktList_t));
+            }
+            err = (int32_t)U_ERROR_COMMON_SUCCESS;
+        }
+    }
+
+    return err;
+}
 // End of file
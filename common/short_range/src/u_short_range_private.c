@@ -31,8 +31,11 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // memset(), strlen(), strcmp()
 
+#include "u_port.h"
 #include "u_port_os.h"
+#include "u_port_heap.h"
 
 #include "u_at_client.h"
 
@@ -50,6 +53,14 @@
  * TYPES
  * -------------------------------------------------------------- */
 
+/** An entry in the peer pool.
+ */
+typedef struct {
+    volatile int32_t peerHandle; /**< -1 if the entry is free. */
+    int32_t idleSinceMs;
+    char url[U_SHORT_RANGE_PEER_POOL_URL_MAX_LENGTH_BYTES];
+} uShortRangePrivatePeer_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES THAT ARE SHARED THROUGHOUT THE SHORT RANGE IMPLEMENTATION
  * -------------------------------------------------------------- */
@@ -61,44 +72,43 @@ uShortRangePrivateInstance_t *gpUShortRangePrivateInstanceList = NULL;
 const uShortRangePrivateModule_t gUShortRangePrivateModuleList[] = {
     {
         U_SHORT_RANGE_MODULE_TYPE_ANNA_B1,
-        (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER) /* features */,
+        U_SHORT_RANGE_PRIVATE_FEATURES_ANNA_B1 /* features */,
         5 /* Boot wait */, 5 /* Min awake */,
         5 /* Pwr down wait */, 5 /* Reboot wait */, 10 /* AT timeout */,
     },
     {
         U_SHORT_RANGE_MODULE_TYPE_NINA_B1,
-        (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER) /* features */,
+        U_SHORT_RANGE_PRIVATE_FEATURES_NINA_B1 /* features */,
         5 /* Boot wait */, 5 /* Min awake */,
         5 /* Pwr down wait */, 5 /* Reboot wait */, 10 /* AT timeout */,
     },
     {
         U_SHORT_RANGE_MODULE_TYPE_NINA_B2,
-        (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER) /* features */,
+        U_SHORT_RANGE_PRIVATE_FEATURES_NINA_B2 /* features */,
         5 /* Boot wait */, 5 /* Min awake */,
         5 /* Pwr down wait */, 5 /* Reboot wait */, 10 /* AT timeout */,
     },
     {
         U_SHORT_RANGE_MODULE_TYPE_NINA_B3,
-        (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER) /* features */,
+        U_SHORT_RANGE_PRIVATE_FEATURES_NINA_B3 /* features */,
         5 /* Boot wait */, 5 /* Min awake */,
         5 /* Pwr down wait */, 5 /* Reboot wait */, 10 /* AT timeout */,
     },
     {
         U_SHORT_RANGE_MODULE_TYPE_NINA_W13,
-        (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_HTTP_CLIENT) /* features */,
+        U_SHORT_RANGE_PRIVATE_FEATURES_NINA_W13 /* features */,
         5 /* Boot wait */, 5 /* Min awake */,
         5 /* Pwr down wait */, 5 /* Reboot wait */, 10 /* AT timeout */,
     },
     {
         U_SHORT_RANGE_MODULE_TYPE_NINA_W15,
-        ((1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER) |
-         (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_HTTP_CLIENT)) /* features */,
+        U_SHORT_RANGE_PRIVATE_FEATURES_NINA_W15 /* features */,
         5 /* Boot wait */, 5 /* Min awake */,
         5 /* Pwr down wait */, 5 /* Reboot wait */, 10 /* AT timeout */,
     },
     {
         U_SHORT_RANGE_MODULE_TYPE_ODIN_W2,
-        0  /* features */,
+        U_SHORT_RANGE_PRIVATE_FEATURES_ODIN_W2 /* features */,
         5 /* Boot wait */, 5 /* Min awake */,
         5 /* Pwr down wait */, 5 /* Reboot wait */, 10 /* AT timeout */,
     }
@@ -141,6 +151,40 @@ static int32_t getServer(const uAtClientHandle_t atHandle, uShortRangeServerType
     return errorOrId;
 }
 
+// Close a peer connection.
+static void peerClose(const uAtClientHandle_t atHandle, int32_t peerHandle)
+{
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UDCPC=");
+    uAtClientWriteInt(atHandle, peerHandle);
+    uAtClientCommandStopReadResponse(atHandle);
+    uAtClientUnlock(atHandle);
+}
+
+// Close the peer connections that have been idle for too long;
+// if closeAll is true, close everything.
+static int32_t peerPoolPurge(uShortRangePrivateInstance_t *pInstance,
+                             bool closeAll)
+{
+    uShortRangePrivatePeer_t *pPeer = (uShortRangePrivatePeer_t *) pInstance->pPeerPool;
+    int32_t peerHandle;
+    int32_t count = 0;
+
+    for (size_t x = 0; (pPeer != NULL) && (x < U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES);
+         x++, pPeer++) {
+        peerHandle = pPeer->peerHandle;
+        if ((peerHandle >= 0) &&
+            (closeAll ||
+             (uPortGetTickTimeMs() - pPeer->idleSinceMs > U_SHORT_RANGE_PEER_POOL_IDLE_TIMEOUT_MS))) {
+            pPeer->peerHandle = -1;
+            peerClose(pInstance->atHandle, peerHandle);
+            count++;
+        }
+    }
+
+    return count;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS THAT ARE PRIVATE TO SHORT RANGE
  * -------------------------------------------------------------- */
@@ -171,6 +215,128 @@ const uShortRangePrivateModule_t *pUShortRangePrivateGetModule(uDeviceHandle_t d
     return pModule;
 }
 
+// Store the settings and restart, or defer that if batching.
+int32_t uShortRangePrivateStoreAndRestart(uShortRangePrivateInstance_t *pInstance,
+                                          int32_t waitMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+
+    if (pInstance->cfgBatch) {
+        pInstance->cfgRestartPending = true;
+        if (waitMs > pInstance->cfgRestartWaitMs) {
+            pInstance->cfgRestartWaitMs = waitMs;
+        }
+    } else {
+        uAtClientLock(atHandle);
+        uAtClientCommandStart(atHandle, "AT&W");
+        uAtClientCommandStopReadResponse(atHandle);
+        errorCode = uAtClientUnlock(atHandle);
+
+        if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+            uAtClientLock(atHandle);
+            uAtClientCommandStart(atHandle, "AT+CPWROFF");
+            uAtClientCommandStopReadResponse(atHandle);
+            errorCode = uAtClientUnlock(atHandle);
+
+            if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                uPortTaskBlock(waitMs);
+                uAtClientFlush(atHandle);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Take a connection from the peer pool.
+int32_t uShortRangePrivatePeerPoolTake(uShortRangePrivateInstance_t *pInstance,
+                                       const char *pUrl)
+{
+    int32_t errorCodeOrPeerHandle = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+    uShortRangePrivatePeer_t *pPeer = (uShortRangePrivatePeer_t *) pInstance->pPeerPool;
+    int32_t peerHandle;
+
+    peerPoolPurge(pInstance, false);
+    for (size_t x = 0; (pPeer != NULL) && (x < U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES) &&
+         (errorCodeOrPeerHandle < 0); x++, pPeer++) {
+        // Read the handle once, it may be cleared by a URC
+        peerHandle = pPeer->peerHandle;
+        if ((peerHandle >= 0) && (strcmp(pPeer->url, pUrl) == 0)) {
+            pPeer->peerHandle = -1;
+            errorCodeOrPeerHandle = peerHandle;
+        }
+    }
+
+    return errorCodeOrPeerHandle;
+}
+
+// Give a connection to the peer pool.
+bool uShortRangePrivatePeerPoolGive(uShortRangePrivateInstance_t *pInstance,
+                                    const char *pUrl, int32_t peerHandle)
+{
+    uShortRangePrivatePeer_t *pPeer;
+    uShortRangePrivatePeer_t *pOldest = NULL;
+    uShortRangePrivatePeer_t *pFree = NULL;
+
+    if ((U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES > 0) && (peerHandle >= 0) &&
+        (strlen(pUrl) < U_SHORT_RANGE_PEER_POOL_URL_MAX_LENGTH_BYTES)) {
+        if (pInstance->pPeerPool == NULL) {
+            pInstance->pPeerPool = pUPortMalloc(sizeof(uShortRangePrivatePeer_t) *
+                                                U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES);
+            if (pInstance->pPeerPool != NULL) {
+                pPeer = (uShortRangePrivatePeer_t *) pInstance->pPeerPool;
+                for (size_t x = 0; x < U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES; x++, pPeer++) {
+                    pPeer->peerHandle = -1;
+                }
+            }
+        }
+        peerPoolPurge(pInstance, false);
+        pPeer = (uShortRangePrivatePeer_t *) pInstance->pPeerPool;
+        for (size_t x = 0; (pPeer != NULL) && (x < U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES) &&
+             (pFree == NULL); x++, pPeer++) {
+            if (pPeer->peerHandle < 0) {
+                pFree = pPeer;
+            } else if ((pOldest == NULL) || (pPeer->idleSinceMs - pOldest->idleSinceMs < 0)) {
+                pOldest = pPeer;
+            }
+        }
+        if ((pFree == NULL) && (pOldest != NULL)) {
+            // Make room by closing the one that has been idle longest
+            peerClose(pInstance->atHandle, pOldest->peerHandle);
+            pOldest->peerHandle = -1;
+            pFree = pOldest;
+        }
+        if (pFree != NULL) {
+            strncpy(pFree->url, pUrl, sizeof(pFree->url));
+            pFree->idleSinceMs = uPortGetTickTimeMs();
+            pFree->peerHandle = peerHandle;
+        }
+    }
+
+    return (pFree != NULL);
+}
+
+// Remove a disconnected peer from the pool.
+void uShortRangePrivatePeerPoolDisconnected(uShortRangePrivateInstance_t *pInstance,
+                                            int32_t peerHandle)
+{
+    uShortRangePrivatePeer_t *pPeer = (uShortRangePrivatePeer_t *) pInstance->pPeerPool;
+
+    for (size_t x = 0; (pPeer != NULL) && (x < U_SHORT_RANGE_PEER_POOL_NUM_ENTRIES);
+         x++, pPeer++) {
+        if (pPeer->peerHandle == peerHandle) {
+            pPeer->peerHandle = -1;
+        }
+    }
+}
+
+// Close everything in the peer pool.
+int32_t uShortRangePrivatePeerPoolFlush(uShortRangePrivateInstance_t *pInstance)
+{
+    return peerPoolPurge(pInstance, true);
+}
+
 int32_t uShortRangePrivateStartServer(const uAtClientHandle_t atHandle,
                                       uShortRangeServerType_t type,
                                       const char *pParam)
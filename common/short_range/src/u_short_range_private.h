@@ -45,6 +45,50 @@ extern "C" {
 
 #define U_SHORT_RANGE_MAX_CONNECTIONS 9
 
+/** The feature bit-maps of the modules, one per entry in
+ * gUShortRangePrivateModuleList, made up of
+ * uShortRangePrivateFeature_t bits and named
+ * U_SHORT_RANGE_PRIVATE_FEATURES_ + the module type without the
+ * U_SHORT_RANGE_MODULE_TYPE_ prefix; see
+ * U_CFG_SHORT_RANGE_MODULE_ONLY.
+ */
+#define U_SHORT_RANGE_PRIVATE_FEATURES_ANNA_B1                        \
+    (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER)
+
+#define U_SHORT_RANGE_PRIVATE_FEATURES_NINA_B1                        \
+    (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER)
+
+#define U_SHORT_RANGE_PRIVATE_FEATURES_NINA_B2                        \
+    (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER)
+
+#define U_SHORT_RANGE_PRIVATE_FEATURES_NINA_B3                        \
+    (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER)
+
+#define U_SHORT_RANGE_PRIVATE_FEATURES_NINA_W13                       \
+    (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_HTTP_CLIENT)
+
+#define U_SHORT_RANGE_PRIVATE_FEATURES_NINA_W15                       \
+    ((1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_GATT_SERVER) |   \
+     (1UL << (int32_t) U_SHORT_RANGE_PRIVATE_FEATURE_HTTP_CLIENT))
+
+#define U_SHORT_RANGE_PRIVATE_FEATURES_ODIN_W2 0
+
+/** Paste the expanded value of a macro onto a prefix.
+ */
+#define U_SHORT_RANGE_PRIVATE_PASTE_(a, b) a##b
+#define U_SHORT_RANGE_PRIVATE_PASTE(a, b) U_SHORT_RANGE_PRIVATE_PASTE_(a, b)
+
+#ifdef U_CFG_SHORT_RANGE_MODULE_ONLY
+/** U_CFG_SHORT_RANGE_MODULE_ONLY may be defined to the module type,
+ * minus the U_SHORT_RANGE_MODULE_TYPE_ prefix (e.g. NINA_W15), for
+ * a build that only ever talks to that one type of module; adding
+ * any other module type will then fail and feature checks are
+ * resolved at compile time.
+ */
+# define U_SHORT_RANGE_PRIVATE_MODULE_TYPE_ONLY U_SHORT_RANGE_PRIVATE_PASTE(U_SHORT_RANGE_MODULE_TYPE_, U_CFG_SHORT_RANGE_MODULE_ONLY)
+# define U_SHORT_RANGE_PRIVATE_FEATURES_ONLY U_SHORT_RANGE_PRIVATE_PASTE(U_SHORT_RANGE_PRIVATE_FEATURES_, U_CFG_SHORT_RANGE_MODULE_ONLY)
+#endif
+
 /** Determine if the given feature is supported or not
  * by the pointed-to module.
  */
@@ -52,8 +96,13 @@ extern "C" {
 // evaluates to True
 //lint -esym(755, U_SHORT_RANGE_PRIVATE_HAS) Suppress macro not
 // referenced it may be conditionally compiled-out.
-#define U_SHORT_RANGE_PRIVATE_HAS(pModule, feature) \
+#ifdef U_CFG_SHORT_RANGE_MODULE_ONLY
+# define U_SHORT_RANGE_PRIVATE_HAS(pModule, feature) \
+    ((pModule != NULL) && ((U_SHORT_RANGE_PRIVATE_FEATURES_ONLY) & (1UL << (int32_t) (feature))))
+#else
+# define U_SHORT_RANGE_PRIVATE_HAS(pModule, feature) \
     ((pModule != NULL) && ((pModule->featuresBitmap) & (1UL << (int32_t) (feature))))
+#endif
 
 /* ----------------------------------------------------------------
  * TYPES
@@ -156,6 +205,13 @@ typedef struct uShortRangePrivateInstance_t {
     uWifiHttpCallback_t *pWifiHttpCallBack;
     uPortMutexHandle_t locMutex;
     volatile void *pLocContext;
+    void *pWifiScanCache; /**< the results of the last Wi-Fi scan, freed with the instance. */
+    void *pWifiConnectCache; /**< the Wi-Fi fast connect cache, freed with the instance. */
+    void *pWifiLocCache; /**< the Wi-Fi location result cache, freed with the instance. */
+    bool cfgBatch; /**< true between uShortRangeCfgBatchStart() and uShortRangeCfgBatchEnd(). */
+    bool cfgRestartPending; /**< a store-and-restart was deferred while cfgBatch was true. */
+    int32_t cfgRestartWaitMs; /**< the longest wait after restart that was asked for. */
+    void *pPeerPool; /**< the idle peer connection pool, freed with the instance. */
     struct uShortRangePrivateInstance_t *pNext;
 } uShortRangePrivateInstance_t;
 
@@ -219,6 +275,65 @@ bool uShortRangePrivateIsRegistered(const uShortRangePrivateInstance_t *pInstanc
 //lint -esym(765, pUShortRangePrivateGetModule) may be compiled-out in various ways
 const uShortRangePrivateModule_t *pUShortRangePrivateGetModule(uDeviceHandle_t devHandle);
 
+/** Store the settings of the module with AT&W and restart it or,
+ * if a configuration batch has been started with
+ * uShortRangeCfgBatchStart(), just remember that this needs to be
+ * done so that uShortRangeCfgBatchEnd() can do it once for all.
+ * Note: gUShortRangePrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the ShortRange instance.
+ * @param waitMs         how long to wait after the restart before
+ *                       talking to the module again.
+ * @return               zero on success or negative error code.
+ */
+int32_t uShortRangePrivateStoreAndRestart(uShortRangePrivateInstance_t *pInstance,
+                                          int32_t waitMs);
+
+/** Take a connection to the given peer URL from the peer pool; the
+ * connection is then no longer in the pool.
+ * Note: gUShortRangePrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the ShortRange instance.
+ * @param[in] pUrl       the URL exactly as it was passed to AT+UDCP.
+ * @return               the peer handle, else negative error code,
+ *                       #U_ERROR_COMMON_NOT_FOUND if there is no pooled
+ *                       connection to that peer URL.
+ */
+int32_t uShortRangePrivatePeerPoolTake(uShortRangePrivateInstance_t *pInstance,
+                                       const char *pUrl);
+
+/** Give an open peer connection, that is no longer needed, to the
+ * peer pool; if the pool is full the connection that has been idle
+ * the longest is closed to make room.
+ * Note: gUShortRangePrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the ShortRange instance.
+ * @param[in] pUrl       the URL exactly as it was passed to AT+UDCP.
+ * @param peerHandle     the peer handle.
+ * @return               true if the pool now has the connection, false
+ *                       if it could not be pooled, in which case the
+ *                       caller should close it.
+ */
+bool uShortRangePrivatePeerPoolGive(uShortRangePrivateInstance_t *pInstance,
+                                    const char *pUrl, int32_t peerHandle);
+
+/** Remove a peer that has been disconnected by the far end from the
+ * peer pool, if it is there; may be called from a URC handler.
+ *
+ * @param[in] pInstance  a pointer to the ShortRange instance.
+ * @param peerHandle     the peer handle.
+ */
+void uShortRangePrivatePeerPoolDisconnected(uShortRangePrivateInstance_t *pInstance,
+                                            int32_t peerHandle);
+
+/** Close all of the connections in the peer pool.
+ * Note: gUShortRangePrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the ShortRange instance.
+ * @return               the number of connections closed.
+ */
+int32_t uShortRangePrivatePeerPoolFlush(uShortRangePrivateInstance_t *pInstance);
+
 /** Start a short range server instance id based on the type.
  *
  * @param atHandle       the handle of the device AT client.
@@ -166,6 +166,9 @@ U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeOpenUart")
     uShortRangeAtClientHandleGet(gHandles.devHandle, &atClient);
     U_PORT_TEST_ASSERT(gHandles.atClientHandle == atClient);
     U_PORT_TEST_ASSERT(uShortRangeAttention(gHandles.devHandle) == 0);
+    // Nothing has been put in the peer pool
+    U_PORT_TEST_ASSERT(uShortRangePeerPoolFlush(NULL) < 0);
+    U_PORT_TEST_ASSERT(uShortRangePeerPoolFlush(gHandles.devHandle) == 0);
 
     U_TEST_PRINT_LINE("calling uShortRangeOpenUart with same arg twice,"
                       " should fail...");
@@ -253,6 +253,64 @@ U_PORT_TEST_FUNCTION("[pbuf]", "pbufPktList")
     errCode = uShortRangePktListConsumePacket(&pktList, pBuffer3, &totalLen, NULL);
     U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_EMPTY);
 
+    // Dropping a packet without reading it
+    errCode = uShortRangePktListDropPacket(NULL);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_INVALID_PARAMETER);
+    errCode = uShortRangePktListDropPacket(&pktList);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_EMPTY);
+
+    // Make up two packets again, with fresh data
+    pPbufList1 = pUShortRangePbufListAlloc();
+    U_PORT_TEST_ASSERT(pPbufList1 != NULL);
+    pPbufList2 = pUShortRangePbufListAlloc();
+    U_PORT_TEST_ASSERT(pPbufList2 != NULL);
+    for (i = 0; i < numOfBlks / 2; i++) {
+        int32_t sizeOfBlk = generatePayLoad(&pBuf);
+        U_PORT_TEST_ASSERT(sizeOfBlk > 0);
+        errCode = uShortRangePbufListAppend(pPbufList1, pBuf);
+        U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    }
+    for (i = 0; i < numOfBlks / 2; i++) {
+        int32_t sizeOfBlk = generatePayLoad(&pBuf);
+        U_PORT_TEST_ASSERT(sizeOfBlk > 0);
+        memcpy(&pBuffer2[i * sizeOfBlk], &pBuf->data[0], sizeOfBlk);
+        errCode = uShortRangePbufListAppend(pPbufList2, pBuf);
+        U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    }
+    errCode = uShortRangePktListAppend(&pktList, pPbufList1);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    errCode = uShortRangePktListAppend(&pktList, pPbufList2);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+
+    // Drop the first: the second should then be the one read out
+    errCode = uShortRangePktListDropPacket(&pktList);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    U_PORT_TEST_ASSERT(pktList.pktCount == 1);
+    memset(pBuffer3, 0, totalLen);
+    //lint -e{679} suppress loss of precision
+    //lint -e{647} suppress suspicious truncation
+    totalLen = numOfBlks * U_SHORT_RANGE_EDM_BLK_SIZE;
+    errCode = uShortRangePktListConsumePacket(&pktList, pBuffer3, &totalLen, NULL);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    errCode = memcmp(pBuffer3, pBuffer2, totalLen);
+    U_PORT_TEST_ASSERT(errCode == 0);
+    U_PORT_TEST_ASSERT(pktList.pktCount == 0);
+
+    // Drop the last packet, leaving the list empty
+    pPbufList1 = pUShortRangePbufListAlloc();
+    U_PORT_TEST_ASSERT(pPbufList1 != NULL);
+    U_PORT_TEST_ASSERT(generatePayLoad(&pBuf) > 0);
+    errCode = uShortRangePbufListAppend(pPbufList1, pBuf);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    errCode = uShortRangePktListAppend(&pktList, pPbufList1);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    errCode = uShortRangePktListDropPacket(&pktList);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    U_PORT_TEST_ASSERT((pktList.pktCount == 0) && (pktList.pBufListHead == NULL) &&
+                       (pktList.pBufListTail == NULL));
+    errCode = uShortRangePktListDropPacket(&pktList);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_EMPTY);
+
     uShortRangeMemPoolDeInit();
     uPortFree(pBuffer1);
     uPortFree(pBuffer2);
@@ -265,4 +323,251 @@ U_PORT_TEST_FUNCTION("[pbuf]", "pbufPktList")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Check that pbuf pools, one per EDM stream, are independent:
+ * exhausting one leaves the other untouched and a pbuf list goes
+ * back to the pool it came from.
+ */
+U_PORT_TEST_FUNCTION("[pbuf]", "pbufPoolIndependent")
+{
+    int32_t errCode;
+    uShortRangePbufPool_t *pPool1 = NULL;
+    uShortRangePbufPool_t *pPool2 = NULL;
+    uShortRangePbufList_t *pPbufList1;
+    uShortRangePbufList_t *pPbufList2;
+    uShortRangePbuf_t *pBuf;
+    int32_t resourceCount;
+    int32_t i;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    errCode = uShortRangePbufPoolCreate(&pPool1);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    U_PORT_TEST_ASSERT(pPool1 != NULL);
+    errCode = uShortRangePbufPoolCreate(&pPool2);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    U_PORT_TEST_ASSERT(pPool2 != NULL);
+
+    pPbufList1 = pUShortRangePbufPoolListAlloc(pPool1);
+    U_PORT_TEST_ASSERT(pPbufList1 != NULL);
+    U_PORT_TEST_ASSERT(pPbufList1->pPool == pPool1);
+
+    // Use up all of the pbufs of the first pool
+    for (i = 0; i < U_SHORT_RANGE_EDM_BLK_COUNT; i++) {
+        errCode = uShortRangePbufPoolAlloc(pPool1, &pBuf);
+        U_PORT_TEST_ASSERT(errCode == U_SHORT_RANGE_EDM_BLK_SIZE);
+        pBuf->length = 1;
+        errCode = uShortRangePbufListAppend(pPbufList1, pBuf);
+        U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    }
+    U_PORT_TEST_ASSERT(uShortRangePbufPoolAlloc(pPool1, &pBuf) < 0);
+
+    // The second pool should be unaffected
+    pPbufList2 = pUShortRangePbufPoolListAlloc(pPool2);
+    U_PORT_TEST_ASSERT(pPbufList2 != NULL);
+    U_PORT_TEST_ASSERT(pPbufList2->pPool == pPool2);
+    errCode = uShortRangePbufPoolAlloc(pPool2, &pBuf);
+    U_PORT_TEST_ASSERT(errCode == U_SHORT_RANGE_EDM_BLK_SIZE);
+    pBuf->length = 1;
+    errCode = uShortRangePbufListAppend(pPbufList2, pBuf);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    uShortRangePbufListFree(pPbufList2);
+
+    // Freeing the first list should return its pbufs to the first pool
+    uShortRangePbufListFree(pPbufList1);
+    errCode = uShortRangePbufPoolAlloc(pPool1, &pBuf);
+    U_PORT_TEST_ASSERT(errCode == U_SHORT_RANGE_EDM_BLK_SIZE);
+
+    uShortRangePbufPoolDelete(pPool1);
+    uShortRangePbufPoolDelete(pPool2);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Check that the pools can be sized, that they grow as configured
+ * and that the usage statistics are counted.
+ */
+U_PORT_TEST_FUNCTION("[pbuf]", "pbufPoolConfig")
+{
+    int32_t errCode;
+    uShortRangePbufPoolConfig_t config = {0};
+    uShortRangePbufPoolStatistics_t stats;
+    uShortRangePbufPool_t *pPool = NULL;
+    uShortRangePbufList_t *pPbufList1;
+    uShortRangePbufList_t *pPbufList2;
+    uShortRangePbuf_t *pBuf;
+    int32_t resourceCount;
+    int32_t i;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    config.pbufCount = -1;
+    U_PORT_TEST_ASSERT(uShortRangeMemPoolInitConfig(&config) < 0);
+
+    // Four pbufs, able to grow two at a time to six, and two
+    // pbuf lists which cannot grow
+    config.pbufCount = 4;
+    config.pbufListCount = 2;
+    config.pbufGrowCount = 2;
+    config.pbufMaxCount = 6;
+    errCode = uShortRangeMemPoolInitConfig(&config);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    U_PORT_TEST_ASSERT(uShortRangePbufPoolGetStatistics(NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uShortRangePbufPoolGetStatistics(NULL, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.pbufCount == 4);
+    U_PORT_TEST_ASSERT(stats.pbufUsedCount == 0);
+    U_PORT_TEST_ASSERT(stats.pbufListCount == 2);
+    U_PORT_TEST_ASSERT(stats.pbufListUsedCount == 0);
+
+    // Use up all of the pbufs, including those of the growth
+    pPbufList1 = pUShortRangePbufListAlloc();
+    U_PORT_TEST_ASSERT(pPbufList1 != NULL);
+    for (i = 0; i < config.pbufMaxCount; i++) {
+        errCode = uShortRangePbufAlloc(&pBuf);
+        U_PORT_TEST_ASSERT(errCode == U_SHORT_RANGE_EDM_BLK_SIZE);
+        pBuf->length = 1;
+        errCode = uShortRangePbufListAppend(pPbufList1, pBuf);
+        U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    }
+    U_PORT_TEST_ASSERT(uShortRangePbufAlloc(&pBuf) < 0);
+    // And the pbuf lists
+    pPbufList2 = pUShortRangePbufListAlloc();
+    U_PORT_TEST_ASSERT(pPbufList2 != NULL);
+    U_PORT_TEST_ASSERT(pUShortRangePbufListAlloc() == NULL);
+
+    U_PORT_TEST_ASSERT(uShortRangePbufPoolGetStatistics(NULL, &stats) == 0);
+    U_TEST_PRINT_LINE("%d pbuf(s), %d used, max %d, %d failure(s).", stats.pbufCount,
+                      stats.pbufUsedCount, stats.pbufUsedMaxCount, stats.pbufAllocFailCount);
+    U_PORT_TEST_ASSERT(stats.pbufCount == config.pbufMaxCount);
+    U_PORT_TEST_ASSERT(stats.pbufUsedCount == config.pbufMaxCount);
+    U_PORT_TEST_ASSERT(stats.pbufUsedMaxCount == config.pbufMaxCount);
+    U_PORT_TEST_ASSERT(stats.pbufAllocFailCount == 1);
+    U_PORT_TEST_ASSERT(stats.pbufListCount == 2);
+    U_PORT_TEST_ASSERT(stats.pbufListUsedCount == 2);
+    U_PORT_TEST_ASSERT(stats.pbufListUsedMaxCount == 2);
+    U_PORT_TEST_ASSERT(stats.pbufListAllocFailCount == 1);
+
+    // Freeing brings the usage down but not the high-water marks
+    uShortRangePbufListFree(pPbufList1);
+    uShortRangePbufListFree(pPbufList2);
+    U_PORT_TEST_ASSERT(uShortRangePbufPoolGetStatistics(NULL, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.pbufUsedCount == 0);
+    U_PORT_TEST_ASSERT(stats.pbufUsedMaxCount == config.pbufMaxCount);
+    U_PORT_TEST_ASSERT(stats.pbufListUsedCount == 0);
+    U_PORT_TEST_ASSERT(stats.pbufListUsedMaxCount == 2);
+
+    // A pool created now is sized in the same way
+    errCode = uShortRangePbufPoolCreate(&pPool);
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    U_PORT_TEST_ASSERT(uShortRangePbufPoolGetStatistics(pPool, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.pbufCount == 4);
+    U_PORT_TEST_ASSERT(stats.pbufUsedCount == 0);
+    U_PORT_TEST_ASSERT(stats.pbufListCount == 2);
+    uShortRangePbufPoolDelete(pPool);
+
+    // Put the default configuration back for any tests that follow
+    uShortRangeMemPoolDeInit();
+    U_PORT_TEST_ASSERT(uShortRangeMemPoolInitConfig(NULL) == 0);
+    uShortRangeMemPoolDeInit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+U_PORT_TEST_FUNCTION("[pbuf]", "pbufPeekSkip")
+{
+    int32_t errCode;
+    uShortRangePbufList_t *pPbufList;
+    int32_t numOfBlks = 4;
+    uShortRangePbuf_t *pBuf;
+    int32_t resourceCount;
+    char *pBuffer;
+    const char *pData = NULL;
+    size_t offset = 0;
+    size_t size;
+    int32_t i;
+    //lint -e{679} suppress loss of precision
+    //lint -e{647} suppress suspicious truncation
+    size_t totalLen = numOfBlks * U_SHORT_RANGE_EDM_BLK_SIZE;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    errCode = uShortRangeMemPoolInit();
+    U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+
+    pPbufList = pUShortRangePbufListAlloc();
+    U_PORT_TEST_ASSERT(pPbufList != NULL);
+
+    pBuffer = (char *)pUPortMalloc(totalLen);
+    U_PORT_TEST_ASSERT(pBuffer != NULL);
+
+    for (i = 0; i < numOfBlks; i++) {
+        int32_t sizeOfBlk = generatePayLoad(&pBuf);
+        U_PORT_TEST_ASSERT_EQUAL(U_SHORT_RANGE_EDM_BLK_SIZE, sizeOfBlk);
+        memcpy(&pBuffer[i * sizeOfBlk], &pBuf->data[0], sizeOfBlk);
+        errCode = uShortRangePbufListAppend(pPbufList, pBuf);
+        U_PORT_TEST_ASSERT(errCode == (int32_t)U_ERROR_COMMON_SUCCESS);
+    }
+
+    // Each pbuf should be visible in place, in order
+    for (i = 0; i < numOfBlks; i++) {
+        size = uShortRangePbufListPeek(pPbufList, i, &pData);
+        U_PORT_TEST_ASSERT(size == U_SHORT_RANGE_EDM_BLK_SIZE);
+        U_PORT_TEST_ASSERT(memcmp(pData, &pBuffer[offset], size) == 0);
+        offset += size;
+    }
+    U_PORT_TEST_ASSERT(uShortRangePbufListPeek(pPbufList, i, &pData) == 0);
+
+    // Skip part of the first pbuf and the data should
+    // start further on, without having been moved
+    U_PORT_TEST_ASSERT(uShortRangePbufListPeek(pPbufList, 0, &pData) > 0);
+    U_PORT_TEST_ASSERT(uShortRangePbufListSkip(pPbufList, 3) == 3);
+    offset = 3;
+    size = uShortRangePbufListPeek(pPbufList, 0, &pData);
+    U_PORT_TEST_ASSERT(size == U_SHORT_RANGE_EDM_BLK_SIZE - offset);
+    U_PORT_TEST_ASSERT(memcmp(pData, &pBuffer[offset], size) == 0);
+    U_PORT_TEST_ASSERT(pPbufList->totalLen == totalLen - offset);
+
+    // Skip across a pbuf boundary
+    U_PORT_TEST_ASSERT(uShortRangePbufListSkip(pPbufList, size + 1) == size + 1);
+    offset += size + 1;
+    size = uShortRangePbufListPeek(pPbufList, 0, &pData);
+    U_PORT_TEST_ASSERT(size == U_SHORT_RANGE_EDM_BLK_SIZE - 1);
+    U_PORT_TEST_ASSERT(memcmp(pData, &pBuffer[offset], size) == 0);
+
+    // Skipping more than there is should consume everything
+    U_PORT_TEST_ASSERT(uShortRangePbufListSkip(pPbufList, totalLen) == totalLen - offset);
+    U_PORT_TEST_ASSERT(pPbufList->totalLen == 0);
+    U_PORT_TEST_ASSERT(pPbufList->pBufHead == NULL);
+    U_PORT_TEST_ASSERT(uShortRangePbufListPeek(pPbufList, 0, &pData) == 0);
+
+    uShortRangePbufListFree(pPbufList);
+    uShortRangeMemPoolDeInit();
+    uPortFree(pBuffer);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 // End of file
@@ -23,6 +23,7 @@
  * please keep #includes to your .c files. */
 
 #include "u_device.h" // uDeviceHandle_t
+#include "u_device_serial.h" // uDeviceSerial_t
 
 /** \addtogroup sock Sockets
  *  @{
@@ -45,7 +46,11 @@ extern "C" {
 /** A value for the maximum number of sockets that can be open
  * simultaneously is required by this API in order that if can
  * define #U_SOCK_DESCRIPTOR_SET_SIZE.  A limitation may also be
- * applied by the underlying implementation.
+ * applied by the underlying implementation.  Socket descriptors
+ * are always less than this value, which may be increased where
+ * several network devices are in use at once: looking up a socket
+ * takes the same time however large it is, the cost is one pointer
+ * of RAM per socket.
  */
 # define U_SOCK_MAX_NUM_SOCKETS 7
 #endif
@@ -57,15 +62,99 @@ extern "C" {
 #endif
 
 #ifndef U_SOCK_RECEIVE_POLL_INTERVAL_MS
-/** The interval at which this layer hits the underlying
- * network layer with a request for incoming data while
- * waiting for the uSockReceiveFrom() or uSockRead().
- * This also represents the minimum time these calls will
- * take in the non-blocking case.
+/** A blocking uSockReceiveFrom() or uSockRead() waits for
+ * the underlying network layer to indicate that data has
+ * arrived, returning as soon as it has; this is the longest
+ * that it will wait for such an indication before asking the
+ * underlying network layer for data anyway, in case an
+ * indication was missed.  It also represents the minimum time
+ * these calls will take in the non-blocking case.
  */
 # define U_SOCK_RECEIVE_POLL_INTERVAL_MS 100
 #endif
 
+#ifndef U_SOCK_SELECT_MAX_NUM_WAITING
+/** The maximum number of tasks that may be waiting in
+ * uSockSelect() at any one time.
+ */
+# define U_SOCK_SELECT_MAX_NUM_WAITING 8
+#endif
+
+#ifndef U_SOCK_WRITE_COALESCE_SIZE_BYTES
+/** The size of the buffer in which uSockWrite() collects small
+ * writes on a TCP socket when #U_SOCK_OPT_TCP_NODELAY has been
+ * set to zero: the buffer is sent when it is full, when
+ * #U_SOCK_WRITE_COALESCE_TIME_MS has passed since data was first
+ * put into it, when uSockFlush() is called or before a read or
+ * close of the socket.
+ */
+# define U_SOCK_WRITE_COALESCE_SIZE_BYTES 1024
+#endif
+
+#ifndef U_SOCK_WRITE_COALESCE_TIME_MS
+/** The longest that data may sit in the buffer of a socket on
+ * which writes are being coalesced before it is sent, see
+ * #U_SOCK_WRITE_COALESCE_SIZE_BYTES.
+ */
+# define U_SOCK_WRITE_COALESCE_TIME_MS 100
+#endif
+
+#ifndef U_SOCK_FLUSH_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that sends coalesced writes
+ * when #U_SOCK_WRITE_COALESCE_TIME_MS expires; it calls into
+ * the cellular or Wi-Fi socket layer and so needs the same
+ * stack as the AT client URC task.
+ */
+# define U_SOCK_FLUSH_TASK_STACK_SIZE_BYTES 2304
+#endif
+
+#ifndef U_SOCK_FLUSH_TASK_PRIORITY
+/** The priority of the task that sends coalesced writes.
+ */
+# define U_SOCK_FLUSH_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
+#ifndef U_SOCK_CONNECT_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that makes the connections
+ * requested with uSockConnectAsync(); it calls into the cellular
+ * or Wi-Fi socket layer and the connect callback.
+ */
+# define U_SOCK_CONNECT_TASK_STACK_SIZE_BYTES 2304
+#endif
+
+#ifndef U_SOCK_CONNECT_TASK_PRIORITY
+/** The priority of the task that makes the connections requested
+ * with uSockConnectAsync().
+ */
+# define U_SOCK_CONNECT_TASK_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
+#ifndef U_SOCK_HOST_CACHE_NUM_ENTRIES
+/** The number of host names that uSockGetHostByName() remembers
+ * the IP address of, so that it does not have to ask the network
+ * each time; set to 0 to switch the cache off.  Entries are kept
+ * per network handle and, when the cache is full, the least
+ * recently used is replaced.
+ */
+# define U_SOCK_HOST_CACHE_NUM_ENTRIES 4
+#endif
+
+#ifndef U_SOCK_HOST_CACHE_NAME_MAX_LENGTH_BYTES
+/** The longest host name, not including the terminator, that
+ * will be stored in the uSockGetHostByName() cache; longer
+ * host names are always looked up.
+ */
+# define U_SOCK_HOST_CACHE_NAME_MAX_LENGTH_BYTES 64
+#endif
+
+#ifndef U_SOCK_HOST_CACHE_TTL_SECONDS
+/** How long an entry in the uSockGetHostByName() cache is used
+ * for; the modules do not report the time-to-live of a DNS
+ * answer so this is a fixed value.
+ */
+# define U_SOCK_HOST_CACHE_TTL_SECONDS 300
+#endif
+
 #ifndef U_SOCK_CLOSE_TIMEOUT_SECONDS
 /** The time permitted for a socket to be closed in seconds.
  * This can be quite long when strictly adhering to the socket
@@ -145,6 +234,7 @@ extern "C" {
 
 /** Socket option: receive buffer size. The value matches
  * LWIP which matches the BSD sockets API (see Stevens et al).
+ * This option is handled by this layer, see uSockOptionSet().
  */
 #define U_SOCK_OPT_RCVBUF       0x1002
 
@@ -220,7 +310,12 @@ extern "C" {
 
 /** TCP socket option: turn off Nagle's algorithm.
  * The value matches LWIP which matches the BSD sockets API
- * (see Stevens et al).
+ * (see Stevens et al).  As well as being passed to the
+ * underlying socket layer, explicitly setting this option to
+ * zero on a TCP socket makes this layer coalesce small
+ * uSockWrite() calls, see #U_SOCK_WRITE_COALESCE_SIZE_BYTES;
+ * setting it non-zero again sends anything buffered and stops
+ * coalescing.
  */
 #define U_SOCK_OPT_TCP_NODELAY  0x0001
 
@@ -285,10 +380,9 @@ extern "C" {
 
 /** Determine if the bit corresponding to a given file descriptor is set.
  */
-#define U_SOCK_FD_ISSET(d, pSet) if (((d) >= 0) &&                           \
-                                     ((d) < U_SOCK_DESCRIPTOR_SET_SIZE)) {   \
-                                     (*(pSet))[(d) / 8] & (1 << ((d) & 7));  \
-                                 }
+#define U_SOCK_FD_ISSET(d, pSet) (((d) >= 0) &&                                 \
+                                  ((d) < U_SOCK_DESCRIPTOR_SET_SIZE) &&         \
+                                  (((*(pSet))[(d) / 8] & (1 << ((d) & 7))) != 0))
 
 /* ----------------------------------------------------------------
  * TYPES
@@ -360,6 +454,31 @@ typedef struct {
     int32_t lingerSeconds;  //<! linger time in seconds.
 } uSockLinger_t;
 
+/** Statistics for a socket, as returned by uSockStatsGet(); the
+ * "underlying" calls are those to the cellular or Wi-Fi socket
+ * layer, each of which is at least one AT command, so
+ * comparing them with the number of application reads shows
+ * the effect of read sizes and of #U_SOCK_OPT_RCVBUF.
+ */
+typedef struct {
+    int32_t bytesSent;           //<! as uSockGetTotalBytesSent().
+    int32_t bytesReceived;       //<! bytes given to the application.
+    int32_t numReads;            //<! application reads that got data.
+    int32_t numUnderlyingReads;  //<! underlying reads, with or without data.
+    int32_t numUnderlyingWrites; //<! underlying writes.
+    int32_t readLatencyMeanMs;   //<! mean time of an underlying read with data.
+    int32_t readLatencyMaxMs;    //<! max time of an underlying read with data.
+    int32_t numWriteRetries;     //<! underlying writes that were flow controlled.
+} uSockStats_t;
+
+/** An element of a scatter/gather list, as passed to
+ * uSockWritev() and uSockReadv(); matches the BSD struct iovec.
+ */
+typedef struct {
+    void *pData;          //<! the start of the buffer.
+    size_t dataSizeBytes; //<! the number of bytes at pData.
+} uSockIoVec_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
  * -------------------------------------------------------------- */
@@ -396,6 +515,46 @@ int32_t uSockCreate(uDeviceHandle_t devHandle, uSockType_t type,
 int32_t uSockConnect(uSockDescriptor_t descriptor,
                      const uSockAddress_t *pRemoteAddress);
 
+/** Make an outgoing connection on the given socket without waiting
+ * for it to complete: the connection is made by a task of this
+ * module and, when it is done, pCallback is called and the socket
+ * becomes writable for uSockSelect().  The outcome can also be
+ * found by calling uSockOptionGet() with #U_SOCK_OPT_ERROR, which
+ * returns the errno of a failed connection once: a socket whose
+ * connection failed may be connected again.  While the connection
+ * is in progress the socket cannot be closed (errno will be
+ * #U_SOCK_EBUSY) and reads and writes will fail.
+ *
+ * The connections requested on all sockets are made one at a time
+ * by the same task, since the underlying transport could not do
+ * otherwise, but the calling task is free to do other things,
+ * including asking for more connections.
+ *
+ * @param descriptor         the descriptor of the socket.
+ * @param pRemoteAddress     the address of the remote host to
+ *                           connect to; this is copied and so
+ *                           need not remain valid.
+ * @param pCallback          the function to call when the
+ *                           connection has been made or has failed;
+ *                           the parameters are the descriptor, zero
+ *                           on success else a negated value of errno,
+ *                           and pCallbackParameter.  It is called
+ *                           with no locks held, from a task with a
+ *                           stack of #U_SOCK_CONNECT_TASK_STACK_SIZE_BYTES,
+ *                           and may call this API.  May be NULL.
+ * @param pCallbackParameter a parameter that will be passed to
+ *                           pCallback; may be NULL.
+ * @return                   zero if the connection has been started
+ *                           else negative error code (and errno will
+ *                           also be set to a value from u_sock_errno.h,
+ *                           e.g. #U_SOCK_EALREADY if a connection is
+ *                           already in progress).
+ */
+int32_t uSockConnectAsync(uSockDescriptor_t descriptor,
+                          const uSockAddress_t *pRemoteAddress,
+                          void (*pCallback) (uSockDescriptor_t, int32_t, void *),
+                          void *pCallbackParameter);
+
 /** Close a socket.  Note that a TCP socket should be shutdown
  * with a call to uSockShutdown() before it is closed. Note that
  * in some cases where TCP socket closure can take a considerable
@@ -406,6 +565,8 @@ int32_t uSockConnect(uSockDescriptor_t descriptor,
  * call-back using uSockRegisterCallbackClosed() before calling
  * uSockClose().  Also note that closing the socket does NOT
  * free the memory it occupied, see uSockCleanUp() for that.
+ * A socket on which uSockConnectAsync() is in progress cannot be
+ * closed.
  *
  * @param descriptor the descriptor of the socket to be closed.
  * @return           zero on success else negative error code
@@ -463,6 +624,19 @@ bool uSockBlockingGet(uSockDescriptor_t descriptor);
  * #U_SOCK_OPT_RCVTIMEO and then the option value would be
  * a pointer to a structure of type timeval.
  *
+ * #U_SOCK_OPT_RCVBUF, with an option value of type int32_t, is
+ * handled by this layer: it sets the size of a receive buffer
+ * for a TCP (or otherwise secured, stream-like) socket, zero
+ * (the default) meaning no buffer.  With a buffer, a uSockRead()
+ * of less than the buffer size reads as much as the module has
+ * waiting, up to the buffer size, in one go and subsequent small
+ * reads are served from RAM; this is worthwhile where an
+ * application reads in small pieces, e.g. a TLS record header
+ * followed by its body.  On a short-range (Wi-Fi) device the
+ * received data is already held in RAM and so the buffer is not
+ * used.  The buffer size can only be changed
+ * while the buffer is empty, else errno will be #U_SOCK_EBUSY.
+ *
  * @param descriptor        the descriptor of the socket.
  * @param level             the option level
  *                          (see U_SOCK_OPT_LEVEL_xxx).
@@ -578,7 +752,11 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
  * FUNCTIONS: STREAM (TCP)
  * -------------------------------------------------------------- */
 
-/** Send data.
+/** Send data.  If #U_SOCK_OPT_TCP_NODELAY has been set to zero
+ * on the socket the data may be held back, to be sent with that
+ * of later calls, see #U_SOCK_WRITE_COALESCE_SIZE_BYTES; the
+ * return value is then the number of bytes taken and
+ * uSockGetTotalBytesSent() only counts them once they are sent.
  *
  * @param descriptor     the descriptor of the socket.
  * @param pData          the data to send.
@@ -590,6 +768,37 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
 int32_t uSockWrite(uSockDescriptor_t descriptor,
                    const void *pData, size_t dataSizeBytes);
 
+/** Send data gathered from several buffers, as if they had been
+ * concatenated and passed to uSockWrite(), but without the need
+ * to allocate memory and copy them; for instance a protocol
+ * header and its payload.  Where the underlying transport is
+ * cellular the buffers are packed into AT commands of the
+ * maximum size, as for a single buffer.  On a UDP socket the
+ * buffers are sent as a single datagram.
+ *
+ * @param descriptor    the descriptor of the socket.
+ * @param[in] pIoVec    an array of count buffers to send, in order;
+ *                      an element with dataSizeBytes of zero is
+ *                      skipped.
+ * @param count         the number of elements at pIoVec.
+ * @return              on success the number of bytes sent else
+ *                      negative error code (and errno will also
+ *                      be set to a value from u_sock_errno.h).
+ */
+int32_t uSockWritev(uSockDescriptor_t descriptor,
+                    const uSockIoVec_t *pIoVec, size_t count);
+
+/** Send any data that uSockWrite() is holding back on a TCP
+ * socket on which #U_SOCK_OPT_TCP_NODELAY has been set to zero;
+ * does nothing if writes are not being coalesced.
+ *
+ * @param descriptor  the descriptor of the socket.
+ * @return            zero on success else negative error code
+ *                    (and errno will also be set to a value from
+ *                    u_sock_errno.h).
+ */
+int32_t uSockFlush(uSockDescriptor_t descriptor);
+
 /** Receive data.
  *
  * @param descriptor     the descriptor of the socket.
@@ -604,6 +813,25 @@ int32_t uSockWrite(uSockDescriptor_t descriptor,
 int32_t uSockRead(uSockDescriptor_t descriptor,
                   void *pData, size_t dataSizeBytes);
 
+/** Receive data into several buffers, filling each in turn; as
+ * for uSockRead() the call blocks, if the socket is blocking,
+ * only until some data arrives: subsequent buffers are only
+ * filled with data that is already waiting.  On a UDP socket a
+ * single datagram is read and scattered across the buffers,
+ * any of it that does not fit being lost, as for uSockRead().
+ *
+ * @param descriptor    the descriptor of the socket.
+ * @param[in] pIoVec    an array of count buffers to receive into,
+ *                      in order.
+ * @param count         the number of elements at pIoVec.
+ * @return              on success the total number of bytes
+ *                      received else negative error code (and
+ *                      errno will also be set to a value from
+ *                      u_sock_errno.h).
+ */
+int32_t uSockReadv(uSockDescriptor_t descriptor,
+                   const uSockIoVec_t *pIoVec, size_t count);
+
 /** Prepare a TCP socket for being closed.
  * This is provided for BSD socket compatibility however
  * it may not be used under the hood other than to prevent
@@ -618,6 +846,47 @@ int32_t uSockRead(uSockDescriptor_t descriptor,
 int32_t uSockShutdown(uSockDescriptor_t descriptor,
                       uSockShutdown_t how);
 
+/* ----------------------------------------------------------------
+ * FUNCTIONS: DIRECT LINK
+ * -------------------------------------------------------------- */
+
+/** Put a connected TCP socket into direct link mode, where the socket
+ * is carried as a raw byte stream over a serial device of its own,
+ * without an AT command per chunk; use this for bulk transfers, e.g.
+ * a file upload or firmware streaming, which will then go at close
+ * to the speed of the serial link to the module.  While in direct
+ * link mode, data should be written to and read from the serial
+ * device, uSockWrite() and uSockRead() failing with errno set to
+ * #U_SOCK_EBUSY; anything already received should have been read
+ * before this is called, anything held back by this layer is sent
+ * first.
+ *
+ * This is currently only supported on cellular and only with the
+ * multiplexer enabled (see uCellMuxEnable()), so that the AT
+ * interface remains available; see uCellSockDirectLinkEnter() for
+ * the details.
+ *
+ * @param descriptor           the descriptor of the socket.
+ * @param[out] ppDeviceSerial  a place to put the serial device that
+ *                             carries the socket; cannot be NULL.
+ * @return                     zero on success else negative error code
+ *                             (and errno will also be set to a value
+ *                             from u_sock_errno.h).
+ */
+int32_t uSockDirectLinkEnter(uSockDescriptor_t descriptor,
+                             uDeviceSerial_t **ppDeviceSerial);
+
+/** Take a socket out of direct link mode, see uCellSockDirectLinkExit()
+ * for the details; this is done automatically by uSockClose().
+ * Does nothing if the socket is not in direct link mode.
+ *
+ * @param descriptor  the descriptor of the socket.
+ * @return            zero on success else negative error code (and
+ *                    errno will also be set to a value from
+ *                    u_sock_errno.h).
+ */
+int32_t uSockDirectLinkExit(uSockDescriptor_t descriptor);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: ASYNC
  * -------------------------------------------------------------- */
@@ -651,6 +920,10 @@ void uSockRegisterCallbackData(uSockDescriptor_t descriptor,
  * is #U_EDM_STREAM_TASK_STACK_SIZE_BYTES for Wi-Fi and
  * #U_AT_CLIENT_CALLBACK_TASK_STACK_SIZE_BYTES for cellular.
  *
+ * If a uSockConnectAsync() connection is in progress the callback
+ * is stored and only handed to the underlying layer once the
+ * connection has been made or has failed.
+ *
  * IMPORTANT: don't spend long in your callback, i.e. don't
  * call directly back into this API, don't call things that will
  * cause any sort of processing load or might get stuck.
@@ -667,6 +940,71 @@ void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
                                  void (*pCallback) (void *),
                                  void *pCallbackParameter);
 
+/* ----------------------------------------------------------------
+ * FUNCTIONS: FAILOVER
+ * -------------------------------------------------------------- */
+
+/** Move a socket to a different device, e.g. from a Wi-Fi module to
+ * a cellular module, keeping its descriptor.  A new socket is created
+ * on the given device and, if this is a connected TCP socket, it is
+ * connected to the same remote address, i.e. the TCP connection is
+ * re-established rather than continued: anything in flight on the
+ * old connection, including data the old module had received but
+ * which had not yet been read, is lost and it is up to the
+ * application protocol to cope with that.  What this layer holds is
+ * kept: data written but held back for coalescing (see
+ * #U_SOCK_OPT_TCP_NODELAY) is sent over the new socket and data
+ * already in the receive buffer (see #U_SOCK_OPT_RCVBUF) is still
+ * returned by the next read, as are the blocking mode, receive
+ * timeout, callbacks, statistics and remote address.  Options that
+ * are passed through to the underlying socket layer by
+ * uSockOptionSet() and any local port bound are not kept and must
+ * be set again if required.  Only when the new socket is ready is
+ * the old one closed; if the move fails the socket remains on the
+ * device it was on.  Secure (TLS/DTLS) sockets, which rely on
+ * credentials stored in the module, cannot be moved.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @param devHandle  the handle of the device to move the socket to;
+ *                   the network on that device must be up.
+ * @return           zero on success else negative error code (and
+ *                   errno will also be set to a value from
+ *                   u_sock_errno.h).
+ */
+int32_t uSockMove(uSockDescriptor_t descriptor, uDeviceHandle_t devHandle);
+
+/** Give a socket a device to fail over to.  Once this has been set,
+ * if the underlying socket is closed by the network (e.g. because a
+ * Wi-Fi link has dropped) or uSockFailoverTrigger() is called for
+ * the device the socket is on, the socket is not marked as closed;
+ * instead the next send, receive or flush on it first moves it to
+ * the failover device, exactly as uSockMove() would, and the device
+ * it was moved from becomes the failover device so that it may
+ * later move back.  If that move fails the send, receive or flush
+ * returns the error and the move is tried again on the next one.
+ * A local uSockClose() is never treated as a loss.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @param devHandle  the handle of the device to fail over to; use
+ *                   NULL to switch failover off.
+ * @return           zero on success else negative error code (and
+ *                   errno will also be set to a value from
+ *                   u_sock_errno.h).
+ */
+int32_t uSockFailoverSet(uSockDescriptor_t descriptor,
+                         uDeviceHandle_t devHandle);
+
+/** Tell this layer that the network of a device has been lost, so
+ * that every socket on that device for which uSockFailoverSet() has
+ * given a failover device will be moved there on its next send,
+ * receive or flush.  This does not talk to any module and so, unlike
+ * other functions of this API, it MAY be called from a network status
+ * callback (see uNetworkSetStatusCallback()) when isUp is false.
+ *
+ * @param devHandle the handle of the device whose network was lost.
+ */
+void uSockFailoverTrigger(uDeviceHandle_t devHandle);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: TCP INCOMING (TCP SERVER) ONLY
  * -------------------------------------------------------------- */
@@ -707,6 +1045,17 @@ int32_t uSockAccept(uSockDescriptor_t descriptor,
                     uSockAddress_t *pRemoteAddress);
 
 /** Select: wait for one of a set of sockets to become unblocked.
+ * This does not poll: it waits for the underlying network layer
+ * to indicate that data has arrived on, or that the far end has
+ * closed, any socket and only then re-checks the sets.  A socket
+ * in the read set is unblocked when data has been indicated for
+ * it and not yet all read, or when it is closed or shut down for
+ * reading (so that a read would return immediately); a socket in
+ * the write set is unblocked unless a uSockConnectAsync() is in
+ * progress on it, since flow control is not visible at this level;
+ * a socket in the except set is unblocked when it has been closed.
+ * On return each set is overwritten with the descriptors in it that
+ * were unblocked.
  *
  * @param maxDescriptor         the highest numbered descriptor in the
  *                              sets that follow to select on + 1.
@@ -719,7 +1068,9 @@ int32_t uSockAccept(uSockDescriptor_t descriptor,
  * @param pExceptDescriptorSet  the set of descriptors to check for
  *                              exceptional conditions. May be NULL.
  * @param timeMs                the timeout for the select operation
- *                              in milliseconds.
+ *                              in milliseconds; zero to check and
+ *                              return immediately, negative to wait
+ *                              indefinitely.
  * @return                      a positive value if an unblock
  *                              occurred, zero on timeout, negative
  *                              on any other error.  Use
@@ -741,6 +1092,16 @@ int32_t uSockSelect(int32_t maxDescriptor,
 
 int32_t uSockGetTotalBytesSent(uSockDescriptor_t descriptor);
 
+/** Get the statistics of a socket.
+ *
+ * @param descriptor   the descriptor of the socket.
+ * @param[out] pStats  a place to put the statistics; cannot be NULL.
+ * @return             zero on success else negative error code
+ *                     (and errno will also be set to a value from
+ *                     u_sock_errno.h).
+ */
+int32_t uSockStatsGet(uSockDescriptor_t descriptor, uSockStats_t *pStats);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: FINDING ADDRESSES
  * -------------------------------------------------------------- */
@@ -791,6 +1152,16 @@ int32_t uSockGetLocalAddress(uSockDescriptor_t descriptor,
 int32_t uSockGetHostByName(uDeviceHandle_t devHandle, const char *pHostName,
                            uSockIpAddress_t *pHostIpAddress);
 
+/** Forget the host names remembered by uSockGetHostByName(), see
+ * #U_SOCK_HOST_CACHE_NUM_ENTRIES; this is called by
+ * uNetworkInterfaceDown(), you only need to call it if you know
+ * that an address has changed.
+ *
+ * @param devHandle the handle of the network to forget the host
+ *                  names of; use NULL to forget all of them.
+ */
+void uSockHostCacheFlush(uDeviceHandle_t devHandle);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: ADDRESS CONVERSION
  * -------------------------------------------------------------- */
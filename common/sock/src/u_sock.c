@@ -319,6 +319,7 @@
 #include "sys/time.h"      // mktime() and struct timeval in most cases
 
 #include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
 
 #include "u_error_common.h"
 
@@ -332,11 +333,15 @@
 #include "u_port_os.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
+#include "u_port_event_queue.h"
+#include "u_log_ram_trace.h" // U_LOG_RAM_TRACE_XXX()
 
 #include "u_sock.h"
 #include "u_sock_security.h"
 #include "u_sock_errno.h"
 
+#include "u_perf_counters.h"
+
 #include "u_cell_sec_tls.h"
 #include "u_cell_sock.h"
 #include "u_wifi_sock.h"
@@ -356,11 +361,47 @@
 # define U_SOCK_NUM_STATIC_SOCKETS     7
 #endif
 
-/** Increment a socket descriptor.
+#ifndef U_SOCK_DEVICE_HASH_NUM_BUCKETS
+/** The number of buckets in the hash table used to find a socket
+ * from the device handle and underlying socket handle that the
+ * data and closed callbacks are given; must be a power of two.
+ */
+# define U_SOCK_DEVICE_HASH_NUM_BUCKETS 16
+#endif
+
+#if (U_SOCK_DEVICE_HASH_NUM_BUCKETS & (U_SOCK_DEVICE_HASH_NUM_BUCKETS - 1)) != 0
+# error U_SOCK_DEVICE_HASH_NUM_BUCKETS must be a power of two
+#endif
+
+#if defined(U_CFG_SOCK_CELL_ONLY) && defined(U_CFG_SOCK_WIFI_ONLY)
+# error U_CFG_SOCK_CELL_ONLY and U_CFG_SOCK_WIFI_ONLY cannot both be defined
+#endif
+
+#ifdef U_CFG_SOCK_CELL_ONLY
+/** Get the operations table of the underlying socket layer of a
+ * container: in a cellular-only build this is a constant, so that
+ * the compiler can turn every call through it into a direct call.
  */
-#define U_SOCK_INC_DESCRIPTOR(d)  (d)++;         \
-                                  if ((d) < 0) { \
-                                      d = 0;     \
+# define U_SOCK_OPS(pContainer) (&gSockOpsCell)
+#elif defined(U_CFG_SOCK_WIFI_ONLY)
+/** Get the operations table of the underlying socket layer of a
+ * container: in a Wi-Fi-only build this is a constant, so that
+ * the compiler can turn every call through it into a direct call.
+ */
+# define U_SOCK_OPS(pContainer) (&gSockOpsWifi)
+#else
+/** Get the operations table of the underlying socket layer of a
+ * container, as resolved when the socket was created or moved.
+ */
+# define U_SOCK_OPS(pContainer) ((pContainer)->socket.pOps)
+#endif
+
+/** Increment a socket descriptor, wrapping at
+ * U_SOCK_MAX_NUM_SOCKETS.
+ */
+#define U_SOCK_INC_DESCRIPTOR(d)  (d)++;                            \
+                                  if ((d) >= U_SOCK_MAX_NUM_SOCKETS) { \
+                                      d = 0;                        \
                                   }
 
 /* ----------------------------------------------------------------
@@ -371,6 +412,8 @@
  */
 typedef enum {
     U_SOCK_STATE_CREATED,   /**< Freshly created, unsullied. */
+    U_SOCK_STATE_CONNECTING, /**< uSockConnectAsync() is in progress,
+                                  the socket cannot be closed. */
     U_SOCK_STATE_CONNECTED, /**< TCP connected or UDP has an address. */
     U_SOCK_STATE_SHUTDOWN_FOR_READ,  /**< Block all reads. */
     U_SOCK_STATE_SHUTDOWN_FOR_WRITE, /**< Block all writes. */
@@ -383,12 +426,40 @@ typedef enum {
                                container may be re-used. */
 } uSockState_t;
 
+/** The operations of an underlying cell/wifi socket layer that
+ * are on the data path, so that a send or a receive is a single
+ * indirect call rather than a uDeviceGetDeviceType() and a branch.
+ */
+typedef struct {
+    int32_t (*pInitInstance) (uDeviceHandle_t);
+    int32_t (*pCreate) (uDeviceHandle_t, uSockType_t, uSockProtocol_t);
+    int32_t (*pSendTo) (uDeviceHandle_t, int32_t, const uSockAddress_t *,
+                        const void *, size_t);
+    int32_t (*pReceiveFrom) (uDeviceHandle_t, int32_t, uSockAddress_t *,
+                             void *, size_t);
+    int32_t (*pRead) (uDeviceHandle_t, int32_t, void *, size_t);
+    int32_t (*pWrite) (uDeviceHandle_t, int32_t, const void *, size_t);
+    int32_t (*pWritev) (uDeviceHandle_t, int32_t, const uSockIoVec_t *,
+                        size_t); /**< NULL if there is no vectored
+                                      write, pWrite() is called for
+                                      each buffer instead. */
+    int32_t (*pClose) (uDeviceHandle_t, int32_t,
+                       void (*) (uDeviceHandle_t, int32_t));
+    bool rxBufferWorthwhile; /**< False where the underlying layer
+                                  already holds received data in RAM,
+                                  so #U_SOCK_OPT_RCVBUF gains nothing. */
+    bool closeTcpAsync; /**< True if a TCP socket is closed
+                             asynchronously, with a callback. */
+} uSockOps_t;
+
 /** A socket.
  */
 typedef struct {
     uSockType_t type;
     uSockProtocol_t protocol;
     uDeviceHandle_t devHandle;
+    const uSockOps_t *pOps; /**< The operations of the underlying
+                                 socket layer of devHandle. */
     int32_t sockHandle; /**< This is the socket handle
                              that is returned by the
                              underlying socket layer and
@@ -403,6 +474,38 @@ typedef struct {
     void *pDataCallbackParameter;
     void (*pClosedCallback) (void *);
     void *pClosedCallbackParameter;
+    uPortSemaphoreHandle_t dataSemaphore; /**< Given by dataCallback(),
+                                               waited on by a blocking
+                                               receive; may be NULL. */
+    bool dataIndicated; /**< Set by dataCallback(), cleared when
+                             a receive finds no more data; protected
+                             by gMutexCallbacks. */
+    char *pRxBuffer; /**< Receive buffer for a stream socket, set
+                          with #U_SOCK_OPT_RCVBUF; may be NULL. */
+    size_t rxBufferSize; /**< The size of pRxBuffer. */
+    size_t rxBufferOffset; /**< Where the unread data in pRxBuffer starts. */
+    size_t rxBufferLength; /**< The amount of unread data in pRxBuffer. */
+    char *pTxBuffer; /**< Buffer of #U_SOCK_WRITE_COALESCE_SIZE_BYTES
+                          in which writes are coalesced, NULL if
+                          they are not; protected by gMutexTx. */
+    size_t txBufferLength; /**< The amount of data in pTxBuffer. */
+    uPortTimerHandle_t txTimer; /**< Timer to send pTxBuffer. */
+    uSockStats_t stats; /**< bytesSent and readLatencyMeanMs are
+                             filled in by uSockStatsGet(). */
+    int64_t readLatencyTotalMs; /**< For readLatencyMeanMs. */
+    int32_t numReadLatency; /**< For readLatencyMeanMs. */
+    void (*pConnectCallback) (uSockDescriptor_t, int32_t, void *);
+    void *pConnectCallbackParameter;
+    int32_t connectErrno; /**< The errno of a failed asynchronous
+                               connect, returned and cleared by
+                               #U_SOCK_OPT_ERROR. */
+    uDeviceHandle_t failoverDevHandle; /**< The device to move to when
+                                            the underlying socket is lost,
+                                            NULL if none. */
+    bool failoverPending; /**< Set when the underlying socket has been
+                               lost and the socket is to be moved to
+                               failoverDevHandle; protected by
+                               gMutexCallbacks. */
     bool blocking; // At end to optimise structure packing
 } uSockSocket_t;
 
@@ -412,10 +515,26 @@ typedef struct uSockContainer_t {
     struct uSockContainer_t *pPrevious;
     uSockDescriptor_t descriptor;
     uSockSocket_t socket;
+    struct uSockContainer_t *pNextInDeviceHash; /**< The next container in
+                                                     the same bucket of
+                                                     gpDeviceHash[]. */
     struct uSockContainer_t *pNext;
+    bool inDeviceHash; /**< True if this container is in gpDeviceHash[]. */
     bool isStatic; // At end to optimise structure packing
 } uSockContainer_t;
 
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+/** An entry in the host name cache.
+ */
+typedef struct {
+    uDeviceHandle_t devHandle; /**< NULL if the entry is not in use. */
+    char hostName[U_SOCK_HOST_CACHE_NAME_MAX_LENGTH_BYTES + 1];
+    uSockIpAddress_t ipAddress;
+    int32_t addedTimeMs;
+    int32_t usedTimeMs;
+} uSockHostCacheEntry_t;
+#endif
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -424,6 +543,40 @@ typedef struct uSockContainer_t {
  */
 static bool gInitialised = false;
 
+#ifndef U_CFG_SOCK_WIFI_ONLY
+/** The operations of the cellular socket layer.
+ */
+static const uSockOps_t gSockOpsCell = {
+    .pInitInstance = uCellSockInitInstance,
+    .pCreate = uCellSockCreate,
+    .pSendTo = uCellSockSendTo,
+    .pReceiveFrom = uCellSockReceiveFrom,
+    .pRead = uCellSockRead,
+    .pWrite = uCellSockWrite,
+    .pWritev = uCellSockWritev,
+    .pClose = uCellSockClose,
+    .rxBufferWorthwhile = true,
+    .closeTcpAsync = true
+};
+#endif
+
+#ifndef U_CFG_SOCK_CELL_ONLY
+/** The operations of the Wi-Fi socket layer.
+ */
+static const uSockOps_t gSockOpsWifi = {
+    .pInitInstance = uWifiSockInitInstance,
+    .pCreate = uWifiSockCreate,
+    .pSendTo = uWifiSockSendTo,
+    .pReceiveFrom = uWifiSockReceiveFrom,
+    .pRead = uWifiSockRead,
+    .pWrite = uWifiSockWrite,
+    .pWritev = NULL,
+    .pClose = uWifiSockClose,
+    .rxBufferWorthwhile = false,
+    .closeTcpAsync = false
+};
+#endif
+
 /** Mutex to protect the container list.
  */
 static uPortMutexHandle_t gMutexContainer = NULL;
@@ -432,6 +585,44 @@ static uPortMutexHandle_t gMutexContainer = NULL;
  */
 static uPortMutexHandle_t gMutexCallbacks = NULL;
 
+/** Semaphore that uSockSelect() waits on, given by the data
+ * and closed callbacks once for each waiting uSockSelect().
+ */
+static uPortSemaphoreHandle_t gSemaphoreSelect = NULL;
+
+/** Mutex to protect the coalesced write buffers of the sockets,
+ * which may be sent from the flush task, and hence the sending of
+ * data on a socket that has one.
+ */
+static uPortMutexHandle_t gMutexTx = NULL;
+
+/** Handle of the event queue on which the timers of sockets that
+ * coalesce writes put the descriptor of the socket to send.
+ */
+static int32_t gFlushEventQueueHandle = -1;
+
+/** The event queue on which uSockConnectAsync() does its
+ * work, opened when first needed.
+ */
+static int32_t gConnectEventQueueHandle = -1;
+
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+/** Mutex to protect the host name cache; separate from
+ * gMutexContainer so that uSockHostCacheFlush(), called with the
+ * device API locked, never has to wait on a socket operation.
+ */
+static uPortMutexHandle_t gMutexHostCache = NULL;
+
+/** The host name cache.
+ */
+static uSockHostCacheEntry_t gHostCache[U_SOCK_HOST_CACHE_NUM_ENTRIES] = {0};
+#endif
+
+/** The number of uSockSelect() calls waiting on gSemaphoreSelect,
+ * protected by gMutexCallbacks.
+ */
+static size_t gSelectNumWaiting = 0;
+
 /** Root of the socket container list.
  */
 static uSockContainer_t *gpContainerListHead = NULL;
@@ -444,10 +635,70 @@ static uSockDescriptor_t gNextDescriptor = 0;
  */
 static uSockContainer_t gStaticContainers[U_SOCK_NUM_STATIC_SOCKETS];
 
+/** The container for each descriptor, indexed by descriptor;
+ * the container may hold a socket in state CLOSED, in which
+ * case the descriptor is free for re-use.  Written with both
+ * gMutexContainer and gMutexCallbacks locked since uSockSelect()
+ * and the callbacks look containers up with only the latter.
+ */
+static uSockContainer_t *gpDescriptorTable[U_SOCK_MAX_NUM_SOCKETS] = {0};
+
+/** Hash table of the containers that have an underlying socket,
+ * indexed by deviceHashIndex(), for the callbacks.
+ */
+static uSockContainer_t *gpDeviceHash[U_SOCK_DEVICE_HASH_NUM_BUCKETS] = {0};
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: MISC
  * -------------------------------------------------------------- */
 
+// The performance counters source for all open sockets, named
+// by descriptor.
+static void statsPerfCountersSource(uPerfCountersWriter_t *pWriter,
+                                    void *pParam)
+{
+    uSockContainer_t *pContainer;
+    const uSockStats_t *pStats;
+    char name[32];
+    int32_t prefixLength;
+    int32_t readLatencyMeanMs;
+
+    (void) pParam;
+
+    U_PORT_MUTEX_LOCK(gMutexContainer);
+
+    for (pContainer = gpContainerListHead; pContainer != NULL; pContainer = pContainer->pNext) {
+        prefixLength = snprintf(name, sizeof(name), "%d.", (int) pContainer->descriptor);
+        if ((pContainer->socket.state != U_SOCK_STATE_CLOSED) && (pContainer->descriptor >= 0) &&
+            (prefixLength > 0) && (prefixLength < (int32_t) sizeof(name))) {
+            pStats = &(pContainer->socket.stats);
+            readLatencyMeanMs = 0;
+            if (pContainer->socket.numReadLatency > 0) {
+                readLatencyMeanMs = (int32_t) (pContainer->socket.readLatencyTotalMs /
+                                               pContainer->socket.numReadLatency);
+            }
+            strncpy(name + prefixLength, "bytesSent", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, pContainer->socket.bytesSent);
+            strncpy(name + prefixLength, "bytesReceived", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, pStats->bytesReceived);
+            strncpy(name + prefixLength, "numReads", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, pStats->numReads);
+            strncpy(name + prefixLength, "numUnderlyingReads", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, pStats->numUnderlyingReads);
+            strncpy(name + prefixLength, "numUnderlyingWrites", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, pStats->numUnderlyingWrites);
+            strncpy(name + prefixLength, "readLatencyMeanMs", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, readLatencyMeanMs);
+            strncpy(name + prefixLength, "readLatencyMaxMs", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, pStats->readLatencyMaxMs);
+            strncpy(name + prefixLength, "numWriteRetries", sizeof(name) - prefixLength);
+            uPerfCountersWriteCounter(pWriter, name, pStats->numWriteRetries);
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gMutexContainer);
+}
+
 // Initialise.
 static int32_t init()
 {
@@ -464,6 +715,10 @@ static int32_t init()
         if (errorCode == 0) {
             // Mark this as a perpetual mutex for accounting purposes
             uPortOsResourcePerpetualAdd(U_PORT_OS_RESOURCE_TYPE_MUTEX);
+            // Make the socket statistics available as performance
+            // counters; done here, once, since this can't be with
+            // gMutexContainer held, and not fatal if there is no room
+            uPerfCountersRegister("sock", statsPerfCountersSource, NULL);
         }
     }
     if ((errorCode == 0) && (gMutexCallbacks == NULL)) {
@@ -473,6 +728,30 @@ static int32_t init()
             uPortOsResourcePerpetualAdd(U_PORT_OS_RESOURCE_TYPE_MUTEX);
         }
     }
+    if ((errorCode == 0) && (gMutexTx == NULL)) {
+        errorCode = uPortMutexCreate(&gMutexTx);
+        if (errorCode == 0) {
+            // Mark this as a perpetual mutex for accounting purposes
+            uPortOsResourcePerpetualAdd(U_PORT_OS_RESOURCE_TYPE_MUTEX);
+        }
+    }
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+    if ((errorCode == 0) && (gMutexHostCache == NULL)) {
+        errorCode = uPortMutexCreate(&gMutexHostCache);
+        if (errorCode == 0) {
+            // Mark this as a perpetual mutex for accounting purposes
+            uPortOsResourcePerpetualAdd(U_PORT_OS_RESOURCE_TYPE_MUTEX);
+        }
+    }
+#endif
+    if ((errorCode == 0) && (gSemaphoreSelect == NULL)) {
+        errorCode = uPortSemaphoreCreate(&gSemaphoreSelect, 0,
+                                         U_SOCK_SELECT_MAX_NUM_WAITING);
+        if (errorCode == 0) {
+            // Mark this as a perpetual semaphore for accounting purposes
+            uPortOsResourcePerpetualAdd(U_PORT_OS_RESOURCE_TYPE_SEMAPHORE);
+        }
+    }
 
     if (errorCode == 0) {
         errnoLocal = U_SOCK_ENONE;
@@ -498,6 +777,9 @@ static int32_t init()
                     *ppContainer = &gStaticContainers[x];
                     (*ppContainer)->isStatic = true;
                     (*ppContainer)->socket.state = U_SOCK_STATE_CLOSED;
+                    (*ppContainer)->descriptor = -1;
+                    (*ppContainer)->pNextInDeviceHash = NULL;
+                    (*ppContainer)->inDeviceHash = false;
                     (*ppContainer)->pNext = NULL;
                     if (ppPreviousNext != NULL) {
                         *ppPreviousNext = *ppContainer;
@@ -539,21 +821,81 @@ static void deinitButNotMutex()
  * STATIC FUNCTIONS: CONTAINER STUFF
  * -------------------------------------------------------------- */
 
+// Return the index into gpDeviceHash[] for the given network
+// handle and underlying socket handle.
+static size_t deviceHashIndex(uDeviceHandle_t devHandle, int32_t sockHandle)
+{
+    // Device handles are pointers, so the bottom bits carry
+    // no information
+    return (size_t) ((((uintptr_t) devHandle) >> 3) ^ (uintptr_t) sockHandle) &
+           (U_SOCK_DEVICE_HASH_NUM_BUCKETS - 1);
+}
+
+// Add a container, which must have a network handle and an
+// underlying socket handle, to gpDeviceHash[].
+// This does NOT lock the mutex, you need to do that.
+static void containerDeviceHashAdd(uSockContainer_t *pContainer)
+{
+    size_t x = deviceHashIndex(pContainer->socket.devHandle,
+                               pContainer->socket.sockHandle);
+
+    pContainer->pNextInDeviceHash = gpDeviceHash[x];
+    gpDeviceHash[x] = pContainer;
+    pContainer->inDeviceHash = true;
+}
+
+// Remove a container from gpDeviceHash[], if it is in there;
+// this must be done before the network handle or underlying
+// socket handle of the container are changed.
+// This does NOT lock the mutex, you need to do that.
+static void containerDeviceHashRemove(uSockContainer_t *pContainer)
+{
+    uSockContainer_t **ppThis;
+
+    if (pContainer->inDeviceHash) {
+        ppThis = &(gpDeviceHash[deviceHashIndex(pContainer->socket.devHandle,
+                                                pContainer->socket.sockHandle)]);
+        while ((*ppThis != NULL) && (*ppThis != pContainer)) {
+            ppThis = &((*ppThis)->pNextInDeviceHash);
+        }
+        if (*ppThis != NULL) {
+            *ppThis = pContainer->pNextInDeviceHash;
+        }
+        pContainer->pNextInDeviceHash = NULL;
+        pContainer->inDeviceHash = false;
+    }
+}
+
+// Remove a container from gpDescriptorTable[] and gpDeviceHash[];
+// must be done before a container is freed or re-used.  This locks
+// gMutexCallbacks, so that once it returns no uSockSelect() or
+// callback can still be looking at the container, but it does NOT
+// lock the container mutex, you need to do that.
+static void containerUnindex(uSockContainer_t *pContainer)
+{
+    U_PORT_MUTEX_LOCK(gMutexCallbacks);
+    if ((pContainer->descriptor >= 0) &&
+        (pContainer->descriptor < U_SOCK_MAX_NUM_SOCKETS) &&
+        (gpDescriptorTable[pContainer->descriptor] == pContainer)) {
+        gpDescriptorTable[pContainer->descriptor] = NULL;
+    }
+    containerDeviceHashRemove(pContainer);
+    U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+}
+
 // Find the socket container for the given descriptor.
 // Will not find sockets in state CLOSED.
 // This does NOT lock the mutex, you need to do that.
 static uSockContainer_t *pContainerFindByDescriptor(uSockDescriptor_t descriptor)
 {
     uSockContainer_t *pContainer = NULL;
-    uSockContainer_t *pContainerThis = gpContainerListHead;
 
-    while ((pContainerThis != NULL) &&
-           (pContainer == NULL)) {
-        if ((pContainerThis->descriptor == descriptor) &&
-            (pContainerThis->socket.state != U_SOCK_STATE_CLOSED)) {
-            pContainer = pContainerThis;
+    if ((descriptor >= 0) && (descriptor < U_SOCK_MAX_NUM_SOCKETS)) {
+        pContainer = gpDescriptorTable[descriptor];
+        if ((pContainer != NULL) &&
+            (pContainer->socket.state == U_SOCK_STATE_CLOSED)) {
+            pContainer = NULL;
         }
-        pContainerThis = pContainerThis->pNext;
     }
 
     return pContainer;
@@ -568,37 +910,84 @@ static uSockContainer_t *pContainerFindByDeviceHandle(uDeviceHandle_t devHandle,
                                                       int32_t sockHandle)
 {
     uSockContainer_t *pContainer = NULL;
-    uSockContainer_t *pContainerThis = gpContainerListHead;
-
-    while ((pContainerThis != NULL) &&
-           (pContainer == NULL)) {
-        if ((pContainerThis->socket.devHandle == devHandle) &&
-            ((pContainerThis->socket.sockHandle == sockHandle) ||
-             (pContainerThis->socket.sockHandle < 0)) &&
-            (pContainerThis->socket.state != U_SOCK_STATE_CLOSED)) {
-            pContainer = pContainerThis;
+    uSockContainer_t *pContainerThis;
+
+    if (sockHandle >= 0) {
+        // This is the case for the callbacks, use the hash
+        pContainerThis = gpDeviceHash[deviceHashIndex(devHandle, sockHandle)];
+        while ((pContainerThis != NULL) && (pContainer == NULL)) {
+            if ((pContainerThis->socket.devHandle == devHandle) &&
+                (pContainerThis->socket.sockHandle == sockHandle) &&
+                (pContainerThis->socket.state != U_SOCK_STATE_CLOSED)) {
+                pContainer = pContainerThis;
+            }
+            pContainerThis = pContainerThis->pNextInDeviceHash;
+        }
+    } else {
+        // Only needed when a socket is created, just go
+        // through the table
+        for (size_t x = 0; (x < sizeof(gpDescriptorTable) / sizeof(gpDescriptorTable[0])) &&
+             (pContainer == NULL); x++) {
+            pContainerThis = gpDescriptorTable[x];
+            if ((pContainerThis != NULL) &&
+                (pContainerThis->socket.devHandle == devHandle) &&
+                (pContainerThis->socket.state != U_SOCK_STATE_CLOSED)) {
+                pContainer = pContainerThis;
+            }
         }
-        pContainerThis = pContainerThis->pNext;
     }
 
     return pContainer;
 }
 
-// Determine the number of non-closed sockets.
+// Find a free descriptor, starting from gNextDescriptor so that
+// a recently closed descriptor is not immediately re-used;
+// since every socket that is not closed has a descriptor, this
+// also limits the number of sockets to U_SOCK_MAX_NUM_SOCKETS.
+// Returns negative error code if there is none.
 // This does NOT lock the mutex, you need to do that.
-static size_t numContainersInUse()
+static int32_t descriptorFindFree()
 {
-    uSockContainer_t *pContainer = gpContainerListHead;
-    size_t numInUse = 0;
+    int32_t descriptorOrError = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    uSockDescriptor_t descriptor = gNextDescriptor;
 
-    while (pContainer != NULL) {
-        if (pContainer->socket.state != U_SOCK_STATE_CLOSED) {
-            numInUse++;
+    for (size_t x = 0; (x < U_SOCK_MAX_NUM_SOCKETS) && (descriptorOrError < 0); x++) {
+        if ((gpDescriptorTable[descriptor] == NULL) ||
+            (gpDescriptorTable[descriptor]->socket.state == U_SOCK_STATE_CLOSED)) {
+            descriptorOrError = descriptor;
         }
-        pContainer = pContainer->pNext;
+        U_SOCK_INC_DESCRIPTOR(descriptor);
     }
 
-    return numInUse;
+    return descriptorOrError;
+}
+
+// Free the receive buffer of a container, if it has one; any
+// unread data in it is lost.
+// This does NOT lock the mutex, you need to do that.
+static void containerRxBufferFree(uSockContainer_t *pContainer)
+{
+    uPortFree(pContainer->socket.pRxBuffer);
+    pContainer->socket.pRxBuffer = NULL;
+    pContainer->socket.rxBufferSize = 0;
+    pContainer->socket.rxBufferOffset = 0;
+    pContainer->socket.rxBufferLength = 0;
+}
+
+// Stop coalescing writes on a socket, freeing the buffer and
+// the timer; any unsent data is lost.
+// This does NOT lock the container mutex, you need to do that.
+static void containerTxBufferFree(uSockContainer_t *pContainer)
+{
+    U_PORT_MUTEX_LOCK(gMutexTx);
+    if (pContainer->socket.txTimer != NULL) {
+        uPortTimerDelete(pContainer->socket.txTimer);
+        pContainer->socket.txTimer = NULL;
+    }
+    uPortFree(pContainer->socket.pTxBuffer);
+    pContainer->socket.pTxBuffer = NULL;
+    pContainer->socket.txBufferLength = 0;
+    U_PORT_MUTEX_UNLOCK(gMutexTx);
 }
 
 // Create a socket in a container with the given descriptor.
@@ -607,12 +996,15 @@ static uSockContainer_t *pSockContainerCreate(uSockDescriptor_t descriptor,
                                               uSockType_t type,
                                               uSockProtocol_t protocol)
 {
-    uSockContainer_t *pContainer = NULL;
+    uSockContainer_t *pContainer = gpDescriptorTable[descriptor];
     uSockContainer_t *pContainerPrevious = NULL;
     uSockContainer_t **ppContainerThis = &gpContainerListHead;
+    uPortSemaphoreHandle_t dataSemaphore;
 
-    // Traverse the list, stopping if there is a container
-    // that holds a closed socket, which we could re-use
+    // If the container that last had this descriptor holds a
+    // closed socket then re-use it, otherwise traverse the list,
+    // stopping if there is a container that holds a closed socket,
+    // which we could re-use
     while ((*ppContainerThis != NULL) && (pContainer == NULL)) {
         if ((*ppContainerThis)->socket.state == U_SOCK_STATE_CLOSED) {
             pContainer = *ppContainerThis;
@@ -628,15 +1020,30 @@ static uSockContainer_t *pSockContainerCreate(uSockDescriptor_t descriptor,
         pContainer = (uSockContainer_t *) pUPortMalloc(sizeof (*pContainer));
         if (pContainer != NULL) {
             pContainer->isStatic = false;
+            pContainer->descriptor = -1;
+            pContainer->socket.dataSemaphore = NULL;
+            pContainer->socket.pRxBuffer = NULL;
+            pContainer->socket.pTxBuffer = NULL;
+            pContainer->socket.txTimer = NULL;
+            pContainer->pNextInDeviceHash = NULL;
+            pContainer->inDeviceHash = false;
             pContainer->pPrevious = pContainerPrevious;
             pContainer->pNext = NULL;
             *ppContainerThis = pContainer;
         }
+    } else {
+        // Detach the re-used container from its old descriptor
+        // and underlying socket
+        containerUnindex(pContainer);
+        containerRxBufferFree(pContainer);
+        containerTxBufferFree(pContainer);
     }
 
     // Set up the new container and socket
     if (pContainer != NULL) {
         pContainer->descriptor = descriptor;
+        // A re-used container may already have a data semaphore
+        dataSemaphore = pContainer->socket.dataSemaphore;
         memset(&(pContainer->socket), 0, sizeof(pContainer->socket));
         pContainer->socket.type = type;
         pContainer->socket.protocol = protocol;
@@ -650,46 +1057,70 @@ static uSockContainer_t *pSockContainerCreate(uSockDescriptor_t descriptor,
         pContainer->socket.pDataCallbackParameter = NULL;
         pContainer->socket.pClosedCallback = NULL;
         pContainer->socket.pClosedCallbackParameter = NULL;
+        if (dataSemaphore == NULL) {
+            // Not fatal if this fails, receive() will just poll
+            uPortSemaphoreCreate(&dataSemaphore, 0, 1);
+        }
+        pContainer->socket.dataSemaphore = dataSemaphore;
+        // Only now let uSockSelect() and the callbacks see it
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        gpDescriptorTable[descriptor] = pContainer;
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
     }
 
     return pContainer;
 }
 
-// Free the container corresponding to the descriptor.
-// Has no effect on static containers.
+// Delete the data semaphore of a container, if it has one; must
+// be done before a container is freed or when a static container
+// is finished with.
+// This does NOT lock the container mutex, you need to do that.
+static void containerDataSemaphoreDelete(uSockContainer_t *pContainer)
+{
+    U_PORT_MUTEX_LOCK(gMutexCallbacks);
+    if (pContainer->socket.dataSemaphore != NULL) {
+        uPortSemaphoreDelete(pContainer->socket.dataSemaphore);
+        pContainer->socket.dataSemaphore = NULL;
+    }
+    U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+}
+
+// Free the container corresponding to the descriptor; a static
+// container is just marked as closed.
 // This does NOT lock the mutex, you need to do that.
 static bool containerFree(uSockDescriptor_t descriptor)
 {
-    uSockContainer_t **ppContainer = NULL;
-    uSockContainer_t **ppContainerThis = &gpContainerListHead;
+    uSockContainer_t *pContainer = NULL;
     bool success = false;
 
-    while ((*ppContainerThis != NULL) &&
-           (ppContainer == NULL)) {
-        if ((*ppContainerThis)->descriptor == descriptor) {
-            ppContainer = ppContainerThis;
-        } else {
-            ppContainerThis = &((*ppContainerThis)->pNext);
-        }
+    if ((descriptor >= 0) && (descriptor < U_SOCK_MAX_NUM_SOCKETS)) {
+        pContainer = gpDescriptorTable[descriptor];
     }
 
-    if ((ppContainer != NULL) && (*ppContainer != NULL)) {
-        if (!(*ppContainer)->isStatic) {
+    if (pContainer != NULL) {
+        containerUnindex(pContainer);
+        containerDataSemaphoreDelete(pContainer);
+        containerRxBufferFree(pContainer);
+        containerTxBufferFree(pContainer);
+        if (!pContainer->isStatic) {
             // If we found it, and it wasn't static, free it
             // If there is a previous container, move its pNext
-            if ((*ppContainer)->pPrevious != NULL) {
-                (*ppContainer)->pPrevious->pNext = (*ppContainer)->pNext;
+            if (pContainer->pPrevious != NULL) {
+                pContainer->pPrevious->pNext = pContainer->pNext;
+            } else {
+                gpContainerListHead = pContainer->pNext;
             }
             // If there is a next container, move its pPrevious
-            if ((*ppContainer)->pNext != NULL) {
-                (*ppContainer)->pNext->pPrevious = (*ppContainer)->pPrevious;
+            if (pContainer->pNext != NULL) {
+                pContainer->pNext->pPrevious = pContainer->pPrevious;
             }
 
-            // Free the memory and NULL the pointer
-            uPortFree(*ppContainer);
-            *ppContainer = NULL;
+            // Free the memory
+            uPortFree(pContainer);
         } else {
-            // Nothing to do for a static container,
+            // Nothing to free for a static container
+            pContainer->socket.state = U_SOCK_STATE_CLOSED;
+            pContainer->socket.devHandle = NULL;
         }
 
         success = true;
@@ -702,6 +1133,15 @@ static bool containerFree(uSockDescriptor_t descriptor)
  * STATIC FUNCTIONS: CALLBACKS
  * -------------------------------------------------------------- */
 
+// Wake up any uSockSelect() calls that are waiting.
+// gMutexCallbacks must be locked before this is called.
+static void selectWake()
+{
+    for (size_t x = 0; x < gSelectNumWaiting; x++) {
+        uPortSemaphoreGive(gSemaphoreSelect);
+    }
+}
+
 // Callback for when local socket closures at the underlying
 // cell/wifi socket layer happen asynchronously, either
 // due to local closure or by the remote host
@@ -715,7 +1155,16 @@ static void closedCallback(uDeviceHandle_t devHandle,
     // in progress and that already has the mutex
     pContainer = pContainerFindByDeviceHandle(devHandle,
                                               sockHandle);
-    if (pContainer != NULL) {
+    if ((pContainer != NULL) &&
+        (pContainer->socket.failoverDevHandle != NULL)) {
+        // Not closed as far as the application is concerned,
+        // the socket will be moved on its next use
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        pContainer->socket.failoverPending = true;
+        pContainer->socket.dataIndicated = true;
+        selectWake();
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+    } else if (pContainer != NULL) {
         // Mark the container as closed
         pContainer->socket.state = U_SOCK_STATE_CLOSED;
         U_PORT_MUTEX_LOCK(gMutexCallbacks);
@@ -727,6 +1176,7 @@ static void closedCallback(uDeviceHandle_t devHandle,
         // context
         uSecurityTlsRemove(pContainer->socket.pSecurityContext);
         pContainer->socket.pSecurityContext = NULL;
+        selectWake();
         U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
     }
 }
@@ -745,6 +1195,12 @@ static void dataCallback(uDeviceHandle_t devHandle,
                                               sockHandle);
     if (pContainer != NULL) {
         U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        // Wake up anyone waiting in receive() or uSockSelect()
+        pContainer->socket.dataIndicated = true;
+        if (pContainer->socket.dataSemaphore != NULL) {
+            uPortSemaphoreGive(pContainer->socket.dataSemaphore);
+        }
+        selectWake();
         if (pContainer->socket.pDataCallback != NULL) {
             pContainer->socket.pDataCallback(pContainer->socket.pDataCallbackParameter);
         }
@@ -752,6 +1208,165 @@ static void dataCallback(uDeviceHandle_t devHandle,
     }
 }
 
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: SELECT
+ * -------------------------------------------------------------- */
+
+// Find the container for the given descriptor, including one
+// that has been closed but not yet cleaned up.
+// This does NOT lock the mutex, you need to do that.
+static uSockContainer_t *pContainerFindByDescriptorForSelect(uSockDescriptor_t descriptor)
+{
+    uSockContainer_t *pContainer = NULL;
+
+    if ((descriptor >= 0) && (descriptor < U_SOCK_MAX_NUM_SOCKETS)) {
+        pContainer = gpDescriptorTable[descriptor];
+    }
+
+    return pContainer;
+}
+
+// Check the descriptors in the read, write and except sets
+// below maxDescriptor, writing the ones that are ready to the
+// given output sets (where not NULL), and return the number
+// that are ready or negated errno.  A socket is ready for read
+// if data has been indicated or a read would otherwise not
+// block, it is ready for write unless an asynchronous connect
+// is in progress (flow control is not visible at this level)
+// and it has an exception if it has been closed by the far end.
+// gMutexCallbacks must be locked before this is called.
+static int32_t selectCheck(int32_t maxDescriptor,
+                           const uSockDescriptorSet_t readSet,
+                           const uSockDescriptorSet_t writeSet,
+                           const uSockDescriptorSet_t exceptSet,
+                           uSockDescriptorSet_t *pReadSetOut,
+                           uSockDescriptorSet_t *pWriteSetOut,
+                           uSockDescriptorSet_t *pExceptSetOut)
+{
+    int32_t negErrnoOrNum = 0;
+    uSockContainer_t *pContainer;
+    uSockState_t state;
+    bool closed;
+    uint8_t mask;
+
+    if (pReadSetOut != NULL) {
+        U_SOCK_FD_ZERO(pReadSetOut);
+    }
+    if (pWriteSetOut != NULL) {
+        U_SOCK_FD_ZERO(pWriteSetOut);
+    }
+    if (pExceptSetOut != NULL) {
+        U_SOCK_FD_ZERO(pExceptSetOut);
+    }
+
+    for (int32_t d = 0; (d < maxDescriptor) && (negErrnoOrNum >= 0); d++) {
+        mask = (uint8_t) (1 << (d & 7));
+        if (((readSet[d / 8] | writeSet[d / 8] | exceptSet[d / 8]) & mask) != 0) {
+            pContainer = pContainerFindByDescriptorForSelect(d);
+            if (pContainer != NULL) {
+                state = pContainer->socket.state;
+                closed = (state == U_SOCK_STATE_CLOSED) ||
+                         (state == U_SOCK_STATE_CLOSING);
+                if (((readSet[d / 8] & mask) != 0) && (pReadSetOut != NULL) &&
+                    (pContainer->socket.dataIndicated || closed ||
+                     (state == U_SOCK_STATE_SHUTDOWN_FOR_READ) ||
+                     (state == U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE))) {
+                    (*pReadSetOut)[d / 8] |= mask;
+                    negErrnoOrNum++;
+                }
+                if (((writeSet[d / 8] & mask) != 0) && (pWriteSetOut != NULL) &&
+                    (state != U_SOCK_STATE_CONNECTING)) {
+                    (*pWriteSetOut)[d / 8] |= mask;
+                    negErrnoOrNum++;
+                }
+                if (((exceptSet[d / 8] & mask) != 0) && (pExceptSetOut != NULL) && closed) {
+                    (*pExceptSetOut)[d / 8] |= mask;
+                    negErrnoOrNum++;
+                }
+            } else {
+                negErrnoOrNum = -U_SOCK_EBADF;
+            }
+        }
+    }
+
+    return negErrnoOrNum;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: HOST NAME CACHE
+ * -------------------------------------------------------------- */
+
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+
+// Look up a host name in the cache, returning true and copying
+// the address to pIpAddress if it is there and still valid.
+static bool hostCacheGet(uDeviceHandle_t devHandle, const char *pHostName,
+                         uSockIpAddress_t *pIpAddress)
+{
+    bool found = false;
+    int32_t nowMs = uPortGetTickTimeMs();
+    uSockHostCacheEntry_t *pEntry;
+
+    U_PORT_MUTEX_LOCK(gMutexHostCache);
+
+    for (size_t x = 0; (x < sizeof(gHostCache) / sizeof(gHostCache[0])) &&
+         !found; x++) {
+        pEntry = &(gHostCache[x]);
+        if ((pEntry->devHandle == devHandle) &&
+            (strcmp(pEntry->hostName, pHostName) == 0)) {
+            if (nowMs - pEntry->addedTimeMs < U_SOCK_HOST_CACHE_TTL_SECONDS * 1000) {
+                *pIpAddress = pEntry->ipAddress;
+                pEntry->usedTimeMs = nowMs;
+                found = true;
+            } else {
+                // Too old, forget it
+                pEntry->devHandle = NULL;
+            }
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gMutexHostCache);
+
+    return found;
+}
+
+// Add a host name to the cache, replacing an unused entry or,
+// failing that, the least recently used entry.
+static void hostCacheAdd(uDeviceHandle_t devHandle, const char *pHostName,
+                         const uSockIpAddress_t *pIpAddress)
+{
+    int32_t nowMs = uPortGetTickTimeMs();
+    uSockHostCacheEntry_t *pEntry = NULL;
+
+    if (strlen(pHostName) <= U_SOCK_HOST_CACHE_NAME_MAX_LENGTH_BYTES) {
+
+        U_PORT_MUTEX_LOCK(gMutexHostCache);
+
+        for (size_t x = 0; x < sizeof(gHostCache) / sizeof(gHostCache[0]); x++) {
+            if (gHostCache[x].devHandle == NULL) {
+                if ((pEntry == NULL) || (pEntry->devHandle != NULL)) {
+                    pEntry = &(gHostCache[x]);
+                }
+            } else if ((pEntry == NULL) ||
+                       ((pEntry->devHandle != NULL) &&
+                        (nowMs - gHostCache[x].usedTimeMs > nowMs - pEntry->usedTimeMs))) {
+                pEntry = &(gHostCache[x]);
+            }
+        }
+        if (pEntry != NULL) {
+            pEntry->devHandle = devHandle;
+            strncpy(pEntry->hostName, pHostName, sizeof(pEntry->hostName));
+            pEntry->ipAddress = *pIpAddress;
+            pEntry->addedTimeMs = nowMs;
+            pEntry->usedTimeMs = nowMs;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexHostCache);
+    }
+}
+
+#endif // #if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: ADDRESS CONVERSION
  * -------------------------------------------------------------- */
@@ -1073,6 +1688,28 @@ static void printSocketOption(const void *pOptionValue,
  * STATIC FUNCTIONS: Creating
  * -------------------------------------------------------------- */
 
+// Get the operations of the underlying socket layer of a device,
+// NULL if it has none; this is done once, when a socket is created
+// or moved, and the result kept in the container.
+static const uSockOps_t *pOpsGet(uDeviceHandle_t devHandle)
+{
+    const uSockOps_t *pOps = NULL;
+    int32_t devType = uDeviceGetDeviceType(devHandle);
+
+#ifndef U_CFG_SOCK_WIFI_ONLY
+    if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+        pOps = &gSockOpsCell;
+    }
+#endif
+#ifndef U_CFG_SOCK_CELL_ONLY
+    if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
+        pOps = &gSockOpsWifi;
+    }
+#endif
+
+    return pOps;
+}
+
 static int32_t uSockCreateEx(uDeviceHandle_t devHandle,
                              uSockType_t type,
                              uSockProtocol_t protocol,
@@ -1081,7 +1718,7 @@ static int32_t uSockCreateEx(uDeviceHandle_t devHandle,
     int32_t descriptorOrError = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    uSockDescriptor_t descriptor = gNextDescriptor;
+    uSockDescriptor_t descriptor;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -1101,44 +1738,34 @@ static int32_t uSockCreateEx(uDeviceHandle_t devHandle,
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
         errnoLocal = U_SOCK_ENOBUFS;
-        if (numContainersInUse() < U_SOCK_MAX_NUM_SOCKETS) {
-            // Find the next free descriptor
-            descriptorOrError = (int32_t) U_ERROR_COMMON_BSD_ERROR;
-            while (descriptorOrError < 0) {
-                // Try the descriptor value, making sure
-                // each time that it can't be found.
-                if (pContainerFindByDescriptor(descriptor) == NULL) {
-                    gNextDescriptor = descriptor;
-                    U_SOCK_INC_DESCRIPTOR(gNextDescriptor);
-                    // Found a free descriptor, now try to
-                    // create the socket in a container
-                    pContainer = pSockContainerCreate(descriptor,
-                                                      type, protocol);
-                    if (pContainer != NULL) {
-                        descriptorOrError = (int32_t) descriptor;
-                    } else {
-                        errnoLocal = U_SOCK_ENOMEM;
-                        uPortLog("U_SOCK: unable to allocate memory"
-                                 " for socket.\n");
-                        // Exit stage left
-                        break;
-                    }
-                }
-                U_SOCK_INC_DESCRIPTOR(descriptor);
+        descriptorOrError = descriptorFindFree();
+        if (descriptorOrError >= 0) {
+            descriptor = (uSockDescriptor_t) descriptorOrError;
+            gNextDescriptor = descriptor;
+            U_SOCK_INC_DESCRIPTOR(gNextDescriptor);
+            // Found a free descriptor, now try to
+            // create the socket in a container
+            pContainer = pSockContainerCreate(descriptor,
+                                              type, protocol);
+            if (pContainer == NULL) {
+                descriptorOrError = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+                errnoLocal = U_SOCK_ENOMEM;
+                uPortLog("U_SOCK: unable to allocate memory"
+                         " for socket.\n");
             }
 
             if ((descriptorOrError >= 0) && (pContainer != NULL)) {
                 int32_t devType = uDeviceGetDeviceType(devHandle);
+                const uSockOps_t *pOps = pOpsGet(devHandle);
                 errnoLocal = U_SOCK_ENOSYS;
-                if (pContainerFindByDeviceHandle(devHandle, -1) == NULL) {
-                    // If this is the first time we have
-                    // encountered this network layer,
-                    // ask the underlying cell/wifi sockets
-                    // layer to initialise it
-                    if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                        errnoLocal = -uCellSockInitInstance(devHandle);
-                    } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                        errnoLocal = -uWifiSockInitInstance(devHandle);
+                if (pOps != NULL) {
+                    errnoLocal = U_SOCK_ENONE;
+                    if (pContainerFindByDeviceHandle(devHandle, -1) == NULL) {
+                        // If this is the first time we have
+                        // encountered this network layer,
+                        // ask the underlying cell/wifi sockets
+                        // layer to initialise it
+                        errnoLocal = -pOps->pInitInstance(devHandle);
                     }
                 }
                 // Get the underlying cell/wifi socket layer to
@@ -1147,20 +1774,16 @@ static int32_t uSockCreateEx(uDeviceHandle_t devHandle,
                 // the U_SOCK_Exxx list
                 if (errnoLocal == 0) {
                     if (sockHandle < 0) {
+                        sockHandle = pOps->pCreate(devHandle, type, protocol);
                         if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                            sockHandle = uCellSockCreate(devHandle,
-                                                         type, protocol);
                             // Setting non-blocking so that
                             // we do the blocking here instead.
                             // Since this has no return value
                             // we can do it at the same time
                             uCellSockBlockingSet(devHandle,
                                                  sockHandle, false);
-                        } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                            sockHandle = uWifiSockCreate(devHandle,
-                                                         type, protocol);
-                            // TODO: Set blocking stuff
                         }
+                        // TODO: Set blocking stuff for Wi-Fi
                     }
 
                     if (sockHandle >= 0) {
@@ -1168,7 +1791,19 @@ static int32_t uSockCreateEx(uDeviceHandle_t devHandle,
                         // as it was already set above
                         pContainer->socket.sockHandle = sockHandle;
                         pContainer->socket.devHandle = devHandle;
+                        pContainer->socket.pOps = pOps;
                         pContainer->socket.bytesSent = 0;
+                        containerDeviceHashAdd(pContainer);
+                        // Always have the underlying socket layer tell
+                        // us about received data so that a blocking
+                        // receive() can wait on it rather than poll
+                        if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+                            uCellSockRegisterCallbackData(devHandle, sockHandle,
+                                                          dataCallback);
+                        } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
+                            uWifiSockRegisterCallbackData(devHandle, sockHandle,
+                                                          dataCallback);
+                        }
                         uPortLog("U_SOCK: socket created, descriptor %d,"
                                  " network handle 0x%08x, socket handle %d.\n",
                                  descriptorOrError, devHandle, sockHandle);
@@ -1197,150 +1832,919 @@ static int32_t uSockCreateEx(uDeviceHandle_t devHandle,
 }
 
 /* ----------------------------------------------------------------
- * STATIC FUNCTIONS: RECEIVING
+ * STATIC FUNCTIONS: SENDING
  * -------------------------------------------------------------- */
 
-// Receive data on a socket, either UDP or TCP.
-static int32_t receive(const uSockContainer_t *pContainer,
-                       uSockAddress_t *pRemoteAddress,
-                       void *pData, size_t dataSizeBytes)
+// Return the total number of bytes in an I/O vector or SIZE_MAX
+// if the vector is not valid.
+static size_t ioVecSize(const uSockIoVec_t *pIoVec, size_t count)
 {
-    uDeviceHandle_t devHandle = pContainer->socket.devHandle;
-    int32_t sockHandle = pContainer->socket.sockHandle;
-    int32_t negErrnoOrSize = -U_SOCK_ENOSYS;
-    int32_t startTimeMs = uPortGetTickTimeMs();
-    int32_t devType = uDeviceGetDeviceType(devHandle);
+    size_t size = 0;
 
-    // Run around the loop until a packet of data turns up
-    // or we time out or just once if we're non-blocking.
-    do {
-        if ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) &&
-            (pContainer->socket.pSecurityContext == NULL)) {
-            // UDP style
-            if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                negErrnoOrSize = uCellSockReceiveFrom(devHandle,
-                                                      sockHandle,
-                                                      pRemoteAddress,
-                                                      pData,
-                                                      dataSizeBytes);
-            } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                negErrnoOrSize = uWifiSockReceiveFrom(devHandle,
-                                                      sockHandle,
-                                                      pRemoteAddress,
-                                                      pData,
-                                                      dataSizeBytes);
-            }
+    if ((pIoVec == NULL) && (count > 0)) {
+        size = SIZE_MAX;
+    }
+    for (size_t x = 0; (x < count) && (size != SIZE_MAX); x++) {
+        if (((pIoVec[x].pData == NULL) && (pIoVec[x].dataSizeBytes > 0)) ||
+            (pIoVec[x].dataSizeBytes > INT_MAX - size)) {
+            size = SIZE_MAX;
         } else {
-            // TCP or DTLS style
-            if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                negErrnoOrSize = uCellSockRead(devHandle,
-                                               sockHandle,
-                                               pData,
-                                               dataSizeBytes);
-            } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                negErrnoOrSize = uWifiSockRead(devHandle,
-                                               sockHandle,
-                                               pData,
-                                               dataSizeBytes);
-            }
+            size += pIoVec[x].dataSizeBytes;
         }
-        if (negErrnoOrSize < 0) {
-            // Yield for the poll interval
-            uPortTaskBlock(U_SOCK_RECEIVE_POLL_INTERVAL_MS);
-        }
-    } while ((negErrnoOrSize < 0) &&
-             (pContainer->socket.blocking) &&
-             (uPortGetTickTimeMs() - startTimeMs <
-              pContainer->socket.receiveTimeoutMs));
+    }
 
-    return negErrnoOrSize;
+    return size;
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
- * -------------------------------------------------------------- */
-
-int32_t uSockCreate(uDeviceHandle_t devHandle, uSockType_t type,
-                    uSockProtocol_t protocol)
+// Copy the contents of an I/O vector into a single buffer, which
+// must be big enough.
+static void ioVecGather(const uSockIoVec_t *pIoVec, size_t count,
+                        char *pBuffer)
 {
-    return uSockCreateEx(devHandle, type, protocol, -1);
+    for (size_t x = 0; x < count; x++) {
+        if (pIoVec[x].dataSizeBytes > 0) {
+            memcpy(pBuffer, pIoVec[x].pData, pIoVec[x].dataSizeBytes);
+            pBuffer += pIoVec[x].dataSizeBytes;
+        }
+    }
 }
 
-// Make an outgoing connection on the given socket.
-int32_t uSockConnect(uSockDescriptor_t descriptor,
-                     const uSockAddress_t *pRemoteAddress)
+// Copy size bytes from a single buffer into an I/O vector, filling
+// each element in turn, returning the number of bytes copied.
+static size_t ioVecScatter(const uSockIoVec_t *pIoVec, size_t count,
+                           const char *pBuffer, size_t size)
 {
-    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-    int32_t errnoLocal;
-    uSockContainer_t *pContainer = NULL;
-    uDeviceHandle_t devHandle;
-    int32_t sockHandle;
-#if U_CFG_ENABLE_LOGGING
-    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
-#endif
+    size_t copied = 0;
+    size_t length;
 
-    errnoLocal = init();
-    if (errnoLocal == U_SOCK_ENONE) {
-        errnoLocal = U_SOCK_EINVAL;
-        // Check that the remote IP address is sensible
-        if (pRemoteAddress != NULL) {
+    for (size_t x = 0; (x < count) && (copied < size); x++) {
+        length = pIoVec[x].dataSizeBytes;
+        if (length > size - copied) {
+            length = size - copied;
+        }
+        if (length > 0) {
+            memcpy(pIoVec[x].pData, pBuffer + copied, length);
+            copied += length;
+        }
+    }
 
-            U_PORT_MUTEX_LOCK(gMutexContainer);
+    return copied;
+}
+
+// Send data gathered from an I/O vector on a socket with the
+// underlying socket layer, returning the number of bytes sent or
+// negated errno.
+static int32_t writevUnderlying(uSockContainer_t *pContainer,
+                                const uSockIoVec_t *pIoVec, size_t count)
+{
+    uDeviceHandle_t devHandle = pContainer->socket.devHandle;
+    int32_t sockHandle = pContainer->socket.sockHandle;
+    const uSockOps_t *pOps = U_SOCK_OPS(pContainer);
+    int32_t negErrnoOrSize;
+    int32_t x = 0;
+    size_t dataSizeBytes;
+    char *pBuffer;
+
+    // uXxxSockWrite() returns the number of bytes sent or a
+    // negated value of errno from the U_SOCK_Exxx list.
+    if (pOps->pWritev != NULL) {
+        pContainer->socket.stats.numUnderlyingWrites++;
+        negErrnoOrSize = pOps->pWritev(devHandle, sockHandle,
+                                       pIoVec, count);
+        if ((negErrnoOrSize < 0) ||
+            (negErrnoOrSize < (int32_t) ioVecSize(pIoVec, count))) {
+            pContainer->socket.stats.numWriteRetries++;
+        }
+    } else if ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) &&
+               (pContainer->socket.pSecurityContext == NULL) && (count > 1)) {
+        // No vectored write in the underlying socket layer and
+        // each write would be a datagram of its own, so gather
+        // the buffers into one
+        negErrnoOrSize = -U_SOCK_ENOMEM;
+        dataSizeBytes = ioVecSize(pIoVec, count);
+        pBuffer = (char *) pUPortMalloc(dataSizeBytes);
+        if (pBuffer != NULL) {
+            ioVecGather(pIoVec, count, pBuffer);
+            pContainer->socket.stats.numUnderlyingWrites++;
+            negErrnoOrSize = pOps->pWrite(devHandle, sockHandle,
+                                          pBuffer, dataSizeBytes);
+            if (negErrnoOrSize < (int32_t) dataSizeBytes) {
+                pContainer->socket.stats.numWriteRetries++;
+            }
+            uPortFree(pBuffer);
+        }
+    } else {
+        // No vectored write in the underlying socket layer,
+        // send the buffers one after the other
+        negErrnoOrSize = 0;
+        for (size_t y = 0; (y < count) && (x >= 0); y++) {
+            if (pIoVec[y].dataSizeBytes > 0) {
+                pContainer->socket.stats.numUnderlyingWrites++;
+                x = pOps->pWrite(devHandle, sockHandle,
+                                 pIoVec[y].pData,
+                                 pIoVec[y].dataSizeBytes);
+                if (x < (int32_t) pIoVec[y].dataSizeBytes) {
+                    pContainer->socket.stats.numWriteRetries++;
+                }
+                if (x > 0) {
+                    negErrnoOrSize += x;
+                    if (x < (int32_t) pIoVec[y].dataSizeBytes) {
+                        // Short write, stop here
+                        x = -1;
+                    }
+                } else {
+                    if (negErrnoOrSize == 0) {
+                        negErrnoOrSize = x;
+                    }
+                    x = -1;
+                }
+            }
+        }
+    }
+    if (negErrnoOrSize > 0) {
+        pContainer->socket.bytesSent += negErrnoOrSize;
+    }
+
+    return negErrnoOrSize;
+}
+
+// Send data on a socket with the underlying socket layer,
+// returning the number of bytes sent or negated errno.
+static int32_t writeUnderlying(uSockContainer_t *pContainer,
+                               const void *pData, size_t dataSizeBytes)
+{
+    uSockIoVec_t ioVec;
+
+    ioVec.pData = (void *) pData;
+    ioVec.dataSizeBytes = dataSizeBytes;
+
+    return writevUnderlying(pContainer, &ioVec, 1);
+}
+
+// Send whatever is in the coalesced write buffer of a socket,
+// returning zero or negated errno; anything that could not be
+// sent is kept.
+// This does NOT lock gMutexTx, you need to do that.
+static int32_t txBufferFlush(uSockContainer_t *pContainer)
+{
+    int32_t negErrno = U_SOCK_ENONE;
+    int32_t x;
+    size_t offset = 0;
+
+    if (pContainer->socket.txTimer != NULL) {
+        uPortTimerStop(pContainer->socket.txTimer);
+    }
+    while ((offset < pContainer->socket.txBufferLength) &&
+           (negErrno == U_SOCK_ENONE)) {
+        x = writeUnderlying(pContainer, pContainer->socket.pTxBuffer + offset,
+                            pContainer->socket.txBufferLength - offset);
+        if (x > 0) {
+            offset += x;
+        } else {
+            negErrno = x;
+            if (negErrno == 0) {
+                negErrno = -U_SOCK_EWOULDBLOCK;
+            }
+        }
+    }
+    if (offset > 0) {
+        pContainer->socket.txBufferLength -= offset;
+        memmove(pContainer->socket.pTxBuffer,
+                pContainer->socket.pTxBuffer + offset,
+                pContainer->socket.txBufferLength);
+    }
+
+    return negErrno;
+}
+
+// Add data to the coalesced write buffer of a socket, sending
+// the buffer each time it fills up and starting the timer if it
+// is left with data in it; returns the number of bytes taken
+// or negated errno.
+// This does NOT lock gMutexTx, you need to do that.
+static int32_t txBufferWrite(uSockContainer_t *pContainer,
+                             const void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoOrSize = U_SOCK_ENONE;
+    size_t offset = 0;
+    size_t length;
+
+    while ((offset < dataSizeBytes) && (negErrnoOrSize == U_SOCK_ENONE)) {
+        if (pContainer->socket.txBufferLength >= U_SOCK_WRITE_COALESCE_SIZE_BYTES) {
+            // Full, make room
+            negErrnoOrSize = txBufferFlush(pContainer);
+        } else {
+            length = U_SOCK_WRITE_COALESCE_SIZE_BYTES - pContainer->socket.txBufferLength;
+            if (length > dataSizeBytes - offset) {
+                length = dataSizeBytes - offset;
+            }
+            memcpy(pContainer->socket.pTxBuffer + pContainer->socket.txBufferLength,
+                   (const char *) pData + offset, length);
+            if (pContainer->socket.txBufferLength == 0) {
+                // First data into the buffer, start the clock
+                uPortTimerStart(pContainer->socket.txTimer);
+            }
+            pContainer->socket.txBufferLength += length;
+            offset += length;
+        }
+    }
+    if ((negErrnoOrSize == U_SOCK_ENONE) &&
+        (pContainer->socket.txBufferLength >= U_SOCK_WRITE_COALESCE_SIZE_BYTES)) {
+        // No point in waiting with a full buffer
+        negErrnoOrSize = txBufferFlush(pContainer);
+    }
+    if (offset > 0) {
+        // Data that was taken is either sent or in the buffer,
+        // where the timer will have another go at sending it
+        if ((negErrnoOrSize < 0) && (pContainer->socket.txBufferLength > 0)) {
+            uPortTimerStart(pContainer->socket.txTimer);
+        }
+        negErrnoOrSize = (int32_t) offset;
+    }
+
+    return negErrnoOrSize;
+}
+
+// Event handler for gFlushEventQueueHandle: send the coalesced
+// write buffer of the socket whose descriptor is at pParam.
+static void flushEventHandler(void *pParam, size_t paramLength)
+{
+    uSockDescriptor_t descriptor = *((uSockDescriptor_t *) pParam);
+    uSockContainer_t *pContainer;
+
+    (void) paramLength;
+
+    // gMutexContainer since a container may be re-used for a new
+    // socket while we look at it, then gMutexTx for the buffer;
+    // uSockDeinit() closes this event queue before it locks
+    // gMutexContainer, so that we can't hold it up
+    U_PORT_MUTEX_LOCK(gMutexContainer);
+    U_PORT_MUTEX_LOCK(gMutexTx);
+    if ((descriptor >= 0) && (descriptor < U_SOCK_MAX_NUM_SOCKETS)) {
+        pContainer = gpDescriptorTable[descriptor];
+        if ((pContainer != NULL) && (pContainer->socket.pTxBuffer != NULL) &&
+            (pContainer->socket.txBufferLength > 0)) {
+            if (txBufferFlush(pContainer) < 0) {
+                // Try again later
+                uPortTimerStart(pContainer->socket.txTimer);
+            }
+        }
+    }
+    U_PORT_MUTEX_UNLOCK(gMutexTx);
+    U_PORT_MUTEX_UNLOCK(gMutexContainer);
+}
+
+// Timer callback for a socket that is coalescing writes: pass
+// the descriptor to the flush task, since a timer callback must
+// not block.  Not the IRQ version of send, which some platforms
+// (e.g. Linux) don't support; keyed on the descriptor there can
+// only be one event per socket waiting, so there is always room.
+static void txTimerCallback(const uPortTimerHandle_t timerHandle,
+                            void *pParam)
+{
+    uSockDescriptor_t descriptor = (uSockDescriptor_t) (intptr_t) pParam;
+
+    (void) timerHandle;
+
+    uPortEventQueueSendExt(gFlushEventQueueHandle, &descriptor,
+                           sizeof(descriptor), descriptor, false);
+}
+
+// Start or stop coalescing writes on a TCP socket, returning
+// zero or negated errno; when stopping, anything buffered is sent.
+// This does NOT lock the container mutex, you need to do that.
+static int32_t coalesceSet(uSockContainer_t *pContainer, bool onNotOff)
+{
+    int32_t negErrno = U_SOCK_ENONE;
+
+    if (onNotOff) {
+        if (pContainer->socket.pTxBuffer == NULL) {
+            negErrno = -U_SOCK_ENOMEM;
+            if (gFlushEventQueueHandle < 0) {
+                gFlushEventQueueHandle = uPortEventQueueOpen(flushEventHandler,
+                                                             "sockFlush",
+                                                             sizeof(uSockDescriptor_t),
+                                                             U_SOCK_FLUSH_TASK_STACK_SIZE_BYTES,
+                                                             U_SOCK_FLUSH_TASK_PRIORITY,
+                                                             U_SOCK_MAX_NUM_SOCKETS);
+            }
+            if (gFlushEventQueueHandle >= 0) {
+                U_PORT_MUTEX_LOCK(gMutexTx);
+                pContainer->socket.pTxBuffer = (char *) pUPortMalloc(U_SOCK_WRITE_COALESCE_SIZE_BYTES);
+                if (pContainer->socket.pTxBuffer != NULL) {
+                    pContainer->socket.txBufferLength = 0;
+                    // Without a timer data could sit in the buffer
+                    // forever, so don't coalesce if there isn't one
+                    negErrno = -U_SOCK_ENOSYS;
+                    if (uPortTimerCreate(&(pContainer->socket.txTimer), "sockTx",
+                                         txTimerCallback,
+                                         (void *) (intptr_t) pContainer->descriptor,
+                                         U_SOCK_WRITE_COALESCE_TIME_MS, false) == 0) {
+                        negErrno = U_SOCK_ENONE;
+                    } else {
+                        pContainer->socket.txTimer = NULL;
+                        uPortFree(pContainer->socket.pTxBuffer);
+                        pContainer->socket.pTxBuffer = NULL;
+                    }
+                }
+                U_PORT_MUTEX_UNLOCK(gMutexTx);
+            }
+        }
+    } else {
+        if (pContainer->socket.pTxBuffer != NULL) {
+            U_PORT_MUTEX_LOCK(gMutexTx);
+            negErrno = txBufferFlush(pContainer);
+            U_PORT_MUTEX_UNLOCK(gMutexTx);
+            if (negErrno == U_SOCK_ENONE) {
+                containerTxBufferFree(pContainer);
+            }
+        }
+    }
+
+    return negErrno;
+}
+
+// Send anything in the coalesced write buffer of a socket,
+// returning zero or negated errno.
+// This does NOT lock the container mutex, you need to do that.
+static int32_t containerFlush(uSockContainer_t *pContainer)
+{
+    int32_t negErrno = U_SOCK_ENONE;
+
+    if (pContainer->socket.pTxBuffer != NULL) {
+        U_PORT_MUTEX_LOCK(gMutexTx);
+        negErrno = txBufferFlush(pContainer);
+        U_PORT_MUTEX_UNLOCK(gMutexTx);
+    }
+
+    return negErrno;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: CONNECTING
+ * -------------------------------------------------------------- */
+
+// Connect a socket at the underlying cell/wifi socket layer,
+// returning zero or negated errno.
+// This does NOT lock the container mutex, you need to do that
+// or otherwise make sure that the container doesn't go away.
+static int32_t connectUnderlying(uSockDescriptor_t descriptor,
+                                 uDeviceHandle_t devHandle,
+                                 int32_t sockHandle,
+                                 const uSockAddress_t *pRemoteAddress)
+{
+    int32_t errorCode = -U_SOCK_ENOSYS;
+#if U_CFG_ENABLE_LOGGING
+    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+#endif
+
+    uPortLog("U_SOCK: connecting socket to \"%.*s\"...\n",
+             addressToString(pRemoteAddress, true,
+                             buffer, sizeof(buffer)),
+             buffer);
+    // uXxxSockConnect() returns a negated value of errno
+    // from the U_SOCK_Exxx list
+    int32_t devType = uDeviceGetDeviceType(devHandle);
+    if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+        errorCode = uCellSockConnect(devHandle,
+                                     sockHandle,
+                                     pRemoteAddress);
+    } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
+        errorCode = uWifiSockConnect(devHandle,
+                                     sockHandle,
+                                     pRemoteAddress);
+    }
+
+    if (errorCode == 0) {
+        uPortLog("U_SOCK: socket with descriptor %d, network"
+                 " handle 0x%08x, socket handle %d, is "
+                 " connected to address \"%.*s\".\n",
+                 descriptor, devHandle, sockHandle,
+                 addressToString(pRemoteAddress,
+                                 true, buffer,
+                                 sizeof(buffer)),
+                 buffer);
+    } else {
+        uPortLog("U_SOCK: underlying layer errno %d on"
+                 " address \"%.*s\", descriptor/"
+                 "network/socket %d/0x%08x/%d.\n", -errorCode,
+                 addressToString(pRemoteAddress, true,
+                                 buffer, sizeof(buffer)),
+                 buffer, descriptor, devHandle,
+                 sockHandle);
+    }
+
+    return errorCode;
+}
+
+// Register closedCallback() with the underlying cell/wifi socket
+// layer for the given container.
+static void registerClosedUnderlying(const uSockContainer_t *pContainer)
+{
+    uDeviceHandle_t devHandle = pContainer->socket.devHandle;
+    int32_t sockHandle = pContainer->socket.sockHandle;
+    int32_t devType = uDeviceGetDeviceType(devHandle);
+
+    if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+        uCellSockRegisterCallbackClosed(devHandle, sockHandle, closedCallback);
+    } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
+        uWifiSockRegisterCallbackClosed(devHandle, sockHandle, closedCallback);
+    }
+}
+
+// Event handler for gConnectEventQueueHandle: connect the socket
+// whose descriptor is at pParam to the remote address stored in
+// it by uSockConnectAsync().
+static void connectEventHandler(void *pParam, size_t paramLength)
+{
+    uSockDescriptor_t descriptor = *((uSockDescriptor_t *) pParam);
+    uSockContainer_t *pContainer = NULL;
+    int32_t errorCode;
+    void (*pCallback) (uSockDescriptor_t, int32_t, void *) = NULL;
+    void *pCallbackParameter = NULL;
+
+    (void) paramLength;
+
+    if ((descriptor >= 0) && (descriptor < U_SOCK_MAX_NUM_SOCKETS)) {
+        pContainer = gpDescriptorTable[descriptor];
+    }
+    // Deliberately not locking gMutexContainer, which may be held
+    // for a long time by a blocking read: a socket that is in
+    // U_SOCK_STATE_CONNECTING cannot be closed, so the container
+    // will not go away under us
+    if ((pContainer != NULL) &&
+        (pContainer->socket.state == U_SOCK_STATE_CONNECTING)) {
+        errorCode = connectUnderlying(descriptor,
+                                      pContainer->socket.devHandle,
+                                      pContainer->socket.sockHandle,
+                                      &pContainer->socket.remoteAddress);
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        if (pContainer->socket.pClosedCallback != NULL) {
+            // uSockRegisterCallbackClosed() was called while
+            // the connection was in progress
+            registerClosedUnderlying(pContainer);
+        }
+        if (errorCode == 0) {
+            pContainer->socket.state = U_SOCK_STATE_CONNECTED;
+        } else {
+            // Back to square one so that the connect may be retried
+            memset(&pContainer->socket.remoteAddress, 0,
+                   sizeof(pContainer->socket.remoteAddress));
+            pContainer->socket.connectErrno = -errorCode;
+            pContainer->socket.state = U_SOCK_STATE_CREATED;
+        }
+        pCallback = pContainer->socket.pConnectCallback;
+        pCallbackParameter = pContainer->socket.pConnectCallbackParameter;
+        pContainer->socket.pConnectCallback = NULL;
+        selectWake();
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+        // Call the callback outside the mutex so that it is
+        // free to call back into this API
+        if (pCallback != NULL) {
+            pCallback(descriptor, errorCode, pCallbackParameter);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: RECEIVING
+ * -------------------------------------------------------------- */
+
+// Update the read latency statistics of a socket.
+static void readStatsUpdate(uSockContainer_t *pContainer, int32_t latencyMs)
+{
+    pContainer->socket.readLatencyTotalMs += latencyMs;
+    pContainer->socket.numReadLatency++;
+    if (latencyMs > pContainer->socket.stats.readLatencyMaxMs) {
+        pContainer->socket.stats.readLatencyMaxMs = latencyMs;
+    }
+}
+
+// Copy data out of the receive buffer of a socket, returning
+// the number of bytes copied.
+// This does NOT lock the container mutex, you need to do that.
+static int32_t rxBufferRead(uSockContainer_t *pContainer,
+                            void *pData, size_t dataSizeBytes)
+{
+    size_t length = pContainer->socket.rxBufferLength;
+
+    if (length > dataSizeBytes) {
+        length = dataSizeBytes;
+    }
+    memcpy(pData, pContainer->socket.pRxBuffer + pContainer->socket.rxBufferOffset,
+           length);
+    pContainer->socket.rxBufferOffset += length;
+    pContainer->socket.rxBufferLength -= length;
+    if (pContainer->socket.rxBufferLength > 0) {
+        // Still something to read: uSockSelect() should say so
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        pContainer->socket.dataIndicated = true;
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+    }
+
+    return (int32_t) length;
+}
+
+// Receive data on a socket, either UDP or TCP.
+// If mayWait is false only data that has already arrived is
+// returned, whether the socket is blocking or not.
+static int32_t receive(uSockContainer_t *pContainer,
+                       uSockAddress_t *pRemoteAddress,
+                       void *pData, size_t dataSizeBytes,
+                       bool mayWait)
+{
+    uDeviceHandle_t devHandle = pContainer->socket.devHandle;
+    int32_t sockHandle = pContainer->socket.sockHandle;
+    int32_t negErrnoOrSize = -U_SOCK_ENOSYS;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+    const uSockOps_t *pOps = U_SOCK_OPS(pContainer);
+    int64_t remainingMs;
+    int32_t waitMs;
+    bool isStream = (pContainer->socket.protocol != U_SOCK_PROTOCOL_UDP) ||
+                    (pContainer->socket.pSecurityContext != NULL);
+    char *pReadData = (char *) pData;
+    size_t readSizeBytes = dataSizeBytes;
+    bool useRxBuffer = false;
+    int32_t readStartTimeMs;
+
+    U_LOG_RAM_TRACE_BEGIN(U_LOG_RAM_TRACE_ID_SOCK_RECEIVE);
+
+    if (isStream && (pContainer->socket.rxBufferLength > 0)) {
+        // Serve the read from what is already buffered
+        negErrnoOrSize = rxBufferRead(pContainer, pData, dataSizeBytes);
+    } else {
+        // No need to stage reads through the buffer where the
+        // underlying layer already holds the received data in memory
+        if (isStream && (pContainer->socket.pRxBuffer != NULL) &&
+            pOps->rxBufferWorthwhile) {
+            if (dataSizeBytes < pContainer->socket.rxBufferSize) {
+                // Small read: fill the buffer with as much as the
+                // underlying layer has, in one go, rather than
+                // going to the module for every few bytes
+                useRxBuffer = true;
+                pReadData = pContainer->socket.pRxBuffer;
+                readSizeBytes = pContainer->socket.rxBufferSize;
+            }
+        }
+
+        // Run around the loop until a packet of data turns up
+        // or we time out or just once if we're non-blocking.
+        do {
+            // Clear the data indication _before_ reading so that
+            // an indication arriving during the read is not lost
+            U_PORT_MUTEX_LOCK(gMutexCallbacks);
+            pContainer->socket.dataIndicated = false;
+            U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+            pContainer->socket.stats.numUnderlyingReads++;
+            readStartTimeMs = uPortGetTickTimeMs();
+            if (!isStream) {
+                // UDP style
+                negErrnoOrSize = pOps->pReceiveFrom(devHandle,
+                                                    sockHandle,
+                                                    pRemoteAddress,
+                                                    pData,
+                                                    dataSizeBytes);
+            } else {
+                // TCP or DTLS style
+                negErrnoOrSize = pOps->pRead(devHandle,
+                                             sockHandle,
+                                             pReadData,
+                                             readSizeBytes);
+            }
+            if (negErrnoOrSize > 0) {
+                readStatsUpdate(pContainer, uPortGetTickTimeMs() - readStartTimeMs);
+            }
+            if ((negErrnoOrSize >= 0) &&
+                ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) ||
+                 (negErrnoOrSize == (int32_t) readSizeBytes))) {
+                // There may be more: another datagram or data that
+                // didn't fit, so uSockSelect() should still report
+                // this socket as readable
+                U_PORT_MUTEX_LOCK(gMutexCallbacks);
+                pContainer->socket.dataIndicated = true;
+                U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+            }
+            if ((negErrnoOrSize < 0) && mayWait) {
+                waitMs = U_SOCK_RECEIVE_POLL_INTERVAL_MS;
+                if (pContainer->socket.blocking && (pContainer->socket.dataSemaphore != NULL)) {
+                    // Wait for dataCallback() to tell us that data
+                    // has arrived, for no longer than the poll
+                    // interval in case an indication is missed
+                    remainingMs = pContainer->socket.receiveTimeoutMs -
+                                  (uPortGetTickTimeMs() - startTimeMs);
+                    if (remainingMs < waitMs) {
+                        waitMs = (int32_t) remainingMs;
+                    }
+                    if (waitMs > 0) {
+                        uPortSemaphoreTryTake(pContainer->socket.dataSemaphore, waitMs);
+                    }
+                } else {
+                    // Yield for the poll interval
+                    uPortTaskBlock(waitMs);
+                }
+            }
+        } while ((negErrnoOrSize < 0) && mayWait &&
+                 (pContainer->socket.blocking) &&
+                 (uPortGetTickTimeMs() - startTimeMs <
+                  pContainer->socket.receiveTimeoutMs));
+
+        if (useRxBuffer && (negErrnoOrSize > 0)) {
+            pContainer->socket.rxBufferOffset = 0;
+            pContainer->socket.rxBufferLength = (size_t) negErrnoOrSize;
+            negErrnoOrSize = rxBufferRead(pContainer, pData, dataSizeBytes);
+        }
+    }
+
+    if (negErrnoOrSize > 0) {
+        pContainer->socket.stats.bytesReceived += negErrnoOrSize;
+        pContainer->socket.stats.numReads++;
+    }
+
+    U_LOG_RAM_TRACE_END(U_LOG_RAM_TRACE_ID_SOCK_RECEIVE);
+
+    return negErrnoOrSize;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: FAILOVER
+ * -------------------------------------------------------------- */
+
+// Close a socket at the underlying cell/wifi socket layer without
+// involving the container, returning zero or negated errno.
+static int32_t closeUnderlying(uDeviceHandle_t devHandle, int32_t sockHandle)
+{
+    int32_t negErrno = -U_SOCK_ENOSYS;
+    const uSockOps_t *pOps = pOpsGet(devHandle);
+
+    if (pOps != NULL) {
+        negErrno = pOps->pClose(devHandle, sockHandle, NULL);
+    }
+
+    return negErrno;
+}
+
+// Move the underlying socket of a container to the given device,
+// see uSockMove(), returning zero or negated errno.
+// This does NOT lock the container mutex, you need to do that.
+static int32_t containerMove(uSockContainer_t *pContainer,
+                             uDeviceHandle_t devHandle)
+{
+    int32_t negErrno = -U_SOCK_ENODEV;
+    uDeviceHandle_t oldDevHandle = pContainer->socket.devHandle;
+    int32_t oldSockHandle = pContainer->socket.sockHandle;
+    int32_t sockHandle = -1;
+    int32_t devType = uDeviceGetDeviceType(devHandle);
+    const uSockOps_t *pOps = pOpsGet(devHandle);
+    bool connected = (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) &&
+                     (pContainer->socket.state == U_SOCK_STATE_CONNECTED);
+    bool registerClosed = (pContainer->socket.pClosedCallback != NULL) ||
+                          (pContainer->socket.failoverDevHandle != NULL);
+
+    if (uDeviceIsValidInstance(U_DEVICE_INSTANCE(devHandle))) {
+        negErrno = -U_SOCK_EOPNOTSUPP;
+        if (pContainer->socket.pSecurityContext == NULL) {
+            negErrno = -U_SOCK_EINVAL;
+            if ((pContainer->socket.state == U_SOCK_STATE_CREATED) ||
+                (pContainer->socket.state == U_SOCK_STATE_CONNECTED)) {
+                negErrno = -U_SOCK_ENOSYS;
+                if (pOps != NULL) {
+                    negErrno = pOps->pInitInstance(devHandle);
+                    if (negErrno == 0) {
+                        sockHandle = pOps->pCreate(devHandle,
+                                                   pContainer->socket.type,
+                                                   pContainer->socket.protocol);
+                        negErrno = sockHandle;
+                        if ((sockHandle >= 0) &&
+                            (devType == (int32_t) U_DEVICE_TYPE_CELL)) {
+                            uCellSockBlockingSet(devHandle, sockHandle, false);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (sockHandle >= 0) {
+        negErrno = U_SOCK_ENONE;
+        if (connected) {
+            negErrno = connectUnderlying(pContainer->descriptor, devHandle, sockHandle,
+                                         &(pContainer->socket.remoteAddress));
+        }
+        if (negErrno == U_SOCK_ENONE) {
+            if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+                uCellSockRegisterCallbackData(devHandle, sockHandle, dataCallback);
+                if (registerClosed) {
+                    uCellSockRegisterCallbackClosed(devHandle, sockHandle, closedCallback);
+                }
+            } else {
+                uWifiSockRegisterCallbackData(devHandle, sockHandle, dataCallback);
+                if (registerClosed) {
+                    uWifiSockRegisterCallbackClosed(devHandle, sockHandle, closedCallback);
+                }
+            }
+            // Swap the underlying sockets over, holding gMutexTx
+            // since the flush task may be sending on the socket;
+            // once out of gpDeviceHash[] the callbacks of the old
+            // underlying socket can no longer find the container
+            U_PORT_MUTEX_LOCK(gMutexTx);
+            containerDeviceHashRemove(pContainer);
+            pContainer->socket.devHandle = devHandle;
+            pContainer->socket.pOps = pOps;
+            pContainer->socket.sockHandle = sockHandle;
+            containerDeviceHashAdd(pContainer);
+            U_PORT_MUTEX_UNLOCK(gMutexTx);
+            U_PORT_MUTEX_LOCK(gMutexCallbacks);
+            pContainer->socket.failoverPending = false;
+            // There may be something for receive() in the
+            // new socket already or in our own buffer
+            pContainer->socket.dataIndicated = true;
+            U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+            // The old socket may well be dead, so don't care
+            // how closing it goes
+            closeUnderlying(oldDevHandle, oldSockHandle);
+            // Anything held back can go now
+            containerFlush(pContainer);
+            uPortLog("U_SOCK: socket with descriptor %d moved from network"
+                     " handle 0x%08x, socket handle %d, to network handle"
+                     " 0x%08x, socket handle %d.\n", pContainer->descriptor,
+                     oldDevHandle, oldSockHandle, devHandle, sockHandle);
+        } else {
+            closeUnderlying(devHandle, sockHandle);
+        }
+    }
+
+    return negErrno;
+}
+
+// If the underlying socket of a container has been lost and there
+// is a device to fail over to, move the socket there, returning
+// zero or negated errno.
+// This does NOT lock the container mutex, you need to do that.
+static int32_t containerFailover(uSockContainer_t *pContainer)
+{
+    int32_t negErrno = U_SOCK_ENONE;
+    uDeviceHandle_t devHandle = pContainer->socket.devHandle;
+    bool failoverPending;
+
+    U_PORT_MUTEX_LOCK(gMutexCallbacks);
+    failoverPending = pContainer->socket.failoverPending;
+    U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+    if (failoverPending && (pContainer->socket.failoverDevHandle != NULL)) {
+        negErrno = containerMove(pContainer, pContainer->socket.failoverDevHandle);
+        if (negErrno == U_SOCK_ENONE) {
+            // Allow a move back later
+            pContainer->socket.failoverDevHandle = devHandle;
+        }
+    }
+
+    return negErrno;
+}
+
+// Find the container for the given descriptor, as
+// pContainerFindByDescriptor(), and then move its socket if it
+// is due to fail over; on failure NULL is returned and *pErrno
+// is set.
+// This does NOT lock the mutex, you need to do that.
+static uSockContainer_t *pContainerFindByDescriptorAndFailover(uSockDescriptor_t descriptor,
+                                                               int32_t *pErrno)
+{
+    uSockContainer_t *pContainer = pContainerFindByDescriptor(descriptor);
+
+    *pErrno = U_SOCK_EBADF;
+    if (pContainer != NULL) {
+        *pErrno = -containerFailover(pContainer);
+        if (*pErrno != U_SOCK_ENONE) {
+            pContainer = NULL;
+        }
+    }
+
+    return pContainer;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
+ * -------------------------------------------------------------- */
+
+int32_t uSockCreate(uDeviceHandle_t devHandle, uSockType_t type,
+                    uSockProtocol_t protocol)
+{
+    return uSockCreateEx(devHandle, type, protocol, -1);
+}
+
+// Make an outgoing connection on the given socket.
+int32_t uSockConnect(uSockDescriptor_t descriptor,
+                     const uSockAddress_t *pRemoteAddress)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = U_SOCK_EINVAL;
+        // Check that the remote IP address is sensible
+        if (pRemoteAddress != NULL) {
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
 
             // Find the container
             pContainer = pContainerFindByDescriptor(descriptor);
             errnoLocal = U_SOCK_EBADF;
             if (pContainer != NULL) {
                 errnoLocal = U_SOCK_EPERM;
-                if (pContainer->socket.state == U_SOCK_STATE_CREATED) {
+                if (pContainer->socket.state == U_SOCK_STATE_CONNECTING) {
+                    errnoLocal = U_SOCK_EALREADY;
+                } else if (pContainer->socket.state == U_SOCK_STATE_CREATED) {
                     // We have found the container and it is
                     // in the right state, talk to the underlying
                     // cell/wifi socket layer to make the connection
-                    // uXxxSockConnect() returns a negated value of errno
-                    // from the U_SOCK_Exxx list
-                    devHandle = pContainer->socket.devHandle;
-                    sockHandle = pContainer->socket.sockHandle;
-                    errnoLocal = U_SOCK_ENONE;
-                    errorCode = -U_SOCK_ENOSYS;
-                    uPortLog("U_SOCK: connecting socket to \"%.*s\"...\n",
-                             addressToString(pRemoteAddress, true,
-                                             buffer, sizeof(buffer)),
-                             buffer);
-                    int32_t devType = uDeviceGetDeviceType(devHandle);
-                    if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                        errorCode = uCellSockConnect(devHandle,
-                                                     sockHandle,
-                                                     pRemoteAddress);
-                    } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                        errorCode = uWifiSockConnect(devHandle,
-                                                     sockHandle,
-                                                     pRemoteAddress);
-                    }
-
+                    errorCode = connectUnderlying(descriptor,
+                                                  pContainer->socket.devHandle,
+                                                  pContainer->socket.sockHandle,
+                                                  pRemoteAddress);
+                    errnoLocal = -errorCode;
                     if (errorCode == 0) {
                         // All is good
                         memcpy(&pContainer->socket.remoteAddress,
                                pRemoteAddress,
                                sizeof(pContainer->socket.remoteAddress));
                         pContainer->socket.state = U_SOCK_STATE_CONNECTED;
-                        uPortLog("U_SOCK: socket with descriptor %d, network"
-                                 " handle 0x%08x, socket handle %d, is "
-                                 " connected to address \"%.*s\".\n",
-                                 descriptor, devHandle, sockHandle,
-                                 addressToString(&pContainer->socket.remoteAddress,
-                                                 true, buffer,
-                                                 sizeof(buffer)),
-                                 buffer);
-                    } else {
-                        // Set errno
-                        errnoLocal = -errorCode;
-                        uPortLog("U_SOCK: underlying layer errno %d on"
-                                 " address \"%.*s\", descriptor/"
-                                 "network/socket %d/0x%08x/%d.\n", errnoLocal,
-                                 addressToString(pRemoteAddress, true,
-                                                 buffer, sizeof(buffer)),
-                                 buffer, descriptor, devHandle,
-                                 sockHandle);
+                    }
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        }
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Make an outgoing connection on the given socket without waiting.
+int32_t uSockConnectAsync(uSockDescriptor_t descriptor,
+                          const uSockAddress_t *pRemoteAddress,
+                          void (*pCallback) (uSockDescriptor_t, int32_t, void *),
+                          void *pCallbackParameter)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = U_SOCK_EINVAL;
+        if (pRemoteAddress != NULL) {
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+
+            // Find the container
+            pContainer = pContainerFindByDescriptor(descriptor);
+            errnoLocal = U_SOCK_EBADF;
+            if (pContainer != NULL) {
+                errnoLocal = U_SOCK_EPERM;
+                if (pContainer->socket.state == U_SOCK_STATE_CONNECTING) {
+                    errnoLocal = U_SOCK_EALREADY;
+                } else if (pContainer->socket.state == U_SOCK_STATE_CREATED) {
+                    errnoLocal = U_SOCK_ENOMEM;
+                    if (gConnectEventQueueHandle < 0) {
+                        gConnectEventQueueHandle = uPortEventQueueOpen(connectEventHandler,
+                                                                       "sockConnect",
+                                                                       sizeof(uSockDescriptor_t),
+                                                                       U_SOCK_CONNECT_TASK_STACK_SIZE_BYTES,
+                                                                       U_SOCK_CONNECT_TASK_PRIORITY,
+                                                                       U_SOCK_MAX_NUM_SOCKETS);
+                    }
+                    if (gConnectEventQueueHandle >= 0) {
+                        // The address is kept in the socket for the
+                        // event handler, which cannot see the caller's
+                        memcpy(&pContainer->socket.remoteAddress,
+                               pRemoteAddress,
+                               sizeof(pContainer->socket.remoteAddress));
+                        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+                        pContainer->socket.pConnectCallback = pCallback;
+                        pContainer->socket.pConnectCallbackParameter = pCallbackParameter;
+                        pContainer->socket.connectErrno = U_SOCK_ENONE;
+                        pContainer->socket.state = U_SOCK_STATE_CONNECTING;
+                        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+                        errnoLocal = U_SOCK_ENONE;
+                        if (uPortEventQueueSend(gConnectEventQueueHandle,
+                                                &descriptor,
+                                                sizeof(descriptor)) != 0) {
+                            errnoLocal = U_SOCK_ENOBUFS;
+                            U_PORT_MUTEX_LOCK(gMutexCallbacks);
+                            memset(&pContainer->socket.remoteAddress, 0,
+                                   sizeof(pContainer->socket.remoteAddress));
+                            pContainer->socket.pConnectCallback = NULL;
+                            pContainer->socket.state = U_SOCK_STATE_CREATED;
+                            U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+                        }
                     }
                 }
             }
@@ -1377,7 +2781,11 @@ int32_t uSockClose(uSockDescriptor_t descriptor)
         // Find the container
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
-        if (pContainer != NULL) {
+        if ((pContainer != NULL) &&
+            (pContainer->socket.state == U_SOCK_STATE_CONNECTING)) {
+            // The connect event handler is using the socket
+            errnoLocal = U_SOCK_EBUSY;
+        } else if (pContainer != NULL) {
             // We have found the container, talk to the underlying
             // cell/wifi socket layer to close the socket there.
             // If the underlying socket layer waits while it gets
@@ -1391,21 +2799,26 @@ int32_t uSockClose(uSockDescriptor_t descriptor)
             sockHandle = pContainer->socket.sockHandle;
             errnoLocal = U_SOCK_ENONE;
             errorCode = -U_SOCK_ENOSYS;
-            int32_t devType = uDeviceGetDeviceType(devHandle);
-            if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+            // A local close is never a loss to fail over from
+            pContainer->socket.failoverDevHandle = NULL;
+            // Send anything that is held back first
+            containerFlush(pContainer);
+            if (pContainer->socket.failoverPending) {
+                // The network has already closed the underlying
+                // socket, just tidy up
+                closeUnderlying(devHandle, sockHandle);
+                errorCode = 0;
+            } else {
                 // In the cellular case asynchronous TCP
                 // socket closure is used in some cases.
-                if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
+                if (U_SOCK_OPS(pContainer)->closeTcpAsync &&
+                    (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP)) {
                     finalState = U_SOCK_STATE_CLOSING;
                     pAsyncClosedCallback = closedCallback;
                 }
-                errorCode = uCellSockClose(devHandle,
-                                           sockHandle,
-                                           pAsyncClosedCallback);
-            } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                errorCode = uWifiSockClose(devHandle,
-                                           sockHandle,
-                                           pAsyncClosedCallback);
+                errorCode = U_SOCK_OPS(pContainer)->pClose(devHandle,
+                                                           sockHandle,
+                                                           pAsyncClosedCallback);
             }
             if (errorCode == 0) {
                 uPortLog("U_SOCK: socket with descriptor %d,"
@@ -1492,14 +2905,22 @@ void uSockCleanUp()
                     devHandle = pContainer->socket.devHandle;
 
                     // Free the memory
+                    containerUnindex(pContainer);
+                    containerDataSemaphoreDelete(pContainer);
+                    containerRxBufferFree(pContainer);
+                    containerTxBufferFree(pContainer);
                     uPortFree(pContainer);
                     // Move to the next entry
                     pContainer = pTmp;
                 } else {
                     // Remember the network handle
                     devHandle = pContainer->socket.devHandle;
+                    containerUnindex(pContainer);
                     pContainer->socket.state = U_SOCK_STATE_CLOSED;
                     pContainer->socket.devHandle = NULL;
+                    containerDataSemaphoreDelete(pContainer);
+                    containerRxBufferFree(pContainer);
+                    containerTxBufferFree(pContainer);
                     // Move on
                     pContainer = pContainer->pNext;
                 }
@@ -1540,8 +2961,22 @@ void uSockDeinit()
 
     if (gInitialised) {
 
+        // The flush task locks the container mutex so it must
+        // be stopped before we lock it, see uPortEventQueueClose()
+        if (gFlushEventQueueHandle >= 0) {
+            uPortEventQueueClose(gFlushEventQueueHandle);
+            gFlushEventQueueHandle = -1;
+        }
+
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
+        // The connect task doesn't lock the container mutex
+        // at all so it can be stopped while we hold it
+        if (gConnectEventQueueHandle >= 0) {
+            uPortEventQueueClose(gConnectEventQueueHandle);
+            gConnectEventQueueHandle = -1;
+        }
+
         // Move through the list closing and
         // removing sockets
         while (pContainer != NULL) {
@@ -1581,16 +3016,28 @@ void uSockDeinit()
                 pTmp = pContainer->pNext;
 
                 // Free the memory
+                containerUnindex(pContainer);
+                containerDataSemaphoreDelete(pContainer);
+                containerRxBufferFree(pContainer);
+                containerTxBufferFree(pContainer);
                 uPortFree(pContainer);
                 // Move to the next entry
                 pContainer = pTmp;
             } else {
+                containerUnindex(pContainer);
                 pContainer->socket.state = U_SOCK_STATE_CLOSED;
+                pContainer->socket.devHandle = NULL;
+                containerDataSemaphoreDelete(pContainer);
+                containerRxBufferFree(pContainer);
+                containerTxBufferFree(pContainer);
                 // Move on
                 pContainer = pContainer->pNext;
             }
         }
 
+        // Device handles may be re-used after this
+        uSockHostCacheFlush(NULL);
+
         // We can now deinit();
         deinitButNotMutex();
 
@@ -1712,6 +3159,41 @@ int32_t uSockOptionSet(uSockDescriptor_t descriptor,
                         printSocketOption(pOptionValue, optionValueLength);
                         uPortLog("\n");
                     }
+                } else if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                           (option == U_SOCK_OPT_RCVBUF) &&
+                           ((pContainer->socket.protocol != U_SOCK_PROTOCOL_UDP) ||
+                            (pContainer->socket.pSecurityContext != NULL))) {
+                    // Receive buffer for a stream socket we keep
+                    // locally; can only be changed while it is empty
+                    if ((pOptionValue != NULL) &&
+                        (optionValueLength == sizeof(int32_t)) &&
+                        (*((const int32_t *) pOptionValue) >= 0)) {
+                        errnoLocal = U_SOCK_EBUSY;
+                        if (pContainer->socket.rxBufferLength == 0) {
+                            errnoLocal = U_SOCK_ENONE;
+                            containerRxBufferFree(pContainer);
+                            if (*((const int32_t *) pOptionValue) > 0) {
+                                pContainer->socket.pRxBuffer = (char *) pUPortMalloc(*((const int32_t *)
+                                                                                       pOptionValue));
+                                if (pContainer->socket.pRxBuffer != NULL) {
+                                    pContainer->socket.rxBufferSize = *((const int32_t *) pOptionValue);
+                                } else {
+                                    errnoLocal = U_SOCK_ENOMEM;
+                                }
+                            }
+                        }
+                    }
+                    if (errnoLocal == U_SOCK_ENONE) {
+                        uPortLog("U_SOCK: receive buffer for socket descriptor"
+                                 " %d set to %d byte(s).\n", descriptor,
+                                 (int32_t) pContainer->socket.rxBufferSize);
+                    } else {
+                        uPortLog("U_SOCK: errno %d when setting receive buffer"
+                                 " for socket descriptor %d to value ",
+                                 errnoLocal, descriptor);
+                        printSocketOption(pOptionValue, optionValueLength);
+                        uPortLog("\n");
+                    }
                 } else {
                     // Otherwise talk to the underlying socket
                     // layer to set the socket option.
@@ -1736,6 +3218,24 @@ int32_t uSockOptionSet(uSockDescriptor_t descriptor,
                                                        optionValueLength);
                     }
 
+                    if ((errorCode == 0) && (level == U_SOCK_OPT_LEVEL_TCP) &&
+                        (option == U_SOCK_OPT_TCP_NODELAY) &&
+                        (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) &&
+                        (pOptionValue != NULL) &&
+                        (optionValueLength == sizeof(int32_t))) {
+                        // Nagle on means coalesce writes here too;
+                        // not being able to do so is not an error,
+                        // not being able to send what was held is
+                        if (*((const int32_t *) pOptionValue) == 0) {
+                            if (coalesceSet(pContainer, true) < 0) {
+                                uPortLog("U_SOCK: unable to coalesce writes"
+                                         " on socket descriptor %d.\n",
+                                         descriptor);
+                            }
+                        } else {
+                            errorCode = coalesceSet(pContainer, false);
+                        }
+                    }
                     if (errorCode == 0) {
                         // All good
                         uPortLog("U_SOCK: socket option %d:0x%04x"
@@ -1815,6 +3315,39 @@ int32_t uSockOptionGet(uSockDescriptor_t descriptor,
                             *pOptionValueLength = sizeof(struct timeval);
                         }
                     }
+                } else if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                           (option == U_SOCK_OPT_ERROR) &&
+                           (pContainer->socket.connectErrno != U_SOCK_ENONE)) {
+                    // The result of a failed asynchronous connect
+                    if (pOptionValueLength != NULL) {
+                        if (pOptionValue != NULL) {
+                            if (*pOptionValueLength >= sizeof(int32_t)) {
+                                errnoLocal = U_SOCK_ENONE;
+                                *((int32_t *) pOptionValue) = pContainer->socket.connectErrno;
+                                *pOptionValueLength = sizeof(int32_t);
+                                pContainer->socket.connectErrno = U_SOCK_ENONE;
+                            }
+                        } else {
+                            errnoLocal = U_SOCK_ENONE;
+                            *pOptionValueLength = sizeof(int32_t);
+                        }
+                    }
+                } else if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                           (option == U_SOCK_OPT_RCVBUF) &&
+                           (pContainer->socket.pRxBuffer != NULL)) {
+                    // Receive buffer we have locally
+                    if (pOptionValueLength != NULL) {
+                        if (pOptionValue != NULL) {
+                            if (*pOptionValueLength >= sizeof(int32_t)) {
+                                errnoLocal = U_SOCK_ENONE;
+                                *((int32_t *) pOptionValue) = (int32_t) pContainer->socket.rxBufferSize;
+                                *pOptionValueLength = sizeof(int32_t);
+                            }
+                        } else {
+                            errnoLocal = U_SOCK_ENONE;
+                            *pOptionValueLength = sizeof(int32_t);
+                        }
+                    }
                 } else {
                     // Otherwise talk to the underlying socket layer
                     // to get the socket option.
@@ -1998,8 +3531,8 @@ int32_t uSockSendTo(uSockDescriptor_t descriptor,
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
         // Find the container
-        errnoLocal = U_SOCK_EBADF;
-        pContainer = pContainerFindByDescriptor(descriptor);
+        pContainer = pContainerFindByDescriptorAndFailover(descriptor,
+                                                           &errnoLocal);
         if (pContainer != NULL) {
             // Check address and state
             if (pRemoteAddress != NULL) {
@@ -2044,26 +3577,17 @@ int32_t uSockSendTo(uSockDescriptor_t descriptor,
                             // from the U_SOCK_Exxx list.
                             devHandle = pContainer->socket.devHandle;
                             sockHandle = pContainer->socket.sockHandle;
-                            errorCodeOrSize = -U_SOCK_ENOSYS;
-                            int32_t devType = uDeviceGetDeviceType(devHandle);
-                            if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                                errorCodeOrSize = uCellSockSendTo(devHandle,
-                                                                  sockHandle,
-                                                                  pRemoteAddress,
-                                                                  pData,
-                                                                  dataSizeBytes);
-                                if (errorCodeOrSize > 0) {
-                                    pContainer->socket.bytesSent += errorCodeOrSize;
-                                }
-                            } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                                errorCodeOrSize = uWifiSockSendTo(devHandle,
-                                                                  sockHandle,
-                                                                  pRemoteAddress,
-                                                                  pData,
-                                                                  dataSizeBytes);
-                                if (errorCodeOrSize > 0) {
-                                    pContainer->socket.bytesSent += errorCodeOrSize;
-                                }
+                            pContainer->socket.stats.numUnderlyingWrites++;
+                            errorCodeOrSize = U_SOCK_OPS(pContainer)->pSendTo(devHandle,
+                                                                              sockHandle,
+                                                                              pRemoteAddress,
+                                                                              pData,
+                                                                              dataSizeBytes);
+                            if (errorCodeOrSize > 0) {
+                                pContainer->socket.bytesSent += errorCodeOrSize;
+                            }
+                            if (errorCodeOrSize < (int32_t) dataSizeBytes) {
+                                pContainer->socket.stats.numWriteRetries++;
                             }
 
                             if (errorCodeOrSize < 0) {
@@ -2102,6 +3626,47 @@ int32_t uSockGetTotalBytesSent(uSockDescriptor_t descriptor)
     return errorCodeOrTotalBytesSent;
 }
 
+// Get the statistics of a socket.
+int32_t uSockStatsGet(uSockDescriptor_t descriptor, uSockStats_t *pStats)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EINVAL;
+            if (pStats != NULL) {
+                errnoLocal = U_SOCK_ENONE;
+                *pStats = pContainer->socket.stats;
+                pStats->bytesSent = pContainer->socket.bytesSent;
+                pStats->readLatencyMeanMs = 0;
+                if (pContainer->socket.numReadLatency > 0) {
+                    pStats->readLatencyMeanMs = (int32_t) (pContainer->socket.readLatencyTotalMs /
+                                                           pContainer->socket.numReadLatency);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
 // Receive a single datagram from the given host.
 int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
                          uSockAddress_t *pRemoteAddress,
@@ -2117,8 +3682,8 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
         // Find the container
-        errnoLocal = U_SOCK_EBADF;
-        pContainer = pContainerFindByDescriptor(descriptor);
+        pContainer = pContainerFindByDescriptorAndFailover(descriptor,
+                                                           &errnoLocal);
         if (pContainer != NULL) {
             errnoLocal = U_SOCK_EPROTOTYPE;
             // It is OK to receive UDP-style on a TCP socket
@@ -2142,7 +3707,8 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
                                 errorCodeOrSize = receive(pContainer,
                                                           pRemoteAddress,
                                                           pData,
-                                                          dataSizeBytes);
+                                                          dataSizeBytes,
+                                                          true);
                                 if (errorCodeOrSize < 0) {
                                     // Set errno
                                     errnoLocal = -errorCodeOrSize;
@@ -2173,12 +3739,24 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
 // Send data.
 int32_t uSockWrite(uSockDescriptor_t descriptor,
                    const void *pData, size_t dataSizeBytes)
+{
+    uSockIoVec_t ioVec;
+
+    ioVec.pData = (void *) pData;
+    ioVec.dataSizeBytes = dataSizeBytes;
+
+    return uSockWritev(descriptor, &ioVec, 1);
+}
+
+// Send data gathered from several buffers.
+int32_t uSockWritev(uSockDescriptor_t descriptor,
+                    const uSockIoVec_t *pIoVec, size_t count)
 {
     int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    uDeviceHandle_t devHandle;
-    int32_t sockHandle;
+    size_t dataSizeBytes;
+    int32_t x = 0;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -2186,42 +3764,41 @@ int32_t uSockWrite(uSockDescriptor_t descriptor,
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
         // Find the container
-        errnoLocal = U_SOCK_EBADF;
-        pContainer = pContainerFindByDescriptor(descriptor);
+        pContainer = pContainerFindByDescriptorAndFailover(descriptor,
+                                                           &errnoLocal);
         if (pContainer != NULL) {
             if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
                 errnoLocal = U_SOCK_EINVAL;
-                if (((pData == NULL) && (dataSizeBytes > 0)) ||
-                    (dataSizeBytes > INT_MAX)) {
+                dataSizeBytes = ioVecSize(pIoVec, count);
+                if (dataSizeBytes > INT_MAX) {
                     // Invalid argument
                 } else {
                     errnoLocal = U_SOCK_ENONE;
-                    if ((pData != NULL) && (dataSizeBytes != 0)) {
-                        // Talk to the underlying cell/wifi
-                        // socket layer to send the datagram.
-                        // uXxxSockWrite() returns the number
-                        // of bytes sent or a negated value of
-                        // errno from the U_SOCK_Exxx list.
-                        devHandle = pContainer->socket.devHandle;
-                        sockHandle = pContainer->socket.sockHandle;
-                        errorCodeOrSize = -U_SOCK_ENOSYS;
-                        int32_t devType = uDeviceGetDeviceType(devHandle);
-                        if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                            errorCodeOrSize = uCellSockWrite(devHandle,
-                                                             sockHandle,
-                                                             pData,
-                                                             dataSizeBytes);
-                            if (errorCodeOrSize > 0) {
-                                pContainer->socket.bytesSent += errorCodeOrSize;
-                            }
-                        } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                            errorCodeOrSize = uWifiSockWrite(devHandle,
-                                                             sockHandle,
-                                                             pData,
-                                                             dataSizeBytes);
-                            if (errorCodeOrSize > 0) {
-                                pContainer->socket.bytesSent += errorCodeOrSize;
+                    if (dataSizeBytes > 0) {
+                        if (pContainer->socket.pTxBuffer != NULL) {
+                            // Coalescing writes
+                            U_PORT_MUTEX_LOCK(gMutexTx);
+                            for (size_t y = 0; (y < count) && (x >= 0) &&
+                                 (errorCodeOrSize >= 0); y++) {
+                                if (pIoVec[y].dataSizeBytes > 0) {
+                                    x = txBufferWrite(pContainer, pIoVec[y].pData,
+                                                      pIoVec[y].dataSizeBytes);
+                                    if (x >= 0) {
+                                        errorCodeOrSize += x;
+                                        if (x < (int32_t) pIoVec[y].dataSizeBytes) {
+                                            // Not all taken, stop here
+                                            x = -1;
+                                        }
+                                    } else if (errorCodeOrSize == 0) {
+                                        errorCodeOrSize = x;
+                                    }
+                                }
                             }
+                            U_PORT_MUTEX_UNLOCK(gMutexTx);
+                        } else {
+                            // Talk to the underlying cell/wifi
+                            // socket layer to send the data
+                            errorCodeOrSize = writevUnderlying(pContainer, pIoVec, count);
                         }
 
                         if (errorCodeOrSize < 0) {
@@ -2257,13 +3834,60 @@ int32_t uSockWrite(uSockDescriptor_t descriptor,
     return errorCodeOrSize;
 }
 
+// Send anything held back by uSockWrite().
+int32_t uSockFlush(uSockDescriptor_t descriptor)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        pContainer = pContainerFindByDescriptorAndFailover(descriptor,
+                                                           &errnoLocal);
+        if (pContainer != NULL) {
+            errnoLocal = -containerFlush(pContainer);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
 // Receive data.
 int32_t uSockRead(uSockDescriptor_t descriptor,
                   void *pData, size_t dataSizeBytes)
+{
+    uSockIoVec_t ioVec;
+
+    ioVec.pData = pData;
+    ioVec.dataSizeBytes = dataSizeBytes;
+
+    return uSockReadv(descriptor, &ioVec, 1);
+}
+
+// Receive data into several buffers.
+int32_t uSockReadv(uSockDescriptor_t descriptor,
+                   const uSockIoVec_t *pIoVec, size_t count)
 {
     int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
+    size_t dataSizeBytes;
+    bool mayWait = true;
+    int32_t x = 0;
+    char *pBuffer;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -2271,24 +3895,61 @@ int32_t uSockRead(uSockDescriptor_t descriptor,
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
         // Find the container
-        errnoLocal = U_SOCK_EBADF;
-        pContainer = pContainerFindByDescriptor(descriptor);
+        pContainer = pContainerFindByDescriptorAndFailover(descriptor,
+                                                           &errnoLocal);
         if (pContainer != NULL) {
             if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
                 errnoLocal = U_SOCK_EINVAL;
-                if (((pData == NULL) && (dataSizeBytes > 0)) ||
-                    (dataSizeBytes > INT_MAX)) {
+                dataSizeBytes = ioVecSize(pIoVec, count);
+                if (dataSizeBytes > INT_MAX) {
                     // Invalid argument
                 } else {
                     errnoLocal = U_SOCK_ENONE;
-                    if ((pData != NULL) && (dataSizeBytes != 0)) {
-                        // Receive the datagram
-                        errorCodeOrSize = receive(pContainer,
-                                                  NULL, pData,
-                                                  dataSizeBytes);
-                        if (errorCodeOrSize < 0) {
-                            // Set errno
-                            errnoLocal = -errorCodeOrSize;
+                    if (dataSizeBytes > 0) {
+                        // Anything held back is likely what
+                        // the far end is waiting for
+                        containerFlush(pContainer);
+                        if ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) &&
+                            (pContainer->socket.pSecurityContext == NULL) && (count > 1)) {
+                            // Each read would take a datagram of its
+                            // own, so read one datagram into a single
+                            // buffer and scatter it from there
+                            x = -U_SOCK_ENOMEM;
+                            pBuffer = (char *) pUPortMalloc(dataSizeBytes);
+                            if (pBuffer != NULL) {
+                                x = receive(pContainer, NULL, pBuffer,
+                                            dataSizeBytes, mayWait);
+                                if (x >= 0) {
+                                    x = (int32_t) ioVecScatter(pIoVec, count,
+                                                               pBuffer, x);
+                                }
+                                uPortFree(pBuffer);
+                            }
+                            errorCodeOrSize = x;
+                            if (x < 0) {
+                                errnoLocal = -x;
+                            }
+                        } else {
+                            // Fill the buffers in turn, only waiting
+                            // for the first lot of data, stopping
+                            // when one is not filled
+                            for (size_t y = 0; (y < count) && (x >= 0); y++) {
+                                if (pIoVec[y].dataSizeBytes > 0) {
+                                    x = receive(pContainer, NULL, pIoVec[y].pData,
+                                                pIoVec[y].dataSizeBytes, mayWait);
+                                    if (x >= 0) {
+                                        errorCodeOrSize += x;
+                                        if (x < (int32_t) pIoVec[y].dataSizeBytes) {
+                                            x = -1;
+                                        }
+                                    } else if (mayWait) {
+                                        // Nothing at all: set errno
+                                        errorCodeOrSize = x;
+                                        errnoLocal = -x;
+                                    }
+                                    mayWait = false;
+                                }
+                            }
                         }
                     }
                 }
@@ -2338,6 +3999,10 @@ int32_t uSockShutdown(uSockDescriptor_t descriptor,
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
+            if (how != U_SOCK_SHUTDOWN_READ) {
+                // Send anything that is held back first
+                containerFlush(pContainer);
+            }
             // Set the socket state
             switch (how) {
                 case U_SOCK_SHUTDOWN_READ:
@@ -2370,6 +4035,87 @@ int32_t uSockShutdown(uSockDescriptor_t descriptor,
     return errorCode;
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: DIRECT LINK
+ * -------------------------------------------------------------- */
+
+// Put a socket into direct link mode.
+int32_t uSockDirectLinkEnter(uSockDescriptor_t descriptor,
+                             uDeviceSerial_t **ppDeviceSerial)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EOPNOTSUPP;
+            if ((pContainer->socket.type == U_SOCK_TYPE_STREAM) &&
+                (uDeviceGetDeviceType(pContainer->socket.devHandle) ==
+                 (int32_t) U_DEVICE_TYPE_CELL)) {
+                // Send anything that is held back first
+                containerFlush(pContainer);
+                errnoLocal = -uCellSockDirectLinkEnter(pContainer->socket.devHandle,
+                                                       pContainer->socket.sockHandle,
+                                                       ppDeviceSerial);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Take a socket out of direct link mode.
+int32_t uSockDirectLinkExit(uSockDescriptor_t descriptor)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_ENONE;
+            if (uDeviceGetDeviceType(pContainer->socket.devHandle) ==
+                (int32_t) U_DEVICE_TYPE_CELL) {
+                errnoLocal = -uCellSockDirectLinkExit(pContainer->socket.devHandle,
+                                                      pContainer->socket.sockHandle);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: ASYNC
  * -------------------------------------------------------------- */
@@ -2457,7 +4203,13 @@ void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
             sockHandle = pContainer->socket.sockHandle;
             errnoLocal = U_SOCK_ENOSYS;
             int32_t devType = uDeviceGetDeviceType(devHandle);
-            if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+            if (pContainer->socket.state == U_SOCK_STATE_CONNECTING) {
+                // The connect task is using the underlying socket
+                // without gMutexContainer, so leave it alone: the
+                // callback is registered with the underlying layer
+                // by connectEventHandler() once the connection is done
+                errnoLocal = U_SOCK_ENONE;
+            } else if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
                 uCellSockRegisterCallbackClosed(devHandle,
                                                 sockHandle,
                                                 closedCallback);
@@ -2485,6 +4237,136 @@ void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
     }
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: FAILOVER
+ * -------------------------------------------------------------- */
+
+// Move a socket to a different device.
+int32_t uSockMove(uSockDescriptor_t descriptor, uDeviceHandle_t devHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_ENONE;
+            if ((devHandle != pContainer->socket.devHandle) ||
+                pContainer->socket.failoverPending) {
+                errnoLocal = -containerMove(pContainer, devHandle);
+                if ((errnoLocal == U_SOCK_ENONE) &&
+                    (pContainer->socket.failoverDevHandle == devHandle)) {
+                    // Don't fail over to where we already are
+                    pContainer->socket.failoverDevHandle = NULL;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Give a socket a device to fail over to.
+int32_t uSockFailoverSet(uSockDescriptor_t descriptor,
+                         uDeviceHandle_t devHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t devType;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_ENODEV;
+            if ((devHandle == NULL) ||
+                uDeviceIsValidInstance(U_DEVICE_INSTANCE(devHandle))) {
+                errnoLocal = U_SOCK_EOPNOTSUPP;
+                if ((devHandle == NULL) ||
+                    (pContainer->socket.pSecurityContext == NULL)) {
+                    errnoLocal = U_SOCK_ENONE;
+                    if ((devHandle != NULL) &&
+                        (pContainer->socket.failoverDevHandle == NULL) &&
+                        (pContainer->socket.pClosedCallback == NULL)) {
+                        // Need to hear about the underlying socket
+                        // being closed
+                        devType = uDeviceGetDeviceType(pContainer->socket.devHandle);
+                        if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+                            uCellSockRegisterCallbackClosed(pContainer->socket.devHandle,
+                                                            pContainer->socket.sockHandle,
+                                                            closedCallback);
+                        } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
+                            errnoLocal = -uWifiSockRegisterCallbackClosed(pContainer->socket.devHandle,
+                                                                          pContainer->socket.sockHandle,
+                                                                          closedCallback);
+                        }
+                    }
+                    if (errnoLocal == U_SOCK_ENONE) {
+                        pContainer->socket.failoverDevHandle = devHandle;
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Mark the sockets on a device as lost.
+void uSockFailoverTrigger(uDeviceHandle_t devHandle)
+{
+    uSockContainer_t *pContainer;
+
+    if (gInitialised) {
+        // Don't lock the container mutex here since this may be
+        // called from a network status callback while a send or
+        // receive is in progress that already has the mutex,
+        // just like closedCallback()
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        for (size_t x = 0; x < U_SOCK_MAX_NUM_SOCKETS; x++) {
+            pContainer = gpDescriptorTable[x];
+            if ((pContainer != NULL) &&
+                (pContainer->socket.state != U_SOCK_STATE_CLOSED) &&
+                (pContainer->socket.devHandle == devHandle) &&
+                (pContainer->socket.failoverDevHandle != NULL)) {
+                pContainer->socket.failoverPending = true;
+                pContainer->socket.dataIndicated = true;
+            }
+        }
+        selectWake();
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TCP INCOMING (TCP SERVER) ONLY
  * -------------------------------------------------------------- */
@@ -2638,18 +4520,83 @@ int32_t uSockAccept(uSockDescriptor_t descriptor,
 // Select: wait for one of a set of sockets to become unblocked.
 int32_t uSockSelect(int32_t maxDescriptor,
                     uSockDescriptorSet_t *pReadDescriptorSet,
-                    uSockDescriptorSet_t *pWriteDescriptoreSet,
+                    uSockDescriptorSet_t *pWriteDescriptorSet,
                     uSockDescriptorSet_t *pExceptDescriptorSet,
                     int32_t timeMs)
 {
-    // TODO
-    (void) maxDescriptor;
-    (void) pReadDescriptorSet;
-    (void) pWriteDescriptoreSet;
-    (void) pExceptDescriptorSet;
-    (void) timeMs;
-    errno = U_SOCK_ENOSYS;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+    int32_t errorCodeOrNum = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    int32_t errnoLocal;
+    uSockDescriptorSet_t readSet = {0};
+    uSockDescriptorSet_t writeSet = {0};
+    uSockDescriptorSet_t exceptSet = {0};
+    int32_t startTimeMs = uPortGetTickTimeMs();
+    int32_t waitMs;
+    bool keepGoing = true;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = U_SOCK_EINVAL;
+        if ((maxDescriptor >= 0) && (maxDescriptor <= U_SOCK_DESCRIPTOR_SET_SIZE)) {
+            errnoLocal = U_SOCK_ENONE;
+            // Keep the sets we were asked about, since the
+            // passed-in sets are overwritten with the result
+            if (pReadDescriptorSet != NULL) {
+                memcpy(readSet, *pReadDescriptorSet, sizeof(readSet));
+            }
+            if (pWriteDescriptorSet != NULL) {
+                memcpy(writeSet, *pWriteDescriptorSet, sizeof(writeSet));
+            }
+            if (pExceptDescriptorSet != NULL) {
+                memcpy(exceptSet, *pExceptDescriptorSet, sizeof(exceptSet));
+            }
+        }
+    }
+
+    while ((errnoLocal == U_SOCK_ENONE) && keepGoing) {
+        // Don't lock the container mutex here, for the same
+        // reasons as dataCallback(): we mustn't be held up by a
+        // blocking receive in progress and the state we need
+        // is protected by gMutexCallbacks
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        errorCodeOrNum = selectCheck(maxDescriptor, readSet, writeSet, exceptSet,
+                                     pReadDescriptorSet, pWriteDescriptorSet,
+                                     pExceptDescriptorSet);
+        if (errorCodeOrNum < 0) {
+            errnoLocal = -errorCodeOrNum;
+        } else if (errorCodeOrNum == 0) {
+            waitMs = timeMs;
+            if (timeMs > 0) {
+                waitMs = timeMs - (uPortGetTickTimeMs() - startTimeMs);
+            }
+            if ((timeMs < 0) || (waitMs > 0)) {
+                // Nothing yet: wait for a data or closed callback;
+                // we are counted as waiting while still holding
+                // gMutexCallbacks so that no callback can be missed
+                gSelectNumWaiting++;
+                uPortMutexUnlock(gMutexCallbacks);
+                if (timeMs < 0) {
+                    uPortSemaphoreTake(gSemaphoreSelect);
+                } else {
+                    uPortSemaphoreTryTake(gSemaphoreSelect, waitMs);
+                }
+                uPortMutexLock(gMutexCallbacks);
+                gSelectNumWaiting--;
+            } else {
+                keepGoing = false;
+            }
+        } else {
+            keepGoing = false;
+        }
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCodeOrNum = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCodeOrNum;
 }
 
 /* ----------------------------------------------------------------
@@ -2761,33 +4708,51 @@ int32_t uSockGetHostByName(uDeviceHandle_t devHandle,
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+    uSockAddress_t address;
+#endif
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
         errnoLocal = U_SOCK_EINVAL;
         // Check parameters
         if ((pHostName != NULL) && (pHostIpAddress != NULL)) {
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+            if (hostCacheGet(devHandle, pHostName, pHostIpAddress)) {
+                errnoLocal = U_SOCK_ENONE;
+            } else
+#endif
+            {
+                U_PORT_MUTEX_LOCK(gMutexContainer);
 
-            U_PORT_MUTEX_LOCK(gMutexContainer);
+                int32_t devType = uDeviceGetDeviceType(devHandle);
 
-            int32_t devType = uDeviceGetDeviceType(devHandle);
+                // Talk to the underlying cell/wifi
+                // socket layer to do the DNS look-up.
+                // uXxxSockGetHostByName() returns a negated
+                // value from the U_SOCK_Exxx list.
+                errnoLocal = U_SOCK_ENOSYS;
+                if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
+                    errnoLocal = -uCellSockGetHostByName(devHandle,
+                                                         pHostName,
+                                                         pHostIpAddress);
+                } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
+                    errnoLocal = -uWifiSockGetHostByName(devHandle,
+                                                         pHostName,
+                                                         pHostIpAddress);
+                }
 
-            // Talk to the underlying cell/wifi
-            // socket layer to do the DNS look-up.
-            // uXxxSockGetHostByName() returns a negated
-            // value from the U_SOCK_Exxx list.
-            errnoLocal = U_SOCK_ENOSYS;
-            if (devType == (int32_t) U_DEVICE_TYPE_CELL) {
-                errnoLocal = -uCellSockGetHostByName(devHandle,
-                                                     pHostName,
-                                                     pHostIpAddress);
-            } else if (devType == (int32_t) U_DEVICE_TYPE_SHORT_RANGE) {
-                errnoLocal = -uWifiSockGetHostByName(devHandle,
-                                                     pHostName,
-                                                     pHostIpAddress);
-            }
+                U_PORT_MUTEX_UNLOCK(gMutexContainer);
 
-            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+                // No point in caching something that is already
+                // an IP address
+                if ((errnoLocal == U_SOCK_ENONE) &&
+                    (uSockStringToAddress(pHostName, &address) != 0)) {
+                    hostCacheAdd(devHandle, pHostName, pHostIpAddress);
+                }
+#endif
+            }
         }
     }
 
@@ -2800,6 +4765,28 @@ int32_t uSockGetHostByName(uDeviceHandle_t devHandle,
     return errorCode;
 }
 
+// Forget the host names remembered by uSockGetHostByName().
+void uSockHostCacheFlush(uDeviceHandle_t devHandle)
+{
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+    // Nothing can have been cached if the mutex is not there
+    if (gMutexHostCache != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutexHostCache);
+
+        for (size_t x = 0; x < sizeof(gHostCache) / sizeof(gHostCache[0]); x++) {
+            if ((devHandle == NULL) || (gHostCache[x].devHandle == devHandle)) {
+                gHostCache[x].devHandle = NULL;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexHostCache);
+    }
+#else
+    (void) devHandle;
+#endif
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: ADDRESS CONVERSION
  * -------------------------------------------------------------- */
@@ -2920,6 +4907,7 @@ char *pUSockDomainRemovePort(char *pDomainString)
 void uSockFree()
 {
     if (gMutexContainer != NULL) {
+        uPerfCountersDeregister(statsPerfCountersSource, NULL);
         uPortMutexDelete(gMutexContainer);
         gMutexContainer = NULL;
     }
@@ -2927,6 +4915,20 @@ void uSockFree()
         uPortMutexDelete(gMutexCallbacks);
         gMutexCallbacks = NULL;
     }
+    if (gMutexTx != NULL) {
+        uPortMutexDelete(gMutexTx);
+        gMutexTx = NULL;
+    }
+#if U_SOCK_HOST_CACHE_NUM_ENTRIES > 0
+    if (gMutexHostCache != NULL) {
+        uPortMutexDelete(gMutexHostCache);
+        gMutexHostCache = NULL;
+    }
+#endif
+    if (gSemaphoreSelect != NULL) {
+        uPortSemaphoreDelete(gSemaphoreSelect);
+        gSemaphoreSelect = NULL;
+    }
 }
 
 // End of file
@@ -193,6 +193,17 @@ U_WEAK int32_t uCellSockWrite(uDeviceHandle_t cellHandle,
     return -U_SOCK_ENOSYS;
 }
 
+U_WEAK int32_t uCellSockWritev(uDeviceHandle_t cellHandle,
+                               int32_t sockHandle,
+                               const uSockIoVec_t *pIoVec, size_t count)
+{
+    (void) cellHandle;
+    (void) sockHandle;
+    (void) pIoVec;
+    (void) count;
+    return -U_SOCK_ENOSYS;
+}
+
 U_WEAK int32_t uCellSockRead(uDeviceHandle_t cellHandle,
                              int32_t sockHandle,
                              void *pData, size_t dataSizeBytes)
@@ -244,6 +255,24 @@ U_WEAK int32_t uCellSockGetLocalAddress(uDeviceHandle_t cellHandle,
     return -U_SOCK_ENOSYS;
 }
 
+U_WEAK int32_t uCellSockDirectLinkEnter(uDeviceHandle_t cellHandle,
+                                        int32_t sockHandle,
+                                        uDeviceSerial_t **ppDeviceSerial)
+{
+    (void) cellHandle;
+    (void) sockHandle;
+    (void) ppDeviceSerial;
+    return -U_SOCK_ENOSYS;
+}
+
+U_WEAK int32_t uCellSockDirectLinkExit(uDeviceHandle_t cellHandle,
+                                       int32_t sockHandle)
+{
+    (void) cellHandle;
+    (void) sockHandle;
+    return -U_SOCK_ENOSYS;
+}
+
 U_WEAK int32_t uCellSockBind(uDeviceHandle_t devHandle,
                              int32_t sockHandle,
                              const uSockAddress_t *pLocalAddress)
@@ -143,6 +143,14 @@
 # define U_SOCK_TEST_MIN_TCP_READ_WRITE_SIZE 128
 #endif
 
+#ifndef U_SOCK_TEST_TCP_SMALL_READ_SIZE_BYTES
+/** The size of read to use when checking that reads which
+ * are smaller than the #U_SOCK_OPT_RCVBUF receive buffer work;
+ * the size of a TLS record header.
+ */
+# define U_SOCK_TEST_TCP_SMALL_READ_SIZE_BYTES 5
+#endif
+
 #ifndef U_SOCK_TEST_NON_BLOCKING_TIME_MS
 /** Expected return time for non-blocking operation
  *in ms during testing.
@@ -754,6 +762,19 @@ static void setBoolCallback(void *pParameter)
     }
 }
 
+// Callback for uSockConnectAsync(): store the result at the
+// passed-in parameter pointer, which must have been set to
+// something other than zero beforehand.
+static void connectCallback(uSockDescriptor_t descriptor,
+                            int32_t errorCode, void *pParameter)
+{
+    (void) descriptor;
+
+    if (pParameter != NULL) {
+        *((volatile int32_t *) pParameter) = errorCode;
+    }
+}
+
 // Callback to send to event queue triggered by
 // data arriving.
 //lint -e{818} Suppress could be const, need to follow
@@ -1110,6 +1131,7 @@ U_PORT_TEST_FUNCTION("[sock]", "sockBasicTcp")
     uSockAddress_t remoteAddress;
     uSockAddress_t address;
     uSockDescriptor_t descriptor;
+    uSockDescriptorSet_t readSet;
     bool dataCallbackCalled;
     bool closedCallbackCalled;
     size_t sizeBytes;
@@ -1156,6 +1178,23 @@ U_PORT_TEST_FUNCTION("[sock]", "sockBasicTcp")
                                               &(remoteAddress.ipAddress)) == 0);
         heapSockInitLoss -= uPortGetHeapFree();
 
+        // A second look-up should come from the cache and give
+        // the same answer, as should one after the cache is flushed
+        for (y = 0; y < 2; y++) {
+            startTimeMs = uPortGetTickTimeMs();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(devHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(address.ipAddress)) == 0);
+            U_TEST_PRINT_LINE("look-up %d took %d ms.", y + 2,
+                              (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+            U_PORT_TEST_ASSERT(address.ipAddress.type == remoteAddress.ipAddress.type);
+            if (address.ipAddress.type == U_SOCK_ADDRESS_TYPE_V4) {
+                U_PORT_TEST_ASSERT(address.ipAddress.address.ipv4 ==
+                                   remoteAddress.ipAddress.address.ipv4);
+            }
+            uSockHostCacheFlush(devHandle);
+        }
+
         // Add the port number we will use
         remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
 
@@ -1247,6 +1286,16 @@ U_PORT_TEST_FUNCTION("[sock]", "sockBasicTcp")
                U_SOCK_TEST_FILL_CHARACTER,
                (sizeof(gSendData) - 1) + (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
         startTimeMs = uPortGetTickTimeMs();
+        if (descriptor < U_SOCK_DESCRIPTOR_SET_SIZE) {
+            // uSockSelect() should say when there is something to read
+            U_TEST_PRINT_LINE("waiting for data with uSockSelect()...");
+            U_SOCK_FD_ZERO(&readSet);
+            U_SOCK_FD_SET(descriptor, &readSet);
+            U_PORT_TEST_ASSERT(uSockSelect(descriptor + 1, &readSet, NULL, NULL, 20000) == 1);
+            U_PORT_TEST_ASSERT(U_SOCK_FD_ISSET(descriptor, &readSet));
+            U_TEST_PRINT_LINE("uSockSelect() returned after %d ms.",
+                              (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+        }
         offset = 0;
         //lint -e{441} Suppress loop variable not found in
         // condition: we're using time instead
@@ -1336,6 +1385,154 @@ U_PORT_TEST_FUNCTION("[sock]", "sockBasicTcp")
     uNetworkTestListFree();
 }
 
+/** Test that, with a #U_SOCK_OPT_RCVBUF receive buffer, many small
+ * reads of a TCP socket, the size of a TLS record header, get back
+ * everything that was sent.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockTcpRxBuffer")
+{
+    uNetworkTestList_t *pList;
+    int32_t errorCode;
+    uDeviceHandle_t devHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor;
+    size_t sizeBytes;
+    size_t offset;
+    int32_t rxBufferSize;
+    int32_t y;
+    char *pDataReceived;
+    int32_t startTimeMs;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    pList = pStdPreamble();
+
+    // Repeat for all bearers
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        devHandle = *pTmp->pDevHandle;
+        // Get the initial-ish heap
+        heapUsed = uPortGetHeapFree();
+
+        U_TEST_PRINT_LINE("doing TCP receive buffer test on %s.",
+                          gpUNetworkTestTypeName[pTmp->networkType]);
+
+        // The first call to a sockets API may need to
+        // initialise the underlying sockets layer; take
+        // account of that initialisation heap cost here.
+        heapSockInitLoss = uPortGetHeapFree();
+        U_PORT_TEST_ASSERT(uSockGetHostByName(devHandle,
+                                              U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                              &(remoteAddress.ipAddress)) == 0);
+        remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+        descriptor = uSockCreate(devHandle, U_SOCK_TYPE_STREAM,
+                                 U_SOCK_PROTOCOL_TCP);
+        heapSockInitLoss -= uPortGetHeapFree();
+        U_PORT_TEST_ASSERT(descriptor >= 0);
+
+        // Give the socket a receive buffer and read it back
+        rxBufferSize = U_SOCK_TEST_MAX_TCP_READ_WRITE_SIZE;
+        U_PORT_TEST_ASSERT(uSockOptionSet(descriptor, U_SOCK_OPT_LEVEL_SOCK,
+                                          U_SOCK_OPT_RCVBUF, &rxBufferSize,
+                                          sizeof(rxBufferSize)) == 0);
+        rxBufferSize = 0;
+        sizeBytes = sizeof(rxBufferSize);
+        U_PORT_TEST_ASSERT(uSockOptionGet(descriptor, U_SOCK_OPT_LEVEL_SOCK,
+                                          U_SOCK_OPT_RCVBUF, &rxBufferSize,
+                                          &sizeBytes) == 0);
+        U_PORT_TEST_ASSERT(sizeBytes == sizeof(rxBufferSize));
+        U_PORT_TEST_ASSERT(rxBufferSize == U_SOCK_TEST_MAX_TCP_READ_WRITE_SIZE);
+
+        // Connections can fail so allow this a few goes
+        errorCode = -1;
+        for (y = 2; (y > 0) && (errorCode < 0); y--) {
+            errorCode = uSockConnect(descriptor, &remoteAddress);
+            if (errorCode < 0) {
+                errno = 0;
+            }
+        }
+        U_PORT_TEST_ASSERT(errorCode == 0);
+
+        // Send everything...
+        offset = 0;
+        while (offset < sizeof(gSendData) - 1) {
+            sizeBytes = (sizeof(gSendData) - 1) - offset;
+            if (sizeBytes > U_SOCK_TEST_MAX_TCP_READ_WRITE_SIZE) {
+                sizeBytes = U_SOCK_TEST_MAX_TCP_READ_WRITE_SIZE;
+            }
+            if (sendTcp(descriptor, gSendData + offset, sizeBytes) == sizeBytes) {
+                offset += sizeBytes;
+            }
+        }
+        U_TEST_PRINT_LINE("%d byte(s) sent via TCP, now receiving in %d byte"
+                          " pieces...", offset, U_SOCK_TEST_TCP_SMALL_READ_SIZE_BYTES);
+
+        // ...and read it back in small pieces, which should
+        // mostly be served from the receive buffer
+        pDataReceived = (char *) pUPortMalloc((sizeof(gSendData) - 1) +
+                                              (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+        U_PORT_TEST_ASSERT(pDataReceived != NULL);
+        //lint -e(668) Suppress possible use of NULL pointer
+        // for pDataReceived
+        memset(pDataReceived,
+               U_SOCK_TEST_FILL_CHARACTER,
+               (sizeof(gSendData) - 1) + (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+        startTimeMs = uPortGetTickTimeMs();
+        offset = 0;
+        while ((offset < sizeof(gSendData) - 1) &&
+               (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+            sizeBytes = (sizeof(gSendData) - 1) - offset;
+            if (sizeBytes > U_SOCK_TEST_TCP_SMALL_READ_SIZE_BYTES) {
+                sizeBytes = U_SOCK_TEST_TCP_SMALL_READ_SIZE_BYTES;
+            }
+            y = uSockRead(descriptor,
+                          pDataReceived + offset +
+                          U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                          sizeBytes);
+            if (y > 0) {
+                U_PORT_TEST_ASSERT(y <= (int32_t) sizeBytes);
+                offset += y;
+            } else {
+                uPortTaskBlock(10);
+            }
+        }
+        U_TEST_PRINT_LINE("%d byte(s) received back after %d ms.", offset,
+                          (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+        U_PORT_TEST_ASSERT(checkAgainstSentData(gSendData,
+                                                sizeof(gSendData) - 1,
+                                                pDataReceived,
+                                                offset));
+
+        U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+        uSockCleanUp();
+        uPortFree(pDataReceived);
+
+        // Check for memory leaks
+        heapUsed -= uPortGetHeapFree();
+        U_TEST_PRINT_LINE("during this part of the test %d byte(s) were"
+                          " lost to sockets initialisation; we have"
+                          " leaked %d byte(s).", heapSockInitLoss,
+                          heapUsed - heapSockInitLoss);
+        U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss);
+    }
+
+    // Remove each network type
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        U_TEST_PRINT_LINE("taking down %s...",
+                          gpUNetworkTestTypeName[pTmp->networkType]);
+        U_PORT_TEST_ASSERT(uNetworkInterfaceDown(*pTmp->pDevHandle,
+                                                 pTmp->networkType) == 0);
+    }
+
+    // To speed things up, do not close the device
+    uNetworkTestListFree();
+}
+
 /** Test maximum number of sockets.
  * Note: this test assumes that all underlying bearers
  * are able to support U_SOCK_MAX_NUM_SOCKETS simultaneously.
@@ -2052,6 +2249,155 @@ U_PORT_TEST_FUNCTION("[sock]", "sockNonBlocking")
     uNetworkTestListFree();
 }
 
+/** Test uSockConnectAsync(), including registering a closed
+ * callback while the connection is in progress.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockConnectAsync")
+{
+    uNetworkTestList_t *pList;
+    int32_t errorCode = -1;
+    uDeviceHandle_t devHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor;
+    uSockDescriptorSet_t writeSet;
+    bool closedCallbackCalled;
+    volatile int32_t connectResult;
+    int32_t connectErrno;
+    size_t length;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    pList = pStdPreamble();
+
+    // Repeat for all bearers
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        devHandle = *pTmp->pDevHandle;
+        // Get the initial-ish heap
+        heapUsed = uPortGetHeapFree();
+
+        U_TEST_PRINT_LINE("doing asynchronous connect test on %s.",
+                          gpUNetworkTestTypeName[pTmp->networkType]);
+        // The first call to a sockets API needs to
+        // initialise the underlying sockets layer; take
+        // account of that initialisation heap cost here.
+        heapSockInitLoss = uPortGetHeapFree();
+        U_PORT_TEST_ASSERT(uSockGetHostByName(devHandle,
+                                              U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                              &(remoteAddress.ipAddress)) == 0);
+        heapSockInitLoss -= uPortGetHeapFree();
+        remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+        heapXxxSockInitLoss += uPortGetHeapFree();
+        descriptor = uSockCreate(devHandle, U_SOCK_TYPE_STREAM,
+                                 U_SOCK_PROTOCOL_TCP);
+        heapXxxSockInitLoss -= uPortGetHeapFree();
+        U_PORT_TEST_ASSERT(descriptor >= 0);
+        U_PORT_TEST_ASSERT(errno == 0);
+
+        // Bad parameters
+        U_PORT_TEST_ASSERT(uSockConnectAsync(descriptor, NULL, NULL, NULL) < 0);
+        U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+        errno = 0;
+        U_PORT_TEST_ASSERT(uSockConnectAsync(-1, &remoteAddress, NULL, NULL) < 0);
+        U_PORT_TEST_ASSERT(errno == U_SOCK_EBADF);
+        errno = 0;
+
+        U_TEST_PRINT_LINE("connect socket to \"%s:%d\" asynchronously...",
+                          U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                          U_SOCK_TEST_ECHO_TCP_SERVER_PORT);
+        // Connections can fail so allow this a few goes
+        for (int32_t y = 2; (y > 0) && (errorCode < 0); y--) {
+            connectResult = 1;
+            // The first asynchronous connect starts a task
+            heapXxxSockInitLoss += uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(uSockConnectAsync(descriptor, &remoteAddress,
+                                                 connectCallback,
+                                                 (void *) &connectResult) == 0);
+            heapXxxSockInitLoss -= uPortGetHeapFree();
+            // While the connection is in progress a second connect
+            // should be refused but a closed callback may be registered
+            if (connectResult == 1) {
+                U_PORT_TEST_ASSERT(uSockConnectAsync(descriptor, &remoteAddress,
+                                                     NULL, NULL) < 0);
+                U_PORT_TEST_ASSERT(errno == U_SOCK_EALREADY);
+                errno = 0;
+            }
+            closedCallbackCalled = false;
+            uSockRegisterCallbackClosed(descriptor, setBoolCallback,
+                                        &closedCallbackCalled);
+            // Wait for the socket to become writable
+            U_SOCK_FD_ZERO(&writeSet);
+            U_SOCK_FD_SET(descriptor, &writeSet);
+            U_PORT_TEST_ASSERT(uSockSelect(descriptor + 1, NULL, &writeSet,
+                                           NULL, 60000) == 1);
+            // The callback may run just after the select returns
+            for (size_t z = 0; (z < 10) && (connectResult == 1); z++) {
+                uPortTaskBlock(100);
+            }
+            errorCode = connectResult;
+            U_TEST_PRINT_LINE("uSockConnectAsync() completed with %d.",
+                              errorCode);
+            if (errorCode < 0) {
+                // The errno should be available, once, as an option
+                length = sizeof(connectErrno);
+                U_PORT_TEST_ASSERT(uSockOptionGet(descriptor,
+                                                  U_SOCK_OPT_LEVEL_SOCK,
+                                                  U_SOCK_OPT_ERROR,
+                                                  (void *) &connectErrno,
+                                                  &length) == 0);
+                U_PORT_TEST_ASSERT(connectErrno == -errorCode);
+            }
+        }
+        U_PORT_TEST_ASSERT(errorCode == 0);
+        U_PORT_TEST_ASSERT(!closedCallbackCalled);
+
+        // The socket should now work
+        U_PORT_TEST_ASSERT(sendTcp(descriptor, gSendData,
+                                   U_SOCK_TEST_MIN_TCP_READ_WRITE_SIZE) ==
+                           U_SOCK_TEST_MIN_TCP_READ_WRITE_SIZE);
+
+        // Close the socket: the closed callback registered while
+        // the connection was in progress should be called
+        U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+        U_TEST_PRINT_LINE("waiting up to %d second(s) for TCP socket to"
+                          " close...", U_SOCK_TEST_TCP_CLOSE_SECONDS);
+        for (size_t y = 0; (y < U_SOCK_TEST_TCP_CLOSE_SECONDS) &&
+             !closedCallbackCalled; y++) {
+            uPortTaskBlock(1000);
+        }
+        U_PORT_TEST_ASSERT(closedCallbackCalled);
+        uSockCleanUp();
+
+        // Check for memory leaks
+        heapUsed -= uPortGetHeapFree();
+        U_TEST_PRINT_LINE("during this part of the test %d byte(s) were"
+                          " lost to sockets initialisation; we have"
+                          " leaked %d byte(s).",
+                          heapSockInitLoss + heapXxxSockInitLoss,
+                          heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+        U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        errorCode = -1;
+    }
+
+    // Remove each network type
+    for (uNetworkTestList_t *pTmp = pList; pTmp != NULL; pTmp = pTmp->pNext) {
+        U_TEST_PRINT_LINE("taking down %s...",
+                          gpUNetworkTestTypeName[pTmp->networkType]);
+        U_PORT_TEST_ASSERT(uNetworkInterfaceDown(*pTmp->pDevHandle,
+                                                 pTmp->networkType) == 0);
+    }
+
+    // To speed things up, do not close the device
+    uNetworkTestListFree();
+}
+
 /** UDP echo test that throws up multiple packets
  * before addressing the received packets.
  */
@@ -22,6 +22,8 @@
  * of another module should be included here; otherwise
  * please keep #includes to your .c files. */
 
+#include "u_spartn_crc.h"
+
 /** \addtogroup __spartn __SPARTN
  *  @{
  */
@@ -56,10 +58,32 @@ extern "C" {
  */
 #define U_SPARTN_MESSAGE_LENGTH_MAX_BYTES (4 + 8 + 1024 + 64 + 4)
 
+/** The maximum size of a SPARTN message header, FRAME START plus
+ * PAYLOAD DESCRIPTION.
+ */
+#define U_SPARTN_HEADER_LENGTH_MAX_BYTES (4 + 8)
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The context of an incremental SPARTN message detector, see
+ * uSpartnDetectorFeed(); the contents are private, initialise it
+ * with uSpartnDetectorInit().
+ */
+typedef struct {
+    char header[U_SPARTN_HEADER_LENGTH_MAX_BYTES]; /**< the start of what might be
+                                                        a message, not yet decided. */
+    size_t headerLength;           /**< the number of bytes in header. */
+    size_t messageLength;          /**< the length of the message in progress,
+                                        zero if there isn't one. */
+    size_t messageCount;           /**< how much of that message has been seen. */
+    size_t crcOffset;              /**< the offset of its message CRC. */
+    uSpartnCrcType_t crcType;
+    uint32_t crcRemainder;         /**< the message CRC so far. */
+    uint32_t crcFromMessage;       /**< the message CRC as received so far. */
+} uSpartnDetector_t;
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -145,6 +169,70 @@ int32_t uSpartnDetect(const char *pBuffer, size_t bufferLengthBytes,
 int32_t uSpartnValidate(const char *pBuffer, size_t bufferLengthBytes,
                         const char **ppMessage);
 
+/** Initialise an incremental SPARTN message detector, or reset one,
+ * forgetting any message in progress.
+ *
+ * @param[out] pDetector  a pointer to the detector; cannot be NULL.
+ */
+void uSpartnDetectorInit(uSpartnDetector_t *pDetector);
+
+/** Pass the next chunk of a stream of data to an incremental SPARTN
+ * message detector.  Unlike uSpartnValidate(), which needs the whole
+ * of a message in one buffer, the detector keeps the state of a
+ * message that is in progress, running its message CRC as the data
+ * arrives, so that chunks of any size may be passed in, each byte
+ * being looked at only once, and messages may straddle chunks.
+ *
+ * The detector stops at the end of each valid message: the caller
+ * should call this function again with what is left of the chunk,
+ * for instance:
+ *
+ * ```
+ * size_t used;
+ * int32_t offset;
+ *
+ * while (size > 0) {
+ *     x = uSpartnDetectorFeed(&detector, pData, size, &used, &offset);
+ *     if (x > 0) {
+ *         // A message of length x ended at pData + used; it began at
+ *         // pData + offset which, if offset is negative, was in
+ *         // a previous chunk
+ *     }
+ *     pData += used;
+ *     size -= used;
+ * }
+ * ```
+ *
+ * A message that fails its message CRC check is skipped as a whole,
+ * just as if it were not there: the detector does not look for
+ * messages inside it since the data is gone.
+ *
+ * @param[in] pDetector     a pointer to the detector, initialised
+ *                          with uSpartnDetectorInit(); cannot be NULL.
+ * @param[in] pBuffer       a pointer to the next chunk of data; may
+ *                          only be NULL if bufferLengthBytes is zero.
+ * @param bufferLengthBytes the amount of data at pBuffer.
+ * @param[out] pUsed        a place to put the number of bytes of pBuffer
+ *                          that were used: all of them unless a valid
+ *                          message ended within them; cannot be NULL.
+ * @param[out] pOffset      a place to put the offset of the start of
+ *                          the message from pBuffer, negative if the
+ *                          message began in a previous chunk; written
+ *                          if the return value is a length or
+ *                          #U_ERROR_COMMON_TIMEOUT, may be NULL.
+ * @return                  the length of a valid SPARTN message, TF001
+ *                          to TF018, that ended within the bytes used,
+ *                          else negative error code:
+ *                          #U_ERROR_COMMON_TIMEOUT if all of pBuffer
+ *                          was used and a message may be in progress,
+ *                          in which case pOffset gives its start so
+ *                          far, #U_ERROR_COMMON_NOT_FOUND if there is
+ *                          no message in progress.
+ */
+int32_t uSpartnDetectorFeed(uSpartnDetector_t *pDetector,
+                            const char *pBuffer, size_t bufferLengthBytes,
+                            size_t *pUsed, int32_t *pOffset);
+
 #ifdef __cplusplus
 }
 #endif
@@ -41,6 +41,24 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_SPARTN_CRC_SLICE_BY
+/** The number of bytes that CRC-24 and CRC-32 process per step:
+ * 1, the byte-wise table, which costs 1 kbyte of constant data for
+ * each, or 4 or 8, "slice-by-4" or "slice-by-8", which are around
+ * two and four times faster at a cost of 4 or 8 kbytes of constant
+ * data for each.
+ */
+# define U_SPARTN_CRC_SLICE_BY 1
+#endif
+
+/* U_SPARTN_CRC_HW: if this is defined at build time then the
+ * message CRCs CRC-8, CRC-16 and CRC-32 are handed to the functions
+ * uSpartnCrcHw8(), uSpartnCrcHw16() and uSpartnCrcHw32(), which the
+ * platform must provide, e.g. using a CRC peripheral or the CRC
+ * functions in ROM; there is an implementation for ESP-IDF.  CRC-4
+ * and CRC-24 are always done in software.
+ */
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -110,6 +128,74 @@ uint32_t uSpartnCrc24(const char *pData, size_t size);
  */
 uint32_t uSpartnCrc32(const char *pData, size_t size);
 
+/** Start a message CRC calculation on data that arrives in pieces;
+ * pass each piece to uSpartnCrcUpdate() and the result to
+ * uSpartnCrcFinish().  The outcome is the same as that of
+ * uSpartnCrc8(), uSpartnCrc16(), uSpartnCrc24() or uSpartnCrc32()
+ * on all of the data at once.
+ *
+ * @param crcType  the message CRC type, #U_SPARTN_CRC_TYPE_8 to
+ *                 #U_SPARTN_CRC_TYPE_32.
+ * @return         the initial remainder.
+ */
+uint32_t uSpartnCrcStart(uSpartnCrcType_t crcType);
+
+/** Continue a message CRC calculation started with uSpartnCrcStart().
+ *
+ * @param crcType    the message CRC type.
+ * @param remainder  the remainder returned by uSpartnCrcStart() or
+ *                   by the previous call to this function.
+ * @param pData      a pointer to the next piece of data.
+ * @param size       the number of bytes pointed to by pData.
+ * @return           the new remainder.
+ */
+uint32_t uSpartnCrcUpdate(uSpartnCrcType_t crcType, uint32_t remainder,
+                          const char *pData, size_t size);
+
+/** Finish a message CRC calculation started with uSpartnCrcStart().
+ *
+ * @param crcType    the message CRC type.
+ * @param remainder  the remainder returned by the last call to
+ *                   uSpartnCrcUpdate().
+ * @return           the CRC.
+ */
+uint32_t uSpartnCrcFinish(uSpartnCrcType_t crcType, uint32_t remainder);
+
+#ifdef U_SPARTN_CRC_HW
+
+/** Continue an MSB-first, non-reflected, CRC-8 calculation with
+ * polynomial 0x07 in hardware; only required if U_SPARTN_CRC_HW is
+ * defined, in which case it MUST be provided by the platform.  No
+ * initial value or final XOR is applied, the remainder is simply
+ * continued.
+ *
+ * @param remainder  the remainder so far.
+ * @param pData      a pointer to the data.
+ * @param size       the number of bytes pointed to by pData.
+ * @return           the new remainder.
+ */
+uint8_t uSpartnCrcHw8(uint8_t remainder, const char *pData, size_t size);
+
+/** As uSpartnCrcHw8() but for CRC-16 with polynomial 0x1021.
+ *
+ * @param remainder  the remainder so far.
+ * @param pData      a pointer to the data.
+ * @param size       the number of bytes pointed to by pData.
+ * @return           the new remainder.
+ */
+uint16_t uSpartnCrcHw16(uint16_t remainder, const char *pData, size_t size);
+
+/** As uSpartnCrcHw8() but for CRC-32 with polynomial 0x04C11DB7.
+ *
+ * @param remainder  the remainder so far.
+ * @param pData      a pointer to the data.
+ * @param size       the number of bytes pointed to by pData.
+ * @return           the new remainder.
+ */
+uint32_t uSpartnCrcHw32(uint32_t remainder, const char *pData, size_t size);
+
+#endif // #ifdef U_SPARTN_CRC_HW
+
 #ifdef __cplusplus
 }
 #endif
@@ -93,7 +93,7 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
-#include "string.h"    // memcpy()
+#include "string.h"    // memcpy(), memmove(), memchr(), memset()
 
 #include "u_error_common.h"
 
@@ -110,6 +110,10 @@
  */
 #define U_SPARTN_HEADER_LENGTH_MIN_BYTES (4 + 4)
 
+/** The SPARTN preamble, TF001.
+ */
+#define U_SPARTN_PREAMBLE 0x73
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -142,7 +146,7 @@ static int32_t decodeHeader(const char *pBuffer, size_t bufferLengthBytes,
         sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
         while ((sizeOrErrorCode < 0) && (sizeOrErrorCode != (int32_t) U_ERROR_COMMON_TIMEOUT) &&
                (bufferLengthBytes > 0)) {
-            if (*pInput == 0x73) {
+            if (*pInput == U_SPARTN_PREAMBLE) {
                 // Potentially a FRAME START
                 sizeOrErrorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
                 pMessage = pInput;
@@ -276,6 +280,109 @@ static int32_t decodeHeader(const char *pBuffer, size_t bufferLengthBytes,
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Throw away the first skip bytes in the header buffer of a
+// detector and then anything up to the next preamble.
+static void detectorResync(uSpartnDetector_t *pDetector, size_t skip)
+{
+    const char *pPreamble = NULL;
+    size_t length = pDetector->headerLength;
+
+    if (skip < pDetector->headerLength) {
+        pPreamble = (const char *) memchr(pDetector->header + skip, U_SPARTN_PREAMBLE,
+                                          pDetector->headerLength - skip);
+    }
+    if (pPreamble != NULL) {
+        length = pPreamble - pDetector->header;
+    }
+    memmove(pDetector->header, pDetector->header + length,
+            pDetector->headerLength - length);
+    pDetector->headerLength -= length;
+}
+
+// Pass bytes of a message whose length is known to a detector, running
+// the message CRC over them; returns how many were taken, fewer than
+// size if the message ends within them.
+static size_t detectorBody(uSpartnDetector_t *pDetector,
+                           const char *pData, size_t size)
+{
+    size_t length = pDetector->messageLength - pDetector->messageCount;
+    size_t crcStart = 0;
+    size_t crcEnd = 0;
+
+    if (length > size) {
+        length = size;
+    }
+    // The message CRC is over all of the message except the
+    // first byte, up to the start of the CRC
+    if (pDetector->messageCount == 0) {
+        crcStart = 1;
+    }
+    if (pDetector->messageCount < pDetector->crcOffset) {
+        crcEnd = pDetector->crcOffset - pDetector->messageCount;
+        if (crcEnd > length) {
+            crcEnd = length;
+        }
+    }
+    if (crcEnd > crcStart) {
+        pDetector->crcRemainder = uSpartnCrcUpdate(pDetector->crcType,
+                                                   pDetector->crcRemainder,
+                                                   pData + crcStart,
+                                                   crcEnd - crcStart);
+    }
+    // Anything after that is the CRC itself, MSB first
+    for (size_t x = crcEnd; x < length; x++) {
+        pDetector->crcFromMessage = (pDetector->crcFromMessage << 8) |
+                                    (uint8_t) * (pData + x);
+    }
+    pDetector->messageCount += length;
+
+    return length;
+}
+
+// Decide on what might be a message header in the header buffer of a
+// detector, stopping when more data is needed or when the message
+// length is known, in which case the header bytes are passed on to
+// detectorBody(); returns the number of bytes left in the header buffer
+// if the message turned out to end within it, which can happen after
+// a false preamble, else zero.
+static size_t detectorHeader(uSpartnDetector_t *pDetector)
+{
+    size_t leftover = 0;
+    bool needMoreData = false;
+    int32_t sizeOrErrorCode;
+    const char *pMessage = NULL;
+    const char *pMessageCrcStart = NULL;
+    uSpartnCrcType_t messageCrcType = U_SPARTN_CRC_TYPE_NONE;
+    size_t length;
+
+    while ((pDetector->headerLength > 0) && (pDetector->messageLength == 0) &&
+           !needMoreData) {
+        sizeOrErrorCode = decodeHeader(pDetector->header, pDetector->headerLength,
+                                       &pMessage, &pMessageCrcStart, &messageCrcType);
+        if ((sizeOrErrorCode > 0) && (pMessage == pDetector->header)) {
+            // Got a header, and hence the length of the message
+            pDetector->messageLength = sizeOrErrorCode;
+            pDetector->messageCount = 0;
+            pDetector->crcOffset = pMessageCrcStart - pMessage;
+            pDetector->crcType = messageCrcType;
+            pDetector->crcRemainder = uSpartnCrcStart(messageCrcType);
+            pDetector->crcFromMessage = 0;
+            length = detectorBody(pDetector, pDetector->header, pDetector->headerLength);
+            leftover = pDetector->headerLength - length;
+            memmove(pDetector->header, pDetector->header + length, leftover);
+            pDetector->headerLength = leftover;
+        } else if ((sizeOrErrorCode == (int32_t) U_ERROR_COMMON_TIMEOUT) &&
+                   (pDetector->headerLength < U_SPARTN_HEADER_LENGTH_MAX_BYTES)) {
+            needMoreData = true;
+        } else {
+            // Not a header, try the next preamble, if there is one
+            detectorResync(pDetector, 1);
+        }
+    }
+
+    return leftover;
+}
+
 // Look for a SPARTN message header in a buffer.
 int32_t uSpartnDetect(const char *pBuffer, size_t bufferLengthBytes,
                       const char **ppMessage)
@@ -352,4 +459,91 @@ int32_t uSpartnValidate(const char *pBuffer, size_t bufferLengthBytes,
     return sizeOrErrorCode;
 }
 
+// Initialise an incremental SPARTN message detector.
+void uSpartnDetectorInit(uSpartnDetector_t *pDetector)
+{
+    if (pDetector != NULL) {
+        memset(pDetector, 0, sizeof(*pDetector));
+        pDetector->crcType = U_SPARTN_CRC_TYPE_NONE;
+    }
+}
+
+// Pass the next chunk of a stream to an incremental SPARTN detector.
+int32_t uSpartnDetectorFeed(uSpartnDetector_t *pDetector,
+                            const char *pBuffer, size_t bufferLengthBytes,
+                            size_t *pUsed, int32_t *pOffset)
+{
+    int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    const char *pPreamble;
+    size_t used = 0;
+    size_t leftover = 0;
+    size_t length;
+    int32_t offset = 0;
+
+    if ((pDetector != NULL) && ((pBuffer != NULL) || (bufferLengthBytes == 0)) &&
+        (pUsed != NULL)) {
+        sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+        while ((sizeOrErrorCode == (int32_t) U_ERROR_COMMON_NOT_FOUND) &&
+               (used < bufferLengthBytes)) {
+            leftover = 0;
+            if (pDetector->messageLength > 0) {
+                // In the body of a message
+                used += detectorBody(pDetector, pBuffer + used, bufferLengthBytes - used);
+            } else if (pDetector->headerLength > 0) {
+                // In what might be a header: add the minimum header length
+                // in one go, beyond that one byte at a time since the
+                // message might be shorter than the header buffer
+                length = 1;
+                if (pDetector->headerLength < U_SPARTN_HEADER_LENGTH_MIN_BYTES) {
+                    length = U_SPARTN_HEADER_LENGTH_MIN_BYTES - pDetector->headerLength;
+                }
+                if (length > bufferLengthBytes - used) {
+                    length = bufferLengthBytes - used;
+                }
+                memcpy(pDetector->header + pDetector->headerLength, pBuffer + used, length);
+                pDetector->headerLength += length;
+                used += length;
+                leftover = detectorHeader(pDetector);
+            } else {
+                // Hunting for a preamble
+                pPreamble = (const char *) memchr(pBuffer + used, U_SPARTN_PREAMBLE,
+                                                  bufferLengthBytes - used);
+                used = bufferLengthBytes;
+                if (pPreamble != NULL) {
+                    pDetector->header[0] = *pPreamble;
+                    pDetector->headerLength = 1;
+                    used = pPreamble - pBuffer + 1;
+                }
+            }
+            if ((pDetector->messageLength > 0) &&
+                (pDetector->messageCount == pDetector->messageLength)) {
+                // End of a message: check its CRC
+                if (uSpartnCrcFinish(pDetector->crcType,
+                                     pDetector->crcRemainder) == pDetector->crcFromMessage) {
+                    sizeOrErrorCode = (int32_t) pDetector->messageLength;
+                    offset = (int32_t) used - (int32_t) leftover -
+                             (int32_t) pDetector->messageLength;
+                }
+                pDetector->messageLength = 0;
+                // Anything left in the header buffer is looked at afresh
+                detectorResync(pDetector, 0);
+            }
+        }
+        if ((sizeOrErrorCode == (int32_t) U_ERROR_COMMON_NOT_FOUND) &&
+            ((pDetector->messageLength > 0) || (pDetector->headerLength > 0))) {
+            sizeOrErrorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+            offset = (int32_t) used - (int32_t) pDetector->headerLength;
+            if (pDetector->messageLength > 0) {
+                offset = (int32_t) used - (int32_t) pDetector->messageCount;
+            }
+        }
+        if ((pOffset != NULL) && (sizeOrErrorCode != (int32_t) U_ERROR_COMMON_NOT_FOUND)) {
+            *pOffset = offset;
+        }
+        *pUsed = used;
+    }
+
+    return sizeOrErrorCode;
+}
+
 // End of file
@@ -39,6 +39,11 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#if (U_SPARTN_CRC_SLICE_BY != 1) && (U_SPARTN_CRC_SLICE_BY != 4) && \
+    (U_SPARTN_CRC_SLICE_BY != 8)
+# error U_SPARTN_CRC_SLICE_BY must be 1, 4 or 8
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -82,6 +87,8 @@ static const uint8_t u8Crc4Table[] = {
     0x02U, 0x09U, 0x07U, 0x0CU, 0x08U, 0x03U, 0x0DU, 0x06U
 };
 
+#ifndef U_SPARTN_CRC_HW
+
 static const uint8_t u8Crc8Table[] = {
     0x00U, 0x07U, 0x0EU, 0x09U, 0x1CU, 0x1BU, 0x12U, 0x15U,
     0x38U, 0x3FU, 0x36U, 0x31U, 0x24U, 0x23U, 0x2AU, 0x2DU,
@@ -152,6 +159,8 @@ static const uint16_t u16Crc16Table[] = {
     0x6E17U, 0x7E36U, 0x4E55U, 0x5E74U, 0x2E93U, 0x3EB2U, 0x0ED1U, 0x1EF0U
 };
 
+#endif // #ifndef U_SPARTN_CRC_HW
+
 static const uint32_t u32Crc24Table[] = {
     0x00000000U, 0x00864CFBU, 0x008AD50DU, 0x000C99F6U, 0x0093E6E1U, 0x0015AA1AU, 0x001933ECU, 0x009F7F17U,
     0x00A18139U, 0x0027CDC2U, 0x002B5434U, 0x00AD18CFU, 0x003267D8U, 0x00B42B23U, 0x00B8B2D5U, 0x003EFE2EU,
@@ -187,6 +196,8 @@ static const uint32_t u32Crc24Table[] = {
     0x0042FA2FU, 0x00C4B6D4U, 0x00C82F22U, 0x004E63D9U, 0x00D11CCEU, 0x00575035U, 0x005BC9C3U, 0x00DD8538U
 };
 
+#ifndef U_SPARTN_CRC_HW
+
 static const uint32_t u32Crc32Table[] = {
     0x00000000U, 0x04C11DB7U, 0x09823B6EU, 0x0D4326D9U, 0x130476DCU, 0x17C56B6BU, 0x1A864DB2U, 0x1E475005U,
     0x2608EDB8U, 0x22C9F00FU, 0x2F8AD6D6U, 0x2B4BCB61U, 0x350C9B64U, 0x31CD86D3U, 0x3C8EA00AU, 0x384FBDBDU,
@@ -222,39 +233,567 @@ static const uint32_t u32Crc32Table[] = {
     0xAFB010B1U, 0xAB710D06U, 0xA6322BDFU, 0xA2F33668U, 0xBCB4666DU, 0xB8757BDAU, 0xB5365D03U, 0xB1F740B4U
 };
 
+#if U_SPARTN_CRC_SLICE_BY > 1
+
+/** Tables 1 to (#U_SPARTN_CRC_SLICE_BY - 1) for slicing CRC-32;
+ * table 0 is u32Crc32Table.
+ */
+static const uint32_t u32Crc32SliceTable[U_SPARTN_CRC_SLICE_BY - 1][256] = {
+    {
+        0x00000000U, 0xD219C1DCU, 0xA0F29E0FU, 0x72EB5FD3U, 0x452421A9U, 0x973DE075U, 0xE5D6BFA6U, 0x37CF7E7AU,
+        0x8A484352U, 0x5851828EU, 0x2ABADD5DU, 0xF8A31C81U, 0xCF6C62FBU, 0x1D75A327U, 0x6F9EFCF4U, 0xBD873D28U,
+        0x10519B13U, 0xC2485ACFU, 0xB0A3051CU, 0x62BAC4C0U, 0x5575BABAU, 0x876C7B66U, 0xF58724B5U, 0x279EE569U,
+        0x9A19D841U, 0x4800199DU, 0x3AEB464EU, 0xE8F28792U, 0xDF3DF9E8U, 0x0D243834U, 0x7FCF67E7U, 0xADD6A63BU,
+        0x20A33626U, 0xF2BAF7FAU, 0x8051A829U, 0x524869F5U, 0x6587178FU, 0xB79ED653U, 0xC5758980U, 0x176C485CU,
+        0xAAEB7574U, 0x78F2B4A8U, 0x0A19EB7BU, 0xD8002AA7U, 0xEFCF54DDU, 0x3DD69501U, 0x4F3DCAD2U, 0x9D240B0EU,
+        0x30F2AD35U, 0xE2EB6CE9U, 0x9000333AU, 0x4219F2E6U, 0x75D68C9CU, 0xA7CF4D40U, 0xD5241293U, 0x073DD34FU,
+        0xBABAEE67U, 0x68A32FBBU, 0x1A487068U, 0xC851B1B4U, 0xFF9ECFCEU, 0x2D870E12U, 0x5F6C51C1U, 0x8D75901DU,
+        0x41466C4CU, 0x935FAD90U, 0xE1B4F243U, 0x33AD339FU, 0x04624DE5U, 0xD67B8C39U, 0xA490D3EAU, 0x76891236U,
+        0xCB0E2F1EU, 0x1917EEC2U, 0x6BFCB111U, 0xB9E570CDU, 0x8E2A0EB7U, 0x5C33CF6BU, 0x2ED890B8U, 0xFCC15164U,
+        0x5117F75FU, 0x830E3683U, 0xF1E56950U, 0x23FCA88CU, 0x1433D6F6U, 0xC62A172AU, 0xB4C148F9U, 0x66D88925U,
+        0xDB5FB40DU, 0x094675D1U, 0x7BAD2A02U, 0xA9B4EBDEU, 0x9E7B95A4U, 0x4C625478U, 0x3E890BABU, 0xEC90CA77U,
+        0x61E55A6AU, 0xB3FC9BB6U, 0xC117C465U, 0x130E05B9U, 0x24C17BC3U, 0xF6D8BA1FU, 0x8433E5CCU, 0x562A2410U,
+        0xEBAD1938U, 0x39B4D8E4U, 0x4B5F8737U, 0x994646EBU, 0xAE893891U, 0x7C90F94DU, 0x0E7BA69EU, 0xDC626742U,
+        0x71B4C179U, 0xA3AD00A5U, 0xD1465F76U, 0x035F9EAAU, 0x3490E0D0U, 0xE689210CU, 0x94627EDFU, 0x467BBF03U,
+        0xFBFC822BU, 0x29E543F7U, 0x5B0E1C24U, 0x8917DDF8U, 0xBED8A382U, 0x6CC1625EU, 0x1E2A3D8DU, 0xCC33FC51U,
+        0x828CD898U, 0x50951944U, 0x227E4697U, 0xF067874BU, 0xC7A8F931U, 0x15B138EDU, 0x675A673EU, 0xB543A6E2U,
+        0x08C49BCAU, 0xDADD5A16U, 0xA83605C5U, 0x7A2FC419U, 0x4DE0BA63U, 0x9FF97BBFU, 0xED12246CU, 0x3F0BE5B0U,
+        0x92DD438BU, 0x40C48257U, 0x322FDD84U, 0xE0361C58U, 0xD7F96222U, 0x05E0A3FEU, 0x770BFC2DU, 0xA5123DF1U,
+        0x189500D9U, 0xCA8CC105U, 0xB8679ED6U, 0x6A7E5F0AU, 0x5DB12170U, 0x8FA8E0ACU, 0xFD43BF7FU, 0x2F5A7EA3U,
+        0xA22FEEBEU, 0x70362F62U, 0x02DD70B1U, 0xD0C4B16DU, 0xE70BCF17U, 0x35120ECBU, 0x47F95118U, 0x95E090C4U,
+        0x2867ADECU, 0xFA7E6C30U, 0x889533E3U, 0x5A8CF23FU, 0x6D438C45U, 0xBF5A4D99U, 0xCDB1124AU, 0x1FA8D396U,
+        0xB27E75ADU, 0x6067B471U, 0x128CEBA2U, 0xC0952A7EU, 0xF75A5404U, 0x254395D8U, 0x57A8CA0BU, 0x85B10BD7U,
+        0x383636FFU, 0xEA2FF723U, 0x98C4A8F0U, 0x4ADD692CU, 0x7D121756U, 0xAF0BD68AU, 0xDDE08959U, 0x0FF94885U,
+        0xC3CAB4D4U, 0x11D37508U, 0x63382ADBU, 0xB121EB07U, 0x86EE957DU, 0x54F754A1U, 0x261C0B72U, 0xF405CAAEU,
+        0x4982F786U, 0x9B9B365AU, 0xE9706989U, 0x3B69A855U, 0x0CA6D62FU, 0xDEBF17F3U, 0xAC544820U, 0x7E4D89FCU,
+        0xD39B2FC7U, 0x0182EE1BU, 0x7369B1C8U, 0xA1707014U, 0x96BF0E6EU, 0x44A6CFB2U, 0x364D9061U, 0xE45451BDU,
+        0x59D36C95U, 0x8BCAAD49U, 0xF921F29AU, 0x2B383346U, 0x1CF74D3CU, 0xCEEE8CE0U, 0xBC05D333U, 0x6E1C12EFU,
+        0xE36982F2U, 0x3170432EU, 0x439B1CFDU, 0x9182DD21U, 0xA64DA35BU, 0x74546287U, 0x06BF3D54U, 0xD4A6FC88U,
+        0x6921C1A0U, 0xBB38007CU, 0xC9D35FAFU, 0x1BCA9E73U, 0x2C05E009U, 0xFE1C21D5U, 0x8CF77E06U, 0x5EEEBFDAU,
+        0xF33819E1U, 0x2121D83DU, 0x53CA87EEU, 0x81D34632U, 0xB61C3848U, 0x6405F994U, 0x16EEA647U, 0xC4F7679BU,
+        0x79705AB3U, 0xAB699B6FU, 0xD982C4BCU, 0x0B9B0560U, 0x3C547B1AU, 0xEE4DBAC6U, 0x9CA6E515U, 0x4EBF24C9U
+    },
+    {
+        0x00000000U, 0x01D8AC87U, 0x03B1590EU, 0x0269F589U, 0x0762B21CU, 0x06BA1E9BU, 0x04D3EB12U, 0x050B4795U,
+        0x0EC56438U, 0x0F1DC8BFU, 0x0D743D36U, 0x0CAC91B1U, 0x09A7D624U, 0x087F7AA3U, 0x0A168F2AU, 0x0BCE23ADU,
+        0x1D8AC870U, 0x1C5264F7U, 0x1E3B917EU, 0x1FE33DF9U, 0x1AE87A6CU, 0x1B30D6EBU, 0x19592362U, 0x18818FE5U,
+        0x134FAC48U, 0x129700CFU, 0x10FEF546U, 0x112659C1U, 0x142D1E54U, 0x15F5B2D3U, 0x179C475AU, 0x1644EBDDU,
+        0x3B1590E0U, 0x3ACD3C67U, 0x38A4C9EEU, 0x397C6569U, 0x3C7722FCU, 0x3DAF8E7BU, 0x3FC67BF2U, 0x3E1ED775U,
+        0x35D0F4D8U, 0x3408585FU, 0x3661ADD6U, 0x37B90151U, 0x32B246C4U, 0x336AEA43U, 0x31031FCAU, 0x30DBB34DU,
+        0x269F5890U, 0x2747F417U, 0x252E019EU, 0x24F6AD19U, 0x21FDEA8CU, 0x2025460BU, 0x224CB382U, 0x23941F05U,
+        0x285A3CA8U, 0x2982902FU, 0x2BEB65A6U, 0x2A33C921U, 0x2F388EB4U, 0x2EE02233U, 0x2C89D7BAU, 0x2D517B3DU,
+        0x762B21C0U, 0x77F38D47U, 0x759A78CEU, 0x7442D449U, 0x714993DCU, 0x70913F5BU, 0x72F8CAD2U, 0x73206655U,
+        0x78EE45F8U, 0x7936E97FU, 0x7B5F1CF6U, 0x7A87B071U, 0x7F8CF7E4U, 0x7E545B63U, 0x7C3DAEEAU, 0x7DE5026DU,
+        0x6BA1E9B0U, 0x6A794537U, 0x6810B0BEU, 0x69C81C39U, 0x6CC35BACU, 0x6D1BF72BU, 0x6F7202A2U, 0x6EAAAE25U,
+        0x65648D88U, 0x64BC210FU, 0x66D5D486U, 0x670D7801U, 0x62063F94U, 0x63DE9313U, 0x61B7669AU, 0x606FCA1DU,
+        0x4D3EB120U, 0x4CE61DA7U, 0x4E8FE82EU, 0x4F5744A9U, 0x4A5C033CU, 0x4B84AFBBU, 0x49ED5A32U, 0x4835F6B5U,
+        0x43FBD518U, 0x4223799FU, 0x404A8C16U, 0x41922091U, 0x44996704U, 0x4541CB83U, 0x47283E0AU, 0x46F0928DU,
+        0x50B47950U, 0x516CD5D7U, 0x5305205EU, 0x52DD8CD9U, 0x57D6CB4CU, 0x560E67CBU, 0x54679242U, 0x55BF3EC5U,
+        0x5E711D68U, 0x5FA9B1EFU, 0x5DC04466U, 0x5C18E8E1U, 0x5913AF74U, 0x58CB03F3U, 0x5AA2F67AU, 0x5B7A5AFDU,
+        0xEC564380U, 0xED8EEF07U, 0xEFE71A8EU, 0xEE3FB609U, 0xEB34F19CU, 0xEAEC5D1BU, 0xE885A892U, 0xE95D0415U,
+        0xE29327B8U, 0xE34B8B3FU, 0xE1227EB6U, 0xE0FAD231U, 0xE5F195A4U, 0xE4293923U, 0xE640CCAAU, 0xE798602DU,
+        0xF1DC8BF0U, 0xF0042777U, 0xF26DD2FEU, 0xF3B57E79U, 0xF6BE39ECU, 0xF766956BU, 0xF50F60E2U, 0xF4D7CC65U,
+        0xFF19EFC8U, 0xFEC1434FU, 0xFCA8B6C6U, 0xFD701A41U, 0xF87B5DD4U, 0xF9A3F153U, 0xFBCA04DAU, 0xFA12A85DU,
+        0xD743D360U, 0xD69B7FE7U, 0xD4F28A6EU, 0xD52A26E9U, 0xD021617CU, 0xD1F9CDFBU, 0xD3903872U, 0xD24894F5U,
+        0xD986B758U, 0xD85E1BDFU, 0xDA37EE56U, 0xDBEF42D1U, 0xDEE40544U, 0xDF3CA9C3U, 0xDD555C4AU, 0xDC8DF0CDU,
+        0xCAC91B10U, 0xCB11B797U, 0xC978421EU, 0xC8A0EE99U, 0xCDABA90CU, 0xCC73058BU, 0xCE1AF002U, 0xCFC25C85U,
+        0xC40C7F28U, 0xC5D4D3AFU, 0xC7BD2626U, 0xC6658AA1U, 0xC36ECD34U, 0xC2B661B3U, 0xC0DF943AU, 0xC10738BDU,
+        0x9A7D6240U, 0x9BA5CEC7U, 0x99CC3B4EU, 0x981497C9U, 0x9D1FD05CU, 0x9CC77CDBU, 0x9EAE8952U, 0x9F7625D5U,
+        0x94B80678U, 0x9560AAFFU, 0x97095F76U, 0x96D1F3F1U, 0x93DAB464U, 0x920218E3U, 0x906BED6AU, 0x91B341EDU,
+        0x87F7AA30U, 0x862F06B7U, 0x8446F33EU, 0x859E5FB9U, 0x8095182CU, 0x814DB4ABU, 0x83244122U, 0x82FCEDA5U,
+        0x8932CE08U, 0x88EA628FU, 0x8A839706U, 0x8B5B3B81U, 0x8E507C14U, 0x8F88D093U, 0x8DE1251AU, 0x8C39899DU,
+        0xA168F2A0U, 0xA0B05E27U, 0xA2D9ABAEU, 0xA3010729U, 0xA60A40BCU, 0xA7D2EC3BU, 0xA5BB19B2U, 0xA463B535U,
+        0xAFAD9698U, 0xAE753A1FU, 0xAC1CCF96U, 0xADC46311U, 0xA8CF2484U, 0xA9178803U, 0xAB7E7D8AU, 0xAAA6D10DU,
+        0xBCE23AD0U, 0xBD3A9657U, 0xBF5363DEU, 0xBE8BCF59U, 0xBB8088CCU, 0xBA58244BU, 0xB831D1C2U, 0xB9E97D45U,
+        0xB2275EE8U, 0xB3FFF26FU, 0xB19607E6U, 0xB04EAB61U, 0xB545ECF4U, 0xB49D4073U, 0xB6F4B5FAU, 0xB72C197DU
+    },
+    {
+        0x00000000U, 0xDC6D9AB7U, 0xBC1A28D9U, 0x6077B26EU, 0x7CF54C05U, 0xA098D6B2U, 0xC0EF64DCU, 0x1C82FE6BU,
+        0xF9EA980AU, 0x258702BDU, 0x45F0B0D3U, 0x999D2A64U, 0x851FD40FU, 0x59724EB8U, 0x3905FCD6U, 0xE5686661U,
+        0xF7142DA3U, 0x2B79B714U, 0x4B0E057AU, 0x97639FCDU, 0x8BE161A6U, 0x578CFB11U, 0x37FB497FU, 0xEB96D3C8U,
+        0x0EFEB5A9U, 0xD2932F1EU, 0xB2E49D70U, 0x6E8907C7U, 0x720BF9ACU, 0xAE66631BU, 0xCE11D175U, 0x127C4BC2U,
+        0xEAE946F1U, 0x3684DC46U, 0x56F36E28U, 0x8A9EF49FU, 0x961C0AF4U, 0x4A719043U, 0x2A06222DU, 0xF66BB89AU,
+        0x1303DEFBU, 0xCF6E444CU, 0xAF19F622U, 0x73746C95U, 0x6FF692FEU, 0xB39B0849U, 0xD3ECBA27U, 0x0F812090U,
+        0x1DFD6B52U, 0xC190F1E5U, 0xA1E7438BU, 0x7D8AD93CU, 0x61082757U, 0xBD65BDE0U, 0xDD120F8EU, 0x017F9539U,
+        0xE417F358U, 0x387A69EFU, 0x580DDB81U, 0x84604136U, 0x98E2BF5DU, 0x448F25EAU, 0x24F89784U, 0xF8950D33U,
+        0xD1139055U, 0x0D7E0AE2U, 0x6D09B88CU, 0xB164223BU, 0xADE6DC50U, 0x718B46E7U, 0x11FCF489U, 0xCD916E3EU,
+        0x28F9085FU, 0xF49492E8U, 0x94E32086U, 0x488EBA31U, 0x540C445AU, 0x8861DEEDU, 0xE8166C83U, 0x347BF634U,
+        0x2607BDF6U, 0xFA6A2741U, 0x9A1D952FU, 0x46700F98U, 0x5AF2F1F3U, 0x869F6B44U, 0xE6E8D92AU, 0x3A85439DU,
+        0xDFED25FCU, 0x0380BF4BU, 0x63F70D25U, 0xBF9A9792U, 0xA31869F9U, 0x7F75F34EU, 0x1F024120U, 0xC36FDB97U,
+        0x3BFAD6A4U, 0xE7974C13U, 0x87E0FE7DU, 0x5B8D64CAU, 0x470F9AA1U, 0x9B620016U, 0xFB15B278U, 0x277828CFU,
+        0xC2104EAEU, 0x1E7DD419U, 0x7E0A6677U, 0xA267FCC0U, 0xBEE502ABU, 0x6288981CU, 0x02FF2A72U, 0xDE92B0C5U,
+        0xCCEEFB07U, 0x108361B0U, 0x70F4D3DEU, 0xAC994969U, 0xB01BB702U, 0x6C762DB5U, 0x0C019FDBU, 0xD06C056CU,
+        0x3504630DU, 0xE969F9BAU, 0x891E4BD4U, 0x5573D163U, 0x49F12F08U, 0x959CB5BFU, 0xF5EB07D1U, 0x29869D66U,
+        0xA6E63D1DU, 0x7A8BA7AAU, 0x1AFC15C4U, 0xC6918F73U, 0xDA137118U, 0x067EEBAFU, 0x660959C1U, 0xBA64C376U,
+        0x5F0CA517U, 0x83613FA0U, 0xE3168DCEU, 0x3F7B1779U, 0x23F9E912U, 0xFF9473A5U, 0x9FE3C1CBU, 0x438E5B7CU,
+        0x51F210BEU, 0x8D9F8A09U, 0xEDE83867U, 0x3185A2D0U, 0x2D075CBBU, 0xF16AC60CU, 0x911D7462U, 0x4D70EED5U,
+        0xA81888B4U, 0x74751203U, 0x1402A06DU, 0xC86F3ADAU, 0xD4EDC4B1U, 0x08805E06U, 0x68F7EC68U, 0xB49A76DFU,
+        0x4C0F7BECU, 0x9062E15BU, 0xF0155335U, 0x2C78C982U, 0x30FA37E9U, 0xEC97AD5EU, 0x8CE01F30U, 0x508D8587U,
+        0xB5E5E3E6U, 0x69887951U, 0x09FFCB3FU, 0xD5925188U, 0xC910AFE3U, 0x157D3554U, 0x750A873AU, 0xA9671D8DU,
+        0xBB1B564FU, 0x6776CCF8U, 0x07017E96U, 0xDB6CE421U, 0xC7EE1A4AU, 0x1B8380FDU, 0x7BF43293U, 0xA799A824U,
+        0x42F1CE45U, 0x9E9C54F2U, 0xFEEBE69CU, 0x22867C2BU, 0x3E048240U, 0xE26918F7U, 0x821EAA99U, 0x5E73302EU,
+        0x77F5AD48U, 0xAB9837FFU, 0xCBEF8591U, 0x17821F26U, 0x0B00E14DU, 0xD76D7BFAU, 0xB71AC994U, 0x6B775323U,
+        0x8E1F3542U, 0x5272AFF5U, 0x32051D9BU, 0xEE68872CU, 0xF2EA7947U, 0x2E87E3F0U, 0x4EF0519EU, 0x929DCB29U,
+        0x80E180EBU, 0x5C8C1A5CU, 0x3CFBA832U, 0xE0963285U, 0xFC14CCEEU, 0x20795659U, 0x400EE437U, 0x9C637E80U,
+        0x790B18E1U, 0xA5668256U, 0xC5113038U, 0x197CAA8FU, 0x05FE54E4U, 0xD993CE53U, 0xB9E47C3DU, 0x6589E68AU,
+        0x9D1CEBB9U, 0x4171710EU, 0x2106C360U, 0xFD6B59D7U, 0xE1E9A7BCU, 0x3D843D0BU, 0x5DF38F65U, 0x819E15D2U,
+        0x64F673B3U, 0xB89BE904U, 0xD8EC5B6AU, 0x0481C1DDU, 0x18033FB6U, 0xC46EA501U, 0xA419176FU, 0x78748DD8U,
+        0x6A08C61AU, 0xB6655CADU, 0xD612EEC3U, 0x0A7F7474U, 0x16FD8A1FU, 0xCA9010A8U, 0xAAE7A2C6U, 0x768A3871U,
+        0x93E25E10U, 0x4F8FC4A7U, 0x2FF876C9U, 0xF395EC7EU, 0xEF171215U, 0x337A88A2U, 0x530D3ACCU, 0x8F60A07BU
+    },
+# if U_SPARTN_CRC_SLICE_BY > 4
+    {
+        0x00000000U, 0x490D678DU, 0x921ACF1AU, 0xDB17A897U, 0x20F48383U, 0x69F9E40EU, 0xB2EE4C99U, 0xFBE32B14U,
+        0x41E90706U, 0x08E4608BU, 0xD3F3C81CU, 0x9AFEAF91U, 0x611D8485U, 0x2810E308U, 0xF3074B9FU, 0xBA0A2C12U,
+        0x83D20E0CU, 0xCADF6981U, 0x11C8C116U, 0x58C5A69BU, 0xA3268D8FU, 0xEA2BEA02U, 0x313C4295U, 0x78312518U,
+        0xC23B090AU, 0x8B366E87U, 0x5021C610U, 0x192CA19DU, 0xE2CF8A89U, 0xABC2ED04U, 0x70D54593U, 0x39D8221EU,
+        0x036501AFU, 0x4A686622U, 0x917FCEB5U, 0xD872A938U, 0x2391822CU, 0x6A9CE5A1U, 0xB18B4D36U, 0xF8862ABBU,
+        0x428C06A9U, 0x0B816124U, 0xD096C9B3U, 0x999BAE3EU, 0x6278852AU, 0x2B75E2A7U, 0xF0624A30U, 0xB96F2DBDU,
+        0x80B70FA3U, 0xC9BA682EU, 0x12ADC0B9U, 0x5BA0A734U, 0xA0438C20U, 0xE94EEBADU, 0x3259433AU, 0x7B5424B7U,
+        0xC15E08A5U, 0x88536F28U, 0x5344C7BFU, 0x1A49A032U, 0xE1AA8B26U, 0xA8A7ECABU, 0x73B0443CU, 0x3ABD23B1U,
+        0x06CA035EU, 0x4FC764D3U, 0x94D0CC44U, 0xDDDDABC9U, 0x263E80DDU, 0x6F33E750U, 0xB4244FC7U, 0xFD29284AU,
+        0x47230458U, 0x0E2E63D5U, 0xD539CB42U, 0x9C34ACCFU, 0x67D787DBU, 0x2EDAE056U, 0xF5CD48C1U, 0xBCC02F4CU,
+        0x85180D52U, 0xCC156ADFU, 0x1702C248U, 0x5E0FA5C5U, 0xA5EC8ED1U, 0xECE1E95CU, 0x37F641CBU, 0x7EFB2646U,
+        0xC4F10A54U, 0x8DFC6DD9U, 0x56EBC54EU, 0x1FE6A2C3U, 0xE40589D7U, 0xAD08EE5AU, 0x761F46CDU, 0x3F122140U,
+        0x05AF02F1U, 0x4CA2657CU, 0x97B5CDEBU, 0xDEB8AA66U, 0x255B8172U, 0x6C56E6FFU, 0xB7414E68U, 0xFE4C29E5U,
+        0x444605F7U, 0x0D4B627AU, 0xD65CCAEDU, 0x9F51AD60U, 0x64B28674U, 0x2DBFE1F9U, 0xF6A8496EU, 0xBFA52EE3U,
+        0x867D0CFDU, 0xCF706B70U, 0x1467C3E7U, 0x5D6AA46AU, 0xA6898F7EU, 0xEF84E8F3U, 0x34934064U, 0x7D9E27E9U,
+        0xC7940BFBU, 0x8E996C76U, 0x558EC4E1U, 0x1C83A36CU, 0xE7608878U, 0xAE6DEFF5U, 0x757A4762U, 0x3C7720EFU,
+        0x0D9406BCU, 0x44996131U, 0x9F8EC9A6U, 0xD683AE2BU, 0x2D60853FU, 0x646DE2B2U, 0xBF7A4A25U, 0xF6772DA8U,
+        0x4C7D01BAU, 0x05706637U, 0xDE67CEA0U, 0x976AA92DU, 0x6C898239U, 0x2584E5B4U, 0xFE934D23U, 0xB79E2AAEU,
+        0x8E4608B0U, 0xC74B6F3DU, 0x1C5CC7AAU, 0x5551A027U, 0xAEB28B33U, 0xE7BFECBEU, 0x3CA84429U, 0x75A523A4U,
+        0xCFAF0FB6U, 0x86A2683BU, 0x5DB5C0ACU, 0x14B8A721U, 0xEF5B8C35U, 0xA656EBB8U, 0x7D41432FU, 0x344C24A2U,
+        0x0EF10713U, 0x47FC609EU, 0x9CEBC809U, 0xD5E6AF84U, 0x2E058490U, 0x6708E31DU, 0xBC1F4B8AU, 0xF5122C07U,
+        0x4F180015U, 0x06156798U, 0xDD02CF0FU, 0x940FA882U, 0x6FEC8396U, 0x26E1E41BU, 0xFDF64C8CU, 0xB4FB2B01U,
+        0x8D23091FU, 0xC42E6E92U, 0x1F39C605U, 0x5634A188U, 0xADD78A9CU, 0xE4DAED11U, 0x3FCD4586U, 0x76C0220BU,
+        0xCCCA0E19U, 0x85C76994U, 0x5ED0C103U, 0x17DDA68EU, 0xEC3E8D9AU, 0xA533EA17U, 0x7E244280U, 0x3729250DU,
+        0x0B5E05E2U, 0x4253626FU, 0x9944CAF8U, 0xD049AD75U, 0x2BAA8661U, 0x62A7E1ECU, 0xB9B0497BU, 0xF0BD2EF6U,
+        0x4AB702E4U, 0x03BA6569U, 0xD8ADCDFEU, 0x91A0AA73U, 0x6A438167U, 0x234EE6EAU, 0xF8594E7DU, 0xB15429F0U,
+        0x888C0BEEU, 0xC1816C63U, 0x1A96C4F4U, 0x539BA379U, 0xA878886DU, 0xE175EFE0U, 0x3A624777U, 0x736F20FAU,
+        0xC9650CE8U, 0x80686B65U, 0x5B7FC3F2U, 0x1272A47FU, 0xE9918F6BU, 0xA09CE8E6U, 0x7B8B4071U, 0x328627FCU,
+        0x083B044DU, 0x413663C0U, 0x9A21CB57U, 0xD32CACDAU, 0x28CF87CEU, 0x61C2E043U, 0xBAD548D4U, 0xF3D82F59U,
+        0x49D2034BU, 0x00DF64C6U, 0xDBC8CC51U, 0x92C5ABDCU, 0x692680C8U, 0x202BE745U, 0xFB3C4FD2U, 0xB231285FU,
+        0x8BE90A41U, 0xC2E46DCCU, 0x19F3C55BU, 0x50FEA2D6U, 0xAB1D89C2U, 0xE210EE4FU, 0x390746D8U, 0x700A2155U,
+        0xCA000D47U, 0x830D6ACAU, 0x581AC25DU, 0x1117A5D0U, 0xEAF48EC4U, 0xA3F9E949U, 0x78EE41DEU, 0x31E32653U
+    },
+    {
+        0x00000000U, 0x1B280D78U, 0x36501AF0U, 0x2D781788U, 0x6CA035E0U, 0x77883898U, 0x5AF02F10U, 0x41D82268U,
+        0xD9406BC0U, 0xC26866B8U, 0xEF107130U, 0xF4387C48U, 0xB5E05E20U, 0xAEC85358U, 0x83B044D0U, 0x989849A8U,
+        0xB641CA37U, 0xAD69C74FU, 0x8011D0C7U, 0x9B39DDBFU, 0xDAE1FFD7U, 0xC1C9F2AFU, 0xECB1E527U, 0xF799E85FU,
+        0x6F01A1F7U, 0x7429AC8FU, 0x5951BB07U, 0x4279B67FU, 0x03A19417U, 0x1889996FU, 0x35F18EE7U, 0x2ED9839FU,
+        0x684289D9U, 0x736A84A1U, 0x5E129329U, 0x453A9E51U, 0x04E2BC39U, 0x1FCAB141U, 0x32B2A6C9U, 0x299AABB1U,
+        0xB102E219U, 0xAA2AEF61U, 0x8752F8E9U, 0x9C7AF591U, 0xDDA2D7F9U, 0xC68ADA81U, 0xEBF2CD09U, 0xF0DAC071U,
+        0xDE0343EEU, 0xC52B4E96U, 0xE853591EU, 0xF37B5466U, 0xB2A3760EU, 0xA98B7B76U, 0x84F36CFEU, 0x9FDB6186U,
+        0x0743282EU, 0x1C6B2556U, 0x311332DEU, 0x2A3B3FA6U, 0x6BE31DCEU, 0x70CB10B6U, 0x5DB3073EU, 0x469B0A46U,
+        0xD08513B2U, 0xCBAD1ECAU, 0xE6D50942U, 0xFDFD043AU, 0xBC252652U, 0xA70D2B2AU, 0x8A753CA2U, 0x915D31DAU,
+        0x09C57872U, 0x12ED750AU, 0x3F956282U, 0x24BD6FFAU, 0x65654D92U, 0x7E4D40EAU, 0x53355762U, 0x481D5A1AU,
+        0x66C4D985U, 0x7DECD4FDU, 0x5094C375U, 0x4BBCCE0DU, 0x0A64EC65U, 0x114CE11DU, 0x3C34F695U, 0x271CFBEDU,
+        0xBF84B245U, 0xA4ACBF3DU, 0x89D4A8B5U, 0x92FCA5CDU, 0xD32487A5U, 0xC80C8ADDU, 0xE5749D55U, 0xFE5C902DU,
+        0xB8C79A6BU, 0xA3EF9713U, 0x8E97809BU, 0x95BF8DE3U, 0xD467AF8BU, 0xCF4FA2F3U, 0xE237B57BU, 0xF91FB803U,
+        0x6187F1ABU, 0x7AAFFCD3U, 0x57D7EB5BU, 0x4CFFE623U, 0x0D27C44BU, 0x160FC933U, 0x3B77DEBBU, 0x205FD3C3U,
+        0x0E86505CU, 0x15AE5D24U, 0x38D64AACU, 0x23FE47D4U, 0x622665BCU, 0x790E68C4U, 0x54767F4CU, 0x4F5E7234U,
+        0xD7C63B9CU, 0xCCEE36E4U, 0xE196216CU, 0xFABE2C14U, 0xBB660E7CU, 0xA04E0304U, 0x8D36148CU, 0x961E19F4U,
+        0xA5CB3AD3U, 0xBEE337ABU, 0x939B2023U, 0x88B32D5BU, 0xC96B0F33U, 0xD243024BU, 0xFF3B15C3U, 0xE41318BBU,
+        0x7C8B5113U, 0x67A35C6BU, 0x4ADB4BE3U, 0x51F3469BU, 0x102B64F3U, 0x0B03698BU, 0x267B7E03U, 0x3D53737BU,
+        0x138AF0E4U, 0x08A2FD9CU, 0x25DAEA14U, 0x3EF2E76CU, 0x7F2AC504U, 0x6402C87CU, 0x497ADFF4U, 0x5252D28CU,
+        0xCACA9B24U, 0xD1E2965CU, 0xFC9A81D4U, 0xE7B28CACU, 0xA66AAEC4U, 0xBD42A3BCU, 0x903AB434U, 0x8B12B94CU,
+        0xCD89B30AU, 0xD6A1BE72U, 0xFBD9A9FAU, 0xE0F1A482U, 0xA12986EAU, 0xBA018B92U, 0x97799C1AU, 0x8C519162U,
+        0x14C9D8CAU, 0x0FE1D5B2U, 0x2299C23AU, 0x39B1CF42U, 0x7869ED2AU, 0x6341E052U, 0x4E39F7DAU, 0x5511FAA2U,
+        0x7BC8793DU, 0x60E07445U, 0x4D9863CDU, 0x56B06EB5U, 0x17684CDDU, 0x0C4041A5U, 0x2138562DU, 0x3A105B55U,
+        0xA28812FDU, 0xB9A01F85U, 0x94D8080DU, 0x8FF00575U, 0xCE28271DU, 0xD5002A65U, 0xF8783DEDU, 0xE3503095U,
+        0x754E2961U, 0x6E662419U, 0x431E3391U, 0x58363EE9U, 0x19EE1C81U, 0x02C611F9U, 0x2FBE0671U, 0x34960B09U,
+        0xAC0E42A1U, 0xB7264FD9U, 0x9A5E5851U, 0x81765529U, 0xC0AE7741U, 0xDB867A39U, 0xF6FE6DB1U, 0xEDD660C9U,
+        0xC30FE356U, 0xD827EE2EU, 0xF55FF9A6U, 0xEE77F4DEU, 0xAFAFD6B6U, 0xB487DBCEU, 0x99FFCC46U, 0x82D7C13EU,
+        0x1A4F8896U, 0x016785EEU, 0x2C1F9266U, 0x37379F1EU, 0x76EFBD76U, 0x6DC7B00EU, 0x40BFA786U, 0x5B97AAFEU,
+        0x1D0CA0B8U, 0x0624ADC0U, 0x2B5CBA48U, 0x3074B730U, 0x71AC9558U, 0x6A849820U, 0x47FC8FA8U, 0x5CD482D0U,
+        0xC44CCB78U, 0xDF64C600U, 0xF21CD188U, 0xE934DCF0U, 0xA8ECFE98U, 0xB3C4F3E0U, 0x9EBCE468U, 0x8594E910U,
+        0xAB4D6A8FU, 0xB06567F7U, 0x9D1D707FU, 0x86357D07U, 0xC7ED5F6FU, 0xDCC55217U, 0xF1BD459FU, 0xEA9548E7U,
+        0x720D014FU, 0x69250C37U, 0x445D1BBFU, 0x5F7516C7U, 0x1EAD34AFU, 0x058539D7U, 0x28FD2E5FU, 0x33D52327U
+    },
+    {
+        0x00000000U, 0x4F576811U, 0x9EAED022U, 0xD1F9B833U, 0x399CBDF3U, 0x76CBD5E2U, 0xA7326DD1U, 0xE86505C0U,
+        0x73397BE6U, 0x3C6E13F7U, 0xED97ABC4U, 0xA2C0C3D5U, 0x4AA5C615U, 0x05F2AE04U, 0xD40B1637U, 0x9B5C7E26U,
+        0xE672F7CCU, 0xA9259FDDU, 0x78DC27EEU, 0x378B4FFFU, 0xDFEE4A3FU, 0x90B9222EU, 0x41409A1DU, 0x0E17F20CU,
+        0x954B8C2AU, 0xDA1CE43BU, 0x0BE55C08U, 0x44B23419U, 0xACD731D9U, 0xE38059C8U, 0x3279E1FBU, 0x7D2E89EAU,
+        0xC824F22FU, 0x87739A3EU, 0x568A220DU, 0x19DD4A1CU, 0xF1B84FDCU, 0xBEEF27CDU, 0x6F169FFEU, 0x2041F7EFU,
+        0xBB1D89C9U, 0xF44AE1D8U, 0x25B359EBU, 0x6AE431FAU, 0x8281343AU, 0xCDD65C2BU, 0x1C2FE418U, 0x53788C09U,
+        0x2E5605E3U, 0x61016DF2U, 0xB0F8D5C1U, 0xFFAFBDD0U, 0x17CAB810U, 0x589DD001U, 0x89646832U, 0xC6330023U,
+        0x5D6F7E05U, 0x12381614U, 0xC3C1AE27U, 0x8C96C636U, 0x64F3C3F6U, 0x2BA4ABE7U, 0xFA5D13D4U, 0xB50A7BC5U,
+        0x9488F9E9U, 0xDBDF91F8U, 0x0A2629CBU, 0x457141DAU, 0xAD14441AU, 0xE2432C0BU, 0x33BA9438U, 0x7CEDFC29U,
+        0xE7B1820FU, 0xA8E6EA1EU, 0x791F522DU, 0x36483A3CU, 0xDE2D3FFCU, 0x917A57EDU, 0x4083EFDEU, 0x0FD487CFU,
+        0x72FA0E25U, 0x3DAD6634U, 0xEC54DE07U, 0xA303B616U, 0x4B66B3D6U, 0x0431DBC7U, 0xD5C863F4U, 0x9A9F0BE5U,
+        0x01C375C3U, 0x4E941DD2U, 0x9F6DA5E1U, 0xD03ACDF0U, 0x385FC830U, 0x7708A021U, 0xA6F11812U, 0xE9A67003U,
+        0x5CAC0BC6U, 0x13FB63D7U, 0xC202DBE4U, 0x8D55B3F5U, 0x6530B635U, 0x2A67DE24U, 0xFB9E6617U, 0xB4C90E06U,
+        0x2F957020U, 0x60C21831U, 0xB13BA002U, 0xFE6CC813U, 0x1609CDD3U, 0x595EA5C2U, 0x88A71DF1U, 0xC7F075E0U,
+        0xBADEFC0AU, 0xF589941BU, 0x24702C28U, 0x6B274439U, 0x834241F9U, 0xCC1529E8U, 0x1DEC91DBU, 0x52BBF9CAU,
+        0xC9E787ECU, 0x86B0EFFDU, 0x574957CEU, 0x181E3FDFU, 0xF07B3A1FU, 0xBF2C520EU, 0x6ED5EA3DU, 0x2182822CU,
+        0x2DD0EE65U, 0x62878674U, 0xB37E3E47U, 0xFC295656U, 0x144C5396U, 0x5B1B3B87U, 0x8AE283B4U, 0xC5B5EBA5U,
+        0x5EE99583U, 0x11BEFD92U, 0xC04745A1U, 0x8F102DB0U, 0x67752870U, 0x28224061U, 0xF9DBF852U, 0xB68C9043U,
+        0xCBA219A9U, 0x84F571B8U, 0x550CC98BU, 0x1A5BA19AU, 0xF23EA45AU, 0xBD69CC4BU, 0x6C907478U, 0x23C71C69U,
+        0xB89B624FU, 0xF7CC0A5EU, 0x2635B26DU, 0x6962DA7CU, 0x8107DFBCU, 0xCE50B7ADU, 0x1FA90F9EU, 0x50FE678FU,
+        0xE5F41C4AU, 0xAAA3745BU, 0x7B5ACC68U, 0x340DA479U, 0xDC68A1B9U, 0x933FC9A8U, 0x42C6719BU, 0x0D91198AU,
+        0x96CD67ACU, 0xD99A0FBDU, 0x0863B78EU, 0x4734DF9FU, 0xAF51DA5FU, 0xE006B24EU, 0x31FF0A7DU, 0x7EA8626CU,
+        0x0386EB86U, 0x4CD18397U, 0x9D283BA4U, 0xD27F53B5U, 0x3A1A5675U, 0x754D3E64U, 0xA4B48657U, 0xEBE3EE46U,
+        0x70BF9060U, 0x3FE8F871U, 0xEE114042U, 0xA1462853U, 0x49232D93U, 0x06744582U, 0xD78DFDB1U, 0x98DA95A0U,
+        0xB958178CU, 0xF60F7F9DU, 0x27F6C7AEU, 0x68A1AFBFU, 0x80C4AA7FU, 0xCF93C26EU, 0x1E6A7A5DU, 0x513D124CU,
+        0xCA616C6AU, 0x8536047BU, 0x54CFBC48U, 0x1B98D459U, 0xF3FDD199U, 0xBCAAB988U, 0x6D5301BBU, 0x220469AAU,
+        0x5F2AE040U, 0x107D8851U, 0xC1843062U, 0x8ED35873U, 0x66B65DB3U, 0x29E135A2U, 0xF8188D91U, 0xB74FE580U,
+        0x2C139BA6U, 0x6344F3B7U, 0xB2BD4B84U, 0xFDEA2395U, 0x158F2655U, 0x5AD84E44U, 0x8B21F677U, 0xC4769E66U,
+        0x717CE5A3U, 0x3E2B8DB2U, 0xEFD23581U, 0xA0855D90U, 0x48E05850U, 0x07B73041U, 0xD64E8872U, 0x9919E063U,
+        0x02459E45U, 0x4D12F654U, 0x9CEB4E67U, 0xD3BC2676U, 0x3BD923B6U, 0x748E4BA7U, 0xA577F394U, 0xEA209B85U,
+        0x970E126FU, 0xD8597A7EU, 0x09A0C24DU, 0x46F7AA5CU, 0xAE92AF9CU, 0xE1C5C78DU, 0x303C7FBEU, 0x7F6B17AFU,
+        0xE4376989U, 0xAB600198U, 0x7A99B9ABU, 0x35CED1BAU, 0xDDABD47AU, 0x92FCBC6BU, 0x43050458U, 0x0C526C49U
+    },
+    {
+        0x00000000U, 0x5BA1DCCAU, 0xB743B994U, 0xECE2655EU, 0x6A466E9FU, 0x31E7B255U, 0xDD05D70BU, 0x86A40BC1U,
+        0xD48CDD3EU, 0x8F2D01F4U, 0x63CF64AAU, 0x386EB860U, 0xBECAB3A1U, 0xE56B6F6BU, 0x09890A35U, 0x5228D6FFU,
+        0xADD8A7CBU, 0xF6797B01U, 0x1A9B1E5FU, 0x413AC295U, 0xC79EC954U, 0x9C3F159EU, 0x70DD70C0U, 0x2B7CAC0AU,
+        0x79547AF5U, 0x22F5A63FU, 0xCE17C361U, 0x95B61FABU, 0x1312146AU, 0x48B3C8A0U, 0xA451ADFEU, 0xFFF07134U,
+        0x5F705221U, 0x04D18EEBU, 0xE833EBB5U, 0xB392377FU, 0x35363CBEU, 0x6E97E074U, 0x8275852AU, 0xD9D459E0U,
+        0x8BFC8F1FU, 0xD05D53D5U, 0x3CBF368BU, 0x671EEA41U, 0xE1BAE180U, 0xBA1B3D4AU, 0x56F95814U, 0x0D5884DEU,
+        0xF2A8F5EAU, 0xA9092920U, 0x45EB4C7EU, 0x1E4A90B4U, 0x98EE9B75U, 0xC34F47BFU, 0x2FAD22E1U, 0x740CFE2BU,
+        0x262428D4U, 0x7D85F41EU, 0x91679140U, 0xCAC64D8AU, 0x4C62464BU, 0x17C39A81U, 0xFB21FFDFU, 0xA0802315U,
+        0xBEE0A442U, 0xE5417888U, 0x09A31DD6U, 0x5202C11CU, 0xD4A6CADDU, 0x8F071617U, 0x63E57349U, 0x3844AF83U,
+        0x6A6C797CU, 0x31CDA5B6U, 0xDD2FC0E8U, 0x868E1C22U, 0x002A17E3U, 0x5B8BCB29U, 0xB769AE77U, 0xECC872BDU,
+        0x13380389U, 0x4899DF43U, 0xA47BBA1DU, 0xFFDA66D7U, 0x797E6D16U, 0x22DFB1DCU, 0xCE3DD482U, 0x959C0848U,
+        0xC7B4DEB7U, 0x9C15027DU, 0x70F76723U, 0x2B56BBE9U, 0xADF2B028U, 0xF6536CE2U, 0x1AB109BCU, 0x4110D576U,
+        0xE190F663U, 0xBA312AA9U, 0x56D34FF7U, 0x0D72933DU, 0x8BD698FCU, 0xD0774436U, 0x3C952168U, 0x6734FDA2U,
+        0x351C2B5DU, 0x6EBDF797U, 0x825F92C9U, 0xD9FE4E03U, 0x5F5A45C2U, 0x04FB9908U, 0xE819FC56U, 0xB3B8209CU,
+        0x4C4851A8U, 0x17E98D62U, 0xFB0BE83CU, 0xA0AA34F6U, 0x260E3F37U, 0x7DAFE3FDU, 0x914D86A3U, 0xCAEC5A69U,
+        0x98C48C96U, 0xC365505CU, 0x2F873502U, 0x7426E9C8U, 0xF282E209U, 0xA9233EC3U, 0x45C15B9DU, 0x1E608757U,
+        0x79005533U, 0x22A189F9U, 0xCE43ECA7U, 0x95E2306DU, 0x13463BACU, 0x48E7E766U, 0xA4058238U, 0xFFA45EF2U,
+        0xAD8C880DU, 0xF62D54C7U, 0x1ACF3199U, 0x416EED53U, 0xC7CAE692U, 0x9C6B3A58U, 0x70895F06U, 0x2B2883CCU,
+        0xD4D8F2F8U, 0x8F792E32U, 0x639B4B6CU, 0x383A97A6U, 0xBE9E9C67U, 0xE53F40ADU, 0x09DD25F3U, 0x527CF939U,
+        0x00542FC6U, 0x5BF5F30CU, 0xB7179652U, 0xECB64A98U, 0x6A124159U, 0x31B39D93U, 0xDD51F8CDU, 0x86F02407U,
+        0x26700712U, 0x7DD1DBD8U, 0x9133BE86U, 0xCA92624CU, 0x4C36698DU, 0x1797B547U, 0xFB75D019U, 0xA0D40CD3U,
+        0xF2FCDA2CU, 0xA95D06E6U, 0x45BF63B8U, 0x1E1EBF72U, 0x98BAB4B3U, 0xC31B6879U, 0x2FF90D27U, 0x7458D1EDU,
+        0x8BA8A0D9U, 0xD0097C13U, 0x3CEB194DU, 0x674AC587U, 0xE1EECE46U, 0xBA4F128CU, 0x56AD77D2U, 0x0D0CAB18U,
+        0x5F247DE7U, 0x0485A12DU, 0xE867C473U, 0xB3C618B9U, 0x35621378U, 0x6EC3CFB2U, 0x8221AAECU, 0xD9807626U,
+        0xC7E0F171U, 0x9C412DBBU, 0x70A348E5U, 0x2B02942FU, 0xADA69FEEU, 0xF6074324U, 0x1AE5267AU, 0x4144FAB0U,
+        0x136C2C4FU, 0x48CDF085U, 0xA42F95DBU, 0xFF8E4911U, 0x792A42D0U, 0x228B9E1AU, 0xCE69FB44U, 0x95C8278EU,
+        0x6A3856BAU, 0x31998A70U, 0xDD7BEF2EU, 0x86DA33E4U, 0x007E3825U, 0x5BDFE4EFU, 0xB73D81B1U, 0xEC9C5D7BU,
+        0xBEB48B84U, 0xE515574EU, 0x09F73210U, 0x5256EEDAU, 0xD4F2E51BU, 0x8F5339D1U, 0x63B15C8FU, 0x38108045U,
+        0x9890A350U, 0xC3317F9AU, 0x2FD31AC4U, 0x7472C60EU, 0xF2D6CDCFU, 0xA9771105U, 0x4595745BU, 0x1E34A891U,
+        0x4C1C7E6EU, 0x17BDA2A4U, 0xFB5FC7FAU, 0xA0FE1B30U, 0x265A10F1U, 0x7DFBCC3BU, 0x9119A965U, 0xCAB875AFU,
+        0x3548049BU, 0x6EE9D851U, 0x820BBD0FU, 0xD9AA61C5U, 0x5F0E6A04U, 0x04AFB6CEU, 0xE84DD390U, 0xB3EC0F5AU,
+        0xE1C4D9A5U, 0xBA65056FU, 0x56876031U, 0x0D26BCFBU, 0x8B82B73AU, 0xD0236BF0U, 0x3CC10EAEU, 0x6760D264U
+    }
+# endif
+};
+
+#endif // #if U_SPARTN_CRC_SLICE_BY > 1
+
+#endif // #ifndef U_SPARTN_CRC_HW
+
+#if U_SPARTN_CRC_SLICE_BY > 1
+
+/** Tables 1 to (#U_SPARTN_CRC_SLICE_BY - 1) for slicing CRC-24,
+ * shifted up by eight bits so that CRC-24 can use the same 32-bit
+ * arithmetic as CRC-32; table 0 is u32Crc24Table, shifted likewise
+ * when it is used.
+ */
+static const uint32_t u32Crc24SliceTable[U_SPARTN_CRC_SLICE_BY - 1][256] = {
+    {
+        0x00000000U, 0x668F4800U, 0xCD1E9000U, 0xAB91D800U, 0x1C71DB00U, 0x7AFE9300U, 0xD16F4B00U, 0xB7E00300U,
+        0x38E3B600U, 0x5E6CFE00U, 0xF5FD2600U, 0x93726E00U, 0x24926D00U, 0x421D2500U, 0xE98CFD00U, 0x8F03B500U,
+        0x71C76C00U, 0x17482400U, 0xBCD9FC00U, 0xDA56B400U, 0x6DB6B700U, 0x0B39FF00U, 0xA0A82700U, 0xC6276F00U,
+        0x4924DA00U, 0x2FAB9200U, 0x843A4A00U, 0xE2B50200U, 0x55550100U, 0x33DA4900U, 0x984B9100U, 0xFEC4D900U,
+        0xE38ED800U, 0x85019000U, 0x2E904800U, 0x481F0000U, 0xFFFF0300U, 0x99704B00U, 0x32E19300U, 0x546EDB00U,
+        0xDB6D6E00U, 0xBDE22600U, 0x1673FE00U, 0x70FCB600U, 0xC71CB500U, 0xA193FD00U, 0x0A022500U, 0x6C8D6D00U,
+        0x9249B400U, 0xF4C6FC00U, 0x5F572400U, 0x39D86C00U, 0x8E386F00U, 0xE8B72700U, 0x4326FF00U, 0x25A9B700U,
+        0xAAAA0200U, 0xCC254A00U, 0x67B49200U, 0x013BDA00U, 0xB6DBD900U, 0xD0549100U, 0x7BC54900U, 0x1D4A0100U,
+        0x41514B00U, 0x27DE0300U, 0x8C4FDB00U, 0xEAC09300U, 0x5D209000U, 0x3BAFD800U, 0x903E0000U, 0xF6B14800U,
+        0x79B2FD00U, 0x1F3DB500U, 0xB4AC6D00U, 0xD2232500U, 0x65C32600U, 0x034C6E00U, 0xA8DDB600U, 0xCE52FE00U,
+        0x30962700U, 0x56196F00U, 0xFD88B700U, 0x9B07FF00U, 0x2CE7FC00U, 0x4A68B400U, 0xE1F96C00U, 0x87762400U,
+        0x08759100U, 0x6EFAD900U, 0xC56B0100U, 0xA3E44900U, 0x14044A00U, 0x728B0200U, 0xD91ADA00U, 0xBF959200U,
+        0xA2DF9300U, 0xC450DB00U, 0x6FC10300U, 0x094E4B00U, 0xBEAE4800U, 0xD8210000U, 0x73B0D800U, 0x153F9000U,
+        0x9A3C2500U, 0xFCB36D00U, 0x5722B500U, 0x31ADFD00U, 0x864DFE00U, 0xE0C2B600U, 0x4B536E00U, 0x2DDC2600U,
+        0xD318FF00U, 0xB597B700U, 0x1E066F00U, 0x78892700U, 0xCF692400U, 0xA9E66C00U, 0x0277B400U, 0x64F8FC00U,
+        0xEBFB4900U, 0x8D740100U, 0x26E5D900U, 0x406A9100U, 0xF78A9200U, 0x9105DA00U, 0x3A940200U, 0x5C1B4A00U,
+        0x82A29600U, 0xE42DDE00U, 0x4FBC0600U, 0x29334E00U, 0x9ED34D00U, 0xF85C0500U, 0x53CDDD00U, 0x35429500U,
+        0xBA412000U, 0xDCCE6800U, 0x775FB000U, 0x11D0F800U, 0xA630FB00U, 0xC0BFB300U, 0x6B2E6B00U, 0x0DA12300U,
+        0xF365FA00U, 0x95EAB200U, 0x3E7B6A00U, 0x58F42200U, 0xEF142100U, 0x899B6900U, 0x220AB100U, 0x4485F900U,
+        0xCB864C00U, 0xAD090400U, 0x0698DC00U, 0x60179400U, 0xD7F79700U, 0xB178DF00U, 0x1AE90700U, 0x7C664F00U,
+        0x612C4E00U, 0x07A30600U, 0xAC32DE00U, 0xCABD9600U, 0x7D5D9500U, 0x1BD2DD00U, 0xB0430500U, 0xD6CC4D00U,
+        0x59CFF800U, 0x3F40B000U, 0x94D16800U, 0xF25E2000U, 0x45BE2300U, 0x23316B00U, 0x88A0B300U, 0xEE2FFB00U,
+        0x10EB2200U, 0x76646A00U, 0xDDF5B200U, 0xBB7AFA00U, 0x0C9AF900U, 0x6A15B100U, 0xC1846900U, 0xA70B2100U,
+        0x28089400U, 0x4E87DC00U, 0xE5160400U, 0x83994C00U, 0x34794F00U, 0x52F60700U, 0xF967DF00U, 0x9FE89700U,
+        0xC3F3DD00U, 0xA57C9500U, 0x0EED4D00U, 0x68620500U, 0xDF820600U, 0xB90D4E00U, 0x129C9600U, 0x7413DE00U,
+        0xFB106B00U, 0x9D9F2300U, 0x360EFB00U, 0x5081B300U, 0xE761B000U, 0x81EEF800U, 0x2A7F2000U, 0x4CF06800U,
+        0xB234B100U, 0xD4BBF900U, 0x7F2A2100U, 0x19A56900U, 0xAE456A00U, 0xC8CA2200U, 0x635BFA00U, 0x05D4B200U,
+        0x8AD70700U, 0xEC584F00U, 0x47C99700U, 0x2146DF00U, 0x96A6DC00U, 0xF0299400U, 0x5BB84C00U, 0x3D370400U,
+        0x207D0500U, 0x46F24D00U, 0xED639500U, 0x8BECDD00U, 0x3C0CDE00U, 0x5A839600U, 0xF1124E00U, 0x979D0600U,
+        0x189EB300U, 0x7E11FB00U, 0xD5802300U, 0xB30F6B00U, 0x04EF6800U, 0x62602000U, 0xC9F1F800U, 0xAF7EB000U,
+        0x51BA6900U, 0x37352100U, 0x9CA4F900U, 0xFA2BB100U, 0x4DCBB200U, 0x2B44FA00U, 0x80D52200U, 0xE65A6A00U,
+        0x6959DF00U, 0x0FD69700U, 0xA4474F00U, 0xC2C80700U, 0x75280400U, 0x13A74C00U, 0xB8369400U, 0xDEB9DC00U
+    },
+    {
+        0x00000000U, 0x8309D700U, 0x805F5500U, 0x03568200U, 0x86F25100U, 0x05FB8600U, 0x06AD0400U, 0x85A4D300U,
+        0x8BA85900U, 0x08A18E00U, 0x0BF70C00U, 0x88FEDB00U, 0x0D5A0800U, 0x8E53DF00U, 0x8D055D00U, 0x0E0C8A00U,
+        0x911C4900U, 0x12159E00U, 0x11431C00U, 0x924ACB00U, 0x17EE1800U, 0x94E7CF00U, 0x97B14D00U, 0x14B89A00U,
+        0x1AB41000U, 0x99BDC700U, 0x9AEB4500U, 0x19E29200U, 0x9C464100U, 0x1F4F9600U, 0x1C191400U, 0x9F10C300U,
+        0xA4746900U, 0x277DBE00U, 0x242B3C00U, 0xA722EB00U, 0x22863800U, 0xA18FEF00U, 0xA2D96D00U, 0x21D0BA00U,
+        0x2FDC3000U, 0xACD5E700U, 0xAF836500U, 0x2C8AB200U, 0xA92E6100U, 0x2A27B600U, 0x29713400U, 0xAA78E300U,
+        0x35682000U, 0xB661F700U, 0xB5377500U, 0x363EA200U, 0xB39A7100U, 0x3093A600U, 0x33C52400U, 0xB0CCF300U,
+        0xBEC07900U, 0x3DC9AE00U, 0x3E9F2C00U, 0xBD96FB00U, 0x38322800U, 0xBB3BFF00U, 0xB86D7D00U, 0x3B64AA00U,
+        0xCEA42900U, 0x4DADFE00U, 0x4EFB7C00U, 0xCDF2AB00U, 0x48567800U, 0xCB5FAF00U, 0xC8092D00U, 0x4B00FA00U,
+        0x450C7000U, 0xC605A700U, 0xC5532500U, 0x465AF200U, 0xC3FE2100U, 0x40F7F600U, 0x43A17400U, 0xC0A8A300U,
+        0x5FB86000U, 0xDCB1B700U, 0xDFE73500U, 0x5CEEE200U, 0xD94A3100U, 0x5A43E600U, 0x59156400U, 0xDA1CB300U,
+        0xD4103900U, 0x5719EE00U, 0x544F6C00U, 0xD746BB00U, 0x52E26800U, 0xD1EBBF00U, 0xD2BD3D00U, 0x51B4EA00U,
+        0x6AD04000U, 0xE9D99700U, 0xEA8F1500U, 0x6986C200U, 0xEC221100U, 0x6F2BC600U, 0x6C7D4400U, 0xEF749300U,
+        0xE1781900U, 0x6271CE00U, 0x61274C00U, 0xE22E9B00U, 0x678A4800U, 0xE4839F00U, 0xE7D51D00U, 0x64DCCA00U,
+        0xFBCC0900U, 0x78C5DE00U, 0x7B935C00U, 0xF89A8B00U, 0x7D3E5800U, 0xFE378F00U, 0xFD610D00U, 0x7E68DA00U,
+        0x70645000U, 0xF36D8700U, 0xF03B0500U, 0x7332D200U, 0xF6960100U, 0x759FD600U, 0x76C95400U, 0xF5C08300U,
+        0x1B04A900U, 0x980D7E00U, 0x9B5BFC00U, 0x18522B00U, 0x9DF6F800U, 0x1EFF2F00U, 0x1DA9AD00U, 0x9EA07A00U,
+        0x90ACF000U, 0x13A52700U, 0x10F3A500U, 0x93FA7200U, 0x165EA100U, 0x95577600U, 0x9601F400U, 0x15082300U,
+        0x8A18E000U, 0x09113700U, 0x0A47B500U, 0x894E6200U, 0x0CEAB100U, 0x8FE36600U, 0x8CB5E400U, 0x0FBC3300U,
+        0x01B0B900U, 0x82B96E00U, 0x81EFEC00U, 0x02E63B00U, 0x8742E800U, 0x044B3F00U, 0x071DBD00U, 0x84146A00U,
+        0xBF70C000U, 0x3C791700U, 0x3F2F9500U, 0xBC264200U, 0x39829100U, 0xBA8B4600U, 0xB9DDC400U, 0x3AD41300U,
+        0x34D89900U, 0xB7D14E00U, 0xB487CC00U, 0x378E1B00U, 0xB22AC800U, 0x31231F00U, 0x32759D00U, 0xB17C4A00U,
+        0x2E6C8900U, 0xAD655E00U, 0xAE33DC00U, 0x2D3A0B00U, 0xA89ED800U, 0x2B970F00U, 0x28C18D00U, 0xABC85A00U,
+        0xA5C4D000U, 0x26CD0700U, 0x259B8500U, 0xA6925200U, 0x23368100U, 0xA03F5600U, 0xA369D400U, 0x20600300U,
+        0xD5A08000U, 0x56A95700U, 0x55FFD500U, 0xD6F60200U, 0x5352D100U, 0xD05B0600U, 0xD30D8400U, 0x50045300U,
+        0x5E08D900U, 0xDD010E00U, 0xDE578C00U, 0x5D5E5B00U, 0xD8FA8800U, 0x5BF35F00U, 0x58A5DD00U, 0xDBAC0A00U,
+        0x44BCC900U, 0xC7B51E00U, 0xC4E39C00U, 0x47EA4B00U, 0xC24E9800U, 0x41474F00U, 0x4211CD00U, 0xC1181A00U,
+        0xCF149000U, 0x4C1D4700U, 0x4F4BC500U, 0xCC421200U, 0x49E6C100U, 0xCAEF1600U, 0xC9B99400U, 0x4AB04300U,
+        0x71D4E900U, 0xF2DD3E00U, 0xF18BBC00U, 0x72826B00U, 0xF726B800U, 0x742F6F00U, 0x7779ED00U, 0xF4703A00U,
+        0xFA7CB000U, 0x79756700U, 0x7A23E500U, 0xF92A3200U, 0x7C8EE100U, 0xFF873600U, 0xFCD1B400U, 0x7FD86300U,
+        0xE0C8A000U, 0x63C17700U, 0x6097F500U, 0xE39E2200U, 0x663AF100U, 0xE5332600U, 0xE665A400U, 0x656C7300U,
+        0x6B60F900U, 0xE8692E00U, 0xEB3FAC00U, 0x68367B00U, 0xED92A800U, 0x6E9B7F00U, 0x6DCDFD00U, 0xEEC42A00U
+    },
+    {
+        0x00000000U, 0x36095200U, 0x6C12A400U, 0x5A1BF600U, 0xD8254800U, 0xEE2C1A00U, 0xB437EC00U, 0x823EBE00U,
+        0x36066B00U, 0x000F3900U, 0x5A14CF00U, 0x6C1D9D00U, 0xEE232300U, 0xD82A7100U, 0x82318700U, 0xB438D500U,
+        0x6C0CD600U, 0x5A058400U, 0x001E7200U, 0x36172000U, 0xB4299E00U, 0x8220CC00U, 0xD83B3A00U, 0xEE326800U,
+        0x5A0ABD00U, 0x6C03EF00U, 0x36181900U, 0x00114B00U, 0x822FF500U, 0xB426A700U, 0xEE3D5100U, 0xD8340300U,
+        0xD819AC00U, 0xEE10FE00U, 0xB40B0800U, 0x82025A00U, 0x003CE400U, 0x3635B600U, 0x6C2E4000U, 0x5A271200U,
+        0xEE1FC700U, 0xD8169500U, 0x820D6300U, 0xB4043100U, 0x363A8F00U, 0x0033DD00U, 0x5A282B00U, 0x6C217900U,
+        0xB4157A00U, 0x821C2800U, 0xD807DE00U, 0xEE0E8C00U, 0x6C303200U, 0x5A396000U, 0x00229600U, 0x362BC400U,
+        0x82131100U, 0xB41A4300U, 0xEE01B500U, 0xD808E700U, 0x5A365900U, 0x6C3F0B00U, 0x3624FD00U, 0x002DAF00U,
+        0x367FA300U, 0x0076F100U, 0x5A6D0700U, 0x6C645500U, 0xEE5AEB00U, 0xD853B900U, 0x82484F00U, 0xB4411D00U,
+        0x0079C800U, 0x36709A00U, 0x6C6B6C00U, 0x5A623E00U, 0xD85C8000U, 0xEE55D200U, 0xB44E2400U, 0x82477600U,
+        0x5A737500U, 0x6C7A2700U, 0x3661D100U, 0x00688300U, 0x82563D00U, 0xB45F6F00U, 0xEE449900U, 0xD84DCB00U,
+        0x6C751E00U, 0x5A7C4C00U, 0x0067BA00U, 0x366EE800U, 0xB4505600U, 0x82590400U, 0xD842F200U, 0xEE4BA000U,
+        0xEE660F00U, 0xD86F5D00U, 0x8274AB00U, 0xB47DF900U, 0x36434700U, 0x004A1500U, 0x5A51E300U, 0x6C58B100U,
+        0xD8606400U, 0xEE693600U, 0xB472C000U, 0x827B9200U, 0x00452C00U, 0x364C7E00U, 0x6C578800U, 0x5A5EDA00U,
+        0x826AD900U, 0xB4638B00U, 0xEE787D00U, 0xD8712F00U, 0x5A4F9100U, 0x6C46C300U, 0x365D3500U, 0x00546700U,
+        0xB46CB200U, 0x8265E000U, 0xD87E1600U, 0xEE774400U, 0x6C49FA00U, 0x5A40A800U, 0x005B5E00U, 0x36520C00U,
+        0x6CFF4600U, 0x5AF61400U, 0x00EDE200U, 0x36E4B000U, 0xB4DA0E00U, 0x82D35C00U, 0xD8C8AA00U, 0xEEC1F800U,
+        0x5AF92D00U, 0x6CF07F00U, 0x36EB8900U, 0x00E2DB00U, 0x82DC6500U, 0xB4D53700U, 0xEECEC100U, 0xD8C79300U,
+        0x00F39000U, 0x36FAC200U, 0x6CE13400U, 0x5AE86600U, 0xD8D6D800U, 0xEEDF8A00U, 0xB4C47C00U, 0x82CD2E00U,
+        0x36F5FB00U, 0x00FCA900U, 0x5AE75F00U, 0x6CEE0D00U, 0xEED0B300U, 0xD8D9E100U, 0x82C21700U, 0xB4CB4500U,
+        0xB4E6EA00U, 0x82EFB800U, 0xD8F44E00U, 0xEEFD1C00U, 0x6CC3A200U, 0x5ACAF000U, 0x00D10600U, 0x36D85400U,
+        0x82E08100U, 0xB4E9D300U, 0xEEF22500U, 0xD8FB7700U, 0x5AC5C900U, 0x6CCC9B00U, 0x36D76D00U, 0x00DE3F00U,
+        0xD8EA3C00U, 0xEEE36E00U, 0xB4F89800U, 0x82F1CA00U, 0x00CF7400U, 0x36C62600U, 0x6CDDD000U, 0x5AD48200U,
+        0xEEEC5700U, 0xD8E50500U, 0x82FEF300U, 0xB4F7A100U, 0x36C91F00U, 0x00C04D00U, 0x5ADBBB00U, 0x6CD2E900U,
+        0x5A80E500U, 0x6C89B700U, 0x36924100U, 0x009B1300U, 0x82A5AD00U, 0xB4ACFF00U, 0xEEB70900U, 0xD8BE5B00U,
+        0x6C868E00U, 0x5A8FDC00U, 0x00942A00U, 0x369D7800U, 0xB4A3C600U, 0x82AA9400U, 0xD8B16200U, 0xEEB83000U,
+        0x368C3300U, 0x00856100U, 0x5A9E9700U, 0x6C97C500U, 0xEEA97B00U, 0xD8A02900U, 0x82BBDF00U, 0xB4B28D00U,
+        0x008A5800U, 0x36830A00U, 0x6C98FC00U, 0x5A91AE00U, 0xD8AF1000U, 0xEEA64200U, 0xB4BDB400U, 0x82B4E600U,
+        0x82994900U, 0xB4901B00U, 0xEE8BED00U, 0xD882BF00U, 0x5ABC0100U, 0x6CB55300U, 0x36AEA500U, 0x00A7F700U,
+        0xB49F2200U, 0x82967000U, 0xD88D8600U, 0xEE84D400U, 0x6CBA6A00U, 0x5AB33800U, 0x00A8CE00U, 0x36A19C00U,
+        0xEE959F00U, 0xD89CCD00U, 0x82873B00U, 0xB48E6900U, 0x36B0D700U, 0x00B98500U, 0x5AA27300U, 0x6CAB2100U,
+        0xD893F400U, 0xEE9AA600U, 0xB4815000U, 0x82880200U, 0x00B6BC00U, 0x36BFEE00U, 0x6CA41800U, 0x5AAD4A00U
+    },
+# if U_SPARTN_CRC_SLICE_BY > 4
+    {
+        0x00000000U, 0xD9FE8C00U, 0x35B1E300U, 0xEC4F6F00U, 0x6B63C600U, 0xB29D4A00U, 0x5ED22500U, 0x872CA900U,
+        0xD6C78C00U, 0x0F390000U, 0xE3766F00U, 0x3A88E300U, 0xBDA44A00U, 0x645AC600U, 0x8815A900U, 0x51EB2500U,
+        0x2BC3E300U, 0xF23D6F00U, 0x1E720000U, 0xC78C8C00U, 0x40A02500U, 0x995EA900U, 0x7511C600U, 0xACEF4A00U,
+        0xFD046F00U, 0x24FAE300U, 0xC8B58C00U, 0x114B0000U, 0x9667A900U, 0x4F992500U, 0xA3D64A00U, 0x7A28C600U,
+        0x5787C600U, 0x8E794A00U, 0x62362500U, 0xBBC8A900U, 0x3CE40000U, 0xE51A8C00U, 0x0955E300U, 0xD0AB6F00U,
+        0x81404A00U, 0x58BEC600U, 0xB4F1A900U, 0x6D0F2500U, 0xEA238C00U, 0x33DD0000U, 0xDF926F00U, 0x066CE300U,
+        0x7C442500U, 0xA5BAA900U, 0x49F5C600U, 0x900B4A00U, 0x1727E300U, 0xCED96F00U, 0x22960000U, 0xFB688C00U,
+        0xAA83A900U, 0x737D2500U, 0x9F324A00U, 0x46CCC600U, 0xC1E06F00U, 0x181EE300U, 0xF4518C00U, 0x2DAF0000U,
+        0xAF0F8C00U, 0x76F10000U, 0x9ABE6F00U, 0x4340E300U, 0xC46C4A00U, 0x1D92C600U, 0xF1DDA900U, 0x28232500U,
+        0x79C80000U, 0xA0368C00U, 0x4C79E300U, 0x95876F00U, 0x12ABC600U, 0xCB554A00U, 0x271A2500U, 0xFEE4A900U,
+        0x84CC6F00U, 0x5D32E300U, 0xB17D8C00U, 0x68830000U, 0xEFAFA900U, 0x36512500U, 0xDA1E4A00U, 0x03E0C600U,
+        0x520BE300U, 0x8BF56F00U, 0x67BA0000U, 0xBE448C00U, 0x39682500U, 0xE096A900U, 0x0CD9C600U, 0xD5274A00U,
+        0xF8884A00U, 0x2176C600U, 0xCD39A900U, 0x14C72500U, 0x93EB8C00U, 0x4A150000U, 0xA65A6F00U, 0x7FA4E300U,
+        0x2E4FC600U, 0xF7B14A00U, 0x1BFE2500U, 0xC200A900U, 0x452C0000U, 0x9CD28C00U, 0x709DE300U, 0xA9636F00U,
+        0xD34BA900U, 0x0AB52500U, 0xE6FA4A00U, 0x3F04C600U, 0xB8286F00U, 0x61D6E300U, 0x8D998C00U, 0x54670000U,
+        0x058C2500U, 0xDC72A900U, 0x303DC600U, 0xE9C34A00U, 0x6EEFE300U, 0xB7116F00U, 0x5B5E0000U, 0x82A08C00U,
+        0xD853E300U, 0x01AD6F00U, 0xEDE20000U, 0x341C8C00U, 0xB3302500U, 0x6ACEA900U, 0x8681C600U, 0x5F7F4A00U,
+        0x0E946F00U, 0xD76AE300U, 0x3B258C00U, 0xE2DB0000U, 0x65F7A900U, 0xBC092500U, 0x50464A00U, 0x89B8C600U,
+        0xF3900000U, 0x2A6E8C00U, 0xC621E300U, 0x1FDF6F00U, 0x98F3C600U, 0x410D4A00U, 0xAD422500U, 0x74BCA900U,
+        0x25578C00U, 0xFCA90000U, 0x10E66F00U, 0xC918E300U, 0x4E344A00U, 0x97CAC600U, 0x7B85A900U, 0xA27B2500U,
+        0x8FD42500U, 0x562AA900U, 0xBA65C600U, 0x639B4A00U, 0xE4B7E300U, 0x3D496F00U, 0xD1060000U, 0x08F88C00U,
+        0x5913A900U, 0x80ED2500U, 0x6CA24A00U, 0xB55CC600U, 0x32706F00U, 0xEB8EE300U, 0x07C18C00U, 0xDE3F0000U,
+        0xA417C600U, 0x7DE94A00U, 0x91A62500U, 0x4858A900U, 0xCF740000U, 0x168A8C00U, 0xFAC5E300U, 0x233B6F00U,
+        0x72D04A00U, 0xAB2EC600U, 0x4761A900U, 0x9E9F2500U, 0x19B38C00U, 0xC04D0000U, 0x2C026F00U, 0xF5FCE300U,
+        0x775C6F00U, 0xAEA2E300U, 0x42ED8C00U, 0x9B130000U, 0x1C3FA900U, 0xC5C12500U, 0x298E4A00U, 0xF070C600U,
+        0xA19BE300U, 0x78656F00U, 0x942A0000U, 0x4DD48C00U, 0xCAF82500U, 0x1306A900U, 0xFF49C600U, 0x26B74A00U,
+        0x5C9F8C00U, 0x85610000U, 0x692E6F00U, 0xB0D0E300U, 0x37FC4A00U, 0xEE02C600U, 0x024DA900U, 0xDBB32500U,
+        0x8A580000U, 0x53A68C00U, 0xBFE9E300U, 0x66176F00U, 0xE13BC600U, 0x38C54A00U, 0xD48A2500U, 0x0D74A900U,
+        0x20DBA900U, 0xF9252500U, 0x156A4A00U, 0xCC94C600U, 0x4BB86F00U, 0x9246E300U, 0x7E098C00U, 0xA7F70000U,
+        0xF61C2500U, 0x2FE2A900U, 0xC3ADC600U, 0x1A534A00U, 0x9D7FE300U, 0x44816F00U, 0xA8CE0000U, 0x71308C00U,
+        0x0B184A00U, 0xD2E6C600U, 0x3EA9A900U, 0xE7572500U, 0x607B8C00U, 0xB9850000U, 0x55CA6F00U, 0x8C34E300U,
+        0xDDDFC600U, 0x04214A00U, 0xE86E2500U, 0x3190A900U, 0xB6BC0000U, 0x6F428C00U, 0x830DE300U, 0x5AF36F00U
+    },
+    {
+        0x00000000U, 0x36EB3D00U, 0x6DD67A00U, 0x5B3D4700U, 0xDBACF400U, 0xED47C900U, 0xB67A8E00U, 0x8091B300U,
+        0x31151300U, 0x07FE2E00U, 0x5CC36900U, 0x6A285400U, 0xEAB9E700U, 0xDC52DA00U, 0x876F9D00U, 0xB184A000U,
+        0x622A2600U, 0x54C11B00U, 0x0FFC5C00U, 0x39176100U, 0xB986D200U, 0x8F6DEF00U, 0xD450A800U, 0xE2BB9500U,
+        0x533F3500U, 0x65D40800U, 0x3EE94F00U, 0x08027200U, 0x8893C100U, 0xBE78FC00U, 0xE545BB00U, 0xD3AE8600U,
+        0xC4544C00U, 0xF2BF7100U, 0xA9823600U, 0x9F690B00U, 0x1FF8B800U, 0x29138500U, 0x722EC200U, 0x44C5FF00U,
+        0xF5415F00U, 0xC3AA6200U, 0x98972500U, 0xAE7C1800U, 0x2EEDAB00U, 0x18069600U, 0x433BD100U, 0x75D0EC00U,
+        0xA67E6A00U, 0x90955700U, 0xCBA81000U, 0xFD432D00U, 0x7DD29E00U, 0x4B39A300U, 0x1004E400U, 0x26EFD900U,
+        0x976B7900U, 0xA1804400U, 0xFABD0300U, 0xCC563E00U, 0x4CC78D00U, 0x7A2CB000U, 0x2111F700U, 0x17FACA00U,
+        0x0EE46300U, 0x380F5E00U, 0x63321900U, 0x55D92400U, 0xD5489700U, 0xE3A3AA00U, 0xB89EED00U, 0x8E75D000U,
+        0x3FF17000U, 0x091A4D00U, 0x52270A00U, 0x64CC3700U, 0xE45D8400U, 0xD2B6B900U, 0x898BFE00U, 0xBF60C300U,
+        0x6CCE4500U, 0x5A257800U, 0x01183F00U, 0x37F30200U, 0xB762B100U, 0x81898C00U, 0xDAB4CB00U, 0xEC5FF600U,
+        0x5DDB5600U, 0x6B306B00U, 0x300D2C00U, 0x06E61100U, 0x8677A200U, 0xB09C9F00U, 0xEBA1D800U, 0xDD4AE500U,
+        0xCAB02F00U, 0xFC5B1200U, 0xA7665500U, 0x918D6800U, 0x111CDB00U, 0x27F7E600U, 0x7CCAA100U, 0x4A219C00U,
+        0xFBA53C00U, 0xCD4E0100U, 0x96734600U, 0xA0987B00U, 0x2009C800U, 0x16E2F500U, 0x4DDFB200U, 0x7B348F00U,
+        0xA89A0900U, 0x9E713400U, 0xC54C7300U, 0xF3A74E00U, 0x7336FD00U, 0x45DDC000U, 0x1EE08700U, 0x280BBA00U,
+        0x998F1A00U, 0xAF642700U, 0xF4596000U, 0xC2B25D00U, 0x4223EE00U, 0x74C8D300U, 0x2FF59400U, 0x191EA900U,
+        0x1DC8C600U, 0x2B23FB00U, 0x701EBC00U, 0x46F58100U, 0xC6643200U, 0xF08F0F00U, 0xABB24800U, 0x9D597500U,
+        0x2CDDD500U, 0x1A36E800U, 0x410BAF00U, 0x77E09200U, 0xF7712100U, 0xC19A1C00U, 0x9AA75B00U, 0xAC4C6600U,
+        0x7FE2E000U, 0x4909DD00U, 0x12349A00U, 0x24DFA700U, 0xA44E1400U, 0x92A52900U, 0xC9986E00U, 0xFF735300U,
+        0x4EF7F300U, 0x781CCE00U, 0x23218900U, 0x15CAB400U, 0x955B0700U, 0xA3B03A00U, 0xF88D7D00U, 0xCE664000U,
+        0xD99C8A00U, 0xEF77B700U, 0xB44AF000U, 0x82A1CD00U, 0x02307E00U, 0x34DB4300U, 0x6FE60400U, 0x590D3900U,
+        0xE8899900U, 0xDE62A400U, 0x855FE300U, 0xB3B4DE00U, 0x33256D00U, 0x05CE5000U, 0x5EF31700U, 0x68182A00U,
+        0xBBB6AC00U, 0x8D5D9100U, 0xD660D600U, 0xE08BEB00U, 0x601A5800U, 0x56F16500U, 0x0DCC2200U, 0x3B271F00U,
+        0x8AA3BF00U, 0xBC488200U, 0xE775C500U, 0xD19EF800U, 0x510F4B00U, 0x67E47600U, 0x3CD93100U, 0x0A320C00U,
+        0x132CA500U, 0x25C79800U, 0x7EFADF00U, 0x4811E200U, 0xC8805100U, 0xFE6B6C00U, 0xA5562B00U, 0x93BD1600U,
+        0x2239B600U, 0x14D28B00U, 0x4FEFCC00U, 0x7904F100U, 0xF9954200U, 0xCF7E7F00U, 0x94433800U, 0xA2A80500U,
+        0x71068300U, 0x47EDBE00U, 0x1CD0F900U, 0x2A3BC400U, 0xAAAA7700U, 0x9C414A00U, 0xC77C0D00U, 0xF1973000U,
+        0x40139000U, 0x76F8AD00U, 0x2DC5EA00U, 0x1B2ED700U, 0x9BBF6400U, 0xAD545900U, 0xF6691E00U, 0xC0822300U,
+        0xD778E900U, 0xE193D400U, 0xBAAE9300U, 0x8C45AE00U, 0x0CD41D00U, 0x3A3F2000U, 0x61026700U, 0x57E95A00U,
+        0xE66DFA00U, 0xD086C700U, 0x8BBB8000U, 0xBD50BD00U, 0x3DC10E00U, 0x0B2A3300U, 0x50177400U, 0x66FC4900U,
+        0xB552CF00U, 0x83B9F200U, 0xD884B500U, 0xEE6F8800U, 0x6EFE3B00U, 0x58150600U, 0x03284100U, 0x35C37C00U,
+        0x8447DC00U, 0xB2ACE100U, 0xE991A600U, 0xDF7A9B00U, 0x5FEB2800U, 0x69001500U, 0x323D5200U, 0x04D66F00U
+    },
+    {
+        0x00000000U, 0x3B918C00U, 0x77231800U, 0x4CB29400U, 0xEE463000U, 0xD5D7BC00U, 0x99652800U, 0xA2F4A400U,
+        0x5AC09B00U, 0x61511700U, 0x2DE38300U, 0x16720F00U, 0xB486AB00U, 0x8F172700U, 0xC3A5B300U, 0xF8343F00U,
+        0xB5813600U, 0x8E10BA00U, 0xC2A22E00U, 0xF933A200U, 0x5BC70600U, 0x60568A00U, 0x2CE41E00U, 0x17759200U,
+        0xEF41AD00U, 0xD4D02100U, 0x9862B500U, 0xA3F33900U, 0x01079D00U, 0x3A961100U, 0x76248500U, 0x4DB50900U,
+        0xED4E9700U, 0xD6DF1B00U, 0x9A6D8F00U, 0xA1FC0300U, 0x0308A700U, 0x38992B00U, 0x742BBF00U, 0x4FBA3300U,
+        0xB78E0C00U, 0x8C1F8000U, 0xC0AD1400U, 0xFB3C9800U, 0x59C83C00U, 0x6259B000U, 0x2EEB2400U, 0x157AA800U,
+        0x58CFA100U, 0x635E2D00U, 0x2FECB900U, 0x147D3500U, 0xB6899100U, 0x8D181D00U, 0xC1AA8900U, 0xFA3B0500U,
+        0x020F3A00U, 0x399EB600U, 0x752C2200U, 0x4EBDAE00U, 0xEC490A00U, 0xD7D88600U, 0x9B6A1200U, 0xA0FB9E00U,
+        0x5CD1D500U, 0x67405900U, 0x2BF2CD00U, 0x10634100U, 0xB297E500U, 0x89066900U, 0xC5B4FD00U, 0xFE257100U,
+        0x06114E00U, 0x3D80C200U, 0x71325600U, 0x4AA3DA00U, 0xE8577E00U, 0xD3C6F200U, 0x9F746600U, 0xA4E5EA00U,
+        0xE950E300U, 0xD2C16F00U, 0x9E73FB00U, 0xA5E27700U, 0x0716D300U, 0x3C875F00U, 0x7035CB00U, 0x4BA44700U,
+        0xB3907800U, 0x8801F400U, 0xC4B36000U, 0xFF22EC00U, 0x5DD64800U, 0x6647C400U, 0x2AF55000U, 0x1164DC00U,
+        0xB19F4200U, 0x8A0ECE00U, 0xC6BC5A00U, 0xFD2DD600U, 0x5FD97200U, 0x6448FE00U, 0x28FA6A00U, 0x136BE600U,
+        0xEB5FD900U, 0xD0CE5500U, 0x9C7CC100U, 0xA7ED4D00U, 0x0519E900U, 0x3E886500U, 0x723AF100U, 0x49AB7D00U,
+        0x041E7400U, 0x3F8FF800U, 0x733D6C00U, 0x48ACE000U, 0xEA584400U, 0xD1C9C800U, 0x9D7B5C00U, 0xA6EAD000U,
+        0x5EDEEF00U, 0x654F6300U, 0x29FDF700U, 0x126C7B00U, 0xB098DF00U, 0x8B095300U, 0xC7BBC700U, 0xFC2A4B00U,
+        0xB9A3AA00U, 0x82322600U, 0xCE80B200U, 0xF5113E00U, 0x57E59A00U, 0x6C741600U, 0x20C68200U, 0x1B570E00U,
+        0xE3633100U, 0xD8F2BD00U, 0x94402900U, 0xAFD1A500U, 0x0D250100U, 0x36B48D00U, 0x7A061900U, 0x41979500U,
+        0x0C229C00U, 0x37B31000U, 0x7B018400U, 0x40900800U, 0xE264AC00U, 0xD9F52000U, 0x9547B400U, 0xAED63800U,
+        0x56E20700U, 0x6D738B00U, 0x21C11F00U, 0x1A509300U, 0xB8A43700U, 0x8335BB00U, 0xCF872F00U, 0xF416A300U,
+        0x54ED3D00U, 0x6F7CB100U, 0x23CE2500U, 0x185FA900U, 0xBAAB0D00U, 0x813A8100U, 0xCD881500U, 0xF6199900U,
+        0x0E2DA600U, 0x35BC2A00U, 0x790EBE00U, 0x429F3200U, 0xE06B9600U, 0xDBFA1A00U, 0x97488E00U, 0xACD90200U,
+        0xE16C0B00U, 0xDAFD8700U, 0x964F1300U, 0xADDE9F00U, 0x0F2A3B00U, 0x34BBB700U, 0x78092300U, 0x4398AF00U,
+        0xBBAC9000U, 0x803D1C00U, 0xCC8F8800U, 0xF71E0400U, 0x55EAA000U, 0x6E7B2C00U, 0x22C9B800U, 0x19583400U,
+        0xE5727F00U, 0xDEE3F300U, 0x92516700U, 0xA9C0EB00U, 0x0B344F00U, 0x30A5C300U, 0x7C175700U, 0x4786DB00U,
+        0xBFB2E400U, 0x84236800U, 0xC891FC00U, 0xF3007000U, 0x51F4D400U, 0x6A655800U, 0x26D7CC00U, 0x1D464000U,
+        0x50F34900U, 0x6B62C500U, 0x27D05100U, 0x1C41DD00U, 0xBEB57900U, 0x8524F500U, 0xC9966100U, 0xF207ED00U,
+        0x0A33D200U, 0x31A25E00U, 0x7D10CA00U, 0x46814600U, 0xE475E200U, 0xDFE46E00U, 0x9356FA00U, 0xA8C77600U,
+        0x083CE800U, 0x33AD6400U, 0x7F1FF000U, 0x448E7C00U, 0xE67AD800U, 0xDDEB5400U, 0x9159C000U, 0xAAC84C00U,
+        0x52FC7300U, 0x696DFF00U, 0x25DF6B00U, 0x1E4EE700U, 0xBCBA4300U, 0x872BCF00U, 0xCB995B00U, 0xF008D700U,
+        0xBDBDDE00U, 0x862C5200U, 0xCA9EC600U, 0xF10F4A00U, 0x53FBEE00U, 0x686A6200U, 0x24D8F600U, 0x1F497A00U,
+        0xE77D4500U, 0xDCECC900U, 0x905E5D00U, 0xABCFD100U, 0x093B7500U, 0x32AAF900U, 0x7E186D00U, 0x4589E100U
+    },
+    {
+        0x00000000U, 0xF50BAF00U, 0x6C5BA500U, 0x99500A00U, 0xD8B74A00U, 0x2DBCE500U, 0xB4ECEF00U, 0x41E74000U,
+        0x37226F00U, 0xC229C000U, 0x5B79CA00U, 0xAE726500U, 0xEF952500U, 0x1A9E8A00U, 0x83CE8000U, 0x76C52F00U,
+        0x6E44DE00U, 0x9B4F7100U, 0x021F7B00U, 0xF714D400U, 0xB6F39400U, 0x43F83B00U, 0xDAA83100U, 0x2FA39E00U,
+        0x5966B100U, 0xAC6D1E00U, 0x353D1400U, 0xC036BB00U, 0x81D1FB00U, 0x74DA5400U, 0xED8A5E00U, 0x1881F100U,
+        0xDC89BC00U, 0x29821300U, 0xB0D21900U, 0x45D9B600U, 0x043EF600U, 0xF1355900U, 0x68655300U, 0x9D6EFC00U,
+        0xEBABD300U, 0x1EA07C00U, 0x87F07600U, 0x72FBD900U, 0x331C9900U, 0xC6173600U, 0x5F473C00U, 0xAA4C9300U,
+        0xB2CD6200U, 0x47C6CD00U, 0xDE96C700U, 0x2B9D6800U, 0x6A7A2800U, 0x9F718700U, 0x06218D00U, 0xF32A2200U,
+        0x85EF0D00U, 0x70E4A200U, 0xE9B4A800U, 0x1CBF0700U, 0x5D584700U, 0xA853E800U, 0x3103E200U, 0xC4084D00U,
+        0x3F5F8300U, 0xCA542C00U, 0x53042600U, 0xA60F8900U, 0xE7E8C900U, 0x12E36600U, 0x8BB36C00U, 0x7EB8C300U,
+        0x087DEC00U, 0xFD764300U, 0x64264900U, 0x912DE600U, 0xD0CAA600U, 0x25C10900U, 0xBC910300U, 0x499AAC00U,
+        0x511B5D00U, 0xA410F200U, 0x3D40F800U, 0xC84B5700U, 0x89AC1700U, 0x7CA7B800U, 0xE5F7B200U, 0x10FC1D00U,
+        0x66393200U, 0x93329D00U, 0x0A629700U, 0xFF693800U, 0xBE8E7800U, 0x4B85D700U, 0xD2D5DD00U, 0x27DE7200U,
+        0xE3D63F00U, 0x16DD9000U, 0x8F8D9A00U, 0x7A863500U, 0x3B617500U, 0xCE6ADA00U, 0x573AD000U, 0xA2317F00U,
+        0xD4F45000U, 0x21FFFF00U, 0xB8AFF500U, 0x4DA45A00U, 0x0C431A00U, 0xF948B500U, 0x6018BF00U, 0x95131000U,
+        0x8D92E100U, 0x78994E00U, 0xE1C94400U, 0x14C2EB00U, 0x5525AB00U, 0xA02E0400U, 0x397E0E00U, 0xCC75A100U,
+        0xBAB08E00U, 0x4FBB2100U, 0xD6EB2B00U, 0x23E08400U, 0x6207C400U, 0x970C6B00U, 0x0E5C6100U, 0xFB57CE00U,
+        0x7EBF0600U, 0x8BB4A900U, 0x12E4A300U, 0xE7EF0C00U, 0xA6084C00U, 0x5303E300U, 0xCA53E900U, 0x3F584600U,
+        0x499D6900U, 0xBC96C600U, 0x25C6CC00U, 0xD0CD6300U, 0x912A2300U, 0x64218C00U, 0xFD718600U, 0x087A2900U,
+        0x10FBD800U, 0xE5F07700U, 0x7CA07D00U, 0x89ABD200U, 0xC84C9200U, 0x3D473D00U, 0xA4173700U, 0x511C9800U,
+        0x27D9B700U, 0xD2D21800U, 0x4B821200U, 0xBE89BD00U, 0xFF6EFD00U, 0x0A655200U, 0x93355800U, 0x663EF700U,
+        0xA236BA00U, 0x573D1500U, 0xCE6D1F00U, 0x3B66B000U, 0x7A81F000U, 0x8F8A5F00U, 0x16DA5500U, 0xE3D1FA00U,
+        0x9514D500U, 0x601F7A00U, 0xF94F7000U, 0x0C44DF00U, 0x4DA39F00U, 0xB8A83000U, 0x21F83A00U, 0xD4F39500U,
+        0xCC726400U, 0x3979CB00U, 0xA029C100U, 0x55226E00U, 0x14C52E00U, 0xE1CE8100U, 0x789E8B00U, 0x8D952400U,
+        0xFB500B00U, 0x0E5BA400U, 0x970BAE00U, 0x62000100U, 0x23E74100U, 0xD6ECEE00U, 0x4FBCE400U, 0xBAB74B00U,
+        0x41E08500U, 0xB4EB2A00U, 0x2DBB2000U, 0xD8B08F00U, 0x9957CF00U, 0x6C5C6000U, 0xF50C6A00U, 0x0007C500U,
+        0x76C2EA00U, 0x83C94500U, 0x1A994F00U, 0xEF92E000U, 0xAE75A000U, 0x5B7E0F00U, 0xC22E0500U, 0x3725AA00U,
+        0x2FA45B00U, 0xDAAFF400U, 0x43FFFE00U, 0xB6F45100U, 0xF7131100U, 0x0218BE00U, 0x9B48B400U, 0x6E431B00U,
+        0x18863400U, 0xED8D9B00U, 0x74DD9100U, 0x81D63E00U, 0xC0317E00U, 0x353AD100U, 0xAC6ADB00U, 0x59617400U,
+        0x9D693900U, 0x68629600U, 0xF1329C00U, 0x04393300U, 0x45DE7300U, 0xB0D5DC00U, 0x2985D600U, 0xDC8E7900U,
+        0xAA4B5600U, 0x5F40F900U, 0xC610F300U, 0x331B5C00U, 0x72FC1C00U, 0x87F7B300U, 0x1EA7B900U, 0xEBAC1600U,
+        0xF32DE700U, 0x06264800U, 0x9F764200U, 0x6A7DED00U, 0x2B9AAD00U, 0xDE910200U, 0x47C10800U, 0xB2CAA700U,
+        0xC40F8800U, 0x31042700U, 0xA8542D00U, 0x5D5F8200U, 0x1CB8C200U, 0xE9B36D00U, 0x70E36700U, 0x85E8C800U
+    }
+# endif
+};
+
+#endif // #if U_SPARTN_CRC_SLICE_BY > 1
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS
- * -------------------------------------------------------------- */
+#if U_SPARTN_CRC_SLICE_BY > 1
 
-uint8_t uSpartnCrc4(const char *pData, size_t size)
+// Continue an MSB-first CRC calculation with 32-bit arithmetic,
+// U_SPARTN_CRC_SLICE_BY bytes at a time while there are that many:
+// pTable0 is the byte-wise table, shifted up by shift0 bits when
+// used, pSliceTable the rest of the tables.
+static uint32_t sliceUpdate(const uint32_t *pTable0, int32_t shift0,
+                            const uint32_t (*pSliceTable)[256],
+                            uint32_t u32Remainder,
+                            const char *pData, size_t size)
 {
-    // Initialize local variables
-    uint8_t u8TableRemainder;
-    uint8_t u8Remainder = 0; // Initial remainder
-    const uint8_t *pU8Msg = (uint8_t *) pData;
-
-    // Compute the CRC value
-    // Divide each byte of the message by the corresponding polynomial
-    for (size_t x = 0; x < size; x++) {
-        u8TableRemainder = pU8Msg[x] ^ u8Remainder;
-        u8Remainder = u8Crc4Table[u8TableRemainder];
+    const uint8_t *pU8Msg = (const uint8_t *) pData;
+    uint32_t x;
+# if U_SPARTN_CRC_SLICE_BY > 4
+    uint32_t y;
+# endif
+
+    while (size >= U_SPARTN_CRC_SLICE_BY) {
+        x = u32Remainder ^ ((((uint32_t) pU8Msg[0]) << 24) | (((uint32_t) pU8Msg[1]) << 16) |
+                            (((uint32_t) pU8Msg[2]) << 8) | ((uint32_t) pU8Msg[3]));
+# if U_SPARTN_CRC_SLICE_BY > 4
+        y = (((uint32_t) pU8Msg[4]) << 24) | (((uint32_t) pU8Msg[5]) << 16) |
+            (((uint32_t) pU8Msg[6]) << 8) | ((uint32_t) pU8Msg[7]);
+        u32Remainder = pSliceTable[6][x >> 24] ^ pSliceTable[5][(x >> 16) & 0xFF] ^
+                       pSliceTable[4][(x >> 8) & 0xFF] ^ pSliceTable[3][x & 0xFF] ^
+                       pSliceTable[2][y >> 24] ^ pSliceTable[1][(y >> 16) & 0xFF] ^
+                       pSliceTable[0][(y >> 8) & 0xFF] ^ (pTable0[y & 0xFF] << shift0);
+# else
+        u32Remainder = pSliceTable[2][x >> 24] ^ pSliceTable[1][(x >> 16) & 0xFF] ^
+                       pSliceTable[0][(x >> 8) & 0xFF] ^ (pTable0[x & 0xFF] << shift0);
+# endif
+        pU8Msg += U_SPARTN_CRC_SLICE_BY;
+        size -= U_SPARTN_CRC_SLICE_BY;
+    }
+    // The remainder a byte at a time
+    for (size_t z = 0; z < size; z++) {
+        u32Remainder = (pTable0[pU8Msg[z] ^ (u32Remainder >> 24)] << shift0) ^ (u32Remainder << 8);
     }
 
-    return u8Remainder;
+    return u32Remainder;
 }
 
-uint8_t uSpartnCrc8(const char *pData, size_t size)
+#endif // #if U_SPARTN_CRC_SLICE_BY > 1
+
+// Continue a CRC8 calculation.
+static uint8_t crc8Update(uint8_t u8Remainder, const char *pData, size_t size)
 {
-    // Initialize local variables
+#ifdef U_SPARTN_CRC_HW
+    return uSpartnCrcHw8(u8Remainder, pData, size);
+#else
     uint8_t u8TableRemainder;
-    uint8_t u8Remainder = 0; // Initial remainder
-    const uint8_t *pU8Msg = (uint8_t *) pData;
+    const uint8_t *pU8Msg = (const uint8_t *) pData;
 
-    // Compute the CRC value
     // Divide each byte of the message by the corresponding polynomial
     for (size_t x = 0; x < size; x++) {
         u8TableRemainder = pU8Msg[x] ^ u8Remainder;
@@ -262,17 +801,19 @@ uint8_t uSpartnCrc8(const char *pData, size_t size)
     }
 
     return u8Remainder;
+#endif
 }
 
-uint16_t uSpartnCrc16(const char *pData, size_t size)
+// Continue a CRC16 calculation.
+static uint16_t crc16Update(uint16_t u16Remainder, const char *pData, size_t size)
 {
-    // Initialize local variables
+#ifdef U_SPARTN_CRC_HW
+    return uSpartnCrcHw16(u16Remainder, pData, size);
+#else
     uint16_t u16TableRemainder;
-    uint16_t u16Remainder = 0; // Initial remainder
     uint8_t  u8NumBitsInCrc = (8 * sizeof(uint16_t));
-    const uint8_t  *pU8Msg = (uint8_t *) pData;
+    const uint8_t  *pU8Msg = (const uint8_t *) pData;
 
-    // Compute the CRC value
     // Divide each byte of the message by the corresponding polynomial
     for (size_t x = 0; x < size; x++) {
         u16TableRemainder = pU8Msg[x] ^ (u16Remainder >> (u8NumBitsInCrc - 8));
@@ -280,17 +821,21 @@ uint16_t uSpartnCrc16(const char *pData, size_t size)
     }
 
     return u16Remainder;
+#endif
 }
 
-uint32_t uSpartnCrc24(const char *pData, size_t size)
+// Continue a CRC24 calculation.
+static uint32_t crc24Update(uint32_t u32Remainder, const char *pData, size_t size)
 {
-    // Initialize local variables
+#if U_SPARTN_CRC_SLICE_BY > 1
+    // Work on the remainder in the top 24 bits of 32
+    return sliceUpdate(u32Crc24Table, 8, u32Crc24SliceTable,
+                       u32Remainder << 8, pData, size) >> 8;
+#else
     uint32_t u32TableRemainder;
-    uint32_t u32Remainder = 0; // Initial remainder
     uint8_t u8NumBitsInCrc = (8 * sizeof(uint8_t) * 3);
-    const uint8_t *pU8Msg = (uint8_t *) pData;
+    const uint8_t *pU8Msg = (const uint8_t *) pData;
 
-    // Compute the CRC value
     // Divide each byte of the message by the corresponding polynomial
     for (size_t x = 0; x < size; x++) {
         u32TableRemainder = pU8Msg[x] ^ (u32Remainder >> (u8NumBitsInCrc - 8));
@@ -299,27 +844,114 @@ uint32_t uSpartnCrc24(const char *pData, size_t size)
     }
 
     return u32Remainder;
+#endif
 }
 
-uint32_t uSpartnCrc32(const char *pData, size_t size)
+// Continue a CRC32 calculation, without the final XOR.
+static uint32_t crc32Update(uint32_t u32Remainder, const char *pData, size_t size)
 {
-    // Initialize local variables
+#if defined(U_SPARTN_CRC_HW)
+    return uSpartnCrcHw32(u32Remainder, pData, size);
+#elif U_SPARTN_CRC_SLICE_BY > 1
+    return sliceUpdate(u32Crc32Table, 0, u32Crc32SliceTable,
+                       u32Remainder, pData, size);
+#else
     uint32_t u32TableRemainder;
-    uint32_t u32Remainder = 0xFFFFFFFFU; // Initial remainder
     uint8_t u8NumBitsInCrc = (8 * sizeof(uint32_t));
-    uint32_t u32FinalXORValue = 0xFFFFFFFFU;
-    const uint8_t *pU8Msg = (uint8_t *) pData;
+    const uint8_t *pU8Msg = (const uint8_t *) pData;
 
-    // Compute the CRC value
     // Divide each byte of the message by the corresponding polynomial
     for (size_t x = 0; x < size; x++) {
         u32TableRemainder = pU8Msg[x] ^ (u32Remainder >> (u8NumBitsInCrc - 8));
         u32Remainder = u32Crc32Table[u32TableRemainder] ^ (u32Remainder << 8);
     }
 
-    u32Remainder = u32Remainder ^ u32FinalXORValue;
-
     return u32Remainder;
+#endif
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+uint8_t uSpartnCrc4(const char *pData, size_t size)
+{
+    // Initialize local variables
+    uint8_t u8TableRemainder;
+    uint8_t u8Remainder = 0; // Initial remainder
+    const uint8_t *pU8Msg = (uint8_t *) pData;
+
+    // Compute the CRC value
+    // Divide each byte of the message by the corresponding polynomial
+    for (size_t x = 0; x < size; x++) {
+        u8TableRemainder = pU8Msg[x] ^ u8Remainder;
+        u8Remainder = u8Crc4Table[u8TableRemainder];
+    }
+
+    return u8Remainder;
+}
+
+uint8_t uSpartnCrc8(const char *pData, size_t size)
+{
+    return crc8Update(0, pData, size);
+}
+
+uint16_t uSpartnCrc16(const char *pData, size_t size)
+{
+    return crc16Update(0, pData, size);
+}
+
+uint32_t uSpartnCrc24(const char *pData, size_t size)
+{
+    return crc24Update(0, pData, size);
+}
+
+uint32_t uSpartnCrc32(const char *pData, size_t size)
+{
+    return crc32Update(0xFFFFFFFFU, pData, size) ^ 0xFFFFFFFFU;
+}
+
+uint32_t uSpartnCrcStart(uSpartnCrcType_t crcType)
+{
+    uint32_t remainder = 0;
+
+    if (crcType == U_SPARTN_CRC_TYPE_32) {
+        remainder = 0xFFFFFFFFU;
+    }
+
+    return remainder;
+}
+
+uint32_t uSpartnCrcUpdate(uSpartnCrcType_t crcType, uint32_t remainder,
+                          const char *pData, size_t size)
+{
+    switch (crcType) {
+        case U_SPARTN_CRC_TYPE_8:
+            remainder = crc8Update((uint8_t) remainder, pData, size);
+            break;
+        case U_SPARTN_CRC_TYPE_16:
+            remainder = crc16Update((uint16_t) remainder, pData, size);
+            break;
+        case U_SPARTN_CRC_TYPE_24:
+            remainder = crc24Update(remainder, pData, size);
+            break;
+        case U_SPARTN_CRC_TYPE_32:
+            remainder = crc32Update(remainder, pData, size);
+            break;
+        default:
+            break;
+    }
+
+    return remainder;
+}
+
+uint32_t uSpartnCrcFinish(uSpartnCrcType_t crcType, uint32_t remainder)
+{
+    if (crcType == U_SPARTN_CRC_TYPE_32) {
+        remainder ^= 0xFFFFFFFFU;
+    }
+
+    return remainder;
 }
 
 // End of file
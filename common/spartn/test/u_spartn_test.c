@@ -183,6 +183,10 @@ static const uSpartnTestCrc_t gCrc32Ccitt = {
  */
 static const uSpartnTestCrc_t *gpTestData[] = {&gCrc4Ccitt, &gCrc8Ccitt, &gCrc16Ccitt, &gCrc32Ccitt};
 
+/** Somewhere to put longer data to CRC, filled in by the test.
+ */
+static char gLongInput[300];
+
 #ifndef __ZEPHYR__
 
 /** A shortish valid SPARTN message.
@@ -249,6 +253,26 @@ static crc24 crc_octets(unsigned char *octets, size_t len)
     return crc & 0xFFFFFFL;
 }
 
+// A bit-wise CRC-32, polynomial 0x04C11DB7, initial value and final
+// XOR 0xFFFFFFFF, against which to check the table-driven version.
+static uint32_t crc32Bitwise(const char *pData, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (size--) {
+        crc ^= ((uint32_t) (uint8_t) *pData++) << 24;
+        for (size_t x = 0; x < 8; x++) {
+            if (crc & 0x80000000) {
+                crc = (crc << 1) ^ 0x04C11DB7;
+            } else {
+                crc <<= 1;
+            }
+        }
+    }
+
+    return ~crc;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
@@ -265,6 +289,7 @@ U_PORT_TEST_FUNCTION("[spartn]", "spartnCrc")
     const uSpartnTestCrc_t *pTestData;
     uint32_t calculated;
     uint32_t expected;
+    uint32_t seed = 1;
 
     // Whatever called us likely initialised the
     // port so deinitialise it here to obtain the
@@ -309,6 +334,53 @@ U_PORT_TEST_FUNCTION("[spartn]", "spartnCrc")
     U_TEST_PRINT_LINE("CRC-24: calculated 0x%08x, expected 0x%08x.", calculated, expected);
     U_PORT_TEST_ASSERT(calculated == expected);
 
+    // The message CRCs calculated in pieces must give the same answers
+    for (int32_t x = (int32_t) U_SPARTN_CRC_TYPE_8; x < (int32_t) U_SPARTN_CRC_TYPE_MAX_NUM; x++) {
+        for (size_t y = 0; y <= sizeof(gpInput); y++) {
+            calculated = uSpartnCrcStart((uSpartnCrcType_t) x);
+            calculated = uSpartnCrcUpdate((uSpartnCrcType_t) x, calculated, gpInput, y);
+            calculated = uSpartnCrcUpdate((uSpartnCrcType_t) x, calculated, gpInput + y,
+                                          sizeof(gpInput) - y);
+            calculated = uSpartnCrcFinish((uSpartnCrcType_t) x, calculated);
+            switch (x) {
+                case U_SPARTN_CRC_TYPE_8:
+                    expected = uSpartnCrc8(gpInput, sizeof(gpInput));
+                    break;
+                case U_SPARTN_CRC_TYPE_16:
+                    expected = uSpartnCrc16(gpInput, sizeof(gpInput));
+                    break;
+                case U_SPARTN_CRC_TYPE_24:
+                    expected = uSpartnCrc24(gpInput, sizeof(gpInput));
+                    break;
+                default:
+                    expected = uSpartnCrc32(gpInput, sizeof(gpInput));
+                    break;
+            }
+            U_PORT_TEST_ASSERT(calculated == expected);
+        }
+    }
+
+    // Check CRC-24 and CRC-32 over longer data at all alignments,
+    // so that the multi-byte steps of U_SPARTN_CRC_SLICE_BY, and
+    // the bytes either side of them, are exercised; the data is
+    // made with a simple LCG rather than rand(), see below
+    for (size_t x = 0; x < sizeof(gLongInput); x++) {
+        seed = (seed * 1103515245) + 12345;
+        gLongInput[x] = (char) (seed >> 16);
+    }
+    for (size_t x = 0; x < 8; x++) {
+        for (size_t y = 0; y <= sizeof(gLongInput) - x; y += 7) {
+            calculated = uSpartnCrc24(gLongInput + x, y);
+            expected = crc_octets((unsigned char *) gLongInput + x, y);
+            U_PORT_TEST_ASSERT(calculated == expected);
+            calculated = uSpartnCrc32(gLongInput + x, y);
+            expected = crc32Bitwise(gLongInput + x, y);
+            U_PORT_TEST_ASSERT(calculated == expected);
+        }
+    }
+    U_TEST_PRINT_LINE("CRC-24 and CRC-32, %d byte(s) per step, checked over %d byte(s)"
+                      " at all alignments.", U_SPARTN_CRC_SLICE_BY, sizeof(gLongInput));
+
     // Check for resource leaks
     uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
     resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
@@ -452,6 +524,126 @@ U_PORT_TEST_FUNCTION("[spartn]", "spartnMessage")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Testing of the incremental SPARTN message detector against
+ * SPARTN message data kept in u_spartn_test_data.c; not run on
+ * Zephyr for the same reason as spartnMessage.
+ */
+U_PORT_TEST_FUNCTION("[spartn]", "spartnDetector")
+{
+    int32_t resourceCount;
+    uSpartnDetector_t detector;
+    uint32_t messageCount;
+    size_t chunkLength;
+    size_t used;
+    int32_t offset;
+    int32_t messageLength;
+    const char *pChunk;
+    const char *pData;
+    const char *pExpected;
+    const char *pMessage;
+    char *pBuffer;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_TEST_PRINT_LINE("testing incremental SPARTN message detection.");
+
+    // Pass the test data in chunks of random length, from a single byte
+    // to bigger than any message, checking that each message is found
+    // where uSpartnValidate() says it is
+    for (size_t x = 0; x < 10; x++) {
+        messageCount = 0;
+        uSpartnDetectorInit(&detector);
+        pExpected = gUSpartnTestData;
+        pChunk = gUSpartnTestData;
+        while (pChunk < gUSpartnTestData + gUSpartnTestDataSize) {
+            chunkLength = (rand() % (U_SPARTN_MESSAGE_LENGTH_MAX_BYTES * 2)) + 1;
+            if (x == 0) {
+                chunkLength = 1;
+            }
+            if (pChunk + chunkLength > gUSpartnTestData + gUSpartnTestDataSize) {
+                chunkLength = gUSpartnTestData + gUSpartnTestDataSize - pChunk;
+            }
+            pData = pChunk;
+            while (pData < pChunk + chunkLength) {
+                messageLength = uSpartnDetectorFeed(&detector, pData,
+                                                    pChunk + chunkLength - pData,
+                                                    &used, &offset);
+                U_PORT_TEST_ASSERT(used > 0);
+                if (messageLength > 0) {
+                    messageCount++;
+                    U_PORT_TEST_ASSERT(uSpartnValidate(pExpected,
+                                                       gUSpartnTestData + gUSpartnTestDataSize - pExpected,
+                                                       &pMessage) == messageLength);
+                    U_PORT_TEST_ASSERT(pData + offset == pMessage);
+                    U_PORT_TEST_ASSERT(pData + used == pMessage + messageLength);
+                    pExpected = pMessage + messageLength;
+                } else {
+                    U_PORT_TEST_ASSERT(used == (size_t) (pChunk + chunkLength - pData));
+                }
+                pData += used;
+            }
+            pChunk += chunkLength;
+        }
+        U_PORT_TEST_ASSERT(messageCount == gUSpartnTestDataNumMessages);
+    }
+    U_TEST_PRINT_LINE("detected %d message(s) out of %d, several times over.",
+                      messageCount, gUSpartnTestDataNumMessages);
+
+    // Random rubbish in front of and behind a valid message: the
+    // message must be found, whatever else the rubbish happens to
+    // look like
+    pBuffer = (char *) pUPortMalloc(U_SPARTN_TEST_BUFFER_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(pBuffer != NULL);
+    for (size_t z = 0; z < 1000; z++) {
+        for (size_t x = 0; x < U_SPARTN_TEST_BUFFER_SIZE_BYTES; x++) {
+            *(pBuffer + x) = (char) rand();
+        }
+        chunkLength = rand() % U_SPARTN_TEST_BUFFER_EXTRA_SIZE_BYTES;
+        memcpy(pBuffer + chunkLength, gpSpartnMessage, sizeof(gpSpartnMessage));
+        // Start the detector just ahead of the message so that
+        // a false preamble in the rubbish can't swallow it
+        uSpartnDetectorInit(&detector);
+        pData = pBuffer + chunkLength;
+        messageLength = uSpartnDetectorFeed(&detector, pData,
+                                            pBuffer + U_SPARTN_TEST_BUFFER_SIZE_BYTES - pData,
+                                            &used, &offset);
+        U_PORT_TEST_ASSERT(messageLength == sizeof(gpSpartnMessage));
+        U_PORT_TEST_ASSERT(offset == 0);
+        U_PORT_TEST_ASSERT(used == sizeof(gpSpartnMessage));
+        // The rubbish that follows may or may not look like the start
+        // of a message but it must not look like a complete one
+        // that passes the message CRC check other than by chance
+        uSpartnDetectorFeed(&detector, pData + used,
+                            pBuffer + U_SPARTN_TEST_BUFFER_SIZE_BYTES - pData - used,
+                            &used, &offset);
+    }
+    uPortFree(pBuffer);
+
+    // A message in progress is reported and data with no
+    // preamble in it is not
+    uSpartnDetectorInit(&detector);
+    U_PORT_TEST_ASSERT(uSpartnDetectorFeed(&detector, gpSpartnMessage, 10,
+                                           &used, &offset) == (int32_t) U_ERROR_COMMON_TIMEOUT);
+    U_PORT_TEST_ASSERT((used == 10) && (offset == 0));
+    U_PORT_TEST_ASSERT(uSpartnDetectorFeed(&detector, gpSpartnMessage + 10, 10,
+                                           &used, &offset) == (int32_t) U_ERROR_COMMON_TIMEOUT);
+    U_PORT_TEST_ASSERT((used == 10) && (offset == -10));
+    U_PORT_TEST_ASSERT(uSpartnDetectorFeed(&detector, gpSpartnMessage + 20,
+                                           sizeof(gpSpartnMessage) - 20,
+                                           &used, &offset) == sizeof(gpSpartnMessage));
+    U_PORT_TEST_ASSERT(offset == -20);
+    U_PORT_TEST_ASSERT(uSpartnDetectorFeed(&detector, "garbage", 7,
+                                           &used, NULL) == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    U_PORT_TEST_ASSERT(used == 7);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 #endif // __ZEPHYR__
 
 /** Clean-up to be run at the end of this round of tests, just
@@ -52,10 +52,69 @@ extern "C" {
  */
 #define U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES (U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + 2)
 
+#ifndef U_UBX_PROTOCOL_ENCODER_BUFFER_LENGTH_BYTES
+/** The size of the buffer inside uUbxProtocolEncoder_t in which the
+ * incremental encoder collects output before passing it on, so
+ * that appending small fields does not result in many tiny writes;
+ * must be at least #U_UBX_PROTOCOL_HEADER_LENGTH_BYTES.
+ */
+# define U_UBX_PROTOCOL_ENCODER_BUFFER_LENGTH_BYTES 32
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The function that the incremental encoder calls to pass on
+ * encoded output, see uUbxProtocolEncodeBegin().
+ *
+ * @param[in] pParam  the pWriteParam given to uUbxProtocolEncodeBegin().
+ * @param[in] pData   the encoded output; never NULL.
+ * @param length      the number of bytes at pData; never zero.
+ * @return            the number of bytes written, which must be
+ *                    length for success, else negative error code.
+ */
+typedef int32_t (*uUbxProtocolEncoderWrite_t)(void *pParam,
+                                              const char *pData,
+                                              size_t length);
+
+/** The state of an incremental encoder, see uUbxProtocolEncodeBegin();
+ * the contents are internal, the structure is only exposed so that
+ * it may be placed on the stack.
+ */
+typedef struct {
+    uUbxProtocolEncoderWrite_t pWrite;
+    void *pWriteParam;
+    size_t bodyLengthBytes;     /**< the body length given in the header. */
+    size_t bodyBytesAppended;
+    uint32_t ca;
+    uint32_t cb;
+    int32_t errorCodeOrLength;  /**< the number of bytes written, else
+                                     the first error. */
+    size_t bufferLength;
+    char buffer[U_UBX_PROTOCOL_ENCODER_BUFFER_LENGTH_BYTES];
+} uUbxProtocolEncoder_t;
+
+/** The function that uUbxProtocolDecodeAll() calls for each message
+ * it finds.
+ *
+ * @param messageClass         the UBX message class.
+ * @param messageId            the UBX message ID.
+ * @param[in] pMessageBody     a pointer to the message body, which is
+ *                             in the buffer passed to
+ *                             uUbxProtocolDecodeAll(); NULL if the
+ *                             body is empty.
+ * @param messageBodyLength    the length of the message body.
+ * @param[in] pCallbackParam   the pCallbackParam given to
+ *                             uUbxProtocolDecodeAll().
+ * @return                     true to carry on decoding, false to stop.
+ */
+typedef bool (*uUbxProtocolDecodeCallback_t)(int32_t messageClass,
+                                             int32_t messageId,
+                                             const char *pMessageBody,
+                                             size_t messageBodyLength,
+                                             void *pCallbackParam);
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -151,6 +210,66 @@ int32_t uUbxProtocolEncode(int32_t messageClass, int32_t messageId,
                            const char *pMessageBody, size_t messageBodyLengthBytes,
                            char *pBuffer);
 
+/** Begin encoding a UBX protocol message incrementally: rather
+ * than encoding a complete body into a caller-supplied buffer, as
+ * uUbxProtocolEncode() does, the body is appended a field at a time
+ * with uUbxProtocolEncodeAppend() and the encoded message is passed,
+ * in chunks of up to #U_UBX_PROTOCOL_ENCODER_BUFFER_LENGTH_BYTES,
+ * to pWrite, e.g. straight to a UART, with the checksum calculated
+ * along the way; the message is completed with uUbxProtocolEncodeFinish().
+ * For this to work the length of the body must be known up-front,
+ * since it is written into the header, and exactly that many bytes
+ * must be appended.
+ *
+ * @param[out] pEncoder           a place to keep the state of the
+ *                                encoder; cannot be NULL.
+ * @param messageClass            the UBX protocol message class.
+ * @param messageId               the UBX protocol message ID.
+ * @param messageBodyLengthBytes  the length of the message body.
+ * @param[in] pWrite              the function to call to pass on the
+ *                                encoded output; cannot be NULL.
+ * @param[in] pWriteParam         a parameter that will be passed
+ *                                to pWrite; may be NULL.
+ * @return                        zero on success else negative error
+ *                                code.
+ */
+int32_t uUbxProtocolEncodeBegin(uUbxProtocolEncoder_t *pEncoder,
+                                int32_t messageClass, int32_t messageId,
+                                size_t messageBodyLengthBytes,
+                                uUbxProtocolEncoderWrite_t pWrite,
+                                void *pWriteParam);
+
+/** Append to the body of a message begun with uUbxProtocolEncodeBegin();
+ * multi-byte values should be in little-endian form, see
+ * uUbxProtocolUint32Encode() etc.  Once an append has failed all
+ * further appends will fail with the same error.
+ *
+ * @param[in] pEncoder  the encoder, as passed to uUbxProtocolEncodeBegin().
+ * @param[in] pData     the data to append; may only be NULL if length
+ *                      is zero.
+ * @param length        the number of bytes at pData.
+ * @return              zero on success, #U_ERROR_COMMON_INVALID_PARAMETER
+ *                      if this would take the body beyond the length
+ *                      given to uUbxProtocolEncodeBegin(), else the
+ *                      negative error code returned by pWrite.
+ */
+int32_t uUbxProtocolEncodeAppend(uUbxProtocolEncoder_t *pEncoder,
+                                 const char *pData, size_t length);
+
+/** Complete a message begun with uUbxProtocolEncodeBegin(), writing
+ * out the checksum and anything that is still held in the encoder.
+ *
+ * @param[in] pEncoder  the encoder, as passed to uUbxProtocolEncodeBegin().
+ * @return              on success the total number of bytes passed
+ *                      to pWrite, including header and checksum,
+ *                      #U_ERROR_COMMON_INVALID_PARAMETER if fewer
+ *                      bytes were appended than the body length given
+ *                      to uUbxProtocolEncodeBegin() (in which case
+ *                      nothing more is written), else the negative error
+ *                      code returned by pWrite.
+ */
+int32_t uUbxProtocolEncodeFinish(uUbxProtocolEncoder_t *pEncoder);
+
 /** Decode a UBX protocol message.  Call this function with a buffer
  * and it will return the first valid UBX format message it finds
  * in the buffer. ppBufferOut will be set to the first position in
@@ -229,6 +348,47 @@ int32_t uUbxProtocolDecode(const char *pBufferIn, size_t bufferLengthBytes,
                            char *pMessageBody, size_t maxMessageBodyLengthBytes,
                            const char **ppBufferOut);
 
+/** Decode all of the UBX protocol messages in a buffer in one go,
+ * calling pCallback for each; the message body is passed to pCallback
+ * in place, no copy is made.  Anything that is not a valid message
+ * (i.e. does not begin with the UBX preamble or has a length or
+ * checksum that doesn't fit) is skipped, the search for the next
+ * preamble being done with memchr(), so this is considerably quicker
+ * than calling uUbxProtocolDecode() repeatedly on a buffer holding
+ * many messages or lots of non-UBX data.
+ *
+ * ppBufferOut is set to the point at which decoding should resume
+ * when more data arrives: this is the start of any partial message at
+ * the end of the buffer, or one byte beyond the end of the buffer
+ * if there is none, or the first byte after the last message
+ * decoded if pCallback returned false.  A pattern for use on a
+ * stream might therefore be:
+ *
+ * ```
+ * uUbxProtocolDecodeAll(buffer, length, callback, NULL, &pBufferEnd);
+ * length -= pBufferEnd - buffer;
+ * memmove(buffer, pBufferEnd, length);
+ * // Read more data into buffer + length
+ * ```
+ *
+ * @param[in] pBufferIn          a pointer to the buffer to decode.
+ * @param bufferLengthBytes      the amount of data at pBufferIn.
+ * @param[in] pCallback          the function to call for each message
+ *                               found; cannot be NULL.
+ * @param[in] pCallbackParam     a parameter that will be passed to
+ *                               pCallback; may be NULL.
+ * @param[out] ppBufferOut       a pointer to somewhere to store the
+ *                               point at which decoding should resume;
+ *                               may be NULL.
+ * @return                       on success the number of messages
+ *                               passed to pCallback, else negative
+ *                               error code.
+ */
+int32_t uUbxProtocolDecodeAll(const char *pBufferIn, size_t bufferLengthBytes,
+                              uUbxProtocolDecodeCallback_t pCallback,
+                              void *pCallbackParam,
+                              const char **ppBufferOut);
+
 #ifdef __cplusplus
 }
 #endif
@@ -53,6 +53,81 @@
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Run the UBX (Fletcher) checksum over size bytes at pData, four
+// at a time where possible: since cb accumulates ca after every
+// byte, after four bytes b0 to b3 it has gained 4 * ca plus
+// 4 * b0 + 3 * b1 + 2 * b2 + b3, which saves most of the loop
+// overhead and the dependency of each step on the one before.
+// Unsigned so that wrapping is defined; only the bottom eight bits
+// of each are ever used.
+static void checksumUpdate(uint32_t *pCa, uint32_t *pCb,
+                           const uint8_t *pData, size_t size)
+{
+    uint32_t ca = *pCa;
+    uint32_t cb = *pCb;
+    uint32_t b0;
+    uint32_t b1;
+    uint32_t b2;
+    uint32_t b3;
+
+    for (; size >= 4; size -= 4) {
+        b0 = *pData++;
+        b1 = *pData++;
+        b2 = *pData++;
+        b3 = *pData++;
+        cb += (ca << 2) + (b0 << 2) + (b1 * 3) + (b2 << 1) + b3;
+        ca += b0 + b1 + b2 + b3;
+    }
+    for (; size > 0; size--) {
+        ca += *pData++;
+        cb += ca;
+    }
+
+    *pCa = ca;
+    *pCb = cb;
+}
+
+// Pass the contents of the buffer of an incremental encoder on.
+static void encoderFlush(uUbxProtocolEncoder_t *pEncoder)
+{
+    int32_t x;
+
+    if ((pEncoder->bufferLength > 0) && (pEncoder->errorCodeOrLength >= 0)) {
+        x = pEncoder->pWrite(pEncoder->pWriteParam, pEncoder->buffer,
+                             pEncoder->bufferLength);
+        if (x == (int32_t) pEncoder->bufferLength) {
+            pEncoder->errorCodeOrLength += x;
+        } else if (x < 0) {
+            pEncoder->errorCodeOrLength = x;
+        } else {
+            pEncoder->errorCodeOrLength = (int32_t) U_ERROR_COMMON_PLATFORM;
+        }
+    }
+    pEncoder->bufferLength = 0;
+}
+
+// Add data to the buffer of an incremental encoder, passing
+// it on as the buffer fills up.
+static void encoderAdd(uUbxProtocolEncoder_t *pEncoder,
+                       const char *pData, size_t length)
+{
+    size_t x;
+
+    while ((length > 0) && (pEncoder->errorCodeOrLength >= 0)) {
+        x = sizeof(pEncoder->buffer) - pEncoder->bufferLength;
+        if (x > length) {
+            x = length;
+        }
+        memcpy(pEncoder->buffer + pEncoder->bufferLength, pData, x);
+        pEncoder->bufferLength += x;
+        pData += x;
+        length -= x;
+        if (pEncoder->bufferLength == sizeof(pEncoder->buffer)) {
+            encoderFlush(pEncoder);
+        }
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -170,8 +245,8 @@ int32_t uUbxProtocolEncode(int32_t messageClass, int32_t messageId,
     int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
     // Use a uint8_t pointer for maths, more certain of its behaviour than char
     uint8_t *pWrite = (uint8_t *) pBuffer;
-    int32_t ca = 0;
-    int32_t cb = 0;
+    uint32_t ca = 0;
+    uint32_t cb = 0;
 
     if (((messageBodyLengthBytes == 0) || (pMessage != NULL)) &&
         (pBuffer != NULL)) {
@@ -192,12 +267,8 @@ int32_t uUbxProtocolEncode(int32_t messageClass, int32_t messageId,
 
         // Work out the CRC over the variable elements of the
         // header and the body
-        pBuffer += 2;
-        for (size_t x = 0; x < messageBodyLengthBytes + 4; x++) {
-            ca += (uint8_t) *pBuffer; // *NOPAD*
-            cb += ca;
-            pBuffer++;
-        }
+        checksumUpdate(&ca, &cb, ((const uint8_t *) pBuffer) + 2,
+                       messageBodyLengthBytes + 4);
 
         // Write in the CRC
         *pWrite++ = (uint8_t) (ca & (uint8_t) 0xff);
@@ -209,6 +280,89 @@ int32_t uUbxProtocolEncode(int32_t messageClass, int32_t messageId,
     return errorCodeOrLength;
 }
 
+// Begin encoding a UBX protocol message incrementally.
+int32_t uUbxProtocolEncodeBegin(uUbxProtocolEncoder_t *pEncoder,
+                                int32_t messageClass, int32_t messageId,
+                                size_t messageBodyLengthBytes,
+                                uUbxProtocolEncoderWrite_t pWrite,
+                                void *pWriteParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pEncoder != NULL) && (pWrite != NULL) &&
+        (messageBodyLengthBytes <= 0xffff)) {
+        memset(pEncoder, 0, sizeof(*pEncoder));
+        pEncoder->pWrite = pWrite;
+        pEncoder->pWriteParam = pWriteParam;
+        pEncoder->bodyLengthBytes = messageBodyLengthBytes;
+        pEncoder->buffer[0] = (char) 0xb5;
+        pEncoder->buffer[1] = 0x62;
+        pEncoder->buffer[2] = (char) messageClass;
+        pEncoder->buffer[3] = (char) messageId;
+        pEncoder->buffer[4] = (char) (messageBodyLengthBytes & 0xff);
+        pEncoder->buffer[5] = (char) (messageBodyLengthBytes >> 8);
+        pEncoder->bufferLength = U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+        // The CRC covers the variable elements of the header
+        checksumUpdate(&(pEncoder->ca), &(pEncoder->cb),
+                       ((const uint8_t *) pEncoder->buffer) + 2, 4);
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
+// Append to the body of a message being encoded incrementally.
+int32_t uUbxProtocolEncodeAppend(uUbxProtocolEncoder_t *pEncoder,
+                                 const char *pData, size_t length)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pEncoder != NULL) && ((pData != NULL) || (length == 0))) {
+        if (pEncoder->errorCodeOrLength >= 0) {
+            if (pEncoder->bodyBytesAppended + length > pEncoder->bodyLengthBytes) {
+                pEncoder->errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+            } else {
+                checksumUpdate(&(pEncoder->ca), &(pEncoder->cb),
+                               (const uint8_t *) pData, length);
+                pEncoder->bodyBytesAppended += length;
+                encoderAdd(pEncoder, pData, length);
+            }
+        }
+        errorCode = pEncoder->errorCodeOrLength;
+        if (errorCode > 0) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+    }
+
+    return errorCode;
+}
+
+// Complete a message being encoded incrementally.
+int32_t uUbxProtocolEncodeFinish(uUbxProtocolEncoder_t *pEncoder)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    char crc[2];
+
+    if (pEncoder != NULL) {
+        if ((pEncoder->errorCodeOrLength >= 0) &&
+            (pEncoder->bodyBytesAppended < pEncoder->bodyLengthBytes)) {
+            pEncoder->errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        }
+        crc[0] = (char) (pEncoder->ca & 0xff);
+        crc[1] = (char) (pEncoder->cb & 0xff);
+        if (pEncoder->bufferLength + sizeof(crc) > sizeof(pEncoder->buffer)) {
+            // Don't split the checksum across writes: some transports
+            // (e.g. I2C) attach meaning to a single-byte write
+            encoderFlush(pEncoder);
+        }
+        encoderAdd(pEncoder, crc, sizeof(crc));
+        encoderFlush(pEncoder);
+        errorCodeOrLength = pEncoder->errorCodeOrLength;
+    }
+
+    return errorCodeOrLength;
+}
+
 // Decode a UBX protocol message.
 int32_t uUbxProtocolDecode(const char *pBufferIn, size_t bufferLengthBytes,
                            int32_t *pMessageClass, int32_t *pMessageId,
@@ -222,19 +376,29 @@ int32_t uUbxProtocolDecode(const char *pBufferIn, size_t bufferLengthBytes,
     bool updateCrc = false;
     size_t expectedMessageByteCount = 0;
     size_t messageByteCount = 0;
-    int32_t ca = 0;
-    int32_t cb = 0;
+    size_t length;
+    uint32_t ca = 0;
+    uint32_t cb = 0;
 
     for (size_t x = 0; (x < bufferLengthBytes) &&
          (overheadByteCount < U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES); x++) {
         switch (overheadByteCount) {
-            case 0:
-                //lint -e{650} Suppress warning about 0xb5 being out of range for char
-                if (*pInput == 0xb5) {
+            case 0: {
+                // Skip straight to the first byte of the header, or
+                // to the last byte of the buffer if there is none
+                const uint8_t *pFound = (const uint8_t *) memchr(pInput, 0xb5,
+                                                                 bufferLengthBytes - x);
+                if (pFound != NULL) {
                     // Got first byte of header, increment count
+                    length = pFound - pInput;
                     overheadByteCount++;
+                } else {
+                    length = bufferLengthBytes - x - 1;
                 }
-                break;
+                pInput += length;
+                x += length;
+            }
+            break;
             case 1:
                 if (*pInput == 0x62) {
                     // Got second byte of header, increment count
@@ -283,13 +447,27 @@ int32_t uUbxProtocolDecode(const char *pBufferIn, size_t bufferLengthBytes,
                 break;
             case 6:
                 if (messageByteCount < expectedMessageByteCount) {
-                    // Store the next byte of the message and
-                    // update CRC
+                    // Take as much of the body as there is in the
+                    // buffer in one go: store it, as far as it fits,
+                    // and update CRC
+                    length = expectedMessageByteCount - messageByteCount;
+                    if (length > bufferLengthBytes - x) {
+                        length = bufferLengthBytes - x;
+                    }
                     if ((pMessage != NULL) && (messageByteCount < maxMessageLengthBytes)) {
-                        *pMessage++ = (char) *pInput; // *NOPAD*
+                        if (length < maxMessageLengthBytes - messageByteCount) {
+                            memcpy(pMessage, pInput, length);
+                            pMessage += length;
+                        } else {
+                            memcpy(pMessage, pInput, maxMessageLengthBytes - messageByteCount);
+                            pMessage += maxMessageLengthBytes - messageByteCount;
+                        }
                     }
-                    updateCrc = true;
-                    messageByteCount++;
+                    checksumUpdate(&ca, &cb, pInput, length);
+                    messageByteCount += length;
+                    // Leave the last byte for the loop to step over
+                    pInput += length - 1;
+                    x += length - 1;
                 } else {
                     // First byte of CRC, check it
                     ca &= 0xff;
@@ -343,4 +521,77 @@ int32_t uUbxProtocolDecode(const char *pBufferIn, size_t bufferLengthBytes,
     return sizeOrErrorCode;
 }
 
+// Decode all of the UBX protocol messages in a buffer.
+int32_t uUbxProtocolDecodeAll(const char *pBufferIn, size_t bufferLengthBytes,
+                              uUbxProtocolDecodeCallback_t pCallback,
+                              void *pCallbackParam,
+                              const char **ppBufferOut)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    // Use a uint8_t pointer for maths, more certain of its behaviour than char
+    const uint8_t *pInput = (const uint8_t *) pBufferIn;
+    const uint8_t *pEnd = pInput + bufferLengthBytes;
+    const uint8_t *pCandidate;
+    const uint8_t *pPartial = NULL;
+    size_t remaining;
+    size_t bodyLength;
+    uint32_t ca;
+    uint32_t cb;
+    bool keepGoing = true;
+
+    if (((pBufferIn != NULL) || (bufferLengthBytes == 0)) && (pCallback != NULL)) {
+        errorCodeOrCount = 0;
+        while (keepGoing && (pInput < pEnd)) {
+            pCandidate = (const uint8_t *) memchr(pInput, 0xb5, pEnd - pInput);
+            if (pCandidate == NULL) {
+                pInput = pEnd;
+            } else {
+                remaining = pEnd - pCandidate;
+                pInput = pCandidate + 1;
+                if ((remaining > 1) && (*(pCandidate + 1) != 0x62)) {
+                    // Not a preamble
+                    continue;
+                }
+                bodyLength = 0;
+                if (remaining >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES) {
+                    bodyLength = ((size_t) *(pCandidate + 5)) << 8; // *NOPAD*
+                    bodyLength += *(pCandidate + 4);
+                }
+                if ((remaining < U_UBX_PROTOCOL_HEADER_LENGTH_BYTES) ||
+                    (remaining < bodyLength + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES)) {
+                    // Could be the start of a message that is yet to
+                    // complete, remember the first of these; it may
+                    // equally be junk, so carry on looking
+                    if (pPartial == NULL) {
+                        pPartial = pCandidate;
+                    }
+                    continue;
+                }
+                ca = 0;
+                cb = 0;
+                checksumUpdate(&ca, &cb, pCandidate + 2, bodyLength + 4);
+                if (((uint8_t) ca == *(pCandidate + bodyLength + 6)) &&
+                    ((uint8_t) cb == *(pCandidate + bodyLength + 7))) {
+                    // A valid message: anything partial before it
+                    // could not have been a message after all
+                    pPartial = NULL;
+                    errorCodeOrCount++;
+                    keepGoing = pCallback(*(pCandidate + 2), *(pCandidate + 3),
+                                          bodyLength > 0 ? (const char *) pCandidate + 6 : NULL,
+                                          bodyLength, pCallbackParam);
+                    pInput = pCandidate + bodyLength + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+                }
+            }
+        }
+        if (keepGoing && (pPartial != NULL)) {
+            pInput = pPartial;
+        }
+        if (ppBufferOut != NULL) {
+            *ppBufferOut = (const char *) pInput;
+        }
+    }
+
+    return errorCodeOrCount;
+}
+
 // End of file
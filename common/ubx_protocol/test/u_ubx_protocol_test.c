@@ -76,10 +76,72 @@
  * VARIABLES
  * -------------------------------------------------------------- */
 
+/** The number of bytes written by encoderWrite().
+ */
+static size_t gEncoderWriteLength = 0;
+
+/** The number of times encoderWrite() has been called.
+ */
+static size_t gEncoderWriteCount = 0;
+
+/** The error code for encoderWrite() to return; zero for success.
+ */
+static int32_t gEncoderWriteErrorCode = 0;
+
+/** The number of messages passed to decodeAllCallback().
+ */
+static size_t gDecodeAllCount = 0;
+
+/** The message class, ID, body and body length of each message
+ * passed to decodeAllCallback().
+ */
+static int32_t gDecodeAllClass[4];
+static int32_t gDecodeAllId[4];
+static const char *gpDecodeAllBody[4];
+static size_t gDecodeAllLength[4];
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Callback for uUbxProtocolDecodeAll(); pCallbackParam points to the
+// number of messages to accept before returning false.
+static bool decodeAllCallback(int32_t messageClass, int32_t messageId,
+                              const char *pMessageBody,
+                              size_t messageBodyLength,
+                              void *pCallbackParam)
+{
+    size_t *pStopCount = (size_t *) pCallbackParam;
+
+    U_PORT_TEST_ASSERT(gDecodeAllCount < sizeof(gDecodeAllClass) / sizeof(gDecodeAllClass[0]));
+    gDecodeAllClass[gDecodeAllCount] = messageClass;
+    gDecodeAllId[gDecodeAllCount] = messageId;
+    gpDecodeAllBody[gDecodeAllCount] = pMessageBody;
+    gDecodeAllLength[gDecodeAllCount] = messageBodyLength;
+    gDecodeAllCount++;
+
+    return (pStopCount == NULL) || (gDecodeAllCount < *pStopCount);
+}
+
+// The write function for the incremental encoder, appending to the
+// buffer passed in as pParam.
+static int32_t encoderWrite(void *pParam, const char *pData, size_t length)
+{
+    int32_t errorCodeOrLength = gEncoderWriteErrorCode;
+
+    // No write should be smaller than the checksum
+    U_PORT_TEST_ASSERT((pData != NULL) && (length >= 2));
+    U_PORT_TEST_ASSERT(length <= U_UBX_PROTOCOL_ENCODER_BUFFER_LENGTH_BYTES);
+    if (errorCodeOrLength == 0) {
+        memcpy(((char *) pParam) + gEncoderWriteLength, pData, length);
+        gEncoderWriteLength += length;
+        errorCodeOrLength = (int32_t) length;
+    }
+    gEncoderWriteCount++;
+
+    return errorCodeOrLength;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
@@ -172,6 +234,179 @@ U_PORT_TEST_FUNCTION("[ubxProtocol]", "ubxProtocolBackToBack")
     uPortFree(pBuffer);
 }
 
+/** Test of the incremental UBX protocol encoder against
+ * uUbxProtocolEncode().
+ */
+U_PORT_TEST_FUNCTION("[ubxProtocol]", "ubxProtocolIncremental")
+{
+    uUbxProtocolEncoder_t encoder;
+    char *pBodyIn;
+    char *pBuffer;
+    char *pBufferIncremental;
+    size_t length;
+    size_t offset;
+    int32_t messageLength;
+
+    pBodyIn = (char *) pUPortMalloc(U_UBX_PROTOCOL_TEST_MAX_BODY_SIZE);
+    U_PORT_TEST_ASSERT(pBodyIn != NULL);
+    pBuffer = (char *) pUPortMalloc(U_UBX_PROTOCOL_TEST_MAX_BODY_SIZE +
+                                    U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(pBuffer != NULL);
+    pBufferIncremental = (char *) pUPortMalloc(U_UBX_PROTOCOL_TEST_MAX_BODY_SIZE +
+                                               U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(pBufferIncremental != NULL);
+    for (size_t x = 0; x < U_UBX_PROTOCOL_TEST_MAX_BODY_SIZE; x++) {
+        //lint -e(613) Suppress possible nullness in pBodyIn, it is checked above
+        *(pBodyIn + x) = (char) (x * 7);
+    }
+
+    for (size_t x = 0; x < U_UBX_PROTOCOL_TEST_MAX_BODY_SIZE; x += 13) {
+        // Encode in one go and then incrementally, in fields of
+        // varying length, and check that the two are the same
+        messageLength = uUbxProtocolEncode(0x13, 0x80, pBodyIn, x, pBuffer);
+        U_PORT_TEST_ASSERT(messageLength == (int32_t) x + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
+        gEncoderWriteLength = 0;
+        gEncoderWriteCount = 0;
+        U_PORT_TEST_ASSERT(uUbxProtocolEncodeBegin(&encoder, 0x13, 0x80, x, encoderWrite,
+                                                   pBufferIncremental) == 0);
+        offset = 0;
+        for (size_t y = 0; offset < x; y++) {
+            length = (y % 8) + 1;
+            if (length > x - offset) {
+                length = x - offset;
+            }
+            U_PORT_TEST_ASSERT(uUbxProtocolEncodeAppend(&encoder, pBodyIn + offset, length) == 0);
+            offset += length;
+        }
+        U_PORT_TEST_ASSERT(uUbxProtocolEncodeFinish(&encoder) == messageLength);
+        U_PORT_TEST_ASSERT(gEncoderWriteLength == (size_t) messageLength);
+        //lint -e(668) Suppress possible nullness, checked above
+        U_PORT_TEST_ASSERT(memcmp(pBufferIncremental, pBuffer, messageLength) == 0);
+        // Output must have been collected into chunks, not passed on
+        // per field; there may be one extra write to keep the checksum
+        // in one piece
+        length = (messageLength + U_UBX_PROTOCOL_ENCODER_BUFFER_LENGTH_BYTES - 1) /
+                 U_UBX_PROTOCOL_ENCODER_BUFFER_LENGTH_BYTES;
+        U_PORT_TEST_ASSERT((gEncoderWriteCount >= length) && (gEncoderWriteCount <= length + 1));
+    }
+
+    // Appending too much or too little should fail
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeBegin(&encoder, 0x06, 0x8a, 4, encoderWrite,
+                                               pBufferIncremental) == 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeAppend(&encoder, pBodyIn, 5) < 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeAppend(&encoder, pBodyIn, 1) < 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeFinish(&encoder) < 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeBegin(&encoder, 0x06, 0x8a, 4, encoderWrite,
+                                               pBufferIncremental) == 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeAppend(&encoder, pBodyIn, 3) == 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeFinish(&encoder) < 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeBegin(&encoder, 0x06, 0x8a, 0x10000, encoderWrite,
+                                               NULL) < 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeBegin(&encoder, 0x06, 0x8a, 4, NULL, NULL) < 0);
+
+    // An error from the write function should be returned
+    gEncoderWriteErrorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeBegin(&encoder, 0x06, 0x8a, 4, encoderWrite,
+                                               pBufferIncremental) == 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeAppend(&encoder, pBodyIn, 4) == 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolEncodeFinish(&encoder) == gEncoderWriteErrorCode);
+    gEncoderWriteErrorCode = 0;
+
+    // Free memory
+    uPortFree(pBodyIn);
+    uPortFree(pBuffer);
+    uPortFree(pBufferIncremental);
+}
+
+/** Test of decoding all of the messages in a buffer in one go,
+ * with junk and false preambles scattered about.
+ */
+U_PORT_TEST_FUNCTION("[ubxProtocol]", "ubxProtocolDecodeAll")
+{
+    char buffer[128];
+    char body[20];
+    // A preamble with a bad checksum
+    const char badChecksum[] = {(char) 0xb5, 0x62, 0x05, 0x01, 0x02, 0x00, 'x', 'y', 0, 0};
+    // A preamble with a length that runs beyond what follows
+    const char badLength[] = {(char) 0xb5, 0x62, 0x01, 0x02, (char) 0xff, (char) 0xff};
+    const char *pTmp = NULL;
+    const char *pBody[3];
+    const char *pPartial;
+    const char *pAfterSecond;
+    size_t length = 0;
+    size_t stopCount;
+
+    for (size_t x = 0; x < sizeof(body); x++) {
+        body[x] = (char) (0xb5 + x);
+    }
+
+    // Assemble: junk, message, bad checksum, a lone 0xb5, message with
+    // no body, bad length, message and then a partial message
+    memcpy(buffer + length, "abc", 3);
+    length += 3;
+    pBody[0] = buffer + length + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+    length += uUbxProtocolEncode(0x01, 0x07, body, sizeof(body), buffer + length);
+    memcpy(buffer + length, badChecksum, sizeof(badChecksum));
+    length += sizeof(badChecksum);
+    buffer[length++] = (char) 0xb5;
+    buffer[length++] = 'q';
+    pBody[1] = NULL;
+    length += uUbxProtocolEncode(0x0a, 0x04, NULL, 0, buffer + length);
+    pAfterSecond = buffer + length;
+    memcpy(buffer + length, badLength, sizeof(badLength));
+    length += sizeof(badLength);
+    pBody[2] = buffer + length + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+    length += uUbxProtocolEncode(0x02, 0x13, body, 5, buffer + length);
+    pPartial = buffer + length;
+    U_PORT_TEST_ASSERT(uUbxProtocolEncode(0x06, 0x8a, body, 10, buffer + length) == 18);
+    length += 7;
+    U_PORT_TEST_ASSERT(length <= sizeof(buffer));
+
+    gDecodeAllCount = 0;
+    U_PORT_TEST_ASSERT(uUbxProtocolDecodeAll(buffer, length, decodeAllCallback,
+                                             NULL, &pTmp) == 3);
+    U_PORT_TEST_ASSERT(gDecodeAllCount == 3);
+    U_PORT_TEST_ASSERT(pTmp == pPartial);
+    U_PORT_TEST_ASSERT((gDecodeAllClass[0] == 0x01) && (gDecodeAllId[0] == 0x07));
+    U_PORT_TEST_ASSERT(gDecodeAllLength[0] == sizeof(body));
+    U_PORT_TEST_ASSERT((gDecodeAllClass[1] == 0x0a) && (gDecodeAllId[1] == 0x04));
+    U_PORT_TEST_ASSERT(gDecodeAllLength[1] == 0);
+    U_PORT_TEST_ASSERT((gDecodeAllClass[2] == 0x02) && (gDecodeAllId[2] == 0x13));
+    U_PORT_TEST_ASSERT(gDecodeAllLength[2] == 5);
+    for (size_t x = 0; x < 3; x++) {
+        U_PORT_TEST_ASSERT(gpDecodeAllBody[x] == pBody[x]);
+    }
+    U_PORT_TEST_ASSERT(memcmp(gpDecodeAllBody[0], body, sizeof(body)) == 0);
+
+    // Once the partial message is complete it should be decoded
+    gDecodeAllCount = 0;
+    length = pPartial - buffer + 18;
+    U_PORT_TEST_ASSERT(uUbxProtocolDecodeAll(pPartial, 18, decodeAllCallback,
+                                             NULL, &pTmp) == 1);
+    U_PORT_TEST_ASSERT((gDecodeAllClass[0] == 0x06) && (gDecodeAllId[0] == 0x8a));
+    U_PORT_TEST_ASSERT(pTmp == buffer + length);
+
+    // Stop after the second message
+    gDecodeAllCount = 0;
+    stopCount = 2;
+    U_PORT_TEST_ASSERT(uUbxProtocolDecodeAll(buffer, length, decodeAllCallback,
+                                             &stopCount, &pTmp) == 2);
+    U_PORT_TEST_ASSERT(pTmp == pAfterSecond);
+
+    // Nothing at all and bad parameters
+    gDecodeAllCount = 0;
+    U_PORT_TEST_ASSERT(uUbxProtocolDecodeAll(buffer, 3, decodeAllCallback,
+                                             NULL, &pTmp) == 0);
+    U_PORT_TEST_ASSERT(pTmp == buffer + 3);
+    U_PORT_TEST_ASSERT(uUbxProtocolDecodeAll(buffer, 0, decodeAllCallback,
+                                             NULL, &pTmp) == 0);
+    U_PORT_TEST_ASSERT(pTmp == buffer);
+    U_PORT_TEST_ASSERT(uUbxProtocolDecodeAll(buffer, length, NULL, NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uUbxProtocolDecodeAll(NULL, length, decodeAllCallback,
+                                             NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(gDecodeAllCount == 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
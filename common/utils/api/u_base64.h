@@ -28,6 +28,13 @@
 
 /** @file
  * @brief This header file defines base64 encode and decode functions.
+ *
+ * uBase64Encode() and uBase64Decode() need the whole of their input
+ * and output in memory.  The streaming functions, uBase64EncodeStream()
+ * and uBase64DecodeStream(), instead take the input in chunks of any
+ * size, carrying a partial group of bytes over from one chunk to the
+ * next in a #uBase64Stream_t, so that, for instance, a large file may
+ * be encoded on the fly through a small buffer.
  */
 
 #ifdef __cplusplus
@@ -38,10 +45,32 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** The largest number of base64 characters that uBase64EncodeStream()
+ * may write for the given number of bytes of binary input, or that
+ * uBase64EncodeStreamFinish() may write if length is zero.
+ */
+#define U_BASE64_ENCODE_STREAM_LENGTH_MAX(length) ((((length) + 2) / 3) * 4)
+
+/** The largest number of bytes that uBase64DecodeStream() may write
+ * for the given number of characters of base64 input, or that
+ * uBase64DecodeStreamFinish() may write if length is zero.
+ */
+#define U_BASE64_DECODE_STREAM_LENGTH_MAX(length) ((((length) + 3) / 4) * 3)
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The state of a streaming base64 encode or decode; the contents
+ * are private, initialise it with uBase64StreamInit().
+ */
+typedef struct {
+    uint8_t carry[4]; /**< bytes (encode) or 6-bit values (decode)
+                           left over from the last chunk. */
+    uint8_t carryLength;
+    bool padded; /**< decode only: true once padding has been seen. */
+} uBase64Stream_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -87,6 +116,86 @@ int32_t uBase64Encode(const char *pBinary, size_t binaryLengthBytes,
 int32_t uBase64Decode(const char *pBase64, size_t base64LengthBytes,
                       char *pBinary, size_t binaryLengthBytes);
 
+/** Initialise the state of a streaming encode or decode; this must
+ * be called before the first chunk and may be called again to start
+ * over.
+ *
+ * @param[out] pStream  a pointer to the state; cannot be NULL.
+ */
+void uBase64StreamInit(uBase64Stream_t *pStream);
+
+/** Base 64 encode a chunk of binary data, carrying any bytes that do
+ * not make up a whole group of three over to the next call.
+ *
+ * @param[in] pStream        a pointer to the state; cannot be NULL.
+ * @param[in] pBinary        the binary data to be encoded; may be NULL
+ *                           only if binaryLengthBytes is zero.
+ * @param binaryLengthBytes  the amount of binary data.
+ * @param[out] pBase64       a place to store the base 64 encoded data;
+ *                           no null-terminator is included.
+ * @param base64LengthBytes  the amount of storage at pBase64, which must
+ *                           be at least
+ *                           #U_BASE64_ENCODE_STREAM_LENGTH_MAX
+ *                           (binaryLengthBytes).
+ * @return                   the number of characters stored at pBase64,
+ *                           else negative error code, in which case
+ *                           none of pBinary has been consumed.
+ */
+int32_t uBase64EncodeStream(uBase64Stream_t *pStream,
+                            const char *pBinary, size_t binaryLengthBytes,
+                            char *pBase64, size_t base64LengthBytes);
+
+/** Finish a streaming base 64 encode, writing out any bytes left
+ * over, with padding.
+ *
+ * @param[in] pStream        a pointer to the state; cannot be NULL.
+ * @param[out] pBase64       a place to store the base 64 encoded data.
+ * @param base64LengthBytes  the amount of storage at pBase64, which must
+ *                           be at least 4.
+ * @return                   the number of characters stored at pBase64,
+ *                           else negative error code.
+ */
+int32_t uBase64EncodeStreamFinish(uBase64Stream_t *pStream,
+                                  char *pBase64, size_t base64LengthBytes);
+
+/** Base 64 decode a chunk of base 64 data, carrying any characters
+ * that do not make up a whole group of four over to the next call.
+ * White space (e.g. the line-breaks of a PEM file) is ignored.
+ *
+ * @param[in] pStream        a pointer to the state; cannot be NULL.
+ * @param[in] pBase64        the base 64 data to be decoded; may be NULL
+ *                           only if base64LengthBytes is zero.
+ * @param base64LengthBytes  the amount of base 64 data.
+ * @param[out] pBinary       a place to store the decoded data.
+ * @param binaryLengthBytes  the amount of storage at pBinary, which
+ *                           must be at least
+ *                           #U_BASE64_DECODE_STREAM_LENGTH_MAX
+ *                           (base64LengthBytes).
+ * @return                   the number of bytes stored at pBinary,
+ *                           else negative error code, e.g.
+ *                           #U_ERROR_COMMON_INVALID_PARAMETER if
+ *                           pBase64 contains a character that is not
+ *                           base 64 or has data after the padding.
+ */
+int32_t uBase64DecodeStream(uBase64Stream_t *pStream,
+                            const char *pBase64, size_t base64LengthBytes,
+                            char *pBinary, size_t binaryLengthBytes);
+
+/** Finish a streaming base 64 decode, writing out anything left
+ * over; base 64 data that is missing its padding is accepted.
+ *
+ * @param[in] pStream        a pointer to the state; cannot be NULL.
+ * @param[out] pBinary       a place to store the decoded data.
+ * @param binaryLengthBytes  the amount of storage at pBinary, which
+ *                           must be at least 3.
+ * @return                   the number of bytes stored at pBinary,
+ *                           else negative error code, e.g.
+ *                           #U_ERROR_COMMON_INVALID_PARAMETER if
+ *                           the base 64 data was truncated.
+ */
+int32_t uBase64DecodeStreamFinish(uBase64Stream_t *pStream,
+                                  char *pBinary, size_t binaryLengthBytes);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_HASH_MAP_H_
+#define _U_HASH_MAP_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** @file
+ * @brief A small hash map, mapping integer or pointer keys to
+ * non-NULL pointer values.  The map uses open addressing with linear
+ * probing in a table of entries provided by the caller, so adding or
+ * removing an entry never allocates memory and a lookup usually
+ * touches a single entry.  For good performance the table should be
+ * kept no more than about three quarters full.  These functions are
+ * NOT thread-safe: should that be required you must provide it with
+ * some form of mutex before the functions are called.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** An entry in a hash map; the contents are private.
+ */
+typedef struct {
+    uintptr_t key;
+    void *pValue; /**< NULL if the entry is empty. */
+} uHashMapEntry_t;
+
+/** A hash map; the contents are private, initialise it
+ * with uHashMapInit().
+ */
+typedef struct {
+    uHashMapEntry_t *pEntries;
+    size_t numEntries; /**< always a power of two. */
+    size_t count;
+} uHashMap_t;
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Initialise a hash map; the map will be empty.
+ *
+ * @param[out] pMap      a pointer to the hash map; cannot be NULL.
+ * @param[in] pEntries   the table of entries for the map to use,
+ *                       which must remain valid for as long as the
+ *                       map is used; cannot be NULL.
+ * @param numEntries     the number of entries at pEntries, which
+ *                       must be a power of two; the map can hold
+ *                       one fewer than this number of values.
+ * @return               zero on success else negative error code.
+ */
+int32_t uHashMapInit(uHashMap_t *pMap, uHashMapEntry_t *pEntries,
+                     size_t numEntries);
+
+/** Set the value for a key in a hash map, replacing any value
+ * that was there before.
+ *
+ * @param[in] pMap    a pointer to the hash map; cannot be NULL.
+ * @param key         the key.
+ * @param[in] pValue  the value; cannot be NULL.
+ * @return            zero on success else negative error code;
+ *                    #U_ERROR_COMMON_NO_MEMORY if the map is full.
+ */
+int32_t uHashMapSet(uHashMap_t *pMap, uintptr_t key, void *pValue);
+
+/** Get the value for a key from a hash map.
+ *
+ * @param[in] pMap  a pointer to the hash map; cannot be NULL.
+ * @param key       the key.
+ * @return          the value, NULL if the key is not in the map.
+ */
+void *pUHashMapGet(const uHashMap_t *pMap, uintptr_t key);
+
+/** Remove a key from a hash map.
+ *
+ * @param[in] pMap  a pointer to the hash map; cannot be NULL.
+ * @param key       the key.
+ * @return          the value the key had, NULL if the key was
+ *                  not in the map.
+ */
+void *pUHashMapRemove(uHashMap_t *pMap, uintptr_t key);
+
+/** Get the number of values in a hash map.
+ *
+ * @param[in] pMap  a pointer to the hash map; cannot be NULL.
+ * @return          the number of values in the map.
+ */
+size_t uHashMapGetCount(const uHashMap_t *pMap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _U_HASH_MAP_H_
+
+// End of file
@@ -21,6 +21,15 @@
  * @brief Linked list utilities.  These functions are NOT thread-safe:
  * should that be required you must provide it with some form of
  * mutex before the functions are called.
+ *
+ * Two kinds of list are offered.  uLinkedListAdd() and friends keep
+ * a list of pointers, allocating a #uLinkedList_t from the heap for
+ * each entry.  The "node" functions, uLinkedListNodeAdd() and friends,
+ * keep an intrusive list: a #uLinkedListNode_t is embedded in the
+ * structure that is to be in the list, so adding and removing entries
+ * allocates nothing and removal needs no search; use
+ * #U_LINKED_LIST_CONTAINER_OF() to get from a node back to the
+ * structure it is embedded in.
  */
 
 #ifdef __cplusplus
@@ -31,6 +40,12 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** Get a pointer to the structure of the given type that the
+ * intrusive list node pNode is embedded in as the given member.
+ */
+#define U_LINKED_LIST_CONTAINER_OF(pNode, type, member) \
+    ((type *) (((char *) (pNode)) - offsetof(type, member)))
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -42,6 +57,20 @@ typedef struct uLinkedList_t {
     struct uLinkedList_t *pNext;
 } uLinkedList_t;
 
+/** An intrusive linked-list node, to be embedded in the structure
+ * that is to be in the list; the root of the list is a pointer to
+ * the first node, NULL when the list is empty.  The contents should
+ * be treated as private, except that the list may be walked with
+ * pNext, which is NULL at the end of the list.
+ */
+typedef struct uLinkedListNode_t {
+    struct uLinkedListNode_t *pNext;
+    struct uLinkedListNode_t *pPrevious; /**< for the first node in
+                                              the list this is the last
+                                              node in the list, so that
+                                              adding to the end is quick. */
+} uLinkedListNode_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -80,6 +109,34 @@ uLinkedList_t *pULinkedListFind(uLinkedList_t **ppList, void *p);
  */
 bool uLinkedListRemove(uLinkedList_t **ppList, void *p);
 
+/** Add a node to the end of an intrusive linked list; nothing is
+ * allocated.  This function is NOT thread-safe.
+ *
+ * @param[in] ppList  a pointer to the root of the linked list,
+ *                    cannot be NULL.
+ * @param[in] pNode   the node to add, which must not already be
+ *                    in a list; cannot be NULL.
+ */
+void uLinkedListNodeAdd(uLinkedListNode_t **ppList, uLinkedListNode_t *pNode);
+
+/** Remove a node from an intrusive linked list; no search is
+ * necessary.  This function is NOT thread-safe.
+ *
+ * @param[in] ppList  a pointer to the root of the linked list,
+ *                    cannot be NULL.
+ * @param[in] pNode   the node to remove, which must be in the
+ *                    list at ppList; cannot be NULL.
+ */
+void uLinkedListNodeRemove(uLinkedListNode_t **ppList, uLinkedListNode_t *pNode);
+
+/** Determine if a node is in an intrusive linked list; this works
+ * for a node that has been zeroed or has been removed from a list.
+ *
+ * @param[in] pNode  the node; cannot be NULL.
+ * @return           true if the node is in a list, else false.
+ */
+bool uLinkedListNodeIsInList(const uLinkedListNode_t *pNode);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,11 @@
  * API for efficient EDM transport.  The API functions are thread-safe except for the
  * uMemPoolInit() and uMemPoolDeinit() APIs, which should not be called while any
  * of the other API calls are in progress.
+ *
+ * A memory pool on which uMemPoolSetLockFree() has been called takes no mutex in
+ * uMemPoolAllocMem() and uMemPoolFreeMem(): its free list is a lock-free stack,
+ * so those two functions may also be called from interrupt context and, on a
+ * multi-core MCU such as ESP32, from any core.
  */
 #ifdef __cplusplus
 extern "C" {
@@ -47,12 +52,36 @@ extern "C" {
 typedef struct {
     uint32_t blockSize; /**< the size of each block. */
     int32_t usedBlockCount; /**< the number of currently used blocks. */
-    int32_t totalBlockCount; /**< the total number of blocks. */
+    int32_t totalBlockCount; /**< the number of blocks in pBuffer. */
     struct uMemPoolFree *pFreeList; /**< linked list of free blocks. */
     uint8_t *pBuffer; /**< data buffer (sub-divided into blocks). */
     uPortMutexHandle_t mutex; /**< mutex for thread protection. */
+    int32_t maxUsedBlockCount; /**< the high-water mark of usedBlockCount. */
+    int32_t allocFailCount; /**< the number of failed allocations. */
+    int32_t growBlockCount; /**< the number of blocks in each secondary
+                                 segment, zero if the pool may not grow. */
+    int32_t maxBlockCount; /**< the limit on the number of blocks,
+                                including those of secondary segments. */
+    int32_t segmentBlockCount; /**< the number of blocks in secondary segments. */
+    struct uMemPoolSegment *pSegmentList; /**< linked list of secondary segments. */
+    bool lockFree; /**< true if uMemPoolSetLockFree() has been called. */
+    volatile int32_t lockFreeHead; /**< the head of the lock-free free list: the
+                                        index plus one of the first free block,
+                                        zero if there is none, in the lower 16
+                                        bits and a change count in the upper. */
 } uMemPoolDesc_t;
 
+/** Statistics of a memory pool, see uMemPoolGetStatistics().
+ */
+typedef struct {
+    int32_t totalBlockCount; /**< the number of blocks, including those
+                                  of secondary segments. */
+    int32_t usedBlockCount; /**< the number of blocks currently in use. */
+    int32_t maxUsedBlockCount; /**< the largest number of blocks ever in use. */
+    int32_t allocFailCount; /**< the number of allocations that failed. */
+    int32_t segmentCount; /**< the number of secondary segments added. */
+} uMemPoolStatistics_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -67,6 +96,43 @@ typedef struct {
  */
 int32_t uMemPoolInit(uMemPoolDesc_t *pMemPool, uint32_t blockSize, int32_t numOfBlks);
 
+/** Allow a memory pool to grow: when all of its blocks are in use
+ * a secondary segment of growNumOfBlks further blocks is allocated
+ * from the heap, up to a total of maxNumOfBlks blocks.  Secondary
+ * segments are only released by uMemPoolDeinit().  Call this after
+ * uMemPoolInit() and before the pool is used.
+ *
+ * @param pMemPool      pointer to the memory pool.
+ * @param growNumOfBlks the number of blocks in each secondary segment;
+ *                      zero (the default) means the pool cannot grow.
+ * @param maxNumOfBlks  the limit on the total number of blocks; must be
+ *                      at least the number given to uMemPoolInit() if
+ *                      growNumOfBlks is non-zero.
+ * @return              zero on success else negative error code.
+ */
+int32_t uMemPoolSetGrowth(uMemPoolDesc_t *pMemPool, int32_t growNumOfBlks,
+                          int32_t maxNumOfBlks);
+
+/** Make a memory pool lock-free: uMemPoolAllocMem() and uMemPoolFreeMem()
+ * will not take the mutex of the pool and so may be called from interrupt
+ * context.  The buffer of the pool is allocated here, rather than on first
+ * use, and a lock-free pool cannot grow (see uMemPoolSetGrowth()).  Call this
+ * after uMemPoolInit() and before the pool is used.
+ *
+ * @param pMemPool      pointer to the memory pool; the number of blocks
+ *                      given to uMemPoolInit() must be less than 65536.
+ * @return              zero on success else negative error code.
+ */
+int32_t uMemPoolSetLockFree(uMemPoolDesc_t *pMemPool);
+
+/** Get the statistics of a memory pool.
+ *
+ * @param pMemPool      pointer to the memory pool.
+ * @param[out] pStats   a place to put the statistics, cannot be NULL.
+ * @return              zero on success else negative error code.
+ */
+int32_t uMemPoolGetStatistics(uMemPoolDesc_t *pMemPool, uMemPoolStatistics_t *pStats);
+
 /** Deinitialize memory pool. This API will free all the references to the block
  *  and the pool itself.
  *
@@ -74,6 +140,15 @@ int32_t uMemPoolInit(uMemPoolDesc_t *pMemPool, uint32_t blockSize, int32_t numOf
  */
 void uMemPoolDeinit(uMemPoolDesc_t *pMemPool);
 
+/** Determine whether a block of memory belongs to the given pool,
+ *  e.g. to decide which of several pools to free it to.
+ *
+ * @param pMemPool      pointer to the memory pool.
+ * @param[in] pMem      pointer to the block.
+ * @return              true if pMem lies within the pool, else false.
+ */
+bool uMemPoolContains(uMemPoolDesc_t *pMemPool, const void *pMem);
+
 /** Allocate memory from the given pool.
  *  The allocated memory will be of size configured during uMemPoolInit.
  *
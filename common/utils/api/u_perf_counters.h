@@ -0,0 +1,201 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_PERF_COUNTERS_H_
+#define _U_PERF_COUNTERS_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** \addtogroup __utils
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines a registry of performance
+ * counters, through which the performance counters and histograms
+ * kept by the various parts of ubxlib, and by the application if
+ * it wishes, can be collected in one go with uPerfCountersSnapshot(),
+ * e.g. for a device management agent to upload.
+ *
+ * Nothing is counted by this API itself: each part of the code that
+ * keeps counters registers a source, a function which is called only
+ * when a snapshot is taken and which reports the current values of
+ * its counters by calling uPerfCountersWriteCounter() and
+ * uPerfCountersWriteHistogram(); hence collecting counters this way
+ * costs nothing until a snapshot is taken.  ubxlib registers:
+ *
+ * - "atClient": per AT client and per AT command, if
+ *   U_CFG_AT_CLIENT_STATS is defined, see uAtClientStatsGet(),
+ * - "sock": per socket, see uSockStatsGet().
+ *
+ * Ring buffers, memory pools and the like are owned by whoever
+ * created them, who may register a source for them.
+ *
+ * A counter is named "<source>.<name>", e.g. "sock.0.bytesSent";
+ * names should contain only printable ASCII characters other than
+ * quotation marks and back-slashes.
+ *
+ * The binary format, #U_PERF_COUNTERS_FORMAT_BINARY, is:
+ *
+ * - the four bytes "UPC" followed by a version byte (1),
+ * - for each counter: a type byte (0 for a counter, 1 for a
+ *   histogram), a length byte, that number of bytes of name (not
+ *   null terminated), and then, for a counter, its value as a
+ *   zig-zag encoded varint (i.e. as in protobuf sint64) or, for a
+ *   histogram, the number of buckets as a varint followed by the
+ *   count in each bucket as a varint.
+ *
+ * The JSON format, #U_PERF_COUNTERS_FORMAT_JSON, is a single
+ * object with a member for each counter, the value of which is a
+ * number or, for a histogram, an array of numbers, e.g.
+ * {"sock.0.bytesSent":1024,"atClient.0.AT+USORD.latencyMs":[0,3,1]}.
+ *
+ * This API is thread-safe; however a source is called with the
+ * registry locked and so uPerfCountersRegister() and
+ * uPerfCountersDeregister() must not be called while holding a
+ * lock which a source might need.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_PERF_COUNTERS_MAX_NUM_SOURCES
+/** The maximum number of sources that may be registered at once.
+ */
+# define U_PERF_COUNTERS_MAX_NUM_SOURCES 16
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The formats in which uPerfCountersSnapshot() can write
+ * the counters.
+ */
+typedef enum {
+    U_PERF_COUNTERS_FORMAT_BINARY, /**< compact binary, see the description
+                                        at the top of this file. */
+    U_PERF_COUNTERS_FORMAT_JSON    /**< a null-terminated JSON object. */
+} uPerfCountersFormat_t;
+
+/** Where a source writes its counters, passed to the source
+ * by uPerfCountersSnapshot(); the contents are private.
+ */
+typedef struct uPerfCountersWriter_t uPerfCountersWriter_t;
+
+/** A source of counters: called by uPerfCountersSnapshot(),
+ * it should call uPerfCountersWriteCounter() and/or
+ * uPerfCountersWriteHistogram() for each of its counters.
+ *
+ * @param pWriter  the writer to pass to uPerfCountersWriteCounter()
+ *                 and uPerfCountersWriteHistogram().
+ * @param pParam   the parameter given to uPerfCountersRegister().
+ */
+typedef void (*uPerfCountersSource_t)(uPerfCountersWriter_t *pWriter,
+                                      void *pParam);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Register a source of counters.  Registering the same pSource
+ * and pParam again has no effect.
+ *
+ * @param[in] pName  the name of the source, which forms the first
+ *                   part of the name of all of its counters; must
+ *                   remain valid until uPerfCountersDeregister()
+ *                   is called, cannot be NULL.
+ * @param pSource    the function which provides the counters,
+ *                   cannot be NULL.
+ * @param[in] pParam a parameter to pass to pSource, may be NULL.
+ * @return           zero on success else negative error code;
+ *                   #U_ERROR_COMMON_NO_MEMORY if there are already
+ *                   #U_PERF_COUNTERS_MAX_NUM_SOURCES sources.
+ */
+int32_t uPerfCountersRegister(const char *pName,
+                              uPerfCountersSource_t pSource,
+                              void *pParam);
+
+/** Deregister a source of counters; when this returns pSource
+ * will not be called again with pParam.
+ *
+ * @param pSource    the function passed to uPerfCountersRegister().
+ * @param[in] pParam the parameter passed to uPerfCountersRegister().
+ */
+void uPerfCountersDeregister(uPerfCountersSource_t pSource,
+                             void *pParam);
+
+/** Called by a source to report the value of a counter.
+ *
+ * @param pWriter    the writer that was passed to the source.
+ * @param[in] pName  the name of the counter, which will be
+ *                   appended to the name of the source after a ".".
+ * @param value      the value of the counter.
+ */
+void uPerfCountersWriteCounter(uPerfCountersWriter_t *pWriter,
+                               const char *pName, int64_t value);
+
+/** Called by a source to report the contents of a histogram.
+ *
+ * @param pWriter     the writer that was passed to the source.
+ * @param[in] pName   the name of the histogram, which will be
+ *                    appended to the name of the source after a ".".
+ * @param[in] pBucket the count in each bucket of the histogram.
+ * @param numBuckets  the number of buckets at pBucket.
+ */
+void uPerfCountersWriteHistogram(uPerfCountersWriter_t *pWriter,
+                                 const char *pName,
+                                 const uint32_t *pBucket,
+                                 size_t numBuckets);
+
+/** Take a snapshot of the counters of all the registered sources.
+ *
+ * @param format      the format to write the counters in.
+ * @param[out] pBuffer the buffer to write the counters to; may be
+ *                    NULL to find out how big a buffer is needed,
+ *                    though note that the number of counters may
+ *                    change in the meantime, e.g. as sockets come
+ *                    and go.
+ * @param bufferSize  the number of bytes at pBuffer; for
+ *                    #U_PERF_COUNTERS_FORMAT_JSON this must include
+ *                    room for a null terminator.
+ * @return            the number of bytes written to pBuffer (or the
+ *                    number that would have been written if pBuffer
+ *                    is NULL), not including any null terminator,
+ *                    else negative error code;
+ *                    #U_ERROR_COMMON_NO_MEMORY if pBuffer is not NULL
+ *                    and bufferSize is too small.
+ */
+int32_t uPerfCountersSnapshot(uPerfCountersFormat_t format,
+                              char *pBuffer, size_t bufferSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_PERF_COUNTERS_H_
+
+// End of file
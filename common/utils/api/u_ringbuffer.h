@@ -44,6 +44,35 @@ extern "C" {
  * TYPES
  * -------------------------------------------------------------- */
 
+/** What happens when data is added to a ring buffer and there is
+ * no room for it behind a particular read handle, see
+ * uRingBufferSetReadPolicyHandle().  Whatever the policy, data is
+ * never thrown away from a read handle that is locked with
+ * uRingBufferLockReadHandle().
+ */
+typedef enum {
+    U_RING_BUFFER_READ_POLICY_DEFAULT,     /**< uRingBufferAdd() fails while
+                                                uRingBufferForceAdd() throws
+                                                away the oldest data of the
+                                                read handle. */
+    U_RING_BUFFER_READ_POLICY_DROP_OLDEST, /**< both uRingBufferAdd() and
+                                                uRingBufferForceAdd() throw
+                                                away the oldest data of the
+                                                read handle, so that a slow
+                                                reader can never cause data
+                                                to be lost to the other
+                                                readers. */
+    U_RING_BUFFER_READ_POLICY_BLOCK_WRITER, /**< both uRingBufferAdd() and
+                                                 uRingBufferForceAdd() fail,
+                                                 as if the read handle were
+                                                 always locked, so that the
+                                                 reader never loses data;
+                                                 the other readers will
+                                                 then lose the data that
+                                                 could not be added. */
+    U_RING_BUFFER_READ_POLICY_MAX_NUM
+} uRingBufferReadPolicy_t;
+
 /** Structure that defines a ring buffer; note that the contents
  * of this structure are internal, subject to change, please use
  * the access functions of this API to get to them, rather than
@@ -74,6 +103,10 @@ typedef struct {
     size_t maxNumReadPointers;      /**< will always be at least 1 for the
                                          "normal" read case. */
     uint64_t dataReadLockBitmap;
+    uint64_t dataReadDropOldestBitmap;  /**< read handles with policy
+                                             #U_RING_BUFFER_READ_POLICY_DROP_OLDEST. */
+    uint64_t dataReadBlockWriterBitmap; /**< read handles with policy
+                                             #U_RING_BUFFER_READ_POLICY_BLOCK_WRITER. */
     bool isMalloced;                /**< true if pDataRead was allocated. */
     char *pDataWrite;
     size_t size;
@@ -99,6 +132,8 @@ typedef struct {
                                          as a result of add or forced add
                                          being unable to write into the
                                          ring buffer. */
+    bool lockFree;                  /**< true if the ring buffer was created
+                                         with uRingBufferCreateLockFree(). */
 } uRingBuffer_t;
 
 typedef void *uParseHandle_t; //!< Parser handle.
@@ -148,6 +183,33 @@ void uRingBufferDump(uRingBuffer_t *pRingBuffer);
 int32_t uRingBufferCreate(uRingBuffer_t *pRingBuffer, char *pLinearBuffer,
                           size_t size);
 
+/** Create a new ring buffer from a linear buffer for the case where
+ * there is exactly one producer (one task or interrupt calling
+ * uRingBufferAdd()) and exactly one consumer (one task calling
+ * uRingBufferRead()): the read and write pointers are then
+ * exchanged atomically and uRingBufferAdd(), uRingBufferRead(),
+ * uRingBufferPeek(), uRingBufferDataSize(), uRingBufferAvailableSize()
+ * and uRingBufferFlush() (the latter three from the consumer) do
+ * not lock the mutex of the ring buffer, hence they are suitable
+ * for the highest-rate data paths.
+ *
+ * The producer cannot move the read pointer, hence uRingBufferForceAdd()
+ * behaves as uRingBufferAdd() on such a ring buffer, and the "read handle"
+ * type API functions are not available; uRingBufferFlushValue() may
+ * only be called by the consumer and uRingBufferReset() only when neither
+ * the producer nor the consumer is active.
+ *
+ * @param[in] pRingBuffer   a pointer to a ring buffer, cannot be NULL.
+ * @param[in] pLinearBuffer a pointer to the linear buffer.
+ * @param size              the size of the linear buffer in bytes; the
+ *                          ring buffer will be of maximum size this
+ *                          number minus one as one byte is used to
+ *                          prevent pointer-wrap.
+ * @return                  zero on success else negative error code.
+ */
+int32_t uRingBufferCreateLockFree(uRingBuffer_t *pRingBuffer, char *pLinearBuffer,
+                                  size_t size);
+
 /** Delete a ring buffer.
  *
  * @param[in] pRingBuffer   a pointer to the ring buffer, cannot be NULL.
@@ -409,6 +471,68 @@ size_t uRingBufferReadHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
 size_t uRingBufferPeekHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
                              char *pData, size_t length, size_t offset);
 
+/** Like uRingBufferPeekHandle() but, rather than copying the data,
+ * return pointers to where it sits in the ring buffer: since the
+ * data may wrap around the end of the linear buffer it is returned
+ * as up to two segments, the second of which will have zero length
+ * if there was no wrap.  The pointers are only valid for as long as
+ * the data remains in the ring buffer; the caller should have
+ * locked the read handle with uRingBufferLockReadHandle() so that
+ * uRingBufferForceAdd() cannot overwrite the data, and should not
+ * read or flush from the handle while using the pointers.  To use
+ * this function the ring buffer must have been created by calling
+ * uRingBufferCreateWithReadHandle() rather than uRingBufferCreate().
+ *
+ * @param[in] pRingBuffer   a pointer to the ring buffer, cannot be NULL.
+ * @param handle            a read handle, as originally  returned by
+ *                          uRingBufferTakeReadHandle().
+ * @param length            the maximum amount of data to peek.
+ * @param[out] ppData1      a place to put a pointer to the first segment
+ *                          of the data; cannot be NULL.
+ * @param[out] pLength1     a place to put the length of the first segment;
+ *                          cannot be NULL.
+ * @param[out] ppData2      a place to put a pointer to the second segment
+ *                          of the data, NULL if there is none; cannot be
+ *                          NULL.
+ * @param[out] pLength2     a place to put the length of the second
+ *                          segment; cannot be NULL.
+ * @return                  the total number of bytes peeked.
+ */
+size_t uRingBufferPeekInPlaceHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
+                                    size_t length,
+                                    const char **ppData1, size_t *pLength1,
+                                    const char **ppData2, size_t *pLength2);
+
+/** Move the read pointer of a read handle on by up to length bytes,
+ * throwing the data away; use this once the data obtained by
+ * uRingBufferPeekInPlaceHandle() has been dealt with.  To use this
+ * function the ring buffer must have been created by calling
+ * uRingBufferCreateWithReadHandle() rather than uRingBufferCreate().
+ *
+ * @param[in] pRingBuffer   a pointer to the ring buffer, cannot be NULL.
+ * @param handle            a read handle, as originally  returned by
+ *                          uRingBufferTakeReadHandle().
+ * @param length            the maximum amount of data to consume.
+ * @return                  the number of bytes consumed.
+ */
+size_t uRingBufferConsumeHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
+                                size_t length);
+
+/** Set what happens when data is added to the ring buffer and there
+ * is no room for it behind the given read handle; the policy of a
+ * read handle returns to #U_RING_BUFFER_READ_POLICY_DEFAULT when it
+ * is given back.  An add that fails does not throw away data from
+ * any read handle.
+ *
+ * @param[in] pRingBuffer   a pointer to the ring buffer, cannot be NULL.
+ * @param handle            a read handle, as originally  returned by
+ *                          uRingBufferTakeReadHandle().
+ * @param policy            the policy.
+ * @return                  zero on success else negative error code.
+ */
+int32_t uRingBufferSetReadPolicyHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
+                                       uRingBufferReadPolicy_t policy);
+
 /** Like uRingBufferDataSize() except for use by an entity that has
  * previously obtained a read handle by calling uRingBufferTakeReadHandle();
  * this mechanism should be employed if there is to be more than one consumer
@@ -43,6 +43,8 @@ extern "C" {
  * TYPES
  * -------------------------------------------------------------- */
 
+struct tm; // Forward declaration, from time.h
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -82,6 +84,45 @@ int64_t uTimeMonthsToSecondsUtc(int32_t monthsUtc);
  */
 int32_t uTimeSecondsToMonthsUtc(int64_t secondsUtc);
 
+/** Return the number of days from the start of 1970 to the given
+ * date of the Gregorian calendar; the calculation takes constant
+ * time, whatever the date.  Not limited to UTC: dates before 1970
+ * give a negative result.
+ *
+ * @param year  the year, e.g. 2023.
+ * @param month the month, 1 to 12.
+ * @param day   the day of the month, 1 to 31.
+ * @return      the number of days since the start of 1970.
+ */
+int64_t uTimeDaysFromCivil(int32_t year, int32_t month, int32_t day);
+
+/** Convert a number of days since the start of 1970 into a date
+ * of the Gregorian calendar, the inverse of uTimeDaysFromCivil().
+ * The calculation takes constant time and the result for the last
+ * day converted is cached, since consecutive timestamps are
+ * usually on the same day.  This function is thread-safe.
+ *
+ * @param days        the number of days since the start of 1970;
+ *                    may be negative.
+ * @param[out] pYear  a place to put the year, e.g. 2023; may be NULL.
+ * @param[out] pMonth a place to put the month, 1 to 12; may be NULL.
+ * @param[out] pDay   a place to put the day of the month, 1 to 31;
+ *                    may be NULL.
+ */
+void uTimeCivilFromDays(int64_t days, int32_t *pYear,
+                        int32_t *pMonth, int32_t *pDay);
+
+/** Convert a number of seconds since 1970 into a struct tm, the
+ * equivalent of gmtime_r() but with a 64-bit input and taking
+ * constant time.  tm_isdst is set to zero.
+ *
+ * @param secondsUtc the number of seconds since 1970; may be
+ *                   negative.
+ * @param[out] pTm   a place to put the result; cannot be NULL.
+ * @return           zero on success else negative error code.
+ */
+int32_t uTimeSecondsToTmUtc(int64_t secondsUtc, struct tm *pTm);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_TIME_SYNC_H_
+#define _U_TIME_SYNC_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** \addtogroup __utils
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines a time service which keeps UTC
+ * time locally, from samples of time obtained from cellular (NITZ,
+ * CellTime) or GNSS, so that the time can be read without an AT
+ * command or UBX message round trip to a module.
+ *
+ * Between samples the time is extrapolated using the local tick,
+ * uPortGetTickTimeMs(), and the drift of the local tick relative
+ * to the sources of time is measured from successive samples and
+ * compensated for.  Samples are fused on the basis of their
+ * accuracy: a new sample is adopted if it is at least as accurate
+ * as the current estimate, the accuracy of which degrades with the
+ * time since it was last adopted.  Hence a GNSS sample will be
+ * preferred over NITZ but, if GNSS goes away, NITZ will take over
+ * once the time extrapolated from the last GNSS sample becomes
+ * worse than NITZ.
+ *
+ * Once uTimeSyncInit() has been called ubxlib feeds samples in
+ * itself whenever uCellInfoGetTimeUtc() or uGnssInfoGetTimeUtc()
+ * succeeds; an application which receives time by other means,
+ * e.g. from a streamed UBX-NAV-PVT message, may call uTimeSyncFeed().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_TIME_SYNC_DRIFT_UNKNOWN_PPB
+/** The uncertainty in the rate of the local tick, in parts per
+ * billion, assumed before its drift has been measured; a typical
+ * crystal will be within 100 ppm.
+ */
+# define U_TIME_SYNC_DRIFT_UNKNOWN_PPB 100000
+#endif
+
+#ifndef U_TIME_SYNC_DRIFT_RESIDUAL_PPB
+/** The uncertainty in the rate of the local tick, in parts per
+ * billion, assumed once its drift has been measured, allowing
+ * for the accuracy of the measurement and for variation with
+ * temperature etc.
+ */
+# define U_TIME_SYNC_DRIFT_RESIDUAL_PPB 10000
+#endif
+
+#ifndef U_TIME_SYNC_DRIFT_MEASUREMENT_ACCURACY_PPB
+/** Two samples are only used to measure the drift of the local
+ * tick if the sum of their accuracies, divided by the time between
+ * them, is no more than this number of parts per billion, i.e.
+ * the less accurate the samples the longer the interval required:
+ * with the default of 10 ppm, samples from a streamed UBX-NAV-PVT
+ * message, limited by the millisecond resolution of the local tick,
+ * need to be a few minutes apart, samples accurate to a second
+ * more than a day apart.
+ */
+# define U_TIME_SYNC_DRIFT_MEASUREMENT_ACCURACY_PPB 10000
+#endif
+
+#ifndef U_TIME_SYNC_DRIFT_LIMIT_PPB
+/** A measured drift bigger than this, in parts per billion, is
+ * taken to mean that a source of time has jumped, rather than
+ * that the local tick has drifted, and is discarded.
+ */
+# define U_TIME_SYNC_DRIFT_LIMIT_PPB 500000
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The sources of time.
+ */
+typedef enum {
+    U_TIME_SYNC_SOURCE_NONE = 0,      /**< no time yet. */
+    U_TIME_SYNC_SOURCE_CELL_NITZ = 1, /**< time from the cellular network,
+                                           e.g. as read by
+                                           uCellInfoGetTimeUtc(). */
+    U_TIME_SYNC_SOURCE_CELL_TIME = 2, /**< time from CellTime. */
+    U_TIME_SYNC_SOURCE_GNSS = 3,      /**< time from GNSS. */
+    U_TIME_SYNC_SOURCE_OTHER = 4,     /**< time from elsewhere, e.g. a
+                                           time server. */
+    U_TIME_SYNC_SOURCE_MAX_NUM
+} uTimeSyncSource_t;
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Initialise the time service.  If the time service is already
+ * initialised this function does nothing and returns success.
+ *
+ * @return zero on success else negative error code.
+ */
+int32_t uTimeSyncInit();
+
+/** Deinitialise the time service, forgetting the time.
+ */
+void uTimeSyncDeinit();
+
+/** Feed a sample of UTC time into the time service.  This function
+ * is thread-safe.
+ *
+ * @param source              the source of the time.
+ * @param timeUtcNanoseconds  the UTC time in nanoseconds since
+ *                            midnight on 1st January 1970.
+ * @param accuracyNanoseconds the accuracy of timeUtcNanoseconds,
+ *                            including any uncertainty as to
+ *                            exactly when it was valid; must not
+ *                            be negative.
+ * @param tickMs              the value of uPortGetTickTimeMs() at
+ *                            which timeUtcNanoseconds was valid,
+ *                            which must not be in the future and
+ *                            should not be more than a few days in
+ *                            the past.
+ * @return                    zero if the sample was adopted,
+ *                            #U_ERROR_COMMON_IGNORED if the current
+ *                            estimate of time is more accurate than
+ *                            the sample, else negative error code.
+ */
+int32_t uTimeSyncFeed(uTimeSyncSource_t source,
+                      int64_t timeUtcNanoseconds,
+                      int64_t accuracyNanoseconds,
+                      int32_t tickMs);
+
+/** Get the current UTC time from the time service; no module is
+ * contacted.  The local tick must have been read, by this function
+ * or by uTimeSyncFeed(), at least once every 49 days for the result
+ * to be correct.  This function is thread-safe.
+ *
+ * @param[out] pAccuracyNanoseconds a place to put the accuracy of
+ *                                  the time; may be NULL.
+ * @param[out] pSource              a place to put the source of the
+ *                                  sample on which the time is based;
+ *                                  may be NULL.
+ * @return                          on success the UTC time in
+ *                                  nanoseconds since midnight on 1st
+ *                                  January 1970, else negative error
+ *                                  code; #U_ERROR_COMMON_EMPTY if no
+ *                                  sample has been adopted yet.
+ */
+int64_t uTimeSyncNowUtc(int64_t *pAccuracyNanoseconds,
+                        uTimeSyncSource_t *pSource);
+
+/** Get the drift of the local tick, as measured by the time service.
+ * This function is thread-safe.
+ *
+ * @param[out] pDriftPpb a place to put the drift in parts per
+ *                       billion, positive if the local tick is
+ *                       running slow, i.e. UTC advances faster
+ *                       than the local tick; cannot be NULL.
+ * @return               zero on success, #U_ERROR_COMMON_EMPTY
+ *                       if the drift has not yet been measured,
+ *                       else negative error code.
+ */
+int32_t uTimeSyncDriftGet(int32_t *pDriftPpb);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_TIME_SYNC_H_
+
+// End of file
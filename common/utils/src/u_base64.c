@@ -30,6 +30,9 @@
 
 #include "stddef.h"    // size_t
 #include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_error_common.h"
 
 #include "u_base64.h"
 
@@ -43,6 +46,18 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** Marker in gDecode[] for a character that is not base 64.
+ */
+#define XX 0xFF
+
+/** Marker in gDecode[] for white space, which is skipped.
+ */
+#define WS 0xFE
+
+/** Marker in gDecode[] for the padding character '='.
+ */
+#define PD 0xFD
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -51,10 +66,60 @@
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
 
+/** The base 64 alphabet, used by the streaming encoder.
+ */
+static const char gEncode[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                              "abcdefghijklmnopqrstuvwxyz"
+                              "0123456789+/";
+
+/** The value of each character, used by the streaming decoder.
+ */
+static const uint8_t gDecode[256] = {
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, WS, WS, XX, XX, WS, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    WS, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, 62, XX, XX, XX, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, XX, XX, XX, PD, XX, XX,
+    XX,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, XX, XX, XX, XX, XX,
+    XX, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX
+};
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Encode a group of three bytes as four characters.
+static inline void encodeGroup(const uint8_t *pIn, char *pOut)
+{
+    uint32_t group = (((uint32_t) pIn[0]) << 16) |
+                     (((uint32_t) pIn[1]) << 8) | pIn[2];
+
+    pOut[0] = gEncode[(group >> 18) & 0x3F];
+    pOut[1] = gEncode[(group >> 12) & 0x3F];
+    pOut[2] = gEncode[(group >> 6) & 0x3F];
+    pOut[3] = gEncode[group & 0x3F];
+}
+
+// Decode a group of four 6-bit values into three bytes.
+static inline void decodeGroup(const uint8_t *pIn, char *pOut)
+{
+    uint32_t group = (((uint32_t) pIn[0]) << 18) | (((uint32_t) pIn[1]) << 12) |
+                     (((uint32_t) pIn[2]) << 6) | pIn[3];
+
+    pOut[0] = (char) (group >> 16);
+    pOut[1] = (char) (group >> 8);
+    pOut[2] = (char) group;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -101,4 +166,187 @@ int32_t uBase64Decode(const char *pBase64, size_t base64LengthBytes,
     return bytesDecoded;
 }
 
+// Initialise the state of a streaming encode or decode.
+void uBase64StreamInit(uBase64Stream_t *pStream)
+{
+    if (pStream != NULL) {
+        pStream->carryLength = 0;
+        pStream->padded = false;
+    }
+}
+
+// Encode a chunk of binary data.
+int32_t uBase64EncodeStream(uBase64Stream_t *pStream,
+                            const char *pBinary, size_t binaryLengthBytes,
+                            char *pBase64, size_t base64LengthBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    const uint8_t *pIn = (const uint8_t *) pBinary;
+    char *pOut = pBase64;
+    size_t x;
+
+    if ((pStream != NULL) && (pStream->carryLength < 3) &&
+        ((pBinary != NULL) || (binaryLengthBytes == 0))) {
+        errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        x = ((pStream->carryLength + binaryLengthBytes) / 3) * 4;
+        if ((x == 0) || ((pBase64 != NULL) && (base64LengthBytes >= x))) {
+            // Complete any group left over from last time
+            while ((pStream->carryLength > 0) && (binaryLengthBytes > 0)) {
+                pStream->carry[pStream->carryLength] = *pIn;
+                pStream->carryLength++;
+                pIn++;
+                binaryLengthBytes--;
+                if (pStream->carryLength == 3) {
+                    encodeGroup(pStream->carry, pOut);
+                    pOut += 4;
+                    pStream->carryLength = 0;
+                }
+            }
+            // Whole groups straight from the input
+            while (binaryLengthBytes >= 3) {
+                encodeGroup(pIn, pOut);
+                pOut += 4;
+                pIn += 3;
+                binaryLengthBytes -= 3;
+            }
+            // Carry whatever remains over to next time
+            while (binaryLengthBytes > 0) {
+                pStream->carry[pStream->carryLength] = *pIn;
+                pStream->carryLength++;
+                pIn++;
+                binaryLengthBytes--;
+            }
+            errorCodeOrLength = (int32_t) (pOut - pBase64);
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// Finish a streaming encode.
+int32_t uBase64EncodeStreamFinish(uBase64Stream_t *pStream,
+                                  char *pBase64, size_t base64LengthBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pStream != NULL) && (pStream->carryLength < 3)) {
+        errorCodeOrLength = 0;
+        if (pStream->carryLength > 0) {
+            errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            if ((pBase64 != NULL) && (base64LengthBytes >= 4)) {
+                if (pStream->carryLength < 2) {
+                    pStream->carry[1] = 0;
+                }
+                pStream->carry[2] = 0;
+                encodeGroup(pStream->carry, pBase64);
+                pBase64[3] = '=';
+                if (pStream->carryLength < 2) {
+                    pBase64[2] = '=';
+                }
+                pStream->carryLength = 0;
+                errorCodeOrLength = 4;
+            }
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// Decode a chunk of base 64 data.
+int32_t uBase64DecodeStream(uBase64Stream_t *pStream,
+                            const char *pBase64, size_t base64LengthBytes,
+                            char *pBinary, size_t binaryLengthBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    const uint8_t *pIn = (const uint8_t *) pBase64;
+    char *pOut = pBinary;
+    uint8_t group[4];
+    uint8_t value;
+
+    if ((pStream != NULL) && (pStream->carryLength < 4) &&
+        ((pBase64 != NULL) || (base64LengthBytes == 0))) {
+        errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        if ((base64LengthBytes == 0) ||
+            ((pBinary != NULL) &&
+             (binaryLengthBytes >= U_BASE64_DECODE_STREAM_LENGTH_MAX(base64LengthBytes)))) {
+            errorCodeOrLength = 0;
+            for (; (base64LengthBytes > 0) && (errorCodeOrLength == 0); base64LengthBytes--, pIn++) {
+                value = gDecode[*pIn];
+                if (value < 64) {
+                    if (pStream->padded) {
+                        // Nothing may follow the padding
+                        errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+                    } else {
+                        pStream->carry[pStream->carryLength] = value;
+                        pStream->carryLength++;
+                        if (pStream->carryLength == 4) {
+                            decodeGroup(pStream->carry, pOut);
+                            pOut += 3;
+                            pStream->carryLength = 0;
+                            // Whole groups straight from the input, for
+                            // as long as there is no white space
+                            while ((base64LengthBytes > 4) &&
+                                   ((gDecode[pIn[1]] | gDecode[pIn[2]] |
+                                     gDecode[pIn[3]] | gDecode[pIn[4]]) < 64)) {
+                                group[0] = gDecode[pIn[1]];
+                                group[1] = gDecode[pIn[2]];
+                                group[2] = gDecode[pIn[3]];
+                                group[3] = gDecode[pIn[4]];
+                                decodeGroup(group, pOut);
+                                pOut += 3;
+                                pIn += 4;
+                                base64LengthBytes -= 4;
+                            }
+                        }
+                    }
+                } else if (value == PD) {
+                    // Padding may only come after two or three characters
+                    // of a group, or after padding
+                    if ((pStream->carryLength < 2) && !pStream->padded) {
+                        errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+                    } else {
+                        pStream->padded = true;
+                    }
+                } else if (value != WS) {
+                    errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+                }
+            }
+            if (errorCodeOrLength == 0) {
+                errorCodeOrLength = (int32_t) (pOut - pBinary);
+            }
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// Finish a streaming decode.
+int32_t uBase64DecodeStreamFinish(uBase64Stream_t *pStream,
+                                  char *pBinary, size_t binaryLengthBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pStream != NULL) && (pStream->carryLength < 4) &&
+        (pStream->carryLength != 1)) {
+        errorCodeOrLength = 0;
+        if (pStream->carryLength > 0) {
+            errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            if ((pBinary != NULL) && (binaryLengthBytes >= 3)) {
+                // Two characters make one byte, three make two
+                pBinary[0] = (char) ((pStream->carry[0] << 2) | (pStream->carry[1] >> 4));
+                if (pStream->carryLength == 3) {
+                    pBinary[1] = (char) ((pStream->carry[1] << 4) | (pStream->carry[2] >> 2));
+                }
+                errorCodeOrLength = pStream->carryLength - 1;
+            }
+        }
+        if (errorCodeOrLength >= 0) {
+            pStream->carryLength = 0;
+            pStream->padded = false;
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
 // End of file
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of a small open-addressing hash map.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_error_common.h"
+
+#include "u_hash_map.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Return the index in the table at which a key would ideally be;
+// keys are often pointers or small integers, neither of which are
+// well spread, so mix the bits up with the MurmurHash3 finaliser.
+static size_t homeIndex(const uHashMap_t *pMap, uintptr_t key)
+{
+    uint32_t x = (uint32_t) key;
+
+    if (sizeof(key) > sizeof(x)) {
+        x ^= (uint32_t) (((uint64_t) key) >> 32);
+    }
+    x ^= x >> 16;
+    x *= 0x85ebca6bUL;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35UL;
+    x ^= x >> 16;
+
+    return (size_t) x & (pMap->numEntries - 1);
+}
+
+// Return the index of the entry holding the given key or, if
+// the key is not there, of the empty entry where it would go;
+// since the table always has at least one empty entry this
+// cannot go on for ever.
+static size_t findIndex(const uHashMap_t *pMap, uintptr_t key)
+{
+    size_t x = homeIndex(pMap, key);
+
+    while ((pMap->pEntries[x].pValue != NULL) &&
+           (pMap->pEntries[x].key != key)) {
+        x = (x + 1) & (pMap->numEntries - 1);
+    }
+
+    return x;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Initialise a hash map.
+int32_t uHashMapInit(uHashMap_t *pMap, uHashMapEntry_t *pEntries,
+                     size_t numEntries)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pMap != NULL) && (pEntries != NULL) && (numEntries > 1) &&
+        ((numEntries & (numEntries - 1)) == 0)) {
+        pMap->pEntries = pEntries;
+        pMap->numEntries = numEntries;
+        pMap->count = 0;
+        for (size_t x = 0; x < numEntries; x++) {
+            pEntries[x].key = 0;
+            pEntries[x].pValue = NULL;
+        }
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
+// Set the value for a key.
+int32_t uHashMapSet(uHashMap_t *pMap, uintptr_t key, void *pValue)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    size_t x;
+
+    if ((pMap != NULL) && (pMap->pEntries != NULL) && (pValue != NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        x = findIndex(pMap, key);
+        if (pMap->pEntries[x].pValue == NULL) {
+            // A new key: always leave one entry empty so
+            // that findIndex() terminates
+            if (pMap->count < pMap->numEntries - 1) {
+                pMap->pEntries[x].key = key;
+                pMap->count++;
+            } else {
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            }
+        }
+        if (errorCode == 0) {
+            pMap->pEntries[x].pValue = pValue;
+        }
+    }
+
+    return errorCode;
+}
+
+// Get the value for a key.
+void *pUHashMapGet(const uHashMap_t *pMap, uintptr_t key)
+{
+    void *pValue = NULL;
+
+    if ((pMap != NULL) && (pMap->pEntries != NULL) && (pMap->count > 0)) {
+        pValue = pMap->pEntries[findIndex(pMap, key)].pValue;
+    }
+
+    return pValue;
+}
+
+// Remove a key.
+void *pUHashMapRemove(uHashMap_t *pMap, uintptr_t key)
+{
+    void *pValue = NULL;
+    size_t mask;
+    size_t x;
+    size_t y;
+    size_t home;
+
+    if ((pMap != NULL) && (pMap->pEntries != NULL) && (pMap->count > 0)) {
+        mask = pMap->numEntries - 1;
+        x = findIndex(pMap, key);
+        pValue = pMap->pEntries[x].pValue;
+        if (pValue != NULL) {
+            pMap->pEntries[x].pValue = NULL;
+            pMap->count--;
+            // Rather than leaving a tombstone, shift back any entries
+            // further along the run that would otherwise no longer be
+            // found: an entry at y may move into the hole at x unless
+            // its home index lies cyclically in (x, y]
+            y = x;
+            for (;;) {
+                y = (y + 1) & mask;
+                if (pMap->pEntries[y].pValue == NULL) {
+                    break;
+                }
+                home = homeIndex(pMap, pMap->pEntries[y].key);
+                if (((y - home) & mask) >= ((y - x) & mask)) {
+                    pMap->pEntries[x] = pMap->pEntries[y];
+                    pMap->pEntries[y].pValue = NULL;
+                    x = y;
+                }
+            }
+        }
+    }
+
+    return pValue;
+}
+
+// Get the number of values.
+size_t uHashMapGetCount(const uHashMap_t *pMap)
+{
+    size_t count = 0;
+
+    if (pMap != NULL) {
+        count = pMap->count;
+    }
+
+    return count;
+}
+
+// End of file
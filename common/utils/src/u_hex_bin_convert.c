@@ -41,6 +41,30 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** The value in gHexToNibble[] for a character that is not
+ * ASCII hex.
+ */
+#define U_HEX_BIN_CONVERT_INVALID 0x10
+
+/** Helper for building gHexToNibble[]: sixteen invalid entries.
+ */
+#define U_HEX_BIN_CONVERT_INVALID_16 U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID, \
+                                     U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID, \
+                                     U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID, \
+                                     U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID, \
+                                     U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID, \
+                                     U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID, \
+                                     U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID, \
+                                     U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID
+
+/** Helper for building gBinToHex[]: the sixteen entries for the
+ * bytes with the given upper hex digit.
+ */
+#define U_HEX_BIN_CONVERT_ROW(hi) {hi, '0'}, {hi, '1'}, {hi, '2'}, {hi, '3'}, \
+                                  {hi, '4'}, {hi, '5'}, {hi, '6'}, {hi, '7'}, \
+                                  {hi, '8'}, {hi, '9'}, {hi, 'A'}, {hi, 'B'}, \
+                                  {hi, 'C'}, {hi, 'D'}, {hi, 'E'}, {hi, 'F'}
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -49,9 +73,56 @@
  * VARIABLES
  * -------------------------------------------------------------- */
 
-static const char gHex[] = {'0', '1', '2', '3', '4', '5', '6', '7',
-                            '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
-                           };
+/** Table to convert a byte into its two ASCII hex characters in
+ * one look-up.
+ */
+static const char gBinToHex[256][2] = {
+    U_HEX_BIN_CONVERT_ROW('0'), U_HEX_BIN_CONVERT_ROW('1'),
+    U_HEX_BIN_CONVERT_ROW('2'), U_HEX_BIN_CONVERT_ROW('3'),
+    U_HEX_BIN_CONVERT_ROW('4'), U_HEX_BIN_CONVERT_ROW('5'),
+    U_HEX_BIN_CONVERT_ROW('6'), U_HEX_BIN_CONVERT_ROW('7'),
+    U_HEX_BIN_CONVERT_ROW('8'), U_HEX_BIN_CONVERT_ROW('9'),
+    U_HEX_BIN_CONVERT_ROW('A'), U_HEX_BIN_CONVERT_ROW('B'),
+    U_HEX_BIN_CONVERT_ROW('C'), U_HEX_BIN_CONVERT_ROW('D'),
+    U_HEX_BIN_CONVERT_ROW('E'), U_HEX_BIN_CONVERT_ROW('F')
+};
+
+/** Table to convert an ASCII hex character, upper or lower case,
+ * into its value, U_HEX_BIN_CONVERT_INVALID if it is not hex.
+ */
+static const uint8_t gHexToNibble[256] = {
+    U_HEX_BIN_CONVERT_INVALID_16, // 0x00
+    U_HEX_BIN_CONVERT_INVALID_16, // 0x10
+    U_HEX_BIN_CONVERT_INVALID_16, // 0x20
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, // 0x30: '0' to '9'
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    // 0x40: 'A' to 'F'
+    U_HEX_BIN_CONVERT_INVALID, 10, 11, 12, 13, 14, 15,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID_16, // 0x50
+    // 0x60: 'a' to 'f'
+    U_HEX_BIN_CONVERT_INVALID, 10, 11, 12, 13, 14, 15,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID, U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID,
+    U_HEX_BIN_CONVERT_INVALID_16, // 0x70
+    U_HEX_BIN_CONVERT_INVALID_16, // 0x80
+    U_HEX_BIN_CONVERT_INVALID_16, // 0x90
+    U_HEX_BIN_CONVERT_INVALID_16, // 0xA0
+    U_HEX_BIN_CONVERT_INVALID_16, // 0xB0
+    U_HEX_BIN_CONVERT_INVALID_16, // 0xC0
+    U_HEX_BIN_CONVERT_INVALID_16, // 0xD0
+    U_HEX_BIN_CONVERT_INVALID_16, // 0xE0
+    U_HEX_BIN_CONVERT_INVALID_16  // 0xF0
+};
 
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
@@ -59,13 +130,16 @@ static const char gHex[] = {'0', '1', '2', '3', '4', '5', '6', '7',
 
 size_t uBinToHex(const char *pBin, size_t binLength, char *pHex)
 {
+    const char *pPair;
+
     U_ASSERT(pHex != NULL);
 
+    // One table look-up per byte
     for (size_t x = 0; x < binLength; x++) {
-        *pHex = gHex[((unsigned char) * pBin) >> 4];
-        pHex++;
-        *pHex = gHex[*pBin & 0x0f];
-        pHex++;
+        pPair = gBinToHex[(uint8_t) *pBin];
+        pHex[0] = pPair[0];
+        pHex[1] = pPair[1];
+        pHex += 2;
         pBin++;
     }
 
@@ -74,36 +148,43 @@ size_t uBinToHex(const char *pBin, size_t binLength, char *pHex)
 
 size_t uHexToBin(const char *pHex, size_t hexLength, char *pBin)
 {
-    bool success = true;
     size_t length;
-    char z[2];
+    uint8_t hi;
+    uint8_t lo;
+    uint8_t hi2;
+    uint8_t lo2;
 
     U_ASSERT(pBin != NULL);
 
-    for (length = 0; (length < hexLength / 2) && success; length++) {
-        z[0] = *pHex - '0';
+    // One table look-up per character: the invalid marker
+    // has bit 4 set, which no valid nibble does, so a single
+    // test covers both characters of a pair; where there is
+    // room, two pairs are done at a time, with a single test
+    // covering all four characters
+    for (length = 0; length + 1 < hexLength / 2; length += 2) {
+        hi = gHexToNibble[(uint8_t) pHex[0]];
+        lo = gHexToNibble[(uint8_t) pHex[1]];
+        hi2 = gHexToNibble[(uint8_t) pHex[2]];
+        lo2 = gHexToNibble[(uint8_t) pHex[3]];
+        if ((hi | lo | hi2 | lo2) & U_HEX_BIN_CONVERT_INVALID) {
+            // Let the loop below sort out which one it was
+            break;
+        }
+        pBin[0] = (char) ((hi << 4) | lo);
+        pBin[1] = (char) ((hi2 << 4) | lo2);
+        pHex += 4;
+        pBin += 2;
+    }
+    for (; length < hexLength / 2; length++) {
+        hi = gHexToNibble[(uint8_t) *pHex];
         pHex++;
-        z[1] = *pHex - '0';
+        lo = gHexToNibble[(uint8_t) *pHex];
         pHex++;
-        for (size_t y = 0; (y < sizeof(z)) && success; y++) {
-            if (z[y] > 9) {
-                // Must be A to F or a to f
-                z[y] -= 'A' - '0';
-                z[y] += 10;
-            }
-            if (z[y] > 15) {
-                // Must be a to f
-                z[y] -= 'a' - 'A';
-            }
-            // Cast here to shut-up a warning under ESP-IDF
-            // which appears to have chars as unsigned and
-            // hence thinks the first condition is always true
-            success = ((signed char) z[y] >= 0) && (z[y] <= 15);
-        }
-        if (success) {
-            *pBin = (char) (((z[0] & 0x0f) << 4) | z[1]);
-            pBin++;
+        if ((hi | lo) & U_HEX_BIN_CONVERT_INVALID) {
+            break;
         }
+        *pBin = (char) ((hi << 4) | lo);
+        pBin++;
     }
 
     return length;
@@ -104,4 +104,47 @@ bool uLinkedListRemove(uLinkedList_t **ppList, void *p)
     return false;
 }
 
+void uLinkedListNodeAdd(uLinkedListNode_t **ppList, uLinkedListNode_t *pNode)
+{
+    if ((ppList != NULL) && (pNode != NULL)) {
+        pNode->pNext = NULL;
+        if (*ppList == NULL) {
+            pNode->pPrevious = pNode;
+            *ppList = pNode;
+        } else {
+            // The previous pointer of the first node is the last node
+            pNode->pPrevious = (*ppList)->pPrevious;
+            (*ppList)->pPrevious->pNext = pNode;
+            (*ppList)->pPrevious = pNode;
+        }
+    }
+}
+
+void uLinkedListNodeRemove(uLinkedListNode_t **ppList, uLinkedListNode_t *pNode)
+{
+    if ((ppList != NULL) && (*ppList != NULL) && (pNode != NULL)) {
+        if (pNode == *ppList) {
+            *ppList = pNode->pNext;
+        } else {
+            pNode->pPrevious->pNext = pNode->pNext;
+        }
+        if (pNode->pNext != NULL) {
+            pNode->pNext->pPrevious = pNode->pPrevious;
+        } else if (*ppList != NULL) {
+            // Removed the last node: the first node must now
+            // point to the new last node
+            (*ppList)->pPrevious = pNode->pPrevious;
+        }
+        pNode->pNext = NULL;
+        pNode->pPrevious = NULL;
+    }
+}
+
+bool uLinkedListNodeIsInList(const uLinkedListNode_t *pNode)
+{
+    // A node in a list always has a previous pointer, even if
+    // it is only to itself
+    return (pNode != NULL) && (pNode->pPrevious != NULL);
+}
+
 // End of file
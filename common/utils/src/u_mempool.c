@@ -36,6 +36,7 @@
 #include "u_assert.h"
 #include "u_port.h"
 #include "u_port_os.h"
+#include "u_port_atomic.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
 #include "u_mempool.h"
@@ -52,11 +53,21 @@
 # define U_MEMPOOL_USE_BUF_FENCE 1
 #endif
 
+// The alignment of each block, which must be that of the worst-case
+// structure type, as for pUPortMalloc(), since a block may hold
+// anything; must be a power of two.
+#ifndef U_MEMPOOL_BLOCK_ALIGNMENT
+# define U_MEMPOOL_BLOCK_ALIGNMENT (sizeof(void *) * 2)
+#endif
+
+#define U_ALIGN_UP(size) \
+    (((size) + U_MEMPOOL_BLOCK_ALIGNMENT - 1) & ~(U_MEMPOOL_BLOCK_ALIGNMENT - 1))
+
 #if U_MEMPOOL_USE_BUF_FENCE
 # define U_REAL_BLOCK_SIZE(userBlockSize) \
-    (userBlockSize + sizeof(uint16_t))
+    U_ALIGN_UP((userBlockSize) + sizeof(uint16_t))
 #else
-# define U_REAL_BLOCK_SIZE(userBlockSize) (userBlockSize)
+# define U_REAL_BLOCK_SIZE(userBlockSize) U_ALIGN_UP(userBlockSize)
 #endif
 
 #define U_BUFFER_SIZE(pMemPool) \
@@ -64,6 +75,16 @@
 
 #define U_FENCE_MAGIC 0xBEEF
 
+// The part of lockFreeHead that is the index plus one of the
+// first free block.
+#define U_LOCK_FREE_INDEX_MASK 0xFFFFUL
+
+// Added to lockFreeHead on every change so that, should the
+// first free block be taken and put back while a task or interrupt
+// is part way through taking it, the head will not compare equal
+// (the "ABA" problem).
+#define U_LOCK_FREE_CHANGE_INCREMENT 0x10000UL
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -72,6 +93,14 @@ typedef struct uMemPoolFree {
     struct uMemPoolFree *pNext;
 } uMemPoolFreeList_t;
 
+/** A secondary segment of a memory pool, allocated when the pool
+ * runs dry; the blocks follow immediately after this header.
+ */
+typedef struct uMemPoolSegment {
+    struct uMemPoolSegment *pNext;
+    int32_t blockCount;
+} uMemPoolSegment_t;
+
 /* ----------------------------------------------------------------
  * PROTOTYPES
  * -------------------------------------------------------------- */
@@ -84,23 +113,157 @@ typedef struct uMemPoolFree {
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Add all of the blocks of a buffer to the free list, in order,
+// ahead of whatever is already there.
+static void addToFreeList(uMemPoolDesc_t *pMemPool, uint8_t *pBuffer,
+                          int32_t blockCount)
+{
+    size_t realBlockSize = U_REAL_BLOCK_SIZE(pMemPool->blockSize);
+
+    for (int32_t i = blockCount - 1; i >= 0; i--) {
+        uMemPoolFreeList_t *pFree = (uMemPoolFreeList_t *)&pBuffer[i * realBlockSize];
+        pFree->pNext = pMemPool->pFreeList;
+        pMemPool->pFreeList = pFree;
+    }
+}
+
 static void initFreeList(uMemPoolDesc_t *pMemPool)
 {
     // Initialize the freed linked list
     U_ASSERT(pMemPool->pBuffer != NULL);
-    uMemPoolFreeList_t *pLastFree = (uMemPoolFreeList_t *)pMemPool->pBuffer;
-    pMemPool->pFreeList = pLastFree;
-    for (int i = 1; i < pMemPool->totalBlockCount; i++) {
-        uMemPoolFreeList_t *pFree;
-        size_t realBlockSize = U_REAL_BLOCK_SIZE(pMemPool->blockSize);
-        pFree = (uMemPoolFreeList_t *)&pMemPool->pBuffer[i * realBlockSize];
-        pLastFree->pNext = pFree;
-        pLastFree = pFree;
-    }
-    pLastFree->pNext = NULL;
+    pMemPool->pFreeList = NULL;
+    for (uMemPoolSegment_t *pSegment = pMemPool->pSegmentList;
+         pSegment != NULL; pSegment = pSegment->pNext) {
+        addToFreeList(pMemPool, (uint8_t *)(pSegment + 1), pSegment->blockCount);
+    }
+    addToFreeList(pMemPool, pMemPool->pBuffer, pMemPool->totalBlockCount);
+    pMemPool->usedBlockCount = 0;
+}
+
+// Add a secondary segment to a memory pool, if it is allowed to grow.
+static void grow(uMemPoolDesc_t *pMemPool)
+{
+    uMemPoolSegment_t *pSegment;
+
+    if ((pMemPool->growBlockCount > 0) &&
+        (pMemPool->totalBlockCount + pMemPool->segmentBlockCount +
+         pMemPool->growBlockCount <= pMemPool->maxBlockCount)) {
+        pSegment = (uMemPoolSegment_t *)pUPortMalloc(sizeof(uMemPoolSegment_t) +
+                                                     (U_REAL_BLOCK_SIZE(pMemPool->blockSize) *
+                                                      pMemPool->growBlockCount));
+        if (pSegment != NULL) {
+            pSegment->blockCount = pMemPool->growBlockCount;
+            pSegment->pNext = pMemPool->pSegmentList;
+            pMemPool->pSegmentList = pSegment;
+            pMemPool->segmentBlockCount += pSegment->blockCount;
+            addToFreeList(pMemPool, (uint8_t *)(pSegment + 1), pSegment->blockCount);
+        }
+    }
+}
+
+// Return the block at the given index of a lock-free memory pool.
+static uint8_t *pLockFreeBlock(const uMemPoolDesc_t *pMemPool, uint32_t index)
+{
+    return pMemPool->pBuffer + (index * U_REAL_BLOCK_SIZE(pMemPool->blockSize));
+}
+
+// Make the head of the lock-free free list of a memory pool
+// point to the given index plus one, moving the change count on.
+static uint32_t lockFreeHeadMake(uint32_t head, uint32_t indexPlusOne)
+{
+    return ((head & ~U_LOCK_FREE_INDEX_MASK) + U_LOCK_FREE_CHANGE_INCREMENT) |
+           indexPlusOne;
+}
+
+// Put all of the blocks of a lock-free memory pool on its free
+// list, in order; nothing else may be using the pool.
+static void initLockFreeList(uMemPoolDesc_t *pMemPool)
+{
+    uint32_t indexPlusOne = 0;
+    uint32_t head;
+
+    // Each free block holds the index plus one of the next;
+    // uint16_t is enough since a block is at least
+    // sizeof(uMemPoolFreeList_t) in size
+    for (int32_t i = pMemPool->totalBlockCount - 1; i >= 0; i--) {
+        *((volatile uint16_t *) pLockFreeBlock(pMemPool, i)) = (uint16_t) indexPlusOne;
+        indexPlusOne = i + 1;
+    }
+    head = (uint32_t) uPortAtomicLoad(&(pMemPool->lockFreeHead));
+    uPortAtomicStore(&(pMemPool->lockFreeHead), (int32_t) lockFreeHeadMake(head, indexPlusOne));
     pMemPool->usedBlockCount = 0;
 }
 
+// Take the first block off the free list of a lock-free memory pool.
+static void *pLockFreePop(uMemPoolDesc_t *pMemPool)
+{
+    uint8_t *pBlock = NULL;
+    uint32_t head;
+    uint32_t next;
+    int32_t used;
+    int32_t maxUsed;
+    bool done = false;
+
+    while (!done) {
+        head = (uint32_t) uPortAtomicLoad(&(pMemPool->lockFreeHead));
+        if ((head & U_LOCK_FREE_INDEX_MASK) == 0) {
+            pBlock = NULL;
+            done = true;
+        } else {
+            pBlock = pLockFreeBlock(pMemPool, (head & U_LOCK_FREE_INDEX_MASK) - 1);
+            // If something else takes the block between here and the
+            // exchange what is read may be rubbish but then the head
+            // will have changed so the exchange will fail
+            next = lockFreeHeadMake(head, *((volatile uint16_t *) pBlock));
+            done = uPortAtomicCompareExchange(&(pMemPool->lockFreeHead),
+                                              (int32_t) head, (int32_t) next);
+        }
+    }
+
+    if (pBlock != NULL) {
+        used = uPortAtomicFetchAdd(&(pMemPool->usedBlockCount), 1) + 1;
+        do {
+            maxUsed = uPortAtomicLoad(&(pMemPool->maxUsedBlockCount));
+        } while ((used > maxUsed) &&
+                 !uPortAtomicCompareExchange(&(pMemPool->maxUsedBlockCount), maxUsed, used));
+    } else {
+        uPortAtomicFetchAdd(&(pMemPool->allocFailCount), 1);
+    }
+
+    return pBlock;
+}
+
+// Put a block back on the free list of a lock-free memory pool.
+static void lockFreePush(uMemPoolDesc_t *pMemPool, uint8_t *pBlock)
+{
+    uint32_t indexPlusOne = ((uint32_t) (pBlock - pMemPool->pBuffer) /
+                             U_REAL_BLOCK_SIZE(pMemPool->blockSize)) + 1;
+    uint32_t head;
+
+    do {
+        head = (uint32_t) uPortAtomicLoad(&(pMemPool->lockFreeHead));
+        *((volatile uint16_t *) pBlock) = (uint16_t) (head & U_LOCK_FREE_INDEX_MASK);
+    } while (!uPortAtomicCompareExchange(&(pMemPool->lockFreeHead), (int32_t) head,
+                                         (int32_t) lockFreeHeadMake(head, indexPlusOne)));
+    uPortAtomicFetchAdd(&(pMemPool->usedBlockCount), -1);
+}
+
+// Return true if the given block belongs to the memory pool.
+static bool isInPool(const uMemPoolDesc_t *pMemPool, const uint8_t *pMem)
+{
+    bool inPool = (pMem >= pMemPool->pBuffer) &&
+                  (pMem < (pMemPool->pBuffer + U_BUFFER_SIZE(pMemPool)));
+
+    for (uMemPoolSegment_t *pSegment = pMemPool->pSegmentList;
+         (pSegment != NULL) && !inPool; pSegment = pSegment->pNext) {
+        inPool = (pMem >= (uint8_t *)(pSegment + 1)) &&
+                 (pMem < ((uint8_t *)(pSegment + 1) +
+                          (U_REAL_BLOCK_SIZE(pMemPool->blockSize) * pSegment->blockCount)));
+    }
+
+    return inPool;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -121,8 +284,75 @@ int32_t uMemPoolInit(uMemPoolDesc_t *pMemPool, uint32_t blockSize, int32_t blkCo
     return err;
 }
 
+int32_t uMemPoolSetGrowth(uMemPoolDesc_t *pMemPool, int32_t growNumOfBlks,
+                          int32_t maxNumOfBlks)
+{
+    int32_t err = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pMemPool != NULL) && (pMemPool->mutex != NULL) && (growNumOfBlks >= 0) &&
+        ((growNumOfBlks == 0) || ((maxNumOfBlks >= pMemPool->totalBlockCount) &&
+                                  !pMemPool->lockFree))) {
+        U_PORT_MUTEX_LOCK(pMemPool->mutex);
+        pMemPool->growBlockCount = growNumOfBlks;
+        pMemPool->maxBlockCount = maxNumOfBlks;
+        U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
+        err = (int32_t)U_ERROR_COMMON_SUCCESS;
+    }
+
+    return err;
+}
+
+int32_t uMemPoolSetLockFree(uMemPoolDesc_t *pMemPool)
+{
+    int32_t err = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pMemPool != NULL) && (pMemPool->mutex != NULL) &&
+        (pMemPool->totalBlockCount > 0) &&
+        (pMemPool->totalBlockCount < (int32_t) U_LOCK_FREE_INDEX_MASK)) {
+        U_PORT_MUTEX_LOCK(pMemPool->mutex);
+        if ((pMemPool->growBlockCount == 0) && (pMemPool->pBuffer == NULL)) {
+            // The buffer has to be there before the free list can be
+            err = (int32_t)U_ERROR_COMMON_NO_MEMORY;
+            pMemPool->pBuffer = (uint8_t *)pUPortMalloc(U_BUFFER_SIZE(pMemPool));
+            uPortLog("U_MEM_POOL: allocated buffer %p.\n", pMemPool->pBuffer);
+            if (pMemPool->pBuffer != NULL) {
+                pMemPool->lockFree = true;
+                initLockFreeList(pMemPool);
+                err = (int32_t)U_ERROR_COMMON_SUCCESS;
+            }
+        }
+        U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
+    }
+
+    return err;
+}
+
+int32_t uMemPoolGetStatistics(uMemPoolDesc_t *pMemPool, uMemPoolStatistics_t *pStats)
+{
+    int32_t err = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pMemPool != NULL) && (pMemPool->mutex != NULL) && (pStats != NULL)) {
+        U_PORT_MUTEX_LOCK(pMemPool->mutex);
+        pStats->totalBlockCount = pMemPool->totalBlockCount + pMemPool->segmentBlockCount;
+        pStats->usedBlockCount = pMemPool->usedBlockCount;
+        pStats->maxUsedBlockCount = pMemPool->maxUsedBlockCount;
+        pStats->allocFailCount = pMemPool->allocFailCount;
+        pStats->segmentCount = 0;
+        for (uMemPoolSegment_t *pSegment = pMemPool->pSegmentList;
+             pSegment != NULL; pSegment = pSegment->pNext) {
+            pStats->segmentCount++;
+        }
+        U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
+        err = (int32_t)U_ERROR_COMMON_SUCCESS;
+    }
+
+    return err;
+}
+
 void uMemPoolDeinit(uMemPoolDesc_t *pMemPool)
 {
+    uMemPoolSegment_t *pSegment;
+
     if ((pMemPool != NULL) && (pMemPool->mutex != NULL)) {
 
         U_PORT_MUTEX_LOCK(pMemPool->mutex);
@@ -131,6 +361,11 @@ void uMemPoolDeinit(uMemPoolDesc_t *pMemPool)
             uPortLog("U_MEM_POOL: freeing buffer %p.\n", pMemPool->pBuffer);
             uPortFree(pMemPool->pBuffer);
         }
+        while (pMemPool->pSegmentList != NULL) {
+            pSegment = pMemPool->pSegmentList;
+            pMemPool->pSegmentList = pSegment->pNext;
+            uPortFree(pSegment);
+        }
         U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
 
         uPortMutexDelete(pMemPool->mutex);
@@ -138,29 +373,64 @@ void uMemPoolDeinit(uMemPoolDesc_t *pMemPool)
     }
 }
 
+bool uMemPoolContains(uMemPoolDesc_t *pMemPool, const void *pMem)
+{
+    bool inPool = false;
+
+    if ((pMemPool != NULL) && (pMem != NULL) && (pMemPool->mutex != NULL)) {
+        if (pMemPool->lockFree) {
+            // No secondary segments, no mutex required
+            inPool = isInPool(pMemPool, (const uint8_t *)pMem);
+        } else {
+            U_PORT_MUTEX_LOCK(pMemPool->mutex);
+            inPool = (pMemPool->pBuffer != NULL) && isInPool(pMemPool, (const uint8_t *)pMem);
+            U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
+        }
+    }
+
+    return inPool;
+}
+
 void *uMemPoolAllocMem(uMemPoolDesc_t *pMemPool)
 {
     void *pAllocMem = NULL;
 
     if ((pMemPool != NULL) && (pMemPool->mutex != NULL)) {
 
-        U_PORT_MUTEX_LOCK(pMemPool->mutex);
+        if (pMemPool->lockFree) {
+            pAllocMem = pLockFreePop(pMemPool);
+        } else {
 
-        // If this is the first call to uMemPoolAllocMem we need to
-        // allocate the buffer
-        if (pMemPool->pBuffer == NULL) {
-            pMemPool->pBuffer = (uint8_t *)pUPortMalloc(U_BUFFER_SIZE(pMemPool));
-            uPortLog("U_MEM_POOL: allocated buffer %p.\n", pMemPool->pBuffer);
-            if (pMemPool->pBuffer != NULL) {
-                initFreeList(pMemPool);
+            U_PORT_MUTEX_LOCK(pMemPool->mutex);
+
+            // If this is the first call to uMemPoolAllocMem we need to
+            // allocate the buffer
+            if (pMemPool->pBuffer == NULL) {
+                pMemPool->pBuffer = (uint8_t *)pUPortMalloc(U_BUFFER_SIZE(pMemPool));
+                uPortLog("U_MEM_POOL: allocated buffer %p.\n", pMemPool->pBuffer);
+                if (pMemPool->pBuffer != NULL) {
+                    initFreeList(pMemPool);
+                }
+            }
+
+            if ((pMemPool->pFreeList == NULL) && (pMemPool->pBuffer != NULL)) {
+                // Run dry: add a secondary segment, if allowed
+                grow(pMemPool);
             }
-        }
 
-        // Grab the free memory available in the free list
-        if (pMemPool->pFreeList) {
-            pAllocMem = pMemPool->pFreeList;
-            pMemPool->pFreeList = pMemPool->pFreeList->pNext;
-            pMemPool->usedBlockCount++;
+            // Grab the free memory available in the free list
+            if (pMemPool->pFreeList) {
+                pAllocMem = pMemPool->pFreeList;
+                pMemPool->pFreeList = pMemPool->pFreeList->pNext;
+                pMemPool->usedBlockCount++;
+                if (pMemPool->usedBlockCount > pMemPool->maxUsedBlockCount) {
+                    pMemPool->maxUsedBlockCount = pMemPool->usedBlockCount;
+                }
+            } else {
+                pMemPool->allocFailCount++;
+            }
+
+            U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
         }
 
 #if U_MEMPOOL_USE_BUF_FENCE
@@ -171,8 +441,6 @@ void *uMemPoolAllocMem(uMemPoolDesc_t *pMemPool)
             *pMagic = U_FENCE_MAGIC;
         }
 #endif
-
-        U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
     }
 
     return pAllocMem;
@@ -183,10 +451,15 @@ void uMemPoolFreeMem(uMemPoolDesc_t *pMemPool, void *pMem)
     void *pMemNext;
 
     if ((pMemPool != NULL) && (pMem != NULL) && (pMemPool->mutex != NULL)) {
-        U_PORT_MUTEX_LOCK(pMemPool->mutex);
         // Make sure the memory segment is within our buffer
-        U_ASSERT((uint8_t *)pMem >= pMemPool->pBuffer);
-        U_ASSERT((uint8_t *)pMem < (pMemPool->pBuffer + U_BUFFER_SIZE(pMemPool)));
+        // or one of its secondary segments; a lock-free pool has
+        // no secondary segments so this needs no mutex
+        if (!pMemPool->lockFree) {
+            uPortMutexLock(pMemPool->mutex);
+        }
+        bool inPool = isInPool(pMemPool, (uint8_t *)pMem);
+        U_ASSERT(inPool);
+        (void) inPool;
 
 #if U_MEMPOOL_USE_BUF_FENCE
         // Validate the magic number
@@ -197,12 +470,16 @@ void uMemPoolFreeMem(uMemPoolDesc_t *pMemPool, void *pMem)
         *pMagic = 0;
 #endif
 
-        // Add the freed memory reference before the head
-        pMemNext = pMemPool->pFreeList;
-        pMemPool->pFreeList = (uMemPoolFreeList_t *)pMem;
-        pMemPool->pFreeList->pNext = (uMemPoolFreeList_t *)pMemNext;
-        pMemPool->usedBlockCount--;
-        U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
+        if (pMemPool->lockFree) {
+            lockFreePush(pMemPool, (uint8_t *)pMem);
+        } else {
+            // Add the freed memory reference before the head
+            pMemNext = pMemPool->pFreeList;
+            pMemPool->pFreeList = (uMemPoolFreeList_t *)pMem;
+            pMemPool->pFreeList->pNext = (uMemPoolFreeList_t *)pMemNext;
+            pMemPool->usedBlockCount--;
+            uPortMutexUnlock(pMemPool->mutex);
+        }
     }
 }
 
@@ -210,7 +487,11 @@ void uMemPoolFreeAllMem(uMemPoolDesc_t *pMemPool)
 {
     if ((pMemPool != NULL) && (pMemPool->mutex != NULL)) {
         U_PORT_MUTEX_LOCK(pMemPool->mutex);
-        initFreeList(pMemPool);
+        if (pMemPool->lockFree) {
+            initLockFreeList(pMemPool);
+        } else {
+            initFreeList(pMemPool);
+        }
         U_PORT_MUTEX_UNLOCK(pMemPool->mutex);
     }
 }
@@ -0,0 +1,357 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the registry of performance counters.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memcpy(), strlen()
+
+#include "u_error_common.h"
+
+#include "u_port_os.h"
+
+#include "u_perf_counters.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The header of the binary format.
+ */
+#define U_PERF_COUNTERS_BINARY_HEADER "UPC\x01"
+
+/** The length of #U_PERF_COUNTERS_BINARY_HEADER.
+ */
+#define U_PERF_COUNTERS_BINARY_HEADER_LENGTH_BYTES 4
+
+/** The longest name that can be represented in the binary format.
+ */
+#define U_PERF_COUNTERS_BINARY_NAME_MAX_LENGTH_BYTES 255
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A registered source.
+ */
+typedef struct {
+    const char *pName;
+    uPerfCountersSource_t pSource;
+    void *pParam;
+} uPerfCountersSourceEntry_t;
+
+/** The writer passed to a source.
+ */
+struct uPerfCountersWriter_t {
+    uPerfCountersFormat_t format;
+    char *pBuffer;       /**< NULL if only counting. */
+    size_t bufferSize;
+    size_t length;       /**< the length of the output so far, which
+                              may be more than bufferSize. */
+    const char *pSourceName;
+    size_t numCounters;
+};
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Mutex to protect gSource[], created when the first source is
+ * registered and never deleted since a source may be registered
+ * again at any time.
+ */
+static uPortMutexHandle_t gMutex = NULL;
+
+/** The registered sources.
+ */
+static uPerfCountersSourceEntry_t gSource[U_PERF_COUNTERS_MAX_NUM_SOURCES] = {0};
+
+/** The number of entries in use in gSource[].
+ */
+static size_t gNumSources = 0;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Write bytes, or just count them if they won't fit.
+static void writeBytes(uPerfCountersWriter_t *pWriter,
+                       const char *pData, size_t length)
+{
+    if ((pWriter->pBuffer != NULL) &&
+        (pWriter->length + length <= pWriter->bufferSize)) {
+        memcpy(pWriter->pBuffer + pWriter->length, pData, length);
+    }
+    pWriter->length += length;
+}
+
+// Write a single character.
+static void writeChar(uPerfCountersWriter_t *pWriter, char c)
+{
+    writeBytes(pWriter, &c, 1);
+}
+
+// Write an unsigned varint.
+static void writeVarint(uPerfCountersWriter_t *pWriter, uint64_t value)
+{
+    do {
+        if (value > 0x7F) {
+            writeChar(pWriter, (char) (0x80 | (value & 0x7F)));
+        } else {
+            writeChar(pWriter, (char) value);
+        }
+        value >>= 7;
+    } while (value > 0);
+}
+
+// Write an integer as decimal ASCII.
+static void writeDecimal(uPerfCountersWriter_t *pWriter, int64_t value)
+{
+    char buffer[20];
+    size_t x = sizeof(buffer);
+    // Work in the negative range so that INT64_MIN is fine
+    int64_t negative = (value < 0) ? value : -value;
+
+    do {
+        x--;
+        buffer[x] = (char) ('0' - (negative % 10));
+        negative /= 10;
+    } while (negative < 0);
+    if (value < 0) {
+        writeChar(pWriter, '-');
+    }
+    writeBytes(pWriter, buffer + x, sizeof(buffer) - x);
+}
+
+// Write a JSON string, replacing anything that would need escaping.
+static void writeJsonString(uPerfCountersWriter_t *pWriter, const char *pString)
+{
+    for (; *pString != 0; pString++) {
+        if ((*pString == '"') || (*pString == '\\') ||
+            ((unsigned char) *pString < 0x20)) {
+            writeChar(pWriter, '_');
+        } else {
+            writeChar(pWriter, *pString);
+        }
+    }
+}
+
+// Write the start of a counter: the type and name in binary
+// format or the name and colon in JSON format.
+static void writeName(uPerfCountersWriter_t *pWriter, uint8_t type,
+                      const char *pName)
+{
+    size_t sourceNameLength = strlen(pWriter->pSourceName);
+    size_t nameLength = strlen(pName);
+
+    if (pWriter->format == U_PERF_COUNTERS_FORMAT_JSON) {
+        if (pWriter->numCounters > 0) {
+            writeChar(pWriter, ',');
+        }
+        writeChar(pWriter, '"');
+        writeJsonString(pWriter, pWriter->pSourceName);
+        writeChar(pWriter, '.');
+        writeJsonString(pWriter, pName);
+        writeBytes(pWriter, "\":", 2);
+    } else {
+        writeChar(pWriter, (char) type);
+        // Truncate the whole name to fit
+        if (sourceNameLength > U_PERF_COUNTERS_BINARY_NAME_MAX_LENGTH_BYTES - 1) {
+            sourceNameLength = U_PERF_COUNTERS_BINARY_NAME_MAX_LENGTH_BYTES - 1;
+        }
+        if (sourceNameLength + 1 + nameLength > U_PERF_COUNTERS_BINARY_NAME_MAX_LENGTH_BYTES) {
+            nameLength = U_PERF_COUNTERS_BINARY_NAME_MAX_LENGTH_BYTES - 1 - sourceNameLength;
+        }
+        writeChar(pWriter, (char) (sourceNameLength + 1 + nameLength));
+        writeBytes(pWriter, pWriter->pSourceName, sourceNameLength);
+        writeChar(pWriter, '.');
+        writeBytes(pWriter, pName, nameLength);
+    }
+    pWriter->numCounters++;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Register a source of counters.
+int32_t uPerfCountersRegister(const char *pName,
+                              uPerfCountersSource_t pSource,
+                              void *pParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    bool found = false;
+
+    if ((pName != NULL) && (pSource != NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if (gMutex == NULL) {
+            errorCode = uPortMutexCreate(&gMutex);
+            if (errorCode == 0) {
+                // Mark this as a perpetual mutex for accounting purposes
+                uPortOsResourcePerpetualAdd(U_PORT_OS_RESOURCE_TYPE_MUTEX);
+            }
+        }
+        if (errorCode == 0) {
+
+            U_PORT_MUTEX_LOCK(gMutex);
+
+            for (size_t x = 0; (x < gNumSources) && !found; x++) {
+                found = (gSource[x].pSource == pSource) && (gSource[x].pParam == pParam);
+            }
+            if (!found) {
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                if (gNumSources < sizeof(gSource) / sizeof(gSource[0])) {
+                    gSource[gNumSources].pName = pName;
+                    gSource[gNumSources].pSource = pSource;
+                    gSource[gNumSources].pParam = pParam;
+                    gNumSources++;
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutex);
+        }
+    }
+
+    return errorCode;
+}
+
+// Deregister a source of counters.
+void uPerfCountersDeregister(uPerfCountersSource_t pSource,
+                             void *pParam)
+{
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        for (size_t x = 0; x < gNumSources; x++) {
+            if ((gSource[x].pSource == pSource) && (gSource[x].pParam == pParam)) {
+                // Keep the order, it is the order of the output
+                gNumSources--;
+                memmove(&(gSource[x]), &(gSource[x + 1]),
+                        (gNumSources - x) * sizeof(gSource[0]));
+                break;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+}
+
+// Report the value of a counter.
+void uPerfCountersWriteCounter(uPerfCountersWriter_t *pWriter,
+                               const char *pName, int64_t value)
+{
+    if ((pWriter != NULL) && (pName != NULL)) {
+        writeName(pWriter, 0, pName);
+        if (pWriter->format == U_PERF_COUNTERS_FORMAT_JSON) {
+            writeDecimal(pWriter, value);
+        } else {
+            // Zig-zag encode so that small negative numbers stay small
+            writeVarint(pWriter, (((uint64_t) value) << 1) ^ ((value < 0) ? UINT64_MAX : 0));
+        }
+    }
+}
+
+// Report the contents of a histogram.
+void uPerfCountersWriteHistogram(uPerfCountersWriter_t *pWriter,
+                                 const char *pName,
+                                 const uint32_t *pBucket,
+                                 size_t numBuckets)
+{
+    if ((pWriter != NULL) && (pName != NULL) &&
+        ((pBucket != NULL) || (numBuckets == 0))) {
+        writeName(pWriter, 1, pName);
+        if (pWriter->format == U_PERF_COUNTERS_FORMAT_JSON) {
+            writeChar(pWriter, '[');
+            for (size_t x = 0; x < numBuckets; x++) {
+                if (x > 0) {
+                    writeChar(pWriter, ',');
+                }
+                writeDecimal(pWriter, pBucket[x]);
+            }
+            writeChar(pWriter, ']');
+        } else {
+            writeVarint(pWriter, numBuckets);
+            for (size_t x = 0; x < numBuckets; x++) {
+                writeVarint(pWriter, pBucket[x]);
+            }
+        }
+    }
+}
+
+// Take a snapshot of all of the counters.
+int32_t uPerfCountersSnapshot(uPerfCountersFormat_t format,
+                              char *pBuffer, size_t bufferSize)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPerfCountersWriter_t writer = {0};
+
+    if ((format == U_PERF_COUNTERS_FORMAT_BINARY) ||
+        (format == U_PERF_COUNTERS_FORMAT_JSON)) {
+        writer.format = format;
+        writer.pBuffer = pBuffer;
+        writer.bufferSize = bufferSize;
+        if (gMutex != NULL) {
+            uPortMutexLock(gMutex);
+        }
+        if (format == U_PERF_COUNTERS_FORMAT_JSON) {
+            writeChar(&writer, '{');
+        } else {
+            writeBytes(&writer, U_PERF_COUNTERS_BINARY_HEADER,
+                       U_PERF_COUNTERS_BINARY_HEADER_LENGTH_BYTES);
+        }
+        for (size_t x = 0; x < gNumSources; x++) {
+            writer.pSourceName = gSource[x].pName;
+            gSource[x].pSource(&writer, gSource[x].pParam);
+        }
+        if (gMutex != NULL) {
+            uPortMutexUnlock(gMutex);
+        }
+        errorCodeOrLength = (int32_t) writer.length;
+        if (format == U_PERF_COUNTERS_FORMAT_JSON) {
+            writeChar(&writer, '}');
+            errorCodeOrLength = (int32_t) writer.length;
+            if (pBuffer != NULL) {
+                if (writer.length < bufferSize) {
+                    *(pBuffer + writer.length) = 0;
+                } else {
+                    errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                }
+            }
+        } else if ((pBuffer != NULL) && (writer.length > bufferSize)) {
+            errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// End of file
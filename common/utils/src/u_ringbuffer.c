@@ -45,6 +45,7 @@
 #include "u_port_os.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
+#include "u_port_atomic.h"
 
 #include "u_ringbuffer.h"
 
@@ -118,6 +119,42 @@ static U_INLINE const char *pPtrOffset(const char *pData, size_t offset,
     return pData;
 }
 
+// Copy length bytes out of the ring buffer, starting at pSource,
+// into pData (which may be NULL), in at most two chunks, returning
+// the source pointer after the copy.
+static const char *pCopyOut(const uRingBuffer_t *pRingBuffer, const char *pSource,
+                            char *pData, size_t length)
+{
+    size_t x = (pRingBuffer->pBuffer + pRingBuffer->size) - pSource;
+
+    if (x > length) {
+        x = length;
+    }
+    if (pData != NULL) {
+        memcpy(pData, pSource, x);
+        memcpy(pData + x, pRingBuffer->pBuffer, length - x);
+    }
+
+    return pPtrOffset(pSource, length, pRingBuffer->pBuffer, pRingBuffer->size);
+}
+
+// Copy length bytes from pData into the ring buffer, starting at
+// pDest, in at most two chunks, returning the destination pointer
+// after the copy.
+static char *pCopyIn(const uRingBuffer_t *pRingBuffer, char *pDest,
+                     const char *pData, size_t length)
+{
+    size_t x = (pRingBuffer->pBuffer + pRingBuffer->size) - pDest;
+
+    if (x > length) {
+        x = length;
+    }
+    memcpy(pDest, pData, x);
+    memcpy(pRingBuffer->pBuffer, pData + x, length - x);
+
+    return (char *) pPtrOffset(pDest, length, pRingBuffer->pBuffer, pRingBuffer->size);
+}
+
 // The ring buffer's mutex should be locked before this is called
 static void bufferReset(uRingBuffer_t *pRingBuffer)
 {
@@ -161,14 +198,8 @@ static size_t read(uRingBuffer_t *pRingBuffer, int32_t handle, char *pData,
             length = available;
         }
 
-        while (bytesRead < length) {
-            if (pData != NULL) {
-                *pData = *pSource;
-                pData++;
-            }
-            pSource = pPtrInc(pSource, pRingBuffer->pBuffer, pRingBuffer->size);
-            bytesRead++;
-        }
+        pSource = pCopyOut(pRingBuffer, pSource, pData, length);
+        bytesRead = length;
         if (destructive) {
             pRingBuffer->pDataRead[handle] = pSource;
         }
@@ -177,37 +208,82 @@ static size_t read(uRingBuffer_t *pRingBuffer, int32_t handle, char *pData,
     return bytesRead;
 }
 
+// Return true if an add may throw away data from the given read
+// pointer to make room; the ring buffer's mutex should be locked
+// before this is called.
+static bool canDrop(const uRingBuffer_t *pRingBuffer, size_t x, bool destructive)
+{
+    bool drop;
+    uint64_t bit;
+
+    if (x == 0) {
+        // For the "normal" read pointer (0), a forced add may
+        // always throw data away, as may any add if it can't be
+        // used (because of the readHandleRequired flag)
+        drop = destructive || pRingBuffer->readHandleRequired;
+    } else {
+        // Otherwise data may be thrown away if the read pointer is
+        // not locked and either its policy is to drop the oldest
+        // data or this is a forced add and its policy is not to
+        // block the writer
+        bit = 1ULL << (x - 1);
+        drop = ((pRingBuffer->dataReadLockBitmap & bit) == 0) &&
+               (((pRingBuffer->dataReadDropOldestBitmap & bit) != 0) ||
+                (destructive && ((pRingBuffer->dataReadBlockWriterBitmap & bit) == 0)));
+    }
+
+    return drop;
+}
+
+// Return the number of bytes by which length bytes would overflow
+// the given read pointer; the ring buffer's mutex should be locked
+// before this is called.
+static size_t overflow(const uRingBuffer_t *pRingBuffer, size_t x, size_t length)
+{
+    size_t used;
+    size_t size = 0;
+
+    if (pRingBuffer->pDataRead[x] != NULL) {
+        used = ptrDiff(pRingBuffer->pDataRead[x], pRingBuffer->pDataWrite, pRingBuffer->size);
+        used++; // Account for the fact that we can't have the pointers overlap
+        if (used + length > pRingBuffer->size) {
+            size = used + length - pRingBuffer->size;
+        }
+    }
+
+    return size;
+}
+
 // The ring buffer's mutex should be locked before this is called
 static bool add(uRingBuffer_t *pRingBuffer, const char *pData,
                 size_t length, bool destructive)
 {
     bool dataFitsInBuffer = true;
     size_t lost;
-    size_t used;
+    size_t size;
 
     if (length >= pRingBuffer->size) {
         dataFitsInBuffer = false;
     } else {
-        for (size_t x = 0; (x < pRingBuffer->maxNumReadPointers) &&
-             (dataFitsInBuffer || destructive); x++) {
-            if (pRingBuffer->pDataRead[x] != NULL) {
-                used = ptrDiff(pRingBuffer->pDataRead[x], pRingBuffer->pDataWrite, pRingBuffer->size);
-                used++; // Account for the fact that we can't have the pointers overlap
-                if (used + length > pRingBuffer->size) {
-                    // If we're on the "normal" read pointer (0) and it can't be used (because
-                    // of the readHandleRequired flag) OR we are being destructive (so a
-                    // forced add) and this data read pointer is not locked, then we
-                    // throw away enough data to make it fit.
-                    if (((x == 0) && pRingBuffer->readHandleRequired) ||
-                        (destructive && ((x == 0) || (pRingBuffer->dataReadLockBitmap & (1ULL << (x - 1))) == 0))) {
-                        lost = read(pRingBuffer, x, NULL, used + length - pRingBuffer->size, 0, true);
-                        if (x == 0) {
-                            pRingBuffer->statReadLossNormalBytes += lost;
-                        } else {
-                            pRingBuffer->statReadLossBytes[x] += lost;
-                        }
+        // First check that there is room behind every read pointer that
+        // can't have data thrown away, so that an add that is going to
+        // fail doesn't cause any of the other read pointers to lose data
+        for (size_t x = 0; (x < pRingBuffer->maxNumReadPointers) && dataFitsInBuffer; x++) {
+            if ((overflow(pRingBuffer, x, length) > 0) &&
+                !canDrop(pRingBuffer, x, destructive)) {
+                dataFitsInBuffer = false;
+            }
+        }
+        if (dataFitsInBuffer) {
+            // Now throw away enough data to make it fit
+            for (size_t x = 0; x < pRingBuffer->maxNumReadPointers; x++) {
+                size = overflow(pRingBuffer, x, length);
+                if (size > 0) {
+                    lost = read(pRingBuffer, x, NULL, size, 0, true);
+                    if (x == 0) {
+                        pRingBuffer->statReadLossNormalBytes += lost;
                     } else {
-                        dataFitsInBuffer = false;
+                        pRingBuffer->statReadLossBytes[x] += lost;
                     }
                 }
             }
@@ -215,13 +291,50 @@ static bool add(uRingBuffer_t *pRingBuffer, const char *pData,
     }
 
     if (dataFitsInBuffer) {
-        while (length > 0) {
-            *(pRingBuffer->pDataWrite) = *pData;
-            pRingBuffer->pDataWrite = (char *) pPtrInc(pRingBuffer->pDataWrite, pRingBuffer->pBuffer,
-                                                       pRingBuffer->size);
-            length--;
-            pData++;
-        }
+        pRingBuffer->pDataWrite = pCopyIn(pRingBuffer, pRingBuffer->pDataWrite,
+                                          pData, length);
+    } else {
+        pRingBuffer->statAddLossBytes += length;
+    }
+
+    return dataFitsInBuffer;
+}
+
+// Read the read pointer atomically, for the lock-free case.
+static const char *pReadPtrGet(const uRingBuffer_t *pRingBuffer)
+{
+    return (const char *) pUPortAtomicLoadPtr((void *const volatile *)
+                                              & (pRingBuffer->pDataRead[0]));
+}
+
+// Write the read pointer atomically, for the lock-free case.
+static void readPtrSet(uRingBuffer_t *pRingBuffer, const char *pRead)
+{
+    uPortAtomicStorePtr((void *volatile *) & (pRingBuffer->pDataRead[0]), (void *) pRead);
+}
+
+// Read the write pointer atomically, for the lock-free case.
+static char *pWritePtrGet(const uRingBuffer_t *pRingBuffer)
+{
+    return (char *) pUPortAtomicLoadPtr((void *const volatile *) & (pRingBuffer->pDataWrite));
+}
+
+// Add for the lock-free case, called only by the producer: the
+// producer owns the write pointer, which is published only once
+// the data has been copied in.
+static bool addLockFree(uRingBuffer_t *pRingBuffer, const char *pData,
+                        size_t length)
+{
+    bool dataFitsInBuffer = false;
+    const char *pRead = pReadPtrGet(pRingBuffer);
+    char *pWrite = pRingBuffer->pDataWrite;
+
+    // +1 since we can't have the pointers overlap
+    if ((length < pRingBuffer->size) &&
+        (ptrDiff(pRead, pWrite, pRingBuffer->size) + 1 + length <= pRingBuffer->size)) {
+        pWrite = pCopyIn(pRingBuffer, pWrite, pData, length);
+        uPortAtomicStorePtr((void *volatile *) & (pRingBuffer->pDataWrite), pWrite);
+        dataFitsInBuffer = true;
     } else {
         pRingBuffer->statAddLossBytes += length;
     }
@@ -229,6 +342,39 @@ static bool add(uRingBuffer_t *pRingBuffer, const char *pData,
     return dataFitsInBuffer;
 }
 
+// Read or peek for the lock-free case, called only by the consumer:
+// the consumer owns the read pointer, which is published only once
+// the data has been copied out.
+static size_t readLockFree(uRingBuffer_t *pRingBuffer, char *pData,
+                           size_t length, size_t offset, bool destructive)
+{
+    size_t bytesRead = 0;
+    const char *pSource = pRingBuffer->pDataRead[0];
+    size_t available = ptrDiff(pSource, pWritePtrGet(pRingBuffer), pRingBuffer->size);
+
+    if (offset < available) {
+        bytesRead = available - offset;
+        if (bytesRead > length) {
+            bytesRead = length;
+        }
+        pSource = pCopyOut(pRingBuffer,
+                           pPtrOffset(pSource, offset, pRingBuffer->pBuffer, pRingBuffer->size),
+                           pData, bytesRead);
+        if (destructive) {
+            readPtrSet(pRingBuffer, pSource);
+        }
+    }
+
+    return bytesRead;
+}
+
+// The amount of data in a lock-free ring buffer.
+static size_t dataSizeLockFree(const uRingBuffer_t *pRingBuffer)
+{
+    return ptrDiff(pReadPtrGet(pRingBuffer), pWritePtrGet(pRingBuffer),
+                   pRingBuffer->size);
+}
+
 // This function does the ring buffer mutex locking itself.
 static size_t lock(uRingBuffer_t *pRingBuffer, int32_t handle, bool lockNotUnlock)
 {
@@ -260,7 +406,10 @@ static size_t availableSize(const uRingBuffer_t *pRingBuffer, bool max)
     size_t y = 0;
     bool foundADataReadPointer = false;
 
-    if (pRingBuffer->pBuffer != NULL) {
+    if ((pRingBuffer->pBuffer != NULL) && pRingBuffer->lockFree) {
+        //  -1 to prevent pointer wrap
+        size = pRingBuffer->size - dataSizeLockFree(pRingBuffer) - 1;
+    } else if (pRingBuffer->pBuffer != NULL) {
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
@@ -398,6 +547,18 @@ int32_t uRingBufferCreate(uRingBuffer_t *pRingBuffer, char *pLinearBuffer, size_
     return createCommon(pRingBuffer, pLinearBuffer, size);
 }
 
+int32_t uRingBufferCreateLockFree(uRingBuffer_t *pRingBuffer, char *pLinearBuffer,
+                                  size_t size)
+{
+    int32_t errorCode = uRingBufferCreate(pRingBuffer, pLinearBuffer, size);
+
+    // The mutex is still created, for the functions that are
+    // not on the producer/consumer path
+    pRingBuffer->lockFree = true;
+
+    return errorCode;
+}
+
 void uRingBufferDelete(uRingBuffer_t *pRingBuffer)
 {
     if ((pRingBuffer != NULL) && (pRingBuffer->mutex != NULL)) {
@@ -418,7 +579,9 @@ bool uRingBufferAdd(uRingBuffer_t *pRingBuffer, const char *pData, size_t length
 {
     bool dataFitsInBuffer = false;
 
-    if (pRingBuffer->pBuffer != NULL) {
+    if ((pRingBuffer->pBuffer != NULL) && pRingBuffer->lockFree) {
+        dataFitsInBuffer = addLockFree(pRingBuffer, pData, length);
+    } else if (pRingBuffer->pBuffer != NULL) {
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
@@ -434,7 +597,10 @@ bool uRingBufferForceAdd(uRingBuffer_t *pRingBuffer, const char *pData, size_t l
 {
     bool dataFitsInBuffer = false;
 
-    if (pRingBuffer->pBuffer != NULL) {
+    if ((pRingBuffer->pBuffer != NULL) && pRingBuffer->lockFree) {
+        // The producer may not move the read pointer
+        dataFitsInBuffer = addLockFree(pRingBuffer, pData, length);
+    } else if (pRingBuffer->pBuffer != NULL) {
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
@@ -450,7 +616,9 @@ size_t uRingBufferRead(uRingBuffer_t *pRingBuffer, char *pData, size_t length)
 {
     size_t bytesRead = 0;
 
-    if ((pRingBuffer->pBuffer != NULL) && !pRingBuffer->readHandleRequired) {
+    if ((pRingBuffer->pBuffer != NULL) && pRingBuffer->lockFree) {
+        bytesRead = readLockFree(pRingBuffer, pData, length, 0, true);
+    } else if ((pRingBuffer->pBuffer != NULL) && !pRingBuffer->readHandleRequired) {
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
@@ -467,7 +635,9 @@ size_t uRingBufferPeek(uRingBuffer_t *pRingBuffer, char *pData, size_t length,
 {
     size_t bytesRead = 0;
 
-    if ((pRingBuffer->pBuffer != NULL) && !pRingBuffer->readHandleRequired) {
+    if ((pRingBuffer->pBuffer != NULL) && pRingBuffer->lockFree) {
+        bytesRead = readLockFree(pRingBuffer, pData, length, offset, false);
+    } else if ((pRingBuffer->pBuffer != NULL) && !pRingBuffer->readHandleRequired) {
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
@@ -483,7 +653,9 @@ size_t uRingBufferDataSize(const uRingBuffer_t *pRingBuffer)
 {
     size_t dataSize = 0;
 
-    if (pRingBuffer->pBuffer != NULL) {
+    if ((pRingBuffer->pBuffer != NULL) && pRingBuffer->lockFree) {
+        dataSize = dataSizeLockFree(pRingBuffer);
+    } else if (pRingBuffer->pBuffer != NULL) {
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
@@ -505,7 +677,9 @@ size_t uRingBufferAvailableSize(const uRingBuffer_t *pRingBuffer)
 
 void uRingBufferFlush(uRingBuffer_t *pRingBuffer)
 {
-    if (pRingBuffer->pBuffer != NULL) {
+    if ((pRingBuffer->pBuffer != NULL) && pRingBuffer->lockFree) {
+        readPtrSet(pRingBuffer, pWritePtrGet(pRingBuffer));
+    } else if (pRingBuffer->pBuffer != NULL) {
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
@@ -525,15 +699,17 @@ void uRingBufferFlushValue(uRingBuffer_t *pRingBuffer, char value, size_t length
 
         U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
 
+        // Atomic accesses, since in the lock-free case the producer
+        // does not lock the mutex
         pData = pRingBuffer->pDataRead[0];
-        dataSize = ptrDiff(pData, pRingBuffer->pDataWrite, pRingBuffer->size);
+        dataSize = ptrDiff(pData, pWritePtrGet(pRingBuffer), pRingBuffer->size);
         if (dataSize >= length) {
             while ((bytesRead < dataSize) && (*pData == value)) {
                 pData = pPtrInc(pData, pRingBuffer->pBuffer, pRingBuffer->size);
                 bytesRead++;
             }
             if (bytesRead >= length) {
-                pRingBuffer->pDataRead[0] = pData;
+                readPtrSet(pRingBuffer, pData);
             }
         }
 
@@ -677,6 +853,8 @@ void uRingBufferGiveReadHandle(uRingBuffer_t *pRingBuffer, int32_t handle)
         if ((handle >= 1) && (handle < (int32_t) pRingBuffer->maxNumReadPointers)) {
             pRingBuffer->pDataRead[handle] = NULL;
             pRingBuffer->dataReadLockBitmap &= ~(1ULL << (handle - 1));
+            pRingBuffer->dataReadDropOldestBitmap &= ~(1ULL << (handle - 1));
+            pRingBuffer->dataReadBlockWriterBitmap &= ~(1ULL << (handle - 1));
         }
 
         U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) pRingBuffer->mutex);
@@ -749,6 +927,89 @@ size_t uRingBufferPeekHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
     return bytesRead;
 }
 
+size_t uRingBufferPeekInPlaceHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
+                                    size_t length,
+                                    const char **ppData1, size_t *pLength1,
+                                    const char **ppData2, size_t *pLength2)
+{
+    size_t bytesPeeked = 0;
+    size_t available;
+    const char *pSource;
+
+    *ppData1 = NULL;
+    *pLength1 = 0;
+    *ppData2 = NULL;
+    *pLength2 = 0;
+
+    if (pRingBuffer->pBuffer != NULL) {
+
+        U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
+
+        if ((handle >= 0) && (handle < (int32_t) pRingBuffer->maxNumReadPointers) &&
+            (pRingBuffer->pDataRead[handle] != NULL)) {
+            pSource = pRingBuffer->pDataRead[handle];
+            available = ptrDiff(pSource, pRingBuffer->pDataWrite, pRingBuffer->size);
+            if (length > available) {
+                length = available;
+            }
+            if (length > 0) {
+                bytesPeeked = length;
+                *ppData1 = pSource;
+                // The first segment runs up to the end of the linear buffer
+                *pLength1 = (pRingBuffer->pBuffer + pRingBuffer->size) - pSource;
+                if (*pLength1 >= length) {
+                    *pLength1 = length;
+                } else {
+                    // The rest wraps to the start of the linear buffer
+                    *ppData2 = pRingBuffer->pBuffer;
+                    *pLength2 = length - *pLength1;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) pRingBuffer->mutex);
+    }
+
+    return bytesPeeked;
+}
+
+size_t uRingBufferConsumeHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
+                                size_t length)
+{
+    return uRingBufferReadHandle(pRingBuffer, handle, NULL, length);
+}
+
+int32_t uRingBufferSetReadPolicyHandle(uRingBuffer_t *pRingBuffer, int32_t handle,
+                                       uRingBufferReadPolicy_t policy)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uint64_t bit;
+
+    if (pRingBuffer->pBuffer != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+        U_PORT_MUTEX_LOCK((uPortMutexHandle_t) pRingBuffer->mutex);
+
+        if ((handle >= 1) && (handle < (int32_t) pRingBuffer->maxNumReadPointers) &&
+            (pRingBuffer->pDataRead[handle] != NULL) &&
+            (policy < U_RING_BUFFER_READ_POLICY_MAX_NUM)) {
+            bit = 1ULL << (handle - 1);
+            pRingBuffer->dataReadDropOldestBitmap &= ~bit;
+            pRingBuffer->dataReadBlockWriterBitmap &= ~bit;
+            if (policy == U_RING_BUFFER_READ_POLICY_DROP_OLDEST) {
+                pRingBuffer->dataReadDropOldestBitmap |= bit;
+            } else if (policy == U_RING_BUFFER_READ_POLICY_BLOCK_WRITER) {
+                pRingBuffer->dataReadBlockWriterBitmap |= bit;
+            }
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK((uPortMutexHandle_t) pRingBuffer->mutex);
+    }
+
+    return errorCode;
+}
+
 size_t uRingBufferDataSizeHandle(const uRingBuffer_t *pRingBuffer, int32_t handle)
 {
     size_t dataSize = 0;
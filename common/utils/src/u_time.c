@@ -28,8 +28,13 @@
 # include "u_cfg_override.h" // For a customer's configuration override
 #endif
 
+#include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // memset()
+#include "time.h"      // struct tm
+
+#include "u_error_common.h"
 
 #include "u_time.h"
 
@@ -37,25 +42,92 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** The number of seconds in a day.
+ */
+#define U_TIME_SECONDS_PER_DAY (3600 * 24)
+
+/** The number of days in a 400 year cycle of the Gregorian
+ * calendar, which repeats exactly.
+ */
+#define U_TIME_DAYS_PER_ERA 146097
+
+/** The number of days from 1st March of the year 0 to 1st
+ * January 1970; years are counted from 1st March in the
+ * conversions below so that the leap day falls at the end.
+ */
+#define U_TIME_DAYS_YEAR_0_TO_1970 719468
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** A cache of the last day converted into a date: timestamping tends
+ * to convert the same day over and over.  The three members are
+ * written and read separately, without a lock, so check is written
+ * as days ^ date: a reader that sees a torn mixture of an old and a
+ * new entry will find days ^ date != check, unless the day is the
+ * same, in which case the date is the same also.
+ */
+typedef struct {
+    int32_t days;  /**< days since 1970. */
+    int32_t date;  /**< (year << 9) | (month << 5) | day. */
+    int32_t check; /**< days ^ date. */
+} uTimeDayCache_t;
+
 /* ----------------------------------------------------------------
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
 
-static const char gDaysInMonth[] = {31, 28, 31, 30, 31, 30, 31,
-                                    31, 30, 31, 30, 31
-                                   };
-static const char gDaysInMonthLeapYear[] = {31, 29, 31, 30, 31, 30,
-                                            31, 31, 30, 31, 30, 31
-                                           };
+/** The cache of the last day converted into a date, initially
+ * 1st January 1970.
+ */
+static volatile uTimeDayCache_t gDayCache = {0, (1970 << 9) | (1 << 5) | 1,
+                                             (1970 << 9) | (1 << 5) | 1
+                                            };
 
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Divide, rounding towards minus infinity.
+static int64_t divFloor(int64_t numerator, int64_t denominator)
+{
+    int64_t quotient = numerator / denominator;
+
+    if ((numerator % denominator) < 0) {
+        quotient--;
+    }
+
+    return quotient;
+}
+
+// Convert days since 1970 into a date without using the cache.
+static void civilFromDays(int64_t days, int32_t *pYear,
+                          int32_t *pMonth, int32_t *pDay)
+{
+    int64_t era;
+    int32_t dayOfEra;
+    int32_t yearOfEra;
+    int32_t dayOfYear;
+    int32_t monthFromMarch;
+    int64_t year;
+
+    days += U_TIME_DAYS_YEAR_0_TO_1970;
+    era = divFloor(days, U_TIME_DAYS_PER_ERA);
+    dayOfEra = (int32_t) (days - (era * U_TIME_DAYS_PER_ERA));
+    yearOfEra = (dayOfEra - (dayOfEra / 1460) + (dayOfEra / 36524) -
+                 (dayOfEra / (U_TIME_DAYS_PER_ERA - 1))) / 365;
+    dayOfYear = dayOfEra - ((365 * yearOfEra) + (yearOfEra / 4) - (yearOfEra / 100));
+    monthFromMarch = ((5 * dayOfYear) + 2) / 153;
+    *pDay = dayOfYear - (((153 * monthFromMarch) + 2) / 5) + 1;
+    *pMonth = monthFromMarch < 10 ? monthFromMarch + 3 : monthFromMarch - 9;
+    year = yearOfEra + (era * 400);
+    if (*pMonth <= 2) {
+        year++;
+    }
+    *pYear = (int32_t) year;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -71,16 +143,68 @@ bool uTimeIsLeapYear(int32_t year)
     return isLeapYear;
 }
 
+int64_t uTimeDaysFromCivil(int32_t year, int32_t month, int32_t day)
+{
+    int64_t era;
+    int32_t yearOfEra;
+    int32_t dayOfYear;
+    int32_t dayOfEra;
+
+    // Count years from 1st March, so that the leap day is last
+    if (month <= 2) {
+        year--;
+    }
+    era = divFloor(year, 400);
+    yearOfEra = (int32_t) (year - (era * 400));
+    dayOfYear = (((153 * (month > 2 ? month - 3 : month + 9)) + 2) / 5) + day - 1;
+    dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+
+    return (era * U_TIME_DAYS_PER_ERA) + dayOfEra - U_TIME_DAYS_YEAR_0_TO_1970;
+}
+
+void uTimeCivilFromDays(int64_t days, int32_t *pYear,
+                        int32_t *pMonth, int32_t *pDay)
+{
+    int32_t year = 0;
+    int32_t month = 0;
+    int32_t day = 0;
+    int32_t date;
+    int32_t cacheDays = gDayCache.days;
+    int32_t cacheDate = gDayCache.date;
+    int32_t cacheCheck = gDayCache.check;
+
+    if ((cacheDays == days) && ((cacheDays ^ cacheDate) == cacheCheck)) {
+        year = cacheDate >> 9;
+        month = (cacheDate >> 5) & 0x0F;
+        day = cacheDate & 0x1F;
+    } else {
+        civilFromDays(days, &year, &month, &day);
+        if ((days >= 0) && (days <= INT32_MAX) && (year < (INT32_MAX >> 9))) {
+            date = (year << 9) | (month << 5) | day;
+            gDayCache.days = (int32_t) days;
+            gDayCache.date = date;
+            gDayCache.check = ((int32_t) days) ^ date;
+        }
+    }
+    if (pYear != NULL) {
+        *pYear = year;
+    }
+    if (pMonth != NULL) {
+        *pMonth = month;
+    }
+    if (pDay != NULL) {
+        *pDay = day;
+    }
+}
+
 int64_t uTimeMonthsToSecondsUtc(int32_t monthsUtc)
 {
     int64_t secondsUtc = 0;
 
-    for (int32_t x = 0; x < monthsUtc; x++) {
-        if (uTimeIsLeapYear((x / 12) + 1970)) {
-            secondsUtc += gDaysInMonthLeapYear[x % 12] * 3600 * 24;
-        } else {
-            secondsUtc += gDaysInMonth[x % 12] * 3600 * 24;
-        }
+    if (monthsUtc > 0) {
+        secondsUtc = uTimeDaysFromCivil(1970 + (monthsUtc / 12),
+                                        (monthsUtc % 12) + 1, 1) *
+                     U_TIME_SECONDS_PER_DAY;
     }
 
     return secondsUtc;
@@ -89,28 +213,50 @@ int64_t uTimeMonthsToSecondsUtc(int32_t monthsUtc)
 int32_t uTimeSecondsToMonthsUtc(int64_t secondsUtc)
 {
     int32_t monthsUtc = 0;
-    int32_t year = 0;
-    int32_t month = 0;
-    int32_t x;
+    int32_t year;
+    int32_t month;
 
-    while (secondsUtc > 0) {
-        if (uTimeIsLeapYear(year + 1970)) {
-            x = gDaysInMonthLeapYear[month] * 3600 * 24;
-        } else {
-            x = gDaysInMonth[month] * 3600 * 24;
-        }
-        if (secondsUtc >= x) {
-            monthsUtc++;
-            month++;
-        }
-        secondsUtc -= x;
-        if (month == 12) {
-            month = 0;
-            year++;
-        }
+    if (secondsUtc > 0) {
+        uTimeCivilFromDays(secondsUtc / U_TIME_SECONDS_PER_DAY, &year, &month, NULL);
+        monthsUtc = ((year - 1970) * 12) + month - 1;
     }
 
     return monthsUtc;
 }
 
+int32_t uTimeSecondsToTmUtc(int64_t secondsUtc, struct tm *pTm)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    int64_t days;
+    int32_t secondsInDay;
+    int32_t year;
+    int32_t month;
+    int32_t day;
+
+    if (pTm != NULL) {
+        memset(pTm, 0, sizeof(*pTm));
+        days = divFloor(secondsUtc, U_TIME_SECONDS_PER_DAY);
+        secondsInDay = (int32_t) (secondsUtc - (days * U_TIME_SECONDS_PER_DAY));
+        uTimeCivilFromDays(days, &year, &month, &day);
+        // Years since 1900, months since January (0 to 11)
+        // and day of the month (1 to 31)
+        pTm->tm_year = year - 1900;
+        pTm->tm_mon = month - 1;
+        pTm->tm_mday = day;
+        // Days since 1st January (0 to 365)
+        pTm->tm_yday = (int32_t) (days - uTimeDaysFromCivil(year, 1, 1));
+        // Day of the week, from Sunday (0 to 6); 1st January
+        // 1970 was a Thursday (4)
+        pTm->tm_wday = (int32_t) ((days + 4) - (divFloor(days + 4, 7) * 7));
+        pTm->tm_hour = secondsInDay / 3600;
+        pTm->tm_min = (secondsInDay % 3600) / 60;
+        pTm->tm_sec = secondsInDay % 60;
+        // Since this is UTC, the Daylight Saving Time
+        // flag is left unset.
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
 // End of file
@@ -0,0 +1,311 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the time service, which keeps UTC time
+ * locally from samples of cellular or GNSS time.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+
+#include "u_time_sync.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The resolution of the local tick in nanoseconds, added to the
+ * accuracy of every sample.
+ */
+#define U_TIME_SYNC_TICK_RESOLUTION_NANOSECONDS 1000000LL
+
+/** The weight given to the existing drift when a new measurement
+ * of drift is made: the new drift is the existing one plus the
+ * difference divided by this.
+ */
+#define U_TIME_SYNC_DRIFT_FILTER 4
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A sample of time.
+ */
+typedef struct {
+    uTimeSyncSource_t source;
+    int64_t timeUtcNanoseconds;
+    int64_t accuracyNanoseconds;
+    int64_t tickMs; /**< the local tick, extended to 64 bits. */
+} uTimeSyncSample_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Mutex to protect the time service, also the indication that
+ * it is initialised.
+ */
+static uPortMutexHandle_t gMutex = NULL;
+
+/** The local tick, extended to 64 bits.
+ */
+static int64_t gTickMs = 0;
+
+/** The last value of uPortGetTickTimeMs(), used in extending
+ * the local tick to 64 bits.
+ */
+static int32_t gLastTickMs = 0;
+
+/** The sample on which the current time is based.
+ */
+static uTimeSyncSample_t gAnchor = {0};
+
+/** The sample from which the next measurement of drift will
+ * be made.
+ */
+static uTimeSyncSample_t gDriftReference = {0};
+
+/** The drift of the local tick in parts per billion, only valid
+ * if gDriftKnown is true.
+ */
+static int32_t gDriftPpb = 0;
+
+/** Whether the drift of the local tick has been measured.
+ */
+static bool gDriftKnown = false;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Convert a value of uPortGetTickTimeMs() from the recent past into
+// the 64-bit local tick, returning false if tickMs is in the future
+// or too far in the past.
+static bool extendTickMs(int32_t tickMs, int64_t *pTickMs)
+{
+    int32_t nowMs = uPortGetTickTimeMs();
+    uint32_t ageMs;
+
+    // Unsigned arithmetic so that a wrap of the tick is harmless
+    gTickMs += (uint32_t) nowMs - (uint32_t) gLastTickMs;
+    gLastTickMs = nowMs;
+    ageMs = (uint32_t) nowMs - (uint32_t) tickMs;
+    *pTickMs = gTickMs - ageMs;
+
+    return ageMs <= INT32_MAX;
+}
+
+// Extrapolate the anchor sample to the given local tick, returning
+// the time and populating pAccuracyNanoseconds with its accuracy.
+static int64_t extrapolate(int64_t tickMs, int64_t *pAccuracyNanoseconds)
+{
+    int64_t elapsedMs = tickMs - gAnchor.tickMs;
+    int64_t timeUtcNanoseconds = gAnchor.timeUtcNanoseconds + (elapsedMs * 1000000);
+    int64_t uncertaintyPpb = U_TIME_SYNC_DRIFT_UNKNOWN_PPB;
+
+    if (gDriftKnown) {
+        // Nanoseconds from milliseconds multiplied by parts per billion
+        timeUtcNanoseconds += (elapsedMs * gDriftPpb) / 1000;
+        uncertaintyPpb = U_TIME_SYNC_DRIFT_RESIDUAL_PPB;
+    }
+    if (elapsedMs < 0) {
+        elapsedMs = -elapsedMs;
+    }
+    *pAccuracyNanoseconds = gAnchor.accuracyNanoseconds + ((elapsedMs * uncertaintyPpb) / 1000);
+
+    return timeUtcNanoseconds;
+}
+
+// Measure the drift of the local tick between the drift reference
+// and a newly adopted sample, if they are far enough apart for the
+// measurement to be accurate.
+static void updateDrift(const uTimeSyncSample_t *pSample)
+{
+    int64_t intervalMs = pSample->tickMs - gDriftReference.tickMs;
+    int64_t errorNanoseconds;
+    int64_t driftPpb;
+
+    if ((gDriftReference.source == U_TIME_SYNC_SOURCE_NONE) || (intervalMs <= 0)) {
+        gDriftReference = *pSample;
+    } else {
+        errorNanoseconds = pSample->timeUtcNanoseconds - gDriftReference.timeUtcNanoseconds -
+                           (intervalMs * 1000000);
+        if ((errorNanoseconds > (intervalMs * U_TIME_SYNC_DRIFT_LIMIT_PPB) / 1000) ||
+            (errorNanoseconds < -(intervalMs * U_TIME_SYNC_DRIFT_LIMIT_PPB) / 1000)) {
+            // A source of time has jumped: start again from here
+            gDriftReference = *pSample;
+        } else if (((gDriftReference.accuracyNanoseconds + pSample->accuracyNanoseconds) * 1000) /
+                   intervalMs <= U_TIME_SYNC_DRIFT_MEASUREMENT_ACCURACY_PPB) {
+            // Parts per billion from nanoseconds per millisecond
+            driftPpb = (errorNanoseconds * 1000) / intervalMs;
+            if (gDriftKnown) {
+                driftPpb = gDriftPpb + ((driftPpb - gDriftPpb) / U_TIME_SYNC_DRIFT_FILTER);
+            }
+            gDriftPpb = (int32_t) driftPpb;
+            gDriftKnown = true;
+            gDriftReference = *pSample;
+        } else if (pSample->accuracyNanoseconds < gDriftReference.accuracyNanoseconds) {
+            // Not far enough apart yet but this sample is a better
+            // basis for a measurement than the one we have
+            gDriftReference = *pSample;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Initialise the time service.
+int32_t uTimeSyncInit()
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+
+    if (gMutex == NULL) {
+        gTickMs = 0;
+        gLastTickMs = uPortGetTickTimeMs();
+        gAnchor.source = U_TIME_SYNC_SOURCE_NONE;
+        gDriftReference.source = U_TIME_SYNC_SOURCE_NONE;
+        gDriftPpb = 0;
+        gDriftKnown = false;
+        errorCode = uPortMutexCreate(&gMutex);
+    }
+
+    return errorCode;
+}
+
+// Deinitialise the time service.
+void uTimeSyncDeinit()
+{
+    if (gMutex != NULL) {
+        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(gMutex);
+        uPortMutexDelete(gMutex);
+        gMutex = NULL;
+    }
+}
+
+// Feed a sample of time into the time service.
+int32_t uTimeSyncFeed(uTimeSyncSource_t source,
+                      int64_t timeUtcNanoseconds,
+                      int64_t accuracyNanoseconds,
+                      int32_t tickMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uTimeSyncSample_t sample;
+    int64_t accuracyNowNanoseconds = 0;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((source > U_TIME_SYNC_SOURCE_NONE) && (source < U_TIME_SYNC_SOURCE_MAX_NUM) &&
+            (timeUtcNanoseconds >= 0) && (accuracyNanoseconds >= 0) &&
+            extendTickMs(tickMs, &sample.tickMs)) {
+            sample.source = source;
+            sample.timeUtcNanoseconds = timeUtcNanoseconds;
+            sample.accuracyNanoseconds = accuracyNanoseconds + U_TIME_SYNC_TICK_RESOLUTION_NANOSECONDS;
+            errorCode = (int32_t) U_ERROR_COMMON_IGNORED;
+            if (gAnchor.source != U_TIME_SYNC_SOURCE_NONE) {
+                extrapolate(sample.tickMs, &accuracyNowNanoseconds);
+            }
+            if ((gAnchor.source == U_TIME_SYNC_SOURCE_NONE) ||
+                (sample.accuracyNanoseconds <= accuracyNowNanoseconds)) {
+                updateDrift(&sample);
+                gAnchor = sample;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return errorCode;
+}
+
+// Get the current UTC time.
+int64_t uTimeSyncNowUtc(int64_t *pAccuracyNanoseconds,
+                        uTimeSyncSource_t *pSource)
+{
+    int64_t errorCodeOrTime = (int64_t) U_ERROR_COMMON_NOT_INITIALISED;
+    int64_t accuracyNanoseconds;
+    int64_t tickMs;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        errorCodeOrTime = (int64_t) U_ERROR_COMMON_EMPTY;
+        if (gAnchor.source != U_TIME_SYNC_SOURCE_NONE) {
+            extendTickMs(uPortGetTickTimeMs(), &tickMs);
+            errorCodeOrTime = extrapolate(tickMs, &accuracyNanoseconds);
+            if (pAccuracyNanoseconds != NULL) {
+                *pAccuracyNanoseconds = accuracyNanoseconds;
+            }
+            if (pSource != NULL) {
+                *pSource = gAnchor.source;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return errorCodeOrTime;
+}
+
+// Get the drift of the local tick.
+int32_t uTimeSyncDriftGet(int32_t *pDriftPpb)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pDriftPpb != NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_EMPTY;
+            if (gDriftKnown) {
+                *pDriftPpb = gDriftPpb;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return errorCode;
+}
+
+// End of file
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Test for the streaming base64 API
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memcmp()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_base64.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_BASE64_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The amount of binary data to test with.
+ */
+#define U_UTILS_TEST_BASE64_LENGTH_BYTES 50
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** The binary data.
+ */
+static char gBinary[U_UTILS_TEST_BASE64_LENGTH_BYTES];
+
+/** The binary data encoded in one go by uBase64Encode().
+ */
+static char gBase64[U_BASE64_ENCODE_STREAM_LENGTH_MAX(U_UTILS_TEST_BASE64_LENGTH_BYTES)];
+
+/** Somewhere to put the output of a streaming encode; plus
+ * white space for the decode test.
+ */
+static char gBuffer[sizeof(gBase64) * 2];
+
+/** Somewhere to put the output of a streaming decode.
+ */
+static char gDecoded[U_UTILS_TEST_BASE64_LENGTH_BYTES];
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TESTS
+ * -------------------------------------------------------------- */
+
+U_PORT_TEST_FUNCTION("[base64]", "base64Stream")
+{
+    uBase64Stream_t stream;
+    int32_t heapAllocCount;
+    int32_t base64Length;
+    int32_t x;
+    size_t length;
+    size_t chunkSize;
+
+    U_TEST_PRINT_LINE("testing streaming base64.");
+    heapAllocCount = uPortHeapAllocCount();
+
+    for (size_t y = 0; y < sizeof(gBinary); y++) {
+        gBinary[y] = (char) ((y * 37) + 11);
+    }
+
+    for (size_t binaryLength = 0; binaryLength <= sizeof(gBinary); binaryLength += 7) {
+        base64Length = uBase64Encode(gBinary, binaryLength, gBase64, sizeof(gBase64));
+        U_PORT_TEST_ASSERT(base64Length == (int32_t) U_BASE64_ENCODE_STREAM_LENGTH_MAX(binaryLength));
+        for (chunkSize = 1; chunkSize <= 5; chunkSize++) {
+            // Encode in chunks, must give the same answer as in one go
+            uBase64StreamInit(&stream);
+            length = 0;
+            for (size_t y = 0; y < binaryLength; y += chunkSize) {
+                x = uBase64EncodeStream(&stream, gBinary + y,
+                                        binaryLength - y < chunkSize ? binaryLength - y : chunkSize,
+                                        gBuffer + length,
+                                        U_BASE64_ENCODE_STREAM_LENGTH_MAX(chunkSize));
+                U_PORT_TEST_ASSERT(x >= 0);
+                length += x;
+            }
+            x = uBase64EncodeStreamFinish(&stream, gBuffer + length, 4);
+            U_PORT_TEST_ASSERT(x >= 0);
+            length += x;
+            U_PORT_TEST_ASSERT(length == (size_t) base64Length);
+            U_PORT_TEST_ASSERT(memcmp(gBuffer, gBase64, length) == 0);
+
+            // Decode in chunks with line-breaks in, must give back the binary
+            length = 0;
+            for (int32_t y = 0; y < base64Length; y++) {
+                gBuffer[length] = gBase64[y];
+                length++;
+                if ((y % 9) == 8) {
+                    gBuffer[length] = '\n';
+                    length++;
+                }
+            }
+            uBase64StreamInit(&stream);
+            base64Length = (int32_t) length;
+            length = 0;
+            for (int32_t y = 0; y < base64Length; y += chunkSize) {
+                x = uBase64DecodeStream(&stream, gBuffer + y,
+                                        (size_t) (base64Length - y) < chunkSize ? base64Length - y : chunkSize,
+                                        gDecoded + length,
+                                        U_BASE64_DECODE_STREAM_LENGTH_MAX(chunkSize));
+                U_PORT_TEST_ASSERT(x >= 0);
+                length += x;
+            }
+            x = uBase64DecodeStreamFinish(&stream, gDecoded + length, 3);
+            U_PORT_TEST_ASSERT(x >= 0);
+            length += x;
+            U_PORT_TEST_ASSERT(length == binaryLength);
+            U_PORT_TEST_ASSERT(memcmp(gDecoded, gBinary, length) == 0);
+            base64Length = (int32_t) U_BASE64_ENCODE_STREAM_LENGTH_MAX(binaryLength);
+        }
+    }
+
+    // Not enough room: nothing should be consumed
+    uBase64StreamInit(&stream);
+    U_PORT_TEST_ASSERT(uBase64EncodeStream(&stream, gBinary, 6, gBuffer, 7) ==
+                       (int32_t) U_ERROR_COMMON_NO_MEMORY);
+    U_PORT_TEST_ASSERT(uBase64EncodeStreamFinish(&stream, gBuffer, 4) == 0);
+
+    // Missing padding is fine, bad characters, data after the
+    // padding and truncation are not
+    uBase64StreamInit(&stream);
+    U_PORT_TEST_ASSERT(uBase64DecodeStream(&stream, "TWE", 3, gDecoded, sizeof(gDecoded)) == 0);
+    U_PORT_TEST_ASSERT(uBase64DecodeStreamFinish(&stream, gDecoded, 3) == 2);
+    U_PORT_TEST_ASSERT(memcmp(gDecoded, "Ma", 2) == 0);
+    uBase64StreamInit(&stream);
+    U_PORT_TEST_ASSERT(uBase64DecodeStream(&stream, "TW!=", 4, gDecoded, sizeof(gDecoded)) < 0);
+    uBase64StreamInit(&stream);
+    U_PORT_TEST_ASSERT(uBase64DecodeStream(&stream, "TQ==TQ==", 8, gDecoded, sizeof(gDecoded)) < 0);
+    uBase64StreamInit(&stream);
+    U_PORT_TEST_ASSERT(uBase64DecodeStream(&stream, "TWFuT", 5, gDecoded, sizeof(gDecoded)) == 3);
+    U_PORT_TEST_ASSERT(uBase64DecodeStreamFinish(&stream, gDecoded, 3) < 0);
+
+    // Nothing should have come from the heap
+    U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+}
+
+// End of file
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Test for the hash map API
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_hash_map.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_HASH_MAP_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The number of entries in the hash map used during testing.
+ */
+#define U_UTILS_TEST_HASH_MAP_NUM_ENTRIES 16
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Storage for the hash map used in testing.
+ */
+static uHashMapEntry_t gEntries[U_UTILS_TEST_HASH_MAP_NUM_ENTRIES];
+
+/** Things to put in the hash map.
+ */
+static int32_t gValues[U_UTILS_TEST_HASH_MAP_NUM_ENTRIES];
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TESTS
+ * -------------------------------------------------------------- */
+
+U_PORT_TEST_FUNCTION("[hashMap]", "hashMapBasic")
+{
+    uHashMap_t map;
+    int32_t heapAllocCount;
+    // Keys that land in the same place in a small table, and
+    // keys that look like pointers
+    uintptr_t key[U_UTILS_TEST_HASH_MAP_NUM_ENTRIES - 1];
+
+    U_TEST_PRINT_LINE("testing hash map.");
+    heapAllocCount = uPortHeapAllocCount();
+
+    for (size_t x = 0; x < sizeof(key) / sizeof(key[0]); x++) {
+        gValues[x] = (int32_t) x;
+        if (x & 1) {
+            key[x] = (uintptr_t) &(gValues[x]);
+        } else {
+            key[x] = x * U_UTILS_TEST_HASH_MAP_NUM_ENTRIES;
+        }
+    }
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uHashMapInit(NULL, gEntries, U_UTILS_TEST_HASH_MAP_NUM_ENTRIES) < 0);
+    U_PORT_TEST_ASSERT(uHashMapInit(&map, NULL, U_UTILS_TEST_HASH_MAP_NUM_ENTRIES) < 0);
+    U_PORT_TEST_ASSERT(uHashMapInit(&map, gEntries, U_UTILS_TEST_HASH_MAP_NUM_ENTRIES - 1) < 0);
+    U_PORT_TEST_ASSERT(uHashMapInit(&map, gEntries, U_UTILS_TEST_HASH_MAP_NUM_ENTRIES) == 0);
+    U_PORT_TEST_ASSERT(uHashMapSet(&map, 1, NULL) < 0);
+    U_PORT_TEST_ASSERT(uHashMapGetCount(&map) == 0);
+    U_PORT_TEST_ASSERT(pUHashMapGet(&map, key[0]) == NULL);
+    U_PORT_TEST_ASSERT(pUHashMapRemove(&map, key[0]) == NULL);
+
+    // Fill it up: one fewer than the number of entries will fit
+    for (size_t x = 0; x < sizeof(key) / sizeof(key[0]); x++) {
+        U_PORT_TEST_ASSERT(uHashMapSet(&map, key[x], &(gValues[x])) == 0);
+        U_PORT_TEST_ASSERT(uHashMapGetCount(&map) == x + 1);
+    }
+    U_PORT_TEST_ASSERT(uHashMapSet(&map, 0xdeadbeef, &(gValues[0])) ==
+                       (int32_t) U_ERROR_COMMON_NO_MEMORY);
+    // Replacing an existing value is still fine
+    U_PORT_TEST_ASSERT(uHashMapSet(&map, key[0], &(gValues[1])) == 0);
+    U_PORT_TEST_ASSERT(pUHashMapGet(&map, key[0]) == &(gValues[1]));
+    U_PORT_TEST_ASSERT(uHashMapSet(&map, key[0], &(gValues[0])) == 0);
+    U_PORT_TEST_ASSERT(uHashMapGetCount(&map) == sizeof(key) / sizeof(key[0]));
+    for (size_t x = 0; x < sizeof(key) / sizeof(key[0]); x++) {
+        U_PORT_TEST_ASSERT(pUHashMapGet(&map, key[x]) == &(gValues[x]));
+    }
+
+    // Remove every other one, the rest must still be found
+    for (size_t x = 0; x < sizeof(key) / sizeof(key[0]); x += 2) {
+        U_PORT_TEST_ASSERT(pUHashMapRemove(&map, key[x]) == &(gValues[x]));
+        U_PORT_TEST_ASSERT(pUHashMapRemove(&map, key[x]) == NULL);
+    }
+    for (size_t x = 0; x < sizeof(key) / sizeof(key[0]); x++) {
+        if (x & 1) {
+            U_PORT_TEST_ASSERT(pUHashMapGet(&map, key[x]) == &(gValues[x]));
+        } else {
+            U_PORT_TEST_ASSERT(pUHashMapGet(&map, key[x]) == NULL);
+        }
+    }
+
+    // Put them back, then remove the lot in reverse order
+    for (size_t x = 0; x < sizeof(key) / sizeof(key[0]); x += 2) {
+        U_PORT_TEST_ASSERT(uHashMapSet(&map, key[x], &(gValues[x])) == 0);
+    }
+    U_PORT_TEST_ASSERT(uHashMapGetCount(&map) == sizeof(key) / sizeof(key[0]));
+    for (size_t x = sizeof(key) / sizeof(key[0]); x > 0; x--) {
+        for (size_t y = 0; y < x; y++) {
+            U_PORT_TEST_ASSERT(pUHashMapGet(&map, key[y]) == &(gValues[y]));
+        }
+        U_PORT_TEST_ASSERT(pUHashMapRemove(&map, key[x - 1]) == &(gValues[x - 1]));
+        U_PORT_TEST_ASSERT(pUHashMapGet(&map, key[x - 1]) == NULL);
+    }
+    U_PORT_TEST_ASSERT(uHashMapGetCount(&map) == 0);
+
+    // Nothing should have come from the heap
+    U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+}
+
+// End of file
@@ -92,6 +92,13 @@
  * TYPES
  * -------------------------------------------------------------- */
 
+/** A structure to put in an intrusive linked list during testing.
+ */
+typedef struct {
+    int32_t value;
+    uLinkedListNode_t node;
+} uUtilsTestLinkedListThing_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -104,6 +111,32 @@ static uLinkedList_t *gpList = NULL;
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Check that an intrusive linked list contains exactly the given
+// values, in order, and that the back-pointers are consistent.
+static bool nodeListIs(uLinkedListNode_t *pList, const int32_t *pValues,
+                       size_t numValues)
+{
+    bool isGood = true;
+    uLinkedListNode_t *pPrevious = NULL;
+    size_t x = 0;
+
+    for (uLinkedListNode_t *pNode = pList; (pNode != NULL) && isGood;
+         pNode = pNode->pNext) {
+        isGood = (x < numValues) &&
+                 (U_LINKED_LIST_CONTAINER_OF(pNode, uUtilsTestLinkedListThing_t,
+                                             node)->value == pValues[x]) &&
+                 ((pPrevious == NULL) || (pNode->pPrevious == pPrevious));
+        pPrevious = pNode;
+        x++;
+    }
+    if (isGood && (pList != NULL)) {
+        // The first node points back to the last
+        isGood = (pList->pPrevious == pPrevious);
+    }
+
+    return isGood && (x == numValues);
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
@@ -191,6 +224,64 @@ U_PORT_TEST_FUNCTION("[linkedList]", "linkedListBasic")
     // Memory leak checking is done in the clean-up
 }
 
+U_PORT_TEST_FUNCTION("[linkedList]", "linkedListNode")
+{
+    uUtilsTestLinkedListThing_t thing[4];
+    uLinkedListNode_t *pList = NULL;
+    int32_t heapAllocCount;
+
+    U_TEST_PRINT_LINE("testing intrusive linked list.");
+    heapAllocCount = uPortHeapAllocCount();
+
+    for (size_t x = 0; x < sizeof(thing) / sizeof(thing[0]); x++) {
+        thing[x].value = (int32_t) x;
+    }
+
+    // NULLs shouldn't go bang
+    uLinkedListNodeAdd(NULL, &(thing[0].node));
+    uLinkedListNodeAdd(&pList, NULL);
+    uLinkedListNodeRemove(NULL, &(thing[0].node));
+    uLinkedListNodeRemove(&pList, NULL);
+    U_PORT_TEST_ASSERT(pList == NULL);
+
+    // Add and remove a single node
+    memset(&(thing[0].node), 0, sizeof(thing[0].node));
+    U_PORT_TEST_ASSERT(!uLinkedListNodeIsInList(&(thing[0].node)));
+    uLinkedListNodeAdd(&pList, &(thing[0].node));
+    U_PORT_TEST_ASSERT(uLinkedListNodeIsInList(&(thing[0].node)));
+    U_PORT_TEST_ASSERT(nodeListIs(pList, (const int32_t[]) {0}, 1));
+    uLinkedListNodeRemove(&pList, &(thing[0].node));
+    U_PORT_TEST_ASSERT(!uLinkedListNodeIsInList(&(thing[0].node)));
+    U_PORT_TEST_ASSERT(pList == NULL);
+
+    // Add them all, they should be in the order added
+    for (size_t x = 0; x < sizeof(thing) / sizeof(thing[0]); x++) {
+        uLinkedListNodeAdd(&pList, &(thing[x].node));
+    }
+    U_PORT_TEST_ASSERT(nodeListIs(pList, (const int32_t[]) {0, 1, 2, 3}, 4));
+
+    // Remove from the middle, the end and the start
+    uLinkedListNodeRemove(&pList, &(thing[1].node));
+    U_PORT_TEST_ASSERT(nodeListIs(pList, (const int32_t[]) {0, 2, 3}, 3));
+    uLinkedListNodeRemove(&pList, &(thing[3].node));
+    U_PORT_TEST_ASSERT(nodeListIs(pList, (const int32_t[]) {0, 2}, 2));
+    // Adding after removing the end should still go at the end
+    uLinkedListNodeAdd(&pList, &(thing[1].node));
+    U_PORT_TEST_ASSERT(nodeListIs(pList, (const int32_t[]) {0, 2, 1}, 3));
+    uLinkedListNodeRemove(&pList, &(thing[0].node));
+    U_PORT_TEST_ASSERT(nodeListIs(pList, (const int32_t[]) {2, 1}, 2));
+    uLinkedListNodeAdd(&pList, &(thing[3].node));
+    U_PORT_TEST_ASSERT(nodeListIs(pList, (const int32_t[]) {2, 1, 3}, 3));
+
+    // Empty it
+    while (pList != NULL) {
+        uLinkedListNodeRemove(&pList, pList);
+    }
+
+    // Nothing should have come from the heap
+    U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -67,6 +67,11 @@
 #define TEST_BLOCK_COUNT 8
 #define TEST_BLOCK_SIZE  64
 
+/** The number of alloc/free iterations each task performs in
+ * the lock-free test.
+ */
+#define TEST_LOCK_FREE_ITERATIONS 2000
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -75,6 +80,14 @@
  * VARIABLES
  * -------------------------------------------------------------- */
 
+/** The number of lock-free test tasks that have finished.
+ */
+static volatile int32_t gLockFreeTaskDoneCount = 0;
+
+/** The number of errors seen by the lock-free test tasks.
+ */
+static volatile int32_t gLockFreeTaskErrorCount = 0;
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -89,6 +102,41 @@ static bool isAllBytes(uint8_t *pBuf, size_t size, uint8_t cmpByte)
     return true;
 }
 
+// Task that allocates and frees blocks of a lock-free pool,
+// checking that no other task is using them in the meantime.
+static void lockFreeTask(void *pParam)
+{
+    uMemPoolDesc_t *pMemPool = (uMemPoolDesc_t *)pParam;
+    uint8_t *pBuf[2];
+    uint8_t fill = (uint8_t) uPortGetTickTimeMs();
+
+    for (int32_t i = 0; i < TEST_LOCK_FREE_ITERATIONS; i++) {
+        for (size_t x = 0; x < sizeof(pBuf) / sizeof(pBuf[0]); x++) {
+            pBuf[x] = (uint8_t *)uMemPoolAllocMem(pMemPool);
+            if (pBuf[x] != NULL) {
+                memset(pBuf[x], fill, TEST_BLOCK_SIZE);
+            }
+        }
+        for (size_t x = 0; x < sizeof(pBuf) / sizeof(pBuf[0]); x++) {
+            if (pBuf[x] != NULL) {
+                if (!isAllBytes(pBuf[x], TEST_BLOCK_SIZE, fill)) {
+                    gLockFreeTaskErrorCount++;
+                }
+                uMemPoolFreeMem(pMemPool, pBuf[x]);
+            } else {
+                gLockFreeTaskErrorCount++;
+            }
+        }
+        fill++;
+        if ((i % 100) == 0) {
+            uPortTaskBlock(1);
+        }
+    }
+
+    gLockFreeTaskDoneCount++;
+    uPortTaskDelete(NULL);
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
@@ -224,4 +272,166 @@ U_PORT_TEST_FUNCTION("[mempool]", "mempoolFreeAllMem")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
-// End of file
\ No newline at end of file
+U_PORT_TEST_FUNCTION("[mempool]", "mempoolGrow")
+{
+    int32_t errCode;
+    uMemPoolDesc_t mempoolDesc;
+    uMemPoolStatistics_t stats;
+    uint8_t *pBuf[TEST_BLOCK_COUNT * 2];
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    errCode = uMemPoolInit(&mempoolDesc, TEST_BLOCK_SIZE, TEST_BLOCK_COUNT);
+    U_PORT_TEST_ASSERT(errCode == U_ERROR_COMMON_SUCCESS);
+    // The limit cannot be less than what is already there
+    U_PORT_TEST_ASSERT(uMemPoolSetGrowth(&mempoolDesc, TEST_BLOCK_COUNT / 2,
+                                         TEST_BLOCK_COUNT - 1) < 0);
+    errCode = uMemPoolSetGrowth(&mempoolDesc, TEST_BLOCK_COUNT / 2, TEST_BLOCK_COUNT * 2);
+    U_PORT_TEST_ASSERT(errCode == U_ERROR_COMMON_SUCCESS);
+
+    // Allocate all of the buffers the pool can grow to
+    for (int32_t i = 0; i < TEST_BLOCK_COUNT * 2; i++) {
+        pBuf[i] = (uint8_t *)uMemPoolAllocMem(&mempoolDesc);
+        U_PORT_TEST_ASSERT(pBuf[i] != NULL);
+        memset(pBuf[i], i, TEST_BLOCK_SIZE);
+    }
+    // That should be the limit
+    U_PORT_TEST_ASSERT(uMemPoolAllocMem(&mempoolDesc) == NULL);
+
+    for (int32_t i = 0; i < TEST_BLOCK_COUNT * 2; i++) {
+        U_PORT_TEST_ASSERT(isAllBytes(pBuf[i], TEST_BLOCK_SIZE, (uint8_t) i));
+    }
+
+    U_PORT_TEST_ASSERT(uMemPoolGetStatistics(&mempoolDesc, &stats) == 0);
+    U_TEST_PRINT_LINE("%d block(s), %d used, max %d, %d failure(s), %d segment(s).",
+                      stats.totalBlockCount, stats.usedBlockCount, stats.maxUsedBlockCount,
+                      stats.allocFailCount, stats.segmentCount);
+    U_PORT_TEST_ASSERT(stats.totalBlockCount == TEST_BLOCK_COUNT * 2);
+    U_PORT_TEST_ASSERT(stats.usedBlockCount == TEST_BLOCK_COUNT * 2);
+    U_PORT_TEST_ASSERT(stats.maxUsedBlockCount == TEST_BLOCK_COUNT * 2);
+    U_PORT_TEST_ASSERT(stats.allocFailCount == 1);
+    U_PORT_TEST_ASSERT(stats.segmentCount == 2);
+
+    // Free the lot, from primary and secondary segments alike
+    for (int32_t i = 0; i < TEST_BLOCK_COUNT * 2; i++) {
+        uMemPoolFreeMem(&mempoolDesc, (void *)pBuf[i]);
+    }
+
+    // The high-water mark should stay put and the pool should not shrink
+    U_PORT_TEST_ASSERT(uMemPoolGetStatistics(&mempoolDesc, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.usedBlockCount == 0);
+    U_PORT_TEST_ASSERT(stats.maxUsedBlockCount == TEST_BLOCK_COUNT * 2);
+    U_PORT_TEST_ASSERT(stats.totalBlockCount == TEST_BLOCK_COUNT * 2);
+
+    uMemPoolDeinit(&mempoolDesc);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+U_PORT_TEST_FUNCTION("[mempool]", "mempoolLockFree")
+{
+    int32_t errCode;
+    uMemPoolDesc_t mempoolDesc;
+    uMemPoolStatistics_t stats;
+    uint8_t *pBuf[TEST_BLOCK_COUNT];
+    uPortTaskHandle_t taskHandle[2];
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    errCode = uMemPoolInit(&mempoolDesc, TEST_BLOCK_SIZE, TEST_BLOCK_COUNT);
+    U_PORT_TEST_ASSERT(errCode == U_ERROR_COMMON_SUCCESS);
+    errCode = uMemPoolSetLockFree(&mempoolDesc);
+    U_PORT_TEST_ASSERT(errCode == U_ERROR_COMMON_SUCCESS);
+    // A lock-free pool cannot grow
+    U_PORT_TEST_ASSERT(uMemPoolSetGrowth(&mempoolDesc, TEST_BLOCK_COUNT / 2,
+                                         TEST_BLOCK_COUNT * 2) < 0);
+
+    for (int32_t i = 0; i < TEST_BLOCK_COUNT; i++) {
+        pBuf[i] = (uint8_t *)uMemPoolAllocMem(&mempoolDesc);
+        U_PORT_TEST_ASSERT(pBuf[i] != NULL);
+        U_PORT_TEST_ASSERT(uMemPoolContains(&mempoolDesc, pBuf[i]));
+        memset(pBuf[i], i, TEST_BLOCK_SIZE);
+    }
+    U_PORT_TEST_ASSERT(uMemPoolAllocMem(&mempoolDesc) == NULL);
+    for (int32_t i = 0; i < TEST_BLOCK_COUNT; i++) {
+        U_PORT_TEST_ASSERT(isAllBytes(pBuf[i], TEST_BLOCK_SIZE, (uint8_t) i));
+    }
+
+    U_PORT_TEST_ASSERT(uMemPoolGetStatistics(&mempoolDesc, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.totalBlockCount == TEST_BLOCK_COUNT);
+    U_PORT_TEST_ASSERT(stats.usedBlockCount == TEST_BLOCK_COUNT);
+    U_PORT_TEST_ASSERT(stats.maxUsedBlockCount == TEST_BLOCK_COUNT);
+    U_PORT_TEST_ASSERT(stats.allocFailCount == 1);
+
+    for (int32_t i = 0; i < TEST_BLOCK_COUNT; i++) {
+        uMemPoolFreeMem(&mempoolDesc, (void *)pBuf[i]);
+    }
+    U_PORT_TEST_ASSERT(uMemPoolGetStatistics(&mempoolDesc, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.usedBlockCount == 0);
+
+    // Now have two tasks hammer the pool at once; between them
+    // they never need more than the pool has
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    gLockFreeTaskDoneCount = 0;
+    gLockFreeTaskErrorCount = 0;
+    for (size_t x = 0; x < sizeof(taskHandle) / sizeof(taskHandle[0]); x++) {
+        errCode = uPortTaskCreate(lockFreeTask, "lockFreeTask",
+                                  U_CFG_TEST_OS_TASK_STACK_SIZE_BYTES, &mempoolDesc,
+                                  U_CFG_TEST_OS_TASK_PRIORITY, &(taskHandle[x]));
+        U_PORT_TEST_ASSERT(errCode == 0);
+    }
+    for (int32_t i = 0; (gLockFreeTaskDoneCount < 2) && (i < 1000); i++) {
+        uPortTaskBlock(100);
+    }
+    U_TEST_PRINT_LINE("%d task(s) finished with %d error(s).",
+                      gLockFreeTaskDoneCount, gLockFreeTaskErrorCount);
+    U_PORT_TEST_ASSERT(gLockFreeTaskDoneCount == 2);
+    U_PORT_TEST_ASSERT(gLockFreeTaskErrorCount == 0);
+    // Give the tasks time to be cleaned up
+    uPortTaskBlock(U_CFG_OS_YIELD_MS + 100);
+
+    U_PORT_TEST_ASSERT(uMemPoolGetStatistics(&mempoolDesc, &stats) == 0);
+    U_TEST_PRINT_LINE("%d block(s), %d used, max %d, %d failure(s).",
+                      stats.totalBlockCount, stats.usedBlockCount, stats.maxUsedBlockCount,
+                      stats.allocFailCount);
+    U_PORT_TEST_ASSERT(stats.usedBlockCount == 0);
+    U_PORT_TEST_ASSERT(stats.maxUsedBlockCount <= TEST_BLOCK_COUNT);
+    U_PORT_TEST_ASSERT(stats.allocFailCount == 1);
+
+    // Free-all should leave the pool usable
+    pBuf[0] = (uint8_t *)uMemPoolAllocMem(&mempoolDesc);
+    U_PORT_TEST_ASSERT(pBuf[0] != NULL);
+    uMemPoolFreeAllMem(&mempoolDesc);
+    U_PORT_TEST_ASSERT(uMemPoolGetStatistics(&mempoolDesc, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.usedBlockCount == 0);
+    for (int32_t i = 0; i < TEST_BLOCK_COUNT; i++) {
+        pBuf[i] = (uint8_t *)uMemPoolAllocMem(&mempoolDesc);
+        U_PORT_TEST_ASSERT(pBuf[i] != NULL);
+    }
+    uMemPoolFreeAllMem(&mempoolDesc);
+
+    uMemPoolDeinit(&mempoolDesc);
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+// End of file
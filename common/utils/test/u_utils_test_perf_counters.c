@@ -0,0 +1,192 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Test for the performance counters API
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // strstr(), memcmp()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_perf_counters.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_PERF_COUNTERS_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The size of the buffer to take snapshots into; big enough for
+ * whatever else in ubxlib may have registered.
+ */
+#define U_UTILS_TEST_PERF_COUNTERS_BUFFER_LENGTH_BYTES 2048
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Buffer to take snapshots into.
+ */
+static char gBuffer[U_UTILS_TEST_PERF_COUNTERS_BUFFER_LENGTH_BYTES];
+
+/** A histogram for testSource() to report.
+ */
+static const uint32_t gHistogram[] = {0, 3, 200};
+
+/** The binary form of what testSource() reports.
+ */
+static const char gBinary[] = {
+    // Counter "test.a" = -1, zig-zag encoded
+    0, 6, 't', 'e', 's', 't', '.', 'a', 0x01,
+    // Counter "test.b" = 300
+    0, 6, 't', 'e', 's', 't', '.', 'b', (char) 0xd8, 0x04,
+    // Histogram "test.h" = [0, 3, 200]
+    1, 6, 't', 'e', 's', 't', '.', 'h', 3, 0, 3, (char) 0xc8, 0x01
+};
+
+/** The number of times testSource() has been called.
+ */
+static int32_t gNumCalls = 0;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// A source of counters.
+static void testSource(uPerfCountersWriter_t *pWriter, void *pParam)
+{
+    (void) pParam;
+
+    uPerfCountersWriteCounter(pWriter, "a", -1);
+    uPerfCountersWriteCounter(pWriter, "b", 300);
+    uPerfCountersWriteHistogram(pWriter, "h", gHistogram,
+                                sizeof(gHistogram) / sizeof(gHistogram[0]));
+    gNumCalls++;
+}
+
+// Find a sequence of bytes in a buffer.
+static bool contains(const char *pBuffer, size_t size,
+                     const char *pBytes, size_t length)
+{
+    bool found = false;
+
+    for (size_t x = 0; (x + length <= size) && !found; x++) {
+        found = (memcmp(pBuffer + x, pBytes, length) == 0);
+    }
+
+    return found;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TESTS
+ * -------------------------------------------------------------- */
+
+U_PORT_TEST_FUNCTION("[perfCounters]", "perfCountersBasic")
+{
+    int32_t heapAllocCount;
+    int32_t size;
+    int32_t length;
+
+    U_TEST_PRINT_LINE("testing performance counters.");
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uPerfCountersRegister(NULL, testSource, NULL) < 0);
+    U_PORT_TEST_ASSERT(uPerfCountersRegister("test", NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uPerfCountersSnapshot((uPerfCountersFormat_t) 99, NULL, 0) < 0);
+
+    // The first registration may create the mutex, which is
+    // perpetual, so take the heap count after that; registering
+    // twice has no effect
+    U_PORT_TEST_ASSERT(uPerfCountersRegister("test", testSource, NULL) == 0);
+    heapAllocCount = uPortHeapAllocCount();
+    U_PORT_TEST_ASSERT(uPerfCountersRegister("test", testSource, NULL) == 0);
+
+    // JSON: find out the size and then take the snapshot
+    size = uPerfCountersSnapshot(U_PERF_COUNTERS_FORMAT_JSON, NULL, 0);
+    U_TEST_PRINT_LINE("JSON snapshot is %d byte(s).", size);
+    U_PORT_TEST_ASSERT(size > 0);
+    U_PORT_TEST_ASSERT(size < (int32_t) sizeof(gBuffer));
+    U_PORT_TEST_ASSERT(gNumCalls == 1);
+    length = uPerfCountersSnapshot(U_PERF_COUNTERS_FORMAT_JSON, gBuffer, sizeof(gBuffer));
+    U_TEST_PRINT_LINE("%s", gBuffer);
+    U_PORT_TEST_ASSERT(length == size);
+    U_PORT_TEST_ASSERT(gNumCalls == 2);
+    U_PORT_TEST_ASSERT(gBuffer[length] == 0);
+    U_PORT_TEST_ASSERT(gBuffer[0] == '{');
+    U_PORT_TEST_ASSERT(gBuffer[length - 1] == '}');
+    U_PORT_TEST_ASSERT(strstr(gBuffer, "\"test.a\":-1,\"test.b\":300,\"test.h\":[0,3,200]") != NULL);
+    // No room for the null terminator
+    U_PORT_TEST_ASSERT(uPerfCountersSnapshot(U_PERF_COUNTERS_FORMAT_JSON, gBuffer,
+                                             size) == (int32_t) U_ERROR_COMMON_NO_MEMORY);
+
+    // Binary
+    size = uPerfCountersSnapshot(U_PERF_COUNTERS_FORMAT_BINARY, NULL, 0);
+    U_TEST_PRINT_LINE("binary snapshot is %d byte(s).", size);
+    U_PORT_TEST_ASSERT(size >= (int32_t) (4 + sizeof(gBinary)));
+    U_PORT_TEST_ASSERT(size <= (int32_t) sizeof(gBuffer));
+    length = uPerfCountersSnapshot(U_PERF_COUNTERS_FORMAT_BINARY, gBuffer, size);
+    U_PORT_TEST_ASSERT(length == size);
+    U_PORT_TEST_ASSERT(memcmp(gBuffer, "UPC\x01", 4) == 0);
+    U_PORT_TEST_ASSERT(contains(gBuffer, length, gBinary, sizeof(gBinary)));
+    U_PORT_TEST_ASSERT(uPerfCountersSnapshot(U_PERF_COUNTERS_FORMAT_BINARY, gBuffer,
+                                             size - 1) == (int32_t) U_ERROR_COMMON_NO_MEMORY);
+
+    // Once deregistered the source is not called
+    gNumCalls = 0;
+    uPerfCountersDeregister(testSource, NULL);
+    U_PORT_TEST_ASSERT(uPerfCountersSnapshot(U_PERF_COUNTERS_FORMAT_JSON, gBuffer,
+                                             sizeof(gBuffer)) >= 2);
+    U_PORT_TEST_ASSERT(strstr(gBuffer, "test.") == NULL);
+    U_PORT_TEST_ASSERT(gNumCalls == 0);
+
+    // Check that we haven't leaked any heap
+    U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+}
+
+// End of file
@@ -811,6 +811,53 @@ U_PORT_TEST_FUNCTION("[ringbuffer]", "ringbufferBasic")
     uRingBufferGiveReadHandle(&ringBuffer, handle[0]);
     uRingBufferGiveReadHandle(&ringBuffer, handle[1]);
 
+    // Test peeking in place, including across the wrap
+    U_TEST_PRINT_LINE("testing peek in place...");
+    handle[0] = uRingBufferTakeReadHandle(&ringBuffer);
+    readLossHandle[0] = 0;
+    {
+        const char *pData1;
+        size_t length1;
+        const char *pData2;
+        size_t length2;
+        // Nothing there yet
+        U_PORT_TEST_ASSERT(uRingBufferPeekInPlaceHandle(&ringBuffer, handle[0], sizeof(bufferOut),
+                                                        &pData1, &length1,
+                                                        &pData2, &length2) == 0);
+        U_PORT_TEST_ASSERT((pData1 == NULL) && (length1 == 0));
+        U_PORT_TEST_ASSERT((pData2 == NULL) && (length2 == 0));
+        // Move the pointers along so that the next add wraps
+        U_PORT_TEST_ASSERT(uRingBufferAdd(&ringBuffer, bufferIn, sizeof(bufferIn) / 2));
+        U_PORT_TEST_ASSERT(uRingBufferReadHandle(&ringBuffer, handle[0], NULL,
+                                                 sizeof(bufferIn) / 2) == sizeof(bufferIn) / 2);
+        uRingBufferFlush(&ringBuffer);
+        U_PORT_TEST_ASSERT(uRingBufferAdd(&ringBuffer, bufferIn, sizeof(bufferIn) - 1));
+        uRingBufferLockReadHandle(&ringBuffer, handle[0]);
+        y = uRingBufferPeekInPlaceHandle(&ringBuffer, handle[0], sizeof(bufferOut),
+                                         &pData1, &length1, &pData2, &length2);
+        U_TEST_PRINT_LINE(" peek in place returned %d byte(s) in segments of %d and %d byte(s).",
+                          y, length1, length2);
+        U_PORT_TEST_ASSERT(y == sizeof(bufferIn) - 1);
+        U_PORT_TEST_ASSERT(length1 + length2 == y);
+        U_PORT_TEST_ASSERT((length1 > 0) && (length2 > 0));
+        U_PORT_TEST_ASSERT(pData2 == linearBuffer);
+        U_PORT_TEST_ASSERT(memcmp(pData1, bufferIn, length1) == 0);
+        U_PORT_TEST_ASSERT(memcmp(pData2, bufferIn + length1, length2) == 0);
+        // Peeking in place must not have moved the read pointer
+        U_PORT_TEST_ASSERT(uRingBufferDataSizeHandle(&ringBuffer, handle[0]) == sizeof(bufferIn) - 1);
+        // A shorter peek may fit in the first segment alone
+        y = uRingBufferPeekInPlaceHandle(&ringBuffer, handle[0], length1,
+                                         &pData1, &length1, &pData2, &length2);
+        U_PORT_TEST_ASSERT(y == length1);
+        U_PORT_TEST_ASSERT((pData2 == NULL) && (length2 == 0));
+        U_PORT_TEST_ASSERT(memcmp(pData1, bufferIn, length1) == 0);
+        uRingBufferUnlockReadHandle(&ringBuffer, handle[0]);
+    }
+    uRingBufferFlushHandle(&ringBuffer, handle[0]);
+    uRingBufferFlush(&ringBuffer);
+    U_PORT_TEST_ASSERT(uRingBufferAvailableSize(&ringBuffer) == sizeof(linearBuffer) - 1);
+    uRingBufferGiveReadHandle(&ringBuffer, handle[0]);
+
     // Check that delete does what it says on the tin
     U_TEST_PRINT_LINE("deleting ring buffer...");
     uRingBufferDelete(&ringBuffer);
@@ -883,4 +930,183 @@ U_PORT_TEST_FUNCTION("[ringbuffer]", "ringbufferBasic")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+U_PORT_TEST_FUNCTION("[ringbuffer]", "ringbufferReadPolicy")
+{
+    int32_t resourceCount;
+    uRingBuffer_t ringBuffer;
+    char linearBuffer[U_TEST_UTILS_RINGBUFFER_SIZE + 1];
+    char bufferOut[U_TEST_UTILS_RINGBUFFER_SIZE + 1];
+    char bufferIn[U_TEST_UTILS_RINGBUFFER_SIZE + 1];
+    int32_t fastHandle;
+    int32_t slowHandle;
+    const char *pData1;
+    size_t length1;
+    const char *pData2;
+    size_t length2;
+    size_t addLoss = 0;
+    size_t y;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_TEST_PRINT_LINE("testing ring buffer read policies.");
+    for (size_t x = 0; x < sizeof(bufferIn); x++) {
+        bufferIn[x] = (char) x;
+    }
+    memset(linearBuffer, 0, sizeof(linearBuffer));
+    U_PORT_TEST_ASSERT(uRingBufferCreateWithReadHandle(&ringBuffer, linearBuffer,
+                                                       sizeof(linearBuffer),
+                                                       U_TEST_UTILS_RINGBUFFER_READ_HANDLES_MAX_NUM) == 0);
+    uRingBufferSetReadRequiresHandle(&ringBuffer, true);
+    fastHandle = uRingBufferTakeReadHandle(&ringBuffer);
+    U_PORT_TEST_ASSERT(fastHandle >= 0);
+    slowHandle = uRingBufferTakeReadHandle(&ringBuffer);
+    U_PORT_TEST_ASSERT(slowHandle >= 0);
+    U_PORT_TEST_ASSERT(uRingBufferSetReadPolicyHandle(&ringBuffer, slowHandle,
+                                                      U_RING_BUFFER_READ_POLICY_MAX_NUM) < 0);
+    U_PORT_TEST_ASSERT(uRingBufferSetReadPolicyHandle(&ringBuffer, 0,
+                                                      U_RING_BUFFER_READ_POLICY_DROP_OLDEST) < 0);
+
+    // With the default policy a full slow reader causes an add to fail
+    // for both readers, without either losing data
+    U_PORT_TEST_ASSERT(uRingBufferAdd(&ringBuffer, bufferIn, sizeof(linearBuffer) - 1));
+    U_PORT_TEST_ASSERT(uRingBufferConsumeHandle(&ringBuffer, fastHandle,
+                                                sizeof(linearBuffer)) == sizeof(linearBuffer) - 1);
+    U_PORT_TEST_ASSERT(!uRingBufferAdd(&ringBuffer, bufferIn, 5));
+    addLoss += 5;
+    U_PORT_TEST_ASSERT(uRingBufferDataSizeHandle(&ringBuffer, fastHandle) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferStatReadLossHandle(&ringBuffer, slowHandle) == 0);
+
+    // With drop-oldest only the slow reader loses out
+    U_TEST_PRINT_LINE(" slow reader set to drop oldest.");
+    U_PORT_TEST_ASSERT(uRingBufferSetReadPolicyHandle(&ringBuffer, slowHandle,
+                                                      U_RING_BUFFER_READ_POLICY_DROP_OLDEST) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferAdd(&ringBuffer, bufferIn, 5));
+    U_PORT_TEST_ASSERT(uRingBufferStatReadLossHandle(&ringBuffer, slowHandle) == 5);
+    U_PORT_TEST_ASSERT(uRingBufferStatReadLossHandle(&ringBuffer, fastHandle) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferDataSizeHandle(&ringBuffer, slowHandle) == sizeof(linearBuffer) - 1);
+    // The fast reader gets its data in place and then consumes it
+    y = uRingBufferPeekInPlaceHandle(&ringBuffer, fastHandle, sizeof(bufferOut),
+                                     &pData1, &length1, &pData2, &length2);
+    U_PORT_TEST_ASSERT(y == 5);
+    U_PORT_TEST_ASSERT(length1 + length2 == y);
+    memcpy(bufferOut, pData1, length1);
+    memcpy(bufferOut + length1, pData2, length2);
+    U_PORT_TEST_ASSERT(memcmp(bufferOut, bufferIn, y) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferConsumeHandle(&ringBuffer, fastHandle, y) == y);
+    U_PORT_TEST_ASSERT(uRingBufferDataSizeHandle(&ringBuffer, fastHandle) == 0);
+    // The slow reader has the newest data
+    y = uRingBufferReadHandle(&ringBuffer, slowHandle, bufferOut, sizeof(bufferOut));
+    U_PORT_TEST_ASSERT(y == sizeof(linearBuffer) - 1);
+    U_PORT_TEST_ASSERT(memcmp(bufferOut, bufferIn + 5, y - 5) == 0);
+    U_PORT_TEST_ASSERT(memcmp(bufferOut + y - 5, bufferIn, 5) == 0);
+    // But not while it is locked
+    U_PORT_TEST_ASSERT(uRingBufferAdd(&ringBuffer, bufferIn, sizeof(linearBuffer) - 1));
+    uRingBufferFlushHandle(&ringBuffer, fastHandle);
+    uRingBufferLockReadHandle(&ringBuffer, slowHandle);
+    U_PORT_TEST_ASSERT(!uRingBufferForceAdd(&ringBuffer, bufferIn, 1));
+    addLoss++;
+    uRingBufferUnlockReadHandle(&ringBuffer, slowHandle);
+
+    // With block-writer not even a forced add gets in
+    U_TEST_PRINT_LINE(" slow reader set to block the writer.");
+    U_PORT_TEST_ASSERT(uRingBufferSetReadPolicyHandle(&ringBuffer, slowHandle,
+                                                      U_RING_BUFFER_READ_POLICY_BLOCK_WRITER) == 0);
+    U_PORT_TEST_ASSERT(!uRingBufferForceAdd(&ringBuffer, bufferIn, 1));
+    addLoss++;
+    U_PORT_TEST_ASSERT(uRingBufferStatReadLossHandle(&ringBuffer, slowHandle) == 5);
+    U_PORT_TEST_ASSERT(uRingBufferDataSizeHandle(&ringBuffer, slowHandle) == sizeof(linearBuffer) - 1);
+
+    // Back to the default, a forced add gets in
+    U_PORT_TEST_ASSERT(uRingBufferSetReadPolicyHandle(&ringBuffer, slowHandle,
+                                                      U_RING_BUFFER_READ_POLICY_DEFAULT) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferForceAdd(&ringBuffer, bufferIn, 1));
+    U_PORT_TEST_ASSERT(uRingBufferStatReadLossHandle(&ringBuffer, slowHandle) == 6);
+    U_PORT_TEST_ASSERT(uRingBufferStatReadLossHandle(&ringBuffer, fastHandle) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferStatAddLoss(&ringBuffer) == addLoss);
+
+    U_TEST_PRINT_LINE("deleting ring buffer...");
+    uRingBufferGiveReadHandle(&ringBuffer, fastHandle);
+    uRingBufferGiveReadHandle(&ringBuffer, slowHandle);
+    uRingBufferDelete(&ringBuffer);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+U_PORT_TEST_FUNCTION("[ringbuffer]", "ringbufferLockFree")
+{
+    int32_t resourceCount;
+    uRingBuffer_t ringBuffer;
+    char linearBuffer[U_TEST_UTILS_RINGBUFFER_SIZE + 1];
+    char bufferOut[U_TEST_UTILS_RINGBUFFER_SIZE + 1];
+    char bufferIn[U_TEST_UTILS_RINGBUFFER_SIZE + 1];
+    size_t addLoss = 0;
+    size_t y;
+
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_TEST_PRINT_LINE("testing lock-free ring buffer.");
+    for (size_t x = 0; x < sizeof(bufferIn); x++) {
+        bufferIn[x] = (char) x;
+    }
+    memset(linearBuffer, 0, sizeof(linearBuffer));
+    U_PORT_TEST_ASSERT(uRingBufferCreateLockFree(&ringBuffer, linearBuffer,
+                                                 sizeof(linearBuffer)) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferDataSize(&ringBuffer) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferAvailableSize(&ringBuffer) == sizeof(linearBuffer) - 1);
+    U_PORT_TEST_ASSERT(uRingBufferRead(&ringBuffer, bufferOut, sizeof(bufferOut)) == 0);
+    // The read handle API is not available
+    U_PORT_TEST_ASSERT(uRingBufferTakeReadHandle(&ringBuffer) < 0);
+
+    // Add and read different amounts of data so that both the
+    // adds and the reads wrap at every possible point
+    for (size_t x = 1; x < sizeof(linearBuffer); x++) {
+        for (size_t z = 0; z < sizeof(linearBuffer); z++) {
+            U_PORT_TEST_ASSERT(uRingBufferAdd(&ringBuffer, bufferIn, x));
+            U_PORT_TEST_ASSERT(uRingBufferDataSize(&ringBuffer) == x);
+            U_PORT_TEST_ASSERT(uRingBufferAvailableSize(&ringBuffer) == sizeof(linearBuffer) - 1 - x);
+            memset(bufferOut, U_TEST_UTILS_RINGBUFFER_FILL_CHAR, sizeof(bufferOut));
+            // Peek beyond the start
+            y = uRingBufferPeek(&ringBuffer, bufferOut, sizeof(bufferOut), 1);
+            U_PORT_TEST_ASSERT(y == x - 1);
+            U_PORT_TEST_ASSERT(memcmp(bufferOut, bufferIn + 1, y) == 0);
+            U_PORT_TEST_ASSERT(uRingBufferPeek(&ringBuffer, bufferOut, sizeof(bufferOut), x) == 0);
+            memset(bufferOut, U_TEST_UTILS_RINGBUFFER_FILL_CHAR, sizeof(bufferOut));
+            y = uRingBufferRead(&ringBuffer, bufferOut, sizeof(bufferOut));
+            U_PORT_TEST_ASSERT(y == x);
+            U_PORT_TEST_ASSERT(memcmp(bufferOut, bufferIn, y) == 0);
+            U_PORT_TEST_ASSERT(bufferOut[y] == U_TEST_UTILS_RINGBUFFER_FILL_CHAR);
+            U_PORT_TEST_ASSERT(uRingBufferDataSize(&ringBuffer) == 0);
+        }
+    }
+
+    // Fill it up: a further add, forced or not, should fail
+    U_PORT_TEST_ASSERT(uRingBufferAdd(&ringBuffer, bufferIn, sizeof(linearBuffer) - 1));
+    U_PORT_TEST_ASSERT(uRingBufferAvailableSize(&ringBuffer) == 0);
+    U_PORT_TEST_ASSERT(!uRingBufferAdd(&ringBuffer, bufferIn, 1));
+    addLoss++;
+    U_PORT_TEST_ASSERT(!uRingBufferForceAdd(&ringBuffer, bufferIn, 1));
+    addLoss++;
+    U_PORT_TEST_ASSERT(uRingBufferStatAddLoss(&ringBuffer) == addLoss);
+    U_PORT_TEST_ASSERT(uRingBufferDataSize(&ringBuffer) == sizeof(linearBuffer) - 1);
+    // Flush it
+    uRingBufferFlush(&ringBuffer);
+    U_PORT_TEST_ASSERT(uRingBufferDataSize(&ringBuffer) == 0);
+    U_PORT_TEST_ASSERT(uRingBufferAvailableSize(&ringBuffer) == sizeof(linearBuffer) - 1);
+
+    U_TEST_PRINT_LINE("deleting ring buffer...");
+    uRingBufferDelete(&ringBuffer);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 // End of file
\ No newline at end of file
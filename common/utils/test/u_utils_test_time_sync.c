@@ -0,0 +1,209 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Test for the time service API
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_time_sync.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_TIME_SYNC_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** A UTC time to start from: November 2023.
+ */
+#define U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS (1700000000LL * 1000000000LL)
+
+/** How far in the past the first sample is taken to be.
+ */
+#define U_UTILS_TEST_TIME_SYNC_INTERVAL_MS 300000
+
+/** The drift of the local tick that the samples imply, in parts
+ * per billion.
+ */
+#define U_UTILS_TEST_TIME_SYNC_DRIFT_PPB 100000
+
+/** The margin allowed for time passing while the test runs.
+ */
+#define U_UTILS_TEST_TIME_SYNC_MARGIN_NANOSECONDS (1000LL * 1000000LL)
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TESTS
+ * -------------------------------------------------------------- */
+
+U_PORT_TEST_FUNCTION("[timeSync]", "timeSyncBasic")
+{
+    int32_t heapAllocCount;
+    int32_t startTickMs;
+    int32_t tickMs;
+    int64_t timeUtcNanoseconds;
+    int64_t expectedNanoseconds;
+    int64_t accuracyNanoseconds;
+    int64_t previousAccuracyNanoseconds;
+    uTimeSyncSource_t source;
+    int32_t driftPpb;
+
+    U_TEST_PRINT_LINE("testing time service.");
+    heapAllocCount = uPortHeapAllocCount();
+
+    // Nothing works before initialisation
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(NULL, NULL) == (int64_t) U_ERROR_COMMON_NOT_INITIALISED);
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_GNSS, 0, 0,
+                                     uPortGetTickTimeMs()) == (int32_t) U_ERROR_COMMON_NOT_INITIALISED);
+    U_PORT_TEST_ASSERT(uTimeSyncDriftGet(&driftPpb) == (int32_t) U_ERROR_COMMON_NOT_INITIALISED);
+
+    U_PORT_TEST_ASSERT(uTimeSyncInit() == 0);
+    U_PORT_TEST_ASSERT(uTimeSyncInit() == 0);
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(NULL, NULL) == (int64_t) U_ERROR_COMMON_EMPTY);
+    U_PORT_TEST_ASSERT(uTimeSyncDriftGet(&driftPpb) == (int32_t) U_ERROR_COMMON_EMPTY);
+
+    // Bad parameters, including a tick in the future
+    tickMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_NONE, 0, 0, tickMs) < 0);
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_MAX_NUM, 0, 0, tickMs) < 0);
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_GNSS, -1, 0, tickMs) < 0);
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_GNSS, 0, -1, tickMs) < 0);
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_GNSS, 0, 0, tickMs + 10000) < 0);
+    U_PORT_TEST_ASSERT(uTimeSyncDriftGet(NULL) < 0);
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(NULL, NULL) == (int64_t) U_ERROR_COMMON_EMPTY);
+
+    // A GNSS sample from a while ago is adopted, after which the
+    // time is that plus the time elapsed
+    startTickMs = uPortGetTickTimeMs() - U_UTILS_TEST_TIME_SYNC_INTERVAL_MS;
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_GNSS,
+                                     U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS,
+                                     0, startTickMs) == 0);
+    source = U_TIME_SYNC_SOURCE_NONE;
+    timeUtcNanoseconds = uTimeSyncNowUtc(&accuracyNanoseconds, &source);
+    tickMs = uPortGetTickTimeMs();
+    U_TEST_PRINT_LINE("time is %d.%09d, accuracy %d ns.",
+                      (int32_t) (timeUtcNanoseconds / 1000000000),
+                      (int32_t) (timeUtcNanoseconds % 1000000000),
+                      (int32_t) accuracyNanoseconds);
+    expectedNanoseconds = U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS +
+                          ((int64_t) (tickMs - startTickMs) * 1000000);
+    U_PORT_TEST_ASSERT(source == U_TIME_SYNC_SOURCE_GNSS);
+    U_PORT_TEST_ASSERT(timeUtcNanoseconds <= expectedNanoseconds);
+    U_PORT_TEST_ASSERT(timeUtcNanoseconds > expectedNanoseconds - U_UTILS_TEST_TIME_SYNC_MARGIN_NANOSECONDS);
+    // Accuracy has degraded with the unknown drift of the tick
+    U_PORT_TEST_ASSERT(accuracyNanoseconds > 0);
+    U_PORT_TEST_ASSERT(uTimeSyncDriftGet(&driftPpb) == (int32_t) U_ERROR_COMMON_EMPTY);
+
+    // A much less accurate NITZ sample is ignored
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_CELL_NITZ,
+                                     U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS,
+                                     1000000000, uPortGetTickTimeMs()) ==
+                       (int32_t) U_ERROR_COMMON_IGNORED);
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(NULL, &source) >= expectedNanoseconds);
+    U_PORT_TEST_ASSERT(source == U_TIME_SYNC_SOURCE_GNSS);
+
+    // A second GNSS sample, now, says that UTC has advanced by
+    // slightly more than the local tick: the drift is measured
+    tickMs = startTickMs + U_UTILS_TEST_TIME_SYNC_INTERVAL_MS;
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_GNSS,
+                                     U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS +
+                                     ((int64_t) U_UTILS_TEST_TIME_SYNC_INTERVAL_MS * 1000000) +
+                                     (((int64_t) U_UTILS_TEST_TIME_SYNC_INTERVAL_MS *
+                                       U_UTILS_TEST_TIME_SYNC_DRIFT_PPB) / 1000),
+                                     0, tickMs) == 0);
+    U_PORT_TEST_ASSERT(uTimeSyncDriftGet(&driftPpb) == 0);
+    U_TEST_PRINT_LINE("drift is %d ppb.", driftPpb);
+    U_PORT_TEST_ASSERT(driftPpb == U_UTILS_TEST_TIME_SYNC_DRIFT_PPB);
+
+    // The time now includes the drift and is more accurate
+    timeUtcNanoseconds = uTimeSyncNowUtc(&previousAccuracyNanoseconds, NULL);
+    expectedNanoseconds = U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS +
+                          ((int64_t) (uPortGetTickTimeMs() - startTickMs) * 1000000) +
+                          (((int64_t) U_UTILS_TEST_TIME_SYNC_INTERVAL_MS *
+                            U_UTILS_TEST_TIME_SYNC_DRIFT_PPB) / 1000);
+    U_PORT_TEST_ASSERT(timeUtcNanoseconds <= expectedNanoseconds + U_UTILS_TEST_TIME_SYNC_MARGIN_NANOSECONDS);
+    U_PORT_TEST_ASSERT(timeUtcNanoseconds > expectedNanoseconds - U_UTILS_TEST_TIME_SYNC_MARGIN_NANOSECONDS);
+    U_PORT_TEST_ASSERT(previousAccuracyNanoseconds < accuracyNanoseconds);
+
+    // Time goes forward and accuracy degrades as it does so
+    uPortTaskBlock(100);
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(&accuracyNanoseconds, NULL) > timeUtcNanoseconds);
+    U_PORT_TEST_ASSERT(accuracyNanoseconds > previousAccuracyNanoseconds);
+
+    // A sample that jumps wildly, but claims to be accurate, is
+    // adopted without disturbing the measured drift
+    U_PORT_TEST_ASSERT(uTimeSyncFeed(U_TIME_SYNC_SOURCE_OTHER,
+                                     U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS * 2,
+                                     0, uPortGetTickTimeMs()) == 0);
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(NULL, &source) >= U_UTILS_TEST_TIME_SYNC_START_NANOSECONDS * 2);
+    U_PORT_TEST_ASSERT(source == U_TIME_SYNC_SOURCE_OTHER);
+    U_PORT_TEST_ASSERT(uTimeSyncDriftGet(&driftPpb) == 0);
+    U_PORT_TEST_ASSERT(driftPpb == U_UTILS_TEST_TIME_SYNC_DRIFT_PPB);
+
+    // Deinitialising forgets everything
+    uTimeSyncDeinit();
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(NULL, NULL) == (int64_t) U_ERROR_COMMON_NOT_INITIALISED);
+    U_PORT_TEST_ASSERT(uTimeSyncInit() == 0);
+    U_PORT_TEST_ASSERT(uTimeSyncNowUtc(NULL, NULL) == (int64_t) U_ERROR_COMMON_EMPTY);
+    U_PORT_TEST_ASSERT(uTimeSyncDriftGet(&driftPpb) == (int32_t) U_ERROR_COMMON_EMPTY);
+    uTimeSyncDeinit();
+
+    // Check that we haven't leaked any heap
+    U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+}
+
+// End of file
@@ -0,0 +1,617 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @brief This example measures the performance of a u-blox module
+ * and of ubxlib end to end: sustained TCP throughput, UDP round-trip
+ * latency percentiles, MQTT publish rate and HTTP download rate,
+ * all against the ubxlib.com echo server, breaking the time taken by
+ * each down into that spent in AT commands, of which an estimate of
+ * the time spent on the wire between MCU and module, and the rest,
+ * which is application and waiting time.  Run it with the same module
+ * and network before and after a change of module firmware or of
+ * ubxlib version to compare the two.
+ *
+ * The breakdown requires U_CFG_AT_CLIENT_STATS to be defined for the
+ * build; without it only the totals are printed.
+ *
+ * The choice of module and the choice of platform on which this
+ * code runs is made at build time, see the README.md for
+ * instructions.
+ */
+
+#include "string.h" // For memset()
+#include "stdlib.h" // For qsort()
+#include "stdio.h"  // For snprintf()
+
+// Bring in all of the ubxlib public header files
+#include "ubxlib.h"
+
+// Bring in the application settings
+#include "u_cfg_app_platform_specific.h"
+
+// For U_SHORT_RANGE_TEST_WIFI()
+#include "u_short_range_test_selector.h"
+
+#ifndef U_CFG_DISABLE_TEST_AUTOMATION
+// This purely for internal u-blox testing
+# include "u_cfg_test_platform_specific.h"
+# include "u_wifi_test_cfg.h"
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+// Echo server URL and port numbers, see
+// port/platform/common/automation/ECHO_SERVER.md
+#define MY_SERVER_NAME "ubxlib.com"
+#define MY_SERVER_TCP_PORT 5055
+#define MY_SERVER_UDP_PORT 5050
+#define MY_HTTP_SERVER_NAME "ubxlib.com:8080"
+
+// The amount of data to send to, and receive back from, the
+// TCP echo server.
+#ifndef MY_TCP_SIZE_BYTES
+# define MY_TCP_SIZE_BYTES (16 * 1024)
+#endif
+
+// The number of UDP round trips to time.
+#ifndef MY_UDP_NUM_ROUND_TRIPS
+# define MY_UDP_NUM_ROUND_TRIPS 20
+#endif
+
+// The size of each UDP datagram.
+#ifndef MY_UDP_SIZE_BYTES
+# define MY_UDP_SIZE_BYTES 64
+#endif
+
+// The number of MQTT messages to publish.
+#ifndef MY_MQTT_NUM_PUBLISHES
+# define MY_MQTT_NUM_PUBLISHES 10
+#endif
+
+// The size of each MQTT message.
+#ifndef MY_MQTT_SIZE_BYTES
+# define MY_MQTT_SIZE_BYTES 256
+#endif
+
+// The size of the file to upload to, and then download
+// from, the HTTP server.
+#ifndef MY_HTTP_SIZE_BYTES
+# define MY_HTTP_SIZE_BYTES 2048
+#endif
+
+// The number of bits on the wire per byte over a UART: start,
+// eight data bits, stop.
+#define MY_UART_BITS_PER_BYTE 10
+
+// For u-blox internal testing only
+#ifdef U_PORT_TEST_ASSERT
+# define EXAMPLE_FINAL_STATE(x) U_PORT_TEST_ASSERT(x);
+#else
+# define EXAMPLE_FINAL_STATE(x)
+#endif
+
+#ifndef U_PORT_TEST_FUNCTION
+# error if you are not using the unit test framework to run this code you must ensure that the platform clocks/RTOS are set up and either define U_PORT_TEST_FUNCTION yourself or replace it as necessary.
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+// Below is the module configuration
+// When U_CFG_TEST_CELL_MODULE_TYPE is set this example will setup a cellular
+// link using uNetworkConfigurationCell_t.
+// When U_CFG_TEST_SHORT_RANGE_MODULE_TYPE is set this example will instead use
+// uNetworkConfigurationWifi_t config to setup a Wifi connection.
+
+#if U_SHORT_RANGE_TEST_WIFI()
+
+// Set U_CFG_TEST_SHORT_RANGE_MODULE_TYPE to your module type,
+// chosen from the values in common/short_range/api/u_short_range_module_type.h
+
+// DEVICE i.e. module/chip configuration: in this case a short-range
+// module connected via UART
+static const uDeviceCfg_t gDeviceCfg = {
+    .deviceType = U_DEVICE_TYPE_SHORT_RANGE,
+    .deviceCfg = {
+        .cfgSho = {
+            .moduleType = U_CFG_TEST_SHORT_RANGE_MODULE_TYPE
+        },
+    },
+    .transportType = U_DEVICE_TRANSPORT_TYPE_UART,
+    .transportCfg = {
+        .cfgUart = {
+            .uart = U_CFG_APP_SHORT_RANGE_UART,
+            .baudRate = U_SHORT_RANGE_UART_BAUD_RATE,
+            .pinTxd = U_CFG_APP_PIN_SHORT_RANGE_TXD,
+            .pinRxd = U_CFG_APP_PIN_SHORT_RANGE_RXD,
+            .pinCts = U_CFG_APP_PIN_SHORT_RANGE_CTS,
+            .pinRts = U_CFG_APP_PIN_SHORT_RANGE_RTS,
+#ifdef U_CFG_APP_UART_PREFIX
+            .pPrefix = U_PORT_STRINGIFY_QUOTED(U_CFG_APP_UART_PREFIX) // Relevant for Linux only
+#else
+            .pPrefix = NULL
+#endif
+        },
+    },
+};
+// NETWORK configuration for Wi-Fi
+static const uNetworkCfgWifi_t gNetworkCfg = {
+    .type = U_NETWORK_TYPE_WIFI,
+    .pSsid = U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_SSID), /* Wifi SSID - replace with your SSID */
+    .authentication = U_WIFI_TEST_CFG_AUTHENTICATION, /* Authentication mode (see uWifiAuth_t in wifi/api/u_wifi.h) */
+    .pPassPhrase = U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_WPA2_PASSPHRASE) /* WPA2 passphrase */
+};
+static const uNetworkType_t gNetType = U_NETWORK_TYPE_WIFI;
+
+#elif defined(U_CFG_TEST_CELL_MODULE_TYPE)
+
+// Cellular configuration.
+// Set U_CFG_TEST_CELL_MODULE_TYPE to your module type,
+// chosen from the values in cell/api/u_cell_module_type.h
+//
+// Note that the pin numbers are those of the MCU: if you
+// are using an MCU inside a u-blox module the IO pin numbering
+// for the module is likely different that from the MCU: check
+// the data sheet for the module to determine the mapping.
+
+// DEVICE i.e. module/chip configuration: in this case a cellular
+// module connected via UART
+static const uDeviceCfg_t gDeviceCfg = {
+    .deviceType = U_DEVICE_TYPE_CELL,
+    .deviceCfg = {
+        .cfgCell = {
+            .moduleType = U_CFG_TEST_CELL_MODULE_TYPE,
+            .pSimPinCode = NULL, /* SIM pin */
+            .pinEnablePower = U_CFG_APP_PIN_CELL_ENABLE_POWER,
+            .pinPwrOn = U_CFG_APP_PIN_CELL_PWR_ON,
+            .pinVInt = U_CFG_APP_PIN_CELL_VINT,
+            .pinDtrPowerSaving = U_CFG_APP_PIN_CELL_DTR
+        },
+    },
+    .transportType = U_DEVICE_TRANSPORT_TYPE_UART,
+    .transportCfg = {
+        .cfgUart = {
+            .uart = U_CFG_APP_CELL_UART,
+            .baudRate = U_CELL_UART_BAUD_RATE,
+            .pinTxd = U_CFG_APP_PIN_CELL_TXD,
+            .pinRxd = U_CFG_APP_PIN_CELL_RXD,
+            .pinCts = U_CFG_APP_PIN_CELL_CTS,
+            .pinRts = U_CFG_APP_PIN_CELL_RTS,
+#ifdef U_CFG_APP_UART_PREFIX
+            .pPrefix = U_PORT_STRINGIFY_QUOTED(U_CFG_APP_UART_PREFIX) // Relevant for Linux only
+#else
+            .pPrefix = NULL
+#endif
+        },
+    },
+};
+// NETWORK configuration for cellular
+static const uNetworkCfgCell_t gNetworkCfg = {
+    .type = U_NETWORK_TYPE_CELL,
+    .pApn = NULL, /* APN: NULL to accept default.  If using a Thingstream SIM enter "tsiot" here */
+    .timeoutSeconds = 240 /* Connection timeout in seconds */
+    // There is an additional field here "pKeepGoingCallback",
+    // which we do NOT set, we allow the compiler to set it to 0
+    // and all will be fine. You may set the field to a function
+    // of the form "bool keepGoingCallback(uDeviceHandle_t devHandle)",
+    // e.g.:
+    // .pKeepGoingCallback = keepGoingCallback
+    // ...and your function will be called periodically during an
+    // abortable network operation such as connect/disconnect;
+    // if it returns true the operation will continue else it
+    // will be aborted, allowing you immediate control.  If this
+    // field is set, timeoutSeconds will be ignored.
+};
+static const uNetworkType_t gNetType = U_NETWORK_TYPE_CELL;
+#else
+// No module available - set some dummy values to make test system happy
+static const uDeviceCfg_t gDeviceCfg = {.deviceType = U_DEVICE_TYPE_NONE};
+static const uNetworkCfgCell_t gNetworkCfg = {.type = U_NETWORK_TYPE_NONE};
+static const uNetworkType_t gNetType = U_NETWORK_TYPE_CELL;
+#endif
+
+// Data to send and a place to put data received; big enough
+// for the largest of the things above, other than TCP, which
+// is done in chunks of this size.
+static char gBuffer[MY_HTTP_SIZE_BYTES];
+
+// The UDP round-trip times.
+static int32_t gRoundTripMs[MY_UDP_NUM_ROUND_TRIPS];
+
+// The AT client statistics, see printBreakdown().
+static uAtClientStats_t gStats[U_AT_CLIENT_STATS_MAX_NUM_COMMANDS];
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Get the AT client of the device, NULL if there isn't one.
+static uAtClientHandle_t atHandleGet(uDeviceHandle_t devHandle)
+{
+    uAtClientHandle_t atHandle = NULL;
+
+    if (gDeviceCfg.deviceType == U_DEVICE_TYPE_CELL) {
+        uCellAtClientHandleGet(devHandle, &atHandle);
+    } else if (gDeviceCfg.deviceType == U_DEVICE_TYPE_SHORT_RANGE) {
+        uShortRangeAtClientHandleGet(devHandle, &atHandle);
+    }
+
+    return atHandle;
+}
+
+// Print how the time taken by a measurement, which started
+// at startTimeMs, and for which the AT client statistics were
+// reset at the start, broke down.
+static void printBreakdown(const char *pName, uAtClientHandle_t atHandle,
+                           int32_t startTimeMs)
+{
+    int32_t totalMs = uPortGetTickTimeMs() - startTimeMs;
+    int32_t numStats = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+    uint32_t atMs = 0;
+    uint32_t bytes = 0;
+    uint32_t wireMs = 0;
+
+    if (atHandle != NULL) {
+        numStats = uAtClientStatsGet(atHandle, gStats,
+                                     sizeof(gStats) / sizeof(gStats[0]));
+    }
+    if (numStats >= 0) {
+        for (int32_t x = 0; x < numStats; x++) {
+            atMs += gStats[x].latencyTotalMs;
+            bytes += gStats[x].bytesSent + gStats[x].bytesReceived;
+        }
+        if (gDeviceCfg.transportCfg.cfgUart.baudRate > 0) {
+            wireMs = (uint32_t) ((((uint64_t) bytes) * MY_UART_BITS_PER_BYTE * 1000) /
+                                 gDeviceCfg.transportCfg.cfgUart.baudRate);
+        }
+        uPortLog("%s: %d ms in total, %u ms in AT commands (%u byte(s), of"
+                 " which ~%u ms on the wire), %d ms application/waiting.\n",
+                 pName, totalMs, atMs, bytes, wireMs, totalMs - (int32_t) atMs);
+        // Print the heaviest AT commands
+        for (int32_t x = 0; x < numStats; x++) {
+            if (gStats[x].latencyTotalMs * 10 >= atMs) {
+                uPortLog("  %s: %u time(s), %u ms, max %d ms.\n",
+                         gStats[x].command, gStats[x].count,
+                         gStats[x].latencyTotalMs, gStats[x].latencyMaxMs);
+            }
+        }
+        uAtClientStatsReset(atHandle);
+    } else {
+        uPortLog("%s: %d ms in total (define U_CFG_AT_CLIENT_STATS"
+                 " for a breakdown).\n", pName, totalMs);
+    }
+}
+
+// Print a rate in bytes per second.
+static void printRate(const char *pName, size_t bytes, int32_t durationMs)
+{
+    if (durationMs <= 0) {
+        durationMs = 1;
+    }
+    uPortLog("%s: %d byte(s) in %d ms, %d bytes/second.\n", pName,
+             (int32_t) bytes, durationMs,
+             (int32_t) ((((uint64_t) bytes) * 1000) / durationMs));
+}
+
+// For qsort().
+static int compareInt32(const void *pA, const void *pB)
+{
+    return (*((const int32_t *) pA) > * ((const int32_t *) pB)) -
+           (*((const int32_t *) pA) < * ((const int32_t *) pB));
+}
+
+// Fill gBuffer with something recognisable.
+static void bufferFill(size_t size)
+{
+    for (size_t x = 0; x < size; x++) {
+        gBuffer[x] = (char) ('A' + (x % 26));
+    }
+}
+
+// Send MY_TCP_SIZE_BYTES to the TCP echo server and read it all
+// back, returning the time taken or negative error code.
+static int32_t measureTcp(uDeviceHandle_t devHandle,
+                          const uSockAddress_t *pAddress)
+{
+    int32_t errorCodeOrMs = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    int32_t sock;
+    int32_t startTimeMs;
+    size_t txSize = 0;
+    size_t rxSize = 0;
+    int32_t x = 0;
+
+    sock = uSockCreate(devHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    if (sock >= 0) {
+        errorCodeOrMs = uSockConnect(sock, pAddress);
+        if (errorCodeOrMs == 0) {
+            bufferFill(sizeof(gBuffer));
+            startTimeMs = uPortGetTickTimeMs();
+            // Keep one buffer's worth in flight: write a chunk,
+            // then read back whatever has arrived
+            while ((x >= 0) && (rxSize < MY_TCP_SIZE_BYTES)) {
+                if (txSize < MY_TCP_SIZE_BYTES) {
+                    x = MY_TCP_SIZE_BYTES - txSize;
+                    if (x > (int32_t) sizeof(gBuffer)) {
+                        x = sizeof(gBuffer);
+                    }
+                    x = uSockWrite(sock, gBuffer, x);
+                    if (x > 0) {
+                        txSize += x;
+                    }
+                }
+                if (x >= 0) {
+                    x = uSockRead(sock, gBuffer, sizeof(gBuffer));
+                    if (x > 0) {
+                        rxSize += x;
+                    }
+                }
+            }
+            errorCodeOrMs = uPortGetTickTimeMs() - startTimeMs;
+            if (rxSize < MY_TCP_SIZE_BYTES) {
+                uPortLog("TCP: only %d byte(s) of %d came back (%d)!\n",
+                         (int32_t) rxSize, MY_TCP_SIZE_BYTES, x);
+                errorCodeOrMs = (int32_t) U_ERROR_COMMON_TRUNCATED;
+            } else {
+                printRate("TCP", txSize + rxSize, errorCodeOrMs);
+            }
+            uSockShutdown(sock, U_SOCK_SHUTDOWN_READ_WRITE);
+        }
+        uSockClose(sock);
+    }
+
+    return errorCodeOrMs;
+}
+
+// Time MY_UDP_NUM_ROUND_TRIPS round trips to the UDP echo server
+// and print the percentiles; returns the number of round trips
+// that succeeded.
+static int32_t measureUdp(uDeviceHandle_t devHandle,
+                          const uSockAddress_t *pAddress)
+{
+    int32_t numRoundTrips = 0;
+    int32_t sock;
+    int32_t startTimeMs;
+
+    sock = uSockCreate(devHandle, U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    if (sock >= 0) {
+        bufferFill(MY_UDP_SIZE_BYTES);
+        for (size_t x = 0; x < MY_UDP_NUM_ROUND_TRIPS; x++) {
+            startTimeMs = uPortGetTickTimeMs();
+            if ((uSockSendTo(sock, pAddress, gBuffer,
+                             MY_UDP_SIZE_BYTES) == MY_UDP_SIZE_BYTES) &&
+                (uSockReceiveFrom(sock, NULL, gBuffer,
+                                  sizeof(gBuffer)) == MY_UDP_SIZE_BYTES)) {
+                gRoundTripMs[numRoundTrips] = uPortGetTickTimeMs() - startTimeMs;
+                numRoundTrips++;
+            }
+        }
+        uSockClose(sock);
+    }
+    if (numRoundTrips > 0) {
+        qsort(gRoundTripMs, numRoundTrips, sizeof(gRoundTripMs[0]), compareInt32);
+        uPortLog("UDP: %d of %d round trip(s) of %d byte(s), min %d ms, 50%% %d ms,"
+                 " 90%% %d ms, 99%% %d ms, max %d ms.\n", numRoundTrips,
+                 MY_UDP_NUM_ROUND_TRIPS, MY_UDP_SIZE_BYTES, gRoundTripMs[0],
+                 gRoundTripMs[(numRoundTrips * 50) / 100],
+                 gRoundTripMs[(numRoundTrips * 90) / 100],
+                 gRoundTripMs[(numRoundTrips * 99) / 100],
+                 gRoundTripMs[numRoundTrips - 1]);
+    } else {
+        uPortLog("UDP: no round trips succeeded!\n");
+    }
+
+    return numRoundTrips;
+}
+
+// Publish MY_MQTT_NUM_PUBLISHES messages to the MQTT broker,
+// returning the number published.
+static int32_t measureMqtt(uDeviceHandle_t devHandle)
+{
+    int32_t numPublishes = 0;
+    uMqttClientContext_t *pContext;
+    uMqttClientConnection_t connection = U_MQTT_CLIENT_CONNECTION_DEFAULT;
+    char topic[U_SECURITY_SERIAL_NUMBER_MAX_LENGTH_BYTES + 16];
+    int32_t startTimeMs;
+
+    pContext = pUMqttClientOpen(devHandle, NULL);
+    if (pContext != NULL) {
+        connection.pBrokerNameStr = MY_SERVER_NAME;
+        if (uMqttClientConnect(pContext, &connection) == 0) {
+            // Make the topic unique to this module
+            uSecurityGetSerialNumber(devHandle, topic);
+            strncat(topic, "/throughput", sizeof(topic) - strlen(topic) - 1);
+            bufferFill(MY_MQTT_SIZE_BYTES);
+            startTimeMs = uPortGetTickTimeMs();
+            for (size_t x = 0; x < MY_MQTT_NUM_PUBLISHES; x++) {
+                if (uMqttClientPublish(pContext, topic, gBuffer, MY_MQTT_SIZE_BYTES,
+                                       U_MQTT_QOS_AT_LEAST_ONCE, false) == 0) {
+                    numPublishes++;
+                }
+            }
+            startTimeMs = uPortGetTickTimeMs() - startTimeMs;
+            if (startTimeMs <= 0) {
+                startTimeMs = 1;
+            }
+            uPortLog("MQTT: %d of %d publish(es) of %d byte(s) in %d ms,"
+                     " %d.%02d publishes/second.\n", numPublishes,
+                     MY_MQTT_NUM_PUBLISHES, MY_MQTT_SIZE_BYTES, startTimeMs,
+                     (numPublishes * 1000) / startTimeMs,
+                     ((numPublishes * 100000) / startTimeMs) % 100);
+            uMqttClientDisconnect(pContext);
+        } else {
+            uPortLog("MQTT: unable to connect to broker \"%s\"!\n", MY_SERVER_NAME);
+        }
+        uMqttClientClose(pContext);
+    }
+
+    return numPublishes;
+}
+
+// Upload a file of MY_HTTP_SIZE_BYTES to the HTTP server and time
+// downloading it again, returning the number of bytes downloaded
+// or negative error code.
+static int32_t measureHttp(uDeviceHandle_t devHandle)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    uHttpClientContext_t *pContext;
+    uHttpClientConnection_t connection = U_HTTP_CLIENT_CONNECTION_DEFAULT;
+    char serialNumber[U_SECURITY_SERIAL_NUMBER_MAX_LENGTH_BYTES];
+    char path[U_SECURITY_SERIAL_NUMBER_MAX_LENGTH_BYTES + 16];
+    size_t size = sizeof(gBuffer);
+    int32_t startTimeMs;
+    int32_t statusCode;
+
+    // Make the path unique to this module
+    uSecurityGetSerialNumber(devHandle, serialNumber);
+    snprintf(path, sizeof(path), "/%s_tp.bin", serialNumber);
+    connection.pServerName = MY_HTTP_SERVER_NAME;
+    pContext = pUHttpClientOpen(devHandle, &connection, NULL);
+    if (pContext != NULL) {
+        bufferFill(MY_HTTP_SIZE_BYTES);
+        statusCode = uHttpClientPutRequest(pContext, path, gBuffer,
+                                           MY_HTTP_SIZE_BYTES,
+                                           "application/octet-stream");
+        if (statusCode == 200) {
+            memset(gBuffer, 0, sizeof(gBuffer));
+            startTimeMs = uPortGetTickTimeMs();
+            statusCode = uHttpClientGetRequest(pContext, path, gBuffer, &size, NULL);
+            startTimeMs = uPortGetTickTimeMs() - startTimeMs;
+            if (statusCode == 200) {
+                errorCodeOrSize = (int32_t) size;
+                printRate("HTTP download", size, startTimeMs);
+            } else {
+                uPortLog("HTTP: GET of \"%s\" failed, status code %d!\n",
+                         path, statusCode);
+            }
+            uHttpClientDeleteRequest(pContext, path);
+        } else {
+            uPortLog("HTTP: PUT of \"%s\" failed, status code %d!\n",
+                     path, statusCode);
+        }
+        uHttpClientClose(pContext);
+    }
+
+    return errorCodeOrSize;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: THE EXAMPLE
+ * -------------------------------------------------------------- */
+
+// The entry point, main(): before this is called the system
+// clocks must have been started and the RTOS must be running;
+// we are in task space.
+U_PORT_TEST_FUNCTION("[example]", "exampleThroughput")
+{
+    uDeviceHandle_t devHandle = NULL;
+    uAtClientHandle_t atHandle;
+    uSockAddress_t tcpAddress;
+    uSockAddress_t udpAddress;
+    int32_t tcpResult = -1;
+    int32_t udpResult = 0;
+    int32_t mqttResult = 0;
+    int32_t httpResult = -1;
+    int32_t startTimeMs;
+    int32_t returnCode;
+
+    // Initialise the APIs we will need
+    uPortInit();
+    uDeviceInit();
+
+    // Open the device
+    returnCode = uDeviceOpen(&gDeviceCfg, &devHandle);
+    uPortLog("Opened device with return code %d.\n", returnCode);
+
+    if (returnCode == 0) {
+        // Bring up the network interface
+        uPortLog("Bringing up the network...\n");
+        if (uNetworkInterfaceUp(devHandle, gNetType,
+                                &gNetworkCfg) == 0) {
+            atHandle = atHandleGet(devHandle);
+            if (uSockGetHostByName(devHandle, MY_SERVER_NAME,
+                                   &(tcpAddress.ipAddress)) == 0) {
+                tcpAddress.port = MY_SERVER_TCP_PORT;
+                udpAddress = tcpAddress;
+                udpAddress.port = MY_SERVER_UDP_PORT;
+
+                // Start the statistics from here
+                if (atHandle != NULL) {
+                    uAtClientStatsReset(atHandle);
+                }
+
+                startTimeMs = uPortGetTickTimeMs();
+                tcpResult = measureTcp(devHandle, &tcpAddress);
+                printBreakdown("TCP", atHandle, startTimeMs);
+
+                startTimeMs = uPortGetTickTimeMs();
+                udpResult = measureUdp(devHandle, &udpAddress);
+                printBreakdown("UDP", atHandle, startTimeMs);
+                uSockCleanUp();
+            } else {
+                uPortLog("Unable to look up \"%s\"!\n", MY_SERVER_NAME);
+            }
+
+            startTimeMs = uPortGetTickTimeMs();
+            mqttResult = measureMqtt(devHandle);
+            printBreakdown("MQTT", atHandle, startTimeMs);
+
+            startTimeMs = uPortGetTickTimeMs();
+            httpResult = measureHttp(devHandle);
+            printBreakdown("HTTP", atHandle, startTimeMs);
+
+            // When finished with the network layer
+            uPortLog("Taking down network...\n");
+            uNetworkInterfaceDown(devHandle, gNetType);
+        } else {
+            uPortLog("Unable to bring up the network!\n");
+        }
+
+        // Close the device
+        // Note: we don't power the device down here in order
+        // to speed up testing; you may prefer to power it off
+        // by setting the second parameter to true.
+        uDeviceClose(devHandle, false);
+
+    } else {
+        uPortLog("Unable to bring up the device!\n");
+    }
+
+    // Tidy up
+    uDeviceDeinit();
+    uPortDeinit();
+
+    uPortLog("Done.\n");
+
+#if defined(U_CFG_TEST_CELL_MODULE_TYPE) || U_SHORT_RANGE_TEST_WIFI()
+    // For u-blox internal testing only
+    EXAMPLE_FINAL_STATE((tcpResult >= 0) && (udpResult > 0) &&
+                        (mqttResult > 0) && (httpResult >= 0));
+#else
+    (void) tcpResult;
+    (void) udpResult;
+    (void) mqttResult;
+    (void) httpResult;
+#endif
+}
+
+// End of file
@@ -169,6 +169,40 @@ int32_t uGnssSetI2cAddress(uDeviceHandle_t gnssHandle, int32_t i2cAddress);
  */
 int32_t uGnssGetI2cAddress(uDeviceHandle_t gnssHandle);
 
+/** Set the size of the ring buffer into which messages streamed
+ * from the GNSS device (e.g. over I2C or UART or SPI) are placed;
+ * if this is not called the size will be
+ * #U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES.  A larger size may be
+ * needed to avoid losing data if high-rate messages (e.g.
+ * UBX-RXM-RAWX and UBX-RXM-SFRBX at a high baud rate) are being
+ * read; uGnssMsgReceiveStatHighWaterMark() may be used to find
+ * out how much is actually being used.  Any data in the existing
+ * ring buffer is lost.  This may be called at any time except while
+ * uGnssMsgReceiveStart() is active; when opening a GNSS device with
+ * uDeviceOpen() the ringBufferLengthBytes field of
+ * #uDeviceCfgGnss_t may be used instead.  Not relevant, and
+ * not supported, if the transport type is AT.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @param length      the size of the ring buffer in bytes; the
+ *                    ring buffer will be able to hold one byte less
+ *                    than this and it must be larger than
+ *                    #U_GNSS_MSG_TEMPORARY_BUFFER_LENGTH_BYTES + 1.
+ * @return            zero on success else negative error code;
+ *                    #U_ERROR_COMMON_BUSY will be returned if
+ *                    uGnssMsgReceiveStart() is active.
+ */
+int32_t uGnssSetRingBufferLength(uDeviceHandle_t gnssHandle, size_t length);
+
+/** Get the size of the ring buffer into which messages streamed
+ * from the GNSS device are placed.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @return            on success the size of the ring buffer in
+ *                    bytes, else negative error code.
+ */
+int32_t uGnssGetRingBufferLength(uDeviceHandle_t gnssHandle);
+
 /** Remove a GNSS instance.  It is up to the caller to ensure
  * that the GNSS module for the given instance has been powered down etc.;
  * all this function does is remove the logical instance.
@@ -38,6 +38,17 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_GNSS_CFG_VAL_SET_PIPELINE_MAX_MESSAGES
+/** The maximum number of UBX-CFG-VALSET messages that
+ * uGnssCfgValSetListTransaction() will send to the GNSS chip
+ * back-to-back, without waiting for an Ack, each message containing
+ * up to 64 values; a longer list will be sent in groups of this
+ * many messages, costing a round trip per group.  Reduce this if the
+ * input buffer of the GNSS chip is small.
+ */
+# define U_GNSS_CFG_VAL_SET_PIPELINE_MAX_MESSAGES 8
+#endif
+
 /** A helper macro to set a single value without a transaction and
  * with less typing: if you are using one of the key IDs from
  * u_gnss_cfg_val_key.h, you may use this macro as follows:
@@ -595,6 +606,89 @@ int32_t uGnssCfgValSetList(uDeviceHandle_t gnssHandle,
                            uGnssCfgValTransaction_t transaction,
                            uint32_t layers);
 
+/** Set the values of a list of configuration items of any length
+ * as a single transaction; only applicable to M9 modules and beyond.
+ * The list is split into as few UBX-CFG-VALSET messages as possible,
+ * using #U_GNSS_CFG_VAL_TRANSACTION_BEGIN, #U_GNSS_CFG_VAL_TRANSACTION_CONTINUE
+ * and #U_GNSS_CFG_VAL_TRANSACTION_EXECUTE as appropriate, and, where
+ * the GNSS chip is connected via a streamed transport (e.g. UART, I2C
+ * or SPI), the messages are sent back-to-back (see
+ * #U_GNSS_CFG_VAL_SET_PIPELINE_MAX_MESSAGES) and the Acks checked
+ * at the end, hence the configuration of an entire receiver costs
+ * about the same latency as setting a single value.  Where the GNSS
+ * chip is accessed through an intermediate module over AT commands,
+ * each message is sent and Acked in turn.
+ *
+ * Since the values are applied only when the last message has been
+ * received, if any message is Nacked or fails to be sent none of the
+ * values are applied.  This function is not itself part of a
+ * transaction begun with uGnssCfgValSet() / uGnssCfgValSetList():
+ * any such transaction will be cancelled.
+ *
+ * @param gnssHandle   the handle of the GNSS instance.
+ * @param[in] pList    a pointer to an array defining the values to set;
+ *                     cannot be NULL.
+ * @param numValues    the number of items in the array pointed-to by pList;
+ *                     must be greater than zero.
+ * @param layers       the layers to set the values in, a bit-map of
+ *                     #uGnssCfgValLayer_t values OR'ed together, see
+ *                     uGnssCfgValSetList().
+ * @return             zero on success else negative error code.
+ */
+int32_t uGnssCfgValSetListTransaction(uDeviceHandle_t gnssHandle,
+                                      const uGnssCfgVal_t *pList,
+                                      size_t numValues,
+                                      uint32_t layers);
+
+/** Set the values of a list of configuration items, writing only
+ * those that differ from what is already in the GNSS chip; only
+ * applicable to M9 modules and beyond.  This is intended for
+ * applications that apply their full configuration at every start:
+ * the current values are read, for each layer in turn, with as few
+ * UBX-CFG-VALGET polls as possible (each poll covers up to 64 keys),
+ * compared with pList and then only the differences are written,
+ * using uGnssCfgValSetListTransaction(), hence, where nothing has
+ * changed, no VALSET messages are sent at all.  A value that is not
+ * present in the layer being checked (e.g. one that has never been
+ * written to BBRAM) counts as a difference.
+ *
+ * Optionally the exchange with the GNSS chip can be skipped entirely:
+ * if pHash is non-NULL and points to the value returned by
+ * uGnssCfgValListHash() for pList (e.g. one your application stored
+ * in its own non-volatile storage after a previous call), nothing is
+ * read or written.  Only use this if you know that the GNSS chip has
+ * retained its configuration, e.g. because it is stored in the
+ * #U_GNSS_CFG_VAL_LAYER_FLASH layer, otherwise pass NULL.  On
+ * success, if pHash is non-NULL, it is updated with the hash of pList.
+ *
+ * @param gnssHandle   the handle of the GNSS instance.
+ * @param[in] pList    a pointer to an array defining the values to set;
+ *                     cannot be NULL.
+ * @param numValues    the number of items in the array pointed-to by pList;
+ *                     must be greater than zero.
+ * @param layers       the layers to set the values in, a bit-map of
+ *                     #uGnssCfgValLayer_t values OR'ed together; each
+ *                     layer is compared and written separately.
+ * @param[in,out] pHash  the hash of pList, see above; may be NULL.
+ * @return             on success the number of values that were
+ *                     written, summed across the layers, else negative
+ *                     error code.
+ */
+int32_t uGnssCfgValSetListDiff(uDeviceHandle_t gnssHandle,
+                               const uGnssCfgVal_t *pList,
+                               size_t numValues, uint32_t layers,
+                               uint32_t *pHash);
+
+/** Compute a hash of a list of configuration items, for use with
+ * uGnssCfgValSetListDiff(); the hash depends upon the order of the
+ * items and only on the significant bytes of each value.
+ *
+ * @param[in] pList    a pointer to an array of values; cannot be NULL.
+ * @param numValues    the number of items in the array pointed-to by pList.
+ * @return             the hash.
+ */
+uint32_t uGnssCfgValListHash(const uGnssCfgVal_t *pList, size_t numValues);
+
 /** Delete a configuration item; only applicable to M9 modules
  * and beyond, using the UBX-CFG-VALDEL mechanism.
  *
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_CORRECTION_H_
+#define _U_GNSS_CORRECTION_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#include "u_device.h"
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the correction forwarding functions
+ * of the GNSS API, intended for passing SPARTN (e.g. PointPerfect)
+ * or RTCM3 correction data, as it arrives from an MQTT broker, an
+ * HTTP server or a socket, to the GNSS device.
+ *
+ * Correction data may be passed to uGnssCorrectionFeed() in chunks of
+ * any size, with no regard to frame boundaries.  Frames are found and
+ * validated (CRC checked) in place and are sent to the GNSS device
+ * straight from the chunk passed in, adjacent frames in one go; only
+ * a frame which straddles two chunks is copied, into a buffer of
+ * [#U_SPARTN_MESSAGE_LENGTH_MAX_BYTES](u_spartn.h), in order to be
+ * put back together.  Data which is not part of a valid frame is
+ * discarded.
+ *
+ * If the GNSS transport does not accept everything that is sent to it,
+ * uGnssCorrectionFeed() returns having consumed less than it was
+ * given: the application should hold on to the rest and pass it in
+ * again later.  Note that not all transports can push back in this way;
+ * for instance, uPortUartWrite() on most platforms blocks until all
+ * of the data has been accepted by the UART driver.
+ *
+ * A streaming transport (UART, I2C, SPI or virtual serial) is required.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** Statistics for correction forwarding, since
+ * uGnssCorrectionStart() was called.
+ */
+typedef struct {
+    size_t framesForwarded; /**< the number of frames sent to the GNSS device. */
+    size_t bytesForwarded;  /**< the number of bytes sent to the GNSS device. */
+    size_t framesBad;       /**< the number of frames discarded because
+                                 they failed a CRC check. */
+    size_t bytesDiscarded;  /**< the number of bytes discarded because
+                                 they were not part of a valid frame,
+                                 including those of bad frames. */
+} uGnssCorrectionStatistics_t;
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Start forwarding correction data to the GNSS device.  If
+ * correction forwarding has already been started this function
+ * does nothing and returns success.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @return            zero on success else negative error code.
+ */
+int32_t uGnssCorrectionStart(uDeviceHandle_t gnssHandle);
+
+/** Pass a chunk of correction data, SPARTN or RTCM3 frames or a
+ * mixture of both, to be forwarded to the GNSS device.  Any part of a
+ * frame left over from the previous call is completed first.  If the
+ * GNSS transport pushes back then fewer than size bytes are consumed,
+ * in which case the application should, later on, call this function
+ * again with the rest; calling this function with pData NULL and size
+ * zero just retries sending whatever is outstanding.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @param[in] pData   the correction data; may only be NULL if size
+ *                    is zero.
+ * @param size        the number of bytes at pData.
+ * @return            the number of bytes of pData consumed, which may
+ *                    be zero if the GNSS transport is still pushing
+ *                    back, else negative error code.
+ */
+int32_t uGnssCorrectionFeed(uDeviceHandle_t gnssHandle,
+                            const char *pData, size_t size);
+
+/** Get the statistics of correction forwarding.
+ *
+ * @param gnssHandle        the handle of the GNSS instance.
+ * @param[out] pStatistics  a place to put the statistics; cannot be NULL.
+ * @return                  zero on success else negative error code.
+ */
+int32_t uGnssCorrectionGetStatistics(uDeviceHandle_t gnssHandle,
+                                     uGnssCorrectionStatistics_t *pStatistics);
+
+/** Stop forwarding correction data; any part of a frame that has
+ * not yet been sent to the GNSS device is discarded.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ */
+void uGnssCorrectionStop(uDeviceHandle_t gnssHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_CORRECTION_H_
+
+// End of file
@@ -24,6 +24,12 @@
 
 #include "u_gnss_dec_ubx_nav_pvt.h"
 #include "u_gnss_dec_ubx_nav_hpposllh.h"
+#include "u_gnss_dec_ubx_nav_sat.h"
+#include "u_gnss_dec_ubx_nav_sig.h"
+#include "u_gnss_dec_ubx_rxm_rawx.h"
+#include "u_gnss_dec_ubx_rxm_sfrbx.h"
+#include "u_gnss_dec_ubx_nav_cov.h"
+#include "u_gnss_dec_ubx_esf_meas.h"
 
 /** \addtogroup _GNSS
  *  @{
@@ -58,6 +64,12 @@ extern "C" {
 typedef union {
     uGnssDecUbxNavPvt_t           ubxNavPvt;      /**< UBX-NAV-PVT. */
     uGnssDecUbxNavHpposllh_t      ubxNavHpposllh; /**< UBX-NAV-HPPOSLLH. */
+    uGnssDecUbxNavSat_t           ubxNavSat;      /**< UBX-NAV-SAT. */
+    uGnssDecUbxNavSig_t           ubxNavSig;      /**< UBX-NAV-SIG. */
+    uGnssDecUbxRxmRawx_t          ubxRxmRawx;     /**< UBX-RXM-RAWX. */
+    uGnssDecUbxRxmSfrbx_t         ubxRxmSfrbx;    /**< UBX-RXM-SFRBX. */
+    uGnssDecUbxNavCov_t           ubxNavCov;      /**< UBX-NAV-COV. */
+    uGnssDecUbxEsfMeas_t          ubxEsfMeas;     /**< UBX-ESF-MEAS. */
 } uGnssDecUnion_t;
 
 /** The result of attempting to decode a message, returned by
@@ -94,6 +106,24 @@ typedef struct {
                                  be decoded. */
 } uGnssDec_t;
 
+/** The offset of the message body from the start of the storage
+ * passed to uGnssDecDecode(); the #uGnssDec_t structure comes first,
+ * rounded up to the size of a double so that the body is aligned.
+ */
+#define U_GNSS_DEC_BODY_OFFSET (((sizeof(uGnssDec_t) + sizeof(double) - 1) / \
+                                 sizeof(double)) * sizeof(double))
+
+/** The amount of storage that uGnssDecDecode() requires to decode
+ * a message of the given body type, e.g.
+ * `U_GNSS_DEC_SIZE(uGnssDecUbxNavPvt_t)`.
+ */
+#define U_GNSS_DEC_SIZE(bodyType) (U_GNSS_DEC_BODY_OFFSET + sizeof(bodyType))
+
+/** The amount of storage that uGnssDecDecode() requires to decode
+ * any of the messages known to this code.
+ */
+#define U_GNSS_DEC_SIZE_MAX U_GNSS_DEC_SIZE(uGnssDecUnion_t)
+
 /** Callback that can be hooked into pUGnssDecAlloc() by
  * uGnssDecSetCallback() to decode message types that are not
  * known to this code.
@@ -155,13 +185,20 @@ typedef int32_t (uGnssDecFunction_t) (uGnssMessageId_t *pId,
  * and must include all headers; no checking of checksums etc. on the
  * end of a known message is performed, hence they may be omitted.
  *
- * Currently only a very limited set of messages (actually just
- * UBX-NAV-PVT and UBX-NAV-HPPOSLLH, the latter useful if you wish
- * to use a high precision GNSS (HPG) device to its full extent) are
- * supported; see the top of the file u_gnss_dec.c for instructions
+ * Currently only a limited set of messages (UBX-NAV-PVT,
+ * UBX-NAV-HPPOSLLH, the latter useful if you wish to use a high
+ * precision GNSS (HPG) device to its full extent, UBX-NAV-SAT,
+ * UBX-NAV-SIG, UBX-NAV-COV, UBX-RXM-RAWX, UBX-RXM-SFRBX and
+ * UBX-ESF-MEAS) are supported; see the top of the file u_gnss_dec.c
+ * for instructions
  * on how to add more decoders, or use uGnssDecSetCallback() to
  * hook-in your own decoders at run-time.
  *
+ * Only as much memory as the decoded message needs is allocated,
+ * not the size of #uGnssDecUnion_t; if you are decoding a message
+ * at a high rate and would rather not allocate memory at all, use
+ * uGnssDecUbx() instead.
+ *
  * If only a partial decode is possible then the errorCode field of
  * the returned structure will be negative but the protocol type
  * and a message ID may _still_ have been decoded; check for
@@ -181,7 +218,72 @@ typedef int32_t (uGnssDecFunction_t) (uGnssMessageId_t *pId,
  */
 uGnssDec_t *pUGnssDecAlloc(const char *pBuffer, size_t size);
 
-/** Free the memory returned by pUGnssDecAlloc().
+/** As pUGnssDecAlloc() but, rather than allocating memory, the
+ * #uGnssDec_t structure and the decoded message body are written to
+ * storage provided by the caller, allowing messages to be decoded
+ * at a high rate without heap churn.  The storage is laid out as a
+ * #uGnssDec_t followed, at #U_GNSS_DEC_BODY_OFFSET, by the message
+ * body, to which the pBody field of the #uGnssDec_t will point;
+ * the amount of storage required for a given message type is known
+ * at compile time: use #U_GNSS_DEC_SIZE, or #U_GNSS_DEC_SIZE_MAX to
+ * be able to decode any of the messages known to this code.  The
+ * storage must be aligned as for a double, e.g. by declaring it as
+ * an array of uint64_t.
+ *
+ * Since there is nowhere to put it, any decoder added with
+ * uGnssDecSetCallback() is NOT called.  Do NOT call uGnssDecFree()
+ * on the storage.
+ *
+ * @param[in] pBuffer  the buffer containing the message to be
+ *                     decoded; cannot be NULL.
+ * @param size         the amount of data at pBuffer.
+ * @param[out] pDec    a pointer to the storage; cannot be NULL.
+ * @param decSize      the number of bytes of storage at pDec.
+ * @return             zero on success, else negative error code,
+ *                     the same value as is written to the errorCode
+ *                     field of the #uGnssDec_t at pDec (which is
+ *                     not written if pDec is NULL or decSize is less
+ *                     than #U_GNSS_DEC_BODY_OFFSET);
+ *                     #U_ERROR_COMMON_NO_MEMORY means that decSize
+ *                     was too small for the message type.
+ */
+int32_t uGnssDecDecode(const char *pBuffer, size_t size,
+                       uGnssDec_t *pDec, size_t decSize);
+
+/** Decode a UBX message received from a GNSS device into a
+ * structure provided by the caller, without allocating any memory;
+ * useful for messages that arrive at a high rate, e.g. UBX-NAV-SAT
+ * or UBX-RXM-RAWX in the callback of uGnssMsgReceiveStart().  Only
+ * the message types that pUGnssDecAlloc() decodes natively are
+ * supported: anything added with uGnssDecSetCallback() is not.  As
+ * with pUGnssDecAlloc(), no checking of the checksum is performed,
+ * hence it may be omitted.
+ *
+ * The structure is not zeroed first: only the fields of the message,
+ * and the entries of any array up to the count of entries populated
+ * (e.g. the svCount field of #uGnssDecUbxNavSat_t), are written.
+ *
+ * @param[in] pBuffer  the buffer containing the UBX message, starting
+ *                     with the 0xB5 0x62 header; cannot be NULL.
+ * @param size         the amount of data at pBuffer.
+ * @param[out] pBody   a pointer to the structure to populate, which
+ *                     must be of the type that matches the message,
+ *                     e.g. #uGnssDecUbxNavSat_t for UBX-NAV-SAT, or
+ *                     may be a #uGnssDecUnion_t; cannot be NULL.
+ * @param bodySize     the amount of storage at pBody.
+ * @return             zero on success, else negative error code:
+ *                     #U_ERROR_COMMON_UNKNOWN if this is not a
+ *                     UBX message, #U_ERROR_COMMON_NOT_SUPPORTED if
+ *                     there is no decoder for the message,
+ *                     #U_ERROR_COMMON_TRUNCATED if the message is
+ *                     incomplete and #U_ERROR_COMMON_NO_MEMORY if
+ *                     bodySize is too small for the message type.
+ */
+int32_t uGnssDecUbx(const char *pBuffer, size_t size,
+                    void *pBody, size_t bodySize);
+
+/** Free the memory returned by pUGnssDecAlloc(); not for use
+ * with uGnssDecDecode().
  *
  * @param[in] pDec the pointer returned by pUGnssDecAlloc(); may
  *                 be NULL.
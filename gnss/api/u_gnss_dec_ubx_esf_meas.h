@@ -0,0 +1,147 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_DEC_UBX_ESF_MEAS_H_
+#define _U_GNSS_DEC_UBX_ESF_MEAS_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the types of a UBX-ESF-MEAS
+ * message.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The message class of a UBX-ESF-MEAS message.
+ */
+#define U_GNSS_DEC_UBX_ESF_MEAS_MESSAGE_CLASS 0x10
+
+/** The message ID of a UBX-ESF-MEAS message.
+ */
+#define U_GNSS_DEC_UBX_ESF_MEAS_MESSAGE_ID 0x02
+
+/** The minimum length of the body of a UBX-ESF-MEAS message.
+ */
+#define U_GNSS_DEC_UBX_ESF_MEAS_BODY_MIN_LENGTH 8
+
+/** The length of each repeated block of a UBX-ESF-MEAS message.
+ */
+#define U_GNSS_DEC_UBX_ESF_MEAS_BLOCK_LENGTH 4
+
+/** The maximum number of measurements in a UBX-ESF-MEAS message,
+ * limited by the width of the numMeas field of "flags".
+ */
+#define U_GNSS_DEC_UBX_ESF_MEAS_MAX_NUM_MEAS 31
+
+/** The mask for the #U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_TIME_MARK_SENT
+ * field of the "flags" field of #uGnssDecUbxEsfMeas_t.
+ */
+#define U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_TIME_MARK_SENT_MASK 0x0003
+
+/** The mask for the #U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_NUM_MEAS
+ * field of the "flags" field of #uGnssDecUbxEsfMeas_t.
+ */
+#define U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_NUM_MEAS_MASK 0xF800
+
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** Bit fields of the "flags" field of #uGnssDecUbxEsfMeas_t; use
+ * these to mask specific bits, e.g.
+ *
+ * `if (flags & (1 << U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_CALIB_TTAG_VALID)) {`
+ *
+ * ...would determine if the calibTtag field is valid, though note
+ * that #U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_TIME_MARK_SENT and
+ * #U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_NUM_MEAS are wider than a single
+ * bit.
+ */
+typedef enum {
+    U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_TIME_MARK_SENT = 0,    /**< not a single bit, the
+                                                              start of a 2-bit field, use
+                                                              #U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_TIME_MARK_SENT_MASK
+                                                              to mask it: 0 none, 1 on
+                                                              Ext0, 2 on Ext1. */
+    U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_TIME_MARK_EDGE = 2,    /**< 0 rising edge, 1 falling
+                                                              edge. */
+    U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_CALIB_TTAG_VALID = 3,  /**< the calibTtag field is
+                                                              valid. */
+    U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_NUM_MEAS = 11          /**< not a single bit, the
+                                                              start of a 5-bit field, use
+                                                              #U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_NUM_MEAS_MASK
+                                                              to mask it: the number of
+                                                              measurements in the message. */
+} uGnssDecUbxEsfMeasFlags_t;
+
+/** The repeated block of a UBX-ESF-MEAS message, one per measurement.
+ * The "data" field of the interface manual is split into its
+ * constituent parts here.
+ */
+typedef struct {
+    int32_t dataField; /**< the data, sign-extended from 24 bits; the
+                            units depend on dataType. */
+    uint8_t dataType;  /**< the type of data, for instance 5 for gyroscope
+                            z-axis angular rate, 11 for wheel tick,
+                            16 to 18 for accelerometer x, y and z-axis
+                            specific force; see the interface manual. */
+} uGnssDecUbxEsfMeasData_t;
+
+/** UBX-ESF-MEAS message structure; the naming and type of each
+ * element follows that of the interface manual.
+ */
+typedef struct {
+    uint32_t timeTag;    /**< time tag of the measurement, in a sensor
+                              specific time base. */
+    uint16_t flags;      /**< see #uGnssDecUbxEsfMeasFlags_t. */
+    uint16_t id;         /**< identification number of the data
+                              provider. */
+    size_t dataCount;    /**< the number of entries populated in
+                              data[], taken from the numMeas field
+                              of flags. */
+    uGnssDecUbxEsfMeasData_t data[U_GNSS_DEC_UBX_ESF_MEAS_MAX_NUM_MEAS]; /**< the
+                                                                              measurements. */
+    uint32_t calibTtag;  /**< receiver local time, calibrated, in
+                              milliseconds; only valid if the
+                              #U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_CALIB_TTAG_VALID
+                              bit of flags is set. */
+} uGnssDecUbxEsfMeas_t;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_DEC_UBX_ESF_MEAS_H_
+
+// End of file
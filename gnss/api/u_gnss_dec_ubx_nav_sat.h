@@ -0,0 +1,188 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_DEC_UBX_NAV_SAT_H_
+#define _U_GNSS_DEC_UBX_NAV_SAT_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the types of a UBX-NAV-SAT
+ * message.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The message class of a UBX-NAV-SAT message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SAT_MESSAGE_CLASS 0x01
+
+/** The message ID of a UBX-NAV-SAT message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SAT_MESSAGE_ID 0x35
+
+/** The minimum length of the body of a UBX-NAV-SAT message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SAT_BODY_MIN_LENGTH 8
+
+/** The length of each repeated block of a UBX-NAV-SAT message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SAT_BLOCK_LENGTH 12
+
+#ifndef U_GNSS_DEC_UBX_NAV_SAT_MAX_NUM_SVS
+/** The maximum number of satellites that will be stored in
+ * #uGnssDecUbxNavSat_t; any more than this in a message are
+ * ignored.  Each one costs 16 bytes of RAM.
+ */
+# define U_GNSS_DEC_UBX_NAV_SAT_MAX_NUM_SVS 64
+#endif
+
+/** The mask for the #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_QUALITY_IND field
+ * of the "flags" field of #uGnssDecUbxNavSatSv_t.
+ */
+#define U_GNSS_DEC_UBX_NAV_SAT_FLAGS_QUALITY_IND_MASK 0x00000007
+
+/** The mask for the #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_HEALTH field
+ * of the "flags" field of #uGnssDecUbxNavSatSv_t.
+ */
+#define U_GNSS_DEC_UBX_NAV_SAT_FLAGS_HEALTH_MASK 0x00000030
+
+/** The mask for the #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_ORBIT_SOURCE field
+ * of the "flags" field of #uGnssDecUbxNavSatSv_t.
+ */
+#define U_GNSS_DEC_UBX_NAV_SAT_FLAGS_ORBIT_SOURCE_MASK 0x00000700
+
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** Bit fields of the "flags" field of #uGnssDecUbxNavSatSv_t; use
+ * these to mask specific bits, e.g.
+ *
+ * `if (flags & (1 << U_GNSS_DEC_UBX_NAV_SAT_FLAGS_SV_USED)) {`
+ *
+ * ...would determine if the satellite is being used for navigation,
+ * though note that #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_QUALITY_IND,
+ * #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_HEALTH and
+ * #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_ORBIT_SOURCE are wider than a
+ * single bit.
+ */
+typedef enum {
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_QUALITY_IND = 0,     /**< not a single bit, the start
+                                                           of a 3-bit field, use
+                                                           #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_QUALITY_IND_MASK
+                                                           to mask it: 0 no signal, 1 searching,
+                                                           2 signal acquired, 3 signal detected
+                                                           but unusable, 4 code locked and time
+                                                           synchronised, 5 to 7 code and carrier
+                                                           locked and time synchronised. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_SV_USED = 3,         /**< the signal of this satellite
+                                                           is being used for navigation. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_HEALTH = 4,          /**< not a single bit, the start of
+                                                           a 2-bit field, use
+                                                           #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_HEALTH_MASK
+                                                           to mask it: 0 unknown, 1 healthy,
+                                                           2 unhealthy. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_DIFF_CORR = 6,       /**< differential correction data
+                                                           is available for this satellite. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_SMOOTHED = 7,        /**< carrier-smoothed pseudorange
+                                                           is being used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_ORBIT_SOURCE = 8,    /**< not a single bit, the start of
+                                                           a 3-bit field, use
+                                                           #U_GNSS_DEC_UBX_NAV_SAT_FLAGS_ORBIT_SOURCE_MASK
+                                                           to mask it: 0 no orbit information,
+                                                           1 ephemeris, 2 almanac, 3 AssistNow
+                                                           Offline, 4 AssistNow Autonomous,
+                                                           5 to 7 other. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_EPH_AVAIL = 11,      /**< ephemeris is available. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_ALM_AVAIL = 12,      /**< almanac is available. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_ANO_AVAIL = 13,      /**< AssistNow Offline data is
+                                                           available. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_AOP_AVAIL = 14,      /**< AssistNow Autonomous data is
+                                                           available. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_SBAS_CORR_USED = 16, /**< SBAS corrections have been
+                                                           used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_RTCM_CORR_USED = 17, /**< RTCM corrections have been
+                                                           used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_SLAS_CORR_USED = 18, /**< QZSS SLAS corrections have
+                                                           been used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_SPARTN_CORR_USED = 19, /**< SPARTN corrections have
+                                                             been used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_PR_CORR_USED = 20,   /**< pseudorange corrections have
+                                                           been used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_CR_CORR_USED = 21,   /**< carrier range corrections
+                                                           have been used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_DO_CORR_USED = 22,   /**< range rate (Doppler)
+                                                           corrections have been used. */
+    U_GNSS_DEC_UBX_NAV_SAT_FLAGS_CLAS_CORR_USED = 23  /**< CLAS corrections have been
+                                                           used. */
+} uGnssDecUbxNavSatFlags_t;
+
+/** The repeated block of a UBX-NAV-SAT message, one per satellite;
+ * the naming and type of each element follows that of the interface
+ * manual.
+ */
+typedef struct {
+    uint8_t gnssId; /**< GNSS identifier, see #uGnssSystem_t. */
+    uint8_t svId;   /**< satellite identifier. */
+    uint8_t cno;    /**< carrier to noise ratio in dBHz. */
+    int8_t elev;    /**< elevation in degrees, range +/-90, unknown
+                         if out of range. */
+    int16_t azim;   /**< azimuth in degrees, range 0 to 360, unknown
+                         if elevation is out of range. */
+    int16_t prRes;  /**< pseudorange residual in metres times 10. */
+    uint32_t flags; /**< see #uGnssDecUbxNavSatFlags_t. */
+} uGnssDecUbxNavSatSv_t;
+
+/** UBX-NAV-SAT message structure; the naming and type of each
+ * element follows that of the interface manual.
+ */
+typedef struct {
+    uint32_t iTOW;   /**< GPS time of week of the navigation epoch
+                          in milliseconds. */
+    uint8_t version; /**< message version. */
+    uint8_t numSvs;  /**< the number of satellites in the message. */
+    size_t svCount;  /**< the number of entries populated in sv[],
+                          the lesser of numSvs and
+                          #U_GNSS_DEC_UBX_NAV_SAT_MAX_NUM_SVS. */
+    uGnssDecUbxNavSatSv_t sv[U_GNSS_DEC_UBX_NAV_SAT_MAX_NUM_SVS]; /**< the
+                                                                       satellites. */
+} uGnssDecUbxNavSat_t;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_DEC_UBX_NAV_SAT_H_
+
+// End of file
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_DEC_UBX_NAV_SIG_H_
+#define _U_GNSS_DEC_UBX_NAV_SIG_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the types of a UBX-NAV-SIG
+ * message.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The message class of a UBX-NAV-SIG message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SIG_MESSAGE_CLASS 0x01
+
+/** The message ID of a UBX-NAV-SIG message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SIG_MESSAGE_ID 0x43
+
+/** The minimum length of the body of a UBX-NAV-SIG message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SIG_BODY_MIN_LENGTH 8
+
+/** The length of each repeated block of a UBX-NAV-SIG message.
+ */
+#define U_GNSS_DEC_UBX_NAV_SIG_BLOCK_LENGTH 16
+
+#ifndef U_GNSS_DEC_UBX_NAV_SIG_MAX_NUM_SIGS
+/** The maximum number of signals that will be stored in
+ * #uGnssDecUbxNavSig_t; any more than this in a message are
+ * ignored.  Each one costs 12 bytes of RAM.
+ */
+# define U_GNSS_DEC_UBX_NAV_SIG_MAX_NUM_SIGS 64
+#endif
+
+/** The mask for the #U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_HEALTH field
+ * of the "sigFlags" field of #uGnssDecUbxNavSigSig_t.
+ */
+#define U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_HEALTH_MASK 0x0003
+
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** Bit fields of the "sigFlags" field of #uGnssDecUbxNavSigSig_t;
+ * use these to mask specific bits, e.g.
+ *
+ * `if (sigFlags & (1 << U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_PR_USED)) {`
+ *
+ * ...would determine if the pseudorange of the signal has been used,
+ * though note that #U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_HEALTH is wider
+ * than a single bit.
+ */
+typedef enum {
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_HEALTH = 0,       /**< not a single bit, the start
+                                                            of a 2-bit field, use
+                                                            #U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_HEALTH_MASK
+                                                            to mask it: 0 unknown, 1 healthy,
+                                                            2 unhealthy. */
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_PR_SMOOTHED = 2,  /**< the pseudorange has been
+                                                            smoothed. */
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_PR_USED = 3,      /**< the pseudorange has been
+                                                            used. */
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_CR_USED = 4,      /**< the carrier range has been
+                                                            used. */
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_DO_USED = 5,      /**< the range rate (Doppler)
+                                                            has been used. */
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_PR_CORR_USED = 6, /**< pseudorange corrections
+                                                            have been used. */
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_CR_CORR_USED = 7, /**< carrier range corrections
+                                                            have been used. */
+    U_GNSS_DEC_UBX_NAV_SIG_SIG_FLAGS_DO_CORR_USED = 8  /**< range rate (Doppler)
+                                                            corrections have been used. */
+} uGnssDecUbxNavSigSigFlags_t;
+
+/** The repeated block of a UBX-NAV-SIG message, one per signal;
+ * the naming and type of each element follows that of the interface
+ * manual.
+ */
+typedef struct {
+    uint8_t gnssId;     /**< GNSS identifier, see #uGnssSystem_t. */
+    uint8_t svId;       /**< satellite identifier. */
+    uint8_t sigId;      /**< signal identifier. */
+    uint8_t freqId;     /**< GLONASS frequency slot + 7, range 0 to 13. */
+    int16_t prRes;      /**< pseudorange residual in metres times 10. */
+    uint8_t cno;        /**< carrier to noise ratio in dBHz. */
+    uint8_t qualityInd; /**< signal quality indicator, range 0 to 7, with
+                             the same meaning as the qualityInd field of
+                             UBX-NAV-SAT. */
+    uint8_t corrSource; /**< correction source: 0 none, 1 SBAS, 2 BeiDou,
+                             3 RTCM2, 4 RTCM3 OSR, 5 RTCM3 SSR, 6 QZSS SLAS,
+                             7 SPARTN, 8 CLAS. */
+    uint8_t ionoModel;  /**< ionospheric model used: 0 none, 1 Klobuchar
+                             GPS, 2 SBAS, 3 Klobuchar BeiDou, 8 dual
+                             frequency. */
+    uint16_t sigFlags;  /**< see #uGnssDecUbxNavSigSigFlags_t. */
+} uGnssDecUbxNavSigSig_t;
+
+/** UBX-NAV-SIG message structure; the naming and type of each
+ * element follows that of the interface manual.
+ */
+typedef struct {
+    uint32_t iTOW;   /**< GPS time of week of the navigation epoch
+                          in milliseconds. */
+    uint8_t version; /**< message version. */
+    uint8_t numSigs; /**< the number of signals in the message. */
+    size_t sigCount; /**< the number of entries populated in sig[],
+                          the lesser of numSigs and
+                          #U_GNSS_DEC_UBX_NAV_SIG_MAX_NUM_SIGS. */
+    uGnssDecUbxNavSigSig_t sig[U_GNSS_DEC_UBX_NAV_SIG_MAX_NUM_SIGS]; /**< the
+                                                                          signals. */
+} uGnssDecUbxNavSig_t;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_DEC_UBX_NAV_SIG_H_
+
+// End of file
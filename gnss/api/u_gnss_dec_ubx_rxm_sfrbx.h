@@ -0,0 +1,102 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_DEC_UBX_RXM_SFRBX_H_
+#define _U_GNSS_DEC_UBX_RXM_SFRBX_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the types of a UBX-RXM-SFRBX
+ * message.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The message class of a UBX-RXM-SFRBX message.
+ */
+#define U_GNSS_DEC_UBX_RXM_SFRBX_MESSAGE_CLASS 0x02
+
+/** The message ID of a UBX-RXM-SFRBX message.
+ */
+#define U_GNSS_DEC_UBX_RXM_SFRBX_MESSAGE_ID 0x13
+
+/** The minimum length of the body of a UBX-RXM-SFRBX message.
+ */
+#define U_GNSS_DEC_UBX_RXM_SFRBX_BODY_MIN_LENGTH 8
+
+/** The length of each repeated block of a UBX-RXM-SFRBX message.
+ */
+#define U_GNSS_DEC_UBX_RXM_SFRBX_BLOCK_LENGTH 4
+
+#ifndef U_GNSS_DEC_UBX_RXM_SFRBX_MAX_NUM_WORDS
+/** The maximum number of data words that will be stored in
+ * #uGnssDecUbxRxmSfrbx_t; any more than this in a message are
+ * ignored.
+ */
+# define U_GNSS_DEC_UBX_RXM_SFRBX_MAX_NUM_WORDS 16
+#endif
+
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** UBX-RXM-SFRBX message structure; the naming and type of each
+ * element follows that of the interface manual.
+ */
+typedef struct {
+    uint8_t gnssId;   /**< GNSS identifier, see #uGnssSystem_t. */
+    uint8_t svId;     /**< satellite identifier. */
+    uint8_t sigId;    /**< signal identifier. */
+    uint8_t freqId;   /**< GLONASS frequency slot + 7, range 0 to 13. */
+    uint8_t numWords; /**< the number of data words in the message. */
+    uint8_t chn;      /**< the tracking channel number the message
+                           was received on. */
+    uint8_t version;  /**< message version. */
+    size_t dwrdCount; /**< the number of entries populated in dwrd[],
+                           the lesser of numWords and
+                           #U_GNSS_DEC_UBX_RXM_SFRBX_MAX_NUM_WORDS. */
+    uint32_t dwrd[U_GNSS_DEC_UBX_RXM_SFRBX_MAX_NUM_WORDS]; /**< the data words,
+                                                                the layout of
+                                                                which depends
+                                                                on gnssId and
+                                                                sigId. */
+} uGnssDecUbxRxmSfrbx_t;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_DEC_UBX_RXM_SFRBX_H_
+
+// End of file
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_GEOFENCE_H_
+#define _U_GNSS_GEOFENCE_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#include "u_device.h"
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines a geofence API: a set of circular
+ * and polygonal fences is created and, once attached to a GNSS
+ * instance with uGnssGeofenceAttach(), every position fix streamed
+ * from that instance (see uGnssPosGetStreamedStart()) is checked
+ * against the fences in the message receive task, the application
+ * only being called when a fence is entered or left.
+ *
+ * Each fence is given a bounding box and the fences are indexed
+ * by a grid of cells, each #U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7
+ * on a side, so that the cost of checking a position against even
+ * hundreds of fences is only that of checking it against the few
+ * that are nearby.  Distances are calculated using a flat-earth
+ * approximation about a reference point of each fence, hence no
+ * part of a fence may be further than
+ * #U_GNSS_GEOFENCE_MAX_SIZE_MILLIMETRES from that point; fences
+ * may cross the anti-meridian.
+ *
+ * Hysteresis applies: a fence is only entered once a position is
+ * inside it by at least the hysteresis distance and only left once
+ * a position is outside it by at least that distance, so that
+ * jitter in position at a boundary does not cause a stream of
+ * events.  When a set of fences is created every fence is
+ * considered to be "outside".
+ *
+ * These functions are thread-safe.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7
+/** The size of a side of a cell of the grid used to index
+ * fences, in ten millionths of a degree; the default of 0.1
+ * degrees is around 11 km of latitude.
+ */
+# define U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7 1000000
+#endif
+
+#ifndef U_GNSS_GEOFENCE_GRID_NUM_BUCKETS
+/** The number of hash buckets that the cells of the grid are
+ * spread across.
+ */
+# define U_GNSS_GEOFENCE_GRID_NUM_BUCKETS 64
+#endif
+
+#ifndef U_GNSS_GEOFENCE_GRID_MAX_CELLS_PER_FENCE
+/** A fence that overlaps more than this many cells of the grid is
+ * not indexed, it is instead checked against every position.
+ */
+# define U_GNSS_GEOFENCE_GRID_MAX_CELLS_PER_FENCE 16
+#endif
+
+#ifndef U_GNSS_GEOFENCE_MAX_SIZE_MILLIMETRES
+/** The maximum distance of any part of a fence, or the hysteresis
+ * distance around it, from its reference point (the centre of a
+ * circle or the first vertex of a polygon); this keeps the integer
+ * arithmetic used within range.
+ */
+# define U_GNSS_GEOFENCE_MAX_SIZE_MILLIMETRES 500000000
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The events that may be reported for a fence.
+ */
+typedef enum {
+    U_GNSS_GEOFENCE_EVENT_ENTER, /**< a position is inside the fence. */
+    U_GNSS_GEOFENCE_EVENT_EXIT   /**< a position is outside the fence. */
+} uGnssGeofenceEvent_t;
+
+/** A set of fences: opaque, obtain one with pUGnssGeofenceCreate().
+ */
+typedef struct uGnssGeofence_t uGnssGeofence_t;
+
+/** The callback for a fence being entered or left.
+ *
+ * @param gnssHandle      the handle of the GNSS instance that
+ *                        the position came from; NULL if the
+ *                        position was passed to uGnssGeofenceUpdate()
+ *                        with a NULL GNSS handle.
+ * @param fenceId         the ID of the fence, as given when it was
+ *                        added.
+ * @param event           the event.
+ * @param latitudeX1e7    the latitude of the position that caused
+ *                        the event, in ten millionths of a degree.
+ * @param longitudeX1e7   the longitude of the position that caused
+ *                        the event, in ten millionths of a degree.
+ * @param[in] pCallbackParam the parameter that was passed to
+ *                        pUGnssGeofenceCreate().
+ */
+typedef void (*uGnssGeofenceCallback_t)(uDeviceHandle_t gnssHandle,
+                                        int32_t fenceId,
+                                        uGnssGeofenceEvent_t event,
+                                        int32_t latitudeX1e7,
+                                        int32_t longitudeX1e7,
+                                        void *pCallbackParam);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Create an empty set of fences.  When done, free it with
+ * uGnssGeofenceFree().
+ *
+ * @param hysteresisMillimetres the hysteresis distance, must be zero
+ *                              or more.
+ * @param[in] pCallback         the function to call when a fence is
+ *                              entered or left; cannot be NULL.  Do
+ *                              not call back into this API for the same
+ *                              set of fences from pCallback.  When the
+ *                              set of fences is attached to a GNSS
+ *                              instance pCallback is called from the
+ *                              message receive task of that instance.
+ * @param[in] pCallbackParam    passed to pCallback as its last
+ *                              parameter; may be NULL.
+ * @return                      a pointer to the set of fences, else NULL
+ *                              on failure.
+ */
+uGnssGeofence_t *pUGnssGeofenceCreate(int32_t hysteresisMillimetres,
+                                      uGnssGeofenceCallback_t pCallback,
+                                      void *pCallbackParam);
+
+/** Free a set of fences; it must not be attached to a GNSS instance.
+ *
+ * @param[in] pGeofence the set of fences, as returned by
+ *                      pUGnssGeofenceCreate(); may be NULL.
+ */
+void uGnssGeofenceFree(uGnssGeofence_t *pGeofence);
+
+/** Add a circular fence to a set of fences.
+ *
+ * @param[in] pGeofence      the set of fences.
+ * @param fenceId            the ID for the fence, which must not
+ *                           already be in use in the set.
+ * @param latitudeX1e7       the latitude of the centre of the circle,
+ *                           in ten millionths of a degree.
+ * @param longitudeX1e7      the longitude of the centre of the circle,
+ *                           in ten millionths of a degree.
+ * @param radiusMillimetres  the radius of the circle, must be greater
+ *                           than zero.
+ * @return                   zero on success else negative error code.
+ */
+int32_t uGnssGeofenceAddCircle(uGnssGeofence_t *pGeofence, int32_t fenceId,
+                               int32_t latitudeX1e7, int32_t longitudeX1e7,
+                               int32_t radiusMillimetres);
+
+/** Add a polygonal fence to a set of fences.
+ *
+ * @param[in] pGeofence       the set of fences.
+ * @param fenceId             the ID for the fence, which must not
+ *                            already be in use in the set.
+ * @param[in] pLatitudeX1e7   an array of the latitudes of the vertices
+ *                            of the polygon, in ten millionths of a
+ *                            degree, in order around the polygon; the
+ *                            values are copied.
+ * @param[in] pLongitudeX1e7  an array of the longitudes of the vertices
+ *                            of the polygon, in ten millionths of a
+ *                            degree, in the same order; the values are
+ *                            copied.
+ * @param numVertices         the number of entries in each array, at
+ *                            least 3; the polygon is closed for you,
+ *                            there is no need to repeat the first
+ *                            vertex at the end.
+ * @return                    zero on success else negative error code.
+ */
+int32_t uGnssGeofenceAddPolygon(uGnssGeofence_t *pGeofence, int32_t fenceId,
+                                const int32_t *pLatitudeX1e7,
+                                const int32_t *pLongitudeX1e7,
+                                size_t numVertices);
+
+/** Remove a fence from a set of fences; no event is reported.
+ *
+ * @param[in] pGeofence the set of fences.
+ * @param fenceId       the ID of the fence to remove.
+ * @return              zero on success else negative error code.
+ */
+int32_t uGnssGeofenceRemove(uGnssGeofence_t *pGeofence, int32_t fenceId);
+
+/** Get whether the last position checked was inside a fence, i.e.
+ * whether the last event reported for it was an entry.
+ *
+ * @param[in] pGeofence the set of fences.
+ * @param fenceId       the ID of the fence.
+ * @return              1 if inside, 0 if outside, else negative
+ *                      error code.
+ */
+int32_t uGnssGeofenceIsInside(const uGnssGeofence_t *pGeofence,
+                              int32_t fenceId);
+
+/** Check a position against a set of fences, calling the callback
+ * for each fence entered or left.  There is no need to call this
+ * if the set of fences is attached to a GNSS instance, it is called
+ * for you with each fix, but it may be used to check positions
+ * obtained in other ways, e.g. from Cell Locate.
+ *
+ * @param[in] pGeofence  the set of fences.
+ * @param gnssHandle     the GNSS handle to pass to the callback;
+ *                       may be NULL.
+ * @param latitudeX1e7   the latitude in ten millionths of a degree.
+ * @param longitudeX1e7  the longitude in ten millionths of a degree.
+ * @return               the number of events reported, else negative
+ *                       error code.
+ */
+int32_t uGnssGeofenceUpdate(uGnssGeofence_t *pGeofence,
+                            uDeviceHandle_t gnssHandle,
+                            int32_t latitudeX1e7,
+                            int32_t longitudeX1e7);
+
+/** Attach a set of fences to a GNSS instance: thereafter every
+ * position fix obtained by the streamed position of that instance
+ * is checked against the fences, whether or not the fix is passed on
+ * to the streamed position callback, so uGnssPosGetStreamedStart()
+ * (or uGnssPosGetStreamedStartFiltered()) must also be called; the
+ * callback passed to those functions may be NULL if only geofencing
+ * is wanted.  Only one set of fences may be attached to a GNSS
+ * instance at a time; the set may be updated while it is attached.
+ *
+ * @param gnssHandle     the handle of the GNSS instance.
+ * @param[in] pGeofence  the set of fences; use NULL to detach any
+ *                       set of fences currently attached, which must
+ *                       be done before that set is freed.
+ * @return               zero on success else negative error code.
+ */
+int32_t uGnssGeofenceAttach(uDeviceHandle_t gnssHandle,
+                            uGnssGeofence_t *pGeofence);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_GEOFENCE_H_
+
+// End of file
@@ -42,6 +42,28 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_GNSS_INFO_COMMS_SAMPLER_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that samples UBX-MON-COMMS in the
+ * background, see uGnssInfoCommsSamplerStart(); the callback is
+ * called from this task.
+ */
+# define U_GNSS_INFO_COMMS_SAMPLER_TASK_STACK_SIZE_BYTES (1024 * 2)
+#endif
+
+#ifndef U_GNSS_INFO_COMMS_SAMPLER_INTERVAL_MIN_MS
+/** The shortest sampling interval that may be passed to
+ * uGnssInfoCommsSamplerStart(); each sample is a poll of the
+ * GNSS device which takes a few tens of milliseconds.
+ */
+# define U_GNSS_INFO_COMMS_SAMPLER_INTERVAL_MIN_MS 100
+#endif
+
+/** Default thresholds for uGnssInfoCommsSamplerStart(): report
+ * when either buffer of the GNSS device is 90% or more used, or
+ * when any receive overrun, skipped byte or host-side loss occurs.
+ */
+#define U_GNSS_INFO_COMMS_THRESHOLDS_DEFAULTS {90, 90, 1, 1, 1}
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -84,6 +106,101 @@ typedef struct {
     size_t rxSkippedBytes;        /**< the number of receive bytes skipped. */
 } uGnssCommunicationStats_t;
 
+/** The events that may be reported by uGnssInfoCommsCheck() and
+ * hence to the callback of uGnssInfoCommsSamplerStart(); the values
+ * are bit positions in the event bit-map.
+ */
+typedef enum {
+    U_GNSS_INFO_COMMS_EVENT_TX_OVERFLOW = 0, /**< the transmit buffer of the
+                                                  GNSS device was full during
+                                                  the last sysmon period, i.e.
+                                                  the GNSS device itself will
+                                                  have dropped output: reduce
+                                                  the message rate or increase
+                                                  the transport speed. */
+    U_GNSS_INFO_COMMS_EVENT_TX_USAGE = 1,    /**< the transmit buffer usage of
+                                                  the GNSS device reached the
+                                                  threshold. */
+    U_GNSS_INFO_COMMS_EVENT_RX_USAGE = 2,    /**< the receive buffer usage of
+                                                  the GNSS device reached the
+                                                  threshold. */
+    U_GNSS_INFO_COMMS_EVENT_RX_OVERRUN = 3,  /**< the number of receive overrun
+                                                  errors of the GNSS device
+                                                  increased by at least the
+                                                  threshold since the last
+                                                  sample. */
+    U_GNSS_INFO_COMMS_EVENT_RX_SKIPPED = 4,  /**< the number of receive bytes
+                                                  skipped by the GNSS device
+                                                  increased by at least the
+                                                  threshold since the last
+                                                  sample. */
+    U_GNSS_INFO_COMMS_EVENT_HOST_LOSS = 5,   /**< the number of bytes lost at
+                                                  the input to the ring buffer
+                                                  of this MCU (see
+                                                  uGnssMsgReceiveStatStreamLoss())
+                                                  increased by at least the
+                                                  threshold since the last
+                                                  sample, i.e. the GNSS device
+                                                  sent the data but this MCU
+                                                  did not keep up. */
+    U_GNSS_INFO_COMMS_EVENT_MAX_NUM
+} uGnssInfoCommsEvent_t;
+
+/** The thresholds at which uGnssInfoCommsCheck() reports an event;
+ * set a threshold to zero or less to ignore it.
+ */
+typedef struct uGnssInfoCommsThresholds_t {
+    int32_t txPercentageUsage;  /**< for #U_GNSS_INFO_COMMS_EVENT_TX_USAGE. */
+    int32_t rxPercentageUsage;  /**< for #U_GNSS_INFO_COMMS_EVENT_RX_USAGE. */
+    int32_t rxOverrunErrors;    /**< for #U_GNSS_INFO_COMMS_EVENT_RX_OVERRUN. */
+    int32_t rxSkippedBytes;     /**< for #U_GNSS_INFO_COMMS_EVENT_RX_SKIPPED. */
+    int32_t hostLossBytes;      /**< for #U_GNSS_INFO_COMMS_EVENT_HOST_LOSS. */
+} uGnssInfoCommsThresholds_t;
+
+/** A sample taken by the background UBX-MON-COMMS sampler, see
+ * uGnssInfoCommsSamplerStart().  The deltas are the change since
+ * the previous sample and are zero for the first sample; should a
+ * counter go backwards (e.g. because the GNSS device was restarted
+ * or the counter wrapped) the delta is the new value of the counter.
+ */
+typedef struct uGnssInfoCommsSample_t {
+    int32_t numSamples;               /**< the number of samples taken so
+                                           far, including this one. */
+    int32_t timeMs;                   /**< the local tick time at which this
+                                           sample was taken. */
+    uGnssCommunicationStats_t stats;  /**< the stats as read from the GNSS
+                                           device. */
+    size_t rxOverrunErrorsDelta;      /**< the change in stats.rxOverrunErrors. */
+    size_t rxSkippedBytesDelta;       /**< the change in stats.rxSkippedBytes. */
+    int32_t rxNumMessagesDelta[U_GNSS_PROTOCOL_MAX_NUM]; /**< the change in
+                                                              each of
+                                                              stats.rxNumMessages,
+                                                              -1 where not
+                                                              reported. */
+    size_t hostLossBytes;             /**< the total number of bytes lost at
+                                           the input to the ring buffer of this
+                                           MCU, as would be returned by
+                                           uGnssMsgReceiveStatStreamLoss(). */
+    size_t hostLossBytesDelta;        /**< the change in hostLossBytes. */
+} uGnssInfoCommsSample_t;
+
+/** The callback of uGnssInfoCommsSamplerStart(), called from the
+ * sampler task when a sample causes one or more events.
+ *
+ * @param gnssHandle      the handle of the GNSS instance.
+ * @param eventBitMap     a bit-map of the events that occurred,
+ *                        see #uGnssInfoCommsEvent_t, never zero.
+ * @param[in] pSample     the sample that caused the events; the
+ *                        contents are only valid for the duration of
+ *                        the callback.
+ * @param pCallbackParam  the pCallbackParam passed to
+ *                        uGnssInfoCommsSamplerStart().
+ */
+typedef void (*uGnssInfoCommsCallback_t)(uDeviceHandle_t gnssHandle,
+                                         uint32_t eventBitMap,
+                                         const uGnssInfoCommsSample_t *pSample,
+                                         void *pCallbackParam);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -186,6 +303,77 @@ int32_t uGnssInfoGetCommunicationStats(uDeviceHandle_t gnssHandle,
                                        int32_t port,
                                        uGnssCommunicationStats_t *pStats);
 
+/** Start sampling the communication stats of the GNSS chip (see
+ * uGnssInfoGetCommunicationStats()) in the background, in a task
+ * of its own, calling pCallback whenever a sample crosses one of
+ * the given thresholds.  Along with the stats as seen by the GNSS
+ * chip each sample includes the loss at the input to the ring
+ * buffer of this MCU, so that an overflow of the transmit buffer
+ * of the GNSS chip (the GNSS chip dropped the data,
+ * #U_GNSS_INFO_COMMS_EVENT_TX_OVERFLOW) can be told apart from a
+ * loss on this MCU (this MCU did not keep up,
+ * #U_GNSS_INFO_COMMS_EVENT_HOST_LOSS).  Supported only on M9 modules
+ * and beyond; only one sampler may be running per GNSS instance.
+ *
+ * The callback may call other functions of this API (e.g. to
+ * reduce a message rate) but must not call
+ * uGnssInfoCommsSamplerStop(); if it does call functions of this
+ * API then uGnssInfoCommsSamplerStop() should be called before
+ * the GNSS instance is removed.
+ *
+ * @param gnssHandle      the handle of the GNSS instance.
+ * @param port            the GNSS chip's port number, as for
+ *                        uGnssInfoGetCommunicationStats(); use -1
+ *                        for the current port.
+ * @param intervalMs      the sampling interval in milliseconds, at
+ *                        least #U_GNSS_INFO_COMMS_SAMPLER_INTERVAL_MIN_MS.
+ * @param[in] pThresholds the thresholds at which to call pCallback;
+ *                        a copy is taken.  Use NULL for
+ *                        #U_GNSS_INFO_COMMS_THRESHOLDS_DEFAULTS.
+ * @param pCallback       the callback, may be NULL if only
+ *                        uGnssInfoCommsSamplerGet() is to be used.
+ * @param pCallbackParam  a parameter that will be passed to pCallback.
+ * @return                zero on success, else negative error code.
+ */
+int32_t uGnssInfoCommsSamplerStart(uDeviceHandle_t gnssHandle,
+                                   int32_t port, int32_t intervalMs,
+                                   const uGnssInfoCommsThresholds_t *pThresholds,
+                                   uGnssInfoCommsCallback_t pCallback,
+                                   void *pCallbackParam);
+
+/** Get the latest sample taken by the background sampler.
+ *
+ * @param gnssHandle    the handle of the GNSS instance.
+ * @param[out] pSample  a place to put the sample, cannot be NULL.
+ * @return              zero on success, #U_ERROR_COMMON_EMPTY if
+ *                      no sample has yet been taken, else negative
+ *                      error code.
+ */
+int32_t uGnssInfoCommsSamplerGet(uDeviceHandle_t gnssHandle,
+                                 uGnssInfoCommsSample_t *pSample);
+
+/** Stop the background sampler; this is also done by
+ * uGnssDeinit() and uGnssRemove().  Must not be called from
+ * the callback of the sampler.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ */
+void uGnssInfoCommsSamplerStop(uDeviceHandle_t gnssHandle);
+
+/** Check a sample against a set of thresholds; this is what the
+ * background sampler uses to decide whether to call its callback,
+ * exposed here in case you want to apply different thresholds to
+ * samples obtained with uGnssInfoCommsSamplerGet().  Does not
+ * talk to the GNSS chip.
+ *
+ * @param[in] pSample     the sample, cannot be NULL.
+ * @param[in] pThresholds the thresholds, cannot be NULL.
+ * @return                a bit-map of the events that the sample
+ *                        represents, see #uGnssInfoCommsEvent_t.
+ */
+uint32_t uGnssInfoCommsCheck(const uGnssInfoCommsSample_t *pSample,
+                             const uGnssInfoCommsThresholds_t *pThresholds);
+
 
 
 #ifdef __cplusplus
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_LOG_H_
+#define _U_GNSS_LOG_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#include "u_device.h"
+#include "u_gnss_type.h"
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the message logging functions of
+ * the GNSS API, intended for capturing messages (e.g. UBX-RXM-RAWX and
+ * UBX-RXM-SFRBX for RTK post-processing) to a file or other sink.
+ *
+ * Messages are captured with the asynchronous message receive
+ * functions of u_gnss_msg.h, framed with a compact header and copied
+ * into a buffer; a task of its own then writes the buffer out in large
+ * chunks, so a slow file system never holds up the message receive
+ * task.  Should the buffer fill up, messages are dropped and counted,
+ * see uGnssLogGetLostCount().
+ *
+ * Each message in the log is preceded by a header of
+ * #U_GNSS_LOG_RECORD_HEADER_LENGTH_BYTES:
+ *
+ * - byte 0: #U_GNSS_LOG_RECORD_SYNC,
+ * - byte 1: the protocol of the message, a #uGnssProtocol_t,
+ * - bytes 2 and 3: the length of the message, little-endian,
+ * - bytes 4 to 7: the value of uPortGetTickTimeMs() when the message
+ *   was received, little-endian,
+ *
+ * followed by the whole message, header, checksum and all, exactly
+ * as it was received from the GNSS device.
+ *
+ * Logging does not switch any messages on: the application should
+ * configure the output of the messages it wishes to log, e.g. with
+ * uGnssCfgValSet().  A streaming transport (UART, I2C, SPI or
+ * virtual serial) is required.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_GNSS_LOG_BUFFER_LENGTH_BYTES
+/** The size of the buffer between the message receive task and the
+ * log task; it must be able to hold all of the messages logged in
+ * the time it takes to write #U_GNSS_LOG_WRITE_LENGTH_BYTES.
+ */
+# define U_GNSS_LOG_BUFFER_LENGTH_BYTES 8192
+#endif
+
+#ifndef U_GNSS_LOG_WRITE_LENGTH_BYTES
+/** The log task writes out data when this much has been logged,
+ * in chunks of up to this size.
+ */
+# define U_GNSS_LOG_WRITE_LENGTH_BYTES 4096
+#endif
+
+#ifndef U_GNSS_LOG_FLUSH_INTERVAL_MS
+/** Logged data is also written out when it has been waiting this
+ * long, so that a slow trickle of messages still makes it to the log.
+ */
+# define U_GNSS_LOG_FLUSH_INTERVAL_MS 1000
+#endif
+
+#ifndef U_GNSS_LOG_TASK_STACK_SIZE_BYTES
+/** The stack size of the log task; the write callback is
+ * called from this task.
+ */
+# define U_GNSS_LOG_TASK_STACK_SIZE_BYTES (1024 * 2)
+#endif
+
+#ifndef U_GNSS_LOG_FILE_SUPPORTED
+/** Set to 1 if the C library of the platform offers fopen()
+ * and friends, in which case uGnssLogStartFile() may be used.
+ */
+# if defined(_WIN32) || defined(__linux__) || \
+     (defined(__ZEPHYR__) && !defined(CONFIG_MINIMAL_LIBC))
+#  define U_GNSS_LOG_FILE_SUPPORTED 1
+# else
+#  define U_GNSS_LOG_FILE_SUPPORTED 0
+# endif
+#endif
+
+/** The length of the header in front of each message in the log.
+ */
+#define U_GNSS_LOG_RECORD_HEADER_LENGTH_BYTES 8
+
+/** The first byte of the header in front of each message in the log.
+ */
+#define U_GNSS_LOG_RECORD_SYNC 0xa5
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The function that writes logged data; it is called from the log
+ * task with up to #U_GNSS_LOG_WRITE_LENGTH_BYTES at a time.  When
+ * logging stops, once all logged data has been written, it is called
+ * one final time with pData NULL, e.g. to close a file.  It must not
+ * call into the GNSS API.
+ *
+ * @param gnssHandle          the handle of the GNSS instance.
+ * @param[in] pData           the data to write, NULL when logging
+ *                            has stopped.
+ * @param size                the number of bytes at pData.
+ * @param[in] pCallbackParam  the parameter that was passed to
+ *                            uGnssLogStart().
+ * @return                    the number of bytes written, else negative
+ *                            error code.
+ */
+typedef int32_t (*uGnssLogWriteCallback_t)(uDeviceHandle_t gnssHandle,
+                                           const char *pData, size_t size,
+                                           void *pCallbackParam);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Start logging the given messages to the given write function.
+ * Only one log may be running per GNSS instance.
+ *
+ * @param gnssHandle          the handle of the GNSS instance.
+ * @param[in] pMessageIdList  the messages to log, see uGnssMsgReceiveStart();
+ *                            a copy is taken so this may be on the stack,
+ *                            cannot be NULL.
+ * @param numMessageIds       the number of entries at pMessageIdList;
+ *                            each uses one of the
+ *                            #U_GNSS_MSG_RECEIVER_MAX_NUM asynchronous
+ *                            message receivers.
+ * @param[in] pCallback       the function that writes logged data,
+ *                            cannot be NULL.
+ * @param[in] pCallbackParam  will be passed to pCallback as its last
+ *                            parameter.
+ * @return                    zero on success else negative error code;
+ *                            #U_ERROR_COMMON_BUSY if a log is already
+ *                            running.
+ */
+int32_t uGnssLogStart(uDeviceHandle_t gnssHandle,
+                      const uGnssMessageId_t *pMessageIdList,
+                      size_t numMessageIds,
+                      uGnssLogWriteCallback_t pCallback,
+                      void *pCallbackParam);
+
+/** Start logging the given messages to a file, which is created,
+ * or truncated if it already exists; only available where
+ * #U_GNSS_LOG_FILE_SUPPORTED is 1.  The file is closed by
+ * uGnssLogStop().
+ *
+ * @param gnssHandle          the handle of the GNSS instance.
+ * @param[in] pMessageIdList  the messages to log, as for uGnssLogStart().
+ * @param numMessageIds       the number of entries at pMessageIdList.
+ * @param[in] pFileName       the file to log to, cannot be NULL.
+ * @return                    zero on success else negative error code.
+ */
+int32_t uGnssLogStartFile(uDeviceHandle_t gnssHandle,
+                          const uGnssMessageId_t *pMessageIdList,
+                          size_t numMessageIds,
+                          const char *pFileName);
+
+/** Get the number of messages that could not be logged because
+ * the buffer was full since logging was started.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @return            the number of messages lost, else negative
+ *                    error code.
+ */
+int32_t uGnssLogGetLostCount(uDeviceHandle_t gnssHandle);
+
+/** Stop logging: all logged data is written before this function
+ * returns, after which the write function is called with pData NULL.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ */
+void uGnssLogStop(uDeviceHandle_t gnssHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_LOG_H_
+
+// End of file
@@ -164,6 +164,66 @@ extern "C" {
  */
 #define U_GNSS_MGA_DBD_MESSAGE_PAYLOAD_LENGTH_MAX_BYTES 248
 
+#ifndef U_GNSS_MGA_SEND_WINDOW_DEFAULT
+/** The default number of messages that may be outstanding, i.e.
+ * sent but not yet acknowledged, when uGnssMgaCacheSend() is
+ * called with a window size of zero.
+ */
+# define U_GNSS_MGA_SEND_WINDOW_DEFAULT 8
+#endif
+
+#ifndef U_GNSS_MGA_SEND_WINDOW_MAX
+/** The maximum window size that may be passed to
+ * uGnssMgaCacheSend(); larger values are limited to this.
+ */
+# define U_GNSS_MGA_SEND_WINDOW_MAX 32
+#endif
+
+#ifndef U_GNSS_MGA_CACHE_ONLINE_VALIDITY_SECONDS
+/** How long AssistNow Online data held in a #uGnssMgaCache_t is
+ * considered to be valid for, counted from the time at which the
+ * AssistNow server generated it; ephemeris data is generally good
+ * for a few hours.
+ */
+# define U_GNSS_MGA_CACHE_ONLINE_VALIDITY_SECONDS (2 * 3600)
+#endif
+
+#ifndef U_GNSS_MGA_OFFLINE_FILTER_MESSAGE_MAX_LENGTH_BYTES
+/** The longest UBX message, including overhead, that
+ * #uGnssMgaOfflineFilter_t can hold; AssistNow Offline data consists
+ * of UBX-MGA-ANO messages (84 bytes) and almanac messages (less
+ * than 64 bytes), any longer message is discarded.
+ */
+# define U_GNSS_MGA_OFFLINE_FILTER_MESSAGE_MAX_LENGTH_BYTES 128
+#endif
+
+#ifndef U_GNSS_MGA_OFFLINE_STREAM_CHUNK_SIZE_BYTES
+/** The number of bytes that uGnssMgaOfflineStreamSend() asks for
+ * from its read callback at a time.
+ */
+# define U_GNSS_MGA_OFFLINE_STREAM_CHUNK_SIZE_BYTES 256
+#endif
+
+/** The four characters at the start of a navigation database
+ * in compact format, see uGnssMgaDatabaseCompact().
+ */
+#define U_GNSS_MGA_DATABASE_COMPACT_MAGIC "UMDB"
+
+/** The version of the compact navigation database format.
+ */
+#define U_GNSS_MGA_DATABASE_COMPACT_VERSION 1
+
+/** The length of the header of a navigation database in compact
+ * format: #U_GNSS_MGA_DATABASE_COMPACT_MAGIC, a version byte, a
+ * reserved byte and a two byte little-endian count of records.
+ */
+#define U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES 8
+
+/** The length of the checksum at the end of a navigation database
+ * in compact format.
+ */
+#define U_GNSS_MGA_DATABASE_COMPACT_CHECKSUM_LENGTH_BYTES 2
+
 #ifndef U_GNSS_MGA_ONLINE_REQUEST_DEFAULTS
 /** Default values for #uGnssMgaOnlineRequest_t.
  */
@@ -350,8 +410,9 @@ typedef struct {
                                        3 for one every 3 days. */
 } uGnssMgaOfflineRequest_t;
 
-/** Callback that will be called while uGnssMgaResponseSend() or
- * uGnssMgaSetDatabase() is running.  Do NOT call into the GNSS API from
+/** Callback that will be called while uGnssMgaResponseSend(),
+ * uGnssMgaCacheSend(), uGnssMgaSetDatabase() or
+ * uGnssMgaSetDatabaseWindowed() is running.  Do NOT call into the GNSS API from
  * this callback as the API will already be locked and you will get stuck.
  *
  * @param devHandle               the device handle.
@@ -362,8 +423,9 @@ typedef struct {
  * @param blocksSent              the number of data blocks successfully
  *                                sent to the GNSS device so far.
  * @param[in,out] pCallbackParam  the pCallbackParam pointer that
- *                                was passed to uGnssMgaResponseSend()
- *                                or uGnssMgaSetDatabase().
+ *                                was passed to uGnssMgaResponseSend(),
+ *                                uGnssMgaCacheSend(), uGnssMgaSetDatabase()
+ *                                or uGnssMgaSetDatabaseWindowed().
  * @return                        true to continue with the transfer,
  *                                false to terminate it.
  */
@@ -392,6 +454,91 @@ typedef bool (uGnssMgaDatabaseCallback_t) (uDeviceHandle_t devHandle,
                                            const char *pBuffer, size_t size,
                                            void *pCallbackParam);
 
+/** A cache of AssistNow data, populated by uGnssMgaCacheCreate();
+ * the data itself is NOT copied, it remains wherever the application
+ * stored it (e.g. in a file or in flash), this structure just records
+ * what it is and when it is valid.  Since it contains no pointers
+ * other than pBuffer the structure may be stored alongside the data
+ * provided pBuffer is set again when it is read back.
+ */
+typedef struct {
+    const char *pBuffer;  /**< the AssistNow data, as received from
+                               the AssistNow server. */
+    size_t size;          /**< the number of bytes at pBuffer. */
+    bool onlineNotOffline; /**< true if this is AssistNow Online data,
+                                false if it is AssistNow Offline data. */
+    size_t numMessages; /**< the number of UBX messages at pBuffer. */
+    int64_t validFromUtcMilliseconds; /**< the UTC time in milliseconds
+                                           from which the data is valid. */
+    int64_t validToUtcMilliseconds;   /**< the UTC time in milliseconds
+                                           at which the data stops being
+                                           valid. */
+} uGnssMgaCache_t;
+
+/** Callback that will be called by uGnssMgaOfflineFilterPush() with
+ * each complete UBX message of AssistNow Offline data that should be
+ * sent to the GNSS device.
+ *
+ * @param[in] pMessage            the UBX message, including header and
+ *                                checksum.
+ * @param length                  the number of bytes at pMessage.
+ * @param[in,out] pCallbackParam  the pCallbackParam pointer that was
+ *                                passed to uGnssMgaOfflineFilterPush().
+ * @return                        zero to continue, else a negative
+ *                                error code which will stop the filter
+ *                                and be returned by
+ *                                uGnssMgaOfflineFilterPush().
+ */
+typedef int32_t (uGnssMgaOfflineFilterCallback_t)(const char *pMessage,
+                                                  size_t length,
+                                                  void *pCallbackParam);
+
+/** Callback that will be called by uGnssMgaOfflineStreamSend() to
+ * obtain the next chunk of AssistNow Offline data, e.g. from a file
+ * or from an HTTP connection to the AssistNow server.  Do NOT call
+ * into the GNSS API from this callback as the API will already be
+ * locked and you will get stuck.
+ *
+ * @param devHandle               the device handle.
+ * @param[out] pBuffer            a place to put the data.
+ * @param size                    the number of bytes of storage at
+ *                                pBuffer.
+ * @param[in,out] pCallbackParam  the pReadCallbackParam pointer that
+ *                                was passed to
+ *                                uGnssMgaOfflineStreamSend().
+ * @return                        the number of bytes written to
+ *                                pBuffer, zero when there is no more
+ *                                data, else negative error code.
+ */
+typedef int32_t (uGnssMgaReadCallback_t)(uDeviceHandle_t devHandle,
+                                         char *pBuffer, size_t size,
+                                         void *pCallbackParam);
+
+/** Filter for AssistNow Offline data arriving in chunks: initialise
+ * it with uGnssMgaOfflineFilterInit() and pass the data to it with
+ * uGnssMgaOfflineFilterPush(); only one UBX message is held at a time
+ * so the data as a whole need never be in RAM.  The contents are
+ * of no interest to the application except for the counters.
+ */
+typedef struct {
+    int64_t todaySecondsUtc; /**< the start of the day being selected. */
+    size_t length;           /**< the number of bytes in buffer. */
+    size_t messageLength;    /**< the length of the message in buffer,
+                                  zero if not yet known. */
+    size_t numMessages;      /**< counter: the number of valid UBX
+                                  messages seen. */
+    size_t numSelected;      /**< counter: the number of UBX messages
+                                  passed to the callback. */
+    size_t numAno;           /**< counter: the number of UBX-MGA-ANO
+                                  messages seen. */
+    size_t numAnoSelected;   /**< counter: the number of UBX-MGA-ANO
+                                  messages passed to the callback. */
+    size_t numDiscarded;     /**< counter: the number of messages
+                                  discarded because they were too long
+                                  or their checksum was bad. */
+    char buffer[U_GNSS_MGA_OFFLINE_FILTER_MESSAGE_MAX_LENGTH_BYTES];
+} uGnssMgaOfflineFilter_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -630,6 +777,203 @@ int32_t uGnssMgaResponseSend(uDeviceHandle_t gnssHandle,
                              uGnssMgaProgressCallback_t *pCallback,
                              void *pCallbackParam);
 
+/** Populate a cache structure for AssistNow data received from a
+ * u-blox assistance server, working out its validity period: for
+ * AssistNow Online data this is from the time the server generated
+ * the data for #U_GNSS_MGA_CACHE_ONLINE_VALIDITY_SECONDS, for
+ * AssistNow Offline data it is from the start of the first day
+ * covered by the UBX-MGA-ANO messages to the end of the last day
+ * (if there are no UBX-MGA-ANO messages, e.g. the data is almanac
+ * only, the data is considered to be always valid).  This does
+ * not talk to the GNSS device; use uGnssMgaCacheIsValid() to check
+ * whether it is time to fetch new data and uGnssMgaCacheSend() to
+ * send the relevant parts of the data to a GNSS device.
+ *
+ * @param[in] pBuffer  the AssistNow data, i.e. the body of an HTTP
+ *                     GET response from a u-blox assistance server;
+ *                     this is NOT copied and so must remain valid
+ *                     for as long as pCache is in use.  Cannot be NULL.
+ * @param size         the number of bytes at pBuffer.
+ * @param[out] pCache  a place to put the cache; cannot be NULL.
+ * @return             the number of UBX messages in the cache, else
+ *                     negative error code, e.g. #U_ERROR_COMMON_BAD_DATA
+ *                     if pBuffer does not contain AssistNow data.
+ */
+int32_t uGnssMgaCacheCreate(const char *pBuffer, size_t size,
+                            uGnssMgaCache_t *pCache);
+
+/** Check whether a cache of AssistNow data is valid at a given time.
+ *
+ * @param[in] pCache            the cache, as populated by
+ *                              uGnssMgaCacheCreate(); cannot be NULL.
+ * @param timeUtcMilliseconds   the current UTC Unix time, NOT including
+ *                              leap seconds, in milliseconds.
+ * @return                      true if the cache holds data that is
+ *                              valid at timeUtcMilliseconds, else false.
+ */
+bool uGnssMgaCacheIsValid(const uGnssMgaCache_t *pCache,
+                          int64_t timeUtcMilliseconds);
+
+/** Send the relevant parts of a cache of AssistNow data to a GNSS
+ * device.  The GNSS device is first given the current time with a
+ * UBX-MGA-INI-TIME_UTC message, then, for AssistNow Offline data,
+ * only the UBX-MGA-ANO messages for the current day plus any almanac
+ * data are sent while, for AssistNow Online data, everything except
+ * the original UBX-MGA-INI-TIME_UTC message is sent.  Rather than
+ * waiting for the acknowledgement of each message before sending
+ * the next, up to windowSize messages, limited also to
+ * #U_GNSS_MGA_RX_BUFFER_SIZE_BYTES, may be outstanding at any one
+ * time, which makes the upload a great deal faster than
+ * uGnssMgaResponseSend() with #U_GNSS_MGA_FLOW_CONTROL_SIMPLE while
+ * retaining its reliability.
+ *
+ * This will only work with one of the streamed transports (for
+ * instance UART, I2C, SPI or Virtual Serial), it will NOT work with
+ * AT-command-based transport (#U_GNSS_TRANSPORT_AT) or if the GNSS
+ * device is connected via an intermediate module.
+ *
+ * Note: in order to speed up this process NMEA messages from the
+ * GNSS chip are temporarily disabled.  You can disable the disabling
+ * by defining the conditional compilation flag
+ * U_GNSS_MGA_DISABLE_NMEA_MESSAGE_DISABLE.
+ *
+ * @param gnssHandle                   the handle of the GNSS instance.
+ * @param[in] pCache                   the cache, as populated by
+ *                                     uGnssMgaCacheCreate(); cannot be
+ *                                     NULL.
+ * @param timeUtcMilliseconds          the current UTC Unix time, NOT
+ *                                     including leap seconds, in
+ *                                     milliseconds; must be known.
+ * @param timeUtcAccuracyMilliseconds  the accuracy of timeUtcMilliseconds
+ *                                     in milliseconds.
+ * @param windowSize                   the maximum number of messages
+ *                                     that may be awaiting an
+ *                                     acknowledgement at any one time;
+ *                                     use 0 for
+ *                                     #U_GNSS_MGA_SEND_WINDOW_DEFAULT,
+ *                                     1 for message-by-message flow
+ *                                     control.
+ * @param[in] pCallback                a function which will be called
+ *                                     as messages are acknowledged, exactly
+ *                                     as for uGnssMgaResponseSend(); may be
+ *                                     NULL.
+ * @param[in,out] pCallbackParam       parameter that will be passed to
+ *                                     pCallback as its last parameter.
+ * @return                             zero on success else negative error
+ *                                     code; #U_ERROR_COMMON_NOT_FOUND is
+ *                                     returned if the cache holds no data
+ *                                     valid at timeUtcMilliseconds.
+ */
+int32_t uGnssMgaCacheSend(uDeviceHandle_t gnssHandle,
+                          const uGnssMgaCache_t *pCache,
+                          int64_t timeUtcMilliseconds,
+                          int64_t timeUtcAccuracyMilliseconds,
+                          size_t windowSize,
+                          uGnssMgaProgressCallback_t *pCallback,
+                          void *pCallbackParam);
+
+/** Initialise a filter for AssistNow Offline data; this does not
+ * talk to the GNSS device.
+ *
+ * @param[out] pFilter         the filter; cannot be NULL.
+ * @param timeUtcMilliseconds  the current UTC Unix time, NOT including
+ *                             leap seconds, in milliseconds: only the
+ *                             UBX-MGA-ANO messages for this day will be
+ *                             selected.
+ * @return                     zero on success else negative error code.
+ */
+int32_t uGnssMgaOfflineFilterInit(uGnssMgaOfflineFilter_t *pFilter,
+                                  int64_t timeUtcMilliseconds);
+
+/** Pass a chunk of AssistNow Offline data, of any size, through a
+ * filter: pCallback is called with each complete UBX message that
+ * should be sent to the GNSS device, i.e. the UBX-MGA-ANO messages
+ * for the day given to uGnssMgaOfflineFilterInit() and any almanac
+ * data, exactly as uGnssMgaCacheSend() would select them.  Messages
+ * may span chunks.  Unlike mgaGetTodaysOfflineData(), which has the
+ * whole of the data to look at, no "best match" is made if there are
+ * no UBX-MGA-ANO messages for the day: check numAnoSelected in the
+ * filter once all of the data has been pushed.  This does not talk
+ * to the GNSS device.
+ *
+ * @param[in,out] pFilter         the filter, as initialised by
+ *                                uGnssMgaOfflineFilterInit(); cannot
+ *                                be NULL.
+ * @param[in] pData               the chunk of data; may be NULL only
+ *                                if size is zero.
+ * @param size                    the number of bytes at pData.
+ * @param[in] pCallback           the function to call with each message
+ *                                selected; cannot be NULL.
+ * @param[in,out] pCallbackParam  parameter that will be passed to
+ *                                pCallback as its last parameter.
+ * @return                        the number of messages passed to
+ *                                pCallback, else negative error code,
+ *                                which may be the one returned by
+ *                                pCallback.
+ */
+int32_t uGnssMgaOfflineFilterPush(uGnssMgaOfflineFilter_t *pFilter,
+                                  const char *pData, size_t size,
+                                  uGnssMgaOfflineFilterCallback_t *pCallback,
+                                  void *pCallbackParam);
+
+/** Send AssistNow Offline data to a GNSS device as it is read, e.g.
+ * from a file or from an HTTP connection to the AssistNow server,
+ * rather than from a buffer: this is the equivalent of
+ * uGnssMgaCacheSend() but the data is obtained through pReadCallback,
+ * #U_GNSS_MGA_OFFLINE_STREAM_CHUNK_SIZE_BYTES at a time, and passed
+ * through a #uGnssMgaOfflineFilter_t, so that AssistNow Offline data
+ * covering many weeks, which may be hundreds of kilobytes, can be
+ * used on a device with little RAM.  The GNSS device is first given
+ * the current time with a UBX-MGA-INI-TIME_UTC message, then only the
+ * UBX-MGA-ANO messages for the current day plus any almanac data are
+ * sent, windowed as described for uGnssMgaCacheSend().
+ *
+ * The same transport restrictions as for uGnssMgaCacheSend() apply
+ * and, likewise, NMEA messages are temporarily disabled unless
+ * U_GNSS_MGA_DISABLE_NMEA_MESSAGE_DISABLE is defined.
+ *
+ * @param gnssHandle                   the handle of the GNSS instance.
+ * @param[in] pReadCallback            the function that provides the
+ *                                     AssistNow Offline data; cannot be
+ *                                     NULL.
+ * @param[in,out] pReadCallbackParam   parameter that will be passed to
+ *                                     pReadCallback as its last parameter.
+ * @param timeUtcMilliseconds          the current UTC Unix time, NOT
+ *                                     including leap seconds, in
+ *                                     milliseconds; must be known.
+ * @param timeUtcAccuracyMilliseconds  the accuracy of timeUtcMilliseconds
+ *                                     in milliseconds.
+ * @param windowSize                   the maximum number of messages
+ *                                     that may be awaiting an
+ *                                     acknowledgement at any one time;
+ *                                     use 0 for
+ *                                     #U_GNSS_MGA_SEND_WINDOW_DEFAULT.
+ * @param[in] pCallback                a function which will be called
+ *                                     as messages are acknowledged,
+ *                                     as for uGnssMgaCacheSend() except
+ *                                     that, since the total is not known
+ *                                     in advance, blocksTotal is the
+ *                                     number of messages selected so far;
+ *                                     may be NULL.
+ * @param[in,out] pCallbackParam       parameter that will be passed to
+ *                                     pCallback as its last parameter.
+ * @return                             zero on success else negative error
+ *                                     code; #U_ERROR_COMMON_NOT_FOUND is
+ *                                     returned if the data contained
+ *                                     UBX-MGA-ANO messages but none for
+ *                                     the current day, in which case the
+ *                                     almanac data will still have been
+ *                                     sent.
+ */
+int32_t uGnssMgaOfflineStreamSend(uDeviceHandle_t gnssHandle,
+                                  uGnssMgaReadCallback_t *pReadCallback,
+                                  void *pReadCallbackParam,
+                                  int64_t timeUtcMilliseconds,
+                                  int64_t timeUtcAccuracyMilliseconds,
+                                  size_t windowSize,
+                                  uGnssMgaProgressCallback_t *pCallback,
+                                  void *pCallbackParam);
+
 /** Erase the flash memory attached to a GNSS chip in which the
  * assistance data is stored; normally there should be no reason
  * to use this since any new assistance data written to the GNSS
@@ -788,6 +1132,74 @@ int32_t uGnssMgaSetDatabase(uDeviceHandle_t gnssHandle,
                             uGnssMgaProgressCallback_t *pCallback,
                             void *pCallbackParam);
 
+/** Convert a navigation database, as retrieved with
+ * uGnssMgaGetDatabase(), into a compact format suitable for storing
+ * in flash.  The compact format is a header of
+ * #U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES, then each
+ * UBX-MGA-DBD payload preceded by a single length byte (rather
+ * than two), then a two byte Fletcher checksum (the same algorithm
+ * as used by the UBX protocol) over all that precedes it, so that
+ * a corrupted store can be detected before anything is sent to
+ * the GNSS device.  A database in compact format may be passed
+ * to uGnssMgaSetDatabaseWindowed().
+ *
+ * This function is designed such that the buffer size may be
+ * determined by calling it with pCompact set to NULL.
+ *
+ * @param[in] pBuffer     the database, as assembled from the chunks
+ *                        passed to the callback of uGnssMgaGetDatabase();
+ *                        cannot be NULL.
+ * @param size            the number of bytes at pBuffer.
+ * @param[out] pCompact   a place to put the compact database; may be
+ *                        NULL, in which case the number of bytes required
+ *                        is returned; must not overlap pBuffer.
+ * @param compactSize     the number of bytes of storage at pCompact.
+ * @return                the number of bytes of compact database, else
+ *                        negative error code; #U_ERROR_COMMON_BAD_DATA
+ *                        is returned if pBuffer does not contain a
+ *                        valid database.
+ */
+int32_t uGnssMgaDatabaseCompact(const char *pBuffer, size_t size,
+                                char *pCompact, size_t compactSize);
+
+/** Set (restore) the assistance database to a GNSS device using
+ * windowed flow control: rather than waiting for the acknowledgement
+ * of each UBX-MGA-DBD message up to windowSize messages, limited also
+ * to #U_GNSS_MGA_RX_BUFFER_SIZE_BYTES, may be outstanding at any one
+ * time, hence this is as reliable as #U_GNSS_MGA_FLOW_CONTROL_SIMPLE
+ * but very much faster, and faster also than
+ * #U_GNSS_MGA_FLOW_CONTROL_WAIT since there is no fixed delay between
+ * messages.  The database may be either as retrieved with
+ * uGnssMgaGetDatabase() or in the compact format produced by
+ * uGnssMgaDatabaseCompact(), the format being detected automatically;
+ * for the compact format the checksum is verified before anything
+ * is sent.
+ *
+ * The notes for uGnssMgaSetDatabase() concerning NMEA messages, NACKs
+ * and intermediate modules apply equally here.
+ *
+ * @param gnssHandle              the handle of the GNSS instance.
+ * @param windowSize              the maximum number of messages that
+ *                                may be awaiting an acknowledgement at
+ *                                any one time; use 0 for
+ *                                #U_GNSS_MGA_SEND_WINDOW_DEFAULT.
+ * @param[in] pBuffer             a pointer to the database; cannot be
+ *                                NULL.
+ * @param size                    the amount of data at pBuffer; must
+ *                                be greater than zero.
+ * @param[in] pCallback           a function which will be called as
+ *                                messages are acknowledged, exactly as
+ *                                for uGnssMgaSetDatabase(); may be NULL.
+ * @param[in,out] pCallbackParam  parameter that will be passed to pCallback
+ *                                as its last parameter.
+ * @return                        zero on success else negative error code.
+ */
+int32_t uGnssMgaSetDatabaseWindowed(uDeviceHandle_t gnssHandle,
+                                    size_t windowSize,
+                                    const char *pBuffer, size_t size,
+                                    uGnssMgaProgressCallback_t *pCallback,
+                                    void *pCallbackParam);
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,7 +46,8 @@ extern "C" {
  * streamed (e.g. over I2C or UART or SPI) from the GNSS chip.
  * Should be big enough to hold a few long messages from the device
  * while these are read asynchronously in task-space by the
- * application.
+ * application.  This is the default; the size may be changed
+ * for a given GNSS instance with uGnssSetRingBufferLength().
  */
 # define U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES 2048
 #endif
@@ -95,6 +96,17 @@ extern "C" {
 # define U_GNSS_MSG_RECEIVE_TASK_QUEUE_ITEM_SIZE_BYTES 1
 #endif
 
+#ifndef U_GNSS_MSG_RECEIVE_TASK_IDLE_TIME_MS
+/** When the task that runs the asynchronous message receive is
+ * event-driven, i.e. when it is woken by a data-received event
+ * from a UART/virtual serial port or by uGnssMsgReceiveWake(),
+ * this is the longest it will wait for such an event before
+ * checking the streaming source anyway, as a safety net against
+ * a lost event.
+ */
+# define U_GNSS_MSG_RECEIVE_TASK_IDLE_TIME_MS 1000
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -153,6 +165,63 @@ typedef void (*uGnssMsgReceiveCallback_t)(uDeviceHandle_t gnssHandle,
                                           int32_t errorCodeOrLength,
                                           void *pCallbackParam);
 
+/** A callback which will be called by uGnssMsgReceiveStartInPlace()
+ * when a matching message has been received from the GNSS chip.
+ * Rather than having to copy the message out with
+ * uGnssMsgReceiveCallbackRead(), the callback is given a read-only
+ * view of the message where it sits in the internal ring buffer:
+ * since the ring buffer may wrap part-way through the message it
+ * is passed as up to two segments, the message being the bytes at
+ * pData1 followed by the bytes at pData2.  The view is only valid
+ * until the callback returns, after which the data is released;
+ * the callback must not keep the pointers.  The same rules apply as
+ * for #uGnssMsgReceiveCallback_t: it should be executed as quickly
+ * as possible and may make no GNSS API calls other than those
+ * listed there.
+ *
+ * @param gnssHandle             the handle of the GNSS instance.
+ * @param[out] pMessageId        a pointer to the message ID that was
+ *                               detected.
+ * @param errorCodeOrLength      the size of the message, which will
+ *                               be size1 + size2, or #U_GNSS_ERROR_NACK,
+ *                               as for #uGnssMsgReceiveCallback_t, in
+ *                               which case there is no message data.
+ * @param[in] pData1             a pointer to the first segment of the
+ *                               message, NULL if there is no message data.
+ * @param size1                  the number of bytes at pData1.
+ * @param[in] pData2             a pointer to the second segment of the
+ *                               message, NULL if the message did not wrap.
+ * @param size2                  the number of bytes at pData2.
+ * @param[in,out] pCallbackParam the callback parameter that was originally
+ *                               given to uGnssMsgReceiveStartInPlace().
+ */
+typedef void (*uGnssMsgReceiveCallbackInPlace_t)(uDeviceHandle_t gnssHandle,
+                                                 const uGnssMessageId_t *pMessageId,
+                                                 int32_t errorCodeOrLength,
+                                                 const char *pData1, size_t size1,
+                                                 const char *pData2, size_t size2,
+                                                 void *pCallbackParam);
+
+/** A callback which will be called when the amount of data waiting
+ * in the ring buffer that holds messages streamed from the GNSS
+ * device rises to or above a threshold, see
+ * uGnssMsgReceiveSetFillCallback().  It is called from whichever
+ * task is reading data from the GNSS device at the time, so it
+ * should return quickly and should not call into the GNSS API.
+ *
+ * @param gnssHandle             the handle of the GNSS instance.
+ * @param fillBytes              the number of bytes waiting.
+ * @param capacityBytes          the maximum number of bytes that
+ *                               the ring buffer can hold.
+ * @param[in,out] pCallbackParam the callback parameter that was
+ *                               originally given to
+ *                               uGnssMsgReceiveSetFillCallback().
+ */
+typedef void (*uGnssMsgReceiveFillCallback_t)(uDeviceHandle_t gnssHandle,
+                                              size_t fillBytes,
+                                              size_t capacityBytes,
+                                              void *pCallbackParam);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: MISC
  * -------------------------------------------------------------- */
@@ -369,6 +438,38 @@ int32_t uGnssMsgReceiveStart(uDeviceHandle_t gnssHandle,
                              uGnssMsgReceiveCallback_t pCallback,
                              void *pCallbackParam);
 
+/** As uGnssMsgReceiveStart() but the callback is given the message
+ * in place, as a read-only view into the internal ring buffer,
+ * avoiding a copy; useful for high-rate messages such as UBX-RXM-RAWX.
+ * The handle returned may be passed to uGnssMsgReceiveStop() as
+ * normal and readers started with this function and with
+ * uGnssMsgReceiveStart() may be mixed.  Note that if a callback,
+ * called earlier, has extracted the message with
+ * uGnssMsgReceiveCallbackExtract(), the view will contain only what
+ * is left of it.
+ *
+ * IMPORTANT: this does not work for modules connected via an AT
+ * transport, please instead open a Virtual Serial connection for
+ * that case (see uCellMuxAddChannel()).
+ *
+ * @param gnssHandle             the handle of the GNSS instance.
+ * @param[in] pMessageId         a pointer to the message ID to capture;
+ *                               a copy will be taken so this may be
+ *                               on the stack; cannot be NULL.
+ * @param[in] pCallback          the callback to be called when a
+ *                               matching message arrives, see
+ *                               #uGnssMsgReceiveCallbackInPlace_t;
+ *                               cannot be NULL.
+ * @param[in] pCallbackParam     will be passed to pCallback as its last
+ *                               parameter.
+ * @return                       a handle for this asynchronous reader on
+ *                               success, else negative error code.
+ */
+int32_t uGnssMsgReceiveStartInPlace(uDeviceHandle_t gnssHandle,
+                                    const uGnssMessageId_t *pMessageId,
+                                    uGnssMsgReceiveCallbackInPlace_t pCallback,
+                                    void *pCallbackParam);
+
 /** To be called from the pCallback of uGnssMsgReceiveStart() to take
  * a peek at the message data from the internal ring buffer, copying it
  * into your buffer but NOT REMOVING IT from the internal ring buffer,
@@ -443,6 +544,41 @@ int32_t uGnssMsgReceiveStopAll(uDeviceHandle_t gnssHandle);
  */
 int32_t uGnssMsgReceiveStackMinFree(uDeviceHandle_t gnssHandle);
 
+/** Wake up the task that runs the asynchronous message receive so
+ * that it reads the streaming source immediately.
+ *
+ * Where the transport is UART or virtual serial, and the event
+ * callback of that transport is not already in use by the
+ * application, the asynchronous message receive task is woken by the
+ * data-received event of the transport and there is no need to call
+ * this function.  Where the transport is I2C or SPI there is no
+ * such event, so the task polls, every
+ * #U_GNSS_MSG_TASK_STACK_YIELD_TIME_MS or so.  To avoid that you
+ * may configure the TX-ready output of the GNSS device (see the
+ * CFG-TXREADY keys in u_gnss_cfg_val_key.h, i.e.
+ * #U_GNSS_CFG_VAL_KEY_ID_TXREADY_ENABLED_L,
+ * #U_GNSS_CFG_VAL_KEY_ID_TXREADY_POLARITY_L,
+ * #U_GNSS_CFG_VAL_KEY_ID_TXREADY_PIN_U1,
+ * #U_GNSS_CFG_VAL_KEY_ID_TXREADY_THRESHOLD_U2 and
+ * #U_GNSS_CFG_VAL_KEY_ID_TXREADY_INTERFACE_E1), wire it to a
+ * GPIO of this MCU and call this function from the handler of
+ * that GPIO; from the first call onwards the asynchronous message
+ * receive task will stop polling and instead wait to be woken,
+ * checking at least every #U_GNSS_MSG_RECEIVE_TASK_IDLE_TIME_MS,
+ * until uGnssMsgReceiveStopAll() is called.
+ *
+ * This function does not lock any mutex and so may be called from
+ * any task; if it is to be called from an interrupt then your
+ * platform must permit uPortSemaphoreGive() to be called from
+ * interrupt context.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @return            zero on success, else negative error code,
+ *                    e.g. if no asynchronous message receive is
+ *                    running.
+ */
+int32_t uGnssMsgReceiveWake(uDeviceHandle_t gnssHandle);
+
 /** Check if any message data bytes from a streaming source (for
  * example I2C or UART or SPI) have been lost to the non-blocking message
  * receive handler as a result of it not keeping up with the data flow
@@ -468,6 +604,40 @@ size_t uGnssMsgReceiveStatReadLoss(uDeviceHandle_t gnssHandle);
  */
 size_t uGnssMsgReceiveStatStreamLoss(uDeviceHandle_t gnssHandle);
 
+/** Get the largest amount of data that has been waiting to be read
+ * from the ring buffer that holds messages streamed from the GNSS
+ * device since it was created.  Only data waiting for an active
+ * reader, e.g. uGnssMsgReceiveStart() or a message exchange with
+ * the GNSS device, is counted.  If this approaches the size of the
+ * ring buffer (see uGnssGetRingBufferLength()) then data is being,
+ * or is about to be, lost and the ring buffer should be made larger
+ * with uGnssSetRingBufferLength().
+ *
+ * @param gnssHandle   the handle of the GNSS instance.
+ * @return             the high-water mark in bytes.
+ */
+size_t uGnssMsgReceiveStatHighWaterMark(uDeviceHandle_t gnssHandle);
+
+/** Set a callback to be called when the amount of data waiting to
+ * be read from the ring buffer that holds messages streamed from the
+ * GNSS device rises to or above a threshold; the callback is
+ * called once each time the threshold is crossed, it is not called
+ * again until the amount of data has fallen below the threshold.
+ *
+ * @param gnssHandle         the handle of the GNSS instance.
+ * @param thresholdPercent   the threshold as a percentage of the
+ *                           capacity of the ring buffer, 1 to 100.
+ * @param[in] pCallback      the callback, use NULL to remove an
+ *                           existing callback.
+ * @param[in] pCallbackParam will be passed to pCallback as its last
+ *                           parameter.
+ * @return                   zero on success else negative error code.
+ */
+int32_t uGnssMsgReceiveSetFillCallback(uDeviceHandle_t gnssHandle,
+                                       int32_t thresholdPercent,
+                                       uGnssMsgReceiveFillCallback_t pCallback,
+                                       void *pCallbackParam);
+
 #ifdef __cplusplus
 }
 #endif
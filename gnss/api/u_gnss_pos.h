@@ -46,6 +46,18 @@ extern "C" {
 # define U_GNSS_POS_TIMEOUT_SECONDS 240
 #endif
 
+#ifndef U_GNSS_POS_STREAMED_PVT_MAX_AGE_MS
+/** If the asynchronous message receive task is running (e.g.
+ * because uGnssPosGetStreamedStart() or uGnssMsgReceiveStart() has
+ * been called) and the GNSS device is streaming UBX-NAV-PVT
+ * messages, uGnssPosGet() will return the position from the latest
+ * of those, rather than polling the device for one, if it contains
+ * a fix and was received no more than this many milliseconds ago.
+ * Set this to zero to always poll.
+ */
+# define U_GNSS_POS_STREAMED_PVT_MAX_AGE_MS 1000
+#endif
+
 /** The default streamed position period in milliseconds.
  */
 #define U_GNSS_POS_STREAMED_PERIOD_DEFAULT_MS 1000
@@ -75,6 +87,42 @@ extern "C" {
  * TYPES
  * -------------------------------------------------------------- */
 
+/** Filter settings for uGnssPosGetStreamedStartFiltered(), evaluated
+ * inside this API so that the callback is only called for the
+ * positions that matter to the application.  Any field set to zero
+ * is ignored; a structure that is all zeroes therefore passes every
+ * position, just like uGnssPosGetStreamedStart().
+ *
+ * The first message received is always reported.  After that a
+ * message is reported if maxIntervalMs has passed since the last
+ * report; otherwise only every decimation'th message is considered
+ * and, if any of the thresholds are set, a considered message is
+ * reported only if the fix state (position fix or not) has changed
+ * since the last report or, for a position fix, if at least one of
+ * the thresholds has been reached when compared with the last
+ * reported position fix.
+ */
+typedef struct {
+    int32_t decimation;  /**< consider only every Nth message, e.g.
+                              10 would consider one message per second
+                              at a 10 Hz rate; 0 or 1 to consider every
+                              message. */
+    int32_t minDistanceMillimetres; /**< the minimum horizontal distance
+                                         from the last reported position. */
+    int32_t minSpeedChangeMillimetresPerSecond; /**< the minimum change in
+                                                     ground speed from the
+                                                     last reported position. */
+    int32_t minHeadingChangeX1e5; /**< the minimum change in heading of
+                                       motion from the last reported
+                                       position in hundred thousandths of
+                                       a degree, e.g. 1000000 for 10 degrees. */
+    int32_t maxIntervalMs; /**< if this much time has passed since the
+                                last report then the next message is
+                                reported regardless of the other settings;
+                                useful to confirm that the application
+                                is still receiving position. */
+} uGnssPosStreamedFilter_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS:  WORKAROUND FOR LINKER ISSUE
  * -------------------------------------------------------------- */
@@ -93,7 +141,10 @@ void uGnssPosPrivateLink(void);
 
 /** Get the current position, one-shot, returning on success or when
  * pKeepGoingCallback returns false; this will work with any
- * transport type.
+ * transport type.  If UBX-NAV-PVT messages are already being
+ * streamed by the GNSS device and received by this code (see
+ * #U_GNSS_POS_STREAMED_PVT_MAX_AGE_MS) no request need be sent to
+ * the GNSS device and this function will return immediately.
  *
  * @param gnssHandle                       the handle of the GNSS instance
  *                                         to use.
@@ -272,6 +323,38 @@ int32_t uGnssPosGetStreamedStart(uDeviceHandle_t gnssHandle,
                                                     int32_t svs,
                                                     int64_t timeUtc));
 
+/** As uGnssPosGetStreamedStart() but with filtering applied, so that
+ * the callback is called only for the positions that pass the filter
+ * (see #uGnssPosStreamedFilter_t).  This is useful where, for instance,
+ * positions are streamed at 10 Hz but the application only needs to
+ * be woken up when the device has moved or when a certain time has
+ * passed.  Stop with uGnssPosGetStreamedStop() as usual.
+ *
+ * @param gnssHandle       the handle of the GNSS instance to use.
+ * @param rateMs           the desired time between position fixes in
+ *                         milliseconds, see uGnssPosGetStreamedStart().
+ * @param[in] pFilter      the filter settings, copied by this function;
+ *                         may be NULL, in which case this function
+ *                         behaves exactly like uGnssPosGetStreamedStart().
+ * @param[in] pCallback    a callback that will be called when
+ *                         positions that pass the filter are obtained;
+ *                         see uGnssPosGetStreamedStart().
+ * @return                 zero on success or negative error code on
+ *                         failure.
+ */
+int32_t uGnssPosGetStreamedStartFiltered(uDeviceHandle_t gnssHandle,
+                                         int32_t rateMs,
+                                         const uGnssPosStreamedFilter_t *pFilter,
+                                         void (*pCallback) (uDeviceHandle_t gnssHandle,
+                                                            int32_t errorCode,
+                                                            int32_t latitudeX1e7,
+                                                            int32_t longitudeX1e7,
+                                                            int32_t altitudeMillimetres,
+                                                            int32_t radiusMillimetres,
+                                                            int32_t speedMillimetresPerSecond,
+                                                            int32_t svs,
+                                                            int64_t timeUtc));
+
 /** Cancel a uGnssPosGetStreamedStart(); after this function has returned
  * the callback passed to uGnssPosGetStreamedStart() will not be called
  * until another uGnssPosGetStreamedStart() is begun.
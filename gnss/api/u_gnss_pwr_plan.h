@@ -0,0 +1,294 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_PWR_PLAN_H_
+#define _U_GNSS_PWR_PLAN_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#include "u_device.h"
+#include "u_gnss_pwr.h"
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the GNSS power plan API: rather
+ * than setting the power-saving mode (uGnssPwrSetMode()), the timings
+ * (uGnssPwrSetTiming()), the power-saving flags (uGnssPwrSetFlag())
+ * and AssistNow Autonomous (uGnssMgaSetAutonomous()) individually,
+ * and deciding whether the MCU should be switching the GNSS device
+ * off between fixes, saving and restoring its navigation database
+ * (uGnssMgaGetDatabase() / uGnssMgaSetDatabase()) around the power
+ * cycle, the application gives the fix interval and accuracy it
+ * requires and uGnssPwrPlanSet() works out and applies a coordinated
+ * set of those settings.  uGnssPwrPlanCycle() is then called once per
+ * fix interval to obtain a fix and measure what it cost.
+ *
+ * Depending on the fix interval the plan will be one of:
+ *
+ * - cyclic tracking (#U_GNSS_PWR_PLAN_TYPE_CYCLIC_TRACKING), for
+ *   fix intervals shorter than
+ *   #U_GNSS_PWR_PLAN_CYCLIC_TRACKING_MAX_INTERVAL_SECONDS: the GNSS
+ *   device stays tracking but power-optimised,
+ * - on/off (#U_GNSS_PWR_PLAN_TYPE_ON_OFF), for fix intervals shorter
+ *   than #U_GNSS_PWR_PLAN_ON_OFF_MAX_INTERVAL_SECONDS: the GNSS device
+ *   switches itself off between fixes, AssistNow Autonomous keeping
+ *   its orbit predictions fresh so that each wake-up is a hot start,
+ * - host-controlled, for longer fix intervals: uGnssPwrPlanCycle()
+ *   powers the GNSS device on, waits for the fix and then puts it into
+ *   back-up mode with uGnssPwrOffBackup()
+ *   (#U_GNSS_PWR_PLAN_TYPE_HOST_BACKUP) or, where back-up mode is not
+ *   possible (e.g. the GNSS device is on I2C, from which it cannot be
+ *   woken, or is connected via an intermediate module), powers it off
+ *   with uGnssPwrOff() (#U_GNSS_PWR_PLAN_TYPE_HOST_OFF), in which case
+ *   the navigation database is read out before power-off and written
+ *   back after power-on, where the transport permits.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_GNSS_PWR_PLAN_CYCLIC_TRACKING_MAX_INTERVAL_SECONDS
+/** Fix intervals shorter than this use cyclic tracking.
+ */
+# define U_GNSS_PWR_PLAN_CYCLIC_TRACKING_MAX_INTERVAL_SECONDS 10
+#endif
+
+#ifndef U_GNSS_PWR_PLAN_ON_OFF_MAX_INTERVAL_SECONDS
+/** Fix intervals shorter than this, and not shorter than
+ * #U_GNSS_PWR_PLAN_CYCLIC_TRACKING_MAX_INTERVAL_SECONDS, use on/off
+ * power-saving managed by the GNSS device itself; longer fix
+ * intervals are host-controlled.
+ */
+# define U_GNSS_PWR_PLAN_ON_OFF_MAX_INTERVAL_SECONDS 1800
+#endif
+
+#ifndef U_GNSS_PWR_PLAN_HIGH_ACCURACY_MILLIMETRES
+/** An accuracy target tighter than this is considered "high
+ * accuracy": power-optimised cyclic tracking is not used and, in
+ * on/off operation, the GNSS device stays on for
+ * #U_GNSS_PWR_PLAN_HIGH_ACCURACY_ON_TIME_SECONDS after a fix.
+ */
+# define U_GNSS_PWR_PLAN_HIGH_ACCURACY_MILLIMETRES 5000
+#endif
+
+#ifndef U_GNSS_PWR_PLAN_HIGH_ACCURACY_ON_TIME_SECONDS
+/** The time the GNSS device stays on after a fix in on/off operation
+ * when the accuracy target is tighter than
+ * #U_GNSS_PWR_PLAN_HIGH_ACCURACY_MILLIMETRES.
+ */
+# define U_GNSS_PWR_PLAN_HIGH_ACCURACY_ON_TIME_SECONDS 10
+#endif
+
+#ifndef U_GNSS_PWR_PLAN_MAX_TIME_TO_FIX_SECONDS
+/** The longest the GNSS device is allowed to try to obtain a fix of
+ * the required accuracy in a cycle; for on/off operation this is
+ * also limited to half of the fix interval and to 255 seconds.
+ */
+# define U_GNSS_PWR_PLAN_MAX_TIME_TO_FIX_SECONDS 60
+#endif
+
+#ifndef U_GNSS_PWR_PLAN_ON_CURRENT_MILLIAMPS
+/** The typical current drawn by the GNSS device while it is on, used
+ * to turn the on-time of a cycle into
+ * uGnssPwrPlanCycle_t.chargeMicroampHours; set this to the figure
+ * from the data sheet of the GNSS device in your product.
+ */
+# define U_GNSS_PWR_PLAN_ON_CURRENT_MILLIAMPS 25
+#endif
+
+#ifndef U_GNSS_PWR_PLAN_DATABASE_MAX_LENGTH_BYTES
+/** The maximum size of the navigation database saved between cycles
+ * of a #U_GNSS_PWR_PLAN_TYPE_HOST_OFF plan; the storage is allocated
+ * at the first save and freed by uGnssPwrPlanClear().
+ */
+# define U_GNSS_PWR_PLAN_DATABASE_MAX_LENGTH_BYTES (1024 * 8)
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The type of power plan, see the description at the top of
+ * this file.
+ */
+typedef enum {
+    U_GNSS_PWR_PLAN_TYPE_CYCLIC_TRACKING,
+    U_GNSS_PWR_PLAN_TYPE_ON_OFF,
+    U_GNSS_PWR_PLAN_TYPE_HOST_BACKUP,
+    U_GNSS_PWR_PLAN_TYPE_HOST_OFF,
+    U_GNSS_PWR_PLAN_TYPE_MAX_NUM
+} uGnssPwrPlanType_t;
+
+/** The outcome of one cycle of a power plan, see uGnssPwrPlanCycle().
+ */
+typedef struct {
+    int32_t timeToFixMs;       /**< the time from the start of the cycle
+                                    (for host-controlled plans, the
+                                    GNSS device being powered on) to a fix
+                                    of the required accuracy, -1 if there
+                                    was none. */
+    int32_t onTimeMs;          /**< the energy proxy: the time for which the
+                                    GNSS device was powered during the
+                                    cycle, including any database restore
+                                    and save; -1 where the GNSS device
+                                    manages its own power and so this is not
+                                    known to the MCU. */
+    int32_t chargeMicroampHours; /**< onTimeMs multiplied by
+                                      #U_GNSS_PWR_PLAN_ON_CURRENT_MILLIAMPS,
+                                      -1 if onTimeMs is not known. */
+    int32_t latitudeX1e7;      /**< the latitude of the fix. */
+    int32_t longitudeX1e7;     /**< the longitude of the fix. */
+    int32_t radiusMillimetres; /**< the accuracy of the fix. */
+    int64_t timeUtc;           /**< the UTC time of the fix. */
+} uGnssPwrPlanCycle_t;
+
+/** A power plan, populated by uGnssPwrPlanCalculate() or
+ * uGnssPwrPlanSet(); the application may read any of it but
+ * should not write to it.
+ */
+typedef struct {
+    uGnssPwrPlanType_t type;
+    int32_t fixIntervalSeconds;
+    int32_t accuracyMillimetres;
+    uGnssPwrSavingMode_t mode; /**< the power-saving mode applied with
+                                    uGnssPwrSetMode(). */
+    int32_t acquisitionPeriodSeconds;      /**< as passed to uGnssPwrSetTiming(). */
+    int32_t acquisitionRetryPeriodSeconds; /**< as passed to uGnssPwrSetTiming(). */
+    int32_t onTimeSeconds;                 /**< as passed to uGnssPwrSetTiming(). */
+    int32_t maxAcquisitionTimeSeconds;     /**< as passed to uGnssPwrSetTiming(). */
+    int32_t minAcquisitionTimeSeconds;     /**< as passed to uGnssPwrSetTiming(). */
+    uint32_t flagsSet;   /**< the #uGnssPwrFlag_t bits set. */
+    uint32_t flagsClear; /**< the #uGnssPwrFlag_t bits cleared. */
+    bool assistNowAutonomous; /**< whether AssistNow Autonomous is on;
+                                   if the GNSS device does not support
+                                   it uGnssPwrPlanSet() sets this to
+                                   false. */
+    bool databaseSaveRestore; /**< whether the navigation database is
+                                   saved and restored across power-off. */
+    int32_t maxTimeToFixSeconds; /**< how long a cycle waits for a fix. */
+    size_t numCycles;            /**< the number of calls to
+                                      uGnssPwrPlanCycle(). */
+    size_t numFixes;             /**< the number of those that obtained
+                                      a fix of the required accuracy. */
+    int64_t totalOnTimeMs;       /**< the sum of onTimeMs for all cycles
+                                      where it is known. */
+    char *pDatabase;             /**< the saved navigation database. */
+    size_t databaseLength;       /**< the number of bytes at pDatabase. */
+} uGnssPwrPlan_t;
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Work out a power plan without talking to any GNSS device; this is
+ * what uGnssPwrPlanSet() uses, it is exposed so that an application
+ * can see what would be done.
+ *
+ * @param fixIntervalSeconds   the required interval between fixes in
+ *                             seconds; must be greater than zero.
+ * @param accuracyMillimetres  the required accuracy of each fix
+ *                             (the radiusMillimetres of uGnssPosGet());
+ *                             must be greater than zero.
+ * @param backupPossible       true if the GNSS device can be put into
+ *                             back-up mode and woken again by the MCU.
+ * @param databasePossible     true if the navigation database of the
+ *                             GNSS device can be read and written.
+ * @param[out] pPlan           a place to put the plan; cannot be NULL.
+ *                             The contents are overwritten, hence
+ *                             a plan that has been used must be passed
+ *                             to uGnssPwrPlanClear() first.
+ * @return                     zero on success else negative error code.
+ */
+int32_t uGnssPwrPlanCalculate(int32_t fixIntervalSeconds,
+                              int32_t accuracyMillimetres,
+                              bool backupPossible,
+                              bool databasePossible,
+                              uGnssPwrPlan_t *pPlan);
+
+/** Work out and apply a power plan to a GNSS device, which must
+ * be powered on.  If this returns an error the GNSS device may be
+ * partially configured.
+ *
+ * @param gnssHandle           the handle of the GNSS instance.
+ * @param fixIntervalSeconds   the required interval between fixes in
+ *                             seconds; must be greater than zero.
+ * @param accuracyMillimetres  the required accuracy of each fix; must
+ *                             be greater than zero.
+ * @param[out] pPlan           a place to put the plan, which must be
+ *                             passed to uGnssPwrPlanCycle() and, when
+ *                             done, to uGnssPwrPlanClear(); cannot be
+ *                             NULL.  The contents are overwritten, as
+ *                             for uGnssPwrPlanCalculate().
+ * @return                     zero on success else negative error code.
+ */
+int32_t uGnssPwrPlanSet(uDeviceHandle_t gnssHandle,
+                        int32_t fixIntervalSeconds,
+                        int32_t accuracyMillimetres,
+                        uGnssPwrPlan_t *pPlan);
+
+/** Perform one cycle of a power plan: call this once per fix interval.
+ * For host-controlled plans the GNSS device is powered on (and its
+ * navigation database restored, if one was saved), a fix of the
+ * required accuracy is waited for and then the GNSS device is put into
+ * back-up mode or (after saving its navigation database) powered off;
+ * where the GNSS device manages its own power this just waits for a fix
+ * of the required accuracy.  The GNSS device is never waited for longer
+ * than maxTimeToFixSeconds of the plan.
+ *
+ * @param gnssHandle          the handle of the GNSS instance.
+ * @param[in,out] pPlan       the plan, as populated by uGnssPwrPlanSet();
+ *                            cannot be NULL.
+ * @param[out] pCycle         a place to put the outcome of the cycle;
+ *                            may be NULL.
+ * @param[in] pKeepGoingCallback a function that will be called while
+ *                            waiting for a fix: return false to give
+ *                            up early; may be NULL.
+ * @return                    zero if a fix of the required accuracy
+ *                            was obtained, else negative error code,
+ *                            e.g. #U_ERROR_COMMON_TIMEOUT.
+ */
+int32_t uGnssPwrPlanCycle(uDeviceHandle_t gnssHandle,
+                          uGnssPwrPlan_t *pPlan,
+                          uGnssPwrPlanCycle_t *pCycle,
+                          bool (*pKeepGoingCallback) (uDeviceHandle_t));
+
+/** Free any memory held by a power plan (i.e. a saved navigation
+ * database); this does not talk to the GNSS device.
+ *
+ * @param[in] pPlan the plan; may be NULL.
+ */
+void uGnssPwrPlanClear(uGnssPwrPlan_t *pPlan);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_PWR_PLAN_H_
+
+// End of file
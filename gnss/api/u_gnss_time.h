@@ -0,0 +1,173 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_GNSS_TIME_H_
+#define _U_GNSS_TIME_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#include "u_device.h"
+
+/** \addtogroup _GNSS
+ *  @{
+ */
+
+/** @file
+ * @brief This header file defines the time pulse functions of the
+ * GNSS API, intended for applications that discipline a local clock
+ * from GNSS.
+ *
+ * The time obtained by parsing position or time messages is subject
+ * to the latency of the transport and of message parsing, tens of
+ * milliseconds of jitter.  The TIMEPULSE output of a GNSS device has
+ * an edge that is aligned with the top of a second to within tens of
+ * nanoseconds; if that edge is wired to a GPIO of this MCU, and the
+ * application calls uGnssTimePulseNotify() from the interrupt handler
+ * of that GPIO, the pulse can be paired with the UBX-TIM-TP message
+ * which the GNSS device emits ahead of each pulse, giving the time
+ * of the pulse together with the local tick time at which it occurred.
+ *
+ * The uPortGpio API has no interrupt support, hence the application
+ * must set up the GPIO interrupt itself.  The resolution of the local
+ * side is that of uPortGetTickTimeMs(), i.e. one millisecond; the jitter
+ * is only that of the interrupt latency of this MCU.
+ *
+ * A streaming transport (UART, I2C, SPI or virtual serial) is required.
+ * The time pulse itself is configured with the CFG-TP keys
+ * (see u_gnss_cfg_val_key.h), by default one pulse per second  on
+ * TIMEPULSE, aligned to UTC.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_GNSS_TIME_PULSE_MESSAGE_MAX_AGE_MS
+/** A UBX-TIM-TP message is only paired with a time pulse that
+ * occurs within this many milliseconds of the message arriving;
+ * should be a little longer than the period of the time pulse.
+ */
+# define U_GNSS_TIME_PULSE_MESSAGE_MAX_AGE_MS 1500
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A time pulse, paired with the local tick time at which it was
+ * notified.
+ */
+typedef struct {
+    int64_t timeNanoseconds; /**< the time of the pulse in nanoseconds
+                                  since midnight on 1st January 1970;
+                                  if utc is false this is GNSS time,
+                                  which does not include leap seconds. */
+    bool utc;                /**< true if timeNanoseconds is UTC, i.e.
+                                  the time pulse is aligned to UTC,
+                                  else false. */
+    int32_t quantisationErrorPicoseconds; /**< the quantisation error of
+                                               the pulse as reported by
+                                               the GNSS device. */
+    int32_t tickTimeMs;      /**< the value of uPortGetTickTimeMs() when
+                                  uGnssTimePulseNotify() was called. */
+    int32_t count;           /**< the number of pulses that have been
+                                  paired since uGnssTimePulseStart(). */
+} uGnssTimePulse_t;
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Start monitoring the time pulse: this switches on the output of
+ * the UBX-TIM-TP message, once per navigation solution, and sets up
+ * an asynchronous message receiver for it.  Thereafter the
+ * application must call uGnssTimePulseNotify() on every active edge
+ * of the TIMEPULSE output.  If a time pulse is already being
+ * monitored this function does nothing and returns success.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @return            zero on success else negative error code.
+ */
+int32_t uGnssTimePulseStart(uDeviceHandle_t gnssHandle);
+
+/** To be called by the application on every active edge of the
+ * TIMEPULSE output, e.g. from the GPIO interrupt handler: records
+ * the local tick time and pairs it with the UBX-TIM-TP message
+ * that preceded it.  This function does not lock any mutex, does
+ * not allocate memory and does not block, it is suitable for
+ * interrupt context.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ * @return            zero on success, else negative error
+ *                    code, e.g. #U_ERROR_COMMON_NOT_FOUND if there
+ *                    was no recent UBX-TIM-TP message to pair the
+ *                    pulse with.
+ */
+int32_t uGnssTimePulseNotify(uDeviceHandle_t gnssHandle);
+
+/** Get the most recent time pulse that was paired with a UBX-TIM-TP
+ * message.
+ *
+ * @param gnssHandle       the handle of the GNSS instance.
+ * @param[out] pTimePulse  a place to put the time pulse; cannot be NULL.
+ * @return                 zero on success, else negative error code,
+ *                         e.g. #U_ERROR_COMMON_NOT_FOUND if no time
+ *                         pulse has yet been paired.
+ */
+int32_t uGnssTimePulseGet(uDeviceHandle_t gnssHandle,
+                          uGnssTimePulse_t *pTimePulse);
+
+/** Get the current time: the time of the last paired time pulse plus
+ * the local tick time that has elapsed since it occurred.  The error
+ * is that of the tick time of this MCU, hence the time pulse should
+ * be recent: check the return value.
+ *
+ * @param gnssHandle             the handle of the GNSS instance.
+ * @param[out] pTimeNanoseconds  a place to put the time, nanoseconds
+ *                               since midnight on 1st January 1970, UTC
+ *                               or GNSS time as indicated by the utc
+ *                               field of uGnssTimePulse_t; cannot be NULL.
+ * @return                       on success the number of milliseconds
+ *                               since the last paired time pulse, else
+ *                               negative error code.
+ */
+int32_t uGnssTimeGetNow(uDeviceHandle_t gnssHandle,
+                        int64_t *pTimeNanoseconds);
+
+/** Stop monitoring the time pulse, restoring the previous output
+ * rate of the UBX-TIM-TP message.  The application must make sure
+ * that it no longer calls uGnssTimePulseNotify() before calling this.
+ *
+ * @param gnssHandle  the handle of the GNSS instance.
+ */
+void uGnssTimePulseStop(uDeviceHandle_t gnssHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_GNSS_TIME_H_
+
+// End of file
@@ -140,6 +140,41 @@ static void addGnssInstance(uGnssPrivateInstance_t *pInstance)
     gpUGnssPrivateInstanceList = pInstance;
 }
 
+// Create the ring buffer of a GNSS instance and reserve the two
+// read handles that this code needs from it.
+static int32_t ringBufferCreate(uRingBuffer_t *pRingBuffer,
+                                char *pLinearBuffer, size_t size,
+                                int32_t *pReadHandlePrivate,
+                                int32_t *pReadHandleMsgReceive)
+{
+    int32_t errorCode;
+
+    // +2 below to keep one for ourselves and one for the
+    // blocking transparent receive function
+    errorCode = uRingBufferCreateWithReadHandle(pRingBuffer, pLinearBuffer, size,
+                                                U_GNSS_MSG_RECEIVER_MAX_NUM + 2);
+    if (errorCode == 0) {
+        // No sneaky uRingBufferRead()'s allowed
+        uRingBufferSetReadRequiresHandle(pRingBuffer, true);
+        // Reserve a handle for us
+        errorCode = uRingBufferTakeReadHandle(pRingBuffer);
+        if (errorCode >= 0) {
+            *pReadHandlePrivate = errorCode;
+            // ...and one for uGnssMsgReceive()
+            errorCode = uRingBufferTakeReadHandle(pRingBuffer);
+            if (errorCode >= 0) {
+                *pReadHandleMsgReceive = errorCode;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+        if (errorCode < 0) {
+            uRingBufferDelete(pRingBuffer);
+        }
+    }
+
+    return errorCode;
+}
+
 // Remove a GNSS instance from the list.
 // gUGnssPrivateMutex should be locked before this is called.
 static void deleteGnssInstance(uGnssPrivateInstance_t *pInstance)
@@ -154,6 +189,14 @@ static void deleteGnssInstance(uGnssPrivateInstance_t *pInstance)
             uGnssPrivateCleanUpPosTask(pInstance);
             // Stop and clean up streamed position
             uGnssPrivateCleanUpStreamedPos(pInstance);
+            // Stop and clean up the time pulse
+            uGnssPrivateCleanUpTimePulse(pInstance);
+            // Flush and stop any message logging
+            uGnssPrivateCleanUpLog(pInstance);
+            // Stop any MON-COMMS sampling
+            uGnssPrivateCleanUpCommsSampler(pInstance);
+            // Free any correction forwarding
+            uGnssPrivateCleanUpCorrection(pInstance);
             // Stop asynchronus message receive from happening
             uGnssPrivateStopMsgReceive(pInstance);
             // Free the SPI buffer, if there is one
@@ -172,6 +215,7 @@ static void deleteGnssInstance(uGnssPrivateInstance_t *pInstance)
             // Delete the transport mutex
             uPortMutexDelete(pInstance->transportMutex);
             // Deallocate the uDevice instance
+            U_DEVICE_INSTANCE(pInstance->gnssHandle)->pPrivateInstance = NULL;
             uDeviceDestroyInstance(U_DEVICE_INSTANCE(pInstance->gnssHandle));
             // Unlink the instance from the list
             if (pPrev != NULL) {
@@ -285,6 +329,9 @@ int32_t uGnssAdd(uGnssModuleType_t moduleType,
             // Check parameters
             errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
             if (((size_t) moduleType < gUGnssPrivateModuleListSize) &&
+#ifdef U_CFG_GNSS_MODULE_ONLY
+                (moduleType == U_GNSS_PRIVATE_MODULE_TYPE_ONLY) &&
+#endif
                 ((transportType > U_GNSS_TRANSPORT_NONE) &&
                  (transportType < U_GNSS_TRANSPORT_MAX_NUM)) &&
                 ((transportType == U_GNSS_TRANSPORT_I2C) ||
@@ -305,6 +352,7 @@ int32_t uGnssAdd(uGnssModuleType_t moduleType,
                         pInstance->transportType = transportType;
                         pInstance->ringBufferReadHandlePrivate = -1;
                         pInstance->ringBufferReadHandleMsgReceive = -1;
+                        pInstance->ringBufferLengthBytes = U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES;
                         pInstance->pModule = &(gUGnssPrivateModuleList[moduleType]);
                         pInstance->transportHandle = transportHandle;
                         pInstance->i2cAddress = U_GNSS_I2C_ADDRESS;
@@ -380,50 +428,31 @@ int32_t uGnssAdd(uGnssModuleType_t moduleType,
                             // Provided we're not on AT transport, i.e. we're on
                             // a streaming transport, then set up the buffer into
                             // which we stream messages received from the module
-                            pInstance->pLinearBuffer = (char *) pUPortMalloc(U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES);
+                            pInstance->pLinearBuffer = (char *) pUPortMalloc(pInstance->ringBufferLengthBytes);
                             if (pInstance->pLinearBuffer != NULL) {
                                 // Also need a temporary buffer to get stuff out
                                 // of the UART/I2C/SPI in the first place
                                 pInstance->pTemporaryBuffer = (char *) pUPortMalloc(U_GNSS_MSG_TEMPORARY_BUFFER_LENGTH_BYTES);
                                 if (pInstance->pTemporaryBuffer != NULL) {
-                                    // +2 below to keep one for ourselves and one for the
-                                    // blocking transparent receive function
-                                    errorCode = uRingBufferCreateWithReadHandle(&(pInstance->ringBuffer),
-                                                                                pInstance->pLinearBuffer,
-                                                                                U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES,
-                                                                                U_GNSS_MSG_RECEIVER_MAX_NUM + 2);
-                                    if (errorCode == 0) {
-                                        // No sneaky uRingBufferRead()'s allowed
-                                        uRingBufferSetReadRequiresHandle(&(pInstance->ringBuffer), true);
-                                        // Reserve a handle for us
-                                        errorCode = uRingBufferTakeReadHandle(&(pInstance->ringBuffer));
-                                        if (errorCode >= 0) {
-                                            pInstance->ringBufferReadHandlePrivate = errorCode;
-                                            // ...and one for uGnssMsgReceive()
-                                            errorCode = uRingBufferTakeReadHandle(&(pInstance->ringBuffer));
-                                            if (errorCode >= 0) {
-                                                pInstance->ringBufferReadHandleMsgReceive = errorCode;
-                                                if (pInstance->transportType == U_GNSS_TRANSPORT_SPI) {
-                                                    // Finally, if we are on SPI, we need a local receive
-                                                    // buffer to keep stuff that we receive while we are
-                                                    // just sending
-                                                    // +1 below since we lose one byte in the ring buffer implementation
-                                                    pInstance->pSpiLinearBuffer = (char *) pUPortMalloc(U_GNSS_SPI_BUFFER_LENGTH_BYTES + 1);
-                                                    if (pInstance->pSpiLinearBuffer != NULL) {
-                                                        pInstance->pSpiRingBuffer = (uRingBuffer_t *) pUPortMalloc(sizeof(uRingBuffer_t));
-                                                        if (pInstance->pSpiRingBuffer != NULL) {
-                                                            errorCode = uRingBufferCreate(pInstance->pSpiRingBuffer,
-                                                                                          pInstance->pSpiLinearBuffer,
-                                                                                          U_GNSS_SPI_BUFFER_LENGTH_BYTES + 1);
-                                                        }
-                                                    } else {
-                                                        uRingBufferDelete(&(pInstance->ringBuffer));
-                                                    }
-                                                } else {
-                                                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                                                }
-                                            } else {
-                                                uRingBufferDelete(&(pInstance->ringBuffer));
+                                    errorCode = ringBufferCreate(&(pInstance->ringBuffer),
+                                                                 pInstance->pLinearBuffer,
+                                                                 pInstance->ringBufferLengthBytes,
+                                                                 &(pInstance->ringBufferReadHandlePrivate),
+                                                                 &(pInstance->ringBufferReadHandleMsgReceive));
+                                    if ((errorCode == 0) &&
+                                        (pInstance->transportType == U_GNSS_TRANSPORT_SPI)) {
+                                        // Finally, if we are on SPI, we need a local receive
+                                        // buffer to keep stuff that we receive while we are
+                                        // just sending
+                                        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                                        // +1 below since we lose one byte in the ring buffer implementation
+                                        pInstance->pSpiLinearBuffer = (char *) pUPortMalloc(U_GNSS_SPI_BUFFER_LENGTH_BYTES + 1);
+                                        if (pInstance->pSpiLinearBuffer != NULL) {
+                                            pInstance->pSpiRingBuffer = (uRingBuffer_t *) pUPortMalloc(sizeof(uRingBuffer_t));
+                                            if (pInstance->pSpiRingBuffer != NULL) {
+                                                errorCode = uRingBufferCreate(pInstance->pSpiRingBuffer,
+                                                                              pInstance->pSpiLinearBuffer,
+                                                                              U_GNSS_SPI_BUFFER_LENGTH_BYTES + 1);
                                             }
                                         } else {
                                             uRingBufferDelete(&(pInstance->ringBuffer));
@@ -433,8 +462,10 @@ int32_t uGnssAdd(uGnssModuleType_t moduleType,
                             }
                         }
                         if (errorCode == 0) {
-                            // Add it to the list
+                            // Add it to the list and to the
+                            // device instance, for lookup
                             addGnssInstance(pInstance);
+                            pDevInstance->pPrivateInstance = (void *) pInstance;
                             errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                             *pGnssHandle = pInstance->gnssHandle;
                         }
@@ -568,6 +599,93 @@ int32_t uGnssGetI2cAddress(uDeviceHandle_t gnssHandle)
     return errorCodeOrI2cAddress;
 }
 
+// Set the size of the ring buffer used for streamed messages.
+int32_t uGnssSetRingBufferLength(uDeviceHandle_t gnssHandle, size_t length)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uRingBuffer_t ringBuffer;
+    char *pLinearBuffer;
+    int32_t readHandlePrivate = -1;
+    int32_t readHandleMsgReceive = -1;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        // The new ring buffer must be able to hold at least one
+        // temporary buffer's worth of data
+        if ((pInstance != NULL) && (length > U_GNSS_MSG_TEMPORARY_BUFFER_LENGTH_BYTES + 1)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (pInstance->pLinearBuffer != NULL) {
+                errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                if (pInstance->pMsgReceive == NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    pLinearBuffer = (char *) pUPortMalloc(length);
+                    if (pLinearBuffer != NULL) {
+                        // Create the new ring buffer before letting go
+                        // of the old one so that, should this fail, we
+                        // are no worse off
+                        memset(&ringBuffer, 0, sizeof(ringBuffer));
+                        errorCode = ringBufferCreate(&ringBuffer, pLinearBuffer, length,
+                                                     &readHandlePrivate, &readHandleMsgReceive);
+                        if (errorCode == 0) {
+
+                            U_PORT_MUTEX_LOCK(pInstance->transportMutex);
+
+                            uRingBufferDelete(&(pInstance->ringBuffer));
+                            uPortFree(pInstance->pLinearBuffer);
+                            pInstance->ringBuffer = ringBuffer;
+                            pInstance->pLinearBuffer = pLinearBuffer;
+                            pInstance->ringBufferLengthBytes = length;
+                            pInstance->ringBufferReadHandlePrivate = readHandlePrivate;
+                            pInstance->ringBufferReadHandleMsgReceive = readHandleMsgReceive;
+                            pInstance->ringBufferHighWaterMark = 0;
+                            pInstance->ringBufferFillAboveThreshold = false;
+
+                            U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
+
+                        } else {
+                            uPortFree(pLinearBuffer);
+                        }
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get the size of the ring buffer used for streamed messages.
+int32_t uGnssGetRingBufferLength(uDeviceHandle_t gnssHandle)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (pInstance->pLinearBuffer != NULL) {
+                errorCodeOrLength = (int32_t) pInstance->ringBufferLengthBytes;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCodeOrLength;
+}
+
 // Remove a GNSS instance.
 void uGnssRemove(uDeviceHandle_t gnssHandle)
 {
@@ -188,6 +188,19 @@ static U_INLINE size_t getStorageSizeBytes(uGnssCfgValKeySize_t storageSize)
     return size;
 }
 
+// Return the value of a configuration item masked to its storage size.
+static uint64_t maskedValue(const uGnssCfgVal_t *pCfgItem)
+{
+    uint64_t value = pCfgItem->value;
+    size_t storageSizeBytes = getStorageSizeBytes(U_GNSS_CFG_VAL_KEY_GET_SIZE(pCfgItem->keyId));
+
+    if (storageSizeBytes < sizeof(value)) {
+        value &= (((uint64_t) 1) << (storageSizeBytes * 8)) - 1;
+    }
+
+    return value;
+}
+
 // Pack a value from a configuration item into a buffer.
 static U_INLINE void packValue(char *pBuffer, const uint64_t *pValue, size_t storageSizeBytes)
 {
@@ -417,6 +430,135 @@ static int32_t valSetByte(uGnssPrivateInstance_t *pInstance,
                                       message, sizeof(message));
 }
 
+// Set a list of configuration items of any length in a single
+// transaction, splitting it into as few VALSET messages as possible.
+// Note: gUGnssPrivateMutex must be locked before this is called.
+static int32_t valSetListTransaction(uGnssPrivateInstance_t *pInstance,
+                                     const uGnssCfgVal_t *pList,
+                                     size_t numValues, int32_t layers)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    size_t numMessages = (numValues + U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES - 1) /
+                         U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES;
+    // Worst case body: header plus all values of eight bytes
+    size_t bodySizeMax = 4 + (U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES * (4 + 8));
+    size_t pipelineSize = U_GNSS_CFG_VAL_SET_PIPELINE_MAX_MESSAGES *
+                          (bodySizeMax + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
+    uGnssCfgValTransaction_t transaction;
+    char *pBody = NULL;
+    char *pPipeline = NULL;
+    size_t pipelineOffset = 0;
+    size_t pipelineCount = 0;
+    size_t bodySize;
+    size_t count;
+
+    if ((uGnssPrivateGetStreamType(pInstance->transportType) >= 0) ||
+        (pInstance->transportType == U_GNSS_TRANSPORT_AT)) {
+        // For the streamed case the messages are encoded into
+        // a pipeline buffer, preceded by a buffer for one body;
+        // the same goes for AT, where the pipeline is sent in as
+        // few AT commands as possible
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pBody = (char *) pUPortMalloc(bodySizeMax + pipelineSize);
+        if (pBody != NULL) {
+            pPipeline = pBody + bodySizeMax;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+    }
+    for (size_t x = 0; (x < numMessages) && (errorCode == 0); x++) {
+        count = numValues - (x * U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES);
+        if (count > U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES) {
+            count = U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES;
+        }
+        transaction = U_GNSS_CFG_VAL_TRANSACTION_CONTINUE;
+        if (numMessages == 1) {
+            transaction = U_GNSS_CFG_VAL_TRANSACTION_NONE;
+        } else if (x == 0) {
+            transaction = U_GNSS_CFG_VAL_TRANSACTION_BEGIN;
+        } else if (x == numMessages - 1) {
+            transaction = U_GNSS_CFG_VAL_TRANSACTION_EXECUTE;
+        }
+        if (pBody == NULL) {
+            // No pipelining: one message at a time
+            errorCode = uGnssCfgPrivateValSetList(pInstance, pList, count,
+                                                  transaction, layers);
+        } else {
+            bodySize = 4 + (4 * count);
+            for (size_t y = 0; y < count; y++) {
+                bodySize += getStorageSizeBytes(U_GNSS_CFG_VAL_KEY_GET_SIZE((pList + y)->keyId));
+            }
+            *pBody       = 0x01; // Version
+            *(pBody + 1) = (char) layers;
+            *(pBody + 2) = (char) transaction;
+            *(pBody + 3) = 0; // Reserved
+            packMessage(pList, count, pBody + 4, bodySize - 4);
+            pipelineOffset += uUbxProtocolEncode(0x06, 0x8a, pBody, bodySize,
+                                                 pPipeline + pipelineOffset);
+            pipelineCount++;
+            if ((pipelineCount == U_GNSS_CFG_VAL_SET_PIPELINE_MAX_MESSAGES) ||
+                (x == numMessages - 1)) {
+                // Send what's in the pipeline and check all of the Acks
+                errorCode = uGnssPrivateSendUbxMessagesAck(pInstance,
+                                                           pPipeline, pipelineOffset,
+                                                           pipelineCount, 0x06, 0x8a);
+                pipelineOffset = 0;
+                pipelineCount = 0;
+            }
+        }
+        pList += count;
+    }
+
+    // Free memory
+    uPortFree(pBody);
+
+    return errorCode;
+}
+
+// For one layer, collect in pDiff the items of pList that differ from
+// those in the GNSS chip, returning the number of items in pDiff.
+// Note: gUGnssPrivateMutex must be locked before this is called.
+static size_t valDiffLayer(uGnssPrivateInstance_t *pInstance,
+                           const uGnssCfgVal_t *pList, size_t numValues,
+                           uGnssCfgValLayer_t layer, uGnssCfgVal_t *pDiff)
+{
+    uint32_t keyIdList[U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES];
+    uGnssCfgVal_t *pCurrent;
+    int32_t numCurrent;
+    size_t numDiff = 0;
+    size_t count;
+    bool same;
+
+    for (size_t x = 0; x < numValues; x += count) {
+        // Poll for as many key IDs as will fit in a VALGET
+        count = numValues - x;
+        if (count > U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES) {
+            count = U_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES;
+        }
+        for (size_t y = 0; y < count; y++) {
+            keyIdList[y] = (pList + x + y)->keyId;
+        }
+        pCurrent = NULL;
+        // A failure here, e.g. a Nack because none of the keys are
+        // present in this layer, just means that everything differs
+        numCurrent = uGnssCfgPrivateValGetListAlloc(pInstance, keyIdList, count,
+                                                    &pCurrent, layer);
+        for (size_t y = 0; y < count; y++) {
+            same = false;
+            for (int32_t z = 0; (z < numCurrent) && !same; z++) {
+                same = ((pCurrent + z)->keyId == (pList + x + y)->keyId) &&
+                       (maskedValue(pCurrent + z) == maskedValue(pList + x + y));
+            }
+            if (!same) {
+                *(pDiff + numDiff) = *(pList + x + y);
+                numDiff++;
+            }
+        }
+        uPortFree(pCurrent);
+    }
+
+    return numDiff;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS THAT ARE PRIVATE TO GNSS
  * -------------------------------------------------------------- */
@@ -1156,6 +1298,122 @@ int32_t uGnssCfgValSetList(uDeviceHandle_t gnssHandle,
     return errorCode;
 }
 
+// Set a list of configuration items of any length in one transaction.
+int32_t uGnssCfgValSetListTransaction(uDeviceHandle_t gnssHandle,
+                                      const uGnssCfgVal_t *pList,
+                                      size_t numValues,
+                                      uint32_t layers)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pList != NULL) && (numValues > 0) &&
+            (layers > 0) && ((layers & ~U_GNSS_CFG_VAL_LAYER_DEFAULT) == 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (U_GNSS_PRIVATE_HAS(pInstance->pModule, U_GNSS_PRIVATE_FEATURE_CFGVALXXX)) {
+                errorCode = valSetListTransaction(pInstance, pList, numValues,
+                                                  (int32_t) layers);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Set a list of configuration items, writing only those that differ.
+int32_t uGnssCfgValSetListDiff(uDeviceHandle_t gnssHandle,
+                               const uGnssCfgVal_t *pList,
+                               size_t numValues, uint32_t layers,
+                               uint32_t *pHash)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssCfgVal_t *pDiff;
+    size_t numDiff;
+    int32_t numWritten = 0;
+    uint32_t hash;
+    uGnssCfgValLayer_t layer;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pList != NULL) && (numValues > 0) &&
+            (layers > 0) && ((layers & ~U_GNSS_CFG_VAL_LAYER_DEFAULT) == 0)) {
+            errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (U_GNSS_PRIVATE_HAS(pInstance->pModule, U_GNSS_PRIVATE_FEATURE_CFGVALXXX)) {
+                hash = uGnssCfgValListHash(pList, numValues);
+                errorCodeOrCount = 0;
+                if ((pHash == NULL) || (*pHash != hash)) {
+                    errorCodeOrCount = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    pDiff = (uGnssCfgVal_t *) pUPortMalloc(numValues * sizeof(uGnssCfgVal_t));
+                    if (pDiff != NULL) {
+                        errorCodeOrCount = 0;
+                        // Do each layer in turn, RAM first
+                        for (int32_t x = 0; (x < 3) && (errorCodeOrCount >= 0); x++) {
+                            layer = (uGnssCfgValLayer_t) (1 << x);
+                            if (layers & layer) {
+                                numDiff = valDiffLayer(pInstance, pList, numValues,
+                                                       layer, pDiff);
+                                if (numDiff > 0) {
+                                    errorCodeOrCount = valSetListTransaction(pInstance, pDiff,
+                                                                             numDiff, layer);
+                                    numWritten += (int32_t) numDiff;
+                                }
+                            }
+                        }
+                        if (errorCodeOrCount == 0) {
+                            errorCodeOrCount = numWritten;
+                        }
+                        uPortFree(pDiff);
+                    }
+                }
+                if ((errorCodeOrCount >= 0) && (pHash != NULL)) {
+                    *pHash = hash;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Compute a hash of a list of configuration items.
+uint32_t uGnssCfgValListHash(const uGnssCfgVal_t *pList, size_t numValues)
+{
+    // 32-bit FNV-1a over the key ID and the significant bytes of
+    // the value of each item, least significant byte first
+    uint32_t hash = 0x811c9dc5;
+    uint64_t value;
+    size_t storageSizeBytes;
+
+    for (size_t x = 0; (pList != NULL) && (x < numValues); x++) {
+        for (size_t y = 0; y < sizeof(pList->keyId); y++) {
+            hash = (hash ^ ((pList->keyId >> (y * 8)) & 0xFF)) * 0x01000193;
+        }
+        value = maskedValue(pList);
+        storageSizeBytes = getStorageSizeBytes(U_GNSS_CFG_VAL_KEY_GET_SIZE(pList->keyId));
+        for (size_t y = 0; y < storageSizeBytes; y++) {
+            hash = (hash ^ (uint32_t) ((value >> (y * 8)) & 0xFF)) * 0x01000193;
+        }
+        pList++;
+    }
+
+    return hash;
+}
+
 // Delete a configuration item.
 int32_t uGnssCfgValDel(uDeviceHandle_t gnssHandle, uint32_t keyId,
                        uGnssCfgValTransaction_t transaction,
@@ -0,0 +1,552 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the correction forwarding functions of
+ * the GNSS API.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset(), memcpy(), memmove()
+
+#include "u_cfg_sw.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+
+#include "u_at_client.h"
+
+#include "u_spartn.h"
+#include "u_spartn_crc.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss_private.h"
+#include "u_gnss_correction.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The size of the buffer in which a frame that straddles two
+ * chunks of correction data is put back together; must be big
+ * enough for the largest SPARTN or RTCM3 frame.
+ */
+#define U_GNSS_CORRECTION_CARRY_LENGTH_BYTES U_SPARTN_MESSAGE_LENGTH_MAX_BYTES
+
+/** The first byte of an RTCM3 frame.
+ */
+#define U_GNSS_CORRECTION_RTCM_PREAMBLE 0xd3
+
+/** The length of the header of an RTCM3 frame: preamble, six
+ * reserved bits and a ten-bit length.
+ */
+#define U_GNSS_CORRECTION_RTCM_HEADER_LENGTH_BYTES 3
+
+/** The length of the CRC-24Q on the end of an RTCM3 frame.
+ */
+#define U_GNSS_CORRECTION_RTCM_CRC_LENGTH_BYTES 3
+
+/** The first byte of a SPARTN frame.
+ */
+#define U_GNSS_CORRECTION_SPARTN_PREAMBLE 0x73
+
+/** The amount of data that uSpartnDetect() needs in order to decide
+ * on the length of any SPARTN frame: the eight bytes of the minimum
+ * header, two more for a 32-bit time tag and two for the
+ * ENCRYPT/AUTH fields.
+ */
+#define U_GNSS_CORRECTION_SPARTN_HEADER_LENGTH_MAX_BYTES (8 + 2 + 2)
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Find the first thing in a buffer that might be a SPARTN or RTCM3
+// frame, writing its start to *ppFrame: returns the length of the
+// frame, which may extend beyond the end of the buffer, else
+// U_ERROR_COMMON_TIMEOUT if there is the start of what might be a
+// frame but not yet enough data to tell, else U_ERROR_COMMON_NOT_FOUND.
+static int32_t findFrame(const char *pBuffer, size_t size,
+                         const char **ppFrame)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+    // Use a uint8_t pointer for maths, more certain of its behaviour than char
+    const uint8_t *pInput = (const uint8_t *) pBuffer;
+    const char *pMessage = NULL;
+    size_t length;
+
+    for (size_t x = 0; (x < size) &&
+         (errorCodeOrLength == (int32_t) U_ERROR_COMMON_NOT_FOUND); x++) {
+        length = size - x;
+        if (*(pInput + x) == U_GNSS_CORRECTION_RTCM_PREAMBLE) {
+            errorCodeOrLength = (int32_t) U_ERROR_COMMON_TIMEOUT;
+            if (length >= U_GNSS_CORRECTION_RTCM_HEADER_LENGTH_BYTES) {
+                errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+                // The six bits after the preamble are reserved, zero
+                if ((*(pInput + x + 1) & 0xfc) == 0) {
+                    errorCodeOrLength = (int32_t) ((((size_t) (*(pInput + x + 1) & 0x03)) << 8) +
+                                                   *(pInput + x + 2) +
+                                                   U_GNSS_CORRECTION_RTCM_HEADER_LENGTH_BYTES +
+                                                   U_GNSS_CORRECTION_RTCM_CRC_LENGTH_BYTES);
+                }
+            }
+        } else if (*(pInput + x) == U_GNSS_CORRECTION_SPARTN_PREAMBLE) {
+            // Only give uSpartnDetect() enough data to decide on this
+            // position, otherwise it would go searching on ahead
+            if (length > U_GNSS_CORRECTION_SPARTN_HEADER_LENGTH_MAX_BYTES) {
+                length = U_GNSS_CORRECTION_SPARTN_HEADER_LENGTH_MAX_BYTES;
+            }
+            errorCodeOrLength = uSpartnDetect(pBuffer + x, length, &pMessage);
+            if (((errorCodeOrLength > 0) && (pMessage != pBuffer + x)) ||
+                ((errorCodeOrLength == (int32_t) U_ERROR_COMMON_TIMEOUT) &&
+                 (length == U_GNSS_CORRECTION_SPARTN_HEADER_LENGTH_MAX_BYTES)) ||
+                ((errorCodeOrLength < 0) &&
+                 (errorCodeOrLength != (int32_t) U_ERROR_COMMON_TIMEOUT))) {
+                // Not a SPARTN frame, or not one that starts here
+                errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            }
+        }
+        if (errorCodeOrLength != (int32_t) U_ERROR_COMMON_NOT_FOUND) {
+            *ppFrame = pBuffer + x;
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// Check the CRC of a complete frame found by findFrame().
+static bool frameIsValid(const char *pFrame, size_t length)
+{
+    bool isValid = false;
+    const uint8_t *pCrc;
+    uint32_t crc;
+
+    if (*((const uint8_t *) pFrame) == U_GNSS_CORRECTION_RTCM_PREAMBLE) {
+        // The RTCM3 CRC-24Q is over the whole frame, preamble
+        // included, and is the same polynomial as the SPARTN CRC-24
+        pCrc = (const uint8_t *) pFrame + length - U_GNSS_CORRECTION_RTCM_CRC_LENGTH_BYTES;
+        crc = (((uint32_t) * pCrc) << 16) + (((uint32_t) * (pCrc + 1)) << 8) +
+              (uint32_t) * (pCrc + 2);
+        isValid = (uSpartnCrc24(pFrame, length - U_GNSS_CORRECTION_RTCM_CRC_LENGTH_BYTES) == crc);
+    } else {
+        isValid = (uSpartnValidate(pFrame, length, NULL) == (int32_t) length);
+    }
+
+    return isValid;
+}
+
+// Remove bytes from the start of the carry buffer.
+static void carryRemove(uGnssPrivateCorrection_t *pCorrection,
+                        size_t length, bool discarded)
+{
+    if (length > pCorrection->carryLength) {
+        length = pCorrection->carryLength;
+    }
+    memmove(pCorrection->pCarry, pCorrection->pCarry + length,
+            pCorrection->carryLength - length);
+    pCorrection->carryLength -= length;
+    if (discarded) {
+        pCorrection->bytesDiscarded += length;
+    }
+}
+
+// Send data to the GNSS device, returning the amount the transport
+// accepted, which will be less than size if it is pushing back, or
+// negative error code if it accepted nothing because of an error.
+static int32_t sendToGnss(uGnssPrivateInstance_t *pInstance,
+                           const char *pData, size_t size)
+{
+    int32_t errorCodeOrLength;
+
+    errorCodeOrLength = uGnssPrivateSendOnlyStreamRaw(pInstance, pData, size);
+    if (errorCodeOrLength > (int32_t) size) {
+        errorCodeOrLength = (int32_t) size;
+    }
+
+    return errorCodeOrLength;
+}
+
+// Complete a frame left over in the carry buffer, topping it up from
+// the chunk at pData (updating *pConsumed), and send it: returns zero
+// when either the carry buffer is empty or the chunk is exhausted,
+// else U_ERROR_COMMON_BUSY or negative error code from the transport
+// if the transport did not accept the whole frame.
+static int32_t feedCarry(uGnssPrivateInstance_t *pInstance,
+                         const char *pData, size_t size,
+                         size_t *pConsumed)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    uGnssPrivateCorrection_t *pCorrection = pInstance->pCorrection;
+    bool needMoreData = false;
+    const char *pFrame = NULL;
+    int32_t errorCodeOrLength;
+    size_t length;
+
+    while ((pCorrection->carryLength > 0) && !needMoreData &&
+           (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS)) {
+        if (!pCorrection->carryReady) {
+            errorCodeOrLength = findFrame(pCorrection->pCarry,
+                                          pCorrection->carryLength, &pFrame);
+            if (errorCodeOrLength == (int32_t) U_ERROR_COMMON_NOT_FOUND) {
+                carryRemove(pCorrection, pCorrection->carryLength, true);
+            } else {
+                // Move the possible frame to the start of the carry buffer
+                carryRemove(pCorrection, pFrame - pCorrection->pCarry, true);
+                length = 1;
+                if (errorCodeOrLength > 0) {
+                    length = (size_t) errorCodeOrLength;
+                    if (length > pCorrection->carryLength) {
+                        length -= pCorrection->carryLength;
+                    } else {
+                        length = 0;
+                    }
+                }
+                // Top up with just enough of the chunk to complete
+                // the frame or, if its length is not yet known, with
+                // one byte at a time
+                if (length > size - *pConsumed) {
+                    length = size - *pConsumed;
+                    needMoreData = true;
+                }
+                if (length > 0) {
+                    memcpy(pCorrection->pCarry + pCorrection->carryLength,
+                           pData + *pConsumed, length);
+                    pCorrection->carryLength += length;
+                    *pConsumed += length;
+                }
+                if ((errorCodeOrLength > 0) &&
+                    (pCorrection->carryLength >= (size_t) errorCodeOrLength)) {
+                    needMoreData = false;
+                    if (frameIsValid(pCorrection->pCarry, errorCodeOrLength)) {
+                        pCorrection->carryReady = true;
+                        pCorrection->carryFrameLength = errorCodeOrLength;
+                        pCorrection->carrySent = 0;
+                    } else {
+                        // Not a frame after all: drop the preamble and
+                        // look again at what is left
+                        pCorrection->framesBad++;
+                        carryRemove(pCorrection, 1, true);
+                    }
+                }
+            }
+        }
+        if (pCorrection->carryReady) {
+            errorCodeOrLength = sendToGnss(pInstance,
+                                     pCorrection->pCarry + pCorrection->carrySent,
+                                     pCorrection->carryFrameLength - pCorrection->carrySent);
+            if (errorCodeOrLength > 0) {
+                pCorrection->carrySent += errorCodeOrLength;
+            }
+            if (pCorrection->carrySent < pCorrection->carryFrameLength) {
+                errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                if (errorCodeOrLength < 0) {
+                    errorCode = errorCodeOrLength;
+                }
+            } else {
+                pCorrection->framesForwarded++;
+                pCorrection->bytesForwarded += pCorrection->carryFrameLength;
+                pCorrection->carryReady = false;
+                carryRemove(pCorrection, pCorrection->carryFrameLength, false);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Send a span of adjacent, valid, frames straight from the caller's
+// chunk.  If the transport pushes back, the frame it stopped part-way
+// through is copied to the carry buffer to be finished later and the
+// frames after that are left with the caller; *pConsumed is set to
+// the amount of the span that need not be passed in again.
+static int32_t sendSpan(uGnssPrivateInstance_t *pInstance,
+                        const char *pSpan, size_t size,
+                        size_t numFrames, size_t *pConsumed)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    uGnssPrivateCorrection_t *pCorrection = pInstance->pCorrection;
+    int32_t errorCodeOrLength;
+    size_t sent = 0;
+    const char *pFrame;
+    size_t length = 0;
+
+    errorCodeOrLength = sendToGnss(pInstance, pSpan, size);
+    if (errorCodeOrLength > 0) {
+        sent = (size_t) errorCodeOrLength;
+    }
+    if (sent == size) {
+        pCorrection->framesForwarded += numFrames;
+        pCorrection->bytesForwarded += size;
+        *pConsumed = size;
+    } else {
+        errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+        if (errorCodeOrLength < 0) {
+            errorCode = errorCodeOrLength;
+        }
+        // Walk the frames, all of which are known to be valid,
+        // to find the one that the transport stopped in
+        *pConsumed = 0;
+        while (*pConsumed + length <= sent) {
+            *pConsumed += length;
+            if (length > 0) {
+                pCorrection->framesForwarded++;
+                pCorrection->bytesForwarded += length;
+            }
+            length = findFrame(pSpan + *pConsumed, size - *pConsumed, &pFrame);
+        }
+        if (sent > *pConsumed) {
+            memcpy(pCorrection->pCarry, pSpan + *pConsumed, length);
+            pCorrection->carryLength = length;
+            pCorrection->carryReady = true;
+            pCorrection->carryFrameLength = length;
+            pCorrection->carrySent = sent - *pConsumed;
+            *pConsumed += length;
+        }
+    }
+
+    return errorCode;
+}
+
+// Forward the frames in a chunk of correction data, with the carry
+// buffer empty, setting *pConsumed to the amount of the chunk dealt
+// with; a frame at the end of the chunk which is incomplete is copied
+// to the carry buffer.
+static int32_t feedChunk(uGnssPrivateInstance_t *pInstance,
+                         const char *pData, size_t size,
+                         size_t *pConsumed)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    uGnssPrivateCorrection_t *pCorrection = pInstance->pCorrection;
+    const char *pEnd = pData + size;
+    const char *pNext = pData;
+    const char *pSpan = pData;
+    size_t spanLength = 0;
+    size_t spanNumFrames = 0;
+    size_t spanConsumed = 0;
+    const char *pFrame = NULL;
+    int32_t errorCodeOrLength;
+    bool isFrame;
+
+    while ((pNext < pEnd) && (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS)) {
+        errorCodeOrLength = findFrame(pNext, pEnd - pNext, &pFrame);
+        isFrame = (errorCodeOrLength > 0) && (pFrame == pNext) &&
+                  (errorCodeOrLength <= pEnd - pFrame) &&
+                  frameIsValid(pFrame, errorCodeOrLength);
+        if (!isFrame && (spanLength > 0)) {
+            // The span of adjacent frames has come to an end: send it
+            errorCode = sendSpan(pInstance, pSpan, spanLength,
+                                 spanNumFrames, &spanConsumed);
+            pNext = pSpan + spanConsumed;
+            spanLength = 0;
+            spanNumFrames = 0;
+        }
+        if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+            if (isFrame) {
+                if (spanLength == 0) {
+                    pSpan = pFrame;
+                }
+                spanLength += errorCodeOrLength;
+                spanNumFrames++;
+                pNext += errorCodeOrLength;
+            } else if (errorCodeOrLength == (int32_t) U_ERROR_COMMON_NOT_FOUND) {
+                pCorrection->bytesDiscarded += pEnd - pNext;
+                pNext = pEnd;
+            } else if (pFrame > pNext) {
+                pCorrection->bytesDiscarded += pFrame - pNext;
+                pNext = pFrame;
+            } else if ((errorCodeOrLength > 0) && (errorCodeOrLength <= pEnd - pFrame)) {
+                // Complete but failed the CRC check: not a frame
+                // after all, move past the preamble
+                pCorrection->framesBad++;
+                pCorrection->bytesDiscarded++;
+                pNext++;
+            } else {
+                // The start of a frame: keep it until the next chunk arrives
+                memcpy(pCorrection->pCarry, pFrame, pEnd - pFrame);
+                pCorrection->carryLength = pEnd - pFrame;
+                pNext = pEnd;
+            }
+        }
+    }
+
+    if ((errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) && (spanLength > 0)) {
+        errorCode = sendSpan(pInstance, pSpan, spanLength,
+                             spanNumFrames, &spanConsumed);
+        pNext = pSpan + spanConsumed;
+    }
+    *pConsumed = pNext - pData;
+
+    return errorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Start forwarding correction data.
+int32_t uGnssCorrectionStart(uDeviceHandle_t gnssHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateCorrection_t *pCorrection;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (uGnssPrivateGetStreamType(pInstance->transportType) >= 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                if (pInstance->pCorrection == NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    // The carry buffer goes on the end of the context
+                    pCorrection = (uGnssPrivateCorrection_t *) pUPortMalloc(sizeof(*pCorrection) +
+                                                                            U_GNSS_CORRECTION_CARRY_LENGTH_BYTES);
+                    if (pCorrection != NULL) {
+                        memset(pCorrection, 0, sizeof(*pCorrection));
+                        pCorrection->pCarry = (char *) (pCorrection + 1);
+                        pInstance->pCorrection = pCorrection;
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Forward a chunk of correction data.
+int32_t uGnssCorrectionFeed(uDeviceHandle_t gnssHandle,
+                            const char *pData, size_t size)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    size_t consumed = 0;
+    size_t chunkConsumed = 0;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && ((pData != NULL) || (size == 0))) {
+            errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+            if (pInstance->pCorrection != NULL) {
+                // Finish off anything left over from last time first
+                errorCodeOrLength = feedCarry(pInstance, pData, size, &consumed);
+                if ((errorCodeOrLength == (int32_t) U_ERROR_COMMON_SUCCESS) &&
+                    (consumed < size)) {
+                    errorCodeOrLength = feedChunk(pInstance, pData + consumed,
+                                                  size - consumed, &chunkConsumed);
+                    consumed += chunkConsumed;
+                }
+                if ((consumed > 0) || (errorCodeOrLength >= 0) ||
+                    (errorCodeOrLength == (int32_t) U_ERROR_COMMON_BUSY)) {
+                    // Back-pressure is not an error, the caller just
+                    // needs to come back with the rest later
+                    errorCodeOrLength = (int32_t) consumed;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCodeOrLength;
+}
+
+// Get the correction forwarding statistics.
+int32_t uGnssCorrectionGetStatistics(uDeviceHandle_t gnssHandle,
+                                     uGnssCorrectionStatistics_t *pStatistics)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateCorrection_t *pCorrection;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pStatistics != NULL)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+            pCorrection = pInstance->pCorrection;
+            if (pCorrection != NULL) {
+                pStatistics->framesForwarded = pCorrection->framesForwarded;
+                pStatistics->bytesForwarded = pCorrection->bytesForwarded;
+                pStatistics->framesBad = pCorrection->framesBad;
+                pStatistics->bytesDiscarded = pCorrection->bytesDiscarded;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Stop forwarding correction data.
+void uGnssCorrectionStop(uDeviceHandle_t gnssHandle)
+{
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            uGnssPrivateCleanUpCorrection(pInstance);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+}
+
+// End of file
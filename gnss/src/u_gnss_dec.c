@@ -49,12 +49,19 @@
  *
  * 3. Create the static decode function for the message here,
  * following the naming pattern, e.g. for UBX-XXX-YYY the function
- * would be named ubxXxxYyyAlloc(); the function  must have the
- * function signature of #uGnssDecKnownFunction_t.
+ * would be named ubxXxxYyyDecode(); the function  must have the
+ * function signature of #uGnssDecKnownFunction_t and must not
+ * allocate memory: it populates a structure provided to it, which
+ * is what allows uGnssDecUbx() to decode into the caller's own
+ * storage.  If the message has repeated blocks, give the header
+ * file a _BLOCK_LENGTH macro and a maximum number of blocks to store
+ * (overridable, see u_gnss_dec_ubx_nav_sat.h) and decode the blocks
+ * with a fixed-stride loop, as ubxNavSatDecode() does.
  *
- * 4. Add the static function to the gpFunctionList array and add
- * its message ID to the gIdList array, making sure to put it in the
- * same position in both.
+ * 4. Add the static function, and the size of its message
+ * structure, to the gFunctionList array and add its message ID to
+ * the gIdList array, making sure to put it in the same position in
+ * both.
  *
  * 5. If in step (1) you chose to include helper functions, add a
  * .c file in this src directory, of the same name as the .h file,
@@ -108,9 +115,9 @@
  * TYPES
  * -------------------------------------------------------------- */
 
-/** Private version of function that can be hooked into
- * pUGnssDecAlloc() by uGnssDecSetCallback() to decode message types
- * that _are_ known to this code.
+/** Function that decodes a message type that is known to this
+ * code into a structure provided by the caller; must not allocate
+ * memory.
  *
  * @param[in] pBuffer             the buffer pointer that was passed to
  *                                pUGnssDecAlloc().
@@ -121,10 +128,13 @@
  *                                by the caller, hence the function
  *                                should not _require_ them to be
  *                                present in the count.
- * @param[out] ppBody             a pointer to a place to put the
- *                                decoded message body, which the
- *                                callback should allocate using
- *                                pUPortMalloc(); will never be NULL.
+ * @param[out] pBody              a pointer to the structure to
+ *                                populate, which will be at least
+ *                                the size given in the bodySize field
+ *                                of #uGnssDecKnown_t; will never be
+ *                                NULL.  Any repeated blocks beyond
+ *                                those in the message need not be
+ *                                written.
  * @return                        zero on a successful decode, else
  *                                negative error code, preferably
  *                                from the set suggested for the
@@ -132,7 +142,14 @@
  */
 typedef int32_t (uGnssDecKnownFunction_t) (const char *pBuffer,
                                            size_t size,
-                                           uGnssDecUnion_t **ppBody);
+                                           uGnssDecUnion_t *pBody);
+
+/** A known decoder and the size of the structure it populates.
+ */
+typedef struct {
+    uGnssDecKnownFunction_t *pFunction;
+    size_t bodySize;
+} uGnssDecKnown_t;
 
 /* ----------------------------------------------------------------
  * STATIC VARIABLES: MISC
@@ -147,7 +164,7 @@ static uGnssDecFunction_t *gpCallback = NULL;
 static void *gpCallbackParam = NULL;
 
 /** The list of known message IDs; order is important,
- * MUST be in the same order as gpFunctionList (see further
+ * MUST be in the same order as gFunctionList (see further
  * down in this file) and both lists must contain the same number
  * of elements.
  */
@@ -159,122 +176,401 @@ static const uGnssMessageId_t gIdList[] = {
     {
         .type = U_GNSS_PROTOCOL_UBX,
         .id.ubx = U_GNSS_UBX_MESSAGE(U_GNSS_DEC_UBX_NAV_HPPOSLLH_MESSAGE_CLASS, U_GNSS_DEC_UBX_NAV_HPPOSLLH_MESSAGE_ID)
+    },
+    {
+        .type = U_GNSS_PROTOCOL_UBX,
+        .id.ubx = U_GNSS_UBX_MESSAGE(U_GNSS_DEC_UBX_NAV_SAT_MESSAGE_CLASS, U_GNSS_DEC_UBX_NAV_SAT_MESSAGE_ID)
+    },
+    {
+        .type = U_GNSS_PROTOCOL_UBX,
+        .id.ubx = U_GNSS_UBX_MESSAGE(U_GNSS_DEC_UBX_NAV_SIG_MESSAGE_CLASS, U_GNSS_DEC_UBX_NAV_SIG_MESSAGE_ID)
+    },
+    {
+        .type = U_GNSS_PROTOCOL_UBX,
+        .id.ubx = U_GNSS_UBX_MESSAGE(U_GNSS_DEC_UBX_RXM_RAWX_MESSAGE_CLASS, U_GNSS_DEC_UBX_RXM_RAWX_MESSAGE_ID)
+    },
+    {
+        .type = U_GNSS_PROTOCOL_UBX,
+        .id.ubx = U_GNSS_UBX_MESSAGE(U_GNSS_DEC_UBX_RXM_SFRBX_MESSAGE_CLASS, U_GNSS_DEC_UBX_RXM_SFRBX_MESSAGE_ID)
+    },
+    {
+        .type = U_GNSS_PROTOCOL_UBX,
+        .id.ubx = U_GNSS_UBX_MESSAGE(U_GNSS_DEC_UBX_NAV_COV_MESSAGE_CLASS, U_GNSS_DEC_UBX_NAV_COV_MESSAGE_ID)
+    },
+    {
+        .type = U_GNSS_PROTOCOL_UBX,
+        .id.ubx = U_GNSS_UBX_MESSAGE(U_GNSS_DEC_UBX_ESF_MEAS_MESSAGE_CLASS, U_GNSS_DEC_UBX_ESF_MEAS_MESSAGE_ID)
     }
 };
 
 // MORE STATIC VARIABLES after the message decoders...
 
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: HELPERS
+ * -------------------------------------------------------------- */
+
+// Decode a little-endian R4 (float) field.
+static float r4Decode(const char *pByte)
+{
+    uint32_t uint32 = uUbxProtocolUint32Decode(pByte);
+    float value;
+
+    memcpy(&value, &uint32, sizeof(value));
+
+    return value;
+}
+
+// Decode a little-endian R8 (double) field.
+static double r8Decode(const char *pByte)
+{
+    uint64_t uint64 = uUbxProtocolUint64Decode(pByte);
+    double value;
+
+    memcpy(&value, &uint64, sizeof(value));
+
+    return value;
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: MESSAGE DECODERS
  * -------------------------------------------------------------- */
 
 // Decode a UBX-NAV-PVT message.
-static int32_t ubxNavPvtAlloc(const char *pBuffer, size_t size,
-                              uGnssDecUnion_t **ppBody)
+static int32_t ubxNavPvtDecode(const char *pBuffer, size_t size,
+                               uGnssDecUnion_t *pBody)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
-    uGnssDecUbxNavPvt_t *pBody;
 
-    // No need to check pBuffer or ppBody for NULLity,
+    // No need to check pBuffer or pBody for NULLity,
     // we will never give this function NULL for those.
     if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_NAV_PVT_BODY_MIN_LENGTH) {
         // Move past the header so that we can use payload offsets
         // throughout, matching the offsets in the interface manual
         pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
-        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-        pBody = (uGnssDecUbxNavPvt_t *) pUPortMalloc(sizeof(uGnssDecUbxNavPvt_t));
-        if (pBody != NULL) {
-            memset(pBody, 0, sizeof(*pBody));
-            // All good now, unless we hit a field we can't decode,
-            // in which case we _could_ set U_ERROR_COMMON_BAD_DATA,
-            // but, since this message will have been checked for
-            // integrity before it gets here, it is better to trust
-            // that the module emitted stuff correctly: it knows
-            // more about this than we do
-            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-            pBody->iTOW = (int32_t) uUbxProtocolUint32Decode(pBuffer + 0);
-            pBody->year = uUbxProtocolUint16Decode(pBuffer + 4);
-            pBody->month = (uint8_t) *(pBuffer + 6); // *NOPAD* stop AStyle making * look like a multiply
-            pBody->day = (uint8_t) *(pBuffer + 7); // *NOPAD*
-            pBody->hour = (uint8_t) *(pBuffer + 8); // *NOPAD*
-            pBody->min = (uint8_t) *(pBuffer + 9); // *NOPAD*
-            pBody->sec = (uint8_t) *(pBuffer + 10); // *NOPAD*
-            pBody->valid = (uint8_t) *(pBuffer + 11); // *NOPAD*
-            pBody->tAcc = uUbxProtocolUint32Decode(pBuffer + 12);
-            pBody->nano = (int32_t) uUbxProtocolUint32Decode(pBuffer + 16);
-            pBody->fixType = (uGnssDecUbxNavPvtFixType_t) *(pBuffer + 20); // *NOPAD*
-            pBody->flags = (uint8_t) *(pBuffer + 21); // *NOPAD*
-            pBody->flags2 = (uint8_t) *(pBuffer + 22); // *NOPAD*
-            pBody->numSV = (uint8_t) *(pBuffer + 23); // *NOPAD*
-            pBody->lon = (int32_t) uUbxProtocolUint32Decode(pBuffer + 24);
-            pBody->lat = (int32_t) uUbxProtocolUint32Decode(pBuffer + 28);
-            pBody->height = (int32_t) uUbxProtocolUint32Decode(pBuffer + 32);
-            pBody->hMSL = (int32_t) uUbxProtocolUint32Decode(pBuffer + 36);
-            pBody->hAcc = uUbxProtocolUint32Decode(pBuffer + 40);
-            pBody->vAcc = uUbxProtocolUint32Decode(pBuffer + 44);
-            pBody->velN = (int32_t) uUbxProtocolUint32Decode(pBuffer + 48);
-            pBody->velE = (int32_t) uUbxProtocolUint32Decode(pBuffer + 52);
-            pBody->velD = (int32_t) uUbxProtocolUint32Decode(pBuffer + 56);
-            pBody->gSpeed = (int32_t) uUbxProtocolUint32Decode(pBuffer + 60);
-            pBody->headMot = (int32_t) uUbxProtocolUint32Decode(pBuffer + 64);
-            pBody->sAcc = uUbxProtocolUint32Decode(pBuffer + 68);
-            pBody->headAcc = uUbxProtocolUint32Decode(pBuffer + 72);
-            pBody->pDOP = uUbxProtocolUint16Decode(pBuffer + 76);
-            pBody->flags3 = uUbxProtocolUint16Decode(pBuffer + 78);
-            // 4 reserved bytes here
-            pBody->headVeh = (int32_t) uUbxProtocolUint32Decode(pBuffer + 84);
-            pBody->magDec = (int16_t) uUbxProtocolUint16Decode(pBuffer + 88);
-            pBody->magAcc = (int16_t) uUbxProtocolUint16Decode(pBuffer + 90);
-
-            // Populate the pointer that was passed in
-            *ppBody = (uGnssDecUnion_t *) pBody;
-        }
+        // All good now, unless we hit a field we can't decode,
+        // in which case we _could_ set U_ERROR_COMMON_BAD_DATA,
+        // but, since this message will have been checked for
+        // integrity before it gets here, it is better to trust
+        // that the module emitted stuff correctly: it knows
+        // more about this than we do
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        pBody->ubxNavPvt.iTOW = (int32_t) uUbxProtocolUint32Decode(pBuffer + 0);
+        pBody->ubxNavPvt.year = uUbxProtocolUint16Decode(pBuffer + 4);
+        pBody->ubxNavPvt.month = (uint8_t) *(pBuffer + 6); // *NOPAD* stop AStyle making * look like a multiply
+        pBody->ubxNavPvt.day = (uint8_t) *(pBuffer + 7); // *NOPAD*
+        pBody->ubxNavPvt.hour = (uint8_t) *(pBuffer + 8); // *NOPAD*
+        pBody->ubxNavPvt.min = (uint8_t) *(pBuffer + 9); // *NOPAD*
+        pBody->ubxNavPvt.sec = (uint8_t) *(pBuffer + 10); // *NOPAD*
+        pBody->ubxNavPvt.valid = (uint8_t) *(pBuffer + 11); // *NOPAD*
+        pBody->ubxNavPvt.tAcc = uUbxProtocolUint32Decode(pBuffer + 12);
+        pBody->ubxNavPvt.nano = (int32_t) uUbxProtocolUint32Decode(pBuffer + 16);
+        pBody->ubxNavPvt.fixType = (uGnssDecUbxNavPvtFixType_t) *(pBuffer + 20); // *NOPAD*
+        pBody->ubxNavPvt.flags = (uint8_t) *(pBuffer + 21); // *NOPAD*
+        pBody->ubxNavPvt.flags2 = (uint8_t) *(pBuffer + 22); // *NOPAD*
+        pBody->ubxNavPvt.numSV = (uint8_t) *(pBuffer + 23); // *NOPAD*
+        pBody->ubxNavPvt.lon = (int32_t) uUbxProtocolUint32Decode(pBuffer + 24);
+        pBody->ubxNavPvt.lat = (int32_t) uUbxProtocolUint32Decode(pBuffer + 28);
+        pBody->ubxNavPvt.height = (int32_t) uUbxProtocolUint32Decode(pBuffer + 32);
+        pBody->ubxNavPvt.hMSL = (int32_t) uUbxProtocolUint32Decode(pBuffer + 36);
+        pBody->ubxNavPvt.hAcc = uUbxProtocolUint32Decode(pBuffer + 40);
+        pBody->ubxNavPvt.vAcc = uUbxProtocolUint32Decode(pBuffer + 44);
+        pBody->ubxNavPvt.velN = (int32_t) uUbxProtocolUint32Decode(pBuffer + 48);
+        pBody->ubxNavPvt.velE = (int32_t) uUbxProtocolUint32Decode(pBuffer + 52);
+        pBody->ubxNavPvt.velD = (int32_t) uUbxProtocolUint32Decode(pBuffer + 56);
+        pBody->ubxNavPvt.gSpeed = (int32_t) uUbxProtocolUint32Decode(pBuffer + 60);
+        pBody->ubxNavPvt.headMot = (int32_t) uUbxProtocolUint32Decode(pBuffer + 64);
+        pBody->ubxNavPvt.sAcc = uUbxProtocolUint32Decode(pBuffer + 68);
+        pBody->ubxNavPvt.headAcc = uUbxProtocolUint32Decode(pBuffer + 72);
+        pBody->ubxNavPvt.pDOP = uUbxProtocolUint16Decode(pBuffer + 76);
+        pBody->ubxNavPvt.flags3 = uUbxProtocolUint16Decode(pBuffer + 78);
+        // 4 reserved bytes here
+        pBody->ubxNavPvt.headVeh = (int32_t) uUbxProtocolUint32Decode(pBuffer + 84);
+        pBody->ubxNavPvt.magDec = (int16_t) uUbxProtocolUint16Decode(pBuffer + 88);
+        pBody->ubxNavPvt.magAcc = (int16_t) uUbxProtocolUint16Decode(pBuffer + 90);
     }
 
     return errorCode;
 }
 
 // Decode a UBX-NAV-HPPOSLLH message.
-static int32_t ubxNavHpposllhAlloc(const char *pBuffer, size_t size,
-                                   uGnssDecUnion_t **ppBody)
+static int32_t ubxNavHpposllhDecode(const char *pBuffer, size_t size,
+                                    uGnssDecUnion_t *pBody)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
-    uGnssDecUbxNavHpposllh_t *pBody;
 
-    // No need to check pBuffer or ppBody for NULLity,
+    // No need to check pBuffer or pBody for NULLity,
     // we will never give this function NULL for those.
     if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_NAV_HPPOSLLH_BODY_MIN_LENGTH) {
         // Move past the header so that we can use payload offsets
         // throughout, matching the offsets in the interface manual
         pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
-        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-        pBody = (uGnssDecUbxNavHpposllh_t *) pUPortMalloc(sizeof(uGnssDecUbxNavHpposllh_t));
-        if (pBody != NULL) {
-            memset(pBody, 0, sizeof(*pBody));
-            // All good now, unless we hit a field we can't decode,
-            // in which case we _could_ set U_ERROR_COMMON_BAD_DATA,
-            // but, since this message will have been checked for
-            // integrity before it gets here, it is better to trust
-            // that the module emitted stuff correctly: it knows
-            // more about this than we do
+        // All good now, unless we hit a field we can't decode,
+        // in which case we _could_ set U_ERROR_COMMON_BAD_DATA,
+        // but, since this message will have been checked for
+        // integrity before it gets here, it is better to trust
+        // that the module emitted stuff correctly: it knows
+        // more about this than we do
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        pBody->ubxNavHpposllh.version = (uint8_t) *(pBuffer + 0); // *NOPAD* stop AStyle making * look like a multiply
+        // 2 reserved bytes here
+        pBody->ubxNavHpposllh.flags = (uint8_t) *(pBuffer + 3); // *NOPAD*
+        pBody->ubxNavHpposllh.iTOW = (int32_t) uUbxProtocolUint32Decode(pBuffer + 4);
+        pBody->ubxNavHpposllh.lon = (int32_t) uUbxProtocolUint32Decode(pBuffer + 8);
+        pBody->ubxNavHpposllh.lat = (int32_t) uUbxProtocolUint32Decode(pBuffer + 12);
+        pBody->ubxNavHpposllh.height = (int32_t) uUbxProtocolUint32Decode(pBuffer + 16);
+        pBody->ubxNavHpposllh.hMSL = (int32_t) uUbxProtocolUint32Decode(pBuffer + 20);
+        pBody->ubxNavHpposllh.lonHp = (int8_t) *(pBuffer + 24); // *NOPAD*
+        pBody->ubxNavHpposllh.latHp = (int8_t) *(pBuffer + 25); // *NOPAD*
+        pBody->ubxNavHpposllh.heightHp = (int8_t) *(pBuffer + 26); // *NOPAD*
+        pBody->ubxNavHpposllh.hMSLHp = (int8_t) *(pBuffer + 27); // *NOPAD*
+        pBody->ubxNavHpposllh.hAcc = uUbxProtocolUint32Decode(pBuffer + 28);
+        pBody->ubxNavHpposllh.vAcc = uUbxProtocolUint32Decode(pBuffer + 32);
+    }
+
+    return errorCode;
+}
+
+// Decode a UBX-NAV-SAT message.
+static int32_t ubxNavSatDecode(const char *pBuffer, size_t size,
+                               uGnssDecUnion_t *pBody)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+    uGnssDecUbxNavSatSv_t *pSv = pBody->ubxNavSat.sv;
+    size_t count;
+
+    if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_NAV_SAT_BODY_MIN_LENGTH) {
+        pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+        pBody->ubxNavSat.iTOW = uUbxProtocolUint32Decode(pBuffer + 0);
+        pBody->ubxNavSat.version = (uint8_t) *(pBuffer + 4); // *NOPAD*
+        pBody->ubxNavSat.numSvs = (uint8_t) *(pBuffer + 5); // *NOPAD*
+        // 2 reserved bytes here
+        count = pBody->ubxNavSat.numSvs;
+        if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_NAV_SAT_BODY_MIN_LENGTH +
+            (count * U_GNSS_DEC_UBX_NAV_SAT_BLOCK_LENGTH)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (count > U_GNSS_DEC_UBX_NAV_SAT_MAX_NUM_SVS) {
+                count = U_GNSS_DEC_UBX_NAV_SAT_MAX_NUM_SVS;
+            }
+            pBody->ubxNavSat.svCount = count;
+            // The repeated blocks: step through with a fixed stride
+            pBuffer += U_GNSS_DEC_UBX_NAV_SAT_BODY_MIN_LENGTH;
+            for (const char *pEnd = pBuffer + (count * U_GNSS_DEC_UBX_NAV_SAT_BLOCK_LENGTH);
+                 pBuffer < pEnd; pBuffer += U_GNSS_DEC_UBX_NAV_SAT_BLOCK_LENGTH, pSv++) {
+                pSv->gnssId = (uint8_t) *(pBuffer + 0); // *NOPAD*
+                pSv->svId = (uint8_t) *(pBuffer + 1); // *NOPAD*
+                pSv->cno = (uint8_t) *(pBuffer + 2); // *NOPAD*
+                pSv->elev = (int8_t) *(pBuffer + 3); // *NOPAD*
+                pSv->azim = (int16_t) uUbxProtocolUint16Decode(pBuffer + 4);
+                pSv->prRes = (int16_t) uUbxProtocolUint16Decode(pBuffer + 6);
+                pSv->flags = uUbxProtocolUint32Decode(pBuffer + 8);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Decode a UBX-NAV-SIG message.
+static int32_t ubxNavSigDecode(const char *pBuffer, size_t size,
+                               uGnssDecUnion_t *pBody)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+    uGnssDecUbxNavSigSig_t *pSig = pBody->ubxNavSig.sig;
+    size_t count;
+
+    if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_NAV_SIG_BODY_MIN_LENGTH) {
+        pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+        pBody->ubxNavSig.iTOW = uUbxProtocolUint32Decode(pBuffer + 0);
+        pBody->ubxNavSig.version = (uint8_t) *(pBuffer + 4); // *NOPAD*
+        pBody->ubxNavSig.numSigs = (uint8_t) *(pBuffer + 5); // *NOPAD*
+        // 2 reserved bytes here
+        count = pBody->ubxNavSig.numSigs;
+        if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_NAV_SIG_BODY_MIN_LENGTH +
+            (count * U_GNSS_DEC_UBX_NAV_SIG_BLOCK_LENGTH)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (count > U_GNSS_DEC_UBX_NAV_SIG_MAX_NUM_SIGS) {
+                count = U_GNSS_DEC_UBX_NAV_SIG_MAX_NUM_SIGS;
+            }
+            pBody->ubxNavSig.sigCount = count;
+            pBuffer += U_GNSS_DEC_UBX_NAV_SIG_BODY_MIN_LENGTH;
+            for (const char *pEnd = pBuffer + (count * U_GNSS_DEC_UBX_NAV_SIG_BLOCK_LENGTH);
+                 pBuffer < pEnd; pBuffer += U_GNSS_DEC_UBX_NAV_SIG_BLOCK_LENGTH, pSig++) {
+                pSig->gnssId = (uint8_t) *(pBuffer + 0); // *NOPAD*
+                pSig->svId = (uint8_t) *(pBuffer + 1); // *NOPAD*
+                pSig->sigId = (uint8_t) *(pBuffer + 2); // *NOPAD*
+                pSig->freqId = (uint8_t) *(pBuffer + 3); // *NOPAD*
+                pSig->prRes = (int16_t) uUbxProtocolUint16Decode(pBuffer + 4);
+                pSig->cno = (uint8_t) *(pBuffer + 6); // *NOPAD*
+                pSig->qualityInd = (uint8_t) *(pBuffer + 7); // *NOPAD*
+                pSig->corrSource = (uint8_t) *(pBuffer + 8); // *NOPAD*
+                pSig->ionoModel = (uint8_t) *(pBuffer + 9); // *NOPAD*
+                pSig->sigFlags = uUbxProtocolUint16Decode(pBuffer + 10);
+                // 4 reserved bytes here
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Decode a UBX-RXM-RAWX message.
+static int32_t ubxRxmRawxDecode(const char *pBuffer, size_t size,
+                                uGnssDecUnion_t *pBody)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+    uGnssDecUbxRxmRawxMeas_t *pMeas = pBody->ubxRxmRawx.meas;
+    size_t count;
+
+    if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_RXM_RAWX_BODY_MIN_LENGTH) {
+        pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+        pBody->ubxRxmRawx.rcvTow = r8Decode(pBuffer + 0);
+        pBody->ubxRxmRawx.week = uUbxProtocolUint16Decode(pBuffer + 8);
+        pBody->ubxRxmRawx.leapS = (int8_t) *(pBuffer + 10); // *NOPAD*
+        pBody->ubxRxmRawx.numMeas = (uint8_t) *(pBuffer + 11); // *NOPAD*
+        pBody->ubxRxmRawx.recStat = (uint8_t) *(pBuffer + 12); // *NOPAD*
+        pBody->ubxRxmRawx.version = (uint8_t) *(pBuffer + 13); // *NOPAD*
+        // 2 reserved bytes here
+        count = pBody->ubxRxmRawx.numMeas;
+        if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_RXM_RAWX_BODY_MIN_LENGTH +
+            (count * U_GNSS_DEC_UBX_RXM_RAWX_BLOCK_LENGTH)) {
             errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-            pBody->version = (uint8_t) *(pBuffer + 0); // *NOPAD* stop AStyle making * look like a multiply
-            // 2 reserved bytes here
-            pBody->flags = (uint8_t) *(pBuffer + 3); // *NOPAD*
-            pBody->iTOW = (int32_t) uUbxProtocolUint32Decode(pBuffer + 4);
-            pBody->lon = (int32_t) uUbxProtocolUint32Decode(pBuffer + 8);
-            pBody->lat = (int32_t) uUbxProtocolUint32Decode(pBuffer + 12);
-            pBody->height = (int32_t) uUbxProtocolUint32Decode(pBuffer + 16);
-            pBody->hMSL = (int32_t) uUbxProtocolUint32Decode(pBuffer + 20);
-            pBody->lonHp = (int8_t) *(pBuffer + 24); // *NOPAD*
-            pBody->latHp = (int8_t) *(pBuffer + 25); // *NOPAD*
-            pBody->heightHp = (int8_t) *(pBuffer + 26); // *NOPAD*
-            pBody->hMSLHp = (int8_t) *(pBuffer + 27); // *NOPAD*
-            pBody->hAcc = uUbxProtocolUint32Decode(pBuffer + 28);
-            pBody->vAcc = uUbxProtocolUint32Decode(pBuffer + 32);
-
-            // Populate the pointer that was passed in
-            *ppBody = (uGnssDecUnion_t *) pBody;
+            if (count > U_GNSS_DEC_UBX_RXM_RAWX_MAX_NUM_MEAS) {
+                count = U_GNSS_DEC_UBX_RXM_RAWX_MAX_NUM_MEAS;
+            }
+            pBody->ubxRxmRawx.measCount = count;
+            pBuffer += U_GNSS_DEC_UBX_RXM_RAWX_BODY_MIN_LENGTH;
+            for (const char *pEnd = pBuffer + (count * U_GNSS_DEC_UBX_RXM_RAWX_BLOCK_LENGTH);
+                 pBuffer < pEnd; pBuffer += U_GNSS_DEC_UBX_RXM_RAWX_BLOCK_LENGTH, pMeas++) {
+                pMeas->prMes = r8Decode(pBuffer + 0);
+                pMeas->cpMes = r8Decode(pBuffer + 8);
+                pMeas->doMes = r4Decode(pBuffer + 16);
+                pMeas->gnssId = (uint8_t) *(pBuffer + 20); // *NOPAD*
+                pMeas->svId = (uint8_t) *(pBuffer + 21); // *NOPAD*
+                pMeas->sigId = (uint8_t) *(pBuffer + 22); // *NOPAD*
+                pMeas->freqId = (uint8_t) *(pBuffer + 23); // *NOPAD*
+                pMeas->locktime = uUbxProtocolUint16Decode(pBuffer + 24);
+                pMeas->cno = (uint8_t) *(pBuffer + 26); // *NOPAD*
+                pMeas->prStdev = (uint8_t) *(pBuffer + 27); // *NOPAD*
+                pMeas->cpStdev = (uint8_t) *(pBuffer + 28); // *NOPAD*
+                pMeas->doStdev = (uint8_t) *(pBuffer + 29); // *NOPAD*
+                pMeas->trkStat = (uint8_t) *(pBuffer + 30); // *NOPAD*
+                // 1 reserved byte here
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Decode a UBX-RXM-SFRBX message.
+static int32_t ubxRxmSfrbxDecode(const char *pBuffer, size_t size,
+                                 uGnssDecUnion_t *pBody)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+    uint32_t *pDwrd = pBody->ubxRxmSfrbx.dwrd;
+    size_t count;
+
+    if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_RXM_SFRBX_BODY_MIN_LENGTH) {
+        pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+        pBody->ubxRxmSfrbx.gnssId = (uint8_t) *(pBuffer + 0); // *NOPAD*
+        pBody->ubxRxmSfrbx.svId = (uint8_t) *(pBuffer + 1); // *NOPAD*
+        pBody->ubxRxmSfrbx.sigId = (uint8_t) *(pBuffer + 2); // *NOPAD*
+        pBody->ubxRxmSfrbx.freqId = (uint8_t) *(pBuffer + 3); // *NOPAD*
+        pBody->ubxRxmSfrbx.numWords = (uint8_t) *(pBuffer + 4); // *NOPAD*
+        pBody->ubxRxmSfrbx.chn = (uint8_t) *(pBuffer + 5); // *NOPAD*
+        pBody->ubxRxmSfrbx.version = (uint8_t) *(pBuffer + 6); // *NOPAD*
+        // 1 reserved byte here
+        count = pBody->ubxRxmSfrbx.numWords;
+        if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_RXM_SFRBX_BODY_MIN_LENGTH +
+            (count * U_GNSS_DEC_UBX_RXM_SFRBX_BLOCK_LENGTH)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (count > U_GNSS_DEC_UBX_RXM_SFRBX_MAX_NUM_WORDS) {
+                count = U_GNSS_DEC_UBX_RXM_SFRBX_MAX_NUM_WORDS;
+            }
+            pBody->ubxRxmSfrbx.dwrdCount = count;
+            pBuffer += U_GNSS_DEC_UBX_RXM_SFRBX_BODY_MIN_LENGTH;
+            for (const char *pEnd = pBuffer + (count * U_GNSS_DEC_UBX_RXM_SFRBX_BLOCK_LENGTH);
+                 pBuffer < pEnd; pBuffer += U_GNSS_DEC_UBX_RXM_SFRBX_BLOCK_LENGTH, pDwrd++) {
+                *pDwrd = uUbxProtocolUint32Decode(pBuffer);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Decode a UBX-NAV-COV message.
+static int32_t ubxNavCovDecode(const char *pBuffer, size_t size,
+                               uGnssDecUnion_t *pBody)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+
+    if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_NAV_COV_BODY_MIN_LENGTH) {
+        pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        pBody->ubxNavCov.iTOW = uUbxProtocolUint32Decode(pBuffer + 0);
+        pBody->ubxNavCov.version = (uint8_t) *(pBuffer + 4); // *NOPAD*
+        pBody->ubxNavCov.posCovValid = (uint8_t) *(pBuffer + 5); // *NOPAD*
+        pBody->ubxNavCov.velCovValid = (uint8_t) *(pBuffer + 6); // *NOPAD*
+        // 9 reserved bytes here
+        pBody->ubxNavCov.posCovNN = r4Decode(pBuffer + 16);
+        pBody->ubxNavCov.posCovNE = r4Decode(pBuffer + 20);
+        pBody->ubxNavCov.posCovND = r4Decode(pBuffer + 24);
+        pBody->ubxNavCov.posCovEE = r4Decode(pBuffer + 28);
+        pBody->ubxNavCov.posCovED = r4Decode(pBuffer + 32);
+        pBody->ubxNavCov.posCovDD = r4Decode(pBuffer + 36);
+        pBody->ubxNavCov.velCovNN = r4Decode(pBuffer + 40);
+        pBody->ubxNavCov.velCovNE = r4Decode(pBuffer + 44);
+        pBody->ubxNavCov.velCovND = r4Decode(pBuffer + 48);
+        pBody->ubxNavCov.velCovEE = r4Decode(pBuffer + 52);
+        pBody->ubxNavCov.velCovED = r4Decode(pBuffer + 56);
+        pBody->ubxNavCov.velCovDD = r4Decode(pBuffer + 60);
+    }
+
+    return errorCode;
+}
+
+// Decode a UBX-ESF-MEAS message.
+static int32_t ubxEsfMeasDecode(const char *pBuffer, size_t size,
+                                uGnssDecUnion_t *pBody)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+    uGnssDecUbxEsfMeasData_t *pData = pBody->ubxEsfMeas.data;
+    uint32_t data;
+    size_t count;
+
+    if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_ESF_MEAS_BODY_MIN_LENGTH) {
+        pBuffer += U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+        pBody->ubxEsfMeas.timeTag = uUbxProtocolUint32Decode(pBuffer + 0);
+        pBody->ubxEsfMeas.flags = uUbxProtocolUint16Decode(pBuffer + 4);
+        pBody->ubxEsfMeas.id = uUbxProtocolUint16Decode(pBuffer + 6);
+        // The number of measurements is in the flags field and
+        // a 5-bit field can't exceed the size of the array
+        count = (pBody->ubxEsfMeas.flags & U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_NUM_MEAS_MASK) >>
+                U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_NUM_MEAS;
+        if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_ESF_MEAS_BODY_MIN_LENGTH +
+            (count * U_GNSS_DEC_UBX_ESF_MEAS_BLOCK_LENGTH)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            pBody->ubxEsfMeas.dataCount = count;
+            pBuffer += U_GNSS_DEC_UBX_ESF_MEAS_BODY_MIN_LENGTH;
+            for (const char *pEnd = pBuffer + (count * U_GNSS_DEC_UBX_ESF_MEAS_BLOCK_LENGTH);
+                 pBuffer < pEnd; pBuffer += U_GNSS_DEC_UBX_ESF_MEAS_BLOCK_LENGTH, pData++) {
+                data = uUbxProtocolUint32Decode(pBuffer);
+                pData->dataType = (uint8_t) ((data >> 24) & 0x3F);
+                // dataField is the signed lower 24 bits, dataType the next 6
+                if (data & 0x00800000) {
+                    data |= 0xFF000000;
+                } else {
+                    data &= 0x00FFFFFF;
+                }
+                pData->dataField = (int32_t) data;
+            }
+            pBody->ubxEsfMeas.calibTtag = 0;
+            if ((pBody->ubxEsfMeas.flags & (1U << U_GNSS_DEC_UBX_ESF_MEAS_FLAGS_CALIB_TTAG_VALID)) &&
+                (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES + U_GNSS_DEC_UBX_ESF_MEAS_BODY_MIN_LENGTH +
+                 (count * U_GNSS_DEC_UBX_ESF_MEAS_BLOCK_LENGTH) + 4)) {
+                pBody->ubxEsfMeas.calibTtag = uUbxProtocolUint32Decode(pBuffer);
+            }
         }
     }
 
@@ -285,115 +581,216 @@ static int32_t ubxNavHpposllhAlloc(const char *pBuffer, size_t size,
  * STATIC VARIABLES: MESSAGE DECODER LIST
  * -------------------------------------------------------------- */
 
-/** A list of message decode functions; order is important,
- * MUST be in the same order as gIdList and both lists
- * must contain the same number of elements.
+/** A list of message decode functions and the size of the structure
+ * each one populates; order is important, MUST be in the same order
+ * as gIdList and both lists must contain the same number of elements.
  */
-static uGnssDecKnownFunction_t *gpFunctionList[] = {
-    ubxNavPvtAlloc,
-    ubxNavHpposllhAlloc
+static const uGnssDecKnown_t gFunctionList[] = {
+    {ubxNavPvtDecode, sizeof(uGnssDecUbxNavPvt_t)},
+    {ubxNavHpposllhDecode, sizeof(uGnssDecUbxNavHpposllh_t)},
+    {ubxNavSatDecode, sizeof(uGnssDecUbxNavSat_t)},
+    {ubxNavSigDecode, sizeof(uGnssDecUbxNavSig_t)},
+    {ubxRxmRawxDecode, sizeof(uGnssDecUbxRxmRawx_t)},
+    {ubxRxmSfrbxDecode, sizeof(uGnssDecUbxRxmSfrbx_t)},
+    {ubxNavCovDecode, sizeof(uGnssDecUbxNavCov_t)},
+    {ubxEsfMeasDecode, sizeof(uGnssDecUbxEsfMeas_t)}
 };
 
 /* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS
+ * STATIC FUNCTIONS: MISC
  * -------------------------------------------------------------- */
 
-// Decode a message buffer received from a GNSS device.
-uGnssDec_t *pUGnssDecAlloc(const char *pBuffer, size_t size)
+// Find the entry in gFunctionList for the given message ID.
+static const uGnssDecKnown_t *pFindKnown(const uGnssMessageId_t *pId)
+{
+    const uGnssDecKnown_t *pKnown = NULL;
+
+    for (size_t x = 0; (pKnown == NULL) && (x < sizeof(gIdList) / sizeof(gIdList[0])); x++) {
+        if (uGnssMsgIdIsWanted((uGnssMessageId_t *) pId, (uGnssMessageId_t *) & (gIdList[x]))) {
+            pKnown = &(gFunctionList[x]);
+        }
+    }
+
+    return pKnown;
+}
+
+// Decode a message buffer into pDec, which must have been zeroed;
+// if pBody is NULL the body is allocated, else it is written to pBody,
+// which has bodySize bytes of storage.
+static void decode(const char *pBuffer, size_t size, uGnssDec_t *pDec,
+                   uGnssDecUnion_t *pBody, size_t bodySize)
 {
-    uGnssDec_t *pDec = NULL;
     uint8_t *pBufferUint8 = (uint8_t *) pBuffer; // To avoid problems with signed char compares
-    uGnssDecKnownFunction_t *pFunction = NULL;
+    const uGnssDecKnown_t *pKnown;
     size_t x;
     size_t y;
 
-    pDec = (uGnssDec_t *) pUPortMalloc(sizeof(uGnssDec_t));
-    if (pDec != NULL) {
-        memset(pDec, 0, sizeof(*pDec));
-        pDec->errorCode = (int32_t) U_ERROR_COMMON_EMPTY;
-        pDec->id.type = U_GNSS_PROTOCOL_UNKNOWN;
-        if ((pBufferUint8 != NULL) && (size > 0)) {
-            // Determine the protocol type/message ID and make
-            // sure the header is sound
-            pDec->errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
-            if ((*pBufferUint8 == 0xB5) && (size >= 1) && (*(pBufferUint8 + 1) == 0x62)) {
-                // Likely a UBX message
+    pDec->errorCode = (int32_t) U_ERROR_COMMON_EMPTY;
+    pDec->id.type = U_GNSS_PROTOCOL_UNKNOWN;
+    if ((pBufferUint8 != NULL) && (size > 0)) {
+        // Determine the protocol type/message ID and make
+        // sure the header is sound
+        pDec->errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
+        if ((*pBufferUint8 == 0xB5) && (size >= 1) && (*(pBufferUint8 + 1) == 0x62)) {
+            // Likely a UBX message
+            pBufferUint8 += 2;
+            pDec->id.type = U_GNSS_PROTOCOL_UBX;
+            pDec->errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+            if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES) {
+                // Grab the message class and message ID, check the length,
+                // allowing the checksum bytes to be omitted
+                pDec->id.id.ubx = U_GNSS_UBX_MESSAGE(*pBufferUint8, *(pBufferUint8 + 1));
                 pBufferUint8 += 2;
-                pDec->id.type = U_GNSS_PROTOCOL_UBX;
-                pDec->errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
-                if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES) {
-                    // Grab the message class and message ID, check the length,
-                    // allowing the checksum bytes to be omitted
-                    pDec->id.id.ubx = U_GNSS_UBX_MESSAGE(*pBufferUint8, *(pBufferUint8 + 1));
-                    pBufferUint8 += 2;
-                    y = *pBufferUint8 + ((uint16_t) *(pBufferUint8 + 1) << 8); // *NOPAD*
-                    if (size >= y + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES) {
-                        pDec->errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                    }
+                y = *pBufferUint8 + ((uint16_t) *(pBufferUint8 + 1) << 8); // *NOPAD*
+                if (size >= y + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES) {
+                    pDec->errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                 }
-            } else if (*pBufferUint8 == '$') {
-                // Likely an NMEA message
+            }
+        } else if (*pBufferUint8 == '$') {
+            // Likely an NMEA message
+            pBufferUint8++;
+            y = size - 1;
+            pDec->id.type = U_GNSS_PROTOCOL_NMEA;
+            pDec->errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+            for (x = 0; (((*pBufferUint8 >= 'A') && (*pBufferUint8 <= 'Z')) ||
+                         ((*pBufferUint8 >= '0') && (*pBufferUint8 <= '9'))) &&
+                 (x < y) && (x < sizeof(pDec->nmea) - 1); x++) {
+                // Looking for up to U_GNSS_NMEA_MESSAGE_MATCH_LENGTH_CHARACTERS
+                // characters in the range 0-9, A-Z, followed by a comma
+                pDec->nmea[x] = *pBufferUint8;
                 pBufferUint8++;
-                y = size - 1;
-                pDec->id.type = U_GNSS_PROTOCOL_NMEA;
-                pDec->errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
-                for (x = 0; (((*pBufferUint8 >= 'A') && (*pBufferUint8 <= 'Z')) ||
-                             ((*pBufferUint8 >= '0') && (*pBufferUint8 <= '9'))) &&
-                     (x < y) && (x < sizeof(pDec->nmea) - 1); x++) {
-                    // Looking for up to U_GNSS_NMEA_MESSAGE_MATCH_LENGTH_CHARACTERS
-                    // characters in the range 0-9, A-Z, followed by a comma
-                    pDec->nmea[x] = *pBufferUint8;
-                    pBufferUint8++;
+            }
+            if ((x < y) && (*pBufferUint8 == ',')) {
+                pDec->id.id.pNmea = pDec->nmea;
+                pDec->errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+            // No need to add a terminator since we zeroed the structure to begin with
+        } else if (*pBufferUint8 == 0xD3) {
+            // Likely an RTCM message
+            pBufferUint8++;
+            pDec->id.type = U_GNSS_PROTOCOL_RTCM;
+            pDec->errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+            // Length is only in the first three bits of the first length byte,
+            // the rest must be zero
+            if ((size >= 1 /* D3 */ + 2 /* length */) &&
+                ((*pBufferUint8 & 0xFC) == 0)) {
+                y = ((uint16_t) (*pBufferUint8 & 0x03) << 8) + *(pBufferUint8 + 1);
+                pBufferUint8 += 2;
+                if (size >= 1 /* D3 */ + 2 /* length */ + 2 /* ID */) {
+                    // Grab the ID from the next two bytes
+                    pDec->id.id.rtcm = (*(pBufferUint8 + 1) >> 4) + (((uint16_t) *pBufferUint8) << 4); // *NOPAD*
+                    if (size >= 1 /* D3 */ + 2 /* length */ + y /* length includes the message ID */ ) {
+                        // Check the length, allowing the CRC bytes to be omitted
+                        pDec->errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    }
                 }
-                if ((x < y) && (*pBufferUint8 == ',')) {
-                    pDec->id.id.pNmea = pDec->nmea;
-                    pDec->errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+        if (pDec->errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+            // Got a known protocol, an ID and a valid length, see if we have
+            // a decoder for this message ID
+            pDec->errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            pKnown = pFindKnown(&(pDec->id));
+            if (pKnown != NULL) {
+                // Found a matching decoder: if no storage has been
+                // provided for the body, allocate it and run the decoder
+                pDec->errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                if (pBody == NULL) {
+                    pDec->pBody = (uGnssDecUnion_t *) pUPortMalloc(pKnown->bodySize);
+                } else if (bodySize >= pKnown->bodySize) {
+                    pDec->pBody = pBody;
                 }
-                // No need to add a terminator since we zeroed the structure to begin with
-            } else if (*pBufferUint8 == 0xD3) {
-                // Likely an RTCM message
-                pBufferUint8++;
-                pDec->id.type = U_GNSS_PROTOCOL_RTCM;
-                pDec->errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
-                // Length is only in the first three bits of the first length byte,
-                // the rest must be zero
-                if ((size >= 1 /* D3 */ + 2 /* length */) &&
-                    ((*pBufferUint8 & 0xFC) == 0)) {
-                    y = ((uint16_t) (*pBufferUint8 & 0x03) << 8) + *(pBufferUint8 + 1);
-                    pBufferUint8 += 2;
-                    if (size >= 1 /* D3 */ + 2 /* length */ + 2 /* ID */) {
-                        // Grab the ID from the next two bytes
-                        pDec->id.id.rtcm = (*(pBufferUint8 + 1) >> 4) + (((uint16_t) *pBufferUint8) << 4); // *NOPAD*
-                        if (size >= 1 /* D3 */ + 2 /* length */ + y /* length includes the message ID */ ) {
-                            // Check the length, allowing the CRC bytes to be omitted
-                            pDec->errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                if (pDec->pBody != NULL) {
+                    memset(pDec->pBody, 0, pKnown->bodySize);
+                    pDec->errorCode = pKnown->pFunction(pBuffer, size, pDec->pBody);
+                    if (pDec->errorCode != (int32_t) U_ERROR_COMMON_SUCCESS) {
+                        if (pBody == NULL) {
+                            uPortFree(pDec->pBody);
                         }
+                        pDec->pBody = NULL;
                     }
                 }
             }
-            if (pDec->errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
-                // Got a known protocol, an ID and a valid length, see if we have
-                // a decoder for this message ID
-                pDec->errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
-                for (x = 0; (pFunction == NULL) && (x < sizeof(gIdList) / sizeof(gIdList[0])); x++) {
-                    if (uGnssMsgIdIsWanted(&(pDec->id), (uGnssMessageId_t *) & (gIdList[x]))) {
-                        pFunction = gpFunctionList[x];
+        }
+        if ((pDec->errorCode != (int32_t) U_ERROR_COMMON_SUCCESS) &&
+            (pBody == NULL) && (gpCallback != NULL)) {
+            // Couldn't decode the message: let the user callback try,
+            // which is only possible if we are allowed to allocate
+            pDec->errorCode = gpCallback(&(pDec->id), pBuffer, size, &(pDec->pBody), gpCallbackParam);
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Decode a message buffer received from a GNSS device.
+uGnssDec_t *pUGnssDecAlloc(const char *pBuffer, size_t size)
+{
+    uGnssDec_t *pDec = NULL;
+
+    pDec = (uGnssDec_t *) pUPortMalloc(sizeof(uGnssDec_t));
+    if (pDec != NULL) {
+        memset(pDec, 0, sizeof(*pDec));
+        decode(pBuffer, size, pDec, NULL, 0);
+    }
+
+    return pDec;
+}
+
+// Decode a message buffer into caller-provided storage.
+int32_t uGnssDecDecode(const char *pBuffer, size_t size,
+                       uGnssDec_t *pDec, size_t decSize)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pDec != NULL) && (decSize >= U_GNSS_DEC_BODY_OFFSET)) {
+        memset(pDec, 0, U_GNSS_DEC_BODY_OFFSET);
+        decode(pBuffer, size, pDec,
+               (uGnssDecUnion_t *) (((char *) pDec) + U_GNSS_DEC_BODY_OFFSET),
+               decSize - U_GNSS_DEC_BODY_OFFSET);
+        errorCode = pDec->errorCode;
+    }
+
+    return errorCode;
+}
+
+// Decode a UBX message into a caller-provided structure.
+int32_t uGnssDecUbx(const char *pBuffer, size_t size,
+                    void *pBody, size_t bodySize)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    const uint8_t *pBufferUint8 = (const uint8_t *) pBuffer;
+    const uGnssDecKnown_t *pKnown;
+    uGnssMessageId_t id;
+
+    if ((pBuffer != NULL) && (pBody != NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+        if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES) {
+            errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
+            if ((*pBufferUint8 == 0xB5) && (*(pBufferUint8 + 1) == 0x62)) {
+                errorCode = (int32_t) U_ERROR_COMMON_TRUNCATED;
+                // Allow the checksum bytes to be omitted
+                if (size >= U_UBX_PROTOCOL_HEADER_LENGTH_BYTES +
+                    uUbxProtocolUint16Decode(pBuffer + 4)) {
+                    id.type = U_GNSS_PROTOCOL_UBX;
+                    id.id.ubx = U_GNSS_UBX_MESSAGE(*(pBufferUint8 + 2), *(pBufferUint8 + 3));
+                    errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+                    pKnown = pFindKnown(&id);
+                    if (pKnown != NULL) {
+                        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                        if (bodySize >= pKnown->bodySize) {
+                            errorCode = pKnown->pFunction(pBuffer, size,
+                                                          (uGnssDecUnion_t *) pBody);
+                        }
                     }
                 }
-                if (pFunction != NULL) {
-                    // Found a matching decoder, run it
-                    pDec->errorCode = pFunction(pBuffer, size, &(pDec->pBody));
-                }
-            }
-            if ((pDec->errorCode != (int32_t) U_ERROR_COMMON_SUCCESS) &&
-                (gpCallback != NULL)) {
-                // Couldn't decode the message: let the user callback try
-                pDec->errorCode = gpCallback(&(pDec->id), pBuffer, size, &(pDec->pBody), gpCallbackParam);
             }
         }
     }
 
-    return pDec;
+    return errorCode;
 }
 
 // Free the memory returned by pUGnssDecAlloc().
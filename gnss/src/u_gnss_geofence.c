@@ -0,0 +1,884 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the GNSS geofence API.
+ *
+ * Each fence is held in a local flat-earth frame, in millimetres
+ * east and north of its reference point, along with a bounding box,
+ * expanded by the hysteresis distance, in ten millionths of a degree
+ * relative to that same point.  A position outside the bounding box
+ * of a fence is outside that fence by at least the hysteresis
+ * distance and so needs no more work; only for a position inside the
+ * bounding box is the position projected into the frame of the fence
+ * and tested properly.
+ *
+ * The bounding boxes are also used to index the fences: each fence
+ * is entered in every cell of a grid of latitude/longitude that its
+ * bounding box overlaps, the cells being hashed into a table of
+ * buckets, so that only the fences in the cell of a position need
+ * be looked at, plus any fences that are too big to index, plus
+ * those that the position was last inside (since those might now
+ * have been left).
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+
+#include "u_at_client.h"
+
+#include "u_ringbuffer.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss_private.h"
+#include "u_gnss_geofence.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The number of millimetres in one ten millionth of a degree of
+ * latitude, multiplied by 1000; the same figure applies to longitude
+ * at the equator.
+ */
+#define U_GNSS_GEOFENCE_MILLIMETRES_PER_DEGREE_X1E7_X1000 11132
+
+/** The smallest cosine (multiplied by 1000) of the latitude of the
+ * reference point of a fence that is used when converting distances
+ * into longitude, so that fences very close to the poles don't
+ * cause a division by zero; they just end up with a bounding box
+ * that covers all longitudes.
+ */
+#define U_GNSS_GEOFENCE_MIN_COS_X1000 10
+
+/** Latitude, in ten millionths of a degree, at the pole.
+ */
+#define U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7 900000000
+
+/** Longitude, in ten millionths of a degree, at the anti-meridian.
+ */
+#define U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7 1800000000
+
+/** The number of grid cells around a line of latitude.
+ */
+#define U_GNSS_GEOFENCE_GRID_NUM_CELLS_LONGITUDE ((int32_t) ((2LL * U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7 +    \
+                                                              U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7 - 1) / \
+                                                             U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7))
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A fence.
+ */
+typedef struct uGnssGeofenceFence_t {
+    int32_t id;
+    int32_t latitudeX1e7;      /**< of the reference point. */
+    int32_t longitudeX1e7;     /**< of the reference point. */
+    int32_t cosX1000;          /**< cosine of latitudeX1e7, times 1000. */
+    int32_t radiusMillimetres; /**< zero if this is a polygon. */
+    size_t numVertices;        /**< zero if this is a circle. */
+    int32_t *pVertex;          /**< east then north, in millimetres from the
+                                    reference point, for each vertex. */
+    int32_t latitudeLowX1e7;   /**< the bounding box, relative to the */
+    int32_t latitudeHighX1e7;  /**< reference point, including the     */
+    int32_t longitudeLowX1e7;  /**< hysteresis distance.               */
+    int32_t longitudeHighX1e7;
+    bool indexed;              /**< true if this fence is in the grid. */
+    bool inside;               /**< true if the last event was an entry. */
+    uint32_t checkCount;       /**< the checkCount of uGnssGeofence_t when
+                                    this fence was last checked. */
+    struct uGnssGeofenceFence_t *pNext;           /**< all fences. */
+    struct uGnssGeofenceFence_t *pNextUnindexed;  /**< fences not in the grid. */
+    struct uGnssGeofenceFence_t *pNextInside;     /**< fences we are inside. */
+} uGnssGeofenceFence_t;
+
+/** An entry for a fence in a cell of the grid.
+ */
+typedef struct uGnssGeofenceCell_t {
+    int32_t cellLatitude;
+    int32_t cellLongitude;
+    uGnssGeofenceFence_t *pFence;
+    struct uGnssGeofenceCell_t *pNext;
+} uGnssGeofenceCell_t;
+
+/** A set of fences.
+ */
+struct uGnssGeofence_t {
+    uPortMutexHandle_t mutex;
+    int32_t hysteresisMillimetres;
+    uGnssGeofenceCallback_t pCallback;
+    void *pCallbackParam;
+    uint32_t checkCount;
+    uGnssGeofenceFence_t *pFenceList;
+    uGnssGeofenceFence_t *pUnindexedList;
+    uGnssGeofenceFence_t *pInsideList;
+    uGnssGeofenceCell_t *pBucket[U_GNSS_GEOFENCE_GRID_NUM_BUCKETS];
+};
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: GEOMETRY
+ * -------------------------------------------------------------- */
+
+// Cosine, multiplied by 1000, of a latitude in ten millionths of a
+// degree, using Bhaskara's rational approximation (good to 0.2%),
+// so that no floating point is needed.
+static int32_t cosX1000(int32_t latitudeX1e7)
+{
+    int64_t x = latitudeX1e7 / 100000; // Hundredths of a degree
+    int64_t xSquared = x * x;
+
+    return (int32_t) ((1000 * 4 * (81000000LL - xSquared)) / ((4 * 81000000LL) + xSquared));
+}
+
+// Return the difference between two longitudes, taking the short
+// way round.
+static int64_t longitudeDifference(int32_t longitudeX1e7, int32_t fromLongitudeX1e7)
+{
+    int64_t difference = (int64_t) longitudeX1e7 - fromLongitudeX1e7;
+
+    if (difference > U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7) {
+        difference -= 2LL * U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7;
+    } else if (difference < -U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7) {
+        difference += 2LL * U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7;
+    }
+
+    return difference;
+}
+
+// Convert a north/south distance in millimetres to ten millionths
+// of a degree of latitude, rounding away from zero.
+static int64_t millimetresToLatitudeX1e7(int64_t millimetres)
+{
+    int64_t x = millimetres * 1000 / U_GNSS_GEOFENCE_MILLIMETRES_PER_DEGREE_X1E7_X1000;
+
+    return (x < 0) ? x - 1 : x + 1;
+}
+
+// Convert an east/west distance in millimetres to ten millionths
+// of a degree of longitude in the frame of a fence, rounding away
+// from zero and limiting the result to half way around the world.
+static int64_t millimetresToLongitudeX1e7(const uGnssGeofenceFence_t *pFence,
+                                          int64_t millimetres)
+{
+    int64_t x = millimetres * 1000 * 1000 /
+                U_GNSS_GEOFENCE_MILLIMETRES_PER_DEGREE_X1E7_X1000 /
+                pFence->cosX1000;
+
+    x = (x < 0) ? x - 1 : x + 1;
+    if (x > U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7) {
+        x = U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7;
+    } else if (x < -U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7) {
+        x = -U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7;
+    }
+
+    return x;
+}
+
+// Project a latitude/longitude into the frame of a fence.
+static void project(const uGnssGeofenceFence_t *pFence,
+                    int32_t latitudeX1e7, int32_t longitudeX1e7,
+                    int64_t *pEast, int64_t *pNorth)
+{
+    *pNorth = ((int64_t) latitudeX1e7 - pFence->latitudeX1e7) *
+              U_GNSS_GEOFENCE_MILLIMETRES_PER_DEGREE_X1E7_X1000 / 1000;
+    *pEast = (longitudeDifference(longitudeX1e7, pFence->longitudeX1e7) *
+              U_GNSS_GEOFENCE_MILLIMETRES_PER_DEGREE_X1E7_X1000 / 1000) *
+             pFence->cosX1000 / 1000;
+}
+
+// Integer square root.
+static int64_t squareRoot(int64_t x)
+{
+    int64_t root = 0;
+    int64_t bit = 1LL << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+// Return true if the point (east, north) is within distance of the
+// line segment from (aEast, aNorth) to (bEast, bNorth), all values
+// being in millimetres and no more than twice
+// U_GNSS_GEOFENCE_MAX_SIZE_MILLIMETRES apart, so that the
+// products here cannot overflow.
+static bool isNearSegment(int64_t east, int64_t north,
+                          int64_t aEast, int64_t aNorth,
+                          int64_t bEast, int64_t bNorth,
+                          int64_t distance)
+{
+    bool isNear;
+    int64_t segmentEast = bEast - aEast;
+    int64_t segmentNorth = bNorth - aNorth;
+    int64_t lengthSquared = (segmentEast * segmentEast) + (segmentNorth * segmentNorth);
+    int64_t dot = ((east - aEast) * segmentEast) + ((north - aNorth) * segmentNorth);
+    int64_t cross;
+
+    if ((dot <= 0) || (lengthSquared == 0)) {
+        // Closest to the start of the segment
+        isNear = ((east - aEast) * (east - aEast)) +
+                 ((north - aNorth) * (north - aNorth)) < distance * distance;
+    } else if (dot >= lengthSquared) {
+        // Closest to the end of the segment
+        isNear = ((east - bEast) * (east - bEast)) +
+                 ((north - bNorth) * (north - bNorth)) < distance * distance;
+    } else {
+        // Closest to somewhere along the segment: the perpendicular
+        // distance is the cross product divided by the length
+        cross = ((east - aEast) * segmentNorth) - ((north - aNorth) * segmentEast);
+        if (cross < 0) {
+            cross = -cross;
+        }
+        isNear = cross / squareRoot(lengthSquared) < distance;
+    }
+
+    return isNear;
+}
+
+// Work out whether a position is inside a fence by at least the
+// hysteresis distance, outside it by at least the hysteresis
+// distance, or neither, returning 1, -1 or 0 respectively.
+static int32_t where(const uGnssGeofenceFence_t *pFence,
+                     int32_t latitudeX1e7, int32_t longitudeX1e7,
+                     int32_t hysteresisMillimetres)
+{
+    int32_t where = -1;
+    int64_t latitude = (int64_t) latitudeX1e7 - pFence->latitudeX1e7;
+    int64_t longitude = longitudeDifference(longitudeX1e7, pFence->longitudeX1e7);
+    int64_t east;
+    int64_t north;
+    int64_t x;
+    int64_t aEast;
+    int64_t aNorth;
+    int64_t bEast;
+    int64_t bNorth;
+    bool inside = false;
+
+    if ((latitude >= pFence->latitudeLowX1e7) && (latitude <= pFence->latitudeHighX1e7) &&
+        (longitude >= pFence->longitudeLowX1e7) && (longitude <= pFence->longitudeHighX1e7)) {
+        // Inside the bounding box: need to look properly
+        project(pFence, latitudeX1e7, longitudeX1e7, &east, &north);
+        if (pFence->numVertices == 0) {
+            // A circle: compare the squared distance from the middle
+            x = (east * east) + (north * north);
+            if ((pFence->radiusMillimetres >= hysteresisMillimetres) &&
+                (x <= ((int64_t) pFence->radiusMillimetres - hysteresisMillimetres) *
+                 ((int64_t) pFence->radiusMillimetres - hysteresisMillimetres))) {
+                where = 1;
+            } else if (x <= ((int64_t) pFence->radiusMillimetres + hysteresisMillimetres) *
+                       ((int64_t) pFence->radiusMillimetres + hysteresisMillimetres)) {
+                where = 0;
+            }
+        } else {
+            // A polygon: count the edges crossed by a line heading
+            // east from the position and, at the same time, check
+            // whether the position is within the hysteresis distance
+            // of any of them
+            where = 1;
+            aEast = pFence->pVertex[(pFence->numVertices - 1) * 2];
+            aNorth = pFence->pVertex[((pFence->numVertices - 1) * 2) + 1];
+            for (size_t v = 0; v < pFence->numVertices; v++) {
+                bEast = pFence->pVertex[v * 2];
+                bNorth = pFence->pVertex[(v * 2) + 1];
+                if ((aNorth > north) != (bNorth > north)) {
+                    // The edge spans the northing of the position: is
+                    // the crossing point to the east of the position?
+                    x = (bEast - aEast) * (north - aNorth);
+                    if (((bNorth > aNorth) && ((east - aEast) * (bNorth - aNorth) < x)) ||
+                        ((bNorth < aNorth) && ((east - aEast) * (bNorth - aNorth) > x))) {
+                        inside = !inside;
+                    }
+                }
+                if ((where != 0) && (hysteresisMillimetres > 0) &&
+                    isNearSegment(east, north, aEast, aNorth, bEast, bNorth,
+                                  hysteresisMillimetres)) {
+                    where = 0;
+                }
+                aEast = bEast;
+                aNorth = bNorth;
+            }
+            if ((where != 0) && !inside) {
+                where = -1;
+            }
+        }
+    }
+
+    return where;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: GRID
+ * -------------------------------------------------------------- */
+
+// Get the grid cell of a latitude.
+static int32_t cellLatitude(int64_t latitudeX1e7)
+{
+    if (latitudeX1e7 < -U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7) {
+        latitudeX1e7 = -U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7;
+    } else if (latitudeX1e7 > U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7) {
+        latitudeX1e7 = U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7;
+    }
+
+    return (int32_t) ((latitudeX1e7 + U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7) /
+                      U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7);
+}
+
+// Get the grid cell of a longitude, which may be out of range.
+static int32_t cellLongitude(int64_t longitudeX1e7)
+{
+    longitudeX1e7 += U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7;
+    while (longitudeX1e7 < 0) {
+        longitudeX1e7 += 2LL * U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7;
+    }
+    while (longitudeX1e7 >= 2LL * U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7) {
+        longitudeX1e7 -= 2LL * U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7;
+    }
+
+    return (int32_t) (longitudeX1e7 / U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7);
+}
+
+// Get the bucket for a grid cell.
+static size_t bucket(int32_t cellLatitude, int32_t cellLongitude)
+{
+    return (((uint32_t) cellLatitude * 73856093UL) ^
+            ((uint32_t) cellLongitude * 19349663UL)) % U_GNSS_GEOFENCE_GRID_NUM_BUCKETS;
+}
+
+// Remove all the grid entries of a fence.
+static void gridRemove(uGnssGeofence_t *pGeofence,
+                       const uGnssGeofenceFence_t *pFence)
+{
+    uGnssGeofenceCell_t **ppCell;
+    uGnssGeofenceCell_t *pCell;
+
+    for (size_t x = 0; x < sizeof(pGeofence->pBucket) / sizeof(pGeofence->pBucket[0]); x++) {
+        ppCell = &(pGeofence->pBucket[x]);
+        while (*ppCell != NULL) {
+            pCell = *ppCell;
+            if (pCell->pFence == pFence) {
+                *ppCell = pCell->pNext;
+                uPortFree(pCell);
+            } else {
+                ppCell = &(pCell->pNext);
+            }
+        }
+    }
+}
+
+// Add a fence to the grid or, if it is too big, to the list of
+// unindexed fences, which is also where it goes if we are out of
+// memory.
+static void gridAdd(uGnssGeofence_t *pGeofence, uGnssGeofenceFence_t *pFence)
+{
+    int32_t latitudeStart = cellLatitude((int64_t) pFence->latitudeX1e7 +
+                                         pFence->latitudeLowX1e7);
+    int32_t latitudeEnd = cellLatitude((int64_t) pFence->latitudeX1e7 +
+                                       pFence->latitudeHighX1e7);
+    int32_t longitudeStart = cellLongitude((int64_t) pFence->longitudeX1e7 +
+                                           pFence->longitudeLowX1e7);
+    int32_t numLongitude = (int32_t) ((((int64_t) pFence->longitudeHighX1e7 -
+                                        pFence->longitudeLowX1e7) /
+                                       U_GNSS_GEOFENCE_GRID_CELL_SIZE_X1E7) + 2);
+    uGnssGeofenceCell_t *pCell;
+    size_t index;
+
+    if (numLongitude > U_GNSS_GEOFENCE_GRID_NUM_CELLS_LONGITUDE) {
+        numLongitude = U_GNSS_GEOFENCE_GRID_NUM_CELLS_LONGITUDE;
+    }
+    pFence->indexed = ((int64_t) (latitudeEnd - latitudeStart + 1) * numLongitude <=
+                       U_GNSS_GEOFENCE_GRID_MAX_CELLS_PER_FENCE);
+    for (int32_t y = latitudeStart; (y <= latitudeEnd) && pFence->indexed; y++) {
+        for (int32_t x = 0; (x < numLongitude) && pFence->indexed; x++) {
+            pCell = (uGnssGeofenceCell_t *) pUPortMalloc(sizeof(*pCell));
+            if (pCell != NULL) {
+                pCell->cellLatitude = y;
+                pCell->cellLongitude = (longitudeStart + x) % U_GNSS_GEOFENCE_GRID_NUM_CELLS_LONGITUDE;
+                pCell->pFence = pFence;
+                index = bucket(pCell->cellLatitude, pCell->cellLongitude);
+                pCell->pNext = pGeofence->pBucket[index];
+                pGeofence->pBucket[index] = pCell;
+            } else {
+                // Can't index it, fall back to checking it every time
+                gridRemove(pGeofence, pFence);
+                pFence->indexed = false;
+            }
+        }
+    }
+    if (!pFence->indexed) {
+        pFence->pNextUnindexed = pGeofence->pUnindexedList;
+        pGeofence->pUnindexedList = pFence;
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: MISC
+ * -------------------------------------------------------------- */
+
+// Find a fence.
+static uGnssGeofenceFence_t *pFenceFind(const uGnssGeofence_t *pGeofence,
+                                        int32_t fenceId)
+{
+    uGnssGeofenceFence_t *pFence = pGeofence->pFenceList;
+
+    while ((pFence != NULL) && (pFence->id != fenceId)) {
+        pFence = pFence->pNext;
+    }
+
+    return pFence;
+}
+
+// Remove a fence from a singly-linked list, where pNext is at
+// the given offset in uGnssGeofenceFence_t.
+static void listRemove(uGnssGeofenceFence_t **ppList,
+                       const uGnssGeofenceFence_t *pFence,
+                       size_t nextOffset)
+{
+    uGnssGeofenceFence_t **ppNext;
+
+    while (*ppList != NULL) {
+        ppNext = (uGnssGeofenceFence_t **) (((char *) *ppList) + nextOffset);
+        if (*ppList == pFence) {
+            *ppList = *ppNext;
+        } else {
+            ppList = ppNext;
+        }
+    }
+}
+
+// Allocate a fence with room for numVertices and fill in the
+// common parts; latitude and longitude are those of the reference
+// point.
+static uGnssGeofenceFence_t *pFenceAlloc(int32_t fenceId,
+                                         int32_t latitudeX1e7,
+                                         int32_t longitudeX1e7,
+                                         size_t numVertices)
+{
+    uGnssGeofenceFence_t *pFence;
+
+    pFence = (uGnssGeofenceFence_t *) pUPortMalloc(sizeof(*pFence) +
+                                                   (numVertices * 2 * sizeof(int32_t)));
+    if (pFence != NULL) {
+        memset(pFence, 0, sizeof(*pFence));
+        pFence->id = fenceId;
+        pFence->latitudeX1e7 = latitudeX1e7;
+        pFence->longitudeX1e7 = longitudeX1e7;
+        pFence->cosX1000 = cosX1000(latitudeX1e7);
+        if (pFence->cosX1000 < U_GNSS_GEOFENCE_MIN_COS_X1000) {
+            pFence->cosX1000 = U_GNSS_GEOFENCE_MIN_COS_X1000;
+        }
+        pFence->numVertices = numVertices;
+        if (numVertices > 0) {
+            pFence->pVertex = (int32_t *) (pFence + 1);
+        }
+    }
+
+    return pFence;
+}
+
+// Set the bounding box of a fence from its extent in millimetres
+// and add it to the set; pGeofence->mutex must be locked.
+static void fenceAdd(uGnssGeofence_t *pGeofence, uGnssGeofenceFence_t *pFence,
+                     int64_t westMillimetres, int64_t eastMillimetres,
+                     int64_t southMillimetres, int64_t northMillimetres)
+{
+    int64_t hysteresis = pGeofence->hysteresisMillimetres;
+
+    pFence->latitudeLowX1e7 = (int32_t) millimetresToLatitudeX1e7(southMillimetres - hysteresis);
+    pFence->latitudeHighX1e7 = (int32_t) millimetresToLatitudeX1e7(northMillimetres + hysteresis);
+    pFence->longitudeLowX1e7 = (int32_t) millimetresToLongitudeX1e7(pFence,
+                                                                    westMillimetres - hysteresis);
+    pFence->longitudeHighX1e7 = (int32_t) millimetresToLongitudeX1e7(pFence,
+                                                                     eastMillimetres + hysteresis);
+    pFence->pNext = pGeofence->pFenceList;
+    pGeofence->pFenceList = pFence;
+    gridAdd(pGeofence, pFence);
+}
+
+// Check a position against a fence and report any event;
+// pGeofence->mutex must be locked.
+static int32_t check(uGnssGeofence_t *pGeofence, uGnssGeofenceFence_t *pFence,
+                     uDeviceHandle_t gnssHandle,
+                     int32_t latitudeX1e7, int32_t longitudeX1e7)
+{
+    int32_t numEvents = 0;
+    int32_t x;
+
+    pFence->checkCount = pGeofence->checkCount;
+    x = where(pFence, latitudeX1e7, longitudeX1e7, pGeofence->hysteresisMillimetres);
+    if (!pFence->inside && (x > 0)) {
+        pFence->inside = true;
+        pFence->pNextInside = pGeofence->pInsideList;
+        pGeofence->pInsideList = pFence;
+        pGeofence->pCallback(gnssHandle, pFence->id, U_GNSS_GEOFENCE_EVENT_ENTER,
+                             latitudeX1e7, longitudeX1e7, pGeofence->pCallbackParam);
+        numEvents++;
+    } else if (pFence->inside && (x < 0)) {
+        pFence->inside = false;
+        listRemove(&(pGeofence->pInsideList), pFence,
+                   offsetof(uGnssGeofenceFence_t, pNextInside));
+        pGeofence->pCallback(gnssHandle, pFence->id, U_GNSS_GEOFENCE_EVENT_EXIT,
+                             latitudeX1e7, longitudeX1e7, pGeofence->pCallbackParam);
+        numEvents++;
+    }
+
+    return numEvents;
+}
+
+// Return true if a latitude/longitude is valid.
+static bool isValid(int32_t latitudeX1e7, int32_t longitudeX1e7)
+{
+    return (latitudeX1e7 >= -U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7) &&
+           (latitudeX1e7 <= U_GNSS_GEOFENCE_LATITUDE_MAX_X1E7) &&
+           (longitudeX1e7 >= -U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7) &&
+           (longitudeX1e7 <= U_GNSS_GEOFENCE_LONGITUDE_MAX_X1E7);
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Create a set of fences.
+uGnssGeofence_t *pUGnssGeofenceCreate(int32_t hysteresisMillimetres,
+                                      uGnssGeofenceCallback_t pCallback,
+                                      void *pCallbackParam)
+{
+    uGnssGeofence_t *pGeofence = NULL;
+
+    if ((hysteresisMillimetres >= 0) &&
+        (hysteresisMillimetres < U_GNSS_GEOFENCE_MAX_SIZE_MILLIMETRES) &&
+        (pCallback != NULL)) {
+        pGeofence = (uGnssGeofence_t *) pUPortMalloc(sizeof(*pGeofence));
+        if (pGeofence != NULL) {
+            memset(pGeofence, 0, sizeof(*pGeofence));
+            if (uPortMutexCreate(&(pGeofence->mutex)) == 0) {
+                pGeofence->hysteresisMillimetres = hysteresisMillimetres;
+                pGeofence->pCallback = pCallback;
+                pGeofence->pCallbackParam = pCallbackParam;
+            } else {
+                uPortFree(pGeofence);
+                pGeofence = NULL;
+            }
+        }
+    }
+
+    return pGeofence;
+}
+
+// Free a set of fences.
+void uGnssGeofenceFree(uGnssGeofence_t *pGeofence)
+{
+    uGnssGeofenceFence_t *pFence;
+    uGnssGeofenceCell_t *pCell;
+
+    if (pGeofence != NULL) {
+        for (size_t x = 0; x < sizeof(pGeofence->pBucket) / sizeof(pGeofence->pBucket[0]); x++) {
+            while (pGeofence->pBucket[x] != NULL) {
+                pCell = pGeofence->pBucket[x];
+                pGeofence->pBucket[x] = pCell->pNext;
+                uPortFree(pCell);
+            }
+        }
+        while (pGeofence->pFenceList != NULL) {
+            pFence = pGeofence->pFenceList;
+            pGeofence->pFenceList = pFence->pNext;
+            uPortFree(pFence);
+        }
+        uPortMutexDelete(pGeofence->mutex);
+        uPortFree(pGeofence);
+    }
+}
+
+// Add a circular fence.
+int32_t uGnssGeofenceAddCircle(uGnssGeofence_t *pGeofence, int32_t fenceId,
+                               int32_t latitudeX1e7, int32_t longitudeX1e7,
+                               int32_t radiusMillimetres)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uGnssGeofenceFence_t *pFence;
+
+    if ((pGeofence != NULL) && isValid(latitudeX1e7, longitudeX1e7) &&
+        (radiusMillimetres > 0)) {
+
+        U_PORT_MUTEX_LOCK(pGeofence->mutex);
+
+        if ((pFenceFind(pGeofence, fenceId) == NULL) &&
+            ((int64_t) radiusMillimetres + pGeofence->hysteresisMillimetres <=
+             U_GNSS_GEOFENCE_MAX_SIZE_MILLIMETRES)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            pFence = pFenceAlloc(fenceId, latitudeX1e7, longitudeX1e7, 0);
+            if (pFence != NULL) {
+                pFence->radiusMillimetres = radiusMillimetres;
+                fenceAdd(pGeofence, pFence, -radiusMillimetres, radiusMillimetres,
+                         -radiusMillimetres, radiusMillimetres);
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pGeofence->mutex);
+    }
+
+    return errorCode;
+}
+
+// Add a polygonal fence.
+int32_t uGnssGeofenceAddPolygon(uGnssGeofence_t *pGeofence, int32_t fenceId,
+                                const int32_t *pLatitudeX1e7,
+                                const int32_t *pLongitudeX1e7,
+                                size_t numVertices)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uGnssGeofenceFence_t *pFence;
+    int64_t east;
+    int64_t north;
+    int64_t west = 0;
+    int64_t eastMost = 0;
+    int64_t south = 0;
+    int64_t northMost = 0;
+    int64_t limit;
+    bool valid = (pGeofence != NULL) && (pLatitudeX1e7 != NULL) &&
+                 (pLongitudeX1e7 != NULL) && (numVertices >= 3);
+
+    for (size_t x = 0; valid && (x < numVertices); x++) {
+        valid = isValid(*(pLatitudeX1e7 + x), *(pLongitudeX1e7 + x));
+    }
+    if (valid) {
+
+        U_PORT_MUTEX_LOCK(pGeofence->mutex);
+
+        if (pFenceFind(pGeofence, fenceId) == NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            pFence = pFenceAlloc(fenceId, *pLatitudeX1e7, *pLongitudeX1e7, numVertices);
+            if (pFence != NULL) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                limit = U_GNSS_GEOFENCE_MAX_SIZE_MILLIMETRES - pGeofence->hysteresisMillimetres;
+                for (size_t x = 0; (x < numVertices) && (errorCode == 0); x++) {
+                    project(pFence, *(pLatitudeX1e7 + x), *(pLongitudeX1e7 + x),
+                            &east, &north);
+                    if ((east < -limit) || (east > limit) ||
+                        (north < -limit) || (north > limit)) {
+                        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+                    }
+                    *(pFence->pVertex + (x * 2)) = (int32_t) east;
+                    *(pFence->pVertex + (x * 2) + 1) = (int32_t) north;
+                    if (east < west) {
+                        west = east;
+                    }
+                    if (east > eastMost) {
+                        eastMost = east;
+                    }
+                    if (north < south) {
+                        south = north;
+                    }
+                    if (north > northMost) {
+                        northMost = north;
+                    }
+                }
+                if (errorCode == 0) {
+                    fenceAdd(pGeofence, pFence, west, eastMost, south, northMost);
+                } else {
+                    uPortFree(pFence);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pGeofence->mutex);
+    }
+
+    return errorCode;
+}
+
+// Remove a fence.
+int32_t uGnssGeofenceRemove(uGnssGeofence_t *pGeofence, int32_t fenceId)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uGnssGeofenceFence_t *pFence;
+
+    if (pGeofence != NULL) {
+
+        U_PORT_MUTEX_LOCK(pGeofence->mutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+        pFence = pFenceFind(pGeofence, fenceId);
+        if (pFence != NULL) {
+            listRemove(&(pGeofence->pFenceList), pFence,
+                       offsetof(uGnssGeofenceFence_t, pNext));
+            listRemove(&(pGeofence->pUnindexedList), pFence,
+                       offsetof(uGnssGeofenceFence_t, pNextUnindexed));
+            listRemove(&(pGeofence->pInsideList), pFence,
+                       offsetof(uGnssGeofenceFence_t, pNextInside));
+            gridRemove(pGeofence, pFence);
+            uPortFree(pFence);
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pGeofence->mutex);
+    }
+
+    return errorCode;
+}
+
+// Get whether we're inside a fence.
+int32_t uGnssGeofenceIsInside(const uGnssGeofence_t *pGeofence,
+                              int32_t fenceId)
+{
+    int32_t errorCodeOrInside = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    const uGnssGeofenceFence_t *pFence;
+
+    if (pGeofence != NULL) {
+
+        U_PORT_MUTEX_LOCK(pGeofence->mutex);
+
+        errorCodeOrInside = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+        pFence = pFenceFind(pGeofence, fenceId);
+        if (pFence != NULL) {
+            errorCodeOrInside = pFence->inside ? 1 : 0;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pGeofence->mutex);
+    }
+
+    return errorCodeOrInside;
+}
+
+// Check a position against a set of fences.
+int32_t uGnssGeofenceUpdate(uGnssGeofence_t *pGeofence,
+                            uDeviceHandle_t gnssHandle,
+                            int32_t latitudeX1e7,
+                            int32_t longitudeX1e7)
+{
+    int32_t errorCodeOrEvents = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    int32_t y;
+    int32_t x;
+    uGnssGeofenceCell_t *pCell;
+    uGnssGeofenceFence_t *pFence;
+    uGnssGeofenceFence_t *pNext;
+
+    if ((pGeofence != NULL) && isValid(latitudeX1e7, longitudeX1e7)) {
+
+        U_PORT_MUTEX_LOCK(pGeofence->mutex);
+
+        errorCodeOrEvents = 0;
+        pGeofence->checkCount++;
+        // First, the fences in the cell of the grid that the
+        // position is in
+        y = cellLatitude(latitudeX1e7);
+        x = cellLongitude(longitudeX1e7);
+        pCell = pGeofence->pBucket[bucket(y, x)];
+        while (pCell != NULL) {
+            if ((pCell->cellLatitude == y) && (pCell->cellLongitude == x)) {
+                errorCodeOrEvents += check(pGeofence, pCell->pFence, gnssHandle,
+                                           latitudeX1e7, longitudeX1e7);
+            }
+            pCell = pCell->pNext;
+        }
+        // Next, the fences that are too big to be in the grid
+        pFence = pGeofence->pUnindexedList;
+        while (pFence != NULL) {
+            errorCodeOrEvents += check(pGeofence, pFence, gnssHandle,
+                                       latitudeX1e7, longitudeX1e7);
+            pFence = pFence->pNextUnindexed;
+        }
+        // Finally, any fences that we were inside and haven't just
+        // checked: we must now be outside their bounding box
+        pFence = pGeofence->pInsideList;
+        while (pFence != NULL) {
+            pNext = pFence->pNextInside;
+            if (pFence->checkCount != pGeofence->checkCount) {
+                errorCodeOrEvents += check(pGeofence, pFence, gnssHandle,
+                                           latitudeX1e7, longitudeX1e7);
+            }
+            pFence = pNext;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pGeofence->mutex);
+    }
+
+    return errorCodeOrEvents;
+}
+
+// Attach a set of fences to a GNSS instance.
+int32_t uGnssGeofenceAttach(uDeviceHandle_t gnssHandle,
+                            uGnssGeofence_t *pGeofence)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            if (pInstance->pMsgReceive != NULL) {
+                // The streamed position callback, which is what uses
+                // pGeofence, is called with the reader mutex locked,
+                // so locking it here means that the old set of fences
+                // is no longer in use once we have swapped it over
+                U_PORT_MUTEX_LOCK(pInstance->pMsgReceive->readerMutexHandle);
+                pInstance->pGeofence = pGeofence;
+                U_PORT_MUTEX_UNLOCK(pInstance->pMsgReceive->readerMutexHandle);
+            } else {
+                pInstance->pGeofence = pGeofence;
+            }
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// End of file
@@ -35,6 +35,7 @@
 #include "stdbool.h"
 #include "string.h"    // memcpy()
 
+#include "u_cfg_os_platform_specific.h" // U_CFG_OS_YIELD_MS
 #include "u_cfg_sw.h"
 #include "u_error_common.h"
 
@@ -44,6 +45,7 @@
 #include "u_port_debug.h"
 
 #include "u_time.h"
+#include "u_time_sync.h"
 
 #include "u_at_client.h"
 
@@ -65,6 +67,13 @@
  */
 #define U_GNSS_INFO_MESSAGE_BODY_LENGTH_UBX_MON_COMMS (8 + (40 * U_GNSS_PORT_MAX_NUM))
 
+#ifndef U_GNSS_INFO_COMMS_SAMPLER_TASK_PRIORITY
+/** The priority of the MON-COMMS sampler task: below that of the
+ * message receive task, which it relies upon to get its answers.
+ */
+# define U_GNSS_INFO_COMMS_SAMPLER_TASK_PRIORITY (U_CFG_OS_PRIORITY_MAX - 6)
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -77,6 +86,223 @@
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Get the communication stats as seen by the GNSS chip: the guts
+// of uGnssInfoGetCommunicationStats(), gUGnssPrivateMutex must be
+// locked.
+static int32_t getCommunicationStats(uGnssPrivateInstance_t *pInstance,
+                                     int32_t port,
+                                     uGnssCommunicationStats_t *pStats)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+    char *pMessage;
+    int32_t messageLength;
+    int32_t numPorts = -1;
+    int32_t protocolId;
+
+    // TODO: fix this properly with versioned UBX messaging later
+    if (pInstance->pModule->moduleType >= U_GNSS_MODULE_TYPE_M9) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        // Message big enough to store UBX-MON-COMMS with max port numbers
+        pMessage = (char *) pUPortMalloc(U_GNSS_INFO_MESSAGE_BODY_LENGTH_UBX_MON_COMMS);
+        if (pMessage != NULL) {
+            if (port < 0) {
+                port = (int32_t) pInstance->portNumber;
+            }
+            // Note: the if() condition below is present to allow future
+            // values, or new and interesting values, to be passed transparently
+            // to this function.
+            if (port < U_GNSS_PORT_MAX_NUM) {
+                // The encoding of the port number in this message is _different_
+                // to that in UBX-CFG-PORT - here it is, adopting the form used
+                // in the system integration manuals, which is AFTER endian
+                // conversion:
+                //
+                // 0 ==> 0x0000 I2C
+                // 1 ==> 0x0100 UART1
+                // 2 ==> 0x0201 UART2
+                // 3 ==> 0x0300 USB
+                // 4 ==> 0x0400 SPI
+                //
+                // This is because there are additional UARTs internal to the
+                // GNSS device which need to be accounted for.  The ones listed
+                // above are those that may be connected to a host MCU, but note
+                // that others (e.g. 0x0101) may appear in the output of
+                // UBX-MON-COMMS, which we will ignore.
+                port = ((uint32_t) port) << 8;
+                if (port == (((uint32_t) U_GNSS_PORT_UART2) << 8)) {
+                    port++;
+                }
+            }
+            // Poll with the message class and ID of the UBX-MON-COMMS command
+            errorCode = uGnssPrivateSendReceiveUbxMessage(pInstance,
+                                                          0x0a, 0x36,
+                                                          NULL, 0, pMessage,
+                                                          U_GNSS_INFO_MESSAGE_BODY_LENGTH_UBX_MON_COMMS);
+            if (errorCode >= 0) {
+                messageLength = errorCode;
+                if ((messageLength >= 2) && (*pMessage == 0)) {
+                    // Have a message in a version we understand;
+                    // get the number of ports reported in it
+                    numPorts = *(pMessage + 1);
+                }
+                errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+                if ((numPorts > 0) && (messageLength >= 8 + (numPorts * 40))) {
+                    // The message has some ports in it and is of the correct
+                    // length for that number of ports; run through the
+                    // message in blocks of 40 bytes, the length of the
+                    // report for one port being 40 bytes, after the initial
+                    // 8 bytes, to find the report for our port number
+                    for (int32_t offset = 0; (8 + offset < messageLength) &&
+                         (errorCode != (int32_t) U_ERROR_COMMON_SUCCESS); offset += 40) {
+                        // No endian conversion here as port is already endian converted
+                        if (*(uint16_t *) (pMessage + 8 + offset) == port) {
+                            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                            if (pStats != NULL) {
+                                pStats->txPendingBytes = uUbxProtocolUint16Decode(pMessage + 10 + offset);
+                                pStats->txBytes = uUbxProtocolUint32Decode(pMessage + 12 + offset);
+                                pStats->txPercentageUsage = *(pMessage + 16 + offset);
+                                pStats->txPeakPercentageUsage = *(pMessage + 17 + offset);
+                                pStats->rxPendingBytes = uUbxProtocolUint16Decode(pMessage + 18 + offset);
+                                pStats->rxBytes = uUbxProtocolUint32Decode(pMessage + 20 + offset);
+                                pStats->rxPercentageUsage = *(pMessage + 24 + offset);
+                                pStats->rxPeakPercentageUsage = *(pMessage + 25 + offset);
+                                pStats->rxOverrunErrors = uUbxProtocolUint16Decode(pMessage + 26 + offset);
+                                // The number of messages parsed is in the array which follows
+                                // based on the array of protocol IDs way back at the start
+                                // of the message in byte 4
+                                for (size_t x = 0; x < sizeof(pStats->rxNumMessages) / sizeof(pStats->rxNumMessages[0]); x++) {
+                                    pStats->rxNumMessages[x] = -1;
+                                }
+                                for (size_t x = 0; x < 4; x++) {
+                                    protocolId = *(pMessage + 4 + x);
+                                    if ((protocolId >= 0) &&
+                                        (protocolId < sizeof(pStats->rxNumMessages) / sizeof(pStats->rxNumMessages[0]))) {
+                                        pStats->rxNumMessages[protocolId] = uUbxProtocolUint16Decode(pMessage + 28 + offset + (x * 2));
+                                    }
+                                }
+                                pStats->rxSkippedBytes = uUbxProtocolUint32Decode(pMessage + 44 + offset);
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Free memory
+            uPortFree(pMessage);
+        }
+    }
+
+    return errorCode;
+}
+
+// The change in a counter, taking it as having been reset if it
+// has gone backwards.
+static size_t counterDelta(size_t previous, size_t now)
+{
+    size_t delta = now;
+
+    if (now >= previous) {
+        delta = now - previous;
+    }
+
+    return delta;
+}
+
+// Take a sample for the MON-COMMS sampler, updating the deltas;
+// gUGnssPrivateMutex must be locked.
+static int32_t commsSample(uGnssPrivateCommsSampler_t *pCommsSampler)
+{
+    int32_t errorCode;
+    uGnssPrivateInstance_t *pInstance = pCommsSampler->pInstance;
+    uGnssInfoCommsSample_t *pSample = pCommsSampler->pSample;
+    uGnssCommunicationStats_t stats;
+    size_t hostLossBytes;
+
+    errorCode = getCommunicationStats(pInstance, pCommsSampler->port, &stats);
+    if (errorCode == 0) {
+        // The same as uGnssMsgReceiveStatStreamLoss()
+        hostLossBytes = uRingBufferStatAddLoss(&(pInstance->ringBuffer));
+        if (pInstance->pSpiRingBuffer != NULL) {
+            hostLossBytes += uRingBufferStatAddLoss(pInstance->pSpiRingBuffer);
+        }
+        if (pSample->numSamples > 0) {
+            pSample->rxOverrunErrorsDelta = counterDelta(pSample->stats.rxOverrunErrors,
+                                                         stats.rxOverrunErrors);
+            pSample->rxSkippedBytesDelta = counterDelta(pSample->stats.rxSkippedBytes,
+                                                        stats.rxSkippedBytes);
+            pSample->hostLossBytesDelta = counterDelta(pSample->hostLossBytes,
+                                                       hostLossBytes);
+            for (size_t x = 0; x < sizeof(stats.rxNumMessages) / sizeof(stats.rxNumMessages[0]); x++) {
+                pSample->rxNumMessagesDelta[x] = -1;
+                if ((stats.rxNumMessages[x] >= 0) && (pSample->stats.rxNumMessages[x] >= 0)) {
+                    pSample->rxNumMessagesDelta[x] = (int32_t) counterDelta((size_t) pSample->stats.rxNumMessages[x],
+                                                                            (size_t) stats.rxNumMessages[x]);
+                }
+            }
+        } else {
+            pSample->rxOverrunErrorsDelta = 0;
+            pSample->rxSkippedBytesDelta = 0;
+            pSample->hostLossBytesDelta = 0;
+            for (size_t x = 0; x < sizeof(stats.rxNumMessages) / sizeof(stats.rxNumMessages[0]); x++) {
+                pSample->rxNumMessagesDelta[x] = -1;
+                if (stats.rxNumMessages[x] >= 0) {
+                    pSample->rxNumMessagesDelta[x] = 0;
+                }
+            }
+        }
+        pSample->stats = stats;
+        pSample->hostLossBytes = hostLossBytes;
+        pSample->timeMs = uPortGetTickTimeMs();
+        pSample->numSamples++;
+    }
+
+    return errorCode;
+}
+
+// The MON-COMMS sampler task.
+static void commsSamplerTask(void *pParameters)
+{
+    uGnssPrivateCommsSampler_t *pCommsSampler = (uGnssPrivateCommsSampler_t *) pParameters;
+    uGnssInfoCommsSample_t sample;
+    uint32_t eventBitMap;
+    bool locked;
+
+    U_PORT_MUTEX_LOCK(pCommsSampler->taskRunningMutexHandle);
+
+    while (pCommsSampler->keepGoing) {
+        uPortSemaphoreTryTake(pCommsSampler->wakeSemaphoreHandle,
+                              pCommsSampler->intervalMs);
+        eventBitMap = 0;
+        // Don't block on gUGnssPrivateMutex: whoever has it locked
+        // may be waiting for this task to exit
+        locked = false;
+        while (pCommsSampler->keepGoing && !locked) {
+            locked = (uPortMutexTryLock(gUGnssPrivateMutex, U_CFG_OS_YIELD_MS) == 0);
+        }
+        if (locked) {
+            if (pCommsSampler->keepGoing &&
+                (commsSample(pCommsSampler) == 0) &&
+                (pCommsSampler->pCallback != NULL)) {
+                eventBitMap = uGnssInfoCommsCheck(pCommsSampler->pSample,
+                                                  pCommsSampler->pThresholds);
+                sample = *pCommsSampler->pSample;
+            }
+            uPortMutexUnlock(gUGnssPrivateMutex);
+        }
+        // Call the callback with nothing locked so that it
+        // may call into this API
+        if (eventBitMap != 0) {
+            pCommsSampler->pCallback(pCommsSampler->gnssHandle, eventBitMap,
+                                     &sample, pCommsSampler->pCallbackParam);
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(pCommsSampler->taskRunningMutexHandle);
+
+    // Delete ourself
+    uPortTaskDelete(NULL);
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -233,6 +459,8 @@ int64_t uGnssInfoGetTimeUtc(uDeviceHandle_t gnssHandle)
     char message[20];
     int32_t months;
     int32_t year;
+    int32_t startTimeMs;
+    int32_t endTimeMs;
 
     if (gUGnssPrivateMutex != NULL) {
 
@@ -241,6 +469,7 @@ int64_t uGnssInfoGetTimeUtc(uDeviceHandle_t gnssHandle)
         errorCodeOrTime = (int64_t) U_ERROR_COMMON_INVALID_PARAMETER;
         pInstance = pUGnssPrivateGetInstance(gnssHandle);
         if (pInstance != NULL) {
+            startTimeMs = uPortGetTickTimeMs();
             // Poll with the message class and ID of the UBX-NAV-TIMEUTC command
             errorCodeOrTime = uGnssPrivateSendReceiveUbxMessage(pInstance,
                                                                 0x01, 0x21,
@@ -267,6 +496,19 @@ int64_t uGnssInfoGetTimeUtc(uDeviceHandle_t gnssHandle)
                     // Second (0 to 60)
                     errorCodeOrTime += message[18];
 
+                    // Let the time service know: a polled UBX-NAV-TIMEUTC
+                    // carries the time of the last navigation epoch, which may
+                    // be up to a second old, so take it to be half a second
+                    // old, accurate to half a second plus tAcc plus however
+                    // long the poll took
+                    endTimeMs = uPortGetTickTimeMs();
+                    uTimeSyncFeed(U_TIME_SYNC_SOURCE_GNSS,
+                                  (errorCodeOrTime * 1000000000) +
+                                  (int32_t) uUbxProtocolUint32Decode(message + 8) + 500000000,
+                                  uUbxProtocolUint32Decode(message + 4) + 500000000 +
+                                  ((int64_t) (endTimeMs - startTimeMs) * 1000000),
+                                  endTimeMs);
+
                     uPortLog("U_GNSS_POS: UTC time is %d.\n", (int32_t) errorCodeOrTime);
                 }
             }
@@ -285,10 +527,6 @@ int32_t uGnssInfoGetCommunicationStats(uDeviceHandle_t gnssHandle,
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uGnssPrivateInstance_t *pInstance;
-    char *pMessage;
-    int32_t messageLength;
-    int32_t numPorts = -1;
-    int32_t protocolId;
 
     if (gUGnssPrivateMutex != NULL) {
 
@@ -297,97 +535,118 @@ int32_t uGnssInfoGetCommunicationStats(uDeviceHandle_t gnssHandle,
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         pInstance = pUGnssPrivateGetInstance(gnssHandle);
         if (pInstance != NULL) {
+            errorCode = getCommunicationStats(pInstance, port, pStats);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Start sampling the communication stats in the background.
+int32_t uGnssInfoCommsSamplerStart(uDeviceHandle_t gnssHandle,
+                                   int32_t port, int32_t intervalMs,
+                                   const uGnssInfoCommsThresholds_t *pThresholds,
+                                   uGnssInfoCommsCallback_t pCallback,
+                                   void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateCommsSampler_t *pCommsSampler;
+    uGnssInfoCommsThresholds_t thresholdsDefault = U_GNSS_INFO_COMMS_THRESHOLDS_DEFAULTS;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) &&
+            (intervalMs >= U_GNSS_INFO_COMMS_SAMPLER_INTERVAL_MIN_MS)) {
             errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
             // TODO: fix this properly with versioned UBX messaging later
             if (pInstance->pModule->moduleType >= U_GNSS_MODULE_TYPE_M9) {
-                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-                // Message big enough to store UBX-MON-COMMS with max port numbers
-                pMessage = (char *) pUPortMalloc(U_GNSS_INFO_MESSAGE_BODY_LENGTH_UBX_MON_COMMS);
-                if (pMessage != NULL) {
-                    if (port < 0) {
-                        port = (int32_t) pInstance->portNumber;
-                    }
-                    // Note: the if() condition below is present to allow future
-                    // values, or new and interesting values, to be passed transparently
-                    // to this function.
-                    if (port < U_GNSS_PORT_MAX_NUM) {
-                        // The encoding of the port number in this message is _different_
-                        // to that in UBX-CFG-PORT - here it is, adopting the form used
-                        // in the system integration manuals, which is AFTER endian
-                        // conversion:
-                        //
-                        // 0 ==> 0x0000 I2C
-                        // 1 ==> 0x0100 UART1
-                        // 2 ==> 0x0201 UART2
-                        // 3 ==> 0x0300 USB
-                        // 4 ==> 0x0400 SPI
-                        //
-                        // This is because there are additional UARTs internal to the
-                        // GNSS device which need to be accounted for.  The ones listed
-                        // above are those that may be connected to a host MCU, but note
-                        // that others (e.g. 0x0101) may appear in the output of
-                        // UBX-MON-COMMS, which we will ignore.
-                        port = ((uint32_t) port) << 8;
-                        if (port == (((uint32_t) U_GNSS_PORT_UART2) << 8)) {
-                            port++;
-                        }
-                    }
-                    // Poll with the message class and ID of the UBX-MON-COMMS command
-                    errorCode = uGnssPrivateSendReceiveUbxMessage(pInstance,
-                                                                  0x0a, 0x36,
-                                                                  NULL, 0, pMessage,
-                                                                  U_GNSS_INFO_MESSAGE_BODY_LENGTH_UBX_MON_COMMS);
-                    if (errorCode >= 0) {
-                        messageLength = errorCode;
-                        if ((messageLength >= 2) && (*pMessage == 0)) {
-                            // Have a message in a version we understand;
-                            // get the number of ports reported in it
-                            numPorts = *(pMessage + 1);
+                errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                if (pInstance->pCommsSampler == NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    // One allocation: the context, the thresholds
+                    // and then the sample
+                    pCommsSampler = (uGnssPrivateCommsSampler_t *) pUPortMalloc(sizeof(*pCommsSampler) +
+                                                                                sizeof(uGnssInfoCommsThresholds_t) +
+                                                                                sizeof(uGnssInfoCommsSample_t));
+                    if (pCommsSampler != NULL) {
+                        memset(pCommsSampler, 0, sizeof(*pCommsSampler));
+                        pCommsSampler->gnssHandle = gnssHandle;
+                        pCommsSampler->pInstance = pInstance;
+                        pCommsSampler->port = port;
+                        pCommsSampler->intervalMs = intervalMs;
+                        pCommsSampler->pThresholds = (uGnssInfoCommsThresholds_t *) (pCommsSampler + 1);
+                        if (pThresholds == NULL) {
+                            pThresholds = &thresholdsDefault;
                         }
-                        errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
-                        if ((numPorts > 0) && (messageLength >= 8 + (numPorts * 40))) {
-                            // The message has some ports in it and is of the correct
-                            // length for that number of ports; run through the
-                            // message in blocks of 40 bytes, the length of the
-                            // report for one port being 40 bytes, after the initial
-                            // 8 bytes, to find the report for our port number
-                            for (int32_t offset = 0; (8 + offset < messageLength) &&
-                                 (errorCode != (int32_t) U_ERROR_COMMON_SUCCESS); offset += 40) {
-                                // No endian conversion here as port is already endian converted
-                                if (*(uint16_t *) (pMessage + 8 + offset) == port) {
-                                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                                    if (pStats != NULL) {
-                                        pStats->txPendingBytes = uUbxProtocolUint16Decode(pMessage + 10 + offset);
-                                        pStats->txBytes = uUbxProtocolUint32Decode(pMessage + 12 + offset);
-                                        pStats->txPercentageUsage = *(pMessage + 16 + offset);
-                                        pStats->txPeakPercentageUsage = *(pMessage + 17 + offset);
-                                        pStats->rxPendingBytes = uUbxProtocolUint16Decode(pMessage + 18 + offset);
-                                        pStats->rxBytes = uUbxProtocolUint32Decode(pMessage + 20 + offset);
-                                        pStats->rxPercentageUsage = *(pMessage + 24 + offset);
-                                        pStats->rxPeakPercentageUsage = *(pMessage + 25 + offset);
-                                        pStats->rxOverrunErrors = uUbxProtocolUint16Decode(pMessage + 26 + offset);
-                                        // The number of messages parsed is in the array which follows
-                                        // based on the array of protocol IDs way back at the start
-                                        // of the message in byte 4
-                                        for (size_t x = 0; x < sizeof(pStats->rxNumMessages) / sizeof(pStats->rxNumMessages[0]); x++) {
-                                            pStats->rxNumMessages[x] = -1;
-                                        }
-                                        for (size_t x = 0; x < 4; x++) {
-                                            protocolId = *(pMessage + 4 + x);
-                                            if ((protocolId >= 0) &&
-                                                (protocolId < sizeof(pStats->rxNumMessages) / sizeof(pStats->rxNumMessages[0]))) {
-                                                pStats->rxNumMessages[protocolId] = uUbxProtocolUint16Decode(pMessage + 28 + offset + (x * 2));
-                                            }
-                                        }
-                                        pStats->rxSkippedBytes = uUbxProtocolUint32Decode(pMessage + 44 + offset);
-                                    }
+                        *pCommsSampler->pThresholds = *pThresholds;
+                        pCommsSampler->pSample = (uGnssInfoCommsSample_t *) (pCommsSampler->pThresholds + 1);
+                        memset(pCommsSampler->pSample, 0, sizeof(*pCommsSampler->pSample));
+                        pCommsSampler->pCallback = pCallback;
+                        pCommsSampler->pCallbackParam = pCallbackParam;
+                        pCommsSampler->keepGoing = true;
+                        pInstance->pCommsSampler = pCommsSampler;
+                        if ((uPortSemaphoreCreate(&(pCommsSampler->wakeSemaphoreHandle), 0, 1) == 0) &&
+                            (uPortMutexCreate(&(pCommsSampler->taskRunningMutexHandle)) == 0)) {
+                            errorCode = uPortTaskCreate(commsSamplerTask, "gnssComms",
+                                                        U_GNSS_INFO_COMMS_SAMPLER_TASK_STACK_SIZE_BYTES,
+                                                        pCommsSampler,
+                                                        U_GNSS_INFO_COMMS_SAMPLER_TASK_PRIORITY,
+                                                        &(pCommsSampler->taskHandle));
+                            if (errorCode == 0) {
+                                // Wait for the task to lock the mutex,
+                                // which shows it is running
+                                while (uPortMutexTryLock(pCommsSampler->taskRunningMutexHandle, 0) == 0) {
+                                    uPortMutexUnlock(pCommsSampler->taskRunningMutexHandle);
+                                    uPortTaskBlock(U_CFG_OS_YIELD_MS);
                                 }
+                            } else {
+                                // So that the clean-up doesn't wait for it
+                                uPortMutexDelete(pCommsSampler->taskRunningMutexHandle);
+                                pCommsSampler->taskRunningMutexHandle = NULL;
                             }
                         }
+                        if (errorCode != 0) {
+                            // Clean up on error
+                            uGnssPrivateCleanUpCommsSampler(pInstance);
+                        }
                     }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get the latest sample taken by the background sampler.
+int32_t uGnssInfoCommsSamplerGet(uDeviceHandle_t gnssHandle,
+                                 uGnssInfoCommsSample_t *pSample)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
 
-                    // Free memory
-                    uPortFree(pMessage);
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pSample != NULL)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            if (pInstance->pCommsSampler != NULL) {
+                errorCode = (int32_t) U_ERROR_COMMON_EMPTY;
+                if (pInstance->pCommsSampler->pSample->numSamples > 0) {
+                    *pSample = *pInstance->pCommsSampler->pSample;
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                 }
             }
         }
@@ -398,5 +657,64 @@ int32_t uGnssInfoGetCommunicationStats(uDeviceHandle_t gnssHandle,
     return errorCode;
 }
 
+// Stop the background sampler.
+void uGnssInfoCommsSamplerStop(uDeviceHandle_t gnssHandle)
+{
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateCommsSampler_t *pCommsSampler = NULL;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pInstance->pCommsSampler != NULL)) {
+            pCommsSampler = pInstance->pCommsSampler;
+            pInstance->pCommsSampler = NULL;
+            pCommsSampler->keepGoing = false;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+
+        // Wait for the task to exit with gUGnssPrivateMutex
+        // unlocked, in case its callback is calling into this API
+        uGnssPrivateCommsSamplerFree(pCommsSampler);
+    }
+}
+
+// Check a sample against a set of thresholds.
+uint32_t uGnssInfoCommsCheck(const uGnssInfoCommsSample_t *pSample,
+                             const uGnssInfoCommsThresholds_t *pThresholds)
+{
+    uint32_t eventBitMap = 0;
+
+    if ((pSample != NULL) && (pThresholds != NULL)) {
+        if (pSample->stats.txPercentageUsage >= 100) {
+            eventBitMap |= 1UL << U_GNSS_INFO_COMMS_EVENT_TX_OVERFLOW;
+        }
+        if ((pThresholds->txPercentageUsage > 0) &&
+            (pSample->stats.txPercentageUsage >= (size_t) pThresholds->txPercentageUsage)) {
+            eventBitMap |= 1UL << U_GNSS_INFO_COMMS_EVENT_TX_USAGE;
+        }
+        if ((pThresholds->rxPercentageUsage > 0) &&
+            (pSample->stats.rxPercentageUsage >= (size_t) pThresholds->rxPercentageUsage)) {
+            eventBitMap |= 1UL << U_GNSS_INFO_COMMS_EVENT_RX_USAGE;
+        }
+        if ((pThresholds->rxOverrunErrors > 0) &&
+            (pSample->rxOverrunErrorsDelta >= (size_t) pThresholds->rxOverrunErrors)) {
+            eventBitMap |= 1UL << U_GNSS_INFO_COMMS_EVENT_RX_OVERRUN;
+        }
+        if ((pThresholds->rxSkippedBytes > 0) &&
+            (pSample->rxSkippedBytesDelta >= (size_t) pThresholds->rxSkippedBytes)) {
+            eventBitMap |= 1UL << U_GNSS_INFO_COMMS_EVENT_RX_SKIPPED;
+        }
+        if ((pThresholds->hostLossBytes > 0) &&
+            (pSample->hostLossBytesDelta >= (size_t) pThresholds->hostLossBytes)) {
+            eventBitMap |= 1UL << U_GNSS_INFO_COMMS_EVENT_HOST_LOSS;
+        }
+    }
+
+    return eventBitMap;
+}
 
 // End of file
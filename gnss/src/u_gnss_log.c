@@ -0,0 +1,367 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the message logging functions of the
+ * GNSS API.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+
+#include "u_at_client.h"
+
+#include "u_ringbuffer.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss_private.h"
+#include "u_gnss_msg.h"
+#include "u_gnss_msg_private.h"
+#include "u_gnss_log.h"
+
+#if U_GNSS_LOG_FILE_SUPPORTED
+# include "stdio.h"    // fopen(), fwrite(), fclose()
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_GNSS_LOG_TASK_PRIORITY
+/** The priority of the log task: below that of the message receive
+ * task, which must never wait for it.
+ */
+# define U_GNSS_LOG_TASK_PRIORITY (U_CFG_OS_PRIORITY_MAX - 6)
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Message receive callback: frame the message into the ring buffer.
+// This is called from the message receive task and is the only
+// producer for the ring buffer.
+static void messageCallback(uDeviceHandle_t gnssHandle,
+                            const uGnssMessageId_t *pMessageId,
+                            int32_t errorCodeOrLength,
+                            const char *pData1, size_t size1,
+                            const char *pData2, size_t size2,
+                            void *pCallbackParam)
+{
+    uGnssPrivateLog_t *pLog = (uGnssPrivateLog_t *) pCallbackParam;
+    char header[U_GNSS_LOG_RECORD_HEADER_LENGTH_BYTES];
+    size_t size = size1 + size2;
+    uint32_t tickTimeMs = (uint32_t) uPortGetTickTimeMs();
+
+    (void) gnssHandle;
+
+    if ((errorCodeOrLength > 0) && (size > 0) && (size <= 0xFFFF)) {
+        // Only the consumer frees space, so if the whole record fits
+        // now then all three of the adds below will succeed
+        if (uRingBufferAvailableSize(&(pLog->ringBuffer)) >= sizeof(header) + size) {
+            header[0] = (char) U_GNSS_LOG_RECORD_SYNC;
+            header[1] = (char) pMessageId->type;
+            header[2] = (char) (size & 0xFF);
+            header[3] = (char) (size >> 8);
+            header[4] = (char) (tickTimeMs & 0xFF);
+            header[5] = (char) ((tickTimeMs >> 8) & 0xFF);
+            header[6] = (char) ((tickTimeMs >> 16) & 0xFF);
+            header[7] = (char) (tickTimeMs >> 24);
+            uRingBufferAdd(&(pLog->ringBuffer), header, sizeof(header));
+            uRingBufferAdd(&(pLog->ringBuffer), pData1, size1);
+            if (size2 > 0) {
+                uRingBufferAdd(&(pLog->ringBuffer), pData2, size2);
+            }
+            if (uRingBufferDataSize(&(pLog->ringBuffer)) >= U_GNSS_LOG_WRITE_LENGTH_BYTES) {
+                uPortSemaphoreGive(pLog->wakeSemaphoreHandle);
+            }
+        } else {
+            pLog->lostCount++;
+        }
+    }
+}
+
+// Write out everything in the ring buffer, in large chunks.
+static void writeOut(uGnssPrivateLog_t *pLog)
+{
+    size_t size;
+
+    do {
+        size = uRingBufferRead(&(pLog->ringBuffer), pLog->pWriteBuffer,
+                               U_GNSS_LOG_WRITE_LENGTH_BYTES);
+        if (size > 0) {
+            pLog->pWriteCallback(pLog->gnssHandle, pLog->pWriteBuffer,
+                                 size, pLog->pWriteCallbackParam);
+        }
+    } while (size == U_GNSS_LOG_WRITE_LENGTH_BYTES);
+}
+
+// The log task: the only consumer for the ring buffer.
+static void logTask(void *pParameters)
+{
+    uGnssPrivateLog_t *pLog = (uGnssPrivateLog_t *) pParameters;
+
+    U_PORT_MUTEX_LOCK(pLog->taskRunningMutexHandle);
+
+    while (pLog->keepGoing) {
+        // Woken by the callback when there is a chunk worth
+        // writing, else flush periodically
+        uPortSemaphoreTryTake(pLog->wakeSemaphoreHandle,
+                              U_GNSS_LOG_FLUSH_INTERVAL_MS);
+        writeOut(pLog);
+    }
+
+    // Write whatever arrived before the readers were stopped
+    writeOut(pLog);
+
+    U_PORT_MUTEX_UNLOCK(pLog->taskRunningMutexHandle);
+
+    // Delete ourself
+    uPortTaskDelete(NULL);
+}
+
+#if U_GNSS_LOG_FILE_SUPPORTED
+// Write function for uGnssLogStartFile().
+static int32_t fileWrite(uDeviceHandle_t gnssHandle, const char *pData,
+                         size_t size, void *pCallbackParam)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_SUCCESS;
+    FILE *pFile = (FILE *) pCallbackParam;
+
+    (void) gnssHandle;
+
+    if (pData != NULL) {
+        errorCodeOrLength = (int32_t) fwrite(pData, 1, size, pFile);
+        if (errorCodeOrLength < (int32_t) size) {
+            errorCodeOrLength = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+        }
+    } else {
+        fclose(pFile);
+    }
+
+    return errorCodeOrLength;
+}
+#endif
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Start logging messages.
+int32_t uGnssLogStart(uDeviceHandle_t gnssHandle,
+                      const uGnssMessageId_t *pMessageIdList,
+                      size_t numMessageIds,
+                      uGnssLogWriteCallback_t pCallback,
+                      void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateLog_t *pLog;
+    uGnssPrivateMessageId_t privateMessageId;
+    char *pLinearBuffer;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pMessageIdList != NULL) &&
+            (numMessageIds > 0) && (pCallback != NULL)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (uGnssPrivateGetStreamType(pInstance->transportType) >= 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_BUSY;
+                if (pInstance->pLog == NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    // One allocation: the context, then the reader
+                    // handles, then the ring buffer, then the write buffer
+                    pLog = (uGnssPrivateLog_t *) pUPortMalloc(sizeof(*pLog) +
+                                                              (numMessageIds * sizeof(int32_t)) +
+                                                              U_GNSS_LOG_BUFFER_LENGTH_BYTES +
+                                                              U_GNSS_LOG_WRITE_LENGTH_BYTES);
+                    if (pLog != NULL) {
+                        memset(pLog, 0, sizeof(*pLog));
+                        pLog->gnssHandle = gnssHandle;
+                        pLog->pAsyncHandles = (int32_t *) (pLog + 1);
+                        for (size_t x = 0; x < numMessageIds; x++) {
+                            pLog->pAsyncHandles[x] = -1;
+                        }
+                        pLog->numAsyncHandles = numMessageIds;
+                        pLinearBuffer = (char *) (pLog->pAsyncHandles + numMessageIds);
+                        pLog->pWriteBuffer = pLinearBuffer + U_GNSS_LOG_BUFFER_LENGTH_BYTES;
+                        pLog->pWriteCallback = pCallback;
+                        pLog->pWriteCallbackParam = pCallbackParam;
+                        pLog->keepGoing = true;
+                        pInstance->pLog = pLog;
+                        if ((uRingBufferCreateLockFree(&(pLog->ringBuffer), pLinearBuffer,
+                                                       U_GNSS_LOG_BUFFER_LENGTH_BYTES) == 0) &&
+                            (uPortSemaphoreCreate(&(pLog->wakeSemaphoreHandle), 0, 1) == 0) &&
+                            (uPortMutexCreate(&(pLog->taskRunningMutexHandle)) == 0)) {
+                            errorCode = uPortTaskCreate(logTask, "gnssLog",
+                                                        U_GNSS_LOG_TASK_STACK_SIZE_BYTES,
+                                                        pLog, U_GNSS_LOG_TASK_PRIORITY,
+                                                        &(pLog->taskHandle));
+                            if (errorCode == 0) {
+                                // Wait for the task to lock the mutex,
+                                // which shows it is running
+                                while (uPortMutexTryLock(pLog->taskRunningMutexHandle, 0) == 0) {
+                                    uPortMutexUnlock(pLog->taskRunningMutexHandle);
+                                    uPortTaskBlock(U_CFG_OS_YIELD_MS);
+                                }
+                            } else {
+                                // So that the clean-up doesn't wait for it
+                                uPortMutexDelete(pLog->taskRunningMutexHandle);
+                                pLog->taskRunningMutexHandle = NULL;
+                            }
+                        }
+                        // Now start the readers
+                        for (size_t x = 0; (x < numMessageIds) && (errorCode == 0); x++) {
+                            errorCode = uGnssPrivateMessageIdToPrivate(pMessageIdList + x,
+                                                                       &privateMessageId);
+                            if (errorCode == 0) {
+                                errorCode = uGnssMsgPrivateReceiveStartInPlace(pInstance,
+                                                                               &privateMessageId,
+                                                                               messageCallback,
+                                                                               pLog);
+                                if (errorCode >= 0) {
+                                    pLog->pAsyncHandles[x] = errorCode;
+                                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                                }
+                            }
+                        }
+                        if (errorCode == 0) {
+                            pLog->notifyStop = true;
+                        } else {
+                            // Clean up, which won't call pCallback
+                            uGnssPrivateCleanUpLog(pInstance);
+                        }
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Start logging messages to a file.
+int32_t uGnssLogStartFile(uDeviceHandle_t gnssHandle,
+                          const uGnssMessageId_t *pMessageIdList,
+                          size_t numMessageIds,
+                          const char *pFileName)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+#if U_GNSS_LOG_FILE_SUPPORTED
+    FILE *pFile;
+
+    errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    if (pFileName != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+        pFile = fopen(pFileName, "wb");
+        if (pFile != NULL) {
+            errorCode = uGnssLogStart(gnssHandle, pMessageIdList, numMessageIds,
+                                      fileWrite, pFile);
+            if (errorCode != 0) {
+                fclose(pFile);
+            }
+        }
+    }
+#else
+    (void) gnssHandle;
+    (void) pMessageIdList;
+    (void) numMessageIds;
+    (void) pFileName;
+#endif
+
+    return errorCode;
+}
+
+// Get the number of messages lost.
+int32_t uGnssLogGetLostCount(uDeviceHandle_t gnssHandle)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            if (pInstance->pLog != NULL) {
+                errorCodeOrCount = pInstance->pLog->lostCount;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Stop logging.
+void uGnssLogStop(uDeviceHandle_t gnssHandle)
+{
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            uGnssPrivateCleanUpLog(pInstance);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+}
+
+// End of file
@@ -44,6 +44,8 @@
 #include "u_port_heap.h"
 #include "u_port_debug.h"
 
+#include "u_time.h"
+
 #include "u_at_client.h"
 
 #include "u_ubx_protocol.h"
@@ -101,6 +103,32 @@ typedef struct {
     void *pCallbackParam;
 } uGnssMgaReadDeviceDatabase_t;
 
+/** Storage for a window of UBX-MGA messages that have been sent
+ * but not yet acknowledged, see windowSend().
+ */
+typedef struct {
+    uGnssPrivateInstance_t *pInstance;
+    size_t windowSize;
+    size_t numOutstanding;
+    size_t bytesOutstanding;
+    size_t oldest;
+    size_t numAcked;
+    uint8_t messageId[U_GNSS_MGA_SEND_WINDOW_MAX];
+    uint16_t length[U_GNSS_MGA_SEND_WINDOW_MAX];
+} uGnssMgaWindow_t;
+
+/** Context for uGnssMgaOfflineStreamSend(), allocated rather than
+ * put on the stack since it is quite large.
+ */
+typedef struct {
+    uDeviceHandle_t gnssHandle;
+    uGnssMgaWindow_t window;
+    uGnssMgaOfflineFilter_t filter;
+    uGnssMgaProgressCallback_t *pCallback;
+    void *pCallbackParam;
+    char chunk[U_GNSS_MGA_OFFLINE_STREAM_CHUNK_SIZE_BYTES];
+} uGnssMgaOfflineStream_t;
+
 /* ----------------------------------------------------------------
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
@@ -444,6 +472,247 @@ static int32_t ubxMgaSendWaitAck(uGnssPrivateInstance_t *pInstance,
     return errorCode;
 }
 
+// Send UBX-MGA-INI-TIME_UTC to a GNSS device and wait for the ack.
+static int32_t iniTimeSend(uGnssPrivateInstance_t *pInstance,
+                           int64_t timeUtcNanoseconds,
+                           int64_t timeUtcAccuracyNanoseconds,
+                           uGnssMgaTimeReference_t *pReference)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    struct tm structTm;
+    time_t time;
+    // Enough room for the body of a UBX-MGA-INI-TIME_UTC message
+    char message[24] = {0};
+
+    time = timeUtcNanoseconds / 1000000000LL;
+    if (gmtime_r(&time, &structTm) != NULL) {
+        // Make sure that acks for aiding messages are enabled
+        errorCode = ubxMgaAckEnable(pInstance);
+        if (errorCode == 0) {
+            message[0] = 0x10; // Message type
+            message[1] = 0;    // Message version
+            if (pReference != NULL) {
+                message[2] = pReference->extInt & 0x0F;
+                if (pReference->fallingNotRising) {
+                    message[2] |= 0x10;
+                }
+                if (pReference->lastNotNext) {
+                    message[2] |= 0x20;
+                }
+            }
+            message[3] = 0x80; // Leap seconds unknown
+            *((uint16_t *) (message + 4)) = uUbxProtocolUint16Encode(structTm.tm_year + 1900); // Year
+            message[6] = structTm.tm_mon + 1; // Month starting at 1
+            message[7] = structTm.tm_mday; // Day starting at 1
+            message[8] = structTm.tm_hour; // Hour
+            message[9] = structTm.tm_min;  // Minute
+            message[10] = structTm.tm_sec; // Seconds
+            // Nanoseconds
+            *((uint32_t *) (message + 12)) = uUbxProtocolUint32Encode((int32_t) (timeUtcNanoseconds %
+                                                                                 1000000000LL));
+            // Accuracy, seconds part
+            *((uint16_t *) (message + 16)) = uUbxProtocolUint16Encode((int16_t) (timeUtcAccuracyNanoseconds /
+                                                                                 1000000000LL));
+            // Accuracy, nanoseconds part
+            *((uint32_t *) (message + 20)) = uUbxProtocolUint32Encode((int32_t) (timeUtcAccuracyNanoseconds %
+                                                                                 1000000000LL));
+            // Send the UBX-MGA-INI-TIME_UTC message and wait for the ack
+            errorCode = ubxMgaSendWaitAck(pInstance, 0x13, 0x40, message, sizeof(message));
+        }
+    }
+
+    return errorCode;
+}
+
+// Initialise a window for windowSend().
+static void windowInit(uGnssMgaWindow_t *pWindow,
+                       uGnssPrivateInstance_t *pInstance,
+                       size_t windowSize)
+{
+    memset(pWindow, 0, sizeof(*pWindow));
+    pWindow->pInstance = pInstance;
+    if (windowSize == 0) {
+        windowSize = U_GNSS_MGA_SEND_WINDOW_DEFAULT;
+    }
+    if (windowSize > U_GNSS_MGA_SEND_WINDOW_MAX) {
+        windowSize = U_GNSS_MGA_SEND_WINDOW_MAX;
+    }
+    pWindow->windowSize = windowSize;
+}
+
+// Wait for the UBX-MGA-ACK-DATA0 message for the oldest outstanding
+// message in a window.
+static int32_t windowWaitAck(uGnssMgaWindow_t *pWindow)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+    uGnssPrivateInstance_t *pInstance = pWindow->pInstance;
+    int32_t startTimeMs;
+    // The UBX-MGA-ACK message ID
+    uGnssPrivateMessageId_t ackMessageId = {.type = U_GNSS_PROTOCOL_UBX,
+                                            .id.ubx = 0x1360
+                                           };
+    // Enough room for a UBX-MGA-ACK-DATA0 message, including overhead
+    char buffer[8 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES] = {0};
+    char *pBuffer = buffer;
+    // 0 for "not acked", 1 for "nacked", 2 for "acked"
+    size_t ackState = 0;
+
+    startTimeMs = uPortGetTickTimeMs();
+    do {
+        if ((uGnssPrivateReceiveStreamMessage(pInstance, &ackMessageId,
+                                              pInstance->ringBufferReadHandlePrivate,
+                                              &pBuffer, sizeof(buffer),
+                                              1000, NULL) == sizeof(buffer)) &&
+            (buffer[1 + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES] == 0) && // Ack message version
+            ((uint8_t) buffer[3 + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES] ==
+             pWindow->messageId[pWindow->oldest])) {  // ID of the oldest message
+            ackState = 1;
+            if (buffer[0 + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES] == 1) {
+                ackState = 2;
+            }
+        }
+    } while ((ackState == 0) && (uPortGetTickTimeMs() - startTimeMs < pInstance->timeoutMs));
+
+    if (ackState == 2) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        pWindow->bytesOutstanding -= pWindow->length[pWindow->oldest];
+        pWindow->numOutstanding--;
+        pWindow->oldest++;
+        if (pWindow->oldest >= pWindow->windowSize) {
+            pWindow->oldest = 0;
+        }
+        pWindow->numAcked++;
+    } else if (ackState == 1) {
+        errorCode = (int32_t) U_GNSS_ERROR_NACK;
+    }
+
+    return errorCode;
+}
+
+// Send a complete UBX-MGA message, waiting for acknowledgements
+// to make room in the window first if necessary; messages are
+// kept within both the window size and the receive buffer size
+// of the GNSS chip.
+static int32_t windowSend(uGnssMgaWindow_t *pWindow,
+                          const char *pMessage, size_t length)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    size_t x;
+
+    while ((pWindow->numOutstanding > 0) && (errorCode == 0) &&
+           ((pWindow->numOutstanding >= pWindow->windowSize) ||
+            (pWindow->bytesOutstanding + length > U_GNSS_MGA_RX_BUFFER_SIZE_BYTES))) {
+        errorCode = windowWaitAck(pWindow);
+    }
+    if (errorCode == 0) {
+        errorCode = uGnssPrivateSendOnlyStreamRaw(pWindow->pInstance, pMessage, length);
+        if (errorCode == (int32_t) length) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            x = pWindow->oldest + pWindow->numOutstanding;
+            if (x >= pWindow->windowSize) {
+                x -= pWindow->windowSize;
+            }
+            pWindow->messageId[x] = (uint8_t) pMessage[3];
+            pWindow->length[x] = (uint16_t) length;
+            pWindow->numOutstanding++;
+            pWindow->bytesOutstanding += length;
+        } else if (errorCode >= 0) {
+            errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+        }
+    }
+
+    return errorCode;
+}
+
+// Wait for all of the messages in a window to be acknowledged.
+static int32_t windowFlush(uGnssMgaWindow_t *pWindow)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+
+    while ((pWindow->numOutstanding > 0) && (errorCode == 0)) {
+        errorCode = windowWaitAck(pWindow);
+    }
+
+    return errorCode;
+}
+
+// Return the UTC time in seconds at the start of the given date.
+static int64_t dateToSecondsUtc(int32_t year, int32_t month, int32_t day)
+{
+    // uTimeMonthsToSecondsUtc() counts months since 1970
+    return uTimeMonthsToSecondsUtc(((year - 1970) * 12) + month - 1) +
+           ((int64_t) (day - 1) * 3600 * 24);
+}
+
+// Find the next UBX message in a cache, returning the length of its
+// body and setting *ppMessage to point to the start of the message,
+// i.e. the 0xb5 header byte, and *ppBuffer past the message.
+static int32_t cacheNext(const char **ppBuffer, const char *pEnd,
+                         const char **ppMessage,
+                         int32_t *pMessageClass, int32_t *pMessageId)
+{
+    int32_t bodyLength = -1;
+    const char *pNext = *ppBuffer;
+
+    if (*ppBuffer < pEnd) {
+        bodyLength = uUbxProtocolDecode(*ppBuffer, pEnd - *ppBuffer,
+                                        pMessageClass, pMessageId,
+                                        NULL, 0, &pNext);
+        if (bodyLength >= 0) {
+            *ppMessage = pNext - (bodyLength + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
+        }
+        *ppBuffer = pNext;
+    }
+
+    return bodyLength;
+}
+
+// Return true if a message from a cache, or from a stream of
+// AssistNow Offline data, should be sent to the GNSS chip at a
+// time on the given day.
+static bool cacheSelect(bool onlineNotOffline,
+                        int32_t messageClass, int32_t messageId,
+                        const char *pBody, int32_t bodyLength,
+                        int64_t todaySecondsUtc)
+{
+    bool sendIt = true;
+
+    if (messageClass == 0x13) {
+        if ((messageId == 0x40) && (bodyLength > 0) && (*pBody == 0x10)) {
+            // A UBX-MGA-INI-TIME_UTC message: we send the current time
+            // so this one, which will be out of date, is not sent
+            sendIt = false;
+        } else if (!onlineNotOffline && (messageId == 0x20) && (bodyLength >= 7)) {
+            // A UBX-MGA-ANO message: only send those for today; the
+            // date is at offset 4, year since 2000, month, day
+            sendIt = (dateToSecondsUtc(2000 + *(pBody + 4), *(pBody + 5),
+                                       *(pBody + 6)) == todaySecondsUtc);
+        }
+    }
+
+    return sendIt;
+}
+
+// Callback for uGnssMgaOfflineFilterPush(), used by
+// uGnssMgaOfflineStreamSend() to send a selected message.
+static int32_t streamSendMessage(const char *pMessage, size_t length,
+                                 void *pCallbackParam)
+{
+    uGnssMgaOfflineStream_t *pStream = (uGnssMgaOfflineStream_t *) pCallbackParam;
+    int32_t errorCode;
+
+    errorCode = windowSend(&pStream->window, pMessage, length);
+    if ((pStream->pCallback != NULL) &&
+        !pStream->pCallback(pStream->gnssHandle, errorCode,
+                            pStream->filter.numSelected,
+                            pStream->window.numAcked,
+                            pStream->pCallbackParam)) {
+        errorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+    }
+
+    return errorCode;
+}
+
 // Given a pointer to the two-byte length field of a UBX message,
 // return the length.
 static int32_t ubxLength(const char *pBuffer, size_t size)
@@ -451,13 +720,79 @@ static int32_t ubxLength(const char *pBuffer, size_t size)
     int32_t length = (int32_t) U_ERROR_COMMON_BAD_DATA;
 
     if (size >= 2) {
-        length = *(pBuffer) + (((uint32_t) * (pBuffer + 1)) << 8);
+        length = (uint8_t) *(pBuffer) + (((uint32_t) (uint8_t) * (pBuffer + 1)) << 8);
     }
 
     return length;
 
 }
 
+// Calculate the Fletcher checksum, as used by the UBX protocol, over
+// a block of data.
+static uint16_t checksum(const char *pBuffer, size_t size)
+{
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+
+    for (size_t x = 0; x < size; x++) {
+        ckA += (uint8_t) *(pBuffer + x);
+        ckB += ckA;
+    }
+
+    return (uint16_t) (ckA | (((uint16_t) ckB) << 8));
+}
+
+// Check a navigation database, either in the form returned by
+// uGnssMgaGetDatabase() or in compact form, returning the number
+// of records it contains and setting *pCompact appropriately.
+static int32_t databaseCheck(const char *pBuffer, size_t size, bool *pCompact)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_BAD_DATA;
+    const char *pEnd = pBuffer + size;
+    int32_t numRecords = 0;
+    int32_t length;
+
+    *pCompact = false;
+    if ((size >= U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES +
+         U_GNSS_MGA_DATABASE_COMPACT_CHECKSUM_LENGTH_BYTES) &&
+        (memcmp(pBuffer, U_GNSS_MGA_DATABASE_COMPACT_MAGIC,
+                sizeof(U_GNSS_MGA_DATABASE_COMPACT_MAGIC) - 1) == 0)) {
+        // Compact form: check the version and checksum, then that the
+        // records fill the space exactly
+        pEnd -= U_GNSS_MGA_DATABASE_COMPACT_CHECKSUM_LENGTH_BYTES;
+        if ((*(pBuffer + 4) == U_GNSS_MGA_DATABASE_COMPACT_VERSION) &&
+            (checksum(pBuffer, pEnd - pBuffer) == uUbxProtocolUint16Decode(pEnd))) {
+            *pCompact = true;
+            length = uUbxProtocolUint16Decode(pBuffer + 6);
+            pBuffer += U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES;
+            while ((pBuffer < pEnd) && (numRecords < length)) {
+                pBuffer += (uint8_t) *pBuffer + 1; // +1 for the length byte
+                numRecords++;
+            }
+            if ((pBuffer == pEnd) && (numRecords == length) && (numRecords > 0)) {
+                errorCodeOrCount = numRecords;
+            }
+        }
+    } else {
+        // The form returned by uGnssMgaGetDatabase()
+        while ((pEnd - pBuffer > 2) && (numRecords >= 0)) { // 2 'cos there must be a length indicator
+            length = ubxLength(pBuffer, pEnd - pBuffer);
+            if ((length >= 0) && (length <= U_GNSS_MGA_DBD_MESSAGE_PAYLOAD_LENGTH_MAX_BYTES) &&
+                (pEnd - pBuffer >= length + 2)) { // +2 to include the length bytes
+                pBuffer += length + 2;
+                numRecords++;
+            } else {
+                numRecords = -1;
+            }
+        }
+        if ((pBuffer == pEnd) && (numRecords > 0)) {
+            errorCodeOrCount = numRecords;
+        }
+    }
+
+    return errorCodeOrCount;
+}
+
 // Callback called by the ubxlib message receive infrastructure when readibg
 // the navigation database from the GNSS device.
 static void readDeviceDatabaseCallback(uDeviceHandle_t gnssHandle,
@@ -654,10 +989,6 @@ int32_t uGnssMgaIniTimeSend(uDeviceHandle_t gnssHandle,
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uGnssPrivateInstance_t *pInstance;
-    struct tm structTm;
-    time_t time;
-    // Enough room for the body of a UBX-MGA-INI-TIME_UTC message
-    char message[24] = {0};
 
     if (gUGnssPrivateMutex != NULL) {
 
@@ -668,42 +999,8 @@ int32_t uGnssMgaIniTimeSend(uDeviceHandle_t gnssHandle,
         // Values in pReference deliberately not checked; the module will do that
         if ((pInstance != NULL) && (timeUtcNanoseconds >= 0) &&
             (timeUtcAccuracyNanoseconds >= 0)) {
-            time = timeUtcNanoseconds / 1000000000LL;
-            if (gmtime_r(&time, &structTm) != NULL) {
-                // Make sure that acks for aiding messages are enabled
-                errorCode = ubxMgaAckEnable(pInstance);
-                if (errorCode == 0) {
-                    message[0] = 0x10; // Message type
-                    message[1] = 0;    // Message version
-                    if (pReference != NULL) {
-                        message[2] = pReference->extInt & 0x0F;
-                        if (pReference->fallingNotRising) {
-                            message[2] |= 0x10;
-                        }
-                        if (pReference->lastNotNext) {
-                            message[2] |= 0x20;
-                        }
-                    }
-                    message[3] = 0x80; // Leap seconds unknown
-                    *((uint16_t *) (message + 4)) = uUbxProtocolUint16Encode(structTm.tm_year + 1900); // Year
-                    message[6] = structTm.tm_mon + 1; // Month starting at 1
-                    message[7] = structTm.tm_mday; // Day starting at 1
-                    message[8] = structTm.tm_hour; // Hour
-                    message[9] = structTm.tm_min;  // Minute
-                    message[10] = structTm.tm_sec; // Seconds
-                    // Nanoseconds
-                    *((uint32_t *) (message + 12)) = uUbxProtocolUint32Encode((int32_t) (timeUtcNanoseconds %
-                                                                                         1000000000LL));
-                    // Accuracy, seconds part
-                    *((uint16_t *) (message + 16)) = uUbxProtocolUint16Encode((int16_t) (timeUtcAccuracyNanoseconds /
-                                                                                         1000000000LL));
-                    // Accuracy, nanoseconds part
-                    *((uint32_t *) (message + 20)) = uUbxProtocolUint32Encode((int32_t) (timeUtcAccuracyNanoseconds %
-                                                                                         1000000000LL));
-                    // Send the UBX-MGA-INI-TIME_UTC message and wait for the ack
-                    errorCode = ubxMgaSendWaitAck(pInstance, 0x13, 0x40, message, sizeof(message));
-                }
-            }
+            errorCode = iniTimeSend(pInstance, timeUtcNanoseconds,
+                                    timeUtcAccuracyNanoseconds, pReference);
         }
 
         U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
@@ -910,6 +1207,395 @@ int32_t uGnssMgaResponseSend(uDeviceHandle_t gnssHandle,
     return errorCode;
 }
 
+// Populate a cache for AssistNow data.
+int32_t uGnssMgaCacheCreate(const char *pBuffer, size_t size,
+                            uGnssMgaCache_t *pCache)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    const char *pEnd = pBuffer + size;
+    const char *pMessage = NULL;
+    int32_t messageClass;
+    int32_t messageId;
+    int32_t bodyLength;
+    const char *pBody;
+    int64_t t;
+
+    if ((pBuffer != NULL) && (pCache != NULL)) {
+        memset(pCache, 0, sizeof(*pCache));
+        pCache->pBuffer = pBuffer;
+        pCache->size = size;
+        pCache->onlineNotOffline = detectAssistNowType(pBuffer, size);
+        pCache->validFromUtcMilliseconds = -1;
+        pCache->validToUtcMilliseconds = -1;
+        for (bodyLength = cacheNext(&pBuffer, pEnd, &pMessage, &messageClass, &messageId);
+             bodyLength >= 0;
+             bodyLength = cacheNext(&pBuffer, pEnd, &pMessage, &messageClass, &messageId)) {
+            pCache->numMessages++;
+            pBody = pMessage + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+            if (pCache->onlineNotOffline) {
+                if ((pCache->validFromUtcMilliseconds < 0) && (messageClass == 0x13) &&
+                    (messageId == 0x40) && (bodyLength >= 11) && (*pBody == 0x10)) {
+                    // The UBX-MGA-INI-TIME_UTC message at the start of
+                    // AssistNow Online data: year, month, day, hour,
+                    // minute and second from offset 4
+                    t = dateToSecondsUtc(uUbxProtocolUint16Decode(pBody + 4),
+                                         *(pBody + 6), *(pBody + 7)) +
+                        ((int64_t) *(pBody + 8) * 3600) + (*(pBody + 9) * 60) + *(pBody + 10);
+                    pCache->validFromUtcMilliseconds = t * 1000;
+                    pCache->validToUtcMilliseconds = (t + U_GNSS_MGA_CACHE_ONLINE_VALIDITY_SECONDS) * 1000;
+                }
+            } else if ((messageClass == 0x13) && (messageId == 0x20) && (bodyLength >= 7)) {
+                // A UBX-MGA-ANO message, valid for the day at offset 4
+                t = dateToSecondsUtc(2000 + *(pBody + 4), *(pBody + 5), *(pBody + 6)) * 1000;
+                if ((pCache->validFromUtcMilliseconds < 0) ||
+                    (t < pCache->validFromUtcMilliseconds)) {
+                    pCache->validFromUtcMilliseconds = t;
+                }
+                t += 3600 * 24 * 1000;
+                if (t > pCache->validToUtcMilliseconds) {
+                    pCache->validToUtcMilliseconds = t;
+                }
+            }
+        }
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_BAD_DATA;
+        if (pCache->numMessages > 0) {
+            errorCodeOrCount = (int32_t) pCache->numMessages;
+            if (!pCache->onlineNotOffline && (pCache->validFromUtcMilliseconds < 0)) {
+                // No dated messages, e.g. almanac only: always valid
+                pCache->validFromUtcMilliseconds = 0;
+                pCache->validToUtcMilliseconds = INT64_MAX;
+            }
+        }
+    }
+
+    return errorCodeOrCount;
+}
+
+// Check whether a cache of AssistNow data is valid.
+bool uGnssMgaCacheIsValid(const uGnssMgaCache_t *pCache,
+                          int64_t timeUtcMilliseconds)
+{
+    return (pCache != NULL) && (pCache->numMessages > 0) &&
+           (timeUtcMilliseconds >= pCache->validFromUtcMilliseconds) &&
+           (timeUtcMilliseconds < pCache->validToUtcMilliseconds);
+}
+
+// Send the relevant parts of a cache of AssistNow data to a GNSS device.
+int32_t uGnssMgaCacheSend(uDeviceHandle_t gnssHandle,
+                          const uGnssMgaCache_t *pCache,
+                          int64_t timeUtcMilliseconds,
+                          int64_t timeUtcAccuracyMilliseconds,
+                          size_t windowSize,
+                          uGnssMgaProgressCallback_t *pCallback,
+                          void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssMgaWindow_t window;
+    const char *pBuffer;
+    const char *pEnd;
+    const char *pMessage = NULL;
+    int32_t messageClass;
+    int32_t messageId;
+    int32_t bodyLength;
+    int64_t todaySecondsUtc;
+    size_t blocksTotal = 0;
+    int32_t protocolsOut = 0;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pCache != NULL) && (pCache->pBuffer != NULL) &&
+            (timeUtcMilliseconds >= 0) && (timeUtcAccuracyMilliseconds >= 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            // Not supported if there is an intermediate module
+            if ((uGnssPrivateGetStreamType(pInstance->transportType) >= 0) &&
+                (pInstance->intermediateHandle == NULL)) {
+                errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+                if (uGnssMgaCacheIsValid(pCache, timeUtcMilliseconds)) {
+#ifndef U_GNSS_MGA_DISABLE_NMEA_MESSAGE_DISABLE
+                    // On a best effort basis switch off NMEA messages
+                    // while we do this as the message load on the
+                    // interface would otherwise slow the acks down
+                    protocolsOut = uGnssPrivateGetProtocolOut(pInstance);
+                    if ((protocolsOut >= 0) && ((protocolsOut & (1ULL << U_GNSS_PROTOCOL_NMEA)) != 0)) {
+                        uGnssPrivateSetProtocolOut(pInstance, U_GNSS_PROTOCOL_NMEA, false);
+                    }
+#endif
+                    // Send the time first: this also enables acks
+                    errorCode = iniTimeSend(pInstance, timeUtcMilliseconds * 1000000LL,
+                                            timeUtcAccuracyMilliseconds * 1000000LL, NULL);
+                    if (errorCode == 0) {
+                        todaySecondsUtc = (timeUtcMilliseconds / 1000) -
+                                          ((timeUtcMilliseconds / 1000) % (3600 * 24));
+                        // Count what we're going to send, for the callback
+                        pEnd = pCache->pBuffer + pCache->size;
+                        pBuffer = pCache->pBuffer;
+                        for (bodyLength = cacheNext(&pBuffer, pEnd, &pMessage, &messageClass, &messageId);
+                             bodyLength >= 0;
+                             bodyLength = cacheNext(&pBuffer, pEnd, &pMessage, &messageClass, &messageId)) {
+                            if (cacheSelect(pCache->onlineNotOffline, messageClass, messageId,
+                                            pMessage + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES,
+                                            bodyLength, todaySecondsUtc)) {
+                                blocksTotal++;
+                            }
+                        }
+                        // Now send it
+                        windowInit(&window, pInstance, windowSize);
+                        pBuffer = pCache->pBuffer;
+                        for (bodyLength = cacheNext(&pBuffer, pEnd, &pMessage, &messageClass, &messageId);
+                             (bodyLength >= 0) && (errorCode == 0);
+                             bodyLength = cacheNext(&pBuffer, pEnd, &pMessage, &messageClass, &messageId)) {
+                            if (cacheSelect(pCache->onlineNotOffline, messageClass, messageId,
+                                            pMessage + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES,
+                                            bodyLength, todaySecondsUtc)) {
+                                errorCode = windowSend(&window, pMessage,
+                                                       bodyLength + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
+                                if ((pCallback != NULL) &&
+                                    !pCallback(gnssHandle, errorCode, blocksTotal,
+                                               window.numAcked, pCallbackParam)) {
+                                    errorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+                                }
+                            }
+                        }
+                        if (errorCode == 0) {
+                            errorCode = windowFlush(&window);
+                            if (pCallback != NULL) {
+                                pCallback(gnssHandle, errorCode, blocksTotal,
+                                          window.numAcked, pCallbackParam);
+                            }
+                        }
+                    }
+
+                    if ((protocolsOut >= 0) && ((protocolsOut & (1ULL << U_GNSS_PROTOCOL_NMEA)) != 0)) {
+                        // Restore NMEA messages, if we switched them off above
+                        uGnssPrivateSetProtocolOut(pInstance, U_GNSS_PROTOCOL_NMEA, true);
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Initialise a filter for AssistNow Offline data.
+int32_t uGnssMgaOfflineFilterInit(uGnssMgaOfflineFilter_t *pFilter,
+                                  int64_t timeUtcMilliseconds)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pFilter != NULL) && (timeUtcMilliseconds >= 0)) {
+        memset(pFilter, 0, sizeof(*pFilter));
+        pFilter->todaySecondsUtc = (timeUtcMilliseconds / 1000) -
+                                   ((timeUtcMilliseconds / 1000) % (3600 * 24));
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
+// Pass a chunk of AssistNow Offline data through a filter.
+int32_t uGnssMgaOfflineFilterPush(uGnssMgaOfflineFilter_t *pFilter,
+                                  const char *pData, size_t size,
+                                  uGnssMgaOfflineFilterCallback_t *pCallback,
+                                  void *pCallbackParam)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    int32_t errorCode = 0;
+    int32_t count = 0;
+    size_t target;
+    size_t x;
+    int32_t messageClass;
+    int32_t messageId;
+    int32_t bodyLength;
+    const char *pBody = NULL;
+
+    if ((pFilter != NULL) && ((pData != NULL) || (size == 0)) && (pCallback != NULL)) {
+        while ((size > 0) && (errorCode == 0)) {
+            if (pFilter->length < 2) {
+                // Hunting for the 0xb5 0x62 at the start of a UBX message
+                if ((uint8_t) *pData == 0xb5) {
+                    pFilter->buffer[0] = *pData;
+                    pFilter->length = 1;
+                } else if ((pFilter->length == 1) && (*pData == 0x62)) {
+                    pFilter->buffer[1] = *pData;
+                    pFilter->length = 2;
+                } else {
+                    pFilter->length = 0;
+                }
+                pData++;
+                size--;
+            } else {
+                // Collect the header, which tells us the length, then
+                // the rest of the message; a message that is too long
+                // to fit is counted through but not stored
+                target = pFilter->messageLength;
+                if (target == 0) {
+                    target = U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+                }
+                x = target - pFilter->length;
+                if (x > size) {
+                    x = size;
+                }
+                if (pFilter->length + x <= sizeof(pFilter->buffer)) {
+                    memcpy(pFilter->buffer + pFilter->length, pData, x);
+                }
+                pFilter->length += x;
+                pData += x;
+                size -= x;
+                if (pFilter->length == target) {
+                    if (pFilter->messageLength == 0) {
+                        pFilter->messageLength = ubxLength(pFilter->buffer + 4, 2) +
+                                                 U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+                    } else {
+                        bodyLength = -1;
+                        if (pFilter->messageLength <= sizeof(pFilter->buffer)) {
+                            bodyLength = uUbxProtocolDecode(pFilter->buffer, pFilter->messageLength,
+                                                            &messageClass, &messageId,
+                                                            NULL, 0, NULL);
+                            pBody = pFilter->buffer + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+                        }
+                        if (bodyLength >= 0) {
+                            pFilter->numMessages++;
+                            if ((messageClass == 0x13) && (messageId == 0x20)) {
+                                pFilter->numAno++;
+                            }
+                            if (cacheSelect(false, messageClass, messageId,
+                                            pBody, bodyLength,
+                                            pFilter->todaySecondsUtc)) {
+                                pFilter->numSelected++;
+                                if ((messageClass == 0x13) && (messageId == 0x20)) {
+                                    pFilter->numAnoSelected++;
+                                }
+                                count++;
+                                errorCode = pCallback(pFilter->buffer, pFilter->messageLength,
+                                                      pCallbackParam);
+                            }
+                        } else {
+                            pFilter->numDiscarded++;
+                        }
+                        pFilter->length = 0;
+                        pFilter->messageLength = 0;
+                    }
+                }
+            }
+        }
+        errorCodeOrCount = count;
+        if (errorCode < 0) {
+            errorCodeOrCount = errorCode;
+        }
+    }
+
+    return errorCodeOrCount;
+}
+
+// Send AssistNow Offline data to a GNSS device as it is read.
+int32_t uGnssMgaOfflineStreamSend(uDeviceHandle_t gnssHandle,
+                                  uGnssMgaReadCallback_t *pReadCallback,
+                                  void *pReadCallbackParam,
+                                  int64_t timeUtcMilliseconds,
+                                  int64_t timeUtcAccuracyMilliseconds,
+                                  size_t windowSize,
+                                  uGnssMgaProgressCallback_t *pCallback,
+                                  void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssMgaOfflineStream_t *pStream;
+    int32_t x;
+    int32_t protocolsOut = 0;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pReadCallback != NULL) &&
+            (timeUtcMilliseconds >= 0) && (timeUtcAccuracyMilliseconds >= 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            // Not supported if there is an intermediate module
+            if ((uGnssPrivateGetStreamType(pInstance->transportType) >= 0) &&
+                (pInstance->intermediateHandle == NULL)) {
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                pStream = (uGnssMgaOfflineStream_t *) pUPortMalloc(sizeof(*pStream));
+                if (pStream != NULL) {
+                    memset(pStream, 0, sizeof(*pStream));
+                    pStream->gnssHandle = gnssHandle;
+                    pStream->pCallback = pCallback;
+                    pStream->pCallbackParam = pCallbackParam;
+#ifndef U_GNSS_MGA_DISABLE_NMEA_MESSAGE_DISABLE
+                    // On a best effort basis switch off NMEA messages
+                    // while we do this as the message load on the
+                    // interface would otherwise slow the acks down
+                    protocolsOut = uGnssPrivateGetProtocolOut(pInstance);
+                    if ((protocolsOut >= 0) && ((protocolsOut & (1ULL << U_GNSS_PROTOCOL_NMEA)) != 0)) {
+                        uGnssPrivateSetProtocolOut(pInstance, U_GNSS_PROTOCOL_NMEA, false);
+                    }
+#endif
+                    // Send the time first: this also enables acks
+                    errorCode = iniTimeSend(pInstance, timeUtcMilliseconds * 1000000LL,
+                                            timeUtcAccuracyMilliseconds * 1000000LL, NULL);
+                    if (errorCode == 0) {
+                        windowInit(&pStream->window, pInstance, windowSize);
+                        uGnssMgaOfflineFilterInit(&pStream->filter, timeUtcMilliseconds);
+                        // Read the data a chunk at a time, sending what
+                        // is selected as we go
+                        do {
+                            x = pReadCallback(gnssHandle, pStream->chunk,
+                                              sizeof(pStream->chunk),
+                                              pReadCallbackParam);
+                            if (x > (int32_t) sizeof(pStream->chunk)) {
+                                x = (int32_t) sizeof(pStream->chunk);
+                            }
+                            if (x > 0) {
+                                errorCode = uGnssMgaOfflineFilterPush(&pStream->filter,
+                                                                      pStream->chunk, x,
+                                                                      streamSendMessage,
+                                                                      pStream);
+                                if (errorCode > 0) {
+                                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                                }
+                            } else if (x < 0) {
+                                errorCode = x;
+                            }
+                        } while ((x > 0) && (errorCode == 0));
+                        if (errorCode == 0) {
+                            errorCode = windowFlush(&pStream->window);
+                            if (pCallback != NULL) {
+                                pCallback(gnssHandle, errorCode, pStream->filter.numSelected,
+                                          pStream->window.numAcked, pCallbackParam);
+                            }
+                        }
+                        if ((errorCode == 0) && (pStream->filter.numAno > 0) &&
+                            (pStream->filter.numAnoSelected == 0)) {
+                            // Everything else was sent but there was
+                            // nothing for today, the data is out of date
+                            errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+                        }
+                    }
+
+                    if ((protocolsOut >= 0) && ((protocolsOut & (1ULL << U_GNSS_PROTOCOL_NMEA)) != 0)) {
+                        // Restore NMEA messages, if we switched them off above
+                        uGnssPrivateSetProtocolOut(pInstance, U_GNSS_PROTOCOL_NMEA, true);
+                    }
+                    uPortFree(pStream);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
 // Erase the flash memory attached to a GNSS chip.
 int32_t uGnssMgaErase(uDeviceHandle_t gnssHandle)
 {
@@ -1266,4 +1952,144 @@ int32_t uGnssMgaSetDatabase(uDeviceHandle_t gnssHandle,
     return errorCode;
 }
 
+// Convert a navigation database into compact format.
+int32_t uGnssMgaDatabaseCompact(const char *pBuffer, size_t size,
+                                char *pCompact, size_t compactSize)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    int32_t numRecords;
+    bool compact;
+    size_t length;
+    size_t x;
+    char *pTmp = pCompact;
+
+    if ((pBuffer != NULL) && (size > 0)) {
+        errorCodeOrLength = (int32_t) U_ERROR_COMMON_BAD_DATA;
+        numRecords = databaseCheck(pBuffer, size, &compact);
+        if ((numRecords > 0) && !compact && (numRecords <= 0xFFFF)) {
+            // Each record loses one of its two length bytes
+            length = size - numRecords + U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES +
+                     U_GNSS_MGA_DATABASE_COMPACT_CHECKSUM_LENGTH_BYTES;
+            errorCodeOrLength = (int32_t) length;
+            if (pCompact != NULL) {
+                errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                if (compactSize >= length) {
+                    memcpy(pTmp, U_GNSS_MGA_DATABASE_COMPACT_MAGIC,
+                           sizeof(U_GNSS_MGA_DATABASE_COMPACT_MAGIC) - 1);
+                    *(pTmp + 4) = U_GNSS_MGA_DATABASE_COMPACT_VERSION;
+                    *(pTmp + 5) = 0;
+                    *((uint16_t *) (pTmp + 6)) = uUbxProtocolUint16Encode((uint16_t) numRecords);
+                    pTmp += U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES;
+                    while (numRecords > 0) {
+                        // Lengths have been checked by databaseCheck()
+                        // to be no more than 248 so one byte will do
+                        x = (size_t) ubxLength(pBuffer, 2);
+                        *pTmp = (char) x;
+                        memcpy(pTmp + 1, pBuffer + 2, x);
+                        pTmp += x + 1;
+                        pBuffer += x + 2;
+                        numRecords--;
+                    }
+                    *((uint16_t *) pTmp) = uUbxProtocolUint16Encode(checksum(pCompact, pTmp - pCompact));
+                    errorCodeOrLength = (int32_t) length;
+                }
+            }
+        }
+    }
+
+    return errorCodeOrLength;
+}
+
+// Set (restore) the assistance database to a GNSS device with
+// windowed flow control.
+int32_t uGnssMgaSetDatabaseWindowed(uDeviceHandle_t gnssHandle,
+                                    size_t windowSize,
+                                    const char *pBuffer, size_t size,
+                                    uGnssMgaProgressCallback_t *pCallback,
+                                    void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssMgaWindow_t window;
+    int32_t totalBlocks;
+    bool compact = false;
+    int32_t length;
+    int32_t protocolsOut = 0;
+    // Enough room for the largest UBX-MGA-DBD message, including overhead
+    char message[U_GNSS_MGA_DBD_MESSAGE_PAYLOAD_LENGTH_MAX_BYTES + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES];
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pBuffer != NULL) && (size > 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            // Not supported if there is an intermediate module
+            if ((uGnssPrivateGetStreamType(pInstance->transportType) >= 0) &&
+                (pInstance->intermediateHandle == NULL)) {
+                // Check the data before we send any of it
+                errorCode = databaseCheck(pBuffer, size, &compact);
+                if (errorCode > 0) {
+                    totalBlocks = errorCode;
+                    errorCode = ubxMgaAckEnable(pInstance);
+#ifndef U_GNSS_MGA_DISABLE_NMEA_MESSAGE_DISABLE
+                    // On a best effort basis switch off NMEA messages
+                    // while we do this as the message load on the
+                    // interface would otherwise slow the acks down
+                    protocolsOut = uGnssPrivateGetProtocolOut(pInstance);
+                    if ((protocolsOut >= 0) && ((protocolsOut & (1ULL << U_GNSS_PROTOCOL_NMEA)) != 0)) {
+                        uGnssPrivateSetProtocolOut(pInstance, U_GNSS_PROTOCOL_NMEA, false);
+                    }
+#endif
+                    if (compact) {
+                        pBuffer += U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES;
+                    }
+                    windowInit(&window, pInstance, windowSize);
+                    for (int32_t x = 0; (x < totalBlocks) && (errorCode == 0); x++) {
+                        // Get the length of the record, which databaseCheck()
+                        // has already checked, and skip the length bytes
+                        if (compact) {
+                            length = (uint8_t) *pBuffer;
+                            pBuffer++;
+                        } else {
+                            length = ubxLength(pBuffer, 2);
+                            pBuffer += 2;
+                        }
+                        length = uUbxProtocolEncode(0x13, 0x80, pBuffer, length, message);
+                        if (length >= 0) {
+                            pBuffer += length - U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+                            errorCode = windowSend(&window, message, length);
+                        } else {
+                            errorCode = length;
+                        }
+                        if ((pCallback != NULL) &&
+                            !pCallback(gnssHandle, errorCode, totalBlocks,
+                                       window.numAcked, pCallbackParam)) {
+                            errorCode = (int32_t) U_ERROR_COMMON_CANCELLED;
+                        }
+                    }
+                    if (errorCode == 0) {
+                        errorCode = windowFlush(&window);
+                        if (pCallback != NULL) {
+                            pCallback(gnssHandle, errorCode, totalBlocks,
+                                      window.numAcked, pCallbackParam);
+                        }
+                    }
+
+                    if ((protocolsOut >= 0) && ((protocolsOut & (1ULL << U_GNSS_PROTOCOL_NMEA)) != 0)) {
+                        // Restore NMEA messages, if we switched them off above
+                        uGnssPrivateSetProtocolOut(pInstance, U_GNSS_PROTOCOL_NMEA, true);
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
 // End of file
@@ -76,9 +76,13 @@
 #include "u_port_uart.h"
 #include "u_port_i2c.h"
 #include "u_port_spi.h"
+#include "u_port_event_queue.h"
+#include "u_log_ram_trace.h" // U_LOG_RAM_TRACE_XXX()
 
 #include "u_at_client.h"
 
+#include "u_device_serial.h"
+
 #include "u_ubx_protocol.h"
 
 #include "u_hex_bin_convert.h"
@@ -124,6 +128,18 @@
 # error U_GNSS_MSG_TASK_STACK_YIELD_TIME_MS must be at least as big as U_CFG_OS_YIELD_MS
 #endif
 
+#if U_GNSS_MSG_RECEIVE_DISPATCH_TABLE_SIZE < 2
+# error U_GNSS_MSG_RECEIVE_DISPATCH_TABLE_SIZE must be at least 2
+#endif
+
+#ifndef U_GNSS_MSG_RECEIVE_STREAM_EVENT_STACK_SIZE_BYTES
+/** The stack size of the task that delivers data-received events
+ * from a UART or virtual serial port to the asynchronous message
+ * receive task; all it does is give a semaphore.
+ */
+# define U_GNSS_MSG_RECEIVE_STREAM_EVENT_STACK_SIZE_BYTES U_PORT_EVENT_QUEUE_MIN_TASK_STACK_SIZE_BYTES
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -136,6 +152,194 @@
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Data-received event callback for a UART: wake up the message
+// receive task.
+static void uartEventCallback(int32_t handle, uint32_t eventBitmask,
+                              void *pParam)
+{
+    uGnssPrivateMsgReceive_t *pMsgReceive = (uGnssPrivateMsgReceive_t *) pParam;
+
+    (void) handle;
+    if ((eventBitmask & U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED) &&
+        (pMsgReceive != NULL)) {
+        uPortSemaphoreGive(pMsgReceive->wakeSemaphoreHandle);
+    }
+}
+
+// Data-received event callback for a virtual serial port: wake up
+// the message receive task.
+static void deviceSerialEventCallback(struct uDeviceSerial_t *pDeviceSerial,
+                                      uint32_t eventBitmask, void *pParam)
+{
+    uGnssPrivateMsgReceive_t *pMsgReceive = (uGnssPrivateMsgReceive_t *) pParam;
+
+    (void) pDeviceSerial;
+    if ((eventBitmask & U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED) &&
+        (pMsgReceive != NULL)) {
+        uPortSemaphoreGive(pMsgReceive->wakeSemaphoreHandle);
+    }
+}
+
+// Set a data-received event callback on the streaming transport,
+// if it has one and the application isn't already using it, so
+// that the message receive task can wait to be woken rather than
+// poll.
+static void streamEventCallbackSet(uGnssPrivateInstance_t *pInstance)
+{
+    uGnssPrivateMsgReceive_t *pMsgReceive = pInstance->pMsgReceive;
+    uDeviceSerial_t *pDeviceSerial;
+
+    switch (uGnssPrivateGetStreamType(pInstance->transportType)) {
+        case U_GNSS_PRIVATE_STREAM_TYPE_UART:
+            if ((uPortUartEventCallbackFilterGet(pInstance->transportHandle.uart) == 0) &&
+                (uPortUartEventCallbackSet(pInstance->transportHandle.uart,
+                                           U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
+                                           uartEventCallback, pMsgReceive,
+                                           U_GNSS_MSG_RECEIVE_STREAM_EVENT_STACK_SIZE_BYTES,
+                                           U_GNSS_MSG_RECEIVE_TASK_PRIORITY) == 0)) {
+                pMsgReceive->streamEventCallbackSet = true;
+            }
+            break;
+        case U_GNSS_PRIVATE_STREAM_TYPE_VIRTUAL_SERIAL:
+            pDeviceSerial = (uDeviceSerial_t *) pInstance->transportHandle.pDeviceSerial;
+            if ((pDeviceSerial != NULL) &&
+                (pDeviceSerial->eventCallbackFilterGet != NULL) &&
+                (pDeviceSerial->eventCallbackSet != NULL) &&
+                (pDeviceSerial->eventCallbackFilterGet(pDeviceSerial) == 0) &&
+                (pDeviceSerial->eventCallbackSet(pDeviceSerial,
+                                                 U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED,
+                                                 deviceSerialEventCallback, pMsgReceive,
+                                                 U_GNSS_MSG_RECEIVE_STREAM_EVENT_STACK_SIZE_BYTES,
+                                                 U_GNSS_MSG_RECEIVE_TASK_PRIORITY) == 0)) {
+                pMsgReceive->streamEventCallbackSet = true;
+            }
+            break;
+        default:
+            // I2C and SPI have no data-received event: the application
+            // may call uGnssMsgReceiveWake() from a TX-ready interrupt
+            break;
+    }
+
+    pMsgReceive->eventDriven = pMsgReceive->streamEventCallbackSet;
+}
+
+// Work out the dispatch table entry for a message ID.  For a
+// received message the entry is always one of the indexed ones;
+// for a wanted message ID it is zero (the catch-all entry) if the ID
+// includes wildcards which would stop it being found by the hash,
+// i.e. anything other than an exact UBX class/ID, an NMEA ID with
+// a full, non-wildcard, sentence formatter (the talker may be
+// wildcarded, e.g. "??GGA") or an exact RTCM message type.
+static size_t dispatchIndex(const uGnssPrivateMessageId_t *pId,
+                            bool wanted)
+{
+    size_t index = 0;
+    uint32_t key = 0;
+    const char *pSentence;
+
+    switch (pId->type) {
+        case U_GNSS_PROTOCOL_UBX:
+            if (!wanted ||
+                (((pId->id.ubx >> 8) != U_GNSS_UBX_MESSAGE_CLASS_ALL) &&
+                 ((pId->id.ubx & 0xFF) != U_GNSS_UBX_MESSAGE_ID_ALL))) {
+                key = 0x1000000 | pId->id.ubx;
+            }
+            break;
+        case U_GNSS_PROTOCOL_NMEA:
+            // Index on the sentence formatter, the three characters
+            // after the two-character talker ID
+            if (strlen(pId->id.nmea) >= 5) {
+                pSentence = pId->id.nmea + 2;
+                if (!wanted ||
+                    ((pSentence[0] != '?') && (pSentence[1] != '?') &&
+                     (pSentence[2] != '?'))) {
+                    key = 0x2000000 | (((uint32_t) (uint8_t) pSentence[0]) << 16) |
+                          (((uint32_t) (uint8_t) pSentence[1]) << 8) |
+                          ((uint32_t) (uint8_t) pSentence[2]);
+                }
+            } else if (!wanted) {
+                // Too short to have a sentence formatter: no indexed
+                // reader can want it, any entry will do
+                key = 0x2000000;
+            }
+            break;
+        case U_GNSS_PROTOCOL_RTCM:
+            if (!wanted || (pId->id.rtcm != U_GNSS_RTCM_MESSAGE_ID_ALL)) {
+                key = 0x3000000 | pId->id.rtcm;
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (key != 0) {
+        // Knuth's multiplicative hash spreads nearby IDs (e.g. the
+        // UBX-NAV messages) across the table
+        index = 1 + (((key * 2654435761UL) >> 16) %
+                     (U_GNSS_MSG_RECEIVE_DISPATCH_TABLE_SIZE - 1));
+    }
+
+    return index;
+}
+
+// Call an in-place callback with a view of what remains of the
+// current message in the ring buffer; the read handle of the
+// message receive task is locked, so the data cannot be
+// overwritten while the callback is looking at it.
+static void callbackInPlace(uGnssPrivateInstance_t *pInstance,
+                            uGnssPrivateMsgReader_t *pReader,
+                            const uGnssMessageId_t *pMessageId,
+                            int32_t errorCodeOrLength)
+{
+    uGnssPrivateMsgReceive_t *pMsgReceive = pInstance->pMsgReceive;
+    const char *pData1 = NULL;
+    size_t size1 = 0;
+    const char *pData2 = NULL;
+    size_t size2 = 0;
+
+    if (errorCodeOrLength > 0) {
+        // If another reader has extracted some of the message
+        // then only what is left is passed on
+        errorCodeOrLength = (int32_t) uRingBufferPeekInPlaceHandle(&(pInstance->ringBuffer),
+                                                                   pMsgReceive->ringBufferReadHandle,
+                                                                   pMsgReceive->msgBytesLeftToRead,
+                                                                   &pData1, &size1,
+                                                                   &pData2, &size2);
+    }
+    ((uGnssMsgReceiveCallbackInPlace_t) pReader->pCallback)(pInstance->gnssHandle,
+                                                            pMessageId,
+                                                            errorCodeOrLength,
+                                                            pData1, size1,
+                                                            pData2, size2,
+                                                            pReader->pCallbackParam);
+}
+
+// Keep a copy of the body of the UBX-NAV-PVT message that the
+// message receive task is currently looking at; pBuffer must
+// be U_GNSS_PRIVATE_NAV_PVT_BODY_LENGTH_BYTES long.
+static void pvtSnapshot(uGnssPrivateInstance_t *pInstance, char *pBuffer)
+{
+    uGnssPrivateMsgReceive_t *pMsgReceive = pInstance->pMsgReceive;
+
+    // Peek first, since that locks the transport mutex itself
+    if (uGnssPrivateStreamPeekRingBuffer(pInstance,
+                                         pMsgReceive->ringBufferReadHandle,
+                                         pBuffer,
+                                         U_GNSS_PRIVATE_NAV_PVT_BODY_LENGTH_BYTES,
+                                         U_UBX_PROTOCOL_HEADER_LENGTH_BYTES,
+                                         U_GNSS_MSG_READ_TIMEOUT_MS) ==
+        U_GNSS_PRIVATE_NAV_PVT_BODY_LENGTH_BYTES) {
+
+        U_PORT_MUTEX_LOCK(pInstance->transportMutex);
+
+        memcpy(pMsgReceive->pvtBody, pBuffer, sizeof(pMsgReceive->pvtBody));
+        pMsgReceive->pvtTimeMs = uPortGetTickTimeMs();
+        pMsgReceive->pvtValid = true;
+
+        U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
+    }
+}
+
 // Task that runs the non-blocking message receive.
 static void msgReceiveTask(void *pParam)
 {
@@ -143,6 +347,9 @@ static void msgReceiveTask(void *pParam)
     char queueItem[U_GNSS_MSG_RECEIVE_TASK_QUEUE_ITEM_SIZE_BYTES];
     uGnssPrivateMsgReceive_t *pMsgReceive = pInstance->pMsgReceive;
     uGnssPrivateMsgReader_t *pReader;
+    uGnssPrivateMsgReader_t *pIndexed;
+    uGnssPrivateMsgReader_t *pThis;
+    size_t index;
     int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_UNKNOWN;
     int32_t receiveSize;
     int32_t yieldTimeMs;
@@ -150,6 +357,7 @@ static void msgReceiveTask(void *pParam)
     uGnssMessageId_t messageId;
     uGnssPrivateMessageId_t privateMessageId;
     char nmeaId[U_GNSS_NMEA_MESSAGE_MATCH_LENGTH_CHARACTERS + 1];
+    char pvtBody[U_GNSS_PRIVATE_NAV_PVT_BODY_LENGTH_BYTES];
 
     U_PORT_MUTEX_LOCK(pMsgReceive->taskRunningMutexHandle);
 
@@ -183,30 +391,60 @@ static void msgReceiveTask(void *pParam)
                                                                        pMsgReceive->ringBufferReadHandle,
                                                                        &privateMessageId);
                 if ((errorCodeOrLength > 0) || (errorCodeOrLength == (int32_t) U_GNSS_ERROR_NACK)) {
+                    U_LOG_RAM_TRACE_BEGIN(U_LOG_RAM_TRACE_ID_GNSS_MSG_RECEIVE);
                     // Remember how long the message is
                     pMsgReceive->msgBytesLeftToRead = 0;
                     if (errorCodeOrLength > 0) {
                         pMsgReceive->msgBytesLeftToRead = errorCodeOrLength;
                     }
 
+                    if ((privateMessageId.type == U_GNSS_PROTOCOL_UBX) &&
+                        (privateMessageId.id.ubx == 0x0107) &&
+                        (errorCodeOrLength == sizeof(pvtBody) + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES)) {
+                        // A UBX-NAV-PVT message: keep a copy of it, before
+                        // any reader can extract it, so that uGnssPosGet()
+                        // can avoid polling for one
+                        pvtSnapshot(pInstance, pvtBody);
+                    }
                     if (uGnssPrivateMessageIdToPublic(&privateMessageId, &messageId, nmeaId) == 0) {
                         // Got something, with a message ID now in public form;
                         // go through the list of readers looking for those interested
 
                         U_PORT_MUTEX_LOCK(pMsgReceive->readerMutexHandle);
 
-                        pReader = pMsgReceive->pReaderList;
-                        while (pReader != NULL) {
+                        // Only the readers in the catch-all entry of the
+                        // dispatch table and the entry for this message
+                        // need be checked; since both are newest-first,
+                        // merging them by handle calls the callbacks in
+                        // the same order as pReaderList would
+                        pReader = pMsgReceive->pDispatch[0];
+                        index = dispatchIndex(&privateMessageId, false);
+                        pIndexed = NULL;
+                        if (index > 0) {
+                            pIndexed = pMsgReceive->pDispatch[index];
+                        }
+                        while ((pReader != NULL) || (pIndexed != NULL)) {
+                            if ((pReader == NULL) ||
+                                ((pIndexed != NULL) && (pIndexed->handle > pReader->handle))) {
+                                pThis = pIndexed;
+                                pIndexed = pIndexed->pNextDispatch;
+                            } else {
+                                pThis = pReader;
+                                pReader = pReader->pNextDispatch;
+                            }
                             if (uGnssPrivateMessageIdIsWanted(&privateMessageId,
-                                                              &(pReader->privateMessageId))) {
+                                                              &(pThis->privateMessageId))) {
                                 // This reader is interested, call the callback
-                                ((uGnssMsgReceiveCallback_t) pReader->pCallback)(pInstance->gnssHandle,
-                                                                                 &messageId,
-                                                                                 errorCodeOrLength,
-                                                                                 pReader->pCallbackParam);
+                                if (pThis->inPlace) {
+                                    callbackInPlace(pInstance, pThis, &messageId,
+                                                    errorCodeOrLength);
+                                } else {
+                                    ((uGnssMsgReceiveCallback_t) pThis->pCallback)(pInstance->gnssHandle,
+                                                                                   &messageId,
+                                                                                   errorCodeOrLength,
+                                                                                   pThis->pCallbackParam);
+                                }
                             }
-                            // Next!
-                            pReader = pReader->pNext;
                         }
 
                         U_PORT_MUTEX_UNLOCK(pMsgReceive->readerMutexHandle);
@@ -216,18 +454,27 @@ static void msgReceiveTask(void *pParam)
                     uRingBufferReadHandle(&(pInstance->ringBuffer),
                                           pMsgReceive->ringBufferReadHandle, NULL,
                                           pMsgReceive->msgBytesLeftToRead);
+                    U_LOG_RAM_TRACE_END(U_LOG_RAM_TRACE_ID_GNSS_MSG_RECEIVE);
                 }
             }
         }
 
-        // Relax to let others in; relax for twice as long if we last
-        // received nothing and aren't desperately seeking more data,
-        // in order to allow some data to build up
-        yieldTimeMs = U_GNSS_MSG_TASK_STACK_YIELD_TIME_MS;
-        if ((receiveSize == 0) && (errorCodeOrLength != (int32_t) U_ERROR_COMMON_TIMEOUT))  {
-            yieldTimeMs *= 2;
+        if (pMsgReceive->eventDriven &&
+            (errorCodeOrLength != (int32_t) U_ERROR_COMMON_TIMEOUT)) {
+            // Nothing part-received, so wait to be woken up by the
+            // arrival of more data, with a safety-net timeout
+            uPortSemaphoreTryTake(pMsgReceive->wakeSemaphoreHandle,
+                                  U_GNSS_MSG_RECEIVE_TASK_IDLE_TIME_MS);
+        } else {
+            // Relax to let others in; relax for twice as long if we last
+            // received nothing and aren't desperately seeking more data,
+            // in order to allow some data to build up
+            yieldTimeMs = U_GNSS_MSG_TASK_STACK_YIELD_TIME_MS;
+            if ((receiveSize == 0) && (errorCodeOrLength != (int32_t) U_ERROR_COMMON_TIMEOUT))  {
+                yieldTimeMs *= 2;
+            }
+            uPortTaskBlock(yieldTimeMs);
         }
-        uPortTaskBlock(yieldTimeMs);
     }
 
     // Now we can unlock our ring buffer read handle.  Phew.
@@ -278,15 +525,12 @@ int32_t msgReceiveCallbackRead(uDeviceHandle_t gnssHandle,
     return errorCodeOrLength;
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS THAT ARE PRIVATE TO GNSS
- * -------------------------------------------------------------- */
-
-// Start monitoring the output of the GNSS chip for a message.
-int32_t uGnssMsgPrivateReceiveStart(uGnssPrivateInstance_t *pInstance,
-                                    const uGnssPrivateMessageId_t *pPrivateMessageId,
-                                    uGnssMsgReceiveCallback_t pCallback,
-                                    void *pCallbackParam)
+// Start monitoring the output of the GNSS chip for a message,
+// with either a normal or an in-place callback.
+static int32_t receiveStart(uGnssPrivateInstance_t *pInstance,
+                            const uGnssPrivateMessageId_t *pPrivateMessageId,
+                            void *pCallback, void *pCallbackParam,
+                            bool inPlace)
 {
     int32_t errorCodeOrHandle = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
     uGnssPrivateMsgReceive_t *pMsgReceive;
@@ -325,6 +569,14 @@ int32_t uGnssMsgPrivateReceiveStart(uGnssPrivateInstance_t *pInstance,
                                     // Create the mutex for task running status
                                     errorCodeOrHandle = uPortMutexCreate(&(pMsgReceive->taskRunningMutexHandle));
                                     if (errorCodeOrHandle == 0) {
+                                        // Create the semaphore that wakes the task up
+                                        errorCodeOrHandle = uPortSemaphoreCreate(&(pMsgReceive->wakeSemaphoreHandle),
+                                                                                 0, 1);
+                                    }
+                                    if (errorCodeOrHandle == 0) {
+                                        // Hook into the data-received event of the
+                                        // transport, where there is one
+                                        streamEventCallbackSet(pInstance);
                                         //... and then the task
                                         errorCodeOrHandle = uPortTaskCreate(msgReceiveTask,
                                                                             pTaskName,
@@ -345,6 +597,10 @@ int32_t uGnssMsgPrivateReceiveStart(uGnssPrivateInstance_t *pInstance,
                         }
                         if (errorCodeOrHandle != 0) {
                             // Tidy up if we couldn't get OS resources
+                            uGnssPrivateMsgReceiveStreamEventCallbackRemove(pInstance);
+                            if (pMsgReceive->wakeSemaphoreHandle != NULL) {
+                                uPortSemaphoreDelete(pMsgReceive->wakeSemaphoreHandle);
+                            }
                             if (pMsgReceive->taskRunningMutexHandle != NULL) {
                                 uPortMutexDelete(pMsgReceive->taskRunningMutexHandle);
                             }
@@ -380,13 +636,17 @@ int32_t uGnssMsgPrivateReceiveStart(uGnssPrivateInstance_t *pInstance,
             pReader->handle = pInstance->pMsgReceive->nextHandle;
             pInstance->pMsgReceive->nextHandle++;
             pReader->privateMessageId = *pPrivateMessageId;
-            pReader->pCallback = (void *) pCallback;
+            pReader->pCallback = pCallback;
             pReader->pCallbackParam = pCallbackParam;
+            pReader->inPlace = inPlace;
             pReader->pNext = pInstance->pMsgReceive->pReaderList;
+            pReader->dispatchIndex = dispatchIndex(pPrivateMessageId, true);
+            pReader->pNextDispatch = pInstance->pMsgReceive->pDispatch[pReader->dispatchIndex];
 
             U_PORT_MUTEX_LOCK(pInstance->pMsgReceive->readerMutexHandle);
 
             pInstance->pMsgReceive->pReaderList = pReader;
+            pInstance->pMsgReceive->pDispatch[pReader->dispatchIndex] = pReader;
 
             U_PORT_MUTEX_UNLOCK(pInstance->pMsgReceive->readerMutexHandle);
 
@@ -398,6 +658,30 @@ int32_t uGnssMsgPrivateReceiveStart(uGnssPrivateInstance_t *pInstance,
     return errorCodeOrHandle;
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS THAT ARE PRIVATE TO GNSS
+ * -------------------------------------------------------------- */
+
+// Start monitoring the output of the GNSS chip for a message.
+int32_t uGnssMsgPrivateReceiveStart(uGnssPrivateInstance_t *pInstance,
+                                    const uGnssPrivateMessageId_t *pPrivateMessageId,
+                                    uGnssMsgReceiveCallback_t pCallback,
+                                    void *pCallbackParam)
+{
+    return receiveStart(pInstance, pPrivateMessageId, (void *) pCallback,
+                        pCallbackParam, false);
+}
+
+// Start monitoring the output of the GNSS chip for a message, in place.
+int32_t uGnssMsgPrivateReceiveStartInPlace(uGnssPrivateInstance_t *pInstance,
+                                           const uGnssPrivateMessageId_t *pPrivateMessageId,
+                                           uGnssMsgReceiveCallbackInPlace_t pCallback,
+                                           void *pCallbackParam)
+{
+    return receiveStart(pInstance, pPrivateMessageId, (void *) pCallback,
+                        pCallbackParam, true);
+}
+
 // Stop monitoring the output of the GNSS chip for a message.
 int32_t uGnssMsgPrivateReceiveStop(uGnssPrivateInstance_t *pInstance,
                                    int32_t asyncHandle)
@@ -406,6 +690,7 @@ int32_t uGnssMsgPrivateReceiveStop(uGnssPrivateInstance_t *pInstance,
     uGnssPrivateMsgReceive_t *pMsgReceive;
     uGnssPrivateMsgReader_t *pCurrent;
     uGnssPrivateMsgReader_t *pPrev = NULL;
+    uGnssPrivateMsgReader_t **ppDispatch;
 
     if (pInstance != NULL) {
         errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
@@ -424,6 +709,15 @@ int32_t uGnssMsgPrivateReceiveStop(uGnssPrivateInstance_t *pInstance,
                     } else {
                         pMsgReceive->pReaderList = pCurrent->pNext;
                     }
+                    // ...and from its dispatch table entry
+                    ppDispatch = &(pMsgReceive->pDispatch[pCurrent->dispatchIndex]);
+                    while (*ppDispatch != NULL) {
+                        if (*ppDispatch == pCurrent) {
+                            *ppDispatch = pCurrent->pNextDispatch;
+                        } else {
+                            ppDispatch = &((*ppDispatch)->pNextDispatch);
+                        }
+                    }
                     uPortFree(pCurrent);
                     pCurrent = NULL;
                     errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
@@ -657,6 +951,36 @@ int32_t uGnssMsgReceiveStart(uDeviceHandle_t gnssHandle,
     return errorCodeOrHandle;
 }
 
+// Monitor the output of the GNSS chip for a message, async version
+// with the message passed to the callback in place.
+int32_t uGnssMsgReceiveStartInPlace(uDeviceHandle_t gnssHandle,
+                                    const uGnssMessageId_t *pMessageId,
+                                    uGnssMsgReceiveCallbackInPlace_t pCallback,
+                                    void *pCallbackParam)
+{
+    int32_t errorCodeOrHandle = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateMessageId_t privateMessageId;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCodeOrHandle = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) &&
+            (uGnssPrivateMessageIdToPrivate(pMessageId, &privateMessageId) == 0)) {
+            errorCodeOrHandle = receiveStart(pInstance, &privateMessageId,
+                                             (void *) pCallback, pCallbackParam,
+                                             true);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCodeOrHandle;
+}
+
 // Read a message from the ring buffer into a user's buffer.
 // This function does NOT lock gUGnssPrivateMutex in order
 // that it can be called from pCallback; this is fine since
@@ -747,6 +1071,30 @@ int32_t uGnssMsgReceiveStackMinFree(uDeviceHandle_t gnssHandle)
     return errorCodeOrStackMinFree;
 }
 
+// Wake up the message receive task.
+int32_t uGnssMsgReceiveWake(uDeviceHandle_t gnssHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateMsgReceive_t *pMsgReceive;
+
+    // Note: deliberately does not lock gUGnssPrivateMutex so that
+    // this may be called from an interrupt handler
+    if (gUGnssPrivateMutex != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            pMsgReceive = pInstance->pMsgReceive;
+            if ((pMsgReceive != NULL) && (pMsgReceive->wakeSemaphoreHandle != NULL)) {
+                pMsgReceive->eventDriven = true;
+                errorCode = uPortSemaphoreGive(pMsgReceive->wakeSemaphoreHandle);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
 // Count of bytes lost for the non-blocking message receive handler.
 size_t uGnssMsgReceiveStatReadLoss(uDeviceHandle_t gnssHandle)
 {
@@ -793,4 +1141,69 @@ size_t uGnssMsgReceiveStatStreamLoss(uDeviceHandle_t gnssHandle)
     return bytesLost;
 }
 
+// The most data that has been waiting in the ring buffer.
+size_t uGnssMsgReceiveStatHighWaterMark(uDeviceHandle_t gnssHandle)
+{
+    size_t highWaterMark = 0;
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            highWaterMark = pInstance->ringBufferHighWaterMark;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return highWaterMark;
+}
+
+// Set a callback for when the ring buffer fill level crosses a threshold.
+int32_t uGnssMsgReceiveSetFillCallback(uDeviceHandle_t gnssHandle,
+                                       int32_t thresholdPercent,
+                                       uGnssMsgReceiveFillCallback_t pCallback,
+                                       void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) &&
+            ((pCallback == NULL) || ((thresholdPercent > 0) && (thresholdPercent <= 100)))) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (pInstance->pLinearBuffer != NULL) {
+                // Lock the transport mutex so that we can't be
+                // changing things while the callback is being called,
+                // at least from anywhere other than the message
+                // receive task
+                U_PORT_MUTEX_LOCK(pInstance->transportMutex);
+
+                pInstance->pRingBufferFillCallback = NULL;
+                pInstance->ringBufferFillThresholdBytes = ((pInstance->ringBufferLengthBytes - 1) *
+                                                           thresholdPercent) / 100;
+                pInstance->ringBufferFillAboveThreshold = false;
+                pInstance->pRingBufferFillCallbackParam = pCallbackParam;
+                pInstance->pRingBufferFillCallback = (void *) pCallback;
+
+                U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
+
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
 // End of file
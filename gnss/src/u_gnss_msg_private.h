@@ -80,6 +80,29 @@ int32_t uGnssMsgPrivateReceiveStart(uGnssPrivateInstance_t *pInstance,
                                     uGnssMsgReceiveCallback_t pCallback,
                                     void *pCallbackParam);
 
+/** As uGnssMsgPrivateReceiveStart() but the callback is given the
+ * message in place, see uGnssMsgReceiveStartInPlace().
+ *
+ * @param[in] pInstance          a pointer to the GNSS instance, cannot
+ *                               be NULL.
+ * @param[in] pPrivateMessageId  a pointer to the message ID to capture;
+ *                               a copy will be taken so this may be
+ *                               on the stack; cannot be NULL.
+ * @param[in] pCallback          the callback to be called when a
+ *                               matching message arrives; the same
+ *                               restrictions apply as for
+ *                               uGnssMsgPrivateReceiveStart(), cannot
+ *                               be NULL.
+ * @param[in] pCallbackParam     will be passed to pCallback as its last
+ *                               parameter.
+ * @return                       a handle for this asynchronous reader on
+ *                               success, else negative error code.
+ */
+int32_t uGnssMsgPrivateReceiveStartInPlace(uGnssPrivateInstance_t *pInstance,
+                                           const uGnssPrivateMessageId_t *pPrivateMessageId,
+                                           uGnssMsgReceiveCallbackInPlace_t pCallback,
+                                           void *pCallbackParam);
+
 /** Stop monitoring the output of the GNSS chip for a message.
  * Once this function returns the pCallback function passed to the
  * associated uGnssMsgPrivateReceiveStart() will no longer be called.
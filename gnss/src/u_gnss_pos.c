@@ -59,6 +59,7 @@
 #include "u_gnss_msg.h"
 #include "u_gnss_msg_private.h"
 #include "u_gnss_pos.h"
+#include "u_gnss_geofence.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -92,6 +93,13 @@
 #define U_GNSS_POS_RRLP_HEADER_SIZE_BYTES (U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES - 2)
 #endif
 
+/** The number of millimetres in one ten millionth of a degree of
+ * latitude, multiplied by 1000, used when checking a streamed position
+ * against a distance threshold; the same figure applies to longitude
+ * at the equator.
+ */
+#define U_GNSS_POS_MILLIMETRES_PER_DEGREE_X1E7_X1000 11132
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -266,6 +274,48 @@ static int32_t posGet(uGnssPrivateInstance_t *pInstance,
     return errorCode;
 }
 
+// Get position from the latest UBX-NAV-PVT message received by the
+// message receive task, if there is a recent enough one with a fix.
+static int32_t posGetStreamed(uGnssPrivateInstance_t *pInstance,
+                              int32_t *pLatitudeX1e7, int32_t *pLongitudeX1e7,
+                              int32_t *pAltitudeMillimetres,
+                              int32_t *pRadiusMillimetres,
+                              int32_t *pSpeedMillimetresPerSecond,
+                              int32_t *pSvs, int64_t *pTimeUtc)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+    uGnssPrivateMsgReceive_t *pMsgReceive = pInstance->pMsgReceive;
+    char message[U_GNSS_PRIVATE_NAV_PVT_BODY_LENGTH_BYTES];
+    bool fresh = false;
+
+    if ((U_GNSS_POS_STREAMED_PVT_MAX_AGE_MS > 0) && (pMsgReceive != NULL)) {
+
+        U_PORT_MUTEX_LOCK(pInstance->transportMutex);
+
+        if (pMsgReceive->pvtValid &&
+            (uPortGetTickTimeMs() - pMsgReceive->pvtTimeMs <= U_GNSS_POS_STREAMED_PVT_MAX_AGE_MS)) {
+            memcpy(message, pMsgReceive->pvtBody, sizeof(message));
+            fresh = true;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
+
+        if (fresh &&
+            (posDecode(message, NULL, NULL, NULL, NULL, NULL, NULL, NULL, false) == 0)) {
+            // Only write to the caller's variables if there is a fix,
+            // since otherwise we will poll
+            errorCode = posDecode(message,
+                                  pLatitudeX1e7, pLongitudeX1e7,
+                                  pAltitudeMillimetres,
+                                  pRadiusMillimetres,
+                                  pSpeedMillimetresPerSecond,
+                                  pSvs, pTimeUtc, true);
+        }
+    }
+
+    return errorCode;
+}
+
 // Establish position as a task.
 // IMPORTANT: this does NOT lock gUGnssPrivateMutex and hence it
 // is important that it is stopped before a pInstance is released.
@@ -320,6 +370,110 @@ static void posGetTask(void *pParameter)
     uPortTaskDelete(NULL);
 }
 
+// Return a good approximation to the cosine of an angle given in
+// ten millionths of a degree, between -90 and +90 degrees, multiplied
+// by 1000; this uses Bhaskara's approximation, which has an error of
+// less than 0.2%, to avoid bringing in floating point trigonometry.
+static int64_t cosX1000(int32_t angleX1e7)
+{
+    int64_t x = angleX1e7 / 100000; // Hundredths of a degree
+    int64_t xSquared = x * x;
+
+    // cos(x) ~= (4 * (90^2 - x^2)) / (4 * 90^2 + x^2), x in degrees
+    return (1000 * 4 * (81000000LL - xSquared)) / ((4 * 81000000LL) + xSquared);
+}
+
+// Return true if a streamed position should be passed to the
+// user's callback, taking into account the filter settings,
+// and, if so, update the stored state.
+static bool streamedFilterPass(uGnssPrivateStreamedPosition_t *pStreamedPosition,
+                               int32_t errorCode,
+                               int32_t latitudeX1e7, int32_t longitudeX1e7,
+                               int32_t speedMillimetresPerSecond,
+                               int32_t headingX1e5)
+{
+    bool pass = true;
+    bool isFix = (errorCode == 0);
+    int32_t nowMs = uPortGetTickTimeMs();
+    int64_t north;
+    int64_t east;
+    int64_t threshold;
+    int32_t x;
+
+    pStreamedPosition->messageCount++;
+    if (pStreamedPosition->reported &&
+        ((pStreamedPosition->maxIntervalMs <= 0) ||
+         (nowMs - pStreamedPosition->lastReportTimeMs < pStreamedPosition->maxIntervalMs))) {
+        // Not the first report and the maximum reporting interval
+        // has not been reached: check decimation
+        pass = (pStreamedPosition->messageCount >= pStreamedPosition->decimation);
+        if (pass) {
+            pStreamedPosition->messageCount = 0;
+            if ((pStreamedPosition->minDistanceMillimetres > 0) ||
+                (pStreamedPosition->minSpeedChangeMillimetresPerSecond > 0) ||
+                (pStreamedPosition->minHeadingChangeX1e5 > 0)) {
+                // There is at least one threshold: a change of fix
+                // state is always reported, else pass the fix on only
+                // if one of the thresholds has been reached
+                pass = (isFix != pStreamedPosition->lastReportWasFix);
+                if (!pass && isFix) {
+                    if (pStreamedPosition->minDistanceMillimetres > 0) {
+                        // Flat-earth approximation, which is fine for
+                        // the distances of interest here, compared
+                        // squared to avoid a square root
+                        north = ((int64_t) latitudeX1e7 - pStreamedPosition->lastLatitudeX1e7) *
+                                U_GNSS_POS_MILLIMETRES_PER_DEGREE_X1E7_X1000 / 1000;
+                        east = (int64_t) longitudeX1e7 - pStreamedPosition->lastLongitudeX1e7;
+                        if (east > 1800000000LL) {
+                            // Crossed the anti-meridian, take the short way round
+                            east -= 3600000000LL;
+                        } else if (east < -1800000000LL) {
+                            east += 3600000000LL;
+                        }
+                        east = (east * U_GNSS_POS_MILLIMETRES_PER_DEGREE_X1E7_X1000 / 1000) *
+                               cosX1000(latitudeX1e7) / 1000;
+                        threshold = pStreamedPosition->minDistanceMillimetres;
+                        pass = ((north * north) + (east * east) >= threshold * threshold);
+                    }
+                    if (!pass && (pStreamedPosition->minSpeedChangeMillimetresPerSecond > 0)) {
+                        x = speedMillimetresPerSecond - pStreamedPosition->lastSpeedMillimetresPerSecond;
+                        if (x < 0) {
+                            x = -x;
+                        }
+                        pass = (x >= pStreamedPosition->minSpeedChangeMillimetresPerSecond);
+                    }
+                    if (!pass && (pStreamedPosition->minHeadingChangeX1e5 > 0)) {
+                        x = headingX1e5 - pStreamedPosition->lastHeadingX1e5;
+                        if (x < 0) {
+                            x = -x;
+                        }
+                        if (x > 18000000) {
+                            // Heading wraps at 360 degrees
+                            x = 36000000 - x;
+                        }
+                        pass = (x >= pStreamedPosition->minHeadingChangeX1e5);
+                    }
+                }
+            }
+        }
+    }
+
+    if (pass) {
+        pStreamedPosition->messageCount = 0;
+        pStreamedPosition->reported = true;
+        pStreamedPosition->lastReportWasFix = isFix;
+        pStreamedPosition->lastReportTimeMs = nowMs;
+        if (isFix) {
+            pStreamedPosition->lastLatitudeX1e7 = latitudeX1e7;
+            pStreamedPosition->lastLongitudeX1e7 = longitudeX1e7;
+            pStreamedPosition->lastSpeedMillimetresPerSecond = speedMillimetresPerSecond;
+            pStreamedPosition->lastHeadingX1e5 = headingX1e5;
+        }
+    }
+
+    return pass;
+}
+
 // Callback that should receive a UBX-NAV-PVT message.
 static void messageCallback(uDeviceHandle_t gnssHandle,
                             const uGnssMessageId_t *pMessageId,
@@ -353,19 +507,35 @@ static void messageCallback(uDeviceHandle_t gnssHandle,
                                       &radiusMillimetres,
                                       &speedMillimetresPerSecond,
                                       &svs, &timeUtc, false);
-        // Call the callback
+        if ((errorCodeOrLength == 0) && (pInstance->pGeofence != NULL)) {
+            // Check every fix against any attached fences, whether
+            // or not the filter passes it on
+            uGnssGeofenceUpdate(pInstance->pGeofence,
+                                pInstance->pStreamedPosition->gnssHandle,
+                                latitudeX1e7, longitudeX1e7);
+        }
+        // Call the callback, if there is one and the filter lets
+        // the position through
         // Note: there can be two handles involved here, e.g. if
         // GNSS is inside a cellular device, hence we make sure
         // we pass back the one that came in
-        pInstance->pStreamedPosition->pCallback(pInstance->pStreamedPosition->gnssHandle,
-                                                errorCodeOrLength,
-                                                latitudeX1e7,
-                                                longitudeX1e7,
-                                                altitudeMillimetres,
-                                                radiusMillimetres,
-                                                speedMillimetresPerSecond,
-                                                svs,
-                                                timeUtc);
+        if ((pInstance->pStreamedPosition->pCallback != NULL) &&
+            streamedFilterPass(pInstance->pStreamedPosition, errorCodeOrLength,
+                               latitudeX1e7, longitudeX1e7,
+                               speedMillimetresPerSecond,
+                               (int32_t) uUbxProtocolUint32Decode(message +
+                                                                  U_UBX_PROTOCOL_HEADER_LENGTH_BYTES +
+                                                                  64))) {
+            pInstance->pStreamedPosition->pCallback(pInstance->pStreamedPosition->gnssHandle,
+                                                    errorCodeOrLength,
+                                                    latitudeX1e7,
+                                                    longitudeX1e7,
+                                                    altitudeMillimetres,
+                                                    radiusMillimetres,
+                                                    speedMillimetresPerSecond,
+                                                    svs,
+                                                    timeUtc);
+        }
     }
 }
 
@@ -423,7 +593,16 @@ int32_t uGnssPosGet(uDeviceHandle_t gnssHandle,
             }
 #endif
             startTime = uPortGetTickTimeMs();
-            errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+            errorCode = posGetStreamed(pInstance,
+                                       pLatitudeX1e7,
+                                       pLongitudeX1e7,
+                                       pAltitudeMillimetres,
+                                       pRadiusMillimetres,
+                                       pSpeedMillimetresPerSecond,
+                                       pSvs, pTimeUtc);
+            if (errorCode != 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+            }
             while ((errorCode == (int32_t) U_ERROR_COMMON_TIMEOUT) &&
                    (((pKeepGoingCallback == NULL) &&
                      (uPortGetTickTimeMs() - startTime) / 1000 < U_GNSS_POS_TIMEOUT_SECONDS) ||
@@ -582,6 +761,23 @@ int32_t uGnssPosGetStreamedStart(uDeviceHandle_t gnssHandle,
                                                     int32_t speedMillimetresPerSecond,
                                                     int32_t svs,
                                                     int64_t timeUtc))
+{
+    return uGnssPosGetStreamedStartFiltered(gnssHandle, rateMs, NULL, pCallback);
+}
+
+// Get filtered position readings constantly streamed to a callback.
+int32_t uGnssPosGetStreamedStartFiltered(uDeviceHandle_t gnssHandle,
+                                         int32_t rateMs,
+                                         const uGnssPosStreamedFilter_t *pFilter,
+                                         void (*pCallback) (uDeviceHandle_t gnssHandle,
+                                                            int32_t errorCode,
+                                                            int32_t latitudeX1e7,
+                                                            int32_t longitudeX1e7,
+                                                            int32_t altitudeMillimetres,
+                                                            int32_t radiusMillimetres,
+                                                            int32_t speedMillimetresPerSecond,
+                                                            int32_t svs,
+                                                            int64_t timeUtc))
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uGnssPrivateInstance_t *pInstance;
@@ -605,7 +801,9 @@ int32_t uGnssPosGetStreamedStart(uDeviceHandle_t gnssHandle,
 
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         pInstance = pUGnssPrivateGetInstance(gnssHandle);
-        if ((pInstance != NULL) && (pCallback != NULL) && (rateMs != 0)) {
+        if ((pInstance != NULL) &&
+            ((pCallback != NULL) || (pInstance->pGeofence != NULL)) &&
+            (rateMs != 0)) {
             errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
             if (uGnssPrivateGetStreamType(pInstance->transportType) >= 0) {
                 // The keyId for the msgout rates is port dependent but, neatly,
@@ -634,6 +832,14 @@ int32_t uGnssPosGetStreamedStart(uDeviceHandle_t gnssHandle,
                     pStreamedPosition->messageRate = -1;
                     pStreamedPosition->asyncHandle = -1;
                     pStreamedPosition->pCallback = pCallback;
+                    if (pFilter != NULL) {
+                        pStreamedPosition->decimation = pFilter->decimation;
+                        pStreamedPosition->minDistanceMillimetres = pFilter->minDistanceMillimetres;
+                        pStreamedPosition->minSpeedChangeMillimetresPerSecond =
+                            pFilter->minSpeedChangeMillimetresPerSecond;
+                        pStreamedPosition->minHeadingChangeX1e5 = pFilter->minHeadingChangeX1e5;
+                        pStreamedPosition->maxIntervalMs = pFilter->maxIntervalMs;
+                    }
                     pInstance->pStreamedPosition = pStreamedPosition;
                     errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                     if (rateMs >= 0) {
@@ -89,6 +89,18 @@
                                          U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) * 2)
 #endif
 
+#ifndef U_GNSS_AT_UBX_BATCH_MAX_LENGTH_BYTES
+/** Where several UBX-format messages are sent in one go over an AT
+ * interface (e.g. a set of UBX-CFG-VALSET messages), they are
+ * concatenated into a single AT+UGUBX command of up to this many
+ * bytes of UBX message (i.e. before hex encoding, which doubles the
+ * length) rather than each incurring an AT command round trip of
+ * its own; a message longer than this is sent on its own.  Set to
+ * zero to send each message with its own AT command.
+ */
+# define U_GNSS_AT_UBX_BATCH_MAX_LENGTH_BYTES 512
+#endif
+
 #ifndef U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES
 /** The minimum number of bytes to read on an SPI transport when
  * trying to determine if there's anything valid to read.
@@ -96,6 +108,17 @@
 # define U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES 1
 #endif
 
+#ifndef U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES
+/** The maximum number of bytes to read on an SPI transport when
+ * checking for data: while the GNSS chip has data to send the read
+ * length is doubled each time, up to this limit, so that a burst of
+ * messages is brought in using a few long transfers rather than
+ * many short ones.  The read buffer is on the stack and so this
+ * can be no larger than #U_GNSS_SPI_FILL_THRESHOLD_MAX.
+ */
+# define U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES U_GNSS_SPI_FILL_THRESHOLD_MAX
+#endif
+
 // Do some cross-checking
 #if U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES > U_GNSS_DEFAULT_SPI_FILL_THRESHOLD
 # error U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES must be less than or equal to U_GNSS_DEFAULT_SPI_FILL_THRESHOLD
@@ -105,6 +128,14 @@
 # error U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES must be less than or equal to U_GNSS_SPI_FILL_THRESHOLD_MAX
 #endif
 
+#if U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES > U_GNSS_SPI_FILL_THRESHOLD_MAX
+# error U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES must be less than or equal to U_GNSS_SPI_FILL_THRESHOLD_MAX
+#endif
+
+#if U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES < U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES
+# error U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES must be greater than or equal to U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES
+#endif
+
 #if U_GNSS_DEFAULT_SPI_FILL_THRESHOLD > U_GNSS_SPI_BUFFER_LENGTH_BYTES
 # error U_GNSS_DEFAULT_SPI_FILL_THRESHOLD must be less than or equal to U_GNSS_SPI_BUFFER_LENGTH_BYTES
 #endif
@@ -161,20 +192,15 @@ uPortMutexHandle_t gUGnssPrivateMutex = NULL;
 const uGnssPrivateModule_t gUGnssPrivateModuleList[] = {
     {
         U_GNSS_MODULE_TYPE_M8,
-        (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_OLD_CFG_API) /* features */
+        U_GNSS_PRIVATE_FEATURES_M8 /* features */
     },
     {
         U_GNSS_MODULE_TYPE_M9,
-        ((1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_CFGVALXXX) |
-         (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_OLD_CFG_API) |
-         (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_GEOFENCE)  /* features */
-        )
+        U_GNSS_PRIVATE_FEATURES_M9 /* features */
     },
     {
         U_GNSS_MODULE_TYPE_M10,
-        ((1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_CFGVALXXX) |
-         (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_RXM_MEAS_50_20_C12_D12)  /* features */
-        )
+        U_GNSS_PRIVATE_FEATURES_M10 /* features */
     }
 };
 
@@ -296,6 +322,32 @@ static void printId(uGnssPrivateMessageId_t *pId)
  * STATIC FUNCTIONS: STREAMING TRANSPORT ONLY
  * -------------------------------------------------------------- */
 
+// Return the number of SPI fill bytes at the start or, if atEnd
+// is true, the end of a buffer, comparing a word at a time where
+// possible; memcpy() is used to load each word so that there are no
+// alignment or aliasing issues, compilers turn it into a plain load.
+static size_t spiFillLength(const char *pBuffer, size_t size, bool atEnd)
+{
+    const uint8_t *pTmp = (const uint8_t *) pBuffer;
+    uint32_t word;
+    size_t length = 0;
+
+    while (length + sizeof(word) <= size) {
+        memcpy(&word, atEnd ? pTmp + size - length - sizeof(word) : pTmp + length,
+               sizeof(word));
+        if (word != 0xFFFFFFFFUL) {
+            break;
+        }
+        length += sizeof(word);
+    }
+    while ((length < size) &&
+           ((atEnd ? pTmp[size - length - 1] : pTmp[length]) == U_GNSS_PRIVATE_SPI_FILL)) {
+        length++;
+    }
+
+    return length;
+}
+
 // Read or peek-at the data in the internal ring buffer.
 static int32_t streamGetFromRingBuffer(uGnssPrivateInstance_t *pInstance,
                                        int32_t readHandle,
@@ -427,6 +479,23 @@ static int32_t sendMessageStream(uGnssPrivateInstance_t *pInstance,
     return errorCodeOrSentLength;
 }
 
+// The write function for the incremental UBX encoder: pParam is
+// the GNSS instance; the transport mutex must be locked.
+static int32_t encoderWriteStream(void *pParam, const char *pData,
+                                  size_t length)
+{
+    uGnssPrivateInstance_t *pInstance = (uGnssPrivateInstance_t *) pParam;
+    int32_t errorCodeOrSentLength;
+
+    errorCodeOrSentLength = sendMessageStream(pInstance, pData, length, false);
+    if (pInstance->printUbxMessages &&
+        (errorCodeOrSentLength == (int32_t) length)) {
+        uGnssPrivatePrintBuffer(pData, length);
+    }
+
+    return errorCodeOrSentLength;
+}
+
 // Receive a UBX format message over UART or I2C or SPI.
 // On entry pResponse should be set to the message class and ID of the
 // expected response, wild cards permitted.  On success it will
@@ -631,10 +700,140 @@ static int32_t sendReceiveUbxMessageAt(const uAtClientHandle_t atHandle,
     return errorCodeOrLength;
 }
 
+// Send a sequence of encoded UBX messages over an AT interface,
+// batching as many as will fit in U_GNSS_AT_UBX_BATCH_MAX_LENGTH_BYTES
+// into each AT+UGUBX command, and check the responses for Acks or
+// Nacks of the given message class/ID.  The AT interface returns
+// whatever response the GNSS chip sent to a batch, which may not
+// include an Ack for each message of that batch, hence the number
+// of Acks found is returned in pNumAcks and it is up to the caller
+// what to make of that; a Nack is always an error, as is an AT
+// command that fails.
+static int32_t sendUbxMessagesAt(const uAtClientHandle_t atHandle,
+                                 const char *pMessages, size_t size,
+                                 int32_t messageClass, int32_t messageId,
+                                 int32_t timeoutMs, bool printIt,
+                                 size_t *pNumAcks)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    int32_t x;
+    size_t offset = 0;
+    size_t batchSize;
+    size_t messageSize;
+    int32_t bytesRead;
+    const char *pResponse;
+    const char *pResponseEnd;
+    int32_t cls;
+    int32_t id;
+    char ackBody[2];
+    char *pBuffer;
+    bool atPrintOn = uAtClientPrintAtGet(atHandle);
+    bool atDebugPrintOn = uAtClientDebugGet(atHandle);
+
+    U_ASSERT(pNumAcks != NULL);
+
+    // One buffer, big enough for the hex of the lot, is used for
+    // every batch, for both the outgoing and the response
+    x = (int32_t) (size * 2) + 1; // +1 for terminator
+    if (x < U_GNSS_AT_BUFFER_LENGTH_BYTES + 1) {
+        x = U_GNSS_AT_BUFFER_LENGTH_BYTES + 1;
+    }
+    pBuffer = (char *) pUPortMalloc(x);
+    if (pBuffer != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if (!printIt) {
+            // As in sendReceiveUbxMessageAt()
+            uAtClientPrintAtSet(atHandle, false);
+            uAtClientDebugSet(atHandle, false);
+        }
+        while ((offset < size) && (errorCode == 0)) {
+            // Add whole messages to the batch while they fit,
+            // the length of each being in its header
+            batchSize = 0;
+            do {
+                messageSize = U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+                if (offset + batchSize + 6 <= size) {
+                    messageSize += uUbxProtocolUint16Decode(pMessages + offset + batchSize + 4);
+                }
+                if (offset + batchSize + messageSize > size) {
+                    // Shouldn't happen, but just in case, send the rest
+                    messageSize = size - (offset + batchSize);
+                }
+                if ((batchSize == 0) ||
+                    (batchSize + messageSize <= U_GNSS_AT_UBX_BATCH_MAX_LENGTH_BYTES)) {
+                    batchSize += messageSize;
+                } else {
+                    messageSize = 0;
+                }
+            } while ((messageSize > 0) && (offset + batchSize < size));
+            *(pBuffer + uBinToHex(pMessages + offset, batchSize, pBuffer)) = 0;
+            uAtClientLock(atHandle);
+            uAtClientTimeoutSet(atHandle, timeoutMs);
+            uAtClientCommandStart(atHandle, "AT+UGUBX=");
+            uAtClientWriteString(atHandle, pBuffer, true);
+            uAtClientCommandStop(atHandle);
+            if (printIt) {
+                uPortLog("U_GNSS: sent UBX command(s)");
+                uGnssPrivatePrintBuffer(pMessages + offset, batchSize);
+                uPortLog(".\n");
+            }
+            uAtClientResponseStart(atHandle, "+UGUBX:");
+            bytesRead = uAtClientReadString(atHandle, pBuffer, x, false);
+            uAtClientResponseStop(atHandle);
+            errorCode = (int32_t) U_GNSS_ERROR_TRANSPORT;
+            if (uAtClientUnlock(atHandle) == 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                if (bytesRead > 0) {
+                    // Look through the response for Acks/Nacks
+                    pResponse = pBuffer;
+                    pResponseEnd = pBuffer + uHexToBin(pBuffer, bytesRead, pBuffer);
+                    while ((pResponse < pResponseEnd) &&
+                           (uUbxProtocolDecode(pResponse, pResponseEnd - pResponse,
+                                               &cls, &id, ackBody, sizeof(ackBody),
+                                               &pResponse) >= 0)) {
+                        if ((cls == 0x05) && (ackBody[0] == (char) messageClass) &&
+                            (ackBody[1] == (char) messageId)) {
+                            if (id == 0x00) {
+                                errorCode = (int32_t) U_GNSS_ERROR_NACK;
+                            } else if (id == 0x01) {
+                                (*pNumAcks)++;
+                            }
+                        }
+                    }
+                }
+            }
+            offset += batchSize;
+        }
+
+        uAtClientPrintAtSet(atHandle, atPrintOn);
+        uAtClientDebugSet(atHandle, atDebugPrintOn);
+
+        uPortFree(pBuffer);
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: ANY TRANSPORT
  * -------------------------------------------------------------- */
 
+// Get the GNSS instance from the device instance of a GNSS device:
+// uGnssAdd() stores it there so that there's no need to search the
+// list.
+static uGnssPrivateInstance_t *pGnssInstanceFromDevice(uDeviceHandle_t gnssHandle)
+{
+    uGnssPrivateInstance_t *pInstance = NULL;
+    uDeviceInstance_t *pDevInstance = U_DEVICE_INSTANCE(gnssHandle);
+
+    if (uDeviceIsValidInstance(pDevInstance) &&
+        (pDevInstance->deviceType == U_DEVICE_TYPE_GNSS)) {
+        pInstance = (uGnssPrivateInstance_t *) pDevInstance->pPrivateInstance;
+    }
+
+    return pInstance;
+}
+
 // Send a UBX format message to the GNSS module and receive
 // the response.
 static int32_t sendReceiveUbxMessage(uGnssPrivateInstance_t *pInstance,
@@ -728,25 +927,19 @@ static int32_t sendReceiveUbxMessage(uGnssPrivateInstance_t *pInstance,
  * STATIC FUNCTIONS: MESSAGE PARSERS
  * -------------------------------------------------------------- */
 
-/** UBX Parser function.
+/** UBX parser, called by parseGnss() once the 0xB5 (µ) sync
+ * character has been read.
  *
  * @param parseHandle    the parse handle of the ring buffer to read from.
- * @param[in] pUserParam the user parameter passed to uRingBufferParseHandle().
+ * @param[out] pMsgId    the message ID to populate.
  * @return               negative error or success code.
  */
-static int32_t parseUbx(uParseHandle_t parseHandle, void *pUserParam)
+static int32_t parseUbx(uParseHandle_t parseHandle, uGnssPrivateMessageId_t *pMsgId)
 {
-    uGnssPrivateMessageId_t *pMsgId = (uGnssPrivateMessageId_t *) pUserParam;
     uint8_t by = 0;
     if (!uRingBufferGetByteUnprotected(parseHandle, &by)) {
         return U_ERROR_COMMON_TIMEOUT;
     }
-    if (0xB5 != by) {
-        return U_ERROR_COMMON_NOT_FOUND;    // = µ, 0xB5
-    }
-    if (!uRingBufferGetByteUnprotected(parseHandle, &by)) {
-        return U_ERROR_COMMON_TIMEOUT;
-    }
     if (0x62 != by) {
         return U_ERROR_COMMON_NOT_FOUND;    // = b
     }
@@ -801,23 +994,17 @@ static int32_t parseUbx(uParseHandle_t parseHandle, void *pUserParam)
     return U_ERROR_COMMON_SUCCESS;
 }
 
-/** NMEA Parser function.
+/** NMEA parser, called by parseGnss() once the '$' start
+ * character has been read.
  *
  * @param parseHandle    the parse handle of the ring buffer to read from.
- * @param[in] pUserParam the user parameter passed to uRingBufferParseHandle().
+ * @param[out] pMsgId    the message ID to populate.
  * @return               negative error or success code.
  */
-static int32_t parseNmea(uParseHandle_t parseHandle, void *pUserParam)
+static int32_t parseNmea(uParseHandle_t parseHandle, uGnssPrivateMessageId_t *pMsgId)
 {
-    uGnssPrivateMessageId_t *pMsgId = (uGnssPrivateMessageId_t *) pUserParam;
     char ch = 0;
     const char *hex = "0123456789ABCDEF";
-    if (!uRingBufferGetByteUnprotected(parseHandle, &ch)) {
-        return U_ERROR_COMMON_TIMEOUT;
-    }
-    if ('$' != ch) {
-        return U_ERROR_COMMON_NOT_FOUND;
-    }
     char crc = 0;
     int i = 0;
     while (uRingBufferGetByteUnprotected(parseHandle, &ch)) {
@@ -875,23 +1062,17 @@ static int32_t parseNmea(uParseHandle_t parseHandle, void *pUserParam)
     return U_ERROR_COMMON_SUCCESS;
 }
 
-/** RTCM Parser function.
+/** RTCM parser, called by parseGnss() once the 0xD3 preamble
+ * has been read.
  *
  * @param parseHandle    the parse handle of the ring buffer to read from.
- * @param[in] pUserParam the user parameter passed to uRingBufferParseHandle().
+ * @param[out] pMsgId    the message ID to populate.
  * @return               negative error or success code.
  */
-static int32_t parseRtcm(uParseHandle_t parseHandle, void *pUserParam)
+static int32_t parseRtcm(uParseHandle_t parseHandle, uGnssPrivateMessageId_t *pMsgId)
 {
-    uGnssPrivateMessageId_t *pMsgId = (uGnssPrivateMessageId_t *) pUserParam;
-    uint8_t by;
+    uint8_t by = 0xD3;
     uint32_t crc = 0;
-    if (!uRingBufferGetByteUnprotected(parseHandle, &by)) {
-        return U_ERROR_COMMON_TIMEOUT;
-    }
-    if (0xD3 != by) {
-        return U_ERROR_COMMON_NOT_FOUND;
-    }
     // CRC24Q check
     const uint32_t _crc24qTable[] = {
         /* 00 */ 0x000000, 0x864cfb, 0x8ad50d, 0x0c99f6, 0x93e6e1, 0x15aa1a, 0x1933ec, 0x9f7f17,
@@ -979,6 +1160,42 @@ static int32_t parseRtcm(uParseHandle_t parseHandle, void *pUserParam)
     return U_ERROR_COMMON_SUCCESS;
 }
 
+/** GNSS stream parser function: reads the first byte at the
+ * current position once and hands over to the UBX, NMEA or
+ * RTCM parser based on it, so that each position in the stream
+ * is examined in a single pass rather than once per protocol.
+ *
+ * @param parseHandle    the parse handle of the ring buffer to read from.
+ * @param[in] pUserParam the user parameter passed to uRingBufferParseHandle().
+ * @return               negative error or success code.
+ */
+static int32_t parseGnss(uParseHandle_t parseHandle, void *pUserParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+    uGnssPrivateMessageId_t *pMsgId = (uGnssPrivateMessageId_t *) pUserParam;
+    uint8_t by = 0;
+
+    if (!uRingBufferGetByteUnprotected(parseHandle, &by)) {
+        errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+    } else {
+        switch (by) {
+            case 0xB5: // = µ
+                errorCode = parseUbx(parseHandle, pMsgId);
+                break;
+            case '$':
+                errorCode = parseNmea(parseHandle, pMsgId);
+                break;
+            case 0xD3:
+                errorCode = parseRtcm(parseHandle, pMsgId);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: RATE CONFIGURATION
  * -------------------------------------------------------------- */
@@ -1405,22 +1622,20 @@ static int32_t getProtocolOutUbxCfgVal(uGnssPrivateInstance_t *pInstance)
  * PUBLIC FUNCTIONS THAT ARE PRIVATE TO GNSS: MISC
  * -------------------------------------------------------------- */
 
-// Find a GNSS instance in the list by instance handle.
+// Find a GNSS instance by instance handle.
 uGnssPrivateInstance_t *pUGnssPrivateGetInstance(uDeviceHandle_t handle)
 {
-    uGnssPrivateInstance_t *pInstance = gpUGnssPrivateInstanceList;
-    uDeviceHandle_t gnssHandle = uNetworkGetDeviceHandle(handle,
-                                                         U_NETWORK_TYPE_GNSS);
+    uGnssPrivateInstance_t *pInstance = NULL;
+    uDeviceHandle_t gnssHandle = handle;
+    uDeviceInstance_t *pDevInstance;
 
-    if (gnssHandle == NULL) {
-        // If the network function returned nothing then the handle
-        // we were given wasn't obtained through the network API,
-        // just use what we were given
-        gnssHandle = handle;
-    }
-    while ((pInstance != NULL) && (pInstance->gnssHandle != gnssHandle)) {
-        pInstance = pInstance->pNext;
+    if ((uDeviceGetInstance(handle, &pDevInstance) == 0) &&
+        (pDevInstance->deviceType != U_DEVICE_TYPE_GNSS)) {
+        // Not a GNSS device: if the GNSS network has been brought
+        // up on it then the network API knows the GNSS handle
+        gnssHandle = uNetworkGetDeviceHandle(handle, U_NETWORK_TYPE_GNSS);
     }
+    pInstance = pGnssInstanceFromDevice(gnssHandle);
 
     return pInstance;
 }
@@ -1428,13 +1643,9 @@ uGnssPrivateInstance_t *pUGnssPrivateGetInstance(uDeviceHandle_t handle)
 // Get the module characteristics for a given instance.
 const uGnssPrivateModule_t *pUGnssPrivateGetModule(uDeviceHandle_t gnssHandle)
 {
-    uGnssPrivateInstance_t *pInstance = gpUGnssPrivateInstanceList;
+    uGnssPrivateInstance_t *pInstance = pGnssInstanceFromDevice(gnssHandle);
     const uGnssPrivateModule_t *pModule = NULL;
 
-    while ((pInstance != NULL) && (pInstance->gnssHandle != gnssHandle)) {
-        pInstance = pInstance->pNext;
-    }
-
     if (pInstance != NULL) {
         pModule = pInstance->pModule;
     }
@@ -1716,6 +1927,132 @@ void uGnssPrivateCleanUpStreamedPos(uGnssPrivateInstance_t *pInstance)
     }
 }
 
+// Shut down and free memory from the time pulse functions.
+void uGnssPrivateCleanUpTimePulse(uGnssPrivateInstance_t *pInstance)
+{
+    size_t tries = 1 + U_GNSS_PRIVATE_STREAMED_POS_ENSURE_SETTINGS_RETRIES;
+    int32_t y;
+    uGnssPrivateTimePulse_t *pTimePulse;
+    uGnssPrivateMessageId_t privateMessageId =  {.type = U_GNSS_PROTOCOL_UBX,
+                                                 .id.ubx = 0x0d01
+                                                };
+    uGnssCfgVal_t cfgVal;
+
+    if ((pInstance != NULL) && (pInstance->pTimePulse != NULL)) {
+        pTimePulse = pInstance->pTimePulse;
+        if (pTimePulse->asyncHandle >= 0) {
+            uGnssMsgPrivateReceiveStop(pInstance, pTimePulse->asyncHandle);
+        }
+        // Put the UBX-TIM-TP message rate back
+        if (pTimePulse->messageRate >= 0) {
+            y = -1;
+            for (size_t x = 0; (x < tries) && (y < 0); x++) {
+                if (U_GNSS_PRIVATE_HAS(pInstance->pModule,
+                                       U_GNSS_PRIVATE_FEATURE_OLD_CFG_API)) {
+                    y = uGnssPrivateSetMsgRate(pInstance,
+                                               &privateMessageId,
+                                               pTimePulse->messageRate);
+                } else {
+                    cfgVal.keyId = U_GNSS_CFG_VAL_KEY_ID_MSGOUT_UBX_TIM_TP_I2C_U1 + pInstance->portNumber;
+                    cfgVal.value = pTimePulse->messageRate;
+                    y = uGnssCfgPrivateValSetList(pInstance, &cfgVal, 1,
+                                                  U_GNSS_CFG_VAL_TRANSACTION_NONE,
+                                                  U_GNSS_CFG_LAYERS_SET);
+                }
+            }
+        }
+        // Now we can free the storage
+        uPortFree(pTimePulse);
+        pInstance->pTimePulse = NULL;
+    }
+}
+
+// Shut down and free memory from message logging.
+void uGnssPrivateCleanUpLog(uGnssPrivateInstance_t *pInstance)
+{
+    uGnssPrivateLog_t *pLog;
+
+    if ((pInstance != NULL) && (pInstance->pLog != NULL)) {
+        pLog = pInstance->pLog;
+        // Stop the readers first so that nothing more is logged
+        for (size_t x = 0; x < pLog->numAsyncHandles; x++) {
+            if (pLog->pAsyncHandles[x] >= 0) {
+                uGnssMsgPrivateReceiveStop(pInstance, pLog->pAsyncHandles[x]);
+            }
+        }
+        if (pLog->taskRunningMutexHandle != NULL) {
+            // Tell the task to exit, which it will do once it
+            // has written out what is left, and wait for it
+            pLog->keepGoing = false;
+            if (pLog->wakeSemaphoreHandle != NULL) {
+                uPortSemaphoreGive(pLog->wakeSemaphoreHandle);
+            }
+            U_PORT_MUTEX_LOCK(pLog->taskRunningMutexHandle);
+            U_PORT_MUTEX_UNLOCK(pLog->taskRunningMutexHandle);
+            // Let the task actually exit
+            uPortTaskBlock(U_CFG_OS_YIELD_MS);
+            uPortMutexDelete(pLog->taskRunningMutexHandle);
+        }
+        if (pLog->wakeSemaphoreHandle != NULL) {
+            uPortSemaphoreDelete(pLog->wakeSemaphoreHandle);
+        }
+        if (pLog->notifyStop) {
+            pLog->pWriteCallback(pLog->gnssHandle, NULL, 0, pLog->pWriteCallbackParam);
+        }
+        uRingBufferDelete(&(pLog->ringBuffer));
+        // The buffers and handles are in the same allocation
+        uPortFree(pLog);
+        pInstance->pLog = NULL;
+    }
+}
+
+// Stop the task of a MON-COMMS sampler and free it.
+void uGnssPrivateCommsSamplerFree(uGnssPrivateCommsSampler_t *pCommsSampler)
+{
+    if (pCommsSampler != NULL) {
+        if (pCommsSampler->taskRunningMutexHandle != NULL) {
+            // The task will exit without touching the instance
+            // since keepGoing is already false: wake it and wait
+            if (pCommsSampler->wakeSemaphoreHandle != NULL) {
+                uPortSemaphoreGive(pCommsSampler->wakeSemaphoreHandle);
+            }
+            U_PORT_MUTEX_LOCK(pCommsSampler->taskRunningMutexHandle);
+            U_PORT_MUTEX_UNLOCK(pCommsSampler->taskRunningMutexHandle);
+            // Let the task actually exit
+            uPortTaskBlock(U_CFG_OS_YIELD_MS);
+            uPortMutexDelete(pCommsSampler->taskRunningMutexHandle);
+        }
+        if (pCommsSampler->wakeSemaphoreHandle != NULL) {
+            uPortSemaphoreDelete(pCommsSampler->wakeSemaphoreHandle);
+        }
+        // The sample is in the same allocation
+        uPortFree(pCommsSampler);
+    }
+}
+
+// Shut down and free memory from the MON-COMMS sampler.
+void uGnssPrivateCleanUpCommsSampler(uGnssPrivateInstance_t *pInstance)
+{
+    uGnssPrivateCommsSampler_t *pCommsSampler;
+
+    if ((pInstance != NULL) && (pInstance->pCommsSampler != NULL)) {
+        pCommsSampler = pInstance->pCommsSampler;
+        pInstance->pCommsSampler = NULL;
+        pCommsSampler->keepGoing = false;
+        uGnssPrivateCommsSamplerFree(pCommsSampler);
+    }
+}
+
+// Free memory from correction forwarding.
+void uGnssPrivateCleanUpCorrection(uGnssPrivateInstance_t *pInstance)
+{
+    if ((pInstance != NULL) && (pInstance->pCorrection != NULL)) {
+        // The carry buffer is in the same allocation
+        uPortFree(pInstance->pCorrection);
+        pInstance->pCorrection = NULL;
+    }
+}
+
 // Check whether the GNSS chip is on-board the cellular module.
 bool uGnssPrivateIsInsideCell(const uGnssPrivateInstance_t *pInstance)
 {
@@ -1749,6 +2086,32 @@ bool uGnssPrivateIsInsideCell(const uGnssPrivateInstance_t *pInstance)
     return isInside;
 }
 
+// Remove the data-received event callback of the asynchronous
+// message receive task from the streaming transport.
+void uGnssPrivateMsgReceiveStreamEventCallbackRemove(uGnssPrivateInstance_t *pInstance)
+{
+    uGnssPrivateMsgReceive_t *pMsgReceive;
+    uDeviceSerial_t *pDeviceSerial;
+
+    if ((pInstance != NULL) && (pInstance->pMsgReceive != NULL)) {
+        pMsgReceive = pInstance->pMsgReceive;
+        if (pMsgReceive->streamEventCallbackSet) {
+            switch (uGnssPrivateGetStreamType(pInstance->transportType)) {
+                case U_GNSS_PRIVATE_STREAM_TYPE_UART:
+                    uPortUartEventCallbackRemove(pInstance->transportHandle.uart);
+                    break;
+                case U_GNSS_PRIVATE_STREAM_TYPE_VIRTUAL_SERIAL:
+                    pDeviceSerial = (uDeviceSerial_t *) pInstance->transportHandle.pDeviceSerial;
+                    pDeviceSerial->eventCallbackRemove(pDeviceSerial);
+                    break;
+                default:
+                    break;
+            }
+            pMsgReceive->streamEventCallbackSet = false;
+        }
+    }
+}
+
 // Stop the asynchronous message receive task.
 void uGnssPrivateStopMsgReceive(uGnssPrivateInstance_t *pInstance)
 {
@@ -1759,8 +2122,14 @@ void uGnssPrivateStopMsgReceive(uGnssPrivateInstance_t *pInstance)
     if ((pInstance != NULL) && (pInstance->pMsgReceive != NULL)) {
         pMsgReceive = pInstance->pMsgReceive;
 
-        // Sending the task anything will cause it to exit
+        // Stop any data-received events first, since they
+        // refer to the semaphore that we are about to delete
+        uGnssPrivateMsgReceiveStreamEventCallbackRemove(pInstance);
+
+        // Sending the task anything will cause it to exit, waking
+        // it up in case it is waiting for data
         uPortQueueSend(pMsgReceive->taskExitQueueHandle, queueItem);
+        uPortSemaphoreGive(pMsgReceive->wakeSemaphoreHandle);
         U_PORT_MUTEX_LOCK(pMsgReceive->taskRunningMutexHandle);
         U_PORT_MUTEX_UNLOCK(pMsgReceive->taskRunningMutexHandle);
         // Wait for the task to actually exit: the STM32F4 platform
@@ -1779,6 +2148,7 @@ void uGnssPrivateStopMsgReceive(uGnssPrivateInstance_t *pInstance)
         uPortMutexDelete(pMsgReceive->taskRunningMutexHandle);
         uPortQueueDelete(pMsgReceive->taskExitQueueHandle);
         uPortMutexDelete(pMsgReceive->readerMutexHandle);
+        uPortSemaphoreDelete(pMsgReceive->wakeSemaphoreHandle);
 
         // Pause here to allow the deletions
         // to actually occur in the idle thread,
@@ -1976,15 +2346,33 @@ int32_t uGnssPrivateStreamGetReceiveSize(uGnssPrivateInstance_t *pInstance)
                 // whether there is any real stuff.  The data that is read is
                 // stored in the internal SPI ring buffer and can be read out
                 // by whoever called this function
+                // The read length starts at spiFillThreshold but is
+                // doubled while the GNSS chip has more to send; see
+                // below
                 spiReadLength = pInstance->spiFillThreshold;
+                if (pInstance->spiReadLength > pInstance->spiFillThreshold) {
+                    spiReadLength = pInstance->spiReadLength;
+                }
                 if (spiReadLength < U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES) {
                     spiReadLength = U_GNSS_PRIVATE_SPI_READ_LENGTH_MIN_BYTES;
                 }
+                if (spiReadLength > U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES) {
+                    spiReadLength = U_GNSS_PRIVATE_SPI_READ_LENGTH_MAX_BYTES;
+                }
                 errorCodeOrReceiveSize = uPortSpiControllerSendReceiveBlock(pInstance->transportHandle.spi,
                                                                             NULL, 0,
                                                                             spiBuffer,
                                                                             spiReadLength);
                 if (errorCodeOrReceiveSize > 0) {
+                    // If the read ended with real data then the GNSS
+                    // chip likely has more, so make the next read
+                    // longer; if it ended with fill, the GNSS chip has
+                    // run out, so go back to the short read
+                    if (spiFillLength(spiBuffer, errorCodeOrReceiveSize, true) == 0) {
+                        pInstance->spiReadLength = spiReadLength * 2;
+                    } else {
+                        pInstance->spiReadLength = 0;
+                    }
                     // This will add any non-fill SPI received data to the
                     // internal SPI ring buffer
                     errorCodeOrReceiveSize = uGnssPrivateSpiAddReceivedData(pInstance,
@@ -2021,9 +2409,7 @@ int32_t uGnssPrivateStreamDecodeRingBuffer(uRingBuffer_t *pRingBuffer,
     if ((pRingBuffer != NULL) && (pPrivateMessageId != NULL)) {
         while (1) {
             U_RING_BUFFER_PARSER_f parserList[] = {
-                parseUbx,
-                parseNmea,
-                parseRtcm,
+                parseGnss,
                 NULL
             };
             uGnssPrivateMessageId_t msg;
@@ -2083,6 +2469,34 @@ int32_t uGnssPrivateStreamDecodeRingBuffer(uRingBuffer_t *pRingBuffer,
     return errorCodeOrLength;
 }
 
+// Update the high-water mark of the internal ring buffer and, if
+// a fill callback is set, call it when the fill level rises to
+// or above the threshold.  The fill level is the amount of data that
+// is waiting for the locked (i.e. active) read handles since that
+// is what a forced add cannot push out of the way.
+static void ringBufferFillCheck(uGnssPrivateInstance_t *pInstance)
+{
+    size_t fillBytes = (pInstance->ringBufferLengthBytes - 1) -
+                       uRingBufferAvailableSizeMax(&(pInstance->ringBuffer));
+
+    if (fillBytes > pInstance->ringBufferHighWaterMark) {
+        pInstance->ringBufferHighWaterMark = fillBytes;
+    }
+    if (pInstance->pRingBufferFillCallback != NULL) {
+        if (fillBytes >= pInstance->ringBufferFillThresholdBytes) {
+            if (!pInstance->ringBufferFillAboveThreshold) {
+                pInstance->ringBufferFillAboveThreshold = true;
+                ((uGnssMsgReceiveFillCallback_t) pInstance->pRingBufferFillCallback)(pInstance->gnssHandle,
+                                                                                     fillBytes,
+                                                                                     pInstance->ringBufferLengthBytes - 1,
+                                                                                     pInstance->pRingBufferFillCallbackParam);
+            }
+        } else {
+            pInstance->ringBufferFillAboveThreshold = false;
+        }
+    }
+}
+
 // Fill the internal ring buffer with data from the GNSS chip.
 // IMPORTANT: this function should not do anything that has "global"
 // effect on the instance data since it may be called at any time
@@ -2094,6 +2508,8 @@ int32_t uGnssPrivateStreamFillRingBuffer(uGnssPrivateInstance_t *pInstance,
     int32_t startTimeMs;
     int32_t privateStreamTypeOrError;
     int32_t receiveSize;
+    int32_t reportedReceiveSize;
+    int32_t i2cPendingSize = 0;
     int32_t totalReceiveSize = 0;
     int32_t ringBufferAvailableSize;
     char *pTemporaryBuffer;
@@ -2116,7 +2532,16 @@ int32_t uGnssPrivateStreamFillRingBuffer(uGnssPrivateInstance_t *pInstance,
             // This is constructed as a do()/while() so that
             // it always has one go even with a zero timeout
             do {
-                receiveSize = uGnssPrivateStreamGetReceiveSize(pInstance);
+                if (i2cPendingSize > 0) {
+                    // The GNSS chip told us last time around that it has
+                    // more than we read: no need to ask it again, which
+                    // would cost two more I2C transactions
+                    receiveSize = i2cPendingSize;
+                } else {
+                    receiveSize = uGnssPrivateStreamGetReceiveSize(pInstance);
+                }
+                reportedReceiveSize = receiveSize;
+                i2cPendingSize = 0;
                 // Don't try to read in more than uRingBufferForceAdd()
                 // can put into the ring buffer
                 ringBufferAvailableSize = uRingBufferAvailableSizeMax(&(pInstance->ringBuffer));
@@ -2146,6 +2571,12 @@ int32_t uGnssPrivateStreamFillRingBuffer(uGnssPrivateInstance_t *pInstance,
                                                                         NULL, 0,
                                                                         pTemporaryBuffer,
                                                                         receiveSize);
+                            if (receiveSize > 0) {
+                                // The register address on the GNSS chip stays at
+                                // 0xFF, the data stream, so the remainder can be
+                                // read directly next time around
+                                i2cPendingSize = reportedReceiveSize - receiveSize;
+                            }
                             break;
                         case U_GNSS_PRIVATE_STREAM_TYPE_SPI:
                             // For the SPI case, we need to pull the data that was
@@ -2175,6 +2606,7 @@ int32_t uGnssPrivateStreamFillRingBuffer(uGnssPrivateInstance_t *pInstance,
                                                  pTemporaryBuffer, receiveSize)) {
                             errorCodeOrLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
                         }
+                        ringBufferFillCheck(pInstance);
                     } else {
                         // Error case
                         errorCodeOrLength = receiveSize;
@@ -2254,32 +2686,32 @@ int32_t uGnssPrivateSendOnlyStreamUbxMessage(uGnssPrivateInstance_t *pInstance,
                                              size_t messageBodyLengthBytes)
 {
     int32_t errorCodeOrSentLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-    int32_t bytesToSend = 0;
-    char *pBuffer;
+    uUbxProtocolEncoder_t encoder;
 
     if (pInstance != NULL) {
         if ((uGnssPrivateGetStreamType(pInstance->transportType) >= 0) &&
             (((pMessageBody == NULL) && (messageBodyLengthBytes == 0)) ||
              (messageBodyLengthBytes > 0))) {
-            errorCodeOrSentLength = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-
-            // Allocate a buffer big enough to encode the outgoing message
-            pBuffer = (char *) pUPortMalloc(messageBodyLengthBytes + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
-            if (pBuffer != NULL) {
-                bytesToSend = uUbxProtocolEncode(messageClass, messageId,
-                                                 pMessageBody, messageBodyLengthBytes,
-                                                 pBuffer);
 
-                U_PORT_MUTEX_LOCK(pInstance->transportMutex);
-
-                errorCodeOrSentLength = sendMessageStream(pInstance, pBuffer, bytesToSend,
-                                                          pInstance->printUbxMessages);
-
-                U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
+            U_PORT_MUTEX_LOCK(pInstance->transportMutex);
 
-                // Free memory
-                uPortFree(pBuffer);
+            // Encode the message straight onto the transport, rather
+            // than allocating a buffer big enough for all of it
+            if (pInstance->printUbxMessages) {
+                uPortLog("U_GNSS: sent command");
+            }
+            errorCodeOrSentLength = uUbxProtocolEncodeBegin(&encoder, messageClass, messageId,
+                                                            messageBodyLengthBytes,
+                                                            encoderWriteStream, pInstance);
+            if (errorCodeOrSentLength == 0) {
+                uUbxProtocolEncodeAppend(&encoder, pMessageBody, messageBodyLengthBytes);
+                errorCodeOrSentLength = uUbxProtocolEncodeFinish(&encoder);
+            }
+            if (pInstance->printUbxMessages) {
+                uPortLog(".\n");
             }
+
+            U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
         }
     }
 
@@ -2348,6 +2780,99 @@ int32_t uGnssPrivateSendOnlyCheckStreamUbxMessage(uGnssPrivateInstance_t *pInsta
     return errorCodeOrLength;
 }
 
+// Send a sequence of encoded UBX messages in one go and then wait
+// for all of their Acks.
+int32_t uGnssPrivateSendUbxMessagesAck(uGnssPrivateInstance_t *pInstance,
+                                             const char *pMessages, size_t size,
+                                             size_t numMessages,
+                                             int32_t messageClass,
+                                             int32_t messageId)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uGnssPrivateUbxReceiveMessage_t response = {0}; // Keep Valgrind happy
+    char ackBody[2] = {0};
+    char *pBody = &(ackBody[0]);
+    size_t numAcks = 0;
+    bool nacked = false;
+    int32_t startTimeMs;
+
+    if ((pInstance != NULL) && (pMessages != NULL) && (size > 0) && (numMessages > 0)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+        if (pInstance->transportType == U_GNSS_TRANSPORT_AT) {
+
+            U_PORT_MUTEX_LOCK(pInstance->transportMutex);
+
+            // Batched into as few AT commands as possible; a Nack
+            // or a failed AT command is an error, otherwise the
+            // messages have been delivered
+            //lint -e{1773} Suppress attempt to cast away const: I'm not!
+            errorCode = sendUbxMessagesAt((const uAtClientHandle_t) pInstance->transportHandle.pAt,
+                                          pMessages, size, messageClass, messageId,
+                                          pInstance->timeoutMs, pInstance->printUbxMessages,
+                                          &numAcks);
+
+            U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
+
+        } else if (uGnssPrivateGetStreamType(pInstance->transportType) >= 0) {
+
+            U_PORT_MUTEX_LOCK(pInstance->transportMutex);
+
+            // As in sendReceiveUbxMessage(), clear out any historical
+            // data and lock our read pointer before we send so that
+            // no Ack can be missed
+            uGnssPrivateStreamFillRingBuffer(pInstance,
+                                             U_GNSS_RING_BUFFER_MIN_FILL_TIME_MS,
+                                             U_GNSS_RING_BUFFER_MAX_FILL_TIME_MS);
+            uRingBufferLockReadHandle(&(pInstance->ringBuffer),
+                                      pInstance->ringBufferReadHandlePrivate);
+            uRingBufferFlushHandle(&(pInstance->ringBuffer),
+                                   pInstance->ringBufferReadHandlePrivate);
+
+            errorCode = (int32_t) U_GNSS_ERROR_TRANSPORT;
+            if (sendMessageStream(pInstance, pMessages, size,
+                                  pInstance->printUbxMessages) == (int32_t) size) {
+                // Now collect an Ack or a Nack for each message, ignoring
+                // any for other messages; the overall wait is bounded in
+                // case some other entity is causing Acks to arrive
+                startTimeMs = uPortGetTickTimeMs();
+                while ((numAcks < numMessages) &&
+                       (uPortGetTickTimeMs() - startTimeMs < pInstance->timeoutMs * (int32_t) numMessages)) {
+                    response.cls = 0x05;
+                    response.id = -1;
+                    response.ppBody = &pBody;
+                    response.bodySize = sizeof(ackBody);
+                    if (receiveUbxMessageStream(pInstance, &response, pInstance->timeoutMs,
+                                                pInstance->printUbxMessages) < 0) {
+                        // Nothing more is coming
+                        break;
+                    }
+                    if ((response.cls == 0x05) &&
+                        (ackBody[0] == (char) messageClass) && (ackBody[1] == (char) messageId)) {
+                        if (response.id == 0x00) {
+                            nacked = true;
+                            numAcks++;
+                        } else if (response.id == 0x01) {
+                            numAcks++;
+                        }
+                    }
+                }
+                errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+                if (nacked) {
+                    errorCode = (int32_t) U_GNSS_ERROR_NACK;
+                } else if (numAcks == numMessages) {
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                }
+            }
+
+            uRingBufferUnlockReadHandle(&(pInstance->ringBuffer), pInstance->ringBufferReadHandlePrivate);
+
+            U_PORT_MUTEX_UNLOCK(pInstance->transportMutex);
+        }
+    }
+
+    return errorCode;
+}
+
 // Receive an arbitrary message over UART or I2C or SPI or Virtual Serial.
 int32_t uGnssPrivateReceiveStreamMessage(uGnssPrivateInstance_t *pInstance,
                                          uGnssPrivateMessageId_t *pPrivateMessageId,
@@ -2449,19 +2974,13 @@ int32_t uGnssPrivateSpiAddReceivedData(uGnssPrivateInstance_t *pInstance,
                                        const char *pBuffer, size_t size)
 {
     int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-    const char *pTmp = pBuffer;
     int32_t y;
 
     if ((pInstance != NULL) && (pInstance->pSpiRingBuffer != NULL) &&
         (pBuffer != NULL) && (size > 0)) {
         if ((pInstance->spiFillThreshold > 0) && (size >= (size_t) pInstance->spiFillThreshold)) {
             // Check if all we have is fill and chuck stuff away if so
-            // Note: do the comparison as a uint8_t pointer to avoid
-            // issues with char being signed
-            for (size_t x = 0; (x < size) && ((*(const uint8_t *) pTmp) == U_GNSS_PRIVATE_SPI_FILL); x++) {
-                pTmp++;
-            }
-            y = pTmp - pBuffer;
+            y = (int32_t) spiFillLength(pBuffer, size, false);
             if (y >= pInstance->spiFillThreshold) {
                 pBuffer += y;
                 size -= y;
@@ -75,6 +75,56 @@ extern "C" {
 # define U_GNSS_RING_BUFFER_MIN_FILL_TIME_MS 100
 #endif
 
+#ifndef U_GNSS_MSG_RECEIVE_DISPATCH_TABLE_SIZE
+/** The number of entries in the table that the asynchronous message
+ * receive task uses to find the readers interested in a message:
+ * entry zero holds the readers that cannot be indexed (e.g. those
+ * that want all messages) while the rest hold readers indexed by
+ * UBX class/ID, NMEA sentence or RTCM message type.  Must be
+ * at least 2.
+ */
+# define U_GNSS_MSG_RECEIVE_DISPATCH_TABLE_SIZE 16
+#endif
+
+/** The length of the body of a UBX-NAV-PVT message.
+ */
+#define U_GNSS_PRIVATE_NAV_PVT_BODY_LENGTH_BYTES 92
+
+/** The feature bit-maps of the modules, one per entry in
+ * gUGnssPrivateModuleList, made up of uGnssPrivateFeature_t bits
+ * and named U_GNSS_PRIVATE_FEATURES_ + the module type without the
+ * U_GNSS_MODULE_TYPE_ prefix; see U_CFG_GNSS_MODULE_ONLY.
+ */
+#define U_GNSS_PRIVATE_FEATURES_M8                        \
+    (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_OLD_CFG_API)
+
+#define U_GNSS_PRIVATE_FEATURES_M9                           \
+    ((1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_CFGVALXXX) |   \
+     (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_OLD_CFG_API) | \
+     (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_GEOFENCE)      \
+    )
+
+#define U_GNSS_PRIVATE_FEATURES_M10                                   \
+    ((1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_CFGVALXXX) |            \
+     (1UL << (int32_t) U_GNSS_PRIVATE_FEATURE_RXM_MEAS_50_20_C12_D12) \
+    )
+
+/** Paste the expanded value of a macro onto a prefix.
+ */
+#define U_GNSS_PRIVATE_PASTE_(a, b) a##b
+#define U_GNSS_PRIVATE_PASTE(a, b) U_GNSS_PRIVATE_PASTE_(a, b)
+
+#ifdef U_CFG_GNSS_MODULE_ONLY
+/** U_CFG_GNSS_MODULE_ONLY may be defined to the module type, minus
+ * the U_GNSS_MODULE_TYPE_ prefix (e.g. M10), for a build that only
+ * ever talks to that one type of module; uGnssAdd() will then
+ * refuse any other module type and feature checks are resolved at
+ * compile time.
+ */
+# define U_GNSS_PRIVATE_MODULE_TYPE_ONLY U_GNSS_PRIVATE_PASTE(U_GNSS_MODULE_TYPE_, U_CFG_GNSS_MODULE_ONLY)
+# define U_GNSS_PRIVATE_FEATURES_ONLY U_GNSS_PRIVATE_PASTE(U_GNSS_PRIVATE_FEATURES_, U_CFG_GNSS_MODULE_ONLY)
+#endif
+
 /** Determine if the given feature is supported or not
  * by the pointed-to module.
  */
@@ -82,8 +132,13 @@ extern "C" {
 // evaluates to True
 //lint -esym(755, U_GNSS_PRIVATE_HAS) Suppress macro not
 // referenced it may be conditionally compiled-out.
-#define U_GNSS_PRIVATE_HAS(pModule, feature) \
+#ifdef U_CFG_GNSS_MODULE_ONLY
+# define U_GNSS_PRIVATE_HAS(pModule, feature) \
+    ((pModule != NULL) && ((U_GNSS_PRIVATE_FEATURES_ONLY) & (1UL << (int32_t) (feature))))
+#else
+# define U_GNSS_PRIVATE_HAS(pModule, feature) \
     ((pModule != NULL) && ((pModule->featuresBitmap) & (1UL << (int32_t) (feature))))
+#endif
 
 /** Flag to indicate that the pos task has run (for synchronisation
  * purposes.
@@ -179,6 +234,11 @@ typedef struct uGnssPrivateMsgReader_t {
                           all the types of uGnssTransparentReceiveCallback_t
                           into everything. */
     void *pCallbackParam;
+    bool inPlace; /**< true if pCallback is a uGnssMsgReceiveCallbackInPlace_t. */
+    size_t dispatchIndex; /**< the entry of pDispatch in uGnssPrivateMsgReceive_t
+                               that this reader is in. */
+    struct uGnssPrivateMsgReader_t *pNextDispatch; /**< the next reader in the
+                                                        same dispatch entry. */
     struct uGnssPrivateMsgReader_t *pNext;
 } uGnssPrivateMsgReader_t;
 
@@ -195,6 +255,23 @@ typedef struct {
     int32_t ringBufferReadHandle;
     size_t msgBytesLeftToRead;
     uGnssPrivateMsgReader_t *pReaderList;
+    uGnssPrivateMsgReader_t *pDispatch[U_GNSS_MSG_RECEIVE_DISPATCH_TABLE_SIZE]; /**< the
+                                     readers in pReaderList again, indexed by message ID,
+                                     newest first, each linked through pNextDispatch. */
+    uPortSemaphoreHandle_t wakeSemaphoreHandle; /**< given to wake the task up
+                                                     when data is available. */
+    bool streamEventCallbackSet; /**< true if we set the UART/virtual serial
+                                      event callback, hence must remove it. */
+    volatile bool eventDriven;   /**< true if the task may wait on
+                                      wakeSemaphoreHandle rather than poll. */
+    char pvtBody[U_GNSS_PRIVATE_NAV_PVT_BODY_LENGTH_BYTES]; /**< the body of the
+                                                                  latest UBX-NAV-PVT
+                                                                  message seen by the
+                                                                  task, protected by
+                                                                  transportMutex. */
+    int32_t pvtTimeMs;           /**< the tick time at which pvtBody was
+                                      written, valid only if pvtValid is true. */
+    bool pvtValid;               /**< true if pvtBody has been written. */
 } uGnssPrivateMsgReceive_t;
 
 /** Parameters to pass to the streamed position callback.
@@ -214,8 +291,105 @@ typedef struct {
     int32_t measurementPeriodMs; /**< set to -1 of nothing to restore. */
     int32_t navigationCount;     /**< set to -1 of nothing to restore. */
     int32_t messageRate;         /**< set to -1 of nothing to restore. */
+    int32_t decimation;          /**< report every Nth message, 0 or 1 for all. */
+    int32_t minDistanceMillimetres; /**< 0 for no distance threshold. */
+    int32_t minSpeedChangeMillimetresPerSecond; /**< 0 for no speed threshold. */
+    int32_t minHeadingChangeX1e5; /**< 0 for no heading threshold. */
+    int32_t maxIntervalMs;       /**< 0 for no maximum reporting interval. */
+    int32_t messageCount;        /**< messages since the last decimation point. */
+    bool reported;               /**< true once a first report has been made. */
+    bool lastReportWasFix;       /**< whether the last report was a position fix. */
+    int32_t lastReportTimeMs;    /**< tick time of the last report. */
+    int32_t lastLatitudeX1e7;    /**< latitude of the last reported fix. */
+    int32_t lastLongitudeX1e7;   /**< longitude of the last reported fix. */
+    int32_t lastSpeedMillimetresPerSecond; /**< speed of the last reported fix. */
+    int32_t lastHeadingX1e5;     /**< heading of motion of the last reported fix. */
 } uGnssPrivateStreamedPosition_t;
 
+/** Context for the time pulse functions of u_gnss_time.h.  The
+ * pending fields are written by the message receive task, as each
+ * UBX-TIM-TP message arrives, the pulse fields are written by
+ * uGnssTimePulseNotify(), potentially from an interrupt, under
+ * pulseSequence, which is odd while they are being written.
+ */
+typedef struct {
+    int32_t asyncHandle;
+    int32_t messageRate;         /**< set to -1 of nothing to restore. */
+    volatile bool pendingValid;  /**< true if the pending fields are complete. */
+    int64_t pendingTimeNanoseconds; /**< time of the next pulse from UBX-TIM-TP. */
+    int32_t pendingQErrPicoseconds; /**< quantisation error from UBX-TIM-TP. */
+    bool pendingUtc;             /**< true if the time base of UBX-TIM-TP is UTC. */
+    int32_t pendingTickTimeMs;   /**< local tick time when UBX-TIM-TP arrived. */
+    volatile uint32_t pulseSequence; /**< incremented before and after writing
+                                          the pulse fields. */
+    int64_t pulseTimeNanoseconds;
+    int32_t pulseQErrPicoseconds;
+    bool pulseUtc;
+    int32_t pulseTickTimeMs;
+    int32_t pulseCount;          /**< number of pulses paired with a UBX-TIM-TP. */
+    int32_t pulseUnpairedCount;  /**< number of pulses with no UBX-TIM-TP to go with. */
+} uGnssPrivateTimePulse_t;
+
+/** Context for logging messages, see u_gnss_log.h; the ring buffer
+ * between the message receive task (the producer) and the log task
+ * (the consumer) is lock-free.
+ */
+typedef struct {
+    uDeviceHandle_t gnssHandle;
+    int32_t *pAsyncHandles;    /**< one asynchronous reader per message ID. */
+    size_t numAsyncHandles;
+    uRingBuffer_t ringBuffer;
+    char *pWriteBuffer;        /**< where the log task copies data to write it. */
+    int32_t (*pWriteCallback)(uDeviceHandle_t, const char *, size_t, void *);
+    void *pWriteCallbackParam;
+    bool notifyStop;           /**< true if pWriteCallback should be told when logging stops. */
+    uPortTaskHandle_t taskHandle;
+    uPortMutexHandle_t taskRunningMutexHandle;
+    uPortSemaphoreHandle_t wakeSemaphoreHandle;
+    volatile bool keepGoing;
+    volatile int32_t lostCount; /**< messages dropped because the ring buffer was full. */
+} uGnssPrivateLog_t;
+
+/** Context for the background UBX-MON-COMMS sampler, see
+ * uGnssInfoCommsSamplerStart(); keepGoing and the sample are
+ * only written with gUGnssPrivateMutex locked.
+ */
+typedef struct {
+    uDeviceHandle_t gnssHandle;
+    struct uGnssPrivateInstance_t *pInstance;
+    int32_t port;
+    int32_t intervalMs;
+    struct uGnssInfoCommsThresholds_t *pThresholds; /**< a copy of the thresholds
+                                                         passed to uGnssInfoCommsSamplerStart(),
+                                                         in the same allocation as this. */
+    struct uGnssInfoCommsSample_t *pSample; /**< the latest sample, in the
+                                                 same allocation as this. */
+    void (*pCallback)(uDeviceHandle_t, uint32_t, const struct uGnssInfoCommsSample_t *, void *);
+    void *pCallbackParam;
+    uPortTaskHandle_t taskHandle;
+    uPortMutexHandle_t taskRunningMutexHandle;
+    uPortSemaphoreHandle_t wakeSemaphoreHandle;
+    volatile bool keepGoing;
+} uGnssPrivateCommsSampler_t;
+
+/** Context for forwarding correction data, see u_gnss_correction.h.
+ * pCarry holds a frame that straddles the chunks passed to
+ * uGnssCorrectionFeed() or, once carryReady is true, a complete
+ * and valid frame that the transport has only accepted carrySent
+ * bytes of; it is in the same allocation as this structure.
+ */
+typedef struct {
+    char *pCarry;
+    size_t carryLength;        /**< the number of bytes at pCarry. */
+    bool carryReady;           /**< true if pCarry starts with a complete, valid, frame. */
+    size_t carryFrameLength;   /**< the length of that frame, valid if carryReady is true. */
+    size_t carrySent;          /**< how much of that frame has been sent. */
+    size_t framesForwarded;
+    size_t bytesForwarded;
+    size_t framesBad;          /**< frames that failed their CRC check. */
+    size_t bytesDiscarded;     /**< bytes that were not part of any frame. */
+} uGnssPrivateCorrection_t;
+
 /** Parameters for AssistNow.
  */
 typedef struct {
@@ -245,12 +419,21 @@ typedef struct uGnssPrivateInstance_t {
     char *pSpiLinearBuffer; /**< the linear buffer that will be used by pSpiRingBuffer. */
     uRingBuffer_t ringBuffer; /**< the ring buffer where we put messages from the GNSS chip. */
     char *pLinearBuffer; /**< the linear buffer that will be used by ringBuffer. */
+    size_t ringBufferLengthBytes; /**< the size of pLinearBuffer. */
+    size_t ringBufferHighWaterMark; /**< the most data ever waiting in ringBuffer for a locked read handle. */
+    size_t ringBufferFillThresholdBytes; /**< the fill level at which pRingBufferFillCallback is called. */
+    bool ringBufferFillAboveThreshold; /**< true if the fill level is at or above ringBufferFillThresholdBytes. */
+    void *pRingBufferFillCallback; /**< stored as a void * to avoid having to bring
+                                        uGnssMsgReceiveFillCallback_t into everything. */
+    void *pRingBufferFillCallbackParam; /**< the parameter for pRingBufferFillCallback. */
     char *pTemporaryBuffer; /**< a temporary buffer, used to get stuff into ringBuffer. */
     int32_t ringBufferReadHandlePrivate; /**< the read handle for this code to use, -1 if there isn't one. */
     int32_t ringBufferReadHandleMsgReceive; /**< the read handle for uGnssUtilTransparentReceive(). */
     uint16_t i2cAddress; /**< the I2C address of the GNSS chip, only relevant if the transport is I2C. */
     int32_t timeoutMs; /**< the timeout for responses from the GNSS chip in milliseconds. */
     int32_t spiFillThreshold; /**< the number of 0xFF fill bytes which constitute "no data" on SPI. */
+    int32_t spiReadLength; /**< the length of the next SPI read when checking for
+                                data, adapted to the data flow; zero means not yet set. */
     bool printUbxMessages; /**< whether debug printing of UBX messages is on or off. */
     int32_t retriesOnNoResponse; /**< number of times to retry message transmission if there is no response. */
     int32_t pinGnssEnablePower; /**< the pin of the MCU that enables power to the GNSS module. */
@@ -269,8 +452,26 @@ typedef struct uGnssPrivateInstance_t {
                                                 message receive utility functions. */
     uGnssPrivateStreamedPosition_t *pStreamedPosition; /**< context data for streamed position, hooked
                                                             here so that we can free it */
+    uGnssPrivateTimePulse_t *pTimePulse; /**< context data for the time pulse, hooked
+                                              here so that we can free it */
+    uGnssPrivateLog_t *pLog; /**< context data for message logging, hooked
+                                  here so that we can free it */
+    uGnssPrivateCommsSampler_t *pCommsSampler; /**< context data for the
+                                                    MON-COMMS sampler, hooked
+                                                    here so that we can free it */
+    uGnssPrivateCorrection_t *pCorrection; /**< context data for correction
+                                                forwarding, hooked here so
+                                                that we can free it */
     uGnssRrlpMode_t rrlpMode; /**< The type of MEASX to use with RRLP capture. */
     uGnssPrivateMga_t *pMga; /**< Storage for AssistNow. */
+    struct uGnssGeofence_t *pGeofence; /**< the set of fences attached with
+                                            uGnssGeofenceAttach(), not owned
+                                            by this instance. */
+    int32_t pwrPlanStopTimeMs; /**< the tick time at which the fix of the
+                                    current uGnssPwrPlanCycle() gives up. */
+    bool (*pPwrPlanKeepGoingCallback) (uDeviceHandle_t); /**< the callback
+                                                              passed to
+                                                              uGnssPwrPlanCycle(). */
     struct uGnssPrivateInstance_t *pNext;
 } uGnssPrivateInstance_t;
 // *INDENT-ON*
@@ -300,10 +501,11 @@ extern uPortMutexHandle_t gUGnssPrivateMutex;
  * FUNCTIONS: MISC
  * -------------------------------------------------------------- */
 
-/** Find a GNSS instance in the list by instance handle.  Note
- * that this function accepts any handle from the device API, e.g.
- * if the GNSS network has been brought up on a cellular device then
- * the cellular device handle may be passed in.
+/** Find a GNSS instance by instance handle, through the device
+ * instance that the handle points to rather than by searching the
+ * list.  Note that this function accepts any handle from the device
+ * API, e.g. if the GNSS network has been brought up on a cellular
+ * device then the cellular device handle may be passed in.
  *
  * Note: gUGnssPrivateMutex should be locked before this is called.
  *
@@ -499,6 +701,52 @@ void uGnssPrivateCleanUpPosTask(uGnssPrivateInstance_t *pInstance);
  */
 void uGnssPrivateCleanUpStreamedPos(uGnssPrivateInstance_t *pInstance);
 
+/** Shut down and free memory from the time pulse functions; should be
+ * called before uGnssPrivateStopMsgReceive().
+ *
+ * Note: gUGnssPrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the GNSS instance, cannot  be NULL.
+ */
+void uGnssPrivateCleanUpTimePulse(uGnssPrivateInstance_t *pInstance);
+
+/** Shut down and free memory from message logging, flushing any
+ * logged data that has not yet been written; should be called
+ * before uGnssPrivateStopMsgReceive().
+ *
+ * Note: gUGnssPrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the GNSS instance, cannot  be NULL.
+ */
+void uGnssPrivateCleanUpLog(uGnssPrivateInstance_t *pInstance);
+
+/** Stop the task of a MON-COMMS sampler and free it; keepGoing
+ * must already have been set to false, with gUGnssPrivateMutex
+ * locked, and the sampler must already have been unhooked from
+ * its instance.  This function does not lock gUGnssPrivateMutex
+ * and may be called with it locked or unlocked.
+ *
+ * @param[in] pCommsSampler  a pointer to the sampler, may be NULL.
+ */
+void uGnssPrivateCommsSamplerFree(uGnssPrivateCommsSampler_t *pCommsSampler);
+
+/** Shut down and free memory from the MON-COMMS sampler.
+ *
+ * Note: gUGnssPrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the GNSS instance, cannot  be NULL.
+ */
+void uGnssPrivateCleanUpCommsSampler(uGnssPrivateInstance_t *pInstance);
+
+/** Free memory from correction forwarding; any correction data
+ * that has not yet been sent is discarded.
+ *
+ * Note: gUGnssPrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance  a pointer to the GNSS instance, cannot  be NULL.
+ */
+void uGnssPrivateCleanUpCorrection(uGnssPrivateInstance_t *pInstance);
+
 /** Check whether a GNSS chip that we are using via a cellular module
  * is on-board the cellular module, in which case the AT+GPIOC
  * comands are not used.
@@ -511,6 +759,14 @@ void uGnssPrivateCleanUpStreamedPos(uGnssPrivateInstance_t *pInstance);
 */
 bool uGnssPrivateIsInsideCell(const uGnssPrivateInstance_t *pInstance);
 
+/** Remove the data-received event callback that the asynchronous
+ * message receive task may have set on a UART or virtual serial
+ * transport; does nothing if no such callback was set.
+ *
+ * @param[in] pInstance  a pointer to the GNSS instance, cannot  be NULL.
+ */
+void uGnssPrivateMsgReceiveStreamEventCallbackRemove(uGnssPrivateInstance_t *pInstance);
+
 /** Stop the asynchronous message receive task; kept here so that
  * GNSS deinitialisation can call it.
  *
@@ -785,6 +1041,38 @@ int32_t uGnssPrivateSendOnlyCheckStreamUbxMessage(uGnssPrivateInstance_t *pInsta
                                                   const char *pMessageBody,
                                                   size_t messageBodyLengthBytes);
 
+/** Send a sequence of UBX format messages, already encoded (header,
+ * checksum and all) and concatenated, in a single write over a stream
+ * and then wait for an Ack or Nack for each of them; all of the
+ * messages must be of the same class and ID.  This allows messages
+ * that would otherwise each incur a round trip to be pipelined.
+ *
+ * On an AT transport the messages are instead batched into as few
+ * AT+UGUBX commands as possible (see U_GNSS_AT_UBX_BATCH_MAX_LENGTH_BYTES
+ * in u_gnss_private.c); the AT interface only returns what the GNSS
+ * chip sent in response to each command, which need not be an Ack per
+ * message, hence on an AT transport success means that no Nack was
+ * seen and every AT command succeeded.
+ *
+ * Note: gUGnssPrivateMutex should be locked before this is called.
+ *
+ * @param[in] pInstance   a pointer to the GNSS instance, cannot be NULL.
+ * @param[in] pMessages   the encoded messages; cannot be NULL.
+ * @param size            the number of bytes at pMessages.
+ * @param numMessages     the number of messages at pMessages, hence
+ *                        the number of Acks to wait for.
+ * @param messageClass    the UBX message class of the messages.
+ * @param messageId       the UBX message ID of the messages.
+ * @return                zero if all of the messages were Acked, else
+ *                        negative error code: #U_GNSS_ERROR_NACK if any
+ *                        were Nacked.
+ */
+int32_t uGnssPrivateSendUbxMessagesAck(uGnssPrivateInstance_t *pInstance,
+                                       const char *pMessages, size_t size,
+                                       size_t numMessages,
+                                       int32_t messageClass,
+                                       int32_t messageId);
+
 /** Wait for the given message, which can be of any type (not just UBX-format)
  * from the GNSS module; the WHOLE message is returned, i.e. header and CRC
  * etc. are included.  This function will internally call
@@ -0,0 +1,434 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the GNSS power plan API; this is built
+ * entirely on the public uGnssPwr, uGnssMga and uGnssPos APIs, it
+ * only looks inside the GNSS instance to find out what the transport
+ * permits.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset(), memcpy()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+
+#include "u_at_client.h"
+
+#include "u_ringbuffer.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss_private.h"
+#include "u_gnss_pwr.h"
+#include "u_gnss_mga.h"
+#include "u_gnss_pos.h"
+#include "u_gnss_pwr_plan.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** How long to wait between attempts to get a fix when a fix has
+ * been obtained but is not yet of the required accuracy; the GNSS
+ * device will not produce a better one any faster than its
+ * navigation rate.
+ */
+#define U_GNSS_PWR_PLAN_FIX_RETRY_INTERVAL_MS 1000
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Return true if waiting for a fix should continue.
+static bool keepGoing(uDeviceHandle_t gnssHandle, int32_t stopTimeMs,
+                      bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    return ((uPortGetTickTimeMs() - stopTimeMs) < 0) &&
+           ((pKeepGoingCallback == NULL) || pKeepGoingCallback(gnssHandle));
+}
+
+// The keep-going callback passed to uGnssPosGet(); this is called
+// with gUGnssPrivateMutex locked, hence pUGnssPrivateGetInstance()
+// can be used.
+static bool posKeepGoingCallback(uDeviceHandle_t gnssHandle)
+{
+    bool keepGoingFlag = false;
+    uGnssPrivateInstance_t *pInstance = pUGnssPrivateGetInstance(gnssHandle);
+
+    if (pInstance != NULL) {
+        keepGoingFlag = keepGoing(gnssHandle, pInstance->pwrPlanStopTimeMs,
+                                  pInstance->pPwrPlanKeepGoingCallback);
+    }
+
+    return keepGoingFlag;
+}
+
+// Wait for a fix of the required accuracy, populating pCycle.
+static int32_t fixGet(uDeviceHandle_t gnssHandle, const uGnssPwrPlan_t *pPlan,
+                      int32_t startTimeMs, uGnssPwrPlanCycle_t *pCycle,
+                      bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uGnssPrivateInstance_t *pInstance;
+    int32_t stopTimeMs = startTimeMs + (pPlan->maxTimeToFixSeconds * 1000);
+
+    U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+    pInstance = pUGnssPrivateGetInstance(gnssHandle);
+    if (pInstance != NULL) {
+        pInstance->pwrPlanStopTimeMs = stopTimeMs;
+        pInstance->pPwrPlanKeepGoingCallback = pKeepGoingCallback;
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+    U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+
+    if (errorCode == 0) {
+        do {
+            errorCode = uGnssPosGet(gnssHandle, &pCycle->latitudeX1e7,
+                                    &pCycle->longitudeX1e7, NULL,
+                                    &pCycle->radiusMillimetres, NULL, NULL,
+                                    &pCycle->timeUtc, posKeepGoingCallback);
+            if ((errorCode == 0) && (pCycle->radiusMillimetres > pPlan->accuracyMillimetres)) {
+                // A fix, but not good enough yet
+                errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+                uPortTaskBlock(U_GNSS_PWR_PLAN_FIX_RETRY_INTERVAL_MS);
+            }
+        } while ((errorCode == (int32_t) U_ERROR_COMMON_TIMEOUT) &&
+                 keepGoing(gnssHandle, stopTimeMs, pKeepGoingCallback));
+        if (errorCode == 0) {
+            pCycle->timeToFixMs = uPortGetTickTimeMs() - startTimeMs;
+        }
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            pInstance->pPwrPlanKeepGoingCallback = NULL;
+        }
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Callback for uGnssMgaGetDatabase(): append the chunk to the
+// database storage of the plan.
+static bool databaseCallback(uDeviceHandle_t devHandle,
+                             const char *pBuffer, size_t size,
+                             void *pCallbackParam)
+{
+    bool keepGoingFlag = true;
+    uGnssPwrPlan_t *pPlan = (uGnssPwrPlan_t *) pCallbackParam;
+
+    (void) devHandle;
+
+    if ((pBuffer != NULL) && (size > 0)) {
+        if (pPlan->databaseLength + size <= U_GNSS_PWR_PLAN_DATABASE_MAX_LENGTH_BYTES) {
+            memcpy(pPlan->pDatabase + pPlan->databaseLength, pBuffer, size);
+            pPlan->databaseLength += size;
+        } else {
+            // Too big: give up, a partial database is no use
+            keepGoingFlag = false;
+            pPlan->databaseLength = 0;
+        }
+    }
+
+    return keepGoingFlag;
+}
+
+// Save the navigation database of the GNSS device into the plan.
+static void databaseSave(uDeviceHandle_t gnssHandle, uGnssPwrPlan_t *pPlan)
+{
+    if (pPlan->pDatabase == NULL) {
+        pPlan->pDatabase = (char *) pUPortMalloc(U_GNSS_PWR_PLAN_DATABASE_MAX_LENGTH_BYTES);
+    }
+    pPlan->databaseLength = 0;
+    if ((pPlan->pDatabase != NULL) &&
+        (uGnssMgaGetDatabase(gnssHandle, databaseCallback, pPlan) < 0)) {
+        pPlan->databaseLength = 0;
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Work out a power plan.
+int32_t uGnssPwrPlanCalculate(int32_t fixIntervalSeconds,
+                              int32_t accuracyMillimetres,
+                              bool backupPossible,
+                              bool databasePossible,
+                              uGnssPwrPlan_t *pPlan)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    bool highAccuracy = (accuracyMillimetres < U_GNSS_PWR_PLAN_HIGH_ACCURACY_MILLIMETRES);
+    uint32_t optimiseForPower = 1UL << U_GNSS_PWR_FLAG_CYCLIC_TRACKING_OPTIMISE_FOR_POWER_ENABLE;
+
+    if ((pPlan != NULL) && (fixIntervalSeconds > 0) && (accuracyMillimetres > 0)) {
+        memset(pPlan, 0, sizeof(*pPlan));
+        pPlan->fixIntervalSeconds = fixIntervalSeconds;
+        pPlan->accuracyMillimetres = accuracyMillimetres;
+        pPlan->acquisitionPeriodSeconds = -1;
+        pPlan->acquisitionRetryPeriodSeconds = -1;
+        pPlan->onTimeSeconds = -1;
+        pPlan->maxAcquisitionTimeSeconds = -1;
+        pPlan->minAcquisitionTimeSeconds = -1;
+        pPlan->maxTimeToFixSeconds = U_GNSS_PWR_PLAN_MAX_TIME_TO_FIX_SECONDS;
+        if (fixIntervalSeconds < U_GNSS_PWR_PLAN_CYCLIC_TRACKING_MAX_INTERVAL_SECONDS) {
+            // Frequent fixes: stay tracking, power-optimised unless
+            // accuracy matters more; AssistNow Autonomous would
+            // only add load since the ephemeris is always fresh
+            pPlan->type = U_GNSS_PWR_PLAN_TYPE_CYCLIC_TRACKING;
+            pPlan->mode = U_GNSS_PWR_SAVING_MODE_CYCLIC_TRACKING;
+            pPlan->acquisitionPeriodSeconds = fixIntervalSeconds;
+            if (highAccuracy) {
+                pPlan->flagsClear = optimiseForPower;
+            } else {
+                pPlan->flagsSet = optimiseForPower;
+            }
+            // A fix may be waited for during up to one interval
+            pPlan->maxTimeToFixSeconds += fixIntervalSeconds;
+        } else if (fixIntervalSeconds < U_GNSS_PWR_PLAN_ON_OFF_MAX_INTERVAL_SECONDS) {
+            // The GNSS device switches itself off between fixes:
+            // each fix refreshes the ephemeris and AssistNow
+            // Autonomous covers the gaps, so there is no need
+            // for extra wake-ups to update the ephemeris
+            pPlan->type = U_GNSS_PWR_PLAN_TYPE_ON_OFF;
+            pPlan->mode = U_GNSS_PWR_SAVING_MODE_ON_OFF;
+            pPlan->acquisitionPeriodSeconds = fixIntervalSeconds;
+            pPlan->acquisitionRetryPeriodSeconds = fixIntervalSeconds;
+            pPlan->onTimeSeconds = 0;
+            if (highAccuracy) {
+                pPlan->onTimeSeconds = U_GNSS_PWR_PLAN_HIGH_ACCURACY_ON_TIME_SECONDS;
+            }
+            pPlan->maxAcquisitionTimeSeconds = U_GNSS_PWR_PLAN_MAX_TIME_TO_FIX_SECONDS;
+            if (pPlan->maxAcquisitionTimeSeconds > fixIntervalSeconds / 2) {
+                pPlan->maxAcquisitionTimeSeconds = fixIntervalSeconds / 2;
+            }
+            if (pPlan->maxAcquisitionTimeSeconds > 255) {
+                pPlan->maxAcquisitionTimeSeconds = 255;
+            }
+            pPlan->minAcquisitionTimeSeconds = 0;
+            pPlan->flagsClear = 1UL << U_GNSS_PWR_FLAG_EPHEMERIS_WAKE_ENABLE;
+            pPlan->assistNowAutonomous = true;
+            // The GNSS device may be asleep for up to one interval
+            // before it starts acquiring
+            pPlan->maxTimeToFixSeconds = fixIntervalSeconds +
+                                         pPlan->maxAcquisitionTimeSeconds +
+                                         pPlan->onTimeSeconds;
+        } else {
+            // Infrequent fixes: the MCU switches the GNSS device off,
+            // preferably into back-up so that it keeps its RTC and
+            // navigation database, else completely, in which case the
+            // navigation database is saved and restored by the MCU
+            pPlan->type = U_GNSS_PWR_PLAN_TYPE_HOST_OFF;
+            if (backupPossible) {
+                pPlan->type = U_GNSS_PWR_PLAN_TYPE_HOST_BACKUP;
+            }
+            pPlan->mode = U_GNSS_PWR_SAVING_MODE_NONE;
+            pPlan->assistNowAutonomous = true;
+            pPlan->databaseSaveRestore = (pPlan->type == U_GNSS_PWR_PLAN_TYPE_HOST_OFF) &&
+                                         databasePossible;
+        }
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
+// Work out and apply a power plan.
+int32_t uGnssPwrPlanSet(uDeviceHandle_t gnssHandle,
+                        int32_t fixIntervalSeconds,
+                        int32_t accuracyMillimetres,
+                        uGnssPwrPlan_t *pPlan)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    bool backupPossible = false;
+    bool databasePossible = false;
+    bool hasModeNone = false;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            // Back-up mode is left by activity on UART RXD or SPI CS,
+            // not I2C, and the navigation database can only be read
+            // over a streamed transport; neither are possible through
+            // an intermediate module
+            if (pInstance->intermediateHandle == NULL) {
+                backupPossible = (pInstance->transportType == U_GNSS_TRANSPORT_UART) ||
+                                 (pInstance->transportType == U_GNSS_TRANSPORT_UART_2) ||
+                                 (pInstance->transportType == U_GNSS_TRANSPORT_SPI);
+                databasePossible = (uGnssPrivateGetStreamType(pInstance->transportType) >= 0);
+            }
+            // There is no "none" power-saving mode before M9, the
+            // GNSS device is in continuous mode unless told otherwise
+            hasModeNone = U_GNSS_PRIVATE_HAS(pInstance->pModule,
+                                             U_GNSS_PRIVATE_FEATURE_CFGVALXXX);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+
+        // The rest is done through the public APIs, which
+        // do their own locking
+        if (errorCode == 0) {
+            errorCode = uGnssPwrPlanCalculate(fixIntervalSeconds, accuracyMillimetres,
+                                              backupPossible, databasePossible,
+                                              pPlan);
+        }
+        if ((errorCode == 0) &&
+            ((pPlan->mode != U_GNSS_PWR_SAVING_MODE_NONE) || hasModeNone)) {
+            errorCode = uGnssPwrSetMode(gnssHandle, pPlan->mode);
+        }
+        if ((errorCode == 0) && (pPlan->mode != U_GNSS_PWR_SAVING_MODE_NONE)) {
+            errorCode = uGnssPwrSetTiming(gnssHandle,
+                                          pPlan->acquisitionPeriodSeconds,
+                                          pPlan->acquisitionRetryPeriodSeconds,
+                                          pPlan->onTimeSeconds,
+                                          pPlan->maxAcquisitionTimeSeconds,
+                                          pPlan->minAcquisitionTimeSeconds);
+        }
+        if (errorCode == 0) {
+            // Not all flags are supported by all GNSS devices, so
+            // these are best effort
+            if (pPlan->flagsSet != 0) {
+                uGnssPwrSetFlag(gnssHandle, pPlan->flagsSet);
+            }
+            if (pPlan->flagsClear != 0) {
+                uGnssPwrClearFlag(gnssHandle, pPlan->flagsClear);
+            }
+            // Likewise, AssistNow Autonomous is only supported by
+            // standard precision GNSS devices
+            if (uGnssMgaSetAutonomous(gnssHandle, pPlan->assistNowAutonomous) < 0) {
+                pPlan->assistNowAutonomous = false;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Perform one cycle of a power plan.
+int32_t uGnssPwrPlanCycle(uDeviceHandle_t gnssHandle,
+                          uGnssPwrPlan_t *pPlan,
+                          uGnssPwrPlanCycle_t *pCycle,
+                          bool (*pKeepGoingCallback) (uDeviceHandle_t))
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPwrPlanCycle_t cycle = {.timeToFixMs = -1,
+                                 .onTimeMs = -1,
+                                 .chargeMicroampHours = -1,
+                                 .radiusMillimetres = -1
+                                };
+    int32_t startTimeMs;
+    bool hostControlled;
+    bool poweredOn = false;
+
+    if (gUGnssPrivateMutex != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pPlan != NULL) && ((int32_t) pPlan->type >= 0) &&
+            (pPlan->type < U_GNSS_PWR_PLAN_TYPE_MAX_NUM)) {
+            hostControlled = (pPlan->type == U_GNSS_PWR_PLAN_TYPE_HOST_BACKUP) ||
+                             (pPlan->type == U_GNSS_PWR_PLAN_TYPE_HOST_OFF);
+            startTimeMs = uPortGetTickTimeMs();
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (hostControlled) {
+                errorCode = uGnssPwrOn(gnssHandle);
+                if (errorCode == 0) {
+                    poweredOn = true;
+                    if (pPlan->databaseSaveRestore && (pPlan->pDatabase != NULL) &&
+                        (pPlan->databaseLength > 0)) {
+                        // Best effort: whatever is restored helps, see
+                        // the note about NACKs for uGnssMgaSetDatabase()
+                        uGnssMgaSetDatabase(gnssHandle, U_GNSS_MGA_FLOW_CONTROL_SMART,
+                                            pPlan->pDatabase, pPlan->databaseLength,
+                                            NULL, NULL);
+                    }
+                }
+            }
+            if (errorCode == 0) {
+                errorCode = fixGet(gnssHandle, pPlan, startTimeMs, &cycle,
+                                   pKeepGoingCallback);
+            }
+            if (poweredOn) {
+                if (pPlan->databaseSaveRestore) {
+                    databaseSave(gnssHandle, pPlan);
+                }
+                if (pPlan->type == U_GNSS_PWR_PLAN_TYPE_HOST_BACKUP) {
+                    uGnssPwrOffBackup(gnssHandle);
+                } else {
+                    uGnssPwrOff(gnssHandle);
+                }
+                cycle.onTimeMs = uPortGetTickTimeMs() - startTimeMs;
+                cycle.chargeMicroampHours = (int32_t) (((int64_t) cycle.onTimeMs *
+                                                        U_GNSS_PWR_PLAN_ON_CURRENT_MILLIAMPS) / 3600);
+                pPlan->totalOnTimeMs += cycle.onTimeMs;
+            }
+            pPlan->numCycles++;
+            if (errorCode == 0) {
+                pPlan->numFixes++;
+            }
+            if (pCycle != NULL) {
+                *pCycle = cycle;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Free any memory held by a power plan.
+void uGnssPwrPlanClear(uGnssPwrPlan_t *pPlan)
+{
+    if (pPlan != NULL) {
+        uPortFree(pPlan->pDatabase);
+        pPlan->pDatabase = NULL;
+        pPlan->databaseLength = 0;
+    }
+}
+
+// End of file
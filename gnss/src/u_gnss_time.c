@@ -0,0 +1,332 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the time pulse functions of the GNSS API.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+
+#include "u_at_client.h"
+
+#include "u_ubx_protocol.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss_private.h"
+#include "u_gnss_cfg_val_key.h"
+#include "u_gnss_cfg.h"
+#include "u_gnss_cfg_private.h"
+#include "u_gnss_msg.h"
+#include "u_gnss_msg_private.h"
+#include "u_gnss_time.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The length of the body of a UBX-TIM-TP message.
+ */
+#define U_GNSS_TIME_UBX_TIM_TP_BODY_LENGTH_BYTES 16
+
+/** The number of seconds between the Unix epoch, midnight on
+ * 1st January 1970, and the GPS epoch, midnight on 6th January 1980,
+ * which is also the origin of the week numbers of UBX-TIM-TP.
+ */
+#define U_GNSS_TIME_GPS_EPOCH_UNIX_SECONDS 315964800LL
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Callback for UBX-TIM-TP, called from the message receive task:
+// store the time of the next pulse as pending.
+static void messageCallback(uDeviceHandle_t gnssHandle,
+                            const uGnssMessageId_t *pMessageId,
+                            int32_t errorCodeOrLength,
+                            void *pCallbackParam)
+{
+    uGnssPrivateInstance_t *pInstance = (uGnssPrivateInstance_t *) pCallbackParam;
+    uGnssPrivateTimePulse_t *pTimePulse = pInstance->pTimePulse;
+    char message[U_GNSS_TIME_UBX_TIM_TP_BODY_LENGTH_BYTES + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES];
+    const char *pBody = message + U_UBX_PROTOCOL_HEADER_LENGTH_BYTES;
+    int64_t milliseconds;
+    int64_t nanoseconds;
+
+    (void) pMessageId;
+
+    if ((pTimePulse != NULL) && (errorCodeOrLength == (int32_t) sizeof(message)) &&
+        (uGnssMsgReceiveCallbackRead(gnssHandle, message,
+                                     sizeof(message)) == (int32_t) sizeof(message))) {
+        // Make sure that uGnssTimePulseNotify() doesn't take
+        // a half-written pending time
+        pTimePulse->pendingValid = false;
+        // Week, at offset 12, and time of week in milliseconds,
+        // at offset 0, with the sub-milliseconds, at offset 4,
+        // in units of 2^-32 milliseconds
+        milliseconds = ((int64_t) uUbxProtocolUint16Decode(pBody + 12)) * 604800000LL +
+                       (int64_t) uUbxProtocolUint32Decode(pBody);
+        nanoseconds = ((int64_t) uUbxProtocolUint32Decode(pBody + 4) * 1000000LL) >> 32;
+        pTimePulse->pendingTimeNanoseconds = (milliseconds +
+                                              (U_GNSS_TIME_GPS_EPOCH_UNIX_SECONDS * 1000)) * 1000000LL +
+                                             nanoseconds;
+        // Quantisation error at offset 8
+        pTimePulse->pendingQErrPicoseconds = (int32_t) uUbxProtocolUint32Decode(pBody + 8);
+        // Bit 0 of the flags, at offset 14, is set if the time base is UTC
+        pTimePulse->pendingUtc = ((*(pBody + 14) & 0x01) != 0);
+        pTimePulse->pendingTickTimeMs = uPortGetTickTimeMs();
+        pTimePulse->pendingValid = true;
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Start monitoring the time pulse.
+int32_t uGnssTimePulseStart(uDeviceHandle_t gnssHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateTimePulse_t *pTimePulse;
+    int32_t messageRate = -1;
+    uGnssPrivateMessageId_t ubxTimTpMessageId =  {.type = U_GNSS_PROTOCOL_UBX,
+                                                  .id.ubx = 0x0d01
+                                                 };
+    uint32_t keyId;
+    uGnssCfgVal_t *pCfgVal = NULL;
+    uGnssCfgVal_t cfgVal;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+            if (uGnssPrivateGetStreamType(pInstance->transportType) >= 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                if (pInstance->pTimePulse == NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    pTimePulse = (uGnssPrivateTimePulse_t *) pUPortMalloc(sizeof(*pTimePulse));
+                    if (pTimePulse != NULL) {
+                        memset(pTimePulse, 0, sizeof(*pTimePulse));
+                        pTimePulse->asyncHandle = -1;
+                        pTimePulse->messageRate = -1;
+                        pInstance->pTimePulse = pTimePulse;
+                        // Make sure that the UBX-TIM-TP message
+                        // is enabled at once per navigation solution
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                        if (U_GNSS_PRIVATE_HAS(pInstance->pModule,
+                                               U_GNSS_PRIVATE_FEATURE_OLD_CFG_API)) {
+                            messageRate = uGnssPrivateGetMsgRate(pInstance,
+                                                                 &ubxTimTpMessageId);
+                            if (messageRate != 1) {
+                                errorCode = uGnssPrivateSetMsgRate(pInstance,
+                                                                   &ubxTimTpMessageId, 1);
+                            }
+                        } else {
+                            // The keyId for the msgout rates is port dependent:
+                            // a base of the I2C value plus the port number (uGnssPort_t)
+                            keyId = U_GNSS_CFG_VAL_KEY_ID_MSGOUT_UBX_TIM_TP_I2C_U1 + pInstance->portNumber;
+                            if (uGnssCfgPrivateValGetListAlloc(pInstance,
+                                                               &keyId, 1,
+                                                               &pCfgVal,
+                                                               U_GNSS_CFG_VAL_LAYER_RAM) == 1) {
+                                messageRate = (int32_t) pCfgVal->value;
+                                uPortFree(pCfgVal);
+                            }
+                            if (messageRate != 1) {
+                                cfgVal.keyId = keyId;
+                                cfgVal.value = 1;
+                                errorCode = uGnssCfgPrivateValSetList(pInstance, &cfgVal, 1,
+                                                                      U_GNSS_CFG_VAL_TRANSACTION_NONE,
+                                                                      U_GNSS_CFG_LAYERS_SET);
+                            }
+                        }
+                        if ((errorCode == 0) && (messageRate != 1)) {
+                            pTimePulse->messageRate = messageRate;
+                        }
+                        if (errorCode == 0) {
+                            errorCode = uGnssMsgPrivateReceiveStart(pInstance,
+                                                                    &ubxTimTpMessageId,
+                                                                    messageCallback,
+                                                                    pInstance);
+                            if (errorCode >= 0) {
+                                pTimePulse->asyncHandle = errorCode;
+                                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                            }
+                        }
+                        if (errorCode != 0) {
+                            uGnssPrivateCleanUpTimePulse(pInstance);
+                        }
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Notify a time pulse; may be called from an interrupt.
+int32_t uGnssTimePulseNotify(uDeviceHandle_t gnssHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    int32_t tickTimeMs = uPortGetTickTimeMs();
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateTimePulse_t *pTimePulse;
+
+    // Note: deliberately does not lock gUGnssPrivateMutex so that
+    // this may be called from an interrupt handler
+    if (gUGnssPrivateMutex != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pInstance->pTimePulse != NULL)) {
+            pTimePulse = pInstance->pTimePulse;
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            if (pTimePulse->pendingValid &&
+                (tickTimeMs - pTimePulse->pendingTickTimeMs < U_GNSS_TIME_PULSE_MESSAGE_MAX_AGE_MS)) {
+                // Each UBX-TIM-TP is good for one pulse only
+                pTimePulse->pendingValid = false;
+                pTimePulse->pulseSequence++;
+                pTimePulse->pulseTimeNanoseconds = pTimePulse->pendingTimeNanoseconds;
+                pTimePulse->pulseQErrPicoseconds = pTimePulse->pendingQErrPicoseconds;
+                pTimePulse->pulseUtc = pTimePulse->pendingUtc;
+                pTimePulse->pulseTickTimeMs = tickTimeMs;
+                pTimePulse->pulseCount++;
+                pTimePulse->pulseSequence++;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            } else {
+                pTimePulse->pulseUnpairedCount++;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Get the most recent paired time pulse.
+int32_t uGnssTimePulseGet(uDeviceHandle_t gnssHandle,
+                          uGnssTimePulse_t *pTimePulse)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uGnssPrivateInstance_t *pInstance;
+    uGnssPrivateTimePulse_t *pPrivate;
+    uint32_t sequence;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if ((pInstance != NULL) && (pInstance->pTimePulse != NULL) &&
+            (pTimePulse != NULL)) {
+            pPrivate = pInstance->pTimePulse;
+            // Copy the pulse fields out, going around again if
+            // uGnssTimePulseNotify() was called in the meantime
+            do {
+                sequence = pPrivate->pulseSequence;
+                pTimePulse->timeNanoseconds = pPrivate->pulseTimeNanoseconds;
+                pTimePulse->utc = pPrivate->pulseUtc;
+                pTimePulse->quantisationErrorPicoseconds = pPrivate->pulseQErrPicoseconds;
+                pTimePulse->tickTimeMs = pPrivate->pulseTickTimeMs;
+                pTimePulse->count = pPrivate->pulseCount;
+            } while ((sequence & 1) || (sequence != pPrivate->pulseSequence));
+            errorCode = (int32_t) U_ERROR_COMMON_NOT_FOUND;
+            if (pTimePulse->count > 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Get the current time from the last time pulse and the local tick.
+int32_t uGnssTimeGetNow(uDeviceHandle_t gnssHandle,
+                        int64_t *pTimeNanoseconds)
+{
+    int32_t errorCodeOrAgeMs = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uGnssTimePulse_t timePulse;
+
+    if (pTimeNanoseconds != NULL) {
+        errorCodeOrAgeMs = uGnssTimePulseGet(gnssHandle, &timePulse);
+        if (errorCodeOrAgeMs == 0) {
+            errorCodeOrAgeMs = uPortGetTickTimeMs() - timePulse.tickTimeMs;
+            *pTimeNanoseconds = timePulse.timeNanoseconds +
+                                ((int64_t) errorCodeOrAgeMs) * 1000000LL;
+        }
+    }
+
+    return errorCodeOrAgeMs;
+}
+
+// Stop monitoring the time pulse.
+void uGnssTimePulseStop(uDeviceHandle_t gnssHandle)
+{
+    uGnssPrivateInstance_t *pInstance;
+
+    if (gUGnssPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUGnssPrivateMutex);
+
+        pInstance = pUGnssPrivateGetInstance(gnssHandle);
+        if (pInstance != NULL) {
+            uGnssPrivateCleanUpTimePulse(pInstance);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUGnssPrivateMutex);
+    }
+}
+
+// End of file
@@ -615,6 +615,7 @@ U_PORT_TEST_FUNCTION("[gnssCfg]", "gnssCfgValBasic")
     uint64_t savedValue;
     uGnssCfgVal_t *pCfgValList = NULL;
     int32_t numValues;
+    uint32_t hash;
     size_t iterations;
     uGnssTransportType_t transportTypes[U_GNSS_TRANSPORT_MAX_NUM];
 
@@ -704,6 +705,20 @@ U_PORT_TEST_FUNCTION("[gnssCfg]", "gnssCfgValBasic")
                 U_PORT_TEST_ASSERT(uGnssCfgValSetList(gnssHandle, pCfgValList, numValues,
                                                       U_GNSS_CFG_VAL_TRANSACTION_NONE,
                                                       U_GNSS_CFG_VAL_LAYER_RAM) == 0);
+                // ...and again with the pipelined transaction API, which
+                // should make no difference to the outcome
+                U_TEST_PRINT_LINE("writing GEOFENCE values as a transaction.");
+                U_PORT_TEST_ASSERT(uGnssCfgValSetListTransaction(gnssHandle, pCfgValList,
+                                                                 numValues,
+                                                                 U_GNSS_CFG_VAL_LAYER_RAM) == 0);
+                // Now that the values are there, a diff should write nothing
+                U_TEST_PRINT_LINE("checking that a diff of GEOFENCE values finds nothing to write.");
+                hash = 0;
+                U_PORT_TEST_ASSERT(uGnssCfgValSetListDiff(gnssHandle, pCfgValList, numValues,
+                                                          U_GNSS_CFG_VAL_LAYER_RAM, &hash) == 0);
+                U_PORT_TEST_ASSERT(hash == uGnssCfgValListHash(pCfgValList, numValues));
+                U_PORT_TEST_ASSERT(uGnssCfgValSetListDiff(gnssHandle, pCfgValList, numValues,
+                                                          U_GNSS_CFG_VAL_LAYER_RAM, &hash) == 0);
                 U_TEST_PRINT_LINE("reading back the modified GEOFENCE values.");
                 for (int32_t x = 0; x < numValues; x++) {
                     // Read the new values, entry by entry this time, and check
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Tests for the GNSS correction forwarding API: these should pass
+ * on all platforms that have a GNSS module connected to them.  They
+ * are only compiled if U_CFG_TEST_GNSS_MODULE_TYPE is defined.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the U_PORT_TEST_FUNCTION()
+ * macro.
+ */
+
+#ifdef U_CFG_TEST_GNSS_MODULE_TYPE
+
+# ifdef U_CFG_OVERRIDE
+#  include "u_cfg_override.h" // For a customer's configuration override
+# endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_at_client.h" // Required by u_gnss_private.h
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+#include "u_port_uart.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_spartn_test_data.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss.h"
+#include "u_gnss_correction.h"
+#include "u_gnss_private.h"
+
+#include "u_gnss_test_private.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_GNSS_CORRECTION_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+#ifndef U_GNSS_CORRECTION_TEST_CHUNK_LENGTH_BYTES
+/** The size of the chunks to feed correction data in: deliberately
+ * not a multiple of anything, so that frames straddle chunks.
+ */
+# define U_GNSS_CORRECTION_TEST_CHUNK_LENGTH_BYTES 1021
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Handles.
+ */
+static uGnssTestPrivate_t gHandles = U_GNSS_TEST_PRIVATE_DEFAULTS;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Forward the SPARTN test data, with some rubbish mixed in.
+ */
+U_PORT_TEST_FUNCTION("[gnssCorrection]", "gnssCorrectionBasic")
+{
+    uDeviceHandle_t gnssHandle;
+    int32_t resourceCount;
+    int32_t y;
+    size_t offset;
+    size_t length;
+    uGnssCorrectionStatistics_t statistics;
+    size_t iterations;
+    const char rubbish[] = "rubbish";
+    uGnssTransportType_t transportTypes[U_GNSS_TRANSPORT_MAX_NUM];
+
+    // In case a previous test failed
+    uGnssTestPrivateCleanup(&gHandles);
+
+    // Get the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Repeat for all transport types
+    iterations = uGnssTestPrivateTransportTypesSet(transportTypes, U_CFG_APP_GNSS_UART,
+                                                   U_CFG_APP_GNSS_I2C, U_CFG_APP_GNSS_SPI);
+    for (size_t w = 0; w < iterations; w++) {
+        // Do the standard preamble
+        U_TEST_PRINT_LINE("testing on transport %s...",
+                          pGnssTestPrivateTransportTypeName(transportTypes[w]));
+        U_PORT_TEST_ASSERT(uGnssTestPrivatePreamble(U_CFG_TEST_GNSS_MODULE_TYPE,
+                                                    transportTypes[w], &gHandles, true,
+                                                    U_CFG_APP_CELL_PIN_GNSS_POWER,
+                                                    U_CFG_APP_CELL_PIN_GNSS_DATA_READY) == 0);
+        gnssHandle = gHandles.gnssHandle;
+
+        // Nothing should work before correction forwarding is started
+        U_PORT_TEST_ASSERT(uGnssCorrectionFeed(gnssHandle, rubbish, sizeof(rubbish)) < 0);
+        U_PORT_TEST_ASSERT(uGnssCorrectionGetStatistics(gnssHandle, &statistics) < 0);
+
+        if (transportTypes[w] == U_GNSS_TRANSPORT_AT) {
+            // Correction forwarding is not supported on an AT transport
+            U_PORT_TEST_ASSERT(uGnssCorrectionStart(gnssHandle) < 0);
+        } else {
+            U_PORT_TEST_ASSERT(uGnssCorrectionStart(gnssHandle) == 0);
+            // Starting again should do no harm
+            U_PORT_TEST_ASSERT(uGnssCorrectionStart(gnssHandle) == 0);
+
+            // Rubbish first, then all of the test data in chunks
+            U_PORT_TEST_ASSERT(uGnssCorrectionFeed(gnssHandle, rubbish,
+                                                   sizeof(rubbish)) == (int32_t) sizeof(rubbish));
+            offset = 0;
+            while (offset < gUSpartnTestDataSize) {
+                length = gUSpartnTestDataSize - offset;
+                if (length > U_GNSS_CORRECTION_TEST_CHUNK_LENGTH_BYTES) {
+                    length = U_GNSS_CORRECTION_TEST_CHUNK_LENGTH_BYTES;
+                }
+                y = uGnssCorrectionFeed(gnssHandle, gUSpartnTestData + offset, length);
+                U_PORT_TEST_ASSERT(y >= 0);
+                if (y < (int32_t) length) {
+                    // Pushed back, give the transport a moment
+                    uPortTaskBlock(10);
+                }
+                offset += y;
+            }
+            // Make sure that nothing is left over
+            U_PORT_TEST_ASSERT(uGnssCorrectionGetStatistics(gnssHandle, &statistics) == 0);
+            for (size_t x = 0; (x < 100) && (statistics.bytesForwarded < gUSpartnTestDataSize); x++) {
+                uPortTaskBlock(10);
+                U_PORT_TEST_ASSERT(uGnssCorrectionFeed(gnssHandle, NULL, 0) == 0);
+                U_PORT_TEST_ASSERT(uGnssCorrectionGetStatistics(gnssHandle, &statistics) == 0);
+            }
+            U_TEST_PRINT_LINE("forwarded %d frame(s), %d byte(s), %d bad frame(s),"
+                              " %d byte(s) discarded.", (int32_t) statistics.framesForwarded,
+                              (int32_t) statistics.bytesForwarded, (int32_t) statistics.framesBad,
+                              (int32_t) statistics.bytesDiscarded);
+            U_PORT_TEST_ASSERT(statistics.framesForwarded == gUSpartnTestDataNumMessages);
+            U_PORT_TEST_ASSERT(statistics.bytesForwarded == gUSpartnTestDataSize);
+            U_PORT_TEST_ASSERT(statistics.framesBad == 0);
+            U_PORT_TEST_ASSERT(statistics.bytesDiscarded == sizeof(rubbish));
+
+            uGnssCorrectionStop(gnssHandle);
+            U_PORT_TEST_ASSERT(uGnssCorrectionGetStatistics(gnssHandle, &statistics) < 0);
+        }
+
+        // Do the standard postamble, leaving the module on for the next
+        // test to speed things up
+        uGnssTestPrivatePostamble(&gHandles, false);
+    }
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Clean-up to be run at the end of this round of tests, just
+ * in case there were test failures which would have resulted
+ * in the deinitialisation being skipped.
+ */
+U_PORT_TEST_FUNCTION("[gnssCorrection]", "gnssCorrectionCleanUp")
+{
+    uGnssTestPrivateCleanup(&gHandles);
+    uPortDeinit();
+    // Printed for information: asserting happens in the postamble
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+}
+
+#endif // #ifdef U_CFG_TEST_GNSS_MODULE_TYPE
+
+// End of file
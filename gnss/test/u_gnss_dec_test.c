@@ -53,6 +53,8 @@
 
 #include "u_test_util_resource_check.h"
 
+#include "u_ubx_protocol.h"
+
 #include "u_gnss_module_type.h"
 #include "u_gnss_type.h"
 #include "u_gnss.h"
@@ -224,13 +226,197 @@ static const uGnssDecTestDataKnown_t gUbxNavHpposllh[] = {
     }
 };
 
+/** Decoded test data for UBX-NAV-SAT, to be used by gUbxNavSat (item 0).
+ */
+static const uGnssDecUbxNavSat_t gUbxNavSatDecoded0 = {
+    486173000 /* iTOW */, 1 /* version */, 2 /* numSvs */, 2 /* svCount */,
+    {
+        {0 /* gnssId */, 5 /* svId */, 42 /* cno */, 67 /* elev */, 284 /* azim */, -13 /* prRes */, 0x0000191f /* flags */},
+        {2 /* gnssId */, 11 /* svId */, 37 /* cno */, -3 /* elev */, 150 /* azim */, 26 /* prRes */, 0x00000a1d /* flags */}
+    }
+};
+
+/** Array of test data for UBX-NAV-SAT.
+ */
+static const uGnssDecTestDataKnown_t gUbxNavSat[] = {
+    {
+        {
+            "\xb5\x62\x01\x35\x20\x00\x48\x69\xfa\x1c\x01\x02\x00\x00\x00\x05"
+            "\x2a\x43\x1c\x01\xf3\xff\x1f\x19\x00\x00\x02\x0b\x25\xfd\x96\x00"
+            "\x1a\x00\x1d\x0a\x00\x00\xdf\x27", 40
+        },
+        {
+            U_GNSS_PROTOCOL_UBX, 0x0135, NULL
+        },
+        (void *) &gUbxNavSatDecoded0
+    }
+};
+
+/** Decoded test data for UBX-NAV-SIG, to be used by gUbxNavSig (item 0).
+ */
+static const uGnssDecUbxNavSig_t gUbxNavSigDecoded0 = {
+    486173000 /* iTOW */, 0 /* version */, 2 /* numSigs */, 2 /* sigCount */,
+    {
+        {
+            0 /* gnssId */, 5 /* svId */, 0 /* sigId */, 0 /* freqId */, -13 /* prRes */, 42 /* cno */,
+            7 /* qualityInd */, 0 /* corrSource */, 1 /* ionoModel */, 0x0029 /* sigFlags */
+        },
+        {
+            6 /* gnssId */, 3 /* svId */, 2 /* sigId */, 9 /* freqId */, 4 /* prRes */, 30 /* cno */,
+            4 /* qualityInd */, 4 /* corrSource */, 8 /* ionoModel */, 0x01c9 /* sigFlags */
+        }
+    }
+};
+
+/** Array of test data for UBX-NAV-SIG.
+ */
+static const uGnssDecTestDataKnown_t gUbxNavSig[] = {
+    {
+        {
+            "\xb5\x62\x01\x43\x28\x00\x48\x69\xfa\x1c\x00\x02\x00\x00\x00\x05"
+            "\x00\x00\xf3\xff\x2a\x07\x00\x01\x29\x00\x00\x00\x00\x00\x06\x03"
+            "\x02\x09\x04\x00\x1e\x04\x04\x08\xc9\x01\x00\x00\x00\x00\x97\xff", 48
+        },
+        {
+            U_GNSS_PROTOCOL_UBX, 0x0143, NULL
+        },
+        (void *) &gUbxNavSigDecoded0
+    }
+};
+
+/** Decoded test data for UBX-RXM-RAWX, to be used by gUbxRxmRawx (item 0).
+ */
+static const uGnssDecUbxRxmRawx_t gUbxRxmRawxDecoded0 = {
+    486173.5 /* rcvTow */, 2275 /* week */, 18 /* leapS */, 2 /* numMeas */,
+    0x01 /* recStat */, 1 /* version */, 2 /* measCount */,
+    {
+        {
+            21234567.25 /* prMes */, 111587213.5 /* cpMes */, -1234.5 /* doMes */,
+            0 /* gnssId */, 5 /* svId */, 0 /* sigId */, 0 /* freqId */, 64500 /* locktime */,
+            42 /* cno */, 3 /* prStdev */, 2 /* cpStdev */, 5 /* doStdev */, 0x07 /* trkStat */
+        },
+        {
+            23456789.125 /* prMes */, -98765432.75 /* cpMes */, 2500.25 /* doMes */,
+            6 /* gnssId */, 3 /* svId */, 2 /* sigId */, 9 /* freqId */, 1200 /* locktime */,
+            30 /* cno */, 5 /* prStdev */, 15 /* cpStdev */, 7 /* doStdev */, 0x01 /* trkStat */
+        }
+    }
+};
+
+/** Array of test data for UBX-RXM-RAWX.
+ */
+static const uGnssDecTestDataKnown_t gUbxRxmRawx[] = {
+    {
+        {
+            "\xb5\x62\x02\x15\x50\x00\x00\x00\x00\x00\x76\xac\x1d\x41\xe3\x08"
+            "\x12\x02\x01\x01\x00\x00\x00\x00\x00\x74\x38\x40\x74\x41\x00\x00"
+            "\x00\x36\xbe\x9a\x9a\x41\x00\x50\x9a\xc4\x00\x05\x00\x00\xf4\xfb"
+            "\x2a\x03\x02\x05\x07\x00\x00\x00\x00\x52\xc1\x5e\x76\x41\x00\x00"
+            "\x00\xe3\x29\x8c\x97\xc1\x00\x44\x1c\x45\x06\x03\x02\x09\xb0\x04"
+            "\x1e\x05\x0f\x07\x01\x00\x8e\x27", 88
+        },
+        {
+            U_GNSS_PROTOCOL_UBX, 0x0215, NULL
+        },
+        (void *) &gUbxRxmRawxDecoded0
+    }
+};
+
+/** Decoded test data for UBX-RXM-SFRBX, to be used by gUbxRxmSfrbx (item 0).
+ */
+static const uGnssDecUbxRxmSfrbx_t gUbxRxmSfrbxDecoded0 = {
+    0 /* gnssId */, 5 /* svId */, 0 /* sigId */, 0 /* freqId */, 3 /* numWords */,
+    4 /* chn */, 2 /* version */, 3 /* dwrdCount */,
+    {0x22c000e4, 0x1234abcd, 0xdeadbeef} /* dwrd */
+};
+
+/** Array of test data for UBX-RXM-SFRBX.
+ */
+static const uGnssDecTestDataKnown_t gUbxRxmSfrbx[] = {
+    {
+        {
+            "\xb5\x62\x02\x13\x14\x00\x00\x05\x00\x00\x03\x04\x02\x00\xe4\x00"
+            "\xc0\x22\xcd\xab\x34\x12\xef\xbe\xad\xde\xf3\xbb", 28
+        },
+        {
+            U_GNSS_PROTOCOL_UBX, 0x0213, NULL
+        },
+        (void *) &gUbxRxmSfrbxDecoded0
+    }
+};
+
+/** Decoded test data for UBX-NAV-COV, to be used by gUbxNavCov (item 0).
+ */
+static const uGnssDecUbxNavCov_t gUbxNavCovDecoded0 = {
+    486173000 /* iTOW */, 0 /* version */, 1 /* posCovValid */, 1 /* velCovValid */,
+    0.5F /* posCovNN */, -0.25 /* posCovNE */, 0.125 /* posCovND */,
+    0.75 /* posCovEE */, 0.0625 /* posCovED */, 2.5 /* posCovDD */,
+    0.015625 /* velCovNN */, -0.0078125 /* velCovNE */, 0.03125 /* velCovND */,
+    0.0234375 /* velCovEE */, 0.001953125 /* velCovED */, 0.09375 /* velCovDD */
+};
+
+/** Array of test data for UBX-NAV-COV.
+ */
+static const uGnssDecTestDataKnown_t gUbxNavCov[] = {
+    {
+        {
+            "\xb5\x62\x01\x36\x40\x00\x48\x69\xfa\x1c\x00\x01\x01\x00\x00\x00"
+            "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x3f\x00\x00\x80\xbe\x00\x00"
+            "\x00\x3e\x00\x00\x40\x3f\x00\x00\x80\x3d\x00\x00\x20\x40\x00\x00"
+            "\x80\x3c\x00\x00\x00\xbc\x00\x00\x00\x3d\x00\x00\xc0\x3c\x00\x00"
+            "\x00\x3b\x00\x00\xc0\x3d\x80\xea", 72
+        },
+        {
+            U_GNSS_PROTOCOL_UBX, 0x0136, NULL
+        },
+        (void *) &gUbxNavCovDecoded0
+    }
+};
+
+/** Decoded test data for UBX-ESF-MEAS, to be used by gUbxEsfMeas (item 0).
+ */
+static const uGnssDecUbxEsfMeas_t gUbxEsfMeasDecoded0 = {
+    12345678 /* timeTag */, 0x1009 /* flags */, 0 /* id */, 2 /* dataCount */,
+    {
+        {-4096 /* dataField */, 5 /* dataType */},
+        {123456 /* dataField */, 16 /* dataType */}
+    },
+    486173123 /* calibTtag */
+};
+
+/** Array of test data for UBX-ESF-MEAS.
+ */
+static const uGnssDecTestDataKnown_t gUbxEsfMeas[] = {
+    {
+        {
+            "\xb5\x62\x10\x02\x14\x00\x4e\x61\xbc\x00\x09\x10\x00\x00\x00\xf0"
+            "\xff\x05\x40\xe2\x01\x10\xc3\x69\xfa\x1c\x13\xb7", 28
+        },
+        {
+            U_GNSS_PROTOCOL_UBX, 0x1002, NULL
+        },
+        (void *) &gUbxEsfMeasDecoded0
+    }
+};
+
 /** Array of arrays of test vectors for all known message types.
  */
 static const uGnssDecTestDataKnownSet_t gTestDataKnownSet[] = {
     {gUbxNavPvt, sizeof(gUbxNavPvt) / sizeof(gUbxNavPvt[0]), sizeof(gUbxNavPvtDecoded0)},
-    {gUbxNavHpposllh, sizeof(gUbxNavHpposllh) / sizeof(gUbxNavHpposllh[0]), sizeof(gUbxNavHpposllhDecoded0)}
+    {gUbxNavHpposllh, sizeof(gUbxNavHpposllh) / sizeof(gUbxNavHpposllh[0]), sizeof(gUbxNavHpposllhDecoded0)},
+    {gUbxNavSat, sizeof(gUbxNavSat) / sizeof(gUbxNavSat[0]), sizeof(gUbxNavSatDecoded0)},
+    {gUbxNavSig, sizeof(gUbxNavSig) / sizeof(gUbxNavSig[0]), sizeof(gUbxNavSigDecoded0)},
+    {gUbxRxmRawx, sizeof(gUbxRxmRawx) / sizeof(gUbxRxmRawx[0]), sizeof(gUbxRxmRawxDecoded0)},
+    {gUbxRxmSfrbx, sizeof(gUbxRxmSfrbx) / sizeof(gUbxRxmSfrbx[0]), sizeof(gUbxRxmSfrbxDecoded0)},
+    {gUbxNavCov, sizeof(gUbxNavCov) / sizeof(gUbxNavCov[0]), sizeof(gUbxNavCovDecoded0)},
+    {gUbxEsfMeas, sizeof(gUbxEsfMeas) / sizeof(gUbxEsfMeas[0]), sizeof(gUbxEsfMeasDecoded0)}
 };
 
+/** Storage for uGnssDecDecode(), declared as uint64_t so that it
+ * is suitably aligned.
+ */
+static uint64_t gDecStorage[(U_GNSS_DEC_SIZE_MAX + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+
 /** Flag to share with the user callback.
  */
 static int32_t gCallback;
@@ -634,6 +820,7 @@ U_PORT_TEST_FUNCTION("[gnssDec]", "gnssDecKnown")
     uGnssDec_t *pDec;
     const uGnssDecTestDataKnown_t *pTestData = NULL;
     size_t decodedStructureSize;
+    void *pBody;
     char prefix[64]; // Just for printing
 
     // Get the initial resource count
@@ -697,6 +884,39 @@ U_PORT_TEST_FUNCTION("[gnssDec]", "gnssDecKnown")
             }
             // Free the structure once more
             uGnssDecFree(pDec);
+            if (pTestData->id.type == U_GNSS_PROTOCOL_UBX) {
+                // Now do the same with the non-allocating decode
+                pBody = pUPortMalloc(decodedStructureSize);
+                U_PORT_TEST_ASSERT(pBody != NULL);
+                memset(pBody, 0, decodedStructureSize);
+                U_PORT_TEST_ASSERT(uGnssDecUbx(pTestData->raw.p,
+                                               pTestData->raw.length - gCrcLength[pTestData->id.type],
+                                               pBody, decodedStructureSize - 1) < 0);
+                U_PORT_TEST_ASSERT(uGnssDecUbx(pTestData->raw.p,
+                                               U_UBX_PROTOCOL_HEADER_LENGTH_BYTES - 1,
+                                               pBody, decodedStructureSize) < 0);
+                U_PORT_TEST_ASSERT(uGnssDecUbx(pTestData->raw.p,
+                                               pTestData->raw.length - gCrcLength[pTestData->id.type],
+                                               pBody, decodedStructureSize) == 0);
+                U_PORT_TEST_ASSERT(memcmp(pBody, pTestData->pDecoded, decodedStructureSize) == 0);
+                uPortFree(pBody);
+            }
+            // And finally with decoding entirely into our own storage
+            pDec = (uGnssDec_t *) gDecStorage;
+            U_PORT_TEST_ASSERT(uGnssDecDecode(pTestData->raw.p,
+                                              pTestData->raw.length - gCrcLength[pTestData->id.type],
+                                              pDec, U_GNSS_DEC_BODY_OFFSET + decodedStructureSize - 1) ==
+                               (int32_t) U_ERROR_COMMON_NO_MEMORY);
+            U_PORT_TEST_ASSERT(pDec->errorCode == (int32_t) U_ERROR_COMMON_NO_MEMORY);
+            U_PORT_TEST_ASSERT(pDec->pBody == NULL);
+            U_PORT_TEST_ASSERT(uGnssDecDecode(pTestData->raw.p,
+                                              pTestData->raw.length - gCrcLength[pTestData->id.type],
+                                              pDec, sizeof(gDecStorage)) == 0);
+            U_PORT_TEST_ASSERT(pDec->errorCode == 0);
+            U_PORT_TEST_ASSERT(pDec->id.type == pTestData->id.type);
+            U_PORT_TEST_ASSERT(pDec->pBody == (uGnssDecUnion_t *) (((char *) gDecStorage) +
+                                                                   U_GNSS_DEC_BODY_OFFSET));
+            U_PORT_TEST_ASSERT(memcmp(pDec->pBody, pTestData->pDecoded, decodedStructureSize) == 0);
         }
     }
 
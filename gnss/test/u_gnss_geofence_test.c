@@ -0,0 +1,345 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Tests for the GNSS geofence API: they do not require a GNSS
+ * module to run, hence these should pass on all platforms.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the U_PORT_TEST_FUNCTION()
+ * macro.
+ */
+
+# ifdef U_CFG_OVERRIDE
+#  include "u_cfg_override.h" // For a customer's configuration override
+# endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_gnss_geofence.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The base string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX_BASE "U_GNSS_GEOFENCE_TEST"
+
+/** The string to put at the start of all prints from this test
+ * that do not require any iterations on the end.
+ */
+#define U_TEST_PREFIX U_TEST_PREFIX_BASE ": "
+
+/** Print a whole line, with terminator, prefixed for this test
+ * file, no iteration(s) version.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** Convert a north/south distance in millimetres into ten
+ * millionths of a degree of latitude.
+ */
+#define U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(mm) ((int32_t) (((int64_t) (mm)) * 1000 / 11132))
+
+/** The latitude of the test area, in ten millionths of a degree;
+ * the equator, so that a millimetre of longitude is the same as
+ * a millimetre of latitude.
+ */
+#define U_GNSS_GEOFENCE_TEST_LATITUDE_X1E7 0
+
+/** The longitude of the test area, in ten millionths of a degree.
+ */
+#define U_GNSS_GEOFENCE_TEST_LONGITUDE_X1E7 100000000
+
+/** The hysteresis distance to use: 10 metres.
+ */
+#define U_GNSS_GEOFENCE_TEST_HYSTERESIS_MM 10000
+
+/** The number of fences in the "depot" test.
+ */
+#define U_GNSS_GEOFENCE_TEST_NUM_DEPOTS 200
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** The number of enter events reported.
+ */
+static int32_t gEnterCount = 0;
+
+/** The number of exit events reported.
+ */
+static int32_t gExitCount = 0;
+
+/** The fence ID of the last event.
+ */
+static int32_t gLastFenceId = -1;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Geofence callback.
+static void callback(uDeviceHandle_t gnssHandle, int32_t fenceId,
+                     uGnssGeofenceEvent_t event,
+                     int32_t latitudeX1e7, int32_t longitudeX1e7,
+                     void *pCallbackParam)
+{
+    (void) gnssHandle;
+    (void) latitudeX1e7;
+    (void) longitudeX1e7;
+    (void) pCallbackParam;
+
+    if (event == U_GNSS_GEOFENCE_EVENT_ENTER) {
+        gEnterCount++;
+    } else {
+        gExitCount++;
+    }
+    gLastFenceId = fenceId;
+}
+
+// Move to a position offset from the test area in millimetres
+// (east, north) and return the number of events.
+static int32_t moveTo(uGnssGeofence_t *pGeofence, int32_t eastMm, int32_t northMm)
+{
+    return uGnssGeofenceUpdate(pGeofence, NULL,
+                               U_GNSS_GEOFENCE_TEST_LATITUDE_X1E7 +
+                               U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(northMm),
+                               U_GNSS_GEOFENCE_TEST_LONGITUDE_X1E7 +
+                               U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(eastMm));
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Test circles and polygons, with hysteresis.
+ */
+U_PORT_TEST_FUNCTION("[gnssGeofence]", "gnssGeofenceBasic")
+{
+    int32_t resourceCount;
+    uGnssGeofence_t *pGeofence;
+    // An L-shaped polygon, 200 metres on a side, 100 metres wide,
+    // with the test area in its bottom left-hand corner
+    int32_t latitudeX1e7[6];
+    int32_t longitudeX1e7[6];
+    const int32_t eastMm[6] = {0, 200000, 200000, 100000, 100000, 0};
+    const int32_t northMm[6] = {0, 0, 100000, 100000, 200000, 200000};
+
+    // Get the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    U_PORT_TEST_ASSERT(pUGnssGeofenceCreate(-1, callback, NULL) == NULL);
+    U_PORT_TEST_ASSERT(pUGnssGeofenceCreate(0, NULL, NULL) == NULL);
+    pGeofence = pUGnssGeofenceCreate(U_GNSS_GEOFENCE_TEST_HYSTERESIS_MM,
+                                     callback, NULL);
+    U_PORT_TEST_ASSERT(pGeofence != NULL);
+
+    U_TEST_PRINT_LINE("testing a circle.");
+    // A circle of radius 100 metres, 1 km north of the test area
+    U_PORT_TEST_ASSERT(uGnssGeofenceAddCircle(pGeofence, 1,
+                                              U_GNSS_GEOFENCE_TEST_LATITUDE_X1E7 +
+                                              U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(1000000),
+                                              U_GNSS_GEOFENCE_TEST_LONGITUDE_X1E7,
+                                              100000) == 0);
+    // Not allowed to re-use the ID or to have a zero radius
+    U_PORT_TEST_ASSERT(uGnssGeofenceAddCircle(pGeofence, 1, 0, 0, 100000) < 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceAddCircle(pGeofence, 2, 0, 0, 0) < 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 1) == 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 2) == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    // Move to the middle: enter
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 0, 1000000) == 1);
+    U_PORT_TEST_ASSERT((gEnterCount == 1) && (gExitCount == 0) && (gLastFenceId == 1));
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 1) == 1);
+    // Move to just outside the edge, but within the hysteresis: nothing
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 0, 1000000 + 105000) == 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 1) == 1);
+    // Move beyond the hysteresis: exit
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 115000, 1000000) == 1);
+    U_PORT_TEST_ASSERT((gEnterCount == 1) && (gExitCount == 1));
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 1) == 0);
+    // Move to just inside the edge, within the hysteresis: nothing
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, -95000, 1000000) == 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 1) == 0);
+    // Further in: enter
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, -85000, 1000000) == 1);
+    U_PORT_TEST_ASSERT((gEnterCount == 2) && (gExitCount == 1));
+    // Jump a long way away, outside the bounding box: exit
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 0, 0) == 1);
+    U_PORT_TEST_ASSERT((gEnterCount == 2) && (gExitCount == 2));
+
+    U_TEST_PRINT_LINE("testing a polygon.");
+    for (size_t x = 0; x < sizeof(latitudeX1e7) / sizeof(latitudeX1e7[0]); x++) {
+        latitudeX1e7[x] = U_GNSS_GEOFENCE_TEST_LATITUDE_X1E7 +
+                          U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(northMm[x]);
+        longitudeX1e7[x] = U_GNSS_GEOFENCE_TEST_LONGITUDE_X1E7 +
+                           U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(eastMm[x]);
+    }
+    U_PORT_TEST_ASSERT(uGnssGeofenceAddPolygon(pGeofence, 3, latitudeX1e7,
+                                               longitudeX1e7, 2) < 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceAddPolygon(pGeofence, 3, latitudeX1e7,
+                                               longitudeX1e7,
+                                               sizeof(latitudeX1e7) / sizeof(latitudeX1e7[0])) == 0);
+    gEnterCount = 0;
+    gExitCount = 0;
+    // Position is currently on a vertex, within the hysteresis: nothing
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 3) == 0);
+    // Into the bottom arm of the L: enter
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 150000, 50000) == 1);
+    U_PORT_TEST_ASSERT((gEnterCount == 1) && (gLastFenceId == 3));
+    // Into the left arm of the L: still inside
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 50000, 150000) == 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 3) == 1);
+    // Into the notch of the L, within the hysteresis of the edge: nothing
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 105000, 150000) == 0);
+    // Into the middle of the notch: exit
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 150000, 150000) == 1);
+    U_PORT_TEST_ASSERT((gEnterCount == 1) && (gExitCount == 1));
+    U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, 3) == 0);
+
+    // Removing a fence reports nothing
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 50000, 50000) == 1);
+    U_PORT_TEST_ASSERT(uGnssGeofenceRemove(pGeofence, 3) == 0);
+    U_PORT_TEST_ASSERT(uGnssGeofenceRemove(pGeofence, 3) == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    U_PORT_TEST_ASSERT(moveTo(pGeofence, 150000, 150000) == 0);
+
+    U_TEST_PRINT_LINE("testing a circle across the anti-meridian.");
+    U_PORT_TEST_ASSERT(uGnssGeofenceAddCircle(pGeofence, 4, 0, 1799999000, 100000) == 0);
+    gEnterCount = 0;
+    gExitCount = 0;
+    U_PORT_TEST_ASSERT(uGnssGeofenceUpdate(pGeofence, NULL, 0, -1799999000) == 1);
+    U_PORT_TEST_ASSERT((gEnterCount == 1) && (gLastFenceId == 4));
+    U_PORT_TEST_ASSERT(uGnssGeofenceUpdate(pGeofence, NULL, 0, 1799000000) == 1);
+    U_PORT_TEST_ASSERT(gExitCount == 1);
+
+    uGnssGeofenceFree(pGeofence);
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test a large number of fences, as a fleet application would
+ * have for its depots.
+ */
+U_PORT_TEST_FUNCTION("[gnssGeofence]", "gnssGeofenceDepots")
+{
+    int32_t resourceCount;
+    uGnssGeofence_t *pGeofence;
+    int32_t startTimeMs;
+
+    // Get the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    pGeofence = pUGnssGeofenceCreate(U_GNSS_GEOFENCE_TEST_HYSTERESIS_MM,
+                                     callback, NULL);
+    U_PORT_TEST_ASSERT(pGeofence != NULL);
+
+    // A row of depots of radius 500 metres, 5 km apart, every
+    // other one being a square rather than a circle
+    for (int32_t x = 0; x < U_GNSS_GEOFENCE_TEST_NUM_DEPOTS; x++) {
+        if (x & 1) {
+            int32_t latitudeX1e7[4];
+            int32_t longitudeX1e7[4];
+            latitudeX1e7[0] = U_GNSS_GEOFENCE_TEST_LATITUDE_X1E7 -
+                              U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(500000);
+            latitudeX1e7[1] = latitudeX1e7[0];
+            latitudeX1e7[2] = U_GNSS_GEOFENCE_TEST_LATITUDE_X1E7 +
+                              U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(500000);
+            latitudeX1e7[3] = latitudeX1e7[2];
+            longitudeX1e7[0] = U_GNSS_GEOFENCE_TEST_LONGITUDE_X1E7 +
+                               U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7((x * 5000000) - 500000);
+            longitudeX1e7[1] = U_GNSS_GEOFENCE_TEST_LONGITUDE_X1E7 +
+                               U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7((x * 5000000) + 500000);
+            longitudeX1e7[2] = longitudeX1e7[1];
+            longitudeX1e7[3] = longitudeX1e7[0];
+            U_PORT_TEST_ASSERT(uGnssGeofenceAddPolygon(pGeofence, x, latitudeX1e7,
+                                                       longitudeX1e7, 4) == 0);
+        } else {
+            U_PORT_TEST_ASSERT(uGnssGeofenceAddCircle(pGeofence, x,
+                                                      U_GNSS_GEOFENCE_TEST_LATITUDE_X1E7,
+                                                      U_GNSS_GEOFENCE_TEST_LONGITUDE_X1E7 +
+                                                      U_GNSS_GEOFENCE_TEST_MM_TO_LAT_X1E7(x * 5000000),
+                                                      500000) == 0);
+        }
+    }
+
+    // Drive along the row in 100 metre steps: every depot should
+    // be entered and left exactly once
+    gEnterCount = 0;
+    gExitCount = 0;
+    startTimeMs = uPortGetTickTimeMs();
+    for (int32_t x = -10; x < (U_GNSS_GEOFENCE_TEST_NUM_DEPOTS * 50) + 10; x++) {
+        U_PORT_TEST_ASSERT(moveTo(pGeofence, x * 100000, 0) >= 0);
+        if ((x >= 0) && (x % 50 == 0) && (x / 50 < U_GNSS_GEOFENCE_TEST_NUM_DEPOTS)) {
+            // At a depot
+            U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(pGeofence, x / 50) == 1);
+            U_PORT_TEST_ASSERT(gLastFenceId == x / 50);
+        }
+    }
+    U_TEST_PRINT_LINE("%d positions checked against %d fences in %d ms.",
+                      (U_GNSS_GEOFENCE_TEST_NUM_DEPOTS * 50) + 20,
+                      U_GNSS_GEOFENCE_TEST_NUM_DEPOTS,
+                      uPortGetTickTimeMs() - startTimeMs);
+    U_TEST_PRINT_LINE("%d enter and %d exit events.", gEnterCount, gExitCount);
+    U_PORT_TEST_ASSERT(gEnterCount == U_GNSS_GEOFENCE_TEST_NUM_DEPOTS);
+    U_PORT_TEST_ASSERT(gExitCount == U_GNSS_GEOFENCE_TEST_NUM_DEPOTS);
+
+    uGnssGeofenceFree(pGeofence);
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+// End of file
@@ -109,10 +109,27 @@
  */
 static uGnssTestPrivate_t gHandles = U_GNSS_TEST_PRIVATE_DEFAULTS;
 
+/** Count of calls to commsCallback().
+ */
+static volatile int32_t gCommsCallbackCount = 0;
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Callback for the MON-COMMS sampler.
+static void commsCallback(uDeviceHandle_t gnssHandle, uint32_t eventBitMap,
+                          const uGnssInfoCommsSample_t *pSample,
+                          void *pCallbackParam)
+{
+    (void) pCallbackParam;
+
+    if ((gnssHandle == gHandles.gnssHandle) && (eventBitMap != 0) &&
+        (pSample != NULL) && (pSample->numSamples > 0)) {
+        gCommsCallbackCount++;
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -129,6 +146,8 @@ U_PORT_TEST_FUNCTION("[gnssInfo]", "gnssInfoStatic")
     char *pTmp;
     size_t iterations;
     uGnssTransportType_t transportTypes[U_GNSS_TRANSPORT_MAX_NUM];
+    uGnssInfoCommsThresholds_t thresholds = {1, 0, 0, 0, 0};
+    uGnssInfoCommsSample_t sample;
 
     // In case a previous test failed
     uGnssTestPrivateCleanup(&gHandles);
@@ -152,6 +171,30 @@ U_PORT_TEST_FUNCTION("[gnssInfo]", "gnssInfoStatic")
         // So that we can see what we're doing
         uGnssSetUbxMessagePrint(gnssHandle, true);
 
+        // Sample the communication stats in the background for a
+        // few seconds; with a transmit usage threshold of 1% the
+        // callback should be called as the GNSS chip answers our
+        // own polls
+        gCommsCallbackCount = 0;
+        y = uGnssInfoCommsSamplerStart(gnssHandle, -1, 1000, &thresholds,
+                                       commsCallback, NULL);
+        if (y == 0) {
+            U_PORT_TEST_ASSERT(uGnssInfoCommsSamplerStart(gnssHandle, -1, 1000, NULL,
+                                                          NULL, NULL) == U_ERROR_COMMON_BUSY);
+            uPortTaskBlock(5000);
+            U_PORT_TEST_ASSERT(uGnssInfoCommsSamplerGet(gnssHandle, &sample) == 0);
+            U_TEST_PRINT_LINE("%d MON-COMMS sample(s), %d callback(s), %d%% transmit"
+                              " buffer usage, %d byte(s) lost on this MCU.",
+                              sample.numSamples, gCommsCallbackCount,
+                              sample.stats.txPercentageUsage, sample.hostLossBytes);
+            U_PORT_TEST_ASSERT(sample.numSamples > 1);
+            uGnssInfoCommsSamplerStop(gnssHandle);
+            U_PORT_TEST_ASSERT(uGnssInfoCommsSamplerGet(gnssHandle,
+                                                        &sample) == U_ERROR_COMMON_NOT_FOUND);
+        } else {
+            U_PORT_TEST_ASSERT(y == U_ERROR_COMMON_NOT_SUPPORTED);
+        }
+
         pBuffer = (char *) pUPortMalloc(U_GNSS_INFO_TEST_VERSION_SIZE_MAX_BYTES);
         U_PORT_TEST_ASSERT(pBuffer != NULL);
         // Ask for firmware version string with insufficient storage
@@ -247,6 +290,61 @@ U_PORT_TEST_FUNCTION("[gnssInfo]", "gnssInfoStatic")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Check MON-COMMS samples against thresholds; no GNSS chip required.
+ */
+U_PORT_TEST_FUNCTION("[gnssInfo]", "gnssInfoCommsCheck")
+{
+    uGnssInfoCommsSample_t sample;
+    uGnssInfoCommsThresholds_t thresholds = U_GNSS_INFO_COMMS_THRESHOLDS_DEFAULTS;
+    uGnssInfoCommsThresholds_t thresholdsNone = {0};
+
+    memset(&sample, 0, sizeof(sample));
+    sample.numSamples = 2;
+
+    // A quiet sample causes no events
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholds) == 0);
+
+    // A full transmit buffer on the GNSS chip is an overflow,
+    // whatever the thresholds, which is different to a loss
+    // on this MCU
+    sample.stats.txPercentageUsage = 100;
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholds) ==
+                       ((1UL << U_GNSS_INFO_COMMS_EVENT_TX_OVERFLOW) |
+                        (1UL << U_GNSS_INFO_COMMS_EVENT_TX_USAGE)));
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholdsNone) ==
+                       (1UL << U_GNSS_INFO_COMMS_EVENT_TX_OVERFLOW));
+    sample.stats.txPercentageUsage = 0;
+    sample.hostLossBytesDelta = 10;
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholds) ==
+                       (1UL << U_GNSS_INFO_COMMS_EVENT_HOST_LOSS));
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholdsNone) == 0);
+    sample.hostLossBytesDelta = 0;
+
+    // Usage thresholds
+    thresholds.rxPercentageUsage = 50;
+    sample.stats.rxPercentageUsage = 49;
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholds) == 0);
+    sample.stats.rxPercentageUsage = 50;
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholds) ==
+                       (1UL << U_GNSS_INFO_COMMS_EVENT_RX_USAGE));
+    sample.stats.rxPercentageUsage = 0;
+
+    // Count thresholds are on the deltas, not the totals
+    thresholds.rxOverrunErrors = 3;
+    sample.stats.rxOverrunErrors = 1000;
+    sample.rxOverrunErrorsDelta = 2;
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholds) == 0);
+    sample.rxOverrunErrorsDelta = 3;
+    sample.rxSkippedBytesDelta = 1;
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, &thresholds) ==
+                       ((1UL << U_GNSS_INFO_COMMS_EVENT_RX_OVERRUN) |
+                        (1UL << U_GNSS_INFO_COMMS_EVENT_RX_SKIPPED)));
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(NULL, &thresholds) == 0);
+    U_PORT_TEST_ASSERT(uGnssInfoCommsCheck(&sample, NULL) == 0);
+}
+
 /** Read time from GNSS.
  */
 U_PORT_TEST_FUNCTION("[gnssInfo]", "gnssInfoTime")
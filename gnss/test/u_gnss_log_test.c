@@ -0,0 +1,317 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Tests for the GNSS message logging API: these should pass on
+ * all platforms that have a GNSS module connected to them.  They
+ * are only compiled if U_CFG_TEST_GNSS_MODULE_TYPE is defined.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the U_PORT_TEST_FUNCTION()
+ * macro.
+ */
+
+#ifdef U_CFG_TEST_GNSS_MODULE_TYPE
+
+# ifdef U_CFG_OVERRIDE
+#  include "u_cfg_override.h" // For a customer's configuration override
+# endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset()
+#include "stdio.h"     // fopen(), fread(), fclose(), remove()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_at_client.h" // Required by u_gnss_private.h
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+#include "u_port_uart.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss.h"
+#include "u_gnss_cfg.h"
+#include "u_gnss_log.h"
+#include "u_gnss_private.h"
+
+#include "u_gnss_test_private.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_GNSS_LOG_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+#ifndef U_GNSS_LOG_TEST_DURATION_SECONDS
+/** How long to log for.
+ */
+# define U_GNSS_LOG_TEST_DURATION_SECONDS 5
+#endif
+
+#ifndef U_GNSS_LOG_TEST_FILE_NAME
+/** The file to log to when testing uGnssLogStartFile().
+ */
+# define U_GNSS_LOG_TEST_FILE_NAME "u_gnss_log_test.bin"
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** What the test write callback has seen.
+ */
+typedef struct {
+    size_t numWrites;
+    size_t numBytes;
+    size_t numRecords;
+    size_t recordBytesLeft;  /**< body bytes of the current record still to come. */
+    size_t headerBytes;      /**< header bytes of the current record so far. */
+    char header[U_GNSS_LOG_RECORD_HEADER_LENGTH_BYTES];
+    bool badHeader;
+    bool stopped;
+} uGnssLogTestContext_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Handles.
+ */
+static uGnssTestPrivate_t gHandles = U_GNSS_TEST_PRIVATE_DEFAULTS;
+
+/** What the write callback has seen.
+ */
+static uGnssLogTestContext_t gContext;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Write callback: walk the records, checking each header.
+static int32_t writeCallback(uDeviceHandle_t gnssHandle, const char *pData,
+                             size_t size, void *pCallbackParam)
+{
+    uGnssLogTestContext_t *pContext = (uGnssLogTestContext_t *) pCallbackParam;
+    size_t length;
+
+    (void) gnssHandle;
+
+    if (pData == NULL) {
+        pContext->stopped = true;
+    } else {
+        pContext->numWrites++;
+        pContext->numBytes += size;
+        for (size_t x = 0; x < size; x += length) {
+            if (pContext->recordBytesLeft > 0) {
+                length = size - x;
+                if (length > pContext->recordBytesLeft) {
+                    length = pContext->recordBytesLeft;
+                }
+                pContext->recordBytesLeft -= length;
+            } else {
+                length = 1;
+                pContext->header[pContext->headerBytes] = *(pData + x);
+                pContext->headerBytes++;
+                if (pContext->headerBytes == sizeof(pContext->header)) {
+                    if ((pContext->header[0] != (char) U_GNSS_LOG_RECORD_SYNC) ||
+                        (pContext->header[1] != (char) U_GNSS_PROTOCOL_NMEA)) {
+                        pContext->badHeader = true;
+                    }
+                    pContext->recordBytesLeft = (uint8_t) pContext->header[2] +
+                                                ((size_t) (uint8_t) pContext->header[3] << 8);
+                    pContext->headerBytes = 0;
+                    pContext->numRecords++;
+                }
+            }
+        }
+    }
+
+    return (int32_t) size;
+}
+
+#if U_GNSS_LOG_FILE_SUPPORTED
+// Read a log file back, passing it through writeCallback() in
+// chunks so that the records in it are checked in the same way.
+static bool readLogFile(const char *pFileName, uGnssLogTestContext_t *pContext)
+{
+    bool success = false;
+    FILE *pFile;
+    char buffer[128];
+    size_t length;
+
+    pFile = fopen(pFileName, "rb");
+    if (pFile != NULL) {
+        success = true;
+        do {
+            length = fread(buffer, 1, sizeof(buffer), pFile);
+            if (length > 0) {
+                writeCallback(NULL, buffer, length, pContext);
+            }
+        } while (length == sizeof(buffer));
+        fclose(pFile);
+    }
+
+    return success;
+}
+#endif
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Log NMEA messages.
+ */
+U_PORT_TEST_FUNCTION("[gnssLog]", "gnssLogBasic")
+{
+    uDeviceHandle_t gnssHandle;
+    int32_t resourceCount;
+    size_t iterations;
+    uGnssMessageId_t messageId = {.type = U_GNSS_PROTOCOL_NMEA, .id.pNmea = NULL};
+    uGnssTransportType_t transportTypes[U_GNSS_TRANSPORT_MAX_NUM];
+
+    // In case a previous test failed
+    uGnssTestPrivateCleanup(&gHandles);
+
+    // Get the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Repeat for all transport types
+    iterations = uGnssTestPrivateTransportTypesSet(transportTypes, U_CFG_APP_GNSS_UART,
+                                                   U_CFG_APP_GNSS_I2C, U_CFG_APP_GNSS_SPI);
+    for (size_t w = 0; w < iterations; w++) {
+        // Do the standard preamble
+        U_TEST_PRINT_LINE("testing on transport %s...",
+                          pGnssTestPrivateTransportTypeName(transportTypes[w]));
+        U_PORT_TEST_ASSERT(uGnssTestPrivatePreamble(U_CFG_TEST_GNSS_MODULE_TYPE,
+                                                    transportTypes[w], &gHandles, true,
+                                                    U_CFG_APP_CELL_PIN_GNSS_POWER,
+                                                    U_CFG_APP_CELL_PIN_GNSS_DATA_READY) == 0);
+        gnssHandle = gHandles.gnssHandle;
+        memset(&gContext, 0, sizeof(gContext));
+
+        U_PORT_TEST_ASSERT(uGnssLogGetLostCount(gnssHandle) < 0);
+        // Bad parameters
+        U_PORT_TEST_ASSERT(uGnssLogStart(gnssHandle, NULL, 1, writeCallback, &gContext) < 0);
+        U_PORT_TEST_ASSERT(uGnssLogStart(gnssHandle, &messageId, 0, writeCallback, &gContext) < 0);
+        U_PORT_TEST_ASSERT(uGnssLogStart(gnssHandle, &messageId, 1, NULL, &gContext) < 0);
+        U_PORT_TEST_ASSERT(uGnssLogStartFile(gnssHandle, &messageId, 1, NULL) < 0);
+        if (transportTypes[w] == U_GNSS_TRANSPORT_AT) {
+            // Logging is not supported on an AT transport
+            U_PORT_TEST_ASSERT(uGnssLogStart(gnssHandle, &messageId, 1,
+                                             writeCallback, &gContext) < 0);
+        } else {
+            // Make sure NMEA messages are being emitted
+            U_PORT_TEST_ASSERT(uGnssCfgSetProtocolOut(gnssHandle, U_GNSS_PROTOCOL_NMEA, true) == 0);
+            U_PORT_TEST_ASSERT(uGnssLogStart(gnssHandle, &messageId, 1,
+                                             writeCallback, &gContext) == 0);
+            // Only one log at a time
+            U_PORT_TEST_ASSERT(uGnssLogStart(gnssHandle, &messageId, 1,
+                                             writeCallback, &gContext) == (int32_t) U_ERROR_COMMON_BUSY);
+            U_TEST_PRINT_LINE("logging for %d second(s)...", U_GNSS_LOG_TEST_DURATION_SECONDS);
+            uPortTaskBlock(U_GNSS_LOG_TEST_DURATION_SECONDS * 1000);
+            U_PORT_TEST_ASSERT(uGnssLogGetLostCount(gnssHandle) >= 0);
+            uGnssLogStop(gnssHandle);
+            U_TEST_PRINT_LINE("%d record(s), %d byte(s) in %d write(s).",
+                              gContext.numRecords, gContext.numBytes, gContext.numWrites);
+            U_PORT_TEST_ASSERT(gContext.stopped);
+            U_PORT_TEST_ASSERT(!gContext.badHeader);
+            U_PORT_TEST_ASSERT(gContext.numRecords > 0);
+            // Everything must have been written out by the stop,
+            // ending on a record boundary
+            U_PORT_TEST_ASSERT(gContext.recordBytesLeft == 0);
+            U_PORT_TEST_ASSERT(gContext.headerBytes == 0);
+            // Once a second or a chunk at a time, not per message
+            U_PORT_TEST_ASSERT(gContext.numWrites < gContext.numRecords);
+            U_PORT_TEST_ASSERT(uGnssLogGetLostCount(gnssHandle) < 0);
+
+#if U_GNSS_LOG_FILE_SUPPORTED
+            // Now log to a file, read it back and check it in the same way
+            U_TEST_PRINT_LINE("logging to file \"%s\" for %d second(s)...",
+                              U_GNSS_LOG_TEST_FILE_NAME, U_GNSS_LOG_TEST_DURATION_SECONDS);
+            U_PORT_TEST_ASSERT(uGnssLogStartFile(gnssHandle, &messageId, 1,
+                                                 U_GNSS_LOG_TEST_FILE_NAME) == 0);
+            uPortTaskBlock(U_GNSS_LOG_TEST_DURATION_SECONDS * 1000);
+            uGnssLogStop(gnssHandle);
+            memset(&gContext, 0, sizeof(gContext));
+            U_PORT_TEST_ASSERT(readLogFile(U_GNSS_LOG_TEST_FILE_NAME, &gContext));
+            remove(U_GNSS_LOG_TEST_FILE_NAME);
+            U_TEST_PRINT_LINE("%d record(s), %d byte(s) read back from file.",
+                              gContext.numRecords, gContext.numBytes);
+            U_PORT_TEST_ASSERT(!gContext.badHeader);
+            U_PORT_TEST_ASSERT(gContext.numRecords > 0);
+            U_PORT_TEST_ASSERT(gContext.recordBytesLeft == 0);
+            U_PORT_TEST_ASSERT(gContext.headerBytes == 0);
+#else
+            U_PORT_TEST_ASSERT(uGnssLogStartFile(gnssHandle, &messageId, 1,
+                                                 U_GNSS_LOG_TEST_FILE_NAME) ==
+                               (int32_t) U_ERROR_COMMON_NOT_SUPPORTED);
+#endif
+        }
+
+        // Do the standard postamble, leaving the module on for the next
+        // test to speed things up
+        uGnssTestPrivatePostamble(&gHandles, false);
+    }
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Clean-up to be run at the end of this round of tests, just
+ * in case there were test failures which would have resulted
+ * in the deinitialisation being skipped.
+ */
+U_PORT_TEST_FUNCTION("[gnssLog]", "gnssLogCleanUp")
+{
+    if (gHandles.gnssHandle != NULL) {
+        uGnssLogStop(gHandles.gnssHandle);
+    }
+    uGnssTestPrivateCleanup(&gHandles);
+    uPortDeinit();
+    // Printed for information: asserting happens in the postamble
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+}
+
+#endif // #ifdef U_CFG_TEST_GNSS_MODULE_TYPE
+
+// End of file
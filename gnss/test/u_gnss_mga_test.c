@@ -514,6 +514,26 @@ static bool databaseCallback(uDeviceHandle_t devHandle,
 
 # endif // ifndef U_GNSS_MGA_TEST_DISABLE_DATABASE
 
+// Callback for uGnssMgaOfflineFilterPush(): checks that the message
+// is a UBX-MGA message and counts it in the int32_t pointed to by
+// pCallbackParam.
+static int32_t offlineFilterCallback(const char *pMessage, size_t length,
+                                     void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_BAD_DATA;
+    int32_t messageClass;
+    int32_t messageId;
+
+    if ((uUbxProtocolDecode(pMessage, length, &messageClass, &messageId,
+                            NULL, 0, NULL) == (int32_t) (length - U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES)) &&
+        (messageClass == 0x13)) {
+        (*((int32_t *) pCallbackParam))++;
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -544,6 +564,7 @@ U_PORT_TEST_FUNCTION("[gnssMga]", "gnssMgaBasic")
     char buffer[4 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES];
     uGnssCommunicationStats_t communicationStats;
     const char *pProtocolName;
+    char *pCompact;
 
     // In case a previous test failed
     uGnssTestPrivateCleanup(&gHandles);
@@ -744,6 +765,28 @@ U_PORT_TEST_FUNCTION("[gnssMga]", "gnssMgaBasic")
                     }
                     U_PORT_TEST_ASSERT(callbackParameter >= 0);
                 }
+                // Compact the database and write it back with windowed flow control
+                y = uGnssMgaDatabaseCompact(gpDatabase, z, NULL, 0);
+                U_TEST_PRINT_LINE("compact database would be %d byte(s) (original %d byte(s)).", y, z);
+                U_PORT_TEST_ASSERT(y > 0);
+                pCompact = (char *) pUPortMalloc(y);
+                U_PORT_TEST_ASSERT(pCompact != NULL);
+                U_PORT_TEST_ASSERT(uGnssMgaDatabaseCompact(gpDatabase, z, pCompact, y) == y);
+                callbackParameter = 0;
+                startTimeMs = uPortGetTickTimeMs();
+                z = uGnssMgaSetDatabaseWindowed(gnssDevHandle, 0, pCompact, y,
+                                                progressCallback, &callbackParameter);
+                U_TEST_PRINT_LINE("uGnssMgaSetDatabaseWindowed() returned %d in %d ms,"
+                                  " progress callback called %d time(s).", z,
+                                  uPortGetTickTimeMs() - startTimeMs, callbackParameter);
+                uPortFree(pCompact);
+                if ((z == (int32_t) U_GNSS_ERROR_NACK) && gDatabaseHasQzss) {
+                    U_TEST_PRINT_LINE("*** WARNING *** uGnssMgaSetDatabaseWindowed() returned %d"
+                                      " but a QZSS MGA DBD record was included, letting that by.", z);
+                } else {
+                    U_PORT_TEST_ASSERT(z == 0);
+                    U_PORT_TEST_ASSERT(callbackParameter >= 0);
+                }
             } else {
                 U_TEST_PRINT_LINE("*** WARNING *** not testing writing database as there is nothing to write.");
             }
@@ -1042,6 +1085,192 @@ U_PORT_TEST_FUNCTION("[gnssMga]", "gnssMgaServer")
 # endif // #if defined(U_CFG_APP_GNSS_ASSIST_NOW_AUTHENTICATION_TOKEN) && defined(U_CFG_TEST_GNSS_MGA) &&
 // (defined(U_CFG_TEST_CELL_MODULE_TYPE) || defined(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE))
 
+/** Test the AssistNow cache validity logic; no GNSS device required.
+ */
+U_PORT_TEST_FUNCTION("[gnssMga]", "gnssMgaCache")
+{
+    // Room for two UBX-MGA-ANO messages, a UBX-MGA-GPS-ALM message
+    // and a UBX-MGA-INI-TIME_UTC message, all with overheads
+    char buffer[((76 * 2) + 36 + 24) + (U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES * 4)];
+    char body[76] = {0};
+    size_t size = 0;
+    uGnssMgaCache_t cache;
+    // 2023/06/01 00:00:00 UTC in milliseconds
+    int64_t dayOneUtcMilliseconds = 1685577600000LL;
+
+    U_TEST_PRINT_LINE("testing AssistNow cache.");
+
+    // Invalid parameters
+    U_PORT_TEST_ASSERT(uGnssMgaCacheCreate(NULL, 0, &cache) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaCacheCreate(buffer, 0, NULL) < 0);
+    U_PORT_TEST_ASSERT(!uGnssMgaCacheIsValid(NULL, dayOneUtcMilliseconds));
+    // No messages
+    U_PORT_TEST_ASSERT(uGnssMgaCacheCreate(buffer, 0, &cache) < 0);
+
+    // AssistNow Offline: a UBX-MGA-ANO message for 2023/06/01,
+    // another for 2023/06/02 and a UBX-MGA-GPS-ALM message
+    body[4] = 23; // Year since 2000
+    body[5] = 6;  // Month
+    body[6] = 1;  // Day
+    size += uUbxProtocolEncode(0x13, 0x20, body, 76, buffer + size);
+    body[6] = 2;
+    size += uUbxProtocolEncode(0x13, 0x20, body, 76, buffer + size);
+    memset(body, 0, sizeof(body));
+    body[0] = 0x02; // Almanac
+    size += uUbxProtocolEncode(0x13, 0x00, body, 36, buffer + size);
+    U_PORT_TEST_ASSERT(uGnssMgaCacheCreate(buffer, size, &cache) == 3);
+    U_PORT_TEST_ASSERT(cache.pBuffer == buffer);
+    U_PORT_TEST_ASSERT(cache.size == size);
+    U_PORT_TEST_ASSERT(!cache.onlineNotOffline);
+    U_PORT_TEST_ASSERT(cache.numMessages == 3);
+    U_PORT_TEST_ASSERT(cache.validFromUtcMilliseconds == dayOneUtcMilliseconds);
+    U_PORT_TEST_ASSERT(cache.validToUtcMilliseconds == dayOneUtcMilliseconds + (2 * 24 * 3600 * 1000LL));
+    U_PORT_TEST_ASSERT(!uGnssMgaCacheIsValid(&cache, dayOneUtcMilliseconds - 1));
+    U_PORT_TEST_ASSERT(uGnssMgaCacheIsValid(&cache, dayOneUtcMilliseconds));
+    U_PORT_TEST_ASSERT(uGnssMgaCacheIsValid(&cache, cache.validToUtcMilliseconds - 1));
+    U_PORT_TEST_ASSERT(!uGnssMgaCacheIsValid(&cache, cache.validToUtcMilliseconds));
+
+    // Almanac only is always valid
+    U_PORT_TEST_ASSERT(uGnssMgaCacheCreate(buffer + ((76 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) * 2),
+                                           36 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES, &cache) == 1);
+    U_PORT_TEST_ASSERT(uGnssMgaCacheIsValid(&cache, dayOneUtcMilliseconds));
+
+    // AssistNow Online: a UBX-MGA-INI-TIME_UTC message for
+    // 2023/06/01 12:00:00 followed by the UBX-MGA-GPS-ALM message
+    // from above
+    size = 0;
+    memset(body, 0, sizeof(body));
+    body[0] = 0x10;
+    *((uint16_t *) (body + 4)) = uUbxProtocolUint16Encode(2023);
+    body[6] = 6;
+    body[7] = 1;
+    body[8] = 12;
+    size += uUbxProtocolEncode(0x13, 0x40, body, 24, buffer + size);
+    memset(body, 0, sizeof(body));
+    body[0] = 0x02;
+    size += uUbxProtocolEncode(0x13, 0x00, body, 36, buffer + size);
+    U_PORT_TEST_ASSERT(uGnssMgaCacheCreate(buffer, size, &cache) == 2);
+    U_PORT_TEST_ASSERT(cache.onlineNotOffline);
+    U_PORT_TEST_ASSERT(cache.validFromUtcMilliseconds == dayOneUtcMilliseconds + (12 * 3600 * 1000LL));
+    U_PORT_TEST_ASSERT(cache.validToUtcMilliseconds == cache.validFromUtcMilliseconds +
+                       (U_GNSS_MGA_CACHE_ONLINE_VALIDITY_SECONDS * 1000LL));
+    U_PORT_TEST_ASSERT(!uGnssMgaCacheIsValid(&cache, dayOneUtcMilliseconds));
+    U_PORT_TEST_ASSERT(uGnssMgaCacheIsValid(&cache, cache.validFromUtcMilliseconds));
+}
+
+/** Test the streaming AssistNow Offline filter; no GNSS device
+ * required.
+ */
+U_PORT_TEST_FUNCTION("[gnssMga]", "gnssMgaOfflineFilter")
+{
+    // Room for two UBX-MGA-ANO messages, a UBX-MGA-GPS-ALM message,
+    // an over-long message and some rubbish, all with overheads
+    char buffer[(76 * 2) + 36 + 200 + 3 + (U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES * 4)];
+    char body[200] = {0};
+    size_t size = 0;
+    uGnssMgaOfflineFilter_t filter;
+    int32_t count;
+    // 2023/06/01 12:00:00 UTC in milliseconds
+    int64_t dayOneUtcMilliseconds = 1685577600000LL + (12 * 3600 * 1000LL);
+    const size_t chunkSize[] = {sizeof(buffer), 1, 7, 64};
+
+    U_TEST_PRINT_LINE("testing AssistNow Offline filter.");
+
+    // Invalid parameters
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineFilterInit(NULL, dayOneUtcMilliseconds) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineFilterInit(&filter, -1) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineFilterInit(&filter, dayOneUtcMilliseconds) == 0);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineFilterPush(NULL, buffer, 1, offlineFilterCallback, &count) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineFilterPush(&filter, buffer, 1, NULL, &count) < 0);
+
+    // Some rubbish, a UBX-MGA-ANO message for 2023/06/01, a message
+    // too long for the filter, another UBX-MGA-ANO message for
+    // 2023/06/02 and a UBX-MGA-GPS-ALM message
+    buffer[size++] = (char) 0xb5;
+    buffer[size++] = 0x00;
+    buffer[size++] = (char) 0xb5;
+    body[4] = 23; // Year since 2000
+    body[5] = 6;  // Month
+    body[6] = 1;  // Day
+    size += uUbxProtocolEncode(0x13, 0x20, body, 76, buffer + size);
+    size += uUbxProtocolEncode(0x13, 0x21, body, 200, buffer + size);
+    body[6] = 2;
+    size += uUbxProtocolEncode(0x13, 0x20, body, 76, buffer + size);
+    memset(body, 0, sizeof(body));
+    body[0] = 0x02; // Almanac
+    size += uUbxProtocolEncode(0x13, 0x00, body, 36, buffer + size);
+    U_PORT_TEST_ASSERT(size == sizeof(buffer));
+
+    // Push it through in different sized chunks, for each day
+    for (size_t x = 0; x < sizeof(chunkSize) / sizeof(chunkSize[0]); x++) {
+        for (int32_t day = 0; day < 3; day++) {
+            U_PORT_TEST_ASSERT(uGnssMgaOfflineFilterInit(&filter, dayOneUtcMilliseconds +
+                                                         (day * 24 * 3600 * 1000LL)) == 0);
+            count = 0;
+            for (size_t y = 0; y < size; y += chunkSize[x]) {
+                size_t z = size - y;
+                if (z > chunkSize[x]) {
+                    z = chunkSize[x];
+                }
+                U_PORT_TEST_ASSERT(uGnssMgaOfflineFilterPush(&filter, buffer + y, z,
+                                                             offlineFilterCallback, &count) >= 0);
+            }
+            U_PORT_TEST_ASSERT(filter.numMessages == 3);
+            U_PORT_TEST_ASSERT(filter.numDiscarded == 1);
+            U_PORT_TEST_ASSERT(filter.numAno == 2);
+            if (day < 2) {
+                // One UBX-MGA-ANO message plus the almanac
+                U_PORT_TEST_ASSERT(count == 2);
+                U_PORT_TEST_ASSERT(filter.numAnoSelected == 1);
+            } else {
+                // Out of date: just the almanac
+                U_PORT_TEST_ASSERT(count == 1);
+                U_PORT_TEST_ASSERT(filter.numAnoSelected == 0);
+            }
+            U_PORT_TEST_ASSERT(filter.numSelected == (size_t) count);
+        }
+    }
+}
+
+/** Test compaction of a navigation database; no GNSS device required.
+ */
+U_PORT_TEST_FUNCTION("[gnssMga]", "gnssMgaDatabaseCompact")
+{
+    // Two records, of 164 and 10 bytes, each preceded by a two byte length
+    char database[(164 + 2) + (10 + 2)];
+    char compact[sizeof(database) + U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES +
+                                    U_GNSS_MGA_DATABASE_COMPACT_CHECKSUM_LENGTH_BYTES];
+    int32_t expectedLength = sizeof(database) - 2 + U_GNSS_MGA_DATABASE_COMPACT_HEADER_LENGTH_BYTES +
+                             U_GNSS_MGA_DATABASE_COMPACT_CHECKSUM_LENGTH_BYTES;
+
+    U_TEST_PRINT_LINE("testing navigation database compaction.");
+
+    for (size_t x = 0; x < sizeof(database); x++) {
+        database[x] = (char) x;
+    }
+    database[0] = (char) 164;
+    database[1] = 0;
+    database[164 + 2] = 10;
+    database[164 + 3] = 0;
+
+    U_PORT_TEST_ASSERT(uGnssMgaDatabaseCompact(NULL, sizeof(database), NULL, 0) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaDatabaseCompact(database, sizeof(database) - 1, NULL, 0) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaDatabaseCompact(database, sizeof(database), NULL, 0) == expectedLength);
+    U_PORT_TEST_ASSERT(uGnssMgaDatabaseCompact(database, sizeof(database), compact,
+                                               expectedLength - 1) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaDatabaseCompact(database, sizeof(database), compact,
+                                               sizeof(compact)) == expectedLength);
+    U_PORT_TEST_ASSERT(memcmp(compact, U_GNSS_MGA_DATABASE_COMPACT_MAGIC, 4) == 0);
+    U_PORT_TEST_ASSERT(compact[4] == U_GNSS_MGA_DATABASE_COMPACT_VERSION);
+    U_PORT_TEST_ASSERT((compact[6] == 2) && (compact[7] == 0));
+    U_PORT_TEST_ASSERT((uint8_t) compact[8] == 164);
+    U_PORT_TEST_ASSERT(memcmp(compact + 9, database + 2, 164) == 0);
+    U_PORT_TEST_ASSERT(compact[9 + 164] == 10);
+    U_PORT_TEST_ASSERT(memcmp(compact + 9 + 164 + 1, database + 164 + 4, 10) == 0);
+    // A compact database is not itself compacted again
+    U_PORT_TEST_ASSERT(uGnssMgaDatabaseCompact(compact, expectedLength, NULL, 0) < 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -99,6 +99,14 @@
 # define U_GNSS_MSG_TEST_MESSAGE_RECEIVE_TIMEOUT_MS 10000
 #endif
 
+#ifndef U_GNSS_MSG_TEST_MESSAGE_RECEIVE_IN_PLACE_ITERATIONS
+/** The number of times to poll for UBX-MON-VER in the in-place
+ * receive test: enough for the ring buffer to wrap part-way
+ * through a message at least once in most cases.
+ */
+# define U_GNSS_MSG_TEST_MESSAGE_RECEIVE_IN_PLACE_ITERATIONS 10
+#endif
+
 #ifndef U_GNSS_MSG_TEST_MESSAGE_RECEIVE_NON_BLOCKING_BUFFER_SIZE_BYTES
 /** A sensible default buffer size for the message receive non-blocking
  * test.
@@ -177,6 +185,37 @@ static uGnssTestPrivate_t gHandles = U_GNSS_TEST_PRIVATE_DEFAULTS;
  */
 static int32_t gCallbackErrorCode = 0;
 
+/** The number of times the ring buffer fill callback has been called.
+ */
+static volatile size_t gFillNumCalls = 0;
+
+/** The fill level last passed to the ring buffer fill callback.
+ */
+static size_t gFillBytes = 0;
+
+/** The capacity last passed to the ring buffer fill callback.
+ */
+static size_t gFillCapacityBytes = 0;
+
+/** Where the in-place receive callback copies the message it
+ * was given.
+ */
+static char *gpInPlaceBuffer = NULL;
+
+/** The length of the message last passed to the in-place receive
+ * callback.
+ */
+static volatile int32_t gInPlaceLength = 0;
+
+/** The number of messages passed to the in-place receive callback.
+ */
+static volatile size_t gInPlaceNumReceived = 0;
+
+/** The number of messages passed to the in-place receive callback
+ * as two segments.
+ */
+static size_t gInPlaceNumWrapped = 0;
+
 #ifndef U_CFG_TEST_USING_NRF5SDK
 
 /** Array of message receivers.
@@ -251,6 +290,59 @@ static void checkMessageReceive(uGnssMessageId_t *pMessageId,
     }
 }
 
+// Callback for the ring buffer fill level crossing a threshold.
+static void fillCallback(uDeviceHandle_t gnssHandle, size_t fillBytes,
+                         size_t capacityBytes, void *pCallbackParam)
+{
+    if (gnssHandle != gHandles.gnssHandle) {
+        gCallbackErrorCode = 1;
+    }
+    if (pCallbackParam != (void *) &gFillNumCalls) {
+        gCallbackErrorCode = 2;
+    }
+    gFillBytes = fillBytes;
+    gFillCapacityBytes = capacityBytes;
+    gFillNumCalls++;
+}
+
+// Callback for the in-place message receive: copies the one or
+// two segments of the message into gpInPlaceBuffer.
+static void messageReceiveInPlaceCallback(uDeviceHandle_t gnssHandle,
+                                          const uGnssMessageId_t *pMessageId,
+                                          int32_t errorCodeOrLength,
+                                          const char *pData1, size_t size1,
+                                          const char *pData2, size_t size2,
+                                          void *pCallbackParam)
+{
+    if (gnssHandle != gHandles.gnssHandle) {
+        gCallbackErrorCode = 1;
+    }
+    if ((pMessageId == NULL) || (pMessageId->type != U_GNSS_PROTOCOL_UBX) ||
+        (pMessageId->id.ubx != 0x0a04)) {
+        gCallbackErrorCode = 2;
+    }
+    if ((errorCodeOrLength < 0) || (size1 + size2 != (size_t) errorCodeOrLength)) {
+        gCallbackErrorCode = 3;
+    }
+    if (pCallbackParam != (void *) &gInPlaceNumReceived) {
+        gCallbackErrorCode = 4;
+    }
+    if ((pData1 == NULL) || ((size2 > 0) && (pData2 == NULL))) {
+        gCallbackErrorCode = 5;
+    }
+
+    if ((gCallbackErrorCode == 0) &&
+        (size1 + size2 <= U_GNSS_MSG_TEST_MESSAGE_RECEIVE_BUFFER_SIZE_BYTES)) {
+        memcpy(gpInPlaceBuffer, pData1, size1);
+        if (size2 > 0) {
+            memcpy(gpInPlaceBuffer + size1, pData2, size2);
+            gInPlaceNumWrapped++;
+        }
+        gInPlaceLength = errorCodeOrLength;
+    }
+    gInPlaceNumReceived++;
+}
+
 // NRF52, which we use NRF5SDK on, doesn't have enough heap for this test
 #ifndef U_CFG_TEST_USING_NRF5SDK
 
@@ -457,6 +549,63 @@ U_PORT_TEST_FUNCTION("[gnssMsg]", "gnssMsgReceiveBlocking")
             U_TEST_PRINT_LINE("%d byte(s) lost at the input to the ring-buffer during that test.", y);
             U_PORT_TEST_ASSERT(y == 0);
 
+            // Check the ring-buffer high-water mark and that the
+            // ring-buffer can be resized
+            y = uGnssGetRingBufferLength(gnssHandle);
+            U_PORT_TEST_ASSERT(y == U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES);
+            x = (int32_t) uGnssMsgReceiveStatHighWaterMark(gnssHandle);
+            U_TEST_PRINT_LINE("ring-buffer high-water mark was %d byte(s) of %d.", x, y - 1);
+            U_PORT_TEST_ASSERT((x > 0) && (x < y));
+            U_PORT_TEST_ASSERT(uGnssSetRingBufferLength(gnssHandle, 1) < 0);
+            U_PORT_TEST_ASSERT(uGnssSetRingBufferLength(gnssHandle, y * 2) == 0);
+            U_PORT_TEST_ASSERT(uGnssGetRingBufferLength(gnssHandle) == y * 2);
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveStatHighWaterMark(gnssHandle) == 0);
+            U_PORT_TEST_ASSERT(uGnssSetRingBufferLength(gnssHandle, y) == 0);
+
+            // Check the ring-buffer fill callback: the threshold must be
+            // sensible, except when removing the callback
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveSetFillCallback(gnssHandle, 0, fillCallback,
+                                                              NULL) < 0);
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveSetFillCallback(gnssHandle, 101, fillCallback,
+                                                              NULL) < 0);
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveSetFillCallback(NULL, 1, fillCallback,
+                                                              NULL) < 0);
+            // With a threshold of 1% the UBX-MON-VER response alone
+            // should be enough to cross it while the receive waits
+            gFillNumCalls = 0;
+            gCallbackErrorCode = 0;
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveSetFillCallback(gnssHandle, 1, fillCallback,
+                                                              (void *) &gFillNumCalls) == 0);
+            pBuffer3 = NULL;
+            uGnssMsgReceiveFlush(gnssHandle, false);
+            U_PORT_TEST_ASSERT(uGnssMsgSend(gnssHandle, command,
+                                            sizeof(command)) == sizeof(command));
+            messageId.type = U_GNSS_PROTOCOL_UBX;
+            messageId.id.ubx = 0x0a04;
+            x = uGnssMsgReceive(gnssHandle, &messageId, &pBuffer3, 0,
+                                U_GNSS_MSG_TEST_MESSAGE_RECEIVE_TIMEOUT_MS, NULL);
+            uPortFree(pBuffer3);
+            U_TEST_PRINT_LINE("fill callback called %d time(s), last with %d byte(s) of %d.",
+                              gFillNumCalls, gFillBytes, gFillCapacityBytes);
+            U_PORT_TEST_ASSERT(x > 0);
+            U_PORT_TEST_ASSERT(gCallbackErrorCode == 0);
+            U_PORT_TEST_ASSERT(gFillNumCalls > 0);
+            U_PORT_TEST_ASSERT(gFillCapacityBytes == (size_t) (y - 1));
+            U_PORT_TEST_ASSERT((gFillBytes >= (size_t) (y - 1) / 100) &&
+                               (gFillBytes <= gFillCapacityBytes));
+            // Once removed, it is not called
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveSetFillCallback(gnssHandle, 0, NULL, NULL) == 0);
+            gFillNumCalls = 0;
+            pBuffer3 = NULL;
+            uGnssMsgReceiveFlush(gnssHandle, false);
+            U_PORT_TEST_ASSERT(uGnssMsgSend(gnssHandle, command,
+                                            sizeof(command)) == sizeof(command));
+            x = uGnssMsgReceive(gnssHandle, &messageId, &pBuffer3, 0,
+                                U_GNSS_MSG_TEST_MESSAGE_RECEIVE_TIMEOUT_MS, NULL);
+            uPortFree(pBuffer3);
+            U_PORT_TEST_ASSERT(x > 0);
+            U_PORT_TEST_ASSERT(gFillNumCalls == 0);
+
             // Do the standard postamble.
             uGnssTestPrivatePostamble(&gHandles, true);
         }
@@ -574,6 +723,8 @@ U_PORT_TEST_FUNCTION("[gnssMsg]", "gnssMsgReceiveNonBlocking")
                     pTmp->moduleType = pModule->moduleType;
                     U_PORT_TEST_ASSERT(pTmp->asyncHandle >= 0);
                 }
+                // A wake-up should be accepted now the task is running
+                U_PORT_TEST_ASSERT(uGnssMsgReceiveWake(gnssHandle) == 0);
 
                 // Messages should now start arriving at our callback
                 U_PORT_TEST_ASSERT(uUbxProtocolEncode(0x02, 0x14, NULL, 0, command) == sizeof(command));
@@ -611,6 +762,7 @@ U_PORT_TEST_FUNCTION("[gnssMsg]", "gnssMsgReceiveNonBlocking")
                 uPortTaskBlock(100);
                 b = uGnssMsgReceiveStopAll(gnssHandle);
                 uPortTaskBlock(100);
+                U_PORT_TEST_ASSERT(uGnssMsgReceiveWake(gnssHandle) < 0);
                 c = uGnssMsgReceiveStatStreamLoss(gnssHandle);
                 d = uGnssMsgReceiveStatReadLoss(gnssHandle);
 
@@ -777,6 +929,131 @@ U_PORT_TEST_FUNCTION("[gnssMsg]", "gnssMsgReceiveNonBlocking")
 
 #endif // U_CFG_TEST_USING_NRF5SDK 
 
+/** Receive messages from the GNSS chip in place, without copying
+ * them out of the ring buffer.
+ */
+U_PORT_TEST_FUNCTION("[gnssMsg]", "gnssMsgReceiveInPlace")
+{
+    uDeviceHandle_t gnssHandle;
+    int32_t resourceCount;
+    char *pBuffer;
+    int32_t asyncHandle;
+    int32_t y;
+    int32_t x;
+    size_t numReceived;
+    // Enough room to encode the poll for a UBX-MON-VER message
+    char command[U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES];
+    uGnssMessageId_t messageId;
+    size_t iterations;
+    uGnssTransportType_t transportTypes[U_GNSS_TRANSPORT_MAX_NUM];
+
+    // In case a previous test failed
+    uGnssTestPrivateCleanup(&gHandles);
+
+    // Get the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Repeat for all transport types except U_GNSS_TRANSPORT_AT
+    iterations = uGnssTestPrivateTransportTypesSet(transportTypes, U_CFG_APP_GNSS_UART,
+                                                   U_CFG_APP_GNSS_I2C, U_CFG_APP_GNSS_SPI);
+    for (size_t w = 0; w < iterations; w++) {
+        // Only do this for non-message-filtered transport since that is the worst case
+        if ((transportTypes[w] == U_GNSS_TRANSPORT_UART) ||
+            (transportTypes[w] == U_GNSS_TRANSPORT_UART_2) ||
+            (transportTypes[w] == U_GNSS_TRANSPORT_I2C)) {
+            // Do the standard preamble
+            U_TEST_PRINT_LINE("testing on transport %s...",
+                              pGnssTestPrivateTransportTypeName(transportTypes[w]));
+            U_PORT_TEST_ASSERT(uGnssTestPrivatePreamble(U_CFG_TEST_GNSS_MODULE_TYPE,
+                                                        transportTypes[w], &gHandles, true,
+                                                        U_CFG_APP_CELL_PIN_GNSS_POWER,
+                                                        U_CFG_APP_CELL_PIN_GNSS_DATA_READY) == 0);
+            gnssHandle = gHandles.gnssHandle;
+
+            // Make sure NMEA is on, so that there's plenty of traffic
+            // to move the messages we want around the ring buffer
+            U_PORT_TEST_ASSERT(uGnssCfgSetProtocolOut(gnssHandle, U_GNSS_PROTOCOL_NMEA, true) == 0);
+
+            pBuffer = (char *) pUPortMalloc(U_GNSS_MSG_TEST_MESSAGE_RECEIVE_BUFFER_SIZE_BYTES);
+            U_PORT_TEST_ASSERT(pBuffer != NULL);
+            gpInPlaceBuffer = (char *) pUPortMalloc(
+                                  U_GNSS_MSG_TEST_MESSAGE_RECEIVE_BUFFER_SIZE_BYTES);
+            U_PORT_TEST_ASSERT(gpInPlaceBuffer != NULL);
+
+            // Get the firmware version string in the normal way to compare with
+            U_TEST_PRINT_LINE("getting the version string the normal way...");
+            y = uGnssInfoGetFirmwareVersionStr(gnssHandle, pBuffer,
+                                               U_GNSS_MSG_TEST_MESSAGE_RECEIVE_BUFFER_SIZE_BYTES);
+            U_PORT_TEST_ASSERT(y > 0);
+
+            // A callback is required
+            messageId.type = U_GNSS_PROTOCOL_UBX;
+            messageId.id.ubx = 0x0a04;
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveStartInPlace(gnssHandle, &messageId,
+                                                           NULL, NULL) < 0);
+
+            // Now start an in-place receiver for UBX-MON-VER
+            gCallbackErrorCode = 0;
+            gInPlaceNumReceived = 0;
+            gInPlaceNumWrapped = 0;
+            asyncHandle = uGnssMsgReceiveStartInPlace(gnssHandle, &messageId,
+                                                      messageReceiveInPlaceCallback,
+                                                      (void *) &gInPlaceNumReceived);
+            U_PORT_TEST_ASSERT(asyncHandle >= 0);
+
+            // Poll for it repeatedly, checking each one that arrives
+            x = uUbxProtocolEncode(0x0a, 0x04, NULL, 0, command);
+            U_PORT_TEST_ASSERT(x == sizeof(command));
+            U_TEST_PRINT_LINE("receiving UBX-MON-VER in place %d time(s)...",
+                              U_GNSS_MSG_TEST_MESSAGE_RECEIVE_IN_PLACE_ITERATIONS);
+            for (size_t z = 0; z < U_GNSS_MSG_TEST_MESSAGE_RECEIVE_IN_PLACE_ITERATIONS; z++) {
+                numReceived = gInPlaceNumReceived;
+                gInPlaceLength = 0;
+                U_PORT_TEST_ASSERT(uGnssMsgSend(gnssHandle, command,
+                                                sizeof(command)) == sizeof(command));
+                gStopTimeMs = uPortGetTickTimeMs() + U_GNSS_MSG_TEST_MESSAGE_RECEIVE_TIMEOUT_MS;
+                while ((gInPlaceNumReceived == numReceived) &&
+                       (uPortGetTickTimeMs() < gStopTimeMs)) {
+                    uPortTaskBlock(100);
+                }
+                U_TEST_PRINT_LINE("the callback error code was %d.", gCallbackErrorCode);
+                U_PORT_TEST_ASSERT(gCallbackErrorCode == 0);
+                U_PORT_TEST_ASSERT(gInPlaceNumReceived == numReceived + 1);
+                checkMessageReceive(NULL, gpInPlaceBuffer, gInPlaceLength, 0x0a04,
+                                    y + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES, pBuffer);
+            }
+            U_TEST_PRINT_LINE("%d of %d message(s) were passed in two segments.",
+                              gInPlaceNumWrapped, gInPlaceNumReceived);
+
+            // Once stopped the callback should not be called
+            U_PORT_TEST_ASSERT(uGnssMsgReceiveStop(gnssHandle, asyncHandle) == 0);
+            numReceived = gInPlaceNumReceived;
+            U_PORT_TEST_ASSERT(uGnssMsgSend(gnssHandle, command,
+                                            sizeof(command)) == sizeof(command));
+            uPortTaskBlock(2000);
+            U_PORT_TEST_ASSERT(gInPlaceNumReceived == numReceived);
+
+            y = uGnssMsgReceiveStatStreamLoss(gnssHandle);
+            U_TEST_PRINT_LINE("%d byte(s) lost at the input to the ring-buffer during that test.", y);
+            U_PORT_TEST_ASSERT(y == 0);
+
+            // Free memory
+            uPortFree(gpInPlaceBuffer);
+            gpInPlaceBuffer = NULL;
+            uPortFree(pBuffer);
+
+            // Do the standard postamble.
+            uGnssTestPrivatePostamble(&gHandles, true);
+        }
+    }
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -785,6 +1062,9 @@ U_PORT_TEST_FUNCTION("[gnssMsg]", "gnssMsgCleanUp")
 {
     uGnssTestPrivateCleanup(&gHandles);
 
+    uPortFree(gpInPlaceBuffer);
+    gpInPlaceBuffer = NULL;
+
 #ifndef U_CFG_TEST_USING_NRF5SDK
     for (size_t x = 0; x < sizeof(gpMessageReceive) / sizeof(gpMessageReceive[0]); x++) {
         if (gpMessageReceive[x] != NULL) {
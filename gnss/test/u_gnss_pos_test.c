@@ -39,6 +39,7 @@
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
 #include "limits.h"    // INT_MIN, LONG_MIN
+#include "string.h"    // memset()
 
 #include "u_cfg_sw.h"
 #include "u_cfg_os_platform_specific.h"
@@ -67,6 +68,7 @@
 #include "u_gnss_pwr.h"
 #include "u_gnss_msg.h" // uGnssMsgReceiveStatStreamLoss()
 #include "u_gnss_pos.h"
+#include "u_gnss_geofence.h"
 #include "u_gnss_private.h"
 
 #include "u_gnss_test_private.h"
@@ -185,6 +187,12 @@
 # define U_GNSS_POS_TEST_STREAMED_WAIT_SECONDS 5
 #endif
 
+#ifndef U_GNSS_POS_TEST_STREAMED_DECIMATION
+/** The decimation to apply when testing filtered streamed position.
+ */
+# define U_GNSS_POS_TEST_STREAMED_DECIMATION 4
+#endif
+
 #ifndef U_GNSS_POS_TEST_STREAMED_SECONDS
 /** How long to run streamed position for, once it has started
  * returning good results.
@@ -192,6 +200,13 @@
 # define U_GNSS_POS_TEST_STREAMED_SECONDS 10
 #endif
 
+#ifndef U_GNSS_POS_TEST_GEOFENCE_RADIUS_MM
+/** The radius of the geofence placed around the streamed position,
+ * large so that the position is well inside it.
+ */
+# define U_GNSS_POS_TEST_GEOFENCE_RADIUS_MM 100000000
+#endif
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -200,6 +215,23 @@
  */
 static int64_t gStopTimeMs;
 
+/** The number of geofence entry events.
+ */
+static volatile size_t gGeofenceEnterCount = 0;
+
+/** The number of geofence exit events.
+ */
+static volatile size_t gGeofenceExitCount = 0;
+
+/** The fence ID of the last geofence event.
+ */
+static int32_t gGeofenceLastFenceId = -1;
+
+/** The set of fences used with the streamed position, kept here
+ * so that it can be freed by the clean-up.
+ */
+static uGnssGeofence_t *gpGeofence = NULL;
+
 /** Handles.
  */
 static uGnssTestPrivate_t gHandles = U_GNSS_TEST_PRIVATE_DEFAULTS;
@@ -314,6 +346,28 @@ static void posCallback(uDeviceHandle_t gnssHandle,
     }
 }
 
+// Geofence callback.
+static void geofenceCallback(uDeviceHandle_t gnssHandle,
+                             int32_t fenceId,
+                             uGnssGeofenceEvent_t event,
+                             int32_t latitudeX1e7,
+                             int32_t longitudeX1e7,
+                             void *pCallbackParam)
+{
+    (void) latitudeX1e7;
+    (void) longitudeX1e7;
+
+    if ((gnssHandle != gHandles.gnssHandle) || (pCallbackParam != (void *) &gGeofenceEnterCount)) {
+        gErrorCode = 1;
+    }
+    gGeofenceLastFenceId = fenceId;
+    if (event == U_GNSS_GEOFENCE_EVENT_ENTER) {
+        gGeofenceEnterCount++;
+    } else {
+        gGeofenceExitCount++;
+    }
+}
+
 // Convert a lat/long into a whole number and a
 // bit-after-the-decimal-point that can be printed
 // without having to invoke floating point operations,
@@ -687,6 +741,7 @@ U_PORT_TEST_FUNCTION("[gnssPos]", "gnssPosStreamed")
     int32_t a = -1;
     int32_t b = -1;
     uGnssTimeSystem_t t = U_GNSS_TIME_SYSTEM_NONE;
+    uGnssPosStreamedFilter_t filter;
 
     // In case a previous test failed
     uGnssTestPrivateCleanup(&gHandles);
@@ -829,6 +884,74 @@ U_PORT_TEST_FUNCTION("[gnssPos]", "gnssPosStreamed")
                 // Don't, stop, me, now.
             }
 
+            // Restart with a decimation filter and check that the
+            // callback is called correspondingly less often
+            uGnssSetUbxMessagePrint(gnssHandle, false);
+            memset(&filter, 0, sizeof(filter));
+            filter.decimation = U_GNSS_POS_TEST_STREAMED_DECIMATION;
+            U_TEST_PRINT_LINE("testing streamed position with a decimation of %d.",
+                              filter.decimation);
+            gErrorCode = 0xFFFFFFFF;
+            U_PORT_TEST_ASSERT(uGnssPosGetStreamedStartFiltered(gnssHandle,
+                                                                U_GNSS_POS_TEST_STREAMED_RATE_MS,
+                                                                &filter, posCallback) == 0);
+            uPortTaskBlock(1000 * U_GNSS_POS_TEST_STREAMED_WAIT_SECONDS);
+            gGoodPosCount = 0;
+            uPortTaskBlock(1000 * U_GNSS_POS_TEST_STREAMED_SECONDS);
+            y = (int32_t) gGoodPosCount;
+            uGnssSetUbxMessagePrint(gnssHandle, true);
+            U_TEST_PRINT_LINE("with decimation the callback was called with a good position"
+                              " %d time(s) in %d second(s).", y, U_GNSS_POS_TEST_STREAMED_SECONDS);
+            if (gErrorCode == 0) {
+                U_PORT_TEST_ASSERT(y > 0);
+                U_PORT_TEST_ASSERT(y <= (((U_GNSS_POS_TEST_STREAMED_SECONDS * 1000) /
+                                          U_GNSS_POS_TEST_STREAMED_RATE_MS) /
+                                         U_GNSS_POS_TEST_STREAMED_DECIMATION) + 1);
+            }
+
+            if ((gErrorCode == 0) && (gLatitudeX1e7 > INT_MIN)) {
+                // Attach a set of fences, one around the position we
+                // have and one a couple of degrees of latitude away,
+                // and run streamed position with no callback of its own
+                U_TEST_PRINT_LINE("testing streamed position with geofencing.");
+                y = uGnssPosGetStreamedStartFiltered(gnssHandle, U_GNSS_POS_TEST_STREAMED_RATE_MS,
+                                                     NULL, NULL);
+                U_PORT_TEST_ASSERT(y < 0);
+                gpGeofence = pUGnssGeofenceCreate(0, geofenceCallback,
+                                                  (void *) &gGeofenceEnterCount);
+                U_PORT_TEST_ASSERT(gpGeofence != NULL);
+                U_PORT_TEST_ASSERT(uGnssGeofenceAddCircle(gpGeofence, 1, gLatitudeX1e7,
+                                                          gLongitudeX1e7,
+                                                          U_GNSS_POS_TEST_GEOFENCE_RADIUS_MM) == 0);
+                y = (gLatitudeX1e7 > 0) ? gLatitudeX1e7 - 20000000 : gLatitudeX1e7 + 20000000;
+                U_PORT_TEST_ASSERT(uGnssGeofenceAddCircle(gpGeofence, 2, y, gLongitudeX1e7,
+                                                          1000000) == 0);
+                U_PORT_TEST_ASSERT(uGnssGeofenceAttach(NULL, gpGeofence) < 0);
+                U_PORT_TEST_ASSERT(uGnssGeofenceAttach(gnssHandle, gpGeofence) == 0);
+                gGeofenceEnterCount = 0;
+                gGeofenceExitCount = 0;
+                gGoodPosCount = 0;
+                y = uGnssPosGetStreamedStartFiltered(gnssHandle, U_GNSS_POS_TEST_STREAMED_RATE_MS,
+                                                     NULL, NULL);
+                U_PORT_TEST_ASSERT(y == 0);
+                uPortTaskBlock(1000 * U_GNSS_POS_TEST_STREAMED_SECONDS);
+                U_TEST_PRINT_LINE("%d geofence entry event(s), %d exit event(s).",
+                                  gGeofenceEnterCount, gGeofenceExitCount);
+                uGnssPosGetStreamedStop(gnssHandle);
+                U_PORT_TEST_ASSERT(uGnssGeofenceAttach(gnssHandle, NULL) == 0);
+                U_PORT_TEST_ASSERT(gErrorCode == 0);
+                // The position callback was not called and the fence
+                // around the position was entered, the other not
+                U_PORT_TEST_ASSERT(gGoodPosCount == 0);
+                U_PORT_TEST_ASSERT(gGeofenceEnterCount == 1);
+                U_PORT_TEST_ASSERT(gGeofenceExitCount == 0);
+                U_PORT_TEST_ASSERT(gGeofenceLastFenceId == 1);
+                U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(gpGeofence, 1) == 1);
+                U_PORT_TEST_ASSERT(uGnssGeofenceIsInside(gpGeofence, 2) == 0);
+                uGnssGeofenceFree(gpGeofence);
+                gpGeofence = NULL;
+            }
+
             // Now stop
             uGnssPosGetStreamedStop(gnssHandle);
 
@@ -912,6 +1035,15 @@ U_PORT_TEST_FUNCTION("[gnssPos]", "gnssPosCleanUp")
         uGnssCfgSetProtocolOut(gHandles.gnssHandle, U_GNSS_PROTOCOL_NMEA, true);
     }
 
+    if (gpGeofence != NULL) {
+        if (gHandles.gnssHandle != NULL) {
+            uGnssPosGetStreamedStop(gHandles.gnssHandle);
+            uGnssGeofenceAttach(gHandles.gnssHandle, NULL);
+        }
+        uGnssGeofenceFree(gpGeofence);
+        gpGeofence = NULL;
+    }
+
     uGnssTestPrivateCleanup(&gHandles);
     uPortDeinit();
     // Printed for information: asserting happens in the postamble
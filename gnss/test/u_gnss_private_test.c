@@ -891,6 +891,71 @@ U_PORT_TEST_FUNCTION("[gnss]", "gnssPrivateUbx")
 
 #endif // #ifndef __ZEPHYR__
 
+/** Test the stripping of SPI fill, which compares a word at
+ * a time, at a variety of alignments and lengths.
+ */
+U_PORT_TEST_FUNCTION("[gnss]", "gnssPrivateSpiFill")
+{
+    uGnssPrivateInstance_t *pInstance;
+    uRingBuffer_t ringBuffer;
+    char buffer[U_GNSS_SPI_FILL_THRESHOLD_MAX + 8];
+    int32_t fillThreshold = 48;
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    gpLinearBuffer = (char *) pUPortMalloc(U_GNSS_PRIVATE_TEST_RINGBUFFER_SIZE);
+    U_PORT_TEST_ASSERT(gpLinearBuffer != NULL);
+    U_PORT_TEST_ASSERT(uRingBufferCreate(&ringBuffer, gpLinearBuffer,
+                                         U_GNSS_PRIVATE_TEST_RINGBUFFER_SIZE) == 0);
+    pInstance = (uGnssPrivateInstance_t *) pUPortMalloc(sizeof(*pInstance));
+    U_PORT_TEST_ASSERT(pInstance != NULL);
+    memset(pInstance, 0, sizeof(*pInstance));
+    pInstance->pSpiRingBuffer = &ringBuffer;
+    pInstance->spiFillThreshold = fillThreshold;
+
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t fill = 0; fill <= U_GNSS_SPI_FILL_THRESHOLD_MAX; fill += 7) {
+            // A run of fill followed by ten bytes of data: the fill
+            // should only be removed if it reaches the threshold
+            memset(buffer, 0xFF, sizeof(buffer));
+            if (fill + 10 <= U_GNSS_SPI_FILL_THRESHOLD_MAX) {
+                memset(buffer + offset + fill, 'x', 10);
+                U_PORT_TEST_ASSERT(uGnssPrivateSpiAddReceivedData(pInstance,
+                                                                  buffer + offset,
+                                                                  fill + 10) ==
+                                   (int32_t) (fill < (size_t) fillThreshold ? fill + 10 : 10));
+            } else {
+                // Nothing but fill
+                U_PORT_TEST_ASSERT(uGnssPrivateSpiAddReceivedData(pInstance,
+                                                                  buffer + offset,
+                                                                  fill) ==
+                                   (int32_t) (fill < (size_t) fillThreshold ? fill : 0));
+            }
+            uRingBufferReset(&ringBuffer);
+        }
+    }
+
+    uPortFree(pInstance);
+    uRingBufferDelete(&ringBuffer);
+    uPortFree(gpLinearBuffer);
+    gpLinearBuffer = NULL;
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -64,6 +64,7 @@
 #include "u_gnss_type.h"
 #include "u_gnss.h"
 #include "u_gnss_pwr.h"
+#include "u_gnss_pwr_plan.h"
 #include "u_gnss_msg.h" // uGnssMsgReceiveStatStreamLoss()
 #include "u_gnss_cfg.h"
 #include "u_gnss_cfg_val_key.h"
@@ -660,6 +661,56 @@ U_PORT_TEST_FUNCTION("[gnssPwr]", "gnssPwrSaving")
 
 #endif // #ifndef U_CFG_TEST_GNSS_POWER_SAVING_NOT_SUPPORTED
 
+/** Test the working out of a power plan; no GNSS device required.
+ */
+U_PORT_TEST_FUNCTION("[gnssPwr]", "gnssPwrPlanCalculate")
+{
+    uGnssPwrPlan_t plan;
+
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(0, 10000, true, true, &plan) < 0);
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(60, 0, true, true, &plan) < 0);
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(60, 10000, true, true, NULL) < 0);
+
+    // Frequent fixes: cyclic tracking, optimised for power unless
+    // high accuracy is required
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(1, 10000, true, true, &plan) == 0);
+    U_PORT_TEST_ASSERT(plan.type == U_GNSS_PWR_PLAN_TYPE_CYCLIC_TRACKING);
+    U_PORT_TEST_ASSERT(plan.mode == U_GNSS_PWR_SAVING_MODE_CYCLIC_TRACKING);
+    U_PORT_TEST_ASSERT(plan.acquisitionPeriodSeconds == 1);
+    U_PORT_TEST_ASSERT(plan.flagsSet == (1UL << U_GNSS_PWR_FLAG_CYCLIC_TRACKING_OPTIMISE_FOR_POWER_ENABLE));
+    U_PORT_TEST_ASSERT(!plan.assistNowAutonomous);
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(1, 1000, true, true, &plan) == 0);
+    U_PORT_TEST_ASSERT(plan.flagsSet == 0);
+    U_PORT_TEST_ASSERT(plan.flagsClear == (1UL << U_GNSS_PWR_FLAG_CYCLIC_TRACKING_OPTIMISE_FOR_POWER_ENABLE));
+
+    // Every minute: on/off with AssistNow Autonomous
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(60, 10000, true, true, &plan) == 0);
+    U_PORT_TEST_ASSERT(plan.type == U_GNSS_PWR_PLAN_TYPE_ON_OFF);
+    U_PORT_TEST_ASSERT(plan.mode == U_GNSS_PWR_SAVING_MODE_ON_OFF);
+    U_PORT_TEST_ASSERT(plan.acquisitionPeriodSeconds == 60);
+    U_PORT_TEST_ASSERT(plan.maxAcquisitionTimeSeconds == 30);
+    U_PORT_TEST_ASSERT(plan.onTimeSeconds == 0);
+    U_PORT_TEST_ASSERT(plan.assistNowAutonomous);
+    U_PORT_TEST_ASSERT(!plan.databaseSaveRestore);
+    U_PORT_TEST_ASSERT(plan.maxTimeToFixSeconds >= 60 + 30);
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(60, 1000, true, true, &plan) == 0);
+    U_PORT_TEST_ASSERT(plan.onTimeSeconds == U_GNSS_PWR_PLAN_HIGH_ACCURACY_ON_TIME_SECONDS);
+
+    // Every few hours: host-controlled, back-up if possible, else
+    // off with the navigation database saved and restored
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(3600 * 4, 10000, true, true, &plan) == 0);
+    U_PORT_TEST_ASSERT(plan.type == U_GNSS_PWR_PLAN_TYPE_HOST_BACKUP);
+    U_PORT_TEST_ASSERT(!plan.databaseSaveRestore);
+    U_PORT_TEST_ASSERT(plan.maxTimeToFixSeconds == U_GNSS_PWR_PLAN_MAX_TIME_TO_FIX_SECONDS);
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(3600 * 4, 10000, false, true, &plan) == 0);
+    U_PORT_TEST_ASSERT(plan.type == U_GNSS_PWR_PLAN_TYPE_HOST_OFF);
+    U_PORT_TEST_ASSERT(plan.databaseSaveRestore);
+    U_PORT_TEST_ASSERT(uGnssPwrPlanCalculate(3600 * 4, 10000, false, false, &plan) == 0);
+    U_PORT_TEST_ASSERT(plan.type == U_GNSS_PWR_PLAN_TYPE_HOST_OFF);
+    U_PORT_TEST_ASSERT(!plan.databaseSaveRestore);
+    uGnssPwrPlanClear(&plan);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Tests for the GNSS time pulse API: these should pass on all
+ * platforms that have a GNSS module connected to them.  They
+ * are only compiled if U_CFG_TEST_GNSS_MODULE_TYPE is defined.
+ * The test system does not wire TIMEPULSE to the MCU, hence the
+ * interrupt is stood in for by calling uGnssTimePulseNotify()
+ * from task space.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the U_PORT_TEST_FUNCTION()
+ * macro.
+ */
+
+#ifdef U_CFG_TEST_GNSS_MODULE_TYPE
+
+# ifdef U_CFG_OVERRIDE
+#  include "u_cfg_override.h" // For a customer's configuration override
+# endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_at_client.h" // Required by u_gnss_private.h
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+#include "u_port_uart.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss.h"
+#include "u_gnss_time.h"
+#include "u_gnss_private.h"
+
+#include "u_gnss_test_private.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_GNSS_TIME_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+#ifndef U_GNSS_TIME_TEST_PULSE_TIMEOUT_SECONDS
+/** How long to wait for a UBX-TIM-TP message to pair with.
+ */
+# define U_GNSS_TIME_TEST_PULSE_TIMEOUT_SECONDS 10
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Handles.
+ */
+static uGnssTestPrivate_t gHandles = U_GNSS_TEST_PRIVATE_DEFAULTS;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Pair a time pulse with UBX-TIM-TP.
+ */
+U_PORT_TEST_FUNCTION("[gnssTime]", "gnssTimePulse")
+{
+    uDeviceHandle_t gnssHandle;
+    int32_t resourceCount;
+    int32_t y;
+    int32_t startTimeMs;
+    int64_t timeNanoseconds;
+    uGnssTimePulse_t timePulse;
+    size_t iterations;
+    uGnssTransportType_t transportTypes[U_GNSS_TRANSPORT_MAX_NUM];
+
+    // In case a previous test failed
+    uGnssTestPrivateCleanup(&gHandles);
+
+    // Get the initial resource count
+    resourceCount = uTestUtilGetDynamicResourceCount();
+
+    // Repeat for all transport types
+    iterations = uGnssTestPrivateTransportTypesSet(transportTypes, U_CFG_APP_GNSS_UART,
+                                                   U_CFG_APP_GNSS_I2C, U_CFG_APP_GNSS_SPI);
+    for (size_t w = 0; w < iterations; w++) {
+        // Do the standard preamble
+        U_TEST_PRINT_LINE("testing on transport %s...",
+                          pGnssTestPrivateTransportTypeName(transportTypes[w]));
+        U_PORT_TEST_ASSERT(uGnssTestPrivatePreamble(U_CFG_TEST_GNSS_MODULE_TYPE,
+                                                    transportTypes[w], &gHandles, true,
+                                                    U_CFG_APP_CELL_PIN_GNSS_POWER,
+                                                    U_CFG_APP_CELL_PIN_GNSS_DATA_READY) == 0);
+        gnssHandle = gHandles.gnssHandle;
+
+        // Nothing should work before the time pulse is started
+        U_PORT_TEST_ASSERT(uGnssTimePulseNotify(gnssHandle) < 0);
+        U_PORT_TEST_ASSERT(uGnssTimePulseGet(gnssHandle, &timePulse) < 0);
+
+        if (transportTypes[w] == U_GNSS_TRANSPORT_AT) {
+            // The time pulse is not supported on an AT transport
+            U_PORT_TEST_ASSERT(uGnssTimePulseStart(gnssHandle) < 0);
+        } else {
+            // So that we can see what we're doing
+            uGnssSetUbxMessagePrint(gnssHandle, true);
+
+            U_PORT_TEST_ASSERT(uGnssTimePulseStart(gnssHandle) == 0);
+            // Starting again should do no harm
+            U_PORT_TEST_ASSERT(uGnssTimePulseStart(gnssHandle) == 0);
+            U_PORT_TEST_ASSERT(uGnssTimePulseGet(gnssHandle, &timePulse) ==
+                               (int32_t) U_ERROR_COMMON_NOT_FOUND);
+
+            // Stand in for the interrupt until a pulse is paired
+            U_TEST_PRINT_LINE("waiting up to %d second(s) for UBX-TIM-TP...",
+                              U_GNSS_TIME_TEST_PULSE_TIMEOUT_SECONDS);
+            y = -1;
+            startTimeMs = uPortGetTickTimeMs();
+            while ((y < 0) &&
+                   (uPortGetTickTimeMs() - startTimeMs < (U_GNSS_TIME_TEST_PULSE_TIMEOUT_SECONDS * 1000))) {
+                uPortTaskBlock(100);
+                y = uGnssTimePulseNotify(gnssHandle);
+            }
+            U_PORT_TEST_ASSERT(y == 0);
+            // The same UBX-TIM-TP cannot be used twice
+            U_PORT_TEST_ASSERT(uGnssTimePulseNotify(gnssHandle) < 0);
+
+            U_PORT_TEST_ASSERT(uGnssTimePulseGet(gnssHandle, &timePulse) == 0);
+            U_TEST_PRINT_LINE("time pulse %d at tick %d ms is %d.%09d %s, qErr %d ps.",
+                              timePulse.count, timePulse.tickTimeMs,
+                              (int32_t) (timePulse.timeNanoseconds / 1000000000),
+                              (int32_t) (timePulse.timeNanoseconds % 1000000000),
+                              timePulse.utc ? "UTC" : "GNSS time",
+                              timePulse.quantisationErrorPicoseconds);
+            U_PORT_TEST_ASSERT(timePulse.count == 1);
+            U_PORT_TEST_ASSERT(timePulse.timeNanoseconds > 0);
+
+            uPortTaskBlock(100);
+            y = uGnssTimeGetNow(gnssHandle, &timeNanoseconds);
+            U_PORT_TEST_ASSERT(y >= 100);
+            U_PORT_TEST_ASSERT(timeNanoseconds >= timePulse.timeNanoseconds + (int64_t) y * 1000000);
+
+            uGnssTimePulseStop(gnssHandle);
+            U_PORT_TEST_ASSERT(uGnssTimePulseGet(gnssHandle, &timePulse) < 0);
+        }
+
+        // Do the standard postamble, leaving the module on for the next
+        // test to speed things up
+        uGnssTestPrivatePostamble(&gHandles, false);
+    }
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Clean-up to be run at the end of this round of tests, just
+ * in case there were test failures which would have resulted
+ * in the deinitialisation being skipped.
+ */
+U_PORT_TEST_FUNCTION("[gnssTime]", "gnssTimeCleanUp")
+{
+    if (gHandles.gnssHandle != NULL) {
+        // Put the UBX-TIM-TP message rate back if a test failed
+        uGnssTimePulseStop(gHandles.gnssHandle);
+    }
+    uGnssTestPrivateCleanup(&gHandles);
+    uPortDeinit();
+    // Printed for information: asserting happens in the postamble
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+}
+
+#endif // #ifdef U_CFG_TEST_GNSS_MODULE_TYPE
+
+// End of file
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_PORT_ATOMIC_H_
+#define _U_PORT_ATOMIC_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+/** \addtogroup __port __Port
+ *  @{
+ */
+
+/** @file
+ * @brief Portable atomic operations and memory barrier API, for
+ * lock-free structures (e.g. single-producer/single-consumer
+ * queues, reference counts, "done" flags) that are shared between
+ * tasks or between a task and an interrupt.  All of the operations
+ * are sequentially consistent, i.e. each is also a full memory
+ * barrier.
+ *
+ * A default implementation of these functions is provided in
+ * u_port_atomic.c: with GCC/Clang (Linux, Zephyr, ESP-IDF, nRF5,
+ * STM32Cube) it uses the compiler's atomic built-ins, which are
+ * exactly what C11 <stdatomic.h> maps to but which may be applied
+ * to a plain int32_t, with Microsoft Visual C++ (Windows) it uses
+ * the Interlocked intrinsics and on an ARMv6-M core (Cortex-M0/M0+),
+ * which has no load-exclusive/store-exclusive instructions, it
+ * masks interrupts around each operation.  Should a platform need
+ * something different the functions may be overridden.
+ *
+ * These functions are what all of ubxlib uses for lock-free code;
+ * the U_ATOMIC_XXX macros in u_compiler.h are only there for the
+ * resource counters of the platform ports.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Read a 32-bit variable atomically.
+ *
+ * @param[in] pValue a pointer to the variable; cannot be NULL.
+ * @return           the value of the variable.
+ */
+int32_t uPortAtomicLoad(const volatile int32_t *pValue);
+
+/** Write a 32-bit variable atomically.
+ *
+ * @param[in] pValue a pointer to the variable; cannot be NULL.
+ * @param value      the value to write.
+ */
+void uPortAtomicStore(volatile int32_t *pValue, int32_t value);
+
+/** If the 32-bit variable at pValue is equal to expected then
+ * set it to desired, atomically.
+ *
+ * @param[in] pValue a pointer to the variable; cannot be NULL.
+ * @param expected   the value the variable is expected to have.
+ * @param desired    the value to set the variable to if it has
+ *                   the expected value.
+ * @return           true if the variable had the expected value
+ *                   and has been set to desired, else false.
+ */
+bool uPortAtomicCompareExchange(volatile int32_t *pValue,
+                                int32_t expected, int32_t desired);
+
+/** Add to a 32-bit variable atomically; use a negative value to
+ * subtract.
+ *
+ * @param[in] pValue a pointer to the variable; cannot be NULL.
+ * @param value      the value to add.
+ * @return           the value the variable had BEFORE the addition.
+ */
+int32_t uPortAtomicFetchAdd(volatile int32_t *pValue, int32_t value);
+
+/** Read a pointer atomically.
+ *
+ * @param[in] ppValue a pointer to the pointer; cannot be NULL.
+ * @return            the value of the pointer.
+ */
+void *pUPortAtomicLoadPtr(void *const volatile *ppValue);
+
+/** Write a pointer atomically.
+ *
+ * @param[in] ppValue a pointer to the pointer; cannot be NULL.
+ * @param[in] pValue  the value to write.
+ */
+void uPortAtomicStorePtr(void *volatile *ppValue, void *pValue);
+
+/** If the pointer at ppValue is equal to pExpected then set it
+ * to pDesired, atomically.
+ *
+ * @param[in] ppValue   a pointer to the pointer; cannot be NULL.
+ * @param[in] pExpected the value the pointer is expected to have.
+ * @param[in] pDesired  the value to set the pointer to if it has
+ *                      the expected value.
+ * @return              true if the pointer had the expected value
+ *                      and has been set to pDesired, else false.
+ */
+bool uPortAtomicCompareExchangePtr(void *volatile *ppValue,
+                                   void *pExpected, void *pDesired);
+
+/** A full memory barrier: neither the compiler nor the processor
+ * may move a load or a store from one side of it to the other.
+ */
+void uPortAtomicBarrier(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @}*/
+
+#endif // _U_PORT_ATOMIC_H_
+
+// End of file
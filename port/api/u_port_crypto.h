@@ -29,6 +29,11 @@
 /** @file
  * @brief Porting layer for cryptographic functions, mapped to
  * mbedTLS on most platforms.  These functions are thread-safe.
+ *
+ * Where the MCU has cryptographic hardware it is used through the
+ * hardware backends of mbedTLS itself, see
+ * [port/platform/common/mbedtls](/port/platform/common/mbedtls/README.md)
+ * for how to enable them on each platform.
  */
 
 #ifdef __cplusplus
@@ -43,6 +48,10 @@ extern "C" {
  */
 #define U_PORT_CRYPTO_SHA256_OUTPUT_LENGTH_BYTES 32
 
+/** The size of output buffer required for an MD5 calculation.
+ */
+#define U_PORT_CRYPTO_MD5_OUTPUT_LENGTH_BYTES 16
+
 /** The size of initialisation vector required for an AES 128
  * calculation.
  */
@@ -73,6 +82,84 @@ int32_t uPortCryptoSha256(const char *pInput,
                           size_t inputLengthBytes,
                           char *pOutput);
 
+/** Begin a SHA256 calculation on data that will be supplied in
+ * pieces with uPortCryptoSha256Update(); the result is the same
+ * as calling uPortCryptoSha256() on all of the pieces joined
+ * together, but there is no need to assemble them into one buffer.
+ * The context allocated here is freed by uPortCryptoSha256Finish(),
+ * which must always be called.
+ *
+ * @param[out] ppContext  a place to put the context of the
+ *                        calculation; cannot be NULL.
+ * @return                zero on success else negative error code;
+ *                        as for uPortCryptoSha256(), the error code
+ *                        may be from the underlying cryptographic
+ *                        library.
+ */
+int32_t uPortCryptoSha256Init(void **ppContext);
+
+/** Add data to a SHA256 calculation begun with uPortCryptoSha256Init().
+ *
+ * @param[in] pContext     the context returned by uPortCryptoSha256Init().
+ * @param[in] pInput       a pointer to the input data; cannot be
+ *                         NULL unless inputLengthBytes is zero.
+ * @param inputLengthBytes the length of the input data.
+ * @return                 zero on success else negative error code.
+ */
+int32_t uPortCryptoSha256Update(void *pContext,
+                                const char *pInput,
+                                size_t inputLengthBytes);
+
+/** Complete a SHA256 calculation begun with uPortCryptoSha256Init(),
+ * freeing the context.
+ *
+ * @param[in] pContext  the context returned by uPortCryptoSha256Init();
+ *                      this is freed and cannot be used again.
+ * @param[out] pOutput  a pointer to at least 32 bytes of space
+ *                      to which the output will be written; may be
+ *                      NULL to abandon the calculation.
+ * @return              zero on success else negative error code.
+ */
+int32_t uPortCryptoSha256Finish(void *pContext, char *pOutput);
+
+/** Begin an MD5 calculation on data that will be supplied in
+ * pieces with uPortCryptoMd5Update(); this is the hash with which
+ * the modules identify a stored security credential, see
+ * uSecurityCredentialGetHash().  The context allocated here is
+ * freed by uPortCryptoMd5Finish(), which must always be called.
+ *
+ * @param[out] ppContext  a place to put the context of the
+ *                        calculation; cannot be NULL.
+ * @return                zero on success else negative error code;
+ *                        the error code may be from the underlying
+ *                        cryptographic library.
+ */
+int32_t uPortCryptoMd5Init(void **ppContext);
+
+/** Add data to an MD5 calculation begun with uPortCryptoMd5Init().
+ *
+ * @param[in] pContext     the context returned by uPortCryptoMd5Init().
+ * @param[in] pInput       a pointer to the input data; cannot be
+ *                         NULL unless inputLengthBytes is zero.
+ * @param inputLengthBytes the length of the input data.
+ * @return                 zero on success else negative error code.
+ */
+int32_t uPortCryptoMd5Update(void *pContext,
+                             const char *pInput,
+                             size_t inputLengthBytes);
+
+/** Complete an MD5 calculation begun with uPortCryptoMd5Init(),
+ * freeing the context.
+ *
+ * @param[in] pContext  the context returned by uPortCryptoMd5Init();
+ *                      this is freed and cannot be used again.
+ * @param[out] pOutput  a pointer to at least 16 bytes of space
+ *                      to which the output will be written; may be
+ *                      NULL to abandon the calculation.
+ * @return              zero on success else negative error code.
+ */
+int32_t uPortCryptoMd5Finish(void *pContext, char *pOutput);
+
 /** Perform a HMAC SHA256 calculation on a block of data.
  *
  * @param pKey             a pointer to the key; cannot be NULL.
@@ -94,7 +181,54 @@ int32_t uPortCryptoHmacSha256(const char *pKey,
                               size_t inputLengthBytes,
                               char *pOutput);
 
-/** Perform AES 128 CBC encryption of a block of data.
+/** Begin a HMAC SHA256 calculation on data that will be supplied
+ * in pieces with uPortCryptoHmacSha256Update(); the context allocated
+ * here is freed by uPortCryptoHmacSha256Finish(), which must always
+ * be called.
+ *
+ * @param[out] ppContext   a place to put the context of the
+ *                         calculation; cannot be NULL.
+ * @param[in] pKey         a pointer to the key; cannot be NULL.
+ * @param keyLengthBytes   the length of the key.
+ * @return                 zero on success else negative error code;
+ *                         as for uPortCryptoHmacSha256(), the error
+ *                         code may be from the underlying cryptographic
+ *                         library.
+ */
+int32_t uPortCryptoHmacSha256Init(void **ppContext,
+                                  const char *pKey,
+                                  size_t keyLengthBytes);
+
+/** Add data to a HMAC SHA256 calculation begun with
+ * uPortCryptoHmacSha256Init().
+ *
+ * @param[in] pContext     the context returned by
+ *                         uPortCryptoHmacSha256Init().
+ * @param[in] pInput       a pointer to the input data; cannot be
+ *                         NULL unless inputLengthBytes is zero.
+ * @param inputLengthBytes the length of the input data.
+ * @return                 zero on success else negative error code.
+ */
+int32_t uPortCryptoHmacSha256Update(void *pContext,
+                                    const char *pInput,
+                                    size_t inputLengthBytes);
+
+/** Complete a HMAC SHA256 calculation begun with
+ * uPortCryptoHmacSha256Init(), freeing the context.
+ *
+ * @param[in] pContext  the context returned by uPortCryptoHmacSha256Init();
+ *                      this is freed and cannot be used again.
+ * @param[out] pOutput  a pointer to at least 32 bytes of space
+ *                      to which the output will be written; may be
+ *                      NULL to abandon the calculation.
+ * @return              zero on success else negative error code.
+ */
+int32_t uPortCryptoHmacSha256Finish(void *pContext, char *pOutput);
+
+/** Perform AES 128 CBC encryption of a block of data.  Since
+ * pInitVector is updated, a long stream of data may be encrypted
+ * in pieces (each a multiple of 16 bytes) by calling this function
+ * repeatedly with the same pInitVector.
  *
  * @param pKey                a pointer to the key; cannot be NULL.
  * @param keyLengthBytes      the length of the key; must be 16, 24
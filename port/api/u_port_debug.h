@@ -42,13 +42,77 @@ extern "C" {
  * leave the building is dictated by the platform.
  */
 #if U_CFG_ENABLE_LOGGING
-# define uPortLog(format, ...) \
+# ifdef U_CFG_LOG_DEFERRED
+/** With #U_CFG_LOG_DEFERRED defined, uPortLog() captures the format
+ * pointer and arguments for formatting later, see uPortLogDeferredF().
+ */
+#  define uPortLog(format, ...) \
+             /*lint -e{507} suppress size incompatibility warnings in printf() */ \
+             uPortLogDeferredF(format, ##__VA_ARGS__)
+# else
+#  define uPortLog(format, ...) \
              /*lint -e{507} suppress size incompatibility warnings in printf() */ \
              uPortLogF(format, ##__VA_ARGS__)
+# endif
 #else
 # define uPortLog(...)
 #endif
 
+#ifndef U_PORT_LOG_DEFERRED_NUM_ENTRIES
+/** The number of prints that may be waiting to be formatted when
+ * deferred logging is in use; a print made when this many are
+ * waiting is lost.  Best kept a power of two.  Each entry takes
+ * roughly 20 bytes plus #U_PORT_LOG_DEFERRED_STRINGS_LENGTH_BYTES
+ * plus 8 bytes for each of #U_PORT_LOG_DEFERRED_ARGS_MAX_NUM.
+ */
+# define U_PORT_LOG_DEFERRED_NUM_ENTRIES 32
+#endif
+
+#ifndef U_PORT_LOG_DEFERRED_ARGS_MAX_NUM
+/** The maximum number of arguments of a deferred print, including
+ * any width/precision given by "*"; conversions after this are
+ * printed as they are.
+ */
+# define U_PORT_LOG_DEFERRED_ARGS_MAX_NUM 8
+#endif
+
+#ifndef U_PORT_LOG_DEFERRED_STRINGS_LENGTH_BYTES
+/** The room in each deferred print for copies of the strings
+ * passed to "%s", including terminators; longer strings are
+ * truncated.
+ */
+# define U_PORT_LOG_DEFERRED_STRINGS_LENGTH_BYTES 48
+#endif
+
+#ifndef U_PORT_LOG_DEFERRED_LINE_LENGTH_BYTES
+/** The size of the buffer a deferred print is formatted into
+ * before being passed to uPortLogF(); longer prints are output
+ * in pieces and a single conversion that is longer, or a print
+ * made before uPortLogDeferredInit() that is longer, is formatted
+ * into a buffer taken from the heap.
+ */
+# define U_PORT_LOG_DEFERRED_LINE_LENGTH_BYTES 128
+#endif
+
+#ifndef U_PORT_LOG_DEFERRED_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that formats deferred prints.
+ */
+# define U_PORT_LOG_DEFERRED_TASK_STACK_SIZE_BYTES 2048
+#endif
+
+#ifndef U_PORT_LOG_DEFERRED_TASK_PRIORITY
+/** The priority of the task that formats deferred prints.
+ */
+# define U_PORT_LOG_DEFERRED_TASK_PRIORITY U_CFG_OS_PRIORITY_MIN
+#endif
+
+#ifndef U_PORT_LOG_DEFERRED_TASK_PERIOD_MS
+/** How often the task that formats deferred prints checks for
+ * work to do.
+ */
+# define U_PORT_LOG_DEFERRED_TASK_PERIOD_MS 20
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -82,6 +146,59 @@ int32_t uPortLogOff(void);
  */
 int32_t uPortLogOn(void);
 
+/** Start deferred logging: from now on uPortLogDeferredF(), which
+ * is what uPortLog() calls when #U_CFG_LOG_DEFERRED is defined,
+ * does not format anything, it just captures the format pointer
+ * and arguments (with copies of any strings) into a lock-free
+ * ring and a task running at #U_PORT_LOG_DEFERRED_TASK_PRIORITY
+ * does the formatting.  Since only the pointer to the format is
+ * captured, the format string must remain valid, as a literal
+ * always does.  Should be called after uPortInit(); calling it
+ * when deferred logging is already started has no effect.
+ *
+ * @param[in] pOutput      the function that formatted output
+ *                         should be passed to, where the second
+ *                         parameter is pOutputParam; use NULL for
+ *                         uPortLogF().
+ * @param[in] pOutputParam a parameter that will be passed to
+ *                         pOutput; may be NULL.
+ * @return                 zero on success else negative error code.
+ */
+int32_t uPortLogDeferredInit(void (*pOutput)(const char *, void *),
+                             void *pOutputParam);
+
+/** printf()-style logging which is captured for formatting later
+ * if uPortLogDeferredInit() has been called, else formatted
+ * immediately; this is not usually called directly, define
+ * #U_CFG_LOG_DEFERRED and call uPortLog() instead.  Never blocks:
+ * if the ring is full the print is lost and counted, see
+ * uPortLogDeferredLostGet().
+ *
+ * @param[in] pFormat a printf() style format string.
+ * @param ...        variable argument list.
+ */
+void uPortLogDeferredF(const char *pFormat, ...);
+
+/** Format all of the deferred prints that are waiting, in the
+ * context of the caller; useful before going to sleep or when
+ * something has gone wrong.
+ *
+ * @return the number of prints formatted, else negative error code.
+ */
+int32_t uPortLogDeferredFlush(void);
+
+/** Get the number of deferred prints that have been lost because
+ * the ring was full.
+ *
+ * @return the number of prints lost, else negative error code.
+ */
+int32_t uPortLogDeferredLostGet(void);
+
+/** Stop deferred logging, formatting anything still waiting;
+ * must not be called while other tasks may still be logging.
+ */
+void uPortLogDeferredDeinit(void);
+
 #ifdef __cplusplus
 }
 #endif
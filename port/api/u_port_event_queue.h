@@ -87,6 +87,16 @@
  * the task.  This is a cooperative process: your function
  * must have emptied the queue and exited for shut-down to
  * complete.
+ *
+ * `uPortEventQueueSendExt()` and `uPortEventQueueSendExtIrq()`
+ * add two things.  An event may be given a coalescing key, in
+ * which case it is merged with (i.e. dropped in favour of) an event
+ * with the same key that is still waiting on the queue: useful
+ * for "data received" style events, where the receiving function
+ * deals with all of the data that has arrived in any case, so that
+ * a burst of them cannot fill the queue.  And an event may be sent
+ * at high priority, in which case it is delivered ahead of any
+ * normal events waiting on the queue.
  */
 
 #ifdef __cplusplus
@@ -124,6 +134,57 @@ extern "C" {
                            U_PORT_EVENT_QUEUE_MAX_PARAM_LENGTH_BYTES
 #endif
 
+#ifndef U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM
+/** The number of coalescing keys, see uPortEventQueueSendExt(),
+ * that may be used on each event queue; keys run from zero to
+ * one less than this number.
+ */
+# define U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM 8
+#endif
+
+#ifndef U_PORT_EVENT_QUEUE_HIGH_PRIORITY_LENGTH
+/** The number of high priority events, see uPortEventQueueSendExt(),
+ * that may be waiting on each event queue; each event queue has a
+ * separate OS queue of this length for them.  Set this to zero to
+ * save the memory, in which case high priority events are sent
+ * as normal events.
+ */
+# define U_PORT_EVENT_QUEUE_HIGH_PRIORITY_LENGTH 2
+#endif
+
+#ifndef U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM
+/** The number of worker tasks that service the event queues
+ * opened with uPortEventQueueOpenShared(); the workers are only
+ * started when the first such event queue is opened.
+ */
+# define U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM 2
+#endif
+
+#ifndef U_PORT_EVENT_QUEUE_SHARED_STACK_SIZE_BYTES
+/** The stack size of each of the shared worker tasks; this must
+ * be large enough for the event callback of every event queue
+ * opened with uPortEventQueueOpenShared().
+ */
+# define U_PORT_EVENT_QUEUE_SHARED_STACK_SIZE_BYTES (1024 * 3)
+#endif
+
+#ifndef U_PORT_EVENT_QUEUE_SHARED_PRIORITY
+/** The priority of the shared worker tasks.
+ */
+# define U_PORT_EVENT_QUEUE_SHARED_PRIORITY U_CFG_OS_APP_TASK_PRIORITY
+#endif
+
+#ifndef U_PORT_EVENT_QUEUE_SHARED_READY_LENGTH
+/** The length of the queue on which the shared worker tasks
+ * wait; there is at most one entry on it for each of the event
+ * queues opened with uPortEventQueueOpenShared(), however many
+ * events are waiting, plus one for each worker when they are
+ * stopped, so this must be at least #U_PORT_EVENT_QUEUE_MAX_NUM
+ * plus #U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM.
+ */
+# define U_PORT_EVENT_QUEUE_SHARED_READY_LENGTH 32
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -195,6 +256,39 @@ int32_t uPortEventQueueOpen(void (*pFunction) (void *, size_t),
                             int32_t priority,
                             size_t queueLength);
 
+/** Open an event queue which, rather than having a task of its own,
+ * is serviced by one of a pool of #U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM
+ * worker tasks, shared by all such event queues, saving the RAM of
+ * a stack per event queue.  The events of a given event queue are
+ * still passed to pFunction one at a time and in the order in which
+ * they were sent, though not necessarily always from the same task.
+ * Everything else is as for uPortEventQueueOpen(), the stack size
+ * and priority being those of the workers,
+ * #U_PORT_EVENT_QUEUE_SHARED_STACK_SIZE_BYTES and
+ * #U_PORT_EVENT_QUEUE_SHARED_PRIORITY.
+ *
+ * IMPORTANT: since a worker is busy for as long as pFunction runs,
+ * pFunction should not block for long and MUST NOT wait on the
+ * outcome of an event sent to another shared event queue: with all
+ * of the workers so blocked nothing more would ever be handled.
+ * Use uPortEventQueueOpen() for an event queue whose callback
+ * does such things.
+ *
+ * @param[in] pFunction        the function that will be called by
+ *                             a worker task, cannot be NULL.
+ * @param paramMaxLengthBytes  the maximum length of the parameter
+ *                             structure to pass to the function, as
+ *                             for uPortEventQueueOpen().
+ * @param queueLength          the number of items to let onto the
+ *                             queue before blocking or returning an
+ *                             error, must be at least 1.
+ * @return                     a handle for the event queue on success,
+ *                             else negative error code.
+ */
+int32_t uPortEventQueueOpenShared(void (*pFunction) (void *, size_t),
+                                  size_t paramMaxLengthBytes,
+                                  size_t queueLength);
+
 /** Send to an event queue.  The data at pParam will be copied
  * onto the queue.  If the queue is full this function will block
  * until room is available.  An event queue should not be closed
@@ -235,6 +329,61 @@ int32_t uPortEventQueueSend(int32_t handle, const void *pParam,
 int32_t uPortEventQueueSendIrq(int32_t handle, const void *pParam,
                                size_t paramLengthBytes);
 
+/** As uPortEventQueueSend() but with coalescing and priority.
+ * If coalesceKey is not -1 and an event with the same key is
+ * already waiting on the queue, i.e. it has not yet been passed
+ * to the event function, then this event is not sent and success
+ * is returned; the key is released just before the waiting event
+ * is passed to the event function.  A high priority event is
+ * delivered ahead of any normal events waiting on the queue; if
+ * the #U_PORT_EVENT_QUEUE_HIGH_PRIORITY_LENGTH high priority
+ * entries are all taken this function will block until one is
+ * free.
+ * @param handle            the handle for the event queue.
+ * @param[in] pParam        a pointer to the parameters structure
+ *                          to send.  May be NULL, in which case
+ *                          paramLengthBytes must be zero.
+ * @param paramLengthBytes  the length of the parameters
+ *                          structure.  Must be less than or
+ *                          equal to paramMaxLengthBytes as
+ *                          given to uPortEventQueueOpen().
+ * @param coalesceKey       the coalescing key, from zero to
+ *                          #U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM
+ *                          minus one, or -1 for no coalescing.
+ * @param highPriority      true to send the event at high priority.
+ * @return                  zero on success, including where the
+ *                          event was merged with one already
+ *                          waiting, else negative error code.
+ */
+int32_t uPortEventQueueSendExt(int32_t handle, const void *pParam,
+                               size_t paramLengthBytes,
+                               int32_t coalesceKey, bool highPriority);
+
+/** As uPortEventQueueSendIrq() but with coalescing and priority,
+ * see uPortEventQueueSendExt(); if there is no room the event will
+ * not be sent and an error will be returned.  Note that a high
+ * priority event sent from an interrupt also uses an entry on the
+ * normal queue, if there is one, to wake up the event task.
+ * @param handle            the handle for the event queue.
+ * @param[in] pParam        a pointer to the parameters structure
+ *                          to send.  May be NULL, in which case
+ *                          paramLengthBytes must be zero.
+ * @param paramLengthBytes  the length of the parameters
+ *                          structure.  Must be less than or
+ *                          equal to paramMaxLengthBytes as
+ *                          given to uPortEventQueueOpen().
+ * @param coalesceKey       the coalescing key, from zero to
+ *                          #U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM
+ *                          minus one, or -1 for no coalescing.
+ * @param highPriority      true to send the event at high priority.
+ * @return                  zero on success, including where the
+ *                          event was merged with one already
+ *                          waiting, else negative error code.
+ */
+int32_t uPortEventQueueSendExtIrq(int32_t handle, const void *pParam,
+                                  size_t paramLengthBytes,
+                                  int32_t coalesceKey, bool highPriority);
+
 /** Detect whether the task currently executing is the
  * event task for the given event queue.  Useful if you
  * have code which is called a few levels down from the
@@ -243,13 +392,18 @@ int32_t uPortEventQueueSendIrq(int32_t handle, const void *pParam,
  *
  * @param handle  the handle for the event queue.
  * @return        true if the current task is the event
- *                task for the given handle, else false.
+ *                task for the given handle or, for an event
+ *                queue opened with uPortEventQueueOpenShared(),
+ *                is the worker currently handling an event
+ *                of that event queue, else false.
  */
 bool uPortEventQueueIsTask(int32_t handle);
 
 /** Get the stack high watermark, the minimum free
  * stack, for the task at the end of the given event
- * queue in bytes.
+ * queue in bytes; for an event queue opened with
+ * uPortEventQueueOpenShared() this is the least of
+ * those of the shared worker tasks.
  *
  * @param handle   the handle of the queue to check.
  * @return         the minimum stack free for the lifetime
@@ -274,6 +274,17 @@ typedef uPortGattIter_t (*uPortGattNotifyFunc_t)(int32_t connHandle,
  */
 typedef void (*uPortGattCccWriteResp_t)(int32_t connHandle, uint8_t err);
 
+/** Callback for the end of a notify stream, see uPortGattNotifyStream().
+ *
+ * @param connHandle         connection handle.
+ * @param errorCodeOrLength  the number of bytes sent, else negative
+ *                           error code.
+ * @param[in] pParam         the parameter given to uPortGattNotifyStream().
+ */
+typedef void (*uPortGattNotifyStreamCallback_t)(int32_t connHandle,
+                                                int32_t errorCodeOrLength,
+                                                void *pParam);
+
 /** GATT Subscription parameters.
  *
  * @param notifyCb             callback which will be called on notifications from GATT server.
@@ -419,6 +430,19 @@ int32_t uPortGattGetMtu(int32_t connHandle);
 int32_t uPortGattExchangeMtu(int32_t connHandle,
                              mtuXchangeRespCallback_t respCallback);
 
+/** Ask the controller to use the largest link layer packets it and
+ * the remote device support (the LE data length extension), so that
+ * an MTU-sized packet need not be split across several radio packets.
+ * The outcome is not reported: the request may be turned down by
+ * either side.
+ *
+ * @param connHandle connection handle.
+ * @return           zero if the request was made, else negative error
+ *                   code; #U_ERROR_COMMON_NOT_SUPPORTED if the
+ *                   platform does not support the request.
+ */
+int32_t uPortGattMaximiseDataLength(int32_t connHandle);
+
 /** Send characteristic notification.
  *
  * @param connHandle     connection handle.
@@ -430,6 +454,31 @@ int32_t uPortGattNotify(int32_t connHandle,
                         const uPortGattCharacteristic_t *pChar,
                         const void *data, uint16_t len);
 
+/** Send a buffer of any length as characteristic notifications: the
+ * buffer is split into pieces of the connection MTU, less the three
+ * byte notification header, and several notifications are handed to
+ * the Bluetooth stack at once so that they may go out in the same
+ * connection event.  This function returns at once; pCallback is
+ * called when all of the notifications have been sent or the stream
+ * has failed.  Only one stream may be ongoing per connection.
+ *
+ * @param connHandle          connection handle.
+ * @param[in] pChar           pointer to characteristic.
+ * @param[in] pData           the data to send; must remain valid until
+ *                            pCallback has been called.
+ * @param length              the number of bytes at pData.
+ * @param[in] pCallback       called when the stream ends, may be NULL.
+ * @param[in] pCallbackParam  passed to pCallback as its last parameter.
+ * @return                    zero if the stream was started, else negative
+ *                            error code; #U_ERROR_COMMON_BUSY if a stream
+ *                            is already ongoing on the connection.
+ */
+int32_t uPortGattNotifyStream(int32_t connHandle,
+                              const uPortGattCharacteristic_t *pChar,
+                              const void *pData, size_t length,
+                              uPortGattNotifyStreamCallback_t pCallback,
+                              void *pCallbackParam);
+
 /** Connect GAP.
  *
  * @param[in] pAddress    pointer to array with address (6 bytes).
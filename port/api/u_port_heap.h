@@ -42,6 +42,27 @@
  * they can be printed with uPortHeapDump().  Note that monitoring
  * will require at least 28 additional bytes of heap storage per
  * heap allocation.
+ *
+ * Defining U_CFG_HEAP_SLAB puts a fixed-block front-end in front of
+ * the default implementation: allocations of up to the largest of
+ * #U_PORT_HEAP_SLAB_BLOCK_SIZES bytes are served from pools of fixed
+ * size blocks, one pool per size class, which are allocated from the
+ * platform heap once, by uPortInit(), and never returned to it; only
+ * larger allocations, or those for which the pool of their size class
+ * is empty, go to the platform heap.  Since the many small, short-lived
+ * allocations then no longer break up the platform heap, the heap
+ * does not fragment over time.  The statistics of each size class,
+ * see uPortHeapSlabGetStatistics(), show how the pools should be
+ * dimensioned.
+ *
+ * Defining U_CFG_HEAP_PROFILE as well as U_CFG_HEAP_MONITOR adds
+ * a profile of the allocations made from each call site, i.e. each
+ * file/line that calls pUPortMalloc(): the number of allocations, the
+ * number of bytes allocated, the number of bytes currently allocated,
+ * the peak of that and a histogram of the sizes allocated.  This is
+ * printed, hottest call site first, by uPortHeapDump() and may be
+ * read with uPortHeapProfileGet(); it is intended to show where the
+ * frequent allocations are made so that they can be eliminated.
  */
 
 #ifdef __cplusplus
@@ -52,10 +73,73 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_PORT_HEAP_SLAB_BLOCK_SIZES
+/** The block size of each size class of the fixed-block front-end,
+ * only relevant if U_CFG_HEAP_SLAB is defined: a comma-separated
+ * list, in ascending order.  Note that, if U_CFG_HEAP_MONITOR is
+ * also defined, an allocation is larger by the monitoring overhead.
+ */
+# define U_PORT_HEAP_SLAB_BLOCK_SIZES 16, 32, 64, 128
+#endif
+
+#ifndef U_PORT_HEAP_SLAB_BLOCK_COUNTS
+/** The number of blocks in each size class of the fixed-block
+ * front-end, only relevant if U_CFG_HEAP_SLAB is defined: a
+ * comma-separated list with one entry for each entry in
+ * #U_PORT_HEAP_SLAB_BLOCK_SIZES.
+ */
+# define U_PORT_HEAP_SLAB_BLOCK_COUNTS 32, 32, 16, 16
+#endif
+
+#ifndef U_PORT_HEAP_PROFILE_MAX_NUM_SITES
+/** The maximum number of call sites that can be profiled, only
+ * relevant if U_CFG_HEAP_PROFILE is defined; allocations from call
+ * sites beyond this number are counted but not profiled.
+ */
+# define U_PORT_HEAP_PROFILE_MAX_NUM_SITES 64
+#endif
+
+#ifndef U_PORT_HEAP_PROFILE_NUM_SIZE_CLASSES
+/** The number of size classes in the histogram of a profiled call
+ * site, only relevant if U_CFG_HEAP_PROFILE is defined: size class
+ * x counts allocations of up to 16 << x bytes, except for the last,
+ * which counts all larger allocations.
+ */
+# define U_PORT_HEAP_PROFILE_NUM_SIZE_CLASSES 8
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The statistics of one size class of the fixed-block front-end,
+ * see uPortHeapSlabGetStatistics().
+ */
+typedef struct {
+    size_t blockSizeBytes;     /**< the block size of the size class. */
+    int32_t totalBlockCount;   /**< the number of blocks in the size class. */
+    int32_t usedBlockCount;    /**< the number of blocks currently in use. */
+    int32_t maxUsedBlockCount; /**< the largest number of blocks ever in use. */
+    int32_t fallbackCount;     /**< the number of allocations of this size
+                                    class that went to the platform heap
+                                    because all of the blocks were in use. */
+} uPortHeapSlabStatistics_t;
+
+/** The profile of one call site, see uPortHeapProfileGet().
+ */
+typedef struct {
+    const char *pFile;       /**< the file of the call site. */
+    int32_t line;            /**< the line of the call site in pFile. */
+    int32_t allocCount;      /**< the number of allocations made. */
+    int32_t allocBytes;      /**< the number of bytes allocated in total. */
+    int32_t liveBytes;       /**< the number of bytes currently allocated. */
+    int32_t peakLiveBytes;   /**< the largest value liveBytes has had. */
+    int32_t sizeClassCount[U_PORT_HEAP_PROFILE_NUM_SIZE_CLASSES]; /**< the
+                                  number of allocations made in each
+                                  size class, see
+                                  #U_PORT_HEAP_PROFILE_NUM_SIZE_CLASSES. */
+} uPortHeapProfileSite_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -145,16 +229,55 @@ void uPortHeapPerpetualAllocAdd();
 int32_t uPortHeapPerpetualAllocCount();
 
 /** Print out the contents of the heap; only useful if
- * U_CFG_HEAP_MONITOR is defined.
+ * U_CFG_HEAP_MONITOR is defined.  If U_CFG_HEAP_PROFILE is also
+ * defined the profile of each call site is printed afterwards,
+ * one line per call site, hottest first.
  *
  * @param[in] pPrefix  print this before each line; may be NULL.
  * @return             the number of entries printed.
  */
 int32_t uPortHeapDump(const char *pPrefix);
 
+/** Get the statistics of a size class of the fixed-block front-end;
+ * only useful if U_CFG_HEAP_SLAB is defined.
+ *
+ * @param sizeClass         the index of the size class, starting at zero
+ *                          for the first of #U_PORT_HEAP_SLAB_BLOCK_SIZES.
+ * @param[out] pStatistics  a place to put the statistics; cannot be NULL.
+ * @return                  zero on success, #U_ERROR_COMMON_INVALID_PARAMETER
+ *                          if there is no such size class or
+ *                          #U_ERROR_COMMON_NOT_SUPPORTED if U_CFG_HEAP_SLAB
+ *                          is not defined or uPortInit() has not been
+ *                          called.
+ */
+int32_t uPortHeapSlabGetStatistics(size_t sizeClass,
+                                   uPortHeapSlabStatistics_t *pStatistics);
+
+/** Get the profile of a call site; only useful if U_CFG_HEAP_PROFILE
+ * and U_CFG_HEAP_MONITOR are defined.  Call sites are added in the
+ * order in which they first allocate memory.
+ *
+ * @param index       the index of the call site, starting at zero.
+ * @param[out] pSite  a place to put the profile; cannot be NULL.
+ * @return            zero on success, #U_ERROR_COMMON_INVALID_PARAMETER
+ *                    if there is no such call site or
+ *                    #U_ERROR_COMMON_NOT_SUPPORTED if U_CFG_HEAP_PROFILE
+ *                    or U_CFG_HEAP_MONITOR is not defined.
+ */
+int32_t uPortHeapProfileGet(size_t index, uPortHeapProfileSite_t *pSite);
+
+/** Reset the profile of all call sites, e.g. after start-up so that
+ * only the allocations of what follows are counted; the number of
+ * bytes currently allocated by each call site is kept, and becomes
+ * its peak.  Only useful if U_CFG_HEAP_PROFILE and U_CFG_HEAP_MONITOR
+ * are defined.
+ */
+void uPortHeapProfileReset();
+
 /** Initialise heap monitoring: you do NOT need to call this, it
  * is called internally by the porting layer if U_CFG_HEAP_MONITOR
- * is defined.
+ * is defined; it also sets up the fixed-block front-end if
+ * U_CFG_HEAP_SLAB is defined.
  *
  * @param[in] pMutexCreate normally this will be NULL; it is only
  *                         provided for platforms where the
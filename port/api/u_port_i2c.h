@@ -60,6 +60,19 @@ extern "C" {
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The callback for the end of an asynchronous transaction, see
+ * uPortI2cControllerSendReceiveAsync().
+ *
+ * @param handle          the handle of the I2C instance.
+ * @param sizeOrErrorCode what uPortI2cControllerSendReceive() would
+ *                        have returned for the transaction.
+ * @param[in] pParam      the parameter that was passed to
+ *                        uPortI2cControllerSendReceiveAsync().
+ */
+typedef void (*uPortI2cCallback_t)(int32_t handle,
+                                   int32_t sizeOrErrorCode,
+                                   void *pParam);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -305,6 +318,70 @@ int32_t uPortI2cControllerSend(int32_t handle, uint16_t address,
                                const char *pSend, size_t bytesToSend,
                                bool noStop);
 
+/** Queue an I2C transaction, exactly as for
+ * uPortI2cControllerSendReceive(), without waiting for it to be
+ * carried out: pCallback is called once it has been.  Transactions
+ * on a given I2C instance are carried out in the order they were
+ * queued, so a bus shared by several callers is shared fairly and
+ * none of them is held up by another's transaction; this suits,
+ * for instance, polling a GNSS device while other devices on the
+ * same bus carry on.  If the queue for the instance is full this
+ * function will block until there is room.
+ *
+ * You do not need to implement this function: where it is not
+ * implemented a #U_WEAK implementation provided in
+ * u_port_bus_async.c will queue the transaction on an event queue
+ * of the given I2C instance, created on first use, and carry it
+ * out with uPortI2cControllerSendReceive(); a platform with a DMA
+ * or interrupt-driven I2C driver may do better.
+ *
+ * @param handle         the handle of the I2C instance.
+ * @param address        the I2C address, as for
+ *                       uPortI2cControllerSendReceive().
+ * @param[in] pSend      a pointer to the data to send, use NULL
+ *                       if only receive is required; it must remain
+ *                       valid until pCallback has been called.
+ * @param bytesToSend    the number of bytes to send, must be zero if
+ *                       pSend is NULL.
+ * @param[out] pReceive  a pointer to a buffer in which to store
+ *                       received data, use NULL if only send is
+ *                       required; it must remain valid until pCallback
+ *                       has been called.
+ * @param bytesToReceive the size of buffer pointed to by pReceive, must
+ *                       be zero if pReceive is NULL.
+ * @param[in] pCallback  the function to call when the transaction is
+ *                       done, cannot be NULL; it is called from a task
+ *                       of the port and must not call
+ *                       uPortI2cControllerAsyncStop().
+ * @param[in] pParam     passed to pCallback as its last parameter.
+ * @return               zero if the transaction has been queued, else
+ *                       negative error code, in which case pCallback
+ *                       will not be called.
+ */
+int32_t uPortI2cControllerSendReceiveAsync(int32_t handle, uint16_t address,
+                                           const char *pSend, size_t bytesToSend,
+                                           char *pReceive, size_t bytesToReceive,
+                                           uPortI2cCallback_t pCallback,
+                                           void *pParam);
+
+/** Stop asynchronous use of an I2C instance, waiting for any
+ * transactions queued by uPortI2cControllerSendReceiveAsync() to be
+ * carried out and freeing the resources that were used for them;
+ * this must be called before uPortI2cClose() if
+ * uPortI2cControllerSendReceiveAsync() has been used and must not
+ * be called at the same time as uPortI2cControllerSendReceiveAsync()
+ * on the same instance.  Does nothing if the instance is not in
+ * asynchronous use.
+ *
+ * You do not need to implement this function: where it is not
+ * implemented a #U_WEAK implementation is provided in
+ * u_port_bus_async.c.
+ *
+ * @param handle  the handle of the I2C instance.
+ * @return        zero on success else negative error code.
+ */
+int32_t uPortI2cControllerAsyncStop(int32_t handle);
+
 /** Get the number of I2C interfaces currently open; this may be used
  * as a basic check for heap monitoring.
  *
@@ -55,6 +55,13 @@ extern "C" {
  */
 #define U_PORT_EXECUTABLE_CHUNK_NO_FLAGS      0
 
+#ifndef U_PORT_TASK_STATS_NAME_LENGTH_BYTES
+/** The number of bytes of storage for the name of a task in
+ * #uPortTaskStats_t, including room for a null terminator.
+ */
+# define U_PORT_TASK_STATS_NAME_LENGTH_BYTES 16
+#endif
+
 #ifndef U_PORT_OS_DEBUG_PRINT_PREFIX
 /** The string to prefix all debug prints from this file with:
  * only used if U_PORT_OS_DEBUG_PRINT is defined.  Defining
@@ -211,6 +218,42 @@ typedef enum {
     U_PORT_OS_RESOURCE_TYPE_TIMER
 } uPortOsResourceType_t;
 
+/** Statistics for a task, as returned by uPortTaskStatsGet().
+ * Where a platform is unable to provide a value it is set to -1.
+ */
+typedef struct {
+    uPortTaskHandle_t taskHandle; /**< the handle of the task, NULL
+                                       where it cannot be determined
+                                       (e.g. on Linux). */
+    char name[U_PORT_TASK_STATS_NAME_LENGTH_BYTES]; /**< the name of
+                                                         the task, null
+                                                         terminated,
+                                                         truncated if
+                                                         required. */
+    int64_t runTime;              /**< the CPU time the task has used:
+                                       in microseconds on Linux, Zephyr
+                                       and ESP-IDF (the default ESP-IDF
+                                       run-time stats clock), otherwise
+                                       in the units of the FreeRTOS
+                                       portGET_RUN_TIME_COUNTER_VALUE();
+                                       since the total is returned in
+                                       the same units the share of CPU
+                                       time is always meaningful.
+                                       Requires
+                                       configGENERATE_RUN_TIME_STATS
+                                       on FreeRTOS platforms and
+                                       CONFIG_SCHED_THREAD_USAGE on
+                                       Zephyr. */
+    int64_t contextSwitches;      /**< the number of times the task
+                                       has been switched out; only
+                                       available on Linux. */
+    int32_t stackMinFreeBytes;    /**< the minimum amount of stack free
+                                       for the lifetime of the task, as
+                                       uPortTaskStackMinFree(); requires
+                                       CONFIG_THREAD_STACK_INFO on
+                                       Zephyr, not possible on Linux. */
+} uPortTaskStats_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: TASKS
  * -------------------------------------------------------------- */
@@ -309,6 +352,35 @@ int32_t uPortTaskStackMinFree(const uPortTaskHandle_t taskHandle);
  */
 int32_t uPortTaskGetHandle(uPortTaskHandle_t *pTaskHandle);
 
+/** Get the statistics of all of the tasks in the system (or, on
+ * Linux, all of the threads of this process), not just those
+ * created by ubxlib, so that it can be seen which task is using
+ * the CPU or is short of stack.  This may take some time if there
+ * are many tasks and should not be called often.
+ * It is NOT a requirement that this API is implemented:
+ * where it is not implemented #U_ERROR_COMMON_NOT_IMPLEMENTED
+ * should be returned.  FreeRTOS platforms require
+ * configUSE_TRACE_FACILITY for this function.
+ *
+ * @param[out] pStats           a pointer to an array of numStats
+ *                              structures in which to store the
+ *                              statistics; may be NULL, in which
+ *                              case numStats must be zero and the
+ *                              number of tasks is returned.
+ * @param numStats              the number of entries at pStats.
+ * @param[out] pTotalRunTime    a place to put the total CPU time
+ *                              used by all tasks since start-up,
+ *                              in the same units as the runTime
+ *                              field of #uPortTaskStats_t, -1 if
+ *                              not known; may be NULL.
+ * @return                      on success the number of entries
+ *                              written to pStats, or the number of
+ *                              tasks if pStats is NULL, else
+ *                              negative error code.
+ */
+int32_t uPortTaskStatsGet(uPortTaskStats_t *pStats, size_t numStats,
+                          int64_t *pTotalRunTime);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: QUEUES
  * -------------------------------------------------------------- */
@@ -39,7 +39,8 @@
  * SPI devices then it may be worth expanding the testing also.
  *
  * Note also that the interface is blocking, 'cos that's all we
- * [currently] need.
+ * [currently] need, with the exception of
+ * uPortSpiControllerSendReceiveBlockAsync().
  */
 
 #ifdef __cplusplus
@@ -54,6 +55,19 @@ extern "C" {
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The callback for the end of an asynchronous transaction, see
+ * uPortSpiControllerSendReceiveBlockAsync().
+ *
+ * @param handle          the handle of the SPI instance.
+ * @param sizeOrErrorCode what uPortSpiControllerSendReceiveBlock()
+ *                        would have returned for the transaction.
+ * @param[in] pParam      the parameter that was passed to
+ *                        uPortSpiControllerSendReceiveBlockAsync().
+ */
+typedef void (*uPortSpiCallback_t)(int32_t handle,
+                                   int32_t sizeOrErrorCode,
+                                   void *pParam);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -209,6 +223,65 @@ int32_t uPortSpiControllerSendReceiveBlock(int32_t handle, const char *pSend,
                                            size_t bytesToSend, char *pReceive,
                                            size_t bytesToReceive);
 
+/** Queue an exchange of a block of data with an SPI device, exactly
+ * as for uPortSpiControllerSendReceiveBlock(), without waiting for it
+ * to be carried out: pCallback is called once it has been.
+ * Transactions on a given SPI instance are carried out in the order
+ * they were queued.  If the queue for the instance is full this
+ * function will block until there is room.
+ *
+ * You do not need to implement this function: where it is not
+ * implemented a #U_WEAK implementation provided in
+ * u_port_bus_async.c will queue the transaction on an event queue
+ * of the given SPI instance, created on first use, and carry it
+ * out with uPortSpiControllerSendReceiveBlock(); a platform with a
+ * DMA-driven SPI driver may do better.
+ *
+ * @param handle         the handle of the SPI instance.
+ * @param[in] pSend      a pointer to the block of data to send; may be
+ *                       NULL; it must remain valid until pCallback has
+ *                       been called.
+ * @param bytesToSend    the amount of data at pSend in BYTES (not words).
+ * @param[out] pReceive  a pointer to a place to put the received data;
+ *                       may be NULL; it must remain valid until pCallback
+ *                       has been called.
+ * @param bytesToReceive the amount of storage at pReceive in BYTES (not
+ *                       words).
+ * @param[in] pCallback  the function to call when the transaction is
+ *                       done, cannot be NULL; it is called from a task
+ *                       of the port and must not call
+ *                       uPortSpiControllerAsyncStop().
+ * @param[in] pParam     passed to pCallback as its last parameter.
+ * @return               zero if the transaction has been queued, else
+ *                       negative error code, in which case pCallback
+ *                       will not be called.
+ */
+int32_t uPortSpiControllerSendReceiveBlockAsync(int32_t handle,
+                                                const char *pSend,
+                                                size_t bytesToSend,
+                                                char *pReceive,
+                                                size_t bytesToReceive,
+                                                uPortSpiCallback_t pCallback,
+                                                void *pParam);
+
+/** Stop asynchronous use of an SPI instance, waiting for any
+ * transactions queued by uPortSpiControllerSendReceiveBlockAsync()
+ * to be carried out and freeing the resources that were used for
+ * them; this must be called before uPortSpiClose() if
+ * uPortSpiControllerSendReceiveBlockAsync() has been used and must
+ * not be called at the same time as
+ * uPortSpiControllerSendReceiveBlockAsync() on the same instance.
+ * Does nothing if the instance is not in asynchronous use.
+ *
+ * You do not need to implement this function: where it is not
+ * implemented a #U_WEAK implementation is provided in
+ * u_port_bus_async.c.
+ *
+ * @param handle  the handle of the SPI instance.
+ * @return        zero on success else negative error code.
+ */
+int32_t uPortSpiControllerAsyncStop(int32_t handle);
+
 /** Get the number of SPI interfaces currently open; this may be used
  * as a basic check for heap monitoring.
  *
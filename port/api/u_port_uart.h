@@ -89,6 +89,19 @@ extern "C" {
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The callback for the end of an asynchronous write, see
+ * uPortUartWriteAsync().
+ *
+ * @param handle          the handle of the UART instance.
+ * @param sizeOrErrorCode the number of bytes sent, else negative
+ *                        error code.
+ * @param[in] pParam      the parameter that was passed to
+ *                        uPortUartWriteAsync().
+ */
+typedef void (*uPortUartWriteCallback_t)(int32_t handle,
+                                         int32_t sizeOrErrorCode,
+                                         void *pParam);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -249,6 +262,35 @@ int32_t uPortUartRead(int32_t handle, void *pBuffer,
 int32_t uPortUartWrite(int32_t handle, const void *pBuffer,
                        size_t sizeBytes);
 
+/** Write to the given UART interface without waiting for the data
+ * to be sent: pCallback is called once it has been, so that the
+ * caller can get on with, for instance, preparing what it will send
+ * next.  Only one asynchronous write may be outstanding per UART;
+ * uPortUartWrite() should not be called while one is.
+ *
+ * You do not need to implement this function: where it is not
+ * implemented a #U_WEAK implementation provided in u_port_uart_async.c
+ * will call uPortUartWrite() and then pCallback before it returns.
+ *
+ * @param handle         the handle of the UART instance.
+ * @param[in] pBuffer    a pointer to a buffer of data to send; it must
+ *                       remain valid until pCallback has been called.
+ * @param sizeBytes      the number of bytes in pBuffer.
+ * @param[in] pCallback  the function to call when the write is done,
+ *                       cannot be NULL; it may be called from a task
+ *                       of the port or, if the write completes at
+ *                       once, before this function returns.
+ * @param[in] pParam     passed to pCallback as its last parameter.
+ * @return               zero if the write has been started, else
+ *                       negative error code, in which case pCallback
+ *                       will not be called; #U_ERROR_COMMON_BUSY if
+ *                       an asynchronous write is already outstanding.
+ */
+int32_t uPortUartWriteAsync(int32_t handle, const void *pBuffer,
+                            size_t sizeBytes,
+                            uPortUartWriteCallback_t pCallback,
+                            void *pParam);
+
 /** Set a callback to be called when a UART event occurs.
  * pFunction will be called asynchronously in its own task,
  * for which the stack size and priority can be specified.
@@ -443,6 +485,21 @@ int32_t uPortUartCtsSuspend(int32_t handle);
  */
 void uPortUartCtsResume(int32_t handle);
 
+/** Change the baud rate of a UART that is already open, e.g. once
+ * the device at the other end has been told to switch to a higher
+ * rate; any data still waiting to be transmitted is sent at the
+ * old rate first and the receive buffer is left alone.
+ *
+ * You do not need to implement this function: where it is not
+ * implemented a #U_WEAK implementation provided in
+ * u_port_uart_async.c will return #U_ERROR_COMMON_NOT_SUPPORTED.
+ *
+ * @param handle   the handle of the UART instance.
+ * @param baudRate the new baud rate.
+ * @return         zero on success else negative error code.
+ */
+int32_t uPortUartSetBaudRate(int32_t handle, int32_t baudRate);
+
 /** Get the number of UART interfaces currently open; this may be
  * used as a basic check for heap monitoring.
  *
@@ -21,7 +21,6 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
-#include "string.h"    // memset()
 #include "time.h"      // struct tm
 
 #include "u_time.h"
@@ -37,40 +36,9 @@
 struct tm *gmtime_r(const time_t *pTime, struct tm *pBuf)
 {
     struct tm *pTm = NULL;
-    int64_t time;
-    int32_t months;
-    int32_t years;
 
-    if ((pTime != NULL) && (pBuf != NULL) && (*pTime >= 0)) {
-        time = (int64_t) * pTime;
-        memset(pBuf, 0, sizeof(*pBuf));
-        // Work out the number of months since 1970
-        months = uTimeSecondsToMonthsUtc(time);
-        // From that, the number of years
-        years = months / 12;
-        // Years since 1900 for struct tm
-        pBuf->tm_year = years + 70;
-        // Months since January (0 to 11)
-        pBuf->tm_mon = months - (years * 12);
-        // Days in the year (0 to 365)
-        pBuf->tm_yday = (int32_t) ((time - uTimeMonthsToSecondsUtc(years * 12)) / (3600 * 24));
-        // Day of the week, from Sunday (0 to 6); the 1/1/1970 was a Wednesday (4)
-        pBuf->tm_wday = (4 + (time / (3600 * 24))) % 7;
-        time -= uTimeMonthsToSecondsUtc(months);
-        // Day of the month (1 to 31)
-        pBuf->tm_mday = (int32_t) (time / (3600 * 24));
-        time -= pBuf->tm_mday * 3600 * 24;
-        pBuf->tm_mday++;
-        // Hours (0 to 23)
-        pBuf->tm_hour = (int32_t)  (time / 3600);
-        time -= pBuf->tm_hour * 3600;
-        // Minutes (0 to 59)
-        pBuf->tm_min = (int32_t) (time / 60);
-        time -= pBuf->tm_min * 60;
-        // Seconds (0 to 59ish)
-        pBuf->tm_sec = (int32_t) time;
-        // Since this function returns UTC, the
-        // Daylight Saving Time flag is left unset.
+    if ((pTime != NULL) && (*pTime >= 0) &&
+        (uTimeSecondsToTmUtc((int64_t) * pTime, pBuf) == 0)) {
         pTm = pBuf;
     }
 
@@ -159,6 +159,16 @@ int32_t uPortTaskGetHandle(uPortTaskHandle_t *pTaskHandle)
     return errorCode;
 }
 
+// Get the statistics of all tasks.
+int32_t uPortTaskStatsGet(uPortTaskStats_t *pStats, size_t numStats,
+                          int64_t *pTotalRunTime)
+{
+    (void) pStats;
+    (void) numStats;
+    (void) pTotalRunTime;
+    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: QUEUES
  * -------------------------------------------------------------- */
@@ -41,7 +41,11 @@
 
 /** A macro to check that the respective event has arrived or not.
  */
-#define U_PORT_UART_EVENT_CHECK(evenBitmap, event) ((evenBitmap) & (1 << event -1))
+#define U_PORT_UART_EVENT_CHECK(evenBitmap, event) ((evenBitmap) & U_PORT_UART_EVENT_BIT(event))
+
+/** The bit in gModemUartEventBitmap that represents an event.
+ */
+#define U_PORT_UART_EVENT_BIT(event) (1UL << ((event) - 1))
 
 /** Size of UART read buffer. Data more than this size will not be
  * dropped or trimmed instead it will be available on next read call,
@@ -119,17 +123,13 @@ static uint32_t gModemUartReceiveBytes = 0;
  */
 static int32_t gModemUartWriteBytes = 0;
 
-/** Handle to timer. Modem UART interface is asynchronous and
- * we wait for event in while loop. The purpose of Timer is to
- * avoid the halt condition or exit the loop, when modem is stucked,
- * or modem takes time more than usual. The default timeout defined
- * is U_PORT_UART_TIMEOUT_MS.
- */
-static uPortTimerHandle_t gModemUartTimerHandle = NULL;
-
-/** Flag of timer expiration.
+/** Semaphore given by modemUartEventCallback() on every event. The
+ * modem UART interface is asynchronous: rather than polling for the
+ * event that completes an operation, waitEvent() blocks on this, so
+ * that it wakes as soon as the event arrives, or after
+ * U_PORT_UART_TIMEOUT_MS if the modem is stuck.
  */
-static bool gModemUartTimerTimeout = false;
+static uPortSemaphoreHandle_t gModemUartEventSemaphore = NULL;
 
 /** Handle to UART context.
  */
@@ -163,7 +163,7 @@ static void modemUartEventCallback(uint32_t eventType, uint32_t eventData,
                                    void *pParam)
 {
     // Set event bitmap
-    gModemUartEventBitmap |= (1 << eventType - 1);
+    gModemUartEventBitmap |= U_PORT_UART_EVENT_BIT(eventType);
 
     switch (eventType) {
         case UCPU_MODEM_UART_EVENT_READ_IND: {
@@ -187,12 +187,29 @@ static void modemUartEventCallback(uint32_t eventType, uint32_t eventData,
             break;
         }
     }
+
+    if (gModemUartEventSemaphore != NULL) {
+        // Wake up whoever is waiting
+        uPortSemaphoreGive(gModemUartEventSemaphore);
+    }
 }
 
-// UART timer callback.
-static void modemUartTimerCallback(uPortTimerHandle_t timerHandle, void *pParameter)
+// Wait for any of the events in eventMask, a bitmap as for
+// gModemUartEventBitmap, to arrive, for at most U_PORT_UART_TIMEOUT_MS;
+// returns true if one of them did.
+static bool waitEvent(uint32_t eventMask)
 {
-    gModemUartTimerTimeout = true;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+    int32_t timeLeftMs = U_PORT_UART_TIMEOUT_MS;
+
+    while (((gModemUartEventBitmap & eventMask) == 0) && (timeLeftMs > 0)) {
+        // The semaphore may have been given by an earlier event,
+        // hence the loop
+        uPortSemaphoreTryTake(gModemUartEventSemaphore, timeLeftMs);
+        timeLeftMs = U_PORT_UART_TIMEOUT_MS - (uPortGetTickTimeMs() - startTimeMs);
+    }
+
+    return (gModemUartEventBitmap & eventMask) != 0;
 }
 
 /* ----------------------------------------------------------------
@@ -217,13 +234,13 @@ int32_t uPortUartInit()
         // Create mutex to protect UART interface
         errorCode = uPortMutexCreate(&gModemUartMutex);
         if (errorCode == U_ERROR_COMMON_SUCCESS) {
-            // Create timer
-            errorCode = uPortTimerCreate(&gModemUartTimerHandle,
-                                         "Uart Timer", modemUartTimerCallback,
-                                         NULL, U_PORT_UART_TIMEOUT_MS, false);
+            // Create the semaphore that is given on events
+            errorCode = uPortSemaphoreCreate(&gModemUartEventSemaphore, 0, 1);
             if (errorCode < 0) {
-                uPortLog("uPortUartInit() Error creating timer.\n");
+                uPortLog("uPortUartInit() Error creating semaphore.\n");
                 (void)uPortMutexDelete(gModemUartMutex);
+                gModemUartMutex = NULL;
+                gModemUartEventSemaphore = NULL;
             }
         } else {
             // Error creating mutex
@@ -243,7 +260,6 @@ void uPortUartDeinit()
         gModemUartContext.markedForDeletion = true;
         gModemUartContext.pEventCallback = NULL;
         gModemUartContext.pEventCallbackParam = NULL;
-        uPortTimerDelete(gModemUartTimerHandle);
         // Release the mutex so that deletion can occur
         U_PORT_MUTEX_UNLOCK(gModemUartMutex);
 
@@ -252,7 +268,8 @@ void uPortUartDeinit()
         U_PORT_MUTEX_UNLOCK(gModemUartMutex);
         uPortMutexDelete(gModemUartMutex);
         gModemUartMutex = NULL;
-        gModemUartTimerHandle = NULL;
+        uPortSemaphoreDelete(gModemUartEventSemaphore);
+        gModemUartEventSemaphore = NULL;
     }
 }
 
@@ -294,95 +311,53 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
             if (gModemUartContext.uartHandle > 0) {
                 // Reset event bitmap
                 gModemUartEventBitmap = 0;
-                gModemUartTimerTimeout = false;
 
                 // Set event callback
                 errorCode = ucpu_sdk_modem_uart_set_callback(gModemUartContext.uartHandle,
                                                              modemUartEventCallback,
                                                              NULL);
                 if (errorCode == U_ERROR_COMMON_SUCCESS) {
-                    // Start timer
-                    errorCode = uPortTimerStart(gModemUartTimerHandle);
-                    if (errorCode == U_ERROR_COMMON_SUCCESS) {
-                        // Wait for UCPU_MODEM_UART_EVENT_ATTACH_CNF/UCPU_MODEM_UART_EVENT_OPEN_FAILURE or timeout
-                        while (1) {
-                            if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_ATTACH_CNF) ||
-                                U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_OPEN_FAILURE) ||
-                                gModemUartTimerTimeout) {
-                                break;
-                            }
-                            uPortTaskBlock(100);
-                        }
-                        // Stop timer
-                        errorCode == uPortTimerStop(gModemUartTimerHandle);
+                    // Wait for UCPU_MODEM_UART_EVENT_ATTACH_CNF/UCPU_MODEM_UART_EVENT_OPEN_FAILURE or timeout
+                    waitEvent(U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_ATTACH_CNF) |
+                              U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_OPEN_FAILURE));
+                    if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_ATTACH_CNF)) {
+                        // Reset event bitmap
+                        gModemUartEventBitmap = 0;
+
+                        // Place read call to UART interface
+                        errorCode = ucpu_sdk_modem_uart_read(gModemUartContext.uartHandle,
+                                                             gModemUartReadBuffer,
+                                                             U_PORT_UART_READ_BUFFER_SIZE);
                         if (errorCode == U_ERROR_COMMON_SUCCESS) {
-                            if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_ATTACH_CNF)) {
-                                // Reset event bitmap
-                                gModemUartEventBitmap = 0;
-                                gModemUartTimerTimeout = false;
-
-                                // Place read call to UART interface
-                                errorCode = ucpu_sdk_modem_uart_read(gModemUartContext.uartHandle,
-                                                                     gModemUartReadBuffer,
-                                                                     U_PORT_UART_READ_BUFFER_SIZE);
-                                if (errorCode == U_ERROR_COMMON_SUCCESS) {
-                                    // Start timer
-                                    errorCode = uPortTimerStart(gModemUartTimerHandle);
-                                    if (errorCode == U_ERROR_COMMON_SUCCESS) {
-                                        // Wait for UCPU_MODEM_UART_EVENT_EWOULD_BLOCK/UCPU_MODEM_UART_EVENT_READ_FAILURE/UCPU_MODEM_UART_EVENT_FAILURE or timeout
-                                        while (1) {
-                                            if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_EWOULD_BLOCK) ||
-                                                U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_READ_FAILURE) ||
-                                                U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE) ||
-                                                gModemUartTimerTimeout) {
-                                                break;
-                                            }
-                                            uPortTaskBlock(100);
-                                        }
-                                        // Stop timer
-                                        errorCode == uPortTimerStop(gModemUartTimerHandle);
-                                        if (errorCode == U_ERROR_COMMON_SUCCESS) {
-                                            if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_EWOULD_BLOCK)) {
-                                                gModemUartReadBufferPlaced = true;
-                                                handleOrErrorCode = gModemUartContext.uartHandle;
-                                            } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_READ_FAILURE) ||
-                                                       U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE)) {
-                                                // Error reading from UART interface
-                                                handleOrErrorCode = U_ERROR_COMMON_PLATFORM;
-                                                uPortLog("uPortUartOpen() Faild to read from UART interface.\n");
-                                            } else {
-                                                // Timeout reading from UART interface
-                                                handleOrErrorCode = U_ERROR_COMMON_TIMEOUT;
-                                                uPortLog("uPortUartOpen() Timeout reading from UART interface.\n");
-                                            }
-                                        } else {
-                                            // Error stoping timer
-                                            uPortLog("uPortUartOpen() Failed to stop timer.\n");
-                                        }
-                                    } else {
-                                        // Error starting timer
-                                        uPortLog("uPortUartOpen() Failed to start timer.\n");
-                                    }
-                                } else {
-                                    // Error reading from UART interface
-                                    uPortLog("uPortUartOpen() Error reading from UART interface.\n");
-                                }
-                            } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_OPEN_FAILURE)) {
-                                // Failed to open UART interface
+                            // Wait for UCPU_MODEM_UART_EVENT_EWOULD_BLOCK/UCPU_MODEM_UART_EVENT_READ_FAILURE/UCPU_MODEM_UART_EVENT_FAILURE or timeout
+                            waitEvent(U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_EWOULD_BLOCK) |
+                                      U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_READ_FAILURE) |
+                                      U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_FAILURE));
+                            if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_EWOULD_BLOCK)) {
+                                gModemUartReadBufferPlaced = true;
+                                handleOrErrorCode = gModemUartContext.uartHandle;
+                            } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_READ_FAILURE) ||
+                                       U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE)) {
+                                // Error reading from UART interface
                                 handleOrErrorCode = U_ERROR_COMMON_PLATFORM;
-                                uPortLog("uPortUartOpen() Failed to open UART interface.\n");
+                                uPortLog("uPortUartOpen() Faild to read from UART interface.\n");
                             } else {
-                                // Timeout opening UART interface
+                                // Timeout reading from UART interface
                                 handleOrErrorCode = U_ERROR_COMMON_TIMEOUT;
-                                uPortLog("uPortUartOpen() Timeout opening UART interface.\n");
+                                uPortLog("uPortUartOpen() Timeout reading from UART interface.\n");
                             }
                         } else {
-                            // Error stoping timer
-                            uPortLog("uPortUartOpen() Failed to stop timer.\n");
+                            // Error reading from UART interface
+                            uPortLog("uPortUartOpen() Error reading from UART interface.\n");
                         }
+                    } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_OPEN_FAILURE)) {
+                        // Failed to open UART interface
+                        handleOrErrorCode = U_ERROR_COMMON_PLATFORM;
+                        uPortLog("uPortUartOpen() Failed to open UART interface.\n");
                     } else {
-                        // Error starting timer
-                        uPortLog("uPortUartOpen() Failed to start timer.\n");
+                        // Timeout opening UART interface
+                        handleOrErrorCode = U_ERROR_COMMON_TIMEOUT;
+                        uPortLog("uPortUartOpen() Timeout opening UART interface.\n");
                     }
                 } else {
                     // Error setting platform callback
@@ -419,36 +394,15 @@ void uPortUartClose(int32_t handle)
         gModemUartContext.pEventCallbackParam = NULL;
         // Reset event bitmap
         gModemUartEventBitmap = 0;
-        gModemUartTimerTimeout = false;
 
         ucpu_sdk_modem_uart_close(handle);
 
-        // Start timer
-        errorCode = uPortTimerStart(gModemUartTimerHandle);
-        if (errorCode == U_ERROR_COMMON_SUCCESS) {
-            // Wait for UCPU_MODEM_UART_EVENT_DETACH_CNF/UCPU_MODEM_UART_EVENT_FAILURE or timeout
-            while (1) {
-                if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_DETACH_CNF) ||
-                    U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE) ||
-                    gModemUartTimerTimeout) {
-                    break;
-                }
-                uPortTaskBlock(100);
-            }
-            // Stop timer
-            errorCode == uPortTimerStop(gModemUartTimerHandle);
-            if (errorCode == U_ERROR_COMMON_SUCCESS) {
-                if (!U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_DETACH_CNF)) {
-                    // Error closing modem UART interface
-                    uPortLog("uPortUartClose() Error closing UART interface.\n");
-                }
-            } else {
-                // Error stoping timer
-                uPortLog("uPortUartClose() Failed to stop timer.\n");
-            }
-        } else {
-            // Error starting timer
-            uPortLog("uPortUartClose() Failed to start timer.\n");
+        // Wait for UCPU_MODEM_UART_EVENT_DETACH_CNF/UCPU_MODEM_UART_EVENT_FAILURE or timeout
+        waitEvent(U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_DETACH_CNF) |
+                  U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_FAILURE));
+        if (!U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_DETACH_CNF)) {
+            // Error closing modem UART interface
+            uPortLog("uPortUartClose() Error closing UART interface.\n");
         }
 
         U_PORT_MUTEX_UNLOCK(gModemUartMutex);
@@ -503,12 +457,11 @@ int32_t uPortUartRead(int32_t handle, void *pBuffer,
             }
 
             if ((gModemUartReceiveBytes == 0) && (gModemUartReadBufferPlaced == false)) {
-                // Reset the UART read buffer
-                memset(gModemUartReadBuffer, 0, U_PORT_UART_READ_BUFFER_SIZE);
+                // Re-use the UART read buffer: no need to clear it,
+                // only what the modem reports it wrote is ever read
                 gpModemUartReadBuffer = gModemUartReadBuffer;
                 // Reset event bitmap
                 gModemUartEventBitmap = 0;
-                gModemUartTimerTimeout = false;
                 gModemUartReadBufferPlaced = true;
 
                 // Read from modem UART interface. It is non-blocking call.
@@ -518,42 +471,22 @@ int32_t uPortUartRead(int32_t handle, void *pBuffer,
                                                            gModemUartReadBuffer,
                                                            U_PORT_UART_READ_BUFFER_SIZE);
                 if (errorCodeOrSize == U_ERROR_COMMON_SUCCESS) {
-                    // Start timer
-                    errorCodeOrSize = uPortTimerStart(gModemUartTimerHandle);
-                    if (errorCodeOrSize == U_ERROR_COMMON_SUCCESS) {
-                        // Wait for UCPU_MODEM_UART_EVENT_EWOULD_BLOCK/UCPU_MODEM_UART_EVENT_READ_IND/UCPU_MODEM_UART_EVENT_FAILURE or timeout
-                        while (1) {
-                            if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_EWOULD_BLOCK) ||
-                                U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_READ_FAILURE) ||
-                                U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE) ||
-                                gModemUartTimerTimeout) {
-                                break;
-                            }
-                            uPortTaskBlock(100);
-                        }
-                        // Stop timer
-                        errorCodeOrSize == uPortTimerStop(gModemUartTimerHandle);
-                        if (errorCodeOrSize == U_ERROR_COMMON_SUCCESS) {
-                            if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_EWOULD_BLOCK)) {
-                                // Number of bytes read from UART interface
-                                errorCodeOrSize = thisSize;
-                            } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_READ_FAILURE) ||
-                                       U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE)) {
-                                // Error reading from UART interface
-                                errorCodeOrSize = U_ERROR_COMMON_PLATFORM;
-                                uPortLog("uPortUartRead() Faild to read from UART interface.\n");
-                            } else {
-                                // Timeout reading from UART interface
-                                errorCodeOrSize = U_ERROR_COMMON_TIMEOUT;
-                                uPortLog("uPortUartRead() Timeout reading from UART interface.\n");
-                            }
-                        } else {
-                            // Error stoping timer
-                            uPortLog("uPortUartRead() Failed to stop timer.\n");
-                        }
+                    // Wait for UCPU_MODEM_UART_EVENT_EWOULD_BLOCK/UCPU_MODEM_UART_EVENT_READ_IND/UCPU_MODEM_UART_EVENT_FAILURE or timeout
+                    waitEvent(U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_EWOULD_BLOCK) |
+                              U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_READ_FAILURE) |
+                              U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_FAILURE));
+                    if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_EWOULD_BLOCK)) {
+                        // Number of bytes read from UART interface
+                        errorCodeOrSize = thisSize;
+                    } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_READ_FAILURE) ||
+                               U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE)) {
+                        // Error reading from UART interface
+                        errorCodeOrSize = U_ERROR_COMMON_PLATFORM;
+                        uPortLog("uPortUartRead() Faild to read from UART interface.\n");
                     } else {
-                        // Error starting timer
-                        uPortLog("uPortUartRead() Failed to start timer.\n");
+                        // Timeout reading from UART interface
+                        errorCodeOrSize = U_ERROR_COMMON_TIMEOUT;
+                        uPortLog("uPortUartRead() Timeout reading from UART interface.\n");
                     }
                 }
             }
@@ -585,7 +518,6 @@ int32_t uPortUartWrite(int32_t handle,
             gModemUartWriteBytes = 0;
             // Reset event bitmap
             gModemUartEventBitmap = 0;
-            gModemUartTimerTimeout = false;
 
             // Write to the modem UART interface. It is non-blocking call.
             // When data is written to UART interface it will be notified
@@ -594,40 +526,20 @@ int32_t uPortUartWrite(int32_t handle,
                                                         (void *) pBuffer,
                                                         sizeBytes);
             if (errorCodeOrSize == U_ERROR_COMMON_SUCCESS) {
-                // Start timer
-                errorCodeOrSize = uPortTimerStart(gModemUartTimerHandle);
-                if (errorCodeOrSize == U_ERROR_COMMON_SUCCESS) {
-                    // Wait for UCPU_MODEM_UART_EVENT_WRITE_IND/UCPU_MODEM_UART_EVENT_FAILURE or timeout
-                    while (1) {
-                        if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_WRITE_IND) ||
-                            U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE) ||
-                            gModemUartTimerTimeout) {
-                            break;
-                        }
-                        uPortTaskBlock(100);
-                    }
-                    // Stop timer
-                    errorCodeOrSize == uPortTimerStop(gModemUartTimerHandle);
-                    if (errorCodeOrSize == U_ERROR_COMMON_SUCCESS) {
-                        if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_WRITE_IND)) {
-                            // Number of bytes written to UART interface
-                            errorCodeOrSize = gModemUartWriteBytes;
-                        } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE)) {
-                            // Error reading from UART interface
-                            errorCodeOrSize = U_ERROR_COMMON_PLATFORM;
-                            uPortLog("uPortUartWrite() Faild to write to UART interface.\n");
-                        } else {
-                            // Timeout reading from UART interface
-                            errorCodeOrSize = U_ERROR_COMMON_TIMEOUT;
-                            uPortLog("uPortUartWrite() Timeout writing to UART interface.\n");
-                        }
-                    } else {
-                        // Error stoping timer
-                        uPortLog("uPortUartWrite() Failed to stop timer.\n");
-                    }
+                // Wait for UCPU_MODEM_UART_EVENT_WRITE_IND/UCPU_MODEM_UART_EVENT_FAILURE or timeout
+                waitEvent(U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_WRITE_IND) |
+                          U_PORT_UART_EVENT_BIT(UCPU_MODEM_UART_EVENT_FAILURE));
+                if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_WRITE_IND)) {
+                    // Number of bytes written to UART interface
+                    errorCodeOrSize = gModemUartWriteBytes;
+                } else if (U_PORT_UART_EVENT_CHECK(gModemUartEventBitmap, UCPU_MODEM_UART_EVENT_FAILURE)) {
+                    // Error reading from UART interface
+                    errorCodeOrSize = U_ERROR_COMMON_PLATFORM;
+                    uPortLog("uPortUartWrite() Faild to write to UART interface.\n");
                 } else {
-                    // Error starting timer
-                    uPortLog("uPortUartWrite() Failed to start timer.\n");
+                    // Timeout reading from UART interface
+                    errorCodeOrSize = U_ERROR_COMMON_TIMEOUT;
+                    uPortLog("uPortUartWrite() Timeout writing to UART interface.\n");
                 }
             } else {
                 // Error writing to UART interface
@@ -24,6 +24,30 @@
  * protection) but, most importantly, means that no loop is required
  * to find a queue, ensuring the lowest possible latency so that
  * send-to-queue can safely be called from an interrupt.
+ *
+ * Each event queue has two OS queues: the normal one, on which the
+ * control/size word of each entry also carries the coalescing key
+ * of the event, if any, and a short high priority one.  The event
+ * task always empties the high priority queue before taking the next
+ * entry off the normal queue; since it can only block on one OS queue,
+ * a high priority event is followed by a "doorbell" entry on the
+ * normal queue to wake the task up.
+ *
+ * An event queue opened with uPortEventQueueOpenShared() has no task
+ * of its own: it is serviced by a pool of worker tasks which wait on
+ * a single "ready" OS queue.  An event sent to an idle shared event
+ * queue is followed by a token, the handle of the event queue, on the
+ * ready queue; gSharedState[] then ensures that there is at most one
+ * token per event queue handle, an event sent while the event queue
+ * is scheduled or running needing no token of its own.  A worker that
+ * receives a token takes the taskRunningMutex of that event queue and
+ * deals with everything waiting on it, running again if more events
+ * arrived while it was busy, so the events of a given event queue are
+ * always handled one at a time and in order, whichever worker handles
+ * them.  Since there is only ever one token, no worker waits for
+ * another, the other shared event queues are not held up by a long
+ * callback and the ready queue can never fill up, so an event
+ * callback is free to send to any event queue.
  */
 
 #ifdef U_CFG_OVERRIDE
@@ -39,6 +63,7 @@
 #include "u_assert.h"
 #include "u_port_os.h"
 #include "u_port_heap.h"
+#include "u_port_atomic.h"
 
 #include "u_port_event_queue_private.h"
 #include "u_port_event_queue.h"
@@ -52,10 +77,48 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** The bits of a positive control/size word that are the size
+ * of the parameter block.
+ */
+#define U_EVENT_SIZE_MASK 0xFFFF
+
+/** The shift to apply to the coalescing key plus one in a
+ * positive control/size word; zero means no coalescing key.
+ */
+#define U_EVENT_COALESCE_KEY_SHIFT 16
+
+#if U_PORT_EVENT_QUEUE_MAX_PARAM_LENGTH_BYTES > U_EVENT_SIZE_MASK
+# error U_PORT_EVENT_QUEUE_MAX_PARAM_LENGTH_BYTES is too large for the control/size word.
+#endif
+
+#if U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM < 1
+# error U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM must be at least 1.
+#endif
+
+#if U_PORT_EVENT_QUEUE_SHARED_READY_LENGTH < \
+    (U_PORT_EVENT_QUEUE_MAX_NUM + U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM)
+# error U_PORT_EVENT_QUEUE_SHARED_READY_LENGTH is too short for a token per event queue.
+#endif
+
+#if U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM > 0x7FFE
+# error U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM is too large for the control/size word.
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The scheduling state of a shared event queue handle, kept in
+ * an int32_t so that it can be changed with uPortAtomicXxx().
+ */
+typedef enum {
+    U_EVENT_SHARED_STATE_IDLE = 0, /**< no token, no worker. */
+    U_EVENT_SHARED_STATE_SCHEDULED = 1, /**< a token is on the ready queue. */
+    U_EVENT_SHARED_STATE_RUNNING = 2, /**< a worker is dealing with the event queue. */
+    U_EVENT_SHARED_STATE_RERUN = 3 /**< as RUNNING but an event has been sent
+                                        since, the worker must look again. */
+} uEventQueueSharedState_t;
+
 /** The info for an event queue.
  */
 typedef struct uEventQueue_t {
@@ -63,9 +126,20 @@ typedef struct uEventQueue_t {
     void (*pFunction)(void *, size_t); /** The function to be called. */
     int32_t handle;            /** Handle for this event queue. */
     uPortQueueHandle_t queue; /** Handle for the OS queue. */
+    uPortQueueHandle_t queueHigh; /** Handle for the high priority OS queue, may be NULL. */
+    volatile bool coalesceKeyPending[U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM]; /** true
+                                                                                   where an event
+                                                                                   with that key
+                                                                                   is queued. */
     size_t paramMaxLengthBytes; /** Max length of an item on this OS queue. */
-    uPortTaskHandle_t task; /** Handle for the OS task. */
-    uPortMutexHandle_t taskRunningMutex; /** Mutex to determine if task has exited. */
+    size_t queueLength; /** The length of the OS queue. */
+    uPortTaskHandle_t task; /** Handle for the OS task, NULL if shared. */
+    uPortMutexHandle_t taskRunningMutex; /** Mutex to determine if task has exited or,
+                                             if shared, held by the worker dealing
+                                             with this event queue. */
+    bool shared; /** true if serviced by the shared workers. */
+    uPortTaskHandle_t sharedWorkerTask; /** The worker dealing with this shared event
+                                            queue, NULL if there is none. */
 } uEventQueue_t;
 
 /** The control/size word, prefixed to the parameter block sent to
@@ -78,7 +152,9 @@ typedef enum {
                                                * be 32 bit so that it can
                                                * also be used as a size. */
     U_EVENT_CONTROL_NONE = 0,
-    U_EVENT_CONTROL_EXIT_NOW = -1
+    U_EVENT_CONTROL_EXIT_NOW = -1,
+    U_EVENT_CONTROL_DOORBELL = -2 /* Wakes the task up to empty the
+                                   * high priority queue. */
 } uEventQueueControlOrSize_t;
 
 /* ----------------------------------------------------------------
@@ -93,10 +169,94 @@ static uPortMutexHandle_t gMutex = NULL;
  */
 static uEventQueue_t *gpEventQueue[U_PORT_EVENT_QUEUE_MAX_NUM];
 
+/** The ready queue of the shared workers, NULL if they
+ * have not been started.
+ */
+static uPortQueueHandle_t gSharedReadyQueue = NULL;
+
+/** The shared worker tasks.
+ */
+static uPortTaskHandle_t gSharedWorkerTask[U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM];
+
+/** Mutexes to determine if the shared worker tasks have exited.
+ */
+static uPortMutexHandle_t gSharedWorkerRunningMutex[U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM];
+
+/** The uEventQueueSharedState_t of each event queue handle; this
+ * is per handle rather than in uEventQueue_t because the token
+ * belongs to the handle: it may outlive the event queue it was
+ * sent for, in which case it serves the next one with that handle.
+ */
+static volatile int32_t gSharedState[U_PORT_EVENT_QUEUE_MAX_NUM];
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Make the control/size word for an event.
+static inline uEventQueueControlOrSize_t makeControlOrSize(size_t paramLengthBytes,
+                                                           int32_t coalesceKey)
+{
+    return (uEventQueueControlOrSize_t) (int32_t) (paramLengthBytes |
+                                                   ((uint32_t) (coalesceKey + 1) << U_EVENT_COALESCE_KEY_SHIFT));
+}
+
+// Check the parameters of a send and, if the event is to be
+// coalesced with one which is already queued, return true; this
+// may be called from an interrupt.
+static bool sendCheck(uEventQueue_t *pEventQueue, const void *pParam,
+                      size_t paramLengthBytes, int32_t coalesceKey,
+                      uErrorCode_t *pErrorCode)
+{
+    bool coalesced = false;
+
+    *pErrorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    if ((pEventQueue != NULL) &&
+        (paramLengthBytes <= pEventQueue->paramMaxLengthBytes) &&
+        ((pParam != NULL) || (paramLengthBytes == 0)) &&
+        (coalesceKey >= -1) &&
+        (coalesceKey < U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM)) {
+        *pErrorCode = U_ERROR_COMMON_SUCCESS;
+        if (coalesceKey >= 0) {
+            // Note: if two senders race here both events will be
+            // queued, which does no harm: the point is never
+            // to drop an event that would not be delivered
+            coalesced = pEventQueue->coalesceKeyPending[coalesceKey];
+            pEventQueue->coalesceKeyPending[coalesceKey] = true;
+        }
+    }
+
+    return coalesced;
+}
+
+// Call the user function for a received entry of the given
+// event queue, if it is an event rather than a control word.
+static void eventCall(uEventQueue_t *pEventQueue, char *pParam)
+{
+    int32_t controlOrSize = (int32_t) * ((uEventQueueControlOrSize_t *) pParam);
+    int32_t coalesceKey;
+    size_t size;
+
+    if (controlOrSize >= 0) {
+        size = (size_t) (controlOrSize & U_EVENT_SIZE_MASK);
+        coalesceKey = (controlOrSize >> U_EVENT_COALESCE_KEY_SHIFT) - 1;
+        if (coalesceKey >= 0) {
+            // Clear the key before calling the user function so that
+            // anything that happens while it is running is not lost
+            pEventQueue->coalesceKeyPending[coalesceKey] = false;
+        }
+        // Call the user function with the parameter block,
+        // skipping the "control or size" word at the
+        // start and passing the size in instead
+        if (size > 0) {
+            pEventQueue->pFunction((void *) & (pParam[U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES]),
+                                   size);
+        } else {
+            pEventQueue->pFunction(NULL, 0);
+        }
+    }
+}
+
 // Run the user function.  This will be run multiple times in a
 // task of its own.
 static void eventQueueTask(void *pParam)
@@ -125,21 +285,12 @@ static void eventQueueTask(void *pParam)
     *pControlOrSize = U_EVENT_CONTROL_NONE;
     // Continue until we're told to exit
     while (*pControlOrSize != U_EVENT_CONTROL_EXIT_NOW) {
-        if (uPortQueueReceive(pEventQueue->queue, param) == 0) {
-            // If this is not a control message, call the
-            // user function with the parameter block,
-            // skipping the "control or size" word at the
-            // start and passing it in instead as the size
-            // parameter
-            if ((int32_t) *pControlOrSize >= 0) {
-                if ((int32_t) *pControlOrSize > 0) {
-                    pEventQueue->pFunction((void *) & (param[U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES]),
-                                           // Cast in two stages to keep Lint happy
-                                           (size_t) (int32_t) *pControlOrSize);
-                } else {
-                    pEventQueue->pFunction(NULL, 0);
-                }
-            }
+        if ((pEventQueue->queueHigh != NULL) &&
+            (uPortQueueTryReceive(pEventQueue->queueHigh, 0, param) == 0)) {
+            // High priority events always go first
+            eventCall(pEventQueue, param);
+        } else if (uPortQueueReceive(pEventQueue->queue, param) == 0) {
+            eventCall(pEventQueue, param);
         }
     }
 
@@ -149,6 +300,208 @@ static void eventQueueTask(void *pParam)
     uPortTaskDelete(NULL);
 }
 
+// Tell the shared workers that an event has been sent to a shared
+// event queue; this has to follow the event so that the worker is
+// sure to find it and may be called from an interrupt.
+static void sharedEventQueueSchedule(int32_t handle, bool isIrq)
+{
+    volatile int32_t *pSharedState = &(gSharedState[handle]);
+    bool done = false;
+
+    while (!done) {
+        switch (uPortAtomicLoad(pSharedState)) {
+            case U_EVENT_SHARED_STATE_IDLE:
+                if (uPortAtomicCompareExchange(pSharedState,
+                                               U_EVENT_SHARED_STATE_IDLE,
+                                               U_EVENT_SHARED_STATE_SCHEDULED)) {
+                    // We are the one to send the token: there is
+                    // at most one per event queue, so there is always
+                    // room for it, see U_PORT_EVENT_QUEUE_SHARED_READY_LENGTH
+                    if (isIrq) {
+                        uPortQueueSendIrq(gSharedReadyQueue, &handle);
+                    } else {
+                        uPortQueueSend(gSharedReadyQueue, &handle);
+                    }
+                    done = true;
+                }
+                break;
+            case U_EVENT_SHARED_STATE_RUNNING:
+                // A worker has it, just make sure it looks again
+                done = uPortAtomicCompareExchange(pSharedState,
+                                                  U_EVENT_SHARED_STATE_RUNNING,
+                                                  U_EVENT_SHARED_STATE_RERUN);
+                break;
+            default:
+                // A token is on its way or the worker is already
+                // going to look again
+                done = true;
+                break;
+        }
+    }
+}
+
+// Get hold of a shared event queue for the worker which has the
+// token for the given handle; returns NULL if the handle is no
+// longer that of a shared event queue, in which case the token
+// is dropped.
+static uEventQueue_t *pSharedEventQueueAcquire(int32_t handle)
+{
+    uEventQueue_t *pEventQueue;
+
+    U_PORT_MUTEX_LOCK(gMutex);
+    pEventQueue = gpEventQueue[handle];
+    // The event queue cannot be freed while we hold taskRunningMutex,
+    // see eventQueueFree(), and, since we have the only token for
+    // it, no other worker can have it
+    if ((pEventQueue != NULL) && pEventQueue->shared &&
+        (uPortMutexTryLock(pEventQueue->taskRunningMutex, 0) == 0)) {
+        uPortTaskGetHandle(&(pEventQueue->sharedWorkerTask));
+        // Anything sent from now on will be found by us
+        uPortAtomicStore(&(gSharedState[handle]), U_EVENT_SHARED_STATE_RUNNING);
+    } else {
+        pEventQueue = NULL;
+        uPortAtomicStore(&(gSharedState[handle]), U_EVENT_SHARED_STATE_IDLE);
+    }
+    U_PORT_MUTEX_UNLOCK(gMutex);
+
+    return pEventQueue;
+}
+
+// Let go of a shared event queue, returning true if an event was
+// sent to it while the worker was busy, i.e. the worker must
+// deal with it again.
+static bool sharedEventQueueRelease(uEventQueue_t *pEventQueue, int32_t handle)
+{
+    pEventQueue->sharedWorkerTask = NULL;
+    // Let go of taskRunningMutex before leaving the RUNNING state so
+    // that, once a sender has seen IDLE and sent a new token, the
+    // worker that gets it does not find the event queue taken; note
+    // that pEventQueue may be freed as soon as it is unlocked
+    uPortMutexUnlock(pEventQueue->taskRunningMutex);
+
+    return !uPortAtomicCompareExchange(&(gSharedState[handle]),
+                                       U_EVENT_SHARED_STATE_RUNNING,
+                                       U_EVENT_SHARED_STATE_IDLE);
+}
+
+// A shared worker task, which deals with the shared event
+// queues that it receives tokens for.
+static void sharedWorkerTask(void *pParam)
+{
+    uPortMutexHandle_t runningMutex = (uPortMutexHandle_t) pParam;
+    char param[U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES +
+                                                               U_PORT_EVENT_QUEUE_MAX_PARAM_LENGTH_BYTES];
+    int32_t handle = 0;
+    uEventQueue_t *pEventQueue;
+
+    U_PORT_MUTEX_LOCK(runningMutex);
+
+    // A negative handle tells us to exit
+    while (handle >= 0) {
+        if ((uPortQueueReceive(gSharedReadyQueue, &handle) == 0) &&
+            (handle >= 0) &&
+            (handle < (int32_t) (sizeof(gpEventQueue) / sizeof(gpEventQueue[0])))) {
+            do {
+                pEventQueue = pSharedEventQueueAcquire(handle);
+                if (pEventQueue != NULL) {
+                    // Deal with everything that is waiting, high
+                    // priority first, since there is only one token
+                    // for all of it
+                    while (((pEventQueue->queueHigh != NULL) &&
+                            (uPortQueueTryReceive(pEventQueue->queueHigh, 0, param) == 0)) ||
+                           (uPortQueueTryReceive(pEventQueue->queue, 0, param) == 0)) {
+                        eventCall(pEventQueue, param);
+                    }
+                    if (!sharedEventQueueRelease(pEventQueue, handle)) {
+                        pEventQueue = NULL;
+                    }
+                }
+            } while (pEventQueue != NULL);
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(runningMutex);
+
+    // Delete ourself
+    uPortTaskDelete(NULL);
+}
+
+// Stop the shared workers, if they are running.
+// The mutex must be locked before this is called.
+static void sharedWorkersStop()
+{
+    int32_t handle = -1;
+
+    if (gSharedReadyQueue != NULL) {
+        // Tell all of the workers to exit first since any one of
+        // them may pick up any one of the exit messages
+        for (size_t x = 0; x < U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM; x++) {
+            if (gSharedWorkerRunningMutex[x] != NULL) {
+                uPortQueueSend(gSharedReadyQueue, &handle);
+            }
+        }
+        for (size_t x = 0; x < U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM; x++) {
+            if (gSharedWorkerRunningMutex[x] != NULL) {
+                U_PORT_MUTEX_LOCK(gSharedWorkerRunningMutex[x]);
+                U_PORT_MUTEX_UNLOCK(gSharedWorkerRunningMutex[x]);
+                uPortMutexDelete(gSharedWorkerRunningMutex[x]);
+                gSharedWorkerRunningMutex[x] = NULL;
+                gSharedWorkerTask[x] = NULL;
+            }
+        }
+        uPortQueueDelete(gSharedReadyQueue);
+        gSharedReadyQueue = NULL;
+        // Pause here to allow the deletions
+        // above to actually occur in the idle thread,
+        // required by some RTOSs (e.g. FreeRTOS)
+        uPortTaskBlock(U_CFG_OS_YIELD_MS);
+    }
+}
+
+// Start the shared workers, if they are not already running.
+// The mutex must be locked before this is called.
+static int32_t sharedWorkersStart()
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    size_t x;
+
+    if (gSharedReadyQueue == NULL) {
+        // No tokens are out
+        for (x = 0; x < sizeof(gSharedState) / sizeof(gSharedState[0]); x++) {
+            gSharedState[x] = U_EVENT_SHARED_STATE_IDLE;
+        }
+        errorCode = uPortQueueCreate(U_PORT_EVENT_QUEUE_SHARED_READY_LENGTH,
+                                     sizeof(int32_t), &gSharedReadyQueue);
+        for (x = 0; (errorCode == 0) && (x < U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM); x++) {
+            errorCode = uPortMutexCreate(&(gSharedWorkerRunningMutex[x]));
+            if (errorCode == 0) {
+                errorCode = uPortTaskCreate(sharedWorkerTask, "eventQueueWorker",
+                                            U_PORT_EVENT_QUEUE_SHARED_STACK_SIZE_BYTES,
+                                            (void *) gSharedWorkerRunningMutex[x],
+                                            U_PORT_EVENT_QUEUE_SHARED_PRIORITY,
+                                            &(gSharedWorkerTask[x]));
+                if (errorCode == 0) {
+                    // Wait for the worker to lock the mutex,
+                    // which shows it is running
+                    while (uPortMutexTryLock(gSharedWorkerRunningMutex[x], 0) == 0) {
+                        uPortMutexUnlock(gSharedWorkerRunningMutex[x]);
+                        uPortTaskBlock(U_CFG_OS_YIELD_MS);
+                    }
+                } else {
+                    uPortMutexDelete(gSharedWorkerRunningMutex[x]);
+                    gSharedWorkerRunningMutex[x] = NULL;
+                }
+            }
+        }
+        if ((errorCode != 0) && (gSharedReadyQueue != NULL)) {
+            // Stop whatever we managed to start
+            sharedWorkersStop();
+        }
+    }
+
+    return errorCode;
+}
+
 // Free memory held by an event queue.
 // The mutex must be locked before this is called.
 static int32_t eventQueueFree(uEventQueue_t *pEventQueue)
@@ -156,31 +509,44 @@ static int32_t eventQueueFree(uEventQueue_t *pEventQueue)
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
     void *pControl;
 
-    // It would be nice to send just U_EVENT_CONTROL_EXIT_NOW
-    // on its own here but, as address sanitizer points out,
-    // the uPortQueueSend() function must copy the required
-    // length for an item on the queue so it has to be
-    // given that data size, hence we allocate the block,
-    // put U_EVENT_CONTROL_EXIT_NOW at the start of it and
-    // then free it once it is sent
-    pControl = pUPortMalloc(pEventQueue->paramMaxLengthBytes +
-                            U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES);
-
-    if (pControl != NULL) {
-        // Keep memory checkers (e.g. Valgrind) happy
-        memset(pControl, 0, pEventQueue->paramMaxLengthBytes +
-               U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES);
-        *((uEventQueueControlOrSize_t *) pControl) = U_EVENT_CONTROL_EXIT_NOW;
-        // Get the task to exit, persisting until it is done
-        while (uPortQueueSend(pEventQueue->queue, pControl) != 0) {
-            uPortTaskBlock(10);
+    if (pEventQueue->shared) {
+        // There is no task to stop, just wait below for any
+        // worker to let go; a token left on the ready queue for
+        // this handle serves the next event queue to have it
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    } else {
+        // It would be nice to send just U_EVENT_CONTROL_EXIT_NOW
+        // on its own here but, as address sanitizer points out,
+        // the uPortQueueSend() function must copy the required
+        // length for an item on the queue so it has to be
+        // given that data size, hence we allocate the block,
+        // put U_EVENT_CONTROL_EXIT_NOW at the start of it and
+        // then free it once it is sent
+        pControl = pUPortMalloc(pEventQueue->paramMaxLengthBytes +
+                                U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES);
+        if (pControl != NULL) {
+            // Keep memory checkers (e.g. Valgrind) happy
+            memset(pControl, 0, pEventQueue->paramMaxLengthBytes +
+                   U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES);
+            *((uEventQueueControlOrSize_t *) pControl) = U_EVENT_CONTROL_EXIT_NOW;
+            // Get the task to exit, persisting until it is done
+            while (uPortQueueSend(pEventQueue->queue, pControl) != 0) {
+                uPortTaskBlock(10);
+            }
+            uPortFree(pControl);
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
         }
-        uPortFree(pControl);
+    }
+
+    if (errorCode == 0) {
         U_PORT_MUTEX_LOCK(pEventQueue->taskRunningMutex);
         U_PORT_MUTEX_UNLOCK(pEventQueue->taskRunningMutex);
 
         // Tidy up
         uPortMutexDelete(pEventQueue->taskRunningMutex);
+        if (pEventQueue->queueHigh != NULL) {
+            uPortQueueDelete(pEventQueue->queueHigh);
+        }
         errorCode = uPortQueueDelete(pEventQueue->queue);
 
         // Pause here to allow the deletions
@@ -281,6 +647,9 @@ void uPortEventQueuePrivateDeinit(void)
             }
         }
 
+        // Stop the shared workers
+        sharedWorkersStop();
+
         U_PORT_MUTEX_UNLOCK(gMutex);
 
         // Finally delete the mutex
@@ -289,17 +658,15 @@ void uPortEventQueuePrivateDeinit(void)
     }
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS
- * -------------------------------------------------------------- */
-
-// Open an event queue.
-int32_t uPortEventQueueOpen(void (*pFunction) (void *, size_t),
-                            const char *pName,
-                            size_t paramMaxLengthBytes,
-                            size_t stackSizeBytes,
-                            int32_t priority,
-                            size_t queueLength)
+// Open an event queue, with a task of its own or, if shared
+// is true, serviced by the shared workers.
+static int32_t eventQueueOpen(void (*pFunction) (void *, size_t),
+                              const char *pName,
+                              size_t paramMaxLengthBytes,
+                              size_t stackSizeBytes,
+                              int32_t priority,
+                              size_t queueLength,
+                              bool shared)
 {
     uEventQueue_t *pEventQueue = NULL;
     uErrorCode_t handleOrError = U_ERROR_COMMON_NOT_INITIALISED;
@@ -311,9 +678,10 @@ int32_t uPortEventQueueOpen(void (*pFunction) (void *, size_t),
         // Check parameters
         if ((pFunction != NULL) &&
             (paramMaxLengthBytes <= U_PORT_EVENT_QUEUE_MAX_PARAM_LENGTH_BYTES) &&
-            (stackSizeBytes >= U_PORT_EVENT_QUEUE_MIN_TASK_STACK_SIZE_BYTES) &&
-            (priority >= U_CFG_OS_PRIORITY_MIN) &&
-            (priority <= U_CFG_OS_PRIORITY_MAX) &&
+            (shared ||
+             ((stackSizeBytes >= U_PORT_EVENT_QUEUE_MIN_TASK_STACK_SIZE_BYTES) &&
+              (priority >= U_CFG_OS_PRIORITY_MIN) &&
+              (priority <= U_CFG_OS_PRIORITY_MAX))) &&
             (queueLength > 0)) {
 
             U_PORT_MUTEX_LOCK(gMutex);
@@ -321,22 +689,45 @@ int32_t uPortEventQueueOpen(void (*pFunction) (void *, size_t),
             handleOrError = U_ERROR_COMMON_NO_MEMORY;
             // See if there's a free handle
             handle = nextEventHandleGet();
+            if ((handle >= 0) && shared) {
+                // Make sure the shared workers are running
+                handleOrError = (uErrorCode_t) sharedWorkersStart();
+                if (handleOrError != U_ERROR_COMMON_SUCCESS) {
+                    handle = -1;
+                }
+            }
             if (handle >= 0) {
+                handleOrError = U_ERROR_COMMON_NO_MEMORY;
                 // Malloc a structure to represent the event queue
                 pEventQueue = (uEventQueue_t *) pUPortMalloc(sizeof(uEventQueue_t));
                 if (pEventQueue != NULL) {
+                    memset(pEventQueue, 0, sizeof(*pEventQueue));
                     pEventQueue->closed = false;
                     pEventQueue->pFunction = pFunction;
                     pEventQueue->paramMaxLengthBytes = paramMaxLengthBytes;
+                    pEventQueue->queueLength = queueLength;
+                    pEventQueue->shared = shared;
                     // Create the queue
                     handleOrError = (uErrorCode_t) uPortQueueCreate(queueLength,
                                                                     paramMaxLengthBytes +
                                                                     U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES,
                                                                     &(pEventQueue->queue));
+#if U_PORT_EVENT_QUEUE_HIGH_PRIORITY_LENGTH > 0
+                    if (handleOrError == U_ERROR_COMMON_SUCCESS) {
+                        // Create the high priority queue
+                        handleOrError = (uErrorCode_t) uPortQueueCreate(U_PORT_EVENT_QUEUE_HIGH_PRIORITY_LENGTH,
+                                                                        paramMaxLengthBytes +
+                                                                        U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES,
+                                                                        &(pEventQueue->queueHigh));
+                        if (handleOrError != U_ERROR_COMMON_SUCCESS) {
+                            uPortQueueDelete(pEventQueue->queue);
+                        }
+                    }
+#endif
                     if (handleOrError == U_ERROR_COMMON_SUCCESS) {
                         // Create the mutex for task running status
                         handleOrError = (uErrorCode_t) uPortMutexCreate(&(pEventQueue->taskRunningMutex));
-                        if (handleOrError == U_ERROR_COMMON_SUCCESS) {
+                        if ((handleOrError == U_ERROR_COMMON_SUCCESS) && !shared) {
                             // Finally, create the task itself
                             if (pName != NULL) {
                                 pTaskName = pName;
@@ -354,21 +745,23 @@ int32_t uPortEventQueueOpen(void (*pFunction) (void *, size_t),
                                     uPortMutexUnlock(pEventQueue->taskRunningMutex);
                                     uPortTaskBlock(U_CFG_OS_YIELD_MS);
                                 }
-                                // Add the event queue structure to the list
-                                pEventQueue->handle = handle;
-                                gpEventQueue[handle] = pEventQueue;
-                                // Return the handle
-                                handleOrError = (uErrorCode_t) handle;
                             } else {
-                                // Couldn't create the task, delete the
-                                // mutex and queue and free the structure
+                                // Couldn't create the task, delete the mutex
                                 uPortMutexDelete(pEventQueue->taskRunningMutex);
-                                uPortQueueDelete(pEventQueue->queue);
-                                uPortFree(pEventQueue);
                             }
+                        }
+                        if (handleOrError == U_ERROR_COMMON_SUCCESS) {
+                            // Add the event queue structure to the list
+                            pEventQueue->handle = handle;
+                            gpEventQueue[handle] = pEventQueue;
+                            // Return the handle
+                            handleOrError = (uErrorCode_t) handle;
                         } else {
-                            // Couldn't create the mutex, delete the queue
-                            // and free the structure
+                            // Couldn't create the mutex or the task, delete
+                            // the queues and free the structure
+                            if (pEventQueue->queueHigh != NULL) {
+                                uPortQueueDelete(pEventQueue->queueHigh);
+                            }
                             uPortQueueDelete(pEventQueue->queue);
                             uPortFree(pEventQueue);
                         }
@@ -386,25 +779,78 @@ int32_t uPortEventQueueOpen(void (*pFunction) (void *, size_t),
     return (int32_t) handleOrError;
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Open an event queue.
+int32_t uPortEventQueueOpen(void (*pFunction) (void *, size_t),
+                            const char *pName,
+                            size_t paramMaxLengthBytes,
+                            size_t stackSizeBytes,
+                            int32_t priority,
+                            size_t queueLength)
+{
+    return eventQueueOpen(pFunction, pName, paramMaxLengthBytes,
+                          stackSizeBytes, priority, queueLength, false);
+}
+
+// Open an event queue serviced by the shared workers.
+int32_t uPortEventQueueOpenShared(void (*pFunction) (void *, size_t),
+                                  size_t paramMaxLengthBytes,
+                                  size_t queueLength)
+{
+    return eventQueueOpen(pFunction, NULL, paramMaxLengthBytes,
+                          0, 0, queueLength, true);
+}
+
 // Send to an event queue.
 int32_t uPortEventQueueSend(int32_t handle, const void *pParam,
                             size_t paramLengthBytes)
+{
+    return uPortEventQueueSendExt(handle, pParam, paramLengthBytes, -1, false);
+}
+
+// Send to an event queue from an interrupt.
+int32_t uPortEventQueueSendIrq(int32_t handle, const void *pParam,
+                               size_t paramLengthBytes)
+{
+    return uPortEventQueueSendExtIrq(handle, pParam, paramLengthBytes, -1, false);
+}
+
+// Send to an event queue, with coalescing and priority.
+int32_t uPortEventQueueSendExt(int32_t handle, const void *pParam,
+                               size_t paramLengthBytes,
+                               int32_t coalesceKey, bool highPriority)
 {
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
     uEventQueue_t *pEventQueue;
     char *pBlock = NULL;
     uPortQueueHandle_t queue = NULL;
+    uPortQueueHandle_t queueHigh = NULL;
+    size_t queueLength = 0;
+    bool shared = false;
+    volatile bool *pCoalesceKeyPending = NULL;
 
     if (gMutex != NULL) {
 
         U_PORT_MUTEX_LOCK(gMutex);
 
-        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
         pEventQueue = pEventQueueGet(handle);
-        if ((pEventQueue != NULL) &&
-            (paramLengthBytes <= pEventQueue->paramMaxLengthBytes) &&
-            ((pParam != NULL) || (paramLengthBytes == 0))) {
+        if (sendCheck(pEventQueue, pParam, paramLengthBytes,
+                      coalesceKey, &errorCode)) {
+            // Merged with an event which is already queued,
+            // nothing more to do
+        } else if (errorCode == U_ERROR_COMMON_SUCCESS) {
             queue = pEventQueue->queue;
+            queueLength = pEventQueue->queueLength;
+            shared = pEventQueue->shared;
+            if (highPriority) {
+                queueHigh = pEventQueue->queueHigh;
+            }
+            if (coalesceKey >= 0) {
+                pCoalesceKeyPending = &(pEventQueue->coalesceKeyPending[coalesceKey]);
+            }
             errorCode = U_ERROR_COMMON_NO_MEMORY;
             // We need to add the control word to the start, so pUPortMalloc
             // a block that is paramMaxLengthBytes (i.e. paramMaxLengthBytes
@@ -418,16 +864,19 @@ int32_t uPortEventQueueSend(int32_t handle, const void *pParam,
                 memset(pBlock, 0, pEventQueue->paramMaxLengthBytes +
                        U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES);
                 // Copy in the control word, which is actually just
-                // the size in this case
+                // the size and key in this case
                 //lint -e(826) Suppress area too small; the size of pBlock is always
                 // at least U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES in size
-                *((uEventQueueControlOrSize_t *) pBlock) = (uEventQueueControlOrSize_t) paramLengthBytes;
+                *((uEventQueueControlOrSize_t *) pBlock) = makeControlOrSize(paramLengthBytes,
+                                                                             coalesceKey);
                 if (pParam != NULL) {
                     // Copy in param
                     //lint -e{826} Suppress pointed-to area too small, we make sure it is OK above
                     memcpy(pBlock + U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES,
                            pParam, paramLengthBytes);
                 }
+            } else if (pCoalesceKeyPending != NULL) {
+                *pCoalesceKeyPending = false;
             }
         }
 
@@ -438,10 +887,30 @@ int32_t uPortEventQueueSend(int32_t handle, const void *pParam,
         U_PORT_MUTEX_UNLOCK(gMutex);
 
         if (pBlock != NULL) {
-            if (queue != NULL) {
+            if (queueHigh != NULL) {
+                // Send it off on the high priority queue and
+                // then, if the normal queue is empty, ring the
+                // doorbell on it since the task may be waiting
+                // there; otherwise the task will get to the high
+                // priority queue before its next normal event
+                errorCode = (uErrorCode_t) uPortQueueSend(queueHigh, pBlock);
+                if ((errorCode == U_ERROR_COMMON_SUCCESS) && !shared &&
+                    ((uPortQueueGetFree(queue) < 0) ||
+                     (uPortQueueGetFree(queue) == (int32_t) queueLength))) {
+                    *((uEventQueueControlOrSize_t *) pBlock) = U_EVENT_CONTROL_DOORBELL;
+                    uPortQueueSend(queue, pBlock);
+                }
+            } else if (queue != NULL) {
                 // Send it off
                 errorCode = (uErrorCode_t) uPortQueueSend(queue, pBlock);
             }
+            if ((errorCode == U_ERROR_COMMON_SUCCESS) && shared) {
+                sharedEventQueueSchedule(handle, false);
+            }
+            if ((errorCode != U_ERROR_COMMON_SUCCESS) &&
+                (pCoalesceKeyPending != NULL)) {
+                *pCoalesceKeyPending = false;
+            }
             // Free memory again
             uPortFree(pBlock);
         }
@@ -450,9 +919,10 @@ int32_t uPortEventQueueSend(int32_t handle, const void *pParam,
     return (int32_t) errorCode;
 }
 
-// Send to an event queue from an interrupt.
-int32_t uPortEventQueueSendIrq(int32_t handle, const void *pParam,
-                               size_t paramLengthBytes)
+// Send to an event queue from an interrupt, with coalescing and priority.
+int32_t uPortEventQueueSendExtIrq(int32_t handle, const void *pParam,
+                                  size_t paramLengthBytes,
+                                  int32_t coalesceKey, bool highPriority)
 {
 #ifndef _WIN32
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
@@ -462,25 +932,44 @@ int32_t uPortEventQueueSendIrq(int32_t handle, const void *pParam,
 
     if (gMutex != NULL) {
         // Can't lock the mutex, we're in an interrupt.
-        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
         pEventQueue = pEventQueueGet(handle);
-        if ((pEventQueue != NULL) &&
-            (paramLengthBytes <= pEventQueue->paramMaxLengthBytes) &&
-            ((pParam != NULL) || (paramLengthBytes == 0))) {
+        if (sendCheck(pEventQueue, pParam, paramLengthBytes,
+                      coalesceKey, &errorCode)) {
+            // Merged with an event which is already queued,
+            // nothing more to do
+        } else if (errorCode == U_ERROR_COMMON_SUCCESS) {
             // Copy in the control word, which is actually just
-            // the size in this case
+            // the size and key in this case
             //lint -e(826) Suppress area too small; the size of pBlock is always
             // at least U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES in size
             uEventQueueControlOrSize_t *pControlOrSize = (uEventQueueControlOrSize_t *) block;
-            *pControlOrSize = (uEventQueueControlOrSize_t) paramLengthBytes;
+            *pControlOrSize = makeControlOrSize(paramLengthBytes, coalesceKey);
             if (pParam != NULL) {
                 // Copy in param
                 memcpy(block + U_PORT_EVENT_QUEUE_CONTROL_OR_SIZE_LENGTH_BYTES,
                        pParam, paramLengthBytes);
             }
             // Send it off
-            errorCode = (uErrorCode_t) uPortQueueSendIrq(pEventQueue->queue,
-                                                         block);
+            if (highPriority && (pEventQueue->queueHigh != NULL)) {
+                errorCode = (uErrorCode_t) uPortQueueSendIrq(pEventQueue->queueHigh,
+                                                             block);
+                if ((errorCode == U_ERROR_COMMON_SUCCESS) && !pEventQueue->shared) {
+                    // Ring the doorbell, see uPortEventQueueSendExt();
+                    // there is no way of checking for an empty queue
+                    // from an interrupt on all platforms, so always
+                    *pControlOrSize = U_EVENT_CONTROL_DOORBELL;
+                    uPortQueueSendIrq(pEventQueue->queue, block);
+                }
+            } else {
+                errorCode = (uErrorCode_t) uPortQueueSendIrq(pEventQueue->queue,
+                                                             block);
+            }
+            if ((errorCode == U_ERROR_COMMON_SUCCESS) && pEventQueue->shared) {
+                sharedEventQueueSchedule(handle, true);
+            }
+            if ((errorCode != U_ERROR_COMMON_SUCCESS) && (coalesceKey >= 0)) {
+                pEventQueue->coalesceKeyPending[coalesceKey] = false;
+            }
         }
     }
 #else
@@ -495,6 +984,8 @@ int32_t uPortEventQueueSendIrq(int32_t handle, const void *pParam,
     (void) handle;
     (void) pParam;
     (void) paramLengthBytes;
+    (void) coalesceKey;
+    (void) highPriority;
 #endif
 
     return (int32_t) errorCode;
@@ -512,7 +1003,12 @@ bool uPortEventQueueIsTask(int32_t handle)
 
         pEventQueue = pEventQueueGet(handle);
         if (pEventQueue != NULL) {
-            isEventTask = uPortTaskIsThis(pEventQueue->task);
+            if (pEventQueue->shared) {
+                isEventTask = (pEventQueue->sharedWorkerTask != NULL) &&
+                              uPortTaskIsThis(pEventQueue->sharedWorkerTask);
+            } else {
+                isEventTask = uPortTaskIsThis(pEventQueue->task);
+            }
         }
 
         U_PORT_MUTEX_UNLOCK(gMutex);
@@ -534,7 +1030,17 @@ int32_t uPortEventQueueStackMinFree(int32_t handle)
         sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         pEventQueue = pEventQueueGet(handle);
         if (pEventQueue != NULL) {
-            sizeOrErrorCode = uPortTaskStackMinFree(pEventQueue->task);
+            if (pEventQueue->shared) {
+                // Any of the workers may run the event callback
+                for (size_t x = 0; x < U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM; x++) {
+                    int32_t y = uPortTaskStackMinFree(gSharedWorkerTask[x]);
+                    if ((x == 0) || (y < sizeOrErrorCode)) {
+                        sizeOrErrorCode = y;
+                    }
+                }
+            } else {
+                sizeOrErrorCode = uPortTaskStackMinFree(pEventQueue->task);
+            }
         }
 
         U_PORT_MUTEX_UNLOCK(gMutex);
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Tests for the RAM logging utility: no module is required.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the
+ * U_PORT_TEST_FUNCTION() macro.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset(), memcpy()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_log_ram.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_LOG_RAM_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The number of tasks that log at the same time.
+ */
+#define U_LOG_RAM_TEST_NUM_WRITERS 3
+
+/** The number of entries each writer task logs, small enough that,
+ * with the start entry, none need be overwritten.
+ */
+#define U_LOG_RAM_TEST_NUM_WRITES ((U_LOG_RAM_ENTRIES_MAX_NUM - 1) / U_LOG_RAM_TEST_NUM_WRITERS)
+
+/** The number of entries to log beyond the size of the log in
+ * order to make it wrap.
+ */
+#define U_LOG_RAM_TEST_NUM_EXTRA 10
+
+/** How long to wait for the writer tasks to finish.
+ */
+#define U_LOG_RAM_TEST_WRITERS_TIMEOUT_MS 10000
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Storage for the log, where the test wants to get at the context;
+ * uint64_t so that it is aligned for the pointer in the context.
+ */
+static uint64_t gStore[(U_LOG_RAM_STORE_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+
+/** Somewhere to put the entries read with uLogRamGet().
+ */
+static uLogRamEntry_t gEntries[U_LOG_RAM_ENTRIES_MAX_NUM + 1];
+
+/** Somewhere to put the output of uLogRamExport().
+ */
+static char gExportBuffer[sizeof(uLogRamExportHeader_t) +
+                          (sizeof(uLogRamEntry_t) * U_LOG_RAM_ENTRIES_MAX_NUM)];
+
+/** The number of bytes in gExportBuffer.
+ */
+static size_t gExportLength = 0;
+
+/** Given by each writer task when it has finished.
+ */
+static uPortSemaphoreHandle_t gWritersDone = NULL;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// A task that logs U_LOG_RAM_TEST_NUM_WRITES entries, the event
+// being U_LOG_RAM_EVENT_USER_0 plus the index passed in and the
+// parameter counting up from zero.
+static void writerTask(void *pParam)
+{
+    uLogRamEvent_t event = (uLogRamEvent_t) (U_LOG_RAM_EVENT_USER_0 + (intptr_t) pParam);
+
+    for (int32_t x = 0; x < U_LOG_RAM_TEST_NUM_WRITES; x++) {
+        uLogRam(event, x);
+        if ((x % 16) == 0) {
+            // Let the others, and the reader, in
+            uPortTaskBlock(1);
+        }
+    }
+
+    uPortSemaphoreGive(gWritersDone);
+    uPortTaskDelete(NULL);
+}
+
+// Callback for uLogRamExport(), writing to gExportBuffer, at most
+// the number of bytes pointed to by pCallbackParam.
+static int32_t exportCallback(const char *pData, size_t size, void *pCallbackParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    size_t capacity = *((size_t *) pCallbackParam);
+
+    if (gExportLength + size <= capacity) {
+        memcpy(gExportBuffer + gExportLength, pData, size);
+        gExportLength += size;
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TESTS
+ * -------------------------------------------------------------- */
+
+/** Log from several tasks at once while reading the log, checking
+ * that nothing is lost, duplicated or re-ordered within a task, and
+ * that an entry which has been reserved but not yet filled in
+ * holds up neither the reader nor the entries behind it for longer
+ * than it takes to fill it in.
+ */
+U_PORT_TEST_FUNCTION("[logRam]", "logRamWriters")
+{
+    uLogRamContext_t *pContext = (uLogRamContext_t *) gStore;
+    uPortTaskHandle_t taskHandle;
+    int32_t nextParameter[U_LOG_RAM_TEST_NUM_WRITERS] = {0};
+    size_t numRead = 0;
+    size_t numDone = 0;
+    int32_t startTimeMs;
+    uint32_t reserved;
+    int32_t index;
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    memset(gStore, 0, sizeof(gStore));
+    U_PORT_TEST_ASSERT(uLogRamInit(gStore));
+    U_PORT_TEST_ASSERT(uLogRamGetNumEntries() == 1);
+
+    U_PORT_TEST_ASSERT(uPortSemaphoreCreate(&gWritersDone, 0,
+                                            U_LOG_RAM_TEST_NUM_WRITERS) == 0);
+    for (intptr_t x = 0; x < U_LOG_RAM_TEST_NUM_WRITERS; x++) {
+        U_PORT_TEST_ASSERT(uPortTaskCreate(writerTask, "logRamWriter",
+                                           U_CFG_TEST_OS_TASK_STACK_SIZE_BYTES,
+                                           (void *) x, U_CFG_TEST_OS_TASK_PRIORITY,
+                                           &taskHandle) == 0);
+    }
+
+    // Read while the writers are writing, until they are done
+    // and the log is empty
+    startTimeMs = uPortGetTickTimeMs();
+    while (((numDone < U_LOG_RAM_TEST_NUM_WRITERS) || (uLogRamGetNumEntries() > 0)) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_LOG_RAM_TEST_WRITERS_TIMEOUT_MS)) {
+        numRead += uLogRamGet(gEntries + numRead,
+                              (sizeof(gEntries) / sizeof(gEntries[0])) - numRead);
+        if (uPortSemaphoreTryTake(gWritersDone, 1) == 0) {
+            numDone++;
+        }
+    }
+    U_TEST_PRINT_LINE("%d writer(s) finished, %d entries read.", numDone, numRead);
+    U_PORT_TEST_ASSERT(numDone == U_LOG_RAM_TEST_NUM_WRITERS);
+    U_PORT_TEST_ASSERT(numRead == 1 + (U_LOG_RAM_TEST_NUM_WRITERS * U_LOG_RAM_TEST_NUM_WRITES));
+    U_PORT_TEST_ASSERT(gEntries[0].event == U_LOG_RAM_EVENT_START);
+    for (size_t x = 0; x < numRead; x++) {
+        U_PORT_TEST_ASSERT(gEntries[x].sequence == x);
+        if (x > 0) {
+            index = (int32_t) gEntries[x].event - U_LOG_RAM_EVENT_USER_0;
+            U_PORT_TEST_ASSERT((index >= 0) && (index < U_LOG_RAM_TEST_NUM_WRITERS));
+            U_PORT_TEST_ASSERT(gEntries[x].parameter == nextParameter[index]);
+            nextParameter[index]++;
+        }
+    }
+    for (size_t x = 0; x < U_LOG_RAM_TEST_NUM_WRITERS; x++) {
+        U_PORT_TEST_ASSERT(nextParameter[x] == U_LOG_RAM_TEST_NUM_WRITES);
+    }
+
+    // Reserve an entry as uLogRam() would, but don't fill it in,
+    // as if the uLogRam() call had been pre-empted, then log
+    // another behind it: reading must return nothing, rather
+    // than wait, until the reserved entry is filled in
+    reserved = pContext->writeCount;
+    pContext->writeCount++;
+    uLogRam(U_LOG_RAM_EVENT_USER_3, 1);
+    U_PORT_TEST_ASSERT(uLogRamGetNumEntries() == 2);
+    U_PORT_TEST_ASSERT(uLogRamGet(gEntries, 2) == 0);
+    U_PORT_TEST_ASSERT(uLogRamGetNumEntries() == 2);
+    gEntries[0].timestamp = U_LOG_RAM_TIMESTAMP_US();
+    gEntries[0].event = U_LOG_RAM_EVENT_USER_3;
+    gEntries[0].parameter = 0;
+    gEntries[0].sequence = reserved;
+    memcpy(pContext->pLog + (reserved % U_LOG_RAM_ENTRIES_MAX_NUM), &gEntries[0],
+           sizeof(gEntries[0]));
+    memset(gEntries, 0, sizeof(gEntries));
+    U_PORT_TEST_ASSERT(uLogRamGet(gEntries, 3) == 2);
+    U_PORT_TEST_ASSERT((gEntries[0].event == U_LOG_RAM_EVENT_USER_3) &&
+                       (gEntries[0].parameter == 0) && (gEntries[0].sequence == reserved));
+    U_PORT_TEST_ASSERT((gEntries[1].event == U_LOG_RAM_EVENT_USER_3) &&
+                       (gEntries[1].parameter == 1) && (gEntries[1].sequence == reserved + 1));
+    U_PORT_TEST_ASSERT(uLogRamGetNumEntries() == 0);
+
+    // Give the writer tasks time to go
+    uPortTaskBlock(100);
+    uPortSemaphoreDelete(gWritersDone);
+    gWritersDone = NULL;
+
+    // The log is in gStore so it remains after this
+    uLogRamDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Make the log wrap, checking the counting of lost entries by
+ * uLogRamGet() and the output of uLogRamExport().
+ */
+U_PORT_TEST_FUNCTION("[logRam]", "logRamWrapExport")
+{
+    const uLogRamExportHeader_t *pHeader = (const uLogRamExportHeader_t *) gExportBuffer;
+    const uLogRamEntry_t *pEntry;
+    size_t capacity = sizeof(gExportBuffer);
+    int32_t heapAllocCount = uPortHeapAllocCount();
+    int32_t x;
+
+    // Log MAX + EXTRA entries on top of the start entry, so that
+    // the start entry and the first EXTRA are overwritten
+    U_PORT_TEST_ASSERT(uLogRamInit(NULL));
+    U_PORT_TEST_ASSERT(uLogRamExport(NULL, NULL) == (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    for (x = 0; x < U_LOG_RAM_ENTRIES_MAX_NUM + U_LOG_RAM_TEST_NUM_EXTRA; x++) {
+        uLogRam(U_LOG_RAM_EVENT_USER_0, x);
+    }
+    U_PORT_TEST_ASSERT(uLogRamGetNumEntries() == U_LOG_RAM_ENTRIES_MAX_NUM);
+
+    // Export: the header and then the entries that remain, oldest
+    // first, without removing them
+    gExportLength = 0;
+    x = uLogRamExport(exportCallback, &capacity);
+    U_TEST_PRINT_LINE("uLogRamExport() returned %d, %d byte(s).", x, gExportLength);
+    U_PORT_TEST_ASSERT(x == U_LOG_RAM_ENTRIES_MAX_NUM);
+    U_PORT_TEST_ASSERT(gExportLength == sizeof(gExportBuffer));
+    U_PORT_TEST_ASSERT(pHeader->magic == U_LOG_RAM_EXPORT_MAGIC);
+    U_PORT_TEST_ASSERT(pHeader->version == U_LOG_RAM_VERSION);
+    U_PORT_TEST_ASSERT(pHeader->entrySizeBytes == sizeof(uLogRamEntry_t));
+    U_PORT_TEST_ASSERT(pHeader->numEntries == U_LOG_RAM_ENTRIES_MAX_NUM);
+    U_PORT_TEST_ASSERT(pHeader->timestampUnitUs == 1);
+    pEntry = (const uLogRamEntry_t *) (gExportBuffer + sizeof(*pHeader));
+    for (x = 0; x < U_LOG_RAM_ENTRIES_MAX_NUM; x++, pEntry++) {
+        U_PORT_TEST_ASSERT(pEntry->event == U_LOG_RAM_EVENT_USER_0);
+        U_PORT_TEST_ASSERT(pEntry->parameter == x + U_LOG_RAM_TEST_NUM_EXTRA);
+        U_PORT_TEST_ASSERT(pEntry->sequence == (uint32_t) x + U_LOG_RAM_TEST_NUM_EXTRA + 1);
+    }
+    U_PORT_TEST_ASSERT(uLogRamGetNumEntries() == U_LOG_RAM_ENTRIES_MAX_NUM);
+
+    // An error from the callback stops the export and is returned
+    gExportLength = 0;
+    capacity = sizeof(uLogRamExportHeader_t) + sizeof(uLogRamEntry_t);
+    U_PORT_TEST_ASSERT(uLogRamExport(exportCallback,
+                                     &capacity) == (int32_t) U_ERROR_COMMON_NO_MEMORY);
+    U_PORT_TEST_ASSERT(gExportLength == capacity);
+
+    // Getting the entries gives first the number that were lost
+    memset(gEntries, 0, sizeof(gEntries));
+    U_PORT_TEST_ASSERT(uLogRamGet(gEntries, U_LOG_RAM_ENTRIES_MAX_NUM + 1) ==
+                       U_LOG_RAM_ENTRIES_MAX_NUM + 1);
+    U_PORT_TEST_ASSERT(gEntries[0].event == U_LOG_RAM_EVENT_ENTRIES_OVERWRITTEN);
+    U_PORT_TEST_ASSERT(gEntries[0].parameter == U_LOG_RAM_TEST_NUM_EXTRA + 1);
+    for (x = 0; x < U_LOG_RAM_ENTRIES_MAX_NUM; x++) {
+        U_PORT_TEST_ASSERT(gEntries[x + 1].event == U_LOG_RAM_EVENT_USER_0);
+        U_PORT_TEST_ASSERT(gEntries[x + 1].parameter == x + U_LOG_RAM_TEST_NUM_EXTRA);
+    }
+    U_PORT_TEST_ASSERT(uLogRamGetNumEntries() == 0);
+    U_PORT_TEST_ASSERT(uLogRamGet(gEntries, 1) == 0);
+
+    // Read one of three entries then wrap the log again: the two
+    // unread entries are reported as lost, even when there is
+    // room for nothing else
+    uLogRam(U_LOG_RAM_EVENT_USER_1, 0);
+    uLogRam(U_LOG_RAM_EVENT_USER_1, 1);
+    uLogRam(U_LOG_RAM_EVENT_USER_1, 2);
+    U_PORT_TEST_ASSERT(uLogRamGet(gEntries, 1) == 1);
+    U_PORT_TEST_ASSERT(gEntries[0].parameter == 0);
+    for (x = 0; x < U_LOG_RAM_ENTRIES_MAX_NUM; x++) {
+        uLogRam(U_LOG_RAM_EVENT_USER_2, x);
+    }
+    U_PORT_TEST_ASSERT(uLogRamGet(gEntries, 1) == 1);
+    U_PORT_TEST_ASSERT(gEntries[0].event == U_LOG_RAM_EVENT_ENTRIES_OVERWRITTEN);
+    U_PORT_TEST_ASSERT(gEntries[0].parameter == 2);
+    U_PORT_TEST_ASSERT(uLogRamGet(gEntries, U_LOG_RAM_ENTRIES_MAX_NUM) ==
+                       U_LOG_RAM_ENTRIES_MAX_NUM);
+    U_PORT_TEST_ASSERT((gEntries[0].event == U_LOG_RAM_EVENT_USER_2) &&
+                       (gEntries[0].parameter == 0));
+    U_PORT_TEST_ASSERT(gEntries[U_LOG_RAM_ENTRIES_MAX_NUM - 1].parameter ==
+                       U_LOG_RAM_ENTRIES_MAX_NUM - 1);
+
+    uLogRamDeinit();
+    U_PORT_TEST_ASSERT(uLogRamExport(exportCallback,
+                                     &capacity) == (int32_t) U_ERROR_COMMON_NOT_INITIALISED);
+
+    // Check that we haven't leaked any heap
+    U_PORT_TEST_ASSERT(uPortHeapAllocCount() == heapAllocCount);
+}
+
+// End of file
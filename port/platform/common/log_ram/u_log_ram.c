@@ -34,11 +34,13 @@
 #include "string.h"    // memcpy()/memset()
 
 #include "u_cfg_sw.h"
+#include "u_error_common.h"
 
 #include "u_port.h"
 #include "u_port_os.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
+#include "u_port_atomic.h"
 
 #include "u_log_ram.h"
 #include "u_log_ram_enum.h"
@@ -48,6 +50,10 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** The magic word at the start of a valid context.
+ */
+#define U_LOG_RAM_MAGIC_WORD 0x123456
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -64,7 +70,7 @@ static uLogRamContext_t *gpContext = NULL;
  */
 static bool gContextMalloced = false;
 
-/** Mutex to arbitrate logging.
+/** Mutex to arbitrate reading the log; uLogRam() does not use it.
  */
 static uPortMutexHandle_t gMutex = NULL;
 
@@ -72,19 +78,75 @@ static uPortMutexHandle_t gMutex = NULL;
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Read a uint32_t atomically.
+static uint32_t atomicLoadU32(const volatile uint32_t *pValue)
+{
+    return (uint32_t) uPortAtomicLoad((const volatile int32_t *) pValue);
+}
+
+// Write a uint32_t atomically.
+static void atomicStoreU32(volatile uint32_t *pValue, uint32_t value)
+{
+    uPortAtomicStore((volatile int32_t *) pValue, (int32_t) value);
+}
+
 // Print a single item from a log.
 static void printItem(const uLogRamEntry_t *pItem, size_t itemIndex)
 {
     if (pItem->event > gULogRamNumStrings) {
-        uPortLog("%10d: out of range event at entry %u (%u when max is %d).\n",
+        uPortLog("%10u: out of range event at entry %u (%u when max is %d).\n",
                  pItem->timestamp, itemIndex, pItem->event, gULogRamNumStrings);
     } else {
-        uPortLog("%10d: [%3u] %s %d (%#x)\n",  pItem->timestamp,
+        uPortLog("%10u: [%3u] %s %d (%#x)\n",  pItem->timestamp,
                  pItem->event, gULogRamString[pItem->event],
                  pItem->parameter, pItem->parameter);
     }
 }
 
+#ifndef U_LOG_RAM_PRINT_ONLY
+
+// Copy the entry with the given sequence number out of the log.
+// Returns 1 if the entry was copied, 0 if it has been reserved
+// but not yet filled in by uLogRam() and -1 if it has been, or
+// is being, overwritten.  Writers are never held up: instead
+// the write count is checked after the copy in case a writer
+// has, in the meantime, reserved the same entry again.
+static int32_t entryRead(uint32_t sequence, uLogRamEntry_t *pEntry)
+{
+    const uLogRamEntry_t *pSlot = gpContext->pLog + (sequence % U_LOG_RAM_ENTRIES_MAX_NUM);
+    int32_t result = -1;
+
+    if (atomicLoadU32(&(gpContext->writeCount)) - sequence <= U_LOG_RAM_ENTRIES_MAX_NUM) {
+        uPortAtomicBarrier();
+        memcpy(pEntry, pSlot, sizeof(*pEntry));
+        uPortAtomicBarrier();
+        if (atomicLoadU32(&(gpContext->writeCount)) - sequence <= U_LOG_RAM_ENTRIES_MAX_NUM) {
+            // uLogRam() writes the sequence number last
+            result = 0;
+            if (pEntry->sequence == sequence) {
+                result = 1;
+            }
+        }
+    }
+
+    return result;
+}
+
+// Return the sequence number of the oldest entry that may still be
+// in the log, given the write count.
+static uint32_t oldestSequence(uint32_t writeCount)
+{
+    uint32_t sequence = gpContext->readCount;
+
+    if (writeCount - sequence > U_LOG_RAM_ENTRIES_MAX_NUM) {
+        sequence = writeCount - U_LOG_RAM_ENTRIES_MAX_NUM;
+    }
+
+    return sequence;
+}
+
+#endif // #ifndef U_LOG_RAM_PRINT_ONLY
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -102,27 +164,25 @@ bool uLogRamInit(void *pBuffer)
     if (gMutex != NULL) {
         if (pBuffer == NULL) {
             pBuffer = pUPortMalloc(U_LOG_RAM_STORE_SIZE);
-            memset(pBuffer, 0, U_LOG_RAM_STORE_SIZE);
-            gContextMalloced = true;
+            if (pBuffer != NULL) {
+                memset(pBuffer, 0, U_LOG_RAM_STORE_SIZE);
+                gContextMalloced = true;
+            }
         }
         if (pBuffer != NULL) {
             gpContext = (uLogRamContext_t *) pBuffer;
         }
         if (gpContext != NULL) {
             // If the context is uninitialised, initialise it
-            if ((gpContext->magicWord != 0x123456) ||
+            if ((gpContext->magicWord != U_LOG_RAM_MAGIC_WORD) ||
                 (gpContext->version != U_LOG_RAM_VERSION)) {
                 freshStart = true;
                 memset(gpContext, 0, sizeof(*gpContext));
                 gpContext->version = U_LOG_RAM_VERSION;
-                gpContext->pLog = (uLogRamEntry_t * ) ((char *) pBuffer + sizeof(*gpContext));
-                gpContext->pLogNextEmpty = gpContext->pLog;
-                gpContext->pLogFirstFull = gpContext->pLog;
-                gpContext->numLogItems = 0;
-                gpContext->logEntriesOverwritten = 0;
-                gpContext->lastLogTime = uPortGetTickTimeMs();
-                gpContext->magicWord = 0x123456;
+                gpContext->magicWord = U_LOG_RAM_MAGIC_WORD;
             }
+            // The buffer may have moved since a reset
+            gpContext->pLog = (uLogRamEntry_t *) ((char *) pBuffer + sizeof(*gpContext));
 
             if (freshStart) {
                 uLogRam(U_LOG_RAM_EVENT_START, U_LOG_RAM_VERSION);
@@ -162,100 +222,119 @@ void uLogRamDeinit()
 // Log an event plus parameter.
 void uLogRam(uLogRamEvent_t event, int32_t parameter)
 {
-    int32_t timestamp = uPortGetTickTimeMs();
-
-    if ((gpContext != NULL) && (gpContext->pLogNextEmpty)) {
-        // Check if the timestamp has wrapped and
-        // insert a log point before this one if that's the
-        // case (coding gods: please excuse my recursion)
-        if (timestamp < gpContext->lastLogTime) {
-            gpContext->lastLogTime = timestamp;
-            uLogRam(U_LOG_RAM_EVENT_TIME_WRAP, timestamp);
-        }
-        gpContext->lastLogTime = timestamp;
-        gpContext->pLogNextEmpty->timestamp = timestamp;
-        gpContext->pLogNextEmpty->event = (uint32_t) event;
-        gpContext->pLogNextEmpty->parameter = parameter;
-#if defined(U_LOG_RAM_PRINT) || defined(U_LOG_RAM_PRINT_ONLY)
-        printItem(gpContext->pLogNextEmpty, 0);
-#endif
+    uLogRamContext_t *pContext = gpContext;
+    uint32_t timestamp;
+    uint32_t sequence = 0;
 #ifndef U_LOG_RAM_PRINT_ONLY
-        if (gpContext->pLogNextEmpty < gpContext->pLog + U_LOG_RAM_ENTRIES_MAX_NUM - 1) {
-            gpContext->pLogNextEmpty++;
-        } else {
-            gpContext->pLogNextEmpty = gpContext->pLog;
-        }
+    uLogRamEntry_t *pEntry;
+#endif
 
-        if (gpContext->pLogNextEmpty == gpContext->pLogFirstFull) {
-            // Logging has wrapped, so move the
-            // first pointer on to reflect the
-            // overwrite
-            if (gpContext->pLogFirstFull < gpContext->pLog + U_LOG_RAM_ENTRIES_MAX_NUM - 1) {
-                gpContext->pLogFirstFull++;
-            } else {
-                gpContext->pLogFirstFull = gpContext->pLog;
-            }
-            gpContext->logEntriesOverwritten++;
-        } else {
-            gpContext->numLogItems++;
-        }
+    if (pContext != NULL) {
+        timestamp = U_LOG_RAM_TIMESTAMP_US();
+#ifndef U_LOG_RAM_PRINT_ONLY
+        // Reserve an entry: no-one else will now write to it
+        // until the log has gone all the way round
+        sequence = (uint32_t) uPortAtomicFetchAdd((volatile int32_t *) & (pContext->writeCount), 1);
+        pEntry = pContext->pLog + (sequence % U_LOG_RAM_ENTRIES_MAX_NUM);
+        pEntry->timestamp = timestamp;
+        pEntry->event = (uint32_t) event;
+        pEntry->parameter = parameter;
+        // Write the sequence number last, with a barrier, since
+        // this is what tells a reader that the entry is complete
+        atomicStoreU32(&(pEntry->sequence), sequence);
 #endif
+#if defined(U_LOG_RAM_PRINT) || defined(U_LOG_RAM_PRINT_ONLY)
+        uLogRamEntry_t entry = {timestamp, (uint32_t) event, parameter, sequence};
+        printItem(&entry, 0);
+#endif
+        (void) sequence;
     }
 }
 
-// Log an event plus parameter, this time with mutex protection.
+// Log an event plus parameter: uLogRam() is safe to call from
+// anywhere so there is nothing more to do.
 void uLogRamX(uLogRamEvent_t event, int32_t parameter)
 {
-    if (gMutex != NULL) {
-
-        U_PORT_MUTEX_LOCK(gMutex);
-
-        uLogRam(event, parameter);
-
-        U_PORT_MUTEX_UNLOCK(gMutex);
-    }
+    uLogRam(event, parameter);
 }
 
 // Get the first N RAM log entries.
 size_t uLogRamGet(uLogRamEntry_t *pEntries, size_t numEntries)
 {
-    const uLogRamEntry_t *pItem;
     size_t itemCount = 0;
+#ifndef U_LOG_RAM_PRINT_ONLY
+    uint32_t writeCount;
+    uint32_t sequence;
+    uLogRamEntry_t entry;
+    int32_t result = 1;
 
     if ((gpContext != NULL) && (gMutex != NULL)) {
 
         U_PORT_MUTEX_LOCK(gMutex);
 
-        pItem = gpContext->pLogFirstFull;
-        while ((pItem != gpContext->pLogNextEmpty) &&
-               (itemCount < numEntries)) {
-            if (gpContext->logEntriesOverwritten > 0) {
-                uLogRamEntry_t insert = {pItem->timestamp,
-                                         U_LOG_RAM_EVENT_ENTRIES_OVERWRITTEN,
-                                         (int32_t) gpContext->logEntriesOverwritten
-                                        };
-                memcpy(pEntries, &insert, sizeof(*pEntries));
-                itemCount++;
-                pEntries++;
-                gpContext->logEntriesOverwritten = 0;
+        // Stop at the end of the log or at an entry that has been
+        // reserved but not yet filled in: the uLogRam() call that
+        // reserved it may have been pre-empted by this task, so
+        // waiting for it here could wait forever; the entry will
+        // be picked up, from readCount, next time
+        while ((itemCount < numEntries) && (result > 0)) {
+            writeCount = atomicLoadU32(&(gpContext->writeCount));
+            sequence = oldestSequence(writeCount);
+            gpContext->logEntriesOverwritten += sequence - gpContext->readCount;
+            gpContext->readCount = sequence;
+            result = -1;
+            if (sequence != writeCount) {
+                result = entryRead(sequence, &entry);
             }
-            if (itemCount < numEntries) {
-                memcpy(pEntries, pItem, sizeof(*pEntries));
-                itemCount++;
-                pEntries++;
-                pItem++;
-                if (gpContext->numLogItems > 0) {
-                    gpContext->numLogItems--;
+            if (result > 0) {
+                if (gpContext->logEntriesOverwritten > 0) {
+                    uLogRamEntry_t insert = {entry.timestamp,
+                                             U_LOG_RAM_EVENT_ENTRIES_OVERWRITTEN,
+                                             (int32_t) gpContext->logEntriesOverwritten,
+                                             sequence
+                                            };
+                    memcpy(pEntries, &insert, sizeof(*pEntries));
+                    itemCount++;
+                    pEntries++;
+                    gpContext->logEntriesOverwritten = 0;
+                }
+                // Timestamps from different tasks may be a little out of
+                // order, a wrap is when they go back a long way
+                if ((itemCount < numEntries) &&
+                    (entry.timestamp < gpContext->lastTimestamp) &&
+                    (gpContext->lastTimestamp - entry.timestamp > 0x80000000U)) {
+                    uLogRamEntry_t insert = {entry.timestamp,
+                                             U_LOG_RAM_EVENT_TIME_WRAP,
+                                             (int32_t) entry.timestamp,
+                                             sequence
+                                            };
+                    memcpy(pEntries, &insert, sizeof(*pEntries));
+                    itemCount++;
+                    pEntries++;
+                    gpContext->lastTimestamp = entry.timestamp;
                 }
-                if (pItem >= gpContext->pLog + U_LOG_RAM_ENTRIES_MAX_NUM) {
-                    pItem = gpContext->pLog;
+                if (itemCount < numEntries) {
+                    memcpy(pEntries, &entry, sizeof(*pEntries));
+                    itemCount++;
+                    pEntries++;
+                    gpContext->lastTimestamp = entry.timestamp;
+                    gpContext->readCount++;
                 }
-                gpContext->pLogFirstFull = pItem;
+            } else if ((result < 0) && (sequence != writeCount)) {
+                // Overwritten while we were reading it, count
+                // it as lost and carry on
+                gpContext->logEntriesOverwritten++;
+                gpContext->readCount++;
+                result = 1;
             }
         }
 
         U_PORT_MUTEX_UNLOCK(gMutex);
     }
+#else
+    (void) pEntries;
+    (void) numEntries;
+#endif
 
     return itemCount;
 }
@@ -264,15 +343,19 @@ size_t uLogRamGet(uLogRamEntry_t *pEntries, size_t numEntries)
 size_t uLogRamGetNumEntries()
 {
     size_t numLogItems = 0;
+#ifndef U_LOG_RAM_PRINT_ONLY
+    uint32_t writeCount;
 
     if ((gpContext != NULL) && (gMutex != NULL)) {
 
         U_PORT_MUTEX_LOCK(gMutex);
 
-        numLogItems = gpContext->numLogItems;
+        writeCount = atomicLoadU32(&(gpContext->writeCount));
+        numLogItems = writeCount - oldestSequence(writeCount);
 
         U_PORT_MUTEX_UNLOCK(gMutex);
     }
+#endif
 
     return numLogItems;
 }
@@ -280,8 +363,11 @@ size_t uLogRamGetNumEntries()
 // Print out the log.
 void uLogRamPrint()
 {
-    const uLogRamEntry_t *pItem;
+#ifndef U_LOG_RAM_PRINT_ONLY
+    uint32_t writeCount;
+    uLogRamEntry_t entry;
     size_t x = 0;
+    size_t lostCount = 0;
 
     if (gpContext != NULL) {
 
@@ -291,13 +377,18 @@ void uLogRamPrint()
 
         uPortLog("------------- uLogRam starts -------------\n");
         // Print the log items from RAM
-        pItem = gpContext->pLogFirstFull;
-        while (pItem != gpContext->pLogNextEmpty) {
-            printItem(pItem, x);
-            x++;
-            pItem++;
-            if (pItem >= gpContext->pLog + U_LOG_RAM_ENTRIES_MAX_NUM) {
-                pItem = gpContext->pLog;
+        writeCount = atomicLoadU32(&(gpContext->writeCount));
+        for (uint32_t sequence = oldestSequence(writeCount);
+             sequence != writeCount; sequence++) {
+            if (entryRead(sequence, &entry) > 0) {
+                if (lostCount > 0) {
+                    uPortLog("%u entries lost.\n", lostCount);
+                    lostCount = 0;
+                }
+                printItem(&entry, x);
+                x++;
+            } else {
+                lostCount++;
             }
         }
         uPortLog("-------------- uLogRam ends --------------\n");
@@ -306,6 +397,64 @@ void uLogRamPrint()
             U_PORT_MUTEX_UNLOCK(gMutex);
         }
     }
+#endif
+}
+
+// Export the log in binary form.
+int32_t uLogRamExport(uLogRamExportCallback_t pCallback, void *pCallbackParam)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+#ifndef U_LOG_RAM_PRINT_ONLY
+    uLogRamExportHeader_t header;
+    uint32_t writeCount;
+    uint32_t sequence;
+    uLogRamEntry_t entry;
+    int32_t result;
+
+    if ((gpContext == NULL) || (gMutex == NULL)) {
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    } else if (pCallback != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        // Take a snapshot of where the log has got to
+        writeCount = atomicLoadU32(&(gpContext->writeCount));
+        sequence = oldestSequence(writeCount);
+        header.magic = U_LOG_RAM_EXPORT_MAGIC;
+        header.version = U_LOG_RAM_VERSION;
+        header.entrySizeBytes = sizeof(uLogRamEntry_t);
+        header.numEntries = writeCount - sequence;
+        header.timestampUnitUs = 1;
+        errorCodeOrCount = pCallback((const char *) &header, sizeof(header),
+                                     pCallbackParam);
+        for (; (sequence != writeCount) && (errorCodeOrCount == 0); sequence++) {
+            result = entryRead(sequence, &entry);
+            if (result <= 0) {
+                // The number of entries is already out so put in a
+                // place-holder, which will at least keep its place
+                // in the sequence
+                entry.timestamp = 0;
+                entry.event = (result < 0) ? U_LOG_RAM_EVENT_ENTRIES_OVERWRITTEN :
+                              U_LOG_RAM_EVENT_NONE;
+                entry.parameter = 1;
+                entry.sequence = sequence;
+            }
+            errorCodeOrCount = pCallback((const char *) &entry, sizeof(entry),
+                                         pCallbackParam);
+        }
+        if (errorCodeOrCount == 0) {
+            errorCodeOrCount = (int32_t) header.numEntries;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+#else
+    (void) pCallback;
+    (void) pCallbackParam;
+    errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+#endif
+
+    return errorCodeOrCount;
 }
 
 // End of file
@@ -30,10 +30,16 @@
 /** @file
  * @brief This logging utility allows events to be logged to RAM at minimal
  * run-time cost.  Each entry includes an event, a 32 bit parameter (which
- * is printed with the event) and a millisecond time-stamp.  This code
- * is not multithreaded in that there can only be a single log buffer
- * at any one time, however the functions, aside from uLogRam(),
- * are mutex-protected.
+ * is printed with the event) and a microsecond time-stamp.  There can
+ * only be a single log buffer at any one time.
+ *
+ * uLogRam() takes no lock: it reserves an entry with a single atomic
+ * fetch-and-add and fills it in, so it may be called from any task
+ * or interrupt at once without the logging perturbing the timing
+ * being observed.  The functions that read the log are mutex-protected
+ * among themselves and never hold up uLogRam(): an entry that is
+ * overwritten while being read is counted as lost rather than being
+ * returned mangled.
  */
 
 #ifdef __cplusplus
@@ -50,18 +56,38 @@ extern "C" {
 # define U_LOG_RAM_ENTRIES_MAX_NUM 500
 #endif
 
+#ifndef U_LOG_RAM_TIMESTAMP_US
+/** Return the current time in microseconds as a uint32_t; this is
+ * called by uLogRam() for every entry.  By default it is derived
+ * from uPortGetTickTimeMs() and so has a resolution of one
+ * millisecond: where a finer time-base is available, e.g. a cycle
+ * counter or a free-running hardware timer, override this to use it;
+ * it must be callable from interrupt context.
+ */
+# define U_LOG_RAM_TIMESTAMP_US() ((uint32_t) uPortGetTickTimeMs() * 1000U)
+#endif
+
+/** The first word of the output of uLogRamExport(), "ULRM" when
+ * read as bytes on a little-endian target.
+ */
+#define U_LOG_RAM_EXPORT_MAGIC 0x4d524c55
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
-/** An entry in the log.
+/** An entry in the log; this is also the format of each entry
+ * in the output of uLogRamExport().
  */
 typedef struct {
-    int32_t timestamp;
+    uint32_t timestamp; /**< in microseconds, see #U_LOG_RAM_TIMESTAMP_US. */
     uint32_t event; // This will be #uLogRamEvent_t but it is stored as an int
     // so that we are guaranteed to get a 32-bit value,
     // making it easier to decode logs on another platform
     int32_t parameter;
+    uint32_t sequence; /**< the number of entries logged before this one;
+                            a gap in the sequence means that entries
+                            were lost. */
 } uLogRamEntry_t;
 
 
@@ -71,13 +97,41 @@ typedef struct {
     uint32_t magicWord;
     int32_t version;
     uLogRamEntry_t *pLog;
-    uLogRamEntry_t *pLogNextEmpty;
-    uLogRamEntry_t const *pLogFirstFull;
-    size_t numLogItems;
-    size_t logEntriesOverwritten;
-    int32_t lastLogTime;
+    volatile uint32_t writeCount; /**< the number of entries ever
+                                       reserved by uLogRam(). */
+    uint32_t readCount; /**< the sequence number of the oldest
+                             entry not yet removed by uLogRamGet(). */
+    uint32_t logEntriesOverwritten; /**< entries lost since last
+                                         reported by uLogRamGet(). */
+    uint32_t lastTimestamp; /**< for uLogRamGet() to spot a wrap. */
 } uLogRamContext_t;
 
+/** The header at the start of the output of uLogRamExport(); it is
+ * followed by numEntries of #uLogRamEntry_t, oldest first, all in
+ * the byte order of the target (little-endian on all of the MCUs
+ * that ubxlib supports).  The events may be decoded with
+ * u_log_ram_enum.h of the matching version.
+ */
+typedef struct {
+    uint32_t magic;  /**< #U_LOG_RAM_EXPORT_MAGIC. */
+    uint32_t version; /**< #U_LOG_RAM_VERSION. */
+    uint32_t entrySizeBytes; /**< sizeof(#uLogRamEntry_t). */
+    uint32_t numEntries; /**< the number of entries that follow. */
+    uint32_t timestampUnitUs; /**< the unit of the timestamp of an entry,
+                                   in microseconds; currently always 1. */
+} uLogRamExportHeader_t;
+
+/** The function that uLogRamExport() calls to write the log.
+ *
+ * @param[in] pData           the data to write.
+ * @param size                the number of bytes at pData.
+ * @param[in] pCallbackParam  the parameter passed to uLogRamExport().
+ * @return                    zero on success, else negative error
+ *                            code, which will stop the export.
+ */
+typedef int32_t (*uLogRamExportCallback_t)(const char *pData, size_t size,
+                                           void *pCallbackParam);
+
 /** The size of the log store, given the number of entries requested.
  */
 #define U_LOG_RAM_STORE_SIZE (sizeof(uLogRamContext_t) + (sizeof(uLogRamEntry_t) * U_LOG_RAM_ENTRIES_MAX_NUM))
@@ -102,17 +156,18 @@ bool uLogRamInit(void *pBuffer);
  */
 void uLogRamDeinit();
 
-/** Log an event plus parameter to RAM.
+/** Log an event plus parameter to RAM.  This takes no lock and may be
+ * called from any task or from interrupt context: it costs an atomic
+ * increment, a call to #U_LOG_RAM_TIMESTAMP_US and four stores.
  *
  * @param event     the event.
  * @param parameter the parameter.
  */
 void uLogRam(uLogRamEvent_t event, int32_t parameter);
 
-/** Log an event plus parameter to RAM, employing a mutex to protect the
- * log contents.  This will take longer, potentially a lot longer,
- * than uLogRam() so call this only in applications where you don't
- * care about speed.
+/** Log an event plus parameter to RAM; this used to be the
+ * mutex-protected version of uLogRam() but, since uLogRam() is now
+ * safe to call from anywhere, it is simply the same as uLogRam().
  *
  * @param event     the event.
  * @param parameter the parameter.
@@ -136,6 +191,21 @@ size_t uLogRamGetNumEntries();
  */
 void uLogRamPrint();
 
+/** Export the log entries that are in RAM, in binary, without removing
+ * them from the log storage: a #uLogRamExportHeader_t is written
+ * followed by the entries, oldest first.  The output may be captured
+ * and decoded off-target.  Entries that are logged while the export
+ * is in progress are not included.
+ *
+ * @param[in] pCallback       the function to write the data with,
+ *                            called with the header and then with
+ *                            each entry; cannot be NULL.
+ * @param[in] pCallbackParam  passed to pCallback as its last parameter.
+ * @return                    the number of entries exported, else
+ *                            negative error code.
+ */
+int32_t uLogRamExport(uLogRamExportCallback_t pCallback, void *pCallbackParam);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,7 +37,7 @@ extern "C" {
 
 /** Increment this variable if you make any changes to the enum below.
  */
-#define U_LOG_RAM_VERSION 0
+#define U_LOG_RAM_VERSION 2
 
 /* ----------------------------------------------------------------
  * TYPES
@@ -55,6 +55,10 @@ typedef enum {
     U_LOG_RAM_EVENT_STOP,
     U_LOG_RAM_EVENT_ENTRIES_OVERWRITTEN,
     U_LOG_RAM_EVENT_TIME_WRAP,
+    // Log points required by u_log_ram_trace.h, do not change;
+    // the parameter is a uLogRamTraceId_t
+    U_LOG_RAM_EVENT_TRACE_BEGIN,
+    U_LOG_RAM_EVENT_TRACE_END,
     // Generic log points
     U_LOG_RAM_EVENT_USER_0,
     U_LOG_RAM_EVENT_USER_1,
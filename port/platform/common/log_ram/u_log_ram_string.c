@@ -42,6 +42,8 @@ const char *gULogRamString[] = {
     "  STOP",
     "* ENTRIES_OVERWRITTEN",
     "  TIME_WRAP",
+    "  TRACE_BEGIN",
+    "  TRACE_END",
     // Generic user log points, do not change
     "  USER_0",
     "  USER_1",
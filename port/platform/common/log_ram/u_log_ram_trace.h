@@ -0,0 +1,99 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_LOG_RAM_TRACE_H_
+#define _U_LOG_RAM_TRACE_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#ifdef U_CFG_LOG_RAM_TRACE
+# include "stdint.h"
+# include "stdbool.h"
+# include "u_log_ram.h"
+#endif
+
+/** @file
+ * @brief Tracepoints: spans of time, marked by a begin and an end
+ * carrying the same ID, logged through u_log_ram.h.  Unlike
+ * uLogRam() itself, tracepoints may be left in core ubxlib code
+ * since they compile to nothing unless U_CFG_LOG_RAM_TRACE is
+ * defined.  When it is, each #U_LOG_RAM_TRACE_BEGIN() or
+ * #U_LOG_RAM_TRACE_END() is a single call to uLogRam(), with the
+ * event #U_LOG_RAM_EVENT_TRACE_BEGIN or #U_LOG_RAM_EVENT_TRACE_END
+ * and the trace ID as the parameter; the application must still
+ * call uLogRamInit() for anything to be logged.
+ *
+ * The output of uLogRamExport() may be converted into Chrome trace
+ * JSON format, for viewing in chrome://tracing or Perfetto, with
+ * the host script u_log_ram_trace.py.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifdef U_CFG_LOG_RAM_TRACE
+/** Mark the start of a span with the given #uLogRamTraceId_t.
+ */
+# define U_LOG_RAM_TRACE_BEGIN(id) uLogRam(U_LOG_RAM_EVENT_TRACE_BEGIN, (int32_t) (id))
+
+/** Mark the end of a span with the given #uLogRamTraceId_t.
+ */
+# define U_LOG_RAM_TRACE_END(id) uLogRam(U_LOG_RAM_EVENT_TRACE_END, (int32_t) (id))
+#else
+# define U_LOG_RAM_TRACE_BEGIN(id)
+# define U_LOG_RAM_TRACE_END(id)
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The IDs of the spans that are traced; if you change this, don't
+ * forget to increment #U_LOG_RAM_VERSION in u_log_ram_enum.h.
+ */
+typedef enum {
+    U_LOG_RAM_TRACE_ID_NONE = 0,
+    U_LOG_RAM_TRACE_ID_AT_CLIENT_BUFFER_FILL, /**< bufferFill() in u_at_client.c. */
+    U_LOG_RAM_TRACE_ID_AT_CLIENT_PROCESS_RESPONSE, /**< processResponse() in
+                                                        u_at_client.c. */
+    U_LOG_RAM_TRACE_ID_CELL_MUX_DECODE, /**< cmuxDecode() in u_cell_mux.c. */
+    U_LOG_RAM_TRACE_ID_EDM_EVENT, /**< processEdmEvent() in
+                                       u_short_range_edm_stream.c. */
+    U_LOG_RAM_TRACE_ID_GNSS_MSG_RECEIVE, /**< a message being handled by
+                                              msgReceiveTask() in u_gnss_msg.c. */
+    U_LOG_RAM_TRACE_ID_SOCK_RECEIVE, /**< receive() in u_sock.c. */
+    // Generic trace IDs for the application
+    U_LOG_RAM_TRACE_ID_USER_0,
+    U_LOG_RAM_TRACE_ID_USER_1,
+    U_LOG_RAM_TRACE_ID_USER_2,
+    U_LOG_RAM_TRACE_ID_USER_3
+} uLogRamTraceId_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_LOG_RAM_TRACE_H_
+
+// End of file
@@ -0,0 +1,175 @@
+#!/usr/bin/env python
+
+'''Convert the output of uLogRamExport() into Chrome trace JSON.'''
+
+import os
+import re
+import sys # For exit() and stderr
+import json
+import struct
+import argparse
+
+# This script reads the binary output of uLogRamExport(), which
+# is a uLogRamExportHeader_t followed by a number of uLogRamEntry_t,
+# and writes it out in the JSON format understood by chrome://tracing
+# and by Perfetto (https://ui.perfetto.dev).
+#
+# It works like this:
+#
+# 1. Reads the names of the events from the enum uLogRamEvent_t in
+#    u_log_ram_enum.h (and the u_log_ram_enum_user.h that it
+#    #includes) and the names of the trace IDs from the enum
+#    uLogRamTraceId_t in u_log_ram_trace.h; by default these are
+#    taken from the directory this script is in but they must match
+#    the U_LOG_RAM_VERSION of the target that exported the log, so
+#    point it at the right ones if they differ.
+#
+# 2. Pairs each U_LOG_RAM_EVENT_TRACE_END with the most recent
+#    unmatched U_LOG_RAM_EVENT_TRACE_BEGIN carrying the same trace ID,
+#    so that nested spans come out right, writing a "complete" event
+#    for the span on a row of its own for that trace ID.
+#
+# 3. Writes any other log entry as an "instant" event, with the
+#    parameter as an argument.
+#
+# Timestamps are in microseconds and wrap at 32 bits; the wrap is
+# undone here so that the trace runs on from start to finish.
+
+# The magic word at the start of the output of uLogRamExport()
+EXPORT_MAGIC = 0x4d524c55
+
+# The format of uLogRamExportHeader_t, little-endian
+HEADER_FORMAT = "<IIIII"
+
+# The format of the start of uLogRamEntry_t, little-endian
+ENTRY_FORMAT = "<IIiI"
+
+def enum_read(file_path, enum_name, include_dir):
+    '''Return a dictionary of the names in the given enum, keyed by value'''
+    names = {}
+    with open(file_path, "r", encoding="utf8") as file:
+        text = file.read()
+    match = re.search(r"typedef\s+enum\s*{(.*?)}\s*" + enum_name + r"\s*;",
+                      text, re.DOTALL)
+    if not match:
+        print(f"Cannot find enum {enum_name} in {file_path}.", file=sys.stderr)
+        sys.exit(1)
+    body = match.group(1)
+    # Bring in any #included files, e.g. u_log_ram_enum_user.h
+    for include in re.findall(r'#include\s+"([^"]+)"', body):
+        with open(os.path.join(include_dir, include), "r", encoding="utf8") as file:
+            body = body.replace(f'#include "{include}"', "," + file.read() + ",")
+    # Remove comments
+    body = re.sub(r"/\*.*?\*/", "", body, flags=re.DOTALL)
+    body = re.sub(r"//[^\n]*", "", body)
+    value = 0
+    for item in body.split(","):
+        item = item.strip()
+        if item:
+            if "=" in item:
+                name, item_value = item.split("=")
+                item = name.strip()
+                value = int(item_value.strip(), 0)
+            names[value] = item
+            value += 1
+    return names
+
+def main(input_path, output_path, enum_dir):
+    '''Do the conversion'''
+    events = enum_read(os.path.join(enum_dir, "u_log_ram_enum.h"),
+                       "uLogRamEvent_t", enum_dir)
+    trace_ids = enum_read(os.path.join(enum_dir, "u_log_ram_trace.h"),
+                          "uLogRamTraceId_t", enum_dir)
+    event_values = {name: value for value, name in events.items()}
+    trace_begin = event_values["U_LOG_RAM_EVENT_TRACE_BEGIN"]
+    trace_end = event_values["U_LOG_RAM_EVENT_TRACE_END"]
+
+    with open(input_path, "rb") as file:
+        data = file.read()
+    header_size = struct.calcsize(HEADER_FORMAT)
+    if len(data) < header_size:
+        print(f"{input_path} is too short.", file=sys.stderr)
+        sys.exit(1)
+    magic, version, entry_size, num_entries, unit_us = struct.unpack_from(HEADER_FORMAT,
+                                                                          data, 0)
+    if magic != EXPORT_MAGIC:
+        print(f"{input_path} is not the output of uLogRamExport() (magic 0x{magic:08x}).",
+              file=sys.stderr)
+        sys.exit(1)
+    print(f"Log version {version}, {num_entries} entries.", file=sys.stderr)
+
+    trace_events = []
+    open_spans = {}
+    wrap_offset = 0
+    last_timestamp = None
+    last_sequence = None
+    offset = header_size
+    for _ in range(num_entries):
+        if offset + entry_size > len(data):
+            print("Log is truncated.", file=sys.stderr)
+            break
+        timestamp, event, parameter, sequence = struct.unpack_from(ENTRY_FORMAT,
+                                                                   data, offset)
+        offset += entry_size
+        if (last_sequence is not None) and (sequence != (last_sequence + 1) & 0xFFFFFFFF):
+            print(f"{(sequence - last_sequence - 1) & 0xFFFFFFFF} entries lost"
+                  f" before sequence number {sequence}.", file=sys.stderr)
+        last_sequence = sequence
+        if (last_timestamp is not None) and (timestamp < last_timestamp) and \
+           (last_timestamp - timestamp > 0x80000000):
+            wrap_offset += 0x100000000
+        last_timestamp = timestamp
+        time_us = (timestamp + wrap_offset) * unit_us
+        if event == trace_begin:
+            open_spans.setdefault(parameter, []).append(time_us)
+        elif event == trace_end:
+            if open_spans.get(parameter):
+                start_us = open_spans[parameter].pop()
+                trace_events.append({"name": trace_ids.get(parameter, str(parameter)),
+                                     "ph": "X", "ts": start_us,
+                                     "dur": time_us - start_us,
+                                     "pid": 0, "tid": parameter})
+            else:
+                print(f"End of trace ID {parameter} at {time_us} us without a begin.",
+                      file=sys.stderr)
+        else:
+            trace_events.append({"name": events.get(event, str(event)),
+                                 "ph": "i", "s": "g", "ts": time_us,
+                                 "pid": 0, "tid": 0,
+                                 "args": {"parameter": parameter}})
+    for parameter, starts in open_spans.items():
+        if starts:
+            print(f"{len(starts)} span(s) of trace ID {parameter} never ended.",
+                  file=sys.stderr)
+
+    # Name the rows; row 0, which would be U_LOG_RAM_TRACE_ID_NONE,
+    # is used for everything that is not a span
+    for value, name in trace_ids.items():
+        if value != 0:
+            trace_events.append({"name": "thread_name", "ph": "M", "pid": 0,
+                                 "tid": value, "args": {"name": name}})
+    trace_events.append({"name": "thread_name", "ph": "M", "pid": 0,
+                         "tid": 0, "args": {"name": "log"}})
+
+    output = json.dumps({"traceEvents": trace_events, "displayTimeUnit": "ms"},
+                        indent=1)
+    if output_path:
+        with open(output_path, "w", encoding="utf8") as file:
+            file.write(output)
+    else:
+        print(output)
+
+if __name__ == "__main__":
+    PARSER = argparse.ArgumentParser(description="A script to convert the"  \
+                                     " binary output of uLogRamExport()"    \
+                                     " into Chrome trace JSON format.")
+    PARSER.add_argument("input", help="the file containing the output of"  \
+                        " uLogRamExport().")
+    PARSER.add_argument("-o", "--output", help="the file to write the JSON"\
+                        " to; if not given the JSON is written to stdout.")
+    PARSER.add_argument("-e", "--enum_dir", default=os.path.dirname(os.path.abspath(__file__)),
+                        help="the directory containing the u_log_ram_enum.h"\
+                        " and u_log_ram_trace.h matching the target; if not"\
+                        " given the directory of this script is used.")
+    ARGS = PARSER.parse_args()
+    main(ARGS.input, ARGS.output, ARGS.enum_dir)
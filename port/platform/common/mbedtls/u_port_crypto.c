@@ -27,12 +27,15 @@
 #include "stdbool.h"
 
 #include "mbedtls/sha256.h"
+#include "mbedtls/md5.h"
 #include "mbedtls/md.h"
 #include "mbedtls/aes.h"
 
 #include "u_error_common.h"
 
 #include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_port_crypto.h"
 
 /* ----------------------------------------------------------------
@@ -77,6 +80,119 @@ int32_t uPortCryptoSha256(const char *pInput,
     return errorCode;
 }
 
+// Begin a SHA256 calculation on data supplied in pieces.
+int32_t uPortCryptoSha256Init(void **ppContext)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    mbedtls_sha256_context *pContext;
+
+    if (ppContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pContext = (mbedtls_sha256_context *) pUPortMalloc(sizeof(*pContext));
+        if (pContext != NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            // As above, use the forms that return void since
+            // the ones that return int are not present everywhere
+            mbedtls_sha256_init(pContext);
+            mbedtls_sha256_starts(pContext, 0);
+            *ppContext = pContext;
+        }
+    }
+
+    return errorCode;
+}
+
+// Add data to a SHA256 calculation.
+int32_t uPortCryptoSha256Update(void *pContext,
+                                const char *pInput,
+                                size_t inputLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pContext != NULL) && ((pInput != NULL) || (inputLengthBytes == 0))) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        mbedtls_sha256_update((mbedtls_sha256_context *) pContext,
+                              (const unsigned char *) pInput,
+                              inputLengthBytes);
+    }
+
+    return errorCode;
+}
+
+// Complete a SHA256 calculation.
+int32_t uPortCryptoSha256Finish(void *pContext, char *pOutput)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (pContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if (pOutput != NULL) {
+            mbedtls_sha256_finish((mbedtls_sha256_context *) pContext,
+                                  (unsigned char *) pOutput);
+        }
+        mbedtls_sha256_free((mbedtls_sha256_context *) pContext);
+        uPortFree(pContext);
+    }
+
+    return errorCode;
+}
+
+// Begin an MD5 calculation on data supplied in pieces.
+int32_t uPortCryptoMd5Init(void **ppContext)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    mbedtls_md5_context *pContext;
+
+    if (ppContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pContext = (mbedtls_md5_context *) pUPortMalloc(sizeof(*pContext));
+        if (pContext != NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            // As for SHA256, use the forms that return void
+            mbedtls_md5_init(pContext);
+            mbedtls_md5_starts(pContext);
+            *ppContext = pContext;
+        }
+    }
+
+    return errorCode;
+}
+
+// Add data to an MD5 calculation.
+int32_t uPortCryptoMd5Update(void *pContext,
+                             const char *pInput,
+                             size_t inputLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pContext != NULL) && ((pInput != NULL) || (inputLengthBytes == 0))) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        mbedtls_md5_update((mbedtls_md5_context *) pContext,
+                           (const unsigned char *) pInput,
+                           inputLengthBytes);
+    }
+
+    return errorCode;
+}
+
+// Complete an MD5 calculation.
+int32_t uPortCryptoMd5Finish(void *pContext, char *pOutput)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (pContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if (pOutput != NULL) {
+            mbedtls_md5_finish((mbedtls_md5_context *) pContext,
+                               (unsigned char *) pOutput);
+        }
+        mbedtls_md5_free((mbedtls_md5_context *) pContext);
+        uPortFree(pContext);
+    }
+
+    return errorCode;
+}
+
 // Perform a HMAC SHA256 calculation on a block of data.
 int32_t uPortCryptoHmacSha256(const char *pKey,
                               size_t keyLengthBytes,
@@ -94,6 +210,72 @@ int32_t uPortCryptoHmacSha256(const char *pKey,
                            (unsigned char *) pOutput);
 }
 
+// Begin a HMAC SHA256 calculation on data supplied in pieces.
+int32_t uPortCryptoHmacSha256Init(void **ppContext,
+                                  const char *pKey,
+                                  size_t keyLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    const mbedtls_md_info_t *pInfo = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    mbedtls_md_context_t *pContext;
+
+    if ((ppContext != NULL) && (pKey != NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pContext = (mbedtls_md_context_t *) pUPortMalloc(sizeof(*pContext));
+        if (pContext != NULL) {
+            mbedtls_md_init(pContext);
+            errorCode = mbedtls_md_setup(pContext, pInfo, 1);
+            if (errorCode == 0) {
+                errorCode = mbedtls_md_hmac_starts(pContext,
+                                                   (const unsigned char *) pKey,
+                                                   keyLengthBytes);
+            }
+            if (errorCode == 0) {
+                *ppContext = pContext;
+            } else {
+                mbedtls_md_free(pContext);
+                uPortFree(pContext);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Add data to a HMAC SHA256 calculation.
+int32_t uPortCryptoHmacSha256Update(void *pContext,
+                                    const char *pInput,
+                                    size_t inputLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pContext != NULL) && ((pInput != NULL) || (inputLengthBytes == 0))) {
+        errorCode = mbedtls_md_hmac_update((mbedtls_md_context_t *) pContext,
+                                           (const unsigned char *) pInput,
+                                           inputLengthBytes);
+    }
+
+    return errorCode;
+}
+
+// Complete a HMAC SHA256 calculation.
+int32_t uPortCryptoHmacSha256Finish(void *pContext, char *pOutput)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (pContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if (pOutput != NULL) {
+            errorCode = mbedtls_md_hmac_finish((mbedtls_md_context_t *) pContext,
+                                               (unsigned char *) pOutput);
+        }
+        mbedtls_md_free((mbedtls_md_context_t *) pContext);
+        uPortFree(pContext);
+    }
+
+    return errorCode;
+}
+
 // Perform AES 128 CBC encryption of a block of data.
 int32_t uPortCryptoAes128CbcEncrypt(const char *pKey,
                                     size_t keyLengthBytes,
@@ -105,6 +287,9 @@ int32_t uPortCryptoAes128CbcEncrypt(const char *pKey,
     int32_t errorCode;
     mbedtls_aes_context context;
 
+    // Hardware backends (e.g. ESP32, CryptoCell) keep state in
+    // the context so it must be initialised and freed
+    mbedtls_aes_init(&context);
     errorCode = mbedtls_aes_setkey_enc(&context,
                                        (const unsigned char *) pKey,
                                        keyLengthBytes * 8);
@@ -116,6 +301,7 @@ int32_t uPortCryptoAes128CbcEncrypt(const char *pKey,
                                           (const unsigned char *) pInput,
                                           (unsigned char *) pOutput);
     }
+    mbedtls_aes_free(&context);
 
     return errorCode;
 }
@@ -131,6 +317,7 @@ int32_t uPortCryptoAes128CbcDecrypt(const char *pKey,
     int32_t errorCode;
     mbedtls_aes_context context;
 
+    mbedtls_aes_init(&context);
     errorCode = mbedtls_aes_setkey_dec(&context,
                                        (const unsigned char *) pKey,
                                        keyLengthBytes * 8);
@@ -142,6 +329,7 @@ int32_t uPortCryptoAes128CbcDecrypt(const char *pKey,
                                           (const unsigned char *) pInput,
                                           (unsigned char *) pOutput);
     }
+    mbedtls_aes_free(&context);
 
     return errorCode;
 }
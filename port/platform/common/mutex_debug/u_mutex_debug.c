@@ -16,7 +16,8 @@
 
 /** @file
  * @brief This file implements some functions that may be useful
- * when debugging a mutex deadlock.
+ * when debugging a mutex deadlock or finding out which mutex is
+ * the point of contention under load.
  */
 
 #ifdef U_CFG_OVERRIDE
@@ -100,6 +101,15 @@ typedef struct uMutexInfo_t {
     uMutexFunctionInfo_t *pLocker;
     uMutexFunctionInfo_t *pWaiting;
     struct uMutexInfo_t *pNext;
+    // Profiling information from here on
+    int32_t lockCount;
+    int32_t contendedCount; // Number of locks that had to wait.
+    int64_t waitTotalMs;
+    int32_t waitMaxMs;
+    int32_t lockedTimeMs; // When the current locker got the lock.
+    int32_t holdMaxMs;
+    const char *pHoldMaxFile; // The locker that held it for holdMaxMs.
+    int32_t holdMaxLine;
 } uMutexInfo_t;
 
 /* ----------------------------------------------------------------
@@ -182,6 +192,19 @@ static void freeFunctionInformationBlock(uMutexFunctionInfo_t *pFunctionInfo)
     }
 }
 
+// Reset the profiling information of a mutex.
+// gMutexList should be locked before this is called.
+static void profileReset(uMutexInfo_t *pMutexInfo)
+{
+    pMutexInfo->lockCount = 0;
+    pMutexInfo->contendedCount = 0;
+    pMutexInfo->waitTotalMs = 0;
+    pMutexInfo->waitMaxMs = 0;
+    pMutexInfo->holdMaxMs = 0;
+    pMutexInfo->pHoldMaxFile = NULL;
+    pMutexInfo->holdMaxLine = -1;
+}
+
 // Allocate a mutex information block.
 // gMutexList should be locked before this is called.
 static uMutexInfo_t *pAllocMutexInformationBlock()
@@ -197,6 +220,7 @@ static uMutexInfo_t *pAllocMutexInformationBlock()
             pMutexInfo->pWaiting = NULL;
             pMutexInfo->handle = NULL;
             pMutexInfo->pNext = NULL;
+            profileReset(pMutexInfo);
         }
     }
 
@@ -322,11 +346,15 @@ static uMutexFunctionInfo_t *pLockAddWaiting(uMutexInfo_t *pMutexInfo,
     return pWaiting;
 }
 
-// Move a waiting entry to become a locker entry.
+// Move a waiting entry to become a locker entry, recording
+// how long it waited, startTimeMs being when it started waiting
+// and contended being true if it could not get the lock at once.
 static bool lockMoveWaitingToLocker(uMutexInfo_t *pMutexInfo,
-                                    uMutexFunctionInfo_t *pWaiting)
+                                    uMutexFunctionInfo_t *pWaiting,
+                                    int32_t startTimeMs, bool contended)
 {
     bool success = false;
+    int32_t nowMs = uPortGetTickTimeMs();
 
     if ((gMutexList != NULL) && (pMutexInfo != NULL)) {
 
@@ -345,6 +373,15 @@ static bool lockMoveWaitingToLocker(uMutexInfo_t *pMutexInfo,
             pMutexInfo->pLocker->counter = 0;
             // For neatness
             pMutexInfo->pLocker->pNext = NULL;
+            pMutexInfo->lockCount++;
+            if (contended) {
+                pMutexInfo->contendedCount++;
+                pMutexInfo->waitTotalMs += nowMs - startTimeMs;
+                if (nowMs - startTimeMs > pMutexInfo->waitMaxMs) {
+                    pMutexInfo->waitMaxMs = nowMs - startTimeMs;
+                }
+            }
+            pMutexInfo->lockedTimeMs = nowMs;
         }
 
         U_MUTEX_DEBUG_PORT_MUTEX_UNLOCK(gMutexList);
@@ -517,6 +554,8 @@ int32_t uMutexDebugLock(uPortMutexHandle_t mutexHandle,
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uMutexInfo_t *pMutexInfo = (uMutexInfo_t *) mutexHandle;
     uMutexFunctionInfo_t *pWaiting;
+    int32_t startTimeMs;
+    bool contended;
 
     if (gMutexList != NULL) {
 
@@ -527,9 +566,17 @@ int32_t uMutexDebugLock(uPortMutexHandle_t mutexHandle,
         errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
         pWaiting = pLockAddWaiting(pMutexInfo, pFile, line);
         if (pWaiting != NULL) {
-            errorCode = _uPortMutexLock(pMutexInfo->handle);
+            startTimeMs = uPortGetTickTimeMs();
+            // Try without waiting first to find out if there is
+            // any contention
+            contended = (_uPortMutexTryLock(pMutexInfo->handle, 0) != 0);
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (contended) {
+                errorCode = _uPortMutexLock(pMutexInfo->handle);
+            }
             if (errorCode == 0) {
-                if (!lockMoveWaitingToLocker(pMutexInfo, pWaiting)) {
+                if (!lockMoveWaitingToLocker(pMutexInfo, pWaiting,
+                                             startTimeMs, contended)) {
                     lockFreeWaiting(pMutexInfo, pWaiting);
                 }
             } else {
@@ -550,6 +597,8 @@ int32_t uMutexDebugTryLock(uPortMutexHandle_t mutexHandle,
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uMutexInfo_t *pMutexInfo = (uMutexInfo_t *) mutexHandle;
     uMutexFunctionInfo_t *pWaiting;
+    int32_t startTimeMs;
+    bool contended;
 
     if (gMutexList != NULL) {
 
@@ -560,9 +609,18 @@ int32_t uMutexDebugTryLock(uPortMutexHandle_t mutexHandle,
         errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
         pWaiting = pLockAddWaiting(pMutexInfo, pFile, line);
         if (pWaiting != NULL) {
-            errorCode = _uPortMutexTryLock(pMutexInfo->handle, delayMs);
+            startTimeMs = uPortGetTickTimeMs();
+            contended = (_uPortMutexTryLock(pMutexInfo->handle, 0) != 0);
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (contended) {
+                errorCode = (int32_t) U_ERROR_COMMON_TIMEOUT;
+                if (delayMs > 0) {
+                    errorCode = _uPortMutexTryLock(pMutexInfo->handle, delayMs);
+                }
+            }
             if (errorCode == 0) {
-                if (!lockMoveWaitingToLocker(pMutexInfo, pWaiting)) {
+                if (!lockMoveWaitingToLocker(pMutexInfo, pWaiting,
+                                             startTimeMs, contended)) {
                     lockFreeWaiting(pMutexInfo, pWaiting);
                 }
             } else {
@@ -579,11 +637,21 @@ int32_t uMutexDebugUnlock(uPortMutexHandle_t mutexHandle)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uMutexInfo_t *pMutexInfo = (uMutexInfo_t *) mutexHandle;
+    int32_t heldMs;
 
     if (gMutexList != NULL) {
 
         U_MUTEX_DEBUG_PORT_MUTEX_LOCK(gMutexList);
 
+        // Record how long the lock was held and by whom
+        if (pMutexInfo->pLocker != NULL) {
+            heldMs = uPortGetTickTimeMs() - pMutexInfo->lockedTimeMs;
+            if (heldMs >= pMutexInfo->holdMaxMs) {
+                pMutexInfo->holdMaxMs = heldMs;
+                pMutexInfo->pHoldMaxFile = pMutexInfo->pLocker->pFile;
+                pMutexInfo->holdMaxLine = pMutexInfo->pLocker->line;
+            }
+        }
         // Unlock the mutex and free the locker entry
         errorCode = _uPortMutexUnlock(pMutexInfo->handle);
         freeFunctionInformationBlock(pMutexInfo->pLocker);
@@ -758,6 +826,73 @@ void uMutexDebugPrint(void *pParam)
     }
 }
 
+// Print out the contention profile of all mutexes.
+void uMutexDebugProfilePrint(void *pParam)
+{
+    int32_t mutexes = 0;
+    int32_t lockCount = 0;
+    int32_t contendedCount = 0;
+    int64_t waitTotalMs = 0;
+    uMutexInfo_t *pMutexInfo;
+
+    (void) pParam;
+
+    if (gMutexList != NULL) {
+
+        U_MUTEX_DEBUG_PORT_MUTEX_LOCK(gMutexList);
+
+        pMutexInfo = gpMutexInfoList;
+        while (pMutexInfo != NULL) {
+            if (pMutexInfo->lockCount > 0) {
+                uPortLog("U_MUTEX_DEBUG_0x%08x: created by %s:%d, locked %d time(s),"
+                         " %d contended, waited %d ms in total (max %d ms).\n",
+                         pMutexInfo->handle,
+                         pMutexInfo->pCreator->pFile,
+                         pMutexInfo->pCreator->line,
+                         pMutexInfo->lockCount,
+                         pMutexInfo->contendedCount,
+                         (int32_t) pMutexInfo->waitTotalMs,
+                         pMutexInfo->waitMaxMs);
+                if (pMutexInfo->pHoldMaxFile != NULL) {
+                    uPortLog("U_MUTEX_DEBUG_0x%08x: held for at most %d ms, by %s:%d.\n",
+                             pMutexInfo->handle, pMutexInfo->holdMaxMs,
+                             pMutexInfo->pHoldMaxFile, pMutexInfo->holdMaxLine);
+                }
+                lockCount += pMutexInfo->lockCount;
+                contendedCount += pMutexInfo->contendedCount;
+                waitTotalMs += pMutexInfo->waitTotalMs;
+            }
+            pMutexInfo = pMutexInfo->pNext;
+            mutexes++;
+        }
+
+        uPortLog("U_MUTEX_DEBUG: %d mutex(es), %d lock(s), %d contended,"
+                 " %d ms spent waiting in total.\n",
+                 mutexes, lockCount, contendedCount, (int32_t) waitTotalMs);
+
+        U_MUTEX_DEBUG_PORT_MUTEX_UNLOCK(gMutexList);
+    }
+}
+
+// Reset the contention profile of all mutexes.
+void uMutexDebugProfileReset(void)
+{
+    uMutexInfo_t *pMutexInfo;
+
+    if (gMutexList != NULL) {
+
+        U_MUTEX_DEBUG_PORT_MUTEX_LOCK(gMutexList);
+
+        pMutexInfo = gpMutexInfoList;
+        while (pMutexInfo != NULL) {
+            profileReset(pMutexInfo);
+            pMutexInfo = pMutexInfo->pNext;
+        }
+
+        U_MUTEX_DEBUG_PORT_MUTEX_UNLOCK(gMutexList);
+    }
+}
+
 #endif // U_CFG_MUTEX_DEBUG
 
 // End of file
@@ -90,6 +90,20 @@
  * U_MUTEX_DEBUG_0x2000a7e8: created by C:/projects/ubxlib/port/platform/stm32cube/src/u_port_uart.c:892 approx. 12 second(s) ago is not locked.
  * U_MUTEX_DEBUG_0x2000a840: created by C:/projects/ubxlib/port/platform/common/event_queue/u_port_event_queue.c:229 approx. 12 second(s) ago is not locked.
  * U_MUTEX_DEBUG: 3 mutex(es), 1 locked, a maximum of 1 waiting, max waiting time approx. 12 second(s).
+ *
+ * Every mutex also keeps a contention profile: the number of times it
+ * has been locked, how many of those locks had to wait, for how long
+ * in total and at most, and the longest time it has been held, with
+ * the file and line of the locker that held it.  Call
+ * uMutexDebugProfilePrint() at any time to print this out, e.g.:
+ *
+ * U_MUTEX_DEBUG_0x2000e960: created by C:/projects/ubxlib/common/at_client/src/u_at_client.c:1234, locked 5000 time(s), 312 contended, waited 1875 ms in total (max 40 ms).
+ * U_MUTEX_DEBUG_0x2000e960: held for at most 38 ms, by C:/projects/ubxlib/common/at_client/src/u_at_client.c:2345.
+ * U_MUTEX_DEBUG: 42 mutex(es), 12045 lock(s), 330 contended, 1902 ms spent waiting in total.
+ *
+ * ...and call uMutexDebugProfileReset() to start afresh, e.g. at the
+ * start of a load test.  Times are measured with uPortGetTickTimeMs()
+ * so they are only as precise as the tick of the platform.
  */
 
 #ifdef __cplusplus
@@ -279,6 +293,20 @@ int32_t uMutexDebugWatchdog(void (*pCallback) (void *),
  */
 void uMutexDebugPrint(void *pParam);
 
+/** Print out the contention profile of all mutexes that have been
+ * locked since they were created or since uMutexDebugProfileReset()
+ * was last called; may be passed as a callback to
+ * uMutexDebugWatchdog().
+ *
+ * @param pParam  a dummy parameter so that this function matches
+ *                the function signature for uMutexDebugWatchdog().
+ */
+void uMutexDebugProfilePrint(void *pParam);
+
+/** Reset the contention profile of all mutexes.
+ */
+void uMutexDebugProfileReset(void);
+
 #ifdef __cplusplus
 }
 #endif
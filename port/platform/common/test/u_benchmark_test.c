@@ -0,0 +1,432 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Micro-benchmarks of the core utilities, so that a change
+ * in their performance on any platform shows up in the test
+ * output.  Each function is called over and over, for at least
+ * #U_BENCHMARK_TEST_DURATION_MS, on each of a number of
+ * sizes of data, and the time taken per byte is printed, along with
+ * the number of CPU cycles per byte if #U_CFG_TEST_CPU_CLOCK_HZ is
+ * set for the platform.  The prints are of the form:
+ *
+ * U_BENCHMARK_TEST: hexEncode 64 byte(s): 12.34 ns/byte, 2.07 cycles/byte.
+ *
+ * ...so that they can be picked out of the test log.  These tests
+ * only fail if the function being measured fails.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memcpy()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_ringbuffer.h"
+#include "u_mempool.h"
+#include "u_hex_bin_convert.h"
+#include "u_base64.h"
+#include "u_spartn_crc.h"
+#include "u_ubx_protocol.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_BENCHMARK_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+#ifndef U_BENCHMARK_TEST_DURATION_MS
+/** The minimum time to spend measuring each function at each size.
+ */
+# define U_BENCHMARK_TEST_DURATION_MS 100
+#endif
+
+#ifndef U_CFG_TEST_CPU_CLOCK_HZ
+/** The CPU clock rate of the platform, used to print the number of
+ * CPU cycles per byte; zero if not known, in which case only the
+ * time per byte is printed.
+ */
+# define U_CFG_TEST_CPU_CLOCK_HZ 0
+#endif
+
+/** The number of calls to a function to make between reads of
+ * the tick time, so that the cost of reading the tick time does
+ * not swamp that of the function being measured.
+ */
+#define U_BENCHMARK_TEST_CALLS_PER_TICK_READ 16
+
+/** The largest amount of data that is measured.
+ */
+#define U_BENCHMARK_TEST_SIZE_MAX_BYTES 1024
+
+/** The number of blocks in the memory pool measured.
+ */
+#define U_BENCHMARK_TEST_MEMPOOL_NUM_BLOCKS 16
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A function to be measured; it should process size bytes of
+ * data and return a negative value on failure.
+ */
+typedef int32_t (*uBenchmarkTestFunction_t)(size_t size);
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** The sizes of data to measure at.
+ */
+static const size_t gSize[] = {16, 64, 256, U_BENCHMARK_TEST_SIZE_MAX_BYTES};
+
+/** Input data.
+ */
+static char gIn[U_BENCHMARK_TEST_SIZE_MAX_BYTES * 2];
+
+/** Output data, big enough for a hex encode and for a UBX message.
+ */
+static char gOut[(U_BENCHMARK_TEST_SIZE_MAX_BYTES * 2) +
+                 U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES];
+
+/** Storage for the ring buffer.
+ */
+static char gRingBufferStorage[U_BENCHMARK_TEST_SIZE_MAX_BYTES + 1];
+
+/** The ring buffer.
+ */
+static uRingBuffer_t gRingBuffer;
+
+/** The memory pool.
+ */
+static uMemPoolDesc_t gMemPool;
+
+/** Somewhere to put results so that the compiler
+ * cannot optimise the work away.
+ */
+static volatile uint32_t gSink = 0;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: THE THINGS BEING MEASURED
+ * -------------------------------------------------------------- */
+
+// Add to and read from a ring buffer.
+static int32_t ringBuffer(size_t size)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+
+    if (uRingBufferAdd(&gRingBuffer, gIn, size)) {
+        errorCode = (int32_t) uRingBufferRead(&gRingBuffer, gOut, size);
+    }
+
+    return errorCode;
+}
+
+// Allocate and free the blocks of a memory pool; size is ignored.
+static int32_t memPool(size_t size)
+{
+    void *pBlock[U_BENCHMARK_TEST_MEMPOOL_NUM_BLOCKS];
+    int32_t errorCode = 0;
+
+    (void) size;
+    for (size_t x = 0; x < sizeof(pBlock) / sizeof(pBlock[0]); x++) {
+        pBlock[x] = uMemPoolAllocMem(&gMemPool);
+        if (pBlock[x] == NULL) {
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        }
+    }
+    for (size_t x = 0; x < sizeof(pBlock) / sizeof(pBlock[0]); x++) {
+        if (pBlock[x] != NULL) {
+            uMemPoolFreeMem(&gMemPool, pBlock[x]);
+        }
+    }
+
+    return errorCode;
+}
+
+// Hex encode.
+static int32_t hexEncode(size_t size)
+{
+    return (int32_t) uBinToHex(gIn, size, gOut);
+}
+
+// Hex decode; gIn must already contain hex.
+static int32_t hexDecode(size_t size)
+{
+    int32_t length = (int32_t) uHexToBin(gIn, size * 2, gOut);
+
+    return (length == (int32_t) size) ? length : (int32_t) U_ERROR_COMMON_UNKNOWN;
+}
+
+// Base 64 encode.
+static int32_t base64Encode(size_t size)
+{
+    uBase64Stream_t stream;
+    int32_t length;
+    int32_t x;
+
+    uBase64StreamInit(&stream);
+    length = uBase64EncodeStream(&stream, gIn, size, gOut, sizeof(gOut));
+    if (length >= 0) {
+        x = uBase64EncodeStreamFinish(&stream, gOut + length,
+                                      sizeof(gOut) - length);
+        length = (x >= 0) ? length + x : x;
+    }
+
+    return length;
+}
+
+// Base 64 decode; gIn must already contain base 64.
+static int32_t base64Decode(size_t size)
+{
+    uBase64Stream_t stream;
+    int32_t length;
+    int32_t x;
+
+    uBase64StreamInit(&stream);
+    length = uBase64DecodeStream(&stream, gIn,
+                                 U_BASE64_ENCODE_STREAM_LENGTH_MAX(size),
+                                 gOut, sizeof(gOut));
+    if (length >= 0) {
+        x = uBase64DecodeStreamFinish(&stream, gOut + length,
+                                      sizeof(gOut) - length);
+        length = (x >= 0) ? length + x : x;
+    }
+
+    return (length == (int32_t) size) ? length : (int32_t) U_ERROR_COMMON_UNKNOWN;
+}
+
+// SPARTN CRC-16.
+static int32_t spartnCrc16(size_t size)
+{
+    gSink += uSpartnCrc16(gIn, size);
+    return 0;
+}
+
+// SPARTN CRC-24.
+static int32_t spartnCrc24(size_t size)
+{
+    gSink += uSpartnCrc24(gIn, size);
+    return 0;
+}
+
+// SPARTN CRC-32.
+static int32_t spartnCrc32(size_t size)
+{
+    gSink += uSpartnCrc32(gIn, size);
+    return 0;
+}
+
+// UBX protocol encode.
+static int32_t ubxEncode(size_t size)
+{
+    return uUbxProtocolEncode(0x0a, 0x04, gIn, size, gOut);
+}
+
+// UBX protocol decode; gIn must already contain a UBX message.
+static int32_t ubxDecode(size_t size)
+{
+    int32_t length = uUbxProtocolDecode(gIn, size + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES,
+                                        NULL, NULL, gOut, sizeof(gOut), NULL);
+
+    return (length == (int32_t) size) ? length : (int32_t) U_ERROR_COMMON_UNKNOWN;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: MEASUREMENT
+ * -------------------------------------------------------------- */
+
+// Fill gIn with something that is not all the same.
+static void fillIn(size_t size)
+{
+    for (size_t x = 0; x < size; x++) {
+        gIn[x] = (char) ((x * 37) + 11);
+    }
+}
+
+// Put size bytes of data, hex encoded, into gIn.
+static void prepareHexDecode(size_t size)
+{
+    fillIn(size);
+    uBinToHex(gIn, size, gOut);
+    memcpy(gIn, gOut, size * 2);
+}
+
+// Put size bytes of data, base 64 encoded, into gIn.
+static void prepareBase64Decode(size_t size)
+{
+    int32_t length;
+
+    fillIn(size);
+    length = base64Encode(size);
+    U_PORT_TEST_ASSERT(length > 0);
+    memcpy(gIn, gOut, length);
+}
+
+// Put a UBX message with a body of size bytes into gIn.
+static void prepareUbxDecode(size_t size)
+{
+    int32_t length;
+
+    fillIn(size);
+    length = ubxEncode(size);
+    U_PORT_TEST_ASSERT(length == (int32_t) (size + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES));
+    memcpy(gIn, gOut, length);
+}
+
+// Call pFunction over and over for each size and print the results,
+// calling pPrepare (if not NULL) for each size beforehand; if perCall
+// is true the time is printed per call rather than per byte.
+static void measure(const char *pName, uBenchmarkTestFunction_t pFunction,
+                    void (*pPrepare)(size_t), bool perCall)
+{
+    int32_t startTimeMs;
+    int32_t durationMs;
+    uint32_t calls;
+    uint64_t units;
+    uint32_t psPerUnit;
+    uint32_t centiCyclesPerUnit;
+
+    for (size_t x = 0; x < sizeof(gSize) / sizeof(gSize[0]); x++) {
+        if (pPrepare != NULL) {
+            pPrepare(gSize[x]);
+        }
+        // Call it once to make sure it works
+        U_PORT_TEST_ASSERT(pFunction(gSize[x]) >= 0);
+        calls = 0;
+        startTimeMs = uPortGetTickTimeMs();
+        do {
+            for (size_t y = 0; y < U_BENCHMARK_TEST_CALLS_PER_TICK_READ; y++) {
+                U_PORT_TEST_ASSERT(pFunction(gSize[x]) >= 0);
+            }
+            calls += U_BENCHMARK_TEST_CALLS_PER_TICK_READ;
+            durationMs = uPortGetTickTimeMs() - startTimeMs;
+        } while (durationMs < U_BENCHMARK_TEST_DURATION_MS);
+        units = calls;
+        if (!perCall) {
+            units *= gSize[x];
+        }
+        // Work in pico-seconds to keep some precision in
+        // integer arithmetic
+        psPerUnit = (uint32_t) ((((uint64_t) durationMs) * 1000000000ULL) / units);
+        if (perCall) {
+            U_TEST_PRINT_LINE("%s: %u.%03u us/call.", pName,
+                              (unsigned) (psPerUnit / 1000000),
+                              (unsigned) ((psPerUnit / 1000) % 1000));
+        } else if (U_CFG_TEST_CPU_CLOCK_HZ > 0) {
+            centiCyclesPerUnit = (uint32_t) ((((uint64_t) psPerUnit) *
+                                              (U_CFG_TEST_CPU_CLOCK_HZ / 1000)) / 10000000ULL);
+            U_TEST_PRINT_LINE("%s %d byte(s): %u.%02u ns/byte, %u.%02u cycles/byte.",
+                              pName, (int32_t) gSize[x],
+                              (unsigned) (psPerUnit / 1000),
+                              (unsigned) ((psPerUnit / 10) % 100),
+                              (unsigned) (centiCyclesPerUnit / 100),
+                              (unsigned) (centiCyclesPerUnit % 100));
+        } else {
+            U_TEST_PRINT_LINE("%s %d byte(s): %u.%02u ns/byte.",
+                              pName, (int32_t) gSize[x],
+                              (unsigned) (psPerUnit / 1000),
+                              (unsigned) ((psPerUnit / 10) % 100));
+        }
+        if (perCall) {
+            // Size doesn't matter
+            break;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TESTS
+ * -------------------------------------------------------------- */
+
+/** Measure the utilities in common/utils.
+ */
+U_PORT_TEST_FUNCTION("[benchmark]", "benchmarkUtils")
+{
+    int32_t heapUsed;
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    heapUsed = uPortGetHeapFree();
+
+    U_PORT_TEST_ASSERT(uRingBufferCreate(&gRingBuffer, gRingBufferStorage,
+                                         sizeof(gRingBufferStorage)) == 0);
+    measure("ringBuffer", ringBuffer, fillIn, false);
+    uRingBufferDelete(&gRingBuffer);
+
+    U_PORT_TEST_ASSERT(uMemPoolInit(&gMemPool, 64,
+                                    U_BENCHMARK_TEST_MEMPOOL_NUM_BLOCKS) == 0);
+    measure("memPool alloc/free x" U_PORT_STRINGIFY_QUOTED(U_BENCHMARK_TEST_MEMPOOL_NUM_BLOCKS),
+            memPool, NULL, true);
+    uMemPoolDeinit(&gMemPool);
+
+    measure("hexEncode", hexEncode, fillIn, false);
+    measure("hexDecode", hexDecode, prepareHexDecode, false);
+    measure("base64Encode", base64Encode, fillIn, false);
+    measure("base64Decode", base64Decode, prepareBase64Decode, false);
+
+    uPortDeinit();
+
+    // Check for memory leaks
+    heapUsed -= uPortGetHeapFree();
+    U_TEST_PRINT_LINE("we have leaked %d byte(s).", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+}
+
+/** Measure the protocol handling in common/spartn and
+ * common/ubx_protocol.
+ */
+U_PORT_TEST_FUNCTION("[benchmark]", "benchmarkProtocol")
+{
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    measure("spartnCrc16", spartnCrc16, fillIn, false);
+    measure("spartnCrc24", spartnCrc24, fillIn, false);
+    measure("spartnCrc32", spartnCrc32, fillIn, false);
+    measure("ubxEncode", ubxEncode, fillIn, false);
+    measure("ubxDecode", ubxDecode, prepareUbxDecode, false);
+
+    uPortDeinit();
+}
+
+// End of file
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Implementation of the SPARTN CRC hardware hooks for the ESP32
+ * platform, using the CRC functions in ROM; only compiled in if
+ * U_SPARTN_CRC_HW is defined, see u_spartn_crc.h.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#ifdef U_SPARTN_CRC_HW
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_spartn_crc.h"
+
+#include "esp_rom_crc.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// The ROM CRC functions invert the remainder on the way in and on
+// the way out, hence the inversions here to simply continue it.
+
+// Continue a CRC-8 calculation.
+uint8_t uSpartnCrcHw8(uint8_t remainder, const char *pData, size_t size)
+{
+    return (uint8_t) ~esp_rom_crc8_be((uint8_t) ~remainder,
+                                      (const uint8_t *) pData,
+                                      (uint32_t) size);
+}
+
+// Continue a CRC-16 calculation.
+uint16_t uSpartnCrcHw16(uint16_t remainder, const char *pData, size_t size)
+{
+    return (uint16_t) ~esp_rom_crc16_be((uint16_t) ~remainder,
+                                        (const uint8_t *) pData,
+                                        (uint32_t) size);
+}
+
+// Continue a CRC-32 calculation.
+uint32_t uSpartnCrcHw32(uint32_t remainder, const char *pData, size_t size)
+{
+    return ~esp_rom_crc32_be(~remainder, (const uint8_t *) pData,
+                             (uint32_t) size);
+}
+
+#endif // #ifdef U_SPARTN_CRC_HW
+
+// End of file
@@ -53,6 +53,26 @@
  */
 #define U_PORT_UART_EVENT_MIN_TASK_STACK_SIZE_BYTES 768
 
+#ifndef U_PORT_UART_RX_FULL_THRESHOLD_BYTES
+/** The number of bytes in the receive FIFO of the UART HW at which
+ * the ESP-IDF UART driver interrupt moves them into its ring buffer
+ * and posts a UART_DATA event; the larger this is the fewer events
+ * a long receive burst generates but the greater the risk of FIFO
+ * overflow at high baud rates.  -1 leaves the ESP-IDF default
+ * (120 bytes) alone.
+ */
+# define U_PORT_UART_RX_FULL_THRESHOLD_BYTES -1
+#endif
+
+#ifndef U_PORT_UART_RX_TIMEOUT_SYMBOLS
+/** The number of idle character times after which the ESP-IDF
+ * UART driver interrupt posts a UART_DATA event for whatever is in
+ * the receive FIFO of the UART HW.  -1 leaves the ESP-IDF default
+ * (10) alone.
+ */
+# define U_PORT_UART_RX_TIMEOUT_SYMBOLS -1
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -173,6 +193,23 @@ static void eventTask(void *pParam)
     do {
         if (uPortQueueReceive((const uPortQueueHandle_t) gUartData[handle].queue,
                               &event) == 0) {
+            if (event.type == UART_DATA) {
+                // The ESP-IDF driver posts a UART_DATA event
+                // every time its interrupt empties the FIFO, so
+                // a single burst may have queued several: swallow
+                // the rest so that the callback is called once per
+                // burst, having all that data to read, rather than
+                // once per event, finding most of them to be empty.
+                // Any other event type is swallowed along the way,
+                // which is fine since none are passed on but the
+                // "exit" event, and that remains in event.type.
+                while ((event.type == UART_DATA) &&
+                       (uPortQueueTryReceive((const uPortQueueHandle_t) gUartData[handle].queue,
+                                             0, &event) == 0)) {}
+                if (event.type < UART_EVENT_MAX) {
+                    event.type = UART_DATA;
+                }
+            }
             // Check if it is in the filter
             eventBitMask = getEventFromEsp32Event(event.type);
             if (eventBitMask & gUartData[handle].eventFilter) {
@@ -333,6 +370,21 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
                                                        U_PORT_UART_EVENT_QUEUE_SIZE,
                                                        &gUartData[uart].queue,
                                                        0);
+#if U_PORT_UART_RX_FULL_THRESHOLD_BYTES >= 0
+                        if (espError == ESP_OK) {
+                            espError = uart_set_rx_full_threshold(uart,
+                                                                  U_PORT_UART_RX_FULL_THRESHOLD_BYTES);
+                        }
+#endif
+#if U_PORT_UART_RX_TIMEOUT_SYMBOLS >= 0
+                        if (espError == ESP_OK) {
+                            espError = uart_set_rx_timeout(uart, U_PORT_UART_RX_TIMEOUT_SYMBOLS);
+                        }
+#endif
+                        if ((espError != ESP_OK) && (gUartData[uart].queue != NULL)) {
+                            uart_driver_delete(uart);
+                            gUartData[uart].queue = NULL;
+                        }
                         if (espError == ESP_OK) {
                             U_ATOMIC_INCREMENT(&gResourceAllocCount);
                             handleOrErrorCode = uart;
@@ -857,6 +909,35 @@ void uPortUartCtsResume(int32_t handle)
     }
 }
 
+// Change the baud rate of an open UART.
+int32_t uPortUartSetBaudRate(int32_t handle, int32_t baudRate)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((handle >= 0) &&
+            (handle < sizeof(gUartData) / sizeof(gUartData[0])) &&
+            (gUartData[handle].queue != NULL) &&
+            !gUartData[handle].markedForDeletion &&
+            (baudRate > 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+            // Let anything already written go out at the old rate
+            uart_wait_tx_done(handle, portMAX_DELAY);
+            if (uart_set_baudrate(handle, baudRate) == ESP_OK) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return errorCode;
+}
+
 // Get the number of UART interfaces currently open.
 int32_t uPortUartResourceAllocCount()
 {
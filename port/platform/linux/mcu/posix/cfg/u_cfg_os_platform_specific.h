@@ -92,9 +92,10 @@
  * -------------------------------------------------------------- */
 
 #ifndef U_CFG_OS_RESOURCES_PER_SEMAPHORE
-/** A semaphore requires mutex protection, hence this is 2.
+/** A semaphore is a single POSIX semaphore, which uPortSemaphoreCreate()
+ * counts once, hence this is 1.
  */
-# define U_CFG_OS_RESOURCES_PER_SEMAPHORE 2
+# define U_CFG_OS_RESOURCES_PER_SEMAPHORE 1
 #endif
 
 #ifndef U_CFG_OS_MALLOCS_PER_TASK
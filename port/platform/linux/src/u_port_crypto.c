@@ -25,13 +25,17 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // memcpy()
 
 #include "openssl/sha.h"
+#include "openssl/md5.h"
 #include "openssl/aes.h"
 #include "openssl/hmac.h"
 
 #include "u_error_common.h"
 #include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_port_crypto.h"
 
 /* ----------------------------------------------------------------
@@ -74,6 +78,110 @@ int32_t uPortCryptoSha256(const char *pInput,
     return (int32_t)errorCode;
 }
 
+// Begin a SHA256 calculation on data supplied in pieces.
+int32_t uPortCryptoSha256Init(void **ppContext)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    SHA256_CTX *pSha256;
+    if (ppContext != NULL) {
+        errorCode = U_ERROR_COMMON_NO_MEMORY;
+        pSha256 = (SHA256_CTX *) pUPortMalloc(sizeof(*pSha256));
+        if (pSha256 != NULL) {
+            errorCode = U_ERROR_COMMON_PLATFORM;
+            if (SHA256_Init(pSha256) == 1) {
+                errorCode = U_ERROR_COMMON_SUCCESS;
+                *ppContext = pSha256;
+            } else {
+                uPortFree(pSha256);
+            }
+        }
+    }
+    return (int32_t)errorCode;
+}
+
+// Add data to a SHA256 calculation.
+int32_t uPortCryptoSha256Update(void *pContext,
+                                const char *pInput,
+                                size_t inputLengthBytes)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    if ((pContext != NULL) && ((pInput != NULL) || (inputLengthBytes == 0))) {
+        errorCode = U_ERROR_COMMON_PLATFORM;
+        if (SHA256_Update((SHA256_CTX *) pContext, pInput, inputLengthBytes) == 1) {
+            errorCode = U_ERROR_COMMON_SUCCESS;
+        }
+    }
+    return (int32_t)errorCode;
+}
+
+// Complete a SHA256 calculation.
+int32_t uPortCryptoSha256Finish(void *pContext, char *pOutput)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    unsigned char discard[U_PORT_CRYPTO_SHA256_OUTPUT_LENGTH_BYTES];
+    if (pContext != NULL) {
+        errorCode = U_ERROR_COMMON_PLATFORM;
+        if (SHA256_Final((pOutput != NULL) ? (unsigned char *) pOutput : discard,
+                         (SHA256_CTX *) pContext) == 1) {
+            errorCode = U_ERROR_COMMON_SUCCESS;
+        }
+        uPortFree(pContext);
+    }
+    return (int32_t)errorCode;
+}
+
+// Begin an MD5 calculation on data supplied in pieces.
+int32_t uPortCryptoMd5Init(void **ppContext)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    MD5_CTX *pMd5;
+    if (ppContext != NULL) {
+        errorCode = U_ERROR_COMMON_NO_MEMORY;
+        pMd5 = (MD5_CTX *) pUPortMalloc(sizeof(*pMd5));
+        if (pMd5 != NULL) {
+            errorCode = U_ERROR_COMMON_PLATFORM;
+            if (MD5_Init(pMd5) == 1) {
+                errorCode = U_ERROR_COMMON_SUCCESS;
+                *ppContext = pMd5;
+            } else {
+                uPortFree(pMd5);
+            }
+        }
+    }
+    return (int32_t)errorCode;
+}
+
+// Add data to an MD5 calculation.
+int32_t uPortCryptoMd5Update(void *pContext,
+                             const char *pInput,
+                             size_t inputLengthBytes)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    if ((pContext != NULL) && ((pInput != NULL) || (inputLengthBytes == 0))) {
+        errorCode = U_ERROR_COMMON_PLATFORM;
+        if (MD5_Update((MD5_CTX *) pContext, pInput, inputLengthBytes) == 1) {
+            errorCode = U_ERROR_COMMON_SUCCESS;
+        }
+    }
+    return (int32_t)errorCode;
+}
+
+// Complete an MD5 calculation.
+int32_t uPortCryptoMd5Finish(void *pContext, char *pOutput)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    unsigned char discard[U_PORT_CRYPTO_MD5_OUTPUT_LENGTH_BYTES];
+    if (pContext != NULL) {
+        errorCode = U_ERROR_COMMON_PLATFORM;
+        if (MD5_Final((pOutput != NULL) ? (unsigned char *) pOutput : discard,
+                      (MD5_CTX *) pContext) == 1) {
+            errorCode = U_ERROR_COMMON_SUCCESS;
+        }
+        uPortFree(pContext);
+    }
+    return (int32_t)errorCode;
+}
+
 // Perform a HMAC SHA256 calculation on a block of data.
 int32_t uPortCryptoHmacSha256(const char *pKey,
                               size_t keyLengthBytes,
@@ -93,6 +201,59 @@ int32_t uPortCryptoHmacSha256(const char *pKey,
     return (int32_t)errorCode;
 }
 
+// Begin a HMAC SHA256 calculation on data supplied in pieces.
+int32_t uPortCryptoHmacSha256Init(void **ppContext,
+                                  const char *pKey,
+                                  size_t keyLengthBytes)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    HMAC_CTX *h;
+    if ((ppContext != NULL) && (pKey != NULL)) {
+        errorCode = U_ERROR_COMMON_NO_MEMORY;
+        h = HMAC_CTX_new();
+        if (h != NULL) {
+            errorCode = U_ERROR_COMMON_PLATFORM;
+            if (HMAC_Init_ex(h, pKey, keyLengthBytes, EVP_sha256(), NULL) == 1) {
+                errorCode = U_ERROR_COMMON_SUCCESS;
+                *ppContext = h;
+            } else {
+                HMAC_CTX_free(h);
+            }
+        }
+    }
+    return (int32_t)errorCode;
+}
+
+// Add data to a HMAC SHA256 calculation.
+int32_t uPortCryptoHmacSha256Update(void *pContext,
+                                    const char *pInput,
+                                    size_t inputLengthBytes)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    if ((pContext != NULL) && ((pInput != NULL) || (inputLengthBytes == 0))) {
+        errorCode = U_ERROR_COMMON_PLATFORM;
+        if (HMAC_Update((HMAC_CTX *) pContext, pInput, inputLengthBytes) == 1) {
+            errorCode = U_ERROR_COMMON_SUCCESS;
+        }
+    }
+    return (int32_t)errorCode;
+}
+
+// Complete a HMAC SHA256 calculation.
+int32_t uPortCryptoHmacSha256Finish(void *pContext, char *pOutput)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    unsigned int len;
+    if (pContext != NULL) {
+        errorCode = U_ERROR_COMMON_SUCCESS;
+        if ((pOutput != NULL) && (HMAC_Final((HMAC_CTX *) pContext, pOutput, &len) != 1)) {
+            errorCode = U_ERROR_COMMON_PLATFORM;
+        }
+        HMAC_CTX_free((HMAC_CTX *) pContext);
+    }
+    return (int32_t)errorCode;
+}
+
 // Perform AES 128 CBC encryption of a block of data.
 int32_t uPortCryptoAes128CbcEncrypt(const char *pKey,
                                     size_t keyLengthBytes,
@@ -111,6 +272,13 @@ int32_t uPortCryptoAes128CbcEncrypt(const char *pKey,
     EVP_EncryptUpdate(ctx, pOutput, &len, pInput, lengthBytes);
     if (EVP_EncryptFinal_ex(ctx, pOutput + len, &len) == 1) {
         errorCode = U_ERROR_COMMON_SUCCESS;
+        // As on other platforms the IV becomes the last block of
+        // cipher text, so that a stream may be encrypted in pieces
+        if (lengthBytes >= U_PORT_CRYPTO_AES128_INITIALISATION_VECTOR_LENGTH_BYTES) {
+            memcpy(pInitVector,
+                   pOutput + lengthBytes - U_PORT_CRYPTO_AES128_INITIALISATION_VECTOR_LENGTH_BYTES,
+                   U_PORT_CRYPTO_AES128_INITIALISATION_VECTOR_LENGTH_BYTES);
+        }
     }
     EVP_CIPHER_CTX_free(ctx);
     return (int32_t)errorCode;
@@ -126,6 +294,13 @@ int32_t uPortCryptoAes128CbcDecrypt(const char *pKey,
 {
     uErrorCode_t errorCode = U_ERROR_COMMON_PLATFORM;
     EVP_CIPHER_CTX *ctx;
+    char nextInitVector[U_PORT_CRYPTO_AES128_INITIALISATION_VECTOR_LENGTH_BYTES];
+    // The next IV is the last block of cipher text, which may be
+    // over-written if the decryption is in place, so keep it now
+    if (lengthBytes >= sizeof(nextInitVector)) {
+        memcpy(nextInitVector, pInput + lengthBytes - sizeof(nextInitVector),
+               sizeof(nextInitVector));
+    }
     ctx = EVP_CIPHER_CTX_new();
     EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, pKey, pInitVector);
     EVP_CIPHER_CTX_set_padding(ctx, 0);
@@ -134,6 +309,9 @@ int32_t uPortCryptoAes128CbcDecrypt(const char *pKey,
     EVP_DecryptUpdate(ctx, pOutput, &len, pInput, lengthBytes);
     if (EVP_DecryptFinal_ex(ctx, pOutput + len, &len) == 1) {
         errorCode = U_ERROR_COMMON_SUCCESS;
+        if (lengthBytes >= sizeof(nextInitVector)) {
+            memcpy(pInitVector, nextInitVector, sizeof(nextInitVector));
+        }
     }
     EVP_CIPHER_CTX_free(ctx);
     return (int32_t)errorCode;
@@ -57,6 +57,7 @@ typedef struct {
     uint16_t address;
     uint8_t *pPendingWriteData;
     size_t pendingWriteLength;
+    uLinkedListNode_t node;
 } i2cPendingDataInfo_t;
 
 /* ----------------------------------------------------------------
@@ -69,7 +70,7 @@ static uPortMutexHandle_t gMutex = NULL;
 
 /** Root of linked list for pending no stop bit write data.
  */
-static uLinkedList_t *gpI2cPendingDataList = NULL;
+static uLinkedListNode_t *gpI2cPendingDataList = NULL;
 
 /** Variable to keep track of the number of I2C interfaces open.
  */
@@ -86,9 +87,10 @@ static i2cPendingDataInfo_t *findPendingData(pthread_t threadId,
                                              int32_t handle,
                                              uint16_t address)
 {
-    uLinkedList_t *p = gpI2cPendingDataList;
+    uLinkedListNode_t *p = gpI2cPendingDataList;
     while (p != NULL) {
-        i2cPendingDataInfo_t *pI2cData = (i2cPendingDataInfo_t *)(p->p);
+        i2cPendingDataInfo_t *pI2cData = U_LINKED_LIST_CONTAINER_OF(p, i2cPendingDataInfo_t,
+                                                                   node);
         if ((pI2cData->threadId == threadId) &&
             (pI2cData->handle == handle) &&
             ((address == 0) || (pI2cData->address == address))) {
@@ -159,9 +161,9 @@ void uPortI2cClose(int32_t handle)
         // Remove possible pending data.
         i2cPendingDataInfo_t *p;
         while ((p = findPendingData(pthread_self(), handle, 0)) != NULL) {
+            uLinkedListNodeRemove(&gpI2cPendingDataList, &(p->node));
             uPortFree(p->pPendingWriteData);
             uPortFree(p);
-            uLinkedListRemove(&gpI2cPendingDataList, p);
         }
         close(handle);
         U_ATOMIC_DECREMENT(&gResourceAllocCount);
@@ -251,9 +253,9 @@ int32_t uPortI2cControllerSendReceive(int32_t handle, uint16_t address,
                 if (bytesReceived == (int)bytesToReceive) {
                     errorOrSize = bytesReceived;
                 }
+                uLinkedListNodeRemove(&gpI2cPendingDataList, &(pI2cData->node));
                 uPortFree(pI2cData->pPendingWriteData);
                 uPortFree(pI2cData);
-                uLinkedListRemove(&gpI2cPendingDataList, pI2cData);
             } else {
                 // Plain write and read.
                 bool ok = true;
@@ -300,7 +302,7 @@ int32_t uPortI2cControllerSend(int32_t handle, uint16_t address,
                     pInfo->address = address;
                     pInfo->pPendingWriteData = pData;
                     pInfo->pendingWriteLength = bytesToSend;
-                    uLinkedListAdd(&gpI2cPendingDataList, (void *)pInfo);
+                    uLinkedListNodeAdd(&gpI2cPendingDataList, &(pInfo->node));
                     errorCode = U_ERROR_COMMON_SUCCESS;
                 } else {
                     uPortFree(pInfo);
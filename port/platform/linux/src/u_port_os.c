@@ -77,6 +77,8 @@
 #include "time.h"
 #include "signal.h"
 #include "errno.h"
+#include "dirent.h"    // For uPortTaskStatsGet()
+#include "sys/timerfd.h"
 
 #include "u_cfg_sw.h"
 #include "u_cfg_os_platform_specific.h"
@@ -125,14 +127,20 @@ typedef struct {
     size_t readCount;     /*!< Unread bytes in the queue. */
 } uPortQueue_t;
 
-/** Timers are implemented using Posix timer_t timers.
+/** Timers are all serviced by a single thread which waits on a
+ * timerfd set to the expiry of the first of the running timers,
+ * which are kept in a list sorted by expiry time.
 */
-typedef struct {
-    timer_t timerId;             /*!< Posix timer ID. */
-    struct itimerspec timerSpec; /*!< Posix structure for timer start values and intervals.*/
+typedef struct uPortTimer_t {
+    int64_t expiryNs;            /*!< CLOCK_MONOTONIC expiry time, valid if active. */
+    uint32_t intervalMs;
     bool periodic;
+    bool active;                 /*!< True if in the list of running timers. */
+    bool deleted;                /*!< Set if deleted while its callback is running. */
     pTimerCallback_t *pCallback;
     void *pCallbackParam;
+    struct uPortTimer_t *pNextActive; /*!< Next in the list of running timers. */
+    struct uPortTimer_t *pNext;       /*!< Next in the list of all timers. */
 } uPortTimer_t;
 
 /** Threads are implemented using Posix pthreads. As the Posix api wants the callback
@@ -161,7 +169,19 @@ uPortMutexHandle_t gMutexThread = NULL;
 uLinkedList_t *gpThreadList = NULL;
 
 uPortMutexHandle_t gMutexTimer = NULL;
-uLinkedList_t *gpTimerList = NULL;
+
+// All of the timers, the timers that are running, sorted by
+// expiry time, and the timer whose callback is being called;
+// all protected by gMutexTimer.
+static uPortTimer_t *gpTimerList = NULL;
+static uPortTimer_t *gpTimerActiveList = NULL;
+static uPortTimer_t *gpTimerCallback = NULL;
+
+// The timerfd and the thread that services all of the timers,
+// started when the first timer is created.
+static int gTimerFd = -1;
+static pthread_t gTimerThread;
+static volatile bool gTimerThreadExit = false;
 
 // Posix has no suspend/resume functions for threads and this is needed
 // for the critical section implementation of the port layer. We therefore
@@ -247,11 +267,162 @@ static int32_t suspendOrResumeAllTasks(bool suspend)
 }
 #endif
 
-// Posix timer callback function in required format.
-static void timerCallback(union sigval sv)
+// Get the CLOCK_MONOTONIC time in nanoseconds.
+static int64_t timerNowNs(void)
+{
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((int64_t) now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+// Set the timerfd to the expiry of the first running timer, or
+// disarm it if there is none; gMutexTimer must be locked.
+static void timerFdSet(void)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+    if (gpTimerActiveList != NULL) {
+        its.it_value.tv_sec = gpTimerActiveList->expiryNs / 1000000000;
+        its.it_value.tv_nsec = gpTimerActiveList->expiryNs % 1000000000;
+        if ((its.it_value.tv_sec == 0) && (its.it_value.tv_nsec == 0)) {
+            // Zero would disarm the timerfd
+            its.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(gTimerFd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+// Remove a timer from the list of running timers; gMutexTimer
+// must be locked.
+static void timerActiveRemove(uPortTimer_t *pTimer)
+{
+    uPortTimer_t **ppTimer = &gpTimerActiveList;
+
+    while ((*ppTimer != NULL) && (*ppTimer != pTimer)) {
+        ppTimer = &((*ppTimer)->pNextActive);
+    }
+    if (*ppTimer != NULL) {
+        *ppTimer = pTimer->pNextActive;
+    }
+    pTimer->pNextActive = NULL;
+    pTimer->active = false;
+}
+
+// Add a timer to the list of running timers, in order of expiry
+// (after any with the same expiry); gMutexTimer must be locked.
+static void timerActiveAdd(uPortTimer_t *pTimer)
 {
-    uPortTimer_t *pTimer = (uPortTimer_t *)sv.sival_ptr;
-    pTimer->pCallback(pTimer, pTimer->pCallbackParam);
+    uPortTimer_t **ppTimer = &gpTimerActiveList;
+
+    while ((*ppTimer != NULL) && ((*ppTimer)->expiryNs <= pTimer->expiryNs)) {
+        ppTimer = &((*ppTimer)->pNextActive);
+    }
+    pTimer->pNextActive = *ppTimer;
+    *ppTimer = pTimer;
+    pTimer->active = true;
+}
+
+// The thread that services all of the timers.
+static void *timerThread(void *pParam)
+{
+    uint64_t expirations;
+    uPortTimer_t *pTimer;
+    pTimerCallback_t *pCallback;
+    void *pCallbackParam;
+    int64_t nowNs;
+
+    (void) pParam;
+
+    while (!gTimerThreadExit) {
+        // Blocks until the timerfd expires; the expiry count
+        // is of no interest since timers are checked against
+        // the time here
+        if (read(gTimerFd, &expirations, sizeof(expirations)) < 0) {
+            if (errno != EINTR) {
+                uPortTaskBlock(1);
+            }
+        }
+        MTX_FN(uPortMutexLock(gMutexTimer));
+        nowNs = timerNowNs();
+        while (!gTimerThreadExit && (gpTimerActiveList != NULL) &&
+               (gpTimerActiveList->expiryNs <= nowNs)) {
+            pTimer = gpTimerActiveList;
+            timerActiveRemove(pTimer);
+            if (pTimer->periodic) {
+                // Re-add the timer before calling its callback, so
+                // that the callback may stop it; work from the previous
+                // expiry so that a periodic timer doesn't drift, unless
+                // we've fallen more than a period behind
+                pTimer->expiryNs += (int64_t) pTimer->intervalMs * 1000000;
+                if (pTimer->expiryNs <= nowNs) {
+                    pTimer->expiryNs = nowNs + ((int64_t) pTimer->intervalMs * 1000000);
+                }
+                timerActiveAdd(pTimer);
+            }
+            pCallback = pTimer->pCallback;
+            pCallbackParam = pTimer->pCallbackParam;
+            gpTimerCallback = pTimer;
+            // Call the callback outside the lock so that the
+            // callback itself may call the timer API
+            MTX_FN(uPortMutexUnlock(gMutexTimer));
+            if (pCallback != NULL) {
+                pCallback((uPortTimerHandle_t) pTimer, pCallbackParam);
+            }
+            MTX_FN(uPortMutexLock(gMutexTimer));
+            gpTimerCallback = NULL;
+            if (pTimer->deleted) {
+                // Deleted while the callback was running
+                uPortFree(pTimer);
+            }
+            nowNs = timerNowNs();
+        }
+        timerFdSet();
+        MTX_FN(uPortMutexUnlock(gMutexTimer));
+    }
+
+    return NULL;
+}
+
+// Start the thread that services the timers, if it is not
+// already running; gMutexTimer must be locked.
+static uErrorCode_t timerThreadStart(void)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_SUCCESS;
+
+    if (gTimerFd < 0) {
+        errorCode = U_ERROR_COMMON_PLATFORM;
+        gTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (gTimerFd >= 0) {
+            gTimerThreadExit = false;
+            if (pthread_create(&gTimerThread, NULL, timerThread, NULL) == 0) {
+                errorCode = U_ERROR_COMMON_SUCCESS;
+            } else {
+                close(gTimerFd);
+                gTimerFd = -1;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Stop the thread that services the timers; gMutexTimer must
+// NOT be locked.
+static void timerThreadStop(void)
+{
+    struct itimerspec its;
+
+    if (gTimerFd >= 0) {
+        gTimerThreadExit = true;
+        // Make the timerfd expire now to wake the thread up
+        memset(&its, 0, sizeof(its));
+        its.it_value.tv_nsec = 1;
+        timerfd_settime(gTimerFd, 0, &its, NULL);
+        pthread_join(gTimerThread, NULL);
+        close(gTimerFd);
+        gTimerFd = -1;
+    }
 }
 
 // Read from a queue if an event is available.
@@ -322,6 +493,76 @@ static int32_t mutexUnlock(const uPortMutexHandle_t mutexHandle)
     return (int32_t)errorCode;
 }
 
+// Read the user plus system CPU time, in microseconds, from a
+// /proc stat file, e.g. /proc/self/stat or /proc/self/task/<tid>/stat;
+// returns -1 on failure.
+static int64_t readProcRunTimeUs(const char *pPath)
+{
+    int64_t runTimeUs = -1;
+    char buffer[512];
+    char *pStr = NULL;
+    FILE *pFile;
+    long long utime;
+    long long stime;
+
+    pFile = fopen(pPath, "r");
+    if (pFile != NULL) {
+        if (fgets(buffer, sizeof(buffer), pFile) != NULL) {
+            // The name, field 2, is in brackets and may contain
+            // spaces, so start after the last closing bracket,
+            // at field 3; utime and stime are fields 14 and 15
+            pStr = strrchr(buffer, ')');
+        }
+        if ((pStr != NULL) &&
+            (sscanf(pStr + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lld %lld",
+                    &utime, &stime) == 2)) {
+            runTimeUs = ((utime + stime) * 1000000LL) / sysconf(_SC_CLK_TCK);
+        }
+        fclose(pFile);
+    }
+
+    return runTimeUs;
+}
+
+// Fill in the statistics for a thread of this process from /proc.
+static void readProcTaskStats(const char *pTid, uPortTaskStats_t *pStats)
+{
+    char path[64];
+    char buffer[64];
+    FILE *pFile;
+    long long count;
+
+    memset(pStats, 0, sizeof(*pStats));
+    pStats->contextSwitches = -1;
+    // Stack high-water marks are not available on Linux
+    pStats->stackMinFreeBytes = -1;
+    snprintf(path, sizeof(path), "/proc/self/task/%s/comm", pTid);
+    pFile = fopen(path, "r");
+    if (pFile != NULL) {
+        if (fgets(pStats->name, sizeof(pStats->name), pFile) != NULL) {
+            pStats->name[strcspn(pStats->name, "\n")] = 0;
+        }
+        fclose(pFile);
+    }
+    snprintf(path, sizeof(path), "/proc/self/task/%s/stat", pTid);
+    pStats->runTime = readProcRunTimeUs(path);
+    snprintf(path, sizeof(path), "/proc/self/task/%s/status", pTid);
+    pFile = fopen(path, "r");
+    if (pFile != NULL) {
+        // Add up voluntary_ctxt_switches and nonvoluntary_ctxt_switches
+        while (fgets(buffer, sizeof(buffer), pFile) != NULL) {
+            if ((strstr(buffer, "voluntary_ctxt_switches:") != NULL) &&
+                (sscanf(strchr(buffer, ':') + 1, "%lld", &count) == 1)) {
+                if (pStats->contextSwitches < 0) {
+                    pStats->contextSwitches = 0;
+                }
+                pStats->contextSwitches += count;
+            }
+        }
+        fclose(pFile);
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS SPECIFIC TO THE OS PART OF THIS PORT
  * -------------------------------------------------------------- */
@@ -362,16 +603,16 @@ int32_t uPortOsPrivateInit(void)
 void uPortOsPrivateDeinit(void)
 {
     if (gMutexTimer != NULL) {
+        timerThreadStop();
         MTX_FN(uPortMutexLock(gMutexTimer));
         // Tidy away the timers
-        uLinkedList_t *p = gpTimerList;
-        while (p != NULL) {
-            uPortTimer_t *pTimer = (uPortTimer_t *)(p->p);
-            uPortTimerDelete(pTimer);
-            uLinkedList_t *pNext = p->pNext;
-            uLinkedListRemove(&gpTimerList, p);
-            p = pNext;
+        while (gpTimerList != NULL) {
+            uPortTimer_t *pTimer = gpTimerList;
+            gpTimerList = pTimer->pNext;
+            uPortFree(pTimer);
+            U_ATOMIC_DECREMENT(&gResourceAllocCount);
         }
+        gpTimerActiveList = NULL;
         MTX_FN(uPortMutexUnlock(gMutexTimer));
         MTX_FN(uPortMutexDelete(gMutexTimer));
         gMutexTimer = NULL;
@@ -419,7 +660,6 @@ int32_t uPortTaskCreate(void (*pFunction)(void *),
         return U_ERROR_COMMON_NO_MEMORY;
     }
     uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-    (void)pName;
     if ((pFunction != NULL) && (pTaskHandle != NULL) &&
         (priority >= U_CFG_OS_PRIORITY_MIN) &&
         (priority <= U_CFG_OS_PRIORITY_MAX)) {
@@ -440,6 +680,13 @@ int32_t uPortTaskCreate(void (*pFunction)(void *),
         pInfo->param = pParameter;
         if (pthread_create(&threadId, &attr, taskProc, (void *)pInfo) == 0) {
             *pTaskHandle = (void *)threadId;
+            if (pName != NULL) {
+                // So that the name shows up in uPortTaskStatsGet(),
+                // ps, top, gdb, etc.; Linux allows 15 characters
+                char name[16] = {0};
+                strncpy(name, pName, sizeof(name) - 1);
+                pthread_setname_np(threadId, name);
+            }
             errorCode = U_ERROR_COMMON_SUCCESS;
             MTX_FN(uPortMutexLock(gMutexThread));
             uLinkedListAdd(&gpThreadList, (void *)threadId);
@@ -500,6 +747,39 @@ int32_t uPortTaskGetHandle(uPortTaskHandle_t *pTaskHandle)
     return (int32_t) errorCode;
 }
 
+// Get the statistics of all tasks, here the threads of this process.
+int32_t uPortTaskStatsGet(uPortTaskStats_t *pStats, size_t numStats,
+                          int64_t *pTotalRunTime)
+{
+    uErrorCode_t errorCodeOrNumber = U_ERROR_COMMON_INVALID_PARAMETER;
+    DIR *pDir;
+    struct dirent *pEntry;
+    int32_t count = 0;
+
+    if ((pStats != NULL) || (numStats == 0)) {
+        errorCodeOrNumber = U_ERROR_COMMON_PLATFORM;
+        pDir = opendir("/proc/self/task");
+        if (pDir != NULL) {
+            while (((pEntry = readdir(pDir)) != NULL) &&
+                   ((pStats == NULL) || (count < (int32_t) numStats))) {
+                if (pEntry->d_name[0] != '.') {
+                    if (pStats != NULL) {
+                        readProcTaskStats(pEntry->d_name, pStats + count);
+                    }
+                    count++;
+                }
+            }
+            closedir(pDir);
+            errorCodeOrNumber = (uErrorCode_t) count;
+        }
+        if (pTotalRunTime != NULL) {
+            *pTotalRunTime = readProcRunTimeUs("/proc/self/stat");
+        }
+    }
+
+    return (int32_t) errorCodeOrNumber;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: QUEUES
  * -------------------------------------------------------------- */
@@ -882,30 +1162,30 @@ int32_t uPortTimerCreate(uPortTimerHandle_t *pTimerHandle,
                          bool periodic)
 {
     (void)pName;
-    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-    if (pTimerHandle != NULL) {
-        errorCode = U_ERROR_COMMON_NO_MEMORY;
-        uPortTimer_t *pTimer = pUPortMalloc(sizeof(uPortTimer_t));
-        if (pTimer != NULL) {
-            errorCode = U_ERROR_COMMON_PLATFORM;
-            struct sigevent sev = {0};
-            sev.sigev_notify = SIGEV_THREAD;
-            sev.sigev_notify_function = timerCallback;
-            sev.sigev_value.sival_ptr = (void *)pTimer;
-            pTimer->periodic = periodic;
-            pTimer->pCallback = pCallback;
-            pTimer->pCallbackParam = pCallbackParam;
-            msToTimeSpec((int32_t)intervalMs, &(pTimer->timerSpec.it_value), false);
-            msToTimeSpec(pTimer->periodic ? (int32_t)intervalMs : 0,
-                         &(pTimer->timerSpec.it_interval), false);
-            if (timer_create(CLOCK_REALTIME, &sev, &(pTimer->timerId)) == 0) {
-                *pTimerHandle = (uPortTimerHandle_t *)pTimer;
-                errorCode = U_ERROR_COMMON_SUCCESS;
-                U_ATOMIC_INCREMENT(&gResourceAllocCount);
-                U_PORT_OS_DEBUG_PRINT_TIMER_CREATE(*pTimerHandle, pName, intervalMs, periodic);
-            } else {
-                uPortFree(pTimer);
+    uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    if (gMutexTimer != NULL) {
+        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pTimerHandle != NULL) {
+            MTX_FN(uPortMutexLock(gMutexTimer));
+            errorCode = timerThreadStart();
+            if (errorCode == U_ERROR_COMMON_SUCCESS) {
+                errorCode = U_ERROR_COMMON_NO_MEMORY;
+                uPortTimer_t *pTimer = pUPortMalloc(sizeof(uPortTimer_t));
+                if (pTimer != NULL) {
+                    memset(pTimer, 0, sizeof(*pTimer));
+                    pTimer->intervalMs = intervalMs;
+                    pTimer->periodic = periodic;
+                    pTimer->pCallback = pCallback;
+                    pTimer->pCallbackParam = pCallbackParam;
+                    pTimer->pNext = gpTimerList;
+                    gpTimerList = pTimer;
+                    *pTimerHandle = (uPortTimerHandle_t *)pTimer;
+                    errorCode = U_ERROR_COMMON_SUCCESS;
+                    U_ATOMIC_INCREMENT(&gResourceAllocCount);
+                    U_PORT_OS_DEBUG_PRINT_TIMER_CREATE(*pTimerHandle, pName, intervalMs, periodic);
+                }
             }
+            MTX_FN(uPortMutexUnlock(gMutexTimer));
         }
     }
     return (int32_t)errorCode;
@@ -914,16 +1194,33 @@ int32_t uPortTimerCreate(uPortTimerHandle_t *pTimerHandle,
 // Destroy a timer.
 int32_t uPortTimerDelete(const uPortTimerHandle_t timerHandle)
 {
-    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-    if (timerHandle != NULL) {
-        errorCode = U_ERROR_COMMON_PLATFORM;
-        uPortTimer_t *pTimer = (uPortTimer_t *)timerHandle;
-        if (timer_delete(pTimer->timerId) == 0) {
-            uPortFree(pTimer);
+    uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    if (gMutexTimer != NULL) {
+        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        MTX_FN(uPortMutexLock(gMutexTimer));
+        uPortTimer_t **ppTimer = &gpTimerList;
+        while ((*ppTimer != NULL) && (*ppTimer != (uPortTimer_t *)timerHandle)) {
+            ppTimer = &((*ppTimer)->pNext);
+        }
+        if (*ppTimer != NULL) {
+            uPortTimer_t *pTimer = *ppTimer;
+            *ppTimer = pTimer->pNext;
+            if (pTimer->active) {
+                timerActiveRemove(pTimer);
+                timerFdSet();
+            }
+            if (pTimer == gpTimerCallback) {
+                // The timer thread is in the callback of this
+                // timer: it will do the freeing
+                pTimer->deleted = true;
+            } else {
+                uPortFree(pTimer);
+            }
             errorCode = U_ERROR_COMMON_SUCCESS;
             U_ATOMIC_DECREMENT(&gResourceAllocCount);
             U_PORT_OS_DEBUG_PRINT_TIMER_DELETE(timerHandle);
         }
+        MTX_FN(uPortMutexUnlock(gMutexTimer));
     }
     return (int32_t)errorCode;
 }
@@ -931,12 +1228,20 @@ int32_t uPortTimerDelete(const uPortTimerHandle_t timerHandle)
 // Start a timer.
 int32_t uPortTimerStart(const uPortTimerHandle_t timerHandle)
 {
-    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-    if (timerHandle != NULL) {
-        errorCode = U_ERROR_COMMON_PLATFORM;
-        uPortTimer_t *pTimer = (uPortTimer_t *)timerHandle;
-        if (timer_settime(pTimer->timerId, 0, &(pTimer->timerSpec), NULL) == 0) {
+    uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    if (gMutexTimer != NULL) {
+        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        if (timerHandle != NULL) {
+            uPortTimer_t *pTimer = (uPortTimer_t *)timerHandle;
+            MTX_FN(uPortMutexLock(gMutexTimer));
+            if (pTimer->active) {
+                timerActiveRemove(pTimer);
+            }
+            pTimer->expiryNs = timerNowNs() + ((int64_t) pTimer->intervalMs * 1000000);
+            timerActiveAdd(pTimer);
+            timerFdSet();
             errorCode = U_ERROR_COMMON_SUCCESS;
+            MTX_FN(uPortMutexUnlock(gMutexTimer));
         }
     }
     return (int32_t)errorCode;
@@ -945,30 +1250,39 @@ int32_t uPortTimerStart(const uPortTimerHandle_t timerHandle)
 // Stop a timer.
 int32_t uPortTimerStop(const uPortTimerHandle_t timerHandle)
 {
-    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-    if (timerHandle != NULL) {
-        errorCode = U_ERROR_COMMON_PLATFORM;
-        uPortTimer_t *pTimer = (uPortTimer_t *)timerHandle;
-        struct itimerspec its;
-        memset(&its, 0, sizeof(its));
-        if (timer_settime(pTimer->timerId, 0, &its, NULL) == 0) {
+    uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    if (gMutexTimer != NULL) {
+        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        if (timerHandle != NULL) {
+            uPortTimer_t *pTimer = (uPortTimer_t *)timerHandle;
+            MTX_FN(uPortMutexLock(gMutexTimer));
+            if (pTimer->active) {
+                timerActiveRemove(pTimer);
+                timerFdSet();
+            }
             errorCode = U_ERROR_COMMON_SUCCESS;
+            MTX_FN(uPortMutexUnlock(gMutexTimer));
         }
     }
     return (int32_t)errorCode;
 }
 
-// Change a timer interval.
+// Change a timer interval; a running timer keeps its current
+// expiry time, the new interval applying from its next start
+// or, if it is periodic, its next reload.
 int32_t uPortTimerChange(const uPortTimerHandle_t timerHandle,
                          uint32_t intervalMs)
 {
-    uErrorCode_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-    if (timerHandle != NULL) {
-        errorCode = U_ERROR_COMMON_SUCCESS;
-        uPortTimer_t *pTimer = (uPortTimer_t *)timerHandle;
-        msToTimeSpec((int32_t)intervalMs, &(pTimer->timerSpec.it_value), false);
-        msToTimeSpec(pTimer->periodic ? (int32_t)intervalMs : 0,
-                     &(pTimer->timerSpec.it_interval), false);
+    uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    if (gMutexTimer != NULL) {
+        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        if (timerHandle != NULL) {
+            uPortTimer_t *pTimer = (uPortTimer_t *)timerHandle;
+            MTX_FN(uPortMutexLock(gMutexTimer));
+            pTimer->intervalMs = intervalMs;
+            errorCode = U_ERROR_COMMON_SUCCESS;
+            MTX_FN(uPortMutexUnlock(gMutexTimer));
+        }
     }
     return (int32_t)errorCode;
 }
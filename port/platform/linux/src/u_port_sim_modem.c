@@ -0,0 +1,1374 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Implementation of a simulated SARA-R5 cellular module, as
+ * a virtual serial device, on Linux.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "stdlib.h"    // strtol()
+#include "stdarg.h"    // va_list
+#include "stdio.h"     // vsnprintf()
+#include "string.h"    // memcpy(), strncmp()
+
+#include "unistd.h"
+#include "poll.h"
+#include "netdb.h"      // getaddrinfo()
+#include "sys/ioctl.h"  // FIONREAD
+#include "sys/socket.h"
+#include "netinet/in.h"
+#include "arpa/inet.h"  // inet_pton(), inet_ntop()
+
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port_clib_platform_specific.h" /* Integer stdio, must be included
+                                              before the other port files if
+                                              any print or scan function is used. */
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_event_queue.h"
+
+#include "u_ringbuffer.h"
+
+#include "u_interface.h"
+#include "u_device_serial.h"
+
+#include "u_port_sim_modem.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The longest command line the simulated module will accept;
+ * characters beyond this are dropped.
+ */
+#define U_PORT_SIM_MODEM_LINE_LENGTH_BYTES 256
+
+/** The most data that can be sent or received in one go, as for
+ * a real SARA-R5 in binary mode.
+ */
+#define U_PORT_SIM_MODEM_DATA_LENGTH_MAX_BYTES 1024
+
+/** The size of the chunks in which responses are moved into the
+ * receive buffer.
+ */
+#define U_PORT_SIM_MODEM_CHUNK_LENGTH_BYTES 256
+
+/** Room to leave in the response buffer, over and above the data,
+ * for the text of a +USORD or +USORF response.
+ */
+#define U_PORT_SIM_MODEM_RESPONSE_OVERHEAD_BYTES 64
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A socket of the simulated module.
+ */
+typedef struct {
+    int fd;             /**< the host socket, -1 if not in use. */
+    bool isStream;
+    bool isConnected;
+    size_t notifiedSize; /**< the amount of received data last
+                              reported in a URC. */
+} uPortSimModemSocket_t;
+
+/** The context of a simulated module.
+ */
+typedef struct {
+    uPortMutexHandle_t mutex;
+    uPortTaskHandle_t taskHandle;
+    bool taskExit;
+    bool isOpen;
+    uPortSimModemCfg_t cfg;
+    char line[U_PORT_SIM_MODEM_LINE_LENGTH_BYTES];
+    size_t lineLength;
+    char commandCallbackResponse[U_PORT_SIM_MODEM_COMMAND_CALLBACK_RESPONSE_LENGTH_BYTES];
+    int32_t dataSocket;   /**< the socket that data is being
+                               written to, -1 if in command mode. */
+    bool dataIsSendTo;    /**< true for AT+USOST, false for AT+USOWR. */
+    struct sockaddr_in dataAddress;
+    char data[U_PORT_SIM_MODEM_DATA_LENGTH_MAX_BYTES];
+    size_t dataLength;
+    size_t dataIndex;
+    char *pResponseBuffer;
+    uRingBuffer_t response; /**< responses not yet released to rx. */
+    int32_t responseTimeMs; /**< when the responses may start to be released. */
+    char *pRxBuffer;
+    uRingBuffer_t rx;       /**< what can be read by the AT client. */
+    uPortSimModemSocket_t socket[U_PORT_SIM_MODEM_NUM_SOCKETS];
+    int32_t unknownCount;
+    int32_t eventQueueHandle;
+    uint32_t eventFilter;
+    void (*pEventCallback)(struct uDeviceSerial_t *, uint32_t, void *);
+    void *pEventCallbackParam;
+} uPortSimModemContext_t;
+
+/** The event passed through the event queue of a simulated module.
+ */
+typedef struct {
+    struct uDeviceSerial_t *pDeviceSerial;
+    uint32_t eventBitMap;
+} uPortSimModemEvent_t;
+
+/** A built-in command handler: pParams points to the text after
+ * the "=" (or to an empty string if there is none); the mutex is
+ * locked.
+ */
+typedef void (*uPortSimModemHandler_t)(uPortSimModemContext_t *pContext,
+                                       const char *pParams);
+
+/** A built-in command.
+ */
+typedef struct {
+    const char *pCommand; /**< the start of the command line, without
+                               the "AT". */
+    uPortSimModemHandler_t pHandler;
+} uPortSimModemCommand_t;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: RESPONSES AND PARAMETERS
+ * -------------------------------------------------------------- */
+
+// Queue a response of the given length; the mutex must be locked.
+static bool respondBytes(uPortSimModemContext_t *pContext,
+                         const char *pData, size_t length)
+{
+    if (uRingBufferDataSize(&(pContext->response)) == 0) {
+        // The response delay runs from the first response that
+        // is queued when nothing is outstanding
+        pContext->responseTimeMs = uPortGetTickTimeMs() + pContext->cfg.responseDelayMs;
+    }
+
+    return uRingBufferAdd(&(pContext->response), pData, length);
+}
+
+// Queue a formatted response; the mutex must be locked.
+static bool respond(uPortSimModemContext_t *pContext, const char *pFormat, ...)
+{
+    bool success = false;
+    char buffer[U_PORT_SIM_MODEM_LINE_LENGTH_BYTES];
+    va_list args;
+    int32_t length;
+
+    va_start(args, pFormat);
+    length = vsnprintf(buffer, sizeof(buffer), pFormat, args);
+    va_end(args);
+    if ((length > 0) && (length < (int32_t) sizeof(buffer))) {
+        success = respondBytes(pContext, buffer, length);
+    }
+
+    return success;
+}
+
+// Respond with OK.
+static void respondOk(uPortSimModemContext_t *pContext)
+{
+    respond(pContext, "\r\nOK\r\n");
+}
+
+// Respond with ERROR.
+static void respondError(uPortSimModemContext_t *pContext)
+{
+    respond(pContext, "\r\nERROR\r\n");
+}
+
+// Read an integer parameter, moving *ppParams past it and any
+// following comma; returns -1 if there is no integer.
+static int32_t paramInt(const char **ppParams)
+{
+    int32_t value = -1;
+    char *pEnd = NULL;
+    long x = strtol(*ppParams, &pEnd, 10);
+
+    if (pEnd != *ppParams) {
+        value = (int32_t) x;
+        *ppParams = pEnd;
+    }
+    if (**ppParams == ',') {
+        (*ppParams)++;
+    }
+
+    return value;
+}
+
+// Read a quoted string parameter into pBuffer, moving *ppParams
+// past it and any following comma; returns false if there is no
+// quoted string or it does not fit.
+static bool paramString(const char **ppParams, char *pBuffer, size_t bufferSize)
+{
+    bool success = false;
+    const char *pStart = *ppParams;
+    const char *pEnd;
+    size_t length;
+
+    if (*pStart == '"') {
+        pStart++;
+        pEnd = strchr(pStart, '"');
+        if (pEnd != NULL) {
+            length = pEnd - pStart;
+            if (length < bufferSize) {
+                memcpy(pBuffer, pStart, length);
+                pBuffer[length] = 0;
+                success = true;
+            }
+            *ppParams = pEnd + 1;
+            if (**ppParams == ',') {
+                (*ppParams)++;
+            }
+        }
+    }
+
+    return success;
+}
+
+// Get the socket with the given number if it is in use, else NULL.
+static uPortSimModemSocket_t *pSocketGet(uPortSimModemContext_t *pContext,
+                                         int32_t number)
+{
+    uPortSimModemSocket_t *pSocket = NULL;
+
+    if ((number >= 0) && (number < U_PORT_SIM_MODEM_NUM_SOCKETS) &&
+        (pContext->socket[number].fd >= 0)) {
+        pSocket = &(pContext->socket[number]);
+    }
+
+    return pSocket;
+}
+
+// Close a socket.
+static void socketClose(uPortSimModemSocket_t *pSocket)
+{
+    if (pSocket->fd >= 0) {
+        close(pSocket->fd);
+    }
+    pSocket->fd = -1;
+    pSocket->isConnected = false;
+    pSocket->notifiedSize = 0;
+}
+
+// Get the amount of data waiting on a socket, which for UDP is
+// the size of the next datagram.
+static size_t socketAvailable(const uPortSimModemSocket_t *pSocket)
+{
+    int available = 0;
+
+    if ((ioctl(pSocket->fd, FIONREAD, &available) != 0) || (available < 0)) {
+        available = 0;
+    }
+
+    return (size_t) available;
+}
+
+// Get the amount of data that a single +USORD or +USORF response
+// may carry without overflowing the response buffer.
+static size_t responseRoom(uPortSimModemContext_t *pContext)
+{
+    size_t room = uRingBufferAvailableSize(&(pContext->response));
+
+    if (room > U_PORT_SIM_MODEM_RESPONSE_OVERHEAD_BYTES) {
+        room -= U_PORT_SIM_MODEM_RESPONSE_OVERHEAD_BYTES;
+    } else {
+        room = 0;
+    }
+    if (room > U_PORT_SIM_MODEM_DATA_LENGTH_MAX_BYTES) {
+        room = U_PORT_SIM_MODEM_DATA_LENGTH_MAX_BYTES;
+    }
+
+    return room;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: BUILT-IN COMMANDS
+ * -------------------------------------------------------------- */
+
+// AT+USOCR=<protocol>[,<local port>[,<IP type>[,<profile>]]]: create
+// a socket; the IP type must be 0 (IPV4) and the profile, which binds
+// the socket to a PDP context, must be 0 to 6 as on SARA-R5 but otherwise
+// makes no difference to the host socket.
+static void handleUsocr(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    int32_t protocol = paramInt(&pParams);
+    int32_t localPort = paramInt(&pParams);
+    int32_t ipType = paramInt(&pParams);
+    int32_t profileId = paramInt(&pParams);
+    int32_t number = -1;
+    uPortSimModemSocket_t *pSocket;
+    struct sockaddr_in address = {0};
+
+    for (int32_t x = 0; (x < U_PORT_SIM_MODEM_NUM_SOCKETS) && (number < 0); x++) {
+        if (pContext->socket[x].fd < 0) {
+            number = x;
+        }
+    }
+    if ((number >= 0) && ((protocol == 6) || (protocol == 17)) &&
+        (ipType <= 0) && (profileId <= 6)) {
+        pSocket = &(pContext->socket[number]);
+        pSocket->isStream = (protocol == 6);
+        pSocket->fd = socket(AF_INET, pSocket->isStream ? SOCK_STREAM : SOCK_DGRAM, 0);
+        if ((pSocket->fd >= 0) && (localPort > 0)) {
+            address.sin_family = AF_INET;
+            address.sin_port = htons((uint16_t) localPort);
+            address.sin_addr.s_addr = htonl(INADDR_ANY);
+            if (bind(pSocket->fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+                socketClose(pSocket);
+            }
+        }
+        if (pSocket->fd >= 0) {
+            respond(pContext, "\r\n+USOCR: %d\r\n\r\nOK\r\n", (int) number);
+        } else {
+            respondError(pContext);
+        }
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+USOCO=<socket>,"<IP address>",<port>: connect a socket; this
+// blocks, as the real thing does.
+static void handleUsoco(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, paramInt(&pParams));
+    char ipAddress[INET_ADDRSTRLEN];
+    struct sockaddr_in address = {0};
+    int32_t port;
+
+    if ((pSocket != NULL) && paramString(&pParams, ipAddress, sizeof(ipAddress))) {
+        port = paramInt(&pParams);
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t) port);
+        if ((port > 0) && (inet_pton(AF_INET, ipAddress, &(address.sin_addr)) == 1) &&
+            (connect(pSocket->fd, (struct sockaddr *) &address, sizeof(address)) == 0)) {
+            pSocket->isConnected = true;
+            respondOk(pContext);
+        } else {
+            respondError(pContext);
+        }
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+USOWR=<socket>,<length>: send data on a connected socket, the
+// data following the "@" prompt.
+static void handleUsowr(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    int32_t number = paramInt(&pParams);
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, number);
+    int32_t length = paramInt(&pParams);
+
+    if ((pSocket != NULL) && pSocket->isConnected && (length > 0) &&
+        (length <= U_PORT_SIM_MODEM_DATA_LENGTH_MAX_BYTES)) {
+        pContext->dataSocket = number;
+        pContext->dataIsSendTo = false;
+        pContext->dataLength = length;
+        pContext->dataIndex = 0;
+        respond(pContext, "@");
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+USOST=<socket>,"<IP address>",<port>,<length>: send a datagram,
+// the data following the "@" prompt.
+static void handleUsost(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    int32_t number = paramInt(&pParams);
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, number);
+    char ipAddress[INET_ADDRSTRLEN];
+    int32_t port;
+    int32_t length;
+
+    if ((pSocket != NULL) && !pSocket->isStream &&
+        paramString(&pParams, ipAddress, sizeof(ipAddress))) {
+        port = paramInt(&pParams);
+        length = paramInt(&pParams);
+        memset(&(pContext->dataAddress), 0, sizeof(pContext->dataAddress));
+        pContext->dataAddress.sin_family = AF_INET;
+        pContext->dataAddress.sin_port = htons((uint16_t) port);
+        if ((port > 0) && (length > 0) && (length <= U_PORT_SIM_MODEM_DATA_LENGTH_MAX_BYTES) &&
+            (inet_pton(AF_INET, ipAddress, &(pContext->dataAddress.sin_addr)) == 1)) {
+            pContext->dataSocket = number;
+            pContext->dataIsSendTo = true;
+            pContext->dataLength = length;
+            pContext->dataIndex = 0;
+            respond(pContext, "@");
+        } else {
+            respondError(pContext);
+        }
+    } else {
+        respondError(pContext);
+    }
+}
+
+// Called when all of the data following the "@" prompt has arrived.
+static void dataComplete(uPortSimModemContext_t *pContext)
+{
+    int32_t number = pContext->dataSocket;
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, number);
+    ssize_t sent = -1;
+
+    pContext->dataSocket = -1;
+    if (pSocket != NULL) {
+        if (pContext->dataIsSendTo) {
+            sent = sendto(pSocket->fd, pContext->data, pContext->dataLength, MSG_NOSIGNAL,
+                          (struct sockaddr *) &(pContext->dataAddress),
+                          sizeof(pContext->dataAddress));
+        } else {
+            sent = send(pSocket->fd, pContext->data, pContext->dataLength, MSG_NOSIGNAL);
+        }
+    }
+    if (sent >= 0) {
+        respond(pContext, "\r\n%s: %d,%d\r\n\r\nOK\r\n",
+                pContext->dataIsSendTo ? "+USOST" : "+USOWR",
+                (int) number, (int) sent);
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+USORD=<socket>,<length>: read from a connected socket or, if
+// length is zero, just say how much there is to read.
+static void handleUsord(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    int32_t number = paramInt(&pParams);
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, number);
+    int32_t length = paramInt(&pParams);
+    size_t available;
+    ssize_t received = 0;
+
+    if ((pSocket != NULL) && pSocket->isStream && (length >= 0)) {
+        available = socketAvailable(pSocket);
+        if (length == 0) {
+            pSocket->notifiedSize = available;
+            respond(pContext, "\r\n+USORD: %d,%d\r\n\r\nOK\r\n",
+                    (int) number, (int) available);
+        } else {
+            if ((size_t) length > available) {
+                length = (int32_t) available;
+            }
+            if ((size_t) length > responseRoom(pContext)) {
+                length = (int32_t) responseRoom(pContext);
+            }
+            if (length > 0) {
+                received = recv(pSocket->fd, pContext->data, length, MSG_DONTWAIT);
+                if (received < 0) {
+                    received = 0;
+                }
+            }
+            pSocket->notifiedSize = socketAvailable(pSocket);
+            respond(pContext, "\r\n+USORD: %d,%d,\"", (int) number, (int) received);
+            respondBytes(pContext, pContext->data, received);
+            respond(pContext, "\"\r\n\r\nOK\r\n");
+        }
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+USORF=<socket>,<length>: read a datagram or, if length is
+// zero, just say how big the next one is.
+static void handleUsorf(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    int32_t number = paramInt(&pParams);
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, number);
+    int32_t length = paramInt(&pParams);
+    size_t available;
+    ssize_t received = 0;
+    struct sockaddr_in address = {0};
+    socklen_t addressLength = sizeof(address);
+    char ipAddress[INET_ADDRSTRLEN] = {0};
+
+    if ((pSocket != NULL) && !pSocket->isStream && (length >= 0)) {
+        available = socketAvailable(pSocket);
+        if (length == 0) {
+            pSocket->notifiedSize = available;
+            respond(pContext, "\r\n+USORF: %d,%d\r\n\r\nOK\r\n",
+                    (int) number, (int) available);
+        } else {
+            if ((size_t) length > responseRoom(pContext)) {
+                length = (int32_t) responseRoom(pContext);
+            }
+            if (available > 0) {
+                // Whatever doesn't fit of the datagram is lost,
+                // as with a real module
+                received = recvfrom(pSocket->fd, pContext->data, length, MSG_DONTWAIT,
+                                    (struct sockaddr *) &address, &addressLength);
+            }
+            pSocket->notifiedSize = 0;
+            if (received > 0) {
+                inet_ntop(AF_INET, &(address.sin_addr), ipAddress, sizeof(ipAddress));
+                respond(pContext, "\r\n+USORF: %d,\"%s\",%d,%d,\"", (int) number,
+                        ipAddress, (int) ntohs(address.sin_port), (int) received);
+                respondBytes(pContext, pContext->data, received);
+                respond(pContext, "\"\r\n\r\nOK\r\n");
+            } else {
+                respond(pContext, "\r\n+USORF: %d,\"\",0,0,\"\"\r\n\r\nOK\r\n", (int) number);
+            }
+        }
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+USOCL=<socket>[,<async>]: close a socket.
+static void handleUsocl(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    int32_t number = paramInt(&pParams);
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, number);
+    bool async = (paramInt(&pParams) == 1);
+
+    if (pSocket != NULL) {
+        socketClose(pSocket);
+        respondOk(pContext);
+        if (async) {
+            respond(pContext, "\r\n+UUSOCL: %d\r\n", (int) number);
+        }
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+USOER: the last socket error, which is always none.
+static void handleUsoer(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    (void) pParams;
+    respond(pContext, "\r\n+USOER: 0\r\n\r\nOK\r\n");
+}
+
+// AT+USOCTL=<socket>,<parameter>: query a socket; parameter 0,
+// the protocol, is answered properly, zero is returned for
+// everything else.
+static void handleUsoctl(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    int32_t number = paramInt(&pParams);
+    int32_t parameter = paramInt(&pParams);
+    uPortSimModemSocket_t *pSocket = pSocketGet(pContext, number);
+    int32_t value = 0;
+
+    if (pSocket != NULL) {
+        if (parameter == 0) {
+            value = pSocket->isStream ? 6 : 17;
+        }
+        respond(pContext, "\r\n+USOCTL: %d,%d,%d\r\n\r\nOK\r\n",
+                (int) number, (int) parameter, (int) value);
+    } else {
+        respondError(pContext);
+    }
+}
+
+// AT+UDNSRN=0,"<domain name>": look up an IPv4 address.
+static void handleUdnsrn(uPortSimModemContext_t *pContext, const char *pParams)
+{
+    char name[U_PORT_SIM_MODEM_LINE_LENGTH_BYTES];
+    char ipAddress[INET_ADDRSTRLEN];
+    struct addrinfo hints = {0};
+    struct addrinfo *pResult = NULL;
+
+    hints.ai_family = AF_INET;
+    if ((paramInt(&pParams) == 0) && paramString(&pParams, name, sizeof(name)) &&
+        (getaddrinfo(name, NULL, &hints, &pResult) == 0) && (pResult != NULL)) {
+        inet_ntop(AF_INET, &(((struct sockaddr_in *) pResult->ai_addr)->sin_addr),
+                  ipAddress, sizeof(ipAddress));
+        respond(pContext, "\r\n+UDNSRN: \"%s\"\r\n\r\nOK\r\n", ipAddress);
+    } else {
+        respondError(pContext);
+    }
+    if (pResult != NULL) {
+        freeaddrinfo(pResult);
+    }
+}
+
+/** The built-in commands; anything else not in the script gets "OK".
+ */
+static const uPortSimModemCommand_t gCommand[] = {
+    {"+USOCR=", handleUsocr},
+    {"+USOCO=", handleUsoco},
+    {"+USOWR=", handleUsowr},
+    {"+USOST=", handleUsost},
+    {"+USORD=", handleUsord},
+    {"+USORF=", handleUsorf},
+    {"+USOCL=", handleUsocl},
+    {"+USOER", handleUsoer},
+    {"+USOCTL=", handleUsoctl},
+    {"+UDNSRN=", handleUdnsrn}
+};
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: COMMAND PROCESSING
+ * -------------------------------------------------------------- */
+
+// Process a complete command line; the mutex must be locked.
+static void lineProcess(uPortSimModemContext_t *pContext)
+{
+    const char *pLine = pContext->line;
+    const uPortSimModemScript_t *pScript = pContext->cfg.pScript;
+    bool done = false;
+    size_t length;
+    int32_t callbackLength;
+
+    pContext->line[pContext->lineLength] = 0;
+    if (((pLine[0] == 'A') || (pLine[0] == 'a')) &&
+        ((pLine[1] == 'T') || (pLine[1] == 't'))) {
+        pLine += 2;
+        if (pContext->cfg.pCommandCallback != NULL) {
+            callbackLength = pContext->cfg.pCommandCallback(pLine,
+                                                            pContext->commandCallbackResponse,
+                                                            sizeof(pContext->commandCallbackResponse),
+                                                            pContext->cfg.pCommandCallbackParam);
+            if (callbackLength >= 0) {
+                if (callbackLength > (int32_t) sizeof(pContext->commandCallbackResponse)) {
+                    callbackLength = sizeof(pContext->commandCallbackResponse);
+                }
+                respondBytes(pContext, pContext->commandCallbackResponse,
+                             callbackLength);
+                done = true;
+            }
+        }
+        for (size_t x = 0; (x < pContext->cfg.scriptLength) && !done; x++, pScript++) {
+            length = strlen(pScript->pCommand);
+            if (strncmp(pLine, pScript->pCommand, length) == 0) {
+                if (pScript->pResponse != NULL) {
+                    // Not respond(): a scripted response may
+                    // be longer than a line
+                    respondBytes(pContext, pScript->pResponse,
+                                 strlen(pScript->pResponse));
+                }
+                done = true;
+            }
+        }
+        for (size_t x = 0; (x < sizeof(gCommand) / sizeof(gCommand[0])) && !done; x++) {
+            length = strlen(gCommand[x].pCommand);
+            if (strncmp(pLine, gCommand[x].pCommand, length) == 0) {
+                gCommand[x].pHandler(pContext, pLine + length);
+                done = true;
+            }
+        }
+        if (!done) {
+            if (*pLine != 0) {
+                pContext->unknownCount++;
+            }
+            respondOk(pContext);
+        }
+    }
+}
+
+// Process bytes written to the simulated module; the mutex must
+// be locked.
+static void inputProcess(uPortSimModemContext_t *pContext,
+                         const char *pData, size_t length)
+{
+    size_t thisLength;
+
+    while (length > 0) {
+        if (pContext->dataSocket >= 0) {
+            // Data following an "@" prompt
+            thisLength = pContext->dataLength - pContext->dataIndex;
+            if (thisLength > length) {
+                thisLength = length;
+            }
+            memcpy(pContext->data + pContext->dataIndex, pData, thisLength);
+            pContext->dataIndex += thisLength;
+            pData += thisLength;
+            length -= thisLength;
+            if (pContext->dataIndex >= pContext->dataLength) {
+                dataComplete(pContext);
+            }
+        } else {
+            if (*pData == '\r') {
+                if (pContext->lineLength > 0) {
+                    lineProcess(pContext);
+                }
+                pContext->lineLength = 0;
+            } else if ((*pData != '\n') &&
+                       (pContext->lineLength < sizeof(pContext->line) - 1)) {
+                pContext->line[pContext->lineLength] = *pData;
+                pContext->lineLength++;
+            }
+            pData++;
+            length--;
+        }
+    }
+}
+
+// Check the host sockets for received data or closure, raising
+// URCs as a real module would; the mutex must be locked.
+static void socketsCheck(uPortSimModemContext_t *pContext)
+{
+    uPortSimModemSocket_t *pSocket;
+    struct pollfd pollFd;
+    size_t available;
+
+    for (int32_t x = 0; x < U_PORT_SIM_MODEM_NUM_SOCKETS; x++) {
+        pSocket = &(pContext->socket[x]);
+        if ((pSocket->fd >= 0) && (pSocket->isConnected || !pSocket->isStream)) {
+            pollFd.fd = pSocket->fd;
+            pollFd.events = POLLIN;
+            pollFd.revents = 0;
+            if (poll(&pollFd, 1, 0) > 0) {
+                available = socketAvailable(pSocket);
+                if (available > pSocket->notifiedSize) {
+                    if (respond(pContext, "\r\n%s: %d,%d\r\n",
+                                pSocket->isStream ? "+UUSORD" : "+UUSORF",
+                                (int) x, (int) available)) {
+                        pSocket->notifiedSize = available;
+                    }
+                } else if ((available == 0) && pSocket->isStream &&
+                           (pollFd.revents & (POLLIN | POLLHUP | POLLERR))) {
+                    // Nothing to read yet readable: the far end has gone
+                    if (respond(pContext, "\r\n+UUSOCL: %d\r\n", (int) x)) {
+                        socketClose(pSocket);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Move responses that are due into the receive buffer, as far as the
+// rate limit allows, returning true if anything was moved; the mutex
+// must be locked.
+static bool responseRelease(uPortSimModemContext_t *pContext, int32_t *pRateTimeMs)
+{
+    char buffer[U_PORT_SIM_MODEM_CHUNK_LENGTH_BYTES];
+    int32_t nowMs = uPortGetTickTimeMs();
+    size_t length = uRingBufferDataSize(&(pContext->response));
+    size_t thisLength;
+    int64_t allowance;
+    bool moved = false;
+
+    if (length == 0) {
+        *pRateTimeMs = nowMs;
+    } else if (nowMs - pContext->responseTimeMs >= 0) {
+        if (*pRateTimeMs - pContext->responseTimeMs < 0) {
+            // Don't give credit for time spent in the response delay
+            *pRateTimeMs = pContext->responseTimeMs;
+        }
+        if (pContext->cfg.bytesPerSecond > 0) {
+            allowance = (((int64_t) (nowMs - *pRateTimeMs)) * pContext->cfg.bytesPerSecond) / 1000;
+            if ((int64_t) length > allowance) {
+                length = (size_t) allowance;
+            }
+            *pRateTimeMs += (int32_t) (((int64_t) length * 1000) / pContext->cfg.bytesPerSecond);
+        }
+        if (length > uRingBufferAvailableSize(&(pContext->rx))) {
+            length = uRingBufferAvailableSize(&(pContext->rx));
+        }
+        while (length > 0) {
+            thisLength = uRingBufferRead(&(pContext->response), buffer,
+                                         length < sizeof(buffer) ? length : sizeof(buffer));
+            uRingBufferAdd(&(pContext->rx), buffer, thisLength);
+            length -= thisLength;
+            moved = true;
+        }
+    }
+
+    return moved;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: EVENTS
+ * -------------------------------------------------------------- */
+
+// Send an event, blocking if delayMs is less than zero, else trying
+// for up to delayMs; must NOT be called with the mutex locked since
+// the event handler locks it.  Note: uPortEventQueueSendIrq() is not
+// supported on Linux so the non-blocking case checks for room in the
+// queue and then uses uPortEventQueueSend().
+static int32_t sendEvent(struct uDeviceSerial_t *pDeviceSerial,
+                         int32_t eventQueueHandle,
+                         uint32_t eventBitMap, int32_t delayMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortSimModemEvent_t event;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    if (eventQueueHandle >= 0) {
+        event.pDeviceSerial = pDeviceSerial;
+        event.eventBitMap = eventBitMap;
+        if (delayMs < 0) {
+            errorCode = uPortEventQueueSend(eventQueueHandle, &event, sizeof(event));
+        } else {
+            do {
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                if (uPortEventQueueGetFree(eventQueueHandle) > 0) {
+                    errorCode = uPortEventQueueSend(eventQueueHandle, &event, sizeof(event));
+                }
+                if ((errorCode != 0) && (delayMs > 0)) {
+                    uPortTaskBlock(U_CFG_OS_YIELD_MS);
+                }
+            } while ((errorCode != 0) && (uPortGetTickTimeMs() - startTimeMs < delayMs));
+        }
+    }
+
+    return errorCode;
+}
+
+// Return the event queue handle if an event callback is set
+// for eventBitMap, else -1; the mutex must be locked.
+static int32_t eventQueueGet(const uPortSimModemContext_t *pContext,
+                             uint32_t eventBitMap)
+{
+    int32_t eventQueueHandle = -1;
+
+    if ((pContext->pEventCallback != NULL) && (pContext->eventFilter & eventBitMap)) {
+        eventQueueHandle = pContext->eventQueueHandle;
+    }
+
+    return eventQueueHandle;
+}
+
+// Event handler for all simulated modules.
+static void eventHandler(void *pParam, size_t paramLength)
+{
+    uPortSimModemEvent_t *pEvent = (uPortSimModemEvent_t *) pParam;
+    uPortSimModemContext_t *pContext;
+    void (*pEventCallback)(struct uDeviceSerial_t *, uint32_t, void *) = NULL;
+    void *pEventCallbackParam = NULL;
+
+    (void) paramLength;
+
+    pContext = (uPortSimModemContext_t *) pUInterfaceContext(pEvent->pDeviceSerial);
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (pContext->eventFilter & pEvent->eventBitMap) {
+            pEventCallback = pContext->pEventCallback;
+            pEventCallbackParam = pContext->pEventCallbackParam;
+        }
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        // Call the callback outside the lock since it will
+        // likely want to read from the device
+        if (pEventCallback != NULL) {
+            pEventCallback(pEvent->pDeviceSerial, pEvent->eventBitMap,
+                           pEventCallbackParam);
+        }
+    }
+}
+
+// The task that runs a simulated module.
+static void simModemTask(void *pParam)
+{
+    struct uDeviceSerial_t *pDeviceSerial = (struct uDeviceSerial_t *) pParam;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+    int32_t rateTimeMs = uPortGetTickTimeMs();
+    int32_t eventQueueHandle;
+    bool exit;
+
+    do {
+        eventQueueHandle = -1;
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (pContext->isOpen) {
+            socketsCheck(pContext);
+            if (responseRelease(pContext, &rateTimeMs)) {
+                eventQueueHandle = eventQueueGet(pContext,
+                                                 U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED);
+            }
+        }
+        exit = pContext->taskExit;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        sendEvent(pDeviceSerial, eventQueueHandle,
+                  U_DEVICE_SERIAL_EVENT_BITMASK_DATA_RECEIVED, 0);
+        if (!exit) {
+            uPortTaskBlock(U_PORT_SIM_MODEM_TICK_MS);
+        }
+    } while (!exit);
+
+    U_PORT_MUTEX_LOCK(pContext->mutex);
+    pContext->taskHandle = NULL;
+    U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+    uPortTaskDelete(NULL);
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: SERIAL DEVICE
+ * -------------------------------------------------------------- */
+
+// Open the simulated module.
+static int32_t serialOpen(struct uDeviceSerial_t *pDeviceSerial,
+                          void *pReceiveBuffer, size_t receiveBufferSizeBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    // The simulated module has a receive buffer of its own
+    (void) pReceiveBuffer;
+    (void) receiveBufferSizeBytes;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (!pContext->isOpen) {
+            uRingBufferReset(&(pContext->response));
+            uRingBufferReset(&(pContext->rx));
+            pContext->lineLength = 0;
+            pContext->dataSocket = -1;
+            pContext->isOpen = true;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCode;
+}
+
+// Close the simulated module, which also closes any sockets.
+static void serialClose(struct uDeviceSerial_t *pDeviceSerial)
+{
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        for (size_t x = 0; x < U_PORT_SIM_MODEM_NUM_SOCKETS; x++) {
+            socketClose(&(pContext->socket[x]));
+        }
+        pContext->isOpen = false;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+}
+
+// Get the number of bytes that may be read.
+static int32_t serialGetReceiveSize(struct uDeviceSerial_t *pDeviceSerial)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->isOpen) {
+            errorCodeOrSize = (int32_t) uRingBufferDataSize(&(pContext->rx));
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrSize;
+}
+
+// Read what the simulated module has sent.
+static int32_t serialRead(struct uDeviceSerial_t *pDeviceSerial,
+                          void *pBuffer, size_t sizeBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->isOpen) {
+            errorCodeOrLength = (int32_t) uRingBufferRead(&(pContext->rx),
+                                                          (char *) pBuffer, sizeBytes);
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrLength;
+}
+
+// Write to the simulated module; commands and data are processed
+// as they arrive, in the context of the caller.
+static int32_t serialWrite(struct uDeviceSerial_t *pDeviceSerial,
+                           const void *pBuffer, size_t sizeBytes)
+{
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->isOpen) {
+            inputProcess(pContext, (const char *) pBuffer, sizeBytes);
+            errorCodeOrLength = (int32_t) sizeBytes;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrLength;
+}
+
+// Set the event callback.
+static int32_t serialEventCallbackSet(struct uDeviceSerial_t *pDeviceSerial,
+                                      uint32_t filter,
+                                      void (*pFunction)(struct uDeviceSerial_t *,
+                                                        uint32_t,
+                                                        void *),
+                                      void *pParam,
+                                      size_t stackSizeBytes,
+                                      int32_t priority)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if ((pContext != NULL) && (pFunction != NULL) && (filter != 0)) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->pEventCallback == NULL) {
+            errorCode = uPortEventQueueOpen(eventHandler, "simModem",
+                                            sizeof(uPortSimModemEvent_t),
+                                            stackSizeBytes, priority,
+                                            U_PORT_SIM_MODEM_CALLBACK_QUEUE_LENGTH);
+            if (errorCode >= 0) {
+                pContext->eventQueueHandle = errorCode;
+                pContext->eventFilter = filter;
+                pContext->pEventCallback = pFunction;
+                pContext->pEventCallbackParam = pParam;
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCode;
+}
+
+// Remove the event callback.
+static void serialEventCallbackRemove(struct uDeviceSerial_t *pDeviceSerial)
+{
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+    int32_t eventQueueHandle = -1;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->pEventCallback != NULL) {
+            eventQueueHandle = pContext->eventQueueHandle;
+            pContext->eventQueueHandle = -1;
+            pContext->pEventCallback = NULL;
+            pContext->eventFilter = 0;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+        // Close the queue outside the lock as the event
+        // handler may be waiting on it
+        if (eventQueueHandle >= 0) {
+            uPortEventQueueClose(eventQueueHandle);
+        }
+    }
+}
+
+// Get the event callback filter.
+static uint32_t serialEventCallbackFilterGet(struct uDeviceSerial_t *pDeviceSerial)
+{
+    uint32_t filter = 0;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        filter = pContext->eventFilter;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return filter;
+}
+
+// Change the event callback filter.
+static int32_t serialEventCallbackFilterSet(struct uDeviceSerial_t *pDeviceSerial,
+                                            uint32_t filter)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if ((pContext != NULL) && (filter != 0)) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        if (pContext->pEventCallback != NULL) {
+            pContext->eventFilter = filter;
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCode;
+}
+
+// Send an event to the event callback.
+static int32_t serialEventSend(struct uDeviceSerial_t *pDeviceSerial,
+                               uint32_t eventBitMap)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+    int32_t eventQueueHandle;
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        eventQueueHandle = eventQueueGet(pContext, eventBitMap);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        errorCode = sendEvent(pDeviceSerial, eventQueueHandle, eventBitMap, -1);
+    }
+
+    return errorCode;
+}
+
+// Try to send an event to the event callback.
+static int32_t serialEventTrySend(struct uDeviceSerial_t *pDeviceSerial,
+                                  uint32_t eventBitMap, int32_t delayMs)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+    int32_t eventQueueHandle;
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        eventQueueHandle = eventQueueGet(pContext, eventBitMap);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        errorCode = sendEvent(pDeviceSerial, eventQueueHandle, eventBitMap, delayMs);
+    }
+
+    return errorCode;
+}
+
+// Return whether we're in the event callback or not.
+static bool serialEventIsCallback(struct uDeviceSerial_t *pDeviceSerial)
+{
+    bool isCallback = false;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (pContext->eventQueueHandle >= 0) {
+            isCallback = uPortEventQueueIsTask(pContext->eventQueueHandle);
+        }
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return isCallback;
+}
+
+// Return the minimum free stack of the event callback task.
+static int32_t serialEventStackMinFree(struct uDeviceSerial_t *pDeviceSerial)
+{
+    int32_t errorCodeOrStackMinFree = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext = (uPortSimModemContext_t *)
+                                       pUInterfaceContext(pDeviceSerial);
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (pContext->eventQueueHandle >= 0) {
+            errorCodeOrStackMinFree = uPortEventQueueStackMinFree(pContext->eventQueueHandle);
+        }
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrStackMinFree;
+}
+
+// Populate the vector table; flow control and discard on
+// overflow are left at their defaults since they have no meaning
+// for a simulated module.
+static void initSerialInterface(struct uDeviceSerial_t *pDeviceSerial)
+{
+    pDeviceSerial->open = serialOpen;
+    pDeviceSerial->close = serialClose;
+    pDeviceSerial->getReceiveSize = serialGetReceiveSize;
+    pDeviceSerial->read = serialRead;
+    pDeviceSerial->write = serialWrite;
+    pDeviceSerial->eventCallbackSet = serialEventCallbackSet;
+    pDeviceSerial->eventCallbackRemove = serialEventCallbackRemove;
+    pDeviceSerial->eventCallbackFilterGet = serialEventCallbackFilterGet;
+    pDeviceSerial->eventCallbackFilterSet = serialEventCallbackFilterSet;
+    pDeviceSerial->eventSend = serialEventSend;
+    pDeviceSerial->eventTrySend = serialEventTrySend;
+    pDeviceSerial->eventIsCallback = serialEventIsCallback;
+    pDeviceSerial->eventStackMinFree = serialEventStackMinFree;
+}
+
+// Free the resources of a simulated module, other than the
+// device itself.
+static void contextFree(uPortSimModemContext_t *pContext)
+{
+    bool taskRunning = true;
+
+    if (pContext->mutex != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        pContext->taskExit = true;
+        taskRunning = (pContext->taskHandle != NULL);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        while (taskRunning) {
+            uPortTaskBlock(U_PORT_SIM_MODEM_TICK_MS);
+            U_PORT_MUTEX_LOCK(pContext->mutex);
+            taskRunning = (pContext->taskHandle != NULL);
+            U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        }
+        // Make sure the task has gone before the mutex does
+        uPortTaskBlock(U_CFG_OS_YIELD_MS);
+        uPortMutexDelete(pContext->mutex);
+    }
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_NUM_SOCKETS; x++) {
+        socketClose(&(pContext->socket[x]));
+    }
+    if (pContext->pResponseBuffer != NULL) {
+        uRingBufferDelete(&(pContext->response));
+        uPortFree(pContext->pResponseBuffer);
+    }
+    if (pContext->pRxBuffer != NULL) {
+        uRingBufferDelete(&(pContext->rx));
+        uPortFree(pContext->pRxBuffer);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Create a simulated module.
+uDeviceSerial_t *pUPortSimModemCreate(const uPortSimModemCfg_t *pCfg)
+{
+    uDeviceSerial_t *pDeviceSerial;
+    uPortSimModemContext_t *pContext;
+    uPortSimModemCfg_t cfgDefault = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+
+    if (pCfg == NULL) {
+        pCfg = &cfgDefault;
+    }
+    pDeviceSerial = pUDeviceSerialCreate(initSerialInterface,
+                                         sizeof(uPortSimModemContext_t));
+    if (pDeviceSerial != NULL) {
+        pContext = (uPortSimModemContext_t *) pUInterfaceContext(pDeviceSerial);
+        pContext->cfg = *pCfg;
+        pContext->dataSocket = -1;
+        pContext->eventQueueHandle = -1;
+        for (size_t x = 0; x < U_PORT_SIM_MODEM_NUM_SOCKETS; x++) {
+            pContext->socket[x].fd = -1;
+        }
+        pContext->pResponseBuffer = (char *) pUPortMalloc(U_PORT_SIM_MODEM_BUFFER_LENGTH_BYTES);
+        pContext->pRxBuffer = (char *) pUPortMalloc(U_PORT_SIM_MODEM_BUFFER_LENGTH_BYTES);
+        if ((pContext->pResponseBuffer != NULL) && (pContext->pRxBuffer != NULL)) {
+            errorCode = uRingBufferCreate(&(pContext->response), pContext->pResponseBuffer,
+                                          U_PORT_SIM_MODEM_BUFFER_LENGTH_BYTES);
+            if (errorCode == 0) {
+                errorCode = uRingBufferCreate(&(pContext->rx), pContext->pRxBuffer,
+                                              U_PORT_SIM_MODEM_BUFFER_LENGTH_BYTES);
+                if (errorCode != 0) {
+                    uRingBufferDelete(&(pContext->response));
+                }
+            }
+            if (errorCode != 0) {
+                uPortFree(pContext->pResponseBuffer);
+                pContext->pResponseBuffer = NULL;
+                uPortFree(pContext->pRxBuffer);
+                pContext->pRxBuffer = NULL;
+            }
+        }
+        if (errorCode == 0) {
+            errorCode = uPortMutexCreate(&(pContext->mutex));
+            if (errorCode == 0) {
+                errorCode = uPortTaskCreate(simModemTask, "simModem",
+                                            U_PORT_SIM_MODEM_TASK_STACK_SIZE_BYTES,
+                                            pDeviceSerial,
+                                            U_PORT_SIM_MODEM_TASK_PRIORITY,
+                                            &(pContext->taskHandle));
+                if (errorCode != 0) {
+                    pContext->taskHandle = NULL;
+                }
+            } else {
+                pContext->mutex = NULL;
+            }
+        }
+        if (errorCode != 0) {
+            contextFree(pContext);
+            uDeviceSerialDelete(pDeviceSerial);
+            pDeviceSerial = NULL;
+        }
+    }
+
+    return pDeviceSerial;
+}
+
+// Get the number of unknown commands.
+int32_t uPortSimModemUnknownGet(uDeviceSerial_t *pDeviceSerial)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext;
+
+    if (pDeviceSerial != NULL) {
+        pContext = (uPortSimModemContext_t *) pUInterfaceContext(pDeviceSerial);
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        errorCodeOrCount = pContext->unknownCount;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Send something unprompted from a simulated module.
+int32_t uPortSimModemSend(uDeviceSerial_t *pDeviceSerial,
+                          const char *pData, size_t length)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortSimModemContext_t *pContext;
+
+    if ((pDeviceSerial != NULL) && (pData != NULL)) {
+        pContext = (uPortSimModemContext_t *) pUInterfaceContext(pDeviceSerial);
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        if (respondBytes(pContext, pData, length)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCode;
+}
+
+// Delete a simulated module.
+void uPortSimModemDelete(uDeviceSerial_t *pDeviceSerial)
+{
+    if (pDeviceSerial != NULL) {
+        serialEventCallbackRemove(pDeviceSerial);
+        contextFree((uPortSimModemContext_t *) pUInterfaceContext(pDeviceSerial));
+        uDeviceSerialDelete(pDeviceSerial);
+    }
+}
+
+// End of file
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_PORT_SIM_MODEM_H_
+#define _U_PORT_SIM_MODEM_H_
+
+/* Only header files representing a direct and unavoidable
+ * dependency between the API of this module and the API
+ * of another module should be included here; otherwise
+ * please keep #includes to your .c files. */
+
+#include "u_device_serial.h"
+
+/** @file
+ * @brief A simulated SARA-R5 cellular module for the Linux platform,
+ * presented as a virtual serial device, so that the cellular socket
+ * code, and everything built on top of it, can be load-tested on a
+ * host without any hardware.
+ *
+ * The simulated module answers the binary-mode socket AT commands
+ * (AT+USOCR, AT+USOCO, AT+USOWR, AT+USOST, AT+USORD, AT+USORF,
+ * AT+USOCL, AT+USOER, AT+USOCTL) and AT+UDNSRN by carrying out the
+ * equivalent operation on a real host socket, emitting +UUSORD,
+ * +UUSORF and +UUSOCL URCs as a real module would.  Any other
+ * command is offered to a callback of the application, if there is
+ * one, then matched against a script supplied by the application
+ * and, if it is not found there, is answered with "OK".  A delay
+ * may be applied before each response and the rate at which
+ * responses are returned may be limited, so that the behaviour of
+ * a real link may be approximated.
+ *
+ * The device should be opened with its open() function and can
+ * then be passed to uAtClientAddExt() as a stream of type
+ * #U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL, after which uCellAdd()
+ * may be called with #U_CELL_MODULE_TYPE_SARA_R5 and all pins -1.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_PORT_SIM_MODEM_NUM_SOCKETS
+/** The number of sockets the simulated module supports, as for
+ * a real SARA-R5.
+ */
+# define U_PORT_SIM_MODEM_NUM_SOCKETS 7
+#endif
+
+#ifndef U_PORT_SIM_MODEM_BUFFER_LENGTH_BYTES
+/** The size of each of the transmit and receive buffers of the
+ * simulated module.
+ */
+# define U_PORT_SIM_MODEM_BUFFER_LENGTH_BYTES 4096
+#endif
+
+#ifndef U_PORT_SIM_MODEM_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that runs the simulated module.
+ */
+# define U_PORT_SIM_MODEM_TASK_STACK_SIZE_BYTES (1024 * 16)
+#endif
+
+#ifndef U_PORT_SIM_MODEM_TASK_PRIORITY
+/** The priority of the task that runs the simulated module.
+ */
+# define U_PORT_SIM_MODEM_TASK_PRIORITY (U_CFG_OS_PRIORITY_MIN + 5)
+#endif
+
+#ifndef U_PORT_SIM_MODEM_TICK_MS
+/** How often the task that runs the simulated module checks
+ * for work to do.
+ */
+# define U_PORT_SIM_MODEM_TICK_MS 5
+#endif
+
+#ifndef U_PORT_SIM_MODEM_CALLBACK_QUEUE_LENGTH
+/** The length of the event queue of the simulated module.
+ */
+# define U_PORT_SIM_MODEM_CALLBACK_QUEUE_LENGTH 20
+#endif
+
+#ifndef U_PORT_SIM_MODEM_COMMAND_CALLBACK_RESPONSE_LENGTH_BYTES
+/** The size of the buffer into which the command callback of the
+ * simulated module may write a response.
+ */
+# define U_PORT_SIM_MODEM_COMMAND_CALLBACK_RESPONSE_LENGTH_BYTES 512
+#endif
+
+/** Default configuration for the simulated module: no script, no
+ * response delay, no limit on rate and no command callback.
+ */
+#define U_PORT_SIM_MODEM_CFG_DEFAULT {NULL, 0, 0, 0, NULL, NULL}
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A scripted response of the simulated module.
+ */
+typedef struct {
+    const char *pCommand;  /**< the start of the command line that this
+                                entry responds to, without the "AT",
+                                e.g. "+CGMR" or "+CEREG?". */
+    const char *pResponse; /**< the response, sent verbatim, e.g.
+                                "\r\n+CEREG: 0,1\r\n\r\nOK\r\n"; NULL
+                                to send nothing at all. */
+} uPortSimModemScript_t;
+
+/** Configuration of the simulated module.
+ */
+typedef struct {
+    const uPortSimModemScript_t *pScript; /**< the scripted responses,
+                                               searched first to last
+                                               before the built-in
+                                               ones; may be NULL.  This
+                                               is NOT copied and so it
+                                               must remain valid for
+                                               the life of the device. */
+    size_t scriptLength;                  /**< the number of entries
+                                               at pScript. */
+    int32_t responseDelayMs;              /**< the delay between a
+                                               command being received
+                                               and its response starting. */
+    int32_t bytesPerSecond;               /**< the rate at which the
+                                               simulated module returns
+                                               characters; zero for
+                                               no limit. */
+    int32_t (*pCommandCallback) (const char *, char *, size_t, void *); /**< called
+                                               with each command line,
+                                               without the "AT", before
+                                               the script is searched,
+                                               a buffer of the given size
+                                               into which a response may
+                                               be written and
+                                               pCommandCallbackParam; it
+                                               should return the length
+                                               of the response, which is
+                                               sent verbatim, or negative
+                                               to have the line handled
+                                               as usual.  It is called
+                                               with the simulated module
+                                               locked and so must not call
+                                               this API; may be NULL. */
+    void *pCommandCallbackParam;
+} uPortSimModemCfg_t;
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Create a simulated module.
+ *
+ * @param[in] pCfg  the configuration; may be NULL in which case
+ *                  #U_PORT_SIM_MODEM_CFG_DEFAULT is used.
+ * @return          on success a pointer to the serial device,
+ *                  else NULL.
+ */
+uDeviceSerial_t *pUPortSimModemCreate(const uPortSimModemCfg_t *pCfg);
+
+/** Get the number of command lines received by a simulated module
+ * that were matched neither by the script nor by a built-in
+ * response, and so were simply answered with "OK"; useful for
+ * spotting what a script is missing.
+ *
+ * @param[in] pDeviceSerial  the simulated module, as returned by
+ *                           pUPortSimModemCreate().
+ * @return                   the number of unknown commands, else
+ *                           negative error code.
+ */
+int32_t uPortSimModemUnknownGet(uDeviceSerial_t *pDeviceSerial);
+
+/** Send, unprompted, something from a simulated module, e.g. a URC;
+ * it is queued behind any response that has not yet been returned.
+ *
+ * @param[in] pDeviceSerial  the simulated module, as returned by
+ *                           pUPortSimModemCreate().
+ * @param[in] pData          the data to send verbatim, e.g.
+ *                           "\r\n+UUMQTTC: 0,100\r\n"; cannot be NULL.
+ * @param length             the number of bytes at pData.
+ * @return                   zero on success else negative error code.
+ */
+int32_t uPortSimModemSend(uDeviceSerial_t *pDeviceSerial,
+                          const char *pData, size_t length);
+
+/** Delete a simulated module, closing any host sockets it has
+ * open; the device must have been removed from the AT client first.
+ *
+ * @param[in] pDeviceSerial  the simulated module, as returned by
+ *                           pUPortSimModemCreate().
+ */
+void uPortSimModemDelete(uDeviceSerial_t *pDeviceSerial);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_PORT_SIM_MODEM_H_
+
+// End of file
@@ -31,12 +31,14 @@
 #include "fcntl.h"
 #include "termios.h"
 #include "unistd.h"
-#include "sys/select.h"
+#include "sys/epoll.h"
 #include "pthread.h"  // threadId
 #include "sys/ioctl.h"
 #include "sys/param.h"
+#include "linux/serial.h" // ASYNC_LOW_LATENCY
 #include "u_error_common.h"
 #include "u_linked_list.h"
+#include "u_hash_map.h"
 
 #include "u_cfg_os_platform_specific.h"
 #include "u_compiler.h" // U_ATOMIC_XXX() macros
@@ -67,6 +69,22 @@
 # define U_PORT_UART_START_STOP_WAIT_MS (U_PORT_UART_READ_WAIT_MS * 10)
 #endif
 
+#ifndef U_PORT_UART_EPOLL_MAX_EVENTS
+/** The maximum number of UART events handled by one go around
+ * the I/O task, which serves all UARTs.
+ */
+# define U_PORT_UART_EPOLL_MAX_EVENTS 8
+#endif
+
+#ifndef U_PORT_UART_HASH_MAP_NUM_ENTRIES
+/** The number of entries in the hash map used to find a UART from
+ * its handle on every call; must be a power of two.  Should more
+ * UARTs be open than fit, the extra ones are found by searching
+ * the list of UARTs instead.
+ */
+# define U_PORT_UART_HASH_MAP_NUM_ENTRIES 16
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -74,7 +92,6 @@
 typedef struct uPortUartData_t {
     int uartFd;
     bool markedForDeletion;
-    uPortTaskHandle_t rxTask;
     uPortMutexHandle_t mutex;
     bool bufferAllocated;
     char *pBuffer;
@@ -88,6 +105,14 @@ typedef struct uPortUartData_t {
     uint32_t eventFilter;
     void (*pEventCallback)(int32_t, uint32_t, void *);
     void *pEventCallbackParam;
+    uPortTaskHandle_t txTask;
+    uPortSemaphoreHandle_t txSemaphore;
+    volatile bool txBusy;
+    const char *pTxData;
+    size_t txSize;
+    uPortUartWriteCallback_t pTxCallback;
+    void *pTxCallbackParam;
+    uLinkedListNode_t node;
 } uPortUartData_t;
 
 /** Structure describing an event.
@@ -106,6 +131,7 @@ typedef struct {
 typedef struct {
     char str[U_PORT_UART_MAX_PREFIX_LENGTH + 1]; // +1 for terminator
     pthread_t threadId;
+    uLinkedListNode_t node;
 } uPortUartPrefix_t;
 
 /* ----------------------------------------------------------------
@@ -118,16 +144,33 @@ static uPortMutexHandle_t gMutex = NULL;
 
 /** Root of linked list of UART data.
  */
-static uLinkedList_t *gpUartList = NULL;
+static uLinkedListNode_t *gpUartList = NULL;
+
+/** Hash map of UART data, keyed on the handle, for quick look-up.
+ */
+static uHashMap_t gUartMap;
+
+/** Storage for gUartMap.
+ */
+static uHashMapEntry_t gUartMapEntries[U_PORT_UART_HASH_MAP_NUM_ENTRIES];
 
 /** Root of linked list of UART prefixes.
  */
-static uLinkedList_t *gpUartPrefixList = NULL;
+static uLinkedListNode_t *gpUartPrefixList = NULL;
 
 /** Variable to keep track of the number of UARTs open.
  */
 static volatile int32_t gResourceAllocCount = 0;
 
+/** The epoll file descriptor the I/O task waits on for received
+ * data from any UART, -1 when no UART is open.
+ */
+static int gEpollFd = -1;
+
+/** The I/O task, which reads the data received by all UARTs.
+ */
+static uPortTaskHandle_t gIoTask = NULL;
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -144,81 +187,38 @@ static void eventHandler(void *pParam, size_t paramLength)
     }
 }
 
-// Task handling incoming uart data
-static void readTask(void *pParam)
+// Task doing asynchronous writes, started by the first call to
+// uPortUartWriteAsync().
+static void writeTask(void *pParam)
 {
     uPortUartData_t *p = (uPortUartData_t *)pParam;
-    struct timeval tv = {0};
+    int32_t sizeOrErrorCode;
+    ssize_t written;
 
-    // Initiate a set for select operation.
-    fd_set set;
-    tv.tv_usec = U_CFG_OS_YIELD_MS * 1000;
-    // Need a brief pause before calling select after open.
-    uPortTaskBlock(10);
     while (!p->markedForDeletion) {
-        FD_ZERO(&set);
-        FD_SET(p->uartFd, &set);
-        // Wait for input
-        int res = select(p->uartFd + 1, &set, NULL, NULL, &tv);
-        if (res > 0) {
-            // Input is available.
-            int available;
-            do {
-                available = 0;
-                ioctl(p->uartFd, FIONREAD, &available);
-                size_t cnt = 0;
-                size_t tot = 0;
-                // Sample readPos
-                size_t readPos = p->readPos;
-                U_PORT_MUTEX_LOCK(p->mutex);
-                if (p->writePos >= readPos) {
-                    // Write pos ahead of read. Use the remaining area in the
-                    // buffer first.
-                    cnt = MIN(available, p->bufferSize - p->writePos);
-                    cnt = read(p->uartFd, p->pBuffer + p->writePos, cnt);
-                    if (cnt > 0) {
-                        available -= cnt;
-                        p->writePos = (p->writePos + cnt) % p->bufferSize;
-                    }
-                    tot = cnt;
-                }
-                if ((available > 0) && (p->writePos < readPos)) {
-                    // Read pos ahead of write.
-                    cnt = MIN(available, readPos - p->writePos);
-                    cnt = read(p->uartFd, p->pBuffer + p->writePos, cnt);
-                    if (cnt > 0) {
-                        available -= cnt;
-                        p->writePos = (p->writePos + cnt) % p->bufferSize;
-                        // We might have filled up the buffer, in which case we must wait below.
-                        p->bufferFull = p->writePos == readPos;
-                    }
-                    tot += cnt;
-                }
-                U_PORT_MUTEX_UNLOCK(p->mutex);
-                if ((tot > 0) &&
-                    (p->eventQueueHandle >= 0)) {
-                    // Call the user callback
-                    uPortUartEvent_t event;
-                    event.uartHandle = p->uartFd;
-                    event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
-                    event.pEventCallback = p->pEventCallback;
-                    event.pEventCallbackParam = p->pEventCallbackParam;
-                    uPortEventQueueSend(p->eventQueueHandle, &event, sizeof(event));
-                }
-                while (p->bufferFull && !p->markedForDeletion) {
-                    // Buffer is full, wait for consumption.
-                    uPortTaskBlock(U_PORT_UART_READ_WAIT_MS);
+        if (uPortSemaphoreTryTake(p->txSemaphore, U_PORT_UART_READ_WAIT_MS) == 0) {
+            sizeOrErrorCode = 0;
+            while ((sizeOrErrorCode >= 0) && ((size_t) sizeOrErrorCode < p->txSize)) {
+                written = write(p->uartFd, p->pTxData + sizeOrErrorCode,
+                                p->txSize - sizeOrErrorCode);
+                if (written < 0) {
+                    sizeOrErrorCode = (int32_t)U_ERROR_COMMON_PLATFORM;
+                } else {
+                    sizeOrErrorCode += (int32_t) written;
                 }
-            } while ((available > 0) && !p->markedForDeletion);
+            }
+            p->txBusy = false;
+            p->pTxCallback(p->uartFd, sizeOrErrorCode, p->pTxCallbackParam);
         }
     }
 }
 
 static uPortUartPrefix_t *findPrefix(pthread_t threadId)
 {
-    uLinkedList_t *p = gpUartPrefixList;
+    uLinkedListNode_t *p = gpUartPrefixList;
     while (p != NULL) {
-        uPortUartPrefix_t *pUartPrefix = (uPortUartPrefix_t *)(p->p);
+        uPortUartPrefix_t *pUartPrefix = U_LINKED_LIST_CONTAINER_OF(p, uPortUartPrefix_t,
+                                                                   node);
         if (pUartPrefix->threadId == threadId) {
             return pUartPrefix;
         }
@@ -227,29 +227,192 @@ static uPortUartPrefix_t *findPrefix(pthread_t threadId)
     return NULL;
 }
 
+// Find a UART from its handle: look in the hash map first, only
+// searching the list if the UART is not there, which will be the
+// case for a bad handle or if the hash map was full.
 static uPortUartData_t *findUart(int32_t handle)
 {
-    uLinkedList_t *p = gpUartList;
-    while (p != NULL) {
-        uPortUartData_t *pUart = (uPortUartData_t *)(p->p);
-        if (pUart->uartFd == handle) {
-            return pUart;
+    uPortUartData_t *pUart = (uPortUartData_t *) pUHashMapGet(&gUartMap,
+                                                              (uintptr_t) handle);
+    uLinkedListNode_t *p = gpUartList;
+    while ((pUart == NULL) && (p != NULL)) {
+        if (U_LINKED_LIST_CONTAINER_OF(p, uPortUartData_t, node)->uartFd == handle) {
+            pUart = U_LINKED_LIST_CONTAINER_OF(p, uPortUartData_t, node);
         }
         p = p->pNext;
     }
-    return NULL;
+    return pUart;
+}
+
+// Read whatever is waiting at the UART into its receive buffer and
+// return true if anything was read; if the buffer fills up the UART
+// is taken out of the epoll set until uPortUartRead() makes room.
+// Must be called with gMutex locked.
+static bool readUart(uPortUartData_t *p)
+{
+    int available;
+    size_t tot = 0;
+    ssize_t cnt;
+
+    U_PORT_MUTEX_LOCK(p->mutex);
+    available = 0;
+    ioctl(p->uartFd, FIONREAD, &available);
+    while ((available > 0) && !p->bufferFull) {
+        // Read up to the end of the buffer or up to the read
+        // pointer, whichever comes first
+        if (p->writePos >= p->readPos) {
+            cnt = MIN((size_t) available, p->bufferSize - p->writePos);
+        } else {
+            cnt = MIN((size_t) available, p->readPos - p->writePos);
+        }
+        cnt = read(p->uartFd, p->pBuffer + p->writePos, cnt);
+        if (cnt <= 0) {
+            break;
+        }
+        available -= cnt;
+        tot += cnt;
+        p->writePos = (p->writePos + cnt) % p->bufferSize;
+        p->bufferFull = p->writePos == p->readPos;
+    }
+    if (p->bufferFull) {
+        // Stop listening until there is room again
+        struct epoll_event event = {0};
+        event.data.fd = p->uartFd;
+        epoll_ctl(gEpollFd, EPOLL_CTL_MOD, p->uartFd, &event);
+    }
+    U_PORT_MUTEX_UNLOCK(p->mutex);
+
+    return tot > 0;
+}
+
+// The one task that handles incoming data for all UARTs.
+static void ioTask(void *pParam)
+{
+    int epollFd = (int) (intptr_t) pParam;
+    struct epoll_event events[U_PORT_UART_EPOLL_MAX_EVENTS];
+    uPortUartEvent_t uartEvents[U_PORT_UART_EPOLL_MAX_EVENTS];
+    int32_t eventQueueHandles[U_PORT_UART_EPOLL_MAX_EVENTS];
+    size_t numUartEvents;
+    uPortUartData_t *p;
+    int numEvents;
+
+    for (;;) {
+        // The task is deleted by cancellation, which must only
+        // happen here, never while gMutex is locked
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        numEvents = epoll_wait(epollFd, events, U_PORT_UART_EPOLL_MAX_EVENTS,
+                               U_PORT_UART_READ_WAIT_MS);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        numUartEvents = 0;
+        U_PORT_MUTEX_LOCK(gMutex);
+        for (int x = 0; x < numEvents; x++) {
+            // Look the UART up by file descriptor since it may have
+            // been closed since epoll_wait() returned
+            p = findUart(events[x].data.fd);
+            if ((p != NULL) && !p->markedForDeletion &&
+                readUart(p) && (p->eventQueueHandle >= 0)) {
+                uartEvents[numUartEvents].uartHandle = p->uartFd;
+                uartEvents[numUartEvents].eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
+                uartEvents[numUartEvents].pEventCallback = p->pEventCallback;
+                uartEvents[numUartEvents].pEventCallbackParam = p->pEventCallbackParam;
+                eventQueueHandles[numUartEvents] = p->eventQueueHandle;
+                numUartEvents++;
+            }
+        }
+        U_PORT_MUTEX_UNLOCK(gMutex);
+        // Call the user callbacks outside the mutex
+        for (size_t x = 0; x < numUartEvents; x++) {
+            // Coalesced so that a burst of data cannot fill the queue
+            uPortEventQueueSendExt(eventQueueHandles[x], &(uartEvents[x]),
+                                   sizeof(uartEvents[x]), 0, false);
+        }
+    }
+}
+
+// Add a UART to the epoll set, starting the I/O task if this is
+// the first one.  Must be called with gMutex locked.
+static int32_t ioAdd(uPortUartData_t *p)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_SUCCESS;
+    struct epoll_event event = {0};
+
+    if (gEpollFd < 0) {
+        errorCode = U_ERROR_COMMON_PLATFORM;
+        gEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (gEpollFd >= 0) {
+            errorCode = U_ERROR_COMMON_SUCCESS;
+            if (uPortTaskCreate(ioTask, "uartIo", 4 * 1024, (void *) (intptr_t) gEpollFd,
+                                U_CFG_OS_PRIORITY_MAX - 5,
+                                &gIoTask) != 0) {
+                errorCode = U_ERROR_COMMON_PLATFORM;
+                close(gEpollFd);
+                gEpollFd = -1;
+                gIoTask = NULL;
+            }
+        }
+    }
+    if (errorCode == U_ERROR_COMMON_SUCCESS) {
+        event.events = EPOLLIN;
+        event.data.fd = p->uartFd;
+        if (epoll_ctl(gEpollFd, EPOLL_CTL_ADD, p->uartFd, &event) != 0) {
+            errorCode = U_ERROR_COMMON_PLATFORM;
+        }
+    }
+
+    return (int32_t) errorCode;
+}
+
+// Remove a UART from the epoll set; if no UARTs are left the I/O
+// task and its epoll file descriptor are handed back to the caller
+// to be stopped, outside gMutex.  Must be called with gMutex locked.
+static void ioRemove(uPortUartData_t *p, uPortTaskHandle_t *pIoTask,
+                     int *pEpollFd)
+{
+    *pIoTask = NULL;
+    *pEpollFd = -1;
+    if (gEpollFd >= 0) {
+        if (p->uartFd >= 0) {
+            epoll_ctl(gEpollFd, EPOLL_CTL_DEL, p->uartFd, NULL);
+        }
+        if (gpUartList == NULL) {
+            *pIoTask = gIoTask;
+            *pEpollFd = gEpollFd;
+            gIoTask = NULL;
+            gEpollFd = -1;
+        }
+    }
 }
 
 static void disposeUartData(uPortUartData_t *p)
 {
     if (p != NULL) {
-        uLinkedListRemove(&gpUartList, p);
-        if (p->rxTask != NULL) {
-            uPortTaskDelete(p->rxTask);
-            // Wait for the task to exit before
-            // we pull the structures out from under it
+        uPortTaskHandle_t ioTaskHandle;
+        int epollFd;
+        U_PORT_MUTEX_LOCK(gMutex);
+        if (uLinkedListNodeIsInList(&(p->node))) {
+            uLinkedListNodeRemove(&gpUartList, &(p->node));
+            if (pUHashMapGet(&gUartMap, (uintptr_t) p->uartFd) == p) {
+                pUHashMapRemove(&gUartMap, (uintptr_t) p->uartFd);
+            }
+        }
+        ioRemove(p, &ioTaskHandle, &epollFd);
+        U_PORT_MUTEX_UNLOCK(gMutex);
+        if (ioTaskHandle != NULL) {
+            uPortTaskDelete(ioTaskHandle);
+            // Wait for the task to exit before we close
+            // the epoll file descriptor out from under it
             uPortTaskBlock(U_PORT_UART_START_STOP_WAIT_MS);
         }
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+        if (p->txTask != NULL) {
+            uPortTaskDelete(p->txTask);
+            uPortTaskBlock(U_PORT_UART_START_STOP_WAIT_MS);
+        }
+        if (p->txSemaphore != NULL) {
+            uPortSemaphoreDelete(p->txSemaphore);
+        }
         if (p->eventQueueHandle >= 0) {
             uPortEventQueueClose(p->eventQueueHandle);
         }
@@ -267,6 +430,35 @@ static void disposeUartData(uPortUartData_t *p)
     }
 }
 
+// Convert a baud rate into a termios speed, returning false if
+// the baud rate is not one that is supported.
+static bool baudRateToSpeed(int32_t baudRate, speed_t *pSpeed)
+{
+    bool supported = true;
+
+    if (baudRate == 9600) {
+        *pSpeed = B9600;
+    } else if (baudRate == 19200) {
+        *pSpeed = B19200;
+    } else if (baudRate == 38400) {
+        *pSpeed = B38400;
+    } else if (baudRate == 57600) {
+        *pSpeed = B57600;
+    } else if (baudRate == 115200) {
+        *pSpeed = B115200;
+    } else if (baudRate == 230400) {
+        *pSpeed = B230400;
+    } else if (baudRate == 460800) {
+        *pSpeed = B460800;
+    } else if (baudRate == 921600) {
+        *pSpeed = B921600;
+    } else {
+        supported = false;
+    }
+
+    return supported;
+}
+
 static uint32_t suspendResumeUartHwHandshake(int32_t handle, bool suspendNotResume)
 {
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
@@ -318,6 +510,8 @@ int32_t uPortUartInit()
 {
     uErrorCode_t errorCode = U_ERROR_COMMON_SUCCESS;
     if (gMutex == NULL) {
+        uHashMapInit(&gUartMap, gUartMapEntries,
+                     sizeof(gUartMapEntries) / sizeof(gUartMapEntries[0]));
         errorCode = uPortMutexCreate(&gMutex);
     }
     return (int32_t) errorCode;
@@ -331,18 +525,19 @@ void uPortUartDeinit()
         U_PORT_MUTEX_LOCK(gMutex);
 
         // First, mark all instances for deletion
-        uLinkedList_t *pList = gpUartList;
+        uLinkedListNode_t *pList = gpUartList;
         while (pList != NULL) {
-            uPortUartData_t *pUart = (uPortUartData_t *)(pList->p);
-            pUart->markedForDeletion = true;
+            U_LINKED_LIST_CONTAINER_OF(pList, uPortUartData_t, node)->markedForDeletion = true;
             pList = pList->pNext;
         }
 
         // Remove any UART prefixes
         while (gpUartPrefixList != NULL) {
-            uPortUartPrefix_t *pUartPrefix = (uPortUartPrefix_t *)(gpUartPrefixList->p);
+            uPortUartPrefix_t *pUartPrefix = U_LINKED_LIST_CONTAINER_OF(gpUartPrefixList,
+                                                                       uPortUartPrefix_t,
+                                                                       node);
+            uLinkedListNodeRemove(&gpUartPrefixList, &(pUartPrefix->node));
             uPortFree(pUartPrefix);
-            uLinkedListRemove(&gpUartPrefixList, pUartPrefix);
         }
 
         // Release the mutex so that deletion can occur
@@ -350,8 +545,7 @@ void uPortUartDeinit()
 
         // Now remove all existing uarts
         while (gpUartList != NULL) {
-            uPortUartData_t *pUart = (uPortUartData_t *)(gpUartList->p);
-            disposeUartData(pUart);
+            disposeUartData(U_LINKED_LIST_CONTAINER_OF(gpUartList, uPortUartData_t, node));
         }
         // Delete the mutex
         U_PORT_MUTEX_LOCK(gMutex);
@@ -373,13 +567,13 @@ int32_t uPortUartPrefix(const char *pPrefix)
             pthread_t threadId = pthread_self();
             uPortUartPrefix_t *p;
             while ((p = findPrefix(threadId)) != NULL) {
+                uLinkedListNodeRemove(&gpUartPrefixList, &(p->node));
                 uPortFree(p);
-                uLinkedListRemove(&gpUartPrefixList, p);
             }
             // Add the new one
             strncpy(pUartPrefix->str, pPrefix, sizeof(pUartPrefix->str));
             pUartPrefix->threadId = threadId;
-            uLinkedListAdd(&gpUartPrefixList, (void *)pUartPrefix);
+            uLinkedListNodeAdd(&gpUartPrefixList, &(pUartPrefix->node));
             errorCode = U_ERROR_COMMON_SUCCESS;
             U_PORT_MUTEX_UNLOCK(gMutex);
         }
@@ -413,23 +607,7 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
         FAIL(U_ERROR_COMMON_INVALID_PARAMETER);
     }
     speed_t speed;
-    if (baudRate == 9600) {
-        speed = B9600;
-    } else if (baudRate == 19200) {
-        speed = B19200;
-    } else if (baudRate == 38400) {
-        speed = B38400;
-    } else if (baudRate == 57600) {
-        speed = B57600;
-    } else if (baudRate == 115200) {
-        speed = B115200;
-    } else if (baudRate == 230400) {
-        speed = B230400;
-    } else if (baudRate == 460800) {
-        speed = B460800;
-    } else if (baudRate == 921600) {
-        speed = B921600;
-    } else {
+    if (!baudRateToSpeed(baudRate, &speed)) {
         FAIL(U_ERROR_COMMON_INVALID_PARAMETER);
     }
     char prefix[U_PORT_UART_MAX_PREFIX_LENGTH + 1]; // +1 for terminator
@@ -463,14 +641,23 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
     } else {
         options.c_cflag &= ~CRTSCTS;
     }
-    // Set timed read with 100 ms timeout
+    // Reads are only made of what epoll says has arrived, so
+    // they need neither a minimum count nor a timeout
     options.c_cc[VMIN] = 0;
-    options.c_cc[VTIME] = 1;
+    options.c_cc[VTIME] = 0;
     if (tcsetattr(pUartData->uartFd, TCSANOW, &options) == 0) {
         tcflush(pUartData->uartFd, TCIOFLUSH);
     } else {
         FAIL(U_ERROR_COMMON_PLATFORM);
     }
+    // Ask the serial driver not to hold on to received data; this
+    // is best effort since not all drivers (e.g. pseudo-terminals
+    // or USB adapters) support it
+    struct serial_struct serial;
+    if (ioctl(pUartData->uartFd, TIOCGSERIAL, &serial) == 0) {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ioctl(pUartData->uartFd, TIOCSSERIAL, &serial);
+    }
 
     if (pReceiveBuffer == NULL) {
         pUartData->pBuffer = pUPortMalloc(bufferSize);
@@ -488,15 +675,16 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
     if (uPortMutexCreate(&(pUartData->mutex)) != 0) {
         FAIL(U_ERROR_COMMON_NO_MEMORY);
     }
-    if (uPortTaskCreate(readTask, "", 4 * 1024, pUartData, U_CFG_OS_PRIORITY_MAX - 5,
-                        &(pUartData->rxTask)) != 0) {
-        FAIL(U_ERROR_COMMON_PLATFORM);
-    }
-    // Wait for the read task to start
-    uPortTaskBlock(U_PORT_UART_START_STOP_WAIT_MS);
+    int32_t errorCode;
     U_PORT_MUTEX_LOCK(gMutex);
-    uLinkedListAdd(&gpUartList, (void *)pUartData);
+    uLinkedListNodeAdd(&gpUartList, &(pUartData->node));
+    // If the hash map is full the UART will be found from the list
+    uHashMapSet(&gUartMap, (uintptr_t) pUartData->uartFd, pUartData);
+    errorCode = ioAdd(pUartData);
     U_PORT_MUTEX_UNLOCK(gMutex);
+    if (errorCode != 0) {
+        FAIL(errorCode);
+    }
     U_ATOMIC_INCREMENT(&gResourceAllocCount);
     return (int32_t)(pUartData->uartFd);
 }
@@ -592,8 +780,12 @@ int32_t uPortUartRead(int32_t handle, void *pBuffer,
                 }
             }
             if (pUartData->bufferFull && (sizeOrErrorCode > 0)) {
-                // Release possible waiting read task.
+                // There is room again: put the UART back into the epoll set
+                struct epoll_event event = {0};
                 pUartData->bufferFull = false;
+                event.events = EPOLLIN;
+                event.data.fd = pUartData->uartFd;
+                epoll_ctl(gEpollFd, EPOLL_CTL_MOD, pUartData->uartFd, &event);
             }
             U_PORT_MUTEX_UNLOCK(pUartData->mutex);
         }
@@ -623,6 +815,47 @@ int32_t uPortUartWrite(int32_t handle, const void *pBuffer,
     return sizeOrErrorCode;
 }
 
+// Write to the given UART interface without waiting.
+int32_t uPortUartWriteAsync(int32_t handle, const void *pBuffer,
+                            size_t sizeBytes,
+                            uPortUartWriteCallback_t pCallback,
+                            void *pParam)
+{
+    int32_t errorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    if (gMutex != NULL) {
+        U_PORT_MUTEX_LOCK(gMutex);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        uPortUartData_t *pUartData = findUart(handle);
+        if ((pBuffer != NULL) && (sizeBytes > 0) && (pCallback != NULL) &&
+            (pUartData != NULL) && !pUartData->markedForDeletion) {
+            errorCode = (int32_t)U_ERROR_COMMON_SUCCESS;
+            if ((pUartData->txSemaphore == NULL) &&
+                (uPortSemaphoreCreate(&(pUartData->txSemaphore), 0, 1) != 0)) {
+                errorCode = (int32_t)U_ERROR_COMMON_NO_MEMORY;
+            }
+            if ((errorCode == 0) && (pUartData->txTask == NULL) &&
+                (uPortTaskCreate(writeTask, "", 4 * 1024, pUartData, U_CFG_OS_PRIORITY_MAX - 5,
+                                 &(pUartData->txTask)) != 0)) {
+                errorCode = (int32_t)U_ERROR_COMMON_PLATFORM;
+            }
+            if (errorCode == 0) {
+                errorCode = (int32_t)U_ERROR_COMMON_BUSY;
+                if (!pUartData->txBusy) {
+                    pUartData->txBusy = true;
+                    pUartData->pTxData = (const char *) pBuffer;
+                    pUartData->txSize = sizeBytes;
+                    pUartData->pTxCallback = pCallback;
+                    pUartData->pTxCallbackParam = pParam;
+                    uPortSemaphoreGive(pUartData->txSemaphore);
+                    errorCode = (int32_t)U_ERROR_COMMON_SUCCESS;
+                }
+            }
+        }
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+    return errorCode;
+}
+
 // Set an event callback.
 int32_t uPortUartEventCallbackSet(int32_t handle,
                                   uint32_t filter,
@@ -830,6 +1063,35 @@ void uPortUartCtsResume(int32_t handle)
     suspendResumeUartHwHandshake(handle, true);
 }
 
+// Change the baud rate of an open UART.
+int32_t uPortUartSetBaudRate(int32_t handle, int32_t baudRate)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    speed_t speed;
+    struct termios options;
+
+    if (gMutex != NULL) {
+        U_PORT_MUTEX_LOCK(gMutex);
+        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        uPortUartData_t *pUartData = findUart(handle);
+        if ((pUartData != NULL) && !pUartData->markedForDeletion &&
+            baudRateToSpeed(baudRate, &speed)) {
+            errorCode = U_ERROR_COMMON_PLATFORM;
+            if (tcgetattr(pUartData->uartFd, &options) == 0) {
+                cfsetispeed(&options, speed);
+                cfsetospeed(&options, speed);
+                // TCSADRAIN so that anything already written
+                // goes out at the old rate
+                if (tcsetattr(pUartData->uartFd, TCSADRAIN, &options) == 0) {
+                    errorCode = U_ERROR_COMMON_SUCCESS;
+                }
+            }
+        }
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+    return (int32_t)errorCode;
+}
+
 // Get the number of UART interfaces currently open.
 int32_t uPortUartResourceAllocCount()
 {
@@ -0,0 +1,377 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Tests for the short range EDM stream on the Linux platform:
+ * two EDM stream instances are run at once, each over a UART that
+ * is the slave side of a pseudo-terminal, the test playing the part
+ * of the two short range modules on the master sides, so no
+ * hardware is required.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the
+ * U_PORT_TEST_FUNCTION() macro.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#define _GNU_SOURCE    // For posix_openpt() and friends
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "stdlib.h"    // posix_openpt(), grantpt(), unlockpt(), ptsname()
+#include "string.h"    // memcmp(), strlen()
+
+#include "unistd.h"
+#include "fcntl.h"
+#include "poll.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+#include "u_port_uart.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_short_range_module_type.h"
+#include "u_short_range.h"
+#include "u_short_range_pbuf.h"
+#include "u_short_range_edm_stream.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_PORT_EDM_STREAM_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The size of UART receive buffer to use.
+ */
+#define U_PORT_EDM_STREAM_TEST_UART_BUFFER_LENGTH_BYTES 1024
+
+/** How long to wait for something to arrive.
+ */
+#define U_PORT_EDM_STREAM_TEST_TIMEOUT_MS 5000
+
+/** The number of EDM stream instances run at once.
+ */
+#define U_PORT_EDM_STREAM_TEST_NUM_STREAMS 2
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** One simulated short range module: the master side of a
+ * pseudo-terminal plus the UART and EDM stream on the slave side.
+ */
+typedef struct {
+    int32_t masterFd;
+    int32_t uartHandle;
+    int32_t edmStreamHandle;
+} uPortEdmStreamTestModule_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** The simulated modules.
+ */
+static uPortEdmStreamTestModule_t gModule[U_PORT_EDM_STREAM_TEST_NUM_STREAMS];
+
+/** The number of times the AT callback has been called for each
+ * stream, indexed by the parameter passed to the callback.
+ */
+static volatile int32_t gAtCallbackCount[U_PORT_EDM_STREAM_TEST_NUM_STREAMS];
+
+/** The EDM stream handle the AT callback was last called with for
+ * each stream, indexed by the parameter passed to the callback.
+ */
+static volatile int32_t gAtCallbackHandle[U_PORT_EDM_STREAM_TEST_NUM_STREAMS];
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Open the master side of a pseudo-terminal and then a UART on
+// its slave side, returning zero on success.
+static int32_t moduleOpen(uPortEdmStreamTestModule_t *pModule)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+    const char *pSlaveName;
+
+    pModule->uartHandle = -1;
+    pModule->edmStreamHandle = -1;
+    pModule->masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if ((pModule->masterFd >= 0) && (grantpt(pModule->masterFd) == 0) &&
+        (unlockpt(pModule->masterFd) == 0)) {
+        pSlaveName = ptsname(pModule->masterFd);
+        // A negative UART number makes uPortUartOpen() open
+        // the prefix on its own
+        if ((pSlaveName != NULL) && (uPortUartPrefix(pSlaveName) == 0)) {
+            pModule->uartHandle = uPortUartOpen(-1, 115200, NULL,
+                                                U_PORT_EDM_STREAM_TEST_UART_BUFFER_LENGTH_BYTES,
+                                                -1, -1, -1, -1);
+            if (pModule->uartHandle >= 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Close what moduleOpen() opened.
+static void moduleClose(uPortEdmStreamTestModule_t *pModule)
+{
+    if (pModule->uartHandle >= 0) {
+        uPortUartClose(pModule->uartHandle);
+        pModule->uartHandle = -1;
+    }
+    if (pModule->masterFd >= 0) {
+        close(pModule->masterFd);
+        pModule->masterFd = -1;
+    }
+}
+
+// Send the given bytes, which may be any part of an EDM packet,
+// from a simulated module.
+static bool moduleSend(const uPortEdmStreamTestModule_t *pModule,
+                       const char *pData, size_t length)
+{
+    return (write(pModule->masterFd, pData, length) == (ssize_t) length);
+}
+
+// Read what has been written to a simulated module, within the
+// timeout, returning the number of bytes read.
+static int32_t moduleReceive(const uPortEdmStreamTestModule_t *pModule,
+                             char *pBuffer, size_t size)
+{
+    int32_t length = 0;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+    struct pollfd pollFd = {.fd = pModule->masterFd, .events = POLLIN};
+    ssize_t x;
+
+    while ((length < (int32_t) size) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_EDM_STREAM_TEST_TIMEOUT_MS)) {
+        if (poll(&pollFd, 1, 100) > 0) {
+            x = read(pModule->masterFd, pBuffer + length, size - length);
+            if (x > 0) {
+                length += (int32_t) x;
+            }
+        }
+    }
+
+    return length;
+}
+
+// Build an EDM AT response packet carrying the given string,
+// returning its length; pBuffer must have room for the string
+// plus six bytes.
+static size_t atResponsePacket(const char *pString, char *pBuffer)
+{
+    size_t length = strlen(pString);
+
+    pBuffer[0] = (char) 0xAA;
+    // The length includes the two bytes of ID and type
+    pBuffer[1] = (char) (((length + 2) >> 8) & 0x0F);
+    pBuffer[2] = (char) ((length + 2) & 0xFF);
+    pBuffer[3] = 0x00;
+    pBuffer[4] = 0x45;
+    memcpy(pBuffer + 5, pString, length);
+    pBuffer[5 + length] = 0x55;
+
+    return length + 6;
+}
+
+// Wait for an AT response to arrive on an EDM stream and read it
+// out, returning the number of bytes read.
+static int32_t atResponseRead(const uPortEdmStreamTestModule_t *pModule,
+                              char *pBuffer, size_t size)
+{
+    int32_t length = 0;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    while ((uShortRangeEdmStreamAtGetReceiveSize(pModule->edmStreamHandle) <= 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_EDM_STREAM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+    if (uShortRangeEdmStreamAtGetReceiveSize(pModule->edmStreamHandle) > 0) {
+        length = uShortRangeEdmStreamAtRead(pModule->edmStreamHandle, pBuffer, size);
+    }
+
+    return length;
+}
+
+// Wait for the AT callback of a stream to reach a count.
+static bool atCallbackWait(size_t index, int32_t count)
+{
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    while ((gAtCallbackCount[index] < count) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_EDM_STREAM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+
+    return (gAtCallbackCount[index] >= count);
+}
+
+// The AT callback: the parameter is the index of the stream.
+static void atCallback(int32_t edmStreamHandle, uint32_t eventBitmask,
+                       void *pCallbackParameter)
+{
+    size_t index = (size_t) pCallbackParameter;
+
+    (void) eventBitmask;
+
+    if (index < U_PORT_EDM_STREAM_TEST_NUM_STREAMS) {
+        gAtCallbackHandle[index] = edmStreamHandle;
+        gAtCallbackCount[index]++;
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Run two EDM stream instances at once, each with its own UART
+ * and pbuf pool, feeding them interleaved pieces of AT response
+ * packets, and check that uShortRangeEdmStreamDeinit() called
+ * with one instance closed cleans that one up while leaving the
+ * other, still open, working.
+ */
+U_PORT_TEST_FUNCTION("[portEdmStream]", "portEdmStreamTwoInstances")
+{
+    const char *pResponse[U_PORT_EDM_STREAM_TEST_NUM_STREAMS] = {
+        "\r\n+TEST: zero\r\nOK\r\n",
+        "\r\n+TEST: one, a bit longer\r\nOK\r\n"
+    };
+    const char *pCommand[U_PORT_EDM_STREAM_TEST_NUM_STREAMS] = {"AT+ZERO\r", "AT+ONE\r"};
+    char packet[U_PORT_EDM_STREAM_TEST_NUM_STREAMS][64];
+    size_t packetLength[U_PORT_EDM_STREAM_TEST_NUM_STREAMS];
+    char buffer[64];
+    int32_t length;
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamInit() == 0);
+
+    // Nothing is open yet
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(0) < 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamOpen(-1) < 0);
+
+    for (size_t x = 0; x < U_PORT_EDM_STREAM_TEST_NUM_STREAMS; x++) {
+        U_PORT_TEST_ASSERT(moduleOpen(&gModule[x]) == 0);
+        gModule[x].edmStreamHandle = uShortRangeEdmStreamOpen(gModule[x].uartHandle);
+        U_TEST_PRINT_LINE("EDM stream %d is handle %d on UART %d.", x,
+                          gModule[x].edmStreamHandle, gModule[x].uartHandle);
+        U_PORT_TEST_ASSERT(gModule[x].edmStreamHandle >= 0);
+        gAtCallbackCount[x] = 0;
+        gAtCallbackHandle[x] = -1;
+        U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtCallbackSet(gModule[x].edmStreamHandle,
+                                                             atCallback, (void *) x) == 0);
+        packetLength[x] = atResponsePacket(pResponse[x], packet[x]);
+    }
+    U_PORT_TEST_ASSERT(gModule[0].edmStreamHandle != gModule[1].edmStreamHandle);
+    // No more room
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamOpen(gModule[0].uartHandle) < 0);
+
+    // Send the packets in interleaved pieces, so that both parsers
+    // hold a partial packet, and pbufs from both pools, at once
+    U_PORT_TEST_ASSERT(moduleSend(&gModule[0], packet[0], 7));
+    U_PORT_TEST_ASSERT(moduleSend(&gModule[1], packet[1], 3));
+    uPortTaskBlock(100);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gModule[0].edmStreamHandle) == 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gModule[1].edmStreamHandle) == 0);
+    U_PORT_TEST_ASSERT(moduleSend(&gModule[1], packet[1] + 3, packetLength[1] - 3));
+    U_PORT_TEST_ASSERT(moduleSend(&gModule[0], packet[0] + 7, packetLength[0] - 7));
+
+    // Each stream must have only its own response
+    for (size_t x = 0; x < U_PORT_EDM_STREAM_TEST_NUM_STREAMS; x++) {
+        U_PORT_TEST_ASSERT(atCallbackWait(x, 1));
+        U_PORT_TEST_ASSERT(gAtCallbackHandle[x] == gModule[x].edmStreamHandle);
+        length = atResponseRead(&gModule[x], buffer, sizeof(buffer));
+        U_TEST_PRINT_LINE("EDM stream %d read %d byte(s).", x, length);
+        U_PORT_TEST_ASSERT(length == (int32_t) strlen(pResponse[x]));
+        U_PORT_TEST_ASSERT(memcmp(buffer, pResponse[x], length) == 0);
+        U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gModule[x].edmStreamHandle) == 0);
+    }
+
+    // Writes must go out of the right UART
+    for (size_t x = 0; x < U_PORT_EDM_STREAM_TEST_NUM_STREAMS; x++) {
+        length = (int32_t) strlen(pCommand[x]);
+        U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtWrite(gModule[x].edmStreamHandle,
+                                                       pCommand[x], length) == length);
+    }
+    for (size_t x = 0; x < U_PORT_EDM_STREAM_TEST_NUM_STREAMS; x++) {
+        length = moduleReceive(&gModule[x], buffer, strlen(pCommand[x]));
+        U_PORT_TEST_ASSERT(length == (int32_t) strlen(pCommand[x]));
+        U_PORT_TEST_ASSERT(memcmp(buffer, pCommand[x], length) == 0);
+    }
+
+    // Close the first stream and deinitialise: the second stream
+    // is still open and so must be left alone, pbuf pool and all
+    uShortRangeEdmStreamClose(gModule[0].edmStreamHandle);
+    uShortRangeEdmStreamDeinit();
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gModule[0].edmStreamHandle) < 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gModule[1].edmStreamHandle) == 0);
+    U_PORT_TEST_ASSERT(moduleSend(&gModule[1], packet[1], packetLength[1]));
+    U_PORT_TEST_ASSERT(atCallbackWait(1, 2));
+    length = atResponseRead(&gModule[1], buffer, sizeof(buffer));
+    U_PORT_TEST_ASSERT(length == (int32_t) strlen(pResponse[1]));
+    U_PORT_TEST_ASSERT(memcmp(buffer, pResponse[1], length) == 0);
+    U_PORT_TEST_ASSERT(gAtCallbackCount[0] == 1);
+
+    // Now close the second stream and deinitialise again, which
+    // must clean up the rest
+    uShortRangeEdmStreamClose(gModule[1].edmStreamHandle);
+    uShortRangeEdmStreamDeinit();
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gModule[1].edmStreamHandle) < 0);
+
+    for (size_t x = 0; x < U_PORT_EDM_STREAM_TEST_NUM_STREAMS; x++) {
+        moduleClose(&gModule[x]);
+    }
+    uPortDeinit();
+
+    // Check for resource leaks, including either pbuf pool
+    U_PORT_TEST_ASSERT(uTestUtilResourceCheck(U_TEST_PREFIX,
+                                              U_TEST_UTIL_RESOURCE_CHECK_ERROR_MARKER,
+                                              true));
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+// End of file
@@ -0,0 +1,654 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Tests for the windowed AssistNow upload of uGnssMgaCacheSend()
+ * and uGnssMgaOfflineStreamSend() on the Linux platform: the GNSS
+ * device is a UART that is the slave side of a pseudo-terminal, a
+ * task playing the part of the GNSS chip on the master side,
+ * acknowledging UBX-MGA messages only when the sender pauses, so
+ * that the flow-control window can be measured; no hardware is
+ * required.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the
+ * U_PORT_TEST_FUNCTION() macro.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#define _GNU_SOURCE    // For posix_openpt() and friends
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "stdlib.h"    // posix_openpt(), grantpt(), unlockpt(), ptsname()
+#include "string.h"    // memset(), memcpy(), memmove()
+
+#include "unistd.h"
+#include "fcntl.h"
+#include "poll.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+#include "u_port_uart.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_ubx_protocol.h"
+
+#include "u_device.h"
+
+#include "u_gnss_module_type.h"
+#include "u_gnss_type.h"
+#include "u_gnss.h"
+#include "u_gnss_mga.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_PORT_GNSS_MGA_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The size of UART receive buffer to use.
+ */
+#define U_PORT_GNSS_MGA_TEST_UART_BUFFER_LENGTH_BYTES 2048
+
+/** How long the sender must be quiet for before the simulated
+ * GNSS chip acknowledges what it has received.
+ */
+#define U_PORT_GNSS_MGA_TEST_QUIET_MS 50
+
+/** The length of the body of a UBX-MGA-ANO message.
+ */
+#define U_PORT_GNSS_MGA_TEST_ANO_BODY_LENGTH_BYTES 76
+
+/** The length of the body of a UBX-MGA-GPS-ALM message.
+ */
+#define U_PORT_GNSS_MGA_TEST_ALM_BODY_LENGTH_BYTES 36
+
+/** The number of UBX-MGA-ANO messages for today in the cache, enough
+ * that the receive buffer size of the GNSS chip, rather than the
+ * window size, limits how many may be outstanding.
+ */
+#define U_PORT_GNSS_MGA_TEST_NUM_ANO_TODAY 14
+
+/** The number of messages in the cache that should be sent: the
+ * UBX-MGA-ANO messages for today plus the almanac.
+ */
+#define U_PORT_GNSS_MGA_TEST_NUM_SELECTED (U_PORT_GNSS_MGA_TEST_NUM_ANO_TODAY + 1)
+
+/** The maximum number of UBX-MGA messages that the simulated
+ * GNSS chip will hold unacknowledged.
+ */
+#define U_PORT_GNSS_MGA_TEST_MAX_PENDING 64
+
+/** 2023/06/01 00:00:00 UTC in milliseconds.
+ */
+#define U_PORT_GNSS_MGA_TEST_DAY_ONE_UTC_MILLISECONDS 1685577600000LL
+
+/** The number of bytes that readCallback() provides at a time,
+ * deliberately not a multiple of the message length so that
+ * messages are split across reads.
+ */
+#define U_PORT_GNSS_MGA_TEST_READ_LENGTH_BYTES 50
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A UBX-MGA message received, and not yet acknowledged, by the
+ * simulated GNSS chip.
+ */
+typedef struct {
+    uint8_t messageId;
+    char payloadStart[4];
+    size_t length;
+} uPortGnssMgaTestPending_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** The master side of the pseudo-terminal.
+ */
+static int32_t gMasterFd = -1;
+
+/** Flag to make gnssTask() exit.
+ */
+static volatile bool gGnssExit = false;
+
+/** Flag to show that gnssTask() has exited.
+ */
+static volatile bool gGnssExited = true;
+
+/** The UBX-MGA messages awaiting acknowledgement.
+ */
+static uPortGnssMgaTestPending_t gPending[U_PORT_GNSS_MGA_TEST_MAX_PENDING];
+
+/** The number of entries in gPending.
+ */
+static size_t gNumPending = 0;
+
+/** The number of bytes of message in gPending.
+ */
+static size_t gPendingBytes = 0;
+
+/** The most entries there have been in gPending.
+ */
+static volatile size_t gMaxPending = 0;
+
+/** The most bytes there have been in gPending.
+ */
+static volatile size_t gMaxPendingBytes = 0;
+
+/** The IDs of the UBX-MGA messages received, in order.
+ */
+static volatile uint8_t gMessageId[U_PORT_GNSS_MGA_TEST_MAX_PENDING];
+
+/** The number of UBX-MGA messages received.
+ */
+static volatile size_t gNumMessages = 0;
+
+/** The index, in order of receipt, of the UBX-MGA message to nack;
+ * -1 for none.
+ */
+static volatile int32_t gNackIndex = -1;
+
+/** Where the sending of the cache has got to, as reported to
+ * progressCallback().
+ */
+static size_t gBlocksTotal = 0;
+static size_t gBlocksSent = 0;
+
+/** The cache: the UBX-MGA-ANO messages for today, one for tomorrow
+ * and an almanac, all with overheads.
+ */
+static char gCacheBuffer[((U_PORT_GNSS_MGA_TEST_ANO_BODY_LENGTH_BYTES +
+                           U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES) *
+                          (U_PORT_GNSS_MGA_TEST_NUM_ANO_TODAY + 1)) +
+                         U_PORT_GNSS_MGA_TEST_ALM_BODY_LENGTH_BYTES +
+                         U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES];
+
+/** The amount of data in gCacheBuffer and how far readCallback()
+ * has got through it.
+ */
+static size_t gReadLength = 0;
+static size_t gReadOffset = 0;
+
+/** The number of times readCallback() has been called.
+ */
+static size_t gReadCount = 0;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Send a UBX message from the simulated GNSS chip.
+static bool gnssSend(int32_t messageClass, int32_t messageId,
+                     const char *pBody, size_t length)
+{
+    char buffer[16 + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES];
+    int32_t x;
+
+    x = uUbxProtocolEncode(messageClass, messageId, pBody, length, buffer);
+
+    return (x > 0) && (write(gMasterFd, buffer, x) == (ssize_t) x);
+}
+
+// Handle a UBX message arriving at the simulated GNSS chip:
+// UBX-CFG messages are acked straight away, except that
+// UBX-CFG-VALGET is nacked since there is nothing to get,
+// UBX-MGA messages are queued for acknowledgement later.
+static bool gnssMessage(int32_t messageClass, int32_t messageId,
+                        const char *pMessageBody, size_t messageBodyLength,
+                        void *pCallbackParam)
+{
+    char body[2] = {(char) messageClass, (char) messageId};
+    uPortGnssMgaTestPending_t *pPending;
+
+    (void) pCallbackParam;
+
+    if (messageClass == 0x06) {
+        gnssSend(0x05, (messageId == 0x8b) ? 0x00 : 0x01, body, sizeof(body));
+    } else if ((messageClass == 0x13) && (gNumPending < U_PORT_GNSS_MGA_TEST_MAX_PENDING)) {
+        pPending = &gPending[gNumPending];
+        pPending->messageId = (uint8_t) messageId;
+        memset(pPending->payloadStart, 0, sizeof(pPending->payloadStart));
+        if (pMessageBody != NULL) {
+            memcpy(pPending->payloadStart, pMessageBody,
+                   messageBodyLength < 4 ? messageBodyLength : 4);
+        }
+        pPending->length = messageBodyLength + U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+        gNumPending++;
+        gPendingBytes += pPending->length;
+        if (gNumPending > gMaxPending) {
+            gMaxPending = gNumPending;
+        }
+        if (gPendingBytes > gMaxPendingBytes) {
+            gMaxPendingBytes = gPendingBytes;
+        }
+        if (gNumMessages < U_PORT_GNSS_MGA_TEST_MAX_PENDING) {
+            gMessageId[gNumMessages] = (uint8_t) messageId;
+        }
+        gNumMessages++;
+    }
+
+    return true;
+}
+
+// Send UBX-MGA-ACK-DATA0 for all of the pending UBX-MGA messages,
+// in order, nacking the one at gNackIndex.
+static void gnssAckPending()
+{
+    char body[8];
+    size_t index = gNumMessages - gNumPending;
+
+    for (size_t x = 0; x < gNumPending; x++, index++) {
+        body[0] = ((int32_t) index == gNackIndex) ? 0 : 1; // Type: 1 for accepted
+        body[1] = 0; // Version
+        body[2] = 0; // Info code
+        body[3] = (char) gPending[x].messageId;
+        memcpy(body + 4, gPending[x].payloadStart, 4);
+        gnssSend(0x13, 0x60, body, sizeof(body));
+    }
+    gNumPending = 0;
+    gPendingBytes = 0;
+}
+
+// The simulated GNSS chip.
+static void gnssTask(void *pParam)
+{
+    struct pollfd pollFd = {.fd = gMasterFd, .events = POLLIN};
+    char buffer[1024];
+    size_t length = 0;
+    const char *pEnd = NULL;
+    ssize_t x;
+
+    (void) pParam;
+
+    while (!gGnssExit) {
+        pollFd.revents = 0;
+        if (poll(&pollFd, 1, U_PORT_GNSS_MGA_TEST_QUIET_MS) > 0) {
+            x = read(gMasterFd, buffer + length, sizeof(buffer) - length);
+            if (x > 0) {
+                length += x;
+                uUbxProtocolDecodeAll(buffer, length, gnssMessage, NULL, &pEnd);
+                length -= pEnd - buffer;
+                memmove(buffer, pEnd, length);
+                if (length >= sizeof(buffer)) {
+                    // No message is this long: throw it away
+                    length = 0;
+                }
+            }
+        } else if (gNumPending > 0) {
+            // The sender has paused, waiting for acks
+            gnssAckPending();
+        }
+    }
+
+    gGnssExited = true;
+    uPortTaskDelete(NULL);
+}
+
+// Reset what the simulated GNSS chip has recorded.
+static void gnssReset(int32_t nackIndex)
+{
+    gNumPending = 0;
+    gPendingBytes = 0;
+    gMaxPending = 0;
+    gMaxPendingBytes = 0;
+    gNumMessages = 0;
+    gNackIndex = nackIndex;
+    gBlocksTotal = 0;
+    gBlocksSent = 0;
+}
+
+// Progress callback for uGnssMgaCacheSend().
+static bool progressCallback(uDeviceHandle_t devHandle,
+                             int32_t errorCode,
+                             size_t blocksTotal, size_t blocksSent,
+                             void *pCallbackParam)
+{
+    (void) devHandle;
+    (void) errorCode;
+    (void) pCallbackParam;
+
+    gBlocksTotal = blocksTotal;
+    gBlocksSent = blocksSent;
+
+    return true;
+}
+
+// Read callback for uGnssMgaOfflineStreamSend(), providing the
+// contents of gCacheBuffer a few bytes at a time.
+static int32_t readCallback(uDeviceHandle_t devHandle,
+                            char *pBuffer, size_t size,
+                            void *pCallbackParam)
+{
+    size_t length = gReadLength - gReadOffset;
+
+    (void) devHandle;
+    (void) pCallbackParam;
+
+    if (length > U_PORT_GNSS_MGA_TEST_READ_LENGTH_BYTES) {
+        length = U_PORT_GNSS_MGA_TEST_READ_LENGTH_BYTES;
+    }
+    if (length > size) {
+        length = size;
+    }
+    memcpy(pBuffer, gCacheBuffer + gReadOffset, length);
+    gReadOffset += length;
+    gReadCount++;
+
+    return (int32_t) length;
+}
+
+// Fill gCacheBuffer with AssistNow Offline data, returning the
+// amount of data.
+static size_t cacheFill()
+{
+    char body[U_PORT_GNSS_MGA_TEST_ANO_BODY_LENGTH_BYTES] = {0};
+    size_t size = 0;
+
+    // UBX-MGA-ANO messages for 2023/06/01, satellite by satellite,
+    // and one for 2023/06/02
+    body[4] = 23; // Year since 2000
+    body[5] = 6;  // Month
+    body[6] = 1;  // Day
+    for (size_t x = 0; x < U_PORT_GNSS_MGA_TEST_NUM_ANO_TODAY; x++) {
+        body[2] = (char) (x + 1); // Satellite ID
+        size += uUbxProtocolEncode(0x13, 0x20, body, sizeof(body), gCacheBuffer + size);
+    }
+    body[6] = 2;
+    size += uUbxProtocolEncode(0x13, 0x20, body, sizeof(body), gCacheBuffer + size);
+    // A UBX-MGA-GPS-ALM message
+    memset(body, 0, sizeof(body));
+    body[0] = 0x02;
+    size += uUbxProtocolEncode(0x13, 0x00, body,
+                               U_PORT_GNSS_MGA_TEST_ALM_BODY_LENGTH_BYTES,
+                               gCacheBuffer + size);
+
+    return size;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Send an AssistNow Offline cache with uGnssMgaCacheSend() to a
+ * simulated GNSS chip, checking that only today's messages are
+ * sent, that no more messages are outstanding than the window
+ * size or the receive buffer size of the GNSS chip allow, that
+ * every message is acknowledged before the send returns and that
+ * a nack stops the send.
+ */
+U_PORT_TEST_FUNCTION("[portGnssMga]", "portGnssMgaCacheWindow")
+{
+    uGnssTransportHandle_t transportHandle;
+    uDeviceHandle_t devHandle = NULL;
+    uPortTaskHandle_t gnssTaskHandle = NULL;
+    uGnssMgaCache_t cache;
+    const char *pSlaveName;
+    int64_t timeUtcMilliseconds = U_PORT_GNSS_MGA_TEST_DAY_ONE_UTC_MILLISECONDS +
+                                  (12 * 3600 * 1000LL);
+    size_t maxPending;
+    int32_t errorCode;
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uGnssInit() == 0);
+
+    // Open a pseudo-terminal and put a GNSS instance on its slave side
+    gMasterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    U_PORT_TEST_ASSERT(gMasterFd >= 0);
+    U_PORT_TEST_ASSERT((grantpt(gMasterFd) == 0) && (unlockpt(gMasterFd) == 0));
+    pSlaveName = ptsname(gMasterFd);
+    U_PORT_TEST_ASSERT(pSlaveName != NULL);
+    // A negative UART number makes uPortUartOpen() open the prefix
+    // on its own
+    U_PORT_TEST_ASSERT(uPortUartPrefix(pSlaveName) == 0);
+    transportHandle.uart = uPortUartOpen(-1, 115200, NULL,
+                                         U_PORT_GNSS_MGA_TEST_UART_BUFFER_LENGTH_BYTES,
+                                         -1, -1, -1, -1);
+    U_PORT_TEST_ASSERT(transportHandle.uart >= 0);
+    U_PORT_TEST_ASSERT(uGnssAdd(U_GNSS_MODULE_TYPE_M9, U_GNSS_TRANSPORT_UART,
+                                transportHandle, -1, false, &devHandle) == 0);
+
+    gGnssExit = false;
+    gGnssExited = false;
+    U_PORT_TEST_ASSERT(uPortTaskCreate(gnssTask, "simGnss", 1024 * 8, NULL,
+                                       U_CFG_OS_PRIORITY_MIN + 5,
+                                       &gnssTaskHandle) == 0);
+
+    U_PORT_TEST_ASSERT(uGnssMgaCacheCreate(gCacheBuffer, cacheFill(), &cache) ==
+                       U_PORT_GNSS_MGA_TEST_NUM_ANO_TODAY + 2);
+    U_PORT_TEST_ASSERT(uGnssMgaCacheIsValid(&cache, timeUtcMilliseconds));
+
+    // A window of three: only three messages may be outstanding
+    gnssReset(-1);
+    errorCode = uGnssMgaCacheSend(devHandle, &cache, timeUtcMilliseconds, 1000, 3,
+                                  progressCallback, NULL);
+    U_TEST_PRINT_LINE("window 3: uGnssMgaCacheSend() returned %d, %d message(s)"
+                      " received, at most %d outstanding.", errorCode,
+                      gNumMessages, gMaxPending);
+    U_PORT_TEST_ASSERT(errorCode == 0);
+    // The time, then today's UBX-MGA-ANO messages, then the almanac
+    U_PORT_TEST_ASSERT(gNumMessages == U_PORT_GNSS_MGA_TEST_NUM_SELECTED + 1);
+    U_PORT_TEST_ASSERT(gMessageId[0] == 0x40);
+    for (size_t x = 1; x <= U_PORT_GNSS_MGA_TEST_NUM_ANO_TODAY; x++) {
+        U_PORT_TEST_ASSERT(gMessageId[x] == 0x20);
+    }
+    U_PORT_TEST_ASSERT(gMessageId[U_PORT_GNSS_MGA_TEST_NUM_SELECTED] == 0x00);
+    U_PORT_TEST_ASSERT(gMaxPending == 3);
+    // Flushed: everything was acknowledged before the return
+    U_PORT_TEST_ASSERT(gBlocksTotal == U_PORT_GNSS_MGA_TEST_NUM_SELECTED);
+    U_PORT_TEST_ASSERT(gBlocksSent == U_PORT_GNSS_MGA_TEST_NUM_SELECTED);
+    U_PORT_TEST_ASSERT(gNumPending == 0);
+
+    // The largest window: the receive buffer size of the GNSS chip
+    // must now be what limits the number outstanding
+    gnssReset(-1);
+    errorCode = uGnssMgaCacheSend(devHandle, &cache, timeUtcMilliseconds, 1000,
+                                  U_GNSS_MGA_SEND_WINDOW_MAX, progressCallback, NULL);
+    U_TEST_PRINT_LINE("window %d: uGnssMgaCacheSend() returned %d, at most %d"
+                      " message(s), %d byte(s), outstanding.", U_GNSS_MGA_SEND_WINDOW_MAX,
+                      errorCode, gMaxPending, gMaxPendingBytes);
+    U_PORT_TEST_ASSERT(errorCode == 0);
+    U_PORT_TEST_ASSERT(gNumMessages == U_PORT_GNSS_MGA_TEST_NUM_SELECTED + 1);
+    maxPending = U_GNSS_MGA_RX_BUFFER_SIZE_BYTES / (U_PORT_GNSS_MGA_TEST_ANO_BODY_LENGTH_BYTES +
+                                                    U_UBX_PROTOCOL_OVERHEAD_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(gMaxPending == maxPending);
+    U_PORT_TEST_ASSERT(gMaxPendingBytes <= U_GNSS_MGA_RX_BUFFER_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(gBlocksSent == U_PORT_GNSS_MGA_TEST_NUM_SELECTED);
+
+    // A nack of the fifth UBX-MGA-ANO message stops the send
+    gnssReset(5);
+    errorCode = uGnssMgaCacheSend(devHandle, &cache, timeUtcMilliseconds, 1000, 3,
+                                  progressCallback, NULL);
+    U_TEST_PRINT_LINE("with a nack uGnssMgaCacheSend() returned %d after %d message(s)"
+                      " acknowledged.", errorCode, gBlocksSent);
+    U_PORT_TEST_ASSERT(errorCode == (int32_t) U_GNSS_ERROR_NACK);
+    U_PORT_TEST_ASSERT(gBlocksSent == 4);
+    U_PORT_TEST_ASSERT(gNumMessages < U_PORT_GNSS_MGA_TEST_NUM_SELECTED + 1);
+
+    gGnssExit = true;
+    while (!gGnssExited) {
+        uPortTaskBlock(10);
+    }
+
+    uGnssRemove(devHandle);
+    uGnssDeinit();
+    uPortUartClose(transportHandle.uart);
+    close(gMasterFd);
+    gMasterFd = -1;
+    uPortDeinit();
+
+    // Check for resource leaks
+    U_PORT_TEST_ASSERT(uTestUtilResourceCheck(U_TEST_PREFIX,
+                                              U_TEST_UTIL_RESOURCE_CHECK_ERROR_MARKER,
+                                              true));
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Stream AssistNow Offline data with uGnssMgaOfflineStreamSend() to
+ * a simulated GNSS chip, a few bytes at a time, checking that only
+ * today's messages are sent, that the window is respected and that
+ * data with nothing for today is reported as not found.
+ */
+U_PORT_TEST_FUNCTION("[portGnssMga]", "portGnssMgaOfflineStream")
+{
+    uGnssTransportHandle_t transportHandle;
+    uDeviceHandle_t devHandle = NULL;
+    uPortTaskHandle_t gnssTaskHandle = NULL;
+    const char *pSlaveName;
+    int64_t timeUtcMilliseconds = U_PORT_GNSS_MGA_TEST_DAY_ONE_UTC_MILLISECONDS +
+                                  (12 * 3600 * 1000LL);
+    int32_t errorCode;
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uGnssInit() == 0);
+
+    // Open a pseudo-terminal and put a GNSS instance on its slave side
+    gMasterFd = posix_openpt(O_RDWR | O_NOCTTY);
+    U_PORT_TEST_ASSERT(gMasterFd >= 0);
+    U_PORT_TEST_ASSERT((grantpt(gMasterFd) == 0) && (unlockpt(gMasterFd) == 0));
+    pSlaveName = ptsname(gMasterFd);
+    U_PORT_TEST_ASSERT(pSlaveName != NULL);
+    U_PORT_TEST_ASSERT(uPortUartPrefix(pSlaveName) == 0);
+    transportHandle.uart = uPortUartOpen(-1, 115200, NULL,
+                                         U_PORT_GNSS_MGA_TEST_UART_BUFFER_LENGTH_BYTES,
+                                         -1, -1, -1, -1);
+    U_PORT_TEST_ASSERT(transportHandle.uart >= 0);
+    U_PORT_TEST_ASSERT(uGnssAdd(U_GNSS_MODULE_TYPE_M9, U_GNSS_TRANSPORT_UART,
+                                transportHandle, -1, false, &devHandle) == 0);
+
+    gGnssExit = false;
+    gGnssExited = false;
+    U_PORT_TEST_ASSERT(uPortTaskCreate(gnssTask, "simGnss", 1024 * 8, NULL,
+                                       U_CFG_OS_PRIORITY_MIN + 5,
+                                       &gnssTaskHandle) == 0);
+
+    gReadLength = cacheFill();
+
+    // Bad parameters: nothing must be sent
+    gnssReset(-1);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineStreamSend(NULL, readCallback, NULL,
+                                                 timeUtcMilliseconds, 1000, 3,
+                                                 NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineStreamSend(devHandle, NULL, NULL,
+                                                 timeUtcMilliseconds, 1000, 3,
+                                                 NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineStreamSend(devHandle, readCallback, NULL,
+                                                 -1, 1000, 3, NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uGnssMgaOfflineStreamSend(devHandle, readCallback, NULL,
+                                                 timeUtcMilliseconds, -1, 3,
+                                                 NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(gNumMessages == 0);
+
+    // A window of three: the data arrives in pieces that split
+    // messages yet only today's are sent, at most three outstanding
+    gnssReset(-1);
+    gReadOffset = 0;
+    gReadCount = 0;
+    errorCode = uGnssMgaOfflineStreamSend(devHandle, readCallback, NULL,
+                                          timeUtcMilliseconds, 1000, 3,
+                                          progressCallback, NULL);
+    U_TEST_PRINT_LINE("uGnssMgaOfflineStreamSend() returned %d after %d read(s), %d"
+                      " message(s) received, at most %d outstanding.", errorCode,
+                      gReadCount, gNumMessages, gMaxPending);
+    U_PORT_TEST_ASSERT(errorCode == 0);
+    U_PORT_TEST_ASSERT(gReadOffset == gReadLength);
+    U_PORT_TEST_ASSERT(gReadCount > gReadLength / U_PORT_GNSS_MGA_TEST_READ_LENGTH_BYTES);
+    // The time, then today's UBX-MGA-ANO messages, then the almanac
+    U_PORT_TEST_ASSERT(gNumMessages == U_PORT_GNSS_MGA_TEST_NUM_SELECTED + 1);
+    U_PORT_TEST_ASSERT(gMessageId[0] == 0x40);
+    for (size_t x = 1; x <= U_PORT_GNSS_MGA_TEST_NUM_ANO_TODAY; x++) {
+        U_PORT_TEST_ASSERT(gMessageId[x] == 0x20);
+    }
+    U_PORT_TEST_ASSERT(gMessageId[U_PORT_GNSS_MGA_TEST_NUM_SELECTED] == 0x00);
+    U_PORT_TEST_ASSERT(gMaxPending <= 3);
+    // Flushed: everything was acknowledged before the return
+    U_PORT_TEST_ASSERT(gBlocksTotal == U_PORT_GNSS_MGA_TEST_NUM_SELECTED);
+    U_PORT_TEST_ASSERT(gBlocksSent == U_PORT_GNSS_MGA_TEST_NUM_SELECTED);
+    U_PORT_TEST_ASSERT(gNumPending == 0);
+
+    // Two days later there is no UBX-MGA-ANO message for the day:
+    // the almanac is still sent but the data is not found
+    gnssReset(-1);
+    gReadOffset = 0;
+    errorCode = uGnssMgaOfflineStreamSend(devHandle, readCallback, NULL,
+                                          timeUtcMilliseconds + (2 * 24 * 3600 * 1000LL),
+                                          1000, 0, progressCallback, NULL);
+    U_TEST_PRINT_LINE("two days later uGnssMgaOfflineStreamSend() returned %d, %d"
+                      " message(s) received.", errorCode, gNumMessages);
+    U_PORT_TEST_ASSERT(errorCode == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    U_PORT_TEST_ASSERT(gNumMessages == 2);
+    U_PORT_TEST_ASSERT(gMessageId[0] == 0x40);
+    U_PORT_TEST_ASSERT(gMessageId[1] == 0x00);
+    U_PORT_TEST_ASSERT(gBlocksSent == 1);
+
+    gGnssExit = true;
+    while (!gGnssExited) {
+        uPortTaskBlock(10);
+    }
+
+    uGnssRemove(devHandle);
+    uGnssDeinit();
+    uPortUartClose(transportHandle.uart);
+    close(gMasterFd);
+    gMasterFd = -1;
+    uPortDeinit();
+
+    // Check for resource leaks
+    U_PORT_TEST_ASSERT(uTestUtilResourceCheck(U_TEST_PREFIX,
+                                              U_TEST_UTIL_RESOURCE_CHECK_ERROR_MARKER,
+                                              true));
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+// End of file
@@ -0,0 +1,3290 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Tests for the simulated SARA-R5 cellular module of the
+ * Linux platform: the cellular socket API is run over the simulated
+ * module against TCP and UDP echo servers on the local host, so no
+ * hardware is required.
+ * IMPORTANT: see notes in u_cfg_test_platform_specific.h for the
+ * naming rules that must be followed when using the
+ * U_PORT_TEST_FUNCTION() macro.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "stdlib.h"    // atoi()
+#include "stdio.h"     // snprintf()
+#include "string.h"    // memset(), memcmp(), strcmp()
+#include "errno.h"
+
+#include "unistd.h"
+#include "poll.h"
+#include "sys/socket.h"
+#include "netinet/in.h"
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_debug.h"
+
+#include "u_test_util_resource_check.h"
+
+#include "u_at_client.h"
+
+#include "u_device.h"
+
+#include "u_sock.h"
+#include "u_sock_errno.h"
+
+#include "u_cell_module_type.h"
+#include "u_cell.h"
+#include "u_cell_net.h"     // Needed by u_cell_pwr.h
+#include "u_cell_pwr.h"
+#include "u_cell_cfg.h"
+#include "u_cell_info.h"
+#include "u_cell_sock.h"
+#include "u_location.h"
+#include "u_cell_loc.h"
+#include "u_cell_mqtt.h"
+
+#include "u_mqtt_common.h"
+#include "u_mqtt_client.h"
+
+#include "u_security_tls.h"
+#include "u_http_client.h"
+
+#include "u_dns_server.h"
+
+#include "u_cell_private.h" // So that we can get at some innards
+
+#include "u_port_sim_modem.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The string to put at the start of all prints from this test.
+ */
+#define U_TEST_PREFIX "U_PORT_SIM_MODEM_TEST: "
+
+/** Print a whole line, with terminator, prefixed for this test file.
+ */
+#define U_TEST_PRINT_LINE(format, ...) uPortLog(U_TEST_PREFIX format "\n", ##__VA_ARGS__)
+
+/** The size of AT buffer to use.
+ */
+#define U_PORT_SIM_MODEM_TEST_AT_BUFFER_LENGTH_BYTES 2048
+
+/** The amount of data to send through the TCP echo server.
+ */
+#define U_PORT_SIM_MODEM_TEST_TCP_LENGTH_BYTES 3000
+
+/** The response delay to configure.
+ */
+#define U_PORT_SIM_MODEM_TEST_RESPONSE_DELAY_MS 20
+
+/** How long to wait for echoed data.
+ */
+#define U_PORT_SIM_MODEM_TEST_TIMEOUT_MS 10000
+
+/** The number of simulated modules, each with an AT client, for
+ * the many AT clients test: enough that the AT client has to grow
+ * its table of them twice.
+ */
+#define U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS ((U_AT_CLIENT_MAX_NUM * 2) + 1)
+
+/** The size of the log that the MQTT session test keeps of what
+ * reached the simulated broker.
+ */
+#define U_PORT_SIM_MODEM_TEST_MQTT_LOG_LENGTH_BYTES 512
+
+/** The number of messages that the MQTT asynchronous publish test
+ * queues.
+ */
+#define U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC 3
+
+/** The number of requests that the HTTP request queue test queues.
+ */
+#define U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS 4
+
+/** The size of the response body buffer of each HTTP request.
+ */
+#define U_PORT_SIM_MODEM_TEST_HTTP_BODY_LENGTH_BYTES 32
+
+/** The length of the path that the HTTP conditional request test
+ * uses to check that a path too long to remember an ETag for is
+ * requested unconditionally.
+ */
+#define U_PORT_SIM_MODEM_TEST_HTTP_LONG_PATH_LENGTH (U_HTTP_CLIENT_ETAG_PATH_LENGTH_BYTES + 10)
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A simulated module, as added by pModuleAdd().
+ */
+typedef struct {
+    uDeviceSerial_t *pDeviceSerial; /**< The simulated module. */
+    uAtClientHandle_t atHandle; /**< The AT client talking to it. */
+    uDeviceHandle_t cellHandle; /**< The cellular instance, NULL if there is none. */
+} uPortSimModemTestModule_t;
+
+/** Everything set up by preamble() and pModuleAdd() and taken down
+ * again by postamble().
+ */
+typedef struct {
+    int32_t resourceCount; /**< The resource count before the test began. */
+    uPortTaskHandle_t echoTaskHandle; /**< The echo server task, NULL if not started. */
+    int32_t tcpPort; /**< The port of the TCP echo server. */
+    int32_t udpPort; /**< The port of the UDP echo server. */
+    size_t numModules; /**< The number of entries in module[]. */
+    uPortSimModemTestModule_t module[U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS];
+} uPortSimModemTestHandles_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** The handles of the test that is running.
+ */
+static uPortSimModemTestHandles_t gHandles;
+
+/** The listening TCP socket of the echo server.
+ */
+static int gTcpListenFd = -1;
+
+/** The UDP socket of the echo server.
+ */
+static int gUdpFd = -1;
+
+/** Flag to tell the echo server task to exit.
+ */
+static volatile bool gEchoExit = false;
+
+/** Flag set by the echo server task when it has exited.
+ */
+static volatile bool gEchoExited = false;
+
+/** A script entry, to check that scripting works.
+ */
+static const uPortSimModemScript_t gScript[] = {
+    {"+CGMR", "\r\nXX.YY\r\n\r\nOK\r\n"}
+};
+
+/** A script that has the simulated module report that 3GPP power
+ * saving has been agreed with the network.
+ */
+static const uPortSimModemScript_t gScriptPsm[] = {
+    {"+UCPSMS?", "\r\n+UCPSMS: 1,,,\"01000011\",\"00000001\",0\r\n\r\nOK\r\n"}
+};
+
+/** A script that has the simulated module report an MNO profile,
+ * RATs and band masks, for uCellCfgApply().
+ */
+static const uPortSimModemScript_t gScriptCfg[] = {
+    {"+UMNOPROF?", "\r\n+UMNOPROF: 100\r\n\r\nOK\r\n"},
+    {"+URAT?", "\r\n+URAT: 7\r\n\r\nOK\r\n"},
+    {"+UBANDMASK?", "\r\n+UBANDMASK: 0,524420,1,524420\r\n\r\nOK\r\n"}
+};
+
+/** A script that has the simulated module report the results of a
+ * deep scan, including the same cell twice with different signal
+ * strengths, as it would if the scan were repeated.
+ */
+static const uPortSimModemScript_t gScriptDeepScan[] = {
+    {
+        "+COPS=5",
+        "\r\nMCC:222, MNC:88, TAC:562c, CI:57367043, DLF: 1325, ULF:19325, PCI:163, RSRP LEV:25, RSRQ LEV:1\r\n"
+        "\r\nMCC:222, MNC:1, TAC:1a2b, CI:12345678, DLF: 6300, ULF:24300, PCI:10, RSRP LEV:40, RSRQ LEV:10\r\n"
+        "\r\nMCC:222, MNC:88, TAC:562c, CI:57367043, DLF: 1325, ULF:19325, PCI:163, RSRP LEV:30, RSRQ LEV:2\r\n"
+        "\r\nMCC:222, MNC:88, TAC:562c, CI:57367044, DLF: 1325, ULF:19325, PCI:164, RSRP LEV:10, RSRQ LEV:0\r\n"
+        "\r\nOK\r\n"
+    }
+};
+
+/** A script that has the simulated module report that it is
+ * registered with an active PDP context, for a warm attach.
+ */
+static const uPortSimModemScript_t gScriptWarmAttach[] = {
+    {"+CEREG?", "\r\n+CEREG: 4,1,\"562c\",\"0370b003\",7\r\n\r\nOK\r\n"},
+    {"+CGACT?", "\r\n+CGACT: 1,1\r\n\r\nOK\r\n"},
+    {"+CGCONTRDP=", "\r\n+CGCONTRDP: 1,5,\"internet\",\"10.0.0.1.255.255.255.0\"\r\n\r\nOK\r\n"}
+};
+
+/** A script that has the simulated module report that it is
+ * registered with a second PDP context active alongside the first.
+ */
+static const uPortSimModemScript_t gScriptContext[] = {
+    {"+CEREG?", "\r\n+CEREG: 4,1,\"562c\",\"0370b003\",7\r\n\r\nOK\r\n"},
+    {"+CGACT?", "\r\n+CGACT: 1,1\r\n+CGACT: 2,1\r\n\r\nOK\r\n"},
+    {"+CGCONTRDP=", "\r\n+CGCONTRDP: 1,5,\"internet\",\"10.0.0.1.255.255.255.0\"\r\n\r\nOK\r\n"},
+    {"+UPSDA=1,3", "\r\nOK\r\n\r\n+UUPSDA: 0,\"10.0.0.2\"\r\n"},
+    {"+CGPADDR=2", "\r\n+CGPADDR: 2,\"10.0.0.2\"\r\n\r\nOK\r\n"}
+};
+
+/** A script that has the simulated module report that it is
+ * registered, with data counters, and that it is detached once
+ * asked to disconnect.
+ */
+static const uPortSimModemScript_t gScriptDataCounter[] = {
+    {"+CEREG?", "\r\n+CEREG: 4,1,\"562c\",\"0370b003\",7\r\n\r\nOK\r\n"},
+    {"+CGACT?", "\r\n+CGACT: 1,1\r\n\r\nOK\r\n"},
+    {"+CGCONTRDP=", "\r\n+CGCONTRDP: 1,5,\"internet\",\"10.0.0.1.255.255.255.0\"\r\n\r\nOK\r\n"},
+    {"+UGCNTRD", "\r\n+UGCNTRD: 1,1000,2000,1000,2000\r\n\r\nOK\r\n"},
+    {"+CGATT?", "\r\n+CGATT: 0\r\n\r\nOK\r\n"}
+};
+
+/** A script that has the simulated module emit a greeting message
+ * on reboot, well before the reboot wait time of a SARA-R5.
+ */
+static const uPortSimModemScript_t gScriptGreeting[] = {
+    {"+CSGT?", "\r\n+CSGT: \"+SIMGREETING\",1\r\n\r\nOK\r\n"},
+    {"+IPR?", "\r\n+IPR: 115200\r\n\r\nOK\r\n"},
+    {"+CFUN=16", "\r\nOK\r\n\r\n+SIMGREETING\r\n"}
+};
+
+/** A script for the fast boot test: a greeting, as for
+ * gScriptGreeting, so that reboots are quick, and an MNO profile;
+ * the non-volatile settings are handled by fastBootCommandCallback().
+ */
+static const uPortSimModemScript_t gScriptFastBoot[] = {
+    {"+CSGT?", "\r\n+CSGT: \"+SIMGREETING\",1\r\n\r\nOK\r\n"},
+    {"+IPR?", "\r\n+IPR: 115200\r\n\r\nOK\r\n"},
+    {"+CFUN=16", "\r\nOK\r\n\r\n+SIMGREETING\r\n"},
+    {"+UMNOPROF?", "\r\n+UMNOPROF: 100\r\n\r\nOK\r\n"}
+};
+
+/** A script that has the simulated module report its identity.
+ */
+static const uPortSimModemScript_t gScriptIdentity[] = {
+    {"+CGSN", "\r\n356726100184891\r\n\r\nOK\r\n"},
+    {"+CIMI", "\r\n222107701772423\r\n\r\nOK\r\n"},
+    {"+CCID", "\r\n+CCID: 89882280666027595366\r\n\r\nOK\r\n"},
+    {"+CGMM", "\r\nSARA-R510M8S\r\n\r\nOK\r\n"},
+    {"I9", "\r\n02.06,A00.01\r\n\r\nOK\r\n"}
+};
+
+#ifdef U_CFG_AT_CLIENT_STATS
+/** A script with a command that the simulated module never answers,
+ * for the adaptive AT timeout test; "AT+XADAPT" on its own gets the
+ * default "OK".
+ */
+static const uPortSimModemScript_t gScriptAdaptive[] = {
+    {"+XADAPT=1", NULL}
+};
+#endif
+
+/** The number of times deferOperation() has been called.
+ */
+static volatile int32_t gDeferCount = 0;
+
+/** The parameter that deferOperation() was last called with.
+ */
+static void *volatile gpDeferParameter = NULL;
+
+/** The number of AT callbacks received by each AT client of the
+ * many AT clients test.
+ */
+static volatile int32_t gAtCallbackCount[U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS] = {0};
+
+/** Data to send.
+ */
+static char gData[U_PORT_SIM_MODEM_TEST_TCP_LENGTH_BYTES];
+
+/** Buffer for data received.
+ */
+static char gBuffer[U_PORT_SIM_MODEM_TEST_TCP_LENGTH_BYTES];
+
+/** What reached the simulated broker in the MQTT session test:
+ * "C;" for a connection, "S:<topic>;" for a subscription and
+ * "P:<message>;" for a publish.
+ */
+static char gMqttLog[U_PORT_SIM_MODEM_TEST_MQTT_LOG_LENGTH_BYTES];
+
+/** The length of gMqttLog.
+ */
+static volatile size_t gMqttLogLength = 0;
+
+/** Whether the simulated broker is connected.
+ */
+static volatile bool gMqttConnected = false;
+
+/** The number of connection attempts that the simulated broker
+ * should refuse.
+ */
+static volatile int32_t gMqttConnectFailCount = 0;
+
+/** The number of publishes, while connected, that the simulated
+ * broker should refuse.
+ */
+static volatile int32_t gMqttPublishFailCount = 0;
+
+/** The number of times the reconnect callback has been called.
+ */
+static volatile int32_t gMqttReconnectCount = 0;
+
+/** The number of attempts passed to the reconnect callback.
+ */
+static volatile int32_t gMqttReconnectAttempts = 0;
+
+/** The number of times the disconnect callback has been called.
+ */
+static volatile int32_t gMqttDisconnectCount = 0;
+
+/** The order in which the callbacks of the MQTT asynchronous
+ * publish test were called, the index of each message as a digit.
+ */
+static char gMqttAsyncDone[U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC + 1];
+
+/** The number of entries in gMqttAsyncDone.
+ */
+static volatile size_t gMqttAsyncDoneCount = 0;
+
+/** The message handle passed to the callback of each message of
+ * the MQTT asynchronous publish test.
+ */
+static volatile int32_t gMqttAsyncHandle[U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC];
+
+/** The error code passed to the callback of each message of the
+ * MQTT asynchronous publish test.
+ */
+static volatile int32_t gMqttAsyncErrorCode[U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC];
+
+/** The sockets hex mode setting of the simulated module in the
+ * fast boot test.
+ */
+static volatile int32_t gFastBootHexMode = 1;
+
+/** The GNSS profile setting of the simulated module in the fast
+ * boot test.
+ */
+static volatile int32_t gFastBootGnssProfile = 0;
+
+/** The number of times a non-volatile setting has been written
+ * in the fast boot test.
+ */
+static volatile int32_t gFastBootWriteCount = 0;
+
+/** The number of times a CellLocate fix has been requested in the
+ * cached location test.
+ */
+static volatile int32_t gLocRequestCount = 0;
+
+/** The number of AT+USORD reads, of more than zero bytes, that
+ * the simulated module has been asked for.
+ */
+static volatile int32_t gSockReadCount = 0;
+
+/** The number of AT+USOWR writes that the simulated module has
+ * been asked for.
+ */
+static volatile int32_t gSockWriteCount = 0;
+
+/** The paths of the HTTP requests that have reached the simulated
+ * module, in order, separated by spaces, a path being followed by
+ * "*" if the request carried an If-None-Match header.
+ */
+static char gHttpLog[U_PORT_SIM_MODEM_TEST_MQTT_LOG_LENGTH_BYTES];
+
+/** The path of the last HTTP request, which is what the simulated
+ * module puts in the body of the response.
+ */
+static char gHttpPath[U_PORT_SIM_MODEM_TEST_HTTP_LONG_PATH_LENGTH + 1];
+
+/** The version of the resources that the simulated module serves,
+ * which goes into their ETags; negative to send no ETags.
+ */
+static volatile int32_t gHttpETagVersion = -1;
+
+/** The value of the If-None-Match request header that has been set
+ * on the simulated module, empty if there is none.
+ */
+static char gHttpIfNoneMatch[U_HTTP_CLIENT_ETAG_LENGTH_BYTES];
+
+/** The value of the If-None-Match header that the last HTTP request
+ * was sent with, empty if there was none.
+ */
+static char gHttpRequestIfNoneMatch[U_HTTP_CLIENT_ETAG_LENGTH_BYTES];
+
+/** How long the simulated module takes to carry out an HTTP request.
+ */
+static volatile int32_t gHttpDelayMs = 0;
+
+/** The order in which the HTTP request queue test is told that its
+ * requests have completed, a character per request.
+ */
+static char gHttpDone[U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS + 1];
+
+/** The number of entries in gHttpDone.
+ */
+static volatile size_t gHttpDoneCount = 0;
+
+/** What each HTTP request of the test was completed with.
+ */
+static volatile int32_t gHttpStatusCodeOrError[U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS];
+
+/** The number of times the registration status has been queried
+ * in the registration test.
+ */
+static volatile int32_t gRegQueryCount = 0;
+
+/** The simulated module of the registration test, so that
+ * regKeepGoingCallback() can send a URC from it.
+ */
+static uDeviceSerial_t *gpRegDeviceSerial = NULL;
+
+/** The time at which the registration test began to register.
+ */
+static int32_t gRegStartTimeMs = 0;
+
+/** Set once the simulated module has reported registration in
+ * the registration test.
+ */
+static volatile bool gRegRegistered = false;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Open a socket of the given type bound to the loopback address,
+// returning the port number it is bound to.
+static int32_t echoSocketOpen(int type, int *pFd)
+{
+    int32_t port = -1;
+    struct sockaddr_in address = {0};
+    socklen_t addressLength = sizeof(address);
+
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    *pFd = socket(AF_INET, type, 0);
+    if ((*pFd >= 0) &&
+        (bind(*pFd, (struct sockaddr *) &address, sizeof(address)) == 0) &&
+        ((type != SOCK_STREAM) || (listen(*pFd, 1) == 0)) &&
+        (getsockname(*pFd, (struct sockaddr *) &address, &addressLength) == 0)) {
+        port = ntohs(address.sin_port);
+    }
+
+    return port;
+}
+
+// A TCP and UDP echo server task, which can serve two TCP
+// connections at once.
+static void echoTask(void *pParam)
+{
+    struct pollfd pollFd[4];
+    int tcpFd[2] = {-1, -1};
+    char buffer[512];
+    ssize_t length;
+    struct sockaddr_in address;
+    socklen_t addressLength;
+
+    (void) pParam;
+
+    while (!gEchoExit) {
+        pollFd[0].fd = gTcpListenFd;
+        pollFd[1].fd = gUdpFd;
+        pollFd[2].fd = tcpFd[0];
+        pollFd[3].fd = tcpFd[1];
+        for (size_t x = 0; x < sizeof(pollFd) / sizeof(pollFd[0]); x++) {
+            pollFd[x].events = POLLIN;
+            pollFd[x].revents = 0;
+        }
+        if (poll(pollFd, sizeof(pollFd) / sizeof(pollFd[0]), 10) > 0) {
+            if (pollFd[0].revents & POLLIN) {
+                if (tcpFd[0] < 0) {
+                    tcpFd[0] = accept(gTcpListenFd, NULL, NULL);
+                } else if (tcpFd[1] < 0) {
+                    tcpFd[1] = accept(gTcpListenFd, NULL, NULL);
+                }
+            }
+            if (pollFd[1].revents & POLLIN) {
+                addressLength = sizeof(address);
+                length = recvfrom(gUdpFd, buffer, sizeof(buffer), 0,
+                                  (struct sockaddr *) &address, &addressLength);
+                if (length > 0) {
+                    sendto(gUdpFd, buffer, length, 0,
+                           (struct sockaddr *) &address, addressLength);
+                }
+            }
+            for (size_t x = 0; x < sizeof(tcpFd) / sizeof(tcpFd[0]); x++) {
+                if ((tcpFd[x] >= 0) && (pollFd[x + 2].revents & (POLLIN | POLLHUP))) {
+                    length = recv(tcpFd[x], buffer, sizeof(buffer), 0);
+                    if (length > 0) {
+                        send(tcpFd[x], buffer, length, MSG_NOSIGNAL);
+                    } else {
+                        close(tcpFd[x]);
+                        tcpFd[x] = -1;
+                    }
+                }
+            }
+        }
+    }
+    for (size_t x = 0; x < sizeof(tcpFd) / sizeof(tcpFd[0]); x++) {
+        if (tcpFd[x] >= 0) {
+            close(tcpFd[x]);
+        }
+    }
+
+    gEchoExited = true;
+    uPortTaskDelete(NULL);
+}
+
+// Write some data on a socket and wait for it to be echoed back,
+// returning true on success.
+static bool sockEcho(uSockDescriptor_t descriptor, size_t length)
+{
+    int32_t received = 0;
+    int32_t x;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    memset(gBuffer, 0, sizeof(gBuffer));
+    if (uSockWrite(descriptor, gData, length) == (int32_t) length) {
+        while ((received < (int32_t) length) &&
+               (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+            x = uSockRead(descriptor, gBuffer + received, length - received);
+            if (x > 0) {
+                received += x;
+            }
+        }
+    }
+    U_TEST_PRINT_LINE("%d byte(s) of TCP echoed over u_sock in %d ms.", received,
+                      uPortGetTickTimeMs() - startTimeMs);
+
+    return (received == (int32_t) length) && (memcmp(gData, gBuffer, length) == 0);
+}
+
+// The standard preamble for a test: bring up the port, the AT
+// client and the device API (which brings up the Wi-Fi socket layer
+// as well, as u_sock needs) and, if echo is true, start the TCP and
+// UDP echo servers.  Modules are then added with pModuleAdd().
+static void preamble(uPortSimModemTestHandles_t *pHandles, bool echo)
+{
+    memset(pHandles, 0, sizeof(*pHandles));
+    pHandles->tcpPort = -1;
+    pHandles->udpPort = -1;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    pHandles->resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+    U_PORT_TEST_ASSERT(uDeviceInit() == 0);
+
+    if (echo) {
+        pHandles->tcpPort = echoSocketOpen(SOCK_STREAM, &gTcpListenFd);
+        U_PORT_TEST_ASSERT(pHandles->tcpPort > 0);
+        pHandles->udpPort = echoSocketOpen(SOCK_DGRAM, &gUdpFd);
+        U_PORT_TEST_ASSERT(pHandles->udpPort > 0);
+        gEchoExit = false;
+        gEchoExited = false;
+        U_PORT_TEST_ASSERT(uPortTaskCreate(echoTask, "simEcho", 1024 * 8, NULL,
+                                           U_CFG_OS_PRIORITY_MIN + 5,
+                                           &pHandles->echoTaskHandle) == 0);
+    }
+}
+
+// Add a simulated module with the given configuration (NULL for
+// the default), an AT client talking to it and, unless moduleType
+// is U_CELL_MODULE_TYPE_MAX_NUM, a cellular instance of that type.
+static uPortSimModemTestModule_t *pModuleAdd(uPortSimModemTestHandles_t *pHandles,
+                                             const uPortSimModemCfg_t *pCfg,
+                                             uCellModuleType_t moduleType)
+{
+    uPortSimModemTestModule_t *pModule;
+    uAtClientStreamHandle_t stream;
+
+    U_PORT_TEST_ASSERT(pHandles->numModules < sizeof(pHandles->module) /
+                       sizeof(pHandles->module[0]));
+    pModule = &(pHandles->module[pHandles->numModules]);
+    pModule->pDeviceSerial = pUPortSimModemCreate(pCfg);
+    U_PORT_TEST_ASSERT(pModule->pDeviceSerial != NULL);
+    pHandles->numModules++;
+    U_PORT_TEST_ASSERT(pModule->pDeviceSerial->open(pModule->pDeviceSerial, NULL, 0) == 0);
+    stream.handle.pDeviceSerial = pModule->pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    pModule->atHandle = uAtClientAddExt(&stream, NULL,
+                                        U_PORT_SIM_MODEM_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(pModule->atHandle != NULL);
+    pModule->cellHandle = NULL;
+    if (moduleType < U_CELL_MODULE_TYPE_MAX_NUM) {
+        U_PORT_TEST_ASSERT(uCellAdd(moduleType, pModule->atHandle,
+                                    -1, -1, -1, false, &pModule->cellHandle) == 0);
+    }
+
+    return pModule;
+}
+
+// The standard postamble for a test: take down everything that
+// preamble() and pModuleAdd() set up and check for resource leaks.
+static void postamble(uPortSimModemTestHandles_t *pHandles)
+{
+    uPortSimModemTestModule_t *pModule;
+    int32_t resourceCount;
+
+    uSockDeinit();
+    uSockCleanUp();
+    uCellSockDeinit();
+    uCellDeinit();
+    for (size_t x = 0; x < pHandles->numModules; x++) {
+        pModule = &(pHandles->module[x]);
+        if (pModule->atHandle != NULL) {
+            uAtClientRemove(pModule->atHandle);
+        }
+        pModule->pDeviceSerial->close(pModule->pDeviceSerial);
+        uPortSimModemDelete(pModule->pDeviceSerial);
+    }
+    pHandles->numModules = 0;
+    uDeviceDeinit();
+
+    if (pHandles->echoTaskHandle != NULL) {
+        gEchoExit = true;
+        while (!gEchoExited) {
+            uPortTaskBlock(10);
+        }
+        pHandles->echoTaskHandle = NULL;
+    }
+    if (gTcpListenFd >= 0) {
+        close(gTcpListenFd);
+        gTcpListenFd = -1;
+    }
+    if (gUdpFd >= 0) {
+        close(gUdpFd);
+        gUdpFd = -1;
+    }
+
+    uAtClientDeinit();
+    uPortDeinit();
+
+    // Check for resource leaks
+    U_PORT_TEST_ASSERT(uTestUtilResourceCheck(U_TEST_PREFIX,
+                                              U_TEST_UTIL_RESOURCE_CHECK_ERROR_MARKER,
+                                              true));
+    resourceCount = uTestUtilGetDynamicResourceCount() - pHandles->resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+// An operation deferred with uCellPwrDefer(): talks to the module
+// to show that it can and records that it was called.
+static void deferOperation(uDeviceHandle_t cellHandle, void *pParameter)
+{
+    if (uCellPwrIsAlive(cellHandle)) {
+        gpDeferParameter = pParameter;
+        gDeferCount++;
+    }
+}
+
+// An AT callback for the many AT clients test: counts calls
+// against the index at pParameter.
+static void atCallback(uAtClientHandle_t atHandle, void *pParameter)
+{
+    size_t index = (size_t) (uintptr_t) pParameter;
+
+    (void) atHandle;
+    if (index < sizeof(gAtCallbackCount) / sizeof(gAtCallbackCount[0])) {
+        gAtCallbackCount[index]++;
+    }
+}
+
+// Wait for gDeferCount to reach the given value, returning true
+// if it does.
+static bool deferWait(int32_t count, int32_t timeoutMs)
+{
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    while ((gDeferCount < count) &&
+           (uPortGetTickTimeMs() - startTimeMs < timeoutMs)) {
+        uPortTaskBlock(10);
+    }
+
+    return (gDeferCount >= count);
+}
+
+// Add to gMqttLog the given string, with the given prefix and
+// a ";" terminator; the string ends at pEnd or, if pEnd is NULL,
+// at its null terminator.
+static void mqttLog(const char *pPrefix, const char *pStr, const char *pEnd)
+{
+    size_t length = (pEnd != NULL) ? (size_t) (pEnd - pStr) : strlen(pStr);
+    int32_t x;
+
+    x = snprintf(gMqttLog + gMqttLogLength, sizeof(gMqttLog) - gMqttLogLength,
+                 "%s%.*s;", pPrefix, (int) length, pStr);
+    if ((x > 0) && (gMqttLogLength + x < sizeof(gMqttLog))) {
+        gMqttLogLength += x;
+    }
+}
+
+// Wait for gMqttLog to contain the given string, returning true
+// if it does.
+static bool mqttLogWait(const char *pStr, int32_t timeoutMs)
+{
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    while ((strstr(gMqttLog, pStr) == NULL) &&
+           (uPortGetTickTimeMs() - startTimeMs < timeoutMs)) {
+        uPortTaskBlock(10);
+    }
+
+    return (strstr(gMqttLog, pStr) != NULL);
+}
+
+// Command callback of the simulated module for the MQTT session
+// test: plays the part of the MQTT client of a SARA-R410M-02B,
+// which uses the old SARA-R4 syntax where the outcome of most
+// commands is in the response, and of the broker behind it.
+static int32_t mqttCommandCallback(const char *pLine, char *pResponse,
+                                   size_t responseSize, void *pParam)
+{
+    int32_t length = -1;
+    int32_t opCode;
+    const char *pStr = NULL;
+    const char *pEnd = NULL;
+    bool success;
+
+    (void) pParam;
+
+    if (strncmp(pLine, "+UMQTT=", 7) == 0) {
+        // Profile settings are always accepted
+        length = snprintf(pResponse, responseSize,
+                          "\r\n+UMQTT: %d,1\r\n\r\nOK\r\n", atoi(pLine + 7));
+    } else if (strncmp(pLine, "+UMQTTC=", 8) == 0) {
+        opCode = atoi(pLine + 8);
+        switch (opCode) {
+            case 0:
+                // Disconnect
+                gMqttConnected = false;
+                length = snprintf(pResponse, responseSize,
+                                  "\r\n+UMQTTC: 0,1\r\n\r\nOK\r\n");
+                break;
+            case 1:
+                // Connect, where the URC gives the outcome,
+                // zero meaning success in the old syntax
+                success = (gMqttConnectFailCount == 0);
+                if (success) {
+                    gMqttConnected = true;
+                    mqttLog("C", "", NULL);
+                } else {
+                    gMqttConnectFailCount--;
+                }
+                length = snprintf(pResponse, responseSize,
+                                  "\r\n+UMQTTC: 1,1\r\n\r\nOK\r\n"
+                                  "\r\n+UUMQTTC: 1,%d\r\n", success ? 0 : 2);
+                break;
+            case 2:
+                // Publish, e.g. 2,1,0,0,"topic","message": the
+                // message is between the third and fourth quotes
+                pStr = strchr(pLine, '"');
+                for (size_t x = 0; (x < 2) && (pStr != NULL); x++) {
+                    pStr = strchr(pStr + 1, '"');
+                }
+                if (pStr != NULL) {
+                    pStr++;
+                    pEnd = strchr(pStr, '"');
+                }
+                success = gMqttConnected && (pEnd != NULL);
+                if (success && (gMqttPublishFailCount > 0)) {
+                    gMqttPublishFailCount--;
+                    success = false;
+                }
+                if (success) {
+                    mqttLog("P:", pStr, pEnd);
+                }
+                length = snprintf(pResponse, responseSize,
+                                  "\r\n+UMQTTC: 2,%d\r\n\r\nOK\r\n", success);
+                break;
+            case 4:
+                // Subscribe, e.g. 4,1,"topic", where the URC gives
+                // the outcome, on SARA-R4 the first parameter
+                // being 0 to 2 for success
+                pStr = strchr(pLine, '"');
+                if (pStr != NULL) {
+                    pStr++;
+                    pEnd = strchr(pStr, '"');
+                }
+                if (gMqttConnected && (pEnd != NULL)) {
+                    mqttLog("S:", pStr, pEnd);
+                    length = snprintf(pResponse, responseSize,
+                                      "\r\n+UMQTTC: 4,1\r\n\r\nOK\r\n"
+                                      "\r\n+UUMQTTC: 4,1,1,\"%.*s\"\r\n",
+                                      (int) (pEnd - pStr), pStr);
+                } else {
+                    length = snprintf(pResponse, responseSize,
+                                      "\r\n+UMQTTC: 4,1\r\n\r\nOK\r\n"
+                                      "\r\n+UUMQTTC: 4,128,-1,\"\"\r\n");
+                }
+                break;
+            default:
+                length = snprintf(pResponse, responseSize,
+                                  "\r\n+UMQTTC: %d,1\r\n\r\nOK\r\n", opCode);
+                break;
+        }
+    }
+
+    return length;
+}
+
+// Put the ETag that the simulated module gives the resource at
+// the given path, which depends on the path and on
+// gHttpETagVersion, into pETag, returning false if there is none.
+static bool httpETag(const char *pPath, char *pETag, size_t size)
+{
+    uint32_t sum = 0;
+
+    for (const char *pStr = pPath; *pStr != 0; pStr++) {
+        sum += (uint8_t) *pStr;
+    }
+    snprintf(pETag, size, "\"%u-%d\"", (unsigned) sum, (int) gHttpETagVersion);
+
+    return (gHttpETagVersion >= 0);
+}
+
+// Command callback of the simulated module for the HTTP tests:
+// logs the path of each AT+UHTTPC request, answering it with
+// success, and serves a response file, of which the body is that
+// path, to AT+URDBLOCK; if gHttpETagVersion is not negative the
+// response carries an ETag and a request that was made with an
+// If-None-Match header of that ETag, set with AT+UHTTP, gets 304.
+static int32_t httpCommandCallback(const char *pLine, char *pResponse,
+                                   size_t responseSize, void *pParam)
+{
+    int32_t length = -1;
+    char file[U_PORT_SIM_MODEM_TEST_HTTP_LONG_PATH_LENGTH + 128];
+    char eTag[U_HTTP_CLIENT_ETAG_LENGTH_BYTES];
+    int32_t fileLength;
+    int32_t profileId;
+    int32_t command;
+    int32_t offset;
+    int32_t size;
+    const char *pStr;
+    const char *pEnd = NULL;
+
+    (void) pParam;
+
+    if ((strncmp(pLine, "+UHTTP=", 7) == 0) && (strstr(pLine, ",9,\"") != NULL)) {
+        // e.g. 0,9,"6:If-None-Match:"1234-0"" or 0,9,"6:" to clear
+        gHttpIfNoneMatch[0] = 0;
+        pStr = strstr(pLine, "If-None-Match:");
+        if (pStr != NULL) {
+            pStr += 14;
+            pEnd = strrchr(pStr, '"');
+            if (pEnd != NULL) {
+                snprintf(gHttpIfNoneMatch, sizeof(gHttpIfNoneMatch), "%.*s",
+                         (int) (pEnd - pStr), pStr);
+            }
+        }
+        length = snprintf(pResponse, responseSize, "\r\nOK\r\n");
+    } else if (strncmp(pLine, "+UHTTPC=", 8) == 0) {
+        // e.g. 0,1,"/path","ubxlibhttp_0"
+        profileId = atoi(pLine + 8);
+        pStr = strchr(pLine, ',');
+        command = (pStr != NULL) ? atoi(pStr + 1) : -1;
+        pStr = strchr(pLine, '"');
+        if (pStr != NULL) {
+            pStr++;
+            pEnd = strchr(pStr, '"');
+        }
+        if (pEnd != NULL) {
+            snprintf(gHttpPath, sizeof(gHttpPath), "%.*s", (int) (pEnd - pStr), pStr);
+            strncpy(gHttpRequestIfNoneMatch, gHttpIfNoneMatch, sizeof(gHttpRequestIfNoneMatch));
+            strncat(gHttpLog, gHttpPath, sizeof(gHttpLog) - strlen(gHttpLog) - 3);
+            if (gHttpRequestIfNoneMatch[0] != 0) {
+                strcat(gHttpLog, "*");
+            }
+            strcat(gHttpLog, " ");
+            if (gHttpDelayMs > 0) {
+                uPortTaskBlock(gHttpDelayMs);
+            }
+            length = snprintf(pResponse, responseSize,
+                              "\r\nOK\r\n\r\n+UUHTTPCR: %d,%d,1\r\n",
+                              (int) profileId, (int) command);
+        }
+    } else if (strncmp(pLine, "+URDBLOCK=", 10) == 0) {
+        // e.g. "ubxlibhttp_0",0,64
+        pStr = strchr(pLine, ',');
+        if (pStr != NULL) {
+            offset = atoi(pStr + 1);
+            pStr = strchr(pStr + 1, ',');
+            if (pStr != NULL) {
+                size = atoi(pStr + 1);
+                if (!httpETag(gHttpPath, eTag, sizeof(eTag))) {
+                    fileLength = snprintf(file, sizeof(file),
+                                          "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n%s",
+                                          (int) strlen(gHttpPath), gHttpPath);
+                } else if (strcmp(gHttpRequestIfNoneMatch, eTag) == 0) {
+                    fileLength = snprintf(file, sizeof(file),
+                                          "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n\r\n",
+                                          eTag);
+                } else {
+                    fileLength = snprintf(file, sizeof(file),
+                                          "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n"
+                                          "ETag: %s\r\n\r\n%s",
+                                          (int) strlen(gHttpPath), eTag, gHttpPath);
+                }
+                if (offset > fileLength) {
+                    offset = fileLength;
+                }
+                if (size > fileLength - offset) {
+                    size = fileLength - offset;
+                }
+                length = snprintf(pResponse, responseSize,
+                                  "\r\n+URDBLOCK: \"x\",%d,\"%.*s\"\r\n\r\nOK\r\n",
+                                  (int) size, (int) size, file + offset);
+            }
+        }
+    }
+
+    return length;
+}
+
+// Make a conditional HTTP GET request for the HTTP conditional
+// request test, clearing the log of requests first.
+static int32_t httpGetConditional(uHttpClientContext_t *pContext,
+                                  const char *pPath, char *pBody,
+                                  size_t bodySize, size_t *pSize)
+{
+    gHttpLog[0] = 0;
+    memset(pBody, 0, bodySize);
+    *pSize = bodySize;
+
+    return uHttpClientGetRequestConditional(pContext, pPath, pBody, pSize, NULL);
+}
+
+// Completion callback for the HTTP request queue test: the
+// parameter is the character to log for the request.
+static void httpQueueCallback(uDeviceHandle_t devHandle,
+                              int32_t statusCodeOrError,
+                              size_t responseSize, void *pParam)
+{
+    char c = (char) (intptr_t) pParam;
+
+    (void) devHandle;
+    (void) responseSize;
+
+    if ((c >= 'a') && (c < 'a' + U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS) &&
+        (gHttpDoneCount < sizeof(gHttpDone) - 1)) {
+        gHttpStatusCodeOrError[c - 'a'] = statusCodeOrError;
+        gHttpDone[gHttpDoneCount] = c;
+        gHttpDoneCount++;
+    }
+}
+
+// Command callback of the simulated module for the fast boot test:
+// keeps the sockets hex mode and GNSS profile settings.
+static int32_t fastBootCommandCallback(const char *pLine, char *pResponse,
+                                       size_t responseSize, void *pParam)
+{
+    int32_t length = -1;
+
+    (void) pParam;
+
+    if (strcmp(pLine, "+UDCONF=1") == 0) {
+        length = snprintf(pResponse, responseSize,
+                          "\r\n+UDCONF: 1,%d\r\n\r\nOK\r\n", (int) gFastBootHexMode);
+    } else if (strncmp(pLine, "+UDCONF=1,", 10) == 0) {
+        gFastBootHexMode = atoi(pLine + 10);
+        gFastBootWriteCount++;
+        length = snprintf(pResponse, responseSize, "\r\nOK\r\n");
+    } else if (strcmp(pLine, "+UGPRF?") == 0) {
+        length = snprintf(pResponse, responseSize,
+                          "\r\n+UGPRF: %d\r\n\r\nOK\r\n", (int) gFastBootGnssProfile);
+    } else if (strncmp(pLine, "+UGPRF=", 7) == 0) {
+        gFastBootGnssProfile = atoi(pLine + 7);
+        gFastBootWriteCount++;
+        length = snprintf(pResponse, responseSize, "\r\nOK\r\n");
+    }
+
+    return length;
+}
+
+// Command callback of the simulated module for the cached location
+// test: counts the requests for a CellLocate fix.
+static int32_t locCommandCallback(const char *pLine, char *pResponse,
+                                  size_t responseSize, void *pParam)
+{
+    (void) pResponse;
+    (void) responseSize;
+    (void) pParam;
+
+    if (strncmp(pLine, "+ULOC=", 6) == 0) {
+        gLocRequestCount++;
+    }
+
+    // Let the script, or the default "OK", answer
+    return -1;
+}
+
+// Connect callback for uSockConnectAsync(): stores the outcome
+// at pParameter.
+static void sockConnectCallback(uSockDescriptor_t descriptor,
+                                int32_t errorCode, void *pParameter)
+{
+    (void) descriptor;
+
+    *((volatile int32_t *) pParameter) = errorCode;
+}
+
+// Closed callback for u_sock: sets the bool at pParameter.
+static void sockClosedCallback(void *pParameter)
+{
+    *((volatile bool *) pParameter) = true;
+}
+
+#if U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES > 0
+// Data callback for the read aggregation test: counts the calls.
+static void sockDataCallback(void *pParameter)
+{
+    (*((volatile int32_t *) pParameter))++;
+}
+#endif
+
+// Command callback of the simulated module for the asynchronous
+// connect test: holds up AT+USOCO for a while.
+static int32_t sockConnectCommandCallback(const char *pLine, char *pResponse,
+                                          size_t responseSize, void *pParam)
+{
+    (void) pResponse;
+    (void) responseSize;
+    (void) pParam;
+
+    if (strncmp(pLine, "+USOCO=", 7) == 0) {
+        uPortTaskBlock(500);
+    }
+
+    // Let the simulated module answer
+    return -1;
+}
+
+// Command callback of the simulated module for the socket tests:
+// counts the AT+USORD reads that ask for data and the AT+USOWR
+// writes.
+static int32_t sockCommandCallback(const char *pLine, char *pResponse,
+                                   size_t responseSize, void *pParam)
+{
+    const char *pLength;
+
+    (void) pResponse;
+    (void) responseSize;
+    (void) pParam;
+
+    if (strncmp(pLine, "+USORD=", 7) == 0) {
+        pLength = strchr(pLine, ',');
+        if ((pLength != NULL) && (atoi(pLength + 1) > 0)) {
+            gSockReadCount++;
+        }
+    } else if (strncmp(pLine, "+USOWR=", 7) == 0) {
+        gSockWriteCount++;
+    }
+
+    // Let the simulated module answer
+    return -1;
+}
+
+// Command callback of the simulated module for the registration
+// test: counts the AT+CxREG? queries, answering "searching" until
+// the module has reported registration or has been asked to
+// deregister.
+static int32_t regCommandCallback(const char *pLine, char *pResponse,
+                                  size_t responseSize, void *pParam)
+{
+    int32_t length = -1;
+    const char *pQuery = NULL;
+    int32_t type = 0;
+
+    (void) pParam;
+
+    if (strcmp(pLine, "+CREG?") == 0) {
+        pQuery = "+CREG";
+        type = 2;
+    } else if (strcmp(pLine, "+CGREG?") == 0) {
+        pQuery = "+CGREG";
+        type = 2;
+    } else if (strcmp(pLine, "+CEREG?") == 0) {
+        pQuery = "+CEREG";
+        type = 4;
+    } else if (strcmp(pLine, "+CIMI") == 0) {
+        length = snprintf(pResponse, responseSize, "\r\n222107701772423\r\n\r\nOK\r\n");
+    } else if (strcmp(pLine, "+COPS?") == 0) {
+        length = snprintf(pResponse, responseSize, "\r\n+COPS: %d\r\n\r\nOK\r\n",
+                          gRegRegistered ? 0 : 2);
+    } else if ((strcmp(pLine, "+CFUN=0") == 0) || (strcmp(pLine, "+CFUN=4") == 0)) {
+        // Radio off, so deregistered
+        gRegRegistered = false;
+    } else if (strcmp(pLine, "+CGATT?") == 0) {
+        length = snprintf(pResponse, responseSize, "\r\n+CGATT: %d\r\n\r\nOK\r\n",
+                          gRegRegistered);
+    }
+    if (pQuery != NULL) {
+        gRegQueryCount++;
+        if (gRegRegistered) {
+            length = snprintf(pResponse, responseSize,
+                              "\r\n%s: %d,1,\"562c\",\"0370b003\",7\r\n\r\nOK\r\n",
+                              pQuery, (int) type);
+        } else {
+            length = snprintf(pResponse, responseSize,
+                              "\r\n%s: %d,2\r\n\r\nOK\r\n", pQuery, (int) type);
+        }
+    }
+
+    return length;
+}
+
+// Keep-going callback for the registration test: three seconds in,
+// has the simulated module report registration with a URC.
+static bool regKeepGoingCallback(uDeviceHandle_t cellHandle)
+{
+    const char *pUrc = "\r\n+CEREG: 1,\"562c\",\"0370b003\",7\r\n";
+
+    (void) cellHandle;
+
+    if (!gRegRegistered && (uPortGetTickTimeMs() - gRegStartTimeMs > 3000)) {
+        gRegRegistered = true;
+        uPortSimModemSend(gpRegDeviceSerial, pUrc, strlen(pUrc));
+    }
+
+    return (uPortGetTickTimeMs() - gRegStartTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS);
+}
+
+// Call uCellLocGetCached() until it returns something other than
+// "busy", or the given time has passed.
+static int32_t locGetCachedWait(uDeviceHandle_t cellHandle,
+                                int32_t *pLatitudeX1e7, int32_t *pLongitudeX1e7,
+                                int32_t waitMs)
+{
+    int32_t errorCode;
+    int32_t startTimeMs = uPortGetTickTimeMs();
+
+    do {
+        uPortTaskBlock(100);
+        errorCode = uCellLocGetCached(cellHandle, pLatitudeX1e7, pLongitudeX1e7,
+                                      NULL, NULL, NULL, NULL, NULL);
+    } while ((errorCode == (int32_t) U_ERROR_COMMON_BUSY) &&
+             (uPortGetTickTimeMs() - startTimeMs < waitMs));
+
+    return errorCode;
+}
+
+// Reconnect callback for the MQTT session test.
+static void mqttReconnectCallback(int32_t attempts, void *pParam)
+{
+    (void) pParam;
+
+    gMqttReconnectAttempts = attempts;
+    gMqttReconnectCount++;
+}
+
+// Callback for the MQTT asynchronous publish test: the parameter
+// is the index of the message.
+static void mqttPublishAsyncCallback(uDeviceHandle_t cellHandle,
+                                     int32_t handle, int32_t errorCode,
+                                     void *pParam)
+{
+    intptr_t x = (intptr_t) pParam;
+
+    (void) cellHandle;
+
+    if ((x >= 0) && (x < U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC) &&
+        (gMqttAsyncDoneCount < sizeof(gMqttAsyncDone) - 1)) {
+        gMqttAsyncHandle[x] = handle;
+        gMqttAsyncErrorCode[x] = errorCode;
+        gMqttAsyncDone[gMqttAsyncDoneCount] = (char) ('0' + x);
+        gMqttAsyncDoneCount++;
+    }
+}
+
+// Disconnect callback for the MQTT session test.
+static void mqttDisconnectCallback(int32_t errorCode, void *pParam)
+{
+    (void) errorCode;
+    (void) pParam;
+
+    gMqttDisconnectCount++;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Run the cellular socket API over the simulated module, through
+ * echo servers on the local host.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSock")
+{
+    uPortSimModemTestModule_t *pModule;
+    uDeviceSerial_t *pDeviceSerial;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uAtClientHandle_t atHandle;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    int32_t sockHandle;
+    int32_t received;
+    int32_t x;
+    int32_t startTimeMs;
+    char version[16];
+
+    preamble(&gHandles, true);
+    cfg.pScript = gScript;
+    cfg.scriptLength = sizeof(gScript) / sizeof(gScript[0]);
+    cfg.responseDelayMs = U_PORT_SIM_MODEM_TEST_RESPONSE_DELAY_MS;
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5);
+    cellHandle = pModule->cellHandle;
+    atHandle = pModule->atHandle;
+    pDeviceSerial = pModule->pDeviceSerial;
+
+    // Check the script and the response delay
+    startTimeMs = uPortGetTickTimeMs();
+    memset(version, 0, sizeof(version));
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+CGMR");
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, NULL);
+    uAtClientReadString(atHandle, version, sizeof(version), false);
+    uAtClientResponseStop(atHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atHandle) == 0);
+    x = uPortGetTickTimeMs() - startTimeMs;
+    U_TEST_PRINT_LINE("AT+CGMR returned \"%s\" after %d ms.", version, x);
+    U_PORT_TEST_ASSERT(strcmp(version, "XX.YY") == 0);
+    U_PORT_TEST_ASSERT(x >= U_PORT_SIM_MODEM_TEST_RESPONSE_DELAY_MS);
+    U_PORT_TEST_ASSERT(uPortSimModemUnknownGet(pDeviceSerial) == 0);
+
+    U_PORT_TEST_ASSERT(uCellSockInit() == 0);
+    U_PORT_TEST_ASSERT(uCellSockInitInstance(cellHandle) == 0);
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+
+    // TCP
+    sockHandle = uCellSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(sockHandle >= 0);
+    address.port = (uint16_t) gHandles.tcpPort;
+    U_PORT_TEST_ASSERT(uCellSockConnect(cellHandle, sockHandle, &address) == 0);
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellSockWrite(cellHandle, sockHandle, gData,
+                                      sizeof(gData)) == sizeof(gData));
+    received = 0;
+    while ((received < (int32_t) sizeof(gData)) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        x = uCellSockRead(cellHandle, sockHandle, gBuffer + received,
+                          sizeof(gBuffer) - received);
+        if (x > 0) {
+            received += x;
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+    U_TEST_PRINT_LINE("%d byte(s) of TCP echoed in %d ms.", received,
+                      uPortGetTickTimeMs() - startTimeMs);
+    U_PORT_TEST_ASSERT(received == sizeof(gData));
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, sizeof(gData)) == 0);
+    U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, sockHandle, NULL) == 0);
+
+    // UDP
+    sockHandle = uCellSockCreate(cellHandle, U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(sockHandle >= 0);
+    address.port = (uint16_t) gHandles.udpPort;
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellSockSendTo(cellHandle, sockHandle, &address,
+                                       gData, 100) == 100);
+    received = 0;
+    while ((received == 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        x = uCellSockReceiveFrom(cellHandle, sockHandle, NULL, gBuffer, sizeof(gBuffer));
+        if (x > 0) {
+            received = x;
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+    U_TEST_PRINT_LINE("%d byte(s) of UDP echoed in %d ms.", received,
+                      uPortGetTickTimeMs() - startTimeMs);
+    U_PORT_TEST_ASSERT(received == 100);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 100) == 0);
+    U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, sockHandle, NULL) == 0);
+
+    postamble(&gHandles);
+}
+
+/** Move a socket between two simulated modules with uSockMove()
+ * and through failover, checking that the echo carries on.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockMove")
+{
+    uDeviceHandle_t cellHandle[2];
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+
+    preamble(&gHandles, true);
+    for (size_t x = 0; x < sizeof(cellHandle) / sizeof(cellHandle[0]); x++) {
+        cellHandle[x] = pModuleAdd(&gHandles, NULL, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+    }
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+
+    // Parameter checks
+    U_PORT_TEST_ASSERT(uSockMove(-1, cellHandle[1]) < 0);
+    U_PORT_TEST_ASSERT(uSockFailoverSet(-1, cellHandle[1]) < 0);
+
+    // TCP: connect on the first module, move to the second
+    descriptor = uSockCreate(cellHandle[0], U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    address.port = (uint16_t) gHandles.tcpPort;
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+    U_PORT_TEST_ASSERT(sockEcho(descriptor, sizeof(gData)));
+    U_PORT_TEST_ASSERT(uSockMove(descriptor, NULL) < 0);
+    U_PORT_TEST_ASSERT(uSockMove(descriptor, cellHandle[1]) == 0);
+    U_PORT_TEST_ASSERT(sockEcho(descriptor, sizeof(gData)));
+
+    // Fail over back to the first module
+    U_PORT_TEST_ASSERT(uSockFailoverSet(descriptor, cellHandle[0]) == 0);
+    uSockFailoverTrigger(cellHandle[1]);
+    U_PORT_TEST_ASSERT(sockEcho(descriptor, sizeof(gData)));
+    // ...and a second loss takes it back again
+    uSockFailoverTrigger(cellHandle[0]);
+    U_PORT_TEST_ASSERT(sockEcho(descriptor, 100));
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    // UDP: the remote address is kept across the move
+    descriptor = uSockCreate(cellHandle[0], U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    address.port = (uint16_t) gHandles.udpPort;
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+    U_PORT_TEST_ASSERT(uSockMove(descriptor, cellHandle[1]) == 0);
+    U_PORT_TEST_ASSERT(uSockSendTo(descriptor, NULL, gData, 100) == 100);
+    memset(gBuffer, 0, sizeof(gBuffer));
+    U_PORT_TEST_ASSERT(uSockReceiveFrom(descriptor, NULL, gBuffer, sizeof(gBuffer)) == 100);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 100) == 0);
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    postamble(&gHandles);
+}
+
+/** Serve DNS requests over a UDP socket of the simulated module
+ * with uDnsServerProcess(), a POSIX UDP socket on the local host
+ * playing the part of the client: a lookup must be answered with
+ * the given address, a bad request with an error and, with nothing
+ * waiting, uDnsServerProcess() must return at once.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemDnsServer")
+{
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+    // A lookup of "example.com", ID 0x1234
+    static const uint8_t query[] = {0x12, 0x34, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00,
+                                    0x00, 0x00, 0x00, 0x00,
+                                    7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0,
+                                    0x00, 0x01, 0x00, 0x01
+                                   };
+    static const uint8_t answerAddress[] = {192, 168, 1, 2};
+    uint8_t buffer[64];
+    struct sockaddr_in simAddress;
+    socklen_t simAddressLength = sizeof(simAddress);
+    struct pollfd pollFd;
+    int clientFd = -1;
+    int32_t clientPort;
+    int32_t numAnswered = 0;
+    int32_t startTimeMs;
+    int32_t x;
+
+    preamble(&gHandles, false);
+    clientPort = echoSocketOpen(SOCK_DGRAM, &clientFd);
+    U_PORT_TEST_ASSERT(clientPort > 0);
+    pollFd.fd = clientFd;
+    pollFd.events = POLLIN;
+    cellHandle = pModuleAdd(&gHandles, NULL, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    uSockBlockingSet(descriptor, false);
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uDnsServerProcess(-1, "192.168.1.2") < 0);
+    U_PORT_TEST_ASSERT(uDnsServerProcess(descriptor, NULL) < 0);
+    U_PORT_TEST_ASSERT(uDnsServerProcess(descriptor, "not an address") < 0);
+
+    // Nothing waiting
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uDnsServerProcess(descriptor, "192.168.1.2") == 0);
+    U_PORT_TEST_ASSERT(uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS / 10);
+
+    // Send something to the client so that it knows where the
+    // simulated module's socket is
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+    address.port = (uint16_t) clientPort;
+    U_PORT_TEST_ASSERT(uSockSendTo(descriptor, &address, "hello", 5) == 5);
+    U_PORT_TEST_ASSERT(poll(&pollFd, 1, U_PORT_SIM_MODEM_TEST_TIMEOUT_MS) == 1);
+    U_PORT_TEST_ASSERT(recvfrom(clientFd, buffer, sizeof(buffer), 0,
+                                (struct sockaddr *) &simAddress, &simAddressLength) == 5);
+
+    // Now a lookup followed by a response, which is not a request
+    U_PORT_TEST_ASSERT(sendto(clientFd, query, sizeof(query), 0,
+                              (struct sockaddr *) &simAddress,
+                              simAddressLength) == sizeof(query));
+    memcpy(buffer, query, sizeof(query));
+    buffer[2] |= 0x80;
+    U_PORT_TEST_ASSERT(sendto(clientFd, buffer, sizeof(query), 0,
+                              (struct sockaddr *) &simAddress,
+                              simAddressLength) == sizeof(query));
+    startTimeMs = uPortGetTickTimeMs();
+    while ((numAnswered < 2) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        x = uDnsServerProcess(descriptor, "192.168.1.2");
+        U_PORT_TEST_ASSERT(x >= 0);
+        numAnswered += x;
+        uPortTaskBlock(10);
+    }
+    U_TEST_PRINT_LINE("%d DNS request(s) answered.", numAnswered);
+    U_PORT_TEST_ASSERT(numAnswered == 2);
+
+    // The lookup is answered with the address, the last four bytes
+    U_PORT_TEST_ASSERT(poll(&pollFd, 1, U_PORT_SIM_MODEM_TEST_TIMEOUT_MS) == 1);
+    x = (int32_t) recv(clientFd, buffer, sizeof(buffer), 0);
+    U_PORT_TEST_ASSERT(x == sizeof(query) + 16);
+    U_PORT_TEST_ASSERT((buffer[0] == 0x12) && (buffer[1] == 0x34));
+    U_PORT_TEST_ASSERT((buffer[2] & 0x80) != 0);
+    U_PORT_TEST_ASSERT((buffer[6] == 0) && (buffer[7] == 1));
+    U_PORT_TEST_ASSERT(memcmp(buffer + x - sizeof(answerAddress), answerAddress,
+                              sizeof(answerAddress)) == 0);
+    // The response gets a format error, just a header
+    U_PORT_TEST_ASSERT(poll(&pollFd, 1, U_PORT_SIM_MODEM_TEST_TIMEOUT_MS) == 1);
+    x = (int32_t) recv(clientFd, buffer, sizeof(buffer), 0);
+    U_PORT_TEST_ASSERT(x == 12);
+    U_PORT_TEST_ASSERT((buffer[3] & 0x0f) == 1);
+
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+    close(clientFd);
+
+    postamble(&gHandles);
+}
+
+/** Coalesce small writes on a TCP socket and check that they are
+ * sent together, by the flush task when
+ * #U_SOCK_WRITE_COALESCE_TIME_MS expires and by uSockFlush(), and
+ * that deinitialising with data still held back doesn't hang.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockCoalesce")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+    int32_t noDelay;
+    int32_t received = 0;
+    int32_t x;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pCommandCallback = sockCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+    address.port = (uint16_t) gHandles.tcpPort;
+
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+    noDelay = 0;
+    U_PORT_TEST_ASSERT(uSockOptionSet(descriptor, U_SOCK_OPT_LEVEL_TCP,
+                                      U_SOCK_OPT_TCP_NODELAY, &noDelay,
+                                      sizeof(noDelay)) == 0);
+
+    // Small writes are held back until the timer goes off
+    gSockWriteCount = 0;
+    for (size_t y = 0; y < 3; y++) {
+        U_PORT_TEST_ASSERT(uSockWrite(descriptor, gData + (y * 10), 10) == 10);
+    }
+    U_PORT_TEST_ASSERT(gSockWriteCount == 0);
+    uPortTaskBlock(U_SOCK_WRITE_COALESCE_TIME_MS * 5);
+    U_TEST_PRINT_LINE("%d AT+USOWR write(s) after the coalescing time.",
+                      gSockWriteCount);
+    U_PORT_TEST_ASSERT(gSockWriteCount == 1);
+
+    // ...or until they are flushed
+    U_PORT_TEST_ASSERT(uSockWrite(descriptor, gData + 30, 10) == 10);
+    U_PORT_TEST_ASSERT(gSockWriteCount == 1);
+    U_PORT_TEST_ASSERT(uSockFlush(descriptor) == 0);
+    U_PORT_TEST_ASSERT(gSockWriteCount == 2);
+
+    // Everything should come back in order
+    memset(gBuffer, 0, sizeof(gBuffer));
+    startTimeMs = uPortGetTickTimeMs();
+    while ((received < 40) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        x = uSockRead(descriptor, gBuffer + received, 40 - received);
+        if (x > 0) {
+            received += x;
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+    U_PORT_TEST_ASSERT(received == 40);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 40) == 0);
+
+    // Leave something in the buffer and deinitialise as the
+    // timer is about to go off: this must not hang
+    U_PORT_TEST_ASSERT(uSockWrite(descriptor, gData, 10) == 10);
+    uPortTaskBlock(U_SOCK_WRITE_COALESCE_TIME_MS);
+
+    postamble(&gHandles);
+}
+
+/** Check the statistics that uSockStatsGet() returns for TCP and
+ * for UDP.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockStats")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+    uSockStats_t stats;
+    int32_t received;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pCommandCallback = sockCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+
+    // TCP
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    address.port = (uint16_t) gHandles.tcpPort;
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+    U_PORT_TEST_ASSERT(sockEcho(descriptor, 100));
+    memset(&stats, 0xff, sizeof(stats));
+    U_PORT_TEST_ASSERT(uSockStatsGet(descriptor, &stats) == 0);
+    U_TEST_PRINT_LINE("TCP: %d byte(s) sent in %d write(s), %d received in %d"
+                      " read(s), %d underlying.", stats.bytesSent,
+                      stats.numUnderlyingWrites, stats.bytesReceived,
+                      stats.numReads, stats.numUnderlyingReads);
+    U_PORT_TEST_ASSERT(stats.bytesSent == 100);
+    U_PORT_TEST_ASSERT(stats.bytesSent == uSockGetTotalBytesSent(descriptor));
+    U_PORT_TEST_ASSERT(stats.numUnderlyingWrites == 1);
+    U_PORT_TEST_ASSERT(stats.numWriteRetries == 0);
+    U_PORT_TEST_ASSERT(stats.bytesReceived == 100);
+    U_PORT_TEST_ASSERT(stats.numReads > 0);
+    U_PORT_TEST_ASSERT(stats.numUnderlyingReads >= stats.numReads);
+    U_PORT_TEST_ASSERT(stats.readLatencyMeanMs >= 0);
+    U_PORT_TEST_ASSERT(stats.readLatencyMaxMs >= stats.readLatencyMeanMs);
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uSockStatsGet(descriptor, NULL) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+    U_PORT_TEST_ASSERT(uSockStatsGet(U_SOCK_MAX_NUM_SOCKETS, &stats) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EBADF);
+    errno = 0;
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    // UDP, with uSockSendTo() on a socket that is not connected
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    address.port = (uint16_t) gHandles.udpPort;
+    U_PORT_TEST_ASSERT(uSockSendTo(descriptor, &address, gData, 50) == 50);
+    memset(gBuffer, 0, sizeof(gBuffer));
+    received = -1;
+    startTimeMs = uPortGetTickTimeMs();
+    while ((received <= 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        received = uSockReceiveFrom(descriptor, NULL, gBuffer, sizeof(gBuffer));
+    }
+    U_PORT_TEST_ASSERT(received == 50);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 50) == 0);
+    memset(&stats, 0xff, sizeof(stats));
+    U_PORT_TEST_ASSERT(uSockStatsGet(descriptor, &stats) == 0);
+    U_TEST_PRINT_LINE("UDP: %d byte(s) sent in %d write(s), %d received in %d"
+                      " read(s), %d underlying.", stats.bytesSent,
+                      stats.numUnderlyingWrites, stats.bytesReceived,
+                      stats.numReads, stats.numUnderlyingReads);
+    U_PORT_TEST_ASSERT(stats.bytesSent == 50);
+    U_PORT_TEST_ASSERT(stats.numUnderlyingWrites == 1);
+    U_PORT_TEST_ASSERT(stats.numWriteRetries == 0);
+    U_PORT_TEST_ASSERT(stats.bytesReceived == 50);
+    U_PORT_TEST_ASSERT(stats.numReads == 1);
+    U_PORT_TEST_ASSERT(stats.numUnderlyingReads >= 1);
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    postamble(&gHandles);
+}
+
+/** Check the parameters of uSockDirectLinkEnter()/uSockDirectLinkExit()
+ * and of uCellSockDirectLinkEnter()/uCellSockDirectLinkExit(), and
+ * that, CMUX not being enabled, direct link mode is refused while
+ * leaving the socket working as before.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockDirectLink")
+{
+    uDeviceSerial_t *pDirectLink = NULL;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+    uSockDescriptor_t udpDescriptor;
+
+    preamble(&gHandles, true);
+    cfg.pCommandCallback = sockCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    address.port = (uint16_t) gHandles.tcpPort;
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+    udpDescriptor = uSockCreate(cellHandle, U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(udpDescriptor >= 0);
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uSockDirectLinkEnter(-1, &pDirectLink) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EBADF);
+    U_PORT_TEST_ASSERT(uSockDirectLinkEnter(U_SOCK_MAX_NUM_SOCKETS, &pDirectLink) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EBADF);
+    U_PORT_TEST_ASSERT(uSockDirectLinkEnter(descriptor, NULL) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+    U_PORT_TEST_ASSERT(uSockDirectLinkExit(-1) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EBADF);
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkEnter(NULL, 0, &pDirectLink) == -U_SOCK_EINVAL);
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkEnter(cellHandle, -1, &pDirectLink) == -U_SOCK_EINVAL);
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkExit(NULL, 0) == -U_SOCK_EINVAL);
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkExit(cellHandle, -1) == -U_SOCK_EINVAL);
+    // Only a TCP socket may use direct link mode
+    U_PORT_TEST_ASSERT(uSockDirectLinkEnter(udpDescriptor, &pDirectLink) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EOPNOTSUPP);
+    // Without CMUX there is no channel to give it
+    U_PORT_TEST_ASSERT(uSockDirectLinkEnter(descriptor, &pDirectLink) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EOPNOTSUPP);
+    U_PORT_TEST_ASSERT(pDirectLink == NULL);
+    errno = 0;
+
+    // Leaving direct link mode when not in it does nothing and
+    // the socket carries on working over AT commands
+    U_PORT_TEST_ASSERT(uSockDirectLinkExit(descriptor) == 0);
+    U_PORT_TEST_ASSERT(uSockDirectLinkExit(udpDescriptor) == 0);
+    U_PORT_TEST_ASSERT(sockEcho(descriptor, 100));
+
+    U_PORT_TEST_ASSERT(uSockClose(udpDescriptor) == 0);
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    postamble(&gHandles);
+}
+
+/** Send and receive with uSockWritev() and uSockReadv() over TCP
+ * and UDP, checking that on UDP a vector is one datagram.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockVector")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+    uSockIoVec_t ioVec[3];
+    size_t length;
+    int32_t received = 0;
+    int32_t x;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pCommandCallback = sockCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+
+    // TCP: a header and payload gathered, read back scattered
+    // across three buffers
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    address.port = (uint16_t) gHandles.tcpPort;
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+    ioVec[0].pData = gData;
+    ioVec[0].dataSizeBytes = 10;
+    ioVec[1].pData = NULL;
+    ioVec[1].dataSizeBytes = 0;
+    ioVec[2].pData = gData + 10;
+    ioVec[2].dataSizeBytes = 290;
+    U_PORT_TEST_ASSERT(uSockWritev(descriptor, ioVec, 3) == 300);
+    memset(gBuffer, 0, sizeof(gBuffer));
+    startTimeMs = uPortGetTickTimeMs();
+    while ((received < 300) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        // Uneven pieces, the vector covering the rest
+        length = 300 - received;
+        ioVec[0].pData = gBuffer + received;
+        ioVec[0].dataSizeBytes = (length < 7) ? length : 7;
+        ioVec[1].pData = NULL;
+        ioVec[1].dataSizeBytes = 0;
+        ioVec[2].pData = gBuffer + received + ioVec[0].dataSizeBytes;
+        ioVec[2].dataSizeBytes = length - ioVec[0].dataSizeBytes;
+        x = uSockReadv(descriptor, ioVec, 3);
+        if (x > 0) {
+            received += x;
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+    U_TEST_PRINT_LINE("%d byte(s) of TCP echoed with uSockWritev()/uSockReadv().",
+                      received);
+    U_PORT_TEST_ASSERT(received == 300);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 300) == 0);
+    // A bad vector
+    ioVec[0].pData = NULL;
+    ioVec[0].dataSizeBytes = 1;
+    U_PORT_TEST_ASSERT(uSockWritev(descriptor, ioVec, 1) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+    U_PORT_TEST_ASSERT(uSockReadv(descriptor, ioVec, 1) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+    errno = 0;
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    // UDP: two buffers go as one datagram, which is then read
+    // back scattered across three buffers in one go, the
+    // second datagram landing only in the next read
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    address.port = (uint16_t) gHandles.udpPort;
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+    ioVec[0].pData = gData;
+    ioVec[0].dataSizeBytes = 20;
+    ioVec[1].pData = gData + 20;
+    ioVec[1].dataSizeBytes = 80;
+    U_PORT_TEST_ASSERT(uSockWritev(descriptor, ioVec, 2) == 100);
+    U_PORT_TEST_ASSERT(uSockWrite(descriptor, gData + 100, 50) == 50);
+    uPortTaskBlock(500);
+    memset(gBuffer, 0, sizeof(gBuffer));
+    ioVec[0].pData = gBuffer;
+    ioVec[0].dataSizeBytes = 30;
+    ioVec[1].pData = gBuffer + 30;
+    ioVec[1].dataSizeBytes = 50;
+    ioVec[2].pData = gBuffer + 80;
+    ioVec[2].dataSizeBytes = 100;
+    received = -1;
+    startTimeMs = uPortGetTickTimeMs();
+    while ((received <= 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        received = uSockReadv(descriptor, ioVec, 3);
+    }
+    U_TEST_PRINT_LINE("%d byte(s) in the first UDP datagram.", received);
+    U_PORT_TEST_ASSERT(received == 100);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 100) == 0);
+    memset(gBuffer, 0, sizeof(gBuffer));
+    received = -1;
+    startTimeMs = uPortGetTickTimeMs();
+    while ((received <= 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        received = uSockReadv(descriptor, ioVec, 3);
+    }
+    U_TEST_PRINT_LINE("%d byte(s) in the second UDP datagram.", received);
+    U_PORT_TEST_ASSERT(received == 50);
+    U_PORT_TEST_ASSERT(memcmp(gData + 100, gBuffer, 50) == 0);
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    postamble(&gHandles);
+}
+
+/** Read a TCP socket that has a #U_SOCK_OPT_RCVBUF receive buffer
+ * in TLS-header-sized pieces and check that most of the reads are
+ * served from the buffer rather than from the module.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockRxBuffer")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+    int32_t rxBufferSize = 1024;
+    size_t length;
+    int32_t received = 0;
+    int32_t x;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pCommandCallback = sockCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+    address.port = (uint16_t) gHandles.tcpPort;
+
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    U_PORT_TEST_ASSERT(uSockOptionSet(descriptor, U_SOCK_OPT_LEVEL_SOCK,
+                                      U_SOCK_OPT_RCVBUF, &rxBufferSize,
+                                      sizeof(rxBufferSize)) == 0);
+    rxBufferSize = 0;
+    length = sizeof(rxBufferSize);
+    U_PORT_TEST_ASSERT(uSockOptionGet(descriptor, U_SOCK_OPT_LEVEL_SOCK,
+                                      U_SOCK_OPT_RCVBUF, &rxBufferSize,
+                                      &length) == 0);
+    U_PORT_TEST_ASSERT((length == sizeof(rxBufferSize)) && (rxBufferSize == 1024));
+    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &address) == 0);
+
+    // Send it all and let the echo come back before reading
+    U_PORT_TEST_ASSERT(uSockWrite(descriptor, gData, 1000) == 1000);
+    uPortTaskBlock(500);
+    gSockReadCount = 0;
+    memset(gBuffer, 0, sizeof(gBuffer));
+    startTimeMs = uPortGetTickTimeMs();
+    while ((received < 1000) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        x = uSockRead(descriptor, gBuffer + received, 5);
+        if (x > 0) {
+            U_PORT_TEST_ASSERT(x <= 5);
+            received += x;
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+    U_TEST_PRINT_LINE("%d byte(s) read in 5 byte pieces with %d AT+USORD read(s).",
+                      received, gSockReadCount);
+    U_PORT_TEST_ASSERT(received == 1000);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 1000) == 0);
+    // 200 reads of the socket should need only a handful of
+    // reads from the module; with read aggregation they may
+    // all have been done before we started reading
+#if U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES == 0
+    U_PORT_TEST_ASSERT(gSockReadCount > 0);
+#endif
+    U_PORT_TEST_ASSERT(gSockReadCount < 10);
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+
+    postamble(&gHandles);
+}
+
+#if U_CELL_SOCK_READ_AGGREGATION_BUFFER_SIZE_BYTES > 0
+/** Have data arrive on two TCP sockets at once and check that it
+ * has all been read from the module, by readAggregateCallback(),
+ * before the data callbacks are called, so that the application's
+ * reads need nothing more from the module.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockReadAggregation")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor[2];
+    volatile int32_t dataCallbackCount[2] = {0};
+    size_t length = 500;
+    int32_t received;
+    int32_t x;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pCommandCallback = sockCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+    address.port = (uint16_t) gHandles.tcpPort;
+
+    for (size_t y = 0; y < sizeof(descriptor) / sizeof(descriptor[0]); y++) {
+        descriptor[y] = uSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+        U_PORT_TEST_ASSERT(descriptor[y] >= 0);
+        U_PORT_TEST_ASSERT(uSockConnect(descriptor[y], &address) == 0);
+        uSockRegisterCallbackData(descriptor[y], sockDataCallback,
+                                  (void *) &(dataCallbackCount[y]));
+    }
+
+    // Send data on both sockets and let the echoes come back
+    gSockReadCount = 0;
+    for (size_t y = 0; y < sizeof(descriptor) / sizeof(descriptor[0]); y++) {
+        U_PORT_TEST_ASSERT(uSockWrite(descriptor[y], gData + y,
+                                      length) == (int32_t) length);
+    }
+    startTimeMs = uPortGetTickTimeMs();
+    while (((dataCallbackCount[0] == 0) || (dataCallbackCount[1] == 0)) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+    // Give any stragglers time to arrive
+    uPortTaskBlock(500);
+    U_TEST_PRINT_LINE("%d and %d data callback(s), %d AT+USORD read(s) before"
+                      " any uSockRead().", dataCallbackCount[0],
+                      dataCallbackCount[1], gSockReadCount);
+    U_PORT_TEST_ASSERT(dataCallbackCount[0] > 0);
+    U_PORT_TEST_ASSERT(dataCallbackCount[1] > 0);
+    // The data has been read from the module for both sockets
+    U_PORT_TEST_ASSERT(gSockReadCount >= 2);
+
+    // Reading it now should take nothing more from the module
+    gSockReadCount = 0;
+    for (size_t y = 0; y < sizeof(descriptor) / sizeof(descriptor[0]); y++) {
+        received = 0;
+        memset(gBuffer, 0, sizeof(gBuffer));
+        startTimeMs = uPortGetTickTimeMs();
+        while ((received < (int32_t) length) &&
+               (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+            x = uSockRead(descriptor[y], gBuffer + received, length - received);
+            if (x > 0) {
+                received += x;
+            } else {
+                uPortTaskBlock(10);
+            }
+        }
+        U_PORT_TEST_ASSERT(received == (int32_t) length);
+        U_PORT_TEST_ASSERT(memcmp(gData + y, gBuffer, length) == 0);
+    }
+    U_TEST_PRINT_LINE("%d AT+USORD read(s) during uSockRead().", gSockReadCount);
+    U_PORT_TEST_ASSERT(gSockReadCount == 0);
+
+    for (size_t y = 0; y < sizeof(descriptor) / sizeof(descriptor[0]); y++) {
+        U_PORT_TEST_ASSERT(uSockClose(descriptor[y]) == 0);
+    }
+
+    postamble(&gHandles);
+}
+#endif
+
+/** Connect with uSockConnectAsync() on a simulated module that is
+ * slow to respond, registering a closed callback while the
+ * connection is in progress, and check that the socket works and
+ * that the callback is called when it is closed.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemSockConnectAsync")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    uSockDescriptor_t descriptor;
+    uSockDescriptorSet_t writeSet;
+    volatile int32_t connectResult = 1;
+    volatile bool closed = false;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pCommandCallback = sockConnectCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+    address.port = (uint16_t) gHandles.tcpPort;
+
+    descriptor = uSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+
+    // The module is slow to connect, see
+    // sockConnectCommandCallback(), so the connection stays in
+    // progress for long enough to poke at it
+    U_PORT_TEST_ASSERT(uSockConnectAsync(descriptor, &address, sockConnectCallback,
+                                         (void *) &connectResult) == 0);
+    U_PORT_TEST_ASSERT(uSockConnectAsync(descriptor, &address, NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EALREADY);
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) < 0);
+    U_PORT_TEST_ASSERT(errno == U_SOCK_EBUSY);
+    errno = 0;
+    uSockRegisterCallbackClosed(descriptor, sockClosedCallback, (void *) &closed);
+    U_PORT_TEST_ASSERT(connectResult == 1);
+
+    // Wait for the socket to become writable
+    U_SOCK_FD_ZERO(&writeSet);
+    U_SOCK_FD_SET(descriptor, &writeSet);
+    U_PORT_TEST_ASSERT(uSockSelect(descriptor + 1, NULL, &writeSet, NULL,
+                                   U_PORT_SIM_MODEM_TEST_TIMEOUT_MS) == 1);
+    startTimeMs = uPortGetTickTimeMs();
+    while ((connectResult == 1) && (uPortGetTickTimeMs() - startTimeMs < 1000)) {
+        uPortTaskBlock(10);
+    }
+    U_PORT_TEST_ASSERT(connectResult == 0);
+    U_PORT_TEST_ASSERT(sockEcho(descriptor, 100));
+    U_PORT_TEST_ASSERT(!closed);
+
+    // Have the module close the socket: the callback registered
+    // while connecting should be called
+    U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+    startTimeMs = uPortGetTickTimeMs();
+    while (!closed && (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+    U_PORT_TEST_ASSERT(closed);
+
+    postamble(&gHandles);
+}
+
+/** Defer operations with uCellPwrDefer() on a simulated module
+ * that reports 3GPP power saving as agreed with the network.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemPwrDefer")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    bool onNotOff = false;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t startTimeMs;
+    int32_t x;
+
+    preamble(&gHandles, false);
+    cfg.pScript = gScriptPsm;
+    cfg.scriptLength = sizeof(gScriptPsm) / sizeof(gScriptPsm[0]);
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+    gDeferCount = 0;
+
+    // Check parameters
+    U_PORT_TEST_ASSERT(uCellPwrDefer(NULL, deferOperation, NULL, 0) < 0);
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, NULL, NULL, 0) < 0);
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, NULL, -1) < 0);
+    U_PORT_TEST_ASSERT(uCellPwrDeferFlush(NULL) < 0);
+    U_PORT_TEST_ASSERT(uCellPwrDeferCancel(NULL, NULL, NULL) < 0);
+
+    // With 3GPP power saving not agreed there's no point
+    // in waiting, the operation should be run straight away
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &a, 60000) == 0);
+    U_PORT_TEST_ASSERT(deferWait(1, U_PORT_SIM_MODEM_TEST_TIMEOUT_MS));
+    U_PORT_TEST_ASSERT(gpDeferParameter == &a);
+
+    // Now have 3GPP power saving agreed: operations should wait
+    U_PORT_TEST_ASSERT(uCellPwrGet3gppPowerSaving(cellHandle, &onNotOff, NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(onNotOff);
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &a, 60000) == 0);
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &b, 60000) == 0);
+    uPortTaskBlock(1000);
+    U_PORT_TEST_ASSERT(gDeferCount == 1);
+    // Cancel one of them and flush the other
+    U_PORT_TEST_ASSERT(uCellPwrDeferCancel(cellHandle, deferOperation, &b) == 1);
+    U_PORT_TEST_ASSERT(uCellPwrDeferFlush(cellHandle) == 1);
+    U_PORT_TEST_ASSERT(deferWait(2, U_PORT_SIM_MODEM_TEST_TIMEOUT_MS));
+    U_PORT_TEST_ASSERT(gpDeferParameter == &a);
+    U_PORT_TEST_ASSERT(uCellPwrDeferFlush(cellHandle) == 0);
+
+    // An operation with a short deadline should take the one
+    // with a long deadline with it
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &a, 60000) == 0);
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &b, 500) == 0);
+    U_PORT_TEST_ASSERT(deferWait(4, U_PORT_SIM_MODEM_TEST_TIMEOUT_MS));
+    x = uPortGetTickTimeMs() - startTimeMs;
+    U_TEST_PRINT_LINE("two deferred operations were run after %d ms.", x);
+    U_PORT_TEST_ASSERT(x >= 500);
+    // The earliest deadline is run first
+    U_PORT_TEST_ASSERT(gpDeferParameter == &a);
+
+    // A zero deadline means now
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &b, 60000) == 0);
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &a, 0) == 0);
+    U_PORT_TEST_ASSERT(deferWait(6, U_PORT_SIM_MODEM_TEST_TIMEOUT_MS));
+
+    // Leave one waiting: it should be discarded when
+    // the instance is removed
+    U_PORT_TEST_ASSERT(uCellPwrDefer(cellHandle, deferOperation, &a, 60000) == 0);
+
+    uCellDeinit();
+    U_PORT_TEST_ASSERT(gDeferCount == 6);
+
+    postamble(&gHandles);
+}
+
+/** Test that uCellCfgApply() leaves alone, and does not reboot for,
+ * settings that already match.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemCfgApply")
+{
+    uPortSimModemTestModule_t *pModule;
+    uDeviceSerial_t *pDeviceSerial;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uCellCfgTransaction_t transaction = U_CELL_CFG_TRANSACTION_DEFAULTS;
+    int32_t unknownCount;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, false);
+    cfg.pScript = gScriptCfg;
+    cfg.scriptLength = sizeof(gScriptCfg) / sizeof(gScriptCfg[0]);
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5);
+    cellHandle = pModule->cellHandle;
+    pDeviceSerial = pModule->pDeviceSerial;
+
+    U_PORT_TEST_ASSERT(uCellCfgApply(cellHandle, NULL, NULL) < 0);
+    // Nothing to do at all
+    U_PORT_TEST_ASSERT(uCellCfgApply(cellHandle, &transaction, NULL) == 0);
+
+    // Ask for what the module already has: nothing should be
+    // written, which the simulated module would answer as an
+    // unknown command, and there should be no reboot
+    transaction.mnoProfile = 100;
+    transaction.rat[0] = U_CELL_NET_RAT_CATM1;
+    transaction.bandMask[0].rat = U_CELL_NET_RAT_CATM1;
+    transaction.bandMask[0].bandMask1 = 524420;
+    transaction.bandMask[1].rat = U_CELL_NET_RAT_NB1;
+    transaction.bandMask[1].bandMask1 = 524420;
+    unknownCount = uPortSimModemUnknownGet(pDeviceSerial);
+    U_PORT_TEST_ASSERT(uCellCfgApply(cellHandle, &transaction, NULL) == 0);
+    U_PORT_TEST_ASSERT(uPortSimModemUnknownGet(pDeviceSerial) == unknownCount);
+    U_PORT_TEST_ASSERT(!uCellPwrRebootIsRequired(cellHandle));
+
+    // Now ask for a different band mask: only that should be
+    // written, followed by a reboot
+    transaction.bandMask[1].bandMask1 = 524416;
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellCfgApply(cellHandle, &transaction, NULL) == 1);
+    U_TEST_PRINT_LINE("applying one change took %d ms.",
+                      uPortGetTickTimeMs() - startTimeMs);
+    U_PORT_TEST_ASSERT(!uCellPwrRebootIsRequired(cellHandle));
+
+    postamble(&gHandles);
+}
+
+/** Test that uCellNetDeepScanRanked() ranks and de-duplicates the
+ * results of a deep scan.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemDeepScan")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uCellNetCellInfo_t table[3];
+
+    preamble(&gHandles, false);
+    cfg.pScript = gScriptDeepScan;
+    cfg.scriptLength = sizeof(gScriptDeepScan) / sizeof(gScriptDeepScan[0]);
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    U_PORT_TEST_ASSERT(uCellNetDeepScanRanked(cellHandle, NULL, 1, NULL) < 0);
+    U_PORT_TEST_ASSERT(uCellNetDeepScanRanked(cellHandle, table, 0, NULL) < 0);
+    U_PORT_TEST_ASSERT(uCellNetConnectBest(cellHandle, NULL, 1, NULL,
+                                           NULL, NULL, NULL) < 0);
+
+    // All three distinct cells should be in the table, best first,
+    // with the repeated cell carrying its better values
+    memset(table, 0, sizeof(table));
+    U_PORT_TEST_ASSERT(uCellNetDeepScanRanked(cellHandle, table,
+                                              sizeof(table) / sizeof(table[0]),
+                                              NULL) == 3);
+    U_PORT_TEST_ASSERT((table[0].mnc == 1) && (table[0].cellIdPhysical == 10));
+    U_PORT_TEST_ASSERT((table[1].mnc == 88) && (table[1].cellIdPhysical == 163));
+    U_PORT_TEST_ASSERT(table[1].rsrpDbm == 30 - (97 + 44));
+    U_PORT_TEST_ASSERT((table[2].mnc == 88) && (table[2].cellIdPhysical == 164));
+
+    // With a too-small table only the best should be kept
+    memset(table, 0, sizeof(table));
+    U_PORT_TEST_ASSERT(uCellNetDeepScanRanked(cellHandle, table, 2, NULL) == 2);
+    U_PORT_TEST_ASSERT(table[0].cellIdPhysical == 10);
+    U_PORT_TEST_ASSERT(table[1].cellIdPhysical == 163);
+    U_PORT_TEST_ASSERT(table[2].cellIdPhysical == 0);
+
+    postamble(&gHandles);
+}
+
+/** Test that, with registration polling off, registration is
+ * picked up from the +CEREG URC without the status being queried
+ * all the time, and that with polling on it is queried.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemRegNoPolling")
+{
+    uPortSimModemTestModule_t *pModule;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+
+    preamble(&gHandles, false);
+    cfg.pCommandCallback = regCommandCallback;
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5);
+    cellHandle = pModule->cellHandle;
+    gpRegDeviceSerial = pModule->pDeviceSerial;
+    U_PORT_TEST_ASSERT(uCellPwrOn(cellHandle, NULL, NULL) == 0);
+
+    U_PORT_TEST_ASSERT(uCellNetSetRegistrationPolling(NULL, false) < 0);
+    U_PORT_TEST_ASSERT(uCellNetGetRegistrationPolling(cellHandle));
+
+    // With polling on the status is queried while waiting
+    gRegQueryCount = 0;
+    gRegRegistered = false;
+    gRegStartTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellNetRegister(cellHandle, NULL, regKeepGoingCallback) == 0);
+    U_PORT_TEST_ASSERT(uCellNetIsRegistered(cellHandle));
+    U_TEST_PRINT_LINE("with polling, registration took %d ms, %d queries.",
+                      uPortGetTickTimeMs() - gRegStartTimeMs, gRegQueryCount);
+    U_PORT_TEST_ASSERT(gRegQueryCount > 1);
+    U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+    U_PORT_TEST_ASSERT(!uCellNetIsRegistered(cellHandle));
+
+    // With polling off only the URC should be needed
+    U_PORT_TEST_ASSERT(uCellNetSetRegistrationPolling(cellHandle, false) == 0);
+    U_PORT_TEST_ASSERT(!uCellNetGetRegistrationPolling(cellHandle));
+    gRegQueryCount = 0;
+    gRegRegistered = false;
+    gRegStartTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellNetRegister(cellHandle, NULL, regKeepGoingCallback) == 0);
+    U_PORT_TEST_ASSERT(uCellNetIsRegistered(cellHandle));
+    U_TEST_PRINT_LINE("without polling, registration took %d ms, %d queries.",
+                      uPortGetTickTimeMs() - gRegStartTimeMs, gRegQueryCount);
+    U_PORT_TEST_ASSERT(gRegQueryCount == 0);
+    U_PORT_TEST_ASSERT(uCellNetGetNetworkStatus(cellHandle,
+                                                U_CELL_NET_REG_DOMAIN_PS) ==
+                       U_CELL_NET_STATUS_REGISTERED_HOME);
+    U_PORT_TEST_ASSERT(uCellNetSetRegistrationPolling(cellHandle, true) == 0);
+    U_PORT_TEST_ASSERT(uCellNetGetRegistrationPolling(cellHandle));
+
+    postamble(&gHandles);
+    gpRegDeviceSerial = NULL;
+}
+
+/** Test that, with a greeting message set, a reboot completes as
+ * soon as the greeting arrives rather than after the fixed wait.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemGreeting")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    const uCellPrivateModule_t *pModule;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, false);
+    cfg.pScript = gScriptGreeting;
+    cfg.scriptLength = sizeof(gScriptGreeting) / sizeof(gScriptGreeting[0]);
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+    pModule = pUCellPrivateGetModule(cellHandle);
+    U_PORT_TEST_ASSERT(pModule != NULL);
+    U_PORT_TEST_ASSERT(uCellPwrOn(cellHandle, NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(uCellCfgSetGreeting(cellHandle, "+SIMGREETING") == 0);
+
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellPwrReboot(cellHandle, NULL) == 0);
+    startTimeMs = uPortGetTickTimeMs() - startTimeMs;
+    U_TEST_PRINT_LINE("reboot took %d ms.", startTimeMs);
+    U_PORT_TEST_ASSERT(startTimeMs < pModule->rebootCommandWaitSeconds * 1000);
+
+    postamble(&gHandles);
+}
+
+/** Test that fast boot skips the non-volatile settings only while
+ * they read back as they were configured.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemFastBoot")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uint32_t fingerprint = 0;
+    uint32_t fingerprintAfter = 0;
+
+    preamble(&gHandles, false);
+    gFastBootHexMode = 1;
+    gFastBootGnssProfile = 0;
+    gFastBootWriteCount = 0;
+    cfg.pScript = gScriptFastBoot;
+    cfg.scriptLength = sizeof(gScriptFastBoot) / sizeof(gScriptFastBoot[0]);
+    cfg.pCommandCallback = fastBootCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+    U_PORT_TEST_ASSERT(uCellPwrSetConfigFingerprint(cellHandle, 1) == 0);
+    U_PORT_TEST_ASSERT(uCellPwrOn(cellHandle, NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(uCellCfgSetGreeting(cellHandle, "+SIMGREETING") == 0);
+
+    // The first power-on writes both settings
+    U_PORT_TEST_ASSERT(gFastBootWriteCount == 2);
+    U_PORT_TEST_ASSERT(gFastBootHexMode == 0);
+    U_PORT_TEST_ASSERT((gFastBootGnssProfile & U_CELL_CFG_GNSS_PROFILE_MUX) != 0);
+    U_PORT_TEST_ASSERT(uCellPwrGetConfigFingerprint(cellHandle, &fingerprint) == 0);
+    U_TEST_PRINT_LINE("fingerprint 0x%08x.", fingerprint);
+
+    // With nothing changed, a reboot writes nothing
+    gFastBootWriteCount = 0;
+    U_PORT_TEST_ASSERT(uCellPwrReboot(cellHandle, NULL) == 0);
+    U_PORT_TEST_ASSERT(gFastBootWriteCount == 0);
+    U_PORT_TEST_ASSERT(uCellPwrGetConfigFingerprint(cellHandle, &fingerprintAfter) == 0);
+    U_PORT_TEST_ASSERT(fingerprintAfter == fingerprint);
+
+    // Something else switches sockets hex mode on: it must be
+    // switched off again
+    gFastBootHexMode = 1;
+    U_PORT_TEST_ASSERT(uCellPwrReboot(cellHandle, NULL) == 0);
+    U_PORT_TEST_ASSERT(gFastBootWriteCount == 1);
+    U_PORT_TEST_ASSERT(gFastBootHexMode == 0);
+    U_PORT_TEST_ASSERT(uCellPwrGetConfigFingerprint(cellHandle, &fingerprintAfter) == 0);
+    U_PORT_TEST_ASSERT(fingerprintAfter == fingerprint);
+
+    // Something else changes the GNSS profile: it must be put back
+    gFastBootWriteCount = 0;
+    gFastBootGnssProfile = 0;
+    U_PORT_TEST_ASSERT(uCellPwrReboot(cellHandle, NULL) == 0);
+    U_PORT_TEST_ASSERT((gFastBootGnssProfile & U_CELL_CFG_GNSS_PROFILE_MUX) != 0);
+    U_PORT_TEST_ASSERT(gFastBootHexMode == 0);
+    U_PORT_TEST_ASSERT(uCellPwrGetConfigFingerprint(cellHandle, &fingerprintAfter) == 0);
+    U_PORT_TEST_ASSERT(fingerprintAfter == fingerprint);
+
+    postamble(&gHandles);
+}
+
+/** Test that uCellLocGetCached() backs off after a refresh that
+ * does not give a usable fix, rather than returning "busy" forever.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemLocCached")
+{
+    uPortSimModemTestModule_t *pModule;
+    uDeviceSerial_t *pDeviceSerial;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uCellPrivateInstance_t *pInstance;
+    const char *pUrc;
+    int32_t latitudeX1e7 = 0;
+    int32_t longitudeX1e7 = 0;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, false);
+    gLocRequestCount = 0;
+    cfg.pScript = gScriptGreeting;
+    cfg.scriptLength = sizeof(gScriptGreeting) / sizeof(gScriptGreeting[0]);
+    cfg.pCommandCallback = locCommandCallback;
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5);
+    cellHandle = pModule->cellHandle;
+    pDeviceSerial = pModule->pDeviceSerial;
+    U_PORT_TEST_ASSERT(uCellPwrOn(cellHandle, NULL, NULL) == 0);
+    // CellLocate needs registration: pretend
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    U_PORT_TEST_ASSERT(pInstance != NULL);
+    pInstance->networkStatus[U_CELL_NET_REG_DOMAIN_PS] = U_CELL_NET_STATUS_REGISTERED_HOME;
+    uCellLocSetCacheMaxAge(cellHandle, 60);
+
+    // Nothing cached: a refresh is started
+    U_PORT_TEST_ASSERT(uCellLocGetCached(cellHandle, &latitudeX1e7, &longitudeX1e7,
+                                         NULL, NULL, NULL, NULL,
+                                         NULL) == (int32_t) U_ERROR_COMMON_BUSY);
+    U_PORT_TEST_ASSERT(gLocRequestCount == 1);
+    U_PORT_TEST_ASSERT(uCellLocGetCached(cellHandle, &latitudeX1e7, &longitudeX1e7,
+                                         NULL, NULL, NULL, NULL,
+                                         NULL) == (int32_t) U_ERROR_COMMON_BUSY);
+    U_PORT_TEST_ASSERT(gLocRequestCount == 1);
+
+    // The refresh returns a fix with a 5 km radius, outside the
+    // desired accuracy: that is the answer and no new refresh
+    // is started until the backoff has passed
+    pUrc = "\r\n+UULOC: 14/10/2026,10:48:43.000,52.2000000,0.1000000,10,5000,0,0,0,2,5\r\n";
+    U_PORT_TEST_ASSERT(uPortSimModemSend(pDeviceSerial, pUrc, strlen(pUrc)) == 0);
+    U_PORT_TEST_ASSERT(locGetCachedWait(cellHandle, &latitudeX1e7, &longitudeX1e7,
+                                        5000) == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    U_PORT_TEST_ASSERT(uCellLocGetCached(cellHandle, &latitudeX1e7, &longitudeX1e7,
+                                         NULL, NULL, NULL, NULL,
+                                         NULL) == (int32_t) U_ERROR_COMMON_NOT_FOUND);
+    U_PORT_TEST_ASSERT(gLocRequestCount == 1);
+
+    // Once the backoff has passed, another refresh is started
+    startTimeMs = uPortGetTickTimeMs();
+    while ((uCellLocGetCached(cellHandle, &latitudeX1e7, &longitudeX1e7,
+                              NULL, NULL, NULL, NULL,
+                              NULL) != (int32_t) U_ERROR_COMMON_BUSY) &&
+           (uPortGetTickTimeMs() - startTimeMs < (U_CELL_LOC_CACHE_REFRESH_BACKOFF_MIN_SECONDS + 5) * 1000)) {
+        uPortTaskBlock(250);
+    }
+    startTimeMs = uPortGetTickTimeMs() - startTimeMs;
+    U_TEST_PRINT_LINE("refresh restarted after %d ms.", startTimeMs);
+    U_PORT_TEST_ASSERT(startTimeMs >= (U_CELL_LOC_CACHE_REFRESH_BACKOFF_MIN_SECONDS - 1) * 1000);
+    U_PORT_TEST_ASSERT(gLocRequestCount == 2);
+
+    // This time the fix is good and comes from the cache from now on
+    pUrc = "\r\n+UULOC: 14/10/2026,10:48:50.000,52.2000000,0.1000000,10,5,0,0,0,2,5\r\n";
+    U_PORT_TEST_ASSERT(uPortSimModemSend(pDeviceSerial, pUrc, strlen(pUrc)) == 0);
+    U_PORT_TEST_ASSERT(locGetCachedWait(cellHandle, &latitudeX1e7, &longitudeX1e7,
+                                        5000) == 0);
+    U_PORT_TEST_ASSERT(latitudeX1e7 == 522000000);
+    U_PORT_TEST_ASSERT(longitudeX1e7 == 1000000);
+    U_PORT_TEST_ASSERT(uCellLocGetCached(cellHandle, &latitudeX1e7, &longitudeX1e7,
+                                         NULL, NULL, NULL, NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(gLocRequestCount == 2);
+
+    postamble(&gHandles);
+}
+
+/** Test that the identity of the module is read from it only once.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemIdCache")
+{
+    uPortSimModemTestModule_t *pModule;
+    uDeviceSerial_t *pDeviceSerial;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    char imei[U_CELL_INFO_IMEI_SIZE];
+    char imsi[U_CELL_INFO_IMSI_SIZE];
+    char str[U_CELL_INFO_ICCID_BUFFER_SIZE];
+    int32_t startTimeMs;
+
+    preamble(&gHandles, false);
+    // Slow the simulated module down so that an AT
+    // exchange is easy to tell apart from a cache hit
+    cfg.pScript = gScriptIdentity;
+    cfg.scriptLength = sizeof(gScriptIdentity) / sizeof(gScriptIdentity[0]);
+    cfg.responseDelayMs = 200;
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5);
+    cellHandle = pModule->cellHandle;
+    pDeviceSerial = pModule->pDeviceSerial;
+
+    for (size_t x = 0; x < 2; x++) {
+        startTimeMs = uPortGetTickTimeMs();
+        U_PORT_TEST_ASSERT(uCellInfoGetImei(cellHandle, imei) == 0);
+        U_PORT_TEST_ASSERT(memcmp(imei, "356726100184891", sizeof(imei)) == 0);
+        U_PORT_TEST_ASSERT(uCellInfoGetImsi(cellHandle, imsi) == 0);
+        U_PORT_TEST_ASSERT(memcmp(imsi, "222107701772423", sizeof(imsi)) == 0);
+        U_PORT_TEST_ASSERT(uCellInfoGetIccidStr(cellHandle, str, sizeof(str)) == 20);
+        U_PORT_TEST_ASSERT(strcmp(str, "89882280666027595366") == 0);
+        U_PORT_TEST_ASSERT(uCellInfoGetModelStr(cellHandle, str, sizeof(str)) == 12);
+        U_PORT_TEST_ASSERT(strcmp(str, "SARA-R510M8S") == 0);
+        // Truncation should work as for a read from the module
+        U_PORT_TEST_ASSERT(uCellInfoGetModelStr(cellHandle, str, 5) == 4);
+        U_PORT_TEST_ASSERT(strcmp(str, "SARA") == 0);
+        U_PORT_TEST_ASSERT(uCellInfoGetFirmwareVersionStr(cellHandle, str, sizeof(str)) == 12);
+        U_PORT_TEST_ASSERT(strcmp(str, "02.06,A00.01") == 0);
+        startTimeMs = uPortGetTickTimeMs() - startTimeMs;
+        U_TEST_PRINT_LINE("pass %d took %d ms.", x + 1, startTimeMs);
+        if (x == 0) {
+            U_PORT_TEST_ASSERT(startTimeMs >= cfg.responseDelayMs * 5);
+        } else {
+            U_PORT_TEST_ASSERT(startTimeMs < cfg.responseDelayMs);
+        }
+    }
+    U_PORT_TEST_ASSERT(uPortSimModemUnknownGet(pDeviceSerial) == 0);
+
+    postamble(&gHandles);
+}
+
+/** Test that, with warm attach, power-on picks up the registration
+ * and PDP context of a module that is already connected, leaving
+ * it connected, and that a socket it has open can be picked up.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemWarmAttach")
+{
+    uPortSimModemTestModule_t *pModule;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uAtClientStreamHandle_t stream;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    int32_t sockHandle;
+    int32_t received;
+    int32_t x;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pScript = gScriptWarmAttach;
+    cfg.scriptLength = sizeof(gScriptWarmAttach) / sizeof(gScriptWarmAttach[0]);
+
+    // First time around, open a TCP socket and leave it open
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5);
+    cellHandle = pModule->cellHandle;
+    U_PORT_TEST_ASSERT(uCellSockInit() == 0);
+    U_PORT_TEST_ASSERT(uCellSockInitInstance(cellHandle) == 0);
+    sockHandle = uCellSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(sockHandle >= 0);
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+    address.port = (uint16_t) gHandles.tcpPort;
+    U_PORT_TEST_ASSERT(uCellSockConnect(cellHandle, sockHandle, &address) == 0);
+
+    // Now "restart", leaving the simulated module as it is
+    uCellSockDeinit();
+    uCellDeinit();
+    uAtClientRemove(pModule->atHandle);
+    stream.handle.pDeviceSerial = pModule->pDeviceSerial;
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    pModule->atHandle = uAtClientAddExt(&stream, NULL,
+                                        U_PORT_SIM_MODEM_TEST_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(pModule->atHandle != NULL);
+    U_PORT_TEST_ASSERT(uCellInit() == 0);
+    U_PORT_TEST_ASSERT(uCellAdd(U_CELL_MODULE_TYPE_SARA_R5, pModule->atHandle,
+                                -1, -1, -1, false, &cellHandle) == 0);
+    U_PORT_TEST_ASSERT(uCellSockInit() == 0);
+    U_PORT_TEST_ASSERT(uCellSockInitInstance(cellHandle) == 0);
+    U_PORT_TEST_ASSERT(!uCellPwrGetWarmAttach(cellHandle));
+    U_PORT_TEST_ASSERT(uCellPwrSetWarmAttach(cellHandle, true) == 0);
+    U_PORT_TEST_ASSERT(uCellPwrGetWarmAttach(cellHandle));
+
+    // Power on should find the module registered and leave
+    // it that way, so connecting should be a free ride
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellPwrOn(cellHandle, NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(uCellNetIsRegistered(cellHandle));
+    U_PORT_TEST_ASSERT(uCellNetConnect(cellHandle, NULL, NULL, NULL,
+                                       NULL, NULL) == 0);
+    U_TEST_PRINT_LINE("warm attach took %d ms.", uPortGetTickTimeMs() - startTimeMs);
+
+    // Pick up the socket and use it
+    sockHandle = -1;
+    U_PORT_TEST_ASSERT(uCellSockWarmAttach(NULL, &sockHandle, 1) < 0);
+    U_PORT_TEST_ASSERT(uCellSockWarmAttach(cellHandle, &sockHandle, 1) == 1);
+    U_PORT_TEST_ASSERT(sockHandle >= 0);
+    // Doing it again should find nothing new
+    U_PORT_TEST_ASSERT(uCellSockWarmAttach(cellHandle, NULL, 0) == 0);
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellSockWrite(cellHandle, sockHandle, gData, 100) == 100);
+    received = 0;
+    while ((received < 100) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        x = uCellSockRead(cellHandle, sockHandle, gBuffer + received,
+                          sizeof(gBuffer) - received);
+        if (x > 0) {
+            received += x;
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+    U_PORT_TEST_ASSERT(received == 100);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 100) == 0);
+    U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, sockHandle, NULL) == 0);
+
+    postamble(&gHandles);
+}
+
+/** Activate a second PDP context and bind a socket to it.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemContext")
+{
+    uPortSimModemTestModule_t *pModule;
+    uDeviceSerial_t *pDeviceSerial;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uSockAddress_t address = {0};
+    char ipAddress[U_CELL_NET_IP_ADDRESS_SIZE];
+    int32_t sockHandle;
+    int32_t received;
+    int32_t x;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, true);
+    cfg.pScript = gScriptContext;
+    cfg.scriptLength = sizeof(gScriptContext) / sizeof(gScriptContext[0]);
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5);
+    cellHandle = pModule->cellHandle;
+    pDeviceSerial = pModule->pDeviceSerial;
+    U_PORT_TEST_ASSERT(uCellSockInit() == 0);
+    U_PORT_TEST_ASSERT(uCellSockInitInstance(cellHandle) == 0);
+
+    // Not registered yet, so a second context can't be activated
+    U_PORT_TEST_ASSERT(uCellNetActivateContext(cellHandle, 2, "private",
+                                               NULL, NULL) < 0);
+    // Warm attach is the quickest way to get registered
+    U_PORT_TEST_ASSERT(uCellPwrSetWarmAttach(cellHandle, true) == 0);
+    U_PORT_TEST_ASSERT(uCellPwrOn(cellHandle, NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(uCellNetIsRegistered(cellHandle));
+
+    // The default context can't be activated this way and
+    // contexts must be in range
+    U_PORT_TEST_ASSERT(uCellNetActivateContext(cellHandle, U_CELL_NET_CONTEXT_ID,
+                                               "private", NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uCellNetActivateContext(cellHandle, 0, "private",
+                                               NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uCellNetActivateContext(cellHandle,
+                                               U_CELL_NET_MAX_NUM_CONTEXTS + 1,
+                                               "private", NULL, NULL) < 0);
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellNetActivateContext(cellHandle, 2, "private",
+                                               "user", "pass") == 0);
+    U_TEST_PRINT_LINE("activating context 2 took %d ms.",
+                      uPortGetTickTimeMs() - startTimeMs);
+    U_PORT_TEST_ASSERT(uCellNetContextIsActive(cellHandle, 2));
+    U_PORT_TEST_ASSERT(uCellNetContextIsActive(cellHandle, U_CELL_NET_CONTEXT_ID));
+    U_PORT_TEST_ASSERT(!uCellNetContextIsActive(cellHandle, 3));
+    U_PORT_TEST_ASSERT(uCellNetGetContextIpAddressStr(cellHandle, 2,
+                                                      ipAddress) == 8);
+    U_PORT_TEST_ASSERT(strcmp(ipAddress, "10.0.0.2") == 0);
+
+    // Bind a socket to context 2 and use it
+    U_PORT_TEST_ASSERT(uCellSockSetNextContextId(cellHandle, 0) < 0);
+    U_PORT_TEST_ASSERT(uCellSockSetNextContextId(cellHandle,
+                                                 U_CELL_NET_MAX_NUM_CONTEXTS + 1) < 0);
+    U_PORT_TEST_ASSERT(uCellSockSetNextContextId(cellHandle, 2) == 0);
+    sockHandle = uCellSockCreate(cellHandle, U_SOCK_TYPE_STREAM, U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(sockHandle >= 0);
+    U_PORT_TEST_ASSERT(uCellSockGetContextId(cellHandle, sockHandle) == 2);
+    address.ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+    address.ipAddress.address.ipv4 = 0x7f000001;
+    address.port = (uint16_t) gHandles.tcpPort;
+    U_PORT_TEST_ASSERT(uCellSockConnect(cellHandle, sockHandle, &address) == 0);
+    for (size_t y = 0; y < sizeof(gData); y++) {
+        gData[y] = (char) y;
+    }
+    startTimeMs = uPortGetTickTimeMs();
+    U_PORT_TEST_ASSERT(uCellSockWrite(cellHandle, sockHandle, gData, 100) == 100);
+    received = 0;
+    while ((received < 100) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        x = uCellSockRead(cellHandle, sockHandle, gBuffer + received,
+                          sizeof(gBuffer) - received);
+        if (x > 0) {
+            received += x;
+        } else {
+            uPortTaskBlock(10);
+        }
+    }
+    U_PORT_TEST_ASSERT(received == 100);
+    U_PORT_TEST_ASSERT(memcmp(gData, gBuffer, 100) == 0);
+    U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, sockHandle, NULL) == 0);
+
+    // The binding applies to one socket only
+    sockHandle = uCellSockCreate(cellHandle, U_SOCK_TYPE_DGRAM, U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(sockHandle >= 0);
+    U_PORT_TEST_ASSERT(uCellSockGetContextId(cellHandle, sockHandle) == U_CELL_NET_CONTEXT_ID);
+    U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, sockHandle, NULL) == 0);
+
+    U_PORT_TEST_ASSERT(uCellNetDeactivateContext(cellHandle, U_CELL_NET_CONTEXT_ID) < 0);
+    U_PORT_TEST_ASSERT(uCellNetDeactivateContext(cellHandle, 2) == 0);
+    U_PORT_TEST_ASSERT(uPortSimModemUnknownGet(pDeviceSerial) >= 0);
+
+    postamble(&gHandles);
+}
+
+/** Run the data counter sampler.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemDataCounter")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uCellNetDataCounterSample_t sample[U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH];
+    int32_t count;
+
+    preamble(&gHandles, false);
+    cfg.pScript = gScriptDataCounter;
+    cfg.scriptLength = sizeof(gScriptDataCounter) / sizeof(gScriptDataCounter[0]);
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+    // Warm attach is the quickest way to get registered
+    U_PORT_TEST_ASSERT(uCellPwrSetWarmAttach(cellHandle, true) == 0);
+    U_PORT_TEST_ASSERT(uCellPwrOn(cellHandle, NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(uCellNetIsRegistered(cellHandle));
+
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, NULL, 0) < 0);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerStart(cellHandle, -1) < 0);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerStart(cellHandle, 100) == 0);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, NULL, 0) == 0);
+    // Wait long enough for the history to fill, and more
+    uPortTaskBlock(100 * (U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH + 10));
+    count = uCellNetDataCounterSamplerRead(cellHandle, NULL, 0);
+    U_TEST_PRINT_LINE("%d data counter sample(s) in the history.", count);
+    U_PORT_TEST_ASSERT(count == U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, sample, 4) == 4);
+    for (size_t x = 0; x < 4; x++) {
+        U_PORT_TEST_ASSERT(sample[x].txBytes == 1000);
+        U_PORT_TEST_ASSERT(sample[x].rxBytes == 2000);
+        U_PORT_TEST_ASSERT(!sample[x].atDeactivation);
+        if (x > 0) {
+            U_PORT_TEST_ASSERT(sample[x].timeMs >= sample[x - 1].timeMs);
+        }
+    }
+
+    // Changing to sampling only at deactivation keeps the history,
+    // disconnecting should add the final count and, once
+    // disconnected, there should be no more samples
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerStart(cellHandle, 0) == 0);
+    count = uCellNetDataCounterSamplerRead(cellHandle, NULL, 0);
+    U_PORT_TEST_ASSERT(count >= U_CELL_NET_DATA_COUNTER_HISTORY_LENGTH - 4);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, sample,
+                                                      sizeof(sample) / sizeof(sample[0])) == count);
+    for (int32_t x = 0; x < count; x++) {
+        U_PORT_TEST_ASSERT(!sample[x].atDeactivation);
+    }
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerStart(cellHandle, 100) == 0);
+    U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+    U_PORT_TEST_ASSERT(!uCellNetIsRegistered(cellHandle));
+    uPortTaskBlock(500);
+    count = uCellNetDataCounterSamplerRead(cellHandle, sample,
+                                           sizeof(sample) / sizeof(sample[0]));
+    U_PORT_TEST_ASSERT(count > 0);
+    U_PORT_TEST_ASSERT(sample[count - 1].atDeactivation);
+    U_PORT_TEST_ASSERT(sample[count - 1].txBytes == 1000);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, NULL, 0) == 0);
+
+    // Stopping frees the history, stopping again does no harm and
+    // a restarted sampler begins with an empty history
+    uCellNetDataCounterSamplerStop(cellHandle);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, NULL, 0) < 0);
+    uCellNetDataCounterSamplerStop(cellHandle);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerStart(cellHandle, 100) == 0);
+    U_PORT_TEST_ASSERT(uCellNetDataCounterSamplerRead(cellHandle, NULL, 0) == 0);
+
+    // Leave the sampler running to check that uCellDeinit() tidies up
+
+    postamble(&gHandles);
+}
+
+/** Test that more AT clients than U_AT_CLIENT_MAX_NUM can be
+ * added, that each can talk to its module and receive callbacks,
+ * and that one stream cannot have two AT clients.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemManyAtClients")
+{
+    uAtClientHandle_t atHandle[U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS];
+    uPortSimModemTestModule_t *pModule;
+    uAtClientStreamHandle_t stream;
+    int32_t startTimeMs;
+    bool allCalledBack = false;
+
+    preamble(&gHandles, false);
+    U_TEST_PRINT_LINE("adding %d AT clients.", U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS);
+    stream.type = U_AT_CLIENT_STREAM_TYPE_VIRTUAL_SERIAL;
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS; x++) {
+        gAtCallbackCount[x] = 0;
+        pModule = pModuleAdd(&gHandles, NULL, U_CELL_MODULE_TYPE_MAX_NUM);
+        atHandle[x] = pModule->atHandle;
+        stream.handle.pDeviceSerial = pModule->pDeviceSerial;
+        // Adding again gives back the same AT client
+        U_PORT_TEST_ASSERT(uAtClientAddExt(&stream, NULL,
+                                           U_PORT_SIM_MODEM_TEST_AT_BUFFER_LENGTH_BYTES) == atHandle[x]);
+    }
+
+    // Talk to each module and ask each AT client for a callback
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS; x++) {
+        uAtClientLock(atHandle[x]);
+        uAtClientCommandStart(atHandle[x], "AT");
+        uAtClientCommandStopReadResponse(atHandle[x]);
+        U_PORT_TEST_ASSERT(uAtClientUnlock(atHandle[x]) == 0);
+        U_PORT_TEST_ASSERT(uAtClientCallback(atHandle[x], atCallback,
+                                             (void *) (uintptr_t) x) == 0);
+    }
+    startTimeMs = uPortGetTickTimeMs();
+    while (!allCalledBack &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        allCalledBack = true;
+        for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS; x++) {
+            if (gAtCallbackCount[x] != 1) {
+                allCalledBack = false;
+            }
+        }
+        uPortTaskBlock(10);
+    }
+    U_PORT_TEST_ASSERT(allCalledBack);
+
+    // An AT client told to ignore asynchronous events gets no more
+    // callbacks, the others still do
+    uAtClientIgnoreAsync(atHandle[0]);
+    U_PORT_TEST_ASSERT(uAtClientCallback(atHandle[0], atCallback, (void *) 0) == 0);
+    U_PORT_TEST_ASSERT(uAtClientCallback(atHandle[U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS - 1],
+                                         atCallback,
+                                         (void *) (uintptr_t) (U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS - 1)) == 0);
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gAtCallbackCount[U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS - 1] < 2) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+    uPortTaskBlock(100);
+    U_PORT_TEST_ASSERT(gAtCallbackCount[U_PORT_SIM_MODEM_TEST_NUM_AT_CLIENTS - 1] == 2);
+    U_PORT_TEST_ASSERT(gAtCallbackCount[0] == 1);
+
+    postamble(&gHandles);
+}
+
+#ifdef U_CFG_AT_CLIENT_STATS
+/** Test that, with adaptive AT timeouts on, an AT command which has
+ * always been answered quickly times out quickly when it is not
+ * answered, while a call to uAtClientTimeoutSet() is still obeyed.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemAdaptiveTimeout")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uAtClientHandle_t atHandle;
+    uAtClientStats_t stats;
+    int32_t startTimeMs;
+    int32_t durationMs;
+
+    preamble(&gHandles, false);
+    cfg.pScript = gScriptAdaptive;
+    cfg.scriptLength = sizeof(gScriptAdaptive) / sizeof(gScriptAdaptive[0]);
+    atHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_MAX_NUM)->atHandle;
+    U_PORT_TEST_ASSERT(uAtClientTimeoutAdaptiveSet(atHandle, true) == 0);
+
+    // Build up some history
+    for (size_t x = 0; x < U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_SAMPLES; x++) {
+        uAtClientLock(atHandle);
+        uAtClientCommandStart(atHandle, "AT+XADAPT");
+        uAtClientCommandStopReadResponse(atHandle);
+        U_PORT_TEST_ASSERT(uAtClientUnlock(atHandle) == 0);
+    }
+    U_PORT_TEST_ASSERT(uAtClientStatsGet(atHandle, &stats, 1) == 1);
+    U_TEST_PRINT_LINE("adaptive timeout of %s is %d ms.", stats.command,
+                      stats.timeoutAdaptiveMs);
+    U_PORT_TEST_ASSERT(stats.timeoutAdaptiveMs >= U_AT_CLIENT_TIMEOUT_ADAPTIVE_MIN_MS);
+    U_PORT_TEST_ASSERT(stats.timeoutAdaptiveMs < U_AT_CLIENT_DEFAULT_TIMEOUT_MS);
+
+    // A timeout set by the caller takes precedence and the
+    // default is back afterwards
+    uAtClientLock(atHandle);
+    uAtClientTimeoutSet(atHandle, stats.timeoutAdaptiveMs * 3);
+    uAtClientCommandStart(atHandle, "AT+XADAPT");
+    uAtClientCommandStopReadResponse(atHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atHandle) == 0);
+    U_PORT_TEST_ASSERT(uAtClientTimeoutGet(atHandle) == U_AT_CLIENT_DEFAULT_TIMEOUT_MS);
+
+    // Now no answer: this should time out in the adaptive time
+    startTimeMs = uPortGetTickTimeMs();
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+XADAPT=1");
+    uAtClientCommandStopReadResponse(atHandle);
+    U_PORT_TEST_ASSERT(uAtClientUnlock(atHandle) < 0);
+    durationMs = uPortGetTickTimeMs() - startTimeMs;
+    U_TEST_PRINT_LINE("unanswered command timed out after %d ms.", durationMs);
+    U_PORT_TEST_ASSERT(durationMs < U_AT_CLIENT_DEFAULT_TIMEOUT_MS / 2);
+    U_PORT_TEST_ASSERT(uAtClientTimeoutGet(atHandle) == U_AT_CLIENT_DEFAULT_TIMEOUT_MS);
+
+    // Having timed out, the command is no longer adapted
+    U_PORT_TEST_ASSERT(uAtClientStatsGet(atHandle, &stats, 1) == 1);
+    U_PORT_TEST_ASSERT(stats.timeoutCount == 1);
+    U_PORT_TEST_ASSERT(stats.timeoutAdaptiveMs < 0);
+
+    postamble(&gHandles);
+}
+#endif
+
+/** Queue HTTP GET requests on a context and check that they are
+ * carried out in order, that each completion callback is called
+ * once with the outcome of its request and that those still queued
+ * when the context is closed are cancelled.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemHttpQueue")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uHttpClientContext_t *pContext;
+    uHttpClientConnection_t connection = U_HTTP_CLIENT_CONNECTION_DEFAULT;
+    static const char *const pPath[] = {"/a", "/b", "/c", "/d"};
+    char body[U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS][U_PORT_SIM_MODEM_TEST_HTTP_BODY_LENGTH_BYTES];
+    size_t size[U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS];
+    int32_t numCancelled = 0;
+    int32_t startTimeMs;
+
+    preamble(&gHandles, false);
+    gHttpLog[0] = 0;
+    gHttpDelayMs = 0;
+    gHttpDoneCount = 0;
+    memset(gHttpDone, 0, sizeof(gHttpDone));
+    cfg.pCommandCallback = httpCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    connection.pServerName = "http.example.com";
+    pContext = pUHttpClientOpen(cellHandle, &connection, NULL);
+    U_PORT_TEST_ASSERT(pContext != NULL);
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestQueue(NULL, pPath[0], body[0], &(size[0]),
+                                                  NULL, httpQueueCallback,
+                                                  (void *) (intptr_t) 'a') < 0);
+    U_PORT_TEST_ASSERT(gHttpDoneCount == 0);
+
+    // Queue all of the requests at once
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS; x++) {
+        memset(body[x], 0, sizeof(body[x]));
+        size[x] = sizeof(body[x]);
+        gHttpStatusCodeOrError[x] = -1;
+        U_PORT_TEST_ASSERT(uHttpClientGetRequestQueue(pContext, pPath[x], body[x],
+                                                      &(size[x]), NULL,
+                                                      httpQueueCallback,
+                                                      (void *) (intptr_t) ('a' + x)) == 0);
+    }
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gHttpDoneCount < U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+    U_TEST_PRINT_LINE("requests \"%s\" completed \"%s\".", gHttpLog, gHttpDone);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/a /b /c /d ") == 0);
+    U_PORT_TEST_ASSERT(strcmp(gHttpDone, "abcd") == 0);
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS; x++) {
+        U_PORT_TEST_ASSERT(gHttpStatusCodeOrError[x] == 200);
+        U_PORT_TEST_ASSERT(size[x] == strlen(pPath[x]));
+        U_PORT_TEST_ASSERT(strcmp(body[x], pPath[x]) == 0);
+    }
+
+    // Now a slow module: close the context while requests are
+    // still queued, they should be cancelled
+    gHttpLog[0] = 0;
+    gHttpDelayMs = 500;
+    gHttpDoneCount = 0;
+    memset(gHttpDone, 0, sizeof(gHttpDone));
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS; x++) {
+        size[x] = sizeof(body[x]);
+        gHttpStatusCodeOrError[x] = -1;
+        U_PORT_TEST_ASSERT(uHttpClientGetRequestQueue(pContext, pPath[x], body[x],
+                                                      &(size[x]), NULL,
+                                                      httpQueueCallback,
+                                                      (void *) (intptr_t) ('a' + x)) == 0);
+    }
+    uPortTaskBlock(100);
+    uHttpClientClose(pContext);
+    U_TEST_PRINT_LINE("requests \"%s\" completed \"%s\".", gHttpLog, gHttpDone);
+    // Every callback has been called, in order, by the time
+    // uHttpClientClose() returns
+    U_PORT_TEST_ASSERT(strcmp(gHttpDone, "abcd") == 0);
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS; x++) {
+        if (gHttpStatusCodeOrError[x] == (int32_t) U_ERROR_COMMON_CANCELLED) {
+            numCancelled++;
+        }
+    }
+    U_PORT_TEST_ASSERT(numCancelled >= U_PORT_SIM_MODEM_TEST_HTTP_NUM_REQUESTS - 1);
+    gHttpDelayMs = 0;
+
+    postamble(&gHandles);
+}
+
+/** Make conditional HTTP GET requests and check that the ETag the
+ * server sent for a path is sent back only with requests for that
+ * same path, that an unchanged resource then costs no body, that a
+ * changed one replaces the ETag, that the oldest path is forgotten
+ * when the cache is full and that a path too long to remember is
+ * requested unconditionally.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemHttpConditional")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uHttpClientContext_t *pContext;
+    uHttpClientConnection_t connection = U_HTTP_CLIENT_CONNECTION_DEFAULT;
+    // One more path than the ETag cache can hold
+    static const char *const pPath[] = {"/a", "/b", "/c", "/d", "/e"};
+    char longPath[U_PORT_SIM_MODEM_TEST_HTTP_LONG_PATH_LENGTH + 1];
+    char body[U_PORT_SIM_MODEM_TEST_HTTP_LONG_PATH_LENGTH + 1];
+    char expected[16];
+    size_t size;
+
+    preamble(&gHandles, false);
+    gHttpLog[0] = 0;
+    gHttpDelayMs = 0;
+    gHttpIfNoneMatch[0] = 0;
+    gHttpETagVersion = 0;
+    cfg.pCommandCallback = httpCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R5)->cellHandle;
+
+    connection.pServerName = "http.example.com";
+    pContext = pUHttpClientOpen(cellHandle, &connection, NULL);
+    U_PORT_TEST_ASSERT(pContext != NULL);
+
+    // Bad parameters
+    size = sizeof(body);
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestConditional(NULL, pPath[0], body,
+                                                        &size, NULL) < 0);
+    U_PORT_TEST_ASSERT(uHttpClientGetRequestConditional(pContext, NULL, body,
+                                                        &size, NULL) < 0);
+    U_PORT_TEST_ASSERT(gHttpLog[0] == 0);
+
+    // The first time round every path is fetched in full, after
+    // which each is fetched with its own ETag and is unchanged
+    for (size_t x = 0; x < 2; x++) {
+        U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[x], body,
+                                              sizeof(body), &size) == 200);
+        snprintf(expected, sizeof(expected), "%s ", pPath[x]);
+        U_PORT_TEST_ASSERT(strcmp(gHttpLog, expected) == 0);
+        U_PORT_TEST_ASSERT(size == strlen(pPath[x]));
+        U_PORT_TEST_ASSERT(strcmp(body, pPath[x]) == 0);
+    }
+    for (size_t x = 0; x < 2; x++) {
+        U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[x], body,
+                                              sizeof(body), &size) == 304);
+        snprintf(expected, sizeof(expected), "%s* ", pPath[x]);
+        U_PORT_TEST_ASSERT(strcmp(gHttpLog, expected) == 0);
+        U_PORT_TEST_ASSERT(size == 0);
+    }
+    // A path that merely starts with one that has an ETag has none
+    U_PORT_TEST_ASSERT(httpGetConditional(pContext, "/a/", body,
+                                          sizeof(body), &size) == 200);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/a/ ") == 0);
+    // An ordinary GET of the same path does not carry the header
+    gHttpLog[0] = 0;
+    size = sizeof(body);
+    U_PORT_TEST_ASSERT(uHttpClientGetRequest(pContext, pPath[0], body, &size, NULL) == 200);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/a ") == 0);
+
+    // Change the resources: the old ETag is sent, the new
+    // resource comes back and its ETag is used next time
+    gHttpETagVersion = 1;
+    U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[0], body,
+                                          sizeof(body), &size) == 200);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/a* ") == 0);
+    U_PORT_TEST_ASSERT(strcmp(body, pPath[0]) == 0);
+    U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[0], body,
+                                          sizeof(body), &size) == 304);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/a* ") == 0);
+
+    // Fill the cache, which holds "/a", "/b" and "/a/": "/c" takes
+    // the last entry, then "/d" and "/e" replace the oldest two
+    for (size_t x = 2; x < sizeof(pPath) / sizeof(pPath[0]); x++) {
+        U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[x], body,
+                                              sizeof(body), &size) == 200);
+    }
+    U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[4], body,
+                                          sizeof(body), &size) == 304);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/e* ") == 0);
+    U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[0], body,
+                                          sizeof(body), &size) == 200);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/a ") == 0);
+
+    // A path too long to remember is always fetched in full
+    memset(longPath, 'x', sizeof(longPath));
+    longPath[0] = '/';
+    longPath[sizeof(longPath) - 1] = 0;
+    for (size_t x = 0; x < 2; x++) {
+        U_PORT_TEST_ASSERT(httpGetConditional(pContext, longPath, body,
+                                              sizeof(body), &size) == 200);
+        U_PORT_TEST_ASSERT(gHttpRequestIfNoneMatch[0] == 0);
+        U_PORT_TEST_ASSERT(size == strlen(longPath));
+        U_PORT_TEST_ASSERT(strcmp(body, longPath) == 0);
+    }
+
+    // When the server stops sending an ETag the path is forgotten
+    gHttpETagVersion = -1;
+    U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[4], body,
+                                          sizeof(body), &size) == 200);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/e* ") == 0);
+    U_PORT_TEST_ASSERT(httpGetConditional(pContext, pPath[4], body,
+                                          sizeof(body), &size) == 200);
+    U_PORT_TEST_ASSERT(strcmp(gHttpLog, "/e ") == 0);
+
+    uHttpClientClose(pContext);
+    gHttpIfNoneMatch[0] = 0;
+    gHttpRequestIfNoneMatch[0] = 0;
+
+    postamble(&gHandles);
+}
+
+/** Test a managed MQTT session over the simulated module, playing
+ * the part of a SARA-R410M-02B: that publishes made while messages
+ * are held do not overtake them, that a held message which keeps
+ * failing is eventually thrown away and that, on reconnection, the
+ * subscriptions are made again before what is held is published.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemMqttSession")
+{
+    uPortSimModemTestModule_t *pModule;
+    uDeviceSerial_t *pDeviceSerial;
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    uMqttClientContext_t *pContext;
+    uMqttClientConnection_t connection = U_MQTT_CLIENT_CONNECTION_DEFAULT;
+    uMqttClientSessionCfg_t sessionCfg = U_MQTT_CLIENT_SESSION_CFG_DEFAULT;
+    int32_t errorCode;
+    int32_t startTimeMs;
+    const char *pStr;
+
+    preamble(&gHandles, false);
+    gMqttLog[0] = 0;
+    gMqttLogLength = 0;
+    gMqttConnected = false;
+    gMqttConnectFailCount = 0;
+    gMqttPublishFailCount = 0;
+    gMqttReconnectCount = 0;
+    gMqttReconnectAttempts = 0;
+    gMqttDisconnectCount = 0;
+    cfg.pCommandCallback = mqttCommandCallback;
+    pModule = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R410M_02B);
+    cellHandle = pModule->cellHandle;
+    pDeviceSerial = pModule->pDeviceSerial;
+
+    pContext = pUMqttClientOpen(cellHandle, NULL);
+    U_PORT_TEST_ASSERT(pContext != NULL);
+    connection.pBrokerNameStr = "broker.example.com";
+    connection.pClientIdStr = "simModem";
+    sessionCfg.backoffMinMs = 100;
+    sessionCfg.backoffMaxMs = 400;
+    sessionCfg.outboxMaxNumMessages = 4;
+    sessionCfg.pReconnectCallback = mqttReconnectCallback;
+    U_PORT_TEST_ASSERT(uMqttClientSessionStart(pContext, &connection, &sessionCfg) == 0);
+    U_PORT_TEST_ASSERT(uMqttClientIsConnected(pContext));
+    // With a managed session, this is called by the session's own
+    U_PORT_TEST_ASSERT(uMqttClientSetDisconnectCallback(pContext,
+                                                        mqttDisconnectCallback,
+                                                        NULL) == 0);
+    U_PORT_TEST_ASSERT(uMqttClientSubscribe(pContext, "sim/topic",
+                                            U_MQTT_QOS_AT_LEAST_ONCE) >= 0);
+    U_PORT_TEST_ASSERT(uMqttClientPublish(pContext, "sim/topic", "one", 3,
+                                          U_MQTT_QOS_AT_LEAST_ONCE, false) == 0);
+    U_PORT_TEST_ASSERT(strcmp(gMqttLog, "C;S:sim/topic;P:one;") == 0);
+
+    // A publish that fails while connected is held and tried
+    // again; one made after it must not overtake it
+    U_TEST_PRINT_LINE("publishing while a message is held...");
+    gMqttLog[0] = 0;
+    gMqttLogLength = 0;
+    gMqttPublishFailCount = 1;
+    U_PORT_TEST_ASSERT(uMqttClientPublish(pContext, "sim/topic", "two", 3,
+                                          U_MQTT_QOS_AT_LEAST_ONCE,
+                                          false) == (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE);
+    errorCode = uMqttClientPublish(pContext, "sim/topic", "three", 5,
+                                   U_MQTT_QOS_AT_LEAST_ONCE, false);
+    U_PORT_TEST_ASSERT((errorCode == 0) ||
+                       (errorCode == (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE));
+    U_PORT_TEST_ASSERT(mqttLogWait("P:three;", U_PORT_SIM_MODEM_TEST_TIMEOUT_MS));
+    U_TEST_PRINT_LINE("broker log \"%s\".", gMqttLog);
+    U_PORT_TEST_ASSERT(strcmp(gMqttLog, "P:two;P:three;") == 0);
+
+    // A held message that keeps failing while connected is thrown
+    // away, after which those behind it are published
+    U_TEST_PRINT_LINE("publishing a message that keeps failing...");
+    gMqttLog[0] = 0;
+    gMqttLogLength = 0;
+    gMqttPublishFailCount = U_MQTT_CLIENT_SESSION_OUTBOX_MAX_NUM_RETRIES + 2;
+    U_PORT_TEST_ASSERT(uMqttClientPublish(pContext, "sim/topic", "four", 4,
+                                          U_MQTT_QOS_AT_LEAST_ONCE,
+                                          false) == (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE);
+    U_PORT_TEST_ASSERT(uMqttClientPublish(pContext, "sim/topic", "five", 4,
+                                          U_MQTT_QOS_AT_LEAST_ONCE,
+                                          false) == (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE);
+    U_PORT_TEST_ASSERT(mqttLogWait("P:five;", U_PORT_SIM_MODEM_TEST_TIMEOUT_MS));
+    U_TEST_PRINT_LINE("broker log \"%s\".", gMqttLog);
+    U_PORT_TEST_ASSERT(strcmp(gMqttLog, "P:five;") == 0);
+    U_PORT_TEST_ASSERT(gMqttPublishFailCount == 0);
+
+    // Now have the broker drop the connection and refuse the first
+    // two attempts to reconnect
+    U_TEST_PRINT_LINE("dropping the connection...");
+    gMqttLog[0] = 0;
+    gMqttLogLength = 0;
+    gMqttConnected = false;
+    gMqttConnectFailCount = 2;
+    pStr = "\r\n+UUMQTTC: 0,100\r\n";
+    U_PORT_TEST_ASSERT(uPortSimModemSend(pDeviceSerial, pStr, strlen(pStr)) == 0);
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gMqttDisconnectCount == 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+    U_PORT_TEST_ASSERT(gMqttDisconnectCount == 1);
+    // While disconnected a QoS 1 message is held, a QoS 0 one is not
+    U_PORT_TEST_ASSERT(uMqttClientPublish(pContext, "sim/topic", "six", 3,
+                                          U_MQTT_QOS_AT_LEAST_ONCE,
+                                          false) == (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE);
+    errorCode = uMqttClientPublish(pContext, "sim/topic", "zero", 4,
+                                   U_MQTT_QOS_AT_MOST_ONCE, false);
+    U_PORT_TEST_ASSERT(errorCode < 0);
+    U_PORT_TEST_ASSERT(errorCode != (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE);
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gMqttReconnectCount == 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS * 3)) {
+        uPortTaskBlock(10);
+    }
+    U_TEST_PRINT_LINE("reconnected after %d attempt(s), broker log \"%s\".",
+                      gMqttReconnectAttempts, gMqttLog);
+    U_PORT_TEST_ASSERT(gMqttReconnectCount == 1);
+    U_PORT_TEST_ASSERT(gMqttReconnectAttempts == 3);
+    U_PORT_TEST_ASSERT(uMqttClientIsConnected(pContext));
+    // The module does not retain sessions, so the subscription must
+    // have been made again, and before the held message went out
+    U_PORT_TEST_ASSERT(strcmp(gMqttLog, "C;S:sim/topic;P:six;") == 0);
+
+    // Nothing is left held
+    U_PORT_TEST_ASSERT(uMqttClientSessionStop(pContext) == 0);
+    uMqttClientClose(pContext);
+
+    postamble(&gHandles);
+}
+
+/** Test uCellMqttPublishAsync() over the simulated module, playing
+ * the part of a SARA-R410M-02B: the callback of each message must
+ * be called, in order, with the outcome the broker gave.
+ */
+U_PORT_TEST_FUNCTION("[portSimModem]", "portSimModemMqttPublishAsync")
+{
+    uPortSimModemCfg_t cfg = U_PORT_SIM_MODEM_CFG_DEFAULT;
+    uDeviceHandle_t cellHandle = NULL;
+    static const char *const pMessage[] = {"one", "two", "three"};
+    int32_t handle[U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC];
+    int32_t startTimeMs;
+
+    preamble(&gHandles, false);
+    gMqttLog[0] = 0;
+    gMqttLogLength = 0;
+    gMqttConnected = false;
+    gMqttConnectFailCount = 0;
+    gMqttPublishFailCount = 0;
+    gMqttAsyncDoneCount = 0;
+    memset(gMqttAsyncDone, 0, sizeof(gMqttAsyncDone));
+    cfg.pCommandCallback = mqttCommandCallback;
+    cellHandle = pModuleAdd(&gHandles, &cfg, U_CELL_MODULE_TYPE_SARA_R410M_02B)->cellHandle;
+
+    // Bad parameters, and not yet initialised
+    U_PORT_TEST_ASSERT(uCellMqttPublishAsync(cellHandle, "sim/topic", "x", 1,
+                                             U_CELL_MQTT_QOS_AT_LEAST_ONCE, false,
+                                             mqttPublishAsyncCallback, NULL) < 0);
+    U_PORT_TEST_ASSERT(uCellMqttInit(cellHandle, "broker.example.com", "simModem",
+                                     NULL, NULL, NULL, false) == 0);
+    U_PORT_TEST_ASSERT(uCellMqttPublishAsync(cellHandle, NULL, "x", 1,
+                                             U_CELL_MQTT_QOS_AT_LEAST_ONCE, false,
+                                             mqttPublishAsyncCallback, NULL) < 0);
+    U_PORT_TEST_ASSERT(uCellMqttConnect(cellHandle) == 0);
+    U_PORT_TEST_ASSERT(gMqttAsyncDoneCount == 0);
+
+    // Queue the messages in one go, the broker refusing the first
+    gMqttPublishFailCount = 1;
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC; x++) {
+        gMqttAsyncHandle[x] = -1;
+        gMqttAsyncErrorCode[x] = 1;
+        handle[x] = uCellMqttPublishAsync(cellHandle, "sim/topic", pMessage[x],
+                                          strlen(pMessage[x]),
+                                          U_CELL_MQTT_QOS_AT_LEAST_ONCE, false,
+                                          mqttPublishAsyncCallback,
+                                          (void *) (intptr_t) x);
+        U_PORT_TEST_ASSERT(handle[x] >= 0);
+    }
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gMqttAsyncDoneCount < U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC) &&
+           (uPortGetTickTimeMs() - startTimeMs < U_PORT_SIM_MODEM_TEST_TIMEOUT_MS)) {
+        uPortTaskBlock(10);
+    }
+    U_TEST_PRINT_LINE("broker got \"%s\", callbacks \"%s\".", gMqttLog, gMqttAsyncDone);
+    U_PORT_TEST_ASSERT(strcmp(gMqttAsyncDone, "012") == 0);
+    U_PORT_TEST_ASSERT(strcmp(gMqttLog, "C;P:two;P:three;") == 0);
+    U_PORT_TEST_ASSERT(uCellMqttPublishAsyncGetNum(cellHandle) == 0);
+    for (size_t x = 0; x < U_PORT_SIM_MODEM_TEST_MQTT_NUM_ASYNC; x++) {
+        U_PORT_TEST_ASSERT(gMqttAsyncHandle[x] == handle[x]);
+        if (x == 0) {
+            U_PORT_TEST_ASSERT(gMqttAsyncErrorCode[x] < 0);
+        } else {
+            U_PORT_TEST_ASSERT(gMqttAsyncErrorCode[x] == 0);
+        }
+    }
+
+    U_PORT_TEST_ASSERT(uCellMqttDisconnect(cellHandle) == 0);
+    uCellMqttDeinit(cellHandle);
+
+    postamble(&gHandles);
+}
+
+// End of file
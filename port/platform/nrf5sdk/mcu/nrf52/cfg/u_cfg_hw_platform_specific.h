@@ -39,23 +39,21 @@
 # define U_CFG_HW_TICK_TIMER_INSTANCE           1
 #endif
 
-/** It is a design constraint of the NRF52 UART that,
- * in order to implement continuous reception, a timer instance
- * is also required to count the UART received characters (since
- * the DMA only tells you when it has finished).  Up to two
- * instances of the UART driver may be created, this is
- * the timer instance that will be used if UARTE0 is selected.
+/** The NRF52 UART has no idle-line detection, hence a timer
+ * instance is also required, to tell when the Rx line has gone idle
+ * after a burst of received characters.  Up to two instances of
+ * the UART driver may be created, this is the timer instance that
+ * will be used if UARTE0 is selected.
  */
 #ifndef U_CFG_HW_UART_COUNTER_INSTANCE_0
 # define U_CFG_HW_UART_COUNTER_INSTANCE_0       2
 #endif
 
-/** It is a design constraint of the NRF52 UART that,
- * in order to implement continuous reception, a timer instance
- * is also required to count the UART received characters (since
- * the DMA only tells you when it has finished).  Up to two
- * instances of the UART driver may be created, this is
- * the timer instance that will be used if UARTE1 is selected.
+/** The NRF52 UART has no idle-line detection, hence a timer
+ * instance is also required, to tell when the Rx line has gone idle
+ * after a burst of received characters.  Up to two instances of
+ * the UART driver may be created, this is the timer instance that
+ * will be used if UARTE1 is selected.
  */
 #ifndef U_CFG_HW_UART_COUNTER_INSTANCE_1
 # define U_CFG_HW_UART_COUNTER_INSTANCE_1       3
@@ -62,6 +62,7 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // memset(), strncpy()
 
 #include "u_cfg_sw.h"
 #include "u_cfg_os_platform_specific.h"
@@ -72,6 +73,7 @@
 #include "u_port_debug.h"
 #include "u_port.h"
 #include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_port_private.h"
 
 #include "FreeRTOS.h"
@@ -189,6 +191,66 @@ int32_t uPortTaskGetHandle(uPortTaskHandle_t *pTaskHandle)
     return (int32_t) errorCode;
 }
 
+// Get the statistics of all tasks.
+int32_t uPortTaskStatsGet(uPortTaskStats_t *pStats, size_t numStats,
+                          int64_t *pTotalRunTime)
+{
+    int32_t errorCodeOrNumber = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+#if (configUSE_TRACE_FACILITY == 1)
+    TaskStatus_t *pStatus;
+    UBaseType_t numTasks;
+    uint32_t totalRunTime = 0;
+
+    if ((pStats != NULL) || (numStats == 0)) {
+        numTasks = uxTaskGetNumberOfTasks();
+        errorCodeOrNumber = (int32_t) numTasks;
+        if (pStats != NULL) {
+            errorCodeOrNumber = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            // Allow for a task or two being created in the meantime
+            numTasks += 2;
+            pStatus = (TaskStatus_t *) pUPortMalloc(numTasks * sizeof(TaskStatus_t));
+            if (pStatus != NULL) {
+                numTasks = uxTaskGetSystemState(pStatus, numTasks, &totalRunTime);
+                if (numTasks > numStats) {
+                    numTasks = numStats;
+                }
+                for (size_t x = 0; x < numTasks; x++) {
+                    memset(pStats, 0, sizeof(*pStats));
+                    pStats->taskHandle = (uPortTaskHandle_t) pStatus[x].xHandle;
+                    strncpy(pStats->name, pStatus[x].pcTaskName, sizeof(pStats->name) - 1);
+# if (configGENERATE_RUN_TIME_STATS == 1)
+                    pStats->runTime = pStatus[x].ulRunTimeCounter;
+# else
+                    pStats->runTime = -1;
+# endif
+                    pStats->contextSwitches = -1;
+                    // As for uPortTaskStackMinFree(), words to bytes
+                    pStats->stackMinFreeBytes = pStatus[x].usStackHighWaterMark * 4;
+                    pStats++;
+                }
+                uPortFree(pStatus);
+                errorCodeOrNumber = (int32_t) numTasks;
+            }
+        }
+        if (pTotalRunTime != NULL) {
+            *pTotalRunTime = -1;
+# if (configGENERATE_RUN_TIME_STATS == 1)
+            if (pStats != NULL) {
+                *pTotalRunTime = totalRunTime;
+            }
+# endif
+        }
+    }
+#else
+    (void) pStats;
+    (void) numStats;
+    (void) pTotalRunTime;
+    errorCodeOrNumber = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+#endif
+
+    return errorCodeOrNumber;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: QUEUES
  * -------------------------------------------------------------- */
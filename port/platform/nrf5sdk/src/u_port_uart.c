@@ -82,6 +82,12 @@
  * We don't read from the Rx DMA buff until we get the ENDRX event from the
  * UARTE H/W. ENDRX event guarantees that the data is copied to Rx DMA buffer
  *
+ * The user is not told about each character though: every ENDRX restarts
+ * a TIMER which expires when the Rx line has been idle for
+ * U_PORT_UART_RX_IDLE_CHARACTERS, the nRF52 having no idle-line
+ * detection of its own, and only then is a
+ * U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED event sent, one per burst.
+ *
  * The key is NEVER to stop the UARTE HW, Any attempt to stop and restart the
  * UARTE ends up with character loss.
  */
@@ -111,6 +117,14 @@
 #define U_PORT_UART_TX_QUEUE_LENGTH 16
 #define U_PORT_UART_RX_DMA_LENGTH   1
 #define U_PORT_UART_TX_DMA_LENGTH   32
+
+#ifndef U_PORT_UART_RX_IDLE_CHARACTERS
+/** The number of character times for which the Rx line must be idle
+ * before the user is told that data has been received.
+ */
+# define U_PORT_UART_RX_IDLE_CHARACTERS 2
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -121,6 +135,7 @@
  */
 typedef struct {
     NRF_UARTE_Type *pReg;
+    nrfx_timer_t idleTimer;
     nrf_ppi_channel_t ppiChannel;
     bool hwfcSuspended;
     int32_t uartHandle;
@@ -139,6 +154,7 @@ typedef struct {
     uint32_t txBuffLen;
     uint32_t txWritten;
     bool bufferFull;
+    volatile bool rxNotifyPending;
     bool disableTxIrq;
     uPortSemaphoreHandle_t txSem;
     uPortQueueHandle_t txQueueHandle;
@@ -165,25 +181,28 @@ typedef struct {
 static uPortMutexHandle_t gMutex = NULL;
 
 // UART data, where the UARTE register and the
-// associated counter and PPI channel are the only
-// ones initialised here.
+// associated idle timer are the only ones initialised here.
 // In this implementation uart and handle are synonymous,
 // both are indexes into the gUartData array.
 #if !NRFX_UARTE0_ENABLED && !NRFX_UARTE1_ENABLED
 static uPortUartData_t gUartData[] = {
     {
         NRF_UARTE0,
+        NRFX_TIMER_INSTANCE(U_CFG_HW_UART_COUNTER_INSTANCE_0)
     },
     {
         NRF_UARTE1,
+        NRFX_TIMER_INSTANCE(U_CFG_HW_UART_COUNTER_INSTANCE_1)
     }
 };
 # else
 #  if !NRFX_UARTE0_ENABLED
 static uPortUartData_t gUartData[] = {NRF_UARTE0,
+                                      NRFX_TIMER_INSTANCE(U_CFG_HW_UART_COUNTER_INSTANCE_0)
                                      };
 #  else
 static uPortUartData_t gUartData[] = {NRF_UARTE1,
+                                      NRFX_TIMER_INSTANCE(U_CFG_HW_UART_COUNTER_INSTANCE_1)
                                      };
 #  endif
 #endif
@@ -261,6 +280,11 @@ static void uartClose(int32_t handle)
                                   NRF_UARTE_INT_ENDRX_MASK);
             NRFX_IRQ_DISABLE(nrfx_get_irq_number((void *) (pReg)));
 
+            // Stop the idle timer
+            nrfx_timer_disable(&gUartData[handle].idleTimer);
+            nrfx_timer_uninit(&gUartData[handle].idleTimer);
+            gUartData[handle].rxNotifyPending = false;
+
             // Make sure all transfers are finished before UARTE is
             // disabled to achieve the lowest power consumption
             nrf_uarte_event_clear(pReg, NRF_UARTE_EVENT_RXTO);
@@ -316,11 +340,55 @@ static void userNotify(uPortUartData_t *pUartData)
         uPortUartEvent_t event;
         event.uartHandle = pUartData->uartHandle;
         event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
-        uPortEventQueueSendIrq(pUartData->eventQueueHandle,
-                               &event, sizeof(event));
+        // Coalesced so that a burst of data cannot fill the queue
+        uPortEventQueueSendExtIrq(pUartData->eventQueueHandle,
+                                  &event, sizeof(event), 0, false);
     }
 }
 
+// Idle timer handler: the Rx line has been idle since the last
+// character arrived; this code is run in INTERRUPT CONTEXT.
+static void idleTimerHandler(nrf_timer_event_t eventType, void *pContext)
+{
+    uPortUartData_t *pUartData = (uPortUartData_t *) pContext;
+
+    if ((eventType == NRF_TIMER_EVENT_COMPARE0) &&
+        pUartData->rxNotifyPending) {
+        pUartData->rxNotifyPending = false;
+        userNotify(pUartData);
+    }
+}
+
+// Set up the idle timer of a UART, which is started by each
+// character received and stops itself when it expires; the
+// interrupt priority is the same as that of the UART so that
+// the two interrupt handlers never pre-empt one another.
+static bool idleTimerInit(uPortUartData_t *pUartData, int32_t baudRate)
+{
+    bool success = false;
+    nrfx_timer_config_t timerCfg = NRFX_TIMER_DEFAULT_CONFIG;
+    // Ten bits per character: start, eight data and stop
+    uint32_t idleTimeUs = ((U_PORT_UART_RX_IDLE_CHARACTERS * 10 * 1000000) / baudRate) + 1;
+
+    timerCfg.frequency = NRF_TIMER_FREQ_1MHz;
+    timerCfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+    timerCfg.interrupt_priority = NRFX_UARTE_DEFAULT_CONFIG_IRQ_PRIORITY;
+    timerCfg.p_context = pUartData;
+    if (nrfx_timer_init(&pUartData->idleTimer, &timerCfg,
+                        idleTimerHandler) == NRFX_SUCCESS) {
+        nrfx_timer_extended_compare(&pUartData->idleTimer, NRF_TIMER_CC_CHANNEL0,
+                                    nrfx_timer_us_to_ticks(&pUartData->idleTimer,
+                                                           idleTimeUs),
+                                    NRF_TIMER_SHORT_COMPARE0_STOP_MASK |
+                                    NRF_TIMER_SHORT_COMPARE0_CLEAR_MASK,
+                                    true);
+        pUartData->rxNotifyPending = false;
+        success = true;
+    }
+
+    return success;
+}
+
 static int32_t uartTxFifoFill(uPortUartData_t *pUartData, const uint8_t *pTxBuff, uint32_t len)
 {
     NRF_UARTE_Type *pReg = pUartData->pReg;
@@ -408,8 +476,20 @@ static void uartIrqHandler(uPortUartData_t *pUartData)
             }
 
             if (read) {
-                //signal the user to read
-                userNotify(pUartData);
+                if (pUartData->bufferFull) {
+                    // No point in waiting for the line to go idle,
+                    // signal the user to read now
+                    nrfx_timer_pause(&pUartData->idleTimer);
+                    nrfx_timer_clear(&pUartData->idleTimer);
+                    pUartData->rxNotifyPending = false;
+                    userNotify(pUartData);
+                } else {
+                    // Signal the user to read once the line has gone
+                    // idle: (re)start the idle timer from zero
+                    pUartData->rxNotifyPending = true;
+                    nrfx_timer_clear(&pUartData->idleTimer);
+                    nrfx_timer_resume(&pUartData->idleTimer);
+                }
             }
         }
     }
@@ -606,9 +686,13 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
             handleOrErrorCode = U_ERROR_COMMON_PLATFORM;
             pReg = gUartData[uart].pReg;
 
-            if (uPortQueueCreate(U_PORT_UART_TX_QUEUE_LENGTH,
-                                 sizeof(uartTxData_t),
-                                 &gUartData[uart].txQueueHandle) == U_ERROR_COMMON_SUCCESS) {
+            if (!idleTimerInit(&gUartData[uart], baudRate)) {
+                // Can't continue without the idle timer
+            } else if (uPortQueueCreate(U_PORT_UART_TX_QUEUE_LENGTH,
+                                        sizeof(uartTxData_t),
+                                        &gUartData[uart].txQueueHandle) != U_ERROR_COMMON_SUCCESS) {
+                nrfx_timer_uninit(&gUartData[uart].idleTimer);
+            } else {
                 handleOrErrorCode = U_ERROR_COMMON_SUCCESS;
 
                 // Malloc memory for the read buffer
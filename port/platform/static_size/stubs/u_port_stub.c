@@ -120,6 +120,14 @@ int32_t uPortTaskGetHandle(uPortTaskHandle_t *pTaskHandle)
     (void) pTaskHandle;
     return 0;
 }
+int32_t uPortTaskStatsGet(uPortTaskStats_t *pStats, size_t numStats,
+                          int64_t *pTotalRunTime)
+{
+    (void) pStats;
+    (void) numStats;
+    (void) pTotalRunTime;
+    return 0;
+}
 int32_t uPortQueueCreate(size_t queueLength,
                          size_t itemSizeBytes,
                          uPortQueueHandle_t *pQueueHandle)
@@ -588,6 +596,26 @@ int32_t uPortCryptoSha256(const char *pInput,
     (void) pOutput;
     return 0;
 }
+int32_t uPortCryptoMd5Init(void **ppContext)
+{
+    (void) ppContext;
+    return 0;
+}
+int32_t uPortCryptoMd5Update(void *pContext,
+                             const char *pInput,
+                             size_t inputLengthBytes)
+{
+    (void) pContext;
+    (void) pInput;
+    (void) inputLengthBytes;
+    return 0;
+}
+int32_t uPortCryptoMd5Finish(void *pContext, char *pOutput)
+{
+    (void) pContext;
+    (void) pOutput;
+    return 0;
+}
 int32_t uPortCryptoHmacSha256(const char *pKey,
                               size_t keyLengthBytes,
                               const char *pInput,
@@ -0,0 +1,292 @@
+#!/usr/bin/env python
+
+'''Report the flash/RAM budget of each module of ubxlib.'''
+
+import os
+import re
+import sys # For exit() and stderr
+import argparse
+import subprocess
+
+# This script combines two things to give a RAM/flash budget for
+# each module of ubxlib (cell, gnss, common/at_client, etc.):
+#
+# 1. The static flash and RAM of the module, obtained by running
+#    "size" on the object files of a static_size build (see the
+#    Makefile in this directory); flash is text + data, static RAM
+#    is data + bss.
+#
+# 2. The default values of the compile-time macros that govern the
+#    RAM the module takes at run-time: the stack sizes of the tasks
+#    it starts (any macro ending in _STACK_SIZE_BYTES) and the sizes
+#    of the buffers it allocates (any macro containing BUFFER and ending
+#    in _BYTES), found by searching the header files of the module for
+#    the usual:
+#
+#    #ifndef U_BLAH_STACK_SIZE_BYTES
+#    # define U_BLAH_STACK_SIZE_BYTES (1024 * 2)
+#    #endif
+#
+#    The values are worked out by substituting the other #defines of
+#    ubxlib and any given with -D; a value that cannot be worked out
+#    (e.g. because it depends on sizeof()) is shown as its expression.
+#
+# The stack and buffer columns are upper bounds: they assume that every
+# task and buffer of the module is in use at once, which is the case
+# that matters when dimensioning a part with little RAM.
+#
+# With --minimal_ram_header the script also writes a u_cfg_override.h
+# (the file that is #included when U_CFG_OVERRIDE is defined) listing
+# every such macro of the modules: the ones in MINIMAL_RAM below are
+# set to their reduced value and the rest are included, commented out,
+# at their default value, ready to be tuned.
+
+# Reduced values for a "minimal RAM" configuration, each with the
+# reason it is safe; only buffers whose required size is set by the
+# protocol, rather than by the platform, are reduced here, task
+# stacks are left alone since how much stack a task needs depends
+# on the platform.
+MINIMAL_RAM = {
+    "U_CELL_UART_BUFFER_LENGTH_BYTES": (1024, "holds a maximum length AT"
+                                        " socket packet; CMUX will flow"
+                                        " control more often"),
+    "U_GNSS_UART_BUFFER_LENGTH_BYTES": (512, "holds a few NAV-PVT messages;"
+                                        " too small if GNSS is reached"
+                                        " through CMUX"),
+    "U_GNSS_MSG_RING_BUFFER_LENGTH_BYTES": (1024, "holds a few long messages"
+                                            " if they are read promptly"),
+    "U_GNSS_LOG_BUFFER_LENGTH_BYTES": (2048, "four times the"
+                                       " U_GNSS_LOG_WRITE_LENGTH_BYTES below"),
+    "U_GNSS_LOG_WRITE_LENGTH_BYTES": (512, "a file system block or so"),
+    "U_CELL_LOC_BUFFER_LENGTH_BYTES": (256, "enough for a handful of"
+                                       " Wifi tags in AT+ULOCEXT"),
+    "U_SHORT_RANGE_AT_BUFFER_LENGTH_BYTES": (1024, "enough unless the Wifi"
+                                             " scan results of a"
+                                             " crowded area are needed"),
+}
+
+# Macros that are buffers but do not match the pattern
+BUFFERS_EXTRA = ["U_GNSS_LOG_WRITE_LENGTH_BYTES"]
+
+# Macros that match the pattern but are not RAM of ubxlib
+EXCLUDE = ["U_GNSS_MGA_RX_BUFFER_SIZE_BYTES"] # The receive buffer of the GNSS chip
+
+# The directories, off the ubxlib root, whose header files are
+# searched, each of which is a module: a directory under common is
+# a module of its own
+MODULE_DIRS = ["cell", "gnss", "ble", "wifi", "common", "port/api", "port/clib"]
+
+# The regex that finds a configurable macro, after line continuations
+# have been removed
+MACRO_CONFIGURABLE = re.compile(r"^\s*#\s*ifndef\s+(U_\w+)\s*$\n"
+                                r"(?:(?:\s*/\*.*?\*/\s*$\n)|(?:\s*//[^\n]*$\n))*"
+                                r"\s*#\s*define\s+\1[ \t]+([^\n]+)$",
+                                re.MULTILINE | re.DOTALL)
+
+# The regex that finds any simple #define
+MACRO_DEFINE = re.compile(r"^\s*#\s*define\s+(U_\w+)[ \t]+([^\n]+)$", re.MULTILINE)
+
+def module_get(path):
+    '''Return the module a file off the ubxlib root belongs to'''
+    parts = path.replace("\\", "/").split("/")
+    if parts[0] in ("common", "port") and len(parts) > 2:
+        return parts[0] + "/" + parts[1]
+    return parts[0]
+
+def header_read(file_path):
+    '''Return the text of a header file with comments on the end of
+    lines and line continuations removed'''
+    with open(file_path, "r", encoding="utf8", errors="replace") as file:
+        text = file.read()
+    text = text.replace("\\\n", " ")
+    return re.sub(r"[ \t]*//[^\n]*", "", text)
+
+def macros_find(ubxlib_dir):
+    '''Return the configurable macros, as a list of (module, name,
+    expression), and all of the simple #defines, as a dictionary'''
+    configurable = []
+    defines = {}
+    names = set()
+    for module_dir in MODULE_DIRS:
+        for root, _, files in os.walk(os.path.join(ubxlib_dir, module_dir)):
+            if os.sep + "test" in root:
+                continue
+            for file_name in sorted(files):
+                if not file_name.endswith(".h"):
+                    continue
+                file_path = os.path.join(root, file_name)
+                text = header_read(file_path)
+                for name, expression in MACRO_DEFINE.findall(text):
+                    defines.setdefault(name, expression.strip())
+                for name, expression in MACRO_CONFIGURABLE.findall(text):
+                    if (name.endswith("_STACK_SIZE_BYTES") or
+                        ("BUFFER" in name and name.endswith("_BYTES")) or
+                        name in BUFFERS_EXTRA) and \
+                       name not in EXCLUDE and name not in names:
+                        names.add(name)
+                        module = module_get(os.path.relpath(file_path, ubxlib_dir))
+                        configurable.append((module, name, expression.strip()))
+    return configurable, defines
+
+def evaluate(expression, defines, depth=0):
+    '''Return the integer value of an expression, else None'''
+    if depth > 20:
+        return None
+    for name in set(re.findall(r"\bU_\w+\b", expression)):
+        value = None
+        if name in defines:
+            value = evaluate(defines[name], defines, depth + 1)
+        if value is None:
+            return None
+        expression = re.sub(r"\b" + name + r"\b", str(value), expression)
+    # Remove integer suffixes and casts to integer types
+    expression = re.sub(r"\b(\d+)[uUlL]+\b", r"\1", expression)
+    expression = re.sub(r"\(\s*(?:u?int\d+_t|size_t|unsigned|int)\s*\)", "", expression)
+    if not re.fullmatch(r"[\d\s+\-*/%()<>]+", expression):
+        return None
+    try:
+        # C integer division
+        return int(eval(expression.replace("/", "//"))) # pylint: disable=eval-used
+    except (SyntaxError, ZeroDivisionError, TypeError):
+        return None
+
+def sizes_get(size, obj_dir):
+    '''Return a dictionary of [flash, static RAM] for each module,
+    taken from the object files in obj_dir'''
+    sizes = {}
+    obj_files = []
+    for root, _, files in os.walk(obj_dir):
+        obj_files += [os.path.join(root, name) for name in files if name.endswith(".o")]
+    if not obj_files:
+        print(f"No object files found in {obj_dir}.", file=sys.stderr)
+        sys.exit(1)
+    try:
+        output = subprocess.check_output([size] + sorted(obj_files), text=True)
+    except (OSError, subprocess.CalledProcessError) as ex:
+        print(f"Unable to run \"{size}\" ({ex}).", file=sys.stderr)
+        sys.exit(1)
+    # Berkeley format: text data bss dec hex filename
+    for line in output.splitlines()[1:]:
+        fields = line.split(None, 5)
+        if len(fields) == 6:
+            text, data, bss = (int(x) for x in fields[:3])
+            module = module_get(os.path.relpath(fields[5].strip(), obj_dir))
+            entry = sizes.setdefault(module, [0, 0])
+            entry[0] += text + data
+            entry[1] += data + bss
+    return sizes
+
+def minimal_ram_header_write(file_path, configurable, values):
+    '''Write a u_cfg_override.h for a minimal RAM configuration'''
+    lines = ["/* Generated by u_static_size_report.py: a \"minimal RAM\"",
+             " * configuration of ubxlib; build with U_CFG_OVERRIDE defined",
+             " * and this file on the include path.  Macros that are",
+             " * commented out are at their default value. */",
+             "",
+             "#ifndef _U_CFG_OVERRIDE_H_",
+             "#define _U_CFG_OVERRIDE_H_",
+             ""]
+    module_last = None
+    for module, name, expression in configurable:
+        if module != module_last:
+            lines.append(f"/* {module} */")
+            module_last = module
+        if name in MINIMAL_RAM:
+            value, reason = MINIMAL_RAM[name]
+            lines += [f"// {reason}, default {expression}",
+                      f"#define {name} {value}"]
+        else:
+            default = values[name] if values[name] is not None else expression
+            lines.append(f"// #define {name} {default}")
+        lines.append("")
+    lines += ["#endif // _U_CFG_OVERRIDE_H_", "", "// End of file", ""]
+    with open(file_path, "w", encoding="utf8") as file:
+        file.write("\n".join(lines))
+
+def main(ubxlib_dir, obj_dir, size, defines, verbose, minimal_ram_header):
+    '''Do the reporting'''
+    configurable, all_defines = macros_find(ubxlib_dir)
+    for define in defines:
+        name, _, value = define.partition("=")
+        all_defines[name] = value if value else "1"
+    values = {}
+    for _, name, expression in configurable:
+        values[name] = evaluate(all_defines.get(name, expression), all_defines)
+
+    sizes = {}
+    if obj_dir:
+        sizes = sizes_get(size, obj_dir)
+
+    # Sum the stacks and buffers of each module
+    budget = {}
+    for module, name, _ in configurable:
+        entry = budget.setdefault(module, [0, 0, []])
+        if values[name] is None:
+            entry[2].append(name)
+        elif name.endswith("_STACK_SIZE_BYTES"):
+            entry[0] += values[name]
+        else:
+            entry[1] += values[name]
+
+    modules = sorted(set(sizes.keys()) | set(budget.keys()))
+    if obj_dir:
+        # Only report the modules that were built
+        modules = [module for module in modules if module in sizes]
+    print(f"{'module':<24} {'flash':>8} {'static RAM':>11} {'stacks':>8} {'buffers':>8}")
+    totals = [0, 0, 0, 0]
+    for module in modules:
+        flash, ram = sizes.get(module, [None, None])
+        stacks, buffers, unknown = budget.get(module, [0, 0, []])
+        columns = [flash, ram, stacks, buffers]
+        text = [f"{x:>{w}}" if x is not None else f"{'-':>{w}}"
+                for x, w in zip(columns, [8, 11, 8, 8])]
+        print(f"{module:<24} " + " ".join(text) + ("  *" if unknown else ""))
+        for x, value in enumerate(columns):
+            if value is not None:
+                totals[x] += value
+    print(f"{'total':<24} {totals[0]:>8} {totals[1]:>11} {totals[2]:>8} {totals[3]:>8}")
+    print("All values are in bytes; stacks and buffers are the sum of the defaults,"
+          " assuming all are in use.")
+    if any(budget.get(module, [0, 0, []])[2] for module in modules):
+        print("* has macros whose value could not be worked out, use --verbose to see them.")
+
+    if verbose:
+        for module in modules:
+            for macro_module, name, expression in configurable:
+                if macro_module == module:
+                    value = values[name]
+                    print(f"{module:<24} {name:<56} "
+                          f"{value if value is not None else expression}")
+
+    if minimal_ram_header:
+        minimal_ram_header_write(minimal_ram_header,
+                                 [x for x in configurable if x[0] in modules],
+                                 values)
+        print(f"Minimal RAM configuration written to {minimal_ram_header}.")
+
+if __name__ == "__main__":
+    PARSER = argparse.ArgumentParser(description="A script to report the"     \
+                                     " flash, static RAM, task stacks and"    \
+                                     " buffers of each module of ubxlib.")
+    PARSER.add_argument("-u", "--ubxlib_dir",
+                        default=os.path.realpath(os.path.join(os.path.dirname(
+                            os.path.abspath(__file__)), "..", "..", "..")),
+                        help="the ubxlib root directory; if not given it is"     \
+                        " worked out from the location of this script.")
+    PARSER.add_argument("-o", "--obj_dir", help="the object directory of a"     \
+                        " static_size build, e.g. output/no_float/obj; if not"\
+                        " given only stacks and buffers are reported.")
+    PARSER.add_argument("-s", "--size", default="arm-none-eabi-size",
+                        help="the size executable; default arm-none-eabi-size.")
+    PARSER.add_argument("-D", "--define", action="append", default=[],
+                        help="a macro that the build overrides, e.g."          \
+                        " -D U_CELL_UART_BUFFER_LENGTH_BYTES=1024; may be given"\
+                        " more than once.")
+    PARSER.add_argument("-v", "--verbose", action="store_true",
+                        help="list the value of every stack and buffer macro.")
+    PARSER.add_argument("-m", "--minimal_ram_header", help="write a"            \
+                        " u_cfg_override.h for a minimal RAM configuration of"\
+                        " the reported modules to this file.")
+    ARGS = PARSER.parse_args()
+    main(ARGS.ubxlib_dir, ARGS.obj_dir, ARGS.size, ARGS.define, ARGS.verbose,
+         ARGS.minimal_ram_header)
@@ -1,28 +1,37 @@
-/*
- * Copyright 2019-2023 u-blox
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-
-
-#ifndef USER_MBEDTLS_CONFIG_H
-#define USER_MBEDTLS_CONFIG_H
-
-#undef MBEDTLS_SHA512_C
-#undef MBEDTLS_SHA1_C
-#undef MBEDTLS_SSL_PROTO_TLS1
-#undef MBEDTLS_SSL_CBC_RECORD_SPLITTING
-#undef MBEDTLS_SSL_PROTO_TLS1_1
-#undef MBEDTLS_RIPEMD160_C
-
-#endif /* USER_MBEDTLS_CONFIG_H */
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef USER_MBEDTLS_CONFIG_H
+#define USER_MBEDTLS_CONFIG_H
+
+#undef MBEDTLS_SHA512_C
+#undef MBEDTLS_SHA1_C
+#undef MBEDTLS_SSL_PROTO_TLS1
+#undef MBEDTLS_SSL_CBC_RECORD_SPLITTING
+#undef MBEDTLS_SSL_PROTO_TLS1_1
+#undef MBEDTLS_RIPEMD160_C
+
+#ifdef U_CFG_MBEDTLS_STM32_HW_CRYPTO
+/* Use the HASH and CRYP peripherals for SHA256 and AES, for those
+ * STM32F4 parts which have them; the sha256_alt.c and aes_alt.c
+ * files from STM32Cube must be added to the build: see the
+ * README.md in port/platform/common/mbedtls. */
+# define MBEDTLS_SHA256_ALT
+# define MBEDTLS_AES_ALT
+#endif
+
+#endif /* USER_MBEDTLS_CONFIG_H */
@@ -16,6 +16,10 @@ PLATFORM_PATH = $(UBXLIB_BASE)/platform/stm32cube/mcu/stm32f4
 UBXLIB_SRC += \
 	$(UBXLIB_BASE)/port/clib/u_port_clib_mktime64.c \
 	$(UBXLIB_BASE)/port/u_port_timezone.c \
+	$(UBXLIB_BASE)/port/u_port_uart_async.c \
+	$(UBXLIB_BASE)/port/u_port_bus_async.c \
+	$(UBXLIB_BASE)/port/u_port_atomic.c \
+	$(UBXLIB_BASE)/port/u_port_log_deferred.c \
 	$(UBXLIB_BASE)/port/platform/common/mbedtls/u_port_crypto.c \
 	$(PLATFORM_PATH)/src/u_port_debug.c \
 	$(PLATFORM_PATH)/src/u_port_gpio.c \
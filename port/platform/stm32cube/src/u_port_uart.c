@@ -634,8 +634,9 @@ static inline void dataIrqHandler(uPortUartData_t *pUartData,
         uPortUartEvent_t event;
         event.uartHandle = pUartData->uartHandle;
         event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
-        uPortEventQueueSendIrq(pUartData->eventQueueHandle,
-                               &event, sizeof(event));
+        // Coalesced so that a burst of data cannot fill the queue
+        uPortEventQueueSendExtIrq(pUartData->eventQueueHandle,
+                                  &event, sizeof(event), 0, false);
     }
 }
 
@@ -33,6 +33,8 @@
 #include "u_error_common.h"
 
 #include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_port_crypto.h"
 
 /* ----------------------------------------------------------------
@@ -43,6 +45,15 @@
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The context of a SHA256 or HMAC SHA256 calculation supplied
+ * in pieces.
+ */
+typedef struct {
+    BCRYPT_ALG_HANDLE algorithmHandle;
+    BCRYPT_HASH_HANDLE hashHandle;
+    size_t outputLengthBytes;
+} uPortCryptoHashContext_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -51,6 +62,79 @@
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Begin a hash calculation with the given algorithm, HMAC if pKey
+// is not NULL, on data supplied in pieces.
+static int32_t hashInit(void **ppContext, LPCWSTR pAlgorithm,
+                        size_t outputLengthBytes,
+                        const char *pKey, size_t keyLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    uPortCryptoHashContext_t *pContext;
+
+    pContext = (uPortCryptoHashContext_t *) pUPortMalloc(sizeof(*pContext));
+    if (pContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+        pContext->algorithmHandle = NULL;
+        pContext->hashHandle = NULL;
+        pContext->outputLengthBytes = outputLengthBytes;
+        if (BCryptOpenAlgorithmProvider(&pContext->algorithmHandle,
+                                        pAlgorithm, NULL,
+                                        (pKey != NULL) ? BCRYPT_ALG_HANDLE_HMAC_FLAG : 0) >= 0) {
+            if (BCryptCreateHash(pContext->algorithmHandle, &pContext->hashHandle,
+                                 NULL, 0, (PUCHAR) pKey,
+                                 (pKey != NULL) ? keyLengthBytes : 0, 0) >= 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                *ppContext = pContext;
+            } else {
+                BCryptCloseAlgorithmProvider(pContext->algorithmHandle, 0);
+            }
+        }
+        if (errorCode != 0) {
+            uPortFree(pContext);
+        }
+    }
+
+    return errorCode;
+}
+
+// Add data to a hash calculation.
+static int32_t hashUpdate(void *pContext, const char *pInput,
+                          size_t inputLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((pContext != NULL) && ((pInput != NULL) || (inputLengthBytes == 0))) {
+        errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+        if (BCryptHashData(((uPortCryptoHashContext_t *) pContext)->hashHandle,
+                           (PBYTE) pInput, inputLengthBytes, 0) >= 0) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+    }
+
+    return errorCode;
+}
+
+// Complete a hash calculation, freeing the context.
+static int32_t hashFinish(void *pContext, char *pOutput)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortCryptoHashContext_t *pHashContext = (uPortCryptoHashContext_t *) pContext;
+
+    if (pHashContext != NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if ((pOutput != NULL) &&
+            (BCryptFinishHash(pHashContext->hashHandle, (PUCHAR) pOutput,
+                              (ULONG) pHashContext->outputLengthBytes, 0) < 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+        }
+        BCryptDestroyHash(pHashContext->hashHandle);
+        BCryptCloseAlgorithmProvider(pHashContext->algorithmHandle, 0);
+        uPortFree(pHashContext);
+    }
+
+    return errorCode;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -92,6 +176,62 @@ int32_t uPortCryptoSha256(const char *pInput,
     return errorCode;
 }
 
+// Begin a SHA256 calculation on data supplied in pieces.
+int32_t uPortCryptoSha256Init(void **ppContext)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (ppContext != NULL) {
+        errorCode = hashInit(ppContext, BCRYPT_SHA256_ALGORITHM,
+                             U_PORT_CRYPTO_SHA256_OUTPUT_LENGTH_BYTES,
+                             NULL, 0);
+    }
+
+    return errorCode;
+}
+
+// Add data to a SHA256 calculation.
+int32_t uPortCryptoSha256Update(void *pContext,
+                                const char *pInput,
+                                size_t inputLengthBytes)
+{
+    return hashUpdate(pContext, pInput, inputLengthBytes);
+}
+
+// Complete a SHA256 calculation.
+int32_t uPortCryptoSha256Finish(void *pContext, char *pOutput)
+{
+    return hashFinish(pContext, pOutput);
+}
+
+// Begin an MD5 calculation on data supplied in pieces.
+int32_t uPortCryptoMd5Init(void **ppContext)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (ppContext != NULL) {
+        errorCode = hashInit(ppContext, BCRYPT_MD5_ALGORITHM,
+                             U_PORT_CRYPTO_MD5_OUTPUT_LENGTH_BYTES,
+                             NULL, 0);
+    }
+
+    return errorCode;
+}
+
+// Add data to an MD5 calculation.
+int32_t uPortCryptoMd5Update(void *pContext,
+                             const char *pInput,
+                             size_t inputLengthBytes)
+{
+    return hashUpdate(pContext, pInput, inputLengthBytes);
+}
+
+// Complete an MD5 calculation.
+int32_t uPortCryptoMd5Finish(void *pContext, char *pOutput)
+{
+    return hashFinish(pContext, pOutput);
+}
+
 // Perform a HMAC SHA256 calculation on a block of data.
 int32_t uPortCryptoHmacSha256(const char *pKey,
                               size_t keyLengthBytes,
@@ -132,6 +272,36 @@ int32_t uPortCryptoHmacSha256(const char *pKey,
     return errorCode;
 }
 
+// Begin a HMAC SHA256 calculation on data supplied in pieces.
+int32_t uPortCryptoHmacSha256Init(void **ppContext,
+                                  const char *pKey,
+                                  size_t keyLengthBytes)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((ppContext != NULL) && (pKey != NULL)) {
+        errorCode = hashInit(ppContext, BCRYPT_SHA256_ALGORITHM,
+                             U_PORT_CRYPTO_SHA256_OUTPUT_LENGTH_BYTES,
+                             pKey, keyLengthBytes);
+    }
+
+    return errorCode;
+}
+
+// Add data to a HMAC SHA256 calculation.
+int32_t uPortCryptoHmacSha256Update(void *pContext,
+                                    const char *pInput,
+                                    size_t inputLengthBytes)
+{
+    return hashUpdate(pContext, pInput, inputLengthBytes);
+}
+
+// Complete a HMAC SHA256 calculation.
+int32_t uPortCryptoHmacSha256Finish(void *pContext, char *pOutput)
+{
+    return hashFinish(pContext, pOutput);
+}
+
 // Perform AES 128 CBC encryption of a block of data.
 int32_t uPortCryptoAes128CbcEncrypt(const char *pKey,
                                     size_t keyLengthBytes,
@@ -250,6 +250,16 @@ int32_t uPortTaskGetHandle(uPortTaskHandle_t *pTaskHandle)
     return (int32_t) errorCode;
 }
 
+// Get the statistics of all tasks.
+int32_t uPortTaskStatsGet(uPortTaskStats_t *pStats, size_t numStats,
+                          int64_t *pTotalRunTime)
+{
+    (void) pStats;
+    (void) numStats;
+    (void) pTotalRunTime;
+    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: QUEUES
  * -------------------------------------------------------------- */
@@ -577,13 +587,7 @@ int32_t uPortTimerStart(const uPortTimerHandle_t timerHandle)
 // Stop a timer.
 int32_t uPortTimerStop(const uPortTimerHandle_t timerHandle)
 {
-    int32_t errroCode = (int32_t) U_ERROR_COMMON_PLATFORM;
-
-    if (CancelWaitableTimer((HANDLE) timerHandle)) {
-        errroCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-    }
-
-    return errroCode;
+    return uPortPrivateTimerStop(timerHandle);
 }
 
 // Change a timer interval.
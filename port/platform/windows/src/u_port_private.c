@@ -58,11 +58,13 @@ uPortTaskHandle_t gMutexDebugWatchdogTaskHandle = NULL;
  */
 #define U_PORT_PRIVATE_QUEUE_HANDLE_MIN 1
 
-/** Macro to convert milliseconds into a Windows waitable timer
- * "due time" value; the "due time" is in nanoseconds and must be
- * negative to give a relative time.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+/** The flag to CreateWaitableTimerEx() which asks for a high
+ * resolution timer (Windows 10 1803 and later), in case the SDK
+ * in use is older than that.
  */
-#define U_PORT_PRIVATE_MS_TO_DUE_TIME(ms) (((int64_t) ms) * -10000)
+# define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
 
 #ifdef U_CFG_MUTEX_DEBUG
 /** Bypass mutex debug for lock: On Windows the functions
@@ -122,12 +124,15 @@ typedef struct uPortPrivateQueue_t {
 /** Type to hold timer information.
  */
 typedef struct uPortPrivateTimer_t {
-    uPortTimerHandle_t handle;
+    int64_t expiry100ns;  /**< expiry time, from timerNow100ns(), valid if active. */
+    uint32_t intervalMs;
+    bool periodic;
+    bool active;          /**< true if in the list of running timers. */
+    bool deleted;         /**< set if deleted while its callback is running. */
     pTimerCallback_t *pCallback;
     void *pCallbackParam;
-    LARGE_INTEGER dueTime;
-    uint32_t periodMs;
-    struct uPortPrivateTimer_t *pNext;
+    struct uPortPrivateTimer_t *pNextActive; /**< next in the list of running timers. */
+    struct uPortPrivateTimer_t *pNext;       /**< next in the list of all timers. */
 } uPortPrivateTimer_t;
 
 /** A structure that allows us to get at the mutex handle
@@ -171,6 +176,28 @@ static uPortMutexHandle_t gMutexTimer = NULL;
  */
 static uPortPrivateTimer_t *gpTimerList = NULL;
 
+/** A hook for the linked list of running timers, sorted by expiry.
+ */
+static uPortPrivateTimer_t *gpTimerActiveList = NULL;
+
+/** The timer whose callback is being called.
+ */
+static uPortPrivateTimer_t *gpTimerCallback = NULL;
+
+/** The single waitable timer which is set to the expiry of the
+ * first running timer, started when the first timer is created.
+ */
+static HANDLE gTimerHandle = NULL;
+
+/** The thread that waits on gTimerHandle and services all of
+ * the timers.
+ */
+static HANDLE gTimerThread = NULL;
+
+/** Flag to tell the timer thread to exit.
+ */
+static volatile bool gTimerThreadExit = false;
+
 /** Convert a local task priority value into a Windows one.
  */
 static const int32_t localToWinPriority[] = {-2,  // 0
@@ -360,71 +387,192 @@ static void queueRemove(int32_t handle)
  * STATIC FUNCTIONS: TIMERS
  * -------------------------------------------------------------- */
 
-// Find a timer in the list by handle (i.e. index) and return
-// a pointer to it.
+// Get a monotonic time in units of 100 nanoseconds, the unit
+// of a waitable timer due time.
+static int64_t timerNow100ns()
+{
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+
+    // Split the sum to avoid overflow
+    return ((counter.QuadPart / frequency.QuadPart) * 10000000) +
+           (((counter.QuadPart % frequency.QuadPart) * 10000000) / frequency.QuadPart);
+}
+
+// Find a timer in the list by handle and return a pointer to it.
 // gMutexTimer should be locked before this is called.
 static uPortPrivateTimer_t *pTimerFind(uPortTimerHandle_t handle)
 {
     uPortPrivateTimer_t *pTmp = gpTimerList;
 
-    while ((pTmp != NULL) && (pTmp->handle != handle)) {
+    while ((pTmp != NULL) && (pTmp != (uPortPrivateTimer_t *) handle)) {
         pTmp = pTmp->pNext;
     }
 
     return pTmp;
 }
 
-// Remove a timer from the list, freeing memory.
+// Set the waitable timer to the expiry of the first running
+// timer, or cancel it if there is none.
 // gMutexTimer should be locked before this is called.
-static void timerRemove(uPortTimerHandle_t handle)
+static void timerHandleSet()
 {
-    uPortPrivateTimer_t *pTimer = gpTimerList;
-    uPortPrivateTimer_t *pPrevious = NULL;
-
-    // Find the entry in the list
-    while ((pTimer != NULL) && (pTimer->handle != handle)) {
-        pPrevious = pTimer;
-        pTimer = pTimer->pNext;
-    }
-    if (pTimer != NULL) {
-        // Remove the entry from the list
-        if (pPrevious != NULL) {
-            pPrevious->pNext = pTimer->pNext;
-        } else {
-            // Must be at head
-            gpTimerList = pTimer->pNext;
+    LARGE_INTEGER dueTime;
+    int64_t now100ns;
+
+    if (gpTimerActiveList != NULL) {
+        // Use a relative due time (negative) as absolute ones
+        // are in system time, which may jump
+        now100ns = timerNow100ns();
+        dueTime.QuadPart = -1;
+        if (gpTimerActiveList->expiry100ns > now100ns) {
+            dueTime.QuadPart = now100ns - gpTimerActiveList->expiry100ns;
         }
-        // Free the entry
-        uPortFree(pTimer);
+        SetWaitableTimer(gTimerHandle, &dueTime, 0, NULL, NULL, false);
+    } else {
+        CancelWaitableTimer(gTimerHandle);
     }
 }
 
-// The timer expiry callback.
-static void timerCallback(LPVOID handle, DWORD dwTimerLowValue,
-                          DWORD dwTimerHighValue)
+// Remove a timer from the list of running timers.
+// gMutexTimer should be locked before this is called.
+static void timerActiveRemove(uPortPrivateTimer_t *pTimer)
 {
-    uPortPrivateTimer_t *pTimer;
-    pTimerCallback_t *pCallback = NULL;
-    void *pCallbackParam;
+    uPortPrivateTimer_t **ppTimer = &gpTimerActiveList;
 
-    if (gMutexTimer != NULL) {
+    while ((*ppTimer != NULL) && (*ppTimer != pTimer)) {
+        ppTimer = &((*ppTimer)->pNextActive);
+    }
+    if (*ppTimer != NULL) {
+        *ppTimer = pTimer->pNextActive;
+    }
+    pTimer->pNextActive = NULL;
+    pTimer->active = false;
+}
 
-        U_PORT_MUTEX_LOCK(gMutexTimer);
+// Add a timer to the list of running timers, in order of expiry
+// (after any with the same expiry).
+// gMutexTimer should be locked before this is called.
+static void timerActiveAdd(uPortPrivateTimer_t *pTimer)
+{
+    uPortPrivateTimer_t **ppTimer = &gpTimerActiveList;
 
-        pTimer = pTimerFind((uPortTimerHandle_t) handle);
-        if (pTimer != NULL) {
+    while ((*ppTimer != NULL) && ((*ppTimer)->expiry100ns <= pTimer->expiry100ns)) {
+        ppTimer = &((*ppTimer)->pNextActive);
+    }
+    pTimer->pNextActive = *ppTimer;
+    *ppTimer = pTimer;
+    pTimer->active = true;
+}
+
+// The thread that services all of the timers.
+static DWORD WINAPI timerThread(LPVOID pParam)
+{
+    uPortPrivateTimer_t *pTimer;
+    pTimerCallback_t *pCallback;
+    void *pCallbackParam;
+    int64_t now100ns;
+
+    (void) pParam;
+
+    while (!gTimerThreadExit) {
+        WaitForSingleObject(gTimerHandle, INFINITE);
+        // Not using U_PORT_MUTEX_LOCK()/U_PORT_MUTEX_UNLOCK() since
+        // the lock is released around each callback
+        uPortMutexLock(gMutexTimer);
+        now100ns = timerNow100ns();
+        while (!gTimerThreadExit && (gpTimerActiveList != NULL) &&
+               (gpTimerActiveList->expiry100ns <= now100ns)) {
+            pTimer = gpTimerActiveList;
+            timerActiveRemove(pTimer);
+            if (pTimer->periodic) {
+                // Re-add the timer before calling its callback, so
+                // that the callback may stop it; work from the previous
+                // expiry so that a periodic timer doesn't drift, unless
+                // we've fallen more than a period behind
+                pTimer->expiry100ns += (int64_t) pTimer->intervalMs * 10000;
+                if (pTimer->expiry100ns <= now100ns) {
+                    pTimer->expiry100ns = now100ns + ((int64_t) pTimer->intervalMs * 10000);
+                }
+                timerActiveAdd(pTimer);
+            }
             pCallback = pTimer->pCallback;
             pCallbackParam = pTimer->pCallbackParam;
+            gpTimerCallback = pTimer;
+            // Call the callback outside the lock so that the
+            // callback itself may call the timer API
+            uPortMutexUnlock(gMutexTimer);
+            if (pCallback != NULL) {
+                pCallback((uPortTimerHandle_t) pTimer, pCallbackParam);
+            }
+            uPortMutexLock(gMutexTimer);
+            gpTimerCallback = NULL;
+            if (pTimer->deleted) {
+                // Deleted while the callback was running
+                uPortFree(pTimer);
+            }
+            now100ns = timerNow100ns();
         }
+        timerHandleSet();
+        uPortMutexUnlock(gMutexTimer);
+    }
 
-        U_PORT_MUTEX_UNLOCK(gMutexTimer);
+    return 0;
+}
+
+// Start the thread that services the timers, if it is not
+// already running.
+// gMutexTimer should be locked before this is called.
+static int32_t timerThreadStart()
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
 
-        // Call the callback outside the locks so that the
-        // callback itself may call the timer API
-        if (pCallback != NULL) {
-            pCallback((uPortTimerHandle_t) handle, pCallbackParam);
+    if (gTimerHandle == NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+        // Ask for a high resolution timer, falling back to
+        // a normal one where that is not supported
+        gTimerHandle = CreateWaitableTimerEx(NULL, NULL,
+                                             CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                             TIMER_ALL_ACCESS);
+        if (gTimerHandle == NULL) {
+            gTimerHandle = CreateWaitableTimer(NULL, false, NULL);
+        }
+        if (gTimerHandle != NULL) {
+            gTimerThreadExit = false;
+            gTimerThread = CreateThread(NULL, 0, timerThread, NULL, 0, NULL);
+            if (gTimerThread != NULL) {
+                SetThreadPriority(gTimerThread, THREAD_PRIORITY_HIGHEST);
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            } else {
+                CloseHandle(gTimerHandle);
+                gTimerHandle = NULL;
+            }
         }
     }
+
+    return errorCode;
+}
+
+// Stop the thread that services the timers.
+// gMutexTimer should NOT be locked when this is called.
+static void timerThreadStop()
+{
+    LARGE_INTEGER dueTime;
+
+    if (gTimerHandle != NULL) {
+        gTimerThreadExit = true;
+        // Make the timer expire now to wake the thread up
+        dueTime.QuadPart = -1;
+        SetWaitableTimer(gTimerHandle, &dueTime, 0, NULL, NULL, false);
+        WaitForSingleObject(gTimerThread, INFINITE);
+        CloseHandle(gTimerThread);
+        gTimerThread = NULL;
+        CloseHandle(gTimerHandle);
+        gTimerHandle = NULL;
+    }
 }
 
 /* ----------------------------------------------------------------
@@ -503,12 +651,15 @@ int32_t uPortPrivateInit(void)
 void uPortPrivateDeinit(void)
 {
     if (gMutexTimer != NULL) {
+        timerThreadStop();
         U_PORT_MUTEX_LOCK(gMutexTimer);
         // Tidy away the timers
         while (gpTimerList != NULL) {
-            CloseHandle((HANDLE) gpTimerList->handle);
-            timerRemove(gpTimerList->handle);
+            uPortPrivateTimer_t *pTimer = gpTimerList;
+            gpTimerList = pTimer->pNext;
+            uPortFree(pTimer);
         }
+        gpTimerActiveList = NULL;
         U_PORT_MUTEX_UNLOCK(gMutexTimer);
         uPortMutexDelete(gMutexTimer);
         gMutexTimer = NULL;
@@ -1138,47 +1289,31 @@ int32_t uPortPrivateTimerCreate(uPortTimerHandle_t *pHandle,
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uPortPrivateTimer_t *pTimer;
 
+    (void) pName;
+
     if (gMutexTimer != NULL) {
 
         U_PORT_MUTEX_LOCK(gMutexTimer);
 
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pHandle != NULL) {
-            // Allocate memory for the timer
-            pTimer = (uPortPrivateTimer_t *) pUPortMalloc(sizeof(uPortPrivateTimer_t));
-            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-            if (pTimer != NULL) {
-                // Create the timer
-                pTimer->handle = CreateWaitableTimer(NULL,   // Default security attributes
-                                                     false,  // No manual reset
-                                                     pName); // Name
-                if (pTimer->handle != NULL) {
-                    errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-                    if (GetLastError() != ERROR_ALREADY_EXISTS) {
-                        // Populate the rest of the timer entry and add
-                        // it to the front of the list
-                        pTimer->pCallback = pCallback;
-                        pTimer->pCallbackParam = pCallbackParam;
-                        // Convert the interval into a LARGE_INTEGER in Microsoft units
-                        pTimer->dueTime.QuadPart = U_PORT_PRIVATE_MS_TO_DUE_TIME(intervalMs);
-                        pTimer->periodMs = 0;
-                        // In case the timer is periodic, update periodic
-                        // interval in milliseconds.
-                        if (periodic) {
-                            pTimer->periodMs = intervalMs;
-                        }
-                        pTimer->pNext = gpTimerList;
-                        gpTimerList = pTimer;
-                        *pHandle = pTimer->handle;
-                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
-                    } else {
-                        // The name already exists: what we've got
-                        // back is the handle of another timer, which is
-                        // an error for us
-                        uPortFree(pTimer);
-                    }
-                } else {
-                    uPortFree(pTimer);
+            errorCode = timerThreadStart();
+            if (errorCode == 0) {
+                // Allocate memory for the timer
+                pTimer = (uPortPrivateTimer_t *) pUPortMalloc(sizeof(uPortPrivateTimer_t));
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                if (pTimer != NULL) {
+                    // Populate the timer entry and add it to the
+                    // front of the list
+                    memset(pTimer, 0, sizeof(*pTimer));
+                    pTimer->pCallback = pCallback;
+                    pTimer->pCallbackParam = pCallbackParam;
+                    pTimer->intervalMs = intervalMs;
+                    pTimer->periodic = periodic;
+                    pTimer->pNext = gpTimerList;
+                    gpTimerList = pTimer;
+                    *pHandle = (uPortTimerHandle_t) pTimer;
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                 }
             }
         }
@@ -1193,18 +1328,34 @@ int32_t uPortPrivateTimerCreate(uPortTimerHandle_t *pHandle,
 int32_t uPortPrivateTimerDelete(uPortTimerHandle_t handle)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortPrivateTimer_t **ppTimer;
+    uPortPrivateTimer_t *pTimer;
 
     if (gMutexTimer != NULL) {
 
-        // Close the timer in Windows, outside the mutex in case
-        // it blocks
-        CloseHandle((HANDLE) handle);
-
         U_PORT_MUTEX_LOCK(gMutexTimer);
 
-        // Remove the timer
-        timerRemove(handle);
-        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        ppTimer = &gpTimerList;
+        while ((*ppTimer != NULL) && (*ppTimer != (uPortPrivateTimer_t *) handle)) {
+            ppTimer = &((*ppTimer)->pNext);
+        }
+        if (*ppTimer != NULL) {
+            pTimer = *ppTimer;
+            *ppTimer = pTimer->pNext;
+            if (pTimer->active) {
+                timerActiveRemove(pTimer);
+                timerHandleSet();
+            }
+            if (pTimer == gpTimerCallback) {
+                // The timer thread is in the callback of this
+                // timer: it will do the freeing
+                pTimer->deleted = true;
+            } else {
+                uPortFree(pTimer);
+            }
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
 
         U_PORT_MUTEX_UNLOCK(gMutexTimer);
     }
@@ -1217,8 +1368,6 @@ int32_t uPortPrivateTimerStart(const uPortTimerHandle_t handle)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uPortPrivateTimer_t *pTimer;
-    LARGE_INTEGER dueTime;
-    uint32_t periodMs;
 
     if (gMutexTimer != NULL) {
 
@@ -1227,32 +1376,50 @@ int32_t uPortPrivateTimerStart(const uPortTimerHandle_t handle)
         pTimer = pTimerFind(handle);
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pTimer != NULL) {
-            dueTime = pTimer->dueTime;
-            periodMs = pTimer->periodMs;
+            if (pTimer->active) {
+                timerActiveRemove(pTimer);
+            }
+            pTimer->expiry100ns = timerNow100ns() + ((int64_t) pTimer->intervalMs * 10000);
+            timerActiveAdd(pTimer);
+            timerHandleSet();
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexTimer);
+    }
+
+    return errorCode;
+}
+
+// Stop a timer.
+int32_t uPortPrivateTimerStop(const uPortTimerHandle_t handle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortPrivateTimer_t *pTimer;
+
+    if (gMutexTimer != NULL) {
 
-        // Start the timer outside the locks in case the call blocks
+        U_PORT_MUTEX_LOCK(gMutexTimer);
+
+        pTimer = pTimerFind(handle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pTimer != NULL) {
-            errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
-            // Activate timer. In case of failure, return value is zero.
-            if (SetWaitableTimer((HANDLE) handle,  // Handle of timer
-                                 &dueTime,         // Expiration interval in Microsoft weird units
-                                 periodMs,         // Periodic expiration interval in milliseconds
-                                 (PTIMERAPCROUTINE) timerCallback, // Callback function called at expiration
-                                 // interval has passed
-                                 handle,           // Parameter to be passed to callback function
-                                 true)) {          // Restore system from power save on timer expiry
-                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            if (pTimer->active) {
+                timerActiveRemove(pTimer);
+                timerHandleSet();
             }
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
         }
+
+        U_PORT_MUTEX_UNLOCK(gMutexTimer);
     }
 
     return errorCode;
 }
 
-// Change a timer interval.
+// Change a timer interval; a running timer keeps its current
+// expiry time, the new interval applying from its next start
+// or, if it is periodic, its next reload.
 int32_t uPortPrivateTimerChange(const uPortTimerHandle_t handle,
                                 uint32_t intervalMs)
 {
@@ -1266,11 +1433,7 @@ int32_t uPortPrivateTimerChange(const uPortTimerHandle_t handle,
         pTimer = pTimerFind(handle);
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pTimer != NULL) {
-            pTimer->dueTime.QuadPart =  U_PORT_PRIVATE_MS_TO_DUE_TIME(intervalMs);
-            // If the timer was periodic then update that entry also
-            if (pTimer->periodMs > 0) {
-                pTimer->periodMs = intervalMs;
-            }
+            pTimer->intervalMs = intervalMs;
             errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
         }
 
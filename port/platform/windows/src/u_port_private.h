@@ -212,6 +212,13 @@ int32_t uPortPrivateTimerDelete(const uPortTimerHandle_t handle);
  */
 int32_t uPortPrivateTimerStart(const uPortTimerHandle_t handle);
 
+/** Stop a timer.
+ *
+ * @param handle  the handle of the timer.
+ * @return        zero on success else negative error code.
+ */
+int32_t uPortPrivateTimerStop(const uPortTimerHandle_t handle);
+
 /** Change a timer interval.
  *
  * @param handle       the handle of the timer.
@@ -57,15 +57,20 @@
 #endif
 
 #ifndef U_PORT_UART_READ_TIMEOUT_MS
-/** The read timeout to set on the COM ports.
+/** The read timeout to set on the COM ports: an overlapped read is
+ * always outstanding and completes as soon as any character arrives,
+ * this is only how long it may wait for the first character before
+ * completing empty and being re-issued, so it has no effect on
+ * latency; must be less than MAXDWORD.
  */
-# define U_PORT_UART_READ_TIMEOUT_MS 50
+# define U_PORT_UART_READ_TIMEOUT_MS 1000
 #endif
 
-#ifndef U_PORT_UART_TIMER_POLL_TIME_MS
-/** Poll every 10 milliseconds to catch anything we might have missed.
+#ifndef U_PORT_UART_READ_ERROR_RETRY_MS
+/** How long to wait before trying again if a read fails outright,
+ * e.g. because a USB serial device has been unplugged.
  */
-# define U_PORT_UART_TIMER_POLL_TIME_MS 10
+# define U_PORT_UART_READ_ERROR_RETRY_MS 100
 #endif
 
 /* ----------------------------------------------------------------
@@ -80,9 +85,12 @@ typedef struct uPortUartData_t {
     bool markedForDeletion;
     char nameStr[U_PORT_UART_MAX_COM_PORT_NAME_BUFFER_LENGTH];
     HANDLE windowsUartHandle;
-    HANDLE waitCommEventThreadHandle;
-    HANDLE waitCommEventThreadReadyHandle;
-    HANDLE waitCommEventThreadTerminateHandle;
+    HANDLE rxThreadHandle;
+    HANDLE rxThreadReadyHandle;
+    HANDLE rxThreadTerminateHandle;
+    HANDLE rxSpaceHandle; /**< signalled by uPortUartRead() when rxBufferFull. */
+    volatile bool rxBufferFull;
+    HANDLE txEventHandle;
     bool rxBufferIsMalloced;
     size_t rxBufferSizeBytes;
     char *pRxBufferStart;
@@ -171,9 +179,11 @@ static uPortUartData_t *pUartAdd()
         pTmp->eventQueueHandle = -1;
         pTmp->uartHandle = -1;
         pTmp->windowsUartHandle = INVALID_HANDLE_VALUE;
-        pTmp->waitCommEventThreadHandle = INVALID_HANDLE_VALUE;
-        pTmp->waitCommEventThreadReadyHandle = INVALID_HANDLE_VALUE;
-        pTmp->waitCommEventThreadTerminateHandle = INVALID_HANDLE_VALUE;
+        pTmp->rxThreadHandle = INVALID_HANDLE_VALUE;
+        pTmp->rxThreadReadyHandle = INVALID_HANDLE_VALUE;
+        pTmp->rxThreadTerminateHandle = INVALID_HANDLE_VALUE;
+        pTmp->rxSpaceHandle = INVALID_HANDLE_VALUE;
+        pTmp->txEventHandle = INVALID_HANDLE_VALUE;
         pTmp->pNext = NULL;
         // Get the next UART handle
         x = gUartHandleNext;
@@ -230,13 +240,16 @@ static void uartRemove(const uPortUartData_t *pUartData)
 // !!! gMutex should NOT be locked when this is called !!!
 static void uartCloseRequiresMutex(uPortUartData_t *pUartData)
 {
-    // Set the terminate event and wait for the waitCommEvent
+    // Set the terminate event and wait for the receive
     // thread to exit
-    SetEvent(pUartData->waitCommEventThreadTerminateHandle);
-    WaitForSingleObject(pUartData->waitCommEventThreadHandle, INFINITE);
-    // Close the ready and terminate events
-    CloseHandle(pUartData->waitCommEventThreadReadyHandle);
-    CloseHandle(pUartData->waitCommEventThreadTerminateHandle);
+    SetEvent(pUartData->rxThreadTerminateHandle);
+    WaitForSingleObject(pUartData->rxThreadHandle, INFINITE);
+    CloseHandle(pUartData->rxThreadHandle);
+    // Close the events
+    CloseHandle(pUartData->rxThreadReadyHandle);
+    CloseHandle(pUartData->rxThreadTerminateHandle);
+    CloseHandle(pUartData->rxSpaceHandle);
+    CloseHandle(pUartData->txEventHandle);
     // Remove the callback if there is one
     if (pUartData->eventQueueHandle >= 0) {
         uPortEventQueueClose(pUartData->eventQueueHandle);
@@ -278,211 +291,165 @@ static void eventHandler(void *pParam, size_t paramLength)
     }
 }
 
-// Handle a UART event, called by waitCommEventThread().
-// Returns the system error code that the attempt to read the
-// UART results in, usually either:
-// ERROR_SUCCESS (0)
-// ERROR_TIMEOUT (1460)
-static DWORD handleThreadUartEvent(uPortUartData_t *pUartData,
-                                   DWORD uartEvent)
+// Work out how much linear space is free in the receive buffer of
+// a UART, i.e. how much may be read in one go at pRxBufferWrite.
+static DWORD rxSpaceGet(const uPortUartData_t *pUartData)
 {
-    uPortUartEvent_t event;
-    OVERLAPPED overlap;
-    DWORD bytesRead;
-    DWORD totalSize = 0;
-    DWORD lastErrorCode = -1;
-    const volatile char *pRxBufferRead;
+    const volatile char *pRxBufferRead = pUartData->pRxBufferRead;
     int32_t spaceAvailable;
 
-    if (uartEvent & EV_RXCHAR) {
-        // There's received data, go get it
-        memset(&overlap, 0, sizeof(overlap));
-        overlap.hEvent = CreateEvent(NULL, true, false, NULL);
-        if (overlap.hEvent != INVALID_HANDLE_VALUE) {
-            do {
-                // Work out how much linear space we have
-                // free in the buffer
-                pRxBufferRead = pUartData->pRxBufferRead;
-                if (pUartData->pRxBufferWrite >= pRxBufferRead) {
-                    //        |              rxBufferSizeBytes          |
-                    //        |---------------|-----------|----- X -----|
-                    //        ^               ^           ^
-                    //        |               |           |
-                    // pRxBufferStart pRxBufferRead pRxBufferWrite
-                    //
-                    // Write pointer is at or ahead of the read pointer,
-                    // bytes available, X, are from the write pointer
-                    // up to the end of the buffer but we also need to
-                    // make sure that wouldn't cause the pointers to
-                    // catch up
-                    spaceAvailable = pUartData->pRxBufferStart +
-                                     (pUartData->rxBufferSizeBytes) -
-                                     pUartData->pRxBufferWrite;
-                    if ((spaceAvailable > 0) &&
-                        (pRxBufferRead == pUartData->pRxBufferStart)) {
-                        spaceAvailable--;
-                    }
-                } else {
-                    //        |              rxBufferSizeBytes          |
-                    //        |---------------|-----X-----|-------------|
-                    //        ^               ^           ^
-                    //        |               |           |
-                    // pRxBufferStart pRxBufferWrite pRxBufferRead
-                    //
-                    // Write pointer is behind read, bytes available, X, is
-                    // simply the difference, -1 so that they don't catch up
-                    spaceAvailable = (pRxBufferRead - pUartData->pRxBufferWrite) - 1;
-                }
-
-                // Now read up to that amount of data or until
-                // we hit the read COMM timeout
-                bytesRead = 0;
-                lastErrorCode = ERROR_SUCCESS;
-                if (!ReadFile(pUartData->windowsUartHandle,
-                              pUartData->pRxBufferWrite,
-                              spaceAvailable, &bytesRead, &overlap)) {
-                    lastErrorCode = GetLastError();
-                    if (lastErrorCode == ERROR_IO_PENDING) {
-                        GetOverlappedResult(pUartData->windowsUartHandle,
-                                            &overlap, &bytesRead, true);
-                        lastErrorCode = GetLastError();
-                    }
-                }
-                // Move the write pointer on
-                pUartData->pRxBufferWrite += bytesRead;
-                totalSize += bytesRead;
-                if (pUartData->pRxBufferWrite >= pUartData->pRxBufferStart +
-                    pUartData->rxBufferSizeBytes) {
-                    pUartData->pRxBufferWrite = pUartData->pRxBufferStart;
-                }
-                // Keep reading while there is stuff to read
-            } while (bytesRead > 0);
-        } else {
-            lastErrorCode = GetLastError() ;
+    if (pUartData->pRxBufferWrite >= pRxBufferRead) {
+        //        |              rxBufferSizeBytes          |
+        //        |---------------|-----------|----- X -----|
+        //        ^               ^           ^
+        //        |               |           |
+        // pRxBufferStart pRxBufferRead pRxBufferWrite
+        //
+        // Write pointer is at or ahead of the read pointer,
+        // bytes available, X, are from the write pointer
+        // up to the end of the buffer but we also need to
+        // make sure that wouldn't cause the pointers to
+        // catch up
+        spaceAvailable = pUartData->pRxBufferStart +
+                         (pUartData->rxBufferSizeBytes) -
+                         pUartData->pRxBufferWrite;
+        if ((spaceAvailable > 0) &&
+            (pRxBufferRead == pUartData->pRxBufferStart)) {
+            spaceAvailable--;
         }
-
-        CloseHandle(overlap.hEvent);
+    } else {
+        //        |              rxBufferSizeBytes          |
+        //        |---------------|-----X-----|-------------|
+        //        ^               ^           ^
+        //        |               |           |
+        // pRxBufferStart pRxBufferWrite pRxBufferRead
+        //
+        // Write pointer is behind read, bytes available, X, is
+        // simply the difference, -1 so that they don't catch up
+        spaceAvailable = (pRxBufferRead - pUartData->pRxBufferWrite) - 1;
     }
 
-    if ((totalSize > 0) &&
-        (pUartData->eventQueueHandle >= 0)) {
-        // Call the user callback
-        event.uartHandle = pUartData->uartHandle;
-        event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
-        event.pEventCallback = pUartData->pEventCallback;
-        event.pEventCallbackParam = pUartData->pEventCallbackParam;
-        uPortEventQueueSend(pUartData->eventQueueHandle, &event, sizeof(event));
-    }
+    return (DWORD) spaceAvailable;
+}
 
-    return lastErrorCode;
+// Handle received data, called by rxThread() when a read has
+// completed: move the write pointer on and tell the user.
+static void rxHandle(uPortUartData_t *pUartData, DWORD bytesRead)
+{
+    uPortUartEvent_t event;
+
+    if (bytesRead > 0) {
+        // Move the write pointer on
+        pUartData->pRxBufferWrite += bytesRead;
+        if (pUartData->pRxBufferWrite >= pUartData->pRxBufferStart +
+            pUartData->rxBufferSizeBytes) {
+            pUartData->pRxBufferWrite = pUartData->pRxBufferStart;
+        }
+        if (pUartData->eventQueueHandle >= 0) {
+            // Call the user callback
+            event.uartHandle = pUartData->uartHandle;
+            event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
+            event.pEventCallback = pUartData->pEventCallback;
+            event.pEventCallbackParam = pUartData->pEventCallbackParam;
+            // Coalesced so that a burst of data cannot fill the queue
+            uPortEventQueueSendExt(pUartData->eventQueueHandle, &event,
+                                   sizeof(event), 0, false);
+        }
+    }
 }
 
-// Event thread used by all UARTs for COM events.
-static int32_t waitCommEventThread(void *pParam)
+// Receive thread, one per UART: keeps an overlapped read outstanding
+// on the COM port, straight into the receive buffer, so that it is
+// woken as soon as data arrives with no polling.  While the receive
+// buffer is full it waits instead for uPortUartRead() to make room.
+static int32_t rxThread(void *pParam)
 {
     uPortUartData_t *pUartData;
     OVERLAPPED overlap;
     int32_t uartHandle;
     HANDLE windowsUartHandle = INVALID_HANDLE_VALUE;
-    HANDLE windowsTimerHandle = INVALID_HANDLE_VALUE;
     HANDLE readyHandle = INVALID_HANDLE_VALUE;
-    LARGE_INTEGER timerDueTime;
-    HANDLE eventHandles[3];
-    DWORD uartEvent;
+    HANDLE eventHandles[2];
+    DWORD spaceAvailable;
+    DWORD bytesRead;
     DWORD x;
-    bool keepGoing = true;
+    bool keepGoing = false;
 
     if (gMutex != NULL) {
         // The parameter passed to us is actually the UART (non-windows) handle
         uartHandle = (int32_t) pParam;
-        for (size_t x = 0; x < sizeof(eventHandles) / sizeof(eventHandles[0]); x++) {
-            eventHandles[x] = INVALID_HANDLE_VALUE;
-        }
-
+        memset(&overlap, 0, sizeof(overlap));
         pUartData = pUartGetByHandle(uartHandle);
         if (pUartData != NULL) {
-            // First item in the array is the event thread terminate event,
+            // First item in the array is the terminate event,
             // don't want to miss that
-            eventHandles[0] = pUartData->waitCommEventThreadTerminateHandle;
-            // Need the ready handle
-            readyHandle = pUartData->waitCommEventThreadReadyHandle;
-            // Also need the Windows handle of the UART
+            eventHandles[0] = pUartData->rxThreadTerminateHandle;
+            readyHandle = pUartData->rxThreadReadyHandle;
             windowsUartHandle = pUartData->windowsUartHandle;
+            // The event that tells us a read has completed
+            overlap.hEvent = CreateEvent(NULL, true, false, NULL);
+            keepGoing = (overlap.hEvent != NULL);
         }
 
-        // Create an event to capture stuff going-on on the serial port
-        // The event is used by WaitCommEvent()
-        eventHandles[1] = CreateEvent(NULL, true, false, NULL);
-        if (eventHandles[1] != INVALID_HANDLE_VALUE) {
-            // Put the event into the overlap structure so that it can
-            // be passed to WaitCommEvent()
-            memset(&overlap, 0, sizeof(overlap));
-            overlap.hEvent = eventHandles[1];
-            // Finally, last in the array, add a timer that we can
-            // use to periodically poll the UART for received data
-            // in case we were unable to process any events (e.g.
-            // if our buffer was full at the time).
-            eventHandles[2] = CreateWaitableTimer(NULL, false, NULL);
-            if (eventHandles[2] != INVALID_HANDLE_VALUE) {
-                // Start the periodic timer, a relative timeout value
-                // that is in units of 100 nanosecond intervals in the future
-                timerDueTime.QuadPart = -U_PORT_UART_TIMER_POLL_TIME_MS * 10;
-                if (SetWaitableTimer(eventHandles[2], &timerDueTime,
-                                     U_PORT_UART_TIMER_POLL_TIME_MS, NULL, NULL, 0)) {
-                    // Now we can wait for events on those handles
-                    SetEvent(readyHandle);
-                    while (keepGoing) {
-                        if (WaitCommEvent(windowsUartHandle, &uartEvent, &overlap)) {
-                            // An event has already occurred, handle it
-                            // However, I have seen this return that there is a character
-                            // in the buffer and then any attempt to read the buffer result
-                            // in timeout, which means the code gets stuck here because
-                            // it never processes any of the events in the section below.
-                            // Hence if handleThreadUartEvent() doesn't return
-                            // ERROR_SUCCESS then we move to waiting on events
-                            x = handleThreadUartEvent(pUartData, uartEvent);
-                        } else {
-                            x = GetLastError();
-                        }
-                        if (x != ERROR_SUCCESS) {
-                            // WaitCommEvent will now signal us with the
-                            // eventHandles[1] flag when something has happened
-                            // while a terminate event might arrive on eventHandles[0]
-                            // and the periodic poll timer on eventHandles[2]
-                            x = WaitForMultipleObjectsEx(sizeof(eventHandles) / sizeof(eventHandles[0]),
-                                                         eventHandles,
-                                                         false, INFINITE, true);
-                            switch (x) {
-                                case WAIT_OBJECT_0 + 0:
-                                    // Terminate thread was signalled
-                                    keepGoing = false;
-                                    break;
-                                case WAIT_OBJECT_0 + 1:
-                                    // UART event was signaled, go get it
-                                    if (GetOverlappedResult(windowsUartHandle, &overlap, &uartEvent, true)) {
-                                        handleThreadUartEvent(pUartData, uartEvent);
-                                    }
-                                    break;
-                                case WAIT_OBJECT_0 + 2:
-                                    // Periodic timer has gone off, do a read
-                                    handleThreadUartEvent(pUartData, EV_RXCHAR);
-                                    break;
-                                default:
-                                    // Ignore and continue
-                                    break;
-                            }
-                        }
+        if (keepGoing) {
+            SetEvent(readyHandle);
+        }
+        while (keepGoing) {
+            spaceAvailable = rxSpaceGet(pUartData);
+            if (spaceAvailable == 0) {
+                // Flag that we need to be told when there is room,
+                // and check again in case uPortUartRead() made some
+                // before it could have seen the flag
+                pUartData->rxBufferFull = true;
+                spaceAvailable = rxSpaceGet(pUartData);
+                if (spaceAvailable == 0) {
+                    eventHandles[1] = pUartData->rxSpaceHandle;
+                    x = WaitForMultipleObjects(sizeof(eventHandles) / sizeof(eventHandles[0]),
+                                               eventHandles, false, INFINITE);
+                    if (x != WAIT_OBJECT_0 + 1) {
+                        // Terminate was signalled (or something is wrong)
+                        keepGoing = false;
                     }
+                    continue;
+                }
+            }
 
-                    // Stop the periodic timer
-                    CancelWaitableTimer(eventHandles[2]);
+            // Read whatever has arrived or, if nothing has,
+            // whatever arrives first
+            bytesRead = 0;
+            if (ReadFile(windowsUartHandle, (LPVOID) pUartData->pRxBufferWrite,
+                         spaceAvailable, &bytesRead, &overlap)) {
+                rxHandle(pUartData, bytesRead);
+            } else if (GetLastError() == ERROR_IO_PENDING) {
+                eventHandles[1] = overlap.hEvent;
+                x = WaitForMultipleObjects(sizeof(eventHandles) / sizeof(eventHandles[0]),
+                                           eventHandles, false, INFINITE);
+                if (x == WAIT_OBJECT_0 + 1) {
+                    if (GetOverlappedResult(windowsUartHandle, &overlap,
+                                            &bytesRead, false)) {
+                        rxHandle(pUartData, bytesRead);
+                    }
+                } else {
+                    // Terminate was signalled (or something is wrong):
+                    // cancel the read and let it complete before the
+                    // buffer or the OVERLAPPED structure go away
+                    CancelIoEx(windowsUartHandle, &overlap);
+                    GetOverlappedResult(windowsUartHandle, &overlap,
+                                        &bytesRead, true);
+                    keepGoing = false;
+                }
+            } else {
+                // The read failed outright: don't spin
+                if (WaitForSingleObject(eventHandles[0],
+                                        U_PORT_UART_READ_ERROR_RETRY_MS) != WAIT_TIMEOUT) {
+                    keepGoing = false;
                 }
             }
         }
 
-        // Close the waitable timer handle and the UART event handle
-        CloseHandle(eventHandles[2]);
-        CloseHandle(eventHandles[1]);
+        if (overlap.hEvent != NULL) {
+            CloseHandle(overlap.hEvent);
+        }
     }
 
     ExitThread(0);
@@ -619,38 +586,39 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
                             }
                             if (SetCommState(pUartData->windowsUartHandle, &dcb)) {
                                 // Set the timeouts: no timeout in the write case,
-                                // i.e. write is blocking, read timeout is set to
+                                // i.e. write is blocking; for read, this
+                                // combination means that a read returns at once
+                                // with whatever has been received or, if nothing
+                                // has, as soon as something is, or after
                                 // U_PORT_UART_READ_TIMEOUT_MS
                                 memset (&timeouts, 0, sizeof(timeouts));
                                 timeouts.ReadIntervalTimeout = MAXDWORD ;
                                 timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
                                 timeouts.ReadTotalTimeoutConstant = U_PORT_UART_READ_TIMEOUT_MS;
                                 if (SetCommTimeouts(pUartData->windowsUartHandle, &timeouts)) {
-                                    // Create an event that lets us know the WaitCom event
-                                    // thread is ready
-                                    pUartData->waitCommEventThreadReadyHandle = CreateEvent(NULL, true,
-                                                                                            false, NULL);
-                                    if (pUartData->waitCommEventThreadReadyHandle != INVALID_HANDLE_VALUE) {
-                                        // Create an event that can terminate our WaitCom event thread
-                                        pUartData->waitCommEventThreadTerminateHandle = CreateEvent(NULL,
-                                                                                                    true,
-                                                                                                    false,
-                                                                                                    NULL);
-                                        if (pUartData->waitCommEventThreadTerminateHandle != INVALID_HANDLE_VALUE) {
-                                            // Now mask-in the receive event flag as that's the only
-                                            // one we support/care about
-                                            if (SetCommMask(pUartData->windowsUartHandle, EV_RXCHAR)) {
-                                                // ...then create the WaitCom thread
-                                                pUartData->waitCommEventThreadHandle = CreateThread(NULL, 0,
-                                                                                                    (LPTHREAD_START_ROUTINE) waitCommEventThread,
-                                                                                                    (PVOID) pUartData->uartHandle,
-                                                                                                    0, NULL);
-                                                if (pUartData->waitCommEventThreadHandle != INVALID_HANDLE_VALUE) {
-                                                    U_ATOMIC_INCREMENT(&gResourceAllocCount);
-                                                    // Done!
-                                                    handleOrErrorCode = pUartData->uartHandle;
-                                                }
-                                            }
+                                    // Create the events: one that lets us know the
+                                    // receive thread is ready, one that terminates
+                                    // it, one that tells it there is room in the
+                                    // receive buffer (auto-reset) and one for writes
+                                    pUartData->rxThreadReadyHandle = CreateEvent(NULL, true, false, NULL);
+                                    pUartData->rxThreadTerminateHandle = CreateEvent(NULL, true, false, NULL);
+                                    pUartData->rxSpaceHandle = CreateEvent(NULL, false, false, NULL);
+                                    pUartData->txEventHandle = CreateEvent(NULL, true, false, NULL);
+                                    if ((pUartData->rxThreadReadyHandle != NULL) &&
+                                        (pUartData->rxThreadTerminateHandle != NULL) &&
+                                        (pUartData->rxSpaceHandle != NULL) &&
+                                        (pUartData->txEventHandle != NULL)) {
+                                        // ...then create the receive thread
+                                        pUartData->rxThreadHandle = CreateThread(NULL, 0,
+                                                                                 (LPTHREAD_START_ROUTINE) rxThread,
+                                                                                 (PVOID) pUartData->uartHandle,
+                                                                                 0, NULL);
+                                        if (pUartData->rxThreadHandle != NULL) {
+                                            U_ATOMIC_INCREMENT(&gResourceAllocCount);
+                                            // Done!
+                                            handleOrErrorCode = pUartData->uartHandle;
+                                        } else {
+                                            pUartData->rxThreadHandle = INVALID_HANDLE_VALUE;
                                         }
                                     }
                                 }
@@ -661,12 +629,15 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
 
                 if (handleOrErrorCode < 0) {
                     // Clean up
-                    if (pUartData->waitCommEventThreadHandle != INVALID_HANDLE_VALUE) {
-                        SetEvent(pUartData->waitCommEventThreadTerminateHandle);
-                        WaitForSingleObject(pUartData->waitCommEventThreadHandle, INFINITE);
+                    if (pUartData->rxThreadHandle != INVALID_HANDLE_VALUE) {
+                        SetEvent(pUartData->rxThreadTerminateHandle);
+                        WaitForSingleObject(pUartData->rxThreadHandle, INFINITE);
+                        CloseHandle(pUartData->rxThreadHandle);
                     }
-                    CloseHandle(pUartData->waitCommEventThreadReadyHandle);
-                    CloseHandle(pUartData->waitCommEventThreadTerminateHandle);
+                    CloseHandle(pUartData->rxThreadReadyHandle);
+                    CloseHandle(pUartData->rxThreadTerminateHandle);
+                    CloseHandle(pUartData->rxSpaceHandle);
+                    CloseHandle(pUartData->txEventHandle);
                     CloseHandle(pUartData->windowsUartHandle);
                     if (pUartData->rxBufferIsMalloced) {
                         uPortFree(pUartData->pRxBufferStart);
@@ -680,8 +651,8 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
     }
 
     if (handleOrErrorCode >= 0) {
-        // Wait for the WaitCom thread to be ready before continuing
-        WaitForSingleObject(pUartData->waitCommEventThreadReadyHandle, INFINITE);
+        // Wait for the receive thread to be ready before continuing
+        WaitForSingleObject(pUartData->rxThreadReadyHandle, INFINITE);
     }
 
     return (int32_t) handleOrErrorCode;
@@ -812,6 +783,11 @@ int32_t uPortUartRead(int32_t handle, void *pBuffer,
                     pUartData->pRxBufferRead += thisSize;
                 }
             }
+            if ((sizeOrErrorCode > 0) && pUartData->rxBufferFull) {
+                // There is room now, let the receive thread know
+                pUartData->rxBufferFull = false;
+                SetEvent(pUartData->rxSpaceHandle);
+            }
         }
 
         U_PORT_MUTEX_UNLOCK(gMutex);
@@ -839,18 +815,16 @@ int32_t uPortUartWrite(int32_t handle, const void *pBuffer,
             (pUartData != NULL) && !pUartData->markedForDeletion) {
             sizeOrErrorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
             memset(&overlap, 0, sizeof(overlap));
-            overlap.hEvent = CreateEvent(NULL, true, false, NULL);
-            if (overlap.hEvent != INVALID_HANDLE_VALUE) {
-                if (WriteFile(pUartData->windowsUartHandle, pBuffer,
-                              sizeBytes, &bytesWritten, &overlap) ||
-                    ((GetLastError() == ERROR_IO_PENDING) &&
-                     GetOverlappedResult(pUartData->windowsUartHandle,
-                                         &overlap, &bytesWritten, true))) {
-                    sizeOrErrorCode = (int32_t) bytesWritten;
-                }
+            // The event is created once with the UART, rather than
+            // on every write
+            overlap.hEvent = pUartData->txEventHandle;
+            if (WriteFile(pUartData->windowsUartHandle, pBuffer,
+                          sizeBytes, &bytesWritten, &overlap) ||
+                ((GetLastError() == ERROR_IO_PENDING) &&
+                 GetOverlappedResult(pUartData->windowsUartHandle,
+                                     &overlap, &bytesWritten, true))) {
+                sizeOrErrorCode = (int32_t) bytesWritten;
             }
-
-            CloseHandle(overlap.hEvent);
         }
 
         U_PORT_MUTEX_UNLOCK(gMutex);
@@ -1203,6 +1177,39 @@ void uPortUartCtsResume(int32_t handle)
     }
 }
 
+// Change the baud rate of an open UART.
+int32_t uPortUartSetBaudRate(int32_t handle, int32_t baudRate)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortUartData_t *pUartData = NULL;
+    DCB dcb;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pUartData = pUartGetByHandle(handle);
+        if ((pUartData != NULL) && (baudRate > 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+            memset(&dcb, 0, sizeof(dcb));
+            dcb.DCBlength = sizeof(DCB);
+            // Let anything already written go out at the old rate
+            FlushFileBuffers(pUartData->windowsUartHandle);
+            if (GetCommState(pUartData->windowsUartHandle, &dcb)) {
+                dcb.BaudRate = baudRate;
+                if (SetCommState(pUartData->windowsUartHandle, &dcb)) {
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return errorCode;
+}
+
 // Get the number of UART interfaces currently open.
 int32_t uPortUartResourceAllocCount()
 {
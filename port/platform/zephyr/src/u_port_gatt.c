@@ -88,6 +88,16 @@
 #define U_PORT_BLE_DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #endif
 
+#ifndef U_PORT_GATT_NOTIFY_STREAM_MAX_IN_FLIGHT
+/** @brief Maximum number of notifications of a stream handed to the
+ * Bluetooth stack at any one time, i.e. the most that can go out in
+ * one connection event. **/
+#define U_PORT_GATT_NOTIFY_STREAM_MAX_IN_FLIGHT 4
+#endif
+
+/** @brief The ATT header of a notification: opcode and handle. **/
+#define U_PORT_GATT_NOTIFY_HEADER_LENGTH_BYTES 3
+
 #define INVALID_HANDLE 0xffffffff
 
 /* ----------------------------------------------------------------
@@ -99,8 +109,23 @@ typedef struct {
     uPortGattSubscribeParams_t     *pUparams;
 } subscribeParams_t;
 
+typedef struct {
+    struct k_work                    work;
+    bool                             active;
+    int32_t                          connHandle;
+    const struct bt_gatt_attr       *pAttr;
+    const uint8_t                   *pData;
+    size_t                           length;
+    size_t                           offset;
+    atomic_t                         inFlight;
+    int32_t                          errorCode;
+    uPortGattNotifyStreamCallback_t  pCallback;
+    void                            *pCallbackParam;
+} notifyStream_t;
+
 typedef struct {
     struct bt_conn                *pConn;
+    notifyStream_t                 notifyStream;
     subscribeParams_t             *pOngoingSubscribe;
     mtuXchangeRespCallback_t       mtuXchangeCallback;
     void                          *discoveryCallback;
@@ -150,6 +175,10 @@ static int32_t startDiscovery(int32_t connHandle, const uPortGattUuid_t *pUuid,
                               void *callback, uint8_t type);
 static void gattXchangeMtuRsp(struct bt_conn *conn, uint8_t err,
                               struct bt_gatt_exchange_params *params);
+static const struct bt_gatt_attr *pFindValueAttr(const uPortGattCharacteristic_t *pChar);
+static void notifyStreamEnd(notifyStream_t *pStream, int32_t errorCode);
+static void notifyStreamComplete(struct bt_conn *conn, void *user_data);
+static void notifyStreamWork(struct k_work *pWork);
 
 /* ----------------------------------------------------------------
  * VARIABLES
@@ -382,6 +411,10 @@ static void gapDisconnected(struct bt_conn *conn, uint8_t reason)
         bt_conn_unref(conn);
         gCurrentConnections[connHandle].pConn = NULL;
         deleteAllSubscriptions(connHandle);
+        if (gCurrentConnections[connHandle].notifyStream.active) {
+            notifyStreamEnd(&(gCurrentConnections[connHandle].notifyStream),
+                            U_ERROR_COMMON_UNKNOWN);
+        }
         if (gAdvertising) {
             (void)bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), gScanResponseData, gAdvIndex);
         }
@@ -834,11 +867,126 @@ int32_t uPortGattExchangeMtu(int32_t connHandle, mtuXchangeRespCallback_t respCa
     return errorCode;
 }
 
+int32_t uPortGattMaximiseDataLength(int32_t connHandle)
+{
+    int32_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (validConnHandle(connHandle)) {
+#ifdef CONFIG_BT_USER_DATA_LEN_UPDATE
+        errorCode = U_ERROR_COMMON_UNKNOWN;
+        if (bt_conn_le_data_len_update(gCurrentConnections[connHandle].pConn,
+                                       BT_LE_DATA_LEN_PARAM_MAX) == 0) {
+            errorCode = U_ERROR_COMMON_SUCCESS;
+        }
+#else
+        errorCode = U_ERROR_COMMON_NOT_SUPPORTED;
+#endif
+    }
+
+    return errorCode;
+}
+
+// We are given a pointer to the porting layer characteristic struct
+// but we need to find the corresponding zephyr attribute in the attribute pool.
+static const struct bt_gatt_attr *pFindValueAttr(const uPortGattCharacteristic_t *pChar)
+{
+    struct bt_gatt_attr *pAtt = gAttrPool;
+
+    while ((pAtt != gpNextFreeAttr) && (pAtt->user_data != &(pChar->valueAtt))) {
+        pAtt++;
+    }
+
+    return (pAtt != gpNextFreeAttr) ? pAtt : NULL;
+}
+
+// Finish a notify stream and tell the user.
+static void notifyStreamEnd(notifyStream_t *pStream, int32_t errorCode)
+{
+    int32_t result = errorCode;
+
+    pStream->active = false;
+    if (result == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        result = (int32_t) pStream->length;
+    }
+    if (pStream->pCallback != NULL) {
+        pStream->pCallback(pStream->connHandle, result, pStream->pCallbackParam);
+    }
+}
+
+// Called by the Bluetooth stack when a notification of a stream
+// has been sent; carry on from the system work queue.
+static void notifyStreamComplete(struct bt_conn *conn, void *user_data)
+{
+    notifyStream_t *pStream = (notifyStream_t *) user_data;
+
+    (void) conn;
+    if (atomic_get(&(pStream->inFlight)) > 0) {
+        atomic_dec(&(pStream->inFlight));
+    }
+    if (pStream->active) {
+        k_work_submit(&(pStream->work));
+    }
+}
+
+// Hand as many fragments of a notify stream as are allowed to the
+// Bluetooth stack; runs on the system work queue, where the stack
+// does not wait for buffers, so a shortage of them just means that
+// the next completion will carry on.
+static void notifyStreamWork(struct k_work *pWork)
+{
+    notifyStream_t *pStream = CONTAINER_OF(pWork, notifyStream_t, work);
+    struct bt_conn *pConn;
+    struct bt_gatt_notify_params params;
+    size_t fragmentSize;
+    int32_t mtu;
+    int err = 0;
+
+    if (!pStream->active) {
+        return;
+    }
+    pConn = gCurrentConnections[pStream->connHandle].pConn;
+    mtu = (pConn != NULL) ? bt_gatt_get_mtu(pConn) : 0;
+    if (mtu <= U_PORT_GATT_NOTIFY_HEADER_LENGTH_BYTES) {
+        pStream->errorCode = U_ERROR_COMMON_UNKNOWN;
+    }
+    while ((pStream->errorCode == 0) && (pStream->offset < pStream->length) &&
+           (atomic_get(&(pStream->inFlight)) < U_PORT_GATT_NOTIFY_STREAM_MAX_IN_FLIGHT)) {
+        fragmentSize = pStream->length - pStream->offset;
+        if (fragmentSize > (size_t) (mtu - U_PORT_GATT_NOTIFY_HEADER_LENGTH_BYTES)) {
+            fragmentSize = (size_t) (mtu - U_PORT_GATT_NOTIFY_HEADER_LENGTH_BYTES);
+        }
+        memset(&params, 0, sizeof(params));
+        params.attr = pStream->pAttr;
+        params.data = pStream->pData + pStream->offset;
+        params.len = (uint16_t) fragmentSize;
+        params.func = notifyStreamComplete;
+        params.user_data = pStream;
+        atomic_inc(&(pStream->inFlight));
+        err = bt_gatt_notify_cb(pConn, &params);
+        if (err == 0) {
+            pStream->offset += fragmentSize;
+        } else {
+            atomic_dec(&(pStream->inFlight));
+            if ((err != -ENOMEM) || (atomic_get(&(pStream->inFlight)) == 0)) {
+                // Out of buffers with nothing in flight to
+                // free any up is as bad as any other error
+                pStream->errorCode = (err == -ENOMEM) ? U_ERROR_COMMON_NO_MEMORY :
+                                     U_ERROR_COMMON_UNKNOWN;
+            }
+            break;
+        }
+    }
+    if (((pStream->errorCode != 0) || (pStream->offset >= pStream->length)) &&
+        (atomic_get(&(pStream->inFlight)) == 0)) {
+        notifyStreamEnd(pStream, pStream->errorCode);
+    }
+}
+
 int32_t uPortGattNotify(int32_t connHandle, const uPortGattCharacteristic_t *pChar,
                         const void *data, uint16_t len)
 {
     int32_t returnValue = U_ERROR_COMMON_UNKNOWN;
-    struct bt_gatt_attr *pAtt = gAttrPool;
+    const struct bt_gatt_attr *pAtt;
 
     if (!validConnHandle(connHandle) || (pChar == NULL) || (data == NULL) || (len == 0)) {
         return U_ERROR_COMMON_INVALID_PARAMETER;
@@ -848,19 +996,51 @@ int32_t uPortGattNotify(int32_t connHandle, const uPortGattCharacteristic_t *pCh
         return returnValue;
     }
 
-    // We are given a pointer to the porting layer characteristic struct
-    // but we need to find the corresponding zephyr attribute in the attribute pool.
-    while ((pAtt != gpNextFreeAttr) && (pAtt->user_data != &(pChar->valueAtt))) {
-        pAtt++;
-    }
-
-    if (pAtt != gpNextFreeAttr) {
+    pAtt = pFindValueAttr(pChar);
+    if (pAtt != NULL) {
         returnValue = bt_gatt_notify(gCurrentConnections[connHandle].pConn, pAtt, data, len);
     }
 
     return returnValue;
 }
 
+int32_t uPortGattNotifyStream(int32_t connHandle, const uPortGattCharacteristic_t *pChar,
+                              const void *pData, size_t length,
+                              uPortGattNotifyStreamCallback_t pCallback,
+                              void *pCallbackParam)
+{
+    int32_t errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+    const struct bt_gatt_attr *pAtt;
+    notifyStream_t *pStream;
+
+    if (validConnHandle(connHandle) && (pChar != NULL) &&
+        (pData != NULL) && (length > 0)) {
+        errorCode = U_ERROR_COMMON_NOT_FOUND;
+        pAtt = pFindValueAttr(pChar);
+        if (pAtt != NULL) {
+            errorCode = U_ERROR_COMMON_BUSY;
+            pStream = &(gCurrentConnections[connHandle].notifyStream);
+            if (!pStream->active) {
+                k_work_init(&(pStream->work), notifyStreamWork);
+                pStream->connHandle = connHandle;
+                pStream->pAttr = pAtt;
+                pStream->pData = (const uint8_t *) pData;
+                pStream->length = length;
+                pStream->offset = 0;
+                atomic_set(&(pStream->inFlight), 0);
+                pStream->errorCode = 0;
+                pStream->pCallback = pCallback;
+                pStream->pCallbackParam = pCallbackParam;
+                pStream->active = true;
+                k_work_submit(&(pStream->work));
+                errorCode = U_ERROR_COMMON_SUCCESS;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
 static struct bt_conn *connectGapAsPeripheral(const bt_addr_le_t *peer, int32_t *pErrorCode)
 {
     struct bt_conn *pConn;
@@ -103,6 +103,14 @@ typedef struct {
     size_t stackSize;
     bool isAllocated;
 } uPortOsThreadInstance_t;
+
+/** Context for taskStatsCallback().
+ */
+typedef struct {
+    uPortTaskStats_t *pStats;
+    size_t numStats;
+    size_t count;
+} uPortOsTaskStatsContext_t;
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -197,6 +205,50 @@ static void freeThreadInstance(struct k_thread *threadPtr)
     }
 }
 
+// Callback for k_thread_foreach_unlocked(), used by uPortTaskStatsGet().
+static void taskStatsCallback(const struct k_thread *pThread, void *pUserData)
+{
+    uPortOsTaskStatsContext_t *pContext = (uPortOsTaskStatsContext_t *) pUserData;
+    uPortTaskStats_t *pStats;
+#ifdef CONFIG_THREAD_NAME
+    const char *pName;
+#endif
+#ifdef CONFIG_SCHED_THREAD_USAGE
+    k_thread_runtime_stats_t runtimeStats;
+#endif
+#ifdef CONFIG_THREAD_STACK_INFO
+    size_t unused = 0;
+#endif
+
+    if ((pContext->pStats != NULL) && (pContext->count < pContext->numStats)) {
+        pStats = pContext->pStats + pContext->count;
+        memset(pStats, 0, sizeof(*pStats));
+        pStats->taskHandle = (uPortTaskHandle_t) pThread;
+#ifdef CONFIG_THREAD_NAME
+        pName = k_thread_name_get((k_tid_t) pThread);
+        if (pName != NULL) {
+            strncpy(pStats->name, pName, sizeof(pStats->name) - 1);
+        }
+#endif
+        pStats->runTime = -1;
+#ifdef CONFIG_SCHED_THREAD_USAGE
+        if (k_thread_runtime_stats_get((k_tid_t) pThread, &runtimeStats) == 0) {
+            pStats->runTime = k_cyc_to_us_floor64(runtimeStats.execution_cycles);
+        }
+#endif
+        pStats->contextSwitches = -1;
+        pStats->stackMinFreeBytes = -1;
+#ifdef CONFIG_THREAD_STACK_INFO
+        if (k_thread_stack_space_get(pThread, &unused) == 0) {
+            pStats->stackMinFreeBytes = (int32_t) unused;
+        }
+#endif
+    }
+    if ((pContext->pStats == NULL) || (pContext->count < pContext->numStats)) {
+        pContext->count++;
+    }
+}
+
 
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: BUT ONES THAT SHOULD BE CALLED INTERNALLY ONLY
@@ -338,6 +390,36 @@ int32_t uPortTaskGetHandle(uPortTaskHandle_t *pTaskHandle)
     return (int32_t) errorCode;
 }
 
+// Get the statistics of all tasks.
+int32_t uPortTaskStatsGet(uPortTaskStats_t *pStats, size_t numStats,
+                          int64_t *pTotalRunTime)
+{
+    int32_t errorCodeOrNumber = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortOsTaskStatsContext_t context = {0};
+#ifdef CONFIG_SCHED_THREAD_USAGE
+    k_thread_runtime_stats_t runtimeStats;
+#endif
+
+    if ((pStats != NULL) || (numStats == 0)) {
+        context.pStats = pStats;
+        context.numStats = numStats;
+        // Unlocked since k_thread_stack_space_get() walks the
+        // stack, which would keep interrupts off for far too long
+        k_thread_foreach_unlocked(taskStatsCallback, &context);
+        errorCodeOrNumber = (int32_t) context.count;
+        if (pTotalRunTime != NULL) {
+            *pTotalRunTime = -1;
+#ifdef CONFIG_SCHED_THREAD_USAGE
+            if (k_thread_runtime_stats_all_get(&runtimeStats) == 0) {
+                *pTotalRunTime = k_cyc_to_us_floor64(runtimeStats.execution_cycles);
+            }
+#endif
+        }
+    }
+
+    return errorCodeOrNumber;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: QUEUES
  * -------------------------------------------------------------- */
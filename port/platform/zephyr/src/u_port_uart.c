@@ -20,6 +20,14 @@
  * target and the Linux/Posix versions: this is because the Zephyr
  * Linux/Posix platform does not support the interrupt-driven UART API;
  * interrupts are supported, just not that UART API.
+ *
+ * If CONFIG_UBXLIB_UART_ASYNC is set the Zephyr asynchronous UART API
+ * is used instead of the interrupt-driven one: received data is DMAed
+ * into one of two buffers of #U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES,
+ * alternately, and copied from there into the receive buffer, and the
+ * data to be sent is DMAed straight from the caller's buffer.  This
+ * keeps the CPU out of the way on a per-character basis, which is
+ * what is needed at high baud rates (e.g. 921600 to a cellular module).
  */
 
 #ifdef U_CFG_OVERRIDE
@@ -66,6 +74,36 @@
 #define U_PORT_UART_MAX_NUM 4
 #endif
 
+#ifdef CONFIG_UBXLIB_UART_ASYNC
+/** Use the asynchronous UART API.
+ */
+# define U_PORT_UART_ASYNC
+#endif
+
+#ifndef U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES
+/** The size of each of the two DMA buffers per UART used by the
+ * asynchronous UART API; when one is filled the DMA moves on to
+ * the other.  At 921600 bits/s 256 bytes takes around 2.8 ms to
+ * fill, which is how long the system has to hand over the next one.
+ */
+# define U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES 256
+#endif
+
+#ifndef U_PORT_UART_ASYNC_RX_TIMEOUT_US
+/** The inactivity time after which the asynchronous UART API
+ * hands over what it has received even though the DMA buffer is
+ * not yet full.
+ */
+# define U_PORT_UART_ASYNC_RX_TIMEOUT_US 1000
+#endif
+
+#ifndef U_PORT_UART_ASYNC_RX_DISABLE_WAIT_MS
+/** How long to wait for the asynchronous UART API to stop
+ * receiving when a UART is closed.
+ */
+# define U_PORT_UART_ASYNC_RX_DISABLE_WAIT_MS 100
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -85,7 +123,14 @@ typedef struct {
     int32_t bufferWrite;
     bool bufferFull;
     struct k_timer rxTimer;
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#if defined(U_PORT_UART_ASYNC)
+    uint8_t *pRxDmaBuffer; /**< two buffers of U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES. */
+    size_t rxDmaBufferNext; /**< the index of the buffer to hand over next. */
+    volatile bool rxStopped; /**< true if receive has been stopped, e.g. for lack of space. */
+    volatile bool closing;
+    struct k_sem rxDisabledSem;
+    struct k_sem txSem;
+#elif defined(CONFIG_UART_INTERRUPT_DRIVEN)
     struct uartData_t *pTxData;
     struct k_fifo fifoTxData;
     uint32_t txWritten;
@@ -150,9 +195,24 @@ static void eventHandler(void *pParam, size_t paramLength)
 // Note: gMutex should be locked before this is called.
 static void uartClose(int32_t handle)
 {
+#if defined(U_PORT_UART_ASYNC)
+    // Stop the DMA before the buffers it writes to are freed
+    gUartData[handle].closing = true;
+    if (!gUartData[handle].rxStopped &&
+        (uart_rx_disable(gUartData[handle].pDevice) == 0)) {
+        k_sem_take(&gUartData[handle].rxDisabledSem,
+                   K_MSEC(U_PORT_UART_ASYNC_RX_DISABLE_WAIT_MS));
+    }
+    uart_tx_abort(gUartData[handle].pDevice);
+    uart_callback_set(gUartData[handle].pDevice, NULL, NULL);
+    k_free(gUartData[handle].pRxDmaBuffer);
+    gUartData[handle].pRxDmaBuffer = NULL;
+#endif
     k_free(gUartData[handle].pBuffer);
     gUartData[handle].pBuffer = NULL;
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#if defined(U_PORT_UART_ASYNC)
+    // Done above
+#elif defined(CONFIG_UART_INTERRUPT_DRIVEN)
     uart_irq_rx_disable(gUartData[handle].pDevice);
     uart_irq_tx_disable(gUartData[handle].pDevice);
 #else
@@ -166,7 +226,7 @@ static void uartClose(int32_t handle)
     gUartData[handle].eventFilter = 0;
     gUartData[handle].pEventCallback = NULL;
     gUartData[handle].pEventCallbackParam = NULL;
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#if !defined(U_PORT_UART_ASYNC) && defined(CONFIG_UART_INTERRUPT_DRIVEN)
     gUartData[handle].pTxData = NULL;
     gUartData[handle].txWritten = 0;
 #endif
@@ -182,12 +242,141 @@ static void rxTimer(struct k_timer *timer_id)
         uPortUartEvent_t event;
         event.uartHandle = uart;
         event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
-        uPortEventQueueSendIrq(gUartData[uart].eventQueueHandle,
-                               &event, sizeof(event));
+        // Coalesced so that a burst of data cannot fill the queue
+        uPortEventQueueSendExtIrq(gUartData[uart].eventQueueHandle,
+                                  &event, sizeof(event), 0, false);
+    }
+}
+
+#if defined(U_PORT_UART_ASYNC)
+
+// Return the number of bytes free in the receive buffer.
+static size_t rxBufferFree(uPortUartData_t *pUartData)
+{
+    int32_t used;
+
+    if (pUartData->bufferFull) {
+        used = pUartData->receiveBufferSizeBytes;
+    } else {
+        used = pUartData->bufferWrite - pUartData->bufferRead;
+        if (used < 0) {
+            used += pUartData->receiveBufferSizeBytes;
+        }
+    }
+
+    return pUartData->receiveBufferSizeBytes - used;
+}
+
+// Return the next DMA buffer to hand over to the asynchronous UART API.
+static uint8_t *pRxDmaBufferNext(uPortUartData_t *pUartData)
+{
+    uint8_t *pBuffer = pUartData->pRxDmaBuffer +
+                       (pUartData->rxDmaBufferNext * U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES);
+
+    pUartData->rxDmaBufferNext = (pUartData->rxDmaBufferNext + 1) % 2;
+
+    return pBuffer;
+}
+
+// Start receiving with the asynchronous UART API.
+static int32_t rxStart(uPortUartData_t *pUartData)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+
+    pUartData->rxStopped = false;
+    if (uart_rx_enable(pUartData->pDevice, pRxDmaBufferNext(pUartData),
+                       U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES,
+                       U_PORT_UART_ASYNC_RX_TIMEOUT_US) == 0) {
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    } else {
+        pUartData->rxStopped = true;
+    }
+
+    return errorCode;
+}
+
+// Callback called by the asynchronous UART API, in interrupt context.
+static void uartAsyncCb(const struct device *pDevice,
+                        struct uart_event *pEvent,
+                        void *pUserData)
+{
+    int32_t uart = (int32_t) pUserData;
+    uPortUartData_t *pUartData = &(gUartData[uart]);
+    const uint8_t *pData;
+    size_t length;
+    size_t thisLength;
+
+    switch (pEvent->type) {
+        case UART_RX_RDY:
+            pData = pEvent->data.rx.buf + pEvent->data.rx.offset;
+            length = pEvent->data.rx.len;
+            // Only ask for a buffer's worth when there is room for
+            // it (see UART_RX_BUF_REQUEST) so this should always fit
+            if (length > rxBufferFree(pUartData)) {
+                length = rxBufferFree(pUartData);
+            }
+            while (length > 0) {
+                thisLength = pUartData->receiveBufferSizeBytes - pUartData->bufferWrite;
+                if (thisLength > length) {
+                    thisLength = length;
+                }
+                memcpy(pUartData->pBuffer + pUartData->bufferWrite, pData, thisLength);
+                pData += thisLength;
+                length -= thisLength;
+                pUartData->bufferWrite += thisLength;
+                pUartData->bufferWrite %= pUartData->receiveBufferSizeBytes;
+            }
+            if (pUartData->bufferWrite == pUartData->bufferRead) {
+                pUartData->bufferFull = true;
+            }
+            if ((pUartData->eventQueueHandle >= 0) &&
+                (pUartData->eventFilter & U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED)) {
+                uPortUartEvent_t event;
+                event.uartHandle = uart;
+                event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
+                // Coalesced so that a burst of data cannot fill the queue
+                uPortEventQueueSendExtIrq(pUartData->eventQueueHandle,
+                                          &event, sizeof(event), 0, false);
+            }
+            break;
+        case UART_RX_BUF_REQUEST:
+            // Only hand over the next buffer if what it may hold,
+            // plus what the current one may hold, will fit in the
+            // receive buffer; if not, receive stops once the current
+            // one is full, HW flow control holds off the far end,
+            // and uPortUartRead() will restart it
+            if (!pUartData->closing &&
+                (rxBufferFree(pUartData) >= U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES * 2)) {
+                uart_rx_buf_rsp(pDevice, pRxDmaBufferNext(pUartData),
+                                U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES);
+            }
+            break;
+        case UART_RX_DISABLED:
+            if (pUartData->closing) {
+                pUartData->rxStopped = true;
+                k_sem_give(&(pUartData->rxDisabledSem));
+            } else if (rxBufferFree(pUartData) >= U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES) {
+                // Disabled by an error (e.g. a break or framing
+                // error) or by running out of buffers while there
+                // was room, just carry on
+                rxStart(pUartData);
+            } else {
+                pUartData->rxStopped = true;
+            }
+            break;
+        case UART_TX_DONE:
+        case UART_TX_ABORTED:
+            k_sem_give(&(pUartData->txSem));
+            break;
+        default:
+            // Nothing to do for UART_RX_BUF_RELEASED, or for
+            // UART_RX_STOPPED, which will be followed by
+            // UART_RX_DISABLED
+            break;
     }
 }
 
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#elif defined(CONFIG_UART_INTERRUPT_DRIVEN)
 // uartCb called by the interrupt-based UART driver.
 static void uartCb(const struct device *uart, void *user_data)
 {
@@ -224,8 +413,9 @@ static void uartCb(const struct device *uart, void *user_data)
                         uPortUartEvent_t event;
                         event.uartHandle = i;
                         event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
-                        uPortEventQueueSendIrq(gUartData[i].eventQueueHandle,
-                                               &event, sizeof(event));
+                        // Coalesced so that a burst of data cannot fill the queue
+                        uPortEventQueueSendExtIrq(gUartData[i].eventQueueHandle,
+                                                  &event, sizeof(event), 0, false);
                     }
                     break;
                 } else {
@@ -298,8 +488,9 @@ static void pollTimer(struct k_timer *timer_id)
                 uPortUartEvent_t event;
                 event.uartHandle = uart;
                 event.eventBitMap = U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED;
-                uPortEventQueueSendIrq(gUartData[uart].eventQueueHandle,
-                                       &event, sizeof(event));
+                // Coalesced so that a burst of data cannot fill the queue
+                uPortEventQueueSendExtIrq(gUartData[uart].eventQueueHandle,
+                                          &event, sizeof(event), 0, false);
             }
         }
     }
@@ -309,7 +500,7 @@ static void pollTimer(struct k_timer *timer_id)
     }
 }
 
-#endif // #ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#endif // #if defined(U_PORT_UART_ASYNC)
 
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
@@ -420,8 +611,27 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
             if (gUartData[uart].pDevice != NULL) {
                 handleOrErrorCode = U_ERROR_COMMON_NO_MEMORY;
                 gUartData[uart].pBuffer = k_malloc(receiveBufferSizeBytes);
+#if defined(U_PORT_UART_ASYNC)
+                // The receive buffer must be big enough to take both
+                // DMA buffers or receive would never get going
+                gUartData[uart].pRxDmaBuffer = NULL;
+                if ((gUartData[uart].pBuffer != NULL) &&
+                    (receiveBufferSizeBytes >= U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES * 2)) {
+                    gUartData[uart].pRxDmaBuffer = k_malloc(U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES * 2);
+                }
+                if (gUartData[uart].pRxDmaBuffer == NULL) {
+                    k_free(gUartData[uart].pBuffer);
+                    gUartData[uart].pBuffer = NULL;
+                }
+#endif
                 if (gUartData[uart].pBuffer != NULL) {
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#if defined(U_PORT_UART_ASYNC)
+                    k_sem_init(&gUartData[uart].txSem, 0, 1);
+                    k_sem_init(&gUartData[uart].rxDisabledSem, 0, 1);
+                    gUartData[uart].rxDmaBufferNext = 0;
+                    gUartData[uart].rxStopped = true;
+                    gUartData[uart].closing = false;
+#elif defined(CONFIG_UART_INTERRUPT_DRIVEN)
                     k_sem_init(&gUartData[uart].txSem, 0, 1);
                     k_fifo_init(&gUartData[uart].fifoTxData);
                     gUartData[uart].pTxData = NULL;
@@ -448,7 +658,10 @@ int32_t uPortUartOpen(int32_t uart, int32_t baudRate,
                     // default values (8N1).
                     gUartData[uart].config.baudrate = baudRate;
                     uart_configure(gUartData[uart].pDevice, &gUartData[uart].config);
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#if defined(U_PORT_UART_ASYNC)
+                    uart_callback_set(gUartData[uart].pDevice, uartAsyncCb, (void *) uart);
+                    rxStart(&gUartData[uart]);
+#elif defined(CONFIG_UART_INTERRUPT_DRIVEN)
                     uart_irq_callback_user_data_set(gUartData[uart].pDevice, uartCb, NULL);
                     uart_irq_rx_enable(gUartData[uart].pDevice);
 #else
@@ -566,7 +779,12 @@ int32_t uPortUartRead(int32_t handle, void *pBuffer,
                 }
 
                 gUartData[handle].bufferFull = false;
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#if defined(U_PORT_UART_ASYNC)
+                if (gUartData[handle].rxStopped &&
+                    (rxBufferFree(&gUartData[handle]) >= U_PORT_UART_ASYNC_RX_BUFFER_SIZE_BYTES * 2)) {
+                    rxStart(&gUartData[handle]);
+                }
+#elif defined(CONFIG_UART_INTERRUPT_DRIVEN)
                 uart_irq_rx_enable(gUartData[handle].pDevice);
 #endif
             }
@@ -601,7 +819,17 @@ int32_t uPortUartWrite(int32_t handle, const void *pBuffer,
             // it or the CTS pin when configuring this UART
             // was wrong and it's not connected to the right
             // thing.
-#ifdef CONFIG_UART_INTERRUPT_DRIVEN
+#if defined(U_PORT_UART_ASYNC)
+            // Note: the nRF UARTE driver copies data that is not
+            // in RAM (e.g. a string constant) through a cache of
+            // its own before DMAing it
+            if (uart_tx(gUartData[handle].pDevice, (const uint8_t *) pBuffer,
+                        sizeBytes, SYS_FOREVER_US) == 0) {
+                k_sem_take(&gUartData[handle].txSem, K_FOREVER);
+            } else {
+                errorCode = U_ERROR_COMMON_PLATFORM;
+            }
+#elif defined(CONFIG_UART_INTERRUPT_DRIVEN)
             struct uartData_t data;
             data.handle = handle;
             data.pData = (void *)pBuffer;
@@ -917,6 +1145,38 @@ void uPortUartCtsResume(int32_t handle)
     (void) handle;
 }
 
+// Change the baud rate of an open UART.
+int32_t uPortUartSetBaudRate(int32_t handle, int32_t baudRate)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uint32_t oldBaudRate;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((handle >= 0) &&
+            (handle < sizeof(gUartData) / sizeof(gUartData[0])) &&
+            (gUartData[handle].pDevice != NULL) &&
+            (baudRate > 0)) {
+            errorCode = (int32_t) U_ERROR_COMMON_PLATFORM;
+            oldBaudRate = gUartData[handle].config.baudrate;
+            gUartData[handle].config.baudrate = baudRate;
+            if (uart_configure(gUartData[handle].pDevice,
+                               &gUartData[handle].config) == 0) {
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            } else {
+                gUartData[handle].config.baudrate = oldBaudRate;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return errorCode;
+}
+
 // Get the number of UART interfaces currently open.
 int32_t uPortUartResourceAllocCount()
 {
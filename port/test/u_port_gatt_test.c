@@ -1497,6 +1497,15 @@ U_PORT_TEST_FUNCTION("[portGatt]", "portGattServerConf")
         U_TEST_PRINT_LINE("uPortGattNotify() - data length = 0.");
         errorCode = uPortGattNotify(connHandle, &gSpsCreditsChar, &credits, 0);
         U_PORT_TEST_ASSERT_EQUAL(errorCode, (int32_t)U_ERROR_COMMON_INVALID_PARAMETER);
+        U_TEST_PRINT_LINE("uPortGattNotifyStream() - invalid parameters.");
+        errorCode = uPortGattNotifyStream(-1, &gSpsFifoChar, "abcd", 4, NULL, NULL);
+        U_PORT_TEST_ASSERT_EQUAL(errorCode, (int32_t)U_ERROR_COMMON_INVALID_PARAMETER);
+        errorCode = uPortGattNotifyStream(connHandle, NULL, "abcd", 4, NULL, NULL);
+        U_PORT_TEST_ASSERT_EQUAL(errorCode, (int32_t)U_ERROR_COMMON_INVALID_PARAMETER);
+        errorCode = uPortGattNotifyStream(connHandle, &gSpsFifoChar, NULL, 4, NULL, NULL);
+        U_PORT_TEST_ASSERT_EQUAL(errorCode, (int32_t)U_ERROR_COMMON_INVALID_PARAMETER);
+        errorCode = uPortGattNotifyStream(connHandle, &gSpsFifoChar, "abcd", 0, NULL, NULL);
+        U_PORT_TEST_ASSERT_EQUAL(errorCode, (int32_t)U_ERROR_COMMON_INVALID_PARAMETER);
 
         U_TEST_PRINT_LINE("notify credits to remote client.");
         errorCode = uPortGattNotify(connHandle, &gSpsCreditsChar, &credits, 1);
@@ -55,15 +55,12 @@
 #include "u_port_os.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
+#include "u_port_atomic.h"
 #include "u_port_gpio.h"
 //lint -esym(766, u_port_uart.h) Suppress not referenced, which will be the case if U_PORT_TEST_CHECK_TIME_TAKEN is defined
 #include "u_port_uart.h"
-#if (U_CFG_APP_GNSS_I2C >= 0)
-# include "u_port_i2c.h"
-#endif
-#if (U_CFG_APP_GNSS_SPI >= 0)
-# include "u_port_spi.h"
-#endif
+#include "u_port_i2c.h"
+#include "u_port_spi.h"
 #if (U_CFG_APP_GNSS_I2C >= 0) || (U_CFG_APP_GNSS_SPI >= 0)
 # include "u_ubx_protocol.h"
 #endif
@@ -73,6 +70,8 @@
 
 #include "u_assert.h"
 
+#include "u_time.h"
+
 #include "u_test_util_resource_check.h"
 
 #ifdef CONFIG_IRQ_OFFLOAD
@@ -123,6 +122,11 @@
  */
 #define U_PORT_TEST_OS_BLOCK_TIME_MS 5000
 
+/** The maximum number of tasks that the task statistics test will
+ * report on.
+ */
+#define U_PORT_TEST_OS_TASK_STATS_MAX_NUM 32
+
 #ifdef U_PORT_TEST_CHECK_TIME_TAKEN
 /** The guard time for the OS test.
  */
@@ -229,6 +233,28 @@
  */
 #define U_PORT_TEST_OS_EVENT_QUEUE_PARAM_MIN_SIZE_BYTES 4
 
+/** The number of events to send to the first event queue in the
+ * shared event queue test: more than the ready queue of the shared
+ * workers could hold if there were a token per event.
+ */
+#define U_PORT_TEST_EVENT_QUEUE_SHARED_NUM (U_PORT_EVENT_QUEUE_SHARED_READY_LENGTH + 8)
+
+/** The number of transactions to queue on each bus in the
+ * asynchronous I2C/SPI test: more than fit on the queue of a bus
+ * so that queueing has to wait for room.
+ */
+#define U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS 20
+
+/** The I2C handle to use in the asynchronous I2C/SPI test: no I2C
+ * instance is opened, it is the queueing that is being tested.
+ */
+#define U_PORT_TEST_BUS_ASYNC_I2C_HANDLE 3
+
+/** The SPI handle to use in the asynchronous I2C/SPI test: no SPI
+ * instance is opened, it is the queueing that is being tested.
+ */
+#define U_PORT_TEST_BUS_ASYNC_SPI_HANDLE 4
+
 #ifndef U_PORT_MALLOC_LENGTH_BYTES
 /** How much to allocate in the heap test; deliberately an odd size.
  */
@@ -287,6 +313,26 @@
 # define U_PORT_TEST_CRITICAL_SECTION_TEST_WAIT_LOOPS 1000000
 #endif
 
+#ifndef U_PORT_TEST_ATOMIC_NUM_TASKS
+/** The number of tasks that hammer on the same atomic variable
+ * during the atomics test.
+ */
+# define U_PORT_TEST_ATOMIC_NUM_TASKS 3
+#endif
+
+#ifndef U_PORT_TEST_ATOMIC_ITERATIONS
+/** The number of times each atomics test task adds to the
+ * atomic variable by each method.
+ */
+# define U_PORT_TEST_ATOMIC_ITERATIONS 10000
+#endif
+
+#ifndef U_PORT_TEST_ATOMIC_TIMEOUT_SECONDS
+/** How long to wait for the atomics test tasks to finish.
+ */
+# define U_PORT_TEST_ATOMIC_TIMEOUT_SECONDS 30
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -374,6 +420,45 @@ static int32_t gEventQueueMinErrorFlag;
 // Counter for event queue callback min length
 static int32_t gEventQueueMinCounter;
 
+// The order in which events arrived at eventQueueOrderFunction().
+static volatile uint8_t gEventQueueOrder[8];
+
+// Counter for eventQueueOrderFunction().
+static volatile int32_t gEventQueueOrderCounter;
+
+// Set to true to let eventQueueOrderFunction() carry on with
+// its first event.
+static volatile bool gEventQueueOrderGo;
+
+// Handles of the three event queues of the shared event queue test.
+static int32_t gEventQueueSharedHandle[3];
+
+// Counters for eventQueueSharedFunction(), one per event queue.
+static volatile int32_t gEventQueueSharedCounter[3];
+
+// Set to true to let eventQueueSharedFunction() carry on with
+// the first event on the first event queue.
+static volatile bool gEventQueueSharedGo;
+
+// Set to true by eventQueueSharedFunction() if it finds something
+// wrong.
+static volatile bool gEventQueueSharedErrorFlag;
+
+// The order in which transactions completed at busAsyncCallback(),
+// I2C at index 0 and SPI at index 1.
+static volatile uint8_t gBusAsyncOrder[2][U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS];
+
+// Counter for busAsyncCallback(), I2C at index 0 and SPI at index 1.
+static volatile int32_t gBusAsyncCounter[2];
+
+// What busAsyncCallback() should be given as sizeOrErrorCode, I2C
+// at index 0 and SPI at index 1.
+static int32_t gBusAsyncExpected[2];
+
+// Set to true by busAsyncCallback() if it is given something
+// unexpected.
+static volatile bool gBusAsyncErrorFlag;
+
 #if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B < 0)
 
 // The data to send during UART testing.
@@ -445,7 +530,7 @@ static uPortTestTimeData_t timeTestData[] = {
     {{0,  0, 0,  1, 11, 70,  2, 334, 0}, 28857600},
     {{0,  0, 0, 13, 0,  70,  2,  12, 0}, 1036800},
     {{0,  0, 0,  1, 0, 137,  4,   0, 0}, 2114380800LL},
-    {{0,  0, 0,  1, 0, 150,  4,   0, 0}, 2524608000LL}
+    {{0,  0, 0,  1, 0, 150,  6,   0, 0}, 2524608000LL}   // A Saturday
 };
 
 /** SHA256 test vector, input, RC4.55 from:
@@ -511,6 +596,14 @@ static const char gAes128CbcEncrypted[] =
  */
 static int32_t gTimerParameterValue[4] = {0};
 
+/** Where the output of the deferred logging test is put.
+ */
+static char gLogDeferredBuffer[256];
+
+/** The amount of data in gLogDeferredBuffer.
+ */
+static size_t gLogDeferredBufferLength = 0;
+
 /** Index into the gTimerParameterValue array.
  */
 static size_t gTimerParameterIndex = 0;
@@ -528,6 +621,14 @@ static uint32_t gVariable = 0;
  */
 static void *gpMalloc = NULL;
 
+/** The variable added to by the atomics test tasks.
+ */
+static volatile int32_t gAtomicVariable = 0;
+
+/** The number of atomics test tasks that have finished.
+ */
+static volatile int32_t gAtomicTasksDone = 0;
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -923,8 +1024,111 @@ static void eventQueueMinFunction(void *pParam,
     gEventQueueMinCounter++;
 }
 
+// Event queue function which records the order that events arrive
+// in, holding on to the first one until gEventQueueOrderGo is set
+// so that the others can queue up behind it.
+static void eventQueueOrderFunction(void *pParam,
+                                    size_t paramLength)
+{
+    (void) paramLength;
+
+    if (gEventQueueOrderCounter == 0) {
+        while (!gEventQueueOrderGo) {
+            uPortTaskBlock(10);
+        }
+    }
+    if (gEventQueueOrderCounter < (int32_t) sizeof(gEventQueueOrder)) {
+        gEventQueueOrder[gEventQueueOrderCounter] = *((uint8_t *) pParam);
+    }
+    gEventQueueOrderCounter++;
+}
+
+// Event queue function for the shared event queue test: the first
+// byte of the parameter is the index of the event queue and the
+// second the number of the event, which must arrive in order.  The
+// first event queue holds on to its first event until
+// gEventQueueSharedGo is set and forwards each event to the second
+// event queue, from the shared worker.
+static void eventQueueSharedFunction(void *pParam,
+                                     size_t paramLength)
+{
+    uint8_t *pEvent = (uint8_t *) pParam;
+    size_t index = pEvent[0];
+
+    if ((paramLength != 2) || (index >= 3) ||
+        (pEvent[1] != (uint8_t) gEventQueueSharedCounter[index]) ||
+        !uPortEventQueueIsTask(gEventQueueSharedHandle[index])) {
+        gEventQueueSharedErrorFlag = true;
+    } else if (index == 0) {
+        if (pEvent[1] == 0) {
+            while (!gEventQueueSharedGo) {
+                uPortTaskBlock(10);
+            }
+        }
+        pEvent[0] = 1;
+        if (uPortEventQueueSend(gEventQueueSharedHandle[1], pEvent, 2) != 0) {
+            gEventQueueSharedErrorFlag = true;
+        }
+    }
+    gEventQueueSharedCounter[index]++;
+}
+
+// Callback for the end of an asynchronous I2C or SPI transaction,
+// which are told apart by handle; pParam points to the number of
+// the transaction.
+static void busAsyncCallback(int32_t handle, int32_t sizeOrErrorCode,
+                             void *pParam)
+{
+    size_t bus = 0;
+
+    if (handle == U_PORT_TEST_BUS_ASYNC_SPI_HANDLE) {
+        bus = 1;
+    } else if (handle != U_PORT_TEST_BUS_ASYNC_I2C_HANDLE) {
+        gBusAsyncErrorFlag = true;
+    }
+    if (sizeOrErrorCode != gBusAsyncExpected[bus]) {
+        gBusAsyncErrorFlag = true;
+    }
+    if (gBusAsyncCounter[bus] < U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS) {
+        gBusAsyncOrder[bus][gBusAsyncCounter[bus]] = *((uint8_t *) pParam);
+    }
+    gBusAsyncCounter[bus]++;
+    // Take a little time so that the queue of the bus fills up
+    uPortTaskBlock(5);
+}
+
+// Send a one-byte event with uPortEventQueueSendExt() or, if useIrq
+// is true, with uPortEventQueueSendExtIrq(), falling back to the
+// non-IRQ version where the IRQ version is not supported.
+static int32_t eventQueueSendExt(int32_t handle, uint8_t value,
+                                 int32_t coalesceKey, bool highPriority,
+                                 bool useIrq)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+
+    if (useIrq) {
+        errorCode = uPortEventQueueSendExtIrq(handle, &value, 1,
+                                              coalesceKey, highPriority);
+    }
+    if (errorCode == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+        errorCode = uPortEventQueueSendExt(handle, &value, 1,
+                                           coalesceKey, highPriority);
+    }
+
+    return errorCode;
+}
+
 #if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B < 0)
 
+// Callback that is called when an asynchronous UART write is done.
+static void uartWriteAsyncCallback(int32_t uartHandle,
+                                   int32_t sizeOrErrorCode,
+                                   void *pParameter)
+{
+    (void) uartHandle;
+    *((volatile int32_t *) pParameter) = sizeOrErrorCode;
+}
+
 // Callback that is called when data arrives at the UART
 static void uartReceivedDataCallback(int32_t uartHandle,
                                      uint32_t filter,
@@ -1013,6 +1217,8 @@ static void runUartTest(int32_t size, int32_t speed,
     int32_t stackMinFreeBytes;
     int32_t x;
     const char *pFlowControl = "?";
+    volatile int32_t writeAsyncResult;
+    int32_t startTimeMs;
 
     eventCallbackData.callCount = 0;
     eventCallbackData.pReceive = gUartBuffer;
@@ -1128,6 +1334,13 @@ static void runUartTest(int32_t size, int32_t speed,
                        (x == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED));
     uPortUartCtsResume(uartHandle);
 
+    // Similarly, changing the baud rate may not be supported:
+    // "change" it to the rate it is already at, which should
+    // not upset the rest of the test
+    x = uPortUartSetBaudRate(uartHandle, speed);
+    U_PORT_TEST_ASSERT((x == 0) ||
+                       (x == (int32_t) U_ERROR_COMMON_NOT_SUPPORTED));
+
     // Manually send an Rx event and check that it caused
     // the callback to be called
     U_PORT_TEST_ASSERT(eventCallbackData.callCount == 0);
@@ -1167,9 +1380,24 @@ static void runUartTest(int32_t size, int32_t speed,
         if (bytesToSend > size - bytesSent) {
             bytesToSend = size - bytesSent;
         }
-        U_PORT_TEST_ASSERT(uPortUartWrite(uartHandle,
-                                          gUartTestData,
-                                          bytesToSend) == bytesToSend);
+        if ((bytesSent / (sizeof(gUartTestData) - 1)) & 1) {
+            // Every other block, write asynchronously
+            writeAsyncResult = INT32_MIN;
+            U_PORT_TEST_ASSERT(uPortUartWriteAsync(uartHandle,
+                                                   gUartTestData, bytesToSend,
+                                                   uartWriteAsyncCallback,
+                                                   (void *) &writeAsyncResult) == 0);
+            startTimeMs = uPortGetTickTimeMs();
+            while ((writeAsyncResult == INT32_MIN) &&
+                   (uPortGetTickTimeMs() - startTimeMs < U_PORT_UART_WRITE_TIMEOUT_MS)) {
+                uPortTaskBlock(U_CFG_OS_YIELD_MS);
+            }
+            U_PORT_TEST_ASSERT(writeAsyncResult == bytesToSend);
+        } else {
+            U_PORT_TEST_ASSERT(uPortUartWrite(uartHandle,
+                                              gUartTestData,
+                                              bytesToSend) == bytesToSend);
+        }
         bytesSent += bytesToSend;
         U_TEST_PRINT_LINE("%d byte(s) sent.", bytesSent);
         // Yield so that the receive task has chance to do
@@ -1251,6 +1479,21 @@ static bool fillWordSame(uint16_t wordA, uint16_t wordB, size_t lengthBytes)
 
 #endif
 
+// Output callback for deferred logging: append to gLogDeferredBuffer.
+static void logDeferredOutput(const char *pStr, void *pParam)
+{
+    size_t length = strlen(pStr);
+
+    (void) pParam;
+
+    if (length > sizeof(gLogDeferredBuffer) - 1 - gLogDeferredBufferLength) {
+        length = sizeof(gLogDeferredBuffer) - 1 - gLogDeferredBufferLength;
+    }
+    memcpy(gLogDeferredBuffer + gLogDeferredBufferLength, pStr, length);
+    gLogDeferredBufferLength += length;
+    gLogDeferredBuffer[gLogDeferredBufferLength] = 0;
+}
+
 // Timer callback
 static void timerCallback(const uPortTimerHandle_t timerHandle, void *pParameter)
 {
@@ -1282,6 +1525,25 @@ static void criticalSectionTestTask(void *pParameter)
     uPortTaskDelete(NULL);
 }
 
+// The test task for atomics: add to gAtomicVariable using
+// both fetch-add and a compare-exchange loop, then count
+// itself out in gAtomicTasksDone.
+static void atomicTestTask(void *pParameter)
+{
+    int32_t value;
+
+    (void) pParameter;
+    for (size_t x = 0; x < U_PORT_TEST_ATOMIC_ITERATIONS; x++) {
+        uPortAtomicFetchAdd(&gAtomicVariable, 1);
+        do {
+            value = uPortAtomicLoad(&gAtomicVariable);
+        } while (!uPortAtomicCompareExchange(&gAtomicVariable, value, value + 2));
+    }
+    uPortAtomicFetchAdd(&gAtomicTasksDone, 1);
+
+    uPortTaskDelete(NULL);
+}
+
 #if (U_CFG_APP_GNSS_I2C >= 0) && !defined(U_PORT_TEST_DISABLE_I2C)
 // Reset a GNSS chip attached via I2C
 static bool gnssReset()
@@ -1324,6 +1586,30 @@ static void assertFunction(const char *pFileStr, int32_t line)
     gVariable = 1;
 }
 
+#ifdef U_CFG_HEAP_SLAB
+// Return the number of fixed-block front-end blocks in use, plus the
+// number of fallbacks to the platform heap, across all size classes,
+// printing the statistics if required.
+static int32_t heapSlabCount(bool print)
+{
+    uPortHeapSlabStatistics_t statistics;
+    int32_t count = 0;
+
+    for (size_t x = 0; uPortHeapSlabGetStatistics(x, &statistics) == 0; x++) {
+        if (print) {
+            U_TEST_PRINT_LINE("size class %d (%d byte(s)): %d of %d block(s)"
+                              " in use, at most %d, %d fallback(s).", x,
+                              statistics.blockSizeBytes, statistics.usedBlockCount,
+                              statistics.totalBlockCount, statistics.maxUsedBlockCount,
+                              statistics.fallbackCount);
+        }
+        count += statistics.usedBlockCount + statistics.fallbackCount;
+    }
+
+    return count;
+}
+#endif
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: TESTS
  * -------------------------------------------------------------- */
@@ -1993,6 +2279,55 @@ U_PORT_TEST_FUNCTION("[port]", "portOsBlock")
 }
 #endif
 
+/** Test getting task statistics.
+ */
+U_PORT_TEST_FUNCTION("[port]", "portOsTaskStats")
+{
+    uPortTaskStats_t stats[U_PORT_TEST_OS_TASK_STATS_MAX_NUM];
+    int64_t totalRunTime = 0;
+    int32_t numTasks;
+    int32_t resourceCount;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    numTasks = uPortTaskStatsGet(NULL, 1, NULL);
+    if (numTasks != (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED) {
+        U_PORT_TEST_ASSERT(numTasks < 0);
+        numTasks = uPortTaskStatsGet(NULL, 0, NULL);
+        U_TEST_PRINT_LINE("uPortTaskStatsGet() says there are %d task(s).", numTasks);
+        if (numTasks != (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+            // At the very least there is this task
+            U_PORT_TEST_ASSERT(numTasks > 0);
+            numTasks = uPortTaskStatsGet(stats, sizeof(stats) / sizeof(stats[0]),
+                                         &totalRunTime);
+            U_PORT_TEST_ASSERT((numTasks > 0) &&
+                               (numTasks <= (int32_t) (sizeof(stats) / sizeof(stats[0]))));
+            U_TEST_PRINT_LINE("total run time %d.", (int32_t) totalRunTime);
+            for (int32_t x = 0; x < numTasks; x++) {
+                U_TEST_PRINT_LINE("%2d \"%s\": run time %d, context switches %d,"
+                                  " stack min free %d byte(s).", x, stats[x].name,
+                                  (int32_t) stats[x].runTime,
+                                  (int32_t) stats[x].contextSwitches,
+                                  stats[x].stackMinFreeBytes);
+                U_PORT_TEST_ASSERT(strlen(stats[x].name) < sizeof(stats[x].name));
+            }
+        }
+    }
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Test event queues.
  */
 U_PORT_TEST_FUNCTION("[port]", "portEventQueue")
@@ -2158,6 +2493,69 @@ U_PORT_TEST_FUNCTION("[port]", "portEventQueue")
         U_PORT_TEST_ASSERT(stackMinFreeBytes > 0);
     }
 
+    for (x = 0; x < 2; x++) {
+        if (x == 0) {
+            U_TEST_PRINT_LINE("checking coalescing and priority...");
+            y = uPortEventQueueOpen(eventQueueOrderFunction, "order",
+                                    U_PORT_TEST_OS_EVENT_QUEUE_PARAM_MIN_SIZE_BYTES,
+                                    U_PORT_EVENT_QUEUE_MIN_TASK_STACK_SIZE_BYTES,
+                                    U_CFG_TEST_OS_TASK_PRIORITY,
+                                    U_PORT_TEST_QUEUE_LENGTH);
+        } else {
+            // The same again on an event queue serviced by the shared
+            // workers: the worker held up by event 0 must still
+            // see all of the others, in the same order
+            U_TEST_PRINT_LINE("checking coalescing and priority on a shared event queue...");
+            y = uPortEventQueueOpenShared(eventQueueOrderFunction,
+                                          U_PORT_TEST_OS_EVENT_QUEUE_PARAM_MIN_SIZE_BYTES,
+                                          U_PORT_TEST_QUEUE_LENGTH);
+        }
+        gEventQueueOrderCounter = 0;
+        gEventQueueOrderGo = false;
+        U_PORT_TEST_ASSERT(y >= 0);
+        // An invalid coalescing key
+        fill = 0;
+        U_PORT_TEST_ASSERT(uPortEventQueueSendExt(y, &fill, 1,
+                                                  U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM,
+                                                  false) < 0);
+        U_PORT_TEST_ASSERT(uPortEventQueueSendExtIrq(y, &fill, 1,
+                                                     U_PORT_EVENT_QUEUE_COALESCE_KEY_MAX_NUM,
+                                                     false) < 0);
+        // Event 0 holds up the event task...
+        U_PORT_TEST_ASSERT(uPortEventQueueSendExt(y, &fill, 1, -1, false) == 0);
+        uPortTaskBlock(100);
+        // ...while 1 and 2 queue up, then 3 is merged with 2
+        // and 4 goes in at high priority; the second time
+        // around these are sent with the IRQ version
+        U_PORT_TEST_ASSERT(eventQueueSendExt(y, 1, -1, false, (x > 0)) == 0);
+        U_PORT_TEST_ASSERT(eventQueueSendExt(y, 2, 0, false, (x > 0)) == 0);
+        U_PORT_TEST_ASSERT(eventQueueSendExt(y, 3, 0, false, (x > 0)) == 0);
+        U_PORT_TEST_ASSERT(eventQueueSendExt(y, 4, -1, true, (x > 0)) == 0);
+        gEventQueueOrderGo = true;
+        uPortTaskBlock(100);
+        // Now that 2 has been delivered the key is free again
+        U_PORT_TEST_ASSERT(eventQueueSendExt(y, 5, 0, false, (x > 0)) == 0);
+        uPortTaskBlock(100);
+        U_TEST_PRINT_LINE("%d event(s) received in the order %d %d %d %d %d.",
+                          gEventQueueOrderCounter, gEventQueueOrder[0],
+                          gEventQueueOrder[1], gEventQueueOrder[2],
+                          gEventQueueOrder[3], gEventQueueOrder[4]);
+        U_PORT_TEST_ASSERT(gEventQueueOrderCounter == 5);
+        U_PORT_TEST_ASSERT(gEventQueueOrder[0] == 0);
+#if U_PORT_EVENT_QUEUE_HIGH_PRIORITY_LENGTH > 0
+        U_PORT_TEST_ASSERT(gEventQueueOrder[1] == 4);
+        U_PORT_TEST_ASSERT(gEventQueueOrder[2] == 1);
+        U_PORT_TEST_ASSERT(gEventQueueOrder[3] == 2);
+#endif
+        U_PORT_TEST_ASSERT(gEventQueueOrder[4] == 5);
+        U_PORT_TEST_ASSERT(!uPortEventQueueIsTask(y));
+        stackMinFreeBytes = uPortEventQueueStackMinFree(y);
+        if (stackMinFreeBytes != (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+            U_PORT_TEST_ASSERT(stackMinFreeBytes > 0);
+        }
+        U_PORT_TEST_ASSERT(uPortEventQueueClose(y) == 0);
+    }
+
     U_TEST_PRINT_LINE("closing the event queues...");
     U_PORT_TEST_ASSERT(uPortEventQueueClose(gEventQueueMaxHandle) == 0);
     uPortEventQueueCleanUp();
@@ -2186,6 +2584,212 @@ U_PORT_TEST_FUNCTION("[port]", "portEventQueue")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test that a callback of an event queue serviced by the shared
+ * workers may send to another such event queue, however many events
+ * are waiting, and that a long callback does not hold up the other
+ * shared event queues.
+ */
+U_PORT_TEST_FUNCTION("[port]", "portEventQueueShared")
+{
+    uint8_t event[2];
+    int32_t resourceCount;
+    int32_t startTimeMs;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    gEventQueueSharedGo = false;
+    gEventQueueSharedErrorFlag = false;
+    for (size_t x = 0; x < sizeof(gEventQueueSharedHandle) / sizeof(gEventQueueSharedHandle[0]);
+         x++) {
+        gEventQueueSharedCounter[x] = 0;
+        gEventQueueSharedHandle[x] = uPortEventQueueOpenShared(eventQueueSharedFunction,
+                                                               sizeof(event),
+                                                               U_PORT_TEST_EVENT_QUEUE_SHARED_NUM);
+        U_PORT_TEST_ASSERT(gEventQueueSharedHandle[x] >= 0);
+    }
+
+    U_TEST_PRINT_LINE("sending %d event(s) to a held-up shared event queue...",
+                      U_PORT_TEST_EVENT_QUEUE_SHARED_NUM);
+    event[0] = 0;
+    for (size_t x = 0; x < U_PORT_TEST_EVENT_QUEUE_SHARED_NUM; x++) {
+        event[1] = (uint8_t) x;
+        U_PORT_TEST_ASSERT(uPortEventQueueSend(gEventQueueSharedHandle[0], event, 2) == 0);
+    }
+#if U_PORT_EVENT_QUEUE_SHARED_WORKERS_NUM > 1
+    // The third event queue must be dealt with while the first
+    // is held up
+    event[0] = 2;
+    event[1] = 0;
+    U_PORT_TEST_ASSERT(uPortEventQueueSend(gEventQueueSharedHandle[2], event, 2) == 0);
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gEventQueueSharedCounter[2] == 0) &&
+           (uPortGetTickTimeMs() - startTimeMs < 1000)) {
+        uPortTaskBlock(10);
+    }
+    U_PORT_TEST_ASSERT(gEventQueueSharedCounter[2] == 1);
+    U_PORT_TEST_ASSERT(gEventQueueSharedCounter[0] == 0);
+#endif
+
+    // Let the first event queue go: everything must arrive at
+    // the first and, forwarded, at the second, in order
+    gEventQueueSharedGo = true;
+    startTimeMs = uPortGetTickTimeMs();
+    while ((gEventQueueSharedCounter[1] < U_PORT_TEST_EVENT_QUEUE_SHARED_NUM) &&
+           (uPortGetTickTimeMs() - startTimeMs < 5000)) {
+        uPortTaskBlock(10);
+    }
+    U_TEST_PRINT_LINE("%d event(s) received, %d forwarded.",
+                      gEventQueueSharedCounter[0], gEventQueueSharedCounter[1]);
+    U_PORT_TEST_ASSERT(!gEventQueueSharedErrorFlag);
+    U_PORT_TEST_ASSERT(gEventQueueSharedCounter[0] == U_PORT_TEST_EVENT_QUEUE_SHARED_NUM);
+    U_PORT_TEST_ASSERT(gEventQueueSharedCounter[1] == U_PORT_TEST_EVENT_QUEUE_SHARED_NUM);
+
+    for (size_t x = 0; x < sizeof(gEventQueueSharedHandle) / sizeof(gEventQueueSharedHandle[0]);
+         x++) {
+        U_PORT_TEST_ASSERT(uPortEventQueueClose(gEventQueueSharedHandle[x]) == 0);
+    }
+
+    uPortDeinit();
+
+    // Give the RTOS idle task time to tidy-away the tasks
+    uPortTaskBlock(1000);
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test the queueing of asynchronous I2C and SPI transactions; no
+ * bus is opened, the transactions fail as the blocking calls would,
+ * hence this requires no wiring.
+ */
+U_PORT_TEST_FUNCTION("[port]", "portBusAsync")
+{
+    int32_t resourceCount;
+    char i2cBuffer[2] = {0};
+    char spiBuffer[2] = {0};
+    uint8_t id[U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS];
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    U_TEST_PRINT_LINE("testing asynchronous I2C and SPI.");
+    gBusAsyncCounter[0] = 0;
+    gBusAsyncCounter[1] = 0;
+    gBusAsyncErrorFlag = false;
+
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uPortI2cControllerSendReceiveAsync(-1, 0x42, i2cBuffer, 1, NULL, 0,
+                                                          busAsyncCallback,
+                                                          &id[0]) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(uPortI2cControllerSendReceiveAsync(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE,
+                                                          0x42, i2cBuffer, 1, NULL, 0,
+                                                          NULL, NULL) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(uPortI2cControllerSendReceiveAsync(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE,
+                                                          0x42, NULL, 1, NULL, 0,
+                                                          busAsyncCallback,
+                                                          &id[0]) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(uPortI2cControllerSendReceiveAsync(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE,
+                                                          0x42, NULL, 0, NULL, 1,
+                                                          busAsyncCallback,
+                                                          &id[0]) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(uPortSpiControllerSendReceiveBlockAsync(-1, spiBuffer, 1, NULL, 0,
+                                                               busAsyncCallback,
+                                                               &id[0]) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(uPortSpiControllerSendReceiveBlockAsync(U_PORT_TEST_BUS_ASYNC_SPI_HANDLE,
+                                                               spiBuffer, 1, NULL, 0,
+                                                               NULL, NULL) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(uPortSpiControllerSendReceiveBlockAsync(U_PORT_TEST_BUS_ASYNC_SPI_HANDLE,
+                                                               NULL, 1, NULL, 0,
+                                                               busAsyncCallback,
+                                                               &id[0]) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+    U_PORT_TEST_ASSERT(uPortSpiControllerSendReceiveBlockAsync(U_PORT_TEST_BUS_ASYNC_SPI_HANDLE,
+                                                               NULL, 0, NULL, 1,
+                                                               busAsyncCallback,
+                                                               &id[0]) ==
+                       (int32_t) U_ERROR_COMMON_INVALID_PARAMETER);
+
+    // Stopping a bus that is not in asynchronous use does nothing
+    U_PORT_TEST_ASSERT(uPortI2cControllerAsyncStop(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE) == 0);
+    U_PORT_TEST_ASSERT(uPortSpiControllerAsyncStop(U_PORT_TEST_BUS_ASYNC_SPI_HANDLE) == 0);
+    U_PORT_TEST_ASSERT(gBusAsyncCounter[0] == 0);
+    U_PORT_TEST_ASSERT(gBusAsyncCounter[1] == 0);
+
+    // The callback must be given whatever the blocking call returns
+    gBusAsyncExpected[0] = uPortI2cControllerSendReceive(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE, 0x42,
+                                                         i2cBuffer, 1, i2cBuffer + 1, 1);
+    gBusAsyncExpected[1] = uPortSpiControllerSendReceiveBlock(U_PORT_TEST_BUS_ASYNC_SPI_HANDLE,
+                                                              spiBuffer, 1, spiBuffer + 1, 1);
+    U_TEST_PRINT_LINE("blocking I2C returns %d, blocking SPI returns %d.",
+                      gBusAsyncExpected[0], gBusAsyncExpected[1]);
+
+    // Queue more transactions on each bus than its queue can hold
+    for (size_t x = 0; x < sizeof(id) / sizeof(id[0]); x++) {
+        id[x] = (uint8_t) x;
+        U_PORT_TEST_ASSERT(uPortI2cControllerSendReceiveAsync(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE,
+                                                              0x42, i2cBuffer, 1,
+                                                              i2cBuffer + 1, 1,
+                                                              busAsyncCallback,
+                                                              &id[x]) == 0);
+        U_PORT_TEST_ASSERT(uPortSpiControllerSendReceiveBlockAsync(U_PORT_TEST_BUS_ASYNC_SPI_HANDLE,
+                                                                   spiBuffer, 1,
+                                                                   spiBuffer + 1, 1,
+                                                                   busAsyncCallback,
+                                                                   &id[x]) == 0);
+    }
+
+    // Stopping must wait for all of them to be done
+    U_PORT_TEST_ASSERT(uPortI2cControllerAsyncStop(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE) == 0);
+    U_TEST_PRINT_LINE("%d I2C transaction(s) done.", gBusAsyncCounter[0]);
+    U_PORT_TEST_ASSERT(gBusAsyncCounter[0] == U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS);
+    U_PORT_TEST_ASSERT(uPortSpiControllerAsyncStop(U_PORT_TEST_BUS_ASYNC_SPI_HANDLE) == 0);
+    U_TEST_PRINT_LINE("%d SPI transaction(s) done.", gBusAsyncCounter[1]);
+    U_PORT_TEST_ASSERT(gBusAsyncCounter[1] == U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS);
+    U_PORT_TEST_ASSERT(!gBusAsyncErrorFlag);
+
+    // ...in the order they were queued
+    for (size_t x = 0; x < U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS; x++) {
+        U_PORT_TEST_ASSERT(gBusAsyncOrder[0][x] == x);
+        U_PORT_TEST_ASSERT(gBusAsyncOrder[1][x] == x);
+    }
+
+    // A bus can be used asynchronously again once stopped
+    U_PORT_TEST_ASSERT(uPortI2cControllerSendReceiveAsync(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE,
+                                                          0x42, i2cBuffer, 1,
+                                                          i2cBuffer + 1, 1,
+                                                          busAsyncCallback,
+                                                          &id[0]) == 0);
+    U_PORT_TEST_ASSERT(uPortI2cControllerAsyncStop(U_PORT_TEST_BUS_ASYNC_I2C_HANDLE) == 0);
+    U_PORT_TEST_ASSERT(gBusAsyncCounter[0] == U_PORT_TEST_BUS_ASYNC_NUM_TRANSACTIONS + 1);
+    U_PORT_TEST_ASSERT(!gBusAsyncErrorFlag);
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Test heap API.
  *
  * NOTE: for this to work fully U_ASSERT_HOOK_FUNCTION_TEST_RETURN must be defined.
@@ -2226,6 +2830,65 @@ U_PORT_TEST_FUNCTION("[port]", "portHeap")
     gpMalloc = NULL;
     U_PORT_TEST_ASSERT(gVariable == 0);
 
+#ifdef U_CFG_HEAP_SLAB
+    U_TEST_PRINT_LINE("testing the fixed-block front-end.");
+    y = heapSlabCount(true);
+    // A small allocation must be served by a size class
+    // (or count as a fallback if that size class is full)
+    gpMalloc = pUPortMalloc(U_PORT_MALLOC_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(gpMalloc != NULL);
+    memset(gpMalloc, 0xa5, U_PORT_MALLOC_LENGTH_BYTES);
+    x = heapSlabCount(false);
+    U_PORT_TEST_ASSERT(x == y + 1);
+    uPortFree(gpMalloc);
+    gpMalloc = NULL;
+    U_PORT_TEST_ASSERT(heapSlabCount(true) <= x);
+    U_PORT_TEST_ASSERT(gVariable == 0);
+#else
+    U_PORT_TEST_ASSERT(uPortHeapSlabGetStatistics(0, NULL) ==
+                       (int32_t) U_ERROR_COMMON_NOT_SUPPORTED);
+#endif
+
+#if defined(U_CFG_HEAP_MONITOR) && defined(U_CFG_HEAP_PROFILE)
+    U_TEST_PRINT_LINE("testing heap profiling.");
+    {
+        uPortHeapProfileSite_t site = {0};
+        int32_t line = 0;
+        uPortHeapProfileReset();
+        // Allocate from a single call site, of two sizes, and
+        // have one allocation live at the end
+        for (x = 0; x < 3; x++) {
+            line = __LINE__ + 1;
+            gpMalloc = pUPortMalloc(x == 0 ? 200 : 8);
+            U_PORT_TEST_ASSERT(gpMalloc != NULL);
+            if (x < 2) {
+                uPortFree(gpMalloc);
+            }
+        }
+        // Find the call site
+        for (y = 0; (uPortHeapProfileGet(y, &site) == 0) && (site.line != line); y++) {}
+        U_PORT_TEST_ASSERT(site.line == line);
+        U_PORT_TEST_ASSERT(uPortHeapProfileGet(y, NULL) < 0);
+        U_TEST_PRINT_LINE("call site %d: %d alloc(s), %d byte(s), live %d, peak %d.",
+                          y, site.allocCount, site.allocBytes, site.liveBytes,
+                          site.peakLiveBytes);
+        U_PORT_TEST_ASSERT(site.allocCount == 3);
+        U_PORT_TEST_ASSERT(site.allocBytes == 200 + 8 + 8);
+        U_PORT_TEST_ASSERT(site.liveBytes == 8);
+        U_PORT_TEST_ASSERT(site.peakLiveBytes == 200);
+        U_PORT_TEST_ASSERT(site.sizeClassCount[0] == 2);
+        U_PORT_TEST_ASSERT(site.sizeClassCount[4] == 1);
+        uPortFree(gpMalloc);
+        gpMalloc = NULL;
+        U_PORT_TEST_ASSERT(uPortHeapProfileGet(y, &site) == 0);
+        U_PORT_TEST_ASSERT(site.liveBytes == 0);
+        U_PORT_TEST_ASSERT(uPortHeapDump(U_TEST_PREFIX) >= 0);
+    }
+#else
+    U_PORT_TEST_ASSERT(uPortHeapProfileGet(0, NULL) ==
+                       (int32_t) U_ERROR_COMMON_NOT_SUPPORTED);
+#endif
+
 #if defined(U_CFG_HEAP_MONITOR) && defined(U_ASSERT_HOOK_FUNCTION_TEST_RETURN)
     U_TEST_PRINT_LINE("testing buffer overrun detection with assert hook.");
 
@@ -2400,6 +3063,89 @@ U_PORT_TEST_FUNCTION("[port]", "portGmtime_r")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test: the calendar conversions of u_time.h, which gmtime_r() and
+ * mktime64() may be built upon.
+ */
+U_PORT_TEST_FUNCTION("[port]", "portTimeUtc")
+{
+    int32_t resourceCount;
+    struct tm timeStruct;
+    int32_t year = 1970;
+    int32_t month = 1;
+    int32_t day = 1;
+    int32_t months = 0;
+    int32_t y;
+    int32_t m;
+    int32_t d;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    U_TEST_PRINT_LINE("testing uTimeSecondsToTmUtc()...");
+    for (size_t x = 0; x < sizeof(timeTestData) / sizeof(timeTestData[0]); x++) {
+        memset(&timeStruct, 0xFF, sizeof(timeStruct));
+        U_PORT_TEST_ASSERT(uTimeSecondsToTmUtc(timeTestData[x].time, &timeStruct) == 0);
+        U_PORT_TEST_ASSERT(timeStruct.tm_sec == timeTestData[x].timeStruct.tm_sec % 60);
+        U_PORT_TEST_ASSERT(timeStruct.tm_min == timeTestData[x].timeStruct.tm_min +
+                           (timeTestData[x].timeStruct.tm_sec / 60));
+        U_PORT_TEST_ASSERT(timeStruct.tm_hour == timeTestData[x].timeStruct.tm_hour);
+        U_PORT_TEST_ASSERT(timeStruct.tm_mday == timeTestData[x].timeStruct.tm_mday);
+        U_PORT_TEST_ASSERT(timeStruct.tm_mon == timeTestData[x].timeStruct.tm_mon);
+        U_PORT_TEST_ASSERT(timeStruct.tm_year == timeTestData[x].timeStruct.tm_year);
+        U_PORT_TEST_ASSERT(timeStruct.tm_wday == timeTestData[x].timeStruct.tm_wday);
+        U_PORT_TEST_ASSERT(timeStruct.tm_yday == timeTestData[x].timeStruct.tm_yday);
+        U_PORT_TEST_ASSERT(timeStruct.tm_isdst == 0);
+    }
+    // One second before 1970: Wednesday 31st December 1969, 23:59:59
+    U_PORT_TEST_ASSERT(uTimeSecondsToTmUtc(-1, &timeStruct) == 0);
+    U_PORT_TEST_ASSERT((timeStruct.tm_year == 69) && (timeStruct.tm_mon == 11) &&
+                       (timeStruct.tm_mday == 31) && (timeStruct.tm_hour == 23) &&
+                       (timeStruct.tm_min == 59) && (timeStruct.tm_sec == 59) &&
+                       (timeStruct.tm_wday == 3) && (timeStruct.tm_yday == 364));
+    U_PORT_TEST_ASSERT(uTimeSecondsToTmUtc(0, NULL) < 0);
+
+    // Walk day by day from 1970 to 2200, checking the constant-time
+    // conversions against a plain count of the calendar
+    U_TEST_PRINT_LINE("testing uTimeDaysFromCivil() and uTimeCivilFromDays()...");
+    for (int32_t days = 0; year < 2200; days++) {
+        U_PORT_TEST_ASSERT(uTimeDaysFromCivil(year, month, day) == days);
+        uTimeCivilFromDays(days, &y, &m, &d);
+        U_PORT_TEST_ASSERT((y == year) && (m == month) && (d == day));
+        if (day == 1) {
+            U_PORT_TEST_ASSERT(uTimeMonthsToSecondsUtc(months) == ((int64_t) days) * 3600 * 24);
+            U_PORT_TEST_ASSERT(uTimeSecondsToMonthsUtc(((int64_t) days) * 3600 * 24) == months);
+            if (months > 0) {
+                U_PORT_TEST_ASSERT(uTimeSecondsToMonthsUtc((((int64_t) days) * 3600 * 24) - 1) ==
+                                   months - 1);
+            }
+        }
+        day++;
+        if ((day > 31) || ((day > 30) && ((month == 4) || (month == 6) ||
+                                          (month == 9) || (month == 11))) ||
+            ((month == 2) && (day > (uTimeIsLeapYear(year) ? 29 : 28)))) {
+            day = 1;
+            month++;
+            months++;
+            if (month > 12) {
+                month = 1;
+                year++;
+            }
+        }
+    }
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Test: uPortGetTimezoneOffsetSeconds().
  */
 U_PORT_TEST_FUNCTION("[port]", "portGetTimezoneOffsetSeconds")
@@ -3093,6 +3839,8 @@ U_PORT_TEST_FUNCTION("[port]", "portCrypto")
     char iv[U_PORT_CRYPTO_AES128_INITIALISATION_VECTOR_LENGTH_BYTES];
     int32_t resourceCount;
     int32_t x;
+    void *pContext = NULL;
+    size_t length;
 
     // Whatever called us likely initialised the
     // port so deinitialise it here to obtain the
@@ -3116,6 +3864,47 @@ U_PORT_TEST_FUNCTION("[port]", "portCrypto")
         U_TEST_PRINT_LINE("SHA256 not supported.");
     }
 
+    U_TEST_PRINT_LINE("testing SHA256 in pieces...");
+    memset(buffer, 0, sizeof(buffer));
+    x = uPortCryptoSha256Init(&pContext);
+    if (x != (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+        U_PORT_TEST_ASSERT(x == (int32_t) U_ERROR_COMMON_SUCCESS);
+        // Feed the input in pieces of increasing size
+        for (size_t y = 0, z = 1; y < sizeof(gSha256Input) - 1; y += length, z++) {
+            length = sizeof(gSha256Input) - 1 - y;
+            if (length > z) {
+                length = z;
+            }
+            U_PORT_TEST_ASSERT(uPortCryptoSha256Update(pContext, gSha256Input + y,
+                                                       length) == 0);
+        }
+        U_PORT_TEST_ASSERT(uPortCryptoSha256Finish(pContext, buffer) == 0);
+        U_PORT_TEST_ASSERT(memcmp(buffer, gSha256Output,
+                                  U_PORT_CRYPTO_SHA256_OUTPUT_LENGTH_BYTES) == 0);
+        // Check that abandoning a calculation is fine
+        U_PORT_TEST_ASSERT(uPortCryptoSha256Init(&pContext) == 0);
+        U_PORT_TEST_ASSERT(uPortCryptoSha256Update(pContext, gSha256Input, 1) == 0);
+        U_PORT_TEST_ASSERT(uPortCryptoSha256Finish(pContext, NULL) == 0);
+    } else {
+        U_TEST_PRINT_LINE("SHA256 in pieces not supported.");
+    }
+
+    U_TEST_PRINT_LINE("testing MD5 in pieces...");
+    memset(buffer, 0, sizeof(buffer));
+    x = uPortCryptoMd5Init(&pContext);
+    if (x != (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+        U_PORT_TEST_ASSERT(x == (int32_t) U_ERROR_COMMON_SUCCESS);
+        // Test vector from RFC 1321
+        U_PORT_TEST_ASSERT(uPortCryptoMd5Update(pContext, "message ", 8) == 0);
+        U_PORT_TEST_ASSERT(uPortCryptoMd5Update(pContext, "digest", 6) == 0);
+        U_PORT_TEST_ASSERT(uPortCryptoMd5Finish(pContext, buffer) == 0);
+        U_PORT_TEST_ASSERT(memcmp(buffer, "\xf9\x6b\x69\x7d\x7c\xb7\x93\x8d"
+                                  "\x52\x5a\x2f\x31\xaa\xf1\x61\xd0",
+                                  U_PORT_CRYPTO_MD5_OUTPUT_LENGTH_BYTES) == 0);
+    } else {
+        U_TEST_PRINT_LINE("MD5 not supported.");
+    }
+
     U_TEST_PRINT_LINE("testing HMAC SHA256...");
     x = uPortCryptoHmacSha256(gHmacSha256Key,
                               sizeof(gHmacSha256Key) - 1,
@@ -3130,6 +3919,27 @@ U_PORT_TEST_FUNCTION("[port]", "portCrypto")
         U_TEST_PRINT_LINE("HMAC SHA256 not supported.");
     }
 
+    U_TEST_PRINT_LINE("testing HMAC SHA256 in pieces...");
+    memset(buffer, 0, sizeof(buffer));
+    x = uPortCryptoHmacSha256Init(&pContext, gHmacSha256Key,
+                                  sizeof(gHmacSha256Key) - 1);
+    if (x != (int32_t) U_ERROR_COMMON_NOT_SUPPORTED) {
+        U_PORT_TEST_ASSERT(x == (int32_t) U_ERROR_COMMON_SUCCESS);
+        for (size_t y = 0; y < sizeof(gHmacSha256Input) - 1; y += 3) {
+            length = sizeof(gHmacSha256Input) - 1 - y;
+            if (length > 3) {
+                length = 3;
+            }
+            U_PORT_TEST_ASSERT(uPortCryptoHmacSha256Update(pContext, gHmacSha256Input + y,
+                                                           length) == 0);
+        }
+        U_PORT_TEST_ASSERT(uPortCryptoHmacSha256Finish(pContext, buffer) == 0);
+        U_PORT_TEST_ASSERT(memcmp(buffer, gHmacSha256Output,
+                                  U_PORT_CRYPTO_SHA256_OUTPUT_LENGTH_BYTES) == 0);
+    } else {
+        U_TEST_PRINT_LINE("HMAC SHA256 in pieces not supported.");
+    }
+
     U_TEST_PRINT_LINE("testing AES CBC 128...");
     memcpy(iv, gAes128CbcIV, sizeof(iv));
     x = uPortCryptoAes128CbcEncrypt(gAes128CbcKey,
@@ -3141,6 +3951,9 @@ U_PORT_TEST_FUNCTION("[port]", "portCrypto")
         U_PORT_TEST_ASSERT(x == (int32_t) U_ERROR_COMMON_SUCCESS);
         U_PORT_TEST_ASSERT(memcmp(buffer, gAes128CbcEncrypted,
                                   sizeof(gAes128CbcEncrypted) - 1) == 0);
+        // The IV should now be the last block of cipher text, ready
+        // to encrypt the next piece of a stream
+        U_PORT_TEST_ASSERT(memcmp(iv, gAes128CbcEncrypted, sizeof(iv)) == 0);
     } else {
         U_TEST_PRINT_LINE("AES CBC 128 encryption not supported.");
     }
@@ -3155,6 +3968,7 @@ U_PORT_TEST_FUNCTION("[port]", "portCrypto")
         U_PORT_TEST_ASSERT(x == (int32_t) U_ERROR_COMMON_SUCCESS);
         U_PORT_TEST_ASSERT(memcmp(buffer, gAes128CbcClear,
                                   sizeof(gAes128CbcClear) - 1) == 0);
+        U_PORT_TEST_ASSERT(memcmp(iv, gAes128CbcEncrypted, sizeof(iv)) == 0);
     } else {
         U_TEST_PRINT_LINE("AES CBC 128 decryption not supported.");
     }
@@ -3410,6 +4224,150 @@ U_PORT_TEST_FUNCTION("[port]", "portCriticalSection")
     U_PORT_TEST_ASSERT(resourceCount <= 0);
 }
 
+/** Test atomics.
+ */
+U_PORT_TEST_FUNCTION("[port]", "portAtomic")
+{
+    int32_t resourceCount;
+    int32_t x = 5;
+    int32_t y;
+    void *pPtr = NULL;
+    uPortTaskHandle_t taskHandle;
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    U_TEST_PRINT_LINE("testing atomics.");
+
+    // The basics, single-threaded
+    uPortAtomicBarrier();
+    U_PORT_TEST_ASSERT(uPortAtomicLoad(&x) == 5);
+    uPortAtomicStore(&x, -7);
+    U_PORT_TEST_ASSERT(x == -7);
+    U_PORT_TEST_ASSERT(uPortAtomicFetchAdd(&x, 10) == -7);
+    U_PORT_TEST_ASSERT(uPortAtomicFetchAdd(&x, -1) == 3);
+    U_PORT_TEST_ASSERT(x == 2);
+    U_PORT_TEST_ASSERT(!uPortAtomicCompareExchange(&x, 3, 4));
+    U_PORT_TEST_ASSERT(x == 2);
+    U_PORT_TEST_ASSERT(uPortAtomicCompareExchange(&x, 2, 4));
+    U_PORT_TEST_ASSERT(x == 4);
+    U_PORT_TEST_ASSERT(pUPortAtomicLoadPtr(&pPtr) == NULL);
+    uPortAtomicStorePtr(&pPtr, &x);
+    U_PORT_TEST_ASSERT(pPtr == &x);
+    U_PORT_TEST_ASSERT(!uPortAtomicCompareExchangePtr(&pPtr, NULL, &y));
+    U_PORT_TEST_ASSERT(pPtr == &x);
+    U_PORT_TEST_ASSERT(uPortAtomicCompareExchangePtr(&pPtr, &x, &y));
+    U_PORT_TEST_ASSERT(pUPortAtomicLoadPtr(&pPtr) == &y);
+
+    // Now with several tasks adding to the same variable at once
+    uPortAtomicStore(&gAtomicVariable, 0);
+    uPortAtomicStore(&gAtomicTasksDone, 0);
+    for (size_t z = 0; z < U_PORT_TEST_ATOMIC_NUM_TASKS; z++) {
+        U_PORT_TEST_ASSERT(uPortTaskCreate(atomicTestTask, "atomicTestTask",
+                                           U_CFG_TEST_OS_TASK_STACK_SIZE_BYTES,
+                                           NULL, U_CFG_TEST_OS_TASK_PRIORITY,
+                                           &taskHandle) == 0);
+    }
+    for (size_t z = 0; (uPortAtomicLoad(&gAtomicTasksDone) < U_PORT_TEST_ATOMIC_NUM_TASKS) &&
+         (z < U_PORT_TEST_ATOMIC_TIMEOUT_SECONDS * 10); z++) {
+        uPortTaskBlock(100);
+    }
+    y = uPortAtomicLoad(&gAtomicVariable);
+    U_TEST_PRINT_LINE("%d task(s) finished, variable is %d (expected %d).",
+                      uPortAtomicLoad(&gAtomicTasksDone), y,
+                      U_PORT_TEST_ATOMIC_NUM_TASKS * U_PORT_TEST_ATOMIC_ITERATIONS * 3);
+    U_PORT_TEST_ASSERT(uPortAtomicLoad(&gAtomicTasksDone) == U_PORT_TEST_ATOMIC_NUM_TASKS);
+    U_PORT_TEST_ASSERT(y == U_PORT_TEST_ATOMIC_NUM_TASKS * U_PORT_TEST_ATOMIC_ITERATIONS * 3);
+    // Allow time for the idle task to clean up the tasks
+    uPortTaskBlock(1000);
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
+/** Test deferred logging.
+ */
+U_PORT_TEST_FUNCTION("[port]", "portLogDeferred")
+{
+    int32_t resourceCount;
+    int32_t y;
+    char expected[sizeof(gLogDeferredBuffer)];
+    // Deliberately not terminated
+    const char notTerminated[] = {'A', 'T', '+', 'C', 'G', 'M', 'R'};
+
+    // Whatever called us likely initialised the
+    // port so deinitialise it here to obtain the
+    // correct initial heap size
+    uPortDeinit();
+    resourceCount = uTestUtilGetDynamicResourceCount();
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    U_TEST_PRINT_LINE("testing deferred logging.");
+
+    U_PORT_TEST_ASSERT(uPortLogDeferredFlush() < 0);
+    U_PORT_TEST_ASSERT(uPortLogDeferredLostGet() < 0);
+    gLogDeferredBufferLength = 0;
+    gLogDeferredBuffer[0] = 0;
+    U_PORT_TEST_ASSERT(uPortLogDeferredInit(logDeferredOutput, NULL) == 0);
+
+    // Capture a mix of conversions and check that what comes out
+    // matches what snprintf() makes of the same thing
+    uPortLogDeferredF("%d|%5.2f|%-4s|%x|%c|%*d|%%|%hhu\n",
+                      -3, 3.14159, "ab", 0xbeefU, 'q', 4, 7, 257);
+    uPortLogDeferredF("%lld|%.*s|%s|%s %s %zu\n",
+                      (long long) -1234567890123LL, 3, notTerminated,
+                      (const char *) NULL, "hello", "world", (size_t) 42);
+    y = uPortLogDeferredFlush();
+    U_TEST_PRINT_LINE("%d print(s) formatted by flush.", y);
+    U_PORT_TEST_ASSERT(y >= 0);
+    snprintf(expected, sizeof(expected), "%d|%5.2f|%-4s|%x|%c|%*d|%%|%hhu\n"
+             "%lld|%.*s|%s|%s %s %zu\n", -3, 3.14159, "ab", 0xbeefU, 'q', 4, 7, (unsigned char) 257,
+             (long long) -1234567890123LL, 3, notTerminated, "(null)",
+             "hello", "world", (size_t) 42);
+    U_TEST_PRINT_LINE("deferred output was \"%s\".", gLogDeferredBuffer);
+    U_PORT_TEST_ASSERT(strcmp(gLogDeferredBuffer, expected) == 0);
+    U_PORT_TEST_ASSERT(uPortLogDeferredLostGet() == 0);
+
+    // A conversion longer than the line buffer must come out whole
+    gLogDeferredBufferLength = 0;
+    gLogDeferredBuffer[0] = 0;
+    uPortLogDeferredF("[%*d]\n", U_PORT_LOG_DEFERRED_LINE_LENGTH_BYTES + 20, 5);
+    U_PORT_TEST_ASSERT(uPortLogDeferredFlush() >= 0);
+    snprintf(expected, sizeof(expected), "[%*d]\n", U_PORT_LOG_DEFERRED_LINE_LENGTH_BYTES + 20, 5);
+    U_TEST_PRINT_LINE("deferred output was %d byte(s).", (int) gLogDeferredBufferLength);
+    U_PORT_TEST_ASSERT(strcmp(gLogDeferredBuffer, expected) == 0);
+
+    // Fill the ring well beyond its size: whatever is lost must
+    // be counted, nothing should block
+    for (size_t x = 0; x < U_PORT_LOG_DEFERRED_NUM_ENTRIES * 2; x++) {
+        uPortLogDeferredF("%d", (int) x);
+    }
+    U_PORT_TEST_ASSERT(uPortLogDeferredFlush() >= 0);
+    y = uPortLogDeferredLostGet();
+    U_TEST_PRINT_LINE("%d print(s) lost.", y);
+    U_PORT_TEST_ASSERT(y >= 0);
+
+    uPortLogDeferredDeinit();
+    U_PORT_TEST_ASSERT(uPortLogDeferredFlush() < 0);
+
+    uPortDeinit();
+
+    // Check for resource leaks
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+    resourceCount = uTestUtilGetDynamicResourceCount() - resourceCount;
+    U_TEST_PRINT_LINE("we have leaked %d resources(s).", resourceCount);
+    U_PORT_TEST_ASSERT(resourceCount <= 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -3439,6 +4397,8 @@ U_PORT_TEST_FUNCTION("[port]", "portCleanUp")
 
     uPortFree(gpMalloc);
 
+    uPortLogDeferredDeinit();
+
     uPortDeinit();
 
     U_PORT_TEST_ASSERT(uTestUtilResourceCheck(U_TEST_PREFIX,
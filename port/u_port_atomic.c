@@ -0,0 +1,291 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Default implementation of the atomic operations and memory
+ * barrier API, see u_port_atomic.h.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"     // NULL, size_t etc.
+#include "stdint.h"     // int32_t etc.
+#include "stdbool.h"
+
+#include "u_compiler.h" // U_WEAK
+
+#include "u_port_atomic.h"
+
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#if !defined(_MSC_VER) && defined(__ARM_ARCH_6M__)
+/** ARMv6-M (Cortex-M0/M0+) has no LDREX/STREX and so the compiler
+ * built-ins would end up calling library functions that are
+ * usually not there; instead mask interrupts around each operation,
+ * restoring the previous mask afterwards so that these functions
+ * may be called from interrupt context or with interrupts already
+ * masked.
+ */
+# define U_PORT_ATOMIC_IRQ_MASK
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+#ifdef U_PORT_ATOMIC_IRQ_MASK
+
+// Mask interrupts, returning the previous PRIMASK.
+static U_INLINE uint32_t irqMask()
+{
+    uint32_t primask;
+
+    __asm volatile ("mrs %0, primask\n"
+                    "cpsid i" : "=r" (primask) : : "memory");
+
+    return primask;
+}
+
+// Restore PRIMASK as returned by irqMask().
+static U_INLINE void irqRestore(uint32_t primask)
+{
+    __asm volatile ("msr primask, %0" : : "r" (primask) : "memory");
+}
+
+#endif
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+#if defined(_MSC_VER)
+
+// Microsoft Visual C++ implementation: the Interlocked
+// intrinsics are each a full barrier.
+
+U_WEAK int32_t uPortAtomicLoad(const volatile int32_t *pValue)
+{
+    return (int32_t) _InterlockedOr((volatile long *) pValue, 0);
+}
+
+U_WEAK void uPortAtomicStore(volatile int32_t *pValue, int32_t value)
+{
+    _InterlockedExchange((volatile long *) pValue, (long) value);
+}
+
+U_WEAK bool uPortAtomicCompareExchange(volatile int32_t *pValue,
+                                       int32_t expected, int32_t desired)
+{
+    return _InterlockedCompareExchange((volatile long *) pValue,
+                                       (long) desired,
+                                       (long) expected) == (long) expected;
+}
+
+U_WEAK int32_t uPortAtomicFetchAdd(volatile int32_t *pValue, int32_t value)
+{
+    return (int32_t) _InterlockedExchangeAdd((volatile long *) pValue,
+                                             (long) value);
+}
+
+U_WEAK void *pUPortAtomicLoadPtr(void *const volatile *ppValue)
+{
+    return _InterlockedCompareExchangePointer((void *volatile *) ppValue,
+                                              NULL, NULL);
+}
+
+U_WEAK void uPortAtomicStorePtr(void *volatile *ppValue, void *pValue)
+{
+    _InterlockedExchangePointer(ppValue, pValue);
+}
+
+U_WEAK bool uPortAtomicCompareExchangePtr(void *volatile *ppValue,
+                                          void *pExpected, void *pDesired)
+{
+    return _InterlockedCompareExchangePointer(ppValue, pDesired,
+                                              pExpected) == pExpected;
+}
+
+U_WEAK void uPortAtomicBarrier(void)
+{
+    volatile long dummy = 0;
+
+    // An interlocked operation is a full processor barrier,
+    // _ReadWriteBarrier() stops the compiler moving things
+    _ReadWriteBarrier();
+    _InterlockedOr(&dummy, 0);
+    _ReadWriteBarrier();
+}
+
+#elif defined(U_PORT_ATOMIC_IRQ_MASK)
+
+// ARMv6-M implementation: aligned 32-bit loads and stores are
+// already atomic and, with a single core, only need to be kept
+// in order by the compiler; read-modify-write operations are
+// done with interrupts masked.
+
+U_WEAK int32_t uPortAtomicLoad(const volatile int32_t *pValue)
+{
+    int32_t value;
+
+    __asm volatile ("" : : : "memory");
+    value = *pValue;
+    __asm volatile ("" : : : "memory");
+
+    return value;
+}
+
+U_WEAK void uPortAtomicStore(volatile int32_t *pValue, int32_t value)
+{
+    __asm volatile ("" : : : "memory");
+    *pValue = value;
+    __asm volatile ("" : : : "memory");
+}
+
+U_WEAK bool uPortAtomicCompareExchange(volatile int32_t *pValue,
+                                       int32_t expected, int32_t desired)
+{
+    bool success = false;
+    uint32_t primask = irqMask();
+
+    if (*pValue == expected) {
+        *pValue = desired;
+        success = true;
+    }
+    irqRestore(primask);
+
+    return success;
+}
+
+U_WEAK int32_t uPortAtomicFetchAdd(volatile int32_t *pValue, int32_t value)
+{
+    int32_t previous;
+    uint32_t primask = irqMask();
+
+    previous = *pValue;
+    *pValue = previous + value;
+    irqRestore(primask);
+
+    return previous;
+}
+
+U_WEAK void *pUPortAtomicLoadPtr(void *const volatile *ppValue)
+{
+    void *pValue;
+
+    __asm volatile ("" : : : "memory");
+    pValue = *ppValue;
+    __asm volatile ("" : : : "memory");
+
+    return pValue;
+}
+
+U_WEAK void uPortAtomicStorePtr(void *volatile *ppValue, void *pValue)
+{
+    __asm volatile ("" : : : "memory");
+    *ppValue = pValue;
+    __asm volatile ("" : : : "memory");
+}
+
+U_WEAK bool uPortAtomicCompareExchangePtr(void *volatile *ppValue,
+                                          void *pExpected, void *pDesired)
+{
+    bool success = false;
+    uint32_t primask = irqMask();
+
+    if (*ppValue == pExpected) {
+        *ppValue = pDesired;
+        success = true;
+    }
+    irqRestore(primask);
+
+    return success;
+}
+
+U_WEAK void uPortAtomicBarrier(void)
+{
+    __asm volatile ("dmb" : : : "memory");
+}
+
+#else
+
+// Default (GCC/Clang) implementation using the __atomic
+// built-ins, which is what C11 atomics compile to; on cores
+// with LDREX/STREX (e.g. Cortex-M3 and above) or on x86 these
+// are lock-free and inlined.
+
+U_WEAK int32_t uPortAtomicLoad(const volatile int32_t *pValue)
+{
+    return __atomic_load_n(pValue, __ATOMIC_SEQ_CST);
+}
+
+U_WEAK void uPortAtomicStore(volatile int32_t *pValue, int32_t value)
+{
+    __atomic_store_n(pValue, value, __ATOMIC_SEQ_CST);
+}
+
+U_WEAK bool uPortAtomicCompareExchange(volatile int32_t *pValue,
+                                       int32_t expected, int32_t desired)
+{
+    return __atomic_compare_exchange_n(pValue, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+U_WEAK int32_t uPortAtomicFetchAdd(volatile int32_t *pValue, int32_t value)
+{
+    return __atomic_fetch_add(pValue, value, __ATOMIC_SEQ_CST);
+}
+
+U_WEAK void *pUPortAtomicLoadPtr(void *const volatile *ppValue)
+{
+    return __atomic_load_n(ppValue, __ATOMIC_SEQ_CST);
+}
+
+U_WEAK void uPortAtomicStorePtr(void *volatile *ppValue, void *pValue)
+{
+    __atomic_store_n(ppValue, pValue, __ATOMIC_SEQ_CST);
+}
+
+U_WEAK bool uPortAtomicCompareExchangePtr(void *volatile *ppValue,
+                                          void *pExpected, void *pDesired)
+{
+    return __atomic_compare_exchange_n(ppValue, &pExpected, pDesired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+U_WEAK void uPortAtomicBarrier(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
+
+// End of file
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Default implementations of the optional asynchronous I2C
+ * and SPI functions, uPortI2cControllerSendReceiveAsync(),
+ * uPortI2cControllerAsyncStop(), uPortSpiControllerSendReceiveBlockAsync()
+ * and uPortSpiControllerAsyncStop(), for platforms that do not
+ * provide their own (e.g. DMA-driven) versions.
+ *
+ * Each bus that is used asynchronously is given an event queue of
+ * its own: transactions are queued on it and carried out, in the
+ * order they were submitted, by the task of that event queue using
+ * the blocking calls of the platform, the callback being called
+ * when each completes.  Since all transactions on a bus pass through
+ * the same queue, callers sharing the bus are served first-come
+ * first-served and none of them has to wait for another's transaction
+ * to complete before it can get on with something else.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"     // NULL, size_t etc.
+#include "stdint.h"     // int32_t etc.
+#include "stdbool.h"
+#include "u_compiler.h" // WEAK
+
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_event_queue.h"
+#include "u_port_i2c.h"
+#include "u_port_spi.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_PORT_BUS_ASYNC_MAX_NUM_BUSES
+/** The maximum number of I2C and SPI buses, in total, that may
+ * be used asynchronously at any one time.
+ */
+# define U_PORT_BUS_ASYNC_MAX_NUM_BUSES 4
+#endif
+
+#ifndef U_PORT_BUS_ASYNC_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that carries out the transactions
+ * on each bus; this has to accommodate the stack needs of the
+ * blocking I2C/SPI calls of the platform and of the callbacks.
+ */
+# define U_PORT_BUS_ASYNC_TASK_STACK_SIZE_BYTES (1024 * 3)
+#endif
+
+#ifndef U_PORT_BUS_ASYNC_TASK_PRIORITY
+/** The priority of the task that carries out the transactions
+ * on each bus.
+ */
+# define U_PORT_BUS_ASYNC_TASK_PRIORITY (U_CFG_OS_PRIORITY_MAX - 5)
+#endif
+
+#ifndef U_PORT_BUS_ASYNC_QUEUE_LENGTH
+/** The number of transactions that may be queued on each bus
+ * before uPortI2cControllerSendReceiveAsync() or
+ * uPortSpiControllerSendReceiveBlockAsync() block.
+ */
+# define U_PORT_BUS_ASYNC_QUEUE_LENGTH 8
+#endif
+
+#ifndef U_PORT_BUS_ASYNC_STOP_POLL_MS
+/** How often uPortI2cControllerAsyncStop() and
+ * uPortSpiControllerAsyncStop() check whether the outstanding
+ * transactions on a bus have completed.
+ */
+# define U_PORT_BUS_ASYNC_STOP_POLL_MS 10
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The callback type common to I2C and SPI: the two are the same.
+ */
+typedef void (*uPortBusAsyncCallback_t)(int32_t handle,
+                                        int32_t sizeOrErrorCode,
+                                        void *pParam);
+
+/** A bus that is being used asynchronously.
+ */
+typedef struct {
+    bool inUse;
+    bool isSpi;
+    int32_t handle;
+    int32_t eventQueueHandle;
+    size_t numOutstanding;
+} uPortBusAsync_t;
+
+/** A transaction, as sent to the event queue of a bus.
+ */
+typedef struct {
+    size_t busIndex;
+    uint16_t address;
+    const char *pSend;
+    size_t bytesToSend;
+    char *pReceive;
+    size_t bytesToReceive;
+    uPortBusAsyncCallback_t pCallback;
+    void *pParam;
+} uPortBusAsyncTransaction_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Mutex to protect gBus; created when the first bus is used
+ * asynchronously and deleted when the last one is stopped.
+ */
+static uPortMutexHandle_t gMutex = NULL;
+
+/** The buses that are in asynchronous use.
+ */
+static uPortBusAsync_t gBus[U_PORT_BUS_ASYNC_MAX_NUM_BUSES] = {0};
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Find the entry in gBus for the given bus, returning -1 if there
+// is none: gMutex must be locked before this is called.
+static int32_t findBus(bool isSpi, int32_t handle)
+{
+    int32_t index = -1;
+
+    for (size_t x = 0; (x < sizeof(gBus) / sizeof(gBus[0])) && (index < 0); x++) {
+        if (gBus[x].inUse && (gBus[x].isSpi == isSpi) &&
+            (gBus[x].handle == handle)) {
+            index = (int32_t) x;
+        }
+    }
+
+    return index;
+}
+
+// Event queue callback: carry out a transaction with the blocking
+// function of the platform and then tell the caller how it went.
+static void transactionCallback(void *pParam, size_t paramLength)
+{
+    uPortBusAsyncTransaction_t *pTransaction = (uPortBusAsyncTransaction_t *) pParam;
+    uPortBusAsync_t *pBus = &(gBus[pTransaction->busIndex]);
+    int32_t sizeOrErrorCode;
+
+    (void) paramLength;
+
+    // The entry in gBus cannot change while a transaction on it
+    // is outstanding, so no need to lock gMutex to read it
+    if (pBus->isSpi) {
+        sizeOrErrorCode = uPortSpiControllerSendReceiveBlock(pBus->handle,
+                                                             pTransaction->pSend,
+                                                             pTransaction->bytesToSend,
+                                                             pTransaction->pReceive,
+                                                             pTransaction->bytesToReceive);
+    } else {
+        sizeOrErrorCode = uPortI2cControllerSendReceive(pBus->handle,
+                                                        pTransaction->address,
+                                                        pTransaction->pSend,
+                                                        pTransaction->bytesToSend,
+                                                        pTransaction->pReceive,
+                                                        pTransaction->bytesToReceive);
+    }
+    pTransaction->pCallback(pBus->handle, sizeOrErrorCode, pTransaction->pParam);
+
+    U_PORT_MUTEX_LOCK(gMutex);
+    if (pBus->numOutstanding > 0) {
+        pBus->numOutstanding--;
+    }
+    U_PORT_MUTEX_UNLOCK(gMutex);
+}
+
+// Queue a transaction on a bus, opening an event queue for the
+// bus if it doesn't already have one.
+static int32_t transactionQueue(bool isSpi, int32_t handle,
+                                uPortBusAsyncTransaction_t *pTransaction)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t index;
+    uPortBusAsync_t *pBus;
+
+    if (gMutex == NULL) {
+        errorCode = uPortMutexCreate(&gMutex);
+    }
+    if (errorCode == 0) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        index = findBus(isSpi, handle);
+        if (index < 0) {
+            // Not in use yet: open an event queue for it
+            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            for (size_t x = 0; (x < sizeof(gBus) / sizeof(gBus[0])) && (index < 0); x++) {
+                if (!gBus[x].inUse) {
+                    errorCode = uPortEventQueueOpen(transactionCallback,
+                                                    isSpi ? "spiAsync" : "i2cAsync",
+                                                    sizeof(uPortBusAsyncTransaction_t),
+                                                    U_PORT_BUS_ASYNC_TASK_STACK_SIZE_BYTES,
+                                                    U_PORT_BUS_ASYNC_TASK_PRIORITY,
+                                                    U_PORT_BUS_ASYNC_QUEUE_LENGTH);
+                    if (errorCode >= 0) {
+                        gBus[x].inUse = true;
+                        gBus[x].isSpi = isSpi;
+                        gBus[x].handle = handle;
+                        gBus[x].eventQueueHandle = errorCode;
+                        gBus[x].numOutstanding = 0;
+                        index = (int32_t) x;
+                    }
+                    // Leave the for() loop either way
+                    x = sizeof(gBus) / sizeof(gBus[0]);
+                }
+            }
+        }
+        if (index >= 0) {
+            pBus = &(gBus[index]);
+            pTransaction->busIndex = (size_t) index;
+            pBus->numOutstanding++;
+            // Must unlock the mutex while sending since, if the queue
+            // is full, uPortEventQueueSend() will block until
+            // transactionCallback() has made room and it needs gMutex;
+            // uPortMutexUnlock()/uPortMutexLock() are called directly
+            // as the U_PORT_MUTEX_xxx() macros have to be balanced
+            uPortMutexUnlock(gMutex);
+            errorCode = uPortEventQueueSend(pBus->eventQueueHandle,
+                                            pTransaction, sizeof(*pTransaction));
+            uPortMutexLock(gMutex);
+            if ((errorCode < 0) && (pBus->numOutstanding > 0)) {
+                pBus->numOutstanding--;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return errorCode;
+}
+
+// Stop asynchronous use of a bus, waiting for anything outstanding
+// to complete, and free gMutex if nothing else is in use.
+static int32_t busStop(bool isSpi, int32_t handle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t index;
+    bool anyInUse = false;
+    uPortMutexHandle_t mutex;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        index = findBus(isSpi, handle);
+        if (index >= 0) {
+            while (gBus[index].numOutstanding > 0) {
+                // Let transactionCallback() have the mutex; called
+                // directly as the U_PORT_MUTEX_xxx() macros have
+                // to be balanced
+                uPortMutexUnlock(gMutex);
+                uPortTaskBlock(U_PORT_BUS_ASYNC_STOP_POLL_MS);
+                uPortMutexLock(gMutex);
+            }
+            errorCode = uPortEventQueueClose(gBus[index].eventQueueHandle);
+            gBus[index].inUse = false;
+        }
+        for (size_t x = 0; (x < sizeof(gBus) / sizeof(gBus[0])) && !anyInUse; x++) {
+            anyInUse = gBus[x].inUse;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if (!anyInUse) {
+            mutex = gMutex;
+            gMutex = NULL;
+            uPortMutexDelete(mutex);
+        }
+    }
+
+    return errorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Default implementation of an asynchronous I2C transaction:
+// queued on an event queue for the bus.
+U_WEAK int32_t uPortI2cControllerSendReceiveAsync(int32_t handle, uint16_t address,
+                                                  const char *pSend, size_t bytesToSend,
+                                                  char *pReceive, size_t bytesToReceive,
+                                                  uPortI2cCallback_t pCallback,
+                                                  void *pParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortBusAsyncTransaction_t transaction;
+
+    if ((handle >= 0) && (pCallback != NULL) &&
+        ((pSend != NULL) || (bytesToSend == 0)) &&
+        ((pReceive != NULL) || (bytesToReceive == 0))) {
+        transaction.address = address;
+        transaction.pSend = pSend;
+        transaction.bytesToSend = bytesToSend;
+        transaction.pReceive = pReceive;
+        transaction.bytesToReceive = bytesToReceive;
+        transaction.pCallback = pCallback;
+        transaction.pParam = pParam;
+        errorCode = transactionQueue(false, handle, &transaction);
+        if (errorCode > 0) {
+            // uPortEventQueueSend() returns zero on success, this
+            // is just in case a platform returns something else
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+    }
+
+    return errorCode;
+}
+
+// Default implementation of stopping asynchronous I2C.
+U_WEAK int32_t uPortI2cControllerAsyncStop(int32_t handle)
+{
+    return busStop(false, handle);
+}
+
+// Default implementation of an asynchronous SPI transaction:
+// queued on an event queue for the bus.
+U_WEAK int32_t uPortSpiControllerSendReceiveBlockAsync(int32_t handle,
+                                                       const char *pSend,
+                                                       size_t bytesToSend,
+                                                       char *pReceive,
+                                                       size_t bytesToReceive,
+                                                       uPortSpiCallback_t pCallback,
+                                                       void *pParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uPortBusAsyncTransaction_t transaction;
+
+    if ((handle >= 0) && (pCallback != NULL) &&
+        ((pSend != NULL) || (bytesToSend == 0)) &&
+        ((pReceive != NULL) || (bytesToReceive == 0))) {
+        transaction.address = 0;
+        transaction.pSend = pSend;
+        transaction.bytesToSend = bytesToSend;
+        transaction.pReceive = pReceive;
+        transaction.bytesToReceive = bytesToReceive;
+        transaction.pCallback = pCallback;
+        transaction.pParam = pParam;
+        errorCode = transactionQueue(true, handle, &transaction);
+        if (errorCode > 0) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        }
+    }
+
+    return errorCode;
+}
+
+// Default implementation of stopping asynchronous SPI.
+U_WEAK int32_t uPortSpiControllerAsyncStop(int32_t handle)
+{
+    return busStop(true, handle);
+}
+
+// End of file
@@ -16,7 +16,8 @@
 
 /** @file
  * @brief Default implementation of pUPortMalloc() / uPortFree() and
- * uPortHeapAllocCount().
+ * uPortHeapAllocCount(), plus the optional fixed-block front-end,
+ * built on u_mempool, which is included if U_CFG_HEAP_SLAB is defined.
  */
 
 #ifdef U_CFG_OVERRIDE
@@ -46,6 +47,10 @@
 #include "u_port_heap.h"
 #include "u_port_debug.h"
 
+#ifdef U_CFG_HEAP_SLAB
+# include "u_mempool.h"
+#endif
+
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
@@ -133,6 +138,25 @@ static int32_t gHeapAllocCount = 0;
  */
 static int32_t gHeapPerpetualAllocCount = 0;
 
+#ifdef U_CFG_HEAP_SLAB
+/** The block size of each size class.
+ */
+static const size_t gSlabBlockSize[] = {U_PORT_HEAP_SLAB_BLOCK_SIZES};
+
+/** The number of blocks in each size class.
+ */
+static const int32_t gSlabBlockCount[] = {U_PORT_HEAP_SLAB_BLOCK_COUNTS};
+
+/** The pool of each size class.
+ */
+static uMemPoolDesc_t gSlabPool[sizeof(gSlabBlockSize) / sizeof(gSlabBlockSize[0])];
+
+/** Set to true once the pools are ready to be used, which
+ * is only ever done once.
+ */
+static bool gSlabReady = false;
+#endif
+
 #ifdef U_CFG_HEAP_MONITOR
 /** Root of linked list of blocks on the heap.
  */
@@ -152,6 +176,29 @@ static int32_t (*gpMutexLock) (const uPortMutexHandle_t) = NULL;
  */
 static int32_t (*gpMutexUnlock) (const uPortMutexHandle_t) = NULL;
 
+# ifdef U_CFG_HEAP_PROFILE
+/** The profile of each call site, protected by gMutex.
+ */
+static uPortHeapProfileSite_t gProfileSite[U_PORT_HEAP_PROFILE_MAX_NUM_SITES];
+
+/** The number of entries used in gProfileSite.
+ */
+static size_t gProfileNumSites = 0;
+
+/** The number of allocations from call sites that did not fit
+ * into gProfileSite.
+ */
+static int32_t gProfileUnprofiledCount = 0;
+
+/** The number of bytes currently allocated, across all call sites.
+ */
+static int32_t gProfileLiveBytes = 0;
+
+/** The largest value gProfileLiveBytes has had.
+ */
+static int32_t gProfilePeakLiveBytes = 0;
+# endif
+
 #endif
 
 /* ----------------------------------------------------------------
@@ -182,6 +229,199 @@ static void printMemory(const char *pMemory, size_t size)
         }
     }
 }
+
+# ifdef U_CFG_HEAP_PROFILE
+// Find the profile of a call site, adding it if addIt is true;
+// gMutex must be locked.
+static uPortHeapProfileSite_t *pProfileSiteGet(const char *pFile,
+                                               int32_t line, bool addIt)
+{
+    uPortHeapProfileSite_t *pSite = NULL;
+
+    for (size_t x = 0; (x < gProfileNumSites) && (pSite == NULL); x++) {
+        // __FILE__ gives the same pointer for every call from a file
+        if ((gProfileSite[x].line == line) && (gProfileSite[x].pFile == pFile)) {
+            pSite = &(gProfileSite[x]);
+        }
+    }
+    if ((pSite == NULL) && addIt &&
+        (gProfileNumSites < sizeof(gProfileSite) / sizeof(gProfileSite[0]))) {
+        pSite = &(gProfileSite[gProfileNumSites]);
+        memset(pSite, 0, sizeof(*pSite));
+        pSite->pFile = pFile;
+        pSite->line = line;
+        gProfileNumSites++;
+    }
+
+    return pSite;
+}
+
+// Add an allocation to the profile; gMutex must be locked.
+static void profileAlloc(const char *pFile, int32_t line, int32_t size)
+{
+    uPortHeapProfileSite_t *pSite = pProfileSiteGet(pFile, line, true);
+    size_t sizeClass = 0;
+    int32_t sizeClassLimit = 16;
+
+    gProfileLiveBytes += size;
+    if (gProfileLiveBytes > gProfilePeakLiveBytes) {
+        gProfilePeakLiveBytes = gProfileLiveBytes;
+    }
+    if (pSite != NULL) {
+        pSite->allocCount++;
+        pSite->allocBytes += size;
+        pSite->liveBytes += size;
+        if (pSite->liveBytes > pSite->peakLiveBytes) {
+            pSite->peakLiveBytes = pSite->liveBytes;
+        }
+        while ((sizeClass < U_PORT_HEAP_PROFILE_NUM_SIZE_CLASSES - 1) &&
+               (size > sizeClassLimit)) {
+            sizeClassLimit <<= 1;
+            sizeClass++;
+        }
+        pSite->sizeClassCount[sizeClass]++;
+    } else {
+        gProfileUnprofiledCount++;
+    }
+}
+
+// Remove an allocation from the profile; gMutex must be locked.
+static void profileFree(const char *pFile, int32_t line, int32_t size)
+{
+    uPortHeapProfileSite_t *pSite = pProfileSiteGet(pFile, line, false);
+
+    gProfileLiveBytes -= size;
+    if (pSite != NULL) {
+        pSite->liveBytes -= size;
+    }
+}
+
+// Print the profile, hottest call site first.
+static void printProfile(const char *pPrefix)
+{
+    bool printed[U_PORT_HEAP_PROFILE_MAX_NUM_SITES] = {0};
+    const uPortHeapProfileSite_t *pSite;
+    size_t next;
+
+    uPortLog("%sPROFILE %d call site(s), %d unprofiled allocation(s), %d byte(s)"
+             " live, peak %d.\n", pPrefix, (int32_t) gProfileNumSites,
+             gProfileUnprofiledCount, gProfileLiveBytes, gProfilePeakLiveBytes);
+    for (size_t x = 0; x < gProfileNumSites; x++) {
+        next = gProfileNumSites;
+        for (size_t y = 0; y < gProfileNumSites; y++) {
+            if (!printed[y] && ((next == gProfileNumSites) ||
+                                (gProfileSite[y].allocCount > gProfileSite[next].allocCount))) {
+                next = y;
+            }
+        }
+        printed[next] = true;
+        pSite = &(gProfileSite[next]);
+        uPortLog("%sSITE %s:%d %d alloc(s) %d byte(s), live %d, peak %d, sizes",
+                 pPrefix, pSite->pFile, pSite->line, pSite->allocCount,
+                 pSite->allocBytes, pSite->liveBytes, pSite->peakLiveBytes);
+        for (size_t y = 0; y < U_PORT_HEAP_PROFILE_NUM_SIZE_CLASSES; y++) {
+            uPortLog(" %d", pSite->sizeClassCount[y]);
+        }
+        uPortLog(".\n");
+    }
+}
+# endif
+#endif
+
+#ifdef U_CFG_HEAP_SLAB
+// Set up the pools of the fixed-block front-end.
+static int32_t slabInit()
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    size_t numClasses = sizeof(gSlabPool) / sizeof(gSlabPool[0]);
+    size_t x;
+    int32_t heapAllocCount = gHeapAllocCount;
+    int32_t heapPerpetualAllocCount = gHeapPerpetualAllocCount;
+
+    if (!gSlabReady) {
+        if (sizeof(gSlabBlockCount) / sizeof(gSlabBlockCount[0]) != numClasses) {
+            errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        }
+        for (x = 1; (errorCode == 0) && (x < numClasses); x++) {
+            if (gSlabBlockSize[x] <= gSlabBlockSize[x - 1]) {
+                errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+            }
+        }
+        for (x = 0; (errorCode == 0) && (x < numClasses); x++) {
+            errorCode = uMemPoolInit(&(gSlabPool[x]), (uint32_t) gSlabBlockSize[x],
+                                     gSlabBlockCount[x]);
+            if (errorCode == 0) {
+                // This also allocates the buffer of the pool now,
+                // while the platform heap is not yet fragmented,
+                // and means that no mutex is taken per allocation
+                errorCode = uMemPoolSetLockFree(&(gSlabPool[x]));
+                if (errorCode != 0) {
+                    uMemPoolDeinit(&(gSlabPool[x]));
+                }
+            }
+        }
+        if (errorCode == 0) {
+            // The mutexes of the pools are never deleted, mark
+            // them as perpetual for accounting purposes
+            for (x = 0; x < numClasses; x++) {
+                uPortOsResourcePerpetualAdd(U_PORT_OS_RESOURCE_TYPE_MUTEX);
+            }
+            gSlabReady = true;
+        } else {
+            // Tidy up: this does nothing to a pool that
+            // was never set up
+            for (x = 0; x < numClasses; x++) {
+                uMemPoolDeinit(&(gSlabPool[x]));
+            }
+        }
+        // The pools are part of the heap rather than allocations
+        // from it: leave them out of the heap accounting
+        gHeapAllocCount = heapAllocCount;
+        gHeapPerpetualAllocCount = heapPerpetualAllocCount;
+    }
+
+    return errorCode;
+}
+
+// Allocate a block from the pool of the size class that fits
+// sizeBytes, returning NULL so that the caller goes to the
+// platform heap if there is no such size class or it is empty.
+static void *pSlabAlloc(size_t sizeBytes)
+{
+    void *pMemory = NULL;
+    size_t numClasses = sizeof(gSlabPool) / sizeof(gSlabPool[0]);
+    size_t x = 0;
+
+    if (gSlabReady) {
+        while ((x < numClasses) && (sizeBytes > gSlabBlockSize[x])) {
+            x++;
+        }
+        if (x < numClasses) {
+            pMemory = uMemPoolAllocMem(&(gSlabPool[x]));
+        }
+    }
+
+    return pMemory;
+}
+
+// Free a block if it belongs to one of the pools, returning
+// true if it did.
+static bool slabFree(void *pMemory)
+{
+    bool freed = false;
+    size_t numClasses = sizeof(gSlabPool) / sizeof(gSlabPool[0]);
+
+    if (gSlabReady && (pMemory != NULL)) {
+        for (size_t x = 0; (x < numClasses) && !freed; x++) {
+            if (uMemPoolContains(&(gSlabPool[x]), pMemory)) {
+                uMemPoolFreeMem(&(gSlabPool[x]), pMemory);
+                freed = true;
+            }
+        }
+    }
+
+    return freed;
+}
 #endif
 
 /* ----------------------------------------------------------------
@@ -196,7 +436,14 @@ static void *_pUPortMalloc(size_t sizeBytes)
 U_WEAK void *pUPortMalloc(size_t sizeBytes)
 #endif
 {
-    void *pMalloc = malloc(sizeBytes);
+    void *pMalloc = NULL;
+
+#ifdef U_CFG_HEAP_SLAB
+    pMalloc = pSlabAlloc(sizeBytes);
+#endif
+    if (pMalloc == NULL) {
+        pMalloc = malloc(sizeBytes);
+    }
     if (pMalloc != NULL) {
         gHeapAllocCount++;
     }
@@ -245,6 +492,9 @@ void *pUPortMallocMonitor(size_t sizeBytes, const char *pFile,
             pBlockTmp = gpHeapBlockList;
             gpHeapBlockList = pBlock;
             pBlock->pNext = pBlockTmp;
+# ifdef U_CFG_HEAP_PROFILE
+            profileAlloc(pFile, line, pBlock->size);
+# endif
 
             U_PORT_HEAP_MUTEX_UNLOCK(gMutex);
         }
@@ -306,6 +556,9 @@ U_WEAK void uPortFree(void *pMemory)
             } else {
                 pBlockTmp2->pNext = pBlockTmp1->pNext;
             }
+# ifdef U_CFG_HEAP_PROFILE
+            profileFree(pBlock->pFile, pBlock->line, pBlock->size);
+# endif
         }
 
         U_PORT_HEAP_MUTEX_UNLOCK(gMutex);
@@ -317,7 +570,13 @@ U_WEAK void uPortFree(void *pMemory)
 #endif
 
     gHeapAllocCount--;
+#ifdef U_CFG_HEAP_SLAB
+    if (!slabFree(pMemory)) {
+        free(pMemory);
+    }
+#else
     free(pMemory);
+#endif
 }
 
 U_WEAK int32_t uPortHeapAllocCount()
@@ -351,6 +610,9 @@ int32_t uPortHeapDump(const char *pPrefix)
         pPrefix = "";
     }
     uPortLog("%s%d block(s).\n", pPrefix, x);
+# ifdef U_CFG_HEAP_PROFILE
+    printProfile(pPrefix);
+# endif
 #else
     (void) pPrefix;
 #endif
@@ -358,6 +620,82 @@ int32_t uPortHeapDump(const char *pPrefix)
     return x;
 }
 
+// Get the statistics of a size class of the fixed-block front-end.
+int32_t uPortHeapSlabGetStatistics(size_t sizeClass,
+                                   uPortHeapSlabStatistics_t *pStatistics)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+#ifdef U_CFG_HEAP_SLAB
+    uMemPoolStatistics_t statistics;
+
+    if (gSlabReady) {
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((sizeClass < sizeof(gSlabPool) / sizeof(gSlabPool[0])) &&
+            (pStatistics != NULL)) {
+            errorCode = uMemPoolGetStatistics(&(gSlabPool[sizeClass]), &statistics);
+            if (errorCode == 0) {
+                pStatistics->blockSizeBytes = gSlabBlockSize[sizeClass];
+                pStatistics->totalBlockCount = statistics.totalBlockCount;
+                pStatistics->usedBlockCount = statistics.usedBlockCount;
+                pStatistics->maxUsedBlockCount = statistics.maxUsedBlockCount;
+                pStatistics->fallbackCount = statistics.allocFailCount;
+            }
+        }
+    }
+#else
+    (void) sizeClass;
+    (void) pStatistics;
+#endif
+
+    return errorCode;
+}
+
+// Get the profile of a call site.
+int32_t uPortHeapProfileGet(size_t index, uPortHeapProfileSite_t *pSite)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+#if defined(U_CFG_HEAP_MONITOR) && defined(U_CFG_HEAP_PROFILE)
+    errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    if (pSite != NULL) {
+        if (gMutex != NULL) {
+            U_PORT_HEAP_MUTEX_LOCK(gMutex);
+            if (index < gProfileNumSites) {
+                *pSite = gProfileSite[index];
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+            U_PORT_HEAP_MUTEX_UNLOCK(gMutex);
+        }
+    }
+#else
+    (void) index;
+    (void) pSite;
+#endif
+
+    return errorCode;
+}
+
+// Reset the profile of all call sites.
+void uPortHeapProfileReset()
+{
+#if defined(U_CFG_HEAP_MONITOR) && defined(U_CFG_HEAP_PROFILE)
+    uPortHeapProfileSite_t *pSite;
+
+    if (gMutex != NULL) {
+        U_PORT_HEAP_MUTEX_LOCK(gMutex);
+        for (size_t x = 0; x < gProfileNumSites; x++) {
+            pSite = &(gProfileSite[x]);
+            pSite->allocCount = 0;
+            pSite->allocBytes = 0;
+            pSite->peakLiveBytes = pSite->liveBytes;
+            memset(pSite->sizeClassCount, 0, sizeof(pSite->sizeClassCount));
+        }
+        gProfileUnprofiledCount = 0;
+        gProfilePeakLiveBytes = gProfileLiveBytes;
+        U_PORT_HEAP_MUTEX_UNLOCK(gMutex);
+    }
+#endif
+}
+
 // Initialise heap monitoring.
 int32_t uPortHeapMonitorInit(int32_t (*pMutexCreate) (uPortMutexHandle_t *),
                              int32_t (*pMutexLock) (const uPortMutexHandle_t),
@@ -382,6 +720,11 @@ int32_t uPortHeapMonitorInit(int32_t (*pMutexCreate) (uPortMutexHandle_t *),
         }
     }
 #endif
+#ifdef U_CFG_HEAP_SLAB
+    if (errorCode == 0) {
+        errorCode = slabInit();
+    }
+#endif
 
     return errorCode;
 }
@@ -0,0 +1,901 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/** @file
+ * @brief A deferred backend for uPortLog(): instead of formatting
+ * the print in the context of the caller, the format pointer and
+ * the arguments are captured into a lock-free ring buffer and the
+ * formatting is performed later by a low-priority task (or by
+ * uPortLogDeferredFlush()), taking the cost of printf() out of
+ * time-critical paths such as the AT client.
+ *
+ * The ring is a fixed array of entries; a writer reserves an entry
+ * by advancing the write count with a compare-and-exchange, fills
+ * it in and then publishes it by writing the entry's sequence
+ * number last.  There is only one reader at a time (protected by
+ * a mutex) and it reads an entry only once its sequence number
+ * shows that it has been published, advancing the read count
+ * when done.  If the ring is full the print is dropped and
+ * counted, no writer ever blocks.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "stdarg.h"    // va_list
+#include "string.h"    // memset(), memcpy()
+#include "stdio.h"     // snprintf(), vsnprintf()
+
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port_clib_platform_specific.h" /* Integer stdio, must
+                                              be included before
+                                              the other port files
+                                              if any print or scan
+                                              function is used. */
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_heap.h"
+#include "u_port_atomic.h"
+#include "u_port_debug.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The maximum length of the flags part of a conversion
+ * specification that is reproduced when formatting.
+ */
+#define U_PORT_LOG_DEFERRED_FLAGS_MAX_LENGTH 5
+
+/** Value used for a width or precision to indicate that there
+ * is none.
+ */
+#define U_PORT_LOG_DEFERRED_FIELD_NONE -1
+
+/** Value used for a width or precision to indicate that it
+ * is given by an argument, i.e. "*".
+ */
+#define U_PORT_LOG_DEFERRED_FIELD_ARGUMENT -2
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The type of argument that a conversion specification consumes.
+ */
+typedef enum {
+    U_PORT_LOG_DEFERRED_ARG_TYPE_NONE,     /**< %% or unrecognised. */
+    U_PORT_LOG_DEFERRED_ARG_TYPE_SIGNED,   /**< d, i. */
+    U_PORT_LOG_DEFERRED_ARG_TYPE_UNSIGNED, /**< u, x, X, o. */
+    U_PORT_LOG_DEFERRED_ARG_TYPE_CHAR,     /**< c. */
+    U_PORT_LOG_DEFERRED_ARG_TYPE_DOUBLE,   /**< f, F, e, E, g, G, a, A. */
+    U_PORT_LOG_DEFERRED_ARG_TYPE_POINTER,  /**< p, and n which is consumed
+                                                but never written. */
+    U_PORT_LOG_DEFERRED_ARG_TYPE_STRING    /**< s. */
+} uPortLogDeferredArgType_t;
+
+/** The length modifier of a conversion specification.
+ */
+typedef enum {
+    U_PORT_LOG_DEFERRED_LENGTH_NONE,
+    U_PORT_LOG_DEFERRED_LENGTH_HH,
+    U_PORT_LOG_DEFERRED_LENGTH_H,
+    U_PORT_LOG_DEFERRED_LENGTH_L,
+    U_PORT_LOG_DEFERRED_LENGTH_LL,
+    U_PORT_LOG_DEFERRED_LENGTH_LONG_DOUBLE,
+    U_PORT_LOG_DEFERRED_LENGTH_Z,
+    U_PORT_LOG_DEFERRED_LENGTH_J,
+    U_PORT_LOG_DEFERRED_LENGTH_T
+} uPortLogDeferredLength_t;
+
+/** A parsed conversion specification.
+ */
+typedef struct {
+    const char *pFlags;
+    size_t flagsLength;
+    int32_t width;     /**< a value, #U_PORT_LOG_DEFERRED_FIELD_NONE
+                            or #U_PORT_LOG_DEFERRED_FIELD_ARGUMENT. */
+    int32_t precision; /**< as width. */
+    uPortLogDeferredLength_t length;
+    char conversion;   /**< zero if the format ended mid-specification. */
+    uPortLogDeferredArgType_t type;
+} uPortLogDeferredSpec_t;
+
+/** A captured argument; for a string the value is the offset of
+ * the copy in the strings area of the entry, or negative if the
+ * string pointer was NULL.
+ */
+typedef union {
+    long long i;
+    unsigned long long u;
+    double d;
+    const void *p;
+} uPortLogDeferredArg_t;
+
+/** An entry in the ring.
+ */
+typedef struct {
+    volatile uint32_t sequence; /**< the write count of the entry plus
+                                     one, written last to publish it. */
+    const char *pFormat;
+    size_t numArgs;
+    uPortLogDeferredArg_t arg[U_PORT_LOG_DEFERRED_ARGS_MAX_NUM];
+    char strings[U_PORT_LOG_DEFERRED_STRINGS_LENGTH_BYTES];
+} uPortLogDeferredEntry_t;
+
+/** The context of deferred logging.
+ */
+typedef struct {
+    volatile uint32_t writeCount;
+    volatile uint32_t readCount;
+    volatile int32_t lostCount;
+    int32_t lostCountReported;
+    volatile int32_t taskStop;
+    uPortMutexHandle_t mutex; /**< held by whoever is reading the ring. */
+    uPortSemaphoreHandle_t taskExitedSemaphore;
+    uPortTaskHandle_t taskHandle;
+    void (*pOutput)(const char *, void *);
+    void *pOutputParam;
+    size_t lineLength;
+    char line[U_PORT_LOG_DEFERRED_LINE_LENGTH_BYTES];
+    uPortLogDeferredEntry_t entry[U_PORT_LOG_DEFERRED_NUM_ENTRIES];
+} uPortLogDeferredContext_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** The context, NULL if deferred logging has not been initialised.
+ */
+static uPortLogDeferredContext_t *gpContext = NULL;
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: ATOMIC ACCESS
+ * -------------------------------------------------------------- */
+
+// Read a uint32_t atomically.
+static uint32_t atomicLoadU32(const volatile uint32_t *pValue)
+{
+    return (uint32_t) uPortAtomicLoad((const volatile int32_t *) pValue);
+}
+
+// Write a uint32_t atomically.
+static void atomicStoreU32(volatile uint32_t *pValue, uint32_t value)
+{
+    uPortAtomicStore((volatile int32_t *) pValue, (int32_t) value);
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: FORMAT PARSING
+ * -------------------------------------------------------------- */
+
+// Parse a decimal number or a "*" for a width or precision.
+static const char *pParseField(const char *pStr, int32_t *pValue)
+{
+    if (*pStr == '*') {
+        *pValue = U_PORT_LOG_DEFERRED_FIELD_ARGUMENT;
+        pStr++;
+    } else if ((*pStr >= '0') && (*pStr <= '9')) {
+        *pValue = 0;
+        while ((*pStr >= '0') && (*pStr <= '9')) {
+            *pValue = (*pValue * 10) + (*pStr - '0');
+            pStr++;
+        }
+    }
+
+    return pStr;
+}
+
+// Parse the conversion specification at pStr, which must point to
+// the character after the '%', returning a pointer to the character
+// after the specification.
+static const char *pParseSpec(const char *pStr, uPortLogDeferredSpec_t *pSpec)
+{
+    memset(pSpec, 0, sizeof(*pSpec));
+    pSpec->width = U_PORT_LOG_DEFERRED_FIELD_NONE;
+    pSpec->precision = U_PORT_LOG_DEFERRED_FIELD_NONE;
+
+    pSpec->pFlags = pStr;
+    while ((*pStr == '-') || (*pStr == '+') || (*pStr == ' ') ||
+           (*pStr == '#') || (*pStr == '0')) {
+        pStr++;
+    }
+    pSpec->flagsLength = pStr - pSpec->pFlags;
+    pStr = pParseField(pStr, &pSpec->width);
+    if (*pStr == '.') {
+        pStr++;
+        // A "." on its own means a precision of zero
+        pSpec->precision = 0;
+        pStr = pParseField(pStr, &pSpec->precision);
+    }
+    switch (*pStr) {
+        case 'h':
+            pStr++;
+            pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_H;
+            if (*pStr == 'h') {
+                pStr++;
+                pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_HH;
+            }
+            break;
+        case 'l':
+            pStr++;
+            pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_L;
+            if (*pStr == 'l') {
+                pStr++;
+                pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_LL;
+            }
+            break;
+        case 'L':
+            pStr++;
+            pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_LONG_DOUBLE;
+            break;
+        case 'z':
+            pStr++;
+            pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_Z;
+            break;
+        case 'j':
+            pStr++;
+            pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_J;
+            break;
+        case 't':
+            pStr++;
+            pSpec->length = U_PORT_LOG_DEFERRED_LENGTH_T;
+            break;
+        default:
+            break;
+    }
+    pSpec->conversion = *pStr;
+    switch (pSpec->conversion) {
+        case 'd':
+        case 'i':
+            pSpec->type = U_PORT_LOG_DEFERRED_ARG_TYPE_SIGNED;
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            pSpec->type = U_PORT_LOG_DEFERRED_ARG_TYPE_UNSIGNED;
+            break;
+        case 'c':
+            pSpec->type = U_PORT_LOG_DEFERRED_ARG_TYPE_CHAR;
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            pSpec->type = U_PORT_LOG_DEFERRED_ARG_TYPE_DOUBLE;
+            break;
+        case 'p':
+        case 'n':
+            pSpec->type = U_PORT_LOG_DEFERRED_ARG_TYPE_POINTER;
+            break;
+        case 's':
+            pSpec->type = U_PORT_LOG_DEFERRED_ARG_TYPE_STRING;
+            break;
+        default:
+            break;
+    }
+    if (pSpec->conversion != 0) {
+        pStr++;
+    }
+
+    return pStr;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: CAPTURE
+ * -------------------------------------------------------------- */
+
+// Read a signed integer argument of the given length.
+static long long argSigned(va_list *pArgs, uPortLogDeferredLength_t length)
+{
+    long long value;
+
+    switch (length) {
+        case U_PORT_LOG_DEFERRED_LENGTH_HH:
+            value = (signed char) va_arg(*pArgs, int);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_H:
+            value = (short) va_arg(*pArgs, int);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_L:
+            value = va_arg(*pArgs, long);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_LL:
+            value = va_arg(*pArgs, long long);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_Z:
+            value = (long long) va_arg(*pArgs, size_t);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_J:
+            value = (long long) va_arg(*pArgs, intmax_t);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_T:
+            value = (long long) va_arg(*pArgs, ptrdiff_t);
+            break;
+        default:
+            value = va_arg(*pArgs, int);
+            break;
+    }
+
+    return value;
+}
+
+// Read an unsigned integer argument of the given length.
+static unsigned long long argUnsigned(va_list *pArgs,
+                                      uPortLogDeferredLength_t length)
+{
+    unsigned long long value;
+
+    switch (length) {
+        case U_PORT_LOG_DEFERRED_LENGTH_HH:
+            value = (unsigned char) va_arg(*pArgs, unsigned int);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_H:
+            value = (unsigned short) va_arg(*pArgs, unsigned int);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_L:
+            value = va_arg(*pArgs, unsigned long);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_LL:
+            value = va_arg(*pArgs, unsigned long long);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_Z:
+            value = va_arg(*pArgs, size_t);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_J:
+            value = (unsigned long long) va_arg(*pArgs, uintmax_t);
+            break;
+        case U_PORT_LOG_DEFERRED_LENGTH_T:
+            value = (unsigned long long) va_arg(*pArgs, ptrdiff_t);
+            break;
+        default:
+            value = va_arg(*pArgs, unsigned int);
+            break;
+    }
+
+    return value;
+}
+
+// Capture the arguments of pFormat into an entry; strings are
+// copied, up to their precision if they have one, for as long as
+// there is room.  Capture stops when the entry has no more room
+// for arguments, any conversion specifications after that are
+// printed literally.
+static void capture(uPortLogDeferredEntry_t *pEntry, const char *pFormat,
+                    va_list *pArgs)
+{
+    uPortLogDeferredSpec_t spec;
+    uPortLogDeferredArg_t *pArg = pEntry->arg;
+    size_t stringsLength = 0;
+    const char *pStr;
+    int32_t precision;
+    size_t x;
+
+    pEntry->pFormat = pFormat;
+    pEntry->numArgs = 0;
+    while ((*pFormat != 0) && (pEntry->numArgs < U_PORT_LOG_DEFERRED_ARGS_MAX_NUM)) {
+        if (*pFormat != '%') {
+            pFormat++;
+            continue;
+        }
+        pFormat = pParseSpec(pFormat + 1, &spec);
+        // A width and precision given by "*" are each an int
+        // argument that comes before the converted one; they take
+        // up an entry each
+        precision = spec.precision;
+        if ((spec.width == U_PORT_LOG_DEFERRED_FIELD_ARGUMENT) &&
+            (pEntry->numArgs < U_PORT_LOG_DEFERRED_ARGS_MAX_NUM)) {
+            pArg[pEntry->numArgs].i = va_arg(*pArgs, int);
+            pEntry->numArgs++;
+        }
+        if ((spec.precision == U_PORT_LOG_DEFERRED_FIELD_ARGUMENT) &&
+            (pEntry->numArgs < U_PORT_LOG_DEFERRED_ARGS_MAX_NUM)) {
+            precision = va_arg(*pArgs, int);
+            pArg[pEntry->numArgs].i = precision;
+            pEntry->numArgs++;
+        }
+        if ((spec.type != U_PORT_LOG_DEFERRED_ARG_TYPE_NONE) &&
+            (pEntry->numArgs < U_PORT_LOG_DEFERRED_ARGS_MAX_NUM)) {
+            switch (spec.type) {
+                case U_PORT_LOG_DEFERRED_ARG_TYPE_SIGNED:
+                    pArg[pEntry->numArgs].i = argSigned(pArgs, spec.length);
+                    break;
+                case U_PORT_LOG_DEFERRED_ARG_TYPE_UNSIGNED:
+                    pArg[pEntry->numArgs].u = argUnsigned(pArgs, spec.length);
+                    break;
+                case U_PORT_LOG_DEFERRED_ARG_TYPE_CHAR:
+                    pArg[pEntry->numArgs].i = va_arg(*pArgs, int);
+                    break;
+                case U_PORT_LOG_DEFERRED_ARG_TYPE_DOUBLE:
+                    if (spec.length == U_PORT_LOG_DEFERRED_LENGTH_LONG_DOUBLE) {
+                        pArg[pEntry->numArgs].d = (double) va_arg(*pArgs, long double);
+                    } else {
+                        pArg[pEntry->numArgs].d = va_arg(*pArgs, double);
+                    }
+                    break;
+                case U_PORT_LOG_DEFERRED_ARG_TYPE_POINTER:
+                    pArg[pEntry->numArgs].p = va_arg(*pArgs, const void *);
+                    break;
+                case U_PORT_LOG_DEFERRED_ARG_TYPE_STRING:
+                    pStr = va_arg(*pArgs, const char *);
+                    pArg[pEntry->numArgs].i = -1;
+                    if ((pStr != NULL) && (stringsLength >= sizeof(pEntry->strings))) {
+                        // No room at all: point at the final terminator
+                        pArg[pEntry->numArgs].i = (long long) sizeof(pEntry->strings) - 1;
+                    } else if (pStr != NULL) {
+                        pArg[pEntry->numArgs].i = (long long) stringsLength;
+                        // Copy what fits, leaving room for a terminator
+                        for (x = 0; (pStr[x] != 0) &&
+                             ((precision < 0) || (x < (size_t) precision)) &&
+                             (stringsLength < sizeof(pEntry->strings) - 1); x++) {
+                            pEntry->strings[stringsLength] = pStr[x];
+                            stringsLength++;
+                        }
+                        if (stringsLength < sizeof(pEntry->strings)) {
+                            pEntry->strings[stringsLength] = 0;
+                            stringsLength++;
+                        }
+                    }
+                    break;
+                default:
+                    break;
+            }
+            pEntry->numArgs++;
+        }
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: FORMATTING
+ * -------------------------------------------------------------- */
+
+// Send the line buffer to the output and empty it.
+static void lineOutput(uPortLogDeferredContext_t *pContext)
+{
+    if (pContext->lineLength > 0) {
+        pContext->line[pContext->lineLength] = 0;
+        if (pContext->pOutput != NULL) {
+            pContext->pOutput(pContext->line, pContext->pOutputParam);
+        } else {
+            uPortLogF("%s", pContext->line);
+        }
+        pContext->lineLength = 0;
+    }
+}
+
+// Add a piece of literal text to the line buffer.
+static void lineAdd(uPortLogDeferredContext_t *pContext,
+                    const char *pStr, size_t length)
+{
+    size_t x;
+
+    while (length > 0) {
+        x = sizeof(pContext->line) - 1 - pContext->lineLength;
+        if (x > length) {
+            x = length;
+        }
+        memcpy(pContext->line + pContext->lineLength, pStr, x);
+        pContext->lineLength += x;
+        pStr += x;
+        length -= x;
+        if (pContext->lineLength >= sizeof(pContext->line) - 1) {
+            lineOutput(pContext);
+        }
+    }
+}
+
+// Format a single conversion, re-built in pSpecStr, into pBuffer,
+// returning what snprintf() returns.
+static int32_t formatConversion(char *pBuffer, size_t size,
+                                const char *pSpecStr,
+                                uPortLogDeferredArgType_t type,
+                                const uPortLogDeferredArg_t *pArg,
+                                const char *pStr)
+{
+    int32_t length = 0;
+
+    switch (type) {
+        case U_PORT_LOG_DEFERRED_ARG_TYPE_SIGNED:
+            length = snprintf(pBuffer, size, pSpecStr, pArg->i);
+            break;
+        case U_PORT_LOG_DEFERRED_ARG_TYPE_UNSIGNED:
+            length = snprintf(pBuffer, size, pSpecStr, pArg->u);
+            break;
+        case U_PORT_LOG_DEFERRED_ARG_TYPE_CHAR:
+            length = snprintf(pBuffer, size, pSpecStr, (int) pArg->i);
+            break;
+        case U_PORT_LOG_DEFERRED_ARG_TYPE_DOUBLE:
+            length = snprintf(pBuffer, size, pSpecStr, pArg->d);
+            break;
+        case U_PORT_LOG_DEFERRED_ARG_TYPE_POINTER:
+            length = snprintf(pBuffer, size, pSpecStr, pArg->p);
+            break;
+        case U_PORT_LOG_DEFERRED_ARG_TYPE_STRING:
+            length = snprintf(pBuffer, size, pSpecStr, pStr);
+            break;
+        default:
+            break;
+    }
+
+    return length;
+}
+
+// Format a single conversion, re-built in pSpecStr, into the line
+// buffer, making room first if it would not fit; anything longer
+// than the whole line buffer is formatted into a temporary buffer
+// from the heap and output on its own.
+static void lineAddConversion(uPortLogDeferredContext_t *pContext,
+                              const char *pSpecStr,
+                              uPortLogDeferredArgType_t type,
+                              const uPortLogDeferredArg_t *pArg,
+                              const char *pStr)
+{
+    int32_t length;
+    size_t room = sizeof(pContext->line) - pContext->lineLength;
+    char *pBuffer;
+
+    length = formatConversion(pContext->line + pContext->lineLength, room,
+                              pSpecStr, type, pArg, pStr);
+    if ((length >= 0) && ((size_t) length >= room) && (pContext->lineLength > 0)) {
+        // Didn't fit: send what we had and try again with the
+        // whole buffer
+        pContext->line[pContext->lineLength] = 0;
+        lineOutput(pContext);
+        room = sizeof(pContext->line);
+        length = formatConversion(pContext->line, room, pSpecStr, type, pArg, pStr);
+    }
+    if ((length >= 0) && ((size_t) length >= room)) {
+        // Too long for the line buffer, even on its own: format it
+        // into a buffer of the right size and output that directly
+        pBuffer = (char *) pUPortMalloc(length + 1);
+        if (pBuffer != NULL) {
+            formatConversion(pBuffer, length + 1, pSpecStr, type, pArg, pStr);
+            if (pContext->pOutput != NULL) {
+                pContext->pOutput(pBuffer, pContext->pOutputParam);
+            } else {
+                uPortLogF("%s", pBuffer);
+            }
+            uPortFree(pBuffer);
+            length = 0;
+        } else {
+            // No memory: output as much as fits
+            length = (int32_t) room - 1;
+        }
+    }
+    if (length > 0) {
+        pContext->lineLength += length;
+        if (pContext->lineLength >= sizeof(pContext->line) - 1) {
+            lineOutput(pContext);
+        }
+    }
+}
+
+// Format an entry through the line buffer to the output.
+static void format(uPortLogDeferredContext_t *pContext,
+                   const uPortLogDeferredEntry_t *pEntry)
+{
+    const char *pFormat = pEntry->pFormat;
+    const char *pStart;
+    const char *pStr;
+    uPortLogDeferredSpec_t spec;
+    uPortLogDeferredArg_t arg;
+    size_t argIndex = 0;
+    size_t required;
+    char specStr[U_PORT_LOG_DEFERRED_FLAGS_MAX_LENGTH + 32];
+    size_t x;
+
+    while (*pFormat != 0) {
+        pStart = pFormat;
+        while ((*pFormat != 0) && (*pFormat != '%')) {
+            pFormat++;
+        }
+        lineAdd(pContext, pStart, pFormat - pStart);
+        if (*pFormat == 0) {
+            break;
+        }
+        pStart = pFormat;
+        pFormat = pParseSpec(pFormat + 1, &spec);
+        if (spec.conversion == '%') {
+            lineAdd(pContext, "%", 1);
+            continue;
+        }
+        required = (spec.width == U_PORT_LOG_DEFERRED_FIELD_ARGUMENT ? 1 : 0) +
+                   (spec.precision == U_PORT_LOG_DEFERRED_FIELD_ARGUMENT ? 1 : 0) +
+                   (spec.type != U_PORT_LOG_DEFERRED_ARG_TYPE_NONE ? 1 : 0);
+        if ((spec.type == U_PORT_LOG_DEFERRED_ARG_TYPE_NONE) ||
+            (argIndex + required > pEntry->numArgs)) {
+            // Not something we understand or not captured,
+            // print it as it is
+            lineAdd(pContext, pStart, pFormat - pStart);
+            argIndex = pEntry->numArgs;
+            continue;
+        }
+        // Re-build the specification with any "*" replaced by the
+        // captured value and the length modifier replaced by the one
+        // for the type we captured into
+        x = 0;
+        specStr[x] = '%';
+        x++;
+        if (spec.flagsLength > U_PORT_LOG_DEFERRED_FLAGS_MAX_LENGTH) {
+            spec.flagsLength = U_PORT_LOG_DEFERRED_FLAGS_MAX_LENGTH;
+        }
+        memcpy(specStr + x, spec.pFlags, spec.flagsLength);
+        x += spec.flagsLength;
+        if (spec.width == U_PORT_LOG_DEFERRED_FIELD_ARGUMENT) {
+            spec.width = (int32_t) pEntry->arg[argIndex].i;
+            argIndex++;
+            if (spec.width < 0) {
+                // A negative width is a "-" flag
+                specStr[x] = '-';
+                x++;
+                spec.width = -spec.width;
+            }
+        }
+        if (spec.width >= 0) {
+            x += snprintf(specStr + x, sizeof(specStr) - x, "%d", (int) spec.width);
+        }
+        if (spec.precision == U_PORT_LOG_DEFERRED_FIELD_ARGUMENT) {
+            spec.precision = (int32_t) pEntry->arg[argIndex].i;
+            argIndex++;
+        }
+        if (spec.precision >= 0) {
+            x += snprintf(specStr + x, sizeof(specStr) - x, ".%d", (int) spec.precision);
+        }
+        if ((spec.type == U_PORT_LOG_DEFERRED_ARG_TYPE_SIGNED) ||
+            (spec.type == U_PORT_LOG_DEFERRED_ARG_TYPE_UNSIGNED)) {
+            specStr[x] = 'l';
+            x++;
+            specStr[x] = 'l';
+            x++;
+        }
+        specStr[x] = spec.conversion;
+        x++;
+        specStr[x] = 0;
+        arg = pEntry->arg[argIndex];
+        argIndex++;
+        pStr = NULL;
+        if (spec.type == U_PORT_LOG_DEFERRED_ARG_TYPE_STRING) {
+            pStr = "(null)";
+            if ((arg.i >= 0) && (arg.i < (long long) sizeof(pEntry->strings))) {
+                pStr = pEntry->strings + arg.i;
+            }
+        }
+        if (spec.conversion != 'n') {
+            lineAddConversion(pContext, specStr, spec.type, &arg, pStr);
+        }
+    }
+    lineOutput(pContext);
+}
+
+// Format everything that has been published in the ring, returning
+// the number of entries formatted; the context mutex must be held.
+static int32_t drain(uPortLogDeferredContext_t *pContext)
+{
+    int32_t count = 0;
+    uint32_t readCount = atomicLoadU32(&pContext->readCount);
+    uPortLogDeferredEntry_t *pEntry;
+    int32_t lostCount;
+
+    pEntry = &(pContext->entry[readCount % U_PORT_LOG_DEFERRED_NUM_ENTRIES]);
+    while (atomicLoadU32(&pEntry->sequence) == readCount + 1) {
+        format(pContext, pEntry);
+        readCount++;
+        // Only once the entry has been formatted may it be re-used
+        atomicStoreU32(&pContext->readCount, readCount);
+        count++;
+        pEntry = &(pContext->entry[readCount % U_PORT_LOG_DEFERRED_NUM_ENTRIES]);
+    }
+    lostCount = uPortAtomicLoad(&pContext->lostCount);
+    if (lostCount != pContext->lostCountReported) {
+        pContext->lineLength = snprintf(pContext->line, sizeof(pContext->line),
+                                        "\n*** %d log print(s) lost ***\n",
+                                        (int) (lostCount - pContext->lostCountReported));
+        lineOutput(pContext);
+        pContext->lostCountReported = lostCount;
+    }
+
+    return count;
+}
+
+// The low-priority task that formats the ring.
+static void logDeferredTask(void *pParam)
+{
+    uPortLogDeferredContext_t *pContext = (uPortLogDeferredContext_t *) pParam;
+
+    while (uPortAtomicLoad(&pContext->taskStop) == 0) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        drain(pContext);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        uPortTaskBlock(U_PORT_LOG_DEFERRED_TASK_PERIOD_MS);
+    }
+
+    // Nothing in the context may be touched after this
+    uPortSemaphoreGive(pContext->taskExitedSemaphore);
+    uPortTaskDelete(NULL);
+}
+
+// Free a context.
+static void contextFree(uPortLogDeferredContext_t *pContext)
+{
+    if (pContext->taskExitedSemaphore != NULL) {
+        uPortSemaphoreDelete(pContext->taskExitedSemaphore);
+    }
+    if (pContext->mutex != NULL) {
+        uPortMutexDelete(pContext->mutex);
+    }
+    uPortFree(pContext);
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Start deferred logging.
+int32_t uPortLogDeferredInit(void (*pOutput)(const char *, void *),
+                             void *pOutputParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    uPortLogDeferredContext_t *pContext;
+
+    if (gpContext == NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pContext = (uPortLogDeferredContext_t *) pUPortMalloc(sizeof(*pContext));
+        if (pContext != NULL) {
+            memset(pContext, 0, sizeof(*pContext));
+            pContext->pOutput = pOutput;
+            pContext->pOutputParam = pOutputParam;
+            errorCode = uPortMutexCreate(&pContext->mutex);
+            if (errorCode == 0) {
+                errorCode = uPortSemaphoreCreate(&pContext->taskExitedSemaphore, 0, 1);
+            }
+            if (errorCode == 0) {
+                errorCode = uPortTaskCreate(logDeferredTask, "logDeferred",
+                                            U_PORT_LOG_DEFERRED_TASK_STACK_SIZE_BYTES,
+                                            pContext,
+                                            U_PORT_LOG_DEFERRED_TASK_PRIORITY,
+                                            &pContext->taskHandle);
+            }
+            if (errorCode == 0) {
+                uPortAtomicBarrier();
+                gpContext = pContext;
+            } else {
+                contextFree(pContext);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Capture a deferred print.
+void uPortLogDeferredF(const char *pFormat, ...)
+{
+    uPortLogDeferredContext_t *pContext = gpContext;
+    uPortLogDeferredEntry_t *pEntry;
+    uint32_t writeCount;
+    bool reserved = false;
+    va_list args;
+    va_list argsCopy;
+    char buffer[U_PORT_LOG_DEFERRED_LINE_LENGTH_BYTES];
+    char *pBuffer;
+    int32_t length;
+
+    va_start(args, pFormat);
+    if (pContext != NULL) {
+        do {
+            writeCount = atomicLoadU32(&pContext->writeCount);
+            if (writeCount - atomicLoadU32(&pContext->readCount) >=
+                U_PORT_LOG_DEFERRED_NUM_ENTRIES) {
+                // Full: drop it
+                uPortAtomicFetchAdd(&pContext->lostCount, 1);
+                break;
+            }
+            reserved = uPortAtomicCompareExchange((volatile int32_t *) &pContext->writeCount,
+                                                  (int32_t) writeCount,
+                                                  (int32_t) (writeCount + 1));
+        } while (!reserved);
+        if (reserved) {
+            pEntry = &(pContext->entry[writeCount % U_PORT_LOG_DEFERRED_NUM_ENTRIES]);
+            capture(pEntry, pFormat, &args);
+            // Publish it
+            atomicStoreU32(&pEntry->sequence, writeCount + 1);
+        }
+    } else {
+        // Not started, just log it now, using a buffer from the
+        // heap if the print is too long for the one on the stack
+        va_copy(argsCopy, args);
+        length = vsnprintf(buffer, sizeof(buffer), pFormat, args);
+        pBuffer = NULL;
+        if (length >= (int32_t) sizeof(buffer)) {
+            pBuffer = (char *) pUPortMalloc(length + 1);
+            if (pBuffer != NULL) {
+                vsnprintf(pBuffer, length + 1, pFormat, argsCopy);
+            }
+        }
+        va_end(argsCopy);
+        if (pBuffer != NULL) {
+            uPortLogF("%s", pBuffer);
+            uPortFree(pBuffer);
+        } else {
+            // If there was no memory this is as much as fits
+            uPortLogF("%s", buffer);
+        }
+    }
+    va_end(args);
+}
+
+// Format everything pending now.
+int32_t uPortLogDeferredFlush(void)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortLogDeferredContext_t *pContext = gpContext;
+
+    if (pContext != NULL) {
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        errorCodeOrCount = drain(pContext);
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Get the number of prints lost.
+int32_t uPortLogDeferredLostGet(void)
+{
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uPortLogDeferredContext_t *pContext = gpContext;
+
+    if (pContext != NULL) {
+        errorCodeOrCount = uPortAtomicLoad(&pContext->lostCount);
+    }
+
+    return errorCodeOrCount;
+}
+
+// Stop deferred logging.
+void uPortLogDeferredDeinit(void)
+{
+    uPortLogDeferredContext_t *pContext = gpContext;
+
+    if (pContext != NULL) {
+        uPortAtomicStore(&pContext->taskStop, 1);
+        uPortSemaphoreTake(pContext->taskExitedSemaphore);
+        // Give the task time to go away
+        uPortTaskBlock(U_CFG_OS_YIELD_MS);
+        // Anything still pending is formatted here, after which
+        // new prints are output directly
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        drain(pContext);
+        gpContext = NULL;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        contextFree(pContext);
+    }
+}
+
+// End of file
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2019-2023 u-blox
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file
+ * @brief Default implementations of the optional UART functions,
+ * uPortUartWriteAsync() and uPortUartSetBaudRate(), for platforms
+ * that do not provide their own.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"     // NULL, size_t etc.
+#include "stdint.h"     // int32_t etc.
+#include "stdbool.h"
+#include "u_compiler.h" // WEAK
+
+#include "u_error_common.h"
+
+#include "u_port_uart.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Default implementation of an asynchronous write: just a
+// blocking write followed by the callback.
+U_WEAK int32_t uPortUartWriteAsync(int32_t handle, const void *pBuffer,
+                                   size_t sizeBytes,
+                                   uPortUartWriteCallback_t pCallback,
+                                   void *pParam)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    int32_t sizeOrErrorCode;
+
+    if (pCallback != NULL) {
+        sizeOrErrorCode = uPortUartWrite(handle, pBuffer, sizeBytes);
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+        if (sizeOrErrorCode == (int32_t) U_ERROR_COMMON_INVALID_PARAMETER) {
+            // Nothing has happened, so report it as a failure to start
+            errorCode = sizeOrErrorCode;
+        } else {
+            pCallback(handle, sizeOrErrorCode, pParam);
+        }
+    }
+
+    return errorCode;
+}
+
+// Default implementation of changing the baud rate: not supported.
+U_WEAK int32_t uPortUartSetBaudRate(int32_t handle, int32_t baudRate)
+{
+    (void) handle;
+    (void) baudRate;
+
+    return (int32_t) U_ERROR_COMMON_NOT_SUPPORTED;
+}
+
+// End of file
@@ -143,6 +143,18 @@ list(APPEND UBXLIB_SRC ${UBXLIB_BASE}/port/u_port_heap.c)
 # Default uPortGetTimezoneOffsetSeconds() implementation
 list(APPEND UBXLIB_SRC ${UBXLIB_BASE}/port/u_port_timezone.c)
 
+# Default uPortUartWriteAsync() implementation
+list(APPEND UBXLIB_SRC ${UBXLIB_BASE}/port/u_port_uart_async.c)
+
+# Default uPortI2c/SpiXxxAsync() implementation
+list(APPEND UBXLIB_SRC ${UBXLIB_BASE}/port/u_port_bus_async.c)
+
+# Default uPortAtomicXxx() implementation
+list(APPEND UBXLIB_SRC ${UBXLIB_BASE}/port/u_port_atomic.c)
+
+# Deferred uPortLog() backend
+list(APPEND UBXLIB_SRC ${UBXLIB_BASE}/port/u_port_log_deferred.c)
+
 # Default uPortXxxResource implementation
 list(APPEND UBXLIB_SRC ${UBXLIB_BASE}/port/u_port_resource.c)
 
@@ -198,6 +210,7 @@ list(APPEND UBXLIB_TEST_INC
 )
 u_add_test_source_dir(base ${UBXLIB_BASE}/port/platform/common/test_util)
 u_add_test_source_dir(base ${UBXLIB_BASE}/port/platform/common/test)
+u_add_test_source_dir(base ${UBXLIB_BASE}/port/platform/common/log_ram/test)
 u_add_test_source_dir(base ${UBXLIB_BASE}/port/test)
 u_add_test_source_dir(base ${UBXLIB_BASE}/common/device/test)
 u_add_test_source_dir(base ${UBXLIB_BASE}/common/network/test)
@@ -206,6 +219,7 @@ u_add_test_source_dir(base ${UBXLIB_BASE}/example/sockets)
 u_add_test_source_dir(base ${UBXLIB_BASE}/example/security)
 u_add_test_source_dir(base ${UBXLIB_BASE}/example/mqtt_client)
 u_add_test_source_dir(base ${UBXLIB_BASE}/example/http_client)
+u_add_test_source_dir(base ${UBXLIB_BASE}/example/throughput)
 u_add_test_source_dir(base ${UBXLIB_BASE}/example/location)
 u_add_test_source_dir(base ${UBXLIB_BASE}/example/cell/lte_cfg)
 u_add_test_source_dir(base ${UBXLIB_BASE}/example/cell/power_saving)
@@ -66,6 +66,18 @@ UBXLIB_SRC += ${UBXLIB_BASE}/port/u_port_heap.c
 # Default uPortGetTimezoneOffsetSeconds() implementation
 UBXLIB_SRC += ${UBXLIB_BASE}/port/u_port_timezone.c
 
+# Default uPortUartWriteAsync() implementation
+UBXLIB_SRC += ${UBXLIB_BASE}/port/u_port_uart_async.c
+
+# Default uPortI2c/SpiXxxAsync() implementation
+UBXLIB_SRC += ${UBXLIB_BASE}/port/u_port_bus_async.c
+
+# Default uPortAtomicXxx() implementation
+UBXLIB_SRC += ${UBXLIB_BASE}/port/u_port_atomic.c
+
+# Deferred uPortLog() backend
+UBXLIB_SRC += ${UBXLIB_BASE}/port/u_port_log_deferred.c
+
 # Default uPortXxxResource implementation
 UBXLIB_SRC += ${UBXLIB_BASE}/port/u_port_resource.c
 
@@ -150,6 +162,7 @@ UBXLIB_TEST_DIRS += \
 	${UBXLIB_BASE}/port/platform/common/runner \
 	${UBXLIB_BASE}/port/platform/common/test_util \
 	${UBXLIB_BASE}/port/platform/common/test \
+	${UBXLIB_BASE}/port/platform/common/log_ram/test \
 	${UBXLIB_BASE}/port/test \
 	${UBXLIB_BASE}/common/device/test \
 	${UBXLIB_BASE}/common/network/test
@@ -159,6 +172,7 @@ UBXLIB_TEST_DIRS += \
 	${UBXLIB_BASE}/example/security \
 	${UBXLIB_BASE}/example/mqtt_client \
 	${UBXLIB_BASE}/example/http_client \
+	${UBXLIB_BASE}/example/throughput \
 	${UBXLIB_BASE}/example/location \
 	${UBXLIB_BASE}/example/cell/lte_cfg \
 	${UBXLIB_BASE}/example/cell/power_saving \
@@ -84,6 +84,8 @@
 #include <u_ringbuffer.h>
 #include <u_linked_list.h>
 #include <u_time.h>
+#include <u_time_sync.h>
+#include <u_perf_counters.h>
 #include <u_debug_utils.h>
 #include <u_at_client.h>
 #include <u_security.h>
@@ -140,6 +142,12 @@
 #include <u_gnss_dec.h>
 #include <u_gnss_dec_ubx_nav_pvt.h>
 #include <u_gnss_dec_ubx_nav_hpposllh.h>
+#include <u_gnss_dec_ubx_nav_sat.h>
+#include <u_gnss_dec_ubx_nav_sig.h>
+#include <u_gnss_dec_ubx_rxm_rawx.h>
+#include <u_gnss_dec_ubx_rxm_sfrbx.h>
+#include <u_gnss_dec_ubx_nav_cov.h>
+#include <u_gnss_dec_ubx_esf_meas.h>
 #include <u_gnss_mga.h>
 #include <u_gnss_util.h>
 #include <u_wifi.h>
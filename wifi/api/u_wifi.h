@@ -39,6 +39,28 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_WIFI_SCAN_CACHE_MAX_NUM
+/** The maximum number of access points kept from the last scan for
+ * uWifiStationScanCached(); if more are found, the strongest are kept.
+ */
+# define U_WIFI_SCAN_CACHE_MAX_NUM 16
+#endif
+
+#ifndef U_WIFI_CONNECT_CACHE_MAX_NUM
+/** The number of SSIDs for which the channel of the last successful
+ * connection is remembered, see uWifiStationSetFastConnect().
+ */
+# define U_WIFI_CONNECT_CACHE_MAX_NUM 4
+#endif
+
+#ifndef U_WIFI_CHANNEL_LIST_MAX_NUM
+/** The maximum number of entries in the channel list of the module
+ * that will be restored after a fast connect, see
+ * uWifiStationSetFastConnect().
+ */
+# define U_WIFI_CHANNEL_LIST_MAX_NUM 32
+#endif
+
 #define U_WIFI_BSSID_SIZE 6        /**< binary BSSID size. */
 #define U_WIFI_SSID_SIZE (32 + 1)  /**< null-terminated SSID string size. */
 
@@ -198,6 +220,30 @@ int32_t uWifiSetHostName(uDeviceHandle_t devHandle, const char *pHostName);
 int32_t uWifiStationConnect(uDeviceHandle_t devHandle, const char *pSsid,
                             uWifiAuth_t authentication, const char *pPassPhrase);
 
+/** Switch fast connect on or off; it is off by default.  With fast
+ * connect on, the channel and BSSID of each successful connection
+ * made by uWifiStationConnect() with a non-NULL SSID are remembered,
+ * along with the authentication type, for up to
+ * #U_WIFI_CONNECT_CACHE_MAX_NUM SSIDs.  When uWifiStationConnect() is
+ * next called for one of those SSIDs with the same authentication
+ * type, the channel list of the module is first restricted, using
+ * AT+UWCL, to the remembered channel, so that the module need not
+ * scan all of the channels before connecting; the full channel list
+ * is put back by the next connect that is not done this way.  Should
+ * a connection made this way fail, the entry is forgotten, so that
+ * the next call to uWifiStationConnect() will do a full scan.
+ *
+ * Connections are learnt through the +UUWLE URC, which is only
+ * monitored while a callback is set with
+ * uWifiSetConnectionStatusCallback().
+ *
+ * @param devHandle  the handle of the wifi instance.
+ * @param onNotOff   true to switch fast connect on, false to switch
+ *                   it off, forgetting all remembered connections.
+ * @return           zero on success, else negative error code.
+ */
+int32_t uWifiStationSetFastConnect(uDeviceHandle_t devHandle, bool onNotOff);
+
 /** Disconnect from Wifi access point
  *
  * @param devHandle the handle of the wifi instance.
@@ -298,7 +344,9 @@ bool uWifiAccessPointHasStoredConfig(uDeviceHandle_t devHandle);
 /** Scan for SSIDs
  *
  * Please note that this function will block until the scan process is completed.
- * During this time pCallback will be called for each scan result entry found.
+ * During this time pCallback will be called for each scan result entry as soon
+ * as it arrives from the module.  The results of a scan for any SSID are also
+ * kept, see uWifiStationScanCached().
  *
  * @param devHandle     the handle of the wifi instance.
  * @param[in] pSsid     optional SSID to search for. Set to NULL to search for any SSID.
@@ -311,6 +359,26 @@ bool uWifiAccessPointHasStoredConfig(uDeviceHandle_t devHandle);
 int32_t uWifiStationScan(uDeviceHandle_t devHandle, const char *pSsid,
                          uWifiScanResultCallback_t pCallback);
 
+/** Scan for SSIDs, or rather don't: if a scan for any SSID completed
+ * within the last maxAgeMs milliseconds, pCallback is called for each
+ * of the access points it found (up to #U_WIFI_SCAN_CACHE_MAX_NUM),
+ * or each of those which match pSsid if it is not NULL, without the
+ * module being troubled; otherwise a scan is performed exactly as by
+ * uWifiStationScan().  Useful when several parts of an application
+ * want to know what is around, as a scan can take some seconds.
+ *
+ * @param devHandle     the handle of the wifi instance.
+ * @param[in] pSsid     optional SSID to search for. Set to NULL to search for any SSID.
+ * @param maxAgeMs      the maximum age of a previous scan that may be used,
+ *                      zero to always scan.
+ * @param[in] pCallback callback for handling a scan result entry; the
+ *                      same restrictions apply as for uWifiStationScan().
+ * @return              zero on successful, else negative error code.
+ */
+int32_t uWifiStationScanCached(uDeviceHandle_t devHandle, const char *pSsid,
+                               int32_t maxAgeMs,
+                               uWifiScanResultCallback_t pCallback);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,20 +40,6 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
-#ifndef U_WIFI_CAPTIVE_PORTAL_DNS_TASK_STACK_SIZE_BYTES
-/** The stack size of the task that runs a local DNS (created and
- * destroyed by uWifiCaptivePortal()).
- */
-# define U_WIFI_CAPTIVE_PORTAL_DNS_TASK_STACK_SIZE_BYTES 2048
-#endif
-
-#ifndef U_WIFI_CAPTIVE_PORTAL_DNS_TASK_PRIORITY
-/** The priority of the task that runs a local DNS (created and
- * destroyed by uWifiCaptivePortal()).
- */
-# define U_WIFI_CAPTIVE_PORTAL_DNS_TASK_PRIORITY (U_CFG_OS_APP_TASK_PRIORITY + 1)
-#endif
-
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -74,7 +60,12 @@ typedef bool (*uWifiCaptivePortalKeepGoingCallback_t)(uDeviceHandle_t deviceHand
  * SSID network and enter the corresponding password. Once that has been
  * done the credentials are stored in the WiFi module and it will be
  * restarted to connect to the selected network. The process involves
- * starting a DNS server and a web server to handle the captive portal.
+ * a DNS server and a web server, both served from a single event loop
+ * in the calling task which handles several HTTP clients at once
+ * (U_WIFI_CAPTIVE_PORTAL_MAX_NUM_CLIENTS, default 4).  The scan for
+ * the networks that the user may choose from is made once, before
+ * the portal starts, since a scan takes seconds and would otherwise
+ * hold up both servers.
  *
  * This function is NOT threadsafe: there can be only one.
  *
@@ -54,6 +54,36 @@ extern "C" {
 # define U_WIFI_LOC_ANSWER_TIMEOUT_SECONDS 30
 #endif
 
+#ifndef U_WIFI_LOC_CACHE_NUM_ENTRIES
+/** The number of locations remembered by the cache of uWifiLocGet(),
+ * see uWifiLocSetCache(); the least recently used is replaced.
+ */
+# define U_WIFI_LOC_CACHE_NUM_ENTRIES 4
+#endif
+
+#ifndef U_WIFI_LOC_CACHE_FINGERPRINT_NUM_APS
+/** The number of strongest access points whose BSSIDs make up the
+ * fingerprint of a location in the cache of uWifiLocGet().
+ */
+# define U_WIFI_LOC_CACHE_FINGERPRINT_NUM_APS 8
+#endif
+
+#ifndef U_WIFI_LOC_CACHE_MATCH_PERCENT
+/** The percentage of the access points in a fingerprint that must
+ * be common to a cached fingerprint for the cached location to be
+ * used; a percentage of the larger of the two sets.
+ */
+# define U_WIFI_LOC_CACHE_MATCH_PERCENT 75
+#endif
+
+#ifndef U_WIFI_LOC_CACHE_SCAN_MAX_AGE_MS
+/** The age of a scan, see uWifiStationScanCached(), that may be
+ * used as the fingerprint for the cache of uWifiLocGet(), rather
+ * than scanning again.
+ */
+# define U_WIFI_LOC_CACHE_SCAN_MAX_AGE_MS 10000
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -208,6 +238,29 @@ int32_t uWifiLocGetStart(uDeviceHandle_t wifiHandle,
  */
 void uWifiLocGetStop(uDeviceHandle_t wifiHandle);
 
+/** Switch on, or off, a cache of the results of uWifiLocGet(); by
+ * default there is no cache.  With the cache switched on,
+ * uWifiLocGet() first scans for access points (or uses a scan made
+ * within the last #U_WIFI_LOC_CACHE_SCAN_MAX_AGE_MS, see
+ * uWifiStationScanCached()) and takes the BSSIDs of the
+ * #U_WIFI_LOC_CACHE_FINGERPRINT_NUM_APS strongest, that pass
+ * rssiDbmFilter, as a fingerprint; if at least
+ * #U_WIFI_LOC_CACHE_MATCH_PERCENT of those match the fingerprint
+ * of a location obtained from the same type of cloud service
+ * within the last maxAgeSeconds then that location is returned
+ * without the cloud service being contacted.  This can save a lot
+ * of cloud requests for a device which doesn't move; the cost is a
+ * scan of a few seconds before each cloud request.
+ * uWifiLocGetStart() is not affected.
+ *
+ * @param wifiHandle     the handle of the Wi-Fi instance.
+ * @param maxAgeSeconds  the maximum age of a cached location that
+ *                       may be returned; zero to switch the cache off
+ *                       and free it.
+ * @return               zero on success, else negative error code.
+ */
+int32_t uWifiLocSetCache(uDeviceHandle_t wifiHandle, int32_t maxAgeSeconds);
+
 /** When uWifiLocGet() or uWifiLocGetStart() are first called they
  * will allocate some memory (for thread-safety) that is never free'd.
  * If you need that memory back and you are ABSOLUTELY SURE that no
@@ -48,6 +48,23 @@ extern "C" {
  */
 #define U_WIFI_MQTT_MAX_NUM_CONNECTIONS 7
 
+#ifndef U_WIFI_MQTT_RX_QUEUE_MAX_MESSAGES
+/** The maximum number of received messages that may wait to be read
+ * on an MQTT session; a message arriving when the queue is full is
+ * dropped, and counted, see uWifiMqttGetRxDropCount(), rather than
+ * using up the receive buffers shared with everything else on the
+ * module.
+ */
+# define U_WIFI_MQTT_RX_QUEUE_MAX_MESSAGES 8
+#endif
+
+#ifndef U_WIFI_MQTT_RX_QUEUE_MAX_BYTES
+/** The maximum number of bytes of received messages that may wait
+ * to be read on an MQTT session, see #U_WIFI_MQTT_RX_QUEUE_MAX_MESSAGES.
+ */
+# define U_WIFI_MQTT_RX_QUEUE_MAX_BYTES (U_WIFI_MQTT_BUFFER_SIZE * 2)
+#endif
+
 
 typedef enum {
     U_WIFI_MQTT_QOS_AT_MOST_ONCE = 0,
@@ -56,6 +73,14 @@ typedef enum {
     U_WIFI_MQTT_QOS_MAX_NUM
 } uWifiMqttQos_t;
 
+/** A run of the payload of a received message, as filled in by
+ * uWifiMqttMessagePeek().
+ */
+typedef struct {
+    const char *pData;  /**< the start of the run. */
+    size_t sizeBytes;   /**< the number of bytes at pData. */
+} uWifiMqttMessageSlice_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS:  WORKAROUND FOR LINKER ISSUE
  * -------------------------------------------------------------- */
@@ -214,6 +239,52 @@ int32_t uWifiMqttMessageRead(const uMqttClientContext_t *pContext,
                              size_t *pMessageSizeBytes,
                              uMqttQos_t *pQos);
 
+/** Get at the oldest received message in place, without copying
+ * it: the topic is returned and each element of pSlices is pointed
+ * at a run of the payload, in order, with any elements left over set
+ * to zero length.  Nothing is consumed: once the message has been
+ * dealt with, call uWifiMqttMessageRelease() to remove it from the
+ * queue.  The message remains valid until it is released or read
+ * with uWifiMqttMessageRead(), or the session is closed; more
+ * messages arriving in the meantime do not disturb it.
+ *
+ * @param[in] pContext        client context returned by pUMqttClientOpen().
+ * @param[out] ppTopicNameStr a place to put a pointer to the topic of
+ *                            the message, a null-terminated string that
+ *                            remains valid while the topic is subscribed;
+ *                            cannot be NULL.
+ * @param[out] pSlices        an array of numSlices elements to fill in.
+ * @param numSlices           the number of elements at pSlices.
+ * @return                    the total number of payload bytes pointed
+ *                            to, else negative error code;
+ *                            #U_ERROR_COMMON_EMPTY if there is no message.
+ */
+int32_t uWifiMqttMessagePeek(const uMqttClientContext_t *pContext,
+                             const char **ppTopicNameStr,
+                             uWifiMqttMessageSlice_t *pSlices,
+                             size_t numSlices);
+
+/** Remove the oldest received message from the queue without copying
+ * it anywhere, e.g. once it has been dealt with in place after a call
+ * to uWifiMqttMessagePeek().
+ *
+ * @param[in] pContext client context returned by pUMqttClientOpen().
+ * @return             zero on success or negative error code;
+ *                     #U_ERROR_COMMON_EMPTY if there is no message.
+ */
+int32_t uWifiMqttMessageRelease(const uMqttClientContext_t *pContext);
+
+/** Get the number of received messages that were dropped because
+ * the receive queue of the session was full, see
+ * #U_WIFI_MQTT_RX_QUEUE_MAX_MESSAGES; a non-zero value is a sign
+ * that messages are not being read quickly enough.
+ *
+ * @param[in] pContext client context returned by pUMqttClientOpen().
+ * @return             the number of messages dropped since the session
+ *                     was opened, else negative error code.
+ */
+int32_t uWifiMqttGetRxDropCount(const uMqttClientContext_t *pContext);
+
 /** Check if we are connected to the given MQTT session.
  *
  * @param[in] pContext        client context returned by pUMqttClientOpen().
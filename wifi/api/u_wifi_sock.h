@@ -93,6 +93,23 @@ extern "C" {
 #define U_WIFI_SOCK_WRITE_TIMEOUT_MS 500
 #endif
 
+#ifndef U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS
+/** The maximum number of received datagrams that may wait to be read
+ * on a UDP socket; a datagram arriving when the queue is full is
+ * dropped, and counted, see uWifiSockGetRxDropCount(), so that one
+ * UDP socket being flooded cannot use up all of the receive buffers
+ * of the other sockets.
+ */
+# define U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS 8
+#endif
+
+#ifndef U_WIFI_SOCK_UDP_QUEUE_MAX_BYTES
+/** The maximum number of bytes of received datagrams that may wait
+ * to be read on a UDP socket, see #U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS.
+ */
+# define U_WIFI_SOCK_UDP_QUEUE_MAX_BYTES (U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES * 2)
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -372,6 +389,19 @@ int32_t uWifiSockReceiveFrom(uDeviceHandle_t devHandle,
                              uSockAddress_t *pRemoteAddress,
                              void *pData, size_t dataSizeBytes);
 
+/** Get the number of datagrams received on a UDP socket that were
+ * dropped because its receive queue was full, see
+ * #U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS; TCP data is never dropped.
+ *
+ * @param devHandle   the handle of the wifi instance.
+ * @param sockHandle  the handle of the socket.
+ * @return            the number of datagrams dropped since the
+ *                    socket was created, else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uWifiSockGetRxDropCount(uDeviceHandle_t devHandle,
+                                int32_t sockHandle);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: STREAM (TCP)
  * -------------------------------------------------------------- */
@@ -407,6 +437,40 @@ int32_t uWifiSockRead(uDeviceHandle_t devHandle,
                       int32_t sockHandle,
                       void *pData, size_t dataSizeBytes);
 
+/** Get at the bytes received on a connected socket in place,
+ * without copying them: each element of pIoVec is pointed at a
+ * run of received data, in order, with any elements left over
+ * set to zero length.  Nothing is consumed: once the data has been
+ * dealt with, call uWifiSockReadRelease() to consume it.  The data
+ * remains valid until it is consumed or the socket is closed;
+ * more data arriving in the meantime does not disturb it.
+ *
+ * @param devHandle     the handle of the wifi instance.
+ * @param sockHandle    the handle of the socket.
+ * @param[out] pIoVec   an array of count elements to fill in.
+ * @param count         the number of elements at pIoVec.
+ * @return              the total number of bytes pointed to
+ *                      else negated value of U_SOCK_Exxx from
+ *                      u_sock_errno.h.
+ */
+int32_t uWifiSockReadPeek(uDeviceHandle_t devHandle,
+                          int32_t sockHandle,
+                          uSockIoVec_t *pIoVec, size_t count);
+
+/** Consume bytes received on a connected socket without copying
+ * them anywhere, e.g. once they have been dealt with in place
+ * after a call to uWifiSockReadPeek().
+ *
+ * @param devHandle     the handle of the wifi instance.
+ * @param sockHandle    the handle of the socket.
+ * @param dataSizeBytes the number of bytes to consume.
+ * @return              the number of bytes consumed else negated
+ *                      value of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uWifiSockReadRelease(uDeviceHandle_t devHandle,
+                             int32_t sockHandle,
+                             size_t dataSizeBytes);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: ASYNC
  * -------------------------------------------------------------- */
@@ -37,6 +37,7 @@
 
 #include "u_error_common.h"
 
+#include "u_port.h"
 #include "u_port_os.h"
 #include "u_port_heap.h"
 #include "u_port_debug.h"
@@ -65,6 +66,7 @@
 #include "u_wifi_mqtt.h"     // For uWifiMqttPrivateLink()
 #include "u_wifi_http_private.h"   // For uWifiHttpPrivateLink()
 #include "u_wifi_loc_private.h"    // For uWifiLocPrivateLink()
+#include "u_wifi_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -115,6 +117,38 @@ typedef enum {
     CFG_ACTION_DEACTIVATE = 4
 } uWifiCfgAction_t;
 
+/** The results of the last scan for any SSID, hung off the
+ * pWifiScanCache member of the short range instance.
+ */
+typedef struct {
+    bool valid;          /**< false until a scan has completed. */
+    int32_t timeMs;      /**< when the scan completed. */
+    size_t count;        /**< the number of entries in results. */
+    uWifiScanResult_t results[U_WIFI_SCAN_CACHE_MAX_NUM];
+} uWifiScanCache_t;
+
+/** What is remembered of a successful connection for fast connect.
+ */
+typedef struct {
+    char ssid[U_WIFI_SSID_SIZE];    /**< empty if the entry is not in use. */
+    uWifiAuth_t authentication;
+    int32_t channel;                /**< zero until connected. */
+    char bssid[U_WIFI_BSSID_SIZE];  /**< as reported by +UUWLE. */
+    int32_t timeMs;                 /**< when the entry was last used. */
+} uWifiConnectCacheEntry_t;
+
+/** The fast connect cache, hung off the pWifiConnectCache member
+ * of the short range instance.
+ */
+typedef struct {
+    uWifiConnectCacheEntry_t entries[U_WIFI_CONNECT_CACHE_MAX_NUM];
+    int32_t pendingIndex;   /**< the entry of the connection in progress, -1 if none. */
+    bool directed;          /**< true if the connection in progress is on one channel. */
+    bool restricted;        /**< true if the channel list of the module is restricted. */
+    size_t channelCount;    /**< the number of entries in channelList. */
+    int32_t channelList[U_WIFI_CHANNEL_LIST_MAX_NUM]; /**< the full channel list. */
+} uWifiConnectCache_t;
+
 /* ----------------------------------------------------------------
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
@@ -386,6 +420,132 @@ static int32_t readIfaceStatusString(uAtClientHandle_t atHandle,
     return retValue;
 }
 
+/** Helper function for writing the Wifi channel list */
+static int32_t writeWifiChannelList(uAtClientHandle_t atHandle,
+                                    const int32_t *pChannelList,
+                                    size_t channelCount)
+{
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UWCL=");
+    for (size_t x = 0; x < channelCount; x++) {
+        uAtClientWriteInt(atHandle, pChannelList[x]);
+    }
+    uAtClientCommandStopReadResponse(atHandle);
+    return uAtClientUnlock(atHandle);
+}
+
+/** Helper function for reading the Wifi channel list, returns the
+ * number of channels read or negative error code */
+static int32_t readWifiChannelList(uAtClientHandle_t atHandle,
+                                   int32_t *pChannelList,
+                                   size_t maxNumChannels)
+{
+    int32_t retValue = 0;
+    int32_t channel = 0;
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UWCL?");
+    uAtClientCommandStop(atHandle);
+    uAtClientResponseStart(atHandle, "+UWCL:");
+    while ((retValue < (int32_t) maxNumChannels) && (channel >= 0)) {
+        channel = uAtClientReadInt(atHandle);
+        if (channel > 0) {
+            pChannelList[retValue] = channel;
+            retValue++;
+        }
+    }
+    uAtClientResponseStop(atHandle);
+    int32_t errorCode = uAtClientUnlock(atHandle);
+    if (errorCode < 0) {
+        retValue = errorCode;
+    }
+    return retValue;
+}
+
+// Prepare the fast connect cache for a connection to the given
+// SSID, restricting the channel list of the module if the SSID
+// was connected to before, else putting it back.
+static void connectCachePrepare(uAtClientHandle_t atHandle,
+                                uWifiConnectCache_t *pCache,
+                                const char *pSsid,
+                                uWifiAuth_t authentication)
+{
+    uWifiConnectCacheEntry_t *pEntry = NULL;
+    int32_t oldest = 0;
+    int32_t count;
+
+    pCache->pendingIndex = -1;
+    pCache->directed = false;
+    for (int32_t x = 0; x < U_WIFI_CONNECT_CACHE_MAX_NUM; x++) {
+        if (strcmp(pCache->entries[x].ssid, pSsid) == 0) {
+            pCache->pendingIndex = x;
+            break;
+        }
+        if ((pCache->entries[x].ssid[0] == 0) ||
+            ((pCache->entries[oldest].ssid[0] != 0) &&
+             (pCache->entries[x].timeMs - pCache->entries[oldest].timeMs < 0))) {
+            oldest = x;
+        }
+    }
+
+    if (pCache->pendingIndex >= 0) {
+        pEntry = &(pCache->entries[pCache->pendingIndex]);
+        if (pEntry->authentication != authentication) {
+            // Different security, start again
+            pEntry->channel = 0;
+        }
+    } else {
+        // New SSID, replace the entry used least recently
+        pCache->pendingIndex = oldest;
+        pEntry = &(pCache->entries[oldest]);
+        memset(pEntry, 0, sizeof(*pEntry));
+        strncpy(pEntry->ssid, pSsid, sizeof(pEntry->ssid) - 1);
+    }
+    pEntry->authentication = authentication;
+    pEntry->timeMs = uPortGetTickTimeMs();
+
+    if (pEntry->channel > 0) {
+        if (!pCache->restricted) {
+            // Remember the full channel list before restricting it
+            count = readWifiChannelList(atHandle, pCache->channelList,
+                                        sizeof(pCache->channelList) / sizeof(pCache->channelList[0]));
+            if (count > 0) {
+                pCache->channelCount = (size_t) count;
+                pCache->restricted = true;
+            }
+        }
+        if (pCache->restricted) {
+            pCache->directed = (writeWifiChannelList(atHandle, &(pEntry->channel), 1) == 0);
+            if (pCache->directed) {
+                uPortLog(LOG_TAG "Fast connect on channel %d\n", pEntry->channel);
+            }
+        }
+    }
+    if (!pCache->directed && pCache->restricted &&
+        (writeWifiChannelList(atHandle, pCache->channelList, pCache->channelCount) == 0)) {
+        pCache->restricted = false;
+    }
+}
+
+// Update the fast connect cache with the outcome of a connection;
+// called with the short range lock held, must not send AT commands.
+static void connectCacheUpdate(uWifiConnectCache_t *pCache,
+                               const uWifiConnection_t *pStatus)
+{
+    uWifiConnectCacheEntry_t *pEntry;
+
+    if (pCache->pendingIndex >= 0) {
+        pEntry = &(pCache->entries[pCache->pendingIndex]);
+        if (pStatus->status == U_WIFI_CON_STATUS_CONNECTED) {
+            pEntry->channel = pStatus->channel;
+            memcpy(pEntry->bssid, pStatus->bssid, sizeof(pEntry->bssid));
+        } else if (pCache->directed) {
+            // The AP may have moved: do a full scan next time
+            pEntry->channel = 0;
+        }
+        pCache->pendingIndex = -1;
+    }
+}
+
 static void wifiConnectCallback(uAtClientHandle_t atHandle,
                                 void *pParameter)
 {
@@ -406,6 +566,9 @@ static void wifiConnectCallback(uAtClientHandle_t atHandle,
             pCallback = pInstance->pWifiConnectionStatusCallback;
             pCallbackParam = pInstance->pWifiConnectionStatusCallbackParameter;
         }
+        if (pInstance && pInstance->pWifiConnectCache) {
+            connectCacheUpdate((uWifiConnectCache_t *) pInstance->pWifiConnectCache, pStatus);
+        }
 
         uShortRangeUnlock();
 
@@ -756,6 +919,11 @@ int32_t uWifiStationConnect(uDeviceHandle_t devHandle, const char *pSsid,
         if ((pSsid == NULL) && (conStatus != 2)) {
             errorCode = writeWifiStaCfgAction(atHandle, 0, CFG_ACTION_LOAD);
         } else {
+            if ((errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) &&
+                (pSsid != NULL) && (pInstance->pWifiConnectCache != NULL)) {
+                connectCachePrepare(atHandle, (uWifiConnectCache_t *) pInstance->pWifiConnectCache,
+                                    pSsid, authentication);
+            }
             if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
                 // Set SSID
                 errorCode = writeWifiStaCfgStr(atHandle, 0, 2, pSsid);
@@ -781,6 +949,48 @@ int32_t uWifiStationConnect(uDeviceHandle_t devHandle, const char *pSsid,
     return errorCode;
 }
 
+int32_t uWifiStationSetFastConnect(uDeviceHandle_t devHandle, bool onNotOff)
+{
+    int32_t errorCode;
+    uShortRangePrivateInstance_t *pInstance;
+    uWifiConnectCache_t *pCache;
+
+    errorCode = uShortRangeLock();
+    if (errorCode != (int32_t) U_ERROR_COMMON_SUCCESS) {
+        return errorCode;
+    }
+
+    errorCode = getInstance(devHandle, &pInstance);
+    if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        pCache = (uWifiConnectCache_t *) pInstance->pWifiConnectCache;
+        if (onNotOff) {
+            if (pCache == NULL) {
+                errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                pCache = (uWifiConnectCache_t *) pUPortMalloc(sizeof(*pCache));
+                if (pCache != NULL) {
+                    memset(pCache, 0, sizeof(*pCache));
+                    pCache->pendingIndex = -1;
+                    pInstance->pWifiConnectCache = pCache;
+                    errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                }
+            }
+        } else if (pCache != NULL) {
+            if (pCache->restricted) {
+                errorCode = writeWifiChannelList(pInstance->atHandle, pCache->channelList,
+                                                 pCache->channelCount);
+            }
+            if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                uPortFree(pCache);
+                pInstance->pWifiConnectCache = NULL;
+            }
+        }
+    }
+
+    uShortRangeUnlock();
+
+    return errorCode;
+}
+
 int32_t uWifiStationDisconnect(uDeviceHandle_t devHandle)
 {
     int32_t errorCode;
@@ -1024,11 +1234,33 @@ bool uWifiAccessPointHasStoredConfig(uDeviceHandle_t devHandle)
     return has;
 }
 
+// Add a scan result to the cache, replacing the weakest entry
+// if the cache is full and the new one is stronger.
+static void scanCacheAdd(uWifiScanCache_t *pCache, const uWifiScanResult_t *pResult)
+{
+    size_t weakest = 0;
+
+    if (pCache->count < U_WIFI_SCAN_CACHE_MAX_NUM) {
+        pCache->results[pCache->count] = *pResult;
+        pCache->count++;
+    } else {
+        for (size_t x = 1; x < pCache->count; x++) {
+            if (pCache->results[x].rssi < pCache->results[weakest].rssi) {
+                weakest = x;
+            }
+        }
+        if (pResult->rssi > pCache->results[weakest].rssi) {
+            pCache->results[weakest] = *pResult;
+        }
+    }
+}
+
 int32_t uWifiStationScan(uDeviceHandle_t devHandle, const char *pSsid,
                          uWifiScanResultCallback_t pCallback)
 {
     int32_t errorCode;
     uShortRangePrivateInstance_t *pInstance;
+    uWifiScanCache_t *pCache = NULL;
 
     errorCode = uShortRangeLock();
     if (errorCode != (int32_t) U_ERROR_COMMON_SUCCESS) {
@@ -1039,6 +1271,19 @@ int32_t uWifiStationScan(uDeviceHandle_t devHandle, const char *pSsid,
     if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
         uAtClientHandle_t atHandle = pInstance->atHandle;
 
+        if (pSsid == NULL) {
+            // Only a scan for everything is any use to the cache
+            pCache = (uWifiScanCache_t *) pInstance->pWifiScanCache;
+            if (pCache == NULL) {
+                pCache = (uWifiScanCache_t *) pUPortMalloc(sizeof(*pCache));
+                pInstance->pWifiScanCache = pCache;
+            }
+            if (pCache != NULL) {
+                pCache->valid = false;
+                pCache->count = 0;
+            }
+        }
+
         uAtClientLock(atHandle);
         // Since the scanning can take some time we release the short range lock here
         // This should be fine since we currently have the AT client lock instead
@@ -1080,10 +1325,17 @@ int32_t uWifiStationScan(uDeviceHandle_t devHandle, const char *pSsid,
             scanResult.uniCipherBitmask = (uint8_t)uAtClientReadInt(atHandle);
             scanResult.grpCipherBitmask = (uint8_t)uAtClientReadInt(atHandle);
 
+            if (pCache != NULL) {
+                scanCacheAdd(pCache, &scanResult);
+            }
             pCallback(devHandle, &scanResult);
         }
 
         errorCode = uAtClientUnlock(atHandle);
+        if ((pCache != NULL) && (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS)) {
+            pCache->timeMs = uPortGetTickTimeMs();
+            pCache->valid = true;
+        }
     } else {
         uShortRangeUnlock();
     }
@@ -1092,4 +1344,106 @@ int32_t uWifiStationScan(uDeviceHandle_t devHandle, const char *pSsid,
     return errorCode;
 }
 
+int32_t uWifiStationScanCached(uDeviceHandle_t devHandle, const char *pSsid,
+                               int32_t maxAgeMs,
+                               uWifiScanResultCallback_t pCallback)
+{
+    int32_t errorCode;
+    uShortRangePrivateInstance_t *pInstance;
+    const uWifiScanCache_t *pCache = NULL;
+    uWifiScanResult_t results[U_WIFI_SCAN_CACHE_MAX_NUM];
+    size_t count = 0;
+
+    errorCode = uShortRangeLock();
+    if (errorCode != (int32_t) U_ERROR_COMMON_SUCCESS) {
+        return errorCode;
+    }
+
+    errorCode = getInstance(devHandle, &pInstance);
+    if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        pCache = (const uWifiScanCache_t *) pInstance->pWifiScanCache;
+        if ((pCache != NULL) && pCache->valid &&
+            (uPortGetTickTimeMs() - pCache->timeMs < maxAgeMs)) {
+            // Take a copy so that the callback is called unlocked
+            for (size_t x = 0; x < pCache->count; x++) {
+                if ((pSsid == NULL) || (strcmp(pCache->results[x].ssid, pSsid) == 0)) {
+                    results[count] = pCache->results[x];
+                    count++;
+                }
+            }
+        } else {
+            pCache = NULL;
+        }
+    }
+
+    uShortRangeUnlock();
+
+    if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        if (pCache != NULL) {
+            for (size_t x = 0; x < count; x++) {
+                pCallback(devHandle, &results[x]);
+            }
+        } else {
+            errorCode = uWifiStationScan(devHandle, pSsid, pCallback);
+        }
+    }
+
+    return errorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS THAT ARE PRIVATE TO WIFI
+ * -------------------------------------------------------------- */
+
+// Get the BSSIDs of the strongest access points of the last scan.
+size_t uWifiPrivateScanCacheGetBssids(const void *pWifiScanCache,
+                                      int32_t maxAgeMs,
+                                      int32_t rssiDbmFilter,
+                                      uint8_t *pBssids, size_t maxNum)
+{
+    const uWifiScanCache_t *pCache = (const uWifiScanCache_t *) pWifiScanCache;
+    const uWifiScanResult_t *pSelected[U_WIFI_SCAN_CACHE_MAX_NUM];
+    const uWifiScanResult_t *pTmp;
+    size_t count = 0;
+
+    if ((pCache != NULL) && pCache->valid && (pBssids != NULL) &&
+        (uPortGetTickTimeMs() - pCache->timeMs < maxAgeMs)) {
+        for (size_t x = 0; x < pCache->count; x++) {
+            if (pCache->results[x].rssi >= rssiDbmFilter) {
+                pSelected[count] = &(pCache->results[x]);
+                count++;
+            }
+        }
+        // Strongest first, then keep the first maxNum
+        for (size_t x = 0; x < count; x++) {
+            for (size_t y = x + 1; y < count; y++) {
+                if (pSelected[y]->rssi > pSelected[x]->rssi) {
+                    pTmp = pSelected[x];
+                    pSelected[x] = pSelected[y];
+                    pSelected[y] = pTmp;
+                }
+            }
+        }
+        if (count > maxNum) {
+            count = maxNum;
+        }
+        // Now put those in BSSID order
+        for (size_t x = 0; x < count; x++) {
+            for (size_t y = x + 1; y < count; y++) {
+                if (memcmp(pSelected[y]->bssid, pSelected[x]->bssid,
+                           sizeof(pSelected[x]->bssid)) < 0) {
+                    pTmp = pSelected[x];
+                    pSelected[x] = pSelected[y];
+                    pSelected[y] = pTmp;
+                }
+            }
+        }
+        for (size_t x = 0; x < count; x++) {
+            memcpy(pBssids + (x * U_WIFI_BSSID_SIZE), pSelected[x]->bssid, U_WIFI_BSSID_SIZE);
+        }
+    }
+
+    return count;
+}
+
 // End of file
@@ -30,6 +30,7 @@
 
 #include "stddef.h"
 #include "stdint.h"
+#include "stdlib.h"
 #include "stdbool.h"
 #include "string.h"
 #include "stdio.h"
@@ -39,7 +40,9 @@
 
 #include "u_assert.h"
 
+#include "u_port.h"
 #include "u_port_os.h"
+#include "u_port_heap.h"
 #include "u_cfg_sw.h"
 #include "u_port_debug.h"
 #include "u_cfg_os_platform_specific.h"
@@ -67,15 +70,99 @@
 
 #define LOG_PREFIX "U_WIFI_CAPTIVE_PORTAL: "
 
+#ifndef U_WIFI_CAPTIVE_PORTAL_MAX_NUM_CLIENTS
+/** The number of HTTP clients that the captive portal serves at
+ * the same time; phones tend to open several connections in
+ * parallel.  Further connections wait in the module until a
+ * client slot becomes free.
+ */
+# define U_WIFI_CAPTIVE_PORTAL_MAX_NUM_CLIENTS 4
+#endif
+
+#ifndef U_WIFI_CAPTIVE_PORTAL_REQUEST_MAX_LENGTH_BYTES
+/** The maximum length of an HTTP request from a client, including
+ * any body; anything beyond this is ignored.
+ */
+# define U_WIFI_CAPTIVE_PORTAL_REQUEST_MAX_LENGTH_BYTES 1024
+#endif
+
+#ifndef U_WIFI_CAPTIVE_PORTAL_SELECT_TIMEOUT_MS
+/** How long the event loop of the captive portal waits in
+ * uSockSelect() before checking for new connections, client
+ * timeouts and the keep-going callback.
+ */
+# define U_WIFI_CAPTIVE_PORTAL_SELECT_TIMEOUT_MS 50
+#endif
+
 #ifndef U_WIFI_CAPTIVE_PORTAL_CLIENT_SOCKET_READ_DELAY_MS
-/** When waiting for a client that has connected to us, wait for
- * this many milliseconds while going around a loop reading
- * from it to make sure that we have really read everything that
- * it has sent to us.
+/** A request from a client that does not yet look complete (e.g.
+ * no blank line marking the end of the headers) is handled anyway
+ * once nothing more has arrived for this many milliseconds.
  */
 # define U_WIFI_CAPTIVE_PORTAL_CLIENT_SOCKET_READ_DELAY_MS 100
 #endif
 
+#ifndef U_WIFI_CAPTIVE_PORTAL_CLIENT_TIMEOUT_MS
+/** A client that has connected but not sent a request within
+ * this many milliseconds is disconnected to free its slot.
+ */
+# define U_WIFI_CAPTIVE_PORTAL_CLIENT_TIMEOUT_MS 10000
+#endif
+
+#ifndef U_WIFI_CAPTIVE_PORTAL_SSID_LIST_MAX_LENGTH_BYTES
+/** The maximum length of the JSON list of SSIDs sent to a client.
+ */
+# define U_WIFI_CAPTIVE_PORTAL_SSID_LIST_MAX_LENGTH_BYTES 1024
+#endif
+
+/** The format of the header of every response, the parameters
+ * being the status code, the content type and the content length.
+ */
+#define U_WIFI_CAPTIVE_PORTAL_HEADER_FORMAT "HTTP/1.0 %s\r\n"                                      \
+                                            "Server: ubxlib\r\n"                                   \
+                                            "Content-type: %s\r\n"                                 \
+                                            "Content-Length: %d\r\n"                               \
+                                            "Cache-Control: no-store, no-cache, must-revalidate\r\n" \
+                                            "\r\n"
+
+/** Room to allow for a rendered header.
+ */
+#define U_WIFI_CAPTIVE_PORTAL_HEADER_MAX_LENGTH_BYTES 255
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * ------------------------------------------------------------- */
+
+/** A connected HTTP client.
+ */
+typedef struct {
+    int32_t sock; /**< negative if this slot is free. */
+    int32_t connectedTimeMs;
+    int32_t lastReceiveTimeMs;
+    size_t requestLength;
+    char request[U_WIFI_CAPTIVE_PORTAL_REQUEST_MAX_LENGTH_BYTES];
+} uWifiCaptivePortalClient_t;
+
+/** Everything the captive portal needs while it is running,
+ * allocated for the duration of uWifiCaptivePortal().
+ */
+typedef struct {
+    uDeviceHandle_t devHandle;
+    bool keepGoing;
+    char *pIndexResponse; /**< header and page, rendered once. */
+    size_t indexResponseLength;
+    size_t ssidListResponseLength; /**< zero if there was no room. */
+    char ssidList[U_WIFI_CAPTIVE_PORTAL_SSID_LIST_MAX_LENGTH_BYTES];
+    char ssidListResponse[U_WIFI_CAPTIVE_PORTAL_HEADER_MAX_LENGTH_BYTES +
+                          U_WIFI_CAPTIVE_PORTAL_SSID_LIST_MAX_LENGTH_BYTES];
+    // Selected credentials
+    char ssid[U_WIFI_SSID_SIZE];
+    char pw[100];
+    // Network configuration
+    uNetworkCfgWifi_t networkCfg;
+    uWifiCaptivePortalClient_t client[U_WIFI_CAPTIVE_PORTAL_MAX_NUM_CLIENTS];
+} uWifiCaptivePortalContext_t;
+
 /* ----------------------------------------------------------------
  * STATIC VARIABLES
  * ------------------------------------------------------------- */
@@ -169,15 +256,23 @@ static const char gIndexPage[] =
     "</body>\r\n"
     "</html>\r\n";
 
-// The list of available network SSIDs
-static char gSsidList[1024];
-static uDeviceHandle_t gDevHandle;
-static bool gKeepGoing = false;
-// Selected credentials
-static char gSsid[U_WIFI_SSID_SIZE];
-static char gPw[100] = {0};
-// Network configuration
-static uNetworkCfgWifi_t gNetworkCfg = {0};
+// Canned responses.
+static const char gNotFoundResponse[] = "HTTP/1.0 404 Not Found\r\n"
+                                        "Server: ubxlib\r\n"
+                                        "Content-type: text/html\r\n"
+                                        "Content-Length: 0\r\n"
+                                        "Cache-Control: no-store, no-cache, must-revalidate\r\n"
+                                        "\r\n";
+static const char gOkResponse[] = "HTTP/1.0 200 OK\r\n"
+                                  "Server: ubxlib\r\n"
+                                  "Content-type: text/html\r\n"
+                                  "Content-Length: 0\r\n"
+                                  "Cache-Control: no-store, no-cache, must-revalidate\r\n"
+                                  "\r\n";
+
+// The running captive portal, required by scanCallback(), which
+// has no parameter of its own.
+static uWifiCaptivePortalContext_t *gpContext = NULL;
 
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
@@ -188,43 +283,55 @@ static void scanCallback(uDeviceHandle_t devHandle, uWifiScanResult_t *pResult)
 {
     (void)devHandle;
     char info[U_WIFI_SSID_SIZE + 15];
-    if (strlen(pResult->ssid)) {
+    char *pSsidList;
+    if ((gpContext != NULL) && strlen(pResult->ssid)) {
+        pSsidList = gpContext->ssidList;
         snprintf(info, sizeof(info), "\"%s (%d%s)\",",
                  pResult->ssid, (int)pResult->rssi,
                  pResult->authSuiteBitmask ? " *" : "");
-        if ((sizeof(gSsidList) - strlen(gSsidList)) > (strlen(info) + 3)) {
-            strcat(gSsidList, info);
+        if ((sizeof(gpContext->ssidList) - strlen(pSsidList)) > (strlen(info) + 3)) {
+            strcat(pSsidList, info);
         }
     }
 }
 
-// Send corresponding html header
-static void sendHeader(int32_t sock, const char *code,
-                       const char *type, size_t length)
+// Render a response, header plus body, into pBuffer, returning
+// its length.
+static size_t renderResponse(char *pBuffer, size_t bufferSize,
+                             const char *pCode, const char *pType,
+                             const char *pBody, size_t bodyLength)
 {
-    static char header[255];
-    snprintf(header, sizeof(header),
-             "HTTP/1.0 %s\r\n"
-             "Server: ubxlib\r\n"
-             "Content-type: %s\r\n"
-             "Content-Length: %d\r\n"
-             "Cache-Control: no-store, no-cache, must-revalidate\r\n"
-             "\r\n",
-             code, type, (int)length);
-    uSockWrite(sock, header, strlen(header));
+    size_t length = 0;
+    int32_t x = snprintf(pBuffer, bufferSize, U_WIFI_CAPTIVE_PORTAL_HEADER_FORMAT,
+                         pCode, pType, (int)bodyLength);
+    if ((x > 0) && ((size_t)x + bodyLength < bufferSize)) {
+        memcpy(pBuffer + x, pBody, bodyLength);
+        length = x + bodyLength;
+    }
+    return length;
 }
 
-// Send the gathered SSID list
-static void sendSsidList(int32_t sock)
+// Scan for SSIDs and render the response carrying the list of
+// them.  This is done once, before the event loop starts: a scan
+// takes seconds, during which the AT client is locked, so a scan
+// made from the event loop, or from another task while it runs,
+// would hold up every DNS lookup and HTTP client for that long.
+static void renderSsidList(uWifiCaptivePortalContext_t *pContext)
 {
-    strcpy(gSsidList, "{\"SSIDList\":[");
-    uWifiStationScan(gDevHandle, NULL, scanCallback);
-    if (gSsidList[strlen(gSsidList) - 1] == ',') {
-        gSsidList[strlen(gSsidList) - 1] = 0;
+    char *pSsidList = pContext->ssidList;
+    size_t length;
+
+    strcpy(pSsidList, "{\"SSIDList\":[");
+    uWifiStationScan(pContext->devHandle, NULL, scanCallback);
+    length = strlen(pSsidList);
+    if (pSsidList[length - 1] == ',') {
+        pSsidList[length - 1] = 0;
     }
-    strcat(gSsidList, "]}");
-    sendHeader(sock, "200 OK", "text/json", strlen(gSsidList));
-    uSockWrite(sock, gSsidList, strlen(gSsidList));
+    strcat(pSsidList, "]}");
+    pContext->ssidListResponseLength = renderResponse(pContext->ssidListResponse,
+                                                      sizeof(pContext->ssidListResponse),
+                                                      "200 OK", "text/json",
+                                                      pSsidList, strlen(pSsidList));
 }
 
 // Get a json string value, assume quoted name and value,
@@ -255,21 +362,23 @@ static void getVal(const char *txt,
 }
 
 // Set the user entered credentials
-static void updateWifi(int32_t sock, const char *params)
+static void updateWifi(uWifiCaptivePortalContext_t *pContext,
+                       int32_t sock, const char *params)
 {
-    getVal(params, "ssid", gSsid, sizeof(gSsid));
-    getVal(params, "pw", gPw, sizeof(gPw));
-    sendHeader(sock, "200 OK", "text/html", 0);
-    gKeepGoing = false;
+    getVal(params, "ssid", pContext->ssid, sizeof(pContext->ssid));
+    getVal(params, "pw", pContext->pw, sizeof(pContext->pw));
+    uSockWrite(sock, gOkResponse, sizeof(gOkResponse) - 1);
+    pContext->keepGoing = false;
 }
 
 // Handle incoming web server requests
-static void handleRequest(const char *request, int32_t sock)
+static void handleRequest(uWifiCaptivePortalContext_t *pContext,
+                          const char *request, int32_t sock)
 {
     char method[15];
     char url[25];
     size_t pos = 0;
-    while ((pos < (sizeof(method) - 1)) && (*request != ' ')) {
+    while ((pos < (sizeof(method) - 1)) && *request && (*request != ' ')) {
         method[pos++] = *(request++);
     }
     method[pos] = 0;
@@ -286,20 +395,19 @@ static void handleRequest(const char *request, int32_t sock)
         uPortLog(LOG_PREFIX "Requested url \"%s\"\n", url);
         if (strcmp(method, "GET") == 0) {
             if (strstr(url, "/get_ssid_list")) {
-                sendSsidList(sock);
+                uSockWrite(sock, pContext->ssidListResponse,
+                           pContext->ssidListResponseLength);
             } else if (strstr(url, "/favicon.ico")) {
                 // Chrome will request this but none available here
                 ok = false;
             } else {
                 // Any other request else just gets the main page
-                const char *p = gIndexPage;
-                size_t len = strlen(p);
-                sendHeader(sock, "200 OK", "text/html", len);
-                uSockWrite(sock, p, len);
+                uSockWrite(sock, pContext->pIndexResponse,
+                           pContext->indexResponseLength);
             }
         } else if (strcmp(method, "POST") == 0) {
             if (strstr(url, "/set_wifi")) {
-                updateWifi(sock, request);
+                updateWifi(pContext, sock, request);
             }
         } else {
             // Unsupported method type
@@ -307,22 +415,186 @@ static void handleRequest(const char *request, int32_t sock)
         }
     }
     if (!ok) {
-        sendHeader(sock, "404 Not Found", "text/html", 0);
+        uSockWrite(sock, gNotFoundResponse, sizeof(gNotFoundResponse) - 1);
     }
 }
 
-// Callback controlling whether the DNS server should continue or not
-static bool dnsKeepGoingCallback(uDeviceHandle_t deviceHandle)
+// Determine if a request has arrived in full: the headers must
+// have ended and any body given by Content-Length must be present.
+static bool requestIsComplete(const uWifiCaptivePortalClient_t *pClient)
 {
-    (void)deviceHandle;
-    return gKeepGoing;
+    bool complete = false;
+    const char *pHeaderEnd = strstr(pClient->request, "\r\n\r\n");
+    const char *pContentLength;
+    size_t headerLength;
+    int32_t contentLength = 0;
+
+    if (pHeaderEnd != NULL) {
+        headerLength = (pHeaderEnd - pClient->request) + 4;
+        pContentLength = strstr(pClient->request, "Content-Length:");
+        if (pContentLength == NULL) {
+            pContentLength = strstr(pClient->request, "content-length:");
+        }
+        if ((pContentLength != NULL) && (pContentLength < pHeaderEnd)) {
+            contentLength = strtol(pContentLength + 15, NULL, 10);
+        }
+        complete = (pClient->requestLength >= headerLength + contentLength);
+    }
+
+    return complete || (pClient->requestLength >= sizeof(pClient->request) - 1);
 }
 
-// The DNS server
-static void dnsServerTask(void *pParameters)
+// Read whatever a client has sent; returns false if the client
+// has gone.
+static bool clientRead(uWifiCaptivePortalClient_t *pClient)
 {
-    uDnsServer(gDevHandle, (const char *)pParameters, dnsKeepGoingCallback);
-    uPortTaskDelete(NULL);
+    int32_t cnt;
+    size_t received = 0;
+    do {
+        cnt = uSockRead(pClient->sock, pClient->request + pClient->requestLength,
+                        sizeof(pClient->request) - pClient->requestLength - 1);
+        if (cnt > 0) {
+            pClient->requestLength += cnt;
+            received += cnt;
+        }
+    } while ((cnt > 0) && (pClient->requestLength < (sizeof(pClient->request) - 1)));
+    pClient->request[pClient->requestLength] = 0;
+    if (received > 0) {
+        pClient->lastReceiveTimeMs = uPortGetTickTimeMs();
+    }
+    // Unblocked by select() with nothing to read means closed
+    return (received > 0) || (pClient->requestLength >= sizeof(pClient->request) - 1);
+}
+
+// Close a client and free its slot.
+static void clientClose(uWifiCaptivePortalClient_t *pClient)
+{
+    uSockClose(pClient->sock);
+    pClient->sock = -1;
+    pClient->requestLength = 0;
+}
+
+// Service one client after select(): read from it if it was
+// unblocked, respond once its request is complete and drop it
+// when it has gone quiet or is taking too long.
+static void clientService(uWifiCaptivePortalContext_t *pContext,
+                          uWifiCaptivePortalClient_t *pClient,
+                          bool readable)
+{
+    bool open = true;
+    bool respond = false;
+    int32_t nowMs;
+
+    if (readable) {
+        open = clientRead(pClient);
+    }
+    nowMs = uPortGetTickTimeMs();
+    if (pClient->requestLength > 0) {
+        respond = !open || requestIsComplete(pClient) ||
+                  (nowMs - pClient->lastReceiveTimeMs > U_WIFI_CAPTIVE_PORTAL_CLIENT_SOCKET_READ_DELAY_MS);
+    } else if (!open || (nowMs - pClient->connectedTimeMs > U_WIFI_CAPTIVE_PORTAL_CLIENT_TIMEOUT_MS)) {
+        uPortLog(LOG_PREFIX "ERROR No request\n");
+        clientClose(pClient);
+    }
+    if (respond) {
+        handleRequest(pContext, pClient->request, pClient->sock);
+        clientClose(pClient);
+    }
+}
+
+// Accept any connections waiting on the listening socket into
+// free client slots; returns false on a fatal error.
+static bool acceptClients(uWifiCaptivePortalContext_t *pContext, int32_t listenSock)
+{
+    bool ok = true;
+    uSockAddress_t remoteAddr;
+    char addrStr[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    int32_t clientSock;
+    uWifiCaptivePortalClient_t *pClient;
+
+    for (size_t x = 0; ok && (x < sizeof(pContext->client) / sizeof(pContext->client[0])); x++) {
+        pClient = &(pContext->client[x]);
+        if (pClient->sock < 0) {
+            clientSock = uSockAccept(listenSock, &remoteAddr);
+            if (clientSock >= 0) {
+                uSockIpAddressToString(&(remoteAddr.ipAddress), addrStr, sizeof(addrStr));
+                uPortLog(LOG_PREFIX "Connected to: %s\n", addrStr);
+                // Set non-blocking: the event loop does the waiting
+                uSockBlockingSet(clientSock, false);
+                pClient->sock = clientSock;
+                pClient->connectedTimeMs = uPortGetTickTimeMs();
+                pClient->lastReceiveTimeMs = pClient->connectedTimeMs;
+                pClient->requestLength = 0;
+            } else {
+                if (clientSock != U_ERROR_COMMON_TIMEOUT) {
+                    uPortLog(LOG_PREFIX "ERROR Accept failed: %d\n", clientSock);
+                    ok = false;
+                }
+                // Nothing more waiting
+                break;
+            }
+        }
+    }
+
+    return ok;
+}
+
+// The event loop: serve DNS and HTTP until told to stop.
+static void eventLoop(uWifiCaptivePortalContext_t *pContext,
+                      int32_t listenSock, int32_t dnsSock,
+                      uWifiCaptivePortalKeepGoingCallback_t cb)
+{
+    uSockDescriptorSet_t readSet;
+    int32_t maxDescriptor;
+    int32_t errorCodeOrNum;
+    uWifiCaptivePortalClient_t *pClient;
+
+    while (pContext->keepGoing) {
+        U_SOCK_FD_ZERO(&readSet);
+        maxDescriptor = 0;
+        if (dnsSock >= 0) {
+            U_SOCK_FD_SET(dnsSock, &readSet);
+            maxDescriptor = dnsSock + 1;
+        }
+        for (size_t x = 0; x < sizeof(pContext->client) / sizeof(pContext->client[0]); x++) {
+            pClient = &(pContext->client[x]);
+            if (pClient->sock >= 0) {
+                U_SOCK_FD_SET(pClient->sock, &readSet);
+                if (pClient->sock + 1 > maxDescriptor) {
+                    maxDescriptor = pClient->sock + 1;
+                }
+            }
+        }
+        errorCodeOrNum = uSockSelect(maxDescriptor, &readSet, NULL, NULL,
+                                     U_WIFI_CAPTIVE_PORTAL_SELECT_TIMEOUT_MS);
+        if (errorCodeOrNum < 0) {
+            // Don't spin on a persistent error
+            U_SOCK_FD_ZERO(&readSet);
+            uPortTaskBlock(U_WIFI_CAPTIVE_PORTAL_SELECT_TIMEOUT_MS);
+        }
+        if (U_SOCK_FD_ISSET(dnsSock, &readSet)) {
+            uDnsServerProcess(dnsSock, pContext->networkCfg.pApIpAddress);
+        }
+        for (size_t x = 0; x < sizeof(pContext->client) / sizeof(pContext->client[0]); x++) {
+            pClient = &(pContext->client[x]);
+            if (pClient->sock >= 0) {
+                clientService(pContext, pClient, U_SOCK_FD_ISSET(pClient->sock, &readSet));
+            }
+        }
+        if (pContext->keepGoing) {
+            pContext->keepGoing = acceptClients(pContext, listenSock);
+        }
+        if (pContext->keepGoing && (cb != NULL)) {
+            pContext->keepGoing = cb(pContext->devHandle);
+        }
+    }
+
+    for (size_t x = 0; x < sizeof(pContext->client) / sizeof(pContext->client[0]); x++) {
+        pClient = &(pContext->client[x]);
+        if (pClient->sock >= 0) {
+            clientClose(pClient);
+        }
+    }
 }
 
 /* ----------------------------------------------------------------
@@ -339,109 +611,113 @@ int32_t uWifiCaptivePortal(uDeviceHandle_t deviceHandle,
                            uWifiCaptivePortalKeepGoingCallback_t cb)
 {
     int32_t errorCode = 0;
+    uWifiCaptivePortalContext_t *pContext;
+    uNetworkCfgWifi_t *pNetworkCfg;
+    size_t length;
+
+    pContext = (uWifiCaptivePortalContext_t *) pUPortMalloc(sizeof(*pContext));
+    if (pContext == NULL) {
+        return (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    }
+    memset(pContext, 0, sizeof(*pContext));
+    for (size_t x = 0; x < sizeof(pContext->client) / sizeof(pContext->client[0]); x++) {
+        pContext->client[x].sock = -1;
+    }
+    // Render the landing page response once, up front
+    length = strlen(gIndexPage);
+    pContext->pIndexResponse = (char *) pUPortMalloc(U_WIFI_CAPTIVE_PORTAL_HEADER_MAX_LENGTH_BYTES +
+                                                     length);
+    if (pContext->pIndexResponse == NULL) {
+        uPortFree(pContext);
+        return (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    }
+    pContext->indexResponseLength = renderResponse(pContext->pIndexResponse,
+                                                   U_WIFI_CAPTIVE_PORTAL_HEADER_MAX_LENGTH_BYTES + length,
+                                                   "200 OK", "text/html", gIndexPage, length);
 
     // Wifi access point configuration
-    gNetworkCfg.type = U_NETWORK_TYPE_WIFI;
-    gNetworkCfg.mode = U_WIFI_MODE_AP;
-    gNetworkCfg.apAuthentication = (pPassword == NULL) ? U_WIFI_AUTH_OPEN : U_WIFI_AUTH_WPA_PSK;
-    gNetworkCfg.pApSssid = pSsid;
-    gNetworkCfg.pApPassPhrase = pPassword;
-    gNetworkCfg.pApIpAddress = "8.8.8.8";  // Required for Android
-
-    gDevHandle = deviceHandle;
-    gKeepGoing = true;
-    gSsid[0] = 0;
-    gPw[0] = 0;
+    pNetworkCfg = &(pContext->networkCfg);
+    pNetworkCfg->type = U_NETWORK_TYPE_WIFI;
+    pNetworkCfg->mode = U_WIFI_MODE_AP;
+    pNetworkCfg->apAuthentication = (pPassword == NULL) ? U_WIFI_AUTH_OPEN : U_WIFI_AUTH_WPA_PSK;
+    pNetworkCfg->pApSssid = pSsid;
+    pNetworkCfg->pApPassPhrase = pPassword;
+    pNetworkCfg->pApIpAddress = "8.8.8.8";  // Required for Android
+
+    pContext->devHandle = deviceHandle;
+    pContext->keepGoing = true;
+    gpContext = pContext;
     if (pSsid != NULL) {
         // Make sure that possible auto connected station mode is disconnected
-        uWifiStationDisconnect(gDevHandle);
+        uWifiStationDisconnect(deviceHandle);
+    }
+    // Find out what networks there are while no one is waiting
+    renderSsidList(pContext);
+    if (pSsid != NULL) {
         // Start the access point
-        errorCode = uNetworkInterfaceUp(gDevHandle, U_NETWORK_TYPE_WIFI, &gNetworkCfg);
+        errorCode = uNetworkInterfaceUp(deviceHandle, U_NETWORK_TYPE_WIFI, pNetworkCfg);
     }
     if (errorCode == 0) {
-        // Start a dns server which redirects all requests to this portal
-        uPortTaskHandle_t dnsServer;
-        uPortTaskCreate(dnsServerTask,
-                        "dns",
-                        U_WIFI_CAPTIVE_PORTAL_DNS_TASK_STACK_SIZE_BYTES,
-                        (void *)gNetworkCfg.pApIpAddress,
-                        U_WIFI_CAPTIVE_PORTAL_DNS_TASK_PRIORITY,
-                        &dnsServer);
+        // Start a dns server which redirects all requests to this
+        // portal, served from the same event loop as the web server
+        int32_t dnsSock = uDnsServerOpen(deviceHandle);
 
         // Start the web server
-        int32_t sock = uSockCreate(gDevHandle,
+        int32_t sock = uSockCreate(deviceHandle,
                                    U_SOCK_TYPE_STREAM,
                                    U_SOCK_PROTOCOL_TCP);
         if (sock >= 0) {
-            uSockAddress_t remoteAddr;
-            char addrStr[15];
-            remoteAddr.ipAddress.address.ipv4 = 0;
-            remoteAddr.port = 80;
-            uSockBind(sock, &remoteAddr);
-            uSockListen(sock, 1);
-            gUWifiSocketAcceptTimeoutS = 2;
+            uSockAddress_t localAddr;
+            int32_t acceptTimeoutS = gUWifiSocketAcceptTimeoutS;
+            memset(&localAddr, 0, sizeof(localAddr));
+            localAddr.port = 80;
+            uSockBind(sock, &localAddr);
+            uSockListen(sock, U_WIFI_CAPTIVE_PORTAL_MAX_NUM_CLIENTS);
+            // A listening socket is not visible to select():
+            // have accept() just check so that it can be polled
+            gUWifiSocketAcceptTimeoutS = 0;
             uPortLog(LOG_PREFIX "\"%s\" started\n", pSsid ? pSsid : "Servers only");
-            while (gKeepGoing) {
-                static char request[1024];
-                // Wait for connection
-                int32_t clientSock = uSockAccept(sock, &remoteAddr);
-                if (clientSock >= 0) {
-                    uSockIpAddressToString(&(remoteAddr.ipAddress), addrStr, sizeof(addrStr));
-                    uPortLog(LOG_PREFIX "Connected to: %s\n", addrStr);
-                    // Set non-blocking: we'll do our own
-                    uSockBlockingSet(clientSock, false);
-                    int32_t cnt;
-                    size_t requestLength = 0;
-                    do {
-                        // Wait for a short while to make sure we don't miss anything
-                        uPortTaskBlock(U_WIFI_CAPTIVE_PORTAL_CLIENT_SOCKET_READ_DELAY_MS);
-                        cnt = uSockRead(clientSock, request + requestLength,
-                                        sizeof(request) - requestLength - 1);
-                        if (cnt > 0) {
-                            requestLength += cnt;
-                        }
-                    } while ((cnt > 0) && (requestLength < (sizeof(request) - 1)));
-                    if (requestLength > 0) {
-                        request[requestLength] = 0;
-                        handleRequest(request, clientSock);
-                    } else {
-                        uPortLog(LOG_PREFIX "ERROR No request\n");
-                    }
-                    uSockClose(clientSock);
-                } else if (clientSock != U_ERROR_COMMON_TIMEOUT) {
-                    uPortLog(LOG_PREFIX "ERROR Accept failed: %d\n", clientSock);
-                    gKeepGoing = false;
-                } else if (cb) {
-                    gKeepGoing = cb(gDevHandle);
-                }
-            }
+            eventLoop(pContext, sock, dnsSock, cb);
+            gUWifiSocketAcceptTimeoutS = acceptTimeoutS;
             uSockClose(sock);
+            if (dnsSock >= 0) {
+                uSockClose(dnsSock);
+            }
             // Close down the access point and try to connect and save the entered credentials
             uPortTaskBlock(1000);
-            if (pSsid != NULL || strlen(gSsid) > 0) {
-                uNetworkInterfaceDown(gDevHandle, U_NETWORK_TYPE_WIFI);
+            if (pSsid != NULL || strlen(pContext->ssid) > 0) {
+                uNetworkInterfaceDown(deviceHandle, U_NETWORK_TYPE_WIFI);
             }
-            if (strlen(gSsid)) {
-                uPortLog(LOG_PREFIX "Connecting to SSID \"%s\"...\n", gSsid);
+            if (strlen(pContext->ssid)) {
+                uPortLog(LOG_PREFIX "Connecting to SSID \"%s\"...\n", pContext->ssid);
                 uPortTaskBlock(1000);
-                gNetworkCfg.authentication = (strlen(gPw) == 0) ? U_WIFI_AUTH_OPEN : U_WIFI_AUTH_WPA_PSK;
-                gNetworkCfg.pSsid = gSsid;
-                gNetworkCfg.pPassPhrase = gPw;
-                gNetworkCfg.mode = U_WIFI_MODE_STA;
-                errorCode = uNetworkInterfaceUp(gDevHandle, U_NETWORK_TYPE_WIFI, &gNetworkCfg);
+                pNetworkCfg->authentication = (strlen(pContext->pw) == 0) ? U_WIFI_AUTH_OPEN :
+                                              U_WIFI_AUTH_WPA_PSK;
+                pNetworkCfg->pSsid = pContext->ssid;
+                pNetworkCfg->pPassPhrase = pContext->pw;
+                pNetworkCfg->mode = U_WIFI_MODE_STA;
+                errorCode = uNetworkInterfaceUp(deviceHandle, U_NETWORK_TYPE_WIFI, pNetworkCfg);
                 if (errorCode == 0) {
-                    errorCode = uWifiStationStoreConfig(gDevHandle, false);
+                    errorCode = uWifiStationStoreConfig(deviceHandle, false);
                 }
             } else {
                 errorCode = U_ERROR_COMMON_NOT_INITIALISED;
             }
         } else {
             uPortLog(LOG_PREFIX "ERROR Failed to create server socket: %d\n", sock);
-            uNetworkInterfaceDown(gDevHandle, U_NETWORK_TYPE_WIFI);
+            if (dnsSock >= 0) {
+                uSockClose(dnsSock);
+            }
+            uNetworkInterfaceDown(deviceHandle, U_NETWORK_TYPE_WIFI);
             errorCode = sock;
         }
     } else {
         uPortLog(LOG_PREFIX "ERROR Failed to start the access point: %d\n", errorCode);
     }
+
+    gpContext = NULL;
+    uPortFree(pContext->pIndexResponse);
+    uPortFree(pContext);
+
     return errorCode;
-}
\ No newline at end of file
+}
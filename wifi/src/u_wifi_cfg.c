@@ -32,6 +32,7 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // strcmp()
 
 #include "u_error_common.h"
 
@@ -51,10 +52,44 @@
 
 #define U_WIFI_CFG_STARTUP_MODE_EDM 2
 
+/** The AT+UWSC tag for the IPv4 mode of a station configuration.
+ */
+#define U_WIFI_CFG_UWSC_TAG_IPV4_MODE 100
+
+/** The first AT+UWSC tag of the static IPv4 settings (address,
+ * subnet mask, gateway, DNS1 and DNS2 follow on contiguously).
+ */
+#define U_WIFI_CFG_UWSC_TAG_IPV4_FIRST 101
+
+/** The number of static IPv4 settings.
+ */
+#define U_WIFI_CFG_UWSC_NUM_IPV4 5
+
+/** IPv4 mode value for static.
+ */
+#define U_WIFI_CFG_IPV4_MODE_STATIC 1
+
+/** IPv4 mode value for DHCP.
+ */
+#define U_WIFI_CFG_IPV4_MODE_DHCP 2
+
+/** The time to wait after the module has been restarted.
+ */
+#define U_WIFI_CFG_RESTART_WAIT_MS 500
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The settings of the module that uWifiCfgConfigure() may change,
+ * read in one pass so that only the differences need be written.
+ */
+typedef struct {
+    int32_t startupMode;
+    int32_t ipv4Mode;
+    char ipv4[U_WIFI_CFG_UWSC_NUM_IPV4][U_WIFI_IP_ADDR_STR_MAX_LEN];
+} uWifiCfgSettings_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -63,19 +98,60 @@
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
-static int32_t getStartupMode(const uAtClientHandle_t atHandle)
+// Read the current settings in one pass, under a single AT lock;
+// the static IPv4 settings are only read if readIpv4 is true.
+static int32_t readSettings(const uAtClientHandle_t atHandle,
+                            uWifiCfgSettings_t *pSettings, bool readIpv4)
 {
-    int32_t modeOrError;
+    size_t numTags = readIpv4 ? U_WIFI_CFG_UWSC_NUM_IPV4 + 1 : 1;
+    int32_t tag;
 
+    memset(pSettings, 0, sizeof(*pSettings));
     uAtClientLock(atHandle);
     uAtClientCommandStart(atHandle, "AT+UMSM?");
     uAtClientCommandStop(atHandle);
     uAtClientResponseStart(atHandle, "+UMSM:");
-    modeOrError = uAtClientReadInt(atHandle);
+    pSettings->startupMode = uAtClientReadInt(atHandle);
     uAtClientResponseStop(atHandle);
-    uAtClientUnlock(atHandle);
+    for (size_t x = 0; x < numTags; x++) {
+        tag = U_WIFI_CFG_UWSC_TAG_IPV4_MODE + (int32_t) x;
+        uAtClientCommandStart(atHandle, "AT+UWSC=");
+        uAtClientWriteInt(atHandle, 0);
+        uAtClientWriteInt(atHandle, tag);
+        uAtClientCommandStop(atHandle);
+        uAtClientResponseStart(atHandle, "+UWSC:");
+        // Skip the configuration ID and the tag
+        uAtClientSkipParameters(atHandle, 2);
+        if (tag == U_WIFI_CFG_UWSC_TAG_IPV4_MODE) {
+            pSettings->ipv4Mode = uAtClientReadInt(atHandle);
+        } else {
+            uAtClientReadString(atHandle, pSettings->ipv4[x - 1],
+                                sizeof(pSettings->ipv4[x - 1]), false);
+        }
+        uAtClientResponseStop(atHandle);
+    }
 
-    return modeOrError;
+    return uAtClientUnlock(atHandle);
+}
+
+// Return true if the static IPv4 settings in pSettings are those
+// of pWifiIpCfg.
+static bool ipv4IsSame(const uWifiCfgSettings_t *pSettings,
+                       const uWifiIpCfg_t *pWifiIpCfg)
+{
+    const uint8_t *pWanted[U_WIFI_CFG_UWSC_NUM_IPV4] = {pWifiIpCfg->IPv4Addr,
+                                                        pWifiIpCfg->subnetMask,
+                                                        pWifiIpCfg->defaultGW,
+                                                        pWifiIpCfg->DNS1,
+                                                        pWifiIpCfg->DNS2
+                                                       };
+    bool isSame = (pSettings->ipv4Mode == U_WIFI_CFG_IPV4_MODE_STATIC);
+
+    for (size_t x = 0; isSame && (x < U_WIFI_CFG_UWSC_NUM_IPV4); x++) {
+        isSame = (strcmp(pSettings->ipv4[x], (const char *) pWanted[x]) == 0);
+    }
+
+    return isSame;
 }
 
 static int32_t setStartupMode(const uAtClientHandle_t atHandle, int32_t mode)
@@ -90,32 +166,6 @@ static int32_t setStartupMode(const uAtClientHandle_t atHandle, int32_t mode)
     return error;
 }
 
-static int32_t restart(const uAtClientHandle_t atHandle, bool store)
-{
-    int32_t error = (int32_t) U_ERROR_COMMON_SUCCESS;
-
-    if (store) {
-        uAtClientLock(atHandle);
-        uAtClientCommandStart(atHandle, "AT&W");
-        uAtClientCommandStopReadResponse(atHandle);
-        error = uAtClientUnlock(atHandle);
-    }
-
-    if (error == (int32_t) U_ERROR_COMMON_SUCCESS) {
-        uAtClientLock(atHandle);
-        uAtClientCommandStart(atHandle, "AT+CPWROFF");
-        uAtClientCommandStopReadResponse(atHandle);
-        error = uAtClientUnlock(atHandle);
-
-        if (error == (int32_t) U_ERROR_COMMON_SUCCESS) {
-            uPortTaskBlock(500);
-            uAtClientFlush(atHandle);
-        }
-    }
-
-    return error;
-}
-
 static int32_t uWifiStationSetStaticIP(const uAtClientHandle_t atHandle,
                                        const uWifiIpCfg_t *wifiIpCfg)
 {
@@ -166,8 +216,8 @@ static int32_t uWifiStationSetDHCP(const uAtClientHandle_t atHandle)
     uAtClientLock(atHandle);
     uAtClientCommandStart(atHandle, "AT+UWSC=");
     uAtClientWriteInt(atHandle, 0);
-    uAtClientWriteInt(atHandle, 100);
-    uAtClientWriteInt(atHandle, 2);
+    uAtClientWriteInt(atHandle, U_WIFI_CFG_UWSC_TAG_IPV4_MODE);
+    uAtClientWriteInt(atHandle, U_WIFI_CFG_IPV4_MODE_DHCP);
     uAtClientCommandStopReadResponse(atHandle);
     error = uAtClientUnlock(atHandle);
 
@@ -183,6 +233,7 @@ int32_t uWifiCfgConfigure(uDeviceHandle_t devHandle,
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
     uShortRangePrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
+    uWifiCfgSettings_t settings;
 
     if (gUShortRangePrivateMutex != NULL) {
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
@@ -194,15 +245,23 @@ int32_t uWifiCfgConfigure(uDeviceHandle_t devHandle,
             if (pInstance != NULL) {
                 atHandle = pInstance->atHandle;
                 errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                bool restartNeeded = false;
+
+                // Read what is there already and then send only the
+                // differences; if the read fails, send everything
+                if (readSettings(atHandle, &settings, !pCfg->dhcp) != 0) {
+                    memset(&settings, 0, sizeof(settings));
+                    settings.startupMode = -1;
+                }
                 if (pCfg->dhcp) {
-                    uWifiStationSetDHCP(atHandle);
-                } else {
+                    if (settings.ipv4Mode != U_WIFI_CFG_IPV4_MODE_DHCP) {
+                        uWifiStationSetDHCP(atHandle);
+                    }
+                } else if (!ipv4IsSame(&settings, &pCfg->wifiIpCfg)) {
                     uWifiStationSetStaticIP(atHandle, &pCfg->wifiIpCfg);
                 }
-                bool restartNeeded = false;
 
-                int32_t mode = getStartupMode(atHandle);
-                if (mode != U_WIFI_CFG_STARTUP_MODE_EDM) {
+                if (settings.startupMode != U_WIFI_CFG_STARTUP_MODE_EDM) {
                     errorCode = setStartupMode(atHandle, U_WIFI_CFG_STARTUP_MODE_EDM);
                     if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
                         restartNeeded = true;
@@ -211,7 +270,9 @@ int32_t uWifiCfgConfigure(uDeviceHandle_t devHandle,
 
 
                 if (errorCode >= 0 && restartNeeded) {
-                    restart(atHandle, true);
+                    // Deferred to uShortRangeCfgBatchEnd() if batching
+                    uShortRangePrivateStoreAndRestart(pInstance,
+                                                      U_WIFI_CFG_RESTART_WAIT_MS);
                 }
             }
 
@@ -126,6 +126,12 @@
  */
 static int32_t gHttpHandleCache[U_WIFI_HTTP_MAX_NUM] = {0};
 
+/** The peer URL of each entry in gHttpHandleCache, so that the
+ * peer connection can be given to the short range peer pool
+ * when the session is closed.
+ */
+static char *gpHttpUrlCache[U_WIFI_HTTP_MAX_NUM] = {0};
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -144,8 +150,10 @@ static bool httpHandleIsInCache(int32_t handle)
     return found;
 }
 
-// Store an HTTP handle in the HTTP handle cache.
-static int32_t httpHandleStoreInCache(int32_t handle)
+// Store an HTTP handle, and a copy of its peer URL, in the HTTP
+// handle cache; the URL copy is not essential, if there is no
+// memory for it the peer will not be pooled when closed.
+static int32_t httpHandleStoreInCache(int32_t handle, const char *pUrl)
 {
     // A nice obvious error code, since this shouldn't really happen
     int32_t errorCode = (int32_t) U_ERROR_COMMON_TEMPORARY_FAILURE;
@@ -156,6 +164,10 @@ static int32_t httpHandleStoreInCache(int32_t handle)
              (errorCode < 0); x++) {
             if (gHttpHandleCache[x] == 0) {
                 gHttpHandleCache[x] = handle;
+                gpHttpUrlCache[x] = (char *) pUPortMalloc(strlen(pUrl) + 1);
+                if (gpHttpUrlCache[x] != NULL) {
+                    strcpy(gpHttpUrlCache[x], pUrl);
+                }
                 errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
             }
         }
@@ -171,11 +183,28 @@ static void httpHandleClearFromCache(int32_t handle)
         for (size_t x = 0; x < sizeof(gHttpHandleCache) / sizeof(gHttpHandleCache[0]); x++) {
             if (gHttpHandleCache[x] == handle) {
                 gHttpHandleCache[x] = 0;
+                uPortFree(gpHttpUrlCache[x]);
+                gpHttpUrlCache[x] = NULL;
             }
         }
     }
 }
 
+// Get the peer URL of an HTTP handle in the HTTP handle cache.
+static const char *pHttpUrlFromCache(int32_t handle)
+{
+    const char *pUrl = NULL;
+
+    for (size_t x = 0; (pUrl == NULL) &&
+         (x < sizeof(gHttpHandleCache) / sizeof(gHttpHandleCache[0])); x++) {
+        if ((handle > 0) && (gHttpHandleCache[x] == handle)) {
+            pUrl = gpHttpUrlCache[x];
+        }
+    }
+
+    return pUrl;
+}
+
 // Return true if the given string is allowed
 // in a message for an HttpRequest.
 static bool isAllowedHttpRequestStr(const char *pStr, size_t maxLength)
@@ -426,24 +455,34 @@ int32_t uWifiHttpOpen(uDeviceHandle_t wifiHandle, const char *pServerName,
                     if (pInstance->pHttpContext->pSecurityContext) {
                         strncat(urlBuffer, "&encr=1", sizeof(urlBuffer) - strlen(urlBuffer) - 1);
                     }
-                    // Configure the server in the connection
-                    uPortLog("U_WIFI_HTTP: sending AT+UDCP\n");
-                    uAtClientLock(atHandle);
-                    uAtClientCommandStart(atHandle, "AT+UDCP=http-tcp://");
-                    uAtClientWriteString(atHandle, urlBuffer, false);
-                    uAtClientCommandStop(atHandle);
-                    uAtClientResponseStart(atHandle, "+UUDPC:");
-                    httpHandle = uAtClientReadInt(atHandle);
-                    peerType = uAtClientReadInt(atHandle);
-                    uAtClientResponseStop(atHandle);
-                    errorCode = uAtClientUnlock(atHandle);
+                    // Re-use an idle connection to the same server, with
+                    // the same options, if the peer pool has one: this
+                    // saves the TCP and TLS handshakes
+                    httpHandle = uShortRangePrivatePeerPoolTake(pInstance, urlBuffer);
+                    if (httpHandle >= 0) {
+                        uPortLog("U_WIFI_HTTP: re-using peer %d.\n", httpHandle);
+                        peerType = 2;
+                        errorCode = 0;
+                    } else {
+                        // Configure the server in the connection
+                        uPortLog("U_WIFI_HTTP: sending AT+UDCP\n");
+                        uAtClientLock(atHandle);
+                        uAtClientCommandStart(atHandle, "AT+UDCP=http-tcp://");
+                        uAtClientWriteString(atHandle, urlBuffer, false);
+                        uAtClientCommandStop(atHandle);
+                        uAtClientResponseStart(atHandle, "+UUDPC:");
+                        httpHandle = uAtClientReadInt(atHandle);
+                        peerType = uAtClientReadInt(atHandle);
+                        uAtClientResponseStop(atHandle);
+                        errorCode = uAtClientUnlock(atHandle);
+                    }
                     if (errorCode == 0) {
                         if (peerType < 2 || peerType > 3) { // check that IPV4/6
                             errorCode = (int32_t) U_ERROR_COMMON_UNKNOWN;
                         }
                         if (errorCode == 0) {
                             // Done: store the handle in the cache and hook in the URC
-                            errorCode = httpHandleStoreInCache(httpHandle);
+                            errorCode = httpHandleStoreInCache(httpHandle, urlBuffer);
                             if (errorCode == 0) {
                                 errorCode = uAtClientSetUrcHandler(atHandle, "+UUDHTTP:",
                                                                    uWifiPrivateUudhttpUrc,
@@ -475,6 +514,7 @@ void uWifiHttpClose(uDeviceHandle_t wifiHandle, int32_t httpHandle)
     uShortRangePrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
     uHttpClientContextWifi_t *pContextWifi;
+    const char *pUrl;
 
     if (gUShortRangePrivateMutex != NULL) {
         U_PORT_MUTEX_LOCK(gUShortRangePrivateMutex);
@@ -491,8 +531,14 @@ void uWifiHttpClose(uDeviceHandle_t wifiHandle, int32_t httpHandle)
                         uAtClientPrintAtSet(atHandle, true);
                     }
                 }
-                // Send the AT sequence to close a HTTP session
-                atCloseHttp(atHandle, httpHandle);
+                // Keep the peer connection open in the peer pool for
+                // re-use if possible, else close it
+                pUrl = pHttpUrlFromCache(httpHandle);
+                if ((pUrl == NULL) ||
+                    !uShortRangePrivatePeerPoolGive(pInstance, pUrl, httpHandle)) {
+                    // Send the AT sequence to close a HTTP session
+                    atCloseHttp(atHandle, httpHandle);
+                }
                 httpHandleClearFromCache(httpHandle);
                 pInstance->pWifiHttpCallBack = NULL;
                 pInstance->pHttpContext = NULL;
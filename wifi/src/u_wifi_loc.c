@@ -56,6 +56,7 @@
 #include "u_short_range.h"
 #include "u_short_range_private.h"
 #include "u_wifi_module_type.h"
+#include "u_wifi.h" // uWifiStationScanCached(), U_WIFI_BSSID_SIZE
 #include "u_wifi_loc.h"
 #include "u_wifi_loc_private.h"
 #include "u_wifi_private.h"
@@ -100,6 +101,25 @@ typedef struct {
     uWifiLocCallback_t *pCallback;
 } uWifiLocCallbackContext_t;
 
+/** An entry in the location cache of uWifiLocGet().
+ */
+typedef struct {
+    size_t numAps;           /**< zero if the entry is not in use. */
+    uint32_t fingerprint;    /**< hash of the BSSIDs, for a quick exact match. */
+    uint8_t bssids[U_WIFI_LOC_CACHE_FINGERPRINT_NUM_APS][U_WIFI_BSSID_SIZE]; /**< sorted. */
+    int32_t timeMs;          /**< when the location was obtained from the cloud. */
+    int32_t lastUsedMs;      /**< when the entry was last added or returned. */
+    uLocation_t location;
+} uWifiLocCacheEntry_t;
+
+/** The location cache of uWifiLocGet(), hung off the pWifiLocCache
+ * member of the short range instance.
+ */
+typedef struct {
+    int32_t maxAgeMs;
+    uWifiLocCacheEntry_t entries[U_WIFI_LOC_CACHE_NUM_ENTRIES];
+} uWifiLocCache_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -353,6 +373,141 @@ static volatile uWifiLocContext_t *pBeginLocationAlloc(uShortRangePrivateInstanc
     return pContext;
 }
 
+// Hash a sorted list of BSSIDs (32-bit FNV-1a).
+static uint32_t fingerprintHash(const uint8_t *pBssids, size_t numAps)
+{
+    uint32_t hash = 2166136261UL;
+
+    for (size_t x = 0; x < numAps * U_WIFI_BSSID_SIZE; x++) {
+        hash ^= *(pBssids + x);
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+// Count the BSSIDs common to two sorted lists.
+static size_t fingerprintCommon(const uint8_t *pBssidsA, size_t numA,
+                                const uint8_t *pBssidsB, size_t numB)
+{
+    size_t common = 0;
+    size_t a = 0;
+    size_t b = 0;
+    int32_t x;
+
+    while ((a < numA) && (b < numB)) {
+        x = memcmp(pBssidsA + (a * U_WIFI_BSSID_SIZE),
+                   pBssidsB + (b * U_WIFI_BSSID_SIZE), U_WIFI_BSSID_SIZE);
+        if (x == 0) {
+            common++;
+            a++;
+            b++;
+        } else if (x < 0) {
+            a++;
+        } else {
+            b++;
+        }
+    }
+
+    return common;
+}
+
+// Find the cache entry that best matches a fingerprint, NULL if
+// there is none that matches well enough.
+static uWifiLocCacheEntry_t *pLocCacheFind(uWifiLocCache_t *pCache,
+                                           uLocationType_t type,
+                                           const uint8_t *pBssids,
+                                           size_t numAps)
+{
+    uWifiLocCacheEntry_t *pBest = NULL;
+    uWifiLocCacheEntry_t *pEntry;
+    uint32_t fingerprint = fingerprintHash(pBssids, numAps);
+    size_t bestCommon = 0;
+    size_t common;
+    size_t largest;
+
+    for (size_t x = 0; (x < U_WIFI_LOC_CACHE_NUM_ENTRIES) &&
+         ((pBest == NULL) || (bestCommon < numAps)); x++) {
+        pEntry = &(pCache->entries[x]);
+        if ((pEntry->numAps > 0) && (pEntry->location.type == type) &&
+            (uPortGetTickTimeMs() - pEntry->timeMs < pCache->maxAgeMs)) {
+            if ((pEntry->fingerprint == fingerprint) && (pEntry->numAps == numAps) &&
+                (memcmp(pEntry->bssids, pBssids, numAps * U_WIFI_BSSID_SIZE) == 0)) {
+                // Exact match, can't do better than that
+                pBest = pEntry;
+                bestCommon = numAps;
+            } else {
+                common = fingerprintCommon(pEntry->bssids[0], pEntry->numAps,
+                                           pBssids, numAps);
+                largest = pEntry->numAps;
+                if (numAps > largest) {
+                    largest = numAps;
+                }
+                if ((common * 100 >= largest * U_WIFI_LOC_CACHE_MATCH_PERCENT) &&
+                    (common > bestCommon)) {
+                    pBest = pEntry;
+                    bestCommon = common;
+                }
+            }
+        }
+    }
+
+    return pBest;
+}
+
+// Add a location to the cache, replacing an unused or expired entry
+// or, failing that, the least recently used.
+static void locCacheAdd(uWifiLocCache_t *pCache, const uint8_t *pBssids,
+                        size_t numAps, const uLocation_t *pLocation)
+{
+    uWifiLocCacheEntry_t *pEntry = &(pCache->entries[0]);
+    int32_t nowMs = uPortGetTickTimeMs();
+
+    for (size_t x = 0; x < U_WIFI_LOC_CACHE_NUM_ENTRIES; x++) {
+        if ((pCache->entries[x].numAps == 0) ||
+            (nowMs - pCache->entries[x].timeMs >= pCache->maxAgeMs)) {
+            pEntry = &(pCache->entries[x]);
+            break;
+        }
+        if (nowMs - pCache->entries[x].lastUsedMs > nowMs - pEntry->lastUsedMs) {
+            pEntry = &(pCache->entries[x]);
+        }
+    }
+    memcpy(pEntry->bssids, pBssids, numAps * U_WIFI_BSSID_SIZE);
+    pEntry->numAps = numAps;
+    pEntry->fingerprint = fingerprintHash(pBssids, numAps);
+    pEntry->timeMs = nowMs;
+    pEntry->lastUsedMs = nowMs;
+    pEntry->location = *pLocation;
+}
+
+// Scan callback for uWifiLocGet(): nothing to do, the scan is only
+// needed for the results it leaves behind for the location cache.
+static void locCacheScanCallback(uDeviceHandle_t devHandle, uWifiScanResult_t *pResult)
+{
+    (void) devHandle;
+    (void) pResult;
+}
+
+// Return true if the location cache is switched on.
+static bool locCacheIsOn(uDeviceHandle_t wifiHandle)
+{
+    bool isOn = false;
+    uShortRangePrivateInstance_t *pInstance;
+
+    if (gUShortRangePrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUShortRangePrivateMutex);
+
+        pInstance = pUShortRangePrivateGetInstance(wifiHandle);
+        isOn = (pInstance != NULL) && (pInstance->pWifiLocCache != NULL);
+
+        U_PORT_MUTEX_UNLOCK(gUShortRangePrivateMutex);
+    }
+
+    return isOn;
+}
+
 // Ensure that we have a location mutex for the instance.
 static int32_t ensureMutex(uShortRangePrivateInstance_t *pInstance)
 {
@@ -504,6 +659,19 @@ int32_t uWifiLocGet(uDeviceHandle_t wifiHandle,
     volatile uWifiLocContext_t *pContext;
     uAtClientHandle_t atHandle;
     int32_t startTimeMs;
+    uWifiLocCache_t *pCache = NULL;
+    uWifiLocCacheEntry_t *pEntry = NULL;
+    uint8_t bssids[U_WIFI_LOC_CACHE_FINGERPRINT_NUM_APS][U_WIFI_BSSID_SIZE];
+    size_t numAps = 0;
+
+    // If the location cache is switched on, make sure that there
+    // is a recent scan to take a fingerprint from; this must be
+    // done before the short range mutex is locked as the scan
+    // locks it itself
+    if (locCacheIsOn(wifiHandle)) {
+        uWifiStationScanCached(wifiHandle, NULL, U_WIFI_LOC_CACHE_SCAN_MAX_AGE_MS,
+                               locCacheScanCallback);
+    }
 
     if (gUShortRangePrivateMutex != NULL) {
 
@@ -524,35 +692,65 @@ int32_t uWifiLocGet(uDeviceHandle_t wifiHandle,
                 // Can only fiddle with memory if we have the location mutex
                 errorCode = (int32_t) U_ERROR_COMMON_BUSY;
                 if (uPortMutexTryLock(pInstance->locMutex, 0) == 0) {
-                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
-                    pContext = pBeginLocationAlloc(pInstance, type, pApiKey,
-                                                   accessPointsFilter, rssiDbmFilter,
-                                                   pLocation);
-                    if (pContext != NULL) {
-                        pInstance->pLocContext = (volatile void *) pContext;
-                        // UNLOCK the location mutex to let the URC handler run
+                    pCache = (uWifiLocCache_t *) pInstance->pWifiLocCache;
+                    if (pCache != NULL) {
+                        numAps = uWifiPrivateScanCacheGetBssids(pInstance->pWifiScanCache,
+                                                                U_WIFI_LOC_CACHE_SCAN_MAX_AGE_MS,
+                                                                rssiDbmFilter, bssids[0],
+                                                                U_WIFI_LOC_CACHE_FINGERPRINT_NUM_APS);
+                        // Only a fingerprint with as many access points as
+                        // the module would need is any use
+                        if ((numAps == 0) || ((accessPointsFilter > 0) &&
+                                              (numAps < (size_t) accessPointsFilter) &&
+                                              (numAps < U_WIFI_LOC_CACHE_FINGERPRINT_NUM_APS))) {
+                            pCache = NULL;
+                        }
+                    }
+                    if (pCache != NULL) {
+                        pEntry = pLocCacheFind(pCache, type, bssids[0], numAps);
+                    }
+                    if (pEntry != NULL) {
+                        // Same place as before, no need to trouble the cloud
+                        pEntry->lastUsedMs = uPortGetTickTimeMs();
+                        if (pLocation != NULL) {
+                            *pLocation = pEntry->location;
+                        }
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
                         uPortMutexUnlock(pInstance->locMutex);
-                        // Hook in the URC handler and wait
-                        atHandle = pInstance->atHandle;
-                        errorCode = uAtClientSetUrcHandler(atHandle, "+UUDHTTP:",
-                                                           uWifiPrivateUudhttpUrc,
-                                                           pInstance);
-                        if (errorCode == 0) {
-                            startTimeMs = uPortGetTickTimeMs();
-                            while ((pContext->errorCode == (int32_t) U_ERROR_COMMON_TIMEOUT) &&
-                                   (((pKeepGoingCallback == NULL) &&
-                                     ((uPortGetTickTimeMs() - startTimeMs) < U_WIFI_LOC_ANSWER_TIMEOUT_SECONDS * 1000)) ||
-                                    ((pKeepGoingCallback != NULL) && pKeepGoingCallback(wifiHandle)))) {
-                                uPortTaskBlock(250);
+                    } else {
+                        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                        pContext = pBeginLocationAlloc(pInstance, type, pApiKey,
+                                                       accessPointsFilter, rssiDbmFilter,
+                                                       pLocation);
+                        if (pContext != NULL) {
+                            pInstance->pLocContext = (volatile void *) pContext;
+                            // UNLOCK the location mutex to let the URC handler run
+                            uPortMutexUnlock(pInstance->locMutex);
+                            // Hook in the URC handler and wait
+                            atHandle = pInstance->atHandle;
+                            errorCode = uAtClientSetUrcHandler(atHandle, "+UUDHTTP:",
+                                                               uWifiPrivateUudhttpUrc,
+                                                               pInstance);
+                            if (errorCode == 0) {
+                                startTimeMs = uPortGetTickTimeMs();
+                                while ((pContext->errorCode == (int32_t) U_ERROR_COMMON_TIMEOUT) &&
+                                       (((pKeepGoingCallback == NULL) &&
+                                         ((uPortGetTickTimeMs() - startTimeMs) < U_WIFI_LOC_ANSWER_TIMEOUT_SECONDS * 1000)) ||
+                                        ((pKeepGoingCallback != NULL) && pKeepGoingCallback(wifiHandle)))) {
+                                    uPortTaskBlock(250);
+                                }
+                                errorCode = pContext->errorCode;
+                            }
+                            if ((errorCode == 0) && (pCache != NULL) && (pLocation != NULL)) {
+                                locCacheAdd(pCache, bssids[0], numAps, pLocation);
                             }
-                            errorCode = pContext->errorCode;
+                            pInstance->pLocContext = NULL;
+                            // Free memory
+                            uPortFree((void *) pContext);
+                        } else {
+                            // UNLOCK the location mutex on error
+                            uPortMutexUnlock(pInstance->locMutex);
                         }
-                        pInstance->pLocContext = NULL;
-                        // Free memory
-                        uPortFree((void *) pContext);
-                    } else {
-                        // UNLOCK the location mutex on error
-                        uPortMutexUnlock(pInstance->locMutex);
                     }
                 }
             }
@@ -669,6 +867,48 @@ void uWifiLocGetStop(uDeviceHandle_t wifiHandle)
     }
 }
 
+// Switch the location cache of uWifiLocGet() on or off.
+int32_t uWifiLocSetCache(uDeviceHandle_t wifiHandle, int32_t maxAgeSeconds)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+    uWifiLocCache_t *pCache;
+
+    if (gUShortRangePrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUShortRangePrivateMutex);
+
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pUShortRangePrivateGetInstance(wifiHandle);
+        if ((pInstance != NULL) && (maxAgeSeconds >= 0) &&
+            (maxAgeSeconds <= INT32_MAX / 1000)) {
+            errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            pCache = (uWifiLocCache_t *) pInstance->pWifiLocCache;
+            if (maxAgeSeconds == 0) {
+                uPortFree(pCache);
+                pInstance->pWifiLocCache = NULL;
+            } else {
+                if (pCache == NULL) {
+                    errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                    pCache = (uWifiLocCache_t *) pUPortMalloc(sizeof(*pCache));
+                    if (pCache != NULL) {
+                        memset(pCache, 0, sizeof(*pCache));
+                        pInstance->pWifiLocCache = pCache;
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    }
+                }
+                if (pCache != NULL) {
+                    pCache->maxAgeMs = maxAgeSeconds * 1000;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUShortRangePrivateMutex);
+    }
+
+    return errorCode;
+}
+
 // Free the mutex that is protecting the data passed around by uWifiLoc.
 void uWifiLocFree(uDeviceHandle_t wifiHandle)
 {
@@ -106,6 +106,8 @@ typedef struct uWifiMqttSession_t {
     uAtClientHandle_t atHandle;
     int32_t localPort;
     int32_t unreadMsgsCount;
+    int32_t rxDropCount; /**< The number of messages dropped
+                              because the queue was full. */
     uPortSemaphoreHandle_t semaphore;
     void *pCbParam;
     void (*pDataCb)(int32_t unreadMsgsCount, void *pCbParam);
@@ -507,6 +509,21 @@ static void onCallbackEvent(void *pParam, size_t eventSize)
     }
 }
 
+// Return true if there is room for another message of the given
+// size in the receive queue of an MQTT session.
+static bool rxQueueHasRoom(const uWifiMqttSession_t *pMqttSession, size_t size)
+{
+    size_t queuedBytes = size;
+
+    for (const uShortRangePbufList_t *pList = pMqttSession->rxPkt.pBufListHead;
+         pList != NULL; pList = pList->pNext) {
+        queuedBytes += pList->totalLen;
+    }
+
+    return (pMqttSession->rxPkt.pktCount < U_WIFI_MQTT_RX_QUEUE_MAX_MESSAGES) &&
+           (queuedBytes <= U_WIFI_MQTT_RX_QUEUE_MAX_BYTES);
+}
+
 static void edmMqttDataCallback(int32_t edmHandle, int32_t edmChannel,
                                 uShortRangePbufList_t *pBufList,
                                 void *pCallbackParameter)
@@ -520,17 +537,23 @@ static void edmMqttDataCallback(int32_t edmHandle, int32_t edmChannel,
 
     U_PORT_MUTEX_LOCK(gMqttSessionMutex);
 
-    for (i = 0; i < U_WIFI_MQTT_MAX_NUM_CONNECTIONS; i++) {
+    for (i = 0; (i < U_WIFI_MQTT_MAX_NUM_CONNECTIONS) && (pBufList != NULL); i++) {
 
         pMqttSession = &gMqttSessions[i];
 
-        for (pTopic = pMqttSession->topicList.pHead; pTopic != NULL; pTopic = pTopic->pNext) {
+        for (pTopic = pMqttSession->topicList.pHead; (pTopic != NULL) && (pBufList != NULL);
+             pTopic = pTopic->pNext) {
 
             if ((pTopic->edmChannel == edmChannel) && (!pTopic->isTopicUnsubscribed)) {
 
                 uPortLog("U_WIFI_MQTT: EDM data event for channel %d\n", edmChannel);
-                if (uShortRangePktListAppend(&pMqttSession->rxPkt,
-                                             pBufList) == (int32_t)U_ERROR_COMMON_SUCCESS) {
+                if (!rxQueueHasRoom(pMqttSession, pBufList->totalLen)) {
+                    // Drop it rather than let this session hog the pbufs
+                    uPortLog("U_WIFI_MQTT: receive queue full, message dropped\n");
+                    pMqttSession->rxDropCount++;
+                    uShortRangePbufListFree(pBufList);
+                } else if (uShortRangePktListAppend(&pMqttSession->rxPkt,
+                                                    pBufList) == (int32_t)U_ERROR_COMMON_SUCCESS) {
                     doCallback = (pMqttSession->rxPkt.pktCount > pMqttSession->unreadMsgsCount);
                     pMqttSession->unreadMsgsCount = pMqttSession->rxPkt.pktCount;
                     // Schedule user data pDataCb
@@ -549,10 +572,17 @@ static void edmMqttDataCallback(int32_t edmHandle, int32_t edmChannel,
                     uPortLog("U_WIFI_MQTT: Pkt insert failed\n");
                     uShortRangePbufListFree(pBufList);
                 }
+                // Either way, the message has been dealt with
+                pBufList = NULL;
             }
         }
     }
 
+    if (pBufList != NULL) {
+        // No-one subscribed to it
+        uShortRangePbufListFree(pBufList);
+    }
+
     U_PORT_MUTEX_UNLOCK(gMqttSessionMutex);
 }
 
@@ -713,6 +743,7 @@ static void freeMqttSession(uWifiMqttSession_t *pMqttSession)
         if (pMqttSession->topicList.pHead) {
             freeAllMqttTopics(pMqttSession);
         }
+        while (uShortRangePktListDropPacket(&pMqttSession->rxPkt) == 0) {}
 
         memset(pMqttSession, 0, sizeof(uWifiMqttSession_t));
         pMqttSession->sessionHandle = -1;
@@ -1297,6 +1328,93 @@ int32_t uWifiMqttMessageRead(const uMqttClientContext_t *pContext,
     return err;
 }
 
+int32_t uWifiMqttMessagePeek(const uMqttClientContext_t *pContext,
+                             const char **ppTopicNameStr,
+                             uWifiMqttMessageSlice_t *pSlices,
+                             size_t numSlices)
+{
+    uWifiMqttSession_t *pMqttSession;
+    uShortRangePrivateInstance_t *pInstance;
+    int32_t errorCodeOrSize = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+    const uShortRangePbufList_t *pBufList;
+    const char *pData;
+    size_t size;
+
+    if ((ppTopicNameStr != NULL) && ((pSlices != NULL) || (numSlices == 0)) &&
+        (uShortRangeLock() == (int32_t)U_ERROR_COMMON_SUCCESS)) {
+
+        // Check WiFi SHO handle and MQTT session exists
+        if (getMqttInstance(pContext, &pInstance, &pMqttSession) == (int32_t)U_ERROR_COMMON_SUCCESS) {
+
+            U_PORT_MUTEX_LOCK(gMqttSessionMutex);
+
+            errorCodeOrSize = (int32_t)U_ERROR_COMMON_EMPTY;
+            pBufList = pMqttSession->rxPkt.pBufListHead;
+            if ((pMqttSession->rxPkt.pktCount > 0) && (pBufList != NULL)) {
+                // The message stays at the head of the queue, where
+                // nothing but a read or a release will disturb it
+                *ppTopicNameStr = getTopicStrForEdmChannel(pMqttSession, pBufList->edmChannel);
+                errorCodeOrSize = 0;
+                for (size_t x = 0; x < numSlices; x++) {
+                    pData = NULL;
+                    size = uShortRangePbufListPeek(pBufList, x, &pData);
+                    pSlices[x].pData = pData;
+                    pSlices[x].sizeBytes = size;
+                    errorCodeOrSize += (int32_t) size;
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMqttSessionMutex);
+        }
+        uShortRangeUnlock();
+    }
+
+    return errorCodeOrSize;
+}
+
+int32_t uWifiMqttMessageRelease(const uMqttClientContext_t *pContext)
+{
+    uWifiMqttSession_t *pMqttSession;
+    uShortRangePrivateInstance_t *pInstance;
+    int32_t err = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (uShortRangeLock() == (int32_t)U_ERROR_COMMON_SUCCESS) {
+
+        // Check WiFi SHO handle and MQTT session exists
+        if (getMqttInstance(pContext, &pInstance, &pMqttSession) == (int32_t)U_ERROR_COMMON_SUCCESS) {
+
+            U_PORT_MUTEX_LOCK(gMqttSessionMutex);
+            err = uShortRangePktListDropPacket(&pMqttSession->rxPkt);
+            pMqttSession->unreadMsgsCount = pMqttSession->rxPkt.pktCount;
+            U_PORT_MUTEX_UNLOCK(gMqttSessionMutex);
+        }
+        uShortRangeUnlock();
+    }
+
+    return err;
+}
+
+int32_t uWifiMqttGetRxDropCount(const uMqttClientContext_t *pContext)
+{
+    uWifiMqttSession_t *pMqttSession;
+    uShortRangePrivateInstance_t *pInstance;
+    int32_t errorCodeOrCount = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (uShortRangeLock() == (int32_t)U_ERROR_COMMON_SUCCESS) {
+
+        // Check WiFi SHO handle and MQTT session exists
+        if (getMqttInstance(pContext, &pInstance, &pMqttSession) == (int32_t)U_ERROR_COMMON_SUCCESS) {
+
+            U_PORT_MUTEX_LOCK(gMqttSessionMutex);
+            errorCodeOrCount = pMqttSession->rxDropCount;
+            U_PORT_MUTEX_UNLOCK(gMqttSessionMutex);
+        }
+        uShortRangeUnlock();
+    }
+
+    return errorCodeOrCount;
+}
+
 bool uWifiMqttIsConnected(const uMqttClientContext_t *pContext)
 {
     uWifiMqttSession_t *pMqttSession;
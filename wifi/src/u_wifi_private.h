@@ -52,6 +52,30 @@ extern "C" {
  */
 void uWifiPrivateUudhttpUrc(uAtClientHandle_t atHandle, void *pParameter);
 
+/** Get the BSSIDs of the strongest access points found by the last
+ * scan for any SSID, as kept for uWifiStationScanCached(), sorted
+ * in ascending binary order so that the same set of access points
+ * always gives the same list.  The caller must have the short range
+ * mutex locked.
+ *
+ * @param[in] pWifiScanCache the pWifiScanCache member of the short
+ *                           range instance, may be NULL.
+ * @param maxAgeMs           the maximum age of the scan that may be
+ *                           used.
+ * @param rssiDbmFilter      ignore access points with a received
+ *                           signal strength less than this.
+ * @param[out] pBssids       a place to put up to maxNum BSSIDs, each
+ *                           of #U_WIFI_BSSID_SIZE bytes.
+ * @param maxNum             the number of BSSIDs that will fit at
+ *                           pBssids.
+ * @return                   the number of BSSIDs written to pBssids,
+ *                           zero if there is no scan recent enough.
+ */
+size_t uWifiPrivateScanCacheGetBssids(const void *pWifiScanCache,
+                                      int32_t maxAgeMs,
+                                      int32_t rssiDbmFilter,
+                                      uint8_t *pBssids, size_t maxNum);
+
 #ifdef __cplusplus
 }
 #endif
@@ -103,6 +103,8 @@ typedef struct {
     int32_t remotePort;
     uShortRangePbufList_t *pTcpRxBuff;
     uShortRangePktList_t udpPktList;
+    int32_t rxDropCount; /**< The number of datagrams dropped
+                              because the queue was full. */
     int32_t intOpts[WIFI_INT_OPT_MAX];
     uWifiSockCallback_t pAsyncClosedCallback; /**< Set to NULL if socket is not in use. */
     uWifiSockCallback_t pDataCallback; /**< Set to NULL if socket is not in use. */
@@ -146,8 +148,8 @@ static uPingContext_t gPingContext;
  * -------------------------------------------------------------- */
 
 /* Workaround for WiFi captive portal. Used to control the accept()
-   timeout for now. Will be removed once a full select() implementation
-   is available.
+   timeout for now, in seconds: -1 to wait forever, 0 to check once and
+   return immediately, since a listening socket is not visible to select().
 */
 int32_t gUWifiSocketAcceptTimeoutS = -1;
 
@@ -194,6 +196,7 @@ static uWifiSockSocket_t *pAllocateSocket(uDeviceHandle_t devHandle)
             } else if (pSock->protocol == U_SOCK_PROTOCOL_UDP) {
                 memset((void *)(&pSock->udpPktList), 0, sizeof(uShortRangePktList_t));
             }
+            pSock->rxDropCount = 0;
             break;
         }
     }
@@ -620,6 +623,21 @@ static void edmIpConnectionCallback(int32_t edmHandle,
     }
 }
 
+// Return true if there is room for another datagram of the given
+// size in the receive queue of a UDP socket.
+static bool udpQueueHasRoom(const uWifiSockSocket_t *pSock, size_t size)
+{
+    size_t queuedBytes = size;
+
+    for (const uShortRangePbufList_t *pList = pSock->udpPktList.pBufListHead;
+         pList != NULL; pList = pList->pNext) {
+        queuedBytes += pList->totalLen;
+    }
+
+    return (pSock->udpPktList.pktCount < U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS) &&
+           (queuedBytes <= U_WIFI_SOCK_UDP_QUEUE_MAX_BYTES);
+}
+
 static void edmIpDataCallback(int32_t edmHandle, int32_t edmChannel,
                               uShortRangePbufList_t *pBufList,
                               void *pCallbackParameter)
@@ -641,8 +659,12 @@ static void edmIpDataCallback(int32_t edmHandle, int32_t edmChannel,
     if (pSock) {
         sockHandle = pSock->sockHandle;
         if (pSock->protocol == U_SOCK_PROTOCOL_UDP) {
-            if (uShortRangePktListAppend(&pSock->udpPktList,
-                                         pBufList) != (int32_t)U_ERROR_COMMON_SUCCESS) {
+            if (!udpQueueHasRoom(pSock, pBufList->totalLen)) {
+                // Drop it rather than let this socket hog the pbufs
+                pSock->rxDropCount++;
+                uShortRangePbufListFree(pBufList);
+            } else if (uShortRangePktListAppend(&pSock->udpPktList,
+                                                pBufList) != (int32_t)U_ERROR_COMMON_SUCCESS) {
                 uPortLog("U_WIFI_SOCK: UDP pkt insert failed\n");
                 uShortRangePbufListFree(pBufList);
             }
@@ -1343,6 +1365,84 @@ int32_t uWifiSockRead(uDeviceHandle_t devHandle,
     return errnoLocal;
 }
 
+int32_t uWifiSockReadPeek(uDeviceHandle_t devHandle,
+                          int32_t sockHandle,
+                          uSockIoVec_t *pIoVec, size_t count)
+{
+    int32_t errnoLocal;
+    uWifiSockSocket_t *pSock = NULL;
+    uShortRangePrivateInstance_t *pInstance = NULL;
+    const char *pData;
+    size_t size;
+
+    if ((pIoVec == NULL) && (count > 0)) {
+        return -U_SOCK_EINVAL;
+    }
+
+    if (uShortRangeLock() != (int32_t) U_ERROR_COMMON_SUCCESS) {
+        return -U_SOCK_EIO;
+    }
+
+    errnoLocal = getInstanceAndSocket(devHandle, sockHandle, &pInstance, &pSock);
+
+    // As for Read, only TCP sockets are supported
+    if ((errnoLocal == U_SOCK_ENONE) && (pSock->protocol != U_SOCK_PROTOCOL_TCP)) {
+        errnoLocal = -U_SOCK_EOPNOTSUPP;
+    }
+
+    if (errnoLocal == U_SOCK_ENONE) {
+        for (size_t x = 0; x < count; x++) {
+            // The pbufs of the receive list are handed out as they are
+            pData = NULL;
+            size = uShortRangePbufListPeek(pSock->pTcpRxBuff, x, &pData);
+            pIoVec[x].pData = (void *) pData;
+            pIoVec[x].dataSizeBytes = size;
+            errnoLocal += (int32_t) size;
+        }
+        if (errnoLocal == 0) {
+            // If there are no data available we must return U_SOCK_EWOULDBLOCK
+            errnoLocal = -U_SOCK_EWOULDBLOCK;
+        }
+    }
+
+    uShortRangeUnlock();
+
+    return errnoLocal;
+}
+
+int32_t uWifiSockReadRelease(uDeviceHandle_t devHandle,
+                             int32_t sockHandle,
+                             size_t dataSizeBytes)
+{
+    int32_t errnoLocal;
+    uWifiSockSocket_t *pSock = NULL;
+    uShortRangePrivateInstance_t *pInstance = NULL;
+    uShortRangePbufList_t *pList;
+
+    if (uShortRangeLock() != (int32_t) U_ERROR_COMMON_SUCCESS) {
+        return -U_SOCK_EIO;
+    }
+
+    errnoLocal = getInstanceAndSocket(devHandle, sockHandle, &pInstance, &pSock);
+
+    if ((errnoLocal == U_SOCK_ENONE) && (pSock->protocol != U_SOCK_PROTOCOL_TCP)) {
+        errnoLocal = -U_SOCK_EOPNOTSUPP;
+    }
+
+    if (errnoLocal == U_SOCK_ENONE) {
+        pList = pSock->pTcpRxBuff;
+        errnoLocal = (int32_t) uShortRangePbufListSkip(pList, dataSizeBytes);
+        if ((pList != NULL) && (pList->totalLen == 0)) {
+            uShortRangePbufListFree(pList);
+            pSock->pTcpRxBuff = NULL;
+        }
+    }
+
+    uShortRangeUnlock();
+
+    return errnoLocal;
+}
+
 int32_t uWifiSockSendTo(uDeviceHandle_t devHandle,
                         int32_t sockHandle,
                         const uSockAddress_t *pRemoteAddress,
@@ -1519,6 +1619,27 @@ int32_t uWifiSockReceiveFrom(uDeviceHandle_t devHandle,
     return errnoLocal;
 }
 
+int32_t uWifiSockGetRxDropCount(uDeviceHandle_t devHandle,
+                                int32_t sockHandle)
+{
+    int32_t errnoLocal;
+    uShortRangePrivateInstance_t *pInstance = NULL;
+    uWifiSockSocket_t *pSock = NULL;
+
+    if (uShortRangeLock() != (int32_t) U_ERROR_COMMON_SUCCESS) {
+        return -U_SOCK_EIO;
+    }
+
+    errnoLocal = getInstanceAndSocket(devHandle, sockHandle, &pInstance, &pSock);
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = pSock->rxDropCount;
+    }
+
+    uShortRangeUnlock();
+
+    return errnoLocal;
+}
+
 
 int32_t uWifiSockRegisterCallbackData(uDeviceHandle_t devHandle,
                                       int32_t sockHandle,
@@ -1766,7 +1887,10 @@ int32_t uWifiSockAccept(uDeviceHandle_t devHandle,
         if (pClientSock) {
             *pRemoteAddress = pClientSock->remoteAddress;
             return pClientSock->sockHandle;
-        } else if (gUWifiSocketAcceptTimeoutS >= 0) {
+        } else if (gUWifiSocketAcceptTimeoutS == 0) {
+            // Zero means just check, so that an event loop can poll
+            return U_ERROR_COMMON_TIMEOUT;
+        } else if (gUWifiSocketAcceptTimeoutS > 0) {
             if ((uPortGetTickTimeMs() - startTimeMs) / 1000 >
                 gUWifiSocketAcceptTimeoutS) {
                 return U_ERROR_COMMON_TIMEOUT;
@@ -126,6 +126,14 @@ U_PORT_TEST_FUNCTION("[wifiCfg]", "wifiCfgConfigureModule")
     cfg.dhcp = true; // set DHCP
     U_PORT_TEST_ASSERT(uWifiCfgConfigure(gHandles.devHandle, &cfg) == 0);
 
+    // Do the same again as a batch: any store-and-restart
+    // happens at most once, at the end
+    U_PORT_TEST_ASSERT(uShortRangeCfgBatchStart(gHandles.devHandle) == 0);
+    cfg.dhcp = false;
+    U_PORT_TEST_ASSERT(uWifiCfgConfigure(gHandles.devHandle, &cfg) == 0);
+    cfg.dhcp = true;
+    U_PORT_TEST_ASSERT(uWifiCfgConfigure(gHandles.devHandle, &cfg) == 0);
+    U_PORT_TEST_ASSERT(uShortRangeCfgBatchEnd(gHandles.devHandle) >= 0);
 
     uWifiTestPrivatePostamble(&gHandles);
 
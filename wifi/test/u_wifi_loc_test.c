@@ -290,6 +290,7 @@ U_PORT_TEST_FUNCTION("[wifiLoc]", "wifiLocBasic")
     int32_t resourceCount;
     int32_t startTimeMs = 0;
     uLocation_t location;
+    uLocation_t cachedLocation;
 
     resourceCount = uTestUtilGetDynamicResourceCount();
 
@@ -326,6 +327,38 @@ U_PORT_TEST_FUNCTION("[wifiLoc]", "wifiLocBasic")
             U_PORT_TEST_ASSERT(location.timeUtc == -1);
             U_PORT_TEST_ASSERT(location.speedMillimetresPerSecond == INT_MIN);
             U_PORT_TEST_ASSERT(location.svs == -1);
+
+            // With the cache on, the first request goes to the cloud
+            // and the second must be answered from the cache, since
+            // we've not moved; to prove that it is, the second request
+            // is given an API key that the cloud would reject
+            U_TEST_PRINT_LINE("testing the location cache with %s.", gLocType[gIteration].pName);
+            U_PORT_TEST_ASSERT(uWifiLocSetCache(gHandles.devHandle, 3600) == 0);
+            gStopTimeMs = uPortGetTickTimeMs() + U_WIFI_LOC_TEST_TIMEOUT_SECONDS * 1000;
+            z = uWifiLocGet(gHandles.devHandle, gLocType[gIteration].type,
+                            gLocType[gIteration].pApiKey,
+                            U_WIFI_LOC_TEST_AP_FILTER,
+                            U_WIFI_LOC_TEST_RSSI_FILTER_DBM,
+                            &location, keepGoingCallback);
+            if (z == 0) {
+                cachedLocation = location;
+                startTimeMs = uPortGetTickTimeMs();
+                gStopTimeMs = startTimeMs + U_WIFI_LOC_TEST_TIMEOUT_SECONDS * 1000;
+                locationSetDefaults(&location);
+                z = uWifiLocGet(gHandles.devHandle, gLocType[gIteration].type,
+                                "not a valid API key",
+                                U_WIFI_LOC_TEST_AP_FILTER,
+                                U_WIFI_LOC_TEST_RSSI_FILTER_DBM,
+                                &location, keepGoingCallback);
+                U_TEST_PRINT_LINE("cached uWifiLocGet() for %s returned %d in %d ms.",
+                                  gLocType[gIteration].pName, z, uPortGetTickTimeMs() - startTimeMs);
+                U_PORT_TEST_ASSERT(z == 0);
+                U_PORT_TEST_ASSERT(location.latitudeX1e7 == cachedLocation.latitudeX1e7);
+                U_PORT_TEST_ASSERT(location.longitudeX1e7 == cachedLocation.longitudeX1e7);
+                U_PORT_TEST_ASSERT(location.radiusMillimetres == cachedLocation.radiusMillimetres);
+            }
+            U_PORT_TEST_ASSERT(uWifiLocSetCache(gHandles.devHandle, 0) == 0);
+            z = 0;
         } else {
             U_TEST_PRINT_LINE("*** WARNING *** %s cloud service was unable to determine position,"
                               " HTTP status code %d.", gLocType[gIteration].pName, z);
@@ -64,6 +64,7 @@
 #include "u_wifi_test_private.h"
 #include "u_mqtt_common.h"
 #include "u_mqtt_client.h"
+#include "u_wifi_mqtt.h"
 #include "u_security_credential.h"
 
 /* ----------------------------------------------------------------
@@ -403,6 +404,48 @@ static int32_t wifiMqttUnsubscribeTest(bool isSecuredConnection)
     return err;
 }
 
+// Check the oldest received message in place, with
+// uWifiMqttMessagePeek(), and then release it: the topic must be one
+// of the two given and the payload one of gTestPublishMsg[].
+static bool peekAndReleaseMessage(const char *pTopic1, const char *pTopic2)
+{
+    bool success = false;
+    const char *pTopicName = NULL;
+    uWifiMqttMessageSlice_t slices[4];
+    char buffer[64];
+    size_t length = 0;
+    int32_t sizeBytes;
+
+    sizeBytes = uWifiMqttMessagePeek(gpMqttClientCtx, &pTopicName, slices,
+                                     sizeof(slices) / sizeof(slices[0]));
+    if ((sizeBytes > 0) && (sizeBytes < (int32_t) sizeof(buffer)) && (pTopicName != NULL) &&
+        ((strcmp(pTopicName, pTopic1) == 0) || (strcmp(pTopicName, pTopic2) == 0))) {
+        // Put the slices back together
+        for (size_t x = 0; x < sizeof(slices) / sizeof(slices[0]); x++) {
+            if ((slices[x].sizeBytes > 0) && (length + slices[x].sizeBytes <= (size_t) sizeBytes)) {
+                memcpy(buffer + length, slices[x].pData, slices[x].sizeBytes);
+                length += slices[x].sizeBytes;
+            }
+        }
+        buffer[length] = 0;
+        U_TEST_PRINT_LINE("peeked topic %s message %s size %d.", pTopicName,
+                          buffer, sizeBytes);
+        for (size_t x = 0; !success && (x < MQTT_PUBLISH_TOTAL_MSG_COUNT); x++) {
+            success = (length == (size_t) sizeBytes) &&
+                      (strcmp(buffer, gTestPublishMsg[x]) == 0);
+        }
+        // Peeking again must give the same message
+        success = success &&
+                  (uWifiMqttMessagePeek(gpMqttClientCtx, &pTopicName, slices,
+                                        sizeof(slices) / sizeof(slices[0])) == sizeBytes);
+    }
+    if (uWifiMqttMessageRelease(gpMqttClientCtx) != (int32_t) U_ERROR_COMMON_SUCCESS) {
+        success = false;
+    }
+
+    return success;
+}
+
 static int32_t wifiMqttPublishSubscribeTest(bool isSecuredConnection)
 {
 
@@ -414,6 +457,7 @@ static int32_t wifiMqttPublishSubscribeTest(bool isSecuredConnection)
     char *pTopicOut2;
     char *pTopicIn;
     char *pMessageIn;
+    const char *pTopicPeek = NULL;
     int32_t topicId1;
     int32_t topicId2;
     int32_t count;
@@ -517,20 +561,36 @@ static int32_t wifiMqttPublishSubscribeTest(bool isSecuredConnection)
     }
 
     U_PORT_TEST_ASSERT(err == (int32_t)U_ERROR_COMMON_SUCCESS);
+    // All of the messages fit in the receive queue
+    U_PORT_TEST_ASSERT(uWifiMqttGetRxDropCount(gpMqttClientCtx) == 0);
+    U_PORT_TEST_ASSERT(uWifiMqttMessagePeek(gpMqttClientCtx, NULL, NULL, 0) < 0);
+    // Read half of the messages in place and half by copying
+    count = 0;
     while (uMqttClientGetUnread(gpMqttClientCtx) != 0) {
 
-        msgBufSz = U_MQTT_CLIENT_TEST_READ_MESSAGE_MAX_LENGTH_BYTES;
+        if ((count & 1) == 0) {
+            U_PORT_TEST_ASSERT(peekAndReleaseMessage(pTopicOut1, pTopicOut2));
+        } else {
+            msgBufSz = U_MQTT_CLIENT_TEST_READ_MESSAGE_MAX_LENGTH_BYTES;
 
-        uMqttClientMessageRead(gpMqttClientCtx,
-                               pTopicIn,
-                               U_MQTT_CLIENT_TEST_READ_TOPIC_MAX_LENGTH_BYTES,
-                               pMessageIn,
-                               &msgBufSz,
-                               &qos);
+            uMqttClientMessageRead(gpMqttClientCtx,
+                                   pTopicIn,
+                                   U_MQTT_CLIENT_TEST_READ_TOPIC_MAX_LENGTH_BYTES,
+                                   pMessageIn,
+                                   &msgBufSz,
+                                   &qos);
 
-        U_TEST_PRINT_LINE("for topic %s msgBuf content %s msg size %d.",
-                          pTopicIn, pMessageIn, msgBufSz);
+            U_TEST_PRINT_LINE("for topic %s msgBuf content %s msg size %d.",
+                              pTopicIn, pMessageIn, msgBufSz);
+        }
+        count++;
     }
+    U_PORT_TEST_ASSERT(count == (MQTT_PUBLISH_TOTAL_MSG_COUNT << 1));
+    U_PORT_TEST_ASSERT(uWifiMqttMessagePeek(gpMqttClientCtx, &pTopicPeek,
+                                            NULL, 0) == (int32_t) U_ERROR_COMMON_EMPTY);
+    U_PORT_TEST_ASSERT(uWifiMqttMessageRelease(gpMqttClientCtx) ==
+                       (int32_t) U_ERROR_COMMON_EMPTY);
+    U_PORT_TEST_ASSERT(uWifiMqttGetRxDropCount(gpMqttClientCtx) == 0);
     U_PORT_TEST_ASSERT(uMqttClientGetTotalMessagesReceived(gpMqttClientCtx) ==
                        (MQTT_PUBLISH_TOTAL_MSG_COUNT << 1));
 
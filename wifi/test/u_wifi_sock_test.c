@@ -313,6 +313,52 @@ static void wifiNetworkStatusCallback(uDeviceHandle_t devHandle,
     gWifiStatusMask = statusMask;
 }
 
+// Read up to size bytes from the TCP socket in place with
+// uWifiSockReadPeek(), copying them to pBuffer, and then consume
+// them with uWifiSockReadRelease(); returns the number of bytes
+// read or negative error code.
+static int32_t readPeekTcp(char *pBuffer, size_t size)
+{
+    int32_t returnCode;
+    uSockIoVec_t ioVec[3];
+    const void *pFirst;
+    int32_t total;
+    size_t length = 0;
+    size_t x;
+
+    returnCode = uWifiSockReadPeek(gHandles.devHandle, gSockHandleTcp,
+                                   ioVec, sizeof(ioVec) / sizeof(ioVec[0]));
+    if (returnCode > 0) {
+        // Peeking again must give at least the same data since
+        // nothing has been consumed
+        pFirst = ioVec[0].pData;
+        total = returnCode;
+        returnCode = uWifiSockReadPeek(gHandles.devHandle, gSockHandleTcp,
+                                       ioVec, sizeof(ioVec) / sizeof(ioVec[0]));
+        if ((returnCode < total) || (ioVec[0].pData != pFirst)) {
+            U_TEST_PRINT_LINE("second uWifiSockReadPeek() differs from the first.");
+            returnCode = -1;
+        }
+    }
+    if (returnCode > 0) {
+        for (x = 0; (x < sizeof(ioVec) / sizeof(ioVec[0])) && (length < size); x++) {
+            if (ioVec[x].dataSizeBytes > size - length) {
+                ioVec[x].dataSizeBytes = size - length;
+            }
+            memcpy(pBuffer + length, ioVec[x].pData, ioVec[x].dataSizeBytes);
+            length += ioVec[x].dataSizeBytes;
+        }
+        returnCode = uWifiSockReadRelease(gHandles.devHandle, gSockHandleTcp, length);
+        if (returnCode != (int32_t) length) {
+            U_TEST_PRINT_LINE("uWifiSockReadRelease() returned %d, expected %d.",
+                              returnCode, length);
+            returnCode = -1;
+        }
+    }
+
+    return returnCode;
+}
+
 // Helper function to connect wifi
 static void connectWifi()
 {
@@ -526,8 +572,13 @@ U_PORT_TEST_FUNCTION("[wifiSock]", "wifiSockTCPTest")
             }
             chunkCounter++;
 
-            returnCode = uWifiSockRead(gHandles.devHandle, gSockHandleTcp,
-                                       pBuffer + bytesRead, bytesToRead);
+            // Alternate between reading by copying and reading in place
+            if ((chunkCounter & 1) == 0) {
+                returnCode = readPeekTcp(pBuffer + bytesRead, bytesToRead);
+            } else {
+                returnCode = uWifiSockRead(gHandles.devHandle, gSockHandleTcp,
+                                           pBuffer + bytesRead, bytesToRead);
+            }
             if (returnCode > 0) {
                 bytesRead += returnCode;
             } else if (returnCode == 0) {
@@ -729,6 +780,35 @@ U_PORT_TEST_FUNCTION("[wifiSock]", "wifiSockUDPTest")
                                sizeof(gAllChars)) == 0);
     }
 
+    if (!TEST_HAS_ERROR()) {
+        // Flood the socket with more small datagrams than its
+        // receive queue can hold, without reading them, then check
+        // that no more than the queue limit were kept and that, if
+        // any were dropped, the queue was full
+        size_t numSent = U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS + 4;
+        size_t numReceived = 0;
+        int32_t dropCount;
+        TEST_CHECK_TRUE(uWifiSockGetRxDropCount(gHandles.devHandle, -1) < 0);
+        TEST_CHECK_TRUE(uWifiSockGetRxDropCount(gHandles.devHandle, gSockHandleUdp) == 0);
+        U_TEST_PRINT_LINE("sending %d datagram(s) without reading them...", (int) numSent);
+        for (size_t x = 0; !TEST_HAS_ERROR() && (x < numSent); x++) {
+            TEST_CHECK_TRUE(uWifiSockSendTo(gHandles.devHandle, gSockHandleUdp,
+                                            &remoteAddress, gAllChars, 16) == 16);
+        }
+        uPortTaskBlock(5000);
+        dropCount = uWifiSockGetRxDropCount(gHandles.devHandle, gSockHandleUdp);
+        while (uWifiSockReceiveFrom(gHandles.devHandle, gSockHandleUdp, &rxAddress,
+                                    pBuffer, U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES) == 16) {
+            numReceived++;
+        }
+        U_TEST_PRINT_LINE("%d datagram(s) queued, %d dropped.", (int) numReceived,
+                          (int) dropCount);
+        TEST_CHECK_TRUE(dropCount >= 0);
+        TEST_CHECK_TRUE(numReceived <= U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS);
+        TEST_CHECK_TRUE(numReceived + (size_t) dropCount <= numSent);
+        TEST_CHECK_TRUE((dropCount == 0) || (numReceived == U_WIFI_SOCK_UDP_QUEUE_MAX_PACKETS));
+    }
+
     if (!TEST_HAS_ERROR()) {
         // Socket should still be open
         TEST_CHECK_TRUE(!gClosedCallbackCalledUdp);
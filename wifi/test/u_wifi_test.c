@@ -174,16 +174,89 @@ static void wifiNetworkStatusCallback(uDeviceHandle_t devHandle,
 }
 
 
-static uWifiTestError_t runWifiTest(const char *pSsid, const char *pPassPhrase)
+// Connect to the given network, wait for the IP addresses and then
+// disconnect again.
+static uWifiTestError_t connectDisconnect(const char *pSsid, const char *pPassPhrase)
 {
-    uWifiTestError_t testError = U_WIFI_TEST_ERROR_NONE;
+    uWifiTestError_t testError;
     uWifiTestError_t connectError = U_WIFI_TEST_ERROR_NONE;
     uWifiTestError_t disconnectError = U_WIFI_TEST_ERROR_NONE;
     int32_t waitCtr = 0;
+    int32_t startTimeMs;
     gWifiStatusMask = 0;
     gWifiConnected = 0;
     gWifiDisconnected = 0;
 
+    // Connect to wifi network
+    startTimeMs = uPortGetTickTimeMs();
+    int32_t res = uWifiStationConnect(gHandles.devHandle,
+                                      pSsid,
+                                      U_WIFI_AUTH_WPA_PSK,
+                                      pPassPhrase);
+    if (res == 0) {
+        //Wait for connection and IP events.
+        //There could be multiple IP events depending on network configuration.
+        while (!connectError && (!gWifiConnected || (gWifiStatusMask != gWifiStatusMaskAllUp))) {
+            if (waitCtr >= 15) {
+                if (!gWifiConnected) {
+                    U_TEST_PRINT_LINE("unable to connect to WiFi network.");
+                    connectError = U_WIFI_TEST_ERROR_CONNECTED;
+                } else {
+                    U_TEST_PRINT_LINE("unable to retrieve IP address.");
+                    connectError = U_WIFI_TEST_ERROR_IPRECV;
+                }
+                break;
+            }
+
+            uPortTaskBlock(1000);
+            waitCtr++;
+        }
+        if (!connectError) {
+            U_TEST_PRINT_LINE("connected in %d ms.", uPortGetTickTimeMs() - startTimeMs);
+        }
+    } else {
+        connectError = U_WIFI_TEST_ERROR_CONNECT;
+    }
+
+    // Disconnect from wifi network (regardless of previous connectError)
+    if (uWifiStationDisconnect(gHandles.devHandle) == 0) {
+        waitCtr = 0;
+        while (!disconnectError && (!gWifiDisconnected || (gWifiStatusMask > 0))) {
+            if (waitCtr >= 5) {
+                disconnectError = U_WIFI_TEST_ERROR_DISCONNECT;
+                if (!gWifiDisconnected) {
+                    U_TEST_PRINT_LINE("unable to diconnect from wifi network.");
+                } else {
+                    U_TEST_PRINT_LINE("network status is still up.");
+                }
+                break;
+            }
+            uPortTaskBlock(1000);
+            waitCtr++;
+        }
+    } else {
+        disconnectError = U_WIFI_TEST_ERROR_DISCONNECT;
+    }
+
+    // Aggregate result
+    if (connectError != U_WIFI_TEST_ERROR_NONE) {
+        testError = connectError;
+    } else {
+        testError = disconnectError;
+    }
+
+    return testError;
+}
+
+// Run the preamble, connect and disconnect and then run the
+// postamble; if fastConnect is true then fast connect is switched
+// on and the connection is made twice, the second time using what
+// was learnt the first time.
+static uWifiTestError_t runWifiTest(const char *pSsid, const char *pPassPhrase,
+                                    bool fastConnect)
+{
+    uWifiTestError_t testError = U_WIFI_TEST_ERROR_NONE;
+
     // Do the standard preamble
     if (0 != uWifiTestPrivatePreamble((uWifiModuleType_t) U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
                                       &uart,
@@ -198,62 +271,19 @@ static uWifiTestError_t runWifiTest(const char *pSsid, const char *pPassPhrase)
         // Add unsolicited response cb for IP status
         uWifiSetNetworkStatusCallback(gHandles.devHandle,
                                       wifiNetworkStatusCallback, NULL);
-        // Connect to wifi network
-        int32_t res = uWifiStationConnect(gHandles.devHandle,
-                                          pSsid,
-                                          U_WIFI_AUTH_WPA_PSK,
-                                          pPassPhrase);
-        if (res == 0) {
-            //Wait for connection and IP events.
-            //There could be multiple IP events depending on network configuration.
-            while (!connectError && (!gWifiConnected || (gWifiStatusMask != gWifiStatusMaskAllUp))) {
-                if (waitCtr >= 15) {
-                    if (!gWifiConnected) {
-                        U_TEST_PRINT_LINE("unable to connect to WiFi network.");
-                        connectError = U_WIFI_TEST_ERROR_CONNECTED;
-                    } else {
-                        U_TEST_PRINT_LINE("unable to retrieve IP address.");
-                        connectError = U_WIFI_TEST_ERROR_IPRECV;
-                    }
-                    break;
-                }
-
-                uPortTaskBlock(1000);
-                waitCtr++;
-            }
-        } else {
-            connectError = U_WIFI_TEST_ERROR_CONNECT;
+        if (fastConnect && (uWifiStationSetFastConnect(gHandles.devHandle, true) != 0)) {
+            testError = U_WIFI_TEST_ERROR_CONNECT;
         }
-    }
-
-    if (testError == U_WIFI_TEST_ERROR_NONE) {
-        // Disconnect from wifi network (regardless of previous connectError)
-        if (uWifiStationDisconnect(gHandles.devHandle) == 0) {
-            waitCtr = 0;
-            while (!disconnectError && (!gWifiDisconnected || (gWifiStatusMask > 0))) {
-                if (waitCtr >= 5) {
-                    disconnectError = U_WIFI_TEST_ERROR_DISCONNECT;
-                    if (!gWifiDisconnected) {
-                        U_TEST_PRINT_LINE("unable to diconnect from wifi network.");
-                    } else {
-                        U_TEST_PRINT_LINE("network status is still up.");
-                    }
-                    break;
-                }
-                uPortTaskBlock(1000);
-                waitCtr++;
-            }
-        } else {
-            disconnectError = U_WIFI_TEST_ERROR_DISCONNECT;
+        if (testError == U_WIFI_TEST_ERROR_NONE) {
+            testError = connectDisconnect(pSsid, pPassPhrase);
         }
-    }
-
-    // Aggregate result
-    if (testError == U_WIFI_TEST_ERROR_NONE) {
-        if (connectError != U_WIFI_TEST_ERROR_NONE) {
-            testError = connectError;
-        } else {
-            testError = disconnectError;
+        if (fastConnect && (testError == U_WIFI_TEST_ERROR_NONE)) {
+            U_TEST_PRINT_LINE("connecting again, on the channel learnt.");
+            testError = connectDisconnect(pSsid, pPassPhrase);
+        }
+        if (fastConnect && (uWifiStationSetFastConnect(gHandles.devHandle, false) != 0) &&
+            (testError == U_WIFI_TEST_ERROR_NONE)) {
+            testError = U_WIFI_TEST_ERROR_DISCONNECT;
         }
     }
 
@@ -438,7 +468,23 @@ U_PORT_TEST_FUNCTION("[wifi]", "wifiNetworkInitialisation")
 U_PORT_TEST_FUNCTION("[wifi]", "wifiStationConnect")
 {
     uWifiTestError_t testError = runWifiTest(U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_SSID),
-                                             U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_WPA2_PASSPHRASE));
+                                             U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_WPA2_PASSPHRASE),
+                                             false);
+    // Handle errors
+    U_PORT_TEST_ASSERT(testError == U_WIFI_TEST_ERROR_NONE);
+    // Printed for information: asserting happens in the postamble
+    uTestUtilResourceCheck(U_TEST_PREFIX, NULL, true);
+}
+
+/** Connect twice with fast connect on: the second connection is
+ * made on the channel learnt from the first.
+ */
+U_PORT_TEST_FUNCTION("[wifi]", "wifiStationConnectFast")
+{
+    U_PORT_TEST_ASSERT(uWifiStationSetFastConnect(NULL, true) < 0);
+    uWifiTestError_t testError = runWifiTest(U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_SSID),
+                                             U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_WPA2_PASSPHRASE),
+                                             true);
     // Handle errors
     U_PORT_TEST_ASSERT(testError == U_WIFI_TEST_ERROR_NONE);
     // Printed for information: asserting happens in the postamble
@@ -450,7 +496,8 @@ U_PORT_TEST_FUNCTION("[wifi]", "wifiStationConnectWrongSSID")
     gLookForDisconnectReasonBitMask = (1 << U_WIFI_REASON_OUT_OF_RANGE); // (cant find SSID)
     gDisconnectReasonFound = 0;
     uWifiTestError_t testError = runWifiTest("DUMMYSSID",
-                                             U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_WPA2_PASSPHRASE));
+                                             U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_WPA2_PASSPHRASE),
+                                             false);
 
     // Handle errors
     U_PORT_TEST_ASSERT(testError == U_WIFI_TEST_ERROR_CONNECTED);
@@ -467,7 +514,7 @@ U_PORT_TEST_FUNCTION("[wifi]", "wifiStationConnectWrongPassphrase")
                                       (1 << U_WIFI_REASON_SECURITY_PROBLEM);
     gDisconnectReasonFound = 0;
     uWifiTestError_t testError = runWifiTest(U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_SSID),
-                                             "WRONGPASSWD");
+                                             "WRONGPASSWD", false);
     // Handle errors
     U_PORT_TEST_ASSERT(testError == U_WIFI_TEST_ERROR_CONNECTED);
     U_PORT_TEST_ASSERT(gDisconnectReasonFound);
@@ -508,6 +555,17 @@ U_PORT_TEST_FUNCTION("[wifi]", "wifiScan")
     // Basic validation of the result
     U_PORT_TEST_ASSERT(validateScanResult(&gScanResult));
 
+    //----------------------------------------------------------
+    // The AP should now be in the scan cache
+    //----------------------------------------------------------
+    memset(&gScanResult, 0, sizeof(gScanResult));
+    result = uWifiStationScanCached(gHandles.devHandle,
+                                    U_PORT_STRINGIFY_QUOTED(U_WIFI_TEST_CFG_SSID),
+                                    60000, uWifiScanResultCallback);
+    U_PORT_TEST_ASSERT(result == 0);
+    U_PORT_TEST_ASSERT(gScanResult.channel != 0);
+    U_PORT_TEST_ASSERT(validateScanResult(&gScanResult));
+
     //----------------------------------------------------------
     // Scan specifically for U_WIFI_TEST_CFG_SSID
     //----------------------------------------------------------